@@ -22,6 +22,7 @@
 #include <auth/auth_srv.h>
 #include <auth/auth_config.h>
 #include <auth/common.h>
+#include <auth/rrl.h>
 
 #include <server_common/portconfig.h>
 
@@ -29,6 +30,8 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/scoped_ptr.hpp>
 
+#include <ctime>
+#include <limits>
 #include <set>
 #include <string>
 #include <utility>
@@ -137,6 +140,329 @@ private:
     size_t timeout_;
 };
 
+/// \brief Configuration for the UDP batch size
+class UDPBatchSizeConfig : public AuthConfigParser {
+public:
+    UDPBatchSizeConfig(AuthSrv& server) : server_(server), batch_size_(1)
+    {}
+
+    virtual void build(ConstElementPtr config) {
+        const int64_t max_size =
+            bundy::asiodns::DNSServiceBase::MAX_UDP_BATCH_SIZE;
+        const int64_t value = config->intValue();
+        if (value < 1 || value > max_size) {
+            bundy_throw(AuthConfigError, "udp_batch_size must be between 1 "
+                        "and " << max_size);
+        }
+        batch_size_ = value;
+    }
+
+    virtual void commit() {
+        server_.setUDPBatchSize(batch_size_);
+    }
+private:
+    AuthSrv& server_;
+    size_t batch_size_;
+};
+
+/// \brief Configuration for the TCP pipelining limit
+class TCPMaxInFlightConfig : public AuthConfigParser {
+public:
+    TCPMaxInFlightConfig(AuthSrv& server) : server_(server), max_in_flight_(16)
+    {}
+
+    virtual void build(ConstElementPtr config) {
+        if (config->intValue() < 1) {
+            bundy_throw(AuthConfigError,
+                        "tcp_max_in_flight must be 1 or higher");
+        }
+        max_in_flight_ = config->intValue();
+    }
+
+    virtual void commit() {
+        server_.setTCPMaxInFlight(max_in_flight_);
+    }
+private:
+    AuthSrv& server_;
+    size_t max_in_flight_;
+};
+
+/// \brief Configuration for the number of worker threads
+class WorkerThreadsConfig : public AuthConfigParser {
+public:
+    WorkerThreadsConfig(AuthSrv& server) : server_(server), count_(0)
+    {}
+
+    virtual void build(ConstElementPtr config) {
+        if (config->intValue() >= 0) {
+            count_ = config->intValue();
+        } else {
+            bundy_throw(AuthConfigError, "worker_threads must be 0 or higher");
+        }
+    }
+
+    virtual void commit() {
+        server_.setWorkerThreads(count_);
+    }
+private:
+    AuthSrv& server_;
+    size_t count_;
+};
+
+/// \brief Configuration for the CPUs the worker threads are bound to
+class WorkerCPUsConfig : public AuthConfigParser {
+public:
+    WorkerCPUsConfig(AuthSrv& server) : server_(server)
+    {}
+
+    virtual void build(ConstElementPtr config) {
+        std::vector<int> cpus;
+        BOOST_FOREACH(ConstElementPtr cpu, config->listValue()) {
+            if (cpu->intValue() < 0) {
+                bundy_throw(AuthConfigError,
+                            "worker_cpus must be 0 or higher: " <<
+                            cpu->intValue());
+            }
+            cpus.push_back(cpu->intValue());
+        }
+        cpus_.swap(cpus);
+    }
+
+    virtual void commit() {
+        server_.setWorkerCPUs(cpus_);
+    }
+private:
+    AuthSrv& server_;
+    std::vector<int> cpus_;
+};
+
+/// \brief Configuration for the number of threads loading zones
+class ZoneLoadThreadsConfig : public AuthConfigParser {
+public:
+    ZoneLoadThreadsConfig(AuthSrv& server) : server_(server), count_(1)
+    {}
+
+    virtual void build(ConstElementPtr config) {
+        if (config->intValue() >= 1) {
+            count_ = config->intValue();
+        } else {
+            bundy_throw(AuthConfigError,
+                        "zone_load_threads must be 1 or higher");
+        }
+    }
+
+    virtual void commit() {
+        server_.getDataSrcClientsMgr().setZoneLoadThreads(count_);
+    }
+private:
+    AuthSrv& server_;
+    size_t count_;
+};
+
+/// \brief Configuration for the minimum interval between zone reloads on
+/// updates
+class ZoneUpdateIntervalConfig : public AuthConfigParser {
+public:
+    ZoneUpdateIntervalConfig(AuthSrv& server) : server_(server), interval_(0)
+    {}
+
+    virtual void build(ConstElementPtr config) {
+        const int64_t interval = config->intValue();
+        if (interval < 0 || interval > numeric_limits<uint32_t>::max()) {
+            bundy_throw(AuthConfigError,
+                        "zone_update_interval is out of range: " << interval);
+        }
+        interval_ = interval;
+    }
+
+    virtual void commit() {
+        server_.getDataSrcClientsMgr().setZoneUpdateInterval(interval_);
+    }
+private:
+    AuthSrv& server_;
+    uint32_t interval_;
+};
+
+/// \brief Configuration for the size of the response cache
+class ResponseCacheSizeConfig : public AuthConfigParser {
+public:
+    ResponseCacheSizeConfig(AuthSrv& server) : server_(server), size_(0)
+    {}
+
+    virtual void build(ConstElementPtr config) {
+        if (config->intValue() >= 0) {
+            size_ = config->intValue();
+        } else {
+            bundy_throw(AuthConfigError,
+                        "response_cache_size must be 0 or higher");
+        }
+    }
+
+    virtual void commit() {
+        server_.setResponseCacheSize(size_);
+    }
+private:
+    AuthSrv& server_;
+    size_t size_;
+};
+
+/// \brief Configuration for the size of the NSEC3 proof cache
+class NSEC3ProofCacheSizeConfig : public AuthConfigParser {
+public:
+    NSEC3ProofCacheSizeConfig(AuthSrv& server) : server_(server), size_(0)
+    {}
+
+    virtual void build(ConstElementPtr config) {
+        if (config->intValue() >= 0) {
+            size_ = config->intValue();
+        } else {
+            bundy_throw(AuthConfigError,
+                        "nsec3_proof_cache_size must be 0 or higher");
+        }
+    }
+
+    virtual void commit() {
+        server_.setNSEC3ProofCacheSize(size_);
+    }
+private:
+    AuthSrv& server_;
+    size_t size_;
+};
+
+/// \brief Configuration for the number of zones with statistics counters
+class ZoneStatisticsConfig : public AuthConfigParser {
+public:
+    ZoneStatisticsConfig(AuthSrv& server) : server_(server), size_(0)
+    {}
+
+    virtual void build(ConstElementPtr config) {
+        if (config->intValue() >= 0) {
+            size_ = config->intValue();
+        } else {
+            bundy_throw(AuthConfigError,
+                        "statistics_zones must be 0 or higher");
+        }
+    }
+
+    virtual void commit() {
+        server_.setZoneStatisticsSize(size_);
+    }
+private:
+    AuthSrv& server_;
+    size_t size_;
+};
+
+/// \brief Configuration for response rate limiting
+///
+/// The limiter is built (and the parameters are validated) in \c build(),
+/// and it replaces the one used by the server only on \c commit().
+/// Omitted parameters get the default values here, since the NXDOMAIN and
+/// error rates default to the value of responses_per_second.
+class RRLConfig : public AuthConfigParser {
+public:
+    RRLConfig(AuthSrv& server) : server_(server)
+    {}
+
+    virtual void build(ConstElementPtr config) {
+        rrl_.reset();
+        if (!getBool(config, "enable", false)) {
+            return;
+        }
+        const int responses = getInt(config, "responses_per_second", 0);
+        try {
+            rrl_.reset(new bundy::auth::ResponseRateLimiter(
+                           getInt(config, "max_table_size", 20000),
+                           responses,
+                           getInt(config, "nxdomains_per_second", responses),
+                           getInt(config, "errors_per_second", responses),
+                           getInt(config, "window", 15),
+                           getInt(config, "slip", 2),
+                           getInt(config, "ipv4_prefix_length", 24),
+                           getInt(config, "ipv6_prefix_length", 56),
+                           getBool(config, "log_only", false),
+                           bundy::auth::ResponseRateLimiter::
+                           getCurrentTime()));
+        } catch (const bundy::InvalidParameter& ex) {
+            bundy_throw(AuthConfigError, "Invalid rrl configuration: " <<
+                        ex.what());
+        }
+    }
+
+    virtual void commit() {
+        server_.setRRL(rrl_);
+    }
+private:
+    static int getInt(ConstElementPtr config, const string& name,
+                      int default_value)
+    {
+        if (!config->contains(name)) {
+            return (default_value);
+        }
+        const int64_t value = config->get(name)->intValue();
+        if (value < 0 || value > numeric_limits<int>::max()) {
+            bundy_throw(AuthConfigError, "rrl/" << name <<
+                        " is out of range: " << value);
+        }
+        return (value);
+    }
+    static bool getBool(ConstElementPtr config, const string& name,
+                        bool default_value)
+    {
+        return (config->contains(name) ? config->get(name)->boolValue() :
+                default_value);
+    }
+
+    AuthSrv& server_;
+    boost::shared_ptr<bundy::auth::ResponseRateLimiter> rrl_;
+};
+
+/// \brief Configuration for the overload detection and load shedding
+///
+/// Omitted parameters get the default values here, like \c RRLConfig.
+class OverloadConfig : public AuthConfigParser {
+public:
+    OverloadConfig(AuthSrv& server) :
+        server_(server), latency_(0), shedding_(AuthSrv::SHED_ALL)
+    {}
+
+    virtual void build(ConstElementPtr config) {
+        latency_ = 0;
+        if (config->contains("latency")) {
+            const int64_t value = config->get("latency")->intValue();
+            if (value < 0 || value > numeric_limits<int>::max()) {
+                bundy_throw(AuthConfigError, "overload/latency is out of "
+                            "range: " << value);
+            }
+            latency_ = value;
+        }
+        shedding_ = AuthSrv::SHED_NONE;
+        if (getBool(config, "drop_refused")) {
+            shedding_ |= AuthSrv::SHED_REFUSED;
+        }
+        if (getBool(config, "drop_rate_limited")) {
+            shedding_ |= AuthSrv::SHED_RATE_LIMITED;
+        }
+        if (getBool(config, "truncate_nsec3_nxdomain")) {
+            shedding_ |= AuthSrv::SHED_NSEC3_NXDOMAIN;
+        }
+    }
+
+    virtual void commit() {
+        server_.setOverloadShedding(shedding_);
+        server_.setUDPOverloadLatency(latency_);
+    }
+private:
+    // All ways of shedding load are enabled by default.
+    static bool getBool(ConstElementPtr config, const string& name) {
+        return (config->contains(name) ? config->get(name)->boolValue() :
+                true);
+    }
+
+    AuthSrv& server_;
+    size_t latency_;
+    unsigned int shedding_;
+};
+
 } // end of unnamed namespace
 
 AuthConfigParser*
@@ -170,6 +496,28 @@ createAuthConfigParser(AuthSrv& server, const std::string& config_id) {
         return (new VersionConfig());
     } else if (config_id == "tcp_recv_timeout") {
         return (new TCPRecvTimeoutConfig(server));
+    } else if (config_id == "tcp_max_in_flight") {
+        return (new TCPMaxInFlightConfig(server));
+    } else if (config_id == "udp_batch_size") {
+        return (new UDPBatchSizeConfig(server));
+    } else if (config_id == "worker_threads") {
+        return (new WorkerThreadsConfig(server));
+    } else if (config_id == "worker_cpus") {
+        return (new WorkerCPUsConfig(server));
+    } else if (config_id == "zone_load_threads") {
+        return (new ZoneLoadThreadsConfig(server));
+    } else if (config_id == "zone_update_interval") {
+        return (new ZoneUpdateIntervalConfig(server));
+    } else if (config_id == "response_cache_size") {
+        return (new ResponseCacheSizeConfig(server));
+    } else if (config_id == "nsec3_proof_cache_size") {
+        return (new NSEC3ProofCacheSizeConfig(server));
+    } else if (config_id == "statistics_zones") {
+        return (new ZoneStatisticsConfig(server));
+    } else if (config_id == "rrl") {
+        return (new RRLConfig(server));
+    } else if (config_id == "overload") {
+        return (new OverloadConfig(server));
     } else {
         bundy_throw(AuthConfigError, "Unknown configuration identifier: " <<
                     config_id);
@@ -33,6 +33,7 @@
 #include <dns/messagerenderer.h>
 #include <dns/name.h>
 #include <dns/question.h>
+#include <dns/query_parser.h>
 #include <dns/opcode.h>
 #include <dns/rcode.h>
 #include <dns/rrset.h>
@@ -41,9 +42,11 @@
 #include <dns/tsig.h>
 
 #include <asiodns/dns_service.h>
+#include <asiodns/dns_worker_pool.h>
 
 #include <datasrc/exceptions.h>
 #include <datasrc/client_list.h>
+#include <datasrc/memory/memory_client.h>
 
 #include <auth/common.h>
 #include <auth/auth_config.h>
@@ -52,17 +55,29 @@
 #include <auth/statistics.h>
 #include <auth/auth_log.h>
 #include <auth/datasrc_clients_mgr.h>
+#include <auth/nsec3_proof_cache.h>
+#include <auth/response_cache.h>
+#include <auth/rrl.h>
+
+#include <util/threads/sync.h>
+
+#include <log/binary_log.h>
 
 #include <boost/bind.hpp>
+#include <boost/foreach.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/scoped_ptr.hpp>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <ctime>
 #include <iostream>
+#include <map>
 #include <vector>
 #include <memory>
 
+#include <sys/time.h>
 #include <sys/types.h>
 #include <netinet/in.h>
 
@@ -82,8 +97,11 @@ using namespace bundy::xfr;
 using namespace bundy::asiolink;
 using namespace bundy::asiodns;
 using namespace bundy::server_common::portconfig;
+using bundy::auth::statistics::ChangeReporter;
 using bundy::auth::statistics::Counters;
 using bundy::auth::statistics::MessageAttributes;
+using bundy::auth::statistics::getMonotonicTime;
+using bundy::util::thread::Mutex;
 
 namespace {
 // A helper class for cleaning up message renderer.
@@ -229,6 +247,161 @@ private:
         }
     }
 };
+
+// A helper to forward NOTIFY requests to Zonemgr.
+//
+// Zonemgr is told about the NOTIFYs without waiting for its answer, so the
+// thread that received them can go on with other queries.  At most one
+// command is outstanding on the session at a time; the NOTIFYs received
+// meanwhile are queued, and sent together in a single "notify_batch" command
+// once the answer arrives.  A zone is queued only once, with the master of
+// the latest NOTIFY for it.  The answer is read asynchronously from the
+// session, in the thread running its IO service, and any error in it can
+// only be logged.
+//
+// The caller of push() must hold the mutex given on construction; the
+// handler of the answer acquires it itself.
+class NotifyForwarder {
+public:
+    /// \brief The maximum number of zones queued.
+    ///
+    /// The NOTIFYs for other zones are dropped while the queue is full.
+    static const size_t MAX_QUEUED = 10000;
+
+    NotifyForwarder(Mutex& mutex) :
+        mutex_(mutex), session_(NULL), waiting_(false), seq_(0)
+    {}
+
+    /// \brief Set the session to Zonemgr.
+    ///
+    /// This is expected to be called once on startup (and in tests).  The
+    /// queued NOTIFYs are forgotten.
+    void setSession(AbstractSession* session) {
+        session_ = session;
+        waiting_ = false;
+        queue_.clear();
+    }
+
+    AbstractSession* getSession() const { return (session_); }
+
+    /// \brief Forward a NOTIFY for a zone.
+    ///
+    /// It's sent to Zonemgr at once if no command is outstanding, and
+    /// queued otherwise.
+    ///
+    /// \return false if the NOTIFY was dropped because the queue is full or
+    /// it couldn't be sent, in which case it shouldn't be answered so that
+    /// the master resends it.
+    bool push(const Name& zone_name, const RRClass& zone_class,
+              const string& master)
+    {
+        const ZoneKey key(zone_name, zone_class);
+        if (queue_.size() >= MAX_QUEUED && queue_.count(key) == 0) {
+            LOG_WARN(auth_logger, AUTH_NOTIFY_QUEUE_FULL).
+                arg(zone_name).arg(zone_class).arg(MAX_QUEUED);
+            return (false);
+        }
+        queue_[key] = master;
+        if (waiting_) {
+            return (true);
+        }
+        return (send());
+    }
+
+private:
+    typedef std::pair<Name, RRClass> ZoneKey;
+    typedef std::map<ZoneKey, string> NotifyQueue;
+
+    Mutex& mutex_;
+    AbstractSession* session_;
+    // Whether a command is outstanding
+    bool waiting_;
+    // The sequence number of the outstanding command
+    int seq_;
+    NotifyQueue queue_;
+
+    static ConstElementPtr createArgs(const NotifyQueue::value_type& notify) {
+        ElementPtr args = Element::createMap();
+        args->set("zone_name",
+                  Element::create(notify.first.first.toText()));
+        args->set("zone_class",
+                  Element::create(notify.first.second.toText()));
+        args->set("master", Element::create(notify.second));
+        return (args);
+    }
+
+    // Send all queued NOTIFYs in a single command, and start reading the
+    // answer.  The queue is emptied even if that fails.
+    bool send() {
+        ConstElementPtr command;
+        if (queue_.size() == 1) {
+            command = createCommand("notify", createArgs(*queue_.begin()));
+        } else {
+            ElementPtr notifies = Element::createList();
+            BOOST_FOREACH(const NotifyQueue::value_type& notify, queue_) {
+                notifies->add(createArgs(notify));
+            }
+            ElementPtr args = Element::createMap();
+            args->set("notifies", notifies);
+            command = createCommand("notify_batch", args);
+        }
+        LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_NOTIFY_FORWARD).
+            arg(queue_.size());
+        queue_.clear();
+
+        try {
+            seq_ = session_->group_sendmsg(command, "Zonemgr",
+                                           CC_INSTANCE_WILDCARD,
+                                           CC_INSTANCE_WILDCARD, true);
+            session_->startRead(boost::bind(&NotifyForwarder::answerReceived,
+                                            this));
+            waiting_ = true;
+        } catch (const bundy::Exception& ex) {
+            LOG_ERROR(auth_logger, AUTH_ZONEMGR_COMMS).arg(ex.what());
+            return (false);
+        }
+        return (true);
+    }
+
+    // Called when the answer to the outstanding command is available.
+    void answerReceived() {
+        Mutex::Locker locker(mutex_);
+        waiting_ = false;
+        try {
+            ConstElementPtr env, answer;
+            session_->group_recvmsg(env, answer, false, seq_);
+            int rcode;
+            const ConstElementPtr parsed_answer = parseAnswer(rcode, answer);
+            if (rcode == CC_REPLY_NO_RECPT) {
+                // This can happen when Zonemgr is not running.  When we
+                // support notification-based membership framework, we should
+                // check if it's supposed to be running and shouldn't even
+                // send the command if not.  Until then, we log this event at
+                // the debug level as we don't know whether it's a real
+                // trouble or intentional configuration.
+                LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_ZONEMGR_NOTEXIST);
+            } else if (rcode != CC_REPLY_SUCCESS) {
+                LOG_ERROR(auth_logger, AUTH_ZONEMGR_ERROR).
+                    arg(parsed_answer->str());
+            }
+        } catch (const bundy::Exception& ex) {
+            LOG_ERROR(auth_logger, AUTH_ZONEMGR_COMMS).arg(ex.what());
+        }
+        if (!queue_.empty()) {
+            send();
+        }
+    }
+};
+
+// Resources used for building a response, which must not be shared by
+// threads processing queries concurrently.  The main thread uses the one
+// held in AuthSrvImpl, and each worker thread (if any) has its own one in
+// its lookup callback object.
+struct ResponseContext {
+    MessageRenderer renderer_;
+    auth::Query query_;
+    QueryParser query_parser_;
+};
 }
 
 class AuthSrvImpl {
@@ -240,40 +413,89 @@ public:
     AuthSrvImpl(BaseSocketSessionForwarder& xfrout_forwarder,
                 BaseSocketSessionForwarder& ddns_forwarder);
 
-    bool processNormalQuery(const IOMessage& io_message,
+    void processMessage(const IOMessage& io_message, Message& message,
+                        OutputBuffer& buffer, DNSServer* server,
+                        ResponseContext& context);
+    bool processFastQuery(ResponseContext& context,
+                          const IOMessage& io_message, Message& message,
+                          OutputBuffer& buffer,
+                          MessageAttributes& stats_attrs, bool& send_answer);
+    bool processNormalQuery(ResponseContext& context,
+                            const IOMessage& io_message,
                             ConstEDNSPtr remote_edns, Message& message,
                             OutputBuffer& buffer,
                             unique_ptr<TSIGContext> tsig_context,
-                            MessageAttributes& stats_attrs);
-    bool processXfrQuery(const IOMessage& io_message, Message& message,
+                            MessageAttributes& stats_attrs,
+                            unsigned int shedding);
+    bool processXfrQuery(MessageRenderer& renderer,
+                         const IOMessage& io_message, Message& message,
                          OutputBuffer& buffer,
                          unique_ptr<TSIGContext> tsig_context,
                          MessageAttributes& stats_attrs);
-    bool processNotify(const IOMessage& io_message, Message& message,
+    bool processNotify(MessageRenderer& renderer,
+                       const IOMessage& io_message, Message& message,
                        OutputBuffer& buffer,
                        unique_ptr<TSIGContext> tsig_context,
                        MessageAttributes& stats_attrs);
     bool processUpdate(const IOMessage& io_message);
+    bool processCachedQuery(MessageRenderer& renderer,
+                            const IOMessage& io_message,
+                            const LabelSequence& qname, const RRType& qtype,
+                            const RRClass& qclass, Message& message,
+                            OutputBuffer& buffer,
+                            const ResponseCache::Entry& cached,
+                            MessageAttributes& stats_attrs);
+
+    /// Invalidate the data derived from a zone that has been updated.
+    /// Called from the data source builder thread.
+    void zoneDataUpdated(const Name& origin, const RRClass& rrclass) {
+        response_cache_.invalidate(origin, rrclass);
+        nsec3_proof_cache_.invalidate(origin, rrclass);
+    }
+
+    /// Check the response to be sent against the response rate limiter.
+    /// It returns RRL_OK if the limiter isn't configured.
+    RRLResult checkRRL(const IOMessage& io_message, const RRClass& qclass,
+                       const RRType& qtype, const Name* name,
+                       detail::ResponseType resp_type);
+
+    /// Return true if the response rate limiter has recently limited
+    /// responses to the client of the request.  It returns false if the
+    /// limiter isn't configured.
+    bool isRateLimitedClient(const IOMessage& io_message);
 
     IOService io_service_;
 
-    MessageRenderer renderer_;
+    /// Response building resources for the main thread
+    ResponseContext main_context_;
     /// Currently non-configurable, but will be.
     static const uint16_t DEFAULT_LOCAL_UDPSIZE = 4096;
 
     /// These members are public because AuthSrv accesses them directly.
     ModuleCCSession* config_session_;
-    AbstractSession* xfrin_session_;
 
-    /// Query counters for statistics
+    /// Query counters for statistics; shared by all worker threads, which
+    /// increment them without locking
     Counters counters_;
 
+    /// Remembers the last statistics report, only used by the command
+    /// handler
+    ChangeReporter stats_reporter_;
+
     /// Addresses we listen on
     AddressList listen_addresses_;
 
     /// The TSIG keyring
     const boost::shared_ptr<TSIGKeyRing>* keyring_;
 
+    /// Cached responses to normal queries.  It must be placed before
+    /// datasrc_clients_mgr_, which invalidates it from its thread.
+    ResponseCache response_cache_;
+
+    /// Cached NSEC3 NXDOMAIN proofs, shared by all response contexts.
+    /// Like response_cache_, it must be placed before datasrc_clients_mgr_.
+    NSEC3ProofCache nsec3_proof_cache_;
+
     /// The data source client list manager
     auth::DataSrcClientsMgr datasrc_clients_mgr_;
 
@@ -287,43 +509,91 @@ public:
     /// bundy-ddns is not running
     boost::scoped_ptr<SocketSessionForwarderHolder> ddns_forwarder_;
 
+    /// Serializes the use of the socket session forwarders and the xfrin
+    /// session, none of which are thread safe, among worker threads.
+    Mutex session_mutex_;
+
+    /// Forwards NOTIFY requests to Zonemgr over the xfrin session.  It's
+    /// protected by session_mutex_.
+    NotifyForwarder notify_forwarder_;
+
+    /// The response rate limiter; NULL if it's disabled.
+    boost::shared_ptr<ResponseRateLimiter> rrl_;
+
+    /// Protects rrl_, which is shared by all worker threads
+    Mutex rrl_mutex_;
+
+    /// How queries are handled while the receiving server is overloaded;
+    /// a combination of AuthSrv::OverloadShedding values.  It's read by
+    /// all worker threads without locking.
+    std::atomic<unsigned int> overload_shedding_;
+
     /// \brief Resume the server
     ///
     /// This is a wrapper call for DNSServer::resume(done). Query/Response
-    /// statistics counters are incremented in this method.
+    /// statistics counters are incremented in this method, and the request
+    /// is recorded in the binary query log if it's open.
     ///
     /// This method is expected to be called by processMessage()
     ///
     /// \param server The DNSServer as passed to processMessage()
+    /// \param io_message The request as passed to processMessage()
     /// \param message The response as constructed by processMessage()
     /// \param stats_attrs Object to store message attributes in for use
     ///                    with statistics
     /// \param done If true, it indicates there is a response.
     ///             this value will be passed to server->resume(bool)
+    /// \param parser If non NULL, the parser that parsed the request when
+    ///               the message itself wasn't fully parsed
     void resumeServer(bundy::asiodns::DNSServer* server,
+                      const IOMessage& io_message,
                       bundy::dns::Message& message,
                       MessageAttributes& stats_attrs,
-                      const bool done);
+                      const bool done, const QueryParser* parser = NULL);
+
+    /// \brief Write a binary query log record for the request
+    ///
+    /// Parameters are those of \c resumeServer().
+    void logQuery(const IOMessage& io_message, const Message& message,
+                  const MessageAttributes& stats_attrs, const bool done,
+                  const QueryParser* parser);
 
     /// Are we currently subscribed to the SegmentReader group?
     bool readers_group_subscribed_;
-private:
-    auth::Query query_;
+
+    /// Number of worker threads for UDP queries (0 means the main thread
+    /// handles everything)
+    size_t worker_threads_;
+
+    /// CPUs the worker threads are bound to (empty if they aren't bound)
+    std::vector<int> worker_cpus_;
+
+    /// The worker thread pool, wrapping the DNS service given via
+    /// AuthSrv::setDNSService().  This must be the last member so that worker
+    /// threads are stopped before anything they use is destroyed.
+    boost::scoped_ptr<DNSWorkerPool> workers_;
 };
 
 AuthSrvImpl::AuthSrvImpl(BaseSocketSessionForwarder& xfrout_forwarder,
                          BaseSocketSessionForwarder& ddns_forwarder) :
     config_session_(NULL),
-    xfrin_session_(NULL),
     counters_(),
+    stats_reporter_(),
     keyring_(NULL),
     datasrc_clients_mgr_(io_service_),
     xfrout_forwarder_(new SocketSessionForwarderHolder("xfrout",
                                                        xfrout_forwarder)),
     ddns_base_forwarder_(ddns_forwarder),
     ddns_forwarder_(NULL),
-    readers_group_subscribed_(false)
-{}
+    notify_forwarder_(session_mutex_),
+    overload_shedding_(AuthSrv::SHED_ALL),
+    readers_group_subscribed_(false),
+    worker_threads_(0)
+{
+    main_context_.query_.setNSEC3ProofCache(&nsec3_proof_cache_);
+    datasrc_clients_mgr_.setZoneUpdatedCallback(
+        boost::bind(&AuthSrvImpl::zoneDataUpdated, this, _1, _2));
+}
 
 // This is a derived class of \c DNSLookup, to serve as a
 // callback in the asiolink module.  It calls
@@ -348,6 +618,36 @@ private:
     AuthSrv* server_;
 };
 
+// A variant of \c MessageLookup used in worker threads.  Each object has
+// its own response context so that worker threads can build responses
+// concurrently.
+class WorkerMessageLookup : public DNSLookup {
+public:
+    WorkerMessageLookup(AuthSrvImpl* impl) : impl_(impl) {
+        context_.query_.setNSEC3ProofCache(&impl_->nsec3_proof_cache_);
+    }
+    virtual void operator()(const IOMessage& io_message,
+                            MessagePtr message,
+                            MessagePtr, // Not used here
+                            OutputBufferPtr buffer,
+                            DNSServer* server) const
+    {
+        MessageHolder message_holder(*message);
+        impl_->processMessage(io_message, *message, *buffer, server,
+                              context_);
+    }
+private:
+    AuthSrvImpl* impl_;
+    mutable ResponseContext context_;
+};
+
+namespace {
+DNSLookup*
+createWorkerMessageLookup(AuthSrvImpl* impl) {
+    return (new WorkerMessageLookup(impl));
+}
+}
+
 // This is a derived class of \c DNSAnswer, to serve as a callback in the
 // asiolink module.  We actually shouldn't do anything in this class because
 // we build complete response messages in the process methods; otherwise
@@ -451,7 +751,7 @@ AuthSrv::getDataSrcClientsMgr() {
 
 void
 AuthSrv::setXfrinSession(AbstractSession* xfrin_session) {
-    impl_->xfrin_session_ = xfrin_session;
+    impl_->notify_forwarder_.setSession(xfrin_session);
 }
 
 void
@@ -464,13 +764,44 @@ AuthSrv::getConfigSession() const {
     return (impl_->config_session_);
 }
 
+namespace {
+// Return the EDNS for responses.  They are immutable, so the same objects
+// are shared by all responses to avoid allocating one for each of them.
+ConstEDNSPtr
+createLocalEDNS(bool dnssec_ok) {
+    EDNSPtr edns(new EDNS());
+    edns->setDNSSECAwareness(dnssec_ok);
+    edns->setUDPSize(AuthSrvImpl::DEFAULT_LOCAL_UDPSIZE);
+    return (edns);
+}
+
+ConstEDNSPtr
+getLocalEDNS(bool dnssec_ok) {
+    static const ConstEDNSPtr edns_do(createLocalEDNS(true));
+    static const ConstEDNSPtr edns_nodo(createLocalEDNS(false));
+    return (dnssec_ok ? edns_do : edns_nodo);
+}
+}
+
 void
 AuthSrv::processMessage(const IOMessage& io_message, Message& message,
                         OutputBuffer& buffer, DNSServer* server)
 {
+    impl_->processMessage(io_message, message, buffer, server,
+                          impl_->main_context_);
+}
+
+void
+AuthSrvImpl::processMessage(const IOMessage& io_message, Message& message,
+                            OutputBuffer& buffer, DNSServer* server,
+                            ResponseContext& context)
+{
+    MessageRenderer& renderer = context.renderer_;
     InputBuffer request_buffer(io_message.getData(), io_message.getDataSize());
     MessageAttributes stats_attrs;
 
+    stats_attrs.setRequestTime(getMonotonicTime());
+
     stats_attrs.setRequestIPVersion(
         io_message.getRemoteEndpoint().getFamily());
     stats_attrs.setRequestTransportProtocol(
@@ -484,13 +815,13 @@ AuthSrv::processMessage(const IOMessage& io_message, Message& message,
         // Ignore all responses.
         if (message.getHeaderFlag(Message::HEADERFLAG_QR)) {
             LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_RESPONSE_RECEIVED);
-            impl_->resumeServer(server, message, stats_attrs, false);
+            resumeServer(server, io_message, message, stats_attrs, false);
             return;
         }
     } catch (const bundy::Exception& ex) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_HEADER_PARSE_FAIL)
                   .arg(ex.what());
-        impl_->resumeServer(server, message, stats_attrs, false);
+        resumeServer(server, io_message, message, stats_attrs, false);
         return;
     }
 
@@ -501,22 +832,51 @@ AuthSrv::processMessage(const IOMessage& io_message, Message& message,
     // sanity check.
     stats_attrs.setRequestOpCode(opcode);
 
+    // While the server is overloaded, some queries are dropped or answered
+    // cheaply (see AuthSrv::setOverloadShedding()).  Those from clients
+    // that have been rate limited are dropped before anything else is done
+    // for them.
+    unsigned int shedding = AuthSrv::SHED_NONE;
+    if (server->isOverloaded()) {
+        shedding = overload_shedding_.load(std::memory_order_relaxed);
+    }
+    if (opcode == Opcode::QUERY() &&
+        (shedding & AuthSrv::SHED_RATE_LIMITED) != 0 &&
+        isRateLimitedClient(io_message)) {
+        LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL,
+                  AUTH_OVERLOAD_DROP_RATE_LIMITED)
+            .arg(io_message.getRemoteEndpoint());
+        resumeServer(server, io_message, message, stats_attrs, false);
+        return;
+    }
+
+    // Standard queries may be answered from the response cache without
+    // being fully parsed.
+    bool send_answer = true;
+    if (opcode == Opcode::QUERY() &&
+        processFastQuery(context, io_message, message, buffer, stats_attrs,
+                         send_answer)) {
+        resumeServer(server, io_message, message, stats_attrs, send_answer,
+                     &context.query_parser_);
+        return;
+    }
+
     try {
         // Parse the message.
         message.fromWire(request_buffer);
     } catch (const DNSProtocolError& error) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_PACKET_PROTOCOL_FAILURE)
                   .arg(error.getRcode().toText()).arg(error.what());
-        makeErrorMessage(impl_->renderer_, message, buffer, error.getRcode(),
+        makeErrorMessage(renderer, message, buffer, error.getRcode(),
                          stats_attrs);
-        impl_->resumeServer(server, message, stats_attrs, true);
+        resumeServer(server, io_message, message, stats_attrs, true);
         return;
     } catch (const bundy::Exception& ex) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_PACKET_PARSE_FAILED)
                   .arg(ex.what());
-        makeErrorMessage(impl_->renderer_, message, buffer, Rcode::SERVFAIL(),
+        makeErrorMessage(renderer, message, buffer, Rcode::SERVFAIL(),
                          stats_attrs);
-        impl_->resumeServer(server, message, stats_attrs, true);
+        resumeServer(server, io_message, message, stats_attrs, true);
         return;
     } // other exceptions will be handled at a higher layer.
 
@@ -532,24 +892,27 @@ AuthSrv::processMessage(const IOMessage& io_message, Message& message,
 
     // Do we do TSIG?
     // The keyring can be null if we're in test
-    if (impl_->keyring_ != NULL && tsig_record != NULL) {
+    if (keyring_ != NULL && tsig_record != NULL) {
+        // The key ring may be replaced by a configuration update meanwhile;
+        // the context keeps a copy of the key.
+        const boost::shared_ptr<TSIGKeyRing> keyring(
+            boost::atomic_load(keyring_));
         tsig_context.reset(new TSIGContext(tsig_record->getName(),
                                            tsig_record->getRdata().
                                                 getAlgorithm(),
-                                           **impl_->keyring_));
+                                           *keyring));
         tsig_error = tsig_context->verify(tsig_record, io_message.getData(),
                                           io_message.getDataSize());
         stats_attrs.setRequestTSIG(true, tsig_error != TSIGError::NOERROR());
     }
 
     if (tsig_error != TSIGError::NOERROR()) {
-        makeErrorMessage(impl_->renderer_, message, buffer,
+        makeErrorMessage(renderer, message, buffer,
                          tsig_error.toRcode(), stats_attrs, move(tsig_context));
-        impl_->resumeServer(server, message, stats_attrs, true);
+        resumeServer(server, io_message, message, stats_attrs, true);
         return;
     }
 
-    bool send_answer = true;
     try {
         // note: This can only be reliable after TSIG check succeeds.
         ConstEDNSPtr edns = message.getEDNS();
@@ -560,75 +923,293 @@ AuthSrv::processMessage(const IOMessage& io_message, Message& message,
 
         // note: This can only be reliable after TSIG check succeeds.
         if (opcode == Opcode::NOTIFY()) {
-            send_answer = impl_->processNotify(io_message, message, buffer,
-                                               move(tsig_context), stats_attrs);
+            Mutex::Locker locker(session_mutex_);
+            send_answer = processNotify(renderer, io_message, message,
+                                        buffer, move(tsig_context),
+                                        stats_attrs);
         } else if (opcode == Opcode::UPDATE()) {
-            if (impl_->ddns_forwarder_) {
-                send_answer = impl_->processUpdate(io_message);
+            Mutex::Locker locker(session_mutex_);
+            if (ddns_forwarder_) {
+                send_answer = processUpdate(io_message);
             } else {
-                makeErrorMessage(impl_->renderer_, message, buffer,
-                                 Rcode::NOTIMP(), stats_attrs, move(tsig_context));
+                makeErrorMessage(renderer, message, buffer, Rcode::NOTIMP(),
+                                 stats_attrs, move(tsig_context));
             }
         } else if (opcode != Opcode::QUERY()) {
             const IOEndpoint& remote_ep = io_message.getRemoteEndpoint();
             LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_UNSUPPORTED_OPCODE)
                 .arg(message.getOpcode().toText()).arg(remote_ep);
-            makeErrorMessage(impl_->renderer_, message, buffer,
+            makeErrorMessage(renderer, message, buffer,
                              Rcode::NOTIMP(), stats_attrs, move(tsig_context));
         } else if (message.getRRCount(Message::SECTION_QUESTION) != 1) {
-            makeErrorMessage(impl_->renderer_, message, buffer,
+            makeErrorMessage(renderer, message, buffer,
                              Rcode::FORMERR(), stats_attrs, move(tsig_context));
         } else {
             ConstQuestionPtr question = *message.beginQuestion();
             const RRType& qtype = question->getType();
             if (qtype == RRType::AXFR()) {
-                send_answer = impl_->processXfrQuery(io_message, message,
-                                                     buffer, move(tsig_context),
-                                                     stats_attrs);
+                send_answer = processXfrQuery(renderer, io_message, message,
+                                              buffer, move(tsig_context),
+                                              stats_attrs);
             } else if (qtype == RRType::IXFR()) {
-                send_answer = impl_->processXfrQuery(io_message, message,
-                                                     buffer, move(tsig_context),
-                                                     stats_attrs);
+                send_answer = processXfrQuery(renderer, io_message, message,
+                                              buffer, move(tsig_context),
+                                              stats_attrs);
             } else {
-                send_answer = impl_->processNormalQuery(io_message, edns,
-                                                        message, buffer,
-                                                        move(tsig_context),
-                                                        stats_attrs);
+                send_answer = processNormalQuery(context, io_message, edns,
+                                                 message, buffer,
+                                                 move(tsig_context),
+                                                 stats_attrs, shedding);
             }
         }
     } catch (const std::exception& ex) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_RESPONSE_FAILURE)
                   .arg(ex.what());
-        makeErrorMessage(impl_->renderer_, message, buffer, Rcode::SERVFAIL(),
+        makeErrorMessage(renderer, message, buffer, Rcode::SERVFAIL(),
                          stats_attrs);
     } catch (...) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_RESPONSE_FAILURE_UNKNOWN);
-        makeErrorMessage(impl_->renderer_, message, buffer, Rcode::SERVFAIL(),
+        makeErrorMessage(renderer, message, buffer, Rcode::SERVFAIL(),
                          stats_attrs);
     }
-    impl_->resumeServer(server, message, stats_attrs, send_answer);
+    resumeServer(server, io_message, message, stats_attrs, send_answer);
+}
+
+namespace {
+// Classify a response built by auth::Query in terms of RRL, and identify
+// the name to be used for it: the query name for positive answers, the
+// zone or delegation point for referrals and empty answers, and the zone
+// for NXDOMAIN.
+detail::ResponseType
+getRRLResponseType(const Message& message, const Name& qname,
+                   const Name*& name)
+{
+    name = &qname;
+    const Rcode& rcode = message.getRcode();
+    if (rcode != Rcode::NOERROR() && rcode != Rcode::NXDOMAIN()) {
+        return (detail::RESPONSE_ERROR);
+    }
+    if (message.getRRCount(Message::SECTION_ANSWER) == 0 &&
+        message.getRRCount(Message::SECTION_AUTHORITY) > 0) {
+        // The owner of the first authority RRset is the zone origin (SOA)
+        // or the delegation point (NS).
+        name = &(*message.beginSection(Message::SECTION_AUTHORITY))->
+            getName();
+    }
+    return (rcode == Rcode::NXDOMAIN() ? detail::RESPONSE_NXDOMAIN :
+            detail::RESPONSE_QUERY);
+}
+}
+
+RRLResult
+AuthSrvImpl::checkRRL(const IOMessage& io_message, const RRClass& qclass,
+                      const RRType& qtype, const Name* name,
+                      detail::ResponseType resp_type)
+{
+    Mutex::Locker locker(rrl_mutex_);
+    if (!rrl_) {
+        return (RRL_OK);
+    }
+    return (rrl_->check(io_message.getRemoteEndpoint(),
+                        io_message.getSocket().getProtocol() == IPPROTO_TCP,
+                        qclass, qtype, name, resp_type,
+                        ResponseRateLimiter::getCurrentTime()));
+}
+
+bool
+AuthSrvImpl::isRateLimitedClient(const IOMessage& io_message) {
+    Mutex::Locker locker(rrl_mutex_);
+    return (rrl_ && rrl_->isLimitedClient(
+                io_message.getRemoteEndpoint(),
+                ResponseRateLimiter::getCurrentTime()));
+}
+
+namespace {
+// Return true if the response to the query can be cached, i.e., if it
+// comes from the in-memory cache of a data source, so it will be
+// invalidated when the zone is updated.  For a DS query, the parent zone
+// has to be cached as well.
+bool
+isCacheableQuery(const datasrc::ClientList& list, const Name& qname,
+                 const RRType& qtype)
+{
+    if (!dynamic_cast<const datasrc::memory::InMemoryClient*>(
+            list.find(qname, false, false).dsrc_client_)) {
+        return (false);
+    }
+    return (qtype != RRType::DS() || qname.getLabelCount() <= 1 ||
+            dynamic_cast<const datasrc::memory::InMemoryClient*>(
+                list.find(qname.split(1), false, false).dsrc_client_));
+}
+
+// Remember the zone the query is answered from for the zone statistics.
+// Like in the query processing, a DS query is answered from the parent
+// zone.
+void
+setStatisticsZone(const datasrc::ClientList& list, const Name& qname,
+                  const RRType& qtype, MessageAttributes& stats_attrs)
+{
+    const datasrc::ClientList::FindResult result(
+        (qtype == RRType::DS() && qname.getLabelCount() > 1) ?
+        list.find(qname.split(1), false, false) :
+        list.find(qname, false, false));
+    if (result.finder_) {
+        stats_attrs.setZone(result.finder_->getOrigin());
+    }
+}
+}
+
+bool
+AuthSrvImpl::processCachedQuery(MessageRenderer& renderer,
+                                const IOMessage& io_message,
+                                const LabelSequence& qname,
+                                const RRType& qtype, const RRClass& qclass,
+                                Message& message, OutputBuffer& buffer,
+                                const ResponseCache::Entry& cached,
+                                MessageAttributes& stats_attrs)
+{
+    // Make the message look like the cached one for statistics.
+    message.setRcode(cached.getRcode());
+    message.setHeaderFlag(Message::HEADERFLAG_AA, cached.isAuthoritative());
+    if (cached.getZone()) {
+        stats_attrs.setZone(cached.getZone().get());
+    }
+
+    switch (checkRRL(io_message, qclass, qtype, &cached.getRRLName(),
+                     cached.getRRLType())) {
+    case RRL_OK:
+        break;
+    case RRL_DROP:
+        return (false);
+    case RRL_SLIP:
+    {
+        // Same as the uncached case; the message has no RRs yet.  If the
+        // query wasn't fully parsed, the question has to be built here.
+        if (message.beginQuestion() == message.endQuestion()) {
+            size_t qname_len;
+            const uint8_t* qname_data = qname.getData(&qname_len);
+            InputBuffer qname_buffer(qname_data, qname_len);
+            message.addQuestion(QuestionPtr(new Question(Name(qname_buffer),
+                                                         qclass, qtype)));
+        }
+        message.setHeaderFlag(Message::HEADERFLAG_TC);
+        RendererHolder holder(renderer, &buffer, stats_attrs);
+        message.toWire(renderer);
+        LOG_DEBUG(auth_logger, DBG_AUTH_MESSAGES, AUTH_SEND_NORMAL_RESPONSE)
+                  .arg(renderer.getLength()).arg(message);
+        return (true);
+    }
+    }
+
+    if (cached.getAnswerSummary()) {
+        message.addRRset(Message::SECTION_ANSWER, cached.getAnswerSummary());
+    }
+    cached.render(buffer, message.getQid(),
+                  message.getHeaderFlag(Message::HEADERFLAG_RD),
+                  message.getHeaderFlag(Message::HEADERFLAG_CD));
+    LOG_DEBUG(auth_logger, DBG_AUTH_MESSAGES, AUTH_SEND_CACHED_RESPONSE)
+              .arg(cached.getLength()).arg(qname).arg(qtype).arg(qclass);
+    return (true);
 }
 
 bool
-AuthSrvImpl::processNormalQuery(const IOMessage& io_message,
+AuthSrvImpl::processFastQuery(ResponseContext& context,
+                              const IOMessage& io_message, Message& message,
+                              OutputBuffer& buffer,
+                              MessageAttributes& stats_attrs,
+                              bool& send_answer)
+{
+    // Only simple queries without TSIG can have a cached response (see
+    // processNormalQuery()).  Unsupported EDNS versions and zone transfers
+    // are left to the normal path, which handles them.
+    QueryParser& parser = context.query_parser_;
+    if (!parser.parse(io_message.getData(), io_message.getDataSize()) ||
+        parser.hasTSIG() || parser.getEDNSVersion() > EDNS::SUPPORTED_VERSION ||
+        parser.getQType() == RRType::AXFR() ||
+        parser.getQType() == RRType::IXFR()) {
+        return (false);
+    }
+
+    const bool has_edns = parser.hasEDNS();
+    const bool dnssec_ok = parser.getDNSSECAwareness();
+    const size_t length_limit =
+        (io_message.getSocket().getProtocol() == IPPROTO_UDP) ?
+        parser.getUDPSize() : 65535;
+    const ResponseCache::ConstEntryPtr cached =
+        response_cache_.lookup(parser.getQName(), parser.getQType(),
+                               parser.getQClass(), has_edns, dnssec_ok);
+    if (!cached || cached->getLength() > length_limit) {
+        return (false);
+    }
+
+    // The rest is the same as processNormalQuery() would do for the
+    // cached response.
+    if (has_edns) {
+        stats_attrs.setRequestEDNS0(true);
+        stats_attrs.setRequestDO(dnssec_ok);
+    }
+    try {
+        message.makeResponse();
+        if (has_edns) {
+            message.setEDNS(getLocalEDNS(dnssec_ok));
+        }
+        send_answer = processCachedQuery(context.renderer_, io_message,
+                                         parser.getQName(), parser.getQType(),
+                                         parser.getQClass(), message, buffer,
+                                         *cached, stats_attrs);
+    } catch (const std::exception& ex) {
+        LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_RESPONSE_FAILURE)
+                  .arg(ex.what());
+        makeErrorMessage(context.renderer_, message, buffer,
+                         Rcode::SERVFAIL(), stats_attrs);
+        send_answer = true;
+    }
+    return (true);
+}
+
+bool
+AuthSrvImpl::processNormalQuery(ResponseContext& context,
+                                const IOMessage& io_message,
                                 ConstEDNSPtr remote_edns, Message& message,
                                 OutputBuffer& buffer,
                                 unique_ptr<TSIGContext> tsig_context,
-                                MessageAttributes& stats_attrs)
+                                MessageAttributes& stats_attrs,
+                                unsigned int shedding)
 {
-    const bool dnssec_ok = remote_edns && remote_edns->getDNSSECAwareness();
-    const uint16_t remote_bufsize = remote_edns ? remote_edns->getUDPSize() :
+    MessageRenderer& renderer = context.renderer_;
+    const bool has_edns = (remote_edns.get() != NULL);
+    const bool dnssec_ok = has_edns && remote_edns->getDNSSECAwareness();
+    const uint16_t remote_bufsize = has_edns ? remote_edns->getUDPSize() :
         Message::DEFAULT_MAX_UDPSIZE;
+    const bool udp_buffer =
+        (io_message.getSocket().getProtocol() == IPPROTO_UDP);
+    const size_t length_limit = udp_buffer ? remote_bufsize : 65535;
 
     message.makeResponse();
     message.setHeaderFlag(Message::HEADERFLAG_AA);
     message.setRcode(Rcode::NOERROR());
 
     if (remote_edns) {
-        EDNSPtr local_edns = EDNSPtr(new EDNS());
-        local_edns->setDNSSECAwareness(dnssec_ok);
-        local_edns->setUDPSize(AuthSrvImpl::DEFAULT_LOCAL_UDPSIZE);
-        message.setEDNS(local_edns);
+        message.setEDNS(getLocalEDNS(dnssec_ok));
+    }
+
+    // Responses signed with TSIG are specific to each query, so they are
+    // never cached.  A cached response is used only if it fits in the
+    // limit; otherwise we'll build a truncated one below.
+    const ConstQuestionPtr question = *message.beginQuestion();
+    const bool use_cache = !tsig_context;
+    const uint64_t cache_generation =
+        use_cache ? response_cache_.getGeneration() : 0;
+    if (use_cache) {
+        const ResponseCache::ConstEntryPtr cached =
+            response_cache_.lookup(*question, has_edns, dnssec_ok);
+        if (cached && cached->getLength() <= length_limit) {
+            return (processCachedQuery(renderer, io_message,
+                                       LabelSequence(question->getName()),
+                                       question->getType(),
+                                       question->getClass(), message, buffer,
+                                       *cached, stats_attrs));
+        }
     }
 
     // Get access to data source client list through the holder and keep
@@ -636,35 +1217,98 @@ AuthSrvImpl::processNormalQuery(const IOMessage& io_message,
     // race with any other thread(s) such as the background loader.
     auth::DataSrcClientsMgr::Holder datasrc_holder(datasrc_clients_mgr_);
 
+    const Name* rrl_name = NULL;
+    detail::ResponseType resp_type = detail::RESPONSE_QUERY;
+    bool cacheable = false;
     try {
-        const ConstQuestionPtr question = *message.beginQuestion();
         const boost::shared_ptr<datasrc::ClientList>
             list(datasrc_holder.findClientList(question->getClass()));
         if (list) {
             const RRType& qtype = question->getType();
             const Name& qname = question->getName();
-            query_.process(*list, qname, qtype, message, dnssec_ok);
+            context.query_.setTruncateNSEC3NXDOMAIN(
+                (shedding & AuthSrv::SHED_NSEC3_NXDOMAIN) != 0);
+            context.query_.process(*list, qname, qtype, message, dnssec_ok);
+            if ((shedding & AuthSrv::SHED_REFUSED) != 0 &&
+                message.getRcode() == Rcode::REFUSED()) {
+                LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL,
+                          AUTH_OVERLOAD_DROP_REFUSED)
+                    .arg(io_message.getRemoteEndpoint()).arg(*question);
+                return (false);
+            }
+            if (counters_.getZoneCounters() > 0) {
+                setStatisticsZone(*list, qname, qtype, stats_attrs);
+            }
+
+            resp_type = getRRLResponseType(message, qname, rrl_name);
+            switch (checkRRL(io_message, question->getClass(), qtype,
+                             rrl_name, resp_type)) {
+            case RRL_OK:
+                // A truncated response built to shed load isn't cached
+                // either.
+                cacheable = use_cache && resp_type != detail::RESPONSE_ERROR &&
+                    !message.getHeaderFlag(Message::HEADERFLAG_TC) &&
+                    response_cache_.getMaxEntries() > 0 &&
+                    isCacheableQuery(*list, qname, qtype);
+                break;
+            case RRL_DROP:
+                return (false);
+            case RRL_SLIP:
+                // Send an empty, truncated response so a legitimate client
+                // can retry over TCP.
+                message.clearSection(Message::SECTION_ANSWER);
+                message.clearSection(Message::SECTION_AUTHORITY);
+                message.clearSection(Message::SECTION_ADDITIONAL);
+                message.setHeaderFlag(Message::HEADERFLAG_TC);
+                break;
+            }
         } else {
-            makeErrorMessage(renderer_, message, buffer, Rcode::REFUSED(),
+            if ((shedding & AuthSrv::SHED_REFUSED) != 0) {
+                LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL,
+                          AUTH_OVERLOAD_DROP_REFUSED)
+                    .arg(io_message.getRemoteEndpoint()).arg(*question);
+                return (false);
+            }
+            // A REFUSED response is already minimal, so it's sent as is
+            // even if it's chosen to slip.
+            if (checkRRL(io_message, question->getClass(),
+                         question->getType(), NULL,
+                         detail::RESPONSE_ERROR) == RRL_DROP) {
+                return (false);
+            }
+            makeErrorMessage(renderer, message, buffer, Rcode::REFUSED(),
                              stats_attrs);
             return (true);
         }
     } catch (const bundy::Exception& ex) {
         LOG_ERROR(auth_logger, AUTH_PROCESS_FAIL).arg(ex.what());
-        makeErrorMessage(renderer_, message, buffer, Rcode::SERVFAIL(),
+        makeErrorMessage(renderer, message, buffer, Rcode::SERVFAIL(),
                          stats_attrs);
         return (true);
     }
 
-    RendererHolder holder(renderer_, &buffer, stats_attrs);
-    const bool udp_buffer =
-        (io_message.getSocket().getProtocol() == IPPROTO_UDP);
-    renderer_.setLengthLimit(udp_buffer ? remote_bufsize : 65535);
-    message.toWire(renderer_, tsig_context.get());
+    RendererHolder holder(renderer, &buffer, stats_attrs);
+    const size_t response_start = buffer.getLength();
+    renderer.setLengthLimit(length_limit);
+    message.toWire(renderer, tsig_context.get());
     stats_attrs.setResponseTSIG(tsig_context.get() != NULL);
 
+    // Truncated responses depend on the limit of the query, so they are
+    // not cached.
+    if (cacheable && !renderer.isTruncated()) {
+        response_cache_.insert(
+            cache_generation, *question, has_edns, dnssec_ok,
+            ResponseCache::ConstEntryPtr(
+                new ResponseCache::Entry(
+                    message,
+                    static_cast<const uint8_t*>(buffer.getData()) +
+                    response_start,
+                    buffer.getLength() - response_start,
+                    *rrl_name, resp_type, stats_attrs.getZone())));
+    }
+
     LOG_DEBUG(auth_logger, DBG_AUTH_MESSAGES, AUTH_SEND_NORMAL_RESPONSE)
-              .arg(renderer_.getLength()).arg(message);
+              .arg(renderer.getLength()).arg(message);
     return (true);
     // The message can contain some data from the locked resource. But outside
     // this method, we touch only the RCode of it, so it should be safe.
@@ -674,24 +1318,27 @@ AuthSrvImpl::processNormalQuery(const IOMessage& io_message,
 }
 
 bool
-AuthSrvImpl::processXfrQuery(const IOMessage& io_message, Message& message,
+AuthSrvImpl::processXfrQuery(MessageRenderer& renderer,
+                             const IOMessage& io_message, Message& message,
                              OutputBuffer& buffer,
                              unique_ptr<TSIGContext> tsig_context,
                              MessageAttributes& stats_attrs)
 {
     if (io_message.getSocket().getProtocol() == IPPROTO_UDP) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_AXFR_UDP);
-        makeErrorMessage(renderer_, message, buffer, Rcode::FORMERR(),
+        makeErrorMessage(renderer, message, buffer, Rcode::FORMERR(),
                          stats_attrs, move(tsig_context));
         return (true);
     }
 
+    Mutex::Locker locker(session_mutex_);
     xfrout_forwarder_->push(io_message);
     return (false);
 }
 
 bool
-AuthSrvImpl::processNotify(const IOMessage& io_message, Message& message,
+AuthSrvImpl::processNotify(MessageRenderer& renderer,
+                           const IOMessage& io_message, Message& message,
                            OutputBuffer& buffer,
                            std::unique_ptr<TSIGContext> tsig_context,
                            MessageAttributes& stats_attrs)
@@ -703,7 +1350,7 @@ AuthSrvImpl::processNotify(const IOMessage& io_message, Message& message,
     if (message.getRRCount(Message::SECTION_QUESTION) != 1) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_NOTIFY_QUESTIONS)
                   .arg(message.getRRCount(Message::SECTION_QUESTION));
-        makeErrorMessage(renderer_, message, buffer, Rcode::FORMERR(),
+        makeErrorMessage(renderer, message, buffer, Rcode::FORMERR(),
                          stats_attrs, move(tsig_context));
         return (true);
     }
@@ -711,7 +1358,7 @@ AuthSrvImpl::processNotify(const IOMessage& io_message, Message& message,
     if (question->getType() != RRType::SOA()) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_NOTIFY_RRTYPE)
                   .arg(question->getType().toText());
-        makeErrorMessage(renderer_, message, buffer, Rcode::FORMERR(),
+        makeErrorMessage(renderer, message, buffer, Rcode::FORMERR(),
                          stats_attrs, move(tsig_context));
         return (true);
     }
@@ -733,7 +1380,7 @@ AuthSrvImpl::processNotify(const IOMessage& io_message, Message& message,
     if (!is_auth) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_RECEIVED_NOTIFY_NOTAUTH)
             .arg(question->getName()).arg(question->getClass()).arg(remote_ep);
-        makeErrorMessage(renderer_, message, buffer, Rcode::NOTAUTH(),
+        makeErrorMessage(renderer, message, buffer, Rcode::NOTAUTH(),
                          stats_attrs, move(tsig_context));
         return (true);
     }
@@ -741,51 +1388,17 @@ AuthSrvImpl::processNotify(const IOMessage& io_message, Message& message,
     LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_RECEIVED_NOTIFY)
         .arg(question->getName()).arg(question->getClass()).arg(remote_ep);
 
-    // xfrin_session_ should have been set and never be replaced except in
-    // tests; otherwise it's an internal bug.  assert() may be too strong,
+    // The xfrin session should have been set and never be replaced except
+    // in tests; otherwise it's an internal bug.  assert() may be too strong,
     // but processMessage() will catch all exceptions, so there's no better
     // way.
-    assert(xfrin_session_);
-
-    const string remote_ip_address = remote_ep.getAddress().toText();
-    static const string command_template_start =
-        "{\"command\": [\"notify\", {\"zone_name\" : \"";
-    static const string command_template_master = "\", \"master\" : \"";
-    static const string command_template_rrclass = "\", \"zone_class\" : \"";
-    static const string command_template_end = "\"}]}";
+    assert(notify_forwarder_.getSession());
 
-    try {
-        ConstElementPtr notify_command = Element::fromJSON(
-                command_template_start + question->getName().toText() +
-                command_template_master + remote_ip_address +
-                command_template_rrclass + question->getClass().toText() +
-                command_template_end);
-        const unsigned int seq =
-            xfrin_session_->group_sendmsg(notify_command, "Zonemgr",
-                                          CC_INSTANCE_WILDCARD,
-                                          CC_INSTANCE_WILDCARD, true);
-        ConstElementPtr env, answer, parsed_answer;
-        xfrin_session_->group_recvmsg(env, answer, false, seq);
-        int rcode;
-        parsed_answer = parseAnswer(rcode, answer);
-        if (rcode == CC_REPLY_NO_RECPT) {
-            // This can happen when Zonemgr is not running.  When we support
-            // notification-based membership framework, we should check if it's
-            // supposed to be running and shouldn't even send the command if
-            // not.  Until then, we log this event at the debug level as we
-            // don't know whether it's a real trouble or intentional
-            // configuration.  (Also, when it's done, maybe we should simply
-            // propagate the exception and return SERVFAIL to suppress further
-            // NOTIFY).
-            LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_ZONEMGR_NOTEXIST);
-            return (false);
-        } else if (rcode != CC_REPLY_SUCCESS) {
-            LOG_ERROR(auth_logger, AUTH_ZONEMGR_ERROR)
-                      .arg(parsed_answer->str());
-            return (false);
-        }
-    } catch (const bundy::Exception& ex) {
-        LOG_ERROR(auth_logger, AUTH_ZONEMGR_COMMS).arg(ex.what());
+    // Zonemgr is told asynchronously, so the NOTIFY is answered once it's
+    // queued; if Zonemgr fails to handle it, the zone will still be
+    // refreshed on its regular schedule.
+    if (!notify_forwarder_.push(question->getName(), question->getClass(),
+                                remote_ep.getAddress().toText())) {
         return (false);
     }
 
@@ -793,8 +1406,8 @@ AuthSrvImpl::processNotify(const IOMessage& io_message, Message& message,
     message.setHeaderFlag(Message::HEADERFLAG_AA);
     message.setRcode(Rcode::NOERROR());
 
-    RendererHolder holder(renderer_, &buffer, stats_attrs);
-    message.toWire(renderer_, tsig_context.get());
+    RendererHolder holder(renderer, &buffer, stats_attrs);
+    message.toWire(renderer, tsig_context.get());
     stats_attrs.setResponseTSIG(tsig_context.get() != NULL);
     return (true);
 }
@@ -810,13 +1423,81 @@ AuthSrvImpl::processUpdate(const IOMessage& io_message)
 }
 
 void
-AuthSrvImpl::resumeServer(DNSServer* server, Message& message,
-                          MessageAttributes& stats_attrs,
-                          const bool done) {
+AuthSrvImpl::resumeServer(DNSServer* server, const IOMessage& io_message,
+                          Message& message, MessageAttributes& stats_attrs,
+                          const bool done, const QueryParser* parser)
+{
     counters_.inc(stats_attrs, message, done);
+    // Responses and messages with a broken header are not queries; the
+    // opcode is only set once the header has been found to be a request.
+    if (stats_attrs.getRequestOpCode() &&
+        bundy::log::BinaryLog::global().isOpen()) {
+        logQuery(io_message, message, stats_attrs, done, parser);
+    }
     server->resume(done);
 }
 
+void
+AuthSrvImpl::logQuery(const IOMessage& io_message, const Message& message,
+                      const MessageAttributes& stats_attrs, const bool done,
+                      const QueryParser* parser)
+{
+    bundy::log::BinaryLogRecord record;
+    memset(&record, 0, sizeof(record));
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    record.timestamp = static_cast<uint64_t>(now.tv_sec) * 1000000 +
+        now.tv_usec;
+    const uint64_t finished = getMonotonicTime();
+    if (finished > stats_attrs.getRequestTime()) {
+        record.latency = finished - stats_attrs.getRequestTime();
+    }
+
+    const IOEndpoint& remote_ep = io_message.getRemoteEndpoint();
+    const struct sockaddr& sa = remote_ep.getSockAddr();
+    if (sa.sa_family == AF_INET) {
+        const struct sockaddr_in& sin =
+            reinterpret_cast<const struct sockaddr_in&>(sa);
+        record.family = 4;
+        record.port = ntohs(sin.sin_port);
+        memcpy(record.address, &sin.sin_addr, sizeof(sin.sin_addr));
+    } else if (sa.sa_family == AF_INET6) {
+        const struct sockaddr_in6& sin6 =
+            reinterpret_cast<const struct sockaddr_in6&>(sa);
+        record.family = 6;
+        record.port = ntohs(sin6.sin6_port);
+        memcpy(record.address, &sin6.sin6_addr, sizeof(sin6.sin6_addr));
+    }
+    if (remote_ep.getProtocol() == IPPROTO_TCP) {
+        record.flags |= bundy::log::BinaryLogRecord::FLAG_TCP;
+    }
+
+    // The question, from the parser if the fast path answered without
+    // parsing the message, otherwise from the message (if it got that far).
+    const uint8_t* qname_data = NULL;
+    size_t qname_len = 0;
+    if (parser != NULL) {
+        qname_data = parser->getQName().getData(&qname_len);
+        record.qtype = parser->getQType().getCode();
+    } else if (message.getRRCount(Message::SECTION_QUESTION) > 0) {
+        const ConstQuestionPtr question = *message.beginQuestion();
+        qname_data = LabelSequence(question->getName()).getData(&qname_len);
+        record.qtype = question->getType().getCode();
+    }
+    if (qname_data != NULL && qname_len <= sizeof(record.qname)) {
+        memcpy(record.qname, qname_data, qname_len);
+        record.qname_length = qname_len;
+    }
+
+    if (done) {
+        record.rcode = message.getRcode().getCode() & 0xff;
+    } else {
+        record.flags |= bundy::log::BinaryLogRecord::FLAG_NO_RESPONSE;
+    }
+    bundy::log::BinaryLog::global().write(record);
+}
+
 ConstElementPtr
 AuthSrv::updateConfig(ConstElementPtr new_config) {
     try {
@@ -832,8 +1513,81 @@ AuthSrv::updateConfig(ConstElementPtr new_config) {
     }
 }
 
+namespace {
+// Return the statistics items with the memory used by the cached zones
+// added as "memory", by zone name.  The usage of the zones of the same
+// name in different classes or data sources is summed.
+ConstElementPtr
+addMemoryStatistics(ConstElementPtr items, ConstElementPtr zone_usage) {
+    typedef std::map<std::string, ConstElementPtr> ItemMap;
+    typedef std::map<std::string, int64_t> UsageMap;
+    std::map<std::string, UsageMap> zones;
+    BOOST_FOREACH(const ItemMap::value_type& rrclass, zone_usage->mapValue()) {
+        BOOST_FOREACH(const ItemMap::value_type& datasrc,
+                      rrclass.second->mapValue()) {
+            BOOST_FOREACH(const ItemMap::value_type& zone,
+                          datasrc.second->mapValue()) {
+                UsageMap& usage = zones[zone.first];
+                BOOST_FOREACH(const ItemMap::value_type& item,
+                              zone.second->mapValue()) {
+                    usage[item.first] += item.second->intValue();
+                }
+            }
+        }
+    }
+
+    ElementPtr memory = Element::createMap();
+    typedef std::map<std::string, UsageMap>::value_type ZoneUsage;
+    BOOST_FOREACH(const ZoneUsage& zone, zones) {
+        ElementPtr usage = Element::createMap();
+        BOOST_FOREACH(const UsageMap::value_type& item, zone.second) {
+            usage->set(item.first, Element::create(item.second));
+        }
+        memory->set(zone.first, usage);
+    }
+
+    ElementPtr result = Element::createMap();
+    BOOST_FOREACH(const ItemMap::value_type& item, items->mapValue()) {
+        result->set(item.first, item.second);
+    }
+    result->set("memory", memory);
+    return (result);
+}
+}
+
 ConstElementPtr AuthSrv::getStatistics() const {
-    return (impl_->counters_.get());
+    return (addMemoryStatistics(impl_->counters_.get(),
+                                getZoneMemoryUsage()));
+}
+
+ConstElementPtr
+AuthSrv::getStatisticsReport(ConstElementPtr args) {
+    return (impl_->stats_reporter_.getReport(
+                addMemoryStatistics(impl_->counters_.get(),
+                                    getZoneMemoryUsage()),
+                args));
+}
+
+ConstElementPtr
+AuthSrv::getZoneMemoryUsage() const {
+    ElementPtr usage = Element::createMap();
+    DataSrcClientsMgr::Holder holder(impl_->datasrc_clients_mgr_);
+    BOOST_FOREACH(const RRClass& rrclass, holder.getClasses()) {
+        usage->set(rrclass.toText(),
+                   holder.findClientList(rrclass)->getZoneMemoryUsage());
+    }
+    return (usage);
+}
+
+ConstElementPtr
+AuthSrv::saveHotNames(size_t max_names) {
+    ElementPtr saved = Element::createMap();
+    DataSrcClientsMgr::Holder holder(impl_->datasrc_clients_mgr_);
+    BOOST_FOREACH(const RRClass& rrclass, holder.getClasses()) {
+        saved->set(rrclass.toText(),
+                   holder.findClientList(rrclass)->saveHotNames(max_names));
+    }
+    return (saved);
 }
 
 const AddressList&
@@ -844,14 +1598,58 @@ AuthSrv::getListenAddresses() const {
 void
 AuthSrv::setListenAddresses(const AddressList& addresses) {
     // For UDP servers we specify the "SYNC_OK" option because in our usage
-    // it can act in the synchronous mode.
-    installListenAddresses(addresses, impl_->listen_addresses_, *dnss_,
-                           DNSService::SERVER_SYNC_OK);
+    // it can act in the synchronous mode.  The worker threads (if any) are
+    // stopped while the servers are replaced, and restarted with the new
+    // (or, on failure, restored) ones.
+    try {
+        installListenAddresses(addresses, impl_->listen_addresses_,
+                               *impl_->workers_, DNSService::SERVER_SYNC_OK);
+    } catch (...) {
+        impl_->workers_->start();
+        throw;
+    }
+    impl_->workers_->start();
 }
 
 void
 AuthSrv::setDNSService(bundy::asiodns::DNSServiceBase& dnss) {
     dnss_ = &dnss;
+    impl_->workers_.reset(
+        new DNSWorkerPool(dnss, boost::bind(createWorkerMessageLookup, impl_),
+                          dns_answer_));
+    impl_->workers_->setWorkerCount(impl_->worker_threads_);
+    impl_->workers_->setWorkerCPUs(impl_->worker_cpus_);
+}
+
+void
+AuthSrv::setWorkerThreads(size_t count) {
+    impl_->worker_threads_ = count;
+    if (impl_->workers_) {
+        impl_->workers_->setWorkerCount(count);
+    }
+}
+
+size_t
+AuthSrv::getWorkerThreads() const {
+    return (impl_->worker_threads_);
+}
+
+void
+AuthSrv::setWorkerCPUs(const std::vector<int>& cpus) {
+    BOOST_FOREACH(int cpu, cpus) {
+        if (cpu < 0) {
+            bundy_throw(bundy::InvalidParameter, "Invalid worker CPU: " << cpu);
+        }
+    }
+    if (impl_->workers_) {
+        impl_->workers_->setWorkerCPUs(cpus);
+    }
+    impl_->worker_cpus_ = cpus;
+}
+
+const std::vector<int>&
+AuthSrv::getWorkerCPUs() const {
+    return (impl_->worker_cpus_);
 }
 
 void
@@ -862,6 +1660,7 @@ AuthSrv::setTSIGKeyRing(const boost::shared_ptr<TSIGKeyRing>* keyring) {
 void
 AuthSrv::createDDNSForwarder() {
     LOG_DEBUG(auth_logger, DBG_AUTH_OPS, AUTH_START_DDNS_FORWARDER);
+    Mutex::Locker locker(impl_->session_mutex_);
     impl_->ddns_forwarder_.reset(
         new SocketSessionForwarderHolder("update",
                                          impl_->ddns_base_forwarder_));
@@ -869,6 +1668,7 @@ AuthSrv::createDDNSForwarder() {
 
 void
 AuthSrv::destroyDDNSForwarder() {
+    Mutex::Locker locker(impl_->session_mutex_);
     if (impl_->ddns_forwarder_) {
         LOG_DEBUG(auth_logger, DBG_AUTH_OPS, AUTH_STOP_DDNS_FORWARDER);
         impl_->ddns_forwarder_.reset();
@@ -880,6 +1680,86 @@ AuthSrv::setTCPRecvTimeout(size_t timeout) {
     dnss_->setTCPRecvTimeout(timeout);
 }
 
+void
+AuthSrv::setRRL(const boost::shared_ptr<ResponseRateLimiter>& rrl) {
+    Mutex::Locker locker(impl_->rrl_mutex_);
+    impl_->rrl_ = rrl;
+}
+
+boost::shared_ptr<ResponseRateLimiter>
+AuthSrv::getRRL() const {
+    Mutex::Locker locker(impl_->rrl_mutex_);
+    return (impl_->rrl_);
+}
+
+void
+AuthSrv::setResponseCacheSize(size_t size) {
+    impl_->response_cache_.setMaxEntries(size);
+}
+
+size_t
+AuthSrv::getResponseCacheSize() const {
+    return (impl_->response_cache_.getMaxEntries());
+}
+
+size_t
+AuthSrv::getCachedResponseCount() const {
+    return (impl_->response_cache_.getEntryCount());
+}
+
+void
+AuthSrv::setNSEC3ProofCacheSize(size_t size) {
+    impl_->nsec3_proof_cache_.setMaxEntries(size);
+}
+
+size_t
+AuthSrv::getNSEC3ProofCacheSize() const {
+    return (impl_->nsec3_proof_cache_.getMaxEntries());
+}
+
+void
+AuthSrv::setZoneStatisticsSize(size_t size) {
+    if (size != impl_->counters_.getZoneCounters()) {
+        impl_->counters_.setZoneCounters(size);
+        // The cached responses only know their zone if it was counted
+        // when they were cached.
+        impl_->response_cache_.clear();
+    }
+}
+
+size_t
+AuthSrv::getZoneStatisticsSize() const {
+    return (impl_->counters_.getZoneCounters());
+}
+
+void
+AuthSrv::setUDPBatchSize(size_t batch_size) {
+    // This also updates dnss_.
+    impl_->workers_->setUDPBatchSize(batch_size);
+}
+
+void
+AuthSrv::setTCPMaxInFlight(size_t max_in_flight) {
+    // This also updates dnss_.
+    impl_->workers_->setTCPMaxInFlight(max_in_flight);
+}
+
+void
+AuthSrv::setUDPOverloadLatency(size_t latency) {
+    // This also updates dnss_.
+    impl_->workers_->setUDPOverloadLatency(latency);
+}
+
+void
+AuthSrv::setOverloadShedding(unsigned int shedding) {
+    impl_->overload_shedding_.store(shedding, std::memory_order_relaxed);
+}
+
+unsigned int
+AuthSrv::getOverloadShedding() const {
+    return (impl_->overload_shedding_.load(std::memory_order_relaxed));
+}
+
 void
 AuthSrv::zoneUpdated(const std::string& event_name,
                      const ConstElementPtr& params)
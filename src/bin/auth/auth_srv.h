@@ -41,6 +41,8 @@
 
 #include <boost/shared_ptr.hpp>
 
+#include <vector>
+
 namespace bundy {
 namespace util {
 namespace io {
@@ -59,6 +61,9 @@ class AbstractXfroutClient;
 namespace dns {
 class TSIGKeyRing;
 }
+namespace auth {
+class ResponseRateLimiter;
+}
 }
 
 
@@ -221,6 +226,38 @@ public:
     /// \return JSON format statistics data.
     bundy::data::ConstElementPtr getStatistics() const;
 
+    /// \brief Returns the statistics data changed since the last report
+    ///
+    /// See \c bundy::auth::statistics::ChangeReporter.
+    ///
+    /// \param args The arguments of the "getstats" command, may be NULL.
+    /// \return JSON format statistics report.
+    bundy::data::ConstElementPtr
+    getStatisticsReport(bundy::data::ConstElementPtr args);
+
+    /// \brief Returns the memory used by the zones cached in memory.
+    ///
+    /// The result maps the RR classes to the usage of the zones of the
+    /// data sources of that class, as returned by
+    /// \c datasrc::ConfigurableClientList::getZoneMemoryUsage().  The
+    /// statistics include the usage by zone name, as "memory".
+    ///
+    /// It walks all the cached zones, so it takes time proportional to
+    /// their size.
+    ///
+    /// \return JSON format memory usage.
+    bundy::data::ConstElementPtr getZoneMemoryUsage() const;
+
+    /// \brief Save the names most frequently found in the cached zones.
+    ///
+    /// The names are saved by the client list of each RR class (see
+    /// \c datasrc::ConfigurableClientList::saveHotNames()).
+    ///
+    /// \param max_names The maximum number of names saved per data source.
+    /// \return A map from the RR classes to the number of names saved by
+    /// data source name.
+    bundy::data::ConstElementPtr saveHotNames(size_t max_names);
+
     /**
      * \brief Set and get the addresses we listen on.
      */
@@ -230,8 +267,51 @@ public:
         const;
 
     /// \brief Assign an ASIO DNS Service queue to this Auth object
+    ///
+    /// The servers for the listen addresses will be added to \c dnss.
+    /// If worker threads are configured (see \c setWorkerThreads()), UDP
+    /// queries are additionally handled by the workers, each of which
+    /// runs its own DNS service.
     void setDNSService(bundy::asiodns::DNSServiceBase& dnss);
 
+    /// \brief Set the number of worker threads handling UDP queries.
+    ///
+    /// Each worker thread runs its own event loop and synchronous UDP
+    /// servers on duplicates of the listening UDP sockets, and builds
+    /// responses with its own renderer and \c Query object, while data
+    /// sources are shared through the \c DataSrcClientsMgr.  TCP queries
+    /// and anything forwarded to other modules are handled in a serialized
+    /// manner.  If set to 0 (the default), all queries are handled in the
+    /// main thread.
+    ///
+    /// If the server is already listening, running workers are restarted
+    /// with the new count.
+    ///
+    /// \throw bundy::asiolink::IOError failed to set up a worker's socket.
+    void setWorkerThreads(size_t count);
+
+    /// \brief Return the number of worker threads.
+    ///
+    /// \throw None
+    size_t getWorkerThreads() const;
+
+    /// \brief Set the CPUs the worker threads are bound to.
+    ///
+    /// The workers are assigned the CPUs of the list in a round-robin
+    /// manner; see \c DNSWorkerPool::setWorkerCPUs().  If empty (the
+    /// default), the workers aren't bound to any CPU.
+    ///
+    /// If the server is already listening, running workers are restarted.
+    ///
+    /// \throw bundy::InvalidParameter a CPU number is negative.
+    /// \throw bundy::asiolink::IOError failed to set up a worker's socket.
+    void setWorkerCPUs(const std::vector<int>& cpus);
+
+    /// \brief Return the CPUs the worker threads are bound to.
+    ///
+    /// \throw None
+    const std::vector<int>& getWorkerCPUs() const;
+
     /// \brief Sets the keyring used for verifying and signing
     ///
     /// The parameter is pointer to shared pointer, because the automatic
@@ -270,6 +350,130 @@ public:
     /// open forever.
     void setTCPRecvTimeout(size_t timeout);
 
+    /// \brief Sets the maximum number of pipelined TCP queries
+    ///
+    /// Up to this number of queries received on a single TCP connection
+    /// are handled at the same time; reading from the connection is
+    /// suspended while that many responses are outstanding.
+    ///
+    /// This must be called after \c setDNSService().
+    ///
+    /// \throw bundy::InvalidParameter max_in_flight is 0
+    /// \param max_in_flight The maximum number of outstanding queries.
+    void setTCPMaxInFlight(size_t max_in_flight);
+
+    /// \brief Sets the maximum number of UDP queries handled at once
+    ///
+    /// On systems that support it, up to this number of queries are
+    /// received from a UDP socket, and their responses sent, with a single
+    /// system call each.  The value of 1 disables the batching.
+    ///
+    /// This must be called after \c setDNSService().
+    ///
+    /// \throw bundy::InvalidParameter batch_size is 0 or too large
+    /// \param batch_size The maximum number of queries per batch.
+    void setUDPBatchSize(size_t batch_size);
+
+    /// \brief Sets the processing time that makes UDP servers overloaded
+    ///
+    /// A UDP server is overloaded while handling the received queries
+    /// takes at least this time and more queries keep waiting on its
+    /// socket (see \c bundy::asiodns::SyncUDPServer).  Queries are then
+    /// handled as configured by \c setOverloadShedding().  0 disables the
+    /// detection, which is the default.
+    ///
+    /// This must be called after \c setDNSService().
+    ///
+    /// \param latency The threshold in microseconds.
+    void setUDPOverloadLatency(size_t latency);
+
+    /// \brief Ways to shed load while overloaded.
+    ///
+    /// They can be combined with bitwise or; see \c setOverloadShedding().
+    enum OverloadShedding {
+        SHED_NONE = 0,
+        /// Drop queries that would be answered with REFUSED, i.e., those
+        /// for names outside our zones, so in-zone queries are preferred.
+        SHED_REFUSED = 1,
+        /// Drop queries from clients whose responses have recently been
+        /// limited by the response rate limiter (see \c setRRL()).
+        SHED_RATE_LIMITED = 2,
+        /// Answer queries that need a new NSEC3 NXDOMAIN proof with an
+        /// empty, truncated response instead of building the proof (see
+        /// \c Query::setTruncateNSEC3NXDOMAIN()).
+        SHED_NSEC3_NXDOMAIN = 4,
+        SHED_ALL = SHED_REFUSED | SHED_RATE_LIMITED | SHED_NSEC3_NXDOMAIN
+    };
+
+    /// \brief Set how queries are handled while the server is overloaded
+    ///
+    /// The given ways of shedding load are applied to normal queries
+    /// received while the server that received them is overloaded (see
+    /// \c setUDPOverloadLatency()).  All of them are enabled by default.
+    ///
+    /// \param shedding A combination of \c OverloadShedding values.
+    void setOverloadShedding(unsigned int shedding);
+
+    /// \brief Return how queries are handled while overloaded.
+    unsigned int getOverloadShedding() const;
+
+    /// \brief Set or clear the response rate limiter
+    ///
+    /// Responses to normal UDP queries are checked against the given
+    /// limiter, and are dropped or truncated as it decides.  The limiter
+    /// is shared by all worker threads.
+    ///
+    /// \param rrl The limiter to use; if it's NULL, responses are never
+    /// limited (which is the default).
+    void setRRL(const boost::shared_ptr<bundy::auth::ResponseRateLimiter>&
+                rrl);
+
+    /// \brief Return the current response rate limiter (NULL if disabled).
+    boost::shared_ptr<bundy::auth::ResponseRateLimiter> getRRL() const;
+
+    /// \brief Set the maximum number of cached responses
+    ///
+    /// Responses to normal queries served from the in-memory cache of data
+    /// sources are cached in the rendered form, and are reused for the same
+    /// queries until the zone data are updated.  0 disables the cache
+    /// (which is the default).
+    ///
+    /// \param size The maximum number of cached responses.
+    void setResponseCacheSize(size_t size);
+
+    /// \brief Return the maximum number of cached responses.
+    size_t getResponseCacheSize() const;
+
+    /// \brief Return the number of currently cached responses.
+    size_t getCachedResponseCount() const;
+
+    /// \brief Set the maximum number of cached NSEC3 proof intervals
+    ///
+    /// NXDOMAIN proofs for NSEC3-signed zones served from the in-memory
+    /// cache of data sources are cached, so that queries for other
+    /// non-existent names in the proven intervals can reuse them until the
+    /// zone data are updated (see \c NSEC3ProofCache).  The limit is per
+    /// zone.  0 disables the cache (which is the default).
+    ///
+    /// \param size The maximum number of cached intervals per zone.
+    void setNSEC3ProofCacheSize(size_t size);
+
+    /// \brief Return the maximum number of cached NSEC3 proof intervals.
+    size_t getNSEC3ProofCacheSize() const;
+
+    /// \brief Set the maximum number of zones with statistics counters
+    ///
+    /// Messages answered from a zone are counted for the zone as well as
+    /// for the whole server, for up to \c size zones (the first ones
+    /// queried).  0 disables the zone counters (which is the default).
+    /// Changing the size resets the existing zone counters.
+    ///
+    /// \param size The maximum number of zones to count.
+    void setZoneStatisticsSize(size_t size);
+
+    /// \brief Return the maximum number of zones with statistics counters.
+    size_t getZoneStatisticsSize() const;
+
     /// \brief Notify the authoritative server that the client lists were
     ///     reconfigured.
     ///
@@ -0,0 +1,757 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+// This benchmark measures the whole UDP query path of bundy-auth: queries
+// are sent over the loopback interface by a number of client threads to an
+// AuthSrv listening with its usual synchronous UDP servers (and worker
+// threads, if configured), and the responses are matched with the queries
+// to measure the latency of each of them.
+
+#include <config.h>
+
+#include <bench/benchmark_util.h>
+
+#include <exceptions/exceptions.h>
+
+#include <util/buffer.h>
+#include <util/random/random_number_generator.h>
+#include <util/threads/thread.h>
+#include <util/unittests/mock_socketsession.h>
+
+#include <dns/edns.h>
+#include <dns/message.h>
+#include <dns/messagerenderer.h>
+#include <dns/name.h>
+#include <dns/opcode.h>
+#include <dns/question.h>
+#include <dns/rcode.h>
+#include <dns/rrclass.h>
+#include <dns/rrset.h>
+#include <dns/rrtype.h>
+
+#include <cc/data.h>
+
+#include <datasrc/client.h>
+#include <datasrc/client_list.h>
+#include <datasrc/zone_iterator.h>
+
+#include <log/logger_support.h>
+
+#include <server_common/portconfig.h>
+#include <server_common/socket_request.h>
+
+#include <auth/auth_srv.h>
+#include <auth/datasrc_config.h>
+#include <auth/datasrc_clients_mgr.h>
+
+#include <asiodns/asiodns.h>
+#include <asiolink/asiolink.h>
+
+#include <zonecompile/zonecompile.h>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace bundy;
+using namespace bundy::data;
+using namespace bundy::auth;
+using namespace bundy::datasrc;
+using namespace bundy::dns;
+using namespace bundy::util;
+using namespace bundy::util::unittests;
+using namespace bundy::bench;
+using namespace bundy::asiodns;
+using namespace bundy::asiolink;
+using namespace bundy::server_common;
+using bundy::util::thread::Thread;
+
+namespace {
+
+// Return the current time of the monotonic clock in microseconds.
+uint64_t
+getTimeUsec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000);
+}
+
+// A socket requestor that creates the sockets by itself on the loopback
+// interface, instead of asking the socket creator through bundy-init.  If
+// port 0 is requested, an ephemeral port is chosen; the UDP port actually
+// bound is remembered so that the clients can send queries to it.
+class LoopbackSocketRequestor : public SocketRequestor {
+public:
+    LoopbackSocketRequestor() : udp_port_(0) {}
+
+    virtual SocketID requestSocket(Protocol protocol,
+                                   const string& address, uint16_t port,
+                                   ShareMode, const string&)
+    {
+        const int fd = socket(AF_INET,
+                              protocol == UDP ? SOCK_DGRAM : SOCK_STREAM, 0);
+        if (fd < 0) {
+            bundy_throw(SocketAllocateError, "failed to create a socket: "
+                        << strerror(errno));
+        }
+        const int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+        struct sockaddr_in sin;
+        memset(&sin, 0, sizeof(sin));
+        sin.sin_family = AF_INET;
+        sin.sin_port = htons(port);
+        if (inet_pton(AF_INET, address.c_str(), &sin.sin_addr) != 1 ||
+            bind(fd, reinterpret_cast<const struct sockaddr*>(&sin),
+                 sizeof(sin)) < 0 ||
+            (protocol == TCP && listen(fd, 16) < 0)) {
+            const int error = errno;
+            close(fd);
+            bundy_throw(SocketAllocateError, "failed to bind a socket to "
+                        << address << "#" << port << ": " << strerror(error));
+        }
+        if (protocol == UDP) {
+            socklen_t len = sizeof(sin);
+            getsockname(fd, reinterpret_cast<struct sockaddr*>(&sin), &len);
+            udp_port_ = ntohs(sin.sin_port);
+        }
+        return (SocketID(fd, boost::lexical_cast<string>(fd)));
+    }
+
+    // The descriptors are owned (and closed) by the DNS service.
+    virtual void releaseSocket(const string&) {}
+
+    uint16_t getUDPPort() const { return (udp_port_); }
+
+private:
+    uint16_t udp_port_;
+};
+
+// Result of a single client thread.
+struct ClientResult {
+    ClientResult() : sent(0), received(0), lost(0) {}
+    size_t sent;
+    size_t received;
+    size_t lost;
+    vector<uint32_t> latencies; // in microseconds
+};
+
+// A client thread.  It sends "count" queries taken from the given queries
+// in a round robin manner, starting at "start", to the server, keeping at
+// most "window" queries outstanding.  Responses are matched with the
+// queries by the query ID.  If no response arrives for "timeout" msec,
+// all outstanding queries are considered lost.
+class Client {
+public:
+    Client(const BenchQueries& queries, size_t start, size_t count,
+           size_t window, int timeout, uint16_t port, ClientResult& result) :
+        queries_(queries), start_(start), count_(count), window_(window),
+        timeout_(timeout), port_(port), result_(result)
+    {}
+
+    void run() {
+        const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0) {
+            bundy_throw(bundy::Unexpected, "failed to create a socket: "
+                        << strerror(errno));
+        }
+        struct sockaddr_in sin;
+        memset(&sin, 0, sizeof(sin));
+        sin.sin_family = AF_INET;
+        sin.sin_port = htons(port_);
+        sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(fd, reinterpret_cast<const struct sockaddr*>(&sin),
+                    sizeof(sin)) < 0) {
+            const int error = errno;
+            close(fd);
+            bundy_throw(bundy::Unexpected, "failed to connect a socket: "
+                        << strerror(error));
+        }
+
+        // Send time of outstanding queries indexed by the query ID; 0
+        // means no query is outstanding with that ID.
+        vector<uint64_t> send_times(QID_COUNT, 0);
+        vector<uint8_t> query;
+        uint8_t response[65535];
+        size_t outstanding = 0;
+        result_.latencies.reserve(count_);
+
+        while (result_.received + result_.lost < count_) {
+            while (outstanding < window_ && result_.sent < count_) {
+                const size_t qid = result_.sent % QID_COUNT;
+                query = queries_[(start_ + result_.sent) % queries_.size()];
+                query[0] = qid >> 8;
+                query[1] = qid & 0xff;
+                send_times[qid] = getTimeUsec();
+                if (send(fd, &query[0], query.size(), 0) < 0) {
+                    send_times[qid] = 0;
+                    ++result_.lost;
+                } else {
+                    ++outstanding;
+                }
+                ++result_.sent;
+            }
+            if (outstanding == 0) {
+                continue;
+            }
+
+            struct pollfd pfd;
+            pfd.fd = fd;
+            pfd.events = POLLIN;
+            if (poll(&pfd, 1, timeout_) <= 0) {
+                // Give up all the outstanding queries.  They are the most
+                // recently sent ones that haven't been answered.
+                for (size_t i = 1; outstanding > 0 && i <= QID_COUNT &&
+                         i <= result_.sent; ++i) {
+                    const size_t qid = (result_.sent - i) % QID_COUNT;
+                    if (send_times[qid] != 0) {
+                        send_times[qid] = 0;
+                        --outstanding;
+                        ++result_.lost;
+                    }
+                }
+                continue;
+            }
+            ssize_t len;
+            while ((len = recv(fd, response, sizeof(response),
+                               MSG_DONTWAIT)) >= 2) {
+                const size_t qid = (response[0] << 8) | response[1];
+                if (send_times[qid] != 0) {
+                    result_.latencies.push_back(getTimeUsec() -
+                                                send_times[qid]);
+                    send_times[qid] = 0;
+                    --outstanding;
+                    ++result_.received;
+                }
+            }
+        }
+        close(fd);
+    }
+
+private:
+    static const size_t QID_COUNT = 65536;
+    const BenchQueries& queries_;
+    const size_t start_;
+    const size_t count_;
+    const size_t window_;
+    const int timeout_;
+    const uint16_t port_;
+    ClientResult& result_;
+};
+
+// Aggregated result of a single measurement.
+struct BenchResult {
+    size_t sent;
+    size_t received;
+    size_t lost;
+    double duration;            // in seconds
+    vector<uint32_t> latencies; // sorted, in microseconds
+
+    // Return the p-th percentile (0 < p <= 100) of the latencies, using
+    // the nearest-rank method.
+    uint32_t getPercentile(double p) const {
+        if (latencies.empty()) {
+            return (0);
+        }
+        const size_t rank =
+            static_cast<size_t>(ceil(p / 100 * latencies.size()));
+        return (latencies[min(max(rank, static_cast<size_t>(1)),
+                              latencies.size()) - 1]);
+    }
+};
+
+BenchResult
+runClients(const BenchQueries& queries, size_t client_count,
+           size_t queries_per_client, size_t window, int timeout,
+           uint16_t port)
+{
+    vector<ClientResult> results(client_count);
+    vector<boost::shared_ptr<Client> > clients;
+    for (size_t i = 0; i < client_count; ++i) {
+        clients.push_back(boost::shared_ptr<Client>(
+                              new Client(queries,
+                                         queries.size() * i / client_count,
+                                         queries_per_client, window, timeout,
+                                         port, results[i])));
+    }
+
+    const uint64_t start = getTimeUsec();
+    vector<boost::shared_ptr<Thread> > threads;
+    for (size_t i = 0; i < client_count; ++i) {
+        threads.push_back(boost::shared_ptr<Thread>(
+                              new Thread(boost::bind(&Client::run,
+                                                     clients[i]))));
+    }
+    for (size_t i = 0; i < client_count; ++i) {
+        threads[i]->wait();
+    }
+
+    BenchResult result;
+    result.duration = (getTimeUsec() - start) / 1000000.0;
+    result.sent = result.received = result.lost = 0;
+    for (size_t i = 0; i < client_count; ++i) {
+        result.sent += results[i].sent;
+        result.received += results[i].received;
+        result.lost += results[i].lost;
+        result.latencies.insert(result.latencies.end(),
+                                results[i].latencies.begin(),
+                                results[i].latencies.end());
+    }
+    sort(result.latencies.begin(), result.latencies.end());
+    return (result);
+}
+
+// Generate queryperf style query data of the given kinds of workloads for
+// the zone of the given data source client list.  Each kind has "count"
+// queries:
+// - positive: random existing owner names and types of the zone
+// - any: random existing owner names with type ANY
+// - nxdomain: random non existent names directly under the origin
+// - wildcard: random names matching wildcards of the zone
+void
+generateQueries(const ConfigurableClientList& list, const Name& origin,
+                const vector<string>& kinds, size_t count, ostream& output)
+{
+    const ClientList::FindResult result(list.find(origin, true, false));
+    if (result.dsrc_client_ == NULL) {
+        bundy_throw(BenchMarkError, "zone not found: " << origin);
+    }
+
+    vector<pair<string, string> > positives; // owner names and types
+    set<string> owners;
+    vector<pair<string, string> > wildcards; // names under '*' and types
+    ZoneIteratorPtr iterator(result.dsrc_client_->getIterator(origin));
+    ConstRRsetPtr rrset;
+    while ((rrset = iterator->getNextRRset()) != NULL) {
+        const RRType& rrtype = rrset->getType();
+        if (rrtype == RRType::NSEC3() || rrtype == RRType::RRSIG()) {
+            // They can't be (meaningfully) queried for.
+            continue;
+        }
+        const Name& owner = rrset->getName();
+        if (owner.isWildcard()) {
+            wildcards.push_back(make_pair(owner.split(1).toText(),
+                                          rrtype.toText()));
+        } else {
+            positives.push_back(make_pair(owner.toText(), rrtype.toText()));
+            owners.insert(owner.toText());
+        }
+    }
+    const vector<string> owner_list(owners.begin(), owners.end());
+
+    random::UniformRandomIntegerGenerator rng(0, 0x7fffffff);
+    for (vector<string>::const_iterator kind = kinds.begin();
+         kind != kinds.end(); ++kind) {
+        if ((*kind == "positive" && positives.empty()) ||
+            (*kind == "wildcard" && wildcards.empty())) {
+            bundy_throw(BenchMarkError, "no names for workload " << *kind
+                        << " in zone " << origin);
+        } else if (*kind != "positive" && *kind != "any" &&
+                   *kind != "nxdomain" && *kind != "wildcard") {
+            bundy_throw(BenchMarkError, "unknown workload: " << *kind);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (*kind == "positive") {
+                const pair<string, string>& q =
+                    positives[rng() % positives.size()];
+                output << q.first << " " << q.second << "\n";
+            } else if (*kind == "any") {
+                output << owner_list[rng() % owner_list.size()] << " ANY\n";
+            } else if (*kind == "nxdomain") {
+                output << "nx" << rng() << "." << origin << " A\n";
+            } else {
+                const pair<string, string>& q =
+                    wildcards[rng() % wildcards.size()];
+                output << "wc" << rng() << "." << q.first << " " << q.second
+                       << "\n";
+            }
+        }
+    }
+}
+
+// Make all the queries request DNSSEC records (by setting the DO bit of
+// EDNS).
+void
+setDNSSECOK(BenchQueries& queries) {
+    Message parsed(Message::PARSE);
+    Message query(Message::RENDER);
+    MessageRenderer renderer;
+    EDNSPtr edns(new EDNS());
+    edns->setUDPSize(4096);
+    edns->setDNSSECAwareness(true);
+    for (BenchQueries::iterator it = queries.begin(); it != queries.end();
+         ++it) {
+        InputBuffer buffer(&(*it)[0], it->size());
+        parsed.clear(Message::PARSE);
+        parsed.fromWire(buffer);
+        query.clear(Message::RENDER);
+        query.setQid(0);
+        query.setOpcode(Opcode::QUERY());
+        query.setRcode(Rcode::NOERROR());
+        query.addQuestion(*parsed.beginQuestion());
+        query.setEDNS(edns);
+        renderer.clear();
+        query.toWire(renderer);
+        const uint8_t* data = static_cast<const uint8_t*>(renderer.getData());
+        it->assign(data, data + renderer.getLength());
+    }
+}
+
+void
+printResult(const BenchResult& result, const string& datasrc_type,
+            size_t server_threads, size_t client_count, size_t window,
+            bool json)
+{
+    const double qps = result.received / result.duration;
+    if (json) {
+        ElementPtr e = Element::createMap();
+        e->set("datasrc", Element::create(datasrc_type));
+        e->set("server_threads",
+               Element::create(static_cast<long int>(server_threads)));
+        e->set("client_threads",
+               Element::create(static_cast<long int>(client_count)));
+        e->set("window", Element::create(static_cast<long int>(window)));
+        e->set("sent", Element::create(static_cast<long int>(result.sent)));
+        e->set("received",
+               Element::create(static_cast<long int>(result.received)));
+        e->set("lost", Element::create(static_cast<long int>(result.lost)));
+        e->set("duration", Element::create(result.duration));
+        e->set("qps", Element::create(qps));
+        ElementPtr latency = Element::createMap();
+        latency->set("p50", Element::create(static_cast<long int>(
+                                                result.getPercentile(50))));
+        latency->set("p90", Element::create(static_cast<long int>(
+                                                result.getPercentile(90))));
+        latency->set("p99", Element::create(static_cast<long int>(
+                                                result.getPercentile(99))));
+        latency->set("p99.9", Element::create(static_cast<long int>(
+                                                  result.getPercentile(99.9))));
+        latency->set("max", Element::create(static_cast<long int>(
+                                                result.getPercentile(100))));
+        e->set("latency_usec", latency);
+        cout << e->str() << endl;
+        return;
+    }
+
+    cout << "Server threads " << server_threads << ": processed "
+         << result.received << "/" << result.sent << " queries in ";
+    cout.precision(6);
+    cout << fixed << result.duration << "s";
+    cout.precision(2);
+    cout << " (" << fixed << qps << "qps), " << result.lost << " lost"
+         << endl;
+    cout << "  latency (usec): p50=" << result.getPercentile(50)
+         << " p90=" << result.getPercentile(90)
+         << " p99=" << result.getPercentile(99)
+         << " p99.9=" << result.getPercentile(99.9)
+         << " max=" << result.getPercentile(100) << endl;
+}
+
+vector<string>
+splitList(const string& text) {
+    vector<string> result;
+    stringstream ss(text);
+    string item;
+    while (getline(ss, item, ',')) {
+        if (!item.empty()) {
+            result.push_back(item);
+        }
+    }
+    return (result);
+}
+
+const int ITERATION_DEFAULT = 1;
+const int CLIENTS_DEFAULT = 4;
+const int WINDOW_DEFAULT = 8;
+const int TIMEOUT_DEFAULT = 1000;
+const int WORKLOAD_COUNT_DEFAULT = 1000;
+const char* const IMAGE_FILE_DEFAULT = "udp_bench.mapped";
+
+void
+usage() {
+    cerr <<
+        "Usage: udp_bench [-dDj] [-t datasrc_type] [-o origin] "
+        "[-q query_datafile]\n"
+        "                 [-w workloads] [-c count] [-n iterations] "
+        "[-s server_threads]\n"
+        "                 [-C clients] [-W window] [-T timeout] "
+        "[-m image_file] datasrc_file\n"
+        "  -d Enable debug logging to stdout\n"
+        "  -D Set the DO bit of EDNS in all queries\n"
+        "  -j Print the results in JSON, one line per measurement\n"
+        "  -t Type of data source: sqlite3|memory|mapped "
+        "(default: sqlite3)\n"
+        "  -o Origin name of datasrc_file; necessary for \"memory\",\n"
+        "     \"mapped\" and -w\n"
+        "  -q Queryperf style input data\n"
+        "  -w Comma separated workloads generated from the zone;\n"
+        "     each of positive|any|nxdomain|wildcard\n"
+        "  -c Number of queries generated per workload (default: "
+         << WORKLOAD_COUNT_DEFAULT << ")\n"
+        "  -n Number of iterations over the queries (default: "
+         << ITERATION_DEFAULT << ")\n"
+        "  -s Comma separated numbers of server worker threads to measure;\n"
+        "     0 means the main thread only (default: 0)\n"
+        "  -C Number of client threads (default: " << CLIENTS_DEFAULT
+         << ")\n"
+        "  -W Outstanding queries per client (default: " << WINDOW_DEFAULT
+         << ")\n"
+        "  -T Timeout for responses in msec (default: " << TIMEOUT_DEFAULT
+         << ")\n"
+        "  -m Image file built for \"mapped\" (default: "
+         << IMAGE_FILE_DEFAULT << ")\n"
+        "  datasrc_file: sqlite3 DB file for \"sqlite3\", "
+        "textual master file for\n"
+        "     \"memory\" and \"mapped\" data sources"
+         << endl;
+    exit (1);
+}
+}
+
+int
+main(int argc, char* argv[]) {
+    int ch;
+    int iteration = ITERATION_DEFAULT;
+    int client_count = CLIENTS_DEFAULT;
+    int window = WINDOW_DEFAULT;
+    int timeout = TIMEOUT_DEFAULT;
+    int workload_count = WORKLOAD_COUNT_DEFAULT;
+    string datasrc_type = "sqlite3";
+    const char* origin = NULL;
+    const char* query_data_file = NULL;
+    const char* image_file = IMAGE_FILE_DEFAULT;
+    vector<string> workloads;
+    vector<string> server_threads(1, "0");
+    bool debug_log = false;
+    bool dnssec_ok = false;
+    bool json = false;
+    while ((ch = getopt(argc, argv, "dDjt:o:q:w:c:n:s:C:W:T:m:")) != -1) {
+        switch (ch) {
+        case 'd':
+            debug_log = true;
+            break;
+        case 'D':
+            dnssec_ok = true;
+            break;
+        case 'j':
+            json = true;
+            break;
+        case 't':
+            datasrc_type = optarg;
+            break;
+        case 'o':
+            origin = optarg;
+            break;
+        case 'q':
+            query_data_file = optarg;
+            break;
+        case 'w':
+            workloads = splitList(optarg);
+            break;
+        case 'c':
+            workload_count = atoi(optarg);
+            break;
+        case 'n':
+            iteration = atoi(optarg);
+            break;
+        case 's':
+            server_threads = splitList(optarg);
+            break;
+        case 'C':
+            client_count = atoi(optarg);
+            break;
+        case 'W':
+            window = atoi(optarg);
+            break;
+        case 'T':
+            timeout = atoi(optarg);
+            break;
+        case 'm':
+            image_file = optarg;
+            break;
+        case '?':
+        default:
+            usage();
+        }
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc < 1 || iteration <= 0 || client_count <= 0 || window <= 0 ||
+        timeout <= 0 || workload_count <= 0 || server_threads.empty()) {
+        usage();
+    }
+    const char* const datasrc_file = argv[0];
+
+    if (datasrc_type != "sqlite3" && datasrc_type != "memory" &&
+        datasrc_type != "mapped") {
+        cerr << "Unknown data source type: " << datasrc_type << endl;
+        return (1);
+    }
+    if (origin == NULL && (datasrc_type != "sqlite3" || !workloads.empty())) {
+        cerr << "'-o Origin' is missing" << endl;
+        return (1);
+    }
+    if (query_data_file == NULL && workloads.empty()) {
+        cerr << "Either '-q query_datafile' or '-w workloads' is necessary"
+             << endl;
+        return (1);
+    }
+
+    // By default disable logging to avoid unwanted noise.
+    initLogger("udp-bench", debug_log ? bundy::log::DEBUG : bundy::log::NONE,
+               bundy::log::MAX_DEBUG_LEVEL, NULL);
+
+    int ret = 0;
+    try {
+        ElementPtr datasrc_config;
+        if (datasrc_type == "sqlite3") {
+            datasrc_config = Element::fromJSON(
+                "{\"type\": \"sqlite3\","
+                " \"params\": {\"database_file\": \"" +
+                string(datasrc_file) + "\"}}");
+        } else {
+            datasrc_config = Element::fromJSON(
+                "{\"type\": \"MasterFiles\","
+                " \"params\": {\"" + string(origin) + "\": \"" +
+                string(datasrc_file) + "\"}}");
+            if (datasrc_type == "mapped") {
+                bundy::zonecompile::compileZones(RRClass::IN(),
+                                                 datasrc_config, image_file);
+                datasrc_config->set("cache-type", Element::create("mapped"));
+                datasrc_config->set("cache-image",
+                                    Element::create(string(image_file)));
+            }
+            datasrc_config->set("cache-enable", Element::create(true));
+        }
+        ElementPtr datasrc_list = Element::createList();
+        datasrc_list->add(datasrc_config);
+        ElementPtr config = Element::createMap();
+        config->set("IN", datasrc_list);
+
+        MockSocketSessionForwarder xfrout_forwarder;
+        MockSocketSessionForwarder ddns_forwarder;
+        AuthSrv server(xfrout_forwarder, ddns_forwarder);
+        // Note: setDataSrcClientLists() may be deprecated, but until then
+        // we use it because we want to be synchronized with the server.
+        server.getDataSrcClientsMgr().setDataSrcClientLists(
+            configureDataSource(config));
+
+        BenchQueries queries;
+        if (query_data_file != NULL) {
+            loadQueryData(query_data_file, queries, RRClass::IN());
+        }
+        if (!workloads.empty()) {
+            stringstream generated;
+            DataSrcClientsMgr::Holder holder(server.getDataSrcClientsMgr());
+            generateQueries(*holder.findClientList(RRClass::IN()),
+                            Name(origin), workloads, workload_count,
+                            generated);
+            loadQueryData(generated, queries, RRClass::IN(), true);
+        }
+        if (queries.empty()) {
+            bundy_throw(BenchMarkError, "no queries to send");
+        }
+        if (dnssec_ok) {
+            setDNSSECOK(queries);
+        }
+
+        if (!json) {
+            cout << "Parameters:" << endl;
+            cout << "  Iterations: " << iteration << endl;
+            cout << "  Data Source: type=" << datasrc_type << ", file="
+                 << datasrc_file << endl;
+            if (origin != NULL) {
+                cout << "  Origin: " << origin << endl;
+            }
+            cout << "  Queries: " << queries.size();
+            if (query_data_file != NULL) {
+                cout << ", file=" << query_data_file;
+            }
+            if (!workloads.empty()) {
+                cout << ", workloads=";
+                for (size_t i = 0; i < workloads.size(); ++i) {
+                    cout << (i > 0 ? "," : "") << workloads[i];
+                }
+            }
+            cout << (dnssec_ok ? ", DO bit set" : "") << endl;
+            cout << "  Clients: " << client_count << " threads, window "
+                 << window << endl << endl;
+        }
+
+        LoopbackSocketRequestor requestor;
+        initTestSocketRequestor(&requestor);
+        IOService& io_service = server.getIOService();
+        DNSService dns_service(io_service, server.getDNSLookupProvider(),
+                               server.getDNSAnswerProvider());
+        server.setDNSService(dns_service);
+        server.setListenAddresses(
+            portconfig::AddressList(1, portconfig::AddressPair("127.0.0.1",
+                                                               0)));
+
+        Thread io_thread(boost::bind(&IOService::run, &io_service));
+        const size_t queries_per_client =
+            queries.size() * iteration / client_count;
+        try {
+            for (vector<string>::const_iterator it = server_threads.begin();
+                 it != server_threads.end(); ++it) {
+                const size_t count = boost::lexical_cast<size_t>(*it);
+                server.setWorkerThreads(count);
+                const BenchResult result =
+                    runClients(queries, client_count, queries_per_client,
+                               window, timeout, requestor.getUDPPort());
+                printResult(result, datasrc_type, count, client_count,
+                            window, json);
+            }
+        } catch (...) {
+            io_service.stop();
+            io_thread.wait();
+            throw;
+        }
+        io_service.stop();
+        io_thread.wait();
+
+        server.setWorkerThreads(0);
+        server.setListenAddresses(portconfig::AddressList());
+        initTestSocketRequestor(NULL);
+    } catch (const std::exception& ex) {
+        cerr << "Test unexpectedly failed: " << ex.what() << endl;
+        ret = 1;
+    }
+    if (datasrc_type == "mapped") {
+        unlink(image_file);
+    }
+
+    return (ret);
+}
@@ -144,10 +144,18 @@ public:
     }
 };
 
-// Handle the "getstats" command.  The argument is a list.
+// Handle the "getstats" command.  The argument is an optional map, whose
+// "since" item tells the last report the stats daemon has received; only
+// the statistics changed since then are returned in that case.
 class GetStatsCommand : public AuthCommand {
 public:
-    virtual ConstElementPtr exec(AuthSrv& server, bundy::data::ConstElementPtr) {
+    virtual ConstElementPtr exec(AuthSrv& server,
+                                 bundy::data::ConstElementPtr args)
+    {
+        if (args && args->getType() == Element::map &&
+            args->contains("since")) {
+            return (createAnswer(0, server.getStatisticsReport(args)));
+        }
         return (createAnswer(0, server.getStatistics()));
     }
 };
@@ -181,6 +189,57 @@ public:
     }
 };
 
+// Handle the "get_zone_load_status" command.
+class GetZoneLoadStatusCommand : public AuthCommand {
+public:
+    virtual ConstElementPtr exec(AuthSrv& server,
+                                 bundy::data::ConstElementPtr)
+    {
+        const bundy::auth::ZoneLoadProgress progress =
+            server.getDataSrcClientsMgr().getZoneLoadProgress();
+        ElementPtr status = Element::createMap();
+        status->set("loading", Element::create(progress.loading));
+        status->set("zones_found",
+                    Element::create(static_cast<long int>(
+                                        progress.zones_found)));
+        status->set("zones_loaded",
+                    Element::create(static_cast<long int>(
+                                        progress.zones_loaded)));
+        return (createAnswer(0, status));
+    }
+};
+
+// Handle the "get_zone_memory_usage" command.
+class GetZoneMemoryUsageCommand : public AuthCommand {
+public:
+    virtual ConstElementPtr exec(AuthSrv& server,
+                                 bundy::data::ConstElementPtr)
+    {
+        return (createAnswer(0, server.getZoneMemoryUsage()));
+    }
+};
+
+// Handle the "save_hot_names" command.
+class SaveHotNamesCommand : public AuthCommand {
+public:
+    virtual ConstElementPtr exec(AuthSrv& server,
+                                 bundy::data::ConstElementPtr args)
+    {
+        // Enough for the names to fill the lower cache levels.
+        size_t max_names = 10000;
+        if (args && args->getType() == Element::map &&
+            args->contains("max_names")) {
+            const int64_t count = args->get("max_names")->intValue();
+            if (count <= 0) {
+                bundy_throw(AuthCommandError,
+                            "max_names must be positive: " << count);
+            }
+            max_names = count;
+        }
+        return (createAnswer(0, server.saveHotNames(max_names)));
+    }
+};
+
 // The factory of command objects.
 AuthCommand*
 createAuthCommand(const string& command_id) {
@@ -192,6 +251,12 @@ createAuthCommand(const string& command_id) {
         return (new GetStatsCommand());
     } else if (command_id == "loadzone") {
         return (new LoadZoneCommand());
+    } else if (command_id == "get_zone_load_status") {
+        return (new GetZoneLoadStatusCommand());
+    } else if (command_id == "get_zone_memory_usage") {
+        return (new GetZoneMemoryUsageCommand());
+    } else if (command_id == "save_hot_names") {
+        return (new SaveHotNamesCommand());
     } else if (command_id == "start_ddns_forwarder") {
         return (new StartDDNSForwarderCommand());
     } else if (command_id == "stop_ddns_forwarder") {
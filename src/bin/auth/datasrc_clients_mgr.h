@@ -17,10 +17,12 @@
 
 #include <util/threads/thread.h>
 #include <util/threads/sync.h>
+#include <util/threads/rcu.h>
 
 #include <log/logger_support.h>
 #include <log/log_dbglevels.h>
 
+#include <dns/name.h>
 #include <dns/rrclass.h>
 
 #include <cc/data.h>
@@ -30,6 +32,7 @@
 #include <datasrc/memory/zone_writer.h>
 
 #include <asiolink/io_service.h>
+#include <asiolink/interval_timer.h>
 #include <asiolink/local_socket.h>
 
 #include <auth/auth_log.h>
@@ -42,13 +45,16 @@
 #include <boost/function.hpp>
 #include <boost/foreach.hpp>
 
+#include <atomic>
 #include <exception>
 #include <cassert>
 #include <cerrno>
 #include <list>
+#include <map>
 #include <utility>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <time.h>
 
 namespace bundy {
 namespace auth {
@@ -66,6 +72,19 @@ public:
         bundy::Exception(file, line, what) {}
 };
 
+/// \brief Progress of loading zones on a data source reconfiguration.
+///
+/// It's a snapshot of the state of the latest reconfiguration that is
+/// (or was) in progress in the builder thread.
+struct ZoneLoadProgress {
+    /// \brief true iff a reconfiguration is currently in progress.
+    bool loading;
+    /// \brief The number of zones to be loaded on the reconfiguration.
+    size_t zones_found;
+    /// \brief The number of zones that have been loaded so far.
+    size_t zones_loaded;
+};
+
 namespace datasrc_clientmgr_internal {
 // This namespace is essentially private for DataSrcClientsMgr(Base) and
 // DataSrcClientsBuilder(Base).  This is exposed in the public header
@@ -105,6 +124,60 @@ typedef boost::function<void (data::ConstElementPtr arg)> FinishedCallback;
 /// \brief A pair of the callback functor and its argument.
 typedef std::pair<FinishedCallback, data::ConstElementPtr> FinishedCallbackPair;
 
+/// \brief Callback to be called when the data of zones are replaced.
+///
+/// It takes the origin and the RR class of the replaced zone; the root
+/// name means all zones of the class.  It's called in the builder thread
+/// (or in the calling thread for \c setDataSrcClientLists()) while the
+/// clients map is locked, so it must be quick and exception free, and must
+/// not call the manager.
+typedef boost::function<void (const dns::Name& origin,
+                              const dns::RRClass& rrclass)>
+ZoneUpdatedCallback;
+
+/// \brief Call a \c ZoneUpdatedCallback (if set) for all classes of the
+/// given clients map.
+template <typename ClientListsMapType>
+void
+notifyAllZonesUpdated(const ZoneUpdatedCallback& callback,
+                      const ClientListsMapType& clients_map)
+{
+    if (!callback) {
+        return;
+    }
+    for (typename ClientListsMapType::const_iterator it = clients_map.begin();
+         it != clients_map.end();
+         ++it) {
+        callback(dns::Name::ROOT_NAME(), it->first);
+    }
+}
+
+/// \brief The clients map as seen by the readers of the manager.
+///
+/// The query processing threads (through \c DataSrcClientsMgr::Holder)
+/// don't lock anything to get access to the clients map.  Instead, they
+/// get the map from \c map in an RCU read-side critical section of
+/// \c rcu.  A writer publishes a new map by storing it in \c map, and
+/// keeps the old one alive until \c rcu.synchronize() returns; updates
+/// within the published map (such as installing new zone data) are done
+/// with an \c RCU::ExclusiveLocker.  Writers are still serialized with
+/// each other by the map mutex.
+struct ClientListMapReaders : boost::noncopyable {
+    /// \brief The map type.
+    typedef datasrc::ClientListMapPtr::element_type ClientListsMap;
+
+    /// \brief Constructor, publishing the initial map.
+    explicit ClientListMapReaders(const ClientListsMap* initial_map) :
+        map(initial_map)
+    {}
+
+    /// \brief Synchronization among the readers and the writers.
+    util::thread::RCU rcu;
+
+    /// \brief The currently published map.
+    std::atomic<const ClientListsMap*> map;
+};
+
 /// \brief The data type passed from DataSrcClientsMgr to
 ///     DataSrcClientsBuilder.
 ///
@@ -192,6 +265,15 @@ public:
     /// causing a race condition with other threads that can possibly use
     /// the same manager throughout the lifetime of the holder object.
     ///
+    /// It doesn't lock the manager: the holder takes a snapshot of the
+    /// clients map in an RCU read-side critical section, which prevents the
+    /// builder thread from releasing the map or modifying zone data in it
+    /// while the holder exists (see
+    /// \c datasrc_clientmgr_internal::ClientListMapReaders).  Many holders
+    /// can therefore exist at the same time in different threads, but a
+    /// thread must not create another holder of the same manager while it
+    /// has one.
+    ///
     /// This also means the holder object is expected to have a short lifetime.
     /// The application shouldn't try to keep it unnecessarily long.
     /// It's normally expected to create the holder object on the stack
@@ -200,7 +282,8 @@ public:
     class Holder {
     public:
         Holder(DataSrcClientsMgrBase& mgr) :
-            mgr_(mgr), locker_(mgr_.map_mutex_)
+            locker_(mgr.readers_.rcu),
+            clients_map_(*mgr.readers_.map.load())
         {}
 
         /// \brief Find a data source client list of a specified RR class.
@@ -222,8 +305,8 @@ public:
             const dns::RRClass& rrclass)
         {
             const ClientListsMap::const_iterator
-                it = mgr_.clients_map_->find(rrclass);
-            if (it == mgr_.clients_map_->end()) {
+                it = clients_map_.find(rrclass);
+            if (it == clients_map_.end()) {
                 return (boost::shared_ptr<datasrc::ConfigurableClientList>());
             } else {
                 return (it->second);
@@ -240,16 +323,16 @@ public:
         /// \throw std::bad_alloc for problems allocating the result.
         std::vector<dns::RRClass> getClasses() const {
             std::vector<dns::RRClass> result;
-            for (ClientListsMap::const_iterator it =
-                 mgr_.clients_map_->begin(); it != mgr_.clients_map_->end();
+            for (ClientListsMap::const_iterator it = clients_map_.begin();
+                 it != clients_map_.end();
                  ++it) {
                 result.push_back(it->first);
             }
             return (result);
         }
     private:
-        DataSrcClientsMgrBase& mgr_;
-        typename MutexType::Locker locker_;
+        util::thread::RCU::ReadLocker locker_;
+        const ClientListsMap& clients_map_;
     };
 
     /// \brief Constructor.
@@ -266,12 +349,16 @@ public:
     /// \throw bundy::Unexpected general unexpected system errors.
     DataSrcClientsMgrBase(asiolink::IOService& service) :
         clients_map_(new ClientListsMap),
+        readers_(clients_map_.get()),
         fd_guard_(new FDGuard(this)),
         read_fd_(-1), write_fd_(-1),
         builder_(&command_queue_, &callback_queue_, &cond_, &queue_mutex_,
-                 &clients_map_, &map_mutex_, createFds()),
+                 &clients_map_, &map_mutex_, createFds(),
+                 &zone_updated_callback_, &readers_),
         builder_thread_(boost::bind(&BuilderType::run, &builder_)),
-        wakeup_socket_(service, read_fd_)
+        wakeup_socket_(service, read_fd_),
+        service_(service),
+        zone_update_interval_(0)
     {
         // Schedule wakeups when callbacks are pushed.
         wakeup_socket_.asyncRead(
@@ -353,7 +440,30 @@ public:
     /// newer tests must not use this.
     void setDataSrcClientLists(datasrc::ClientListMapPtr new_lists) {
         typename MutexType::Locker locker(map_mutex_);
-        clients_map_ = new_lists;
+        datasrc_clientmgr_internal::notifyAllZonesUpdated(
+            zone_updated_callback_, *clients_map_);
+        clients_map_.swap(new_lists);
+        readers_.map.store(clients_map_.get());
+        datasrc_clientmgr_internal::notifyAllZonesUpdated(
+            zone_updated_callback_, *clients_map_);
+        // The old lists (now in new_lists) are released on return, once
+        // no reader can see them.
+        readers_.rcu.synchronize();
+    }
+
+    /// \brief Set the callback to be notified of replaced zone data.
+    ///
+    /// The callback is called every time the builder thread replaces data
+    /// of a zone (by loading or updating it), data of a memory segment or
+    /// the whole clients map, right after replacing it
+    /// (see \c datasrc_clientmgr_internal::ZoneUpdatedCallback).  It's
+    /// intended to be used to invalidate anything derived from the zone
+    /// data, such as cached responses.  An empty functor disables it.
+    void setZoneUpdatedCallback(
+        const datasrc_clientmgr_internal::ZoneUpdatedCallback& callback)
+    {
+        typename MutexType::Locker locker(map_mutex_);
+        zone_updated_callback_ = callback;
     }
 
     /// \brief Instruct internal thread to (re)load a zone
@@ -377,9 +487,68 @@ public:
                            callback);
     }
 
+    /// \brief Instruct internal thread to reload an updated zone
+    ///
+    /// It's similar to \c loadZone(), but is intended for notifications of
+    /// zone updates from other modules, so \c args must also contain the
+    /// "datasource" the zone belongs to.
+    ///
+    /// As the builder reloads the whole zone from the data source, the
+    /// update is merged into a reload of the same zone that is still queued
+    /// for it.  Also, if a minimum interval between the reloads is set
+    /// (see \c setZoneUpdateInterval()), a zone updated again before the
+    /// end of the interval is only reloaded at its end, once for all the
+    /// updates in between.
+    ///
+    /// \exception CommandError same as \c loadZone(), or if the args value
+    ///                         doesn't contain a "datasource"
     void updateZone(const data::ConstElementPtr& args) {
-        updateZoneInternal(datasrc_clientmgr_internal::UPDATEZONE, args,
-                           datasrc_clientmgr_internal::FinishedCallback());
+        validateZoneArgs(datasrc_clientmgr_internal::UPDATEZONE, args);
+
+        if (zone_update_interval_ == 0) {
+            sendZoneUpdate(args);
+            return;
+        }
+        const ZoneKey key(getZoneKey(args));
+        ZoneUpdateState& state = zone_updates_[key];
+        if (state.deferred_) {
+            // The reload is already scheduled, it'll use the latest args.
+            state.deferred_ = args;
+            return;
+        }
+        const uint64_t now = getCurrentTime();
+        if (state.last_ == 0 || now - state.last_ >= zone_update_interval_) {
+            state.last_ = now;
+            sendZoneUpdate(args);
+            return;
+        }
+        state.deferred_ = args;
+        if (!state.timer_) {
+            state.timer_.reset(new asiolink::IntervalTimer(service_));
+        }
+        state.timer_->setup(
+            boost::bind(&DataSrcClientsMgrBase::sendDeferredZoneUpdate, this,
+                        key),
+            state.last_ + zone_update_interval_ - now);
+    }
+
+    /// \brief Set the minimum interval between the reloads of a zone on
+    /// updates.
+    ///
+    /// See \c updateZone().  0 (the default) disables the limit; the
+    /// updates are then only merged while a reload is still queued.
+    /// It doesn't apply to \c loadZone().  The reloads already deferred
+    /// are kept as scheduled.
+    ///
+    /// \param interval The interval in milliseconds.
+    void setZoneUpdateInterval(uint32_t interval) {
+        zone_update_interval_ = interval;
+    }
+
+    /// \brief Return the minimum interval between the reloads of a zone on
+    /// updates, in milliseconds.
+    uint32_t getZoneUpdateInterval() const {
+        return (zone_update_interval_);
     }
 
     void segmentInfoUpdate(const data::ConstElementPtr& args,
@@ -424,6 +593,24 @@ public:
                     callback);
     }
 
+    /// \brief Set the number of threads to load zones on reconfiguration.
+    ///
+    /// It takes effect from the next reconfiguration.  Only zones of
+    /// "MasterFiles" data sources cached in local memory segments are
+    /// loaded in parallel; others are always loaded one by one.
+    ///
+    /// \throw bundy::InvalidParameter thread_count is 0
+    void setZoneLoadThreads(size_t thread_count) {
+        builder_.setZoneLoadThreads(thread_count);
+    }
+
+    /// \brief Return the progress of loading zones in the builder thread.
+    ///
+    /// \throw None
+    ZoneLoadProgress getZoneLoadProgress() const {
+        return (builder_.getZoneLoadProgress());
+    }
+
 private:
     // This is expected to be called at the end of the destructor.  It
     // actually does nothing, but provides a customization point for
@@ -436,6 +623,14 @@ private:
                             const data::ConstElementPtr& args,
                             const datasrc_clientmgr_internal::FinishedCallback&
                             callback)
+    {
+        validateZoneArgs(command, args);
+        sendCommand(command, args, callback);
+    }
+
+    // Common argument checks of LOADZONE and UPDATEZONE.
+    void validateZoneArgs(datasrc_clientmgr_internal::CommandID command,
+                          const data::ConstElementPtr& args)
     {
         const std::string& command_str =
             (command == datasrc_clientmgr_internal::LOADZONE) ?
@@ -493,8 +688,67 @@ private:
         // For now these are skipped, but one obvious way to
         // implement it would be to factor out the code from
         // the start of doUpdateZone(), and call it here too
+    }
 
-        sendCommand(command, args, callback);
+    // The zones whose updates are tracked, by class and origin.  The args
+    // are expected to have been validated.
+    typedef std::pair<dns::RRClass, dns::Name> ZoneKey;
+    static ZoneKey getZoneKey(const data::ConstElementPtr& args) {
+        return (ZoneKey(args->contains("class") ?
+                        dns::RRClass(args->get("class")->stringValue()) :
+                        dns::RRClass::IN(),
+                        dns::Name(args->get("origin")->stringValue())));
+    }
+
+    // Queue an UPDATEZONE command, unless one for the same zone of the same
+    // data source is still queued: the builder will then reload the zone
+    // with this update anyway.  We don't look beyond a RECONFIGURE, as the
+    // zone may be served differently after it.
+    void sendZoneUpdate(const data::ConstElementPtr& args) {
+        const ZoneKey key(getZoneKey(args));
+        const std::string& datasrc_name = args->get("datasource")->stringValue();
+
+        typename MutexType::Locker locker(queue_mutex_);
+        for (std::list<datasrc_clientmgr_internal::Command>::
+                 const_reverse_iterator it = command_queue_.rbegin();
+             it != command_queue_.rend() &&
+                 it->id != datasrc_clientmgr_internal::RECONFIGURE;
+             ++it) {
+            if (it->id == datasrc_clientmgr_internal::UPDATEZONE &&
+                getZoneKey(it->params) == key &&
+                it->params->get("datasource")->stringValue() == datasrc_name) {
+                LOG_DEBUG(auth_logger, DBGLVL_TRACE_DETAIL,
+                          AUTH_DATASRC_CLIENTS_ZONE_UPDATE_MERGED).
+                    arg(key.second).arg(key.first);
+                return;
+            }
+        }
+        command_queue_.push_back(
+            datasrc_clientmgr_internal::Command(
+                datasrc_clientmgr_internal::UPDATEZONE, args,
+                datasrc_clientmgr_internal::FinishedCallback()));
+        cond_.signal();
+    }
+
+    // Timer callback of a reload deferred by updateZone().
+    void sendDeferredZoneUpdate(const ZoneKey& key) {
+        ZoneUpdateState& state = zone_updates_[key];
+        state.timer_->cancel(); // the timer is one-shot
+        if (state.deferred_) {
+            state.last_ = getCurrentTime();
+            const data::ConstElementPtr args = state.deferred_;
+            state.deferred_.reset();
+            sendZoneUpdate(args);
+        }
+    }
+
+    // The current time in milliseconds from an arbitrary point, unaffected
+    // by changes of the system time.
+    static uint64_t getCurrentTime() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (static_cast<uint64_t>(ts.tv_sec) * 1000 +
+                ts.tv_nsec / 1000000);
     }
 
     // same as cleanup(), for reconfigure().
@@ -565,15 +819,31 @@ private:
     MutexType queue_mutex_;     // mutex to protect the queue
     datasrc::ClientListMapPtr clients_map_;
                                 // map of actual data source client objects
+    // The clients map for readers, see ClientListMapReaders
+    datasrc_clientmgr_internal::ClientListMapReaders readers_;
     boost::scoped_ptr<FDGuard> fd_guard_; // A guard to close the fds.
     int read_fd_, write_fd_;    // Descriptors for wakeup
-    MutexType map_mutex_;       // mutex to protect the clients map
+    MutexType map_mutex_;       // mutex to serialize updates to clients map
+    // Called on replacing zone data, protected by map_mutex_
+    datasrc_clientmgr_internal::ZoneUpdatedCallback zone_updated_callback_;
 
     BuilderType builder_;
     ThreadType builder_thread_; // for safety this should be placed last
     bundy::asiolink::LocalSocket wakeup_socket_; // For integration of read_fd_
                                                // to the asio loop
     char buffer[1];   // Buffer for the wakeup socket.
+
+    // The rate limiting of the zone reloads on updates, only used in the
+    // main thread.
+    struct ZoneUpdateState {
+        ZoneUpdateState() : last_(0) {}
+        uint64_t last_;  // time of the last reload sent, see getCurrentTime()
+        data::ConstElementPtr deferred_; // args of the deferred reload if any
+        boost::shared_ptr<asiolink::IntervalTimer> timer_;
+    };
+    asiolink::IOService& service_;
+    uint32_t zone_update_interval_; // in milliseconds, 0 for no limit
+    std::map<ZoneKey, ZoneUpdateState> zone_updates_;
 };
 
 namespace datasrc_clientmgr_internal {
@@ -615,6 +885,8 @@ public:
     /// \brief Constructor.
     ///
     /// It simply sets up a local copy of shared data with the manager.
+    /// If \c readers is NULL, the builder uses its own one, which is only
+    /// useful for tests where there's no other thread to read the map.
     ///
     /// \throw None
     DataSrcClientsBuilderBase(std::list<Command>* command_queue,
@@ -622,12 +894,18 @@ public:
                               CondVarType* cond, MutexType* queue_mutex,
                               datasrc::ClientListMapPtr* clients_map,
                               MutexType* map_mutex,
-                              int wake_fd
+                              int wake_fd,
+                              ZoneUpdatedCallback* zone_updated_callback = NULL,
+                              ClientListMapReaders* readers = NULL
         ) :
         command_queue_(command_queue), callback_queue_(callback_queue),
         cond_(cond), queue_mutex_(queue_mutex),
         clients_map_(clients_map), map_mutex_(map_mutex), wake_fd_(wake_fd),
-        gen_id_(-1)
+        zone_updated_callback_(zone_updated_callback),
+        own_readers_(clients_map->get()),
+        readers_(readers != NULL ? readers : &own_readers_),
+        gen_id_(-1), zone_load_threads_(1), loading_(false), zones_found_(0),
+        zones_loaded_(0)
     {}
 
     /// \brief The main loop.
@@ -651,6 +929,33 @@ public:
         return (callbacks_);
     }
 
+    /// \brief Set the number of threads to load zones on reconfiguration.
+    ///
+    /// This can be called from a thread other than the builder's one.
+    ///
+    /// \throw bundy::InvalidParameter thread_count is 0
+    void setZoneLoadThreads(size_t thread_count) {
+        if (thread_count == 0) {
+            bundy_throw(InvalidParameter,
+                        "number of zone load threads must not be 0");
+        }
+        zone_load_threads_.store(thread_count);
+    }
+
+    /// \brief Return the progress of loading zones.
+    ///
+    /// This can be called from a thread other than the builder's one.
+    /// Each counter is consistent by itself, but they are not read
+    /// atomically as a whole, so this is only for informational purposes.
+    ///
+    /// \throw None
+    ZoneLoadProgress getZoneLoadProgress() const {
+        const ZoneLoadProgress progress = {
+            loading_.load(), zones_found_.load(), zones_loaded_.load()
+        };
+        return (progress);
+    }
+
 private:
     // NOOP command handler.  We use this so tests can override it; the default
     // implementation really does nothing.
@@ -685,11 +990,22 @@ private:
         // Define new_clients_map outside of the block that has the lock scope;
         // this way, after the swap, the lock is guaranteed to be released
         // before the old data is destroyed, minimizing the lock duration.
+        // Readers are never blocked by this; they see either map until the
+        // new one is published, and we wait for those that could still see
+        // the old one before releasing it.
         {
             typename MutexType::Locker locker(*map_mutex_);
             pending_map_->clients_map_.swap(*clients_map_);
+            readers_->map.store(clients_map_->get());
+            if (zone_updated_callback_ != NULL) {
+                notifyAllZonesUpdated(*zone_updated_callback_,
+                                      *pending_map_->clients_map_);
+                notifyAllZonesUpdated(*zone_updated_callback_,
+                                      **clients_map_);
+            }
         } // lock is released by leaving scope
-          // old clients_map_ data is released by leaving scope
+        readers_->rcu.synchronize();
+          // old clients_map_ data is released by resetting pending_map_
 
         if (pending_callback_) {
             callbacks_.push_back(FinishedCallbackPair(pending_callback_,
@@ -703,6 +1019,27 @@ private:
             arg(gen_id_);
     }
 
+    // Called by the client lists (possibly from their loader threads) as
+    // zones are found and loaded during reconfiguration.
+    void updateZoneLoadProgress(size_t zones_found, size_t zones_loaded) {
+        zones_found_.fetch_add(zones_found);
+        zones_loaded_.fetch_add(zones_loaded);
+    }
+
+    // Mark the zone loading state for the lifetime of the object, so it'll
+    // be reset even if reconfiguration fails with an exception.
+    class ZoneLoadingMarker : boost::noncopyable {
+    public:
+        ZoneLoadingMarker(std::atomic<bool>& loading) : loading_(loading) {
+            loading_.store(true);
+        }
+        ~ZoneLoadingMarker() {
+            loading_.store(false);
+        }
+    private:
+        std::atomic<bool>& loading_;
+    };
+
     // This method returns a bool element, whose value is true iff shared-type
     // memory segment is going to be used.  It will be used as a callback
     // argument so it can be used in the callback to determine whether to
@@ -735,9 +1072,17 @@ private:
                 // that we override any existing pending generation; it does
                 // not make sense to complete such an intermediate version, and
                 // even memmgr may have stopped completing it.
+                zones_found_.store(0);
+                zones_loaded_.store(0);
+                const ZoneLoadingMarker marker(loading_);
                 pending_map_.reset(
                     new PendingClientListMap(
-                        configureDataSource(mod_config->get("classes")),
+                        configureDataSource(
+                            mod_config->get("classes"),
+                            zone_load_threads_.load(),
+                            boost::bind(&DataSrcClientsBuilderBase::
+                                        updateZoneLoadProgress,
+                                        this, _1, _2)),
                         genid));
 
                 // Check if all memory segments are ready: if not, we are done
@@ -807,7 +1152,9 @@ private:
             }
         }
 
+        // The segment is remapped in place, so no reader may be using it.
         typename MutexType::Locker locker(*map_mutex_);
+        util::thread::RCU::ExclusiveLocker readers_locker(readers_->rcu);
         if (!list->resetMemorySegment(
                 dsrc_name, bundy::datasrc::memory::ZoneTableSegment::READ_ONLY,
                 segment_params)) {
@@ -816,6 +1163,7 @@ private:
                 .arg(rrclass).arg(dsrc_name);
             std::terminate();
         }
+        notifyZoneUpdated(dns::Name::ROOT_NAME(), rrclass);
     }
 
     void doSegmentUpdate(const bundy::data::ConstElementPtr& arg) {
@@ -881,6 +1229,16 @@ private:
         const dns::Name& origin);
     FinishedCallback doReleaseSegments(const Command& command);
 
+    // Call the zone updated callback, if any.  Must be called with
+    // map_mutex_ held.
+    void notifyZoneUpdated(const dns::Name& origin,
+                           const dns::RRClass& rrclass)
+    {
+        if (zone_updated_callback_ != NULL && *zone_updated_callback_) {
+            (*zone_updated_callback_)(origin, rrclass);
+        }
+    }
+
     // The following are shared with the manager
     std::list<Command>* command_queue_;
     std::list<FinishedCallbackPair> *callback_queue_;
@@ -889,6 +1247,9 @@ private:
     datasrc::ClientListMapPtr* clients_map_;
     MutexType* map_mutex_;
     int wake_fd_;
+    ZoneUpdatedCallback* zone_updated_callback_;
+    ClientListMapReaders own_readers_; // used if not shared with the manager
+    ClientListMapReaders* readers_;
 
     // These are local to the builder thread:
     // Placeholder for pending new generation of data source clients.  Defined
@@ -905,6 +1266,12 @@ private:
     int64_t gen_id_;    // effective generation ID of the current clients_map_
                         // begin with -1, and >= 0 once configured.
 
+    // Zone loading parameters and progress, shared with the manager.
+    std::atomic<size_t> zone_load_threads_;
+    std::atomic<bool> loading_;
+    std::atomic<size_t> zones_found_;
+    std::atomic<size_t> zones_loaded_;
+
     // local queue of call backs to be purged at the end of command handling
     std::list<FinishedCallbackPair> callbacks_;
 
@@ -1084,16 +1451,21 @@ DataSrcClientsBuilderBase<MutexType, CondVarType>::doUpdateZone(
         }
 
         zwriter->load(); // this can take time but doesn't cause a race
-        {   // install() can cause a race and must be in a critical section
+        {   // install() can cause a race and must be in a critical section;
+            // it updates the zone table in place, so readers must wait.
             typename MutexType::Locker locker(*map_mutex_);
+            util::thread::RCU::ExclusiveLocker readers_locker(readers_->rcu);
             zwriter->install();
+            notifyZoneUpdated(origin, rrclass);
         }
         LOG_DEBUG(auth_logger, DBG_AUTH_OPS,
                   AUTH_DATASRC_CLIENTS_BUILDER_LOAD_ZONE)
             .arg(origin).arg(rrclass);
 
         // same as load(). We could let the destructor do it, but do it
-        // ourselves explicitly just in case.
+        // ourselves explicitly just in case.  The old zone data released
+        // here is not visible to readers any more, as we had exclusive
+        // access while installing the new one.
         zwriter->cleanup();
     } catch (const InternalCommandError& ex) {
         throw;     // this comes from getZoneWriter.  just let it go through.
@@ -1123,6 +1495,7 @@ DataSrcClientsBuilderBase<MutexType, CondVarType>::getZoneWriter(
     datasrc::ConfigurableClientList::ZoneWriterPair writerpair;
     {
         typename MutexType::Locker locker(*map_mutex_);
+        util::thread::RCU::ExclusiveLocker readers_locker(readers_->rcu);
         writerpair = client_list.getCachedZoneWriter(origin, false,
                                                      datasrc_name);
     }
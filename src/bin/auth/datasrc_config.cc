@@ -18,7 +18,12 @@
 // This is a trivial specialization for the commonly used version.
 // Defined in .cc to avoid accidental creation of multiple copies.
 bundy::datasrc::ClientListMapPtr
-configureDataSource(const bundy::data::ConstElementPtr& config) {
+configureDataSource(const bundy::data::ConstElementPtr& config,
+                    size_t load_thread_count,
+                    const bundy::datasrc::ConfigurableClientList::
+                    LoadProgressCallback& progress_callback)
+{
     return (configureDataSourceGeneric<
-            bundy::datasrc::ConfigurableClientList>(config));
+            bundy::datasrc::ConfigurableClientList>(config, load_thread_count,
+                                                    progress_callback));
 }
@@ -45,13 +45,22 @@
 ///
 /// \param config The configuration value to parse. It is in the form
 ///     as an update from the config manager.
+/// \param load_thread_count The number of threads to load zones of each
+///     list with (see \c ConfigurableClientList::setLoadThreadCount()).
+/// \param progress_callback If non empty, set to each list to report
+///     progress of loading zones.
 /// \return A map from RR classes to configured lists.
 /// \throw ConfigurationError if the config element is not in the expected
 ///        format (A map of lists)
 template<class List>
 boost::shared_ptr<std::map<bundy::dns::RRClass,
                            boost::shared_ptr<List> > > // = ListMap below
-configureDataSourceGeneric(const bundy::data::ConstElementPtr& config) {
+configureDataSourceGeneric(const bundy::data::ConstElementPtr& config,
+                           size_t load_thread_count = 1,
+                           const typename List::LoadProgressCallback&
+                           progress_callback =
+                           typename List::LoadProgressCallback())
+{
     typedef boost::shared_ptr<List> ListPtr;
     typedef std::map<std::string, bundy::data::ConstElementPtr> Map;
     typedef std::map<bundy::dns::RRClass, ListPtr> ListMap;
@@ -62,6 +71,8 @@ configureDataSourceGeneric(const bundy::data::ConstElementPtr& config) {
     for (Map::const_iterator it(map.begin()); it != map.end(); ++it) {
         const bundy::dns::RRClass rrclass(it->first);
         ListPtr list(new List(rrclass));
+        list->setLoadThreadCount(load_thread_count);
+        list->setLoadProgressCallback(progress_callback);
         list->configure(it->second, true);
         new_lists->insert(std::pair<bundy::dns::RRClass, ListPtr>(rrclass,
                                                                 list));
@@ -73,7 +84,12 @@ configureDataSourceGeneric(const bundy::data::ConstElementPtr& config) {
 /// \brief Concrete version of configureDataSource() for the
 ///     use with authoritative server implementation.
 bundy::datasrc::ClientListMapPtr
-configureDataSource(const bundy::data::ConstElementPtr& config);
+configureDataSource(const bundy::data::ConstElementPtr& config,
+                    size_t load_thread_count = 1,
+                    const bundy::datasrc::ConfigurableClientList::
+                    LoadProgressCallback& progress_callback =
+                    bundy::datasrc::ConfigurableClientList::
+                    LoadProgressCallback());
 
 #endif  // AUTH_DATASRC_CONFIG_H
 
@@ -0,0 +1,274 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+#include <auth/nsec3_proof_cache.h>
+
+#include <dns/labelsequence.h>
+#include <dns/nsec3hash.h>
+#include <dns/rdataclass.h>
+#include <util/encode/base32hex.h>
+
+#include <cassert>
+#include <cctype>
+
+using namespace bundy::dns;
+using namespace bundy::dns::rdata;
+using bundy::util::thread::Mutex;
+
+namespace bundy {
+namespace auth {
+
+namespace {
+void
+toUpper(std::string& str) {
+    for (std::string::iterator it = str.begin(); it != str.end(); ++it) {
+        *it = std::toupper(static_cast<unsigned char>(*it));
+    }
+}
+
+// Return a copy of the first NSEC3 RDATA of the RRset, or NULL if it
+// doesn't have one.
+boost::shared_ptr<const generic::NSEC3>
+getNSEC3(const AbstractRRset& rrset) {
+    if (rrset.getType() != RRType::NSEC3() || rrset.getRdataCount() == 0) {
+        return (boost::shared_ptr<const generic::NSEC3>());
+    }
+    RdataIteratorPtr rit = rrset.getRdataIterator();
+    const generic::NSEC3* nsec3 =
+        dynamic_cast<const generic::NSEC3*>(&rit->getCurrent());
+    if (nsec3 == NULL) {
+        return (boost::shared_ptr<const generic::NSEC3>());
+    }
+    return (boost::shared_ptr<const generic::NSEC3>(
+                new generic::NSEC3(*nsec3)));
+}
+}
+
+NSEC3ProofCache::NSEC3ProofCache() : max_entries_(0), entry_count_(0)
+{}
+
+NSEC3ProofCache::~NSEC3ProofCache() {}
+
+void
+NSEC3ProofCache::setMaxEntries(size_t max_entries) {
+    Mutex::Locker locker(mutex_);
+    max_entries_ = max_entries;
+    if (max_entries_ == 0) {
+        zones_.clear();
+        entry_count_ = 0;
+        return;
+    }
+    for (ZoneMap::iterator it = zones_.begin(); it != zones_.end(); ++it) {
+        if (it->second->intervals_.size() > max_entries_) {
+            entry_count_ -= it->second->intervals_.size();
+            it->second->intervals_.clear();
+        }
+    }
+}
+
+size_t
+NSEC3ProofCache::getMaxEntries() const {
+    Mutex::Locker locker(mutex_);
+    return (max_entries_);
+}
+
+size_t
+NSEC3ProofCache::getEntryCount() const {
+    Mutex::Locker locker(mutex_);
+    return (entry_count_);
+}
+
+const NSEC3ProofCache::Interval*
+NSEC3ProofCache::findInterval(const Zone& zone, const std::string& hash) {
+    const IntervalMap& intervals = zone.intervals_;
+    if (intervals.empty()) {
+        return (NULL);
+    }
+
+    // Find the interval starting at or before the hash.  If there's none,
+    // the hash can still be covered by the last one, if it wraps around.
+    IntervalMap::const_iterator it = intervals.upper_bound(hash);
+    if (it == intervals.begin()) {
+        it = intervals.end();
+    }
+    --it;
+    const std::string& owner = it->first;
+    const std::string& next = it->second.next_;
+    const bool wraps = (next <= owner);
+    if (owner == hash) {
+        return (NULL);          // matching, not covering
+    } else if (owner < hash) {
+        return ((wraps || hash < next) ? &it->second : NULL);
+    } else {
+        return ((wraps && hash < next) ? &it->second : NULL);
+    }
+}
+
+bool
+NSEC3ProofCache::lookup(const Name& origin, const RRClass& rrclass,
+                        const Name& qname,
+                        boost::scoped_ptr<NSEC3Hash>& hash, Proof& proof)
+{
+    ZonePtr zone;
+    boost::shared_ptr<const generic::NSEC3> params;
+    const Encloser* encloser = NULL;
+    Proof encloser_proof;
+    unsigned int encloser_labels = 0;
+    {
+        Mutex::Locker locker(mutex_);
+        const ZoneMap::const_iterator found =
+            zones_.find(std::make_pair(rrclass, origin));
+        if (found == zones_.end()) {
+            return (false);
+        }
+        zone = found->second;
+        for (std::vector<Encloser>::const_iterator it =
+                 zone->enclosers_.begin();
+             it != zone->enclosers_.end(); ++it) {
+            const unsigned int labels = it->name_.getLabelCount();
+            if (labels <= encloser_labels) {
+                continue;
+            }
+            if (qname.compare(it->name_).getRelation() ==
+                NameComparisonResult::SUBDOMAIN) {
+                encloser = &*it;
+                encloser_labels = labels;
+            }
+        }
+        if (encloser == NULL) {
+            return (false);
+        }
+        params = zone->params_;
+        encloser_proof.closest_proof = encloser->closest_proof_;
+        encloser_proof.wildcard_proof = encloser->wildcard_proof_;
+    }
+
+    // Calculate the hash of the next closer name without the lock.
+    if (!hash || !hash->match(*params)) {
+        hash.reset(NSEC3Hash::create(*params));
+    }
+    LabelSequence next_closer(qname);
+    next_closer.stripLeft(qname.getLabelCount() - encloser_labels - 1);
+    std::string next_hash = hash->calculate(next_closer);
+    toUpper(next_hash);
+
+    Mutex::Locker locker(mutex_);
+    const Interval* interval = findInterval(*zone, next_hash);
+    if (interval == NULL) {
+        return (false);
+    }
+    proof.closest_proof = encloser_proof.closest_proof;
+    proof.next_proof = interval->rrset_;
+    proof.wildcard_proof = encloser_proof.wildcard_proof;
+    return (true);
+}
+
+void
+NSEC3ProofCache::insert(const Name& origin, const RRClass& rrclass,
+                        const Name& closest_encloser, const Proof& proof)
+{
+    assert(proof.closest_proof && proof.next_proof && proof.wildcard_proof);
+
+    // Extract the NSEC3 parameters and the covering interval before
+    // taking the lock.
+    const boost::shared_ptr<const generic::NSEC3> params =
+        getNSEC3(*proof.closest_proof);
+    const boost::shared_ptr<const generic::NSEC3> next =
+        getNSEC3(*proof.next_proof);
+    if (!params || !next || !getNSEC3(*proof.wildcard_proof)) {
+        return;
+    }
+    const Name& next_owner = proof.next_proof->getName();
+    if (next_owner.getLabelCount() < 2) {
+        return;
+    }
+    std::string owner_hash = next_owner.split(0, 1).toText(true);
+    toUpper(owner_hash);
+    Interval interval;
+    interval.next_ = util::encode::encodeBase32Hex(next->getNext());
+    interval.rrset_ = proof.next_proof;
+
+    Mutex::Locker locker(mutex_);
+    if (max_entries_ == 0) {
+        return;
+    }
+    ZonePtr& zone = zones_[std::make_pair(rrclass, origin)];
+    if (!zone) {
+        zone.reset(new Zone);
+    }
+    if (!zone->params_) {
+        zone->params_ = params;
+    }
+
+    std::vector<Encloser>& enclosers = zone->enclosers_;
+    std::vector<Encloser>::iterator it = enclosers.begin();
+    for (; it != enclosers.end(); ++it) {
+        if (it->name_ == closest_encloser) {
+            *it = Encloser(closest_encloser, proof);
+            break;
+        }
+    }
+    if (it == enclosers.end()) {
+        if (enclosers.size() >= MAX_ENCLOSERS) {
+            enclosers.erase(enclosers.begin());
+        }
+        enclosers.push_back(Encloser(closest_encloser, proof));
+    }
+
+    IntervalMap& intervals = zone->intervals_;
+    const std::pair<IntervalMap::iterator, bool> result =
+        intervals.insert(IntervalMap::value_type(owner_hash, interval));
+    if (!result.second) {
+        result.first->second = interval;
+        return;
+    }
+    ++entry_count_;
+    if (intervals.size() > max_entries_) {
+        // Hashes are effectively random, so the neighbor of the new
+        // interval is as good a victim as any.
+        IntervalMap::iterator victim = result.first;
+        if (++victim == intervals.end()) {
+            victim = intervals.begin();
+        }
+        intervals.erase(victim);
+        --entry_count_;
+    }
+}
+
+void
+NSEC3ProofCache::invalidate(const Name& origin, const RRClass& rrclass) {
+    Mutex::Locker locker(mutex_);
+    ZoneMap::iterator it = zones_.begin();
+    while (it != zones_.end()) {
+        const NameComparisonResult::NameRelation relation =
+            it->first.second.compare(origin).getRelation();
+        if (it->first.first == rrclass &&
+            (relation == NameComparisonResult::EQUAL ||
+             relation == NameComparisonResult::SUBDOMAIN)) {
+            entry_count_ -= it->second->intervals_.size();
+            zones_.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void
+NSEC3ProofCache::clear() {
+    Mutex::Locker locker(mutex_);
+    zones_.clear();
+    entry_count_ = 0;
+}
+
+} // namespace auth
+} // namespace bundy
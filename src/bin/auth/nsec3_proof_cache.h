@@ -0,0 +1,199 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+#ifndef AUTH_NSEC3_PROOF_CACHE_H
+#define AUTH_NSEC3_PROOF_CACHE_H 1
+
+#include <dns/name.h>
+#include <dns/rrclass.h>
+#include <dns/rrset.h>
+#include <util/threads/sync.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bundy {
+namespace dns {
+class NSEC3Hash;
+namespace rdata {
+namespace generic {
+class NSEC3;
+}
+}
+}
+
+namespace auth {
+
+/// \brief A cache of NSEC3 RRsets used for NXDOMAIN proofs.
+///
+/// The proof of a non-existent name in an NSEC3-signed zone (RFC 5155
+/// Section 7.2.2) consists of the NSEC3 matching the closest encloser,
+/// the NSEC3 covering the "next closer" name and the NSEC3 covering the
+/// wildcard at the closest encloser.  Building it needs several hash
+/// calculations and zone searches.  But once a closest encloser is proven,
+/// any query name under it whose next closer name falls in a known covering
+/// interval (between the owner hash and the next hash of an NSEC3) has
+/// the same closest encloser, and its proof can be built from the cached
+/// RRsets with a single hash calculation.  This is typically the case in
+/// random subdomain attacks.
+///
+/// The cache is organized by zone.  For each zone it keeps the proven
+/// closest enclosers (with their matching and wildcard NSEC3 RRsets) and
+/// the covering intervals seen in the proofs.  The number of intervals per
+/// zone is limited; when it's reached, an arbitrary one of them is
+/// removed.  The cache is disabled if the limit is 0, which is the
+/// default.
+///
+/// The cached RRsets refer to the zone data, so the cache must only be
+/// used while the zone data are protected from updates (for bundy-auth,
+/// while the query has a \c DataSrcClientsMgr::Holder), and the zone must
+/// be invalidated by \c invalidate() before the old zone data are
+/// released.
+///
+/// All methods are thread safe.
+class NSEC3ProofCache : boost::noncopyable {
+public:
+    /// \brief The NSEC3 RRsets of a closest encloser proof for NXDOMAIN.
+    struct Proof {
+        /// The NSEC3 matching the closest encloser.
+        dns::ConstRRsetPtr closest_proof;
+        /// The NSEC3 covering the next closer name.
+        dns::ConstRRsetPtr next_proof;
+        /// The NSEC3 covering the wildcard name at the closest encloser.
+        dns::ConstRRsetPtr wildcard_proof;
+    };
+
+    /// \brief Constructor.
+    ///
+    /// The cache is initially disabled.
+    NSEC3ProofCache();
+
+    /// \brief Destructor.
+    ~NSEC3ProofCache();
+
+    /// \brief Set the maximum number of cached intervals per zone.
+    ///
+    /// 0 disables the cache, removing everything.  Otherwise zones that
+    /// have more intervals than the new limit are just cleared.
+    void setMaxEntries(size_t max_entries);
+
+    /// \brief Return the maximum number of cached intervals per zone.
+    size_t getMaxEntries() const;
+
+    /// \brief Return the number of cached intervals of all zones.
+    size_t getEntryCount() const;
+
+    /// \brief Find the NXDOMAIN proof for a query name.
+    ///
+    /// This looks for the deepest cached closest encloser of the zone
+    /// that is a proper superdomain of \c qname, calculates the hash of
+    /// the next closer name and looks for a cached interval covering it.
+    ///
+    /// The hash calculation is done with \c hash, which is owned by the
+    /// caller so that threads don't have to share (or lock) it.  If it's
+    /// NULL or its parameters don't match those of the zone, it's replaced
+    /// with a new one using \c dns::NSEC3Hash::create().
+    ///
+    /// \param origin The origin of the zone.
+    /// \param rrclass The RR class of the zone.
+    /// \param qname The query name, which must be in the zone.
+    /// \param hash The hash calculator as described above.
+    /// \param proof Set to the cached proof if it's found.
+    ///
+    /// \return true if the proof is found; false otherwise.
+    bool lookup(const dns::Name& origin, const dns::RRClass& rrclass,
+                const dns::Name& qname,
+                boost::scoped_ptr<dns::NSEC3Hash>& hash, Proof& proof);
+
+    /// \brief Cache an NXDOMAIN proof.
+    ///
+    /// It's a no-op if the cache is disabled, or if the NSEC3 RRsets of
+    /// the proof don't look valid (this is not a full check; the caller
+    /// should only pass proofs that it has built for a response).
+    ///
+    /// \param origin The origin of the zone.
+    /// \param rrclass The RR class of the zone.
+    /// \param closest_encloser The closest encloser proven by \c proof.
+    /// \param proof The proof, all of whose RRsets must be non NULL.
+    void insert(const dns::Name& origin, const dns::RRClass& rrclass,
+                const dns::Name& closest_encloser, const Proof& proof);
+
+    /// \brief Remove cached proofs of zones at or under the given name.
+    ///
+    /// \param origin The name (normally the origin of an updated zone).
+    /// \param rrclass The RR class of the zones to be removed.
+    void invalidate(const dns::Name& origin, const dns::RRClass& rrclass);
+
+    /// \brief Remove all cached proofs.
+    void clear();
+
+private:
+    // The maximum number of closest enclosers kept per zone.  Floods
+    // normally use a few of them, so a short list that's linearly searched
+    // is enough.
+    static const size_t MAX_ENCLOSERS = 16;
+
+    struct Encloser {
+        Encloser(const dns::Name& name, const Proof& proof) :
+            name_(name), closest_proof_(proof.closest_proof),
+            wildcard_proof_(proof.wildcard_proof)
+        {}
+        dns::Name name_;
+        dns::ConstRRsetPtr closest_proof_;
+        dns::ConstRRsetPtr wildcard_proof_;
+    };
+
+    // A covering interval; the key of IntervalMap is the owner hash.  The
+    // hashes are kept in the upper case base32hex form, which sorts in
+    // the same order as the raw hash values.
+    struct Interval {
+        std::string next_;
+        dns::ConstRRsetPtr rrset_;
+    };
+    typedef std::map<std::string, Interval> IntervalMap;
+
+    // The NSEC3 parameters of the zone are taken from the first cached
+    // proof, as an NSEC3 RDATA.
+    struct Zone {
+        boost::shared_ptr<const dns::rdata::generic::NSEC3> params_;
+        std::vector<Encloser> enclosers_;
+        IntervalMap intervals_;
+    };
+    typedef boost::shared_ptr<Zone> ZonePtr;
+    typedef std::map<std::pair<dns::RRClass, dns::Name>, ZonePtr> ZoneMap;
+
+    // Return the interval covering the given hash, or NULL.  Must be called
+    // with the lock held.
+    static const Interval* findInterval(const Zone& zone,
+                                        const std::string& hash);
+
+    mutable util::thread::Mutex mutex_;
+    size_t max_entries_;
+    size_t entry_count_;
+    ZoneMap zones_;
+};
+
+} // namespace auth
+} // namespace bundy
+
+#endif // AUTH_NSEC3_PROOF_CACHE_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -20,7 +20,9 @@
 
 #include <datasrc/client.h>
 #include <datasrc/client_list.h>
+#include <datasrc/memory/memory_client.h>
 
+#include <auth/nsec3_proof_cache.h>
 #include <auth/query.h>
 
 #include <boost/foreach.hpp>
@@ -36,6 +38,7 @@ using namespace std;
 using namespace bundy::dns;
 using namespace bundy::datasrc;
 using namespace bundy::dns::rdata;
+using bundy::util::MemoryArena;
 
 namespace bundy {
 namespace auth {
@@ -190,8 +193,27 @@ Query::addNSEC3ForName(ZoneFinder& finder, const Name& name, bool match) {
     authorities_.push_back(result.closest_proof);
 }
 
-void
-Query::addNXDOMAINProofByNSEC3(ZoneFinder& finder) {
+bool
+Query::addNXDOMAINProofByNSEC3(ZoneFinder& finder, bool use_proof_cache) {
+    use_proof_cache = use_proof_cache && nsec3_proof_cache_ != NULL;
+    NSEC3ProofCache::Proof proof;
+    if (use_proof_cache &&
+        nsec3_proof_cache_->lookup(finder.getOrigin(), finder.getClass(),
+                                   *qname_, nsec3_hash_, proof)) {
+        authorities_.push_back(proof.closest_proof);
+        authorities_.push_back(proof.next_proof);
+        authorities_.push_back(proof.wildcard_proof);
+        return (true);
+    }
+    if (truncate_nsec3_nxdomain_) {
+        return (false);
+    }
+
+    // The cached proofs are kept over queries, so they mustn't be taken
+    // from the arena of this one.
+    const MemoryArena::Scope heap_scope(use_proof_cache ? NULL :
+                                        MemoryArena::getCurrent());
+
     // Firstly get the NSEC3 proves for Closest Encloser Proof
     // See Section 7.2.1 of RFC 5155.
     const uint8_t closest_labels =
@@ -199,9 +221,23 @@ Query::addNXDOMAINProofByNSEC3(ZoneFinder& finder) {
 
     // Next, construct the wildcard name at the closest encloser, i.e.,
     // '*' followed by the closest encloser, and add NSEC3 for it.
-    const Name wildname(Name("*").concatenate(
-               qname_->split(qname_->getLabelCount() - closest_labels)));
+    const Name closest_encloser(
+        qname_->split(qname_->getLabelCount() - closest_labels));
+    const Name wildname(Name("*").concatenate(closest_encloser));
     addNSEC3ForName(finder, wildname, false);
+
+    // The closest, next closer and wildcard proofs are now the last three
+    // RRsets of the authority section.
+    if (use_proof_cache) {
+        const size_t count = authorities_.size();
+        assert(count >= 3);
+        proof.closest_proof = authorities_[count - 3];
+        proof.next_proof = authorities_[count - 2];
+        proof.wildcard_proof = authorities_[count - 1];
+        nsec3_proof_cache_->insert(finder.getOrigin(), finder.getClass(),
+                                   closest_encloser, proof);
+    }
+    return (true);
 }
 
 void
@@ -349,6 +385,17 @@ Query::process(datasrc::ClientList& client_list,
     // always reset after scope leaves this method
     QueryCleaner cleaner(*this);
 
+    // The in-memory data source creates the RRsets and find contexts from
+    // the arena.  Those of the previous query were held by its response
+    // until it was rendered, so the arena can normally be reused; if
+    // something still holds any of them, it is left to it.
+    if (arena_.unique()) {
+        arena_->reset();
+    } else {
+        arena_.reset(new MemoryArena);
+    }
+    const MemoryArena::Scope arena_scope(arena_.get());
+
     // Set up query parameters for the rest of the (internal) methods
     initialize(client_list, qname, qtype, response, dnssec);
 
@@ -521,7 +568,16 @@ Query::process(datasrc::ClientList& client_list,
                 if (db_context->isNSECSigned() && db_context->rrset) {
                     addNXDOMAINProofByNSEC(zfinder, db_context->rrset);
                 } else if (db_context->isNSEC3Signed()) {
-                    addNXDOMAINProofByNSEC3(zfinder);
+                    // Proofs can be cached only for the in-memory data
+                    // source, whose updates invalidate the cache.
+                    const bool use_proof_cache =
+                        dynamic_cast<const datasrc::memory::InMemoryClient*>(
+                            result.dsrc_client_) != NULL;
+                    if (!addNXDOMAINProofByNSEC3(zfinder, use_proof_cache)) {
+                        // Let the client retry over TCP instead.
+                        authorities_.clear();
+                        response_->setHeaderFlag(Message::HEADERFLAG_TC);
+                    }
                 }
             }
             break;
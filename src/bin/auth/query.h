@@ -15,10 +15,14 @@
  */
 
 #include <exceptions/exceptions.h>
+#include <dns/nsec3hash.h>
 #include <dns/rrset.h>
 #include <datasrc/zone.h>
+#include <util/memory_arena.h>
 
 #include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <functional>
 #include <vector>
@@ -36,6 +40,7 @@ class ClientList;
 }
 
 namespace auth {
+class NSEC3ProofCache;
 
 /// The \c Query class represents a standard DNS query that encapsulates
 /// processing logic to answer the query.
@@ -117,7 +122,16 @@ private:
     /// Add NSEC3 RRs that prove an NXDOMAIN result.
     ///
     /// This corresponds to Section 7.2.2 of RFC 5155.
-    void addNXDOMAINProofByNSEC3(bundy::datasrc::ZoneFinder& finder);
+    ///
+    /// If \c use_proof_cache is true and an \c NSEC3ProofCache is set,
+    /// the proof is taken from the cache if possible, and a newly built
+    /// proof is stored in it.
+    ///
+    /// \return false if the proof wasn't added because it would have to be
+    /// built while NSEC3 NXDOMAIN responses are to be truncated (see
+    /// \c setTruncateNSEC3NXDOMAIN()); true otherwise.
+    bool addNXDOMAINProofByNSEC3(bundy::datasrc::ZoneFinder& finder,
+                                 bool use_proof_cache = false);
 
     /// Add NSEC or NSEC3 RRs that prove a wildcard answer is the best one.
     ///
@@ -281,6 +295,8 @@ public:
     Query() :
         client_list_(NULL), qname_(NULL), qtype_(NULL),
         dnssec_(false), dnssec_opt_(bundy::datasrc::ZoneFinder::FIND_DEFAULT),
+        nsec3_proof_cache_(NULL), truncate_nsec3_nxdomain_(false),
+        arena_(new bundy::util::MemoryArena),
         response_(NULL)
     {
         answers_.reserve(RESERVE_RRSETS);
@@ -292,6 +308,34 @@ public:
     }
 
 
+    /// \brief Set the cache of NSEC3 NXDOMAIN proofs.
+    ///
+    /// If set, NXDOMAIN proofs for NSEC3-signed zones in the in-memory
+    /// cache of data sources are taken from and stored in \c cache (see
+    /// \c NSEC3ProofCache).  The cache can be shared by multiple \c Query
+    /// objects, and must be invalidated whenever a zone is updated.  NULL
+    /// disables it, which is the default.
+    ///
+    /// \param cache The cache, which must be valid as long as this object
+    ///        uses it.
+    void setNSEC3ProofCache(NSEC3ProofCache* cache) {
+        nsec3_proof_cache_ = cache;
+    }
+
+    /// \brief Truncate NSEC3 NXDOMAIN responses instead of building proofs.
+    ///
+    /// If set to true, a DNSSEC NXDOMAIN response from an NSEC3-signed
+    /// zone is only built if its proof can be taken from the
+    /// \c NSEC3ProofCache.  Otherwise the response is left empty with the
+    /// TC bit set, so the client retries over TCP.  Building a proof takes
+    /// several NSEC3 hash calculations, so this is a cheap alternative to
+    /// it, e.g., while the server is overloaded.  It's false by default.
+    ///
+    /// \param truncate Whether to truncate such responses.
+    void setTruncateNSEC3NXDOMAIN(bool truncate) {
+        truncate_nsec3_nxdomain_ = truncate;
+    }
+
     /// Process the query.
     ///
     /// This method first identifies the zone that best matches the query
@@ -486,6 +530,12 @@ private:
     bool dnssec_;
     bundy::datasrc::ZoneFinder::FindOptions dnssec_opt_;
     ResponseCreator response_creator_;
+    NSEC3ProofCache* nsec3_proof_cache_;
+    bool truncate_nsec3_nxdomain_;
+    // The hash calculator for the cached proofs, kept over queries
+    boost::scoped_ptr<bundy::dns::NSEC3Hash> nsec3_hash_;
+    // The memory of the RRsets and contexts found for a query
+    boost::shared_ptr<bundy::util::MemoryArena> arena_;
 
     bundy::dns::Message* response_;
     std::vector<bundy::dns::ConstRRsetPtr> answers_;
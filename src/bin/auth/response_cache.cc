@@ -0,0 +1,244 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <auth/response_cache.h>
+
+#include <dns/message.h>
+#include <dns/question.h>
+#include <dns/rdata.h>
+#include <util/buffer.h>
+
+#include <boost/functional/hash.hpp>
+
+#include <cassert>
+#include <cstring>
+
+using namespace bundy::dns;
+using bundy::util::OutputBuffer;
+using bundy::util::thread::Mutex;
+
+namespace bundy {
+namespace auth {
+
+namespace {
+// Offset and bits of the header flags copied from the query.
+const size_t HEADER_FLAGS_POS = 2;
+const uint16_t RD_BIT = 0x0100;
+const uint16_t CD_BIT = 0x0010;
+
+// The minimum size of a DNS message (the header)
+const size_t HEADER_LEN = 12;
+}
+
+ResponseCache::Entry::Entry(const Message& response, const void* data,
+                            size_t len, const Name& rrl_name,
+                            detail::ResponseType rrl_type,
+                            const boost::optional<Name>& zone) :
+    data_(static_cast<const uint8_t*>(data),
+          static_cast<const uint8_t*>(data) + len),
+    rcode_(response.getRcode()),
+    authoritative_(response.getHeaderFlag(Message::HEADERFLAG_AA)),
+    rrl_name_(rrl_name), rrl_type_(rrl_type), zone_(zone)
+{
+    if (len < HEADER_LEN) {
+        bundy_throw(InvalidParameter, "Response to cache is too short: " <<
+                    len);
+    }
+    if (response.getRRCount(Message::SECTION_ANSWER) > 0) {
+        const ConstRRsetPtr rrset =
+            *response.beginSection(Message::SECTION_ANSWER);
+        answer_summary_.reset(new RRset(rrset->getName(), rrset->getClass(),
+                                        rrset->getType(), rrset->getTTL()));
+        if (rrset->getRdataCount() > 0) {
+            answer_summary_->addRdata(rrset->getRdataIterator()->
+                                      getCurrent());
+        }
+    }
+}
+
+void
+ResponseCache::Entry::render(OutputBuffer& buffer, uint16_t qid, bool rd,
+                             bool cd) const
+{
+    const size_t start = buffer.getLength();
+    buffer.writeData(&data_[0], data_.size());
+    buffer.writeUint16At(qid, start);
+    uint16_t flags = (data_[HEADER_FLAGS_POS] << 8) |
+        data_[HEADER_FLAGS_POS + 1];
+    flags &= ~(RD_BIT | CD_BIT);
+    if (rd) {
+        flags |= RD_BIT;
+    }
+    if (cd) {
+        flags |= CD_BIT;
+    }
+    buffer.writeUint16At(flags, start + HEADER_FLAGS_POS);
+}
+
+ResponseCache::ResponseCache() : max_entries_(0), generation_(0)
+{}
+
+void
+ResponseCache::setMaxEntries(size_t max_entries) {
+    Mutex::Locker locker(mutex_);
+    shrink(max_entries);
+    max_entries_ = max_entries;
+}
+
+size_t
+ResponseCache::getMaxEntries() const {
+    Mutex::Locker locker(mutex_);
+    return (max_entries_);
+}
+
+size_t
+ResponseCache::getEntryCount() const {
+    Mutex::Locker locker(mutex_);
+    return (entries_.size());
+}
+
+uint64_t
+ResponseCache::getGeneration() const {
+    Mutex::Locker locker(mutex_);
+    return (generation_);
+}
+
+size_t
+ResponseCache::KeyHash::operator()(const std::string& key) const {
+    return (boost::hash_range(key.begin(), key.end()));
+}
+
+size_t
+ResponseCache::KeyHash::operator()(const KeyRef& key) const {
+    return (boost::hash_range(key.data_, key.data_ + key.len_));
+}
+
+bool
+ResponseCache::KeyEqual::operator()(const KeyRef& key1,
+                                    const std::string& key2) const
+{
+    return (key1.len_ == key2.size() &&
+            std::memcmp(key1.data_, key2.data(), key1.len_) == 0);
+}
+
+size_t
+ResponseCache::makeKey(const LabelSequence& qname, const RRType& qtype,
+                       const RRClass& qclass, bool edns, bool dnssec_ok,
+                       char key[MAX_KEY_LEN])
+{
+    size_t name_len;
+    const uint8_t* const name_data = qname.getData(&name_len);
+    std::memcpy(key, name_data, name_len);
+    char* cp = key + name_len;
+    *cp++ = qtype.getCode() >> 8;
+    *cp++ = qtype.getCode() & 0xff;
+    *cp++ = qclass.getCode() >> 8;
+    *cp++ = qclass.getCode() & 0xff;
+    *cp++ = (edns ? 1 : 0) | (dnssec_ok ? 2 : 0);
+    return (cp - key);
+}
+
+ResponseCache::ConstEntryPtr
+ResponseCache::lookup(const Question& question, bool edns, bool dnssec_ok) {
+    return (lookup(LabelSequence(question.getName()), question.getType(),
+                   question.getClass(), edns, dnssec_ok));
+}
+
+ResponseCache::ConstEntryPtr
+ResponseCache::lookup(const LabelSequence& qname, const RRType& qtype,
+                      const RRClass& qclass, bool edns, bool dnssec_ok)
+{
+    char key[MAX_KEY_LEN];
+    const KeyRef key_ref = { key, makeKey(qname, qtype, qclass, edns,
+                                          dnssec_ok, key) };
+
+    Mutex::Locker locker(mutex_);
+    if (max_entries_ == 0) {
+        return (ConstEntryPtr());
+    }
+    const EntryMap::iterator found =
+        entries_.find(key_ref, KeyHash(), KeyEqual());
+    if (found == entries_.end()) {
+        return (ConstEntryPtr());
+    }
+    // Move it to the most recently used position.
+    lru_.splice(lru_.end(), lru_, found->second);
+    return (found->second->entry_);
+}
+
+bool
+ResponseCache::insert(uint64_t generation, const Question& question,
+                      bool edns, bool dnssec_ok, const ConstEntryPtr& entry)
+{
+    char key_buf[MAX_KEY_LEN];
+    const std::string key(key_buf,
+                          makeKey(LabelSequence(question.getName()),
+                                  question.getType(), question.getClass(),
+                                  edns, dnssec_ok, key_buf));
+
+    Mutex::Locker locker(mutex_);
+    if (max_entries_ == 0 || generation != generation_) {
+        return (false);
+    }
+    const EntryMap::iterator found = entries_.find(key);
+    if (found != entries_.end()) {
+        lru_.erase(found->second);
+        entries_.erase(found);
+    } else {
+        shrink(max_entries_ - 1);
+    }
+    lru_.push_back(LRUElement(key, question.getName(), question.getClass(),
+                              entry));
+    entries_.insert(EntryMap::value_type(key, --lru_.end()));
+    return (true);
+}
+
+void
+ResponseCache::invalidate(const Name& origin, const RRClass& rrclass) {
+    Mutex::Locker locker(mutex_);
+    ++generation_;
+    LRUList::iterator it = lru_.begin();
+    while (it != lru_.end()) {
+        const NameComparisonResult::NameRelation relation =
+            it->qname_.compare(origin).getRelation();
+        if (it->qclass_ == rrclass &&
+            (relation == NameComparisonResult::EQUAL ||
+             relation == NameComparisonResult::SUBDOMAIN)) {
+            entries_.erase(it->key_);
+            it = lru_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void
+ResponseCache::clear() {
+    Mutex::Locker locker(mutex_);
+    ++generation_;
+    entries_.clear();
+    lru_.clear();
+}
+
+void
+ResponseCache::shrink(size_t max_entries) {
+    while (entries_.size() > max_entries) {
+        assert(!lru_.empty());
+        entries_.erase(lru_.front().key_);
+        lru_.pop_front();
+    }
+}
+
+} // namespace auth
+} // namespace bundy
@@ -0,0 +1,276 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef AUTH_RESPONSE_CACHE_H
+#define AUTH_RESPONSE_CACHE_H 1
+
+#include <auth/rrl_response_type.h>
+
+#include <exceptions/exceptions.h>
+#include <dns/labelsequence.h>
+#include <dns/name.h>
+#include <dns/rcode.h>
+#include <dns/rrclass.h>
+#include <dns/rrset.h>
+#include <dns/rrtype.h>
+#include <util/threads/sync.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace dns {
+class Message;
+class Question;
+}
+namespace util {
+class OutputBuffer;
+}
+
+namespace auth {
+
+/// \brief A cache of rendered responses to normal queries.
+///
+/// This class keeps the wire-format data of responses built for queries,
+/// so the response to a repeated query can be sent without looking up
+/// the data sources and rendering the message again.  The cache key is
+/// the question section (the query name is compared as is, so the case
+/// of the name is preserved in cached responses) and whether the query
+/// has EDNS and the DO bit.  The query ID and the RD and CD bits of
+/// the cached data are replaced with those of the query when it's
+/// copied for a response.
+///
+/// Responses of a zone must be invalidated when the zone data is
+/// replaced; \c invalidate() removes all responses for the names at or
+/// under the given name.  In order not to cache a response built from
+/// the old data after that, insertion is only allowed if nothing has been
+/// invalidated since the corresponding lookup (see \c getGeneration()).
+///
+/// When the cache is full, the least recently used response is removed.
+/// The cache is disabled if the maximum number of entries is 0, which is
+/// the default.
+///
+/// All methods are thread safe.
+class ResponseCache : boost::noncopyable {
+public:
+    /// \brief A cached response.
+    ///
+    /// This object is immutable once created, so it can be used without
+    /// holding a lock on the cache.
+    class Entry : boost::noncopyable {
+    public:
+        /// \brief Constructor.
+        ///
+        /// \param response The response message, used to get a summary
+        ///        of it (see \c getAnswerSummary()).
+        /// \param data The rendered response.
+        /// \param len The length of \c data.
+        /// \param rrl_name The name to identify the response for response
+        ///        rate limiting.
+        /// \param rrl_type The type of the response for response rate
+        ///        limiting.
+        /// \param zone The origin of the zone the response comes from, if
+        ///        it's needed for the statistics.
+        Entry(const dns::Message& response, const void* data, size_t len,
+              const dns::Name& rrl_name, detail::ResponseType rrl_type,
+              const boost::optional<dns::Name>& zone =
+              boost::optional<dns::Name>());
+
+        /// \brief Return the length of the rendered response.
+        size_t getLength() const { return (data_.size()); }
+
+        /// \brief Copy the response to a buffer, with the ID and the RD
+        /// and CD bits set to the given values.
+        void render(util::OutputBuffer& buffer, uint16_t qid, bool rd,
+                    bool cd) const;
+
+        /// \brief Return the RCODE of the response.
+        const dns::Rcode& getRcode() const { return (rcode_); }
+
+        /// \brief Return whether the AA bit of the response is set.
+        bool isAuthoritative() const { return (authoritative_); }
+
+        /// \brief Return a copy of (part of) the first answer RRset, or
+        /// NULL if the answer section is empty.
+        ///
+        /// It's provided so that the statistics counters can see a
+        /// response that looks like the cached one without keeping the
+        /// whole message.
+        dns::RRsetPtr getAnswerSummary() const { return (answer_summary_); }
+
+        /// \brief Return the name to identify the response for response
+        /// rate limiting.
+        const dns::Name& getRRLName() const { return (rrl_name_); }
+
+        /// \brief Return the type of the response for response rate
+        /// limiting.
+        detail::ResponseType getRRLType() const { return (rrl_type_); }
+
+        /// \brief Return the origin of the zone the response comes from,
+        /// if it was given on construction.
+        const boost::optional<dns::Name>& getZone() const { return (zone_); }
+
+    private:
+        const std::vector<uint8_t> data_;
+        const dns::Rcode rcode_;
+        const bool authoritative_;
+        const dns::Name rrl_name_;
+        const detail::ResponseType rrl_type_;
+        const boost::optional<dns::Name> zone_;
+        dns::RRsetPtr answer_summary_;
+    };
+
+    typedef boost::shared_ptr<const Entry> ConstEntryPtr;
+
+    /// \brief Constructor.
+    ///
+    /// The cache is initially disabled.
+    ResponseCache();
+
+    /// \brief Set the maximum number of cached responses.
+    ///
+    /// If the new size is smaller than the number of cached responses,
+    /// the least recently used ones are removed.  0 disables the cache,
+    /// removing everything.
+    void setMaxEntries(size_t max_entries);
+
+    /// \brief Return the maximum number of cached responses.
+    size_t getMaxEntries() const;
+
+    /// \brief Return the number of cached responses.
+    size_t getEntryCount() const;
+
+    /// \brief Return the current generation of the cache.
+    ///
+    /// It's incremented every time responses are invalidated.  The caller
+    /// is expected to get it before looking up the data sources, and to
+    /// pass it to \c insert().
+    uint64_t getGeneration() const;
+
+    /// \brief Find the cached response to a query.
+    ///
+    /// \param question The question of the query.
+    /// \param edns Whether the query has EDNS.
+    /// \param dnssec_ok Whether the query has the DO bit.
+    ///
+    /// \return The cached response, or NULL if it's not found.
+    ConstEntryPtr lookup(const dns::Question& question, bool edns,
+                         bool dnssec_ok);
+
+    /// \brief Find the cached response to a query, given the query
+    /// parameters separately.
+    ///
+    /// This is the same as the other version, but doesn't require a
+    /// \c Question object, and doesn't allocate memory by itself.
+    ///
+    /// \param qname The query name.
+    /// \param qtype The query type.
+    /// \param qclass The query class.
+    /// \param edns Whether the query has EDNS.
+    /// \param dnssec_ok Whether the query has the DO bit.
+    ///
+    /// \return The cached response, or NULL if it's not found.
+    ConstEntryPtr lookup(const dns::LabelSequence& qname,
+                         const dns::RRType& qtype, const dns::RRClass& qclass,
+                         bool edns, bool dnssec_ok);
+
+    /// \brief Cache a response.
+    ///
+    /// It's a no-op (returning false) if the cache is disabled or any
+    /// response has been invalidated since the given generation.  An
+    /// existing response for the same key is replaced.
+    ///
+    /// \param generation The generation returned by \c getGeneration()
+    ///        before the response was built.
+    /// \param question The question of the query.
+    /// \param edns Whether the query has EDNS.
+    /// \param dnssec_ok Whether the query has the DO bit.
+    /// \param entry The response to be cached.
+    ///
+    /// \return true if the response is cached; false otherwise.
+    bool insert(uint64_t generation, const dns::Question& question,
+                bool edns, bool dnssec_ok, const ConstEntryPtr& entry);
+
+    /// \brief Remove cached responses for names at or under the given name.
+    ///
+    /// \param origin The name (normally the origin of an updated zone).
+    /// \param rrclass The RR class of the responses to be removed.
+    void invalidate(const dns::Name& origin, const dns::RRClass& rrclass);
+
+    /// \brief Remove all cached responses.
+    void clear();
+
+private:
+    // The list is ordered from the least recently used.  The query name
+    // and class are kept for invalidate().
+    struct LRUElement {
+        LRUElement(const std::string& key, const dns::Name& qname,
+                   const dns::RRClass& qclass, const ConstEntryPtr& entry) :
+            key_(key), qname_(qname), qclass_(qclass), entry_(entry)
+        {}
+        std::string key_;
+        dns::Name qname_;
+        dns::RRClass qclass_;
+        ConstEntryPtr entry_;
+    };
+    typedef std::list<LRUElement> LRUList;
+
+    // The key is the query name in wire format, type, class and the EDNS
+    // flags.  It's built in a fixed size buffer for lookups, so they can
+    // be done without constructing a string.
+    static const size_t MAX_KEY_LEN = dns::Name::MAX_WIRE + 5;
+    struct KeyRef {
+        const char* data_;
+        size_t len_;
+    };
+    struct KeyHash {
+        size_t operator()(const std::string& key) const;
+        size_t operator()(const KeyRef& key) const;
+    };
+    struct KeyEqual {
+        bool operator()(const KeyRef& key1, const std::string& key2) const;
+    };
+    typedef boost::unordered_map<std::string, LRUList::iterator, KeyHash>
+    EntryMap;
+
+    static size_t makeKey(const dns::LabelSequence& qname,
+                          const dns::RRType& qtype, const dns::RRClass& qclass,
+                          bool edns, bool dnssec_ok, char key[MAX_KEY_LEN]);
+    // Remove the least recently used entries so the cache has at most the
+    // given number of them.  Must be called with the lock held.
+    void shrink(size_t max_entries);
+
+    mutable util::thread::Mutex mutex_;
+    size_t max_entries_;
+    uint64_t generation_;
+    LRUList lru_;
+    EntryMap entries_;
+};
+
+} // namespace auth
+} // namespace bundy
+
+#endif // AUTH_RESPONSE_CACHE_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -18,14 +18,22 @@
 #include <cc/data.h>
 
 #include <dns/message.h>
+#include <dns/name.h>
 #include <dns/opcode.h>
 
-#include <statistics/counter.h>
+#include <statistics/histogram.h>
+#include <statistics/sharded_counter.h>
+
+#include <util/threads/rcu.h>
 
 #include <boost/noncopyable.hpp>
 #include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
 
+#include <atomic>
 #include <bitset>
+#include <map>
+#include <string>
 
 #include <stdint.h>
 
@@ -39,6 +47,13 @@ namespace bundy {
 namespace auth {
 namespace statistics {
 
+/// \brief Return the current time of a monotonic clock in microseconds.
+///
+/// It's used to measure the time it takes to answer a request.
+///
+/// \throw None
+uint64_t getMonotonicTime();
+
 /// \brief DNS Message attributes for statistics.
 ///
 /// This class holds some attributes related to a DNS message
@@ -63,6 +78,8 @@ private:
     int req_address_family_;        // IP version
     int req_transport_protocol_;    // Transport layer protocol
     boost::optional<bundy::dns::Opcode> req_opcode_;  // OpCode
+    uint64_t req_time_;             // Time of receipt (0 if not set)
+    boost::optional<bundy::dns::Name> zone_;  // Zone answering the request
     enum BitAttributes {
         REQ_WITH_EDNS_0,            // request with EDNS ver.0
         REQ_WITH_DNSSEC_OK,         // DNSSEC OK (DO) bit is set in request
@@ -79,9 +96,48 @@ public:
     /// \brief The constructor.
     ///
     /// \throw None
-    MessageAttributes() : req_address_family_(0), req_transport_protocol_(0)
+    MessageAttributes() :
+        req_address_family_(0), req_transport_protocol_(0), req_time_(0)
     {}
 
+    /// \brief Return the time the request was received.
+    ///
+    /// \return time in microseconds as returned by \c getMonotonicTime(),
+    ///         or 0 if it hasn't been set.
+    /// \throw None
+    uint64_t getRequestTime() const {
+        return (req_time_);
+    }
+
+    /// \brief Set the time the request was received.
+    ///
+    /// \param time time in microseconds as returned by
+    ///        \c getMonotonicTime()
+    /// \throw None
+    void setRequestTime(const uint64_t time) {
+        req_time_ = time;
+    }
+
+    /// \brief Return the origin of the zone the request was answered from.
+    ///
+    /// \return the zone origin wrapped with boost::optional; it's converted
+    ///         to false if the zone hasn't been set.
+    /// \throw None
+    const boost::optional<bundy::dns::Name>& getZone() const {
+        return (zone_);
+    }
+
+    /// \brief Set the origin of the zone the request was answered from.
+    ///
+    /// It's only needed for per-zone counters (see
+    /// \c Counters::setZoneCounters()).
+    ///
+    /// \param zone origin of the zone
+    /// \throw None
+    void setZone(const bundy::dns::Name& zone) {
+        zone_ = zone;
+    }
+
     /// \brief Return opcode of the request.
     ///
     /// \return opcode of the request wrapped with boost::optional; it's
@@ -270,15 +326,38 @@ public:
 /// This class is constructed on startup of the server, so
 /// construction overhead of this approach should be acceptable.
 ///
-/// \todo Consider overhead of \c Counters::inc()
+/// \c inc() and \c get() can be called from multiple threads without
+/// locking; each thread increments its own shard of the counters (see
+/// \c bundy::statistics::ShardedCounter).
+///
+/// Besides the server wide counters, it keeps histograms of the time from
+/// receiving a request to sending the response, one for each transport,
+/// and optionally the message counters for each zone (see
+/// \c setZoneCounters()).
 class Counters : boost::noncopyable {
 private:
+    typedef boost::shared_ptr<bundy::statistics::ShardedCounter>
+        ShardedCounterPtr;
+    typedef std::map<bundy::dns::Name, ShardedCounterPtr> ZoneCounterMap;
+
     // counter for DNS message attributes
-    bundy::statistics::Counter server_msg_counter_;
-    void incRequest(const MessageAttributes& msgattrs);
-    void incResponse(const MessageAttributes& msgattrs,
-                     const bundy::dns::Message& response);
+    bundy::statistics::ShardedCounter server_msg_counter_;
+    // response latencies in microseconds
+    bundy::statistics::Histogram udp_latency_;
+    bundy::statistics::Histogram tcp_latency_;
+    // per-zone counters; the map is only modified within an exclusive
+    // section of the RCU, so the increments don't have to lock.
+    mutable bundy::util::thread::RCU zone_rcu_;
+    ZoneCounterMap zone_counters_;
+    std::atomic<size_t> max_zones_;
+    void incZone(const MessageAttributes& msgattrs,
+                 const bundy::dns::Message& response, const bool done);
+    void incLatency(const MessageAttributes& msgattrs);
 public:
+    /// \brief The number of bits of the largest latency (in microseconds)
+    /// told from bigger ones in the histograms, about 67 seconds.
+    static const unsigned int LATENCY_BITS = 26;
+
     /// \brief A type of statistics item tree in bundy::data::MapElement.
     /// \verbatim
     ///        {
@@ -308,16 +387,87 @@ public:
     void inc(const MessageAttributes& msgattrs,
              const bundy::dns::Message& response, const bool done);
 
+    /// \brief Enable or disable the counters for each zone.
+    ///
+    /// The counters of a zone are created when the first request for it
+    /// is counted.  Once \a max_zones zones have counters, the requests
+    /// for other zones are only counted in the server wide counters, so
+    /// the memory used is bounded.  Any existing zone counters are
+    /// dropped.
+    ///
+    /// \param max_zones The maximum number of zones to count, 0 to disable
+    ///        them.
+    /// \throw bundy::InvalidOperation an error on the internal lock.
+    void setZoneCounters(const size_t max_zones);
+
+    /// \brief Return the maximum number of zones to count.
+    ///
+    /// \throw None
+    size_t getZoneCounters() const {
+        return (max_zones_.load(std::memory_order_relaxed));
+    }
+
     /// \brief Get statistics counters.
     ///
     /// This method is mostly exception free. But it may still throw a
     /// standard exception if memory allocation fails inside the method.
     ///
+    /// The tree also has a "latency" item, which is a map of the
+    /// transports ("udp" and "tcp") to the counts of the buckets of their
+    /// histograms (see \c bundy::statistics::Histogram).
+    ///
     /// \return statistics data
     /// \throw std::bad_alloc Internal resource allocation fails
     ConstItemTreePtr get() const;
 };
 
+/// \brief Reports the statistics items changed since the previous report.
+///
+/// Sending the whole item tree each time the stats daemon polls the
+/// servers makes a lot of traffic when there are many of them, while most
+/// of the items don't change between two polls.  The reporter remembers
+/// the tree it reported last, and only reports the items which changed
+/// since then, provided the stats daemon has received that report.
+///
+/// A report is the item tree restricted to the changed items, with a
+/// "_report" map holding the "id" of the server (its process ID), the
+/// "serial" number of the report and the "base" serial of the report it
+/// is relative to, 0 if it holds the whole tree.  The stats daemon passes
+/// the serial of the last report it received from each server in the
+/// "since" map of the "getstats" command, keyed by the ID of the server.
+/// The whole tree is reported if it isn't the serial of the last report
+/// (for example, because a reply was lost or the stats daemon restarted),
+/// or if an item was removed since then.
+///
+/// It is meant to be used by the thread handling the commands only.
+class ChangeReporter : boost::noncopyable {
+public:
+    /// \brief The constructor.
+    ChangeReporter();
+
+    /// \brief Return the report of an item tree.
+    ///
+    /// \param tree The current item tree.
+    /// \param args The arguments of the "getstats" command, may be NULL.
+    /// \return The report.
+    /// \throw std::bad_alloc Internal resource allocation fails
+    bundy::data::ConstElementPtr
+    getReport(const bundy::data::ConstElementPtr& tree,
+              const bundy::data::ConstElementPtr& args);
+
+    /// \brief Return the ID of the server in the reports.
+    ///
+    /// \throw None
+    const std::string& getId() const {
+        return (id_);
+    }
+
+private:
+    const std::string id_;
+    int64_t serial_;
+    bundy::data::ConstElementPtr last_;
+};
+
 } // namespace statistics
 } // namespace auth
 } // namespace bundy
@@ -38,6 +38,9 @@
 #include <auth/statistics.h>
 #include <auth/statistics_items.h>
 #include <auth/datasrc_config.h>
+#include <auth/rrl.h>
+
+#include <log/binary_log.h>
 
 #include <config/tests/fake_session.h>
 #include <config/ccsession.h>
@@ -60,11 +63,15 @@
 #include <boost/scoped_ptr.hpp>
 #include <boost/foreach.hpp>
 
+#include <cstring>
+#include <ctime>
+#include <set>
 #include <vector>
 
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netdb.h>
+#include <unistd.h>
 
 using namespace std;
 using namespace bundy::cc;
@@ -331,6 +338,53 @@ TEST_F(AuthSrvTest, noClientList) {
     checkStatisticsCounters(stats_after, expect);
 }
 
+// The statistics report only holds the counters changed since the last
+// report the stats daemon received.
+TEST_F(AuthSrvTest, statisticsReport) {
+    ConstElementPtr report =
+        server.getStatisticsReport(Element::fromJSON("{\"since\": {}}"));
+    const std::string id =
+        report->get("_report")->get("id")->stringValue();
+    EXPECT_EQ(0, report->get("_report")->get("base")->intValue());
+    EXPECT_TRUE(report->contains("latency"));
+    EXPECT_TRUE(report->contains("memory"));
+
+    UnitTestUtil::createRequestMessage(request_message, Opcode::QUERY(),
+                                       default_qid, Name("version.bind"),
+                                       RRClass::CH(), RRType::TXT());
+    createRequestPacket(request_message, IPPROTO_UDP);
+    server.processMessage(*io_message, *parse_message, *response_obuffer,
+                          &dnsserv);
+
+    report = server.getStatisticsReport(
+        Element::fromJSON("{\"since\": {\"" + id + "\": 1}}"));
+    EXPECT_EQ(1, report->get("_report")->get("base")->intValue());
+    ConstElementPtr changes = report->get("zones")->get("_SERVER_");
+    EXPECT_EQ(1, changes->get("request.v4")->intValue());
+    EXPECT_EQ(1, changes->get("rcode.refused")->intValue());
+    EXPECT_FALSE(changes->contains("request.v6"));
+}
+
+// The memory used by the cached zones is reported by zone name in the
+// statistics, and by class and data source by getZoneMemoryUsage().
+TEST_F(AuthSrvTest, zoneMemoryUsage) {
+    EXPECT_EQ(0, server.getZoneMemoryUsage()->size());
+    EXPECT_EQ(0, server.getStatistics()->get("memory")->size());
+
+    updateInMemory(server, "example.", CONFIG_INMEMORY_EXAMPLE);
+    const ConstElementPtr usage = server.getZoneMemoryUsage();
+    EXPECT_EQ(2, usage->size());
+    const ConstElementPtr zone = usage->get("IN")->get("MasterFiles")->
+        get("example.");
+    ASSERT_TRUE(zone);
+    EXPECT_LT(0, zone->get("total")->intValue());
+    EXPECT_TRUE(usage->get("CH")->get("MasterFiles")->contains("BIND."));
+
+    const ConstElementPtr memory = server.getStatistics()->get("memory");
+    EXPECT_EQ(2, memory->size());
+    EXPECT_TRUE(zone->equals(*memory->get("example.")));
+}
+
 // Unsupported requests.  Should result in NOTIMP.
 TEST_F(AuthSrvTest, unsupportedRequest) {
     unsupportedRequest();
@@ -731,6 +785,12 @@ TEST_F(AuthSrvTest, notify) {
     EXPECT_EQ(DEFAULT_REMOTE_ADDRESS,
               notify_args->get("master")->stringValue());
     EXPECT_EQ("IN", notify_args->get("zone_class")->stringValue());
+    EXPECT_TRUE(notify_session.wasAnswerWanted());
+
+    // The answer is read asynchronously; the server shouldn't wait for it
+    // to respond to the notify.
+    EXPECT_TRUE(notify_session.isReading());
+    EXPECT_NO_THROW(notify_session.deliverMessage());
 
     // On success, the server should return a response to the notify.
     headerCheck(*parse_message, default_qid, Rcode::NOERROR(),
@@ -882,14 +942,16 @@ TEST_F(AuthSrvTest, notifyWithoutRecipient) {
     request_message.setHeaderFlag(Message::HEADERFLAG_AA);
     createRequestPacket(request_message, IPPROTO_UDP);
 
-    // we simply ignore the notify and let it be resent if an internal error
-    // happens.
+    // The notify is answered once it's forwarded; the failure only shows up
+    // in the answer from msgq, which is simply logged.
     server.processMessage(*io_message, *parse_message, *response_obuffer,
                           &dnsserv);
     // want_answer should have been set to true so auth can catch it if zonemgr
     // is not running.
     EXPECT_TRUE(notify_session.wasAnswerWanted());
-    EXPECT_FALSE(dnsserv.hasAnswer());
+    EXPECT_TRUE(dnsserv.hasAnswer());
+    EXPECT_NO_THROW(notify_session.deliverMessage());
+    EXPECT_FALSE(notify_session.isReading());
 }
 
 TEST_F(AuthSrvTest, notifySendFail) {
@@ -903,55 +965,96 @@ TEST_F(AuthSrvTest, notifySendFail) {
     request_message.setHeaderFlag(Message::HEADERFLAG_AA);
     createRequestPacket(request_message, IPPROTO_UDP);
 
+    // If the notify can't even be sent, we ignore it and let it be resent.
     server.processMessage(*io_message, *parse_message, *response_obuffer,
                           &dnsserv);
     EXPECT_FALSE(dnsserv.hasAnswer());
+    EXPECT_FALSE(notify_session.isReading());
 }
 
-TEST_F(AuthSrvTest, notifyReceiveFail) {
+// Errors in the answer from Zonemgr are only logged, and don't prevent
+// further notifies from being forwarded.
+TEST_F(AuthSrvTest, notifyAnswerErrors) {
     updateInMemory(server, "example.", CONFIG_INMEMORY_EXAMPLE, false);
 
-    notify_session.disableReceive();
-
-    UnitTestUtil::createRequestMessage(request_message, Opcode::NOTIFY(),
-                                       default_qid, Name("example"),
-                                       RRClass::IN(), RRType::SOA());
-    request_message.setHeaderFlag(Message::HEADERFLAG_AA);
-    createRequestPacket(request_message, IPPROTO_UDP);
-    server.processMessage(*io_message, *parse_message, *response_obuffer,
-                          &dnsserv);
-    EXPECT_FALSE(dnsserv.hasAnswer());
+    for (int i = 0; i < 3; ++i) {
+        switch (i) {
+        case 0:
+            notify_session.setMessage(Element::fromJSON("{\"foo\": 1}"));
+            break;
+        case 1:
+            notify_session.setMessage(
+                Element::fromJSON("{\"result\": [1, \"FAIL\"]}"));
+            break;
+        case 2:
+            notify_session.disableReceive();
+            break;
+        }
+        UnitTestUtil::createRequestMessage(request_message, Opcode::NOTIFY(),
+                                           default_qid, Name("example"),
+                                           RRClass::IN(), RRType::SOA());
+        request_message.setHeaderFlag(Message::HEADERFLAG_AA);
+        request_renderer.clear();
+        parse_message->clear(Message::PARSE);
+        createRequestPacket(request_message, IPPROTO_UDP);
+        server.processMessage(*io_message, *parse_message, *response_obuffer,
+                              &dnsserv);
+        EXPECT_TRUE(dnsserv.hasAnswer());
+        ASSERT_TRUE(notify_session.isReading());
+        EXPECT_NO_THROW(notify_session.deliverMessage());
+        EXPECT_FALSE(notify_session.isReading());
+    }
 }
 
-TEST_F(AuthSrvTest, notifyWithBogusSessionMessage) {
-    updateInMemory(server, "example.", CONFIG_INMEMORY_EXAMPLE, false);
-
-    notify_session.setMessage(Element::fromJSON("{\"foo\": 1}"));
-
-    UnitTestUtil::createRequestMessage(request_message, Opcode::NOTIFY(),
-                                       default_qid, Name("example"),
-                                       RRClass::IN(), RRType::SOA());
-    request_message.setHeaderFlag(Message::HEADERFLAG_AA);
-    createRequestPacket(request_message, IPPROTO_UDP);
-    server.processMessage(*io_message, *parse_message, *response_obuffer,
-                          &dnsserv);
-    EXPECT_FALSE(dnsserv.hasAnswer());
-}
+// Notifies received while waiting for the answer from Zonemgr are queued
+// and sent together.
+TEST_F(AuthSrvTest, notifyBatch) {
+    updateInMemory(server, "example.", CONFIG_INMEMORY_EXAMPLE);
 
-TEST_F(AuthSrvTest, notifyWithSessionMessageError) {
-    updateInMemory(server, "example.", CONFIG_INMEMORY_EXAMPLE, false);
+    const Name zones[] = { Name("example"), Name("bind"), Name("example") };
+    const RRClass classes[] = { RRClass::IN(), RRClass::CH(), RRClass::IN() };
+    for (int i = 0; i < 3; ++i) {
+        UnitTestUtil::createRequestMessage(request_message, Opcode::NOTIFY(),
+                                           default_qid, zones[i], classes[i],
+                                           RRType::SOA());
+        request_message.setHeaderFlag(Message::HEADERFLAG_AA);
+        request_renderer.clear();
+        parse_message->clear(Message::PARSE);
+        createRequestPacket(request_message, IPPROTO_UDP);
+        server.processMessage(*io_message, *parse_message, *response_obuffer,
+                              &dnsserv);
+        EXPECT_TRUE(dnsserv.hasAnswer());
+        // Only the first one is sent at once.
+        EXPECT_EQ("notify",
+                  notify_session.getSentMessage()->get("command")->get(0)->
+                      stringValue());
+        EXPECT_EQ("example.", notify_session.getSentMessage()->
+                  get("command")->get(1)->get("zone_name")->stringValue());
+    }
 
-    notify_session.setMessage(
-        Element::fromJSON("{\"result\": [1, \"FAIL\"]}"));
+    // Once the answer arrives, the queued ones are sent, each zone once.
+    notify_session.deliverMessage();
+    EXPECT_TRUE(notify_session.isReading());
+    EXPECT_EQ("Zonemgr", notify_session.getMessageDest());
+    EXPECT_EQ("notify_batch",
+              notify_session.getSentMessage()->get("command")->get(0)->
+                  stringValue());
+    const ConstElementPtr notifies = notify_session.getSentMessage()->
+        get("command")->get(1)->get("notifies");
+    ASSERT_EQ(2, notifies->size());
+    std::set<std::string> sent;
+    for (size_t i = 0; i < notifies->size(); ++i) {
+        EXPECT_EQ(DEFAULT_REMOTE_ADDRESS,
+                  notifies->get(i)->get("master")->stringValue());
+        sent.insert(notifies->get(i)->get("zone_name")->stringValue() + "/" +
+                    notifies->get(i)->get("zone_class")->stringValue());
+    }
+    EXPECT_EQ(1, sent.count("example./IN"));
+    EXPECT_EQ(1, sent.count("bind./CH"));
 
-    UnitTestUtil::createRequestMessage(request_message, Opcode::NOTIFY(),
-                                       default_qid, Name("example"),
-                                       RRClass::IN(), RRType::SOA());
-    request_message.setHeaderFlag(Message::HEADERFLAG_AA);
-    createRequestPacket(request_message, IPPROTO_UDP);
-    server.processMessage(*io_message, *parse_message, *response_obuffer,
-                          &dnsserv);
-    EXPECT_FALSE(dnsserv.hasAnswer());
+    // Nothing more to send after that.
+    notify_session.deliverMessage();
+    EXPECT_FALSE(notify_session.isReading());
 }
 
 TEST_F(AuthSrvTest, notifyNotAuth) {
@@ -1102,6 +1205,42 @@ TEST_F(AuthSrvTest, builtInQuery) {
     checkAllRcodeCountersZeroExcept(Rcode::NOERROR(), 1);
 }
 
+// With the binary log open, each query is recorded in it.
+TEST_F(AuthSrvTest, binaryQueryLog) {
+    const char* const log_file = "auth_querylog_test.blg";
+    unlink(log_file);
+    bundy::log::BinaryLog& querylog = bundy::log::BinaryLog::global();
+    querylog.open(log_file, 0, 0);
+
+    updateBuiltin(server);
+    UnitTestUtil::createRequestMessage(request_message, Opcode::QUERY(),
+                                       default_qid, Name("VERSION.BIND."),
+                                       RRClass::CH(), RRType::TXT());
+    createRequestPacket(request_message, IPPROTO_TCP);
+    server.processMessage(*io_message, *parse_message, *response_obuffer,
+                          &dnsserv);
+    querylog.close();
+
+    bundy::log::BinaryLogReader reader(log_file);
+    bundy::log::BinaryLogRecord record;
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(4, record.family);
+    const uint8_t address[] = { 192, 0, 2, 1 };
+    EXPECT_EQ(0, memcmp(address, record.address, sizeof(address)));
+    EXPECT_EQ(53210, record.port);
+    EXPECT_EQ(bundy::log::BinaryLogRecord::FLAG_TCP, record.flags);
+    EXPECT_EQ(Rcode::NOERROR().getCode(), record.rcode);
+    EXPECT_EQ(RRType::TXT().getCode(), record.qtype);
+    const Name qname("VERSION.BIND.");
+    ASSERT_EQ(qname.getLength(), record.qname_length);
+    InputBuffer qname_buffer(record.qname, record.qname_length);
+    EXPECT_EQ(qname, Name(qname_buffer));
+    EXPECT_NE(0, record.timestamp);
+    EXPECT_FALSE(reader.next(record));
+
+    unlink(log_file);
+}
+
 // Same type of test as builtInQueryViaDNSServer but for an error response.
 TEST_F(AuthSrvTest, iqueryViaDNSServer) {
     updateBuiltin(server);
@@ -1276,6 +1415,233 @@ TEST_F(AuthSrvTest, queryWithInMemoryClientDNSSEC) {
                 opcode.getCode(), QR_FLAG | AA_FLAG, 1, 2, 3, 3);
 }
 
+TEST_F(AuthSrvTest, queryWithRRL) {
+    updateInMemory(server, "example.", CONFIG_INMEMORY_EXAMPLE);
+
+    // Allow one response per second, and let every limited response slip.
+    server.setRRL(boost::shared_ptr<ResponseRateLimiter>(
+                      new ResponseRateLimiter(
+                          100, 1, 1, 1, 15, 1, 24, 56, false,
+                          ResponseRateLimiter::getCurrentTime())));
+    createDataFromFile("nsec3query_nodnssec_fromWire.wire");
+    server.processMessage(*io_message, *parse_message, *response_obuffer,
+                          &dnsserv);
+    EXPECT_TRUE(dnsserv.hasAnswer());
+    headerCheck(*parse_message, default_qid, Rcode::NOERROR(),
+                opcode.getCode(), QR_FLAG | AA_FLAG, 1, 1, 2, 1);
+
+    // The next one is limited, and sent as an empty, truncated response.
+    parse_message->clear(Message::PARSE);
+    createDataFromFile("nsec3query_nodnssec_fromWire.wire");
+    server.processMessage(*io_message, *parse_message, *response_obuffer,
+                          &dnsserv);
+    EXPECT_TRUE(dnsserv.hasAnswer());
+    headerCheck(*parse_message, default_qid, Rcode::NOERROR(),
+                opcode.getCode(), QR_FLAG | AA_FLAG | TC_FLAG, 1, 0, 0, 0);
+
+    // Queries over TCP are never limited.
+    parse_message->clear(Message::PARSE);
+    createDataFromFile("nsec3query_nodnssec_fromWire.wire", IPPROTO_TCP);
+    server.processMessage(*io_message, *parse_message, *response_obuffer,
+                          &dnsserv);
+    EXPECT_TRUE(dnsserv.hasAnswer());
+    headerCheck(*parse_message, default_qid, Rcode::NOERROR(),
+                opcode.getCode(), QR_FLAG | AA_FLAG, 1, 1, 2, 1);
+
+    // Without slip, limited responses are dropped.
+    server.setRRL(boost::shared_ptr<ResponseRateLimiter>(
+                      new ResponseRateLimiter(
+                          100, 1, 1, 1, 15, 0, 24, 56, false,
+                          ResponseRateLimiter::getCurrentTime())));
+    parse_message->clear(Message::PARSE);
+    createDataFromFile("nsec3query_nodnssec_fromWire.wire");
+    server.processMessage(*io_message, *parse_message, *response_obuffer,
+                          &dnsserv);
+    EXPECT_TRUE(dnsserv.hasAnswer());
+    parse_message->clear(Message::PARSE);
+    createDataFromFile("nsec3query_nodnssec_fromWire.wire");
+    server.processMessage(*io_message, *parse_message, *response_obuffer,
+                          &dnsserv);
+    EXPECT_FALSE(dnsserv.hasAnswer());
+
+    // And nothing is limited once it's disabled.
+    server.setRRL(boost::shared_ptr<ResponseRateLimiter>());
+    parse_message->clear(Message::PARSE);
+    createDataFromFile("nsec3query_nodnssec_fromWire.wire");
+    server.processMessage(*io_message, *parse_message, *response_obuffer,
+                          &dnsserv);
+    EXPECT_TRUE(dnsserv.hasAnswer());
+}
+
+TEST_F(AuthSrvTest, queryWhileOverloaded) {
+    updateInMemory(server, "example.", CONFIG_INMEMORY_EXAMPLE);
+    EXPECT_EQ(AuthSrv::SHED_ALL, server.getOverloadShedding());
+    dnsserv.setOverloaded(true);
+
+    // A query that would be refused is dropped.
+    UnitTestUtil::createRequestMessage(request_message, Opcode::QUERY(),
+                                       default_qid, Name("example.org"),
+                                       RRClass::IN(), RRType::A());
+    createRequestPacket(request_message, IPPROTO_UDP);
+    server.processMessage(*io_message, *parse_message, *response_obuffer,
+                          &dnsserv);
+    EXPECT_FALSE(dnsserv.hasAnswer());
+
+    // Queries for the zone are answered as usual.
+    parse_message->clear(Message::PARSE);
+    createDataFromFile("nsec3query_nodnssec_fromWire.wire");
+    server.processMessage(*io_message, *parse_message, *response_obuffer,
+                          &dnsserv);
+    EXPECT_TRUE(dnsserv.hasAnswer());
+    headerCheck(*parse_message, default_qid, Rcode::NOERROR(),
+                opcode.getCode(), QR_FLAG | AA_FLAG, 1, 1, 2, 1);
+
+    // Once a response to the client is limited (and slips), its further
+    // queries are dropped before being answered.
+    server.setRRL(boost::shared_ptr<ResponseRateLimiter>(
+                      new ResponseRateLimiter(
+                          100, 1, 1, 1, 15, 1, 24, 56, false,
+                          ResponseRateLimiter::getCurrentTime())));
+    for (int i = 0; i < 2; ++i) {
+        parse_message->clear(Message::PARSE);
+        createDataFromFile("nsec3query_nodnssec_fromWire.wire");
+        server.processMessage(*io_message, *parse_message, *response_obuffer,
+                              &dnsserv);
+        EXPECT_TRUE(dnsserv.hasAnswer());
+    }
+    headerCheck(*parse_message, default_qid, Rcode::NOERROR(),
+                opcode.getCode(), QR_FLAG | AA_FLAG | TC_FLAG, 1, 0, 0, 0);
+    parse_message->clear(Message::PARSE);
+    createDataFromFile("nsec3query_nodnssec_fromWire.wire");
+    server.processMessage(*io_message, *parse_message, *response_obuffer,
+                          &dnsserv);
+    EXPECT_FALSE(dnsserv.hasAnswer());
+
+    // Without shedding, it's left to the limiter, which lets it slip.
+    server.setOverloadShedding(AuthSrv::SHED_NONE);
+    parse_message->clear(Message::PARSE);
+    createDataFromFile("nsec3query_nodnssec_fromWire.wire");
+    server.processMessage(*io_message, *parse_message, *response_obuffer,
+                          &dnsserv);
+    EXPECT_TRUE(dnsserv.hasAnswer());
+    headerCheck(*parse_message, default_qid, Rcode::NOERROR(),
+                opcode.getCode(), QR_FLAG | AA_FLAG | TC_FLAG, 1, 0, 0, 0);
+
+    // And the query that would be refused is answered, as it is when the
+    // server isn't overloaded.
+    server.setRRL(boost::shared_ptr<ResponseRateLimiter>());
+    parse_message->clear(Message::PARSE);
+    request_renderer.clear();
+    createRequestPacket(request_message, IPPROTO_UDP);
+    server.processMessage(*io_message, *parse_message, *response_obuffer,
+                          &dnsserv);
+    EXPECT_TRUE(dnsserv.hasAnswer());
+    headerCheck(*parse_message, default_qid, Rcode::REFUSED(),
+                opcode.getCode(), QR_FLAG, 1, 0, 0, 0);
+
+    server.setOverloadShedding(AuthSrv::SHED_ALL);
+    dnsserv.setOverloaded(false);
+    parse_message->clear(Message::PARSE);
+    request_renderer.clear();
+    createRequestPacket(request_message, IPPROTO_UDP);
+    server.processMessage(*io_message, *parse_message, *response_obuffer,
+                          &dnsserv);
+    EXPECT_TRUE(dnsserv.hasAnswer());
+    headerCheck(*parse_message, default_qid, Rcode::REFUSED(),
+                opcode.getCode(), QR_FLAG, 1, 0, 0, 0);
+}
+
+TEST_F(AuthSrvTest, queryWithResponseCache) {
+    updateInMemory(server, "example.", CONFIG_INMEMORY_EXAMPLE);
+    server.setResponseCacheSize(10);
+    EXPECT_EQ(10, server.getResponseCacheSize());
+
+    // The first response is built from the zone and cached.
+    createDataFromFile("nsec3query_nodnssec_fromWire.wire");
+    server.processMessage(*io_message, *parse_message, *response_obuffer,
+                          &dnsserv);
+    EXPECT_TRUE(dnsserv.hasAnswer());
+    EXPECT_EQ(1, server.getCachedResponseCount());
+    const vector<uint8_t> first_response(
+        static_cast<const uint8_t*>(response_obuffer->getData()),
+        static_cast<const uint8_t*>(response_obuffer->getData()) +
+        response_obuffer->getLength());
+
+    // The second one comes from the cache, and is the same as the first.
+    parse_message->clear(Message::PARSE);
+    response_obuffer->clear();
+    createDataFromFile("nsec3query_nodnssec_fromWire.wire");
+    server.processMessage(*io_message, *parse_message, *response_obuffer,
+                          &dnsserv);
+    EXPECT_TRUE(dnsserv.hasAnswer());
+    EXPECT_EQ(1, server.getCachedResponseCount());
+    matchWireData(&first_response[0], first_response.size(),
+                  response_obuffer->getData(), response_obuffer->getLength());
+    Message cached_response(Message::PARSE);
+    InputBuffer ib(response_obuffer->getData(),
+                   response_obuffer->getLength());
+    cached_response.fromWire(ib);
+    headerCheck(cached_response, default_qid, Rcode::NOERROR(),
+                opcode.getCode(), QR_FLAG | AA_FLAG, 1, 1, 2, 1);
+
+    // A query with the DO bit is cached separately.
+    parse_message->clear(Message::PARSE);
+    response_obuffer->clear();
+    createDataFromFile("nsec3query_fromWire.wire");
+    server.processMessage(*io_message, *parse_message, *response_obuffer,
+                          &dnsserv);
+    EXPECT_TRUE(dnsserv.hasAnswer());
+    EXPECT_EQ(2, server.getCachedResponseCount());
+
+    // Updating the zone invalidates the cached responses.
+    updateInMemory(server, "example.", CONFIG_INMEMORY_EXAMPLE);
+    EXPECT_EQ(0, server.getCachedResponseCount());
+
+    // Disabling the cache also removes everything.
+    parse_message->clear(Message::PARSE);
+    response_obuffer->clear();
+    createDataFromFile("nsec3query_nodnssec_fromWire.wire");
+    server.processMessage(*io_message, *parse_message, *response_obuffer,
+                          &dnsserv);
+    EXPECT_EQ(1, server.getCachedResponseCount());
+    server.setResponseCacheSize(0);
+    EXPECT_EQ(0, server.getCachedResponseCount());
+}
+
+TEST_F(AuthSrvTest, cachedQueryWithRRL) {
+    // Cached responses are subject to RRL, too.  This is a separate path
+    // from the uncached case, as the query isn't fully parsed.
+    updateInMemory(server, "example.", CONFIG_INMEMORY_EXAMPLE);
+    server.setResponseCacheSize(10);
+    server.setRRL(boost::shared_ptr<ResponseRateLimiter>(
+                      new ResponseRateLimiter(
+                          100, 1, 1, 1, 15, 1, 24, 56, false,
+                          ResponseRateLimiter::getCurrentTime())));
+    createDataFromFile("nsec3query_fromWire.wire");
+    server.processMessage(*io_message, *parse_message, *response_obuffer,
+                          &dnsserv);
+    EXPECT_TRUE(dnsserv.hasAnswer());
+    EXPECT_EQ(1, server.getCachedResponseCount());
+
+    // The limited response still needs the question and EDNS.
+    parse_message->clear(Message::PARSE);
+    response_obuffer->clear();
+    createDataFromFile("nsec3query_fromWire.wire");
+    server.processMessage(*io_message, *parse_message, *response_obuffer,
+                          &dnsserv);
+    EXPECT_TRUE(dnsserv.hasAnswer());
+    Message response(Message::PARSE);
+    InputBuffer ib(response_obuffer->getData(),
+                   response_obuffer->getLength());
+    response.fromWire(ib);
+    headerCheck(response, default_qid, Rcode::NOERROR(), opcode.getCode(),
+                QR_FLAG | AA_FLAG | TC_FLAG, 1, 0, 0, 1);
+    EXPECT_EQ(Name("ns2.example"),
+              (*response.beginQuestion())->getName());
+    ASSERT_TRUE(response.getEDNS());
+    EXPECT_TRUE(response.getEDNS()->getDNSSECAwareness());
+}
+
 TEST_F(AuthSrvTest, chQueryWithInMemoryClient) {
     // Set up the in-memory
     updateInMemory(server, "example.", CONFIG_INMEMORY_EXAMPLE);
@@ -174,4 +174,40 @@ TEST_F(AuthCommandTest, getStats) {
     // statistics are done in its own tests.
     EXPECT_EQ(0, rcode_);
 }
+
+TEST_F(AuthCommandTest, getZoneLoadStatus) {
+    result_ = execAuthServerCommand(server_, "get_zone_load_status",
+                                    ConstElementPtr());
+    const ConstElementPtr status = parseAnswer(rcode_, result_);
+    EXPECT_EQ(0, rcode_);
+    // Nothing has been configured yet.
+    EXPECT_FALSE(status->get("loading")->boolValue());
+    EXPECT_EQ(0, status->get("zones_found")->intValue());
+    EXPECT_EQ(0, status->get("zones_loaded")->intValue());
+}
+
+TEST_F(AuthCommandTest, getZoneMemoryUsage) {
+    result_ = execAuthServerCommand(server_, "get_zone_memory_usage",
+                                    ConstElementPtr());
+    const ConstElementPtr usage = parseAnswer(rcode_, result_);
+    EXPECT_EQ(0, rcode_);
+    // Nothing has been configured yet.  The usage itself is tested with
+    // the server.
+    EXPECT_EQ(0, usage->size());
+}
+
+TEST_F(AuthCommandTest, saveHotNames) {
+    result_ = execAuthServerCommand(server_, "save_hot_names",
+                                    ConstElementPtr());
+    const ConstElementPtr saved = parseAnswer(rcode_, result_);
+    EXPECT_EQ(0, rcode_);
+    // Nothing has been configured yet, so nothing is saved.
+    EXPECT_EQ(0, saved->size());
+
+    // The number of names must be positive.
+    result_ = execAuthServerCommand(server_, "save_hot_names",
+                                    Element::fromJSON("{\"max_names\": 0}"));
+    parseAnswer(rcode_, result_);
+    EXPECT_EQ(1, rcode_);
+}
 }
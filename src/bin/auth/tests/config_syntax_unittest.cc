@@ -86,4 +86,16 @@ TEST_F(AuthConfigSyntaxTest, badTCPRecvTimeout) {
                 "                 \"filetype\": \"sqlite3\"}]}]}"), false));
 }
 
+TEST_F(AuthConfigSyntaxTest, workerThreads) {
+    // worker_threads is optional, and must be int if specified
+    EXPECT_TRUE(
+        mspec_.validateConfig(
+            Element::fromJSON("{\"tcp_recv_timeout\": 1000,"
+                              " \"listen_on\": [],"
+                              " \"worker_threads\": 4}"), true));
+    EXPECT_FALSE(
+        mspec_.validateConfig(
+            Element::fromJSON("{\"worker_threads\": \"foo\"}"), false));
+}
+
 }
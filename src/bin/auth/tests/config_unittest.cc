@@ -26,6 +26,7 @@
 #include <auth/auth_srv.h>
 #include <auth/auth_config.h>
 #include <auth/common.h>
+#include <auth/rrl.h>
 
 #include "datasrc_util.h"
 
@@ -157,4 +158,224 @@ TEST_F(AuthConfigTest, tcpRecvTimeoutConfig) {
                  AuthConfigError);
 }
 
+// Try setting the TCP pipelining limit through config
+TEST_F(AuthConfigTest, tcpMaxInFlightConfig) {
+    EXPECT_EQ(16, dnss_.getTCPMaxInFlight());
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"tcp_max_in_flight\": 4 }"));
+    EXPECT_EQ(4, dnss_.getTCPMaxInFlight());
+    EXPECT_THROW(configureAuthServer(server, Element::fromJSON(
+                    "{ \"tcp_max_in_flight\": 0 }")),
+                 AuthConfigError);
+    EXPECT_EQ(4, dnss_.getTCPMaxInFlight());
+}
+
+// Try setting the UDP batch size through config
+TEST_F(AuthConfigTest, udpBatchSizeConfig) {
+    EXPECT_EQ(1, dnss_.getUDPBatchSize());
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"udp_batch_size\": 32 }"));
+    EXPECT_EQ(32, dnss_.getUDPBatchSize());
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"udp_batch_size\": 1 }"));
+    EXPECT_EQ(1, dnss_.getUDPBatchSize());
+    EXPECT_THROW(configureAuthServer(server, Element::fromJSON(
+                    "{ \"udp_batch_size\": 0 }")),
+                 AuthConfigError);
+    EXPECT_THROW(configureAuthServer(server, Element::fromJSON(
+                    "{ \"udp_batch_size\": 1025 }")),
+                 AuthConfigError);
+    EXPECT_EQ(1, dnss_.getUDPBatchSize());
+}
+
+// Try setting the number of worker threads through config
+TEST_F(AuthConfigTest, workerThreadsConfig) {
+    EXPECT_EQ(0, server.getWorkerThreads());
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"worker_threads\": 4 }"));
+    EXPECT_EQ(4, server.getWorkerThreads());
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"worker_threads\": 0 }"));
+    EXPECT_EQ(0, server.getWorkerThreads());
+    EXPECT_THROW(configureAuthServer(server, Element::fromJSON(
+                    "{ \"worker_threads\": -1 }")),
+                 AuthConfigError);
+    EXPECT_EQ(0, server.getWorkerThreads());
+}
+
+// Try setting the CPUs of the worker threads through config
+TEST_F(AuthConfigTest, workerCPUsConfig) {
+    EXPECT_TRUE(server.getWorkerCPUs().empty());
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"worker_cpus\": [0, 2] }"));
+    ASSERT_EQ(2, server.getWorkerCPUs().size());
+    EXPECT_EQ(0, server.getWorkerCPUs()[0]);
+    EXPECT_EQ(2, server.getWorkerCPUs()[1]);
+    EXPECT_THROW(configureAuthServer(server, Element::fromJSON(
+                    "{ \"worker_cpus\": [1, -1] }")),
+                 AuthConfigError);
+    EXPECT_EQ(2, server.getWorkerCPUs().size());
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"worker_cpus\": [] }"));
+    EXPECT_TRUE(server.getWorkerCPUs().empty());
+}
+
+// Try setting the number of zone load threads through config
+TEST_F(AuthConfigTest, zoneLoadThreadsConfig) {
+    EXPECT_NO_THROW(configureAuthServer(server, Element::fromJSON(
+                        "{ \"zone_load_threads\": 4 }")));
+    EXPECT_THROW(configureAuthServer(server, Element::fromJSON(
+                    "{ \"zone_load_threads\": 0 }")),
+                 AuthConfigError);
+    EXPECT_THROW(configureAuthServer(server, Element::fromJSON(
+                    "{ \"zone_load_threads\": -1 }")),
+                 AuthConfigError);
+}
+
+// Try setting the minimum interval between zone reloads through config
+TEST_F(AuthConfigTest, zoneUpdateIntervalConfig) {
+    EXPECT_EQ(0, server.getDataSrcClientsMgr().getZoneUpdateInterval());
+    EXPECT_NO_THROW(configureAuthServer(server, Element::fromJSON(
+                        "{ \"zone_update_interval\": 500 }")));
+    EXPECT_EQ(500, server.getDataSrcClientsMgr().getZoneUpdateInterval());
+    EXPECT_THROW(configureAuthServer(server, Element::fromJSON(
+                    "{ \"zone_update_interval\": -1 }")),
+                 AuthConfigError);
+    EXPECT_THROW(configureAuthServer(server, Element::fromJSON(
+                    "{ \"zone_update_interval\": 4294967296 }")),
+                 AuthConfigError);
+    EXPECT_EQ(500, server.getDataSrcClientsMgr().getZoneUpdateInterval());
+}
+
+// Try setting the size of the response cache through config
+TEST_F(AuthConfigTest, responseCacheSizeConfig) {
+    EXPECT_EQ(0, server.getResponseCacheSize());
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"response_cache_size\": 1000 }"));
+    EXPECT_EQ(1000, server.getResponseCacheSize());
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"response_cache_size\": 0 }"));
+    EXPECT_EQ(0, server.getResponseCacheSize());
+    EXPECT_THROW(configureAuthServer(server, Element::fromJSON(
+                    "{ \"response_cache_size\": -1 }")),
+                 AuthConfigError);
+    EXPECT_EQ(0, server.getResponseCacheSize());
+}
+
+// Try setting the size of the NSEC3 proof cache through config
+TEST_F(AuthConfigTest, nsec3ProofCacheSizeConfig) {
+    EXPECT_EQ(0, server.getNSEC3ProofCacheSize());
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"nsec3_proof_cache_size\": 1000 }"));
+    EXPECT_EQ(1000, server.getNSEC3ProofCacheSize());
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"nsec3_proof_cache_size\": 0 }"));
+    EXPECT_EQ(0, server.getNSEC3ProofCacheSize());
+    EXPECT_THROW(configureAuthServer(server, Element::fromJSON(
+                    "{ \"nsec3_proof_cache_size\": -1 }")),
+                 AuthConfigError);
+    EXPECT_EQ(0, server.getNSEC3ProofCacheSize());
+}
+
+// Try setting the number of zones with statistics counters through config
+TEST_F(AuthConfigTest, zoneStatisticsConfig) {
+    EXPECT_EQ(0, server.getZoneStatisticsSize());
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"statistics_zones\": 100 }"));
+    EXPECT_EQ(100, server.getZoneStatisticsSize());
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"statistics_zones\": 0 }"));
+    EXPECT_EQ(0, server.getZoneStatisticsSize());
+    EXPECT_THROW(configureAuthServer(server, Element::fromJSON(
+                    "{ \"statistics_zones\": -1 }")),
+                 AuthConfigError);
+    EXPECT_EQ(0, server.getZoneStatisticsSize());
+}
+
+// Try enabling and disabling response rate limiting through config
+TEST_F(AuthConfigTest, rrlConfig) {
+    EXPECT_FALSE(server.getRRL());
+
+    // Omitted parameters get the default values.
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"rrl\": { \"enable\": true, \"responses_per_second\": 5 } }"));
+    ASSERT_TRUE(server.getRRL());
+    EXPECT_EQ(5, server.getRRL()->getResponseRate());
+    EXPECT_EQ(5, server.getRRL()->getNXDOMAINRate());
+    EXPECT_EQ(5, server.getRRL()->getErrorRate());
+    EXPECT_EQ(15, server.getRRL()->getWindow());
+    EXPECT_EQ(2, server.getRRL()->getSlip());
+    EXPECT_FALSE(server.getRRL()->isLogOnly());
+    EXPECT_EQ(20000, server.getRRL()->getTableSize());
+
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"rrl\": { \"enable\": true, \"responses_per_second\": 5,"
+    "  \"nxdomains_per_second\": 2, \"errors_per_second\": 1,"
+    "  \"window\": 5, \"slip\": 0, \"log_only\": true,"
+    "  \"max_table_size\": 100 } }"));
+    ASSERT_TRUE(server.getRRL());
+    EXPECT_EQ(2, server.getRRL()->getNXDOMAINRate());
+    EXPECT_EQ(1, server.getRRL()->getErrorRate());
+    EXPECT_EQ(5, server.getRRL()->getWindow());
+    EXPECT_EQ(0, server.getRRL()->getSlip());
+    EXPECT_TRUE(server.getRRL()->isLogOnly());
+    EXPECT_EQ(100, server.getRRL()->getTableSize());
+
+    // Invalid parameters are rejected, keeping the current limiter.
+    const boost::shared_ptr<bundy::auth::ResponseRateLimiter> rrl =
+        server.getRRL();
+    EXPECT_THROW(configureAuthServer(server, Element::fromJSON(
+                    "{ \"rrl\": { \"enable\": true, \"window\": 0 } }")),
+                 AuthConfigError);
+    EXPECT_THROW(configureAuthServer(server, Element::fromJSON(
+                    "{ \"rrl\": { \"enable\": true, \"slip\": -1 } }")),
+                 AuthConfigError);
+    EXPECT_THROW(configureAuthServer(server, Element::fromJSON(
+                    "{ \"rrl\": { \"enable\": true,"
+                    "  \"ipv4_prefix_length\": 33 } }")),
+                 AuthConfigError);
+    EXPECT_EQ(rrl, server.getRRL());
+
+    // Disabled explicitly or by default.
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"rrl\": { \"enable\": false } }"));
+    EXPECT_FALSE(server.getRRL());
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"rrl\": { \"enable\": true } }"));
+    EXPECT_TRUE(server.getRRL());
+    configureAuthServer(server, Element::fromJSON("{ \"rrl\": {} }"));
+    EXPECT_FALSE(server.getRRL());
+}
+
+// Try configuring the overload detection and load shedding
+TEST_F(AuthConfigTest, overloadConfig) {
+    EXPECT_EQ(0, dnss_.getUDPOverloadLatency());
+    EXPECT_EQ(AuthSrv::SHED_ALL, server.getOverloadShedding());
+
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"overload\": { \"latency\": 5000, \"drop_refused\": false } }"));
+    EXPECT_EQ(5000, dnss_.getUDPOverloadLatency());
+    EXPECT_EQ(AuthSrv::SHED_RATE_LIMITED | AuthSrv::SHED_NSEC3_NXDOMAIN,
+              server.getOverloadShedding());
+
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"overload\": { \"latency\": 100, \"drop_refused\": false,"
+    "  \"drop_rate_limited\": false,"
+    "  \"truncate_nsec3_nxdomain\": false } }"));
+    EXPECT_EQ(100, dnss_.getUDPOverloadLatency());
+    EXPECT_EQ(AuthSrv::SHED_NONE, server.getOverloadShedding());
+
+    // An invalid latency is rejected, keeping the current configuration.
+    EXPECT_THROW(configureAuthServer(server, Element::fromJSON(
+                    "{ \"overload\": { \"latency\": -1 } }")),
+                 AuthConfigError);
+    EXPECT_EQ(100, dnss_.getUDPOverloadLatency());
+    EXPECT_EQ(AuthSrv::SHED_NONE, server.getOverloadShedding());
+
+    // Omitted parameters get the default values.
+    configureAuthServer(server, Element::fromJSON("{ \"overload\": {} }"));
+    EXPECT_EQ(0, dnss_.getUDPOverloadLatency());
+    EXPECT_EQ(AuthSrv::SHED_ALL, server.getOverloadShedding());
+}
+
 }
@@ -34,6 +34,7 @@
 
 #include <gtest/gtest.h>
 
+#include <boost/bind.hpp>
 #include <boost/function.hpp>
 
 #include <sys/types.h>
@@ -42,6 +43,8 @@
 #include <cstdlib>
 #include <string>
 #include <sstream>
+#include <utility>
+#include <vector>
 #include <cerrno>
 #include <unistd.h>
 
@@ -49,6 +52,7 @@ using bundy::data::ConstElementPtr;
 using namespace bundy::dns;
 using namespace bundy::data;
 using namespace bundy::datasrc;
+using bundy::auth::ZoneLoadProgress;
 using namespace bundy::auth::datasrc_clientmgr_internal;
 using namespace bundy::auth::unittest;
 using namespace bundy::testutils;
@@ -394,6 +398,50 @@ DataSrcClientsBuilderTest::configureZones() {
     zoneChecks(clients_map, rrclass);
 }
 
+TEST_F(DataSrcClientsBuilderTest, zoneLoadProgress) {
+    // Nothing is loading initially.
+    ZoneLoadProgress progress = builder.getZoneLoadProgress();
+    EXPECT_FALSE(progress.loading);
+    EXPECT_EQ(0, progress.zones_found);
+    EXPECT_EQ(0, progress.zones_loaded);
+
+    EXPECT_THROW(builder.setZoneLoadThreads(0), bundy::InvalidParameter);
+    builder.setZoneLoadThreads(2);
+
+    // Two MasterFiles zones are loaded (in parallel), and the counters
+    // show all of them at the end.
+    const Command reconfig_cmd(
+        RECONFIGURE,
+        Element::fromJSON(
+            "{\"classes\": {\"IN\": [{"
+            "   \"type\": \"MasterFiles\","
+            "   \"params\": {"
+            "       \"test1.example\": \"" TEST_DATA_DIR "/test1.zone.in\","
+            "       \"test2.example\": \"" TEST_DATA_DIR "/test2.zone.in\""
+            "   },"
+            "   \"cache-enable\": true}]},"
+            " \"_generation_id\": 1}"),
+        FinishedCallback());
+    EXPECT_TRUE(builder.handleCommand(reconfig_cmd));
+    progress = builder.getZoneLoadProgress();
+    EXPECT_FALSE(progress.loading);
+    EXPECT_EQ(2, progress.zones_found);
+    EXPECT_EQ(2, progress.zones_loaded);
+    zoneChecks(clients_map, rrclass);
+
+    // Counters are reset on the next reconfiguration, even if it fails.
+    const Command bad_cmd(
+        RECONFIGURE,
+        Element::fromJSON("{\"classes\": {\"IN\": [{\"type\": \"Bad\"}]},"
+                          " \"_generation_id\": 2}"),
+        FinishedCallback());
+    EXPECT_TRUE(builder.handleCommand(bad_cmd));
+    progress = builder.getZoneLoadProgress();
+    EXPECT_FALSE(progress.loading);
+    EXPECT_EQ(0, progress.zones_found);
+    EXPECT_EQ(0, progress.zones_loaded);
+}
+
 TEST_F(DataSrcClientsBuilderTest, loadZone) {
     // pre test condition checks
     EXPECT_EQ(0, map_mutex.lock_count);
@@ -423,6 +471,56 @@ TEST_F(DataSrcClientsBuilderTest, loadZone) {
     newZoneChecks(clients_map, rrclass);
 }
 
+typedef std::vector<std::pair<Name, RRClass> > UpdatedZones;
+
+void
+recordZoneUpdated(UpdatedZones* updated, const Name& origin,
+                  const RRClass& rrclass)
+{
+    updated->push_back(std::make_pair(origin, rrclass));
+}
+
+TEST_F(DataSrcClientsBuilderTest, zoneUpdatedCallback) {
+    configureZones();
+
+    // Use a separate builder with the callback.
+    UpdatedZones updated;
+    ZoneUpdatedCallback callback(boost::bind(recordZoneUpdated, &updated,
+                                             _1, _2));
+    TestDataSrcClientsBuilder builder2(&command_queue, &callback_queue, &cond,
+                                       &queue_mutex, &clients_map,
+                                       &map_mutex, write_end, &callback);
+
+    // Loading a zone notifies it, within the critical section.
+    const Command loadzone_cmd(LOADZONE, Element::fromJSON(
+                                   "{\"class\": \"IN\","
+                                   " \"origin\": \"test1.example\"}"),
+                               FinishedCallback());
+    EXPECT_TRUE(builder2.handleCommand(loadzone_cmd));
+    ASSERT_EQ(1, updated.size());
+    EXPECT_EQ(Name("test1.example"), updated[0].first);
+    EXPECT_EQ(RRClass::IN(), updated[0].second);
+
+    // Reconfiguration notifies all zones of the classes in the old and new
+    // maps.
+    updated.clear();
+    const Command reconfig_cmd(RECONFIGURE, Element::fromJSON(
+                                   "{\"_generation_id\": 1,"
+                                   " \"classes\": {\"CH\": []}}"),
+                               FinishedCallback());
+    EXPECT_TRUE(builder2.handleCommand(reconfig_cmd));
+    ASSERT_EQ(2, updated.size());
+    EXPECT_EQ(Name::ROOT_NAME(), updated[0].first);
+    EXPECT_EQ(RRClass::IN(), updated[0].second);
+    EXPECT_EQ(Name::ROOT_NAME(), updated[1].first);
+    EXPECT_EQ(RRClass::CH(), updated[1].second);
+
+    // Nothing is notified by the builder without the callback.
+    updated.clear();
+    EXPECT_TRUE(builder.handleCommand(reconfig_cmd));
+    EXPECT_TRUE(updated.empty());
+}
+
 // Shared test for both LOADZONE and UPDATEZONE
 void
 DataSrcClientsBuilderTest::checkLoadOrUpdateZone(CommandID cmdid) {
@@ -159,12 +159,10 @@ TEST(DataSrcClientsMgrTest, holder) {
         EXPECT_FALSE(holder.findClientList(RRClass::IN()));
         EXPECT_FALSE(holder.findClientList(RRClass::CH()));
         EXPECT_TRUE(holder.getClasses().empty());
-        // map should be protected here
-        EXPECT_EQ(1, FakeDataSrcClientsBuilder::map_mutex->lock_count);
-        EXPECT_EQ(0, FakeDataSrcClientsBuilder::map_mutex->unlock_count);
+        // readers don't lock the map
+        EXPECT_EQ(0, FakeDataSrcClientsBuilder::map_mutex->lock_count);
     }
-    // map lock has been released
-    EXPECT_EQ(1, FakeDataSrcClientsBuilder::map_mutex->unlock_count);
+    EXPECT_EQ(0, FakeDataSrcClientsBuilder::map_mutex->unlock_count);
 
     // Put something in, that should become visible.
     ConstElementPtr reconfigure_arg = Element::fromJSON(
@@ -195,10 +193,9 @@ TEST(DataSrcClientsMgrTest, holder) {
         EXPECT_EQ(RRClass::IN(), holder.getClasses()[0]);
     }
 
-    // Duplicate lock acquisition is prohibited (only test mgr can detect
-    // this reliably, so this test may not be that useful)
-    TestDataSrcClientsMgr::Holder holder1(mgr);
-    EXPECT_THROW(TestDataSrcClientsMgr::Holder holder2(mgr), bundy::Unexpected);
+    // Holders in different threads don't block each other, but we can only
+    // check that they don't lock the map here.
+    EXPECT_EQ(0, FakeDataSrcClientsBuilder::map_mutex->lock_count);
 }
 
 namespace {
@@ -208,7 +205,7 @@ void loadZoneWrapper(TestDataSrcClientsMgr* mgr, const ConstElementPtr& args) {
 }
 
 void checkLoadOrUpdateZone(boost::function<void(const ConstElementPtr& args)>
-                           handler)
+                           handler, bool merged = false)
 {
     EXPECT_TRUE(FakeDataSrcClientsBuilder::started);
     EXPECT_TRUE(FakeDataSrcClientsBuilder::command_queue->empty());
@@ -220,43 +217,47 @@ void checkLoadOrUpdateZone(boost::function<void(const ConstElementPtr& args)>
                                      "  \"datasource\": \"testsrc\"}");
     handler(args);
     EXPECT_EQ(1, FakeDataSrcClientsBuilder::command_queue->size());
+    // For updateZone, the queued command of the same zone covers the new one.
     handler(args);
-    EXPECT_EQ(2, FakeDataSrcClientsBuilder::command_queue->size());
+    const size_t qlen = merged ? 1 : 2;
+    EXPECT_EQ(qlen, FakeDataSrcClientsBuilder::command_queue->size());
 
     // Should fail with non-string 'class' value
     args->set("class", Element::create(1));
     EXPECT_THROW(handler(args), CommandError);
-    EXPECT_EQ(2, FakeDataSrcClientsBuilder::command_queue->size());
+    EXPECT_EQ(qlen, FakeDataSrcClientsBuilder::command_queue->size());
 
     // And with badclass
     args->set("class", Element::create("BADCLASS"));
     EXPECT_THROW(handler(args), CommandError);
-    EXPECT_EQ(2, FakeDataSrcClientsBuilder::command_queue->size());
+    EXPECT_EQ(qlen, FakeDataSrcClientsBuilder::command_queue->size());
 
-    // Should succeed without 'class'
+    // Should succeed without 'class' (which defaults to IN, so it's the same
+    // zone again)
     args->remove("class");
     handler(args);
-    EXPECT_EQ(3, FakeDataSrcClientsBuilder::command_queue->size());
+    const size_t last_qlen = merged ? qlen : qlen + 1;
+    EXPECT_EQ(last_qlen, FakeDataSrcClientsBuilder::command_queue->size());
 
     // but fail without origin, without sending new commands
     args->remove("origin");
     EXPECT_THROW(handler(args), CommandError);
-    EXPECT_EQ(3, FakeDataSrcClientsBuilder::command_queue->size());
+    EXPECT_EQ(last_qlen, FakeDataSrcClientsBuilder::command_queue->size());
 
     // And for 'origin' that is not a string
     args->set("origin", Element::create(1));
     EXPECT_THROW(handler(args), CommandError);
-    EXPECT_EQ(3, FakeDataSrcClientsBuilder::command_queue->size());
+    EXPECT_EQ(last_qlen, FakeDataSrcClientsBuilder::command_queue->size());
 
     // And origin that is not a correct name
     args->set("origin", Element::create(".."));
     EXPECT_THROW(handler(args), CommandError);
-    EXPECT_EQ(3, FakeDataSrcClientsBuilder::command_queue->size());
+    EXPECT_EQ(last_qlen, FakeDataSrcClientsBuilder::command_queue->size());
 
     // same for empty data and data that is not a map
     EXPECT_THROW(handler(bundy::data::ConstElementPtr()), CommandError);
     EXPECT_THROW(handler(bundy::data::Element::createList()), CommandError);
-    EXPECT_EQ(3, FakeDataSrcClientsBuilder::command_queue->size());
+    EXPECT_EQ(last_qlen, FakeDataSrcClientsBuilder::command_queue->size());
 
     // "datasource" is provided but not a string
     EXPECT_THROW(handler(bundy::data::Element::fromJSON(
@@ -280,12 +281,93 @@ TEST(DataSrcClientsMgrTest, updateZone) {
     TestDataSrcClientsMgr mgr;
 
     checkLoadOrUpdateZone(boost::bind(&TestDataSrcClientsMgr::updateZone, &mgr,
-                                      _1));
+                                      _1), true);
     // UPDATEZONE requires datasource be specified.
     EXPECT_THROW(mgr.updateZone(bundy::data::Element::fromJSON(
                                     "{ \"origin\": \".\"}")), CommandError);
 }
 
+TEST(DataSrcClientsMgrTest, updateZoneMerged) {
+    TestDataSrcClientsMgr mgr;
+    std::list<Command>& queue = *FakeDataSrcClientsBuilder::command_queue;
+
+    const ConstElementPtr args = Element::fromJSON(
+        "{\"origin\": \"example.com\", \"datasource\": \"testsrc\"}");
+    mgr.updateZone(args);
+    // The same zone, with the explicit default class and in different case
+    mgr.updateZone(Element::fromJSON("{\"class\": \"IN\","
+                                     " \"origin\": \"EXAMPLE.com\","
+                                     " \"datasource\": \"testsrc\"}"));
+    EXPECT_EQ(1, queue.size());
+
+    // Other zones, classes and data sources are queued separately.
+    mgr.updateZone(Element::fromJSON("{\"origin\": \"example.org\","
+                                     " \"datasource\": \"testsrc\"}"));
+    mgr.updateZone(Element::fromJSON("{\"class\": \"CH\","
+                                     " \"origin\": \"example.com\","
+                                     " \"datasource\": \"testsrc\"}"));
+    mgr.updateZone(Element::fromJSON("{\"origin\": \"example.com\","
+                                     " \"datasource\": \"othersrc\"}"));
+    EXPECT_EQ(4, queue.size());
+    mgr.updateZone(args);
+    EXPECT_EQ(4, queue.size());
+
+    // Nor loadZone commands, which are explicit requests.
+    mgr.loadZone(args);
+    mgr.loadZone(args);
+    EXPECT_EQ(6, queue.size());
+
+    // Updates are not merged across a reconfiguration.  (The test manager's
+    // reconfigure() expects an empty queue, so we push the command directly)
+    queue.push_back(Command(RECONFIGURE, Element::createMap(),
+                            FinishedCallback()));
+    mgr.updateZone(args);
+    EXPECT_EQ(8, queue.size());
+    EXPECT_EQ(UPDATEZONE, queue.back().id);
+    mgr.updateZone(args);
+    EXPECT_EQ(8, queue.size());
+
+    // Once the builder has taken the command, the zone is reloaded again.
+    queue.clear();
+    mgr.updateZone(args);
+    EXPECT_EQ(1, queue.size());
+}
+
+TEST(DataSrcClientsMgrTest, updateZoneInterval) {
+    TestDataSrcClientsMgr mgr;
+    std::list<Command>& queue = *FakeDataSrcClientsBuilder::command_queue;
+    EXPECT_EQ(0, mgr.getZoneUpdateInterval());
+    mgr.setZoneUpdateInterval(100);
+    EXPECT_EQ(100, mgr.getZoneUpdateInterval());
+
+    const ConstElementPtr args = Element::fromJSON(
+        "{\"origin\": \"example.com\", \"datasource\": \"testsrc\"}");
+    const ConstElementPtr other_args = Element::fromJSON(
+        "{\"origin\": \"example.org\", \"datasource\": \"testsrc\"}");
+
+    // The first update is sent immediately.
+    mgr.updateZone(args);
+    ASSERT_EQ(1, queue.size());
+    queue.clear();
+
+    // The following ones are deferred to the end of the interval, and
+    // sent once with the latest arguments.  Other zones are not affected.
+    const ConstElementPtr latest_args = Element::fromJSON(
+        "{\"origin\": \"example.com\", \"datasource\": \"testsrc\","
+        " \"serial\": 2}");
+    mgr.updateZone(args);
+    mgr.updateZone(latest_args);
+    mgr.updateZone(other_args);
+    ASSERT_EQ(1, queue.size());
+    EXPECT_EQ(other_args, queue.front().params);
+    queue.clear();
+
+    mgr.run_one();              // fires the timer
+    ASSERT_EQ(1, queue.size());
+    EXPECT_EQ(UPDATEZONE, queue.front().id);
+    EXPECT_EQ(latest_args, queue.front().params);
+}
+
 TEST(DataSrcClientsMgrTest, segmentUpdate) {
     TestDataSrcClientsMgr mgr;
     EXPECT_TRUE(FakeDataSrcClientsBuilder::started);
@@ -376,6 +458,14 @@ TEST(DataSrcClientsMgrTest, wakeup) {
     EXPECT_TRUE(FakeDataSrcClientsBuilder::callback_queue->empty());
 }
 
+TEST(DataSrcClientsMgrTest, zoneLoadThreads) {
+    // The thread count is simply passed to the builder.
+    TestDataSrcClientsMgr mgr;
+    mgr.setZoneLoadThreads(4);
+    EXPECT_EQ(4, FakeDataSrcClientsBuilder::zone_load_threads);
+    EXPECT_FALSE(mgr.getZoneLoadProgress().loading);
+}
+
 TEST(DataSrcClientsMgrTest, realThread) {
     // Using the non-test definition with a real thread.  Just checking
     // no disruption happens.
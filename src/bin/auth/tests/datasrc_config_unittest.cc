@@ -20,6 +20,7 @@
 #include <gtest/gtest.h>
 
 #include <boost/bind.hpp>
+#include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
 
 #include <memory>
@@ -37,9 +38,13 @@ class DatasrcConfigTest;
 
 class FakeList {
 public:
+    typedef boost::function<void(size_t, size_t)> LoadProgressCallback;
+
     FakeList(const RRClass&) :
         configuration_(new ListElement)
     {}
+    void setLoadThreadCount(size_t) {}
+    void setLoadProgressCallback(const LoadProgressCallback&) {}
     void configure(const ConstElementPtr& configuration, bool allow_cache) {
         EXPECT_TRUE(allow_cache);
         conf_ = configuration->get(0)->get("type")->stringValue();
@@ -0,0 +1,231 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+#include <config.h>
+
+#include <auth/nsec3_proof_cache.h>
+
+#include <dns/name.h>
+#include <dns/nsec3hash.h>
+#include <dns/rdataclass.h>
+#include <dns/rrclass.h>
+#include <dns/rrset.h>
+#include <dns/rrttl.h>
+#include <dns/rrtype.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <string>
+
+using namespace bundy::dns;
+using namespace bundy::auth;
+using boost::scoped_ptr;
+using std::string;
+
+namespace {
+
+// Hashes (with no salt and no additional iterations) used in the tests:
+// example.com:   ONIB9MGUB9H0RML3CDF5BGRJ59DKJHVK
+// *.example.com: 4F3CNT8CU22TNGEC382JJ4GDE4RB47UB
+// b.example.com: 3QNILC4QRC2P5CRN7JGVB5S3BPG0SHUV
+// g.example.com: ESHNE1DI7M7KUBJM0O1V3LRK563PAHMP
+// v.example.com: 0T0GN364IO3ILNADL2HF044TNMA8I7PT
+// z.example.com: S0V9O5V118DBNE8O1UBMP39315J46Q21
+class NSEC3ProofCacheTest : public ::testing::Test {
+protected:
+    NSEC3ProofCacheTest() :
+        origin_("example.com"),
+        // The NSEC3 of the apex, and intervals covering b, *, g, and z and
+        // v (wrapping around) respectively.
+        apex_nsec3_(createNSEC3("onib9mgub9h0rml3cdf5bgrj59dkjhvk",
+                                "P0000000000000000000000000000000")),
+        nsec3_1_(createNSEC3("10000000000000000000000000000000",
+                             "50000000000000000000000000000000")),
+        nsec3_2_(createNSEC3("e0000000000000000000000000000000",
+                             "G0000000000000000000000000000000")),
+        nsec3_3_(createNSEC3("s0000000000000000000000000000000",
+                             "10000000000000000000000000000000"))
+    {
+        cache_.setMaxEntries(10);
+    }
+
+    ConstRRsetPtr createNSEC3(const string& owner, const string& next) {
+        RRsetPtr rrset(new RRset(Name(owner).concatenate(origin_),
+                                 RRClass::IN(), RRType::NSEC3(),
+                                 RRTTL(3600)));
+        rrset->addRdata(rdata::generic::NSEC3("1 0 0 - " + next + " A"));
+        return (rrset);
+    }
+
+    void insert(const ConstRRsetPtr& next_proof,
+                const ConstRRsetPtr& wildcard_proof) {
+        NSEC3ProofCache::Proof proof;
+        proof.closest_proof = apex_nsec3_;
+        proof.next_proof = next_proof;
+        proof.wildcard_proof = wildcard_proof;
+        cache_.insert(origin_, RRClass::IN(), origin_, proof);
+    }
+
+    bool lookup(const Name& qname) {
+        proof_ = NSEC3ProofCache::Proof();
+        return (cache_.lookup(origin_, RRClass::IN(), qname, hash_,
+                              proof_));
+    }
+
+    NSEC3ProofCache cache_;
+    const Name origin_;
+    const ConstRRsetPtr apex_nsec3_;
+    const ConstRRsetPtr nsec3_1_;
+    const ConstRRsetPtr nsec3_2_;
+    const ConstRRsetPtr nsec3_3_;
+    scoped_ptr<NSEC3Hash> hash_;
+    NSEC3ProofCache::Proof proof_;
+};
+
+TEST_F(NSEC3ProofCacheTest, disabled) {
+    NSEC3ProofCache cache;
+    EXPECT_EQ(0, cache.getMaxEntries());
+    NSEC3ProofCache::Proof proof;
+    proof.closest_proof = apex_nsec3_;
+    proof.next_proof = nsec3_1_;
+    proof.wildcard_proof = nsec3_1_;
+    cache.insert(origin_, RRClass::IN(), origin_, proof);
+    EXPECT_EQ(0, cache.getEntryCount());
+    EXPECT_FALSE(cache.lookup(origin_, RRClass::IN(), Name("b.example.com"),
+                              hash_, proof));
+}
+
+TEST_F(NSEC3ProofCacheTest, lookup) {
+    EXPECT_FALSE(lookup(Name("b.example.com")));
+
+    insert(nsec3_1_, nsec3_1_);
+    EXPECT_EQ(1, cache_.getEntryCount());
+    ASSERT_TRUE(lookup(Name("b.example.com")));
+    EXPECT_EQ(apex_nsec3_, proof_.closest_proof);
+    EXPECT_EQ(nsec3_1_, proof_.next_proof);
+    EXPECT_EQ(nsec3_1_, proof_.wildcard_proof);
+    // The hash calculator is created on the first use.
+    EXPECT_TRUE(hash_);
+
+    // The next closer name of a deeper name is b.example.com.
+    EXPECT_TRUE(lookup(Name("x.y.b.example.com")));
+    EXPECT_EQ(nsec3_1_, proof_.next_proof);
+
+    // Not in any known interval.
+    EXPECT_FALSE(lookup(Name("g.example.com")));
+    EXPECT_FALSE(proof_.next_proof);
+    insert(nsec3_2_, nsec3_1_);
+    EXPECT_EQ(2, cache_.getEntryCount());
+    EXPECT_TRUE(lookup(Name("g.example.com")));
+    EXPECT_EQ(nsec3_2_, proof_.next_proof);
+
+    // The interval of the last NSEC3 wraps around.
+    EXPECT_FALSE(lookup(Name("z.example.com")));
+    EXPECT_FALSE(lookup(Name("v.example.com")));
+    insert(nsec3_3_, nsec3_1_);
+    EXPECT_TRUE(lookup(Name("z.example.com")));
+    EXPECT_EQ(nsec3_3_, proof_.next_proof);
+    EXPECT_TRUE(lookup(Name("v.example.com")));
+    EXPECT_EQ(nsec3_3_, proof_.next_proof);
+
+    // The closest encloser itself is never a non-existent name, even if
+    // its hash is in an interval.
+    insert(createNSEC3("n0000000000000000000000000000000",
+                       "P0000000000000000000000000000000"), nsec3_1_);
+    EXPECT_FALSE(lookup(origin_));
+
+    // Other zones aren't affected.
+    EXPECT_FALSE(cache_.lookup(origin_, RRClass::CH(), Name("b.example.com"),
+                               hash_, proof_));
+    EXPECT_FALSE(cache_.lookup(Name("b.example.com"), RRClass::IN(),
+                               Name("x.b.example.com"), hash_, proof_));
+}
+
+TEST_F(NSEC3ProofCacheTest, replaceHash) {
+    // A hash calculator that doesn't match the zone is replaced.
+    hash_.reset(NSEC3Hash::create(1, 10, NULL, 0));
+    const NSEC3Hash* const old_hash = hash_.get();
+    insert(nsec3_1_, nsec3_1_);
+    EXPECT_TRUE(lookup(Name("b.example.com")));
+    EXPECT_NE(old_hash, hash_.get());
+
+    // A matching one is reused.
+    const NSEC3Hash* const new_hash = hash_.get();
+    EXPECT_TRUE(lookup(Name("b.example.com")));
+    EXPECT_EQ(new_hash, hash_.get());
+}
+
+TEST_F(NSEC3ProofCacheTest, limit) {
+    cache_.setMaxEntries(2);
+    insert(nsec3_1_, nsec3_1_);
+    insert(nsec3_2_, nsec3_1_);
+    insert(nsec3_3_, nsec3_1_);
+    EXPECT_EQ(2, cache_.getEntryCount());
+    // The latest one is always kept.
+    EXPECT_TRUE(lookup(Name("z.example.com")));
+    EXPECT_TRUE(lookup(Name("b.example.com")) ||
+                lookup(Name("g.example.com")));
+
+    // Re-inserting the same interval doesn't increase the count.
+    insert(nsec3_3_, nsec3_1_);
+    EXPECT_EQ(2, cache_.getEntryCount());
+
+    // Shrinking the limit clears zones that exceed it.
+    cache_.setMaxEntries(1);
+    EXPECT_EQ(0, cache_.getEntryCount());
+    EXPECT_FALSE(lookup(Name("z.example.com")));
+
+    cache_.setMaxEntries(0);
+    insert(nsec3_1_, nsec3_1_);
+    EXPECT_EQ(0, cache_.getEntryCount());
+}
+
+TEST_F(NSEC3ProofCacheTest, invalidate) {
+    insert(nsec3_1_, nsec3_1_);
+
+    // Different class or an unrelated or deeper name don't matter.
+    cache_.invalidate(origin_, RRClass::CH());
+    cache_.invalidate(Name("example.org"), RRClass::IN());
+    cache_.invalidate(Name("sub.example.com"), RRClass::IN());
+    EXPECT_EQ(1, cache_.getEntryCount());
+    EXPECT_TRUE(lookup(Name("b.example.com")));
+
+    cache_.invalidate(origin_, RRClass::IN());
+    EXPECT_EQ(0, cache_.getEntryCount());
+    EXPECT_FALSE(lookup(Name("b.example.com")));
+
+    // Invalidating a superdomain (e.g. the root when a memory segment is
+    // reset) removes the zone, too.
+    insert(nsec3_1_, nsec3_1_);
+    cache_.invalidate(Name::ROOT_NAME(), RRClass::IN());
+    EXPECT_FALSE(lookup(Name("b.example.com")));
+
+    insert(nsec3_1_, nsec3_1_);
+    cache_.clear();
+    EXPECT_EQ(0, cache_.getEntryCount());
+    EXPECT_FALSE(lookup(Name("b.example.com")));
+}
+
+TEST_F(NSEC3ProofCacheTest, badProof) {
+    // RRsets that aren't NSEC3 are ignored.
+    RRsetPtr soa(new RRset(origin_, RRClass::IN(), RRType::SOA(),
+                           RRTTL(3600)));
+    soa->addRdata(rdata::generic::SOA(". . 0 0 0 0 0"));
+    insert(soa, nsec3_1_);
+    insert(nsec3_1_, soa);
+    EXPECT_EQ(0, cache_.getEntryCount());
+}
+
+}
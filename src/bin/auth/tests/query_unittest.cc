@@ -34,6 +34,7 @@
 #include <datasrc/client.h>
 #include <datasrc/client_list.h>
 
+#include <auth/nsec3_proof_cache.h>
 #include <auth/query.h>
 
 #include <testutils/dnsmessage_test.h>
@@ -2673,6 +2674,97 @@ TEST_P(QueryTest, nxdomainWithNSEC3Proof) {
                   NULL, mock_finder->getOrigin());
 }
 
+TEST_P(QueryTest, nxdomainWithCachedNSEC3Proof) {
+    // Same as the previous test, with the NSEC3 proof cache.
+    rrsets_to_add_.push_back(nsec3_uwild_txt);
+    rrsets_to_add_.push_back(unsigned_delegation_nsec3_txt);
+    enableNSEC3(rrsets_to_add_);
+    NSEC3ProofCache cache;
+    cache.setMaxEntries(10);
+    query.setNSEC3ProofCache(&cache);
+
+    const string expected_proof =
+        string(soa_minttl_txt) +
+        string("example.com. 0 IN RRSIG ") + getCommonRRSIGText("SOA") + "\n" +
+        string(nsec3_apex_txt) + "\n" +
+        nsec3_hash_.calculate(mock_finder->getOrigin()) +
+        string(".example.com. 3600 IN RRSIG ") +
+        getCommonRRSIGText("NSEC3") + "\n" +
+        string(nsec3_uwild_txt) + "\n" +
+        nsec3_hash_.calculate(Name("uwild.example.com")) +
+        ".example.com. 3600 IN RRSIG " + getCommonRRSIGText("NSEC3") + "\n" +
+        string(unsigned_delegation_nsec3_txt) +
+        nsec3_hash_.calculate(Name("unsigned-delegation.example.com")) +
+        ".example.com. 3600 IN RRSIG " + getCommonRRSIGText("NSEC3");
+
+    query.process(*list_, Name("nxdomain.example.com"), qtype, response,
+                  true);
+    responseCheck(response, Rcode::NXDOMAIN(), AA_FLAG, 0, 8, 0, NULL,
+                  expected_proof.c_str(), NULL, mock_finder->getOrigin());
+
+    // Only proofs from the in-memory data source are cached.
+    EXPECT_EQ(GetParam() == INMEMORY ? 1 : 0, cache.getEntryCount());
+
+    // The next closer name of nx.domain.example.com (domain.example.com)
+    // is in the same interval, so the (cached, if it's in-memory) proof
+    // should be the same.
+    response.clear(bundy::dns::Message::RENDER);
+    response.setRcode(Rcode::NOERROR());
+    response.setOpcode(Opcode::QUERY());
+    query.process(*list_, Name("nx.domain.example.com"), qtype, response,
+                  true);
+    responseCheck(response, Rcode::NXDOMAIN(), AA_FLAG, 0, 8, 0, NULL,
+                  expected_proof.c_str(), NULL, mock_finder->getOrigin());
+    EXPECT_EQ(GetParam() == INMEMORY ? 1 : 0, cache.getEntryCount());
+}
+
+TEST_P(QueryTest, nxdomainWithTruncatedNSEC3Proof) {
+    // When told to truncate NSEC3 NXDOMAIN responses, a proof that would
+    // have to be built results in an empty, truncated response.
+    rrsets_to_add_.push_back(nsec3_uwild_txt);
+    rrsets_to_add_.push_back(unsigned_delegation_nsec3_txt);
+    enableNSEC3(rrsets_to_add_);
+    NSEC3ProofCache cache;
+    cache.setMaxEntries(10);
+    query.setNSEC3ProofCache(&cache);
+
+    query.setTruncateNSEC3NXDOMAIN(true);
+    query.process(*list_, Name("nxdomain.example.com"), qtype, response,
+                  true);
+    responseCheck(response, Rcode::NXDOMAIN(), AA_FLAG | TC_FLAG, 0, 0, 0,
+                  NULL, NULL, NULL);
+    EXPECT_EQ(0, cache.getEntryCount());
+
+    // Non-DNSSEC responses don't need the proof, so they're not affected.
+    response.clear(bundy::dns::Message::RENDER);
+    response.setRcode(Rcode::NOERROR());
+    response.setOpcode(Opcode::QUERY());
+    query.process(*list_, Name("nxdomain.example.com"), qtype, response);
+    responseCheck(response, Rcode::NXDOMAIN(), AA_FLAG, 0, 1, 0, NULL,
+                  soa_minttl_txt, NULL, mock_finder->getOrigin());
+
+    // Once the proof is built (and cached), it's used even when truncating,
+    // as that's cheap.
+    query.setTruncateNSEC3NXDOMAIN(false);
+    response.clear(bundy::dns::Message::RENDER);
+    response.setRcode(Rcode::NOERROR());
+    response.setOpcode(Opcode::QUERY());
+    query.process(*list_, Name("nxdomain.example.com"), qtype, response,
+                  true);
+    responseCheck(response, Rcode::NXDOMAIN(), AA_FLAG, 0, 8, 0, NULL, NULL,
+                  NULL);
+    if (GetParam() == INMEMORY) {
+        query.setTruncateNSEC3NXDOMAIN(true);
+        response.clear(bundy::dns::Message::RENDER);
+        response.setRcode(Rcode::NOERROR());
+        response.setOpcode(Opcode::QUERY());
+        query.process(*list_, Name("nx.domain.example.com"), qtype,
+                      response, true);
+        responseCheck(response, Rcode::NXDOMAIN(), AA_FLAG, 0, 8, 0, NULL,
+                      NULL, NULL);
+    }
+}
+
 TEST_F(QueryTestForMockOnly, nxdomainWithBadNextNSEC3Proof) {
     // This is a broken data source scenario; works only with mock.
 
@@ -0,0 +1,249 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <auth/response_cache.h>
+
+#include <dns/message.h>
+#include <dns/messagerenderer.h>
+#include <dns/name.h>
+#include <dns/opcode.h>
+#include <dns/question.h>
+#include <dns/rcode.h>
+#include <dns/rdataclass.h>
+#include <dns/rrclass.h>
+#include <dns/rrset.h>
+#include <dns/rrttl.h>
+#include <dns/rrtype.h>
+#include <util/buffer.h>
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+using namespace bundy::dns;
+using namespace bundy::auth;
+using bundy::util::InputBuffer;
+using bundy::util::OutputBuffer;
+
+namespace {
+
+class ResponseCacheTest : public ::testing::Test {
+protected:
+    ResponseCacheTest() :
+        question_(Name("www.example.com"), RRClass::IN(), RRType::A()),
+        response_(Message::RENDER), wire_(0)
+    {
+        response_.setQid(0x1234);
+        response_.setOpcode(Opcode::QUERY());
+        response_.setRcode(Rcode::NOERROR());
+        response_.setHeaderFlag(Message::HEADERFLAG_QR);
+        response_.setHeaderFlag(Message::HEADERFLAG_AA);
+        response_.setHeaderFlag(Message::HEADERFLAG_RD);
+        response_.addQuestion(question_);
+        RRsetPtr rrset(new RRset(question_.getName(), RRClass::IN(),
+                                 RRType::A(), RRTTL(3600)));
+        rrset->addRdata(rdata::in::A("192.0.2.1"));
+        rrset->addRdata(rdata::in::A("192.0.2.2"));
+        response_.addRRset(Message::SECTION_ANSWER, rrset);
+
+        MessageRenderer renderer;
+        renderer.setBuffer(&wire_);
+        response_.toWire(renderer);
+        renderer.setBuffer(NULL);
+    }
+
+    // Create a cache entry of the response with the given question.
+    ResponseCache::ConstEntryPtr createEntry() {
+        return (ResponseCache::ConstEntryPtr(
+                    new ResponseCache::Entry(response_, wire_.getData(),
+                                             wire_.getLength(),
+                                             Name("example.com"),
+                                             detail::RESPONSE_QUERY)));
+    }
+
+    ResponseCache cache_;
+    const Question question_;
+    Message response_;
+    OutputBuffer wire_;
+};
+
+TEST_F(ResponseCacheTest, entry) {
+    const ResponseCache::ConstEntryPtr entry = createEntry();
+    EXPECT_EQ(wire_.getLength(), entry->getLength());
+    EXPECT_EQ(Rcode::NOERROR(), entry->getRcode());
+    EXPECT_TRUE(entry->isAuthoritative());
+    EXPECT_EQ(Name("example.com"), entry->getRRLName());
+    EXPECT_EQ(detail::RESPONSE_QUERY, entry->getRRLType());
+
+    // The summary has only the first RR of the first answer RRset.
+    ASSERT_TRUE(entry->getAnswerSummary());
+    EXPECT_EQ(question_.getName(), entry->getAnswerSummary()->getName());
+    EXPECT_EQ(RRType::A(), entry->getAnswerSummary()->getType());
+    EXPECT_EQ(1, entry->getAnswerSummary()->getRdataCount());
+
+    // Rendering the same query gives the same data.
+    OutputBuffer buffer(0);
+    entry->render(buffer, 0x1234, true, false);
+    ASSERT_EQ(wire_.getLength(), buffer.getLength());
+    EXPECT_EQ(0, std::memcmp(wire_.getData(), buffer.getData(),
+                             wire_.getLength()));
+
+    // The ID and the RD/CD bits are replaced.
+    buffer.clear();
+    entry->render(buffer, 0xabcd, false, true);
+    Message parsed(Message::PARSE);
+    InputBuffer ibuffer(buffer.getData(), buffer.getLength());
+    parsed.fromWire(ibuffer);
+    EXPECT_EQ(0xabcd, parsed.getQid());
+    EXPECT_FALSE(parsed.getHeaderFlag(Message::HEADERFLAG_RD));
+    EXPECT_TRUE(parsed.getHeaderFlag(Message::HEADERFLAG_CD));
+    EXPECT_TRUE(parsed.getHeaderFlag(Message::HEADERFLAG_AA));
+    EXPECT_TRUE(parsed.getHeaderFlag(Message::HEADERFLAG_QR));
+    EXPECT_EQ(2, parsed.getRRCount(Message::SECTION_ANSWER));
+
+    // A response without answers has no summary.
+    Message empty(Message::RENDER);
+    empty.setRcode(Rcode::NXDOMAIN());
+    const ResponseCache::Entry empty_entry(empty, wire_.getData(),
+                                           wire_.getLength(),
+                                           Name("example.com"),
+                                           detail::RESPONSE_NXDOMAIN);
+    EXPECT_FALSE(empty_entry.getAnswerSummary());
+    EXPECT_FALSE(empty_entry.isAuthoritative());
+    EXPECT_EQ(Rcode::NXDOMAIN(), empty_entry.getRcode());
+
+    // Too short data is rejected.
+    EXPECT_THROW(ResponseCache::Entry(response_, wire_.getData(), 11,
+                                      Name("example.com"),
+                                      detail::RESPONSE_QUERY),
+                 bundy::InvalidParameter);
+}
+
+TEST_F(ResponseCacheTest, disabled) {
+    // By default the cache is disabled and nothing is cached.
+    EXPECT_EQ(0, cache_.getMaxEntries());
+    EXPECT_FALSE(cache_.insert(cache_.getGeneration(), question_, false,
+                               false, createEntry()));
+    EXPECT_EQ(0, cache_.getEntryCount());
+    EXPECT_FALSE(cache_.lookup(question_, false, false));
+}
+
+TEST_F(ResponseCacheTest, lookup) {
+    cache_.setMaxEntries(10);
+    const ResponseCache::ConstEntryPtr entry = createEntry();
+    EXPECT_TRUE(cache_.insert(cache_.getGeneration(), question_, false,
+                              false, entry));
+    EXPECT_EQ(1, cache_.getEntryCount());
+    EXPECT_EQ(entry, cache_.lookup(question_, false, false));
+
+    // EDNS and the DO bit are part of the key.
+    EXPECT_FALSE(cache_.lookup(question_, true, false));
+    EXPECT_FALSE(cache_.lookup(question_, true, true));
+
+    // So are the type and class.
+    EXPECT_FALSE(cache_.lookup(Question(question_.getName(), RRClass::IN(),
+                                        RRType::AAAA()), false, false));
+    EXPECT_FALSE(cache_.lookup(Question(question_.getName(), RRClass::CH(),
+                                        RRType::A()), false, false));
+
+    // The name is compared as is, including the case.
+    EXPECT_FALSE(cache_.lookup(Question(Name("WWW.example.com"),
+                                        RRClass::IN(), RRType::A()),
+                               false, false));
+
+    // Inserting it again replaces the old one.
+    const ResponseCache::ConstEntryPtr entry2 = createEntry();
+    EXPECT_TRUE(cache_.insert(cache_.getGeneration(), question_, false,
+                              false, entry2));
+    EXPECT_EQ(1, cache_.getEntryCount());
+    EXPECT_EQ(entry2, cache_.lookup(question_, false, false));
+
+    cache_.clear();
+    EXPECT_EQ(0, cache_.getEntryCount());
+    EXPECT_FALSE(cache_.lookup(question_, false, false));
+}
+
+TEST_F(ResponseCacheTest, lru) {
+    cache_.setMaxEntries(2);
+    const Question q1(Name("a.example.com"), RRClass::IN(), RRType::A());
+    const Question q2(Name("b.example.com"), RRClass::IN(), RRType::A());
+    const Question q3(Name("c.example.com"), RRClass::IN(), RRType::A());
+    EXPECT_TRUE(cache_.insert(cache_.getGeneration(), q1, false, false,
+                              createEntry()));
+    EXPECT_TRUE(cache_.insert(cache_.getGeneration(), q2, false, false,
+                              createEntry()));
+
+    // Using q1 makes q2 the least recently used one, so it's removed.
+    EXPECT_TRUE(cache_.lookup(q1, false, false));
+    EXPECT_TRUE(cache_.insert(cache_.getGeneration(), q3, false, false,
+                              createEntry()));
+    EXPECT_EQ(2, cache_.getEntryCount());
+    EXPECT_TRUE(cache_.lookup(q1, false, false));
+    EXPECT_FALSE(cache_.lookup(q2, false, false));
+    EXPECT_TRUE(cache_.lookup(q3, false, false));
+
+    // Shrinking the cache removes the least recently used ones.
+    cache_.setMaxEntries(1);
+    EXPECT_EQ(1, cache_.getEntryCount());
+    EXPECT_TRUE(cache_.lookup(q3, false, false));
+
+    // And disabling it removes everything.
+    cache_.setMaxEntries(0);
+    EXPECT_EQ(0, cache_.getEntryCount());
+}
+
+TEST_F(ResponseCacheTest, invalidate) {
+    cache_.setMaxEntries(10);
+    const Question q_apex(Name("example.com"), RRClass::IN(), RRType::SOA());
+    const Question q_sub(Name("a.b.example.com"), RRClass::IN(),
+                         RRType::A());
+    const Question q_other(Name("example.org"), RRClass::IN(), RRType::A());
+    const Question q_ch(Name("example.com"), RRClass::CH(), RRType::TXT());
+    const Question q_parent(Name("com"), RRClass::IN(), RRType::NS());
+    const Question* const questions[] = {
+        &q_apex, &q_sub, &q_other, &q_ch, &q_parent
+    };
+    for (size_t i = 0; i < sizeof(questions) / sizeof(questions[0]); ++i) {
+        EXPECT_TRUE(cache_.insert(cache_.getGeneration(), *questions[i],
+                                  false, false, createEntry()));
+    }
+    EXPECT_EQ(5, cache_.getEntryCount());
+
+    // Names at or under the origin of the class are removed (the case of the
+    // origin doesn't matter).
+    const uint64_t generation = cache_.getGeneration();
+    cache_.invalidate(Name("EXAMPLE.com"), RRClass::IN());
+    EXPECT_EQ(3, cache_.getEntryCount());
+    EXPECT_FALSE(cache_.lookup(q_apex, false, false));
+    EXPECT_FALSE(cache_.lookup(q_sub, false, false));
+    EXPECT_TRUE(cache_.lookup(q_other, false, false));
+    EXPECT_TRUE(cache_.lookup(q_ch, false, false));
+    EXPECT_TRUE(cache_.lookup(q_parent, false, false));
+
+    // A response built before the invalidation can't be inserted.
+    EXPECT_NE(generation, cache_.getGeneration());
+    EXPECT_FALSE(cache_.insert(generation, q_apex, false, false,
+                               createEntry()));
+    EXPECT_FALSE(cache_.lookup(q_apex, false, false));
+
+    // The root name removes all of the class.
+    cache_.invalidate(Name::ROOT_NAME(), RRClass::IN());
+    EXPECT_EQ(1, cache_.getEntryCount());
+    EXPECT_TRUE(cache_.lookup(q_ch, false, false));
+}
+
+}
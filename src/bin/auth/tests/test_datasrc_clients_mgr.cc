@@ -39,6 +39,7 @@ bundy::datasrc::ClientListMapPtr*
 TestMutex* FakeDataSrcClientsBuilder::map_mutex = NULL;
 TestMutex FakeDataSrcClientsBuilder::queue_mutex_copy;
 bool FakeDataSrcClientsBuilder::thread_waited = false;
+size_t FakeDataSrcClientsBuilder::zone_load_threads = 1;
 FakeDataSrcClientsBuilder::ExceptionFromWait
 FakeDataSrcClientsBuilder::thread_throw_on_wait =
     FakeDataSrcClientsBuilder::NOTHROW;
@@ -96,6 +97,7 @@ TestDataSrcClientsMgrBase::reconfigureHook() {
     assert(command_queue_.front().id == RECONFIGURE);
     try {
         clients_map_ = configureDataSource(command_queue_.front().params);
+        readers_.map.store(clients_map_.get());
     } catch (...) {}
 }
 
@@ -162,7 +162,8 @@ public:
         TestCondVar* cond,
         TestMutex* queue_mutex,
         bundy::datasrc::ClientListMapPtr* clients_map,
-        TestMutex* map_mutex, int wakeup_fd)
+        TestMutex* map_mutex, int wakeup_fd,
+        ZoneUpdatedCallback* = NULL, ClientListMapReaders* = NULL)
     {
         FakeDataSrcClientsBuilder::started = false;
         FakeDataSrcClientsBuilder::command_queue = command_queue;
@@ -178,6 +179,16 @@ public:
     void run() {
         FakeDataSrcClientsBuilder::started = true;
     }
+    void setZoneLoadThreads(size_t thread_count) {
+        FakeDataSrcClientsBuilder::zone_load_threads = thread_count;
+    }
+    ZoneLoadProgress getZoneLoadProgress() const {
+        const ZoneLoadProgress progress = { false, 0, 0 };
+        return (progress);
+    }
+
+    // Last value given to setZoneLoadThreads().
+    static size_t zone_load_threads;
 };
 
 // A fake thread class that doesn't really invoke thread but simply calls
@@ -34,7 +34,8 @@ ALLOWED_SEVERITIES = [ 'default',
                        'none' ]
 ALLOWED_DESTINATIONS = [ 'console',
                          'file',
-                         'syslog' ]
+                         'syslog',
+                         'binary' ]
 ALLOWED_STREAMS = [ 'stdout',
                     'stderr' ]
 
@@ -93,6 +94,13 @@ def check(config):
                                                   "output not set to any "
                                                   "filename for logger "
                                                   + name)
+                            elif destination == "binary" and\
+                                 ('output' not in output_option or\
+                                  output_option['output'] == ""):
+                                    errors.append("destination set to binary "
+                                                  "but output not set to any "
+                                                  "filename for logger "
+                                                  + name)
                             elif destination == "syslog" and\
                                  'output' not in output_option or\
                                  output_option['output'] == "":
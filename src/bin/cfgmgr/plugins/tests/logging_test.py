@@ -112,6 +112,15 @@ class LoggingConfCheckTest(unittest.TestCase):
                                             { 'destination': 'file' }
                                             ]}]}))
 
+    def test_logger_bad_binary_output(self):
+        self.assertEqual('destination set to binary but output not set to any filename for logger *',
+                         bundylogging.check({'loggers':
+                                          [{'name': '*',
+                                            'severity': 'INFO',
+                                            'output_options': [
+                                            { 'destination': 'binary' }
+                                            ]}]}))
+
     def test_logger_bad_syslog_output(self):
         self.assertEqual('destination set to syslog but output not set to any facility for logger *',
                          bundylogging.check({'loggers':
@@ -64,6 +64,7 @@ D2CfgMgr::D2CfgMgr() : DCfgMgrBase(DCfgContextBasePtr(new D2CfgContext())) {
     addToParseOrder("interface");
     addToParseOrder("ip_address");
     addToParseOrder("port");
+    addToParseOrder("ncr_format");
     addToParseOrder("tsig_keys");
     addToParseOrder("forward_ddns");
     addToParseOrder("reverse_ddns");
@@ -196,7 +197,8 @@ D2CfgMgr::createConfigParser(const std::string& config_id) {
     // Create parser instance based on element_id.
     bundy::dhcp::DhcpConfigParser* parser = NULL;
     if ((config_id == "interface")  ||
-        (config_id == "ip_address")) {
+        (config_id == "ip_address") ||
+        (config_id == "ncr_format")) {
         parser = new bundy::dhcp::StringParser(config_id,
                                              context->getStringStorage());
     } else if (config_id == "port") {
@@ -37,6 +37,10 @@ D2Process::D2Process(const char* name, IOServicePtr io_service)
     // Pass in IOService for NCR IO event processing.
     queue_mgr_.reset(new D2QueueMgr(getIoService()));
 
+    // Requests received for clients whose earlier requests are still
+    // queued replace the earlier ones, rather than each going to DNS.
+    queue_mgr_->setCoalesceRequests(true);
+
     // Instantiate update manager.
     // Pass in both queue manager and configuration manager.
     // Pass in IOService for DNS update transaction IO event processing.
@@ -325,7 +329,7 @@ D2Process::reconfigureQueueMgr() {
         queue_mgr_->removeListener();
 
         // Get the configuration parameters that affect Queue Manager.
-        // @todo Need to add parameters for listener TYPE, FORMAT, address reuse
+        // @todo Need to add parameters for listener TYPE, address reuse
         std::string ip_address;
         uint32_t port;
         getCfgMgr()->getContext()->getParam("ip_address", ip_address);
@@ -339,8 +343,15 @@ D2Process::reconfigureQueueMgr() {
         getCfgMgr()->getContext()->getParam("port", port);
         bundy::asiolink::IOAddress addr(ip_address);
 
+        // The format is optional and defaults to JSON.  Note that
+        // stringToNcrFormat throws if the format is not valid.
+        std::string ncr_format("JSON");
+        getCfgMgr()->getContext()->getParam("ncr_format", ncr_format, true);
+        dhcp_ddns::NameChangeFormat format =
+            dhcp_ddns::stringToNcrFormat(ncr_format);
+
         // Instantiate the listener.
-        queue_mgr_->initUDPListener(addr, port, dhcp_ddns::FMT_JSON, true);
+        queue_mgr_->initUDPListener(addr, port, format, true);
 
         // Now start it. This assumes that starting is a synchronous,
         // blocking call that executes quickly.  @todo Should that change then
@@ -16,6 +16,30 @@
 #include <d2/d2_queue_mgr.h>
 #include <dhcp_ddns/ncr_udp.h>
 
+namespace {
+
+/// @brief Returns true if the newer request supersedes the older one.
+///
+/// @param newer the request received last.
+/// @param older the request which is still queued.
+bool
+supersedes(const bundy::dhcp_ddns::NameChangeRequest& newer,
+           const bundy::dhcp_ddns::NameChangeRequest& older) {
+    // The requests must be for the same client, name and address.  The FQDN
+    // is known to be the same as the queued request was found by it.
+    if ((newer.getDhcid() != older.getDhcid()) ||
+        (newer.getIpAddress() != older.getIpAddress())) {
+        return (false);
+    }
+
+    // The newer request must change DNS in all the directions the older
+    // one does, or the older change would be lost.
+    return ((newer.isForwardChange() || !older.isForwardChange()) &&
+            (newer.isReverseChange() || !older.isReverseChange()));
+}
+
+}
+
 namespace bundy {
 namespace d2 {
 
@@ -24,7 +48,8 @@ const size_t D2QueueMgr::MAX_QUEUE_DEFAULT;
 
 D2QueueMgr::D2QueueMgr(IOServicePtr& io_service, const size_t max_queue_size)
     : io_service_(io_service), max_queue_size_(max_queue_size),
-      mgr_state_(NOT_INITTED), target_stop_state_(NOT_INITTED) {
+      mgr_state_(NOT_INITTED), target_stop_state_(NOT_INITTED),
+      coalesce_requests_(false) {
     if (!io_service_) {
         bundy_throw(D2QueueMgrError, "IOServicePtr cannot be null");
     }
@@ -49,7 +74,13 @@ D2QueueMgr::operator()(const dhcp_ddns::NameChangeListener::Result result,
         // state as well as our queue size.
         switch (result) {
         case dhcp_ddns::NameChangeListener::SUCCESS:
-            // Receive was successful, attempt to queue the request.
+            // Receive was successful. If the request supersedes one which
+            // is still queued, it simply takes the older one's place.
+            if (coalesce_requests_ && supersede(ncr)) {
+                return;
+            }
+
+            // Otherwise attempt to queue the request.
             if (getQueueSize() < getMaxQueueSize()) {
                 // There's room on the queue, add to the end
                 enqueue(ncr);
@@ -244,6 +275,31 @@ D2QueueMgr::clearQueue() {
     ncr_queue_.clear();
 }
 
+bool
+D2QueueMgr::supersede(dhcp_ddns::NameChangeRequestPtr& ncr) {
+    // Look through the queued requests for the same FQDN.
+    typedef RequestQueue::nth_index<1>::type FqdnIndex;
+    const FqdnIndex& idx = ncr_queue_.get<1>();
+    std::pair<FqdnIndex::const_iterator, FqdnIndex::const_iterator> range =
+        idx.equal_range(ncr->getFqdn());
+    for (FqdnIndex::const_iterator it = range.first; it != range.second;
+         ++it) {
+        if (supersedes(*ncr, **it)) {
+            LOG_DEBUG(dctl_logger, DBGLVL_TRACE_DETAIL_DATA,
+                      DHCP_DDNS_QUEUE_MGR_REQUEST_SUPERSEDED)
+                      .arg(ncr->getFqdn()).arg(ncr->getDhcid().toStr());
+
+            // Replace the older request, keeping its position in the queue.
+            // The FQDN is the same so the request stays where it is in
+            // the FQDN index too.
+            ncr_queue_.replace(ncr_queue_.project<0>(it), ncr);
+            return (true);
+        }
+    }
+
+    return (false);
+}
+
 void
 D2QueueMgr::setMaxQueueSize(const size_t new_queue_max) {
     if (new_queue_max < 1) {
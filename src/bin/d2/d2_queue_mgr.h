@@ -22,15 +22,35 @@
 #include <dhcp_ddns/ncr_msg.h>
 #include <dhcp_ddns/ncr_io.h>
 
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/indexed_by.hpp>
+#include <boost/multi_index/mem_fun.hpp>
+#include <boost/multi_index/random_access_index.hpp>
+#include <boost/multi_index_container.hpp>
 #include <boost/noncopyable.hpp>
-#include <deque>
 
 namespace bundy {
 namespace d2 {
 
 /// @brief Defines a queue of requests.
-/// @todo This may be replaced with an actual class in the future.
-typedef std::deque<dhcp_ddns::NameChangeRequestPtr> RequestQueue;
+///
+/// The requests are held in the order in which they were queued (the first
+/// index), and are also indexed by FQDN so that a newly received request
+/// can quickly find the queued requests for the same name.
+typedef boost::multi_index_container<
+    // The queue holds pointers to the requests.
+    dhcp_ddns::NameChangeRequestPtr,
+    boost::multi_index::indexed_by<
+        // First index is the position in the queue.
+        boost::multi_index::random_access<>,
+        // Second index is the FQDN of the request.
+        boost::multi_index::hashed_non_unique<
+            boost::multi_index::const_mem_fun<
+                dhcp_ddns::NameChangeRequest, const std::string,
+                &dhcp_ddns::NameChangeRequest::getFqdn>
+        >
+    >
+> RequestQueue;
 
 /// @brief Thrown if the queue manager encounters a general error.
 class D2QueueMgrError : public bundy::Exception {
@@ -129,6 +149,12 @@ public:
 /// D2QueueMgr does not attempt to recover from stopped conditions, this is left
 /// to upper layers.
 ///
+/// When request coalescing is enabled (see setCoalesceRequests()), a
+/// received request which supersedes a request still waiting in the queue
+/// takes the place of the older request instead of being added to the end.
+/// This collapses the requests generated for the same client during lease
+/// renewals, or when a client comes and goes, into a single DNS update.
+///
 /// It is important to note that the queue contents are preserved between
 /// state transitions.  In other words entries in the queue remain there
 /// until they are removed explicitly via the deque() or implicitly by
@@ -203,6 +229,9 @@ public:
     /// passed up to the D2QueueMgr for queueing.
     /// If the given result indicates a successful receive completion and
     /// there is room left in the queue, the given request is queued.
+    /// If request coalescing is enabled and the request supersedes one
+    /// which is still queued, it replaces the older request instead (see
+    /// supersede()), which doesn't require room in the queue.
     ///
     /// If the queue is at maximum capacity, stopListening() is invoked and
     /// the state is set to STOPPED_QUEUE_FULL.
@@ -319,6 +348,42 @@ public:
     /// @brief Removes all entries from the queue.
     void clearQueue();
 
+    /// @brief Replaces a queued request superseded by the given request.
+    ///
+    /// A request supersedes a queued request if both are for the same FQDN,
+    /// DHCID and lease address, and the new request calls for a change in
+    /// at least the directions (forward and reverse) of the queued one.
+    /// Carrying out only the new request then leaves DNS in the same state
+    /// as carrying out both of them in order: an add replaces the entries
+    /// of the client, whatever the queued request was, and a remove deletes
+    /// them.  The new request takes the position of the superseded request
+    /// in the queue.
+    ///
+    /// Requests for which transactions have been started are no longer in
+    /// the queue and are never superseded.
+    ///
+    /// @param ncr pointer to the newly received NameChangeRequest.
+    ///
+    /// @return true if a queued request has been replaced, false if the
+    /// given request supersedes none of the queued requests, in which case
+    /// the queue is left unchanged.
+    bool supersede(dhcp_ddns::NameChangeRequestPtr& ncr);
+
+    /// @brief Enables or disables the coalescing of received requests.
+    ///
+    /// @param coalesce_requests if true, the requests received from the
+    /// listener replace the queued requests they supersede.  Otherwise all
+    /// of them are added to the end of the queue.  Coalescing is disabled
+    /// by default.
+    void setCoalesceRequests(const bool coalesce_requests) {
+        coalesce_requests_ = coalesce_requests;
+    }
+
+    /// @brief Returns true if the received requests are coalesced.
+    bool getCoalesceRequests() const {
+        return (coalesce_requests_);
+    }
+
   private:
     /// @brief Sets the manager state to the target stop state.
     ///
@@ -343,6 +408,9 @@ public:
 
     /// @brief Tracks the state the manager should be in once stopped.
     State target_stop_state_;
+
+    /// @brief Indicates if the received requests are coalesced.
+    bool coalesce_requests_;
 };
 
 /// @brief Defines a pointer for manager instances.
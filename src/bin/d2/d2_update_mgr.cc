@@ -44,23 +44,27 @@ D2UpdateMgr::D2UpdateMgr(D2QueueMgrPtr& queue_mgr, D2CfgMgrPtr& cfg_mgr,
 
     // Use setter to do validation.
     setMaxTransactions(max_transactions);
+
+    // The sockets of the pool are opened as the updates need them.
+    socket_pool_.reset(new asiodns::FetchSocketPool(*io_service_));
 }
 
 D2UpdateMgr::~D2UpdateMgr() {
     transaction_list_.clear();
+    socket_pool_.reset();
 }
 
 void D2UpdateMgr::sweep() {
     // cleanup finished transactions;
     checkFinishedTransactions();
 
-    // if the queue isn't empty, find the next suitable job and
-    // start a transaction for it.
-    // @todo - Do we want to queue max transactions? The logic here will only
-    // start one new transaction per invocation.  On the other hand a busy
-    // system will generate many IO events and this method will be called
-    // frequently.  It will likely achieve max transactions quickly on its own.
-    if (getQueueCount() > 0)  {
+    // Start transactions for as many eligible jobs as the maximum number
+    // of transactions allows, so that the updates for a burst of requests
+    // are in flight at the same time rather than being started one per
+    // IO event. The queue is scanned once: the entries before the index
+    // are the ones whose DHCIDs already have transactions in progress.
+    size_t index = 0;
+    while (getQueueCount() > 0) {
         if (getTransactionCount() >= max_transactions_) {
             LOG_DEBUG(dctl_logger, DBGLVL_TRACE_DETAIL_DATA,
                       DHCP_DDNS_AT_MAX_TRANSACTIONS).arg(getQueueCount())
@@ -70,7 +74,12 @@ void D2UpdateMgr::sweep() {
         }
 
         // We are not at maximum transactions, so pick and start the next job.
-        pickNextJob();
+        if (!pickNextJob(index)) {
+            LOG_DEBUG(dctl_logger, DBGLVL_TRACE_DETAIL_DATA,
+                      DHCP_DDNS_NO_ELIGIBLE_JOBS)
+                      .arg(getQueueCount()).arg(getTransactionCount());
+            return;
+        }
     }
 }
 
@@ -98,26 +107,35 @@ D2UpdateMgr::checkFinishedTransactions() {
 }
 
 void D2UpdateMgr::pickNextJob() {
-    // Start at the front of the queue, looking for the first entry for
-    // which no transaction is in progress.  If we find an eligible entry
+    size_t index = 0;
+    if (!pickNextJob(index)) {
+        // There were no eligible jobs. All of the current DHCIDs already have
+        // transactions pending.
+        LOG_DEBUG(dctl_logger, DBGLVL_TRACE_DETAIL_DATA,
+                  DHCP_DDNS_NO_ELIGIBLE_JOBS)
+                  .arg(getQueueCount()).arg(getTransactionCount());
+    }
+}
+
+bool D2UpdateMgr::pickNextJob(size_t& index) {
+    // Start at the given position in the queue, looking for the first entry
+    // for which no transaction is in progress.  If we find an eligible entry
     // remove it from the queue and  make a transaction for it.
     // Requests and transactions are associated by DHCID.  If a request has
     // the same DHCID as a transaction, they are presumed to be for the same
     // "end user".
     size_t queue_count = getQueueCount();
-    for (size_t index = 0; index < queue_count; ++index) {
+    for (; index < queue_count; ++index) {
         dhcp_ddns::NameChangeRequestPtr found_ncr = queue_mgr_->peekAt(index);
         if (!hasTransaction(found_ncr->getDhcid())) {
+            // The index now refers to the entry following the dequeued one.
             queue_mgr_->dequeueAt(index);
             makeTransaction(found_ncr);
-            return;
+            return (true);
         }
     }
 
-    // There were no eligible jobs. All of the current DHCIDs already have
-    // transactions pending.
-    LOG_DEBUG(dctl_logger, DBGLVL_TRACE_DETAIL_DATA, DHCP_DDNS_NO_ELIGIBLE_JOBS)
-              .arg(getQueueCount()).arg(getTransactionCount());
+    return (false);
 }
 
 void
@@ -201,6 +219,9 @@ D2UpdateMgr::makeTransaction(dhcp_ddns::NameChangeRequestPtr& next_ncr) {
                                               forward_domain, reverse_domain));
     }
 
+    // Let the transaction send its updates from the shared sockets.
+    trans->setSocketPool(socket_pool_);
+
     // Add the new transaction to the list.
     transaction_list_[key] = trans;
 
@@ -114,12 +114,13 @@ public:
     ///
     /// - Removes all completed transactions from the transaction list.
     ///
-    /// - If the request queue is not empty and the number of transactions
-    /// in the transaction list has not reached maximum allowed, then select
-    /// a request from the queue.
+    /// - While the request queue is not empty and the number of transactions
+    /// in the transaction list has not reached maximum allowed, select
+    /// the next eligible request from the queue, start a new transaction
+    /// for it and add the transaction to the list of transactions.
     ///
-    /// - If a request was selected, start a new transaction for it and
-    /// add the transaction to the list of transactions.
+    /// Starting all of the transactions the limit allows in one invocation
+    /// keeps the updates for a burst of requests in flight concurrently.
     void sweep();
 
 protected:
@@ -145,6 +146,22 @@ protected:
     /// clients in quick succession.
     void pickNextJob();
 
+    /// @brief Starts a transaction for the next eligible request after the
+    /// given position in the queue.
+    ///
+    /// This variant is used by @c sweep to start several transactions in
+    /// a single scan of the queue.  The requests before the given position
+    /// are known to have transactions in progress and are skipped.
+    ///
+    /// @param[in,out] index position in the queue where the scan starts.
+    /// On return it holds the position of the request which followed the
+    /// dequeued one, or the queue size if no request was dequeued.
+    ///
+    /// @return true if a request was dequeued, false if there was no
+    /// eligible request.  Note that a dequeued request which can't be
+    /// matched to DNS servers is discarded rather than started.
+    bool pickNextJob(size_t& index);
+
     /// @brief Create a new transaction for the given request.
     ///
     /// This method will attempt to match the request to suitable DNS servers.
@@ -177,6 +194,13 @@ public:
         return (io_service_);
     }
 
+    /// @brief Gets the pool of sockets shared by the transactions.
+    ///
+    /// @return returns a reference to the pool.
+    const FetchSocketPoolPtr& getSocketPool() const {
+        return (socket_pool_);
+    }
+
     /// @brief Returns the maximum number of concurrent transactions.
     size_t getMaxTransactions() const {
         return (max_transactions_);
@@ -251,6 +275,14 @@ private:
     /// @brief Maximum number of concurrent transactions.
     size_t max_transactions_;
 
+    /// @brief Pool of sockets shared by the DNS updates of the transactions.
+    ///
+    /// Rather than each update opening and closing a socket of its own,
+    /// the updates are sent from a fixed set of sockets which are kept open,
+    /// and the responses are matched to the updates by server, message ID
+    /// and zone.
+    FetchSocketPoolPtr socket_pool_;
+
     /// @brief List of transactions.
     TransactionList transaction_list_;
 };
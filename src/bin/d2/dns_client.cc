@@ -60,6 +60,8 @@ public:
     DNSClient::Callback* callback_;
     // A Transport Layer protocol used to communicate with a DNS.
     DNSClient::Protocol proto_;
+    // An optional pool of sockets shared with other clients.
+    FetchSocketPoolPtr socket_pool_;
 
     // Constructor and Destructor
     DNSClientImpl(D2UpdateMessagePtr& response_placeholder,
@@ -88,7 +90,8 @@ DNSClientImpl::DNSClientImpl(D2UpdateMessagePtr& response_placeholder,
                              DNSClient::Callback* callback,
                              const DNSClient::Protocol proto)
     : in_buf_(new OutputBuffer(DEFAULT_BUFFER_SIZE)),
-      response_(response_placeholder), callback_(callback), proto_(proto) {
+      response_(response_placeholder), callback_(callback), proto_(proto),
+      socket_pool_() {
 
     // Response should be an empty pointer. It gets populated by the
     // operator() method.
@@ -205,6 +208,9 @@ DNSClientImpl::doUpdate(asiolink::IOService& io_service,
     // caller that the unsigned timeout value will fit into int.
     IOFetch io_fetch(IOFetch::UDP, io_service, msg_buf, ns_addr, ns_port,
                      in_buf_, this, static_cast<int>(wait));
+    if (socket_pool_) {
+        io_fetch.setSocketPool(*socket_pool_);
+    }
 
     // Post the task to the task queue in the IO service. Caller will actually
     // run these tasks by executing IOService::run.
@@ -227,6 +233,11 @@ DNSClient::getMaxTimeout() {
     return (max_timeout);
 }
 
+void
+DNSClient::setSocketPool(const FetchSocketPoolPtr& pool) {
+    impl_->socket_pool_ = pool;
+}
+
 void
 DNSClient::doUpdate(asiolink::IOService&,
                     const IOAddress&,
@@ -20,6 +20,7 @@
 #include <asiolink/io_service.h>
 #include <util/buffer.h>
 
+#include <asiodns/fetch_socket_pool.h>
 #include <asiodns/io_fetch.h>
 #include <dns/tsig.h>
 
@@ -29,6 +30,9 @@ namespace d2 {
 class DNSClient;
 typedef boost::shared_ptr<DNSClient> DNSClientPtr;
 
+/// @brief Defines a pointer to the pool of sockets shared by DNS Updates.
+typedef boost::shared_ptr<asiodns::FetchSocketPool> FetchSocketPoolPtr;
+
 /// DNSClient class implementation.
 class DNSClientImpl;
 
@@ -128,6 +132,18 @@ public:
     /// @return maximal allowed timeout value accepted by @c DNSClient::doUpdate
     static unsigned int getMaxTimeout();
 
+    /// @brief Sets the pool of sockets used to send the DNS Updates.
+    ///
+    /// By default, each message exchange opens a socket of its own and
+    /// closes it when the exchange is complete.  With a pool, the updates
+    /// are sent from (and the responses read on) the sockets of the pool
+    /// instead, which are shared with the other clients using it.  The pool
+    /// must be created on the IO service passed to @c doUpdate.
+    ///
+    /// @param pool Pointer to the pool to use.  An empty pointer restores
+    /// the default behavior.
+    void setSocketPool(const FetchSocketPoolPtr& pool);
+
     /// @brief Start asynchronous DNS Update with TSIG.
     ///
     /// This function starts asynchronous DNS Update and returns. The DNS Update
@@ -62,6 +62,7 @@ std::ostream& operator<<(std::ostream& os, const LabeledValue& vlp) {
 /**************************** LabeledValueSet ****************************/
 
 const char* LabeledValueSet::UNDEFINED_LABEL = "UNDEFINED";
+const int LabeledValueSet::MAX_INDEXED_VALUE;
 
 LabeledValueSet::LabeledValueSet(){
 }
@@ -83,6 +84,12 @@ LabeledValueSet::add(LabeledValuePtr entry) {
         }
 
     map_[entry->getValue()]=entry;
+    if (value >= 0 && value <= MAX_INDEXED_VALUE) {
+        if (static_cast<size_t>(value) >= index_.size()) {
+            index_.resize(value + 1, NULL);
+        }
+        index_[value] = entry.get();
+    }
 }
 
 void
@@ -104,16 +111,14 @@ LabeledValueSet::get(int value) {
 
 bool
 LabeledValueSet::isDefined(const int value) const {
-    LabeledValueMap::const_iterator it = map_.find(value);
-    return (it != map_.end());
+    return (find(value) != NULL);
 }
 
 std::string
 LabeledValueSet::getLabel(const int value) const {
-    LabeledValueMap::const_iterator it = map_.find(value);
-    if (it != map_.end()) {
-        const LabeledValuePtr& ptr = (*it).second;
-        return (ptr->getLabel());
+    const LabeledValue* entry = find(value);
+    if (entry) {
+        return (entry->getLabel());
     }
 
     return (std::string(UNDEFINED_LABEL));
@@ -21,6 +21,7 @@
 #include <ostream>
 #include <string>
 #include <map>
+#include <vector>
 
 /// @file labeled_value.h This file defines classes: LabeledValue and
 /// LabeledValueSet.
@@ -124,6 +125,9 @@ public:
     /// @brief Defines a text label returned by when value is not found.
     static const char* UNDEFINED_LABEL;
 
+    /// @brief The largest value found through an array rather than the map.
+    static const int MAX_INDEXED_VALUE = 255;
+
     /// @brief Constructor
     ///
     /// Constructs an empty set.
@@ -159,6 +163,23 @@ public:
     /// pointer is empty.
     const LabeledValuePtr& get(int value);
 
+    /// @brief Fetches the entry associated with value
+    ///
+    /// This doesn't copy the pointer of the entry, and values from 0 to
+    /// MAX_INDEXED_VALUE are found by indexing an array.
+    ///
+    /// @param value is the value of the entry desired.
+    ///
+    /// @return The entry, or NULL if the value is undefined.
+    const LabeledValue* find(const int value) const {
+        if (value >= 0 && value <= MAX_INDEXED_VALUE) {
+            return (static_cast<size_t>(value) < index_.size() ?
+                    index_[value] : NULL);
+        }
+        LabeledValueMap::const_iterator it = map_.find(value);
+        return (it != map_.end() ? it->second.get() : NULL);
+    }
+
     /// @brief Tests if the set contains an entry for the given value.
     ///
     /// @param value is the value of the entry to test.
@@ -177,6 +198,10 @@ public:
 private:
     /// @brief The map of labeled values.
     LabeledValueMap map_;
+
+    /// @brief The entries of the values from 0 to MAX_INDEXED_VALUE, by
+    /// value, NULL for the undefined ones.
+    std::vector<const LabeledValue*> index_;
 };
 
 } // namespace bundy::d2
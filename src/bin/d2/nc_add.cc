@@ -17,7 +17,6 @@
 #include <d2/nc_add.h>
 
 #include <boost/function.hpp>
-#include <boost/bind.hpp>
 
 #include <util/buffer.h>
 #include <dns/rdataclass.h>
@@ -84,28 +83,28 @@ NameAddTransaction::defineStates() {
 
     // Define NameAddTransaction states.
     defineState(READY_ST, "READY_ST",
-             boost::bind(&NameAddTransaction::readyHandler, this));
+                &NameAddTransaction::readyHandler);
 
     defineState(SELECTING_FWD_SERVER_ST, "SELECTING_FWD_SERVER_ST",
-             boost::bind(&NameAddTransaction::selectingFwdServerHandler, this));
+                &NameAddTransaction::selectingFwdServerHandler);
 
     defineState(SELECTING_REV_SERVER_ST, "SELECTING_REV_SERVER_ST",
-             boost::bind(&NameAddTransaction::selectingRevServerHandler, this));
+                &NameAddTransaction::selectingRevServerHandler);
 
     defineState(ADDING_FWD_ADDRS_ST, "ADDING_FWD_ADDRS_ST",
-             boost::bind(&NameAddTransaction::addingFwdAddrsHandler, this));
+                &NameAddTransaction::addingFwdAddrsHandler);
 
     defineState(REPLACING_FWD_ADDRS_ST, "REPLACING_FWD_ADDRS_ST",
-             boost::bind(&NameAddTransaction::replacingFwdAddrsHandler, this));
+                &NameAddTransaction::replacingFwdAddrsHandler);
 
     defineState(REPLACING_REV_PTRS_ST, "REPLACING_REV_PTRS_ST",
-             boost::bind(&NameAddTransaction::replacingRevPtrsHandler, this));
+                &NameAddTransaction::replacingRevPtrsHandler);
 
     defineState(PROCESS_TRANS_OK_ST, "PROCESS_TRANS_OK_ST",
-             boost::bind(&NameAddTransaction::processAddOkHandler, this));
+                &NameAddTransaction::processAddOkHandler);
 
     defineState(PROCESS_TRANS_FAILED_ST, "PROCESS_TRANS_FAILED_ST",
-             boost::bind(&NameAddTransaction::processAddFailedHandler, this));
+                &NameAddTransaction::processAddFailedHandler);
 
 }
 void
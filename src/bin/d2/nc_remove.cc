@@ -17,7 +17,6 @@
 #include <d2/nc_remove.h>
 
 #include <boost/function.hpp>
-#include <boost/bind.hpp>
 
 namespace bundy {
 namespace d2 {
@@ -81,35 +80,28 @@ NameRemoveTransaction::defineStates() {
 
     // Define NameRemoveTransaction states.
     defineState(READY_ST, "READY_ST",
-                boost::bind(&NameRemoveTransaction::readyHandler, this));
+                &NameRemoveTransaction::readyHandler);
 
     defineState(SELECTING_FWD_SERVER_ST, "SELECTING_FWD_SERVER_ST",
-                boost::bind(&NameRemoveTransaction::selectingFwdServerHandler,
-                            this));
+                &NameRemoveTransaction::selectingFwdServerHandler);
 
     defineState(SELECTING_REV_SERVER_ST, "SELECTING_REV_SERVER_ST",
-                boost::bind(&NameRemoveTransaction::selectingRevServerHandler,
-                            this));
+                &NameRemoveTransaction::selectingRevServerHandler);
 
     defineState(REMOVING_FWD_ADDRS_ST, "REMOVING_FWD_ADDRS_ST",
-                boost::bind(&NameRemoveTransaction::removingFwdAddrsHandler,
-                            this));
+                &NameRemoveTransaction::removingFwdAddrsHandler);
 
     defineState(REMOVING_FWD_RRS_ST, "REMOVING_FWD_RRS_ST",
-                boost::bind(&NameRemoveTransaction::removingFwdRRsHandler,
-                            this));
+                &NameRemoveTransaction::removingFwdRRsHandler);
 
     defineState(REMOVING_REV_PTRS_ST, "REMOVING_REV_PTRS_ST",
-                boost::bind(&NameRemoveTransaction::removingRevPtrsHandler,
-                            this));
+                &NameRemoveTransaction::removingRevPtrsHandler);
 
     defineState(PROCESS_TRANS_OK_ST, "PROCESS_TRANS_OK_ST",
-                boost::bind(&NameRemoveTransaction::processRemoveOkHandler,
-                            this));
+                &NameRemoveTransaction::processRemoveOkHandler);
 
     defineState(PROCESS_TRANS_FAILED_ST, "PROCESS_TRANS_FAILED_ST",
-                boost::bind(&NameRemoveTransaction::processRemoveFailedHandler,
-                            this));
+                &NameRemoveTransaction::processRemoveFailedHandler);
 }
 
 void
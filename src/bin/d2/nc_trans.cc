@@ -15,6 +15,7 @@
 #include <d2/d2_log.h>
 #include <d2/nc_trans.h>
 #include <dns/rdata.h>
+#include <util/random/qid_gen.h>
 
 #include <sstream>
 
@@ -50,7 +51,8 @@ NameChangeTransaction(IOServicePtr& io_service,
                       DdnsDomainPtr& forward_domain,
                       DdnsDomainPtr& reverse_domain)
     : io_service_(io_service), ncr_(ncr), forward_domain_(forward_domain),
-     reverse_domain_(reverse_domain), dns_client_(), dns_update_request_(),
+     reverse_domain_(reverse_domain), dns_client_(), socket_pool_(),
+     dns_update_request_(),
      dns_update_status_(DNSClient::OTHER), dns_update_response_(),
      forward_change_completed_(false), reverse_change_completed_(false),
      current_server_list_(), current_server_(), next_server_pos_(0),
@@ -90,6 +92,11 @@ NameChangeTransaction::startTransaction() {
     startModel(READY_ST);
 }
 
+void
+NameChangeTransaction::setSocketPool(const FetchSocketPoolPtr& pool) {
+    socket_pool_ = pool;
+}
+
 void
 NameChangeTransaction::operator()(DNSClient::Status status) {
     // Stow the completion status and re-enter the run loop with the event
@@ -320,6 +327,10 @@ NameChangeTransaction::prepNewRequest(DdnsDomainPtr domain) {
         // Create a "blank" update request.
         D2UpdateMessagePtr request(new D2UpdateMessage(D2UpdateMessage::
                                                        OUTBOUND));
+        // Use a random message ID, so that the responses to the concurrent
+        // updates sharing the sockets of the pool can be told apart.
+        request->setId(util::random::QidGenerator::getInstance()
+                       .generateQid());
         // Construct the Zone Section.
         dns::Name zone_name(domain->getName());
         request->setZone(zone_name, dns::RRClass::IN());
@@ -439,6 +450,10 @@ NameChangeTransaction::selectNextServer() {
         // Once that is supported we need to add it here.
         dns_client_.reset(new DNSClient(dns_update_response_ , this,
                                         DNSClient::UDP));
+        if (socket_pool_) {
+            dns_client_->setSocketPool(socket_pool_);
+        }
+
         ++next_server_pos_;
         return (true);
     }
@@ -451,6 +466,11 @@ NameChangeTransaction::getDNSClient() const {
     return (dns_client_);
 }
 
+const FetchSocketPoolPtr&
+NameChangeTransaction::getSocketPool() const {
+    return (socket_pool_);
+}
+
 const DnsServerInfoPtr&
 NameChangeTransaction::getCurrentServer() const {
     return (current_server_);
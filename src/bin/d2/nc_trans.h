@@ -187,6 +187,17 @@ public:
     /// with the state handler for READY_ST.
     void startTransaction();
 
+    /// @brief Sets the pool of sockets used to send the DNS updates.
+    ///
+    /// The pool is passed to each DNSClient the transaction creates, so that
+    /// the updates of concurrent transactions share the sockets of the pool
+    /// rather than each opening its own.  It must be set before the
+    /// transaction is started.
+    ///
+    /// @param pool Pointer to the pool to use.  An empty pointer means each
+    /// update uses a socket of its own.
+    void setSocketPool(const FetchSocketPoolPtr& pool);
+
     /// @brief Serves as the DNSClient IO completion event handler.
     ///
     /// This is the implementation of the method inherited by our derivation
@@ -469,6 +480,12 @@ public:
     /// @return A const pointer reference to the DNSClient
     const DNSClientPtr& getDNSClient() const;
 
+    /// @brief Fetches the pool of sockets used to send the DNS updates.
+    ///
+    /// @return A const pointer reference to the pool, which is empty if
+    /// none has been set.
+    const FetchSocketPoolPtr& getSocketPool() const;
+
     /// @brief Fetches the current DNS update request packet.
     ///
     /// @return A const pointer reference to the current D2UpdateMessage
@@ -541,6 +558,9 @@ private:
     /// @brief The DNSClient instance that will carry out DNS packet exchanges.
     DNSClientPtr dns_client_;
 
+    /// @brief The pool of sockets shared by the DNS packet exchanges.
+    FetchSocketPoolPtr socket_pool_;
+
     /// @brief The DNS current update request packet.
     D2UpdateMessagePtr dns_update_request_;
 
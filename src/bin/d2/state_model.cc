@@ -15,15 +15,42 @@
 #include <d2/d2_log.h>
 #include <d2/state_model.h>
 
+#include <map>
+#include <sstream>
 #include <string>
+#include <typeindex>
+#include <utility>
 
 namespace bundy {
 namespace d2 {
 
+namespace {
+
+/// @brief Event and state dictionaries shared by the instances of a model
+/// class.
+typedef std::pair<boost::shared_ptr<LabeledValueSet>,
+                  boost::shared_ptr<StateSet> > SharedDictionaries;
+
+/// @brief Returns the shared dictionaries, by model class.
+///
+/// D2 runs the models in one thread, so this isn't locked.
+std::map<std::type_index, SharedDictionaries>&
+getSharedDictionaries() {
+    static std::map<std::type_index, SharedDictionaries> dictionaries;
+    return (dictionaries);
+}
+
+}
+
 /********************************** State *******************************/
 
 State::State(const int value, const std::string& label, StateHandler handler)
-        : LabeledValue(value, label), handler_(handler) {
+        : LabeledValue(value, label), handler_(handler), method_(NULL) {
+}
+
+State::State(const int value, const std::string& label,
+             StateHandlerMethod method)
+        : LabeledValue(value, label), method_(method) {
 }
 
 State::~State() {
@@ -31,12 +58,25 @@ State::~State() {
 
 void
 State::run() {
+    if (method_) {
+        bundy_throw(StateModelError, "State::run: state " << getLabel()
+                    << " needs a model to run its handler");
+    }
+    (handler_)();
+}
+
+void
+State::run(StateModel& model) const {
+    if (method_) {
+        (model.*method_)();
+    } else {
         (handler_)();
+    }
 }
 
 /********************************** StateSet *******************************/
 
-StateSet::StateSet() {
+StateSet::StateSet() : bound_handlers_(false) {
 }
 
 StateSet::~StateSet() {
@@ -49,7 +89,17 @@ StateSet::add(const int value, const std::string& label, StateHandler handler) {
     } catch (const std::exception& ex) {
         bundy_throw(StateModelError, "StateSet: cannot add state :" << ex.what());
     }
+    bound_handlers_ = true;
+}
 
+void
+StateSet::add(const int value, const std::string& label,
+              StateHandlerMethod method) {
+    try {
+        LabeledValueSet::add(LabeledValuePtr(new State(value, label, method)));
+    } catch (const std::exception& ex) {
+        bundy_throw(StateModelError, "StateSet: cannot add state :" << ex.what());
+    }
 }
 
 const StatePtr
@@ -81,7 +131,10 @@ const int StateModel::FAIL_EVT;
 
 const int StateModel::SM_DERIVED_EVENT_MIN;
 
-StateModel::StateModel() : events_(), states_(), dictionaries_initted_(false),
+StateModel::StateModel() : events_(new LabeledValueSet()),
+                          states_(new StateSet()),
+                          dictionaries_shared_(false),
+                          dictionaries_initted_(false),
                           curr_state_(NEW_ST), prev_state_(NEW_ST),
                           last_event_(NOP_EVT), next_event_(NOP_EVT),
                           on_entry_flag_(false), on_exit_flag_(false) {
@@ -116,7 +169,12 @@ StateModel::runModel(unsigned int run_event) {
             // Invoke the current state's handler.  It should consume the
             // next event, then determine what happens next by setting
             // current state and/or the next event.
-            getState(curr_state_)->run();
+            const State* state = states_->findState(curr_state_);
+            if (!state) {
+                bundy_throw(StateModelError,
+                            "State value is not defined:" << curr_state_);
+            }
+            state->run(*this);
 
             // Keep going until a handler sets next event to a NOP_EVT.
         } while (!isModelDone() && getNextEvent() != NOP_EVT);
@@ -137,6 +195,25 @@ StateModel::nopStateHandler() {
 
 void
 StateModel::initDictionaries() {
+    // Shared dictionaries are complete, there is nothing left to build.
+    if (dictionaries_shared_) {
+        return;
+    }
+
+    // Use the dictionaries built by another instance of the class if there
+    // are some, and this instance didn't start building its own.
+    const std::type_index model_class(typeid(*this));
+    std::map<std::type_index, SharedDictionaries>::const_iterator shared =
+        getSharedDictionaries().find(model_class);
+    if (shared != getSharedDictionaries().end() &&
+        !events_->isDefined(NOP_EVT) && !states_->isDefined(NEW_ST)) {
+        events_ = shared->second.first;
+        states_ = shared->second.second;
+        dictionaries_shared_ = true;
+        dictionaries_initted_ = true;
+        return;
+    }
+
     // First let's build and verify the dictionary of events.
     try {
         defineEvents();
@@ -153,21 +230,40 @@ StateModel::initDictionaries() {
         bundy_throw(StateModelError, "State set is invalid: " << ex.what());
     }
 
+    // Let the other instances of the class use the dictionaries, unless
+    // some states are handled by methods bound to this instance.
+    if (!states_->hasBoundHandlers()) {
+        getSharedDictionaries()[model_class] =
+            SharedDictionaries(events_, states_);
+        dictionaries_shared_ = true;
+    }
+
     // Record that we are good to go.
     dictionaries_initted_ = true;
 }
 
 void
-StateModel::defineEvent(unsigned int event_value, const std::string& label) {
+StateModel::checkDictionariesModifiable(const std::string& what) const {
     if (!isModelNew()) {
         // Don't allow for self-modifying models.
-        bundy_throw(StateModelError, "Events may only be added to a new model."
-                   << event_value << " - " << label);
+        bundy_throw(StateModelError, what << " may only be added to a new "
+                    "model.");
     }
+    if (dictionaries_shared_) {
+        bundy_throw(StateModelError, what << " may not be added to "
+                    "dictionaries shared with other models.");
+    }
+}
+
+void
+StateModel::defineEvent(unsigned int event_value, const std::string& label) {
+    std::ostringstream what;
+    what << "Event " << event_value << " - " << label;
+    checkDictionariesModifiable(what.str());
 
     // Attempt to add the event to the set.
     try {
-        events_.add(event_value, label);
+        events_->add(event_value, label);
     } catch (const std::exception& ex) {
         bundy_throw(StateModelError, "Error adding event: " << ex.what());
     }
@@ -175,26 +271,39 @@ StateModel::defineEvent(unsigned int event_value, const std::string& label) {
 
 const EventPtr&
 StateModel::getEvent(unsigned int event_value) {
-    if (!events_.isDefined(event_value)) {
+    if (!events_->isDefined(event_value)) {
         bundy_throw(StateModelError,
                   "Event value is not defined:" << event_value);
     }
 
-    return (events_.get(event_value));
+    return (events_->get(event_value));
 }
 
 void
 StateModel::defineState(unsigned int state_value, const std::string& label,
     StateHandler handler) {
-    if (!isModelNew()) {
-        // Don't allow for self-modifying maps.
-        bundy_throw(StateModelError, "States may only be added to a new model."
-                   << state_value << " - " << label);
+    std::ostringstream what;
+    what << "State " << state_value << " - " << label;
+    checkDictionariesModifiable(what.str());
+
+    // Attempt to add the state to the set.
+    try {
+        states_->add(state_value, label, handler);
+    } catch (const std::exception& ex) {
+        bundy_throw(StateModelError, "Error adding state: " << ex.what());
     }
+}
+
+void
+StateModel::defineState(unsigned int state_value, const std::string& label,
+                        StateHandlerMethod handler) {
+    std::ostringstream what;
+    what << "State " << state_value << " - " << label;
+    checkDictionariesModifiable(what.str());
 
     // Attempt to add the state to the set.
     try {
-        states_.add(state_value, label, handler);
+        states_->add(state_value, label, handler);
     } catch (const std::exception& ex) {
         bundy_throw(StateModelError, "Error adding state: " << ex.what());
     }
@@ -202,12 +311,12 @@ StateModel::defineState(unsigned int state_value, const std::string& label,
 
 const StatePtr
 StateModel::getState(unsigned int state_value) {
-    if (!states_.isDefined(state_value)) {
+    if (!states_->isDefined(state_value)) {
         bundy_throw(StateModelError,
                   "State value is not defined:" << state_value);
     }
 
-    return (states_.getState(state_value));
+    return (states_->getState(state_value));
 }
 
 void
@@ -228,10 +337,8 @@ StateModel::verifyEvents() {
 
 void
 StateModel::defineStates() {
-    defineState(NEW_ST, "NEW_ST",
-                boost::bind(&StateModel::nopStateHandler, this));
-    defineState(END_ST, "END_ST",
-                boost::bind(&StateModel::nopStateHandler, this));
+    defineState(NEW_ST, "NEW_ST", &StateModel::nopStateHandler);
+    defineState(END_ST, "END_ST", &StateModel::nopStateHandler);
 }
 
 void
@@ -267,7 +374,7 @@ StateModel::abortModel(const std::string& explanation) {
 
 void
 StateModel::setState(unsigned int state) {
-    if (state != END_ST && !states_.isDefined(state)) {
+    if (state != END_ST && !states_->isDefined(state)) {
         bundy_throw(StateModelError,
                   "Attempt to set state to an undefined value: " << state );
     }
@@ -286,7 +393,7 @@ void
 StateModel::postNextEvent(unsigned int event_value) {
     // Check for FAIL_EVT as special case of model error before events are
     // defined.
-    if (event_value != FAIL_EVT && !events_.isDefined(event_value)) {
+    if (event_value != FAIL_EVT && !events_->isDefined(event_value)) {
         bundy_throw(StateModelError,
                   "Attempt to post an undefined event, value: " << event_value);
     }
@@ -355,12 +462,12 @@ StateModel::didModelFail() const {
 
 std::string
 StateModel::getStateLabel(const int state) const {
-    return (states_.getLabel(state));
+    return (states_->getLabel(state));
 }
 
 std::string
 StateModel::getEventLabel(const int event) const {
-    return (events_.getLabel(event));
+    return (events_->getLabel(event));
 }
 
 std::string
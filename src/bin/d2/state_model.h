@@ -46,6 +46,15 @@ typedef LabeledValuePtr EventPtr;
 /// @brief Defines a pointer to an instance method for handling a state.
 typedef boost::function<void()> StateHandler;
 
+class StateModel;
+
+/// @brief Defines a pointer to a method of a model class for handling a
+/// state.
+///
+/// Unlike a StateHandler, it isn't bound to an instance, so the states
+/// using it can be shared by all the instances of the model class.
+typedef void (StateModel::*StateHandlerMethod)();
+
 /// @brief Defines a State within the State Model.
 ///
 /// This class provides the means to define a state within a set or dictionary
@@ -71,15 +80,41 @@ public:
     /// @throw StateModelError if label is null or blank.
     State(const int value, const std::string& label, StateHandler handler);
 
+    /// @brief Constructor
+    ///
+    /// @param value is the numeric value of the state
+    /// @param label is the text label to assign to the state
+    /// @param method is the model method which handles the state's action.
+    ///
+    /// @throw StateModelError if label is null or blank.
+    State(const int value, const std::string& label,
+          StateHandlerMethod method);
+
     /// @brief Destructor
     virtual ~State();
 
-    /// @brief Invokes the State's handler.
+    /// @brief Invokes the State's bound handler.
+    ///
+    /// @throw StateModelError if the state has a handler method instead.
     void run();
 
+    /// @brief Invokes the State's handler for a model.
+    ///
+    /// @param model is the model a handler method is invoked on; it is
+    /// ignored by a bound handler.
+    void run(StateModel& model) const;
+
+    /// @brief Returns true if the handler is bound to an instance.
+    bool isBound() const {
+        return (!method_);
+    }
+
 private:
     /// @brief Bound instance method pointer to the state's handler method.
     StateHandler handler_;
+
+    /// @brief Model method handling the state, NULL if it is bound.
+    StateHandlerMethod method_;
 };
 
 /// @brief Defines a shared pointer to a State.
@@ -108,6 +143,35 @@ public:
     /// if the label is null or blank.
     void add(const int value, const std::string& label, StateHandler handler);
 
+    /// @brief Adds a state definition to the set of states.
+    ///
+    /// @param value is the numeric value of the state
+    /// @param label is the text label to assig to the state
+    /// @param method is the model method which handles the state's action.
+    ///
+    /// @throw StateModelError if the value is already defined in the set, or
+    /// if the label is null or blank.
+    void add(const int value, const std::string& label,
+             StateHandlerMethod method);
+
+    /// @brief Returns true if any state has a handler bound to an instance.
+    ///
+    /// Such a set belongs to one model instance.
+    bool hasBoundHandlers() const {
+        return (bound_handlers_);
+    }
+
+    /// @brief Fetches a state for the given value without copying its
+    /// pointer.
+    ///
+    /// @param value the numeric value of the state desired
+    ///
+    /// @return The state, or NULL if the value is undefined.
+    const State* findState(const int value) const {
+        // Only states are added to the set.
+        return (static_cast<const State*>(find(value)));
+    }
+
     /// @brief Fetches a state for the given value.
     ///
     /// @param value the numeric value of the state desired
@@ -117,6 +181,10 @@ public:
     ///
     /// @throw StateModelError if the value is undefined.
     const StatePtr getState(int value);
+
+private:
+    /// @brief True if any state has a handler bound to an instance.
+    bool bound_handlers_;
 };
 
 /// @brief Implements a finite state machine.
@@ -214,6 +282,13 @@ public:
 /// derivation hierarchy.  This allows each layer to define additional events
 /// and states.
 ///
+/// When all the states are defined with handler methods of the model class
+/// (rather than handlers bound to the instance), the dictionaries are only
+/// built by the first instance of the class: they are then shared by all
+/// the instances of the class, which need neither build nor copy them.
+/// Models like the DNS update transactions, which are created for each
+/// request, should thus use handler methods.
+///
 /// Once the dictionaries have been properly initialized, the startModel method
 /// invokes runModel with an event of START_EVT.  From this point forward and
 /// until the model reaches the END_ST or fails, it is considered to be
@@ -325,7 +400,9 @@ protected:
     /// @brief Initializes the event and state dictionaries.
     ///
     /// This method invokes the define and verify methods for both events and
-    /// states to initialize their respective dictionaries. 
+    /// states to initialize their respective dictionaries.  If another
+    /// instance of the same class already built dictionaries which can be
+    /// shared, these are used instead.
     ///
     /// @throw StateModelError or others indirectly, as this method calls
     /// dictionary define and verify methods.
@@ -415,7 +492,7 @@ protected:
     ///
     ///     // Add the states defined by the derivation.
     ///     defineState(SOME_ST, "SOME_ST",
-    ///                 boost::bind(&StateModelDerivation::someHandler, this));
+    ///                 &StateModelDerivation::someHandler);
     ///     :
     /// }
     /// @endcode
@@ -434,6 +511,30 @@ protected:
     void defineState(unsigned int value, const std::string& label,
                      StateHandler handler);
 
+    /// @brief Adds an state value and associated label to the set of states.
+    ///
+    /// The handler is a method of the model class rather than bound to the
+    /// instance, which allows the dictionaries to be shared.
+    ///
+    /// @param value is the numeric value of the state
+    /// @param label is the text label of the state used in log messages and
+    /// exceptions.
+    /// @param handler is the method which implements the state's actions.
+    ///
+    /// @throw StateModelError if the model has already been started, if
+    /// the value is already defined, or if the label is empty.
+    void defineState(unsigned int value, const std::string& label,
+                     StateHandlerMethod handler);
+
+    /// @brief Adds an state value and associated label to the set of states.
+    ///
+    /// This converts a handler method of a derived class.
+    template <typename ModelType>
+    void defineState(unsigned int value, const std::string& label,
+                     void (ModelType::*handler)()) {
+        defineState(value, label, static_cast<StateHandlerMethod>(handler));
+    }
+
     /// @brief Fetches the state referred to by value.
     ///
     /// @param value is the numeric value of the state desired.
@@ -643,11 +744,21 @@ public:
     std::string getPrevContextStr() const;
 
 private:
+    /// @brief Throws StateModelError if the dictionaries can't be modified.
+    ///
+    /// @param what is the kind and value of the entry to add, for the
+    /// error message.
+    void checkDictionariesModifiable(const std::string& what) const;
+
     /// @brief The dictionary of valid events.
-    LabeledValueSet events_;
+    boost::shared_ptr<LabeledValueSet> events_;
 
     /// @brief The dictionary of valid states.
-    StateSet states_;
+    boost::shared_ptr<StateSet> states_;
+
+    /// @brief Indicates if the dictionaries are shared with other instances,
+    /// in which case they can't be modified.
+    bool dictionaries_shared_;
 
     /// @brief Indicates if the event and state dictionaries have been initted.
     bool dictionaries_initted_;
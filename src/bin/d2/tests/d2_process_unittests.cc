@@ -38,6 +38,7 @@ const char* bad_ip_d2_config = "{ "
                         "\"interface\" : \"eth1\" , "
                         "\"ip_address\" : \"1.1.1.1\" , "
                         "\"port\" : 5031, "
+                        "\"ncr_format\" : \"JSON\" , "
                         "\"tsig_keys\": ["
                         "{ \"name\": \"d2_key.tmark.org\" , "
                         "   \"algorithm\": \"md5\" ,"
@@ -161,6 +162,9 @@ TEST(D2Process, construction) {
     D2QueueMgrPtr queue_mgr = d2process.getD2QueueMgr();
     ASSERT_TRUE(queue_mgr);
 
+    // Verify that the received requests are coalesced.
+    EXPECT_TRUE(queue_mgr->getCoalesceRequests());
+
     const D2UpdateMgrPtr& update_mgr = d2process.getD2UpdateMgr();
     ASSERT_TRUE(update_mgr);
 }
@@ -610,6 +614,7 @@ TEST_F(D2ProcessTest, notLoopbackTest) {
                         "\"interface\" : \"\" , "
                         "\"ip_address\" : \"0.0.0.0\" , "
                         "\"port\" : 53001, "
+                        "\"ncr_format\" : \"JSON\" , "
                         "\"tsig_keys\": [],"
                         "\"forward_ddns\" : {},"
                         "\"reverse_ddns\" : {}"
@@ -629,6 +634,7 @@ TEST_F(D2ProcessTest, v4LoopbackTest) {
                         "\"interface\" : \"\" , "
                         "\"ip_address\" : \"127.0.0.1\" , "
                         "\"port\" : 53001, "
+                        "\"ncr_format\" : \"JSON\" , "
                         "\"tsig_keys\": [],"
                         "\"forward_ddns\" : {},"
                         "\"reverse_ddns\" : {}"
@@ -643,6 +649,7 @@ TEST_F(D2ProcessTest, v6LoopbackTest) {
                         "\"interface\" : \"\" , "
                         "\"ip_address\" : \"::1\" , "
                         "\"port\" : 53001, "
+                        "\"ncr_format\" : \"JSON\" , "
                         "\"tsig_keys\": [],"
                         "\"forward_ddns\" : {},"
                         "\"reverse_ddns\" : {}"
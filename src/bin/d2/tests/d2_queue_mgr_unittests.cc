@@ -197,6 +197,109 @@ TEST(D2QueueMgrBasicTest, basicQueue) {
                  D2QueueMgrInvalidIndex);
 }
 
+/// @brief Tests QueueMgr's replacement of superseded requests.
+/// This test verifies that:
+/// 1. A request replaces a queued request for the same FQDN, DHCID and
+/// address, keeping its position in the queue, whatever the change types.
+/// 2. A request doesn't replace a queued request for another DHCID or
+/// address, or one whose change in a direction it doesn't make.
+TEST(D2QueueMgrBasicTest, supersede) {
+    IOServicePtr io_service(new bundy::asiolink::IOService());
+    D2QueueMgrPtr queue_mgr;
+    ASSERT_NO_THROW(queue_mgr.reset(new D2QueueMgr(io_service)));
+
+    // Queue an add, and the IPv6 add for the same FQDN and DHCID.
+    NameChangeRequestPtr add_ncr;
+    ASSERT_NO_THROW(add_ncr = NameChangeRequest::fromJSON(valid_msgs[0]));
+    NameChangeRequestPtr add6_ncr;
+    ASSERT_NO_THROW(add6_ncr = NameChangeRequest::fromJSON(valid_msgs[2]));
+    ASSERT_NO_THROW(queue_mgr->enqueue(add_ncr));
+    ASSERT_NO_THROW(queue_mgr->enqueue(add6_ncr));
+
+    // Verify that a request for another DHCID supersedes none.
+    NameChangeRequestPtr ncr;
+    ASSERT_NO_THROW(ncr = NameChangeRequest::fromJSON(valid_msgs[1]));
+    ncr->setDhcid("0102030405060708");
+    EXPECT_FALSE(queue_mgr->supersede(ncr));
+
+    // Verify that a request which doesn't make the forward change of the
+    // queued add doesn't supersede it.
+    ASSERT_NO_THROW(ncr = NameChangeRequest::fromJSON(valid_msgs[1]));
+    ncr->setForwardChange(false);
+    ncr->setReverseChange(true);
+    EXPECT_FALSE(queue_mgr->supersede(ncr));
+    EXPECT_EQ(2, queue_mgr->getQueueSize());
+
+    // Verify that the remove for the address of the first add replaces it,
+    // and leaves the IPv6 add in place.
+    NameChangeRequestPtr remove_ncr;
+    ASSERT_NO_THROW(remove_ncr = NameChangeRequest::fromJSON(valid_msgs[1]));
+    remove_ncr->setReverseChange(true);
+    EXPECT_TRUE(queue_mgr->supersede(remove_ncr));
+    ASSERT_EQ(2, queue_mgr->getQueueSize());
+    EXPECT_TRUE(queue_mgr->peekAt(0) == remove_ncr);
+    EXPECT_TRUE(queue_mgr->peekAt(1) == add6_ncr);
+
+    // Verify that an add replaces the remove in turn.
+    ASSERT_NO_THROW(ncr = NameChangeRequest::fromJSON(valid_msgs[0]));
+    ncr->setReverseChange(true);
+    EXPECT_TRUE(queue_mgr->supersede(ncr));
+    ASSERT_EQ(2, queue_mgr->getQueueSize());
+    EXPECT_TRUE(queue_mgr->peekAt(0) == ncr);
+
+    // Verify that once dequeued, a request is no longer superseded.
+    ASSERT_NO_THROW(queue_mgr->dequeue());
+    EXPECT_FALSE(queue_mgr->supersede(remove_ncr));
+    EXPECT_EQ(1, queue_mgr->getQueueSize());
+}
+
+/// @brief Tests QueueMgr's coalescing of received requests.
+/// This test verifies that:
+/// 1. Coalescing is disabled by default, and received requests are queued
+/// whether or not they supersede queued ones.
+/// 2. When enabled, received requests which supersede queued ones replace
+/// them, even when the queue is full.
+TEST(D2QueueMgrBasicTest, coalesceRequests) {
+    IOServicePtr io_service(new bundy::asiolink::IOService());
+    D2QueueMgrPtr queue_mgr;
+    ASSERT_NO_THROW(queue_mgr.reset(new D2QueueMgr(io_service, 2)));
+    EXPECT_FALSE(queue_mgr->getCoalesceRequests());
+
+    // Verify that the add and the remove for the same FQDN are both queued.
+    NameChangeRequestPtr ncr;
+    for (int i = 0; i < 2; ++i) {
+        ASSERT_NO_THROW(ncr = NameChangeRequest::fromJSON(valid_msgs[i]));
+        EXPECT_NO_THROW((*queue_mgr)(NameChangeListener::SUCCESS, ncr));
+    }
+    EXPECT_EQ(2, queue_mgr->getQueueSize());
+
+    // Enable coalescing on an emptied queue.
+    queue_mgr->setCoalesceRequests(true);
+    EXPECT_TRUE(queue_mgr->getCoalesceRequests());
+    queue_mgr->clearQueue();
+
+    // Verify that the remove replaces the add.
+    for (int i = 0; i < 2; ++i) {
+        ASSERT_NO_THROW(ncr = NameChangeRequest::fromJSON(valid_msgs[i]));
+        EXPECT_NO_THROW((*queue_mgr)(NameChangeListener::SUCCESS, ncr));
+    }
+    ASSERT_EQ(1, queue_mgr->getQueueSize());
+    EXPECT_EQ(CHG_REMOVE, queue_mgr->peek()->getChangeType());
+
+    // Fill the queue with the IPv6 add.
+    ASSERT_NO_THROW(ncr = NameChangeRequest::fromJSON(valid_msgs[2]));
+    EXPECT_NO_THROW((*queue_mgr)(NameChangeListener::SUCCESS, ncr));
+    ASSERT_EQ(2, queue_mgr->getQueueSize());
+
+    // Verify that a duplicate of a queued request is absorbed although the
+    // queue is full.
+    ASSERT_NO_THROW(ncr = NameChangeRequest::fromJSON(valid_msgs[2]));
+    EXPECT_NO_THROW((*queue_mgr)(NameChangeListener::SUCCESS, ncr));
+    EXPECT_EQ(2, queue_mgr->getQueueSize());
+    EXPECT_TRUE(queue_mgr->peekAt(1) == ncr);
+    EXPECT_EQ(D2QueueMgr::NOT_INITTED, queue_mgr->getMgrState());
+}
+
 /// @brief Compares two NameChangeRequests for equality.
 bool checkSendVsReceived(NameChangeRequestPtr sent_ncr,
                          NameChangeRequestPtr received_ncr) {
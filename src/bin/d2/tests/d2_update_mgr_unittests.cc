@@ -123,6 +123,7 @@ public:
                   "\"interface\" : \"eth1\" , "
                   "\"ip_address\" : \"192.168.1.33\" , "
                   "\"port\" : 88 , "
+                  "\"ncr_format\" : \"JSON\" , "
                   "\"tsig_keys\": [] ,"
                   "\"forward_ddns\" : {"
                   "\"ddns_domains\": [ "
@@ -603,11 +604,11 @@ TEST_F(D2UpdateMgrTest, sweep) {
         EXPECT_NO_THROW(queue_mgr_->enqueue(canned_ncrs_[i]));
     }
 
-    // Invoke sweep canned_count_ times which should create a
-    // transaction for each canned ncr.
+    // Invoke sweep once which should create a transaction for each
+    // canned ncr.
+    EXPECT_NO_THROW(update_mgr_->sweep());
+    EXPECT_EQ(canned_count_, update_mgr_->getTransactionCount());
     for (int i = 0; i < canned_count_; i++) {
-        EXPECT_NO_THROW(update_mgr_->sweep());
-        EXPECT_EQ(i + 1, update_mgr_->getTransactionCount());
         EXPECT_TRUE(update_mgr_->hasTransaction(canned_ncrs_[i]->getDhcid()));
     }
 
@@ -665,6 +666,80 @@ TEST_F(D2UpdateMgrTest, sweep) {
     EXPECT_EQ(0, update_mgr_->getTransactionCount());
 }
 
+/// @brief Tests that sweep starts as many transactions as allowed.
+/// This test verifies that a single sweep:
+/// 1. Starts transactions for the queued requests up to the maximum
+/// number of transactions, leaving the remaining requests queued.
+/// 2. Skips the requests for DHCIDs with transactions in progress and
+/// starts the eligible requests queued behind them.
+TEST_F(D2UpdateMgrTest, sweepMultiple) {
+    // Ensure we have at least 4 canned requests with which to work.
+    ASSERT_TRUE(canned_count_ >= 4);
+
+    // Allow one transaction less than there are requests.
+    EXPECT_NO_THROW(update_mgr_->setMaxTransactions(canned_count_ - 1));
+
+    // Put each transaction on the queue.
+    for (int i = 0; i < canned_count_; i++) {
+        EXPECT_NO_THROW(queue_mgr_->enqueue(canned_ncrs_[i]));
+    }
+
+    // Verify that sweep starts the transactions for all but the last request.
+    EXPECT_NO_THROW(update_mgr_->sweep());
+    EXPECT_EQ(canned_count_ - 1, update_mgr_->getTransactionCount());
+    EXPECT_EQ(1, update_mgr_->getQueueCount());
+    for (int i = 0; i < canned_count_ - 1; i++) {
+        EXPECT_TRUE(update_mgr_->hasTransaction(canned_ncrs_[i]->getDhcid()));
+    }
+
+    // Queue up a request for a DHCID which has a transaction in progress
+    // and one which goes to a domain without a match.  Both are queued
+    // behind the remaining canned request.
+    dhcp_ddns::NameChangeRequestPtr
+        subsequent_ncr(new dhcp_ddns::NameChangeRequest(*(canned_ncrs_[0])));
+    EXPECT_NO_THROW(queue_mgr_->enqueue(subsequent_ncr));
+    dhcp_ddns::NameChangeRequestPtr
+        bogus_ncr(new dhcp_ddns::NameChangeRequest(*(canned_ncrs_[0])));
+    bogus_ncr->setDhcid("AABBCCDDEEFF");
+    bogus_ncr->setFqdn("bogus.forward.domain.com");
+    EXPECT_NO_THROW(queue_mgr_->enqueue(bogus_ncr));
+    EXPECT_EQ(3, update_mgr_->getQueueCount());
+
+    // Mark two of the transactions complete, leaving the transaction for
+    // the DHCID of the first request in progress.
+    completeTransaction(1, dhcp_ddns::ST_COMPLETED);
+    completeTransaction(2, dhcp_ddns::ST_COMPLETED);
+
+    // Verify that invoking sweep:
+    // 1. Starts the remaining canned request.
+    // 2. Leaves the request for the busy DHCID queued.
+    // 3. Discards the request with no matching domain.
+    EXPECT_NO_THROW(update_mgr_->sweep());
+    EXPECT_EQ(2, update_mgr_->getTransactionCount());
+    EXPECT_TRUE(update_mgr_->hasTransaction(canned_ncrs_[0]->getDhcid()));
+    EXPECT_TRUE(update_mgr_->hasTransaction(canned_ncrs_[3]->getDhcid()));
+    EXPECT_EQ(1, update_mgr_->getQueueCount());
+    EXPECT_TRUE(queue_mgr_->peek() == subsequent_ncr);
+}
+
+/// @brief Tests that the transactions share the update manager's sockets.
+TEST_F(D2UpdateMgrTest, socketPool) {
+    // The pool is created along with the manager.
+    ASSERT_TRUE(update_mgr_->getSocketPool());
+
+    ASSERT_NO_THROW(queue_mgr_->enqueue(canned_ncrs_[0]));
+    ASSERT_NO_THROW(queue_mgr_->enqueue(canned_ncrs_[1]));
+    ASSERT_NO_THROW(update_mgr_->sweep());
+    ASSERT_EQ(2, update_mgr_->getTransactionCount());
+
+    // Verify that each transaction was given the manager's pool.
+    for (TransactionList::iterator it = update_mgr_->transactionListBegin();
+         it != update_mgr_->transactionListEnd(); ++it) {
+        EXPECT_TRUE(it->second->getSocketPool() ==
+                    update_mgr_->getSocketPool());
+    }
+}
+
 /// @brief Tests integration of NameAddTransaction
 /// This test verifies that update manager can create and manage a
 /// NameAddTransaction from start to finish.  It utilizes a fake server
@@ -114,12 +114,13 @@ FauxServer::requestHandler(const asio::error_code& error,
     // The request parsed OK, so let's build a response.
     // We must use the QID we received in the response or IOFetch will
     // toss the response out, resulting in eventual timeout.
-    // We fill in the zone with data we know is from the "server".
+    // We echo the zone of the request, like a real server does, or the
+    // response would not be matched to the request on a pooled socket.
     dns::Message response(dns::Message::RENDER);
     response.setQid(request.getQid());
-    dns::Question question(dns::Name("response.example.com"),
-                           dns::RRClass::ANY(), dns::RRType::SOA());
-    response.addQuestion(question);
+    if (request.getRRCount(dns::Message::SECTION_QUESTION) > 0) {
+        response.addQuestion(*request.beginQuestion());
+    }
     response.setOpcode(dns::Opcode(dns::Opcode::UPDATE_CODE));
     response.setHeaderFlag(dns::Message::HEADERFLAG_QR, true);
 
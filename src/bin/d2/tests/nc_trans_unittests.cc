@@ -30,6 +30,8 @@
 #include <boost/bind.hpp>
 #include <gtest/gtest.h>
 
+#include <set>
+
 using namespace std;
 using namespace bundy;
 using namespace bundy::d2;
@@ -995,13 +997,43 @@ TEST_F(NameChangeTransactionTest, sendUpdate) {
     ASSERT_EQ(DNSClient::SUCCESS, name_change->getDnsUpdateStatus());
 
     // Verify that we have a response and it's Rcode is NOERROR,
-    // and the zone is as expected.
+    // and the zone is the one of the request.
     D2UpdateMessagePtr response = name_change->getDnsUpdateResponse();
     ASSERT_TRUE(response);
     ASSERT_EQ(dns::Rcode::NOERROR().getCode(), response->getRcode().getCode());
     D2ZonePtr zone = response->getZone();
     EXPECT_TRUE(zone);
-    EXPECT_EQ("response.example.com.", zone->getName().toText());
+    EXPECT_EQ("request.example.com.", zone->getName().toText());
+}
+
+/// @brief Tests sendUpdate method when the update is sent from the sockets
+/// of a pool.
+TEST_F(NameChangeTransactionTest, sendUpdatePooled) {
+    NameChangeStubPtr name_change;
+    ASSERT_NO_THROW(name_change = makeCannedTransaction());
+    ASSERT_NO_THROW(name_change->initDictionaries());
+
+    // The pool must be set before the server is selected, as it's passed
+    // to the DNSClient created for the server.
+    EXPECT_FALSE(name_change->getSocketPool());
+    FetchSocketPoolPtr pool(new asiodns::FetchSocketPool(*io_service_, 1));
+    ASSERT_NO_THROW(name_change->setSocketPool(pool));
+    EXPECT_TRUE(name_change->getSocketPool() == pool);
+    ASSERT_TRUE(name_change->selectFwdServer());
+
+    // Create a server and start it listening.
+    FauxServer server(*io_service_, *(name_change->getCurrentServer()));
+    server.receive (FauxServer::USE_RCODE, dns::Rcode::NOERROR());
+
+    // Build a valid request, call sendUpdate and process the response.
+    ASSERT_NO_FATAL_FAILURE(doOneExchange(name_change));
+
+    // Verify that the response was received on a socket of the pool.
+    ASSERT_EQ(DNSClient::SUCCESS, name_change->getDnsUpdateStatus());
+    EXPECT_EQ(1, pool->getUDPSocketCount());
+    D2UpdateMessagePtr response = name_change->getDnsUpdateResponse();
+    ASSERT_TRUE(response);
+    ASSERT_EQ(dns::Rcode::NOERROR().getCode(), response->getRcode().getCode());
 }
 
 /// @brief Tests the prepNewRequest method
@@ -1025,6 +1057,15 @@ TEST_F(NameChangeTransactionTest, prepNewRequest) {
     // valid input.
     ASSERT_NO_THROW(request = name_change->prepNewRequest(forward_domain_));
     checkZone(request, forward_domain_->getName());
+
+    // Verify that the requests are given random IDs, so that the responses
+    // to concurrent requests can be told apart.
+    std::set<uint16_t> ids;
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_NO_THROW(request = name_change->prepNewRequest(forward_domain_));
+        ids.insert(request->getId());
+    }
+    EXPECT_LT(1, ids.size());
 }
 
 /// @brief Tests the addLeaseAddressRData method
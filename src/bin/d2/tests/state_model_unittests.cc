@@ -836,4 +836,66 @@ TEST_F(StateModelTest, stateModelTest) {
     EXPECT_TRUE(getWorkCompleted());
 }
 
+
+/// @brief Minimal state model whose handlers are all member methods.
+///
+/// Its dictionaries are shared by all of its instances.
+class MethodStateModel : public StateModel {
+public:
+    /// @brief The only state of the model.
+    static const int READY_ST = SM_DERIVED_STATE_MIN + 1;
+
+    /// @brief Builds the dictionaries.
+    void init() {
+        initDictionaries();
+    }
+
+    /// @brief Ends the model on any event.
+    void readyHandler() {
+        endModel();
+    }
+
+    /// @brief Exposes the state lookup.
+    const StatePtr getReadyState() {
+        return (getState(READY_ST));
+    }
+
+    /// @brief Exposes the event definition.
+    void addEvent(unsigned int value, const std::string& label) {
+        defineEvent(value, label);
+    }
+
+protected:
+    virtual void defineStates() {
+        StateModel::defineStates();
+        defineState(READY_ST, "READY_ST", &MethodStateModel::readyHandler);
+    }
+};
+
+const int MethodStateModel::READY_ST;
+
+/// @brief Verifies that models with method handlers share their
+/// dictionaries, which can't be modified any more, and run with them.
+TEST(StateModelSharingTest, sharedDictionaries) {
+    MethodStateModel model1;
+    ASSERT_NO_THROW(model1.init());
+    MethodStateModel model2;
+    ASSERT_NO_THROW(model2.init());
+
+    // Both instances use the same state objects.
+    StatePtr state1;
+    ASSERT_NO_THROW(state1 = model1.getReadyState());
+    EXPECT_EQ(state1, model2.getReadyState());
+    EXPECT_EQ("READY_ST", model2.getStateLabel(MethodStateModel::READY_ST));
+
+    // The shared dictionaries can't be changed.
+    EXPECT_THROW(model2.addEvent(StateModel::SM_DERIVED_EVENT_MIN + 1,
+                                 "EXTRA_EVT"), StateModelError);
+
+    // Each instance runs the handler on itself.
+    ASSERT_NO_THROW(model2.startModel(MethodStateModel::READY_ST));
+    EXPECT_TRUE(model2.isModelDone());
+    EXPECT_TRUE(model1.isModelNew());
+}
+
 }
@@ -43,6 +43,12 @@
             }
           ]
         }
+      },
+      {
+        "item_name": "batch_window",
+        "item_type": "integer",
+        "item_optional": false,
+        "item_default": 0
       }
     ],
     "commands": [
@@ -174,6 +174,24 @@ class FakeUpdateSession:
             self.__msg.set_rcode(Rcode.REFUSED)
         return self.__msg
 
+class FakeUpdateBatch:
+    '''A fake update batch, emulating bundy.ddns.session.UpdateBatch.
+
+    commit() returns the given faked result.
+
+    '''
+    def __init__(self, faked_commit):
+        self.__faked_commit = faked_commit
+        self.sessions = 0
+        self.committed = False
+
+    def get_update_count(self):
+        return self.sessions
+
+    def commit(self):
+        self.committed = True
+        return self.__faked_commit
+
 class FakeKeyringModule:
     '''Fake the entire bundy.server_common.tsig_keyring module.'''
 
@@ -475,6 +493,18 @@ class TestDDNSServer(unittest.TestCase):
         acl = self.ddns_server._zone_config[(TEST_ZONE_NAME, TEST_RRCLASS)]
         self.assertEqual(ACCEPT, acl.execute(TEST_ACL_CONTEXT))
 
+    def test_batch_window_config(self):
+        # The batching is disabled by default
+        self.assertEqual(0, self.ddns_server._batch_window)
+        answer = self.ddns_server.config_handler({'batch_window': 20})
+        self.assertEqual((0, None), bundy.config.parse_answer(answer))
+        self.assertEqual(20, self.ddns_server._batch_window)
+
+        # A negative window is rejected, keeping the previous one
+        answer = self.ddns_server.config_handler({'batch_window': -1})
+        self.assertEqual(1, bundy.config.parse_answer(answer)[0])
+        self.assertEqual(20, self.ddns_server._batch_window)
+
     def test_secondary_zones_config(self):
         # By default it should be an empty list
         self.assertEqual(set(), self.ddns_server._secondary_zones)
@@ -724,6 +754,40 @@ class TestDDNSServer(unittest.TestCase):
         self.assertEqual({3: (socket, receiver)},
                          self.ddns_server._socksession_receivers)
 
+    def test_handle_session_batch(self):
+        """
+        Test the handle_session holds the requests when the batching is
+        enabled, until they are handled together.
+        """
+        socket = FakeSocket(3)
+        receiver = FakeSessionReceiver(socket)
+        param = (FakeSocket(4), ('127.0.0.1', 1234), ('127.0.0.1', 1235),
+                 'Some data')
+        receiver.pop = lambda: param
+        self.ddns_server._socksession_receivers = {3: (socket, receiver)}
+        self.ddns_server.handle_request = self.__hook
+        self.ddns_server.handle_batch = self.__hook
+        self.ddns_server._batch_window = 10
+
+        self.assertFalse(self.ddns_server.handle_session(3))
+        self.assertFalse(self.ddns_server.handle_session(3))
+        self.assertFalse(self.__hook_called)
+        self.assertEqual([param, param], self.ddns_server._pending_requests)
+        self.assertIsNotNone(self.ddns_server._batch_deadline)
+
+        self.ddns_server.handle_pending_requests()
+        self.assertEqual([param, param], self.__hook_called)
+        self.assertEqual([], self.ddns_server._pending_requests)
+        self.assertIsNone(self.ddns_server._batch_deadline)
+
+        # The requests are handled without waiting when enough are held
+        self.__hook_called = False
+        self.ddns_server.BATCH_REQUESTS = 2
+        self.ddns_server.handle_session(3)
+        self.assertFalse(self.__hook_called)
+        self.ddns_server.handle_session(3)
+        self.assertEqual([param, param], self.__hook_called)
+
     def test_handle_session_fail(self):
         """
         Test the handle_session removes (and closes) the socket and receiver
@@ -894,18 +958,28 @@ class TestDDNSSession(unittest.TestCase):
         self.check_session_start_forwarder_called()
         self.server._UpdateSessionClass = self.__fake_session_creator
         self.__faked_result = UPDATE_SUCCESS # will be returned by fake session
+        self.server._UpdateBatchClass = self.__fake_batch_creator
+        self.__faked_commit = True # will be returned by fake batch
+        self.__batch = None
         self.__sock = FakeSocket(-1)
 
     def tearDown(self):
         self.assertTrue(bundy.server_common.tsig_keyring.initialized)
         bundy.server_common.tsig_keyring = self.orig_tsig_keyring
 
-    def __fake_session_creator(self, req_message, client_addr, zone_config):
+    def __fake_session_creator(self, req_message, client_addr, zone_config,
+                               batch=None):
         # remember the passed message for possible inspection later.
         self.__req_message = req_message
+        if batch is not None:
+            batch.sessions += 1
         return FakeUpdateSession(req_message, client_addr, zone_config,
                                  self.__faked_result)
 
+    def __fake_batch_creator(self):
+        self.__batch = FakeUpdateBatch(self.__faked_commit)
+        return self.__batch
+
     def check_update_response(self, resp_wire, expected_rcode=Rcode.NOERROR,
                               tsig_ctx=None, tcp=False):
         '''Check if given wire data are valid form of update response.
@@ -976,6 +1050,58 @@ class TestDDNSSession(unittest.TestCase):
         # Update will be refused and dropped, with TSIG (doesn't matter though)
         self.check_session(UPDATE_DROP, ipv6=False, tsig_key=TEST_TSIG_KEY)
 
+    def test_handle_batch(self):
+        '''Requests to the same zone handled as a batch.'''
+        sock1 = FakeSocket(-1)
+        sock2 = FakeSocket(-2)
+        requests = [(sock1, TEST_SERVER6, TEST_CLIENT6, create_msg()),
+                    (sock2, TEST_SERVER4, TEST_CLIENT4, create_msg())]
+        self.__cc_session.clear_msg()
+        self.assertEqual(2, self.server.handle_batch(requests))
+        self.assertTrue(self.__batch.committed)
+        self.assertEqual(2, self.__batch.sessions)
+        for sock, client_addr in [(sock1, TEST_CLIENT6),
+                                  (sock2, TEST_CLIENT4)]:
+            self.assertEqual(client_addr, sock._sent_addr)
+            self.check_update_response(sock._sent_data)
+        # The zone is notified as updated once.
+        self.check_session_msg(UPDATE_SUCCESS)
+
+        # A single request is handled on its own, and a broken one is
+        # dropped.
+        self.__batch = None
+        sock1.clear()
+        self.__cc_session.clear_msg()
+        self.assertEqual(1, self.server.handle_batch(
+                [(sock1, TEST_SERVER6, TEST_CLIENT6, create_msg()),
+                 (sock2, TEST_SERVER6, TEST_CLIENT6, b'x' * 11)]))
+        self.assertIsNone(self.__batch)
+        self.check_update_response(sock1._sent_data)
+        self.check_session_msg(UPDATE_SUCCESS)
+
+        # If the batch can't be committed, the requests are handled again
+        # one by one.
+        self.__faked_commit = False
+        sock1.clear()
+        sock2.clear()
+        self.__cc_session.clear_msg()
+        self.assertEqual(2, self.server.handle_batch(requests))
+        self.assertTrue(self.__batch.committed)
+        self.check_update_response(sock1._sent_data)
+        self.check_update_response(sock2._sent_data)
+        self.assertEqual(4, len(self.__cc_session._sent_msg))
+
+        # Nothing is committed if all the requests fail.
+        self.__faked_result = UPDATE_ERROR
+        sock1.clear()
+        sock2.clear()
+        self.__cc_session.clear_msg()
+        self.assertEqual(2, self.server.handle_batch(requests))
+        self.assertFalse(self.__batch.committed)
+        self.check_update_response(sock1._sent_data, Rcode.REFUSED)
+        self.check_update_response(sock2._sent_data, Rcode.REFUSED)
+        self.check_session_msg(UPDATE_ERROR)
+
     def test_broken_request(self):
         # Message data too short
         s = self.__sock
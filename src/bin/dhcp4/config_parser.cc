@@ -171,20 +171,28 @@ public:
     /// @throw throws Unexpected if dynamic cast fails.
     void commit() {
         if (subnet_) {
-            Subnet4Ptr sub4ptr = boost::dynamic_pointer_cast<Subnet4>(subnet_);
-            if (!sub4ptr) {
-                // If we hit this, it is a programming error.
-                bundy_throw(Unexpected,
-                          "Invalid cast in Subnet4ConfigParser::commit");
-            }
+            bundy::dhcp::CfgMgr::instance().addSubnet4(getSubnet4());
+        }
+    }
 
-            // Set relay information if it was parsed
-            if (relay_info_) {
-                sub4ptr->setRelayInfo(*relay_info_);
-            }
+    /// @brief Returns the created subnet.
+    ///
+    /// @return the subnet, with the relay information set if it was
+    /// parsed.
+    /// @throw throws Unexpected if dynamic cast fails.
+    Subnet4Ptr getSubnet4() {
+        Subnet4Ptr sub4ptr = boost::dynamic_pointer_cast<Subnet4>(subnet_);
+        if (!sub4ptr) {
+            // If we hit this, it is a programming error.
+            bundy_throw(Unexpected,
+                      "Invalid cast in Subnet4ConfigParser::getSubnet4");
+        }
 
-            bundy::dhcp::CfgMgr::instance().addSubnet4(sub4ptr);
+        // Set relay information if it was parsed
+        if (relay_info_) {
+            sub4ptr->setRelayInfo(*relay_info_);
         }
+        return (sub4ptr);
     }
 
 protected:
@@ -316,11 +324,18 @@ protected:
     }
 };
 
+/// @brief Returns the subnets built from the last committed configuration.
+SubnetConfigCache<Subnet4>& subnet4Cache() {
+    static SubnetConfigCache<Subnet4> cache("subnet4");
+    return (cache);
+}
+
 /// @brief this class parses list of DHCP4 subnets
 ///
 /// This is a wrapper parser that handles the whole list of Subnet4
 /// definitions. It iterates over all entries and creates Subnet4ConfigParser
-/// for each entry.
+/// for each entry whose subnet can't be reused from the previous
+/// configuration (see @c SubnetConfigCache).
 class Subnets4ListConfigParser : public DhcpConfigParser {
 public:
 
@@ -328,38 +343,48 @@ public:
     ///
     /// @param dummy first argument, always ignored. All parsers accept a
     /// string parameter "name" as their first argument.
-    Subnets4ListConfigParser(const std::string&) {
+    Subnets4ListConfigParser(const std::string&)
+        : hosts_(new CfgHosts()) {
     }
 
     /// @brief parses contents of the list
     ///
     /// Iterates over all entries on the list and creates Subnet4ConfigParser
-    /// for each entry.
+    /// for each entry which changed since the previous configuration.
+    /// @c subnet4Cache().startConfig() must have been called for the new
+    /// configuration.
     ///
     /// @param subnets_list pointer to a list of IPv4 subnets
     void build(ConstElementPtr subnets_list) {
         BOOST_FOREACH(ConstElementPtr subnet, subnets_list->listValue()) {
-            ParserPtr parser(new Subnet4ConfigParser("subnet"));
-            parser->build(subnet);
-            subnets_.push_back(parser);
+            Subnet4Ptr subnet4 = subnet4Cache().reuseSubnet(subnet);
+            if (!subnet4) {
+                Subnet4ConfigParser parser("subnet");
+                parser.build(subnet);
+                subnet4 = parser.getSubnet4();
+            }
+            // The host reservations are parsed (and the subnet ID they
+            // refer to is known) whether the subnet is reused or not.
+            ConstElementPtr reservations = subnet->get("reservations");
+            if (reservations) {
+                HostReservationsListParser parser("reservations", subnet4,
+                                                  hosts_, Option::V4);
+                parser.build(reservations);
+                parser.commit();
+            }
+            subnet4Cache().addSubnet(subnet, subnet4);
+            subnets_.push_back(subnet4);
         }
     }
 
     /// @brief commits subnets definitions.
     ///
-    /// Iterates over all Subnet4 parsers. Each parser contains definitions of
-    /// a single subnet and its parameters and commits each subnet separately.
+    /// Replaces the subnets of the server's configuration with the parsed
+    /// ones in one go. The reused subnets stay in place.
     void commit() {
-        // @todo: Implement more subtle reconfiguration than toss
-        // the old one and replace with the new one.
-
-        // remove old subnets
-        CfgMgr::instance().deleteSubnets4();
-
-        BOOST_FOREACH(ParserPtr subnet, subnets_) {
-            subnet->commit();
-        }
-
+        CfgMgr::instance().replaceSubnets4(subnets_);
+        CfgMgr::instance().setHosts(hosts_);
+        subnet4Cache().commit();
     }
 
     /// @brief Returns Subnet4ListConfigParser object
@@ -369,8 +394,11 @@ public:
         return (new Subnets4ListConfigParser(param_name));
     }
 
-    /// @brief collection of subnet parsers.
-    ParserCollection subnets_;
+    /// @brief collection of parsed subnets.
+    Subnet4Collection subnets_;
+
+    /// @brief host reservations of the parsed subnets.
+    CfgHostsPtr hosts_;
 
 };
 
@@ -392,7 +420,15 @@ DhcpConfigParser* createGlobalDhcp4ConfigParser(const std::string& config_id) {
     DhcpConfigParser* parser = NULL;
     if ((config_id.compare("valid-lifetime") == 0)  ||
         (config_id.compare("renew-timer") == 0)  ||
-        (config_id.compare("rebind-timer") == 0))  {
+        (config_id.compare("rebind-timer") == 0)  ||
+        (config_id.compare("reclaim-timer") == 0)  ||
+        (config_id.compare("reclaim-max-leases") == 0)  ||
+        (config_id.compare("reclaim-max-time") == 0)  ||
+        (config_id.compare("parked-query-limit") == 0)  ||
+        (config_id.compare("parked-query-timeout") == 0)  ||
+        (config_id.compare("receive-queue-limit") == 0)  ||
+        (config_id.compare("shed-threshold") == 0)  ||
+        (config_id.compare("offer-lifetime") == 0))  {
         parser = new Uint32Parser(config_id,
                                  globalContext()->uint32_values_);
     } else if (config_id.compare("interfaces") == 0) {
@@ -419,6 +455,8 @@ DhcpConfigParser* createGlobalDhcp4ConfigParser(const std::string& config_id) {
         parser = new BooleanParser(config_id, globalContext()->boolean_values_);
     } else if (config_id.compare("dhcp-ddns") == 0) {
         parser = new D2ClientConfigParser(config_id);
+    } else if (config_id.compare("client-classes") == 0) {
+        parser = new ClientClassDefListParser(config_id, Option::V4);
     } else {
         bundy_throw(NotImplemented,
                 "Parser error: Global configuration parameter not supported: "
@@ -440,6 +478,29 @@ void commitGlobalOptions() {
     } catch (...) {
         // Ignore errors. This flag is optional
     }
+
+    // Set the parameters of the expired leases reclamation. They are all
+    // optional and the reclamation is disabled unless the timer is set.
+    Uint32StoragePtr uint32_values = globalContext()->uint32_values_;
+    CfgMgr::instance().setLeaseReclamation(
+        uint32_values->getOptionalParam("reclaim-timer", 0),
+        uint32_values->getOptionalParam("reclaim-max-leases", 100),
+        uint32_values->getOptionalParam("reclaim-max-time", 250));
+
+    // Set the limits on the queries parked by the hook libraries.
+    CfgMgr::instance().setQueryParking(
+        uint32_values->getOptionalParam("parked-query-limit", 256),
+        uint32_values->getOptionalParam("parked-query-timeout", 5000));
+
+    // Set the limits of the queue of the received queries, which is
+    // disabled by default.
+    CfgMgr::instance().setReceiveQueue(
+        uint32_values->getOptionalParam("receive-queue-limit", 0),
+        uint32_values->getOptionalParam("shed-threshold", 0));
+
+    // Set the time during which the offers are held, not at all by default.
+    CfgMgr::instance().setOfferLifetime(
+        uint32_values->getOptionalParam("offer-lifetime", 0));
 }
 
 bundy::data::ConstElementPtr
@@ -542,6 +603,8 @@ configureDhcp4Server(Dhcpv4Srv&, bundy::data::ConstElementPtr config_set) {
         std::map<std::string, ConstElementPtr>::const_iterator subnet_config =
             values_map.find("subnet4");
         if (subnet_config != values_map.end()) {
+            subnet4Cache().startConfig(config_set,
+                                       *CfgMgr::instance().getSubnets4());
             subnet_parser->build(subnet_config->second);
         }
 
@@ -608,6 +671,9 @@ configureDhcp4Server(Dhcpv4Srv&, bundy::data::ConstElementPtr config_set) {
         return (answer);
     }
 
+    // The packets are processed with the new configuration from now on.
+    CfgMgr::instance().publishSnapshot();
+
     LOG_INFO(dhcp4_logger, DHCP4_CONFIG_COMPLETE).arg(config_details);
 
     // Everything was fine. Configuration is successful.
@@ -39,8 +39,11 @@
 #include <util/strutil.h>
 
 #include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/foreach.hpp>
+#include <boost/make_shared.hpp>
 
+#include <algorithm>
 #include <iomanip>
 
 using namespace bundy;
@@ -60,7 +63,14 @@ struct Dhcp4Hooks {
     int hook_index_pkt4_send_;      ///< index for "pkt4_send" hook point
     int hook_index_buffer4_send_;   ///< index for "buffer4_send" hook point
 
-    /// Constructor that registers hook points for DHCPv4 engine
+    int arg_index_query4_;          ///< index for "query4" argument
+    int arg_index_response4_;       ///< index for "response4" argument
+    int arg_index_subnet4_;         ///< index for "subnet4" argument
+    int arg_index_subnet4collection_; ///< index for "subnet4collection"
+    int arg_index_lease4_;          ///< index for "lease4" argument
+
+    /// Constructor that registers hook points and callout arguments for
+    /// DHCPv4 engine
     Dhcp4Hooks() {
         hook_index_buffer4_receive_= HooksManager::registerHook("buffer4_receive");
         hook_index_pkt4_receive_   = HooksManager::registerHook("pkt4_receive");
@@ -68,6 +78,13 @@ struct Dhcp4Hooks {
         hook_index_pkt4_send_      = HooksManager::registerHook("pkt4_send");
         hook_index_lease4_release_ = HooksManager::registerHook("lease4_release");
         hook_index_buffer4_send_   = HooksManager::registerHook("buffer4_send");
+
+        arg_index_query4_    = HooksManager::registerArgument("query4");
+        arg_index_response4_ = HooksManager::registerArgument("response4");
+        arg_index_subnet4_   = HooksManager::registerArgument("subnet4");
+        arg_index_subnet4collection_ =
+            HooksManager::registerArgument("subnet4collection");
+        arg_index_lease4_    = HooksManager::registerArgument("lease4");
     }
 };
 
@@ -86,9 +103,16 @@ Dhcpv4Srv::Dhcpv4Srv(uint16_t port, const char* dbconfig, const bool use_bcast,
                      const bool direct_response_desired)
 : shutdown_(true), alloc_engine_(), port_(port),
     use_bcast_(use_bcast), hook_index_pkt4_receive_(-1),
-    hook_index_subnet4_select_(-1), hook_index_pkt4_send_(-1) {
+    hook_index_subnet4_select_(-1), hook_index_pkt4_send_(-1),
+    group_commit_(0), uncommitted_queries_(0), last_reclaim_(0),
+    receive_queue_(Option::V4) {
 
     LOG_DEBUG(dhcp4_logger, DBG_DHCP4_START, DHCP4_OPEN_SOCKET).arg(port);
+
+    // These classes are checked for every packet in classSpecificProcessing.
+    ClientClasses::intern(VENDOR_CLASS_PREFIX + DOCSIS3_CLASS_MODEM);
+    ClientClasses::intern(VENDOR_CLASS_PREFIX + DOCSIS3_CLASS_EROUTER);
+
     try {
         // Open sockets only if port is non-zero. Port 0 is used for testing
         // purposes in two cases:
@@ -110,6 +134,24 @@ Dhcpv4Srv::Dhcpv4Srv(uint16_t port, const char* dbconfig, const bool use_bcast,
             bundy::dhcp::IfaceMgrErrorMsgCallback error_handler =
                 boost::bind(&Dhcpv4Srv::ifaceMgrSocket4ErrorHandler, _1);
             IfaceMgr::instance().openSockets4(port_, use_bcast_, error_handler);
+
+            // Reopen the sockets of the interfaces which change, rather
+            // than waiting for a reconfiguration.
+            try {
+                if (!IfaceMgr::instance().startIfaceMonitor(
+                        boost::bind(&Dhcpv4Srv::ifacesChanged, this, _1))) {
+                    LOG_DEBUG(dhcp4_logger, DBG_DHCP4_START,
+                              DHCP4_IFACE_MONITOR_UNSUPPORTED);
+                }
+            } catch (const std::exception& ex) {
+                LOG_WARN(dhcp4_logger, DHCP4_IFACE_MONITOR_FAILED)
+                    .arg(ex.what());
+            }
+
+            // Go on with the queries resumed by the hook libraries when the
+            // parking lot tells so.
+            IfaceMgr::instance().addExternalSocket(parking_lot_.getFD(),
+                boost::bind(&Dhcpv4Srv::processParkedQueries, this));
         }
 
         // Instantiate LeaseMgr
@@ -118,8 +160,9 @@ Dhcpv4Srv::Dhcpv4Srv(uint16_t port, const char* dbconfig, const bool use_bcast,
             .arg(LeaseMgrFactory::instance().getType())
             .arg(LeaseMgrFactory::instance().getName());
 
-        // Instantiate allocation engine
-        alloc_engine_.reset(new AllocEngine(AllocEngine::ALLOC_ITERATIVE, 100,
+        // Instantiate allocation engine.  The free map allocator avoids
+        // repeated lease database lookups when the pools are nearly full.
+        alloc_engine_.reset(new AllocEngine(AllocEngine::ALLOC_FREE_MAP, 100,
                                             false /* false = IPv4 */));
 
         // Register hook points
@@ -139,6 +182,10 @@ Dhcpv4Srv::Dhcpv4Srv(uint16_t port, const char* dbconfig, const bool use_bcast,
 }
 
 Dhcpv4Srv::~Dhcpv4Srv() {
+    if (port_) {
+        IfaceMgr::instance().stopIfaceMonitor();
+        IfaceMgr::instance().deleteExternalSocket(parking_lot_.getFD());
+    }
     IfaceMgr::instance().closeSockets();
 }
 
@@ -153,6 +200,29 @@ Dhcpv4Srv::receivePacket(int timeout) {
     return (IfaceMgr::instance().receive4(timeout));
 }
 
+Pkt4Ptr
+Dhcpv4Srv::receiveQuery(int timeout) {
+    // The limits may have been changed by a reconfiguration.
+    receive_queue_.setLimits(CfgMgr::instance().getReceiveQueueLimit(),
+                             CfgMgr::instance().getShedThreshold());
+    if (!receive_queue_.isEnabled()) {
+        // The queries queued before the queue was disabled go first.
+        Pkt4Ptr query = receive_queue_.pop();
+        return (query ? query : receivePacket(timeout));
+    }
+
+    // Read the queries already received, so that the ones of the existing
+    // clients overtake the new clients. Only wait if none is queued.
+    for (size_t reads = 0; reads < receive_queue_.getLimit(); ++reads) {
+        Pkt4Ptr query = receivePacket(receive_queue_.size() > 0 ? 0 : timeout);
+        if (!query) {
+            break;
+        }
+        receive_queue_.push(query);
+    }
+    return (receive_queue_.pop());
+}
+
 void
 Dhcpv4Srv::sendPacket(const Pkt4Ptr& packet) {
     IfaceMgr::instance().send(packet);
@@ -163,14 +233,43 @@ Dhcpv4Srv::run() {
     while (!shutdown_) {
         /// @todo: calculate actual timeout once we have lease database
         //cppcheck-suppress variableScope This is temporary anyway
-        const int timeout = 1000;
+        int timeout = 1000;
+
+        // Reclaim the expired leases when the reclamation timer elapses,
+        // and wake up in time for the next reclamation.
+        const uint32_t reclaim_timer = CfgMgr::instance().getReclaimTimer();
+        if (reclaim_timer > 0) {
+            const time_t now = time(NULL);
+            if (now - last_reclaim_ >= reclaim_timer) {
+                last_reclaim_ = now;
+                // Commit the held lease writes first, so that the
+                // reclamation is committed on its own.
+                sendPendingResponses();
+                reclaimExpiredLeases(CfgMgr::instance().getReclaimMaxLeases(),
+                                     CfgMgr::instance().getReclaimMaxTime());
+            }
+            timeout = std::min(timeout, static_cast<int>(reclaim_timer));
+        }
+
+        // Drop the parked queries which have timed out, and wake up in time
+        // for the next one.  The timeout is in seconds, so the queries are
+        // dropped up to a second late when the server is idle.
+        int parked_timeout = parking_lot_.getNextTimeout();
+        if (parked_timeout == 0) {
+            processParkedQueries();
+            parked_timeout = parking_lot_.getNextTimeout();
+        }
+        if (parked_timeout > 0) {
+            timeout = std::min(timeout, (parked_timeout + 999) / 1000);
+        }
 
-        // client's message and server's response
+        // client's message
         Pkt4Ptr query;
-        Pkt4Ptr rsp;
 
         try {
-            query = receivePacket(timeout);
+            // While lease writes are waiting for the group commit, only
+            // take the queries which have already been received.
+            query = receiveQuery(uncommitted_queries_ > 0 ? 0 : timeout);
         } catch (const std::exception& e) {
             LOG_ERROR(dhcp4_logger, DHCP4_PACKET_RECEIVE_FAIL).arg(e.what());
         }
@@ -178,255 +277,450 @@ Dhcpv4Srv::run() {
         // Timeout may be reached or signal received, which breaks select()
         // with no reception ocurred
         if (!query) {
+            sendPendingResponses();
             continue;
         }
 
-        // In order to parse the DHCP options, the server needs to use some
-        // configuration information such as: existing option spaces, option
-        // definitions etc. This is the kind of information which is not
-        // available in the libdhcp, so we need to supply our own implementation
-        // of the option parsing function here, which would rely on the
-        // configuration data.
-        query->setCallback(boost::bind(&Dhcpv4Srv::unpackOptions, this,
-                                       _1, _2, _3));
+        timing_.start(query->getTimestamp());
 
-        bool skip_unpack = false;
+        // The lease manager is replaced when the server is reconfigured,
+        // so check for group commit for each query.
+        group_commit_ = LeaseMgrFactory::haveInstance() ?
+            LeaseMgrFactory::instance().getGroupCommit() : 0;
 
-        // The packet has just been received so contains the uninterpreted wire
-        // data; execute callouts registered for buffer4_receive.
-        if (HooksManager::calloutsPresent(Hooks.hook_index_buffer4_receive_)) {
-            CalloutHandlePtr callout_handle = getCalloutHandle(query);
+        // The options are unpacked lazily, so a malformed option may
+        // only be found when the packet is being processed.
+        try {
+            processPacket(query);
+        } catch (const std::exception& e) {
+            LOG_DEBUG(dhcp4_logger, DBG_DHCP4_DETAIL,
+                      DHCP4_PACKET_PARSE_FAIL).arg(e.what());
+        }
 
-            // Delete previously set arguments
-            callout_handle->deleteAllArguments();
+        if (group_commit_ > 0 && ++uncommitted_queries_ >= group_commit_) {
+            sendPendingResponses();
+        }
 
-            // Pass incoming packet as argument
-            callout_handle->setArgument("query4", query);
+        if (timing_.isEnabled()) {
+            uint8_t type = 0;
+            try {
+                type = query->getType();
+            } catch (const std::exception&) {
+                // The query has no message type.
+            }
+            timing_.finish(type);
+        }
+    }
 
-            // Call callouts
-            HooksManager::callCallouts(Hooks.hook_index_buffer4_receive_,
-                                       *callout_handle);
+    sendPendingResponses();
 
-            // Callouts decided to skip the next processing step. The next
-            // processing step would to parse the packet, so skip at this
-            // stage means that callouts did the parsing already, so server
-            // should skip parsing.
-            if (callout_handle->getSkip()) {
-                LOG_DEBUG(dhcp4_logger, DBG_DHCP4_HOOKS, DHCP4_HOOK_BUFFER_RCVD_SKIP);
-                skip_unpack = true;
-            }
+    return (true);
+}
 
-            callout_handle->getArgument("query4", query);
+void
+Dhcpv4Srv::sendPendingResponses() {
+    if (uncommitted_queries_ == 0) {
+        return;
+    }
+    uncommitted_queries_ = 0;
+
+    try {
+        PacketTiming::Scope timing(timing_, PacketTiming::COMMIT);
+        LeaseMgrFactory::instance().commit();
+    } catch (const std::exception& e) {
+        LOG_ERROR(dhcp4_logger, DHCP4_LEASE_COMMIT_FAIL)
+            .arg(pending_responses_.size()).arg(e.what());
+        try {
+            LeaseMgrFactory::instance().rollback();
+        } catch (const std::exception&) {
+            // The failure to commit has already been logged.
         }
+        pending_responses_.clear();
+        return;
+    }
 
-        // Unpack the packet information unless the buffer4_receive callouts
-        // indicated they did it
-        if (!skip_unpack) {
-            try {
-                query->unpack();
-            } catch (const std::exception& e) {
-                // Failed to parse the packet.
-                LOG_DEBUG(dhcp4_logger, DBG_DHCP4_DETAIL,
-                          DHCP4_PACKET_PARSE_FAIL).arg(e.what());
+    for (std::vector<Pkt4Ptr>::const_iterator rsp = pending_responses_.begin();
+         rsp != pending_responses_.end(); ++rsp) {
+        try {
+            PacketTiming::Scope timing(timing_, PacketTiming::SEND);
+            sendPacket(*rsp);
+        } catch (const std::exception& e) {
+            LOG_ERROR(dhcp4_logger, DHCP4_PACKET_SEND_FAIL)
+                .arg(e.what());
+        }
+    }
+    pending_responses_.clear();
+}
+
+size_t
+Dhcpv4Srv::reclaimExpiredLeases(const size_t max_leases,
+                                 const uint32_t max_time) {
+    if (!LeaseMgrFactory::haveInstance()) {
+        return (0);
+    }
+
+    using namespace boost::posix_time;
+    const ptime start = microsec_clock::universal_time();
+    size_t reclaimed = 0;
+    Lease4Collection leases;
+    try {
+        LeaseMgr& lease_mgr = LeaseMgrFactory::instance();
+        leases = lease_mgr.getExpiredLeases4(max_leases);
+        for (Lease4Collection::const_iterator lease = leases.begin();
+             lease != leases.end(); ++lease) {
+            // Leave the remaining leases for the next reclamation if
+            // this one has taken too long.
+            if ((max_time > 0) &&
+                ((microsec_clock::universal_time() - start).total_milliseconds()
+                 >= max_time)) {
+                break;
+            }
+
+            if (!lease_mgr.deleteLease((*lease)->addr_)) {
                 continue;
             }
+            ++reclaimed;
+            alloc_engine_->leaseDeleted(Lease::TYPE_V4, (*lease)->addr_);
+
+            if (CfgMgr::instance().ddnsEnabled()) {
+                // Remove existing DNS entries for the lease, if any.
+                queueNameChangeRequest(bundy::dhcp_ddns::CHG_REMOVE, *lease);
+            }
+        }
+        lease_mgr.commit();
+    } catch (const std::exception& ex) {
+        LOG_ERROR(dhcp4_logger, DHCP4_LEASE_RECLAIM_FAIL).arg(ex.what());
+        return (reclaimed);
+    }
+
+    LOG_DEBUG(dhcp4_logger, DBG_DHCP4_BASIC, DHCP4_LEASE_RECLAIM)
+        .arg(reclaimed).arg(leases.size())
+        .arg((microsec_clock::universal_time() - start).total_milliseconds());
+
+    return (reclaimed);
+}
+
+void
+Dhcpv4Srv::processPacket(Pkt4Ptr& query) {
+    // In order to parse the DHCP options, the server needs to use some
+    // configuration information such as: existing option spaces, option
+    // definitions etc. This is the kind of information which is not
+    // available in the libdhcp, so we need to supply our own implementation
+    // of the option parsing function here, which would rely on the
+    // configuration data.
+    query->setCallback(boost::bind(&Dhcpv4Srv::unpackOptions, this,
+                                   _1, _2, _3));
+    // Most of the options sent by the clients are never looked at by the
+    // server, so they are only parsed when they are used.
+    query->setLazyUnpack(true);
+
+    bool skip_unpack = false;
+
+    // The packet has just been received so contains the uninterpreted wire
+    // data; execute callouts registered for buffer4_receive.
+    if (HooksManager::calloutsPresent(Hooks.hook_index_buffer4_receive_)) {
+        PacketTiming::Scope timing(timing_, PacketTiming::HOOKS);
+        CalloutHandlePtr callout_handle = getCalloutHandle(query);
+
+        // Delete previously set arguments
+        callout_handle->deleteAllArguments();
+
+        // Pass incoming packet as argument
+        callout_handle->setArgument(Hooks.arg_index_query4_, query);
+
+        // Call callouts
+        HooksManager::callCallouts(Hooks.hook_index_buffer4_receive_,
+                                   *callout_handle);
+
+        // Callouts decided to skip the next processing step. The next
+        // processing step would to parse the packet, so skip at this
+        // stage means that callouts did the parsing already, so server
+        // should skip parsing.
+        if (callout_handle->getSkip()) {
+            LOG_DEBUG(dhcp4_logger, DBG_DHCP4_HOOKS, DHCP4_HOOK_BUFFER_RCVD_SKIP);
+            skip_unpack = true;
+        }
+
+        callout_handle->getArgument(Hooks.arg_index_query4_, query);
+    }
+
+    // Unpack the packet information unless the buffer4_receive callouts
+    // indicated they did it
+    if (!skip_unpack) {
+        try {
+            PacketTiming::Scope timing(timing_, PacketTiming::UNPACK);
+            query->unpack();
+        } catch (const std::exception& e) {
+            // Failed to parse the packet.
+            LOG_DEBUG(dhcp4_logger, DBG_DHCP4_DETAIL,
+                      DHCP4_PACKET_PARSE_FAIL).arg(e.what());
+            return;
         }
+    }
 
-        // Assign this packet to one or more classes if needed. We need to do
-        // this before calling accept(), because getSubnet4() may need client
-        // class information.
+    // Assign this packet to one or more classes if needed. We need to do
+    // this before calling accept(), because getSubnet4() may need client
+    // class information.
+    {
+        PacketTiming::Scope timing(timing_, PacketTiming::CLASSIFY);
         classifyPacket(query);
 
-        // Check whether the message should be further processed or discarded.
-        // There is no need to log anything here. This function logs by itself.
+        // Check whether the message should be further processed or
+        // discarded. There is no need to log anything here. This function
+        // logs by itself.
         if (!accept(query)) {
-            continue;
+            return;
         }
+    }
 
-        // We have sanity checked (in accept() that the Message Type option
-        // exists, so we can safely get it here.
-        int type = query->getType();
-        LOG_DEBUG(dhcp4_logger, DBG_DHCP4_DETAIL, DHCP4_PACKET_RECEIVED)
-            .arg(serverReceivedPacketName(type))
-            .arg(type)
-            .arg(query->getIface());
-        LOG_DEBUG(dhcp4_logger, DBG_DHCP4_DETAIL_DATA, DHCP4_QUERY_DATA)
-            .arg(type)
-            .arg(query->toText());
+    // We have sanity checked (in accept() that the Message Type option
+    // exists, so we can safely get it here.
+    int type = query->getType();
+    LOG_DEBUG(dhcp4_logger, DBG_DHCP4_DETAIL, DHCP4_PACKET_RECEIVED)
+        .arg(serverReceivedPacketName(type))
+        .arg(type)
+        .arg(query->getIface());
+    LOG_DEBUG(dhcp4_logger, DBG_DHCP4_DETAIL_DATA, DHCP4_QUERY_DATA)
+        .arg(type)
+        .arg(query->toText());
 
-        // Let's execute all callouts registered for pkt4_receive
-        if (HooksManager::calloutsPresent(hook_index_pkt4_receive_)) {
-            CalloutHandlePtr callout_handle = getCalloutHandle(query);
+    // Let's execute all callouts registered for pkt4_receive
+    if (HooksManager::calloutsPresent(hook_index_pkt4_receive_)) {
+        PacketTiming::Scope timing(timing_, PacketTiming::HOOKS);
+        CalloutHandlePtr callout_handle = getCalloutHandle(query);
 
-            // Delete previously set arguments
-            callout_handle->deleteAllArguments();
+        // Delete previously set arguments
+        callout_handle->deleteAllArguments();
 
-            // Pass incoming packet as argument
-            callout_handle->setArgument("query4", query);
+        // Pass incoming packet as argument
+        callout_handle->setArgument(Hooks.arg_index_query4_, query);
 
-            // Call callouts
-            HooksManager::callCallouts(hook_index_pkt4_receive_,
-                                       *callout_handle);
+        // Call callouts
+        HooksManager::callCallouts(hook_index_pkt4_receive_,
+                                   *callout_handle);
 
-            // Callouts decided to skip the next processing step. The next
-            // processing step would to process the packet, so skip at this
-            // stage means drop.
-            if (callout_handle->getSkip()) {
-                LOG_DEBUG(dhcp4_logger, DBG_DHCP4_HOOKS, DHCP4_HOOK_PACKET_RCVD_SKIP);
-                continue;
-            }
+        // Callouts decided to skip the next processing step. The next
+        // processing step would to process the packet, so skip at this
+        // stage means drop.
+        if (callout_handle->getSkip()) {
+            LOG_DEBUG(dhcp4_logger, DBG_DHCP4_HOOKS, DHCP4_HOOK_PACKET_RCVD_SKIP);
+            return;
+        }
 
-            callout_handle->getArgument("query4", query);
+        // Callouts parked the packet while they wait for something: the
+        // processing goes on in resumeQuery() once they resume it.
+        if (callout_handle->isParked()) {
+            parking_lot_.setLimit(CfgMgr::instance().getParkedQueryLimit());
+            parking_lot_.setTimeout(CfgMgr::instance().getParkedQueryTimeout());
+            if (parking_lot_.park(*callout_handle,
+                                  boost::bind(&Dhcpv4Srv::resumeQuery, this,
+                                              query, callout_handle, _1))) {
+                LOG_DEBUG(dhcp4_logger, DBG_DHCP4_HOOKS,
+                          DHCP4_HOOK_PACKET_PARKED);
+            } else {
+                LOG_DEBUG(dhcp4_logger, DBG_DHCP4_HOOKS,
+                          DHCP4_HOOK_PACKET_PARK_LIMIT)
+                    .arg(parking_lot_.getParkedCount());
+            }
+            return;
         }
 
-        try {
-            switch (query->getType()) {
-            case DHCPDISCOVER:
-                rsp = processDiscover(query);
-                break;
+        callout_handle->getArgument(Hooks.arg_index_query4_, query);
+    }
 
-            case DHCPREQUEST:
-                // Note that REQUEST is used for many things in DHCPv4: for
-                // requesting new leases, renewing existing ones and even
-                // for rebinding.
-                rsp = processRequest(query);
-                break;
+    processQuery(query);
+}
 
-            case DHCPRELEASE:
-                processRelease(query);
-                break;
+void
+Dhcpv4Srv::resumeQuery(Pkt4Ptr query, CalloutHandlePtr callout_handle,
+                       bool resume) {
+    if (!resume) {
+        LOG_DEBUG(dhcp4_logger, DBG_DHCP4_HOOKS, DHCP4_HOOK_PACKET_PARK_DROP);
+        return;
+    }
 
-            case DHCPDECLINE:
-                processDecline(query);
-                break;
+    try {
+        callout_handle->getArgument(Hooks.arg_index_query4_, query);
 
-            case DHCPINFORM:
-                processInform(query);
-                break;
+        // Other queries have been processed since the query was parked, so
+        // make the callout handle the one of the query again for the
+        // following hooks.
+        getCalloutHandle(query, callout_handle);
 
-            default:
-                // Only action is to output a message if debug is enabled,
-                // and that is covered by the debug statement before the
-                // "switch" statement.
-                ;
-            }
-        } catch (const bundy::Exception& e) {
-
-            // Catch-all exception (at least for ones based on the isc
-            // Exception class, which covers more or less all that
-            // are explicitly raised in the BUNDY code).  Just log
-            // the problem and ignore the packet. (The problem is logged
-            // as a debug message because debug is disabled by default -
-            // it prevents a DDOS attack based on the sending of problem
-            // packets.)
-            if (dhcp4_logger.isDebugEnabled(DBG_DHCP4_BASIC)) {
-                std::string source = "unknown";
-                HWAddrPtr hwptr = query->getHWAddr();
-                if (hwptr) {
-                    source = hwptr->toText();
-                }
-                LOG_DEBUG(dhcp4_logger, DBG_DHCP4_BASIC,
-                          DHCP4_PACKET_PROCESS_FAIL)
-                    .arg(source).arg(e.what());
+        processQuery(query);
+    } catch (const std::exception& e) {
+        LOG_DEBUG(dhcp4_logger, DBG_DHCP4_DETAIL,
+                  DHCP4_PACKET_PARSE_FAIL).arg(e.what());
+    }
+
+    if (group_commit_ > 0 && ++uncommitted_queries_ >= group_commit_) {
+        sendPendingResponses();
+    }
+}
+
+void
+Dhcpv4Srv::processParkedQueries() {
+    parking_lot_.processReady();
+}
+
+void
+Dhcpv4Srv::processQuery(Pkt4Ptr& query) {
+    // server's response
+    Pkt4Ptr rsp;
+
+    try {
+        switch (query->getType()) {
+        case DHCPDISCOVER:
+            rsp = processDiscover(query);
+            break;
+
+        case DHCPREQUEST:
+            // Note that REQUEST is used for many things in DHCPv4: for
+            // requesting new leases, renewing existing ones and even
+            // for rebinding.
+            rsp = processRequest(query);
+            break;
+
+        case DHCPRELEASE:
+            processRelease(query);
+            break;
+
+        case DHCPDECLINE:
+            processDecline(query);
+            break;
+
+        case DHCPINFORM:
+            processInform(query);
+            break;
+
+        default:
+            // Only action is to output a message if debug is enabled,
+            // and that is covered by the debug statement before the
+            // "switch" statement.
+            ;
+        }
+    } catch (const bundy::Exception& e) {
+
+        // Catch-all exception (at least for ones based on the isc
+        // Exception class, which covers more or less all that
+        // are explicitly raised in the BUNDY code).  Just log
+        // the problem and ignore the packet. (The problem is logged
+        // as a debug message because debug is disabled by default -
+        // it prevents a DDOS attack based on the sending of problem
+        // packets.)
+        if (dhcp4_logger.isDebugEnabled(DBG_DHCP4_BASIC)) {
+            std::string source = "unknown";
+            HWAddrPtr hwptr = query->getHWAddr();
+            if (hwptr) {
+                source = hwptr->toText();
             }
+            LOG_DEBUG(dhcp4_logger, DBG_DHCP4_BASIC,
+                      DHCP4_PACKET_PROCESS_FAIL)
+                .arg(source).arg(e.what());
         }
+    }
 
-        if (!rsp) {
-            continue;
-        }
+    if (!rsp) {
+        return;
+    }
 
-        // Let's do class specific processing. This is done before
-        // pkt4_send.
-        //
-        /// @todo: decide whether we want to add a new hook point for
-        /// doing class specific processing.
-        if (!classSpecificProcessing(query, rsp)) {
-            /// @todo add more verbosity here
-            LOG_DEBUG(dhcp4_logger, DBG_DHCP4_BASIC, DHCP4_CLASS_PROCESSING_FAILED);
+    // Let's do class specific processing. This is done before
+    // pkt4_send.
+    //
+    /// @todo: decide whether we want to add a new hook point for
+    /// doing class specific processing.
+    if (!classSpecificProcessing(query, rsp)) {
+        /// @todo add more verbosity here
+        LOG_DEBUG(dhcp4_logger, DBG_DHCP4_BASIC, DHCP4_CLASS_PROCESSING_FAILED);
 
-            continue;
+        return;
+    }
+
+    // Specifies if server should do the packing
+    bool skip_pack = false;
+
+    // Execute all callouts registered for pkt4_send
+    if (HooksManager::calloutsPresent(hook_index_pkt4_send_)) {
+        PacketTiming::Scope timing(timing_, PacketTiming::HOOKS);
+        CalloutHandlePtr callout_handle = getCalloutHandle(query);
+
+        // Delete all previous arguments
+        callout_handle->deleteAllArguments();
+
+        // Clear skip flag if it was set in previous callouts
+        callout_handle->setSkip(false);
+
+        // Set our response
+        callout_handle->setArgument(Hooks.arg_index_response4_, rsp);
+
+        // Call all installed callouts
+        HooksManager::callCallouts(hook_index_pkt4_send_,
+                                   *callout_handle);
+
+        // Callouts decided to skip the next processing step. The next
+        // processing step would to send the packet, so skip at this
+        // stage means "drop response".
+        if (callout_handle->getSkip()) {
+            LOG_DEBUG(dhcp4_logger, DBG_DHCP4_HOOKS, DHCP4_HOOK_PACKET_SEND_SKIP);
+            skip_pack = true;
         }
+    }
 
-        // Specifies if server should do the packing
-        bool skip_pack = false;
+    if (!skip_pack) {
+        try {
+            PacketTiming::Scope timing(timing_, PacketTiming::PACK);
+            rsp->pack();
+        } catch (const std::exception& e) {
+            LOG_ERROR(dhcp4_logger, DHCP4_PACKET_SEND_FAIL)
+                .arg(e.what());
+        }
+    }
 
-        // Execute all callouts registered for pkt4_send
-        if (HooksManager::calloutsPresent(hook_index_pkt4_send_)) {
+    try {
+        // Now all fields and options are constructed into output wire buffer.
+        // Option objects modification does not make sense anymore. Hooks
+        // can only manipulate wire buffer at this stage.
+        // Let's execute all callouts registered for buffer4_send
+        if (HooksManager::calloutsPresent(Hooks.hook_index_buffer4_send_)) {
+            PacketTiming::Scope timing(timing_, PacketTiming::HOOKS);
             CalloutHandlePtr callout_handle = getCalloutHandle(query);
 
-            // Delete all previous arguments
+            // Delete previously set arguments
             callout_handle->deleteAllArguments();
 
-            // Clear skip flag if it was set in previous callouts
-            callout_handle->setSkip(false);
-
-            // Set our response
-            callout_handle->setArgument("response4", rsp);
+            // Pass incoming packet as argument
+            callout_handle->setArgument(Hooks.arg_index_response4_, rsp);
 
-            // Call all installed callouts
-            HooksManager::callCallouts(hook_index_pkt4_send_,
+            // Call callouts
+            HooksManager::callCallouts(Hooks.hook_index_buffer4_send_,
                                        *callout_handle);
 
             // Callouts decided to skip the next processing step. The next
-            // processing step would to send the packet, so skip at this
-            // stage means "drop response".
+            // processing step would to parse the packet, so skip at this
+            // stage means drop.
             if (callout_handle->getSkip()) {
-                LOG_DEBUG(dhcp4_logger, DBG_DHCP4_HOOKS, DHCP4_HOOK_PACKET_SEND_SKIP);
-                skip_pack = true;
+                LOG_DEBUG(dhcp4_logger, DBG_DHCP4_HOOKS,
+                          DHCP4_HOOK_BUFFER_SEND_SKIP);
+                return;
             }
-        }
 
-        if (!skip_pack) {
-            try {
-                rsp->pack();
-            } catch (const std::exception& e) {
-                LOG_ERROR(dhcp4_logger, DHCP4_PACKET_SEND_FAIL)
-                    .arg(e.what());
-            }
+            callout_handle->getArgument(Hooks.arg_index_response4_, rsp);
         }
 
-        try {
-            // Now all fields and options are constructed into output wire buffer.
-            // Option objects modification does not make sense anymore. Hooks
-            // can only manipulate wire buffer at this stage.
-            // Let's execute all callouts registered for buffer4_send
-            if (HooksManager::calloutsPresent(Hooks.hook_index_buffer4_send_)) {
-                CalloutHandlePtr callout_handle = getCalloutHandle(query);
-
-                // Delete previously set arguments
-                callout_handle->deleteAllArguments();
-
-                // Pass incoming packet as argument
-                callout_handle->setArgument("response4", rsp);
-
-                // Call callouts
-                HooksManager::callCallouts(Hooks.hook_index_buffer4_send_,
-                                           *callout_handle);
-
-                // Callouts decided to skip the next processing step. The next
-                // processing step would to parse the packet, so skip at this
-                // stage means drop.
-                if (callout_handle->getSkip()) {
-                    LOG_DEBUG(dhcp4_logger, DBG_DHCP4_HOOKS,
-                              DHCP4_HOOK_BUFFER_SEND_SKIP);
-                    continue;
-                }
-
-                callout_handle->getArgument("response4", rsp);
-            }
-
-            LOG_DEBUG(dhcp4_logger, DBG_DHCP4_DETAIL_DATA,
-                      DHCP4_RESPONSE_DATA)
-                .arg(static_cast<int>(rsp->getType())).arg(rsp->toText());
+        LOG_DEBUG(dhcp4_logger, DBG_DHCP4_DETAIL_DATA,
+                  DHCP4_RESPONSE_DATA)
+            .arg(static_cast<int>(rsp->getType())).arg(rsp->toText());
 
+        if (group_commit_ > 0) {
+            pending_responses_.push_back(rsp);
+        } else {
+            PacketTiming::Scope timing(timing_, PacketTiming::SEND);
             sendPacket(rsp);
-        } catch (const std::exception& e) {
-            LOG_ERROR(dhcp4_logger, DHCP4_PACKET_SEND_FAIL)
-                .arg(e.what());
         }
+    } catch (const std::exception& e) {
+        LOG_ERROR(dhcp4_logger, DHCP4_PACKET_SEND_FAIL)
+            .arg(e.what());
     }
-
-    return (true);
 }
 
 string
@@ -558,9 +852,9 @@ Dhcpv4Srv::appendServerID(const Pkt4Ptr& response) {
     // available from the client.
     /// @todo: perhaps we should consider some more sophisticated server id
     /// generation, but for the current use cases, it should be ok.
-    response->addOption(OptionPtr(new Option4AddrLst(DHO_DHCP_SERVER_IDENTIFIER,
-                                                     response->getLocalAddr()))
-                        );
+    response->addOption(boost::make_shared<Option4AddrLst>
+                        (DHO_DHCP_SERVER_IDENTIFIER,
+                         response->getLocalAddr()));
 }
 
 void
@@ -589,16 +883,15 @@ Dhcpv4Srv::appendRequestedOptions(const Pkt4Ptr& question, Pkt4Ptr& msg) {
 
     // Get the codes of requested options.
     const std::vector<uint8_t>& requested_opts = option_prl->getValues();
-    // For each requested option code get the instance of the option
-    // to be returned to the client.
-    for (std::vector<uint8_t>::const_iterator opt = requested_opts.begin();
-         opt != requested_opts.end(); ++opt) {
-        if (!msg->getOption(*opt)) {
-            Subnet::OptionDescriptor desc =
-                subnet->getOptionDescriptor("dhcp4", *opt);
-            if (desc.option && !msg->getOption(*opt)) {
-                msg->addOption(desc.option);
-            }
+    // Get the instances of the requested options configured for the
+    // subnet, and add those not yet in the response.
+    const std::vector<uint16_t> codes(requested_opts.begin(),
+                                      requested_opts.end());
+    Subnet::OptionListPtr options = subnet->getRequestedOptions("dhcp4", codes);
+    for (Subnet::OptionList::const_iterator opt = options->begin();
+         opt != options->end(); ++opt) {
+        if (!msg->getOption((*opt)->getType())) {
+            msg->addOption(*opt);
         }
     }
 }
@@ -669,8 +962,9 @@ Dhcpv4Srv::appendBasicOptions(const Pkt4Ptr& question, Pkt4Ptr& msg) {
         DHO_DOMAIN_NAME_SERVERS,
         DHO_DOMAIN_NAME };
 
-    static size_t required_options_size =
-        sizeof(required_options) / sizeof(required_options[0]);
+    static const std::vector<uint16_t>
+        required_codes(required_options, required_options +
+                       sizeof(required_options) / sizeof(required_options[0]));
 
     // Get the subnet.
     Subnet4Ptr subnet = selectSubnet(question);
@@ -679,16 +973,14 @@ Dhcpv4Srv::appendBasicOptions(const Pkt4Ptr& question, Pkt4Ptr& msg) {
     }
 
     // Try to find all 'required' options in the outgoing
-    // message. Those that are not present will be added.
-    for (int i = 0; i < required_options_size; ++i) {
-        OptionPtr opt = msg->getOption(required_options[i]);
-        if (!opt) {
-            // Check whether option has been configured.
-            Subnet::OptionDescriptor desc =
-                subnet->getOptionDescriptor("dhcp4", required_options[i]);
-            if (desc.option) {
-                msg->addOption(desc.option);
-            }
+    // message. Those that are not present will be added if they
+    // have been configured.
+    Subnet::OptionListPtr options =
+        subnet->getRequestedOptions("dhcp4", required_codes);
+    for (Subnet::OptionList::const_iterator opt = options->begin();
+         opt != options->end(); ++opt) {
+        if (!msg->getOption((*opt)->getType())) {
+            msg->addOption(*opt);
         }
     }
 }
@@ -994,6 +1286,7 @@ Dhcpv4Srv::assignLease(const Pkt4Ptr& question, Pkt4Ptr& answer) {
     // be inserted into the LeaseMgr as well.
     /// @todo pass the actual FQDN data.
     Lease4Ptr old_lease;
+    alloc_engine_->setOfferLifetime(CfgMgr::instance().getOfferLifetime());
     Lease4Ptr lease = alloc_engine_->allocateLease4(subnet, client_id, hwaddr,
                                                       hint, fqdn_fwd, fqdn_rev,
                                                       hostname,
@@ -1044,7 +1337,7 @@ Dhcpv4Srv::assignLease(const Pkt4Ptr& question, Pkt4Ptr& answer) {
         }
 
         // IP Address Lease time (type 51)
-        opt = OptionPtr(new Option(Option::V4, DHO_DHCP_LEASE_TIME));
+        opt = boost::make_shared<Option>(Option::V4, DHO_DHCP_LEASE_TIME);
         opt->setUint32(lease->valid_lft_);
         answer->addOption(opt);
 
@@ -1171,8 +1464,9 @@ OptionPtr
 Dhcpv4Srv::getNetmaskOption(const Subnet4Ptr& subnet) {
     uint32_t netmask = getNetmask4(subnet->get().second);
 
-    OptionPtr opt(new OptionInt<uint32_t>(Option::V4,
-                  DHO_SUBNET_MASK, netmask));
+    OptionPtr opt(boost::make_shared<OptionInt<uint32_t> >(Option::V4,
+                                                           DHO_SUBNET_MASK,
+                                                           netmask));
 
     return (opt);
 }
@@ -1182,8 +1476,8 @@ Dhcpv4Srv::processDiscover(Pkt4Ptr& discover) {
 
     sanityCheck(discover, FORBIDDEN);
 
-    Pkt4Ptr offer = Pkt4Ptr
-        (new Pkt4(DHCPOFFER, discover->getTransid()));
+    Pkt4Ptr offer = boost::make_shared<Pkt4>(DHCPOFFER,
+                                             discover->getTransid());
 
     copyDefaultFields(discover, offer);
     appendDefaultOptions(offer, DHCPOFFER);
@@ -1221,8 +1515,7 @@ Dhcpv4Srv::processRequest(Pkt4Ptr& request) {
     /// @todo Uncomment this (see ticket #3116)
     /// sanityCheck(request, MANDATORY);
 
-    Pkt4Ptr ack = Pkt4Ptr
-        (new Pkt4(DHCPACK, request->getTransid()));
+    Pkt4Ptr ack = boost::make_shared<Pkt4>(DHCPACK, request->getTransid());
 
     copyDefaultFields(request, ack);
     appendDefaultOptions(ack, DHCPACK);
@@ -1310,16 +1603,17 @@ Dhcpv4Srv::processRelease(Pkt4Ptr& release) {
 
         // Execute all callouts registered for lease4_release
         if (HooksManager::calloutsPresent(Hooks.hook_index_lease4_release_)) {
+            PacketTiming::Scope timing(timing_, PacketTiming::HOOKS);
             CalloutHandlePtr callout_handle = getCalloutHandle(release);
 
             // Delete all previous arguments
             callout_handle->deleteAllArguments();
 
             // Pass the original packet
-            callout_handle->setArgument("query4", release);
+            callout_handle->setArgument(Hooks.arg_index_query4_, release);
 
             // Pass the lease to be updated
-            callout_handle->setArgument("lease4", lease);
+            callout_handle->setArgument(Hooks.arg_index_lease4_, lease);
 
             // Call all installed callouts
             HooksManager::callCallouts(Hooks.hook_index_lease4_release_,
@@ -1340,6 +1634,9 @@ Dhcpv4Srv::processRelease(Pkt4Ptr& release) {
             bool success = LeaseMgrFactory::instance().deleteLease(lease->addr_);
 
             if (success) {
+                // Let the allocation engine know the address is free again.
+                alloc_engine_->leaseDeleted(Lease::TYPE_V4, lease->addr_);
+
                 // Release successful
                 LOG_DEBUG(dhcp4_logger, DBG_DHCP4_DETAIL, DHCP4_RELEASE)
                     .arg(lease->addr_.toText())
@@ -1412,20 +1709,24 @@ Dhcpv4Srv::serverReceivedPacketName(uint8_t type) {
 
 Subnet4Ptr
 Dhcpv4Srv::selectSubnet(const Pkt4Ptr& question) const {
+    PacketTiming::Scope timing(timing_, PacketTiming::SUBNET);
 
     Subnet4Ptr subnet;
     static const IOAddress notset("0.0.0.0");
     static const IOAddress bcast("255.255.255.255");
 
+    // The subnets are taken from the published configuration snapshot,
+    // which stays valid while this query is processed.
+    CfgMgr::SnapshotReader config;
+
     // If a message is relayed, use the relay (giaddr) address to select subnet
     // for the client. Note that this may result in exception if the value
     // of hops does not correspond with the Giaddr. Such message is considered
     // to be malformed anyway and the message will be dropped by the higher
     // level functions.
     if (question->isRelayed()) {
-        subnet = CfgMgr::instance().getSubnet4(question->getGiaddr(),
-                                               question->classes_,
-                                               true);
+        subnet = config->getSubnet4(question->getGiaddr(), question->classes_,
+                                    true);
 
     // The message is not relayed so it is sent directly by a client. But
     // the client may be renewing its lease and in such case it unicasts
@@ -1435,30 +1736,31 @@ Dhcpv4Srv::selectSubnet(const Pkt4Ptr& question) const {
     // we rely on the client's address to get the subnet.
     } else if ((question->getLocalAddr() != bcast) &&
                (question->getCiaddr() != notset)) {
-        subnet = CfgMgr::instance().getSubnet4(question->getCiaddr(),
-                                               question->classes_);
+        subnet = config->getSubnet4(question->getCiaddr(),
+                                    question->classes_);
 
     // The message has been received from a directly connected client
     // and this client appears to have no address. The IPv4 address
     // assigned to the interface on which this message has been received,
     // will be used to determine the subnet suitable for the client.
     } else {
-        subnet = CfgMgr::instance().getSubnet4(question->getIface(),
-                                               question->classes_);
+        subnet = config->getSubnet4(question->getIface(),
+                                    question->classes_);
     }
 
     // Let's execute all callouts registered for subnet4_select
     if (HooksManager::calloutsPresent(hook_index_subnet4_select_)) {
+        PacketTiming::Scope timing(timing_, PacketTiming::HOOKS);
         CalloutHandlePtr callout_handle = getCalloutHandle(question);
 
         // We're reusing callout_handle from previous calls
         callout_handle->deleteAllArguments();
 
         // Set new arguments
-        callout_handle->setArgument("query4", question);
-        callout_handle->setArgument("subnet4", subnet);
-        callout_handle->setArgument("subnet4collection",
-                                    CfgMgr::instance().getSubnets4());
+        callout_handle->setArgument(Hooks.arg_index_query4_, question);
+        callout_handle->setArgument(Hooks.arg_index_subnet4_, subnet);
+        callout_handle->setArgument(Hooks.arg_index_subnet4collection_,
+                                    config->getSubnets4());
 
         // Call user (and server-side) callouts
         HooksManager::callCallouts(hook_index_subnet4_select_,
@@ -1474,7 +1776,7 @@ Dhcpv4Srv::selectSubnet(const Pkt4Ptr& question) const {
         }
 
         // Use whatever subnet was specified by the callout
-        callout_handle->getArgument("subnet4", subnet);
+        callout_handle->getArgument(Hooks.arg_index_subnet4_, subnet);
     }
 
     return (subnet);
@@ -1661,7 +1963,8 @@ Dhcpv4Srv::sanityCheck(const Pkt4Ptr& pkt, RequirementLevel serverid) {
 void
 Dhcpv4Srv::openActiveSockets(const uint16_t port,
                              const bool use_bcast) {
-    IfaceMgr::instance().closeSockets();
+    bundy::dhcp::IfaceMgrErrorMsgCallback error_handler =
+        boost::bind(&Dhcpv4Srv::ifaceMgrSocket4ErrorHandler, _1);
 
     // Get the reference to the collection of interfaces. This reference should
     // be valid as long as the program is run because IfaceMgr is a singleton.
@@ -1677,7 +1980,9 @@ Dhcpv4Srv::openActiveSockets(const uint16_t port,
                       << " instance of the interface when DHCPv4 server was"
                       << " trying to reopen sockets after reconfiguration");
         }
-        if (CfgMgr::instance().isActiveIface(iface->getName())) {
+        const bool active = CfgMgr::instance().isActiveIface(iface->getName());
+        const bool changed = (iface_ptr->inactive4_ == active);
+        if (active) {
             iface_ptr->inactive4_ = false;
             LOG_INFO(dhcp4_logger, DHCP4_ACTIVATE_INTERFACE)
                 .arg(iface->getFullName());
@@ -1691,15 +1996,46 @@ Dhcpv4Srv::openActiveSockets(const uint16_t port,
             iface_ptr->inactive4_ = true;
 
         }
+
+        // Reopen the sockets of the interfaces affected by the new
+        // configuration only. reopenSockets4 will check internally whether
+        // the interface is marked active or inactive.
+        bool has_socket = false;
+        const Iface::SocketCollection& sockets = iface_ptr->getSockets();
+        for (Iface::SocketCollection::const_iterator sock = sockets.begin();
+             sock != sockets.end(); ++sock) {
+            if (sock->family_ == AF_INET) {
+                has_socket = true;
+                break;
+            }
+        }
+        if (changed || !has_socket) {
+            IfaceMgr::instance().reopenSockets4(iface->getName(), port,
+                                                use_bcast, error_handler);
+        }
+    }
+    if (!IfaceMgr::instance().hasOpenSocket(AF_INET)) {
+        LOG_WARN(dhcp4_logger, DHCP4_NO_SOCKETS_OPEN);
     }
-    // Let's reopen active sockets. openSockets4 will check internally whether
-    // sockets are marked active or inactive.
-    /// @todo Optimization: we should not reopen all sockets but rather select
-    /// those that have been affected by the new configuration.
+}
+
+void
+Dhcpv4Srv::ifacesChanged(const std::vector<std::string>& ifnames) {
     bundy::dhcp::IfaceMgrErrorMsgCallback error_handler =
         boost::bind(&Dhcpv4Srv::ifaceMgrSocket4ErrorHandler, _1);
-    if (!IfaceMgr::instance().openSockets4(port, use_bcast, error_handler)) {
-        LOG_WARN(dhcp4_logger, DHCP4_NO_SOCKETS_OPEN);
+
+    for (std::vector<std::string>::const_iterator name = ifnames.begin();
+         name != ifnames.end(); ++name) {
+        Iface* iface = IfaceMgr::instance().getIface(*name);
+        if (iface == NULL) {
+            LOG_INFO(dhcp4_logger, DHCP4_IFACE_REMOVED).arg(*name);
+            continue;
+        }
+        LOG_DEBUG(dhcp4_logger, DBG_DHCP4_BASIC, DHCP4_IFACE_CHANGED)
+            .arg(iface->getFullName());
+        iface->inactive4_ = !CfgMgr::instance().isActiveIface(*name);
+        IfaceMgr::instance().reopenSockets4(*name, port_, use_bcast_,
+                                            error_handler);
     }
 }
 
@@ -1707,22 +2043,20 @@ size_t
 Dhcpv4Srv::unpackOptions(const OptionBuffer& buf,
                          const std::string& option_space,
                          bundy::dhcp::OptionCollection& options) {
+    // The options are parsed when they are first used, which may be in
+    // any stage.
+    PacketTiming::Scope timing(timing_, PacketTiming::UNPACK);
     size_t offset = 0;
 
-    OptionDefContainer option_defs;
+    // Look up the option space once, so as the definition of each option
+    // is taken directly from the table.
+    const OptionDefTable* option_defs = NULL;
     if (option_space == "dhcp4") {
-        // Get the list of stdandard option definitions.
-        option_defs = LibDHCP::getOptionDefs(Option::V4);
+        // Get the table of standard option definitions.
+        option_defs = &LibDHCP::getOptionDefTable(Option::V4);
     } else if (!option_space.empty()) {
-        OptionDefContainerPtr option_defs_ptr =
-            CfgMgr::instance().getOptionDefs(option_space);
-        if (option_defs_ptr != NULL) {
-            option_defs = *option_defs_ptr;
-        }
+        option_defs = CfgMgr::instance().getOptionDefTable(option_space);
     }
-    // Get the search index #1. It allows to search for option definitions
-    // using option code.
-    const OptionDefContainerTypeIndex& idx = option_defs.get<1>();
 
     // The buffer being read comprises a set of options, each starting with
     // a one-byte type code and a one-byte length field.
@@ -1752,33 +2086,21 @@ Dhcpv4Srv::unpackOptions(const OptionBuffer& buf,
                       << "-byte long buffer.");
         }
 
-        // Get all definitions with the particular option code. Note that option code
-        // is non-unique within this container however at this point we expect
-        // to get one option definition with the particular code. If more are
-        // returned we report an error.
-        const OptionDefContainerTypeRange& range = idx.equal_range(opt_type);
-        // Get the number of returned option definitions for the option code.
-        size_t num_defs = distance(range.first, range.second);
+        // Get the definition of the option. The table holds at most one
+        // definition for each option code.
+        const OptionDefinitionPtr& def =
+            LibDHCP::findOptionDef(option_defs, opt_type);
 
         OptionPtr opt;
-        if (num_defs > 1) {
-            // Multiple options of the same code are not supported right now!
-            bundy_throw(bundy::Unexpected, "Internal error: multiple option definitions"
-                      " for option type " << static_cast<int>(opt_type)
-                      << " returned. Currently it is not supported to initialize"
-                      << " multiple option definitions for the same option code."
-                      << " This will be supported once support for option spaces"
-                      << " is implemented");
-        } else if (num_defs == 0) {
-            opt = OptionPtr(new Option(Option::V4, opt_type,
-                                       buf.begin() + offset,
-                                       buf.begin() + offset + opt_len));
+        if (!def) {
+            opt = boost::make_shared<Option>(Option::V4, opt_type,
+                                             buf.begin() + offset,
+                                             buf.begin() + offset +
+                                             opt_len);
             opt->setEncapsulatedSpace("dhcp4");
         } else {
             // The option definition has been found. Use it to create
             // the option instance from the provided buffer chunk.
-            const OptionDefinitionPtr& def = *(range.first);
-            assert(def);
             opt = def->optionFactory(Option::V4, opt_type,
                                      buf.begin() + offset,
                                      buf.begin() + offset + opt_len,
@@ -1799,6 +2121,22 @@ Dhcpv4Srv::ifaceMgrSocket4ErrorHandler(const std::string& errmsg) {
 }
 
 void Dhcpv4Srv::classifyPacket(const Pkt4Ptr& pkt) {
+    // Classes defined in the configuration. Their tests are evaluated
+    // against the received data, without parsing the options.
+    string defined_classes = "";
+    const ClientClassDefList& defs = CfgMgr::instance().getClientClassDefs();
+    for (ClientClassDefList::const_iterator def = defs.begin();
+         def != defs.end(); ++def) {
+        if (def->test_->evaluate(*pkt)) {
+            pkt->addClass(def->name_);
+            defined_classes += def->name_ + " ";
+        }
+    }
+    if (!defined_classes.empty()) {
+        LOG_DEBUG(dhcp4_logger, DBG_DHCP4_BASIC, DHCP4_CLASS_ASSIGNED)
+            .arg(defined_classes);
+    }
+
     boost::shared_ptr<OptionString> vendor_class =
         boost::dynamic_pointer_cast<OptionString>(pkt->getOption(DHO_VENDOR_CLASS_IDENTIFIER));
 
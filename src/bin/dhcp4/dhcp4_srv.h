@@ -25,12 +25,16 @@
 #include <dhcpsrv/d2_client_mgr.h>
 #include <dhcpsrv/subnet.h>
 #include <dhcpsrv/alloc_engine.h>
+#include <dhcpsrv/packet_timing.h>
+#include <dhcpsrv/receive_queue.h>
 #include <hooks/callout_handle.h>
+#include <hooks/parking_lot.h>
 
 #include <boost/noncopyable.hpp>
 
 #include <iostream>
 #include <queue>
+#include <vector>
 
 namespace bundy {
 namespace dhcp {
@@ -156,12 +160,30 @@ public:
     }
     //@}
 
+    /// @brief Returns the breakdown of the processing time of the packets.
+    ///
+    /// The timing is disabled by default; it is controlled with the
+    /// "packet-timing" command.
+    PacketTiming& getPacketTiming() {
+        return (timing_);
+    }
+
+    /// @brief Returns the queue of the received queries.
+    ///
+    /// Its statistics are returned by the "receive-queue" command.
+    ReceiveQueue<Pkt4Ptr>& getReceiveQueue() {
+        return (receive_queue_);
+    }
+
     /// @brief Open sockets which are marked as active in @c CfgMgr.
     ///
     /// This function reopens sockets according to the current settings in the
     /// Configuration Manager. It holds the list of the interfaces which server
     /// should listen on. This function will open sockets on these interfaces
-    /// only. This function is not exception safe.
+    /// only. The sockets of an interface are reopened only if it has been
+    /// activated or deactivated, or if it has no sockets, so that the other
+    /// interfaces keep receiving traffic while the server is reconfigured.
+    /// This function is not exception safe.
     ///
     /// @param port UDP port on which server should listen.
     /// @param use_bcast should broadcast flags be set on the sockets.
@@ -193,6 +215,81 @@ public:
                                       dhcp_ddns::NameChangeRequestPtr& ncr);
 protected:
 
+    /// @brief Processes a received packet.
+    ///
+    /// Runs a single query through all processing steps, from the
+    /// buffer4_receive callouts and parsing to sending the response (if
+    /// any). It is called by @c run() for each received packet; failures are
+    /// logged and cause the packet to be dropped.
+    ///
+    /// @todo Processing relies on the lease manager, the configuration
+    /// manager and the hooks framework, none of which can be used from
+    /// multiple threads yet. Once they can, this function is what worker
+    /// threads would run for each query dispatched to them.
+    ///
+    /// @param query query received from a client
+    void processPacket(Pkt4Ptr& query);
+
+    /// @brief Processes a query accepted by the pkt4_receive callouts.
+    ///
+    /// This is the part of @c processPacket after the pkt4_receive hook:
+    /// it generates the response and sends it. It is separate so that the
+    /// queries parked by the pkt4_receive callouts can go on from there
+    /// when they are resumed.
+    ///
+    /// @param query query received from a client
+    void processQuery(Pkt4Ptr& query);
+
+    /// @brief Goes on with a query parked by the pkt4_receive callouts.
+    ///
+    /// Called by the parking lot when the callouts have resumed or dropped
+    /// the query, or it has timed out.
+    ///
+    /// @param query the parked query
+    /// @param callout_handle the callout handle of the query, which holds
+    /// the per-packet context of the libraries
+    /// @param resume true if the query was resumed, false if it is dropped
+    void resumeQuery(Pkt4Ptr query,
+                     bundy::hooks::CalloutHandlePtr callout_handle,
+                     bool resume);
+
+    /// @brief Goes on with the parked queries which are ready.
+    ///
+    /// Called when the descriptor of the parking lot is readable, and by
+    /// @c run() when a parked query times out.
+    void processParkedQueries();
+
+    /// @brief Commits the lease writes and sends the held responses.
+    ///
+    /// When the lease manager works in group commit mode (see
+    /// @c LeaseMgr::getGroupCommit), @c processPacket holds the responses
+    /// instead of sending them, and @c run() calls this function once it
+    /// has processed all queries received so far, or the group commit
+    /// size of them. It commits the lease writes made for these queries
+    /// and sends the responses. If the commit fails, the writes are rolled
+    /// back and the responses are dropped so that no client is given a
+    /// lease missing from the lease database; the clients will retransmit.
+    void sendPendingResponses();
+
+    /// @brief Reclaims the expired leases.
+    ///
+    /// Fetches a batch of the expired leases from the lease database,
+    /// oldest first, and deletes them, queueing the removal of their DNS
+    /// entries. The allocation engine is told about the freed addresses.
+    /// @c run() calls this function each time the reclamation timer
+    /// configured in @c CfgMgr elapses, so that the expired leases don't
+    /// accumulate in the lease database.
+    ///
+    /// @param max_leases maximum number of leases to reclaim, zero for no
+    /// limit.
+    /// @param max_time maximum time the reclamation may take in
+    /// milliseconds, zero for no limit. The leases not reclaimed in time
+    /// are left for the next reclamation.
+    ///
+    /// @return number of leases reclaimed.
+    size_t reclaimExpiredLeases(const size_t max_leases,
+                                const uint32_t max_time);
+
     /// @name Functions filtering and sanity-checking received messages.
     ///
     /// @todo These functions are supposed to be moved to a new class which
@@ -642,6 +739,17 @@ protected:
     /// simulates reception of a packet. For that purpose it is protected.
     virtual Pkt4Ptr receivePacket(int timeout);
 
+    /// @brief Returns the next query to be processed.
+    ///
+    /// If the receive queue is enabled, the queries waiting on the sockets
+    /// are read into it (up to its limit at a time) and the next one is
+    /// taken from it, by priority. Otherwise this is @c receivePacket.
+    ///
+    /// @param timeout the time to wait for a query if none is waiting, in
+    /// seconds.
+    /// @return the query, NULL if none was received before the timeout.
+    Pkt4Ptr receiveQuery(int timeout);
+
     /// @brief dummy wrapper around IfaceMgr::send()
     ///
     /// This method is useful for testing purposes, where its replacement
@@ -662,9 +770,11 @@ protected:
 
     /// @brief Assigns incoming packet to zero or more classes.
     ///
-    /// @note For now, the client classification is very simple. It just uses
-    /// content of the vendor-class-identifier option as a class. The resulting
-    /// class will be stored in packet (see @ref bundy::dhcp::Pkt4::classes_ and
+    /// The packet is assigned to the classes defined in the configuration
+    /// (see @ref bundy::dhcp::CfgMgr::getClientClassDefs) whose test it
+    /// passes. In addition, the content of the vendor-class-identifier
+    /// option is used as a class. The resulting classes will be stored in
+    /// packet (see @ref bundy::dhcp::Pkt4::classes_ and
     /// @ref bundy::dhcp::Pkt4::inClass).
     ///
     /// @param pkt packet to be classified
@@ -696,6 +806,16 @@ private:
     /// @param errmsg An error message containing a cause of the failure.
     static void ifaceMgrSocket4ErrorHandler(const std::string& errmsg);
 
+    /// @brief Reopens the sockets of the interfaces which have changed.
+    ///
+    /// This callback function is installed on the @c bundy::dhcp::IfaceMgr
+    /// interface monitor. It marks each interface active or inactive
+    /// according to the configuration and reopens its sockets, leaving the
+    /// other interfaces alone.
+    ///
+    /// @param ifnames names of the interfaces which have changed.
+    void ifacesChanged(const std::vector<std::string>& ifnames);
+
     /// @brief Allocation Engine.
     /// Pointer to the allocation engine that we are currently using
     /// It must be a pointer, because we will support changing engines
@@ -709,6 +829,30 @@ private:
     int hook_index_pkt4_receive_;
     int hook_index_subnet4_select_;
     int hook_index_pkt4_send_;
+
+    /// Maximum number of queries for which the lease writes are committed
+    /// together, zero if the writes are committed as they are made.
+    size_t group_commit_;
+
+    /// Number of queries processed since the lease writes were committed.
+    size_t uncommitted_queries_;
+
+    /// Responses held until the lease writes made for them are committed.
+    std::vector<Pkt4Ptr> pending_responses_;
+
+    /// Time of the last reclamation of the expired leases.
+    time_t last_reclaim_;
+
+    /// Queries parked by the pkt4_receive callouts, while the hook
+    /// libraries wait for an external server for example.
+    bundy::hooks::ParkingLot parking_lot_;
+
+    /// Breakdown of the processing time of the packets. It is mutable as
+    /// the subnet selection is timed too.
+    mutable PacketTiming timing_;
+
+    /// Queries received but not processed yet, by priority.
+    ReceiveQueue<Pkt4Ptr> receive_queue_;
 };
 
 }; // namespace bundy::dhcp
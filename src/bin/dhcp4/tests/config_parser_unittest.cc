@@ -821,6 +821,120 @@ TEST_F(Dhcp4ParserTest, reconfigureRemoveSubnet) {
 
 }
 
+// Checks that the subnets whose configuration didn't change are kept as they
+// are on reconfiguration, while the changed ones are parsed again.
+TEST_F(Dhcp4ParserTest, reconfigureKeepUnchangedSubnets) {
+    ConstElementPtr x;
+
+    string config = "{ \"interfaces\": [ \"*\" ],"
+        "\"rebind-timer\": 2000, "
+        "\"renew-timer\": 1000, "
+        "\"subnet4\": [ { "
+        "    \"pool\": [ \"192.0.2.1 - 192.0.2.100\" ],"
+        "    \"subnet\": \"192.0.2.0/24\" "
+        " },"
+        " {"
+        "    \"pool\": [ \"192.0.3.101 - 192.0.3.150\" ],"
+        "    \"subnet\": \"192.0.3.0/24\" "
+        " },"
+        " {"
+        "    \"pool\": [ \"192.0.4.101 - 192.0.4.150\" ],"
+        "    \"subnet\": \"192.0.4.0/24\" "
+        " } ],"
+        "\"valid-lifetime\": 4000 }";
+
+    // The second subnet changed
+    string config_second_changed = "{ \"interfaces\": [ \"*\" ],"
+        "\"rebind-timer\": 2000, "
+        "\"renew-timer\": 1000, "
+        "\"subnet4\": [ { "
+        "    \"pool\": [ \"192.0.2.1 - 192.0.2.100\" ],"
+        "    \"subnet\": \"192.0.2.0/24\" "
+        " },"
+        " {"
+        "    \"pool\": [ \"192.0.3.101 - 192.0.3.150\" ],"
+        "    \"subnet\": \"192.0.3.0/24\", "
+        "    \"valid-lifetime\": 5000 "
+        " },"
+        " {"
+        "    \"pool\": [ \"192.0.4.101 - 192.0.4.150\" ],"
+        "    \"subnet\": \"192.0.4.0/24\" "
+        " } ],"
+        "\"valid-lifetime\": 4000 }";
+
+    ElementPtr json = Element::fromJSON(config);
+    EXPECT_NO_THROW(x = configureDhcp4Server(*srv_, json));
+    checkResult(x, 0);
+    const Subnet4Collection subnets = *CfgMgr::instance().getSubnets4();
+    ASSERT_EQ(3, subnets.size());
+
+    json = Element::fromJSON(config_second_changed);
+    EXPECT_NO_THROW(x = configureDhcp4Server(*srv_, json));
+    checkResult(x, 0);
+    const Subnet4Collection* new_subnets = CfgMgr::instance().getSubnets4();
+    ASSERT_EQ(3, new_subnets->size());
+    EXPECT_EQ(subnets[0], new_subnets->at(0));
+    EXPECT_NE(subnets[1], new_subnets->at(1));
+    EXPECT_EQ(subnets[2], new_subnets->at(2));
+    EXPECT_EQ(5000, new_subnets->at(1)->getValid());
+    EXPECT_EQ(1, new_subnets->at(0)->getID());
+    EXPECT_EQ(2, new_subnets->at(1)->getID());
+    EXPECT_EQ(3, new_subnets->at(2)->getID());
+
+    // A change of a global parameter affects all subnets.
+    json = Element::fromJSON(config);
+    json->set("valid-lifetime", Element::create(6000));
+    EXPECT_NO_THROW(x = configureDhcp4Server(*srv_, json));
+    checkResult(x, 0);
+    new_subnets = CfgMgr::instance().getSubnets4();
+    ASSERT_EQ(3, new_subnets->size());
+    EXPECT_NE(subnets[0], new_subnets->at(0));
+    EXPECT_NE(subnets[2], new_subnets->at(2));
+    EXPECT_EQ(6000, new_subnets->at(0)->getValid());
+}
+
+// Checks that the host reservations of the subnets are configured, also
+// when the subnets are reused, and that invalid ones are rejected.
+TEST_F(Dhcp4ParserTest, hostReservations) {
+    ConstElementPtr x;
+
+    string config = "{ \"interfaces\": [ \"*\" ],"
+        "\"rebind-timer\": 2000, "
+        "\"renew-timer\": 1000, "
+        "\"subnet4\": [ { "
+        "    \"pool\": [ \"192.0.2.1 - 192.0.2.100\" ],"
+        "    \"subnet\": \"192.0.2.0/24\", "
+        "    \"reservations\": [ {"
+        "        \"hw-address\": \"01:02:03:04:05:06\","
+        "        \"ip-address\": \"192.0.2.200\" } ]"
+        " } ],"
+        "\"valid-lifetime\": 4000 }";
+
+    ElementPtr json = Element::fromJSON(config);
+    EXPECT_NO_THROW(x = configureDhcp4Server(*srv_, json));
+    checkResult(x, 0);
+
+    HWAddrPtr hwaddr(new HWAddr(HWAddr::fromText("01:02:03:04:05:06")));
+    ConstHostPtr host = CfgMgr::instance().getHosts()->get4(1, hwaddr);
+    ASSERT_TRUE(host);
+    EXPECT_EQ("192.0.2.200", host->getIPv4Reservation().toText());
+
+    // The subnet is reused, the reservations are configured again.
+    EXPECT_NO_THROW(x = configureDhcp4Server(*srv_, json));
+    checkResult(x, 0);
+    EXPECT_TRUE(CfgMgr::instance().getHosts()->get4(1, hwaddr));
+
+    // An address out of the subnet is rejected, and the reservations are
+    // kept.
+    ConstCfgHostsPtr hosts = CfgMgr::instance().getHosts();
+    string bad_config = config;
+    bad_config.replace(bad_config.find("192.0.2.200"), 11, "192.0.3.1");
+    json = Element::fromJSON(bad_config);
+    EXPECT_NO_THROW(x = configureDhcp4Server(*srv_, json));
+    checkResult(x, 1);
+    EXPECT_EQ(hosts, CfgMgr::instance().getHosts());
+}
+
 /// @todo: implement subnet removal test as part of #3281.
 
 // Checks if the next-server defined as global parameter is taken into
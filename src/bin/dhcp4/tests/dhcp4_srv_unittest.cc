@@ -1322,6 +1322,39 @@ TEST_F(Dhcpv4SrvTest, ReleaseReject) {
     EXPECT_FALSE(l);
 }
 
+// This test verifies that the expired leases are reclaimed, the first
+// expired first, and that the valid leases are left alone.
+TEST_F(Dhcpv4SrvTest, reclaimExpiredLeases) {
+    boost::scoped_ptr<NakedDhcpv4Srv> srv;
+    ASSERT_NO_THROW(srv.reset(new NakedDhcpv4Srv(0)));
+
+    // Create two expired leases and a valid one, each for its own client.
+    const time_t now = time(NULL);
+    const char* addrs[] = { "192.0.2.105", "192.0.2.106", "192.0.2.107" };
+    const time_t cltts[] = { now - 300, now - 200, now };
+    for (int i = 0; i < 3; ++i) {
+        uint8_t mac_addr[] = { 0, 0xfe, 0xfe, 0xfe, 0xfe,
+                               static_cast<uint8_t>(i) };
+        Lease4Ptr lease(new Lease4(IOAddress(addrs[i]), mac_addr,
+                                   sizeof(mac_addr), NULL, 0, 100, 50, 75,
+                                   cltts[i], subnet_->getID()));
+        ASSERT_TRUE(LeaseMgrFactory::instance().addLease(lease));
+    }
+
+    // Only the lease which expired first should be reclaimed.
+    EXPECT_EQ(1, srv->reclaimExpiredLeases(1, 0));
+    EXPECT_FALSE(LeaseMgrFactory::instance().getLease4(IOAddress(addrs[0])));
+    EXPECT_TRUE(LeaseMgrFactory::instance().getLease4(IOAddress(addrs[1])));
+
+    // Without the limit, the other expired lease should be reclaimed.
+    EXPECT_EQ(1, srv->reclaimExpiredLeases(0, 0));
+    EXPECT_FALSE(LeaseMgrFactory::instance().getLease4(IOAddress(addrs[1])));
+
+    // The valid lease should be left alone.
+    EXPECT_EQ(0, srv->reclaimExpiredLeases(0, 0));
+    EXPECT_TRUE(LeaseMgrFactory::instance().getLease4(IOAddress(addrs[2])));
+}
+
 // Checks if received relay agent info option is echoed back to the client
 TEST_F(Dhcpv4SrvTest, relayAgentInfoEcho) {
     IfaceMgrTestConfig test_config(true);
@@ -1957,6 +1990,17 @@ public:
         return pkt4_receive_callout(callout_handle);
     }
 
+    /// test callback that parks the packet
+    /// @param callout_handle handle passed by the hooks framework
+    /// @return always 0
+    static int
+    pkt4_receive_park(CalloutHandle& callout_handle) {
+        callback_ticket_ = callout_handle.park();
+
+        // carry on as usual
+        return pkt4_receive_callout(callout_handle);
+    }
+
     /// Test callback that stores received callout name and pkt4 value
     /// @param callout_handle handle passed by the hooks framework
     /// @return always 0
@@ -2139,6 +2183,7 @@ public:
         callback_subnet4_.reset();
         callback_subnet4collection_ = NULL;
         callback_argument_names_.clear();
+        callback_ticket_.reset();
     }
 
     /// pointer to Dhcpv4Srv that is used in tests
@@ -2169,6 +2214,9 @@ public:
 
     /// A list of all received arguments
     static vector<string> callback_argument_names_;
+
+    /// Ticket of the packet parked by the callout
+    static ParkingTicketPtr callback_ticket_;
 };
 
 // The following fields are used in testing pkt4_receive_callout.
@@ -2181,6 +2229,7 @@ ClientIdPtr HooksDhcpv4SrvTest::callback_clientid_;
 Lease4Ptr HooksDhcpv4SrvTest::callback_lease4_;
 const Subnet4Collection* HooksDhcpv4SrvTest::callback_subnet4collection_;
 vector<string> HooksDhcpv4SrvTest::callback_argument_names_;
+ParkingTicketPtr HooksDhcpv4SrvTest::callback_ticket_;
 
 // Checks if callouts installed on pkt4_receive are indeed called and the
 // all necessary parameters are passed.
@@ -2416,6 +2465,52 @@ TEST_F(HooksDhcpv4SrvTest, pkt4ReceiveSkip) {
     ASSERT_EQ(0, srv_->fake_sent_.size());
 }
 
+// Checks if a packet parked by the callouts installed on pkt4_receive is
+// processed once they resume it.
+TEST_F(HooksDhcpv4SrvTest, pkt4ReceivePark) {
+    IfaceMgrTestConfig test_config(true);
+    IfaceMgr::instance().openSockets4();
+
+    // Install pkt4_receive_park
+    EXPECT_NO_THROW(HooksManager::preCalloutsLibraryHandle().registerCallout(
+                        "pkt4_receive", pkt4_receive_park));
+
+    // Let's create a simple DISCOVER
+    Pkt4Ptr sol = generateSimpleDiscover();
+    srv_->fakeReceive(sol);
+    srv_->run();
+
+    // The packet is parked, so there is no response yet
+    ASSERT_TRUE(callback_ticket_);
+    EXPECT_EQ(0, srv_->fake_sent_.size());
+
+    // The response is sent once the callout resumes the packet
+    callback_ticket_->resume();
+    srv_->processParkedQueries();
+    ASSERT_EQ(1, srv_->fake_sent_.size());
+    EXPECT_EQ(DHCPOFFER, srv_->fake_sent_.front()->getType());
+}
+
+// Checks if a packet parked by the callouts installed on pkt4_receive is
+// dropped when they drop it.
+TEST_F(HooksDhcpv4SrvTest, pkt4ReceiveParkDrop) {
+    IfaceMgrTestConfig test_config(true);
+    IfaceMgr::instance().openSockets4();
+
+    // Install pkt4_receive_park
+    EXPECT_NO_THROW(HooksManager::preCalloutsLibraryHandle().registerCallout(
+                        "pkt4_receive", pkt4_receive_park));
+
+    Pkt4Ptr sol = generateSimpleDiscover();
+    srv_->fakeReceive(sol);
+    srv_->run();
+    ASSERT_TRUE(callback_ticket_);
+
+    callback_ticket_->drop();
+    srv_->processParkedQueries();
+    EXPECT_EQ(0, srv_->fake_sent_.size());
+}
+
 
 // Checks if callouts installed on pkt4_send are indeed called and the
 // all necessary parameters are passed.
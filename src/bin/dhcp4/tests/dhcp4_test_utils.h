@@ -188,6 +188,8 @@ public:
     using Dhcpv4Srv::processRequest;
     using Dhcpv4Srv::processRelease;
     using Dhcpv4Srv::processDecline;
+    using Dhcpv4Srv::reclaimExpiredLeases;
+    using Dhcpv4Srv::processParkedQueries;
     using Dhcpv4Srv::processInform;
     using Dhcpv4Srv::processClientName;
     using Dhcpv4Srv::computeDhcid;
@@ -375,20 +375,28 @@ public:
     /// @throw throws Unexpected if dynamic cast fails.
     void commit() {
         if (subnet_) {
-            Subnet6Ptr sub6ptr = boost::dynamic_pointer_cast<Subnet6>(subnet_);
-            if (!sub6ptr) {
-                // If we hit this, it is a programming error.
-                bundy_throw(Unexpected,
-                          "Invalid cast in Subnet4ConfigParser::commit");
-            }
+            bundy::dhcp::CfgMgr::instance().addSubnet6(getSubnet6());
+        }
+    }
 
-            // Set relay infomation if it was provided
-            if (relay_info_) {
-                sub6ptr->setRelayInfo(*relay_info_);
-            }
+    /// @brief Returns the created subnet.
+    ///
+    /// @return the subnet, with the relay information set if it was
+    /// provided.
+    /// @throw throws Unexpected if dynamic cast fails.
+    Subnet6Ptr getSubnet6() {
+        Subnet6Ptr sub6ptr = boost::dynamic_pointer_cast<Subnet6>(subnet_);
+        if (!sub6ptr) {
+            // If we hit this, it is a programming error.
+            bundy_throw(Unexpected,
+                      "Invalid cast in Subnet6ConfigParser::getSubnet6");
+        }
 
-            bundy::dhcp::CfgMgr::instance().addSubnet6(sub6ptr);
+        // Set relay infomation if it was provided
+        if (relay_info_) {
+            sub6ptr->setRelayInfo(*relay_info_);
         }
+        return (sub6ptr);
     }
 
 protected:
@@ -547,11 +555,18 @@ protected:
 };
 
 
+/// @brief Returns the subnets built from the last committed configuration.
+SubnetConfigCache<Subnet6>& subnet6Cache() {
+    static SubnetConfigCache<Subnet6> cache("subnet6");
+    return (cache);
+}
+
 /// @brief this class parses a list of DHCP6 subnets
 ///
 /// This is a wrapper parser that handles the whole list of Subnet6
 /// definitions. It iterates over all entries and creates Subnet6ConfigParser
-/// for each entry.
+/// for each entry whose subnet can't be reused from the previous
+/// configuration (see @c SubnetConfigCache).
 class Subnets6ListConfigParser : public DhcpConfigParser {
 public:
 
@@ -559,39 +574,49 @@ public:
     ///
     /// @param dummy first argument, always ignored. All parsers accept a
     /// string parameter "name" as their first argument.
-    Subnets6ListConfigParser(const std::string&) {
+    Subnets6ListConfigParser(const std::string&)
+        : hosts_(new CfgHosts()) {
     }
 
     /// @brief parses contents of the list
     ///
     /// Iterates over all entries on the list and creates a Subnet6ConfigParser
-    /// for each entry.
+    /// for each entry which changed since the previous configuration.
+    /// @c subnet6Cache().startConfig() must have been called for the new
+    /// configuration.
     ///
     /// @param subnets_list pointer to a list of IPv6 subnets
     void build(ConstElementPtr subnets_list) {
         BOOST_FOREACH(ConstElementPtr subnet, subnets_list->listValue()) {
-            ParserPtr parser(new Subnet6ConfigParser("subnet"));
-            parser->build(subnet);
-            subnets_.push_back(parser);
+            Subnet6Ptr subnet6 = subnet6Cache().reuseSubnet(subnet);
+            if (!subnet6) {
+                Subnet6ConfigParser parser("subnet");
+                parser.build(subnet);
+                subnet6 = parser.getSubnet6();
+            }
+            // The host reservations are parsed (and the subnet ID they
+            // refer to is known) whether the subnet is reused or not.
+            ConstElementPtr reservations = subnet->get("reservations");
+            if (reservations) {
+                HostReservationsListParser parser("reservations", subnet6,
+                                                  hosts_, Option::V6);
+                parser.build(reservations);
+                parser.commit();
+            }
+            subnet6Cache().addSubnet(subnet, subnet6);
+            subnets_.push_back(subnet6);
         }
 
     }
 
     /// @brief commits subnets definitions.
     ///
-    /// Iterates over all Subnet6 parsers. Each parser contains definitions of
-    /// a single subnet and its parameters and commits each subnet separately.
+    /// Replaces the subnets of the server's configuration with the parsed
+    /// ones in one go. The reused subnets stay in place.
     void commit() {
-        // @todo: Implement more subtle reconfiguration than toss
-        // the old one and replace with the new one.
-
-        // remove old subnets
-        bundy::dhcp::CfgMgr::instance().deleteSubnets6();
-
-        BOOST_FOREACH(ParserPtr subnet, subnets_) {
-            subnet->commit();
-        }
-
+        bundy::dhcp::CfgMgr::instance().replaceSubnets6(subnets_);
+        bundy::dhcp::CfgMgr::instance().setHosts(hosts_);
+        subnet6Cache().commit();
     }
 
     /// @brief Returns Subnet6ListConfigParser object
@@ -601,8 +626,11 @@ public:
         return (new Subnets6ListConfigParser(param_name));
     }
 
-    /// @brief collection of subnet parsers.
-    ParserCollection subnets_;
+    /// @brief collection of parsed subnets.
+    Subnet6Collection subnets_;
+
+    /// @brief host reservations of the parsed subnets.
+    CfgHostsPtr hosts_;
 };
 
 } // anonymous namespace
@@ -624,7 +652,12 @@ DhcpConfigParser* createGlobal6DhcpConfigParser(const std::string& config_id) {
     if ((config_id.compare("preferred-lifetime") == 0)  ||
         (config_id.compare("valid-lifetime") == 0)  ||
         (config_id.compare("renew-timer") == 0)  ||
-        (config_id.compare("rebind-timer") == 0))  {
+        (config_id.compare("rebind-timer") == 0)  ||
+        (config_id.compare("reclaim-timer") == 0)  ||
+        (config_id.compare("reclaim-max-leases") == 0)  ||
+        (config_id.compare("reclaim-max-time") == 0)  ||
+        (config_id.compare("receive-queue-limit") == 0)  ||
+        (config_id.compare("shed-threshold") == 0))  {
         parser = new Uint32Parser(config_id,
                                  globalContext()->uint32_values_);
     } else if (config_id.compare("interfaces") == 0) {
@@ -648,6 +681,8 @@ DhcpConfigParser* createGlobal6DhcpConfigParser(const std::string& config_id) {
         parser = new HooksLibrariesParser(config_id);
     } else if (config_id.compare("dhcp-ddns") == 0) {
         parser = new D2ClientConfigParser(config_id);
+    } else if (config_id.compare("client-classes") == 0) {
+        parser = new ClientClassDefListParser(config_id, Option::V6);
     } else {
         bundy_throw(NotImplemented,
                 "Parser error: Global configuration parameter not supported: "
@@ -657,6 +692,22 @@ DhcpConfigParser* createGlobal6DhcpConfigParser(const std::string& config_id) {
     return (parser);
 }
 
+void commitGlobalOptions() {
+    // Set the parameters of the expired leases reclamation. They are all
+    // optional and the reclamation is disabled unless the timer is set.
+    Uint32StoragePtr uint32_values = globalContext()->uint32_values_;
+    CfgMgr::instance().setLeaseReclamation(
+        uint32_values->getOptionalParam("reclaim-timer", 0),
+        uint32_values->getOptionalParam("reclaim-max-leases", 100),
+        uint32_values->getOptionalParam("reclaim-max-time", 250));
+
+    // Set the limits of the queue of the received queries, which is
+    // disabled by default.
+    CfgMgr::instance().setReceiveQueue(
+        uint32_values->getOptionalParam("receive-queue-limit", 0),
+        uint32_values->getOptionalParam("shed-threshold", 0));
+}
+
 bundy::data::ConstElementPtr
 configureDhcp6Server(Dhcpv6Srv&, bundy::data::ConstElementPtr config_set) {
     if (!config_set) {
@@ -759,6 +810,8 @@ configureDhcp6Server(Dhcpv6Srv&, bundy::data::ConstElementPtr config_set) {
         std::map<std::string, ConstElementPtr>::const_iterator subnet_config =
             values_map.find("subnet6");
         if (subnet_config != values_map.end()) {
+            subnet6Cache().startConfig(config_set,
+                                       *CfgMgr::instance().getSubnets6());
             subnet_parser->build(subnet_config->second);
         }
 
@@ -793,6 +846,9 @@ configureDhcp6Server(Dhcpv6Srv&, bundy::data::ConstElementPtr config_set) {
                 iface_parser->commit();
             }
 
+            // Apply global options
+            commitGlobalOptions();
+
             // This occurs last as if it succeeds, there is no easy way to
             // revert it.  As a result, the failure to commit a subsequent
             // change causes problems when trying to roll back.
@@ -822,6 +878,9 @@ configureDhcp6Server(Dhcpv6Srv&, bundy::data::ConstElementPtr config_set) {
         return (answer);
     }
 
+    // The packets are processed with the new configuration from now on.
+    CfgMgr::instance().publishSnapshot();
+
     LOG_INFO(dhcp6_logger, DHCP6_CONFIG_COMPLETE).arg(config_details);
 
     // Everything was fine. Configuration is successful.
@@ -104,6 +104,10 @@ ControlledDhcpv6Srv::dhcp6ConfigHandler(ConstElementPtr new_config) {
             .arg(merged_config->str());
     }
 
+    // The new configuration may replace the lease manager, so commit the
+    // lease writes held for group commit first.
+    server_->sendPendingResponses();
+
     // Configure the server.
     ConstElementPtr answer = configureDhcp6Server(*server_, merged_config);
 
@@ -170,6 +174,97 @@ ControlledDhcpv6Srv::dhcp6CommandHandler(const string& command, ConstElementPtr
         ConstElementPtr answer = bundy::config::createAnswer(0,
                                  "Hooks libraries successfully reloaded.");
         return (answer);
+
+    } else if (command == "hooks-statistics") {
+        // Optionally enable/disable or clear the collection of callout
+        // statistics, then return the figures collected so far.
+        ConstElementPtr enable = args->get("enable");
+        if (enable) {
+            HooksManager::setStatisticsEnabled(enable->boolValue());
+        }
+        ConstElementPtr clear = args->get("clear");
+        if (clear && clear->boolValue()) {
+            HooksManager::clearStatistics();
+        }
+
+        ElementPtr callouts = Element::createList();
+        const vector<HookStatistics> stats = HooksManager::getStatistics();
+        for (vector<HookStatistics>::const_iterator i = stats.begin();
+             i != stats.end(); ++i) {
+            ElementPtr entry = Element::createMap();
+            entry->set("hook", Element::create(i->hook_name_));
+            entry->set("library", Element::create(i->library_name_));
+            entry->set("calls", Element::create(static_cast<long long int>(
+                                                i->statistics_.calls_)));
+            // Times are reported in microseconds.
+            entry->set("total-time", Element::create(static_cast<long long int>(
+                                     i->statistics_.total_time_ / 1000)));
+            entry->set("max-time", Element::create(static_cast<long long int>(
+                                   i->statistics_.max_time_ / 1000)));
+            callouts->add(entry);
+        }
+        ElementPtr result = Element::createMap();
+        result->set("enabled",
+                    Element::create(HooksManager::getStatisticsEnabled()));
+        result->set("callouts", callouts);
+
+        ConstElementPtr answer = bundy::config::createAnswer(0, result);
+        return (answer);
+
+    } else if (command == "packet-timing") {
+        // Optionally enable/disable or clear the timing of the packets and
+        // start or stop the trace of the slow ones, then return the times
+        // collected so far.
+        if (!ControlledDhcpv6Srv::server_) {
+            LOG_WARN(dhcp6_logger, DHCP6_NOT_RUNNING);
+            ConstElementPtr answer = bundy::config::createAnswer(1,
+                                     "Server is not running.");
+            return (answer);
+        }
+        PacketTiming& timing = ControlledDhcpv6Srv::server_->getPacketTiming();
+        ConstElementPtr enable = args->get("enable");
+        if (enable) {
+            timing.setEnabled(enable->boolValue());
+        }
+        ConstElementPtr clear = args->get("clear");
+        if (clear && clear->boolValue()) {
+            timing.clear();
+        }
+        ConstElementPtr trace_file = args->get("trace-file");
+        if (trace_file) {
+            if (trace_file->stringValue().empty()) {
+                timing.closeTrace();
+            } else {
+                // The threshold is in microseconds.
+                ConstElementPtr threshold = args->get("trace-threshold");
+                timing.openTrace(trace_file->stringValue(),
+                                 threshold ? threshold->intValue() : 0);
+            }
+        }
+
+        ConstElementPtr answer =
+            bundy::config::createAnswer(0, timing.toElement());
+        return (answer);
+
+    } else if (command == "receive-queue") {
+        // Optionally clear the counters of the queue of the received
+        // queries, then return them with the queries waiting.
+        if (!ControlledDhcpv6Srv::server_) {
+            LOG_WARN(dhcp6_logger, DHCP6_NOT_RUNNING);
+            ConstElementPtr answer = bundy::config::createAnswer(1,
+                                     "Server is not running.");
+            return (answer);
+        }
+        ReceiveQueueBase& queue =
+            ControlledDhcpv6Srv::server_->getReceiveQueue();
+        ConstElementPtr clear = args->get("clear");
+        if (clear && clear->boolValue()) {
+            queue.clearStatistics();
+        }
+
+        ConstElementPtr answer =
+            bundy::config::createAnswer(0, queue.toElement());
+        return (answer);
     }
 
     ConstElementPtr answer = bundy::config::createAnswer(1,
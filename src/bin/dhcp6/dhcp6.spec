@@ -54,6 +54,36 @@
         "item_default": 4000
       },
 
+      { "item_name": "reclaim-timer",
+        "item_type": "integer",
+        "item_optional": true,
+        "item_default": 0
+      },
+
+      { "item_name": "reclaim-max-leases",
+        "item_type": "integer",
+        "item_optional": true,
+        "item_default": 100
+      },
+
+      { "item_name": "reclaim-max-time",
+        "item_type": "integer",
+        "item_optional": true,
+        "item_default": 250
+      },
+
+      { "item_name": "receive-queue-limit",
+        "item_type": "integer",
+        "item_optional": true,
+        "item_default": 0
+      },
+
+      { "item_name": "shed-threshold",
+        "item_type": "integer",
+        "item_optional": true,
+        "item_default": 0
+      },
+
       { "item_name": "option-def",
         "item_type": "list",
         "item_optional": false,
@@ -191,6 +221,48 @@
                 "item_type": "boolean",
                 "item_optional": true,
                 "item_default": true
+            },
+            {
+                "item_name": "group-commit",
+                "item_type": "integer",
+                "item_optional": true,
+                "item_default": 0
+            },
+            {
+                "item_name": "standby-address",
+                "item_type": "string",
+                "item_optional": true,
+                "item_default": ""
+            },
+            {
+                "item_name": "standby-port",
+                "item_type": "integer",
+                "item_optional": true,
+                "item_default": 0
+            },
+            {
+                "item_name": "listen-address",
+                "item_type": "string",
+                "item_optional": true,
+                "item_default": ""
+            },
+            {
+                "item_name": "listen-port",
+                "item_type": "integer",
+                "item_optional": true,
+                "item_default": 0
+            },
+            {
+                "item_name": "lfc-threshold",
+                "item_type": "integer",
+                "item_optional": true,
+                "item_default": 0
+            },
+            {
+                "item_name": "shards",
+                "item_type": "integer",
+                "item_optional": true,
+                "item_default": 1
             }
         ]
       },
@@ -322,6 +394,51 @@
                        }]
                     }
                 },
+                { "item_name": "reservations",
+                  "item_type": "list",
+                  "item_optional": false,
+                  "item_default": [],
+                  "item_description" : "Addresses reserved for specific hosts",
+                  "list_item_spec":
+                  {
+                    "item_name": "reservation",
+                    "item_type": "map",
+                    "item_optional": false,
+                    "item_default": {},
+                    "map_item_spec": [
+                    {
+                      "item_name": "hw-address",
+                      "item_type": "string",
+                      "item_optional": false,
+                      "item_default": ""
+                    },
+                    {
+                      "item_name": "duid",
+                      "item_type": "string",
+                      "item_optional": false,
+                      "item_default": ""
+                    },
+                    {
+                      "item_name": "ip-addresses",
+                      "item_type": "list",
+                      "item_optional": false,
+                      "item_default": [],
+                      "list_item_spec":
+                      {
+                        "item_name": "ip-address",
+                        "item_type": "string",
+                        "item_optional": false,
+                        "item_default": ""
+                      }
+                    },
+                    {
+                      "item_name": "hostname",
+                      "item_type": "string",
+                      "item_optional": false,
+                      "item_default": ""
+                    } ]
+                  }
+                },
                 { "item_name": "option-data",
                   "item_type": "list",
                   "item_optional": false,
@@ -365,6 +482,32 @@
                 } ]
             }
       },
+      { "item_name": "client-classes",
+        "item_type": "list",
+        "item_optional": false,
+        "item_default": [],
+        "list_item_spec":
+        {
+          "item_name": "client-class",
+          "item_type": "map",
+          "item_optional": false,
+          "item_default": {},
+          "map_item_spec": [
+          {
+            "item_name": "name",
+            "item_type": "string",
+            "item_optional": false,
+            "item_default": ""
+          },
+
+          { "item_name": "test",
+            "item_type": "string",
+            "item_optional": false,
+            "item_default": ""
+          } ]
+        }
+      },
+
       { "item_name": "dhcp-ddns",
         "item_type": "map",
         "item_optional": false,
@@ -470,6 +613,62 @@
             "command_name": "libreload",
             "command_description": "Reloads the current hooks libraries.",
             "command_args": []
+        },
+
+        {
+            "command_name": "hooks-statistics",
+            "command_description": "Returns call counts and execution times of hooks library callouts. Collection is disabled by default; it can be enabled, disabled or cleared with the arguments.",
+            "command_args": [
+                {
+                    "item_name": "enable",
+                    "item_type": "boolean",
+                    "item_optional": true
+                },
+                {
+                    "item_name": "clear",
+                    "item_type": "boolean",
+                    "item_optional": true
+                }
+            ]
+        },
+
+        {
+            "command_name": "packet-timing",
+            "command_description": "Returns histograms of the time spent in each stage of the processing of the packets, in microseconds. Timing is disabled by default; it can be enabled, disabled or cleared with the arguments. The packets slower than the trace-threshold (in microseconds) can be written to a binary trace file; an empty trace-file stops the trace.",
+            "command_args": [
+                {
+                    "item_name": "enable",
+                    "item_type": "boolean",
+                    "item_optional": true
+                },
+                {
+                    "item_name": "clear",
+                    "item_type": "boolean",
+                    "item_optional": true
+                },
+                {
+                    "item_name": "trace-file",
+                    "item_type": "string",
+                    "item_optional": true
+                },
+                {
+                    "item_name": "trace-threshold",
+                    "item_type": "integer",
+                    "item_optional": true
+                }
+            ]
+        },
+
+        {
+            "command_name": "receive-queue",
+            "command_description": "Returns the number of queries waiting in the queue of the received queries, by priority, and the number of queries dropped by the load shedding, by message type. The counters can be cleared with the argument.",
+            "command_args": [
+                {
+                    "item_name": "clear",
+                    "item_type": "boolean",
+                    "item_optional": true
+                }
+            ]
         }
     ]
   }
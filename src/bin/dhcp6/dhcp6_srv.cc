@@ -47,10 +47,12 @@
 #include <util/range_utilities.h>
 
 #include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/foreach.hpp>
 #include <boost/tokenizer.hpp>
 #include <boost/algorithm/string/erase.hpp>
 
+#include <algorithm>
 #include <stdlib.h>
 #include <time.h>
 #include <iomanip>
@@ -115,7 +117,9 @@ const std::string Dhcpv6Srv::VENDOR_CLASS_PREFIX("VENDOR_CLASS_");
 static const char* SERVER_DUID_FILE = "bundy-dhcp6-serverid";
 
 Dhcpv6Srv::Dhcpv6Srv(uint16_t port)
-:alloc_engine_(), serverid_(), port_(port), shutdown_(true)
+:alloc_engine_(), serverid_(), port_(port), shutdown_(true),
+ group_commit_(0), uncommitted_queries_(0), last_reclaim_(0),
+ receive_queue_(Option::V6)
 {
 
     LOG_DEBUG(dhcp6_logger, DBG_DHCP6_START, DHCP6_OPEN_SOCKET).arg(port);
@@ -157,7 +161,8 @@ Dhcpv6Srv::Dhcpv6Srv(uint16_t port)
         }
 
         // Instantiate allocation engine
-        alloc_engine_.reset(new AllocEngine(AllocEngine::ALLOC_ITERATIVE, 100));
+        alloc_engine_.reset(new AllocEngine(AllocEngine::ALLOC_PREFIX_TREE,
+                                            100));
 
         /// @todo call loadLibraries() when handling configuration changes
 
@@ -185,6 +190,28 @@ Pkt6Ptr Dhcpv6Srv::receivePacket(int timeout) {
     return (IfaceMgr::instance().receive6(timeout));
 }
 
+Pkt6Ptr Dhcpv6Srv::receiveQuery(int timeout) {
+    // The limits may have been changed by a reconfiguration.
+    receive_queue_.setLimits(CfgMgr::instance().getReceiveQueueLimit(),
+                             CfgMgr::instance().getShedThreshold());
+    if (!receive_queue_.isEnabled()) {
+        // The queries queued before the queue was disabled go first.
+        Pkt6Ptr query = receive_queue_.pop();
+        return (query ? query : receivePacket(timeout));
+    }
+
+    // Read the queries already received, so that the ones of the existing
+    // clients overtake the new clients. Only wait if none is queued.
+    for (size_t reads = 0; reads < receive_queue_.getLimit(); ++reads) {
+        Pkt6Ptr query = receivePacket(receive_queue_.size() > 0 ? 0 : timeout);
+        if (!query) {
+            break;
+        }
+        receive_queue_.push(query);
+    }
+    return (receive_queue_.pop());
+}
+
 void Dhcpv6Srv::sendPacket(const Pkt6Ptr& packet) {
     IfaceMgr::instance().send(packet);
 }
@@ -243,14 +270,31 @@ bool Dhcpv6Srv::run() {
         /// were some issues reported on some systems when calling select()
         /// with too large values. Unfortunately, I don't recall the details.
         //cppcheck-suppress variableScope This is temporary anyway
-        const int timeout = 1000;
+        int timeout = 1000;
+
+        // Reclaim the expired leases when the reclamation timer elapses,
+        // and wake up in time for the next reclamation.
+        const uint32_t reclaim_timer = CfgMgr::instance().getReclaimTimer();
+        if (reclaim_timer > 0) {
+            const time_t now = time(NULL);
+            if (now - last_reclaim_ >= reclaim_timer) {
+                last_reclaim_ = now;
+                // Commit the held lease writes first, so that the
+                // reclamation is committed on its own.
+                sendPendingResponses();
+                reclaimExpiredLeases(CfgMgr::instance().getReclaimMaxLeases(),
+                                     CfgMgr::instance().getReclaimMaxTime());
+            }
+            timeout = std::min(timeout, static_cast<int>(reclaim_timer));
+        }
 
-        // client's message and server's response
+        // client's message
         Pkt6Ptr query;
-        Pkt6Ptr rsp;
 
         try {
-            query = receivePacket(timeout);
+            // While lease writes are waiting for the group commit, only
+            // take the queries which have already been received.
+            query = receiveQuery(uncommitted_queries_ > 0 ? 0 : timeout);
         } catch (const std::exception& e) {
             LOG_ERROR(dhcp6_logger, DHCP6_PACKET_RECEIVE_FAIL).arg(e.what());
         }
@@ -258,274 +302,404 @@ bool Dhcpv6Srv::run() {
         // Timeout may be reached or signal received, which breaks select()
         // with no packet received
         if (!query) {
+            sendPendingResponses();
             continue;
         }
 
-        // In order to parse the DHCP options, the server needs to use some
-        // configuration information such as: existing option spaces, option
-        // definitions etc. This is the kind of information which is not
-        // available in the libdhcp, so we need to supply our own implementation
-        // of the option parsing function here, which would rely on the
-        // configuration data.
-        query->setCallback(boost::bind(&Dhcpv6Srv::unpackOptions, this, _1, _2,
-                                       _3, _4, _5));
+        timing_.start(query->getTimestamp());
+
+        // The lease manager is replaced when the server is reconfigured,
+        // so check for group commit for each query.
+        group_commit_ = 0;
+        if (LeaseMgrFactory::haveInstance()) {
+            LeaseMgr& lease_mgr = LeaseMgrFactory::instance();
+            group_commit_ = lease_mgr.getGroupCommit();
+            // Outside of the group commit mode, the leases of all IAs of
+            // the query are written in one transaction, committed before
+            // the response is sent.
+            lease_mgr.beginTransaction();
+        }
 
-        bool skip_unpack = false;
+        processPacket(query);
 
-        // The packet has just been received so contains the uninterpreted wire
-        // data; execute callouts registered for buffer6_receive.
-        if (HooksManager::calloutsPresent(Hooks.hook_index_buffer6_receive_)) {
-            CalloutHandlePtr callout_handle = getCalloutHandle(query);
+        if (++uncommitted_queries_ >= std::max(group_commit_,
+                                               static_cast<size_t>(1))) {
+            sendPendingResponses();
+        }
 
-            // Delete previously set arguments
-            callout_handle->deleteAllArguments();
+        timing_.finish(query->getType());
+    }
 
-            // Pass incoming packet as argument
-            callout_handle->setArgument("query6", query);
+    sendPendingResponses();
 
-            // Call callouts
-            HooksManager::callCallouts(Hooks.hook_index_buffer6_receive_, *callout_handle);
+    return (true);
+}
 
-            // Callouts decided to skip the next processing step. The next
-            // processing step would to parse the packet, so skip at this
-            // stage means that callouts did the parsing already, so server
-            // should skip parsing.
-            if (callout_handle->getSkip()) {
-                LOG_DEBUG(dhcp6_logger, DBG_DHCP6_HOOKS, DHCP6_HOOK_BUFFER_RCVD_SKIP);
-                skip_unpack = true;
-            }
+void
+Dhcpv6Srv::sendPendingResponses() {
+    if (uncommitted_queries_ == 0) {
+        return;
+    }
+    uncommitted_queries_ = 0;
 
-            callout_handle->getArgument("query6", query);
+    try {
+        PacketTiming::Scope timing(timing_, PacketTiming::COMMIT);
+        if (LeaseMgrFactory::haveInstance()) {
+            LeaseMgrFactory::instance().commit();
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR(dhcp6_logger, DHCP6_LEASE_COMMIT_FAIL)
+            .arg(pending_responses_.size()).arg(e.what());
+        try {
+            LeaseMgrFactory::instance().rollback();
+        } catch (const std::exception&) {
+            // The failure to commit has already been logged.
         }
+        pending_responses_.clear();
+        return;
+    }
 
-        // Unpack the packet information unless the buffer6_receive callouts
-        // indicated they did it
-        if (!skip_unpack) {
-            if (!query->unpack()) {
-                LOG_DEBUG(dhcp6_logger, DBG_DHCP6_DETAIL,
-                          DHCP6_PACKET_PARSE_FAIL);
+    for (std::vector<Pkt6Ptr>::const_iterator rsp = pending_responses_.begin();
+         rsp != pending_responses_.end(); ++rsp) {
+        try {
+            PacketTiming::Scope timing(timing_, PacketTiming::SEND);
+            sendPacket(*rsp);
+        } catch (const std::exception& e) {
+            LOG_ERROR(dhcp6_logger, DHCP6_PACKET_SEND_FAIL)
+                .arg(e.what());
+        }
+    }
+    pending_responses_.clear();
+}
+
+size_t
+Dhcpv6Srv::reclaimExpiredLeases(const size_t max_leases,
+                                 const uint32_t max_time) {
+    if (!LeaseMgrFactory::haveInstance()) {
+        return (0);
+    }
+
+    using namespace boost::posix_time;
+    const ptime start = microsec_clock::universal_time();
+    size_t reclaimed = 0;
+    Lease6Collection leases;
+    try {
+        LeaseMgr& lease_mgr = LeaseMgrFactory::instance();
+        leases = lease_mgr.getExpiredLeases6(max_leases);
+        for (Lease6Collection::const_iterator lease = leases.begin();
+             lease != leases.end(); ++lease) {
+            // Leave the remaining leases for the next reclamation if
+            // this one has taken too long.
+            if ((max_time > 0) &&
+                ((microsec_clock::universal_time() - start).total_milliseconds()
+                 >= max_time)) {
+                break;
+            }
+
+            if (!lease_mgr.deleteLease((*lease)->addr_)) {
                 continue;
             }
+            ++reclaimed;
+            alloc_engine_->leaseDeleted((*lease)->type_, (*lease)->addr_);
+
+            // Remove existing DNS entries for the lease, if any.
+            createRemovalNameChangeRequest(*lease);
         }
+        lease_mgr.commit();
+    } catch (const std::exception& ex) {
+        LOG_ERROR(dhcp6_logger, DHCP6_LEASE_RECLAIM_FAIL).arg(ex.what());
+        return (reclaimed);
+    }
+
+    LOG_DEBUG(dhcp6_logger, DBG_DHCP6_BASIC, DHCP6_LEASE_RECLAIM)
+        .arg(reclaimed).arg(leases.size())
+        .arg((microsec_clock::universal_time() - start).total_milliseconds());
+
+    return (reclaimed);
+}
+
+void
+Dhcpv6Srv::processPacket(Pkt6Ptr& query) {
+    // server's response
+    Pkt6Ptr rsp;
+
+    // In order to parse the DHCP options, the server needs to use some
+    // configuration information such as: existing option spaces, option
+    // definitions etc. This is the kind of information which is not
+    // available in the libdhcp, so we need to supply our own implementation
+    // of the option parsing function here, which would rely on the
+    // configuration data.
+    query->setCallback(boost::bind(&Dhcpv6Srv::unpackOptions, this, _1, _2,
+                                   _3, _4, _5));
+
+    bool skip_unpack = false;
+
+    // The packet has just been received so contains the uninterpreted wire
+    // data; execute callouts registered for buffer6_receive.
+    if (HooksManager::calloutsPresent(Hooks.hook_index_buffer6_receive_)) {
+        PacketTiming::Scope timing(timing_, PacketTiming::HOOKS);
+        CalloutHandlePtr callout_handle = getCalloutHandle(query);
+
+        // Delete previously set arguments
+        callout_handle->deleteAllArguments();
+
+        // Pass incoming packet as argument
+        callout_handle->setArgument("query6", query);
+
+        // Call callouts
+        HooksManager::callCallouts(Hooks.hook_index_buffer6_receive_, *callout_handle);
+
+        // Callouts decided to skip the next processing step. The next
+        // processing step would to parse the packet, so skip at this
+        // stage means that callouts did the parsing already, so server
+        // should skip parsing.
+        if (callout_handle->getSkip()) {
+            LOG_DEBUG(dhcp6_logger, DBG_DHCP6_HOOKS, DHCP6_HOOK_BUFFER_RCVD_SKIP);
+            skip_unpack = true;
+        }
+
+        callout_handle->getArgument("query6", query);
+    }
+
+    // Unpack the packet information unless the buffer6_receive callouts
+    // indicated they did it
+    if (!skip_unpack) {
+        PacketTiming::Scope timing(timing_, PacketTiming::UNPACK);
+        if (!query->unpack()) {
+            LOG_DEBUG(dhcp6_logger, DBG_DHCP6_DETAIL,
+                      DHCP6_PACKET_PARSE_FAIL);
+            return;
+        }
+    }
+    {
+        PacketTiming::Scope timing(timing_, PacketTiming::CLASSIFY);
+
         // Check if received query carries server identifier matching
         // server identifier being used by the server.
         if (!testServerID(query)) {
-            continue;
+            return;
         }
 
-        // Check if the received query has been sent to unicast or multicast.
-        // The Solicit, Confirm, Rebind and Information Request will be
-        // discarded if sent to unicast address.
+        // Check if the received query has been sent to unicast or
+        // multicast. The Solicit, Confirm, Rebind and Information Request
+        // will be discarded if sent to unicast address.
         if (!testUnicast(query)) {
-            continue;
+            return;
         }
+    }
 
-        LOG_DEBUG(dhcp6_logger, DBG_DHCP6_DETAIL, DHCP6_PACKET_RECEIVED)
-            .arg(query->getName());
-        LOG_DEBUG(dhcp6_logger, DBG_DHCP6_DETAIL_DATA, DHCP6_QUERY_DATA)
-            .arg(static_cast<int>(query->getType()))
-            .arg(query->getBuffer().getLength())
-            .arg(query->toText());
-
-        // At this point the information in the packet has been unpacked into
-        // the various packet fields and option objects has been cretated.
-        // Execute callouts registered for packet6_receive.
-        if (HooksManager::calloutsPresent(Hooks.hook_index_pkt6_receive_)) {
-            CalloutHandlePtr callout_handle = getCalloutHandle(query);
+    LOG_DEBUG(dhcp6_logger, DBG_DHCP6_DETAIL, DHCP6_PACKET_RECEIVED)
+        .arg(query->getName());
+    LOG_DEBUG(dhcp6_logger, DBG_DHCP6_DETAIL_DATA, DHCP6_QUERY_DATA)
+        .arg(static_cast<int>(query->getType()))
+        .arg(query->getBuffer().getLength())
+        .arg(query->toText());
 
-            // Delete previously set arguments
-            callout_handle->deleteAllArguments();
+    // At this point the information in the packet has been unpacked into
+    // the various packet fields and option objects has been cretated.
+    // Execute callouts registered for packet6_receive.
+    if (HooksManager::calloutsPresent(Hooks.hook_index_pkt6_receive_)) {
+        PacketTiming::Scope timing(timing_, PacketTiming::HOOKS);
+        CalloutHandlePtr callout_handle = getCalloutHandle(query);
 
-            // Pass incoming packet as argument
-            callout_handle->setArgument("query6", query);
+        // Delete previously set arguments
+        callout_handle->deleteAllArguments();
 
-            // Call callouts
-            HooksManager::callCallouts(Hooks.hook_index_pkt6_receive_, *callout_handle);
+        // Pass incoming packet as argument
+        callout_handle->setArgument("query6", query);
 
-            // Callouts decided to skip the next processing step. The next
-            // processing step would to process the packet, so skip at this
-            // stage means drop.
-            if (callout_handle->getSkip()) {
-                LOG_DEBUG(dhcp6_logger, DBG_DHCP6_HOOKS, DHCP6_HOOK_PACKET_RCVD_SKIP);
-                continue;
-            }
+        // Call callouts
+        HooksManager::callCallouts(Hooks.hook_index_pkt6_receive_, *callout_handle);
 
-            callout_handle->getArgument("query6", query);
+        // Callouts decided to skip the next processing step. The next
+        // processing step would to process the packet, so skip at this
+        // stage means drop.
+        if (callout_handle->getSkip()) {
+            LOG_DEBUG(dhcp6_logger, DBG_DHCP6_HOOKS, DHCP6_HOOK_PACKET_RCVD_SKIP);
+            return;
         }
 
-        // Assign this packet to a class, if possible
+        callout_handle->getArgument("query6", query);
+    }
+
+    // Assign this packet to a class, if possible
+    {
+        PacketTiming::Scope timing(timing_, PacketTiming::CLASSIFY);
         classifyPacket(query);
+    }
 
-        try {
-                NameChangeRequestPtr ncr;
-            switch (query->getType()) {
-            case DHCPV6_SOLICIT:
-                rsp = processSolicit(query);
-                    break;
-
-            case DHCPV6_REQUEST:
-                rsp = processRequest(query);
+    try {
+            NameChangeRequestPtr ncr;
+        switch (query->getType()) {
+        case DHCPV6_SOLICIT:
+            rsp = processSolicit(query);
                 break;
 
-            case DHCPV6_RENEW:
-                rsp = processRenew(query);
-                break;
+        case DHCPV6_REQUEST:
+            rsp = processRequest(query);
+            break;
 
-            case DHCPV6_REBIND:
-                rsp = processRebind(query);
-                break;
+        case DHCPV6_RENEW:
+            rsp = processRenew(query);
+            break;
 
-            case DHCPV6_CONFIRM:
-                rsp = processConfirm(query);
-                break;
+        case DHCPV6_REBIND:
+            rsp = processRebind(query);
+            break;
 
-            case DHCPV6_RELEASE:
-                rsp = processRelease(query);
-                break;
+        case DHCPV6_CONFIRM:
+            rsp = processConfirm(query);
+            break;
 
-            case DHCPV6_DECLINE:
-                rsp = processDecline(query);
-                break;
+        case DHCPV6_RELEASE:
+            rsp = processRelease(query);
+            break;
 
-            case DHCPV6_INFORMATION_REQUEST:
-                rsp = processInfRequest(query);
-                break;
+        case DHCPV6_DECLINE:
+            rsp = processDecline(query);
+            break;
 
-            default:
-                // We received a packet type that we do not recognize.
-                LOG_DEBUG(dhcp6_logger, DBG_DHCP6_BASIC, DHCP6_UNKNOWN_MSG_RECEIVED)
-                    .arg(static_cast<int>(query->getType()))
-                    .arg(query->getIface());
-                // Only action is to output a message if debug is enabled,
-                // and that will be covered by the debug statement before
-                // the "switch" statement.
-                ;
-            }
+        case DHCPV6_INFORMATION_REQUEST:
+            rsp = processInfRequest(query);
+            break;
 
-        } catch (const RFCViolation& e) {
-            LOG_DEBUG(dhcp6_logger, DBG_DHCP6_BASIC, DHCP6_REQUIRED_OPTIONS_CHECK_FAIL)
-                .arg(query->getName())
-                .arg(query->getRemoteAddr().toText())
-                .arg(e.what());
+        default:
+            // We received a packet type that we do not recognize.
+            LOG_DEBUG(dhcp6_logger, DBG_DHCP6_BASIC, DHCP6_UNKNOWN_MSG_RECEIVED)
+                .arg(static_cast<int>(query->getType()))
+                .arg(query->getIface());
+            // Only action is to output a message if debug is enabled,
+            // and that will be covered by the debug statement before
+            // the "switch" statement.
+            ;
+        }
 
-        } catch (const bundy::Exception& e) {
+    } catch (const RFCViolation& e) {
+        LOG_DEBUG(dhcp6_logger, DBG_DHCP6_BASIC, DHCP6_REQUIRED_OPTIONS_CHECK_FAIL)
+            .arg(query->getName())
+            .arg(query->getRemoteAddr().toText())
+            .arg(e.what());
+
+    } catch (const bundy::Exception& e) {
+
+        // Catch-all exception (at least for ones based on the isc
+        // Exception class, which covers more or less all that
+        // are explicitly raised in the BUNDY code).  Just log
+        // the problem and ignore the packet. (The problem is logged
+        // as a debug message because debug is disabled by default -
+        // it prevents a DDOS attack based on the sending of problem
+        // packets.)
+        LOG_DEBUG(dhcp6_logger, DBG_DHCP6_BASIC, DHCP6_PACKET_PROCESS_FAIL)
+            .arg(query->getName())
+            .arg(query->getRemoteAddr().toText())
+            .arg(e.what());
+    }
 
-            // Catch-all exception (at least for ones based on the isc
-            // Exception class, which covers more or less all that
-            // are explicitly raised in the BUNDY code).  Just log
-            // the problem and ignore the packet. (The problem is logged
-            // as a debug message because debug is disabled by default -
-            // it prevents a DDOS attack based on the sending of problem
-            // packets.)
-            LOG_DEBUG(dhcp6_logger, DBG_DHCP6_BASIC, DHCP6_PACKET_PROCESS_FAIL)
-                .arg(query->getName())
-                .arg(query->getRemoteAddr().toText())
-                .arg(e.what());
+    if (rsp) {
+        rsp->setRemoteAddr(query->getRemoteAddr());
+        rsp->setLocalAddr(query->getLocalAddr());
+
+        if (rsp->relay_info_.empty()) {
+            // Direct traffic, send back to the client directly
+            rsp->setRemotePort(DHCP6_CLIENT_PORT);
+        } else {
+            // Relayed traffic, send back to the relay agent
+            rsp->setRemotePort(DHCP6_SERVER_PORT);
         }
 
-        if (rsp) {
-            rsp->setRemoteAddr(query->getRemoteAddr());
-            rsp->setLocalAddr(query->getLocalAddr());
+        rsp->setLocalPort(DHCP6_SERVER_PORT);
+        rsp->setIndex(query->getIndex());
+        rsp->setIface(query->getIface());
 
-            if (rsp->relay_info_.empty()) {
-                // Direct traffic, send back to the client directly
-                rsp->setRemotePort(DHCP6_CLIENT_PORT);
-            } else {
-                // Relayed traffic, send back to the relay agent
-                rsp->setRemotePort(DHCP6_SERVER_PORT);
+        // Specifies if server should do the packing
+        bool skip_pack = false;
+
+        // Server's reply packet now has all options and fields set.
+        // Options are represented by individual objects, but the
+        // output wire data has not been prepared yet.
+        // Execute all callouts registered for packet6_send
+        if (HooksManager::calloutsPresent(Hooks.hook_index_pkt6_send_)) {
+            PacketTiming::Scope timing(timing_, PacketTiming::HOOKS);
+            CalloutHandlePtr callout_handle = getCalloutHandle(query);
+
+            // Delete all previous arguments
+            callout_handle->deleteAllArguments();
+
+            // Set our response
+            callout_handle->setArgument("response6", rsp);
+
+            // Call all installed callouts
+            HooksManager::callCallouts(Hooks.hook_index_pkt6_send_, *callout_handle);
+
+            // Callouts decided to skip the next processing step. The next
+            // processing step would to pack the packet (create wire data).
+            // That step will be skipped if any callout sets skip flag.
+            // It essentially means that the callout already did packing,
+            // so the server does not have to do it again.
+            if (callout_handle->getSkip()) {
+                LOG_DEBUG(dhcp6_logger, DBG_DHCP6_HOOKS, DHCP6_HOOK_PACKET_SEND_SKIP);
+                skip_pack = true;
             }
+        }
 
-            rsp->setLocalPort(DHCP6_SERVER_PORT);
-            rsp->setIndex(query->getIndex());
-            rsp->setIface(query->getIface());
+        LOG_DEBUG(dhcp6_logger, DBG_DHCP6_DETAIL_DATA,
+                  DHCP6_RESPONSE_DATA)
+            .arg(static_cast<int>(rsp->getType())).arg(rsp->toText());
 
-            // Specifies if server should do the packing
-            bool skip_pack = false;
+        if (!skip_pack) {
+            try {
+                PacketTiming::Scope timing(timing_, PacketTiming::PACK);
+                rsp->pack();
+            } catch (const std::exception& e) {
+                LOG_ERROR(dhcp6_logger, DHCP6_PACK_FAIL)
+                    .arg(e.what());
+                return;
+            }
 
-            // Server's reply packet now has all options and fields set.
-            // Options are represented by individual objects, but the
-            // output wire data has not been prepared yet.
-            // Execute all callouts registered for packet6_send
-            if (HooksManager::calloutsPresent(Hooks.hook_index_pkt6_send_)) {
+        }
+
+        try {
+
+            // Now all fields and options are constructed into output wire buffer.
+            // Option objects modification does not make sense anymore. Hooks
+            // can only manipulate wire buffer at this stage.
+            // Let's execute all callouts registered for buffer6_send
+            if (HooksManager::calloutsPresent(Hooks.hook_index_buffer6_send_)) {
+                PacketTiming::Scope timing(timing_, PacketTiming::HOOKS);
                 CalloutHandlePtr callout_handle = getCalloutHandle(query);
 
-                // Delete all previous arguments
+                // Delete previously set arguments
                 callout_handle->deleteAllArguments();
 
-                // Set our response
+                // Pass incoming packet as argument
                 callout_handle->setArgument("response6", rsp);
 
-                // Call all installed callouts
-                HooksManager::callCallouts(Hooks.hook_index_pkt6_send_, *callout_handle);
+                // Call callouts
+                HooksManager::callCallouts(Hooks.hook_index_buffer6_send_, *callout_handle);
 
                 // Callouts decided to skip the next processing step. The next
-                // processing step would to pack the packet (create wire data).
-                // That step will be skipped if any callout sets skip flag.
-                // It essentially means that the callout already did packing,
-                // so the server does not have to do it again.
+                // processing step would to parse the packet, so skip at this
+                // stage means drop.
                 if (callout_handle->getSkip()) {
-                    LOG_DEBUG(dhcp6_logger, DBG_DHCP6_HOOKS, DHCP6_HOOK_PACKET_SEND_SKIP);
-                    skip_pack = true;
+                    LOG_DEBUG(dhcp6_logger, DBG_DHCP6_HOOKS, DHCP6_HOOK_BUFFER_SEND_SKIP);
+                    return;
                 }
+
+                callout_handle->getArgument("response6", rsp);
             }
 
             LOG_DEBUG(dhcp6_logger, DBG_DHCP6_DETAIL_DATA,
                       DHCP6_RESPONSE_DATA)
                 .arg(static_cast<int>(rsp->getType())).arg(rsp->toText());
 
-            if (!skip_pack) {
-                try {
-                    rsp->pack();
-                } catch (const std::exception& e) {
-                    LOG_ERROR(dhcp6_logger, DHCP6_PACK_FAIL)
-                        .arg(e.what());
-                    continue;
-                }
-
-            }
-
-            try {
-
-                // Now all fields and options are constructed into output wire buffer.
-                // Option objects modification does not make sense anymore. Hooks
-                // can only manipulate wire buffer at this stage.
-                // Let's execute all callouts registered for buffer6_send
-                if (HooksManager::calloutsPresent(Hooks.hook_index_buffer6_send_)) {
-                    CalloutHandlePtr callout_handle = getCalloutHandle(query);
-
-                    // Delete previously set arguments
-                    callout_handle->deleteAllArguments();
-
-                    // Pass incoming packet as argument
-                    callout_handle->setArgument("response6", rsp);
-
-                    // Call callouts
-                    HooksManager::callCallouts(Hooks.hook_index_buffer6_send_, *callout_handle);
-
-                    // Callouts decided to skip the next processing step. The next
-                    // processing step would to parse the packet, so skip at this
-                    // stage means drop.
-                    if (callout_handle->getSkip()) {
-                        LOG_DEBUG(dhcp6_logger, DBG_DHCP6_HOOKS, DHCP6_HOOK_BUFFER_SEND_SKIP);
-                        continue;
-                    }
-
-                    callout_handle->getArgument("response6", rsp);
-                }
-
-                LOG_DEBUG(dhcp6_logger, DBG_DHCP6_DETAIL_DATA,
-                          DHCP6_RESPONSE_DATA)
-                    .arg(static_cast<int>(rsp->getType())).arg(rsp->toText());
-
-                sendPacket(rsp);
-            } catch (const std::exception& e) {
-                LOG_ERROR(dhcp6_logger, DHCP6_PACKET_SEND_FAIL)
-                    .arg(e.what());
-            }
+            // The response is sent when the lease writes made for it
+            // are committed.
+            pending_responses_.push_back(rsp);
+        } catch (const std::exception& e) {
+            LOG_ERROR(dhcp6_logger, DHCP6_PACKET_SEND_FAIL)
+                .arg(e.what());
         }
     }
-
-    return (true);
 }
 
 bool Dhcpv6Srv::loadServerID(const std::string& file_name) {
@@ -721,11 +895,10 @@ Dhcpv6Srv::appendRequestedOptions(const Pkt6Ptr& question, Pkt6Ptr& answer) {
     }
     // Get the list of options that client requested.
     const std::vector<uint16_t>& requested_opts = option_oro->getValues();
-    BOOST_FOREACH(uint16_t opt, requested_opts) {
-        Subnet::OptionDescriptor desc = subnet->getOptionDescriptor("dhcp6", opt);
-        if (desc.option) {
-            answer->addOption(desc.option);
-        }
+    Subnet::OptionListPtr options =
+        subnet->getRequestedOptions("dhcp6", requested_opts);
+    BOOST_FOREACH(const OptionPtr& opt, *options) {
+        answer->addOption(opt);
     }
 }
 
@@ -857,19 +1030,24 @@ Dhcpv6Srv::sanityCheck(const Pkt6Ptr& pkt, RequirementLevel clientid,
 
 Subnet6Ptr
 Dhcpv6Srv::selectSubnet(const Pkt6Ptr& question) {
+    PacketTiming::Scope timing(timing_, PacketTiming::SUBNET);
 
     Subnet6Ptr subnet;
 
+    // The subnets are taken from the published configuration snapshot,
+    // which stays valid while this query is processed.
+    CfgMgr::SnapshotReader config;
+
     if (question->relay_info_.empty()) {
         // This is a direct (non-relayed) message
 
         // Try to find a subnet if received packet from a directly connected client
-        subnet = CfgMgr::instance().getSubnet6(question->getIface(),
-                                               question->classes_);
+        subnet = config->getSubnet6(question->getIface(),
+                                    question->classes_);
         if (!subnet) {
             // If no subnet was found, try to find it based on remote address
-            subnet = CfgMgr::instance().getSubnet6(question->getRemoteAddr(),
-                                                   question->classes_);
+            subnet = config->getSubnet6(question->getRemoteAddr(),
+                                        question->classes_);
         }
     } else {
 
@@ -877,8 +1055,7 @@ Dhcpv6Srv::selectSubnet(const Pkt6Ptr& question) {
         OptionPtr interface_id = question->getAnyRelayOption(D6O_INTERFACE_ID,
                                                              Pkt6::RELAY_GET_FIRST);
         if (interface_id) {
-            subnet = CfgMgr::instance().getSubnet6(interface_id,
-                                                   question->classes_);
+            subnet = config->getSubnet6(interface_id, question->classes_);
         }
 
         if (!subnet) {
@@ -888,14 +1065,15 @@ Dhcpv6Srv::selectSubnet(const Pkt6Ptr& question) {
 
             // if relay filled in link_addr field, then let's use it
             if (link_addr != IOAddress("::")) {
-                subnet = CfgMgr::instance().getSubnet6(link_addr,
-                                                       question->classes_, true);
+                subnet = config->getSubnet6(link_addr, question->classes_,
+                                            true);
             }
         }
     }
 
     // Let's execute all callouts registered for subnet6_receive
     if (HooksManager::calloutsPresent(Hooks.hook_index_subnet6_select_)) {
+        PacketTiming::Scope timing(timing_, PacketTiming::HOOKS);
         CalloutHandlePtr callout_handle = getCalloutHandle(question);
 
         // We're reusing callout_handle from previous calls
@@ -908,7 +1086,7 @@ Dhcpv6Srv::selectSubnet(const Pkt6Ptr& question) {
         // We pass pointer to const collection for performance reasons.
         // Otherwise we would get a non-trivial performance penalty each
         // time subnet6_select is called.
-        callout_handle->setArgument("subnet6collection", CfgMgr::instance().getSubnets6());
+        callout_handle->setArgument("subnet6collection", config->getSubnets6());
 
         // Call user (and server-side) callouts
         HooksManager::callCallouts(Hooks.hook_index_subnet6_select_, *callout_handle);
@@ -1576,6 +1754,7 @@ Dhcpv6Srv::extendIA_NA(const Subnet6Ptr& subnet, const DuidPtr& duid,
     int hook_point = query->getType() == DHCPV6_RENEW ?
         Hooks.hook_index_lease6_renew_ : Hooks.hook_index_lease6_rebind_;
     if (HooksManager::calloutsPresent(hook_point)) {
+        PacketTiming::Scope timing(timing_, PacketTiming::HOOKS);
         CalloutHandlePtr callout_handle = getCalloutHandle(query);
 
         // Delete all previous arguments
@@ -1749,6 +1928,7 @@ Dhcpv6Srv::extendIA_PD(const Subnet6Ptr& subnet, const DuidPtr& duid,
     int hook_point = query->getType() == DHCPV6_RENEW ?
         Hooks.hook_index_lease6_renew_ : Hooks.hook_index_lease6_rebind_;
     if (HooksManager::calloutsPresent(hook_point)) {
+        PacketTiming::Scope timing(timing_, PacketTiming::HOOKS);
         CalloutHandlePtr callout_handle = getCalloutHandle(query);
 
         // Delete all previous arguments
@@ -2026,6 +2206,7 @@ Dhcpv6Srv::releaseIA_NA(const DuidPtr& duid, const Pkt6Ptr& query,
     bool skip = false;
     // Execute all callouts registered for packet6_send
     if (HooksManager::calloutsPresent(Hooks.hook_index_lease6_release_)) {
+        PacketTiming::Scope timing(timing_, PacketTiming::HOOKS);
         CalloutHandlePtr callout_handle = getCalloutHandle(query);
 
         // Delete all previous arguments
@@ -2071,6 +2252,9 @@ Dhcpv6Srv::releaseIA_NA(const DuidPtr& duid, const Pkt6Ptr& query,
 
         return (ia_rsp);
     } else {
+        // Let the allocation engine know the address is free again.
+        alloc_engine_->leaseDeleted(Lease::TYPE_NA, lease->addr_);
+
         LOG_DEBUG(dhcp6_logger, DBG_DHCP6_DETAIL, DHCP6_RELEASE_NA)
             .arg(lease->addr_.toText())
             .arg(duid->toText())
@@ -2176,6 +2360,7 @@ Dhcpv6Srv::releaseIA_PD(const DuidPtr& duid, const Pkt6Ptr& query,
     bool skip = false;
     // Execute all callouts registered for packet6_send
     if (HooksManager::calloutsPresent(Hooks.hook_index_lease6_release_)) {
+        PacketTiming::Scope timing(timing_, PacketTiming::HOOKS);
         CalloutHandlePtr callout_handle = getCalloutHandle(query);
 
         // Delete all previous arguments
@@ -2218,6 +2403,9 @@ Dhcpv6Srv::releaseIA_PD(const DuidPtr& duid, const Pkt6Ptr& query,
             .arg(lease->iaid_);
         general_status = STATUS_UnspecFail;
     } else {
+        // Let the allocation engine know the prefix is free again.
+        alloc_engine_->leaseDeleted(Lease::TYPE_PD, lease->addr_);
+
         LOG_DEBUG(dhcp6_logger, DBG_DHCP6_DETAIL, DHCP6_RELEASE_PD)
             .arg(lease->addr_.toText())
             .arg(duid->toText())
@@ -2410,22 +2598,16 @@ Dhcpv6Srv::unpackOptions(const OptionBuffer& buf,
     size_t offset = 0;
     size_t length = buf.size();
 
-    OptionDefContainer option_defs;
+    // Look up the option space once, so as the definition of each option
+    // is taken directly from the table.
+    const OptionDefTable* option_defs = NULL;
     if (option_space == "dhcp6") {
-        // Get the list of stdandard option definitions.
-        option_defs = LibDHCP::getOptionDefs(Option::V6);
+        // Get the table of standard option definitions.
+        option_defs = &LibDHCP::getOptionDefTable(Option::V6);
     } else if (!option_space.empty()) {
-        OptionDefContainerPtr option_defs_ptr =
-            CfgMgr::instance().getOptionDefs(option_space);
-        if (option_defs_ptr != NULL) {
-            option_defs = *option_defs_ptr;
-        }
+        option_defs = CfgMgr::instance().getOptionDefTable(option_space);
     }
 
-    // Get the search index #1. It allows to search for option definitions
-    // using option code.
-    const OptionDefContainerTypeIndex& idx = option_defs.get<1>();
-
     // The buffer being read comprises a set of options, each starting with
     // a two-byte type code and a two-byte length field.
     while (offset + 4 <= length) {
@@ -2453,23 +2635,13 @@ Dhcpv6Srv::unpackOptions(const OptionBuffer& buf,
             continue;
         }
 
-        // Get all definitions with the particular option code. Note that option
-        // code is non-unique within this container however at this point we
-        // expect to get one option definition with the particular code. If more
-        // are returned we report an error.
-        const OptionDefContainerTypeRange& range = idx.equal_range(opt_type);
-        // Get the number of returned option definitions for the option code.
-        size_t num_defs = distance(range.first, range.second);
+        // Get the definition of the option. The table holds at most one
+        // definition for each option code.
+        const OptionDefinitionPtr& def =
+            LibDHCP::findOptionDef(option_defs, opt_type);
 
         OptionPtr opt;
-        if (num_defs > 1) {
-            // Multiple options of the same code are not supported right now!
-            bundy_throw(bundy::Unexpected, "Internal error: multiple option definitions"
-                      " for option type " << opt_type << " returned. Currently it is not"
-                      " supported to initialize multiple option definitions"
-                      " for the same option code. This will be supported once"
-                      " support for option spaces is implemented");
-        } else if (num_defs == 0) {
+        if (!def) {
             // @todo Don't crash if definition does not exist because only a few
             // option definitions are initialized right now. In the future
             // we will initialize definitions for all options and we will
@@ -2481,8 +2653,6 @@ Dhcpv6Srv::unpackOptions(const OptionBuffer& buf,
         } else {
             // The option definition has been found. Use it to create
             // the option instance from the provided buffer chunk.
-            const OptionDefinitionPtr& def = *(range.first);
-            assert(def);
             opt = def->optionFactory(Option::V6, opt_type,
                                      buf.begin() + offset,
                                      buf.begin() + offset + opt_len,
@@ -2504,6 +2674,21 @@ Dhcpv6Srv::ifaceMgrSocket6ErrorHandler(const std::string& errmsg) {
 }
 
 void Dhcpv6Srv::classifyPacket(const Pkt6Ptr& pkt) {
+    // Classes defined in the configuration.
+    std::string defined_classes;
+    const ClientClassDefList& defs = CfgMgr::instance().getClientClassDefs();
+    for (ClientClassDefList::const_iterator def = defs.begin();
+         def != defs.end(); ++def) {
+        if (def->test_->evaluate(*pkt)) {
+            pkt->addClass(def->name_);
+            defined_classes += def->name_ + " ";
+        }
+    }
+    if (!defined_classes.empty()) {
+        LOG_DEBUG(dhcp6_logger, DBG_DHCP6_BASIC, DHCP6_CLASS_ASSIGNED)
+            .arg(defined_classes);
+    }
+
     OptionVendorClassPtr vclass = boost::dynamic_pointer_cast<
         OptionVendorClass>(pkt->getOption(D6O_VENDOR_CLASS));
 
@@ -25,6 +25,8 @@
 #include <dhcp/pkt6.h>
 #include <dhcpsrv/alloc_engine.h>
 #include <dhcpsrv/d2_client_mgr.h>
+#include <dhcpsrv/packet_timing.h>
+#include <dhcpsrv/receive_queue.h>
 #include <dhcpsrv/subnet.h>
 #include <hooks/callout_handle.h>
 
@@ -32,6 +34,7 @@
 
 #include <iostream>
 #include <queue>
+#include <vector>
 
 namespace bundy {
 namespace dhcp {
@@ -116,6 +119,21 @@ public:
         return (port_);
     }
 
+    /// @brief Returns the breakdown of the processing time of the packets.
+    ///
+    /// The timing is disabled by default; it is controlled with the
+    /// "packet-timing" command.
+    PacketTiming& getPacketTiming() {
+        return (timing_);
+    }
+
+    /// @brief Returns the queue of the received queries.
+    ///
+    /// Its statistics are returned by the "receive-queue" command.
+    ReceiveQueue<Pkt6Ptr>& getReceiveQueue() {
+        return (receive_queue_);
+    }
+
     /// @brief Open sockets which are marked as active in @c CfgMgr.
     ///
     /// This function reopens sockets according to the current settings in the
@@ -153,6 +171,54 @@ public:
 
 protected:
 
+    /// @brief Processes a received packet.
+    ///
+    /// Runs a single query through all processing steps, from the
+    /// buffer6_receive callouts and parsing to the response (if any), which
+    /// is held until @c sendPendingResponses sends it. It is called by @c run() for each received packet; failures are
+    /// logged and cause the packet to be dropped.
+    ///
+    /// @todo Processing relies on the lease manager, the configuration
+    /// manager and the hooks framework, none of which can be used from
+    /// multiple threads yet. Once they can, this function is what worker
+    /// threads would run for each query dispatched to them.
+    ///
+    /// @param query query received from a client
+    void processPacket(Pkt6Ptr& query);
+
+    /// @brief Commits the lease writes and sends the held responses.
+    ///
+    /// @c processPacket holds the responses instead of sending them, and
+    /// @c run() calls this function after each query or, when the lease
+    /// manager works in group commit mode (see @c LeaseMgr::getGroupCommit),
+    /// once it has processed all queries received so far, or the group
+    /// commit size of them. Outside of the group commit mode the leases of
+    /// all IAs of the query are written in one transaction (see
+    /// @c LeaseMgr::beginTransaction). This function commits the lease writes made for these queries
+    /// and sends the responses. If the commit fails, the writes are rolled
+    /// back and the responses are dropped so that no client is given a
+    /// lease missing from the lease database; the clients will retransmit.
+    void sendPendingResponses();
+
+    /// @brief Reclaims the expired leases.
+    ///
+    /// Fetches a batch of the expired leases from the lease database,
+    /// oldest first, and deletes them, queueing the removal of their DNS
+    /// entries. The allocation engine is told about the freed addresses.
+    /// @c run() calls this function each time the reclamation timer
+    /// configured in @c CfgMgr elapses, so that the expired leases don't
+    /// accumulate in the lease database.
+    ///
+    /// @param max_leases maximum number of leases to reclaim, zero for no
+    /// limit.
+    /// @param max_time maximum time the reclamation may take in
+    /// milliseconds, zero for no limit. The leases not reclaimed in time
+    /// are left for the next reclamation.
+    ///
+    /// @return number of leases reclaimed.
+    size_t reclaimExpiredLeases(const size_t max_leases,
+                                const uint32_t max_time);
+
     /// @brief Compare received server id with our server id
     ///
     /// Checks if the server id carried in a query from a client matches
@@ -563,6 +629,17 @@ protected:
     /// simulates reception of a packet. For that purpose it is protected.
     virtual Pkt6Ptr receivePacket(int timeout);
 
+    /// @brief Returns the next query to be processed.
+    ///
+    /// If the receive queue is enabled, the queries waiting on the sockets
+    /// are read into it (up to its limit at a time) and the next one is
+    /// taken from it, by priority. Otherwise this is @c receivePacket.
+    ///
+    /// @param timeout the time to wait for a query if none is waiting, in
+    /// seconds.
+    /// @return the query, NULL if none was received before the timeout.
+    Pkt6Ptr receiveQuery(int timeout);
+
     /// @brief dummy wrapper around IfaceMgr::send()
     ///
     /// This method is useful for testing purposes, where its replacement
@@ -589,10 +666,11 @@ protected:
 
     /// @brief Assigns incoming packet to zero or more classes.
     ///
-    /// @note For now, the client classification is very simple. It just uses
-    /// content of the vendor-class-identifier option as a class. The resulting
-    /// class will be stored in packet (see @ref bundy::dhcp::Pkt6::classes_ and
-    /// @ref bundy::dhcp::Pkt6::inClass).
+    /// The packet is assigned to the classes defined in the configuration
+    /// (see @ref bundy::dhcp::CfgMgr::getClientClassDefs) whose test it
+    /// passes. In addition, the content of the vendor-class option is used
+    /// as a class. The resulting classes will be stored in packet (see
+    /// @ref bundy::dhcp::Pkt6::classes_ and @ref bundy::dhcp::Pkt6::inClass).
     ///
     /// @param pkt packet to be classified
     void classifyPacket(const Pkt6Ptr& pkt);
@@ -680,6 +758,25 @@ protected:
     /// Holds a list of @c bundy::dhcp_ddns::NameChangeRequest objects, which
     /// are waiting for sending to bundy-dhcp-ddns module.
     std::queue<bundy::dhcp_ddns::NameChangeRequest> name_change_reqs_;
+
+    /// Maximum number of queries for which the lease writes are committed
+    /// together, zero if the writes are committed as they are made.
+    size_t group_commit_;
+
+    /// Number of queries processed since the lease writes were committed.
+    size_t uncommitted_queries_;
+
+    /// Responses held until the lease writes made for them are committed.
+    std::vector<Pkt6Ptr> pending_responses_;
+
+    /// Time of the last reclamation of the expired leases.
+    time_t last_reclaim_;
+
+    /// Breakdown of the processing time of the packets.
+    PacketTiming timing_;
+
+    /// Queries received but not processed yet, by priority.
+    ReceiveQueue<Pkt6Ptr> receive_queue_;
 };
 
 }; // namespace bundy::dhcp
@@ -148,4 +148,84 @@ TEST_F(CtrlDhcpv6SrvTest, libreload) {
     EXPECT_TRUE(checkMarkerFile(LOAD_MARKER_FILE, "1212"));
 }
 
+// Check that the "hooks-statistics" command enables and disables the
+// collection of callout statistics and returns the figures.
+
+TEST_F(CtrlDhcpv6SrvTest, hooksStatistics) {
+    HooksManager::unloadLibraries();
+    ASSERT_FALSE(HooksManager::getStatisticsEnabled());
+
+    // Enable collection.
+    ElementPtr params(new bundy::data::MapElement());
+    params->set("enable", Element::create(true));
+    int rcode = -1;
+    ConstElementPtr result =
+        ControlledDhcpv6Srv::execDhcpv6ServerCommand("hooks-statistics",
+                                                      params);
+    ConstElementPtr stats = parseAnswer(rcode, result);
+    EXPECT_EQ(0, rcode);
+    EXPECT_TRUE(HooksManager::getStatisticsEnabled());
+    ASSERT_TRUE(stats);
+    EXPECT_TRUE(stats->get("enabled")->boolValue());
+    EXPECT_EQ(0, stats->get("callouts")->size());
+
+    // An invalid argument is reported as an error.
+    params->set("enable", Element::create("yes"));
+    result = ControlledDhcpv6Srv::execDhcpv6ServerCommand("hooks-statistics",
+                                                          params);
+    parseAnswer(rcode, result);
+    EXPECT_EQ(1, rcode);
+
+    // Disable collection.
+    params->set("enable", Element::create(false));
+    result = ControlledDhcpv6Srv::execDhcpv6ServerCommand("hooks-statistics",
+                                                          params);
+    stats = parseAnswer(rcode, result);
+    EXPECT_EQ(0, rcode);
+    EXPECT_FALSE(HooksManager::getStatisticsEnabled());
+    EXPECT_FALSE(stats->get("enabled")->boolValue());
+}
+
+// Check that the "packet-timing" command enables and disables the timing
+// of the packets and returns the times.
+
+TEST_F(CtrlDhcpv6SrvTest, packetTiming) {
+    boost::scoped_ptr<ControlledDhcpv6Srv> srv;
+    ASSERT_NO_THROW(
+        srv.reset(new NakedControlledDhcpv6Srv())
+    );
+    ASSERT_FALSE(srv->getPacketTiming().isEnabled());
+
+    // Enable the timing.
+    ElementPtr params(new bundy::data::MapElement());
+    params->set("enable", Element::create(true));
+    int rcode = -1;
+    ConstElementPtr result =
+        ControlledDhcpv6Srv::execDhcpv6ServerCommand("packet-timing", params);
+    ConstElementPtr times = parseAnswer(rcode, result);
+    EXPECT_EQ(0, rcode);
+    EXPECT_TRUE(srv->getPacketTiming().isEnabled());
+    ASSERT_TRUE(times);
+    EXPECT_TRUE(times->get("enabled")->boolValue());
+    EXPECT_EQ(0, times->get("packets")->intValue());
+    EXPECT_EQ(PacketTiming::STAGE_COUNT + 1, times->get("stages")->size());
+
+    // A trace file which can't be opened is reported as an error.
+    params->set("trace-file", Element::create("/no/such/dir/trace.bin"));
+    result = ControlledDhcpv6Srv::execDhcpv6ServerCommand("packet-timing",
+                                                          params);
+    parseAnswer(rcode, result);
+    EXPECT_EQ(1, rcode);
+
+    // Disable the timing.
+    ElementPtr disable(new bundy::data::MapElement());
+    disable->set("enable", Element::create(false));
+    result = ControlledDhcpv6Srv::execDhcpv6ServerCommand("packet-timing",
+                                                          disable);
+    times = parseAnswer(rcode, result);
+    EXPECT_EQ(0, rcode);
+    EXPECT_FALSE(srv->getPacketTiming().isEnabled());
+    EXPECT_FALSE(times->get("enabled")->boolValue());
+}
+
 } // End of anonymous namespace
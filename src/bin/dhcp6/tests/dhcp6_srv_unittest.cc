@@ -998,6 +998,43 @@ TEST_F(Dhcpv6SrvTest, pdReleaseReject) {
     testReleaseReject(Lease::TYPE_PD, IOAddress("2001:db8:1:2::"));
 }
 
+// This test verifies that the expired leases are reclaimed, the first
+// expired first, and that the valid leases are left alone.
+TEST_F(Dhcpv6SrvTest, reclaimExpiredLeases) {
+    NakedDhcpv6Srv srv(0);
+
+    // Create two expired leases and a valid one.
+    const time_t now = time(NULL);
+    const char* addrs[] = { "2001:db8:1:1::cafe:babe",
+                            "2001:db8:1:1::cafe:babf",
+                            "2001:db8:1:1::cafe:bac0" };
+    const time_t cltts[] = { now - 300, now - 200, now };
+    for (int i = 0; i < 3; ++i) {
+        Lease6Ptr lease(new Lease6(Lease::TYPE_NA, IOAddress(addrs[i]), duid_,
+                                   234 + i, 50, 100, 25, 40,
+                                   subnet_->getID()));
+        lease->cltt_ = cltts[i];
+        ASSERT_TRUE(LeaseMgrFactory::instance().addLease(lease));
+    }
+
+    // Only the lease which expired first should be reclaimed.
+    EXPECT_EQ(1, srv.reclaimExpiredLeases(1, 0));
+    EXPECT_FALSE(LeaseMgrFactory::instance().getLease6(Lease::TYPE_NA,
+                                                       IOAddress(addrs[0])));
+    EXPECT_TRUE(LeaseMgrFactory::instance().getLease6(Lease::TYPE_NA,
+                                                      IOAddress(addrs[1])));
+
+    // Without the limit, the other expired lease should be reclaimed.
+    EXPECT_EQ(1, srv.reclaimExpiredLeases(0, 0));
+    EXPECT_FALSE(LeaseMgrFactory::instance().getLease6(Lease::TYPE_NA,
+                                                       IOAddress(addrs[1])));
+
+    // The valid lease should be left alone.
+    EXPECT_EQ(0, srv.reclaimExpiredLeases(0, 0));
+    EXPECT_TRUE(LeaseMgrFactory::instance().getLease6(Lease::TYPE_NA,
+                                                      IOAddress(addrs[2])));
+}
+
 // This test verifies if the status code option is generated properly.
 TEST_F(Dhcpv6SrvTest, StatusCode) {
     NakedDhcpv6Srv srv(0);
@@ -83,6 +83,12 @@ class TestLoadZoneRunner(unittest.TestCase):
         self.assertEqual('INFO', self.__runner._log_severity) # default
         self.assertEqual(0, self.__runner._log_debuglevel)
         self.assertFalse(self.__runner._empty_zone)
+        self.assertFalse(self.__runner._pipeline)
+
+    def test_parse_pipeline(self):
+        runner = LoadZoneRunner(['-P'] + self.__args)
+        runner._parse_args()
+        self.assertTrue(runner._pipeline)
 
     def test_set_loglevel(self):
         runner = LoadZoneRunner(['-d', '1'] + self.__args)
@@ -189,6 +195,15 @@ class TestLoadZoneRunner(unittest.TestCase):
         self.__check_zone_soa(NEW_SOA_TXT)
         self.assertEqual(3, self.__runner._loaded_rrs)
 
+    def test_load_update_pipelined(self):
+        '''successful loading in the pipelined mode.'''
+        self.__common_load_setup()
+        self.__runner._pipeline = True
+        self.__runner._do_load()
+        self.assertEqual([1, 2, 3], self.__reports)
+        self.__check_zone_soa(NEW_SOA_TXT)
+        self.assertEqual(3, self.__runner._loaded_rrs)
+
     def test_load_update_skipped_report(self):
         '''successful loading, with reports for every 2 RRs'''
         self.__common_load_setup()
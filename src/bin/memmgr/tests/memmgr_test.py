@@ -121,9 +121,16 @@ class MockMemmgr(memmgr.Memmgr):
         finally:
             bundy.config.ModuleCCSession = orig_cls
 
-    def _create_builder_thread(self):
+    def _create_builder_threads(self):
         self.builder_thread_created = True
 
+    def pretend_builders(self, count=1):
+        """Pretend to have the given number of builder threads."""
+        lock = threading.Lock()
+        for _ in range(count):
+            self._builder_cvs.append(threading.Condition(lock=lock))
+            self._builder_command_queues.append([])
+
 class MockDataSrcInfo:
     def __init__(self, sgmt_info):
         self.segment_info_map = {(bundy.dns.RRClass.IN, "name"): sgmt_info}
@@ -164,9 +171,10 @@ class TestMemmgr(unittest.TestCase):
         # builder thread has been created.
         self.__mgr._shutdown_module()
 
-        # Assert that all commands sent to the builder thread were
+        # Assert that all commands sent to the builder threads were
         # handled.
-        self.assertEqual(len(self.__mgr._builder_command_queue), 0)
+        for queue in self.__mgr._builder_command_queues:
+            self.assertEqual(len(queue), 0)
 
         # Restore faked values
         os.access = self.__orig_os_access
@@ -244,6 +252,17 @@ class TestMemmgr(unittest.TestCase):
         self.assertEqual('/some/path/dir',
                          self.__mgr._config_params['mapped_file_dir'])
 
+        # The number of builder threads.
+        self.assertEqual(1, self.__mgr._config_params['builder_threads'])
+        self.assertEqual((0, None), parse_answer(
+            self.__mgr._config_handler({'builder_threads': 4})))
+        self.assertEqual(4, self.__mgr._config_params['builder_threads'])
+        answer = parse_answer(
+            self.__mgr._config_handler({'builder_threads': 0}))
+        self.assertEqual(1, answer[0])
+        self.assertIsNotNone(re.search('must be positive', answer[1]))
+        self.assertEqual(4, self.__mgr._config_params['builder_threads'])
+
         # Bad update: diretory doesn't exist (we assume it really doesn't
         # exist in the tested environment).  Update won't be made.
         os.path.isdir = self.__orig_isdir # use real library
@@ -344,7 +363,7 @@ class TestMemmgr(unittest.TestCase):
 
     def test_datasrc_config_handler(self):
         # Pretend to have the builder thread
-        self.__mgr._builder_cv = threading.Condition()
+        self.__mgr.pretend_builders()
 
         self.__mgr._config_params = {'mapped_file_dir': '/some/path'}
 
@@ -362,7 +381,7 @@ class TestMemmgr(unittest.TestCase):
         self.assertIsNotNone(self.__mgr._datasrc_info)
         self.assertEqual(1, self.__mgr._datasrc_info.gen_id)
         self.assertEqual(self.__init_called, self.__mgr._datasrc_info)
-        self.assertEqual([], self.__mgr._builder_command_queue)
+        self.assertEqual([], self.__mgr._builder_command_queues[0])
 
         # Below we're using a mock DataSrcClientMgr for easier tests
         class MockDataSrcClientMgr:
@@ -400,8 +419,8 @@ class TestMemmgr(unittest.TestCase):
         self.assertSetEqual({old_datasrc_info},
                             set(self.__mgr._old_datasrc_info.values()))
         self.assertEqual([('cancel', old_datasrc_info)],
-                         self.__mgr._builder_command_queue)
-        del self.__mgr._builder_command_queue[:] # for tearDown
+                         self.__mgr._builder_command_queues[0])
+        del self.__mgr._builder_command_queues[0][:] # for tearDown
 
         # Emulate the case reconfigure() fails.  Exception isn't propagated,
         # but the status doesn't change.
@@ -422,7 +441,7 @@ class TestMemmgr(unittest.TestCase):
         dsrc_info = MockDataSrcInfo(sgmt_info)
 
         # Pretend to have the builder thread
-        self.__mgr._builder_cv = threading.Condition()
+        self.__mgr.pretend_builders()
 
         # Run the initialization
         self.__mgr._segment_readers = {'reader1': {}, 'reader2': {}}
@@ -434,7 +453,7 @@ class TestMemmgr(unittest.TestCase):
         self.assertEqual(['reader1', 'reader2'], added_readers)
 
         # Check the first command sent to the builder thread.
-        self.assertEqual(self.__mgr._builder_command_queue,
+        self.assertEqual(self.__mgr._builder_command_queues[0],
                          [('validate', dsrc_info, bundy.dns.RRClass.IN, 'name',
                           'action1')])
 
@@ -446,7 +465,7 @@ class TestMemmgr(unittest.TestCase):
         self.assertEqual(sgmt_info.events[1],
                          ('load', None, dsrc_info, bundy.dns.RRClass.IN,
                           'name'))
-        del self.__mgr._builder_command_queue[:]
+        del self.__mgr._builder_command_queues[0][:]
 
     # Check the handling of 'update/validate-completed' notification from
     # the builder.
@@ -559,10 +578,57 @@ class TestMemmgr(unittest.TestCase):
         """
         Send command to the builder test.
         """
-        self.__mgr._builder_cv = threading.Condition()
+        self.__mgr.pretend_builders()
         self.__mgr._cmd_to_builder(('test',))
-        self.assertEqual([('test',)], self.__mgr._builder_command_queue)
-        del self.__mgr._builder_command_queue[:]
+        self.assertEqual([('test',)], self.__mgr._builder_command_queues[0])
+        del self.__mgr._builder_command_queues[0][:]
+
+    def test_send_to_builders(self):
+        """
+        Send commands to several builders.
+        """
+        self.__mgr.pretend_builders(2)
+        queues = self.__mgr._builder_command_queues
+        dsrc_info = MockDataSrcInfo(MockSegmentInfo())
+
+        # Segments are assigned to the builders in turn, and the commands
+        # on a segment always go to the same builder.
+        cmd1 = ('validate', dsrc_info, RRClass.IN, 'dsrc1', 'action1')
+        cmd2 = ('validate', dsrc_info, RRClass.IN, 'dsrc2', 'action1')
+        cmd3 = ('load', None, dsrc_info, RRClass.IN, 'dsrc1')
+        cmd4 = ('reclaim', dsrc_info, RRClass.CH, 'dsrc1')
+        cmd5 = ('load', None, dsrc_info, RRClass.IN, 'dsrc2')
+        for cmd in [cmd1, cmd2, cmd3, cmd4, cmd5]:
+            self.__mgr._cmd_to_builder(cmd)
+        self.assertEqual([cmd1, cmd3, cmd4], queues[0])
+        self.assertEqual([cmd2, cmd5], queues[1])
+        del queues[0][:]
+        del queues[1][:]
+
+        # Others go to all builders.
+        self.__mgr._cmd_to_builder(('cancel', dsrc_info))
+        self.assertEqual([('cancel', dsrc_info)], queues[0])
+        self.assertEqual([('cancel', dsrc_info)], queues[1])
+        del queues[0][:]
+        del queues[1][:]
+
+        # The cancel is completed when all builders have completed it.
+        class Sock:
+            def recv(self, size):
+                pass
+        self.__mgr._master_sock = Sock()
+        self.__mgr._builder_lock = threading.Lock()
+        self.__mgr._old_datasrc_info[TEST_GENERATION_ID] = dsrc_info
+        self.__mgr._builder_response_queue.append(('cancel-completed',
+                                                    dsrc_info))
+        self.__mgr._notify_from_builder()
+        self.assertEqual([], dsrc_info.canceled_readers)
+        self.assertIn(TEST_GENERATION_ID, self.__mgr._old_datasrc_info)
+        self.__mgr._builder_response_queue.append(('cancel-completed',
+                                                    dsrc_info))
+        self.__mgr._notify_from_builder()
+        self.assertEqual([None], dsrc_info.canceled_readers)
+        self.assertNotIn(TEST_GENERATION_ID, self.__mgr._old_datasrc_info)
 
     def test_mod_command_handler(self):
         # unknown name of command will be rejected.  known cases are tested
@@ -795,6 +861,47 @@ class TestMemmgr(unittest.TestCase):
             'loadzone', {'class': 'IN', 'datasource': 'noname',
                          'origin': 'zone'}))[0])
 
+    def test_relayout(self):
+        "Normal and invalid cases of relayout command"
+
+        commands = []
+        self.__mgr._cmd_to_builder = lambda cmd: commands.append(cmd)
+
+        # there's no datasrc info
+        self.assertEqual(1, parse_answer(self.__mgr._mod_command_handler(
+            'relayout', {'datasource': 'name'}))[0])
+
+        sgmt_info = MockSegmentInfo()
+        dsrc_info = MockDataSrcInfo(sgmt_info)
+        self.__mgr._datasrc_info = dsrc_info
+
+        # missing or invalid parameters
+        self.assertEqual(1, parse_answer(self.__mgr._mod_command_handler(
+            'relayout', {}))[0])
+        self.assertEqual(1, parse_answer(self.__mgr._mod_command_handler(
+            'relayout', {'class': 'badclass', 'datasource': 'name'}))[0])
+        self.assertEqual(1, parse_answer(self.__mgr._mod_command_handler(
+            'relayout', {'datasource': 'noname'}))[0])
+        self.assertFalse(self.__mgr.mod_ccsession.rpc_call_params)
+        self.assertFalse(commands)
+
+        # auth is asked to save the names, and all zones are loaded.
+        expected_event = ('load', None, dsrc_info, bundy.dns.RRClass('IN'),
+                          'name')
+        self.assertEqual(0, parse_answer(self.__mgr._mod_command_handler(
+            'relayout', {'datasource': 'name'}))[0])
+        self.assertEqual([('save_hot_names', 'Auth', {})],
+                         self.__mgr.mod_ccsession.rpc_call_params)
+        self.assertEqual([expected_event], sgmt_info.events)
+        self.assertEqual([expected_event], commands)
+
+        # If auth fails to save them, the zones are loaded anyway.
+        self.__mgr.mod_ccsession.rpc_call_exception = \
+            bundy.config.RPCError(1, 'no auth')
+        self.assertEqual(0, parse_answer(self.__mgr._mod_command_handler(
+            'relayout', {'class': 'IN', 'datasource': 'name'}))[0])
+        self.assertEqual([expected_event, expected_event], sgmt_info.events)
+
     def test_bad_zone_updated(self):
         """Check various invalid/rare cases of 'zone_updated' command.
 
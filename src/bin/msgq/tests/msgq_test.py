@@ -459,6 +459,70 @@ class MsgQTest(unittest.TestCase):
         self.__msgq.process_command_send(sender, routing, data)
         check_delivered(rcpt_socket=another_recipiet)
 
+    def test_binary_payload(self):
+        """
+        Check the clients that offer it are told the binary wire format is
+        accepted, and payloads in it are converted to JSON only for the
+        other clients.
+        """
+        self.__sent_messages = []
+        def fake_send_prepared_msg(socket, msg):
+            self.__sent_messages.append((socket, msg))
+            return True
+        self.__msgq.send_prepared_msg = fake_send_prepared_msg
+        # Simple integers as sockets, like in test_undeliverable_errors.
+        sender = 1
+        binary_recipient = 2
+        json_recipient = 3
+        self.__msgq.lnames = {
+            'binary': binary_recipient,
+            'json': json_recipient
+        }
+
+        self.__msgq.process_command_getlname(binary_recipient,
+                                             {'type': 'getlname',
+                                              'binary': True}, None)
+        self.__msgq.process_command_getlname(json_recipient,
+                                             {'type': 'getlname'}, None)
+        self.assertEqual([(binary_recipient, ({'type': 'getlname',
+                                               'binary': True},
+                                              {'lname': 'binary'})),
+                          (json_recipient, ({'type': 'getlname'},
+                                            {'lname': 'json'}))],
+                         [(sock, self.parse_msg(msg))
+                          for (sock, msg) in self.__sent_messages])
+        self.__sent_messages = []
+
+        routing = {
+            'to': '*',
+            'from': 'sender',
+            'group': 'group',
+            'instance': '*',
+            'seq': 42
+        }
+        data = {
+            "data": [1, 2.5, None]
+        }
+        binary_data = bundy.cc.message.to_binary_wire(data)
+        self.__msgq.subs.find = lambda group, instance: [binary_recipient,
+                                                         json_recipient]
+        self.__msgq.process_command_send(sender, routing, binary_data)
+        self.assertEqual(2, len(self.__sent_messages))
+        (sock, msg) = self.__sent_messages[0]
+        self.assertEqual(binary_recipient, sock)
+        (length, header_len) = struct.unpack('>IH', msg[:6])
+        self.assertEqual(binary_data, msg[6 + header_len:])
+        (sock, msg) = self.__sent_messages[1]
+        self.assertEqual(json_recipient, sock)
+        self.assertEqual((routing, data), self.parse_msg(msg))
+        self.__sent_messages = []
+
+        # A malformed payload can't be converted, so it only gets to the
+        # client accepting the binary format.
+        self.__msgq.process_command_send(sender, routing, b'\xb1\x08')
+        self.assertEqual(1, len(self.__sent_messages))
+        self.assertEqual(binary_recipient, self.__sent_messages[0][0])
+
 class DummySocket:
     """
     Dummy socket class.
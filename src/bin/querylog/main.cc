@@ -0,0 +1,58 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "querylog.h"
+
+#include <exceptions/exceptions.h>
+
+#include <cstdlib>
+#include <iostream>
+
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+const char* const QUERYLOG_NAME = "bundy-querylog";
+
+void
+usage() {
+    cerr << "Usage: " << QUERYLOG_NAME << " file..." << endl;
+    cerr << "\tfile: binary query log file; older versions (file.1 etc.) "
+         << "should be given first" << endl;
+    exit(1);
+}
+}
+
+int
+main(int argc, char* argv[]) {
+    int ch;
+    while ((ch = getopt(argc, argv, "")) != -1) {
+        usage();
+    }
+    if (argc == optind) {
+        usage();
+    }
+
+    int status = 0;
+    for (int i = optind; i < argc; ++i) {
+        try {
+            bundy::querylog::printFile(cout, argv[i]);
+        } catch (const bundy::Exception& ex) {
+            cerr << QUERYLOG_NAME << ": " << ex.what() << endl;
+            status = 1;
+        }
+    }
+    return (status);
+}
@@ -0,0 +1,104 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "querylog.h"
+
+#include <dns/name.h>
+#include <dns/rcode.h>
+#include <dns/rrtype.h>
+#include <exceptions/exceptions.h>
+#include <util/buffer.h>
+
+#include <iomanip>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+
+using namespace bundy::dns;
+using bundy::log::BinaryLogReader;
+using bundy::log::BinaryLogRecord;
+using bundy::util::InputBuffer;
+
+namespace bundy {
+namespace querylog {
+
+namespace {
+void
+printTime(std::ostream& os, uint64_t timestamp) {
+    const time_t seconds = timestamp / 1000000;
+    struct tm tm;
+    char buf[sizeof("YYYY-MM-DDTHH:MM:SS")];
+    gmtime_r(&seconds, &tm);
+    strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+    os << buf << '.' << std::setw(6) << std::setfill('0')
+       << (timestamp % 1000000) << std::setfill(' ') << 'Z';
+}
+
+void
+printAddress(std::ostream& os, const BinaryLogRecord& record) {
+    char buf[INET6_ADDRSTRLEN];
+    const int af = (record.family == 6) ? AF_INET6 : AF_INET;
+    if (record.family == 0 ||
+        inet_ntop(af, record.address, buf, sizeof(buf)) == NULL) {
+        os << '?';
+    } else {
+        os << buf;
+    }
+    os << '#' << record.port;
+}
+
+void
+printQName(std::ostream& os, const BinaryLogRecord& record) {
+    try {
+        InputBuffer buffer(record.qname, record.qname_length);
+        os << Name(buffer).toText();
+    } catch (const bundy::Exception&) {
+        os << '?';
+    }
+}
+}
+
+void
+printRecord(std::ostream& os, const BinaryLogRecord& record) {
+    printTime(os, record.timestamp);
+    os << ' ';
+    printAddress(os, record);
+    os << ((record.flags & BinaryLogRecord::FLAG_TCP) != 0 ? " tcp " :
+           " udp ");
+    printQName(os, record);
+    os << ' ' << RRType(record.qtype) << ' ';
+    if ((record.flags & BinaryLogRecord::FLAG_NO_RESPONSE) != 0) {
+        os << '-';
+    } else {
+        os << Rcode(record.rcode);
+    }
+    os << ' ' << record.latency << "us\n";
+}
+
+size_t
+printFile(std::ostream& os, const std::string& filename) {
+    BinaryLogReader reader(filename);
+    BinaryLogRecord record;
+    size_t count = 0;
+    while (reader.next(record)) {
+        printRecord(os, record);
+        ++count;
+    }
+    return (count);
+}
+
+} // namespace querylog
+} // namespace bundy
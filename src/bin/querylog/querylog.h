@@ -0,0 +1,50 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef QUERYLOG_H
+#define QUERYLOG_H 1
+
+#include <log/binary_log.h>
+
+#include <ostream>
+#include <string>
+
+namespace bundy {
+namespace querylog {
+
+/// \brief Print a binary query log record as a line of text.
+///
+/// The line consists of space-separated fields: the time in ISO 8601 form
+/// (UTC, microsecond precision), the client address and port (as
+/// address#port), the transport ("udp" or "tcp"), the query name, the
+/// query type, the response code ("-" if no response was sent) and the
+/// processing time in microseconds.  A query name that can't be parsed is
+/// shown as "?".
+///
+/// \param os The stream to print to.
+/// \param record The record to print.
+void printRecord(std::ostream& os, const bundy::log::BinaryLogRecord& record);
+
+/// \brief Print all records of a binary query log file.
+///
+/// \param os The stream to print to.
+/// \param filename The file to read.
+/// \return The number of records printed.
+/// \throw bundy::log::BinaryLogError The file can't be read.
+size_t printFile(std::ostream& os, const std::string& filename);
+
+} // namespace querylog
+} // namespace bundy
+
+#endif // QUERYLOG_H
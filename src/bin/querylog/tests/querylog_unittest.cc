@@ -0,0 +1,116 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <querylog/querylog.h>
+
+#include <log/binary_log.h>
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <sstream>
+
+#include <unistd.h>
+
+using namespace bundy::log;
+using bundy::querylog::printFile;
+using bundy::querylog::printRecord;
+
+namespace {
+
+const char* const TEST_FILE = "querylog_test.blg";
+
+class QueryLogTest : public ::testing::Test {
+protected:
+    QueryLogTest() {
+        std::memset(&record_, 0, sizeof(record_));
+        record_.latency = 18;
+        record_.timestamp = 1413278467517839ULL; // 2014-10-14T09:21:07.517839
+        record_.qtype = 1;
+        record_.port = 53000;
+        record_.family = 4;
+        const uint8_t address[] = { 192, 0, 2, 1 };
+        std::memcpy(record_.address, address, sizeof(address));
+        const uint8_t qname[] = { 3, 'w', 'w', 'w', 7, 'e', 'x', 'a', 'm',
+                                  'p', 'l', 'e', 3, 'c', 'o', 'm', 0 };
+        std::memcpy(record_.qname, qname, sizeof(qname));
+        record_.qname_length = sizeof(qname);
+    }
+    ~QueryLogTest() {
+        unlink(TEST_FILE);
+    }
+
+    std::string toText() const {
+        std::ostringstream os;
+        printRecord(os, record_);
+        return (os.str());
+    }
+
+    BinaryLogRecord record_;
+};
+
+TEST_F(QueryLogTest, printRecord) {
+    EXPECT_EQ("2014-10-14T09:21:07.517839Z 192.0.2.1#53000 udp "
+              "www.example.com. A NOERROR 18us\n", toText());
+
+    record_.family = 6;
+    const uint8_t address[16] = { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+                                  0, 0, 0, 0, 0, 0, 0, 1 };
+    std::memcpy(record_.address, address, sizeof(address));
+    record_.flags = BinaryLogRecord::FLAG_TCP;
+    record_.qtype = 28;
+    record_.rcode = 3;
+    record_.timestamp = 1413278467000001ULL;
+    EXPECT_EQ("2014-10-14T09:21:07.000001Z 2001:db8::1#53000 tcp "
+              "www.example.com. AAAA NXDOMAIN 18us\n", toText());
+}
+
+TEST_F(QueryLogTest, printNoResponse) {
+    record_.flags = BinaryLogRecord::FLAG_NO_RESPONSE;
+    EXPECT_EQ("2014-10-14T09:21:07.517839Z 192.0.2.1#53000 udp "
+              "www.example.com. A - 18us\n", toText());
+}
+
+TEST_F(QueryLogTest, printBroken) {
+    // No address or query name
+    record_.family = 0;
+    record_.qname_length = 0;
+    EXPECT_EQ("2014-10-14T09:21:07.517839Z ?#53000 udp ? A NOERROR 18us\n",
+              toText());
+
+    // A truncated name
+    record_.qname_length = 5;
+    EXPECT_EQ("2014-10-14T09:21:07.517839Z ?#53000 udp ? A NOERROR 18us\n",
+              toText());
+}
+
+TEST_F(QueryLogTest, printFile) {
+    BinaryLog log;
+    log.open(TEST_FILE, 0, 0);
+    log.write(record_);
+    record_.qtype = 28;
+    log.write(record_);
+    log.close();
+
+    std::ostringstream os;
+    EXPECT_EQ(2, printFile(os, TEST_FILE));
+    EXPECT_EQ("2014-10-14T09:21:07.517839Z 192.0.2.1#53000 udp "
+              "www.example.com. A NOERROR 18us\n"
+              "2014-10-14T09:21:07.517839Z 192.0.2.1#53000 udp "
+              "www.example.com. AAAA NOERROR 18us\n", os.str());
+
+    EXPECT_THROW(printFile(os, "no_such_file.blg"), BinaryLogError);
+}
+
+}
@@ -0,0 +1,408 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <resolver/bench/fake_hierarchy.h>
+
+#include <exceptions/exceptions.h>
+#include <dns/messagerenderer.h>
+#include <dns/question.h>
+#include <dns/rcode.h>
+#include <dns/rdata.h>
+#include <dns/rrclass.h>
+#include <dns/rrttl.h>
+#include <dns/rrtype.h>
+#include <util/buffer.h>
+#include <util/random/random_number_generator.h>
+
+#include <asio.hpp>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+
+using namespace bundy::dns;
+using bundy::util::InputBuffer;
+using bundy::util::random::UniformRandomIntegerGenerator;
+using boost::lexical_cast;
+using std::string;
+using std::vector;
+
+namespace bundy {
+namespace resolver {
+namespace bench {
+
+namespace {
+
+// Long enough for nothing to expire during a benchmark.
+const RRTTL TTL(86400);
+
+// The resolution of the random drops.
+const int LOSS_SCALE = 1000000;
+
+string
+childName(const string& label, const Name& origin) {
+    return (origin == Name::ROOT_NAME() ? label + "." :
+            label + "." + origin.toText());
+}
+
+RRsetPtr
+createRRset(const Name& owner, const RRType& type, const string& rdata) {
+    RRsetPtr rrset(new RRset(owner, RRClass::IN(), type, TTL));
+    rrset->addRdata(rdata::createRdata(type, RRClass::IN(), rdata));
+    return (rrset);
+}
+
+}
+
+// The server listening on one address, for the zones it's authoritative
+// for.
+class FakeHierarchy::Server : boost::noncopyable {
+public:
+    Server(asio::io_service& io_service, const string& address,
+           uint16_t port, unsigned latency, double loss) :
+        io_service_(io_service),
+        socket_(io_service,
+                asio::ip::udp::endpoint(
+                    asio::ip::address::from_string(address), port)),
+        latency_(latency),
+        loss_(static_cast<int>(loss * LOSS_SCALE)),
+        rng_(0, LOSS_SCALE - 1),
+        message_(Message::PARSE),
+        queries_(0), drops_(0)
+    {}
+
+    void addZone(Zone& zone) {
+        zones_[zone.origin] = &zone;
+    }
+
+    void start() {
+        receive();
+    }
+
+    size_t getQueryCount() const {
+        return (queries_);
+    }
+
+    size_t getDropCount() const {
+        return (drops_);
+    }
+
+private:
+    typedef boost::shared_ptr<vector<uint8_t> > DataPtr;
+    typedef boost::shared_ptr<asio::deadline_timer> TimerPtr;
+
+    void receive() {
+        socket_.async_receive_from(asio::buffer(data_, sizeof(data_)),
+                                   sender_,
+                                   boost::bind(&Server::received, this,
+                                               asio::placeholders::error,
+                                               asio::placeholders::
+                                               bytes_transferred));
+    }
+
+    void received(const asio::error_code& error, size_t length) {
+        if (error == asio::error::operation_aborted) {
+            return;
+        }
+        if (!error) {
+            ++queries_;
+            if (loss_ > 0 && rng_() < loss_) {
+                ++drops_;
+            } else {
+                respond(length);
+            }
+        }
+        receive();
+    }
+
+    void respond(size_t length) {
+        try {
+            InputBuffer input(data_, length);
+            message_.clear(Message::PARSE);
+            message_.fromWire(input);
+        } catch (const bundy::Exception&) {
+            // Not worth answering
+            return;
+        }
+        if (message_.getHeaderFlag(Message::HEADERFLAG_QR) ||
+            message_.getRRCount(Message::SECTION_QUESTION) != 1) {
+            return;
+        }
+        message_.makeResponse();
+        FakeHierarchy::answer(zones_, message_);
+        renderer_.clear();
+        message_.toWire(renderer_);
+        const uint8_t* wire = static_cast<const uint8_t*>(
+            renderer_.getData());
+        const DataPtr response(new vector<uint8_t>(
+                                   wire, wire + renderer_.getLength()));
+        if (latency_ == 0) {
+            send(response, sender_);
+        } else {
+            const TimerPtr timer(new asio::deadline_timer(io_service_));
+            timer->expires_from_now(
+                boost::posix_time::milliseconds(latency_));
+            timer->async_wait(boost::bind(&Server::delayed, this, response,
+                                          sender_, timer));
+        }
+    }
+
+    void delayed(const DataPtr& response,
+                 const asio::ip::udp::endpoint& destination, TimerPtr) {
+        send(response, destination);
+    }
+
+    void send(const DataPtr& response,
+              const asio::ip::udp::endpoint& destination) {
+        // The handler keeps the data alive until it's sent.
+        socket_.async_send_to(asio::buffer(*response), destination,
+                              boost::bind(&Server::sent, response));
+    }
+
+    static void sent(const DataPtr&) {}
+
+    asio::io_service& io_service_;
+    asio::ip::udp::socket socket_;
+    const unsigned latency_;
+    const int loss_;
+    UniformRandomIntegerGenerator rng_;
+    std::map<Name, Zone*> zones_;
+    uint8_t data_[65535];
+    asio::ip::udp::endpoint sender_;
+    Message message_;
+    MessageRenderer renderer_;
+    size_t queries_;
+    size_t drops_;
+};
+
+FakeHierarchy::FakeHierarchy(bundy::asiolink::IOService& io_service,
+                             const HierarchyParams& params) :
+    io_service_(io_service), params_(params), address_count_(0)
+{
+    vector<string> addresses;
+    addresses.push_back(allocateAddress());
+    addresses.push_back(allocateAddress());
+    Zone& root = addZone(Name::ROOT_NAME(), NULL, addresses);
+    for (size_t i = 0; i < addresses.size(); ++i) {
+        root_addresses_.push_back(
+            root.addresses[Name(childName(string(1, 'a' + i) +
+                                          ".root-servers",
+                                          Name::ROOT_NAME()))]);
+    }
+
+    vector<string> sld_addresses;
+    for (size_t i = 0; i < std::max(params.sld_servers,
+                                     static_cast<size_t>(1)); ++i) {
+        sld_addresses.push_back(allocateAddress());
+    }
+
+    size_t sld_index = 0;
+    for (size_t i = 0; i < params.tld_count; ++i) {
+        addresses.clear();
+        addresses.push_back(allocateAddress());
+        addresses.push_back(allocateAddress());
+        Zone& tld = addZone(Name("tld" + lexical_cast<string>(i)), &root,
+                            addresses);
+        for (size_t j = 0; j < params.sld_count; ++j, ++sld_index) {
+            // Two servers of the pool, the next domain starting with the
+            // second one, so that they share the load.
+            addresses.clear();
+            addresses.push_back(sld_addresses[sld_index %
+                                              sld_addresses.size()]);
+            if (sld_addresses.size() > 1) {
+                addresses.push_back(sld_addresses[(sld_index + 1) %
+                                                  sld_addresses.size()]);
+            }
+            Zone& sld = addZone(Name(childName("z" + lexical_cast<string>(j),
+                                               tld.origin)),
+                                &tld, addresses);
+            domain_names_.push_back(sld.origin);
+            for (size_t k = 0; k < params.host_count; ++k) {
+                const Name host(childName("h" + lexical_cast<string>(k),
+                                          sld.origin));
+                sld.addresses[host] = createRRset(host, RRType::A(),
+                                                  "192.0.2.1");
+                host_names_.push_back(host);
+            }
+            sld.wildcard = createRRset(Name(childName("*", sld.origin)),
+                                       RRType::A(), "192.0.2.2");
+        }
+    }
+}
+
+FakeHierarchy::~FakeHierarchy() {}
+
+FakeHierarchy::Zone&
+FakeHierarchy::addZone(const Name& origin, Zone* parent,
+                       const vector<string>& server_addresses)
+{
+    const boost::shared_ptr<Zone> zone(new Zone(origin));
+    zones_[origin] = zone;
+    const bool root = origin == Name::ROOT_NAME();
+    const string mname = root ? "a.root-servers." : childName("ns1", origin);
+    zone->soa = createRRset(origin, RRType::SOA(),
+                            mname + " " + childName("hostmaster", origin) +
+                            " 1 3600 900 604800 86400");
+    zone->ns.reset(new RRset(origin, RRClass::IN(), RRType::NS(), TTL));
+    Delegation* delegation = NULL;
+    if (parent != NULL) {
+        delegation = &parent->delegations[origin];
+        delegation->ns = zone->ns;
+    }
+
+    for (size_t i = 0; i < server_addresses.size(); ++i) {
+        const string& address = server_addresses[i];
+        const Name ns_name(root ?
+                           childName(string(1, 'a' + i) + ".root-servers",
+                                     origin) :
+                           childName("ns" + lexical_cast<string>(i + 1),
+                                     origin));
+        zone->ns->addRdata(rdata::createRdata(RRType::NS(), RRClass::IN(),
+                                              ns_name.toText()));
+        const RRsetPtr glue(createRRset(ns_name, RRType::A(), address));
+        zone->addresses[ns_name] = glue;
+        if (delegation != NULL) {
+            delegation->glue.push_back(glue);
+        }
+
+        Server*& server = servers_by_address_[address];
+        if (server == NULL) {
+            servers_.push_back(boost::shared_ptr<Server>(
+                                   new Server(io_service_.get_io_service(),
+                                              address, params_.port,
+                                              params_.latency,
+                                              params_.loss)));
+            server = servers_.back().get();
+        }
+        server->addZone(*zone);
+    }
+    return (*zone);
+}
+
+string
+FakeHierarchy::allocateAddress() {
+    const size_t index = ++address_count_;
+    if (index > 0xffff) {
+        bundy_throw(bundy::BadValue, "too many fake nameservers");
+    }
+    return ("127.1." + lexical_cast<string>(index >> 8) + "." +
+            lexical_cast<string>(index & 0xff));
+}
+
+void
+FakeHierarchy::start() {
+    for (size_t i = 0; i < servers_.size(); ++i) {
+        servers_[i]->start();
+    }
+}
+
+RRsetPtr
+FakeHierarchy::getRootNS() const {
+    return (zones_.find(Name::ROOT_NAME())->second->ns);
+}
+
+size_t
+FakeHierarchy::getQueryCount() const {
+    size_t count = 0;
+    for (size_t i = 0; i < servers_.size(); ++i) {
+        count += servers_[i]->getQueryCount();
+    }
+    return (count);
+}
+
+size_t
+FakeHierarchy::getDropCount() const {
+    size_t count = 0;
+    for (size_t i = 0; i < servers_.size(); ++i) {
+        count += servers_[i]->getDropCount();
+    }
+    return (count);
+}
+
+void
+FakeHierarchy::answer(const std::map<Name, Zone*>& zones, Message& response)
+{
+    const ConstQuestionPtr question = *response.beginQuestion();
+    const Name& qname = question->getName();
+    const RRType& qtype = question->getType();
+    const unsigned int labels = qname.getLabelCount();
+
+    // The deepest zone of the server the name belongs to
+    const Zone* zone = NULL;
+    for (unsigned int i = 0; i < labels && zone == NULL; ++i) {
+        const std::map<Name, Zone*>::const_iterator it =
+            zones.find(qname.split(i));
+        if (it != zones.end()) {
+            zone = it->second;
+        }
+    }
+    if (zone == NULL || question->getClass() != RRClass::IN()) {
+        response.setRcode(Rcode::REFUSED());
+        return;
+    }
+
+    // A referral if the name is delegated further down
+    for (unsigned int i = 0; labels - i > zone->origin.getLabelCount();
+         ++i) {
+        const std::map<Name, Delegation>::const_iterator it =
+            zone->delegations.find(qname.split(i));
+        if (it != zone->delegations.end()) {
+            response.addRRset(Message::SECTION_AUTHORITY, it->second.ns);
+            for (size_t j = 0; j < it->second.glue.size(); ++j) {
+                response.addRRset(Message::SECTION_ADDITIONAL,
+                                  it->second.glue[j]);
+            }
+            return;
+        }
+    }
+
+    response.setHeaderFlag(Message::HEADERFLAG_AA);
+    RRsetPtr rrset;
+    bool exists = true;
+    if (qname == zone->origin) {
+        if (qtype == RRType::NS()) {
+            rrset = zone->ns;
+        } else if (qtype == RRType::SOA()) {
+            rrset = zone->soa;
+        }
+    } else {
+        const std::map<Name, RRsetPtr>::const_iterator it =
+            zone->addresses.find(qname);
+        if (it != zone->addresses.end()) {
+            if (qtype == RRType::A()) {
+                rrset = it->second;
+            }
+        } else if (zone->wildcard) {
+            if (qtype == RRType::A()) {
+                rrset.reset(new RRset(qname, RRClass::IN(), RRType::A(),
+                                      TTL));
+                rrset->addRdata(zone->wildcard->getRdataIterator()->
+                                getCurrent());
+            }
+        } else {
+            exists = false;
+        }
+    }
+    if (rrset) {
+        response.addRRset(Message::SECTION_ANSWER, rrset);
+    } else {
+        if (!exists) {
+            response.setRcode(Rcode::NXDOMAIN());
+        }
+        response.addRRset(Message::SECTION_AUTHORITY, zone->soa);
+    }
+}
+
+}
+}
+}
@@ -0,0 +1,180 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef RESOLVER_BENCH_FAKE_HIERARCHY_H
+#define RESOLVER_BENCH_FAKE_HIERARCHY_H
+
+#include <asiolink/io_service.h>
+#include <dns/message.h>
+#include <dns/name.h>
+#include <dns/rrset.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace resolver {
+namespace bench {
+
+/// \brief Parameters of a \c FakeHierarchy.
+struct HierarchyParams {
+    HierarchyParams() :
+        tld_count(10), sld_count(100), host_count(10), sld_servers(8),
+        port(5300), latency(0), loss(0)
+    {}
+
+    /// \brief Number of the top level domains.
+    size_t tld_count;
+    /// \brief Number of the second level domains in each of them.
+    size_t sld_count;
+    /// \brief Number of the hosts in each second level domain.
+    size_t host_count;
+    /// \brief Number of the servers the second level domains are spread
+    /// over.
+    size_t sld_servers;
+    /// \brief Port the servers listen on.
+    uint16_t port;
+    /// \brief Delay of the responses, in milliseconds.
+    unsigned latency;
+    /// \brief Probability of dropping a query, between 0 and 1.
+    double loss;
+};
+
+/// \brief A fake DNS hierarchy for benchmarking the resolver.
+///
+/// It stands up the authoritative servers of a root zone, of the top
+/// level domains \c tld0 to \c tldN below it and of the second level
+/// domains \c z0 to \c zM below each of them, which answer from zones
+/// built in memory.  Each zone has two nameservers; the root and each
+/// top level domain have servers of their own, the second level domains
+/// share a pool of servers.  The servers listen on the same port at
+/// distinct addresses of 127.0.0.0/8, starting at 127.1.0.1, so the
+/// resolver has to be told to send its queries to that port.
+///
+/// A second level domain has the hosts \c h0 to \c hK, and a wildcard
+/// matching any other name, all of them with an A record.  The records
+/// have long TTLs, so they don't expire during a benchmark.
+///
+/// The servers run on the given IO service, delay each response by the
+/// given latency and drop queries at random with the given probability.
+class FakeHierarchy : boost::noncopyable {
+public:
+    /// \brief Constructor.
+    ///
+    /// Builds the zones and binds the sockets of the servers.
+    ///
+    /// \param io_service The IO service the servers run on.
+    /// \param params The shape of the hierarchy and the network
+    ///     conditions.
+    /// \throw bundy::BadValue if there are too many servers.
+    /// \throw asio::system_error if a socket can't be bound.
+    FakeHierarchy(bundy::asiolink::IOService& io_service,
+                  const HierarchyParams& params);
+
+    /// \brief Destructor.
+    ~FakeHierarchy();
+
+    /// \brief Starts answering queries.
+    void start();
+
+    /// \brief Returns the A records of the root nameservers.
+    ///
+    /// They are meant to prime the cache of the resolver.
+    const std::vector<bundy::dns::RRsetPtr>& getRootAddresses() const {
+        return (root_addresses_);
+    }
+
+    /// \brief Returns the NS record of the root zone.
+    bundy::dns::RRsetPtr getRootNS() const;
+
+    /// \brief Returns the names of all the hosts.
+    const std::vector<bundy::dns::Name>& getHostNames() const {
+        return (host_names_);
+    }
+
+    /// \brief Returns the names of the second level domains.
+    const std::vector<bundy::dns::Name>& getDomainNames() const {
+        return (domain_names_);
+    }
+
+    /// \brief Returns the number of queries the servers received.
+    ///
+    /// This must not be called while the IO service is running.
+    size_t getQueryCount() const;
+
+    /// \brief Returns the number of queries the servers dropped.
+    ///
+    /// This must not be called while the IO service is running.
+    size_t getDropCount() const;
+
+    /// \brief A delegation to a child zone.
+    struct Delegation {
+        bundy::dns::RRsetPtr ns;
+        std::vector<bundy::dns::RRsetPtr> glue;
+    };
+
+    /// \brief A zone, as far as the fake servers are concerned.
+    struct Zone {
+        explicit Zone(const bundy::dns::Name& zone_origin) :
+            origin(zone_origin)
+        {}
+
+        bundy::dns::Name origin;
+        bundy::dns::RRsetPtr soa;
+        bundy::dns::RRsetPtr ns;
+        /// A records by owner name, including the nameservers of the zone.
+        std::map<bundy::dns::Name, bundy::dns::RRsetPtr> addresses;
+        /// Delegations, by name of the child zone.
+        std::map<bundy::dns::Name, Delegation> delegations;
+        /// A record matching the names not otherwise in the zone, if any.
+        bundy::dns::RRsetPtr wildcard;
+    };
+
+    /// \brief Builds the response to a query.
+    ///
+    /// \param zones The zones of the server, by origin.
+    /// \param response The query, to be turned into the response.
+    static void answer(const std::map<bundy::dns::Name, Zone*>& zones,
+                       bundy::dns::Message& response);
+
+private:
+    class Server;
+
+    Zone& addZone(const bundy::dns::Name& origin, Zone* parent,
+                  const std::vector<std::string>& server_addresses);
+    std::string allocateAddress();
+
+    bundy::asiolink::IOService& io_service_;
+    const HierarchyParams params_;
+    std::map<bundy::dns::Name, boost::shared_ptr<Zone> > zones_;
+    std::vector<bundy::dns::RRsetPtr> root_addresses_;
+    std::vector<bundy::dns::Name> host_names_;
+    std::vector<bundy::dns::Name> domain_names_;
+    std::vector<boost::shared_ptr<Server> > servers_;
+    std::map<std::string, Server*> servers_by_address_;
+    size_t address_count_;
+};
+
+}
+}
+}
+
+#endif
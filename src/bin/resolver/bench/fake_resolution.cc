@@ -43,9 +43,26 @@ const float chance_complete = 0.5;
 const size_t upstream_time_min = 2;
 const size_t upstream_time_max = 50;
 
+FakeCache::FakeCache(size_t shard_count) :
+    shards_(shard_count)
+{
+    BOOST_FOREACH(boost::shared_ptr<util::thread::Mutex>& shard, shards_) {
+        shard.reset(new util::thread::Mutex);
+    }
+}
+
+void
+FakeCache::access(size_t shard, size_t work_size) {
+    util::thread::Mutex::Locker locker(*shards_[shard % shards_.size()]);
+    for (size_t i = 0; i < work_size; ++i) {
+        dummy_work();
+    }
+}
+
 FakeQuery::FakeQuery(FakeInterface& interface) :
     interface_(&interface),
-    outstanding_(false)
+    outstanding_(false),
+    cache_shard_(random())
 {
     // Schedule what tasks are needed.
     // First, parse the query
@@ -79,6 +96,11 @@ FakeQuery::performTask(const StepCallback& callback) {
         interface_->scheduleUpstreamAnswer(this, callback,
                                            steps_.back().second);
         steps_.pop_back();
+    } else if ((nextTask() == CacheRead || nextTask() == CacheWrite) &&
+               interface_->cache_ != NULL) {
+        interface_->cache_->access(cache_shard_, steps_.back().second);
+        steps_.pop_back();
+        callback();
     } else {
         for (size_t i = 0; i < steps_.back().second; ++i) {
             dummy_work();
@@ -88,8 +110,9 @@ FakeQuery::performTask(const StepCallback& callback) {
     }
 }
 
-FakeInterface::FakeInterface(size_t query_count) :
-    queries_(query_count)
+FakeInterface::FakeInterface(size_t query_count, FakeCache* cache) :
+    queries_(query_count),
+    cache_(cache)
 {
     BOOST_FOREACH(FakeQueryPtr& query, queries_) {
         query = FakeQueryPtr(new FakeQuery(*this));
@@ -17,8 +17,10 @@
 
 #include <exceptions/exceptions.h>
 #include <asiolink/io_service.h>
+#include <util/threads/sync.h>
 
 #include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
 
 #include <utility>
@@ -61,6 +63,28 @@ enum Task {
 
 class FakeInterface;
 
+/// \brief Imitation of a cache shared between threads.
+///
+/// The cache is split into shards, each with its own lock, like
+/// the resolver cache. The CacheRead and CacheWrite tasks of queries on
+/// an interface using this hold the lock of one of the shards while they
+/// do their work, so the threads need to wait for each other when they
+/// happen to access the same shard.
+class FakeCache : boost::noncopyable {
+public:
+    /// \brief Constructor
+    ///
+    /// \param shard_count Number of the shards (and locks).
+    FakeCache(size_t shard_count);
+    /// \brief Do some work on one of the shards.
+    ///
+    /// \param shard Any number, the shard is chosen by it.
+    /// \param work_size How much work to do with the shard locked.
+    void access(size_t shard, size_t work_size);
+private:
+    std::vector<boost::shared_ptr<util::thread::Mutex> > shards_;
+};
+
 /// \brief Imitation of the work done to resolve a query.
 ///
 /// An object of this class represents some fake work that should look like
@@ -159,6 +183,8 @@ private:
     FakeInterface* interface_;
     // Is an upstream query outstanding?
     bool outstanding_;
+    // The shard of the cache the query accesses (if the cache is shared)
+    size_t cache_shard_;
 };
 
 typedef boost::shared_ptr<FakeQuery> FakeQueryPtr;
@@ -188,7 +214,11 @@ public:
     ///
     /// Initiarile the interface and create query_count queries for the
     /// benchmark. They will be handed out one by one with receiveQuery().
-    FakeInterface(size_t query_count);
+    ///
+    /// If cache is not NULL, the queries access the cache through it.
+    /// It may be shared by interfaces in different threads, and it must
+    /// outlive the interface.
+    FakeInterface(size_t query_count, FakeCache* cache = NULL);
     /// \brief Wait for answers from upstream servers.
     ///
     /// Wait until at least one "answer" comes from the remote server. This
@@ -219,6 +249,7 @@ private:
                                 size_t msec);
     asiolink::IOService service_;
     std::vector<FakeQueryPtr> queries_;
+    FakeCache* cache_;
 };
 
 }
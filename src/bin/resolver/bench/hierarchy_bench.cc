@@ -0,0 +1,604 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+// This benchmark measures the whole recursive resolution path of
+// bundy-resolver: the resolver, with its cache and nameserver address
+// store, listens on the loopback interface and resolves the queries of a
+// client by querying the fake authoritative servers of a FakeHierarchy,
+// also on the loopback interface.  The client sends the queries at a fixed
+// rate, regardless of the answers, and measures the latency of each of
+// them.
+
+#include <config.h>
+
+#include <resolver/bench/fake_hierarchy.h>
+#include <resolver/resolver.h>
+
+#include <exceptions/exceptions.h>
+
+#include <util/buffer.h>
+#include <util/random/random_number_generator.h>
+#include <util/threads/thread.h>
+
+#include <dns/message.h>
+#include <dns/messagerenderer.h>
+#include <dns/name.h>
+#include <dns/opcode.h>
+#include <dns/question.h>
+#include <dns/rcode.h>
+#include <dns/rrclass.h>
+#include <dns/rrset.h>
+#include <dns/rrtype.h>
+
+#include <cc/data.h>
+#include <config/ccsession.h>
+
+#include <log/logger_support.h>
+
+#include <asiodns/asiodns.h>
+#include <asiolink/asiolink.h>
+#include <cache/resolver_cache.h>
+#include <nsas/nameserver_address_store.h>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace bundy;
+using namespace bundy::data;
+using namespace bundy::dns;
+using namespace bundy::util;
+using namespace bundy::asiodns;
+using namespace bundy::asiolink;
+using namespace bundy::resolver::bench;
+using bundy::util::thread::Thread;
+
+namespace {
+
+// Return the current time of the monotonic clock in microseconds.
+uint64_t
+getTimeUsec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000);
+}
+
+// The names the client asks for.  A query is for a name of the population
+// of the hierarchy with the probability "hit_ratio", chosen with a Zipf
+// distribution of exponent "zipf" (0 making all the names as popular);
+// such a name is in the cache of the resolver once it has been asked.
+// The other queries are for names never asked before, matching the
+// wildcard of a second level domain chosen at random, so the resolver has
+// to query its servers again.
+class NameGenerator {
+public:
+    NameGenerator(const FakeHierarchy& hierarchy, double hit_ratio,
+                  double zipf) :
+        names_(hierarchy.getHostNames()),
+        domains_(hierarchy.getDomainNames()),
+        hit_ratio_(static_cast<int>(hit_ratio * SCALE)),
+        rng_(0, SCALE - 1),
+        fresh_count_(0)
+    {
+        // The most popular names are spread over the domains.
+        shuffle(names_.begin(), names_.end(), mt19937(time(NULL)));
+        vector<double> probabilities(names_.size());
+        double sum = 0;
+        for (size_t i = 0; i < names_.size(); ++i) {
+            probabilities[i] = 1 / pow(i + 1, zipf);
+            sum += probabilities[i];
+        }
+        for (size_t i = 0; i < names_.size(); ++i) {
+            probabilities[i] /= sum;
+        }
+        popularity_.reset(probabilities);
+    }
+
+    Name next() {
+        if (rng_() < hit_ratio_) {
+            return (names_[min(popularity_(), names_.size() - 1)]);
+        }
+        return (Name("n" + boost::lexical_cast<string>(fresh_count_++) +
+                     "." + domains_[rng_() % domains_.size()].toText()));
+    }
+
+private:
+    static const int SCALE = 1000000;
+    vector<Name> names_;
+    const vector<Name>& domains_;
+    const int hit_ratio_;
+    random::UniformRandomIntegerGenerator rng_;
+    random::WeightedRandomIntegerGenerator popularity_;
+    size_t fresh_count_;
+};
+
+// Result of a measurement.
+struct BenchResult {
+    BenchResult() : sent(0), answered(0), failed(0), lost(0), duration(0) {}
+
+    size_t sent;
+    size_t answered;            // including the failures
+    size_t failed;              // answered with another rcode than NOERROR
+    size_t lost;
+    double duration;            // in seconds
+    vector<uint32_t> latencies; // sorted, in microseconds
+
+    // Return the p-th percentile (0 < p <= 100) of the latencies, using
+    // the nearest-rank method.
+    uint32_t getPercentile(double p) const {
+        if (latencies.empty()) {
+            return (0);
+        }
+        const size_t rank =
+            static_cast<size_t>(ceil(p / 100 * latencies.size()));
+        return (latencies[min(max(rank, static_cast<size_t>(1)),
+                              latencies.size()) - 1]);
+    }
+};
+
+// Build "count" queries for the names of the generator.
+vector<vector<uint8_t> >
+buildQueries(NameGenerator& names, size_t count) {
+    vector<vector<uint8_t> > queries;
+    queries.reserve(count);
+    Message query(Message::RENDER);
+    MessageRenderer renderer;
+    for (size_t i = 0; i < count; ++i) {
+        query.clear(Message::RENDER);
+        query.setQid(0);
+        query.setOpcode(Opcode::QUERY());
+        query.setRcode(Rcode::NOERROR());
+        query.setHeaderFlag(Message::HEADERFLAG_RD);
+        query.addQuestion(Question(names.next(), RRClass::IN(),
+                                   RRType::A()));
+        renderer.clear();
+        query.toWire(renderer);
+        const uint8_t* data = static_cast<const uint8_t*>(renderer.getData());
+        queries.push_back(vector<uint8_t>(data, data + renderer.getLength()));
+    }
+    return (queries);
+}
+
+// Send the queries to the resolver at the given rate, and wait for the
+// answers.  A query not answered within "timeout" msec is lost.  The
+// responses are matched with the queries by the query ID, so a query
+// still outstanding when its ID is reused is lost as well.
+BenchResult
+runClient(vector<vector<uint8_t> >& queries, double qps, int timeout,
+          uint16_t port)
+{
+    const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        bundy_throw(bundy::Unexpected, "failed to create a socket: "
+                    << strerror(errno));
+    }
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(port);
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<const struct sockaddr*>(&sin),
+                sizeof(sin)) < 0) {
+        const int error = errno;
+        close(fd);
+        bundy_throw(bundy::Unexpected, "failed to connect a socket: "
+                    << strerror(error));
+    }
+
+    const size_t QID_COUNT = 65536;
+    const uint64_t timeout_usec = static_cast<uint64_t>(timeout) * 1000;
+    // Send time of outstanding queries indexed by the query ID; 0 means
+    // no query is outstanding with that ID.
+    vector<uint64_t> send_times(QID_COUNT, 0);
+    // The query IDs and send times of the queries, in the order sent.
+    deque<pair<size_t, uint64_t> > sent;
+    uint8_t response[65535];
+    BenchResult result;
+    result.latencies.reserve(queries.size());
+
+    const uint64_t start = getTimeUsec();
+    uint64_t end = start;
+    while (result.sent < queries.size() || !sent.empty()) {
+        uint64_t now = getTimeUsec();
+        while (result.sent < queries.size() &&
+               start + static_cast<uint64_t>(result.sent * 1000000 / qps) <=
+               now) {
+            const size_t qid = result.sent % QID_COUNT;
+            if (send_times[qid] != 0) {
+                ++result.lost;
+            }
+            vector<uint8_t>& query = queries[result.sent];
+            query[0] = qid >> 8;
+            query[1] = qid & 0xff;
+            send_times[qid] = now;
+            if (send(fd, &query[0], query.size(), 0) < 0) {
+                send_times[qid] = 0;
+                ++result.lost;
+            } else {
+                sent.push_back(make_pair(qid, now));
+            }
+            ++result.sent;
+        }
+        // Forget the queries answered meanwhile, and give up those which
+        // timed out.
+        while (!sent.empty() &&
+               (send_times[sent.front().first] != sent.front().second ||
+                sent.front().second + timeout_usec <= now)) {
+            if (send_times[sent.front().first] == sent.front().second) {
+                send_times[sent.front().first] = 0;
+                ++result.lost;
+                end = now;
+            }
+            sent.pop_front();
+        }
+
+        uint64_t wake = ~static_cast<uint64_t>(0);
+        if (result.sent < queries.size()) {
+            wake = start + static_cast<uint64_t>(result.sent * 1000000 / qps);
+        }
+        if (!sent.empty()) {
+            wake = min(wake, sent.front().second + timeout_usec);
+        } else if (result.sent == queries.size()) {
+            break;
+        }
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, wake > now ? (wake - now + 999) / 1000 : 0) <= 0) {
+            continue;
+        }
+        ssize_t len;
+        while ((len = recv(fd, response, sizeof(response),
+                           MSG_DONTWAIT)) >= 4) {
+            const size_t qid = (response[0] << 8) | response[1];
+            if ((response[2] & 0x80) == 0 || send_times[qid] == 0) {
+                continue;
+            }
+            now = getTimeUsec();
+            result.latencies.push_back(now - send_times[qid]);
+            send_times[qid] = 0;
+            ++result.answered;
+            if ((response[3] & 0x0f) != 0) {
+                ++result.failed;
+            }
+            end = now;
+        }
+    }
+    close(fd);
+
+    result.duration = (end - start) / 1000000.0;
+    sort(result.latencies.begin(), result.latencies.end());
+    return (result);
+}
+
+// Create the UDP socket the resolver listens on, on an ephemeral port of
+// the loopback interface.
+int
+createServerSocket(uint16_t& port) {
+    const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        bundy_throw(bundy::Unexpected, "failed to create a socket: "
+                    << strerror(errno));
+    }
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(sin);
+    if (bind(fd, reinterpret_cast<const struct sockaddr*>(&sin),
+             sizeof(sin)) < 0 ||
+        getsockname(fd, reinterpret_cast<struct sockaddr*>(&sin), &len) < 0) {
+        const int error = errno;
+        close(fd);
+        bundy_throw(bundy::Unexpected, "failed to bind a socket: "
+                    << strerror(error));
+    }
+    port = ntohs(sin.sin_port);
+    return (fd);
+}
+
+// Fake the priming query, as bundy-resolver does, with the root servers
+// of the hierarchy.
+void
+primeCache(bundy::cache::ResolverCache& cache,
+           const FakeHierarchy& hierarchy)
+{
+    Message priming(Message::RENDER);
+    priming.setRcode(Rcode::NOERROR());
+    priming.addQuestion(Question(Name::ROOT_NAME(), RRClass::IN(),
+                                 RRType::NS()));
+    priming.addRRset(Message::SECTION_ANSWER, hierarchy.getRootNS());
+    cache.update(hierarchy.getRootNS());
+    for (size_t i = 0; i < hierarchy.getRootAddresses().size(); ++i) {
+        priming.addRRset(Message::SECTION_ADDITIONAL,
+                         hierarchy.getRootAddresses()[i]);
+        cache.update(hierarchy.getRootAddresses()[i]);
+    }
+    cache.update(priming);
+}
+
+void
+printResult(const BenchResult& result, size_t upstream_queries,
+            size_t upstream_drops, double qps, bool json)
+{
+    const double throughput = result.duration > 0 ?
+        result.answered / result.duration : 0;
+    const double upstream_ratio = result.sent > 0 ?
+        static_cast<double>(upstream_queries) / result.sent : 0;
+    if (json) {
+        ElementPtr e = Element::createMap();
+        e->set("qps", Element::create(qps));
+        e->set("sent", Element::create(static_cast<long int>(result.sent)));
+        e->set("answered",
+               Element::create(static_cast<long int>(result.answered)));
+        e->set("failed", Element::create(static_cast<long int>(result.failed)));
+        e->set("lost", Element::create(static_cast<long int>(result.lost)));
+        e->set("duration", Element::create(result.duration));
+        e->set("throughput", Element::create(throughput));
+        e->set("upstream_queries",
+               Element::create(static_cast<long int>(upstream_queries)));
+        e->set("upstream_drops",
+               Element::create(static_cast<long int>(upstream_drops)));
+        ElementPtr latency = Element::createMap();
+        latency->set("p50", Element::create(static_cast<long int>(
+                                                result.getPercentile(50))));
+        latency->set("p90", Element::create(static_cast<long int>(
+                                                result.getPercentile(90))));
+        latency->set("p99", Element::create(static_cast<long int>(
+                                                result.getPercentile(99))));
+        latency->set("p99.9", Element::create(static_cast<long int>(
+                                                  result.getPercentile(99.9))));
+        latency->set("max", Element::create(static_cast<long int>(
+                                                result.getPercentile(100))));
+        e->set("latency_usec", latency);
+        cout << e->str() << endl;
+        return;
+    }
+
+    cout << "Answered " << result.answered << "/" << result.sent
+         << " queries in ";
+    cout.precision(6);
+    cout << fixed << result.duration << "s";
+    cout.precision(2);
+    cout << " (" << fixed << throughput << "qps), " << result.failed
+         << " failed, " << result.lost << " lost" << endl;
+    cout << "  upstream: " << upstream_queries << " queries ("
+         << upstream_ratio << " per query), " << upstream_drops
+         << " dropped" << endl;
+    cout << "  latency (usec): p50=" << result.getPercentile(50)
+         << " p90=" << result.getPercentile(90)
+         << " p99=" << result.getPercentile(99)
+         << " p99.9=" << result.getPercentile(99.9)
+         << " max=" << result.getPercentile(100) << endl;
+}
+
+const int COUNT_DEFAULT = 10000;
+const double QPS_DEFAULT = 1000;
+const double HIT_RATIO_DEFAULT = 0.9;
+const double ZIPF_DEFAULT = 1.0;
+const int TIMEOUT_DEFAULT = 5000;
+const int QUERY_TIMEOUT_DEFAULT = 2000;
+
+void
+usage() {
+    const HierarchyParams params;
+    cerr <<
+        "Usage: resolver-hierarchy-bench [-dj] [-n count] [-q qps] "
+        "[-r hit_ratio] [-z zipf]\n"
+        "                 [-t tlds] [-s slds] [-H hosts] [-S sld_servers] "
+        "[-l latency]\n"
+        "                 [-L loss] [-p port] [-T timeout] "
+        "[-Q query_timeout]\n"
+        "  -d Enable debug logging to stdout\n"
+        "  -j Print the results in JSON\n"
+        "  -n Number of queries (default: " << COUNT_DEFAULT << ")\n"
+        "  -q Queries sent per second (default: " << QPS_DEFAULT << ")\n"
+        "  -r Ratio of the queries for names of the population, which can\n"
+        "     be answered from the cache once asked; the others are for\n"
+        "     new names (default: " << HIT_RATIO_DEFAULT << ")\n"
+        "  -z Exponent of the Zipf distribution of the popularity of the\n"
+        "     names; 0 for a uniform one (default: " << ZIPF_DEFAULT << ")\n"
+        "  -t Number of top level domains (default: " << params.tld_count
+         << ")\n"
+        "  -s Number of second level domains per top level domain "
+        "(default: " << params.sld_count << ")\n"
+        "  -H Number of hosts per second level domain (default: "
+         << params.host_count << ")\n"
+        "  -S Number of servers of the second level domains (default: "
+         << params.sld_servers << ")\n"
+        "  -l Latency of the authoritative servers in msec (default: "
+         << params.latency << ")\n"
+        "  -L Percentage of queries the authoritative servers drop "
+        "(default: " << params.loss * 100 << ")\n"
+        "  -p Port of the authoritative servers (default: " << params.port
+         << ")\n"
+        "  -T Timeout for the answers of the resolver in msec (default: "
+         << TIMEOUT_DEFAULT << ")\n"
+        "  -Q Timeout of the resolver for upstream queries in msec "
+        "(default: " << QUERY_TIMEOUT_DEFAULT << ")"
+         << endl;
+    exit (1);
+}
+}
+
+int
+main(int argc, char* argv[]) {
+    int ch;
+    int count = COUNT_DEFAULT;
+    double qps = QPS_DEFAULT;
+    double hit_ratio = HIT_RATIO_DEFAULT;
+    double zipf = ZIPF_DEFAULT;
+    int timeout = TIMEOUT_DEFAULT;
+    int query_timeout = QUERY_TIMEOUT_DEFAULT;
+    HierarchyParams params;
+    bool debug_log = false;
+    bool json = false;
+    while ((ch = getopt(argc, argv, "djn:q:r:z:t:s:H:S:l:L:p:T:Q:")) != -1) {
+        switch (ch) {
+        case 'd':
+            debug_log = true;
+            break;
+        case 'j':
+            json = true;
+            break;
+        case 'n':
+            count = atoi(optarg);
+            break;
+        case 'q':
+            qps = atof(optarg);
+            break;
+        case 'r':
+            hit_ratio = atof(optarg);
+            break;
+        case 'z':
+            zipf = atof(optarg);
+            break;
+        case 't':
+            params.tld_count = atoi(optarg);
+            break;
+        case 's':
+            params.sld_count = atoi(optarg);
+            break;
+        case 'H':
+            params.host_count = atoi(optarg);
+            break;
+        case 'S':
+            params.sld_servers = atoi(optarg);
+            break;
+        case 'l':
+            params.latency = atoi(optarg);
+            break;
+        case 'L':
+            params.loss = atof(optarg) / 100;
+            break;
+        case 'p':
+            params.port = atoi(optarg);
+            break;
+        case 'T':
+            timeout = atoi(optarg);
+            break;
+        case 'Q':
+            query_timeout = atoi(optarg);
+            break;
+        case '?':
+        default:
+            usage();
+        }
+    }
+    if (optind != argc || count <= 0 || qps <= 0 || hit_ratio < 0 ||
+        hit_ratio > 1 || zipf < 0 || params.tld_count == 0 ||
+        params.sld_count == 0 || params.host_count == 0 ||
+        params.sld_servers == 0 || params.loss < 0 || params.loss > 1 ||
+        params.port == 0 || timeout <= 0 || query_timeout <= 0) {
+        usage();
+    }
+
+    // By default disable logging to avoid unwanted noise.
+    initLogger("resolver-hierarchy-bench",
+               debug_log ? bundy::log::DEBUG : bundy::log::NONE,
+               bundy::log::MAX_DEBUG_LEVEL, NULL);
+
+    int ret = 0;
+    try {
+        IOService hierarchy_service;
+        FakeHierarchy hierarchy(hierarchy_service, params);
+        NameGenerator names(hierarchy, hit_ratio, zipf);
+        vector<vector<uint8_t> > queries = buildQueries(names, count);
+
+        if (!json) {
+            cout << "Parameters:" << endl;
+            cout << "  Queries: " << count << " at " << qps
+                 << "qps, hit ratio " << hit_ratio << ", Zipf exponent "
+                 << zipf << endl;
+            cout << "  Hierarchy: " << params.tld_count << " TLDs, "
+                 << params.sld_count << " SLDs per TLD on "
+                 << params.sld_servers << " servers, " << params.host_count
+                 << " hosts per SLD" << endl;
+            cout << "  Network: latency " << params.latency << "ms, loss "
+                 << params.loss * 100 << "%" << endl << endl;
+        }
+
+        boost::shared_ptr<Resolver> resolver(new Resolver());
+        bundy::nsas::NameserverAddressStore nsas(resolver);
+        resolver->setNameserverAddressStore(nsas);
+        bundy::cache::ResolverCache cache;
+        resolver->setCache(cache);
+        primeCache(cache, hierarchy);
+
+        IOService io_service;
+        DNSService dns_service(io_service, resolver->getDNSLookupProvider(),
+                               resolver->getDNSAnswerProvider());
+        resolver->setDNSService(dns_service);
+        resolver->setNameserverPort(params.port);
+        uint16_t port;
+        dns_service.addServerUDPFromFD(createServerSocket(port), AF_INET);
+        int rcode;
+        config::parseAnswer(rcode, resolver->updateConfig(Element::fromJSON(
+            "{\"query_acl\": [{\"action\": \"ACCEPT\","
+            "                  \"from\": \"127.0.0.1\"}],"
+            " \"timeout_query\": " +
+            boost::lexical_cast<string>(query_timeout) + "}")));
+        if (rcode != 0) {
+            bundy_throw(bundy::Unexpected, "failed to configure the resolver");
+        }
+
+        hierarchy.start();
+        Thread hierarchy_thread(boost::bind(&IOService::run,
+                                            &hierarchy_service));
+        Thread io_thread(boost::bind(&IOService::run, &io_service));
+        BenchResult result;
+        try {
+            result = runClient(queries, qps, timeout, port);
+        } catch (...) {
+            io_service.stop();
+            hierarchy_service.stop();
+            io_thread.wait();
+            hierarchy_thread.wait();
+            throw;
+        }
+        io_service.stop();
+        hierarchy_service.stop();
+        io_thread.wait();
+        hierarchy_thread.wait();
+
+        printResult(result, hierarchy.getQueryCount(),
+                    hierarchy.getDropCount(), qps, json);
+    } catch (const std::exception& ex) {
+        cerr << "Test unexpectedly failed: " << ex.what() << endl;
+        ret = 1;
+    }
+
+    return (ret);
+}
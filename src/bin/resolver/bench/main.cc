@@ -13,9 +13,15 @@
 // PERFORMANCE OF THIS SOFTWARE.
 
 #include <resolver/bench/naive_resolver.h>
+#include <resolver/bench/threaded_resolver.h>
 
 #include <bench/benchmark.h>
 
+#include <algorithm>
+#include <iostream>
+
+#include <unistd.h>
+
 const size_t count = 1000; // TODO: We may want to read this from argv.
 
 int main(int, const char**) {
@@ -23,5 +29,20 @@ int main(int, const char**) {
     bundy::resolver::bench::NaiveResolver naive_resolver(count);
     bundy::bench::BenchMark<bundy::resolver::bench::NaiveResolver>
         (1, naive_resolver, true);
+
+    // The same amount of work split between threads sharing the cache,
+    // doubling the threads up to the number of CPUs.
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    const size_t max_threads = cpus > 1 ? cpus : 1;
+    for (size_t threads = 1; ; threads = std::min(threads * 2, max_threads)) {
+        std::cout << "Threaded resolver, " << threads << " thread(s): ";
+        bundy::resolver::bench::ThreadedResolver threaded_resolver(count,
+                                                                   threads);
+        bundy::bench::BenchMark<bundy::resolver::bench::ThreadedResolver>
+            (1, threaded_resolver, true);
+        if (threads == max_threads) {
+            break;
+        }
+    }
     return 0;
 }
@@ -21,8 +21,8 @@ namespace bundy {
 namespace resolver {
 namespace bench {
 
-NaiveResolver::NaiveResolver(size_t query_count) :
-    interface_(query_count),
+NaiveResolver::NaiveResolver(size_t query_count, FakeCache* cache) :
+    interface_(query_count, cache),
     processed_(false)
 {}
 
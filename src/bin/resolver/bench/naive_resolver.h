@@ -29,7 +29,10 @@ namespace bench {
 class NaiveResolver {
 public:
     /// \brief Constructor. Initializes the data.
-    NaiveResolver(size_t query_count);
+    ///
+    /// The queries use the given cache if it's not NULL (see
+    /// \c FakeInterface).
+    NaiveResolver(size_t query_count, FakeCache* cache = NULL);
     /// \brief Run the resolution.
     size_t run();
 private:
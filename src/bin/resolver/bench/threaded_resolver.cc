@@ -0,0 +1,70 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <resolver/bench/threaded_resolver.h>
+
+#include <util/threads/thread.h>
+
+#include <boost/bind.hpp>
+
+namespace bundy {
+namespace resolver {
+namespace bench {
+
+namespace {
+
+// The number of shards of the cache, the same as in the resolver cache.
+const size_t cache_shards = 16;
+
+void
+runResolver(NaiveResolver* resolver, size_t* count) {
+    *count = resolver->run();
+}
+
+}
+
+ThreadedResolver::ThreadedResolver(size_t query_count, size_t thread_count) :
+    cache_(cache_shards)
+{
+    // The interfaces are created here, from a single thread (see
+    // FakeInterface).
+    for (size_t i = 0; i < thread_count; ++i) {
+        const size_t count = query_count / thread_count +
+            (i < query_count % thread_count ? 1 : 0);
+        resolvers_.push_back(boost::shared_ptr<NaiveResolver>(
+            new NaiveResolver(count, &cache_)));
+    }
+}
+
+size_t
+ThreadedResolver::run() {
+    std::vector<size_t> counts(resolvers_.size());
+    std::vector<boost::shared_ptr<util::thread::Thread> > threads;
+    for (size_t i = 0; i < resolvers_.size(); ++i) {
+        threads.push_back(boost::shared_ptr<util::thread::Thread>(
+            new util::thread::Thread(boost::bind(&runResolver,
+                                                 resolvers_[i].get(),
+                                                 &counts[i]))));
+    }
+    size_t count = 0;
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i]->wait();
+        count += counts[i];
+    }
+    return (count);
+}
+
+}
+}
+}
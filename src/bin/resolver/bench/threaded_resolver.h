@@ -0,0 +1,53 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef RESOLVER_BENCH_THREADED_H
+#define RESOLVER_BENCH_THREADED_H
+
+#include <resolver/bench/fake_resolution.h>
+#include <resolver/bench/naive_resolver.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
+
+namespace bundy {
+namespace resolver {
+namespace bench {
+
+/// \brief Resolver running in several threads for the benchmark
+///
+/// The queries are split between the threads.  Each thread has its own
+/// interface (and event loop) and handles its queries the naive way (see
+/// \c NaiveResolver), while all of them share a sharded cache.  Running it
+/// with different number of threads shows how the resolution scales.
+class ThreadedResolver {
+public:
+    /// \brief Constructor. Initializes the data.
+    ///
+    /// \param query_count Total number of queries to resolve.
+    /// \param thread_count Number of threads to use.
+    ThreadedResolver(size_t query_count, size_t thread_count);
+    /// \brief Run the resolution.
+    size_t run();
+private:
+    FakeCache cache_;
+    std::vector<boost::shared_ptr<NaiveResolver> > resolvers_;
+};
+
+}
+}
+}
+
+#endif
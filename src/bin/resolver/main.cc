@@ -103,6 +103,13 @@ my_command_handler(const string& command, ConstElementPtr args) {
             LOG_DEBUG(resolver_logger, RESOLVER_DBG_INIT,
                       RESOLVER_SHUTDOWN_RECEIVED);
             io_service.stop();
+        } else if (command == "save_cache") {
+            if (resolver->getCacheSnapshotFile().empty()) {
+                answer = createAnswer(1, "no cache_snapshot_file configured");
+            } else if (!resolver->saveCacheSnapshot()) {
+                answer = createAnswer(1, "failed to save the cache to " +
+                                      resolver->getCacheSnapshotFile());
+            }
         }
 
         return (answer);
@@ -240,11 +247,19 @@ main(int argc, char* argv[]) {
         resolver->updateConfig(config_session->getFullConfig(), true);
         LOG_DEBUG(resolver_logger, RESOLVER_DBG_INIT, RESOLVER_CONFIG_LOADED);
 
+        // Fill the cache with what was saved on the last shutdown, on top
+        // of the priming data.
+        resolver->loadCacheSnapshot();
+
         // Now start asynchronous read.
         config_session->start();
 
         LOG_INFO(resolver_logger, RESOLVER_STARTED);
         io_service.run();
+
+        // The cache and the NSAS are local to this block, so it's saved
+        // here rather than after the cleanup.
+        resolver->saveCacheSnapshot();
     } catch (const std::exception& ex) {
         LOG_FATAL(resolver_logger, RESOLVER_FAILED).arg(ex.what());
         ret = 1;
@@ -17,6 +17,8 @@
 #include <stdint.h>
 #include <sys/types.h>
 #include <netinet/in.h>
+#include <sys/stat.h>
+#include <errno.h>
 
 #include <algorithm>
 #include <vector>
@@ -82,6 +84,9 @@ public:
         client_timeout_(4000),
         lookup_timeout_(30000),
         retries_(3),
+        prefetch_hits_(10),
+        prefetch_window_(10),
+        nameserver_port_(53),
         // we apply "reject all" (implicit default of the loader) ACL by
         // default:
         query_acl_(acl::dns::getRequestLoader().load(Element::fromJSON("[]"))),
@@ -106,6 +111,7 @@ public:
                                         client_timeout_,
                                         lookup_timeout_,
                                         retries_);
+        rec_query_->setNameserverPort(nameserver_port_);
     }
 
     void queryShutdown() {
@@ -192,6 +198,18 @@ public:
     /// Number of retries after timeout
     unsigned retries_;
 
+    /// Number of hits of a cached response near its expiry that trigger
+    /// refreshing it; 0 disables prefetching
+    unsigned prefetch_hits_;
+    /// Percentage of the TTL at the end of which hits are counted
+    unsigned prefetch_window_;
+
+    /// Port the queries are sent to on the nameservers
+    uint16_t nameserver_port_;
+
+    /// File the cache is saved to; empty if it isn't saved
+    std::string cache_snapshot_file_;
+
 private:
     /// ACL on incoming queries
     boost::shared_ptr<const RequestACL> query_acl_;
@@ -373,6 +391,7 @@ void
 Resolver::setCache(bundy::cache::ResolverCache& cache)
 {
     cache_ = &cache;
+    cache_->setPrefetch(impl_->prefetch_hits_, impl_->prefetch_window_);
 }
 
 
@@ -602,6 +621,13 @@ Resolver::updateConfig(ConstElementPtr config, bool startup) {
                         ctimeoutE(config->get("timeout_client")),
                         ltimeoutE(config->get("timeout_lookup")),
                         retriesE(config->get("retries"));
+        bool set_prefetch(false);
+        unsigned prefetch_hits = impl_->prefetch_hits_;
+        unsigned prefetch_window = impl_->prefetch_window_;
+        ConstElementPtr prefetch_hitsE(config->get("prefetch_hits")),
+                        prefetch_windowE(config->get("prefetch_window"));
+        const ConstElementPtr cache_snapshot_fileE(
+            config->get("cache_snapshot_file"));
         if (qtimeoutE) {
             // It should be safe to just get it, the config manager should
             // check for us
@@ -643,6 +669,26 @@ Resolver::updateConfig(ConstElementPtr config, bool startup) {
             retries = retriesE->intValue();
             set_timeouts = true;
         }
+        if (prefetch_hitsE) {
+            if (prefetch_hitsE->intValue() < 0) {
+                LOG_ERROR(resolver_logger, RESOLVER_BAD_PREFETCH)
+                          .arg("prefetch_hits").arg(prefetch_hitsE->intValue());
+                bundy_throw(BadValue, "Negative number of prefetch hits");
+            }
+            prefetch_hits = prefetch_hitsE->intValue();
+            set_prefetch = true;
+        }
+        if (prefetch_windowE) {
+            if (prefetch_windowE->intValue() < 0 ||
+                prefetch_windowE->intValue() > 100) {
+                LOG_ERROR(resolver_logger, RESOLVER_BAD_PREFETCH)
+                          .arg("prefetch_window")
+                          .arg(prefetch_windowE->intValue());
+                bundy_throw(BadValue, "Prefetch window out of range");
+            }
+            prefetch_window = prefetch_windowE->intValue();
+            set_prefetch = true;
+        }
         // Everything OK, so commit the changes
         // listenAddresses can fail to bind, so try them first
         bool need_query_restart = false;
@@ -663,6 +709,12 @@ Resolver::updateConfig(ConstElementPtr config, bool startup) {
             setTimeouts(qtimeout, ctimeout, ltimeout, retries);
             need_query_restart = true;
         }
+        if (set_prefetch) {
+            setPrefetch(prefetch_hits, prefetch_window);
+        }
+        if (cache_snapshot_fileE) {
+            setCacheSnapshotFile(cache_snapshot_fileE->stringValue());
+        }
         if (query_acl) {
             setQueryACL(query_acl);
         }
@@ -730,6 +782,93 @@ Resolver::setTimeouts(int query_timeout, int client_timeout,
     impl_->retries_ = retries;
 }
 
+void
+Resolver::setNameserverPort(uint16_t port) {
+    impl_->nameserver_port_ = port;
+}
+
+void
+Resolver::setPrefetch(unsigned hits, unsigned window) {
+    LOG_DEBUG(resolver_logger, RESOLVER_DBG_CONFIG, RESOLVER_SET_PREFETCH)
+              .arg(hits).arg(window);
+
+    impl_->prefetch_hits_ = hits;
+    impl_->prefetch_window_ = window;
+    if (cache_ != NULL) {
+        cache_->setPrefetch(hits, window);
+    }
+}
+
+unsigned
+Resolver::getPrefetchHits() const {
+    return impl_->prefetch_hits_;
+}
+
+unsigned
+Resolver::getPrefetchWindow() const {
+    return impl_->prefetch_window_;
+}
+
+void
+Resolver::setCacheSnapshotFile(const std::string& filename) {
+    impl_->cache_snapshot_file_ = filename;
+}
+
+const std::string&
+Resolver::getCacheSnapshotFile() const {
+    return (impl_->cache_snapshot_file_);
+}
+
+bool
+Resolver::saveCacheSnapshot() const {
+    const std::string& filename = impl_->cache_snapshot_file_;
+    if (filename.empty() || cache_ == NULL) {
+        return (false);
+    }
+    try {
+        bundy::nsas::AddressRTTs rtts;
+        if (nsas_ != NULL) {
+            nsas_->getRTTs(rtts);
+        }
+        const size_t count = cache_->saveSnapshot(filename, rtts);
+        LOG_INFO(resolver_logger, RESOLVER_CACHE_SNAPSHOT_SAVED).arg(count).
+            arg(rtts.size()).arg(filename);
+        return (true);
+    } catch (const bundy::Exception& ex) {
+        LOG_ERROR(resolver_logger, RESOLVER_CACHE_SNAPSHOT_SAVE_FAILED).
+            arg(filename).arg(ex.what());
+        return (false);
+    }
+}
+
+bool
+Resolver::loadCacheSnapshot() {
+    const std::string& filename = impl_->cache_snapshot_file_;
+    if (filename.empty() || cache_ == NULL) {
+        return (false);
+    }
+    struct stat st;
+    if (stat(filename.c_str(), &st) == -1 && errno == ENOENT) {
+        LOG_DEBUG(resolver_logger, RESOLVER_DBG_INIT,
+                  RESOLVER_CACHE_SNAPSHOT_NONE).arg(filename);
+        return (false);
+    }
+    try {
+        bundy::nsas::AddressRTTs rtts;
+        const size_t count = cache_->loadSnapshot(filename, rtts);
+        if (nsas_ != NULL) {
+            nsas_->setRTTHints(rtts);
+        }
+        LOG_INFO(resolver_logger, RESOLVER_CACHE_SNAPSHOT_LOADED).arg(count).
+            arg(rtts.size()).arg(filename);
+        return (true);
+    } catch (const bundy::Exception& ex) {
+        LOG_ERROR(resolver_logger, RESOLVER_CACHE_SNAPSHOT_LOAD_FAILED).
+            arg(filename).arg(ex.what());
+        return (false);
+    }
+}
+
 int
 Resolver::getQueryTimeout() const {
     return impl_->query_timeout_;
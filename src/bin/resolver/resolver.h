@@ -194,6 +194,65 @@ public:
                      int lookup_timeout = 30000,
                      unsigned retries = 3);
 
+    /**
+     * \short Set the port the queries are sent to on the nameservers.
+     *
+     * This is 53 by default.  Other ports are only meant for benchmarks
+     * and tests running fake nameservers; it is used by the queries
+     * started after the next configuration update.
+     */
+    void setNameserverPort(uint16_t port);
+
+    /**
+     * \short Set options related to prefetching.
+     *
+     * A cached response that is looked up \c hits times within the last
+     * \c window percent of its TTL is refreshed in the background, so it
+     * doesn't expire while it's in use.  The parameters are applied to
+     * the cache set by \c setCache().
+     * \param hits The number of hits; 0 disables prefetching.
+     * \param window The percentage of the TTL (up to 100).
+     */
+    void setPrefetch(unsigned hits = 10, unsigned window = 10);
+
+    /// \brief Get the number of hits that trigger prefetching.
+    unsigned getPrefetchHits() const;
+
+    /// \brief Get the percentage of the TTL in which hits are counted.
+    unsigned getPrefetchWindow() const;
+
+    /**
+     * \short Set the file the cache is saved to.
+     *
+     * The cache set by \c setCache() and the RTTs of the NSAS are saved
+     * to the file by \c saveCacheSnapshot() and loaded from it by
+     * \c loadCacheSnapshot(), so the cache isn't empty after a restart.
+     * \param filename The name of the file; an empty name disables
+     * saving and loading the cache.
+     */
+    void setCacheSnapshotFile(const std::string& filename);
+
+    /// \brief Get the file the cache is saved to.
+    const std::string& getCacheSnapshotFile() const;
+
+    /**
+     * \short Save the cache to the cache snapshot file.
+     *
+     * Nothing is done if no file is set.  Errors are logged.
+     * \return true if the cache was saved.
+     */
+    bool saveCacheSnapshot() const;
+
+    /**
+     * \short Fill the cache from the cache snapshot file.
+     *
+     * Meant to be called on startup, once the cache and the NSAS are set.
+     * Nothing is done if no file is set or it doesn't exist.  Errors are
+     * logged.
+     * \return true if the cache was loaded.
+     */
+    bool loadCacheSnapshot();
+
     /**
      * \short Get info about timeouts.
      *
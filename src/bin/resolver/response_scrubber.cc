@@ -17,6 +17,7 @@
 #include <dns/message.h>
 #include <dns/rrset.h>
 #include <dns/name.h>
+#include <dns/labelsequence.h>
 #include "response_scrubber.h"
 
 using namespace bundy::dns;
@@ -52,63 +53,68 @@ ResponseScrubber::scrubSection(Message& message,
     const NameComparisonResult::NameRelation connection,
     const Message::Section section)
 {
-    unsigned int count = 0;     // Count of RRsets removed
-    unsigned int kept = 0;      // Count of RRsets kept
-    bool removed = true;        // Set true if RRset removed in a pass
+    // Build the label sequences of the given names once; each RRset is then
+    // compared against them without re-deriving the labels of both names on
+    // every comparison.
+    vector<LabelSequence> labels;
+    labels.reserve(names.size());
+    for (vector<const Name*>::const_iterator n = names.begin();
+         n != names.end(); ++n) {
+        labels.push_back(LabelSequence(**n));
+    }
 
-    // Need to go through the section multiple times as when an RRset is
-    // removed, all iterators into the section are invalidated.  This condition
-    // is flagged by "remove" being set true when an RRset is removed.
+    // Single pass over the section deciding which RRsets must go.  The
+    // common case of a well-behaved server leaves this empty, so the section
+    // is not touched at all.
+    vector<RRsetPtr> unwanted;
+    for (RRsetIterator i = message.beginSection(section);
+         i != message.endSection(section); ++i) {
+
+        // Loop through the list of names given and see if any are in the
+        // given relationship with the QNAME of this RRset
+        const LabelSequence rrset_labels((*i)->getName());
+        bool match = false;
+        for (vector<LabelSequence>::const_iterator n = labels.begin();
+             n != labels.end(); ++n) {
+            const NameComparisonResult::NameRelation relationship =
+                rrset_labels.compare(*n).getRelation();
+            if ((relationship == NameComparisonResult::EQUAL) ||
+               (relationship == connection)) {
+
+                // RRset in the specified relationship, so a match has
+                // been found
+                match = true;
+                break;
+            }
+        }
 
-    while (removed) {
-        RRsetIterator i = message.beginSection(section);
+        // Remember the RRset if there was no match to one of the given
+        // names.  (Only the pointer is held; the RRset is not copied.)
+        if (!match) {
+            unwanted.push_back(*i);
+        }
+    }
 
-        // Skips the ones that have been checked (and retained) in a previous
-        // pass through the "while" loop.  (Although RRset removal invalidates
-        // iterators, it does not change the relative order of the retained
-        // RRsets in the section.)
-        for (int j = 0; j < kept; ++j) {
+    // Removing an RRset invalidates all iterators into the section, so each
+    // removal needs a fresh one.  The relative order of the remaining RRsets
+    // is unchanged, so the search for the next unwanted RRset resumes at the
+    // position where the previous one was removed instead of rescanning the
+    // retained RRsets.
+    unsigned int kept = 0;      // Count of RRsets kept ahead of the cursor
+    for (vector<RRsetPtr>::const_iterator u = unwanted.begin();
+         u != unwanted.end(); ++u) {
+        RRsetIterator i = message.beginSection(section);
+        for (unsigned int j = 0; j < kept; ++j) {
             ++i;
         }
-
-        // Start looking at the remaining entries in the section.
-        removed = false;
-        for (; i != message.endSection(section); ++i) {
-
-            // Loop through the list of names given and see if any are in the
-            // given relationship with the QNAME of this RRset
-            bool match = false;
-            for (vector<const Name*>::const_iterator n = names.begin();
-                 n != names.end(); ++n) {
-                NameComparisonResult result = (*i)->getName().compare(**n);
-                NameComparisonResult::NameRelation relationship =
-                    result.getRelation();
-                if ((relationship == NameComparisonResult::EQUAL) ||
-                   (relationship == connection)) {
-
-                    // RRset in the specified relationship, so a match has
-                    // been found
-                    match = true;
-                    break;
-                }
-            }
-
-            // Remove the RRset if there was no match to one of the given names.
-            if (!match) {
-                message.removeRRset(section, i);
-                ++count;            // One more RRset removed
-                removed = true;     // Something was removed
-                break; // It invalidated the iterators, start again
-             } else {
-
-                // There was a match so this is one more entry we can skip next
-                // time.
-                ++kept;
-             }
+        while ((*i) != (*u)) {
+            ++i;
+            ++kept;
         }
+        message.removeRRset(section, i);
     }
 
-    return (count);
+    return (unwanted.size());
 }
 
 // Perform the scrubbing of all sections of the message.
@@ -18,6 +18,7 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <netdb.h>
+#include <unistd.h>
 
 #include <cerrno>
 #include <cstring>
@@ -383,6 +384,55 @@ TEST_F(ResolverConfig, timeoutsConfig) {
     EXPECT_EQ(4, server.getRetries());
 }
 
+TEST_F(ResolverConfig, prefetch) {
+    EXPECT_EQ(10, server.getPrefetchHits());
+    EXPECT_EQ(10, server.getPrefetchWindow());
+    server.setPrefetch(0, 20);
+    EXPECT_EQ(0, server.getPrefetchHits());
+    EXPECT_EQ(20, server.getPrefetchWindow());
+
+    ConstElementPtr config = Element::fromJSON("{"
+                                               "\"prefetch_hits\": 5,"
+                                               "\"prefetch_window\": 15"
+                                               "}");
+    ConstElementPtr result(server.updateConfig(config));
+    EXPECT_EQ(result->toWire(), bundy::config::createAnswer()->toWire());
+    EXPECT_EQ(5, server.getPrefetchHits());
+    EXPECT_EQ(15, server.getPrefetchWindow());
+
+    invalidTest("{\"prefetch_hits\": -1}", "Negative prefetch hits");
+    invalidTest("{\"prefetch_window\": 101}", "Too large prefetch window");
+    invalidTest("{\"prefetch_window\": -1}", "Negative prefetch window");
+}
+
+TEST_F(ResolverConfig, cacheSnapshot) {
+    // Disabled by default
+    EXPECT_EQ("", server.getCacheSnapshotFile());
+    EXPECT_FALSE(server.saveCacheSnapshot());
+    EXPECT_FALSE(server.loadCacheSnapshot());
+
+    const string filename(TEST_DATA_BUILDDIR "/resolver_cache.snapshot");
+    ConstElementPtr config = Element::fromJSON("{\"cache_snapshot_file\": \"" +
+                                               filename + "\"}");
+    ConstElementPtr result(server.updateConfig(config));
+    EXPECT_EQ(result->toWire(), bundy::config::createAnswer()->toWire());
+    EXPECT_EQ(filename, server.getCacheSnapshotFile());
+
+    // Save a cache and load it into another one
+    bundy::cache::ResolverCache cache;
+    server.setCache(cache);
+    EXPECT_TRUE(server.saveCacheSnapshot());
+    bundy::cache::ResolverCache new_cache;
+    server.setCache(new_cache);
+    EXPECT_TRUE(server.loadCacheSnapshot());
+
+    // A missing file is no error, but nothing is loaded
+    EXPECT_EQ(0, unlink(filename.c_str()));
+    EXPECT_FALSE(server.loadCacheSnapshot());
+
+    invalidTest("{\"cache_snapshot_file\": 1}", "Wrong file name type");
+}
+
 TEST_F(ResolverConfig, invalidTimeoutsConfig) {
     invalidTest("{"
         "\"timeout_query\": \"error\""
@@ -101,31 +101,69 @@ getErrorCode(const int status) {
 }
 
 
-// Handle the request from the client.
-//
-// Reads the type and family of socket required, creates the socket and returns
-// it to the client.
-//
-// The arguments passed (and the exceptions thrown) are the same as those for
-// run().
+// The socket requested by the client, as read by readSocketRequest().
+struct SocketRequest {
+    int sock_type;
+    sockaddr* addr;
+    size_t addr_len;
+    sockaddr_in addr_in;
+    sockaddr_in6 addr_in6;
+};
+
+// Tell the client the socket couldn't be created.
 void
-handleRequest(const int input_fd, const int output_fd,
-              const get_sock_t get_sock, const send_fd_t send_fd_fun,
-              const close_t close_fun)
+writeError(const int output_fd, const int result) {
+    // Save the errno before anything could change it.
+    const int error_number = errno;
+
+    char error_message[2];
+    error_message[0] = 'E';
+    error_message[1] = getErrorCode(result);
+    writeMessage(output_fd, error_message, sizeof(error_message));
+
+    // ...and append the reason code to the error message
+    writeMessage(output_fd, &error_number, sizeof(error_number));
+}
+
+// Send a socket to the client and close our copy.
+void
+sendSocket(const int output_fd, const int sock, const send_fd_t send_fd_fun,
+           const close_t close_fun)
+{
+    if (send_fd_fun(output_fd, sock) != 0) {
+        // Error.  Close the socket (ignore any error from that operation)
+        // and abort.
+        close_fun(sock);
+        bundy_throw(InternalError, "Error sending descriptor");
+    }
+
+    // Successfully sent the socket, so free up resources we still hold
+    // for it.
+    if (close_fun(sock) == -1) {
+        bundy_throw(InternalError, "Error closing socket");
+    }
+}
+
+// Read the type, family and address of the socket requested by the client.
+void
+readSocketRequest(const int input_fd, const int output_fd,
+                  SocketRequest& request)
 {
     // Read the message from the client
     char type[2];
     readMessage(input_fd, type, sizeof(type));
 
     // Decide what type of socket is being asked for
-    const int sock_type = getSocketType(type[0], output_fd);
+    request.sock_type = getSocketType(type[0], output_fd);
 
     // Read the address they ask for depending on what address family was
     // specified.
-    sockaddr* addr = NULL;
-    size_t addr_len = 0;
-    sockaddr_in addr_in;
-    sockaddr_in6 addr_in6;
+    sockaddr*& addr = request.addr;
+    size_t& addr_len = request.addr_len;
+    sockaddr_in& addr_in = request.addr_in;
+    sockaddr_in6& addr_in6 = request.addr_in6;
+    addr = NULL;
+    addr_len = 0;
     switch (type[1]) { // The address family
 
         // The casting to apparently incompatible types is required by the
@@ -155,34 +193,88 @@ handleRequest(const int input_fd, const int output_fd,
         default:
             protocolError(output_fd);
     }
+}
+
+// Handle the request from the client.
+//
+// Reads the type and family of socket required, creates the socket and returns
+// it to the client.
+//
+// The arguments passed (and the exceptions thrown) are the same as those for
+// run().
+void
+handleRequest(const int input_fd, const int output_fd,
+              const get_sock_t get_sock, const send_fd_t send_fd_fun,
+              const close_t close_fun)
+{
+    SocketRequest request;
+    readSocketRequest(input_fd, output_fd, request);
 
     // Obtain the socket
-    const int result = get_sock(sock_type, addr, addr_len, close_fun);
+    const int result = get_sock(request.sock_type, request.addr,
+                                request.addr_len, close_fun);
     if (result >= 0) {
         // Got the socket, send it to the client.
         writeMessage(output_fd, "S", 1);
-        if (send_fd_fun(output_fd, result) != 0) {
-            // Error.  Close the socket (ignore any error from that operation)
-            // and abort.
-            close_fun(result);
-            bundy_throw(InternalError, "Error sending descriptor");
+        sendSocket(output_fd, result, send_fd_fun, close_fun);
+    } else {
+        // Error.  Tell the client.
+        writeError(output_fd, result);
+    }
+}
+
+// Handle the request for a group of sockets from the client.
+//
+// Reads the socket description as for handleRequest(), then the size of the
+// group and the CPU of each socket.  All the sockets are created before any
+// is sent, so the client gets either the whole group or an error.
+void
+handleGroupRequest(const int input_fd, const int output_fd,
+                   const get_reuseport_sock_t get_sock,
+                   const send_fd_t send_fd_fun, const close_t close_fun)
+{
+    SocketRequest request;
+    readSocketRequest(input_fd, output_fd, request);
+
+    uint16_t count;
+    readMessage(input_fd, &count, sizeof(count));
+    if (count == 0 || count > MAX_SOCKET_GROUP_SIZE) {
+        protocolError(output_fd);
+    }
+    int cpus[MAX_SOCKET_GROUP_SIZE];
+    readMessage(input_fd, cpus, count * sizeof(cpus[0]));
+
+    int socks[MAX_SOCKET_GROUP_SIZE];
+    for (size_t i = 0; i < count; ++i) {
+        const int result = get_sock(request.sock_type, request.addr,
+                                    request.addr_len, cpus[i], close_fun);
+        if (result < 0) {
+            // Release the ones already created (keeping the errno of the
+            // failure), and tell the client.
+            const int error_number = errno;
+            for (size_t j = 0; j < i; ++j) {
+                if (close_fun(socks[j]) == -1) {
+                    bundy_throw(InternalError, "Error closing socket");
+                }
+            }
+            errno = error_number;
+            writeError(output_fd, result);
+            return;
         }
+        socks[i] = result;
+    }
 
-        // Successfully sent the socket, so free up resources we still hold
-        // for it.
-        if (close_fun(result) == -1) {
-            bundy_throw(InternalError, "Error closing socket");
+    writeMessage(output_fd, "S", 1);
+    for (size_t i = 0; i < count; ++i) {
+        try {
+            sendSocket(output_fd, socks[i], send_fd_fun, close_fun);
+        } catch (...) {
+            // We abort anyway, but don't leak the rest of the group.
+            for (size_t j = i + 1; j < count; ++j) {
+                close_fun(socks[j]);
+            }
+            throw;
         }
-    } else {
-        // Error.  Tell the client.
-        char error_message[2];
-        error_message[0] = 'E';
-        error_message[1] = getErrorCode(result);
-        writeMessage(output_fd, error_message, sizeof(error_message));
-
-        // ...and append the reason code to the error message
-        const int error_number = errno;
-        writeMessage(output_fd, &error_number, sizeof(error_number));
     }
 }
 
@@ -232,15 +324,16 @@ int maybeClose(const int result, const int socket, const close_t close_fun) {
     return (result);
 }
 
-} // Anonymous namespace
-
-namespace bundy {
-namespace socket_creator {
-
-// Get the socket and bind to it.
+// The common implementation of getSock() and getReusePortSock().
 int
-getSock(const int type, struct sockaddr* bind_addr, const socklen_t addr_len,
-        const close_t close_fun) {
+createSock(const int type, struct sockaddr* bind_addr, const socklen_t addr_len,
+           const bool reuse_port, const int cpu, const close_t close_fun) {
+#ifndef SO_REUSEPORT
+    if (reuse_port) {
+        errno = ENOPROTOOPT;
+        return (-2);
+    }
+#endif
     const int sock = socket(bind_addr->sa_family, type, 0);
     if (sock == -1) {
         return (-1);
@@ -250,6 +343,20 @@ getSock(const int type, struct sockaddr* bind_addr, const socklen_t addr_len,
         // This is part of the binding process, so it's a bind error
         return (maybeClose(-2, sock, close_fun));
     }
+#ifdef SO_REUSEPORT
+    if (reuse_port &&
+        setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == -1) {
+        return (maybeClose(-2, sock, close_fun));
+    }
+#endif
+#ifdef SO_INCOMING_CPU
+    if (cpu >= 0) {
+        // Only a hint, so a failure (eg. an older kernel) is not an error.
+        setsockopt(sock, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu));
+    }
+#else
+    (void)cpu;
+#endif
     if (bind_addr->sa_family == AF_INET6 &&
         setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, &on, sizeof(on)) == -1) {
         // This is part of the binding process, so it's a bind error
@@ -265,10 +372,31 @@ getSock(const int type, struct sockaddr* bind_addr, const socklen_t addr_len,
     return (sock);
 }
 
+} // Anonymous namespace
+
+namespace bundy {
+namespace socket_creator {
+
+// Get the socket and bind to it.
+int
+getSock(const int type, struct sockaddr* bind_addr, const socklen_t addr_len,
+        const close_t close_fun) {
+    return (createSock(type, bind_addr, addr_len, false, -1, close_fun));
+}
+
+// Get a socket of a SO_REUSEPORT group and bind to it.
+int
+getReusePortSock(const int type, struct sockaddr* bind_addr,
+                 const socklen_t addr_len, const int cpu,
+                 const close_t close_fun) {
+    return (createSock(type, bind_addr, addr_len, true, cpu, close_fun));
+}
+
 // Main run loop.
 void
 run(const int input_fd, const int output_fd, get_sock_t get_sock,
-    send_fd_t send_fd_fun, close_t close_fun)
+    send_fd_t send_fd_fun, close_t close_fun,
+    get_reuseport_sock_t get_reuseport_sock)
 {
     for (;;) {
         char command;
@@ -279,6 +407,11 @@ run(const int input_fd, const int output_fd, get_sock_t get_sock,
                               send_fd_fun, close_fun);
                 break;
 
+            case 'G':   // The "get socket group" command
+                handleGroupRequest(input_fd, output_fd, get_reuseport_sock,
+                                   send_fd_fun, close_fun);
+                break;
+
             case 'T':   // The "terminate" command
                 return;
 
@@ -96,6 +96,30 @@ int
 getSock(const int type, struct sockaddr* bind_addr, const socklen_t addr_len,
         const close_t close_fun);
 
+/// \short Create a socket of a SO_REUSEPORT group and bind it.
+///
+/// This is the same as getSock(), except the SO_REUSEPORT option is set on
+/// the socket before binding it, so the other sockets of the group can be
+/// bound to the same address (and the kernel spreads the incoming packets
+/// or connections among them).  If a CPU is given and the system supports
+/// it, it is set as the SO_INCOMING_CPU of the socket, a hint to prefer the
+/// socket for the traffic processed on that CPU.  A failure to set the hint
+/// is ignored.
+///
+/// \param type The type of socket to create (SOCK_STREAM, SOCK_DGRAM, etc).
+/// \param bind_addr The address to bind.
+/// \param addr_len The actual length of bind_addr.
+/// \param cpu The CPU the socket is intended for, or -1 for no hint.
+/// \param close_fun The function used to close a socket if there's an error
+///     after the creation.
+///
+/// \return Same as getSock().  If the system doesn't support SO_REUSEPORT,
+///     -2 is returned and errno is set to ENOPROTOOPT.
+int
+getReusePortSock(const int type, struct sockaddr* bind_addr,
+                 const socklen_t addr_len, const int cpu,
+                 const close_t close_fun);
+
 // Define some types for functions used to perform socket-related operations.
 // These are typedefed so that alternatives can be passed through to the
 // main functions for testing purposes.
@@ -105,6 +129,15 @@ getSock(const int type, struct sockaddr* bind_addr, const socklen_t addr_len,
 typedef int (*get_sock_t)(const int, struct sockaddr *, const socklen_t,
                           const close_t close_fun);
 
+// Type of the function to get a socket of a SO_REUSEPORT group.  Arguments
+// are those described above for getReusePortSock().
+typedef int (*get_reuseport_sock_t)(const int, struct sockaddr *,
+                                    const socklen_t, const int,
+                                    const close_t close_fun);
+
+/// \brief Maximum number of sockets of a group requested at once.
+const size_t MAX_SOCKET_GROUP_SIZE = 1024;
+
 // Type of the send_fd() function, so it can be passed as a parameter.
 // Arguments are the same as those of the send_fd() function.
 typedef int (*send_fd_t)(const int, const int);
@@ -132,6 +165,9 @@ typedef int (*send_fd_t)(const int, const int);
 ///        here for testing purposes.
 /// \param close_fun The close function used to close sockets, coming from
 ///        unistd.h. It can be overriden in tests.
+/// \param get_reuseport_sock_fun The function that is used to create the
+///        sockets of a SO_REUSEPORT group.  This should be left on the
+///        default value, the parameter is here for testing purposes.
 ///
 /// \exception bundy::socket_creator::ReadError Error reading from input
 /// \exception bundy::socket_creator::WriteError Error writing to output
@@ -139,7 +175,8 @@ typedef int (*send_fd_t)(const int, const int);
 /// \exception bundy::socket_creator::InternalError Other error
 void
 run(const int input_fd, const int output_fd, get_sock_t get_sock_fun,
-    send_fd_t send_fd_fun, close_t close_fun);
+    send_fd_t send_fd_fun, close_t close_fun,
+    get_reuseport_sock_t get_reuseport_sock_fun = getReusePortSock);
 
 }   // namespace socket_creator
 }   // NAMESPACE ISC
@@ -246,6 +246,37 @@ TEST(get_sock, fail_with_bind) {
     ASSERT_TRUE(close_called); // The "socket" call should have failed already
 }
 
+// Sockets of a SO_REUSEPORT group can be bound to the same address.
+TEST(get_sock, reuseport_group) {
+#ifdef SO_REUSEPORT
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sockaddr* addr_ptr = reinterpret_cast<sockaddr*>(&addr);
+
+    const int first = getReusePortSock(SOCK_DGRAM, addr_ptr, sizeof(addr),
+                                       0, closeIgnore);
+    ASSERT_GE(first, 0) << "Couldn't create socket: " << strerror(errno);
+    int options;
+    socklen_t len = sizeof(options);
+    EXPECT_EQ(0, getsockopt(first, SOL_SOCKET, SO_REUSEPORT, &options, &len));
+    EXPECT_NE(0, options);
+
+    // Bind the second one to the port chosen for the first one.
+    len = sizeof(addr);
+    ASSERT_EQ(0, getsockname(first, addr_ptr, &len));
+    const int second = getReusePortSock(SOCK_DGRAM, addr_ptr, sizeof(addr),
+                                        -1, closeIgnore);
+    EXPECT_GE(second, 0) << "Couldn't create socket: " << strerror(errno);
+
+    EXPECT_EQ(0, close(first));
+    if (second >= 0) {
+        EXPECT_EQ(0, close(second));
+    }
+#endif
+}
+
 // The main run() function in the socket creator takes three functions to
 // get the socket, send information to it, and close it.  These allow for
 // alternatives to the system functions to be used for testing.
@@ -310,6 +341,19 @@ getSockDummy(const int type, struct sockaddr* addr, const socklen_t,
     return (result);
 }
 
+// Replacement getReusePortSock() function.  The result is the same as for
+// getSockDummy(), with the CPU in bits 5 and 6 (-1 being 3).
+int
+getReusePortSockDummy(const int type, struct sockaddr* addr,
+                      const socklen_t addr_len, const int cpu,
+                      const close_t close_fun) {
+    const int result = getSockDummy(type, addr, addr_len, close_fun);
+    if (result < 0) {
+        return (result);
+    }
+    return (result | ((cpu & 0x03) << 5));
+}
+
 // Dummy send function - return data (the result of getSock()) to the destination.
 int
 send_FdDummy(const int destination, const int what) {
@@ -345,10 +389,11 @@ void runTest(const char* input_data, const size_t input_size,
     // Run the body
     if (should_succeed) {
         EXPECT_NO_THROW(run(input_fd, output_fd, getSockDummy, send_fd,
-                            test_close));
+                            test_close, getReusePortSockDummy));
     } else {
         EXPECT_THROW(run(input_fd, output_fd, getSockDummy, send_fd,
-                         test_close), bundy::socket_creator::SocketCreatorError);
+                         test_close, getReusePortSockDummy),
+                     bundy::socket_creator::SocketCreatorError);
     }
 
     // Close the pipes
@@ -388,6 +433,49 @@ TEST(run, sockets) {
 }
 
 
+// Build a request for a group of sockets, with the given address part
+// (starting with the socket type) and CPUs.
+std::string
+groupRequest(const char* address, const size_t address_len,
+             const uint16_t count, const int* cpus)
+{
+    std::string request("G");
+    request.append(address, address_len);
+    request.append(reinterpret_cast<const char*>(&count), sizeof(count));
+    request.append(reinterpret_cast<const char*>(cpus), count * sizeof(int));
+    return (request);
+}
+
+// Check it correctly parses the requests for groups of sockets.
+TEST(run, socket_groups) {
+    const int cpus[] = { 0, 1, -1 };
+    const std::string input =
+        groupRequest("U4\xff\xff\0\0\0\0", 8, 3, cpus) +
+        groupRequest("T6\xff\xff\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0",
+                     20, 1, cpus + 1) +
+        "T";
+    runTest(input.c_str(), input.size(),
+            "S\x07\x27\x67"   // "S" + the LS byte of each socket
+            "S\x2d",            // The TCP socket for CPU 1
+            6);
+}
+
+// Check a group of sockets fails as a whole.
+TEST(run, bad_socket_group) {
+    char result[2 + sizeof(int)];
+    memset(result, 0, sizeof(result));
+    strcpy(result, "EB");
+
+    const int cpus[] = { 0, 1 };
+    const std::string input =
+        groupRequest("U4\xbb\xbb\0\0\0\0", 8, 2, cpus) + "T";
+    runTest(input.c_str(), input.size(), result, sizeof(result));
+
+    // An empty group is invalid.
+    const std::string empty = groupRequest("U4\xff\xff\0\0\0\0", 8, 0, cpus);
+    runTest(empty.c_str(), empty.size(), "FI", 2, false);
+}
+
 // Check if failures of get_socket are handled correctly.
 TEST(run, bad_sockets) {
     // We need to construct the answer, but it depends on int length.  We expect
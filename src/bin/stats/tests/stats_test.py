@@ -31,7 +31,7 @@ import sys
 import stats
 import bundy.log
 from test_utils import MyStats
-from bundy.config.ccsession import create_answer
+from bundy.config.ccsession import create_answer, create_command
 
 class TestUtilties(unittest.TestCase):
     items = [
@@ -1612,6 +1612,69 @@ class TestStats(unittest.TestCase):
             last_update_time,
             stat.statistics_data['Stats']['last_update_time'])
 
+    def test_query_statistics_since(self):
+        """Test _query_statistics asks each module for the statistics
+        changed since the last reports received from its instances"""
+        stat = MyStats()
+        class DummyDict:
+            def items(self):
+                return [('Init', 'dummy'), ('Auth', 'dummy')]
+        stat.get_statistics_data = lambda: DummyDict()
+        stat.reports_bymid = {'Auth': {'auth1': ('1034', 2),
+                                       'auth2': ('1035', 7)}}
+        commands = []
+        def __group_sendmsg(command, destination, want_answer=False):
+            commands.append((destination, command))
+            return 0
+        stat.cc_session.group_sendmsg = __group_sendmsg
+        stat._query_statistics(('Init', 'Auth'))
+        self.assertEqual(
+            [('Init', create_command('getstats', {'since': {}})),
+             ('Auth', create_command('getstats',
+                                     {'since': {'1034': 2, '1035': 7}}))],
+            commands)
+
+    def test_refresh_statistics_report(self):
+        """Test _refresh_statistics() merges the reports of the statistics
+        changed since a previous report"""
+        stat = MyStats()
+        # complete statistics data
+        stat._refresh_statistics(
+            [('Auth', 'auth1', {'queries.tcp': 10, 'queries.udp': 20,
+                                '_report': {'id': '1034', 'serial': 1,
+                                            'base': 0}})])
+        self.assertEqual(10, stat.statistics_data['Auth']['queries.tcp'])
+        self.assertEqual(20, stat.statistics_data['Auth']['queries.udp'])
+        self.assertEqual({'auth1': ('1034', 1)}, stat.reports_bymid['Auth'])
+        self.assertNotIn('_report', stat.statistics_data_bymid['Auth']['auth1'])
+
+        # changes since the first report
+        stat._refresh_statistics(
+            [('Auth', 'auth1', {'queries.tcp': 15,
+                                '_report': {'id': '1034', 'serial': 2,
+                                            'base': 1}})])
+        self.assertEqual(15, stat.statistics_data['Auth']['queries.tcp'])
+        self.assertEqual(20, stat.statistics_data['Auth']['queries.udp'])
+        self.assertEqual({'auth1': ('1034', 2)}, stat.reports_bymid['Auth'])
+
+        # changes since a report which wasn't received are ignored, and
+        # the next query asks for complete data
+        stat._refresh_statistics(
+            [('Auth', 'auth1', {'queries.tcp': 99,
+                                '_report': {'id': '1034', 'serial': 4,
+                                            'base': 3}})])
+        self.assertEqual(15, stat.statistics_data['Auth']['queries.tcp'])
+        self.assertEqual({}, stat.reports_bymid['Auth'])
+
+        # complete data replace the previous ones
+        stat._refresh_statistics(
+            [('Auth', 'auth1', {'queries.udp': 30,
+                                '_report': {'id': '1034', 'serial': 5,
+                                            'base': 0}})])
+        self.assertEqual({'queries.udp': 30},
+                         stat.statistics_data_bymid['Auth']['auth1'])
+        self.assertEqual({'auth1': ('1034', 5)}, stat.reports_bymid['Auth'])
+
     def test_polling_update_lasttime_poll(self):
         """Test _lasttime_poll is updated after do_polling()
         """
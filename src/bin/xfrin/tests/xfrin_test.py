@@ -2425,6 +2425,109 @@ class TestXfrinRecorder(unittest.TestCase):
         self.recorder.decrement(TEST_ZONE_NAME)
         self.assertEqual(self.recorder.xfrin_in_progress(TEST_ZONE_NAME), False)
 
+class TestXfrinConnectionPool(unittest.TestCase):
+    def setUp(self):
+        self.pool = XfrinConnectionPool(
+            xfrin.Counters(xfrin.SPECFILE_LOCATION), 1, 30)
+        self.shutdown_event = threading.Event()
+        self.sockets = []
+
+    def tearDown(self):
+        for sock in self.sockets:
+            sock.close()
+
+    def __socketpair(self):
+        pair = socket.socketpair()
+        self.sockets.extend(pair)
+        return pair
+
+    def test_reuse(self):
+        self.assertIsNone(self.pool.acquire(TEST_MASTER_IPV4_ADDRINFO,
+                                            self.shutdown_event))
+        sock, _ = self.__socketpair()
+        self.pool.release(TEST_MASTER_IPV4_ADDRINFO, sock)
+        self.assertEqual(1, self.pool.get_idle_count(TEST_MASTER_IPV4_ADDRINFO))
+
+        # Only sessions with the same master get the connection.
+        self.assertIsNone(self.pool.acquire(TEST_MASTER_IPV6_ADDRINFO,
+                                            self.shutdown_event))
+        self.pool.release(TEST_MASTER_IPV6_ADDRINFO, None)
+        self.assertEqual(sock, self.pool.acquire(TEST_MASTER_IPV4_ADDRINFO,
+                                                 self.shutdown_event))
+        self.assertEqual(0, self.pool.get_idle_count(TEST_MASTER_IPV4_ADDRINFO))
+        self.pool.release(TEST_MASTER_IPV4_ADDRINFO, None)
+
+    def test_stale(self):
+        # A connection closed by the master is not reused.
+        sock, peer = self.__socketpair()
+        self.pool.acquire(TEST_MASTER_IPV4_ADDRINFO, self.shutdown_event)
+        self.pool.release(TEST_MASTER_IPV4_ADDRINFO, sock)
+        peer.close()
+        self.assertIsNone(self.pool.acquire(TEST_MASTER_IPV4_ADDRINFO,
+                                            self.shutdown_event))
+        self.assertEqual(-1, sock.fileno())
+        self.assertEqual(1, self.pool._counters.get('socket', 'ipv4', 'tcp',
+                                                    'close'))
+
+    def test_limit(self):
+        self.pool.acquire(TEST_MASTER_IPV4_ADDRINFO, self.shutdown_event)
+        started = threading.Event()
+        def session():
+            self.pool.acquire(TEST_MASTER_IPV4_ADDRINFO, self.shutdown_event)
+            started.set()
+        thread = threading.Thread(target=session)
+        thread.start()
+        # The second session waits until the first one is done.
+        self.assertFalse(started.wait(0.1))
+        self.pool.release(TEST_MASTER_IPV4_ADDRINFO, None)
+        self.assertTrue(started.wait(10))
+        thread.join()
+
+        # Other masters are not affected.
+        self.assertIsNone(self.pool.acquire(TEST_MASTER_IPV6_ADDRINFO,
+                                            self.shutdown_event))
+
+        # Waiting sessions stop with xfrin.
+        self.shutdown_event.set()
+        self.assertRaises(XfrinException, self.pool.acquire,
+                          TEST_MASTER_IPV4_ADDRINFO, self.shutdown_event)
+
+        # No limit.
+        self.pool.set_limits(0, 30)
+        self.pool.acquire(TEST_MASTER_IPV4_ADDRINFO, self.shutdown_event)
+
+    def test_idle_timeout(self):
+        sock1, _ = self.__socketpair()
+        sock2, _ = self.__socketpair()
+        self.pool.set_limits(0, 30)
+        self.pool.acquire(TEST_MASTER_IPV4_ADDRINFO, self.shutdown_event)
+        self.pool.acquire(TEST_MASTER_IPV4_ADDRINFO, self.shutdown_event)
+        self.pool.release(TEST_MASTER_IPV4_ADDRINFO, sock1)
+        self.pool.release(TEST_MASTER_IPV4_ADDRINFO, sock2)
+        self.assertEqual(2, self.pool.get_idle_count(TEST_MASTER_IPV4_ADDRINFO))
+
+        # The connections idle for too long are closed, the oldest first.
+        self.pool._idle[TEST_MASTER_IPV4_ADDRINFO][0] = (sock1, time.time() - 31)
+        self.assertEqual(sock2, self.pool.acquire(TEST_MASTER_IPV4_ADDRINFO,
+                                                  self.shutdown_event))
+        self.assertEqual(-1, sock1.fileno())
+
+        # Without a timeout, the connections are closed at once.
+        self.pool.set_limits(0, 0)
+        self.pool.release(TEST_MASTER_IPV4_ADDRINFO, sock2)
+        self.assertEqual(0, self.pool.get_idle_count(TEST_MASTER_IPV4_ADDRINFO))
+        self.assertEqual(-1, sock2.fileno())
+
+    def test_close_all(self):
+        sock, _ = self.__socketpair()
+        self.pool.acquire(TEST_MASTER_IPV6_ADDRINFO, self.shutdown_event)
+        self.pool.release(TEST_MASTER_IPV6_ADDRINFO, sock)
+        self.pool.close_all()
+        self.assertEqual(0, self.pool.get_idle_count(TEST_MASTER_IPV6_ADDRINFO))
+        self.assertEqual(-1, sock.fileno())
+        self.assertEqual(1, self.pool._counters.get('socket', 'ipv6', 'tcp',
+                                                    'close'))
+
 class TestXfrinProcessCloseCheck(unittest.TestCase):
     def setUp(self):
         self.unlocked = False
@@ -3051,6 +3154,23 @@ class TestXfrin(unittest.TestCase):
         self.assertEqual(self.xfr.config_handler(config)['result'][0], 0)
         self._check_zones_config(config)
 
+    def test_config_handler_connection_pool(self):
+        self.assertEqual(DEFAULT_TRANSFERS_PER_MASTER,
+                         self.xfr._connection_pool._max_transfers)
+        self.assertEqual(DEFAULT_CONNECTION_IDLE_TIMEOUT,
+                         self.xfr._connection_pool._idle_timeout)
+        config = { 'transfers_per_master': 5,
+                   'connection_idle_timeout': 0 }
+        self.assertEqual(self.xfr.config_handler(config)['result'][0], 0)
+        self.assertEqual(5, self.xfr._connection_pool._max_transfers)
+        self.assertEqual(0, self.xfr._connection_pool._idle_timeout)
+
+        # Omitted items keep their value.
+        config = { 'transfers_per_master': 1 }
+        self.assertEqual(self.xfr.config_handler(config)['result'][0], 0)
+        self.assertEqual(1, self.xfr._connection_pool._max_transfers)
+        self.assertEqual(0, self.xfr._connection_pool._idle_timeout)
+
     def test_config_handler_use_ixfr(self):
         # use_ixfr was deprecated and explicitly rejected for now.
         config = { 'zones': [
@@ -9,6 +9,18 @@
         "item_optional": false,
         "item_default": 10
       },
+      {
+        "item_name": "transfers_per_master",
+        "item_type": "integer",
+        "item_optional": false,
+        "item_default": 2
+      },
+      {
+        "item_name": "connection_idle_timeout",
+        "item_type": "integer",
+        "item_optional": false,
+        "item_default": 30
+      },
       { "item_name": "zones",
         "item_type": "list",
         "item_optional": false,
@@ -0,0 +1,98 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "zonecompile.h"
+
+#include <cc/data.h>
+#include <dns/rrclass.h>
+#include <exceptions/exceptions.h>
+#include <log/logger_support.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+
+using namespace std;
+using namespace bundy::data;
+using namespace bundy::dns;
+using bundy::zonecompile::compileZones;
+
+namespace {
+const char* const ZONECOMPILE_NAME = "bundy-zonecompile";
+
+void
+usage() {
+    cerr << "Usage: " << ZONECOMPILE_NAME
+         << " [-c class] [-d] -o image_file config_file" << endl;
+    cerr << "\t-c: RR class of the data source (default: IN)" << endl;
+    cerr << "\t-d: enable debug logging" << endl;
+    cerr << "\t-o: file name of the zone table image to build" << endl;
+    cerr << "\tconfig_file: JSON file containing a single data source "
+         << "configuration" << endl;
+    exit(1);
+}
+}
+
+int
+main(int argc, char* argv[]) {
+    string rrclass_txt = "IN";
+    string image_file;
+    bool debug = false;
+    int ch;
+
+    while ((ch = getopt(argc, argv, "c:do:")) != -1) {
+        switch (ch) {
+        case 'c':
+            rrclass_txt = optarg;
+            break;
+        case 'd':
+            debug = true;
+            break;
+        case 'o':
+            image_file = optarg;
+            break;
+        case '?':
+        default:
+            usage();
+        }
+    }
+    if (image_file.empty() || argc - optind != 1) {
+        usage();
+    }
+    const string config_file = argv[optind];
+
+    bundy::log::initLogger(ZONECOMPILE_NAME,
+                           debug ? bundy::log::DEBUG : bundy::log::INFO,
+                           bundy::log::MAX_DEBUG_LEVEL, NULL);
+
+    try {
+        const RRClass rrclass(rrclass_txt);
+        ifstream ifs(config_file.c_str());
+        if (!ifs) {
+            cerr << "Failed to open " << config_file << endl;
+            return (1);
+        }
+        const ConstElementPtr config = Element::fromJSON(ifs, config_file);
+        const size_t zone_count = compileZones(rrclass, config, image_file);
+        cout << zone_count << " zone(s) compiled into " << image_file << endl;
+    } catch (const bundy::Exception& ex) {
+        cerr << ZONECOMPILE_NAME << ": " << ex.what() << endl;
+        return (1);
+    }
+
+    return (0);
+}
@@ -0,0 +1,146 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <zonecompile/zonecompile.h>
+
+#include <datasrc/client_list.h>
+#include <datasrc/exceptions.h>
+#include <datasrc/zone_finder.h>
+#include <dns/name.h>
+#include <dns/rrclass.h>
+#include <cc/data.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace bundy::data;
+using namespace bundy::datasrc;
+using namespace bundy::dns;
+using bundy::zonecompile::compileZones;
+using bundy::zonecompile::ZoneCompileError;
+using std::string;
+
+namespace {
+
+const char* const IMAGE_FILE = TEST_DATA_BUILDDIR "/zonecompile.mapped";
+const char* const TMP_IMAGE_FILE = TEST_DATA_BUILDDIR "/zonecompile.mapped.tmp";
+
+bool
+fileExists(const char* path) {
+    struct stat sb;
+    return (stat(path, &sb) == 0);
+}
+
+class ZoneCompileTest : public ::testing::Test {
+protected:
+    ZoneCompileTest() :
+        config_(Element::fromJSON(
+                    "{\"type\": \"MasterFiles\","
+                    " \"params\": {"
+                    "   \".\": \"" TEST_DATA_DIR "/root.zone\","
+                    "   \"example.org\": \"" TEST_DATA_DIR "/example.org\""
+                    " }}"))
+    {
+        unlink(IMAGE_FILE);
+        unlink(TMP_IMAGE_FILE);
+    }
+    ~ZoneCompileTest() {
+        unlink(IMAGE_FILE);
+        unlink(TMP_IMAGE_FILE);
+    }
+
+    // Configure a client list that uses the image, and check the zones
+    // are available.
+    void checkImage() {
+        ElementPtr config = Element::fromJSON(config_->str());
+        config->set("cache-enable", Element::create(true));
+        config->set("cache-type", Element::create("mapped"));
+        config->set("cache-image", Element::create(IMAGE_FILE));
+        ElementPtr list_config = Element::createList();
+        list_config->add(config);
+
+        ConfigurableClientList list(RRClass::IN());
+        list.configure(list_config, true);
+        ASSERT_EQ(1, list.getStatus().size());
+        EXPECT_EQ(SEGMENT_INUSE, list.getStatus()[0].getSegmentState());
+
+        const ClientList::FindResult result =
+            list.find(Name("www.example.org"));
+        ASSERT_TRUE(result.finder_);
+        EXPECT_EQ(Name("example.org"), result.finder_->getOrigin());
+        EXPECT_TRUE(list.find(Name("."), true).finder_);
+    }
+
+    ElementPtr config_;
+};
+
+TEST_F(ZoneCompileTest, compile) {
+    EXPECT_EQ(2, compileZones(RRClass::IN(), config_, IMAGE_FILE));
+    EXPECT_TRUE(fileExists(IMAGE_FILE));
+    EXPECT_FALSE(fileExists(TMP_IMAGE_FILE));
+    checkImage();
+
+    // An existing image (and a stale temporary file) is replaced.
+    ASSERT_EQ(0, symlink(IMAGE_FILE, TMP_IMAGE_FILE));
+    config_->set("params",
+                 Element::fromJSON("{\"example.org\": \""
+                                   TEST_DATA_DIR "/example.org\"}"));
+    EXPECT_EQ(1, compileZones(RRClass::IN(), config_, IMAGE_FILE));
+    EXPECT_TRUE(fileExists(IMAGE_FILE));
+    EXPECT_FALSE(fileExists(TMP_IMAGE_FILE));
+}
+
+TEST_F(ZoneCompileTest, explicitCacheOptions) {
+    // Cache options that conflict with the image are overridden.
+    config_->set("cache-enable", Element::create(false));
+    config_->set("cache-type", Element::create("local"));
+    config_->set("cache-image", Element::create("/nonexistent"));
+    EXPECT_EQ(2, compileZones(RRClass::IN(), config_, IMAGE_FILE));
+    config_->remove("cache-enable");
+    config_->remove("cache-type");
+    config_->remove("cache-image");
+    checkImage();
+}
+
+TEST_F(ZoneCompileTest, badConfig) {
+    EXPECT_THROW(compileZones(RRClass::IN(), ConstElementPtr(), IMAGE_FILE),
+                 ZoneCompileError);
+    EXPECT_THROW(compileZones(RRClass::IN(), Element::fromJSON("[]"),
+                              IMAGE_FILE),
+                 ZoneCompileError);
+    EXPECT_THROW(compileZones(RRClass::IN(),
+                              Element::fromJSON("{\"params\": {}}"),
+                              IMAGE_FILE),
+                 ZoneCompileError);
+    EXPECT_FALSE(fileExists(IMAGE_FILE));
+}
+
+TEST_F(ZoneCompileTest, loadError) {
+    // If any of the zones fails to load, no image is built.
+    config_->set("params",
+                 Element::fromJSON("{\"example.org\": \""
+                                   TEST_DATA_DIR "/example.org\","
+                                   " \"example.com\": \""
+                                   TEST_DATA_DIR "/nonexistent.zone\"}"));
+    EXPECT_THROW(compileZones(RRClass::IN(), config_, IMAGE_FILE),
+                 bundy::Exception);
+    EXPECT_FALSE(fileExists(IMAGE_FILE));
+    EXPECT_FALSE(fileExists(TMP_IMAGE_FILE));
+}
+
+}
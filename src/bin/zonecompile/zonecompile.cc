@@ -0,0 +1,152 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "zonecompile.h"
+
+#include <datasrc/client_list.h>
+#include <datasrc/memory/zone_table_segment.h>
+#include <datasrc/memory/zone_writer.h>
+#include <datasrc/zone_table_accessor.h>
+
+#include <dns/name.h>
+
+#include <boost/foreach.hpp>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace bundy::data;
+using namespace bundy::datasrc;
+using namespace bundy::dns;
+using bundy::datasrc::memory::ZoneTableSegment;
+using std::string;
+
+namespace bundy {
+namespace zonecompile {
+
+namespace {
+// Make the single-element client list configuration for building the image
+// from the given data source configuration.
+ConstElementPtr
+createListConfig(const ConstElementPtr& datasrc_config) {
+    if (!datasrc_config || datasrc_config->getType() != Element::map) {
+        bundy_throw(ZoneCompileError,
+                    "data source configuration must be a map");
+    }
+    typedef std::map<string, ConstElementPtr> ConfigMap;
+    ElementPtr config = Element::createMap();
+    BOOST_FOREACH(const ConfigMap::value_type& item,
+                  datasrc_config->mapValue()) {
+        config->set(item.first, item.second);
+    }
+    config->set("cache-enable", Element::create(true));
+    config->set("cache-type", Element::create("mapped"));
+    if (config->contains("cache-image")) {
+        config->remove("cache-image");
+    }
+
+    ElementPtr list_config = Element::createList();
+    list_config->add(config);
+    return (list_config);
+}
+
+// A temporary image file.  Any stale file of the name is removed first, and
+// the file is removed on destruction unless it has been released on success.
+class TemporaryFile {
+public:
+    TemporaryFile(const string& filename) : filename_(filename) {
+        unlink(filename_.c_str());
+    }
+    ~TemporaryFile() {
+        if (!filename_.empty()) {
+            unlink(filename_.c_str());
+        }
+    }
+    const string& getName() const { return (filename_); }
+    void release() { filename_.clear(); }
+private:
+    string filename_;
+};
+
+ConstElementPtr
+createSegmentParams(const string& filename) {
+    ElementPtr params = Element::createMap();
+    params->set("mapped-file", filename.empty() ?
+                Element::create() : Element::create(filename));
+    return (params);
+}
+}
+
+size_t
+compileZones(const RRClass& rrclass, const ConstElementPtr& datasrc_config,
+             const string& image_file)
+{
+    ConfigurableClientList list(rrclass);
+    try {
+        list.configure(createListConfig(datasrc_config), true);
+    } catch (const ConfigurableClientList::ConfigurationError& ex) {
+        bundy_throw(ZoneCompileError,
+                    "invalid data source configuration: " << ex.what());
+    }
+    // The data source is silently skipped if its library can't be loaded.
+    const std::vector<DataSourceStatus> statuses = list.getStatus();
+    if (statuses.size() != 1) {
+        bundy_throw(ZoneCompileError, "failed to configure data source");
+    }
+    const string& datasrc_name = statuses[0].getName();
+
+    TemporaryFile tmp_file(image_file + ".tmp");
+    list.resetMemorySegment(datasrc_name, ZoneTableSegment::CREATE,
+                            createSegmentParams(tmp_file.getName()));
+
+    size_t zone_count = 0;
+    const ConstZoneTableAccessorPtr accessor =
+        list.getZoneTableAccessor(datasrc_name, true);
+    for (ZoneTableAccessor::IteratorPtr it = accessor->getIterator();
+         !it->isLast(); it->next()) {
+        const Name origin = it->getCurrent().origin;
+        const ConfigurableClientList::ZoneWriterPair result =
+            list.getCachedZoneWriter(origin, false, datasrc_name);
+        if (result.first != ConfigurableClientList::ZONE_SUCCESS) {
+            bundy_throw(ZoneCompileError, "zone " << origin << "/" <<
+                        rrclass << " not found in data source " <<
+                        datasrc_name);
+        }
+        // Loading errors are propagated as exceptions.
+        result.second->load();
+        result.second->install();
+        result.second->cleanup();
+        ++zone_count;
+    }
+
+    // Close the segment, which stores the checksum, and install the image.
+    list.resetMemorySegment(datasrc_name, ZoneTableSegment::CREATE,
+                            createSegmentParams(""));
+    if (std::rename(tmp_file.getName().c_str(), image_file.c_str()) != 0) {
+        bundy_throw(ZoneCompileError, "failed to rename " <<
+                    tmp_file.getName() << " to " << image_file << ": " <<
+                    std::strerror(errno));
+    }
+    tmp_file.release();
+
+    return (zone_count);
+}
+
+} // namespace zonecompile
+} // namespace bundy
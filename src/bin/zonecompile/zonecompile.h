@@ -0,0 +1,81 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef ZONECOMPILE_H
+#define ZONECOMPILE_H 1
+
+#include <cc/data.h>
+#include <dns/rrclass.h>
+#include <exceptions/exceptions.h>
+
+#include <string>
+
+namespace bundy {
+namespace zonecompile {
+
+/// \brief Exception thrown when a zone table image can't be built.
+class ZoneCompileError : public bundy::Exception {
+public:
+    ZoneCompileError(const char* file, size_t line, const char* what) :
+        bundy::Exception(file, line, what)
+    {}
+};
+
+/// \brief Build a mapped zone table image from a data source.
+///
+/// This function loads all zones of the given data source into a
+/// "mapped" type of zone table segment, stored in \c image_file.  The
+/// resulting file is an image of the in-memory cache of the data source
+/// (including the image version and checksum maintained by
+/// \c ZoneTableSegmentMapped), which can be mapped as is by servers
+/// through the "cache-image" data source option.
+///
+/// \c datasrc_config is a single data source configuration in the same
+/// form as the elements of the data_sources/classes lists, e.g.:
+///
+/// \code {"type": "MasterFiles",
+///        "params": {"example.org": "/var/bundy/example.org.zone"}}
+/// \endcode
+///
+/// The cache is implicitly enabled and its type set to "mapped"; other
+/// cache options such as "cache-zones" and "cache-name-index" are
+/// honored.  All zones must be loaded successfully.
+///
+/// The image is first built in a temporary file (\c image_file with a
+/// ".tmp" suffix), which is renamed to \c image_file on success.  So an
+/// existing image is atomically replaced, and processes that have mapped
+/// it can continue to use the old one.  The temporary file is removed on
+/// failure.
+///
+/// \throw ZoneCompileError The data source can't be configured, a zone
+/// isn't found or the image file can't be installed.
+/// \throw Other Exceptions from the data source library, e.g., on a zone
+/// loading error.
+///
+/// \param rrclass The RR class of the data source.
+/// \param datasrc_config The data source configuration (see above).
+/// \param image_file The file name of the image to be built.
+/// \return The number of zones stored in the image.
+size_t compileZones(const dns::RRClass& rrclass,
+                    const data::ConstElementPtr& datasrc_config,
+                    const std::string& image_file);
+
+} // namespace zonecompile
+} // namespace bundy
+
+#endif // ZONECOMPILE_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -403,12 +403,66 @@ class TestZonemgrRefresh(unittest.TestCase):
                     'zone_soa_rdata': 'a.example.org. root.example.org. 2009073112 7200 3600 2419200 21600',
                     'zone_state': ZONE_REFRESHING}
                 }
-        zone_need_refresh = self.zone_refresh._find_need_do_refresh_zone()
+        zone_need_refresh, due_time = \
+            self.zone_refresh._find_need_do_refresh_zone()
         self.assertEqual(ZONE_NAME_CLASS1_IN, zone_need_refresh)
+        self.assertEqual(time1 + 7200, due_time)
 
-        self.zone_refresh._zonemgr_refresh_info[ZONE_NAME_CLASS2_CH]["refresh_timeout"] = time1
-        zone_need_refresh = self.zone_refresh._find_need_do_refresh_zone()
+        self.zone_refresh._set_zone_refresh_timeout(ZONE_NAME_CLASS2_CH, time1)
+        zone_need_refresh, due_time = \
+            self.zone_refresh._find_need_do_refresh_zone()
         self.assertEqual(ZONE_NAME_CLASS2_CH, zone_need_refresh)
+        self.assertEqual(time1, due_time)
+
+        # A refresh of a zone being refreshed isn't due until its refresh
+        # timeout.
+        self.zone_refresh._set_zone_refresh_timeout(ZONE_NAME_CLASS2_CH,
+                                                    time1 + 8000)
+        self.zone_refresh._set_zone_notify_timer(ZONE_NAME_CLASS2_CH)
+        self.assertEqual((ZONE_NAME_CLASS1_IN, time1 + 7200),
+                         self.zone_refresh._find_need_do_refresh_zone())
+        self.zone_refresh._set_zone_state(ZONE_NAME_CLASS2_CH, ZONE_OK)
+        self.assertEqual(ZONE_NAME_CLASS2_CH,
+                         self.zone_refresh._find_need_do_refresh_zone()[0])
+
+        self.zone_refresh._zonemgr_refresh_info = {}
+        self.assertEqual((None, None),
+                         self.zone_refresh._find_need_do_refresh_zone())
+
+    def test_refresh_queue(self):
+        queue = ZoneRefreshQueue()
+        self.assertEqual(0, len(queue))
+        self.assertEqual((None, None), queue.first())
+        queue.schedule(ZONE_NAME_CLASS1_IN, 30)
+        queue.schedule(ZONE_NAME_CLASS2_CH, 20)
+        queue.schedule(ZONE_NAME_CLASS3_IN, 20)
+        self.assertEqual(3, len(queue))
+        # Same times are in the order of scheduling
+        self.assertEqual((ZONE_NAME_CLASS2_CH, 20), queue.first())
+        # Rescheduled zones are only due at the new time
+        queue.schedule(ZONE_NAME_CLASS2_CH, 40)
+        self.assertEqual((ZONE_NAME_CLASS3_IN, 20), queue.first())
+        queue.schedule(ZONE_NAME_CLASS1_IN, 10)
+        self.assertEqual((ZONE_NAME_CLASS1_IN, 10), queue.first())
+        queue.remove(ZONE_NAME_CLASS1_IN)
+        queue.remove(ZONE_NAME_CLASS3_IN)
+        self.assertEqual((ZONE_NAME_CLASS2_CH, 40), queue.first())
+        self.assertEqual(1, len(queue))
+        # Removing an unknown zone is no-op
+        queue.remove(ZONE_NAME_CLASS3_IN)
+
+        # Many reschedules don't make the heap grow without limit
+        for i in range(10 * ZoneRefreshQueue.COMPACT_MARGIN):
+            queue.schedule(ZONE_NAME_CLASS2_CH, i)
+        self.assertEqual((ZONE_NAME_CLASS2_CH,
+                          10 * ZoneRefreshQueue.COMPACT_MARGIN - 1),
+                         queue.first())
+        self.assertTrue(len(queue._ZoneRefreshQueue__heap) <=
+                        ZoneRefreshQueue.COMPACT_MARGIN + 2)
+
+        queue.clear()
+        self.assertEqual(0, len(queue))
+        self.assertEqual((None, None), queue.first())
 
     def test_do_refresh(self):
         time1 = time.time()
@@ -739,6 +793,36 @@ class TestZonemgr(unittest.TestCase):
                                                 "master": "192.0.2.1"})
         self.assertEqual([b" "], self.zonemgr._master_socket.sent_data)
 
+    def test_command_handler_notify_batch(self):
+        """Check the result of the NOTIFY command for several zones."""
+        self.zonemgr._zone_refresh = MyZonemgrRefresh()
+        notified = []
+        def handle_notify(zone_name_class, master):
+            notified.append((zone_name_class, master))
+            return zone_name_class[0] == "example.org."
+        self.zonemgr._zone_refresh.zone_handle_notify = handle_notify
+        notifies = [{"zone_name": "example.", "zone_class": "IN",
+                     "master": "192.0.2.1"},
+                    {"zone_name": "example.org.", "zone_class": "CH",
+                     "master": "2001:db8::1"}]
+
+        # The thread is woken once if any of the zones needs it.
+        self.zonemgr.command_handler("notify_batch", {"notifies": notifies})
+        self.assertEqual([(("example.", "IN"), "192.0.2.1"),
+                          (("example.org.", "CH"), "2001:db8::1")], notified)
+        self.assertEqual([b" "], self.zonemgr._master_socket.sent_data)
+
+        self.zonemgr.command_handler("notify_batch",
+                                     {"notifies": notifies[:1]})
+        self.assertEqual([b" "], self.zonemgr._master_socket.sent_data)
+
+        # All of them must be valid.
+        notified.clear()
+        self.assertRaises(ZonemgrException, self.zonemgr.command_handler,
+                          "notify_batch",
+                          {"notifies": notifies + [{"zone_name": "example."}]})
+        self.assertEqual([], notified)
+
 if __name__== "__main__":
     bundy.log.resetUnitTestRootLogger()
     unittest.main()
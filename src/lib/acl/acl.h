@@ -17,6 +17,10 @@
 
 #include "check.h"
 #include <vector>
+#include <cassert>
+#include <cstddef>
+
+#include <exceptions/exceptions.h>
 
 #include <boost/shared_ptr.hpp>
 #include <boost/noncopyable.hpp>
@@ -38,6 +42,41 @@ enum BasicAction {
     DROP
 };
 
+/**
+ * \brief Evaluator of a run of consecutive ACL entries.
+ *
+ * An ACL compiler (see \c Loader::Compiler) may replace a run of
+ * consecutive entries whose checks it understands with a single object of
+ * this class, which evaluates all of them at once (e.g., by looking up a
+ * prefix trie instead of trying the IP checks one by one).
+ *
+ * The checks of the replaced entries are kept in the ACL but aren't
+ * called any more, so the matcher must give exactly the same result as
+ * running them in the order.
+ */
+template<typename Context> class EntryMatcher {
+public:
+    /// \brief The value returned by \c match() when nothing matches.
+    static const size_t NO_MATCH = static_cast<size_t>(-1);
+
+    /// \brief Virtual destructor, as we're virtual
+    virtual ~EntryMatcher() {}
+
+    /**
+     * \brief Find the first matching entry of the run.
+     *
+     * \param context The thing that should be checked.
+     * \return The position of the first entry in the run whose check
+     *     matches the context, relative to the beginning of the run, or
+     *     \c NO_MATCH if none of them matches.
+     */
+    virtual size_t match(const Context& context) const = 0;
+};
+
+// Some compilers seem to need this to be explicitly defined outside the class
+template<typename Context>
+const size_t EntryMatcher<Context>::NO_MATCH;
+
 /**
  * \brief The ACL itself.
  *
@@ -95,11 +134,31 @@ public:
      * \return The action for the ACL entry that first matches the context.
      */
     const Action& execute(const Context& context) const {
-        const typename Entries::const_iterator end(entries_.end());
-        for (typename Entries::const_iterator i(entries_.begin()); i != end;
-             ++i) {
-            if (i->first->matches(context)) {
-                return (i->second);
+        if (runs_.empty()) {
+            const typename Entries::const_iterator end(entries_.end());
+            for (typename Entries::const_iterator i(entries_.begin());
+                 i != end; ++i) {
+                if (i->first->matches(context)) {
+                    return (i->second);
+                }
+            }
+            return (default_action_);
+        }
+
+        // Some entries are evaluated in runs by their matchers.
+        typename Runs::const_iterator run(runs_.begin());
+        const size_t count = entries_.size();
+        for (size_t i = 0; i < count; ++i) {
+            if (run != runs_.end() && run->begin == i) {
+                const size_t pos = run->matcher->match(context);
+                if (pos != EntryMatcher<Context>::NO_MATCH) {
+                    assert(i + pos < run->end);
+                    return (entries_[i + pos].second);
+                }
+                i = run->end - 1;
+                ++run;
+            } else if (entries_[i].first->matches(context)) {
+                return (entries_[i].second);
             }
         }
         return (default_action_);
@@ -118,14 +177,77 @@ public:
     void append(ConstCheckPtr check, const Action& action) {
         entries_.push_back(Entry(check, action));
     }
+
+    /// \brief Pointer to an entry matcher.
+    typedef boost::shared_ptr<const EntryMatcher<Context> >
+    ConstEntryMatcherPtr;
+
+    /// \brief Return the number of entries.
+    size_t getEntryCount() const {
+        return (entries_.size());
+    }
+
+    /**
+     * \brief Return the check of an entry.
+     *
+     * This is mainly for ACL compilers to examine the entries.
+     *
+     * \throw OutOfRange The position is not smaller than the number of
+     *     entries.
+     */
+    const ConstCheckPtr& getCheck(size_t pos) const {
+        if (pos >= entries_.size()) {
+            bundy_throw(bundy::OutOfRange, "ACL entry position out of range: "
+                        << pos);
+        }
+        return (entries_[pos].first);
+    }
+
+    /**
+     * \brief Evaluate a run of entries with a matcher.
+     *
+     * From this point, the entries in the range of [\c begin, \c end) are
+     * evaluated by calling \c matcher instead of their checks.  The runs
+     * must be set in the order of the positions and must not overlap.
+     * Note that appending more entries after this is still possible; they
+     * are evaluated one by one.
+     *
+     * \throw BadValue The range is empty, out of range or overlaps with
+     *     the previous one, or the matcher is NULL.
+     *
+     * \param begin The position of the first entry of the run.
+     * \param end The position after the last entry of the run.
+     * \param matcher The matcher that evaluates the run.
+     */
+    void setMatcher(size_t begin, size_t end, ConstEntryMatcherPtr matcher) {
+        if (!matcher || begin >= end || end > entries_.size() ||
+            (!runs_.empty() && runs_.back().end > begin)) {
+            bundy_throw(bundy::BadValue, "Invalid ACL entry matcher range: "
+                        << begin << "-" << end);
+        }
+        runs_.push_back(Run(begin, end, matcher));
+    }
 private:
     // Just type abbreviations.
     typedef std::pair<ConstCheckPtr, Action> Entry;
     typedef std::vector<Entry> Entries;
+    /// \brief A run of entries evaluated by a matcher.
+    struct Run {
+        Run(size_t begin_param, size_t end_param,
+            ConstEntryMatcherPtr matcher_param) :
+            begin(begin_param), end(end_param), matcher(matcher_param)
+        {}
+        size_t begin;
+        size_t end;
+        ConstEntryMatcherPtr matcher;
+    };
+    typedef std::vector<Run> Runs;
     /// \brief The default action, when nothing mathes.
     const Action default_action_;
     /// \brief The entries we have.
     Entries entries_;
+    /// \brief The runs of entries evaluated by matchers, in the order.
+    Runs runs_;
 protected:
     /**
      * \brief Get the default action.
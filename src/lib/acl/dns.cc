@@ -28,6 +28,7 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/scoped_ptr.hpp>
 
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -105,6 +106,134 @@ internal::RequestCheckCreator::create(const string& name,
     }
 }
 
+namespace {
+// Collect the simple checks of type CheckType that the given check consists
+// of: either the check itself or the subexpressions of an ANY operator
+// (which is also created for the list-abbreviated form).  Returns false if
+// the check is anything else.
+template <typename CheckType>
+bool
+getSimpleChecks(const RequestCheck& check,
+                vector<const CheckType*>* checks = NULL)
+{
+    const CheckType* const simple = dynamic_cast<const CheckType*>(&check);
+    if (simple != NULL) {
+        if (checks != NULL) {
+            checks->push_back(simple);
+        }
+        return (true);
+    }
+    const LogicOperator<AnyOfSpec, RequestContext>* const any =
+        dynamic_cast<const LogicOperator<AnyOfSpec, RequestContext>*>(&check);
+    if (any == NULL) {
+        return (false);
+    }
+    const CompoundCheck::Checks subexprs(any->getSubexpressions());
+    for (CompoundCheck::Checks::const_iterator it = subexprs.begin();
+         it != subexprs.end(); ++it) {
+        const CheckType* const sub = dynamic_cast<const CheckType*>(*it);
+        if (sub == NULL) {
+            return (false);
+        }
+        if (checks != NULL) {
+            checks->push_back(sub);
+        }
+    }
+    return (true);
+}
+
+enum CheckKind {
+    OTHER_CHECK,
+    IP_CHECK,
+    KEY_CHECK
+};
+
+CheckKind
+getCheckKind(const RequestCheck& check) {
+    if (getSimpleChecks<internal::RequestIPCheck>(check)) {
+        return (IP_CHECK);
+    } else if (getSimpleChecks<internal::RequestKeyCheck>(check)) {
+        return (KEY_CHECK);
+    }
+    return (OTHER_CHECK);
+}
+
+// Matcher of a run of "from" entries.
+class IPEntryMatcher : public EntryMatcher<RequestContext> {
+public:
+    IPEntryMatcher(const RequestACL& acl, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            vector<const internal::RequestIPCheck*> checks;
+            getSimpleChecks(*acl.getCheck(i), &checks);
+            for (size_t j = 0; j < checks.size(); ++j) {
+                trie_.add(*checks[j], i - begin);
+            }
+        }
+    }
+    virtual size_t match(const RequestContext& request) const {
+        const size_t pos = trie_.find(request.remote_address);
+        return (pos == IPPrefixTrie::NOT_FOUND ? NO_MATCH : pos);
+    }
+private:
+    IPPrefixTrie trie_;
+};
+
+// Matcher of a run of "key" entries.  NameCheck is an exact (but case
+// insensitive) match, which is what the ordering of Name gives.
+class KeyEntryMatcher : public EntryMatcher<RequestContext> {
+public:
+    KeyEntryMatcher(const RequestACL& acl, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            vector<const internal::RequestKeyCheck*> checks;
+            getSimpleChecks(*acl.getCheck(i), &checks);
+            for (size_t j = 0; j < checks.size(); ++j) {
+                // insert() keeps the first (smallest) position.
+                names_.insert(NameMap::value_type(checks[j]->getName(),
+                                                  i - begin));
+            }
+        }
+    }
+    virtual size_t match(const RequestContext& request) const {
+        if (request.tsig == NULL) {
+            return (NO_MATCH);
+        }
+        const NameMap::const_iterator it =
+            names_.find(request.tsig->getName());
+        return (it == names_.end() ? NO_MATCH : it->second);
+    }
+private:
+    typedef map<Name, size_t> NameMap;
+    NameMap names_;
+};
+}
+
+const size_t internal::RequestACLCompiler::MIN_RUN_LENGTH;
+
+void
+internal::RequestACLCompiler::compile(RequestACL& acl) const {
+    const size_t count = acl.getEntryCount();
+    size_t begin = 0;
+    while (begin < count) {
+        const CheckKind kind = getCheckKind(*acl.getCheck(begin));
+        size_t end = begin + 1;
+        if (kind != OTHER_CHECK) {
+            while (end < count && getCheckKind(*acl.getCheck(end)) == kind) {
+                ++end;
+            }
+        }
+        if (end - begin >= MIN_RUN_LENGTH) {
+            if (kind == IP_CHECK) {
+                acl.setMatcher(begin, end, RequestACL::ConstEntryMatcherPtr(
+                                   new IPEntryMatcher(acl, begin, end)));
+            } else if (kind == KEY_CHECK) {
+                acl.setMatcher(begin, end, RequestACL::ConstEntryMatcherPtr(
+                                   new KeyEntryMatcher(acl, begin, end)));
+            }
+        }
+        begin = end;
+    }
+}
+
 RequestLoader&
 getRequestLoader() {
     // To ensure that the singleton gets destroyed at the end of the
@@ -130,6 +259,9 @@ getRequestLoader() {
         loader_ptr->registerCreator(
             boost::shared_ptr<LogicCreator<AllOfSpec, RequestContext> >(
                 new LogicCreator<AllOfSpec, RequestContext>("ALL")));
+        loader_ptr->setCompiler(
+            boost::shared_ptr<internal::RequestACLCompiler>(
+                new internal::RequestACLCompiler()));
 
         // From this point there shouldn't be any exception thrown
         loader.reset(loader_ptr.release());
@@ -137,6 +137,25 @@ public:
     create(const std::string& name, bundy::data::ConstElementPtr definition,
            const acl::Loader<RequestContext>& loader);
 };
+
+/// \brief Compiler of \c RequestACL.
+///
+/// It finds runs of consecutive entries that only check the remote address
+/// ("from") or only check the TSIG key name ("key"), possibly in the
+/// list-abbreviated form, and replaces each of them with a single lookup:
+/// an \c IPPrefixTrie for addresses and a map for key names.  Other entries
+/// (including compound ones like ALL or NOT) are evaluated as they are.
+/// Since the lookups return the first matching entry of the run, the
+/// first-match semantics of the ACL is kept.
+class RequestACLCompiler : public acl::Loader<RequestContext>::Compiler {
+public:
+    /// \brief The minimum number of entries compiled into a lookup.
+    ///
+    /// For shorter runs, trying the checks one by one is cheap enough.
+    static const size_t MIN_RUN_LENGTH = 4;
+
+    virtual void compile(RequestACL& acl) const;
+};
 } // end of namespace "internal"
 
 } // end of namespace "dns"
@@ -19,6 +19,8 @@
 
 #include <boost/lexical_cast.hpp>
 
+#include <algorithm>
+
 #include <acl/ip_check.h>
 
 using namespace std;
@@ -138,5 +140,81 @@ IPAddress::IPAddress(const struct sockaddr& sa) :
     length(family == AF_INET ?
            sizeof(struct in_addr) : sizeof(struct in6_addr))
 {}
+
+namespace {
+// The roots of the IPv4 and IPv6 trees in IPPrefixTrie::nodes_.
+const uint32_t IPV4_ROOT = 0;
+const uint32_t IPV6_ROOT = 1;
+
+inline unsigned int
+getBit(const uint8_t* address, size_t pos) {
+    return ((address[pos >> 3] >> (7 - (pos & 7))) & 1);
+}
+}
+
+const size_t IPPrefixTrie::NOT_FOUND;
+
+IPPrefixTrie::IPPrefixTrie() : nodes_(2) {}
+
+void
+IPPrefixTrie::add(int family, const uint8_t* address, size_t prefixlen,
+                  size_t id)
+{
+    uint32_t node;
+    size_t maxlen;
+    if (family == AF_INET) {
+        node = IPV4_ROOT;
+        maxlen = 8 * sizeof(struct in_addr);
+    } else if (family == AF_INET6) {
+        node = IPV6_ROOT;
+        maxlen = 8 * sizeof(struct in6_addr);
+    } else {
+        bundy_throw(BadValue, "Unsupported address family for "
+                    "IPPrefixTrie: " << family);
+    }
+    if (prefixlen > maxlen) {
+        bundy_throw(BadValue, "Prefix length " << prefixlen <<
+                    " is too large for address family " << family);
+    }
+
+    for (size_t i = 0; i < prefixlen; ++i) {
+        const unsigned int bit = getBit(address, i);
+        if (nodes_[node].children[bit] == 0) {
+            // Note: push_back may reallocate, so we can't hold a reference
+            // to the current node across it.
+            nodes_.push_back(Node());
+            nodes_[node].children[bit] = nodes_.size() - 1;
+        }
+        node = nodes_[node].children[bit];
+    }
+    nodes_[node].id = std::min(nodes_[node].id, id);
+}
+
+size_t
+IPPrefixTrie::find(const IPAddress& address) const {
+    uint32_t node;
+    if (address.getFamily() == AF_INET) {
+        node = IPV4_ROOT;
+    } else if (address.getFamily() == AF_INET6) {
+        node = IPV6_ROOT;
+    } else {
+        return (NOT_FOUND);
+    }
+
+    // Walk down along the address and take the smallest ID on the path.
+    // As NOT_FOUND is the largest size_t value, nodes with no prefix don't
+    // need special care.
+    const uint8_t* const data = address.getData();
+    const size_t len = 8 * address.getLength();
+    size_t result = nodes_[node].id;
+    for (size_t i = 0; i < len; ++i) {
+        node = nodes_[node].children[getBit(data, i)];
+        if (node == 0) {
+            break;
+        }
+        result = std::min(result, nodes_[node].id);
+    }
+    return (result);
+}
 } // namespace acl
 } // namespace bundy
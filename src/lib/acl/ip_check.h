@@ -400,6 +400,78 @@ private:
     int     family_;              ///< Address family
 };
 
+/// \brief A binary trie of IP address prefixes.
+///
+/// This is a helper for ACL compilers (see \c Loader::Compiler) that
+/// replaces a long list of \c IPCheck objects.  Each prefix is added with
+/// an ID (normally the position of the ACL entry), and \c find() returns
+/// the smallest ID of the prefixes that match a given address.  This gives
+/// the same result as trying the checks in the order of the IDs and taking
+/// the first match, but it takes time proportional to the address length
+/// instead of the number of prefixes.
+///
+/// IPv4 and IPv6 prefixes are held in separate trees; as with \c IPCheck,
+/// an address never matches a prefix of the other family.
+class IPPrefixTrie {
+public:
+    /// \brief The value returned by \c find() if no prefix matches.
+    static const size_t NOT_FOUND = static_cast<size_t>(-1);
+
+    /// \brief Constructor.
+    ///
+    /// It creates an empty trie.
+    ///
+    /// \exception std::bad_alloc Resource allocation fails
+    IPPrefixTrie();
+
+    /// \brief Add a prefix.
+    ///
+    /// If the same prefix has already been added, the smaller ID is kept.
+    ///
+    /// \exception BadValue The address family is not supported or the
+    /// prefix length is too large for it.
+    /// \exception std::bad_alloc Resource allocation fails
+    ///
+    /// \param family The address family, either \c AF_INET or \c AF_INET6.
+    /// \param address The address in network byte order.  Only the bits
+    /// covered by \c prefixlen are examined.
+    /// \param prefixlen The length of the prefix in bits.
+    /// \param id The ID associated with the prefix.
+    void add(int family, const uint8_t* address, size_t prefixlen, size_t id);
+
+    /// \brief Add the prefix of an \c IPCheck.
+    ///
+    /// This is a shortcut of the other version for the parameters of the
+    /// check.
+    template <typename Context>
+    void add(const IPCheck<Context>& check, size_t id) {
+        const std::vector<uint8_t> address = check.getAddress();
+        add(check.getFamily(), &address[0], check.getPrefixlen(), id);
+    }
+
+    /// \brief Find the smallest ID of the prefixes matching an address.
+    ///
+    /// \exception None
+    ///
+    /// \param address The address to be matched.
+    /// \return The smallest ID of the matching prefixes, or \c NOT_FOUND if
+    /// none of them matches.
+    size_t find(const IPAddress& address) const;
+
+    /// \brief Return the number of nodes of the trie, including the roots.
+    ///
+    /// This is mainly for testing purposes.
+    size_t getNodeCount() const { return (nodes_.size()); }
+
+private:
+    struct Node {
+        Node() : id(NOT_FOUND) { children[0] = children[1] = 0; }
+        uint32_t children[2]; // indices in nodes_; 0 means none
+        size_t id;            // the smallest ID of the prefix ending here
+    };
+    std::vector<Node> nodes_;
+};
+
 // Some compilers seem to need this to be explicitly defined outside the class
 template <typename Context>
 const size_t IPCheck<Context>::IPV6_SIZE;
@@ -229,6 +229,43 @@ public:
         }
     };
 
+    /**
+     * \brief Compiler of loaded ACLs.
+     *
+     * If set to the loader, it is called for every ACL created by \c load(),
+     * after all its entries are loaded.  It can examine the checks and
+     * replace runs of consecutive entries with faster equivalents using
+     * \c ACL::setMatcher() (for example, a long list of IP address checks
+     * can be converted into a prefix trie).  This is application specific,
+     * as it needs to know the concrete types of the checks.
+     */
+    class Compiler {
+    public:
+        /** \brief Virtual class needs virtual destructor */
+        virtual ~Compiler() {}
+
+        /**
+         * \brief Compile the ACL.
+         *
+         * The result of \c ACL::execute() must not change with the
+         * compilation for any context.  Exceptions are propagated to the
+         * caller of \c load().
+         *
+         * \param acl The newly loaded ACL.
+         */
+        virtual void compile(ACL<Context, Action>& acl) const = 0;
+    };
+
+    /**
+     * \brief Set the compiler of loaded ACLs.
+     *
+     * \param compiler Shared pointer to the compiler.  It can be NULL,
+     *     in which case ACLs are not compiled (which is the default).
+     */
+    void setCompiler(boost::shared_ptr<const Compiler> compiler) {
+        compiler_ = compiler;
+    }
+
     /**
      * \brief Register another check creator.
      *
@@ -298,7 +335,7 @@ public:
      * \brief Load an ACL.
      *
      * This parses an ACL list, creates the checks and actions of each element
-     * and returns it.
+     * and returns it.  If a compiler is set, it's applied to the ACL.
      *
      * No exceptions from \c loadCheck (therefore from whatever creator is
      * used) and from the actionLoader passed to constructor are caught.
@@ -354,6 +391,9 @@ public:
                                acValue);
             }
         }
+        if (compiler_) {
+            compiler_->compile(*result);
+        }
         return (result);
     }
 
@@ -366,6 +406,7 @@ private:
     Creators creators_;
     const Action default_action_;
     const boost::function1<Action, data::ConstElementPtr> action_loader_;
+    boost::shared_ptr<const Compiler> compiler_;
 
     /**
      * \brief Internal version of loadCheck.
@@ -86,4 +86,72 @@ TEST_F(ACLTest, firstMatch) {
     log_.checkFirst(2);
 }
 
+// A matcher returning a fixed position, logging that it did run.
+class ConstMatcher : public EntryMatcher<Log> {
+public:
+    ConstMatcher(size_t pos, size_t logNum) : pos_(pos), logNum_(logNum) {}
+    virtual size_t match(const Log& log) const {
+        log.run[logNum_] = true;
+        return (pos_);
+    }
+private:
+    const size_t pos_;
+    const size_t logNum_;
+};
+
+/*
+ * Entries replaced by a matcher are evaluated by the matcher, and the
+ * result is the action of the entry it returns.  The checks of the run
+ * are not called.
+ */
+TEST_F(ACLTest, matcher) {
+    acl_.append(getCheck(false), ACCEPT);
+    acl_.append(getCheck(true), ACCEPT);
+    acl_.append(getCheck(true), REJECT);
+    acl_.append(getCheck(true), ACCEPT);
+    EXPECT_EQ(4, acl_.getEntryCount());
+    acl_.setMatcher(1, 3, TestACL::ConstEntryMatcherPtr(
+                        new ConstMatcher(1, 9)));
+    EXPECT_EQ(REJECT, acl_.execute(log_));
+    log_.run[9] = false;
+    log_.checkFirst(1);
+}
+
+/*
+ * The entries after the run are tried if the matcher doesn't match.
+ */
+TEST_F(ACLTest, matcherNoMatch) {
+    acl_.append(getCheck(true), REJECT);
+    acl_.append(getCheck(true), REJECT);
+    acl_.append(getCheck(false), ACCEPT);
+    acl_.append(getCheck(true), ACCEPT);
+    acl_.setMatcher(0, 2, TestACL::ConstEntryMatcherPtr(
+                        new ConstMatcher(EntryMatcher<Log>::NO_MATCH, 9)));
+    EXPECT_EQ(ACCEPT, acl_.execute(log_));
+    EXPECT_TRUE(log_.run[9]);
+    EXPECT_FALSE(log_.run[0]);
+    EXPECT_FALSE(log_.run[1]);
+    EXPECT_TRUE(log_.run[2]);
+    EXPECT_TRUE(log_.run[3]);
+}
+
+TEST_F(ACLTest, badMatcher) {
+    const TestACL::ConstEntryMatcherPtr matcher(new ConstMatcher(0, 9));
+    acl_.append(getCheck(false), ACCEPT);
+    acl_.append(getCheck(false), ACCEPT);
+    acl_.append(getCheck(false), ACCEPT);
+    // Empty or out of range
+    EXPECT_THROW(acl_.setMatcher(1, 1, matcher), bundy::BadValue);
+    EXPECT_THROW(acl_.setMatcher(2, 4, matcher), bundy::BadValue);
+    EXPECT_THROW(acl_.setMatcher(0, 1, TestACL::ConstEntryMatcherPtr()),
+                 bundy::BadValue);
+    // Overlap or out of order
+    acl_.setMatcher(1, 2, matcher);
+    EXPECT_THROW(acl_.setMatcher(1, 3, matcher), bundy::BadValue);
+    EXPECT_THROW(acl_.setMatcher(0, 1, matcher), bundy::BadValue);
+    acl_.setMatcher(2, 3, matcher);
+
+    EXPECT_THROW(acl_.getCheck(3), bundy::OutOfRange);
+}
+
 }
@@ -33,6 +33,7 @@
 #include <acl/loader.h>
 #include <acl/check.h>
 #include <acl/ip_check.h>
+#include <acl/logic_check.h>
 
 #include "sockaddr.h"
 
@@ -280,4 +281,117 @@ TEST(DNSACL, anyLoad) {
         "{\"ANY\": [{\"from\": \"192.0.2.1\"}]}")));
 }
 
+// Compiled ACLs (those loaded by getRequestLoader()) give the same results
+// as the entries evaluated one by one.
+class RequestACLCompilerTest : public ::testing::Test {
+protected:
+    RequestACLCompilerTest() : plain_loader_(REJECT) {
+        plain_loader_.registerCreator(
+            boost::shared_ptr<dns::internal::RequestCheckCreator>(
+                new dns::internal::RequestCheckCreator()));
+        plain_loader_.registerCreator(
+            boost::shared_ptr<NotCreator<dns::RequestContext> >(
+                new NotCreator<dns::RequestContext>("NOT")));
+        plain_loader_.registerCreator(
+            boost::shared_ptr<LogicCreator<AllOfSpec, dns::RequestContext> >(
+                new LogicCreator<AllOfSpec, dns::RequestContext>("ALL")));
+    }
+
+    // Check the given request against both the compiled and plain ACLs.
+    void check(const char* address, const char* key_name,
+               BasicAction expected)
+    {
+        SCOPED_TRACE(string(address) + " " + (key_name ? key_name : "-"));
+        const IPAddress ipaddr(tests::getSockAddr(address));
+        scoped_ptr<TSIGRecord> tsig;
+        if (key_name != NULL) {
+            tsig.reset(new TSIGRecord(Name(key_name),
+                                      any::TSIG(TSIGKey::HMACMD5_NAME(), 0, 0,
+                                                0, NULL, 0, 0, 0, NULL)));
+        }
+        const dns::RequestContext request(ipaddr, tsig.get());
+        EXPECT_EQ(expected, plain_acl_->execute(request));
+        EXPECT_EQ(expected, compiled_acl_->execute(request));
+    }
+
+    void load(const string& description) {
+        compiled_acl_ = getRequestLoader().load(Element::fromJSON(description));
+        plain_acl_ = plain_loader_.load(Element::fromJSON(description));
+    }
+
+    dns::RequestLoader plain_loader_;
+    boost::shared_ptr<dns::RequestACL> compiled_acl_;
+    boost::shared_ptr<dns::RequestACL> plain_acl_;
+};
+
+TEST_F(RequestACLCompilerTest, firstMatch) {
+    load("["
+         // A run of address checks; the more specific ones are not
+         // necessarily earlier.
+         " {\"action\": \"DROP\", \"from\": \"192.0.2.1\"},"
+         " {\"action\": \"ACCEPT\", \"from\": \"192.0.2.0/24\"},"
+         " {\"action\": \"REJECT\", \"from\": [\"10.0.0.0/8\","
+         "                                   \"2001:db8::/32\"]},"
+         " {\"action\": \"ACCEPT\", \"from\": \"2001:db8::1\"},"
+         " {\"action\": \"ACCEPT\", \"from\": \"10.1.0.0/16\"},"
+         // A run of key checks
+         " {\"action\": \"ACCEPT\", \"key\": \"key1.example\"},"
+         " {\"action\": \"DROP\", \"key\": [\"KEY2.example\","
+         "                                \"key1.example\"]},"
+         " {\"action\": \"ACCEPT\", \"key\": \"key2.example\"},"
+         " {\"action\": \"DROP\", \"key\": \"key3.example\"},"
+         // Others are evaluated as they are
+         " {\"action\": \"DROP\", \"from\": \"203.0.113.1\","
+         "  \"key\": \"key4.example\"},"
+         " {\"action\": \"ACCEPT\", \"NOT\": {\"from\": \"203.0.113.1\"}}"
+         "]");
+
+    check("192.0.2.1", NULL, DROP);
+    check("192.0.2.1", "key3.example", DROP);
+    check("192.0.2.2", NULL, ACCEPT);
+    check("10.1.2.3", NULL, REJECT);
+    check("2001:db8::1", NULL, REJECT);
+    check("192.0.3.1", "key1.example", ACCEPT);
+    check("192.0.3.1", "KEY1.EXAMPLE", ACCEPT);
+    check("2001:db9::1", "key2.example", DROP);
+    check("192.0.3.1", "key3.example", DROP);
+    check("203.0.113.1", "key4.example", DROP);
+    check("203.0.113.1", "key5.example", REJECT);
+    check("203.0.113.1", NULL, REJECT);
+    check("192.0.3.1", NULL, ACCEPT);
+}
+
+// A matcher that never matches.
+class NullMatcher : public EntryMatcher<dns::RequestContext> {
+public:
+    virtual size_t match(const dns::RequestContext&) const {
+        return (NO_MATCH);
+    }
+};
+
+// Runs are compiled only if they are long enough.  We check it by trying
+// to set another matcher, which fails if the range is already compiled.
+TEST_F(RequestACLCompilerTest, compile) {
+    const size_t len = dns::internal::RequestACLCompiler::MIN_RUN_LENGTH;
+    const dns::internal::RequestACLCompiler compiler;
+    dns::internal::RequestCheckCreator creator;
+    const dns::RequestACL::ConstEntryMatcherPtr matcher(new NullMatcher);
+
+    dns::RequestACL acl1(REJECT);
+    for (size_t i = 0; i < len - 1; ++i) {
+        acl1.append(creator.create("from", Element::fromJSON("\"192.0.2.1\""),
+                                   getRequestLoader()), ACCEPT);
+    }
+    compiler.compile(acl1);
+    EXPECT_NO_THROW(acl1.setMatcher(0, len - 1, matcher));
+
+    dns::RequestACL acl2(REJECT);
+    for (size_t i = 0; i < len; ++i) {
+        acl2.append(creator.create("key", Element::fromJSON("\"key.example\""),
+                                   getRequestLoader()), ACCEPT);
+    }
+    compiler.compile(acl2);
+    EXPECT_THROW(acl2.setMatcher(0, len, matcher), bundy::BadValue);
+}
+
 }
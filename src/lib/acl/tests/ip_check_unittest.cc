@@ -614,4 +614,72 @@ TEST(IPCheck, MixedMode) {
     GeneralAddress test6(vector<uint8_t>(V6ADDR_1, V6ADDR_1 + IPV6_SIZE));
     EXPECT_FALSE(acl6.matches(test6));
 }
+
+// Add the prefix of the given IPCheck string to the trie.
+void
+addPrefix(IPPrefixTrie& trie, const char* prefix, size_t id) {
+    trie.add(IPCheck<GeneralAddress>(prefix), id);
+}
+
+// Find the given address in the trie.  Note that getSockAddr() uses a
+// static storage, so the IPAddress is used immediately.
+size_t
+findAddress(const IPPrefixTrie& trie, const char* address) {
+    return (trie.find(IPAddress(tests::getSockAddr(address))));
+}
+
+TEST(IPPrefixTrie, empty) {
+    IPPrefixTrie trie;
+    EXPECT_EQ(2, trie.getNodeCount()); // only the roots
+    EXPECT_EQ(IPPrefixTrie::NOT_FOUND, findAddress(trie, "192.0.2.1"));
+    EXPECT_EQ(IPPrefixTrie::NOT_FOUND, findAddress(trie, "2001:db8::1"));
+}
+
+// The smallest ID of the matching prefixes is returned, which is not
+// necessarily the longest one.
+TEST(IPPrefixTrie, find) {
+    IPPrefixTrie trie;
+    addPrefix(trie, "192.0.2.1", 3);
+    addPrefix(trie, "192.0.2.0/24", 1);
+    addPrefix(trie, "192.0.2.128/25", 0);
+    addPrefix(trie, "10.0.0.0/8", 2);
+    addPrefix(trie, "2001:db8::/32", 4);
+    addPrefix(trie, "2001:db8::1", 5);
+
+    EXPECT_EQ(1, findAddress(trie, "192.0.2.1"));
+    EXPECT_EQ(0, findAddress(trie, "192.0.2.200"));
+    EXPECT_EQ(2, findAddress(trie, "10.1.2.3"));
+    EXPECT_EQ(IPPrefixTrie::NOT_FOUND, findAddress(trie, "192.0.3.1"));
+    EXPECT_EQ(4, findAddress(trie, "2001:db8::1"));
+    EXPECT_EQ(IPPrefixTrie::NOT_FOUND, findAddress(trie, "2001:db9::1"));
+
+    // The same prefix keeps the smaller ID.
+    addPrefix(trie, "2001:db8::1", 6);
+    addPrefix(trie, "2001:db8::/32", 7);
+    EXPECT_EQ(4, findAddress(trie, "2001:db8::1"));
+
+    // A zero-length prefix matches everything of the family.
+    addPrefix(trie, "any6", 3);
+    EXPECT_EQ(3, findAddress(trie, "2001:db8::1"));
+    EXPECT_EQ(3, findAddress(trie, "::1"));
+    EXPECT_EQ(IPPrefixTrie::NOT_FOUND, findAddress(trie, "192.0.3.1"));
+}
+
+// IPv4 and IPv6 prefixes are separate, even if the bits are the same.
+TEST(IPPrefixTrie, family) {
+    IPPrefixTrie trie;
+    addPrefix(trie, "32.1.13.184", 0);
+    EXPECT_EQ(IPPrefixTrie::NOT_FOUND, findAddress(trie, "2001:db8::1"));
+    addPrefix(trie, "c000:0201::/32", 1);
+    EXPECT_EQ(IPPrefixTrie::NOT_FOUND, findAddress(trie, "192.0.2.1"));
+}
+
+TEST(IPPrefixTrie, badAdd) {
+    IPPrefixTrie trie;
+    const uint8_t address[16] = { 0 };
+    EXPECT_THROW(trie.add(AF_UNIX, address, 0, 0), bundy::BadValue);
+    EXPECT_THROW(trie.add(AF_INET, address, 33, 0), bundy::BadValue);
+    EXPECT_THROW(trie.add(AF_INET6, address, 129, 0), bundy::BadValue);
+    EXPECT_NO_THROW(trie.add(AF_INET6, address, 128, 0));
+}
 } // Unnamed namespace
@@ -316,6 +316,36 @@ TEST_F(LoaderTest, CheckNoAction) {
     EXPECT_TRUE(check->data_->equals(*Element::fromJSON("1")));
 }
 
+// A compiler that records the ACL it was given.
+class TestCompiler : public Loader<Log>::Compiler {
+public:
+    TestCompiler() : acl_(NULL), entries_(0) {}
+    virtual void compile(ACL<Log>& acl) const {
+        acl_ = &acl;
+        entries_ = acl.getEntryCount();
+    }
+    mutable const ACL<Log>* acl_;
+    mutable size_t entries_;
+};
+
+// The compiler is called for loaded ACLs once they are fully loaded.
+TEST_F(LoaderTest, compiler) {
+    aclSetup();
+    boost::shared_ptr<TestCompiler> compiler(new TestCompiler);
+    loader_.setCompiler(compiler);
+    boost::shared_ptr<ACL<Log> > acl(loader_.load(Element::fromJSON(
+        "[{\"logcheck\": [0, false], \"action\": \"DROP\"},"
+        " {\"action\": \"ACCEPT\"}]")));
+    EXPECT_EQ(acl.get(), compiler->acl_);
+    EXPECT_EQ(2, compiler->entries_);
+
+    // It can be unset.
+    compiler->acl_ = NULL;
+    loader_.setCompiler(boost::shared_ptr<TestCompiler>());
+    loader_.load(Element::fromJSON("[]"));
+    EXPECT_EQ(static_cast<const ACL<Log>*>(NULL), compiler->acl_);
+}
+
 // The empty ACL can be created and run, providing the default action
 TEST_F(LoaderTest, EmptyACL) {
     aclRun("[]", REJECT, 0);
@@ -111,6 +111,41 @@ public:
     /// \param timeout The timeout in milliseconds
     virtual void setTCPRecvTimeout(size_t) {}
 
+    /// \brief Set the maximum number of UDP datagrams handled at once
+    ///
+    /// Like \c setTCPRecvTimeout(), this is only relevant for some types
+    /// of DNSServer (currently \c SyncUDPServer), and has a no-op default
+    /// implementation.
+    ///
+    /// \param batch_size The maximum number of datagrams per batch
+    virtual void setUDPBatchSize(size_t) {}
+
+    /// \brief Set the maximum number of queries in flight per TCP
+    /// connection
+    ///
+    /// Like \c setTCPRecvTimeout(), this is only relevant for some types
+    /// of DNSServer (\c TCPServer), and has a no-op default implementation.
+    ///
+    /// \param max_in_flight The maximum number of queries in flight
+    virtual void setTCPMaxInFlight(size_t) {}
+
+    /// \brief Set the processing time that makes the server overloaded
+    ///
+    /// Like \c setUDPBatchSize(), this is only relevant for some types
+    /// of DNSServer (currently \c SyncUDPServer), and has a no-op default
+    /// implementation.
+    ///
+    /// \param latency The threshold in microseconds (0 disables overload
+    ///        detection)
+    virtual void setUDPOverloadLatency(size_t) {}
+
+    /// \brief Return true if the server is overloaded
+    ///
+    /// The lookup callback can use this to shed load, e.g., by dropping
+    /// queries it would otherwise answer at some cost.  Servers that don't
+    /// detect overload (the default implementation) always return false.
+    virtual bool isOverloaded() const { return (false); }
+
 protected:
     /// \brief Lookup handler object.
     ///
@@ -35,12 +35,15 @@ namespace asiodns {
 class DNSLookup;
 class DNSAnswer;
 
+const size_t DNSServiceBase::MAX_UDP_BATCH_SIZE;
+
 class DNSServiceImpl {
 public:
     DNSServiceImpl(IOService& io_service,
                    DNSLookup* lookup, DNSAnswer* answer) :
             io_service_(io_service), lookup_(lookup),
-            answer_(answer), tcp_recv_timeout_(5000)
+            answer_(answer), tcp_recv_timeout_(5000), udp_batch_size_(1),
+            tcp_max_in_flight_(16), udp_overload_latency_(0)
     {}
 
     IOService& io_service_;
@@ -53,6 +56,9 @@ public:
     DNSLookup* lookup_;
     DNSAnswer* answer_;
     size_t tcp_recv_timeout_;
+    size_t udp_batch_size_;
+    size_t tcp_max_in_flight_;
+    size_t udp_overload_latency_;
 
     template<class Ptr, class Server> void addServerFromFD(int fd, int af) {
         Ptr server(new Server(io_service_.get_io_service(), fd, af,
@@ -79,9 +85,42 @@ public:
         }
     }
 
+    void setUDPBatchSize(size_t batch_size) {
+        if (batch_size == 0 ||
+            batch_size > DNSServiceBase::MAX_UDP_BATCH_SIZE) {
+            bundy_throw(bundy::InvalidParameter, "Invalid UDP batch size: "
+                        << batch_size);
+        }
+        udp_batch_size_ = batch_size;
+        BOOST_FOREACH(const DNSServerPtr& server, servers_) {
+            server->setUDPBatchSize(batch_size);
+        }
+    }
+
+    void setTCPMaxInFlight(size_t max_in_flight) {
+        if (max_in_flight == 0) {
+            bundy_throw(bundy::InvalidParameter, "Invalid number of TCP "
+                        "queries in flight: " << max_in_flight);
+        }
+        tcp_max_in_flight_ = max_in_flight;
+        BOOST_FOREACH(const DNSServerPtr& server, servers_) {
+            server->setTCPMaxInFlight(max_in_flight);
+        }
+    }
+
+    void setUDPOverloadLatency(size_t latency) {
+        udp_overload_latency_ = latency;
+        BOOST_FOREACH(const DNSServerPtr& server, servers_) {
+            server->setUDPOverloadLatency(latency);
+        }
+    }
+
 private:
     void startServer(DNSServerPtr server) {
         server->setTCPRecvTimeout(tcp_recv_timeout_);
+        server->setUDPBatchSize(udp_batch_size_);
+        server->setTCPMaxInFlight(tcp_max_in_flight_);
+        server->setUDPOverloadLatency(udp_overload_latency_);
         (*server)();
         servers_.push_back(server);
     }
@@ -128,5 +167,20 @@ DNSService::setTCPRecvTimeout(size_t timeout) {
     impl_->setTCPRecvTimeout(timeout);
 }
 
+void
+DNSService::setUDPBatchSize(size_t batch_size) {
+    impl_->setUDPBatchSize(batch_size);
+}
+
+void
+DNSService::setTCPMaxInFlight(size_t max_in_flight) {
+    impl_->setTCPMaxInFlight(max_in_flight);
+}
+
+void
+DNSService::setUDPOverloadLatency(size_t latency) {
+    impl_->setUDPOverloadLatency(latency);
+}
+
 } // namespace asiodns
 } // namespace bundy
@@ -76,6 +76,11 @@ public:
     };
 
 public:
+    /// \brief The maximum value accepted by \c setUDPBatchSize().
+    ///
+    /// This is the limit of a single \c recvmmsg(2) call on Linux.
+    static const size_t MAX_UDP_BATCH_SIZE = 1024;
+
     /// \brief The destructor.
     virtual ~DNSServiceBase() {}
 
@@ -99,6 +104,48 @@ public:
     /// \param timeout The timeout in milliseconds
     virtual void setTCPRecvTimeout(size_t timeout) = 0;
 
+    /// \brief Set the maximum number of datagrams a UDP server handles
+    /// at once
+    ///
+    /// For UDP servers that support batched I/O (i.e. those added with
+    /// the \c SERVER_SYNC_OK flag on systems that have \c recvmmsg(2) and
+    /// \c sendmmsg(2)), up to this number of datagrams are received and
+    /// answered in a single system call each.  The value 1 means no
+    /// batching.
+    ///
+    /// Like the TCP timeout, the value is applied to existing servers and
+    /// kept for servers created later.
+    ///
+    /// \param batch_size The maximum number of datagrams per batch
+    virtual void setUDPBatchSize(size_t batch_size) = 0;
+
+    /// \brief Set the maximum number of queries in flight per TCP
+    /// connection
+    ///
+    /// TCP servers keep reading queries from a connection while earlier
+    /// ones are being looked up, up to this number.  The value 1 means
+    /// queries on a connection are handled one by one.
+    ///
+    /// Like the TCP timeout, the value is applied to existing servers and
+    /// kept for servers created later.
+    ///
+    /// \param max_in_flight The maximum number of queries in flight
+    virtual void setTCPMaxInFlight(size_t max_in_flight) = 0;
+
+    /// \brief Set the overload detection threshold of UDP servers
+    ///
+    /// A UDP server that supports it (\c SyncUDPServer) considers itself
+    /// overloaded while handling received datagrams takes at least this
+    /// time and more datagrams keep waiting on the socket; the lookup
+    /// callback can then shed load (see \c DNSServer::isOverloaded()).
+    ///
+    /// Like the TCP timeout, the value is applied to existing servers and
+    /// kept for servers created later.
+    ///
+    /// \param latency The threshold in microseconds; 0 disables overload
+    ///        detection
+    virtual void setUDPOverloadLatency(size_t latency) = 0;
+
     virtual asiolink::IOService& getIOService() = 0;
 };
 
@@ -201,6 +248,25 @@ public:
     virtual asiolink::IOService& getIOService() { return (io_service_);}
 
     virtual void setTCPRecvTimeout(size_t timeout);
+
+    /// \brief Set the maximum number of datagrams a UDP server handles
+    /// at once
+    ///
+    /// \throw bundy::InvalidParameter batch_size is 0 or too large (see
+    ///     \c MAX_UDP_BATCH_SIZE)
+    virtual void setUDPBatchSize(size_t batch_size);
+
+    /// \brief Set the maximum number of queries in flight per TCP
+    /// connection
+    ///
+    /// \throw bundy::InvalidParameter max_in_flight is 0
+    virtual void setTCPMaxInFlight(size_t max_in_flight);
+
+    /// \brief Set the overload detection threshold of UDP servers
+    ///
+    /// \throw None
+    virtual void setUDPOverloadLatency(size_t latency);
+
 private:
     DNSServiceImpl* impl_;
     asiolink::IOService& io_service_;
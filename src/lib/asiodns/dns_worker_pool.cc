@@ -0,0 +1,262 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <asiodns/dns_worker_pool.h>
+#include <asiodns/dns_lookup.h>
+#include <asiodns/logger.h>
+
+#include <asiolink/io_error.h>
+#include <asiolink/io_service.h>
+
+#include <util/threads/affinity.h>
+#include <util/threads/thread.h>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+
+using namespace bundy::asiolink;
+using bundy::util::thread::Thread;
+using bundy::util::thread::setCurrentThreadAffinity;
+
+namespace bundy {
+namespace asiodns {
+
+// A single worker thread with its own event loop, DNS service and lookup
+// callback.
+class DNSWorkerPool::Worker : boost::noncopyable {
+public:
+    Worker(DNSLookup* lookup, DNSAnswer* answer, size_t udp_batch_size,
+           size_t udp_overload_latency) :
+        lookup_(lookup), service_(io_service_, lookup, answer)
+    {
+        service_.setUDPBatchSize(udp_batch_size);
+        service_.setUDPOverloadLatency(udp_overload_latency);
+    }
+
+    ~Worker() {
+        stop();
+    }
+
+    // Add a UDP server on a duplicate of the given descriptor.  The
+    // duplicate will be owned (and closed) by the created server.
+    void addServerUDPFromFD(int fd, int af, ServerFlag options) {
+        const int new_fd = dup(fd);
+        if (new_fd < 0) {
+            bundy_throw(IOError, "failed to duplicate socket " << fd <<
+                        " for a DNS worker: " << std::strerror(errno));
+        }
+        try {
+            service_.addServerUDPFromFD(new_fd, af, options);
+        } catch (...) {
+            close(new_fd);
+            throw;
+        }
+    }
+
+    // Start the thread, bound to the given CPU unless it's negative.
+    void start(int cpu) {
+        thread_.reset(new Thread(boost::bind(&Worker::run, this, cpu)));
+    }
+
+    // Stop the event loop, wait for the thread and close all servers.
+    // The servers must be cleared in this (the controlling) thread only after
+    // the worker thread terminates, as ASIO sockets are not thread safe.
+    void stop() {
+        if (thread_) {
+            io_service_.stop();
+            try {
+                thread_->wait();
+            } catch (const std::exception& ex) {
+                LOG_ERROR(logger, ASIODNS_WORKER_FAIL).arg(ex.what());
+            }
+            thread_.reset();
+        }
+        service_.clearServers();
+    }
+
+private:
+    void run(int cpu) {
+        if (cpu >= 0) {
+            try {
+                setCurrentThreadAffinity(std::vector<int>(1, cpu));
+            } catch (const std::exception& ex) {
+                LOG_WARN(logger, ASIODNS_WORKER_AFFINITY_FAIL).arg(cpu).
+                    arg(ex.what());
+            }
+        }
+        io_service_.run();
+    }
+
+    IOService io_service_;
+    // This must be placed before service_ so it will be destroyed after it.
+    boost::scoped_ptr<DNSLookup> lookup_;
+    DNSService service_;
+    boost::scoped_ptr<Thread> thread_;
+};
+
+DNSWorkerPool::DNSWorkerPool(DNSServiceBase& main_service,
+                             const LookupFactory& lookup_factory,
+                             DNSAnswer* answer) :
+    main_service_(main_service), lookup_factory_(lookup_factory),
+    answer_(answer), worker_count_(0), udp_batch_size_(1),
+    udp_overload_latency_(0)
+{}
+
+DNSWorkerPool::~DNSWorkerPool() {
+    stop();
+}
+
+void
+DNSWorkerPool::setWorkerCount(size_t count) {
+    if (count == worker_count_) {
+        return;
+    }
+    const bool running = isRunning();
+    stop();
+    worker_count_ = count;
+    if (running) {
+        start();
+    }
+}
+
+void
+DNSWorkerPool::setWorkerCPUs(const std::vector<int>& cpus) {
+    BOOST_FOREACH(int cpu, cpus) {
+        if (cpu < 0) {
+            bundy_throw(InvalidParameter, "Invalid worker CPU: " << cpu);
+        }
+    }
+    if (cpus == worker_cpus_) {
+        return;
+    }
+    const bool running = isRunning();
+    stop();
+    worker_cpus_ = cpus;
+    if (running) {
+        start();
+    }
+}
+
+void
+DNSWorkerPool::start() {
+    if (isRunning() || udp_servers_.empty()) {
+        return;
+    }
+
+    std::vector<WorkerPtr> workers;
+    for (size_t i = 0; i < worker_count_; ++i) {
+        WorkerPtr worker(new Worker(lookup_factory_(), answer_,
+                                     udp_batch_size_, udp_overload_latency_));
+        BOOST_FOREACH(const UDPServerParams& params, udp_servers_) {
+            worker->addServerUDPFromFD(params.fd, params.af, params.options);
+        }
+        workers.push_back(worker);
+    }
+    // Start the threads only after all servers have been successfully set
+    // up, so a failure above won't leave a partially running pool.
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i]->start(worker_cpus_.empty() ? -1 :
+                          worker_cpus_[i % worker_cpus_.size()]);
+    }
+    workers_.swap(workers);
+    if (worker_count_ > 0) {
+        LOG_DEBUG(logger, DBGLVL_TRACE_BASIC, ASIODNS_WORKERS_STARTED).
+            arg(worker_count_).arg(udp_servers_.size());
+    }
+}
+
+void
+DNSWorkerPool::stop() {
+    // Destroying the workers stops them and closes their sockets.
+    workers_.clear();
+}
+
+void
+DNSWorkerPool::addServerTCPFromFD(int fd, int af) {
+    main_service_.addServerTCPFromFD(fd, af);
+}
+
+void
+DNSWorkerPool::addServerUDPFromFD(int fd, int af, ServerFlag options) {
+    stop();
+    main_service_.addServerUDPFromFD(fd, af, options);
+    const UDPServerParams params = { fd, af, options };
+    udp_servers_.push_back(params);
+}
+
+void
+DNSWorkerPool::clearServers() {
+    stop();
+    udp_servers_.clear();
+    main_service_.clearServers();
+}
+
+void
+DNSWorkerPool::setTCPRecvTimeout(size_t timeout) {
+    main_service_.setTCPRecvTimeout(timeout);
+}
+
+void
+DNSWorkerPool::setTCPMaxInFlight(size_t max_in_flight) {
+    main_service_.setTCPMaxInFlight(max_in_flight);
+}
+
+void
+DNSWorkerPool::setUDPBatchSize(size_t batch_size) {
+    // Check it beforehand, so an invalid value won't stop the workers.
+    if (batch_size == 0 || batch_size > MAX_UDP_BATCH_SIZE) {
+        bundy_throw(InvalidParameter, "Invalid UDP batch size: " <<
+                    batch_size);
+    }
+    main_service_.setUDPBatchSize(batch_size);
+    if (batch_size == udp_batch_size_) {
+        return;
+    }
+    const bool running = isRunning();
+    stop();
+    udp_batch_size_ = batch_size;
+    if (running) {
+        start();
+    }
+}
+
+void
+DNSWorkerPool::setUDPOverloadLatency(size_t latency) {
+    main_service_.setUDPOverloadLatency(latency);
+    if (latency == udp_overload_latency_) {
+        return;
+    }
+    const bool running = isRunning();
+    stop();
+    udp_overload_latency_ = latency;
+    if (running) {
+        start();
+    }
+}
+
+IOService&
+DNSWorkerPool::getIOService() {
+    return (main_service_.getIOService());
+}
+
+} // namespace asiodns
+} // namespace bundy
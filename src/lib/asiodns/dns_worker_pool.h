@@ -0,0 +1,201 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef ASIODNS_DNS_WORKER_POOL_H
+#define ASIODNS_DNS_WORKER_POOL_H 1
+
+#include <asiodns/dns_service.h>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
+
+namespace bundy {
+namespace asiodns {
+
+class DNSLookup;
+class DNSAnswer;
+
+/// \brief A \c DNSServiceBase that spreads UDP servers over worker threads.
+///
+/// This class wraps a "main" \c DNSServiceBase object (normally the
+/// \c DNSService running on the application's main event loop) and adds
+/// a configurable number of worker threads.  Each worker thread runs its
+/// own \c IOService and \c DNSService, with its own \c DNSLookup object
+/// created by the factory passed on construction.  Every UDP socket
+/// added through \c addServerUDPFromFD() is given to the main service as
+/// before, and additionally each worker gets a duplicate descriptor of
+/// the same socket, so the kernel distributes the incoming datagrams
+/// among all threads waiting on it.  TCP servers are only added to the
+/// main service.
+///
+/// Since each worker has its own servers (and therefore their own query
+/// \c Message and output buffer) and its own \c DNSLookup, the lookup
+/// implementation can keep any per-query resources (such as a
+/// \c MessageRenderer) in the lookup object without locking; it's the
+/// responsibility of the lookup implementation, however, to make sure
+/// anything shared with other threads is safe to be used concurrently.
+///
+/// Worker threads are not running while the set of servers is being
+/// changed: \c clearServers() and \c addServerUDPFromFD() stop the
+/// workers, and they are restarted on the next call to \c start().
+/// The typical usage is thus:
+/// \code pool.clearServers();
+/// pool.addServerUDPFromFD(...); // repeat as necessary
+/// pool.start(); \endcode
+///
+/// With the worker count of 0 (the default) this class simply behaves
+/// as a transparent wrapper of the main service.
+class DNSWorkerPool : public DNSServiceBase, boost::noncopyable {
+public:
+    /// \brief Type of the factory of per-worker \c DNSLookup objects.
+    ///
+    /// The returned object is owned by the pool and destroyed with the
+    /// worker.  It must not be NULL.
+    typedef boost::function<DNSLookup*()> LookupFactory;
+
+    /// \brief Constructor.
+    ///
+    /// \param main_service The \c DNSServiceBase to which all servers are
+    ///        added in the calling thread.  It must be valid throughout
+    ///        the lifetime of this object.
+    /// \param lookup_factory Factory of the per-worker lookup objects.
+    /// \param answer The answer provider for the worker services (can be
+    ///        NULL as it's unused for synchronous UDP servers).
+    DNSWorkerPool(DNSServiceBase& main_service,
+                  const LookupFactory& lookup_factory, DNSAnswer* answer);
+
+    /// \brief Destructor.
+    ///
+    /// Stops and joins all worker threads.
+    virtual ~DNSWorkerPool();
+
+    /// \brief Set the number of worker threads.
+    ///
+    /// If the workers are running, they are restarted with the new count.
+    ///
+    /// \throw bundy::asiolink::IOError failed to duplicate a socket.
+    void setWorkerCount(size_t count);
+
+    /// \brief Return the number of worker threads.
+    size_t getWorkerCount() const { return (worker_count_); }
+
+    /// \brief Set the CPUs the worker threads are bound to.
+    ///
+    /// The i-th worker is bound to the (i mod N)-th CPU of the list, where
+    /// N is its size, so a worker keeps handling its queries on the same
+    /// CPU and its data stays in that CPU's caches.  The list would
+    /// normally name the CPUs handling the interrupts of the network
+    /// interfaces.  If the list is empty (the default), the workers are
+    /// scheduled freely by the system.  A failure to bind a worker is
+    /// logged and the worker runs unbound.
+    ///
+    /// If the workers are running, they are restarted with the new list.
+    ///
+    /// \throw bundy::InvalidParameter a CPU number is negative.
+    /// \throw bundy::asiolink::IOError failed to duplicate a socket.
+    void setWorkerCPUs(const std::vector<int>& cpus);
+
+    /// \brief Return the CPUs the worker threads are bound to.
+    const std::vector<int>& getWorkerCPUs() const { return (worker_cpus_); }
+
+    /// \brief Start the worker threads.
+    ///
+    /// It creates the configured number of workers (if not running yet),
+    /// each with a duplicate of every UDP socket added so far.  It's a
+    /// no-op if the workers are already running or there is no UDP server.
+    ///
+    /// \throw bundy::asiolink::IOError failed to duplicate a socket.
+    void start();
+
+    /// \brief Stop and join the worker threads.
+    ///
+    /// The UDP sockets owned by the workers are closed; the original
+    /// descriptors used by the main service are intact.
+    ///
+    /// \throw None
+    void stop();
+
+    /// \brief Return true if the worker threads are running.
+    bool isRunning() const { return (!workers_.empty()); }
+
+    /// \brief Add a TCP server to the main service only.
+    virtual void addServerTCPFromFD(int fd, int af);
+
+    /// \brief Add a UDP server to the main service and remember it for the
+    /// workers.
+    ///
+    /// Running workers are stopped; call \c start() to restart them.
+    virtual void addServerUDPFromFD(int fd, int af,
+                                    ServerFlag options = SERVER_DEFAULT);
+
+    /// \brief Stop the workers and remove all servers.
+    virtual void clearServers();
+
+    /// \brief Set the TCP timeout of the main service.
+    virtual void setTCPRecvTimeout(size_t timeout);
+
+    /// \brief Set the UDP batch size of the main service and workers.
+    ///
+    /// As the worker services can't be safely updated while they are
+    /// running, running workers are restarted with the new size.
+    ///
+    /// \throw bundy::InvalidParameter batch_size is 0 or too large
+    /// \throw bundy::asiolink::IOError failed to duplicate a socket.
+    virtual void setUDPBatchSize(size_t batch_size);
+
+    /// \brief Set the TCP queries in flight limit of the main service.
+    virtual void setTCPMaxInFlight(size_t max_in_flight);
+
+    /// \brief Set the UDP overload threshold of the main service and
+    /// workers.
+    ///
+    /// Like the batch size, running workers are restarted with the new
+    /// value.
+    ///
+    /// \throw bundy::asiolink::IOError failed to duplicate a socket.
+    virtual void setUDPOverloadLatency(size_t latency);
+
+    /// \brief Return the \c IOService of the main service.
+    virtual asiolink::IOService& getIOService();
+
+private:
+    class Worker;
+    typedef boost::shared_ptr<Worker> WorkerPtr;
+    struct UDPServerParams {
+        int fd;
+        int af;
+        ServerFlag options;
+    };
+
+    DNSServiceBase& main_service_;
+    const LookupFactory lookup_factory_;
+    DNSAnswer* const answer_;
+    size_t worker_count_;
+    size_t udp_batch_size_;
+    size_t udp_overload_latency_;
+    std::vector<int> worker_cpus_;
+    std::vector<UDPServerParams> udp_servers_;
+    std::vector<WorkerPtr> workers_;
+};
+
+} // namespace asiodns
+} // namespace bundy
+#endif // ASIODNS_DNS_WORKER_POOL_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -0,0 +1,893 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <asio.hpp>
+
+#include <asiodns/fetch_socket_pool.h>
+#include <asiodns/io_fetch.h>
+
+#include <asiolink/io_asio_socket.h>
+#include <asiolink/tcp_endpoint.h>
+#include <asiolink/tcp_socket.h>
+#include <asiolink/timer_wheel.h>
+#include <asiolink/udp_endpoint.h>
+
+#include <exceptions/exceptions.h>
+#include <util/buffer.h>
+#include <util/random/random_number_generator.h>
+
+#include <boost/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/function.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include <cctype>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <netinet/in.h>
+#include <stdint.h>
+
+using asio::ip::tcp;
+using asio::ip::udp;
+using namespace bundy::asiolink;
+using namespace bundy::util;
+using bundy::util::random::UniformRandomIntegerGenerator;
+
+namespace bundy {
+namespace asiodns {
+
+namespace {
+typedef boost::function<void(const asio::error_code&, size_t)> Handler;
+
+const size_t HEADER_LEN = 12;
+const size_t MAX_MESSAGE_LEN = 65535;
+
+// Extract the query ID and the question of a DNS message in wire format.
+// The question is the raw data of the only entry of the question section
+// with the owner name in lower case; it's empty if there isn't exactly one.
+// Returns false if the data is too short to be a DNS message.
+bool
+parseMessage(const uint8_t* data, size_t len, uint16_t& qid,
+             std::string& question)
+{
+    question.clear();
+    if (len < HEADER_LEN) {
+        return (false);
+    }
+    qid = (data[0] << 8) | data[1];
+    if (data[4] != 0 || data[5] != 1) {
+        return (true);
+    }
+    size_t pos = HEADER_LEN;
+    while (pos < len && data[pos] != 0) {
+        if (data[pos] > 63) {   // compressed names aren't handled
+            return (true);
+        }
+        pos += data[pos] + 1;
+    }
+    pos += 1 + 4;               // the root label, type and class
+    if (pos > len) {
+        return (true);
+    }
+    question.assign(data + HEADER_LEN, data + pos);
+    // Label lengths are less than 64, so they are not affected by this.
+    for (std::string::iterator it = question.begin();
+         it != question.end() - 4; ++it) {
+        *it = std::tolower(static_cast<unsigned char>(*it));
+    }
+    return (true);
+}
+
+// A query sent from a shared socket, waiting for the response.
+//
+// The response is copied here, and passed to the fetch in the receive
+// calls; multiple calls are needed if it doesn't fit into the receive
+// buffer.
+struct PendingQuery : boost::noncopyable {
+    PendingQuery(uint16_t qid_param, const std::string& question_param) :
+        qid(qid_param), question(question_param), received(false),
+        response_pos(0), buffer(NULL), buffer_len(0)
+    {}
+
+    // Whether the given response answers this query.  Responses without
+    // a question (like some error responses) are matched by the ID only.
+    bool matches(uint16_t response_qid,
+                 const std::string& response_question) const
+    {
+        return (qid == response_qid &&
+                (response_question.empty() || response_question == question));
+    }
+
+    // Set the result of the query and pass it to the receive in progress,
+    // if any.
+    void setResponse(const uint8_t* data, size_t len,
+                     const asio::error_code& ec, asio::io_service& io)
+    {
+        response.assign(data, data + len);
+        response_pos = 0;
+        error = ec;
+        received = true;
+        if (!handler.empty()) {
+            deliver(io);
+        }
+    }
+
+    // Start a receive.  It completes right away if we have the response,
+    // otherwise when it arrives.
+    void receive(uint8_t* data, size_t len, const Handler& callback,
+                 asio::io_service& io)
+    {
+        handler = callback;
+        buffer = data;
+        buffer_len = len;
+        if (received) {
+            deliver(io);
+        }
+    }
+
+    // Pass (the next part of) the response to the receive in progress.
+    // The fetch is called back through the IO service, as it's generally
+    // not expecting to be called within its own call.
+    void deliver(asio::io_service& io) {
+        const size_t len = std::min(response.size() - response_pos,
+                                    buffer_len);
+        if (len > 0) {
+            std::memcpy(buffer, &response[response_pos], len);
+        }
+        response_pos += len;
+        io.post(boost::bind(handler, error, len));
+        handler.clear();
+    }
+
+    const uint16_t qid;
+    const std::string question;
+    bool received;
+    std::vector<uint8_t> response;
+    size_t response_pos;
+    asio::error_code error;
+    Handler handler;            // the receive in progress, if any
+    uint8_t* buffer;
+    size_t buffer_len;
+};
+typedef boost::shared_ptr<PendingQuery> PendingQueryPtr;
+}
+
+/// A UDP socket shared by fetches.
+///
+/// It reads from the socket while there are queries waiting for
+/// responses, and passes the responses to them.
+class PooledUDPSocket :
+    public boost::enable_shared_from_this<PooledUDPSocket>,
+    boost::noncopyable
+{
+public:
+    PooledUDPSocket(asio::io_service& io, int family,
+                    UniformRandomIntegerGenerator& port_generator) :
+        io_(io), socket_(io), uses_(0), reading_(false), retired_(false)
+    {
+        socket_.open(family == AF_INET6 ? udp::v6() : udp::v4());
+        // Bind to a random port; if we are unlucky a few times, leave it
+        // to the kernel.
+        const udp::endpoint any(family == AF_INET6 ?
+                                udp::endpoint(udp::v6(), 0) :
+                                udp::endpoint(udp::v4(), 0));
+        for (int i = 0; i < 10; ++i) {
+            udp::endpoint local(any.address(), port_generator());
+            asio::error_code ec;
+            socket_.bind(local, ec);
+            if (!ec) {
+                return;
+            }
+        }
+        socket_.bind(any);
+    }
+
+    ~PooledUDPSocket() {
+        asio::error_code ec;
+        socket_.close(ec);
+    }
+
+    int getNative() {
+        return (socket_.native());
+    }
+
+    size_t getUses() const {
+        return (uses_);
+    }
+
+    // Send a query; the callback is called when the query has been sent.
+    PendingQueryPtr send(const void* data, size_t len,
+                         const udp::endpoint& remote, const Handler& callback)
+    {
+        ++uses_;
+        uint16_t qid = 0;
+        std::string question;
+        parseMessage(static_cast<const uint8_t*>(data), len, qid, question);
+        const PendingQueryPtr query(new PendingQuery(qid, question));
+        queries_.insert(std::make_pair(std::make_pair(remote, qid), query));
+        socket_.async_send_to(asio::buffer(data, len), remote, callback);
+        if (!reading_) {
+            startRead();
+        }
+        return (query);
+    }
+
+    // Forget a query (whether it has been answered or not).
+    void remove(const PendingQueryPtr& query, const udp::endpoint& remote) {
+        const std::pair<Queries::iterator, Queries::iterator> range =
+            queries_.equal_range(std::make_pair(remote, query->qid));
+        for (Queries::iterator it = range.first; it != range.second; ++it) {
+            if (it->second == query) {
+                queries_.erase(it);
+                break;
+            }
+        }
+        closeIfDone();
+    }
+
+    // The pool has replaced us with a new socket; we are closed once the
+    // remaining queries are done.
+    void retire() {
+        retired_ = true;
+        closeIfDone();
+    }
+
+    void close() {
+        asio::error_code ec;
+        socket_.close(ec);
+    }
+
+private:
+    // Queries by the server they are sent to and the query ID.
+    typedef std::multimap<std::pair<udp::endpoint, uint16_t>,
+                          PendingQueryPtr> Queries;
+
+    void startRead() {
+        reading_ = true;
+        socket_.async_receive_from(asio::buffer(recvbuf_, sizeof(recvbuf_)),
+                                   sender_,
+                                   boost::bind(&PooledUDPSocket::readDone,
+                                               shared_from_this(),
+                                               asio::placeholders::error,
+                                               asio::placeholders::
+                                               bytes_transferred));
+    }
+
+    void readDone(const asio::error_code& ec, size_t len) {
+        reading_ = false;
+        if (ec == asio::error::operation_aborted || !socket_.is_open()) {
+            return;
+        }
+        uint16_t qid;
+        std::string question;
+        if (!ec && parseMessage(recvbuf_, len, qid, question)) {
+            const std::pair<Queries::iterator, Queries::iterator> range =
+                queries_.equal_range(std::make_pair(sender_, qid));
+            for (Queries::iterator it = range.first; it != range.second;
+                 ++it) {
+                if (!it->second->received &&
+                    it->second->matches(qid, question)) {
+                    it->second->setResponse(recvbuf_, len, ec, io_);
+                    break;
+                }
+            }
+        }
+        // Other errors (such as ICMP errors reported for some other
+        // query) are ignored; keep reading for the others.
+        if (!queries_.empty()) {
+            startRead();
+        }
+    }
+
+    void closeIfDone() {
+        if (retired_ && queries_.empty()) {
+            close();
+        }
+    }
+
+    asio::io_service& io_;
+    udp::socket socket_;
+    size_t uses_;
+    bool reading_;
+    bool retired_;
+    Queries queries_;
+    udp::endpoint sender_;
+    uint8_t recvbuf_[MAX_MESSAGE_LEN];
+};
+typedef boost::shared_ptr<PooledUDPSocket> PooledUDPSocketPtr;
+
+/// A TCP connection to a server shared by fetches.
+///
+/// Queries may be sent on it while others are waiting for responses; the
+/// responses are read as they come and passed to the queries.  Once no
+/// query is waiting, the connection is closed after the idle timeout.
+class PooledTCPConnection :
+    public boost::enable_shared_from_this<PooledTCPConnection>,
+    boost::noncopyable
+{
+public:
+    PooledTCPConnection(asio::io_service& io, const tcp::endpoint& remote,
+                        TimerWheel& wheel, long idle_timeout,
+                        const boost::weak_ptr<FetchSocketPoolImpl>& pool) :
+        io_(io), socket_(io), remote_(remote), idle_timer_(wheel),
+        idle_timeout_(idle_timeout), pool_(pool), state_(CONNECTING),
+        writing_(false)
+    {}
+
+    ~PooledTCPConnection() {
+        asio::error_code ec;
+        socket_.close(ec);
+    }
+
+    void connect() {
+        socket_.async_connect(remote_,
+                              boost::bind(&PooledTCPConnection::connected,
+                                          shared_from_this(),
+                                          asio::placeholders::error));
+    }
+
+    bool isClosed() const {
+        return (state_ == CLOSED);
+    }
+
+    int getNative() {
+        return (socket_.native());
+    }
+
+    // The callback is called once the connection is usable (or it fails).
+    void open(const Handler& callback) {
+        if (state_ == CONNECTING) {
+            open_waiters_.push_back(callback);
+        } else {
+            io_.post(boost::bind(callback, state_ == OPEN ? asio::error_code()
+                                 : asio::error::not_connected, 0));
+        }
+    }
+
+    // Send a query (the length field is added here); the callback is
+    // called when it has been written.
+    PendingQueryPtr send(const void* data, size_t len,
+                         const Handler& callback)
+    {
+        uint16_t qid = 0;
+        std::string question;
+        parseMessage(static_cast<const uint8_t*>(data), len, qid, question);
+        const PendingQueryPtr query(new PendingQuery(qid, question));
+        if (state_ != OPEN) {
+            io_.post(boost::bind(callback, asio::error::not_connected, 0));
+            return (query);
+        }
+        queries_.push_back(query);
+        idle_timer_.cancel();
+
+        OutputBufferPtr buffer(new OutputBuffer(len + 2));
+        buffer->writeUint16(len);
+        buffer->writeData(data, len);
+        write_queue_.push_back(std::make_pair(buffer, callback));
+        if (!writing_) {
+            startWrite();
+        }
+        return (query);
+    }
+
+    void remove(const PendingQueryPtr& query) {
+        for (Queries::iterator it = queries_.begin(); it != queries_.end();
+             ++it) {
+            if (*it == query) {
+                queries_.erase(it);
+                break;
+            }
+        }
+        startIdleTimer();
+    }
+
+    // Close the connection, failing all queries waiting on it.
+    void close(const asio::error_code& ec = asio::error::operation_aborted) {
+        if (state_ == CLOSED) {
+            return;
+        }
+        state_ = CLOSED;
+        idle_timer_.cancel();
+        asio::error_code ignored;
+        socket_.close(ignored);
+        const std::vector<Handler> waiters(open_waiters_);
+        open_waiters_.clear();
+        for (std::vector<Handler>::const_iterator it = waiters.begin();
+             it != waiters.end(); ++it) {
+            io_.post(boost::bind(*it, ec, 0));
+        }
+        const Queries queries(queries_);
+        for (Queries::const_iterator it = queries.begin();
+             it != queries.end(); ++it) {
+            if (!(*it)->received) {
+                (*it)->setResponse(NULL, 0, ec, io_);
+            }
+        }
+        removeFromPool();
+    }
+
+private:
+    typedef std::deque<PendingQueryPtr> Queries;
+    enum State {
+        CONNECTING,
+        OPEN,
+        CLOSED
+    };
+
+    void connected(const asio::error_code& ec) {
+        if (state_ == CLOSED) {
+            return;
+        }
+        if (ec) {
+            close(ec);
+            return;
+        }
+        state_ = OPEN;
+        std::vector<Handler> waiters;
+        waiters.swap(open_waiters_);
+        for (std::vector<Handler>::const_iterator it = waiters.begin();
+             it != waiters.end(); ++it) {
+            io_.post(boost::bind(*it, ec, 0));
+        }
+        // Keep reading until closed, so we notice the server closing it.
+        startRead();
+        startIdleTimer();
+    }
+
+    void startIdleTimer() {
+        if (state_ == OPEN && queries_.empty()) {
+            // The timer belongs to us, so the raw pointer is safe.
+            idle_timer_.setup(boost::bind(&PooledTCPConnection::idle, this),
+                              idle_timeout_, WheelTimer::ONE_SHOT);
+        }
+    }
+
+    void idle() {
+        close();
+    }
+
+    void startWrite() {
+        writing_ = true;
+        const OutputBufferPtr& buffer = write_queue_.front().first;
+        asio::async_write(socket_, asio::buffer(buffer->getData(),
+                                                buffer->getLength()),
+                          boost::bind(&PooledTCPConnection::writeDone,
+                                      shared_from_this(),
+                                      asio::placeholders::error,
+                                      asio::placeholders::bytes_transferred));
+    }
+
+    void writeDone(const asio::error_code& ec, size_t len) {
+        writing_ = false;
+        if (write_queue_.empty()) {
+            return;             // closed in the meantime
+        }
+        const Handler callback = write_queue_.front().second;
+        write_queue_.pop_front();
+        io_.post(boost::bind(callback, ec, len));
+        if (ec) {
+            write_queue_.clear();
+            close(ec);
+        } else if (!write_queue_.empty()) {
+            startWrite();
+        }
+    }
+
+    void startRead() {
+        asio::async_read(socket_, asio::buffer(length_, sizeof(length_)),
+                         boost::bind(&PooledTCPConnection::lengthRead,
+                                     shared_from_this(),
+                                     asio::placeholders::error));
+    }
+
+    void lengthRead(const asio::error_code& ec) {
+        if (state_ == CLOSED) {
+            return;
+        }
+        if (ec) {
+            close(ec);
+            return;
+        }
+        recvbuf_.resize((length_[0] << 8) | length_[1]);
+        if (recvbuf_.empty()) {
+            startRead();
+            return;
+        }
+        asio::async_read(socket_, asio::buffer(&recvbuf_[0], recvbuf_.size()),
+                         boost::bind(&PooledTCPConnection::messageRead,
+                                     shared_from_this(),
+                                     asio::placeholders::error));
+    }
+
+    void messageRead(const asio::error_code& ec) {
+        if (state_ == CLOSED) {
+            return;
+        }
+        if (ec) {
+            close(ec);
+            return;
+        }
+        uint16_t qid;
+        std::string question;
+        if (parseMessage(&recvbuf_[0], recvbuf_.size(), qid, question)) {
+            for (Queries::iterator it = queries_.begin();
+                 it != queries_.end(); ++it) {
+                if (!(*it)->received && (*it)->matches(qid, question)) {
+                    (*it)->setResponse(&recvbuf_[0], recvbuf_.size(), ec,
+                                       io_);
+                    break;
+                }
+            }
+        }
+        startRead();
+    }
+
+    void removeFromPool();
+
+    asio::io_service& io_;
+    tcp::socket socket_;
+    const tcp::endpoint remote_;
+    WheelTimer idle_timer_;
+    const long idle_timeout_;
+    const boost::weak_ptr<FetchSocketPoolImpl> pool_;
+    State state_;
+    std::vector<Handler> open_waiters_;
+    Queries queries_;
+    std::deque<std::pair<OutputBufferPtr, Handler> > write_queue_;
+    bool writing_;
+    uint8_t length_[2];
+    std::vector<uint8_t> recvbuf_;
+};
+typedef boost::shared_ptr<PooledTCPConnection> PooledTCPConnectionPtr;
+
+class FetchSocketPoolImpl :
+    public boost::enable_shared_from_this<FetchSocketPoolImpl>,
+    boost::noncopyable
+{
+public:
+    FetchSocketPoolImpl(IOService& service, size_t udp_sockets,
+                        size_t udp_socket_uses, long tcp_idle_timeout) :
+        io_(service.get_io_service()), wheel_(service.getTimerWheel()),
+        udp_socket_uses_(udp_socket_uses),
+        tcp_idle_timeout_(tcp_idle_timeout),
+        udp4_(udp_sockets), udp6_(udp_sockets),
+        port_generator_(1024, 65535),
+        slot_generator_(0, udp_sockets - 1)
+    {}
+
+    asio::io_service& getIOService() {
+        return (io_);
+    }
+
+    // Pick a random socket of the family, replacing it if it has been used
+    // enough.
+    PooledUDPSocketPtr getUDPSocket(int family) {
+        PooledUDPSocketPtr& socket =
+            (family == AF_INET6 ? udp6_ : udp4_)[slot_generator_()];
+        if (socket && socket->getUses() >= udp_socket_uses_) {
+            socket->retire();
+            socket.reset();
+        }
+        if (!socket) {
+            socket.reset(new PooledUDPSocket(io_, family, port_generator_));
+        }
+        return (socket);
+    }
+
+    // Return the connection to the server, connecting to it if needed.
+    PooledTCPConnectionPtr getTCPConnection(const tcp::endpoint& remote) {
+        PooledTCPConnectionPtr& conn = tcp_[remote];
+        if (!conn || conn->isClosed()) {
+            conn.reset(new PooledTCPConnection(io_, remote, wheel_,
+                                               tcp_idle_timeout_,
+                                               shared_from_this()));
+            conn->connect();
+        }
+        return (conn);
+    }
+
+    void removeTCPConnection(const tcp::endpoint& remote,
+                             const PooledTCPConnection* conn)
+    {
+        const TCPConnections::iterator it = tcp_.find(remote);
+        if (it != tcp_.end() && it->second.get() == conn) {
+            tcp_.erase(it);
+        }
+    }
+
+    size_t getUDPSocketCount() const {
+        size_t count = 0;
+        for (size_t i = 0; i < udp4_.size(); ++i) {
+            count += (udp4_[i] ? 1 : 0) + (udp6_[i] ? 1 : 0);
+        }
+        return (count);
+    }
+
+    size_t getTCPConnectionCount() const {
+        return (tcp_.size());
+    }
+
+    void clear() {
+        for (size_t i = 0; i < udp4_.size(); ++i) {
+            if (udp4_[i]) {
+                udp4_[i]->close();
+                udp4_[i].reset();
+            }
+            if (udp6_[i]) {
+                udp6_[i]->close();
+                udp6_[i].reset();
+            }
+        }
+        // close() removes the connection from the map.
+        const TCPConnections connections(tcp_);
+        for (TCPConnections::const_iterator it = connections.begin();
+             it != connections.end(); ++it) {
+            it->second->close();
+        }
+        tcp_.clear();
+    }
+
+private:
+    typedef std::map<tcp::endpoint, PooledTCPConnectionPtr> TCPConnections;
+
+    asio::io_service& io_;
+    TimerWheel& wheel_;
+    const size_t udp_socket_uses_;
+    const long tcp_idle_timeout_;
+    std::vector<PooledUDPSocketPtr> udp4_;
+    std::vector<PooledUDPSocketPtr> udp6_;
+    TCPConnections tcp_;
+    UniformRandomIntegerGenerator port_generator_;
+    UniformRandomIntegerGenerator slot_generator_;
+};
+
+void
+PooledTCPConnection::removeFromPool() {
+    const boost::shared_ptr<FetchSocketPoolImpl> pool = pool_.lock();
+    if (pool) {
+        pool->removeTCPConnection(remote_, this);
+    }
+}
+
+namespace {
+// The sockets given to the fetches.  They implement the IOAsioSocket
+// interface on top of the shared sockets, so IOFetch doesn't have to care.
+
+class PooledUDPFetchSocket : public IOAsioSocket<IOFetch> {
+public:
+    PooledUDPFetchSocket(const boost::shared_ptr<FetchSocketPoolImpl>& pool) :
+        pool_(pool)
+    {}
+    virtual ~PooledUDPFetchSocket() {
+        close();
+    }
+    virtual int getNative() const {
+        return (socket_ ? socket_->getNative() : -1);
+    }
+    virtual int getProtocol() const {
+        return (IPPROTO_UDP);
+    }
+    virtual bool isOpenSynchronous() const {
+        return (true);
+    }
+    virtual void open(const IOEndpoint* endpoint, IOFetch&) {
+        if (!socket_) {
+            socket_ = pool_->getUDPSocket(endpoint->getFamily());
+        }
+    }
+    virtual void asyncSend(const void* data, size_t length,
+                           const IOEndpoint* endpoint, IOFetch& callback)
+    {
+        if (!socket_) {
+            bundy_throw(SocketNotOpen,
+                        "attempt to send on a UDP socket that is not open");
+        }
+        assert(endpoint->getProtocol() == IPPROTO_UDP);
+        if (query_) {
+            socket_->remove(query_, remote_);
+        }
+        remote_ = static_cast<const UDPEndpoint*>(endpoint)->
+            getASIOEndpoint();
+        query_ = socket_->send(data, length, remote_, callback);
+    }
+    virtual void asyncReceive(void* data, size_t length, size_t offset,
+                              IOEndpoint* endpoint, IOFetch& callback)
+    {
+        if (!query_) {
+            bundy_throw(SocketNotOpen,
+                        "attempt to receive before sending a query");
+        }
+        if (offset >= length) {
+            bundy_throw(BufferOverflow, "attempt to read into area beyond "
+                        "end of UDP receive buffer");
+        }
+        // Only responses from the server are passed to us.
+        assert(endpoint->getProtocol() == IPPROTO_UDP);
+        static_cast<UDPEndpoint*>(endpoint)->getASIOEndpoint() = remote_;
+        query_->receive(static_cast<uint8_t*>(data) + offset,
+                        length - offset, callback, pool_->getIOService());
+    }
+    virtual bool processReceivedData(const void* staging, size_t length,
+                                     size_t& cumulative, size_t& offset,
+                                     size_t& expected,
+                                     OutputBufferPtr& outbuff)
+    {
+        // Same as UDPSocket: it's complete in one read.
+        expected = length;
+        cumulative = length;
+        offset = 0;
+        outbuff->writeData(staging, length);
+        return (true);
+    }
+    virtual void cancel() {
+        if (query_) {
+            query_->handler.clear();
+        }
+    }
+    virtual void close() {
+        if (query_) {
+            socket_->remove(query_, remote_);
+            query_.reset();
+        }
+        socket_.reset();
+    }
+private:
+    const boost::shared_ptr<FetchSocketPoolImpl> pool_;
+    PooledUDPSocketPtr socket_;
+    udp::endpoint remote_;
+    PendingQueryPtr query_;
+};
+
+class PooledTCPFetchSocket : public IOAsioSocket<IOFetch> {
+public:
+    PooledTCPFetchSocket(const boost::shared_ptr<FetchSocketPoolImpl>& pool) :
+        pool_(pool)
+    {}
+    virtual ~PooledTCPFetchSocket() {
+        close();
+    }
+    virtual int getNative() const {
+        return (conn_ ? conn_->getNative() : -1);
+    }
+    virtual int getProtocol() const {
+        return (IPPROTO_TCP);
+    }
+    virtual bool isOpenSynchronous() const {
+        return (false);
+    }
+    virtual void open(const IOEndpoint* endpoint, IOFetch& callback) {
+        assert(endpoint->getProtocol() == IPPROTO_TCP);
+        remote_ = static_cast<const TCPEndpoint*>(endpoint)->
+            getASIOEndpoint();
+        conn_ = pool_->getTCPConnection(remote_);
+        conn_->open(callback);
+    }
+    virtual void asyncSend(const void* data, size_t length,
+                           const IOEndpoint*, IOFetch& callback)
+    {
+        if (!conn_) {
+            bundy_throw(SocketNotOpen,
+                        "attempt to send on a TCP socket that is not open");
+        }
+        if (length > MAX_MESSAGE_LEN) {
+            bundy_throw(BufferTooLarge,
+                        "attempt to send buffer larger than 64kB");
+        }
+        if (query_) {
+            conn_->remove(query_);
+        }
+        query_ = conn_->send(data, length, callback);
+    }
+    virtual void asyncReceive(void* data, size_t length, size_t offset,
+                              IOEndpoint* endpoint, IOFetch& callback)
+    {
+        if (!query_) {
+            bundy_throw(SocketNotOpen,
+                        "attempt to receive before sending a query");
+        }
+        if (offset >= length) {
+            bundy_throw(BufferOverflow, "attempt to read into area beyond "
+                        "end of TCP receive buffer");
+        }
+        assert(endpoint->getProtocol() == IPPROTO_TCP);
+        static_cast<TCPEndpoint*>(endpoint)->getASIOEndpoint() = remote_;
+        query_->receive(static_cast<uint8_t*>(data) + offset,
+                        length - offset, callback, pool_->getIOService());
+    }
+    virtual bool processReceivedData(const void* staging, size_t length,
+                                     size_t& cumulative, size_t& offset,
+                                     size_t& expected,
+                                     OutputBufferPtr& outbuff)
+    {
+        // The response is passed without the length field, in as many
+        // reads as needed.
+        expected = query_->response.size();
+        cumulative += length;
+        offset = 0;
+        outbuff->writeData(staging, length);
+        return (cumulative >= expected);
+    }
+    virtual void cancel() {
+        if (query_) {
+            query_->handler.clear();
+        }
+    }
+    virtual void close() {
+        if (query_) {
+            conn_->remove(query_);
+            query_.reset();
+        }
+        conn_.reset();
+    }
+private:
+    const boost::shared_ptr<FetchSocketPoolImpl> pool_;
+    PooledTCPConnectionPtr conn_;
+    tcp::endpoint remote_;
+    PendingQueryPtr query_;
+};
+}
+
+const size_t FetchSocketPool::DEFAULT_UDP_SOCKETS;
+const size_t FetchSocketPool::DEFAULT_UDP_SOCKET_USES;
+const long FetchSocketPool::DEFAULT_TCP_IDLE_TIMEOUT;
+
+FetchSocketPool::FetchSocketPool(IOService& service, size_t udp_sockets,
+                                 size_t udp_socket_uses,
+                                 long tcp_idle_timeout)
+{
+    if (udp_sockets == 0 || udp_socket_uses == 0 || tcp_idle_timeout <= 0) {
+        bundy_throw(BadValue, "Invalid fetch socket pool parameters: " <<
+                    udp_sockets << "/" << udp_socket_uses << "/" <<
+                    tcp_idle_timeout);
+    }
+    impl_.reset(new FetchSocketPoolImpl(service, udp_sockets,
+                                        udp_socket_uses, tcp_idle_timeout));
+}
+
+FetchSocketPool::~FetchSocketPool() {
+    impl_->clear();
+}
+
+size_t
+FetchSocketPool::getUDPSocketCount() const {
+    return (impl_->getUDPSocketCount());
+}
+
+size_t
+FetchSocketPool::getTCPConnectionCount() const {
+    return (impl_->getTCPConnectionCount());
+}
+
+void
+FetchSocketPool::clear() {
+    impl_->clear();
+}
+
+IOAsioSocket<IOFetch>*
+FetchSocketPool::createSocket(int protocol) {
+    if (protocol == IPPROTO_UDP) {
+        return (new PooledUDPFetchSocket(impl_));
+    }
+    return (new PooledTCPFetchSocket(impl_));
+}
+
+} // namespace asiodns
+} // namespace bundy
@@ -0,0 +1,126 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef FETCH_SOCKET_POOL_H
+#define FETCH_SOCKET_POOL_H 1
+
+#include <asiolink/io_service.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <cstddef>
+
+namespace bundy {
+namespace asiolink {
+template <typename C> class IOAsioSocket;
+}
+
+namespace asiodns {
+
+class IOFetch;
+class FetchSocketPoolImpl;
+
+/// \brief Sockets shared by upstream fetches.
+///
+/// By default an \c IOFetch opens a UDP socket for its query (or connects
+/// to the server over TCP) and closes it when it's done.  Under heavy load
+/// that means a lot of system calls and ephemeral port churn.  Fetches
+/// given a pool of this class (see \c IOFetch::setSocketPool()) share its
+/// sockets instead:
+///
+/// - UDP queries are sent from a fixed number of open sockets per address
+///   family, each bound to a random port.  A fetch picks one of them at
+///   random, and a socket is replaced with a new one (on a new random port)
+///   after a number of queries, so an attacker can't learn the port to
+///   spoof answers to for long.
+/// - TCP queries to the same server are sent over a single connection,
+///   which is kept open for a while after the last query on it.
+///
+/// Responses are passed to the fetch whose query they answer, matched by
+/// the address and port of the server, the query ID and the question
+/// (with the owner name compared case-insensitively).  Other responses are
+/// dropped, like a non-pooled fetch does.
+///
+/// The pool and the fetches using it must be used in the thread running
+/// the IO service.  The sockets are closed on destruction of the pool;
+/// fetches still using them will fail.
+class FetchSocketPool : boost::noncopyable {
+public:
+    /// \brief The default number of UDP sockets per address family.
+    static const size_t DEFAULT_UDP_SOCKETS = 16;
+
+    /// \brief The default number of queries sent from a UDP socket before
+    /// it's replaced.
+    static const size_t DEFAULT_UDP_SOCKET_USES = 100;
+
+    /// \brief The default time an unused TCP connection is kept open
+    /// (in milliseconds).
+    static const long DEFAULT_TCP_IDLE_TIMEOUT = 5000;
+
+    /// \brief Constructor.
+    ///
+    /// No socket is opened until a fetch needs it.
+    ///
+    /// \throw bundy::BadValue udp_sockets, udp_socket_uses or
+    /// tcp_idle_timeout is 0 (or negative).
+    ///
+    /// \param service The IO service which the fetches use.
+    /// \param udp_sockets The number of UDP sockets per address family.
+    /// \param udp_socket_uses The number of queries sent from a UDP socket
+    ///     before it's replaced.
+    /// \param tcp_idle_timeout The time an unused TCP connection is kept
+    ///     open, in milliseconds.
+    FetchSocketPool(bundy::asiolink::IOService& service,
+                    size_t udp_sockets = DEFAULT_UDP_SOCKETS,
+                    size_t udp_socket_uses = DEFAULT_UDP_SOCKET_USES,
+                    long tcp_idle_timeout = DEFAULT_TCP_IDLE_TIMEOUT);
+
+    /// \brief Destructor.
+    ///
+    /// All sockets of the pool are closed.
+    ~FetchSocketPool();
+
+    /// \brief Return the number of open UDP sockets in the pool.
+    ///
+    /// This doesn't include replaced sockets still in use by fetches.
+    size_t getUDPSocketCount() const;
+
+    /// \brief Return the number of open (or opening) TCP connections.
+    size_t getTCPConnectionCount() const;
+
+    /// \brief Close all sockets of the pool.
+    ///
+    /// Fetches using them fail; the pool itself can still be used, and new
+    /// sockets are opened as needed.
+    void clear();
+
+private:
+    friend class IOFetch;
+
+    /// \brief Create a socket for a fetch, sharing the sockets of the pool.
+    ///
+    /// \param protocol IPPROTO_UDP or IPPROTO_TCP
+    bundy::asiolink::IOAsioSocket<IOFetch>* createSocket(int protocol);
+
+    boost::shared_ptr<FetchSocketPoolImpl> impl_;
+};
+
+} // namespace asiodns
+} // namespace bundy
+#endif // FETCH_SOCKET_POOL_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -19,12 +19,13 @@
 #include <stdint.h>
 #include <sys/socket.h>
 
+#include <algorithm>
+
 #include <boost/bind.hpp>
+#include <boost/noncopyable.hpp>
 #include <boost/scoped_ptr.hpp>
-#include <boost/date_time/posix_time/posix_time_types.hpp>
 
 #include <asio.hpp>
-#include <asio/deadline_timer.hpp>
 
 #include <asiolink/io_address.h>
 #include <asiolink/io_asio_socket.h>
@@ -32,16 +33,19 @@
 #include <asiolink/io_service.h>
 #include <asiolink/tcp_endpoint.h>
 #include <asiolink/tcp_socket.h>
+#include <asiolink/timer_wheel.h>
 #include <asiolink/udp_endpoint.h>
 #include <asiolink/udp_socket.h>
 
+#include <dns/edns.h>
+#include <dns/message.h>
 #include <dns/messagerenderer.h>
-#include <dns/opcode.h>
-#include <dns/rcode.h>
 
+#include <asiodns/fetch_socket_pool.h>
 #include <asiodns/io_fetch.h>
 
 #include <util/buffer.h>
+#include <util/free_list.h>
 #include <util/random/qid_gen.h>
 
 #include <asiodns/logger.h>
@@ -70,20 +74,26 @@ const int DBG_ALL = DBGLVL_TRACE_DETAIL + 20;
 /// as a coroutine and passed as callback to many async_*() functions) and we
 /// want keep the same data).  Organising the data in this way keeps copying to
 /// a minimum.
-struct IOFetchData {
+///
+/// The objects are not destroyed when the fetch is done, but kept by the
+/// thread (see \c acquireFetchData()) with their buffers for the next
+/// fetches.
+struct IOFetchData : boost::noncopyable {
 
-    // The first two members are shared pointers to a base class because what is
+    // The socket and endpoints are pointers to a base class because what is
     // actually instantiated depends on whether the fetch is over UDP or TCP,
-    // which is not known until construction of the IOFetch.  Use of a shared
-    // pointer here is merely to ensure deletion when the data object is deleted.
+    // which is not known until initialization of the data.  The socket is
+    // created when the fetch starts, unless it was given by a socket pool.
     boost::scoped_ptr<IOAsioSocket<IOFetch> > socket;
                                              ///< Socket to use for I/O
     boost::scoped_ptr<IOEndpoint> remote_snd;///< Where the fetch is sent
     boost::scoped_ptr<IOEndpoint> remote_rcv;///< Where the response came from
     OutputBufferPtr   msgbuf;      ///< Wire buffer for question
+    const OutputBufferPtr query_buf;///< Own buffer for the question
     OutputBufferPtr   received;    ///< Received data put here
     IOFetch::Callback*          callback;    ///< Called on I/O Completion
-    asio::deadline_timer        timer;       ///< Timer to measure timeouts
+    IOService*                  service;     ///< Service of the fetch
+    boost::scoped_ptr<WheelTimer> timer;     ///< Timer to measure timeouts
     IOFetch::Protocol           protocol;    ///< Protocol being used
     size_t                      cumulative;  ///< Cumulative received amount
     size_t                      expected;    ///< Expected amount of data
@@ -104,10 +114,27 @@ struct IOFetchData {
 
     /// \brief Constructor
     ///
-    /// Just fills in the data members of the IOFetchData structure
+    /// The object must be initialized by \c init() before use.
+    IOFetchData() :
+        query_buf(new OutputBuffer(512)),
+        callback(NULL),
+        service(NULL),
+        protocol(IOFetch::UDP),
+        cumulative(0),
+        expected(0),
+        offset(0),
+        stopped(true),
+        timeout(-1),
+        packet(false),
+        origin(ASIODNS_UNKNOWN_ORIGIN),
+        staging(),
+        qid(0)
+    {}
+
+    /// \brief Initializes the data for a fetch
     ///
     /// \param proto Either IOFetch::TCP or IOFetch::UDP.
-    /// \param service I/O Service object to handle the asynchronous
+    /// \param io_service I/O Service object to handle the asynchronous
     ///        operations.
     /// \param address IP address of upstream server
     /// \param port Port to use for the query
@@ -117,41 +144,45 @@ struct IOFetchData {
     ///        when we terminate.  The caller is responsible for managing this
     ///        object and deleting it if necessary.
     /// \param wait Timeout for the fetch (in ms).
-    ///
-    /// TODO: May need to alter constructor (see comment 4 in Trac ticket #554)
-    IOFetchData(IOFetch::Protocol proto, IOService& service,
-        const IOAddress& address, uint16_t port, OutputBufferPtr& buff,
-        IOFetch::Callback* cb, int wait)
-        :
-        socket((proto == IOFetch::UDP) ?
-            static_cast<IOAsioSocket<IOFetch>*>(
-                new UDPSocket<IOFetch>(service)) :
-            static_cast<IOAsioSocket<IOFetch>*>(
-                new TCPSocket<IOFetch>(service))
-            ),
-        remote_snd((proto == IOFetch::UDP) ?
+    void init(IOFetch::Protocol proto, IOService& io_service,
+              const IOAddress& address, uint16_t port, OutputBufferPtr& buff,
+              IOFetch::Callback* cb, int wait)
+    {
+        remote_snd.reset((proto == IOFetch::UDP) ?
             static_cast<IOEndpoint*>(new UDPEndpoint(address, port)) :
-            static_cast<IOEndpoint*>(new TCPEndpoint(address, port))
-            ),
-        remote_rcv((proto == IOFetch::UDP) ?
+            static_cast<IOEndpoint*>(new TCPEndpoint(address, port)));
+        remote_rcv.reset((proto == IOFetch::UDP) ?
             static_cast<IOEndpoint*>(new UDPEndpoint(address, port)) :
-            static_cast<IOEndpoint*>(new TCPEndpoint(address, port))
-            ),
-        msgbuf(new OutputBuffer(512)),
-        received(buff),
-        callback(cb),
-        timer(service.get_io_service()),
-        protocol(proto),
-        cumulative(0),
-        expected(0),
-        offset(0),
-        stopped(false),
-        timeout(wait),
-        packet(false),
-        origin(ASIODNS_UNKNOWN_ORIGIN),
-        staging(),
-        qid(QidGenerator::getInstance().generateQid())
-    {}
+            static_cast<IOEndpoint*>(new TCPEndpoint(address, port)));
+        query_buf->clear();
+        msgbuf = query_buf;
+        received = buff;
+        callback = cb;
+        service = &io_service;
+        timer.reset(new WheelTimer(io_service.getTimerWheel()));
+        protocol = proto;
+        cumulative = 0;
+        expected = 0;
+        offset = 0;
+        stopped = false;
+        timeout = wait;
+        packet = false;
+        origin = ASIODNS_UNKNOWN_ORIGIN;
+        qid = QidGenerator::getInstance().generateQid();
+    }
+
+    /// \brief Drops what was used by the fetch, keeping the buffers.
+    void clear() {
+        socket.reset();
+        remote_snd.reset();
+        remote_rcv.reset();
+        msgbuf.reset();
+        received.reset();
+        callback = NULL;
+        service = NULL;
+        timer.reset();
+        stopped = true;
+    }
 
     // Checks if the response we received was ok;
     // - data contains the buffer we read, as well as the address
@@ -166,23 +197,56 @@ struct IOFetchData {
     }
 };
 
+namespace {
+// The unused fetch data of a thread.
+typedef bundy::util::FreeList<IOFetchData> FetchDataList;
+
+// Puts the data of a finished fetch in the list of the thread.
+void
+releaseFetchData(IOFetchData* data) {
+    data->clear();
+    FetchDataList::put(data);
+}
+
+// Returns the data for a new fetch, from the list of the thread if there
+// is some.
+boost::shared_ptr<IOFetchData>
+acquireFetchData(IOFetch::Protocol protocol, IOService& service,
+                 const IOAddress& address, uint16_t port,
+                 OutputBufferPtr& buff, IOFetch::Callback* cb, int wait)
+{
+    IOFetchData* data = FetchDataList::get();
+    if (data == NULL) {
+        data = new IOFetchData;
+    }
+    boost::shared_ptr<IOFetchData> data_ptr(data, releaseFetchData);
+    data->init(protocol, service, address, port, buff, cb, wait);
+    return (data_ptr);
+}
+
+// The renderer of the queries of the thread, kept for its tables.
+MessageRenderer&
+getQueryRenderer() {
+    static thread_local MessageRenderer renderer;
+    return (renderer);
+}
+}
+
 /// IOFetch Constructor - just initialize the private data
 
 IOFetch::IOFetch(Protocol protocol, IOService& service,
     const bundy::dns::Question& question, const IOAddress& address,
     uint16_t port, OutputBufferPtr& buff, Callback* cb, int wait, bool edns)
 {
-    MessagePtr query_msg(new Message(Message::RENDER));
-    initIOFetch(query_msg, protocol, service, question, address, port, buff,
-                cb, wait, edns);
+    initIOFetch(protocol, service, question, address, port, buff, cb, wait,
+                edns, false);
 }
 
 IOFetch::IOFetch(Protocol protocol, IOService& service,
     OutputBufferPtr& outpkt, const IOAddress& address, uint16_t port,
     OutputBufferPtr& buff, Callback* cb, int wait)
     :
-    data_(new IOFetchData(protocol, service,
-          address, port, buff, cb, wait))
+    data_(acquireFetchData(protocol, service, address, port, buff, cb, wait))
 {
     data_->msgbuf = outpkt;
     data_->packet = true;
@@ -192,43 +256,40 @@ IOFetch::IOFetch(Protocol protocol, IOService& service,
     ConstMessagePtr query_message, const IOAddress& address, uint16_t port,
     OutputBufferPtr& buff, Callback* cb, int wait)
 {
-    MessagePtr msg(new Message(Message::RENDER));
-
-    msg->setHeaderFlag(Message::HEADERFLAG_RD,
-                       query_message->getHeaderFlag(Message::HEADERFLAG_RD));
-    msg->setHeaderFlag(Message::HEADERFLAG_CD,
-                       query_message->getHeaderFlag(Message::HEADERFLAG_CD));
-
-    initIOFetch(msg, protocol, service,
-                **(query_message->beginQuestion()),
-                address, port, buff, cb, wait);
+    initIOFetch(protocol, service, **(query_message->beginQuestion()),
+                address, port, buff, cb, wait, true,
+                query_message->getHeaderFlag(Message::HEADERFLAG_CD));
 }
 
 void
-IOFetch::initIOFetch(MessagePtr& query_msg, Protocol protocol,
-                     IOService& service,
+IOFetch::initIOFetch(Protocol protocol, IOService& service,
                      const bundy::dns::Question& question,
                      const IOAddress& address, uint16_t port,
-                     OutputBufferPtr& buff, Callback* cb, int wait, bool edns)
+                     OutputBufferPtr& buff, Callback* cb, int wait, bool edns,
+                     bool cd)
 {
-    data_ = boost::shared_ptr<IOFetchData>(new IOFetchData(
-        protocol, service, address, port, buff, cb, wait));
-
-    query_msg->setQid(data_->qid);
-    query_msg->setOpcode(Opcode::QUERY());
-    query_msg->setRcode(Rcode::NOERROR());
-    query_msg->setHeaderFlag(Message::HEADERFLAG_RD);
-    query_msg->addQuestion(question);
-
+    data_ = acquireFetchData(protocol, service, address, port, buff, cb,
+                             wait);
+
+    // The query is rendered directly rather than through a Message: a
+    // header with the recursion desired flag (and the checking disabled
+    // one if asked), the question and the EDNS OPT RR if any.
+    MessageRenderer& renderer = getQueryRenderer();
+    renderer.clear();
+    renderer.setBuffer(data_->msgbuf.get());
+    renderer.writeUint16(data_->qid);
+    renderer.writeUint16(Message::HEADERFLAG_RD |
+                         (cd ? Message::HEADERFLAG_CD : 0));
+    renderer.writeUint16(1);    // QDCOUNT
+    renderer.writeUint16(0);    // ANCOUNT
+    renderer.writeUint16(0);    // NSCOUNT
+    renderer.writeUint16(edns ? 1 : 0); // ARCOUNT
+    question.toWire(renderer);
     if (edns) {
-        EDNSPtr edns_query(new EDNS());
-        edns_query->setUDPSize(Message::DEFAULT_MAX_EDNS0_UDPSIZE);
-        query_msg->setEDNS(edns_query);
+        EDNS edns_query;
+        edns_query.setUDPSize(Message::DEFAULT_MAX_EDNS0_UDPSIZE);
+        edns_query.toWire(renderer, 0);
     }
-
-    MessageRenderer renderer;
-    renderer.setBuffer(data_->msgbuf.get());
-    query_msg->toWire(renderer);
     renderer.setBuffer(NULL);
 }
 
@@ -239,6 +300,12 @@ IOFetch::getProtocol() const {
     return (data_->protocol);
 }
 
+void
+IOFetch::setSocketPool(FetchSocketPool& pool) {
+    data_->socket.reset(pool.createSocket(data_->protocol == UDP ?
+                                          IPPROTO_UDP : IPPROTO_TCP));
+}
+
 /// The function operator is implemented with the "stackless coroutine"
 /// pattern; see internal/coroutine.h for details.
 
@@ -252,6 +319,14 @@ IOFetch::operator()(asio::error_code ec, size_t length) {
         return;
     }
 
+    if (!data_->socket) {
+        data_->socket.reset((data_->protocol == UDP) ?
+            static_cast<IOAsioSocket<IOFetch>*>(
+                new UDPSocket<IOFetch>(*data_->service)) :
+            static_cast<IOAsioSocket<IOFetch>*>(
+                new TCPSocket<IOFetch>(*data_->service)));
+    }
+
     CORO_REENTER (this) {
 
         /// Generate the upstream query and render it to wire format
@@ -267,12 +342,13 @@ IOFetch::operator()(asio::error_code ec, size_t length) {
         }
 
         // If we timeout, we stop, which will can cancel outstanding I/Os and
-        // shutdown everything.
+        // shutdown everything.  The timer is driven by the timer wheel of
+        // the service, as there can be many fetches at the same time.
+        // (A zero timeout is treated as the shortest one the wheel can do.)
         if (data_->timeout != -1) {
-            data_->timer.expires_from_now(boost::posix_time::milliseconds(
-                data_->timeout));
-            data_->timer.async_wait(boost::bind(&IOFetch::stop, *this,
-                TIME_OUT));
+            data_->timer->setup(boost::bind(&IOFetch::stop, *this, TIME_OUT),
+                               std::max(data_->timeout, 1),
+                               WheelTimer::ONE_SHOT);
         }
 
         // Open a connection to the target system.  For speed, if the operation
@@ -388,10 +464,12 @@ IOFetch::stop(Result result) {
 
         // Stop requested, cancel and I/O's on the socket and shut it down,
         // and cancel the timer.
-        data_->socket->cancel();
-        data_->socket->close();
+        if (data_->socket) {
+            data_->socket->cancel();
+            data_->socket->close();
+        }
 
-        data_->timer.cancel();
+        data_->timer->cancel();
 
         // Execute the I/O completion callback (if present).
         if (data_->callback) {
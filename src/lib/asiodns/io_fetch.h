@@ -36,6 +36,7 @@ namespace asiodns {
 
 // Forward declarations
 struct IOFetchData;
+class FetchSocketPool;
 
 /// \brief Upstream Fetch Processing
 ///
@@ -184,6 +185,15 @@ public:
     /// \return Protocol associated with this IOFetch object.
     Protocol getProtocol() const;
 
+    /// \brief Use a shared socket of the pool
+    ///
+    /// By default, each fetch opens a socket of its own.  With this, the
+    /// query is sent from (and the response read on) a socket of the pool
+    /// instead.  It must be called before the fetch is started.
+    ///
+    /// \param pool The pool to use.
+    void setSocketPool(FetchSocketPool& pool);
+
     /// \brief Coroutine entry point
     ///
     /// The operator() method is the method in which the coroutine code enters
@@ -204,13 +214,13 @@ public:
 private:
     /// \brief IOFetch Initialization Function.
     /// All the parameters are same with the constructor, except
-    /// parameter "query_message"
-    /// \param query_message the message to be sent out.
-    void initIOFetch(bundy::dns::MessagePtr& query_message, Protocol protocol,
+    /// parameter "cd"
+    /// \param cd true if the checking disabled flag is set in the query.
+    void initIOFetch(Protocol protocol,
             bundy::asiolink::IOService& service, const bundy::dns::Question& question,
             const bundy::asiolink::IOAddress& address, uint16_t port,
             bundy::util::OutputBufferPtr& buff, Callback* cb, int wait,
-            bool edns = true);
+            bool edns, bool cd);
 
     /// \brief Log I/O Failure
     ///
@@ -0,0 +1,668 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <asio.hpp>
+
+#include <asiodns/notify_sender.h>
+
+#include <asiolink/io_service.h>
+#include <asiolink/timer_wheel.h>
+
+#include <exceptions/exceptions.h>
+#include <util/random/random_number_generator.h>
+#include <util/threads/sync.h>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <deque>
+#include <map>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <errno.h>
+
+using asio::ip::udp;
+using namespace bundy::asiolink;
+using bundy::util::random::UniformRandomIntegerGenerator;
+using bundy::util::thread::Mutex;
+
+namespace bundy {
+namespace asiodns {
+
+namespace {
+
+const size_t HEADER_LEN = 12;
+const unsigned int OPCODE_NOTIFY = 4;
+
+// The number of messages sent or received with a single system call.
+const size_t BATCH_SIZE = 64;
+
+// Responses are truncated to this; only the header and question are used.
+const size_t MAX_RESPONSE_LEN = 512;
+
+// The retransmission timeout stops doubling after this many tries.
+const unsigned int MAX_BACKOFF_SHIFT = 10;
+
+// Extract the question of a DNS message in wire format.  The question is
+// the raw data of the only entry of the question section with the owner
+// name in lower case.  Returns false if there isn't exactly one question or
+// the message is malformed.
+bool
+getQuestion(const uint8_t* data, size_t len, std::string& question) {
+    if (len < HEADER_LEN || data[4] != 0 || data[5] != 1) {
+        return (false);
+    }
+    size_t pos = HEADER_LEN;
+    while (pos < len && data[pos] != 0) {
+        if (data[pos] > 63) {   // compressed names aren't expected here
+            return (false);
+        }
+        pos += data[pos] + 1;
+    }
+    pos += 1 + 4;               // the root label, type and class
+    if (pos > len) {
+        return (false);
+    }
+    question.assign(data + HEADER_LEN, data + pos);
+    // Label lengths are less than 64, so they are not affected by this.
+    for (std::string::iterator it = question.begin();
+         it != question.end() - 4; ++it) {
+        *it = std::tolower(static_cast<unsigned char>(*it));
+    }
+    return (true);
+}
+
+unsigned int
+getOpcode(const uint8_t* data) {
+    return ((data[2] >> 3) & 0x0f);
+}
+
+// The NOTIFY message of a zone.
+struct Zone : boost::noncopyable {
+    Zone(size_t id, const uint8_t* data, size_t len,
+         const std::string& question) :
+        id_(id), message_(data, data + len), question_(question), targets_(0)
+    {}
+
+    const size_t id_;
+    const std::vector<uint8_t> message_;
+    const std::string question_;
+    // The number of NOTIFYs of the zone not done yet.
+    size_t targets_;
+};
+typedef boost::shared_ptr<Zone> ZonePtr;
+
+#if defined(HAVE_SENDMMSG) || defined(HAVE_RECVMMSG)
+typedef struct mmsghdr BatchMessage;
+#else
+struct BatchMessage {
+    struct msghdr msg_hdr;
+    unsigned int msg_len;
+};
+#endif
+
+struct Socket;
+
+// A NOTIFY to a target.
+struct Notify : boost::noncopyable {
+    Notify(const ZonePtr& zone, const udp::endpoint& target,
+           TimerWheel& wheel) :
+        zone_(zone), target_(target), socket_(NULL), qid_(0), tries_(0),
+        done_(false), timer_(wheel)
+    {}
+
+    const ZonePtr zone_;
+    const udp::endpoint target_;
+    // The socket it's sent from, once it's outstanding.
+    Socket* socket_;
+    uint16_t qid_;
+    // The query ID in wire format, sent instead of the one of the zone's
+    // message.
+    uint8_t qid_data_[2];
+    unsigned int tries_;
+    bool done_;
+    WheelTimer timer_;
+};
+typedef boost::shared_ptr<Notify> NotifyPtr;
+
+// The socket of an address family, and the NOTIFYs sent from it.
+struct Socket : boost::noncopyable {
+    Socket(asio::io_service& io_service) :
+        socket_(io_service), outstanding_(0x10000), flushing_(false),
+        waiting_writable_(false)
+    {}
+
+    udp::socket socket_;
+    // The outstanding NOTIFYs by query ID.
+    std::vector<NotifyPtr> outstanding_;
+    // The NOTIFYs to be sent (or resent).
+    std::deque<NotifyPtr> send_queue_;
+    // Whether a flush of the queue is scheduled.
+    bool flushing_;
+    // Whether we wait for the socket to be writable to flush the queue.
+    bool waiting_writable_;
+};
+
+// Send count messages, in one system call if possible.  Returns the number
+// of messages sent, or -1 if the first one couldn't be sent (with errno
+// set).
+int
+sendBatch(int fd, BatchMessage* msgs, size_t count) {
+#ifdef HAVE_SENDMMSG
+    return (sendmmsg(fd, msgs, count, MSG_DONTWAIT));
+#else
+    size_t sent = 0;
+    for (; sent < count; ++sent) {
+        if (sendmsg(fd, &msgs[sent].msg_hdr, MSG_DONTWAIT) < 0) {
+            break;
+        }
+    }
+    return (sent > 0 ? static_cast<int>(sent) : -1);
+#endif
+}
+
+// Receive up to count messages, in one system call if possible.  Returns
+// the number of messages received, or -1 (with errno set).
+int
+receiveBatch(int fd, BatchMessage* msgs, size_t count) {
+#ifdef HAVE_RECVMMSG
+    return (recvmmsg(fd, msgs, count, MSG_DONTWAIT, NULL));
+#else
+    size_t received = 0;
+    for (; received < count; ++received) {
+        const ssize_t ret = recvmsg(fd, &msgs[received].msg_hdr,
+                                    MSG_DONTWAIT);
+        if (ret < 0) {
+            break;
+        }
+        msgs[received].msg_len = ret;
+    }
+    return (received > 0 ? static_cast<int>(received) : -1);
+#endif
+}
+
+}
+
+class NotifySenderImpl : boost::noncopyable {
+public:
+    NotifySenderImpl(size_t max_outstanding, long timeout,
+                     unsigned int max_tries) :
+        max_outstanding_(max_outstanding), timeout_(timeout),
+        max_tries_(max_tries), next_zone_(0), outstanding_(0),
+        starting_(false), running_(false), woken_(false),
+        qid_generator_(0, 0xffff), run_timer_(service_.getTimerWheel()),
+        response_data_(BATCH_SIZE * MAX_RESPONSE_LEN),
+        senders_(BATCH_SIZE), iovecs_(BATCH_SIZE * 2), msgs_(BATCH_SIZE)
+    {
+        std::memset(&msgs_[0], 0, sizeof(msgs_[0]) * msgs_.size());
+    }
+
+    // Start the waiting NOTIFYs while there's room for them.
+    void startWaiting();
+
+    // Send the queued NOTIFYs of a socket in the next handler.
+    void scheduleFlush(Socket& socket);
+
+    // Send the queued NOTIFYs of a socket.
+    void flush(Socket* socket);
+
+    // The socket is writable again.
+    void handleWritable(Socket* socket, const asio::error_code& ec);
+
+    // Receive the responses available on a socket.
+    void handleReadable(Socket* socket, const asio::error_code& ec);
+
+    // A NOTIFY has been sent.
+    void handleSent(Notify& notify);
+
+    // No response to a NOTIFY in time.
+    void handleTimeout(Notify* notify);
+
+    // Record the outcome of a NOTIFY and forget it.
+    void finish(NotifyPtr notify, bool replied, unsigned int rcode,
+                int error);
+
+    // Get the socket for an address family, opening it if needed.  Returns
+    // NULL (and sets errno) if it can't be opened.
+    Socket* getSocket(const udp& protocol);
+
+    // Called by the run timer.
+    void stopRunning() {
+        service_.stop();
+    }
+
+    // Stop running if there's nothing left to do.
+    void checkDone() {
+        if (running_ && outstanding_ == 0 && waiting_.empty()) {
+            service_.stop();
+        }
+    }
+
+    // Forget the zones without targets.  Zones are otherwise forgotten when
+    // their last NOTIFY is done.
+    void forgetUnusedZones() {
+        for (std::vector<size_t>::const_iterator it = new_zones_.begin();
+             it != new_zones_.end(); ++it) {
+            const std::map<size_t, ZonePtr>::iterator zone = zones_.find(*it);
+            if (zone != zones_.end() && zone->second->targets_ == 0) {
+                zones_.erase(zone);
+            }
+        }
+        new_zones_.clear();
+    }
+
+    // Declared first, so it's destroyed last.
+    IOService service_;
+
+    const size_t max_outstanding_;
+    const long timeout_;
+    const unsigned int max_tries_;
+
+    std::map<size_t, ZonePtr> zones_;
+    // Zones added since the last run.
+    std::vector<size_t> new_zones_;
+    size_t next_zone_;
+
+    // The NOTIFYs waiting for their turn.
+    std::deque<NotifyPtr> waiting_;
+    size_t outstanding_;
+    // Whether startWaiting() is in progress.
+    bool starting_;
+
+    // The IPv4 and IPv6 sockets.
+    boost::scoped_ptr<Socket> sockets_[2];
+
+    std::vector<NotifySender::Result> results_;
+
+    // Protects running_ and woken_, and serializes wakeup() with the
+    // reset of the IO service.
+    Mutex mutex_;
+    bool running_;
+    bool woken_;
+
+    UniformRandomIntegerGenerator qid_generator_;
+    WheelTimer run_timer_;
+
+    // Buffers for the system calls, used by one batch at a time.
+    std::vector<uint8_t> response_data_;
+    std::vector<udp::endpoint> senders_;
+    std::vector<struct iovec> iovecs_;
+    std::vector<BatchMessage> msgs_;
+};
+
+void
+NotifySenderImpl::startWaiting() {
+    // A NOTIFY failing right away calls us again through finish().
+    if (starting_) {
+        return;
+    }
+    starting_ = true;
+    while (outstanding_ < max_outstanding_ && !waiting_.empty()) {
+        const NotifyPtr notify = waiting_.front();
+        waiting_.pop_front();
+        ++outstanding_;
+
+        Socket* socket = getSocket(notify->target_.protocol());
+        if (socket == NULL) {
+            finish(notify, false, 0, errno);
+            continue;
+        }
+
+        // There are at most MAX_OUTSTANDING NOTIFYs, so this terminates.
+        uint16_t qid = qid_generator_();
+        while (socket->outstanding_[qid]) {
+            ++qid;
+        }
+        notify->socket_ = socket;
+        notify->qid_ = qid;
+        notify->qid_data_[0] = qid >> 8;
+        notify->qid_data_[1] = qid & 0xff;
+        socket->outstanding_[qid] = notify;
+        socket->send_queue_.push_back(notify);
+        scheduleFlush(*socket);
+    }
+    starting_ = false;
+}
+
+Socket*
+NotifySenderImpl::getSocket(const udp& protocol) {
+    boost::scoped_ptr<Socket>& socket =
+        sockets_[protocol == udp::v4() ? 0 : 1];
+    if (socket) {
+        return (socket.get());
+    }
+
+    boost::scoped_ptr<Socket> new_socket(
+        new Socket(service_.get_io_service()));
+    asio::error_code ec;
+    new_socket->socket_.open(protocol, ec);
+    if (!ec) {
+        // Bind it now, so we can wait for responses before the first send.
+        new_socket->socket_.bind(udp::endpoint(protocol, 0), ec);
+    }
+    if (ec) {
+        errno = ec.value();
+        return (NULL);
+    }
+    socket.swap(new_socket);
+    socket->socket_.async_receive(
+        asio::null_buffers(),
+        boost::bind(&NotifySenderImpl::handleReadable, this, socket.get(),
+                    _1));
+    return (socket.get());
+}
+
+void
+NotifySenderImpl::scheduleFlush(Socket& socket) {
+    if (!socket.flushing_ && !socket.waiting_writable_) {
+        socket.flushing_ = true;
+        service_.post(boost::bind(&NotifySenderImpl::flush, this, &socket));
+    }
+}
+
+void
+NotifySenderImpl::flush(Socket* socket) {
+    socket->flushing_ = false;
+    std::deque<NotifyPtr>& queue = socket->send_queue_;
+    while (!queue.empty()) {
+        // Skip the NOTIFYs answered while waiting to be resent.
+        if (queue.front()->done_) {
+            queue.pop_front();
+            continue;
+        }
+        size_t count = 0;
+        for (std::deque<NotifyPtr>::const_iterator it = queue.begin();
+             it != queue.end() && count < BATCH_SIZE; ++it) {
+            Notify& notify = **it;
+            if (notify.done_) {
+                continue;
+            }
+            const std::vector<uint8_t>& message = notify.zone_->message_;
+            iovecs_[count * 2].iov_base = notify.qid_data_;
+            iovecs_[count * 2].iov_len = sizeof(notify.qid_data_);
+            iovecs_[count * 2 + 1].iov_base =
+                const_cast<uint8_t*>(&message[2]);
+            iovecs_[count * 2 + 1].iov_len = message.size() - 2;
+            struct msghdr& hdr = msgs_[count].msg_hdr;
+            hdr.msg_name = const_cast<udp::endpoint::data_type*>(
+                notify.target_.data());
+            hdr.msg_namelen = notify.target_.size();
+            hdr.msg_iov = &iovecs_[count * 2];
+            hdr.msg_iovlen = 2;
+            ++count;
+        }
+
+        const int ret = sendBatch(socket->socket_.native(), &msgs_[0], count);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            socket->waiting_writable_ = true;
+            socket->socket_.async_send(
+                asio::null_buffers(),
+                boost::bind(&NotifySenderImpl::handleWritable, this, socket,
+                            _1));
+            return;
+        }
+        if (ret < 0) {
+            // The first one couldn't be sent; give it up and go on with
+            // the others.
+            const NotifyPtr notify = queue.front();
+            queue.pop_front();
+            finish(notify, false, 0, errno);
+            continue;
+        }
+        // Done NOTIFYs were skipped above, so pop them as well.
+        for (int sent = 0; sent < ret; queue.pop_front()) {
+            if (!queue.front()->done_) {
+                handleSent(*queue.front());
+                ++sent;
+            }
+        }
+    }
+    checkDone();
+}
+
+void
+NotifySenderImpl::handleWritable(Socket* socket, const asio::error_code& ec) {
+    socket->waiting_writable_ = false;
+    if (ec != asio::error::operation_aborted) {
+        flush(socket);
+    }
+}
+
+void
+NotifySenderImpl::handleSent(Notify& notify) {
+    ++notify.tries_;
+    // Exponential backoff, as in section 3.6 of RFC 1996.
+    const long interval =
+        timeout_ << std::min(notify.tries_ - 1, MAX_BACKOFF_SHIFT);
+    notify.timer_.setup(boost::bind(&NotifySenderImpl::handleTimeout, this,
+                                    &notify),
+                        interval, WheelTimer::ONE_SHOT);
+}
+
+void
+NotifySenderImpl::handleTimeout(Notify* notify) {
+    Socket& socket = *notify->socket_;
+    const NotifyPtr notify_ptr = socket.outstanding_[notify->qid_];
+    if (notify->tries_ >= max_tries_) {
+        finish(notify_ptr, false, 0, 0);
+        checkDone();
+    } else {
+        socket.send_queue_.push_back(notify_ptr);
+        scheduleFlush(socket);
+    }
+}
+
+void
+NotifySenderImpl::handleReadable(Socket* socket, const asio::error_code& ec) {
+    if (ec == asio::error::operation_aborted) {
+        return;
+    }
+
+    for (;;) {
+        for (size_t i = 0; i < BATCH_SIZE; ++i) {
+            iovecs_[i].iov_base = &response_data_[i * MAX_RESPONSE_LEN];
+            iovecs_[i].iov_len = MAX_RESPONSE_LEN;
+            struct msghdr& hdr = msgs_[i].msg_hdr;
+            hdr.msg_name = senders_[i].data();
+            hdr.msg_namelen = senders_[i].capacity();
+            hdr.msg_iov = &iovecs_[i];
+            hdr.msg_iovlen = 1;
+        }
+        const int received = receiveBatch(socket->socket_.native(),
+                                          &msgs_[0], BATCH_SIZE);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        std::string question;
+        for (int i = 0; i < received; ++i) {
+            const uint8_t* data = &response_data_[i * MAX_RESPONSE_LEN];
+            const size_t len = std::min(static_cast<size_t>(msgs_[i].msg_len),
+                                        MAX_RESPONSE_LEN);
+            if (len < HEADER_LEN || (data[2] & 0x80) == 0 ||
+                getOpcode(data) != OPCODE_NOTIFY) {
+                continue;
+            }
+            const uint16_t qid = (data[0] << 8) | data[1];
+            const NotifyPtr notify = socket->outstanding_[qid];
+            if (!notify) {
+                continue;
+            }
+            udp::endpoint& sender = senders_[i];
+            sender.resize(msgs_[i].msg_hdr.msg_namelen);
+            if (sender != notify->target_ ||
+                !getQuestion(data, len, question) ||
+                question != notify->zone_->question_) {
+                continue;
+            }
+            finish(notify, true, data[3] & 0x0f, 0);
+        }
+        if (received < static_cast<int>(BATCH_SIZE)) {
+            break;
+        }
+    }
+    checkDone();
+
+    socket->socket_.async_receive(
+        asio::null_buffers(),
+        boost::bind(&NotifySenderImpl::handleReadable, this, socket, _1));
+}
+
+void
+NotifySenderImpl::finish(NotifyPtr notify, bool replied, unsigned int rcode,
+                         int error)
+{
+    notify->done_ = true;
+    notify->timer_.cancel();
+    if (notify->socket_ != NULL) {
+        notify->socket_->outstanding_[notify->qid_].reset();
+    }
+    --outstanding_;
+
+    const NotifySender::Result result = {
+        notify->zone_->id_, notify->target_.address().to_string(),
+        notify->target_.port(), notify->tries_, replied, rcode, error
+    };
+    results_.push_back(result);
+
+    if (--notify->zone_->targets_ == 0) {
+        zones_.erase(notify->zone_->id_);
+    }
+    startWaiting();
+}
+
+NotifySender::NotifySender(size_t max_outstanding, long timeout,
+                           unsigned int max_tries)
+{
+    if (max_outstanding == 0 || max_outstanding > MAX_OUTSTANDING) {
+        bundy_throw(BadValue, "invalid maximum number of outstanding "
+                    "NOTIFYs: " << max_outstanding);
+    }
+    if (timeout <= 0) {
+        bundy_throw(BadValue, "invalid NOTIFY timeout: " << timeout);
+    }
+    if (max_tries == 0) {
+        bundy_throw(BadValue, "NOTIFYs must be sent at least once");
+    }
+    impl_.reset(new NotifySenderImpl(max_outstanding, timeout, max_tries));
+}
+
+NotifySender::~NotifySender() {
+}
+
+size_t
+NotifySender::addZone(const void* data, size_t length) {
+    const uint8_t* const message = static_cast<const uint8_t*>(data);
+    std::string question;
+    if (!getQuestion(message, length, question) ||
+        getOpcode(message) != OPCODE_NOTIFY) {
+        bundy_throw(BadValue, "not a NOTIFY message with a single question");
+    }
+    const size_t id = impl_->next_zone_++;
+    impl_->zones_[id].reset(new Zone(id, message, length, question));
+    impl_->new_zones_.push_back(id);
+    return (id);
+}
+
+void
+NotifySender::addTarget(size_t zone, const std::string& address,
+                        uint16_t port)
+{
+    const std::map<size_t, ZonePtr>::const_iterator it =
+        impl_->zones_.find(zone);
+    if (it == impl_->zones_.end()) {
+        bundy_throw(BadValue, "unknown NOTIFY zone: " << zone);
+    }
+    asio::error_code ec;
+    const asio::ip::address target_address =
+        asio::ip::address::from_string(address, ec);
+    if (ec) {
+        bundy_throw(BadValue, "invalid NOTIFY target address: " << address);
+    }
+    impl_->waiting_.push_back(NotifyPtr(
+        new Notify(it->second, udp::endpoint(target_address, port),
+                   impl_->service_.getTimerWheel())));
+    ++it->second->targets_;
+}
+
+size_t
+NotifySender::run(long timeout) {
+    {
+        Mutex::Locker locker(impl_->mutex_);
+        if (impl_->woken_) {
+            impl_->woken_ = false;
+            return (impl_->results_.size());
+        }
+        impl_->running_ = true;
+        impl_->service_.get_io_service().reset();
+    }
+
+    impl_->forgetUnusedZones();
+    const bool idle = (getPendingCount() == 0);
+    impl_->startWaiting();
+    if (timeout > 0) {
+        impl_->run_timer_.setup(
+            boost::bind(&NotifySenderImpl::stopRunning, impl_.get()),
+            timeout, WheelTimer::ONE_SHOT);
+    }
+    // Unless the NOTIFYs have all failed already.
+    if (idle || getPendingCount() > 0) {
+        impl_->service_.run();
+    }
+    impl_->run_timer_.cancel();
+
+    {
+        Mutex::Locker locker(impl_->mutex_);
+        impl_->running_ = false;
+        impl_->woken_ = false;
+    }
+    impl_->forgetUnusedZones();
+    return (impl_->results_.size());
+}
+
+void
+NotifySender::wakeup() {
+    Mutex::Locker locker(impl_->mutex_);
+    impl_->woken_ = true;
+    if (impl_->running_) {
+        impl_->service_.stop();
+    }
+}
+
+std::vector<NotifySender::Result>
+NotifySender::getResults() {
+    std::vector<Result> results;
+    results.swap(impl_->results_);
+    return (results);
+}
+
+size_t
+NotifySender::getPendingCount() const {
+    return (impl_->outstanding_ + impl_->waiting_.size());
+}
+
+} // namespace asiodns
+} // namespace bundy
@@ -0,0 +1,185 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef NOTIFY_SENDER_H
+#define NOTIFY_SENDER_H 1
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace asiodns {
+
+class NotifySenderImpl;
+
+/// \brief Sender of NOTIFY messages to many secondary servers.
+///
+/// A primary server sends a NOTIFY to each secondary of a zone when the
+/// zone changes, and resends it with an exponential backoff until the
+/// secondary answers (RFC 1996).  When many zones change at once, that's
+/// a lot of messages and timers.  This class handles them in bulk:
+///
+/// - The NOTIFY message of a zone is given once, in wire format, and is
+///   sent to each of its targets with only the query ID changed, without
+///   copying or rendering it again.
+/// - All messages are sent from one UDP socket per address family, in
+///   batches with \c sendmmsg(2) where available.  Responses are received
+///   in batches as well, and matched to the NOTIFY they answer by the
+///   socket, the query ID, the address and port of the target, the opcode
+///   and the question (with the zone name compared case-insensitively).
+///   Other responses are ignored.
+/// - The retransmissions are driven by the timer wheel of an internal IO
+///   service, so arming and canceling the timers is cheap.
+///
+/// No more than a maximum number of NOTIFYs are outstanding at a time;
+/// the others wait for their turn, in the order they were added.
+///
+/// The sender is driven by calling \c run() in some thread, which returns
+/// after a while; the outcome of each NOTIFY is then available with
+/// \c getResults().  All methods but \c wakeup() must be called in the
+/// same thread.
+class NotifySender : boost::noncopyable {
+public:
+    /// \brief The default maximum number of outstanding NOTIFYs.
+    static const size_t DEFAULT_MAX_OUTSTANDING = 1000;
+
+    /// \brief The default time to wait for the first response, in
+    /// milliseconds.
+    ///
+    /// The time is doubled after each retransmission.
+    static const long DEFAULT_TIMEOUT = 2000;
+
+    /// \brief The default number of times a NOTIFY is sent before giving
+    /// up.
+    static const unsigned int DEFAULT_MAX_TRIES = 5;
+
+    /// \brief The largest number of outstanding NOTIFYs accepted.
+    ///
+    /// The query IDs of the outstanding NOTIFYs sent from a socket must
+    /// be distinct, and are picked at random among the free ones.
+    static const size_t MAX_OUTSTANDING = 32768;
+
+    /// \brief The outcome of a NOTIFY.
+    struct Result {
+        /// The zone, as returned by \c addZone().
+        size_t zone_;
+        /// The address of the target, in textual form.
+        std::string address_;
+        /// The port of the target.
+        uint16_t port_;
+        /// The number of times the NOTIFY was sent.
+        unsigned int tries_;
+        /// Whether the target answered.
+        bool replied_;
+        /// The RCODE of the response (only the 4 bits of the header), if
+        /// the target answered.
+        unsigned int rcode_;
+        /// The \c errno value if the NOTIFY couldn't be sent, 0 otherwise.
+        int error_;
+    };
+
+    /// \brief Constructor.
+    ///
+    /// No socket is opened until a NOTIFY is sent over it.
+    ///
+    /// \throw bundy::BadValue max_outstanding is 0 or larger than
+    /// \c MAX_OUTSTANDING, timeout is not positive, or max_tries is 0.
+    ///
+    /// \param max_outstanding The maximum number of outstanding NOTIFYs.
+    /// \param timeout The time to wait for the first response, in
+    ///     milliseconds.
+    /// \param max_tries The number of times a NOTIFY is sent before giving
+    ///     up.
+    NotifySender(size_t max_outstanding = DEFAULT_MAX_OUTSTANDING,
+                 long timeout = DEFAULT_TIMEOUT,
+                 unsigned int max_tries = DEFAULT_MAX_TRIES);
+
+    /// \brief Destructor.
+    ///
+    /// The sockets are closed, and the NOTIFYs not done are forgotten.
+    ~NotifySender();
+
+    /// \brief Add the NOTIFY message of a zone.
+    ///
+    /// The message is copied; its query ID is ignored.  It is then sent to
+    /// the targets given with \c addTarget().
+    ///
+    /// \throw bundy::BadValue The data is not a NOTIFY message with a
+    /// single question.
+    ///
+    /// \param data The message in wire format.
+    /// \param length The length of the data.
+    /// \return An identifier of the zone for \c addTarget() and the
+    ///     results.
+    size_t addZone(const void* data, size_t length);
+
+    /// \brief Send the NOTIFY message of a zone to a target.
+    ///
+    /// The NOTIFY is sent by the next \c run().
+    ///
+    /// \throw bundy::BadValue zone is not known, or address is not a
+    /// valid IPv4 or IPv6 address.
+    ///
+    /// \param zone The zone, as returned by \c addZone().
+    /// \param address The address of the target, in textual form.
+    /// \param port The port of the target.
+    void addTarget(size_t zone, const std::string& address, uint16_t port);
+
+    /// \brief Send the NOTIFYs and handle the responses and timeouts.
+    ///
+    /// This returns when all NOTIFYs are done, when the timeout expires,
+    /// or when \c wakeup() is called.  If there's nothing to do, it just
+    /// waits for the timeout or a wakeup.
+    ///
+    /// Zones without a NOTIFY left are forgotten (their identifiers must
+    /// not be used again) once this returns.
+    ///
+    /// \param timeout The maximum time to run, in milliseconds; 0 means no
+    ///     limit.
+    /// \return The number of results available.
+    size_t run(long timeout);
+
+    /// \brief Make \c run() return as soon as possible.
+    ///
+    /// If \c run() is not running, the next call returns at once.  This
+    /// can be called from any thread.
+    void wakeup();
+
+    /// \brief Return the outcome of the NOTIFYs done so far, and forget
+    /// them.
+    std::vector<Result> getResults();
+
+    /// \brief Return the number of NOTIFYs not done yet.
+    ///
+    /// This includes the outstanding ones and the ones waiting for their
+    /// turn.
+    size_t getPendingCount() const;
+
+private:
+    boost::scoped_ptr<NotifySenderImpl> impl_;
+};
+
+} // namespace asiodns
+} // namespace bundy
+#endif // NOTIFY_SENDER_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -25,14 +25,24 @@
 #include <asiolink/udp_socket.h>
 
 #include <boost/bind.hpp>
+#include <boost/scoped_array.hpp>
 
 #include <cassert>
+#include <cstring>
+#include <vector>
 
 #include <sys/types.h>
 #include <netinet/in.h>
+#include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <unistd.h>             // for some IPC/network system calls
 #include <errno.h>
+#include <time.h>
+
+// Batched I/O needs both recvmmsg() and sendmmsg().
+#if defined(HAVE_RECVMMSG) && defined(HAVE_SENDMMSG)
+#define SYNC_UDP_SERVER_BATCHED_IO 1
+#endif
 
 using namespace std;
 using namespace bundy::asiolink;
@@ -40,6 +50,58 @@ using namespace bundy::asiolink;
 namespace bundy {
 namespace asiodns {
 
+namespace {
+// The monotonic time in microseconds, to measure the processing time for
+// overload detection.
+uint64_t
+getMicroseconds() {
+    struct timespec now;
+    if (clock_gettime(CLOCK_MONOTONIC, &now) != 0) {
+        return (0);
+    }
+    return (static_cast<uint64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000);
+}
+}
+
+#ifdef SYNC_UDP_SERVER_BATCHED_IO
+// Everything needed for a single recvmmsg()/sendmmsg() round.  Slot i of
+// each array is used for the i-th datagram of the batch; they are only
+// allocated on construction so handling a batch doesn't allocate memory
+// (except when an output buffer needs to grow for the first time).
+struct SyncUDPServer::BatchContext {
+    BatchContext(size_t size) :
+        size_(size), data_(new uint8_t[size * MAX_LENGTH]), senders_(size),
+        recv_iovecs_(size), recv_msgs_(size), send_iovecs_(size),
+        send_msgs_(size)
+    {
+        for (size_t i = 0; i < size; ++i) {
+            output_buffers_.push_back(bundy::util::OutputBufferPtr(
+                                          new bundy::util::OutputBuffer(0)));
+            recv_iovecs_[i].iov_base = &data_[i * MAX_LENGTH];
+            recv_iovecs_[i].iov_len = MAX_LENGTH;
+            std::memset(&recv_msgs_[i], 0, sizeof(recv_msgs_[i]));
+            recv_msgs_[i].msg_hdr.msg_iov = &recv_iovecs_[i];
+            recv_msgs_[i].msg_hdr.msg_iovlen = 1;
+            std::memset(&send_msgs_[i], 0, sizeof(send_msgs_[i]));
+            send_msgs_[i].msg_hdr.msg_iov = &send_iovecs_[i];
+            send_msgs_[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+
+    const size_t size_;
+    boost::scoped_array<uint8_t> data_;
+    std::vector<asio::ip::udp::endpoint> senders_;
+    std::vector<bundy::util::OutputBufferPtr> output_buffers_;
+    std::vector<struct iovec> recv_iovecs_;
+    std::vector<struct mmsghdr> recv_msgs_;
+    std::vector<struct iovec> send_iovecs_;
+    std::vector<struct mmsghdr> send_msgs_;
+};
+#else
+// Not used, just make scoped_ptr happy.
+struct SyncUDPServer::BatchContext {};
+#endif
+
 SyncUDPServerPtr
 SyncUDPServer::create(asio::io_service& io_service, const int fd,
                       const int af, DNSLookup* lookup)
@@ -52,7 +114,8 @@ SyncUDPServer::SyncUDPServer(asio::io_service& io_service, const int fd,
     output_buffer_(new bundy::util::OutputBuffer(0)),
     query_(new bundy::dns::Message(bundy::dns::Message::PARSE)),
     udp_endpoint_(sender_), lookup_callback_(lookup),
-    resume_called_(false), done_(false), stopped_(false)
+    resume_called_(false), done_(false), stopped_(false), batch_size_(1),
+    overload_latency_(0), overloaded_(false)
 {
     if (af != AF_INET && af != AF_INET6) {
         bundy_throw(InvalidParameter, "Address family must be either AF_INET "
@@ -75,21 +138,83 @@ SyncUDPServer::SyncUDPServer(asio::io_service& io_service, const int fd,
     udp_socket_.reset(new UDPSocket<DummyIOCallback>(*socket_));
 }
 
+SyncUDPServer::~SyncUDPServer() {}
+
+void
+SyncUDPServer::setUDPBatchSize(size_t batch_size) {
+    if (batch_size == 0 || batch_size > DNSServiceBase::MAX_UDP_BATCH_SIZE) {
+        bundy_throw(InvalidParameter, "UDP batch size must be between 1 and "
+                    << DNSServiceBase::MAX_UDP_BATCH_SIZE << ", not " <<
+                    batch_size);
+    }
+#ifdef SYNC_UDP_SERVER_BATCHED_IO
+    // A read may be pending, and this may even be called from the lookup
+    // callback while a batch is handled, so the batch buffers are only
+    // replaced by the next scheduleRead().
+    batch_size_ = batch_size;
+#endif
+}
+
+void
+SyncUDPServer::setUDPOverloadLatency(size_t latency) {
+    overload_latency_ = latency;
+    if (latency == 0) {
+        overloaded_ = false;
+    }
+}
+
+void
+SyncUDPServer::checkOverload(uint64_t start) {
+    // For UDP, this gives the size of the next waiting datagram, if any.
+    int pending = 0;
+    if (ioctl(socket_->native(), FIONREAD, &pending) != 0) {
+        pending = 0;
+    }
+    if (pending == 0) {
+        if (overloaded_) {
+            overloaded_ = false;
+            LOG_INFO(logger, ASIODNS_UDP_SYNC_OVERLOAD_END);
+        }
+    } else if (!overloaded_ &&
+               getMicroseconds() - start >= overload_latency_) {
+        overloaded_ = true;
+        LOG_INFO(logger, ASIODNS_UDP_SYNC_OVERLOAD_START).
+            arg(overload_latency_);
+    }
+}
+
 void
 SyncUDPServer::scheduleRead() {
+#ifdef SYNC_UDP_SERVER_BATCHED_IO
+    // No read is pending here, so the batch size can be applied.
+    if (batch_size_ == 1) {
+        batch_.reset();
+    } else if (!batch_ || batch_->size_ != batch_size_) {
+        batch_.reset(new BatchContext(batch_size_));
+    }
+#endif
+    if (batch_) {
+        // In the batched mode we only wait for the socket to be readable
+        // and receive the data ourselves in handleReadable().
+        socket_->async_receive(
+            asio::null_buffers(),
+            boost::bind(&SyncUDPServer::handleReadable, shared_from_this(),
+                        _1));
+        return;
+    }
     socket_->async_receive_from(
         asio::mutable_buffers_1(data_, MAX_LENGTH), sender_,
         boost::bind(&SyncUDPServer::handleRead, shared_from_this(), _1, _2));
 }
 
-void
-SyncUDPServer::handleRead(const asio::error_code& ec, const size_t length) {
+bool
+SyncUDPServer::readSucceeded(const asio::error_code& ec) {
     if (stopped_) {
         // stopped_ can be set to true only after the socket object is closed.
         // checking this would also detect premature destruction of 'this'
         // object.
         assert(socket_ && !socket_->is_open());
-        return;
+        return (false);
     }
     if (ec) {
         using namespace asio::error;
@@ -97,14 +222,24 @@ SyncUDPServer::handleRead(const asio::error_code& ec, const size_t length) {
 
         // See TCPServer::operator() for details on error handling.
         if (err_val == operation_aborted || err_val == bad_descriptor) {
-            return;
+            return (false);
         }
         if (err_val != would_block && err_val != try_again &&
             err_val != interrupted) {
             LOG_ERROR(logger, ASIODNS_UDP_SYNC_RECEIVE_FAIL).arg(ec.message());
         }
+        scheduleRead();
+        return (false);
+    }
+    return (true);
+}
+
+void
+SyncUDPServer::handleRead(const asio::error_code& ec, const size_t length) {
+    if (!readSucceeded(ec)) {
+        return;
     }
-    if (ec || length == 0) {
+    if (length == 0) {
         scheduleRead();
         return;
     }
@@ -122,6 +257,8 @@ SyncUDPServer::handleRead(const asio::error_code& ec, const size_t length) {
     done_ = false;
     resume_called_ = false;
 
+    const uint64_t start = overload_latency_ > 0 ? getMicroseconds() : 0;
+
     // Call the actual lookup
     const IOMessage message(data_, length, *udp_socket_, udp_endpoint_);
     (*lookup_callback_)(message, query_, answer_, output_buffer_, this);
@@ -141,11 +278,135 @@ SyncUDPServer::handleRead(const asio::error_code& ec, const size_t length) {
                       arg(sender_.address().to_string()).arg(ec_.message());
         }
     }
+    if (overload_latency_ > 0 && !stopped_) {
+        checkOverload(start);
+    }
 
     // And schedule handling another socket.
     scheduleRead();
 }
 
+#ifdef SYNC_UDP_SERVER_BATCHED_IO
+void
+SyncUDPServer::handleReadable(const asio::error_code& ec) {
+    if (!readSucceeded(ec)) {
+        return;
+    }
+
+    if (!batch_) {
+        // Not expected, as the batch is only released when no read is
+        // pending, but the datagrams are still there for the next read.
+        scheduleRead();
+        return;
+    }
+
+    const uint64_t start = overload_latency_ > 0 ? getMicroseconds() : 0;
+    BatchContext& batch = *batch_;
+    for (size_t i = 0; i < batch.size_; ++i) {
+        batch.recv_msgs_[i].msg_hdr.msg_name = batch.senders_[i].data();
+        batch.recv_msgs_[i].msg_hdr.msg_namelen =
+            batch.senders_[i].capacity();
+    }
+    // The socket may be shared with other threads or processes, so this can
+    // fail with EAGAIN even if we've been told it's readable.
+    const int received = recvmmsg(socket_->native(),
+                                  &batch.recv_msgs_[0], batch.size_,
+                                  MSG_DONTWAIT, NULL);
+    if (received < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            LOG_ERROR(logger, ASIODNS_UDP_SYNC_RECEIVE_FAIL).
+                arg(std::strerror(errno));
+        }
+        scheduleRead();
+        return;
+    }
+
+    size_t answers = 0;
+    for (int i = 0; i < received; ++i) {
+        const size_t length = batch.recv_msgs_[i].msg_len;
+        if (length == 0) {
+            continue;
+        }
+        asio::ip::udp::endpoint& sender = batch.senders_[i];
+        sender.resize(batch.recv_msgs_[i].msg_hdr.msg_namelen);
+        const UDPEndpoint udp_endpoint(sender);
+        const bundy::util::OutputBufferPtr& output_buffer =
+            batch.output_buffers_[answers];
+        output_buffer->clear();
+
+        done_ = false;
+        resume_called_ = false;
+
+        // See handleRead() about the buffers and query_.
+        const IOMessage message(batch.recv_iovecs_[i].iov_base, length,
+                                *udp_socket_, udp_endpoint);
+        (*lookup_callback_)(message, query_, answer_, output_buffer, this);
+
+        if (!resume_called_) {
+            bundy_throw(bundy::Unexpected,
+                        "No resume called from the lookup callback");
+        }
+        if (stopped_) {
+            // The callback stopped us; the socket is already closed.
+            return;
+        }
+        if (done_) {
+            struct msghdr& hdr = batch.send_msgs_[answers].msg_hdr;
+            hdr.msg_name = sender.data();
+            hdr.msg_namelen = sender.size();
+            batch.send_iovecs_[answers].iov_base =
+                const_cast<void*>(output_buffer->getData());
+            batch.send_iovecs_[answers].iov_len = output_buffer->getLength();
+            ++answers;
+        }
+    }
+    flushBatch(answers);
+    if (overload_latency_ > 0) {
+        checkOverload(start);
+    }
+
+    scheduleRead();
+}
+
+void
+SyncUDPServer::flushBatch(size_t count) {
+    BatchContext& batch = *batch_;
+    size_t sent = 0;
+    while (sent < count) {
+        const int ret = sendmmsg(socket_->native(),
+                                 &batch.send_msgs_[sent], count - sent, 0);
+        if (ret > 0) {
+            sent += ret;
+            continue;
+        }
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        // The first remaining message couldn't be sent.  Log it, skip it
+        // and try the rest, just as if they had been sent one by one.
+        asio::ip::udp::endpoint endpoint;
+        const struct msghdr& hdr = batch.send_msgs_[sent].msg_hdr;
+        std::memcpy(endpoint.data(), hdr.msg_name, hdr.msg_namelen);
+        endpoint.resize(hdr.msg_namelen);
+        LOG_ERROR(logger, ASIODNS_UDP_SYNC_SEND_FAIL).
+            arg(endpoint.address().to_string()).
+            arg(ret < 0 ? std::strerror(errno) : "no message sent");
+        ++sent;
+    }
+}
+#else
+void
+SyncUDPServer::handleReadable(const asio::error_code&) {
+    // batch_ is never set in this case, so this can't be called.
+    assert(false);
+}
+
+void
+SyncUDPServer::flushBatch(size_t) {
+    assert(false);
+}
+#endif
+
 void
 SyncUDPServer::operator()(asio::error_code, size_t) {
     // To start the server, we just schedule reading of data when they
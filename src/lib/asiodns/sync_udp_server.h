@@ -22,6 +22,7 @@
 #include "dns_answer.h"
 #include "dns_lookup.h"
 #include "dns_server.h"
+#include "dns_service.h"
 
 #include <dns/message.h>
 #include <asiolink/simple_callback.h>
@@ -66,6 +67,9 @@ private:
                   DNSLookup* lookup);
 
 public:
+    /// \brief Destructor.
+    virtual ~SyncUDPServer();
+
     /// \brief Factory of SyncUDPServer object in the form of shared_ptr.
     ///
     /// Due to the nature of this server, it's meaningless if the lookup
@@ -125,6 +129,55 @@ public:
     /// \return true if we have an answer
     virtual bool hasAnswer();
 
+    /// \brief Set the maximum number of datagrams handled per wakeup
+    ///
+    /// With a size larger than 1, the server waits for the socket to be
+    /// readable and then receives up to \c batch_size datagrams at once
+    /// with \c recvmmsg(2).  Each of them is passed to the lookup callback
+    /// in turn, and all answers are sent with a single \c sendmmsg(2)
+    /// call.  The receive and output buffers for each slot of the batch
+    /// are allocated here, so the query handling itself doesn't allocate
+    /// memory in this mode.
+    ///
+    /// If the system doesn't support these calls, the server always
+    /// handles one datagram at a time and this method has no effect.
+    /// The new size takes effect on the next read from the socket; it can
+    /// be safely changed while the server is running.
+    ///
+    /// \throw bundy::InvalidParameter batch_size is 0 or larger than
+    ///     \c DNSServiceBase::MAX_UDP_BATCH_SIZE
+    virtual void setUDPBatchSize(size_t batch_size);
+
+    /// \brief Return the maximum number of datagrams handled per wakeup.
+    ///
+    /// It's always 1 if batched I/O isn't supported by the system.
+    size_t getUDPBatchSize() const {
+        return (batch_size_);
+    }
+
+    /// \brief Set the overload detection threshold
+    ///
+    /// The server becomes overloaded when handling the datagrams of a
+    /// single wakeup (a batch, or a single datagram if batched I/O isn't
+    /// used) took at least \c latency microseconds and more datagrams are
+    /// still waiting on the socket after that, i.e., when queries wait in
+    /// the socket buffer for about that long before they are handled.  It
+    /// stays overloaded until the socket is found empty after handling a
+    /// wakeup.  While overloaded, \c isOverloaded() returns true so the
+    /// lookup callback can shed load.
+    ///
+    /// Checking the socket costs a system call per wakeup, so it's only
+    /// done if the detection is enabled.
+    ///
+    /// \param latency The threshold in microseconds; 0 disables the
+    ///        detection, which is the default.
+    virtual void setUDPOverloadLatency(size_t latency);
+
+    /// \brief Return true if the server is currently overloaded.
+    ///
+    /// See \c setUDPOverloadLatency().
+    virtual bool isOverloaded() const { return (overloaded_); }
+
     /// \brief Clones the object
     ///
     /// Since cloning is for the use of coroutines, the synchronous UDP server
@@ -176,6 +229,16 @@ private:
     // Placeholder for error code object.  It will be passed to ASIO library
     // to have it set in case of error.
     asio::error_code ec_;
+    // Per-slot buffers and message headers for batched I/O.  It's NULL
+    // unless the batch size is larger than 1 (or batched I/O isn't supported
+    // at all).  Defined in the .cc to keep system specific stuff out of here.
+    struct BatchContext;
+    boost::scoped_ptr<BatchContext> batch_;
+    size_t batch_size_;
+    // The processing time per wakeup that makes us overloaded (in
+    // microseconds, 0 if disabled) and whether we are.
+    size_t overload_latency_;
+    bool overloaded_;
 
     // Auxiliary functions
 
@@ -185,6 +248,18 @@ private:
     // Callback from the socket's read call (called when there's an error or
     // when a new packet comes).
     void handleRead(const asio::error_code& ec, const size_t length);
+    // Callback when the socket becomes readable in the batched mode.
+    void handleReadable(const asio::error_code& ec);
+    // Common error handling of the read callbacks.  It returns true if
+    // the callback should go on to handle the received data; otherwise the
+    // next read has been scheduled if necessary and the callback should
+    // simply return.
+    bool readSucceeded(const asio::error_code& ec);
+    // Send all answers collected in a batch.
+    void flushBatch(size_t count);
+    // Update overloaded_ after handling the datagrams of a wakeup that
+    // started at the given time (see getMicroseconds() in the .cc).
+    void checkOverload(uint64_t start);
 };
 
 } // namespace asiodns
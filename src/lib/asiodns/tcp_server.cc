@@ -20,12 +20,18 @@
 #include <asiolink/dummy_io_cb.h>
 #include <asiolink/tcp_endpoint.h>
 #include <asiolink/tcp_socket.h>
+#include <asiolink/timer_wheel.h>
 #include <asiodns/tcp_server.h>
 #include <asiodns/logger.h>
 
+#include <boost/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/shared_array.hpp>
 
 #include <cassert>
+#include <vector>
 #include <unistd.h>             // for some IPC/network system calls
 #include <netinet/in.h>
 #include <sys/socket.h>
@@ -46,6 +52,181 @@ using namespace bundy::asiolink;
 namespace bundy {
 namespace asiodns {
 
+/// The state of a connection, shared by the coroutine reading queries from
+/// it and the coroutines handling the queries.
+///
+/// All of them run in the thread of the IO service, so no locking is
+/// needed.  The object is kept alive by the coroutines and by the pending
+/// write handler.
+class TCPServer::Connection :
+    public boost::enable_shared_from_this<TCPServer::Connection>,
+    boost::noncopyable
+{
+public:
+    Connection(io_service& io, boost::shared_ptr<tcp::socket> socket,
+               boost::shared_ptr<size_t> max_in_flight, TimerWheel& wheel) :
+        io_(io), socket_(socket), max_in_flight_(max_in_flight),
+        timer_(wheel), in_flight_(0), reader_done_(false), writing_(false)
+    {}
+
+    /// (Re)start the idle timer.  If it expires while no query is in
+    /// flight, the socket is canceled, making the pending read fail.
+    void startTimer(size_t timeout) {
+        if (timeout == 0) {
+            return;
+        }
+        // This cancels the previous setup.  The timer is ours, so it
+        // can't expire after we are gone.
+        timer_.setup(boost::bind(&Connection::timedOut, this, timeout),
+                     timeout, WheelTimer::ONE_SHOT);
+    }
+
+    /// Whether as many queries as allowed are in flight.
+    bool isFull() const {
+        return (in_flight_ >= *max_in_flight_);
+    }
+
+    /// Keep the reading coroutine until a query in flight is done.
+    void pauseReader(const TCPServer& reader) {
+        paused_reader_.reset(new TCPServer(reader));
+    }
+
+    /// A query has been read and is passed to the lookup.
+    void queryStarted() {
+        ++in_flight_;
+    }
+
+    /// The lookup decided not to answer a query.  As it normally
+    /// happens when the connection is passed to someone else (for zone
+    /// transfers), we stop using it at this point.
+    void queryDropped() {
+        --in_flight_;
+        close(true);
+    }
+
+    /// Queue the response to a query, and write it unless another write is
+    /// in progress; in that case it's written with the other responses
+    /// queued in the meantime once the current write completes.
+    void sendResponse(const OutputBufferPtr& response) {
+        queue_.push_back(Response(response));
+        if (!writing_) {
+            startWrite();
+        }
+    }
+
+    /// The reading coroutine has finished (the client closed the
+    /// connection, or an error or timeout happened).  The connection is
+    /// closed once the queries in flight are answered.
+    void readerDone() {
+        reader_done_ = true;
+        timer_.cancel();
+        paused_reader_.reset();
+        closeIfDone();
+    }
+
+    /// Close the socket now.  The pending I/O will fail and the coroutines
+    /// finish.
+    void close(bool noresp = false) {
+        timer_.cancel();
+        asio::error_code ec;
+        socket_->close(ec);
+        if (ec) {
+            // close() should be unlikely to fail, but we've seen it fail
+            // once, so we log the event (at the lowest level of debug).
+            LOG_DEBUG(logger, 0, noresp ? ASIODNS_TCP_CLOSE_NORESP_FAIL :
+                      ASIODNS_TCP_CLOSE_FAIL).arg(ec.message());
+        }
+        resumeReader();
+    }
+
+private:
+    // A response with the length field to be sent before it.
+    struct Response {
+        Response(const OutputBufferPtr& data_param) : data(data_param) {
+            const size_t len = data->getLength();
+            length[0] = (len >> 8) & 0xff;
+            length[1] = len & 0xff;
+        }
+        uint8_t length[TCP_MESSAGE_LENGTHSIZE];
+        OutputBufferPtr data;
+    };
+
+    void timedOut(size_t timeout) {
+        if (reader_done_) {
+            return;
+        }
+        if (in_flight_ > 0) {
+            // The client is waiting for us; it's not idle.
+            startTimer(timeout);
+            return;
+        }
+        asio::error_code ec;
+        socket_->cancel(ec);
+    }
+
+    void startWrite() {
+        assert(sending_.empty());
+        sending_.swap(queue_);
+        std::vector<const_buffer> bufs;
+        bufs.reserve(sending_.size() * 2);
+        for (std::vector<Response>::const_iterator it = sending_.begin();
+             it != sending_.end(); ++it) {
+            bufs.push_back(buffer(it->length, TCP_MESSAGE_LENGTHSIZE));
+            bufs.push_back(buffer(it->data->getData(),
+                                  it->data->getLength()));
+        }
+        writing_ = true;
+        async_write(*socket_, bufs,
+                    boost::bind(&Connection::writeDone, shared_from_this(),
+                                asio::placeholders::error));
+    }
+
+    void writeDone(const asio::error_code& ec) {
+        writing_ = false;
+        in_flight_ -= sending_.size();
+        sending_.clear();
+        if (ec) {
+            LOG_DEBUG(logger, DBGLVL_TRACE_BASIC, ASIODNS_TCP_WRITE_FAIL).
+                arg(ec.message());
+            // The connection is unusable; drop the queued responses, too.
+            in_flight_ -= queue_.size();
+            queue_.clear();
+            close();
+        } else if (!queue_.empty()) {
+            startWrite();
+        }
+        resumeReader();
+        closeIfDone();
+    }
+
+    void resumeReader() {
+        if (paused_reader_ && (!isFull() || !socket_->is_open())) {
+            // post() can throw due to memory allocation failure; we consider
+            // it fatal.
+            io_.post(*paused_reader_);
+            paused_reader_.reset();
+        }
+    }
+
+    void closeIfDone() {
+        if (reader_done_ && in_flight_ == 0 && !writing_ &&
+            socket_->is_open()) {
+            close();
+        }
+    }
+
+    io_service& io_;
+    const boost::shared_ptr<tcp::socket> socket_;
+    const boost::shared_ptr<size_t> max_in_flight_;
+    WheelTimer timer_;
+    boost::scoped_ptr<TCPServer> paused_reader_;
+    size_t in_flight_;         // read and not yet answered (or dropped)
+    bool reader_done_;
+    bool writing_;
+    std::vector<Response> queue_;   // waiting for the current write
+    std::vector<Response> sending_; // being written
+};
+
 /// The following functions implement the \c TCPServer class.
 ///
 /// The constructor
@@ -54,7 +235,9 @@ TCPServer::TCPServer(io_service& io_service, int fd, int af,
                      const DNSAnswer* answer) :
     io_(io_service), done_(false),
     lookup_callback_(lookup),
-    answer_callback_(answer)
+    answer_callback_(answer),
+    connections_(new Connections),
+    timer_wheel_(new TimerWheel(io_service))
 {
     if (af != AF_INET && af != AF_INET6) {
         bundy_throw(InvalidParameter, "Address family must be either AF_INET "
@@ -74,20 +257,16 @@ TCPServer::TCPServer(io_service& io_service, int fd, int af,
     // Set it to some value. It should be set to the right one
     // immediately, but set it to something non-zero just in case.
     tcp_recv_timeout_.reset(new size_t(5000));
+    tcp_max_in_flight_.reset(new size_t(16));
 }
 
-namespace {
-// Called by the timeout_ deadline timer if the client takes too long.
-// If not aborted, cancels the given socket
-// (in which case TCPServer::operator() will be called to continue,
-// with an 'aborted' error code.)
-void doTimeOut(boost::shared_ptr<asio::ip::tcp::socket> socket,
-               const asio::error_code& error)
-{
-    if (error != asio::error::operation_aborted) {
-        socket->cancel();
+void
+TCPServer::setTCPMaxInFlight(size_t max_in_flight) {
+    if (max_in_flight == 0) {
+        bundy_throw(InvalidParameter, "TCP queries in flight must be "
+                    "positive");
     }
-}
+    *tcp_max_in_flight_ = max_in_flight;
 }
 
 void
@@ -96,9 +275,6 @@ TCPServer::operator()(asio::error_code ec, size_t length) {
     /// a switch statement, inline variable declarations are not
     /// permitted.  Certain variables used below can be declared here.
 
-    boost::array<const_buffer,2> bufs;
-    OutputBuffer lenbuf(TCP_MESSAGE_LENGTHSIZE);
-
     CORO_REENTER (this) {
         do {
             /// Create a socket to listen for connections (no-throw operation)
@@ -145,45 +321,22 @@ TCPServer::operator()(asio::error_code ec, size_t length) {
         // immediately trigger destroying this object, cleaning up all
         // resources including any open sockets.
 
-        /// Instantiate the data buffer that will be used by the
-        /// asynchronous read call.
-        data_.reset(new char[MAX_LENGTH]);
-
-        /// Start a timer to drop the connection if it is idle.  note that
-        // we pass a shared_ptr of the socket object so that it won't be
-        // destroyed at least until the timeout callback (including abort)
-        // is called.
-        if (*tcp_recv_timeout_ > 0) {
-            timeout_.reset(new asio::deadline_timer(io_)); // shouldn't throw
-            timeout_->expires_from_now( // consider any exception fatal.
-                boost::posix_time::milliseconds(*tcp_recv_timeout_));
-            timeout_->async_wait(boost::bind(&doTimeOut, socket_,
-                                             asio::placeholders::error));
-        }
-
-        /// Read the message, in two parts.  First, the message length:
-        CORO_YIELD async_read(*socket_, asio::buffer(data_.get(),
-                              TCP_MESSAGE_LENGTHSIZE), *this);
-        if (ec) {
-            LOG_DEBUG(logger, DBGLVL_TRACE_BASIC, ASIODNS_TCP_READLEN_FAIL).
-                arg(ec.message());
-            return;
-        }
-
-        /// Now read the message itself. (This is done in a different scope
-        /// to allow inline variable declarations.)
-        CORO_YIELD {
-            InputBuffer dnsbuffer(data_.get(), length);
-            const uint16_t msglen = dnsbuffer.readUint16();
-            async_read(*socket_, asio::buffer(data_.get(), msglen), *this);
-        }
-        if (ec) {
-            LOG_DEBUG(logger, DBGLVL_TRACE_BASIC, ASIODNS_TCP_READDATA_FAIL).
-                arg(ec.message());
-            return;
+        // Set up the state of the connection, and register it (forgetting
+        // those already closed).
+        conn_.reset(new Connection(io_, socket_, tcp_max_in_flight_,
+                                   *timer_wheel_));
+        for (Connections::iterator it = connections_->begin();
+             it != connections_->end();) {
+            if (it->expired()) {
+                it = connections_->erase(it);
+            } else {
+                ++it;
+            }
         }
+        connections_->push_back(conn_);
 
-        // Create an \c IOMessage object to store the query.
+        // Create the endpoint and socket objects for \c IOMessage.  They
+        // are shared by all queries on this connection.
         //
         // (XXX: It would be good to write a factory function
         // that would quickly generate an IOMessage object without
@@ -192,6 +345,7 @@ TCPServer::operator()(asio::error_code ec, size_t length) {
         if (ec) {
             LOG_DEBUG(logger, DBGLVL_TRACE_BASIC, ASIODNS_TCP_GETREMOTE_FAIL).
                 arg(ec.message());
+            conn_->readerDone();
             return;
         }
 
@@ -202,20 +356,78 @@ TCPServer::operator()(asio::error_code ec, size_t length) {
         // the underlying Boost TCP socket - DummyIOCallback is used.  This
         // provides the appropriate operator() but is otherwise functionless.
         iosock_.reset(new TCPSocket<DummyIOCallback>(*socket_));
-        io_message_.reset(new IOMessage(data_.get(), length, *iosock_,
-                                        *peer_));
 
-        // If we don't have a DNS Lookup provider, there's no point in
-        // continuing; we exit the coroutine permanently.
-        if (lookup_callback_ == NULL) {
-            return;
-        }
+        // Read queries until the connection is closed, forking a coroutine
+        // for each of them.
+        do {
+            // If too many queries are in flight, wait until one of them is
+            // answered.  The connection resumes us (a copy of us, to be
+            // precise) then.
+            if (conn_->isFull()) {
+                CORO_YIELD conn_->pauseReader(*this);
+                if (!socket_->is_open()) {
+                    conn_->readerDone();
+                    return;
+                }
+            }
 
-        // Reset or instantiate objects that will be needed by the
-        // DNS lookup and the write call.
-        respbuf_.reset(new OutputBuffer(0));
-        query_message_.reset(new Message(Message::PARSE));
-        answer_message_.reset(new Message(Message::RENDER));
+            /// Instantiate the data buffer that will be used by the
+            /// asynchronous read call.  This is per query, as the
+            /// previous one may still be used by its lookup.
+            data_.reset(new char[MAX_LENGTH]);
+
+            /// Start a timer to drop the connection if it is idle.
+            conn_->startTimer(*tcp_recv_timeout_);
+
+            /// Read the message, in two parts.  First, the message length:
+            CORO_YIELD async_read(*socket_, asio::buffer(data_.get(),
+                                  TCP_MESSAGE_LENGTHSIZE), *this);
+            if (ec) {
+                // The client closing the connection after its queries is
+                // the normal end of it.
+                if (ec != asio::error::eof) {
+                    LOG_DEBUG(logger, DBGLVL_TRACE_BASIC,
+                              ASIODNS_TCP_READLEN_FAIL).arg(ec.message());
+                }
+                conn_->readerDone();
+                return;
+            }
+
+            /// Now read the message itself. (This is done in a different scope
+            /// to allow inline variable declarations.)
+            CORO_YIELD {
+                InputBuffer dnsbuffer(data_.get(), length);
+                const uint16_t msglen = dnsbuffer.readUint16();
+                async_read(*socket_, asio::buffer(data_.get(), msglen), *this);
+            }
+            if (ec) {
+                LOG_DEBUG(logger, DBGLVL_TRACE_BASIC,
+                          ASIODNS_TCP_READDATA_FAIL).arg(ec.message());
+                conn_->readerDone();
+                return;
+            }
+
+            // If we don't have a DNS Lookup provider, there's no point in
+            // continuing; we exit the coroutine permanently.
+            if (lookup_callback_ == NULL) {
+                conn_->readerDone();
+                return;
+            }
+
+            // Create an \c IOMessage object to store the query, and
+            // instantiate objects that will be needed by the DNS lookup and
+            // the write call.  They are owned by the child below.
+            io_message_.reset(new IOMessage(data_.get(), length, *iosock_,
+                                            *peer_));
+            respbuf_.reset(new OutputBuffer(0));
+            query_message_.reset(new Message(Message::PARSE));
+            answer_message_.reset(new Message(Message::RENDER));
+            conn_->queryStarted();
+
+            /// Fork the coroutine: the child handles the query while the
+            /// parent goes on reading the next one.
+            CORO_FORK io_.post(TCPServer(*this));
+        } while (is_parent());
 
         // Schedule a DNS lookup, and yield.  When the lookup is
         // finished, the coroutine will resume immediately after
@@ -226,51 +438,20 @@ TCPServer::operator()(asio::error_code ec, size_t length) {
         assert(!ec);
 
         // The 'done_' flag indicates whether we have an answer
-        // to send back.  If not, exit the coroutine permanently.
+        // to send back.  If not, the connection is closed; this normally
+        // means it has been passed to someone else (e.g., for zone
+        // transfers).
         if (!done_) {
-            // Explicitly close() isn't necessary for most cases. But for the
-            // very connection, socket_ is shared with the original owner of
-            // the server object and would stay open.
-            // TODO: should we keep the connection open for a short time
-            // to see if new requests come in?
-            socket_->close(ec);
-            if (ec) {
-                LOG_DEBUG(logger, 0, ASIODNS_TCP_CLOSE_FAIL).arg(ec.message());
-            }
+            conn_->queryDropped();
             return;
         }
 
         // Call the DNS answer provider to render the answer into
-        // wire format
+        // wire format, and pass it to the connection to be sent back,
+        // beginning with two length bytes.  We have nothing further to do.
         (*answer_callback_)(*io_message_, query_message_, answer_message_,
                             respbuf_);
-
-        // Set up the response, beginning with two length bytes.
-        lenbuf.writeUint16(respbuf_->getLength());
-        bufs[0] = buffer(lenbuf.getData(), lenbuf.getLength());
-        bufs[1] = buffer(respbuf_->getData(), respbuf_->getLength());
-
-        // Begin an asynchronous send, and then yield.  When the
-        // send completes, we will resume immediately after this point
-        // (though we have nothing further to do, so the coroutine
-        // will simply exit at that time).
-        CORO_YIELD async_write(*socket_, bufs, *this);
-        if (ec) {
-            LOG_DEBUG(logger, DBGLVL_TRACE_BASIC, ASIODNS_TCP_WRITE_FAIL).
-                arg(ec.message());
-        }
-
-        // All done, cancel the timeout timer. if it throws, consider it fatal.
-        timeout_->cancel();
-
-        // TODO: should we keep the connection open for a short time
-        // to see if new requests come in?
-        socket_->close(ec);
-        if (ec) {
-            // close() should be unlikely to fail, but we've seen it fail once,
-            // so we log the event (at the lowest level of debug).
-            LOG_DEBUG(logger, 0, ASIODNS_TCP_CLOSE_FAIL).arg(ec.message());
-        }
+        conn_->sendResponse(respbuf_);
     }
 }
 
@@ -301,6 +482,16 @@ void TCPServer::stop() {
             LOG_ERROR(logger, ASIODNS_TCP_CLEANUP_CLOSE_FAIL).arg(ec.message());
         }
     }
+
+    // Persistent connections would otherwise stay open; close them, too.
+    for (Connections::const_iterator it = connections_->begin();
+         it != connections_->end(); ++it) {
+        const boost::shared_ptr<Connection> conn = it->lock();
+        if (conn) {
+            conn->close();
+        }
+    }
+    connections_->clear();
 }
 /// Post this coroutine on the ASIO service queue so that it will
 /// resume processing where it left off.  The 'done' parameter indicates
@@ -21,6 +21,9 @@
 
 #include <boost/shared_array.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include <list>
 
 #include <asiolink/asiolink.h>
 #include <coroutine.h>
@@ -35,6 +38,16 @@ namespace asiodns {
 ///
 /// This class inherits from both \c DNSServer and from \c coroutine,
 /// defined in coroutine.h.
+///
+/// Connections are persistent: after a query is read, the server forks a
+/// coroutine to look it up and goes on reading the next query on the same
+/// connection, up to a configurable number of queries in flight (see
+/// \c setTCPMaxInFlight()).  Responses are sent in the order the lookups
+/// complete, which may differ from the order of the queries; responses
+/// that become ready while another one is being sent are coalesced into a
+/// single gathered write.  The connection is closed when the client closes
+/// it, or when it's idle (no query being read or answered) for the
+/// receive timeout.
 class TCPServer : public virtual DNSServer, public virtual coroutine {
 public:
     /// \brief Constructor
@@ -69,6 +82,20 @@ public:
         *tcp_recv_timeout_ = timeout;
     }
 
+    /// \brief Set the maximum number of queries in flight per connection
+    ///
+    /// When this number of queries read from a connection are still being
+    /// looked up or answered, the server stops reading the connection until
+    /// one of them is done.  The value 1 means the queries are handled one
+    /// by one.  This applies to existing connections, too.
+    ///
+    /// \throw bundy::InvalidParameter max_in_flight is 0
+    /// \param max_in_flight The maximum number of queries in flight
+    virtual void setTCPMaxInFlight(size_t max_in_flight);
+
+    /// \brief Return the maximum number of queries in flight per connection
+    size_t getTCPMaxInFlight() const { return (*tcp_max_in_flight_); }
+
 private:
     enum { MAX_LENGTH = 65535 };
     static const size_t TCP_MESSAGE_LENGTHSIZE = 2;
@@ -129,16 +156,28 @@ private:
     boost::shared_ptr<bundy::asiolink::IOEndpoint> peer_;
     boost::shared_ptr<bundy::asiolink::IOSocket> iosock_;
 
-    // Timer used to timeout on tcp connections
-    // This is a shared pointer because we need to have something
-    // that outlives the operator() call and is copyable (for CORO_FORK)
-    // even though it is only set after fork
-    boost::shared_ptr<asio::deadline_timer> timeout_;
-
-    // Timeout value to use in the timer;
+    // Timeout value to use in the idle timer of connections;
     // this, too, is a pointer, so that it can be updated whithout restarting
     // the server
     boost::shared_ptr<size_t> tcp_recv_timeout_;
+
+    // The maximum number of queries in flight per connection; a pointer
+    // for the same reason as tcp_recv_timeout_.
+    boost::shared_ptr<size_t> tcp_max_in_flight_;
+
+    // The state of an accepted connection shared by the coroutine reading
+    // it and those handling its queries: the idle timer, the number of
+    // queries in flight and the responses to be written.  It's only set
+    // after fork.  Defined in the implementation.
+    class Connection;
+    boost::shared_ptr<Connection> conn_;
+
+    // All open connections, so that stop() can close them.
+    typedef std::list<boost::weak_ptr<Connection> > Connections;
+    boost::shared_ptr<Connections> connections_;
+
+    // The wheel driving the idle timers of all connections.
+    boost::shared_ptr<bundy::asiolink::TimerWheel> timer_wheel_;
 };
 
 } // namespace asiodns
@@ -24,6 +24,7 @@
 #include <asiodns/dns_answer.h>
 #include <asiodns/dns_lookup.h>
 #include <string>
+#include <vector>
 #include <cstring>
 #include <cerrno>
 #include <csignal>
@@ -694,6 +695,169 @@ TYPED_TEST(DNSServerTest, stopTCPServeMoreThanOnce) {
     EXPECT_TRUE(this->serverStopSucceed());
 }
 
+// Check the limit of TCP queries in flight can be set and is validated.
+TEST_F(AsyncServerTest, tcpMaxInFlight) {
+    EXPECT_EQ(16, tcp_server_->getTCPMaxInFlight());
+    EXPECT_THROW(tcp_server_->setTCPMaxInFlight(0), bundy::InvalidParameter);
+    EXPECT_EQ(16, tcp_server_->getTCPMaxInFlight());
+    tcp_server_->setTCPMaxInFlight(1);
+    EXPECT_EQ(1, tcp_server_->getTCPMaxInFlight());
+}
+
+// Multiple queries sent over a single TCP connection without waiting for
+// the answers are all answered on that connection.  The limit of queries
+// in flight is lower than the number of queries, so that the reading is
+// paused and resumed in the middle.
+TEST_F(AsyncServerTest, pipelinedTCPQueries) {
+    tcp_server_->setTCPMaxInFlight(2);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET6;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICSERV | AI_NUMERICHOST;
+    struct addrinfo* res;
+    ASSERT_EQ(0, getaddrinfo(server_ip, server_port_str, &hints, &res));
+    const int sock = socket(res->ai_family, res->ai_socktype, 0);
+    ASSERT_NE(-1, sock);
+    (*tcp_server_)();
+    // The connection is established in the kernel even before the server
+    // accepts it, so we can do this synchronously.
+    ASSERT_EQ(0, connect(sock, res->ai_addr, res->ai_addrlen));
+    freeaddrinfo(res);
+
+    // Send all queries at once; each is 2 bytes of data.
+    static const size_t QUERY_COUNT = 5;
+    std::vector<uint8_t> queries;
+    for (size_t i = 0; i < QUERY_COUNT; ++i) {
+        queries.push_back(0);
+        queries.push_back(2);
+        queries.push_back(42);
+        queries.push_back(i);
+    }
+    ASSERT_EQ(queries.size(), send(sock, &queries[0], queries.size(), 0));
+
+    // Run the server until all answers arrive (or give up after a while).
+    std::vector<uint8_t> answers;
+    for (size_t count = 0; count < 1000 && answers.size() < queries.size();
+         ++count) {
+        service.poll();
+        service.reset();
+        uint8_t buf[256];
+        const ssize_t cc = recv(sock, buf, sizeof(buf), MSG_DONTWAIT);
+        if (cc > 0) {
+            answers.insert(answers.end(), buf, buf + cc);
+        } else {
+            usleep(1000);
+        }
+    }
+
+    // The answers are copies of the queries.  Our lookup answers
+    // immediately, so they come in the same order.
+    EXPECT_TRUE(queries == answers);
+    close(sock);
+}
+
+// Check the limit of UDP queries handled at a time can be set and is
+// validated.
+TEST_F(AsyncServerTest, udpMaxOutstanding) {
+    EXPECT_EQ(1000, udp_server_->getMaxOutstanding());
+    EXPECT_THROW(udp_server_->setMaxOutstanding(0), bundy::InvalidParameter);
+    EXPECT_EQ(1000, udp_server_->getMaxOutstanding());
+    udp_server_->setMaxOutstanding(1);
+    EXPECT_EQ(1, udp_server_->getMaxOutstanding());
+    EXPECT_EQ(0, udp_server_->getOutstanding());
+}
+
+// \brief lookup keeping the servers, to resume them later (as a recursive
+// lookup does)
+class DeferredLookup : public DNSLookup {
+public:
+    virtual ~DeferredLookup() {
+        for (size_t i = 0; i < servers_.size(); ++i) {
+            delete servers_[i];
+        }
+    }
+    virtual void operator()(const IOMessage&, bundy::dns::MessagePtr,
+                            bundy::dns::MessagePtr,
+                            bundy::util::OutputBufferPtr,
+                            DNSServer* server) const
+    {
+        servers_.push_back(server->clone());
+    }
+    void resumeFirst() {
+        servers_.front()->resume(true);
+        delete servers_.front();
+        servers_.erase(servers_.begin());
+    }
+    mutable std::vector<DNSServer*> servers_;
+};
+
+// When as many UDP queries as allowed are being looked up, the server stops
+// receiving until one of them is answered.  The queries wait in the socket
+// meanwhile.
+TEST_F(AsyncServerTest, udpMaxOutstandingQueries) {
+    // A server of its own, on another port, with a lookup that doesn't
+    // answer at once.
+    ip::udp::socket server_socket(service,
+                                  ip::udp::endpoint(server_address_, 0));
+    const ip::udp::endpoint server(server_socket.local_endpoint());
+    const int fd = dup(server_socket.native());
+    ASSERT_NE(-1, fd);
+    server_socket.close();
+    DeferredLookup lookup;
+    UDPServer udp_server(service, fd, AF_INET6, &lookup, answer_);
+    udp_server.setMaxOutstanding(2);
+    udp_server();
+
+    ip::udp::socket client(service, ip::udp::v6());
+    for (size_t i = 0; i < 3; ++i) {
+        client.send_to(buffer(query_message, strlen(query_message) + 1),
+                       server);
+    }
+
+    // Run the server until the lookups are called (or give up after a
+    // while).
+    const size_t MAX_POLLS = 1000;
+    for (size_t count = 0; count < MAX_POLLS && lookup.servers_.size() < 2;
+         ++count) {
+        service.poll();
+        service.reset();
+        usleep(1000);
+    }
+    ASSERT_EQ(2, lookup.servers_.size());
+    EXPECT_EQ(2, udp_server.getOutstanding());
+    // No more queries are received.
+    service.poll();
+    service.reset();
+    EXPECT_EQ(2, lookup.servers_.size());
+
+    // Once a query is answered, the next one is received.
+    lookup.resumeFirst();
+    size_t answers = 0;
+    for (size_t count = 0; count < MAX_POLLS &&
+             (answers < 3 || udp_server.getOutstanding() > 0); ++count) {
+        service.poll();
+        service.reset();
+        if (!lookup.servers_.empty()) {
+            lookup.resumeFirst();
+        }
+        char buf[256];
+        ip::udp::endpoint sender;
+        asio::error_code ec;
+        if (client.available(ec) > 0) {
+            client.receive_from(buffer(buf, sizeof(buf)), sender, 0, ec);
+            EXPECT_EQ(std::string(query_message), buf);
+            ++answers;
+        } else {
+            usleep(1000);
+        }
+    }
+    EXPECT_EQ(3, answers);
+    EXPECT_EQ(0, udp_server.getOutstanding());
+    udp_server.stop();
+}
+
 // It raises an exception when invalid address family is passed
 // The parameter here doesn't mean anything
 TYPED_TEST(DNSServerTestBase, invalidFamily) {
@@ -756,6 +920,196 @@ TEST_F(SyncServerTest, nullLookupCallback) {
                  bundy::InvalidParameter);
 }
 
+// Check the UDP batch size can be set and is validated.
+TEST_F(SyncServerTest, udpBatchSize) {
+    EXPECT_EQ(1, udp_server_->getUDPBatchSize());
+    EXPECT_THROW(udp_server_->setUDPBatchSize(0), bundy::InvalidParameter);
+    EXPECT_THROW(udp_server_->setUDPBatchSize(
+                     DNSServiceBase::MAX_UDP_BATCH_SIZE + 1),
+                 bundy::InvalidParameter);
+    EXPECT_EQ(1, udp_server_->getUDPBatchSize());
+    udp_server_->setUDPBatchSize(DNSServiceBase::MAX_UDP_BATCH_SIZE);
+#if defined(HAVE_RECVMMSG) && defined(HAVE_SENDMMSG)
+    EXPECT_EQ(DNSServiceBase::MAX_UDP_BATCH_SIZE,
+              udp_server_->getUDPBatchSize());
+#else
+    // Not supported, so it's silently ignored.
+    EXPECT_EQ(1, udp_server_->getUDPBatchSize());
+#endif
+    udp_server_->setUDPBatchSize(1);
+    EXPECT_EQ(1, udp_server_->getUDPBatchSize());
+}
+
+// The same as stopUDPServerAfterOneQuery, but in the batched mode.
+TEST_F(SyncServerTest, batchedQuery) {
+    udp_server_->setUDPBatchSize(8);
+    testStopServerByStopper(*udp_server_, udp_client_, udp_client_);
+    EXPECT_EQ(query_message, udp_client_->getReceivedData());
+    EXPECT_TRUE(serverStopSucceed());
+}
+
+// Multiple queries that are already queued are all answered in a single
+// event in the batched mode.
+TEST_F(SyncServerTest, batchedMultipleQueries) {
+    udp_server_->setUDPBatchSize(4);
+    if (udp_server_->getUDPBatchSize() == 1) {
+        return;                 // batched I/O isn't supported.
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET6;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_NUMERICSERV | AI_NUMERICHOST;
+    struct addrinfo* res;
+    ASSERT_EQ(0, getaddrinfo(server_ip, server_port_str, &hints, &res));
+    const int sock = socket(res->ai_family, res->ai_socktype, 0);
+    ASSERT_NE(-1, sock);
+
+    // Send more queries than the batch size; they are queued on the socket
+    // as nobody is reading there yet.
+    static const size_t QUERY_COUNT = 6;
+    for (size_t i = 0; i < QUERY_COUNT; ++i) {
+        const uint8_t data[2] = { 42, static_cast<uint8_t>(i) };
+        EXPECT_EQ(sizeof(data), sendto(sock, data, sizeof(data), 0,
+                                       res->ai_addr, res->ai_addrlen));
+    }
+    freeaddrinfo(res);
+
+    // The first event handles up to the batch size, and the next one
+    // handles the rest.
+    (*udp_server_)();
+    EXPECT_EQ(1, service.run_one());
+    EXPECT_EQ(1, service.run_one());
+
+    for (size_t i = 0; i < QUERY_COUNT; ++i) {
+        uint8_t received[2];
+        EXPECT_EQ(sizeof(received), recv(sock, received, sizeof(received),
+                                         MSG_DONTWAIT)) << i;
+        EXPECT_EQ(i, received[1]);
+    }
+    close(sock);
+}
+
+// The batch size can be lowered to 1 while a batched read is pending.
+TEST_F(SyncServerTest, batchSizeChangedWhileReading) {
+    udp_server_->setUDPBatchSize(4);
+    if (udp_server_->getUDPBatchSize() == 1) {
+        return;                 // batched I/O isn't supported.
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET6;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_NUMERICSERV | AI_NUMERICHOST;
+    struct addrinfo* res;
+    ASSERT_EQ(0, getaddrinfo(server_ip, server_port_str, &hints, &res));
+    const int sock = socket(res->ai_family, res->ai_socktype, 0);
+    ASSERT_NE(-1, sock);
+
+    // The server waits for the socket to be readable in the batched mode
+    // when the size is changed.
+    (*udp_server_)();
+    udp_server_->setUDPBatchSize(1);
+    EXPECT_EQ(1, udp_server_->getUDPBatchSize());
+
+    // The pending read handles the first query, and the next one is read
+    // one datagram at a time.
+    for (size_t i = 0; i < 2; ++i) {
+        const uint8_t data[2] = { 42, static_cast<uint8_t>(i) };
+        EXPECT_EQ(sizeof(data), sendto(sock, data, sizeof(data), 0,
+                                       res->ai_addr, res->ai_addrlen));
+        EXPECT_EQ(1, service.run_one());
+        uint8_t received[2];
+        EXPECT_EQ(sizeof(received), recv(sock, received, sizeof(received),
+                                         0)) << i;
+        EXPECT_EQ(i, received[1]);
+    }
+    freeaddrinfo(res);
+    close(sock);
+}
+
+// A lookup that takes some time for each query and records whether the
+// server was overloaded then.
+class SlowLookup : public DNSLookup {
+public:
+    SlowLookup(useconds_t delay) : delay_(delay) {}
+    virtual void operator()(const IOMessage&, bundy::dns::MessagePtr,
+                            bundy::dns::MessagePtr,
+                            bundy::util::OutputBufferPtr,
+                            DNSServer* server) const
+    {
+        overloaded_.push_back(server->isOverloaded());
+        usleep(delay_);
+        server->resume(false);
+    }
+    const useconds_t delay_;
+    mutable std::vector<bool> overloaded_;
+};
+
+// The server becomes overloaded while queries wait longer than the
+// threshold, and recovers once it has caught up.
+TEST_F(SyncServerTest, overload) {
+    // Use a separate server with the slow lookup on an ephemeral port.
+    const int fd = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+    ASSERT_NE(-1, fd);
+    struct sockaddr_in6 addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin6_family = AF_INET6;
+    addr.sin6_addr = in6addr_loopback;
+    socklen_t addr_len = sizeof(addr);
+    ASSERT_EQ(0, bind(fd, reinterpret_cast<sockaddr*>(&addr), addr_len));
+    ASSERT_EQ(0, getsockname(fd, reinterpret_cast<sockaddr*>(&addr),
+                             &addr_len));
+    SlowLookup lookup(2000);
+    const SyncUDPServerPtr server(SyncUDPServer::create(service, fd,
+                                                        AF_INET6, &lookup));
+    EXPECT_FALSE(server->isOverloaded());
+    server->setUDPOverloadLatency(1000);
+
+    const int sock = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+    ASSERT_NE(-1, sock);
+    static const size_t QUERY_COUNT = 4;
+    for (size_t i = 0; i < QUERY_COUNT; ++i) {
+        const uint8_t data[2] = { 42, static_cast<uint8_t>(i) };
+        EXPECT_EQ(sizeof(data),
+                  sendto(sock, data, sizeof(data), 0,
+                         reinterpret_cast<sockaddr*>(&addr), addr_len));
+    }
+
+    // The first query takes longer than the threshold while the others
+    // wait, so the server is overloaded for them.  The last one leaves
+    // the socket empty.
+    (*server)();
+    for (size_t i = 0; i < QUERY_COUNT; ++i) {
+        EXPECT_EQ(1, service.run_one());
+    }
+    ASSERT_EQ(QUERY_COUNT, lookup.overloaded_.size());
+    EXPECT_FALSE(lookup.overloaded_[0]);
+    for (size_t i = 1; i < QUERY_COUNT; ++i) {
+        EXPECT_TRUE(lookup.overloaded_[i]) << i;
+    }
+    EXPECT_FALSE(server->isOverloaded());
+
+    // With the detection disabled, it never becomes overloaded.
+    server->setUDPOverloadLatency(0);
+    lookup.overloaded_.clear();
+    for (size_t i = 0; i < QUERY_COUNT; ++i) {
+        const uint8_t data[2] = { 42, static_cast<uint8_t>(i) };
+        EXPECT_EQ(sizeof(data),
+                  sendto(sock, data, sizeof(data), 0,
+                         reinterpret_cast<sockaddr*>(&addr), addr_len));
+    }
+    for (size_t i = 0; i < QUERY_COUNT; ++i) {
+        EXPECT_EQ(1, service.run_one());
+    }
+    EXPECT_EQ(std::vector<bool>(QUERY_COUNT, false), lookup.overloaded_);
+
+    server->stop();
+    close(sock);
+}
+
 TEST_F(SyncServerTest, resetUDPServerBeforeEvent) {
     // Reset the UDP server object after starting and before it would get
     // an event from io_service (in this case abort event).  The following
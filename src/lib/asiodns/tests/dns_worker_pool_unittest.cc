@@ -0,0 +1,385 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+#include <gtest/gtest.h>
+
+#include <asio.hpp>
+#include <asiolink/asiolink.h>
+#include <asiodns/asiodns.h>
+#include <asiodns/dns_worker_pool.h>
+
+#include <util/buffer.h>
+#include <util/threads/affinity.h>
+
+#include <boost/bind.hpp>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace bundy::asiolink;
+using namespace bundy::asiodns;
+using bundy::util::thread::getCurrentThreadAffinity;
+using bundy::util::thread::isAffinitySupported;
+
+namespace {
+const uint16_t TEST_SERVER_PORT = 53536;
+const char* const TEST_IPV4_ADDR = "127.0.0.1";
+
+// A lookup callback that simply echoes the received data back.
+class EchoLookup : public DNSLookup {
+public:
+    void operator()(const IOMessage& io_message, bundy::dns::MessagePtr,
+                    bundy::dns::MessagePtr,
+                    bundy::util::OutputBufferPtr buffer,
+                    DNSServer* server) const
+    {
+        buffer->writeData(io_message.getData(), io_message.getDataSize());
+        server->resume(true);
+    }
+};
+
+// A lookup callback that answers with the CPUs its thread may run on,
+// as a list of bytes.
+class AffinityLookup : public DNSLookup {
+public:
+    void operator()(const IOMessage&, bundy::dns::MessagePtr,
+                    bundy::dns::MessagePtr,
+                    bundy::util::OutputBufferPtr buffer,
+                    DNSServer* server) const
+    {
+        const std::vector<int> cpus = getCurrentThreadAffinity();
+        for (size_t i = 0; i < cpus.size() && i < 256; ++i) {
+            buffer->writeUint8(cpus[i]);
+        }
+        server->resume(true);
+    }
+};
+
+// A minimal main service, which only records what's given.  It doesn't
+// serve anything, so all answers must come from worker threads.
+class TestMainService : public DNSServiceBase {
+public:
+    TestMainService() :
+        tcp_count_(0), clear_count_(0), tcp_timeout_(0), udp_batch_size_(1),
+        tcp_max_in_flight_(0), udp_overload_latency_(0)
+    {}
+    virtual void addServerTCPFromFD(int, int) { ++tcp_count_; }
+    virtual void addServerUDPFromFD(int fd, int, ServerFlag) {
+        udp_fds_.push_back(fd);
+    }
+    virtual void clearServers() {
+        ++clear_count_;
+        udp_fds_.clear();
+    }
+    virtual void setTCPRecvTimeout(size_t timeout) { tcp_timeout_ = timeout; }
+    virtual void setUDPBatchSize(size_t batch_size) {
+        udp_batch_size_ = batch_size;
+    }
+    virtual void setTCPMaxInFlight(size_t max_in_flight) {
+        tcp_max_in_flight_ = max_in_flight;
+    }
+    virtual void setUDPOverloadLatency(size_t latency) {
+        udp_overload_latency_ = latency;
+    }
+    virtual IOService& getIOService() { return (io_service_); }
+
+    IOService io_service_;
+    size_t tcp_count_;
+    size_t clear_count_;
+    size_t tcp_timeout_;
+    size_t udp_batch_size_;
+    size_t tcp_max_in_flight_;
+    size_t udp_overload_latency_;
+    std::vector<int> udp_fds_;
+};
+
+class DNSWorkerPoolTest : public ::testing::Test {
+protected:
+    DNSWorkerPoolTest() :
+        lookups_created_(0), report_affinity_(false),
+        pool_(main_service_,
+              boost::bind(&DNSWorkerPoolTest::createLookup, this), NULL),
+        server_fd_(-1), client_fd_(-1)
+    {
+        std::memset(&server_addr_, 0, sizeof(server_addr_));
+        server_addr_.sin_family = AF_INET;
+        server_addr_.sin_port = htons(TEST_SERVER_PORT);
+        inet_pton(AF_INET, TEST_IPV4_ADDR, &server_addr_.sin_addr);
+    }
+
+    ~DNSWorkerPoolTest() {
+        pool_.stop();
+        if (server_fd_ >= 0) {
+            close(server_fd_);
+        }
+        if (client_fd_ >= 0) {
+            close(client_fd_);
+        }
+    }
+
+    DNSLookup* createLookup() {
+        ++lookups_created_;
+        if (report_affinity_) {
+            return (new AffinityLookup);
+        }
+        return (new EchoLookup);
+    }
+
+    // Open the server-side socket and the client socket to talk to it.
+    void openSockets() {
+        server_fd_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        ASSERT_LE(0, server_fd_);
+        ASSERT_EQ(0, bind(server_fd_,
+                          reinterpret_cast<const sockaddr*>(&server_addr_),
+                          sizeof(server_addr_)));
+        client_fd_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        ASSERT_LE(0, client_fd_);
+        // Don't let a bug hang up the test
+        struct timeval tv = { 5, 0 };
+        ASSERT_EQ(0, setsockopt(client_fd_, SOL_SOCKET, SO_RCVTIMEO, &tv,
+                                sizeof(tv)));
+    }
+
+    // Send some data to the server and see it's echoed back.
+    void checkEcho(uint8_t seq) {
+        const uint8_t data[4] = { 1, 2, 3, seq };
+        ASSERT_EQ(sizeof(data),
+                  sendto(client_fd_, data, sizeof(data), 0,
+                         reinterpret_cast<const sockaddr*>(&server_addr_),
+                         sizeof(server_addr_)));
+        uint8_t received[sizeof(data) * 2];
+        ASSERT_EQ(sizeof(data), recv(client_fd_, received, sizeof(received),
+                                     0));
+        EXPECT_EQ(0, std::memcmp(data, received, sizeof(data)));
+    }
+
+    // Send a query to the server and return the CPUs of the worker which
+    // answered it, as reported by AffinityLookup.
+    std::vector<int> getWorkerAffinity() {
+        const uint8_t data[1] = { 0 };
+        EXPECT_EQ(sizeof(data),
+                  sendto(client_fd_, data, sizeof(data), 0,
+                         reinterpret_cast<const sockaddr*>(&server_addr_),
+                         sizeof(server_addr_)));
+        uint8_t received[256];
+        const ssize_t len = recv(client_fd_, received, sizeof(received), 0);
+        EXPECT_LT(0, len);
+        return (std::vector<int>(received, received + std::max<ssize_t>(len,
+                                                                        0)));
+    }
+
+    size_t lookups_created_;
+    bool report_affinity_;
+    TestMainService main_service_;
+    DNSWorkerPool pool_;
+    int server_fd_;
+    int client_fd_;
+    sockaddr_in server_addr_;
+};
+
+TEST_F(DNSWorkerPoolTest, noWorker) {
+    // By default there's no worker, and the pool is just a wrapper of the
+    // main service.
+    EXPECT_EQ(0, pool_.getWorkerCount());
+    pool_.addServerTCPFromFD(10, AF_INET);
+    pool_.addServerUDPFromFD(11, AF_INET, DNSService::SERVER_SYNC_OK);
+    pool_.setTCPRecvTimeout(1000);
+    pool_.setTCPMaxInFlight(4);
+    pool_.start();
+    EXPECT_FALSE(pool_.isRunning());
+    EXPECT_EQ(0, lookups_created_);
+    EXPECT_EQ(1, main_service_.tcp_count_);
+    ASSERT_EQ(1, main_service_.udp_fds_.size());
+    EXPECT_EQ(11, main_service_.udp_fds_[0]);
+    EXPECT_EQ(1000, main_service_.tcp_timeout_);
+    EXPECT_EQ(4, main_service_.tcp_max_in_flight_);
+    EXPECT_EQ(&main_service_.io_service_, &pool_.getIOService());
+
+    pool_.clearServers();
+    EXPECT_EQ(1, main_service_.clear_count_);
+    EXPECT_TRUE(main_service_.udp_fds_.empty());
+}
+
+TEST_F(DNSWorkerPoolTest, noServer) {
+    // Workers won't start until there's something to serve.
+    pool_.setWorkerCount(2);
+    pool_.start();
+    EXPECT_FALSE(pool_.isRunning());
+    EXPECT_EQ(0, lookups_created_);
+}
+
+TEST_F(DNSWorkerPoolTest, serve) {
+    openSockets();
+    pool_.setWorkerCount(2);
+    pool_.addServerUDPFromFD(server_fd_, AF_INET, DNSService::SERVER_SYNC_OK);
+    EXPECT_FALSE(pool_.isRunning());
+    pool_.start();
+    EXPECT_TRUE(pool_.isRunning());
+    EXPECT_EQ(2, lookups_created_);
+    // The main service still gets the original descriptor.
+    ASSERT_EQ(1, main_service_.udp_fds_.size());
+    EXPECT_EQ(server_fd_, main_service_.udp_fds_[0]);
+
+    // Nobody reads on the main service, so these must be handled by workers.
+    for (uint8_t i = 0; i < 10; ++i) {
+        checkEcho(i);
+    }
+
+    // Starting it again is a no-op.
+    pool_.start();
+    EXPECT_EQ(2, lookups_created_);
+
+    // Changing the count restarts workers, creating new lookups.
+    pool_.setWorkerCount(3);
+    EXPECT_TRUE(pool_.isRunning());
+    EXPECT_EQ(5, lookups_created_);
+    checkEcho(10);
+
+    // Stopping the workers doesn't affect the original socket.
+    pool_.stop();
+    EXPECT_FALSE(pool_.isRunning());
+    EXPECT_LE(0, fcntl(server_fd_, F_GETFD));
+
+    // And they can be restarted.
+    pool_.start();
+    EXPECT_TRUE(pool_.isRunning());
+    checkEcho(11);
+
+    // Adding a new server stops the workers until they are started again.
+    pool_.addServerTCPFromFD(10, AF_INET);
+    EXPECT_TRUE(pool_.isRunning());
+    pool_.addServerUDPFromFD(server_fd_, AF_INET, DNSService::SERVER_SYNC_OK);
+    EXPECT_FALSE(pool_.isRunning());
+
+    // Clearing servers also stops workers, and start() is now no-op.
+    pool_.start();
+    EXPECT_TRUE(pool_.isRunning());
+    pool_.clearServers();
+    EXPECT_FALSE(pool_.isRunning());
+    pool_.start();
+    EXPECT_FALSE(pool_.isRunning());
+}
+
+TEST_F(DNSWorkerPoolTest, udpBatchSize) {
+    openSockets();
+    pool_.setWorkerCount(2);
+    pool_.addServerUDPFromFD(server_fd_, AF_INET, DNSService::SERVER_SYNC_OK);
+    pool_.start();
+    EXPECT_EQ(2, lookups_created_);
+
+    // The batch size is passed to the main service, and the workers are
+    // restarted to use it too.
+    pool_.setUDPBatchSize(16);
+    EXPECT_EQ(16, main_service_.udp_batch_size_);
+    EXPECT_TRUE(pool_.isRunning());
+    EXPECT_EQ(4, lookups_created_);
+    checkEcho(0);
+
+    // Setting the same size doesn't restart them.
+    pool_.setUDPBatchSize(16);
+    EXPECT_EQ(4, lookups_created_);
+
+    // An invalid value is rejected without affecting anything.
+    EXPECT_THROW(pool_.setUDPBatchSize(0), bundy::InvalidParameter);
+    EXPECT_THROW(pool_.setUDPBatchSize(DNSService::MAX_UDP_BATCH_SIZE + 1),
+                 bundy::InvalidParameter);
+    EXPECT_EQ(16, main_service_.udp_batch_size_);
+    EXPECT_TRUE(pool_.isRunning());
+    EXPECT_EQ(4, lookups_created_);
+}
+
+TEST_F(DNSWorkerPoolTest, udpOverloadLatency) {
+    openSockets();
+    pool_.setWorkerCount(2);
+    pool_.addServerUDPFromFD(server_fd_, AF_INET, DNSService::SERVER_SYNC_OK);
+    pool_.start();
+    EXPECT_EQ(2, lookups_created_);
+
+    // Like the batch size, the value is passed to the main service, and
+    // the workers are restarted to use it too.
+    pool_.setUDPOverloadLatency(1000);
+    EXPECT_EQ(1000, main_service_.udp_overload_latency_);
+    EXPECT_TRUE(pool_.isRunning());
+    EXPECT_EQ(4, lookups_created_);
+    checkEcho(0);
+
+    pool_.setUDPOverloadLatency(1000);
+    EXPECT_EQ(4, lookups_created_);
+}
+
+TEST_F(DNSWorkerPoolTest, workerCPUs) {
+    report_affinity_ = true;
+    openSockets();
+    pool_.setWorkerCount(2);
+    pool_.addServerUDPFromFD(server_fd_, AF_INET, DNSService::SERVER_SYNC_OK);
+    EXPECT_TRUE(pool_.getWorkerCPUs().empty());
+    pool_.start();
+    EXPECT_EQ(2, lookups_created_);
+
+    // Bind both workers to the first CPU we may run on.  The workers are
+    // restarted.
+    const std::vector<int> allowed = getCurrentThreadAffinity();
+    ASSERT_FALSE(allowed.empty());
+    const std::vector<int> cpus(1, allowed.front());
+    pool_.setWorkerCPUs(cpus);
+    EXPECT_EQ(cpus, pool_.getWorkerCPUs());
+    EXPECT_TRUE(pool_.isRunning());
+    EXPECT_EQ(4, lookups_created_);
+    if (isAffinitySupported()) {
+        for (int i = 0; i < 4; ++i) {
+            EXPECT_EQ(cpus, getWorkerAffinity());
+        }
+    }
+
+    // Setting the same list doesn't restart them.
+    pool_.setWorkerCPUs(cpus);
+    EXPECT_EQ(4, lookups_created_);
+
+    // A negative CPU is rejected without affecting anything.
+    EXPECT_THROW(pool_.setWorkerCPUs(std::vector<int>(1, -1)),
+                 bundy::InvalidParameter);
+    EXPECT_EQ(cpus, pool_.getWorkerCPUs());
+    EXPECT_EQ(4, lookups_created_);
+
+    // A CPU which doesn't exist is only logged, and the workers still run
+    // unbound.
+    pool_.setWorkerCPUs(std::vector<int>(1, 1000000));
+    EXPECT_TRUE(pool_.isRunning());
+    EXPECT_EQ(allowed, getWorkerAffinity());
+
+    // An empty list unbinds them.
+    pool_.setWorkerCPUs(std::vector<int>());
+    EXPECT_EQ(allowed, getWorkerAffinity());
+}
+
+TEST_F(DNSWorkerPoolTest, badDescriptor) {
+    // If the socket can't be duplicated, start() fails and nothing runs.
+    pool_.setWorkerCount(2);
+    pool_.addServerUDPFromFD(-1, AF_INET, DNSService::SERVER_SYNC_OK);
+    EXPECT_THROW(pool_.start(), IOError);
+    EXPECT_FALSE(pool_.isRunning());
+}
+
+}
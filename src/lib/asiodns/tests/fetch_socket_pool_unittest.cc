@@ -0,0 +1,291 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+#include <gtest/gtest.h>
+
+#include <asio.hpp>
+#include <asiolink/io_address.h>
+#include <asiolink/io_service.h>
+#include <asiodns/fetch_socket_pool.h>
+#include <asiodns/io_fetch.h>
+
+#include <dns/message.h>
+#include <dns/name.h>
+#include <dns/question.h>
+#include <dns/rrclass.h>
+#include <dns/rrtype.h>
+#include <exceptions/exceptions.h>
+#include <util/buffer.h>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <set>
+#include <vector>
+
+using namespace bundy::asiolink;
+using namespace bundy::asiodns;
+using namespace bundy::dns;
+using bundy::util::OutputBuffer;
+using bundy::util::OutputBufferPtr;
+using asio::ip::tcp;
+using asio::ip::udp;
+
+namespace {
+const char* const TEST_ADDR = "127.0.0.1";
+const uint16_t TEST_PORT = 53537;
+const int FETCH_TIMEOUT = 2000;
+
+// A server answering each query with itself (with the QR bit set), over
+// UDP and TCP, and the fetches sent to it.
+class FetchSocketPoolTest : public ::testing::Test, public IOFetch::Callback {
+protected:
+    FetchSocketPoolTest() :
+        udp_socket_(service_.get_io_service(),
+                    udp::endpoint(asio::ip::address::from_string(TEST_ADDR),
+                                  TEST_PORT)),
+        acceptor_(service_.get_io_service(),
+                  tcp::endpoint(asio::ip::address::from_string(TEST_ADDR),
+                                TEST_PORT)),
+        timer_(service_.get_io_service()),
+        spoof_(false), tcp_accepts_(0), fetches_(0)
+    {
+        udp_socket_.async_receive_from(
+            asio::buffer(udp_buffer_, sizeof(udp_buffer_)), udp_sender_,
+            boost::bind(&FetchSocketPoolTest::udpReceived, this, _1, _2));
+        startAccept();
+    }
+
+    // Send a fetch for the given name using the pool.
+    void fetch(FetchSocketPool& pool, IOFetch::Protocol protocol,
+               const char* name)
+    {
+        const OutputBufferPtr buffer(new OutputBuffer(512));
+        buffers_.push_back(buffer);
+        IOFetch fetch(protocol, service_,
+                      Question(Name(name), RRClass::IN(), RRType::A()),
+                      IOAddress(TEST_ADDR), TEST_PORT, buffers_.back(), this,
+                      FETCH_TIMEOUT);
+        fetch.setSocketPool(pool);
+        service_.get_io_service().post(fetch);
+        ++fetches_;
+    }
+
+    // Run until all fetches are done.
+    void run() {
+        runFor(5000);
+    }
+
+    // Run for the given time (in milliseconds), or until stopped.
+    void runFor(long msec) {
+        timer_.expires_from_now(boost::posix_time::milliseconds(msec));
+        timer_.async_wait(boost::bind(&FetchSocketPoolTest::timedOut, this,
+                                      _1));
+        service_.run();
+        service_.get_io_service().reset();
+        timer_.cancel();
+    }
+
+    void timedOut(const asio::error_code& ec) {
+        if (!ec) {
+            service_.stop();
+        }
+    }
+
+    virtual void operator()(IOFetch::Result result) {
+        results_.push_back(result);
+        if (--fetches_ == 0) {
+            service_.stop();
+        }
+    }
+
+    void udpReceived(const asio::error_code& ec, size_t len) {
+        if (ec) {
+            return;
+        }
+        udp_ports_.insert(udp_sender_.port());
+        udp_buffer_[2] |= 0x80;
+        if (spoof_) {
+            // A response with the same ID for another question first; it
+            // must be ignored.
+            std::vector<uint8_t> spoofed(udp_buffer_, udp_buffer_ + len);
+            spoofed[13] ^= 0x01;
+            udp_socket_.send_to(asio::buffer(spoofed), udp_sender_);
+        }
+        udp_socket_.send_to(asio::buffer(udp_buffer_, len), udp_sender_);
+        udp_socket_.async_receive_from(
+            asio::buffer(udp_buffer_, sizeof(udp_buffer_)), udp_sender_,
+            boost::bind(&FetchSocketPoolTest::udpReceived, this, _1, _2));
+    }
+
+    // A TCP connection accepted by the server.
+    struct TCPConnection {
+        TCPConnection(asio::io_service& io) : socket(io) {}
+        tcp::socket socket;
+        uint8_t length[2];
+        std::vector<uint8_t> data;
+    };
+    typedef boost::shared_ptr<TCPConnection> TCPConnectionPtr;
+
+    void startAccept() {
+        const TCPConnectionPtr conn(
+            new TCPConnection(service_.get_io_service()));
+        acceptor_.async_accept(conn->socket,
+                               boost::bind(&FetchSocketPoolTest::accepted,
+                                           this, conn, _1));
+    }
+
+    void accepted(TCPConnectionPtr conn, const asio::error_code& ec) {
+        if (ec) {
+            return;
+        }
+        ++tcp_accepts_;
+        tcp_connections_.push_back(conn);
+        startTCPRead(conn);
+        startAccept();
+    }
+
+    void startTCPRead(TCPConnectionPtr conn) {
+        asio::async_read(conn->socket, asio::buffer(conn->length),
+                         boost::bind(&FetchSocketPoolTest::lengthRead, this,
+                                     conn, _1));
+    }
+
+    void lengthRead(TCPConnectionPtr conn, const asio::error_code& ec) {
+        if (ec) {
+            return;
+        }
+        conn->data.resize((conn->length[0] << 8) | conn->length[1]);
+        asio::async_read(conn->socket, asio::buffer(conn->data),
+                         boost::bind(&FetchSocketPoolTest::queryRead, this,
+                                     conn, _1));
+    }
+
+    // The answer is sent synchronously, which is good enough here.
+    void queryRead(TCPConnectionPtr conn, const asio::error_code& ec) {
+        if (ec) {
+            return;
+        }
+        conn->data[2] |= 0x80;
+        asio::write(conn->socket, asio::buffer(conn->length));
+        asio::write(conn->socket, asio::buffer(conn->data));
+        startTCPRead(conn);
+    }
+
+    IOService service_;
+    udp::socket udp_socket_;
+    udp::endpoint udp_sender_;
+    uint8_t udp_buffer_[512];
+    tcp::acceptor acceptor_;
+    std::vector<TCPConnectionPtr> tcp_connections_;
+    asio::deadline_timer timer_;
+    bool spoof_;
+    std::set<uint16_t> udp_ports_;
+    size_t tcp_accepts_;
+    size_t fetches_;
+    std::vector<OutputBufferPtr> buffers_;
+    std::vector<IOFetch::Result> results_;
+};
+
+TEST_F(FetchSocketPoolTest, badParameters) {
+    EXPECT_THROW(FetchSocketPool(service_, 0), bundy::BadValue);
+    EXPECT_THROW(FetchSocketPool(service_, 1, 0), bundy::BadValue);
+    EXPECT_THROW(FetchSocketPool(service_, 1, 1, 0), bundy::BadValue);
+    EXPECT_THROW(FetchSocketPool(service_, 1, 1, -1), bundy::BadValue);
+}
+
+TEST_F(FetchSocketPoolTest, udpFetches) {
+    FetchSocketPool pool(service_, 1);
+    EXPECT_EQ(0, pool.getUDPSocketCount());
+
+    // All queries are sent from the only socket, at the same time.
+    fetch(pool, IOFetch::UDP, "a.example.org");
+    fetch(pool, IOFetch::UDP, "b.example.org");
+    fetch(pool, IOFetch::UDP, "c.example.org");
+    run();
+    ASSERT_EQ(3, results_.size());
+    for (size_t i = 0; i < results_.size(); ++i) {
+        EXPECT_EQ(IOFetch::SUCCESS, results_[i]);
+    }
+    EXPECT_EQ(1, pool.getUDPSocketCount());
+    ASSERT_EQ(1, udp_ports_.size());
+    EXPECT_LE(1024, *udp_ports_.begin());
+
+    // The socket is still used for later queries, until the pool is
+    // cleared.
+    fetch(pool, IOFetch::UDP, "d.example.org");
+    run();
+    EXPECT_EQ(1, udp_ports_.size());
+    pool.clear();
+    EXPECT_EQ(0, pool.getUDPSocketCount());
+}
+
+TEST_F(FetchSocketPoolTest, udpSocketReplaced) {
+    // Each socket is used for one query only.
+    FetchSocketPool pool(service_, 1, 1);
+    fetch(pool, IOFetch::UDP, "a.example.org");
+    run();
+    fetch(pool, IOFetch::UDP, "b.example.org");
+    run();
+    EXPECT_EQ(2, results_.size());
+    EXPECT_EQ(1, pool.getUDPSocketCount());
+}
+
+TEST_F(FetchSocketPoolTest, udpResponseMatching) {
+    // The response for a different question is ignored; the fetch gets the
+    // right one.
+    spoof_ = true;
+    FetchSocketPool pool(service_);
+    fetch(pool, IOFetch::UDP, "a.example.org");
+    fetch(pool, IOFetch::UDP, "b.example.org");
+    run();
+    ASSERT_EQ(2, results_.size());
+    EXPECT_EQ(IOFetch::SUCCESS, results_[0]);
+    EXPECT_EQ(IOFetch::SUCCESS, results_[1]);
+    Message response(Message::PARSE);
+    bundy::util::InputBuffer ib(buffers_[0]->getData(),
+                                buffers_[0]->getLength());
+    response.fromWire(ib);
+    EXPECT_EQ(Name("a.example.org"), (*response.beginQuestion())->getName());
+}
+
+TEST_F(FetchSocketPoolTest, tcpFetches) {
+    FetchSocketPool pool(service_, FetchSocketPool::DEFAULT_UDP_SOCKETS,
+                         FetchSocketPool::DEFAULT_UDP_SOCKET_USES, 100);
+
+    // All queries are sent over a single connection.
+    fetch(pool, IOFetch::TCP, "a.example.org");
+    fetch(pool, IOFetch::TCP, "b.example.org");
+    fetch(pool, IOFetch::TCP, "c.example.org");
+    EXPECT_EQ(0, pool.getTCPConnectionCount());
+    run();
+    ASSERT_EQ(3, results_.size());
+    for (size_t i = 0; i < results_.size(); ++i) {
+        EXPECT_EQ(IOFetch::SUCCESS, results_[i]);
+    }
+    EXPECT_EQ(1, tcp_accepts_);
+    EXPECT_EQ(1, pool.getTCPConnectionCount());
+
+    // It's reused for later ones.
+    fetch(pool, IOFetch::TCP, "d.example.org");
+    run();
+    EXPECT_EQ(4, results_.size());
+    EXPECT_EQ(1, tcp_accepts_);
+
+    // And closed once it's been idle.
+    runFor(300);
+    EXPECT_EQ(0, pool.getTCPConnectionCount());
+}
+}
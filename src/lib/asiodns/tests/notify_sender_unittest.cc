@@ -0,0 +1,332 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+#include <gtest/gtest.h>
+
+#include <asio.hpp>
+#include <asiodns/notify_sender.h>
+
+#include <dns/message.h>
+#include <dns/messagerenderer.h>
+#include <dns/name.h>
+#include <dns/opcode.h>
+#include <dns/question.h>
+#include <dns/rcode.h>
+#include <dns/rrclass.h>
+#include <dns/rrtype.h>
+#include <exceptions/exceptions.h>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+using namespace bundy::asiodns;
+using namespace bundy::dns;
+using asio::ip::udp;
+
+namespace {
+const char* const TEST_ADDR = "127.0.0.1";
+
+// Render a NOTIFY message for the zone.
+std::vector<uint8_t>
+renderNotify(const char* zone, uint16_t qid = 0) {
+    Message message(Message::RENDER);
+    message.setQid(qid);
+    message.setOpcode(Opcode::NOTIFY());
+    message.setRcode(Rcode::NOERROR());
+    message.setHeaderFlag(Message::HEADERFLAG_AA);
+    message.addQuestion(Question(Name(zone), RRClass::IN(), RRType::SOA()));
+    MessageRenderer renderer;
+    message.toWire(renderer);
+    const uint8_t* data = static_cast<const uint8_t*>(renderer.getData());
+    return (std::vector<uint8_t>(data, data + renderer.getLength()));
+}
+
+void*
+wakeupThread(void* sender) {
+    static_cast<NotifySender*>(sender)->wakeup();
+    return (NULL);
+}
+
+// Secondary servers, as plain sockets read and answered by the tests
+// between the runs of the sender.
+class NotifySenderTest : public ::testing::Test {
+protected:
+    NotifySenderTest() {
+        for (size_t i = 0; i < 2; ++i) {
+            secondaries_.push_back(SocketPtr(new udp::socket(
+                io_service_, udp::endpoint(
+                    asio::ip::address::from_string(TEST_ADDR), 0))));
+            asio::socket_base::non_blocking_io non_blocking(true);
+            secondaries_.back()->io_control(non_blocking);
+        }
+        zone_ = renderNotify("example.com");
+    }
+
+    uint16_t port(size_t secondary) const {
+        return (secondaries_[secondary]->local_endpoint().port());
+    }
+
+    // Receive the NOTIFYs sent to a secondary so far.
+    std::vector<std::vector<uint8_t> > receive(size_t secondary) {
+        std::vector<std::vector<uint8_t> > messages;
+        for (;;) {
+            uint8_t data[512];
+            asio::error_code ec;
+            const size_t len = secondaries_[secondary]->receive_from(
+                asio::buffer(data), sender_, 0, ec);
+            if (ec) {
+                break;
+            }
+            messages.push_back(std::vector<uint8_t>(data, data + len));
+        }
+        return (messages);
+    }
+
+    // Send a response from a secondary to the sender.
+    void respond(size_t secondary, std::vector<uint8_t> message,
+                 uint8_t rcode = 0)
+    {
+        message[2] |= 0x80;
+        message[3] = (message[3] & 0xf0) | rcode;
+        secondaries_[secondary]->send_to(asio::buffer(message), sender_);
+    }
+
+    uint16_t getQid(const std::vector<uint8_t>& message) const {
+        return ((message[0] << 8) | message[1]);
+    }
+
+    typedef boost::shared_ptr<udp::socket> SocketPtr;
+    asio::io_service io_service_;
+    std::vector<SocketPtr> secondaries_;
+    udp::endpoint sender_;
+    std::vector<uint8_t> zone_;
+};
+
+TEST_F(NotifySenderTest, badParameters) {
+    EXPECT_THROW(NotifySender(0), bundy::BadValue);
+    EXPECT_THROW(NotifySender(NotifySender::MAX_OUTSTANDING + 1),
+                 bundy::BadValue);
+    EXPECT_THROW(NotifySender(10, 0), bundy::BadValue);
+    EXPECT_THROW(NotifySender(10, 100, 0), bundy::BadValue);
+
+    NotifySender sender;
+    // Not a DNS message, not a NOTIFY, no question.
+    EXPECT_THROW(sender.addZone(&zone_[0], 11), bundy::BadValue);
+    std::vector<uint8_t> message(zone_);
+    message[2] &= 0x87;
+    EXPECT_THROW(sender.addZone(&message[0], message.size()),
+                 bundy::BadValue);
+    message = zone_;
+    message[5] = 0;
+    EXPECT_THROW(sender.addZone(&message[0], message.size()),
+                 bundy::BadValue);
+
+    const size_t zone = sender.addZone(&zone_[0], zone_.size());
+    EXPECT_THROW(sender.addTarget(zone + 1, TEST_ADDR, port(0)),
+                 bundy::BadValue);
+    EXPECT_THROW(sender.addTarget(zone, "192.0.2.256", port(0)),
+                 bundy::BadValue);
+    EXPECT_EQ(0, sender.getPendingCount());
+}
+
+// The NOTIFY of a zone is sent to each target with its own query ID, and
+// each target's response completes its NOTIFY.
+TEST_F(NotifySenderTest, send) {
+    NotifySender sender;
+    const size_t zone = sender.addZone(&zone_[0], zone_.size());
+    sender.addTarget(zone, TEST_ADDR, port(0));
+    sender.addTarget(zone, TEST_ADDR, port(1));
+    EXPECT_EQ(2, sender.getPendingCount());
+
+    EXPECT_EQ(0, sender.run(100));
+    EXPECT_EQ(2, sender.getPendingCount());
+    std::vector<std::vector<uint8_t> > sent0 = receive(0);
+    ASSERT_EQ(1, sent0.size());
+    std::vector<uint8_t> sent1 = receive(1).at(0);
+    EXPECT_NE(getQid(sent0[0]), getQid(sent1));
+    EXPECT_TRUE(std::equal(zone_.begin() + 2, zone_.end(),
+                           sent0[0].begin() + 2));
+    EXPECT_TRUE(std::equal(zone_.begin() + 2, zone_.end(),
+                           sent1.begin() + 2));
+
+    respond(1, sent1, Rcode::NOTAUTH_CODE);
+    respond(0, sent0[0]);
+    // This returns when both are done.
+    EXPECT_EQ(2, sender.run(0));
+    EXPECT_EQ(0, sender.getPendingCount());
+
+    std::vector<NotifySender::Result> results = sender.getResults();
+    ASSERT_EQ(2, results.size());
+    EXPECT_TRUE(sender.getResults().empty());
+    if (results[0].port_ != port(1)) {
+        std::swap(results[0], results[1]);
+    }
+    EXPECT_EQ(zone, results[0].zone_);
+    EXPECT_EQ(TEST_ADDR, results[0].address_);
+    EXPECT_EQ(port(1), results[0].port_);
+    EXPECT_EQ(1, results[0].tries_);
+    EXPECT_TRUE(results[0].replied_);
+    EXPECT_EQ(Rcode::NOTAUTH_CODE, results[0].rcode_);
+    EXPECT_EQ(0, results[0].error_);
+    EXPECT_EQ(port(0), results[1].port_);
+    EXPECT_TRUE(results[1].replied_);
+    EXPECT_EQ(0, results[1].rcode_);
+
+    // The zone is forgotten.
+    EXPECT_THROW(sender.addTarget(zone, TEST_ADDR, port(0)),
+                 bundy::BadValue);
+}
+
+// Responses not answering the NOTIFY are ignored.
+TEST_F(NotifySenderTest, badResponses) {
+    NotifySender sender;
+    const size_t zone = sender.addZone(&zone_[0], zone_.size());
+    sender.addTarget(zone, TEST_ADDR, port(0));
+    sender.run(100);
+    const std::vector<uint8_t> sent = receive(0).at(0);
+
+    std::vector<uint8_t> response(sent);
+    response[1] ^= 1;           // query ID
+    respond(0, response);
+    response = sent;
+    response[2] &= 0x87;        // opcode
+    respond(0, response);
+    response = renderNotify("example.org", getQid(sent));
+    respond(0, response);
+    // QR bit not set.
+    secondaries_[0]->send_to(asio::buffer(sent), sender_);
+    // From another address.
+    secondaries_[1]->send_to(asio::buffer(response), sender_);
+    respond(1, sent);
+
+    EXPECT_EQ(0, sender.run(100));
+    EXPECT_EQ(1, sender.getPendingCount());
+
+    // The zone name is compared case-insensitively.
+    respond(0, renderNotify("EXAMPLE.com", getQid(sent)));
+    EXPECT_EQ(1, sender.run(0));
+    EXPECT_TRUE(sender.getResults().at(0).replied_);
+}
+
+// NOTIFYs without a response are resent with the same query ID, then
+// given up.
+TEST_F(NotifySenderTest, retry) {
+    NotifySender sender(10, 10, 3);
+    const size_t zone = sender.addZone(&zone_[0], zone_.size());
+    sender.addTarget(zone, TEST_ADDR, port(0));
+    EXPECT_EQ(1, sender.run(0));
+
+    const std::vector<std::vector<uint8_t> > sent = receive(0);
+    ASSERT_EQ(3, sent.size());
+    EXPECT_EQ(sent[0], sent[1]);
+    EXPECT_EQ(sent[0], sent[2]);
+
+    const NotifySender::Result result = sender.getResults().at(0);
+    EXPECT_EQ(3, result.tries_);
+    EXPECT_FALSE(result.replied_);
+    EXPECT_EQ(0, result.error_);
+}
+
+// A response to a previous try completes the NOTIFY.
+TEST_F(NotifySenderTest, lateResponse) {
+    NotifySender sender(10, 10, 5);
+    const size_t zone = sender.addZone(&zone_[0], zone_.size());
+    sender.addTarget(zone, TEST_ADDR, port(0));
+    sender.run(50);
+    const std::vector<std::vector<uint8_t> > sent = receive(0);
+    ASSERT_LT(1, sent.size());
+    respond(0, sent[0]);
+    EXPECT_EQ(1, sender.run(0));
+    const NotifySender::Result result = sender.getResults().at(0);
+    EXPECT_TRUE(result.replied_);
+    EXPECT_EQ(sent.size(), result.tries_);
+}
+
+// No more NOTIFYs than the maximum are outstanding.
+TEST_F(NotifySenderTest, maxOutstanding) {
+    NotifySender sender(1);
+    const size_t zone = sender.addZone(&zone_[0], zone_.size());
+    sender.addTarget(zone, TEST_ADDR, port(0));
+    sender.addTarget(zone, TEST_ADDR, port(1));
+    sender.run(100);
+    const std::vector<std::vector<uint8_t> > sent = receive(0);
+    ASSERT_EQ(1, sent.size());
+    EXPECT_TRUE(receive(1).empty());
+
+    respond(0, sent[0]);
+    EXPECT_EQ(1, sender.run(100));
+    EXPECT_EQ(1, receive(1).size());
+    EXPECT_EQ(1, sender.getPendingCount());
+}
+
+// NOTIFYs to several zones.
+TEST_F(NotifySenderTest, zones) {
+    NotifySender sender;
+    const std::vector<uint8_t> other = renderNotify("example.org");
+    const size_t zone1 = sender.addZone(&zone_[0], zone_.size());
+    const size_t zone2 = sender.addZone(&other[0], other.size());
+    EXPECT_NE(zone1, zone2);
+    sender.addTarget(zone1, TEST_ADDR, port(0));
+    sender.addTarget(zone2, TEST_ADDR, port(0));
+    sender.run(100);
+
+    const std::vector<std::vector<uint8_t> > sent = receive(0);
+    ASSERT_EQ(2, sent.size());
+    respond(0, sent[1]);
+    EXPECT_EQ(1, sender.run(100));
+    EXPECT_EQ(zone2, sender.getResults().at(0).zone_);
+    respond(0, sent[0]);
+    EXPECT_EQ(1, sender.run(0));
+    EXPECT_EQ(zone1, sender.getResults().at(0).zone_);
+}
+
+// NOTIFYs which can't be sent fail at once.
+TEST_F(NotifySenderTest, sendError) {
+    NotifySender sender;
+    const size_t zone = sender.addZone(&zone_[0], zone_.size());
+    sender.addTarget(zone, TEST_ADDR, 0);
+    sender.addTarget(zone, TEST_ADDR, port(0));
+    sender.run(100);
+
+    const std::vector<NotifySender::Result> results = sender.getResults();
+    ASSERT_EQ(1, results.size());
+    EXPECT_EQ(0, results[0].port_);
+    EXPECT_EQ(0, results[0].tries_);
+    EXPECT_FALSE(results[0].replied_);
+    EXPECT_NE(0, results[0].error_);
+    EXPECT_EQ(1, receive(0).size());
+}
+
+// run() waits for the timeout or a wakeup when there's nothing to do.
+TEST_F(NotifySenderTest, wakeup) {
+    NotifySender sender;
+    EXPECT_EQ(0, sender.run(10));
+
+    // A wakeup before run() isn't lost.
+    sender.wakeup();
+    EXPECT_EQ(0, sender.run(0));
+
+    pthread_t thread;
+    ASSERT_EQ(0, pthread_create(&thread, NULL, wakeupThread, &sender));
+    EXPECT_EQ(0, sender.run(0));
+    pthread_join(thread, NULL);
+}
+
+}
@@ -0,0 +1,293 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+#include <gtest/gtest.h>
+
+#include <asio.hpp>
+#include <asiodns/xdp_server.h>
+
+#include <dns/message.h>
+#include <dns/messagerenderer.h>
+#include <dns/name.h>
+#include <dns/opcode.h>
+#include <dns/question.h>
+#include <dns/rcode.h>
+#include <dns/rrclass.h>
+#include <dns/rrtype.h>
+#include <exceptions/exceptions.h>
+
+#include <cstring>
+#include <vector>
+
+#include <sys/socket.h>
+
+using namespace bundy::asiodns;
+using namespace bundy::dns;
+using namespace bundy::asiodns::xdp;
+
+namespace {
+const size_t ETHER_LENGTH = 14;
+const size_t UDP_LENGTH = 8;
+
+uint16_t
+readUint16(const uint8_t* data) {
+    return ((data[0] << 8) | data[1]);
+}
+
+void
+writeUint16(uint16_t value, uint8_t* data) {
+    data[0] = value >> 8;
+    data[1] = value & 0xff;
+}
+
+// The one's complement sum used by the IP and UDP checksums; it's 0xffff
+// over a header (with its pseudo header for UDP) with a valid checksum.
+uint16_t
+checksum(const std::vector<uint8_t>& data) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < data.size(); i += 2) {
+        sum += data[i] << 8;
+        if (i + 1 < data.size()) {
+            sum += data[i + 1];
+        }
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return (sum);
+}
+
+std::vector<uint8_t>
+renderQuery(const char* name, uint16_t qid = 0x1234) {
+    Message message(Message::RENDER);
+    message.setQid(qid);
+    message.setOpcode(Opcode::QUERY());
+    message.setRcode(Rcode::NOERROR());
+    message.addQuestion(Question(Name(name), RRClass::IN(), RRType::A()));
+    MessageRenderer renderer;
+    message.toWire(renderer);
+    const uint8_t* data = static_cast<const uint8_t*>(renderer.getData());
+    return (std::vector<uint8_t>(data, data + renderer.getLength()));
+}
+
+// Build an Ethernet frame with the payload sent from 192.0.2.1:5300 (or
+// 2001:db8::1) to 192.0.2.53:53 (or 2001:db8::53).
+std::vector<uint8_t>
+buildFrame(int af, const std::vector<uint8_t>& payload) {
+    const size_t ip_length = (af == AF_INET) ? 20 : 40;
+    std::vector<uint8_t> frame(ETHER_LENGTH + ip_length + UDP_LENGTH);
+    for (size_t i = 0; i < 6; ++i) {
+        frame[i] = 0x02;        // destination
+        frame[6 + i] = 0x04;    // source
+    }
+    uint8_t* const ip = &frame[ETHER_LENGTH];
+    if (af == AF_INET) {
+        writeUint16(0x0800, &frame[12]);
+        ip[0] = 0x45;
+        writeUint16(ip_length + UDP_LENGTH + payload.size(), ip + 2);
+        ip[8] = 60;
+        ip[9] = IPPROTO_UDP;
+        const uint8_t addresses[] = { 192, 0, 2, 1, 192, 0, 2, 53 };
+        std::memcpy(ip + 12, addresses, sizeof(addresses));
+    } else {
+        writeUint16(0x86dd, &frame[12]);
+        ip[0] = 0x60;
+        writeUint16(UDP_LENGTH + payload.size(), ip + 4);
+        ip[6] = IPPROTO_UDP;
+        ip[7] = 60;
+        const uint8_t address[] = { 0x20, 0x01, 0x0d, 0xb8 };
+        std::memcpy(ip + 8, address, sizeof(address));
+        ip[23] = 0x01;
+        std::memcpy(ip + 24, address, sizeof(address));
+        ip[39] = 0x53;
+    }
+    uint8_t* const udp = ip + ip_length;
+    writeUint16(5300, udp);
+    writeUint16(53, udp + 2);
+    writeUint16(UDP_LENGTH + payload.size(), udp + 4);
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    return (frame);
+}
+
+void
+checkResponseFrame(int af, const std::vector<uint8_t>& frame,
+                   const std::vector<uint8_t>& payload)
+{
+    const size_t ip_length = (af == AF_INET) ? 20 : 40;
+    ASSERT_EQ(ETHER_LENGTH + ip_length + UDP_LENGTH + payload.size(),
+              frame.size());
+    for (size_t i = 0; i < 6; ++i) {
+        EXPECT_EQ(0x04, frame[i]);
+        EXPECT_EQ(0x02, frame[6 + i]);
+    }
+    const uint8_t* const ip = &frame[ETHER_LENGTH];
+    std::vector<uint8_t> pseudo;
+    if (af == AF_INET) {
+        EXPECT_EQ(ip_length + UDP_LENGTH + payload.size(),
+                  readUint16(ip + 2));
+        EXPECT_EQ(64, ip[8]);
+        EXPECT_EQ(0xffff, checksum(std::vector<uint8_t>(ip, ip + 20)));
+        const uint8_t addresses[] = { 192, 0, 2, 53, 192, 0, 2, 1 };
+        EXPECT_EQ(0, std::memcmp(ip + 12, addresses, sizeof(addresses)));
+        pseudo.assign(ip + 12, ip + 20);
+    } else {
+        EXPECT_EQ(UDP_LENGTH + payload.size(), readUint16(ip + 4));
+        EXPECT_EQ(64, ip[7]);
+        EXPECT_EQ(0x53, ip[23]);
+        EXPECT_EQ(0x01, ip[39]);
+        pseudo.assign(ip + 8, ip + 40);
+    }
+    const uint8_t* const udp = ip + ip_length;
+    EXPECT_EQ(53, readUint16(udp));
+    EXPECT_EQ(5300, readUint16(udp + 2));
+    EXPECT_EQ(UDP_LENGTH + payload.size(), readUint16(udp + 4));
+    EXPECT_EQ(0, std::memcmp(udp + UDP_LENGTH, &payload[0],
+                             payload.size()));
+    pseudo.push_back(0);
+    pseudo.push_back(IPPROTO_UDP);
+    pseudo.push_back((UDP_LENGTH + payload.size()) >> 8);
+    pseudo.push_back((UDP_LENGTH + payload.size()) & 0xff);
+    pseudo.insert(pseudo.end(), udp, &frame[0] + frame.size());
+    EXPECT_EQ(0xffff, checksum(pseudo));
+}
+
+TEST(XDPFrameTest, parseFrame) {
+    const std::vector<uint8_t> query = renderQuery("example.com");
+    const int families[] = { AF_INET, AF_INET6 };
+    for (size_t i = 0; i < 2; ++i) {
+        const int af = families[i];
+        SCOPED_TRACE(af == AF_INET ? "IPv4" : "IPv6");
+        std::vector<uint8_t> frame = buildFrame(af, query);
+        FrameInfo info;
+        ASSERT_TRUE(parseFrame(&frame[0], frame.size(), info));
+        EXPECT_EQ(af, info.af_);
+        EXPECT_EQ(ETHER_LENGTH + (af == AF_INET ? 20 : 40),
+                  info.udp_offset_);
+        EXPECT_EQ(query.size(), info.payload_length_);
+
+        // Ethernet padding is ignored.
+        frame.resize(frame.size() + 10);
+        ASSERT_TRUE(parseFrame(&frame[0], frame.size(), info));
+        EXPECT_EQ(query.size(), info.payload_length_);
+
+        // A truncated frame is rejected.
+        frame = buildFrame(af, query);
+        EXPECT_FALSE(parseFrame(&frame[0], frame.size() - 1, info));
+        EXPECT_FALSE(parseFrame(&frame[0], ETHER_LENGTH - 1, info));
+
+        // So is a UDP length beyond the IP payload.
+        writeUint16(UDP_LENGTH + query.size() + 1,
+                    &frame[info.udp_offset_ + 4]);
+        EXPECT_FALSE(parseFrame(&frame[0], frame.size(), info));
+
+        // And anything but UDP.
+        frame = buildFrame(af, query);
+        frame[ETHER_LENGTH + (af == AF_INET ? 9 : 6)] = IPPROTO_TCP;
+        EXPECT_FALSE(parseFrame(&frame[0], frame.size(), info));
+    }
+
+    // IPv4 options and fragments aren't handled.
+    FrameInfo info;
+    std::vector<uint8_t> frame = buildFrame(AF_INET, query);
+    frame[ETHER_LENGTH] = 0x46;
+    EXPECT_FALSE(parseFrame(&frame[0], frame.size(), info));
+    frame = buildFrame(AF_INET, query);
+    frame[ETHER_LENGTH + 6] = 0x20; // more fragments
+    EXPECT_FALSE(parseFrame(&frame[0], frame.size(), info));
+    frame[ETHER_LENGTH + 6] = 0x40; // don't fragment is fine
+    EXPECT_TRUE(parseFrame(&frame[0], frame.size(), info));
+
+    // Neither IPv4 nor IPv6
+    writeUint16(0x0806, &frame[12]);
+    EXPECT_FALSE(parseFrame(&frame[0], frame.size(), info));
+}
+
+TEST(XDPFrameTest, makeResponseFrame) {
+    const std::vector<uint8_t> query = renderQuery("example.com");
+    // Longer than the query, and of odd length to check the checksum
+    // padding.
+    const std::vector<uint8_t> answer = renderQuery("www.example.org");
+    ASSERT_EQ(1, answer.size() % 2);
+    const int families[] = { AF_INET, AF_INET6 };
+    for (size_t i = 0; i < 2; ++i) {
+        const int af = families[i];
+        SCOPED_TRACE(af == AF_INET ? "IPv4" : "IPv6");
+        std::vector<uint8_t> frame = buildFrame(af, query);
+        FrameInfo info;
+        ASSERT_TRUE(parseFrame(&frame[0], frame.size(), info));
+        frame.resize(info.udp_offset_ + UDP_LENGTH + answer.size());
+        std::memcpy(&frame[info.udp_offset_ + UDP_LENGTH], &answer[0],
+                    answer.size());
+        EXPECT_EQ(frame.size(),
+                  makeResponseFrame(&frame[0], info, answer.size()));
+        checkResponseFrame(af, frame, answer);
+    }
+}
+
+TEST(XDPFrameTest, truncateResponse) {
+    std::vector<uint8_t> response = renderQuery("example.com");
+    const size_t question_end = response.size();
+    response[2] |= 0x80;        // QR
+    writeUint16(1, &response[6]); // ANCOUNT
+    response.resize(question_end + 100, 0xaa);
+
+    std::vector<uint8_t> buffer(response.size());
+    ASSERT_EQ(question_end,
+              truncateResponse(&response[0], response.size(), &buffer[0],
+                               buffer.size()));
+    EXPECT_EQ(0x82, buffer[2]);
+    EXPECT_EQ(0, readUint16(&buffer[6]));
+    EXPECT_EQ(0, std::memcmp(&response[12], &buffer[12], question_end - 12));
+
+    // The buffers can be the same.
+    ASSERT_EQ(question_end,
+              truncateResponse(&response[0], response.size(), &response[0],
+                               response.size()));
+    EXPECT_EQ(0, std::memcmp(&response[0], &buffer[0], question_end));
+
+    // The question doesn't fit.
+    EXPECT_EQ(0, truncateResponse(&response[0], response.size(), &buffer[0],
+                                  question_end - 1));
+    // Broken responses
+    EXPECT_EQ(0, truncateResponse(&response[0], 11, &buffer[0],
+                                  buffer.size()));
+    EXPECT_EQ(0, truncateResponse(&response[0], question_end - 1,
+                                  &buffer[0], buffer.size()));
+    writeUint16(2, &response[4]); // QDCOUNT
+    EXPECT_EQ(0, truncateResponse(&response[0], question_end, &buffer[0],
+                                  buffer.size()));
+}
+
+class DummyLookup : public DNSLookup {};
+
+// The server itself needs privileges and a real interface, so only the
+// parameter checks can be tested here.
+TEST(XDPServerTest, create) {
+    asio::io_service io_service;
+    DummyLookup lookup;
+    if (!XDPServer::isSupported()) {
+        EXPECT_THROW(XDPServer::create(io_service, "lo", 0, 53, &lookup),
+                     bundy::NotImplemented);
+        return;
+    }
+    EXPECT_THROW(XDPServer::create(io_service, "lo", 0, 53, NULL),
+                 bundy::InvalidParameter);
+    EXPECT_THROW(XDPServer::create(io_service, "lo",
+                                   XDPServer::MAX_QUEUE_ID + 1, 53,
+                                   &lookup),
+                 bundy::InvalidParameter);
+}
+
+}
@@ -17,7 +17,9 @@
 #include <sys/socket.h>
 #include <errno.h>
 
-#include <boost/shared_array.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #include <config.h>
 
@@ -33,10 +35,8 @@
 
 // Avoid 'using namespace asio' (see tcp_server.cc)
 using asio::io_service;
-using asio::socket_base;
 using asio::buffer;
 using asio::ip::udp;
-using asio::ip::address;
 
 using namespace std;
 using namespace bundy::dns;
@@ -47,40 +47,108 @@ namespace bundy {
 namespace asiodns {
 
 /*
- * Some of the member variables here are shared_ptrs and some are
- * unique_ptrs. There will be one instance of Data for the lifetime
- * of packet. The variables that are state only for a single packet
- * use unique_ptr, as it is more lightweight. In the case of shared
- * configuration (eg. the callbacks, socket), we use shared_ptrs.
+ * The state of a single query.  There will be one instance of Data in use
+ * for the lifetime of a packet; it goes back to the pool when the packet is
+ * done, keeping the buffers and the messages for the next one.  The
+ * variables that are state only for a single packet use unique_ptr, as it
+ * is more lightweight.
  */
-struct UDPServer::Data {
-    /*
-     * Constructors from parameters passed to UDPServer constructor.
-     * This instance will not be used to retrieve and answer the actual
-     * query, it will only hold parameters until we wait for the
-     * first packet. But we do initialize the socket in here.
-     */
-    Data(io_service& io_service, const address& addr, const uint16_t port,
-         DNSLookup* lookup, DNSAnswer* answer) :
-        io_(io_service), bytes_(0), done_(false),
-        lookup_callback_(lookup),
-        answer_callback_(answer)
-    {
-        // We must use different instantiations for v4 and v6;
-        // otherwise ASIO will bind to both
-        udp proto = addr.is_v4() ? udp::v4() : udp::v6();
-        socket_.reset(new udp::socket(io_service, proto));
-        socket_->set_option(socket_base::reuse_address(true));
-        if (addr.is_v6()) {
-            socket_->set_option(asio::ip::v6_only(true));
+struct UDPServer::Data : boost::noncopyable {
+    explicit Data(udp::socket& socket) :
+        peer_(sender_), iosock_(socket), bytes_(0), done_(false),
+        received_(false)
+    {}
+
+    // Prepare for the next packet.  The messages and the buffer are
+    // cleared for reuse, unless the lookup kept a reference to them.
+    void reset() {
+        io_message_.reset();
+        if (query_message_) {
+            if (query_message_.unique()) {
+                query_message_->clear(Message::PARSE);
+            } else {
+                query_message_.reset();
+            }
         }
-        socket_->bind(udp::endpoint(addr, port));
+        if (answer_message_) {
+            if (answer_message_.unique()) {
+                answer_message_->clear(Message::RENDER);
+            } else {
+                answer_message_.reset();
+            }
+        }
+        if (respbuf_) {
+            if (respbuf_.unique()) {
+                respbuf_->clear();
+            } else {
+                respbuf_.reset();
+            }
+        }
+        bytes_ = 0;
+        done_ = false;
+        received_ = false;
     }
-    Data(io_service& io_service, int fd, int af,
+
+    // The ASIO-internal endpoint object representing the client
+    asio::ip::udp::endpoint sender_;
+
+    // The client and the socket as passed in the \c IOMessage.  The
+    // endpoint refers to sender_, so it's updated by each receive.  The
+    // UDP socket class has been extended with asynchronous functions and
+    // takes as a template parameter a completion callback class.  As
+    // UDPServer does not use these extended functions (only those defined
+    // in the IOSocket base class) - but needs a UDPSocket to get hold of
+    // the underlying Boost UDP socket - DummyIOCallback is used.  This
+    // provides the appropriate operator() but is otherwise functionless.
+    UDPEndpoint peer_;
+    UDPSocket<DummyIOCallback> iosock_;
+
+    // \c IOMessage and \c Message objects to be passed to the
+    // DNS lookup and answer providers
+    std::unique_ptr<asiolink::IOMessage> io_message_;
+
+    // The original query as sent by the client
+    bundy::dns::MessagePtr query_message_;
+
+    // The response message we are building
+    bundy::dns::MessagePtr answer_message_;
+
+    // The buffer into which the response is written
+    bundy::util::OutputBufferPtr respbuf_;
+
+    // The buffer into which the query packet is written
+    char data_[MAX_LENGTH];
+
+    // State information that is entirely internal to a given instance
+    // of the coroutine can be declared here.
+    size_t bytes_;
+    bool done_;
+
+    // Whether a query was received, so it counts as outstanding.
+    bool received_;
+};
+
+/*
+ * What is shared by the copies of a server: the socket, the callbacks and
+ * the states of the queries not in use.  As a query state holds a reference
+ * to the pool while in use, the pool outlives the queries in progress.
+ *
+ * All the copies run in the thread of the IO service, so no locking is
+ * needed.
+ */
+class UDPServer::Pool :
+    public boost::enable_shared_from_this<UDPServer::Pool>,
+    boost::noncopyable
+{
+public:
+    /*
+     * Constructor from parameters passed to UDPServer constructor.  It
+     * initializes the socket.
+     */
+    Pool(io_service& io_service, int fd, int af,
          DNSLookup* lookup, DNSAnswer* answer) :
-         io_(io_service), bytes_(0), done_(false),
-         lookup_callback_(lookup),
-         answer_callback_(answer)
+        io_(io_service), max_outstanding_(DEFAULT_MAX_OUTSTANDING),
+        outstanding_(0), lookup_callback_(lookup), answer_callback_(answer)
     {
         if (af != AF_INET && af != AF_INET6) {
             bundy_throw(InvalidParameter, "Address family must be either AF_INET"
@@ -97,83 +165,112 @@ struct UDPServer::Data {
         }
     }
 
-    /*
-     * Copy constructor. Default one would probably do, but it is unnecessary
-     * to copy many of the member variables every time we fork to handle
-     * another packet.
-     *
-     * We also allocate data for receiving the packet here.
-     */
-    Data(const Data& other) :
-        io_(other.io_), socket_(other.socket_), bytes_(0), done_(false),
-        lookup_callback_(other.lookup_callback_),
-        answer_callback_(other.answer_callback_)
-    {
-        // Instantiate the data buffer and endpoint that will
-        // be used by the asynchronous receive call.
-        data_.reset(new char[MAX_LENGTH]);
-        sender_.reset(new udp::endpoint());
+    ~Pool() {
+        for (vector<Data*>::iterator i = free_.begin(); i != free_.end();
+             ++i) {
+            delete *i;
+        }
+    }
+
+    /// Whether as many queries as allowed are being handled.
+    bool isFull() const {
+        return (outstanding_ >= max_outstanding_);
+    }
+
+    /// Get a state for the next query.  It returns to the pool when the
+    /// last reference to it is gone.
+    boost::shared_ptr<Data> getData() {
+        Data* data;
+        if (free_.empty()) {
+            data = new Data(*socket_);
+        } else {
+            data = free_.back();
+            free_.pop_back();
+        }
+        return (boost::shared_ptr<Data>(data, Releaser(shared_from_this())));
+    }
+
+    /// A query has been received in the state and is passed to the lookup.
+    void queryReceived(Data& data) {
+        data.received_ = true;
+        ++outstanding_;
+    }
+
+    /// Keep the receiving coroutine until a query is done.
+    void pauseReceiver(const UDPServer& receiver) {
+        paused_receiver_.reset(new UDPServer(receiver));
+    }
+
+    void setMaxOutstanding(size_t max_outstanding) {
+        max_outstanding_ = max_outstanding;
+        resumeReceiver();
+    }
+
+    /// Close the socket.  The pending receive fails, and a paused receiver
+    /// is simply forgotten.
+    void stop() {
+        asio::error_code ec;
+        socket_->close(ec);
+        if (ec) {
+            LOG_ERROR(logger, ASIODNS_UDP_CLOSE_FAIL).arg(ec.message());
+        }
+        paused_receiver_.reset();
     }
 
     // The ASIO service object
     asio::io_service& io_;
 
-    // Class member variables which are dynamic, and changes to which
-    // need to accessible from both sides of a coroutine fork or from
-    // outside of the coroutine (i.e., from an asynchronous I/O call),
-    // should be declared here as pointers and allocated in the
-    // constructor or in the coroutine.  This allows state information
-    // to persist when an individual copy of the coroutine falls out
-    // scope while waiting for an event, *so long as* there is another
-    // object that is referencing the same data.  As a side-benefit, using
-    // pointers also reduces copy overhead for coroutine objects.
-    //
-    // Note: Currently these objects are allocated by "new" in the
-    // constructor, or in the function operator while processing a query.
-    // Repeated allocations from the heap for every incoming query is
-    // clearly a performance issue; this must be optimized in the future.
-    // The plan is to have a structure pre-allocate several "Data"
-    // objects which can be pulled off a free list and placed on an in-use
-    // list whenever a query comes in.  This will serve the dual purpose
-    // of improving performance and guaranteeing that state information
-    // will *not* be destroyed when any one instance of the coroutine
-    // falls out of scope while waiting for an event.
-    //
     // Socket used to for listen for queries.  Created in the
     // constructor and stored in a shared_ptr because socket objects
     // are not copyable.
     boost::shared_ptr<asio::ip::udp::socket> socket_;
 
-    // The ASIO-internal endpoint object representing the client
-    std::unique_ptr<asio::ip::udp::endpoint> sender_;
-
-    // \c IOMessage and \c Message objects to be passed to the
-    // DNS lookup and answer providers
-    std::unique_ptr<asiolink::IOMessage> io_message_;
-
-    // The original query as sent by the client
-    bundy::dns::MessagePtr query_message_;
+    size_t max_outstanding_;
+    size_t outstanding_;        // received and not yet answered (or dropped)
 
-    // The response message we are building
-    bundy::dns::MessagePtr answer_message_;
+    // Callback functions provided by the caller
+    const DNSLookup* lookup_callback_;
+    const DNSAnswer* answer_callback_;
 
-    // The buffer into which the response is written
-    bundy::util::OutputBufferPtr respbuf_;
+private:
+    // The deleter of the query states in use, giving them back to the pool.
+    class Releaser {
+    public:
+        Releaser(const boost::shared_ptr<Pool>& pool) : pool_(pool) {}
+        void operator()(Data* data) const {
+            pool_->release(data);
+        }
+    private:
+        boost::shared_ptr<Pool> pool_;
+    };
 
-    // The buffer into which the query packet is written
-    boost::shared_array<char> data_;
+    void release(Data* data) {
+        if (data->received_) {
+            --outstanding_;
+        }
+        if (free_.size() < max_outstanding_) {
+            data->reset();
+            free_.push_back(data);
+        } else {
+            delete data;
+        }
+        resumeReceiver();
+    }
 
-    // State information that is entirely internal to a given instance
-    // of the coroutine can be declared here.
-    size_t bytes_;
-    bool done_;
+    void resumeReceiver() {
+        if (paused_receiver_ && !isFull()) {
+            // post() can throw due to memory allocation failure; we consider
+            // it fatal.
+            io_.post(*paused_receiver_);
+            paused_receiver_.reset();
+        }
+    }
 
-    // Callback functions provided by the caller
-    const DNSLookup* lookup_callback_;
-    const DNSAnswer* answer_callback_;
+    // Default limit of the queries handled at a time.
+    static const size_t DEFAULT_MAX_OUTSTANDING = 1000;
 
-    std::unique_ptr<IOEndpoint> peer_;
-    std::unique_ptr<IOSocket> iosock_;
+    std::vector<Data*> free_;
+    boost::scoped_ptr<UDPServer> paused_receiver_;
 };
 
 /// The following functions implement the \c UDPServer class.
@@ -183,9 +280,28 @@ struct UDPServer::Data {
 UDPServer::UDPServer(io_service& io_service, int fd, int af,
                      DNSLookup* lookup,
                      DNSAnswer* answer) :
-    data_(new Data(io_service, fd, af, lookup, answer))
+    pool_(new Pool(io_service, fd, af, lookup, answer))
 { }
 
+void
+UDPServer::setMaxOutstanding(size_t max_outstanding) {
+    if (max_outstanding == 0) {
+        bundy_throw(InvalidParameter, "UDP queries outstanding must be "
+                    "positive");
+    }
+    pool_->setMaxOutstanding(max_outstanding);
+}
+
+size_t
+UDPServer::getMaxOutstanding() const {
+    return (pool_->max_outstanding_);
+}
+
+size_t
+UDPServer::getOutstanding() const {
+    return (pool_->outstanding_);
+}
+
 /// The function operator is implemented with the "stackless coroutine"
 /// pattern; see internal/coroutine.h for details.
 void
@@ -197,19 +313,32 @@ UDPServer::operator()(asio::error_code ec, size_t length) {
     CORO_REENTER (this) {
         do {
             /*
-             * This is preparation for receiving a packet. We get a new
-             * state object for the lifetime of the next packet to come.
-             * It allocates the buffers to receive data into.
+             * This is preparation for receiving a packet.  The state of
+             * the previous one now belongs to the child.  If too many
+             * queries are being handled, wait until one of them is done;
+             * the pool resumes us (a copy of us, to be precise) then.
+             * Otherwise we get a state object from the pool for the
+             * lifetime of the next packet to come.
              */
-            data_.reset(new Data(*data_));
+            data_.reset();
+            if (pool_->isFull()) {
+                CORO_YIELD pool_->pauseReceiver(*this);
+            }
+            data_ = pool_->getData();
 
             do {
                 // Begin an asynchronous receive, then yield.
                 // When the receive event is posted, the coroutine
-                // will resume immediately after this point.
-                CORO_YIELD data_->socket_->async_receive_from(
-                    buffer(data_->data_.get(), MAX_LENGTH), *data_->sender_,
-                    *this);
+                // will resume immediately after this point.  The copy
+                // of us left behind (the one the server was started
+                // with) drops the state, so that it returns to the pool
+                // once the query is done.
+                CORO_YIELD {
+                    pool_->socket_->async_receive_from(
+                        buffer(data_->data_, MAX_LENGTH), data_->sender_,
+                        *this);
+                    data_.reset();
+                }
 
                 // See TCPServer::operator() for details on error handling.
                 if (ec) {
@@ -229,6 +358,7 @@ UDPServer::operator()(asio::error_code ec, size_t length) {
             } while (ec || length == 0);
 
             data_->bytes_ = length;
+            pool_->queryReceived(*data_);
 
             /*
              * We fork the coroutine now. One (the child) will keep
@@ -240,44 +370,36 @@ UDPServer::operator()(asio::error_code ec, size_t length) {
              * Actually, both of the coroutines will be a copy of this
              * one, but that's just internal implementation detail.
              */
-            CORO_FORK data_->io_.post(UDPServer(*this));
+            CORO_FORK pool_->io_.post(UDPServer(*this));
         } while (is_parent());
 
         // Create an \c IOMessage object to store the query.
-        //
-        // (XXX: It would be good to write a factory function
-        // that would quickly generate an IOMessage object without
-        // all these calls to "new".)
-        data_->peer_.reset(new UDPEndpoint(*data_->sender_));
-
-        // The UDP socket class has been extended with asynchronous functions
-        // and takes as a template parameter a completion callback class.  As
-        // UDPServer does not use these extended functions (only those defined
-        // in the IOSocket base class) - but needs a UDPSocket to get hold of
-        // the underlying Boost UDP socket - DummyIOCallback is used.  This
-        // provides the appropriate operator() but is otherwise functionless.
-        data_->iosock_.reset(
-            new UDPSocket<DummyIOCallback>(*data_->socket_));
-
-        data_->io_message_.reset(new IOMessage(data_->data_.get(),
-            data_->bytes_, *data_->iosock_, *data_->peer_));
+        data_->io_message_.reset(new IOMessage(data_->data_,
+            data_->bytes_, data_->iosock_, data_->peer_));
 
         // If we don't have a DNS Lookup provider, there's no point in
         // continuing; we exit the coroutine permanently.
-        if (data_->lookup_callback_ == NULL) {
+        if (pool_->lookup_callback_ == NULL) {
             return;
         }
 
-        // Instantiate objects that will be needed by the
-        // asynchronous DNS lookup and/or by the send call.
-        data_->respbuf_.reset(new OutputBuffer(0));
-        data_->query_message_.reset(new Message(Message::PARSE));
-        data_->answer_message_.reset(new Message(Message::RENDER));
+        // Instantiate objects that will be needed by the asynchronous DNS
+        // lookup and/or by the send call, unless the state has them from
+        // a previous query.
+        if (!data_->respbuf_) {
+            data_->respbuf_.reset(new OutputBuffer(0));
+        }
+        if (!data_->query_message_) {
+            data_->query_message_.reset(new Message(Message::PARSE));
+        }
+        if (!data_->answer_message_) {
+            data_->answer_message_.reset(new Message(Message::RENDER));
+        }
 
         // Schedule a DNS lookup, and yield.  When the lookup is
         // finished, the coroutine will resume immediately after
         // this point.
-        CORO_YIELD data_->io_.post(AsyncLookup<UDPServer>(*this));
+        CORO_YIELD pool_->io_.post(AsyncLookup<UDPServer>(*this));
 
         // The 'done_' flag indicates whether we have an answer
         // to send back.  If not, exit the coroutine permanently.
@@ -287,20 +409,20 @@ UDPServer::operator()(asio::error_code ec, size_t length) {
 
         // Call the DNS answer provider to render the answer into
         // wire format
-        (*data_->answer_callback_)(*data_->io_message_, data_->query_message_,
-            data_->answer_message_, data_->respbuf_);
+        (*pool_->answer_callback_)(*data_->io_message_,
+            data_->query_message_, data_->answer_message_, data_->respbuf_);
 
         // Begin an asynchronous send, and then yield.  When the
         // send completes, we will resume immediately after this point
         // (though we have nothing further to do, so the coroutine
         // will simply exit at that time, after reporting an error if
         // there was one).
-        CORO_YIELD data_->socket_->async_send_to(
+        CORO_YIELD pool_->socket_->async_send_to(
             buffer(data_->respbuf_->getData(), data_->respbuf_->getLength()),
-            *data_->sender_, *this);
+            data_->sender_, *this);
         if (ec) {
             LOG_ERROR(logger, ASIODNS_UDP_ASYNC_SEND_FAIL).
-                      arg(data_->sender_->address().to_string()).
+                      arg(data_->sender_.address().to_string()).
                       arg(ec.message());
         }
     }
@@ -310,15 +432,13 @@ UDPServer::operator()(asio::error_code ec, size_t length) {
 /// AsyncLookup<UDPServer> handler.)
 void
 UDPServer::asyncLookup() {
-    (*data_->lookup_callback_)(*data_->io_message_,
+    (*pool_->lookup_callback_)(*data_->io_message_,
         data_->query_message_, data_->answer_message_, data_->respbuf_, this);
 }
 
 /// Stop the UDPServer
 void
 UDPServer::stop() {
-    asio::error_code ec;
-
     /// Using close instead of cancel, because cancel
     /// will only cancel the asynchronized event already submitted
     /// to io service, the events post to io service after
@@ -327,10 +447,7 @@ UDPServer::stop() {
     /// for it won't be scheduled by io service not matter it is
     /// submit to io service before or after close call. And we will
     //  get bad_descriptor error.
-    data_->socket_->close(ec);
-    if (ec) {
-        LOG_ERROR(logger, ASIODNS_UDP_CLOSE_FAIL).arg(ec.message());
-    }
+    pool_->stop();
 }
 
 /// Post this coroutine on the ASIO service queue so that it will
@@ -339,7 +456,7 @@ UDPServer::stop() {
 void
 UDPServer::resume(const bool done) {
     data_->done_ = done;
-    data_->io_.post(*this);  // this can throw, but can be considered fatal.
+    pool_->io_.post(*this);  // this can throw, but can be considered fatal.
 }
 
 } // namespace asiodns
@@ -76,6 +76,23 @@ public:
         return (s);
     }
 
+    /// \brief Set the maximum number of queries handled at a time
+    ///
+    /// When this number of queries are still being looked up or answered,
+    /// the server stops receiving from the socket until one of them is
+    /// done; the queries arriving meanwhile wait in the socket buffer.
+    /// The state of the queries is kept for reuse up to this number, too.
+    ///
+    /// \throw bundy::InvalidParameter max_outstanding is 0
+    /// \param max_outstanding The maximum number of queries
+    void setMaxOutstanding(size_t max_outstanding);
+
+    /// \brief Return the maximum number of queries handled at a time
+    size_t getMaxOutstanding() const;
+
+    /// \brief Return the number of queries being handled
+    size_t getOutstanding() const;
+
 private:
     enum { MAX_LENGTH = 4096 };
 
@@ -85,10 +102,17 @@ private:
      * We use the pimple design pattern, but not because we need to hide
      * internal data. This class and whole header is for private use anyway.
      * It turned out that UDPServer is copied a lot, because it is a coroutine.
-     * This way the overhead of copying is lower, we copy only one shared
-     * pointer instead of about 10 of them.
+     * This way the overhead of copying is lower, we copy two shared pointers
+     * instead of about 10 of them.
+     *
+     * The Pool holds what is shared by all the copies (the socket and the
+     * callbacks) and the states of the queries not in use, and Data the
+     * state of a single query, which returns to the pool when the last copy
+     * handling the query is gone.
      */
+    class Pool;
     struct Data;
+    boost::shared_ptr<Pool> pool_;
     boost::shared_ptr<Data> data_;
 };
 
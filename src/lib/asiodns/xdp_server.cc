@@ -0,0 +1,992 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <asio.hpp>
+#include <asio/error.hpp>
+
+#include "xdp_server.h"
+#include "logger.h"
+
+#include <asiolink/io_error.h>
+#include <asiolink/io_message.h>
+#include <asiolink/io_socket.h>
+#include <util/threads/sync.h>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#if defined(HAVE_LINUX_IF_XDP_H) && defined(HAVE_LINUX_BPF_H) && \
+    defined(AF_XDP)
+#define XDP_SERVER_SUPPORTED 1
+#endif
+
+#ifdef XDP_SERVER_SUPPORTED
+#include <linux/bpf.h>
+#include <linux/if_xdp.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+#endif
+
+using namespace std;
+using namespace bundy::asiolink;
+
+namespace bundy {
+namespace asiodns {
+
+namespace xdp {
+
+namespace {
+const size_t ETHER_HEADER_LENGTH = 14;
+const size_t IPV4_HEADER_LENGTH = 20;
+const size_t IPV6_HEADER_LENGTH = 40;
+const size_t UDP_HEADER_LENGTH = 8;
+const size_t DNS_HEADER_LENGTH = 12;
+
+inline uint16_t
+readUint16(const uint8_t* data) {
+    return ((data[0] << 8) | data[1]);
+}
+
+inline void
+writeUint16(uint8_t* data, uint16_t value) {
+    data[0] = value >> 8;
+    data[1] = value & 0xff;
+}
+
+// Add data to a one's complement checksum, 16 bits at a time
+uint32_t
+addChecksum(uint32_t sum, const uint8_t* data, size_t length) {
+    for (size_t i = 0; i + 1 < length; i += 2) {
+        sum += readUint16(data + i);
+    }
+    if ((length % 2) != 0) {
+        sum += data[length - 1] << 8;
+    }
+    return (sum);
+}
+
+uint16_t
+finishChecksum(uint32_t sum) {
+    while ((sum >> 16) != 0) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return (~sum & 0xffff);
+}
+}
+
+bool
+parseFrame(const uint8_t* frame, size_t length, FrameInfo& info) {
+    if (length < ETHER_HEADER_LENGTH) {
+        return (false);
+    }
+    // The lengths are taken from the headers, as the frame may be padded.
+    size_t ip_payload_length;
+    switch (readUint16(frame + 12)) {
+    case 0x0800: {
+        const uint8_t* const ip = frame + ETHER_HEADER_LENGTH;
+        if (length < ETHER_HEADER_LENGTH + IPV4_HEADER_LENGTH ||
+            ip[0] != 0x45 ||    // version 4 without options
+            (readUint16(ip + 6) & 0x3fff) != 0 || // a fragment
+            ip[9] != IPPROTO_UDP) {
+            return (false);
+        }
+        const size_t total_length = readUint16(ip + 2);
+        if (total_length < IPV4_HEADER_LENGTH ||
+            ETHER_HEADER_LENGTH + total_length > length) {
+            return (false);
+        }
+        info.af_ = AF_INET;
+        info.udp_offset_ = ETHER_HEADER_LENGTH + IPV4_HEADER_LENGTH;
+        ip_payload_length = total_length - IPV4_HEADER_LENGTH;
+        break;
+    }
+    case 0x86dd: {
+        const uint8_t* const ip = frame + ETHER_HEADER_LENGTH;
+        if (length < ETHER_HEADER_LENGTH + IPV6_HEADER_LENGTH ||
+            (ip[0] >> 4) != 6 ||
+            ip[6] != IPPROTO_UDP) { // no extension header
+            return (false);
+        }
+        ip_payload_length = readUint16(ip + 4);
+        if (ETHER_HEADER_LENGTH + IPV6_HEADER_LENGTH + ip_payload_length >
+            length) {
+            return (false);
+        }
+        info.af_ = AF_INET6;
+        info.udp_offset_ = ETHER_HEADER_LENGTH + IPV6_HEADER_LENGTH;
+        break;
+    }
+    default:
+        return (false);
+    }
+    if (ip_payload_length < UDP_HEADER_LENGTH) {
+        return (false);
+    }
+    const size_t udp_length = readUint16(frame + info.udp_offset_ + 4);
+    if (udp_length < UDP_HEADER_LENGTH || udp_length > ip_payload_length) {
+        return (false);
+    }
+    info.payload_length_ = udp_length - UDP_HEADER_LENGTH;
+    return (true);
+}
+
+size_t
+makeResponseFrame(uint8_t* frame, const FrameInfo& info,
+                  size_t payload_length)
+{
+    // Ethernet addresses
+    uint8_t mac[6];
+    memcpy(mac, frame, 6);
+    memcpy(frame, frame + 6, 6);
+    memcpy(frame + 6, mac, 6);
+
+    // UDP ports and length
+    uint8_t* const udp = frame + info.udp_offset_;
+    const size_t udp_length = UDP_HEADER_LENGTH + payload_length;
+    uint8_t port[2];
+    memcpy(port, udp, 2);
+    memcpy(udp, udp + 2, 2);
+    memcpy(udp + 2, port, 2);
+    writeUint16(udp + 4, udp_length);
+    writeUint16(udp + 6, 0);
+
+    // IP header, and the pseudo header part of the UDP checksum
+    uint8_t* const ip = frame + ETHER_HEADER_LENGTH;
+    uint32_t sum = IPPROTO_UDP + udp_length;
+    if (info.af_ == AF_INET) {
+        uint8_t address[4];
+        writeUint16(ip + 2, IPV4_HEADER_LENGTH + udp_length);
+        writeUint16(ip + 6, 0x4000); // don't fragment
+        ip[8] = 64;                  // TTL
+        memcpy(address, ip + 12, 4);
+        memcpy(ip + 12, ip + 16, 4);
+        memcpy(ip + 16, address, 4);
+        writeUint16(ip + 10, 0);
+        writeUint16(ip + 10,
+                    finishChecksum(addChecksum(0, ip, IPV4_HEADER_LENGTH)));
+        sum = addChecksum(sum, ip + 12, 8);
+    } else {
+        uint8_t address[16];
+        writeUint16(ip + 4, udp_length);
+        ip[7] = 64;                 // hop limit
+        memcpy(address, ip + 8, 16);
+        memcpy(ip + 8, ip + 24, 16);
+        memcpy(ip + 24, address, 16);
+        sum = addChecksum(sum, ip + 8, 32);
+    }
+    uint16_t checksum = finishChecksum(addChecksum(sum, udp, udp_length));
+    if (checksum == 0) {
+        checksum = 0xffff;
+    }
+    writeUint16(udp + 6, checksum);
+
+    return (info.udp_offset_ + udp_length);
+}
+
+size_t
+truncateResponse(const uint8_t* response, size_t length, uint8_t* buffer,
+                 size_t max_length)
+{
+    if (length < DNS_HEADER_LENGTH) {
+        return (0);
+    }
+    size_t pos = DNS_HEADER_LENGTH;
+    const size_t qdcount = readUint16(response + 4);
+    for (size_t i = 0; i < qdcount; ++i) {
+        // Skip the name; only the first one can't be compressed.
+        while (true) {
+            if (pos >= length) {
+                return (0);
+            }
+            const uint8_t label_length = response[pos];
+            if (label_length == 0) {
+                ++pos;
+                break;
+            } else if ((label_length & 0xc0) == 0xc0) {
+                pos += 2;
+                break;
+            } else if ((label_length & 0xc0) != 0) {
+                return (0);
+            }
+            pos += 1 + label_length;
+        }
+        pos += 4;               // type and class
+        if (pos > length) {
+            return (0);
+        }
+    }
+    if (pos > max_length) {
+        return (0);
+    }
+    memmove(buffer, response, pos);
+    buffer[2] |= 0x02;          // TC
+    memset(buffer + 6, 0, 6);   // ANCOUNT, NSCOUNT and ARCOUNT
+    return (pos);
+}
+
+} // namespace xdp
+
+#ifdef XDP_SERVER_SUPPORTED
+namespace {
+// The UMEM is split in NUM_FRAMES frames of FRAME_SIZE bytes, and each ring
+// can hold all of them, so a ring can never overflow: a frame is always in
+// exactly one of the rings, or being handled.
+const size_t FRAME_SIZE = 4096;
+const uint32_t NUM_FRAMES = 2048;
+const uint32_t RING_SIZE = NUM_FRAMES;
+
+// The maximum number of frames handled before their answers are sent
+const uint32_t BATCH_SIZE = 64;
+
+// How long to wait before checking again for completed transmissions, in
+// milliseconds
+const long RECLAIM_INTERVAL = 1;
+
+void
+throwError(const char* what) {
+    const int error = errno;
+    bundy_throw(IOError, "AF_XDP setup failed: " << what << ": " <<
+                std::strerror(error));
+}
+
+inline uint32_t
+loadAcquire(const uint32_t* ptr) {
+    return (__atomic_load_n(ptr, __ATOMIC_ACQUIRE));
+}
+
+inline void
+storeRelease(uint32_t* ptr, uint32_t value) {
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+// One of the four rings shared with the kernel.  The producer and consumer
+// indexes are free running; the entries are at index & (RING_SIZE - 1).
+// The index we update is only written by us, so we can read it plainly.
+template <typename Entry>
+struct XSKRing : boost::noncopyable {
+    XSKRing() : producer_(NULL), consumer_(NULL), entries_(NULL),
+                map_(MAP_FAILED), map_size_(0)
+    {}
+    ~XSKRing() {
+        if (map_ != MAP_FAILED) {
+            munmap(map_, map_size_);
+        }
+    }
+
+    void map(int fd, const struct xdp_ring_offset& offsets, off_t pgoff) {
+        map_size_ = offsets.desc + RING_SIZE * sizeof(Entry);
+        map_ = mmap(NULL, map_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, pgoff);
+        if (map_ == MAP_FAILED) {
+            throwError("mmap ring");
+        }
+        char* const base = static_cast<char*>(map_);
+        producer_ = reinterpret_cast<uint32_t*>(base + offsets.producer);
+        consumer_ = reinterpret_cast<uint32_t*>(base + offsets.consumer);
+        entries_ = reinterpret_cast<Entry*>(base + offsets.desc);
+    }
+
+    Entry& operator[](uint32_t index) {
+        return (entries_[index & (RING_SIZE - 1)]);
+    }
+
+    uint32_t* producer_;
+    uint32_t* consumer_;
+    Entry* entries_;
+    void* map_;
+    size_t map_size_;
+};
+
+int
+bpf(int cmd, union bpf_attr& attr) {
+    return (syscall(__NR_bpf, cmd, &attr, sizeof(attr)));
+}
+
+// A tiny assembler for the XDP program.  Jumps refer to labels, which are
+// resolved by finish().
+class BPFAssembler {
+public:
+    void emit(uint8_t code, uint8_t dst, uint8_t src, int16_t off,
+              int32_t imm)
+    {
+        struct bpf_insn insn;
+        memset(&insn, 0, sizeof(insn));
+        insn.code = code;
+        insn.dst_reg = dst;
+        insn.src_reg = src;
+        insn.off = off;
+        insn.imm = imm;
+        insns_.push_back(insn);
+    }
+
+    // Jump to label if dst <op> imm
+    void jumpIf(uint8_t op, uint8_t dst, int32_t imm, int label) {
+        fixups_.push_back(std::make_pair(insns_.size(), label));
+        emit(BPF_JMP | op | BPF_K, dst, 0, 0, imm);
+    }
+
+    // Jump to label if dst <op> src
+    void jumpIfReg(uint8_t op, uint8_t dst, uint8_t src, int label) {
+        fixups_.push_back(std::make_pair(insns_.size(), label));
+        emit(BPF_JMP | op | BPF_X, dst, src, 0, 0);
+    }
+
+    // Load a byte of the packet (whose start is in r2) into r5
+    void loadByte(int16_t offset) {
+        emit(BPF_LDX | BPF_B | BPF_MEM, BPF_REG_5, BPF_REG_2, offset, 0);
+    }
+
+    void setLabel(int label) {
+        labels_[label] = insns_.size();
+    }
+
+    const std::vector<struct bpf_insn>& finish() {
+        for (size_t i = 0; i < fixups_.size(); ++i) {
+            const size_t from = fixups_[i].first;
+            insns_[from].off = labels_[fixups_[i].second] - (from + 1);
+        }
+        return (insns_);
+    }
+
+private:
+    std::vector<struct bpf_insn> insns_;
+    std::vector<std::pair<size_t, int> > fixups_;
+    std::map<int, size_t> labels_;
+};
+
+// Build the XDP program redirecting DNS queries to the given port to the
+// socket of the receive queue in the map, and passing anything else to the
+// kernel.  See the XDPServer class description for what is redirected.
+// Only single bytes are loaded from the packet, so the program doesn't
+// depend on the byte order.
+std::vector<struct bpf_insn>
+buildProgram(int map_fd, uint16_t port) {
+    enum { PASS, IPV6, REDIRECT };
+    BPFAssembler a;
+
+    // r6 = ctx, r2 = data, r3 = data_end
+    a.emit(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_6, BPF_REG_1, 0, 0);
+    a.emit(BPF_LDX | BPF_W | BPF_MEM, BPF_REG_2, BPF_REG_6,
+           offsetof(struct xdp_md, data), 0);
+    a.emit(BPF_LDX | BPF_W | BPF_MEM, BPF_REG_3, BPF_REG_6,
+           offsetof(struct xdp_md, data_end), 0);
+
+    // IPv4: Ethernet (14) + IP (20) + UDP (8) + the DNS flags (3)
+    a.emit(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0);
+    a.emit(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0, 45);
+    a.jumpIfReg(BPF_JGT, BPF_REG_4, BPF_REG_3, PASS);
+    a.loadByte(12);             // ethertype
+    a.jumpIf(BPF_JEQ, BPF_REG_5, 0x86, IPV6);
+    a.jumpIf(BPF_JNE, BPF_REG_5, 0x08, PASS);
+    a.loadByte(13);
+    a.jumpIf(BPF_JNE, BPF_REG_5, 0x00, PASS);
+    a.loadByte(14);             // version and header length
+    a.jumpIf(BPF_JNE, BPF_REG_5, 0x45, PASS);
+    a.loadByte(20);             // MF and fragment offset
+    a.emit(BPF_ALU64 | BPF_AND | BPF_K, BPF_REG_5, 0, 0, 0x3f);
+    a.jumpIf(BPF_JNE, BPF_REG_5, 0, PASS);
+    a.loadByte(21);
+    a.jumpIf(BPF_JNE, BPF_REG_5, 0, PASS);
+    a.loadByte(23);             // protocol
+    a.jumpIf(BPF_JNE, BPF_REG_5, IPPROTO_UDP, PASS);
+    a.loadByte(36);             // destination port
+    a.jumpIf(BPF_JNE, BPF_REG_5, port >> 8, PASS);
+    a.loadByte(37);
+    a.jumpIf(BPF_JNE, BPF_REG_5, port & 0xff, PASS);
+    a.loadByte(44);             // QR and opcode
+    a.emit(BPF_ALU64 | BPF_AND | BPF_K, BPF_REG_5, 0, 0, 0xf8);
+    a.jumpIf(BPF_JNE, BPF_REG_5, 0, PASS);
+    a.jumpIf(BPF_JA, 0, 0, REDIRECT);
+
+    // IPv6: Ethernet (14) + IP (40) + UDP (8) + the DNS flags (3)
+    a.setLabel(IPV6);
+    a.loadByte(13);
+    a.jumpIf(BPF_JNE, BPF_REG_5, 0xdd, PASS);
+    a.emit(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0);
+    a.emit(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0, 65);
+    a.jumpIfReg(BPF_JGT, BPF_REG_4, BPF_REG_3, PASS);
+    a.loadByte(20);             // next header
+    a.jumpIf(BPF_JNE, BPF_REG_5, IPPROTO_UDP, PASS);
+    a.loadByte(56);             // destination port
+    a.jumpIf(BPF_JNE, BPF_REG_5, port >> 8, PASS);
+    a.loadByte(57);
+    a.jumpIf(BPF_JNE, BPF_REG_5, port & 0xff, PASS);
+    a.loadByte(64);             // QR and opcode
+    a.emit(BPF_ALU64 | BPF_AND | BPF_K, BPF_REG_5, 0, 0, 0xf8);
+    a.jumpIf(BPF_JNE, BPF_REG_5, 0, PASS);
+
+    // return bpf_redirect_map(&map, ctx->rx_queue_index, XDP_PASS)
+    a.setLabel(REDIRECT);
+    a.emit(BPF_LDX | BPF_W | BPF_MEM, BPF_REG_2, BPF_REG_6,
+           offsetof(struct xdp_md, rx_queue_index), 0);
+    a.emit(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0,
+           map_fd);
+    a.emit(0, 0, 0, 0, 0);
+    a.emit(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS);
+    a.emit(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map);
+    a.emit(BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+
+    a.setLabel(PASS);
+    a.emit(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, XDP_PASS);
+    a.emit(BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+
+    return (a.finish());
+}
+
+// The XDP program attached to an interface, and the map of the sockets it
+// redirects to.  It's shared by the servers on the interface, and detached
+// when the last one goes away.
+class XDPProgram : boost::noncopyable {
+public:
+    typedef boost::shared_ptr<XDPProgram> Ptr;
+
+    // Return the program attached to the interface, attaching it first if
+    // needed.
+    static Ptr get(int ifindex, uint16_t port) {
+        static bundy::util::thread::Mutex mutex;
+        static std::map<int, boost::weak_ptr<XDPProgram> > programs;
+
+        bundy::util::thread::Mutex::Locker locker(mutex);
+        Ptr program = programs[ifindex].lock();
+        if (!program) {
+            program.reset(new XDPProgram(ifindex, port));
+            programs[ifindex] = program;
+        } else if (program->port_ != port) {
+            bundy_throw(IOError, "AF_XDP setup failed: the interface is "
+                        "already used for port " << program->port_);
+        }
+        return (program);
+    }
+
+    ~XDPProgram() {
+        // Closing the link detaches the program.
+        closeFd(link_fd_);
+        closeFd(prog_fd_);
+        closeFd(map_fd_);
+    }
+
+    // Redirect the queries received on the queue to the socket.
+    void addSocket(unsigned int queue_id, int fd) {
+        const uint32_t key = queue_id;
+        const uint32_t value = fd;
+        union bpf_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.map_fd = map_fd_;
+        attr.key = reinterpret_cast<uintptr_t>(&key);
+        attr.value = reinterpret_cast<uintptr_t>(&value);
+        attr.flags = BPF_ANY;
+        if (bpf(BPF_MAP_UPDATE_ELEM, attr) < 0) {
+            throwError("update XSK map");
+        }
+    }
+
+private:
+    XDPProgram(int ifindex, uint16_t port) :
+        port_(port), map_fd_(-1), prog_fd_(-1), link_fd_(-1)
+    {
+        try {
+            union bpf_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.map_type = BPF_MAP_TYPE_XSKMAP;
+            attr.key_size = sizeof(uint32_t);
+            attr.value_size = sizeof(uint32_t);
+            attr.max_entries = XDPServer::MAX_QUEUE_ID + 1;
+            map_fd_ = bpf(BPF_MAP_CREATE, attr);
+            if (map_fd_ < 0) {
+                throwError("create XSK map");
+            }
+
+            const std::vector<struct bpf_insn> insns =
+                buildProgram(map_fd_, port);
+            static const char license[] = "ISC";
+            std::vector<char> log(65536);
+            memset(&attr, 0, sizeof(attr));
+            attr.prog_type = BPF_PROG_TYPE_XDP;
+            attr.insns = reinterpret_cast<uintptr_t>(&insns[0]);
+            attr.insn_cnt = insns.size();
+            attr.license = reinterpret_cast<uintptr_t>(license);
+            attr.log_buf = reinterpret_cast<uintptr_t>(&log[0]);
+            attr.log_size = log.size();
+            attr.log_level = 1;
+            prog_fd_ = bpf(BPF_PROG_LOAD, attr);
+            if (prog_fd_ < 0) {
+                const int error = errno;
+                log.back() = '\0';
+                bundy_throw(IOError, "AF_XDP setup failed: load XDP "
+                            "program: " << std::strerror(error) << ": " <<
+                            &log[0]);
+            }
+
+            memset(&attr, 0, sizeof(attr));
+            attr.link_create.prog_fd = prog_fd_;
+            attr.link_create.target_ifindex = ifindex;
+            attr.link_create.attach_type = BPF_XDP;
+            link_fd_ = bpf(BPF_LINK_CREATE, attr);
+            if (link_fd_ < 0) {
+                throwError("attach XDP program");
+            }
+        } catch (...) {
+            closeFd(prog_fd_);
+            closeFd(map_fd_);
+            throw;
+        }
+    }
+
+    static void closeFd(int fd) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    const uint16_t port_;
+    int map_fd_;
+    int prog_fd_;
+    int link_fd_;
+};
+}
+
+struct XDPServer::XSKContext {
+    XSKContext(asio::io_service& io_service, const std::string& ifname,
+               unsigned int queue_id, uint16_t port) :
+        descriptor_(io_service), timer_(io_service), umem_(MAP_FAILED),
+        max_frame_length_(0), outstanding_(0), timer_armed_(false),
+        zero_copy_(false)
+    {
+        const unsigned int ifindex = if_nametoindex(ifname.c_str());
+        if (ifindex == 0) {
+            throwError(ifname.c_str());
+        }
+
+        const int fd = socket(AF_XDP, SOCK_RAW | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            throwError("socket");
+        }
+        // From now on the descriptor owns the socket.
+        descriptor_.assign(fd);
+
+        // The frames can't be larger than the MTU, as they can't be
+        // fragmented.  AF_XDP sockets don't handle the interface ioctls,
+        // so ask with a throwaway UDP socket.
+        struct ifreq ifr;
+        memset(&ifr, 0, sizeof(ifr));
+        strncpy(ifr.ifr_name, ifname.c_str(), IFNAMSIZ - 1);
+        const int ioctl_fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (ioctl_fd < 0) {
+            throwError("get MTU");
+        }
+        const int ioctl_result = ioctl(ioctl_fd, SIOCGIFMTU, &ifr);
+        const int ioctl_errno = errno;
+        close(ioctl_fd);
+        if (ioctl_result < 0) {
+            errno = ioctl_errno;
+            throwError("get MTU");
+        }
+        max_frame_length_ = xdp::ETHER_HEADER_LENGTH + ifr.ifr_mtu;
+
+        const size_t umem_size = NUM_FRAMES * FRAME_SIZE;
+        umem_ = mmap(NULL, umem_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (umem_ == MAP_FAILED) {
+            throwError("mmap UMEM");
+        }
+        struct xdp_umem_reg umem_reg;
+        memset(&umem_reg, 0, sizeof(umem_reg));
+        umem_reg.addr = reinterpret_cast<uintptr_t>(umem_);
+        umem_reg.len = umem_size;
+        umem_reg.chunk_size = FRAME_SIZE;
+        umem_reg.headroom = 0;
+        if (setsockopt(fd, SOL_XDP, XDP_UMEM_REG, &umem_reg,
+                       sizeof(umem_reg)) < 0) {
+            throwError("register UMEM");
+        }
+
+        const int ring_size = RING_SIZE;
+        if (setsockopt(fd, SOL_XDP, XDP_UMEM_FILL_RING, &ring_size,
+                       sizeof(ring_size)) < 0 ||
+            setsockopt(fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &ring_size,
+                       sizeof(ring_size)) < 0 ||
+            setsockopt(fd, SOL_XDP, XDP_RX_RING, &ring_size,
+                       sizeof(ring_size)) < 0 ||
+            setsockopt(fd, SOL_XDP, XDP_TX_RING, &ring_size,
+                       sizeof(ring_size)) < 0) {
+            throwError("set ring size");
+        }
+        struct xdp_mmap_offsets offsets;
+        socklen_t optlen = sizeof(offsets);
+        if (getsockopt(fd, SOL_XDP, XDP_MMAP_OFFSETS, &offsets,
+                       &optlen) < 0) {
+            throwError("get ring offsets");
+        }
+        fill_.map(fd, offsets.fr, XDP_UMEM_PGOFF_FILL_RING);
+        comp_.map(fd, offsets.cr, XDP_UMEM_PGOFF_COMPLETION_RING);
+        rx_.map(fd, offsets.rx, XDP_PGOFF_RX_RING);
+        tx_.map(fd, offsets.tx, XDP_PGOFF_TX_RING);
+
+        // Give all frames to the kernel to receive in.
+        for (uint32_t i = 0; i < NUM_FRAMES; ++i) {
+            fill_[i] = static_cast<uint64_t>(i) * FRAME_SIZE;
+        }
+        storeRelease(fill_.producer_, NUM_FRAMES);
+
+        struct sockaddr_xdp sxdp;
+        memset(&sxdp, 0, sizeof(sxdp));
+        sxdp.sxdp_family = AF_XDP;
+        sxdp.sxdp_ifindex = ifindex;
+        sxdp.sxdp_queue_id = queue_id;
+        if (bind(fd, reinterpret_cast<struct sockaddr*>(&sxdp),
+                 sizeof(sxdp)) < 0) {
+            throwError("bind");
+        }
+
+        struct xdp_options options;
+        optlen = sizeof(options);
+        if (getsockopt(fd, SOL_XDP, XDP_OPTIONS, &options, &optlen) == 0) {
+            zero_copy_ = (options.flags & XDP_OPTIONS_ZEROCOPY) != 0;
+        }
+
+        program_ = XDPProgram::get(ifindex, port);
+        program_->addSocket(queue_id, fd);
+    }
+
+    ~XSKContext() {
+        asio::error_code ec;
+        descriptor_.close(ec);
+        // The rings are unmapped by their destructors, after the UMEM, but
+        // the socket is closed already.
+        if (umem_ != MAP_FAILED) {
+            munmap(umem_, NUM_FRAMES * FRAME_SIZE);
+        }
+    }
+
+    uint8_t* getFrame(uint64_t addr) {
+        return (static_cast<uint8_t*>(umem_) + addr);
+    }
+
+    // Ask the kernel to send the frames in the TX ring.
+    void kick() {
+        if (sendto(descriptor_.native(), NULL, 0, MSG_DONTWAIT, NULL, 0) <
+            0) {
+            // These only mean the kernel is busy, and it'll pick up the
+            // frames on the next kick.
+            if (errno != EAGAIN && errno != EBUSY && errno != ENOBUFS &&
+                errno != EINTR) {
+                LOG_ERROR(logger, ASIODNS_XDP_SEND_FAIL).
+                    arg(std::strerror(errno));
+            }
+        }
+    }
+
+    asio::posix::stream_descriptor descriptor_;
+    asio::deadline_timer timer_;
+    void* umem_;
+    XSKRing<uint64_t> fill_;
+    XSKRing<uint64_t> comp_;
+    XSKRing<struct xdp_desc> rx_;
+    XSKRing<struct xdp_desc> tx_;
+    XDPProgram::Ptr program_;
+    size_t max_frame_length_;
+    // The number of frames sent but not completed yet
+    size_t outstanding_;
+    bool timer_armed_;
+    bool zero_copy_;
+};
+#else
+// Not used, just make scoped_ptr happy.
+struct XDPServer::XSKContext {};
+#endif
+
+const unsigned int XDPServer::MAX_QUEUE_ID;
+
+bool
+XDPServer::isSupported() {
+#ifdef XDP_SERVER_SUPPORTED
+    return (true);
+#else
+    return (false);
+#endif
+}
+
+XDPServerPtr
+XDPServer::create(asio::io_service& io_service, const std::string& ifname,
+                  unsigned int queue_id, uint16_t port, DNSLookup* lookup)
+{
+    return (XDPServerPtr(new XDPServer(io_service, ifname, queue_id, port,
+                                       lookup)));
+}
+
+XDPServer::XDPServer(asio::io_service& io_service, const std::string& ifname,
+                     unsigned int queue_id, uint16_t port,
+                     DNSLookup* lookup) :
+    output_buffer_(new bundy::util::OutputBuffer(0)),
+    query_(new bundy::dns::Message(bundy::dns::Message::PARSE)),
+    udp_endpoint_(sender_), lookup_callback_(lookup),
+    resume_called_(false), done_(false), stopped_(false)
+{
+    if (!lookup) {
+        bundy_throw(InvalidParameter, "null lookup callback given to "
+                    "XDPServer");
+    }
+    if (queue_id > MAX_QUEUE_ID) {
+        bundy_throw(InvalidParameter, "XDP queue must be at most " <<
+                    MAX_QUEUE_ID << ", not " << queue_id);
+    }
+#ifdef XDP_SERVER_SUPPORTED
+    xsk_.reset(new XSKContext(io_service, ifname, queue_id, port));
+    LOG_INFO(logger, ASIODNS_XDP_SERVER_STARTED).arg(ifname).arg(queue_id).
+        arg(xsk_->zero_copy_ ? "zero-copy" : "copy");
+#else
+    (void)io_service;
+    (void)ifname;
+    (void)port;
+    bundy_throw(NotImplemented, "AF_XDP isn't supported on this system");
+#endif
+}
+
+XDPServer::~XDPServer() {}
+
+#ifdef XDP_SERVER_SUPPORTED
+void
+XDPServer::scheduleRead() {
+    xsk_->descriptor_.async_read_some(
+        asio::null_buffers(),
+        boost::bind(&XDPServer::handleReadable, shared_from_this(), _1));
+}
+
+void
+XDPServer::handleReadable(const asio::error_code& ec) {
+    if (stopped_) {
+        return;
+    }
+    if (ec) {
+        using namespace asio::error;
+        const asio::error_code::value_type err_val = ec.value();
+        if (err_val == operation_aborted || err_val == bad_descriptor) {
+            return;
+        }
+        if (err_val != would_block && err_val != try_again &&
+            err_val != interrupted) {
+            LOG_ERROR(logger, ASIODNS_XDP_RECEIVE_FAIL).arg(ec.message());
+        }
+        scheduleRead();
+        return;
+    }
+
+    XSKContext& xsk = *xsk_;
+    // Don't starve the other handlers if the queries keep coming; the
+    // socket will be readable again right away.
+    for (uint32_t handled = 0; handled < RING_SIZE; ) {
+        const uint32_t rx_cons = *xsk.rx_.consumer_;
+        const uint32_t count = std::min(loadAcquire(xsk.rx_.producer_) -
+                                        rx_cons, BATCH_SIZE);
+        if (count == 0) {
+            break;
+        }
+        uint32_t tx_prod = *xsk.tx_.producer_;
+        uint32_t fill_prod = *xsk.fill_.producer_;
+        for (uint32_t i = 0; i < count; ++i) {
+            const struct xdp_desc& desc = xsk.rx_[rx_cons + i];
+            const uint64_t addr = desc.addr;
+            // The answer is built in the same frame, up to the end of the
+            // chunk (the packet may not start at its beginning).
+            const size_t room =
+                std::min<size_t>(FRAME_SIZE - (addr % FRAME_SIZE),
+                                 xsk.max_frame_length_);
+            const size_t length = handleFrame(xsk.getFrame(addr), desc.len,
+                                              room);
+            if (stopped_) {
+                // The callback stopped us; the socket is already closed.
+                return;
+            }
+            if (length > 0) {
+                struct xdp_desc& tx_desc = xsk.tx_[tx_prod++];
+                tx_desc.addr = addr;
+                tx_desc.len = length;
+                tx_desc.options = 0;
+            } else {
+                xsk.fill_[fill_prod++] = addr;
+            }
+        }
+        storeRelease(xsk.rx_.consumer_, rx_cons + count);
+        storeRelease(xsk.fill_.producer_, fill_prod);
+        const uint32_t sent = tx_prod - *xsk.tx_.producer_;
+        if (sent > 0) {
+            storeRelease(xsk.tx_.producer_, tx_prod);
+            xsk.outstanding_ += sent;
+            xsk.kick();
+        }
+        handled += count;
+    }
+    reclaimFrames();
+
+    scheduleRead();
+}
+
+size_t
+XDPServer::handleFrame(uint8_t* frame, size_t length, size_t room) {
+    xdp::FrameInfo info;
+    if (!xdp::parseFrame(frame, length, info)) {
+        return (0);
+    }
+    const uint8_t* const ip = frame + xdp::ETHER_HEADER_LENGTH;
+    const uint16_t port = xdp::readUint16(frame + info.udp_offset_);
+    if (info.af_ == AF_INET) {
+        asio::ip::address_v4::bytes_type address;
+        memcpy(address.data(), ip + 12, address.size());
+        sender_ = asio::ip::udp::endpoint(asio::ip::address_v4(address),
+                                          port);
+    } else {
+        asio::ip::address_v6::bytes_type address;
+        memcpy(address.data(), ip + 8, address.size());
+        sender_ = asio::ip::udp::endpoint(asio::ip::address_v6(address),
+                                          port);
+    }
+
+    // See SyncUDPServer::handleRead() about the buffers and query_.
+    output_buffer_->clear();
+    done_ = false;
+    resume_called_ = false;
+
+    uint8_t* const payload =
+        frame + info.udp_offset_ + xdp::UDP_HEADER_LENGTH;
+    const IOMessage message(payload, info.payload_length_,
+                            IOSocket::getDummyUDPSocket(), udp_endpoint_);
+    (*lookup_callback_)(message, query_, answer_, output_buffer_, this);
+
+    if (!resume_called_) {
+        bundy_throw(bundy::Unexpected,
+                    "No resume called from the lookup callback");
+    }
+    if (stopped_ || !done_) {
+        return (0);
+    }
+
+    // room is at least the length of the query frame, so this can't
+    // underflow.
+    const size_t max_payload_length =
+        room - info.udp_offset_ - xdp::UDP_HEADER_LENGTH;
+    const uint8_t* const answer =
+        static_cast<const uint8_t*>(output_buffer_->getData());
+    size_t payload_length = output_buffer_->getLength();
+    if (payload_length <= max_payload_length) {
+        memcpy(payload, answer, payload_length);
+    } else {
+        payload_length = xdp::truncateResponse(answer, payload_length,
+                                               payload, max_payload_length);
+        if (payload_length == 0) {
+            return (0);
+        }
+    }
+    return (xdp::makeResponseFrame(frame, info, payload_length));
+}
+
+void
+XDPServer::reclaimFrames() {
+    XSKContext& xsk = *xsk_;
+    const uint32_t comp_cons = *xsk.comp_.consumer_;
+    const uint32_t count = loadAcquire(xsk.comp_.producer_) - comp_cons;
+    if (count > 0) {
+        uint32_t fill_prod = *xsk.fill_.producer_;
+        for (uint32_t i = 0; i < count; ++i) {
+            xsk.fill_[fill_prod++] = xsk.comp_[comp_cons + i];
+        }
+        storeRelease(xsk.comp_.consumer_, comp_cons + count);
+        storeRelease(xsk.fill_.producer_, fill_prod);
+        xsk.outstanding_ -= count;
+    }
+
+    // If the kernel hasn't sent everything yet, check again a bit later;
+    // otherwise the frames would only be reclaimed with the next query,
+    // which might never come if they were all used.
+    if (xsk.outstanding_ > 0 && !xsk.timer_armed_) {
+        xsk.timer_armed_ = true;
+        xsk.timer_.expires_from_now(
+            boost::posix_time::milliseconds(RECLAIM_INTERVAL));
+        xsk.timer_.async_wait(boost::bind(&XDPServer::handleReclaimTimer,
+                                          shared_from_this(), _1));
+    }
+}
+
+void
+XDPServer::handleReclaimTimer(const asio::error_code& ec) {
+    xsk_->timer_armed_ = false;
+    if (stopped_ || ec) {
+        return;
+    }
+    xsk_->kick();
+    reclaimFrames();
+}
+
+void
+XDPServer::operator()(asio::error_code, size_t) {
+    scheduleRead();
+}
+
+void
+XDPServer::stop() {
+    asio::error_code ec;
+    xsk_->timer_.cancel(ec);
+    xsk_->descriptor_.close(ec);
+    stopped_ = true;
+    if (ec) {
+        LOG_ERROR(logger, ASIODNS_XDP_CLOSE_FAIL).arg(ec.message());
+    }
+}
+#else
+// The constructor always throws in this case, so these can't be called.
+void XDPServer::scheduleRead() { assert(false); }
+void XDPServer::handleReadable(const asio::error_code&) { assert(false); }
+size_t XDPServer::handleFrame(uint8_t*, size_t, size_t) {
+    assert(false);
+    return (0);
+}
+void XDPServer::reclaimFrames() { assert(false); }
+void XDPServer::handleReclaimTimer(const asio::error_code&) { assert(false); }
+void XDPServer::operator()(asio::error_code, size_t) { assert(false); }
+void XDPServer::stop() { assert(false); }
+#endif
+
+void
+XDPServer::resume(const bool done) {
+    resume_called_ = true;
+    done_ = done;
+}
+
+bool
+XDPServer::hasAnswer() {
+    return (done_);
+}
+
+} // namespace asiodns
+} // namespace bundy
@@ -0,0 +1,235 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef XDP_SERVER_H
+#define XDP_SERVER_H 1
+
+#ifndef ASIO_HPP
+#error "asio.hpp must be included before including this, see asiolink.h as to why"
+#endif
+
+#include "dns_lookup.h"
+#include "dns_server.h"
+
+#include <dns/message.h>
+#include <asiolink/udp_endpoint.h>
+#include <util/buffer.h>
+#include <exceptions/exceptions.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+
+#include <string>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace asiodns {
+
+class XDPServer;
+typedef boost::shared_ptr<XDPServer> XDPServerPtr;
+
+/// \brief A UDP server that receives queries with AF_XDP, bypassing the
+/// kernel network stack.
+///
+/// The server opens an AF_XDP socket on one receive queue of a network
+/// interface, and attaches an XDP program to the interface (shared by all
+/// servers on the interface) that redirects UDP queries to the given port
+/// (normally 53) to that socket.  Only unfragmented IPv4 packets without
+/// IP options and IPv6 packets without extension headers are redirected,
+/// and only if the DNS header is that of a standard query (QR is 0 and
+/// the opcode is QUERY).  Anything else, including NOTIFY and UPDATE
+/// requests, is passed on to the kernel, so a normal UDP server should
+/// still be listening on the port.
+///
+/// Each query is handed to the lookup callback from the frame it was
+/// received in, without copying; like with \c SyncUDPServer the callback
+/// must build the complete answer before returning.  The answer is copied
+/// back into the same frame, whose Ethernet, IP and UDP headers are
+/// rewritten to send it back to the client, and the frame is queued for
+/// transmission.  As the frames can't be fragmented, an answer that
+/// doesn't fit in the MTU of the interface is replaced with a truncated
+/// one (the header and question with the TC bit set), so the client
+/// retries over TCP.
+///
+/// This requires Linux 5.9 or later, and the CAP_NET_ADMIN and CAP_BPF
+/// (or CAP_SYS_ADMIN) capabilities.  \c isSupported() tells whether the
+/// system headers were available at build time.
+///
+/// As with the other servers, a static factory method is provided, and
+/// the constructor is hidden as a private.
+class XDPServer : public DNSServer,
+                  public boost::enable_shared_from_this<XDPServer>,
+                  boost::noncopyable
+{
+private:
+    /// \brief Constructor.
+    ///
+    /// This is hidden as private (see the class description).
+    XDPServer(asio::io_service& io_service, const std::string& ifname,
+              unsigned int queue_id, uint16_t port, DNSLookup* lookup);
+
+public:
+    /// \brief The largest receive queue number accepted.
+    static const unsigned int MAX_QUEUE_ID = 255;
+
+    /// \brief Destructor.
+    ///
+    /// The socket is closed; the XDP program is detached from the
+    /// interface when the last server using it is destroyed.
+    virtual ~XDPServer();
+
+    /// \brief Return whether AF_XDP is supported by this build.
+    static bool isSupported();
+
+    /// \brief Factory of XDPServer object in the form of shared_ptr.
+    ///
+    /// \param io_service the asio::io_service to work with
+    /// \param ifname the name of the network interface
+    /// \param queue_id the receive queue of the interface
+    /// \param port the UDP port of the queries to handle
+    /// \param lookup the callback provider for DNS lookup events (must not
+    ///        be NULL)
+    ///
+    /// \throw bundy::NotImplemented AF_XDP isn't supported by this build
+    /// \throw bundy::InvalidParameter lookup is NULL, or queue_id is larger
+    ///     than \c MAX_QUEUE_ID
+    /// \throw bundy::asiolink::IOError the interface doesn't exist, or the
+    ///     socket or the XDP program can't be set up
+    static XDPServerPtr create(asio::io_service& io_service,
+                               const std::string& ifname,
+                               unsigned int queue_id, uint16_t port,
+                               DNSLookup* lookup);
+
+    /// \brief Start the XDPServer.
+    virtual void operator()(asio::error_code ec = asio::error_code(),
+                            size_t length = 0);
+
+    /// \brief Calls the lookup callback
+    virtual void asyncLookup() {
+        bundy_throw(Unexpected,
+                    "XDPServer doesn't support asyncLookup by design, use "
+                    "UDPServer if you need it.");
+    }
+
+    /// \brief Stop the running server
+    /// \note once the server stopped, it can't restart
+    virtual void stop();
+
+    /// \brief Resume operation
+    ///
+    /// Like for \c SyncUDPServer, it must be called directly from the
+    /// lookup callback.
+    ///
+    /// \param done Set this to true if the lookup action is done and
+    ///        we have an answer
+    virtual void resume(const bool done);
+
+    /// \brief Check if we have an answer
+    ///
+    /// \return true if we have an answer
+    virtual bool hasAnswer();
+
+    /// \brief Clones the object
+    ///
+    /// Like \c SyncUDPServer, this server can't be cloned and this throws
+    /// Unexpected.
+    virtual DNSServer* clone() {
+        bundy_throw(Unexpected, "XDPServer can't be cloned.");
+    }
+
+private:
+    // The socket, rings and frames.  Defined in the .cc to keep system
+    // specific stuff out of here.
+    struct XSKContext;
+    boost::scoped_ptr<XSKContext> xsk_;
+    // The buffer to render the answer to, before it's copied to the frame
+    bundy::util::OutputBufferPtr output_buffer_;
+    // See SyncUDPServer
+    bundy::dns::MessagePtr query_, answer_;
+    // The sender of the query being handled, and its IOEndpoint wrapper
+    asio::ip::udp::endpoint sender_;
+    asiolink::UDPEndpoint udp_endpoint_;
+    // Callback
+    const DNSLookup* lookup_callback_;
+    // Answers from the lookup callback
+    bool resume_called_, done_;
+    // This turns true when the server stops.
+    bool stopped_;
+
+    // Wait for the socket to be readable.
+    void scheduleRead();
+    // Handle the received frames.
+    void handleReadable(const asio::error_code& ec);
+    // Handle a single frame; return the length of the answer written in
+    // it, or 0 if it should be dropped.
+    size_t handleFrame(uint8_t* frame, size_t length, size_t room);
+    // Return the frames whose transmission is complete to the kernel, and
+    // schedule another try later if some are still outstanding.
+    void reclaimFrames();
+    // Callback of that later try.
+    void handleReclaimTimer(const asio::error_code& ec);
+};
+
+/// Helpers for \c XDPServer to parse and rewrite frames.  They are exposed
+/// for tests only.
+namespace xdp {
+
+/// \brief Where the headers of a DNS query are in a frame.
+struct FrameInfo {
+    /// The address family of the IP header, AF_INET or AF_INET6
+    int af_;
+    /// The offset of the UDP header
+    size_t udp_offset_;
+    /// The length of the DNS message, after the UDP header
+    size_t payload_length_;
+};
+
+/// \brief Check that a frame is a UDP datagram that \c XDPServer can
+/// handle, and locate its headers.
+///
+/// \return true if it is, false otherwise
+bool parseFrame(const uint8_t* frame, size_t length, FrameInfo& info);
+
+/// \brief Turn a frame parsed with \c parseFrame() into the response to
+/// it.
+///
+/// The source and destination addresses and ports are swapped, and the
+/// lengths and checksums are updated for the new payload, which must have
+/// been written after the UDP header.
+///
+/// \return the length of the response frame
+size_t makeResponseFrame(uint8_t* frame, const FrameInfo& info,
+                         size_t payload_length);
+
+/// \brief Write a truncated version of a DNS response.
+///
+/// Only the header and the question section are kept, and the TC bit is
+/// set.  The buffers may be the same.
+///
+/// \return the length of the truncated response, or 0 if the response is
+///     too broken to be truncated or doesn't fit in max_length
+size_t truncateResponse(const uint8_t* response, size_t length,
+                        uint8_t* buffer, size_t max_length);
+
+} // namespace xdp
+
+} // namespace asiodns
+} // namespace bundy
+#endif // XDP_SERVER_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -22,6 +22,7 @@
 #include <asiolink/io_service.h>
 #include <asiolink/simple_callback.h>
 #include <asiolink/interval_timer.h>
+#include <asiolink/timer_wheel.h>
 
 #include <asiolink/io_address.h>
 #include <asiolink/io_endpoint.h>
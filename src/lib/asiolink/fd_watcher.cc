@@ -0,0 +1,95 @@
+// Copyright (C) 2013  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <asiolink/fd_watcher.h>
+#include <asiolink/io_error.h>
+
+#include <asio.hpp>
+
+#include <boost/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
+
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+
+namespace bundy {
+namespace asiolink {
+
+class FDWatcher::Impl : public boost::enable_shared_from_this<Impl> {
+public:
+    Impl(IOService& io_service, int fd, const Callback& callback) :
+        descriptor_(io_service.get_io_service()), callback_(callback),
+        active_(true)
+    {
+        const int new_fd = dup(fd);
+        if (new_fd < 0) {
+            bundy_throw(IOError, "failed to duplicate descriptor " << fd <<
+                        " to watch: " << std::strerror(errno));
+        }
+        asio::error_code ec;
+        descriptor_.assign(new_fd, ec);
+        if (ec) {
+            close(new_fd);
+            bundy_throw(IOError, "failed to watch descriptor " << fd <<
+                        ": " << ec.message());
+        }
+    }
+
+    // Wait for the next readable event.  The handler holds a reference to
+    // this object, so it's valid even if the watcher is gone by then.
+    void schedule() {
+        descriptor_.async_read_some(
+            asio::null_buffers(),
+            boost::bind(&Impl::handleReadable, shared_from_this(), _1));
+    }
+
+    void stop() {
+        active_ = false;
+        asio::error_code ec;
+        descriptor_.close(ec);
+    }
+
+private:
+    void handleReadable(const asio::error_code& ec) {
+        if (!active_ || ec == asio::error::operation_aborted) {
+            return;
+        }
+        // Other errors are unexpected for a readiness wait; keep watching
+        // so a transient one doesn't silently stop the notifications.
+        callback_();
+        if (active_) {
+            schedule();
+        }
+    }
+
+    asio::posix::stream_descriptor descriptor_;
+    const Callback callback_;
+    bool active_;
+};
+
+FDWatcher::FDWatcher(IOService& io_service, int fd,
+                     const Callback& callback) :
+    impl_(new Impl(io_service, fd, callback))
+{
+    impl_->schedule();
+}
+
+FDWatcher::~FDWatcher() {
+    impl_->stop();
+}
+
+} // namespace asiolink
+} // namespace bundy
@@ -0,0 +1,76 @@
+// Copyright (C) 2013  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef ASIOLINK_FD_WATCHER_H
+#define ASIOLINK_FD_WATCHER_H 1
+
+#include <asiolink/io_service.h>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace bundy {
+namespace asiolink {
+
+/// \brief Calls a callback whenever a file descriptor becomes readable.
+///
+/// This lets an event loop react to a descriptor which isn't a socket
+/// handled by other classes of this library, typically the descriptor of
+/// a \c bundy::util::thread::EventNotifier signalled by other threads.
+///
+/// The callback is called from \c IOService::run() (or similar) each time
+/// the descriptor is readable, until the watcher is destroyed.  The
+/// callback is expected to consume what made it readable (e.g., to clear
+/// the notifier), otherwise it's called again immediately.
+///
+/// The watcher works on a duplicate of the descriptor, so the caller keeps
+/// the ownership of the original one; it must not be closed before the
+/// watcher is destroyed, however, as the duplicate refers to the same
+/// file.
+class FDWatcher : boost::noncopyable {
+public:
+    /// \brief The callback functor, called without parameters.
+    typedef boost::function<void()> Callback;
+
+    /// \brief Constructor; starts watching the descriptor.
+    ///
+    /// \param io_service The IO service to run the callback from.
+    /// \param fd The descriptor to watch.
+    /// \param callback The callback to be called when it's readable.
+    ///
+    /// \throw IOError the descriptor couldn't be duplicated or registered
+    ///     to the IO service.
+    FDWatcher(IOService& io_service, int fd, const Callback& callback);
+
+    /// \brief Destructor; stops watching the descriptor.
+    ///
+    /// The callback won't be called once the watcher is destroyed.
+    ///
+    /// \throw None
+    ~FDWatcher();
+
+private:
+    class Impl;
+    boost::shared_ptr<Impl> impl_;
+};
+
+} // namespace asiolink
+} // namespace bundy
+
+#endif // ASIOLINK_FD_WATCHER_H
+
+// Local Variables:
+// mode: c++
+// End:
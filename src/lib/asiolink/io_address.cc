@@ -24,7 +24,6 @@
 #include <exceptions/exceptions.h>
 #include <asiolink/io_address.h>
 #include <asiolink/io_error.h>
-#include <boost/static_assert.hpp>
 
 using namespace asio;
 using asio::ip::udp;
@@ -35,29 +34,67 @@ using namespace std;
 namespace bundy {
 namespace asiolink {
 
+namespace {
+
+// Reads 64 bits in network byte order.
+uint64_t
+readUint64(const uint8_t* data) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        value = (value << 8) | data[i];
+    }
+    return (value);
+}
+
+// Writes 64 bits in network byte order.
+void
+writeUint64(uint64_t value, uint8_t* data) {
+    for (size_t i = 8; i > 0; --i) {
+        data[i - 1] = static_cast<uint8_t>(value);
+        value >>= 8;
+    }
+}
+
+}
+
 // XXX: we cannot simply construct the address in the initialization list,
 // because we'd like to throw our own exception on failure.
 IOAddress::IOAddress(const std::string& address_str) {
     asio::error_code err;
-    asio_address_ = ip::address::from_string(address_str, err);
+    const ip::address asio_address = ip::address::from_string(address_str,
+                                                              err);
     if (err) {
         bundy_throw(IOError, "Failed to convert string to address '"
                   << address_str << "': " << err.message());
     }
+    *this = IOAddress(asio_address);
 }
 
-IOAddress::IOAddress(const asio::ip::address& asio_address) :
-    asio_address_(asio_address)
-{}
-
-IOAddress::IOAddress(uint32_t v4address):
-    asio_address_(asio::ip::address_v4(v4address)) {
-
+IOAddress::IOAddress(const asio::ip::address& asio_address) {
+    if (asio_address.is_v4()) {
+        high_ = 0;
+        low_ = asio_address.to_v4().to_ulong();
+        scope_id_ = 0;
+        family_ = AF_INET;
+    } else {
+        const asio::ip::address_v6 v6 = asio_address.to_v6();
+        const asio::ip::address_v6::bytes_type bytes = v6.to_bytes();
+        high_ = readUint64(&bytes[0]);
+        low_ = readUint64(&bytes[8]);
+        scope_id_ = v6.scope_id();
+        family_ = AF_INET6;
+    }
 }
 
 string
 IOAddress::toText() const {
-    return (asio_address_.to_string());
+    if (isV4()) {
+        return (ip::address_v4(static_cast<uint32_t>(low_)).to_string());
+    }
+    ip::address_v6::bytes_type bytes;
+    writeUint64(high_, &bytes[0]);
+    writeUint64(low_, &bytes[8]);
+    return (ip::address_v6(bytes, scope_id_).to_string());
 }
 
 IOAddress
@@ -70,55 +107,72 @@ IOAddress::fromBytes(short family, const uint8_t* data) {
                   << "are supported");
     }
 
-    BOOST_STATIC_ASSERT(INET6_ADDRSTRLEN >= INET_ADDRSTRLEN);
-    char addr_str[INET6_ADDRSTRLEN];
-    inet_ntop(family, data, addr_str, INET6_ADDRSTRLEN);
-    return IOAddress(string(addr_str));
+    IOAddress address(static_cast<uint32_t>(0));
+    if (family == AF_INET) {
+        address.low_ = (static_cast<uint32_t>(data[0]) << 24) |
+            (static_cast<uint32_t>(data[1]) << 16) |
+            (static_cast<uint32_t>(data[2]) << 8) | data[3];
+    } else {
+        address.high_ = readUint64(data);
+        address.low_ = readUint64(data + 8);
+        address.family_ = AF_INET6;
+    }
+    return (address);
 }
 
-std::vector<uint8_t>
-IOAddress::toBytes() const {
-    if (asio_address_.is_v4()) {
-        const asio::ip::address_v4::bytes_type bytes4 =
-            asio_address_.to_v4().to_bytes();
-        return (std::vector<uint8_t>(bytes4.begin(), bytes4.end()));
+size_t
+IOAddress::toBytes(uint8_t* data) const {
+    if (isV4()) {
+        data[0] = static_cast<uint8_t>(low_ >> 24);
+        data[1] = static_cast<uint8_t>(low_ >> 16);
+        data[2] = static_cast<uint8_t>(low_ >> 8);
+        data[3] = static_cast<uint8_t>(low_);
+        return (V4ADDRESS_LEN);
     }
-
-    // Not V4 address, so must be a V6 address (else we could never construct
-    // this object).
-    const asio::ip::address_v6::bytes_type bytes6 =
-        asio_address_.to_v6().to_bytes();
-    return (std::vector<uint8_t>(bytes6.begin(), bytes6.end()));
+    writeUint64(high_, data);
+    writeUint64(low_, data + 8);
+    return (V6ADDRESS_LEN);
 }
 
-short
-IOAddress::getFamily() const {
-    if (asio_address_.is_v4()) {
-        return (AF_INET);
-    } else {
-        return (AF_INET6);
-    }
+std::vector<uint8_t>
+IOAddress::toBytes() const {
+    uint8_t data[V6ADDRESS_LEN];
+    const size_t len = toBytes(data);
+    return (std::vector<uint8_t>(data, data + len));
 }
 
-bool
-IOAddress::isV6LinkLocal() const {
-    if (!asio_address_.is_v6()) {
-        return (false);
+IOAddress
+IOAddress::increasePrefix(const uint8_t prefix_len) const {
+    if (prefix_len < 1 || prefix_len > maxPrefixLength()) {
+        bundy_throw(BadValue, "Invalid prefix length " <<
+                    static_cast<int>(prefix_len) << " for " << toText());
+    }
+    const unsigned shift = maxPrefixLength() - prefix_len;
+    IOAddress next(*this);
+    if (shift < 64) {
+        const uint64_t low = low_ + (1ULL << shift);
+        if (low < low_) {
+            ++next.high_;
+        }
+        next.low_ = low;
+    } else {
+        next.high_ += 1ULL << (shift - 64);
     }
-    return (asio_address_.to_v6().is_link_local());
+    next.clearHostBits(maxPrefixLength(), false);
+    return (next);
 }
 
-bool
-IOAddress::isV6Multicast() const {
-    if (!asio_address_.is_v6()) {
-        return (false);
+void
+IOAddress::checkPrefixLength(const uint8_t prefix_len) const {
+    if (prefix_len > maxPrefixLength()) {
+        bundy_throw(BadValue, "Too large prefix length " <<
+                    static_cast<int>(prefix_len) << " for " << toText());
     }
-    return (asio_address_.to_v6().is_multicast());
 }
 
 IOAddress::operator uint32_t() const {
-    if (asio_address_.is_v4()) {
-        return (asio_address_.to_v4().to_ulong());
+    if (isV4()) {
+        return (static_cast<uint32_t>(low_));
     } else {
         bundy_throw(BadValue, "Can't convert " << toText()
                   << " address to IPv4.");
@@ -19,6 +19,7 @@
 // this file.  In particular, asio.hpp should never be included here.
 // See the description of the namespace below.
 #include <unistd.h>             // for some network system calls
+#include <sys/socket.h>         // for AF_INET and AF_INET6
 #include <stdint.h>             // for uint32_t
 #include <asio/ip/address.hpp>
 
@@ -40,7 +41,13 @@ namespace asiolink {
 /// \brief The \c IOAddress class represents an IP addresses (version
 /// agnostic)
 ///
-/// This class is a wrapper for the ASIO \c ip::address class.
+/// The address is held as a 128-bit integer, in two 64-bit halves in host
+/// byte order (an IPv4 address is in the low 32 bits), with its family and
+/// IPv6 scope identifier.  This keeps the object small and lets it be
+/// compared, incremented, masked and hashed without converting it to bytes
+/// or text, which matters to the DHCP servers selecting subnets and
+/// allocating addresses for each packet.  The ASIO \c ip::address class is
+/// only used to convert the address from and to text.
 class IOAddress {
 public:
     ///
@@ -80,7 +87,9 @@ public:
     /// network byte order
     ///
     /// @param v4address IPv4 address represnted by uint32_t
-    IOAddress(uint32_t v4address);
+    IOAddress(uint32_t v4address) :
+        high_(0), low_(v4address), scope_id_(0), family_(AF_INET)
+    {}
 
     /// \brief Convert the address to a string.
     ///
@@ -94,31 +103,39 @@ public:
     /// \brief Returns the address family
     ///
     /// \return AF_INET for IPv4 or AF_INET6 for IPv6.
-    short getFamily() const;
+    short getFamily() const {
+        return (family_);
+    }
 
     /// \brief Convenience function to check for an IPv4 address
     ///
     /// \return true if the address is a V4 address
     bool isV4() const {
-        return (asio_address_.is_v4());
+        return (family_ == AF_INET);
     }
 
     /// \brief Convenience function to check for an IPv6 address
     ///
     /// \return true if the address is a V6 address
     bool isV6() const {
-        return (asio_address_.is_v6());
+        return (family_ == AF_INET6);
     }
 
     /// \brief checks whether and address is IPv6 and is link-local
     ///
     /// \return true if the address is IPv6 link-local, false otherwise
-    bool isV6LinkLocal() const;
+    bool isV6LinkLocal() const {
+        // fe80::/10
+        return (isV6() && ((high_ >> 54) == 0x3fa));
+    }
 
     /// \brief checks whether and address is IPv6 and is multicast
     ///
     /// \return true if the address is IPv6 multicast, false otherwise
-    bool isV6Multicast() const;
+    bool isV6Multicast() const {
+        // ff00::/8
+        return (isV6() && ((high_ >> 56) == 0xff));
+    }
 
     /// \brief Creates an address from over wire data.
     ///
@@ -134,13 +151,23 @@ public:
     ///         order.
     std::vector<uint8_t> toBytes() const;
 
+    /// \brief Writes the address as bytes in network byte order.
+    ///
+    /// This is \c toBytes() without allocating a vector.
+    ///
+    /// \param data Buffer of at least \c V4ADDRESS_LEN bytes for an IPv4
+    /// address, \c V6ADDRESS_LEN bytes for an IPv6 address.
+    /// \return The number of bytes written.
+    size_t toBytes(uint8_t* data) const;
+
     /// \brief Compare addresses for equality
     ///
     /// \param other Address to compare against.
     ///
     /// \return true if addresses are equal, false if not.
     bool equals(const IOAddress& other) const {
-        return (asio_address_ == other.asio_address_);
+        return ((low_ == other.low_) && (high_ == other.high_) &&
+                (family_ == other.family_) && (scope_id_ == other.scope_id_));
     }
 
     /// \brief Compare addresses for equality
@@ -172,14 +199,16 @@ public:
     /// Comparisons between v4 and v6 will allways return v4
     /// being smaller. This follows boost::asio::ip implementation
     bool lessThan(const IOAddress& other) const {
-        if (this->getFamily() == other.getFamily()) {
-            if (this->getFamily() == AF_INET6) {
-                return (this->asio_address_.to_v6() < other.asio_address_.to_v6());
-            } else {
-                return (this->asio_address_.to_v4() < other.asio_address_.to_v4());
-            }
+        if (family_ != other.family_) {
+            return (family_ < other.family_);
+        }
+        if (high_ != other.high_) {
+            return (high_ < other.high_);
         }
-        return (this->getFamily() < other.getFamily());
+        if (low_ != other.low_) {
+            return (low_ < other.low_);
+        }
+        return (scope_id_ < other.scope_id_);
     }
 
     /// \brief Checks if one address is smaller or equal than the other
@@ -188,10 +217,7 @@ public:
     ///
     /// \return true if this address is smaller than the other address.
     bool smallerEqual(const IOAddress& other) const {
-        if (equals(other)) {
-            return (true);
-        }
-        return (lessThan(other));
+        return (!other.lessThan(*this));
     }
 
     /// \brief Checks if one address is smaller than the other
@@ -221,6 +247,57 @@ public:
         return (nequals(other));
     }
 
+    /// \brief Returns the next address.
+    ///
+    /// The address following the highest address of the family is the
+    /// lowest one (0.0.0.0 or ::).  The scope identifier is kept.
+    IOAddress increase() const {
+        IOAddress next(*this);
+        if (++next.low_ == 0) {
+            ++next.high_;
+        }
+        next.clearHostBits(maxPrefixLength(), false);
+        return (next);
+    }
+
+    /// \brief Returns the next prefix of a given length.
+    ///
+    /// This adds one to the last bit of the prefix; the bits after it
+    /// are kept.  The prefix following the highest one of the family is
+    /// the lowest one.
+    ///
+    /// \param prefix_len Prefix length, 1..32 for IPv4 or 1..128 for IPv6.
+    /// \throw BadValue if the prefix length is out of range.
+    IOAddress increasePrefix(const uint8_t prefix_len) const;
+
+    /// \brief Returns the first address of the prefix this address is in.
+    ///
+    /// \param prefix_len Prefix length, 0..32 for IPv4 or 0..128 for IPv6.
+    /// \throw BadValue if the prefix length is out of range.
+    IOAddress firstInPrefix(const uint8_t prefix_len) const {
+        checkPrefixLength(prefix_len);
+        IOAddress first(*this);
+        first.clearHostBits(prefix_len, false);
+        return (first);
+    }
+
+    /// \brief Returns the last address of the prefix this address is in.
+    ///
+    /// \param prefix_len Prefix length, 0..32 for IPv4 or 0..128 for IPv6.
+    /// \throw BadValue if the prefix length is out of range.
+    IOAddress lastInPrefix(const uint8_t prefix_len) const {
+        checkPrefixLength(prefix_len);
+        IOAddress last(*this);
+        last.clearHostBits(prefix_len, true);
+        return (last);
+    }
+
+    /// \brief Returns a hash value of the address.
+    size_t hash() const {
+        return (static_cast<size_t>(low_ ^ (low_ >> 32) ^ high_ ^
+                                    (high_ >> 32) ^ scope_id_));
+    }
+
     /// \brief Converts IPv4 address to uint32_t
     ///
     /// Will throw BadValue exception if that is not IPv4
@@ -231,9 +308,62 @@ public:
     operator uint32_t () const;
 
 private:
-    asio::ip::address asio_address_;
+    /// \brief Returns the number of bits of an address of the family.
+    uint8_t maxPrefixLength() const {
+        return (isV4() ? 32 : 128);
+    }
+
+    /// \brief Throws BadValue if a prefix length is too large for the
+    /// family.
+    void checkPrefixLength(const uint8_t prefix_len) const;
+
+    /// \brief Clears (or sets) the bits after a prefix.
+    ///
+    /// The bits above the address length of the family are always
+    /// cleared.
+    ///
+    /// \param prefix_len Prefix length, not larger than the address length.
+    /// \param set Whether to set the bits rather than clear them.
+    void clearHostBits(const uint8_t prefix_len, const bool set) {
+        const unsigned host_bits = maxPrefixLength() - prefix_len;
+        const uint64_t low_mask = host_bits >= 64 ? ~0ULL :
+            (1ULL << host_bits) - 1;
+        const uint64_t high_mask = host_bits <= 64 ? 0 :
+            host_bits >= 128 ? ~0ULL : (1ULL << (host_bits - 64)) - 1;
+        if (set) {
+            low_ |= low_mask;
+            high_ |= high_mask;
+        } else {
+            low_ &= ~low_mask;
+            high_ &= ~high_mask;
+        }
+        if (isV4()) {
+            low_ &= 0xffffffffULL;
+            high_ = 0;
+        }
+    }
+
+    /// The first 64 bits of an IPv6 address, zero for IPv4.
+    uint64_t high_;
+
+    /// The last 64 bits of an IPv6 address, or the IPv4 address.
+    uint64_t low_;
+
+    /// IPv6 scope identifier, zero for none.
+    uint32_t scope_id_;
+
+    /// AF_INET or AF_INET6.
+    short family_;
 };
 
+/// \brief Returns a hash value of an address.
+///
+/// This makes \c boost::hash work with \c IOAddress.
+inline size_t
+hash_value(const IOAddress& address) {
+    return (address.hash());
+}
+
 /// \brief Insert the IOAddress as a string into stream.
 ///
 /// This method converts the \c address into a string and inserts it
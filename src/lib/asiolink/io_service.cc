@@ -20,6 +20,9 @@
 
 #include <asio.hpp>
 #include <asiolink/io_service.h>
+#include <asiolink/timer_wheel.h>
+
+#include <boost/scoped_ptr.hpp>
 
 namespace bundy {
 namespace asiolink {
@@ -84,9 +87,16 @@ public:
         const CallbackWrapper wrapper(callback);
         io_service_.post(wrapper);
     }
+    TimerWheel& getTimerWheel() {
+        if (!timer_wheel_) {
+            timer_wheel_.reset(new TimerWheel(io_service_));
+        }
+        return (*timer_wheel_);
+    }
 private:
     asio::io_service io_service_;
     asio::io_service::work work_;
+    boost::scoped_ptr<TimerWheel> timer_wheel_;
 };
 
 IOService::IOService() {
@@ -122,5 +132,10 @@ IOService::post(const boost::function<void ()>& callback) {
     return (io_impl_->post(callback));
 }
 
+TimerWheel&
+IOService::getTimerWheel() {
+    return (io_impl_->getTimerWheel());
+}
+
 } // namespace asiolink
 } // namespace bundy
@@ -25,6 +25,7 @@ namespace bundy {
 namespace asiolink {
 
 class IOServiceImpl;
+class TimerWheel;
 
 /// \brief The \c IOService class is a wrapper for the ASIO \c io_service
 /// class.
@@ -83,6 +84,12 @@ public:
     /// by small bits that are called from time to time).
     void post(const boost::function<void ()>& callback);
 
+    /// \brief Return the timer wheel shared by the users of this service.
+    ///
+    /// The wheel is created on the first call.  Components using a large
+    /// number of timers (see \c TimerWheel) use this one by default.
+    TimerWheel& getTimerWheel();
+
 private:
     IOServiceImpl* io_impl_;
 };
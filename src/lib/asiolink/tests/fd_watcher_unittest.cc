@@ -0,0 +1,101 @@
+// Copyright (C) 2013  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <asiolink/fd_watcher.h>
+#include <asiolink/interval_timer.h>
+#include <asiolink/io_error.h>
+#include <asiolink/io_service.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace bundy::asiolink;
+
+namespace {
+
+class FDWatcherTest : public ::testing::Test {
+public:
+    FDWatcherTest() : timer_(io_service_), count_(0) {
+        EXPECT_EQ(0, pipe(fds_));
+        EXPECT_NE(-1, fcntl(fds_[0], F_SETFL, O_NONBLOCK));
+        // Don't let a bug hang up the test.
+        timer_.setup(boost::bind(&IOService::stop, &io_service_), 5000);
+    }
+
+    ~FDWatcherTest() {
+        close(fds_[0]);
+        close(fds_[1]);
+    }
+
+    // Consume the readable data.
+    void readableCallback() {
+        char buf[16];
+        while (read(fds_[0], buf, sizeof(buf)) > 0) {
+        }
+        ++count_;
+    }
+
+    void notify() {
+        const char data = 1;
+        EXPECT_EQ(1, write(fds_[1], &data, 1));
+    }
+
+    IOService io_service_;
+    IntervalTimer timer_;
+    int fds_[2];
+    size_t count_;
+};
+
+TEST_F(FDWatcherTest, watch) {
+    FDWatcher watcher(io_service_, fds_[0],
+                      boost::bind(&FDWatcherTest::readableCallback, this));
+    notify();
+    io_service_.run_one();
+    EXPECT_EQ(1, count_);
+
+    // The callback is called again on the next event.
+    notify();
+    notify();
+    io_service_.run_one();
+    EXPECT_EQ(2, count_);
+}
+
+TEST_F(FDWatcherTest, destroy) {
+    boost::scoped_ptr<FDWatcher> watcher(
+        new FDWatcher(io_service_, fds_[0],
+                      boost::bind(&FDWatcherTest::readableCallback, this)));
+    notify();
+    watcher.reset();
+    // Only the timer stops the loop now, and the callback isn't called.
+    timer_.setup(boost::bind(&IOService::stop, &io_service_), 100);
+    io_service_.run();
+    EXPECT_EQ(0, count_);
+
+    // The original descriptor is intact.
+    EXPECT_NE(-1, fcntl(fds_[0], F_GETFD));
+}
+
+TEST_F(FDWatcherTest, badDescriptor) {
+    EXPECT_THROW(FDWatcher(io_service_, -1,
+                           boost::bind(&FDWatcherTest::readableCallback,
+                                       this)),
+                 IOError);
+}
+
+}
@@ -217,3 +217,105 @@ TEST(IOAddressTest, accessClassificationMethods) {
     EXPECT_FALSE(addr5.isV6LinkLocal());
     EXPECT_TRUE (addr5.isV6Multicast());
 }
+
+// Tests that the scope identifier of an IPv6 address is kept.
+TEST(IOAddressTest, scopeId) {
+    const IOAddress addr2("fe80::1");
+    const asio::ip::address_v6::bytes_type bytes =
+        asio::ip::address_v6::from_string("fe80::1").to_bytes();
+    const IOAddress addr1(asio::ip::address(asio::ip::address_v6(bytes, 1)));
+    EXPECT_EQ(AF_INET6, addr1.getFamily());
+    EXPECT_TRUE(addr1.isV6LinkLocal());
+    EXPECT_FALSE(addr1 == addr2);
+    EXPECT_TRUE(addr2 < addr1);
+    EXPECT_EQ(addr2.toBytes(), addr1.toBytes());
+    EXPECT_EQ(addr2, IOAddress::fromBytes(AF_INET6, &addr1.toBytes()[0]));
+}
+
+// Tests getting the bytes of an address without a vector.
+TEST(IOAddressTest, toBytesBuffer) {
+    uint8_t data[V6ADDRESS_LEN];
+
+    EXPECT_EQ(V4ADDRESS_LEN, IOAddress("192.0.2.3").toBytes(data));
+    const uint8_t v4[] = { 192, 0, 2, 3 };
+    EXPECT_EQ(0, std::memcmp(v4, data, V4ADDRESS_LEN));
+
+    EXPECT_EQ(V6ADDRESS_LEN,
+              IOAddress("2001:db8:1::dead:beef").toBytes(data));
+    const uint8_t v6[] = {
+        0x20, 0x01, 0x0d, 0xb8, 0x00, 0x01, 0, 0,
+        0, 0, 0, 0, 0xde, 0xad, 0xbe, 0xef };
+    EXPECT_EQ(0, std::memcmp(v6, data, V6ADDRESS_LEN));
+}
+
+// Tests getting the next address.
+TEST(IOAddressTest, increase) {
+    EXPECT_EQ("192.0.2.4", IOAddress("192.0.2.3").increase().toText());
+    EXPECT_EQ("192.0.3.0", IOAddress("192.0.2.255").increase().toText());
+    EXPECT_EQ("0.0.0.0", IOAddress("255.255.255.255").increase().toText());
+
+    EXPECT_EQ("2001:db8::2", IOAddress("2001:db8::1").increase().toText());
+    EXPECT_EQ("2001:db8:0:1::",
+              IOAddress("2001:db8::ffff:ffff:ffff:ffff").increase().toText());
+    EXPECT_EQ("::", IOAddress("ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff")
+              .increase().toText());
+}
+
+// Tests getting the next prefix.
+TEST(IOAddressTest, increasePrefix) {
+    EXPECT_EQ("2001:db8:0:1::",
+              IOAddress("2001:db8::").increasePrefix(64).toText());
+    EXPECT_EQ("2001:db9::",
+              IOAddress("2001:db8:ffff::").increasePrefix(48).toText());
+    EXPECT_EQ("2001:db8::1:8",
+              IOAddress("2001:db8::1:0").increasePrefix(125).toText());
+    EXPECT_EQ("2001:db8::1",
+              IOAddress("2001:db8::").increasePrefix(128).toText());
+    EXPECT_EQ("::", IOAddress("8000::").increasePrefix(1).toText());
+    EXPECT_EQ("192.0.3.0",
+              IOAddress("192.0.2.0").increasePrefix(24).toText());
+
+    EXPECT_THROW(IOAddress("2001:db8::").increasePrefix(0), bundy::BadValue);
+    EXPECT_THROW(IOAddress("2001:db8::").increasePrefix(129),
+                 bundy::BadValue);
+    EXPECT_THROW(IOAddress("192.0.2.0").increasePrefix(33), bundy::BadValue);
+}
+
+// Tests the first and last addresses of prefixes.
+TEST(IOAddressTest, prefixBounds) {
+    const IOAddress v4("192.0.2.77");
+    EXPECT_EQ("192.0.2.0", v4.firstInPrefix(24).toText());
+    EXPECT_EQ("192.0.2.255", v4.lastInPrefix(24).toText());
+    EXPECT_EQ("192.0.2.64", v4.firstInPrefix(26).toText());
+    EXPECT_EQ("192.0.2.127", v4.lastInPrefix(26).toText());
+    EXPECT_EQ("0.0.0.0", v4.firstInPrefix(0).toText());
+    EXPECT_EQ("255.255.255.255", v4.lastInPrefix(0).toText());
+    EXPECT_EQ(v4, v4.firstInPrefix(32));
+    EXPECT_EQ(v4, v4.lastInPrefix(32));
+    EXPECT_THROW(v4.firstInPrefix(33), bundy::BadValue);
+
+    const IOAddress v6("2001:db8:1:2:3:4:5:6");
+    EXPECT_EQ("2001:db8:1::", v6.firstInPrefix(48).toText());
+    EXPECT_EQ("2001:db8:1:ffff:ffff:ffff:ffff:ffff",
+              v6.lastInPrefix(48).toText());
+    EXPECT_EQ("2001:db8:1:2::", v6.firstInPrefix(64).toText());
+    EXPECT_EQ("2001:db8:1:2:ffff:ffff:ffff:ffff",
+              v6.lastInPrefix(64).toText());
+    EXPECT_EQ("2001:db8:1:2:3:4:5:0", v6.firstInPrefix(115).toText());
+    EXPECT_EQ("2001:db8:1:2:3:4:5:1fff", v6.lastInPrefix(115).toText());
+    EXPECT_EQ("::", v6.firstInPrefix(0).toText());
+    EXPECT_EQ(v6, v6.lastInPrefix(128));
+    EXPECT_THROW(v6.lastInPrefix(129), bundy::BadValue);
+}
+
+// Tests that equal addresses have equal hashes.
+TEST(IOAddressTest, hash) {
+    EXPECT_EQ(IOAddress("192.0.2.1").hash(), IOAddress("192.0.2.1").hash());
+    EXPECT_EQ(IOAddress("2001:db8::1").hash(),
+              IOAddress("2001:db8:0::1").hash());
+    EXPECT_NE(IOAddress("192.0.2.1").hash(), IOAddress("192.0.2.2").hash());
+    EXPECT_NE(IOAddress("2001:db8::1").hash(),
+              IOAddress("2001:db8::2").hash());
+    EXPECT_EQ(IOAddress("192.0.2.1").hash(),
+              hash_value(IOAddress("192.0.2.1")));
+}
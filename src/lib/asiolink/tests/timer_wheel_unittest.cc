@@ -0,0 +1,200 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <asiolink/timer_wheel.h>
+#include <asiolink/io_service.h>
+
+#include <exceptions/exceptions.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
+
+using namespace bundy::asiolink;
+using boost::posix_time::ptime;
+using boost::posix_time::microsec_clock;
+
+namespace {
+
+class TimerWheelTest : public ::testing::Test {
+protected:
+    TimerWheelTest() : wheel_(io_service_, 1) {}
+
+public:
+    // Callbacks of the timers (need to be public for boost::bind).
+
+    void count(int* counter) {
+        ++*counter;
+    }
+    void record(int id) {
+        fired_.push_back(id);
+    }
+    void stop() {
+        io_service_.stop();
+    }
+    void cancelOther(WheelTimer* timer, WheelTimer* other) {
+        record(1);
+        other->cancel();
+        delete timer;
+    }
+
+protected:
+    IOService io_service_;
+    TimerWheel wheel_;          // 1ms ticks
+    std::vector<int> fired_;
+};
+
+TEST_F(TimerWheelTest, invalidArguments) {
+    EXPECT_THROW(TimerWheel(io_service_, 0), bundy::BadValue);
+    EXPECT_EQ(TimerWheel::DEFAULT_TICK, TimerWheel(io_service_).getTick());
+    EXPECT_EQ(1, wheel_.getTick());
+
+    WheelTimer timer(wheel_);
+    EXPECT_THROW(timer.setup(WheelTimer::Callback(), 1),
+                 bundy::InvalidParameter);
+    EXPECT_THROW(timer.setup(boost::bind(&TimerWheelTest::stop, this), 0),
+                 bundy::BadValue);
+    EXPECT_THROW(timer.setup(boost::bind(&TimerWheelTest::stop, this), -1),
+                 bundy::BadValue);
+    EXPECT_EQ(0, timer.getInterval());
+    EXPECT_EQ(0, wheel_.getTimerCount());
+}
+
+TEST_F(TimerWheelTest, oneShot) {
+    WheelTimer timer(wheel_);
+    const ptime start = microsec_clock::universal_time();
+    timer.setup(boost::bind(&TimerWheelTest::stop, this), 100,
+                WheelTimer::ONE_SHOT);
+    EXPECT_EQ(100, timer.getInterval());
+    EXPECT_EQ(1, wheel_.getTimerCount());
+    io_service_.run();
+
+    // It never expires early.
+    EXPECT_LE(100, (microsec_clock::universal_time() - start).
+              total_milliseconds());
+    EXPECT_EQ(0, timer.getInterval());
+    EXPECT_EQ(0, wheel_.getTimerCount());
+}
+
+TEST_F(TimerWheelTest, repeating) {
+    WheelTimer timer(wheel_);
+    WheelTimer watcher(wheel_);
+    int counter = 0;
+    timer.setup(boost::bind(&TimerWheelTest::count, this, &counter), 20);
+    watcher.setup(boost::bind(&TimerWheelTest::stop, this), 110,
+                  WheelTimer::ONE_SHOT);
+    io_service_.run();
+    EXPECT_LE(3, counter);
+    EXPECT_GE(5, counter);
+    EXPECT_EQ(20, timer.getInterval());
+    EXPECT_EQ(1, wheel_.getTimerCount());
+
+    timer.cancel();
+    EXPECT_EQ(0, timer.getInterval());
+    EXPECT_EQ(0, wheel_.getTimerCount());
+    // Canceling it again is harmless.
+    timer.cancel();
+}
+
+// Timers expire in the order of their intervals, including those on the
+// higher levels of the wheel.
+TEST_F(TimerWheelTest, order) {
+    WheelTimer timer1(wheel_), timer2(wheel_), timer3(wheel_);
+    WheelTimer watcher(wheel_);
+    timer3.setup(boost::bind(&TimerWheelTest::record, this, 3), 300,
+                 WheelTimer::ONE_SHOT);
+    timer1.setup(boost::bind(&TimerWheelTest::record, this, 1), 5,
+                 WheelTimer::ONE_SHOT);
+    timer2.setup(boost::bind(&TimerWheelTest::record, this, 2), 70,
+                 WheelTimer::ONE_SHOT);
+    watcher.setup(boost::bind(&TimerWheelTest::stop, this), 320,
+                  WheelTimer::ONE_SHOT);
+    io_service_.run();
+    ASSERT_EQ(3, fired_.size());
+    EXPECT_EQ(1, fired_[0]);
+    EXPECT_EQ(2, fired_[1]);
+    EXPECT_EQ(3, fired_[2]);
+}
+
+// Timers can be canceled and destroyed in a callback, even when they
+// expire on the same tick.
+TEST_F(TimerWheelTest, cancelInCallback) {
+    WheelTimer* canceller = new WheelTimer(wheel_);
+    WheelTimer canceled(wheel_);
+    WheelTimer watcher(wheel_);
+    canceller->setup(boost::bind(&TimerWheelTest::cancelOther, this,
+                                 canceller, &canceled), 30);
+    canceled.setup(boost::bind(&TimerWheelTest::record, this, 2), 30);
+    watcher.setup(boost::bind(&TimerWheelTest::stop, this), 100,
+                  WheelTimer::ONE_SHOT);
+    io_service_.run();
+    ASSERT_EQ(1, fired_.size());
+    EXPECT_EQ(1, fired_[0]);
+    EXPECT_EQ(0, wheel_.getTimerCount());
+}
+
+// A larger number of timers, half of which are canceled.
+TEST_F(TimerWheelTest, manyTimers) {
+    static const int TIMER_COUNT = 10000;
+    std::vector<boost::shared_ptr<WheelTimer> > timers;
+    int counter = 0;
+    for (int i = 0; i < TIMER_COUNT; ++i) {
+        timers.push_back(boost::shared_ptr<WheelTimer>(
+                             new WheelTimer(wheel_)));
+        timers.back()->setup(boost::bind(&TimerWheelTest::count, this,
+                                         &counter),
+                             1 + (i * 7) % 150, WheelTimer::ONE_SHOT);
+    }
+    for (int i = 0; i < TIMER_COUNT; i += 2) {
+        timers[i]->cancel();
+    }
+    EXPECT_EQ(TIMER_COUNT / 2, wheel_.getTimerCount());
+    WheelTimer watcher(wheel_);
+    watcher.setup(boost::bind(&TimerWheelTest::stop, this), 200,
+                  WheelTimer::ONE_SHOT);
+    io_service_.run();
+    EXPECT_EQ(TIMER_COUNT / 2, counter);
+    EXPECT_EQ(0, wheel_.getTimerCount());
+}
+
+// The timers keep working after the wheel object is gone.
+TEST_F(TimerWheelTest, destroyWheel) {
+    TimerWheel* wheel = new TimerWheel(io_service_, 1);
+    WheelTimer timer(*wheel);
+    delete wheel;
+    timer.setup(boost::bind(&TimerWheelTest::stop, this), 10,
+                WheelTimer::ONE_SHOT);
+    io_service_.run();
+    EXPECT_EQ(0, timer.getInterval());
+}
+
+TEST_F(TimerWheelTest, serviceWheel) {
+    TimerWheel& wheel = io_service_.getTimerWheel();
+    EXPECT_EQ(&wheel, &io_service_.getTimerWheel());
+    EXPECT_EQ(TimerWheel::DEFAULT_TICK, wheel.getTick());
+
+    WheelTimer timer(wheel);
+    timer.setup(boost::bind(&TimerWheelTest::stop, this), 10,
+                WheelTimer::ONE_SHOT);
+    io_service_.run();
+    EXPECT_EQ(0, wheel.getTimerCount());
+}
+
+}
@@ -0,0 +1,384 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <asiolink/timer_wheel.h>
+
+#include <exceptions/exceptions.h>
+
+#include <asio.hpp>
+
+#include <boost/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace asiolink {
+
+namespace {
+// The wheel has LEVELS levels of SLOTS slots each.  A slot of level 0
+// holds the timers expiring in a particular tick, a slot of level 1 those
+// in a particular range of SLOTS ticks, and so on.  As the time advances
+// the timers of the higher level slots are moved ("cascaded") to the lower
+// levels.  With 10ms ticks this covers about 46 hours; later timers are
+// kept in the last slot and cascaded again.
+const unsigned int SLOT_BITS = 6;
+const unsigned int SLOTS = 1 << SLOT_BITS;
+const uint64_t SLOT_MASK = SLOTS - 1;
+const unsigned int LEVELS = 4;
+const uint64_t MAX_DELTA = (static_cast<uint64_t>(1) << (SLOT_BITS * LEVELS));
+
+// A node of the doubly linked lists of timers in the slots.  An empty list
+// is a sentinel node pointing to itself.
+struct ListNode : boost::noncopyable {
+    ListNode() : prev(this), next(this) {}
+    bool empty() const { return (next == this); }
+    // Move all nodes of this list to the (empty) list of the given sentinel.
+    void moveTo(ListNode& other) {
+        assert(other.empty());
+        if (!empty()) {
+            other.next = next;
+            other.prev = prev;
+            other.next->prev = &other;
+            other.prev->next = &other;
+            prev = next = this;
+        }
+    }
+    ListNode* prev;
+    ListNode* next;
+};
+}
+
+class WheelTimerImpl : public ListNode {
+public:
+    WheelTimerImpl(const boost::shared_ptr<TimerWheelImpl>& wheel) :
+        wheel_(wheel), linked_(false), level_(0), slot_(0), expiry_(0),
+        interval_(0), mode_(WheelTimer::REPEATING)
+    {}
+    // Link to the end of the given list.
+    void link(ListNode& head, unsigned int level, unsigned int slot) {
+        prev = head.prev;
+        next = &head;
+        head.prev->next = this;
+        head.prev = this;
+        linked_ = true;
+        level_ = level;
+        slot_ = slot;
+    }
+    void unlink() {
+        prev->next = next;
+        next->prev = prev;
+        prev = next = this;
+        linked_ = false;
+    }
+
+    const boost::shared_ptr<TimerWheelImpl> wheel_;
+    bool linked_;
+    unsigned int level_;        // position in the wheel, if linked
+    unsigned int slot_;
+    uint64_t expiry_;           // in ticks
+    WheelTimer::Callback cbfunc_;
+    long interval_;
+    WheelTimer::Mode mode_;
+};
+
+class TimerWheelImpl :
+    public boost::enable_shared_from_this<TimerWheelImpl>,
+    boost::noncopyable
+{
+public:
+    TimerWheelImpl(asio::io_service& io_service, long tick);
+    void add(WheelTimerImpl& timer);
+    void remove(WheelTimerImpl& timer);
+    long getTick() const { return (tick_); }
+    size_t getTimerCount() const { return (count_); }
+private:
+    // The number of complete ticks since the wheel was created.
+    uint64_t getCurrentTick() const {
+        const boost::posix_time::time_duration elapsed =
+            asio::deadline_timer::traits_type::now() - start_;
+        return (elapsed.total_milliseconds() / tick_);
+    }
+    // Put the timer in the slot for its expiry.
+    void insert(WheelTimerImpl& timer);
+    // Move timers from the slots of the current tick to the lower levels
+    // and call the expired ones.
+    void advance();
+    // Return the next tick at which there may be something to do.
+    uint64_t getNextTick() const;
+    // Make the ASIO timer expire at the given tick (if it isn't set to
+    // expire earlier already).
+    void schedule(uint64_t tick);
+    void expired(const asio::error_code& ec);
+
+    asio::deadline_timer timer_;
+    const long tick_;
+    const boost::posix_time::ptime start_;
+    uint64_t current_;          // the last processed tick
+    size_t count_;              // number of armed timers
+    bool waiting_;              // whether timer_ is armed
+    uint64_t wakeup_;           // when it expires (in ticks), if armed
+    ListNode slots_[LEVELS][SLOTS];
+    uint64_t occupied_[LEVELS]; // bitmaps of non empty slots
+};
+
+TimerWheelImpl::TimerWheelImpl(asio::io_service& io_service, long tick) :
+    timer_(io_service), tick_(tick),
+    start_(asio::deadline_timer::traits_type::now()),
+    current_(0), count_(0), waiting_(false), wakeup_(0)
+{
+    if (tick <= 0) {
+        bundy_throw(BadValue, "Timer wheel tick should be positive: " <<
+                    tick);
+    }
+    std::fill(occupied_, occupied_ + LEVELS, 0);
+}
+
+void
+TimerWheelImpl::add(WheelTimerImpl& timer) {
+    // The wheel may be far behind the actual time if it has been idle;
+    // it doesn't matter while it's empty.
+    const uint64_t now = getCurrentTick();
+    if (count_ == 0) {
+        current_ = std::max(current_, now);
+    }
+    // Round the interval up, so we never expire early.
+    const uint64_t ticks = (timer.interval_ + tick_ - 1) / tick_;
+    timer.expiry_ = std::max(now + ticks, current_ + 1);
+    insert(timer);
+    ++count_;
+
+    // Timers of the higher levels need to be looked at on the next cascade.
+    schedule(timer.level_ == 0 ? timer.expiry_ : (current_ | SLOT_MASK) + 1);
+}
+
+void
+TimerWheelImpl::remove(WheelTimerImpl& timer) {
+    assert(timer.linked_);
+    timer.unlink();
+    if (slots_[timer.level_][timer.slot_].empty()) {
+        occupied_[timer.level_] &= ~(static_cast<uint64_t>(1) << timer.slot_);
+    }
+    --count_;
+}
+
+void
+TimerWheelImpl::insert(WheelTimerImpl& timer) {
+    const uint64_t delta = timer.expiry_ - current_;
+    const uint64_t expiry = (delta < MAX_DELTA) ? timer.expiry_ :
+        current_ + MAX_DELTA - 1;
+    unsigned int level = 0;
+    while (level + 1 < LEVELS &&
+           (expiry - current_) >= (static_cast<uint64_t>(1) <<
+                                   (SLOT_BITS * (level + 1)))) {
+        ++level;
+    }
+    const unsigned int slot = (expiry >> (SLOT_BITS * level)) & SLOT_MASK;
+    timer.link(slots_[level][slot], level, slot);
+    occupied_[level] |= (static_cast<uint64_t>(1) << slot);
+}
+
+void
+TimerWheelImpl::advance() {
+    ++current_;
+
+    // Cascade, from the highest level as its timers may go to the lower
+    // level slots being cascaded next.
+    for (unsigned int level = LEVELS - 1; level > 0; --level) {
+        if ((current_ & ((static_cast<uint64_t>(1) << (SLOT_BITS * level)) -
+                         1)) != 0) {
+            continue;
+        }
+        const unsigned int slot = (current_ >> (SLOT_BITS * level)) &
+            SLOT_MASK;
+        ListNode cascaded;
+        slots_[level][slot].moveTo(cascaded);
+        occupied_[level] &= ~(static_cast<uint64_t>(1) << slot);
+        while (!cascaded.empty()) {
+            WheelTimerImpl& timer = static_cast<WheelTimerImpl&>(
+                *cascaded.next);
+            timer.unlink();
+            insert(timer);
+        }
+    }
+
+    // Call the expired ones.  We first take them out of the wheel, as the
+    // callbacks may modify it.
+    const unsigned int slot = current_ & SLOT_MASK;
+    ListNode expired;
+    slots_[0][slot].moveTo(expired);
+    occupied_[0] &= ~(static_cast<uint64_t>(1) << slot);
+    while (!expired.empty()) {
+        WheelTimerImpl& timer = static_cast<WheelTimerImpl&>(*expired.next);
+        timer.unlink();
+        if (timer.expiry_ > current_) {
+            // Far timers come back to the last slot until reaching it.
+            insert(timer);
+            continue;
+        }
+        // The callback may cancel or destroy the timer, so we make a copy.
+        const WheelTimer::Callback cbfunc = timer.cbfunc_;
+        if (timer.mode_ == WheelTimer::REPEATING) {
+            timer.expiry_ = current_ + std::max<uint64_t>(
+                (timer.interval_ + tick_ - 1) / tick_, 1);
+            insert(timer);
+        } else {
+            --count_;
+            timer.interval_ = 0;
+            timer.cbfunc_ = WheelTimer::Callback();
+        }
+        try {
+            cbfunc();
+        } catch (...) {
+            // Don't leave the remaining ones linked to our local list;
+            // they'll be called on the next tick.
+            while (!expired.empty()) {
+                WheelTimerImpl& rest =
+                    static_cast<WheelTimerImpl&>(*expired.next);
+                rest.unlink();
+                rest.expiry_ = current_ + 1;
+                insert(rest);
+            }
+            throw;
+        }
+    }
+}
+
+uint64_t
+TimerWheelImpl::getNextTick() const {
+    // The nearest non empty slot of the level 0, and the next cascade if
+    // any of the higher levels is non empty.
+    uint64_t next = (current_ | SLOT_MASK) + 1;
+    if (occupied_[0] != 0) {
+        for (uint64_t tick = current_ + 1; tick < next; ++tick) {
+            if ((occupied_[0] & (static_cast<uint64_t>(1) <<
+                                 (tick & SLOT_MASK))) != 0) {
+                return (tick);
+            }
+        }
+    }
+    return (next);
+}
+
+void
+TimerWheelImpl::schedule(uint64_t tick) {
+    if (waiting_ && wakeup_ <= tick) {
+        return;
+    }
+    // This cancels the previous wait, if any.
+    timer_.expires_at(start_ + boost::posix_time::milliseconds(tick * tick_));
+    timer_.async_wait(boost::bind(&TimerWheelImpl::expired,
+                                  shared_from_this(),
+                                  asio::placeholders::error));
+    waiting_ = true;
+    wakeup_ = tick;
+}
+
+void
+TimerWheelImpl::expired(const asio::error_code& ec) {
+    if (ec == asio::error::operation_aborted) {
+        // Replaced with an earlier wait; that one is still valid.
+        return;
+    }
+    waiting_ = false;
+    const uint64_t now = getCurrentTick();
+    try {
+        while (current_ < now && count_ > 0) {
+            advance();
+        }
+    } catch (...) {
+        // Sort things out before propagating the exception from the
+        // callback (like IntervalTimer does).
+        if (count_ > 0) {
+            schedule(std::max(getNextTick(), current_ + 1));
+        }
+        throw;
+    }
+    if (count_ > 0) {
+        schedule(getNextTick());
+    }
+}
+
+const long TimerWheel::DEFAULT_TICK;
+
+TimerWheel::TimerWheel(IOService& io_service, long tick) :
+    impl_(new TimerWheelImpl(io_service.get_io_service(), tick))
+{}
+
+TimerWheel::TimerWheel(asio::io_service& io_service, long tick) :
+    impl_(new TimerWheelImpl(io_service, tick))
+{}
+
+TimerWheel::~TimerWheel() {
+}
+
+long
+TimerWheel::getTick() const {
+    return (impl_->getTick());
+}
+
+size_t
+TimerWheel::getTimerCount() const {
+    return (impl_->getTimerCount());
+}
+
+WheelTimer::WheelTimer(TimerWheel& wheel) :
+    impl_(new WheelTimerImpl(wheel.impl_))
+{}
+
+WheelTimer::~WheelTimer() {
+    cancel();
+}
+
+void
+WheelTimer::setup(const Callback& cbfunc, long interval, Mode mode) {
+    // Interval should not be less than or equal to 0.
+    if (interval <= 0) {
+        bundy_throw(bundy::BadValue, "Interval should not be less than or "
+                    "equal to 0");
+    }
+    // Call back function should not be empty.
+    if (cbfunc.empty()) {
+        bundy_throw(bundy::InvalidParameter, "Callback function is empty");
+    }
+    if (impl_->linked_) {
+        impl_->wheel_->remove(*impl_);
+    }
+    impl_->cbfunc_ = cbfunc;
+    impl_->interval_ = interval;
+    impl_->mode_ = mode;
+    impl_->wheel_->add(*impl_);
+}
+
+void
+WheelTimer::cancel() {
+    if (impl_->linked_) {
+        impl_->wheel_->remove(*impl_);
+    }
+    impl_->interval_ = 0;
+    impl_->cbfunc_ = Callback();
+}
+
+long
+WheelTimer::getInterval() const {
+    return (impl_->interval_);
+}
+
+} // namespace asiolink
+} // namespace bundy
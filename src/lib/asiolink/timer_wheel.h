@@ -0,0 +1,179 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef ASIOLINK_TIMER_WHEEL_H
+#define ASIOLINK_TIMER_WHEEL_H 1
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <asiolink/io_service.h>
+
+#include <cstddef>
+
+namespace asio {
+    class io_service;
+}
+
+namespace bundy {
+namespace asiolink {
+
+class TimerWheelImpl;
+class WheelTimerImpl;
+
+/// \brief A hierarchical timer wheel driving many timers with one
+/// \c asio::deadline_timer.
+///
+/// Each \c IntervalTimer has its own \c asio::deadline_timer, and ASIO keeps
+/// all of them in a heap, so arming and canceling a timer costs O(log n).
+/// Components running tens of thousands of timers at the same time (such
+/// as outstanding upstream fetches or idle TCP connections) spend a
+/// noticeable amount of time there.  The timer wheel keeps its timers
+/// (\c WheelTimer objects) in slots of a fixed time granularity (the "tick")
+/// instead, so arming and canceling them is O(1).  Only the wheel itself
+/// uses an ASIO timer, and it's active only while some of its timers are
+/// armed.
+///
+/// The price is precision: a timer expires up to one tick later than
+/// requested.  The default tick, 10 milliseconds, is fine for network
+/// timeouts; components needing a finer resolution should keep using
+/// \c IntervalTimer.
+///
+/// The wheel and its timers must be used in the thread running the
+/// IO service; the class is not thread safe.
+///
+/// Sample code:
+/// \code
+///  IOService io_service;
+///  WheelTimer timer(io_service.getTimerWheel());
+///  timer.setup(function_to_call_back, 5000, WheelTimer::ONE_SHOT);
+///  io_service.run();
+/// \endcode
+class TimerWheel : boost::noncopyable {
+public:
+    /// \brief The default tick in milliseconds.
+    static const long DEFAULT_TICK = 10;
+
+    /// \brief The constructor with \c IOService.
+    ///
+    /// \throw bundy::BadValue tick is less than or equal to 0
+    ///
+    /// \param io_service A reference to an instance of IOService
+    /// \param tick The granularity of the wheel in milliseconds
+    explicit TimerWheel(IOService& io_service, long tick = DEFAULT_TICK);
+
+    /// \brief The constructor with the native ASIO \c io_service.
+    ///
+    /// This is for the components that only have the ASIO object (such as
+    /// the DNS servers).  Otherwise the same as the other constructor.
+    explicit TimerWheel(asio::io_service& io_service,
+                        long tick = DEFAULT_TICK);
+
+    /// \brief The destructor.
+    ///
+    /// The timers of the wheel can still be used (and will work) after the
+    /// wheel object itself has been destroyed, as long as the IO service is
+    /// alive.
+    ~TimerWheel();
+
+    /// \brief Return the granularity of the wheel in milliseconds.
+    long getTick() const;
+
+    /// \brief Return the number of armed timers of the wheel.
+    size_t getTimerCount() const;
+
+private:
+    friend class WheelTimer;
+    boost::shared_ptr<TimerWheelImpl> impl_;
+};
+
+/// \brief A timer driven by a \c TimerWheel.
+///
+/// This has the same interface as \c IntervalTimer (so it can simply
+/// replace it where the precision of the wheel is enough), with an
+/// additional one-shot mode for timeouts.
+///
+/// The call back function will not be called once the timer has been
+/// canceled or destroyed.  It's safe to cancel, set up again or destroy
+/// the timer (or other timers of the same wheel) within the call back.
+class WheelTimer : boost::noncopyable {
+public:
+    /// \name The type of timer callback function
+    typedef boost::function<void()> Callback;
+
+    /// \brief Whether the timer is re-armed when it expires.
+    enum Mode {
+        REPEATING,              ///< Expire every interval until canceled
+        ONE_SHOT                ///< Expire once and stop
+    };
+
+    /// \brief The constructor.
+    ///
+    /// This constructor may throw a standard exception if
+    /// memory allocation fails inside the method.
+    ///
+    /// \param wheel The wheel driving this timer
+    explicit WheelTimer(TimerWheel& wheel);
+
+    /// \brief The destructor.
+    ///
+    /// The timer is canceled.  This destructor never throws an exception.
+    ~WheelTimer();
+
+    /// \brief Register timer callback function and interval.
+    ///
+    /// This function sets callback function and interval in milliseconds,
+    /// and arms the timer (canceling it first if it was armed already).
+    /// The interval is rounded up to the tick of the wheel.
+    ///
+    /// In the \c ONE_SHOT mode the call back function is released once it
+    /// has been called, so it may safely refer back to the owner of the
+    /// timer.
+    ///
+    /// \throw bundy::InvalidParameter cbfunc is empty
+    /// \throw bundy::BadValue interval is less than or equal to 0
+    ///
+    /// \param cbfunc A reference to a function \c void(void) to call back
+    /// when the timer is expired (should not be an empty functor)
+    /// \param interval Interval in milliseconds (greater than 0)
+    /// \param mode Whether the timer repeats or not
+    void setup(const Callback& cbfunc, long interval,
+               Mode mode = REPEATING);
+
+    /// \brief Cancel the timer.
+    ///
+    /// The call back function is released.  If the timer has already
+    /// been canceled, this method effectively does nothing.
+    ///
+    /// This method never throws an exception.
+    void cancel();
+
+    /// \brief Return the timer interval.
+    ///
+    /// This method returns the timer interval in milliseconds if it's
+    /// running; if the timer has been canceled (or it was a one-shot timer
+    /// that has expired) it returns 0.
+    ///
+    /// This method never throws an exception.
+    long getInterval() const;
+
+private:
+    boost::scoped_ptr<WheelTimerImpl> impl_;
+};
+
+} // namespace asiolink
+} // namespace bundy
+#endif // ASIOLINK_TIMER_WHEEL_H
@@ -0,0 +1,41 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef AUTH_LOGGER_H
+#define AUTH_LOGGER_H 1
+
+#include <log/macros.h>
+#include <auth/libauth_messages.h>
+
+/// \file auth/logger.h
+/// \brief Authoritative server library global logger
+///
+/// This holds the logger for the authoritative server library.  It is a
+/// private header and should not be included in any publicly used header,
+/// only in local cc files.
+
+namespace bundy {
+namespace auth {
+
+/// \brief The logger for this library
+extern bundy::log::Logger logger;
+
+}
+}
+
+#endif // AUTH_LOGGER_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -0,0 +1,338 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <auth/rrl.h>
+#include <auth/rrl_entry.h>
+#include <auth/rrl_key.h>
+#include <auth/rrl_name_pool.h>
+#include <auth/rrl_table.h>
+#include <auth/rrl_timestamps.h>
+#include <auth/logger.h>
+
+#include <exceptions/exceptions.h>
+
+#include <dns/labelsequence.h>
+#include <dns/name.h>
+#include <dns/rrclass.h>
+#include <dns/rrtype.h>
+
+#include <asiolink/io_endpoint.h>
+
+#include <util/random/random_number_generator.h>
+#include <util/time_utilities.h>
+
+#include <boost/bind.hpp>
+
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <netinet/in.h>
+#include <stdint.h>
+
+using namespace bundy::auth::detail;
+using bundy::asiolink::IOEndpoint;
+
+namespace bundy {
+namespace auth {
+
+namespace {
+// The max number of query names saved for logging.
+const size_t MAX_LOG_NAMES = 1000;
+
+// The number of slots of recently limited client networks.
+const size_t MAX_LIMITED_CLIENTS = 4096;
+
+const int MAX_RATE = 1000000;
+const int MAX_WINDOW = 3600;
+const int MAX_SLIP = 10;
+
+const char*
+getTypeText(ResponseType resp_type) {
+    switch (resp_type) {
+    case RESPONSE_QUERY:
+        return ("responses");
+    case RESPONSE_NXDOMAIN:
+        return ("NXDOMAIN responses");
+    case RESPONSE_ERROR:
+        return ("error responses");
+    }
+    return ("?");
+}
+
+// Convert an IPv4 prefix length to a network byte order mask.
+uint32_t
+getIPv4Mask(size_t prefixlen) {
+    return (prefixlen == 0 ? 0 : htonl(0xffffffffU << (32 - prefixlen)));
+}
+
+// Same for IPv6 (only the higher 64 bits are used).
+void
+setIPv6Masks(size_t prefixlen, uint32_t masks[4]) {
+    for (size_t i = 0; i < 4; ++i) {
+        const size_t len = prefixlen > 32 * i ? prefixlen - 32 * i : 0;
+        masks[i] = getIPv4Mask(len > 32 ? 32 : len);
+    }
+}
+
+void
+checkRange(const char* what, int value, int min_value, int max_value) {
+    if (value < min_value || value > max_value) {
+        bundy_throw(InvalidParameter, "RRL " << what << " out of range: "
+                    << value);
+    }
+}
+}
+
+struct ResponseRateLimiter::Impl {
+    Impl(size_t max_table_size, int responses_per_second,
+         int nxdomains_per_second, int errors_per_second, int window, int slip,
+         size_t ipv4_prefixlen, size_t ipv6_prefixlen, bool log_only,
+         std::time_t now) :
+        window_(window), slip_(slip), ipv4_prefixlen_(ipv4_prefixlen),
+        ipv6_prefixlen_(ipv6_prefixlen), log_only_(log_only),
+        ipv4_mask_(getIPv4Mask(ipv4_prefixlen)),
+        hash_seed_(util::random::UniformRandomIntegerGenerator(
+                       0, std::numeric_limits<int>::max())()),
+        table_(max_table_size), names_(MAX_LOG_NAMES),
+        limited_clients_(MAX_LIMITED_CLIENTS),
+        ts_bases_(now, boost::bind(&RRLTable::invalidateTimestamps,
+                                   &table_, _1))
+    {
+        rates_[RESPONSE_QUERY] = responses_per_second;
+        rates_[RESPONSE_NXDOMAIN] = nxdomains_per_second;
+        rates_[RESPONSE_ERROR] = errors_per_second;
+        setIPv6Masks(ipv6_prefixlen, ipv6_masks_);
+    }
+
+    // A key identifying the network of the client only.
+    RRLKey getClientKey(const IOEndpoint& client) const {
+        return (RRLKey(client, dns::RRType(0), NULL, dns::RRClass(0),
+                       RESPONSE_ERROR, ipv4_mask_, ipv6_masks_, hash_seed_));
+    }
+
+    void startLimiting(RRLEntry& entry, const dns::Name* qname);
+    void stopLimiting(RRLEntry& entry);
+    std::string getNameText(const RRLEntry& entry);
+
+    int rates_[RESPONSE_TYPE_MAX + 1];
+    const int window_;
+    const int slip_;
+    const size_t ipv4_prefixlen_;
+    const size_t ipv6_prefixlen_;
+    const bool log_only_;
+    const uint32_t ipv4_mask_;
+    uint32_t ipv6_masks_[4];
+    const uint32_t hash_seed_;
+    RRLTable table_;
+    NamePool names_;
+
+    // Client networks whose responses were recently limited, indexed by
+    // the hash of their key.  A slot only keeps the latest one mapped to it.
+    struct LimitedClient {
+        LimitedClient() : hash(0), last(0) {}
+        size_t hash;
+        std::time_t last;
+    };
+    std::vector<LimitedClient> limited_clients_;
+
+    RRLTimeStamps ts_bases_;
+};
+
+std::string
+ResponseRateLimiter::Impl::getNameText(const RRLEntry& entry) {
+    const RRLKey& key = entry.getKey();
+    const dns::Name* name = names_.getName(entry.getLogIndex());
+    std::string text = name ? name->toText() : std::string("(any)");
+    if (key.getResponseType() == RESPONSE_QUERY) {
+        text += "/" + key.getClassText() + "/" + key.getType().toText();
+    }
+    return (text);
+}
+
+void
+ResponseRateLimiter::Impl::startLimiting(RRLEntry& entry,
+                                         const dns::Name* qname)
+{
+    size_t log_index = MAX_LOG_NAMES; // "no name" in the NamePool
+    if (qname && entry.getKey().getResponseType() != RESPONSE_ERROR) {
+        log_index = names_.saveName(*qname).second;
+    }
+    entry.setLimited(true, log_index);
+    LOG_INFO(logger, log_only_ ? LIBAUTH_RRL_LOG_ONLY_LIMIT_START :
+             LIBAUTH_RRL_LIMIT_START).
+        arg(getTypeText(entry.getKey().getResponseType())).
+        arg(entry.getKey().getIPText(ipv4_prefixlen_, ipv6_prefixlen_)).
+        arg(getNameText(entry));
+}
+
+void
+ResponseRateLimiter::Impl::stopLimiting(RRLEntry& entry) {
+    LOG_INFO(logger, LIBAUTH_RRL_LIMIT_STOP).
+        arg(getTypeText(entry.getKey().getResponseType())).
+        arg(entry.getKey().getIPText(ipv4_prefixlen_, ipv6_prefixlen_)).
+        arg(getNameText(entry));
+    names_.freeName(entry.getLogIndex());
+    entry.setLimited(false, MAX_LOG_NAMES);
+}
+
+ResponseRateLimiter::ResponseRateLimiter(size_t max_table_size,
+                                         int responses_per_second,
+                                         int nxdomains_per_second,
+                                         int errors_per_second, int window,
+                                         int slip, size_t ipv4_prefixlen,
+                                         size_t ipv6_prefixlen, bool log_only,
+                                         std::time_t now) :
+    impl_(NULL)
+{
+    checkRange("responses-per-second", responses_per_second, 0, MAX_RATE);
+    checkRange("nxdomains-per-second", nxdomains_per_second, 0, MAX_RATE);
+    checkRange("errors-per-second", errors_per_second, 0, MAX_RATE);
+    checkRange("window", window, 1, MAX_WINDOW);
+    checkRange("slip", slip, 0, MAX_SLIP);
+    if (ipv4_prefixlen > 32) {
+        bundy_throw(InvalidParameter, "RRL IPv4 prefix length out of range: "
+                    << ipv4_prefixlen);
+    }
+    if (ipv6_prefixlen > 64) {
+        bundy_throw(InvalidParameter, "RRL IPv6 prefix length out of range: "
+                    << ipv6_prefixlen);
+    }
+    impl_ = new Impl(max_table_size, responses_per_second,
+                     nxdomains_per_second, errors_per_second, window, slip,
+                     ipv4_prefixlen, ipv6_prefixlen, log_only, now);
+}
+
+ResponseRateLimiter::~ResponseRateLimiter() {
+    delete impl_;
+}
+
+RRLResult
+ResponseRateLimiter::check(const IOEndpoint& client, bool using_tcp,
+                           const dns::RRClass& qclass,
+                           const dns::RRType& qtype, const dns::Name* qname,
+                           ResponseType resp_type, std::time_t now)
+{
+    // TCP clients can't spoof their addresses, so there's no point of
+    // limiting them.
+    if (using_tcp) {
+        return (RRL_OK);
+    }
+    const int rate = impl_->rates_[resp_type];
+    if (rate == 0) {
+        return (RRL_OK);
+    }
+
+    // Error responses are limited per client, regardless of the name.
+    const bool use_name = qname && resp_type != RESPONSE_ERROR;
+    const dns::LabelSequence labels(use_name ? *qname : dns::Name::ROOT_NAME());
+    const RRLKey key(client, qtype, use_name ? &labels : NULL, qclass,
+                     resp_type, impl_->ipv4_mask_, impl_->ipv6_masks_,
+                     impl_->hash_seed_);
+
+    RRLEntry* entry = impl_->table_.findEntry(key);
+    if (!entry) {
+        RRLEntry& oldest = impl_->table_.getOldestEntry();
+        if (oldest.isLimited()) {
+            impl_->stopLimiting(oldest);
+        }
+        impl_->table_.rekeyEntry(oldest, key);
+        entry = &oldest;
+    }
+
+    const RRLResult result = entry->updateBalance(impl_->ts_bases_, rate,
+                                                  impl_->slip_,
+                                                  impl_->window_, now);
+    if (result == RRL_OK) {
+        if (entry->isLimited()) {
+            impl_->stopLimiting(*entry);
+        }
+        return (RRL_OK);
+    }
+    if (!entry->isLimited()) {
+        impl_->startLimiting(*entry, qname);
+    }
+    if (impl_->log_only_) {
+        return (RRL_OK);
+    }
+    const size_t hash = impl_->getClientKey(client).getHash();
+    Impl::LimitedClient& limited =
+        impl_->limited_clients_[hash % MAX_LIMITED_CLIENTS];
+    limited.hash = hash;
+    limited.last = now;
+    return (result);
+}
+
+bool
+ResponseRateLimiter::isLimitedClient(const IOEndpoint& client,
+                                     std::time_t now) const
+{
+    if (impl_->log_only_) {
+        return (false);
+    }
+    const size_t hash = impl_->getClientKey(client).getHash();
+    const Impl::LimitedClient& limited =
+        impl_->limited_clients_[hash % MAX_LIMITED_CLIENTS];
+    return (limited.last != 0 && limited.hash == hash &&
+            now - limited.last < impl_->window_);
+}
+
+int
+ResponseRateLimiter::getResponseRate() const {
+    return (impl_->rates_[RESPONSE_QUERY]);
+}
+
+int
+ResponseRateLimiter::getNXDOMAINRate() const {
+    return (impl_->rates_[RESPONSE_NXDOMAIN]);
+}
+
+int
+ResponseRateLimiter::getErrorRate() const {
+    return (impl_->rates_[RESPONSE_ERROR]);
+}
+
+int
+ResponseRateLimiter::getWindow() const {
+    return (impl_->window_);
+}
+
+int
+ResponseRateLimiter::getSlip() const {
+    return (impl_->slip_);
+}
+
+bool
+ResponseRateLimiter::isLogOnly() const {
+    return (impl_->log_only_);
+}
+
+size_t
+ResponseRateLimiter::getTableSize() const {
+    return (impl_->table_.getMaxEntries());
+}
+
+size_t
+ResponseRateLimiter::getEntryCount() const {
+    return (impl_->table_.getEntryCount());
+}
+
+std::time_t
+ResponseRateLimiter::getCurrentTime() {
+    return (static_cast<std::time_t>(
+                util::CoarseClock::getMonotonicMillis() / 1000));
+}
+
+} // namespace auth
+} // namespace bundy
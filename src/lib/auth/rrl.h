@@ -0,0 +1,185 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef AUTH_RRL_H
+#define AUTH_RRL_H 1
+
+#include <auth/rrl_response_type.h>
+#include <auth/rrl_result.h>
+
+#include <dns/dns_fwd.h>
+
+#include <exceptions/exceptions.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <cstddef>
+#include <ctime>
+
+namespace bundy {
+namespace asiolink {
+class IOEndpoint;
+}
+
+namespace auth {
+
+/// \brief Response Rate Limiter.
+///
+/// This class implements the DNS Response Rate Limiting (RRL) mechanism
+/// (compatible with that of BIND 9) to mitigate reflection/amplification
+/// attacks that use the server.
+///
+/// Responses are classified by the client network (the client address
+/// masked with the configured prefix lengths), the response type (see
+/// \c detail::ResponseType), and, depending on the type, the query name,
+/// type and class.  Each class of responses is allowed up to the configured
+/// rate per second, averaged over the configured window; responses beyond
+/// that are limited, i.e., either dropped or replaced with a truncated
+/// response ("slip"), which lets legitimate clients retry over TCP.
+/// Responses over TCP are never limited, as the source address of a TCP
+/// client can't be spoofed.
+///
+/// The state is kept in a fixed-size table allocated on construction
+/// (see \c detail::RRLTable), so checking a response takes constant time
+/// and normally doesn't allocate memory; the only exception is saving the
+/// query name of a newly limited entry for logging, which is only needed
+/// when limiting starts and the number of saved names is bounded.
+///
+/// This class is not thread safe; if it's shared by multiple threads, the
+/// caller must serialize the calls to \c check().
+class ResponseRateLimiter : boost::noncopyable {
+public:
+    /// \brief Constructor.
+    ///
+    /// A rate of 0 means responses of that type are never limited.
+    ///
+    /// \throw bundy::InvalidParameter any of the parameters is out of range
+    /// \throw std::bad_alloc memory allocation failed
+    ///
+    /// \param max_table_size The number of entries of the state table
+    ///        (must be positive).
+    /// \param responses_per_second Allowed rate of non-error responses
+    ///        per client network, query name and type.
+    /// \param nxdomains_per_second Allowed rate of NXDOMAIN responses per
+    ///        client network and zone.
+    /// \param errors_per_second Allowed rate of error responses per
+    ///        client network.
+    /// \param window The period (in seconds, 1 to 3600) over which the
+    ///        rates are averaged.
+    /// \param slip One of every this many limited responses is sent as a
+    ///        truncated response (0 to 10; 0 means all are dropped).
+    /// \param ipv4_prefixlen The prefix length of IPv4 client networks
+    ///        (0 to 32).
+    /// \param ipv6_prefixlen The prefix length of IPv6 client networks
+    ///        (0 to 64).
+    /// \param log_only If true, limited responses are only logged and sent
+    ///        as usual.
+    /// \param now The current time.
+    ResponseRateLimiter(size_t max_table_size, int responses_per_second,
+                        int nxdomains_per_second, int errors_per_second,
+                        int window, int slip, size_t ipv4_prefixlen,
+                        size_t ipv6_prefixlen, bool log_only,
+                        std::time_t now);
+
+    /// \brief Destructor.
+    ~ResponseRateLimiter();
+
+    /// \brief Check whether a response should be limited.
+    ///
+    /// \param client The client's endpoint.
+    /// \param using_tcp true if the query was received over TCP.
+    /// \param qclass The query class.
+    /// \param qtype The query type.
+    /// \param qname The name to identify the response: the query name for
+    ///        positive answers, the zone name for NXDOMAIN; can be NULL
+    ///        (it's ignored for error responses anyway).
+    /// \param resp_type The type of the response.
+    /// \param now The current time.
+    ///
+    /// \return \c RRL_OK if the response can be sent (always the case in
+    /// the log-only mode), \c RRL_DROP if it should be dropped, or
+    /// \c RRL_SLIP if a truncated response should be sent instead.
+    RRLResult check(const asiolink::IOEndpoint& client, bool using_tcp,
+                    const dns::RRClass& qclass, const dns::RRType& qtype,
+                    const dns::Name* qname, detail::ResponseType resp_type,
+                    std::time_t now);
+
+    /// \brief Check whether a client has recently been limited.
+    ///
+    /// It returns true if any response to the client's network was limited
+    /// (dropped or slipped) by \c check() within the configured window.
+    /// This is cheaper than \c check() and doesn't need the response, so
+    /// it can be used to shed queries from such clients before answering
+    /// them, e.g., when the server is overloaded.  The networks are kept
+    /// in a fixed-size table, so a recently limited network can be
+    /// forgotten if many others are limited as well.
+    ///
+    /// It always returns false in the log-only mode.
+    ///
+    /// \throw None
+    ///
+    /// \param client The client's endpoint.
+    /// \param now The current time.
+    bool isLimitedClient(const asiolink::IOEndpoint& client,
+                         std::time_t now) const;
+
+    /// \brief Return the configured rate of non-error responses.
+    int getResponseRate() const;
+
+    /// \brief Return the configured rate of NXDOMAIN responses.
+    int getNXDOMAINRate() const;
+
+    /// \brief Return the configured rate of error responses.
+    int getErrorRate() const;
+
+    /// \brief Return the configured window.
+    int getWindow() const;
+
+    /// \brief Return the configured slip ratio.
+    int getSlip() const;
+
+    /// \brief Return true if the limiter is in the log-only mode.
+    bool isLogOnly() const;
+
+    /// \brief Return the number of entries of the state table.
+    size_t getTableSize() const;
+
+    /// \brief Return the number of entries currently in use.
+    ///
+    /// This is mainly for tests and diagnostics.
+    size_t getEntryCount() const;
+
+    /// \brief Return the current time to be passed as \c now.
+    ///
+    /// The limiter only compares the times it's given, so this is the
+    /// monotonic time in seconds (see \c util::CoarseClock), which isn't
+    /// distorted when the system time is changed and is cheap enough to be
+    /// read for every response.
+    ///
+    /// \throw None
+    static std::time_t getCurrentTime();
+
+private:
+    struct Impl;
+    Impl* impl_;
+};
+
+} // namespace auth
+} // namespace bundy
+
+#endif // AUTH_RRL_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -0,0 +1,90 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <auth/rrl_entry.h>
+
+namespace bundy {
+namespace auth {
+namespace detail {
+
+int
+RRLEntry::getAge(const RRLTimeStamps& ts_bases, std::time_t now) const {
+    if (!timestamp_valid_) {
+        return (RRL_TIMESTAMP_FOREVER);
+    }
+    return (RRLTimeStamps::deltaTime(
+                ts_bases.getBaseByGen(timestamp_gen_) + timestamp_, now));
+}
+
+void
+RRLEntry::setAge(RRLTimeStamps& ts_bases, std::time_t now) {
+    const std::pair<std::time_t, size_t> base = ts_bases.getCurrentBase(now);
+    const int ts = now - base.first;
+    // The base can be slightly in the future (see getCurrentBase()), in
+    // which case we consider it "now".
+    timestamp_ = ts < 0 ? 0 : ts;
+    timestamp_gen_ = base.second;
+    timestamp_valid_ = true;
+}
+
+RRLResult
+RRLEntry::updateBalance(RRLTimeStamps& ts_bases, int rate, int slip,
+                        int window, std::time_t now)
+{
+    // Credit the entry for the time elapsed since the last update.  The
+    // balance never exceeds a second's worth of responses.
+    const int age = getAge(ts_bases, now);
+    if (age > 0) {
+        if (age > window) {
+            responses_ = rate;
+        } else {
+            responses_ += rate * age;
+            if (responses_ > rate) {
+                responses_ = rate;
+            }
+        }
+        setAge(ts_bases, now);
+    }
+
+    // Debit it for this response.
+    if (--responses_ >= 0) {
+        return (RRL_OK);
+    }
+
+    // Don't let the balance get so low that it couldn't recover within
+    // the window.
+    const int min_balance = -window * rate;
+    if (responses_ < min_balance) {
+        responses_ = min_balance;
+    }
+
+    // Let some of the limited responses slip through as truncated ones
+    // so legitimate clients can retry over TCP.
+    if (slip != 0) {
+        if (slip_count_++ == 0) {
+            if (slip_count_ >= slip) {
+                slip_count_ = 0;
+            }
+            return (RRL_SLIP);
+        }
+        if (slip_count_ >= slip) {
+            slip_count_ = 0;
+        }
+    }
+    return (RRL_DROP);
+}
+
+} // namespace detail
+} // namespace auth
+} // namespace bundy
@@ -0,0 +1,177 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef AUTH_RRL_ENTRY_H
+#define AUTH_RRL_ENTRY_H 1
+
+#include <auth/rrl_key.h>
+#include <auth/rrl_result.h>
+#include <auth/rrl_timestamps.h>
+
+#include <boost/intrusive/list.hpp>
+#include <boost/intrusive/unordered_set.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <ctime>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace auth {
+namespace detail {
+
+/// \brief The age (in seconds) of an RRL entry that is considered "forever".
+///
+/// Entries store their timestamps as 12-bit offsets from one of the
+/// timestamp bases, so this is the largest age that can be represented.
+const int RRL_TIMESTAMP_FOREVER = 4096;
+
+/// \brief Timestamp bases used for RRL entries.
+typedef RRLTimeStampBases<4, RRL_TIMESTAMP_FOREVER> RRLTimeStamps;
+
+/// \brief A single entry of the RRL table.
+///
+/// An entry corresponds to a single \c RRLKey, i.e., a class of responses
+/// (such as "positive answers for a particular query name and type") to
+/// a particular client network.  It keeps the "account balance" of the
+/// key in the form of a token bucket: the balance is credited at the
+/// configured rate per second (up to the rate, i.e., for one second's
+/// worth of responses), and debited for each response.  Responses are
+/// limited while the balance is negative.
+///
+/// Entries are pre-allocated in the \c RRLTable and reused for different
+/// keys; they are linked in the table's hash buckets and LRU list via
+/// intrusive hooks so that no memory allocation is needed to handle
+/// a query.
+class RRLEntry : boost::noncopyable {
+public:
+    /// \brief Constructor.
+    ///
+    /// Constructs an entry that is not associated with any key.
+    ///
+    /// \throw None
+    RRLEntry() :
+        responses_(0), slip_count_(0), timestamp_(0), timestamp_gen_(0),
+        timestamp_valid_(false), limited_(false), log_index_(0)
+    {}
+
+    /// \brief (Re)initialize the entry for a new key.
+    ///
+    /// The balance and timestamp are reset, so the next call to
+    /// \c updateBalance() will start with a full balance.
+    ///
+    /// \throw None
+    void reset(const RRLKey& key) {
+        key_ = key;
+        responses_ = 0;
+        slip_count_ = 0;
+        timestamp_valid_ = false;
+        limited_ = false;
+    }
+
+    /// \brief Return the key of the entry.
+    const RRLKey& getKey() const { return (key_); }
+
+    /// \brief Return the number of seconds since the entry was last updated.
+    ///
+    /// If the entry doesn't have a valid timestamp, it returns
+    /// \c RRL_TIMESTAMP_FOREVER.
+    ///
+    /// \throw None
+    int getAge(const RRLTimeStamps& ts_bases, std::time_t now) const;
+
+    /// \brief Update the timestamp of the entry to the given time.
+    ///
+    /// This may cause the generation of a new timestamp base in
+    /// \c ts_bases.
+    void setAge(RRLTimeStamps& ts_bases, std::time_t now);
+
+    /// \brief Invalidate the timestamp if it's based on the given generation.
+    ///
+    /// This is expected to be called when a timestamp base is about to be
+    /// reused for a new base time.
+    ///
+    /// \throw None
+    void invalidateTimestamp(size_t gen) {
+        if (timestamp_valid_ && timestamp_gen_ == gen) {
+            timestamp_valid_ = false;
+        }
+    }
+
+    /// \brief Account for a new response and decide whether to limit it.
+    ///
+    /// The balance is first credited for the time elapsed since the last
+    /// update, then debited for the response.  If the balance stays
+    /// non negative, \c RRL_OK is returned.  Otherwise, the balance is
+    /// capped at <code>-window * rate</code> and the response is limited:
+    /// if \c slip is non 0, every <code>slip</code>-th limited response
+    /// (starting with the first one) results in \c RRL_SLIP, and others result
+    /// in \c RRL_DROP.
+    ///
+    /// \param ts_bases The timestamp bases.
+    /// \param rate The allowed number of responses per second; must be
+    ///        positive.
+    /// \param slip The slip ratio (0 disables slipping).
+    /// \param window The window of the rate calculation in seconds.
+    /// \param now The current time.
+    RRLResult updateBalance(RRLTimeStamps& ts_bases, int rate, int slip,
+                            int window, std::time_t now);
+
+    /// \brief Return the current balance of responses (mainly for tests).
+    int getResponseBalance() const { return (responses_); }
+
+    /// \brief Return true if responses of the entry are being limited.
+    ///
+    /// It's set by the \c setLimited() and reset by \c reset().  It's
+    /// intended to be used to log the start and end of limiting.
+    bool isLimited() const { return (limited_); }
+
+    /// \brief Mark the entry as limited or not.
+    ///
+    /// \param limited Whether the entry is limited.
+    /// \param log_index A \c NamePool index of the name for logging.
+    void setLimited(bool limited, size_t log_index) {
+        limited_ = limited;
+        log_index_ = log_index;
+    }
+
+    /// \brief Return the \c NamePool index for logging (set by setLimited()).
+    size_t getLogIndex() const { return (log_index_); }
+
+    /// \brief Hook for the LRU list of the \c RRLTable.
+    boost::intrusive::list_member_hook<> lru_hook_;
+
+    /// \brief Hook for the hash buckets of the \c RRLTable.
+    boost::intrusive::unordered_set_member_hook<> hash_hook_;
+
+private:
+    RRLKey key_;
+    int32_t responses_;         // the balance of responses
+    uint8_t slip_count_;
+    uint16_t timestamp_;        // offset from the base of timestamp_gen_
+    uint8_t timestamp_gen_;
+    bool timestamp_valid_;
+    bool limited_;
+    size_t log_index_;
+};
+
+} // namespace detail
+} // namespace auth
+} // namespace bundy
+
+#endif // AUTH_RRL_ENTRY_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -0,0 +1,161 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <auth/rrl_table.h>
+#include <auth/rrl_entry.h>
+#include <auth/rrl_key.h>
+
+#include <exceptions/exceptions.h>
+
+#include <boost/intrusive/list.hpp>
+#include <boost/intrusive/unordered_set.hpp>
+#include <boost/scoped_array.hpp>
+
+namespace bundy {
+namespace auth {
+namespace detail {
+
+namespace {
+struct EntryHash {
+    size_t operator()(const RRLEntry& entry) const {
+        return (entry.getKey().getHash());
+    }
+    size_t operator()(const RRLKey& key) const {
+        return (key.getHash());
+    }
+};
+
+struct EntryEqual {
+    bool operator()(const RRLEntry& entry1, const RRLEntry& entry2) const {
+        return (entry1.getKey() == entry2.getKey());
+    }
+    bool operator()(const RRLKey& key, const RRLEntry& entry) const {
+        return (key == entry.getKey());
+    }
+};
+
+// Return the smallest power of 2 that is equal to or larger than n.
+size_t
+getBucketCount(size_t n) {
+    size_t count = 1;
+    while (count < n) {
+        count <<= 1;
+    }
+    return (count);
+}
+}
+
+struct RRLTable::Impl {
+    typedef boost::intrusive::list<
+        RRLEntry,
+        boost::intrusive::member_hook<
+            RRLEntry, boost::intrusive::list_member_hook<>,
+            &RRLEntry::lru_hook_> > LRUList;
+    typedef boost::intrusive::unordered_set<
+        RRLEntry,
+        boost::intrusive::member_hook<
+            RRLEntry, boost::intrusive::unordered_set_member_hook<>,
+            &RRLEntry::hash_hook_>,
+        boost::intrusive::hash<EntryHash>,
+        boost::intrusive::equal<EntryEqual>,
+        boost::intrusive::power_2_buckets<true> > HashTable;
+
+    Impl(size_t max_entries) :
+        max_entries_(max_entries),
+        entries_(new RRLEntry[max_entries]),
+        n_buckets_(getBucketCount(max_entries)),
+        buckets_(new HashTable::bucket_type[n_buckets_]),
+        hash_table_(HashTable::bucket_traits(buckets_.get(), n_buckets_))
+    {
+        for (size_t i = 0; i < max_entries_; ++i) {
+            lru_.push_back(entries_[i]);
+        }
+    }
+
+    ~Impl() {
+        // intrusive containers must be cleared before the elements are
+        // destroyed.
+        hash_table_.clear();
+        lru_.clear();
+    }
+
+    void touch(RRLEntry& entry) {
+        lru_.splice(lru_.begin(), lru_, lru_.iterator_to(entry));
+    }
+
+    const size_t max_entries_;
+    boost::scoped_array<RRLEntry> entries_;
+    const size_t n_buckets_;
+    boost::scoped_array<HashTable::bucket_type> buckets_;
+    HashTable hash_table_;
+    LRUList lru_;               // the front is the most recently used
+};
+
+RRLTable::RRLTable(size_t max_entries) : impl_(NULL) {
+    if (max_entries == 0) {
+        bundy_throw(InvalidParameter, "RRL table size must not be 0");
+    }
+    impl_ = new Impl(max_entries);
+}
+
+RRLTable::~RRLTable() {
+    delete impl_;
+}
+
+RRLEntry*
+RRLTable::findEntry(const RRLKey& key) {
+    const Impl::HashTable::iterator it =
+        impl_->hash_table_.find(key, EntryHash(), EntryEqual());
+    if (it == impl_->hash_table_.end()) {
+        return (NULL);
+    }
+    impl_->touch(*it);
+    return (&*it);
+}
+
+RRLEntry&
+RRLTable::getOldestEntry() {
+    return (impl_->lru_.back());
+}
+
+void
+RRLTable::rekeyEntry(RRLEntry& entry, const RRLKey& key) {
+    if (entry.hash_hook_.is_linked()) {
+        impl_->hash_table_.erase(impl_->hash_table_.iterator_to(entry));
+    }
+    entry.reset(key);
+    impl_->hash_table_.insert(entry);
+    impl_->touch(entry);
+}
+
+void
+RRLTable::invalidateTimestamps(size_t gen) {
+    for (size_t i = 0; i < impl_->max_entries_; ++i) {
+        impl_->entries_[i].invalidateTimestamp(gen);
+    }
+}
+
+size_t
+RRLTable::getEntryCount() const {
+    return (impl_->hash_table_.size());
+}
+
+size_t
+RRLTable::getMaxEntries() const {
+    return (impl_->max_entries_);
+}
+
+} // namespace detail
+} // namespace auth
+} // namespace bundy
@@ -0,0 +1,116 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef AUTH_RRL_TABLE_H
+#define AUTH_RRL_TABLE_H 1
+
+#include <auth/rrl_entry.h>
+#include <auth/rrl_key.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <cstddef>
+
+namespace bundy {
+namespace auth {
+namespace detail {
+
+/// \brief The table of RRL entries.
+///
+/// This is a fixed-size table of \c RRLEntry objects, indexed by a hash
+/// of \c RRLKey.  All entries and hash buckets are allocated on
+/// construction; once constructed, no operation of this class allocates
+/// memory, and all of them (except \c invalidateTimestamps()) run in
+/// constant time.
+///
+/// The entries are also linked in a least-recently-used list.  When an
+/// entry for a new key is needed, the least recently used one (which may
+/// be an entry that has never been used) is recycled for the key; this
+/// way the table keeps the most active clients while limiting the memory
+/// footprint even under a flood of queries from many different (possibly
+/// spoofed) addresses.
+class RRLTable : boost::noncopyable {
+public:
+    /// \brief Constructor.
+    ///
+    /// \throw bundy::InvalidParameter max_entries is 0
+    /// \throw std::bad_alloc memory allocation failed
+    ///
+    /// \param max_entries The number of entries of the table.
+    explicit RRLTable(size_t max_entries);
+
+    /// \brief Destructor.
+    ~RRLTable();
+
+    /// \brief Find the entry for the given key.
+    ///
+    /// If found, the entry is marked as the most recently used.
+    ///
+    /// \throw None
+    ///
+    /// \return A pointer to the found entry, or NULL if not found.
+    RRLEntry* findEntry(const RRLKey& key);
+
+    /// \brief Return the least recently used entry.
+    ///
+    /// This is the entry that will be recycled in the next call to
+    /// \c rekeyEntry().  The caller can use it to clean up things related
+    /// to the entry (such as logging) before it's reused.
+    ///
+    /// \throw None
+    RRLEntry& getOldestEntry();
+
+    /// \brief Reuse the given entry for a new key.
+    ///
+    /// The entry is reset for the key (see \c RRLEntry::reset()) and marked
+    /// as the most recently used.  The given key must not be in the table.
+    ///
+    /// \throw None
+    void rekeyEntry(RRLEntry& entry, const RRLKey& key);
+
+    /// \brief Invalidate timestamps of all entries based on a timestamp
+    /// base generation.
+    ///
+    /// This is expected to be called when the base is about to be reused
+    /// (see \c RRLTimeStampBases).  Unlike other methods, this takes time
+    /// proportional to the table size, but it only happens once in a
+    /// long period (about an hour).
+    ///
+    /// \throw None
+    void invalidateTimestamps(size_t gen);
+
+    /// \brief Return the number of entries that are associated with a key.
+    ///
+    /// \throw None
+    size_t getEntryCount() const;
+
+    /// \brief Return the total number of entries of the table.
+    ///
+    /// \throw None
+    size_t getMaxEntries() const;
+
+private:
+    struct Impl;
+    Impl* impl_;
+};
+
+} // namespace detail
+} // namespace auth
+} // namespace bundy
+
+#endif // AUTH_RRL_TABLE_H
+
+// Local Variables:
+// mode: c++
+// End:
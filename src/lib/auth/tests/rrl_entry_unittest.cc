@@ -0,0 +1,180 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <auth/rrl_entry.h>
+#include <auth/rrl_key.h>
+
+#include <dns/labelsequence.h>
+#include <dns/name.h>
+#include <dns/rrclass.h>
+#include <dns/rrtype.h>
+
+#include <asiolink/io_address.h>
+#include <asiolink/io_endpoint.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <ctime>
+
+#include <netinet/in.h>
+
+using namespace bundy::auth;
+using namespace bundy::auth::detail;
+using namespace bundy::dns;
+using bundy::asiolink::IOEndpoint;
+using bundy::asiolink::IOAddress;
+
+namespace {
+
+const uint32_t MASK6[4] = { 0xffffffff, 0xffffffff, 0, 0 };
+
+class RRLEntryTest : public ::testing::Test {
+protected:
+    RRLEntryTest() :
+        now_(1000),
+        ts_bases_(now_, boost::bind(&RRLEntryTest::baseChanged, this, _1)),
+        ep_(IOEndpoint::create(IPPROTO_UDP, IOAddress("192.0.2.1"), 53210)),
+        qname_("example.com"), qlabels_(qname_),
+        key_(*ep_, RRType::A(), &qlabels_, RRClass::IN(), RESPONSE_QUERY,
+             0xffffffff, MASK6, 0)
+    {
+        entry_.reset(key_);
+    }
+
+    // Consume as many responses as 'count' at the current time, and return
+    // the result of the last one.
+    RRLResult consume(int count, int rate, int slip = 0, int window = 15) {
+        RRLResult result = RRL_OK;
+        for (int i = 0; i < count; ++i) {
+            result = entry_.updateBalance(ts_bases_, rate, slip, window,
+                                          now_);
+        }
+        return (result);
+    }
+
+    void baseChanged(size_t gen) { entry_.invalidateTimestamp(gen); }
+
+    std::time_t now_;
+    RRLTimeStamps ts_bases_;
+    boost::scoped_ptr<const IOEndpoint> ep_;
+    const Name qname_;
+    const LabelSequence qlabels_;
+    const RRLKey key_;
+    RRLEntry entry_;
+};
+
+TEST_F(RRLEntryTest, reset) {
+    EXPECT_TRUE(key_ == entry_.getKey());
+    EXPECT_EQ(0, entry_.getResponseBalance());
+    EXPECT_FALSE(entry_.isLimited());
+    // Without a timestamp, the age is "forever".
+    EXPECT_EQ(RRL_TIMESTAMP_FOREVER, entry_.getAge(ts_bases_, now_));
+
+    entry_.setAge(ts_bases_, now_);
+    EXPECT_EQ(0, entry_.getAge(ts_bases_, now_));
+    EXPECT_EQ(10, entry_.getAge(ts_bases_, now_ + 10));
+    entry_.setLimited(true, 42);
+    EXPECT_TRUE(entry_.isLimited());
+    EXPECT_EQ(42, entry_.getLogIndex());
+
+    entry_.reset(key_);
+    EXPECT_FALSE(entry_.isLimited());
+    EXPECT_EQ(RRL_TIMESTAMP_FOREVER, entry_.getAge(ts_bases_, now_));
+}
+
+TEST_F(RRLEntryTest, updateBalance) {
+    // A new entry starts with the full balance of one second's responses.
+    EXPECT_EQ(RRL_OK, consume(10, 10));
+    EXPECT_EQ(0, entry_.getResponseBalance());
+    // Further responses in the same second are limited.
+    EXPECT_EQ(RRL_DROP, consume(1, 10));
+    EXPECT_EQ(-1, entry_.getResponseBalance());
+
+    // The balance is credited at the rate per second, so after one second
+    // we can have 9 more responses.
+    ++now_;
+    EXPECT_EQ(RRL_OK, consume(9, 10));
+    EXPECT_EQ(RRL_DROP, consume(1, 10));
+
+    // The balance won't go below -window * rate.
+    EXPECT_EQ(RRL_DROP, consume(1000, 10, 0, 5));
+    EXPECT_EQ(-50, entry_.getResponseBalance());
+
+    // ...so it recovers in the window.
+    now_ += 5;
+    EXPECT_EQ(RRL_DROP, consume(1, 10, 0, 5));
+    ++now_;
+    EXPECT_EQ(RRL_OK, consume(1, 10, 0, 5));
+
+    // The credit never exceeds the rate.
+    now_ += 3;
+    EXPECT_EQ(RRL_OK, consume(10, 10));
+    EXPECT_EQ(RRL_DROP, consume(1, 10));
+
+    // If the entry is older than the window, it gets a full balance.
+    EXPECT_EQ(RRL_DROP, consume(1000, 10));
+    now_ += 16;
+    EXPECT_EQ(RRL_OK, consume(1, 10));
+    EXPECT_EQ(9, entry_.getResponseBalance());
+}
+
+TEST_F(RRLEntryTest, slip) {
+    EXPECT_EQ(RRL_OK, consume(10, 10, 2));
+    // With slip = 2, every other limited response slips (starting with
+    // the first one).
+    EXPECT_EQ(RRL_SLIP, consume(1, 10, 2));
+    EXPECT_EQ(RRL_DROP, consume(1, 10, 2));
+    EXPECT_EQ(RRL_SLIP, consume(1, 10, 2));
+    EXPECT_EQ(RRL_DROP, consume(1, 10, 2));
+
+    // With slip = 1, all limited responses slip.
+    EXPECT_EQ(RRL_SLIP, consume(1, 10, 1));
+    EXPECT_EQ(RRL_SLIP, consume(1, 10, 1));
+
+    // With slip = 3, one of three.
+    EXPECT_EQ(RRL_SLIP, consume(1, 10, 3));
+    EXPECT_EQ(RRL_DROP, consume(1, 10, 3));
+    EXPECT_EQ(RRL_DROP, consume(1, 10, 3));
+    EXPECT_EQ(RRL_SLIP, consume(1, 10, 3));
+}
+
+TEST_F(RRLEntryTest, invalidateTimestamp) {
+    entry_.setAge(ts_bases_, now_);
+    // Different generation: no effect
+    entry_.invalidateTimestamp(1);
+    EXPECT_EQ(0, entry_.getAge(ts_bases_, now_));
+    entry_.invalidateTimestamp(0);
+    EXPECT_EQ(RRL_TIMESTAMP_FOREVER, entry_.getAge(ts_bases_, now_));
+
+    // Timestamp bases are renewed when they get too old.  Once the
+    // generation of the entry's base is reused (after 4 renewals), the
+    // entry's timestamp is invalidated via the callback.
+    entry_.setAge(ts_bases_, now_);
+    RRLEntry other;
+    other.reset(key_);
+    for (size_t i = 0; i < 3; ++i) {
+        now_ += RRL_TIMESTAMP_FOREVER;
+        other.setAge(ts_bases_, now_);
+        EXPECT_EQ(RRL_TIMESTAMP_FOREVER * (i + 1),
+                  entry_.getAge(ts_bases_, now_));
+    }
+    now_ += RRL_TIMESTAMP_FOREVER;
+    other.setAge(ts_bases_, now_);
+    EXPECT_EQ(RRL_TIMESTAMP_FOREVER, entry_.getAge(ts_bases_, now_));
+}
+
+}
@@ -0,0 +1,125 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <auth/rrl_table.h>
+#include <auth/rrl_entry.h>
+#include <auth/rrl_key.h>
+
+#include <exceptions/exceptions.h>
+
+#include <dns/rrclass.h>
+#include <dns/rrtype.h>
+
+#include <asiolink/io_address.h>
+#include <asiolink/io_endpoint.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <string>
+
+#include <netinet/in.h>
+
+using namespace bundy::auth::detail;
+using namespace bundy::dns;
+using bundy::asiolink::IOEndpoint;
+using bundy::asiolink::IOAddress;
+
+namespace {
+
+const uint32_t MASK6[4] = { 0xffffffff, 0xffffffff, 0, 0 };
+
+// Make a key for the client address 192.0.2.<id>.
+RRLKey
+createKey(int id) {
+    const std::string addr = "192.0.2." + boost::lexical_cast<std::string>(id);
+    boost::scoped_ptr<const IOEndpoint> ep(
+        IOEndpoint::create(IPPROTO_UDP, IOAddress(addr), 53));
+    return (RRLKey(*ep, RRType::A(), NULL, RRClass::IN(), RESPONSE_QUERY,
+                   0xffffffff, MASK6, 0));
+}
+
+// Add an entry for the key in the way the table is expected to be used.
+RRLEntry&
+addEntry(RRLTable& table, const RRLKey& key) {
+    RRLEntry& entry = table.getOldestEntry();
+    table.rekeyEntry(entry, key);
+    return (entry);
+}
+
+TEST(RRLTableTest, construct) {
+    EXPECT_THROW(RRLTable(0), bundy::InvalidParameter);
+
+    RRLTable table(10);
+    EXPECT_EQ(10, table.getMaxEntries());
+    EXPECT_EQ(0, table.getEntryCount());
+    EXPECT_EQ(static_cast<RRLEntry*>(NULL), table.findEntry(createKey(1)));
+}
+
+TEST(RRLTableTest, addAndFind) {
+    RRLTable table(3);
+    RRLEntry& entry1 = addEntry(table, createKey(1));
+    EXPECT_TRUE(createKey(1) == entry1.getKey());
+    EXPECT_EQ(1, table.getEntryCount());
+    EXPECT_EQ(&entry1, table.findEntry(createKey(1)));
+    EXPECT_EQ(static_cast<RRLEntry*>(NULL), table.findEntry(createKey(2)));
+
+    RRLEntry& entry2 = addEntry(table, createKey(2));
+    EXPECT_NE(&entry1, &entry2);
+    EXPECT_EQ(2, table.getEntryCount());
+    EXPECT_EQ(&entry1, table.findEntry(createKey(1)));
+    EXPECT_EQ(&entry2, table.findEntry(createKey(2)));
+}
+
+TEST(RRLTableTest, recycle) {
+    RRLTable table(3);
+    RRLEntry& entry1 = addEntry(table, createKey(1));
+    RRLEntry& entry2 = addEntry(table, createKey(2));
+    RRLEntry& entry3 = addEntry(table, createKey(3));
+    EXPECT_EQ(3, table.getEntryCount());
+
+    // The table is now full; the oldest one is entry1.  Looking it up
+    // makes it the newest, so the next one to be recycled is entry2.
+    EXPECT_EQ(&entry1, &table.getOldestEntry());
+    EXPECT_EQ(&entry1, table.findEntry(createKey(1)));
+    EXPECT_EQ(&entry2, &table.getOldestEntry());
+
+    RRLEntry& entry4 = addEntry(table, createKey(4));
+    EXPECT_EQ(&entry2, &entry4);
+    EXPECT_EQ(3, table.getEntryCount());
+    EXPECT_EQ(static_cast<RRLEntry*>(NULL), table.findEntry(createKey(2)));
+    EXPECT_EQ(&entry4, table.findEntry(createKey(4)));
+    EXPECT_EQ(&entry3, &table.getOldestEntry());
+}
+
+TEST(RRLTableTest, invalidateTimestamps) {
+    RRLTable table(2);
+    RRLTimeStamps ts_bases(100, RRLTimeStamps::BaseChangeCallback());
+    RRLEntry& entry1 = addEntry(table, createKey(1));
+    RRLEntry& entry2 = addEntry(table, createKey(2));
+    entry1.setAge(ts_bases, 100);
+    entry2.setAge(ts_bases, 110);
+
+    table.invalidateTimestamps(1); // no entry uses gen 1
+    EXPECT_EQ(10, entry1.getAge(ts_bases, 110));
+    EXPECT_EQ(0, entry2.getAge(ts_bases, 110));
+
+    table.invalidateTimestamps(0);
+    EXPECT_EQ(RRL_TIMESTAMP_FOREVER, entry1.getAge(ts_bases, 110));
+    EXPECT_EQ(RRL_TIMESTAMP_FOREVER, entry2.getAge(ts_bases, 110));
+}
+
+}
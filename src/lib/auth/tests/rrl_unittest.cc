@@ -0,0 +1,240 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <auth/rrl.h>
+
+#include <exceptions/exceptions.h>
+
+#include <dns/name.h>
+#include <dns/rrclass.h>
+#include <dns/rrtype.h>
+
+#include <asiolink/io_address.h>
+#include <asiolink/io_endpoint.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <ctime>
+
+#include <netinet/in.h>
+
+using namespace bundy::auth;
+using namespace bundy::auth::detail;
+using namespace bundy::dns;
+using bundy::asiolink::IOEndpoint;
+using bundy::asiolink::IOAddress;
+
+namespace {
+
+class RRLTest : public ::testing::Test {
+protected:
+    RRLTest() :
+        now_(1000),
+        // 10 positive responses, 5 NXDOMAINs, 2 errors per second, slip 2
+        rrl_(100, 10, 5, 2, 15, 2, 24, 56, false, now_),
+        ep4_(IOEndpoint::create(IPPROTO_UDP, IOAddress("192.0.2.1"), 5300)),
+        ep6_(IOEndpoint::create(IPPROTO_UDP, IOAddress("2001:db8::1"), 5300)),
+        qname_("www.example.com"), zname_("example.com")
+    {}
+
+    // Check the given number of responses for the endpoint and return the
+    // number of OKs.
+    int countOK(ResponseRateLimiter& rrl, const IOEndpoint& ep, int count,
+                const Name* qname, ResponseType resp_type,
+                const RRType& qtype = RRType::A(), bool using_tcp = false)
+    {
+        int n_ok = 0;
+        for (int i = 0; i < count; ++i) {
+            if (rrl.check(ep, using_tcp, RRClass::IN(), qtype, qname,
+                          resp_type, now_) == RRL_OK) {
+                ++n_ok;
+            }
+        }
+        return (n_ok);
+    }
+
+    std::time_t now_;
+    ResponseRateLimiter rrl_;
+    boost::scoped_ptr<const IOEndpoint> ep4_;
+    boost::scoped_ptr<const IOEndpoint> ep6_;
+    const Name qname_;
+    const Name zname_;
+};
+
+TEST_F(RRLTest, construct) {
+    EXPECT_EQ(10, rrl_.getResponseRate());
+    EXPECT_EQ(5, rrl_.getNXDOMAINRate());
+    EXPECT_EQ(2, rrl_.getErrorRate());
+    EXPECT_EQ(15, rrl_.getWindow());
+    EXPECT_EQ(2, rrl_.getSlip());
+    EXPECT_FALSE(rrl_.isLogOnly());
+    EXPECT_EQ(100, rrl_.getTableSize());
+    EXPECT_EQ(0, rrl_.getEntryCount());
+
+    // Invalid parameters
+    EXPECT_THROW(ResponseRateLimiter(0, 10, 5, 2, 15, 2, 24, 56, false, now_),
+                 bundy::InvalidParameter);
+    EXPECT_THROW(ResponseRateLimiter(10, -1, 5, 2, 15, 2, 24, 56, false,
+                                     now_), bundy::InvalidParameter);
+    EXPECT_THROW(ResponseRateLimiter(10, 10, -1, 2, 15, 2, 24, 56, false,
+                                     now_), bundy::InvalidParameter);
+    EXPECT_THROW(ResponseRateLimiter(10, 10, 5, -1, 15, 2, 24, 56, false,
+                                     now_), bundy::InvalidParameter);
+    EXPECT_THROW(ResponseRateLimiter(10, 10, 5, 2, 0, 2, 24, 56, false, now_),
+                 bundy::InvalidParameter);
+    EXPECT_THROW(ResponseRateLimiter(10, 10, 5, 2, 3601, 2, 24, 56, false,
+                                     now_), bundy::InvalidParameter);
+    EXPECT_THROW(ResponseRateLimiter(10, 10, 5, 2, 15, 11, 24, 56, false,
+                                     now_), bundy::InvalidParameter);
+    EXPECT_THROW(ResponseRateLimiter(10, 10, 5, 2, 15, 2, 33, 56, false,
+                                     now_), bundy::InvalidParameter);
+    EXPECT_THROW(ResponseRateLimiter(10, 10, 5, 2, 15, 2, 24, 65, false,
+                                     now_), bundy::InvalidParameter);
+}
+
+TEST_F(RRLTest, limitResponses) {
+    // Up to the rate responses are allowed in a second.
+    EXPECT_EQ(10, countOK(rrl_, *ep4_, 15, &qname_, RESPONSE_QUERY));
+    EXPECT_EQ(1, rrl_.getEntryCount());
+
+    // 5 responses have been limited, 3 of them slipped as slip is 2.
+    // So the next one should be dropped, then the next one will slip.
+    EXPECT_EQ(RRL_DROP, rrl_.check(*ep4_, false, RRClass::IN(), RRType::A(),
+                                   &qname_, RESPONSE_QUERY, now_));
+    EXPECT_EQ(RRL_SLIP, rrl_.check(*ep4_, false, RRClass::IN(), RRType::A(),
+                                   &qname_, RESPONSE_QUERY, now_));
+
+    // Other hosts in the same /24 share the limit.
+    const boost::scoped_ptr<const IOEndpoint> ep4_2(
+        IOEndpoint::create(IPPROTO_UDP, IOAddress("192.0.2.200"), 5300));
+    EXPECT_EQ(0, countOK(rrl_, *ep4_2, 1, &qname_, RESPONSE_QUERY));
+    EXPECT_EQ(1, rrl_.getEntryCount());
+
+    // But a different network, type or name doesn't.
+    const boost::scoped_ptr<const IOEndpoint> ep4_3(
+        IOEndpoint::create(IPPROTO_UDP, IOAddress("192.0.3.1"), 5300));
+    EXPECT_EQ(10, countOK(rrl_, *ep4_3, 15, &qname_, RESPONSE_QUERY));
+    EXPECT_EQ(10, countOK(rrl_, *ep4_, 15, &qname_, RESPONSE_QUERY,
+                          RRType::AAAA()));
+    EXPECT_EQ(10, countOK(rrl_, *ep4_, 15, &zname_, RESPONSE_QUERY));
+    EXPECT_EQ(4, rrl_.getEntryCount());
+
+    // Over TCP, responses are never limited.
+    EXPECT_EQ(15, countOK(rrl_, *ep4_, 15, &qname_, RESPONSE_QUERY,
+                          RRType::A(), true));
+
+    // After a second, the rate is allowed again.
+    now_ += 2;
+    EXPECT_EQ(10, countOK(rrl_, *ep4_, 15, &qname_, RESPONSE_QUERY));
+}
+
+TEST_F(RRLTest, responseTypes) {
+    // NXDOMAIN and errors have their own rates.
+    EXPECT_EQ(5, countOK(rrl_, *ep4_, 10, &zname_, RESPONSE_NXDOMAIN));
+    EXPECT_EQ(2, countOK(rrl_, *ep4_, 10, &qname_, RESPONSE_ERROR));
+
+    // Errors are limited regardless of the name.
+    EXPECT_EQ(0, countOK(rrl_, *ep4_, 1, &zname_, RESPONSE_ERROR));
+    EXPECT_EQ(0, countOK(rrl_, *ep4_, 1, NULL, RESPONSE_ERROR));
+
+    // IPv6 clients are limited per /56.
+    const boost::scoped_ptr<const IOEndpoint> ep6_2(
+        IOEndpoint::create(IPPROTO_UDP, IOAddress("2001:db8:0:ff::1"), 5300));
+    EXPECT_EQ(5, countOK(rrl_, *ep6_, 10, &zname_, RESPONSE_NXDOMAIN));
+    EXPECT_EQ(0, countOK(rrl_, *ep6_2, 1, &zname_, RESPONSE_NXDOMAIN));
+}
+
+TEST_F(RRLTest, zeroRate) {
+    // 0 means unlimited.  Such responses don't even consume table entries.
+    ResponseRateLimiter rrl(10, 0, 0, 0, 15, 2, 24, 56, false, now_);
+    EXPECT_EQ(100, countOK(rrl, *ep4_, 100, &qname_, RESPONSE_QUERY));
+    EXPECT_EQ(100, countOK(rrl, *ep4_, 100, &zname_, RESPONSE_NXDOMAIN));
+    EXPECT_EQ(100, countOK(rrl, *ep4_, 100, NULL, RESPONSE_ERROR));
+    EXPECT_EQ(0, rrl.getEntryCount());
+}
+
+TEST_F(RRLTest, logOnly) {
+    ResponseRateLimiter rrl(100, 10, 5, 2, 15, 2, 24, 56, true, now_);
+    EXPECT_TRUE(rrl.isLogOnly());
+    EXPECT_EQ(20, countOK(rrl, *ep4_, 20, &qname_, RESPONSE_QUERY));
+}
+
+TEST_F(RRLTest, noSlip) {
+    ResponseRateLimiter rrl(100, 10, 5, 2, 15, 0, 24, 56, false, now_);
+    EXPECT_EQ(10, countOK(rrl, *ep4_, 10, &qname_, RESPONSE_QUERY));
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(RRL_DROP, rrl.check(*ep4_, false, RRClass::IN(),
+                                      RRType::A(), &qname_, RESPONSE_QUERY,
+                                      now_));
+    }
+}
+
+TEST_F(RRLTest, limitedClient) {
+    EXPECT_FALSE(rrl_.isLimitedClient(*ep4_, now_));
+
+    // Responses within the rate don't make the client limited.
+    EXPECT_EQ(10, countOK(rrl_, *ep4_, 10, &qname_, RESPONSE_QUERY));
+    EXPECT_FALSE(rrl_.isLimitedClient(*ep4_, now_));
+
+    // Once a response is limited, the whole network is, for any name.
+    EXPECT_EQ(0, countOK(rrl_, *ep4_, 1, &qname_, RESPONSE_QUERY));
+    EXPECT_TRUE(rrl_.isLimitedClient(*ep4_, now_));
+    const boost::scoped_ptr<const IOEndpoint> ep4_2(
+        IOEndpoint::create(IPPROTO_UDP, IOAddress("192.0.2.200"), 5300));
+    EXPECT_TRUE(rrl_.isLimitedClient(*ep4_2, now_));
+    const boost::scoped_ptr<const IOEndpoint> ep4_3(
+        IOEndpoint::create(IPPROTO_UDP, IOAddress("192.0.3.1"), 5300));
+    EXPECT_FALSE(rrl_.isLimitedClient(*ep4_3, now_));
+    EXPECT_FALSE(rrl_.isLimitedClient(*ep6_, now_));
+
+    // It's forgotten after the window.
+    EXPECT_TRUE(rrl_.isLimitedClient(*ep4_, now_ + 14));
+    EXPECT_FALSE(rrl_.isLimitedClient(*ep4_, now_ + 15));
+
+    // Clients are never considered limited in the log-only mode.
+    ResponseRateLimiter rrl(100, 10, 5, 2, 15, 2, 24, 56, true, now_);
+    EXPECT_EQ(20, countOK(rrl, *ep4_, 20, &qname_, RESPONSE_QUERY));
+    EXPECT_FALSE(rrl.isLimitedClient(*ep4_, now_));
+}
+
+TEST_F(RRLTest, tableFull) {
+    // The table is full with the limited entry and another; a new client
+    // recycles the least recently used entry, which starts over.
+    ResponseRateLimiter rrl(2, 1, 1, 1, 15, 0, 32, 64, false, now_);
+    EXPECT_EQ(1, countOK(rrl, *ep4_, 5, &qname_, RESPONSE_QUERY));
+    EXPECT_EQ(1, countOK(rrl, *ep6_, 5, &qname_, RESPONSE_QUERY));
+    EXPECT_EQ(2, rrl.getEntryCount());
+    const boost::scoped_ptr<const IOEndpoint> ep4_2(
+        IOEndpoint::create(IPPROTO_UDP, IOAddress("192.0.2.2"), 5300));
+    EXPECT_EQ(1, countOK(rrl, *ep4_2, 5, &qname_, RESPONSE_QUERY));
+    EXPECT_EQ(2, rrl.getEntryCount());
+    // ep4_'s entry has been recycled, so it's allowed again.
+    EXPECT_EQ(1, countOK(rrl, *ep4_, 5, &qname_, RESPONSE_QUERY));
+}
+
+TEST_F(RRLTest, getCurrentTime) {
+    // It's the monotonic time, so it never goes backwards.
+    const std::time_t start = ResponseRateLimiter::getCurrentTime();
+    EXPECT_LE(start, ResponseRateLimiter::getCurrentTime());
+
+    // The limiter works with it as with any other time.
+    now_ = start;
+    ResponseRateLimiter rrl(100, 10, 5, 2, 15, 2, 24, 56, false, now_);
+    EXPECT_EQ(10, countOK(rrl, *ep4_, 20, &qname_, RESPONSE_QUERY));
+    EXPECT_TRUE(rrl.isLimitedClient(*ep4_, now_));
+}
+
+}
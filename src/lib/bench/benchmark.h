@@ -15,11 +15,23 @@
 #ifndef BENCHMARK_H
 #define BENCHMARK_H 1
 
-#include <sys/time.h>
+#include <bench/perf_counters.h>
 
+#include <exceptions/exceptions.h>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <time.h>
+
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <ios>
+#include <string>
+#include <vector>
 
 namespace bundy {
 namespace bench {
@@ -175,6 +187,39 @@ namespace bench {
 /// object can be accessed (through its public interfaces) via the \c target_
 /// member variable of \c BenchMark.
 ///
+/// \b Statistics
+///
+/// A single measurement is easily disturbed by cold caches, page faults,
+/// CPU frequency scaling or other processes, so comparing two versions of
+/// code by a single run of each is often misleading.  The benchmark can
+/// therefore call \c T::run() a number of times without measuring it
+/// before the measurement (warm-up), and repeat the whole measurement
+/// of \c niter calls a number of times (repetitions).  In addition to the
+/// total, the result then shows the median and the standard deviation of
+/// the durations of the repetitions; if the deviation is large compared to
+/// the difference between the two versions, the comparison is meaningless.
+/// On Linux, it can also show the CPU cycles, instructions, cache misses
+/// and branch misses per iteration, using the hardware performance
+/// counters (see \c PerfCounters).  Time is measured by a monotonic clock
+/// in nanoseconds.
+///
+/// These are controlled by \c setWarmup(), \c setRepetitions() and
+/// \c setCounters(), and the result can be printed in JSON
+/// (\c setJSONOutput()) to be processed by other programs.  The defaults
+/// are taken from the following environment variables, so any existing
+/// benchmark program can use these features without modification:
+/// - \c BUNDY_BENCH_WARMUP: the number of warm-up calls to \c T::run()
+///   (default 0)
+/// - \c BUNDY_BENCH_REPETITIONS: the number of repetitions (default 1)
+/// - \c BUNDY_BENCH_COUNTERS: use hardware counters if set to non-0
+/// - \c BUNDY_BENCH_OUTPUT: print the result in JSON if set to "json"
+///
+/// With the defaults the result is the same as a single measurement.
+///
+/// The JSON output includes the duration of each repetition, so that
+/// \c tools/bench_runner.py can compare the results of two versions with
+/// a statistical test rather than by their totals.
+///
 /// <b>Future Plans and Compatibility Notes</b>
 ///
 /// Currently, benchmark developers need to write supplemental code that is
@@ -211,8 +256,10 @@ public:
     /// \param target The templated class object that
     /// implements the code to be benchmarked.
     BenchMark(const int iterations, T target) :
-        iterations_(iterations), sub_iterations_(0), target_(NULL)
+        iterations_(iterations), sub_iterations_(0), target_(NULL),
+        duration_(0)
     {
+        configure();
         initialize(target, true);
     }
 
@@ -231,12 +278,46 @@ public:
     /// \param immediate If \c true the benchmark will be performed within
     /// the constructor; otherwise it only does initialization.
     BenchMark(const int iterations, T& target, const bool immediate) :
-        iterations_(iterations), sub_iterations_(0), target_(&target)
+        iterations_(iterations), sub_iterations_(0), target_(&target),
+        duration_(0)
     {
+        configure();
         initialize(target, immediate);
     }
     //@}
 
+    /// \name Measurement parameters
+    ///
+    /// These override the defaults taken from the environment variables
+    /// (see the class description).  They are only meaningful for the
+    /// constructor that doesn't run the benchmark immediately.
+    //@{
+    /// \brief Set the number of calls to \c T::run() before measurement.
+    void setWarmup(const unsigned int warmup) { warmup_ = warmup; }
+
+    /// \brief Set the number of times to repeat the \c niter calls to
+    /// \c T::run().
+    ///
+    /// \throw InvalidParameter repetitions is 0
+    void setRepetitions(const unsigned int repetitions) {
+        if (repetitions == 0) {
+            bundy_throw(InvalidParameter, "repetitions must be positive");
+        }
+        repetitions_ = repetitions;
+    }
+
+    /// \brief Set whether to use the hardware performance counters.
+    void setCounters(const bool use_counters) {
+        use_counters_ = use_counters;
+    }
+
+    /// \brief Set whether \c printResult() prints the result in JSON.
+    void setJSONOutput(const bool json) { json_ = json; }
+
+    /// \brief Set the name of the benchmark included in the JSON output.
+    void setName(const std::string& name) { name_ = name; }
+    //@}
+
     /// \brief Hook to be called before starting benchmark.
     ///
     /// This method will be called from \c run() before starting the benchmark.
@@ -255,10 +336,14 @@ public:
 
     /// \brief Perform benchmark.
     ///
-    /// This method first calls \c setUp().
+    /// This method first calls \c setUp() and the warm-up calls to
+    /// \c T::run().
     /// It then records the current time, calls \c T::run() for the number
-    /// of times specified on construction, and records the time on completion.
+    /// of times specified on construction, and records the time on completion,
+    /// as many times as the repetitions.
     /// Finally, it calls \c tearDown().
+    ///
+    /// The results of a previous call to this method are discarded.
     void run() {
         assert(target_ != NULL);
         run(*target_);
@@ -269,17 +354,53 @@ public:
     /// This method prints the benchmark result in a common style to the
     /// standard out.  The result contains the number of total iterations,
     /// the duration of the test, and the number of iterations per second
-    /// calculated from the previous two parameters.
+    /// calculated from the previous two parameters.  If there are multiple
+    /// repetitions, it also contains the median and standard deviation of
+    /// their durations, and if the hardware counters are used, their counts
+    /// per iteration.
+    ///
+    /// If the JSON output is enabled, all of them are printed in a single
+    /// line of a JSON object instead.
     ///
     /// A call to this method is only meaningful after the completion of
     /// \c run().  The behavior is undefined in other cases.
     void printResult() const {
+        if (json_) {
+            printJSONResult();
+            return;
+        }
         std::cout.precision(6);
         std::cout << "Performed " << getIteration() << " iterations in "
                   << std::fixed << getDuration() << "s";
         std::cout.precision(2);
         std::cout << " (" << std::fixed << getIterationPerSecond() << "ips)"
                   << std::endl;
+        if (getRepetitions() > 1) {
+            const double median = getMedianDuration();
+            std::cout.precision(6);
+            std::cout << "  " << getRepetitions() << " repetitions: median "
+                      << std::fixed << median << "s, stddev "
+                      << getDurationStdDev() << "s";
+            std::cout.precision(2);
+            std::cout << " (" << std::fixed
+                      << (median > 0 ? getDurationStdDev() / median * 100 : 0)
+                      << "%)" << std::endl;
+        }
+        if (counters_) {
+            std::cout << "  per iteration:";
+            if (!counters_->isAvailable()) {
+                std::cout << " hardware counters unavailable";
+            }
+            for (int i = 0; i < PerfCounters::EVENT_COUNT; ++i) {
+                const PerfCounters::Event event =
+                    static_cast<PerfCounters::Event>(i);
+                if (counters_->isAvailable(event)) {
+                    std::cout << " " << getCountPerIteration(event) << " "
+                              << PerfCounters::getEventName(event);
+                }
+            }
+            std::cout << std::endl;
+        }
     }
 
     /// \brief Return the number of iterations.
@@ -295,18 +416,87 @@ public:
 
     /// \brief Return the duration of benchmark in seconds.
     ///
-    /// The highest possible precision of this value is microseconds.
+    /// This is the total of all repetitions, excluding the warm-up.
+    /// The highest possible precision of this value is nanoseconds.
     ///
     /// A call to this method is only meaningful after the completion of
     /// \c run().  The behavior is undefined in other cases.
-    double getDuration() const {
-        return (tv_diff_.tv_sec +
-                static_cast<double>(tv_diff_.tv_usec) / ONE_MILLION);
+    double getDuration() const { return (duration_); }
+
+    /// \brief Return the number of repetitions of the measurement.
+    unsigned int getRepetitions() const { return (repetitions_); }
+
+    /// \brief Return the durations of each repetition in seconds.
+    ///
+    /// A call to this method is only meaningful after the completion of
+    /// \c run().  The behavior is undefined in other cases.
+    const std::vector<double>& getRepetitionDurations() const {
+        return (durations_);
+    }
+
+    /// \brief Return the median of the durations of the repetitions in
+    /// seconds.
+    ///
+    /// A call to this method is only meaningful after the completion of
+    /// \c run().  The behavior is undefined in other cases.
+    double getMedianDuration() const {
+        assert(!durations_.empty());
+        std::vector<double> sorted(durations_);
+        std::sort(sorted.begin(), sorted.end());
+        const size_t n = sorted.size();
+        return ((n % 2) == 1 ? sorted[n / 2] :
+                (sorted[n / 2 - 1] + sorted[n / 2]) / 2);
+    }
+
+    /// \brief Return the sample standard deviation of the durations of the
+    /// repetitions in seconds.
+    ///
+    /// It's 0 if there is only one repetition.
+    ///
+    /// A call to this method is only meaningful after the completion of
+    /// \c run().  The behavior is undefined in other cases.
+    double getDurationStdDev() const {
+        const size_t n = durations_.size();
+        if (n < 2) {
+            return (0);
+        }
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += durations_[i];
+        }
+        const double mean = sum / n;
+        double sq_sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            sq_sum += (durations_[i] - mean) * (durations_[i] - mean);
+        }
+        return (std::sqrt(sq_sum / (n - 1)));
+    }
+
+    /// \brief Return the hardware counters of the benchmark.
+    ///
+    /// The counts are totals of all repetitions, excluding the warm-up.
+    /// It returns NULL unless the counters are enabled by \c setCounters()
+    /// (or the environment variable).
+    ///
+    /// A call to this method is only meaningful after the completion of
+    /// \c run().  The behavior is undefined in other cases.
+    const PerfCounters* getCounters() const { return (counters_.get()); }
+
+    /// \brief Return the count of a hardware counter per iteration.
+    ///
+    /// If it cannot calculate the average, including the case where the
+    /// counters are not used, it returns \c TIME_FAILURE.
+    double getCountPerIteration(const PerfCounters::Event event) const {
+        if (sub_iterations_ == 0 || !counters_) {
+            return (TIME_FAILURE);
+        }
+        return (static_cast<double>(counters_->getCount(event)) /
+                sub_iterations_);
     }
 
     /// \brief Return the average duration per iteration in seconds.
     ///
-    /// The highest possible precision of this value is microseconds.
+    /// The highest possible precision of this value is nanoseconds.
     /// The iteration is the sum of the return value of \c T::run() over
     /// all calls to it (note that it may not equal to the number of calls
     /// to \c T::run()).
@@ -319,9 +509,7 @@ public:
         if (sub_iterations_ == 0) {
             return (TIME_FAILURE);
         }
-        return ((tv_diff_.tv_sec +
-                 static_cast<double>(tv_diff_.tv_usec) / ONE_MILLION ) /
-                sub_iterations_);
+        return (duration_ / sub_iterations_);
     }
 
     /// \brief Return the number of possible iterations per second based on
@@ -332,12 +520,10 @@ public:
     /// A call to this method is only meaningful after the completion of
     /// \c run().  The behavior is undefined in other cases.
     double getIterationPerSecond() const {
-        const double duration_usec = tv_diff_.tv_sec +
-            static_cast<double>(tv_diff_.tv_usec) / ONE_MILLION;
-        if (duration_usec == 0) {
+        if (duration_ == 0) {
             return (ITERATION_FAILURE);
         }
-        return (sub_iterations_ / duration_usec);
+        return (sub_iterations_ / duration_);
     }
 public:
     /// \brief A constant that indicates a failure in \c getAverageTime().
@@ -356,15 +542,31 @@ public:
     static const int ITERATION_FAILURE = -1;
 private:
     void run(T& target) {
+        sub_iterations_ = 0;
+        duration_ = 0;
+        durations_.clear();
+        counters_.reset(use_counters_ ? new PerfCounters : NULL);
+
         setUp(target);
 
-        struct timeval beg, end;
-        gettimeofday(&beg, NULL);
-        for (unsigned int i = 0; i < iterations_; ++i) {
-            sub_iterations_ += target.run();
+        for (unsigned int i = 0; i < warmup_; ++i) {
+            target.run();
+        }
+        for (unsigned int r = 0; r < repetitions_; ++r) {
+            if (counters_) {
+                counters_->start();
+            }
+            const double beg = getTime();
+            for (unsigned int i = 0; i < iterations_; ++i) {
+                sub_iterations_ += target.run();
+            }
+            const double end = getTime();
+            if (counters_) {
+                counters_->stop();
+            }
+            durations_.push_back(end - beg);
+            duration_ += end - beg;
         }
-        gettimeofday(&end, NULL);
-        tv_diff_ = tv_subtract(end, beg);
 
         tearDown(target);
     }
@@ -375,29 +577,83 @@ private:
             printResult();
         }
     }
+
+    void printJSONResult() const {
+        std::cout.precision(9);
+        std::cout << std::fixed << "{";
+        if (!name_.empty()) {
+            std::cout << "\"name\": \"" << name_ << "\", ";
+        }
+        std::cout << "\"iterations\": " << getIteration()
+                  << ", \"duration\": " << getDuration()
+                  << ", \"warmup\": " << warmup_
+                  << ", \"repetitions\": " << getRepetitions()
+                  << ", \"median_duration\": " << getMedianDuration()
+                  << ", \"stddev_duration\": " << getDurationStdDev()
+                  << ", \"durations\": [";
+        for (size_t i = 0; i < durations_.size(); ++i) {
+            std::cout << (i > 0 ? ", " : "") << durations_[i];
+        }
+        std::cout << "]";
+        std::cout.precision(2);
+        std::cout << ", \"ips\": " << getIterationPerSecond();
+        if (counters_) {
+            std::cout << ", \"counters\": {";
+            const char* sep = "";
+            for (int i = 0; i < PerfCounters::EVENT_COUNT; ++i) {
+                const PerfCounters::Event event =
+                    static_cast<PerfCounters::Event>(i);
+                if (counters_->isAvailable(event)) {
+                    std::cout << sep << "\""
+                              << PerfCounters::getEventName(event) << "\": "
+                              << counters_->getCount(event);
+                    sep = ", ";
+                }
+            }
+            std::cout << "}";
+        }
+        std::cout << "}" << std::endl;
+    }
 private:
-    // return t1 - t2
-    struct timeval tv_subtract(const struct timeval& t1,
-                               const struct timeval& t2)
+    // Take the default parameters from the environment variables.
+    void configure() {
+        warmup_ = getEnvValue("BUNDY_BENCH_WARMUP", 0);
+        repetitions_ = std::max(getEnvValue("BUNDY_BENCH_REPETITIONS", 1),
+                                1U);
+        use_counters_ = getEnvValue("BUNDY_BENCH_COUNTERS", 0) != 0;
+        const char* const output = std::getenv("BUNDY_BENCH_OUTPUT");
+        json_ = (output != NULL && std::strcmp(output, "json") == 0);
+    }
+
+    static unsigned int getEnvValue(const char* name,
+                                    const unsigned int default_value)
     {
-        struct timeval result;
-
-        result.tv_sec = t1.tv_sec - t2.tv_sec;
-        if (t1.tv_usec >= t2.tv_usec) {
-            result.tv_usec = t1.tv_usec- t2.tv_usec;
-        } else {
-            result.tv_usec = ONE_MILLION + t1.tv_usec - t2.tv_usec;
-            --result.tv_sec;
+        const char* const value = std::getenv(name);
+        if (value == NULL || *value == '\0') {
+            return (default_value);
         }
+        return (std::strtoul(value, NULL, 10));
+    }
 
-        return (result);
+    // Return the current time of the monotonic clock in seconds.
+    static double getTime() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (ts.tv_sec + static_cast<double>(ts.tv_nsec) / ONE_BILLION);
     }
 private:
-    static const int ONE_MILLION = 1000000;
+    static const int ONE_BILLION = 1000000000;
     const unsigned int iterations_;
     unsigned int sub_iterations_;
     T* target_;
-    struct timeval tv_diff_;
+    unsigned int warmup_;
+    unsigned int repetitions_;
+    bool use_counters_;
+    bool json_;
+    std::string name_;
+    double duration_;
+    std::vector<double> durations_;
+    boost::scoped_ptr<PerfCounters> counters_;
 };
 
 }
@@ -0,0 +1,187 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef BENCH_PERF_COUNTERS_H
+#define BENCH_PERF_COUNTERS_H 1
+
+#include <boost/noncopyable.hpp>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace bench {
+
+/// \brief Hardware performance counters of the calling thread.
+///
+/// This class counts CPU cycles, instructions, cache misses and branch
+/// misses (in the user space) between \c start() and \c stop(), using the
+/// perf_event interface of Linux.  The counts of multiple start/stop
+/// periods are accumulated.
+///
+/// The counters are not always available: on other systems, on kernels
+/// that don't allow unprivileged processes to use them (see
+/// /proc/sys/kernel/perf_event_paranoid) and on virtual machines that
+/// don't expose them.  Each counter that cannot be opened is considered
+/// unavailable and counts nothing; \c isAvailable() tells whether a
+/// particular one works.  All methods are no-ops if none is available, so
+/// the caller doesn't have to care about it until it reports the result.
+///
+/// This is header-only so that benchmark programs using \c BenchMark don't
+/// have to link any additional library.
+class PerfCounters : boost::noncopyable {
+public:
+    /// \brief The counted events.
+    enum Event {
+        CYCLES = 0,
+        INSTRUCTIONS,
+        CACHE_MISSES,
+        BRANCH_MISSES,
+        EVENT_COUNT             ///< The number of events (not an event).
+    };
+
+    /// \brief Constructor.
+    ///
+    /// It opens the counters, initially stopped.  It never fails; the
+    /// counters that cannot be opened are simply unavailable.
+    PerfCounters() : leader_fd_(-1), open_count_(0) {
+        for (int i = 0; i < EVENT_COUNT; ++i) {
+            fds_[i] = -1;
+            counts_[i] = 0;
+        }
+#ifdef __linux__
+        static const uint64_t configs[EVENT_COUNT] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES
+        };
+        for (int i = 0; i < EVENT_COUNT; ++i) {
+            struct perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            // All counters are in one group led by the first opened one,
+            // so they are scheduled, enabled and read at the same time.
+            attr.disabled = (leader_fd_ == -1) ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            const int fd = syscall(__NR_perf_event_open, &attr, 0, -1,
+                                   leader_fd_, 0);
+            if (fd == -1) {
+                continue;
+            }
+            if (leader_fd_ == -1) {
+                leader_fd_ = fd;
+            }
+            fds_[i] = fd;
+            order_[open_count_++] = static_cast<Event>(i);
+        }
+#endif
+    }
+
+    /// \brief Destructor.  It closes the counters.
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int i = 0; i < EVENT_COUNT; ++i) {
+            if (fds_[i] != -1) {
+                close(fds_[i]);
+            }
+        }
+#endif
+    }
+
+    /// \brief Return whether the given counter works.
+    bool isAvailable(Event event) const { return (fds_[event] != -1); }
+
+    /// \brief Return whether any of the counters works.
+    bool isAvailable() const { return (leader_fd_ != -1); }
+
+    /// \brief Start counting.
+    void start() {
+#ifdef __linux__
+        if (leader_fd_ != -1) {
+            ioctl(leader_fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(leader_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+
+    /// \brief Stop counting, and add the counts since \c start() to the
+    /// accumulated ones.
+    void stop() {
+#ifdef __linux__
+        if (leader_fd_ == -1) {
+            return;
+        }
+        ioctl(leader_fd_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        // With PERF_FORMAT_GROUP we read the number of counters followed
+        // by their values, in the order they were opened.
+        uint64_t data[1 + EVENT_COUNT];
+        const ssize_t len = read(leader_fd_, data, sizeof(data));
+        if (len < static_cast<ssize_t>(sizeof(uint64_t))) {
+            return;
+        }
+        for (size_t i = 0; i < data[0] && i < open_count_; ++i) {
+            counts_[order_[i]] += data[1 + i];
+        }
+#endif
+    }
+
+    /// \brief Reset the accumulated counts to 0.
+    void clear() {
+        for (int i = 0; i < EVENT_COUNT; ++i) {
+            counts_[i] = 0;
+        }
+    }
+
+    /// \brief Return the accumulated count of the given event.
+    ///
+    /// It's 0 if that counter is unavailable.
+    uint64_t getCount(Event event) const { return (counts_[event]); }
+
+    /// \brief Return the textual name of the given event, such as
+    /// "cycles".
+    static const char* getEventName(Event event) {
+        static const char* const names[EVENT_COUNT] = {
+            "cycles", "instructions", "cache_misses", "branch_misses"
+        };
+        return (names[event]);
+    }
+
+private:
+    int leader_fd_;
+    int fds_[EVENT_COUNT];
+    Event order_[EVENT_COUNT];  // events in the order they were opened
+    size_t open_count_;
+    uint64_t counts_[EVENT_COUNT];
+};
+
+}
+}
+#endif  // BENCH_PERF_COUNTERS_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -12,12 +12,18 @@
 // OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
 // PERFORMANCE OF THIS SOFTWARE.
 
+#include <sys/time.h>
 #include <time.h>               // for nanosleep
 
 #include <bench/benchmark.h>
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+
 using namespace std;
 using namespace bundy::bench;
 
@@ -29,16 +35,18 @@ public:
     TestBenchMark(const int sub_iterations,
                   const struct timespec& sleep_time) :
         sub_iterations_(sub_iterations), sleep_time_(sleep_time),
-        setup_completed_(false), teardown_completed_(false)
+        setup_completed_(false), teardown_completed_(false), run_count_(0)
     {}
     unsigned int run() {
         nanosleep(&sleep_time_, NULL);
+        ++run_count_;
         return (sub_iterations_);
     }
     const int sub_iterations_;
     const struct timespec sleep_time_;
     bool setup_completed_;
     bool teardown_completed_;
+    unsigned int run_count_;
 };
 }
 
@@ -143,4 +151,107 @@ TEST(BenchMarkTest, runWithNoIteration) {
     // time would cause a division by 0 failure.
     EXPECT_EQ(bench.TIME_FAILURE, bench.getAverageTime());
 }
+
+TEST(BenchMarkTest, repetitions) {
+    const struct timespec sleep_timespec = { 0, 1000000 }; // 1ms
+    TestBenchMark test_bench(5, sleep_timespec);
+    BenchMark<TestBenchMark> bench(2, test_bench, false);
+    EXPECT_EQ(1, bench.getRepetitions());
+    EXPECT_THROW(bench.setRepetitions(0), bundy::InvalidParameter);
+    bench.setWarmup(3);
+    bench.setRepetitions(4);
+    bench.run();
+
+    // The warm-up calls are made but not counted.
+    EXPECT_EQ(3 + 2 * 4, test_bench.run_count_);
+    EXPECT_EQ(5 * 2 * 4, bench.getIteration());
+    EXPECT_EQ(4, bench.getRepetitions());
+
+    const std::vector<double>& durations = bench.getRepetitionDurations();
+    ASSERT_EQ(4, durations.size());
+    double total = 0;
+    for (size_t i = 0; i < durations.size(); ++i) {
+        EXPECT_LT(0, durations[i]);
+        total += durations[i];
+    }
+    EXPECT_DOUBLE_EQ(total, bench.getDuration());
+    EXPECT_LE(*std::min_element(durations.begin(), durations.end()),
+              bench.getMedianDuration());
+    EXPECT_GE(*std::max_element(durations.begin(), durations.end()),
+              bench.getMedianDuration());
+    EXPECT_LE(0, bench.getDurationStdDev());
+
+    // Running it again discards the previous results.
+    bench.setRepetitions(1);
+    bench.run();
+    EXPECT_EQ(5 * 2, bench.getIteration());
+    EXPECT_EQ(1, bench.getRepetitionDurations().size());
+    EXPECT_EQ(0, bench.getDurationStdDev());
+    EXPECT_DOUBLE_EQ(bench.getDuration(), bench.getMedianDuration());
+}
+
+TEST(BenchMarkTest, environment) {
+    setenv("BUNDY_BENCH_WARMUP", "1", 1);
+    setenv("BUNDY_BENCH_REPETITIONS", "3", 1);
+    const struct timespec null_timespec = { 0, 0 };
+    TestBenchMark test_bench(1, null_timespec);
+    BenchMark<TestBenchMark> bench(2, test_bench, false);
+    unsetenv("BUNDY_BENCH_WARMUP");
+    unsetenv("BUNDY_BENCH_REPETITIONS");
+    bench.run();
+    EXPECT_EQ(1 + 2 * 3, test_bench.run_count_);
+    EXPECT_EQ(3, bench.getRepetitions());
+}
+
+TEST(BenchMarkTest, jsonOutput) {
+    const struct timespec null_timespec = { 0, 0 };
+    TestBenchMark test_bench(1, null_timespec);
+    BenchMark<TestBenchMark> bench(2, test_bench, false);
+    bench.setName("test");
+    bench.setRepetitions(3);
+    bench.setJSONOutput(true);
+    bench.run();
+
+    std::ostringstream output;
+    std::streambuf* const saved = std::cout.rdbuf(output.rdbuf());
+    bench.printResult();
+    std::cout.rdbuf(saved);
+
+    // A single line, with the duration of each repetition.
+    const std::string result = output.str();
+    EXPECT_EQ(0, result.find("{\"name\": \"test\", \"iterations\": 6, "));
+    EXPECT_NE(std::string::npos, result.find("\"repetitions\": 3, "));
+    const size_t durations = result.find("\"durations\": [");
+    ASSERT_NE(std::string::npos, durations);
+    EXPECT_EQ(2, std::count(result.begin() + durations,
+                            result.begin() + result.find(']', durations),
+                            ','));
+    EXPECT_EQ(1, std::count(result.begin(), result.end(), '\n'));
+}
+
+TEST(BenchMarkTest, counters) {
+    const struct timespec null_timespec = { 0, 0 };
+    TestBenchMark test_bench(1, null_timespec);
+    BenchMark<TestBenchMark> bench(10, test_bench, false);
+
+    // By default the counters aren't used.
+    bench.run();
+    EXPECT_EQ(static_cast<const PerfCounters*>(NULL), bench.getCounters());
+    EXPECT_EQ(bench.TIME_FAILURE,
+              bench.getCountPerIteration(PerfCounters::INSTRUCTIONS));
+
+    // They may not be available on the test system, in which case they
+    // count nothing.  If they are, we can expect some instructions have been
+    // executed.
+    bench.setCounters(true);
+    bench.run();
+    const PerfCounters* counters = bench.getCounters();
+    ASSERT_NE(static_cast<const PerfCounters*>(NULL), counters);
+    if (counters->isAvailable(PerfCounters::INSTRUCTIONS)) {
+        EXPECT_LT(0, counters->getCount(PerfCounters::INSTRUCTIONS));
+        EXPECT_LT(0, bench.getCountPerIteration(PerfCounters::INSTRUCTIONS));
+    } else {
+        EXPECT_EQ(0, counters->getCount(PerfCounters::INSTRUCTIONS));
+    }
+}
 }
@@ -15,31 +15,29 @@
 
 #include <config.h>
 
-#include <nsas/nsas_entry_compare.h>
-#include <nsas/hash_table.h>
-#include <nsas/hash_deleter.h>
 #include "message_cache.h"
 #include "message_utility.h"
 #include "cache_entry_key.h"
 #include "logger.h"
+#include <util/time_utilities.h>
 
 namespace bundy {
 namespace cache {
 
-using namespace bundy::nsas;
 using namespace bundy::dns;
 using namespace std;
 using namespace MessageUtility;
 
 MessageCache::MessageCache(const RRsetCachePtr& rrset_cache,
                            uint32_t cache_size, uint16_t message_class,
-                           const RRsetCachePtr& negative_soa_cache):
+                           const RRsetCachePtr& negative_soa_cache,
+                           size_t max_bytes):
     message_class_(message_class),
     rrset_cache_(rrset_cache),
     negative_soa_cache_(negative_soa_cache),
-    message_table_(new NsasEntryCompare<MessageEntry>, cache_size),
-    message_lru_((3 * cache_size),
-                  new HashDeleter<MessageEntry>(message_table_))
+    messages_(3 * cache_size, max_bytes),
+    prefetch_hits_(0),
+    prefetch_window_(DEFAULT_PREFETCH_WINDOW)
 {
     LOG_DEBUG(logger, DBG_TRACE_BASIC, CACHE_MESSAGES_INIT).arg(cache_size).
         arg(RRClass(message_class));
@@ -47,31 +45,40 @@ MessageCache::MessageCache(const RRsetCachePtr& rrset_cache,
 
 MessageCache::~MessageCache() {
     // Destroy all the message entries in the cache.
-    message_lru_.clear();
+    messages_.clear();
     LOG_DEBUG(logger, DBG_TRACE_BASIC, CACHE_MESSAGES_DEINIT);
 }
 
+const unsigned int MessageCache::DEFAULT_PREFETCH_WINDOW;
+const uint32_t MessageCache::STALE_TTL;
+const uint32_t MessageCache::MAX_STALE_TIME;
+
 bool
 MessageCache::lookup(const bundy::dns::Name& qname,
                      const bundy::dns::RRType& qtype,
-                     bundy::dns::Message& response)
+                     bundy::dns::Message& response, bool* prefetch)
 {
+    if (prefetch != NULL) {
+        *prefetch = false;
+    }
     std::string entry_name = genCacheEntryName(qname, qtype);
-    HashKey entry_key = HashKey(entry_name, RRClass(message_class_));
-    MessageEntryPtr msg_entry = message_table_.get(entry_key);
+    MessageEntryPtr msg_entry = messages_.get(entry_name);
     if(msg_entry) {
         // Check whether the message entry has expired.
-       if (msg_entry->getExpireTime() > time(NULL)) {
+       const time_t now = bundy::util::CoarseClock::getTime();
+       if (msg_entry->getExpireTime() > now) {
             LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_MESSAGES_FOUND).
                 arg(entry_name);
-            message_lru_.touch(msg_entry);
-            return (msg_entry->genMessage(time(NULL), response));
+            if (!msg_entry->genMessage(now, response)) {
+                return (false);
+            }
+            checkPrefetch(*msg_entry, now, prefetch);
+            return (true);
         } else {
-            // message entry expires, remove it from hash table and lru list.
+            // message entry expires, remove it from the cache.
             LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_MESSAGES_EXPIRED).
                 arg(entry_name);
-            message_table_.remove(entry_key);
-            message_lru_.remove(msg_entry);
+            removeExpired(entry_name, msg_entry);
             return (false);
        }
     }
@@ -80,6 +87,100 @@ MessageCache::lookup(const bundy::dns::Name& qname,
     return (false);
 }
 
+bool
+MessageCache::lookupWire(const bundy::dns::Name& qname,
+                         const bundy::dns::RRType& qtype,
+                         bundy::util::OutputBuffer& buffer, bool* prefetch)
+{
+    if (prefetch != NULL) {
+        *prefetch = false;
+    }
+    std::string entry_name = genCacheEntryName(qname, qtype);
+    MessageEntryPtr msg_entry = messages_.get(entry_name);
+    if (msg_entry) {
+        const time_t now = bundy::util::CoarseClock::getTime();
+        if (msg_entry->getExpireTime() > now) {
+            LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_MESSAGES_FOUND).
+                arg(entry_name);
+            if (!msg_entry->genWire(now, buffer)) {
+                return (false);
+            }
+            checkPrefetch(*msg_entry, now, prefetch);
+            return (true);
+        } else {
+            LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_MESSAGES_EXPIRED).
+                arg(entry_name);
+            removeExpired(entry_name, msg_entry);
+            return (false);
+        }
+    }
+
+    LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_MESSAGES_UNKNOWN).arg(entry_name);
+    return (false);
+}
+
+bool
+MessageCache::lookupStale(const bundy::dns::Name& qname,
+                          const bundy::dns::RRType& qtype,
+                          bundy::dns::Message& response)
+{
+    const std::string entry_name = genCacheEntryName(qname, qtype);
+    MessageEntryPtr msg_entry = messages_.get(entry_name);
+    if (!msg_entry && stale_) {
+        msg_entry = stale_->get(entry_name);
+    }
+    const time_t now = bundy::util::CoarseClock::getTime();
+    if (!msg_entry || msg_entry->getExpireTime() + MAX_STALE_TIME <= now) {
+        return (false);
+    }
+    if (!msg_entry->genStaleMessage(now, STALE_TTL, response)) {
+        return (false);
+    }
+    LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_MESSAGES_STALE).arg(entry_name);
+    return (true);
+}
+
+void
+MessageCache::setStalePool(uint32_t pool_size) {
+    if (pool_size == 0) {
+        stale_.reset();
+    } else {
+        stale_.reset(new ShardedCache<MessageEntry>(3 * pool_size));
+    }
+}
+
+void
+MessageCache::removeExpired(const std::string& entry_name,
+                            const MessageEntryPtr& msg_entry)
+{
+    if (stale_) {
+        stale_->add(entry_name, msg_entry, msg_entry->getSize());
+    }
+    messages_.remove(entry_name);
+}
+
+void
+MessageCache::setPrefetch(uint32_t min_hits, unsigned int window) {
+    if (window > 100) {
+        bundy_throw(InvalidParameter,
+                    "prefetch window is larger than 100%: " << window);
+    }
+    prefetch_hits_ = min_hits;
+    prefetch_window_ = window;
+}
+
+void
+MessageCache::checkPrefetch(MessageEntry& msg_entry, time_t now,
+                            bool* prefetch)
+{
+    if (prefetch != NULL &&
+        msg_entry.countPrefetchHit(now, prefetch_hits_, prefetch_window_)) {
+        LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_MESSAGES_PREFETCH).
+            arg(msg_entry.getEntryName());
+        *prefetch = true;
+    }
+}
+
 bool
 MessageCache::update(const Message& msg) {
     if (!canMessageBeCached(msg)){
@@ -94,27 +195,14 @@ MessageCache::update(const Message& msg) {
     LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_MESSAGES_UPDATE).
         arg((*iter)->getName()).arg((*iter)->getType()).
         arg((*iter)->getClass());
-    std::string entry_name = genCacheEntryName((*iter)->getName(),
-                                               (*iter)->getType());
-    HashKey entry_key = HashKey(entry_name, RRClass(message_class_));
-
-    // The simplest way to update is removing the old message entry directly.
-    // We have find the existed message entry, since we need to delete it
-    // from lru list too.
-    // TODO, but there should be a better way, since we here have to remove and
-    // add the message entry, maybe there is one way to touch it once.
-    MessageEntryPtr old_msg_entry = message_table_.get(entry_key);
-    if (old_msg_entry) {
-        LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_MESSAGES_REMOVE).
-            arg((*iter)->getName()).arg((*iter)->getType()).
-            arg((*iter)->getClass());
-        message_lru_.remove(old_msg_entry);
-    }
-
     MessageEntryPtr msg_entry(new MessageEntry(msg, rrset_cache_,
                                                negative_soa_cache_));
-    message_lru_.add(msg_entry);
-    return (message_table_.add(msg_entry, entry_key, true));
+    // An old entry of the message is replaced, and so is the stale one.
+    if (stale_) {
+        stale_->remove(msg_entry->getEntryName());
+    }
+    return (messages_.add(msg_entry->getEntryName(), msg_entry,
+                          msg_entry->getSize()));
 }
 
 } // namespace cache
@@ -19,9 +19,10 @@
 #include <boost/shared_ptr.hpp>
 #include <dns/message.h>
 #include "message_entry.h"
-#include <nsas/hash_table.h>
-#include <util/lru_list.h>
 #include "rrset_cache.h"
+#include "sharded_cache.h"
+
+#include <boost/scoped_ptr.hpp>
 
 namespace bundy {
 namespace cache {
@@ -44,9 +45,12 @@ public:
     /// \param message_class The class of the message cache
     /// \param negative_soa_cache The cache that stores the SOA record
     ///        that comes from negative response message
+    /// \param max_bytes The maximum estimated memory used by the message
+    ///        entries, in bytes; 0 means no limit.
     MessageCache(const RRsetCachePtr& rrset_cache,
                  uint32_t cache_size, uint16_t message_class,
-                 const RRsetCachePtr& negative_soa_cache);
+                 const RRsetCachePtr& negative_soa_cache,
+                 size_t max_bytes = 0);
 
     /// \brief Destructor function
     virtual ~MessageCache();
@@ -56,33 +60,121 @@ public:
     /// \param qtype Type of the RR for which the message is being sought.
     /// \param message generated response message if the message entry
     ///        can be found.
+    /// \param prefetch If not NULL, it's set to true if the message was
+    ///        found and should be refreshed before it expires (see
+    ///        \c setPrefetch()), and to false otherwise.
     ///
     /// \return return true if the message can be found in cache, or else,
     /// return false.
     //TODO Maybe some user just want to get the message_entry.
     bool lookup(const bundy::dns::Name& qname,
                 const bundy::dns::RRType& qtype,
-                bundy::dns::Message& message);
+                bundy::dns::Message& message, bool* prefetch = NULL);
+
+    /// \brief Look up message in cache and render it in wire format.
+    ///
+    /// This is the same as \c lookup(), but appends the cached wire image
+    /// of the message to \c buffer (see \c MessageEntry::genWire()).
+    ///
+    /// \return true if the message was rendered; false if it can't be
+    /// found or the wire image can't be used, in which case \c lookup()
+    /// may still succeed.
+    bool lookupWire(const bundy::dns::Name& qname,
+                    const bundy::dns::RRType& qtype,
+                    bundy::util::OutputBuffer& buffer, bool* prefetch = NULL);
+
+    /// \brief Set the parameters of prefetching.
+    ///
+    /// A message found by \c lookup() \c min_hits times within the last
+    /// \c window percent of its TTL is reported to be prefetched, so the
+    /// caller can refresh it in the background before it expires.
+    /// Prefetching is disabled by default.
+    ///
+    /// \param min_hits The number of hits needed; 0 disables prefetching.
+    /// \param window The percentage of the TTL in which hits are counted.
+    ///
+    /// \throw InvalidParameter \c window is larger than 100.
+    void setPrefetch(uint32_t min_hits,
+                     unsigned int window = DEFAULT_PREFETCH_WINDOW);
+
+    /// \brief The default percentage of the TTL for prefetching.
+    static const unsigned int DEFAULT_PREFETCH_WINDOW = 10;
+
+    /// \brief Set the size of the pool of stale messages.
+    ///
+    /// When the pool is enabled, a message found expired by \c lookup()
+    /// is moved to it instead of being dropped, so \c lookupStale() can
+    /// still answer with it for up to \c MAX_STALE_TIME seconds after it
+    /// expired.  The pool holds up to three times \c pool_size entries;
+    /// the least recently used ones are evicted first.  It's disabled by
+    /// default.  The RRset caches need their own pools (see
+    /// \c RRsetCache::setStalePool()) to keep the RRsets of the message.
+    ///
+    /// This is not thread safe; it's expected to be called before the
+    /// cache is used.
+    ///
+    /// \param pool_size The size of the pool; 0 disables it and drops all
+    ///        the messages in it.
+    void setStalePool(uint32_t pool_size);
+
+    /// \brief Look up message in cache, expired or not.
+    ///
+    /// This is the same as \c lookup(), but the message may have expired
+    /// (see \c MessageEntry::genStaleMessage()).  The TTLs of the expired
+    /// RRsets are set to \c STALE_TTL.
+    ///
+    /// \return true if the message was found.
+    bool lookupStale(const bundy::dns::Name& qname,
+                     const bundy::dns::RRType& qtype,
+                     bundy::dns::Message& message);
+
+    /// \brief The TTL of expired RRsets in stale answers.
+    static const uint32_t STALE_TTL = 30;
+
+    /// \brief How long after expiring a message may be used as stale.
+    static const uint32_t MAX_STALE_TIME = 86400;
 
     /// \brief Update the message in the cache with the new one.
     /// If the message doesn't exist in the cache, it will be added
     /// directly.
     bool update(const bundy::dns::Message& msg);
-protected:
-    /// \brief Get the hash key for the message entry in the cache.
-    /// \param name query name of the message.
-    /// \param type query type of the message.
-    /// \return return the hash key.
-    bundy::nsas::HashKey getEntryHashKey(const bundy::dns::Name& name,
-                                       const bundy::dns::RRType& type) const;
+
+    /// \brief Return all entries in the cache, expired or not.
+    ///
+    /// See \c ShardedCache::getEntries().
+    void getEntries(std::vector<MessageEntryPtr>& entries) const {
+        messages_.getEntries(entries);
+    }
+
+    /// \brief Return the number of shards of the cache.
+    size_t getShardCount() const {
+        return (messages_.getShardCount());
+    }
+
+    /// \brief Return the statistics of a shard of the cache.
+    ///
+    /// \param shard The index of the shard, less than \c getShardCount().
+    CacheShardStats getShardStats(size_t shard) const {
+        return (messages_.getShardStats(shard));
+    }
+
+private:
+    // Tell the caller to prefetch the message if it's popular enough.
+    void checkPrefetch(MessageEntry& msg_entry, time_t now, bool* prefetch);
+
+    // Remove an expired message, keeping it in the stale pool if enabled.
+    void removeExpired(const std::string& entry_name,
+                       const MessageEntryPtr& msg_entry);
 
     // Make these variants be protected for easy unittest.
 protected:
     uint16_t message_class_; // The class of the message cache.
     RRsetCachePtr rrset_cache_;
     RRsetCachePtr negative_soa_cache_;
-    bundy::nsas::HashTable<MessageEntry> message_table_;
-    bundy::util::LruList<MessageEntry> message_lru_;
+    ShardedCache<MessageEntry> messages_;
+    uint32_t prefetch_hits_; // Hits needed for prefetching, 0 if disabled.
+    unsigned int prefetch_window_; // Percentage of TTL for prefetching.
+    boost::scoped_ptr<ShardedCache<MessageEntry> > stale_; // NULL if disabled
 };
 
 typedef boost::shared_ptr<MessageCache> MessageCachePtr;
@@ -16,14 +16,21 @@
 
 #include <limits>
 #include <dns/message.h>
+#include <dns/messagerenderer.h>
+#include <dns/opcode.h>
+#include <dns/question.h>
 #include <nsas/nsas_entry.h>
+#include <util/io_utilities.h>
+#include <util/time_utilities.h>
 #include "message_entry.h"
 #include "message_utility.h"
 #include "rrset_cache.h"
+#include "rrset_copy.h"
 #include "logger.h"
 
 using namespace bundy::dns;
 using namespace bundy::nsas;
+using namespace bundy::util;
 using namespace std;
 
 // Put file scope functions in unnamed namespace.
@@ -52,6 +59,19 @@ getDNAMEChainStarter(const Message& message, const Name& query_name) {
     return (dname);
 }
 
+// Skip a (possibly compressed) name in wire format, returning the position
+// after it.
+size_t
+skipName(const vector<uint8_t>& wire, size_t pos) {
+    while (wire.at(pos) != 0) {
+        if ((wire[pos] & 0xc0) == 0xc0) {
+            return (pos + 2);
+        }
+        pos += wire[pos] + 1;
+    }
+    return (pos + 1);
+}
+
 } // End of unnamed namespace
 
 namespace bundy {
@@ -81,11 +101,29 @@ MessageEntry::MessageEntry(const bundy::dns::Message& msg,
     rrset_cache_(rrset_cache),
     negative_soa_cache_(negative_soa_cache),
     headerflag_aa_(false),
-    headerflag_tc_(false)
+    headerflag_tc_(false),
+    wire_time_(0),
+    ttl_(0),
+    prefetch_hits_(0),
+    prefetch_requested_(false)
 {
     initMessageEntry(msg);
     entry_name_ = genCacheEntryName(query_name_, query_type_);
     hash_key_ptr_ = new HashKey(entry_name_, RRClass(query_class_));
+    renderWire(msg);
+}
+
+size_t
+MessageEntry::getSize() const {
+    size_t size = sizeof(*this) + sizeof(*hash_key_ptr_) +
+        entry_name_.size() + query_name_.size();
+    for (vector<RRsetRef>::const_iterator it = rrsets_.begin();
+         it != rrsets_.end(); ++it) {
+        size += sizeof(*it) + it->name_.getLength();
+    }
+    size += wire_.size() + wire_ttl_offsets_.size() * sizeof(uint16_t) +
+        wire_rrsets_.size() * sizeof(boost::weak_ptr<RRsetEntry>);
+    return (size);
 }
 
 bool
@@ -163,6 +201,151 @@ MessageEntry::genMessage(const time_t& time_now,
     }
 }
 
+bool
+MessageEntry::genStaleMessage(const time_t& time_now, uint32_t stale_ttl,
+                              bundy::dns::Message& msg)
+{
+    const uint16_t entry_count =
+        answer_count_ + authority_count_ + additional_count_;
+    vector<RRsetPtr> rrset_vec;
+    rrset_vec.reserve(entry_count);
+    for (int index = 0; index < entry_count; ++index) {
+        RRsetEntryPtr rrset_entry =
+            rrsets_[index].cache_->lookupStale(rrsets_[index].name_,
+                                               rrsets_[index].type_);
+        if (!rrset_entry) {
+            LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_ENTRY_MISSING_RRSET).
+                arg(entry_name_);
+            return (false);
+        }
+
+        // The cached RRset is shared with the fresh answers, so the reduced
+        // TTL goes to a copy (which gets copies of the RRSIGs, too).
+        const RRsetPtr cached = rrset_entry->getRRset();
+        uint32_t ttl = stale_ttl;
+        if (time_now < rrset_entry->getExpireTime()) {
+            ttl = std::min(ttl, cached->getTTL().getValue());
+        }
+        RRsetPtr rrset(new RRset(cached->getName(), cached->getClass(),
+                                 cached->getType(), RRTTL(ttl)));
+        rrsetCopy(*cached, *rrset);
+        rrset_vec.push_back(rrset);
+    }
+
+    msg.setHeaderFlag(Message::HEADERFLAG_AA, false);
+    msg.setHeaderFlag(Message::HEADERFLAG_TC, headerflag_tc_);
+
+    for (uint16_t index = 0; index < entry_count; ++index) {
+        const Message::Section section =
+            index < answer_count_ ? Message::SECTION_ANSWER :
+            (index < answer_count_ + authority_count_ ?
+             Message::SECTION_AUTHORITY : Message::SECTION_ADDITIONAL);
+        msg.addRRset(section, rrset_vec[index]);
+    }
+
+    return (true);
+}
+
+bool
+MessageEntry::genWire(const time_t& time_now, OutputBuffer& buffer) {
+    if (wire_.empty() || time_now >= expire_time_) {
+        return (false);
+    }
+    // The image can only be used if all the RRsets are the ones it was
+    // rendered from (and unexpired).
+    for (vector<boost::weak_ptr<RRsetEntry> >::const_iterator it =
+             wire_rrsets_.begin(); it != wire_rrsets_.end(); ++it) {
+        const RRsetEntryPtr rrset_entry = it->lock();
+        if (!rrset_entry || time_now >= rrset_entry->getExpireTime()) {
+            return (false);
+        }
+    }
+
+    const size_t start = buffer.getLength();
+    buffer.writeData(&wire_[0], wire_.size());
+    const uint32_t elapsed = time_now > wire_time_ ? time_now - wire_time_ : 0;
+    for (vector<uint16_t>::const_iterator it = wire_ttl_offsets_.begin();
+         it != wire_ttl_offsets_.end(); ++it) {
+        // As in RRsetEntry::updateTTL(), a TTL of 0 stays 0.
+        const uint32_t ttl = readUint32(&wire_[*it], 4);
+        const uint32_t new_ttl = ttl > elapsed ? ttl - elapsed : 0;
+        buffer.writeUint16At(new_ttl >> 16, start + *it);
+        buffer.writeUint16At(new_ttl & 0xffff, start + *it + 2);
+    }
+    return (true);
+}
+
+bool
+MessageEntry::countPrefetchHit(const time_t& time_now, uint32_t min_hits,
+                               unsigned int window)
+{
+    if (min_hits == 0 || prefetch_requested_ || time_now >= expire_time_ ||
+        time_now < expire_time_ -
+        static_cast<time_t>(static_cast<uint64_t>(ttl_) * window / 100)) {
+        return (false);
+    }
+    if (++prefetch_hits_ < min_hits) {
+        return (false);
+    }
+    prefetch_requested_ = true;
+    return (true);
+}
+
+void
+MessageEntry::renderWire(const Message& msg) {
+    vector<RRsetEntryPtr> rrset_entries;
+    for (vector<boost::weak_ptr<RRsetEntry> >::const_iterator it =
+             wire_rrsets_.begin(); it != wire_rrsets_.end(); ++it) {
+        const RRsetEntryPtr rrset_entry = it->lock();
+        if (!rrset_entry) {
+            return;
+        }
+        rrset_entries.push_back(rrset_entry);
+    }
+
+    // The TTLs of the RRsets are set relative to this time (or a bit later,
+    // so they can't become larger than with genMessage()).
+    wire_time_ = CoarseClock::getTime();
+    Message response(Message::RENDER);
+    response.setQid(0);
+    response.setOpcode(Opcode::QUERY());
+    response.setRcode(msg.getRcode());
+    response.setHeaderFlag(Message::HEADERFLAG_QR, true);
+    response.setHeaderFlag(Message::HEADERFLAG_RA, true);
+    response.setHeaderFlag(Message::HEADERFLAG_TC, headerflag_tc_);
+    response.addQuestion(Question(Name(query_name_), RRClass(query_class_),
+                                  RRType(query_type_)));
+    addRRset(response, rrset_entries, Message::SECTION_ANSWER);
+    addRRset(response, rrset_entries, Message::SECTION_AUTHORITY);
+    addRRset(response, rrset_entries, Message::SECTION_ADDITIONAL);
+
+    MessageRenderer renderer;
+    renderer.setLengthLimit(0xffff);
+    try {
+        response.toWire(renderer);
+        if (renderer.isTruncated()) {
+            return;             // no image; genMessage() will be used
+        }
+        const uint8_t* const data =
+            static_cast<const uint8_t*>(renderer.getData());
+        wire_.assign(data, data + renderer.getLength());
+
+        // Find the TTL fields.  The counts are in the header at offset 6.
+        const size_t rr_count = readUint16(&wire_[6], 2) +
+            readUint16(&wire_[8], 2) + readUint16(&wire_[10], 2);
+        size_t pos = skipName(wire_, 12) + 4;
+        for (size_t i = 0; i < rr_count; ++i) {
+            pos = skipName(wire_, pos) + 4; // type and class
+            wire_ttl_offsets_.push_back(pos);
+            pos += 4;
+            pos += readUint16(&wire_.at(pos), 2) + 2;
+        }
+    } catch (const std::exception&) {
+        wire_.clear();
+        wire_ttl_offsets_.clear();
+    }
+}
+
 RRsetTrustLevel
 MessageEntry::getRRsetTrustLevel(const Message& message,
     const bundy::dns::RRsetPtr& rrset,
@@ -259,6 +442,7 @@ MessageEntry::parseSection(const bundy::dns::Message& msg,
         RRsetEntryPtr rrset_entry = rrset_cache_->update(*rrset_ptr, level);
         rrsets_.push_back(RRsetRef(rrset_ptr->getName(), rrset_ptr->getType(),
                           rrset_cache_.get()));
+        wire_rrsets_.push_back(rrset_entry);
 
         uint32_t rrset_ttl = rrset_entry->getTTL();
         if (smaller_ttl > rrset_ttl) {
@@ -292,6 +476,7 @@ MessageEntry::parseNegativeResponseAuthoritySection(const bundy::dns::Message& m
         rrsets_.push_back(RRsetRef(rrset_ptr->getName(),
                                    rrset_ptr->getType(),
                                    rrset_cache_ptr.get()));
+        wire_rrsets_.push_back(rrset_entry);
         uint32_t rrset_ttl = rrset_entry->getTTL();
         if (min_ttl > rrset_ttl) {
             min_ttl = rrset_ttl;
@@ -339,7 +524,8 @@ MessageEntry::initMessageEntry(const bundy::dns::Message& msg) {
         }
     }
 
-    expire_time_ = time(NULL) + min_ttl;
+    ttl_ = min_ttl;
+    expire_time_ = CoarseClock::getTime() + min_ttl;
 }
 
 } // namespace cache
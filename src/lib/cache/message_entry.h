@@ -16,9 +16,11 @@
 #define MESSAGE_ENTRY_H
 
 #include <vector>
+#include <boost/weak_ptr.hpp>
 #include <dns/message.h>
 #include <dns/rrset.h>
 #include <nsas/nsas_entry.h>
+#include <util/buffer.h>
 #include "rrset_cache.h"
 #include "rrset_entry.h"
 
@@ -87,6 +89,55 @@ public:
     ///         from the cached information, or else, return false.
     bool genMessage(const time_t& time_now, bundy::dns::Message& response);
 
+    /// \brief Generate the message from possibly expired data.
+    ///
+    /// This is the same as \c genMessage(), but the message entry and the
+    /// RRsets may have expired; the RRsets are looked up with
+    /// \c RRsetCache::lookupStale().  The RRsets in the response are
+    /// copies whose TTL is no larger than \c stale_ttl.
+    ///
+    /// \param time_now The current time.
+    /// \param stale_ttl The TTL of the expired RRsets.
+    /// \param response generated dns message.
+    /// \return true if the response message can be generated, false if
+    ///         any of the RRsets is gone.
+    bool genStaleMessage(const time_t& time_now, uint32_t stale_ttl,
+                         bundy::dns::Message& response);
+
+    /// \brief Generate the response message in wire format.
+    ///
+    /// The entry keeps the response rendered when it was created, with the
+    /// positions of the TTL fields.  As long as the RRsets it was rendered
+    /// from are still in the RRset caches (that is, they haven't expired or
+    /// been replaced), this copies that image to the buffer and decreases
+    /// the TTLs by the time passed since then.
+    ///
+    /// The ID of the message is 0, and of the flags, only QR, RA and TC
+    /// (as cached) are set; the caller is expected to set the ID and
+    /// the RD and CD bits of the query.  There's no EDNS, and it's not
+    /// truncated to any size.
+    ///
+    /// \param time_now The current time.
+    /// \param buffer The buffer to append the message to.
+    /// \return true if the message was generated, false if the image can't
+    ///         be used (the caller should then fall back to
+    ///         \c genMessage()).
+    bool genWire(const time_t& time_now, bundy::util::OutputBuffer& buffer);
+
+    /// \brief Count a hit for prefetching the message.
+    ///
+    /// Hits are counted while the entry is within the last \c window
+    /// percent of its TTL.  This returns true (once per entry) when
+    /// \c min_hits is reached, to tell the caller that the message is
+    /// popular and should be refreshed before it expires.
+    ///
+    /// \param time_now The current time.
+    /// \param min_hits The number of hits needed; 0 disables prefetching.
+    /// \param window The percentage of the TTL in which hits are counted.
+    /// \return true if the message should be prefetched.
+    bool countPrefetchHit(const time_t& time_now, uint32_t min_hits,
+                          unsigned int window);
+
     /// \brief Get the hash key of the message entry.
     ///
     /// \return return hash key
@@ -100,6 +151,20 @@ public:
         return (expire_time_);
     }
 
+    /// \brief Get the name of the entry in the cache.
+    ///
+    /// \return The name generated by \c genCacheEntryName().
+    const std::string& getEntryName() const {
+        return (entry_name_);
+    }
+
+    /// \brief Get the estimated memory used by the entry.
+    ///
+    /// The RRsets themselves are in the RRset cache and not counted.
+    ///
+    /// \return The size in bytes.
+    size_t getSize() const;
+
     /// \short Protected memebers, so they can be accessed by tests.
     //@{
 protected:
@@ -166,6 +231,11 @@ protected:
     bool getRRsetEntries(std::vector<RRsetEntryPtr>& rrset_entry_vec,
                          const time_t time_now);
 
+    /// \brief Render the wire format image of the response.
+    ///
+    /// \param message The message the entry is created from.
+    void renderWire(const bundy::dns::Message& message);
+
     time_t expire_time_;  // Expiration time of the message.
     //@}
 
@@ -190,6 +260,18 @@ private:
     //TODO, there should be a better way to cache these header flags
     bool headerflag_aa_; // Whether AA bit is set.
     bool headerflag_tc_; // Whether TC bit is set.
+
+    // The rendered response, the positions of its TTL fields, the time it
+    // was rendered and the RRset entries it was rendered from.  The image
+    // is empty if it couldn't be rendered.
+    std::vector<uint8_t> wire_;
+    std::vector<uint16_t> wire_ttl_offsets_;
+    time_t wire_time_;
+    std::vector<boost::weak_ptr<RRsetEntry> > wire_rrsets_;
+
+    uint32_t ttl_; // TTL of the message, when it was cached.
+    uint32_t prefetch_hits_; // Hits within the prefetch window.
+    bool prefetch_requested_; // Whether prefetching was requested.
 };
 
 typedef boost::shared_ptr<MessageEntry> MessageEntryPtr;
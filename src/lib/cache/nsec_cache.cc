@@ -0,0 +1,342 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include "nsec_cache.h"
+#include "logger.h"
+
+#include <dns/rcode.h>
+#include <dns/rdataclass.h>
+#include <dns/rrttl.h>
+#include <util/buffer.h>
+#include <util/time_utilities.h>
+
+#include <algorithm>
+
+using namespace bundy::dns;
+using namespace std;
+
+namespace bundy {
+namespace cache {
+
+namespace {
+
+// Copy the RRset (the data and the signatures) with the given TTL.
+RRsetPtr
+copyRRset(const AbstractRRset& rrset, uint32_t ttl) {
+    RRsetPtr copy(new RRset(rrset.getName(), rrset.getClass(),
+                            rrset.getType(), RRTTL(ttl)));
+    for (RdataIteratorPtr it(rrset.getRdataIterator()); !it->isLast();
+         it->next()) {
+        copy->addRdata(it->getCurrent());
+    }
+    const RRsetPtr sigs(rrset.getRRsig());
+    if (sigs) {
+        for (RdataIteratorPtr it(sigs->getRdataIterator()); !it->isLast();
+             it->next()) {
+            copy->addRRsig(rdata::createRdata(RRType::RRSIG(),
+                                              rrset.getClass(),
+                                              it->getCurrent()));
+        }
+    }
+    return (copy);
+}
+
+// Check if the NSEC type bitmaps (in wire format) contain the type.
+bool
+hasType(const vector<uint8_t>& typebits, const RRType& type) {
+    const uint8_t window = type.getCode() >> 8;
+    const uint8_t code = type.getCode() & 0xff;
+    size_t pos = 0;
+    while (pos + 2 <= typebits.size()) {
+        const uint8_t block = typebits[pos];
+        const uint8_t len = typebits[pos + 1];
+        if (block == window) {
+            return ((code >> 3) < len && pos + 2 + (code >> 3) <
+                    typebits.size() &&
+                    (typebits[pos + 2 + (code >> 3)] & (0x80 >> (code & 7)))
+                    != 0);
+        }
+        pos += 2 + len;
+    }
+    return (false);
+}
+
+// Check if the name is the zone or below it.
+bool
+isInZone(const Name& name, const Name& zone) {
+    const NameComparisonResult::NameRelation relation =
+        name.compare(zone).getRelation();
+    return (relation == NameComparisonResult::EQUAL ||
+            relation == NameComparisonResult::SUBDOMAIN);
+}
+
+}
+
+NsecCache::NsecCache(size_t max_ranges) :
+    max_ranges_(max_ranges), range_count_(0)
+{}
+
+bool
+NsecCache::update(const Message& msg) {
+    if (!msg.getHeaderFlag(Message::HEADERFLAG_AD) ||
+        !(msg.getRcode() == Rcode::NXDOMAIN() ||
+          (msg.getRcode() == Rcode::NOERROR() &&
+           msg.getRRCount(Message::SECTION_ANSWER) == 0))) {
+        return (false);
+    }
+
+    // The SOA tells the zone and how long the negative answers may be
+    // cached.
+    ConstRRsetPtr soa;
+    for (RRsetIterator it = msg.beginSection(Message::SECTION_AUTHORITY);
+         it != msg.endSection(Message::SECTION_AUTHORITY); ++it) {
+        if ((*it)->getType() == RRType::SOA() &&
+            (*it)->getRdataCount() == 1) {
+            soa = *it;
+            break;
+        }
+    }
+    if (!soa) {
+        return (false);
+    }
+    const Name& zone_name(soa->getName());
+    const uint32_t negative_ttl =
+        min(soa->getTTL().getValue(),
+            dynamic_cast<const rdata::generic::SOA&>(
+                soa->getRdataIterator()->getCurrent()).getMinimum());
+    if (negative_ttl == 0) {
+        return (false);
+    }
+
+    const time_t now = bundy::util::CoarseClock::getTime();
+    bool updated = false;
+    util::thread::Mutex::Locker locker(mutex_);
+    for (RRsetIterator it = msg.beginSection(Message::SECTION_AUTHORITY);
+         it != msg.endSection(Message::SECTION_AUTHORITY); ++it) {
+        const AbstractRRset& nsec(**it);
+        if (nsec.getType() != RRType::NSEC() || !nsec.getRRsig() ||
+            nsec.getRdataCount() != 1 ||
+            !isInZone(nsec.getName(), zone_name)) {
+            continue;
+        }
+        const rdata::Rdata& rdata(nsec.getRdataIterator()->getCurrent());
+        const Name& next(dynamic_cast<const rdata::generic::NSEC&>(rdata).
+                         getNextName());
+        if (!isInZone(next, zone_name)) {
+            continue;
+        }
+        const uint32_t ttl = min(nsec.getTTL().getValue(), negative_ttl);
+        if (ttl == 0) {
+            continue;
+        }
+
+        // The type bitmaps follow the (uncompressed) next name.
+        util::OutputBuffer buffer(0);
+        rdata.toWire(buffer);
+        const uint8_t* data = static_cast<const uint8_t*>(buffer.getData());
+        const vector<uint8_t> typebits(data + next.getLength(),
+                                       data + buffer.getLength());
+
+        ZoneMap::iterator zone(zones_.find(zone_name));
+        if (range_count_ >= max_ranges_ &&
+            (zone == zones_.end() ||
+             zone->second.ranges.count(nsec.getName()) == 0)) {
+            removeExpired(now);
+            if (range_count_ >= max_ranges_) {
+                // Full of unexpired records, keep the ones we have.
+                LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_NSEC_FULL).
+                    arg(nsec.getName());
+                continue;
+            }
+            zone = zones_.find(zone_name);
+        }
+        if (zone == zones_.end()) {
+            zone = zones_.insert(ZoneMap::value_type(
+                       zone_name, Zone(copyRRset(*soa, negative_ttl),
+                                       now + negative_ttl))).first;
+        } else if (!updated) {
+            // Refresh the SOA (once per message)
+            zone->second.soa = copyRRset(*soa, negative_ttl);
+            zone->second.expire = now + negative_ttl;
+        }
+        const Range new_range(copyRRset(nsec, ttl), next, typebits,
+                              now + ttl);
+        const RangeMap::iterator range(
+            zone->second.ranges.find(nsec.getName()));
+        if (range == zone->second.ranges.end()) {
+            zone->second.ranges.insert(RangeMap::value_type(nsec.getName(),
+                                                            new_range));
+            ++range_count_;
+        } else {
+            range->second = new_range;
+        }
+        LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_NSEC_UPDATE).
+            arg(nsec.getName()).arg(next);
+        updated = true;
+    }
+    return (updated);
+}
+
+bool
+NsecCache::lookup(const Name& qname, const RRType& qtype,
+                  Message& response) const
+{
+    const time_t now = bundy::util::CoarseClock::getTime();
+    util::thread::Mutex::Locker locker(mutex_);
+
+    // Find the deepest zone we have records for.
+    ZoneMap::const_iterator zone(zones_.end());
+    for (unsigned int level = 0; level < qname.getLabelCount(); ++level) {
+        zone = zones_.find(qname.split(level));
+        if (zone != zones_.end()) {
+            break;
+        }
+    }
+    if (zone == zones_.end() || zone->second.expire <= now) {
+        return (false);
+    }
+    const Name& zone_name(zone->first);
+
+    vector<const Range*> proof;
+    const Range* match = findRange(zone->second, zone_name, qname, true, now);
+    if (match != NULL) {
+        // The name exists, see if the type doesn't.  A record of a
+        // delegation comes from the parent side and can only prove there's
+        // no DS, while DS isn't in the zone at its apex.
+        const bool apex = hasType(match->typebits, RRType::SOA());
+        const bool delegation = !apex &&
+            hasType(match->typebits, RRType::NS());
+        if (qtype == RRType::ANY() || hasType(match->typebits, qtype) ||
+            hasType(match->typebits, RRType::CNAME()) ||
+            (qtype == RRType::DS() ? apex : delegation)) {
+            return (false);
+        }
+        proof.push_back(match);
+        response.setRcode(Rcode::NOERROR());
+    } else {
+        // The name doesn't exist if it's covered by a record and there's
+        // no wildcard to match it at the closest encloser (the longest
+        // common ancestor of the name and the ends of the range).
+        const Range* cover = findRange(zone->second, zone_name, qname, false,
+                                       now);
+        if (cover == NULL) {
+            return (false);
+        }
+        const unsigned int encloser_labels =
+            max(qname.compare(cover->nsec->getName()).getCommonLabels(),
+                qname.compare(cover->next).getCommonLabels());
+        if (encloser_labels >= qname.getLabelCount()) {
+            // The name is an empty non-terminal.
+            return (false);
+        }
+        const Name wildcard(Name("*").concatenate(
+            qname.split(qname.getLabelCount() - encloser_labels)));
+        const Range* wildcard_cover = findRange(zone->second, zone_name,
+                                                wildcard, false, now);
+        if (wildcard_cover == NULL) {
+            return (false);
+        }
+        proof.push_back(cover);
+        if (wildcard_cover != cover) {
+            proof.push_back(wildcard_cover);
+        }
+        response.setRcode(Rcode::NXDOMAIN());
+    }
+
+    LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_NSEC_SYNTHESIZED).
+        arg(qname).arg(qtype).arg(response.getRcode());
+    response.setHeaderFlag(Message::HEADERFLAG_AA, false);
+    response.addRRset(Message::SECTION_AUTHORITY,
+                      copyRRset(*zone->second.soa,
+                                zone->second.expire - now));
+    for (vector<const Range*>::const_iterator it = proof.begin();
+         it != proof.end(); ++it) {
+        response.addRRset(Message::SECTION_AUTHORITY,
+                          copyRRset(*(*it)->nsec, (*it)->expire - now));
+    }
+    return (true);
+}
+
+size_t
+NsecCache::size() const {
+    util::thread::Mutex::Locker locker(mutex_);
+    return (range_count_);
+}
+
+const NsecCache::Range*
+NsecCache::findRange(const Zone& zone, const Name& zone_name,
+                     const Name& name, bool match, time_t now) const
+{
+    RangeMap::const_iterator it;
+    if (match) {
+        it = zone.ranges.find(name);
+        if (it == zone.ranges.end()) {
+            return (NULL);
+        }
+    } else {
+        // The candidate is the record of the closest preceding name.
+        it = zone.ranges.upper_bound(name);
+        if (it == zone.ranges.begin()) {
+            return (NULL);
+        }
+        --it;
+        if (it->first == name) {
+            return (NULL);
+        }
+        // It covers the name if the name is before its next name, or if
+        // it's the last record of the zone (the next name is the apex).
+        if (name.compare(it->second.next).getOrder() >= 0 &&
+            it->second.next != zone_name) {
+            return (NULL);
+        }
+        // Names below a delegation or a DNAME aren't in this zone.
+        if (name.compare(it->first).getRelation() ==
+            NameComparisonResult::SUBDOMAIN &&
+            ((hasType(it->second.typebits, RRType::NS()) &&
+              !hasType(it->second.typebits, RRType::SOA())) ||
+             hasType(it->second.typebits, RRType::DNAME()))) {
+            return (NULL);
+        }
+    }
+    if (it->second.expire <= now) {
+        return (NULL);
+    }
+    return (&it->second);
+}
+
+void
+NsecCache::removeExpired(time_t now) {
+    for (ZoneMap::iterator zone = zones_.begin(); zone != zones_.end();) {
+        RangeMap& ranges(zone->second.ranges);
+        for (RangeMap::iterator range = ranges.begin();
+             range != ranges.end();) {
+            if (range->second.expire <= now) {
+                ranges.erase(range++);
+                --range_count_;
+            } else {
+                ++range;
+            }
+        }
+        if (ranges.empty()) {
+            zones_.erase(zone++);
+        } else {
+            ++zone;
+        }
+    }
+}
+
+} // namespace cache
+} // namespace bundy
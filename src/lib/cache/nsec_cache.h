@@ -0,0 +1,145 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef NSEC_CACHE_H
+#define NSEC_CACHE_H
+
+#include <util/threads/sync.h>
+
+#include <dns/message.h>
+#include <dns/name.h>
+#include <dns/rrset.h>
+#include <dns/rrtype.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <map>
+#include <vector>
+
+#include <stdint.h>
+#include <time.h>
+
+namespace bundy {
+namespace cache {
+
+//TODO a better proper default cache size
+#define NSEC_CACHE_DEFAULT_SIZE 10000
+
+/// \brief Cache of NSEC ranges.
+///
+/// This keeps the NSEC records of negative responses from signed zones, so
+/// negative answers can be synthesized for any name they prove not to
+/// exist, not only for the name that was asked (the "aggressive use" of
+/// RFC 8198).  That way a flood of queries for random names in a zone
+/// doesn't have to be sent to its servers.
+///
+/// The NSEC records are stored by zone, each zone keeping them ordered by
+/// their owner names in the DNSSEC canonical order, so the record covering
+/// a name is the one preceding it.
+///
+/// The records are used as they are, this doesn't validate them.  Only
+/// responses marked as validated (by the AD bit) are accepted, it's up to
+/// the user to make sure the bit can be trusted (or not to feed the cache
+/// at all otherwise).  NSEC3 isn't supported.
+class NsecCache : boost::noncopyable {
+public:
+    /// \brief Constructor.
+    ///
+    /// \param max_ranges The maximum number of NSEC records kept.
+    NsecCache(size_t max_ranges = NSEC_CACHE_DEFAULT_SIZE);
+
+    /// \brief Store the NSEC records proving a negative response.
+    ///
+    /// The message must be a validated (having the AD bit set) NXDOMAIN
+    /// or NODATA response with the SOA of the zone in the authority
+    /// section.  The signed NSEC records in the authority section are
+    /// stored, the rest of the message is ignored.
+    ///
+    /// \param msg The response.
+    /// \return true if any NSEC record was stored.
+    bool update(const bundy::dns::Message& msg);
+
+    /// \brief Synthesize a negative response.
+    ///
+    /// If the stored NSEC records prove that the name doesn't exist (the
+    /// name and the wildcard at its closest encloser are covered by some
+    /// records) or that it has no data of the type (the record of the
+    /// name doesn't have the type nor CNAME), the rcode of the response
+    /// is set to NXDOMAIN or NOERROR and the SOA and the NSEC records of
+    /// the proof are added to the authority section, with TTLs decreased
+    /// by the time they have been cached.
+    ///
+    /// \param qname The query name.
+    /// \param qtype The query type.
+    /// \param response The response to fill (must be in RENDER mode).
+    /// \return true if the response was synthesized, false if the
+    ///     stored records don't prove anything about the name.
+    bool lookup(const bundy::dns::Name& qname,
+                const bundy::dns::RRType& qtype,
+                bundy::dns::Message& response) const;
+
+    /// \brief Return the number of NSEC records stored.
+    size_t size() const;
+
+private:
+    // One stored NSEC record
+    struct Range {
+        Range(const bundy::dns::ConstRRsetPtr& nsec_rrset,
+              const bundy::dns::Name& next_name,
+              const std::vector<uint8_t>& type_bits, time_t expire_time) :
+            nsec(nsec_rrset), next(next_name), typebits(type_bits),
+            expire(expire_time)
+        {}
+
+        bundy::dns::ConstRRsetPtr nsec;  // The record (with its RRSIG)
+        bundy::dns::Name next;           // Its next name
+        std::vector<uint8_t> typebits;   // Its type bitmaps
+        time_t expire;                   // When it's not to be used anymore
+    };
+    typedef std::map<bundy::dns::Name, Range> RangeMap;
+
+    // The records of a zone
+    struct Zone {
+        Zone(const bundy::dns::ConstRRsetPtr& soa_rrset, time_t expire_time) :
+            soa(soa_rrset), expire(expire_time)
+        {}
+
+        bundy::dns::ConstRRsetPtr soa;  // The last SOA received
+        time_t expire;                  // When the SOA expires
+        RangeMap ranges;                // The records by owner name
+    };
+    typedef std::map<bundy::dns::Name, Zone> ZoneMap;
+
+    // Find the unexpired record covering (or matching, if match is true)
+    // the name in the zone.  Returns NULL if there's none.
+    const Range* findRange(const Zone& zone, const bundy::dns::Name& zone_name,
+                           const bundy::dns::Name& name, bool match,
+                           time_t now) const;
+
+    // Remove the expired records (and the zones left empty).
+    void removeExpired(time_t now);
+
+    const size_t max_ranges_;
+    size_t range_count_;
+    ZoneMap zones_;
+    mutable bundy::util::thread::Mutex mutex_;
+};
+
+typedef boost::shared_ptr<NsecCache> NsecCachePtr;
+
+} // namespace cache
+} // namespace bundy
+
+#endif // NSEC_CACHE_H
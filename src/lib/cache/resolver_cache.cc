@@ -18,17 +18,207 @@
 #include "dns/message.h"
 #include "rrset_cache.h"
 #include "logger.h"
+#include <dns/messagerenderer.h>
+#include <dns/rdata.h>
+#include <dns/rrset.h>
+#include <util/time_utilities.h>
 #include <string>
 #include <algorithm>
+#include <fstream>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
 
 using namespace bundy::dns;
+using bundy::util::InputBuffer;
+using bundy::util::OutputBuffer;
 using namespace std;
 
 namespace bundy {
 namespace cache {
 
+namespace {
+// The snapshot file begins with a header of the magic number, the format
+// version, 2 reserved bytes and the time it was saved (64 bits), followed
+// by records of a type (8 bits), a class (16 bits), the length of the data
+// (32 bits) and the data.  All numbers are in network byte order.
+const uint32_t SNAPSHOT_MAGIC = 0x42445343; // "BDSC"
+const uint16_t SNAPSHOT_VERSION = 1;
+const size_t SNAPSHOT_HEADER_LEN = 16;
+const size_t SNAPSHOT_RECORD_HEADER_LEN = 7;
+
+// Record types.  An RRset record holds the trust level (8 bits) and the
+// RRs of the RRset and its RRSIGs in wire format, a message record the
+// message in wire format, and an RTT record the RTT (32 bits) and the
+// address in text.  Records of other types are skipped.
+enum SnapshotRecordType {
+    SNAPSHOT_RRSET = 1,
+    SNAPSHOT_MESSAGE = 2,
+    SNAPSHOT_RTT = 3
+};
+
+void
+writeUint64(OutputBuffer& buffer, uint64_t data) {
+    buffer.writeUint32(static_cast<uint32_t>(data >> 32));
+    buffer.writeUint32(static_cast<uint32_t>(data));
+}
+
+uint64_t
+readUint64(InputBuffer& buffer) {
+    const uint64_t high = buffer.readUint32();
+    return ((high << 32) | buffer.readUint32());
+}
+
+// Begin a record; the returned position is to be passed to endRecord()
+// once the data has been written.
+size_t
+beginRecord(OutputBuffer& buffer, SnapshotRecordType type, uint16_t rrclass) {
+    const size_t pos = buffer.getLength();
+    buffer.writeUint8(type);
+    buffer.writeUint16(rrclass);
+    buffer.skip(4);
+    return (pos);
+}
+
+void
+endRecord(OutputBuffer& buffer, size_t pos) {
+    const uint32_t len = buffer.getLength() - pos - SNAPSHOT_RECORD_HEADER_LEN;
+    buffer.writeUint16At(len >> 16, pos + 3);
+    buffer.writeUint16At(len & 0xffff, pos + 5);
+}
+
+// A snapshot file mapped into memory, unmapped on destruction.
+class MappedFile : boost::noncopyable {
+public:
+    MappedFile(const string& filename) : data_(NULL), len_(0) {
+        const int fd = open(filename.c_str(), O_RDONLY);
+        if (fd == -1) {
+            bundy_throw(CacheSnapshotError, "failed to open " << filename <<
+                        ": " << strerror(errno));
+        }
+        struct stat st;
+        if (fstat(fd, &st) == -1) {
+            const int error = errno;
+            close(fd);
+            bundy_throw(CacheSnapshotError, "failed to stat " << filename <<
+                        ": " << strerror(error));
+        }
+        len_ = st.st_size;
+        if (len_ > 0) {
+            void* const data = mmap(NULL, len_, PROT_READ, MAP_PRIVATE, fd,
+                                    0);
+            if (data == MAP_FAILED) {
+                const int error = errno;
+                close(fd);
+                bundy_throw(CacheSnapshotError, "failed to map " <<
+                            filename << ": " << strerror(error));
+            }
+            data_ = static_cast<const uint8_t*>(data);
+        }
+        close(fd);
+    }
+    ~MappedFile() {
+        if (data_ != NULL) {
+            munmap(const_cast<uint8_t*>(data_), len_);
+        }
+    }
+    const uint8_t* getData() const { return (data_); }
+    size_t getLength() const { return (len_); }
+private:
+    const uint8_t* data_;
+    size_t len_;
+};
+
+// Decrease the TTL of an RRset (and its RRSIGs) by the elapsed time, and
+// return false if it has expired.
+bool
+adjustTTL(AbstractRRset& rrset, uint64_t elapsed) {
+    const uint32_t ttl = rrset.getTTL().getValue();
+    if (ttl <= elapsed) {
+        return (false);
+    }
+    rrset.setTTL(RRTTL(ttl - elapsed));
+    return (true);
+}
+
+// Restore an RRset record.  Returns true if the RRset was added.
+bool
+restoreRRset(ResolverClassCache& cache, InputBuffer& buffer, uint64_t elapsed)
+{
+    const uint8_t level = buffer.readUint8();
+    if (level > RRSET_TRUST_PRIM_ZONE_NONGLUE) {
+        bundy_throw(CacheSnapshotError, "invalid trust level in snapshot: " <<
+                    static_cast<unsigned int>(level));
+    }
+    RRsetPtr rrset;
+    RRsetPtr rrsig;
+    while (buffer.getPosition() < buffer.getLength()) {
+        const Name name(buffer);
+        const RRType type(buffer.readUint16());
+        const RRClass rrclass(buffer.readUint16());
+        const RRTTL ttl(buffer.readUint32());
+        const size_t rdlen = buffer.readUint16();
+        RRsetPtr& target = (type == RRType::RRSIG() ? rrsig : rrset);
+        if (!target) {
+            target.reset(new RRset(name, rrclass, type, ttl));
+        }
+        target->addRdata(rdata::createRdata(type, rrclass, buffer, rdlen));
+    }
+    if (!rrset) {
+        bundy_throw(CacheSnapshotError, "RRset record without RRs");
+    }
+    if (!adjustTTL(*rrset, elapsed)) {
+        return (false);
+    }
+    if (rrsig) {
+        rrsig->setTTL(rrset->getTTL());
+        rrset->addRRsig(rrsig);
+    }
+    cache.restore(*rrset, static_cast<RRsetTrustLevel>(level));
+    return (true);
+}
+
+// Restore a message record.  Returns true if the message was added.
+bool
+restoreMessage(ResolverClassCache& cache, InputBuffer& buffer,
+               uint64_t elapsed)
+{
+    Message msg(Message::PARSE);
+    msg.fromWire(buffer);
+    if (msg.beginQuestion() == msg.endQuestion()) {
+        bundy_throw(CacheSnapshotError, "message record without question");
+    }
+    const Message::Section sections[] = {
+        Message::SECTION_ANSWER, Message::SECTION_AUTHORITY,
+        Message::SECTION_ADDITIONAL
+    };
+    for (size_t i = 0; i < sizeof(sections) / sizeof(sections[0]); ++i) {
+        for (RRsetIterator it = msg.beginSection(sections[i]);
+             it != msg.endSection(sections[i]);
+             ++it) {
+            if (!adjustTTL(**it, elapsed)) {
+                return (false);
+            }
+            if ((*it)->getRRsig()) {
+                (*it)->getRRsig()->setTTL((*it)->getTTL());
+            }
+        }
+    }
+    return (cache.update(msg));
+}
+}
+
 ResolverClassCache::ResolverClassCache(const RRClass& cache_class) :
-    cache_class_(cache_class)
+    cache_class_(cache_class), aggressive_nsec_(false),
+    serve_stale_(false)
 {
     LOG_DEBUG(logger, DBG_TRACE_BASIC, CACHE_RESOLVER_INIT).arg(cache_class);
     local_zone_data_ = LocalZoneDataPtr(new LocalZoneData(cache_class_.getCode()));
@@ -42,10 +232,12 @@ ResolverClassCache::ResolverClassCache(const RRClass& cache_class) :
                                       MESSAGE_CACHE_DEFAULT_SIZE,
                                       cache_class_.getCode(),
                                       negative_soa_cache_));
+    nsec_cache_ = NsecCachePtr(new NsecCache());
 }
 
 ResolverClassCache::ResolverClassCache(const CacheSizeInfo& cache_info) :
-    cache_class_(cache_info.cclass)
+    cache_class_(cache_info.cclass), aggressive_nsec_(false),
+    serve_stale_(false)
 {
     LOG_DEBUG(logger, DBG_TRACE_BASIC, CACHE_RESOLVER_INIT_INFO).
         arg(cache_class_);
@@ -53,14 +245,18 @@ ResolverClassCache::ResolverClassCache(const CacheSizeInfo& cache_info) :
     // TODO We should find one way to load local zone data.
     local_zone_data_ = LocalZoneDataPtr(new LocalZoneData(klass));
     rrsets_cache_ = RRsetCachePtr(new
-                        RRsetCache(cache_info.rrset_cache_size, klass));
+                        RRsetCache(cache_info.rrset_cache_size, klass,
+                                   cache_info.rrset_cache_bytes));
     // SOA rrset cache from negative response
     negative_soa_cache_ = RRsetCachePtr(new RRsetCache(cache_info.rrset_cache_size,
-                                                       klass));
+                                                       klass,
+                                                       cache_info.rrset_cache_bytes));
 
     messages_cache_ = MessageCachePtr(new MessageCache(rrsets_cache_,
                                       cache_info.message_cache_size,
-                                      klass, negative_soa_cache_));
+                                      klass, negative_soa_cache_,
+                                      cache_info.message_cache_bytes));
+    nsec_cache_ = NsecCachePtr(new NsecCache());
 }
 
 const RRClass&
@@ -68,10 +264,60 @@ ResolverClassCache::getClass() const {
     return (cache_class_);
 }
 
+size_t
+ResolverClassCache::dump(OutputBuffer& buffer, time_t now) const {
+    const uint16_t rrclass = cache_class_.getCode();
+    size_t count = 0;
+
+    std::vector<RRsetEntryPtr> rrsets;
+    rrsets_cache_->getEntries(rrsets);
+    for (std::vector<RRsetEntryPtr>::const_iterator it = rrsets.begin();
+         it != rrsets.end();
+         ++it) {
+        if ((*it)->getExpireTime() <= now) {
+            continue;
+        }
+        const RRsetPtr rrset = (*it)->getRRset();
+        if (rrset->getRdataCount() == 0) {
+            continue;
+        }
+        const size_t pos = beginRecord(buffer, SNAPSHOT_RRSET, rrclass);
+        buffer.writeUint8((*it)->getTrustLevel());
+        rrset->toWire(buffer);
+        endRecord(buffer, pos);
+        ++count;
+    }
+
+    std::vector<MessageEntryPtr> messages;
+    messages_cache_->getEntries(messages);
+    for (std::vector<MessageEntryPtr>::const_iterator it = messages.begin();
+         it != messages.end();
+         ++it) {
+        if ((*it)->getExpireTime() <= now) {
+            continue;
+        }
+        const size_t pos = beginRecord(buffer, SNAPSHOT_MESSAGE, rrclass);
+        if ((*it)->genWire(now, buffer)) {
+            endRecord(buffer, pos);
+            ++count;
+        } else {
+            buffer.trim(buffer.getLength() - pos);
+        }
+    }
+    return (count);
+}
+
+void
+ResolverClassCache::restore(const AbstractRRset& rrset,
+                            RRsetTrustLevel level)
+{
+    rrsets_cache_->update(rrset, level);
+}
+
 bool
 ResolverClassCache::lookup(const bundy::dns::Name& qname,
                       const bundy::dns::RRType& qtype,
-                      bundy::dns::Message& response) const
+                      bundy::dns::Message& response, bool* prefetch) const
 {
     LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_RESOLVER_LOOKUP_MSG).
         arg(qname).arg(qtype);
@@ -89,11 +335,66 @@ ResolverClassCache::lookup(const bundy::dns::Name& qname,
         LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_RESOLVER_LOCAL_MSG).
             arg(qname).arg(qtype);
         response.addRRset(Message::SECTION_ANSWER, rrset_ptr);
+        if (prefetch != NULL) {
+            *prefetch = false;
+        }
         return (true);
     }
 
     // Search in class-specific message cache.
-    return (messages_cache_->lookup(qname, qtype, response));
+    return (messages_cache_->lookup(qname, qtype, response, prefetch));
+}
+
+bool
+ResolverClassCache::lookupWire(const bundy::dns::Name& qname,
+                               const bundy::dns::RRType& qtype,
+                               bundy::util::OutputBuffer& buffer,
+                               bool* prefetch) const
+{
+    LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_RESOLVER_LOOKUP_MSG).
+        arg(qname).arg(qtype);
+    if (local_zone_data_->lookup(qname, qtype)) {
+        if (prefetch != NULL) {
+            *prefetch = false;
+        }
+        return (false);
+    }
+    return (messages_cache_->lookupWire(qname, qtype, buffer, prefetch));
+}
+
+bool
+ResolverClassCache::lookupNegative(const bundy::dns::Name& qname,
+                                   const bundy::dns::RRType& qtype,
+                                   bundy::dns::Message& response) const
+{
+    return (aggressive_nsec_ && nsec_cache_->lookup(qname, qtype, response));
+}
+
+bool
+ResolverClassCache::lookupStale(const bundy::dns::Name& qname,
+                                const bundy::dns::RRType& qtype,
+                                bundy::dns::Message& response) const
+{
+    return (serve_stale_ && messages_cache_->lookupStale(qname, qtype,
+                                                         response));
+}
+
+void
+ResolverClassCache::setPrefetch(uint32_t min_hits, unsigned int window) {
+    messages_cache_->setPrefetch(min_hits, window);
+}
+
+void
+ResolverClassCache::setAggressiveNsec(bool enable) {
+    aggressive_nsec_ = enable;
+}
+
+void
+ResolverClassCache::setServeStale(uint32_t pool_size) {
+    messages_cache_->setStalePool(pool_size);
+    rrsets_cache_->setStalePool(pool_size);
+    negative_soa_cache_->setStalePool(pool_size);
+    serve_stale_ = (pool_size != 0);
 }
 
 bundy::dns::RRsetPtr
@@ -129,6 +430,11 @@ ResolverClassCache::update(const bundy::dns::Message& msg) {
     return (messages_cache_->update(msg));
 }
 
+bool
+ResolverClassCache::updateNegative(const bundy::dns::Message& msg) {
+    return (aggressive_nsec_ && nsec_cache_->update(msg));
+}
+
 bool
 ResolverClassCache::updateRRsetCache(const bundy::dns::ConstRRsetPtr& rrset_ptr,
                                 RRsetCachePtr rrset_cache_ptr)
@@ -182,11 +488,34 @@ bool
 ResolverCache::lookup(const bundy::dns::Name& qname,
                       const bundy::dns::RRType& qtype,
                       const bundy::dns::RRClass& qclass,
-                      bundy::dns::Message& response) const
+                      bundy::dns::Message& response, bool* prefetch) const
 {
+    if (prefetch != NULL) {
+        *prefetch = false;
+    }
     ResolverClassCache* cc = getClassCache(qclass);
     if (cc) {
-        return (cc->lookup(qname, qtype, response));
+        return (cc->lookup(qname, qtype, response, prefetch));
+    } else {
+        LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_RESOLVER_UNKNOWN_CLASS_MSG).
+            arg(qclass);
+        return (false);
+    }
+}
+
+bool
+ResolverCache::lookupWire(const bundy::dns::Name& qname,
+                          const bundy::dns::RRType& qtype,
+                          const bundy::dns::RRClass& qclass,
+                          bundy::util::OutputBuffer& buffer,
+                          bool* prefetch) const
+{
+    if (prefetch != NULL) {
+        *prefetch = false;
+    }
+    ResolverClassCache* cc = getClassCache(qclass);
+    if (cc) {
+        return (cc->lookupWire(qname, qtype, buffer, prefetch));
     } else {
         LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_RESOLVER_UNKNOWN_CLASS_MSG).
             arg(qclass);
@@ -234,6 +563,50 @@ ResolverCache::lookupDeepestNS(const bundy::dns::Name& qname,
     return (RRsetPtr());
 }
 
+bool
+ResolverCache::lookupNegative(const bundy::dns::Name& qname,
+                              const bundy::dns::RRType& qtype,
+                              const bundy::dns::RRClass& qclass,
+                              bundy::dns::Message& response) const
+{
+    ResolverClassCache* cc = getClassCache(qclass);
+    return (cc != NULL && cc->lookupNegative(qname, qtype, response));
+}
+
+bool
+ResolverCache::lookupStale(const bundy::dns::Name& qname,
+                           const bundy::dns::RRType& qtype,
+                           const bundy::dns::RRClass& qclass,
+                           bundy::dns::Message& response) const
+{
+    ResolverClassCache* cc = getClassCache(qclass);
+    return (cc != NULL && cc->lookupStale(qname, qtype, response));
+}
+
+void
+ResolverCache::setPrefetch(uint32_t min_hits, unsigned int window) {
+    for (std::vector<ResolverClassCache*>::const_iterator it =
+             class_caches_.begin(); it != class_caches_.end(); ++it) {
+        (*it)->setPrefetch(min_hits, window);
+    }
+}
+
+void
+ResolverCache::setAggressiveNsec(bool enable) {
+    for (std::vector<ResolverClassCache*>::const_iterator it =
+             class_caches_.begin(); it != class_caches_.end(); ++it) {
+        (*it)->setAggressiveNsec(enable);
+    }
+}
+
+void
+ResolverCache::setServeStale(uint32_t pool_size) {
+    for (std::vector<ResolverClassCache*>::const_iterator it =
+             class_caches_.begin(); it != class_caches_.end(); ++it) {
+        (*it)->setServeStale(pool_size);
+    }
+}
+
 bool
 ResolverCache::update(const bundy::dns::Message& msg) {
     QuestionIterator iter = msg.beginQuestion();
@@ -248,6 +621,15 @@ ResolverCache::update(const bundy::dns::Message& msg) {
     }
 }
 
+bool
+ResolverCache::updateNegative(const bundy::dns::Message& msg) {
+    if (msg.beginQuestion() == msg.endQuestion()) {
+        return (false);
+    }
+    ResolverClassCache* cc = getClassCache((*msg.beginQuestion())->getClass());
+    return (cc != NULL && cc->updateNegative(msg));
+}
+
 bool
 ResolverCache::update(const bundy::dns::ConstRRsetPtr& rrset_ptr) {
     ResolverClassCache* cc = getClassCache(rrset_ptr->getClass());
@@ -261,6 +643,132 @@ ResolverCache::update(const bundy::dns::ConstRRsetPtr& rrset_ptr) {
     }
 }
 
+size_t
+ResolverCache::saveSnapshot(const std::string& filename,
+                            const nsas::AddressRTTs& rtts) const
+{
+    const time_t now = bundy::util::CoarseClock::getTime();
+    OutputBuffer buffer(0);
+    buffer.writeUint32(SNAPSHOT_MAGIC);
+    buffer.writeUint16(SNAPSHOT_VERSION);
+    buffer.writeUint16(0);
+    writeUint64(buffer, now);
+
+    size_t count = 0;
+    for (std::vector<ResolverClassCache*>::const_iterator it =
+             class_caches_.begin(); it != class_caches_.end(); ++it) {
+        count += (*it)->dump(buffer, now);
+    }
+    for (nsas::AddressRTTs::const_iterator it = rtts.begin();
+         it != rtts.end();
+         ++it) {
+        const size_t pos = beginRecord(buffer, SNAPSHOT_RTT, 0);
+        buffer.writeUint32(it->second);
+        buffer.writeData(it->first.c_str(), it->first.size());
+        endRecord(buffer, pos);
+    }
+
+    // Write to a temporary file first, so a crash doesn't leave a broken
+    // snapshot behind.
+    const std::string tmp_filename = filename + ".tmp";
+    {
+        std::ofstream os(tmp_filename.c_str(),
+                         std::ios::binary | std::ios::trunc);
+        os.write(static_cast<const char*>(buffer.getData()),
+                 buffer.getLength());
+        os.close();
+        if (!os) {
+            unlink(tmp_filename.c_str());
+            bundy_throw(CacheSnapshotError, "failed to write " <<
+                        tmp_filename);
+        }
+    }
+    if (rename(tmp_filename.c_str(), filename.c_str()) == -1) {
+        const int error = errno;
+        unlink(tmp_filename.c_str());
+        bundy_throw(CacheSnapshotError, "failed to rename " << tmp_filename <<
+                    " to " << filename << ": " << strerror(error));
+    }
+    return (count);
+}
+
+size_t
+ResolverCache::loadSnapshot(const std::string& filename,
+                            nsas::AddressRTTs& rtts)
+{
+    const MappedFile file(filename);
+    InputBuffer buffer(file.getData(), file.getLength());
+    size_t count = 0;
+    try {
+        if (buffer.getLength() < SNAPSHOT_HEADER_LEN ||
+            buffer.readUint32() != SNAPSHOT_MAGIC) {
+            bundy_throw(CacheSnapshotError, filename <<
+                        " is not a cache snapshot");
+        }
+        const uint16_t version = buffer.readUint16();
+        if (version != SNAPSHOT_VERSION) {
+            bundy_throw(CacheSnapshotError, "unsupported version of " <<
+                        filename << ": " << version);
+        }
+        buffer.readUint16();
+        const uint64_t saved = readUint64(buffer);
+        const uint64_t now = bundy::util::CoarseClock::getTime();
+        const uint64_t elapsed = (now > saved) ? now - saved : 0;
+
+        // The records are gone through twice, to add the RRsets before
+        // the messages: adding a message adds its RRsets with the trust
+        // levels of the message, which must not replace the (usually
+        // higher) ones they had.
+        const size_t records_pos = buffer.getPosition();
+        for (int pass = 0; pass < 2; ++pass) {
+            buffer.setPosition(records_pos);
+            while (buffer.getPosition() < buffer.getLength()) {
+                const uint8_t type = buffer.readUint8();
+                const uint16_t rrclass = buffer.readUint16();
+                const size_t len = buffer.readUint32();
+                if (len > buffer.getLength() - buffer.getPosition()) {
+                    bundy_throw(CacheSnapshotError, "truncated record in " <<
+                                filename);
+                }
+                const uint8_t* const record = file.getData() +
+                    buffer.getPosition();
+                InputBuffer data(record, len);
+                buffer.setPosition(buffer.getPosition() + len);
+
+                if (type == SNAPSHOT_RTT) {
+                    if (pass == 0) {
+                        const uint32_t rtt = data.readUint32();
+                        rtts[std::string(record + data.getPosition(),
+                                         record + len)] = rtt;
+                    }
+                    continue;
+                }
+                if ((type != SNAPSHOT_RRSET || pass != 0) &&
+                    (type != SNAPSHOT_MESSAGE || pass != 1)) {
+                    continue;
+                }
+                ResolverClassCache* cc = getClassCache(RRClass(rrclass));
+                if (cc == NULL) {
+                    continue;
+                }
+                if (type == SNAPSHOT_RRSET) {
+                    if (restoreRRset(*cc, data, elapsed)) {
+                        ++count;
+                    }
+                } else if (restoreMessage(*cc, data, elapsed)) {
+                    ++count;
+                }
+            }
+        }
+    } catch (const CacheSnapshotError&) {
+        throw;
+    } catch (const bundy::Exception& ex) {
+        bundy_throw(CacheSnapshotError, "broken cache snapshot " <<
+                    filename << ": " << ex.what());
+    }
+    return (count);
+}
+
 ResolverClassCache*
 ResolverCache::getClassCache(const bundy::dns::RRClass& cache_class) const {
     for (std::vector<ResolverClassCache*>::size_type i = 0;
@@ -21,9 +21,12 @@
 #include <dns/rrclass.h>
 #include <dns/message.h>
 #include <exceptions/exceptions.h>
+#include <nsas/nsas_types.h>
+#include <util/buffer.h>
 #include "message_cache.h"
 #include "rrset_cache.h"
 #include "local_zone_data.h"
+#include "nsec_cache.h"
 
 namespace bundy {
 namespace cache {
@@ -45,17 +48,27 @@ public:
     /// \param cls The RRClass code
     /// \param msg_cache_size The size for the message cache
     /// \param rst_cache_size The size for the RRset cache
+    /// \param msg_cache_bytes The memory budget for the message cache in
+    ///        bytes (0 for no limit)
+    /// \param rst_cache_bytes The memory budget for the RRset cache in
+    ///        bytes (0 for no limit)
     CacheSizeInfo(const bundy::dns::RRClass& cls,
                   uint32_t msg_cache_size,
-                  uint32_t rst_cache_size):
+                  uint32_t rst_cache_size,
+                  size_t msg_cache_bytes = 0,
+                  size_t rst_cache_bytes = 0):
                     cclass(cls),
                     message_cache_size(msg_cache_size),
-                    rrset_cache_size(rst_cache_size)
+                    rrset_cache_size(rst_cache_size),
+                    message_cache_bytes(msg_cache_bytes),
+                    rrset_cache_bytes(rst_cache_bytes)
     {}
 
     bundy::dns::RRClass cclass; // class of the cache.
     uint32_t message_cache_size; // the size for message cache.
     uint32_t rrset_cache_size; // The size for rrset cache.
+    size_t message_cache_bytes; // The memory budget for message cache.
+    size_t rrset_cache_bytes; // The memory budget for rrset cache.
 };
 
 /// \brief  Message has no question section.
@@ -69,6 +82,16 @@ public:
     {}
 };
 
+/// \brief A cache snapshot can't be saved or loaded.
+///
+/// Thrown if a snapshot file can't be written or read, or if it's broken.
+class CacheSnapshotError : public bundy::Exception {
+public:
+    CacheSnapshotError(const char* file, size_t line, const char* what) :
+        bundy::Exception(file, line, what)
+    {}
+};
+
 /// \brief Class-specific Resolver Cache.
 ///
 /// The object of ResolverCache represents the cache of the resolver. It may hold
@@ -105,11 +128,25 @@ public:
     ///        no question section). If the message can be found
     ///        in cache, rrsets for the message will be added to
     ///        different sections(answer, authority, additional).
+    /// \param prefetch If not NULL, it's set to true if the message should
+    ///        be refreshed before it expires (see
+    ///        \c MessageCache::setPrefetch()), and to false otherwise.
     /// \return return true if the message can be found, or else,
     ///         return false.
     bool lookup(const bundy::dns::Name& qname,
                 const bundy::dns::RRType& qtype,
-                bundy::dns::Message& response) const;
+                bundy::dns::Message& response,
+                bool* prefetch = NULL) const;
+
+    /// \brief Look up message in cache and render it in wire format.
+    ///
+    /// See \c MessageCache::lookupWire().  Local zone data is not
+    /// rendered; if the name and type are found there this returns false
+    /// and \c lookup() should be used.
+    bool lookupWire(const bundy::dns::Name& qname,
+                    const bundy::dns::RRType& qtype,
+                    bundy::util::OutputBuffer& buffer,
+                    bool* prefetch = NULL) const;
 
     /// \brief Look up rrset in cache.
     ///
@@ -126,6 +163,42 @@ public:
     bundy::dns::RRsetPtr lookup(const bundy::dns::Name& qname,
                               const bundy::dns::RRType& qtype) const;
 
+    /// \brief Synthesize a negative answer from the cached NSEC records.
+    ///
+    /// See \c NsecCache::lookup().  This always returns false unless
+    /// enabled by \c setAggressiveNsec().
+    bool lookupNegative(const bundy::dns::Name& qname,
+                        const bundy::dns::RRType& qtype,
+                        bundy::dns::Message& response) const;
+
+    /// \brief Look up message in cache, expired or not.
+    ///
+    /// See \c MessageCache::lookupStale().  This always returns false
+    /// unless enabled by \c setServeStale().
+    bool lookupStale(const bundy::dns::Name& qname,
+                     const bundy::dns::RRType& qtype,
+                     bundy::dns::Message& response) const;
+
+    /// \brief Set the parameters of prefetching.
+    ///
+    /// See \c MessageCache::setPrefetch().
+    void setPrefetch(uint32_t min_hits, unsigned int window);
+
+    /// \brief Enable or disable the aggressive use of NSEC records.
+    ///
+    /// When enabled, the NSEC records of validated negative responses
+    /// given to \c updateNegative() are kept and used by
+    /// \c lookupNegative(). Disabling it drops nothing, the records are
+    /// just not used.
+    void setAggressiveNsec(bool enable);
+
+    /// \brief Set the size of the pools of stale data.
+    ///
+    /// See \c MessageCache::setStalePool().  The message cache and the
+    /// RRset caches each get a pool of \c pool_size; 0 disables serving
+    /// stale data.
+    void setServeStale(uint32_t pool_size);
+
     /// \brief Update the message in the cache with the new one.
     ///
     /// \param msg The message to update
@@ -143,6 +216,14 @@ public:
     ///       should be cached for all the types queries of a.example.
     bool update(const bundy::dns::Message& msg);
 
+    /// \brief Store the NSEC records of a negative response.
+    ///
+    /// See \c NsecCache::update().  Nothing is stored unless enabled by
+    /// \c setAggressiveNsec().
+    ///
+    /// \return true if any record was stored.
+    bool updateNegative(const bundy::dns::Message& msg);
+
     /// \brief Update the rrset in the cache with the new one.
     ///
     /// local zone data and rrset cache will be updated together.
@@ -165,6 +246,29 @@ public:
     /// \return The RRClass of this cache
     const bundy::dns::RRClass& getClass() const;
 
+    /// \brief Write the cached RRsets and messages to a snapshot.
+    ///
+    /// The unexpired RRsets of the RRset cache, with their trust levels,
+    /// and the messages that can be rendered by
+    /// \c MessageEntry::genWire() are appended to \c buffer as snapshot
+    /// records (see \c ResolverCache::saveSnapshot()), RRsets first.  The
+    /// TTLs are those remaining at \c now.
+    ///
+    /// \param buffer The buffer to append the records to.
+    /// \param now The current time.
+    /// \return The number of records written.
+    size_t dump(bundy::util::OutputBuffer& buffer, time_t now) const;
+
+    /// \brief Restore an RRset from a snapshot.
+    ///
+    /// The RRset is added to the RRset cache with the given trust level,
+    /// like one found in a response (the local zone data isn't updated).
+    ///
+    /// \param rrset The RRset, with the TTL remaining.
+    /// \param level The trust level it had when the snapshot was saved.
+    void restore(const bundy::dns::AbstractRRset& rrset,
+                 RRsetTrustLevel level);
+
 private:
     /// \brief Update rrset cache.
     ///
@@ -197,6 +301,15 @@ private:
 
     /// \brief cache the SOA rrset parsed from the negative response message.
     RRsetCachePtr negative_soa_cache_;
+
+    /// \brief cache the NSEC records of validated negative responses.
+    NsecCachePtr nsec_cache_;
+
+    /// \brief Whether the NSEC records are stored and used.
+    bool aggressive_nsec_;
+
+    /// Whether stale messages are used.
+    bool serve_stale_;
 };
 
 class ResolverCache {
@@ -229,12 +342,26 @@ public:
     ///        no question section). If the message can be found
     ///        in cache, rrsets for the message will be added to
     ///        different sections(answer, authority, additional).
+    /// \param prefetch If not NULL, it's set to true if the message should
+    ///        be refreshed before it expires (see
+    ///        \c MessageCache::setPrefetch()), and to false otherwise.
     /// \return return true if the message can be found, or else,
     ///         return false.
     bool lookup(const bundy::dns::Name& qname,
                 const bundy::dns::RRType& qtype,
                 const bundy::dns::RRClass& qclass,
-                bundy::dns::Message& response) const;
+                bundy::dns::Message& response,
+                bool* prefetch = NULL) const;
+
+    /// \brief Look up message in cache of the given class and render it
+    /// in wire format.
+    ///
+    /// See \c ResolverClassCache::lookupWire().
+    bool lookupWire(const bundy::dns::Name& qname,
+                    const bundy::dns::RRType& qtype,
+                    const bundy::dns::RRClass& qclass,
+                    bundy::util::OutputBuffer& buffer,
+                    bool* prefetch = NULL) const;
 
     /// \brief Look up rrset in cache.
     ///
@@ -275,8 +402,47 @@ public:
     /// is used frequently? Exact or closest enclosing ns looking up.
     bundy::dns::RRsetPtr lookupDeepestNS(const bundy::dns::Name& qname,
                               const bundy::dns::RRClass& qclass) const;
+
+    /// \brief Synthesize a negative answer from the cached NSEC records
+    /// of the given class.
+    ///
+    /// See \c ResolverClassCache::lookupNegative().
+    bool lookupNegative(const bundy::dns::Name& qname,
+                        const bundy::dns::RRType& qtype,
+                        const bundy::dns::RRClass& qclass,
+                        bundy::dns::Message& response) const;
+
+    /// \brief Look up message in cache of the given class, expired or
+    /// not.
+    ///
+    /// See \c ResolverClassCache::lookupStale().
+    bool lookupStale(const bundy::dns::Name& qname,
+                     const bundy::dns::RRType& qtype,
+                     const bundy::dns::RRClass& qclass,
+                     bundy::dns::Message& response) const;
     //@}
 
+    /// \brief Set the parameters of prefetching for all classes.
+    ///
+    /// See \c MessageCache::setPrefetch().
+    void setPrefetch(uint32_t min_hits,
+                     unsigned int window =
+                     MessageCache::DEFAULT_PREFETCH_WINDOW);
+
+    /// \brief Enable or disable the aggressive use of NSEC records for
+    /// all classes.
+    ///
+    /// See \c ResolverClassCache::setAggressiveNsec().  It's disabled by
+    /// default, as this cache doesn't validate the records itself (see
+    /// \c NsecCache).
+    void setAggressiveNsec(bool enable);
+
+    /// \brief Set the size of the pools of stale data for all classes.
+    ///
+    /// See \c ResolverClassCache::setServeStale().  It's disabled by
+    /// default.
+    void setServeStale(uint32_t pool_size);
+
     /// \brief Update the message in the cache with the new one.
     ///
     /// \param msg The message to update
@@ -288,6 +454,12 @@ public:
     ///       the user should make sure the message is valid.
     bool update(const bundy::dns::Message& msg);
 
+    /// \brief Store the NSEC records of a negative response in the cache
+    /// of its class.
+    ///
+    /// See \c ResolverClassCache::updateNegative().
+    bool updateNegative(const bundy::dns::Message& msg);
+
     /// \brief Update the rrset in the cache with the new one.
     ///
     /// local zone data and rrset cache will be updated together.
@@ -303,6 +475,47 @@ public:
     ///
     bool update(const bundy::dns::ConstRRsetPtr& rrset_ptr);
 
+    /// \brief Save a snapshot of the cache to a file.
+    ///
+    /// The RRsets and messages of the caches of all classes (see
+    /// \c ResolverClassCache::dump()) and the given nameserver RTTs are
+    /// written in a compact binary format, so a new cache can be filled
+    /// with them by \c loadSnapshot().  Local zone data and the NSEC
+    /// records for aggressive negative caching aren't saved.
+    ///
+    /// The file is written under a temporary name and renamed, so an
+    /// existing snapshot is replaced atomically.
+    ///
+    /// \throw CacheSnapshotError The file can't be written.
+    ///
+    /// \param filename The name of the snapshot file.
+    /// \param rtts The RTTs of nameserver addresses (see
+    ///     \c bundy::nsas::NameserverAddressStore::getRTTs()).
+    /// \return The number of RRsets and messages saved.
+    size_t saveSnapshot(const std::string& filename,
+                        const bundy::nsas::AddressRTTs& rtts) const;
+
+    /// \brief Fill the cache from a snapshot file.
+    ///
+    /// The file is mapped into memory and the RRsets and messages saved
+    /// by \c saveSnapshot() are added to the caches of their classes, with
+    /// their TTLs decreased by the time passed since then.  Those that
+    /// have expired meanwhile, or are for classes this cache doesn't
+    /// have, are skipped.  The RRsets are added before the messages, so
+    /// the messages refer to them and keep their trust levels.
+    ///
+    /// If the file turns out to be broken, the data added before the
+    /// problem was found stays in the cache.
+    ///
+    /// \throw CacheSnapshotError The file can't be read or is broken.
+    ///
+    /// \param filename The name of the snapshot file.
+    /// \param rtts The saved RTTs of nameserver addresses are stored in
+    ///     it.
+    /// \return The number of RRsets and messages added.
+    size_t loadSnapshot(const std::string& filename,
+                        bundy::nsas::AddressRTTs& rtts);
+
 private:
     /// \brief Returns the class-specific subcache
     ///
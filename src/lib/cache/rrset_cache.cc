@@ -16,12 +16,9 @@
 
 #include "rrset_cache.h"
 #include "logger.h"
+#include <util/time_utilities.h>
 #include <string>
-#include <nsas/nsas_entry_compare.h>
-#include <nsas/hash_table.h>
-#include <nsas/hash_deleter.h>
 
-using namespace bundy::nsas;
 using namespace bundy::dns;
 using namespace std;
 
@@ -29,11 +26,9 @@ namespace bundy {
 namespace cache {
 
 RRsetCache::RRsetCache(uint32_t cache_size,
-                       uint16_t rrset_class):
+                       uint16_t rrset_class, size_t max_bytes):
     class_(rrset_class),
-    rrset_table_(new NsasEntryCompare<RRsetEntry>, cache_size),
-    rrset_lru_((3 * cache_size),
-                  new HashDeleter<RRsetEntry>(rrset_table_))
+    rrsets_(3 * cache_size, max_bytes)
 {
     LOG_DEBUG(logger, DBG_TRACE_BASIC, CACHE_RRSET_INIT).arg(cache_size).
         arg(RRClass(rrset_class));
@@ -47,20 +42,20 @@ RRsetCache::lookup(const bundy::dns::Name& qname,
         arg(qtype).arg(RRClass(class_));
     const string entry_name = genCacheEntryName(qname, qtype);
 
-    RRsetEntryPtr entry_ptr = rrset_table_.get(HashKey(entry_name,
-                                                       RRClass(class_)));
+    RRsetEntryPtr entry_ptr = rrsets_.get(entry_name);
     if (entry_ptr) {
-        if (entry_ptr->getExpireTime() > time(NULL)) {
-            // Only touch the non-expired rrset entries
-            rrset_lru_.touch(entry_ptr);
+        if (entry_ptr->getExpireTime() >
+            bundy::util::CoarseClock::getTime()) {
             return (entry_ptr);
         } else {
             LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_RRSET_EXPIRED).arg(qname).
                 arg(qtype).arg(RRClass(class_));
-            // the rrset entry has expired, so just remove it from
-            // hash table and lru list.
-            rrset_table_.remove(entry_ptr->hashKey());
-            rrset_lru_.remove(entry_ptr);
+            // the rrset entry has expired, so just remove it (keeping it
+            // for stale answers if enabled).
+            if (stale_) {
+                stale_->add(entry_name, entry_ptr, entry_ptr->getSize());
+            }
+            rrsets_.remove(entry_name);
         }
     }
 
@@ -86,17 +81,40 @@ RRsetCache::update(const bundy::dns::AbstractRRset& rrset,
             // existed rrset entry is more authoritative, just return it
             return (entry_ptr);
         } else {
+            // The old rrset entry is replaced below.
             LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_RRSET_REMOVE_OLD).
                 arg(rrset.getName()).arg(rrset.getType()).
                 arg(rrset.getClass());
-            // Remove the old rrset entry from the lru list.
-            rrset_lru_.remove(entry_ptr);
         }
     }
 
     entry_ptr.reset(new RRsetEntry(rrset, level));
-    rrset_table_.add(entry_ptr, entry_ptr->hashKey(), true);
-    rrset_lru_.add(entry_ptr);
+    rrsets_.add(entry_ptr->getEntryName(), entry_ptr, entry_ptr->getSize());
+    if (stale_) {
+        // The stale copy is superseded by the new one.
+        stale_->remove(entry_ptr->getEntryName());
+    }
+    return (entry_ptr);
+}
+
+void
+RRsetCache::setStalePool(uint32_t pool_size) {
+    if (pool_size == 0) {
+        stale_.reset();
+    } else {
+        stale_.reset(new ShardedCache<RRsetEntry>(3 * pool_size));
+    }
+}
+
+RRsetEntryPtr
+RRsetCache::lookupStale(const bundy::dns::Name& qname,
+                        const bundy::dns::RRType& qtype)
+{
+    const string entry_name = genCacheEntryName(qname, qtype);
+    RRsetEntryPtr entry_ptr = rrsets_.get(entry_name);
+    if (!entry_ptr && stale_) {
+        entry_ptr = stale_->get(entry_name);
+    }
     return (entry_ptr);
 }
 
@@ -16,9 +16,9 @@
 #define RRSET_CACHE_H
 
 #include <cache/rrset_entry.h>
-#include <nsas/hash_table.h>
+#include <cache/sharded_cache.h>
 
-#include <util/lru_list.h>
+#include <boost/scoped_ptr.hpp>
 
 namespace bundy {
 namespace cache {
@@ -29,6 +29,9 @@ class RRsetEntry;
 /// The object of RRsetCache represented the cache for class-specific
 /// RRsets.
 ///
+/// The RRsets are kept in a \c ShardedCache, so lookups from multiple
+/// threads can run in parallel.
+///
 /// \todo The rrset cache class should provide the interfaces for
 ///       loading, dumping and resizing.
 class RRsetCache{
@@ -44,12 +47,15 @@ private:
 public:
     /// \brief Constructor and Destructor
     ///
+    /// The cache holds up to three times \c cache_size entries.
+    ///
     /// \param cache_size the size of rrset cache.
     /// \param rrset_class the class of rrset cache.
-    RRsetCache(uint32_t cache_size, uint16_t rrset_class);
-    virtual ~RRsetCache() {
-        rrset_lru_.clear(); // Clear the rrset entries in the list.
-    }
+    /// \param max_bytes the maximum estimated memory used by the RRsets,
+    ///        in bytes; 0 means no limit.
+    RRsetCache(uint32_t cache_size, uint16_t rrset_class,
+               size_t max_bytes = 0);
+    virtual ~RRsetCache() {}
     //@}
 
     /// \brief Look up rrset in cache.
@@ -74,11 +80,52 @@ public:
     RRsetEntryPtr update(const bundy::dns::AbstractRRset& rrset,
                          const RRsetTrustLevel& level);
 
+    /// \brief Set the size of the pool of stale RRsets.
+    ///
+    /// When the pool is enabled, an RRset found expired by \c lookup() is
+    /// moved to it instead of being dropped, so \c lookupStale() can
+    /// still find it.  The pool holds up to three times \c pool_size
+    /// entries; the least recently used ones are evicted first.  It's
+    /// disabled by default.
+    ///
+    /// This is not thread safe; it's expected to be called before the
+    /// cache is used.
+    ///
+    /// \param pool_size The size of the pool; 0 disables it and drops all
+    ///        the RRsets in it.
+    void setStalePool(uint32_t pool_size);
+
+    /// \brief Look up an RRset, expired or not.
+    ///
+    /// \return The entry of the RRset in the cache or, failing that, in
+    ///         the stale pool; NULL if it's in neither.
+    RRsetEntryPtr lookupStale(const bundy::dns::Name& qname,
+                              const bundy::dns::RRType& qtype);
+
+    /// \brief Return all entries in the cache, expired or not.
+    ///
+    /// See \c ShardedCache::getEntries().
+    void getEntries(std::vector<RRsetEntryPtr>& entries) const {
+        rrsets_.getEntries(entries);
+    }
+
+    /// \brief Return the number of shards of the cache.
+    size_t getShardCount() const {
+        return (rrsets_.getShardCount());
+    }
+
+    /// \brief Return the statistics of a shard of the cache.
+    ///
+    /// \param shard The index of the shard, less than \c getShardCount().
+    CacheShardStats getShardStats(size_t shard) const {
+        return (rrsets_.getShardStats(shard));
+    }
+
     /// \short Protected memebers, so they can be accessed by tests.
 protected:
     uint16_t class_; // The class of the rrset cache.
-    bundy::nsas::HashTable<RRsetEntry> rrset_table_;
-    bundy::util::LruList<RRsetEntry> rrset_lru_;
+    ShardedCache<RRsetEntry> rrsets_;
+    boost::scoped_ptr<ShardedCache<RRsetEntry> > stale_; // NULL if disabled
 };
 
 typedef boost::shared_ptr<RRsetCache> RRsetCachePtr;
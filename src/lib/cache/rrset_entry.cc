@@ -17,6 +17,7 @@
 #include <dns/message.h>
 #include <nsas/nsas_entry.h>
 #include <nsas/fetchable.h>
+#include <util/time_utilities.h>
 #include "rrset_entry.h"
 #include "rrset_copy.h"
 
@@ -29,12 +30,15 @@ namespace cache {
 RRsetEntry::RRsetEntry(const bundy::dns::AbstractRRset& rrset,
                        const RRsetTrustLevel& level):
     entry_name_(genCacheEntryName(rrset.getName(), rrset.getType())),
-    expire_time_(time(NULL) + rrset.getTTL().getValue()),
+    expire_time_(bundy::util::CoarseClock::getTime() +
+                 rrset.getTTL().getValue()),
     trust_level_(level),
     rrset_(new RRset(rrset.getName(), rrset.getClass(), rrset.getType(), rrset.getTTL())),
     hash_key_(HashKey(entry_name_, rrset_->getClass()))
 {
     rrsetCopy(rrset, *(rrset_.get()));
+    size_ = sizeof(*this) + entry_name_.size() +
+        (rrset_->getRdataCount() > 0 ? rrset_->getLength() : 0);
 }
 
 bundy::dns::RRsetPtr
@@ -55,7 +59,7 @@ RRsetEntry::updateTTL(){
         return;
     }
 
-    uint32_t now = time(NULL);
+    uint32_t now = bundy::util::CoarseClock::getTime();
     uint32_t newTTL = now < expire_time_ ? (expire_time_ - now) : 0;
 
     RRTTL ttl(newTTL);
@@ -113,6 +113,23 @@ public:
     RRsetTrustLevel getTrustLevel() const {
         return (trust_level_);
     }
+
+    /// \brief Get the name of the entry in the cache.
+    ///
+    /// \return The name generated by \c genCacheEntryName().
+    const std::string& getEntryName() const {
+        return (entry_name_);
+    }
+
+    /// \brief Get the estimated memory used by the entry.
+    ///
+    /// This is the size of the object and the wire format of the RRset,
+    /// which roughly approximates the data kept in the RRset.
+    ///
+    /// \return The size in bytes.
+    size_t getSize() const {
+        return (size_);
+    }
 private:
     /// \brief Update TTL according to expiration time
     void updateTTL();
@@ -123,6 +140,7 @@ private:
     RRsetTrustLevel trust_level_; // RRset trustworthiness.
     boost::shared_ptr<bundy::dns::RRset> rrset_;
     bundy::nsas::HashKey hash_key_; // RRsetEntry hash key
+    size_t size_; // Estimated memory used by the entry.
 };
 
 typedef boost::shared_ptr<RRsetEntry> RRsetEntryPtr;
@@ -0,0 +1,326 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SHARDED_CACHE_H
+#define SHARDED_CACHE_H
+
+#include <util/threads/sync.h>
+
+#include <boost/functional/hash.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace cache {
+
+/// \brief Statistics of a shard of a \c ShardedCache.
+struct CacheShardStats {
+    CacheShardStats() :
+        entries(0), bytes(0), hits(0), misses(0), evictions(0)
+    {}
+
+    size_t entries;     ///< Number of entries in the shard
+    size_t bytes;       ///< Estimated memory used by the entries
+    uint64_t hits;      ///< Number of successful lookups
+    uint64_t misses;    ///< Number of lookups that found nothing
+    uint64_t evictions; ///< Number of entries evicted to make room
+};
+
+/// \brief Storage of the resolver caches.
+///
+/// Entries are stored by their key (see \c genCacheEntryName()) in a
+/// number of shards chosen by the hash of the key, each protected by its
+/// own mutex, so lookups from different threads rarely wait for each
+/// other.
+///
+/// Each shard replaces its entries with the CLOCK algorithm: a lookup only
+/// marks the entry as referenced, and when room is needed the clock hand
+/// sweeps over the entries, clearing the marks and evicting the first one
+/// that isn't marked.  That approximates LRU, but a hit doesn't need to
+/// move anything, unlike with \c bundy::util::LruList.
+///
+/// The size of the cache is limited by the number of entries and,
+/// optionally, by the estimated memory their data use.  Both limits are
+/// split evenly between the shards.  Small caches (fewer than
+/// \c MIN_SHARD_ENTRIES entries per shard) use fewer shards, so the limit
+/// of the number of entries stays meaningful.
+///
+/// \param T The type of the entries.
+template <typename T>
+class ShardedCache : boost::noncopyable {
+public:
+    /// \brief Shared pointer to an entry.
+    typedef boost::shared_ptr<T> EntryPtr;
+
+    /// \brief The default number of shards.
+    static const size_t DEFAULT_SHARDS = 16;
+
+    /// \brief The minimum number of entries in a shard.
+    static const size_t MIN_SHARD_ENTRIES = 64;
+
+    /// \brief Constructor.
+    ///
+    /// \param max_entries The maximum number of entries in the cache.
+    /// \param max_bytes The maximum estimated memory used by the entries,
+    ///     in bytes; 0 means no limit.
+    /// \param shards The number of shards.
+    ShardedCache(size_t max_entries, size_t max_bytes = 0,
+                 size_t shards = DEFAULT_SHARDS)
+    {
+        shards = std::max(static_cast<size_t>(1),
+                          std::min(shards, max_entries / MIN_SHARD_ENTRIES));
+        const size_t shard_entries =
+            std::max(static_cast<size_t>(1),
+                     (max_entries + shards - 1) / shards);
+        const size_t shard_bytes = (max_bytes + shards - 1) / shards;
+        for (size_t i = 0; i < shards; ++i) {
+            shards_.push_back(ShardPtr(new Shard(shard_entries,
+                                                 shard_bytes)));
+        }
+    }
+
+    /// \brief Find an entry.
+    ///
+    /// \return The entry, or NULL if there's none for the key.
+    EntryPtr get(const std::string& key) {
+        Shard& shard = getShard(key);
+        util::thread::Mutex::Locker locker(shard.mutex_);
+        const typename Index::const_iterator it = shard.index_.find(key);
+        if (it == shard.index_.end()) {
+            ++shard.stats_.misses;
+            return (EntryPtr());
+        }
+        ++shard.stats_.hits;
+        Slot& slot = shard.slots_[it->second];
+        slot.referenced_ = true;
+        return (slot.entry_);
+    }
+
+    /// \brief Add an entry.
+    ///
+    /// An entry of the same key is replaced (which counts as a reference to
+    /// it).  Other entries of the shard are evicted as needed to make room.
+    ///
+    /// \param key The key of the entry.
+    /// \param entry The entry.
+    /// \param size The estimated memory used by the entry, in bytes.
+    /// \return false if the entry is larger than the size of a shard (so
+    ///     it's not stored), true otherwise.
+    bool add(const std::string& key, const EntryPtr& entry, size_t size) {
+        Shard& shard = getShard(key);
+        util::thread::Mutex::Locker locker(shard.mutex_);
+        const typename Index::iterator it = shard.index_.find(key);
+        if (it != shard.index_.end()) {
+            Slot& slot = shard.slots_[it->second];
+            if (shard.max_bytes_ == 0 ||
+                shard.stats_.bytes - slot.size_ + size <= shard.max_bytes_) {
+                // Replace it in place; it counts as a reference.
+                shard.stats_.bytes += size - slot.size_;
+                slot.entry_ = entry;
+                slot.size_ = size;
+                slot.referenced_ = true;
+                return (true);
+            }
+            shard.release(it->second);
+            shard.index_.erase(it);
+        }
+        if (shard.max_bytes_ != 0 && size > shard.max_bytes_) {
+            return (false);
+        }
+        while (shard.stats_.entries >= shard.max_entries_ ||
+               (shard.max_bytes_ != 0 &&
+                shard.stats_.bytes + size > shard.max_bytes_)) {
+            shard.evict();
+        }
+        const size_t pos = shard.allocate();
+        Slot& slot = shard.slots_[pos];
+        slot.key_ = key;
+        slot.entry_ = entry;
+        slot.size_ = size;
+        slot.referenced_ = false;
+        shard.index_.insert(std::make_pair(key, pos));
+        ++shard.stats_.entries;
+        shard.stats_.bytes += size;
+        return (true);
+    }
+
+    /// \brief Remove an entry.
+    ///
+    /// \return true if there was an entry for the key, false otherwise.
+    bool remove(const std::string& key) {
+        Shard& shard = getShard(key);
+        util::thread::Mutex::Locker locker(shard.mutex_);
+        const typename Index::iterator it = shard.index_.find(key);
+        if (it == shard.index_.end()) {
+            return (false);
+        }
+        shard.release(it->second);
+        shard.index_.erase(it);
+        return (true);
+    }
+
+    /// \brief Remove all entries.
+    ///
+    /// The statistics other than the number of entries and bytes are kept.
+    void clear() {
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            Shard& shard = *shards_[i];
+            util::thread::Mutex::Locker locker(shard.mutex_);
+            shard.slots_.clear();
+            shard.free_.clear();
+            shard.index_.clear();
+            shard.hand_ = 0;
+            shard.stats_.entries = 0;
+            shard.stats_.bytes = 0;
+        }
+    }
+
+    /// \brief Return all entries.
+    ///
+    /// The shards are locked one by one, so if the cache is updated
+    /// meanwhile, the result isn't an exact image of it at any time.
+    ///
+    /// \param entries The entries are appended to this vector.
+    void getEntries(std::vector<EntryPtr>& entries) const {
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            const Shard& shard = *shards_[i];
+            util::thread::Mutex::Locker locker(shard.mutex_);
+            for (size_t pos = 0; pos < shard.slots_.size(); ++pos) {
+                if (shard.slots_[pos].entry_) {
+                    entries.push_back(shard.slots_[pos].entry_);
+                }
+            }
+        }
+    }
+
+    /// \brief Return the number of entries in the cache.
+    size_t size() const {
+        size_t entries = 0;
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            util::thread::Mutex::Locker locker(shards_[i]->mutex_);
+            entries += shards_[i]->stats_.entries;
+        }
+        return (entries);
+    }
+
+    /// \brief Return the number of shards.
+    size_t getShardCount() const {
+        return (shards_.size());
+    }
+
+    /// \brief Return the statistics of a shard.
+    ///
+    /// \param shard The index of the shard, less than
+    ///     \c getShardCount().
+    CacheShardStats getShardStats(size_t shard) const {
+        util::thread::Mutex::Locker locker(shards_.at(shard)->mutex_);
+        return (shards_[shard]->stats_);
+    }
+
+private:
+    typedef boost::unordered_map<std::string, size_t> Index;
+
+    struct Slot {
+        Slot() : size_(0), referenced_(false) {}
+        std::string key_;
+        EntryPtr entry_;        // NULL if the slot is free
+        size_t size_;
+        bool referenced_;
+    };
+
+    struct Shard : boost::noncopyable {
+        Shard(size_t max_entries, size_t max_bytes) :
+            max_entries_(max_entries), max_bytes_(max_bytes), hand_(0)
+        {}
+
+        // Return a free slot.
+        size_t allocate() {
+            if (!free_.empty()) {
+                const size_t pos = free_.back();
+                free_.pop_back();
+                return (pos);
+            }
+            slots_.push_back(Slot());
+            return (slots_.size() - 1);
+        }
+
+        // Make the slot free (the index is updated by the caller).
+        void release(size_t pos) {
+            Slot& slot = slots_[pos];
+            --stats_.entries;
+            stats_.bytes -= slot.size_;
+            slot.key_.clear();
+            slot.entry_.reset();
+            slot.size_ = 0;
+            free_.push_back(pos);
+        }
+
+        // Evict an entry with the clock hand.  There must be one.
+        void evict() {
+            while (true) {
+                if (hand_ >= slots_.size()) {
+                    hand_ = 0;
+                }
+                Slot& slot = slots_[hand_++];
+                if (!slot.entry_) {
+                    continue;
+                } else if (slot.referenced_) {
+                    slot.referenced_ = false;
+                    continue;
+                }
+                index_.erase(slot.key_);
+                release(hand_ - 1);
+                ++stats_.evictions;
+                return;
+            }
+        }
+
+        mutable util::thread::Mutex mutex_;
+        const size_t max_entries_;
+        const size_t max_bytes_;
+        std::vector<Slot> slots_;
+        std::vector<size_t> free_;
+        Index index_;
+        size_t hand_;
+        CacheShardStats stats_;
+    };
+    typedef boost::shared_ptr<Shard> ShardPtr;
+
+    Shard& getShard(const std::string& key) {
+        // The upper bits are used so the choice of the shard doesn't
+        // correlate with the buckets of the index in the shard.
+        const size_t hash = boost::hash<std::string>()(key);
+        return (*shards_[(hash >> 16) % shards_.size()]);
+    }
+
+    std::vector<ShardPtr> shards_;
+};
+
+template <typename T>
+const size_t ShardedCache<T>::DEFAULT_SHARDS;
+
+template <typename T>
+const size_t ShardedCache<T>::MIN_SHARD_ENTRIES;
+
+} // namespace cache
+} // namespace bundy
+
+#endif // SHARDED_CACHE_H
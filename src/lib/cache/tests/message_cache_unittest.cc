@@ -42,7 +42,7 @@ public:
     {}
 
     uint16_t messages_count() {
-        return message_lru_.size();
+        return messages_.size();
     }
 };
 
@@ -56,13 +56,7 @@ public:
 
     /// \brief Remove one rrset entry from rrset cache.
     void removeRRsetEntry(Name& name, const RRType& type) {
-        const string entry_name = genCacheEntryName(name, type);
-        HashKey entry_key = HashKey(entry_name, RRClass(class_));
-        RRsetEntryPtr rrset_entry = rrset_table_.get(entry_key);
-        if (rrset_entry) {
-            rrset_lru_.remove(rrset_entry);
-            rrset_table_.remove(entry_key);
-        }
+        rrsets_.remove(genCacheEntryName(name, type));
     }
 };
 
@@ -127,6 +121,90 @@ TEST_F(MessageCacheTest, testLookup) {
     EXPECT_EQ(message_cache_->messages_count(), 2);
 }
 
+TEST_F(MessageCacheTest, testPrefetch) {
+    messageFromFile(message_parse, "message_fromWire1");
+    EXPECT_TRUE(message_cache_->update(message_parse));
+    const Name qname("test.example.com.");
+    bool prefetch = true;
+
+    // Disabled by default.
+    EXPECT_TRUE(message_cache_->lookup(qname, RRType::A(), message_render,
+                                       &prefetch));
+    EXPECT_FALSE(prefetch);
+
+    // The hits are counted only within the window; the message was just
+    // cached, so it is not within the default 10% window yet.
+    message_cache_->setPrefetch(1);
+    EXPECT_TRUE(message_cache_->lookup(qname, RRType::A(), message_render,
+                                       &prefetch));
+    EXPECT_FALSE(prefetch);
+
+    // With the whole TTL, prefetch is requested once on the third hit.
+    message_cache_->setPrefetch(3, 100);
+    EXPECT_TRUE(message_cache_->lookup(qname, RRType::A(), message_render,
+                                       &prefetch));
+    EXPECT_FALSE(prefetch);
+    EXPECT_TRUE(message_cache_->lookup(qname, RRType::A(), message_render,
+                                       &prefetch));
+    EXPECT_FALSE(prefetch);
+    EXPECT_TRUE(message_cache_->lookup(qname, RRType::A(), message_render,
+                                       &prefetch));
+    EXPECT_TRUE(prefetch);
+    EXPECT_TRUE(message_cache_->lookup(qname, RRType::A(), message_render,
+                                       &prefetch));
+    EXPECT_FALSE(prefetch);
+
+    // The refreshed message is counted from the start again.
+    EXPECT_TRUE(message_cache_->update(message_parse));
+    util::OutputBuffer buffer(0);
+    for (int i = 0; i < 2; ++i) {
+        EXPECT_TRUE(message_cache_->lookupWire(qname, RRType::A(), buffer,
+                                               &prefetch));
+        EXPECT_FALSE(prefetch);
+    }
+    EXPECT_TRUE(message_cache_->lookupWire(qname, RRType::A(), buffer,
+                                           &prefetch));
+    EXPECT_TRUE(prefetch);
+
+    EXPECT_THROW(message_cache_->setPrefetch(1, 101), InvalidParameter);
+}
+
+TEST_F(MessageCacheTest, testStale) {
+    // Disabled by default; the expired message is just dropped.
+    updateMessageCache("message_fromWire9", message_cache_);
+    const Name qname("test.example.org.");
+    EXPECT_FALSE(message_cache_->lookup(qname, RRType::A(), message_render));
+    EXPECT_FALSE(message_cache_->lookupStale(qname, RRType::A(),
+                                             message_render));
+
+    message_cache_->setStalePool(1);
+    rrset_cache_->setStalePool(1);
+    updateMessageCache("message_fromWire9", message_cache_);
+    EXPECT_FALSE(message_cache_->lookup(qname, RRType::A(), message_render));
+    EXPECT_EQ(0, message_cache_->messages_count());
+    // The expired RRset is moved to the stale pool, too.
+    EXPECT_FALSE(rrset_cache_->lookup(qname, RRType::A()));
+    EXPECT_TRUE(rrset_cache_->lookupStale(qname, RRType::A()));
+
+    Message stale(Message::RENDER);
+    EXPECT_TRUE(message_cache_->lookupStale(qname, RRType::A(), stale));
+    ASSERT_EQ(2, stale.getRRCount(Message::SECTION_ANSWER));
+    const ConstRRsetPtr rrset = *stale.beginSection(Message::SECTION_ANSWER);
+    EXPECT_EQ(2, rrset->getRdataCount());
+    EXPECT_EQ(RRTTL(MessageCache::STALE_TTL), rrset->getTTL());
+
+    // Without the RRset the stale message can't be used either.
+    rrset_cache_->setStalePool(0);
+    Message stale2(Message::RENDER);
+    EXPECT_FALSE(message_cache_->lookupStale(qname, RRType::A(), stale2));
+
+    // Fresh messages are found, too.
+    messageFromFile(message_parse, "message_fromWire1");
+    EXPECT_TRUE(message_cache_->update(message_parse));
+    EXPECT_TRUE(message_cache_->lookupStale(Name("test.example.com."),
+                                            RRType::A(), message_render));
+}
+
 TEST_F(MessageCacheTest, testUpdate) {
     messageFromFile(message_parse, "message_fromWire4");
     EXPECT_TRUE(message_cache_->update(message_parse));
@@ -280,6 +280,58 @@ TEST_F(MessageEntryTest, testGenMessage) {
     EXPECT_EQ(7, msg.getRRCount(Message::SECTION_ADDITIONAL));
 }
 
+TEST_F(MessageEntryTest, testGenWire) {
+    messageFromFile(message_parse, "message_fromWire3");
+    DerivedMessageEntry message_entry(message_parse, rrset_cache_, negative_soa_cache_);
+    const time_t expire_time = message_entry.getExpireTime();
+    const time_t now = time(NULL);
+
+    util::OutputBuffer buffer(0);
+    EXPECT_FALSE(message_entry.genWire(expire_time, buffer));
+    EXPECT_EQ(0, buffer.getLength());
+
+    // The image is appended to the buffer.
+    buffer.writeUint8(0xff);
+    ASSERT_TRUE(message_entry.genWire(now, buffer));
+    ASSERT_LT(1, buffer.getLength());
+    util::InputBuffer ibuffer(static_cast<const uint8_t*>(buffer.getData()) + 1,
+                              buffer.getLength() - 1);
+    Message msg(Message::PARSE);
+    msg.fromWire(ibuffer);
+    EXPECT_EQ(0, msg.getQid());
+    EXPECT_TRUE(msg.getHeaderFlag(Message::HEADERFLAG_QR));
+    EXPECT_TRUE(msg.getHeaderFlag(Message::HEADERFLAG_RA));
+    EXPECT_FALSE(msg.getHeaderFlag(Message::HEADERFLAG_AA));
+    EXPECT_FALSE(msg.getHeaderFlag(Message::HEADERFLAG_TC));
+    EXPECT_EQ((*message_parse.beginQuestion())->toText(),
+              (*msg.beginQuestion())->toText());
+    EXPECT_EQ(1, msg.getRRCount(Message::SECTION_ANSWER));
+    EXPECT_EQ(5, msg.getRRCount(Message::SECTION_AUTHORITY));
+    EXPECT_EQ(7, msg.getRRCount(Message::SECTION_ADDITIONAL));
+    EXPECT_GE(21600, (*msg.beginSection(Message::SECTION_ANSWER))->
+              getTTL().getValue());
+
+    // The TTLs are decreased by the elapsed time.
+    buffer.clear();
+    ASSERT_TRUE(message_entry.genWire(now + 100, buffer));
+    util::InputBuffer ibuffer2(buffer.getData(), buffer.getLength());
+    Message msg2(Message::PARSE);
+    msg2.fromWire(ibuffer2);
+    EXPECT_GE(21500, (*msg2.beginSection(Message::SECTION_ANSWER))->
+              getTTL().getValue());
+    EXPECT_LT(21400, (*msg2.beginSection(Message::SECTION_ANSWER))->
+              getTTL().getValue());
+
+    // Once an RRset is replaced in the RRset cache, the image can't be used
+    // any more, but the message is still generated from the cache.
+    RRsetPtr rrset = *message_parse.beginSection(Message::SECTION_ANSWER);
+    rrset_cache_->update(*rrset, RRSET_TRUST_PRIM_ZONE_NONGLUE);
+    buffer.clear();
+    EXPECT_FALSE(message_entry.genWire(now, buffer));
+    Message msg3(Message::RENDER);
+    EXPECT_TRUE(message_entry.genMessage(time(NULL), msg3));
+}
+
 TEST_F(MessageEntryTest, testMaxTTL) {
     messageFromFile(message_parse, "message_large_ttl.wire");
 
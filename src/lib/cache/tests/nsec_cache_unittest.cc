@@ -0,0 +1,248 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include "nsec_cache.h"
+#include "resolver_cache.h"
+
+#include <dns/message.h>
+#include <dns/question.h>
+#include <dns/rcode.h>
+#include <dns/rdata.h>
+#include <dns/rrset.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using namespace bundy::cache;
+using namespace bundy::dns;
+using namespace std;
+
+namespace {
+
+class NsecCacheTest : public testing::Test {
+protected:
+    NsecCacheTest() :
+        zone_("example.com"), msg_(Message::RENDER)
+    {}
+
+    // Make msg_ a negative response to the question, and add the SOA.
+    void makeResponse(const string& qname, const RRType& qtype,
+                      const Rcode& rcode, bool validated = true)
+    {
+        msg_.clear(Message::RENDER);
+        msg_.setRcode(rcode);
+        msg_.setHeaderFlag(Message::HEADERFLAG_QR);
+        msg_.setHeaderFlag(Message::HEADERFLAG_AD, validated);
+        msg_.addQuestion(Question(Name(qname), RRClass::IN(), qtype));
+        RRsetPtr soa(new RRset(zone_, RRClass::IN(), RRType::SOA(),
+                               RRTTL(3600)));
+        soa->addRdata(rdata::createRdata(RRType::SOA(), RRClass::IN(),
+                                         "ns.example.com. root.example.com. "
+                                         "1 3600 300 3600000 600"));
+        msg_.addRRset(Message::SECTION_AUTHORITY, soa);
+    }
+
+    // Add an NSEC record to the authority section of msg_.
+    void addNsec(const string& owner, const string& rdata,
+                 bool signed_nsec = true)
+    {
+        RRsetPtr nsec(new RRset(Name(owner), RRClass::IN(), RRType::NSEC(),
+                                RRTTL(3600)));
+        nsec->addRdata(rdata::createRdata(RRType::NSEC(), RRClass::IN(),
+                                          rdata));
+        if (signed_nsec) {
+            nsec->addRRsig(rdata::createRdata(RRType::RRSIG(), RRClass::IN(),
+                                              "NSEC 5 3 3600 20300101000000 "
+                                              "20000101000000 12345 "
+                                              "example.com. FAKEFAKEFAKE"));
+        }
+        msg_.addRRset(Message::SECTION_AUTHORITY, nsec);
+    }
+
+    // Store the usual NSEC records: the apex, proving there's no
+    // wildcard, and a.example.com, covering everything up to d.example.com.
+    void storeRanges() {
+        makeResponse("b.example.com", RRType::A(), Rcode::NXDOMAIN());
+        addNsec("example.com", "a.example.com. NS SOA RRSIG NSEC");
+        addNsec("a.example.com", "d.example.com. A RRSIG NSEC");
+        EXPECT_TRUE(cache_.update(msg_));
+        EXPECT_EQ(2, cache_.size());
+    }
+
+    // Check the synthesized response in msg_.
+    void checkResponse(const Rcode& rcode, size_t nsec_count) {
+        EXPECT_EQ(rcode, msg_.getRcode());
+        RRsetIterator it = msg_.beginSection(Message::SECTION_AUTHORITY);
+        ASSERT_TRUE(it != msg_.endSection(Message::SECTION_AUTHORITY));
+        EXPECT_EQ(RRType::SOA(), (*it)->getType());
+        EXPECT_GE(600, (*it)->getTTL().getValue());
+        size_t count = 0;
+        for (++it; it != msg_.endSection(Message::SECTION_AUTHORITY); ++it) {
+            ++count;
+            EXPECT_EQ(RRType::NSEC(), (*it)->getType());
+            EXPECT_GE(600, (*it)->getTTL().getValue());
+            ASSERT_TRUE((*it)->getRRsig());
+            EXPECT_EQ((*it)->getTTL(), (*it)->getRRsig()->getTTL());
+        }
+        EXPECT_EQ(nsec_count, count);
+    }
+
+    bool lookup(const string& qname, const RRType& qtype) {
+        msg_.clear(Message::RENDER);
+        msg_.addQuestion(Question(Name(qname), RRClass::IN(), qtype));
+        return (cache_.lookup(Name(qname), qtype, msg_));
+    }
+
+    const Name zone_;
+    Message msg_;
+    NsecCache cache_;
+};
+
+TEST_F(NsecCacheTest, nxdomain) {
+    storeRanges();
+
+    // Names in the range, including ones below names that don't exist
+    EXPECT_TRUE(lookup("b.example.com", RRType::A()));
+    checkResponse(Rcode::NXDOMAIN(), 2);
+    EXPECT_TRUE(lookup("c.example.com", RRType::AAAA()));
+    checkResponse(Rcode::NXDOMAIN(), 2);
+    EXPECT_TRUE(lookup("x.b.example.com", RRType::A()));
+    checkResponse(Rcode::NXDOMAIN(), 2);
+
+    // Names we don't know about
+    EXPECT_FALSE(lookup("e.example.com", RRType::A()));
+    EXPECT_FALSE(lookup("b.example.org", RRType::A()));
+    // The name exists
+    EXPECT_FALSE(lookup("a.example.com", RRType::A()));
+    // ... and so does the next name
+    EXPECT_FALSE(lookup("d.example.com", RRType::A()));
+
+    // The last record covers the rest of the zone.
+    makeResponse("f.example.com", RRType::A(), Rcode::NXDOMAIN());
+    addNsec("d.example.com", "example.com. A MX RRSIG NSEC");
+    EXPECT_TRUE(cache_.update(msg_));
+    EXPECT_TRUE(lookup("zzz.example.com", RRType::A()));
+    checkResponse(Rcode::NXDOMAIN(), 2);
+}
+
+TEST_F(NsecCacheTest, wildcard) {
+    // Without the proof there's no wildcard, nothing can be synthesized.
+    makeResponse("b.example.com", RRType::A(), Rcode::NXDOMAIN());
+    addNsec("a.example.com", "d.example.com. A RRSIG NSEC");
+    EXPECT_TRUE(cache_.update(msg_));
+    EXPECT_FALSE(lookup("b.example.com", RRType::A()));
+
+    // And if there's a wildcard, the name would match it.
+    makeResponse("*.example.com", RRType::MX(), Rcode::NOERROR());
+    addNsec("*.example.com", "a.example.com. A RRSIG NSEC");
+    EXPECT_TRUE(cache_.update(msg_));
+    EXPECT_FALSE(lookup("b.example.com", RRType::A()));
+}
+
+TEST_F(NsecCacheTest, nodata) {
+    storeRanges();
+
+    EXPECT_TRUE(lookup("a.example.com", RRType::MX()));
+    checkResponse(Rcode::NOERROR(), 1);
+    EXPECT_TRUE(lookup("example.com", RRType::MX()));
+    checkResponse(Rcode::NOERROR(), 1);
+
+    // Types that exist
+    EXPECT_FALSE(lookup("a.example.com", RRType::A()));
+    EXPECT_FALSE(lookup("example.com", RRType::NS()));
+    EXPECT_FALSE(lookup("a.example.com", RRType::ANY()));
+    // DS of the apex would be in the parent zone.
+    EXPECT_FALSE(lookup("example.com", RRType::DS()));
+}
+
+TEST_F(NsecCacheTest, delegation) {
+    makeResponse("sub.example.com", RRType::DS(), Rcode::NOERROR());
+    addNsec("sub.example.com", "w.example.com. NS RRSIG NSEC");
+    EXPECT_TRUE(cache_.update(msg_));
+
+    // The record proves there's no DS, but nothing else.
+    EXPECT_TRUE(lookup("sub.example.com", RRType::DS()));
+    checkResponse(Rcode::NOERROR(), 1);
+    EXPECT_FALSE(lookup("sub.example.com", RRType::A()));
+    EXPECT_FALSE(lookup("x.sub.example.com", RRType::A()));
+}
+
+TEST_F(NsecCacheTest, notStored) {
+    // Not validated
+    makeResponse("b.example.com", RRType::A(), Rcode::NXDOMAIN(), false);
+    addNsec("a.example.com", "d.example.com. A RRSIG NSEC");
+    EXPECT_FALSE(cache_.update(msg_));
+
+    // Not signed
+    makeResponse("b.example.com", RRType::A(), Rcode::NXDOMAIN());
+    addNsec("a.example.com", "d.example.com. A RRSIG NSEC", false);
+    EXPECT_FALSE(cache_.update(msg_));
+
+    // Not in the zone of the SOA
+    makeResponse("b.example.com", RRType::A(), Rcode::NXDOMAIN());
+    addNsec("a.example.org", "d.example.org. A RRSIG NSEC");
+    addNsec("a.example.com", "d.example.org. A RRSIG NSEC");
+    EXPECT_FALSE(cache_.update(msg_));
+
+    // Not a negative response
+    makeResponse("b.example.com", RRType::A(), Rcode::SERVFAIL());
+    addNsec("a.example.com", "d.example.com. A RRSIG NSEC");
+    EXPECT_FALSE(cache_.update(msg_));
+
+    EXPECT_EQ(0, cache_.size());
+}
+
+TEST_F(NsecCacheTest, full) {
+    NsecCache cache(1);
+    makeResponse("b.example.com", RRType::A(), Rcode::NXDOMAIN());
+    addNsec("example.com", "a.example.com. NS SOA RRSIG NSEC");
+    addNsec("a.example.com", "d.example.com. A RRSIG NSEC");
+    EXPECT_TRUE(cache.update(msg_));
+    EXPECT_EQ(1, cache.size());
+
+    // An existing record can still be replaced.
+    EXPECT_TRUE(cache.update(msg_));
+    EXPECT_EQ(1, cache.size());
+}
+
+TEST_F(NsecCacheTest, resolverCache) {
+    ResolverCache cache;
+    makeResponse("b.example.com", RRType::A(), Rcode::NXDOMAIN());
+    addNsec("example.com", "a.example.com. NS SOA RRSIG NSEC");
+    addNsec("a.example.com", "d.example.com. A RRSIG NSEC");
+
+    // Disabled by default
+    EXPECT_FALSE(cache.updateNegative(msg_));
+
+    cache.setAggressiveNsec(true);
+    EXPECT_TRUE(cache.updateNegative(msg_));
+    Message response(Message::RENDER);
+    response.addQuestion(Question(Name("c.example.com"), RRClass::IN(),
+                                  RRType::A()));
+    EXPECT_TRUE(cache.lookupNegative(Name("c.example.com"), RRType::A(),
+                                     RRClass::IN(), response));
+    EXPECT_EQ(Rcode::NXDOMAIN(), response.getRcode());
+    EXPECT_FALSE(cache.lookupNegative(Name("c.example.com"), RRType::A(),
+                                      RRClass::CH(), response));
+
+    // Disabling stops using the records.
+    cache.setAggressiveNsec(false);
+    EXPECT_FALSE(cache.lookupNegative(Name("c.example.com"), RRType::A(),
+                                      RRClass::IN(), response));
+}
+
+}
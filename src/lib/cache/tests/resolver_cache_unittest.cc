@@ -14,8 +14,12 @@
 
 #include <config.h>
 #include <string>
+#include <fstream>
+#include <iterator>
 #include <gtest/gtest.h>
 #include <dns/rrset.h>
+#include <util/time_utilities.h>
+#include <stdio.h>
 #include "resolver_cache.h"
 #include "cache_test_messagefromfile.h"
 #include "cache_test_sectioncount.h"
@@ -44,6 +48,22 @@ public:
     ResolverCache* cache;
 };
 
+const char* const SNAPSHOT_FILE = TEST_DATA_BUILDDIR "/cache_snapshot.tmp";
+
+// Pretend the snapshot file was saved the given number of seconds ago.
+void
+ageSnapshot(uint64_t seconds) {
+    const uint64_t saved = bundy::util::CoarseClock::getTime() - seconds;
+    uint8_t data[8];
+    for (int i = 0; i < 8; ++i) {
+        data[i] = saved >> (56 - i * 8);
+    }
+    std::fstream fs(SNAPSHOT_FILE, std::ios::in | std::ios::out |
+                    std::ios::binary);
+    fs.seekp(8);
+    fs.write(reinterpret_cast<const char*>(data), sizeof(data));
+}
+
 TEST_F(ResolverCacheTest, testUpdateMessage) {
     Message msg(Message::PARSE);
     messageFromFile(msg, "message_fromWire3");
@@ -125,4 +145,79 @@ TEST_F(ResolverCacheTest, testLookupClosestRRset) {
     EXPECT_FALSE(rrset_ptr);
 }
 
+TEST_F(ResolverCacheTest, snapshot) {
+    Message msg(Message::PARSE);
+    messageFromFile(msg, "message_fromWire3");
+    cache->update(msg);
+    const Name qname("example.com.");
+    const RRsetPtr ns = cache->lookup(qname, RRType::NS(), RRClass::IN());
+    ASSERT_TRUE(ns);
+    const uint32_t ttl = ns->getTTL().getValue();
+
+    bundy::nsas::AddressRTTs rtts;
+    rtts["192.0.2.1"] = 100;
+    rtts["2001:db8::1"] = 2000;
+    EXPECT_LT(0, cache->saveSnapshot(SNAPSHOT_FILE, rtts));
+
+    // Load it into a new cache, as if it had been saved 10 seconds ago.
+    ageSnapshot(10);
+    ResolverCache new_cache;
+    bundy::nsas::AddressRTTs loaded_rtts;
+    EXPECT_LT(0, new_cache.loadSnapshot(SNAPSHOT_FILE, loaded_rtts));
+    EXPECT_TRUE(rtts == loaded_rtts);
+
+    // Both the RRsets and the message are there, with the TTLs decreased.
+    const RRsetPtr loaded_ns = new_cache.lookup(qname, RRType::NS(),
+                                                RRClass::IN());
+    ASSERT_TRUE(loaded_ns);
+    EXPECT_EQ(ns->getRdataCount(), loaded_ns->getRdataCount());
+    EXPECT_GE(ttl - 10, loaded_ns->getTTL().getValue());
+    EXPECT_LE(ttl - 12, loaded_ns->getTTL().getValue());
+    Message response(Message::PARSE);
+    messageFromFile(response, "message_fromWire3");
+    response.makeResponse();
+    EXPECT_TRUE(new_cache.lookup(qname, RRType::SOA(), RRClass::IN(),
+                                 response));
+
+    // Data that has expired in the meantime isn't loaded.
+    ResolverCache expired_cache;
+    ageSnapshot(1000000000);
+    loaded_rtts.clear();
+    EXPECT_EQ(0, expired_cache.loadSnapshot(SNAPSHOT_FILE, loaded_rtts));
+    EXPECT_FALSE(expired_cache.lookup(qname, RRType::NS(), RRClass::IN()));
+    EXPECT_TRUE(rtts == loaded_rtts);
+
+    remove(SNAPSHOT_FILE);
+}
+
+TEST_F(ResolverCacheTest, badSnapshot) {
+    bundy::nsas::AddressRTTs rtts;
+    remove(SNAPSHOT_FILE);
+    EXPECT_THROW(cache->loadSnapshot(SNAPSHOT_FILE, rtts), CacheSnapshotError);
+
+    {
+        std::ofstream os(SNAPSHOT_FILE);
+        os << "this is not a cache snapshot";
+    }
+    EXPECT_THROW(cache->loadSnapshot(SNAPSHOT_FILE, rtts), CacheSnapshotError);
+
+    // A truncated snapshot.
+    Message msg(Message::PARSE);
+    messageFromFile(msg, "message_fromWire3");
+    cache->update(msg);
+    cache->saveSnapshot(SNAPSHOT_FILE, rtts);
+    std::ifstream is(SNAPSHOT_FILE, std::ios::binary);
+    const std::string data((std::istreambuf_iterator<char>(is)),
+                           std::istreambuf_iterator<char>());
+    is.close();
+    {
+        std::ofstream os(SNAPSHOT_FILE, std::ios::binary | std::ios::trunc);
+        os.write(data.c_str(), data.size() - 1);
+    }
+    ResolverCache new_cache;
+    EXPECT_THROW(new_cache.loadSnapshot(SNAPSHOT_FILE, rtts),
+                 CacheSnapshotError);
+    remove(SNAPSHOT_FILE);
+}
+
 }
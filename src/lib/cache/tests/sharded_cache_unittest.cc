@@ -0,0 +1,214 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <cache/sharded_cache.h>
+#include <util/threads/thread.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace bundy::cache;
+using bundy::util::thread::Thread;
+using boost::lexical_cast;
+using std::string;
+
+namespace {
+
+typedef ShardedCache<int> IntCache;
+typedef IntCache::EntryPtr IntPtr;
+
+IntPtr
+makeEntry(int value) {
+    return (IntPtr(new int(value)));
+}
+
+// The sum of the statistics of all shards.
+CacheShardStats
+getTotalStats(const IntCache& cache) {
+    CacheShardStats total;
+    for (size_t i = 0; i < cache.getShardCount(); ++i) {
+        const CacheShardStats stats = cache.getShardStats(i);
+        total.entries += stats.entries;
+        total.bytes += stats.bytes;
+        total.hits += stats.hits;
+        total.misses += stats.misses;
+        total.evictions += stats.evictions;
+    }
+    return (total);
+}
+
+TEST(ShardedCacheTest, addAndGet) {
+    IntCache cache(10);
+    EXPECT_FALSE(cache.get("a"));
+    EXPECT_TRUE(cache.add("a", makeEntry(1), 10));
+    EXPECT_TRUE(cache.add("b", makeEntry(2), 20));
+    EXPECT_EQ(2, cache.size());
+    ASSERT_TRUE(cache.get("a"));
+    EXPECT_EQ(1, *cache.get("a"));
+    EXPECT_EQ(2, *cache.get("b"));
+
+    // Replace an entry.
+    EXPECT_TRUE(cache.add("a", makeEntry(3), 30));
+    EXPECT_EQ(3, *cache.get("a"));
+    EXPECT_EQ(2, cache.size());
+
+    const CacheShardStats stats = getTotalStats(cache);
+    EXPECT_EQ(2, stats.entries);
+    EXPECT_EQ(50, stats.bytes);
+    EXPECT_EQ(4, stats.hits);
+    EXPECT_EQ(1, stats.misses);
+    EXPECT_EQ(0, stats.evictions);
+
+    EXPECT_TRUE(cache.remove("a"));
+    EXPECT_FALSE(cache.remove("a"));
+    EXPECT_FALSE(cache.get("a"));
+    EXPECT_EQ(1, cache.size());
+    EXPECT_EQ(20, getTotalStats(cache).bytes);
+
+    cache.clear();
+    EXPECT_EQ(0, cache.size());
+    EXPECT_EQ(0, getTotalStats(cache).bytes);
+    EXPECT_FALSE(cache.get("b"));
+}
+
+TEST(ShardedCacheTest, getEntries) {
+    IntCache cache(100000, 0, 4);
+    std::vector<IntPtr> entries;
+    cache.getEntries(entries);
+    EXPECT_TRUE(entries.empty());
+
+    for (int i = 0; i < 100; ++i) {
+        cache.add(lexical_cast<string>(i), makeEntry(i), 1);
+    }
+    cache.getEntries(entries);
+    ASSERT_EQ(100, entries.size());
+    std::vector<bool> found(100, false);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        ASSERT_LE(0, *entries[i]);
+        ASSERT_GT(100, *entries[i]);
+        EXPECT_FALSE(found[*entries[i]]);
+        found[*entries[i]] = true;
+    }
+}
+
+TEST(ShardedCacheTest, shards) {
+    // Small caches use a single shard.
+    EXPECT_EQ(1, IntCache(10).getShardCount());
+    EXPECT_EQ(1, IntCache(IntCache::MIN_SHARD_ENTRIES * 2, 0, 1).
+              getShardCount());
+    EXPECT_EQ(2, IntCache(IntCache::MIN_SHARD_ENTRIES * 2).getShardCount());
+    EXPECT_EQ(IntCache::DEFAULT_SHARDS, IntCache(100000).getShardCount());
+    EXPECT_EQ(4, IntCache(100000, 0, 4).getShardCount());
+    EXPECT_EQ(1, IntCache(0).getShardCount());
+
+    // Entries are spread over the shards.
+    IntCache cache(100000, 0, 4);
+    for (int i = 0; i < 1000; ++i) {
+        cache.add(lexical_cast<string>(i), makeEntry(i), 1);
+    }
+    for (size_t i = 0; i < cache.getShardCount(); ++i) {
+        EXPECT_LT(100, cache.getShardStats(i).entries);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(cache.get(lexical_cast<string>(i)));
+        EXPECT_EQ(i, *cache.get(lexical_cast<string>(i)));
+    }
+}
+
+TEST(ShardedCacheTest, clockEviction) {
+    IntCache cache(3);
+    cache.add("a", makeEntry(1), 1);
+    cache.add("b", makeEntry(2), 1);
+    cache.add("c", makeEntry(3), 1);
+
+    // "a" was looked up, so it gets a second chance and "b" is evicted.
+    cache.get("a");
+    cache.add("d", makeEntry(4), 1);
+    EXPECT_EQ(3, cache.size());
+    EXPECT_TRUE(cache.get("a"));
+    EXPECT_FALSE(cache.get("b"));
+    EXPECT_TRUE(cache.get("c"));
+    EXPECT_TRUE(cache.get("d"));
+
+    // Now all of them are referenced; the hand clears the marks and comes
+    // back to the next one after the last eviction.
+    cache.add("e", makeEntry(5), 1);
+    EXPECT_EQ(3, cache.size());
+    EXPECT_FALSE(cache.get("c"));
+    EXPECT_EQ(2, getTotalStats(cache).evictions);
+}
+
+TEST(ShardedCacheTest, byteBudget) {
+    IntCache cache(100, 100);
+    EXPECT_TRUE(cache.add("a", makeEntry(1), 40));
+    EXPECT_TRUE(cache.add("b", makeEntry(2), 40));
+
+    // No room for 40 more bytes: "a" is evicted.
+    EXPECT_TRUE(cache.add("c", makeEntry(3), 40));
+    EXPECT_FALSE(cache.get("a"));
+    EXPECT_EQ(80, getTotalStats(cache).bytes);
+
+    // Entries larger than the whole budget aren't stored.  An old entry
+    // of the key is still removed.
+    EXPECT_FALSE(cache.add("b", makeEntry(4), 101));
+    EXPECT_FALSE(cache.get("b"));
+    EXPECT_TRUE(cache.get("c"));
+    EXPECT_EQ(40, getTotalStats(cache).bytes);
+
+    // One large one may evict several.
+    EXPECT_TRUE(cache.add("d", makeEntry(5), 20));
+    EXPECT_TRUE(cache.add("e", makeEntry(6), 100));
+    EXPECT_EQ(1, cache.size());
+    EXPECT_EQ(100, getTotalStats(cache).bytes);
+}
+
+void
+lookupEntries(IntCache* cache, int count, int* found) {
+    for (int i = 0; i < count; ++i) {
+        const IntPtr entry = cache->get(lexical_cast<string>(i % 100));
+        if (entry && *entry == i % 100) {
+            ++*found;
+        }
+    }
+}
+
+TEST(ShardedCacheTest, concurrentLookups) {
+    IntCache cache(100000);
+    for (int i = 0; i < 100; ++i) {
+        cache.add(lexical_cast<string>(i), makeEntry(i), 1);
+    }
+    const int THREADS = 4;
+    const int LOOKUPS = 10000;
+    std::vector<int> found(THREADS);
+    std::vector<boost::shared_ptr<Thread> > threads;
+    for (int i = 0; i < THREADS; ++i) {
+        threads.push_back(boost::shared_ptr<Thread>(
+                              new Thread(boost::bind(lookupEntries, &cache,
+                                                     LOOKUPS, &found[i]))));
+    }
+    for (int i = 0; i < THREADS; ++i) {
+        threads[i]->wait();
+        EXPECT_EQ(LOOKUPS, found[i]);
+    }
+    EXPECT_EQ(THREADS * LOOKUPS, getTotalStats(cache).hits);
+}
+}
@@ -16,6 +16,8 @@
 
 #include <cc/data.h>
 
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <cassert>
 #include <climits>
@@ -29,6 +31,8 @@
 
 #include <boost/algorithm/string.hpp> // for iequals
 #include <boost/lexical_cast.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/noncopyable.hpp>
 
 #include <cmath>
 
@@ -502,6 +506,377 @@ fromStringstreamMap(std::istream& in, const std::string& file, int& line,
     }
     return (map);
 }
+
+// Memory for the elements (and their reference counts) of a tree parsed
+// by fromJSON() with use_arena.  It is only ever allocated from while
+// the tree is being parsed, and each element holds a reference to it,
+// so the chunks are freed together with the last element of the tree.
+const size_t ARENA_CHUNK_SIZE = 64 * 1024;
+const size_t ARENA_ALIGNMENT = 16;
+
+class ElementArena : boost::noncopyable {
+public:
+    ElementArena() : current_(NULL), left_(0) {}
+    ~ElementArena() {
+        for (std::vector<char*>::const_iterator it = chunks_.begin();
+             it != chunks_.end(); ++it) {
+            delete[] *it;
+        }
+    }
+    void* allocate(size_t size) {
+        size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+        if (size > left_) {
+            const size_t chunk_size = std::max(size, ARENA_CHUNK_SIZE);
+            chunks_.reserve(chunks_.size() + 1);
+            chunks_.push_back(new char[chunk_size]);
+            current_ = chunks_.back();
+            left_ = chunk_size;
+        }
+        void* const result = current_;
+        current_ += size;
+        left_ -= size;
+        return (result);
+    }
+private:
+    std::vector<char*> chunks_;
+    char* current_;
+    size_t left_;
+};
+
+// The allocator passed to boost::allocate_shared for arena elements.
+// Memory is never given back one by one, only with the whole arena.
+template <typename T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+    template <typename U>
+    struct rebind {
+        typedef ArenaAllocator<U> other;
+    };
+
+    explicit ArenaAllocator(const boost::shared_ptr<ElementArena>& arena) :
+        arena_(arena)
+    {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) :
+        arena_(other.getArena())
+    {}
+
+    T* allocate(size_t n) {
+        return (static_cast<T*>(arena_->allocate(n * sizeof(T))));
+    }
+    void deallocate(T*, size_t) {}
+
+    const boost::shared_ptr<ElementArena>& getArena() const {
+        return (arena_);
+    }
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const {
+        return (arena_ == other.getArena());
+    }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const {
+        return (arena_ != other.getArena());
+    }
+private:
+    boost::shared_ptr<ElementArena> arena_;
+};
+
+inline bool
+isWhitespace(const char c) {
+    switch (c) {
+    case ' ':
+    case '\b':
+    case '\f':
+    case '\n':
+    case '\r':
+    case '\t':
+        return (true);
+    default:
+        return (false);
+    }
+}
+
+// The parser behind fromJSON() on a contiguous buffer.  It accepts the
+// same syntax as the stream based parser above and throws the same
+// errors; the line and position of an error are reported in the same
+// way too (the position is one past the characters consumed on the
+// line, where reading the end of the data counts as one), but they are
+// only counted once an error is found.
+class JSONBufferParser {
+public:
+    JSONBufferParser(const char* data, size_t length, const std::string& file,
+                     bool use_arena) :
+        begin_(data), current_(data), end_(data + length), file_(file)
+    {
+        if (use_arena) {
+            arena_.reset(new ElementArena);
+        }
+    }
+
+    ElementPtr parseElement() {
+        skipWhitespace();
+        if (current_ == end_) {
+            bundy_throw(JSONError, "nothing read");
+        }
+        const char c = *current_;
+        switch (c) {
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+        case '0':
+        case '-':
+        case '+':
+        case '.':
+            return (parseNumber());
+        case 't':
+        case 'T':
+        case 'f':
+        case 'F':
+            return (parseBool());
+        case 'n':
+        case 'N':
+            return (parseNull());
+        case '"':
+            return (create<StringElement>(parseString()));
+        case '[':
+            ++current_;
+            return (parseList());
+        case '{':
+            ++current_;
+            return (parseMap());
+        default:
+            throwError(std::string("error: unexpected character ") +
+                       std::string(1, c), current_ + 1);
+        }
+        return (ElementPtr());  // shouldn't reach here
+    }
+
+    void checkEnd() {
+        skipWhitespace();
+        if (current_ != end_) {
+            throwError("Extra data", current_);
+        }
+    }
+
+private:
+    template <typename ElementType>
+    ElementPtr create() {
+        if (arena_) {
+            return (boost::allocate_shared<ElementType>(
+                        ArenaAllocator<ElementType>(arena_)));
+        }
+        return (ElementPtr(new ElementType()));
+    }
+
+    template <typename ElementType, typename ValueType>
+    ElementPtr create(const ValueType& value) {
+        if (arena_) {
+            return (boost::allocate_shared<ElementType>(
+                        ArenaAllocator<ElementType>(arena_), value));
+        }
+        return (ElementPtr(new ElementType(value)));
+    }
+
+    void throwError(const std::string& error, const char* at) const {
+        int line = 1;
+        const char* line_start = begin_;
+        for (const char* p = begin_; p < at && p < end_; ++p) {
+            if (*p == '\n') {
+                ++line;
+                line_start = p + 1;
+            }
+        }
+        throwJSONError(error, file_, line, at - line_start + 1);
+    }
+
+    void skipWhitespace() {
+        while (current_ != end_ && isWhitespace(*current_)) {
+            ++current_;
+        }
+    }
+
+    // Skips whitespace and one of the given characters, which it
+    // returns.
+    char skipTo(const char* chars) {
+        skipWhitespace();
+        if (current_ == end_) {
+            throwError(std::string("EOF read, one of \"") + chars +
+                       "\" expected", current_ + 1);
+        }
+        const char c = *current_++;
+        if (std::strchr(chars, c) == NULL) {
+            throwError(std::string("'") + std::string(1, c) +
+                       "' read, one of \"" + chars + "\" expected", current_);
+        }
+        return (c);
+    }
+
+    std::string parseWord() {
+        const char* const start = current_;
+        while (current_ != end_ &&
+               isalpha(static_cast<unsigned char>(*current_))) {
+            ++current_;
+        }
+        return (std::string(start, current_));
+    }
+
+    ElementPtr parseNumber() {
+        const char* const start = current_;
+        while (current_ != end_ &&
+               (isdigit(static_cast<unsigned char>(*current_)) ||
+                charIn(*current_, "+-.eE"))) {
+            ++current_;
+        }
+        const std::string number(start, current_);
+        char* number_end;
+        errno = 0;
+        if (number.find_first_of(".eE") != std::string::npos) {
+            const double d = std::strtod(number.c_str(), &number_end);
+            if (errno == 0 && number_end == number.c_str() + number.size()) {
+                return (create<DoubleElement>(d));
+            }
+        } else {
+            const long long i = std::strtoll(number.c_str(), &number_end, 10);
+            if (errno == 0 && number_end == number.c_str() + number.size()) {
+                return (create<IntElement>(static_cast<int64_t>(i)));
+            }
+        }
+        bundy_throw(JSONError, std::string("Number overflow: ") + number);
+    }
+
+    ElementPtr parseBool() {
+        const std::string word = parseWord();
+        if (boost::iequals(word, "True")) {
+            return (create<BoolElement>(true));
+        } else if (boost::iequals(word, "False")) {
+            return (create<BoolElement>(false));
+        }
+        throwError(std::string("Bad boolean value: ") + word, current_);
+        return (ElementPtr());
+    }
+
+    ElementPtr parseNull() {
+        const std::string word = parseWord();
+        if (boost::iequals(word, "null")) {
+            return (create<NullElement>());
+        }
+        throwError(std::string("Bad null value: ") + word, current_);
+        return (ElementPtr());
+    }
+
+    // The unescaped parts of the string are found with memchr() and
+    // copied in one go.
+    std::string parseString() {
+        if (current_ == end_ || *current_ != '"') {
+            throwError("String expected", current_ + 1);
+        }
+        ++current_;
+        std::string result;
+        const char* quote = NULL;
+        while (true) {
+            if (quote < current_) {
+                quote = static_cast<const char*>(
+                    std::memchr(current_, '"', end_ - current_));
+                if (quote == NULL) {
+                    quote = end_;
+                }
+            }
+            const char* stop = static_cast<const char*>(
+                std::memchr(current_, '\\', quote - current_));
+            if (stop == NULL) {
+                stop = quote;
+            }
+            result.append(current_, stop);
+            current_ = stop;
+            if (current_ == end_) {
+                throwError("Unterminated string", current_ + 1);
+            }
+            if (*current_ == '"') {
+                ++current_;
+                return (result);
+            }
+            // see the spec for allowed escape characters
+            char c = 0;
+            switch (current_ + 1 == end_ ? 0 : current_[1]) {
+            case '"':
+                c = '"';
+                break;
+            case '/':
+                c = '/';
+                break;
+            case '\\':
+                c = '\\';
+                break;
+            case 'b':
+                c = '\b';
+                break;
+            case 'f':
+                c = '\f';
+                break;
+            case 'n':
+                c = '\n';
+                break;
+            case 'r':
+                c = '\r';
+                break;
+            case 't':
+                c = '\t';
+                break;
+            default:
+                throwError("Bad escape", current_ + 1);
+            }
+            result.push_back(c);
+            current_ += 2;
+        }
+    }
+
+    ElementPtr parseList() {
+        ElementPtr list = create<ListElement>();
+        skipWhitespace();
+        while (current_ == end_ || *current_ != ']') {
+            list->add(parseElement());
+            if (skipTo(",]") == ']') {
+                return (list);
+            }
+            skipWhitespace();
+        }
+        ++current_;
+        return (list);
+    }
+
+    ElementPtr parseMap() {
+        ElementPtr map = create<MapElement>();
+        skipWhitespace();
+        if (current_ == end_) {
+            throwError("Unterminated map, <string> or } expected",
+                       current_);
+        } else if (*current_ == '}') {
+            // empty map, skip closing curly
+            ++current_;
+            return (map);
+        }
+        do {
+            skipWhitespace();
+            const std::string key = parseString();
+            skipTo(":");
+            map->set(key, parseElement());
+        } while (skipTo(",}") != '}');
+        return (map);
+    }
+
+    const char* const begin_;
+    const char* current_;
+    const char* const end_;
+    const std::string& file_;
+    boost::shared_ptr<ElementArena> arena_;
+};
 } // unnamed namespace
 
 std::string
@@ -643,16 +1018,18 @@ Element::fromJSON(std::istream& in, const std::string& file, int& line,
 
 ElementPtr
 Element::fromJSON(const std::string& in) {
-    std::stringstream ss;
-    ss << in;
-    int line = 1, pos = 1;
-    ElementPtr result(fromJSON(ss, "<string>", line, pos));
-    skipChars(ss, WHITESPACE, line, pos);
-    // ss must now be at end
-    if (ss.peek() != EOF) {
-        throwJSONError("Extra data", "<string>", line, pos);
-    }
-    return result;
+    return (fromJSON(in.data(), in.size(), "<string>"));
+}
+
+ElementPtr
+Element::fromJSON(const char* data, size_t length, const std::string& file,
+                  bool use_arena)
+{
+    JSONBufferParser parser(data, length, file, use_arena);
+    ElementPtr result(parser.parseElement());
+    // the buffer must now be at end
+    parser.checkEnd();
+    return (result);
 }
 
 // to JSON format
@@ -802,6 +1179,224 @@ Element::fromWire(std::stringstream& in, int) {
     return (fromJSON(in, "<wire>", line, pos));
 }
 
+const uint8_t Element::BINARY_WIRE_MARKER;
+
+namespace {
+// The type bytes of the binary wire format
+enum BinaryWireType {
+    BINARY_NULL = 0,
+    BINARY_FALSE = 1,
+    BINARY_TRUE = 2,
+    BINARY_INTEGER = 3,
+    BINARY_REAL = 4,
+    BINARY_STRING = 5,
+    BINARY_LIST = 6,
+    BINARY_MAP = 7
+};
+
+void
+putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void
+putString(std::vector<uint8_t>& out, const std::string& str) {
+    putVarint(out, str.size());
+    out.insert(out.end(), str.begin(), str.end());
+}
+
+void
+putElement(std::vector<uint8_t>& out, const Element& element) {
+    switch (element.getType()) {
+    case Element::null:
+        out.push_back(BINARY_NULL);
+        break;
+    case Element::boolean:
+        out.push_back(element.boolValue() ? BINARY_TRUE : BINARY_FALSE);
+        break;
+    case Element::integer:
+    {
+        const int64_t value = element.intValue();
+        out.push_back(BINARY_INTEGER);
+        putVarint(out, (static_cast<uint64_t>(value) << 1) ^
+                  static_cast<uint64_t>(value >> 63));
+        break;
+    }
+    case Element::real:
+    {
+        const double value = element.doubleValue();
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        out.push_back(BINARY_REAL);
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            out.push_back(static_cast<uint8_t>(bits >> shift));
+        }
+        break;
+    }
+    case Element::string:
+        out.push_back(BINARY_STRING);
+        putString(out, element.stringValue());
+        break;
+    case Element::list:
+    {
+        const std::vector<ConstElementPtr>& list = element.listValue();
+        out.push_back(BINARY_LIST);
+        putVarint(out, list.size());
+        for (std::vector<ConstElementPtr>::const_iterator it = list.begin();
+             it != list.end(); ++it) {
+            putElement(out, **it);
+        }
+        break;
+    }
+    case Element::map:
+    {
+        const std::map<std::string, ConstElementPtr>& map =
+            element.mapValue();
+        out.push_back(BINARY_MAP);
+        putVarint(out, map.size());
+        for (std::map<std::string, ConstElementPtr>::const_iterator it =
+                 map.begin(); it != map.end(); ++it) {
+            putString(out, it->first);
+            putElement(out, *it->second);
+        }
+        break;
+    }
+    default:
+        bundy_throw(TypeError, "Element of unknown type in binary wire format");
+    }
+}
+
+// Decodes the binary wire format, with the current position in the data.
+class BinaryWireReader {
+public:
+    BinaryWireReader(const uint8_t* data, size_t length) :
+        current_(data), end_(data + length)
+    {}
+
+    bool atEnd() const {
+        return (current_ == end_);
+    }
+
+    uint8_t getByte() {
+        if (current_ == end_) {
+            bundy_throw(DecodeError, "Binary wire format is truncated");
+        }
+        return (*current_++);
+    }
+
+    uint64_t getVarint() {
+        uint64_t value = 0;
+        for (unsigned int shift = 0; shift < 64; shift += 7) {
+            const uint8_t byte = getByte();
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return (value);
+            }
+        }
+        bundy_throw(DecodeError, "Binary wire format integer is too long");
+    }
+
+    // Return the size of a string or a container, which can't be larger
+    // than the rest of the data (each element takes at least a byte).
+    size_t getSize() {
+        const uint64_t size = getVarint();
+        if (size > static_cast<uint64_t>(end_ - current_)) {
+            bundy_throw(DecodeError, "Binary wire format size is too large");
+        }
+        return (static_cast<size_t>(size));
+    }
+
+    std::string getString() {
+        const size_t size = getSize();
+        const char* const data = reinterpret_cast<const char*>(current_);
+        current_ += size;
+        return (std::string(data, size));
+    }
+
+    ElementPtr getElement() {
+        switch (getByte()) {
+        case BINARY_NULL:
+            return (Element::create());
+        case BINARY_FALSE:
+            return (Element::create(false));
+        case BINARY_TRUE:
+            return (Element::create(true));
+        case BINARY_INTEGER:
+        {
+            const uint64_t value = getVarint();
+            return (Element::create(static_cast<long long int>(
+                (value >> 1) ^ (~(value & 1) + 1))));
+        }
+        case BINARY_REAL:
+        {
+            uint64_t bits = 0;
+            for (int i = 0; i < 8; ++i) {
+                bits = (bits << 8) | getByte();
+            }
+            double value;
+            memcpy(&value, &bits, sizeof(value));
+            return (Element::create(value));
+        }
+        case BINARY_STRING:
+            return (Element::create(getString()));
+        case BINARY_LIST:
+        {
+            ElementPtr list = Element::createList();
+            for (size_t count = getSize(); count > 0; --count) {
+                list->add(getElement());
+            }
+            return (list);
+        }
+        case BINARY_MAP:
+        {
+            ElementPtr map = Element::createMap();
+            for (size_t count = getSize(); count > 0; --count) {
+                const std::string key = getString();
+                map->set(key, getElement());
+            }
+            return (map);
+        }
+        default:
+            bundy_throw(DecodeError, "Unknown type in binary wire format");
+        }
+    }
+
+private:
+    const uint8_t* current_;
+    const uint8_t* const end_;
+};
+}
+
+void
+Element::toBinaryWire(std::vector<uint8_t>& out) const {
+    out.push_back(BINARY_WIRE_MARKER);
+    putElement(out, *this);
+}
+
+bool
+Element::isBinaryWire(const void* data, size_t length) {
+    return (length > 0 &&
+            *static_cast<const uint8_t*>(data) == BINARY_WIRE_MARKER);
+}
+
+ElementPtr
+Element::fromBinaryWire(const void* data, size_t length) {
+    if (!isBinaryWire(data, length)) {
+        bundy_throw(DecodeError, "Not in binary wire format");
+    }
+    BinaryWireReader reader(static_cast<const uint8_t*>(data) + 1,
+                            length - 1);
+    ElementPtr element = reader.getElement();
+    if (!reader.atEnd()) {
+        bundy_throw(DecodeError, "Trailing data after binary wire format");
+    }
+    return (element);
+}
+
 void
 MapElement::set(const std::string& key, ConstElementPtr value) {
     m[key] = value;
@@ -21,6 +21,7 @@
 #include <boost/shared_ptr.hpp>
 #include <stdexcept>
 #include <exceptions/exceptions.h>
+#include <stdint.h>
 
 namespace bundy { namespace data {
 
@@ -53,6 +54,16 @@ public:
         bundy::Exception(file, line, what) {}
 };
 
+///
+/// \brief A standard Data module exception that is thrown if an Element
+/// can't be decoded from the binary wire format
+///
+class DecodeError : public bundy::Exception {
+public:
+    DecodeError(const char* file, size_t line, const char* what) :
+        bundy::Exception(file, line, what) {}
+};
+
 ///
 /// \brief The \c Element class represents a piece of data, used by
 /// the command channel and configuration parts.
@@ -336,6 +347,34 @@ public:
     /// in the given input stream.
     // make this one private?
     static ElementPtr fromJSON(std::istream& in, const std::string& file, int& line, int &pos) throw(JSONError);
+
+    /// Creates an Element from JSON formatted data in a contiguous
+    /// buffer.
+    ///
+    /// This accepts the same syntax as the stream based versions, but
+    /// works in a single pass over the buffer (string bodies are
+    /// located with \c memchr() rather than read character by
+    /// character), and only computes the line and position when it
+    /// needs to report an error.  The whole buffer must be a single
+    /// element, optionally surrounded by whitespace.
+    ///
+    /// If \c use_arena is true, the elements of the resulting tree are
+    /// allocated (along with their reference counts) from a set of
+    /// large memory chunks which are shared by the whole tree, rather
+    /// than one by one.  The chunks are only freed when the last of
+    /// those elements is destroyed, so this is meant for trees that are
+    /// kept (or dropped) as a whole, like a full configuration; holding
+    /// on to a small part of such a tree keeps all of its memory.
+    ///
+    /// \param data The JSON text; it doesn't have to be nul-terminated.
+    /// \param length The length of \c data.
+    /// \param file The name to use for \c data in error messages.
+    /// \param use_arena Whether to allocate the elements from an arena.
+    /// \return An ElementPtr that contains the element(s) specified
+    /// in the given buffer.
+    static ElementPtr fromJSON(const char* data, size_t length,
+                               const std::string& file = "<buffer>",
+                               bool use_arena = false);
     //@}
 
     /// \name Type name conversion functions
@@ -379,6 +418,45 @@ public:
     /// \return ElementPtr with the data that is parsed.
     static ElementPtr fromWire(const std::string& s);
     //@}
+
+    /// \name Binary wire format
+    ///
+    /// A compact alternative to the JSON wire format, which is encoded
+    /// and decoded without building intermediate strings.  It starts
+    /// with \c BINARY_WIRE_MARKER, which can't start JSON text, so the
+    /// two formats can be told apart.  Each element is a type byte
+    /// followed by its value: nothing for null and booleans, a zigzag
+    /// encoded variable length integer (7 bits per byte, least
+    /// significant first) for integers, 8 bytes of network order IEEE
+    /// 754 for reals, and a variable length size followed by the bytes,
+    /// elements, or key (size and bytes) and element pairs for strings,
+    /// lists and maps respectively.
+    //@{
+    /// \brief The first byte of the binary wire format.
+    static const uint8_t BINARY_WIRE_MARKER = 0xb1;
+
+    /// Appends the binary wire format of the Element and all its child
+    /// elements to the given buffer.
+    ///
+    /// \param out The buffer to append to.
+    void toBinaryWire(std::vector<uint8_t>& out) const;
+
+    /// Returns whether the given data is in the binary wire format (as
+    /// opposed to JSON).
+    ///
+    /// \param data The wire data.
+    /// \param length The length of \c data.
+    static bool isBinaryWire(const void* data, size_t length);
+
+    /// Creates an Element from the binary wire format.
+    ///
+    /// \throw DecodeError the data is not valid binary wire format.
+    ///
+    /// \param data The wire data, starting with \c BINARY_WIRE_MARKER.
+    /// \param length The length of \c data.
+    /// \return ElementPtr with the data that is decoded.
+    static ElementPtr fromBinaryWire(const void* data, size_t length);
+    //@}
 };
 
 /// Notes: IntElement type is changed to int64_t.
@@ -32,6 +32,7 @@ const char* const CC_HEADER_INSTANCE = "instance";
 const char* const CC_HEADER_SEQ = "seq";
 const char* const CC_HEADER_WANT_ANSWER = "want_answer";
 const char* const CC_HEADER_REPLY = "reply";
+const char* const CC_HEADER_BINARY = "binary";
 // The commands in the "type" header
 const char* const CC_COMMAND_SEND = "send";
 const char* const CC_COMMAND_SUBSCRIBE = "subscribe";
@@ -74,7 +74,7 @@ namespace cc {
 class SessionImpl {
 public:
     SessionImpl(io_service& io_service) :
-        sequence_(-1), queue_(Element::createList()),
+        sequence_(-1), queue_(Element::createList()), binary_wire_(false),
         io_service_(io_service), socket_(io_service_), data_length_(0),
         timeout_(MSGQ_DEFAULT_TIMEOUT)
     {}
@@ -93,6 +93,8 @@ public:
     long int sequence_; // the next sequence number to use
     std::string lname_;
     ElementPtr queue_;
+    // Whether the msgq accepts payloads in the binary wire format
+    bool binary_wire_;
 
 private:
     void internalRead(const asio::error_code& error,
@@ -284,6 +286,11 @@ Session::startRead(boost::function<void()> read_callback) {
     impl_->startRead(read_callback);
 }
 
+bool
+Session::usesBinaryWire() const {
+    return (impl_->binary_wire_);
+}
+
 int
 Session::getSocketDesc() const {
     return impl_->getSocketDesc();
@@ -323,16 +330,21 @@ Session::establish(const char* socket_file) {
     SessionHolder session_holder(impl_);
 
     //
-    // send a request for our local name, and wait for a response
+    // send a request for our local name, and wait for a response.  We
+    // also offer to use the binary wire format for payloads; the msgq
+    // confirms it in the response if it supports it.
     //
     ElementPtr get_lname_msg(Element::createMap());
     get_lname_msg->set(CC_HEADER_TYPE, Element::create(CC_COMMAND_GET_LNAME));
+    get_lname_msg->set(CC_HEADER_BINARY, Element::create(true));
     sendmsg(get_lname_msg);
 
     ConstElementPtr routing, msg;
     recvmsg(routing, msg, false);
 
     impl_->lname_ = msg->get(CC_PAYLOAD_LNAME)->stringValue();
+    impl_->binary_wire_ = routing->contains(CC_HEADER_BINARY) &&
+        routing->get(CC_HEADER_BINARY)->boolValue();
     LOG_DEBUG(logger, DBG_TRACE_DETAILED, CC_LNAME_RECEIVED).arg(impl_->lname_);
 
     // At this point there's no risk of resource leak.
@@ -341,7 +353,8 @@ Session::establish(const char* socket_file) {
 
 //
 // Convert to wire format and send this via the stream socket with its length
-// prefix.
+// prefix.  The header is always JSON, as the msgq needs to read it, but the
+// payload is in the binary wire format if the msgq agreed to it.
 //
 void
 Session::sendmsg(ConstElementPtr header) {
@@ -359,8 +372,14 @@ Session::sendmsg(ConstElementPtr header) {
 void
 Session::sendmsg(ConstElementPtr header, ConstElementPtr payload) {
     std::string header_wire = header->toWire();
-    std::string body_wire = payload->toWire();
-    unsigned int length = 2 + header_wire.length() + body_wire.length();
+    std::vector<uint8_t> body_wire;
+    if (impl_->binary_wire_) {
+        payload->toBinaryWire(body_wire);
+    } else {
+        const std::string body_json = payload->toWire();
+        body_wire.assign(body_json.begin(), body_json.end());
+    }
+    unsigned int length = 2 + header_wire.length() + body_wire.size();
     unsigned int length_net = htonl(length);
     unsigned short header_length = header_wire.length();
     unsigned short header_length_net = htons(header_length);
@@ -368,7 +387,9 @@ Session::sendmsg(ConstElementPtr header, ConstElementPtr payload) {
     impl_->writeData(&length_net, sizeof(length_net));
     impl_->writeData(&header_length_net, sizeof(header_length_net));
     impl_->writeData(header_wire.data(), header_length);
-    impl_->writeData(body_wire.data(), body_wire.length());
+    if (!body_wire.empty()) {
+        impl_->writeData(&body_wire[0], body_wire.size());
+    }
 }
 
 bool
@@ -416,18 +437,19 @@ Session::recvmsg(ConstElementPtr& env, ConstElementPtr& msg,
     std::vector<char> buffer(length);
     impl_->readData(&buffer[0], length);
 
-    std::string header_wire = std::string(&buffer[0], header_length);
-    std::string body_wire = std::string(&buffer[0] + header_length,
-                                        length - header_length);
-    std::stringstream header_wire_stream;
-    header_wire_stream << header_wire;
     ConstElementPtr l_env =
-        Element::fromWire(header_wire_stream, header_length);
-    
-    std::stringstream body_wire_stream;
-    body_wire_stream << body_wire;
-    ConstElementPtr l_msg =
-        Element::fromWire(body_wire_stream, length - header_length);
+        Element::fromJSON(&buffer[0], header_length, "<wire>");
+
+    // Any peer can send the payload in the binary wire format; the msgq
+    // only passes it to us as is if we asked for it.
+    const char* const body_data = &buffer[0] + header_length;
+    const size_t body_length = length - header_length;
+    ConstElementPtr l_msg;
+    if (Element::isBinaryWire(body_data, body_length)) {
+        l_msg = Element::fromBinaryWire(body_data, body_length);
+    } else {
+        l_msg = Element::fromJSON(body_data, body_length, "<wire>");
+    }
     if ((seq == -1 &&
          !l_env->contains(CC_HEADER_REPLY)
         ) || (
@@ -161,6 +161,13 @@ namespace bundy {
             virtual void setTimeout(size_t milliseconds);
             virtual size_t getTimeout() const;
 
+            /// @brief returns whether payloads are sent in the binary wire
+            /// format
+            ///
+            /// It's negotiated with the msgq when the session is
+            /// established (see \c bundy::data::Element::toBinaryWire()).
+            bool usesBinaryWire() const;
+
             /// @brief returns socket descriptor from underlying socket connection
             ///
             /// @return socket descriptor used for session connection
@@ -16,6 +16,7 @@
 #include <boost/foreach.hpp>
 #include <boost/assign/std/vector.hpp>
 #include <climits>
+#include <cstring>
 
 #include <cc/data.h>
 
@@ -198,6 +199,63 @@ TEST(Element, from_and_to_json) {
 
 }
 
+TEST(Element, from_json_buffer) {
+    const std::string json("{ \"name\": \"foo\\n\\\"bar\\\"\", "
+                           "\"list\": [ 1, 2.5, true, null, {  } ], "
+                           "\"empty\": \"\" }");
+    const ConstElementPtr expected = Element::fromJSON(json);
+
+    // Only the given length is parsed, so the buffer doesn't have to be
+    // nul-terminated.
+    const std::string padded = json + "garbage";
+    for (int i = 0; i < 2; ++i) {
+        ConstElementPtr el = Element::fromJSON(padded.data(), json.size(),
+                                               "<buffer>", i == 1);
+        EXPECT_EQ(*expected, *el);
+        EXPECT_EQ("foo\n\"bar\"", el->get("name")->stringValue());
+
+        // A part of an arena tree stays valid on its own
+        ConstElementPtr list = el->get("list");
+        el.reset();
+        EXPECT_EQ("[ 1, 2.5, true, null, {  } ]", list->str());
+    }
+
+    // The elements can still be modified
+    ElementPtr el = Element::fromJSON(json.data(), json.size(), "<buffer>",
+                                      true);
+    el->set("added", Element::create(1));
+    el->remove("list");
+    EXPECT_EQ("{ \"added\": 1, \"empty\": \"\", \"name\": \"foo\\n\\\"bar\\\"\" }",
+              el->str());
+
+    EXPECT_THROW(Element::fromJSON(padded.data(), padded.size()), JSONError);
+    EXPECT_THROW(Element::fromJSON(json.data(), json.size() - 1), JSONError);
+    EXPECT_THROW(Element::fromJSON(json.data(), 0), JSONError);
+
+    // Errors are reported at the same places as by the stream parser
+    const char* const bad[] = {
+        "{1}", "\n\nTru", "{ \n \"aaa\"\n err:", "{ \n", "\n  [ 1,\n",
+        "[ 1 2 ]", "{ \"a\" 1 }", "{ \"a\": 1 ", "\"\\u0041\"", "  \"abc", NULL
+    };
+    for (const char* const* s = bad; *s != NULL; ++s) {
+        std::string stream_error, buffer_error;
+        try {
+            std::istringstream iss(*s);
+            int line = 1, pos = 1;
+            Element::fromJSON(iss, "<buffer>", line, pos);
+        } catch (const JSONError& ex) {
+            stream_error = ex.what();
+        }
+        try {
+            Element::fromJSON(*s, std::strlen(*s));
+        } catch (const JSONError& ex) {
+            buffer_error = ex.what();
+        }
+        EXPECT_FALSE(buffer_error.empty()) << *s;
+        EXPECT_EQ(stream_error, buffer_error) << *s;
+    }
+}
+
 template <typename T>
 void
 testGetValueInt() {
@@ -678,6 +736,61 @@ TEST(Element, to_and_from_wire) {
     EXPECT_THROW(Element::fromJSON("[ \"a\": \"b\" ]"), bundy::data::JSONError);
 }
 
+// Encode to the binary wire format and decode it again
+ConstElementPtr
+binaryRoundTrip(ConstElementPtr element) {
+    std::vector<uint8_t> wire;
+    element->toBinaryWire(wire);
+    EXPECT_TRUE(Element::isBinaryWire(&wire[0], wire.size()));
+    return (Element::fromBinaryWire(&wire[0], wire.size()));
+}
+
+TEST(Element, to_and_from_binary_wire) {
+    const char* const tests[] = {
+        "null", "true", "false", "0", "1", "-1", "63", "-64", "64",
+        "9223372036854775807", "-9223372036854775808", "1.5", "-0.25",
+        "\"\"", "\"a string\"", "[]", "{}",
+        "[ 1, \"a\", [ null, true ], { \"b\": 2.5 } ]",
+        "{ \"a\": { \"b\": [ 1, 2 ], \"c\": \"\" }, \"d\": false }",
+        NULL
+    };
+    for (int i = 0; tests[i] != NULL; ++i) {
+        SCOPED_TRACE(tests[i]);
+        const ConstElementPtr element = Element::fromJSON(tests[i]);
+        EXPECT_TRUE(element->equals(*binaryRoundTrip(element)));
+    }
+
+    // Small values are shorter than in JSON.
+    std::vector<uint8_t> wire;
+    Element::create(-1)->toBinaryWire(wire);
+    ASSERT_EQ(3, wire.size());
+    EXPECT_EQ(Element::BINARY_WIRE_MARKER, wire[0]);
+    EXPECT_EQ(1, wire[2]);
+
+    // JSON is not mistaken for it.
+    const std::string json = Element::create(1)->toWire();
+    EXPECT_FALSE(Element::isBinaryWire(json.data(), json.size()));
+    EXPECT_FALSE(Element::isBinaryWire(json.data(), 0));
+    EXPECT_THROW(Element::fromBinaryWire(json.data(), json.size()),
+                 DecodeError);
+
+    // Malformed data: truncated, trailing garbage, unknown type, and a
+    // size bigger than the data.
+    wire.clear();
+    Element::fromJSON("{ \"a\": [ 1, \"b\" ] }")->toBinaryWire(wire);
+    for (size_t len = 1; len < wire.size(); ++len) {
+        EXPECT_THROW(Element::fromBinaryWire(&wire[0], len), DecodeError);
+    }
+    wire.push_back(0);
+    EXPECT_THROW(Element::fromBinaryWire(&wire[0], wire.size()), DecodeError);
+    const uint8_t unknown[] = { Element::BINARY_WIRE_MARKER, 8 };
+    EXPECT_THROW(Element::fromBinaryWire(unknown, sizeof(unknown)),
+                 DecodeError);
+    const uint8_t too_long[] = { Element::BINARY_WIRE_MARKER, 5, 0x7f, 'a' };
+    EXPECT_THROW(Element::fromBinaryWire(too_long, sizeof(too_long)),
+                 DecodeError);
+}
+
 ConstElementPtr
 efs(const std::string& str) {
     return (Element::fromJSON(str));
@@ -31,6 +31,7 @@
 #include <utility>
 #include <list>
 #include <string>
+#include <vector>
 #include <iostream>
 
 using namespace bundy::cc;
@@ -90,9 +91,16 @@ public:
     void acceptHandler(const asio::error_code&) const {
     }
 
-    void sendmsg(bundy::data::ElementPtr& env, bundy::data::ElementPtr& msg) {
+    void sendmsg(bundy::data::ElementPtr& env, bundy::data::ElementPtr& msg,
+                 bool binary = false)
+    {
         const std::string header_wire = env->toWire();
-        const std::string body_wire = msg->toWire();
+        std::string body_wire = msg->toWire();
+        if (binary) {
+            std::vector<uint8_t> binary_wire;
+            msg->toBinaryWire(binary_wire);
+            body_wire.assign(binary_wire.begin(), binary_wire.end());
+        }
         const unsigned int length = 2 + header_wire.length() +
             body_wire.length();
         const unsigned int length_net = htonl(length);
@@ -106,18 +114,24 @@ public:
         socket_.send(asio::buffer(body_wire.data(), body_wire.length()));
     }
 
-    void sendLname() {
+    void sendLname(bool binary) {
         bundy::data::ElementPtr lname_answer1 =
             bundy::data::Element::fromJSON("{ \"type\": \"lname\" }");
+        if (binary) {
+            lname_answer1->set("binary", bundy::data::Element::create(true));
+        }
         bundy::data::ElementPtr lname_answer2 =
             bundy::data::Element::fromJSON("{ \"lname\": \"foobar\" }");
         sendmsg(lname_answer1, lname_answer2);
     }
 
-    void setSendLname() {
+    // If binary is true, the lname answer also agrees to use the binary
+    // wire format.
+    void setSendLname(bool binary = false) {
         // ignore whatever data we get, send back an lname
         asio::async_read(socket_,  asio::buffer(data_buf, 0),
-                         boost::bind(&TestDomainSocket::sendLname, this));
+                         boost::bind(&TestDomainSocket::sendLname, this,
+                                     binary));
     }
 
 private:
@@ -234,6 +248,19 @@ TEST_F(SessionTest, connect_ok) {
     sess.establish(BUNDY_TEST_SOCKET_FILE);
 }
 
+// The binary wire format is only used if the msgq agrees to it.
+TEST_F(SessionTest, connect_ok_binary_wire) {
+    tds->setSendLname(true);
+    sess.establish(BUNDY_TEST_SOCKET_FILE);
+    EXPECT_TRUE(sess.usesBinaryWire());
+}
+
+TEST_F(SessionTest, connect_ok_json_wire) {
+    tds->setSendLname();
+    sess.establish(BUNDY_TEST_SOCKET_FILE);
+    EXPECT_FALSE(sess.usesBinaryWire());
+}
+
 TEST_F(SessionTest, connect_ok_no_timeout) {
     tds->setSendLname();
 
@@ -276,6 +303,30 @@ TEST_F(SessionTest, run_with_handler) {
     ASSERT_EQ(2, count);
 }
 
+// Payloads in either wire format are received.
+TEST_F(SessionTest, run_with_handler_binary_wire) {
+    tds->setSendLname(true);
+
+    sess.establish(BUNDY_TEST_SOCKET_FILE);
+    sess.startRead(boost::bind(&SessionTest::someHandler, this));
+
+    bundy::data::ElementPtr env = bundy::data::Element::fromJSON("{ \"to\": \"me\" }");
+    bundy::data::ElementPtr msg = bundy::data::Element::fromJSON("{ \"some\": [ 1, 2.5 ] }");
+    tds->sendmsg(env, msg, true);
+
+    msg = bundy::data::Element::fromJSON("{ \"another\": \"message\" }");
+    tds->sendmsg(env, msg);
+
+    msg = bundy::data::Element::fromJSON("{ \"a third\": \"message\" }");
+    tds->sendmsg(env, msg, true);
+
+    msg = bundy::data::Element::fromJSON("{ \"command\": \"stop\" }");
+    tds->sendmsg(env, msg, true);
+
+    size_t count = my_io_service.run();
+    ASSERT_EQ(2, count);
+}
+
 TEST_F(SessionTest, run_with_handler_timeout) {
     tds->setSendLname();
 
@@ -225,7 +225,8 @@ readOutputOptionConf(bundy::log::OutputOption& output_option,
                                     "loggers/output_options/output");
     if (output_option.destination == bundy::log::OutputOption::DEST_CONSOLE) {
         output_option.stream = bundy::log::getStream(output_el->stringValue());
-    } else if (output_option.destination == bundy::log::OutputOption::DEST_FILE) {
+    } else if (output_option.destination == bundy::log::OutputOption::DEST_FILE ||
+               output_option.destination == bundy::log::OutputOption::DEST_BINARY) {
         output_option.filename = output_el->stringValue();
     } else if (output_option.destination == bundy::log::OutputOption::DEST_SYSLOG) {
         output_option.facility = output_el->stringValue();
@@ -516,17 +517,23 @@ ModuleCCSession::start() {
     started_ = true;
 }
 
-/// Validates the new config values, if they are correct,
-/// call the config handler with the values that have changed
+/// Validates the new config values that have changed, if they are correct,
+/// call the config handler with them
 /// If that results in success, store the new config
 ConstElementPtr
 ModuleCCSession::handleConfigUpdate(ConstElementPtr new_config) {
     ConstElementPtr answer;
     ElementPtr errors = Element::createList();
+    ConstElementPtr diff;
+    if (config_handler_) {
+        // remove the values that have not changed; the local config has
+        // been validated already, so only the values that have changed
+        // need to be
+        diff = removeIdentical(new_config, getLocalConfig());
+    }
     if (!config_handler_) {
         answer = createAnswer(1, module_name_ + " does not have a config handler");
-    } else if (!module_specification_.validateConfig(new_config, false,
-                                                      errors)) {
+    } else if (!module_specification_.validateConfig(diff, false, errors)) {
         std::stringstream ss;
         ss << "Error in config validation: ";
         BOOST_FOREACH(ConstElementPtr error, errors->listValue()) {
@@ -534,8 +541,6 @@ ModuleCCSession::handleConfigUpdate(ConstElementPtr new_config) {
         }
         answer = createAnswer(2, ss.str());
     } else {
-        // remove the values that have not changed
-        ConstElementPtr diff = removeIdentical(new_config, getLocalConfig());
         // handle config update
         answer = config_handler_(diff);
         int rcode = -1;
@@ -19,6 +19,8 @@
 #include <iostream>
 #include <fstream>
 #include <cerrno>
+#include <map>
+#include <vector>
 
 #include <boost/foreach.hpp>
 
@@ -88,34 +90,64 @@ check_config_item_list(ConstElementPtr spec) {
     }
 }
 
+// returns the strptime()/strftime() format of the given item_format,
+// or NULL if it is not a known format
+const char*
+format_pattern(const std::string& format_name) {
+    // TODO: should be added other format types if necessary
+    static const struct {
+        const char* name;
+        const char* pattern;
+    } time_formats[] = {
+        { "date-time", "%Y-%m-%dT%H:%M:%SZ" },
+        { "date", "%Y-%m-%d" },
+        { "time", "%H:%M:%S" }
+    };
+    for (size_t i = 0; i < sizeof(time_formats) / sizeof(time_formats[0]);
+         ++i) {
+        if (format_name == time_formats[i].name) {
+            return (time_formats[i].pattern);
+        }
+    }
+    return (NULL);
+}
+
+// checks whether the given element is a string in the given format
+// (as returned by format_pattern(); NULL matches nothing)
+bool
+check_format_pattern(ConstElementPtr value, const char* pattern) {
+    if (pattern == NULL) {
+        return (false);
+    }
+    struct tm tm;
+    std::vector<char> buf(32);
+    memset(&tm, 0, sizeof(tm));
+    // reverse check
+    return (strptime(value->stringValue().c_str(), pattern, &tm) != NULL
+            && strftime(&buf[0], buf.size(), pattern, &tm) != 0
+            && strncmp(value->stringValue().c_str(),
+                       &buf[0], buf.size()) == 0);
+}
+
 // checks whether the given element is a valid statistics specification
 // returns false if the specification is bad
 bool
 check_format(ConstElementPtr value, ConstElementPtr format_name) {
-    typedef std::map<std::string, std::string> format_types;
-    format_types time_formats;
-    // TODO: should be added other format types if necessary
-    time_formats.insert(
-        format_types::value_type("date-time", "%Y-%m-%dT%H:%M:%SZ") );
-    time_formats.insert(
-        format_types::value_type("date", "%Y-%m-%d") );
-    time_formats.insert(
-        format_types::value_type("time", "%H:%M:%S") );
-    BOOST_FOREACH (const format_types::value_type& f, time_formats) {
-        if (format_name->stringValue() == f.first) {
-            struct tm tm;
-            std::vector<char> buf(32);
-            memset(&tm, 0, sizeof(tm));
-            // reverse check
-            return (strptime(value->stringValue().c_str(),
-                             f.second.c_str(), &tm) != NULL
-                    && strftime(&buf[0], buf.size(),
-                                f.second.c_str(), &tm) != 0
-                    && strncmp(value->stringValue().c_str(),
-                               &buf[0], buf.size()) == 0);
-        }
+    return (check_format_pattern(value,
+                                 format_pattern(format_name->stringValue())));
+}
+
+// returns the given entry of the given specification map if it is of
+// the given type, and an empty pointer otherwise
+ConstElementPtr
+get_typed_item(ConstElementPtr spec, const std::string& name,
+               Element::types type)
+{
+    if (spec->getType() != Element::map || !spec->contains(name)) {
+        return (ConstElementPtr());
     }
-    return (false);
+    ConstElementPtr item = spec->get(name);
+    return (item->getType() == type ? item : ConstElementPtr());
 }
 
 void check_statistics_item_list(ConstElementPtr spec);
@@ -191,6 +223,275 @@ check_module_specification(ConstElementPtr def) {
 
 namespace bundy {
 namespace config {
+//
+// Compiled specifications
+//
+
+// An item of a specification, with everything validation needs to know
+// about it extracted from the specification elements
+struct ModuleSpec::CompiledItem {
+    std::string name;
+    bool optional;
+    // the type of the data, Element::any if any type is allowed
+    Element::types type;
+    // whether item_type is "map" (the only items of lists validated
+    // beyond their type)
+    bool is_map;
+    boost::shared_ptr<const CompiledItem> list_item;
+    CompiledSpecListPtr map_items;
+    // only set if there's no map_item_spec
+    boost::shared_ptr<const CompiledItem> named_set_item;
+    bool has_format;
+    // NULL if the format is unknown
+    const char* format;
+
+    // returns false if the specification is malformed
+    bool compile(ConstElementPtr spec);
+
+    bool checkType(ConstElementPtr data) const {
+        if (type == Element::any) {
+            return (true);
+        }
+        // there's no null item_type for data
+        return (data->getType() == type && type != Element::null);
+    }
+
+    bool validate(ConstElementPtr data, const bool full,
+                  ElementPtr errors) const;
+};
+
+// A list of items, the specification of a map
+struct ModuleSpec::CompiledSpecList {
+    // in the order of the specification
+    std::vector<CompiledItem> items;
+    // the index in items of the (first) item with each name
+    std::map<std::string, size_t> index;
+
+    // returns an empty pointer if the specification is malformed
+    static CompiledSpecListPtr create(ConstElementPtr spec);
+
+    const CompiledItem* find(const std::string& name) const {
+        const std::map<std::string, size_t>::const_iterator
+            found(index.find(name));
+        return (found != index.end() ? &items[found->second] : NULL);
+    }
+
+    bool validate(ConstElementPtr data, const bool full,
+                  ElementPtr errors) const;
+};
+
+bool
+ModuleSpec::CompiledItem::compile(ConstElementPtr spec) {
+    ConstElementPtr name_el = get_typed_item(spec, "item_name",
+                                             Element::string);
+    ConstElementPtr type_el = get_typed_item(spec, "item_type",
+                                             Element::string);
+    ConstElementPtr optional_el = get_typed_item(spec, "item_optional",
+                                                 Element::boolean);
+    if (!name_el || !type_el || !optional_el) {
+        return (false);
+    }
+    name = name_el->stringValue();
+    optional = optional_el->boolValue();
+    // throws TypeError for unknown type names
+    type = Element::nameToType(type_el->stringValue());
+    is_map = (type_el->stringValue() == "map");
+
+    if (spec->contains("list_item_spec")) {
+        boost::shared_ptr<CompiledItem> item(new CompiledItem);
+        if (!item->compile(spec->get("list_item_spec"))) {
+            return (false);
+        }
+        list_item = item;
+    } else if (type == Element::list) {
+        return (false);
+    }
+
+    if (spec->contains("map_item_spec")) {
+        map_items = CompiledSpecList::create(spec->get("map_item_spec"));
+        if (!map_items) {
+            return (false);
+        }
+    } else if (spec->contains("named_set_item_spec")) {
+        boost::shared_ptr<CompiledItem> item(new CompiledItem);
+        if (!item->compile(spec->get("named_set_item_spec"))) {
+            return (false);
+        }
+        named_set_item = item;
+    } else if (type == Element::map) {
+        return (false);
+    }
+
+    has_format = spec->contains("item_format");
+    format = NULL;
+    if (has_format) {
+        ConstElementPtr format_el = get_typed_item(spec, "item_format",
+                                                   Element::string);
+        if (!format_el) {
+            return (false);
+        }
+        format = format_pattern(format_el->stringValue());
+    }
+    return (true);
+}
+
+// Same as ModuleSpec::validateItem()
+bool
+ModuleSpec::CompiledItem::validate(ConstElementPtr data, const bool full,
+                                   ElementPtr errors) const
+{
+    if (!checkType(data)) {
+        if (errors) {
+            errors->add(Element::create("Type mismatch"));
+        }
+        return (false);
+    }
+    if (data->getType() == Element::list && list_item) {
+        BOOST_FOREACH(ConstElementPtr list_el, data->listValue()) {
+            if (!list_item->checkType(list_el)) {
+                if (errors) {
+                    errors->add(Element::create("Type mismatch"));
+                }
+                return (false);
+            }
+            if (list_item->is_map &&
+                !list_item->validate(list_el, full, errors)) {
+                return (false);
+            }
+        }
+    }
+    if (data->getType() == Element::map) {
+        if (map_items) {
+            if (!map_items->validate(data, full, errors)) {
+                return (false);
+            }
+        } else if (named_set_item) {
+            const std::map<std::string, ConstElementPtr>& data_map =
+                data->mapValue();
+            for (std::map<std::string, ConstElementPtr>::const_iterator it =
+                     data_map.begin(); it != data_map.end(); ++it) {
+                if (!named_set_item->validate(it->second, full, errors)) {
+                    return (false);
+                }
+            }
+        }
+    }
+    if (has_format && !check_format_pattern(data, format)) {
+        if (errors) {
+            errors->add(Element::create("Format mismatch"));
+        }
+        return (false);
+    }
+    return (true);
+}
+
+ModuleSpec::CompiledSpecListPtr
+ModuleSpec::CompiledSpecList::create(ConstElementPtr spec) {
+    if (spec->getType() != Element::list) {
+        return (CompiledSpecListPtr());
+    }
+    boost::shared_ptr<CompiledSpecList> compiled(new CompiledSpecList);
+    compiled->items.resize(spec->size());
+    for (size_t i = 0; i < compiled->items.size(); ++i) {
+        if (!compiled->items[i].compile(spec->get(i))) {
+            return (CompiledSpecListPtr());
+        }
+        // insert() keeps the first item of a name
+        compiled->index.insert(std::make_pair(compiled->items[i].name, i));
+    }
+    return (compiled);
+}
+
+// Same as ModuleSpec::validateSpecList()
+bool
+ModuleSpec::CompiledSpecList::validate(ConstElementPtr data, const bool full,
+                                       ElementPtr errors) const
+{
+    const std::map<std::string, ConstElementPtr>& data_map = data->mapValue();
+    bool validated = true;
+    BOOST_FOREACH(const CompiledItem& item, items) {
+        const std::map<std::string, ConstElementPtr>::const_iterator
+            found(data_map.find(item.name));
+        if (found != data_map.end()) {
+            if (!item.validate(found->second, full, errors)) {
+                validated = false;
+            }
+        } else if (!item.optional && full) {
+            if (errors) {
+                errors->add(Element::create("Non-optional value missing"));
+            }
+            validated = false;
+        }
+    }
+
+    // Both the data and the index are sorted by name, so the unknown items
+    // are found in a single pass over them.
+    std::map<std::string, size_t>::const_iterator known = index.begin();
+    for (std::map<std::string, ConstElementPtr>::const_iterator it =
+             data_map.begin(); it != data_map.end(); ++it) {
+        while (known != index.end() && known->first < it->first) {
+            ++known;
+        }
+        if (known != index.end() && known->first == it->first) {
+            continue;
+        }
+        // Ignore 'version' and other system reserved items as a config
+        // element.
+        if (it->first != "version" && it->first != "_generation_id") {
+            validated = false;
+            if (errors) {
+                errors->add(Element::create("Unknown item " + it->first));
+            }
+        }
+    }
+
+    return (validated);
+}
+
+void
+ModuleSpec::compile() {
+    if (!module_specification ||
+        module_specification->getType() != Element::map) {
+        return;
+    }
+    // A module may have no configuration or statistics, in which case
+    // there's no data to accept.
+    const ConstElementPtr empty_list = Element::createList();
+    ConstElementPtr config = module_specification->get("config_data");
+    ConstElementPtr statistics = module_specification->get("statistics");
+    ConstElementPtr commands = module_specification->get("commands");
+    try {
+        config_validator_ = CompiledSpecList::create(config ? config :
+                                                     empty_list);
+        statistics_validator_ =
+            CompiledSpecList::create(statistics ? statistics : empty_list);
+        if (!commands || commands->getType() != Element::list) {
+            return;
+        }
+        boost::shared_ptr<CompiledCommands> validators(new CompiledCommands);
+        BOOST_FOREACH(ConstElementPtr command, commands->listValue()) {
+            ConstElementPtr name = get_typed_item(command, "command_name",
+                                                  Element::string);
+            ConstElementPtr args = get_typed_item(command, "command_args",
+                                                  Element::list);
+            CompiledSpecListPtr compiled;
+            if (name && args) {
+                compiled = CompiledSpecList::create(args);
+            }
+            if (!compiled) {
+                return;
+            }
+            // insert() keeps the first command of a name, as
+            // validateCommand() does
+            validators->insert(std::make_pair(name->stringValue(), compiled));
+        }
+        command_validators_ = validators;
+    } catch (const TypeError&) {
+        // An unknown item_type; the specification elements are used for
+        // the parts not compiled yet.
+    }
+}
+
 //
 // Public functions
 //
@@ -204,6 +505,7 @@ ModuleSpec::ModuleSpec(ConstElementPtr module_spec_element,
     if (check) {
         check_module_specification(module_specification);
     }
+    compile();
 }
 
 ConstElementPtr
@@ -249,14 +551,12 @@ ModuleSpec::getModuleDescription() const {
 
 bool
 ModuleSpec::validateConfig(ConstElementPtr data, const bool full) const {
-    ConstElementPtr spec = module_specification->find("config_data");
-    return (validateSpecList(spec, data, full, ElementPtr()));
+    return (validateConfig(data, full, ElementPtr()));
 }
 
 bool
 ModuleSpec::validateStatistics(ConstElementPtr data, const bool full) const {
-    ConstElementPtr spec = module_specification->find("statistics");
-    return (validateSpecList(spec, data, full, ElementPtr()));
+    return (validateStatistics(data, full, ElementPtr()));
 }
 
 bool
@@ -270,6 +570,14 @@ ModuleSpec::validateCommand(const std::string& command,
         return (false);
     }
 
+    if (command_validators_) {
+        const CompiledCommands::const_iterator
+            found(command_validators_->find(command));
+        if (found != command_validators_->end()) {
+            return (found->second->validate(args, true, errors));
+        }
+    }
+
     ConstElementPtr commands_spec = module_specification->find("commands");
     if (!commands_spec) {
         // there are no commands according to the spec.
@@ -293,6 +601,9 @@ bool
 ModuleSpec::validateConfig(ConstElementPtr data, const bool full,
                             ElementPtr errors) const
 {
+    if (config_validator_) {
+        return (config_validator_->validate(data, full, errors));
+    }
     ConstElementPtr spec = module_specification->find("config_data");
     return (validateSpecList(spec, data, full, errors));
 }
@@ -301,10 +612,60 @@ bool
 ModuleSpec::validateStatistics(ConstElementPtr data, const bool full,
                                ElementPtr errors) const
 {
+    if (statistics_validator_) {
+        return (statistics_validator_->validate(data, full, errors));
+    }
     ConstElementPtr spec = module_specification->find("statistics");
     return (validateSpecList(spec, data, full, errors));
 }
 
+bool
+ModuleSpec::validateConfigItem(const std::string& identifier,
+                               ConstElementPtr data, const bool full,
+                               ElementPtr errors) const
+{
+    if (!config_validator_) {
+        bundy_throw(ModuleSpecError, "config_data can't be compiled");
+    }
+    const CompiledSpecList* list = config_validator_.get();
+    const CompiledItem* item = NULL;
+    bool known = true;
+    size_t pos = 0;
+    while (known && pos <= identifier.size()) {
+        size_t sep = identifier.find('/', pos);
+        if (sep == std::string::npos) {
+            sep = identifier.size();
+        }
+        const std::string part = identifier.substr(pos, sep - pos);
+        pos = sep + 1;
+        if (part.empty()) {
+            continue;
+        }
+        if (item != NULL) {
+            if (item->named_set_item) {
+                // any name is an entry of the named set
+                item = item->named_set_item.get();
+                continue;
+            } else if (item->map_items) {
+                list = item->map_items.get();
+            } else {
+                known = false;
+                break;
+            }
+        }
+        item = list->find(part);
+        known = (item != NULL);
+    }
+
+    if (!known || item == NULL) {
+        if (errors) {
+            errors->add(Element::create("Unknown item " + identifier));
+        }
+        return (false);
+    }
+    return (item->validate(data, full, errors));
+}
+
 ModuleSpec
 moduleSpecFromFile(const std::string& file_name, const bool check)
                    throw(JSONError, ModuleSpecError)
@@ -18,6 +18,9 @@
 
 #include <cc/data.h>
 
+#include <boost/shared_ptr.hpp>
+
+#include <map>
 #include <sstream>
 
 namespace bundy { namespace config {
@@ -43,6 +46,14 @@ namespace bundy { namespace config {
     ///
     /// The form of the specification is described in doc/ (TODO)
     ///
+    /// The configuration, statistics and command parts of the
+    /// specification are compiled into validators when the \c ModuleSpec
+    /// is constructed, so that validating data does not walk the
+    /// specification elements again (looking up the item names, types
+    /// and formats as strings) for every piece of data.  If a part of
+    /// the specification cannot be compiled (which can only happen if it
+    /// was not checked), the data is validated against the elements.
+    ///
     class ModuleSpec {
     public:
         ModuleSpec() {};
@@ -159,7 +170,38 @@ namespace bundy { namespace config {
         bool validateStatistics(bundy::data::ConstElementPtr data, const bool full,
                                 bundy::data::ElementPtr errors) const;
 
+        /// Validates a single item of configuration data.
+        ///
+        /// This allows to validate only the parts of the configuration
+        /// that have changed, instead of the whole configuration.  The
+        /// identifier is the '/'-separated path of the item in the
+        /// configuration, the names of the entries of a named set
+        /// being any name.  Items in lists cannot be addressed.
+        ///
+        /// \param identifier The identifier of the item, e.g. "foo/bar"
+        /// \param data The value of the item
+        /// \param full If true, all non-optional configuration parameters
+        /// below the item must be specified.
+        /// \param errors If not null, a ListElement the errors are added to
+        /// \return true if the identifier is known and the data conforms
+        /// to its specification, false otherwise.
+        bool validateConfigItem(const std::string& identifier,
+                                bundy::data::ConstElementPtr data,
+                                const bool full,
+                                bundy::data::ElementPtr errors) const;
+
     private:
+        struct CompiledItem;
+        struct CompiledSpecList;
+        typedef boost::shared_ptr<const CompiledSpecList> CompiledSpecListPtr;
+        typedef std::map<std::string, CompiledSpecListPtr> CompiledCommands;
+
+        // Compiles the parts of the specification, see the class comment.
+        void compile();
+
+        // The validation against the specification elements, used for
+        // the parts which could not be compiled.
+
         bool validateItem(bundy::data::ConstElementPtr spec,
                           bundy::data::ConstElementPtr data,
                           const bool full,
@@ -174,6 +216,12 @@ namespace bundy { namespace config {
                                 bundy::data::ElementPtr errors) const;
 
         bundy::data::ConstElementPtr module_specification;
+
+        // The compiled parts of the specification, null if they could
+        // not be compiled.
+        CompiledSpecListPtr config_validator_;
+        CompiledSpecListPtr statistics_validator_;
+        boost::shared_ptr<const CompiledCommands> command_validators_;
     };
 
     /// Creates a \c ModuleSpec instance from the contents
@@ -395,3 +395,77 @@ TEST(ModuleSpec, CheckFormat) {
         EXPECT_THROW(ModuleSpec(el, true), ModuleSpecError);
     }
 }
+
+TEST(ModuleSpec, ConfigItemValidation) {
+    const ModuleSpec dd = moduleSpecFromFile(specfile("spec32.spec"));
+    ElementPtr errors = Element::createList();
+
+    EXPECT_TRUE(dd.validateConfigItem("named_set_item",
+                                      Element::fromJSON("{ \"a\": 1 }"),
+                                      true, errors));
+    EXPECT_TRUE(dd.validateConfigItem("named_set_item2/foo/first",
+                                      Element::create(1), true, errors));
+    EXPECT_TRUE(dd.validateConfigItem("/named_set_item2/foo/",
+                                      Element::fromJSON("{ \"second\": "
+                                                        "\"bar\" }"),
+                                      true, errors));
+    EXPECT_TRUE(dd.validateConfigItem("named_set_item3/values",
+                                      Element::fromJSON("[ 1, 2 ]"),
+                                      true, errors));
+    EXPECT_EQ(0, errors->size());
+
+    EXPECT_FALSE(dd.validateConfigItem("named_set_item2/foo/first",
+                                       Element::create("one"), true, errors));
+    EXPECT_FALSE(dd.validateConfigItem("named_set_item3/values",
+                                       Element::fromJSON("[ 1, \"a\" ]"),
+                                       true, errors));
+    EXPECT_FALSE(dd.validateConfigItem("named_set_item2/foo",
+                                       Element::fromJSON("{ \"third\": 3 }"),
+                                       true, errors));
+    EXPECT_EQ("[ \"Type mismatch\", \"Type mismatch\", "
+              "\"Unknown item third\" ]", errors->str());
+
+    // Unknown items, including items below leaves
+    errors = Element::createList();
+    EXPECT_FALSE(dd.validateConfigItem("no_such_item", Element::create(1),
+                                       true, errors));
+    EXPECT_FALSE(dd.validateConfigItem("named_set_item2/foo/third",
+                                       Element::create(1), true, errors));
+    EXPECT_FALSE(dd.validateConfigItem("named_set_item3/values/1",
+                                       Element::create(1), true, errors));
+    EXPECT_FALSE(dd.validateConfigItem("", Element::create(1), true,
+                                       ElementPtr()));
+    EXPECT_EQ("[ \"Unknown item no_such_item\", "
+              "\"Unknown item named_set_item2/foo/third\", "
+              "\"Unknown item named_set_item3/values/1\" ]", errors->str());
+}
+
+TEST(ModuleSpec, UncompiledValidation) {
+    // The unknown type can't be compiled, the specification elements are
+    // used instead, and the data doesn't match the type.
+    const ModuleSpec dd(Element::fromJSON(
+        "{ \"module_name\": \"Foo\", \"config_data\": [ "
+        "{ \"item_name\": \"item1\", \"item_type\": \"somethingbad\", "
+        "\"item_optional\": true } ] }"), false);
+    ElementPtr errors = Element::createList();
+    EXPECT_FALSE(dd.validateConfig(Element::fromJSON("{ \"item1\": 1 }"),
+                                   false, errors));
+    EXPECT_EQ("[ \"Type mismatch\" ]", errors->str());
+    EXPECT_THROW(dd.validateConfigItem("item1", Element::create(1), false,
+                                       errors), ModuleSpecError);
+
+    const ModuleSpec dd20 = moduleSpecFromFile(specfile("spec20.spec"),
+                                               false);
+    errors = Element::createList();
+    EXPECT_FALSE(dd20.validateCommand("print_message",
+                                      Element::fromJSON("{ \"message\": "
+                                                        "\"Hello\" }"),
+                                      errors));
+    EXPECT_EQ("[ \"Type mismatch\" ]", errors->str());
+
+    // Without configuration, no configuration item is accepted.
+    const ModuleSpec dd1 = moduleSpecFromFile(specfile("spec1.spec"));
+    EXPECT_TRUE(dd1.validateConfig(Element::createMap(), true));
+    EXPECT_FALSE(dd1.validateConfig(Element::fromJSON("{ \"item1\": 1 }")));
+    EXPECT_TRUE(dd1.validateStatistics(Element::createMap(), true));
+}
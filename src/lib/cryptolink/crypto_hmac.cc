@@ -95,19 +95,18 @@ public:
             size_t block_length = 0;
 #endif
             if (secret_len > block_length) {
-                Botan::SecureVector<Botan::byte> hashed_key =
-                    hash->process(static_cast<const Botan::byte*>(secret),
-                                  secret_len);
-                hmac_->set_key(hashed_key.begin(), hashed_key.size());
+                key_ = hash->process(static_cast<const Botan::byte*>(secret),
+                                     secret_len);
             } else {
                 // Botan 1.8 considers len 0 a bad key. 1.9 does not,
                 // but we won't accept it anyway, and fail early
                 if (secret_len == 0) {
                     bundy_throw(BadKey, "Bad HMAC secret length: 0");
                 }
-                hmac_->set_key(static_cast<const Botan::byte*>(secret),
-                               secret_len);
+                key_ = Botan::SecureVector<Botan::byte>(
+                    static_cast<const Botan::byte*>(secret), secret_len);
             }
+            hmac_->set_key(key_.begin(), key_.size());
         } catch (const Botan::Invalid_Key_Length& ikl) {
             bundy_throw(BadKey, ikl.what());
         } catch (const Botan::Exception& exc) {
@@ -115,6 +114,18 @@ public:
         }
     }
 
+    // Creates an object keyed with the same secret as the source, in the
+    // state just after the construction.  Cloning the Botan object skips
+    // the lookup of the hash algorithm, and the key is already hashed.
+    HMACImpl(const HMACImpl& source) : key_(source.key_) {
+        try {
+            hmac_.reset(static_cast<Botan::HMAC*>(source.hmac_->clone()));
+            hmac_->set_key(key_.begin(), key_.size());
+        } catch (const Botan::Exception& exc) {
+            bundy_throw(bundy::cryptolink::LibraryError, exc.what());
+        }
+    }
+
     ~HMACImpl() { }
 
     size_t getOutputLength() const {
@@ -137,6 +148,10 @@ public:
         }
     }
 
+    // Note: Botan's final() resets the internal state to the one just after
+    // set_key(), preserving the key.  The following methods rely on this
+    // to allow the object to be reused.
+
     void sign(bundy::util::OutputBuffer& result, size_t len) {
         try {
             Botan::SecureVector<Botan::byte> b_result(hmac_->final());
@@ -205,6 +220,8 @@ public:
 
 private:
     boost::scoped_ptr<Botan::HMAC> hmac_;
+    // The key given to the Botan object, kept for the clones.
+    Botan::SecureVector<Botan::byte> key_;
 };
 
 HMAC::HMAC(const void* secret, size_t secret_length,
@@ -213,10 +230,18 @@ HMAC::HMAC(const void* secret, size_t secret_length,
     impl_ = new HMACImpl(secret, secret_length, hash_algorithm);
 }
 
+HMAC::HMAC(const HMACImpl& impl) : impl_(new HMACImpl(impl)) {
+}
+
 HMAC::~HMAC() {
     delete impl_;
 }
 
+HMAC*
+HMAC::clone() const {
+    return (new HMAC(*impl_));
+}
+
 size_t
 HMAC::getOutputLength() const {
     return (impl_->getOutputLength());
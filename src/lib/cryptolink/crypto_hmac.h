@@ -32,6 +32,12 @@ class HMACImpl;
 /// This class is used to create and verify HMAC signatures. Instances
 /// can be created with CryptoLink::createHMAC()
 ///
+/// Once \c sign() or \c verify() is called, the object is reset to the
+/// state just after the construction, so it can be reused for another
+/// signature with the same key.  This is cheaper than creating a new
+/// object, which involves deriving the inner and outer keys from the
+/// secret.
+///
 class HMAC : private boost::noncopyable {
 private:
     /// \brief Constructor from a secret and a hash algorithm
@@ -56,10 +62,30 @@ private:
     friend HMAC* CryptoLink::createHMAC(const void*, size_t,
                                         const HashAlgorithm);
 
+    /// \brief Constructor for \c clone()
+    explicit HMAC(const HMACImpl& impl);
+
 public:
     /// \brief Destructor
     ~HMAC();
 
+    /// \brief Create another object keyed with the same secret
+    ///
+    /// The new object is in the state just after the construction,
+    /// whatever data has been added to this one.  This is cheaper than
+    /// creating it with \c CryptoLink::createHMAC(), as the hash algorithm
+    /// doesn't need to be looked up and the secret is already prepared, so
+    /// a keyed object can be kept as a template for the objects used for
+    /// each signature.  This object is not modified, so it can be cloned
+    /// by several threads at once.
+    ///
+    /// \exception LibraryError if there was any unexpected exception
+    ///                         in the underlying library
+    ///
+    /// \return A newly created HMAC object, which must be deleted with
+    ///         \c deleteHMAC()
+    HMAC* clone() const;
+
     /// \brief Returns the output size of the digest
     ///
     /// \return output size of the digest
@@ -581,6 +581,60 @@ TEST(CryptoLinkTest, HMACSigLengthArgument) {
     EXPECT_EQ(32, sigBufferLength(SHA256, 3200));
 }
 
+// The same HMAC object can be used for multiple signatures, with the key
+// kept across them (the RFC 2202 test case 2 is used).
+TEST(CryptoLinkTest, HMACReuse) {
+    const std::string data("what do ya want for nothing?");
+    const uint8_t hmac_expected[] = { 0x75, 0x0c, 0x78, 0x3e, 0x6a,
+                                      0xb0, 0xb5, 0x03, 0xea, 0xa8,
+                                      0x6e, 0x31, 0x0a, 0x5d, 0xb7,
+                                      0x38 };
+    boost::shared_ptr<HMAC> hmac(
+        CryptoLink::getCryptoLink().createHMAC("Jefe", 4, MD5), deleteHMAC);
+
+    for (int i = 0; i < 2; ++i) {
+        OutputBuffer hmac_sig(0);
+        hmac->update(data.c_str(), data.size());
+        hmac->sign(hmac_sig, hmac->getOutputLength());
+        checkBuffer(hmac_sig, hmac_expected, sizeof(hmac_expected));
+    }
+
+    // Verifying with the same object also works after signing, and a
+    // failed verification doesn't affect the next one.
+    hmac->update("garbage", 7);
+    EXPECT_FALSE(hmac->verify(hmac_expected, sizeof(hmac_expected)));
+    hmac->update(data.c_str(), data.size());
+    EXPECT_TRUE(hmac->verify(hmac_expected, sizeof(hmac_expected)));
+}
+
+// A clone of an HMAC object is keyed with the same secret, including one
+// longer than the block size (the RFC 2202 test case 6 is used), and
+// doesn't inherit the data added to the original.
+TEST(CryptoLinkTest, HMACClone) {
+    const std::string data("Test Using Larger Than Block-Size Key - "
+                           "Hash Key First");
+    const std::vector<uint8_t> secret(80, 0xaa);
+    const uint8_t hmac_expected[] = { 0x6b, 0x1a, 0xb7, 0xfe, 0x4b,
+                                      0xd7, 0xbf, 0x8f, 0x0b, 0x62,
+                                      0xe6, 0xce, 0x61, 0xb9, 0xd0,
+                                      0xcd };
+    boost::shared_ptr<HMAC> hmac(
+        CryptoLink::getCryptoLink().createHMAC(&secret[0], secret.size(),
+                                               MD5), deleteHMAC);
+    hmac->update("garbage", 7);
+
+    boost::shared_ptr<HMAC> clone(hmac->clone(), deleteHMAC);
+    EXPECT_EQ(hmac->getOutputLength(), clone->getOutputLength());
+    OutputBuffer hmac_sig(0);
+    clone->update(data.c_str(), data.size());
+    clone->sign(hmac_sig, clone->getOutputLength());
+    checkBuffer(hmac_sig, hmac_expected, sizeof(hmac_expected));
+
+    // The original still has its own data.
+    hmac->update(data.c_str(), data.size());
+    EXPECT_FALSE(hmac->verify(hmac_expected, sizeof(hmac_expected)));
+}
+
 TEST(CryptoLinkTest, BadKey) {
     OutputBuffer data_buf(0);
     OutputBuffer hmac_sig(0);
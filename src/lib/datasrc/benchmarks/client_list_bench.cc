@@ -0,0 +1,266 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <bench/benchmark.h>
+
+#include <log/logger_support.h>
+
+#include <dns/name.h>
+#include <dns/rrclass.h>
+
+#include <cc/data.h>
+
+#include <datasrc/client_list.h>
+#include <datasrc/memory/zone_table_segment.h>
+#include <datasrc/memory/zone_writer.h>
+
+#include <boost/lexical_cast.hpp>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using std::string;
+using std::vector;
+using namespace bundy::bench;
+using namespace bundy::data;
+using namespace bundy::datasrc;
+using namespace bundy::dns;
+
+namespace {
+class ListFindBenchMark {
+public:
+    ListFindBenchMark(const ClientList& list, const vector<Name>& names,
+                      bool want_exact_match, bool want_finder) :
+        list_(list), names_(names), want_exact_match_(want_exact_match),
+        want_finder_(want_finder)
+    {}
+    unsigned int run() {
+        vector<Name>::const_iterator it;
+        const vector<Name>::const_iterator it_end = names_.end();
+        for (it = names_.begin(); it != it_end; ++it) {
+            list_.find(*it, want_exact_match_, want_finder_);
+        }
+        return (names_.size());
+    }
+private:
+    const ClientList& list_;
+    const vector<Name>& names_;
+    const bool want_exact_match_;
+    const bool want_finder_;
+};
+
+// The zone names are spread over some TLDs, like a hosting provider serving
+// many customer domains: zone0.tld0, zone1.tld1, ... zone16.tld0, ...
+const size_t TLD_COUNT = 16;
+
+Name
+getZoneName(size_t i) {
+    return (Name("zone" + boost::lexical_cast<string>(i) + ".tld" +
+                 boost::lexical_cast<string>(i % TLD_COUNT)));
+}
+
+// All zones are loaded from this single file; it only has relative names so
+// it works for any origin.
+const char* const ZONE_FILE = "client_list_bench.zone";
+
+void
+writeZoneFile() {
+    std::ofstream zone(ZONE_FILE);
+    zone << "@ 3600 IN SOA ns1 hostmaster 1 3600 300 3600000 3600\n"
+         << "@ 3600 IN NS ns1\n"
+         << "ns1 3600 IN A 192.0.2.1\n"
+         << "www 3600 IN A 192.0.2.2\n";
+    if (!zone) {
+        bundy_throw(bundy::Unexpected, "failed to write " << ZONE_FILE);
+    }
+}
+
+// Build a client list of a MasterFiles data source with the given number of
+// zones in the cache.
+boost::shared_ptr<ConfigurableClientList>
+createList(size_t zone_count, const string& segment_type,
+           const string& mapped_file)
+{
+    const ElementPtr params = Element::createMap();
+    for (size_t i = 0; i < zone_count; ++i) {
+        params->set(getZoneName(i).toText(), Element::create(ZONE_FILE));
+    }
+    const ElementPtr datasrc_config = Element::createMap();
+    datasrc_config->set("type", Element::create("MasterFiles"));
+    datasrc_config->set("cache-enable", Element::create(true));
+    datasrc_config->set("cache-type", Element::create(segment_type));
+    datasrc_config->set("params", params);
+    const ElementPtr config = Element::createList();
+    config->add(datasrc_config);
+
+    boost::shared_ptr<ConfigurableClientList> list(
+        new ConfigurableClientList(RRClass::IN()));
+    list->configure(config, true);
+
+    // A mapped segment isn't loaded on configuration; we create it and
+    // load the zones into it, as the memory manager would do.
+    if (segment_type == "mapped") {
+        list->resetMemorySegment("MasterFiles",
+                                 memory::ZoneTableSegment::CREATE,
+                                 Element::fromJSON("{\"mapped-file\": \"" +
+                                                   mapped_file + "\"}"));
+        for (size_t i = 0; i < zone_count; ++i) {
+            const ConfigurableClientList::ZoneWriterPtr writer =
+                list->getCachedZoneWriter(getZoneName(i), false).second;
+            writer->load();
+            writer->install();
+            writer->cleanup();
+        }
+    }
+    return (list);
+}
+
+void
+runBenchMarks(const ClientList& list, size_t zone_count, size_t query_count,
+              int iteration)
+{
+    // Names in random zones, to be found by the longest match, the exact
+    // zone names, and names of no zone.
+    vector<Name> sub_names;
+    vector<Name> zone_names;
+    vector<Name> nx_names;
+    for (size_t i = 0; i < query_count; ++i) {
+        const size_t zone_id = std::rand() % zone_count;
+        zone_names.push_back(getZoneName(zone_id));
+        sub_names.push_back(Name("www").concatenate(zone_names.back()));
+        nx_names.push_back(Name("www.nxzone" +
+                                boost::lexical_cast<string>(zone_id) +
+                                ".tld" +
+                                boost::lexical_cast<string>(zone_id %
+                                                            TLD_COUNT)));
+    }
+
+    std::cout << "Benchmark for ClientList::find() of names in zones, "
+              << zone_count << " zones" << std::endl;
+    BenchMark<ListFindBenchMark>(iteration,
+                                 ListFindBenchMark(list, sub_names, false,
+                                                   false));
+    std::cout << "Benchmark for ClientList::find() of names in zones with "
+              << "finders, " << zone_count << " zones" << std::endl;
+    BenchMark<ListFindBenchMark>(iteration,
+                                 ListFindBenchMark(list, sub_names, false,
+                                                   true));
+    std::cout << "Benchmark for ClientList::find() of zone names by exact "
+              << "match, " << zone_count << " zones" << std::endl;
+    BenchMark<ListFindBenchMark>(iteration,
+                                 ListFindBenchMark(list, zone_names, true,
+                                                   false));
+    std::cout << "Benchmark for ClientList::find() of names in no zone, "
+              << zone_count << " zones" << std::endl;
+    BenchMark<ListFindBenchMark>(iteration,
+                                 ListFindBenchMark(list, nx_names, false,
+                                                   false));
+}
+
+const char* const MAPPED_FILE_DEFAULT = "client_list_bench.mapped";
+const char* const ZONE_COUNTS_DEFAULT = "1,100,10000";
+const size_t QUERY_COUNT_DEFAULT = 100000;
+
+void
+usage() {
+    std::cerr <<
+        "Usage: client_list_bench [-n iterations] [-c queries] "
+        "[-s zone_counts]\n"
+        "                         [-t local|mapped] [-m mapped_file]\n"
+        "  -n Number of iterations per test case (default: 1)\n"
+        "  -c Number of queries per test case (default: "
+              << QUERY_COUNT_DEFAULT << ")\n"
+        "  -s Comma separated numbers of zones to measure (default: "
+              << ZONE_COUNTS_DEFAULT << ")\n"
+        "  -t Type of the memory segment (default: local)\n"
+        "  -m File for the mapped segment (default: "
+              << MAPPED_FILE_DEFAULT << ")"
+              << std::endl;
+    exit (1);
+}
+}
+
+int
+main(int argc, char* argv[]) {
+    int ch;
+    int iteration = 1;
+    size_t query_count = QUERY_COUNT_DEFAULT;
+    string zone_counts_txt = ZONE_COUNTS_DEFAULT;
+    string segment_type = "local";
+    string mapped_file = MAPPED_FILE_DEFAULT;
+    while ((ch = getopt(argc, argv, "n:c:s:t:m:")) != -1) {
+        switch (ch) {
+        case 'n':
+            iteration = atoi(optarg);
+            break;
+        case 'c':
+            query_count = strtoul(optarg, NULL, 10);
+            break;
+        case 's':
+            zone_counts_txt = optarg;
+            break;
+        case 't':
+            segment_type = optarg;
+            break;
+        case 'm':
+            mapped_file = optarg;
+            break;
+        case '?':
+        default:
+            usage();
+        }
+    }
+    argc -= optind;
+    if (argc != 0 || iteration <= 0 || query_count == 0 ||
+        (segment_type != "local" && segment_type != "mapped")) {
+        usage();
+    }
+    vector<size_t> zone_counts;
+    std::stringstream ss(zone_counts_txt);
+    string count_txt;
+    while (std::getline(ss, count_txt, ',')) {
+        zone_counts.push_back(strtoul(count_txt.c_str(), NULL, 10));
+        if (zone_counts.back() == 0) {
+            usage();
+        }
+    }
+
+    // Logging is disabled to avoid unwanted noise.
+    bundy::log::initLogger("client-list-bench", bundy::log::NONE, 0, NULL);
+
+    int ret = 0;
+    try {
+        writeZoneFile();
+        std::srand(1);
+        for (size_t i = 0; i < zone_counts.size(); ++i) {
+            const boost::shared_ptr<ConfigurableClientList> list =
+                createList(zone_counts[i], segment_type, mapped_file);
+            runBenchMarks(*list, zone_counts[i], query_count, iteration);
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Benchmark failed: " << ex.what() << std::endl;
+        ret = 1;
+    }
+    unlink(ZONE_FILE);
+    if (segment_type == "mapped") {
+        unlink(mapped_file.c_str());
+    }
+    return (ret);
+}
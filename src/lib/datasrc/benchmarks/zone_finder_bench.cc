@@ -0,0 +1,349 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <bench/benchmark.h>
+
+#include <log/logger_support.h>
+
+#include <dns/name.h>
+#include <dns/rrclass.h>
+#include <dns/rrtype.h>
+#include <dns/rrset.h>
+
+#include <cc/data.h>
+
+#include <datasrc/zone_iterator.h>
+#include <datasrc/memory/memory_client.h>
+#include <datasrc/memory/zone_data.h>
+#include <datasrc/memory/zone_data_loader.h>
+#include <datasrc/memory/zone_finder.h>
+#include <datasrc/memory/zone_table.h>
+#include <datasrc/memory/zone_table_segment.h>
+#include <datasrc/memory/zone_writer.h>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+using std::string;
+using std::vector;
+using namespace bundy::bench;
+using namespace bundy::data;
+using namespace bundy::datasrc;
+using namespace bundy::datasrc::memory;
+using namespace bundy::dns;
+
+namespace {
+typedef std::pair<Name, RRType> Query;
+
+class FinderBenchMark {
+public:
+    FinderBenchMark(ZoneFinder& finder, const vector<Query>& queries) :
+        finder_(finder), queries_(queries)
+    {}
+    unsigned int run() {
+        vector<Query>::const_iterator it;
+        const vector<Query>::const_iterator it_end = queries_.end();
+        for (it = queries_.begin(); it != it_end; ++it) {
+            finder_.find(it->first, it->second);
+        }
+        return (queries_.size());
+    }
+private:
+    ZoneFinder& finder_;
+    const vector<Query>& queries_;
+};
+
+// The kinds of find() results we measure separately.  A query is classified
+// into one of them by actually performing find() before the benchmark.
+enum ResultKind {
+    KIND_SUCCESS = 0,
+    KIND_WILDCARD,
+    KIND_NXDOMAIN,
+    KIND_NXRRSET,
+    KIND_DELEGATION,
+    KIND_CNAME,
+    KIND_DNAME,
+    KIND_COUNT
+};
+
+const char* const kind_names[KIND_COUNT] = {
+    "SUCCESS", "SUCCESS (wildcard)", "NXDOMAIN", "NXRRSET", "DELEGATION",
+    "CNAME", "DNAME"
+};
+
+ResultKind
+classify(ZoneFinder& finder, const Query& query) {
+    const ZoneFinderContextPtr ctx = finder.find(query.first, query.second);
+    switch (ctx->code) {
+    case ZoneFinder::SUCCESS:
+        return (ctx->isWildcard() ? KIND_WILDCARD : KIND_SUCCESS);
+    case ZoneFinder::DELEGATION:
+        return (KIND_DELEGATION);
+    case ZoneFinder::NXDOMAIN:
+        return (KIND_NXDOMAIN);
+    case ZoneFinder::NXRRSET:
+        return (KIND_NXRRSET);
+    case ZoneFinder::CNAME:
+        return (KIND_CNAME);
+    case ZoneFinder::DNAME:
+        return (KIND_DNAME);
+    }
+    return (KIND_COUNT);
+}
+
+// Build the queries for each result kind from the zone contents: the
+// existing names and types, the same names with a type that shouldn't exist,
+// names under each of them (which match delegations, DNAMEs and wildcards),
+// and non existent names under the origin.  Each kind has "count" queries,
+// repeating the candidates if there are fewer of them, in random order.
+void
+generateQueries(const DataSourceClient& client, ZoneFinder& finder,
+                const Name& origin, size_t count,
+                vector<Query> (&queries)[KIND_COUNT])
+{
+    const RRType absent_type("TYPE65280");
+    vector<Query> candidates;
+    ZoneIteratorPtr iterator = client.getIterator(origin);
+    for (ConstRRsetPtr rrset = iterator->getNextRRset();
+         rrset;
+         rrset = iterator->getNextRRset()) {
+        if (rrset->getType() == RRType::RRSIG() ||
+            rrset->getType() == RRType::NSEC3()) {
+            continue;
+        }
+        Name owner(rrset->getName());
+        if (owner.isWildcard()) {
+            owner = owner.split(1);
+        }
+        candidates.push_back(Query(rrset->getName(), rrset->getType()));
+        candidates.push_back(Query(owner, absent_type));
+        candidates.push_back(Query(Name("bench-sub").concatenate(owner),
+                                   RRType::A()));
+    }
+    for (size_t i = 0; i < count; ++i) {
+        std::stringstream ss;
+        ss << "nx" << std::rand() << "." << origin;
+        candidates.push_back(Query(Name(ss.str()), RRType::A()));
+    }
+
+    vector<Query> classified[KIND_COUNT];
+    for (vector<Query>::const_iterator it = candidates.begin();
+         it != candidates.end();
+         ++it) {
+        classified[classify(finder, *it)].push_back(*it);
+    }
+    for (int kind = 0; kind < KIND_COUNT; ++kind) {
+        vector<Query>& src = classified[kind];
+        if (src.empty()) {
+            continue;
+        }
+        std::random_shuffle(src.begin(), src.end());
+        for (size_t i = 0; i < count; ++i) {
+            queries[kind].push_back(src[i % src.size()]);
+        }
+        std::random_shuffle(queries[kind].begin(), queries[kind].end());
+    }
+}
+
+// Write a synthetic zone of about the given number of names.  Most of them
+// are hosts spread over a few levels of subdomains with A RRs, and a fixed
+// portion of them are delegations (with glue), CNAMEs, DNAMEs and wildcards.
+void
+writeSyntheticZone(const string& file, const Name& origin, size_t names) {
+    std::ofstream zone(file.c_str());
+    zone << "$ORIGIN " << origin << "\n"
+         << "@ 3600 IN SOA ns1 hostmaster 1 3600 300 3600000 3600\n"
+         << "@ 3600 IN NS ns1\n"
+         << "ns1 3600 IN A 192.0.2.1\n";
+    for (size_t i = 0; i < names; ++i) {
+        const string sub = "sub" + boost::lexical_cast<string>(i % 1000);
+        const string id = boost::lexical_cast<string>(i);
+        switch (i % 100) {
+        case 0:
+            zone << "*.wild" << id << " 3600 IN A 192.0.2.2\n";
+            break;
+        case 1:
+            zone << "dname" << id << " 3600 IN DNAME example.net.\n";
+            break;
+        default:
+            if (i % 10 == 2) {
+                zone << "child" << id << "." << sub << " 3600 IN NS ns.child"
+                     << id << "." << sub << "\n"
+                     << "ns.child" << id << "." << sub
+                     << " 3600 IN A 192.0.2.3\n";
+            } else if (i % 20 == 3) {
+                zone << "alias" << id << "." << sub
+                     << " 3600 IN CNAME host" << id << "." << sub << "\n";
+            } else {
+                zone << "host" << id << "." << sub
+                     << " 3600 IN A 192.0.2.4\n";
+            }
+        }
+    }
+    if (!zone) {
+        bundy_throw(bundy::Unexpected, "failed to write " << file);
+    }
+}
+
+ZoneDataLoader*
+createLoader(bundy::util::MemorySegment& mem_sgmt, ZoneData* old_data,
+             const Name& origin, const string& zone_file)
+{
+    return (new ZoneDataLoader(mem_sgmt, RRClass::IN(), origin, zone_file,
+                               old_data));
+}
+
+const char* const MAPPED_FILE_DEFAULT = "zone_finder_bench.mapped";
+const char* const SYNTHETIC_FILE = "zone_finder_bench.zone";
+const size_t SYNTHETIC_NAMES_DEFAULT = 100000;
+const size_t QUERY_COUNT_DEFAULT = 10000;
+
+void
+usage() {
+    std::cerr <<
+        "Usage: zone_finder_bench [-n iterations] [-c queries] "
+        "[-t local|mapped]\n"
+        "                         [-m mapped_file] [-s names] "
+        "[-o origin] [zone_file]\n"
+        "  -n Number of iterations per test case (default: 1)\n"
+        "  -c Number of queries per result type (default: "
+              << QUERY_COUNT_DEFAULT << ")\n"
+        "  -t Type of the memory segment (default: local)\n"
+        "  -m File for the mapped segment (default: "
+              << MAPPED_FILE_DEFAULT << ")\n"
+        "  -s Number of names of the synthetic zone used if zone_file is\n"
+        "     not given (default: " << SYNTHETIC_NAMES_DEFAULT << ")\n"
+        "  -o Origin of the zone (default: example.org)"
+              << std::endl;
+    exit (1);
+}
+}
+
+int
+main(int argc, char* argv[]) {
+    int ch;
+    int iteration = 1;
+    size_t query_count = QUERY_COUNT_DEFAULT;
+    size_t synthetic_names = SYNTHETIC_NAMES_DEFAULT;
+    string segment_type = "local";
+    string mapped_file = MAPPED_FILE_DEFAULT;
+    string origin_txt = "example.org";
+    while ((ch = getopt(argc, argv, "n:c:t:m:s:o:")) != -1) {
+        switch (ch) {
+        case 'n':
+            iteration = atoi(optarg);
+            break;
+        case 'c':
+            query_count = strtoul(optarg, NULL, 10);
+            break;
+        case 't':
+            segment_type = optarg;
+            break;
+        case 'm':
+            mapped_file = optarg;
+            break;
+        case 's':
+            synthetic_names = strtoul(optarg, NULL, 10);
+            break;
+        case 'o':
+            origin_txt = optarg;
+            break;
+        case '?':
+        default:
+            usage();
+        }
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc > 1 || iteration <= 0 || query_count == 0 ||
+        (segment_type != "local" && segment_type != "mapped")) {
+        usage();
+    }
+
+    // Logging is disabled to avoid unwanted noise.
+    bundy::log::initLogger("zone-finder-bench", bundy::log::NONE, 0, NULL);
+
+    try {
+        const Name origin(origin_txt);
+        string zone_file;
+        if (argc == 1) {
+            zone_file = argv[0];
+        } else {
+            zone_file = SYNTHETIC_FILE;
+            writeSyntheticZone(zone_file, origin, synthetic_names);
+        }
+
+        boost::shared_ptr<ZoneTableSegment> ztable_segment(
+            ZoneTableSegment::create(RRClass::IN(), segment_type));
+        if (segment_type == "mapped") {
+            ztable_segment->reset(ZoneTableSegment::CREATE,
+                                  Element::fromJSON("{\"mapped-file\": \"" +
+                                                    mapped_file + "\"}"));
+        }
+        {
+            ZoneWriter writer(*ztable_segment,
+                              boost::bind(createLoader, _1, _2, origin,
+                                          zone_file),
+                              origin, RRClass::IN(), false);
+            writer.load();
+            writer.install();
+            writer.cleanup();
+        }
+        if (argc == 0) {
+            unlink(zone_file.c_str());
+        }
+
+        const InMemoryClient client("bench", ztable_segment, RRClass::IN());
+        const ZoneFinderPtr finder = client.findZone(origin).zone_finder;
+
+        std::srand(1);
+        vector<Query> queries[KIND_COUNT];
+        generateQueries(client, *finder, origin, query_count, queries);
+
+        std::cout << "Zone " << origin << " from "
+                  << (argc == 1 ? zone_file : "a synthetic zone") << " in a "
+                  << segment_type << " segment" << std::endl;
+        for (int kind = 0; kind < KIND_COUNT; ++kind) {
+            if (queries[kind].empty()) {
+                continue;
+            }
+            std::cout << "Benchmark for InMemoryZoneFinder::find() "
+                      << "resulting in " << kind_names[kind] << std::endl;
+            BenchMark<FinderBenchMark>(iteration,
+                                       FinderBenchMark(*finder,
+                                                       queries[kind]));
+        }
+
+        if (segment_type == "mapped") {
+            ztable_segment->clear();
+            unlink(mapped_file.c_str());
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Benchmark failed: " << ex.what() << std::endl;
+        return (1);
+    }
+    return (0);
+}
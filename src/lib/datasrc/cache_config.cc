@@ -54,6 +54,66 @@ getSegmentTypeFromConf(const Element& conf) {
     }
     return (conf.get("cache-type")->stringValue());
 }
+
+bool
+getNameIndexFromConf(const Element& conf) {
+    return (conf.contains("cache-name-index") &&
+            conf.get("cache-name-index")->boolValue());
+}
+
+bool
+getSharedLabelsFromConf(const Element& conf) {
+    return (conf.contains("cache-shared-labels") &&
+            conf.get("cache-shared-labels")->boolValue());
+}
+
+bool
+getSharedRdataFromConf(const Element& conf) {
+    return (conf.contains("cache-shared-rdata") &&
+            conf.get("cache-shared-rdata")->boolValue());
+}
+
+size_t
+getEncodeThreadsFromConf(const Element& conf) {
+    if (!conf.contains("cache-encode-threads")) {
+        return (0);
+    }
+    const int64_t count = conf.get("cache-encode-threads")->intValue();
+    if (count < 0) {
+        bundy_throw(CacheConfigError, "Negative cache-encode-threads: "
+                    << count);
+    }
+    return (count);
+}
+
+size_t
+getSampleRateFromConf(const Element& conf) {
+    if (!conf.contains("cache-sample-rate")) {
+        return (0);
+    }
+    const int64_t rate = conf.get("cache-sample-rate")->intValue();
+    if (rate < 0) {
+        bundy_throw(CacheConfigError, "Negative cache-sample-rate: " << rate);
+    }
+    return (rate);
+}
+
+std::string
+getHotNamesFileFromConf(const Element& conf) {
+    if (!conf.contains("cache-hot-names")) {
+        return ("");
+    }
+    return (conf.get("cache-hot-names")->stringValue());
+}
+
+std::string
+getImageFileFromConf(const Element& conf) {
+    if (!conf.contains("cache-image") ||
+        getSegmentTypeFromConf(conf) != "mapped") {
+        return ("");
+    }
+    return (conf.get("cache-image")->stringValue());
+}
 }
 
 CacheConfig::CacheConfig(const std::string& datasrc_type,
@@ -62,6 +122,13 @@ CacheConfig::CacheConfig(const std::string& datasrc_type,
                          bool allowed) :
     enabled_(allowed && getEnabledFromConf(datasrc_conf)),
     segment_type_(getSegmentTypeFromConf(datasrc_conf)),
+    name_index_(getNameIndexFromConf(datasrc_conf)),
+    shared_labels_(getSharedLabelsFromConf(datasrc_conf)),
+    encode_threads_(getEncodeThreadsFromConf(datasrc_conf)),
+    shared_rdata_(getSharedRdataFromConf(datasrc_conf)),
+    image_file_(getImageFileFromConf(datasrc_conf)),
+    sample_rate_(getSampleRateFromConf(datasrc_conf)),
+    hot_names_file_(getHotNamesFileFromConf(datasrc_conf)),
     datasrc_client_(datasrc_client)
 {
     ConstElementPtr params = datasrc_conf.get("params");
@@ -121,16 +188,30 @@ CacheConfig::CacheConfig(const std::string& datasrc_type,
 }
 
 namespace {
+// The optional parameters of ZoneDataLoader, bundled so that they are bound
+// as one argument (boost::bind doesn't take that many).
+struct LoaderParams {
+    bool build_name_index;
+    bool share_labels;
+    size_t encode_threads;
+    bool share_rdata;
+    std::string hot_names_file;
+};
+
 // We can't use the loadZoneData function directly in boost::bind, since
 // it is overloaded and the compiler can't choose the correct version
 // reliably and fails. So we simply wrap it into an unique name.
 memory::ZoneDataLoader*
 createLoaderFromFile(util::MemorySegment& segment, const dns::RRClass& rrclass,
                      const dns::Name& name, const std::string& filename,
-                     memory::ZoneData* old_data)
+                     const LoaderParams& params, memory::ZoneData* old_data)
 {
     return (new memory::ZoneDataLoader(segment, rrclass, name, filename,
-                                       old_data));
+                                       old_data, params.build_name_index,
+                                       params.share_labels,
+                                       params.encode_threads,
+                                       params.share_rdata,
+                                       params.hot_names_file));
 }
 
 memory::ZoneDataLoader*
@@ -138,10 +219,16 @@ createLoaderFromDataSource(util::MemorySegment& segment,
                            const dns::RRClass& rrclass,
                            const dns::Name& name,
                            const DataSourceClient* datasrc_client,
+                           const LoaderParams& params,
                            memory::ZoneData* old_data)
 {
     return (new memory::ZoneDataLoader(segment, rrclass, name,
-                                       *datasrc_client, old_data));
+                                       *datasrc_client, old_data,
+                                       params.build_name_index,
+                                       params.share_labels,
+                                       params.encode_threads,
+                                       params.share_rdata,
+                                       params.hot_names_file));
 }
 
 } // unnamed namespace
@@ -156,10 +243,13 @@ CacheConfig::getLoaderCreator(const dns::RRClass& rrclass,
         return (memory::ZoneDataLoaderCreator());
     }
 
+    const LoaderParams params = { name_index_, shared_labels_,
+                                  encode_threads_, shared_rdata_,
+                                  hot_names_file_ };
     if (!found->second.empty()) {
         // This is "MasterFiles" data source.
         return (boost::bind(createLoaderFromFile, _1, rrclass, zone_name,
-                            found->second, _2));
+                            found->second, params, _2));
     }
 
     // Otherwise there must be a "source" data source (ensured by constructor)
@@ -175,7 +265,7 @@ CacheConfig::getLoaderCreator(const dns::RRClass& rrclass,
     // Wrap the iterator into the correct functor (which keeps it alive as
     // long as it is needed).
     return (boost::bind(createLoaderFromDataSource, _1, rrclass, zone_name,
-                        datasrc_client_, _2));
+                        datasrc_client_, params, _2));
 }
 
 } // namespace internal
@@ -107,7 +107,36 @@ public:
     ///
     /// This constructor also identifies the underlying memory segment type
     /// used for the cache.  It's given via the "cache-type" configuration
-    /// item if defined; otherwise it defaults to "local".
+    /// item if defined; otherwise it defaults to "local".  The "local-slab"
+    /// type is a local segment whose small allocations are served by a
+    /// slab allocator (see \c util::MemorySegmentSlab).
+    ///
+    /// Likewise, whether to build the exact-match name index of cached
+    /// zones (see \c memory::ZoneNameIndex) is given via the
+    /// "cache-name-index" boolean configuration item; it defaults to false.
+    /// Whether the nodes of cached zones share identical labels (see
+    /// \c memory::ZoneData::create()) is given via the "cache-shared-labels"
+    /// boolean configuration item; it also defaults to false.  So does
+    /// "cache-shared-rdata", which tells whether the \c RdataSets of cached
+    /// zones share identical encoded RDATA (see
+    /// \c memory::ZoneData::getRdataPool()).
+    /// The number of threads encoding the RDATA of zones being loaded (see
+    /// \c memory::ZoneDataUpdater::addBatch()) is given via the
+    /// "cache-encode-threads" integer configuration item; it defaults to 0,
+    /// i.e., the RDATA are encoded by the loading thread.  A negative
+    /// value results in \c CacheConfigError.
+    ///
+    /// The optional "cache-image" string configuration item specifies the
+    /// file name of a prebuilt image of the zone table (see
+    /// \c getImageFile()).  It's only meaningful for the "mapped" segment
+    /// type; it's ignored otherwise.
+    ///
+    /// The optional "cache-sample-rate" integer configuration item enables
+    /// sampling of the names found in cached zones if positive (see
+    /// \c getSampleRate()); a negative value results in
+    /// \c CacheConfigError.  The optional "cache-hot-names" string
+    /// configuration item specifies the file of the most frequently found
+    /// names (see \c getHotNamesFile()).
     ///
     /// \throw InvalidParameter Program error at the caller side rather than
     /// in the configuration (see above)
@@ -147,6 +176,58 @@ public:
     /// \throw None
     const std::string& getSegmentType() const { return (segment_type_); }
 
+    /// \brief Return if the name index should be built for cached zones.
+    ///
+    /// \throw None
+    bool isNameIndexEnabled() const { return (name_index_); }
+
+    /// \brief Return if the nodes of cached zones should share labels.
+    ///
+    /// \throw None
+    bool isSharedLabelsEnabled() const { return (shared_labels_); }
+
+    /// \brief Return the number of threads encoding RDATA on load.
+    ///
+    /// \throw None
+    size_t getEncodeThreads() const { return (encode_threads_); }
+
+    /// \brief Return if the \c RdataSets of cached zones should share
+    /// RDATA.
+    ///
+    /// \throw None
+    bool isSharedRdataEnabled() const { return (shared_rdata_); }
+
+    /// \brief Return the file name of a prebuilt zone table image.
+    ///
+    /// It's a mapped file built offline (e.g., by bundy-zonecompile) from
+    /// the same set of zones as configured for this cache.  It allows the
+    /// application to map and use the image immediately, instead of waiting
+    /// for the zones to be loaded by the memory manager.
+    ///
+    /// It returns an empty string if the image isn't configured or the
+    /// segment type isn't "mapped".
+    ///
+    /// \throw None
+    const std::string& getImageFile() const { return (image_file_); }
+
+    /// \brief Return the rate of sampling the names found in cached zones.
+    ///
+    /// If it's positive, one of this number of lookups in cached zones is
+    /// sampled (see \c memory::ZoneNodeSampler); 0 means no sampling.
+    ///
+    /// \throw None
+    size_t getSampleRate() const { return (sample_rate_); }
+
+    /// \brief Return the file name of the most frequently found names.
+    ///
+    /// The sampled names are written to this file by the application that
+    /// finds them, and the nodes of the names are packed together when the
+    /// zones are loaded into the cache (see \c memory::ZoneDataLoader).
+    /// It returns an empty string if the file isn't configured.
+    ///
+    /// \throw None
+    const std::string& getHotNamesFile() const { return (hot_names_file_); }
+
     /// \brief Return a \c LoadAction functor to load zone data into memory.
     ///
     /// This method returns an appropriate \c LoadAction functor that can be
@@ -229,9 +310,25 @@ public:
     /// \brief Return the end of cached zones in the form of iterator.
     ConstZoneIterator end() const { return (zone_config_.end()); }
 
+    /// \brief Return the first cached zone following the given name.
+    ///
+    /// The zones are iterated in the DNSSEC order of their names, so this
+    /// can be used to resume an iteration after \c zone_name, whether or
+    /// not it's still configured.
+    ConstZoneIterator upperBound(const dns::Name& zone_name) const {
+        return (zone_config_.upper_bound(zone_name));
+    }
+
 private:
     const bool enabled_; // if the use of in-memory zone table is enabled
     const std::string segment_type_;
+    const bool name_index_; // whether to build name index of cached zones
+    const bool shared_labels_; // whether cached zones share node labels
+    const size_t encode_threads_; // threads encoding RDATA on load
+    const bool shared_rdata_; // whether cached zones share RDATA
+    const std::string image_file_; // prebuilt image of the zone table
+    const size_t sample_rate_; // rate of sampling found names, 0 if none
+    const std::string hot_names_file_; // file of most frequently found names
     // client of underlying data source, will be NULL for MasterFile datasrc
     const DataSourceClient* datasrc_client_;
 
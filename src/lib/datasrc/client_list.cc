@@ -18,16 +18,25 @@
 #include <datasrc/client.h>
 #include <datasrc/factory.h>
 #include <datasrc/cache_config.h>
+#include <datasrc/memory/domaintree.h>
 #include <datasrc/memory/memory_client.h>
+#include <datasrc/memory/zone_data.h>
+#include <datasrc/memory/zone_table.h>
 #include <datasrc/memory/zone_table_segment.h>
 #include <datasrc/memory/zone_writer.h>
 #include <datasrc/memory/zone_data_loader.h>
 #include <datasrc/memory/zone_data_updater.h>
+#include <datasrc/memory/zone_node_sampler.h>
 #include <datasrc/logger.h>
 #include <datasrc/zone_table_accessor_cache.h>
 #include <dns/masterload.h>
 #include <util/memory_segment_local.h>
+#include <util/threads/sync.h>
+#include <util/threads/thread.h>
 
+#include <cstdio>
+#include <fstream>
+#include <iterator>
 #include <memory>
 #include <set>
 #include <boost/foreach.hpp>
@@ -38,16 +47,320 @@ using namespace bundy::data;
 using namespace bundy::dns;
 using namespace std;
 using bundy::util::MemorySegment;
+using bundy::util::MemorySegmentLocal;
+using bundy::util::thread::Mutex;
+using bundy::util::thread::Thread;
 using boost::lexical_cast;
 using boost::shared_ptr;
 using boost::dynamic_pointer_cast;
 using bundy::datasrc::memory::InMemoryClient;
 using bundy::datasrc::memory::ZoneTableSegment;
 using bundy::datasrc::memory::ZoneDataUpdater;
+using bundy::datasrc::memory::ZoneNodeSampler;
 
 namespace bundy {
 namespace datasrc {
 
+namespace {
+
+// The maximum number of different names counted by the sampler of a cache.
+// Less popular names beyond this are simply not counted, which is fine as
+// only the most popular ones matter.
+const size_t MAX_SAMPLED_NAMES = 100000;
+
+// Map the prebuilt zone table image for the cache of a data source.  On
+// failure the segment is left unusable, and will be reset later as if the
+// image weren't configured.
+void
+mapCacheImage(ZoneTableSegment& segment, const string& image_file,
+              const string& datasrc_name)
+{
+    ElementPtr params(Element::createMap());
+    params->set("mapped-file", Element::create(image_file));
+    try {
+        segment.reset(ZoneTableSegment::READ_ONLY, params);
+        LOG_INFO(logger, DATASRC_LIST_CACHE_IMAGE_MAPPED).arg(image_file).
+            arg(datasrc_name);
+    } catch (const bundy::Exception& ex) {
+        LOG_WARN(logger, DATASRC_LIST_CACHE_IMAGE_ERROR).arg(image_file).
+            arg(datasrc_name).arg(ex.what());
+    }
+}
+
+// Load the zones of a cache concurrently into a local zone table segment.
+//
+// Each zone is loaded by one of the threads into a private local memory
+// segment of the same type as the zone table's, so the loaders never share
+// any state of a segment (such as named addresses).  The loaded data are then
+// adopted by the memory segment of the zone table and installed in the table,
+// which is serialized by a mutex.
+// As with ZoneWriter for the initial load, a zone that fails to load is
+// installed as an empty zone.
+class ParallelZoneLoader : boost::noncopyable {
+public:
+    ParallelZoneLoader(ZoneTableSegment& zt_segment,
+                       const internal::CacheConfig& cache_conf,
+                       const RRClass& rrclass, const string& datasrc_name,
+                       const ConfigurableClientList::LoadProgressCallback&
+                       progress_callback) :
+        table_sgmt_(dynamic_cast<MemorySegmentLocal&>(
+                        zt_segment.getMemorySegment())),
+        table_(zt_segment.getHeader().getTable()),
+        cache_conf_(cache_conf), rrclass_(rrclass),
+        datasrc_name_(datasrc_name), progress_callback_(progress_callback),
+        next_zone_(cache_conf.begin()), failed_(false)
+    {
+        assert(table_);
+    }
+
+    // Load all zones with the given number of threads.  If any thread
+    // fails with an exception, the others stop after their current zones,
+    // and the error is propagated as Thread::UncaughtException.
+    void run(size_t thread_count) {
+        vector<boost::shared_ptr<Thread> > threads;
+        try {
+            for (size_t i = 0; i < thread_count; ++i) {
+                threads.push_back(boost::shared_ptr<Thread>(
+                    new Thread(boost::bind(&ParallelZoneLoader::loadZones,
+                                           this))));
+            }
+        } catch (...) {
+            stop();
+            waitAll(threads);
+            throw;
+        }
+        waitAll(threads);
+    }
+
+private:
+    static void waitAll(const vector<boost::shared_ptr<Thread> >& threads) {
+        // Wait for all threads before propagating an error, as they refer
+        // to this object.
+        bool failed = false;
+        string what;
+        BOOST_FOREACH(const boost::shared_ptr<Thread>& thread, threads) {
+            try {
+                thread->wait();
+            } catch (const Thread::UncaughtException& ex) {
+                if (!failed) {
+                    failed = true;
+                    what = ex.what();
+                }
+            }
+        }
+        if (failed) {
+            bundy_throw(Thread::UncaughtException, what);
+        }
+    }
+
+    void stop() {
+        Mutex::Locker locker(mutex_);
+        failed_ = true;
+    }
+
+    // Get the next zone to load, NULL if there's no more (or we stop).
+    const Name* getNextZone() {
+        Mutex::Locker locker(mutex_);
+        if (failed_ || next_zone_ == cache_conf_.end()) {
+            return (NULL);
+        }
+        return (&(next_zone_++)->first);
+    }
+
+    // The main routine of the threads.
+    void loadZones() {
+        try {
+            const Name* zname;
+            while ((zname = getNextZone()) != NULL) {
+                loadZone(*zname);
+            }
+        } catch (...) {
+            stop();
+            throw;
+        }
+    }
+
+    void loadZone(const Name& zname) {
+        memory::ZoneDataLoaderCreator loader_creator;
+        try {
+            loader_creator = cache_conf_.getLoaderCreator(rrclass_, zname);
+        } catch (const NoSuchZone&) {
+            LOG_ERROR(logger, DATASRC_CACHE_ZONE_NOTFOUND).
+                arg(zname).arg(rrclass_).arg(datasrc_name_);
+            Mutex::Locker locker(mutex_);
+            reportLoaded();
+            return;
+        }
+        assert(loader_creator);
+
+        const boost::scoped_ptr<MemorySegmentLocal>
+            mem_sgmt(table_sgmt_.createPeer());
+        memory::ZoneData* zone_data = NULL;
+        try {
+            const boost::scoped_ptr<memory::ZoneDataLoader>
+                loader(loader_creator(*mem_sgmt, NULL));
+            zone_data = loader->load();
+        } catch (const ZoneLoaderException& ex) {
+            LOG_ERROR(logger, DATASRC_LOAD_ZONE_ERROR).arg(zname).
+                arg(rrclass_).arg(datasrc_name_).arg(ex.what());
+        }
+
+        Mutex::Locker locker(mutex_);
+        table_sgmt_.adopt(*mem_sgmt);
+        try {
+            const memory::ZoneTable::AddResult result(
+                zone_data ? table_->addZone(table_sgmt_, zname, zone_data) :
+                table_->addEmptyZone(table_sgmt_, zname));
+            if (result.zone_data) {
+                // Shouldn't happen as the zones are distinct, but in case.
+                memory::ZoneData::destroy(table_sgmt_, result.zone_data,
+                                          rrclass_);
+            }
+        } catch (...) {
+            if (zone_data) {
+                memory::ZoneData::destroy(table_sgmt_, zone_data, rrclass_);
+            }
+            throw;
+        }
+        reportLoaded();
+    }
+
+    // Must be called with mutex_ held.
+    void reportLoaded() {
+        if (progress_callback_) {
+            progress_callback_(0, 1);
+        }
+    }
+
+    MemorySegmentLocal& table_sgmt_;
+    memory::ZoneTable* const table_;
+    const internal::CacheConfig& cache_conf_;
+    const RRClass rrclass_;
+    const string datasrc_name_;
+    const ConfigurableClientList::LoadProgressCallback& progress_callback_;
+
+    // Protects the following members and the zone table.
+    Mutex mutex_;
+    internal::CacheConfig::ConstZoneIterator next_zone_;
+    bool failed_;
+};
+
+// The index is used only for lists of at least this many data sources.  With
+// fewer, searching each of them is no more expensive than the index lookup
+// and the check of its result in findInternal().
+const size_t ZONE_INDEX_MIN_DATA_SOURCES = 3;
+
+void
+deleteNoIndexEntry(void*) {
+    // The index entries are not allocated in the tree; nothing to delete.
+}
+}
+
+// An index of the zones of all the data sources of a list.
+//
+// It maps each zone name to be cached by any of the data sources to the
+// first data source that caches it, so findInternal() can identify the best
+// matching zone and its data source with a single lookup of the name.  It's
+// built from the cache configurations of the data sources on configure().
+// The zone table of a data source may have fewer zones than configured
+// (e.g., a mapped image may lack some of them), so findInternal() checks
+// the result with the data source; a table never has zones that aren't
+// configured, so the index can't miss a better match.
+class ConfigurableClientList::ZoneIndex : boost::noncopyable {
+public:
+    struct Entry {
+        Entry(size_t position_param, size_t labels_param) :
+            position(position_param), labels(labels_param)
+        {}
+        size_t position;        // of the data source in the list
+        size_t labels;          // the number of labels of the zone name
+    };
+
+    // Return a new index of the given data sources, or NULL if they should
+    // not be indexed.  Those of the list must all be cached.
+    static ZoneIndex* create(const DataSources& data_sources) {
+        if (data_sources.size() < ZONE_INDEX_MIN_DATA_SOURCES) {
+            return (NULL);
+        }
+        BOOST_FOREACH(const DataSourceInfo& info, data_sources) {
+            if (!info.cache_) {
+                return (NULL);
+            }
+        }
+        return (new ZoneIndex(data_sources));
+    }
+
+    ~ZoneIndex() {
+        IndexTree::destroy(mem_sgmt_, tree_, deleteNoIndexEntry);
+    }
+
+    // Return if this index was built for the given data sources, and they
+    // can be searched.  Tests may replace the data sources of the list
+    // after configure().
+    bool isUsable(const DataSources& data_sources) const {
+        if (data_sources.size() != clients_.size()) {
+            return (false);
+        }
+        for (size_t i = 0; i < clients_.size(); ++i) {
+            if (data_sources[i].cache_.get() != clients_[i] ||
+                !data_sources[i].ztable_segment_->isUsable()) {
+                return (false);
+            }
+        }
+        return (true);
+    }
+
+    // Return the entry of the zone that best matches the given name, or
+    // NULL if there's none.
+    const Entry* find(const Name& name) const {
+        const IndexNode* node;
+        if (tree_->find(name, &node) == IndexTree::NOTFOUND) {
+            return (NULL);
+        }
+        return (node->getData());
+    }
+
+    size_t getZoneCount() const { return (entries_.size()); }
+
+private:
+    typedef memory::DomainTree<Entry> IndexTree;
+    typedef memory::DomainTreeNode<Entry> IndexNode;
+
+    ZoneIndex(const DataSources& data_sources) {
+        // The tree nodes point to the entries, so they must not be
+        // reallocated.
+        size_t zone_count = 0;
+        BOOST_FOREACH(const DataSourceInfo& info, data_sources) {
+            const internal::CacheConfig& conf = *info.getCacheConfig();
+            zone_count += distance(conf.begin(), conf.end());
+        }
+        entries_.reserve(zone_count);
+
+        tree_ = IndexTree::create(mem_sgmt_);
+        for (size_t i = 0; i < data_sources.size(); ++i) {
+            const internal::CacheConfig& conf =
+                *data_sources[i].getCacheConfig();
+            for (internal::CacheConfig::ConstZoneIterator it = conf.begin();
+                 it != conf.end();
+                 ++it) {
+                IndexNode* node;
+                tree_->insert(mem_sgmt_, it->first, &node);
+                // The first data source of the zone wins.
+                if (node->getData() == NULL) {
+                    entries_.push_back(Entry(i, it->first.getLabelCount()));
+                    node->setData(&entries_.back());
+                }
+            }
+            clients_.push_back(data_sources[i].cache_.get());
+        }
+    }
+
+    MemorySegmentLocal mem_sgmt_;
+    IndexTree* tree_;
+    vector<Entry> entries_;
+    vector<const InMemoryClient*> clients_;
+};
+
 ConfigurableClientList::DataSourceInfo::DataSourceInfo(
     DataSourceClient* data_src_client,
     const DataSourceClientContainerPtr& container,
@@ -61,7 +374,12 @@ ConfigurableClientList::DataSourceInfo::DataSourceInfo(
     if (cache_conf_ && cache_conf_->isEnabled()) {
         ztable_segment_.reset(ZoneTableSegment::create(
                                   rrclass, cache_conf_->getSegmentType()));
-        cache_.reset(new InMemoryClient(name_, ztable_segment_, rrclass));
+        if (cache_conf_->getSampleRate() > 0) {
+            sampler_.reset(new ZoneNodeSampler(cache_conf_->getSampleRate(),
+                                               MAX_SAMPLED_NAMES));
+        }
+        cache_.reset(new InMemoryClient(name_, ztable_segment_, rrclass,
+                                        sampler_));
     }
 }
 
@@ -73,7 +391,8 @@ ConfigurableClientList::DataSourceInfo::getCacheClient() const {
 ConfigurableClientList::ConfigurableClientList(const RRClass& rrclass) :
     rrclass_(rrclass),
     configuration_(new bundy::data::ListElement),
-    allow_cache_(false)
+    allow_cache_(false),
+    load_thread_count_(1)
 {}
 
 void
@@ -150,6 +469,11 @@ ConfigurableClientList::configure(const ConstElementPtr& config,
             }
             memory::ZoneTableSegment& zt_segment =
                 *new_data_sources.back().ztable_segment_;
+            if (!zt_segment.isUsable() &&
+                !cache_conf->getImageFile().empty()) {
+                mapCacheImage(zt_segment, cache_conf->getImageFile(),
+                              datasrc_name);
+            }
             if (!zt_segment.isWritable()) {
                 LOG_DEBUG(logger, DBGLVL_TRACE_BASIC,
                           DATASRC_LIST_CACHE_PENDING).arg(datasrc_name);
@@ -158,6 +482,18 @@ ConfigurableClientList::configure(const ConstElementPtr& config,
 
             internal::CacheConfig::ConstZoneIterator end_of_zones =
                 cache_conf->end();
+            if (load_progress_callback_) {
+                load_progress_callback_(distance(cache_conf->begin(),
+                                                 end_of_zones), 0);
+            }
+            if (load_thread_count_ > 1 && type == "MasterFiles" &&
+                (zt_segment.getImplType() == "local" ||
+                 zt_segment.getImplType() == "local-slab")) {
+                ParallelZoneLoader(zt_segment, *cache_conf, rrclass_,
+                                   datasrc_name, load_progress_callback_).
+                    run(load_thread_count_);
+                continue;
+            }
             for (internal::CacheConfig::ConstZoneIterator zone_it =
                      cache_conf->begin();
                  zone_it != end_of_zones;
@@ -186,12 +522,23 @@ ConfigurableClientList::configure(const ConstElementPtr& config,
                     LOG_ERROR(logger, DATASRC_CACHE_ZONE_NOTFOUND).
                         arg(zname).arg(rrclass_).arg(datasrc_name);
                 }
+                if (load_progress_callback_) {
+                    load_progress_callback_(0, 1);
+                }
             }
         }
         // If everything is OK up until now, we have the new configuration
         // ready. So just put it there and let the old one die when we exit
         // the scope.
+        boost::shared_ptr<const ZoneIndex> zone_index(
+            ZoneIndex::create(new_data_sources));
+        if (zone_index) {
+            LOG_DEBUG(logger, DBGLVL_TRACE_BASIC, DATASRC_LIST_ZONE_INDEX).
+                arg(zone_index->getZoneCount()).arg(new_data_sources.size()).
+                arg(rrclass_);
+        }
         data_sources_.swap(new_data_sources);
+        zone_index_ = zone_index;
         configuration_ = config;
         allow_cache_ = allow_cache;
     } catch (const TypeError& te) {
@@ -276,6 +623,33 @@ ConfigurableClientList::findInternal(MutableResult& candidate,
                                      const dns::Name& name,
                                      bool want_exact_match, bool) const
 {
+    // If we have the index, it tells the data source with the best match.
+    // We confirm it with the zone table of the data source (see ZoneIndex),
+    // and take its result as if we had searched all of them in turn.
+    if (zone_index_ && zone_index_->isUsable(data_sources_)) {
+        const ZoneIndex::Entry* entry = zone_index_->find(name);
+        if (entry == NULL) {
+            return;
+        }
+        const bool exact = (entry->labels == name.getLabelCount());
+        if (want_exact_match && !exact) {
+            return;
+        }
+        const DataSourceInfo& info = data_sources_[entry->position];
+        const DataSourceClient::FindResult result(info.cache_->findZone(name));
+        if (result.code == (exact ? result::SUCCESS : result::PARTIALMATCH) &&
+            result.label_count == entry->labels) {
+            candidate.datasrc_client = info.cache_.get();
+            candidate.finder = result.zone_finder;
+            candidate.matched = true;
+            candidate.matched_labels = result.label_count;
+            candidate.exact = exact;
+            candidate.info = &info;
+            return;
+        }
+        // Otherwise the zone isn't in the table; search them all.
+    }
+
     BOOST_FOREACH(const DataSourceInfo& info, data_sources_) {
         DataSourceClient* client(info.cache_ ? info.cache_.get() :
                                  info.data_src_client_);
@@ -428,6 +802,80 @@ ConfigurableClientList::getStatus() const {
     return (result);
 }
 
+ElementPtr
+ConfigurableClientList::getZoneMemoryUsage() const {
+    ElementPtr result = Element::createMap();
+    BOOST_FOREACH(const DataSourceInfo& info, data_sources_) {
+        if (!info.ztable_segment_ || !info.ztable_segment_->isUsable()) {
+            continue;
+        }
+        const memory::ZoneTable* table =
+            info.ztable_segment_->getHeader().getTable();
+        const internal::CacheConfig* config = info.getCacheConfig();
+        ElementPtr zones = Element::createMap();
+        for (internal::CacheConfig::ConstZoneIterator it = config->begin();
+             it != config->end();
+             ++it) {
+            const memory::ZoneTable::FindResult found =
+                table->findZone(it->first);
+            if (found.code != result::SUCCESS || found.zone_data == NULL) {
+                continue;       // not loaded
+            }
+            const memory::ZoneData::MemoryUsage usage =
+                found.zone_data->getMemoryUsage(rrclass_);
+            ElementPtr zone = Element::createMap();
+            zone->set("nodes", Element::create(
+                          static_cast<long int>(usage.nodes)));
+            zone->set("rdatasets", Element::create(
+                          static_cast<long int>(usage.rdatasets)));
+            zone->set("nsec3", Element::create(
+                          static_cast<long int>(usage.nsec3)));
+            zone->set("total", Element::create(
+                          static_cast<long int>(usage.total)));
+            zones->set(it->first.toText(), zone);
+        }
+        result->set(info.name_, zones);
+    }
+    return (result);
+}
+
+ElementPtr
+ConfigurableClientList::saveHotNames(size_t max_names) const {
+    ElementPtr result = Element::createMap();
+    BOOST_FOREACH(const DataSourceInfo& info, data_sources_) {
+        if (!info.sampler_ ||
+            info.getCacheConfig()->getHotNamesFile().empty()) {
+            continue;
+        }
+        const string& filename = info.getCacheConfig()->getHotNamesFile();
+        const ZoneNodeSampler::HotNames names =
+            info.sampler_->getHotNames(max_names);
+
+        // Write to a temporary file and rename it, so the loader never
+        // sees a partially written file.
+        const string tmp_filename = filename + ".tmp";
+        {
+            ofstream ofs(tmp_filename.c_str());
+            ZoneNodeSampler::writeHotNames(ofs, names);
+            ofs.close();
+            if (!ofs) {
+                std::remove(tmp_filename.c_str());
+                bundy_throw(DataSourceError, "failed to write hot names of "
+                            "data source " << info.name_ << " to "
+                            << tmp_filename);
+            }
+        }
+        if (std::rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+            std::remove(tmp_filename.c_str());
+            bundy_throw(DataSourceError, "failed to rename " << tmp_filename
+                        << " to " << filename);
+        }
+        result->set(info.name_,
+                    Element::create(static_cast<long int>(names.size())));
+    }
+    return (result);
+}
+
 ConstZoneTableAccessorPtr
 ConfigurableClientList::getZoneTableAccessor(const std::string& datasrc_name,
                                              bool use_cache) const
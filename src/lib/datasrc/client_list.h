@@ -25,6 +25,7 @@
 #include <datasrc/zone_table_accessor.h>
 
 #include <vector>
+#include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/noncopyable.hpp>
@@ -44,6 +45,7 @@ typedef boost::shared_ptr<DataSourceClientContainer>
 // and hide real definitions except for itself and tests.
 namespace memory {
 class InMemoryClient;
+class ZoneNodeSampler;
 class ZoneWriter;
 }
 
@@ -371,6 +373,36 @@ public:
     void configure(const bundy::data::ConstElementPtr& configuration,
                    bool allow_cache);
 
+    /// \brief Set the number of threads to load zones in \c configure().
+    ///
+    /// If it's larger than 1, zones of "MasterFiles" data sources cached in
+    /// local memory segments are loaded by that many threads concurrently;
+    /// only installing the loaded data in the zone table is serialized.
+    /// Other types of data sources share a single data source client among
+    /// the zones, and shared memory segments can't be updated concurrently,
+    /// so their zones are always loaded one by one.  The default is 1.
+    ///
+    /// \param count The number of threads.  0 is regarded as 1.
+    void setLoadThreadCount(size_t count) {
+        load_thread_count_ = count;
+    }
+
+    /// \brief Type of the callback to report progress of loading zones.
+    ///
+    /// It's called with increments since the previous call: the number
+    /// of zones found to be loaded, and the number of zones whose load has
+    /// completed (successfully or not).  It can be called from any of the
+    /// loading threads, but the calls are serialized.  It must not throw.
+    typedef boost::function<void(size_t zones_found, size_t zones_loaded)>
+    LoadProgressCallback;
+
+    /// \brief Set the callback to report progress of \c configure().
+    ///
+    /// An empty functor (the default) disables it.
+    void setLoadProgressCallback(const LoadProgressCallback& callback) {
+        load_progress_callback_ = callback;
+    }
+
     /// \brief Returns the currently active configuration.
     ///
     /// In case configure was not called yet, it returns an empty
@@ -475,6 +507,9 @@ public:
         const DataSourceClient* getCacheClient() const;
         boost::shared_ptr<memory::InMemoryClient> cache_;
         boost::shared_ptr<memory::ZoneTableSegment> ztable_segment_;
+        // Samples the names found in the cache, if it's configured with
+        // cache-sample-rate; NULL otherwise.
+        boost::shared_ptr<memory::ZoneNodeSampler> sampler_;
         std::string name_;
 
         // cache_conf_ can be accessed only from this read-only getter,
@@ -531,6 +566,41 @@ public:
     /// it is exception free.
     std::vector<DataSourceStatus> getStatus() const;
 
+    /// \brief Get the memory used by the zones cached in memory.
+    ///
+    /// The result maps the names of the data sources whose cache is
+    /// usable to maps from the names of their loaded zones to the number
+    /// of bytes used by the zone: for the tree nodes ("nodes"), for the
+    /// \c RdataSets ("rdatasets"), for the NSEC3 data ("nsec3") and in
+    /// total ("total").  See \c memory::ZoneData::getMemoryUsage().
+    ///
+    /// This walks all the cached zones, so it takes time proportional to
+    /// their size.  The caller must make sure the zones are not modified
+    /// in the meantime.
+    ///
+    /// This may throw standard exceptions, such as std::bad_alloc. Otherwise,
+    /// it is exception free.
+    data::ElementPtr getZoneMemoryUsage() const;
+
+    /// \brief Save the most frequently found names in the cached zones.
+    ///
+    /// For each data source whose cache samples the names found in it and
+    /// has a file of them configured (see
+    /// \c internal::CacheConfig::getSampleRate() and
+    /// \c internal::CacheConfig::getHotNamesFile()), it writes the most
+    /// frequently found names to the file, replacing it atomically.  When
+    /// the zones are loaded into the cache next time (normally by the
+    /// memory manager), the nodes of these names are packed together in
+    /// memory.
+    ///
+    /// \throw DataSourceError A file can't be written.
+    /// \throw Other standard exceptions, such as std::bad_alloc.
+    ///
+    /// \param max_names The maximum number of names written per data source.
+    /// \return A map from the names of the data sources whose names are
+    /// written to the number of names written.
+    data::ElementPtr saveHotNames(size_t max_names) const;
+
     /// \brief Access to the data source clients.
     ///
     /// It can be used to examine the loaded list of data sources clients
@@ -577,6 +647,17 @@ private:
     /// \brief The last set value of allow_cache.
     bool allow_cache_;
 
+    /// \brief Zone loading parameters of configure().
+    size_t load_thread_count_;
+    LoadProgressCallback load_progress_callback_;
+
+    /// \brief Index of the zones of all the data sources.
+    ///
+    /// It's built by configure() if it makes find() faster (see
+    /// findInternal()), and NULL otherwise.
+    class ZoneIndex;
+    boost::shared_ptr<const ZoneIndex> zone_index_;
+
 protected:
     /// \brief The data sources held here.
     ///
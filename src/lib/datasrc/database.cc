@@ -85,7 +85,8 @@ private:
 DatabaseClient::DatabaseClient(const std::string& datasrc_name, RRClass rrclass,
                                boost::shared_ptr<DatabaseAccessor>
                                accessor) :
-    DataSourceClient(datasrc_name), rrclass_(rrclass), accessor_(accessor)
+    DataSourceClient(datasrc_name), rrclass_(rrclass), accessor_(accessor),
+    cache_(new DatabaseCache)
 {
     if (!accessor_) {
         bundy_throw(bundy::InvalidParameter,
@@ -100,7 +101,8 @@ DatabaseClient::findZone(const Name& name) const {
     if (zone.first) {
         return (FindResult(result::SUCCESS,
                            ZoneFinderPtr(new Finder(accessor_,
-                                                    zone.second, name)),
+                                                    zone.second, name,
+                                                    cache_)),
                            name.getLabelCount()));
     }
     // Then super domains
@@ -112,7 +114,8 @@ DatabaseClient::findZone(const Name& name) const {
             return (FindResult(result::PARTIALMATCH,
                                ZoneFinderPtr(new Finder(accessor_,
                                                         zone.second,
-                                                        superdomain)),
+                                                        superdomain,
+                                                        cache_)),
 
                                superdomain.getLabelCount()));
         }
@@ -142,15 +145,44 @@ DatabaseClient::deleteZone(const Name& zone_name) {
     }
     accessor_->deleteZone(zinfo.second);
     transaction.commit();
+    cache_->invalidate(zone_name);
     return (true);
 }
 
 DatabaseClient::Finder::Finder(boost::shared_ptr<DatabaseAccessor> accessor,
-                               int zone_id, const bundy::dns::Name& origin) :
+                               int zone_id, const bundy::dns::Name& origin,
+                               const boost::shared_ptr<DatabaseCache>& cache) :
     accessor_(accessor),
     zone_id_(zone_id),
-    origin_(origin)
-{ }
+    origin_(origin),
+    cache_generation_(0)
+{
+    if (!cache || cache->getMaxEntries() == 0) {
+        return;
+    }
+
+    // Check the cached data are for the current version of the zone.  We
+    // read the whole apex for the serial, which we then cache as the apex
+    // lookups of the query.  A zone without an SOA is broken; we don't
+    // cache anything for it.
+    const string origin_text = origin_.toText();
+    const FoundRRsets apex = loadRRsets(origin_text, WantedTypes(), true,
+                                        NULL, true,
+                                        DatabaseAccessor::IteratorContextPtr());
+    const FoundIterator soa = apex.second.find(RRType::SOA());
+    if (soa == apex.second.end()) {
+        return;
+    }
+    cache_ = cache;
+    cache_generation_ = cache_->validate(
+        origin_, dynamic_cast<const rdata::generic::SOA&>(
+            soa->second->getRdataIterator()->getCurrent()).getSerial().
+        getValue());
+    cache_->insert(cache_generation_, origin_, DatabaseCache::RECORDS,
+                   origin_text,
+                   DatabaseCache::ConstEntryPtr(
+                       new DatabaseCache::Entry(apex.first, apex.second)));
+}
 
 namespace {
 // Adds the given Rdata to the given RRset
@@ -245,6 +277,22 @@ public:
 private:
     std::map<bundy::dns::RRType, std::vector<bundy::dns::rdata::RdataPtr> > sigs_;
 };
+
+// Return a copy of the RRset renamed to the given owner name, optionally
+// with the signatures.
+RRsetPtr
+copyRRset(const AbstractRRset& rrset, const Name& owner, bool sigs) {
+    RRsetPtr copy(new RRset(owner, rrset.getClass(), rrset.getType(),
+                            rrset.getTTL()));
+    for (RdataIteratorPtr it = rrset.getRdataIterator(); !it->isLast();
+         it->next()) {
+        copy->addRdata(it->getCurrent());
+    }
+    if (sigs && rrset.getRRsig()) {
+        copy->addRRsig(*rrset.getRRsig());
+    }
+    return (copy);
+}
 }
 
 DatabaseClient::Finder::FoundRRsets
@@ -252,6 +300,69 @@ DatabaseClient::Finder::getRRsets(const string& name, const WantedTypes& types,
                                   bool sigs,
                                   const string* construct_name, bool any,
                                   DatabaseAccessor::IteratorContextPtr context)
+{
+    FoundRRsets result;
+    if (!cache_ || context) {
+        result = loadRRsets(name, types, sigs, construct_name, any, context);
+    } else {
+        // Cache all RRsets of the name, so the entry serves any type.
+        DatabaseCache::ConstEntryPtr entry =
+            cache_->lookup(origin_, DatabaseCache::RECORDS, name);
+        if (!entry) {
+            const FoundRRsets all = loadRRsets(name, WantedTypes(), true,
+                                               NULL, true, context);
+            entry.reset(new DatabaseCache::Entry(all.first, all.second));
+            cache_->insert(cache_generation_, origin_,
+                           DatabaseCache::RECORDS, name, entry);
+        }
+        result = selectRRsets(*entry, name, types, sigs, construct_name,
+                              any);
+    }
+    if (result.first && any) {
+        result.second[RRType::ANY()] = RRsetPtr();
+        // These will be sitting on the other RRsets.
+        result.second.erase(RRType::RRSIG());
+    }
+    return (result);
+}
+
+DatabaseClient::Finder::FoundRRsets
+DatabaseClient::Finder::selectRRsets(const DatabaseCache::Entry& entry,
+                                     const string& name,
+                                     const WantedTypes& types, bool sigs,
+                                     const string* construct_name,
+                                     bool any) const
+{
+    const bool rename = (construct_name != NULL && *construct_name != name);
+    boost::scoped_ptr<Name> owner;
+    std::map<RRType, RRsetPtr> result;
+    for (DatabaseCache::Entry::RRsetMap::const_iterator it =
+             entry.getRRsets().begin();
+         it != entry.getRRsets().end();
+         ++it) {
+        if (!any && types.find(it->first) == types.end()) {
+            continue;
+        }
+        const RRsetPtr& rrset = it->second;
+        if (rename) {
+            if (!owner) {
+                owner.reset(new Name(*construct_name));
+            }
+            result[it->first] = copyRRset(*rrset, *owner, sigs);
+        } else if (!sigs && rrset->getRRsig()) {
+            result[it->first] = copyRRset(*rrset, rrset->getName(), false);
+        } else {
+            result[it->first] = rrset;
+        }
+    }
+    return (FoundRRsets(entry.isFound(), result));
+}
+
+DatabaseClient::Finder::FoundRRsets
+DatabaseClient::Finder::loadRRsets(const string& name, const WantedTypes& types,
+                                   bool sigs,
+                                   const string* construct_name, bool any,
+                                   DatabaseAccessor::IteratorContextPtr context)
 {
     RRsigStore sig_store;
     bool records_found = false;
@@ -353,16 +464,19 @@ DatabaseClient::Finder::getRRsets(const string& name, const WantedTypes& types,
             sig_store.appendSignatures(i->second);
         }
     }
-    if (records_found && any) {
-        result[RRType::ANY()] = RRsetPtr();
-        // These will be sitting on the other RRsets.
-        result.erase(RRType::RRSIG());
-    }
     return (FoundRRsets(records_found, result));
 }
 
 bool
 DatabaseClient::Finder::hasSubdomains(const std::string& name) {
+    DatabaseCache::ConstEntryPtr entry;
+    if (cache_) {
+        entry = cache_->lookup(origin_, DatabaseCache::SUBDOMAINS, name);
+        if (entry) {
+            return (entry->isFound());
+        }
+    }
+
     // Request the context
     DatabaseAccessor::IteratorContextPtr
         context(accessor_->getRecords(name, zone_id_, true));
@@ -372,7 +486,13 @@ DatabaseClient::Finder::hasSubdomains(const std::string& name) {
     }
 
     std::string columns[DatabaseAccessor::COLUMN_COUNT];
-    return (context->getNext(columns));
+    const bool found = context->getNext(columns);
+    if (cache_) {
+        cache_->insert(cache_generation_, origin_, DatabaseCache::SUBDOMAINS,
+                       name, DatabaseCache::ConstEntryPtr(
+                           new DatabaseCache::Entry(found)));
+    }
+    return (found);
 }
 
 // Some manipulation with RRType sets
@@ -1204,10 +1324,25 @@ DatabaseClient::Finder::findNSEC3(const Name& name, bool recursive) {
 
 Name
 DatabaseClient::Finder::findPreviousName(const Name& name) const {
-    const string str(accessor_->findPreviousName(zone_id_,
-                                                 name.reverse().toText()));
+    const string rname = name.reverse().toText();
+    if (cache_) {
+        const DatabaseCache::ConstEntryPtr entry =
+            cache_->lookup(origin_, DatabaseCache::PREVIOUS_NAME, rname);
+        if (entry) {
+            return (entry->getName());
+        }
+    }
+
+    const string str(accessor_->findPreviousName(zone_id_, rname));
     try {
-        return (Name(str));
+        const Name previous(str);
+        if (cache_) {
+            cache_->insert(cache_generation_, origin_,
+                           DatabaseCache::PREVIOUS_NAME, rname,
+                           DatabaseCache::ConstEntryPtr(
+                               new DatabaseCache::Entry(previous)));
+        }
+        return (previous);
     } catch (const bundy::dns::NameParserException&) {
         bundy_throw(DataSourceError, "Bad name " + str +
                   " from findPreviousName");
@@ -1242,6 +1377,8 @@ public:
         accessor_(accessor),
         class_(rrclass),
         ready_(true),
+        owner_(Name::ROOT_NAME()),
+        owner_txt_(Name::ROOT_NAME().toText()),
         separate_rrs_(separate_rrs)
     {
         // Get the zone
@@ -1295,8 +1432,7 @@ public:
             return (ConstRRsetPtr());
         }
         const RRType rtype(rtype_txt_);
-        RRsetPtr rrset(new RRset(Name(name_txt_), class_, rtype,
-                                 RRTTL(ttl_txt_)));
+        RRsetPtr rrset(new RRset(getOwner(), class_, rtype, RRTTL(ttl_txt_)));
         // Remember the first RDATA of the RRset for comparison:
         const ConstRdataPtr rdata_base = rdata_;
         while (true) {
@@ -1315,7 +1451,7 @@ public:
             // we are done.  The next RDATA has been stored in rdata_, which
             // is used within this loop (if it belongs to the same RRset) or
             // in the next call.
-            if (Name(name_txt_) != rrset->getName() ||
+            if (getOwner() != rrset->getName() ||
                 !isSameType(rtype, rdata_base, RRType(rtype_txt_), rdata_)) {
                 break;
             }
@@ -1335,7 +1471,50 @@ public:
         return (rrset);
     }
 
+    // Render the records directly as they are fetched, without building
+    // RRsets.
+    virtual size_t getNextRRs(bundy::util::OutputBuffer& buffer,
+                              size_t max_length)
+    {
+        if (!ready_) {
+            bundy_throw(bundy::Unexpected, "Iterating past the zone end");
+        }
+        const size_t start = buffer.getLength();
+        size_t count = 0;
+        while (data_ready_ && buffer.getLength() - start < max_length) {
+            getOwner().toWire(buffer);
+            RRType(rtype_txt_).toWire(buffer);
+            class_.toWire(buffer);
+            RRTTL(ttl_txt_).toWire(buffer);
+            const size_t rdlen_pos = buffer.getLength();
+            buffer.skip(sizeof(uint16_t));
+            rdata_->toWire(buffer);
+            buffer.writeUint16At(buffer.getLength() - rdlen_pos -
+                                 sizeof(uint16_t), rdlen_pos);
+            ++count;
+            getData();
+        }
+        if (count == 0) {
+            // At the end of zone
+            accessor_->commit();
+            ready_ = false;
+            LOG_DEBUG(logger, DBG_TRACE_DETAILED, DATASRC_DATABASE_ITERATE_END);
+        }
+        return (count);
+    }
+
 private:
+    // Return the owner name of the next row.  The records of a name are
+    // normally adjacent, so the last converted name is reused as long as
+    // the text is the same.
+    const Name& getOwner() {
+        if (name_txt_ != owner_txt_) {
+            owner_ = Name(name_txt_);
+            owner_txt_ = name_txt_;
+        }
+        return (owner_);
+    }
+
     // Check two RDATA types are equivalent.  Basically it's a trivial
     // comparison, but if both are of RRSIG, we should also compare the types
     // covered.
@@ -1378,6 +1557,9 @@ private:
     bool ready_, data_ready_;
     // Data of the next row
     string name_txt_, rtype_txt_, ttl_txt_;
+    // The last converted owner name and its text (see getOwner())
+    Name owner_;
+    string owner_txt_;
     // RDATA of the next row
     ConstRdataPtr rdata_;
     // Whether to modify differing TTL values, or treat a different TTL as
@@ -1422,8 +1604,9 @@ class DatabaseUpdater : public ZoneUpdater {
 public:
     DatabaseUpdater(boost::shared_ptr<DatabaseAccessor> accessor, int zone_id,
             const Name& zone_name, const RRClass& zone_class,
-            bool journaling) :
-        committed_(false), accessor_(accessor), zone_id_(zone_id),
+            bool journaling, const boost::shared_ptr<DatabaseCache>& cache) :
+        committed_(false), accessor_(accessor), cache_(cache),
+        zone_id_(zone_id),
         db_name_(accessor->getDBName()), zone_name_(zone_name.toText()),
         zone_class_(zone_class), journaling_(journaling),
         diff_phase_(NOT_STARTED), serial_(0),
@@ -1473,6 +1656,8 @@ private:
 
     bool committed_;
     boost::shared_ptr<DatabaseAccessor> accessor_;
+    // The lookup cache of the client; flushed for the zone on commit.
+    const boost::shared_ptr<DatabaseCache> cache_;
     const int zone_id_;
     const string db_name_;
     const string zone_name_;
@@ -1752,6 +1937,9 @@ DatabaseUpdater::commit() {
     accessor_->commit();
     committed_ = true; // make sure the destructor won't trigger rollback
 
+    // Any cached lookup results of the zone are now possibly stale.
+    cache_->invalidate(finder_->getOrigin());
+
     // Disable the RRsetCollection if it exists.
     if (rrset_collection_) {
         rrset_collection_->disableWrapper();
@@ -1782,7 +1970,8 @@ DatabaseClient::getUpdater(const bundy::dns::Name& name, bool replace,
     }
 
     return (ZoneUpdaterPtr(new DatabaseUpdater(update_accessor, zone.second,
-                                               name, rrclass_, journaling)));
+                                               name, rrclass_, journaling,
+                                               cache_)));
 }
 
 //
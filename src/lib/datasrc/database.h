@@ -26,6 +26,7 @@
 
 #include <datasrc/exceptions.h>
 #include <datasrc/client.h>
+#include <datasrc/database_cache.h>
 #include <datasrc/zone.h>
 #include <datasrc/logger.h>
 
@@ -884,6 +885,23 @@ public:
                    bundy::dns::RRClass rrclass,
                    boost::shared_ptr<DatabaseAccessor> accessor);
 
+    /// \brief Set the number of lookup results cached per zone.
+    ///
+    /// Finders of this client keep the results of their database lookups
+    /// in a \c DatabaseCache shared by all of them, up to the given number
+    /// of entries per zone.  The cached data of a zone are removed when
+    /// its SOA serial changes, or when an update to the zone is committed
+    /// through an updater of this client.  Note that the cache doesn't
+    /// notice an update that doesn't change the serial.
+    ///
+    /// 0 disables the cache, which is the default.
+    void setCacheSize(size_t max_entries) {
+        cache_->setMaxEntries(max_entries);
+    }
+
+    /// \brief Return the number of lookup results cached per zone.
+    size_t getCacheSize() const { return (cache_->getMaxEntries()); }
+
 
     /// \brief Corresponding ZoneFinder implementation
     ///
@@ -910,8 +928,16 @@ public:
         /// \param origin The name of the origin of this zone. It could query
         ///     it from database, but as the DatabaseClient just searched for
         ///     the zone using the name, it should have it.
+        /// \param cache If non NULL and enabled, the cache of lookup results
+        ///     to be used.  The SOA serial of the zone is looked up here to
+        ///     validate the cached data of the zone.
+        ///
+        /// \exception DataSourceError Looking up the SOA for \c cache
+        ///     failed.
         Finder(boost::shared_ptr<DatabaseAccessor> database, int zone_id,
-               const bundy::dns::Name& origin);
+               const bundy::dns::Name& origin,
+               const boost::shared_ptr<DatabaseCache>& cache =
+               boost::shared_ptr<DatabaseCache>());
 
         // The following three methods are just implementations of inherited
         // ZoneFinder's pure virtual methods.
@@ -990,6 +1016,10 @@ public:
         boost::shared_ptr<DatabaseAccessor> accessor_;
         const int zone_id_;
         const bundy::dns::Name origin_;
+        /// \brief The lookup cache, NULL if it's not used.
+        boost::shared_ptr<DatabaseCache> cache_;
+        /// \brief The generation of the cached zone data to insert into.
+        uint64_t cache_generation_;
 
         /// \brief Shortcut name for the result of getRRsets
         typedef std::pair<bool, std::map<dns::RRType, dns::RRsetPtr> >
@@ -1068,6 +1098,29 @@ public:
                               DatabaseAccessor::IteratorContextPtr srcContext =
                               DatabaseAccessor::IteratorContextPtr());
 
+        /// \brief Read RRsets of one domain from the database.
+        ///
+        /// This is the database part of \c getRRsets() and takes the same
+        /// parameters, except that if \c any is true the result contains
+        /// the RRSIG type too, and not the ANY type.
+        FoundRRsets loadRRsets(const std::string& name,
+                               const WantedTypes& types,
+                               bool sigs,
+                               const std::string* construct_name,
+                               bool any,
+                               DatabaseAccessor::IteratorContextPtr context);
+
+        /// \brief Build the result of \c getRRsets() from a cache entry.
+        ///
+        /// The parameters are the same as those of \c getRRsets().  The
+        /// cached RRsets are returned as they are unless they have to be
+        /// renamed or stripped of their signatures.
+        FoundRRsets selectRRsets(const DatabaseCache::Entry& entry,
+                                 const std::string& name,
+                                 const WantedTypes& types, bool sigs,
+                                 const std::string* construct_name,
+                                 bool any) const;
+
         /// \brief DNSSEC related context for ZoneFinder::findInternal.
         ///
         /// This class is a helper for the ZoneFinder::findInternal method,
@@ -1511,6 +1564,9 @@ private:
 
     /// \brief The accessor to our database.
     const boost::shared_ptr<DatabaseAccessor> accessor_;
+
+    /// \brief The lookup cache shared by the finders.
+    const boost::shared_ptr<DatabaseCache> cache_;
 };
 
 }
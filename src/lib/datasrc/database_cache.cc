@@ -0,0 +1,139 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <datasrc/database_cache.h>
+
+#include <cassert>
+
+using bundy::dns::Name;
+using bundy::util::thread::Mutex;
+
+namespace bundy {
+namespace datasrc {
+
+DatabaseCache::DatabaseCache() : max_entries_(0), generation_(0) {}
+
+void
+DatabaseCache::setMaxEntries(size_t max_entries) {
+    Mutex::Locker locker(mutex_);
+    if (max_entries == 0) {
+        zones_.clear();
+    } else {
+        for (ZoneMap::iterator it = zones_.begin(); it != zones_.end(); ++it) {
+            shrink(*it->second, max_entries);
+        }
+    }
+    max_entries_ = max_entries;
+}
+
+size_t
+DatabaseCache::getMaxEntries() const {
+    Mutex::Locker locker(mutex_);
+    return (max_entries_);
+}
+
+size_t
+DatabaseCache::getEntryCount(const Name& zone_name) const {
+    Mutex::Locker locker(mutex_);
+    const ZoneMap::const_iterator found = zones_.find(zone_name);
+    return (found == zones_.end() ? 0 : found->second->entries_.size());
+}
+
+uint64_t
+DatabaseCache::validate(const Name& zone_name, uint32_t serial) {
+    Mutex::Locker locker(mutex_);
+    if (max_entries_ == 0) {
+        return (generation_);
+    }
+    boost::shared_ptr<Zone>& zone = zones_[zone_name];
+    if (!zone || zone->serial_ != serial) {
+        zone.reset(new Zone(serial, ++generation_));
+    }
+    return (zone->generation_);
+}
+
+DatabaseCache::ConstEntryPtr
+DatabaseCache::lookup(const Name& zone_name, LookupType type,
+                      const std::string& name)
+{
+    Mutex::Locker locker(mutex_);
+    const ZoneMap::iterator zone_it = zones_.find(zone_name);
+    if (zone_it == zones_.end()) {
+        return (ConstEntryPtr());
+    }
+    Zone& zone = *zone_it->second;
+    const EntryMap::iterator found = zone.entries_.find(makeKey(type, name));
+    if (found == zone.entries_.end()) {
+        return (ConstEntryPtr());
+    }
+    // Move it to the most recently used position.
+    zone.lru_.splice(zone.lru_.end(), zone.lru_, found->second);
+    return (found->second->entry_);
+}
+
+bool
+DatabaseCache::insert(uint64_t generation, const Name& zone_name,
+                      LookupType type, const std::string& name,
+                      const ConstEntryPtr& entry)
+{
+    Mutex::Locker locker(mutex_);
+    const ZoneMap::iterator zone_it = zones_.find(zone_name);
+    if (max_entries_ == 0 || zone_it == zones_.end() ||
+        zone_it->second->generation_ != generation) {
+        return (false);
+    }
+    Zone& zone = *zone_it->second;
+    const std::string key = makeKey(type, name);
+    const EntryMap::iterator found = zone.entries_.find(key);
+    if (found != zone.entries_.end()) {
+        found->second->entry_ = entry;
+        zone.lru_.splice(zone.lru_.end(), zone.lru_, found->second);
+        return (true);
+    }
+    shrink(zone, max_entries_ - 1);
+    zone.lru_.push_back(LRUElement(key, entry));
+    zone.entries_.insert(EntryMap::value_type(key, --zone.lru_.end()));
+    return (true);
+}
+
+void
+DatabaseCache::invalidate(const Name& zone_name) {
+    Mutex::Locker locker(mutex_);
+    zones_.erase(zone_name);
+}
+
+void
+DatabaseCache::clear() {
+    Mutex::Locker locker(mutex_);
+    zones_.clear();
+}
+
+std::string
+DatabaseCache::makeKey(LookupType type, const std::string& name) {
+    std::string key(1, static_cast<char>(type));
+    key.append(name);
+    return (key);
+}
+
+void
+DatabaseCache::shrink(Zone& zone, size_t max_entries) {
+    while (zone.entries_.size() > max_entries) {
+        assert(!zone.lru_.empty());
+        zone.entries_.erase(zone.lru_.front().key_);
+        zone.lru_.pop_front();
+    }
+}
+
+} // namespace datasrc
+} // namespace bundy
@@ -0,0 +1,219 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef DATASRC_DATABASE_CACHE_H
+#define DATASRC_DATABASE_CACHE_H 1
+
+#include <dns/name.h>
+#include <dns/rrset.h>
+#include <dns/rrtype.h>
+#include <util/threads/sync.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <list>
+#include <map>
+#include <string>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace datasrc {
+
+/// \brief A cache of lookup results of \c DatabaseClient::Finder.
+///
+/// A single DNS query can make the database finder look at the same names
+/// in the database repeatedly: each superdomain of the query name for a
+/// delegation, the wildcard and NSEC related names and the previous name
+/// for negative answers.  This class keeps the results of such lookups
+/// (both positive and negative) for each zone, so \c DatabaseClient finders
+/// can serve hot names without going to the database.
+///
+/// The cached data of a zone are tied to the SOA serial of the zone:
+/// \c validate() removes everything cached for the zone when the serial
+/// has changed, which the finder checks every time it's created.  The data
+/// of a zone are also removed on \c invalidate(), which \c DatabaseClient
+/// calls when an update of the zone is committed through it.  In order not
+/// to cache a result looked up in the old data after that, insertion is
+/// only allowed for the generation of the zone data returned by
+/// \c validate().
+///
+/// When a zone has the maximum number of entries, the least recently used
+/// one is removed.  The cache is disabled if the maximum number of entries
+/// is 0, which is the default.
+///
+/// All methods are thread safe.
+class DatabaseCache : boost::noncopyable {
+public:
+    /// \brief The kind of cached lookups.
+    enum LookupType {
+        RECORDS,        ///< All RRsets of a name
+        SUBDOMAINS,     ///< Whether a name has subdomains
+        PREVIOUS_NAME   ///< The previous name in the DNSSEC order
+    };
+
+    /// \brief A cached lookup result.
+    ///
+    /// This object (including the RRsets in it) is immutable once created,
+    /// so it can be used without holding a lock on the cache.
+    class Entry : boost::noncopyable {
+    public:
+        /// \brief RRsets of a name, keyed by their types.
+        typedef std::map<dns::RRType, dns::RRsetPtr> RRsetMap;
+
+        /// \brief Constructor for \c RECORDS.
+        ///
+        /// \param found Whether the name has any records.
+        /// \param rrsets All RRsets of the name, with their RRSIGs.
+        Entry(bool found, const RRsetMap& rrsets) :
+            found_(found), rrsets_(rrsets), name_(dns::Name::ROOT_NAME())
+        {}
+
+        /// \brief Constructor for \c SUBDOMAINS.
+        ///
+        /// \param found Whether the name has subdomains.
+        explicit Entry(bool found) :
+            found_(found), name_(dns::Name::ROOT_NAME())
+        {}
+
+        /// \brief Constructor for \c PREVIOUS_NAME.
+        ///
+        /// \param name The previous name.
+        explicit Entry(const dns::Name& name) : found_(true), name_(name) {}
+
+        /// \brief Return whether the name has records or subdomains.
+        bool isFound() const { return (found_); }
+
+        /// \brief Return the RRsets of the name.
+        const RRsetMap& getRRsets() const { return (rrsets_); }
+
+        /// \brief Return the previous name.
+        const dns::Name& getName() const { return (name_); }
+
+    private:
+        const bool found_;
+        const RRsetMap rrsets_;
+        const dns::Name name_;
+    };
+
+    typedef boost::shared_ptr<const Entry> ConstEntryPtr;
+
+    /// \brief Constructor.
+    ///
+    /// The cache is initially disabled.
+    DatabaseCache();
+
+    /// \brief Set the maximum number of cached entries per zone.
+    ///
+    /// If the new size is smaller than the number of entries of a zone,
+    /// the least recently used ones are removed.  0 disables the cache,
+    /// removing everything.
+    void setMaxEntries(size_t max_entries);
+
+    /// \brief Return the maximum number of cached entries per zone.
+    size_t getMaxEntries() const;
+
+    /// \brief Return the number of cached entries of a zone.
+    size_t getEntryCount(const dns::Name& zone_name) const;
+
+    /// \brief Make sure the cached data of a zone are for the given serial.
+    ///
+    /// If the zone was cached for a different SOA serial, everything
+    /// cached for it is removed.
+    ///
+    /// \param zone_name The origin name of the zone.
+    /// \param serial The current SOA serial of the zone.
+    ///
+    /// \return The generation of the cached zone data, to be passed to
+    /// \c insert().
+    uint64_t validate(const dns::Name& zone_name, uint32_t serial);
+
+    /// \brief Find a cached lookup result.
+    ///
+    /// \param zone_name The origin name of the zone.
+    /// \param type The kind of the lookup.
+    /// \param name The looked up name (compared as is).
+    ///
+    /// \return The cached result, or NULL if it's not found.
+    ConstEntryPtr lookup(const dns::Name& zone_name, LookupType type,
+                         const std::string& name);
+
+    /// \brief Cache a lookup result.
+    ///
+    /// It's a no-op (returning false) if the cache is disabled or the zone
+    /// data have been removed since \c validate() returned the given
+    /// generation.  An existing entry for the same lookup is replaced.
+    ///
+    /// \param generation The generation returned by \c validate().
+    /// \param zone_name The origin name of the zone.
+    /// \param type The kind of the lookup.
+    /// \param name The looked up name.
+    /// \param entry The result to be cached.
+    ///
+    /// \return true if the result is cached; false otherwise.
+    bool insert(uint64_t generation, const dns::Name& zone_name,
+                LookupType type, const std::string& name,
+                const ConstEntryPtr& entry);
+
+    /// \brief Remove everything cached for a zone.
+    void invalidate(const dns::Name& zone_name);
+
+    /// \brief Remove everything.
+    void clear();
+
+private:
+    // The list is ordered from the least recently used.
+    struct LRUElement {
+        LRUElement(const std::string& key, const ConstEntryPtr& entry) :
+            key_(key), entry_(entry)
+        {}
+        std::string key_;
+        ConstEntryPtr entry_;
+    };
+    typedef std::list<LRUElement> LRUList;
+    typedef boost::unordered_map<std::string, LRUList::iterator> EntryMap;
+
+    struct Zone {
+        Zone(uint32_t serial, uint64_t generation) :
+            serial_(serial), generation_(generation)
+        {}
+        uint32_t serial_;
+        uint64_t generation_;
+        LRUList lru_;
+        EntryMap entries_;
+    };
+    typedef std::map<dns::Name, boost::shared_ptr<Zone> > ZoneMap;
+
+    // The key is the lookup type followed by the name.
+    static std::string makeKey(LookupType type, const std::string& name);
+    // Remove the least recently used entries of a zone so it has at most
+    // the given number of them.  Must be called with the lock held.
+    static void shrink(Zone& zone, size_t max_entries);
+
+    mutable util::thread::Mutex mutex_;
+    size_t max_entries_;
+    uint64_t generation_;
+    ZoneMap zones_;
+};
+
+} // namespace datasrc
+} // namespace bundy
+
+#endif // DATASRC_DATABASE_CACHE_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -67,6 +67,17 @@ public:
         DataSourceError(file, line, what) {}
 };
 
+/// \brief An error in sending or receiving a zone transfer.
+///
+/// It's thrown if a response can't be rendered (e.g., an RR doesn't fit
+/// in a message) or written to the socket, or if a received response is
+/// broken or violates the protocol.
+class ZoneTransferError : public DataSourceError {
+public:
+    ZoneTransferError(const char* file, size_t line, const char* what) :
+        DataSourceError(file, line, what) {}
+};
+
 /// Base class for a number of exceptions that are thrown while working
 /// with zones.
 struct ZoneException : public Exception {
@@ -0,0 +1,135 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <bench/benchmark.h>
+
+#include <util/memory_segment_local.h>
+
+#include <dns/name.h>
+
+#include <datasrc/memory/domaintree.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include <unistd.h>
+
+using std::vector;
+using namespace bundy::bench;
+using namespace bundy::datasrc::memory;
+using namespace bundy::dns;
+
+namespace {
+typedef DomainTree<int> TestDomainTree;
+typedef DomainTreeNode<int> TestDomainTreeNode;
+
+class FindBenchMark {
+public:
+    FindBenchMark(const TestDomainTree& tree, const vector<Name>& names) :
+        tree_(tree), names_(names)
+    {}
+    unsigned int run() {
+        const TestDomainTreeNode* node;
+        vector<Name>::const_iterator it;
+        const vector<Name>::const_iterator it_end = names_.end();
+        for (it = names_.begin(); it != it_end; ++it) {
+            if (tree_.find(*it, &node) != TestDomainTree::EXACTMATCH) {
+                std::cerr << "Unexpected result for " << *it << std::endl;
+                exit(1);
+            }
+        }
+        return (names_.size());
+    }
+private:
+    const TestDomainTree& tree_;
+    const vector<Name>& names_;
+};
+
+// All nodes share this data; find() ignores nodes without data.
+int node_data = 0;
+
+void
+deleteData(int*) {
+    // The data is shared and not allocated; nothing to delete.
+}
+
+void
+usage() {
+    std::cerr << "Usage: domaintree_bench [-n iterations] [-s names]"
+              << std::endl;
+    exit (1);
+}
+}
+
+int
+main(int argc, char* argv[]) {
+    int ch;
+    int iteration = 1;
+    size_t name_count = 1000000;
+    while ((ch = getopt(argc, argv, "n:s:")) != -1) {
+        switch (ch) {
+        case 'n':
+            iteration = atoi(optarg);
+            break;
+        case 's':
+            name_count = strtoul(optarg, NULL, 10);
+            break;
+        case '?':
+        default:
+            usage();
+        }
+    }
+    argc -= optind;
+    if (argc != 0 || iteration <= 0 || name_count == 0) {
+        usage();
+    }
+
+    // Build test data.  The names are spread over a few levels of
+    // subdomains, like a large delegation-centric zone such as
+    // "hostN.subM.example.", so the search goes through both the
+    // binary trees at each level and the links between levels.
+    vector<Name> names;
+    names.reserve(name_count);
+    for (size_t i = 0; i < name_count; ++i) {
+        std::stringstream ss;
+        ss << "host" << i << ".sub" << (i % 1000) << ".zone" << (i % 7)
+           << ".example.";
+        names.push_back(Name(ss.str()));
+    }
+
+    bundy::util::MemorySegmentLocal mem_sgmt;
+    TestDomainTree* tree = TestDomainTree::create(mem_sgmt);
+    for (vector<Name>::const_iterator it = names.begin();
+         it != names.end();
+         ++it) {
+        TestDomainTreeNode* node;
+        tree->insert(mem_sgmt, *it, &node);
+        node->setData(&node_data);
+    }
+
+    // Look them up in a different order than the insertion, so the
+    // consecutive searches don't simply hit the nodes in cache.
+    std::srand(1);
+    std::random_shuffle(names.begin(), names.end());
+
+    std::cout << "Benchmark for DomainTree::find() with " << name_count
+              << " names" << std::endl;
+    BenchMark<FindBenchMark>(iteration, FindBenchMark(*tree, names));
+
+    TestDomainTree::destroy(mem_sgmt, tree, deleteData);
+    return (0);
+}
@@ -112,6 +112,57 @@ private:
     MessageRenderer& renderer_;
 };
 
+// Same as ReaderBenchMark, but with the RdataFieldReader specialized for
+// the rendering callbacks.
+class FieldReaderBenchMark {
+public:
+    FieldReaderBenchMark(const vector<EncodeParam>& encode_params,
+                         MessageRenderer& renderer) :
+        encode_params_(encode_params), renderer_(renderer)
+    {}
+    unsigned int run() {
+        vector<EncodeParam>::const_iterator it;
+        const vector<EncodeParam>::const_iterator it_end =
+            encode_params_.end();
+        renderer_.clear();
+        for (it = encode_params_.begin(); it != it_end; ++it) {
+            RdataFieldReader<NameRenderer, DataRenderer>
+                reader(it->rrclass, it->rrtype, &it->data[0],
+                       it->rdata_count, it->sig_count,
+                       NameRenderer(renderer_), DataRenderer(renderer_));
+            reader.iterate();
+            reader.iterateAllSigs();
+        }
+        return (1);
+    }
+private:
+    struct NameRenderer {
+        explicit NameRenderer(MessageRenderer& renderer) :
+            renderer_(renderer)
+        {}
+        void operator()(const LabelSequence& labels,
+                        RdataNameAttributes attributes) const
+        {
+            const bool compress =
+                (attributes & NAMEATTR_COMPRESSIBLE) != 0;
+            renderer_.writeName(labels, compress);
+        }
+        MessageRenderer& renderer_;
+    };
+    struct DataRenderer {
+        explicit DataRenderer(MessageRenderer& renderer) :
+            renderer_(renderer)
+        {}
+        void operator()(const void* data, size_t data_len) const {
+            renderer_.writeData(data, data_len);
+        }
+        MessageRenderer& renderer_;
+    };
+
+    const vector<EncodeParam>& encode_params_;
+    MessageRenderer& renderer_;
+};
+
 // Builtin benchmark data.  This is a list of RDATA (of RRs) in a response
 // from a root server for the query for "www.example.com" (as of this
 // implementation).  We use a real world example to make the case practical.
@@ -216,5 +267,10 @@ main(int argc, char* argv[]) {
     std::cout << "Benchmark for RdataReader" << std::endl;
     BenchMark<ReaderBenchMark>(iteration,
                                 ReaderBenchMark(encode_param_list, renderer));
+
+    std::cout << "Benchmark for RdataFieldReader" << std::endl;
+    BenchMark<FieldReaderBenchMark>(iteration,
+                                    FieldReaderBenchMark(encode_param_list,
+                                                         renderer));
     return (0);
 }
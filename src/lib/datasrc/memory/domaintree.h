@@ -28,6 +28,7 @@
 #include <util/memory_segment.h>
 #include <dns/name.h>
 #include <dns/labelsequence.h>
+#include <datasrc/memory/label_pool.h>
 
 #include <boost/utility.hpp>
 #include <boost/shared_ptr.hpp>
@@ -107,19 +108,51 @@ private:
 
     //@}
 
+    /// \brief The pointer to shared labels stored in place of the labels.
+    ///
+    /// See \c create().
+    typedef boost::interprocess::offset_ptr<const void> LabelsPtr;
+
     /// \brief Accessor to the memory region for node labels.
     ///
     /// The only valid usage of the returned pointer is to pass it to
     /// the corresponding constructor of \c dns::LabelSequence.
-    const void* getLabelsData() const { return (this + 1); }
+    const void* getLabelsData() const {
+        if ((flags_ & FLAG_SHARED_LABELS) != 0) {
+            return (getSharedLabelsData());
+        }
+        return (this + 1);
+    }
 
     /// \brief Accessor to the memory region for node labels, mutable version.
     ///
     /// The only valid usage of the returned pointer is to pass it to
     /// \c LabelSequence::serialize() with the node's labels_capacity_ member
     /// (which should be sufficiently large for the \c LabelSequence in that
-    /// context).
-    void* getLabelsData() { return (this + 1); }
+    /// context).  It must not be used for a node with shared labels.
+    void* getLabelsData() {
+        assert((flags_ & FLAG_SHARED_LABELS) == 0);
+        return (this + 1);
+    }
+
+    /// \brief Return if the node refers to shared labels.
+    bool isSharedLabels() const {
+        return ((flags_ & FLAG_SHARED_LABELS) != 0);
+    }
+
+    /// \brief Return the shared labels the node refers to.
+    ///
+    /// This must only be called for a node with shared labels.
+    const void* getSharedLabelsData() const {
+        assert((flags_ & FLAG_SHARED_LABELS) != 0);
+        return (reinterpret_cast<const LabelsPtr*>(this + 1)->get());
+    }
+
+    /// \brief Make the node refer to shared labels.
+    void setSharedLabels(const void* labels_data) {
+        new(this + 1) LabelsPtr(labels_data);
+        flags_ |= FLAG_SHARED_LABELS;
+    }
 
     /// \brief Allocate and construct \c DomainTreeNode
     ///
@@ -129,12 +162,33 @@ private:
     ///
     /// \throw std::bad_alloc Memory allocation fails.
     ///
+    /// If \c label_pool is non-NULL and the serialized labels are larger
+    /// than a pointer, the labels are added to the pool, and the node
+    /// holds a pointer to the shared copy in place of the labels.
+    ///
+    /// \throw util::MemorySegmentGrown The memory segment has grown.
+    /// \throw std::bad_alloc Memory allocation fails.
+    ///
     /// \param mem_sgmt A \c MemorySegment from which memory for the new
     /// \c DomainTreeNode is allocated.
+    /// \param labels The labels of the new node.
+    /// \param label_pool The pool for shared labels, or NULL.
     static DomainTreeNode<T>* create(util::MemorySegment& mem_sgmt,
-                                     const dns::LabelSequence& labels)
+                                     const dns::LabelSequence& labels,
+                                     LabelPool* label_pool = NULL)
     {
         const size_t labels_len = labels.getSerializedLength();
+        if (label_pool != NULL && labels_len > sizeof(LabelsPtr)) {
+            // Add the labels first, so the pool keeps the reference (and
+            // no node is leaked) if allocating the node throws.
+            const void* labels_data = label_pool->addLabels(mem_sgmt, labels);
+            void* p = mem_sgmt.allocate(sizeof(DomainTreeNode<T>) +
+                                        sizeof(LabelsPtr));
+            DomainTreeNode<T>* node =
+                new(p) DomainTreeNode<T>(sizeof(LabelsPtr));
+            node->setSharedLabels(labels_data);
+            return (node);
+        }
         void* p = mem_sgmt.allocate(sizeof(DomainTreeNode<T>) + labels_len);
         DomainTreeNode<T>* node = new(p) DomainTreeNode<T>(labels_len);
         labels.serialize(node->getLabelsData(), labels_len);
@@ -150,9 +204,16 @@ private:
     /// \param node A non NULL pointer to a valid \c DomainTreeNode object
     /// that was originally created by the \c create() method (the behavior
     /// is undefined if this condition isn't met).
+    /// \param label_pool The pool passed to \c create(); it must be
+    /// non-NULL if the node has shared labels.
     static void destroy(util::MemorySegment& mem_sgmt,
-                        DomainTreeNode<T>* node)
+                        DomainTreeNode<T>* node,
+                        LabelPool* label_pool = NULL)
     {
+        if ((node->flags_ & FLAG_SHARED_LABELS) != 0) {
+            assert(label_pool != NULL);
+            label_pool->releaseLabels(mem_sgmt, node->getSharedLabelsData());
+        }
         const size_t labels_capacity = node->labels_capacity_;
         node->~DomainTreeNode<T>();
         mem_sgmt.deallocate(node,
@@ -167,6 +228,31 @@ private:
         labels.serialize(getLabelsData(), labels_capacity_);
     }
 
+    /// \brief Reset the labels of a node with shared labels.
+    ///
+    /// This is the \c resetLabels() version for a node with shared
+    /// labels, whose reference to the current labels is released.  If
+    /// \c labels_data is non-NULL, it must be the data of \c labels added
+    /// to \c label_pool, and the node refers to it; otherwise \c labels
+    /// must be small enough to be stored in place of the pointer (see
+    /// \c create()).
+    ///
+    /// \c labels must not refer to the current labels of the node.
+    void resetSharedLabels(util::MemorySegment& mem_sgmt,
+                           LabelPool& label_pool,
+                           const dns::LabelSequence& labels,
+                           const void* labels_data)
+    {
+        label_pool.releaseLabels(mem_sgmt, getSharedLabelsData());
+        if (labels_data != NULL) {
+            setSharedLabels(labels_data);
+        } else {
+            reinterpret_cast<LabelsPtr*>(this + 1)->~LabelsPtr();
+            flags_ &= ~FLAG_SHARED_LABELS;
+            labels.serialize(getLabelsData(), labels_capacity_);
+        }
+    }
+
 public:
     /// Node flags.
     ///
@@ -181,6 +267,7 @@ public:
         FLAG_CALLBACK = 1, ///< Callback enabled. See \ref callback
         FLAG_RED = 2, ///< Node color; 1 if node is red, 0 if node is black.
         FLAG_SUBTREE_ROOT = 4, ///< Set if the node is the root of a subtree
+        FLAG_SHARED_LABELS = 8, ///< Set if the labels are in a LabelPool
         FLAG_USER1 = 0x400000U, ///< Application specific flag
         FLAG_USER2 = 0x200000U, ///< Application specific flag
         FLAG_USER3 = 0x100000U, ///< Application specific flag
@@ -226,6 +313,14 @@ public:
         return (dns::LabelSequence(getLabelsData()));
     }
 
+    /// \brief Return the memory allocated for the node, in bytes.
+    ///
+    /// It includes the labels of the node, or the reference to them if
+    /// they are shared, but not the data of the node.
+    size_t getAllocatedSize() const {
+        return (sizeof(DomainTreeNode<T>) + labels_capacity_);
+    }
+
     /// \brief Return the absolute label sequence of the node.
     ///
     /// This method returns the label sequence corresponding to the full
@@ -1221,11 +1316,21 @@ public:
     ///                          return empty nodes (which contain no
     ///                          data). If it's \c true, \c find() will
     ///                          match and return empty nodes.
+    /// \param share_labels Whether the nodes of this tree should share
+    ///                     identical labels.  If it's \c true, labels
+    ///                     that don't fit in a pointer are kept in a
+    ///                     \c LabelPool of the tree, and each node only
+    ///                     holds a pointer to them.  This saves memory
+    ///                     when many nodes have the same (relative)
+    ///                     labels, at the cost of some overhead per
+    ///                     distinct label sequence; it doesn't change the
+    ///                     result of any operation on the tree.
     static DomainTree* create(util::MemorySegment& mem_sgmt,
-                              bool return_empty_node = false)
+                              bool return_empty_node = false,
+                              bool share_labels = false)
     {
         void* p = mem_sgmt.allocate(sizeof(DomainTree<T>));
-        return (new(p) DomainTree<T>(return_empty_node));
+        return (new(p) DomainTree<T>(return_empty_node, share_labels));
     }
 
     /// \brief Destruct and deallocate \c DomainTree
@@ -1266,6 +1371,7 @@ public:
                         DataDeleter deleter)
     {
         tree->removeAllNodes(mem_sgmt, deleter);
+        tree->label_pool_.clear(mem_sgmt);
         tree->~DomainTree<T>();
         mem_sgmt.deallocate(tree, sizeof(DomainTree<T>));
     }
@@ -1279,7 +1385,8 @@ private:
     /// allocator (\c create()), so the constructor is hidden as private.
     ///
     /// It never throws an exception.
-    explicit DomainTree(bool returnEmptyNode = false);
+    explicit DomainTree(bool returnEmptyNode = false,
+                        bool shareLabels = false);
 
     /// \brief The destructor.
     ///
@@ -1353,6 +1460,24 @@ private:
                            bool (*callback)(const DomainTreeNode<T>&, CBARG),
                            CBARG callback_arg);
 
+    /// \brief Hint the CPU to load a node that findImpl() may compare next.
+    ///
+    /// The label data immediately follows the node (see
+    /// \c DomainTreeNode::getLabelsData()), so the node itself and the
+    /// beginning of the label data may be on different cache lines; both
+    /// are prefetched.  This is only a hint and doesn't change the
+    /// semantics; \c node can be NULL.
+    template <typename TTN>
+    static void prefetchNode(TTN* node) {
+#ifdef __GNUC__
+        if (node != NULL) {
+            __builtin_prefetch(node);
+            const TTN* const cnode = node;
+            __builtin_prefetch(cnode->getLabelsData());
+        }
+#endif
+    }
+
 public:
     /// \brief Find with callback and node chain
     /// \anchor callback
@@ -1600,6 +1725,27 @@ public:
     /// must not use it.
     size_t getHeight() const;
 
+    /// \brief Return the memory allocated for the tree, in bytes.
+    ///
+    /// This is the size of the tree object, of its nodes and of the
+    /// labels they share.  The data of the nodes is not included; instead,
+    /// \c data_size is called with the data of each node having one, and
+    /// the sum of the values it returns is added to \c data_total.
+    ///
+    /// It walks the whole tree.
+    template <typename DataSize>
+    size_t getAllocatedSize(const DataSize& data_size,
+                            size_t& data_total) const;
+
+private:
+    /// \brief Helper method for getAllocatedSize()
+    template <typename DataSize>
+    size_t getAllocatedSizeHelper(const DomainTreeNode<T>* node,
+                                  const DataSize& data_size,
+                                  size_t& data_total) const;
+
+public:
+
 private:
     /// \brief Helper method for checkProperties()
     bool checkPropertiesHelper(const DomainTreeNode<T>* node) const;
@@ -1683,6 +1829,62 @@ public:
     Result insert(util::MemorySegment& mem_sgmt, const bundy::dns::Name& name,
                   DomainTreeNode<T>** inserted_node);
 
+    /// \brief Insert a domain name that follows all names in the tree.
+    ///
+    /// This is a faster version of \c insert() for building a tree from
+    /// names given in the DNSSEC order, such as those from a zone
+    /// iterator of a database.  A name that is larger than any name in the
+    /// tree only has to be compared with the largest node of each level,
+    /// and the new node simply becomes the root of its level, with the
+    /// previous root as its left child.  So no rebalancing happens, and
+    /// the nodes are allocated in the order of the names.
+    ///
+    /// As a result, after this method is called the subtrees of the levels
+    /// are not balanced (each of them is a chain of left children); they
+    /// are still valid binary search trees and can be searched, but
+    /// slowly.  \c finishAppend() must be called after adding the names,
+    /// in particular before any other modification of the tree.  Also,
+    /// the tree must have been built by this method (except that it may
+    /// have a single node inserted by \c insert()) since it was last
+    /// balanced.
+    ///
+    /// If the name is not larger than all the names in the tree, but is
+    /// equal to the name of the largest node of some level or an empty
+    /// node created to split such a node, \c ALREADYEXISTS is returned as
+    /// \c insert() would.  Otherwise, the name can't be appended and
+    /// \c NOTFOUND is returned, without modifying the tree; the caller
+    /// would then call \c finishAppend() and \c insert() the name.
+    ///
+    /// Exceptions are the same as those of \c insert(), and the tree
+    /// retains the same level of integrity on exception.
+    ///
+    /// \param mem_sgmt A \c MemorySegment object for allocating memory of
+    /// a new node to be inserted.  Must be the same segment as that used
+    /// for creating the tree itself.
+    /// \param name The name to be inserted into the tree.
+    /// \param inserted_node This is an output parameter and is set to the
+    ///     node unless \c NOTFOUND is returned.
+    ///
+    /// \return
+    ///  - SUCCESS The node was added.
+    ///  - ALREADYEXISTS There was already a node of that name, so it was not
+    ///     added.
+    ///  - NOTFOUND The name can't be appended.
+    Result append(util::MemorySegment& mem_sgmt, const bundy::dns::Name& name,
+                  DomainTreeNode<T>** inserted_node);
+
+    /// \brief Balance the tree after \c append().
+    ///
+    /// This makes each level of the tree a balanced red-black tree in
+    /// linear time.  It works for any tree, but is only needed after
+    /// \c append().  The tree structure changes, but the nodes remain
+    /// valid and keep representing the same names.
+    ///
+    /// \throw none
+    void finishAppend() {
+        balanceLevel(&root_, NULL);
+    }
+
     /// \brief Delete a tree node.
     ///
     /// \throw none.
@@ -1709,6 +1911,42 @@ public:
     template <typename DataDeleter>
     void removeAllNodes(util::MemorySegment& mem_sgmt, DataDeleter deleter);
 
+    /// \brief Move a tree node to newly allocated memory.
+    ///
+    /// It creates a copy of \c node, with the same labels, data and flags,
+    /// and replaces \c node with it in the tree.  Nodes represent the same
+    /// names after that; only the address of the node changes.  Any
+    /// pointer to \c node held outside the tree must be updated by the
+    /// caller.
+    ///
+    /// \c node is unlinked from the tree, but remains allocated; it must be
+    /// destroyed by \c destroyRelocated().  This allows moving a series of
+    /// nodes without the new ones reusing the memory of the old ones, so
+    /// they will be packed together in the memory segment.
+    ///
+    /// \throw util::MemorySegmentGrown The memory segment has grown, possibly
+    ///     relocating data.  The tree is not modified in this case.
+    /// \throw std::bad_alloc Memory allocation fails.  The tree is not
+    ///     modified in this case.
+    ///
+    /// \param mem_sgmt The \c MemorySegment object used to insert the nodes.
+    /// \param node The node to move.
+    /// \return The new node.
+    DomainTreeNode<T>* relocate(util::MemorySegment& mem_sgmt,
+                                DomainTreeNode<T>* node);
+
+    /// \brief Destroy a node that has been replaced by \c relocate().
+    ///
+    /// \throw none.
+    ///
+    /// \param mem_sgmt The \c MemorySegment object used to insert the nodes.
+    /// \param node The node given to \c relocate().
+    void destroyRelocated(util::MemorySegment& mem_sgmt,
+                          DomainTreeNode<T>* node)
+    {
+        DomainTreeNode<T>::destroy(mem_sgmt, node, &label_pool_);
+    }
+
     /// \brief Swaps two tree's contents.
     ///
     /// This and \c other trees must have been created with the same
@@ -1741,6 +1979,20 @@ private:
     DomainTreeNode<T>*
     leftRotate(typename DomainTreeNode<T>::DomainTreeNodePtr* root,
                DomainTreeNode<T>* node);
+
+    /// \brief Rebuild a level of the tree, and the ones below it, as
+    /// balanced red-black trees (see \c finishAppend()).
+    static void
+    balanceLevel(typename DomainTreeNode<T>::DomainTreeNodePtr* root_ptr,
+                 DomainTreeNode<T>* upper);
+
+    /// \brief Build a balanced subtree of \c count nodes of a level from
+    /// a chain of left children in the descending order, starting at
+    /// \c next; \c next is updated to the first node not used.  The
+    /// nodes at \c red_depth are colored red and the others black.
+    static DomainTreeNode<T>*
+    buildBalanced(DomainTreeNode<T>*& next, size_t count, size_t depth,
+                  size_t red_depth);
     //@}
 
     /// \name Helper functions
@@ -1787,13 +2039,35 @@ private:
 
     /// search policy for domaintree
     const bool needsReturnEmptyNode_;
+
+    /// whether the nodes share labels in label_pool_
+    const bool shareLabels_;
+
+    /// shared labels of the nodes; unused unless shareLabels_ is true.
+    LabelPool label_pool_;
+
+    /// Return the pool to be passed to \c DomainTreeNode::create().
+    LabelPool* getLabelPool() {
+        return (shareLabels_ ? &label_pool_ : NULL);
+    }
+
+public:
+    /// \brief Return the number of distinct labels shared by the nodes.
+    ///
+    /// It's always 0 unless the tree was created with \c share_labels.
+    ///
+    /// This function is mainly intended to be used for debugging.
+    size_t getSharedLabelsCount() const {
+        return (label_pool_.getLabelsCount());
+    }
 };
 
 template <typename T>
-DomainTree<T>::DomainTree(bool returnEmptyNode) :
+DomainTree<T>::DomainTree(bool returnEmptyNode, bool shareLabels) :
     root_(NULL),
     node_count_(0),
-    needsReturnEmptyNode_(returnEmptyNode)
+    needsReturnEmptyNode_(returnEmptyNode),
+    shareLabels_(shareLabels)
 {
 }
 
@@ -1830,7 +2104,7 @@ DomainTree<T>::deleteHelper(util::MemorySegment& mem_sgmt,
             DomainTreeNode<T>* node = root;
             root = root->getParent();
             deleter(node->data_.get());
-            DomainTreeNode<T>::destroy(mem_sgmt, node);
+            DomainTreeNode<T>::destroy(mem_sgmt, node, &label_pool_);
             --node_count_;
         }
     }
@@ -1857,6 +2131,14 @@ DomainTree<T>::findImpl(TT* tree,
     dns::LabelSequence target_labels(target_labels_orig);
 
     while (node != NULL) {
+        // On a large tree the nodes are unlikely to be in cache, and
+        // loading the next one would otherwise only start after the
+        // comparison below.  Since we don't know yet which child we'll
+        // visit, start loading both children of the binary tree while
+        // comparing the labels of this node.
+        prefetchNode(node->getLeft());
+        prefetchNode(node->getRight());
+
         node_path.last_compared_ = node;
         node_path.last_comparison_ = target_labels.compare(node->getLabels());
         const bundy::dns::NameComparisonResult::NameRelation relation =
@@ -2217,7 +2499,8 @@ DomainTree<T>::insert(util::MemorySegment& mem_sgmt,
     // Once a new node is created, no exception will be thrown until the end
     // of the function, so we can simply create and hold a new node pointer.
     DomainTreeNode<T>* node = DomainTreeNode<T>::create(mem_sgmt,
-                                                        target_labels);
+                                                        target_labels,
+                                                        getLabelPool());
     node->parent_ = parent;
     if (parent == NULL) {
         *current_root = node;
@@ -2243,6 +2526,199 @@ DomainTree<T>::insert(util::MemorySegment& mem_sgmt,
     return (SUCCESS);
 }
 
+template <typename T>
+typename DomainTree<T>::Result
+DomainTree<T>::append(util::MemorySegment& mem_sgmt,
+                      const bundy::dns::Name& target_name,
+                      DomainTreeNode<T>** new_node)
+{
+    // current is always the root of a level, which is also its largest
+    // node.
+    DomainTreeNode<T>* current = root_.get();
+    DomainTreeNode<T>* up_node = NULL;
+    bundy::dns::LabelSequence target_labels(target_name);
+
+    uint8_t labels_buf[dns::LabelSequence::MAX_SERIALIZED_LENGTH];
+    while (current != NULL) {
+        const dns::LabelSequence current_labels(
+            dns::LabelSequence(current->getLabels(), labels_buf));
+        const bundy::dns::NameComparisonResult compare_result =
+            target_labels.compare(current_labels);
+        const bundy::dns::NameComparisonResult::NameRelation relation =
+            compare_result.getRelation();
+        if (relation == bundy::dns::NameComparisonResult::EQUAL) {
+            if (new_node != NULL) {
+                *new_node = current;
+            }
+            return (ALREADYEXISTS);
+        } else if (relation == bundy::dns::NameComparisonResult::SUBDOMAIN) {
+            up_node = current;
+            target_labels.stripRight(compare_result.getCommonLabels());
+            current = current->getDown();
+        } else if (compare_result.getOrder() < 0) {
+            // Nothing has been modified so far; a split below is always
+            // followed by the addition.
+            return (NOTFOUND);
+        } else if (relation == bundy::dns::NameComparisonResult::NONE) {
+            break;
+        } else {
+            // Split the current node as insert() does; the node with the
+            // common labels takes its place as the root of the level.
+            dns::LabelSequence common_ancestor = target_labels;
+            common_ancestor.stripLeft(target_labels.getLabelCount() -
+                                      compare_result.getCommonLabels());
+            dns::LabelSequence new_prefix = current_labels;
+            new_prefix.stripRight(compare_result.getCommonLabels());
+            nodeFission(mem_sgmt, *current, new_prefix, common_ancestor);
+            current = current->getParent();
+        }
+    }
+
+    typename DomainTreeNode<T>::DomainTreeNodePtr* current_root =
+        (up_node != NULL) ? &(up_node->down_) : &root_;
+    DomainTreeNode<T>* node = DomainTreeNode<T>::create(mem_sgmt,
+                                                        target_labels,
+                                                        getLabelPool());
+    node->setColor(DomainTreeNode<T>::BLACK);
+    node->parent_ = up_node;
+    node->left_ = current;
+    if (current != NULL) {
+        current->parent_ = node;
+        current->setSubTreeRoot(false);
+    }
+    *current_root = node;
+
+    if (new_node != NULL) {
+        *new_node = node;
+    }
+
+    ++node_count_;
+    return (SUCCESS);
+}
+
+template <typename T>
+void
+DomainTree<T>::balanceLevel(
+    typename DomainTreeNode<T>::DomainTreeNodePtr* root_ptr,
+    DomainTreeNode<T>* upper)
+{
+    // First make the level a chain of left children by rotating any right
+    // child up.  This is a no-op for a level built by append().
+    DomainTreeNode<T>* head = root_ptr->get();
+    DomainTreeNode<T>* prev = NULL;
+    size_t count = 0;
+    for (DomainTreeNode<T>* current = head; current != NULL; ) {
+        DomainTreeNode<T>* const right = current->getRight();
+        if (right != NULL) {
+            current->right_ = right->getLeft();
+            right->left_ = current;
+            if (prev != NULL) {
+                prev->left_ = right;
+            } else {
+                head = right;
+            }
+            current = right;
+        } else {
+            prev = current;
+            current = current->getLeft();
+            ++count;
+        }
+    }
+    if (count == 0) {
+        return;
+    }
+
+    // With the subtrees of every node split evenly, all the levels of the
+    // binary tree but the deepest one are complete.  Coloring the nodes of
+    // the incomplete level red and all others black satisfies the
+    // red-black properties.
+    size_t red_depth = 0;
+    while ((static_cast<size_t>(2) << red_depth) <= count + 1) {
+        ++red_depth;
+    }
+    DomainTreeNode<T>* root = buildBalanced(head, count, 0, red_depth);
+    root->parent_ = upper;
+    root->setSubTreeRoot(true);
+    *root_ptr = root;
+}
+
+template <typename T>
+DomainTreeNode<T>*
+DomainTree<T>::buildBalanced(DomainTreeNode<T>*& next, size_t count,
+                             size_t depth, size_t red_depth)
+{
+    if (count == 0) {
+        return (NULL);
+    }
+
+    // The larger nodes come first.
+    const size_t right_count = (count - 1) / 2;
+    DomainTreeNode<T>* const right =
+        buildBalanced(next, right_count, depth + 1, red_depth);
+    DomainTreeNode<T>* const node = next;
+    next = node->getLeft();
+    DomainTreeNode<T>* const left =
+        buildBalanced(next, count - 1 - right_count, depth + 1, red_depth);
+
+    node->left_ = left;
+    node->right_ = right;
+    if (left != NULL) {
+        left->parent_ = node;
+    }
+    if (right != NULL) {
+        right->parent_ = node;
+    }
+    node->setSubTreeRoot(false);
+    node->setColor(depth == red_depth ? DomainTreeNode<T>::RED :
+                   DomainTreeNode<T>::BLACK);
+    balanceLevel(&node->down_, node);
+    return (node);
+}
+
+template <typename T>
+DomainTreeNode<T>*
+DomainTree<T>::relocate(util::MemorySegment& mem_sgmt,
+                        DomainTreeNode<T>* node)
+{
+    // Creating the new node is the only operation that can throw; the tree
+    // is not modified until it succeeds.  If the labels are shared, the new
+    // node adds its own reference to them in the pool.
+    DomainTreeNode<T>* new_node =
+        DomainTreeNode<T>::create(mem_sgmt, node->getLabels(),
+                                  getLabelPool());
+
+    // All flags other than whether the labels are shared are properties
+    // of the node (including its position in the tree), not of the memory.
+    const uint32_t shared_flag =
+        DomainTreeNode<T>::FLAG_SHARED_LABELS;
+    new_node->flags_ = (node->flags_ & ~shared_flag) |
+        (new_node->flags_ & shared_flag);
+    new_node->data_ = node->data_;
+    node->data_ = NULL;
+
+    new_node->parent_ = node->getParent();
+    node->connectChild(node, new_node, &root_);
+    new_node->left_ = node->getLeft();
+    if (node->getLeft() != NULL) {
+        node->getLeft()->parent_ = new_node;
+    }
+    new_node->right_ = node->getRight();
+    if (node->getRight() != NULL) {
+        node->getRight()->parent_ = new_node;
+    }
+    new_node->down_ = node->getDown();
+    if (node->getDown() != NULL) {
+        node->getDown()->parent_ = new_node;
+    }
+
+    node->parent_ = NULL;
+    node->left_ = NULL;
+    node->right_ = NULL;
+    node->down_ = NULL;
+
+    return (new_node);
+}
+
 template <typename T>
 template <typename DataDeleter>
 void
@@ -2338,7 +2814,7 @@ DomainTree<T>::remove(util::MemorySegment& mem_sgmt, DomainTreeNode<T>* node,
         if (node->data_.get()) {
             deleter(node->data_.get());
         }
-        DomainTreeNode<T>::destroy(mem_sgmt, node);
+        DomainTreeNode<T>::destroy(mem_sgmt, node, &label_pool_);
         --node_count_;
 
         // If the node deletion did not cause the subtree to disappear
@@ -2385,9 +2861,23 @@ DomainTree<T>::nodeFission(util::MemorySegment& mem_sgmt,
     // the end of the function, and it will keep consistent behavior
     // (i.e., a weak form of strong exception guarantee) even if code
     // after the call to this function throws an exception.
-    DomainTreeNode<T>* up_node = DomainTreeNode<T>::create(mem_sgmt,
-                                                           new_suffix);
-    node.resetLabels(new_prefix);
+    //
+    // If the node has shared labels and the new ones have to be shared,
+    // too, they are added to the pool before that for the same reason.
+    // new_prefix refers to a copy of the node's labels (see insert()).
+    const void* prefix_data = NULL;
+    if (node.isSharedLabels() && new_prefix.getSerializedLength() >
+        sizeof(typename DomainTreeNode<T>::LabelsPtr)) {
+        prefix_data = label_pool_.addLabels(mem_sgmt, new_prefix);
+    }
+    DomainTreeNode<T>* up_node =
+        DomainTreeNode<T>::create(mem_sgmt, new_suffix, getLabelPool());
+    if (node.isSharedLabels()) {
+        node.resetSharedLabels(mem_sgmt, label_pool_, new_prefix,
+                               prefix_data);
+    } else {
+        node.resetLabels(new_prefix);
+    }
 
     up_node->parent_ = node.getParent();
 
@@ -2928,6 +3418,39 @@ DomainTree<T>::getHeight() const {
     return (getHeightHelper(root_.get()));
 }
 
+template <typename T>
+template <typename DataSize>
+size_t
+DomainTree<T>::getAllocatedSizeHelper(const DomainTreeNode<T>* node,
+                                      const DataSize& data_size,
+                                      size_t& data_total) const
+{
+    size_t size = 0;
+    // Iterate to the right, so only the left and down subtrees, whose
+    // depth is bounded, need a recursion.
+    for (; node != NULL; node = node->getRight()) {
+        size += node->getAllocatedSize();
+        if (!node->isEmpty()) {
+            data_total += data_size(node->getData());
+        }
+        size += getAllocatedSizeHelper(node->getLeft(), data_size,
+                                       data_total);
+        size += getAllocatedSizeHelper(node->getDown(), data_size,
+                                       data_total);
+    }
+    return (size);
+}
+
+template <typename T>
+template <typename DataSize>
+size_t
+DomainTree<T>::getAllocatedSize(const DataSize& data_size,
+                                size_t& data_total) const
+{
+    return (sizeof(DomainTree<T>) + label_pool_.getAllocatedSize() +
+            getAllocatedSizeHelper(root_.get(), data_size, data_total));
+}
+
 template <typename T>
 bool
 DomainTree<T>::checkPropertiesHelper(const DomainTreeNode<T>* node) const {
@@ -0,0 +1,184 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <datasrc/memory/label_pool.h>
+
+#include <util/memory_segment.h>
+#include <util/random/random_number_generator.h>
+
+#include <dns/labelsequence.h>
+
+#include <cassert>
+#include <limits>
+#include <new>                  // for the placement new
+
+using namespace bundy::dns;
+
+namespace bundy {
+namespace datasrc {
+namespace memory {
+
+// A shared label sequence.  Its serialized form immediately follows this
+// structure (in the same way as the labels of DomainTreeNode).
+struct LabelPool::Entry {
+    Entry(uint32_t hash_param) : next(NULL), hash(hash_param), refcount(1) {}
+    const void* getLabelsData() const { return (this + 1); }
+    void* getLabelsData() { return (this + 1); }
+    static Entry* fromLabelsData(const void* labels_data) {
+        return (const_cast<Entry*>(static_cast<const Entry*>(labels_data)) -
+                1);
+    }
+    size_t getAllocatedSize() const {
+        return (sizeof(Entry) +
+                LabelSequence(getLabelsData()).getSerializedLength());
+    }
+
+    EntryPtr next;
+    const uint32_t hash;
+    uint32_t refcount;
+};
+
+namespace {
+// The number of hash buckets allocated on the first addLabels().
+const uint32_t INITIAL_BUCKET_COUNT = 64;
+}
+
+LabelPool::LabelPool() :
+    buckets_(NULL), bucket_count_(0),
+    seed_(util::random::UniformRandomIntegerGenerator(
+              0, std::numeric_limits<int>::max())()),
+    entry_count_(0)
+{}
+
+void
+LabelPool::clear(util::MemorySegment& mem_sgmt) {
+    for (uint32_t i = 0; i < bucket_count_; ++i) {
+        Entry* entry = buckets_[i].get();
+        while (entry != NULL) {
+            Entry* const next = entry->next.get();
+            const size_t size = entry->getAllocatedSize();
+            entry->~Entry();
+            mem_sgmt.deallocate(entry, size);
+            entry = next;
+        }
+    }
+    if (buckets_) {
+        mem_sgmt.deallocate(buckets_.get(), sizeof(EntryPtr) * bucket_count_);
+    }
+    buckets_ = NULL;
+    bucket_count_ = 0;
+    entry_count_ = 0;
+}
+
+void
+LabelPool::rehash(util::MemorySegment& mem_sgmt, uint32_t bucket_count) {
+    // Allocate the new table first; if it throws, nothing has changed.
+    void* p = mem_sgmt.allocate(sizeof(EntryPtr) * bucket_count);
+    EntryPtr* buckets = static_cast<EntryPtr*>(p);
+    for (uint32_t i = 0; i < bucket_count; ++i) {
+        new(&buckets[i]) EntryPtr(NULL);
+    }
+
+    for (uint32_t i = 0; i < bucket_count_; ++i) {
+        Entry* entry = buckets_[i].get();
+        while (entry != NULL) {
+            Entry* const next = entry->next.get();
+            EntryPtr& head = buckets[entry->hash & (bucket_count - 1)];
+            entry->next = head;
+            head = entry;
+            entry = next;
+        }
+    }
+    if (buckets_) {
+        mem_sgmt.deallocate(buckets_.get(), sizeof(EntryPtr) * bucket_count_);
+    }
+    buckets_ = buckets;
+    bucket_count_ = bucket_count;
+}
+
+const void*
+LabelPool::addLabels(util::MemorySegment& mem_sgmt,
+                     const LabelSequence& labels)
+{
+    const uint32_t hash = labels.getFullHash(true, seed_);
+    if (bucket_count_ > 0) {
+        for (Entry* entry = buckets_[hash & (bucket_count_ - 1)].get();
+             entry != NULL;
+             entry = entry->next.get()) {
+            if (entry->hash == hash &&
+                LabelSequence(entry->getLabelsData()).equals(labels, true)) {
+                ++entry->refcount;
+                return (entry->getLabelsData());
+            }
+        }
+    }
+
+    // Keep the load factor at 1 at most.  Growing the table is complete
+    // by itself, so it doesn't matter if allocating the entry throws.
+    if (bucket_count_ == 0) {
+        rehash(mem_sgmt, INITIAL_BUCKET_COUNT);
+    } else if (entry_count_ >= bucket_count_) {
+        rehash(mem_sgmt, bucket_count_ * 2);
+    }
+
+    const size_t labels_len = labels.getSerializedLength();
+    void* p = mem_sgmt.allocate(sizeof(Entry) + labels_len);
+    Entry* entry = new(p) Entry(hash);
+    labels.serialize(entry->getLabelsData(), labels_len);
+    EntryPtr& head = buckets_[hash & (bucket_count_ - 1)];
+    entry->next = head;
+    head = entry;
+    ++entry_count_;
+    return (entry->getLabelsData());
+}
+
+void
+LabelPool::releaseLabels(util::MemorySegment& mem_sgmt,
+                         const void* labels_data)
+{
+    Entry* const entry = Entry::fromLabelsData(labels_data);
+    assert(entry->refcount > 0);
+    if (--entry->refcount > 0) {
+        return;
+    }
+
+    EntryPtr* link = &buckets_[entry->hash & (bucket_count_ - 1)];
+    while (link->get() != entry) {
+        assert(*link);
+        link = &(*link)->next;
+    }
+    *link = entry->next;
+    --entry_count_;
+
+    const size_t size = entry->getAllocatedSize();
+    entry->~Entry();
+    mem_sgmt.deallocate(entry, size);
+}
+
+size_t
+LabelPool::getAllocatedSize() const {
+    size_t size = sizeof(EntryPtr) * bucket_count_;
+    for (uint32_t i = 0; i < bucket_count_; ++i) {
+        for (const Entry* entry = buckets_[i].get();
+             entry != NULL;
+             entry = entry->next.get()) {
+            size += entry->getAllocatedSize();
+        }
+    }
+    return (size);
+}
+
+} // namespace memory
+} // namespace datasrc
+} // namespace bundy
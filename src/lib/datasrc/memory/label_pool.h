@@ -0,0 +1,134 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef DATASRC_MEMORY_LABEL_POOL_H
+#define DATASRC_MEMORY_LABEL_POOL_H 1
+
+#include <util/memory_segment.h>
+
+#include <dns/labelsequence.h>
+
+#include <boost/interprocess/offset_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace datasrc {
+namespace memory {
+
+/// \brief Shared storage of label sequences.
+///
+/// This class keeps a single copy of each distinct label sequence given
+/// to \c addLabels() in the serialized form, so that the nodes of a
+/// \c DomainTree with many identical relative names (e.g., the same host
+/// labels under many different parents) can refer to the shared copy
+/// instead of holding their own (see \c DomainTree::create()).
+///
+/// Label sequences are compared case-sensitively, since the nodes keep
+/// the original case of the names; sequences that only differ in case
+/// are stored separately.  Each copy has a reference count, and it's
+/// released when the count drops to 0 by \c releaseLabels().
+///
+/// An object of this class is expected to be embedded in another object
+/// allocated from a \c MemorySegment, and the copies and the hash table
+/// are allocated from the same segment.  Like \c ZoneData, everything is
+/// referred to by offset pointers so it can be placed in a shared or
+/// mapped memory segment.
+class LabelPool : boost::noncopyable {
+public:
+    /// \brief The constructor.
+    ///
+    /// No memory is allocated until the first \c addLabels().
+    ///
+    /// \throw none
+    LabelPool();
+
+    /// \brief Release all the memory allocated for the pool.
+    ///
+    /// The data returned by \c addLabels() can't be used after this call,
+    /// regardless of the reference counts.
+    ///
+    /// \throw none
+    ///
+    /// \param mem_sgmt The \c MemorySegment that allocated memory for
+    /// the pool.
+    void clear(util::MemorySegment& mem_sgmt);
+
+    /// \brief Add a reference to the shared copy of a label sequence.
+    ///
+    /// If an identical sequence is already in the pool, its reference
+    /// count is incremented; otherwise a new copy is created.  The
+    /// returned data can be passed to the constructor of
+    /// \c dns::LabelSequence, and is valid until the corresponding
+    /// \c releaseLabels() call.
+    ///
+    /// On \c util::MemorySegmentGrown the pool is not modified.  Note
+    /// that if the caller fails after this call but before storing the
+    /// returned data, the reference is kept until \c clear().
+    ///
+    /// \throw util::MemorySegmentGrown The memory segment has grown,
+    ///     possibly relocating data.
+    /// \throw std::bad_alloc Memory allocation fails.
+    ///
+    /// \param mem_sgmt The \c MemorySegment to allocate memory from.
+    /// \param labels The label sequence to be added.
+    /// \return The serialized data of the shared copy.
+    const void* addLabels(util::MemorySegment& mem_sgmt,
+                          const dns::LabelSequence& labels);
+
+    /// \brief Release a reference to a shared label sequence.
+    ///
+    /// \throw none
+    ///
+    /// \param mem_sgmt The \c MemorySegment that allocated memory for
+    /// the pool.
+    /// \param labels_data Data returned by \c addLabels() on this pool.
+    void releaseLabels(util::MemorySegment& mem_sgmt,
+                       const void* labels_data);
+
+    /// \brief Return the number of distinct label sequences in the pool.
+    ///
+    /// \throw none
+    size_t getLabelsCount() const { return (entry_count_); }
+
+    /// \brief Return the memory allocated for the pool, in bytes.
+    ///
+    /// This is the size of the hash table and of the shared label sequences;
+    /// the pool object itself isn't included.  It walks the whole pool.
+    ///
+    /// \throw none
+    size_t getAllocatedSize() const;
+
+private:
+    struct Entry;
+    typedef boost::interprocess::offset_ptr<Entry> EntryPtr;
+
+    void rehash(util::MemorySegment& mem_sgmt, uint32_t bucket_count);
+
+    boost::interprocess::offset_ptr<EntryPtr> buckets_;
+    uint32_t bucket_count_;     // 0 or a power of 2
+    const uint32_t seed_;
+    size_t entry_count_;
+};
+
+} // namespace memory
+} // namespace datasrc
+} // namespace bundy
+
+#endif // DATASRC_MEMORY_LABEL_POOL_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -26,6 +26,7 @@
 #include <datasrc/factory.h>
 #include <datasrc/result.h>
 
+#include <dns/messagerenderer.h>
 #include <dns/name.h>
 #include <dns/rdataclass.h>
 #include <dns/rrclass.h>
@@ -45,10 +46,12 @@ using boost::shared_ptr;
 
 InMemoryClient::InMemoryClient(const std::string& datasrc_name,
                                shared_ptr<ZoneTableSegment> ztable_segment,
-                               RRClass rrclass) :
+                               RRClass rrclass,
+                               shared_ptr<ZoneNodeSampler> sampler) :
     DataSourceClient(datasrc_name),
     ztable_segment_(ztable_segment),
-    rrclass_(rrclass)
+    rrclass_(rrclass),
+    sampler_(sampler)
 {}
 
 RRClass
@@ -72,7 +75,8 @@ InMemoryClient::findZone(const bundy::dns::Name& zone_name) const {
 
     ZoneFinderPtr finder;
     if (result.code != result::NOTFOUND && result.zone_data) {
-        finder.reset(new InMemoryZoneFinder(*result.zone_data, getClass()));
+        finder.reset(new InMemoryZoneFinder(*result.zone_data, getClass(),
+                                            sampler_.get()));
     }
 
     return (DataSourceClient::FindResult(result.code, finder,
@@ -246,6 +250,45 @@ public:
         }
     }
 
+    // Render the RdataSets directly from the tree, without creating RRset
+    // objects.  The RdataSet that doesn't fit stays the current one.
+    virtual size_t renderNextRRsets(AbstractMessageRenderer& renderer,
+                                    bool skip_soa)
+    {
+        if (separate_rrs_) {
+            return (ZoneIterator::renderNextRRsets(renderer, skip_soa));
+        }
+        size_t count = 0;
+        while (ready_) {
+            while (node_ != NULL &&
+                   (node_->getData() == NULL || set_node_ == NULL)) {
+                node_ = tree_.nextNode(chain_);
+                if (node_ != NULL) {
+                    set_node_ = node_->getData();
+                }
+            }
+            if (node_ == NULL) {
+                ready_ = false;
+                break;
+            }
+            if (!skip_soa || set_node_->type != RRType::SOA()) {
+                const TreeNodeRRset rrset(rrclass_, node_, set_node_, true);
+                const size_t pos = renderer.getLength();
+                const unsigned int rendered = rrset.toWire(renderer);
+                if (renderer.isTruncated()) {
+                    renderer.trim(renderer.getLength() - pos);
+                    return (count);
+                }
+                count += rendered;
+            }
+            set_node_ = set_node_->getNext();
+        }
+        if (nsec3_namespace_ != ZoneIteratorPtr()) {
+            count += nsec3_namespace_->renderNextRRsets(renderer, skip_soa);
+        }
+        return (count);
+    }
+
     virtual ConstRRsetPtr getSOA() const {
         return (soa_);
     }
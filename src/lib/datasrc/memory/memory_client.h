@@ -37,6 +37,7 @@ namespace datasrc {
 namespace memory {
 
 class ZoneTableSegment;
+class ZoneNodeSampler;
 
 /// \brief A data source client that holds all necessary data in memory.
 ///
@@ -64,9 +65,14 @@ public:
     /// This constructor internally involves resource allocation, and if
     /// it fails, a corresponding standard exception will be thrown.
     /// It never throws an exception otherwise.
+    ///
+    /// If \c sampler is non NULL, the zone finders returned by
+    /// \c findZone() pass the nodes they find to it.
     InMemoryClient(const std::string& datasrc_name,
                    boost::shared_ptr<ZoneTableSegment> ztable_segment,
-                   bundy::dns::RRClass rrclass);
+                   bundy::dns::RRClass rrclass,
+                   boost::shared_ptr<ZoneNodeSampler> sampler =
+                   boost::shared_ptr<ZoneNodeSampler>());
     //@}
 
     /// \brief Returns the class of the data source client.
@@ -118,6 +124,7 @@ public:
 private:
     boost::shared_ptr<ZoneTableSegment> ztable_segment_;
     const bundy::dns::RRClass rrclass_;
+    boost::shared_ptr<ZoneNodeSampler> sampler_;
 };
 
 } // namespace memory
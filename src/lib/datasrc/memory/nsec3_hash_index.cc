@@ -0,0 +1,156 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <datasrc/memory/nsec3_hash_index.h>
+
+#include <util/memory_segment.h>
+#include <util/encode/base32hex.h>
+
+#include <dns/name.h>
+
+#include <exceptions/exceptions.h>
+
+#include <boost/static_assert.hpp>
+
+#include <cstring>
+#include <new>                  // for the placement new
+#include <vector>
+
+using namespace bundy::dns;
+
+namespace bundy {
+namespace datasrc {
+namespace memory {
+
+size_t
+NSEC3HashIndex::getAllocatedSize(size_t hash_length, size_t node_count) {
+    return (sizeof(NSEC3HashIndex) +
+            (sizeof(NodePtr) + hash_length) * node_count);
+}
+
+const NSEC3HashIndex::NodePtr*
+NSEC3HashIndex::getNodes() const {
+    return (reinterpret_cast<const NodePtr*>(this + 1));
+}
+
+NSEC3HashIndex::NodePtr*
+NSEC3HashIndex::getNodes() {
+    return (reinterpret_cast<NodePtr*>(this + 1));
+}
+
+const uint8_t*
+NSEC3HashIndex::getHash(size_t pos) const {
+    return (reinterpret_cast<const uint8_t*>(getNodes() + node_count_) +
+            pos * hash_length_);
+}
+
+uint8_t*
+NSEC3HashIndex::getHash(size_t pos) {
+    return (reinterpret_cast<uint8_t*>(getNodes() + node_count_) +
+            pos * hash_length_);
+}
+
+NSEC3HashIndex*
+NSEC3HashIndex::create(util::MemorySegment& mem_sgmt, const ZoneTree& tree,
+                       const Name& origin)
+{
+    BOOST_STATIC_ASSERT(sizeof(NSEC3HashIndex) % sizeof(NodePtr) == 0);
+
+    // First, collect the hashes in the local memory, so we only allocate
+    // memory from the segment once (see ZoneNameIndex::create()).
+    std::vector<const ZoneNode*> nodes;
+    std::vector<uint8_t> hashes;
+    std::vector<uint8_t> hash;
+    size_t hash_length = 0;
+
+    ZoneChain chain;
+    const ZoneNode* node = NULL;
+    if (tree.find(origin, &node, chain) != ZoneTree::EXACTMATCH) {
+        bundy_throw(bundy::Unexpected,
+                    "Zone origin is missing in the NSEC3 tree: " << origin);
+    }
+    const unsigned int label_count = origin.getLabelCount() + 1;
+    for (; node != NULL; node = tree.nextNode(chain)) {
+        if (node->isEmpty()) {
+            continue;
+        }
+        const Name name(chain.getAbsoluteName());
+        if (name.getLabelCount() != label_count) {
+            bundy_throw(bundy::BadValue, "Unexpected NSEC3 owner name: " <<
+                        name);
+        }
+        // This throws BadValue for an invalid base32hex label.
+        util::encode::decodeBase32Hex(name.split(0, 1).toText(true), hash);
+        if (hash.empty()) {
+            bundy_throw(bundy::BadValue, "Empty NSEC3 hash: " << name);
+        }
+        if (nodes.empty()) {
+            hash_length = hash.size();
+        } else if (hash.size() != hash_length) {
+            bundy_throw(bundy::BadValue, "NSEC3 hash length mismatch: " <<
+                        name);
+        } else if (std::memcmp(&hashes[hashes.size() - hash_length],
+                               &hash[0], hash_length) >= 0) {
+            // Names that differ only in the non-canonical encoding of the
+            // same hash would break the order.
+            bundy_throw(bundy::BadValue, "NSEC3 hash out of order: " << name);
+        }
+        nodes.push_back(node);
+        hashes.insert(hashes.end(), hash.begin(), hash.end());
+    }
+
+    void* p = mem_sgmt.allocate(getAllocatedSize(hash_length, nodes.size()));
+    NSEC3HashIndex* index = new(p) NSEC3HashIndex(hash_length, nodes.size());
+    NodePtr* index_nodes = index->getNodes();
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        new(&index_nodes[i]) NodePtr(nodes[i]);
+    }
+    if (!hashes.empty()) {
+        std::memcpy(index->getHash(0), &hashes[0], hashes.size());
+    }
+
+    return (index);
+}
+
+void
+NSEC3HashIndex::destroy(util::MemorySegment& mem_sgmt, NSEC3HashIndex* index)
+{
+    mem_sgmt.deallocate(index, getAllocatedSize(index->hash_length_,
+                                                index->node_count_));
+}
+
+const ZoneNode*
+NSEC3HashIndex::find(const uint8_t* hash, bool& exact) const {
+    // Find the largest hash not larger than the given one.  The number of
+    // iterations only depends on the number of nodes, and the position is
+    // updated with a conditional move rather than a branch.
+    size_t pos = 0;
+    for (size_t count = node_count_; count > 1; ) {
+        const size_t half = count / 2;
+        pos = (std::memcmp(getHash(pos + half), hash, hash_length_) <= 0) ?
+            pos + half : pos;
+        count -= half;
+    }
+    const int cmp = std::memcmp(getHash(pos), hash, hash_length_);
+    exact = (cmp == 0);
+    if (cmp > 0) {
+        // All hashes are larger, so the last one covers it.
+        pos = node_count_ - 1;
+    }
+    return (getNodes()[pos].get());
+}
+
+} // namespace memory
+} // namespace datasrc
+} // namespace bundy
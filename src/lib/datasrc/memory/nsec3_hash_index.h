@@ -0,0 +1,159 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef DATASRC_MEMORY_NSEC3_HASH_INDEX_H
+#define DATASRC_MEMORY_NSEC3_HASH_INDEX_H 1
+
+#include <util/memory_segment.h>
+
+#include <dns/name.h>
+
+#include <datasrc/memory/zone_data.h>
+
+#include <boost/interprocess/offset_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace datasrc {
+namespace memory {
+
+/// \brief Sorted array index of the NSEC3 hashes of a zone.
+///
+/// This class holds the owner names of the NSEC3 RRs of a zone, i.e., the
+/// nodes of the \c ZoneTree of \c NSEC3Data that have data, as a sorted
+/// array of the raw (base32hex decoded) hash values, with a parallel
+/// array of the corresponding nodes.  Since all NSEC3 owner names of a
+/// zone are hashes of the same length directly below the origin, and the
+/// base32hex encoding preserves the order of the raw values, the order of
+/// the array is the same as the DNSSEC order of the names in the tree.  So
+/// the NSEC3 RR matching or covering a given hash can be identified by a
+/// binary search over a contiguous block of memory, rather than by
+/// walking through the tree comparing labels.
+///
+/// An object of this class is stored in a single region allocated from a
+/// \c MemorySegment, which consists of this class object, the node
+/// pointers and the hash values (the latter two immediately follow the
+/// object).  Just like \c ZoneData, node pointers are stored as offset
+/// pointers, so it can be placed in a shared or mapped memory segment.
+///
+/// The index doesn't support modifications; it has to be destroyed when
+/// an NSEC3 owner name is added to or removed from the zone, and can be
+/// rebuilt once the zone has been updated.  Changing the \c RdataSet of
+/// an indexed node doesn't invalidate the index.  It's the responsibility
+/// of the user (normally \c ZoneDataUpdater) to do that.
+class NSEC3HashIndex : boost::noncopyable {
+private:
+    /// \brief The constructor.
+    ///
+    /// An object of this class is always expected to be created by the
+    /// allocator (\c create()), so the constructor is hidden as private.
+    NSEC3HashIndex(size_t hash_length, size_t node_count) :
+        hash_length_(hash_length), node_count_(node_count)
+    {}
+
+public:
+    /// \brief Allocate and construct \c NSEC3HashIndex for the given tree.
+    ///
+    /// It iterates over the entire \c tree, which is expected to be the
+    /// NSEC3 tree of \c NSEC3Data, and builds the index of its nodes that
+    /// have data.
+    ///
+    /// \throw util::MemorySegmentGrown The memory segment has grown, possibly
+    ///     relocating data.  The segment is not modified in this case.
+    /// \throw std::bad_alloc Memory allocation fails.
+    /// \throw bundy::BadValue The tree has a non-empty node whose name is
+    ///     not a base32hex label directly below \c origin, or whose hash
+    ///     has a different length than others.  Such a tree can't be
+    ///     indexed.
+    /// \throw bundy::Unexpected The tree doesn't contain \c origin.
+    ///
+    /// \param mem_sgmt A \c MemorySegment from which memory for the new
+    /// \c NSEC3HashIndex is allocated.
+    /// \param tree The NSEC3 tree of the zone to be indexed.
+    /// \param origin The origin name of the zone.
+    static NSEC3HashIndex* create(util::MemorySegment& mem_sgmt,
+                                  const ZoneTree& tree,
+                                  const dns::Name& origin);
+
+    /// \brief Destruct and deallocate \c NSEC3HashIndex.
+    ///
+    /// \throw none
+    ///
+    /// \param mem_sgmt The \c MemorySegment that allocated memory for
+    /// \c index.
+    /// \param index A non-NULL pointer to a valid NSEC3HashIndex object
+    /// that was originally created by the \c create() method.
+    static void destroy(util::MemorySegment& mem_sgmt, NSEC3HashIndex* index);
+
+    /// \brief Find the node matching or covering the given hash.
+    ///
+    /// If the index has a node of \c hash, it's returned and \c exact is
+    /// set to true.  Otherwise the node of the largest hash smaller than
+    /// \c hash is returned, or that of the largest hash if there's no
+    /// smaller one (i.e., the node of the NSEC3 RR that covers \c hash),
+    /// and \c exact is set to false.
+    ///
+    /// \c hash must be \c getHashLength() bytes long, and the index must
+    /// not be empty.
+    ///
+    /// \throw none
+    ///
+    /// \param hash The raw hash value to be found.
+    /// \param exact Set to whether the returned node matches \c hash.
+    /// \return The matching or covering node.
+    const ZoneNode* find(const uint8_t* hash, bool& exact) const;
+
+    /// \brief Return the length of the indexed hash values, in bytes.
+    ///
+    /// It's 0 if the index is empty.
+    ///
+    /// \throw none
+    size_t getHashLength() const { return (hash_length_); }
+
+    /// \brief Return the number of indexed nodes.
+    ///
+    /// \throw none
+    size_t getNodeCount() const { return (node_count_); }
+
+    /// \brief Return the memory allocated for the index, in bytes.
+    ///
+    /// \throw none
+    size_t getAllocatedSize() const {
+        return (getAllocatedSize(hash_length_, node_count_));
+    }
+
+private:
+    typedef boost::interprocess::offset_ptr<const ZoneNode> NodePtr;
+
+    static size_t getAllocatedSize(size_t hash_length, size_t node_count);
+    const NodePtr* getNodes() const;
+    NodePtr* getNodes();
+    const uint8_t* getHash(size_t pos) const;
+    uint8_t* getHash(size_t pos);
+
+    const size_t hash_length_;
+    const size_t node_count_;
+};
+
+} // namespace memory
+} // namespace datasrc
+} // namespace bundy
+
+#endif // DATASRC_MEMORY_NSEC3_HASH_INDEX_H
+
+// Local Variables:
+// mode: c++
+// End:
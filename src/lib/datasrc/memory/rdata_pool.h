@@ -0,0 +1,130 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef DATASRC_MEMORY_RDATA_POOL_H
+#define DATASRC_MEMORY_RDATA_POOL_H 1
+
+#include <util/memory_segment.h>
+
+#include <boost/interprocess/offset_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace datasrc {
+namespace memory {
+
+/// \brief Shared storage of encoded RDATA.
+///
+/// This class keeps a single copy of each distinct block of encoded RDATA
+/// (as produced by \c RdataEncoder) given to \c addData(), so that the
+/// \c RdataSet objects of a zone holding identical data (e.g., the same
+/// NS or MX set under many delegations) can refer to the shared copy
+/// instead of holding their own (see \c RdataSet::create()).
+///
+/// Blocks are compared byte by byte; the pool doesn't interpret the data,
+/// which is always interpreted by the \c RdataSet referring to it.  Each
+/// copy has a reference count, and it's released when the count drops to
+/// 0 by \c releaseData().
+///
+/// Like \c LabelPool, an object of this class is expected to be embedded
+/// in another object allocated from a \c MemorySegment, and the copies
+/// and the hash table are allocated from the same segment, referred to by
+/// offset pointers.
+class RdataPool : boost::noncopyable {
+public:
+    /// \brief The constructor.
+    ///
+    /// No memory is allocated until the first \c addData().
+    ///
+    /// \throw none
+    RdataPool();
+
+    /// \brief Release all the memory allocated for the pool.
+    ///
+    /// The data returned by \c addData() can't be used after this call,
+    /// regardless of the reference counts.
+    ///
+    /// \throw none
+    ///
+    /// \param mem_sgmt The \c MemorySegment that allocated memory for
+    /// the pool.
+    void clear(util::MemorySegment& mem_sgmt);
+
+    /// \brief Add a reference to the shared copy of a block of data.
+    ///
+    /// If an identical block is already in the pool, its reference
+    /// count is incremented; otherwise a new copy is created.  The
+    /// returned data is suitably aligned to be passed to \c RdataReader,
+    /// and is valid until the corresponding \c releaseData() call.
+    ///
+    /// On \c util::MemorySegmentGrown the pool is not modified.  Note
+    /// that if the caller fails after this call but before storing the
+    /// returned data, the reference is kept until \c clear().
+    ///
+    /// \throw util::MemorySegmentGrown The memory segment has grown,
+    ///     possibly relocating data.
+    /// \throw std::bad_alloc Memory allocation fails.
+    ///
+    /// \param mem_sgmt The \c MemorySegment to allocate memory from.
+    /// \param data The data to be added.
+    /// \param data_len The length of \c data in bytes.
+    /// \return The shared copy of the data.
+    const void* addData(util::MemorySegment& mem_sgmt, const void* data,
+                        size_t data_len);
+
+    /// \brief Release a reference to a shared block of data.
+    ///
+    /// \throw none
+    ///
+    /// \param mem_sgmt The \c MemorySegment that allocated memory for
+    /// the pool.
+    /// \param data Data returned by \c addData() on this pool.
+    void releaseData(util::MemorySegment& mem_sgmt, const void* data);
+
+    /// \brief Return the number of distinct blocks in the pool.
+    ///
+    /// \throw none
+    size_t getDataCount() const { return (entry_count_); }
+
+    /// \brief Return the memory allocated for the pool, in bytes.
+    ///
+    /// This is the size of the hash table and of the shared blocks;
+    /// the pool object itself isn't included.  It walks the whole pool.
+    ///
+    /// \throw none
+    size_t getAllocatedSize() const;
+
+private:
+    struct Entry;
+    typedef boost::interprocess::offset_ptr<Entry> EntryPtr;
+
+    void rehash(util::MemorySegment& mem_sgmt, uint32_t bucket_count);
+
+    boost::interprocess::offset_ptr<EntryPtr> buckets_;
+    uint32_t bucket_count_;     // 0 or a power of 2
+    const uint32_t seed_;
+    size_t entry_count_;
+};
+
+} // namespace memory
+} // namespace datasrc
+} // namespace bundy
+
+#endif // DATASRC_MEMORY_RDATA_POOL_H
+
+// Local Variables:
+// mode: c++
+// End:
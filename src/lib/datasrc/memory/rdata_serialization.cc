@@ -228,6 +228,32 @@ getRdataEncodeSpec(const RRClass& rrclass, const RRType& rrtype) {
     return (generic_data_spec);
 }
 
+RdataLayout
+getRdataLayout(const RRClass& rrclass, const RRType& rrtype) {
+    // The layouts correspond to the field lists of the specs; the same
+    // list may be shared by several types (like CNAME and PTR).
+    const RdataFieldSpec* const fields =
+        getRdataEncodeSpec(rrclass, rrtype).fields;
+    if (fields == generic_data_fields) {
+        return (RDATA_LAYOUT_OPAQUE);
+    } else if (fields == single_ipv4_fields) {
+        return (RDATA_LAYOUT_IPV4);
+    } else if (fields == single_ipv6_fields) {
+        return (RDATA_LAYOUT_IPV6);
+    } else if (fields == single_compadditional_name_fields) {
+        return (RDATA_LAYOUT_ADDITIONAL_NAME);
+    } else if (fields == single_compressible_name_fields) {
+        return (RDATA_LAYOUT_COMPRESSIBLE_NAME);
+    } else if (fields == soa_fields) {
+        return (RDATA_LAYOUT_SOA);
+    } else if (fields == mx_fields) {
+        return (RDATA_LAYOUT_MX);
+    } else if (fields == nsec_fields) {
+        return (RDATA_LAYOUT_NSEC);
+    }
+    return (RDATA_LAYOUT_OTHER);
+}
+
 namespace {
 // This class is a helper for RdataEncoder to divide the content of RDATA
 // fields for encoding by "abusing" the  message rendering logic.
@@ -744,8 +770,45 @@ RdataReader::emptyDataAction(const void*, size_t) {
     // Do nothing here.
 }
 
+bool
+RdataReader::hasSingleDataField() const {
+    return (spec_.field_count == 1 &&
+            spec_.fields[0].type != RdataFieldSpec::DOMAIN_NAME);
+}
+
+bool
+RdataReader::nextRdataData(const void** data, size_t* data_len) {
+    assert(hasSingleDataField());
+    if (spec_pos_ < spec_count_) {
+        const RdataFieldSpec& spec(spec_.fields[0]);
+        const size_t length(spec.type == RdataFieldSpec::FIXEDLEN_DATA ?
+                            spec.fixeddata_len : lengths_[length_pos_++]);
+        *data = data_ + data_pos_;
+        *data_len = length;
+        data_pos_ += length;
+        ++spec_pos_;
+        return (true);
+    } else {
+        sigs_ = data_ + data_pos_;
+        return (false);
+    }
+}
+
 RdataReader::Boundary
 RdataReader::nextSig() {
+    const void* data;
+    size_t data_len;
+    if (nextSigData(&data, &data_len)) {
+        // Call the callback
+        data_action_(data, data_len);
+        return (RDATA_BOUNDARY);
+    } else {
+        return (RRSET_BOUNDARY);
+    }
+}
+
+bool
+RdataReader::nextSigData(const void** data, size_t* data_len) {
     if (sig_pos_ < sig_count_) {
         if (sigs_ == NULL) {
             // We didn't find where the signatures start yet. We do it
@@ -764,16 +827,14 @@ RdataReader::nextSig() {
             length_pos_ = length_pos;
         }
         // Extract the result
-        const size_t length = lengths_[var_count_total_ + sig_pos_];
-        const uint8_t* const pos = sigs_ + sig_data_pos_;
+        *data_len = lengths_[var_count_total_ + sig_pos_];
+        *data = sigs_ + sig_data_pos_;
         // Move the position of iterator.
-        sig_data_pos_ += lengths_[var_count_total_ + sig_pos_];
+        sig_data_pos_ += *data_len;
         ++sig_pos_;
-        // Call the callback
-        data_action_(pos, length);
-        return (RDATA_BOUNDARY);
+        return (true);
     } else {
-        return (RRSET_BOUNDARY);
+        return (false);
     }
 }
 
@@ -24,6 +24,10 @@
 
 #include <boost/function.hpp>
 #include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+#include <boost/ref.hpp>
+
+#include <cassert>
 
 /// \file rdata_serialization.h
 ///
@@ -42,6 +46,8 @@
 /// the bundy::datasrc::memory::RdataReader provides an interface to iterate
 /// over encoded set of RDATA for purposes such as data lookups or rendering
 /// the data into the wire format to create a DNS message.
+/// bundy::datasrc::memory::RdataFieldReader is a faster variant of the
+/// latter for performance sensitive paths.
 ///
 /// The actual encoding detail is private information to the implementation,
 /// and the application shouldn't assume anything about that except that
@@ -501,12 +507,49 @@ public:
         }
     }
 
+    /// \brief Return if each RDATA consists of a single data field.
+    ///
+    /// This is the case if the RDATA don't contain any domain name, such
+    /// as those of A, AAAA, TXT, DNSKEY (or any RR types treated as opaque
+    /// data), in which case the wire format of each RDATA is stored as is.
+    /// For such RDATA \c nextRdataData() can be used instead of
+    /// \c iterateRdata().
+    bool hasSingleDataField() const;
+
+    /// \brief Get the next RDATA consisting of a single data field.
+    ///
+    /// This is a shortcut of \c iterateRdata() for the case where
+    /// \c hasSingleDataField() is true.  Instead of calling the data
+    /// action, it returns the wire format data of the RDATA, which is
+    /// valid as long as the data given on construction is valid.
+    ///
+    /// It must not be called if \c hasSingleDataField() is false.
+    ///
+    /// \param data Set to the beginning of the RDATA.
+    /// \param data_len Set to the length of the RDATA.
+    /// \return true if there was an RDATA; false if it reached the end
+    ///     (in which case \c data and \c data_len are intact).
+    bool nextRdataData(const void** data, size_t* data_len);
+
     /// \brief Step to next field of RRSig data.
     ///
     /// This is almost the same as next(), but it iterates through the
     /// associated RRSig data, not the data for the given RRType.
     Boundary nextSig();
 
+    /// \brief Get the next RRSig data.
+    ///
+    /// This is similar to \c nextRdataData(), but for RRSig data (which
+    /// always consist of a single data field).  It's a shortcut of
+    /// \c iterateSingleSig() that returns the data instead of calling the
+    /// data action.
+    ///
+    /// \param data Set to the beginning of the RRSig data.
+    /// \param data_len Set to the length of the RRSig data.
+    /// \return true if there was an RRSig; false if it reached the end
+    ///     (in which case \c data and \c data_len are intact).
+    bool nextSigData(const void** data, size_t* data_len);
+
     /// \brief Iterate through all RRSig data.
     ///
     /// This is almost the same as iterate(), but it iterates through the
@@ -573,6 +616,408 @@ private:
                           const DataAction& data_action);
 };
 
+/// \brief Layouts of the fields of encoded RDATA.
+///
+/// Each of them (but \c RDATA_LAYOUT_OTHER) corresponds to a sequence of
+/// fields known at compile time, which is used by \c RdataFieldReader to
+/// iterate over the fields without interpreting the field specification
+/// of the RR type at run time.  The layouts cover the most common RR
+/// types; the RDATA of DS, DNSKEY, RRSIG, NSEC3, TXT and all the types
+/// without any domain name are encoded as opaque data.
+enum RdataLayout {
+    RDATA_LAYOUT_OPAQUE,        ///< Variable length data only
+    RDATA_LAYOUT_IPV4,          ///< A: 4 bytes of data
+    RDATA_LAYOUT_IPV6,          ///< AAAA: 16 bytes of data
+    RDATA_LAYOUT_ADDITIONAL_NAME, ///< NS: compressible name with additional
+                                  ///< section handling
+    RDATA_LAYOUT_COMPRESSIBLE_NAME, ///< CNAME, PTR: compressible name
+    RDATA_LAYOUT_SOA,           ///< SOA: two compressible names, 20 bytes
+    RDATA_LAYOUT_MX,            ///< MX: 2 bytes, name with additional handling
+    RDATA_LAYOUT_NSEC,          ///< NSEC: name, variable length data
+    RDATA_LAYOUT_OTHER          ///< Anything else
+};
+
+/// \brief Return the layout of the encoded RDATA of the given class and
+/// type.
+///
+/// This never throws.
+RdataLayout getRdataLayout(const dns::RRClass& rrclass,
+                           const dns::RRType& rrtype);
+
+/// \brief Field types of the layouts in \c RdataLayout.
+///
+/// Each reads a field of encoded RDATA at \c data, calls the appropriate
+/// action for it, and moves \c data (and \c lengths, for a variable length
+/// field) past it.  The \c RdataLayoutFields template combines them into
+/// the whole RDATA.  These are internal to \c RdataFieldReader.
+namespace rdata_layout {
+
+struct NoField {
+    template <typename NameAction, typename DataAction>
+    static void read(const uint8_t*&, const uint16_t*&, NameAction&,
+                     DataAction&)
+    {}
+};
+
+template <size_t LENGTH>
+struct FixedData {
+    template <typename NameAction, typename DataAction>
+    static void read(const uint8_t*& data, const uint16_t*&, NameAction&,
+                     DataAction& data_action)
+    {
+        data_action(data, LENGTH);
+        data += LENGTH;
+    }
+};
+
+struct VarData {
+    template <typename NameAction, typename DataAction>
+    static void read(const uint8_t*& data, const uint16_t*& lengths,
+                     NameAction&, DataAction& data_action)
+    {
+        const size_t length = *lengths++;
+        data_action(data, length);
+        data += length;
+    }
+};
+
+template <unsigned int ATTRIBUTES>
+struct DomainName {
+    template <typename NameAction, typename DataAction>
+    static void read(const uint8_t*& data, const uint16_t*&,
+                     NameAction& name_action, DataAction&)
+    {
+        const dns::LabelSequence sequence(data);
+        data += sequence.getSerializedLength();
+        name_action(sequence, static_cast<RdataNameAttributes>(ATTRIBUTES));
+    }
+};
+
+template <typename Field1, typename Field2 = NoField,
+          typename Field3 = NoField>
+struct RdataLayoutFields {
+    template <typename NameAction, typename DataAction>
+    static void read(const uint8_t*& data, const uint16_t*& lengths,
+                     NameAction& name_action, DataAction& data_action)
+    {
+        Field1::read(data, lengths, name_action, data_action);
+        Field2::read(data, lengths, name_action, data_action);
+        Field3::read(data, lengths, name_action, data_action);
+    }
+};
+
+const unsigned int COMPRESSIBLE_ADDITIONAL =
+    NAMEATTR_COMPRESSIBLE | NAMEATTR_ADDITIONAL;
+
+typedef RdataLayoutFields<VarData> Opaque;
+typedef RdataLayoutFields<FixedData<4> > IPv4;
+typedef RdataLayoutFields<FixedData<16> > IPv6;
+typedef RdataLayoutFields<DomainName<COMPRESSIBLE_ADDITIONAL> >
+    AdditionalName;
+typedef RdataLayoutFields<DomainName<NAMEATTR_COMPRESSIBLE> >
+    CompressibleName;
+typedef RdataLayoutFields<DomainName<NAMEATTR_COMPRESSIBLE>,
+                          DomainName<NAMEATTR_COMPRESSIBLE>,
+                          FixedData<sizeof(uint32_t) * 5> > SOA;
+typedef RdataLayoutFields<FixedData<sizeof(uint16_t)>,
+                          DomainName<COMPRESSIBLE_ADDITIONAL> > MX;
+typedef RdataLayoutFields<DomainName<NAMEATTR_NONE>, VarData> NSEC;
+
+// Actions doing nothing, used to skip the RDATA.
+struct NoNameAction {
+    void operator()(const dns::LabelSequence&, RdataNameAttributes) const {}
+};
+struct NoDataAction {
+    void operator()(const void*, size_t) const {}
+};
+
+} // namespace rdata_layout
+
+/// \brief Class to read serialized rdata, specialized for the callbacks.
+///
+/// This is a variant of \c RdataReader for performance sensitive paths,
+/// with the same interface for the iteration (but \c next(), \c nextSig()
+/// and \c rewind(): the fields are only read in RDATA units, and only
+/// once).  The callbacks are given as template parameters, so they can be
+/// any function objects and are called directly (and normally inlined)
+/// instead of through \c boost::function; the fields of the common RR
+/// types (see \c RdataLayout) are read with their layout known at
+/// compile time, chosen once by the RR type.  The other RR types are read
+/// through an internal \c RdataReader.
+///
+/// \code
+/// struct NameRenderer {
+///     void operator()(const LabelSequence& labels,
+///                     RdataNameAttributes attributes) const { ... }
+/// };
+/// struct DataRenderer {
+///     void operator()(const void* data, size_t data_len) const { ... }
+/// };
+///
+/// RdataFieldReader<NameRenderer, DataRenderer>
+///     reader(RRClass::IN(), RRType::MX(), data, rdata_count, sig_count,
+///            NameRenderer(), DataRenderer());
+/// reader.iterate();
+/// reader.iterateAllSigs();
+/// \endcode
+///
+/// The same note about the validity of the data as for \c RdataReader
+/// applies.
+template <typename NameAction, typename DataAction>
+class RdataFieldReader : boost::noncopyable {
+public:
+    /// \brief Constructor
+    ///
+    /// The parameters are the same as those of \c RdataReader, but the
+    /// callbacks are copied into the reader.
+    RdataFieldReader(const dns::RRClass& rrclass, const dns::RRType& rrtype,
+                     const void* data, size_t rdata_count, size_t sig_count,
+                     const NameAction& name_action,
+                     const DataAction& data_action) :
+        name_action_(name_action), data_action_(data_action),
+        layout_(getRdataLayout(rrclass, rrtype)),
+        rdata_count_(rdata_count), sig_count_(sig_count),
+        rdata_pos_(0), sig_pos_(0)
+    {
+        if (layout_ == RDATA_LAYOUT_OTHER) {
+            reader_.emplace(rrclass, rrtype, data, rdata_count, sig_count,
+                            boost::ref(name_action_),
+                            boost::ref(data_action_));
+            return;
+        }
+        // Of the specialized layouts, only these have a variable length
+        // field, and exactly one.
+        const size_t varlen_count =
+            (layout_ == RDATA_LAYOUT_OPAQUE ||
+             layout_ == RDATA_LAYOUT_NSEC) ? rdata_count : 0;
+        lengths_ = static_cast<const uint16_t*>(data);
+        sig_lengths_ = lengths_ + varlen_count;
+        data_ = reinterpret_cast<const uint8_t*>(sig_lengths_ + sig_count);
+        sigs_ = (rdata_count == 0) ? data_ : NULL;
+    }
+
+    /// \brief Call the actions for all the remaining RDATA.
+    void iterate() {
+        switch (layout_) {
+        case RDATA_LAYOUT_OPAQUE:
+            readAll<rdata_layout::Opaque>(name_action_, data_action_);
+            break;
+        case RDATA_LAYOUT_IPV4:
+            readAll<rdata_layout::IPv4>(name_action_, data_action_);
+            break;
+        case RDATA_LAYOUT_IPV6:
+            readAll<rdata_layout::IPv6>(name_action_, data_action_);
+            break;
+        case RDATA_LAYOUT_ADDITIONAL_NAME:
+            readAll<rdata_layout::AdditionalName>(name_action_, data_action_);
+            break;
+        case RDATA_LAYOUT_COMPRESSIBLE_NAME:
+            readAll<rdata_layout::CompressibleName>(name_action_,
+                                                    data_action_);
+            break;
+        case RDATA_LAYOUT_SOA:
+            readAll<rdata_layout::SOA>(name_action_, data_action_);
+            break;
+        case RDATA_LAYOUT_MX:
+            readAll<rdata_layout::MX>(name_action_, data_action_);
+            break;
+        case RDATA_LAYOUT_NSEC:
+            readAll<rdata_layout::NSEC>(name_action_, data_action_);
+            break;
+        case RDATA_LAYOUT_OTHER:
+            reader_->iterate();
+            break;
+        }
+    }
+
+    /// \brief Call the actions for the fields of the next RDATA.
+    ///
+    /// \return If there was RDATA to iterate through.
+    bool iterateRdata() {
+        if (layout_ == RDATA_LAYOUT_OTHER) {
+            return (reader_->iterateRdata());
+        }
+        if (rdata_pos_ == rdata_count_) {
+            sigs_ = data_;
+            return (false);
+        }
+        switch (layout_) {
+        case RDATA_LAYOUT_OPAQUE:
+            readRdata<rdata_layout::Opaque>(name_action_, data_action_);
+            break;
+        case RDATA_LAYOUT_IPV4:
+            readRdata<rdata_layout::IPv4>(name_action_, data_action_);
+            break;
+        case RDATA_LAYOUT_IPV6:
+            readRdata<rdata_layout::IPv6>(name_action_, data_action_);
+            break;
+        case RDATA_LAYOUT_ADDITIONAL_NAME:
+            readRdata<rdata_layout::AdditionalName>(name_action_,
+                                                    data_action_);
+            break;
+        case RDATA_LAYOUT_COMPRESSIBLE_NAME:
+            readRdata<rdata_layout::CompressibleName>(name_action_,
+                                                      data_action_);
+            break;
+        case RDATA_LAYOUT_SOA:
+            readRdata<rdata_layout::SOA>(name_action_, data_action_);
+            break;
+        case RDATA_LAYOUT_MX:
+            readRdata<rdata_layout::MX>(name_action_, data_action_);
+            break;
+        case RDATA_LAYOUT_NSEC:
+            readRdata<rdata_layout::NSEC>(name_action_, data_action_);
+            break;
+        case RDATA_LAYOUT_OTHER:
+            break;
+        }
+        return (true);
+    }
+
+    /// \brief Return if each RDATA consists of a single data field.
+    ///
+    /// \see RdataReader::hasSingleDataField()
+    bool hasSingleDataField() const {
+        switch (layout_) {
+        case RDATA_LAYOUT_OPAQUE:
+        case RDATA_LAYOUT_IPV4:
+        case RDATA_LAYOUT_IPV6:
+            return (true);
+        case RDATA_LAYOUT_OTHER:
+            return (reader_->hasSingleDataField());
+        default:
+            return (false);
+        }
+    }
+
+    /// \brief Get the next RDATA consisting of a single data field.
+    ///
+    /// \see RdataReader::nextRdataData()
+    bool nextRdataData(const void** data, size_t* data_len) {
+        assert(hasSingleDataField());
+        if (layout_ == RDATA_LAYOUT_OTHER) {
+            return (reader_->nextRdataData(data, data_len));
+        }
+        if (rdata_pos_ == rdata_count_) {
+            sigs_ = data_;
+            return (false);
+        }
+        *data = data_;
+        *data_len = (layout_ == RDATA_LAYOUT_IPV4) ? 4 :
+            (layout_ == RDATA_LAYOUT_IPV6) ? 16 : *lengths_++;
+        data_ += *data_len;
+        ++rdata_pos_;
+        return (true);
+    }
+
+    /// \brief Call the data action for the next RRSIG.
+    ///
+    /// \return If there was an RRSIG.
+    bool iterateSingleSig() {
+        const void* data;
+        size_t data_len;
+        if (nextSigData(&data, &data_len)) {
+            data_action_(data, data_len);
+            return (true);
+        }
+        return (false);
+    }
+
+    /// \brief Call the data action for all the remaining RRSIGs.
+    void iterateAllSigs() {
+        while (iterateSingleSig()) {}
+    }
+
+    /// \brief Get the next RRSig data.
+    ///
+    /// \see RdataReader::nextSigData()
+    bool nextSigData(const void** data, size_t* data_len) {
+        if (layout_ == RDATA_LAYOUT_OTHER) {
+            return (reader_->nextSigData(data, data_len));
+        }
+        if (sig_pos_ == sig_count_) {
+            return (false);
+        }
+        if (sigs_ == NULL) {
+            findSigs();
+        }
+        *data = sigs_;
+        *data_len = sig_lengths_[sig_pos_++];
+        sigs_ += *data_len;
+        return (true);
+    }
+
+private:
+    template <typename Fields, typename NameActionT, typename DataActionT>
+    void readRdata(NameActionT& name_action, DataActionT& data_action) {
+        Fields::read(data_, lengths_, name_action, data_action);
+        ++rdata_pos_;
+    }
+
+    template <typename Fields, typename NameActionT, typename DataActionT>
+    void readAll(NameActionT& name_action, DataActionT& data_action) {
+        while (rdata_pos_ < rdata_count_) {
+            readRdata<Fields>(name_action, data_action);
+        }
+        sigs_ = data_;
+    }
+
+    // Locate the RRSIGs behind the remaining RDATA, without moving over
+    // the RDATA.
+    void findSigs() {
+        const uint8_t* const data = data_;
+        const uint16_t* const lengths = lengths_;
+        const size_t rdata_pos = rdata_pos_;
+        rdata_layout::NoNameAction no_name;
+        rdata_layout::NoDataAction no_data;
+        switch (layout_) {
+        case RDATA_LAYOUT_OPAQUE:
+            readAll<rdata_layout::Opaque>(no_name, no_data);
+            break;
+        case RDATA_LAYOUT_IPV4:
+            readAll<rdata_layout::IPv4>(no_name, no_data);
+            break;
+        case RDATA_LAYOUT_IPV6:
+            readAll<rdata_layout::IPv6>(no_name, no_data);
+            break;
+        case RDATA_LAYOUT_ADDITIONAL_NAME:
+            readAll<rdata_layout::AdditionalName>(no_name, no_data);
+            break;
+        case RDATA_LAYOUT_COMPRESSIBLE_NAME:
+            readAll<rdata_layout::CompressibleName>(no_name, no_data);
+            break;
+        case RDATA_LAYOUT_SOA:
+            readAll<rdata_layout::SOA>(no_name, no_data);
+            break;
+        case RDATA_LAYOUT_MX:
+            readAll<rdata_layout::MX>(no_name, no_data);
+            break;
+        case RDATA_LAYOUT_NSEC:
+            readAll<rdata_layout::NSEC>(no_name, no_data);
+            break;
+        case RDATA_LAYOUT_OTHER:
+            break;
+        }
+        data_ = data;
+        lengths_ = lengths;
+        rdata_pos_ = rdata_pos;
+    }
+
+    NameAction name_action_;
+    DataAction data_action_;
+    const RdataLayout layout_;
+    const size_t rdata_count_, sig_count_;
+    // Lengths of the next variable length field and of the RRSIGs
+    const uint16_t* lengths_;
+    const uint16_t* sig_lengths_;
+    // The next RDATA, and the next RRSIG (NULL until found)
+    const uint8_t* data_;
+    const uint8_t* sigs_;
+    size_t rdata_pos_, sig_pos_;
+    // The reader of RDATA with layout RDATA_LAYOUT_OTHER
+    boost::optional<RdataReader> reader_;
+};
+
 } // namespace memory
 } // namespace datasrc
 } // namespace bundy
@@ -13,6 +13,7 @@
 // PERFORMANCE OF THIS SOFTWARE.
 
 #include "rdataset.h"
+#include "rdata_pool.h"
 #include "rdata_serialization.h"
 
 #include <exceptions/exceptions.h>
@@ -29,8 +30,10 @@
 
 #include <stdint.h>
 #include <algorithm>
+#include <cassert>
 #include <cstring>
 #include <new>                  // for the placement new
+#include <vector>
 
 using namespace bundy::dns;
 using namespace bundy::dns::rdata;
@@ -120,26 +123,61 @@ sanityChecks(const ConstRRsetPtr& rrset, const ConstRRsetPtr &sig_rrset,
 RdataSet*
 RdataSet::packSet(util::MemorySegment& mem_sgmt, RdataEncoder& encoder,
                   size_t rdata_count, size_t rrsig_count, const RRType& rrtype,
-                  const RRTTL& rrttl)
+                  const RRTTL& rrttl, RdataPool* rdata_pool)
 {
-    const size_t ext_rrsig_count_len =
-        rrsig_count >= MANY_RRSIG_COUNT ? sizeof(uint16_t) : 0;
     const size_t data_len = encoder.getStorageLength();
-    void* p = mem_sgmt.allocate(sizeof(RdataSet) + ext_rrsig_count_len +
-                                data_len);
+    if (isSharedData(rdata_pool, rrsig_count, data_len)) {
+        std::vector<uint8_t> data(data_len);
+        encoder.encode(&data[0], data_len);
+        // Add the data first, so the pool keeps the reference (and no
+        // RdataSet is leaked) if allocating the RdataSet throws.
+        const void* shared_data =
+            rdata_pool->addData(mem_sgmt, &data[0], data_len);
+        return (allocateSet(mem_sgmt, rdata_count, rrsig_count, rrtype,
+                            rrttl, data_len, shared_data));
+    }
+    RdataSet* rdataset = allocateSet(mem_sgmt, rdata_count, rrsig_count,
+                                     rrtype, rrttl, data_len, NULL);
+    encoder.encode(rdataset->getDataBuf(), data_len);
+    return (rdataset);
+}
+
+RdataSet*
+RdataSet::allocateSet(util::MemorySegment& mem_sgmt, size_t rdata_count,
+                      size_t rrsig_count, const RRType& rrtype,
+                      const RRTTL& rrttl, size_t data_len,
+                      const void* shared_data)
+{
+    const size_t additional_nodes_len = hasAdditionalNodes(rrtype) ?
+        sizeof(AdditionalNodePtr) * rdata_count : 0;
+    size_t ext_rrsig_count_len =
+        rrsig_count >= MANY_RRSIG_COUNT ? sizeof(uint16_t) : 0;
+    if (shared_data != NULL) {
+        ext_rrsig_count_len = sizeof(SharedDataPtr);
+        data_len = sizeof(SharedDataPtr);
+    }
+    void* p = mem_sgmt.allocate(sizeof(RdataSet) + additional_nodes_len +
+                                ext_rrsig_count_len + data_len);
     RdataSet* rdataset = new(p) RdataSet(rrtype, rdata_count, rrsig_count,
-                                         rrttl);
-    if (rrsig_count >= RdataSet::MANY_RRSIG_COUNT) {
+                                         rrttl, shared_data != NULL);
+    AdditionalNodePtr* nodes = rdataset->getAdditionalNodeBuf();
+    for (size_t i = 0; i < rdataset->getAdditionalNodeCount(); ++i) {
+        new(&nodes[i]) AdditionalNodePtr();
+    }
+    rdataset->clearAdditionalNodes();
+    if (rdataset->sig_rdata_count_ == MANY_RRSIG_COUNT) {
         *rdataset->getExtSIGCountBuf() = rrsig_count;
     }
-    encoder.encode(rdataset->getDataBuf(), data_len);
+    if (shared_data != NULL) {
+        new(rdataset->getSharedDataPtr()) SharedDataPtr(shared_data);
+    }
     return (rdataset);
 }
 
 RdataSet*
 RdataSet::create(util::MemorySegment& mem_sgmt, RdataEncoder& encoder,
                  ConstRRsetPtr rrset, ConstRRsetPtr sig_rrset,
-                 const RdataSet* old_rdataset)
+                 const RdataSet* old_rdataset, RdataPool* rdata_pool)
 {
     const std::pair<RRClass, RRType>& rrparams =
         sanityChecks(rrset, sig_rrset, old_rdataset);
@@ -194,7 +232,7 @@ RdataSet::create(util::MemorySegment& mem_sgmt, RdataEncoder& encoder,
     }
 
     return (packSet(mem_sgmt, encoder, rdata_count, rrsig_count, rrtype,
-                    rrttl));
+                    rrttl, rdata_pool));
 }
 
 namespace {
@@ -249,7 +287,7 @@ RdataSet*
 RdataSet::subtract(util::MemorySegment& mem_sgmt, RdataEncoder& encoder,
                    const dns::ConstRRsetPtr& rrset,
                    const dns::ConstRRsetPtr& sig_rrset,
-                   const RdataSet& old_rdataset)
+                   const RdataSet& old_rdataset, RdataPool* rdata_pool)
 {
     const std::pair<RRClass, RRType>& rrparams =
         sanityChecks(rrset, sig_rrset, &old_rdataset);
@@ -285,24 +323,76 @@ RdataSet::subtract(util::MemorySegment& mem_sgmt, RdataEncoder& encoder,
         return (NULL); // It is left empty
     }
     return (packSet(mem_sgmt, encoder, rdata_count, rrsig_count, rrtype,
-                    restoreTTL(old_rdataset.getTTLData())));
+                    restoreTTL(old_rdataset.getTTLData()), rdata_pool));
 }
 
-void
-RdataSet::destroy(util::MemorySegment& mem_sgmt, RdataSet* rdataset,
-                  RRClass rrclass)
+RdataSet*
+RdataSet::copy(util::MemorySegment& mem_sgmt, RRClass rrclass,
+               const RdataSet& source, RdataPool* rdata_pool)
 {
     const size_t data_len =
-        RdataReader(rrclass, rdataset->type,
-                    reinterpret_cast<const uint8_t*>(rdataset->getDataBuf()),
-                    rdataset->getRdataCount(), rdataset->getSigRdataCount(),
+        RdataReader(rrclass, source.type,
+                    reinterpret_cast<const uint8_t*>(source.getDataBuf()),
+                    source.getRdataCount(), source.getSigRdataCount(),
                     &RdataReader::emptyNameAction,
                     &RdataReader::emptyDataAction).getSize();
+    if (isSharedData(rdata_pool, source.getSigRdataCount(), data_len)) {
+        const void* shared_data =
+            rdata_pool->addData(mem_sgmt, source.getDataBuf(), data_len);
+        return (allocateSet(mem_sgmt, source.getRdataCount(),
+                            source.getSigRdataCount(), source.type,
+                            restoreTTL(source.getTTLData()), data_len,
+                            shared_data));
+    }
+    RdataSet* rdataset = allocateSet(mem_sgmt, source.getRdataCount(),
+                                     source.getSigRdataCount(), source.type,
+                                     restoreTTL(source.getTTLData()),
+                                     data_len, NULL);
+    std::memcpy(rdataset->getDataBuf(), source.getDataBuf(), data_len);
+    return (rdataset);
+}
+
+size_t
+RdataSet::getAllocatedSize(RRClass rrclass) const {
+    const size_t additional_nodes_len =
+        sizeof(AdditionalNodePtr) * getAdditionalNodeCount();
+    if (hasSharedData()) {
+        return (sizeof(RdataSet) + additional_nodes_len +
+                sizeof(SharedDataPtr) + sizeof(SharedDataPtr));
+    }
     const size_t ext_rrsig_count_len =
-        rdataset->sig_rdata_count_ == MANY_RRSIG_COUNT ? sizeof(uint16_t) : 0;
+        sig_rdata_count_ == MANY_RRSIG_COUNT ? sizeof(uint16_t) : 0;
+    const size_t data_len =
+        RdataReader(rrclass, type,
+                    reinterpret_cast<const uint8_t*>(getDataBuf()),
+                    getRdataCount(), getSigRdataCount(),
+                    &RdataReader::emptyNameAction,
+                    &RdataReader::emptyDataAction).getSize();
+    return (sizeof(RdataSet) + additional_nodes_len + ext_rrsig_count_len +
+            data_len);
+}
+
+void
+RdataSet::destroy(util::MemorySegment& mem_sgmt, RdataSet* rdataset,
+                  RRClass rrclass, RdataPool* rdata_pool)
+{
+    const size_t size = rdataset->getAllocatedSize(rrclass);
+    if (rdataset->hasSharedData()) {
+        assert(rdata_pool != NULL);
+        rdata_pool->releaseData(mem_sgmt, rdataset->getDataBuf());
+    }
     rdataset->~RdataSet();
-    mem_sgmt.deallocate(rdataset,
-                        sizeof(RdataSet) + ext_rrsig_count_len + data_len);
+    mem_sgmt.deallocate(rdataset, size);
+}
+
+void
+RdataSet::clearAdditionalNodes() {
+    const AdditionalNode* const unset =
+        reinterpret_cast<const AdditionalNode*>(this);
+    AdditionalNodePtr* nodes = getAdditionalNodeBuf();
+    for (size_t i = 0; i < getAdditionalNodeCount(); ++i) {
+        nodes[i] = unset;
+    }
 }
 
 namespace {
@@ -324,9 +414,9 @@ convertTTL(RRTTL ttl) {
 }
 
 RdataSet::RdataSet(RRType type_param, size_t rdata_count,
-                   size_t sig_rdata_count, RRTTL ttl) :
+                   size_t sig_rdata_count, RRTTL ttl, bool shared_data) :
     type(type_param),
-    sig_rdata_count_(sig_rdata_count >= MANY_RRSIG_COUNT ?
+    sig_rdata_count_(sig_rdata_count >= MANY_RRSIG_COUNT || shared_data ?
                      MANY_RRSIG_COUNT : sig_rdata_count),
     rdata_count_(rdata_count), ttl_(convertTTL(ttl))
 {
@@ -338,6 +428,10 @@ RdataSet::RdataSet(RRType type_param, size_t rdata_count,
     // Confirm we meet the alignment requirement for RdataEncoder
     // ("this + 1" should be safely passed to the encoder).
     BOOST_STATIC_ASSERT(sizeof(RdataSet) % sizeof(uint16_t) == 0);
+    // And for the additional nodes that may come first.
+    BOOST_STATIC_ASSERT(sizeof(RdataSet) % sizeof(AdditionalNodePtr) == 0);
+    // And for the pointer to the shared data that follows them.
+    BOOST_STATIC_ASSERT(sizeof(SharedDataPtr) == sizeof(AdditionalNodePtr));
 }
 
 } // namespace memory
@@ -31,6 +31,8 @@ namespace bundy {
 namespace datasrc {
 namespace memory {
 class RdataEncoder;
+class RdataPool;
+template <typename T> class DomainTreeNode;
 
 /// \brief General error on creating RdataSet.
 ///
@@ -104,9 +106,29 @@ public:
 /// \c RdataSet object.  The memory layout would be as follows:
 /// \verbatim
 /// RdataSet object
+/// (optional) offset pointers: additional nodes, one per RDATA (see below)
 /// (optional) uint16_t: number of RRSIGs, if it's larger than 6 (see above)
 /// encoded RDATA (generated by RdataEncoder) \endverbatim
 ///
+/// If the encoded RDATA is shared in an \c RdataPool (see \c create()),
+/// the RRSIG count field is always used, with an offset pointer to the
+/// shared data in place of the encoded RDATA:
+/// \verbatim
+/// RdataSet object
+/// (optional) offset pointers: additional nodes, one per RDATA
+/// uint16_t: number of RRSIGs, smaller than 7, padded to an offset pointer
+/// offset pointer: encoded RDATA in the pool \endverbatim
+/// The count being smaller than 7 is what distinguishes the two layouts;
+/// an \c RdataSet with more than 6 RRSIGs never shares its data.
+///
+/// The additional nodes are stored for the RR types whose RDATA has a name
+/// subject to additional section processing (NS, MX and SRV; see
+/// \c hasAdditionalNodes()).  They link each RDATA to the zone node that
+/// holds the records for the additional section, so they don't have to be
+/// looked up on every query.  They are not set on creation, and it's up to
+/// the user of this class (normally \c ZoneDataUpdater) to set them once
+/// all nodes of the zone are in place; see \c setAdditionalNode().
+///
 /// This is shown here only for reference purposes.  The application must not
 /// assume any particular format of data in this region directly; it must
 /// get access to it via public interfaces provided in the main \c RdataSet
@@ -199,13 +221,18 @@ public:
     /// created.  Can be NULL if rrset is not.
     /// \param old_rdataset If non NULL, create RdataSet merging old_rdataset
     /// into given rrset and sig_rrset.
+    /// \param rdata_pool If non NULL, the encoded RDATA is shared with the
+    /// other \c RdataSets holding identical data in this pool, unless it's
+    /// too small to be worth it.  It must have been created in
+    /// \c mem_sgmt, and the same pool must be passed to \c destroy().
     ///
     /// \return A pointer to the created \c RdataSet.
     static RdataSet* create(util::MemorySegment& mem_sgmt,
                             RdataEncoder& encoder,
                             dns::ConstRRsetPtr rrset,
                             dns::ConstRRsetPtr sig_rrset,
-                            const RdataSet* old_rdataset = NULL);
+                            const RdataSet* old_rdataset = NULL,
+                            RdataPool* rdata_pool = NULL);
 
     /// \brief Subtract some RDATAs and RRSIGs from an RdataSet
     ///
@@ -246,6 +273,8 @@ public:
     /// \param sig_rrset An RRSIG RRset containing the RRSIGs that are not
     /// to be present in the result. Can be NULL if rrset is not.
     /// \param old_rdataset The data from which to subtract.
+    /// \param rdata_pool The pool to share the encoded RDATA in, as for
+    /// \c create().
     ///
     /// \return A pointer to the created \c RdataSet.  NULL if the
     /// result RdataSet becomes empty.
@@ -253,7 +282,35 @@ public:
                               RdataEncoder& encoder,
                               const dns::ConstRRsetPtr& rrset,
                               const dns::ConstRRsetPtr& sig_rrset,
-                              const RdataSet& old_rdataset);
+                              const RdataSet& old_rdataset,
+                              RdataPool* rdata_pool = NULL);
+
+    /// \brief Allocate and construct a copy of an \c RdataSet.
+    ///
+    /// The new \c RdataSet has the same RR type, TTL, RDATAs and RRSIGs as
+    /// \c source, which can be in a different memory segment than
+    /// \c mem_sgmt (e.g., one that belongs to another thread).  It's not
+    /// linked to any next \c RdataSet, and its additional nodes are unset
+    /// as they can be specific to the zone of \c source.
+    ///
+    /// The memory segment related exception guarantee is the same as
+    /// \c create().
+    ///
+    /// \throw util::MemorySegmentGrown The memory segment has grown, possibly
+    ///     relocating data.
+    /// \throw std::bad_alloc Memory allocation fails.
+    ///
+    /// \param mem_sgmt A \c MemorySegment from which memory for the new
+    /// \c RdataSet is allocated.
+    /// \param rrclass The RR class of \c source (see \c destroy()).
+    /// \param source The \c RdataSet to be copied.
+    /// \param rdata_pool The pool to share the encoded RDATA in, as for
+    /// \c create().  Whether \c source shares its data doesn't matter.
+    ///
+    /// \return A pointer to the created \c RdataSet.
+    static RdataSet* copy(util::MemorySegment& mem_sgmt,
+                          dns::RRClass rrclass, const RdataSet& source,
+                          RdataPool* rdata_pool = NULL);
 
     /// \brief Destruct and deallocate \c RdataSet
     ///
@@ -275,8 +332,106 @@ public:
     /// \param rrclass The RR class of the \c RdataSet to be destroyed.
     /// that was originally created by the \c create() method (the behavior
     /// is undefined if this condition isn't met).
+    /// \param rdata_pool The pool given on creation, if any.
     static void destroy(util::MemorySegment& mem_sgmt, RdataSet* rdataset,
-                        dns::RRClass rrclass);
+                        dns::RRClass rrclass, RdataPool* rdata_pool = NULL);
+
+    /// \brief Return whether the encoded RDATA is shared in an
+    /// \c RdataPool.
+    ///
+    /// \throw none
+    bool hasSharedData() const {
+        return (sig_rdata_count_ == MANY_RRSIG_COUNT &&
+                *getExtSIGCountBuf() < MANY_RRSIG_COUNT);
+    }
+
+    /// \brief Return the memory allocated for the \c RdataSet, in bytes.
+    ///
+    /// If the encoded RDATA is shared (see \c hasSharedData()), only the
+    /// reference to it is included.  \c rrclass must be the RR class of the
+    /// \c RdataSet, as for \c destroy().
+    ///
+    /// \throw none
+    size_t getAllocatedSize(dns::RRClass rrclass) const;
+
+    /// \brief The type of the zone node an additional node links to.
+    typedef DomainTreeNode<RdataSet> AdditionalNode;
+
+    /// \brief Return whether an \c RdataSet of the given type stores the
+    /// additional nodes of its RDATA.
+    ///
+    /// It's the case for the types whose RDATA has exactly one name
+    /// subject to additional section processing, i.e., NS, MX and SRV.
+    ///
+    /// \throw none
+    static bool hasAdditionalNodes(const dns::RRType& type) {
+        // Compare the codes; this is used for every access to the encoded
+        // data, and RRType::NS() etc. may not be as cheap as that.
+        switch (type.getCode()) {
+        case 2:                 // NS
+        case 15:                // MX
+        case 33:                // SRV
+            return (true);
+        default:
+            return (false);
+        }
+    }
+
+    /// \brief Return whether all the additional nodes of the \c RdataSet
+    /// have been set.
+    ///
+    /// It's always false if the \c RdataSet doesn't store them (see
+    /// \c hasAdditionalNodes()) or only has RRSIGs.  Otherwise, it's true
+    /// iff \c setAdditionalNode() has been called for every RDATA since
+    /// the creation or the last call to \c clearAdditionalNodes().
+    ///
+    /// \throw none
+    bool isAdditionalNodeSet() const {
+        const size_t count = getAdditionalNodeCount();
+        const AdditionalNodePtr* nodes = getAdditionalNodeBuf();
+        for (size_t i = 0; i < count; ++i) {
+            if (isUnsetNode(nodes[i])) {
+                return (false);
+            }
+        }
+        return (count > 0);
+    }
+
+    /// \brief Return the additional node of the given RDATA.
+    ///
+    /// \c isAdditionalNodeSet() must be true; otherwise the result is
+    /// undefined.  RDATAs are indexed in the order of \c RdataReader.
+    ///
+    /// \throw none
+    /// \return The node set by \c setAdditionalNode(), possibly NULL.
+    const AdditionalNode* getAdditionalNode(size_t rdata_index) const {
+        return (getAdditionalNodeBuf()[rdata_index].get());
+    }
+
+    /// \brief Set the additional node of the given RDATA.
+    ///
+    /// The \c node must be the zone node whose records are to be added to
+    /// the additional section for the name in the RDATA, or NULL if there
+    /// are none.  It must be in the same memory segment as the
+    /// \c RdataSet, and the caller is responsible for keeping it valid:
+    /// any modification of the zone tree can make it wrong (or dangling),
+    /// so \c clearAdditionalNodes() must be called before that.
+    ///
+    /// The \c RdataSet must store the additional nodes (see
+    /// \c hasAdditionalNodes()), and \c rdata_index must be smaller than
+    /// \c getRdataCount(); otherwise the result is undefined.
+    ///
+    /// \throw none
+    void setAdditionalNode(size_t rdata_index, const AdditionalNode* node) {
+        getAdditionalNodeBuf()[rdata_index] = node;
+    }
+
+    /// \brief Reset all the additional nodes of the \c RdataSet to unset.
+    ///
+    /// This is a no-op if it doesn't store the additional nodes.
+    ///
+    /// \throw none
+    void clearAdditionalNodes();
 
     /// \brief Find \c RdataSet of given RR type from a list (const version).
     ///
@@ -328,6 +483,9 @@ public:
 
     typedef boost::interprocess::offset_ptr<RdataSet> RdataSetPtr;
     typedef boost::interprocess::offset_ptr<const RdataSet> ConstRdataSetPtr;
+    typedef boost::interprocess::offset_ptr<const AdditionalNode>
+    AdditionalNodePtr;
+    typedef boost::interprocess::offset_ptr<const void> SharedDataPtr;
 
     // Note: the size and order of the members are carefully chosen to
     // maximize efficiency.  Don't change them unless there's strong reason
@@ -359,11 +517,34 @@ private:
     // field for the real number of RRSIGs.  It's 2^3 - 1 = 7.
     static const size_t MANY_RRSIG_COUNT = (1 << 3) - 1;
 
+    // Encoded data up to this size is never shared, as it's not larger
+    // than the RRSIG count and pointer fields needed to refer to it.
+    static const size_t MAX_UNSHARED_DATA_LEN = 2 * sizeof(SharedDataPtr);
+
+    // Return whether data_len bytes of encoded data are shared in the
+    // given pool.
+    static bool isSharedData(const RdataPool* rdata_pool, size_t rrsig_count,
+                             size_t data_len)
+    {
+        return (rdata_pool != NULL && rrsig_count < MANY_RRSIG_COUNT &&
+                data_len > MAX_UNSHARED_DATA_LEN);
+    }
+
     // Common code for packing the result in create and subtract.
     static RdataSet* packSet(util::MemorySegment& mem_sgmt,
                              RdataEncoder& encoder, size_t rdata_count,
                              size_t rrsig_count, const dns::RRType& rrtype,
-                             const dns::RRTTL& rrttl);
+                             const dns::RRTTL& rrttl, RdataPool* rdata_pool);
+
+    // Allocate and construct an RdataSet with the room for data_len bytes
+    // of encoded data, which is left uninitialized.  If shared_data is
+    // non NULL, it refers to that data (of data_len bytes) instead.  Used
+    // by packSet and copy.
+    static RdataSet* allocateSet(util::MemorySegment& mem_sgmt,
+                                 size_t rdata_count, size_t rrsig_count,
+                                 const dns::RRType& rrtype,
+                                 const dns::RRTTL& rrttl, size_t data_len,
+                                 const void* shared_data);
 
 public:
     /// \brief Return the bare pointer to the next node.
@@ -428,21 +609,61 @@ private:
     template <typename RetType, typename ThisType>
     static RetType* getDataBuf(ThisType* rdataset) {
         if (rdataset->sig_rdata_count_ < MANY_RRSIG_COUNT) {
-            return (rdataset + 1);
+            return (rdataset->getAdditionalNodeBuf() +
+                    rdataset->getAdditionalNodeCount());
+        } else if (*rdataset->getExtSIGCountBuf() < MANY_RRSIG_COUNT) {
+            return (const_cast<RetType*>(
+                        rdataset->getSharedDataPtr()->get()));
         } else {
             return (rdataset->getExtSIGCountBuf() + 1);
         }
     }
 
+    /// \brief Accessor to the pointer to the shared encoded RDATA.
+    ///
+    /// It follows the RRSIG count field, padded to the size of the
+    /// pointer.  Only valid if \c hasSharedData() is true.
+    const SharedDataPtr* getSharedDataPtr() const {
+        return (reinterpret_cast<const SharedDataPtr*>(
+                    getAdditionalNodeBuf() + getAdditionalNodeCount()) + 1);
+    }
+    SharedDataPtr* getSharedDataPtr() {
+        return (reinterpret_cast<SharedDataPtr*>(
+                    getAdditionalNodeBuf() + getAdditionalNodeCount()) + 1);
+    }
+
     /// \brief Accessor to the memory region for the RRSIG count field for
     /// a large number of RRSIGs.
     ///
     /// These are used only internally and defined as private.
     const uint16_t* getExtSIGCountBuf() const {
-        return (reinterpret_cast<const uint16_t*>(this + 1));
+        return (reinterpret_cast<const uint16_t*>(
+                    getAdditionalNodeBuf() + getAdditionalNodeCount()));
     }
     uint16_t* getExtSIGCountBuf() {
-        return (reinterpret_cast<uint16_t*>(this + 1));
+        return (reinterpret_cast<uint16_t*>(
+                    getAdditionalNodeBuf() + getAdditionalNodeCount()));
+    }
+
+    /// \brief Accessors to the memory region for the additional nodes.
+    ///
+    /// It immediately follows the object, so it's suitably aligned for
+    /// offset pointers as long as the object is.  It's empty unless
+    /// \c hasAdditionalNodes() is true for the type.
+    const AdditionalNodePtr* getAdditionalNodeBuf() const {
+        return (reinterpret_cast<const AdditionalNodePtr*>(this + 1));
+    }
+    AdditionalNodePtr* getAdditionalNodeBuf() {
+        return (reinterpret_cast<AdditionalNodePtr*>(this + 1));
+    }
+    size_t getAdditionalNodeCount() const {
+        return (hasAdditionalNodes(type) ? rdata_count_ : 0);
+    }
+
+    // An additional node that hasn't been set points to the RdataSet itself
+    // (see clearAdditionalNodes()), as NULL means there's no node.
+    bool isUnsetNode(const AdditionalNodePtr& node) const {
+        return (node.get() == reinterpret_cast<const AdditionalNode*>(this));
     }
 
     // Shared by both mutable and immutable versions of find()
@@ -469,7 +690,7 @@ private:
     ///
     /// It never throws an exception.
     RdataSet(dns::RRType type, size_t rdata_count, size_t sig_rdata_count,
-             dns::RRTTL ttl);
+             dns::RRTTL ttl, bool shared_data);
 
     /// \brief The destructor.
     ///
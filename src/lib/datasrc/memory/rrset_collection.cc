@@ -15,6 +15,8 @@
 #include <datasrc/memory/rrset_collection.h>
 #include <datasrc/memory/treenode_rrset.h>
 
+#include <dns/labelsequence.h>
+
 #include <exceptions/exceptions.h>
 
 using namespace bundy;
@@ -52,6 +54,79 @@ RRsetCollection::find(const bundy::dns::Name& name,
     return (ConstRRsetPtr(new TreeNodeRRset(rrclass_, node, rdataset, true)));
 }
 
+const AbstractRRset&
+RRsetCollection::MemIter::getValue() {
+    if (rdataset_ == NULL) {
+        bundy_throw(bundy::InvalidOperation,
+                    "Dereferencing the end of the RRset collection");
+    }
+    if (!rrset_) {
+        rrset_.reset(new TreeNodeRRset(rrclass_, node_, rdataset_, true));
+    }
+    return (*rrset_);
+}
+
+RRsetCollectionBase::IterPtr
+RRsetCollection::MemIter::getNext() {
+    if (rdataset_ == NULL) {
+        return (IterPtr(new MemIter(tree_, rrclass_)));
+    }
+    if (rdataset_->getNext() != NULL) {
+        return (IterPtr(new MemIter(tree_, rrclass_, chain_, node_,
+                                    rdataset_->getNext())));
+    }
+
+    // Move on to the next node that has data.
+    ZoneChain chain(chain_);
+    const ZoneNode* node = tree_.nextNode(chain);
+    while (node != NULL && node->isEmpty()) {
+        node = tree_.nextNode(chain);
+    }
+    if (node == NULL) {
+        return (IterPtr(new MemIter(tree_, rrclass_)));
+    }
+    return (IterPtr(new MemIter(tree_, rrclass_, chain, node,
+                                node->getData())));
+}
+
+bool
+RRsetCollection::MemIter::equals(Iter& other) {
+    const MemIter* other_real = dynamic_cast<MemIter*>(&other);
+    if (other_real == NULL) {
+        return (false);
+    }
+    return (&tree_ == &other_real->tree_ && node_ == other_real->node_ &&
+            rdataset_ == other_real->rdataset_);
+}
+
+RRsetCollectionBase::IterPtr
+RRsetCollection::getBeginning() {
+    const ZoneTree& tree = zone_data_.getZoneTree();
+    uint8_t labels_buf[LabelSequence::MAX_SERIALIZED_LENGTH];
+    const LabelSequence origin =
+        zone_data_.getOriginNode()->getAbsoluteLabels(labels_buf);
+    ZoneChain chain;
+    const ZoneNode* node = NULL;
+    if (tree.find<void*>(origin, &node, chain, NULL, NULL) !=
+        ZoneTree::EXACTMATCH) {
+        bundy_throw(RRsetCollectionError,
+                    "In-memory zone corrupted, missing origin node");
+    }
+    while (node != NULL && node->isEmpty()) {
+        node = tree.nextNode(chain);
+    }
+    if (node == NULL) {
+        return (getEnd());
+    }
+    return (IterPtr(new MemIter(tree, rrclass_, chain, node,
+                                node->getData())));
+}
+
+RRsetCollectionBase::IterPtr
+RRsetCollection::getEnd() {
+    return (IterPtr(new MemIter(zone_data_.getZoneTree(), rrclass_)));
+}
+
 } // end of namespace memory
 } // end of namespace datasrc
 } // end of namespace bundy
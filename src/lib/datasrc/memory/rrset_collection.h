@@ -19,12 +19,20 @@
 #include <dns/rrclass.h>
 
 #include <datasrc/memory/zone_data.h>
+#include <datasrc/memory/treenode_rrset.h>
+
+#include <boost/scoped_ptr.hpp>
 
 namespace bundy {
 namespace datasrc {
 namespace memory {
 
 /// \brief In-memory derivation of \c bundy::dns::RRsetCollectionBase.
+///
+/// The RRsets are found and iterated directly in the \c ZoneData (which
+/// may be in a mapped memory segment), so a loaded zone can be checked
+/// with \c bundy::dns::checkZone() without copying its data.  Each RRset
+/// is returned as a \c TreeNodeRRset referring to the data.
 class RRsetCollection : public bundy::dns::RRsetCollectionBase {
 public:
     /// \brief Constructor.
@@ -61,13 +69,44 @@ public:
                                          const bundy::dns::RRType& rrtype) const;
 
 protected:
-    virtual RRsetCollectionBase::IterPtr getBeginning() {
-        bundy_throw(NotImplemented, "This method is not implemented.");
-    }
+    /// \brief Iterator over the RRsets of the zone tree.
+    ///
+    /// The nodes are visited in DNSSEC order, from the origin, and the
+    /// RRsets of a node in the order they are stored.  The NSEC3 RRsets
+    /// are not included (they can't be found by \c find() either).
+    class MemIter : public RRsetCollectionBase::Iter {
+    public:
+        /// \brief Constructor of the end iterator.
+        MemIter(const ZoneTree& tree, const bundy::dns::RRClass& rrclass) :
+            tree_(tree), rrclass_(rrclass), node_(NULL), rdataset_(NULL)
+        {}
+
+        /// \brief Constructor of an iterator at the given RRset.
+        ///
+        /// \c node is the last node of \c chain, and \c rdataset one of
+        /// its RdataSets.
+        MemIter(const ZoneTree& tree, const bundy::dns::RRClass& rrclass,
+                const ZoneChain& chain, const ZoneNode* node,
+                const RdataSet* rdataset) :
+            tree_(tree), rrclass_(rrclass), chain_(chain), node_(node),
+            rdataset_(rdataset)
+        {}
+
+        virtual const bundy::dns::AbstractRRset& getValue();
+        virtual IterPtr getNext();
+        virtual bool equals(Iter& other);
+
+    private:
+        const ZoneTree& tree_;
+        const bundy::dns::RRClass rrclass_;
+        ZoneChain chain_;
+        const ZoneNode* node_;
+        const RdataSet* rdataset_;
+        boost::scoped_ptr<TreeNodeRRset> rrset_; // created by getValue()
+    };
 
-    virtual RRsetCollectionBase::IterPtr getEnd() {
-        bundy_throw(NotImplemented, "This method is not implemented.");
-    }
+    virtual RRsetCollectionBase::IterPtr getBeginning();
+    virtual RRsetCollectionBase::IterPtr getEnd();
 
 private:
     ZoneData& zone_data_;
@@ -16,6 +16,7 @@
 
 #include <boost/lexical_cast.hpp>
 
+#include <atomic>
 #include <cassert>
 #include <stdint.h>
 
@@ -26,8 +27,9 @@ namespace detail {
 
 std::string
 getNextHolderName() {
-    static uint64_t index = 0;
-    ++index;
+    // Holders can be used in multiple threads (on different segments)
+    static std::atomic<uint64_t> next_index(0);
+    const uint64_t index = ++next_index;
     // in practice we should be able to assume this, uint64 is large
     // and should not overflow
     assert(index != 0);
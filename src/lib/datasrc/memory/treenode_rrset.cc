@@ -29,6 +29,7 @@
 
 #include <boost/bind.hpp>
 
+#include <algorithm>
 #include <cassert>
 #include <string>
 #include <vector>
@@ -100,38 +101,59 @@ TreeNodeRRset::toText() const {
 }
 
 namespace {
-void
-sizeupName(const LabelSequence& name_labels, RdataNameAttributes,
-           size_t* length)
-{
-    *length += name_labels.getDataLength();
-}
+// Actions of the RdataFieldReader to get the length of RDATA.
+struct NameSizer {
+    explicit NameSizer(size_t* length) : length_(length) {}
+    void operator()(const LabelSequence& name_labels,
+                    RdataNameAttributes) const
+    {
+        *length_ += name_labels.getDataLength();
+    }
+    size_t* const length_;
+};
 
-void
-sizeupData(const void*, size_t data_len, size_t* length)
-{
-    *length += data_len;
-}
+struct DataSizer {
+    explicit DataSizer(size_t* length) : length_(length) {}
+    void operator()(const void*, size_t data_len) const {
+        *length_ += data_len;
+    }
+    size_t* const length_;
+};
 
-void
-renderName(const LabelSequence& name_labels, RdataNameAttributes attr,
-           AbstractMessageRenderer* renderer)
-{
-    renderer->writeName(name_labels, (attr & NAMEATTR_COMPRESSIBLE) != 0);
-}
+typedef RdataFieldReader<NameSizer, DataSizer> SizeReader;
 
-void
-renderData(const void* data, size_t data_len,
-           AbstractMessageRenderer* renderer)
-{
-    renderer->writeData(data, data_len);
-}
+// Actions of the RdataFieldReader to render RDATA.
+struct NameRenderer {
+    explicit NameRenderer(AbstractMessageRenderer* renderer) :
+        renderer_(renderer)
+    {}
+    void operator()(const LabelSequence& name_labels,
+                    RdataNameAttributes attr) const
+    {
+        renderer_->writeName(name_labels,
+                             (attr & NAMEATTR_COMPRESSIBLE) != 0);
+    }
+    AbstractMessageRenderer* const renderer_;
+};
+
+struct DataRenderer {
+    explicit DataRenderer(AbstractMessageRenderer* renderer) :
+        renderer_(renderer)
+    {}
+    void operator()(const void* data, size_t data_len) const {
+        renderer_->writeData(data, data_len);
+    }
+    AbstractMessageRenderer* const renderer_;
+};
+
+typedef RdataFieldReader<NameRenderer, DataRenderer> RenderReader;
 
 // Helper for calculating wire data length of a single (etiher main or
 // RRSIG) RRset.
+template <typename Reader>
 uint16_t
 getLengthHelper(size_t* rlength, size_t rr_count, uint16_t name_labels_size,
-                RdataReader& reader, bool (RdataReader::* rdata_iterate_fn)())
+                Reader& reader, bool (Reader::* rdata_iterate_fn)())
 {
     uint16_t length = 0;
 
@@ -156,16 +178,37 @@ getLengthHelper(size_t* rlength, size_t rr_count, uint16_t name_labels_size,
     return (length);
 }
 
+// The smallest possible wire format size of an RR of the given owner name
+// and RDATA length: the owner name is fully compressed (unless it's the
+// root name, which is a single octet), followed by TYPE, CLASS, TTL and
+// RDLENGTH.  If even this doesn't fit in the renderer, rendering the RR
+// and rolling it back would be a waste; we can tell the result beforehand.
+inline size_t
+getMinimumRRLength(const LabelSequence& name_labels, size_t rdata_len) {
+    const size_t name_len =
+        std::min<size_t>(name_labels.getDataLength(), sizeof(uint16_t));
+    return (name_len + sizeof(uint16_t) * 3 + sizeof(uint32_t) + rdata_len);
+}
+
 // Common code logic for rendering a single (either main or RRSIG) RRset.
+template <typename Reader>
 size_t
 writeRRs(AbstractMessageRenderer& renderer, size_t rr_count,
          const LabelSequence& name_labels, const RRType& rrtype,
          const RRClass& rrclass, const void* ttl_data,
-         RdataReader& reader, bool (RdataReader::* rdata_iterate_fn)())
+         Reader& reader, bool (Reader::* rdata_iterate_fn)())
 {
     for (size_t i = 0; i < rr_count; ++i) {
         const size_t pos0 = renderer.getLength();
 
+        // We don't know the RDATA length without rendering it, but we can
+        // still avoid rendering anything if the rest of the RR can't fit.
+        if (pos0 + getMinimumRRLength(name_labels, 0) >
+            renderer.getLengthLimit()) {
+            renderer.setTruncated();
+            return (i);
+        }
+
         // Name, type, class, TTL
         renderer.writeName(name_labels, true);
         rrtype.toWire(renderer);
@@ -189,15 +232,61 @@ writeRRs(AbstractMessageRenderer& renderer, size_t rr_count,
     }
     return (rr_count);
 }
+
+// A shortcut version of writeRRs() for RDATA (or RRSIG) consisting of a
+// single data field.  Its wire format data is retrieved from the reader
+// directly and copied to the renderer at once, without going through the
+// callbacks or updating RDLENGTH after rendering.  As the RDATA length is
+// known before rendering the RR, an RR that can never fit in the renderer
+// is detected without touching the renderer.
+template <typename Reader>
+size_t
+writeSingleFieldRRs(AbstractMessageRenderer& renderer, size_t rr_count,
+                    const LabelSequence& name_labels, const RRType& rrtype,
+                    const RRClass& rrclass, const void* ttl_data,
+                    Reader& reader,
+                    bool (Reader::* data_iterate_fn)(const void**, size_t*))
+{
+    for (size_t i = 0; i < rr_count; ++i) {
+        const size_t pos0 = renderer.getLength();
+
+        const void* data;
+        size_t data_len;
+        const bool rendered = (reader.*data_iterate_fn)(&data, &data_len);
+        assert(rendered == true);
+        if (pos0 + getMinimumRRLength(name_labels, data_len) >
+            renderer.getLengthLimit()) {
+            renderer.setTruncated();
+            return (i);
+        }
+
+        // Name, type, class, TTL
+        renderer.writeName(name_labels, true);
+        rrtype.toWire(renderer);
+        rrclass.toWire(renderer);
+        renderer.writeData(ttl_data, sizeof(uint32_t));
+
+        // RDLEN and RDATA
+        renderer.writeUint16(data_len);
+        renderer.writeData(data, data_len);
+
+        // Check if truncation would happen
+        if (renderer.getLength() > renderer.getLengthLimit()) {
+            renderer.trim(renderer.getLength() - pos0);
+            renderer.setTruncated();
+            return (i);
+        }
+    }
+    return (rr_count);
+}
 }
 
 uint16_t
 TreeNodeRRset::getLength() const {
     size_t rlength = 0;
-    RdataReader reader(rrclass_, rdataset_->type, rdataset_->getDataBuf(),
-                       rdataset_->getRdataCount(), rrsig_count_,
-                       boost::bind(sizeupName, _1, _2, &rlength),
-                       boost::bind(sizeupData, _1, _2, &rlength));
+    SizeReader reader(rrclass_, rdataset_->type, rdataset_->getDataBuf(),
+                      rdataset_->getRdataCount(), rrsig_count_,
+                      NameSizer(&rlength), DataSizer(&rlength));
 
     // Get the owner name of the RRset in the form of LabelSequence.
     uint8_t labels_buf[LabelSequence::MAX_SERIALIZED_LENGTH];
@@ -207,7 +296,7 @@ TreeNodeRRset::getLength() const {
     // Find the length of the main (non RRSIG) RRs
     const uint16_t rrset_length =
         getLengthHelper(&rlength, rdataset_->getRdataCount(), name_labels_size,
-                        reader, &RdataReader::iterateRdata);
+                        reader, &SizeReader::iterateRdata);
 
     rlength = 0;
     const bool rendered = reader.iterateRdata();
@@ -216,7 +305,7 @@ TreeNodeRRset::getLength() const {
     // Find the length of any RRSIGs, if we supposed to do so
     const uint16_t rrsig_length = dnssec_ok_ ?
         getLengthHelper(&rlength, rrsig_count_, name_labels_size,
-                        reader, &RdataReader::iterateSingleSig) : 0;
+                        reader, &SizeReader::iterateSingleSig) : 0;
 
     // the uint16_ts are promoted to ints during addition below, so it
     // won't overflow a 16-bit register.
@@ -226,31 +315,44 @@ TreeNodeRRset::getLength() const {
 
 unsigned int
 TreeNodeRRset::toWire(AbstractMessageRenderer& renderer) const {
-    RdataReader reader(rrclass_, rdataset_->type, rdataset_->getDataBuf(),
-                       rdataset_->getRdataCount(), rrsig_count_,
-                       boost::bind(renderName, _1, _2, &renderer),
-                       boost::bind(renderData, _1, _2, &renderer));
+    RenderReader reader(rrclass_, rdataset_->type, rdataset_->getDataBuf(),
+                        rdataset_->getRdataCount(), rrsig_count_,
+                        NameRenderer(&renderer), DataRenderer(&renderer));
 
     // Get the owner name of the RRset in the form of LabelSequence.
     uint8_t labels_buf[LabelSequence::MAX_SERIALIZED_LENGTH];
     const LabelSequence name_labels = getOwnerLabels(labels_buf);
 
-    // Render the main (non RRSIG) RRs
-    const size_t rendered_rdata_count =
+    // Render the main (non RRSIG) RRs.  Many RR types (A, AAAA, TXT,
+    // DNSKEY, etc) don't contain any domain name in RDATA, which we can
+    // render with the shortcut.
+    const bool single_field = reader.hasSingleDataField();
+    const size_t rendered_rdata_count = single_field ?
+        writeSingleFieldRRs(renderer, rdataset_->getRdataCount(),
+                            name_labels, rdataset_->type, rrclass_,
+                            ttl_data_, reader, &RenderReader::nextRdataData) :
         writeRRs(renderer, rdataset_->getRdataCount(), name_labels,
                  rdataset_->type, rrclass_, ttl_data_, reader,
-                 &RdataReader::iterateRdata);
+                 &RenderReader::iterateRdata);
     if (renderer.isTruncated()) {
         return (rendered_rdata_count);
     }
-    const bool rendered = reader.iterateRdata();
-    assert(rendered == false); // we should've reached the end
+    if (single_field) {
+        const void* data;
+        size_t data_len;
+        const bool rendered = reader.nextRdataData(&data, &data_len);
+        assert(rendered == false); // we should've reached the end
+    } else {
+        const bool rendered = reader.iterateRdata();
+        assert(rendered == false); // we should've reached the end
+    }
 
-    // Render any RRSIGs, if we supposed to do so
+    // Render any RRSIGs, if we supposed to do so.  RRSIGs are always
+    // encoded as single-field data.
     const size_t rendered_rrsig_count = dnssec_ok_ ?
-        writeRRs(renderer, rrsig_count_, name_labels, RRType::RRSIG(),
-                 rrclass_, ttl_data_, reader,
-                 &RdataReader::iterateSingleSig) : 0;
+        writeSingleFieldRRs(renderer, rrsig_count_, name_labels,
+                            RRType::RRSIG(), rrclass_, ttl_data_, reader,
+                            &RenderReader::nextSigData) : 0;
 
     return (rendered_rdata_count + rendered_rrsig_count);
 }
@@ -23,6 +23,8 @@
 #include "rdataset.h"
 #include "rdata_serialization.h"
 #include "zone_data.h"
+#include "zone_name_index.h"
+#include "nsec3_hash_index.h"
 #include "segment_object_holder.h"
 
 #include <boost/bind.hpp>
@@ -47,7 +49,7 @@ const ZoneNode::Flags ZoneData::DNSSEC_SIGNED;
 namespace {
 void
 rdataSetDeleter(RRClass rrclass, util::MemorySegment* mem_sgmt,
-                RdataSet* rdataset_head)
+                RdataPool* rdata_pool, RdataSet* rdataset_head)
 {
     RdataSet* rdataset_next;
     for (RdataSet* rdataset = rdataset_head;
@@ -55,7 +57,7 @@ rdataSetDeleter(RRClass rrclass, util::MemorySegment* mem_sgmt,
          rdataset = rdataset_next)
     {
         rdataset_next = rdataset->getNext();
-        RdataSet::destroy(*mem_sgmt, rdataset, rrclass);
+        RdataSet::destroy(*mem_sgmt, rdataset, rrclass, rdata_pool);
     }
 }
 
@@ -63,6 +65,19 @@ void
 nullDeleter(RdataSet* rdataset_head) {
     assert(rdataset_head == NULL);
 }
+
+// Return the memory allocated for the RdataSets of a node.
+size_t
+rdataSetSize(RRClass rrclass, const RdataSet* rdataset_head) {
+    size_t size = 0;
+    for (const RdataSet* rdataset = rdataset_head;
+         rdataset != NULL;
+         rdataset = rdataset->getNext())
+    {
+        size += rdataset->getAllocatedSize(rrclass);
+    }
+    return (size);
+}
 }
 
 NSEC3Data*
@@ -123,9 +138,12 @@ void
 NSEC3Data::destroy(util::MemorySegment& mem_sgmt, NSEC3Data* data,
                    RRClass nsec3_class)
 {
+    if (data->hash_index_) {
+        NSEC3HashIndex::destroy(mem_sgmt, data->hash_index_.get());
+    }
     ZoneTree::destroy(mem_sgmt, data->nsec3_tree_.get(),
                       boost::bind(rdataSetDeleter, nsec3_class, &mem_sgmt,
-                                  _1));
+                                  static_cast<RdataPool*>(NULL), _1));
     mem_sgmt.deallocate(data, sizeof(NSEC3Data) + 1 + data->getSaltLen());
 }
 
@@ -185,21 +203,25 @@ setTTLInNetOrder(uint32_t val, uint32_t* result) {
 }
 }
 
-ZoneData::ZoneData(ZoneTree* zone_tree, ZoneNode* origin_node) :
+ZoneData::ZoneData(ZoneTree* zone_tree, ZoneNode* origin_node,
+                   bool share_rdata) :
     zone_tree_(zone_tree), origin_node_(origin_node),
-    min_ttl_(0)          // tentatively set to silence static checkers
+    min_ttl_(0),         // tentatively set to silence static checkers
+    additional_linked_(false), share_rdata_(share_rdata)
 {
     setTTLInNetOrder(RRTTL::MAX_TTL().getValue(), &min_ttl_);
 }
 
 ZoneData*
-ZoneData::create(util::MemorySegment& mem_sgmt, const Name& zone_origin) {
+ZoneData::create(util::MemorySegment& mem_sgmt, const Name& zone_origin,
+                 bool share_labels, bool share_rdata)
+{
     // ZoneTree::insert() and ZoneData allocation can throw.  See also
     // NSEC3Data::create().
     typedef boost::function<void(RdataSet*)> RdataSetDeleterType;
     detail::SegmentObjectHolder<ZoneTree, RdataSetDeleterType> holder(
         mem_sgmt, boost::bind(nullDeleter, _1));
-    holder.set(ZoneTree::create(mem_sgmt, true));
+    holder.set(ZoneTree::create(mem_sgmt, true, share_labels));
 
     ZoneTree* tree = holder.get();
     ZoneNode* origin_node = NULL;
@@ -207,7 +229,8 @@ ZoneData::create(util::MemorySegment& mem_sgmt, const Name& zone_origin) {
         tree->insert(mem_sgmt, zone_origin, &origin_node);
     assert(result == ZoneTree::SUCCESS);
     void* p = mem_sgmt.allocate(sizeof(ZoneData));
-    ZoneData* zone_data = new(p) ZoneData(holder.release(), origin_node);
+    ZoneData* zone_data = new(p) ZoneData(holder.release(), origin_node,
+                                          share_rdata);
 
     return (zone_data);
 }
@@ -223,15 +246,44 @@ void
 ZoneData::destroy(util::MemorySegment& mem_sgmt, ZoneData* zone_data,
                   RRClass zone_class)
 {
+    // The index refers to the tree nodes, so destroy it first.
+    if (zone_data->name_index_) {
+        ZoneNameIndex::destroy(mem_sgmt, zone_data->name_index_.get());
+    }
     ZoneTree::destroy(mem_sgmt, zone_data->zone_tree_.get(),
                       boost::bind(rdataSetDeleter, zone_class, &mem_sgmt,
-                                  _1));
+                                  zone_data->getRdataPool(), _1));
     if (zone_data->nsec3_data_) {
         NSEC3Data::destroy(mem_sgmt, zone_data->nsec3_data_.get(), zone_class);
     }
+    zone_data->rdata_pool_.clear(mem_sgmt);
     mem_sgmt.deallocate(zone_data, sizeof(ZoneData));
 }
 
+ZoneData::MemoryUsage
+ZoneData::getMemoryUsage(RRClass zone_class) const {
+    MemoryUsage usage;
+    usage.nodes = zone_tree_->getAllocatedSize(
+        boost::bind(rdataSetSize, zone_class, _1), usage.rdatasets);
+    if (name_index_) {
+        usage.nodes += name_index_->getAllocatedSize();
+    }
+    usage.rdatasets += rdata_pool_.getAllocatedSize();
+    if (nsec3_data_) {
+        size_t rdatasets = 0;
+        usage.nsec3 = sizeof(NSEC3Data) + 1 + nsec3_data_->getSaltLen() +
+            nsec3_data_->getNSEC3Tree().getAllocatedSize(
+                boost::bind(rdataSetSize, zone_class, _1), rdatasets) +
+            rdatasets;
+        if (nsec3_data_->getHashIndex()) {
+            usage.nsec3 += nsec3_data_->getHashIndex()->getAllocatedSize();
+        }
+    }
+    usage.total = sizeof(ZoneData) + usage.nodes + usage.rdatasets +
+        usage.nsec3;
+    return (usage);
+}
+
 void
 ZoneData::insertName(util::MemorySegment& mem_sgmt, const Name& name,
                      ZoneNode** node)
@@ -243,6 +295,19 @@ ZoneData::insertName(util::MemorySegment& mem_sgmt, const Name& name,
             result == ZoneTree::ALREADYEXISTS) && node != NULL);
 }
 
+bool
+ZoneData::appendName(util::MemorySegment& mem_sgmt, const Name& name,
+                     ZoneNode** node)
+{
+    const ZoneTree::Result result = zone_tree_->append(mem_sgmt, name, node);
+    return (result != ZoneTree::NOTFOUND);
+}
+
+void
+ZoneData::finishAppend() {
+    zone_tree_->finishAppend();
+}
+
 ZoneNode*
 ZoneData::findName(const Name& name) {
     ZoneNode* node = NULL;
@@ -268,6 +333,22 @@ ZoneData::removeNode(util::MemorySegment& mem_sgmt, ZoneNode* node) {
     zone_tree_->remove(mem_sgmt, node, nullDeleter);
 }
 
+ZoneNode*
+ZoneData::relocateNode(util::MemorySegment& mem_sgmt, ZoneNode* node) {
+    // The origin node is referred to by this object, and it's allocated
+    // first on creation anyway.
+    if (node == getOriginNode()) {
+        return (node);
+    }
+    return (zone_tree_->relocate(mem_sgmt, node));
+}
+
+void
+ZoneData::destroyRelocatedNode(util::MemorySegment& mem_sgmt, ZoneNode* node)
+{
+    zone_tree_->destroyRelocated(mem_sgmt, node);
+}
+
 void
 ZoneData::setMinTTL(uint32_t min_ttl_val) {
     setTTLInNetOrder(min_ttl_val, &min_ttl_);
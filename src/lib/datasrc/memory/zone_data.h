@@ -21,6 +21,7 @@
 #include <dns/rrclass.h>
 
 #include <datasrc/memory/domaintree.h>
+#include <datasrc/memory/rdata_pool.h>
 #include <datasrc/memory/rdataset.h>
 
 #include <boost/interprocess/offset_ptr.hpp>
@@ -45,6 +46,9 @@ typedef DomainTree<RdataSet> ZoneTree;
 typedef DomainTreeNode<RdataSet> ZoneNode;
 typedef DomainTreeNodeChain<RdataSet> ZoneChain;
 
+class ZoneNameIndex;
+class NSEC3HashIndex;
+
 /// \brief NSEC3 data for a DNS zone.
 ///
 /// This class encapsulates a set of NSEC3 related data for a zone
@@ -172,6 +176,8 @@ private:
     // Domain tree for the Internal NSEC3 name space.  Access to it is
     // limited only via public methods.
     const boost::interprocess::offset_ptr<ZoneTree> nsec3_tree_;
+    // The sorted hash index of the tree, if any.
+    boost::interprocess::offset_ptr<NSEC3HashIndex> hash_index_;
 public:
     const uint8_t hashalg;      ///< Hash algorithm
     const uint8_t flags;        ///< NSEC3 parameter flags
@@ -185,6 +191,34 @@ public:
     /// \throw none
     const ZoneTree& getNSEC3Tree() const { return (*nsec3_tree_); }
 
+    /// \brief Return the hash index of the NSEC3 tree.
+    ///
+    /// This method returns non-NULL valid pointer to \c NSEC3HashIndex
+    /// object associated to the \c NSEC3Data if it was set by
+    /// \c setHashIndex(); otherwise it returns NULL.
+    ///
+    /// \throw none
+    const NSEC3HashIndex* getHashIndex() const { return (hash_index_.get()); }
+
+    /// \brief Associate \c NSEC3HashIndex to the NSEC3 tree.
+    ///
+    /// This works like \c ZoneData::setNameIndex() for the NSEC3 tree: the
+    /// index is assumed to be allocated in the same \c MemorySegment so
+    /// \c destroy() can destroy both, and the caller is responsible for
+    /// removing it before adding or removing NSEC3 owner names.
+    ///
+    /// \throw none
+    ///
+    /// \param hash_index A pointer to \c NSEC3HashIndex object to be
+    /// associated.  Can be NULL.
+    /// \return Previously associated \c NSEC3HashIndex object.  This can be
+    /// NULL.
+    NSEC3HashIndex* setHashIndex(NSEC3HashIndex* hash_index) {
+        NSEC3HashIndex* old = hash_index_.get();
+        hash_index_ = hash_index;
+        return (old);
+    }
+
     /// \brief Return the size of NSEC3 salt.
     ///
     /// \throw none
@@ -251,7 +285,8 @@ private:
     /// It never throws an exception.
     NSEC3Data(ZoneTree* nsec3_tree_param, uint8_t hashalg_param,
               uint8_t flags_param, uint16_t iterations_param) :
-        nsec3_tree_(nsec3_tree_param), hashalg(hashalg_param),
+        nsec3_tree_(nsec3_tree_param), hash_index_(NULL),
+        hashalg(hashalg_param),
         flags(flags_param), iterations(iterations_param)
     {}
 
@@ -398,7 +433,7 @@ private:
     /// allocator (\c create()), so the constructor is hidden as private.
     ///
     /// It never throws an exception.
-    ZoneData(ZoneTree* zone_tree, ZoneNode* origin_node);
+    ZoneData(ZoneTree* zone_tree, ZoneNode* origin_node, bool share_rdata);
 
     // Zone node flags.  When adding a new flag, it's generally advisable to
     // keep existing values so the binary image of the data is as much
@@ -439,8 +474,14 @@ public:
     /// \param mem_sgmt A \c MemorySegment from which memory for the new
     /// \c ZoneData is allocated.
     /// \param zone_origin The zone origin.
+    /// \param share_labels Whether the nodes of the zone tree share
+    /// identical labels (see \c DomainTree::create()).
+    /// \param share_rdata Whether the \c RdataSets of the zone share
+    /// identical encoded RDATA (see \c getRdataPool()).
     static ZoneData* create(util::MemorySegment& mem_sgmt,
-                            const dns::Name& zone_origin);
+                            const dns::Name& zone_origin,
+                            bool share_labels = false,
+                            bool share_rdata = false);
 
     /// \brief Allocate and construct a special "empty" \c ZoneData.
     ///
@@ -539,6 +580,17 @@ public:
     /// \throw None
     bool isEmpty() const { return (origin_node_->getFlag(EMPTY_ZONE)); }
 
+    /// \brief Return whether the additional nodes of the \c RdataSets of
+    /// the zone can be used.
+    ///
+    /// This method simply returns the last value set by
+    /// \c setAdditionalLinked() (or the default, which is \c false).  If
+    /// it's false, the additional nodes must be ignored even if they are
+    /// set (see \c RdataSet::setAdditionalNode()).
+    ///
+    /// \throw none
+    bool isAdditionalLinked() const { return (additional_linked_); }
+
     /// \brief Return NSEC3Data of the zone.
     ///
     /// This method returns non-NULL valid pointer to \c NSEC3Data object
@@ -548,6 +600,47 @@ public:
     /// \throw none
     const NSEC3Data* getNSEC3Data() const { return (nsec3_data_.get()); }
 
+    /// \brief Return the pool of the encoded RDATA shared by the
+    /// \c RdataSets of the zone.
+    ///
+    /// It's non NULL iff the zone data was created with \c share_rdata
+    /// (see \c create()).  The \c RdataSets in the zone tree must then
+    /// be created and destroyed with this pool; those of the \c NSEC3Data
+    /// never share their data (and use no pool), as NSEC3 RDATA is unique
+    /// to each name anyway.
+    ///
+    /// \throw none
+    const RdataPool* getRdataPool() const {
+        return (share_rdata_ ? &rdata_pool_ : NULL);
+    }
+
+    /// \brief The memory allocated for a zone, in bytes.
+    ///
+    /// \see getMemoryUsage()
+    struct MemoryUsage {
+        MemoryUsage() : nodes(0), rdatasets(0), nsec3(0), total(0) {}
+
+        /// The zone tree: its nodes, their labels and the name index.
+        size_t nodes;
+        /// The \c RdataSets of the zone tree, with the shared RDATA.
+        size_t rdatasets;
+        /// The \c NSEC3Data: its tree, nodes and \c RdataSets.
+        size_t nsec3;
+        /// All of the above and the \c ZoneData object itself.
+        size_t total;
+    };
+
+    /// \brief Return the memory allocated for the zone.
+    ///
+    /// The usage is computed by walking all the trees of the zone, so it
+    /// takes time proportional to the size of the zone; it's meant for
+    /// occasional reporting, not to be called for every query.
+    ///
+    /// \throw none
+    ///
+    /// \param zone_class The RR class of the zone, as for \c destroy().
+    MemoryUsage getMemoryUsage(dns::RRClass zone_class) const;
+
     /// \brief Return a pointer to the zone's minimum TTL data.
     ///
     /// The returned pointer points to a memory region that is valid at least
@@ -567,6 +660,24 @@ public:
     ///
     /// \throw none
     const void* getMinTTLData() const { return (&min_ttl_); }
+
+    /// \brief Return the exact-match name index of the zone.
+    ///
+    /// This method returns non-NULL valid pointer to \c ZoneNameIndex
+    /// object associated to the \c ZoneData if it was set by
+    /// \c setNameIndex(); otherwise it returns NULL.
+    ///
+    /// \throw none
+    const ZoneNameIndex* getNameIndex() const { return (name_index_.get()); }
+
+    /// \brief Return the exact-match name index of the zone (mutable
+    /// version).
+    ///
+    /// This is intended to be used by \c ZoneDataUpdater to keep the index
+    /// consistent on modifications of the zone.
+    ///
+    /// \throw none
+    ZoneNameIndex* getNameIndex() { return (name_index_.get()); }
     //@}
 
     ///
@@ -612,6 +723,36 @@ public:
     void insertName(util::MemorySegment& mem_sgmt, const dns::Name& name,
                     ZoneNode** node);
 
+    /// \brief Append a name to the zone in the DNSSEC order.
+    ///
+    /// This is a faster variant of \c insertName() for names that are
+    /// given in the DNSSEC order: see \c DomainTree::append().  If the name
+    /// already exists, \c node is set to the existing node as in
+    /// \c insertName(); if it precedes the largest name added so far, this
+    /// method returns \c false without modifying the zone, and the caller
+    /// is expected to call \c finishAppend() and then \c insertName().
+    ///
+    /// \throw std::bad_alloc Memory allocation fails
+    ///
+    /// \param mem_sgmt Memory segment in which resource for the new memory
+    /// is to be allocated.
+    /// \param name The name to be appended.
+    /// \param node A pointer to \c ZoneNode pointer in which the created or
+    /// found node for the name is stored.  Must not be NULL.
+    /// \return \c true if \c node is set; \c false if the name is out of
+    /// order.
+    bool appendName(util::MemorySegment& mem_sgmt, const dns::Name& name,
+                    ZoneNode** node);
+
+    /// \brief Balance the zone tree after appending names.
+    ///
+    /// This must be called after a series of \c appendName() calls, before
+    /// any other modification of the zone tree.  See
+    /// \c DomainTree::finishAppend().
+    ///
+    /// \throw none
+    void finishAppend();
+
     /// \brief Find an internal zone node for the given name for update.
     ///
     /// This is similar to \c insertName(), but does not create a new node
@@ -639,6 +780,29 @@ public:
     /// \param node The node to be removed.
     void removeNode(util::MemorySegment& mem_sgmt, ZoneNode* node);
 
+    /// \brief Move a node of the zone to newly allocated memory.
+    ///
+    /// See \c DomainTree::relocate().  The origin node is never moved; it's
+    /// returned as it is.  Otherwise the returned node replaces \c node,
+    /// which must be destroyed with \c destroyRelocatedNode().
+    ///
+    /// \throw util::MemorySegmentGrown The memory segment has grown.  The
+    ///     zone is not modified in this case.
+    /// \throw std::bad_alloc Memory allocation fails
+    ///
+    /// \param mem_sgmt Memory segment in which node was allocated.
+    /// \param node The node to be moved.
+    /// \return The node that replaces \c node.
+    ZoneNode* relocateNode(util::MemorySegment& mem_sgmt, ZoneNode* node);
+
+    /// \brief Destroy a node replaced by \c relocateNode().
+    ///
+    /// \throw none
+    ///
+    /// \param mem_sgmt Memory segment in which node was allocated.
+    /// \param node The node given to \c relocateNode().
+    void destroyRelocatedNode(util::MemorySegment& mem_sgmt, ZoneNode* node);
+
     /// \brief Specify whether or not the zone is signed in terms of DNSSEC.
     ///
     /// The zone will be considered "signed" (in that subsequent calls to
@@ -655,6 +819,19 @@ public:
         origin_node_->setFlag(DNSSEC_SIGNED, on);
     }
 
+    /// \brief Specify whether the additional nodes of the \c RdataSets of
+    /// the zone can be used.
+    ///
+    /// The caller (normally \c ZoneDataUpdater) must set it to \c true
+    /// only after setting the additional nodes of all the \c RdataSets for
+    /// the current content of the zone, and set it to \c false before any
+    /// modification of the zone, as the nodes may become invalid.
+    ///
+    /// \throw none
+    void setAdditionalLinked(bool on) {
+        additional_linked_ = on;
+    }
+
     /// \brief Return NSEC3Data of the zone, non-const version.
     ///
     /// This is similar to the const version, but return a non-const pointer
@@ -663,6 +840,12 @@ public:
     /// \throw none
     NSEC3Data* getNSEC3Data() { return (nsec3_data_.get()); }
 
+    /// \brief Return the pool of the shared encoded RDATA of the zone,
+    /// non-const version.
+    ///
+    /// \throw none
+    RdataPool* getRdataPool() { return (share_rdata_ ? &rdata_pool_ : NULL); }
+
     /// \brief Associate \c NSEC3Data to the zone.
     ///
     /// This method associates the given \c NSEC3Data object with the zone
@@ -691,6 +874,31 @@ public:
         return (old);
     }
 
+    /// \brief Associate \c ZoneNameIndex to the zone.
+    ///
+    /// This method associates the given \c ZoneNameIndex object with the
+    /// zone data, and returns the previously associated one (which can be
+    /// NULL).  \c name_index can be NULL, in which case the zone will be
+    /// disassociated with an index.
+    ///
+    /// Like \c setNSEC3Data(), a non-NULL \c name_index is assumed to be
+    /// allocated in the same \c MemorySegment as that for the zone data
+    /// so \c destroy() can destroy both.  The index must have been built
+    /// for the zone tree of this zone data, and the caller is responsible
+    /// for removing it before modifying the tree.
+    ///
+    /// \throw none
+    ///
+    /// \param name_index A pointer to \c ZoneNameIndex object to be
+    /// associated with the zone.  Can be NULL.
+    /// \return Previously associated \c ZoneNameIndex object in the zone.
+    /// This can be NULL.
+    ZoneNameIndex* setNameIndex(ZoneNameIndex* name_index) {
+        ZoneNameIndex* old = name_index_.get();
+        name_index_ = name_index;
+        return (old);
+    }
+
     /// \brief Set the zone's "minimum" TTL.
     ///
     /// This method updates the recorded minimum TTL of the zone data.
@@ -715,7 +923,11 @@ private:
     const boost::interprocess::offset_ptr<ZoneTree> zone_tree_;
     const boost::interprocess::offset_ptr<ZoneNode> origin_node_;
     boost::interprocess::offset_ptr<NSEC3Data> nsec3_data_;
+    boost::interprocess::offset_ptr<ZoneNameIndex> name_index_;
+    RdataPool rdata_pool_;
     uint32_t min_ttl_;
+    bool additional_linked_;
+    const bool share_rdata_;
 };
 
 } // namespace memory
@@ -15,6 +15,7 @@
 #include <datasrc/master_loader_callbacks.h>
 #include <datasrc/memory/zone_data_loader.h>
 #include <datasrc/memory/zone_data_updater.h>
+#include <datasrc/memory/zone_node_sampler.h>
 #include <datasrc/memory/logger.h>
 #include <datasrc/memory/segment_object_holder.h>
 #include <datasrc/memory/util_internal.h>
@@ -34,6 +35,7 @@
 #include <boost/optional.hpp>
 #include <boost/noncopyable.hpp>
 
+#include <fstream>
 #include <map>
 
 using namespace bundy::dns;
@@ -67,6 +69,10 @@ namespace { // unnamed namespace
 // do it, but since we cannot guarantee the adding/removing operation is
 // exception free, we don't choose that option to maintain the common
 // expectation for destructors.
+//
+// If encode_threads is non 0, the pairs to add are collected and given to
+// ZoneDataUpdater::addBatch() in batches of BATCH_SIZE pairs; the caller
+// must then call flushBatch() after flushNodeRRsets() at the end.
 class ZoneDataUpdaterHelper : boost::noncopyable {
 public:
     enum OP_MODE {ADD, DELETE};
@@ -78,12 +84,22 @@ public:
     ZoneDataUpdaterHelper(util::MemorySegment& mem_sgmt,
                          const bundy::dns::RRClass& rrclass,
                          const bundy::dns::Name& zone_name,
-                         ZoneData& zone_data) :
-        updater_(mem_sgmt, rrclass, zone_name, zone_data)
+                         ZoneData& zone_data, size_t encode_threads) :
+        updater_(mem_sgmt, rrclass, zone_name, zone_data),
+        encode_threads_(encode_threads)
     {}
 
     void updateFromLoad(const bundy::dns::ConstRRsetPtr& rrset, OP_MODE mode);
     void flushNodeRRsets();
+    void flushBatch();
+    void buildNameIndex() { updater_.buildNameIndex(); }
+    void buildNSEC3Index() { updater_.buildNSEC3Index(); }
+    void setAdditionalNodes() { updater_.setAdditionalNodes(); }
+    void startAppend() { updater_.startAppend(); }
+    void finishAppend() { updater_.finishAppend(); }
+    size_t relayout(const std::vector<bundy::dns::Name>& names) {
+        return (updater_.relayout(names));
+    }
 
 private:
     typedef std::map<bundy::dns::RRType, bundy::dns::ConstRRsetPtr> NodeRRsets;
@@ -92,12 +108,26 @@ private:
     // A helper to identify the covered type of an RRSIG.
     const bundy::dns::Name& getCurrentName() const;
 
+    void addToBatch(const bundy::dns::ConstRRsetPtr& rrset,
+                    const bundy::dns::ConstRRsetPtr& sig_rrset)
+    {
+        batch_.push_back(ZoneDataUpdater::RRsetPairs::value_type(rrset,
+                                                                 sig_rrset));
+    }
+
+    // The number of pairs of RRsets given to addBatch() at once; large
+    // enough to keep the encoding threads busy, small enough to keep the
+    // memory for the encoded data moderate.
+    static const size_t BATCH_SIZE = 1024;
+
 private:
     NodeRRsets node_rrsets_;
     NodeRRsets node_rrsigsets_;
     std::vector<bundy::dns::ConstRRsetPtr> non_consecutive_rrsets_;
     ZoneDataUpdater updater_;
     boost::optional<OP_MODE> current_mode_;
+    const size_t encode_threads_;
+    ZoneDataUpdater::RRsetPairs batch_;
 };
 
 void
@@ -107,6 +137,7 @@ ZoneDataUpdaterHelper::updateFromLoad(const ConstRRsetPtr& rrset, OP_MODE mode)
     // changes in the previous mode.
     if (current_mode_ && *current_mode_ != mode) {
         flushNodeRRsets();
+        flushBatch();
     }
     current_mode_ = mode;
 
@@ -140,10 +171,14 @@ ZoneDataUpdaterHelper::flushNodeRRsets() {
         return;
     }
 
-    boost::function<void(const ConstRRsetPtr&, const ConstRRsetPtr&)> op =
-        (*current_mode_ == ADD) ?
-        boost::bind(&ZoneDataUpdater::add, &updater_, _1, _2) :
-        boost::bind(&ZoneDataUpdater::remove, &updater_, _1, _2);
+    boost::function<void(const ConstRRsetPtr&, const ConstRRsetPtr&)> op;
+    if (*current_mode_ == DELETE) {
+        op = boost::bind(&ZoneDataUpdater::remove, &updater_, _1, _2);
+    } else if (encode_threads_ == 0) {
+        op = boost::bind(&ZoneDataUpdater::add, &updater_, _1, _2);
+    } else {
+        op = boost::bind(&ZoneDataUpdaterHelper::addToBatch, this, _1, _2);
+    }
 
     BOOST_FOREACH(NodeRRsetsVal val, node_rrsets_) {
         // Identify the corresponding RRSIG for the RRset, if any.  If
@@ -176,6 +211,18 @@ ZoneDataUpdaterHelper::flushNodeRRsets() {
     node_rrsets_.clear();
     node_rrsigsets_.clear();
     non_consecutive_rrsets_.clear();
+
+    if (batch_.size() >= BATCH_SIZE) {
+        flushBatch();
+    }
+}
+
+void
+ZoneDataUpdaterHelper::flushBatch() {
+    if (!batch_.empty()) {
+        updater_.addBatch(batch_, encode_threads_);
+        batch_.clear();
+    }
 }
 
 const Name&
@@ -279,11 +326,32 @@ public:
         mem_sgmt_(mem_sgmt), rrclass_(rrclass), zone_name_(zone_name),
         old_data_(old_data),
         old_serial_(old_serial ? new dns::Serial(*old_serial) : NULL),
-        loaded_data_(NULL)
+        loaded_data_(NULL), build_name_index_(false), share_labels_(false),
+        encode_threads_(0), share_rdata_(false)
     {
         validateOldData(zone_name, old_data);
     }
 
+    void setBuildNameIndex(bool on) {
+        build_name_index_ = on;
+    }
+
+    void setShareLabels(bool on) {
+        share_labels_ = on;
+    }
+
+    void setEncodeThreads(size_t count) {
+        encode_threads_ = count;
+    }
+
+    void setShareRdata(bool on) {
+        share_rdata_ = on;
+    }
+
+    void setHotNamesFile(const std::string& hot_names_file) {
+        hot_names_file_ = hot_names_file;
+    }
+
     virtual bool doLoad(size_t count_limit) {
         initUpdate(NULL);
         const bool completed = doLoadCommon(count_limit);
@@ -305,6 +373,7 @@ public:
 
 protected:
     bool doLoadCommon(size_t count_limit);
+    void relayoutHotNames();
 
     virtual void initUpdate(ZoneData* const zone_data) {
         if (data_holder_) {
@@ -318,7 +387,9 @@ protected:
                 if (zone_data) {
                     holder->set(zone_data);
                 } else {
-                    holder->set(ZoneData::create(mem_sgmt_, zone_name_));
+                    holder->set(ZoneData::create(mem_sgmt_, zone_name_,
+                                                 share_labels_,
+                                                 share_rdata_));
                 }
                 data_holder_.swap(holder);
                 break;
@@ -334,7 +405,14 @@ protected:
         }
         update_helper_.reset(new ZoneDataUpdaterHelper(mem_sgmt_, rrclass_,
                                                        zone_name_,
-                                                       *data_holder_->get()));
+                                                       *data_holder_->get(),
+                                                       encode_threads_));
+        // Loading new data from a sorted source (e.g., another data source
+        // or a canonicalized zone file) can append the names; otherwise the
+        // updater falls back to insertion at the first name out of order.
+        if (!zone_data) {
+            update_helper_->startAppend();
+        }
     }
 
     void finishUpdate();
@@ -350,8 +428,37 @@ protected:
     boost::scoped_ptr<SegmentObjectHolder<ZoneData, RRClass> > data_holder_;
     boost::scoped_ptr<ZoneDataUpdaterHelper> update_helper_;
     ZoneData* loaded_data_;
+    bool build_name_index_;
+    bool share_labels_;
+    size_t encode_threads_;
+    bool share_rdata_;
+    std::string hot_names_file_;
 };
 
+void
+ZoneDataLoader::ZoneDataLoaderImpl::relayoutHotNames() {
+    // The names are only a hint for the layout, so any problem with the
+    // file is logged and the zone is loaded as it is.
+    std::ifstream ifs(hot_names_file_.c_str());
+    if (!ifs) {
+        LOG_WARN(logger, DATASRC_MEMORY_MEM_HOT_NAMES_FAIL).
+            arg(zone_name_).arg(rrclass_).arg(hot_names_file_).
+            arg("cannot open file");
+        return;
+    }
+    std::vector<dns::Name> names;
+    try {
+        names = ZoneNodeSampler::readHotNames(ifs, zone_name_);
+    } catch (const bundy::Exception& ex) {
+        LOG_WARN(logger, DATASRC_MEMORY_MEM_HOT_NAMES_FAIL).
+            arg(zone_name_).arg(rrclass_).arg(hot_names_file_).arg(ex.what());
+        return;
+    }
+    if (!names.empty()) {
+        update_helper_->relayout(names);
+    }
+}
+
 void
 ZoneDataLoader::ZoneDataLoaderImpl::finishUpdate() {
     const ZoneNode* origin_node = data_holder_->get()->getOriginNode();
@@ -412,7 +519,25 @@ ZoneDataLoader::ZoneDataLoaderImpl::doLoadCommon(const size_t count_limit) {
         } while (!completed && count_limit == 0);
         // Add any last RRsets that were left
         update_helper_->flushNodeRRsets();
+        update_helper_->flushBatch();
         if (completed) {
+            update_helper_->finishAppend();
+            // Pack the frequently queried names before anything refers to
+            // their nodes.
+            if (!hot_names_file_.empty()) {
+                relayoutHotNames();
+            }
+            // An index of reused zone data is kept up to date by the
+            // updater unless it had to be dropped.
+            if (build_name_index_ && !data_holder_->get()->getNameIndex()) {
+                update_helper_->buildNameIndex();
+            }
+            // The NSEC3 index is small, so it's always built (unless it
+            // was kept by the updater).
+            update_helper_->buildNSEC3Index();
+            // The additional nodes depend on the entire zone, so they are
+            // always set again.
+            update_helper_->setAdditionalNodes();
             // we're done with the updater.  Release internal resources sooner.
             update_helper_.reset();
         }
@@ -676,7 +801,10 @@ ZoneDataLoader::ZoneDataLoader(util::MemorySegment& mem_sgmt,
                                const dns::RRClass& rrclass,
                                const dns::Name& zone_name,
                                const std::string& zone_file,
-                               ZoneData* old_data) :
+                               ZoneData* old_data, bool build_name_index,
+                               bool share_labels, size_t encode_threads,
+                               bool share_rdata,
+                               const std::string& hot_names_file) :
     impl_(NULL)                 // defer until logging to avoid leak
 {
     LOG_DEBUG(logger, DBG_TRACE_BASIC, DATASRC_MEMORY_MEM_LOAD_FROM_FILE).
@@ -684,13 +812,21 @@ ZoneDataLoader::ZoneDataLoader(util::MemorySegment& mem_sgmt,
 
     impl_ = new MasterFileLoader(mem_sgmt, rrclass, zone_name, zone_file,
                                  old_data);
+    impl_->setBuildNameIndex(build_name_index);
+    impl_->setShareLabels(share_labels);
+    impl_->setEncodeThreads(encode_threads);
+    impl_->setShareRdata(share_rdata);
+    impl_->setHotNamesFile(hot_names_file);
 }
 
 ZoneDataLoader::ZoneDataLoader(util::MemorySegment& mem_sgmt,
                                const dns::RRClass& rrclass,
                                const dns::Name& zone_name,
                                const DataSourceClient& datasrc_client,
-                               ZoneData* old_data) :
+                               ZoneData* old_data, bool build_name_index,
+                               bool share_labels, size_t encode_threads,
+                               bool share_rdata,
+                               const std::string& hot_names_file) :
     impl_(NULL)
 {
     const std::string& dsrc_name = datasrc_client.getDataSourceName();
@@ -717,7 +853,9 @@ ZoneDataLoader::ZoneDataLoader(util::MemorySegment& mem_sgmt,
         getSerialFromZoneData(rrclass, old_data));
     const boost::scoped_ptr<const dns::Serial> new_serial(
         getSerialFromRRset(*new_soarrset));
-    if (old_serial && (*old_serial == *new_serial)) {
+    // With the frequently queried names given, the same zone is loaded
+    // again to pack their nodes, rather than reused.
+    if (old_serial && (*old_serial == *new_serial) && hot_names_file.empty()) {
         impl_ = new ReuseLoader(mem_sgmt, rrclass, zone_name, old_data,
                                 *old_serial, dsrc_name);
         return;
@@ -731,6 +869,7 @@ ZoneDataLoader::ZoneDataLoader(util::MemorySegment& mem_sgmt,
                                           old_data, *old_serial,
                                           *new_serial, result.second,
                                           dsrc_name);
+                impl_->setBuildNameIndex(build_name_index);
                 return;
             }
         } catch (const bundy::NotImplemented&) {
@@ -738,8 +877,17 @@ ZoneDataLoader::ZoneDataLoader(util::MemorySegment& mem_sgmt,
             // serials.
         }
     }
+    // Reloading the same serial for the relayout isn't worth the warning
+    // about the serial not increased.
+    const bool same_serial = old_serial && (*old_serial == *new_serial);
     impl_ = new IteratorLoader(mem_sgmt, rrclass, zone_name, iterator,
-                               old_data, old_serial.get());
+                               old_data,
+                               same_serial ? NULL : old_serial.get());
+    impl_->setBuildNameIndex(build_name_index);
+    impl_->setShareLabels(share_labels);
+    impl_->setEncodeThreads(encode_threads);
+    impl_->setShareRdata(share_rdata);
+    impl_->setHotNamesFile(hot_names_file);
 }
 
 ZoneDataLoader::~ZoneDataLoader() {
@@ -58,11 +58,30 @@ public:
     /// \param zone_file Filename which contains the zone data for \c zone_name.
     /// \param old_data If non-NULL, zone data currently being used.  Also
     /// in that case, its origin name must be equal to \c zone_name.
+    /// \param build_name_index If true, build the exact-match name index
+    /// (see \c ZoneNameIndex) of the loaded zone data.
+    /// \param share_labels If true, newly created zone data share
+    /// identical labels in the zone tree (see \c ZoneData::create()).
+    /// \param encode_threads If non 0, the number of worker threads
+    /// encoding the RDATA of the loaded RRsets (see
+    /// \c ZoneDataUpdater::addBatch()).
+    /// \param share_rdata If true, the \c RdataSets of newly created zone
+    /// data share identical encoded RDATA (see \c ZoneData::create()).
+    /// \param hot_names_file If not empty, a file of frequently queried
+    /// names written by \c ZoneNodeSampler::writeHotNames().  The nodes of
+    /// the names of the zone are packed together in newly created zone
+    /// data (see \c ZoneDataUpdater::relayout()).  If the file can't be
+    /// read, the zone is loaded without it.
     ZoneDataLoader(util::MemorySegment& mem_sgmt,
                    const dns::RRClass& rrclass,
                    const dns::Name& zone_name,
                    const std::string& zone_file,
-                   ZoneData* old_data = NULL);
+                   ZoneData* old_data = NULL,
+                   bool build_name_index = false,
+                   bool share_labels = false,
+                   size_t encode_threads = 0,
+                   bool share_rdata = false,
+                   const std::string& hot_names_file = "");
 
     /// \brief Constructor for loading from a given data source.
     ///
@@ -73,11 +92,25 @@ public:
     ///
     /// \param datasrc_client A client for the data source from which new
     /// zone data should be loaded.
+    ///
+    /// Note that if \c old_data can be reused without any change (i.e., the
+    /// SOA serial is the same), it's used as it is regardless of the
+    /// \c build_name_index, \c share_labels, \c encode_threads,
+    /// \c share_rdata and \c hot_names_file parameters.  All but the first
+    /// don't matter either when \c old_data is updated with the journal.
+    /// As an exception, if \c hot_names_file is not empty, \c old_data
+    /// with the same SOA serial is not reused but loaded again, so the
+    /// names in the file are packed.
     ZoneDataLoader(util::MemorySegment& mem_sgmt,
                    const dns::RRClass& rrclass,
                    const dns::Name& zone_name,
                    const DataSourceClient& datasrc_client,
-                   ZoneData* old_data = NULL);
+                   ZoneData* old_data = NULL,
+                   bool build_name_index = false,
+                   bool share_labels = false,
+                   size_t encode_threads = 0,
+                   bool share_rdata = false,
+                   const std::string& hot_names_file = "");
 
     /// Destructor.
     virtual ~ZoneDataLoader();
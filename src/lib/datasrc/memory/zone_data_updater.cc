@@ -15,17 +15,34 @@
 #include <exceptions/exceptions.h>
 
 #include <datasrc/memory/zone_data_updater.h>
+#include <datasrc/memory/zone_finder.h>
+#include <datasrc/memory/zone_name_index.h>
+#include <datasrc/memory/nsec3_hash_index.h>
 #include <datasrc/memory/logger.h>
 #include <datasrc/memory/util_internal.h>
 #include <datasrc/zone.h>
 
 #include <dns/rdataclass.h>
 
+#include <util/memory_segment_local.h>
+#include <util/threads/sync.h>
+#include <util/threads/thread.h>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
 #include <cassert>
 #include <string>
+#include <vector>
 
 using namespace bundy::dns;
 using namespace bundy::dns::rdata;
+using bundy::util::MemorySegmentLocal;
+using bundy::util::thread::CondVar;
+using bundy::util::thread::Mutex;
+using bundy::util::thread::Thread;
 
 namespace bundy {
 namespace datasrc {
@@ -49,14 +66,14 @@ ZoneDataUpdater::addWildcards(const Name& name) {
             // Ensure a separate level exists for the "wildcarding"
             // name, and mark the node as "wild".
             ZoneNode* node;
-            zone_data_->insertName(mem_sgmt_, wname.split(1), &node);
+            insertName(wname.split(1), &node);
             node->setFlag(ZoneData::WILDCARD_NODE);
 
             // Ensure a separate level exists for the wildcard name.
             // Note: for 'name' itself we do this later anyway, but the
             // overhead should be marginal because wildcard names should
             // be rare.
-            zone_data_->insertName(mem_sgmt_, wname, &node);
+            insertName(wname, &node);
         }
     }
 }
@@ -248,7 +265,8 @@ ZoneDataUpdater::setupNSEC3(const ConstRRsetPtr rrset) {
 
 void
 ZoneDataUpdater::addNSEC3(const Name& name, const ConstRRsetPtr& rrset,
-                          const ConstRRsetPtr& rrsig)
+                          const ConstRRsetPtr& rrsig,
+                          const RdataSet* prepared)
 {
     if (rrset) {
         setupNSEC3<generic::NSEC3>(rrset);
@@ -273,24 +291,62 @@ ZoneDataUpdater::addNSEC3(const Name& name, const ConstRRsetPtr& rrset,
     // Create a new RdataSet, merging any existing NSEC3 data for this
     // name.
     RdataSet* old_rdataset = node->getData();
-    RdataSet* rdataset = RdataSet::create(mem_sgmt_, encoder_, rrset, rrsig,
-                                          old_rdataset);
+    if (old_rdataset == NULL) {
+        // A new hash, which the index doesn't have.
+        clearNSEC3Index();
+    }
+    RdataSet* rdataset = createRdataSet(rrset, rrsig, old_rdataset, prepared,
+                                        NULL);
     old_rdataset = node->setData(rdataset);
     if (old_rdataset != NULL) {
         RdataSet::destroy(mem_sgmt_, old_rdataset, rrclass_);
     }
 }
 
+RdataSet*
+ZoneDataUpdater::createRdataSet(const ConstRRsetPtr& rrset,
+                                const ConstRRsetPtr& rrsig,
+                                const RdataSet* old_rdataset,
+                                const RdataSet* prepared,
+                                RdataPool* rdata_pool)
+{
+    if (prepared && !old_rdataset) {
+        return (RdataSet::copy(mem_sgmt_, rrclass_, *prepared, rdata_pool));
+    }
+    return (RdataSet::create(mem_sgmt_, encoder_, rrset, rrsig,
+                             old_rdataset, rdata_pool));
+}
+
+void
+ZoneDataUpdater::insertName(const Name& name, ZoneNode** node) {
+    if (appending_) {
+        if (zone_data_->appendName(mem_sgmt_, name, node)) {
+            return;
+        }
+        finishAppend();
+    }
+    zone_data_->insertName(mem_sgmt_, name, node);
+}
+
+void
+ZoneDataUpdater::finishAppend() {
+    if (appending_) {
+        zone_data_->finishAppend();
+        appending_ = false;
+    }
+}
+
 void
 ZoneDataUpdater::addRdataSet(const Name& name, const RRType& rrtype,
                              const ConstRRsetPtr& rrset,
-                             const ConstRRsetPtr& rrsig)
+                             const ConstRRsetPtr& rrsig,
+                             const RdataSet* prepared)
 {
     if (rrtype == RRType::NSEC3()) {
-        addNSEC3(name, rrset, rrsig);
+        addNSEC3(name, rrset, rrsig, prepared);
     } else {
         ZoneNode* node;
-        zone_data_->insertName(mem_sgmt_, name, &node);
+        insertName(name, &node);
 
         RdataSet* rdataset_head = node->getData();
 
@@ -305,8 +361,9 @@ ZoneDataUpdater::addRdataSet(const Name& name, const RRType& rrtype,
         // Create a new RdataSet, merging any existing data for this
         // type.
         RdataSet* old_rdataset = RdataSet::find(rdataset_head, rrtype, true);
-        RdataSet* rdataset_new = RdataSet::create(mem_sgmt_, encoder_,
-                                                  rrset, rrsig, old_rdataset);
+        RdataSet* rdataset_new = createRdataSet(rrset, rrsig, old_rdataset,
+                                                prepared,
+                                                zone_data_->getRdataPool());
         if (old_rdataset == NULL) {
             // There is no existing RdataSet. Prepend the new RdataSet
             // to the list.
@@ -328,7 +385,8 @@ ZoneDataUpdater::addRdataSet(const Name& name, const RRType& rrtype,
                     break;
                 }
             }
-            RdataSet::destroy(mem_sgmt_, old_rdataset, rrclass_);
+            RdataSet::destroy(mem_sgmt_, old_rdataset, rrclass_,
+                              zone_data_->getRdataPool());
         }
 
         // Ok, we just put it in.
@@ -376,7 +434,8 @@ void
 ZoneDataUpdater::addInternal(const bundy::dns::Name& name,
                              const bundy::dns::RRType& rrtype,
                              const bundy::dns::ConstRRsetPtr& rrset,
-                             const bundy::dns::ConstRRsetPtr& rrsig)
+                             const bundy::dns::ConstRRsetPtr& rrsig,
+                             const RdataSet* prepared)
 {
     // Add wildcards possibly contained in the owner name to the domain
     // tree.  This can only happen for the normal (non-NSEC3) tree.
@@ -387,12 +446,20 @@ ZoneDataUpdater::addInternal(const bundy::dns::Name& name,
         addWildcards(name);
     }
 
-    addRdataSet(name, rrtype, rrset, rrsig);
+    addRdataSet(name, rrtype, rrset, rrsig, prepared);
 }
 
 void
 ZoneDataUpdater::add(const ConstRRsetPtr& rrset,
                      const ConstRRsetPtr& sig_rrset)
+{
+    addPrepared(rrset, sig_rrset, NULL);
+}
+
+void
+ZoneDataUpdater::addPrepared(const ConstRRsetPtr& rrset,
+                             const ConstRRsetPtr& sig_rrset,
+                             const RdataSet* prepared)
 {
     // Validate input.
     if (!rrset && !sig_rrset) {
@@ -415,12 +482,24 @@ ZoneDataUpdater::add(const ConstRRsetPtr& rrset,
         arg(rrset ? rrtype.toText() : "RRSIG(" + rrtype.toText() + ")").
         arg(zone_name_);
 
+    // Any new name can change the additional nodes of others; they have
+    // to be set again by setAdditionalNodes().
+    zone_data_->setAdditionalLinked(false);
+
+    // Remember whether the node was already a zone cut or DNAME, so we can
+    // tell if the index has to be rebuilt (see addToNameIndex()).
+    bool had_callback = false;
+    if (zone_data_->getNameIndex() && rrtype != RRType::NSEC3()) {
+        const ZoneNode* node = zone_data_->findName(name);
+        had_callback = node && node->getFlag(ZoneNode::FLAG_CALLBACK);
+    }
+
     // Store the address, it may change during growth and the address inside
     // would get updated.
     bool added = false;
     do {
         try {
-            addInternal(name, rrtype, rrset, sig_rrset);
+            addInternal(name, rrtype, rrset, sig_rrset, prepared);
             added = true;
         } catch (const bundy::util::MemorySegmentGrown&) {
             // The segment has grown. So, we update the base pointer (because
@@ -431,6 +510,158 @@ ZoneDataUpdater::add(const ConstRRsetPtr& rrset,
         }
         // Retry if it didn't add due to the growth
     } while (!added);
+
+    if (rrtype != RRType::NSEC3()) {
+        addToNameIndex(name, had_callback);
+    }
+}
+
+namespace {
+// The worker threads of ZoneDataUpdater::addBatch().  The workers and the
+// updater claim the pairs of RRsets in order; each worker creates the
+// RdataSets of the pairs it claims in its own local segment, and the
+// updater copies them into the zone.
+class BatchEncoder : boost::noncopyable {
+public:
+    BatchEncoder(const ZoneDataUpdater::RRsetPairs& rrsets,
+                 const RRClass& rrclass, size_t thread_count) :
+        rrsets_(rrsets), rrclass_(rrclass), items_(rrsets.size()), next_(0)
+    {
+        try {
+            for (size_t i = 0; i < thread_count; ++i) {
+                segments_.push_back(boost::shared_ptr<MemorySegmentLocal>(
+                                        new MemorySegmentLocal));
+                threads_.push_back(boost::shared_ptr<Thread>(
+                                       new Thread(boost::bind(
+                                           &BatchEncoder::run, this,
+                                           segments_.back().get()))));
+            }
+        } catch (...) {
+            stop();
+            throw;
+        }
+    }
+
+    ~BatchEncoder() {
+        stop();
+    }
+
+    // Return the RdataSet created for the i-th pair, waiting for the worker
+    // that claimed it.  It returns NULL if the caller has to add the pair
+    // by itself; that is the case if no worker has claimed it yet (it's
+    // claimed for the caller then), or the worker failed.  In the latter
+    // case add() will fail the same way in the order of the pairs.
+    // The pairs must be got in order.
+    const RdataSet* get(size_t i) {
+        Mutex::Locker locker(mutex_);
+        assert(i <= next_);
+        if (i == next_) {
+            ++next_;
+            return (NULL);
+        }
+        while (!items_[i].done) {
+            cond_.wait(mutex_);
+        }
+        return (items_[i].rdataset);
+    }
+
+private:
+    struct Item {
+        Item() : rdataset(NULL), segment(NULL), done(false) {}
+        RdataSet* rdataset;
+        MemorySegmentLocal* segment;
+        bool done;
+    };
+
+    // The main routine of the threads.  It doesn't throw, so the threads
+    // can be simply waited for in stop().
+    void run(MemorySegmentLocal* segment) {
+        RdataEncoder encoder;
+        while (true) {
+            size_t i;
+            {
+                Mutex::Locker locker(mutex_);
+                if (next_ == items_.size()) {
+                    return;
+                }
+                i = next_++;
+            }
+            RdataSet* rdataset = NULL;
+            try {
+                rdataset = RdataSet::create(*segment, encoder,
+                                            rrsets_[i].first,
+                                            rrsets_[i].second, NULL);
+            } catch (...) {
+                // Left to the updater; see get().
+            }
+            Mutex::Locker locker(mutex_);
+            items_[i].rdataset = rdataset;
+            items_[i].segment = segment;
+            items_[i].done = true;
+            cond_.signal();
+        }
+    }
+
+    // Stop claiming new pairs, wait for the threads and release the
+    // RdataSets they created.
+    void stop() {
+        {
+            Mutex::Locker locker(mutex_);
+            next_ = items_.size();
+        }
+        BOOST_FOREACH(const boost::shared_ptr<Thread>& thread, threads_) {
+            thread->wait();
+        }
+        BOOST_FOREACH(const Item& item, items_) {
+            if (item.rdataset) {
+                RdataSet::destroy(*item.segment, item.rdataset, rrclass_);
+            }
+        }
+    }
+
+    const ZoneDataUpdater::RRsetPairs& rrsets_;
+    const RRClass rrclass_;
+    std::vector<boost::shared_ptr<MemorySegmentLocal> > segments_;
+    std::vector<boost::shared_ptr<Thread> > threads_;
+
+    // Protects the following members.
+    Mutex mutex_;
+    CondVar cond_;
+    std::vector<Item> items_;
+    size_t next_;
+};
+
+void
+prepareForSharing(const ConstRRsetPtr& rrset) {
+    if (rrset) {
+        rrset->getName();
+        rrset->getTTL();
+    }
+}
+}
+
+void
+ZoneDataUpdater::addBatch(const RRsetPairs& rrsets, size_t thread_count) {
+    thread_count = std::min(thread_count, rrsets.size());
+    if (thread_count == 0) {
+        for (size_t i = 0; i < rrsets.size(); ++i) {
+            add(rrsets[i].first, rrsets[i].second);
+        }
+        return;
+    }
+
+    // Some RRset implementations (such as TreeNodeRRset) construct the
+    // name and TTL on first use, so we make sure it's done before the
+    // RRsets are shared with the workers.
+    BOOST_FOREACH(const RRsetPairs::value_type& rrset_pair, rrsets) {
+        prepareForSharing(rrset_pair.first);
+        prepareForSharing(rrset_pair.second);
+    }
+
+    BatchEncoder batch_encoder(rrsets, rrclass_, thread_count);
+    for (size_t i = 0; i < rrsets.size(); ++i) {
+        addPrepared(rrsets[i].first, rrsets[i].second, batch_encoder.get(i));
+    }
 }
 
 void
@@ -456,9 +687,11 @@ ZoneDataUpdater::removeInternal(const bundy::dns::Name& name,
                     name << "/" << rrtype);
     }
 
+    RdataPool* const rdata_pool = zone_data_->getRdataPool();
     RdataSet* const new_rdataset = RdataSet::subtract(mem_sgmt_, encoder_,
                                                       rrset, sig_rrset,
-                                                      *old_rdataset);
+                                                      *old_rdataset,
+                                                      rdata_pool);
     if (new_rdataset) {
         new_rdataset->next = cur->getNext();
     }
@@ -469,7 +702,7 @@ ZoneDataUpdater::removeInternal(const bundy::dns::Name& name,
     } else {
         prev->next = new_next_of_prev;
     }
-    RdataSet::destroy(mem_sgmt_, old_rdataset, rrclass_);
+    RdataSet::destroy(mem_sgmt_, old_rdataset, rrclass_, rdata_pool);
 
     if (node->isEmpty()) {
         zone_data_->removeNode(mem_sgmt_, node);
@@ -508,6 +741,7 @@ ZoneDataUpdater::removeNSEC3(const Name& name, const ConstRRsetPtr& rrset,
     RdataSet::destroy(mem_sgmt_, old_rdataset, rrclass_);
 
     if (node->isEmpty()) {
+        clearNSEC3Index();
         nsec3_data->removeNode(mem_sgmt_, node);
     }
 }
@@ -535,10 +769,16 @@ ZoneDataUpdater::remove(const ConstRRsetPtr& rrset,
     const RRType& rrtype = rrset ? rrset->getType() :
         getCoveredType(sig_rrset);
 
+    // Removing nodes relies on the tree being balanced.
+    finishAppend();
+
     LOG_DEBUG(logger, DBG_TRACE_DATA, DATASRC_MEMORY_MEM_REMOVE_RRS).arg(name).
         arg(rrset ? rrtype.toText() : "RRSIG(" + rrtype.toText() + ")").
         arg(zone_name_);
 
+    // A removed node may be the additional node of others.
+    zone_data_->setAdditionalLinked(false);
+
     while (true) {
         try {
             if (rrtype == RRType::NSEC3()) {
@@ -552,6 +792,360 @@ ZoneDataUpdater::remove(const ConstRRsetPtr& rrset,
                 mem_sgmt_.getNamedAddress("updater_zone_data").second);
         }
     }
+
+    if (rrtype != RRType::NSEC3()) {
+        removeFromNameIndex(name);
+    }
+}
+
+void
+ZoneDataUpdater::buildNameIndex() {
+    // Release the current index first, as it's not used in building the
+    // new one.
+    finishAppend();
+    clearNameIndex();
+    while (true) {
+        try {
+            ZoneNameIndex* index =
+                ZoneNameIndex::create(mem_sgmt_, zone_data_->getZoneTree(),
+                                      zone_name_);
+            zone_data_->setNameIndex(index);
+            LOG_DEBUG(logger, DBG_TRACE_BASIC,
+                      DATASRC_MEMORY_MEM_NAME_INDEX_BUILT).
+                arg(index->getNameCount()).arg(zone_name_);
+            break;
+        } catch (const bundy::util::MemorySegmentGrown&) {
+            zone_data_ = static_cast<ZoneData*>(
+                mem_sgmt_.getNamedAddress("updater_zone_data").second);
+        }
+    }
+}
+
+void
+ZoneDataUpdater::buildNSEC3Index() {
+    NSEC3Data* nsec3_data = zone_data_->getNSEC3Data();
+    if (nsec3_data == NULL || nsec3_data->getHashIndex() != NULL) {
+        return;
+    }
+    while (true) {
+        try {
+            NSEC3HashIndex* index =
+                NSEC3HashIndex::create(mem_sgmt_, nsec3_data->getNSEC3Tree(),
+                                       zone_name_);
+            nsec3_data->setHashIndex(index);
+            LOG_DEBUG(logger, DBG_TRACE_BASIC,
+                      DATASRC_MEMORY_MEM_NSEC3_INDEX_BUILT).
+                arg(index->getNodeCount()).arg(zone_name_);
+            break;
+        } catch (const bundy::BadValue& ex) {
+            LOG_DEBUG(logger, DBG_TRACE_BASIC,
+                      DATASRC_MEMORY_MEM_NSEC3_INDEX_FAIL).
+                arg(zone_name_).arg(ex.what());
+            break;
+        } catch (const bundy::util::MemorySegmentGrown&) {
+            zone_data_ = static_cast<ZoneData*>(
+                mem_sgmt_.getNamedAddress("updater_zone_data").second);
+            nsec3_data = zone_data_->getNSEC3Data();
+        }
+    }
+}
+
+void
+ZoneDataUpdater::clearNSEC3Index() {
+    NSEC3Data* nsec3_data = zone_data_->getNSEC3Data();
+    if (nsec3_data != NULL) {
+        NSEC3HashIndex* index = nsec3_data->setHashIndex(NULL);
+        if (index != NULL) {
+            NSEC3HashIndex::destroy(mem_sgmt_, index);
+        }
+    }
+}
+
+namespace {
+// Return whether the tree has any node (including empty ones) for a
+// subdomain of the given name, which must exist in the tree.  As nodes are
+// iterated in the DNSSEC order, it's the case iff the next node is such one.
+bool
+hasSubdomains(const ZoneTree& tree, const Name& name) {
+    ZoneChain chain;
+    const ZoneNode* node = NULL;
+    tree.find(name, &node, chain);
+    if (tree.nextNode(chain) == NULL) {
+        return (false);
+    }
+    return (chain.getAbsoluteName().compare(name).getRelation() ==
+            NameComparisonResult::SUBDOMAIN);
+}
+}
+
+void
+ZoneDataUpdater::addToNameIndex(const Name& name, bool had_callback) {
+    ZoneNameIndex* const index = zone_data_->getNameIndex();
+    if (index == NULL) {
+        return;
+    }
+    const ZoneNode* const node = zone_data_->findName(name);
+    assert(node != NULL);
+
+    // A new zone cut or DNAME hides the names below it, some of which may
+    // be in the index.  Rather than looking for them, we simply drop the
+    // index; it's rare in practice for a node that has subdomains.
+    if (!had_callback && node->getFlag(ZoneNode::FLAG_CALLBACK) &&
+        hasSubdomains(zone_data_->getZoneTree(), name)) {
+        clearNameIndex();
+        return;
+    }
+
+    // Names below a zone cut or DNAME are not indexed.
+    for (const ZoneNode* upper = node->getUpperNode(); upper != NULL;
+         upper = upper->getUpperNode()) {
+        if (upper->getFlag(ZoneNode::FLAG_CALLBACK)) {
+            return;
+        }
+    }
+
+    // If the index is full, drop it so it'll be rebuilt with enough room.
+    if (!index->insert(LabelSequence(name), node)) {
+        clearNameIndex();
+    }
+}
+
+void
+ZoneDataUpdater::removeFromNameIndex(const Name& name) {
+    ZoneNameIndex* const index = zone_data_->getNameIndex();
+    if (index == NULL) {
+        return;
+    }
+    // The node may have been removed, or may be kept as an empty
+    // non-terminal; neither should be in the index.  Removing the node
+    // doesn't affect others in the index, since any other node removed
+    // with it is empty.
+    const ZoneNode* const node = zone_data_->findName(name);
+    if (node == NULL || node->isEmpty()) {
+        index->erase(LabelSequence(name));
+    }
+}
+
+void
+ZoneDataUpdater::clearNameIndex() {
+    ZoneNameIndex* index = zone_data_->setNameIndex(NULL);
+    if (index != NULL) {
+        ZoneNameIndex::destroy(mem_sgmt_, index);
+    }
+}
+
+namespace {
+// RdataReader callback for setAdditionalNodes(): set the additional node of
+// the RDATA being read (its index is *rdata_index) for the name, if it's
+// subject to additional section processing.  If the node can't be
+// identified, *linked is set to false.
+void
+setAdditionalNode(const ZoneData* zone_data, RdataSet* rdataset,
+                  const size_t* rdata_index, bool* linked,
+                  const LabelSequence& name_labels, RdataNameAttributes attr)
+{
+    if ((attr & NAMEATTR_ADDITIONAL) == 0) {
+        return;
+    }
+    const ZoneNode* node = NULL;
+    if (InMemoryZoneFinder::findAdditionalNode(*zone_data, rdataset->type,
+                                               name_labels, &node)) {
+        rdataset->setAdditionalNode(*rdata_index, node);
+    } else {
+        *linked = false;
+    }
+}
+}
+
+void
+ZoneDataUpdater::setAdditionalNodes() {
+    finishAppend();
+    zone_data_->setAdditionalLinked(false);
+
+    size_t rdataset_count = 0;
+    size_t unlinked_count = 0;
+    const ZoneTree& tree = zone_data_->getZoneTree();
+    ZoneChain chain;
+    const ZoneNode* node = NULL;
+    tree.find(zone_name_, &node, chain);
+    for (; node != NULL; node = tree.nextNode(chain)) {
+        if (!hasAdditionalNodes(node)) {
+            continue;
+        }
+        // The tree only gives const nodes; get the same one for update.
+        ZoneNode* const target = zone_data_->findName(chain.getAbsoluteName());
+        assert(target == node);
+        for (RdataSet* rdataset = target->getData();
+             rdataset != NULL;
+             rdataset = rdataset->getNext()) {
+            if (!RdataSet::hasAdditionalNodes(rdataset->type) ||
+                rdataset->getRdataCount() == 0) {
+                continue;
+            }
+            rdataset->clearAdditionalNodes();
+            size_t rdata_index = 0;
+            bool linked = true;
+            const RdataSet* const const_rdataset = rdataset;
+            RdataReader reader(rrclass_, rdataset->type,
+                               const_rdataset->getDataBuf(),
+                               rdataset->getRdataCount(),
+                               rdataset->getSigRdataCount(),
+                               boost::bind(setAdditionalNode, zone_data_,
+                                           rdataset, &rdata_index, &linked,
+                                           _1, _2),
+                               &RdataReader::emptyDataAction);
+            while (reader.iterateRdata()) {
+                ++rdata_index;
+            }
+            ++rdataset_count;
+            if (!linked || !rdataset->isAdditionalNodeSet()) {
+                ++unlinked_count;
+            }
+        }
+    }
+
+    zone_data_->setAdditionalLinked(true);
+    LOG_DEBUG(logger, DBG_TRACE_BASIC, DATASRC_MEMORY_MEM_ADDITIONAL_LINKED).
+        arg(rdataset_count - unlinked_count).arg(rdataset_count).
+        arg(zone_name_);
+}
+
+namespace {
+// While relayout() moves nodes, the old nodes and RdataSets to be released
+// are remembered by their offsets from the zone data, which remain valid
+// even if the memory segment is remapped as it grows.
+ptrdiff_t
+getOffset(const ZoneData* zone_data, const void* ptr) {
+    return (static_cast<const char*>(ptr) -
+            reinterpret_cast<const char*>(zone_data));
+}
+
+template <typename T>
+T*
+getAddress(ZoneData* zone_data, ptrdiff_t offset) {
+    return (reinterpret_cast<T*>(reinterpret_cast<char*>(zone_data) +
+                                 offset));
+}
+
+void
+destroyRdataSets(util::MemorySegment& mem_sgmt, RdataSet* rdataset,
+                 const RRClass& rrclass, RdataPool* rdata_pool)
+{
+    while (rdataset != NULL) {
+        RdataSet* const next = rdataset->getNext();
+        RdataSet::destroy(mem_sgmt, rdataset, rrclass, rdata_pool);
+        rdataset = next;
+    }
+}
+}
+
+size_t
+ZoneDataUpdater::relayout(const std::vector<Name>& names) {
+    finishAppend();
+    clearNameIndex();
+    // Other RdataSets can have the moved nodes as their additional nodes.
+    zone_data_->setAdditionalLinked(false);
+
+    std::vector<ptrdiff_t> old_nodes;
+    std::vector<ptrdiff_t> old_rdatasets;
+    size_t count = 0;
+    BOOST_FOREACH(const Name& name, names) {
+        const NameComparisonResult::NameRelation relation =
+            name.compare(zone_name_).getRelation();
+        if (relation != NameComparisonResult::SUBDOMAIN &&
+            relation != NameComparisonResult::EQUAL) {
+            continue;
+        }
+
+        // Move the node first, so its RdataSets follow it.
+        ZoneNode* node = NULL;
+        while (true) {
+            try {
+                node = zone_data_->findName(name);
+                if (node != NULL) {
+                    ZoneNode* const new_node =
+                        zone_data_->relocateNode(mem_sgmt_, node);
+                    if (new_node != node) {
+                        old_nodes.push_back(getOffset(zone_data_, node));
+                    }
+                }
+                break;
+            } catch (const bundy::util::MemorySegmentGrown&) {
+                zone_data_ = static_cast<ZoneData*>(
+                    mem_sgmt_.getNamedAddress("updater_zone_data").second);
+            }
+        }
+        if (node == NULL) {
+            continue;
+        }
+
+        // Then copy the RdataSets and replace the old ones at once.  If
+        // the segment grows in the middle, the copies made so far are
+        // released and copied again.
+        while (true) {
+            RdataSet* head = NULL;
+            RdataSet* tail = NULL;
+            try {
+                node = zone_data_->findName(name);
+                for (const RdataSet* rdataset = node->getData();
+                     rdataset != NULL;
+                     rdataset = rdataset->getNext()) {
+                    RdataSet* const copy =
+                        RdataSet::copy(mem_sgmt_, rrclass_, *rdataset,
+                                       zone_data_->getRdataPool());
+                    if (tail == NULL) {
+                        head = copy;
+                    } else {
+                        tail->next = copy;
+                    }
+                    tail = copy;
+                }
+                RdataSet* const old_head = node->setData(head);
+                if (old_head != NULL) {
+                    old_rdatasets.push_back(getOffset(zone_data_, old_head));
+                }
+                break;
+            } catch (const bundy::util::MemorySegmentGrown&) {
+                const ptrdiff_t head_offset =
+                    head != NULL ? getOffset(zone_data_, head) : 0;
+                zone_data_ = static_cast<ZoneData*>(
+                    mem_sgmt_.getNamedAddress("updater_zone_data").second);
+                if (head != NULL) {
+                    destroyRdataSets(mem_sgmt_,
+                                     getAddress<RdataSet>(zone_data_,
+                                                          head_offset),
+                                     rrclass_, zone_data_->getRdataPool());
+                }
+            }
+        }
+        ++count;
+    }
+
+    BOOST_FOREACH(const ptrdiff_t offset, old_nodes) {
+        zone_data_->destroyRelocatedNode(mem_sgmt_,
+                                         getAddress<ZoneNode>(zone_data_,
+                                                              offset));
+    }
+    BOOST_FOREACH(const ptrdiff_t offset, old_rdatasets) {
+        destroyRdataSets(mem_sgmt_, getAddress<RdataSet>(zone_data_, offset),
+                         rrclass_, zone_data_->getRdataPool());
+    }
+
+    LOG_DEBUG(logger, DBG_TRACE_BASIC, DATASRC_MEMORY_MEM_RELAYOUT).
+        arg(count).arg(names.size()).arg(zone_name_);
+    return (count);
+}
+
+bool
+ZoneDataUpdater::hasAdditionalNodes(const ZoneNode* node) {
+    for (const RdataSet* rdataset = node->getData();
+         rdataset != NULL;
+         rdataset = rdataset->getNext()) {
+        if (RdataSet::hasAdditionalNodes(rdataset->type)) {
+            return (true);
+        }
+    }
+    return (false);
 }
 
 } // namespace memory
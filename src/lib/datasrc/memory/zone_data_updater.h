@@ -26,6 +26,9 @@
 
 #include <boost/noncopyable.hpp>
 
+#include <utility>
+#include <vector>
+
 namespace bundy {
 namespace datasrc {
 namespace memory {
@@ -74,7 +77,8 @@ public:
        rrclass_(rrclass),
        zone_name_(zone_name),
        hash_(NULL),
-       zone_data_(&zone_data)
+       zone_data_(&zone_data),
+       appending_(false)
     {
         if (mem_sgmt_.getNamedAddress("updater_zone_data").first) {
             bundy_throw(bundy::InvalidOperation,
@@ -163,6 +167,38 @@ public:
     void add(const bundy::dns::ConstRRsetPtr& rrset,
              const bundy::dns::ConstRRsetPtr& sig_rrset);
 
+    /// \brief Pairs of an RRset and its RRSIG to be given to \c addBatch().
+    typedef std::vector<std::pair<bundy::dns::ConstRRsetPtr,
+                                  bundy::dns::ConstRRsetPtr> > RRsetPairs;
+
+    /// \brief Add RRsets to the zone, encoding them on worker threads.
+    ///
+    /// This is equivalent to calling \c add() for each pair of
+    /// \c rrsets in the given order, including the exceptions: if a pair
+    /// is rejected, the pairs before it have been added and the ones after
+    /// it are not.
+    ///
+    /// Encoding the RDATA is the most expensive part of \c add() for large
+    /// zones.  This method lets \c thread_count worker threads encode the
+    /// RRsets into their own local memory segments in advance, while
+    /// the calling thread validates the RRsets and inserts them into the
+    /// zone in order, copying the encoded sets (see \c RdataSet::copy()).
+    /// The calling thread encodes RRsets the workers haven't claimed yet
+    /// by itself, and RRsets to be merged with an existing RdataSet of the
+    /// same type are encoded again with the existing one, so it's most
+    /// effective for a large batch of RRsets of distinct names and types,
+    /// such as a chunk of a zone file.
+    ///
+    /// If \c thread_count is 0, it simply calls \c add() for each pair.
+    ///
+    /// \throw Any exception \c add() throws (see above).
+    /// \throw std::bad_alloc or bundy::Unexpected Failure to start the
+    /// worker threads.
+    ///
+    /// \param rrsets The RRsets and RRSIGs to be added.
+    /// \param thread_count The number of worker threads.
+    void addBatch(const RRsetPairs& rrsets, size_t thread_count);
+
     /// \brief Remove RRs (possibly with some of RRSIGs) from the zone.
     ///
     /// This method removes any of the given RRs and RRSIGs that currently
@@ -198,7 +234,138 @@ public:
     void remove(const bundy::dns::ConstRRsetPtr& rrset,
                 const bundy::dns::ConstRRsetPtr& sig_rrset);
 
+    /// \brief Start adding names in the DNSSEC order.
+    ///
+    /// After this call, \c add() appends new names to the zone tree
+    /// without rebalancing it (see \c ZoneData::appendName()), as long as
+    /// the names are given in the DNSSEC order, which is the case for
+    /// zones loaded from a sorted source such as a zone transferred from
+    /// another in-memory data source or a canonicalized zone file.  At the
+    /// first name out of order, the tree is balanced and the remaining
+    /// names are inserted as usual, so this doesn't affect the result
+    /// whatever the order is.
+    ///
+    /// \c finishAppend() must be called once the RRsets are added;
+    /// \c remove() and \c buildNameIndex() call it implicitly.
+    ///
+    /// \throw none
+    void startAppend() {
+        appending_ = true;
+    }
+
+    /// \brief Balance the zone tree after adding names with \c startAppend().
+    ///
+    /// It does nothing if \c startAppend() wasn't called or the tree has
+    /// already been balanced.
+    ///
+    /// \throw none
+    void finishAppend();
+
+    /// \brief Build the exact-match name index of the zone.
+    ///
+    /// It creates a \c ZoneNameIndex for the current content of the zone
+    /// data and associates it with the zone data, replacing any existing
+    /// one.  It's expected to be called once all RRsets have been added
+    /// or removed.
+    ///
+    /// If the zone data already have an index, \c add() and \c remove()
+    /// update it in place so it can be still used after incremental
+    /// changes to the zone.  In some cases that can't be done cheaply
+    /// (e.g., a zone cut is added above indexed names, or the index runs
+    /// out of the room for new names), they destroy the index instead;
+    /// the caller can then rebuild it with this method.
+    ///
+    /// Like \c add(), this method handles the growth of the memory
+    /// segment internally, so \c util::MemorySegmentGrown won't be
+    /// propagated to the caller.
+    ///
+    /// \throw std::bad_alloc Memory allocation fails.
+    void buildNameIndex();
+
+    /// \brief Build the NSEC3 hash index of the zone.
+    ///
+    /// It creates a \c NSEC3HashIndex for the current NSEC3 RRs of the
+    /// zone data, unless the zone isn't signed with NSEC3 or already has
+    /// the index.  It's expected to be called once all RRsets have been
+    /// added or removed.  If the NSEC3 RRs can't be indexed, the zone is
+    /// left without the index.
+    ///
+    /// The index can't be updated in place; \c add() and \c remove()
+    /// destroy it when they add or remove an NSEC3 owner name, and it
+    /// should then be built again with this method.
+    ///
+    /// Like \c add(), this method handles the growth of the memory
+    /// segment internally.
+    ///
+    /// \throw std::bad_alloc Memory allocation fails.
+    void buildNSEC3Index();
+
+    /// \brief Set the additional nodes of all \c RdataSets of the zone.
+    ///
+    /// For each name subject to additional section processing in the
+    /// RDATA of the zone (such as the name server names of NS), it
+    /// identifies the zone node that has the records for the additional
+    /// section, and stores it in the \c RdataSet (see
+    /// \c RdataSet::setAdditionalNode()), so \c InMemoryZoneFinder
+    /// doesn't have to look up the names on each query.  Names matched
+    /// by a wildcard are still looked up on each query.
+    ///
+    /// As the nodes depend on the entire zone, \c add() and \c remove()
+    /// disable them (see \c ZoneData::setAdditionalLinked()), and this
+    /// method has to be called again once all RRsets have been added or
+    /// removed.  It should be called after \c buildNameIndex(), if it's
+    /// called at all, so the lookups can use the index.
+    ///
+    /// \throw none
+    void setAdditionalNodes();
+
+    /// \brief Pack the nodes of the given names together in memory.
+    ///
+    /// For each of \c names, in the given order, it moves the zone node of
+    /// the name (see \c ZoneData::relocateNode()) and its \c RdataSets to
+    /// newly allocated memory.  The old ones are only released at the end,
+    /// so the new ones are allocated next to each other, rather than
+    /// scattered in the order the names were loaded.  It's intended to be
+    /// given the most frequently queried names of the zone (see
+    /// \c ZoneNodeSampler), so queries for them touch fewer cache lines and
+    /// pages.  Names that don't exist in the zone are ignored.
+    ///
+    /// The name index and the additional nodes refer to the moved nodes,
+    /// so this method destroys the former and disables the latter; like
+    /// after \c add(), they should be built again with
+    /// \c buildNameIndex() and \c setAdditionalNodes().
+    ///
+    /// Like \c add(), this method handles the growth of the memory
+    /// segment internally.
+    ///
+    /// \throw std::bad_alloc Memory allocation fails.
+    ///
+    /// \param names The names to be packed, most important first.
+    /// \return The number of names found in the zone, whose data have been
+    /// moved (the node of the zone origin itself is never moved).
+    size_t relayout(const std::vector<bundy::dns::Name>& names);
+
 private:
+    // Return whether the node has any RdataSet that stores additional
+    // nodes.
+    static bool hasAdditionalNodes(const ZoneNode* node);
+
+    // Reflect the addition of an RRset of 'name' to the name index of the
+    // zone, if any.  'had_callback' is whether the node of the name had
+    // FLAG_CALLBACK before the addition.
+    void addToNameIndex(const bundy::dns::Name& name, bool had_callback);
+
+    // Reflect the removal of RRs of 'name' to the name index of the zone,
+    // if any.
+    void removeFromNameIndex(const bundy::dns::Name& name);
+
+    // Destroy the name index of the zone, if any.
+    void clearNameIndex();
+
+    // Destroy the NSEC3 hash index of the zone, if any.
+    void clearNSEC3Index();
+
+
     // Add the necessary magic for any wildcard contained in 'name'
     // (including itself) to be found in the zone.
     //
@@ -214,10 +381,19 @@ private:
     // contained in 'name' (e.g., '*.foo.example' in 'bar.*.foo.example').
     void addWildcards(const bundy::dns::Name& name);
 
+    // The body of add() and addBatch().  If 'prepared' isn't NULL, it's an
+    // RdataSet created from 'rrset' and 'sig_rrset' in another segment,
+    // and it's copied instead of encoding them if nothing has to be
+    // merged with it.
+    void addPrepared(const bundy::dns::ConstRRsetPtr& rrset,
+                     const bundy::dns::ConstRRsetPtr& sig_rrset,
+                     const RdataSet* prepared);
+
     void addInternal(const bundy::dns::Name& name,
                      const bundy::dns::RRType& rrtype,
                      const bundy::dns::ConstRRsetPtr& rrset,
-                     const bundy::dns::ConstRRsetPtr& rrsig);
+                     const bundy::dns::ConstRRsetPtr& rrsig,
+                     const RdataSet* prepared);
 
     void removeInternal(const bundy::dns::Name& name,
                         const bundy::dns::RRType& rrtype,
@@ -241,14 +417,29 @@ private:
     void setupNSEC3(const bundy::dns::ConstRRsetPtr rrset);
     void addNSEC3(const bundy::dns::Name& name,
                   const bundy::dns::ConstRRsetPtr& rrset,
-                  const bundy::dns::ConstRRsetPtr& rrsig);
+                  const bundy::dns::ConstRRsetPtr& rrsig,
+                  const RdataSet* prepared);
     void removeNSEC3(const bundy::dns::Name& name,
                      const bundy::dns::ConstRRsetPtr& rrset,
                      const bundy::dns::ConstRRsetPtr& rrsig);
     void addRdataSet(const bundy::dns::Name& name,
                      const bundy::dns::RRType& rrtype,
                      const bundy::dns::ConstRRsetPtr& rrset,
-                     const bundy::dns::ConstRRsetPtr& rrsig);
+                     const bundy::dns::ConstRRsetPtr& rrsig,
+                     const RdataSet* prepared);
+
+    // Create the RdataSet to be stored for addRdataSet() and addNSEC3(),
+    // copying 'prepared' if possible, and sharing its data in 'rdata_pool'
+    // if it's non NULL.
+    RdataSet* createRdataSet(const bundy::dns::ConstRRsetPtr& rrset,
+                             const bundy::dns::ConstRRsetPtr& rrsig,
+                             const RdataSet* old_rdataset,
+                             const RdataSet* prepared,
+                             RdataPool* rdata_pool);
+
+    // Insert 'name' into the zone tree, appending it if we are in the
+    // append mode and it's in order (see startAppend()).
+    void insertName(const bundy::dns::Name& name, ZoneNode** node);
 
     util::MemorySegment& mem_sgmt_;
     const bundy::dns::RRClass rrclass_;
@@ -256,6 +447,7 @@ private:
     RdataEncoder encoder_;
     const bundy::dns::NSEC3Hash* hash_;
     ZoneData* zone_data_;
+    bool appending_;
 };
 
 } // namespace memory
@@ -16,6 +16,9 @@
 #include <datasrc/memory/domaintree.h>
 #include <datasrc/memory/treenode_rrset.h>
 #include <datasrc/memory/rdata_serialization.h>
+#include <datasrc/memory/zone_name_index.h>
+#include <datasrc/memory/nsec3_hash_index.h>
+#include <datasrc/memory/zone_node_sampler.h>
 
 #include <datasrc/zone_finder.h>
 #include <datasrc/exceptions.h>
@@ -29,6 +32,8 @@
 #include <datasrc/memory/logger.h>
 
 #include <util/buffer.h>
+#include <util/memory_arena.h>
+#include <util/encode/base32hex.h>
 
 #include <boost/scoped_ptr.hpp>
 #include <boost/bind.hpp>
@@ -41,6 +46,8 @@
 using namespace bundy::dns;
 using namespace bundy::datasrc::memory;
 using namespace bundy::datasrc;
+using bundy::util::MemoryArena;
+using bundy::util::encode::decodeBase32Hex;
 
 namespace bundy {
 namespace datasrc {
@@ -95,8 +102,9 @@ typedef std::pair<const ZoneNode*, const RdataSet*> ConstNodeRRset;
 /// Creates a TreeNodeRRsetPtr for the given RdataSet at the given Node, for
 /// the given RRClass
 ///
-/// We should probably have some pool so these  do not need to be allocated
-/// dynamically.
+/// The RRset is created from the \c util::MemoryArena of the current
+/// thread, if any, so that the processing of a query doesn't need the
+/// general purpose allocator for it.
 ///
 /// \param node The ZoneNode found by the find() calls
 /// \param rdataset The RdataSet to create the RRsetPtr for
@@ -116,16 +124,19 @@ createTreeNodeRRset(const ZoneNode* node,
     const bool dnssec = ((options & ZoneFinder::FIND_DNSSEC) != 0);
     if (node && rdataset) {
         if (realname) {
-            return (TreeNodeRRsetPtr(new TreeNodeRRset(*realname, rrclass,
-                                                       node, rdataset,
-                                                       dnssec)));
+            return (MemoryArena::createShared<TreeNodeRRset>(*realname,
+                                                             rrclass, node,
+                                                             rdataset,
+                                                             dnssec));
         } else if (ttl_data) {
             assert(!realname);  // these two cases should be mixed in our use
-            return (TreeNodeRRsetPtr(new TreeNodeRRset(rrclass, node, rdataset,
-                                                       dnssec, ttl_data)));
+            return (MemoryArena::createShared<TreeNodeRRset>(rrclass, node,
+                                                             rdataset, dnssec,
+                                                             ttl_data));
         } else {
-            return (TreeNodeRRsetPtr(new TreeNodeRRset(rrclass, node, rdataset,
-                                                       dnssec)));
+            return (MemoryArena::createShared<TreeNodeRRset>(rrclass, node,
+                                                             rdataset,
+                                                             dnssec));
         }
     } else {
         return (TreeNodeRRsetPtr());
@@ -469,12 +480,26 @@ public:
 // out_of_zone_ok is true, it returns an NXDOMAIN result with NULL data so
 // the caller can take an action to it (technically it's not "NXDOMAIN",
 // but the caller is assumed not to rely on the difference.)
+//
+// Before all of this, if the zone has a name index, we first look up
+// the name in it.  A name found in the index is guaranteed to be a
+// non-empty exact match without any delegation above it, so the result
+// is the same as that of the tree search except that node_path is left
+// empty.  It's okay as the callers only use node_path for other cases.
 FindNodeResult findNode(const ZoneData& zone_data,
                         const LabelSequence& name_labels,
                         ZoneChain& node_path,
                         ZoneFinder::FindOptions options,
                         bool out_of_zone_ok = false)
 {
+    const ZoneNameIndex* name_index = zone_data.getNameIndex();
+    if (name_index != NULL) {
+        const ZoneNode* node = name_index->find(name_labels);
+        if (node != NULL) {
+            return (FindNodeResult(ZoneFinder::SUCCESS, node, NULL));
+        }
+    }
+
     const ZoneNode* node = NULL;
     FindState state((options & ZoneFinder::FIND_GLUE_OK) != 0);
 
@@ -562,6 +587,57 @@ FindNodeResult findNode(const ZoneData& zone_data,
     }
 }
 
+// Return the options to find the additional records for names in RDATA of
+// the given type.
+ZoneFinder::FindOptions
+getAdditionalOptions(const RRType& type, ZoneFinder::FindOptions orig_options)
+{
+    ZoneFinder::FindOptions options = ZoneFinder::FIND_DEFAULT;
+    if ((orig_options & ZoneFinder::FIND_DNSSEC) != 0) {
+        options = options | ZoneFinder::FIND_DNSSEC;
+    }
+    if (type == RRType::NS()) {
+        options = options | ZoneFinder::FIND_GLUE_OK;
+    }
+    return (options);
+}
+
+// Identify the zone node holding the additional records for the given name
+// in RDATA, or return NULL if there's none.  If the node is of a wildcard
+// match, wildcard is set to true.
+const ZoneNode*
+identifyAdditionalNode(const ZoneData& zone_data,
+                       const LabelSequence& name_labels,
+                       ZoneFinder::FindOptions options, bool& wildcard)
+{
+    // Find the zone node for the additional name.  By passing true as the
+    // last parameter of findNode() we ignore out-of-zone names.
+    ZoneChain node_path;
+    const FindNodeResult node_result =
+        findNode(zone_data, name_labels, node_path, options, true);
+    // we only need non-empty exact match
+    if (node_result.code != ZoneFinder::SUCCESS) {
+        return (NULL);
+    }
+
+    // Ignore data at a zone cut (due to subdomain delegation) unless glue is
+    // allowed.  Checking the node callback flag is a cheap way to detect
+    // zone cuts, but it includes DNAME delegation, in which case we should
+    // keep finding the additional records regardless of the 'GLUE_OK' flag.
+    // The last two conditions limit the case to delegation NS, i.e, the node
+    // has an NS and it's not the zone origin.
+    const ZoneNode* node = node_result.node;
+    if ((options & ZoneFinder::FIND_GLUE_OK) == 0 &&
+        node->getFlag(ZoneNode::FLAG_CALLBACK) &&
+        node != zone_data.getOriginNode() &&
+        RdataSet::find(node->getData(), RRType::NS()) != NULL) {
+        return (NULL);
+    }
+
+    wildcard = (node_result.flags & FindNodeResult::FIND_WILDCARD) != 0;
+    return (node);
+}
+
 } // end anonymous namespace
 
 
@@ -634,12 +710,21 @@ private:
                              std::vector<ConstRRsetPtr>& result,
                              ZoneFinder::FindOptions orig_options) const
     {
-        ZoneFinder::FindOptions options = ZoneFinder::FIND_DEFAULT;
-        if ((orig_options & ZoneFinder::FIND_DNSSEC) != 0) {
-            options = options | ZoneFinder::FIND_DNSSEC;
-        }
-        if (rdset->type == RRType::NS()) {
-            options = options | ZoneFinder::FIND_GLUE_OK;
+        const ZoneFinder::FindOptions options =
+            getAdditionalOptions(rdset->type, orig_options);
+
+        // If the nodes were identified on load, we don't have to look up
+        // the names in the RDATA (see ZoneDataUpdater::setAdditionalNodes()).
+        if (zone_data_->isAdditionalLinked() && rdset->isAdditionalNodeSet()) {
+            const size_t rdata_count = rdset->getRdataCount();
+            for (size_t i = 0; i < rdata_count; ++i) {
+                const ZoneNode* node = rdset->getAdditionalNode(i);
+                if (node != NULL) {
+                    findAdditionalHelper(&requested_types, &result, node,
+                                         options, NULL);
+                }
+            }
+            return;
         }
 
         RdataReader(rrclass_, rdset->type, rdset->getDataBuf(),
@@ -710,33 +795,16 @@ InMemoryZoneFinder::Context::findAdditional(
         return;
     }
 
-    // Find the zone node for the additional name.  By passing true as the
-    // last parameter of findNode() we ignore out-of-zone names.
-    ZoneChain node_path;
-    const FindNodeResult node_result =
-        findNode(*zone_data_, name_labels, node_path, options, true);
-    // we only need non-empty exact match
-    if (node_result.code != SUCCESS) {
-        return;
-    }
-
-    // Ignore data at a zone cut (due to subdomain delegation) unless glue is
-    // allowed.  Checking the node callback flag is a cheap way to detect
-    // zone cuts, but it includes DNAME delegation, in which case we should
-    // keep finding the additional records regardless of the 'GLUE_OK' flag.
-    // The last two conditions limit the case to delegation NS, i.e, the node
-    // has an NS and it's not the zone origin.
-    const ZoneNode* node = node_result.node;
-    if ((options & ZoneFinder::FIND_GLUE_OK) == 0 &&
-        node->getFlag(ZoneNode::FLAG_CALLBACK) &&
-        node != zone_data_->getOriginNode() &&
-        RdataSet::find(node->getData(), RRType::NS()) != NULL) {
+    bool wildcard = false;
+    const ZoneNode* node = identifyAdditionalNode(*zone_data_, name_labels,
+                                                  options, wildcard);
+    if (node == NULL) {
         return;
     }
 
     // Examine RdataSets of the node, and create and insert requested types
     // of RRsets as we find them.
-    if ((node_result.flags & FindNodeResult::FIND_WILDCARD) == 0) {
+    if (!wildcard) {
         // normal case
         findAdditionalHelper(requested_types, result, node, options, NULL);
     } else {
@@ -754,14 +822,27 @@ InMemoryZoneFinder::Context::findAdditional(
     }
 }
 
+bool
+InMemoryZoneFinder::findAdditionalNode(const ZoneData& zone_data,
+                                       const RRType& type,
+                                       const LabelSequence& name_labels,
+                                       const ZoneNode** node)
+{
+    bool wildcard = false;
+    *node = identifyAdditionalNode(zone_data, name_labels,
+                                   getAdditionalOptions(type, FIND_DEFAULT),
+                                   wildcard);
+    return (!wildcard);
+}
+
 boost::shared_ptr<ZoneFinder::Context>
 InMemoryZoneFinder::find(const bundy::dns::Name& name,
                          const bundy::dns::RRType& type,
                          const FindOptions options)
 {
-    return (ZoneFinderContextPtr(new Context(*this, options, rrclass_,
-                                             findInternal(name, type,
-                                                          NULL, options))));
+    return (MemoryArena::createShared<Context>(*this, options, rrclass_,
+                                               findInternal(name, type,
+                                                            NULL, options)));
 }
 
 boost::shared_ptr<ZoneFinder::Context>
@@ -769,11 +850,11 @@ InMemoryZoneFinder::findAll(const bundy::dns::Name& name,
                             std::vector<bundy::dns::ConstRRsetPtr>& target,
                             const FindOptions options)
 {
-    return (ZoneFinderContextPtr(new Context(*this, options, rrclass_,
-                                             findInternal(name,
-                                                          RRType::ANY(),
-                                                          &target,
-                                                          options))));
+    return (MemoryArena::createShared<Context>(*this, options, rrclass_,
+                                               findInternal(name,
+                                                            RRType::ANY(),
+                                                            &target,
+                                                            options)));
 }
 
 // The implementation is a special case of the generic findInternal: we know
@@ -797,21 +878,18 @@ InMemoryZoneFinder::findAtOrigin(const bundy::dns::RRType& type,
     if (found != NULL) {
         LOG_DEBUG(logger, DBG_TRACE_DATA, DATASRC_MEMORY_FIND_TYPE_AT_ORIGIN).
             arg(type).arg(getOrigin()).arg(rrclass_);
-        return (ZoneFinderContextPtr(
-                    new Context(*this, options, rrclass_,
-                                createFindResult(rrclass_, zone_data_, SUCCESS,
-                                                 node, found, options, false,
-                                                 NULL, use_minttl))));
+        return (MemoryArena::createShared<Context>(
+                    *this, options, rrclass_,
+                    createFindResult(rrclass_, zone_data_, SUCCESS, node,
+                                     found, options, false, NULL,
+                                     use_minttl)));
     }
-    return (ZoneFinderContextPtr(
-                    new Context(*this, options, rrclass_,
-                                createFindResult(rrclass_, zone_data_, NXRRSET,
-                                                 node,
-                                                 getNSECForNXRRSET(zone_data_,
-                                                                   options,
-                                                                   node),
-                                                 options, false, NULL,
-                                                 use_minttl))));
+    return (MemoryArena::createShared<Context>(
+                    *this, options, rrclass_,
+                    createFindResult(rrclass_, zone_data_, NXRRSET, node,
+                                     getNSECForNXRRSET(zone_data_, options,
+                                                       node),
+                                     options, false, NULL, use_minttl)));
 }
 
 ZoneFinderResultContext
@@ -825,6 +903,9 @@ InMemoryZoneFinder::findInternal(const bundy::dns::Name& name,
     ZoneChain node_path;
     const FindNodeResult node_result =
         findNode(zone_data_, LabelSequence(name), node_path, options);
+    if (sampler_ != NULL && node_result.node != NULL) {
+        sampler_->sample(zone_data_, node_result.node);
+    }
     if (node_result.code != SUCCESS) {
         // We pass name's label count in case it's NXRRSET due to empty name
         // (in which case we need to identify the match labels from qname).
@@ -959,12 +1040,57 @@ InMemoryZoneFinder::findNSEC3(const bundy::dns::Name& name, bool recursive) {
     // placeholder of the next closer proof
     const ZoneNode* covering_node(NULL);
 
-    // Now we'll first look up the origin node and initialize orig_chain
-    // with it.
+    const boost::scoped_ptr<NSEC3Hash> hash
+        (NSEC3Hash::create(nsec3_data->hashalg,
+                           nsec3_data->iterations,
+                           nsec3_data->getSaltData(),
+                           nsec3_data->getSaltLen()));
+
+    // In the recursive mode we'll likely need to examine most of the names
+    // from the query name to the origin, so we calculate all their hashes
+    // at once.  Otherwise only the query name is needed.
+    std::vector<LabelSequence> candidates;
+    std::vector<std::string> hlabels;
+    candidates.push_back(name_ls);
+    if (recursive) {
+        LabelSequence ancestor_ls(name_ls);
+        for (unsigned int labels = qlabels; labels > olabels; --labels) {
+            ancestor_ls.stripLeft(1);
+            candidates.push_back(ancestor_ls);
+        }
+    }
+    hash->calculateBatch(candidates, hlabels);
+
+    // If the NSEC3 RRs are indexed, the hashes are looked up in the index,
+    // unless they can't be (e.g., they were made with an algorithm of
+    // another hash length).  Otherwise we'll first look up the origin node
+    // and initialize orig_chain with it.
+    const NSEC3HashIndex* index = nsec3_data->getHashIndex();
+    std::vector<uint8_t> hashes;
+    if (index != NULL && index->getNodeCount() > 0) {
+        std::vector<uint8_t> hash_buf;
+        try {
+            for (size_t i = 0; i < hlabels.size(); ++i) {
+                decodeBase32Hex(hlabels[i], hash_buf);
+                if (hash_buf.size() != index->getHashLength()) {
+                    index = NULL;
+                    break;
+                }
+                hashes.insert(hashes.end(), hash_buf.begin(),
+                              hash_buf.end());
+            }
+        } catch (const bundy::BadValue&) {
+            index = NULL;
+        }
+    } else {
+        index = NULL;
+    }
     ZoneChain orig_chain;
     const ZoneNode* node(NULL);
-    ZoneTree::Result result =
-         tree.find<void*>(origin_ls, &node, orig_chain, NULL, NULL);
+    ZoneTree::Result result = ZoneTree::EXACTMATCH;
+    if (index == NULL) {
+        result = tree.find<void*>(origin_ls, &node, orig_chain, NULL, NULL);
+    }
     if (result != ZoneTree::EXACTMATCH) {
         // If the origin node doesn't exist, simply fail.
         bundy_throw(DataSourceError,
@@ -972,35 +1098,43 @@ InMemoryZoneFinder::findNSEC3(const bundy::dns::Name& name, bool recursive) {
                   origin_ls << "/" << getClass());
     }
 
-    const boost::scoped_ptr<NSEC3Hash> hash
-        (NSEC3Hash::create(nsec3_data->hashalg,
-                           nsec3_data->iterations,
-                           nsec3_data->getSaltData(),
-                           nsec3_data->getSaltLen()));
-
     // Examine all names from the query name to the origin name, stripping
     // the deepest label one by one, until we find a name that has a matching
     // NSEC3 hash.
-    for (unsigned int labels = qlabels; labels >= olabels;
-         --labels, name_ls.stripLeft(1))
-    {
-        const std::string hlabel = hash->calculate(name_ls);
+    for (unsigned int labels = qlabels; labels >= olabels; --labels) {
+        const std::string& hlabel = hlabels[qlabels - labels];
 
         LOG_DEBUG(logger, DBG_TRACE_BASIC, DATASRC_MEMORY_FINDNSEC3_TRYHASH).
             arg(name).arg(labels).arg(hlabel);
 
-        node = NULL;
-        ZoneChain chain(orig_chain);
-
-        // Now, make a label sequence relative to the origin.
-        const Name hlabel_name(hlabel);
-        LabelSequence hlabel_ls(hlabel_name);
-        // Remove trailing '.' making it relative
-        hlabel_ls.stripRight(1);
-
-        // Find hlabel relative to the orig_chain.
-        result = tree.find<void*>(hlabel_ls, &node, chain, NULL, NULL);
-        if (result == ZoneTree::EXACTMATCH) {
+        bool exact;
+        if (index != NULL) {
+            node = index->find(&hashes[(qlabels - labels) *
+                                       index->getHashLength()], exact);
+        } else {
+            node = NULL;
+            ZoneChain chain(orig_chain);
+
+            // Now, make a label sequence relative to the origin.
+            const Name hlabel_name(hlabel);
+            LabelSequence hlabel_ls(hlabel_name);
+            // Remove trailing '.' making it relative
+            hlabel_ls.stripRight(1);
+
+            // Find hlabel relative to the orig_chain.
+            result = tree.find<void*>(hlabel_ls, &node, chain, NULL, NULL);
+            exact = (result == ZoneTree::EXACTMATCH);
+            if (!exact) {
+                while ((node = tree.previousNode(chain)) != NULL &&
+                       node->isEmpty()) {
+                    ;
+                }
+                if (node == NULL) {
+                    node = tree.largestNode();
+                }
+            }
+        }
+        if (exact) {
             // We found an exact match.
             ConstRRsetPtr closest = createNSEC3RRset(node, getClass());
             ConstRRsetPtr next;
@@ -1014,13 +1148,7 @@ InMemoryZoneFinder::findNSEC3(const bundy::dns::Name& name, bool recursive) {
 
             return (FindNSEC3Result(true, labels, closest, next));
         } else {
-            while ((covering_node = tree.previousNode(chain)) != NULL &&
-                   covering_node->isEmpty()) {
-                ;
-            }
-            if (covering_node == NULL) {
-                covering_node = tree.largestNode();
-            }
+            covering_node = node;
 
             if (!recursive) {   // in non recursive mode, we are done.
                 ConstRRsetPtr closest;
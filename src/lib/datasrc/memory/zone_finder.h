@@ -19,6 +19,7 @@
 #include <datasrc/memory/treenode_rrset.h>
 
 #include <datasrc/zone_finder.h>
+#include <dns/labelsequence.h>
 #include <dns/name.h>
 #include <dns/rrset.h>
 #include <dns/rrtype.h>
@@ -33,6 +34,8 @@ namespace internal {
 class ZoneFinderResultContext;
 }
 
+class ZoneNodeSampler;
+
 /// A derived zone finder class intended to be used with the memory data
 /// source, using ZoneData for its contents.
 class InMemoryZoneFinder : boost::noncopyable, public ZoneFinder {
@@ -48,10 +51,15 @@ public:
     ///
     /// \param zone_data The ZoneData containing the zone.
     /// \param rrclass The RR class of the zone
+    /// \param sampler If non NULL, the nodes found by \c find() and
+    /// \c findAll() are sampled by it.  The caller must keep it valid
+    /// while the finder is used.
     InMemoryZoneFinder(const ZoneData& zone_data,
-                       const bundy::dns::RRClass& rrclass) :
+                       const bundy::dns::RRClass& rrclass,
+                       ZoneNodeSampler* sampler = NULL) :
         zone_data_(zone_data),
-        rrclass_(rrclass)
+        rrclass_(rrclass),
+        sampler_(sampler)
     {}
 
     /// \brief Find an RRset in the datasource
@@ -94,6 +102,28 @@ public:
         return (rrclass_);
     }
 
+    /// \brief Identify the zone node of the additional records for a name.
+    ///
+    /// This is a helper for \c ZoneDataUpdater::setAdditionalNodes().  It
+    /// identifies the node whose records \c getAdditional() of a context
+    /// of this class returns for the given name in the RDATA of the given
+    /// RR type, so the node can be stored in the \c RdataSet on load (see
+    /// \c RdataSet::setAdditionalNode()).
+    ///
+    /// If the name is matched by a wildcard, the records have to be named
+    /// after it on each query, so the node isn't identified and this method
+    /// returns false.
+    ///
+    /// \param zone_data The zone to search.
+    /// \param type The RR type of the RDATA that has the name.
+    /// \param name_labels The name in the RDATA.
+    /// \param node Set to the identified node, or NULL if there are no
+    /// additional records for the name.  Undefined if it returns false.
+    /// \return true if the node is identified; false otherwise.
+    static bool findAdditionalNode(
+        const ZoneData& zone_data, const bundy::dns::RRType& type,
+        const bundy::dns::LabelSequence& name_labels, const ZoneNode** node);
+
 private:
     /// \brief In-memory version of finder context.
     ///
@@ -111,6 +141,7 @@ private:
 
     const ZoneData& zone_data_;
     const bundy::dns::RRClass rrclass_;
+    ZoneNodeSampler* const sampler_;
 };
 
 } // namespace memory
@@ -0,0 +1,320 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <datasrc/memory/zone_name_index.h>
+
+#include <util/memory_segment.h>
+#include <util/random/random_number_generator.h>
+
+#include <dns/labelsequence.h>
+#include <dns/name.h>
+
+#include <exceptions/exceptions.h>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/static_assert.hpp>
+
+#include <cstring>
+#include <limits>
+#include <new>                  // for the placement new
+#include <vector>
+
+using namespace bundy::dns;
+
+namespace bundy {
+namespace datasrc {
+namespace memory {
+
+// An entry of the hash table.  The hash value of the name is kept in the
+// slot itself, so we don't have to look into the record on most of the
+// collisions.
+struct ZoneNameIndex::Slot {
+    uint32_t hash;
+    // 1 + the position of the record in the record area in the unit of
+    // RECORD_ALIGN.  0 means the slot is unused.  Once used, a slot is
+    // never made unused again (see erase()).
+    uint32_t record_id;
+};
+
+// An indexed node.  The serialized form of the absolute label sequence
+// of the node's name immediately follows this structure (in the same way
+// as the labels of ZoneNode).  The node is NULL if the name has been
+// erased.
+struct ZoneNameIndex::Record {
+    explicit Record(const ZoneNode* node_param) : node(node_param) {}
+    const void* getLabelsData() const { return (this + 1); }
+
+    boost::interprocess::offset_ptr<const ZoneNode> node;
+};
+
+namespace {
+// Each record is placed at this alignment so the offset pointer in it is
+// properly aligned.
+const size_t RECORD_ALIGN = 8;
+
+size_t
+alignRecordLength(size_t len) {
+    return ((len + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1));
+}
+
+// Return the number of hash table slots that can be used for the given
+// capacity.  We keep the load factor at 2/3 at most so the probe sequences
+// are short, and ensure there's at least one unused slot so searching for
+// a non-indexed name always terminates.
+size_t
+getMaxSlotCount(uint32_t capacity) {
+    return ((static_cast<size_t>(capacity) - 1) * 2 / 3);
+}
+
+// Return the hash table size for the given number of names.
+uint32_t
+getCapacity(size_t name_count) {
+    const size_t min_capacity = name_count + name_count / 2 + 1;
+    if (min_capacity > (1U << 31)) {
+        bundy_throw(bundy::InvalidParameter,
+                    "Too many names for a zone name index: " << name_count);
+    }
+    uint32_t capacity = 1;
+    while (capacity < min_capacity) {
+        capacity <<= 1;
+    }
+    return (capacity);
+}
+
+// The spare room reserved for insert() on creation: 1/16 of the initial
+// names and their records, in addition to small constants so a nearly
+// empty zone can also be updated for a while.
+size_t
+getSpareNameCount(size_t name_count) {
+    return (name_count / 16 + 16);
+}
+
+size_t
+getSpareRecordsLength(size_t records_len) {
+    return (alignRecordLength(records_len / 16 + 2048));
+}
+}
+
+ZoneNameIndex::ZoneNameIndex(uint32_t seed, uint32_t capacity,
+                             size_t name_count, size_t records_len,
+                             size_t records_used) :
+    seed_(seed), capacity_(capacity), name_count_(name_count),
+    slot_count_(name_count), records_len_(records_len),
+    records_used_(records_used)
+{}
+
+size_t
+ZoneNameIndex::getAllocatedSize(uint32_t capacity, size_t records_len) {
+    return (sizeof(ZoneNameIndex) + sizeof(Slot) * capacity + records_len);
+}
+
+const ZoneNameIndex::Slot*
+ZoneNameIndex::getSlots() const {
+    return (reinterpret_cast<const Slot*>(this + 1));
+}
+
+ZoneNameIndex::Slot*
+ZoneNameIndex::getSlots() {
+    return (reinterpret_cast<Slot*>(this + 1));
+}
+
+const ZoneNameIndex::Record*
+ZoneNameIndex::getRecord(uint32_t record_id) const {
+    const uint8_t* records =
+        reinterpret_cast<const uint8_t*>(getSlots() + capacity_);
+    return (reinterpret_cast<const Record*>(
+                records + (record_id - 1) * RECORD_ALIGN));
+}
+
+ZoneNameIndex::Record*
+ZoneNameIndex::getRecord(uint32_t record_id) {
+    uint8_t* records = reinterpret_cast<uint8_t*>(getSlots() + capacity_);
+    return (reinterpret_cast<Record*>(records +
+                                      (record_id - 1) * RECORD_ALIGN));
+}
+
+ZoneNameIndex*
+ZoneNameIndex::create(util::MemorySegment& mem_sgmt, const ZoneTree& tree,
+                      const Name& origin)
+{
+    BOOST_STATIC_ASSERT(sizeof(Record) % RECORD_ALIGN == 0);
+    BOOST_STATIC_ASSERT(sizeof(ZoneNameIndex) % RECORD_ALIGN == 0);
+    BOOST_STATIC_ASSERT(sizeof(Slot) % RECORD_ALIGN == 0);
+
+    // First, collect the names to be indexed in the local memory.  This way
+    // we only allocate memory from the segment once, and if it throws
+    // MemorySegmentGrown nothing in the segment has been changed.
+    const uint32_t seed = util::random::UniformRandomIntegerGenerator(
+        0, std::numeric_limits<int>::max())();
+    std::vector<const ZoneNode*> nodes;
+    std::vector<uint32_t> hashes;
+    std::vector<size_t> offsets;
+    std::vector<uint8_t> records;
+
+    ZoneChain chain;
+    const ZoneNode* node = NULL;
+    if (tree.find(origin, &node, chain) != ZoneTree::EXACTMATCH) {
+        bundy_throw(bundy::Unexpected,
+                    "Zone origin is missing in the tree: " << origin);
+    }
+
+    // The name of the zone cut or DNAME whose subdomains are being
+    // iterated over, if any.  As we iterate in the DNSSEC order, all
+    // subdomains of a name come right after the name itself.
+    boost::scoped_ptr<Name> cut_name;
+    for (; node != NULL; node = tree.nextNode(chain)) {
+        const Name name(chain.getAbsoluteName());
+        if (cut_name) {
+            if (name.compare(*cut_name).getRelation() ==
+                NameComparisonResult::SUBDOMAIN) {
+                continue;
+            }
+            cut_name.reset();
+        }
+
+        if (!node->isEmpty()) {
+            const LabelSequence labels(name);
+            const size_t labels_len = labels.getSerializedLength();
+            const size_t offset = records.size();
+            records.resize(offset +
+                           alignRecordLength(sizeof(Record) + labels_len));
+            labels.serialize(&records[offset + sizeof(Record)], labels_len);
+            nodes.push_back(node);
+            hashes.push_back(labels.getFullHash(false, seed));
+            offsets.push_back(offset);
+        }
+
+        if (node->getFlag(ZoneNode::FLAG_CALLBACK)) {
+            cut_name.reset(new Name(name));
+        }
+    }
+
+    const uint32_t capacity =
+        getCapacity(nodes.size() + getSpareNameCount(nodes.size()));
+    const size_t records_len =
+        records.size() + getSpareRecordsLength(records.size());
+    if (records_len / RECORD_ALIGN >= std::numeric_limits<uint32_t>::max()) {
+        bundy_throw(bundy::InvalidParameter,
+                    "Too large names for a zone name index: " <<
+                    records.size() << " bytes");
+    }
+
+    void* p = mem_sgmt.allocate(getAllocatedSize(capacity, records_len));
+    ZoneNameIndex* index = new(p) ZoneNameIndex(seed, capacity, nodes.size(),
+                                                records_len, records.size());
+    Slot* slots = index->getSlots();
+    std::memset(slots, 0, sizeof(Slot) * capacity);
+    if (!records.empty()) {
+        std::memcpy(slots + capacity, &records[0], records.size());
+    }
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const uint32_t record_id = offsets[i] / RECORD_ALIGN + 1;
+        new(index->getRecord(record_id)) Record(nodes[i]);
+
+        uint32_t pos = hashes[i] & (capacity - 1);
+        while (slots[pos].record_id != 0) {
+            pos = (pos + 1) & (capacity - 1);
+        }
+        slots[pos].hash = hashes[i];
+        slots[pos].record_id = record_id;
+    }
+
+    return (index);
+}
+
+void
+ZoneNameIndex::destroy(util::MemorySegment& mem_sgmt, ZoneNameIndex* index) {
+    mem_sgmt.deallocate(index, getAllocatedSize(index->capacity_,
+                                                index->records_len_));
+}
+
+const ZoneNode*
+ZoneNameIndex::find(const LabelSequence& name) const {
+    const uint32_t hash = name.getFullHash(false, seed_);
+    const Slot* slots = getSlots();
+    for (uint32_t pos = hash & (capacity_ - 1);
+         slots[pos].record_id != 0;
+         pos = (pos + 1) & (capacity_ - 1)) {
+        if (slots[pos].hash == hash) {
+            const Record* record = getRecord(slots[pos].record_id);
+            if (LabelSequence(record->getLabelsData()).equals(name, false)) {
+                return (record->node.get());
+            }
+        }
+    }
+    return (NULL);
+}
+
+// Return the slot of the given name (including an erased one), or the
+// unused slot where the name would be placed.
+ZoneNameIndex::Slot*
+ZoneNameIndex::findSlot(const LabelSequence& name, uint32_t hash) {
+    Slot* slots = getSlots();
+    uint32_t pos = hash & (capacity_ - 1);
+    for (; slots[pos].record_id != 0; pos = (pos + 1) & (capacity_ - 1)) {
+        if (slots[pos].hash == hash &&
+            LabelSequence(getRecord(slots[pos].record_id)->getLabelsData()).
+            equals(name, false)) {
+            break;
+        }
+    }
+    return (&slots[pos]);
+}
+
+bool
+ZoneNameIndex::insert(const LabelSequence& name, const ZoneNode* node) {
+    const uint32_t hash = name.getFullHash(false, seed_);
+    Slot* slot = findSlot(name, hash);
+    if (slot->record_id != 0) {
+        Record* record = getRecord(slot->record_id);
+        if (!record->node) {
+            ++name_count_;
+        }
+        record->node = node;
+        return (true);
+    }
+
+    const size_t labels_len = name.getSerializedLength();
+    const size_t record_len = alignRecordLength(sizeof(Record) + labels_len);
+    if (slot_count_ + 1 > getMaxSlotCount(capacity_) ||
+        records_used_ + record_len > records_len_) {
+        return (false);
+    }
+    const uint32_t record_id = records_used_ / RECORD_ALIGN + 1;
+    Record* record = new(getRecord(record_id)) Record(node);
+    name.serialize(record + 1, labels_len);
+    records_used_ += record_len;
+    slot->hash = hash;
+    slot->record_id = record_id;
+    ++slot_count_;
+    ++name_count_;
+    return (true);
+}
+
+void
+ZoneNameIndex::erase(const LabelSequence& name) {
+    // The slot is kept used so it won't break the probe sequence of others.
+    Slot* slot = findSlot(name, name.getFullHash(false, seed_));
+    if (slot->record_id != 0) {
+        Record* record = getRecord(slot->record_id);
+        if (record->node) {
+            record->node = NULL;
+            --name_count_;
+        }
+    }
+}
+
+} // namespace memory
+} // namespace datasrc
+} // namespace bundy
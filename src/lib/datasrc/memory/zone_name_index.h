@@ -0,0 +1,183 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef DATASRC_MEMORY_ZONE_NAME_INDEX_H
+#define DATASRC_MEMORY_ZONE_NAME_INDEX_H 1
+
+#include <util/memory_segment.h>
+
+#include <dns/labelsequence.h>
+#include <dns/name.h>
+
+#include <datasrc/memory/zone_data.h>
+
+#include <boost/interprocess/offset_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace datasrc {
+namespace memory {
+
+/// \brief Hash index for exact-match lookups of zone names.
+///
+/// This class maps absolute owner names of a zone to the corresponding
+/// \c ZoneNode of the zone's \c ZoneTree by an open-addressing hash
+/// table, so that the node for an existing name can be identified without
+/// walking through the tree.
+///
+/// Not all nodes of the tree are indexed.  The index only contains nodes
+/// that have some data and are not below a zone cut or a DNAME, i.e.,
+/// none of their ancestors in the zone has \c ZoneNode::FLAG_CALLBACK.
+/// For any name found in the index it's therefore ensured that
+/// \c ZoneTree::find() would result in an exact match of the same node
+/// without encountering any delegation on the way.  Other names,
+/// including empty non-terminals, glue records, wildcard matches and
+/// non-existent names, still have to be looked up in the tree.
+///
+/// An object of this class is stored in a single region allocated from
+/// a \c MemorySegment, which consists of this class object, the hash
+/// table and the names of the indexed nodes (the latter two immediately
+/// follow the object).  Just like \c ZoneData, node pointers are stored as
+/// offset pointers, so it can be placed in a shared or mapped memory
+/// segment.
+///
+/// The index refers to nodes of the tree, so it has to be kept consistent
+/// with the tree when the zone is modified.  Since a subset of the names
+/// described above is still a valid index, small modifications (such as
+/// the ones from a dynamic update or IXFR) can be reflected with
+/// \c insert() and \c erase() in place; the index reserves some spare
+/// room for the former when it's created.  Other modifications, such as
+/// adding a zone cut above indexed names or running out of the spare
+/// room, need the index to be destroyed and rebuilt.  It's the
+/// responsibility of the user (normally \c ZoneDataUpdater) to choose and
+/// perform the appropriate action.
+class ZoneNameIndex : boost::noncopyable {
+private:
+    /// \brief The constructor.
+    ///
+    /// An object of this class is always expected to be created by the
+    /// allocator (\c create()), so the constructor is hidden as private.
+    ZoneNameIndex(uint32_t seed, uint32_t capacity, size_t name_count,
+                  size_t records_len, size_t records_used);
+
+public:
+    /// \brief Allocate and construct \c ZoneNameIndex for the given tree.
+    ///
+    /// It iterates over the entire \c tree to identify the nodes to be
+    /// indexed (see the class description), and builds the index of them.
+    ///
+    /// \throw util::MemorySegmentGrown The memory segment has grown, possibly
+    ///     relocating data.  The segment is not modified in this case.
+    /// \throw std::bad_alloc Memory allocation fails.
+    /// \throw bundy::Unexpected The tree doesn't contain \c origin.
+    ///
+    /// \param mem_sgmt A \c MemorySegment from which memory for the new
+    /// \c ZoneNameIndex is allocated.
+    /// \param tree The tree of the zone to be indexed.
+    /// \param origin The origin name of the zone.
+    static ZoneNameIndex* create(util::MemorySegment& mem_sgmt,
+                                 const ZoneTree& tree,
+                                 const dns::Name& origin);
+
+    /// \brief Destruct and deallocate \c ZoneNameIndex.
+    ///
+    /// \throw none
+    ///
+    /// \param mem_sgmt The \c MemorySegment that allocated memory for
+    /// \c index.
+    /// \param index A non-NULL pointer to a valid ZoneNameIndex object
+    /// that was originally created by the \c create() method.
+    static void destroy(util::MemorySegment& mem_sgmt, ZoneNameIndex* index);
+
+    /// \brief Find the node of the given name in the index.
+    ///
+    /// Names are compared case-insensitively, as in \c ZoneTree.
+    ///
+    /// \throw none
+    ///
+    /// \param name An absolute label sequence of the name to be found.
+    /// \return The indexed node of the name, or NULL if it's not indexed.
+    const ZoneNode* find(const dns::LabelSequence& name) const;
+
+    /// \brief Add a node to the index.
+    ///
+    /// If \c name is already in the index, its node is replaced with
+    /// \c node.  The caller must ensure \c node meets the conditions of
+    /// indexed nodes (see the class description).
+    ///
+    /// This method doesn't allocate any memory; it returns false if
+    /// there's no spare room for a new name, in which case the index is
+    /// still valid but doesn't contain \c name.
+    ///
+    /// \throw none
+    ///
+    /// \param name An absolute label sequence of the name of \c node.
+    /// \param node The node to be indexed.
+    /// \return true if the node is indexed; false otherwise.
+    bool insert(const dns::LabelSequence& name, const ZoneNode* node);
+
+    /// \brief Remove a name from the index.
+    ///
+    /// This must be called before the node of an indexed name is removed
+    /// from the tree or gets empty.  It does nothing if \c name isn't in
+    /// the index.  The space for the name isn't reclaimed, but can be
+    /// reused if the same name is inserted again.
+    ///
+    /// \throw none
+    ///
+    /// \param name An absolute label sequence of the name to be removed.
+    void erase(const dns::LabelSequence& name);
+
+    /// \brief Return the number of indexed names.
+    ///
+    /// \throw none
+    size_t getNameCount() const { return (name_count_); }
+
+    /// \brief Return the memory allocated for the index, in bytes.
+    ///
+    /// \throw none
+    size_t getAllocatedSize() const {
+        return (getAllocatedSize(capacity_, records_len_));
+    }
+
+private:
+    struct Slot;
+    struct Record;
+
+    static size_t getAllocatedSize(uint32_t capacity, size_t records_len);
+    Slot* findSlot(const dns::LabelSequence& name, uint32_t hash);
+    const Slot* getSlots() const;
+    Slot* getSlots();
+    const Record* getRecord(uint32_t record_id) const;
+    Record* getRecord(uint32_t record_id);
+
+    const uint32_t seed_;
+    const uint32_t capacity_;   // always a power of 2
+    size_t name_count_;
+    uint32_t slot_count_;       // used slots, including erased names
+    const size_t records_len_;
+    size_t records_used_;
+};
+
+} // namespace memory
+} // namespace datasrc
+} // namespace bundy
+
+#endif // DATASRC_MEMORY_ZONE_NAME_INDEX_H
+
+// Local Variables:
+// mode: c++
+// End:
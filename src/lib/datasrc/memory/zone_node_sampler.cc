@@ -0,0 +1,139 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <datasrc/memory/zone_node_sampler.h>
+
+#include <dns/labelsequence.h>
+
+#include <util/buffer.h>
+
+#include <exceptions/exceptions.h>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+
+using namespace bundy::dns;
+using bundy::util::thread::Mutex;
+
+namespace bundy {
+namespace datasrc {
+namespace memory {
+
+namespace {
+Name
+getAbsoluteName(const ZoneNode* node) {
+    uint8_t labels_buf[LabelSequence::MAX_SERIALIZED_LENGTH];
+    const LabelSequence labels = node->getAbsoluteLabels(labels_buf);
+    size_t data_len;
+    const uint8_t* data = labels.getData(&data_len);
+    util::InputBuffer buffer(data, data_len);
+    return (Name(buffer));
+}
+
+bool
+compareCounts(const ZoneNodeSampler::HotName& lhs,
+              const ZoneNodeSampler::HotName& rhs)
+{
+    return (lhs.count > rhs.count);
+}
+}
+
+ZoneNodeSampler::ZoneNodeSampler(size_t rate, size_t max_names) :
+    rate_(rate), max_names_(max_names), lookups_(0)
+{
+    if (rate_ == 0) {
+        bundy_throw(BadValue, "zone node sampling rate must be positive");
+    }
+    if (max_names_ == 0) {
+        bundy_throw(BadValue, "zone node sampler must count some names");
+    }
+}
+
+void
+ZoneNodeSampler::record(const ZoneData& zone_data, const ZoneNode* node) {
+    // Names are built outside the lock; this is only done for the sampled
+    // lookups.
+    const Counts::key_type key(getAbsoluteName(zone_data.getOriginNode()),
+                               getAbsoluteName(node));
+    Mutex::Locker locker(mutex_);
+    Counts::iterator it = counts_.find(key);
+    if (it != counts_.end()) {
+        ++it->second;
+    } else if (counts_.size() < max_names_) {
+        counts_.insert(Counts::value_type(key, 1));
+    }
+}
+
+ZoneNodeSampler::HotNames
+ZoneNodeSampler::getHotNames(size_t max_count) const {
+    HotNames names;
+    {
+        Mutex::Locker locker(mutex_);
+        names.reserve(counts_.size());
+        for (Counts::const_iterator it = counts_.begin();
+             it != counts_.end();
+             ++it) {
+            names.push_back(HotName(it->first.first, it->first.second,
+                                    it->second));
+        }
+    }
+    // Keep the DNSSEC order of names with the same count, so the result
+    // is stable.
+    std::stable_sort(names.begin(), names.end(), compareCounts);
+    if (max_count != 0 && names.size() > max_count) {
+        names.erase(names.begin() + max_count, names.end());
+    }
+    return (names);
+}
+
+void
+ZoneNodeSampler::clear() {
+    Mutex::Locker locker(mutex_);
+    counts_.clear();
+    lookups_ = 0;
+}
+
+void
+ZoneNodeSampler::writeHotNames(std::ostream& os, const HotNames& names) {
+    for (HotNames::const_iterator it = names.begin(); it != names.end();
+         ++it) {
+        os << it->zone << " " << it->name << " " << it->count << "\n";
+    }
+}
+
+std::vector<Name>
+ZoneNodeSampler::readHotNames(std::istream& is, const Name& zone_name) {
+    std::vector<Name> names;
+    std::string line;
+    while (std::getline(is, line)) {
+        std::istringstream iss(line);
+        std::string zone_text, name_text;
+        uint64_t count;
+        if (!(iss >> zone_text)) {
+            continue;           // empty line
+        }
+        if (!(iss >> name_text >> count)) {
+            bundy_throw(BadValue, "bad line of hot names: " << line);
+        }
+        if (Name(zone_text) == zone_name) {
+            names.push_back(Name(name_text));
+        }
+    }
+    return (names);
+}
+
+} // namespace memory
+} // namespace datasrc
+} // namespace bundy
@@ -0,0 +1,159 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef DATASRC_MEMORY_ZONE_NODE_SAMPLER_H
+#define DATASRC_MEMORY_ZONE_NODE_SAMPLER_H 1
+
+#include <datasrc/memory/zone_data.h>
+
+#include <dns/name.h>
+
+#include <util/threads/sync.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace datasrc {
+namespace memory {
+
+/// \brief Sampler of the zone nodes found by \c InMemoryZoneFinder.
+///
+/// It counts how often the names of the zones of a data source are
+/// found by queries, by looking at one of every given number of lookups,
+/// so that the most frequently queried names can be identified without
+/// slowing down the lookups much.  The names can then be given to
+/// \c ZoneDataLoader, which packs their nodes together in memory when the
+/// zones are loaded again (see \c ZoneDataUpdater::relayout()).  As the
+/// loader normally runs in a different process (the memory manager), they
+/// are passed through a file, with \c writeHotNames() and
+/// \c readHotNames().
+///
+/// Names are counted by their absolute names, not by the nodes, so the
+/// counts remain valid if the zones are reloaded or the memory segment is
+/// remapped.
+///
+/// This class is thread safe: \c sample() can be called from multiple
+/// threads looking up the zones, while the counts are retrieved.
+class ZoneNodeSampler : boost::noncopyable {
+public:
+    /// \brief A name and its sampled count.
+    struct HotName {
+        HotName(const dns::Name& zone_param, const dns::Name& name_param,
+                uint64_t count_param) :
+            zone(zone_param), name(name_param), count(count_param)
+        {}
+        dns::Name zone;         ///< The origin of the zone of the name
+        dns::Name name;         ///< The name
+        uint64_t count;         ///< The number of samples of the name
+    };
+    typedef std::vector<HotName> HotNames;
+
+    /// \brief Constructor.
+    ///
+    /// \throw bundy::BadValue \c rate or \c max_names is 0.
+    ///
+    /// \param rate One of this number of lookups is sampled.
+    /// \param max_names The maximum number of different names to be
+    /// counted.  Once it's reached, only the names already counted are.
+    ZoneNodeSampler(size_t rate, size_t max_names);
+
+    /// \brief Sample a lookup of a zone node.
+    ///
+    /// It counts the name of \c node if it's the one of every \c rate
+    /// lookups to be sampled.  Otherwise it just counts the lookup.
+    ///
+    /// \throw std::bad_alloc Memory allocation fails.
+    ///
+    /// \param zone_data The zone the node was found in.
+    /// \param node The node found by the lookup.
+    void sample(const ZoneData& zone_data, const ZoneNode* node) {
+        if (lookups_.fetch_add(1, std::memory_order_relaxed) % rate_ == 0) {
+            record(zone_data, node);
+        }
+    }
+
+    /// \brief Return the sampling rate given on construction.
+    ///
+    /// \throw none
+    size_t getRate() const { return (rate_); }
+
+    /// \brief Return the most frequently sampled names.
+    ///
+    /// The names are ordered by their counts, the largest first.
+    ///
+    /// \throw std::bad_alloc Memory allocation fails.
+    ///
+    /// \param max_count The maximum number of names to be returned; if 0,
+    /// all sampled names are returned.
+    HotNames getHotNames(size_t max_count = 0) const;
+
+    /// \brief Forget all sampled names.
+    ///
+    /// \throw none
+    void clear();
+
+    /// \brief Write the given names to a stream.
+    ///
+    /// Each name is written in a line of the zone origin, the name and its
+    /// count, separated by a space, in the given order.
+    ///
+    /// \throw std::bad_alloc Memory allocation fails.
+    static void writeHotNames(std::ostream& os, const HotNames& names);
+
+    /// \brief Read the names of a zone written by \c writeHotNames().
+    ///
+    /// It returns the names of the lines whose zone origin is
+    /// \c zone_name, in the order they were written.  Other lines and
+    /// empty lines are skipped.
+    ///
+    /// \throw bundy::BadValue A line is not in the expected format.
+    /// \throw Other Exceptions from the \c dns::Name constructor for a
+    ///     bad name.
+    ///
+    /// \param is The stream to read from.
+    /// \param zone_name The origin of the zone of the names to be read.
+    /// \return The names of the zone.
+    static std::vector<dns::Name> readHotNames(std::istream& is,
+                                               const dns::Name& zone_name);
+
+private:
+    void record(const ZoneData& zone_data, const ZoneNode* node);
+
+    typedef std::map<std::pair<dns::Name, dns::Name>, uint64_t> Counts;
+
+    const size_t rate_;
+    const size_t max_names_;
+    std::atomic<size_t> lookups_;
+    mutable util::thread::Mutex mutex_;
+    Counts counts_;
+};
+
+} // namespace memory
+} // namespace datasrc
+} // namespace bundy
+
+#endif // DATASRC_MEMORY_ZONE_NODE_SAMPLER_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -16,6 +16,7 @@
 
 #include <datasrc/memory/zone_table_segment.h>
 #include <datasrc/memory/zone_table_segment_local.h>
+#include <datasrc/memory/zone_data.h>
 #ifdef USE_SHARED_MEMORY
 #include <datasrc/memory/zone_table_segment_mapped.h>
 #endif
@@ -24,18 +25,58 @@
 #include <string>
 
 using namespace bundy::dns;
+using boost::interprocess::offset_ptr;
 
 namespace bundy {
 namespace datasrc {
 namespace memory {
 
+struct ZoneTableHeader::RetiredZoneData {
+    RetiredZoneData(ZoneData* data, RetiredZoneData* next) :
+        data_(data), next_(next)
+    {}
+
+    offset_ptr<ZoneData> data_;
+    offset_ptr<RetiredZoneData> next_;
+};
+
+void
+ZoneTableHeader::retireZoneData(util::MemorySegment& mem_sgmt,
+                                ZoneData* zone_data)
+{
+    void* p = mem_sgmt.allocate(sizeof(RetiredZoneData));
+    retired_ = new(p) RetiredZoneData(zone_data, retired_.get());
+}
+
+void
+ZoneTableHeader::destroyRetiredZoneData(util::MemorySegment& mem_sgmt,
+                                        const RRClass& rrclass)
+{
+    while (retired_) {
+        RetiredZoneData* const retired = retired_.get();
+        retired_ = retired->next_;
+        ZoneData::destroy(mem_sgmt, retired->data_.get(), rrclass);
+        mem_sgmt.deallocate(retired, sizeof(RetiredZoneData));
+    }
+}
+
+size_t
+ZoneTableHeader::getRetiredZoneDataCount() const {
+    size_t count = 0;
+    for (const RetiredZoneData* retired = retired_.get(); retired != NULL;
+         retired = retired->next_.get()) {
+        ++count;
+    }
+    return (count);
+}
+
 ZoneTableSegment*
 ZoneTableSegment::create(const RRClass& rrclass, const std::string& type) {
     // This will be a few sequences of if-else and hardcoded.  Not really
     // sophisticated, but we don't expect to have too many types at the moment.
     // Until that it becomes a real issue we won't be too smart.
-    if (type == "local") {
-        return (new ZoneTableSegmentLocal(rrclass));
+    if (type == "local" || type == "local-slab") {
+        return (new ZoneTableSegmentLocal(rrclass, type));
 #ifdef USE_SHARED_MEMORY
     } else if (type == "mapped") {
         return (new ZoneTableSegmentMapped(rrclass));
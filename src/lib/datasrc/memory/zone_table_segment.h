@@ -78,11 +78,14 @@ public:
 ///
 /// An instance of this type lives inside a \c ZoneTableSegment
 /// implementation. It contains an offset pointer to the \c ZoneTable (a
-/// map from domain names to zone locators) in the \c ZoneTableSegment.
+/// map from domain names to zone locators) in the \c ZoneTableSegment,
+/// and the list of zone data that have been replaced in the table but may
+/// still be used by readers of the segment (see
+/// \c ZoneTableSegment::isSharedWithReaders()).
 struct ZoneTableHeader {
 public:
     ZoneTableHeader(ZoneTable* zone_table) :
-        table_(zone_table)
+        table_(zone_table), retired_(NULL)
     {}
 
     /// \brief Returns a pointer to the underlying zone table.
@@ -94,8 +97,39 @@ public:
     const ZoneTable* getTable() const {
         return (table_.get());
     }
+
+    /// \brief Keep zone data replaced in the table until they're released.
+    ///
+    /// The zone data will be destroyed by \c destroyRetiredZoneData().
+    /// The memory needed to remember them is allocated from \c mem_sgmt;
+    /// if the allocation throws, including \c MemorySegmentGrown, nothing
+    /// is changed.
+    ///
+    /// \throw std::bad_alloc, bundy::util::MemorySegmentGrown see above.
+    ///
+    /// \param mem_sgmt The memory segment the header and the data are in.
+    /// \param zone_data The zone data to retire; must not be NULL.
+    void retireZoneData(util::MemorySegment& mem_sgmt, ZoneData* zone_data);
+
+    /// \brief Destroy all the zone data retired so far.
+    ///
+    /// \throw None
+    ///
+    /// \param mem_sgmt The memory segment the header and the data are in.
+    /// \param rrclass The RR class of the zone data.
+    void destroyRetiredZoneData(util::MemorySegment& mem_sgmt,
+                                const bundy::dns::RRClass& rrclass);
+
+    /// \brief Return the number of zone data retired and not yet destroyed.
+    ///
+    /// \throw None
+    size_t getRetiredZoneDataCount() const;
+
 private:
+    struct RetiredZoneData;
+
     boost::interprocess::offset_ptr<ZoneTable> table_;
+    boost::interprocess::offset_ptr<RetiredZoneData> retired_;
 };
 
 /// \brief Manages a \c ZoneTableHeader, an entry point into a table of
@@ -175,6 +209,23 @@ public:
     /// exception-free.
     virtual bool isWritable() const = 0;
 
+    /// \brief Return true if readers may be using the segment while it's
+    /// written.
+    ///
+    /// In such a segment the zone data in the zone table must neither be
+    /// modified nor destroyed, and no zone can be added to the table.  The
+    /// writer (see \c ZoneWriter) builds new zone data from scratch,
+    /// replaces the old data in the table with them, and retires the old
+    /// data in the \c ZoneTableHeader.  The derived class destroys the
+    /// retired data once the readers are known to have stopped using them.
+    ///
+    /// The default implementation returns false.
+    ///
+    /// \throw None
+    virtual bool isSharedWithReaders() const {
+        return (false);
+    }
+
     /// \brief Create an instance depending on the requested memory
     /// segment implementation type.
     ///
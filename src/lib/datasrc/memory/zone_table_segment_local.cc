@@ -13,6 +13,7 @@
 // PERFORMANCE OF THIS SOFTWARE.
 
 #include <datasrc/memory/zone_table_segment_local.h>
+#include <util/memory_segment_slab.h>
 
 using namespace bundy::dns;
 using namespace bundy::util;
@@ -21,10 +22,23 @@ namespace bundy {
 namespace datasrc {
 namespace memory {
 
-ZoneTableSegmentLocal::ZoneTableSegmentLocal(const RRClass& rrclass) :
+namespace {
+MemorySegmentLocal*
+createMemorySegment(const std::string& type) {
+    if (type == "local-slab") {
+        return (new MemorySegmentSlab);
+    }
+    assert(type == "local");
+    return (new MemorySegmentLocal);
+}
+}
+
+ZoneTableSegmentLocal::ZoneTableSegmentLocal(const RRClass& rrclass,
+                                             const std::string& type) :
     ZoneTableSegment(rrclass),
-    impl_type_("local"),
-    header_(ZoneTable::create(mem_sgmt_, rrclass))
+    impl_type_(type),
+    mem_sgmt_(createMemorySegment(type)),
+    header_(ZoneTable::create(*mem_sgmt_, rrclass))
 {
 }
 
@@ -34,8 +48,8 @@ ZoneTableSegmentLocal::~ZoneTableSegmentLocal() {
     // it's probably better to find more leaks initially.  Once it's stabilized
     // we should probably revisit it.
 
-    ZoneTable::destroy(mem_sgmt_, header_.getTable());
-    assert(mem_sgmt_.allMemoryDeallocated());
+    ZoneTable::destroy(*mem_sgmt_, header_.getTable());
+    assert(mem_sgmt_->allMemoryDeallocated());
 }
 
 const std::string&
@@ -75,7 +89,7 @@ ZoneTableSegmentLocal::getHeader() const {
 
 MemorySegment&
 ZoneTableSegmentLocal::getMemorySegment() {
-     return (mem_sgmt_);
+     return (*mem_sgmt_);
 }
 
 } // namespace memory
@@ -18,6 +18,8 @@
 #include <datasrc/memory/zone_table_segment.h>
 #include <util/memory_segment_local.h>
 
+#include <boost/scoped_ptr.hpp>
+
 #include <string>
 
 namespace bundy {
@@ -29,6 +31,10 @@ namespace memory {
 /// This class specifies a concrete implementation for a
 /// \c MemorySegmentLocal -based \c ZoneTableSegment. Please see the
 /// \c ZoneTableSegment class documentation for usage.
+///
+/// The "local-slab" type of segment uses \c MemorySegmentSlab instead,
+/// which serves the many small allocations of the zone data from large
+/// chunks and releases them all at once when the segment is destroyed.
 class ZoneTableSegmentLocal : public ZoneTableSegment {
     // This is so that \c ZoneTableSegmentLocal can be instantiated from
     // \c ZoneTableSegment::create().
@@ -40,13 +46,17 @@ protected:
     /// Instances are expected to be created by the factory method
     /// (\c ZoneTableSegment::create()), so this constructor is
     /// protected.
-    ZoneTableSegmentLocal(const bundy::dns::RRClass& rrclass);
+    ///
+    /// \param rrclass The RR class of the zones to be maintained in the table.
+    /// \param type The implementation type, "local" or "local-slab".
+    ZoneTableSegmentLocal(const bundy::dns::RRClass& rrclass,
+                          const std::string& type = "local");
 
 public:
     /// \brief Destructor
     virtual ~ZoneTableSegmentLocal();
 
-    /// \brief Returns "local" as the implementation type.
+    /// \brief Returns "local" or "local-slab" as the implementation type.
     virtual const std::string& getImplType() const;
 
     /// \brief Return the \c ZoneTableHeader for this local zone table
@@ -57,7 +67,8 @@ public:
     virtual const ZoneTableHeader& getHeader() const;
 
     /// \brief Return the \c MemorySegment for the local zone table
-    /// segment implementation (a \c MemorySegmentLocal instance).
+    /// segment implementation (a \c MemorySegmentLocal or
+    /// \c MemorySegmentSlab instance).
     virtual bundy::util::MemorySegment& getMemorySegment();
 
     /// \brief Return true if the segment is writable.
@@ -95,7 +106,7 @@ public:
 
 private:
     std::string impl_type_;
-    bundy::util::MemorySegmentLocal mem_sgmt_;
+    boost::scoped_ptr<bundy::util::MemorySegmentLocal> mem_sgmt_;
     ZoneTableHeader header_;
 };
 
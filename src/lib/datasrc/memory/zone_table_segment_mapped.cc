@@ -17,7 +17,11 @@
 #include <datasrc/memory/segment_object_holder.h>
 #include <datasrc/memory/logger.h>
 
+#include <boost/lexical_cast.hpp>
+
+#include <algorithm>
 #include <memory>
+#include <thread>
 
 using namespace bundy::data;
 using namespace bundy::dns;
@@ -36,13 +40,32 @@ const char* const ZONE_TABLE_CHECKSUM_NAME = "zone_table_checksum";
 // The name with which the zone table header is associated in the segment.
 const char* const ZONE_TABLE_HEADER_NAME = "zone_table_header";
 
+// The name with which the image format version is associated in the segment.
+const char* const ZONE_TABLE_VERSION_NAME = "zone_table_version";
+
+// Each thread computing the checksum reads at least this much of the
+// segment; smaller segments are read by a single thread.
+const size_t CHECKSUM_BYTES_PER_THREAD = 256 * 1024 * 1024;
+
+// The number of threads used to compute the checksum of the segment.
+size_t
+getCheckSumThreads(const MemorySegmentMapped& segment) {
+    const size_t threads =
+        segment.getSize() / CHECKSUM_BYTES_PER_THREAD + 1;
+    const size_t max_threads = std::thread::hardware_concurrency();
+    return (max_threads > 0 ? std::min(threads, max_threads) : 1);
+}
+
 } // end of unnamed namespace
 
+const uint32_t ZoneTableSegmentMapped::IMAGE_VERSION;
+
 ZoneTableSegmentMapped::ZoneTableSegmentMapped(const RRClass& rrclass) :
     ZoneTableSegment(rrclass),
     impl_type_("mapped"),
     rrclass_(rrclass),
     current_mode_(CREATE), // not matter until usable, but init it explicitly
+    shared_with_readers_(false), // ditto
     cached_ro_header_(NULL)     // ditto
 {
 }
@@ -78,7 +101,8 @@ ZoneTableSegmentMapped::processChecksum(MemorySegmentMapped& segment,
             // First, clear the checksum so that getCheckSum() returns a
             // consistent value.
             *checksum = 0;
-            const size_t new_checksum = segment.getCheckSum();
+            const size_t new_checksum = segment.getCheckSum(
+                getCheckSumThreads(segment));
             if (saved_checksum != new_checksum) {
                 error_msg = "Saved checksum doesn't match segment data";
                 return (false);
@@ -150,9 +174,68 @@ ZoneTableSegmentMapped::processHeader(MemorySegmentMapped& segment,
     return (true);
 }
 
+bool
+ZoneTableSegmentMapped::processVersion(MemorySegmentMapped& segment,
+                                       bool create, bool has_allocations,
+                                       std::string& error_msg)
+{
+    const MemorySegment::NamedAddressResult result =
+        segment.getNamedAddress(ZONE_TABLE_VERSION_NAME);
+    if (result.first) {
+        if (create) {
+            // There must be no previously saved version.
+            error_msg = "There is already a saved image version in the "
+                 "segment opened in create mode";
+            return (false);
+        }
+        assert(result.second);
+        return (checkVersion(*static_cast<const uint32_t*>(result.second),
+                             error_msg));
+    }
+    if ((!create) && has_allocations) {
+        // Same as the checksum and the header: an existing segment
+        // without the version is either corrupted or of an unknown format.
+        error_msg = "Existing segment is missing an image version name";
+        return (false);
+    }
+
+    void* version = NULL;
+    while (!version) {
+        try {
+            version = segment.allocate(sizeof(uint32_t));
+        } catch (const MemorySegmentGrown&) {
+            // Do nothing and try again.
+        }
+    }
+    *static_cast<uint32_t*>(version) = IMAGE_VERSION;
+    segment.setNamedAddress(ZONE_TABLE_VERSION_NAME, version);
+
+    return (true);
+}
+
+bool
+ZoneTableSegmentMapped::checkVersion(uint32_t version, std::string& error_msg)
+{
+    if (version != IMAGE_VERSION) {
+        error_msg = "Unsupported image version " +
+            boost::lexical_cast<std::string>(version) + " (expected " +
+            boost::lexical_cast<std::string>(IMAGE_VERSION) + ")";
+        return (false);
+    }
+    return (true);
+}
+
+namespace {
+bool
+isConcurrent(int mapping_flags) {
+    return ((mapping_flags & MemorySegmentMapped::MAPPING_CONCURRENT) != 0);
+}
+}
+
 MemorySegmentMapped*
 ZoneTableSegmentMapped::openReadWrite(const std::string& filename,
-                                      bool create)
+                                      bool create, int mapping_flags,
+                                      bool& has_allocations)
 {
     const MemorySegmentMapped::OpenMode mode = create ?
          MemorySegmentMapped::CREATE_ONLY :
@@ -160,14 +243,26 @@ ZoneTableSegmentMapped::openReadWrite(const std::string& filename,
     // In case there is a problem, we throw. We want the segment to be
     // automatically destroyed then.
     std::unique_ptr<MemorySegmentMapped> segment
-        (new MemorySegmentMapped(filename, mode));
+        (new MemorySegmentMapped(filename, mode,
+                                 MemorySegmentMapped::INITIAL_SIZE,
+                                 mapping_flags));
 
     // This flag is used inside processCheckSum() and processHeader(),
     // and must be initialized before we make any further allocations.
-    const bool has_allocations = !segment->allMemoryDeallocated();
+    // allMemoryDeallocated() can't be used if readers may be using the
+    // image, in which case we tell an existing image by its named addresses.
+    if (isConcurrent(mapping_flags)) {
+        has_allocations =
+            segment->getNamedAddress(ZONE_TABLE_CHECKSUM_NAME).first ||
+            segment->getNamedAddress(ZONE_TABLE_VERSION_NAME).first ||
+            segment->getNamedAddress(ZONE_TABLE_HEADER_NAME).first;
+    } else {
+        has_allocations = !segment->allMemoryDeallocated();
+    }
 
     std::string error_msg;
     if ((!processChecksum(*segment, create, has_allocations, error_msg)) ||
+        (!processVersion(*segment, create, has_allocations, error_msg)) ||
         (!processHeader(*segment, create, has_allocations, error_msg))) {
          if (mem_sgmt_) {
               bundy_throw(ResetFailed,
@@ -180,22 +275,44 @@ ZoneTableSegmentMapped::openReadWrite(const std::string& filename,
          }
     }
 
+    // The zone data retired by the previous writer of a shared image are no
+    // longer used by the readers (see reset()).
+    if (isConcurrent(mapping_flags) && has_allocations) {
+        static_cast<ZoneTableHeader*>(
+            segment->getNamedAddress(ZONE_TABLE_HEADER_NAME).second)->
+            destroyRetiredZoneData(*segment, rrclass_);
+    }
+
     return (segment.release());
 }
 
 MemorySegmentMapped*
-ZoneTableSegmentMapped::openReadOnly(const std::string& filename) {
+ZoneTableSegmentMapped::openReadOnly(const std::string& filename,
+                                     int mapping_flags)
+{
     // In case the checksum or table header is missing, we throw. We
     // want the segment to be automatically destroyed then.
     std::unique_ptr<MemorySegmentMapped> segment
-        (new MemorySegmentMapped(filename));
+        (new MemorySegmentMapped(filename, mapping_flags));
     // There must be a previously saved checksum.
     MemorySegment::NamedAddressResult result =
         segment->getNamedAddress(ZONE_TABLE_CHECKSUM_NAME);
+    std::string error_msg;
     if (!result.first) {
-         const std::string error_msg =
-             "There is no previously saved checksum in a "
-             "mapped segment opened in read-only mode";
+        error_msg = "There is no previously saved checksum in a "
+            "mapped segment opened in read-only mode";
+    } else {
+        // The image must be of the format we know.
+        result = segment->getNamedAddress(ZONE_TABLE_VERSION_NAME);
+        if (!result.first) {
+            error_msg = "There is no previously saved image version in a "
+                "mapped segment opened in read-only mode";
+        } else {
+            checkVersion(*static_cast<const uint32_t*>(result.second),
+                         error_msg);
+        }
+    }
+    if (!error_msg.empty()) {
          if (mem_sgmt_) {
               bundy_throw(ResetFailed,
                         "Error in resetting zone table segment to use "
@@ -216,8 +333,7 @@ ZoneTableSegmentMapped::openReadOnly(const std::string& filename) {
     if (result.first) {
         assert(result.second);
     } else {
-         const std::string error_msg =
-             "There is no previously saved ZoneTableHeader in a "
+         error_msg = "There is no previously saved ZoneTableHeader in a "
              "mapped segment opened in read-only mode.";
          if (mem_sgmt_) {
               bundy_throw(ResetFailed,
@@ -248,6 +364,44 @@ modeString(ZoneTableSegment::MemorySegmentOpenMode mode) {
         return ("unknown"); // we could assert here, but maybe not worth it.
     }
 }
+
+// Convert the optional mapping options in the reset() parameters to
+// MemorySegmentMapped::MappingFlags.
+int
+getMappingFlagsParam(const ConstElementPtr& params) {
+    const struct {
+        const char* const name;
+        const int flag;
+    } options[] = {
+        { "huge-pages", MemorySegmentMapped::MAPPING_HUGE_PAGES },
+        { "prefault", MemorySegmentMapped::MAPPING_PREFAULT },
+        { "numa-interleave", MemorySegmentMapped::MAPPING_NUMA_INTERLEAVE },
+        { "versioned", MemorySegmentMapped::MAPPING_CONCURRENT },
+        { NULL, 0 }
+    };
+    int flags = MemorySegmentMapped::MAPPING_DEFAULT;
+    for (size_t i = 0; options[i].name != NULL; ++i) {
+        const ConstElementPtr value = params->get(options[i].name);
+        if (!value) {
+            continue;
+        }
+        if (value->getType() != Element::boolean) {
+            bundy_throw(bundy::InvalidParameter,
+                        "Invalid value of \"" << options[i].name <<
+                        "\": must be boolean");
+        }
+        if (value->boolValue()) {
+            flags |= options[i].flag;
+        }
+    }
+    return (flags);
+}
+
+// A trivial helper for log message(s).
+const char*
+flagString(int flags, int flag) {
+    return (((flags & flag) != 0) ? "yes" : "no");
+}
 }
 
 void
@@ -278,11 +432,13 @@ ZoneTableSegmentMapped::reset(MemorySegmentOpenMode mode,
         current_filename_.clear();
         // see the constructor; not a big deal in practice, but to be clean
         current_mode_ = CREATE;
+        shared_with_readers_ = false;
         cached_ro_header_ = NULL;
         return;
     }
 
     const std::string filename = mapped_file->stringValue();
+    const int mapping_flags = getMappingFlagsParam(params);
 
     if (mem_sgmt_ && (filename == current_filename_)) {
         // This reset() is an attempt to re-open the currently open
@@ -299,18 +455,21 @@ ZoneTableSegmentMapped::reset(MemorySegmentOpenMode mode,
     // In case current_filename_ below fails, we want the segment to be
     // automatically destroyed.
     std::unique_ptr<MemorySegmentMapped> segment;
+    bool has_allocations = false;
 
     switch (mode) {
     case CREATE:
-        segment.reset(openReadWrite(filename, true));
+        segment.reset(openReadWrite(filename, true, mapping_flags,
+                                    has_allocations));
         break;
 
     case READ_WRITE:
-        segment.reset(openReadWrite(filename, false));
+        segment.reset(openReadWrite(filename, false, mapping_flags,
+                                    has_allocations));
         break;
 
     case READ_ONLY:
-        segment.reset(openReadOnly(filename));
+        segment.reset(openReadOnly(filename, mapping_flags));
         break;
 
     default:
@@ -318,8 +477,18 @@ ZoneTableSegmentMapped::reset(MemorySegmentOpenMode mode,
                   "Invalid MemorySegmentOpenMode passed to reset()");
     }
 
+    const int active_flags = segment->getMappingFlags();
+    LOG_DEBUG(logger, DBG_TRACE_BASIC,
+              DATASRC_MEMORY_MEM_MAPPED_SEGMENT_OPTIONS).arg(filename).
+        arg(flagString(active_flags, MemorySegmentMapped::MAPPING_HUGE_PAGES)).
+        arg(flagString(active_flags, MemorySegmentMapped::MAPPING_PREFAULT)).
+        arg(flagString(active_flags,
+                       MemorySegmentMapped::MAPPING_NUMA_INTERLEAVE));
+
     current_filename_ = filename;
     current_mode_ = mode;
+    shared_with_readers_ = (mode == READ_WRITE) &&
+        isConcurrent(mapping_flags) && has_allocations;
     mem_sgmt_.reset(segment.release());
 
     if (!isWritable()) {
@@ -336,6 +505,14 @@ ZoneTableSegmentMapped::sync() {
         // If there is a previously opened segment, and it was opened in
         // read-write mode, update its checksum.
         mem_sgmt_->shrinkToFit();
+        // allMemoryDeallocated() releases and re-reserves the internal
+        // storage of the segment, which can shift bytes that contribute to
+        // the checksum.  openReadWrite() calls it before verifying the
+        // checksum (unless readers may be using the image), so it's done
+        // here, too, to compute the checksum on the same layout.
+        if (!isConcurrent(mem_sgmt_->getMappingFlags())) {
+            mem_sgmt_->allMemoryDeallocated();
+        }
         const MemorySegment::NamedAddressResult result =
             mem_sgmt_->getNamedAddress(ZONE_TABLE_CHECKSUM_NAME);
         assert(result.first);
@@ -344,7 +521,8 @@ ZoneTableSegmentMapped::sync() {
         // First, clear the checksum so that getCheckSum() returns a
         // consistent value.
         *checksum = 0;
-        const size_t new_checksum = mem_sgmt_->getCheckSum();
+        const size_t new_checksum = mem_sgmt_->getCheckSum(
+            getCheckSumThreads(*mem_sgmt_));
         // Now, update it into place.
         *checksum = new_checksum;
     }
@@ -410,6 +588,19 @@ ZoneTableSegmentMapped::isUsable() const {
     return (!!mem_sgmt_);
 }
 
+bool
+ZoneTableSegmentMapped::isSharedWithReaders() const {
+    return (isWritable() && shared_with_readers_);
+}
+
+int
+ZoneTableSegmentMapped::getMappingFlags() const {
+    if (!mem_sgmt_) {
+        return (MemorySegmentMapped::MAPPING_DEFAULT);
+    }
+    return (mem_sgmt_->getMappingFlags());
+}
+
 bool
 ZoneTableSegmentMapped::isWritable() const {
     if (!isUsable()) {
@@ -19,8 +19,11 @@
 #include <util/memory_segment_mapped.h>
 
 #include <boost/scoped_ptr.hpp>
+
 #include <string>
 
+#include <stdint.h>
+
 namespace bundy {
 namespace datasrc {
 namespace memory {
@@ -44,6 +47,15 @@ protected:
     ZoneTableSegmentMapped(const bundy::dns::RRClass& rrclass);
 
 public:
+    /// \brief The version of the mapped image format.
+    ///
+    /// It's stored in every segment created by this class, and a segment
+    /// of a different version is rejected on \c reset().  It must be
+    /// incremented whenever the layout of the data stored in the segment
+    /// (e.g., \c ZoneData or \c RdataSet) changes incompatibly, so a
+    /// stale image built by an older version is never mapped.
+    static const uint32_t IMAGE_VERSION = 5;
+
     /// \brief Destructor
     virtual ~ZoneTableSegmentMapped();
 
@@ -88,6 +100,24 @@ public:
     ///
     ///  {"mapped-file": "/var/bundy/mapped-files/zone-sqlite3.mapped.0"}
     ///
+    /// It can also contain the optional boolean "huge-pages", "prefault"
+    /// and "numa-interleave" keys to specify the corresponding
+    /// \c MemorySegmentMapped::MappingFlags for the mapped file (all false
+    /// by default).
+    ///
+    /// If the optional boolean "versioned" key is true, the writer and the
+    /// readers use the same mapped file at the same time (with
+    /// \c MemorySegmentMapped::MAPPING_CONCURRENT), rather than the writer
+    /// updating a separate copy of the image.  A writable segment opened for
+    /// an existing image is then shared with readers (see
+    /// \c isSharedWithReaders()), and the zone data it replaces are only
+    /// retired.  On the next \c reset() in the \c READ_WRITE mode for the
+    /// image, the retired zone data are destroyed; the caller must ensure
+    /// that every reader has reset its segment since the image was last
+    /// written, so none of them is still using these data.  A segment reset
+    /// in the \c CREATE mode, or for a new file, is not shared, as readers
+    /// can't be using the new image yet.
+    ///
     /// If the value for "mapped-file" is null, any existing mapping is cleared,
     /// and the zone table segment will become unusable.  In this case,
     /// \c mode will be ignored.
@@ -116,6 +146,23 @@ public:
     /// See the base class for the description.
     virtual bool isUsable() const;
 
+    /// \brief Return true if the segment is writable and was opened with
+    /// "versioned" for an existing image.
+    ///
+    /// See the description of \c reset().
+    ///
+    /// \throw None
+    virtual bool isSharedWithReaders() const;
+
+    /// \brief Return the mapping options in effect for the current segment.
+    ///
+    /// It's the \c MemorySegmentMapped::getMappingFlags() value of the
+    /// current segment, or \c MemorySegmentMapped::MAPPING_DEFAULT if
+    /// there's no segment.
+    ///
+    /// \throw None
+    int getMappingFlags() const;
+
 private:
     void sync();
 
@@ -123,10 +170,17 @@ private:
                          bool has_allocations, std::string& error_msg);
     bool processHeader(bundy::util::MemorySegmentMapped& segment, bool create,
                        bool has_allocations, std::string& error_msg);
+    bool processVersion(bundy::util::MemorySegmentMapped& segment,
+                        bool create, bool has_allocations,
+                        std::string& error_msg);
+    static bool checkVersion(uint32_t version, std::string& error_msg);
 
     bundy::util::MemorySegmentMapped* openReadWrite(const std::string& filename,
-                                                  bool create);
-    bundy::util::MemorySegmentMapped* openReadOnly(const std::string& filename);
+                                                  bool create,
+                                                  int mapping_flags,
+                                                  bool& has_allocations);
+    bundy::util::MemorySegmentMapped* openReadOnly(const std::string& filename,
+                                                 int mapping_flags);
 
     template<typename T> T* getHeaderHelper(bool initial) const;
 
@@ -135,6 +189,7 @@ private:
     const bundy::dns::RRClass rrclass_;
     MemorySegmentOpenMode current_mode_;
     std::string current_filename_;
+    bool shared_with_readers_;
     // Internally holds a MemorySegmentMapped. This is NULL on
     // construction, and is set by the \c reset() method.
     boost::scoped_ptr<bundy::util::MemorySegmentMapped> mem_sgmt_;
@@ -130,8 +130,19 @@ ZoneWriter::load(size_t count_limit, std::string* error_msg) {
             ZoneTable* const table = getZoneTable(impl_->segment_);
             const ZoneTable::MutableFindResult ztresult =
                 table->findZone(impl_->origin_);
+            // Readers of a shared segment may be using the old data, so
+            // they can't be updated in place, nor can the table be modified
+            // for a new zone.
+            const bool shared = impl_->segment_.isSharedWithReaders();
+            if (shared && ztresult.code != result::SUCCESS) {
+                bundy_throw(bundy::InvalidOperation,
+                            "Zone " << impl_->origin_ << "/" <<
+                            impl_->rrclass_ << " can't be added to a zone "
+                            "table segment shared with readers");
+            }
             ZoneData* const old_data =
-                (ztresult.code == result::SUCCESS) ? ztresult.zone_data : NULL;
+                (ztresult.code == result::SUCCESS && !shared) ?
+                ztresult.zone_data : NULL;
             impl_->loader_.reset(impl_->loader_creator_(
                                      impl_->segment_.getMemorySegment(),
                                      old_data));
@@ -259,6 +270,27 @@ void
 ZoneWriter::cleanup() {
     // We eat the data (if any) now.
 
+    // Old data replaced in a segment shared with readers are only retired.
+    // If we can't even do that, they are leaked rather than destroyed under
+    // the readers.
+    if (impl_->state_ == Impl::ZW_INSTALLED && impl_->data_holder_->get() &&
+        impl_->segment_.isSharedWithReaders()) {
+        while (true) {
+            try {
+                impl_->segment_.getHeader().retireZoneData(
+                    impl_->segment_.getMemorySegment(),
+                    impl_->data_holder_->get());
+                break;
+            } catch (const bundy::util::MemorySegmentGrown&) {
+            } catch (const std::bad_alloc&) {
+                break;
+            }
+        }
+        impl_->data_holder_->release();
+        impl_->state_ = Impl::ZW_CLEANED;
+        return;
+    }
+
     ZoneData* zone_data = impl_->data_holder_->release();
     if (zone_data) {
         ZoneData::destroy(impl_->segment_.getMemorySegment(), zone_data,
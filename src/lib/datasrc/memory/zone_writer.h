@@ -99,7 +99,11 @@ public:
     ///     discard it.
     /// \note After successful load(), you have to call cleanup() some time
     ///     later.
-    /// \throw bundy::InvalidOperation if called second time.
+    /// \note If the segment is shared with readers (see
+    ///     \c ZoneTableSegment::isSharedWithReaders()), the zone is always
+    ///     loaded from scratch, rather than by updating the current data.
+    /// \throw bundy::InvalidOperation if called second time, or the zone is
+    /// not in the table of a segment shared with readers.
     /// \throw DataSourceError load related error (not thrown if constructed
     /// with catch_load_error being \c true).
     ///
@@ -137,7 +141,9 @@ public:
     ///
     /// This releases all resources held by owned zone data. That means the
     /// one loaded by load() in case install() was not called or was not
-    /// successful, or the one replaced in install().
+    /// successful, or the one replaced in install().  If the segment is
+    /// shared with readers (see \c ZoneTableSegment::isSharedWithReaders()),
+    /// the replaced data are retired in the \c ZoneTableHeader instead.
     ///
     /// \throw none
     void cleanup();
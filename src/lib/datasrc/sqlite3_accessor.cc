@@ -13,11 +13,18 @@
 // PERFORMANCE OF THIS SOFTWARE.
 
 #include <sqlite3.h>
+#include <strings.h>
 
+#include <algorithm>
+#include <map>
+#include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include <boost/noncopyable.hpp>
+
 #include <exceptions/exceptions.h>
 
 #include <dns/name.h>
@@ -29,6 +36,7 @@
 #include <datasrc/factory.h>
 #include <datasrc/database.h>
 #include <util/filename.h>
+#include <util/threads/sync.h>
 
 using namespace std;
 using namespace bundy::data;
@@ -45,12 +53,15 @@ namespace {
 // program may not be taking advantage of features (possibly performance
 // improvements) added to the database.
 const int SQLITE_SCHEMA_MAJOR_VERSION = 2;
-const int SQLITE_SCHEMA_MINOR_VERSION = 2;
+const int SQLITE_SCHEMA_MINOR_VERSION = 3;
 }
 
 namespace bundy {
 namespace datasrc {
 
+const size_t SQLite3Accessor::DEFAULT_JOURNAL_LIMIT;
+const size_t SQLite3Accessor::DEFAULT_BULK_LOAD_THRESHOLD;
+
 // The following enum and char* array define the SQL statements commonly
 // used in this implementation.  Corresponding prepared statements (of
 // type sqlite3_stmt*) are maintained in the statements_ array of the
@@ -81,7 +92,12 @@ enum StatementID {
     DEL_NSEC3_RECORD = 21,
     ADD_ZONE = 22,
     DELETE_ZONE = 23,
-    NUM_STATEMENTS = 24
+    ADD_JOURNAL = 24,
+    NEXT_JOURNAL = 25,
+    JOURNAL_DIFFS = 26,
+    TRIM_JOURNAL = 27,
+    RECORDS_SIZE = 28,
+    NUM_STATEMENTS = 29
 };
 
 const char* const text_statements[NUM_STATEMENTS] = {
@@ -171,16 +187,53 @@ const char* const text_statements[NUM_STATEMENTS] = {
     // ADD_ZONE: add a zone to the zones table
     "INSERT INTO zones (name, rdclass) VALUES (?1, ?2)", // ADD_ZONE
     // DELETE_ZONE: delete a zone from the zones table
-    "DELETE FROM zones WHERE id=?1" // DELETE_ZONE
+    "DELETE FROM zones WHERE id=?1", // DELETE_ZONE
+
+    // ADD_JOURNAL: store the differences of a version of a zone
+    "INSERT INTO journal (zone_id, from_serial, to_serial, diffs) "
+        "VALUES (?1, ?2, ?3, ?4)",
+    // NEXT_JOURNAL: find the earliest differences from a version stored
+    // after a given one.  The index on (zone_id, from_serial) also holds
+    // the id, so this doesn't scan the table.
+    "SELECT id, to_serial FROM journal "
+        "WHERE zone_id=?1 AND from_serial=?2 AND id>?3 "
+        "ORDER BY id ASC LIMIT 1",
+    // JOURNAL_DIFFS: get the differences found by NEXT_JOURNAL
+    "SELECT diffs FROM journal WHERE id=?1",
+    // TRIM_JOURNAL: keep only the ?2 latest versions of a zone
+    "DELETE FROM journal WHERE zone_id=?1 AND id<="
+        "(SELECT id FROM journal WHERE zone_id=?1 "
+        "ORDER BY id DESC LIMIT 1 OFFSET ?2)",
+    // RECORDS_SIZE: the largest ID in the records table, a cheap estimate
+    // of its number of rows
+    "SELECT MAX(id) FROM records"
+};
+
+// The differences added in an update transaction, grouped by the version
+// of the zone they lead to.  They are stored in the journal table when the
+// transaction is committed.
+struct PendingJournal {
+    PendingJournal(uint32_t from_serial) :
+        from_serial_(from_serial), to_serial_(from_serial), added_(false)
+    {}
+    uint32_t from_serial_;
+    uint32_t to_serial_;
+    // Whether the added RRs have started, so that the next deleted one
+    // starts the differences of the next version.
+    bool added_;
+    // The RRs, see appendDiff().
+    vector<uint8_t> diffs_;
 };
 
 struct SQLite3Parameters {
     SQLite3Parameters() :
         db_(NULL), major_version_(-1), minor_version_(-1),
-        in_transaction(false), updating_zone(false), updated_zone_id(-1)
+        has_journal_(false), in_transaction(false), updating_zone(false),
+        updated_zone_id(-1), added_records_(0), bulk_load_size_(0)
     {
         for (int i = 0; i < NUM_STATEMENTS; ++i) {
             statements_[i] = NULL;
+            spare_statements_[i] = NULL;
         }
     }
 
@@ -204,6 +257,44 @@ struct SQLite3Parameters {
         return (statements_[id]);
     }
 
+    // Iterator contexts need a statement of their own, as more than one
+    // of them can be alive at the same time.  This method returns such a
+    // statement, reusing the one released by a previous context if
+    // available, so that a plain lookup doesn't have to parse and compile
+    // the SQL each time.  The statement must be given back via
+    // releaseStatement().
+    sqlite3_stmt*
+    acquireStatement(int id) {
+        assert(id < NUM_STATEMENTS);
+        sqlite3_stmt* stmt = spare_statements_[id];
+        if (stmt != NULL) {
+            spare_statements_[id] = NULL;
+            return (stmt);
+        }
+        assert(db_ != NULL);
+        if (sqlite3_prepare_v2(db_, text_statements[id], -1, &stmt,
+                               NULL) != SQLITE_OK) {
+            bundy_throw(SQLite3Error, "Could not prepare SQLite statement: "
+                      << text_statements[id] <<
+                      ": " << sqlite3_errmsg(db_));
+        }
+        return (stmt);
+    }
+
+    // Give back a statement returned by acquireStatement().  It's kept
+    // for the next context unless there's already a spare one.
+    void
+    releaseStatement(int id, sqlite3_stmt* stmt) {
+        assert(id < NUM_STATEMENTS);
+        if (spare_statements_[id] == NULL) {
+            sqlite3_reset(stmt);
+            sqlite3_clear_bindings(stmt);
+            spare_statements_[id] = stmt;
+        } else {
+            sqlite3_finalize(stmt);
+        }
+    }
+
     void
     finalizeStatements() {
         for (int i = 0; i < NUM_STATEMENTS; ++i) {
@@ -211,20 +302,32 @@ struct SQLite3Parameters {
                 sqlite3_finalize(statements_[i]);
                 statements_[i] = NULL;
             }
+            if (spare_statements_[i] != NULL) {
+                sqlite3_finalize(spare_statements_[i]);
+                spare_statements_[i] = NULL;
+            }
         }
     }
 
     sqlite3* db_;
     int major_version_;
     int minor_version_;
+    // Whether the database has the journal table (schema 2.3 and later);
+    // the older ones keep one row per RR in the diffs table.
+    bool has_journal_;
     bool in_transaction; // whether or not a transaction has been started
     bool updating_zone;          // whether or not updating the zone
     int updated_zone_id;        // valid only when in_transaction is true
     string updated_zone_origin_; // ditto, and only needed to handle NSEC3s
+    vector<PendingJournal> pending_journal_; // diffs not yet committed
+    size_t added_records_;      // records added in the update so far
+    size_t bulk_load_size_;     // added_records_ to start a bulk load at,
+                                // 0 if it mustn't
 private:
     // statements_ are private and must be accessed via getStatement() outside
     // of this structure.
     sqlite3_stmt* statements_[NUM_STATEMENTS];
+    sqlite3_stmt* spare_statements_[NUM_STATEMENTS];
 };
 
 // This is a helper class to encapsulate the code logic of executing
@@ -282,6 +385,14 @@ public:
         }
     }
 
+    void bindBlob(int index, const void* val, int len) {
+        if (sqlite3_bind_blob(stmt_, index, val, len, SQLITE_STATIC)
+            != SQLITE_OK) {
+            bundy_throw(DataSourceError, "failed to bind SQLite3 parameter: " <<
+                      sqlite3_errmsg(dbparameters_.db_));
+        }
+    }
+
     void exec() {
         if (sqlite3_step(stmt_) != SQLITE_DONE) {
             sqlite3_reset(stmt_);
@@ -296,13 +407,306 @@ private:
     const char* const desc_;
 };
 
+// Connections for reading the database from threads other than the one that
+// opened the accessor.  A single sqlite3 connection (and the statements
+// prepared on it) must not be used by multiple threads at the same time,
+// so each such thread gets its own connection on its first read, which is
+// kept until the accessor is destroyed.
+class SQLite3Accessor::ReadConnections : boost::noncopyable {
+public:
+    ReadConnections() : owner_(std::this_thread::get_id()) {}
+    ~ReadConnections() {
+        for (ConnectionMap::iterator it = connections_.begin();
+             it != connections_.end();
+             ++it) {
+            it->second->finalizeStatements();
+            sqlite3_close(it->second->db_);
+            delete it->second;
+        }
+    }
+
+    const std::thread::id owner_;
+    bundy::util::thread::Mutex mutex_;
+    typedef std::map<std::thread::id, SQLite3Parameters*> ConnectionMap;
+    ConnectionMap connections_;
+};
+
+// Inserter of the records added by an update once it switched to bulk
+// loading (see SQLite3Accessor::setBulkLoadThreshold()).  The indexes of
+// the records table are dropped at construction and built again by
+// finish().  The records are collected in batches of BATCH_SIZE rows,
+// each inserted with a single statement by a separate thread while the
+// next one is being filled.  The connection is otherwise only used by the
+// constructing thread between batches (see sync()) or once finished.
+class SQLite3Accessor::BulkLoader : boost::noncopyable {
+public:
+    BulkLoader(SQLite3Parameters& params, const string& database_name);
+    ~BulkLoader();
+
+    // Queue a record to be inserted.
+    void add(const string (&columns)[ADD_COLUMN_COUNT]);
+
+    // Wait until the queued batches are inserted, so that the connection
+    // can be used.  The batch being filled is kept.
+    void sync();
+
+    // Insert the remaining records and rebuild the indexes.  Nothing is
+    // done if it's already finished.
+    void finish();
+
+    bool isLoading() const { return (loading_); }
+
+private:
+    // The number of rows of a batch; each has ADD_COLUMN_COUNT text
+    // parameters and the zone ID, and SQLite doesn't accept more than 999
+    // parameters in a statement by default.
+    static const size_t BATCH_SIZE = 128;
+
+    // Hand the batch being filled over to the thread.
+    void handOff();
+    // Make the thread exit once it's done, and wait for it.
+    void stop();
+    // The body of the thread.
+    void run();
+    // Insert the first count rows of writing_, in the thread.
+    void insert(size_t count);
+
+    SQLite3Parameters& params_;
+    const string database_name_;
+    const int zone_id_;
+    sqlite3_stmt* batch_stmt_;
+    sqlite3_stmt* row_stmt_;
+    // The names and definitions of the dropped indexes.
+    vector<pair<string, string> > indexes_;
+    bool loading_;
+    size_t loaded_;
+    // The batch being filled by add() and the one being inserted by the
+    // thread, ADD_COLUMN_COUNT strings per row.
+    vector<string> filling_;
+    size_t filling_count_;
+    vector<string> writing_;
+    // The following are shared with the thread, protected by mutex_.
+    bundy::util::thread::Mutex mutex_;
+    bundy::util::thread::CondVar work_cond_;
+    bundy::util::thread::CondVar idle_cond_;
+    size_t writing_count_;      // rows of writing_ to insert, 0 if none
+    bool stopping_;
+    string error_;              // set by the thread if an insert failed
+    std::thread thread_;
+};
+
+const size_t SQLite3Accessor::BulkLoader::BATCH_SIZE;
+
+SQLite3Accessor::BulkLoader::BulkLoader(SQLite3Parameters& params,
+                                        const string& database_name) :
+    params_(params), database_name_(database_name),
+    zone_id_(params.updated_zone_id), batch_stmt_(NULL), row_stmt_(NULL),
+    loading_(true), loaded_(0), filling_(BATCH_SIZE * ADD_COLUMN_COUNT),
+    filling_count_(0), writing_(BATCH_SIZE * ADD_COLUMN_COUNT),
+    writing_count_(0), stopping_(false)
+{
+    string batch_text = "INSERT INTO records "
+        "(zone_id, name, rname, ttl, rdtype, sigtype, rdata) VALUES ";
+    for (size_t i = 0; i < BATCH_SIZE; ++i) {
+        batch_text += (i == 0) ? "(?,?,?,?,?,?,?)" : ",(?,?,?,?,?,?,?)";
+    }
+    sqlite3_stmt* indexes_stmt = NULL;
+    if (sqlite3_prepare_v2(params_.db_, batch_text.c_str(), -1, &batch_stmt_,
+                           NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(params_.db_, text_statements[ADD_RECORD], -1,
+                           &row_stmt_, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(params_.db_,
+                           "SELECT name, sql FROM sqlite_master "
+                           "WHERE type='index' AND tbl_name='records' "
+                           "AND sql IS NOT NULL", -1, &indexes_stmt,
+                           NULL) != SQLITE_OK) {
+        const string error(sqlite3_errmsg(params_.db_));
+        sqlite3_finalize(batch_stmt_);
+        sqlite3_finalize(row_stmt_);
+        sqlite3_finalize(indexes_stmt);
+        bundy_throw(SQLite3Error, "Could not prepare SQLite statements for "
+                    "a bulk load: " << error);
+    }
+    while (sqlite3_step(indexes_stmt) == SQLITE_ROW) {
+        indexes_.push_back(pair<string, string>(
+            reinterpret_cast<const char*>(
+                sqlite3_column_text(indexes_stmt, 0)),
+            reinterpret_cast<const char*>(
+                sqlite3_column_text(indexes_stmt, 1))));
+    }
+    sqlite3_finalize(indexes_stmt);
+
+    // An index that can't be dropped (e.g., because a statement reading
+    // the table is in progress) is just maintained as usual.
+    vector<pair<string, string> >::iterator it = indexes_.begin();
+    while (it != indexes_.end()) {
+        const string drop_text = "DROP INDEX " + it->first;
+        if (sqlite3_exec(params_.db_, drop_text.c_str(), NULL, NULL,
+                         NULL) == SQLITE_OK) {
+            ++it;
+        } else {
+            it = indexes_.erase(it);
+        }
+    }
+
+    thread_ = std::thread(&BulkLoader::run, this);
+}
+
+SQLite3Accessor::BulkLoader::~BulkLoader() {
+    if (thread_.joinable()) {
+        stop();
+    }
+    sqlite3_finalize(batch_stmt_);
+    sqlite3_finalize(row_stmt_);
+}
+
+void
+SQLite3Accessor::BulkLoader::add(const string (&columns)[ADD_COLUMN_COUNT]) {
+    string* const row = &filling_[filling_count_ * ADD_COLUMN_COUNT];
+    for (size_t i = 0; i < ADD_COLUMN_COUNT; ++i) {
+        row[i] = columns[i];
+    }
+    if (++filling_count_ == BATCH_SIZE) {
+        handOff();
+    }
+}
+
+void
+SQLite3Accessor::BulkLoader::sync() {
+    bundy::util::thread::Mutex::Locker locker(mutex_);
+    while (writing_count_ > 0) {
+        idle_cond_.wait(mutex_);
+    }
+    if (!error_.empty()) {
+        bundy_throw(DataSourceError, "failed to bulk load records: " <<
+                    error_);
+    }
+}
+
+void
+SQLite3Accessor::BulkLoader::handOff() {
+    sync();
+    bundy::util::thread::Mutex::Locker locker(mutex_);
+    filling_.swap(writing_);
+    writing_count_ = filling_count_;
+    loaded_ += filling_count_;
+    filling_count_ = 0;
+    work_cond_.signal();
+}
+
+void
+SQLite3Accessor::BulkLoader::finish() {
+    if (!loading_) {
+        return;
+    }
+    loading_ = false;
+    if (filling_count_ > 0) {
+        handOff();
+    }
+    stop();
+    if (!error_.empty()) {
+        bundy_throw(DataSourceError, "failed to bulk load records: " <<
+                    error_);
+    }
+
+    for (vector<pair<string, string> >::const_iterator it = indexes_.begin();
+         it != indexes_.end();
+         ++it) {
+        if (sqlite3_exec(params_.db_, it->second.c_str(), NULL, NULL,
+                         NULL) != SQLITE_OK) {
+            bundy_throw(DataSourceError, "failed to rebuild index " <<
+                        it->first << ": " << sqlite3_errmsg(params_.db_));
+        }
+    }
+    LOG_DEBUG(logger, DBG_TRACE_BASIC, DATASRC_SQLITE_BULK_LOAD_END).
+        arg(loaded_).arg(database_name_).arg(indexes_.size());
+}
+
+void
+SQLite3Accessor::BulkLoader::stop() {
+    {
+        bundy::util::thread::Mutex::Locker locker(mutex_);
+        stopping_ = true;
+        work_cond_.signal();
+    }
+    thread_.join();
+}
+
+void
+SQLite3Accessor::BulkLoader::run() {
+    while (true) {
+        size_t count;
+        {
+            bundy::util::thread::Mutex::Locker locker(mutex_);
+            while (writing_count_ == 0 && !stopping_) {
+                work_cond_.wait(mutex_);
+            }
+            if (writing_count_ == 0) {
+                return;
+            }
+            count = writing_count_;
+        }
+
+        string error;
+        try {
+            insert(count);
+        } catch (const std::exception& ex) {
+            error = ex.what();
+        }
+
+        bundy::util::thread::Mutex::Locker locker(mutex_);
+        if (error_.empty()) {
+            error_ = error;
+        }
+        writing_count_ = 0;
+        idle_cond_.signal();
+    }
+}
+
+void
+SQLite3Accessor::BulkLoader::insert(size_t count) {
+    // After an error the rest is skipped, as the update is rolled back.
+    if (!error_.empty()) {
+        return;
+    }
+    sqlite3_stmt* const stmt = (count == BATCH_SIZE) ? batch_stmt_ :
+        row_stmt_;
+    const size_t rows = (count == BATCH_SIZE) ? BATCH_SIZE : 1;
+    for (size_t row = 0; row < count; ) {
+        int param_id = 0;
+        for (size_t i = 0; i < rows; ++i, ++row) {
+            int rc = sqlite3_bind_int(stmt, ++param_id, zone_id_);
+            const string* const columns = &writing_[row * ADD_COLUMN_COUNT];
+            for (size_t j = 0; j < ADD_COLUMN_COUNT && rc == SQLITE_OK; ++j) {
+                // The empty columns are NULL, as in doUpdate().
+                rc = sqlite3_bind_text(stmt, ++param_id, columns[j].empty() ?
+                                       NULL : columns[j].c_str(), -1,
+                                       SQLITE_STATIC);
+            }
+            if (rc != SQLITE_OK) {
+                bundy_throw(DataSourceError, "failed to bind SQLite3 "
+                            "parameter: " << sqlite3_errmsg(params_.db_));
+            }
+        }
+        const int rc = sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+        if (rc != SQLITE_DONE) {
+            bundy_throw(DataSourceError, "failed to add records to zone: " <<
+                        sqlite3_errmsg(params_.db_));
+        }
+    }
+}
+
 SQLite3Accessor::SQLite3Accessor(const std::string& filename,
                                  const string& rrclass) :
     dbparameters_(new SQLite3Parameters),
+    read_connections_(new ReadConnections),
     filename_(filename),
     class_(rrclass),
     database_name_("sqlite3_" +
-                   bundy::util::Filename(filename).nameAndExtension())
+                   bundy::util::Filename(filename).nameAndExtension()),
+    journal_limit_(DEFAULT_JOURNAL_LIMIT),
+    bulk_load_threshold_(DEFAULT_BULK_LOAD_THRESHOLD)
 {
     LOG_DEBUG(logger, DBG_TRACE_BASIC, DATASRC_SQLITE_NEWCONN);
 
@@ -311,8 +715,11 @@ SQLite3Accessor::SQLite3Accessor(const std::string& filename,
 
 boost::shared_ptr<DatabaseAccessor>
 SQLite3Accessor::clone() {
-    return (boost::shared_ptr<DatabaseAccessor>(new SQLite3Accessor(filename_,
-                                                                    class_)));
+    boost::shared_ptr<SQLite3Accessor> accessor(new SQLite3Accessor(filename_,
+                                                                    class_));
+    accessor->setJournalLimit(journal_limit_);
+    accessor->setBulkLoadThreshold(bulk_load_threshold_);
+    return (accessor);
 }
 
 namespace {
@@ -341,7 +748,7 @@ public:
 const char* const SCHEMA_LIST[] = {
     "CREATE TABLE schema_version (version INTEGER NOT NULL, "
         "minor INTEGER NOT NULL DEFAULT 0)",
-    "INSERT INTO schema_version VALUES (2, 2)",
+    "INSERT INTO schema_version VALUES (2, 3)",
     "CREATE TABLE zones (id INTEGER PRIMARY KEY, "
     "name TEXT NOT NULL COLLATE NOCASE, "
     "rdclass TEXT NOT NULL COLLATE NOCASE DEFAULT 'IN', "
@@ -377,6 +784,12 @@ const char* const SCHEMA_LIST[] = {
         "rrtype TEXT NOT NULL COLLATE NOCASE, "
         "ttl INTEGER NOT NULL, "
         "rdata TEXT NOT NULL)",
+    "CREATE TABLE journal (id INTEGER PRIMARY KEY, "
+        "zone_id INTEGER NOT NULL, "
+        "from_serial INTEGER NOT NULL, "
+        "to_serial INTEGER NOT NULL, "
+        "diffs BLOB NOT NULL)",
+    "CREATE INDEX journal_byzone_and_serial ON journal (zone_id, from_serial)",
     NULL
 };
 
@@ -390,6 +803,19 @@ prepare(sqlite3* const db, const char* const statement) {
     return (prepared);
 }
 
+// The maximum number of bytes of the database file SQLite may access via
+// mmap() for each connection.  This avoids copying pages to the private
+// page cache of the connection, which matters as we have a connection per
+// query thread.  It only reserves address space, and is silently ignored
+// by SQLite versions that don't support memory-mapped I/O.
+const char* const MMAP_SIZE_PRAGMA = "PRAGMA mmap_size=268435456";
+
+// Connection-wide settings applied whenever we open a database.
+void
+tuneConnection(sqlite3* db) {
+    sqlite3_exec(db, MMAP_SIZE_PRAGMA, NULL, NULL, NULL);
+}
+
 // small function to sleep for 0.1 seconds, needed when waiting for
 // exclusive database locks (which should only occur on startup, and only
 // when the database has not been created yet)
@@ -450,6 +876,28 @@ pair<int, int> checkSchemaVersion(sqlite3* db) {
     }
 }
 
+// Returns whether the database has the journal table.  The databases
+// created with an older schema keep using the diffs table until they're
+// upgraded.
+bool
+hasJournal(sqlite3* db) {
+    sqlite3_stmt* prepared = NULL;
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM sqlite_master "
+                           "WHERE type='table' AND name='journal'", -1,
+                           &prepared, NULL) != SQLITE_OK) {
+        sqlite3_finalize(prepared);
+        bundy_throw(SQLite3Error, "Unable to prepare journal table query: "
+                    << sqlite3_errmsg(db));
+    }
+    const int rc = sqlite3_step(prepared);
+    sqlite3_finalize(prepared);
+    if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+        bundy_throw(SQLite3Error, "Unable to query the journal table: " <<
+                    sqlite3_errmsg(db));
+    }
+    return (rc == SQLITE_ROW);
+}
+
 // A helper class used in createDatabase() below so we manage the one shot
 // transaction safely.
 class ScopedTransaction {
@@ -493,6 +941,26 @@ private:
     sqlite3* db_;
 };
 
+// Switch the database to the write-ahead logging mode.  The pragma results
+// in the mode actually in effect, which is something else if it failed.
+bool
+enableWAL(sqlite3* db) {
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(db, "PRAGMA journal_mode=WAL", -1, &stmt,
+                           NULL) != SQLITE_OK) {
+        sqlite3_finalize(stmt);
+        return (false);
+    }
+    bool enabled = false;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const void* mode = sqlite3_column_text(stmt, 0);
+        enabled = (mode != NULL &&
+                   strcasecmp(static_cast<const char*>(mode), "wal") == 0);
+    }
+    sqlite3_finalize(stmt);
+    return (enabled);
+}
+
 // return db version
 pair<int, int>
 createDatabase(sqlite3* db, const std::string& name) {
@@ -512,6 +980,15 @@ createDatabase(sqlite3* db, const std::string& name) {
         }
         trasaction.commit();
 
+        // New databases use write-ahead logging, so readers (such as
+        // bundy-auth and xfrout) don't block a writer committing an update
+        // and vice versa.  The mode is persistent in the database file.
+        // Failing to switch isn't fatal: the database still works in the
+        // default rollback journal mode.
+        if (!enableWAL(db)) {
+            LOG_WARN(logger, DATASRC_SQLITE_WAL_FAILED).arg(name);
+        }
+
         // Return the version.  We query again to ensure that the only point
         // in which the current schema version is defined is in the create
         // statements.
@@ -543,6 +1020,7 @@ checkAndSetupSchema(Initializer* initializer, const std::string& name) {
 
     initializer->params_.major_version_ = schema_version.first;
     initializer->params_.minor_version_ = schema_version.second;
+    initializer->params_.has_journal_ = hasJournal(db);
 }
 
 }
@@ -562,12 +1040,53 @@ SQLite3Accessor::open(const std::string& name) {
     }
 
     checkAndSetupSchema(&initializer, name);
+    tuneConnection(initializer.params_.db_);
     initializer.move(dbparameters_.get());
 }
 
+SQLite3Parameters&
+SQLite3Accessor::getReadParameters() const {
+    const std::thread::id self = std::this_thread::get_id();
+    if (self == read_connections_->owner_) {
+        if (bulk_loader_) {
+            bulk_loader_->finish();
+        }
+        return (*dbparameters_);
+    }
+
+    bundy::util::thread::Mutex::Locker locker(read_connections_->mutex_);
+    ReadConnections::ConnectionMap::const_iterator found =
+        read_connections_->connections_.find(self);
+    if (found != read_connections_->connections_.end()) {
+        return (*found->second);
+    }
+
+    // The schema was checked (or created) by the owner's connection, so
+    // we only have to open the file again.
+    Initializer initializer;
+    if (sqlite3_open_v2(filename_.c_str(), &initializer.params_.db_,
+                        SQLITE_OPEN_READWRITE, NULL) != SQLITE_OK) {
+        bundy_throw(SQLite3Error, "Cannot open SQLite database file: " <<
+                    filename_);
+    }
+    tuneConnection(initializer.params_.db_);
+    initializer.params_.major_version_ = dbparameters_->major_version_;
+    initializer.params_.minor_version_ = dbparameters_->minor_version_;
+    initializer.params_.has_journal_ = dbparameters_->has_journal_;
+
+    std::auto_ptr<SQLite3Parameters> params(new SQLite3Parameters);
+    read_connections_->connections_[self] = params.get();
+    initializer.move(params.get());
+    LOG_DEBUG(logger, DBG_TRACE_BASIC, DATASRC_SQLITE_READCONN).
+        arg(database_name_);
+    return (*params.release());
+}
+
 SQLite3Accessor::~SQLite3Accessor() {
     LOG_DEBUG(logger, DBG_TRACE_BASIC, DATASRC_SQLITE_DROPCONN)
         .arg(database_name_);
+    bulk_loader_.reset();
+    read_connections_.reset();
     if (dbparameters_->db_ != NULL) {
         close();
     }
@@ -588,8 +1107,9 @@ SQLite3Accessor::close(void) {
 
 std::pair<bool, int>
 SQLite3Accessor::getZone(const std::string& name) const {
+    SQLite3Parameters& params = getReadParameters();
     int rc;
-    sqlite3_stmt* const stmt = dbparameters_->getStatement(ZONE);
+    sqlite3_stmt* const stmt = params.getStatement(ZONE);
 
     // Take the statement (simple SELECT id FROM zones WHERE...)
     // and prepare it (bind the parameters to it)
@@ -619,7 +1139,7 @@ SQLite3Accessor::getZone(const std::string& name) const {
 
     sqlite3_reset(stmt);
     bundy_throw(DataSourceError, "Unexpected failure in sqlite3_step: " <<
-              sqlite3_errmsg(dbparameters_->db_));
+              sqlite3_errmsg(params.db_));
     // Compilers might not realize bundy_throw always throws
     return (std::pair<bool, int>(false, 0));
 }
@@ -695,22 +1215,24 @@ public:
     Context(const boost::shared_ptr<const SQLite3Accessor>& accessor, int id) :
         iterator_type_(ITT_ALL),
         accessor_(accessor),
+        params_(accessor->getReadParameters()),
         statement_(NULL),
         statement2_(NULL),
+        statement_id_(ITERATE_NSEC3),
+        statement2_id_(ITERATE_RECORDS),
         rc_(SQLITE_OK),
         rc2_(SQLITE_OK),
         name_("")
     {
         // We create the statements now and then just keep getting data
         // from them.
-        statement_ = prepare(accessor->dbparameters_->db_,
-                             text_statements[ITERATE_NSEC3]);
+        statement_ = params_.acquireStatement(ITERATE_NSEC3);
         bindZoneId(id);
 
         std::swap(statement_, statement2_);
+        std::swap(statement_id_, statement2_id_);
 
-        statement_ = prepare(accessor->dbparameters_->db_,
-                             text_statements[ITERATE_RECORDS]);
+        statement_ = params_.acquireStatement(ITERATE_RECORDS);
         bindZoneId(id);
     }
 
@@ -723,46 +1245,30 @@ public:
     };
 
     // Construct an iterator for records with a specific name. When constructed
-    // this way, the getNext() call will copy all fields except name
+    // this way, the getNext() call will copy all fields except name.
+    //
+    // The statement comes from the per-connection cache of the accessor,
+    // so looking up a name doesn't involve compiling the SQL.
     Context(const boost::shared_ptr<const SQLite3Accessor>& accessor, int id,
             const std::string& name, QueryType qtype) :
         iterator_type_(qtype == QT_NSEC3 ? ITT_NSEC3 : ITT_NAME),
         accessor_(accessor),
+        params_(accessor->getReadParameters()),
         statement_(NULL),
         statement2_(NULL),
+        statement_id_(getStatementID(qtype)),
+        statement2_id_(statement_id_),
         rc_(SQLITE_OK),
         rc2_(SQLITE_OK),
         name_(name)
     {
-        // Choose the statement text depending on the query type, and
-        // prepare a statement to get data from it.
-        switch (qtype) {
-            case QT_ANY:
-                statement_ = prepare(accessor->dbparameters_->db_,
-                                     text_statements[ANY]);
-                bindZoneId(id);
-                bindName(name_);
-                break;
-            case QT_SUBDOMAINS:
-                statement_ = prepare(accessor->dbparameters_->db_,
-                                     text_statements[ANY_SUB]);
-                bindZoneId(id);
-                // Done once, this should not be very inefficient.
-                bindName(bundy::dns::Name(name_).reverse().toText() + "%");
-                break;
-            case QT_NSEC3:
-                statement_ = prepare(accessor->dbparameters_->db_,
-                                     text_statements[NSEC3]);
-                bindZoneId(id);
-                bindName(name_);
-                break;
-            default:
-                // Can Not Happen - there isn't any other type of query
-                // and all the calls to the constructor are from this
-                // file. Therefore no way to test it throws :-(.
-                bundy_throw(Unexpected,
-                          "Invalid qtype passed - unreachable code branch "
-                          "reached");
+        statement_ = params_.acquireStatement(statement_id_);
+        bindZoneId(id);
+        if (qtype == QT_SUBDOMAINS) {
+            // Done once, this should not be very inefficient.
+            bindName(bundy::dns::Name(name_).reverse().toText() + "%");
+        } else {
+            bindName(name_);
         }
     }
 
@@ -790,7 +1296,7 @@ public:
             } else if (rc_ != SQLITE_DONE) {
                 bundy_throw(DataSourceError,
                           "Unexpected failure in sqlite3_step: " <<
-                          sqlite3_errmsg(accessor_->dbparameters_->db_));
+                          sqlite3_errmsg(params_.db_));
             }
             // We are done with statement_. If statement2_ has not been
             // used yet, try that one now.
@@ -798,6 +1304,7 @@ public:
                 break;
             }
             std::swap(statement_, statement2_);
+            std::swap(statement_id_, statement2_id_);
             std::swap(rc_, rc2_);
         }
         finalize();
@@ -818,10 +1325,27 @@ private:
         ITT_NSEC3
     };
 
+    static StatementID getStatementID(QueryType qtype) {
+        switch (qtype) {
+            case QT_ANY:
+                return (ANY);
+            case QT_SUBDOMAINS:
+                return (ANY_SUB);
+            case QT_NSEC3:
+                return (NSEC3);
+        }
+        // Can Not Happen - there isn't any other type of query
+        // and all the calls to the constructor are from this
+        // file. Therefore no way to test it throws :-(.
+        bundy_throw(Unexpected,
+                  "Invalid qtype passed - unreachable code branch reached");
+        return (ANY);           // silence compiler warnings
+    }
+
     void copyColumn(std::string (&data)[COLUMN_COUNT], int column) {
         data[column] = convertToPlainChar(sqlite3_column_text(statement_,
                                                               column),
-                                          accessor_->dbparameters_->db_);
+                                          params_.db_);
     }
 
     void bindZoneId(const int zone_id) {
@@ -829,35 +1353,39 @@ private:
             finalize();
             bundy_throw(SQLite3Error, "Could not bind int " << zone_id <<
                       " to SQL statement: " <<
-                      sqlite3_errmsg(accessor_->dbparameters_->db_));
+                      sqlite3_errmsg(params_.db_));
         }
     }
 
     void bindName(const std::string& name) {
         if (sqlite3_bind_text(statement_, 2, name.c_str(), -1,
                               SQLITE_TRANSIENT) != SQLITE_OK) {
-            const char* errmsg = sqlite3_errmsg(accessor_->dbparameters_->db_);
+            const char* errmsg = sqlite3_errmsg(params_.db_);
             finalize();
             bundy_throw(SQLite3Error, "Could not bind text '" << name <<
                       "' to SQL statement: " << errmsg);
         }
     }
 
+    // Give the statements back to the cache.
     void finalize() {
         if (statement_ != NULL) {
-             sqlite3_finalize(statement_);
+             params_.releaseStatement(statement_id_, statement_);
              statement_ = NULL;
         }
         if (statement2_ != NULL) {
-             sqlite3_finalize(statement2_);
+             params_.releaseStatement(statement2_id_, statement2_);
              statement2_ = NULL;
         }
     }
 
     const IteratorType iterator_type_;
     boost::shared_ptr<const SQLite3Accessor> accessor_;
+    SQLite3Parameters& params_;
     sqlite3_stmt* statement_;
     sqlite3_stmt* statement2_;
+    StatementID statement_id_;
+    StatementID statement2_id_;
     int rc_;
     int rc2_;
     const std::string name_;
@@ -888,10 +1416,40 @@ SQLite3Accessor::getAllRecords(int id) const {
 }
 
 
+namespace {
+
+// The RRs of the differences of a version are stored in a single blob:
+// the owner name, type, TTL and RDATA of each RR, in this order, as in
+// DatabaseAccessor::DiffRecordParams.  Each field is preceded by its length,
+// in network byte order, in 2 octets, or 4 for the RDATA.
+const size_t DIFF_FIELD_LENGTHS[DatabaseAccessor::DIFF_PARAM_COUNT] =
+    { 2, 2, 2, 4 };
+
+void
+appendDiff(vector<uint8_t>& diffs,
+           const std::string (&params)[DatabaseAccessor::DIFF_PARAM_COUNT])
+{
+    for (int i = 0; i < DatabaseAccessor::DIFF_PARAM_COUNT; ++i) {
+        const std::string& field = params[i];
+        const size_t length_len = DIFF_FIELD_LENGTHS[i];
+        if (length_len == 2 && field.size() > 0xffff) {
+            bundy_throw(DataSourceError, "record diff field too long: " <<
+                        field.size() << " bytes");
+        }
+        for (size_t j = length_len; j > 0; --j) {
+            diffs.push_back((field.size() >> ((j - 1) * 8)) & 0xff);
+        }
+        diffs.insert(diffs.end(), field.begin(), field.end());
+    }
+}
+
+}
+
 /// \brief Difference Iterator
 ///
-/// This iterator is used to search through the differences table for the
-/// resouce records making up an IXFR between two versions of a zone.
+/// This iterator is used to search through the journal (or, for databases
+/// of an older schema, the differences table) for the resouce records
+/// making up an IXFR between two versions of a zone.
 
 // cppcheck-suppress noConstructor
 class SQLite3Accessor::DiffContext : public DatabaseAccessor::IteratorContext {
@@ -904,6 +1462,12 @@ public:
     /// sequence.  Note that because of serial number rollover, it may well
     /// be that the start serial number is greater than the end one.
     ///
+    /// The journal entries making up the sequence are looked up here, so
+    /// that a missing version is reported at once; their RRs are read by
+    /// getNext(), one version at a time.  The differences stored in the
+    /// diffs table before the database was upgraded to the journal are
+    /// still used if the journal doesn't have the start version.
+    ///
     /// \param accessor The accessor to the database to use to get data.
     /// \param zone_id ID of the zone (in the zone table)
     /// \param start Serial number of first version in difference sequence
@@ -913,9 +1477,18 @@ public:
     DiffContext(const boost::shared_ptr<const SQLite3Accessor>& accessor,
                 int zone_id, uint32_t start, uint32_t end) :
         accessor_(accessor),
-        last_status_(SQLITE_ROW)
+        last_status_(SQLITE_ROW),
+        use_journal_(false),
+        next_entry_(0),
+        offset_(0)
     {
         try {
+            if (accessor_->dbparameters_->has_journal_ &&
+                findJournal(zone_id, start, end)) {
+                use_journal_ = true;
+                return;
+            }
+
             int low_id = findIndex(LOW_DIFF_ID, zone_id, start, DIFF_DELETE);
             int high_id = findIndex(HIGH_DIFF_ID, zone_id, end, DIFF_ADD);
 
@@ -947,6 +1520,9 @@ public:
     ///
     /// \exception any Varied
     bool getNext(std::string (&data)[COLUMN_COUNT]) {
+        if (use_journal_) {
+            return (getNextJournal(data));
+        }
 
         if (last_status_ != SQLITE_DONE) {
             // Last call (if any) didn't reach end of result set, so we
@@ -978,6 +1554,100 @@ public:
 
 private:
 
+    /// \brief Find the journal entries
+    ///
+    /// Follows the versions of the zone in the journal, from the start
+    /// version to the end one, each entry being the earliest one stored
+    /// after the previous one, and keeps their IDs.
+    ///
+    /// \return false if the journal doesn't have the start version.
+    /// \exception NoSuchSerial the journal has the start version, but
+    ///            the end one can't be reached from it.
+    bool findJournal(int zone_id, uint32_t start, uint32_t end) {
+        sqlite3_stmt* stmt =
+            accessor_->dbparameters_->getStatement(NEXT_JOURNAL);
+        uint32_t serial = start;
+        sqlite3_int64 id = 0;
+        do {
+            reset(NEXT_JOURNAL);
+            bindInt(NEXT_JOURNAL, 1, zone_id);
+            bindInt(NEXT_JOURNAL, 2, serial);
+            bindInt(NEXT_JOURNAL, 3, id);
+            const int rc = sqlite3_step(stmt);
+            if (rc == SQLITE_DONE) {
+                reset(NEXT_JOURNAL);
+                if (entries_.empty()) {
+                    return (false);
+                }
+                bundy_throw(NoSuchSerial, "No entry in journal for zone ID " <<
+                            zone_id << " from serial number " << start <<
+                            " to " << end);
+            } else if (rc != SQLITE_ROW) {
+                bundy_throw(DataSourceError,
+                            "could not get data from journal table: " <<
+                            sqlite3_errmsg(accessor_->dbparameters_->db_));
+            }
+            id = sqlite3_column_int64(stmt, 0);
+            serial = static_cast<uint32_t>(sqlite3_column_int64(stmt, 1));
+            entries_.push_back(id);
+        } while (serial != end);
+        reset(NEXT_JOURNAL);
+        return (true);
+    }
+
+    /// \brief Get the next RR from the journal entries
+    bool getNextJournal(std::string (&data)[COLUMN_COUNT]) {
+        while (offset_ == diffs_.size()) {
+            if (next_entry_ == entries_.size()) {
+                return (false);
+            }
+            loadJournal(entries_[next_entry_++]);
+        }
+        data[NAME_COLUMN] = readField(DIFF_FIELD_LENGTHS[DIFF_NAME]);
+        data[TYPE_COLUMN] = readField(DIFF_FIELD_LENGTHS[DIFF_TYPE]);
+        data[TTL_COLUMN] = readField(DIFF_FIELD_LENGTHS[DIFF_TTL]);
+        data[RDATA_COLUMN] = readField(DIFF_FIELD_LENGTHS[DIFF_RDATA]);
+        return (true);
+    }
+
+    /// \brief Read the RRs of a journal entry
+    void loadJournal(sqlite3_int64 id) {
+        sqlite3_stmt* stmt =
+            accessor_->dbparameters_->getStatement(JOURNAL_DIFFS);
+        reset(JOURNAL_DIFFS);
+        bindInt(JOURNAL_DIFFS, 1, id);
+        if (sqlite3_step(stmt) != SQLITE_ROW) {
+            bundy_throw(DataSourceError,
+                        "could not get data from journal table: " <<
+                        sqlite3_errmsg(accessor_->dbparameters_->db_));
+        }
+        const uint8_t* const blob =
+            static_cast<const uint8_t*>(sqlite3_column_blob(stmt, 0));
+        diffs_.assign(blob, blob + sqlite3_column_bytes(stmt, 0));
+        reset(JOURNAL_DIFFS);
+        offset_ = 0;
+    }
+
+    /// \brief Read a field of an RR of the journal entry
+    ///
+    /// \param length_len The number of octets of the field length.
+    std::string readField(size_t length_len) {
+        if (diffs_.size() - offset_ < length_len) {
+            bundy_throw(DataSourceError, "corrupted journal entry");
+        }
+        size_t length = 0;
+        for (size_t i = 0; i < length_len; ++i) {
+            length = (length << 8) | diffs_[offset_++];
+        }
+        if (diffs_.size() - offset_ < length) {
+            bundy_throw(DataSourceError, "corrupted journal entry");
+        }
+        const std::string field(diffs_.begin() + offset_,
+                                diffs_.begin() + offset_ + length);
+        offset_ += length;
+        return (field);
+    }
+
     /// \brief Reset prepared statement
     ///
     /// Sets up the statement so that new parameters can be attached to it and
@@ -1128,6 +1798,11 @@ private:
 
     boost::shared_ptr<const SQLite3Accessor> accessor_; // Accessor object
     int last_status_;           // Last status received from sqlite3_step
+    bool use_journal_;          // Whether the journal table is read
+    vector<sqlite3_int64> entries_; // IDs of the journal entries
+    size_t next_entry_;         // Index of the next entry to read
+    vector<uint8_t> diffs_;     // RRs of the current journal entry
+    size_t offset_;             // Offset of the next RR in diffs_
 };
 
 // ... and return the iterator
@@ -1190,10 +1865,29 @@ SQLite3Accessor::startUpdateZone(const string& zone_name, const bool replace) {
     dbparameters_->updating_zone = true;
     dbparameters_->updated_zone_id = zone_info.second;
     dbparameters_->updated_zone_origin_ = zone_name;
+    dbparameters_->pending_journal_.clear();
+    dbparameters_->added_records_ = 0;
+    dbparameters_->bulk_load_size_ =
+        (replace && bulk_load_threshold_ > 0) ?
+        std::max(bulk_load_threshold_, getRecordsSize() / 2) : 0;
 
     return (zone_info);
 }
 
+size_t
+SQLite3Accessor::getRecordsSize() {
+    sqlite3_stmt* const stmt = dbparameters_->getStatement(RECORDS_SIZE);
+    const int rc = sqlite3_step(stmt);
+    const sqlite3_int64 size =
+        (rc == SQLITE_ROW) ? sqlite3_column_int64(stmt, 0) : 0;
+    sqlite3_reset(stmt);
+    if (rc != SQLITE_ROW) {
+        bundy_throw(DataSourceError, "failed to get the size of the records "
+                    "table: " << sqlite3_errmsg(dbparameters_->db_));
+    }
+    return (size);
+}
+
 void
 SQLite3Accessor::startTransaction() {
     if (dbparameters_->in_transaction) {
@@ -1213,14 +1907,49 @@ SQLite3Accessor::commit() {
                   "data source without transaction");
     }
 
+    if (bulk_loader_) {
+        bulk_loader_->finish();
+    }
+    writeJournal();
     StatementProcessor(*dbparameters_, COMMIT,
                        "commit an SQLite3 transaction").exec();
+    bulk_loader_.reset();
     dbparameters_->in_transaction = false;
     dbparameters_->updating_zone = false;
     dbparameters_->updated_zone_id = -1;
     dbparameters_->updated_zone_origin_.clear();
 }
 
+void
+SQLite3Accessor::writeJournal() {
+    vector<PendingJournal>& pending = dbparameters_->pending_journal_;
+    if (pending.empty()) {
+        return;
+    }
+
+    const int zone_id = dbparameters_->updated_zone_id;
+    for (vector<PendingJournal>::const_iterator it = pending.begin();
+         it != pending.end();
+         ++it) {
+        StatementProcessor proc(*dbparameters_, ADD_JOURNAL,
+                                "add journal entry");
+        proc.bindInt(1, zone_id);
+        proc.bindInt64(2, it->from_serial_);
+        proc.bindInt64(3, it->to_serial_);
+        proc.bindBlob(4, &it->diffs_[0], it->diffs_.size());
+        proc.exec();
+    }
+    pending.clear();
+
+    if (journal_limit_ > 0) {
+        StatementProcessor proc(*dbparameters_, TRIM_JOURNAL,
+                                "trim the journal");
+        proc.bindInt(1, zone_id);
+        proc.bindInt64(2, journal_limit_);
+        proc.exec();
+    }
+}
+
 void
 SQLite3Accessor::rollback() {
     if (!dbparameters_->in_transaction) {
@@ -1228,6 +1957,9 @@ SQLite3Accessor::rollback() {
                   "data source without transaction");
     }
 
+    // The indexes dropped by a bulk load are restored by the rollback.
+    bulk_loader_.reset();
+    dbparameters_->pending_journal_.clear();
     StatementProcessor(*dbparameters_, ROLLBACK,
                        "rollback an SQLite3 transaction").exec();
     dbparameters_->in_transaction = false;
@@ -1265,8 +1997,18 @@ SQLite3Accessor::addRecordToZone(const string (&columns)[ADD_COLUMN_COUNT]) {
         bundy_throw(DataSourceError, "adding record to SQLite3 "
                   "data source without transaction");
     }
+    if (bulk_loader_ && bulk_loader_->isLoading()) {
+        bulk_loader_->add(columns);
+        return;
+    }
     doUpdate<const string (&)[ADD_COLUMN_COUNT]>(
         *dbparameters_, ADD_RECORD, columns, "add record to zone");
+    if (++dbparameters_->added_records_ == dbparameters_->bulk_load_size_) {
+        LOG_DEBUG(logger, DBG_TRACE_BASIC, DATASRC_SQLITE_BULK_LOAD_START).
+            arg(dbparameters_->updated_zone_origin_).arg(database_name_).
+            arg(dbparameters_->added_records_);
+        bulk_loader_.reset(new BulkLoader(*dbparameters_, database_name_));
+    }
 }
 
 void
@@ -1288,6 +2030,9 @@ SQLite3Accessor::addNSEC3RecordToZone(
           columns[ADD_NSEC3_HASH] + "." + dbparameters_->updated_zone_origin_,
           columns[ADD_NSEC3_TTL],
           columns[ADD_NSEC3_TYPE], columns[ADD_NSEC3_RDATA] };
+    if (bulk_loader_) {
+        bulk_loader_->sync();
+    }
     doUpdate<const string (&)[ADD_NSEC3_COLUMN_COUNT + 1]>(
         *dbparameters_, ADD_NSEC3_RECORD, sqlite3_columns,
         "add NSEC3 record to zone");
@@ -1307,6 +2052,9 @@ SQLite3Accessor::deleteRecordInZone(const string (&params)[DEL_PARAM_COUNT]) {
         params[DEL_TYPE],
         params[DEL_RDATA]
     };
+    if (bulk_loader_) {
+        bulk_loader_->finish();
+    }
     doUpdate<const string (&)[SQLITE3_DEL_PARAM_COUNT]>(
         *dbparameters_, DEL_RECORD, sqlite3_params, "delete record from zone");
 }
@@ -1319,6 +2067,9 @@ SQLite3Accessor::deleteNSEC3RecordInZone(
         bundy_throw(DataSourceError, "deleting NSEC3-related record in SQLite3 "
                   "data source without transaction");
     }
+    if (bulk_loader_) {
+        bulk_loader_->sync();
+    }
     doUpdate<const string (&)[DEL_NSEC3_PARAM_COUNT]>(
         *dbparameters_, DEL_NSEC3_RECORD, params,
         "delete NSEC3 record from zone");
@@ -1339,6 +2090,26 @@ SQLite3Accessor::addRecordDiff(int zone_id, uint32_t serial,
                   << dbparameters_->updated_zone_id);
     }
 
+    if (dbparameters_->has_journal_) {
+        // Deleting an RR after some were added starts the differences of
+        // the next version.
+        vector<PendingJournal>& pending = dbparameters_->pending_journal_;
+        if (pending.empty() ||
+            (operation == DIFF_DELETE && pending.back().added_)) {
+            pending.push_back(PendingJournal(serial));
+        }
+        PendingJournal& journal = pending.back();
+        if (operation == DIFF_ADD && !journal.added_) {
+            journal.to_serial_ = serial;
+            journal.added_ = true;
+        }
+        appendDiff(journal.diffs_, params);
+        return;
+    }
+
+    if (bulk_loader_) {
+        bulk_loader_->sync();
+    }
     StatementProcessor proc(*dbparameters_, ADD_RECORD_DIFF,
                             "add record diff");
     int param_id = 0;
@@ -1355,20 +2126,21 @@ std::string
 SQLite3Accessor::findPreviousName(int zone_id, const std::string& rname)
     const
 {
-    sqlite3_stmt* const stmt = dbparameters_->getStatement(FIND_PREVIOUS);
+    SQLite3Parameters& params = getReadParameters();
+    sqlite3_stmt* const stmt = params.getStatement(FIND_PREVIOUS);
     sqlite3_reset(stmt);
     sqlite3_clear_bindings(stmt);
 
     if (sqlite3_bind_int(stmt, 1, zone_id) != SQLITE_OK) {
         bundy_throw(SQLite3Error, "Could not bind zone ID " << zone_id <<
                   " to SQL statement (find previous): " <<
-                  sqlite3_errmsg(dbparameters_->db_));
+                  sqlite3_errmsg(params.db_));
     }
     if (sqlite3_bind_text(stmt, 2, rname.c_str(), -1, SQLITE_STATIC) !=
         SQLITE_OK) {
         bundy_throw(SQLite3Error, "Could not bind name " << rname <<
                   " to SQL statement (find previous): " <<
-                  sqlite3_errmsg(dbparameters_->db_));
+                  sqlite3_errmsg(params.db_));
     }
 
     std::string result;
@@ -1376,7 +2148,7 @@ SQLite3Accessor::findPreviousName(int zone_id, const std::string& rname)
     if (rc == SQLITE_ROW) {
         // We found it
         result = convertToPlainChar(sqlite3_column_text(stmt, 0),
-                                    dbparameters_->db_);
+                                    params.db_);
     }
     sqlite3_reset(stmt);
 
@@ -1399,20 +2171,21 @@ std::string
 SQLite3Accessor::findPreviousNSEC3Hash(int zone_id, const std::string& hash)
     const
 {
-    sqlite3_stmt* const stmt = dbparameters_->getStatement(NSEC3_PREVIOUS);
+    SQLite3Parameters& params = getReadParameters();
+    sqlite3_stmt* const stmt = params.getStatement(NSEC3_PREVIOUS);
     sqlite3_reset(stmt);
     sqlite3_clear_bindings(stmt);
 
     if (sqlite3_bind_int(stmt, 1, zone_id) != SQLITE_OK) {
         bundy_throw(SQLite3Error, "Could not bind zone ID " << zone_id <<
                   " to SQL statement (find previous NSEC3): " <<
-                  sqlite3_errmsg(dbparameters_->db_));
+                  sqlite3_errmsg(params.db_));
     }
     if (sqlite3_bind_text(stmt, 2, hash.c_str(), -1, SQLITE_STATIC) !=
         SQLITE_OK) {
         bundy_throw(SQLite3Error, "Could not bind hash " << hash <<
                   " to SQL statement (find previous NSEC3): " <<
-                  sqlite3_errmsg(dbparameters_->db_));
+                  sqlite3_errmsg(params.db_));
     }
 
     std::string result;
@@ -1420,7 +2193,7 @@ SQLite3Accessor::findPreviousNSEC3Hash(int zone_id, const std::string& hash)
     if (rc == SQLITE_ROW) {
         // We found it
         result = convertToPlainChar(sqlite3_column_text(stmt, 0),
-                                    dbparameters_->db_);
+                                    params.db_);
     }
     sqlite3_reset(stmt);
 
@@ -1432,21 +2205,21 @@ SQLite3Accessor::findPreviousNSEC3Hash(int zone_id, const std::string& hash)
     if (rc == SQLITE_DONE) {
         // No NSEC3 records before this hash. This means we should wrap
         // around and take the last one.
-        sqlite3_stmt* const stmt = dbparameters_->getStatement(NSEC3_LAST);
+        sqlite3_stmt* const stmt = params.getStatement(NSEC3_LAST);
         sqlite3_reset(stmt);
         sqlite3_clear_bindings(stmt);
 
         if (sqlite3_bind_int(stmt, 1, zone_id) != SQLITE_OK) {
             bundy_throw(SQLite3Error, "Could not bind zone ID " << zone_id <<
                       " to SQL statement (find last NSEC3): " <<
-                      sqlite3_errmsg(dbparameters_->db_));
+                      sqlite3_errmsg(params.db_));
         }
 
         const int rc = sqlite3_step(stmt);
         if (rc == SQLITE_ROW) {
             // We found it
             result = convertToPlainChar(sqlite3_column_text(stmt, 0),
-                                        dbparameters_->db_);
+                                        params.db_);
         }
         sqlite3_reset(stmt);
 
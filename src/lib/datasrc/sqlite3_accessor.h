@@ -78,6 +78,26 @@ struct SQLite3Parameters;
 /// This opens one database file with our schema and serves data from there.
 /// According to the design, it doesn't interpret the data in any way, it just
 /// provides unified access to the DB.
+///
+/// The lookup methods (\c getZone(), \c getRecords(), \c getNSEC3Records(),
+/// \c getAllRecords() and the \c findPrevious methods) can be called from
+/// multiple threads at the same time: the thread that constructed the
+/// accessor uses its main connection, and every other thread uses a
+/// connection of its own, each with its own set of prepared statements.
+/// The update related methods must only be called from the constructing
+/// thread.  Databases created by this class use the SQLite write-ahead
+/// logging mode, in which readers and a writer don't block each other.
+///
+/// The differences added by an update are stored in the journal table,
+/// one row per version of the zone, indexed by the zone and the serial
+/// of the version it starts from, so that an IXFR only looks up one row
+/// per version.  The journal of a zone keeps a limited number of versions
+/// (see \c setJournalLimit()); the older ones are removed when an update
+/// is committed.  Databases of a schema older than 2.3 have no journal
+/// table and keep storing one row per RR in the diffs table.
+///
+/// An update replacing a large zone switches to bulk loading on the way
+/// (see \c setBulkLoadThreshold()).
 class SQLite3Accessor : public DatabaseAccessor,
     public boost::enable_shared_from_this<SQLite3Accessor> {
 public:
@@ -102,8 +122,48 @@ public:
 
     /// This implementation internally opens a new sqlite3 database for the
     /// same file name specified in the constructor of the original accessor.
+    /// The journal limit and the bulk load threshold are copied too.
     virtual boost::shared_ptr<DatabaseAccessor> clone();
 
+    /// \brief The default number of versions kept in the journal of a zone
+    static const size_t DEFAULT_JOURNAL_LIMIT = 1000;
+
+    /// \brief Set the number of versions kept in the journal of a zone
+    ///
+    /// When an update is committed, the differences of the older versions
+    /// of the zone are removed, so that IXFR is only possible from the
+    /// \c limit latest ones.  Zero disables the removal.
+    ///
+    /// \param limit The maximum number of versions in the journal.
+    void setJournalLimit(size_t limit) { journal_limit_ = limit; }
+
+    /// \brief Return the number of versions kept in the journal of a zone
+    size_t getJournalLimit() const { return (journal_limit_); }
+
+    /// \brief The default number of records added before bulk loading
+    static const size_t DEFAULT_BULK_LOAD_THRESHOLD = 100000;
+
+    /// \brief Set the number of records added before bulk loading
+    ///
+    /// Maintaining the indexes of the records table for each inserted row
+    /// is what makes loading a large zone slow.  So an update replacing a
+    /// zone (see \c startUpdateZone()) switches to bulk loading once it
+    /// has added \c threshold records, and at least half as many as the
+    /// table had before (so that loading a small zone in a large database
+    /// doesn't rebuild the indexes of all the other zones): the indexes of
+    /// the records table are dropped, the following records are inserted
+    /// many at a time by a separate thread, and the indexes are built again
+    /// when the update is committed, or as soon as the records are read
+    /// or deleted within the update.  Zero disables bulk loading.
+    ///
+    /// \param threshold The number of records added before bulk loading.
+    void setBulkLoadThreshold(size_t threshold) {
+        bulk_load_threshold_ = threshold;
+    }
+
+    /// \brief Return the number of records added before bulk loading
+    size_t getBulkLoadThreshold() const { return (bulk_load_threshold_); }
+
     /// \brief Look up a zone
     ///
     /// This implements the getZone from DatabaseAccessor and looks up a zone
@@ -205,7 +265,8 @@ public:
     /// \note we are quite impatient here: it's quite possible that the COMMIT
     /// fails due to other process performing SELECT on the same database
     /// (consider the case where COMMIT is done by xfrin or dynamic update
-    /// server while an authoritative server is busy reading the DB).
+    /// server while an authoritative server is busy reading the DB; this
+    /// doesn't happen if the database is in the write-ahead logging mode).
     /// In a future version we should probably need to introduce some retry
     /// attempt and/or increase timeout before giving up the COMMIT, even
     /// if it still doesn't guarantee 100% success.  Right now this
@@ -258,17 +319,43 @@ public:
 private:
     /// \brief Private database data
     boost::scoped_ptr<SQLite3Parameters> dbparameters_;
+    /// \brief Database connections of threads other than the opening one
+    class ReadConnections;
+    boost::scoped_ptr<ReadConnections> read_connections_;
     /// \brief The filename of the DB (necessary for clone())
     const std::string filename_;
     /// \brief The class for which the queries are done
     const std::string class_;
     /// \brief Database name
     const std::string database_name_;
+    /// \brief Number of versions kept in the journal of a zone
+    size_t journal_limit_;
+    /// \brief Number of records added before bulk loading
+    size_t bulk_load_threshold_;
+    /// \brief Inserter of the records of a bulk load
+    class BulkLoader;
+    boost::scoped_ptr<BulkLoader> bulk_loader_;
 
     /// \brief Opens the database
     void open(const std::string& filename);
     /// \brief Closes the database
     void close();
+    /// \brief Return the database data to be used for reading.
+    ///
+    /// This is \c dbparameters_ for the thread that constructed the
+    /// accessor; any other thread gets a separate connection to the same
+    /// database file, opened on its first call.
+    ///
+    /// A bulk load in progress is finished first, so that the records
+    /// added so far are visible and indexed.
+    SQLite3Parameters& getReadParameters() const;
+    /// \brief Store the differences added in the update transaction
+    ///
+    /// Called just before the commit; also removes the versions beyond
+    /// the journal limit.
+    void writeJournal();
+    /// \brief Return the approximate number of rows of the records table
+    size_t getRecordsSize();
 
     /// \brief SQLite3 implementation of IteratorContext for all records
     class Context;
@@ -281,7 +368,11 @@ private:
 /// \brief Creates an instance of the SQlite3 datasource client
 ///
 /// Currently the configuration passed here must be a MapElement, containing
-/// one item called "database_file", whose value is a string
+/// one item called "database_file", whose value is a string, and optionally
+/// "cache_size", a non negative integer passed to
+/// \c DatabaseClient::setCacheSize() (0, the default, disables the cache),
+/// and "journal_limit", a non negative integer passed to
+/// \c SQLite3Accessor::setJournalLimit().
 ///
 /// This configuration setup is currently under discussion and will change in
 /// the near future.
@@ -33,6 +33,8 @@ namespace datasrc {
 namespace {
 
 const char* const CONFIG_ITEM_DATABASE_FILE = "database_file";
+const char* const CONFIG_ITEM_CACHE_SIZE = "cache_size";
+const char* const CONFIG_ITEM_JOURNAL_LIMIT = "journal_limit";
 
 void
 addError(ElementPtr errors, const std::string& error) {
@@ -70,6 +72,24 @@ checkConfig(ConstElementPtr config, ElementPtr errors) {
                      " in SQLite3 backend is empty");
             result = false;
         }
+        if (config->contains(CONFIG_ITEM_CACHE_SIZE) &&
+            (!config->get(CONFIG_ITEM_CACHE_SIZE) ||
+             config->get(CONFIG_ITEM_CACHE_SIZE)->getType() !=
+             Element::integer ||
+             config->get(CONFIG_ITEM_CACHE_SIZE)->intValue() < 0)) {
+            addError(errors, "value of " + string(CONFIG_ITEM_CACHE_SIZE) +
+                     " in SQLite3 backend is not a non negative integer");
+            result = false;
+        }
+        if (config->contains(CONFIG_ITEM_JOURNAL_LIMIT) &&
+            (!config->get(CONFIG_ITEM_JOURNAL_LIMIT) ||
+             config->get(CONFIG_ITEM_JOURNAL_LIMIT)->getType() !=
+             Element::integer ||
+             config->get(CONFIG_ITEM_JOURNAL_LIMIT)->intValue() < 0)) {
+            addError(errors, "value of " + string(CONFIG_ITEM_JOURNAL_LIMIT) +
+                     " in SQLite3 backend is not a non negative integer");
+            result = false;
+        }
     }
 
     return (result);
@@ -92,10 +112,20 @@ createInstance(const std::string& datasrc_name,
     const std::string dbfile =
         config->get(CONFIG_ITEM_DATABASE_FILE)->stringValue();
     try {
-        boost::shared_ptr<DatabaseAccessor> sqlite3_accessor(
+        boost::shared_ptr<SQLite3Accessor> sqlite3_accessor(
             new SQLite3Accessor(dbfile, "IN")); // XXX: avoid hardcode RR class
-        return (new DatabaseClient(datasrc_name, bundy::dns::RRClass::IN(),
-                                   sqlite3_accessor));
+        if (config->contains(CONFIG_ITEM_JOURNAL_LIMIT)) {
+            sqlite3_accessor->setJournalLimit(
+                config->get(CONFIG_ITEM_JOURNAL_LIMIT)->intValue());
+        }
+        DatabaseClient* client =
+            new DatabaseClient(datasrc_name, bundy::dns::RRClass::IN(),
+                               sqlite3_accessor);
+        if (config->contains(CONFIG_ITEM_CACHE_SIZE)) {
+            client->setCacheSize(
+                config->get(CONFIG_ITEM_CACHE_SIZE)->intValue());
+        }
+        return (client);
     } catch (const std::exception& exc) {
         error = std::string("Error creating SQLite3 datasource: ") +
             exc.what();
@@ -311,4 +311,158 @@ TEST_F(CacheConfigTest, getSegmentType) {
                  bundy::data::TypeError);
 }
 
+
+TEST_F(CacheConfigTest, isNameIndexEnabled) {
+    // Disabled by default
+    EXPECT_FALSE(CacheConfig("MasterFiles", 0,
+                             *master_config_, true).isNameIndexEnabled());
+
+    ConstElementPtr config(Element::fromJSON("{\"cache-enable\": true,"
+                                             " \"cache-name-index\": true,"
+                                             " \"params\": {}}" ));
+    EXPECT_TRUE(CacheConfig("MasterFiles", 0, *config,
+                            true).isNameIndexEnabled());
+
+    // Wrong types: should be rejected at construction time
+    ConstElementPtr badconfig(Element::fromJSON("{\"cache-enable\": true,"
+                                                " \"cache-name-index\": 1,"
+                                                " \"params\": {}}"));
+    EXPECT_THROW(CacheConfig("MasterFiles", 0, *badconfig, true),
+                 bundy::data::TypeError);
+}
+
+TEST_F(CacheConfigTest, isSharedLabelsEnabled) {
+    // Disabled by default
+    EXPECT_FALSE(CacheConfig("MasterFiles", 0,
+                             *master_config_, true).isSharedLabelsEnabled());
+
+    ConstElementPtr config(Element::fromJSON("{\"cache-enable\": true,"
+                                             " \"cache-shared-labels\": true,"
+                                             " \"params\": {}}" ));
+    EXPECT_TRUE(CacheConfig("MasterFiles", 0, *config,
+                            true).isSharedLabelsEnabled());
+
+    // Wrong types: should be rejected at construction time
+    ConstElementPtr badconfig(Element::fromJSON("{\"cache-enable\": true,"
+                                                " \"cache-shared-labels\": 1,"
+                                                " \"params\": {}}"));
+    EXPECT_THROW(CacheConfig("MasterFiles", 0, *badconfig, true),
+                 bundy::data::TypeError);
+}
+
+TEST_F(CacheConfigTest, getEncodeThreads) {
+    // 0 by default
+    EXPECT_EQ(0, CacheConfig("MasterFiles", 0,
+                             *master_config_, true).getEncodeThreads());
+
+    ConstElementPtr config(Element::fromJSON("{\"cache-enable\": true,"
+                                             " \"cache-encode-threads\": 4,"
+                                             " \"params\": {}}" ));
+    EXPECT_EQ(4, CacheConfig("MasterFiles", 0, *config,
+                             true).getEncodeThreads());
+
+    // Wrong types or values: should be rejected at construction time
+    ConstElementPtr badconfig(Element::fromJSON(
+                                  "{\"cache-enable\": true,"
+                                  " \"cache-encode-threads\": true,"
+                                  " \"params\": {}}"));
+    EXPECT_THROW(CacheConfig("MasterFiles", 0, *badconfig, true),
+                 bundy::data::TypeError);
+    badconfig = Element::fromJSON("{\"cache-enable\": true,"
+                                  " \"cache-encode-threads\": -1,"
+                                  " \"params\": {}}");
+    EXPECT_THROW(CacheConfig("MasterFiles", 0, *badconfig, true),
+                 CacheConfigError);
+}
+
+TEST_F(CacheConfigTest, isSharedRdataEnabled) {
+    // Disabled by default
+    EXPECT_FALSE(CacheConfig("MasterFiles", 0,
+                             *master_config_, true).isSharedRdataEnabled());
+
+    ConstElementPtr config(Element::fromJSON("{\"cache-enable\": true,"
+                                             " \"cache-shared-rdata\": true,"
+                                             " \"params\": {}}" ));
+    EXPECT_TRUE(CacheConfig("MasterFiles", 0, *config,
+                            true).isSharedRdataEnabled());
+
+    // Wrong types: should be rejected at construction time
+    ConstElementPtr badconfig(Element::fromJSON("{\"cache-enable\": true,"
+                                                " \"cache-shared-rdata\": 1,"
+                                                " \"params\": {}}"));
+    EXPECT_THROW(CacheConfig("MasterFiles", 0, *badconfig, true),
+                 bundy::data::TypeError);
+}
+
+TEST_F(CacheConfigTest, getImageFile) {
+    // Not configured by default
+    EXPECT_EQ("", CacheConfig("MasterFiles", 0,
+                              *master_config_, true).getImageFile());
+
+    ConstElementPtr config(Element::fromJSON("{\"cache-enable\": true,"
+                                             " \"cache-type\": \"mapped\","
+                                             " \"cache-image\": \"a.img\","
+                                             " \"params\": {}}" ));
+    EXPECT_EQ("a.img",
+              CacheConfig("MasterFiles", 0, *config, true).getImageFile());
+
+    // Ignored for non-mapped segments
+    config = Element::fromJSON("{\"cache-enable\": true,"
+                               " \"cache-image\": \"a.img\","
+                               " \"params\": {}}" );
+    EXPECT_EQ("", CacheConfig("MasterFiles", 0, *config, true).getImageFile());
+
+    // Wrong types: should be rejected at construction time
+    ConstElementPtr badconfig(Element::fromJSON("{\"cache-enable\": true,"
+                                                " \"cache-type\": \"mapped\","
+                                                " \"cache-image\": 1,"
+                                                " \"params\": {}}"));
+    EXPECT_THROW(CacheConfig("MasterFiles", 0, *badconfig, true),
+                 bundy::data::TypeError);
+}
+
+TEST_F(CacheConfigTest, getSampleRate) {
+    // 0 (no sampling) by default
+    EXPECT_EQ(0, CacheConfig("MasterFiles", 0,
+                             *master_config_, true).getSampleRate());
+
+    ConstElementPtr config(Element::fromJSON("{\"cache-enable\": true,"
+                                             " \"cache-sample-rate\": 100,"
+                                             " \"params\": {}}" ));
+    EXPECT_EQ(100, CacheConfig("MasterFiles", 0, *config,
+                               true).getSampleRate());
+
+    // Wrong types or values: should be rejected at construction time
+    ConstElementPtr badconfig(Element::fromJSON(
+                                  "{\"cache-enable\": true,"
+                                  " \"cache-sample-rate\": \"100\","
+                                  " \"params\": {}}"));
+    EXPECT_THROW(CacheConfig("MasterFiles", 0, *badconfig, true),
+                 bundy::data::TypeError);
+    badconfig = Element::fromJSON("{\"cache-enable\": true,"
+                                  " \"cache-sample-rate\": -1,"
+                                  " \"params\": {}}");
+    EXPECT_THROW(CacheConfig("MasterFiles", 0, *badconfig, true),
+                 CacheConfigError);
+}
+
+TEST_F(CacheConfigTest, getHotNamesFile) {
+    // Not configured by default
+    EXPECT_EQ("", CacheConfig("MasterFiles", 0,
+                              *master_config_, true).getHotNamesFile());
+
+    ConstElementPtr config(Element::fromJSON("{\"cache-enable\": true,"
+                                             " \"cache-hot-names\": \"hot\","
+                                             " \"params\": {}}" ));
+    EXPECT_EQ("hot",
+              CacheConfig("MasterFiles", 0, *config, true).getHotNamesFile());
+
+    // Wrong types: should be rejected at construction time
+    ConstElementPtr badconfig(Element::fromJSON("{\"cache-enable\": true,"
+                                                " \"cache-hot-names\": 1,"
+                                                " \"params\": {}}"));
+    EXPECT_THROW(CacheConfig("MasterFiles", 0, *badconfig, true),
+                 bundy::data::TypeError);
+}
+
 }
@@ -33,6 +33,7 @@
 
 #include <gtest/gtest.h>
 
+#include <boost/bind.hpp>
 #include <boost/format.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/interprocess/file_mapping.hpp>
@@ -898,6 +899,65 @@ TEST_P(ListTest,
               doReload(Name("example.org")));
 }
 
+// This test relies on the property of mapped type of cache.
+TEST_P(ListTest,
+#ifdef USE_SHARED_MEMORY
+       cacheImage
+#else
+       DISABLED_cacheImage
+#endif
+    )
+{
+    // Build an image of the zone table offline, the way bundy-zonecompile
+    // does.
+    const std::string image_file = getMappedFilename(0);
+    const std::string zone_conf =
+        "   \"type\": \"MasterFiles\","
+        "   \"cache-enable\": true,"
+        "   \"cache-type\": \"mapped\","
+        "   \"params\": {"
+        "       \".\": \"" TEST_DATA_DIR "/root.zone\""
+        "   }";
+    {
+        ConfigurableClientList builder(rrclass_);
+        builder.configure(Element::fromJSON("[{" + zone_conf + "}]"), true);
+        ASSERT_TRUE(builder.resetMemorySegment(
+                        "MasterFiles", memory::ZoneTableSegment::CREATE,
+                        Element::fromJSON("{\"mapped-file\": \"" +
+                                          image_file + "\"}")));
+        const ConfigurableClientList::ZoneWriterPair result =
+            builder.getCachedZoneWriter(Name::ROOT_NAME(), false,
+                                        "MasterFiles");
+        ASSERT_EQ(ConfigurableClientList::ZONE_SUCCESS, result.first);
+        result.second->load();
+        result.second->install();
+        result.second->cleanup();
+    }
+
+    // With the image, the cache is immediately usable (but not writable).
+    list_->configure(Element::fromJSON("[{" + zone_conf + ","
+                                       "   \"cache-image\": \"" +
+                                       image_file + "\"}]"), true);
+    vector<DataSourceStatus> statuses(list_->getStatus());
+    ASSERT_EQ(1, statuses.size());
+    EXPECT_EQ(SEGMENT_INUSE, statuses[0].getSegmentState());
+    positiveResult(list_->find(Name(".")), ds_[0], Name("."), true, "root",
+                   true);
+    EXPECT_EQ(ConfigurableClientList::CACHE_NOT_WRITABLE,
+              list_->getCachedZoneWriter(Name::ROOT_NAME(), false,
+                                         "MasterFiles").first);
+
+    // A bad image is simply ignored, and the cache waits for the segment
+    // to be reset, as if the image weren't specified.
+    list_->configure(Element::fromJSON("[{" + zone_conf + ","
+                                       "   \"cache-image\": \"" +
+                                       getMappedFilename(1) + "\"}]"),
+                     true);
+    statuses = list_->getStatus();
+    ASSERT_EQ(1, statuses.size());
+    EXPECT_EQ(SEGMENT_WAITING, statuses[0].getSegmentState());
+}
+
 TEST_P(ListTest, masterFiles) {
     const ConstElementPtr elem(Element::fromJSON("["
         "{"
@@ -922,6 +982,114 @@ TEST_P(ListTest, masterFiles) {
     EXPECT_EQ(0, list_->getDataSources().size());
 }
 
+TEST_P(ListTest, zoneMemoryUsage) {
+    EXPECT_EQ(0, list_->getZoneMemoryUsage()->size());
+
+    const ConstElementPtr elem(Element::fromJSON("["
+        "{"
+        "   \"type\": \"MasterFiles\","
+        "   \"cache-enable\": true,"
+        "   \"params\": {"
+        "       \"example.com.\": \"" TEST_DATA_DIR "/example.com.flattened\","
+        "       \"example.info.\": \"" TEST_DATA_DIR "/example.info-nonexist\","
+        "       \".\": \"" TEST_DATA_DIR "/root.zone\""
+        "   }"
+        "}]"));
+    list_->configure(elem, true);
+
+    // The zones which couldn't be loaded are omitted.
+    const ConstElementPtr usage = list_->getZoneMemoryUsage();
+    ASSERT_EQ(1, usage->size());
+    const ConstElementPtr zones = usage->get("MasterFiles");
+    ASSERT_TRUE(zones);
+    EXPECT_EQ(2, zones->size());
+    EXPECT_FALSE(zones->contains("example.info."));
+    const char* const names[] = { "example.com.", "." };
+    for (size_t i = 0; i < sizeof(names) / sizeof(*names); ++i) {
+        SCOPED_TRACE(names[i]);
+        const ConstElementPtr zone = zones->get(names[i]);
+        ASSERT_TRUE(zone);
+        EXPECT_LT(0, zone->get("nodes")->intValue());
+        EXPECT_LT(0, zone->get("rdatasets")->intValue());
+        EXPECT_EQ(0, zone->get("nsec3")->intValue());
+        EXPECT_LT(zone->get("nodes")->intValue() +
+                  zone->get("rdatasets")->intValue(),
+                  zone->get("total")->intValue());
+    }
+}
+
+// A list of enough cached data sources uses an index of all their zones to
+// find the best match.  It must give the same results as searching each
+// data source in turn.
+TEST_P(ListTest, zoneIndex) {
+    const ConstElementPtr elem(Element::fromJSON("["
+        "{"
+        "   \"type\": \"MasterFiles\","
+        "   \"cache-enable\": true,"
+        "   \"params\": {"
+        "       \"example.org\": \"" TEST_DATA_DIR "/example.org\""
+        "   },"
+        "   \"name\": \"first\""
+        "},"
+        "{"
+        "   \"type\": \"MasterFiles\","
+        "   \"cache-enable\": true,"
+        "   \"params\": {"
+        "       \".\": \"" TEST_DATA_DIR "/root.zone\","
+        "       \"example.com\": \"" TEST_DATA_DIR "/example.com.flattened\""
+        "   },"
+        "   \"name\": \"second\""
+        "},"
+        "{"
+        "   \"type\": \"MasterFiles\","
+        "   \"cache-enable\": true,"
+        "   \"params\": {"
+        "       \"example.org\": \"" TEST_DATA_DIR "/example.org\","
+        "       \"sql1.example.com\": \"" TEST_DATA_DIR
+        "/sql1.example.com.signed\""
+        "   },"
+        "   \"name\": \"third\""
+        "}]"));
+    list_->configure(elem, true);
+    const std::vector<ConfigurableClientList::DataSourceInfo>& sources =
+        list_->getDataSources();
+    ASSERT_EQ(3, sources.size());
+
+    // The first data source wins for a zone of two of them.
+    const ClientList::FindResult result1(list_->find(Name("www.example.org")));
+    positiveResult(result1, ds_[0], Name("example.org"), false, "first",
+                   true);
+    EXPECT_EQ(sources[0].getCacheClient(), result1.dsrc_client_);
+    const ClientList::FindResult result2(list_->find(Name("example.org"),
+                                                     true));
+    positiveResult(result2, ds_[0], Name("example.org"), true, "exact",
+                   true);
+    EXPECT_EQ(sources[0].getCacheClient(), result2.dsrc_client_);
+
+    // The better match of the later one wins over that of example.com.
+    const ClientList::FindResult result3(
+        list_->find(Name("www.sql1.example.com")));
+    positiveResult(result3, ds_[0], Name("sql1.example.com"), false, "third",
+                   true);
+    EXPECT_EQ(sources[2].getCacheClient(), result3.dsrc_client_);
+
+    // Anything else is in the root zone, but not by exact match.
+    const ClientList::FindResult result4(list_->find(Name("www.example.net")));
+    positiveResult(result4, ds_[0], Name("."), false, "root", true);
+    EXPECT_EQ(sources[1].getCacheClient(), result4.dsrc_client_);
+    EXPECT_TRUE(negative_result_ == list_->find(Name("www.example.net"),
+                                                true));
+
+    // If the data sources are changed behind the list, it doesn't use the
+    // index any more, and searches them in turn.
+    list_->getDataSources().erase(list_->getDataSources().begin());
+    const ClientList::FindResult result5(list_->find(Name("www.example.org")));
+    positiveResult(result5, ds_[0], Name("example.org"), false, "changed",
+                   true);
+    EXPECT_EQ(list_->getDataSources()[1].getCacheClient(),
+              result5.dsrc_client_);
+}
+
 // Test the names are set correctly and collission is detected.
 TEST_P(ListTest, names) {
     // Explicit name
@@ -1025,6 +1193,79 @@ TEST_P(ListTest, BadMasterFile) {
     EXPECT_TRUE(list_->find(Name("example.org."), true) == negative_result_);
 }
 
+// Used as ConfigurableClientList::LoadProgressCallback below.
+void
+countProgress(size_t* found, size_t* loaded, size_t zones_found,
+              size_t zones_loaded)
+{
+    *found += zones_found;
+    *loaded += zones_loaded;
+}
+
+// Load good and bad master files with multiple threads.  The result should
+// be the same as loading them one by one.
+TEST_P(ListTest, parallelLoad) {
+    const ConstElementPtr elem(Element::fromJSON("["
+        "{"
+        "   \"type\": \"MasterFiles\","
+        "   \"cache-enable\": true,"
+        "   \"params\": {"
+        "       \"example.com.\": \"" TEST_DATA_DIR "/example.com.flattened\","
+        "       \"example.net.\": \"" TEST_DATA_DIR "/example.net-empty\","
+        "       \"example.info.\": \"" TEST_DATA_DIR "/example.info-nonexist\","
+        "       \".\": \"" TEST_DATA_DIR "/root.zone\""
+        "   }"
+        "}]"));
+
+    size_t found = 0;
+    size_t loaded = 0;
+    list_->setLoadThreadCount(3);
+    list_->setLoadProgressCallback(boost::bind(countProgress, &found, &loaded,
+                                               _1, _2));
+    list_->configure(elem, true);
+    EXPECT_EQ(4, found);
+    EXPECT_EQ(4, loaded);
+
+    positiveResult(list_->find(Name("example.com."), true), ds_[0],
+                   Name("example.com."), true, "example.com", true);
+    emptyResult(list_->find(Name("example.net."), true), true, "example.net");
+    emptyResult(list_->find(Name("example.info."), true), true,
+                "example.info");
+    positiveResult(list_->find(Name(".")), ds_[0], Name("."), true, "root",
+                   true);
+
+    // The loaded data can be reloaded (and released) in the usual way.
+    EXPECT_EQ(ConfigurableClientList::ZONE_SUCCESS,
+              doReload(Name("example.com.")));
+    positiveResult(list_->find(Name("example.com."), true), ds_[0],
+                   Name("example.com."), true, "example.com", true);
+}
+
+// The zones can also be loaded in parallel into a slab allocated segment.
+TEST_P(ListTest, parallelLoadSlab) {
+    const ConstElementPtr elem(Element::fromJSON("["
+        "{"
+        "   \"type\": \"MasterFiles\","
+        "   \"cache-enable\": true,"
+        "   \"cache-type\": \"local-slab\","
+        "   \"params\": {"
+        "       \"example.com.\": \"" TEST_DATA_DIR "/example.com.flattened\","
+        "       \".\": \"" TEST_DATA_DIR "/root.zone\""
+        "   }"
+        "}]"));
+
+    list_->setLoadThreadCount(2);
+    list_->configure(elem, true);
+    EXPECT_EQ("local-slab", list_->getStatus()[0].getSegmentType());
+
+    positiveResult(list_->find(Name("example.com."), true), ds_[0],
+                   Name("example.com."), true, "example.com", true);
+    positiveResult(list_->find(Name(".")), ds_[0], Name("."), true, "root",
+                   true);
+    EXPECT_EQ(ConfigurableClientList::ZONE_SUCCESS,
+              doReload(Name("example.com.")));
+}
+
 ConfigurableClientList::CacheStatus
 ListTest::doReload(const Name& origin, const string& datasrc_name) {
     ConfigurableClientList::ZoneWriterPair
@@ -0,0 +1,175 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+#include <datasrc/database_cache.h>
+
+#include <dns/name.h>
+#include <dns/rrclass.h>
+#include <dns/rrset.h>
+#include <dns/rrttl.h>
+#include <dns/rrtype.h>
+
+#include <gtest/gtest.h>
+
+using namespace bundy::dns;
+using namespace bundy::datasrc;
+
+namespace {
+
+class DatabaseCacheTest : public ::testing::Test {
+protected:
+    DatabaseCacheTest() :
+        zone1_("example.org"), zone2_("example.com"),
+        rrset_(new RRset(Name("www.example.org"), RRClass::IN(),
+                         RRType::A(), RRTTL(3600)))
+    {
+        DatabaseCache::Entry::RRsetMap rrsets;
+        rrsets[RRType::A()] = rrset_;
+        found_.reset(new DatabaseCache::Entry(true, rrsets));
+        notfound_.reset(new DatabaseCache::Entry(false));
+    }
+
+    DatabaseCache cache_;
+    const Name zone1_;
+    const Name zone2_;
+    const RRsetPtr rrset_;
+    DatabaseCache::ConstEntryPtr found_;
+    DatabaseCache::ConstEntryPtr notfound_;
+};
+
+TEST_F(DatabaseCacheTest, disabled) {
+    EXPECT_EQ(0, cache_.getMaxEntries());
+    const uint64_t generation = cache_.validate(zone1_, 100);
+    EXPECT_FALSE(cache_.insert(generation, zone1_, DatabaseCache::RECORDS,
+                               "www.example.org.", found_));
+    EXPECT_FALSE(cache_.lookup(zone1_, DatabaseCache::RECORDS,
+                               "www.example.org."));
+    EXPECT_EQ(0, cache_.getEntryCount(zone1_));
+}
+
+TEST_F(DatabaseCacheTest, insertAndLookup) {
+    cache_.setMaxEntries(10);
+    const uint64_t generation = cache_.validate(zone1_, 100);
+    EXPECT_TRUE(cache_.insert(generation, zone1_, DatabaseCache::RECORDS,
+                              "www.example.org.", found_));
+    EXPECT_TRUE(cache_.insert(generation, zone1_, DatabaseCache::RECORDS,
+                              "nx.example.org.", notfound_));
+    EXPECT_EQ(2, cache_.getEntryCount(zone1_));
+
+    DatabaseCache::ConstEntryPtr entry =
+        cache_.lookup(zone1_, DatabaseCache::RECORDS, "www.example.org.");
+    ASSERT_TRUE(entry);
+    EXPECT_TRUE(entry->isFound());
+    ASSERT_EQ(1, entry->getRRsets().size());
+    EXPECT_EQ(rrset_, entry->getRRsets().begin()->second);
+
+    entry = cache_.lookup(zone1_, DatabaseCache::RECORDS, "nx.example.org.");
+    ASSERT_TRUE(entry);
+    EXPECT_FALSE(entry->isFound());
+
+    // The lookup type, the name and the zone all matter.
+    EXPECT_FALSE(cache_.lookup(zone1_, DatabaseCache::SUBDOMAINS,
+                               "www.example.org."));
+    EXPECT_FALSE(cache_.lookup(zone1_, DatabaseCache::RECORDS,
+                               "WWW.example.org."));
+    EXPECT_FALSE(cache_.lookup(zone2_, DatabaseCache::RECORDS,
+                               "www.example.org."));
+
+    // The same lookup is replaced.
+    EXPECT_TRUE(cache_.insert(generation, zone1_, DatabaseCache::RECORDS,
+                              "www.example.org.", notfound_));
+    EXPECT_EQ(2, cache_.getEntryCount(zone1_));
+    EXPECT_EQ(notfound_, cache_.lookup(zone1_, DatabaseCache::RECORDS,
+                                       "www.example.org."));
+
+    // Previous names.
+    EXPECT_TRUE(cache_.insert(generation, zone1_,
+                              DatabaseCache::PREVIOUS_NAME,
+                              "org.example.www.",
+                              DatabaseCache::ConstEntryPtr(
+                                  new DatabaseCache::Entry(
+                                      Name("example.org")))));
+    entry = cache_.lookup(zone1_, DatabaseCache::PREVIOUS_NAME,
+                          "org.example.www.");
+    ASSERT_TRUE(entry);
+    EXPECT_EQ(Name("example.org"), entry->getName());
+}
+
+TEST_F(DatabaseCacheTest, leastRecentlyUsed) {
+    cache_.setMaxEntries(2);
+    const uint64_t generation = cache_.validate(zone1_, 100);
+    cache_.insert(generation, zone1_, DatabaseCache::RECORDS, "a.", found_);
+    cache_.insert(generation, zone1_, DatabaseCache::RECORDS, "b.", found_);
+    // Touch "a." so "b." is the least recently used one.
+    EXPECT_TRUE(cache_.lookup(zone1_, DatabaseCache::RECORDS, "a."));
+    cache_.insert(generation, zone1_, DatabaseCache::RECORDS, "c.", found_);
+    EXPECT_EQ(2, cache_.getEntryCount(zone1_));
+    EXPECT_TRUE(cache_.lookup(zone1_, DatabaseCache::RECORDS, "a."));
+    EXPECT_FALSE(cache_.lookup(zone1_, DatabaseCache::RECORDS, "b."));
+    EXPECT_TRUE(cache_.lookup(zone1_, DatabaseCache::RECORDS, "c."));
+
+    // Shrinking the limit removes the older ones.
+    cache_.setMaxEntries(1);
+    EXPECT_EQ(1, cache_.getEntryCount(zone1_));
+    EXPECT_TRUE(cache_.lookup(zone1_, DatabaseCache::RECORDS, "c."));
+
+    // Disabling removes everything.
+    cache_.setMaxEntries(0);
+    EXPECT_EQ(0, cache_.getEntryCount(zone1_));
+}
+
+TEST_F(DatabaseCacheTest, serialChange) {
+    cache_.setMaxEntries(10);
+    const uint64_t generation = cache_.validate(zone1_, 100);
+    cache_.insert(generation, zone1_, DatabaseCache::RECORDS, "a.", found_);
+    cache_.insert(cache_.validate(zone2_, 200), zone2_,
+                  DatabaseCache::RECORDS, "a.", found_);
+
+    // The same serial keeps the data.
+    EXPECT_EQ(generation, cache_.validate(zone1_, 100));
+    EXPECT_TRUE(cache_.lookup(zone1_, DatabaseCache::RECORDS, "a."));
+
+    // A new serial removes it, and results of the old generation are
+    // rejected.  Other zones are intact.
+    const uint64_t new_generation = cache_.validate(zone1_, 101);
+    EXPECT_NE(generation, new_generation);
+    EXPECT_FALSE(cache_.lookup(zone1_, DatabaseCache::RECORDS, "a."));
+    EXPECT_FALSE(cache_.insert(generation, zone1_, DatabaseCache::RECORDS, "a.",
+                               found_));
+    EXPECT_EQ(0, cache_.getEntryCount(zone1_));
+    EXPECT_TRUE(cache_.insert(new_generation, zone1_, DatabaseCache::RECORDS,
+                              "a.", found_));
+    EXPECT_TRUE(cache_.lookup(zone2_, DatabaseCache::RECORDS, "a."));
+}
+
+TEST_F(DatabaseCacheTest, invalidate) {
+    cache_.setMaxEntries(10);
+    const uint64_t generation = cache_.validate(zone1_, 100);
+    cache_.insert(generation, zone1_, DatabaseCache::RECORDS, "a.", found_);
+    cache_.insert(cache_.validate(zone2_, 200), zone2_,
+                  DatabaseCache::RECORDS, "a.", found_);
+
+    cache_.invalidate(zone1_);
+    EXPECT_FALSE(cache_.lookup(zone1_, DatabaseCache::RECORDS, "a."));
+    EXPECT_TRUE(cache_.lookup(zone2_, DatabaseCache::RECORDS, "a."));
+    // A finder created before the invalidation can't fill it again, even
+    // if the serial wasn't changed.
+    EXPECT_FALSE(cache_.insert(generation, zone1_, DatabaseCache::RECORDS, "a.",
+                               found_));
+    EXPECT_NE(generation, cache_.validate(zone1_, 100));
+
+    cache_.clear();
+    EXPECT_FALSE(cache_.lookup(zone2_, DatabaseCache::RECORDS, "a."));
+}
+
+}
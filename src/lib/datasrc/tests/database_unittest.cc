@@ -30,6 +30,9 @@
 
 #include <testutils/dnsmessage_test.h>
 
+#include <util/buffer.h>
+#include <util/unittests/wiredata.h>
+
 #include <gtest/gtest.h>
 
 #include <boost/bind.hpp>
@@ -49,6 +52,8 @@ using boost::lexical_cast;
 using namespace bundy::dns;
 using namespace bundy::testutils;
 using namespace bundy::datasrc::test;
+using bundy::util::OutputBuffer;
+using bundy::util::unittests::matchWireData;
 
 namespace bundy {
 namespace datasrc {
@@ -1579,6 +1584,64 @@ TEST_F(MockDatabaseClientTest, iteratorSeparateRRs) {
                           sizeof(expected_sequence[0]));
 }
 
+TEST_F(MockDatabaseClientTest, iteratorWire) {
+    // The wire data are the same as rendering the individual RRs in order.
+    ZoneIteratorPtr it(client_->getIterator(Name("example.org"), true));
+    OutputBuffer expected(0);
+    size_t expected_count = 0;
+    ConstRRsetPtr rrset;
+    while ((rrset = it->getNextRRset())) {
+        expected_count += rrset->toWire(expected);
+    }
+
+    it = client_->getIterator(Name("example.org"));
+    OutputBuffer actual(0);
+    EXPECT_EQ(expected_count, it->getNextRRs(actual, 65535));
+    matchWireData(expected.getData(), expected.getLength(),
+                  actual.getData(), actual.getLength());
+    EXPECT_EQ(0, it->getNextRRs(actual, 65535));
+    EXPECT_THROW(it->getNextRRs(actual, 65535), bundy::Unexpected);
+
+    // The length limit is soft; it can be mixed with getNextRRset().
+    it = client_->getIterator(Name("example.org"));
+    actual.clear();
+    EXPECT_EQ(1, it->getNextRRs(actual, 1));
+    EXPECT_EQ(1, it->getNextRRs(actual, 1));
+    EXPECT_EQ(RRType::A(), it->getNextRRset()->getType()); // x.example.org
+    EXPECT_LT(2, it->getNextRRs(actual, 65535));
+    EXPECT_EQ(ConstRRsetPtr(), it->getNextRRset());
+}
+
+TEST_F(MockDatabaseClientTest, iteratorText) {
+    // The text is the same as that of the individual RRsets in order.
+    ZoneIteratorPtr it(client_->getIterator(Name("example.org")));
+    string expected;
+    size_t expected_count = 0;
+    ConstRRsetPtr rrset;
+    while ((rrset = it->getNextRRset())) {
+        expected += rrset->toText();
+        expected_count += rrset->getRdataCount();
+        if (rrset->getRRsig()) {
+            expected_count += rrset->getRRsigDataCount();
+        }
+    }
+
+    it = client_->getIterator(Name("example.org"));
+    MasterTextRenderer renderer;
+    EXPECT_EQ(expected_count, it->getNextRRsText(renderer, 65535));
+    EXPECT_EQ(expected, string(renderer.getData(), renderer.getLength()));
+    EXPECT_EQ(0, it->getNextRRsText(renderer, 65535));
+
+    // The length limit is soft; it can be mixed with getNextRRset().
+    it = client_->getIterator(Name("example.org"));
+    renderer.clear();
+    EXPECT_EQ(1, it->getNextRRsText(renderer, 1));
+    EXPECT_EQ(1, it->getNextRRsText(renderer, 1));
+    EXPECT_EQ(RRType::A(), it->getNextRRset()->getType()); // x.example.org
+    EXPECT_LT(2, it->getNextRRsText(renderer, 65535));
+    EXPECT_EQ(ConstRRsetPtr(), it->getNextRRset());
+}
+
 // This has inconsistent TTL in the set (the rest, like nonsense in
 // the data is handled in rdata itself).  Works for the mock accessor only.
 TEST_F(MockDatabaseClientTest, badIterator) {
@@ -3205,6 +3268,43 @@ TEST_P(DatabaseClientTest, flushZone) {
     EXPECT_FALSE(isRollbacked());
 }
 
+TEST_P(DatabaseClientTest, lookupCache) {
+    EXPECT_EQ(0, client_->getCacheSize());
+    client_->setCacheSize(100);
+    EXPECT_EQ(100, client_->getCacheSize());
+    boost::shared_ptr<DatabaseClient::Finder> finder(getFinder());
+
+    // Repeated lookups, either cached or not, give the same results.  Names
+    // matching the same wildcard get their own copies of the RRset.
+    expected_sig_rdatas_.push_back("A 5 3 3600 20000101000000 "
+                                   "20000201000000 12345 example.org. "
+                                   "FAKEFAKEFAKE");
+    for (int i = 0; i < 2; ++i) {
+        expected_rdatas_.clear();
+        expected_rdatas_.push_back("192.0.2.1");
+        doFindTest(*finder, qname_, qtype_, qtype_, rrttl_,
+                   ZoneFinder::SUCCESS, expected_rdatas_, empty_rdatas_);
+        expected_rdatas_.clear();
+        expected_rdatas_.push_back("192.0.2.5");
+        doFindTest(*finder, Name("a.wild.example.org"), qtype_, qtype_,
+                   rrttl_, ZoneFinder::SUCCESS, expected_rdatas_,
+                   expected_sig_rdatas_, ZoneFinder::RESULT_WILDCARD);
+        doFindTest(*finder, Name("b.wild.example.org"), qtype_, qtype_,
+                   rrttl_, ZoneFinder::SUCCESS, expected_rdatas_,
+                   expected_sig_rdatas_, ZoneFinder::RESULT_WILDCARD);
+        EXPECT_EQ(ZoneFinder::NXDOMAIN,
+                  finder->find(Name("nosuchname.example.org"),
+                               qtype_)->code);
+    }
+
+    // Committed updates are visible to the existing and new finders.
+    updater_ = client_->getUpdater(zname_, true);
+    setUpdateAccessor();
+    updater_->commit();
+    EXPECT_EQ(ZoneFinder::NXDOMAIN, finder->find(qname_, qtype_)->code);
+    EXPECT_EQ(ZoneFinder::NXDOMAIN, getFinder()->find(qname_, qtype_)->code);
+}
+
 TEST_P(DatabaseClientTest, updateCancel) {
     // similar to the previous test, but destruct the updater before commit.
 
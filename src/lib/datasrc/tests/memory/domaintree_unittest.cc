@@ -280,6 +280,173 @@ TEST_F(DomainTreeTest, checkDistanceSorted) {
     EXPECT_TRUE(mytree.checkProperties());
 }
 
+TEST_F(DomainTreeTest, checkDistanceAppended) {
+    // Same as checkDistanceSorted, but the names are appended and then
+    // balanced at once.  Each of them has a subdomain, so the tree has
+    // two levels.
+    TreeHolder mytree_holder(mem_sgmt_, TestDomainTree::create(mem_sgmt_));
+    TestDomainTree& mytree = *mytree_holder.get();
+    const int log_num_nodes = 16;
+
+    for (int i = 0; i < (1 << log_num_nodes); i++) {
+        const string namestr(boost::str(boost::format("name%08x.") % i));
+        EXPECT_EQ(TestDomainTree::SUCCESS,
+                  mytree.append(mem_sgmt_, Name(namestr), &dtnode));
+        EXPECT_EQ(static_cast<int*>(NULL), dtnode->setData(new int(i + 1)));
+        EXPECT_EQ(TestDomainTree::SUCCESS,
+                  mytree.append(mem_sgmt_, Name("www." + namestr), &dtnode));
+        EXPECT_EQ(static_cast<int*>(NULL), dtnode->setData(new int(i + 1)));
+    }
+    mytree.finishAppend();
+
+    EXPECT_EQ((1 << log_num_nodes) * 2 + 1, mytree.getNodeCount());
+    EXPECT_GE(2 * log_num_nodes, mytree.getHeight());
+    EXPECT_TRUE(mytree.checkProperties());
+
+    // All names can be found.
+    for (int i = 0; i < (1 << log_num_nodes); i++) {
+        const string namestr(boost::str(boost::format("name%08x.") % i));
+        EXPECT_EQ(TestDomainTree::EXACTMATCH,
+                  mytree.find(Name("www." + namestr), &cdtnode));
+        EXPECT_EQ(i + 1, *cdtnode->getData());
+    }
+}
+
+TEST_F(DomainTreeTest, append) {
+    // Appending the names of the test tree in the DNSSEC order results in
+    // the same set of nodes as inserting them.  The nodes are all empty
+    // here, so the tree exposes them.
+    TreeHolder mytree_holder(mem_sgmt_,
+                             TestDomainTree::create(mem_sgmt_, true));
+    TestDomainTree& mytree = *mytree_holder.get();
+    for (int i = 0; i < ordered_names_count; ++i) {
+        // "d.e.f" is created to split "x.d.e.f" and "z.d.e.f" in the test
+        // tree, but here it's appended first.
+        EXPECT_EQ(TestDomainTree::SUCCESS,
+                  mytree.append(mem_sgmt_, Name(ordered_names[i]), &dtnode));
+    }
+    EXPECT_EQ(dtree.getNodeCount(), mytree.getNodeCount());
+
+    // Names that follow an appended one or the empty node created for it
+    // are already there.
+    EXPECT_EQ(TestDomainTree::ALREADYEXISTS,
+              mytree.append(mem_sgmt_, Name("k.g.h"), &dtnode));
+    EXPECT_EQ(Name("k"), dtnode->getName());
+    EXPECT_EQ(TestDomainTree::ALREADYEXISTS,
+              mytree.append(mem_sgmt_, Name("g.h"), &dtnode));
+    EXPECT_EQ(TestDomainTree::ALREADYEXISTS,
+              mytree.append(mem_sgmt_, Name("."), &dtnode));
+
+    // Others can't be appended, and the tree doesn't change.
+    dtnode = NULL;
+    EXPECT_EQ(TestDomainTree::NOTFOUND,
+              mytree.append(mem_sgmt_, Name("a"), &dtnode));
+    EXPECT_EQ(TestDomainTree::NOTFOUND,
+              mytree.append(mem_sgmt_, Name("d.e.f"), &dtnode));
+    EXPECT_EQ(TestDomainTree::NOTFOUND,
+              mytree.append(mem_sgmt_, Name("h"), &dtnode));
+    EXPECT_EQ(TestDomainTree::NOTFOUND,
+              mytree.append(mem_sgmt_, Name("j.g.h"), &dtnode));
+    EXPECT_EQ(static_cast<TestDomainTreeNode*>(NULL), dtnode);
+    EXPECT_EQ(dtree.getNodeCount(), mytree.getNodeCount());
+
+    // The names can be found even before balancing the tree.
+    for (int i = 0; i < ordered_names_count; ++i) {
+        EXPECT_EQ(TestDomainTree::EXACTMATCH,
+                  mytree.find(Name(ordered_names[i]), &cdtnode));
+    }
+
+    mytree.finishAppend();
+    EXPECT_TRUE(mytree.checkProperties());
+
+    // The nodes have the same upper nodes as in the test tree.
+    for (int i = 0; i < ordered_names_count; ++i) {
+        EXPECT_EQ(TestDomainTree::EXACTMATCH,
+                  mytree.find(Name(ordered_names[i]), &cdtnode));
+        EXPECT_EQ(Name(upper_node_names[i]).toText(),
+                  cdtnode->getUpperNode()->getAbsoluteLabels(buf).toText());
+    }
+
+    // Now the tree can be modified as usual.
+    EXPECT_EQ(TestDomainTree::ALREADYEXISTS,
+              mytree.insert(mem_sgmt_, Name("a"), &dtnode));
+    EXPECT_EQ(TestDomainTree::SUCCESS,
+              mytree.insert(mem_sgmt_, Name("j.g.h"), &dtnode));
+    EXPECT_TRUE(mytree.checkProperties());
+}
+
+TEST_F(DomainTreeTest, finishAppendInserted) {
+    // Balancing a tree built by insert() is harmless.
+    dtree_expose_empty_node.finishAppend();
+    EXPECT_TRUE(dtree_expose_empty_node.checkProperties());
+    EXPECT_EQ(15, dtree_expose_empty_node.getNodeCount());
+
+    TestDomainTreeNodeChain node_path;
+    EXPECT_EQ(TestDomainTree::EXACTMATCH,
+              dtree_expose_empty_node.find(Name("."), &cdtnode, node_path));
+    for (int i = 0; i < ordered_names_count; ++i) {
+        cdtnode = dtree_expose_empty_node.nextNode(node_path);
+        ASSERT_NE(static_cast<const TestDomainTreeNode*>(NULL), cdtnode);
+        EXPECT_EQ(Name(ordered_names[i]), node_path.getAbsoluteName());
+    }
+    EXPECT_EQ(static_cast<const TestDomainTreeNode*>(NULL),
+              dtree_expose_empty_node.nextNode(node_path));
+}
+
+TEST_F(DomainTreeTest, shareLabels) {
+    const char* const names[] = {
+        "example.", "a.example.", "b.example.", "c.example.",
+        "dhcp-10-1-2-3.a.example.", "dhcp-10-1-2-3.b.example.",
+        "dhcp-10-1-2-3.c.example.",
+        // These split a node with shared labels into ones with shared
+        // labels and others with labels in place.
+        "longer-label.sub.a.example.", "other.sub.a.example.",
+        "x.longer-label.b.example.", "y.longer-label.b.example."
+    };
+    const size_t names_count = sizeof(names) / sizeof(*names);
+
+    util::MemorySegmentLocal mem_sgmt;
+    TestDomainTree* tree = TestDomainTree::create(mem_sgmt, true, true);
+    for (size_t i = 0; i < names_count; ++i) {
+        EXPECT_EQ(TestDomainTree::SUCCESS,
+                  tree->insert(mem_sgmt, Name(names[i]), &dtnode));
+        EXPECT_EQ(static_cast<int*>(NULL), dtnode->setData(new int(i)));
+    }
+    EXPECT_TRUE(tree->checkProperties());
+    EXPECT_EQ(13, tree->getNodeCount());
+    // Only "example.", "dhcp-10-1-2-3" and "longer-label" are shared; the
+    // others are small enough to be stored in the nodes.
+    EXPECT_EQ(3, tree->getSharedLabelsCount());
+
+    // The tree works just like one without sharing.
+    for (size_t i = 0; i < names_count; ++i) {
+        EXPECT_EQ(TestDomainTree::EXACTMATCH,
+                  tree->find(Name(names[i]), &cdtnode));
+        EXPECT_EQ(static_cast<int>(i), *cdtnode->getData());
+        EXPECT_EQ(Name(names[i]).toText(),
+                  cdtnode->getAbsoluteLabels(buf).toText());
+    }
+    EXPECT_EQ(TestDomainTree::EXACTMATCH,
+              tree->find(Name("DHCP-10-1-2-3.B.example"), &cdtnode));
+    EXPECT_EQ(5, *cdtnode->getData());
+    EXPECT_EQ(TestDomainTree::EXACTMATCH,
+              tree->find(Name("y.longer-label.b.example"), &cdtnode));
+    EXPECT_EQ(Name("longer-label"), cdtnode->getUpperNode()->getName());
+    EXPECT_EQ(TestDomainTree::PARTIALMATCH,
+              tree->find(Name("dhcp-10-1-2-4.a.example"), &cdtnode));
+
+    // Removing nodes releases their labels.
+    EXPECT_EQ(TestDomainTree::EXACTMATCH,
+              tree->find(Name("dhcp-10-1-2-3.a.example"), &dtnode));
+    tree->remove(mem_sgmt, dtnode, deleteData);
+    EXPECT_EQ(3, tree->getSharedLabelsCount());
+    tree->removeAllNodes(mem_sgmt, deleteData);
+    EXPECT_EQ(0, tree->getSharedLabelsCount());
+
+    TestDomainTree::destroy(mem_sgmt, tree, deleteData);
+    EXPECT_TRUE(mem_sgmt.allMemoryDeallocated());
+}
+
 TEST_F(DomainTreeTest, setGetData) {
     // set new data to an existing node.  It should have some data.
     int* newdata = new int(11);
@@ -477,6 +644,54 @@ TEST_F(DomainTreeTest, remove) {
     }
 }
 
+TEST_F(DomainTreeTest, relocate) {
+    // Relocate each node in turn, and check the tree still has all nodes
+    // in the correct order with their data.
+    for (int j = 0; j < ordered_names_count; ++j) {
+        TreeHolder holder(mem_sgmt_, TestDomainTree::create(mem_sgmt_, true));
+        TestDomainTree& tree(*holder.get());
+        TestDomainTreeNode* node;
+
+        for (int i = 0; i < name_count; ++i) {
+            tree.insert(mem_sgmt_, Name(domain_names[i]), NULL);
+        }
+        for (int i = 0; i < ordered_names_count; ++i) {
+            EXPECT_EQ(TestDomainTree::EXACTMATCH,
+                      tree.find(Name(ordered_names[i]), &node));
+            node->setData(new int(i));
+        }
+
+        EXPECT_EQ(TestDomainTree::EXACTMATCH,
+                  tree.find(Name(ordered_names[j]), &node));
+        node->setFlag(TestDomainTreeNode::FLAG_CALLBACK);
+        TestDomainTreeNode* new_node = tree.relocate(mem_sgmt_, node);
+        EXPECT_NE(node, new_node);
+        EXPECT_EQ(static_cast<int*>(NULL), node->getData());
+        EXPECT_TRUE(new_node->getFlag(TestDomainTreeNode::FLAG_CALLBACK));
+        tree.destroyRelocated(mem_sgmt_, node);
+
+        ASSERT_TRUE(tree.checkProperties());
+        EXPECT_EQ(ordered_names_count + 1, tree.getNodeCount());
+
+        TestDomainTreeNodeChain node_path;
+        const TestDomainTreeNode* cnode;
+        EXPECT_EQ(TestDomainTree::EXACTMATCH,
+                  tree.find(Name(ordered_names[0]), &cnode, node_path));
+        for (int i = 0; i < ordered_names_count; ++i) {
+            ASSERT_NE(static_cast<void*>(NULL), cnode);
+            ASSERT_NE(static_cast<int*>(NULL), cnode->getData());
+            EXPECT_EQ(i, *cnode->getData());
+            const LabelSequence ls(cnode->getAbsoluteLabels(buf));
+            EXPECT_EQ(LabelSequence(Name(ordered_names[i])), ls);
+            if (i == j) {
+                EXPECT_EQ(new_node, cnode);
+            }
+            cnode = tree.nextNode(node_path);
+        }
+        EXPECT_EQ(static_cast<void*>(NULL), cnode);
+    }
+}
+
 TEST_F(DomainTreeTest, removeEmpty) {
     // This test is similar to the .remove test. But it checks node
     // deletion when upper nodes are empty.
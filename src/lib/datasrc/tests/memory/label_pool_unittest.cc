@@ -0,0 +1,141 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+#include <datasrc/memory/label_pool.h>
+
+#include <dns/name.h>
+#include <dns/labelsequence.h>
+
+#include <datasrc/tests/memory/memory_segment_mock.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/lexical_cast.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace bundy::dns;
+using namespace bundy::datasrc::memory;
+using namespace bundy::datasrc::memory::test;
+
+namespace {
+
+class LabelPoolTest : public ::testing::Test {
+protected:
+    void TearDown() {
+        pool_.clear(mem_sgmt_);
+        // detect any memory leak in the test memory segment
+        EXPECT_TRUE(mem_sgmt_.allMemoryDeallocated());
+    }
+
+    const void* add(const std::string& name_txt) {
+        return (pool_.addLabels(mem_sgmt_, LabelSequence(Name(name_txt))));
+    }
+
+    MemorySegmentMock mem_sgmt_;
+    LabelPool pool_;
+};
+
+TEST_F(LabelPoolTest, addAndRelease) {
+    EXPECT_EQ(0, pool_.getLabelsCount());
+
+    const void* data = add("dhcp-10-1-2-3.example.org");
+    EXPECT_EQ("dhcp-10-1-2-3.example.org.", LabelSequence(data).toText());
+    EXPECT_EQ(1, pool_.getLabelsCount());
+
+    // The same sequence is shared.
+    EXPECT_EQ(data, add("dhcp-10-1-2-3.example.org"));
+    EXPECT_EQ(1, pool_.getLabelsCount());
+
+    // Different ones are not, including those differing only in case.
+    const void* data2 = add("dhcp-10-1-2-4.example.org");
+    EXPECT_NE(data, data2);
+    const void* data3 = add("DHCP-10-1-2-3.example.org");
+    EXPECT_NE(data, data3);
+    EXPECT_EQ("DHCP-10-1-2-3.example.org.", LabelSequence(data3).toText());
+    EXPECT_EQ(3, pool_.getLabelsCount());
+
+    // A relative sequence is different from the absolute one.
+    const Name name("dhcp-10-1-2-3.example.org");
+    LabelSequence relative(name);
+    relative.stripRight(1);
+    const void* data4 = pool_.addLabels(mem_sgmt_, relative);
+    EXPECT_NE(data, data4);
+    EXPECT_FALSE(LabelSequence(data4).isAbsolute());
+    EXPECT_EQ(4, pool_.getLabelsCount());
+
+    // The sequence is kept until all references are released.
+    pool_.releaseLabels(mem_sgmt_, data);
+    EXPECT_EQ(4, pool_.getLabelsCount());
+    EXPECT_EQ("dhcp-10-1-2-3.example.org.", LabelSequence(data).toText());
+    pool_.releaseLabels(mem_sgmt_, data);
+    EXPECT_EQ(3, pool_.getLabelsCount());
+
+    pool_.releaseLabels(mem_sgmt_, data2);
+    pool_.releaseLabels(mem_sgmt_, data3);
+    pool_.releaseLabels(mem_sgmt_, data4);
+    EXPECT_EQ(0, pool_.getLabelsCount());
+
+    // Everything but the hash table has been released, and the pool can be
+    // used again.
+    EXPECT_FALSE(mem_sgmt_.allMemoryDeallocated());
+    EXPECT_EQ("dhcp-10-1-2-3.example.org.",
+              LabelSequence(add("dhcp-10-1-2-3.example.org")).toText());
+}
+
+TEST_F(LabelPoolTest, manyLabels) {
+    // Add enough sequences to make the hash table grow a few times.
+    std::vector<const void*> data;
+    for (size_t i = 0; i < 1000; ++i) {
+        data.push_back(add("host" + boost::lexical_cast<std::string>(i)));
+    }
+    EXPECT_EQ(1000, pool_.getLabelsCount());
+    for (size_t i = 0; i < 1000; ++i) {
+        const std::string name_txt("host" +
+                                   boost::lexical_cast<std::string>(i));
+        EXPECT_EQ(data[i], add(name_txt));
+        EXPECT_EQ(name_txt + ".", LabelSequence(data[i]).toText());
+    }
+
+    // Release the even ones.  The odd ones are still there.
+    for (size_t i = 0; i < 1000; i += 2) {
+        pool_.releaseLabels(mem_sgmt_, data[i]);
+        pool_.releaseLabels(mem_sgmt_, data[i]);
+    }
+    EXPECT_EQ(500, pool_.getLabelsCount());
+    for (size_t i = 1; i < 1000; i += 2) {
+        EXPECT_EQ(data[i],
+                  add("host" + boost::lexical_cast<std::string>(i)));
+    }
+
+    // clear() releases the rest regardless of the references (checked in
+    // TearDown()).
+}
+
+TEST_F(LabelPoolTest, allocationFailure) {
+    add("host1");
+
+    // A failure to allocate a new entry doesn't change the pool.
+    mem_sgmt_.setThrowCount(1);
+    EXPECT_THROW(add("host2"), std::bad_alloc);
+    EXPECT_EQ(1, pool_.getLabelsCount());
+
+    // Existing ones can still be added without allocation.
+    mem_sgmt_.setThrowCount(1);
+    add("host1");
+    EXPECT_EQ(1, pool_.getLabelsCount());
+    mem_sgmt_.setThrowCount(0);
+}
+
+}
@@ -16,8 +16,11 @@
 
 #include <exceptions/exceptions.h>
 
+#include <util/buffer.h>
 #include <util/memory_segment_local.h>
+#include <util/unittests/wiredata.h>
 
+#include <dns/messagerenderer.h>
 #include <dns/name.h>
 #include <dns/rrclass.h>
 #include <dns/masterload.h>
@@ -59,6 +62,8 @@ using namespace bundy::testutils;
 using boost::shared_ptr;
 using std::vector;
 using bundy::datasrc::memory::test::loadZoneIntoTable;
+using bundy::util::OutputBuffer;
+using bundy::util::unittests::matchWireData;
 
 namespace {
 
@@ -767,6 +772,94 @@ TEST_F(MemoryClientTest, getIterator) {
     EXPECT_THROW(iterator->getNextRRset(), bundy::Unexpected);
 }
 
+TEST_F(MemoryClientTest, getIteratorWire) {
+    // The default implementation of getNextRRs() renders the RRsets.
+    loadZoneIntoTable(*ztable_segment_, Name("example.org"), zclass_,
+                      TEST_DATA_DIR "/example.org-empty.zone");
+    ZoneIteratorPtr iterator(client_->getIterator(Name("example.org")));
+    OutputBuffer expected(0);
+    size_t count = 0;
+    ConstRRsetPtr rrset;
+    while ((rrset = iterator->getNextRRset())) {
+        // The in-memory RRsets can't be rendered to a buffer directly.
+        RRset copy(rrset->getName(), rrset->getClass(), rrset->getType(),
+                   rrset->getTTL());
+        for (RdataIteratorPtr it = rrset->getRdataIterator(); !it->isLast();
+             it->next()) {
+            copy.addRdata(it->getCurrent());
+        }
+        count += copy.toWire(expected);
+    }
+    EXPECT_EQ(2, count);
+
+    iterator = client_->getIterator(Name("example.org"));
+    OutputBuffer actual(0);
+    EXPECT_EQ(count, iterator->getNextRRs(actual, 65535));
+    matchWireData(expected.getData(), expected.getLength(),
+                  actual.getData(), actual.getLength());
+    EXPECT_EQ(0, iterator->getNextRRs(actual, 65535));
+    EXPECT_EQ(0, iterator->getNextRRs(actual, 65535));
+}
+
+TEST_F(MemoryClientTest, getIteratorRenderRRsets) {
+    loadZoneIntoTable(*ztable_segment_, Name("example.org"), zclass_,
+                      TEST_DATA_DIR "/example.org-nsec3-signed.zone");
+
+    // Render the RRsets other than SOA one by one, as a sender would do
+    // without the bulk method.
+    ZoneIteratorPtr iterator(client_->getIterator(Name("example.org")));
+    MessageRenderer expected;
+    expected.setLengthLimit(65535);
+    size_t count = 0;
+    size_t soa_count = 0;
+    ConstRRsetPtr rrset;
+    while ((rrset = iterator->getNextRRset())) {
+        if (rrset->getType() != RRType::SOA()) {
+            count += rrset->toWire(expected);
+        } else {
+            soa_count = rrset->getRdataCount() +
+                rrset->getRRsigDataCount();
+        }
+    }
+    ASSERT_FALSE(expected.isTruncated());
+
+    // With the largest length limit, the whole zone is rendered at once, with
+    // the same result.
+    iterator = client_->getIterator(Name("example.org"));
+    MessageRenderer actual;
+    actual.setLengthLimit(65535);
+    EXPECT_EQ(count, iterator->renderNextRRsets(actual, true));
+    EXPECT_FALSE(actual.isTruncated());
+    matchWireData(expected.getData(), expected.getLength(),
+                  actual.getData(), actual.getLength());
+    EXPECT_EQ(0, iterator->renderNextRRsets(actual, true));
+
+    // With a small limit, the zone is split into several messages, each
+    // ending before an RRset that doesn't fit.  The same holds with the
+    // SOA, and with the default implementation used for separate RRs.
+    for (int separate = 0; separate < 2; ++separate) {
+        iterator = client_->getIterator(Name("example.org"), separate);
+        size_t total = 0;
+        size_t messages = 0;
+        MessageRenderer chunk;
+        while (true) {
+            chunk.clear();
+            chunk.setLengthLimit(512);
+            const size_t chunk_count = iterator->renderNextRRsets(chunk,
+                                                                  false);
+            EXPECT_GE(512, chunk.getLength());
+            total += chunk_count;
+            ++messages;
+            if (!chunk.isTruncated()) {
+                break;
+            }
+            ASSERT_LT(0, chunk_count);
+        }
+        EXPECT_EQ(count + soa_count, total);
+        EXPECT_LT(1, messages);
+    }
+}
+
 TEST_F(MemoryClientTest, getIteratorForEmptyZone) {
     // trying to load a broken zone (zone file not existent).  It's internally
     // stored an empty zone.
@@ -0,0 +1,228 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+#include <datasrc/memory/nsec3_hash_index.h>
+#include <datasrc/memory/zone_data.h>
+#include <datasrc/memory/zone_data_updater.h>
+
+#include <util/encode/base32hex.h>
+
+#include <dns/name.h>
+#include <dns/rrclass.h>
+
+#include <testutils/dnsmessage_test.h>
+#include <datasrc/tests/memory/memory_segment_mock.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace bundy::dns;
+using namespace bundy::datasrc::memory;
+using namespace bundy::datasrc::memory::test;
+using namespace bundy::testutils;
+using bundy::util::encode::decodeBase32Hex;
+
+namespace {
+
+// Hashes in the order of their values
+const char* const hash1 = "01UDEMVP1J2F7EG6JEBPS17VP3N8I58H";
+const char* const hash2 = "0P9MHAVEQVM6T7VBL5LOP2U3T2RP3TOM";
+const char* const hash3 = "2T7B4G4VSA5SMI47K61MV5BV1A22BOJR";
+const char* const hash4 = "R53BQ7CC2UVMUBFU5OCMM6PERS9TK9EN";
+
+const char* const nsec3_rdata =
+    ".example.org. 300 IN NSEC3 1 1 12 aabbccdd "
+    "2T7B4G4VSA5SMI47K61MV5BV1A22BOJR A RRSIG";
+
+class NSEC3HashIndexTest : public ::testing::Test {
+protected:
+    NSEC3HashIndexTest() :
+        zname_("example.org"),
+        zone_data_(ZoneData::create(mem_sgmt_, zname_)),
+        updater_(new ZoneDataUpdater(mem_sgmt_, RRClass::IN(), zname_,
+                                     *zone_data_)),
+        index_(NULL)
+    {}
+    void TearDown() {
+        if (index_ != NULL) {
+            NSEC3HashIndex::destroy(mem_sgmt_, index_);
+        }
+        updater_.reset();
+        ZoneData::destroy(mem_sgmt_, zone_data_, RRClass::IN());
+        // detect any memory leak in the test memory segment
+        EXPECT_TRUE(mem_sgmt_.allMemoryDeallocated());
+    }
+
+    void addNSEC3(const std::string& hash) {
+        updater_->add(textToRRset(hash + nsec3_rdata), ConstRRsetPtr());
+    }
+
+    const ZoneTree& getTree() const {
+        return (zone_data_->getNSEC3Data()->getNSEC3Tree());
+    }
+
+    void createIndex() {
+        index_ = NSEC3HashIndex::create(mem_sgmt_, getTree(), zname_);
+    }
+
+    const ZoneNode* getTreeNode(const std::string& hash) const {
+        const ZoneNode* node = NULL;
+        if (getTree().find(Name(hash).concatenate(zname_), &node) !=
+            ZoneTree::EXACTMATCH) {
+            return (NULL);
+        }
+        return (node);
+    }
+
+    // Find the hash given in base32hex in the index.
+    const ZoneNode* findIndex(const std::string& hash, bool& exact) const {
+        std::vector<uint8_t> raw;
+        decodeBase32Hex(hash, raw);
+        EXPECT_EQ(index_->getHashLength(), raw.size());
+        return (index_->find(&raw[0], exact));
+    }
+
+    MemorySegmentMock mem_sgmt_;
+    const Name zname_;
+    ZoneData* zone_data_;
+    boost::scoped_ptr<ZoneDataUpdater> updater_;
+    NSEC3HashIndex* index_;
+};
+
+TEST_F(NSEC3HashIndexTest, find) {
+    // Added out of order, and in lower case for one of them.
+    addNSEC3(hash3);
+    addNSEC3(hash1);
+    addNSEC3("r53bq7cc2uvmubfu5ocmm6pers9tk9en");
+    addNSEC3(hash2);
+    createIndex();
+    EXPECT_EQ(4, index_->getNodeCount());
+    EXPECT_EQ(20, index_->getHashLength());
+
+    const char* const hashes[] = { hash1, hash2, hash3, hash4 };
+    for (size_t i = 0; i < 4; ++i) {
+        SCOPED_TRACE(hashes[i]);
+        bool exact = false;
+        EXPECT_EQ(getTreeNode(hashes[i]), findIndex(hashes[i], exact));
+        EXPECT_TRUE(exact);
+    }
+
+    // Hashes between the indexed ones are covered by the smaller one, and
+    // those out of the range by the largest one.
+    bool exact = true;
+    EXPECT_EQ(getTreeNode(hash1),
+              findIndex("01UDEMVP1J2F7EG6JEBPS17VP3N8I58I", exact));
+    EXPECT_FALSE(exact);
+    EXPECT_EQ(getTreeNode(hash3),
+              findIndex("90000000000000000000000000000000", exact));
+    EXPECT_FALSE(exact);
+    EXPECT_EQ(getTreeNode(hash4),
+              findIndex("VVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVV", exact));
+    EXPECT_FALSE(exact);
+    EXPECT_EQ(getTreeNode(hash4),
+              findIndex("00000000000000000000000000000000", exact));
+    EXPECT_FALSE(exact);
+}
+
+TEST_F(NSEC3HashIndexTest, singleHash) {
+    addNSEC3(hash2);
+    createIndex();
+    bool exact = false;
+    EXPECT_EQ(getTreeNode(hash2), findIndex(hash2, exact));
+    EXPECT_TRUE(exact);
+    EXPECT_EQ(getTreeNode(hash2), findIndex(hash1, exact));
+    EXPECT_FALSE(exact);
+    EXPECT_EQ(getTreeNode(hash2), findIndex(hash3, exact));
+    EXPECT_FALSE(exact);
+}
+
+TEST_F(NSEC3HashIndexTest, emptyTree) {
+    addNSEC3(hash1);
+    updater_->remove(textToRRset(std::string(hash1) + nsec3_rdata),
+                     ConstRRsetPtr());
+    createIndex();
+    EXPECT_EQ(0, index_->getNodeCount());
+    EXPECT_EQ(0, index_->getHashLength());
+}
+
+TEST_F(NSEC3HashIndexTest, badHashes) {
+    // Not a base32hex label
+    addNSEC3("ZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZ");
+    EXPECT_THROW(createIndex(), bundy::BadValue);
+    EXPECT_EQ(static_cast<NSEC3HashIndex*>(NULL), index_);
+}
+
+TEST_F(NSEC3HashIndexTest, hashLengthMismatch) {
+    addNSEC3(hash1);
+    addNSEC3("0P9MHAVEQVM6T7VB");
+    EXPECT_THROW(createIndex(), bundy::BadValue);
+}
+
+TEST_F(NSEC3HashIndexTest, noOrigin) {
+    addNSEC3(hash1);
+    EXPECT_THROW(NSEC3HashIndex::create(mem_sgmt_, getTree(),
+                                        Name("example.com")),
+                 bundy::Unexpected);
+}
+
+TEST_F(NSEC3HashIndexTest, allocationFailure) {
+    addNSEC3(hash1);
+    mem_sgmt_.setThrowCount(1);
+    EXPECT_THROW(createIndex(), std::bad_alloc);
+    EXPECT_EQ(static_cast<NSEC3HashIndex*>(NULL), index_);
+}
+
+TEST_F(NSEC3HashIndexTest, updater) {
+    addNSEC3(hash1);
+    addNSEC3(hash2);
+    updater_->buildNSEC3Index();
+    const NSEC3Data* nsec3_data = zone_data_->getNSEC3Data();
+    ASSERT_NE(static_cast<const NSEC3HashIndex*>(NULL),
+              nsec3_data->getHashIndex());
+    EXPECT_EQ(2, nsec3_data->getHashIndex()->getNodeCount());
+
+    // Changing the RRSIGs of an existing hash keeps the index.
+    updater_->add(ConstRRsetPtr(), textToRRset(
+                      std::string(hash1) + ".example.org. 300 IN RRSIG "
+                      "NSEC3 5 3 300 20120814220826 20120715220826 1234 "
+                      "example.org. FAKE"));
+    EXPECT_NE(static_cast<const NSEC3HashIndex*>(NULL),
+              nsec3_data->getHashIndex());
+
+    // A new hash drops it; it can be built again.
+    addNSEC3(hash3);
+    EXPECT_EQ(static_cast<const NSEC3HashIndex*>(NULL),
+              nsec3_data->getHashIndex());
+    updater_->buildNSEC3Index();
+    ASSERT_NE(static_cast<const NSEC3HashIndex*>(NULL),
+              nsec3_data->getHashIndex());
+    EXPECT_EQ(3, nsec3_data->getHashIndex()->getNodeCount());
+
+    // So does the removal of a hash.
+    updater_->remove(textToRRset(std::string(hash3) + nsec3_rdata),
+                     ConstRRsetPtr());
+    EXPECT_EQ(static_cast<const NSEC3HashIndex*>(NULL),
+              nsec3_data->getHashIndex());
+
+    // A zone whose hashes can't be indexed is left without the index.
+    addNSEC3("ZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZ");
+    updater_->buildNSEC3Index();
+    EXPECT_EQ(static_cast<const NSEC3HashIndex*>(NULL),
+              nsec3_data->getHashIndex());
+}
+
+}
@@ -0,0 +1,126 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+#include <datasrc/memory/rdata_pool.h>
+
+#include <datasrc/tests/memory/memory_segment_mock.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/lexical_cast.hpp>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace bundy::datasrc::memory;
+using namespace bundy::datasrc::memory::test;
+
+namespace {
+
+class RdataPoolTest : public ::testing::Test {
+protected:
+    void TearDown() {
+        pool_.clear(mem_sgmt_);
+        // detect any memory leak in the test memory segment
+        EXPECT_TRUE(mem_sgmt_.allMemoryDeallocated());
+    }
+
+    const void* add(const std::string& data) {
+        return (pool_.addData(mem_sgmt_, data.c_str(), data.size()));
+    }
+
+    MemorySegmentMock mem_sgmt_;
+    RdataPool pool_;
+};
+
+TEST_F(RdataPoolTest, addAndRelease) {
+    EXPECT_EQ(0, pool_.getDataCount());
+
+    const std::string text("some encoded rdata");
+    const void* data = add(text);
+    EXPECT_NE(static_cast<const void*>(text.c_str()), data);
+    EXPECT_EQ(0, std::memcmp(text.c_str(), data, text.size()));
+    EXPECT_EQ(1, pool_.getDataCount());
+
+    // The same data is shared.
+    EXPECT_EQ(data, add(text));
+    EXPECT_EQ(1, pool_.getDataCount());
+
+    // Different ones are not, including a prefix of the data.
+    const void* data2 = add("some encoded rdatA");
+    EXPECT_NE(data, data2);
+    const void* data3 = add("some encoded");
+    EXPECT_NE(data, data3);
+    EXPECT_EQ(3, pool_.getDataCount());
+
+    // The data is kept until all references are released.
+    pool_.releaseData(mem_sgmt_, data);
+    EXPECT_EQ(3, pool_.getDataCount());
+    EXPECT_EQ(0, std::memcmp(text.c_str(), data, text.size()));
+    pool_.releaseData(mem_sgmt_, data);
+    EXPECT_EQ(2, pool_.getDataCount());
+
+    pool_.releaseData(mem_sgmt_, data2);
+    pool_.releaseData(mem_sgmt_, data3);
+    EXPECT_EQ(0, pool_.getDataCount());
+
+    // Everything but the hash table has been released, and the pool can be
+    // used again.
+    EXPECT_FALSE(mem_sgmt_.allMemoryDeallocated());
+    EXPECT_EQ(0, std::memcmp(text.c_str(), add(text), text.size()));
+}
+
+TEST_F(RdataPoolTest, manyData) {
+    // Add enough blocks to make the hash table grow a few times.
+    std::vector<const void*> data;
+    for (size_t i = 0; i < 1000; ++i) {
+        data.push_back(add("data" + boost::lexical_cast<std::string>(i)));
+    }
+    EXPECT_EQ(1000, pool_.getDataCount());
+    for (size_t i = 0; i < 1000; ++i) {
+        const std::string text("data" + boost::lexical_cast<std::string>(i));
+        EXPECT_EQ(data[i], add(text));
+        EXPECT_EQ(0, std::memcmp(text.c_str(), data[i], text.size()));
+    }
+
+    // Release the even ones.  The odd ones are still there.
+    for (size_t i = 0; i < 1000; i += 2) {
+        pool_.releaseData(mem_sgmt_, data[i]);
+        pool_.releaseData(mem_sgmt_, data[i]);
+    }
+    EXPECT_EQ(500, pool_.getDataCount());
+    for (size_t i = 1; i < 1000; i += 2) {
+        EXPECT_EQ(data[i], add("data" + boost::lexical_cast<std::string>(i)));
+    }
+
+    // clear() releases the rest regardless of the references (checked in
+    // TearDown()).
+}
+
+TEST_F(RdataPoolTest, allocationFailure) {
+    add("data1");
+
+    // A failure to allocate a new entry doesn't change the pool.
+    mem_sgmt_.setThrowCount(1);
+    EXPECT_THROW(add("data2"), std::bad_alloc);
+    EXPECT_EQ(1, pool_.getDataCount());
+
+    // Existing ones can still be added without allocation.
+    mem_sgmt_.setThrowCount(1);
+    add("data1");
+    EXPECT_EQ(1, pool_.getDataCount());
+    mem_sgmt_.setThrowCount(0);
+}
+
+}
@@ -463,6 +463,45 @@ public:
     }
 };
 
+// Decode using the shortcut for single-field RDATA if possible, and for all
+// RRSIGs.
+class DirectDataDecoder {
+public:
+    static void decode(const bundy::dns::RRClass& rrclass,
+                       const bundy::dns::RRType& rrtype,
+                       size_t rdata_count, size_t sig_count, size_t,
+                       const vector<uint8_t>& encoded_data, size_t,
+                       MessageRenderer& renderer)
+    {
+        RdataReader reader(rrclass, rrtype, &encoded_data[0],
+                           rdata_count, sig_count,
+                           boost::bind(renderNameField, &renderer,
+                                       additionalRequired(rrtype), _1, _2),
+                           boost::bind(renderDataField, &renderer, _1, _2));
+        const void* data;
+        size_t data_len;
+        size_t actual_count = 0;
+        if (reader.hasSingleDataField()) {
+            while (reader.nextRdataData(&data, &data_len)) {
+                renderer.writeData(data, data_len);
+                ++actual_count;
+            }
+        } else {
+            while (reader.iterateRdata()) {
+                ++actual_count;
+            }
+        }
+        EXPECT_EQ(rdata_count, actual_count);
+        actual_count = 0;
+        renderer.writeName(dummyName2());
+        while (reader.nextSigData(&data, &data_len)) {
+            renderer.writeData(data, data_len);
+            ++actual_count;
+        }
+        EXPECT_EQ(sig_count, actual_count);
+    }
+};
+
 // This one does not adhere to the usual way the reader is used, trying
 // to confuse it. It iterates part of the data manually and then reads
 // the rest through iterate. It also reads the signatures in the middle
@@ -518,11 +557,131 @@ public:
     }
 };
 
+// Action objects for RdataFieldReader.
+struct NameFieldRenderer {
+    NameFieldRenderer(MessageRenderer& renderer, const RRType& rrtype) :
+        renderer_(renderer), additional_(additionalRequired(rrtype))
+    {}
+    void operator()(const LabelSequence& labels,
+                    RdataNameAttributes attributes) const
+    {
+        renderNameField(&renderer_, additional_, labels, attributes);
+    }
+    MessageRenderer& renderer_;
+    const bool additional_;
+};
+
+struct DataFieldRenderer {
+    explicit DataFieldRenderer(MessageRenderer& renderer) :
+        renderer_(renderer)
+    {}
+    void operator()(const void* data, size_t data_len) const {
+        renderer_.writeData(data, data_len);
+    }
+    MessageRenderer& renderer_;
+};
+
+typedef RdataFieldReader<NameFieldRenderer, DataFieldRenderer>
+    TestFieldReader;
+
+// Decode with the specialized reader, calling iterate.
+class FieldIterateDecoder {
+public:
+    static void decode(const bundy::dns::RRClass& rrclass,
+                       const bundy::dns::RRType& rrtype,
+                       size_t rdata_count, size_t sig_count, size_t,
+                       const vector<uint8_t>& encoded_data, size_t,
+                       MessageRenderer& renderer)
+    {
+        TestFieldReader reader(rrclass, rrtype, &encoded_data[0],
+                               rdata_count, sig_count,
+                               NameFieldRenderer(renderer, rrtype),
+                               DataFieldRenderer(renderer));
+        reader.iterate();
+        renderer.writeName(dummyName2());
+        reader.iterateAllSigs();
+    }
+};
+
+// Decode with the specialized reader, one RDATA each time.
+class FieldSingleIterateDecoder {
+public:
+    static void decode(const bundy::dns::RRClass& rrclass,
+                       const bundy::dns::RRType& rrtype,
+                       size_t rdata_count, size_t sig_count, size_t,
+                       const vector<uint8_t>& encoded_data, size_t,
+                       MessageRenderer& renderer)
+    {
+        TestFieldReader reader(rrclass, rrtype, &encoded_data[0],
+                               rdata_count, sig_count,
+                               NameFieldRenderer(renderer, rrtype),
+                               DataFieldRenderer(renderer));
+        size_t actual_count = 0;
+        while (reader.iterateRdata()) {
+            ++actual_count;
+        }
+        EXPECT_EQ(rdata_count, actual_count);
+        actual_count = 0;
+        renderer.writeName(dummyName2());
+        while (reader.iterateSingleSig()) {
+            ++actual_count;
+        }
+        EXPECT_EQ(sig_count, actual_count);
+    }
+};
+
+// Decode with the specialized reader, using the shortcuts for single-field
+// data.  The RRSIGs are taken before the RDATA, so they must be located
+// without disturbing the RDATA iteration.
+class FieldDirectDataDecoder {
+public:
+    static void decode(const bundy::dns::RRClass& rrclass,
+                       const bundy::dns::RRType& rrtype,
+                       size_t rdata_count, size_t sig_count, size_t,
+                       const vector<uint8_t>& encoded_data, size_t,
+                       MessageRenderer& renderer)
+    {
+        TestFieldReader reader(rrclass, rrtype, &encoded_data[0],
+                               rdata_count, sig_count,
+                               NameFieldRenderer(renderer, rrtype),
+                               DataFieldRenderer(renderer));
+        const void* data;
+        size_t data_len;
+        vector<uint8_t> sigs;
+        size_t actual_count = 0;
+        while (reader.nextSigData(&data, &data_len)) {
+            sigs.insert(sigs.end(), static_cast<const uint8_t*>(data),
+                        static_cast<const uint8_t*>(data) + data_len);
+            ++actual_count;
+        }
+        EXPECT_EQ(sig_count, actual_count);
+        actual_count = 0;
+        if (reader.hasSingleDataField()) {
+            while (reader.nextRdataData(&data, &data_len)) {
+                renderer.writeData(data, data_len);
+                ++actual_count;
+            }
+        } else {
+            while (reader.iterateRdata()) {
+                ++actual_count;
+            }
+        }
+        EXPECT_EQ(rdata_count, actual_count);
+        renderer.writeName(dummyName2());
+        if (!sigs.empty()) {
+            renderer.writeData(&sigs[0], sigs.size());
+        }
+    }
+};
+
 typedef ::testing::Types<ManualDecoderStyle,
                          CallbackDecoder, IterateDecoder, SingleIterateDecoder,
+                         DirectDataDecoder,
                          HybridDecoder<true, true>, HybridDecoder<true, false>,
                          HybridDecoder<false, true>,
-                         HybridDecoder<false, false> >
+                         HybridDecoder<false, false>,
+                         FieldIterateDecoder, FieldSingleIterateDecoder,
+                         FieldDirectDataDecoder>
     DecoderStyles;
 // Each decoder style must contain a decode() method. Such method is expected
 // to decode the passed data, first render the Rdata into the passed renderer,
@@ -750,6 +909,68 @@ checkLargeData(const in::DHCID* decoded, bool* called, const void* encoded,
     EXPECT_EQ(0, reconstructed.compare(*decoded));
 }
 
+TEST_F(RdataSerializationTest, hasSingleDataField) {
+    // RR types whose RDATA don't contain a domain name.
+    const RRType single_types[] = {
+        RRType::A(), RRType::AAAA(), RRType::TXT(), RRType::DNSKEY(),
+        RRType::DS(), RRType::RRSIG(), RRType::NSEC3(), RRType(65000)
+    };
+    for (size_t i = 0; i < sizeof(single_types) / sizeof(RRType); ++i) {
+        SCOPED_TRACE(single_types[i].toText());
+        EXPECT_TRUE(RdataReader(RRClass::IN(), single_types[i], NULL, 0, 0,
+                                RdataReader::emptyNameAction,
+                                RdataReader::emptyDataAction).
+                    hasSingleDataField());
+    }
+    // And those with domain names.
+    const RRType name_types[] = {
+        RRType::NS(), RRType::CNAME(), RRType::SOA(), RRType::MX(),
+        RRType::SRV(), RRType::NAPTR(), RRType::DNAME(), RRType::NSEC()
+    };
+    for (size_t i = 0; i < sizeof(name_types) / sizeof(RRType); ++i) {
+        SCOPED_TRACE(name_types[i].toText());
+        EXPECT_FALSE(RdataReader(RRClass::IN(), name_types[i], NULL, 0, 0,
+                                 RdataReader::emptyNameAction,
+                                 RdataReader::emptyDataAction).
+                     hasSingleDataField());
+    }
+}
+
+TEST_F(RdataSerializationTest, getRdataLayout) {
+    EXPECT_EQ(RDATA_LAYOUT_IPV4, getRdataLayout(RRClass::IN(), RRType::A()));
+    EXPECT_EQ(RDATA_LAYOUT_IPV6,
+              getRdataLayout(RRClass::IN(), RRType::AAAA()));
+    EXPECT_EQ(RDATA_LAYOUT_ADDITIONAL_NAME,
+              getRdataLayout(RRClass::IN(), RRType::NS()));
+    EXPECT_EQ(RDATA_LAYOUT_COMPRESSIBLE_NAME,
+              getRdataLayout(RRClass::IN(), RRType::CNAME()));
+    EXPECT_EQ(RDATA_LAYOUT_COMPRESSIBLE_NAME,
+              getRdataLayout(RRClass::IN(), RRType::PTR()));
+    EXPECT_EQ(RDATA_LAYOUT_SOA, getRdataLayout(RRClass::IN(), RRType::SOA()));
+    EXPECT_EQ(RDATA_LAYOUT_MX, getRdataLayout(RRClass::IN(), RRType::MX()));
+    EXPECT_EQ(RDATA_LAYOUT_NSEC,
+              getRdataLayout(RRClass::IN(), RRType::NSEC()));
+
+    // Opaque data, including the class-IN specific types in other classes.
+    const RRType opaque_types[] = {
+        RRType::TXT(), RRType::DNSKEY(), RRType::DS(), RRType::RRSIG(),
+        RRType::NSEC3(), RRType(65000)
+    };
+    for (size_t i = 0; i < sizeof(opaque_types) / sizeof(RRType); ++i) {
+        SCOPED_TRACE(opaque_types[i].toText());
+        EXPECT_EQ(RDATA_LAYOUT_OPAQUE,
+                  getRdataLayout(RRClass::IN(), opaque_types[i]));
+    }
+    EXPECT_EQ(RDATA_LAYOUT_OPAQUE, getRdataLayout(RRClass::CH(), RRType::A()));
+
+    // The other ones are read through RdataReader.
+    EXPECT_EQ(RDATA_LAYOUT_OTHER, getRdataLayout(RRClass::IN(), RRType::SRV()));
+    EXPECT_EQ(RDATA_LAYOUT_OTHER,
+              getRdataLayout(RRClass::IN(), RRType::NAPTR()));
+    EXPECT_EQ(RDATA_LAYOUT_OTHER,
+              getRdataLayout(RRClass::IN(), RRType::DNAME()));
+}
+
 TEST_F(RdataSerializationTest, encodeLargeRdata) {
     // There should be no reason for a large RDATA to fail in encoding,
     // but we check such a case explicitly.
@@ -25,6 +25,7 @@
 #include <dns/rrttl.h>
 
 #include <datasrc/memory/segment_object_holder.h>
+#include <datasrc/memory/rdata_pool.h>
 #include <datasrc/memory/rdata_serialization.h>
 #include <datasrc/memory/rdataset.h>
 
@@ -152,6 +153,12 @@ checkRdataSet(const RdataSet& rdataset,
     EXPECT_TRUE(it == expected_data.end());
 }
 
+// A helper callback to record the names of RDATA.
+void
+collectName(const LabelSequence& labels, vector<string>* names) {
+    names->push_back(labels.toText());
+}
+
 TEST_F(RdataSetTest, create) {
     // A simple case of creating an RdataSet.  Confirming the resulting
     // fields have the expected values, and then destroying it (TearDown()
@@ -354,6 +361,62 @@ TEST_F(RdataSetTest, getNext) {
     RdataSet::destroy(mem_sgmt_, rdataset, RRClass::IN());
 }
 
+TEST_F(RdataSetTest, additionalNodes) {
+    EXPECT_TRUE(RdataSet::hasAdditionalNodes(RRType::NS()));
+    EXPECT_TRUE(RdataSet::hasAdditionalNodes(RRType::MX()));
+    EXPECT_TRUE(RdataSet::hasAdditionalNodes(RRType::SRV()));
+    EXPECT_FALSE(RdataSet::hasAdditionalNodes(RRType::A()));
+    EXPECT_FALSE(RdataSet::hasAdditionalNodes(RRType::CNAME()));
+
+    // A type without additional nodes never has them set.
+    SegmentObjectHolder<RdataSet, RRClass> holder1(mem_sgmt_, rrclass);
+    holder1.set(RdataSet::create(mem_sgmt_, encoder_, a_rrset_,
+                                 rrsig_rrset_));
+    EXPECT_FALSE(holder1.get()->isAdditionalNodeSet());
+
+    // For NS, the nodes are initially unset, and become "set" once all of
+    // them are set.  The node pointers are only stored, never dereferenced
+    // here, so we can use fake ones (including NULL).
+    const ConstRRsetPtr ns_rrset = textToRRset(
+        "example.com. 3600 IN NS ns1.example.com.\n"
+        "example.com. 3600 IN NS ns2.example.com.");
+    SegmentObjectHolder<RdataSet, RRClass> holder2(mem_sgmt_, rrclass);
+    holder2.set(RdataSet::create(mem_sgmt_, encoder_, ns_rrset,
+                                 ConstRRsetPtr()));
+    RdataSet* rdataset = holder2.get();
+    EXPECT_FALSE(rdataset->isAdditionalNodeSet());
+
+    const RdataSet::AdditionalNode* const fake_node =
+        reinterpret_cast<const RdataSet::AdditionalNode*>(&fake_node);
+    rdataset->setAdditionalNode(0, fake_node);
+    EXPECT_FALSE(rdataset->isAdditionalNodeSet());
+    rdataset->setAdditionalNode(1, NULL);
+    EXPECT_TRUE(rdataset->isAdditionalNodeSet());
+    EXPECT_EQ(fake_node, rdataset->getAdditionalNode(0));
+    EXPECT_EQ(static_cast<const RdataSet::AdditionalNode*>(NULL),
+              rdataset->getAdditionalNode(1));
+
+    // The nodes don't affect the rest of the data.
+    const RdataSet* const const_rdataset = rdataset;
+    EXPECT_EQ(2, const_rdataset->getRdataCount());
+    EXPECT_EQ(0, const_rdataset->getSigRdataCount());
+    vector<string> names;
+    RdataReader reader(rrclass, RRType::NS(),
+                       reinterpret_cast<const uint8_t*>(
+                           const_rdataset->getDataBuf()),
+                       const_rdataset->getRdataCount(),
+                       const_rdataset->getSigRdataCount(),
+                       boost::bind(collectName, _1, &names),
+                       &RdataReader::emptyDataAction);
+    reader.iterate();
+    ASSERT_EQ(2, names.size());
+    EXPECT_EQ("ns1.example.com.", names[0]);
+    EXPECT_EQ("ns2.example.com.", names[1]);
+
+    rdataset->clearAdditionalNodes();
+    EXPECT_FALSE(rdataset->isAdditionalNodeSet());
+}
+
 TEST_F(RdataSetTest, find) {
     // Create some RdataSets and make a chain of them.
     SegmentObjectHolder<RdataSet, RRClass> holder1(mem_sgmt_, RRClass::IN());
@@ -449,7 +512,8 @@ RdataSetTest::checkCreateManyRRs(CreateFn create_fn, size_t n_old_rdata) {
 
 TEST_F(RdataSetTest, createManyRRs) {
     checkCreateManyRRs(boost::bind(&RdataSet::create, _1, _2, _3, _4,
-                                   static_cast<const RdataSet*>(NULL)), 0);
+                                   static_cast<const RdataSet*>(NULL),
+                                   static_cast<RdataPool*>(NULL)), 0);
 }
 
 TEST_F(RdataSetTest, mergeCreateManyRRs) {
@@ -458,7 +522,9 @@ TEST_F(RdataSetTest, mergeCreateManyRRs) {
     holder.set(RdataSet::create(mem_sgmt_, encoder_, rrset, ConstRRsetPtr()));
 
     checkCreateManyRRs(boost::bind(&RdataSet::create, _1, _2, _3, _4,
-                                   holder.get()), rrset->getRdataCount());
+                                   holder.get(),
+                                   static_cast<RdataPool*>(NULL)),
+                       rrset->getRdataCount());
 }
 
 TEST_F(RdataSetTest, createWithRRSIG) {
@@ -541,7 +607,8 @@ RdataSetTest::checkCreateManyRRSIGs(CreateFn create_fn, size_t n_old_sig) {
 
 TEST_F(RdataSetTest, createManyRRSIGs) {
     checkCreateManyRRSIGs(boost::bind(&RdataSet::create, _1, _2, _3, _4,
-                                      static_cast<const RdataSet*>(NULL)), 0);
+                                      static_cast<const RdataSet*>(NULL),
+                                      static_cast<RdataPool*>(NULL)), 0);
 }
 
 TEST_F(RdataSetTest, mergeCreateManyRRSIGs) {
@@ -554,7 +621,148 @@ TEST_F(RdataSetTest, mergeCreateManyRRSIGs) {
     holder.set(RdataSet::create(mem_sgmt_, encoder_, ConstRRsetPtr(), rrsig));
 
     checkCreateManyRRSIGs(boost::bind(&RdataSet::create, _1, _2, _3, _4,
-                                      holder.get()), rrsig->getRdataCount());
+                                      holder.get(),
+                                      static_cast<RdataPool*>(NULL)),
+                          rrsig->getRdataCount());
+}
+
+TEST_F(RdataSetTest, copy) {
+    // Copy an RdataSet from another segment.  The copy is independent of
+    // the source, so the source segment can be cleaned up first.
+    RdataSet* rdataset;
+    {
+        bundy::util::MemorySegmentLocal src_sgmt;
+        RdataSet* source = RdataSet::create(src_sgmt, encoder_, a_rrset_,
+                                            rrsig_rrset_);
+        rdataset = RdataSet::copy(mem_sgmt_, rrclass, *source);
+        RdataSet::destroy(src_sgmt, source, rrclass);
+        EXPECT_TRUE(src_sgmt.allMemoryDeallocated());
+    }
+    checkRdataSet(*rdataset, def_rdata_txt_, def_rrsig_txt_);
+    RdataSet::destroy(mem_sgmt_, rdataset, rrclass);
+
+    // Many RRSIGs are counted out of the RdataSet itself.
+    RdataSet* source = RdataSet::create(mem_sgmt_, encoder_, a_rrset_,
+                                        getRRSIGWithRdataCount(100));
+    rdataset = RdataSet::copy(mem_sgmt_, rrclass, *source);
+    EXPECT_EQ(1, rdataset->getRdataCount());
+    EXPECT_EQ(100, rdataset->getSigRdataCount());
+    RdataSet::destroy(mem_sgmt_, source, rrclass);
+    RdataSet::destroy(mem_sgmt_, rdataset, rrclass);
+
+    // Additional nodes are not copied.  A fake one is good enough (see the
+    // additionalNodes test).
+    const RdataSet::AdditionalNode* const fake_node =
+        reinterpret_cast<const RdataSet::AdditionalNode*>(&fake_node);
+    source = RdataSet::create(mem_sgmt_, encoder_,
+                              textToRRset("example.com. 3600 IN NS "
+                                          "ns.example.com."),
+                              ConstRRsetPtr());
+    source->setAdditionalNode(0, fake_node);
+    EXPECT_TRUE(source->isAdditionalNodeSet());
+    rdataset = RdataSet::copy(mem_sgmt_, rrclass, *source);
+    EXPECT_FALSE(rdataset->isAdditionalNodeSet());
+    rdataset->setAdditionalNode(0, fake_node);
+    EXPECT_TRUE(rdataset->isAdditionalNodeSet());
+    RdataSet::destroy(mem_sgmt_, source, rrclass);
+    RdataSet::destroy(mem_sgmt_, rdataset, rrclass);
+}
+
+// The encoded data of the RdataSet, shared or not.
+const void*
+getData(const RdataSet* rdataset) {
+    return (rdataset->getDataBuf());
+}
+
+TEST_F(RdataSetTest, sharedData) {
+    RdataPool pool;
+
+    // The A RRset with its RRSIG is large enough to be shared.
+    RdataSet* rdataset1 = RdataSet::create(mem_sgmt_, encoder_, a_rrset_,
+                                           rrsig_rrset_, NULL, &pool);
+    EXPECT_TRUE(rdataset1->hasSharedData());
+    checkRdataSet(*rdataset1, def_rdata_txt_, def_rrsig_txt_);
+    EXPECT_EQ(1, pool.getDataCount());
+
+    // Identical data is shared, including that of a copy.
+    RdataSet* rdataset2 = RdataSet::create(mem_sgmt_, encoder_, a_rrset_,
+                                           rrsig_rrset_, NULL, &pool);
+    EXPECT_EQ(getData(rdataset1), getData(rdataset2));
+    RdataSet* rdataset3 = RdataSet::copy(mem_sgmt_, rrclass, *rdataset1,
+                                         &pool);
+    EXPECT_EQ(getData(rdataset1), getData(rdataset3));
+    checkRdataSet(*rdataset3, def_rdata_txt_, def_rrsig_txt_);
+    EXPECT_EQ(1, pool.getDataCount());
+
+    // Merging and subtracting make new data, which is shared again if it's
+    // identical.
+    const ConstRRsetPtr a_rrset2 =
+        textToRRset("www.example.com. 1076895760 IN A 192.0.2.2");
+    RdataSet* rdataset4 = RdataSet::create(mem_sgmt_, encoder_, a_rrset2,
+                                           ConstRRsetPtr(), rdataset1,
+                                           &pool);
+    EXPECT_TRUE(rdataset4->hasSharedData());
+    EXPECT_NE(getData(rdataset1), getData(rdataset4));
+    EXPECT_EQ(2, rdataset4->getRdataCount());
+    EXPECT_EQ(1, rdataset4->getSigRdataCount());
+    EXPECT_EQ(2, pool.getDataCount());
+    RdataSet* rdataset5 = RdataSet::subtract(mem_sgmt_, encoder_, a_rrset2,
+                                             ConstRRsetPtr(), *rdataset4,
+                                             &pool);
+    EXPECT_EQ(getData(rdataset1), getData(rdataset5));
+    checkRdataSet(*rdataset5, def_rdata_txt_, def_rrsig_txt_);
+
+    // Data not larger than the reference to it isn't shared, nor is that
+    // of an RdataSet with many RRSIGs.
+    RdataSet* small = RdataSet::create(mem_sgmt_, encoder_, a_rrset_,
+                                       ConstRRsetPtr(), NULL, &pool);
+    EXPECT_FALSE(small->hasSharedData());
+    checkRdataSet(*small, def_rdata_txt_, vector<string>());
+    RdataSet* many = RdataSet::create(mem_sgmt_, encoder_, a_rrset_,
+                                      getRRSIGWithRdataCount(7), NULL,
+                                      &pool);
+    EXPECT_FALSE(many->hasSharedData());
+    EXPECT_EQ(7, many->getSigRdataCount());
+    EXPECT_EQ(2, pool.getDataCount());
+
+    // The additional nodes work the same way with shared data.
+    const RdataSet::AdditionalNode* const fake_node =
+        reinterpret_cast<const RdataSet::AdditionalNode*>(&fake_node);
+    RdataSet* ns = RdataSet::create(mem_sgmt_, encoder_,
+                                    textToRRset("example.com. 3600 IN NS "
+                                                "ns1.example.com.\n"
+                                                "example.com. 3600 IN NS "
+                                                "ns2.example.com."),
+                                    ConstRRsetPtr(), NULL, &pool);
+    EXPECT_TRUE(ns->hasSharedData());
+    ns->setAdditionalNode(0, fake_node);
+    ns->setAdditionalNode(1, NULL);
+    EXPECT_TRUE(ns->isAdditionalNodeSet());
+    EXPECT_EQ(fake_node, ns->getAdditionalNode(0));
+    vector<string> names;
+    RdataReader(rrclass, RRType::NS(),
+                reinterpret_cast<const uint8_t*>(getData(ns)),
+                ns->getRdataCount(), ns->getSigRdataCount(),
+                boost::bind(collectName, _1, &names),
+                &RdataReader::emptyDataAction).iterate();
+    ASSERT_EQ(2, names.size());
+    EXPECT_EQ("ns1.example.com.", names[0]);
+    EXPECT_EQ("ns2.example.com.", names[1]);
+    EXPECT_EQ(3, pool.getDataCount());
+
+    // The shared data is released with the last RdataSet referring to it.
+    RdataSet::destroy(mem_sgmt_, rdataset4, rrclass, &pool);
+    EXPECT_EQ(2, pool.getDataCount());
+    RdataSet::destroy(mem_sgmt_, rdataset1, rrclass, &pool);
+    RdataSet::destroy(mem_sgmt_, rdataset2, rrclass, &pool);
+    RdataSet::destroy(mem_sgmt_, rdataset3, rrclass, &pool);
+    EXPECT_EQ(2, pool.getDataCount());
+    RdataSet::destroy(mem_sgmt_, rdataset5, rrclass, &pool);
+    RdataSet::destroy(mem_sgmt_, ns, rrclass, &pool);
+    RdataSet::destroy(mem_sgmt_, small, rrclass, &pool);
+    RdataSet::destroy(mem_sgmt_, many, rrclass, &pool);
+    EXPECT_EQ(0, pool.getDataCount());
+    pool.clear(mem_sgmt_);
 }
 
 TEST_F(RdataSetTest, createWithRRSIGOnly) {
@@ -611,7 +819,8 @@ RdataSetTest::checkBadCreate(CreateFn create_fn) {
 
 TEST_F(RdataSetTest, badCreate) {
     checkBadCreate(boost::bind(&RdataSet::create, _1, _2, _3, _4,
-                               static_cast<const RdataSet*>(NULL)));
+                               static_cast<const RdataSet*>(NULL),
+                               static_cast<RdataPool*>(NULL)));
 }
 
 TEST_F(RdataSetTest, badMergeCreate) {
@@ -623,7 +832,8 @@ TEST_F(RdataSetTest, badMergeCreate) {
                          ConstRRsetPtr()));
 
     checkBadCreate(boost::bind(&RdataSet::create, _1, _2, _3, _4,
-                               holder.get()));
+                               holder.get(),
+                               static_cast<RdataPool*>(NULL)));
 
     // Type mismatch: this case is specific to the merge create.
     EXPECT_THROW(RdataSet::create(mem_sgmt_, encoder_, a_rrset_,
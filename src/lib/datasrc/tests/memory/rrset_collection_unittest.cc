@@ -26,6 +26,9 @@
 
 #include <boost/scoped_ptr.hpp>
 
+#include <string>
+#include <vector>
+
 using namespace bundy::dns;
 using namespace bundy::dns::rdata;
 using namespace std;
@@ -91,4 +94,33 @@ TEST_F(RRsetCollectionTest, find) {
     EXPECT_FALSE(rrset);
 }
 
+TEST_F(RRsetCollectionTest, iterate) {
+    // All RRsets are iterated, in DNSSEC order of their names, and each of
+    // them is the one find() returns.
+    std::vector<std::string> rrsets;
+    for (MemRRsetCollection::Iterator it = collection->begin();
+         it != collection->end();
+         ++it) {
+        const AbstractRRset& rrset = *it;
+        rrsets.push_back(rrset.getName().toText() + "/" +
+                         rrset.getType().toText());
+        const ConstRRsetPtr found = collection->find(rrset.getName(),
+                                                     rrset.getClass(),
+                                                     rrset.getType());
+        ASSERT_TRUE(found);
+        EXPECT_EQ(found->toText(), rrset.toText());
+    }
+    ASSERT_EQ(4, rrsets.size());
+    EXPECT_TRUE(rrsets[0] == "example.org./SOA" ||
+                rrsets[0] == "example.org./NS");
+    EXPECT_TRUE(rrsets[1] == "example.org./SOA" ||
+                rrsets[1] == "example.org./NS");
+    EXPECT_NE(rrsets[0], rrsets[1]);
+    EXPECT_TRUE(rrsets[2] == "www.example.org./A" ||
+                rrsets[2] == "www.example.org./AAAA");
+    EXPECT_TRUE(rrsets[3] == "www.example.org./A" ||
+                rrsets[3] == "www.example.org./AAAA");
+    EXPECT_NE(rrsets[2], rrsets[3]);
+}
+
 } // namespace
@@ -107,8 +107,11 @@ allocateUntilGrows(MemorySegment& segment, size_t& current_size) {
 // Check that the segment thing releases stuff even in case it throws
 // SegmentGrown exception and the thing moves address
 TEST(SegmentObjectHolderTest, grow) {
+    // The segment normally grows in place; it has to be told not to.
     MemorySegmentMapped segment(mapped_file,
-                                bundy::util::MemorySegmentMapped::CREATE_ONLY);
+                                bundy::util::MemorySegmentMapped::CREATE_ONLY,
+                                MemorySegmentMapped::INITIAL_SIZE,
+                                MemorySegmentMapped::MAPPING_NO_RESERVE);
     // Allocate a bit of memory, to get a unique address
     void* mark = segment.allocate(1);
     segment.setNamedAddress("mark", mark);
@@ -520,6 +520,36 @@ TEST_F(TreeNodeRRsetTest, toWireTruncated) {
                       0);   // no RR
 }
 
+TEST_F(TreeNodeRRsetTest, toWireTruncatedWithoutRendering) {
+    MessageRenderer renderer;
+
+    // The A RR can't fit even if its owner name was compressed (2 + 14
+    // octets), so nothing should be rendered, not even the owner name.
+    renderer.setLengthLimit(15);
+    EXPECT_EQ(0, createRRset(rrclass_, www_node_, a_rdataset_,
+                             true)->toWire(renderer));
+    EXPECT_TRUE(renderer.isTruncated());
+    EXPECT_EQ(0, renderer.getLength());
+
+    // Since the owner name wasn't rendered, it shouldn't be remembered for
+    // compression either: the next occurrence is rendered in full form.
+    renderer.setLengthLimit(512);
+    renderer.writeName(www_name_);
+    EXPECT_EQ(www_name_.getLength(), renderer.getLength());
+
+    // Same for RRSIGs, which are always rendered with the shortcut.  The
+    // main RR fits, but its RRSIG doesn't even in the minimum form.
+    renderer.clear();
+    a_rrset_->toWire(renderer);
+    const size_t limit_len = renderer.getLength();
+    renderer.clear();
+    renderer.setLengthLimit(limit_len + 2 + 10);
+    EXPECT_EQ(2, createRRset(rrclass_, www_node_, a_rdataset_,
+                             true)->toWire(renderer));
+    EXPECT_TRUE(renderer.isTruncated());
+    EXPECT_EQ(limit_len, renderer.getLength());
+}
+
 void
 checkRdataIterator(const vector<string>& expected, RdataIteratorPtr rit) {
     for (vector<string>::const_iterator it = expected.begin();
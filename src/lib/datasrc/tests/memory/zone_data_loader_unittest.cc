@@ -18,6 +18,7 @@
 #include <datasrc/memory/rdataset.h>
 #include <datasrc/memory/zone_data.h>
 #include <datasrc/memory/zone_data_updater.h>
+#include <datasrc/memory/zone_name_index.h>
 #include <datasrc/memory/segment_object_holder.h>
 #include <datasrc/client.h>
 #include <datasrc/zone_iterator.h>
@@ -26,6 +27,7 @@
 
 #include <util/buffer.h>
 
+#include <dns/labelsequence.h>
 #include <dns/name.h>
 #include <dns/rrclass.h>
 #include <dns/rdataclass.h>
@@ -39,8 +41,11 @@
 
 #include <gtest/gtest.h>
 
+#include <fstream>
 #include <vector>
 
+#include <unistd.h>
+
 using namespace bundy::dns;
 using namespace bundy::datasrc;
 using namespace bundy::datasrc::memory;
@@ -132,9 +137,9 @@ public:
             }
             diffs_.push_back(soa); // add new SOA
             diffs_.push_back(ns); // add new NS
-            it_ = diffs_.begin();
         }
         diffs_.push_back(ConstRRsetPtr());
+        it_ = diffs_.begin();
     }
     virtual ConstRRsetPtr getNextDiff() {
         const ConstRRsetPtr result = *it_;
@@ -276,6 +281,78 @@ TEST_F(ZoneDataLoaderTest, zoneMinTTL) {
     EXPECT_EQ(RRTTL(1200), RRTTL(b));
 }
 
+// With encoding threads, the RRsets are loaded as usual, including NSEC3s
+// and RRsets of the same type that have to be merged.
+TEST_F(ZoneDataLoaderTest, loadWithEncodeThreads) {
+    zone_data_ = ZoneDataLoader(mem_sgmt_, zclass_, Name("example.org"),
+                                TEST_DATA_DIR
+                                "/example.org-nsec3-signed.zone", NULL,
+                                false, false, 2).load();
+    EXPECT_TRUE(zone_data_->isNSEC3Signed());
+    const ZoneNode* node = NULL;
+    EXPECT_EQ(ZoneTree::EXACTMATCH,
+              zone_data_->getNSEC3Data()->getNSEC3Tree().find(
+                  Name("09GM5T42SMIMT7R8DF6RTG80SFMS1NLU.example.org"),
+                  &node));
+    ASSERT_NE(static_cast<const RdataSet*>(NULL), node->getData());
+    EXPECT_EQ(1, node->getData()->getRdataCount());
+    EXPECT_EQ(1, node->getData()->getSigRdataCount());
+    node = zone_data_->findName(Name("ns.example.org"));
+    ASSERT_NE(static_cast<const ZoneNode*>(NULL), node);
+    const RdataSet* rdset = RdataSet::find(node->getData(), RRType::A());
+    ASSERT_NE(static_cast<const RdataSet*>(NULL), rdset);
+    EXPECT_EQ(1, rdset->getRdataCount());
+    EXPECT_EQ(1, rdset->getSigRdataCount());
+    ZoneData::destroy(mem_sgmt_, zone_data_, zclass_);
+
+    zone_data_ = ZoneDataLoader(mem_sgmt_, zclass_, Name("example.org"),
+                                TEST_DATA_DIR
+                                "/example.org-duplicate-type-bad.zone", NULL,
+                                false, false, 2).load();
+    node = zone_data_->findName(Name("ns1.example.org"));
+    ASSERT_NE(static_cast<const ZoneNode*>(NULL), node);
+    rdset = RdataSet::find(node->getData(), RRType::A());
+    ASSERT_NE(static_cast<const RdataSet*>(NULL), rdset);
+    EXPECT_EQ(2, rdset->getRdataCount());
+}
+
+// The nodes of the frequently queried names given in a file are packed,
+// and the zone is loaded just as without them.
+TEST_F(ZoneDataLoaderTest, loadWithHotNames) {
+    const char* const hot_names_file = TEST_DATA_BUILDDIR "/hot_names";
+    std::ofstream ofs(hot_names_file);
+    ofs << "example.org. ns.example.org. 10\n"
+        << "example.com. www.example.com. 5\n"
+        << "example.org. example.org. 3\n";
+    ofs.close();
+
+    zone_data_ = ZoneDataLoader(mem_sgmt_, zclass_, Name("example.org"),
+                                TEST_DATA_DIR
+                                "/example.org-nsec3-signed.zone", NULL,
+                                true, false, 0, false, hot_names_file).load();
+    EXPECT_EQ(0, unlink(hot_names_file));
+    ASSERT_NE(static_cast<const ZoneNameIndex*>(NULL),
+              zone_data_->getNameIndex());
+    const ZoneNode* node = zone_data_->findName(Name("ns.example.org"));
+    ASSERT_NE(static_cast<const ZoneNode*>(NULL), node);
+    EXPECT_EQ(node, zone_data_->getNameIndex()->find(
+                  LabelSequence(Name("ns.example.org"))));
+    const RdataSet* rdset = RdataSet::find(node->getData(), RRType::A());
+    ASSERT_NE(static_cast<const RdataSet*>(NULL), rdset);
+    EXPECT_EQ(1, rdset->getSigRdataCount());
+    EXPECT_TRUE(zone_data_->getZoneTree().checkProperties());
+    ZoneData::destroy(mem_sgmt_, zone_data_, zclass_);
+
+    // A missing file is ignored.
+    zone_data_ = ZoneDataLoader(mem_sgmt_, zclass_, Name("example.org"),
+                                TEST_DATA_DIR
+                                "/example.org-nsec3-signed.zone", NULL,
+                                false, false, 0, false,
+                                hot_names_file).load();
+    EXPECT_NE(static_cast<const ZoneNode*>(NULL),
+              zone_data_->findName(Name("ns.example.org")));
+}
+
 void
 ZoneDataLoaderTest::loadFromDataSourceCommon(bool incremental) {
     const Name origin("example.com");
@@ -373,6 +450,30 @@ TEST_F(ZoneDataLoaderTest, loadFromDataSourceIncremental) {
     loadFromDataSourceCommon(true);
 }
 
+TEST_F(ZoneDataLoaderTest, loadFromJournalWithNameIndex) {
+    const Name origin("example.com");
+    MockDataSourceClient dsc;
+
+    // The initial load builds the index.
+    ZoneDataLoader loader1(mem_sgmt_, zclass_, origin, dsc, NULL, true);
+    zone_data_ = checkLoad(loader1, false);
+    const ZoneNameIndex* index = zone_data_->getNameIndex();
+    ASSERT_NE(static_cast<const ZoneNameIndex*>(NULL), index);
+    const size_t name_count = index->getNameCount();
+
+    // Applying diffs from the journal updates the same index in place,
+    // rather than rebuilding it for the entire zone.
+    dsc.serial_ = 2;
+    dsc.use_journal_ = true;
+    ZoneDataLoader loader2(mem_sgmt_, zclass_, origin, dsc, zone_data_, true);
+    checkLoad(loader2, false, true);
+    EXPECT_EQ(zone_data_, loader2.commit(zone_data_));
+    EXPECT_EQ(index, zone_data_->getNameIndex());
+    EXPECT_EQ(name_count, index->getNameCount());
+    EXPECT_NE(static_cast<const ZoneNode*>(NULL),
+              index->find(LabelSequence(origin)));
+}
+
 TEST_F(ZoneDataLoaderTest, loadFromBadDataSource) {
     // Even if getIterator() returns NULL, it shouldn't cause a crash.
     MockDataSourceClient dsc;
@@ -423,14 +524,15 @@ TEST_F(ZoneDataLoaderTest, loadToBeNSEC3Unsigned) {
 }
 
 // Load bunch of small zones, hoping some of the relocation will happen
-// during the memory creation, not only Rdata creation.
+// during the memory creation, not only Rdata creation.  The segment is told
+// not to grow in place so it's relocated.
 // Note: this doesn't even compile unless USE_SHARED_MEMORY is defined.
 void
 ZoneDataLoaderTest::relocateCommon(bool incremental) {
     const char* const mapped_file = TEST_DATA_BUILDDIR "/test.mapped";
     MemorySegmentMapped segment(mapped_file,
                                 bundy::util::MemorySegmentMapped::CREATE_ONLY,
-                                4096);
+                                4096, MemorySegmentMapped::MAPPING_NO_RESERVE);
     const size_t zone_count = 10000;
     typedef SegmentObjectHolder<ZoneData, RRClass> Holder;
     typedef boost::shared_ptr<Holder> HolderPtr;
@@ -33,6 +33,8 @@
 
 #include <gtest/gtest.h>
 
+#include <boost/lexical_cast.hpp>
+
 #include <new>                  // for bad_alloc
 #include <string>
 
@@ -189,6 +191,117 @@ TEST_F(ZoneDataTest, exceptionSafetyOnCreate) {
     // (that would be caught in TearDown()).
 }
 
+TEST_F(ZoneDataTest, shareLabels) {
+    ZoneData* zone_data = ZoneData::create(mem_sgmt_, zname_, true);
+    const char* const names[] = {
+        "a.example.com", "b.example.com", "host-1.a.example.com",
+        "host-1.b.example.com"
+    };
+    for (size_t i = 0; i < sizeof(names) / sizeof(*names); ++i) {
+        ZoneNode* node = NULL;
+        zone_data->insertName(mem_sgmt_, Name(names[i]), &node);
+        EXPECT_EQ(node, zone_data->findName(Name(names[i])));
+    }
+    // The origin name and "host-1" are shared; "a" and "b" are small
+    // enough to be stored in the nodes.
+    EXPECT_EQ(2, zone_data->getZoneTree().getSharedLabelsCount());
+    EXPECT_EQ(LabelSequence(zname_), zone_data->getOriginNode()->getLabels());
+    ZoneData::destroy(mem_sgmt_, zone_data, RRClass::IN());
+
+    // A failure in any allocation on creation doesn't cause leak (caught
+    // in TearDown()): the tree, the pool's hash table and the labels of
+    // the origin, the origin node and the zone data.
+    for (size_t count = 2; count <= 5; ++count) {
+        mem_sgmt_.setThrowCount(count);
+        EXPECT_THROW(ZoneData::create(mem_sgmt_, zname_, true),
+                     std::bad_alloc);
+    }
+}
+
+TEST_F(ZoneDataTest, shareRdata) {
+    // Not shared by default.
+    EXPECT_EQ(static_cast<const RdataPool*>(NULL),
+              static_cast<const ZoneData*>(zone_data_)->getRdataPool());
+
+    ZoneData* zone_data = ZoneData::create(mem_sgmt_, zname_, false, true);
+    RdataPool* pool = zone_data->getRdataPool();
+    ASSERT_NE(static_cast<RdataPool*>(NULL), pool);
+    const ConstRRsetPtr ns_rrset =
+        textToRRset("example.com. 3600 IN NS ns1.example.net.\n"
+                    "example.com. 3600 IN NS ns2.example.net.");
+    const char* const names[] = { "a.example.com", "b.example.com" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(*names); ++i) {
+        ZoneNode* node = NULL;
+        zone_data->insertName(mem_sgmt_, Name(names[i]), &node);
+        node->setData(RdataSet::create(mem_sgmt_, encoder_, ns_rrset,
+                                       ConstRRsetPtr(), NULL, pool));
+    }
+    EXPECT_EQ(1, pool->getDataCount());
+
+    // The RdataSets and the pool are released with the zone data (leaks
+    // would be caught in TearDown()).
+    ZoneData::destroy(mem_sgmt_, zone_data, RRClass::IN());
+}
+
+TEST_F(ZoneDataTest, getMemoryUsage) {
+    // Only the zone data object, the tree and its origin node.
+    const ZoneData::MemoryUsage empty_usage =
+        zone_data_->getMemoryUsage(RRClass::IN());
+    EXPECT_LT(0, empty_usage.nodes);
+    EXPECT_EQ(0, empty_usage.rdatasets);
+    EXPECT_EQ(0, empty_usage.nsec3);
+    EXPECT_EQ(mem_sgmt_.getAllocatedSize(), empty_usage.total);
+
+    // The usage accounts for every byte allocated for the zone, with
+    // shared labels and RDATA, many RRSIGs and NSEC3.
+    const size_t base_size = mem_sgmt_.getAllocatedSize();
+    ZoneData* zone_data = ZoneData::create(mem_sgmt_, zname_, true, true);
+    const ConstRRsetPtr ns_rrset =
+        textToRRset("example.com. 3600 IN NS ns1.example.net.\n"
+                    "example.com. 3600 IN NS ns2.example.net.");
+    std::string sig_text;
+    for (int i = 0; i < 8; ++i) {
+        sig_text += "www.example.com. 3600 IN RRSIG A 5 3 3600 "
+            "20150420235959 20051021000000 " +
+            boost::lexical_cast<std::string>(i) +
+            " example.com. FAKEFAKEFAKE\n";
+    }
+    const ConstRRsetPtr sig_rrset = textToRRset(sig_text);
+    const char* const names[] = { "a.example.com", "b.example.com" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(*names); ++i) {
+        ZoneNode* node = NULL;
+        zone_data->insertName(mem_sgmt_, Name(names[i]), &node);
+        node->setData(RdataSet::create(mem_sgmt_, encoder_, ns_rrset,
+                                       ConstRRsetPtr(), NULL,
+                                       zone_data->getRdataPool()));
+    }
+    ZoneNode* node = NULL;
+    zone_data->insertName(mem_sgmt_, a_rrset_->getName(), &node);
+    node->setData(RdataSet::create(mem_sgmt_, encoder_, a_rrset_, sig_rrset,
+                                   NULL, zone_data->getRdataPool()));
+    const ZoneData::MemoryUsage usage =
+        zone_data->getMemoryUsage(RRClass::IN());
+    EXPECT_EQ(0, usage.nsec3);
+
+    NSEC3Data* nsec3_data = NSEC3Data::create(mem_sgmt_, zname_,
+                                              param_rdata_);
+    zone_data->setNSEC3Data(nsec3_data);
+    nsec3_data->insertName(mem_sgmt_, nsec3_rrset_->getName(), &node);
+    node->setData(RdataSet::create(mem_sgmt_, encoder_, nsec3_rrset_,
+                                   ConstRRsetPtr()));
+    const ZoneData::MemoryUsage nsec3_usage =
+        zone_data->getMemoryUsage(RRClass::IN());
+    EXPECT_EQ(usage.nodes, nsec3_usage.nodes);
+    EXPECT_EQ(usage.rdatasets, nsec3_usage.rdatasets);
+    EXPECT_LT(0, nsec3_usage.nsec3);
+    EXPECT_EQ(mem_sgmt_.getAllocatedSize() - base_size, nsec3_usage.total);
+    EXPECT_EQ(nsec3_usage.total, sizeof(ZoneData) + nsec3_usage.nodes +
+              nsec3_usage.rdatasets + nsec3_usage.nsec3);
+
+    ZoneData::destroy(mem_sgmt_, zone_data, RRClass::IN());
+    EXPECT_EQ(base_size, mem_sgmt_.getAllocatedSize());
+}
+
 TEST_F(ZoneDataTest, addRdataSets) {
     // Insert a name to the zone, and add a couple the data (RdataSet) objects
     // to the corresponding node.
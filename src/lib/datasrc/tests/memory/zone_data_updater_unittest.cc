@@ -17,11 +17,14 @@
 #include <datasrc/memory/zone_data_updater.h>
 #include <datasrc/memory/rdataset.h>
 #include <datasrc/memory/zone_data.h>
+#include <datasrc/memory/zone_name_index.h>
+#include <datasrc/memory/treenode_rrset.h>
 
 #include <testutils/dnsmessage_test.h>
 
 #include <exceptions/exceptions.h>
 
+#include <dns/labelsequence.h>
 #include <dns/name.h>
 #include <dns/rrclass.h>
 #include <dns/rrset.h>
@@ -37,6 +40,9 @@
 #include <boost/lexical_cast.hpp>
 
 #include <cassert>
+#include <string>
+#include <utility>
+#include <vector>
 
 using bundy::testutils::textToRRset;
 using namespace bundy::dns;
@@ -69,6 +75,14 @@ getNode(bundy::util::MemorySegment& mem_sgmt, const Name& name,
     return (node);
 }
 
+// Look up the name in the name index of the zone data, which must exist.
+const ZoneNode*
+findInIndex(const ZoneData* zone_data, const Name& name) {
+    const ZoneNameIndex* index = zone_data->getNameIndex();
+    EXPECT_NE(static_cast<const ZoneNameIndex*>(NULL), index);
+    return (index ? index->find(LabelSequence(name)) : NULL);
+}
+
 class ZoneDataUpdaterTest : public ::testing::TestWithParam<SegmentCreator*> {
 protected:
     ZoneDataUpdaterTest() :
@@ -92,12 +106,13 @@ protected:
         GetParam()->cleanup();
     }
 
-    void clearZoneData() {
+    void clearZoneData(bool share_rdata = false) {
         assert(updater_);
         ZoneData::destroy(*mem_sgmt_, getZoneData(), zclass_);
         mem_sgmt_->clearNamedAddress("Test zone data");
         updater_.reset();
-        ZoneData* data = ZoneData::create(*mem_sgmt_, zname_);
+        ZoneData* data = ZoneData::create(*mem_sgmt_, zname_, false,
+                                          share_rdata);
         mem_sgmt_->setNamedAddress("Test zone data", data);
         updater_.reset(new ZoneDataUpdater(*mem_sgmt_, zclass_, zname_,
                                            *data));
@@ -146,29 +161,37 @@ INSTANTIATE_TEST_CASE_P(LocalSegment, ZoneDataUpdaterTest,
 class MappedSegmentCreator : public SegmentCreator {
 public:
     MappedSegmentCreator(size_t initial_size =
-                         bundy::util::MemorySegmentMapped::INITIAL_SIZE) :
-        initial_size_(initial_size)
+                         bundy::util::MemorySegmentMapped::INITIAL_SIZE,
+                         int mapping_flags =
+                         bundy::util::MemorySegmentMapped::MAPPING_DEFAULT) :
+        initial_size_(initial_size), mapping_flags_(mapping_flags)
     {}
     virtual SegmentPtr create() const {
         return (SegmentPtr(new bundy::util::MemorySegmentMapped(
                                mapped_file,
                                bundy::util::MemorySegmentMapped::CREATE_ONLY,
-                               initial_size_)));
+                               initial_size_, mapping_flags_)));
     }
     virtual void cleanup() const {
         EXPECT_EQ(0, unlink(mapped_file));
     }
 private:
     const size_t initial_size_;
+    const int mapping_flags_;
 };
 
 // There should be no initialization fiasco there. We only set int value inside
-// and don't use it until the create() is called.
-MappedSegmentCreator small_creator(4092), default_creator;
+// and don't use it until the create() is called.  The segments normally grow
+// in place; relocating_creator makes sure the updater also copes with the
+// segment being relocated.
+MappedSegmentCreator small_creator(4092), default_creator,
+    relocating_creator(4092,
+                       bundy::util::MemorySegmentMapped::MAPPING_NO_RESERVE);
 
 INSTANTIATE_TEST_CASE_P(MappedSegment, ZoneDataUpdaterTest, ::testing::Values(
                             static_cast<SegmentCreator*>(&small_creator),
-                            static_cast<SegmentCreator*>(&default_creator)));
+                            static_cast<SegmentCreator*>(&default_creator),
+                            static_cast<SegmentCreator*>(&relocating_creator)));
 #endif
 
 TEST_P(ZoneDataUpdaterTest, bothNull) {
@@ -341,6 +364,179 @@ TEST_P(ZoneDataUpdaterTest, manySmallRRsets) {
     }
 }
 
+// Names added in the DNSSEC order after startAppend() are appended to the
+// zone tree, which is balanced on finishAppend().  A name out of order
+// falls back to the normal insertion.
+TEST_P(ZoneDataUpdaterTest, appendSorted) {
+    const std::string txtspec(" 3600 IN TXT " + std::string(30, 'X'));
+    const size_t name_count = 4096;
+
+    updater_->startAppend();
+    for (size_t i = 0; i < name_count; ++i) {
+        // All the numbers have the same number of digits, so the names
+        // are in the DNSSEC order.
+        const std::string name(boost::lexical_cast<std::string>(10000 + i) +
+                               ".example.org.");
+        updater_->add(textToRRset(name + txtspec), ConstRRsetPtr());
+    }
+    updater_->add(textToRRset("a.example.org." + txtspec), ConstRRsetPtr());
+    updater_->add(textToRRset("*.wild.example.org." + txtspec),
+                  ConstRRsetPtr());
+    updater_->finishAppend();
+
+    const ZoneTree& tree = getZoneData()->getZoneTree();
+    EXPECT_TRUE(tree.checkProperties());
+    // The origin and the zone's names, plus "wild" and the wildcard.
+    EXPECT_EQ(name_count + 4, tree.getNodeCount());
+    EXPECT_GE(2 * 13, tree.getHeight());
+    for (size_t i = 0; i < name_count; ++i) {
+        const Name name(boost::lexical_cast<std::string>(10000 + i) +
+                        ".example.org.");
+        EXPECT_NE(static_cast<ZoneNode*>(NULL),
+                  getZoneData()->findName(name));
+    }
+    EXPECT_NE(static_cast<ZoneNode*>(NULL),
+              getZoneData()->findName(Name("a.example.org")));
+    const ZoneNode* node = getZoneData()->findName(Name("wild.example.org"));
+    ASSERT_NE(static_cast<ZoneNode*>(NULL), node);
+    EXPECT_TRUE(node->getFlag(ZoneData::WILDCARD_NODE));
+}
+
+TEST_P(ZoneDataUpdaterTest, relayout) {
+    // Enough names for the segment to grow, if it can.
+    for (int i = 0; i < 128; ++i) {
+        const std::string name(boost::lexical_cast<std::string>(i) +
+                               ".example.org.");
+        updater_->add(textToRRset(name + " 3600 IN A 192.0.2.1"),
+                      ConstRRsetPtr());
+        updater_->add(textToRRset(name + " 3600 IN TXT \"" + name + "\""),
+                      ConstRRsetPtr());
+    }
+    updater_->add(textToRRset("example.org. 3600 IN NS 1.example.org."),
+                  ConstRRsetPtr());
+    updater_->buildNameIndex();
+    updater_->setAdditionalNodes();
+    const ZoneNode* const old_node =
+        getZoneData()->findName(Name("100.example.org"));
+
+    std::vector<Name> names;
+    names.push_back(Name("100.example.org"));
+    names.push_back(Name("example.org"));
+    names.push_back(Name("1.example.org"));
+    names.push_back(Name("nosuchname.example.org")); // ignored
+    names.push_back(Name("example.com"));            // ignored
+    EXPECT_EQ(3, updater_->relayout(names));
+
+    // The name index and the additional nodes refer to the old nodes.
+    EXPECT_EQ(static_cast<const ZoneNameIndex*>(NULL),
+              getZoneData()->getNameIndex());
+    EXPECT_FALSE(getZoneData()->isAdditionalLinked());
+
+    // All names remain with their data.
+    EXPECT_TRUE(getZoneData()->getZoneTree().checkProperties());
+    EXPECT_NE(old_node, getZoneData()->findName(Name("100.example.org")));
+    for (int i = 0; i < 128; ++i) {
+        const Name name(boost::lexical_cast<std::string>(i) +
+                        ".example.org.");
+        const ZoneNode* node = getZoneData()->findName(name);
+        ASSERT_NE(static_cast<const ZoneNode*>(NULL), node);
+        EXPECT_NE(static_cast<const RdataSet*>(NULL),
+                  RdataSet::find(node->getData(), RRType::A()));
+        EXPECT_NE(static_cast<const RdataSet*>(NULL),
+                  RdataSet::find(node->getData(), RRType::TXT()));
+    }
+    EXPECT_NE(static_cast<const RdataSet*>(NULL),
+              RdataSet::find(getZoneData()->getOriginNode()->getData(),
+                             RRType::NS()));
+
+    // They can be built again.
+    updater_->buildNameIndex();
+    updater_->setAdditionalNodes();
+    // (the origin is also indexed as it now has data)
+    EXPECT_EQ(129, getZoneData()->getNameIndex()->getNameCount());
+    EXPECT_TRUE(getZoneData()->isAdditionalLinked());
+}
+
+TEST_P(ZoneDataUpdaterTest, buildNameIndex) {
+    // No index by default.
+    EXPECT_EQ(static_cast<const ZoneNameIndex*>(NULL),
+              getZoneData()->getNameIndex());
+
+    // Build it with enough names for the segment to grow, if it can.
+    for (int i = 0; i < 128; ++i) {
+        const std::string name(boost::lexical_cast<std::string>(i) +
+                               ".example.org.");
+        updater_->add(textToRRset(name + " 3600 IN A 192.0.2.1"),
+                      ConstRRsetPtr());
+    }
+    updater_->buildNameIndex();
+    const ZoneNameIndex* index = getZoneData()->getNameIndex();
+    ASSERT_NE(static_cast<const ZoneNameIndex*>(NULL), index);
+    EXPECT_EQ(128, index->getNameCount());
+    const Name name("127.example.org");
+    EXPECT_EQ(getNode(*mem_sgmt_, name, getZoneData()),
+              index->find(LabelSequence(name)));
+
+    // Building it again replaces the index.
+    updater_->buildNameIndex();
+    ASSERT_NE(static_cast<const ZoneNameIndex*>(NULL),
+              getZoneData()->getNameIndex());
+
+    // Further modifications are reflected to the index.  Note that the
+    // segment may grow on them, so we always get the index again.
+    const Name www_name("www.example.org");
+    updater_->add(textToRRset("www.example.org. 3600 IN A 192.0.2.1"),
+                  ConstRRsetPtr());
+    ASSERT_NE(static_cast<const ZoneNameIndex*>(NULL),
+              getZoneData()->getNameIndex());
+    EXPECT_EQ(129, getZoneData()->getNameIndex()->getNameCount());
+    EXPECT_EQ(getNode(*mem_sgmt_, www_name, getZoneData()),
+              findInIndex(getZoneData(), www_name));
+    updater_->add(textToRRset("www.example.org. 3600 IN AAAA 2001:db8::1"),
+                  ConstRRsetPtr());
+    updater_->remove(textToRRset("www.example.org. 3600 IN A 192.0.2.1"),
+                     ConstRRsetPtr());
+    EXPECT_EQ(129, getZoneData()->getNameIndex()->getNameCount());
+    EXPECT_EQ(getNode(*mem_sgmt_, www_name, getZoneData()),
+              findInIndex(getZoneData(), www_name));
+    updater_->remove(textToRRset("www.example.org. 3600 IN AAAA 2001:db8::1"),
+                     ConstRRsetPtr());
+    EXPECT_EQ(128, getZoneData()->getNameIndex()->getNameCount());
+    EXPECT_EQ(static_cast<const ZoneNode*>(NULL),
+              findInIndex(getZoneData(), www_name));
+
+    // A node that becomes an empty non-terminal is removed from the index.
+    updater_->add(textToRRset("a.0.example.org. 3600 IN A 192.0.2.1"),
+                  ConstRRsetPtr());
+    EXPECT_EQ(129, getZoneData()->getNameIndex()->getNameCount());
+    updater_->remove(textToRRset("0.example.org. 3600 IN A 192.0.2.1"),
+                     ConstRRsetPtr());
+    EXPECT_EQ(128, getZoneData()->getNameIndex()->getNameCount());
+    EXPECT_EQ(static_cast<const ZoneNode*>(NULL),
+              findInIndex(getZoneData(), Name("0.example.org")));
+
+    // Names below a zone cut are not indexed.  A new zone cut over
+    // existing names invalidates the index, while a cut at a leaf doesn't.
+    const Name child_name("child.example.org");
+    updater_->add(textToRRset("child.example.org. 3600 IN NS ns.example.org."),
+                  ConstRRsetPtr());
+    updater_->add(textToRRset("a.child.example.org. 3600 IN A 192.0.2.1"),
+                  ConstRRsetPtr());
+    EXPECT_EQ(129, getZoneData()->getNameIndex()->getNameCount());
+    EXPECT_EQ(getNode(*mem_sgmt_, child_name, getZoneData()),
+              findInIndex(getZoneData(), child_name));
+    EXPECT_EQ(static_cast<const ZoneNode*>(NULL),
+              findInIndex(getZoneData(), Name("a.child.example.org")));
+    updater_->add(textToRRset("0.example.org. 3600 IN NS ns.example.org."),
+                  ConstRRsetPtr());
+    EXPECT_EQ(static_cast<const ZoneNameIndex*>(NULL),
+              getZoneData()->getNameIndex());
+
+    // If there's an index on destruction of the zone data, it's released
+    // with the data (checked in the destructor of the fixture).
+    updater_->buildNameIndex();
+}
+
 TEST_P(ZoneDataUpdaterTest, updaterCollision) {
     ZoneData* zone_data = ZoneData::create(*mem_sgmt_,
                                            Name("another.example.com."));
@@ -445,6 +641,35 @@ TEST_P(ZoneDataUpdaterTest, remove) {
     EXPECT_EQ(ZoneTree::PARTIALMATCH, result); // should match origin
 }
 
+TEST_P(ZoneDataUpdaterTest, shareRdata) {
+    clearZoneData(true);
+    const RdataPool* pool =
+        static_cast<const ZoneData*>(getZoneData())->getRdataPool();
+    ASSERT_NE(static_cast<const RdataPool*>(NULL), pool);
+
+    // Identical NS RRsets of different delegations share their RDATA.
+    const char* const owners[] = { "a.example.org.", "b.example.org." };
+    for (size_t i = 0; i < sizeof(owners) / sizeof(*owners); ++i) {
+        const std::string owner(owners[i]);
+        updater_->add(textToRRset(owner + " 3600 IN NS ns1.example.net.\n" +
+                                  owner + " 3600 IN NS ns2.example.net."),
+                      ConstRRsetPtr());
+    }
+    EXPECT_EQ(1, pool->getDataCount());
+
+    // Merging into one of them makes it refer to different data.
+    updater_->add(textToRRset("a.example.org. 3600 IN NS ns3.example.net."),
+                  ConstRRsetPtr());
+    checkRdataSet(*getZoneData(), Name("a.example.org"), RRType::NS(), 3, 0);
+    EXPECT_EQ(2, pool->getDataCount());
+
+    // And removing it makes it share the data again.
+    updater_->remove(textToRRset("a.example.org. 3600 IN NS "
+                                 "ns3.example.net."), ConstRRsetPtr());
+    checkRdataSet(*getZoneData(), Name("a.example.org"), RRType::NS(), 2, 0);
+    EXPECT_EQ(1, pool->getDataCount());
+}
+
 TEST_P(ZoneDataUpdaterTest, badRemove) {
     const Name name("a.example.org");
 
@@ -519,4 +744,156 @@ TEST_P(ZoneDataUpdaterTest, removeNSEC3) {
                  ZoneDataUpdater::RemoveError);
 }
 
+// Pairs of RRsets for the addBatch tests: signed TXT (and A for some)
+// RRsets of many names, signed NSEC3s, an RRSIG without the covered RRset,
+// and RRsets to be merged with ones added before.
+ZoneDataUpdater::RRsetPairs
+getBatchRRsets(size_t name_count) {
+    const std::string sigspec(" 3600 IN RRSIG TXT 5 3 3600 "
+                              "20150420235959 20051021000000 1 "
+                              "example.org. FAKE");
+    const std::string n3sigspec(" 3600 IN RRSIG NSEC3 5 3 3600 "
+                                "20150420235959 20051021000000 1 "
+                                "example.org. FAKE");
+    ZoneDataUpdater::RRsetPairs rrsets;
+    rrsets.push_back(std::make_pair(
+                         textToRRset("example.org. 3600 IN NSEC3PARAM "
+                                     "1 0 12 aabbccdd"), ConstRRsetPtr()));
+    for (size_t i = 0; i < name_count; ++i) {
+        const std::string name(boost::lexical_cast<std::string>(i) +
+                               ".example.org.");
+        rrsets.push_back(std::make_pair(
+                             textToRRset(name + " 3600 IN TXT " +
+                                         std::string(1 + i % 100, 'X')),
+                             textToRRset(name + sigspec)));
+        if (i % 3 == 0) {
+            rrsets.push_back(std::make_pair(
+                                 textToRRset(name + " 3600 IN A 192.0.2.1"),
+                                 ConstRRsetPtr()));
+        }
+        rrsets.push_back(std::make_pair(
+                             textToRRset("n3-" + name + " 3600 IN NSEC3 "
+                                         "1 0 12 aabbccdd TDK23RP6 A"),
+                             textToRRset("n3-" + name + n3sigspec)));
+    }
+    rrsets.push_back(std::make_pair(
+                         ConstRRsetPtr(),
+                         textToRRset("rrsig-only.example.org." + sigspec)));
+    rrsets.push_back(std::make_pair(
+                         textToRRset("0.example.org. 3600 IN TXT merged"),
+                         ConstRRsetPtr()));
+    rrsets.push_back(std::make_pair(
+                         textToRRset("n3-0.example.org. 3600 IN NSEC3 "
+                                     "1 0 12 aabbccdd TDK23RP7 A"),
+                         ConstRRsetPtr()));
+    return (rrsets);
+}
+
+// The text of all RRsets (with RRSIGs) of the names of 'rrsets' in the zone.
+std::vector<std::string>
+getZoneText(ZoneData& zone_data, const RRClass& rrclass,
+            const ZoneDataUpdater::RRsetPairs& rrsets)
+{
+    std::vector<std::string> texts;
+    for (size_t i = 0; i < rrsets.size(); ++i) {
+        const ConstRRsetPtr& rrset = rrsets[i].first ? rrsets[i].first :
+            rrsets[i].second;
+        const ZoneNode* node = NULL;
+        if (rrset->getType() == RRType::NSEC3()) {
+            zone_data.getNSEC3Data()->getNSEC3Tree().find(rrset->getName(),
+                                                          &node);
+        } else {
+            node = zone_data.findName(rrset->getName());
+        }
+        if (node == NULL) {
+            texts.push_back(rrset->getName().toText() + " not found");
+            continue;
+        }
+        for (const RdataSet* rdataset = node->getData(); rdataset != NULL;
+             rdataset = rdataset->getNext()) {
+            texts.push_back(TreeNodeRRset(rrclass, node, rdataset,
+                                          true).toText());
+        }
+    }
+    return (texts);
+}
+
+// addBatch() results in the same zone as add() for each pair, regardless of
+// the number of threads.
+TEST_P(ZoneDataUpdaterTest, addBatch) {
+    const ZoneDataUpdater::RRsetPairs rrsets = getBatchRRsets(1000);
+    for (size_t i = 0; i < rrsets.size(); ++i) {
+        updater_->add(rrsets[i].first, rrsets[i].second);
+    }
+    const std::vector<std::string> expected =
+        getZoneText(*getZoneData(), zclass_, rrsets);
+
+    const size_t thread_counts[] = {0, 1, 4};
+    for (size_t i = 0; i < sizeof(thread_counts) / sizeof(size_t); ++i) {
+        SCOPED_TRACE("threads: " +
+                     boost::lexical_cast<std::string>(thread_counts[i]));
+        clearZoneData();
+        updater_->addBatch(rrsets, thread_counts[i]);
+        EXPECT_TRUE(expected ==
+                    getZoneText(*getZoneData(), zclass_, rrsets));
+        EXPECT_TRUE(getZoneData()->isNSEC3Signed());
+    }
+}
+
+// The RdataSets encoded by the worker threads are shared in the zone the
+// same way as those added one by one.
+TEST_P(ZoneDataUpdaterTest, addBatchSharedRdata) {
+    const ZoneDataUpdater::RRsetPairs rrsets = getBatchRRsets(100);
+    clearZoneData(true);
+    for (size_t i = 0; i < rrsets.size(); ++i) {
+        updater_->add(rrsets[i].first, rrsets[i].second);
+    }
+    const std::vector<std::string> expected =
+        getZoneText(*getZoneData(), zclass_, rrsets);
+    const size_t data_count =
+        static_cast<const ZoneData*>(getZoneData())->getRdataPool()->
+        getDataCount();
+    EXPECT_LT(0, data_count);
+
+    clearZoneData(true);
+    updater_->addBatch(rrsets, 4);
+    EXPECT_TRUE(expected == getZoneText(*getZoneData(), zclass_, rrsets));
+    EXPECT_EQ(data_count,
+              static_cast<const ZoneData*>(getZoneData())->getRdataPool()->
+              getDataCount());
+}
+
+// If a pair is rejected, the pairs before it are added, and the ones
+// after it are not.
+TEST_P(ZoneDataUpdaterTest, addBatchFailure) {
+    ZoneDataUpdater::RRsetPairs rrsets = getBatchRRsets(100);
+    const size_t bad_pos = rrsets.size() / 2;
+    const ZoneDataUpdater::RRsetPairs::value_type bad_pair(
+        textToRRset("example.com. 3600 IN A 192.0.2.1"), ConstRRsetPtr());
+    rrsets.insert(rrsets.begin() + bad_pos, bad_pair);
+
+    const size_t thread_counts[] = {0, 4};
+    for (size_t i = 0; i < sizeof(thread_counts) / sizeof(size_t); ++i) {
+        SCOPED_TRACE("threads: " +
+                     boost::lexical_cast<std::string>(thread_counts[i]));
+        clearZoneData();
+        EXPECT_THROW(updater_->addBatch(rrsets, thread_counts[i]),
+                     ZoneDataUpdater::AddError);
+        // The last pairs are merged with the ones before, so we don't
+        // check them.
+        for (size_t j = 0; j < rrsets.size() - 3; ++j) {
+            if (j == bad_pos || !rrsets[j].first ||
+                rrsets[j].first->getType() == RRType::NSEC3()) {
+                continue;
+            }
+            const ZoneNode* node =
+                getZoneData()->findName(rrsets[j].first->getName());
+            const RdataSet* rdataset = node ?
+                RdataSet::find(node->getData(), rrsets[j].first->getType()) :
+                NULL;
+            EXPECT_EQ(j < bad_pos, rdataset != NULL);
+        }
+    }
+}
+
 }
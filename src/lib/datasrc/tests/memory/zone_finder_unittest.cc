@@ -26,12 +26,15 @@
 
 #include <datasrc/memory/zone_finder.h>
 #include <datasrc/memory/zone_data_updater.h>
+#include <datasrc/memory/zone_name_index.h>
+#include <datasrc/memory/nsec3_hash_index.h>
 #include <datasrc/memory/rdata_serialization.h>
 #include <datasrc/memory/zone_table_segment.h>
 #include <datasrc/memory/memory_client.h>
 #include <datasrc/exceptions.h>
 #include <datasrc/client.h>
 #include <testutils/dnsmessage_test.h>
+#include <util/memory_arena.h>
 
 #include <boost/foreach.hpp>
 
@@ -482,6 +485,39 @@ TEST_F(InMemoryZoneFinderTest, constructor) {
     ASSERT_EQ(origin_, zone_finder_.getOrigin());
 }
 
+// The results are created from the arena of the thread, if any.
+TEST_F(InMemoryZoneFinderTest, findInArena) {
+    addToZoneData(rr_a_);
+
+    boost::shared_ptr<bundy::util::MemoryArena> arena(
+        new bundy::util::MemoryArena);
+    ConstRRsetPtr rrset;
+    {
+        const bundy::util::MemoryArena::Scope scope(arena.get());
+        ZoneFinderContextPtr context = zone_finder_.find(rr_a_->getName(),
+                                                         RRType::A());
+        EXPECT_EQ(ZoneFinder::SUCCESS, context->code);
+        rrset = context->rrset;
+        EXPECT_LT(0, arena->getAllocatedSize());
+        EXPECT_FALSE(arena.unique());
+
+        context = zone_finder_.findAtOrigin(RRType::A(), false,
+                                            ZoneFinder::FIND_DEFAULT);
+        EXPECT_EQ(ZoneFinder::SUCCESS, context->code);
+    }
+    // The RRset keeps the arena, and can still be used.
+    EXPECT_FALSE(arena.unique());
+    rrsetCheck(rr_a_, rrset);
+    rrset.reset();
+    EXPECT_TRUE(arena.unique());
+
+    // Without an arena, the results are allocated on the heap.
+    arena->reset();
+    EXPECT_EQ(ZoneFinder::SUCCESS,
+              zone_finder_.find(rr_a_->getName(), RRType::A())->code);
+    EXPECT_EQ(0, arena->getAllocatedSize());
+}
+
 TEST_F(InMemoryZoneFinderTest, findCNAME) {
     // install CNAME RR
     addToZoneData(rr_cname_);
@@ -680,6 +716,120 @@ TEST_F(InMemoryZoneFinderTest, glue) {
              NULL, ZoneFinder::FIND_GLUE_OK);
 }
 
+TEST_F(InMemoryZoneFinderTest, nameIndex) {
+    // Results with the name index should be the same as those without it,
+    // whether or not the searched name is in the index.
+    addToZoneData(rr_a_);
+    addToZoneData(rr_ns_);
+    addToZoneData(rr_cname_);
+    addToZoneData(rr_child_ns_);
+    addToZoneData(rr_child_ds_);
+    addToZoneData(rr_child_glue_);
+    addToZoneData(rr_dname_);
+    addToZoneData(rr_dname_a_);
+    addToZoneData(rr_wild_);
+    addToZoneData(rr_under_wild_);
+    addToZoneData(rr_emptywild_);
+    updater_->buildNameIndex();
+    ASSERT_NE(static_cast<const ZoneNameIndex*>(NULL),
+              zone_data_->getNameIndex());
+
+    // Names in the index
+    findTest(origin_, RRType::A(), ZoneFinder::SUCCESS, true, rr_a_);
+    findTest(origin_, RRType::TXT(), ZoneFinder::NXRRSET);
+    findTest(Name("CNAME.example.org"), RRType::A(), ZoneFinder::CNAME, true,
+             rr_cname_);
+    findTest(rr_child_ns_->getName(), RRType::A(), ZoneFinder::DELEGATION,
+             true, rr_child_ns_);
+    findTest(rr_child_ds_->getName(), RRType::DS(), ZoneFinder::SUCCESS,
+             true, rr_child_ds_);
+    findTest(rr_dname_->getName(), RRType::A(), ZoneFinder::SUCCESS, true,
+             rr_dname_a_);
+    findTest(rr_under_wild_->getName(), RRType::A(), ZoneFinder::SUCCESS,
+             true, rr_under_wild_);
+
+    // Names below a zone cut or DNAME, and other names not in the index
+    findTest(rr_child_glue_->getName(), RRType::A(), ZoneFinder::DELEGATION,
+             true, rr_child_ns_);
+    findTest(rr_child_glue_->getName(), RRType::A(), ZoneFinder::SUCCESS, true,
+             rr_child_glue_, ZoneFinder::RESULT_DEFAULT, NULL,
+             ZoneFinder::FIND_GLUE_OK);
+    findTest(Name("below.dname.example.org"), RRType::A(), ZoneFinder::DNAME,
+             true, rr_dname_);
+    findTest(Name("a.wild.example.org"), RRType::A(), ZoneFinder::SUCCESS,
+             false, rr_wild_, ZoneFinder::RESULT_WILDCARD, NULL,
+             ZoneFinder::FIND_DEFAULT, true);
+    findTest(Name("foo.example.org"), RRType::A(), ZoneFinder::NXRRSET);
+    findTest(Name("nothere.example.org"), RRType::A(), ZoneFinder::NXDOMAIN);
+
+    // Adding more data updates the index.
+    addToZoneData(rr_ns_a_);
+    ASSERT_NE(static_cast<const ZoneNameIndex*>(NULL),
+              zone_data_->getNameIndex());
+    EXPECT_NE(static_cast<const ZoneNode*>(NULL),
+              zone_data_->getNameIndex()->find(
+                  LabelSequence(rr_ns_a_->getName())));
+    findTest(rr_ns_a_->getName(), RRType::A(), ZoneFinder::SUCCESS, true,
+             rr_ns_a_);
+
+    // A new DNAME above indexed names invalidates the index.
+    addToZoneData(textToRRset("wild.example.org. 300 IN DNAME example.com."));
+    EXPECT_EQ(static_cast<const ZoneNameIndex*>(NULL),
+              zone_data_->getNameIndex());
+}
+
+TEST_F(InMemoryZoneFinderTest, additionalNodes) {
+    // Additional records are the same whether or not the additional nodes
+    // are set; the glue of the delegation and the address of the apex NS are
+    // found either way.
+    addToZoneData(rr_ns_);
+    addToZoneData(rr_ns_a_);
+    addToZoneData(rr_ns_aaaa_);
+    addToZoneData(rr_child_ns_);
+    addToZoneData(rr_child_glue_);
+    EXPECT_FALSE(zone_data_->isAdditionalLinked());
+
+    vector<RRType> types;
+    types.push_back(RRType::A());
+    types.push_back(RRType::AAAA());
+    vector<ConstRRsetPtr> expected_apex;
+    expected_apex.push_back(rr_ns_a_);
+    expected_apex.push_back(rr_ns_aaaa_);
+    vector<ConstRRsetPtr> expected_child;
+    expected_child.push_back(rr_child_glue_);
+
+    for (int i = 0; i < 2; ++i) {
+        if (i == 1) {
+            updater_->setAdditionalNodes();
+            EXPECT_TRUE(zone_data_->isAdditionalLinked());
+        }
+        vector<ConstRRsetPtr> actual;
+        zone_finder_.find(origin_, RRType::NS())->getAdditional(types,
+                                                                actual);
+        rrsetsCheck(expected_apex.begin(), expected_apex.end(),
+                    actual.begin(), actual.end());
+
+        actual.clear();
+        zone_finder_.find(rr_child_glue_->getName(), RRType::A())->
+            getAdditional(types, actual);
+        rrsetsCheck(expected_child.begin(), expected_child.end(),
+                    actual.begin(), actual.end());
+    }
+
+    // Any change to the zone unlinks them, and the additional records
+    // reflect it.
+    const ConstRRsetPtr rr_child_aaaa =
+        textToRRset("ns.child.example.org. 300 IN AAAA 2001:db8::1");
+    addToZoneData(rr_child_aaaa);
+    EXPECT_FALSE(zone_data_->isAdditionalLinked());
+    expected_child.push_back(rr_child_aaaa);
+    vector<ConstRRsetPtr> actual;
+    zone_finder_.find(rr_child_glue_->getName(), RRType::A())->
+        getAdditional(types, actual);
+    rrsetsCheck(expected_child.begin(), expected_child.end(),
+                actual.begin(), actual.end());
+}
+
 TEST_F(InMemoryZoneFinderTest, findAtOrigin) {
     // Add origin NS.
     rr_ns_->addRRsig(createRdata(RRType::RRSIG(), RRClass::IN(),
@@ -1712,16 +1862,15 @@ const TestData nsec3_data[] = {
 
 const size_t data_count(sizeof(nsec3_data) / sizeof(*nsec3_data));
 
-TEST_F(InMemoryZoneFinderNSEC3Test, findNSEC3Walk) {
-    // This test basically uses nsec3_data[] declared above along with
-    // the fake hash setup to walk the NSEC3 tree. The names and fake
-    // hash calculation is specially setup so that the tree search
-    // terminates at specific locations in the tree. We findNSEC3() on
-    // each of the nsec3_data[], which is setup such that the hash
-    // results in the search terminating on either side of each node of
-    // the NSEC3 tree. This way, we check what result is returned in
-    // every search termination case in the NSEC3 tree.
-
+// This basically uses nsec3_data[] declared above along with the fake
+// hash setup to walk the NSEC3 tree. The names and fake hash calculation
+// is specially setup so that the tree search terminates at specific
+// locations in the tree. We findNSEC3() on each of the nsec3_data[], which
+// is setup such that the hash results in the search terminating on either
+// side of each node of the NSEC3 tree. This way, we check what result is
+// returned in every search termination case in the NSEC3 tree.
+void
+checkNSEC3Walk(ZoneFinder& zone_finder) {
     const Name origin("example.org");
     for (size_t i = 0; i < data_count; ++i) {
         const Name name = Name(nsec3_data[i].name).concatenate(origin);
@@ -1731,7 +1880,7 @@ TEST_F(InMemoryZoneFinderNSEC3Test, findNSEC3Walk) {
                                       ", non-recursive"));
 
         const ZoneFinder::FindNSEC3Result result =
-            zone_finder_.findNSEC3(name, nsec3_data[i].recursive);
+            zone_finder.findNSEC3(name, nsec3_data[i].recursive);
 
         EXPECT_EQ(nsec3_data[i].matched, result.matched);
         EXPECT_EQ(nsec3_data[i].closest_labels, result.closest_labels);
@@ -1754,6 +1903,19 @@ TEST_F(InMemoryZoneFinderNSEC3Test, findNSEC3Walk) {
     }
 }
 
+TEST_F(InMemoryZoneFinderNSEC3Test, findNSEC3Walk) {
+    checkNSEC3Walk(zone_finder_);
+}
+
+TEST_F(InMemoryZoneFinderNSEC3Test, findNSEC3WalkWithIndex) {
+    // The same results are returned from the NSEC3 hash index.
+    updater_->buildNSEC3Index();
+    ASSERT_NE(static_cast<const NSEC3HashIndex*>(NULL),
+              zone_data_->getNSEC3Data()->getHashIndex());
+    checkNSEC3Walk(zone_finder_);
+    performNSEC3Test(zone_finder_);
+}
+
 TEST_F(InMemoryZoneFinderNSEC3Test, RRSIGOnly) {
     // add an RRSIG-only NSEC3 to the NSEC3 space, and try to find it; it
     // should result in an exception.
@@ -0,0 +1,248 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+#include <datasrc/memory/zone_name_index.h>
+#include <datasrc/memory/zone_data.h>
+#include <datasrc/memory/zone_data_updater.h>
+
+#include <dns/name.h>
+#include <dns/labelsequence.h>
+#include <dns/rrclass.h>
+
+#include <testutils/dnsmessage_test.h>
+#include <datasrc/tests/memory/memory_segment_mock.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <string>
+
+using namespace bundy::dns;
+using namespace bundy::datasrc::memory;
+using namespace bundy::datasrc::memory::test;
+using namespace bundy::testutils;
+
+namespace {
+
+class ZoneNameIndexTest : public ::testing::Test {
+protected:
+    ZoneNameIndexTest() :
+        zname_("example.org"),
+        zone_data_(ZoneData::create(mem_sgmt_, zname_)),
+        updater_(new ZoneDataUpdater(mem_sgmt_, RRClass::IN(), zname_,
+                                     *zone_data_)),
+        index_(NULL)
+    {}
+    void TearDown() {
+        if (index_ != NULL) {
+            ZoneNameIndex::destroy(mem_sgmt_, index_);
+        }
+        updater_.reset();
+        ZoneData::destroy(mem_sgmt_, zone_data_, RRClass::IN());
+        // detect any memory leak in the test memory segment
+        EXPECT_TRUE(mem_sgmt_.allMemoryDeallocated());
+    }
+
+    void add(const std::string& rrset_txt) {
+        updater_->add(textToRRset(rrset_txt), ConstRRsetPtr());
+    }
+
+    void createIndex() {
+        index_ = ZoneNameIndex::create(mem_sgmt_, zone_data_->getZoneTree(),
+                                       zname_);
+    }
+
+    // Return the node of the given name in the tree, or NULL if it's not
+    // an exact match.
+    const ZoneNode* getTreeNode(const Name& name) const {
+        const ZoneNode* node = NULL;
+        if (zone_data_->getZoneTree().find(name, &node) !=
+            ZoneTree::EXACTMATCH) {
+            return (NULL);
+        }
+        return (node);
+    }
+
+    const ZoneNode* findIndex(const std::string& name_txt) const {
+        return (index_->find(LabelSequence(Name(name_txt))));
+    }
+
+    MemorySegmentMock mem_sgmt_;
+    const Name zname_;
+    ZoneData* zone_data_;
+    boost::scoped_ptr<ZoneDataUpdater> updater_;
+    ZoneNameIndex* index_;
+};
+
+TEST_F(ZoneNameIndexTest, emptyZone) {
+    // The zone data has the origin node but it's empty.
+    createIndex();
+    EXPECT_EQ(0, index_->getNameCount());
+    EXPECT_EQ(static_cast<const ZoneNode*>(NULL), findIndex("example.org"));
+}
+
+TEST_F(ZoneNameIndexTest, find) {
+    add("example.org. 3600 IN NS ns.example.org.");
+    add("ns.example.org. 3600 IN A 192.0.2.1");
+    add("www.example.org. 3600 IN A 192.0.2.2");
+    add("a.b.c.example.org. 3600 IN A 192.0.2.3");
+    add("child.example.org. 3600 IN NS ns.child.example.org.");
+    add("child.example.org. 3600 IN DS 12345 5 1 "
+        "2BB183AF5F22588179A53B0A98631FAD1A292118");
+    add("ns.child.example.org. 3600 IN A 192.0.2.4");
+    add("dname.example.org. 3600 IN DNAME example.com.");
+    add("a.dname.example.org. 3600 IN A 192.0.2.5");
+    add("*.wild.example.org. 3600 IN A 192.0.2.6");
+    createIndex();
+
+    // origin, ns, www, a.b.c, child, dname, *.wild
+    EXPECT_EQ(7, index_->getNameCount());
+
+    // Indexed names result in the same node as the tree.
+    const char* const indexed[] = {
+        "example.org", "ns.example.org", "www.example.org",
+        "a.b.c.example.org", "child.example.org", "dname.example.org",
+        "*.wild.example.org", NULL
+    };
+    for (int i = 0; indexed[i] != NULL; ++i) {
+        SCOPED_TRACE(indexed[i]);
+        const ZoneNode* node = findIndex(indexed[i]);
+        ASSERT_NE(static_cast<const ZoneNode*>(NULL), node);
+        EXPECT_EQ(getTreeNode(Name(indexed[i])), node);
+    }
+
+    // Comparison is case-insensitive.
+    EXPECT_EQ(getTreeNode(Name("www.example.org")),
+              findIndex("WWW.Example.ORG"));
+
+    // Names below a cut or DNAME, empty non-terminals and names that don't
+    // exist in the tree are not indexed.
+    const char* const not_indexed[] = {
+        "ns.child.example.org", "a.dname.example.org", "b.c.example.org",
+        "c.example.org", "wild.example.org", "foo.wild.example.org",
+        "nothere.example.org", "org", "www.example.com", NULL
+    };
+    for (int i = 0; not_indexed[i] != NULL; ++i) {
+        SCOPED_TRACE(not_indexed[i]);
+        EXPECT_EQ(static_cast<const ZoneNode*>(NULL),
+                  findIndex(not_indexed[i]));
+    }
+
+    // A relative name never matches.
+    const Name www("www.example.org");
+    LabelSequence relative_www(www);
+    relative_www.stripRight(1);
+    EXPECT_EQ(static_cast<const ZoneNode*>(NULL), index_->find(relative_www));
+}
+
+TEST_F(ZoneNameIndexTest, manyNames) {
+    // Enough names to cause many collisions in the hash table.
+    const int count = 1000;
+    for (int i = 0; i < count; ++i) {
+        add("host" + boost::lexical_cast<std::string>(i) +
+            ".example.org. 3600 IN A 192.0.2.1");
+    }
+    createIndex();
+    EXPECT_EQ(count, index_->getNameCount());
+    for (int i = 0; i < count; ++i) {
+        const std::string name = "host" + boost::lexical_cast<std::string>(i) +
+            ".example.org";
+        EXPECT_EQ(getTreeNode(Name(name)), findIndex(name));
+        EXPECT_EQ(static_cast<const ZoneNode*>(NULL),
+                  findIndex("nohost" + boost::lexical_cast<std::string>(i) +
+                            ".example.org"));
+    }
+}
+
+TEST_F(ZoneNameIndexTest, insertAndErase) {
+    add("www.example.org. 3600 IN A 192.0.2.1");
+    createIndex();
+    EXPECT_EQ(1, index_->getNameCount());
+
+    // Insert a new name.  It can be found just like the ones indexed on
+    // creation.
+    add("mail.example.org. 3600 IN A 192.0.2.2");
+    const ZoneNode* mail_node = getTreeNode(Name("mail.example.org"));
+    EXPECT_TRUE(index_->insert(LabelSequence(Name("mail.example.org")),
+                               mail_node));
+    EXPECT_EQ(2, index_->getNameCount());
+    EXPECT_EQ(mail_node, findIndex("MAIL.example.org"));
+
+    // Inserting an existing name replaces its node without adding a name.
+    const ZoneNode* www_node = getTreeNode(Name("www.example.org"));
+    EXPECT_TRUE(index_->insert(LabelSequence(Name("www.example.org")),
+                               mail_node));
+    EXPECT_EQ(2, index_->getNameCount());
+    EXPECT_EQ(mail_node, findIndex("www.example.org"));
+    EXPECT_TRUE(index_->insert(LabelSequence(Name("www.example.org")),
+                               www_node));
+
+    // Erase them; erasing a non-indexed name is a no-op.
+    index_->erase(LabelSequence(Name("www.example.org")));
+    EXPECT_EQ(1, index_->getNameCount());
+    EXPECT_EQ(static_cast<const ZoneNode*>(NULL), findIndex("www.example.org"));
+    index_->erase(LabelSequence(Name("www.example.org")));
+    index_->erase(LabelSequence(Name("nothere.example.org")));
+    EXPECT_EQ(1, index_->getNameCount());
+    EXPECT_EQ(mail_node, findIndex("mail.example.org"));
+
+    // An erased name can be inserted again.
+    EXPECT_TRUE(index_->insert(LabelSequence(Name("www.example.org")),
+                               www_node));
+    EXPECT_EQ(2, index_->getNameCount());
+    EXPECT_EQ(www_node, findIndex("www.example.org"));
+}
+
+TEST_F(ZoneNameIndexTest, insertFull) {
+    createIndex();
+
+    // The index has some spare room for new names, but not infinitely.
+    add("www.example.org. 3600 IN A 192.0.2.1");
+    const ZoneNode* node = getTreeNode(Name("www.example.org"));
+    int count = 0;
+    for (; count < 10000; ++count) {
+        const std::string name = "host" +
+            boost::lexical_cast<std::string>(count) + ".example.org";
+        if (!index_->insert(LabelSequence(Name(name)), node)) {
+            // The index is still usable without the name.
+            EXPECT_EQ(static_cast<const ZoneNode*>(NULL), findIndex(name));
+            break;
+        }
+    }
+    EXPECT_LT(0, count);
+    EXPECT_GT(10000, count);
+    EXPECT_EQ(count, index_->getNameCount());
+    for (int i = 0; i < count; ++i) {
+        EXPECT_EQ(node, findIndex("host" + boost::lexical_cast<std::string>(i) +
+                                  ".example.org"));
+    }
+    EXPECT_EQ(static_cast<const ZoneNode*>(NULL), findIndex("www.example.org"));
+}
+
+TEST_F(ZoneNameIndexTest, noOrigin) {
+    // The tree of a different zone doesn't contain the origin.
+    EXPECT_THROW(ZoneNameIndex::create(mem_sgmt_, zone_data_->getZoneTree(),
+                                       Name("example.com")),
+                 bundy::Unexpected);
+}
+
+TEST_F(ZoneNameIndexTest, allocationFailure) {
+    add("www.example.org. 3600 IN A 192.0.2.1");
+    mem_sgmt_.setThrowCount(1);
+    EXPECT_THROW(createIndex(), std::bad_alloc);
+    EXPECT_EQ(static_cast<ZoneNameIndex*>(NULL), index_);
+}
+
+}
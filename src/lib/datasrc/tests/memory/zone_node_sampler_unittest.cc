@@ -0,0 +1,165 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <datasrc/memory/zone_node_sampler.h>
+#include <datasrc/memory/zone_data.h>
+
+#include <exceptions/exceptions.h>
+
+#include <dns/name.h>
+#include <dns/rrclass.h>
+
+#include <datasrc/tests/memory/memory_segment_mock.h>
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace bundy::dns;
+using namespace bundy::datasrc::memory;
+using namespace bundy::datasrc::memory::test;
+
+namespace {
+
+class ZoneNodeSamplerTest : public ::testing::Test {
+protected:
+    ZoneNodeSamplerTest() :
+        zname_("example.org"),
+        zone_data_(ZoneData::create(mem_sgmt_, zname_))
+    {}
+    ~ZoneNodeSamplerTest() {
+        ZoneData::destroy(mem_sgmt_, zone_data_, RRClass::IN());
+        // detect any memory leak in the test memory segment
+        EXPECT_TRUE(mem_sgmt_.allMemoryDeallocated());
+    }
+
+    const ZoneNode* getNode(const char* name) {
+        ZoneNode* node = NULL;
+        zone_data_->insertName(mem_sgmt_, Name(name), &node);
+        return (node);
+    }
+
+    test::MemorySegmentMock mem_sgmt_;
+    const Name zname_;
+    ZoneData* zone_data_;
+};
+
+TEST_F(ZoneNodeSamplerTest, construct) {
+    EXPECT_THROW(ZoneNodeSampler(0, 10), bundy::BadValue);
+    EXPECT_THROW(ZoneNodeSampler(1, 0), bundy::BadValue);
+    EXPECT_EQ(10, ZoneNodeSampler(10, 1).getRate());
+    EXPECT_TRUE(ZoneNodeSampler(1, 1).getHotNames().empty());
+}
+
+TEST_F(ZoneNodeSamplerTest, sample) {
+    const ZoneNode* www = getNode("www.example.org");
+    const ZoneNode* mail = getNode("mail.example.org");
+
+    ZoneNodeSampler sampler(1, 10);
+    sampler.sample(*zone_data_, mail);
+    for (int i = 0; i < 3; ++i) {
+        sampler.sample(*zone_data_, www);
+    }
+    sampler.sample(*zone_data_, zone_data_->getOriginNode());
+    sampler.sample(*zone_data_, zone_data_->getOriginNode());
+
+    // Ordered by the counts; the same counts are in the DNSSEC order.
+    const ZoneNodeSampler::HotNames names = sampler.getHotNames();
+    ASSERT_EQ(3, names.size());
+    EXPECT_EQ(Name("www.example.org"), names[0].name);
+    EXPECT_EQ(3, names[0].count);
+    EXPECT_EQ(Name("example.org"), names[1].name);
+    EXPECT_EQ(2, names[1].count);
+    EXPECT_EQ(Name("mail.example.org"), names[2].name);
+    EXPECT_EQ(1, names[2].count);
+    for (size_t i = 0; i < names.size(); ++i) {
+        EXPECT_EQ(zname_, names[i].zone);
+    }
+
+    // Only the most frequent ones.
+    EXPECT_EQ(1, sampler.getHotNames(1).size());
+    EXPECT_EQ(3, sampler.getHotNames(4).size());
+
+    sampler.clear();
+    EXPECT_TRUE(sampler.getHotNames().empty());
+}
+
+TEST_F(ZoneNodeSamplerTest, sampleRate) {
+    const ZoneNode* www = getNode("www.example.org");
+
+    // One of every 3 lookups is counted, starting with the first one.
+    ZoneNodeSampler sampler(3, 10);
+    for (int i = 0; i < 7; ++i) {
+        sampler.sample(*zone_data_, www);
+    }
+    const ZoneNodeSampler::HotNames names = sampler.getHotNames();
+    ASSERT_EQ(1, names.size());
+    EXPECT_EQ(3, names[0].count);
+}
+
+TEST_F(ZoneNodeSamplerTest, maxNames) {
+    const ZoneNode* www = getNode("www.example.org");
+    const ZoneNode* mail = getNode("mail.example.org");
+
+    // Once the limit is reached, new names are not counted, but the ones
+    // already counted still are.
+    ZoneNodeSampler sampler(1, 1);
+    sampler.sample(*zone_data_, www);
+    sampler.sample(*zone_data_, mail);
+    sampler.sample(*zone_data_, www);
+    const ZoneNodeSampler::HotNames names = sampler.getHotNames();
+    ASSERT_EQ(1, names.size());
+    EXPECT_EQ(Name("www.example.org"), names[0].name);
+    EXPECT_EQ(2, names[0].count);
+}
+
+TEST_F(ZoneNodeSamplerTest, writeAndRead) {
+    ZoneNodeSampler::HotNames names;
+    names.push_back(ZoneNodeSampler::HotName(zname_,
+                                             Name("www.example.org"), 10));
+    names.push_back(ZoneNodeSampler::HotName(Name("example.com"),
+                                             Name("www.example.com"), 5));
+    names.push_back(ZoneNodeSampler::HotName(zname_, zname_, 3));
+
+    std::stringstream ss;
+    ZoneNodeSampler::writeHotNames(ss, names);
+    EXPECT_EQ("example.org. www.example.org. 10\n"
+              "example.com. www.example.com. 5\n"
+              "example.org. example.org. 3\n", ss.str());
+
+    // Only the names of the zone are read, in the order.
+    const std::vector<Name> read = ZoneNodeSampler::readHotNames(ss, zname_);
+    ASSERT_EQ(2, read.size());
+    EXPECT_EQ(Name("www.example.org"), read[0]);
+    EXPECT_EQ(zname_, read[1]);
+
+    // Empty lines are skipped.
+    std::stringstream empty("\n  \n");
+    EXPECT_TRUE(ZoneNodeSampler::readHotNames(empty, zname_).empty());
+
+    // Bad lines.
+    std::stringstream no_count("example.org. www.example.org.\n");
+    EXPECT_THROW(ZoneNodeSampler::readHotNames(no_count, zname_),
+                 bundy::BadValue);
+    std::stringstream bad_count("example.org. www.example.org. many\n");
+    EXPECT_THROW(ZoneNodeSampler::readHotNames(bad_count, zname_),
+                 bundy::BadValue);
+    std::stringstream bad_name("example.org. bad..name 1\n");
+    EXPECT_THROW(ZoneNodeSampler::readHotNames(bad_name, zname_),
+                 bundy::Exception);
+}
+
+}
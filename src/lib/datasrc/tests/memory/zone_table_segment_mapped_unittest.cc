@@ -14,6 +14,8 @@
 
 #include <datasrc/memory/zone_writer.h>
 #include <datasrc/memory/zone_table_segment_mapped.h>
+#include <datasrc/memory/zone_table.h>
+#include <datasrc/memory/zone_data.h>
 #include <util/random/random_number_generator.h>
 #include <util/unittests/check_valgrind.h>
 
@@ -122,6 +124,19 @@ deleteHeader(MemorySegment& segment) {
     segment.clearNamedAddress("zone_table_header");
 }
 
+void
+setVersion(MemorySegment& segment, uint32_t version) {
+    const MemorySegment::NamedAddressResult result =
+        segment.getNamedAddress("zone_table_version");
+    ASSERT_TRUE(result.first);
+    *static_cast<uint32_t*>(result.second) = version;
+}
+
+void
+deleteVersion(MemorySegment& segment) {
+    segment.clearNamedAddress("zone_table_version");
+}
+
 void
 ZoneTableSegmentMappedTest::addData(MemorySegment& segment) {
     // For purposes of this test, we assume that the following
@@ -430,6 +445,96 @@ TEST_F(ZoneTableSegmentMappedTest, resetReadOnly) {
                  MemorySegmentError);
 }
 
+TEST_F(ZoneTableSegmentMappedTest, resetWithMappingOptions) {
+    ZoneTableSegmentMapped& mapped_segment =
+        dynamic_cast<ZoneTableSegmentMapped&>(*ztable_segment_);
+    EXPECT_EQ(MemorySegmentMapped::MAPPING_DEFAULT,
+              mapped_segment.getMappingFlags());
+
+    ztable_segment_->reset(ZoneTableSegment::READ_WRITE, config_params_);
+    addData(ztable_segment_->getMemorySegment());
+    EXPECT_EQ(MemorySegmentMapped::MAPPING_DEFAULT,
+              mapped_segment.getMappingFlags());
+    ztable_segment_->clear();
+
+    // The options are given to the mapped segment.  Prefaulting always
+    // works in the read-only mode; the others depend on the system.
+    ztable_segment_->reset(ZoneTableSegment::READ_ONLY,
+                           Element::fromJSON(
+                               "{\"mapped-file\": \"" +
+                               std::string(mapped_file) + "\","
+                               " \"huge-pages\": true,"
+                               " \"prefault\": true,"
+                               " \"numa-interleave\": false}"));
+    EXPECT_NE(0, mapped_segment.getMappingFlags() &
+              MemorySegmentMapped::MAPPING_PREFAULT);
+    EXPECT_EQ(0, mapped_segment.getMappingFlags() &
+              MemorySegmentMapped::MAPPING_NUMA_INTERLEAVE);
+    EXPECT_TRUE(verifyData(ztable_segment_->getMemorySegment()));
+
+    // Non boolean option is rejected, with the segment kept intact.
+    EXPECT_THROW(ztable_segment_->reset(ZoneTableSegment::READ_ONLY,
+                                        Element::fromJSON(
+                                            "{\"mapped-file\": \"" +
+                                            std::string(mapped_file) + "\","
+                                            " \"prefault\": 1}")),
+                 bundy::InvalidParameter);
+    EXPECT_TRUE(verifyData(ztable_segment_->getMemorySegment()));
+
+    ztable_segment_->clear();
+    EXPECT_EQ(MemorySegmentMapped::MAPPING_DEFAULT,
+              mapped_segment.getMappingFlags());
+}
+
+TEST_F(ZoneTableSegmentMappedTest, versioned) {
+    const ConstElementPtr params =
+        Element::fromJSON("{\"mapped-file\": \"" +
+                          std::string(mapped_file) + "\","
+                          " \"versioned\": true}");
+    const Name origin("example.org");
+
+    // A newly created image is not shared with readers.
+    ztable_segment_->reset(ZoneTableSegment::CREATE, params);
+    EXPECT_FALSE(ztable_segment_->isSharedWithReaders());
+    EXPECT_NE(0, dynamic_cast<ZoneTableSegmentMapped&>(*ztable_segment_).
+              getMappingFlags() & MemorySegmentMapped::MAPPING_CONCURRENT);
+    ZoneData* const old_data =
+        ZoneData::create(ztable_segment_->getMemorySegment(), origin);
+    ztable_segment_->getHeader().getTable()->addZone(
+        ztable_segment_->getMemorySegment(), origin, old_data);
+
+    // An existing one is, and readers can map it at the same time.
+    ztable_segment_->reset(ZoneTableSegment::READ_WRITE, params);
+    EXPECT_TRUE(ztable_segment_->isSharedWithReaders());
+    std::auto_ptr<ZoneTableSegment> reader(
+        ZoneTableSegment::create(RRClass::IN(), "mapped"));
+    reader->reset(ZoneTableSegment::READ_ONLY, params);
+    EXPECT_FALSE(reader->isSharedWithReaders());
+    EXPECT_EQ(bundy::datasrc::result::SUCCESS,
+              reader->getHeader().getTable()->findZone(origin).code);
+
+    // Replacing and retiring the data of the zone.
+    MemorySegment& mem_sgmt = ztable_segment_->getMemorySegment();
+    ZoneTableHeader& header = ztable_segment_->getHeader();
+    const ZoneTable::AddResult add_result =
+        header.getTable()->addZone(mem_sgmt, origin,
+                                   ZoneData::create(mem_sgmt, origin));
+    EXPECT_EQ(bundy::datasrc::result::EXIST, add_result.code);
+    header.retireZoneData(mem_sgmt, add_result.zone_data);
+    EXPECT_EQ(1, header.getRetiredZoneDataCount());
+    EXPECT_EQ(bundy::datasrc::result::SUCCESS,
+              reader->getHeader().getTable()->findZone(origin).code);
+
+    // The retired data are destroyed when the image is opened for write
+    // again, once the reader has left it.
+    ZoneTableSegment::destroy(reader.release());
+    ztable_segment_->reset(ZoneTableSegment::READ_WRITE, params);
+    EXPECT_EQ(0, ztable_segment_->getHeader().getRetiredZoneDataCount());
+    EXPECT_EQ(bundy::datasrc::result::SUCCESS,
+              ztable_segment_->getHeader().getTable()->findZone(origin).code);
+    ztable_segment_->clear();
+}
+
 TEST_F(ZoneTableSegmentMappedTest, clearUninitialized) {
     // Clearing a segment that has not been reset() is a nop, as clear()
     // returns it to a fresh uninitialized state anyway.
@@ -545,6 +650,55 @@ TEST_F(ZoneTableSegmentMappedTest, resetFailedMissingHeader) {
     EXPECT_TRUE(verifyData(ztable_segment_->getMemorySegment()));
 }
 
+TEST_F(ZoneTableSegmentMappedTest, resetFailedBadVersion) {
+    setupMappedFiles();
+
+    // Make mapped file 2 look like an image of a future version.  This is
+    // done via ZoneTableSegment so the checksum is kept consistent and only
+    // the version check can fail.
+    ztable_segment_->reset(ZoneTableSegment::READ_WRITE, config_params2_);
+    setVersion(ztable_segment_->getMemorySegment(),
+               ZoneTableSegmentMapped::IMAGE_VERSION + 1);
+
+    // Open mapped file 1 in read-write mode
+    ztable_segment_->reset(ZoneTableSegment::READ_WRITE, config_params_);
+
+    // Resetting to mapped file 2 should fail in either mode
+    EXPECT_THROW({
+        ztable_segment_->reset(ZoneTableSegment::READ_ONLY, config_params2_);
+    }, ResetFailed);
+    EXPECT_THROW({
+        ztable_segment_->reset(ZoneTableSegment::READ_WRITE, config_params2_);
+    }, ResetFailed);
+
+    EXPECT_TRUE(ztable_segment_->isUsable());
+    EXPECT_TRUE(ztable_segment_->isWritable());
+    EXPECT_TRUE(verifyData(ztable_segment_->getMemorySegment()));
+}
+
+TEST_F(ZoneTableSegmentMappedTest, resetFailedMissingVersion) {
+    setupMappedFiles();
+
+    // Remove the version of mapped file 2, again keeping the checksum
+    // consistent.
+    ztable_segment_->reset(ZoneTableSegment::READ_WRITE, config_params2_);
+    deleteVersion(ztable_segment_->getMemorySegment());
+
+    // Open mapped file 1 in read-write mode
+    ztable_segment_->reset(ZoneTableSegment::READ_WRITE, config_params_);
+
+    EXPECT_THROW({
+        ztable_segment_->reset(ZoneTableSegment::READ_ONLY, config_params2_);
+    }, ResetFailed);
+    EXPECT_THROW({
+        ztable_segment_->reset(ZoneTableSegment::READ_WRITE, config_params2_);
+    }, ResetFailed);
+
+    EXPECT_TRUE(ztable_segment_->isUsable());
+    EXPECT_TRUE(ztable_segment_->isWritable());
+    EXPECT_TRUE(verifyData(ztable_segment_->getMemorySegment()));
+}
+
 TEST_F(ZoneTableSegmentMappedTest, resetCreateOverCorruptedFile) {
     setupMappedFiles();
 
@@ -36,11 +36,14 @@ public:
                          bundy::util::MemorySegment& mem_sgmt) :
         ZoneTableSegment(rrclass),
         impl_type_("mock"),
+        rrclass_(rrclass),
         mem_sgmt_(mem_sgmt),
-        header_(ZoneTable::create(mem_sgmt_, rrclass))
+        header_(ZoneTable::create(mem_sgmt_, rrclass)),
+        shared_with_readers_(false)
     {}
 
     virtual ~ZoneTableSegmentMock() {
+        header_.destroyRetiredZoneData(mem_sgmt_, rrclass_);
         ZoneTable::destroy(mem_sgmt_, header_.getTable());
     }
 
@@ -76,10 +79,20 @@ public:
         return (true);
     }
 
+    virtual bool isSharedWithReaders() const {
+        return (shared_with_readers_);
+    }
+
+    void setSharedWithReaders(bool shared) {
+        shared_with_readers_ = shared;
+    }
+
 private:
     std::string impl_type_;
+    const bundy::dns::RRClass rrclass_;
     bundy::util::MemorySegment& mem_sgmt_;
     ZoneTableHeader header_;
+    bool shared_with_readers_;
 };
 
 } // namespace test
@@ -14,6 +14,7 @@
 
 #include <datasrc/memory/zone_writer.h>
 #include <datasrc/memory/zone_table_segment_local.h>
+#include <util/memory_segment_slab.h>
 
 #include <gtest/gtest.h>
 #include <boost/scoped_ptr.hpp>
@@ -54,6 +55,19 @@ TEST_F(ZoneTableSegmentTest, create) {
                  UnknownSegmentType);
 }
 
+TEST_F(ZoneTableSegmentTest, createSlab) {
+    // A local segment can use the slab allocator for the zone data.
+    ZoneTableSegment* ztable_segment =
+        ZoneTableSegment::create(RRClass::IN(), "local-slab");
+    EXPECT_EQ("local-slab", ztable_segment->getImplType());
+    EXPECT_TRUE(ztable_segment->isWritable());
+    EXPECT_NE(static_cast<void*>(NULL),
+              dynamic_cast<MemorySegmentSlab*>(
+                  &ztable_segment->getMemorySegment()));
+    EXPECT_NE(static_cast<void*>(NULL), ztable_segment->getHeader().getTable());
+    ZoneTableSegment::destroy(ztable_segment);
+}
+
 TEST_F(ZoneTableSegmentTest, reset) {
     // reset() should throw that it's not implemented so that any
     // accidental calls are found out.
@@ -299,6 +299,43 @@ TEST_F(ZoneWriterTest, reloadOverridden) {
     reloadCommon(false, 0);
 }
 
+TEST_F(ZoneWriterTest, sharedWithReaders) {
+    const Name zname("example.org");
+    reuse_old_data_ = true;
+    writer_->load();
+    writer_->install();
+    writer_->cleanup();
+    const ZoneData* const zd1 =
+        zt_segment_->getHeader().getTable()->findZone(zname).zone_data;
+    EXPECT_TRUE(zd1);
+
+    // If readers may be using the segment, the current data aren't reused
+    // but replaced with new ones, and they are only retired.
+    zt_segment_->setSharedWithReaders(true);
+    writer_.reset(new ZoneWriter(*zt_segment_,
+                                 boost::bind(&ZoneWriterTest::loaderCreator,
+                                             this, _1, _2),
+                                 zname, RRClass::IN(), false));
+    writer_->load();
+    writer_->install();
+    writer_->cleanup();
+    const ZoneData* const zd2 =
+        zt_segment_->getHeader().getTable()->findZone(zname).zone_data;
+    EXPECT_TRUE(zd2);
+    EXPECT_NE(zd1, zd2);
+    EXPECT_EQ(1, zt_segment_->getHeader().getRetiredZoneDataCount());
+
+    // Nor can a new zone be added to the table.
+    writer_.reset(new ZoneWriter(*zt_segment_,
+                                 boost::bind(&ZoneWriterTest::loaderCreator,
+                                             this, _1, _2),
+                                 Name("example.com"), RRClass::IN(), false));
+    EXPECT_THROW(writer_->load(), bundy::InvalidOperation);
+
+    zt_segment_->getHeader().destroyRetiredZoneData(mem_sgmt_, RRClass::IN());
+    EXPECT_EQ(0, zt_segment_->getHeader().getRetiredZoneDataCount());
+}
+
 TEST_F(ZoneWriterTest, growOnCommit) {
     reloadCommon(true, 0);
 }
@@ -22,10 +22,13 @@
 
 #include <exceptions/exceptions.h>
 
+#include <util/threads/thread.h>
+
 #include <sqlite3.h>
 
 #include <gtest/gtest.h>
 
+#include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/scoped_ptr.hpp>
 
@@ -763,6 +766,112 @@ TEST_F(SQLite3Create, lockedtest) {
     ASSERT_EQ(SQLITE_OK, sqlite3_close(db));
 }
 
+// Look up foo.example.com. and return the RDATA of its first record.
+void
+lookupFoo(boost::shared_ptr<const SQLite3Accessor> accessor, string* rdata) {
+    const std::pair<bool, int> zone_info(accessor->getZone("example.com."));
+    ASSERT_TRUE(zone_info.first);
+    DatabaseAccessor::IteratorContextPtr iterator =
+        accessor->getRecords("foo.example.com.", zone_info.second);
+    string columns[DatabaseAccessor::COLUMN_COUNT];
+    ASSERT_TRUE(iterator->getNext(columns));
+    *rdata = columns[DatabaseAccessor::RDATA_COLUMN];
+}
+
+TEST_F(SQLite3Create, writeAheadLogging) {
+    const std::string zone_name("example.com.");
+    boost::shared_ptr<SQLite3Accessor> accessor(
+        new SQLite3Accessor(SQLITE_NEW_DBFILE, "IN"));
+
+    // A new database is created in the WAL mode.
+    sqlite3* db;
+    ASSERT_EQ(SQLITE_OK, sqlite3_open(SQLITE_NEW_DBFILE, &db));
+    sqlite3_stmt* stmt;
+    ASSERT_EQ(SQLITE_OK, sqlite3_prepare_v2(db, "PRAGMA journal_mode", -1,
+                                            &stmt, NULL));
+    ASSERT_EQ(SQLITE_ROW, sqlite3_step(stmt));
+    EXPECT_EQ(string("wal"), reinterpret_cast<const char*>(
+                  sqlite3_column_text(stmt, 0)));
+    sqlite3_finalize(stmt);
+    ASSERT_EQ(SQLITE_OK, sqlite3_close(db));
+
+    const string columns[DatabaseAccessor::ADD_COLUMN_COUNT] = {
+        "foo.example.com.", "com.example.foo.", "3600", "A", "", "192.0.2.1"
+    };
+    accessor->startTransaction();
+    const int zone_id = accessor->addZone(zone_name);
+    accessor->commit();
+    accessor->startUpdateZone(zone_name, false);
+    accessor->addRecordToZone(columns);
+    accessor->commit();
+
+    // Unlike the commitConflict test of SQLite3Update, an ongoing read by
+    // another accessor doesn't prevent committing an update.
+    boost::shared_ptr<SQLite3Accessor> reader(
+        new SQLite3Accessor(SQLITE_NEW_DBFILE, "IN"));
+    DatabaseAccessor::IteratorContextPtr iterator =
+        reader->getRecords("foo.example.com.", zone_id);
+    string get_columns[DatabaseAccessor::COLUMN_COUNT];
+    EXPECT_TRUE(iterator->getNext(get_columns));
+
+    accessor->startUpdateZone(zone_name, true);
+    EXPECT_NO_THROW(accessor->commit());
+}
+
+// Multiple contexts of the same query type can be used at the same time,
+// and a context reusing the statement of a finished one starts afresh.
+TEST_F(SQLite3AccessorTest, concurrentContexts) {
+    const int zone_id = accessor->getZone("example.com.").second;
+    string columns1[DatabaseAccessor::COLUMN_COUNT];
+    string columns2[DatabaseAccessor::COLUMN_COUNT];
+
+    DatabaseAccessor::IteratorContextPtr iterator1 =
+        accessor->getRecords("foo.example.com.", zone_id);
+    DatabaseAccessor::IteratorContextPtr iterator2 =
+        accessor->getRecords("foo.example.com.", zone_id);
+    ASSERT_TRUE(iterator1->getNext(columns1));
+    ASSERT_TRUE(iterator2->getNext(columns2));
+    checkRecordRow(columns1, "CNAME", "3600", "", "cnametest.example.org.",
+                   "");
+    checkRecordRow(columns2, "CNAME", "3600", "", "cnametest.example.org.",
+                   "");
+
+    // Destroy them in the middle of the iteration; the next ones must not
+    // see the previous state.
+    iterator1.reset();
+    iterator2.reset();
+    iterator1 = accessor->getRecords("nosuchname.example.com.", zone_id);
+    EXPECT_FALSE(iterator1->getNext(columns1));
+    iterator1 = accessor->getRecords("foo.example.com.", zone_id);
+    ASSERT_TRUE(iterator1->getNext(columns1));
+    checkRecordRow(columns1, "CNAME", "3600", "", "cnametest.example.org.",
+                   "");
+}
+
+// Lookups from a thread other than the constructing one use a connection
+// of its own, so they work while the constructing thread is iterating.
+TEST_F(SQLite3AccessorTest, lookupInOtherThread) {
+    const std::pair<bool, int> zone_info(accessor->getZone("example.com."));
+    DatabaseAccessor::IteratorContextPtr iterator =
+        accessor->getRecords("foo.example.com.", zone_info.second);
+    string columns[DatabaseAccessor::COLUMN_COUNT];
+    ASSERT_TRUE(iterator->getNext(columns));
+
+    for (int i = 0; i < 2; ++i) {
+        string rdata;
+        bundy::util::thread::Thread thread(boost::bind(lookupFoo, accessor,
+                                                       &rdata));
+        thread.wait();
+        EXPECT_EQ("cnametest.example.org.", rdata);
+    }
+
+    // The original iteration isn't affected.
+    EXPECT_TRUE(iterator->getNext(columns));
+    checkRecordRow(columns, "RRSIG", "3600", "CNAME",
+                   "CNAME 5 3 3600 20100322084538 20100220084538 33495 "
+                   "example.com. FAKEFAKEFAKEFAKE", "");
+}
+
 TEST_F(SQLite3AccessorTest, clone) {
     boost::shared_ptr<DatabaseAccessor> cloned = accessor->clone();
     EXPECT_EQ(accessor->getDBName(), cloned->getDBName());
@@ -1667,4 +1776,234 @@ TEST_F(SQLite3Update, deleteZoneWhileLocked) {
     EXPECT_TRUE(accessor->getZone("example.com.").first);
 }
 
+//
+// Tests for the journal of the databases of the current schema.  The
+// tests above use a database of an older schema, which keeps the diffs
+// in the diffs table.
+//
+
+// Add the diffs of a version changing only the SOA serial.
+void
+addSOADiffs(SQLite3Accessor& accessor, int zone_id, uint32_t from,
+            uint32_t to)
+{
+    std::string params[DatabaseAccessor::DIFF_PARAM_COUNT] =
+        { "example.com.", "SOA", "3600", "" };
+    params[DatabaseAccessor::DIFF_RDATA] = "ns.example.com. "
+        "admin.example.com. " + lexical_cast<string>(from) +
+        " 3600 1800 2419200 7200";
+    accessor.addRecordDiff(zone_id, from, DatabaseAccessor::DIFF_DELETE,
+                           params);
+    params[DatabaseAccessor::DIFF_RDATA] = "ns.example.com. "
+        "admin.example.com. " + lexical_cast<string>(to) +
+        " 3600 1800 2419200 7200";
+    accessor.addRecordDiff(zone_id, to, DatabaseAccessor::DIFF_ADD, params);
+}
+
+// Count the diffs between two versions.
+size_t
+countDiffs(const SQLite3Accessor& accessor, int zone_id, uint32_t start,
+           uint32_t end)
+{
+    DatabaseAccessor::IteratorContextPtr context =
+        accessor.getDiffs(zone_id, start, end);
+    string data[DatabaseAccessor::COLUMN_COUNT];
+    size_t count = 0;
+    while (context->getNext(data)) {
+        ++count;
+    }
+    return (count);
+}
+
+TEST_F(SQLite3Create, journal) {
+    boost::shared_ptr<SQLite3Accessor> accessor(
+        new SQLite3Accessor(SQLITE_NEW_DBFILE, "IN"));
+    EXPECT_EQ(SQLite3Accessor::DEFAULT_JOURNAL_LIMIT,
+              accessor->getJournalLimit());
+    accessor->startTransaction();
+    const int zone_id = accessor->addZone("example.com.");
+    accessor->commit();
+
+    // The same diffs as the addDiffWithUpdate test.
+    accessor->startUpdateZone("example.com.", false);
+    const char* const* const diffs[] = {
+        diff_begin_data, diff_del_a_data, diff_end_data, diff_add_a_data
+    };
+    std::string diff_params[DatabaseAccessor::DIFF_PARAM_COUNT];
+    vector<const char* const*> expected_stored;
+    for (size_t i = 0; i < sizeof(diffs) / sizeof(diffs[0]); ++i) {
+        copy(diffs[i], diffs[i] + DatabaseAccessor::DIFF_PARAM_COUNT,
+             diff_params);
+        accessor->addRecordDiff(zone_id, getVersion(diffs[i]),
+                                getOperation(diffs[i]), diff_params);
+        expected_stored.push_back(diffs[i]);
+    }
+    // Another version in the same transaction.
+    addSOADiffs(*accessor, zone_id, 1300, 1301);
+
+    // Nothing is stored until the commit.
+    EXPECT_THROW(accessor->getDiffs(zone_id, 1234, 1300), NoSuchSerial);
+    accessor->commit();
+
+    checkDiffs(expected_stored, accessor->getDiffs(zone_id, 1234, 1300));
+    EXPECT_EQ(6, countDiffs(*accessor, zone_id, 1234, 1301));
+    EXPECT_EQ(2, countDiffs(*accessor, zone_id, 1300, 1301));
+
+    // The start version must exist, and the end one must be reachable
+    // from it.
+    EXPECT_THROW(accessor->getDiffs(zone_id, 1235, 1301), NoSuchSerial);
+    EXPECT_THROW(accessor->getDiffs(zone_id, 1234, 1302), NoSuchSerial);
+    EXPECT_THROW(accessor->getDiffs(zone_id, 1300, 1234), NoSuchSerial);
+
+    // The rolled back diffs are not stored.
+    accessor->startUpdateZone("example.com.", false);
+    addSOADiffs(*accessor, zone_id, 1301, 1302);
+    accessor->rollback();
+    EXPECT_THROW(accessor->getDiffs(zone_id, 1301, 1302), NoSuchSerial);
+}
+
+TEST_F(SQLite3Create, journalLimit) {
+    boost::shared_ptr<SQLite3Accessor> accessor(
+        new SQLite3Accessor(SQLITE_NEW_DBFILE, "IN"));
+    accessor->setJournalLimit(2);
+    accessor->startTransaction();
+    const int zone_id = accessor->addZone("example.com.");
+    const int other_zone_id = accessor->addZone("example.org.");
+    accessor->commit();
+
+    // The clones, used for the updates, keep the limit.
+    boost::shared_ptr<SQLite3Accessor> updater(
+        boost::dynamic_pointer_cast<SQLite3Accessor>(accessor->clone()));
+    ASSERT_TRUE(updater);
+    EXPECT_EQ(2, updater->getJournalLimit());
+
+    updater->startUpdateZone("example.org.", false);
+    addSOADiffs(*updater, other_zone_id, 1, 2);
+    updater->commit();
+
+    for (uint32_t serial = 10; serial < 13; ++serial) {
+        updater->startUpdateZone("example.com.", false);
+        addSOADiffs(*updater, zone_id, serial, serial + 1);
+        updater->commit();
+    }
+
+    // Only the two latest versions are kept, for this zone only.
+    EXPECT_THROW(accessor->getDiffs(zone_id, 10, 13), NoSuchSerial);
+    EXPECT_EQ(4, countDiffs(*accessor, zone_id, 11, 13));
+    EXPECT_EQ(2, countDiffs(*accessor, other_zone_id, 1, 2));
+
+    // Zero keeps them all.
+    updater->setJournalLimit(0);
+    for (uint32_t serial = 13; serial < 16; ++serial) {
+        updater->startUpdateZone("example.com.", false);
+        addSOADiffs(*updater, zone_id, serial, serial + 1);
+        updater->commit();
+    }
+    EXPECT_EQ(10, countDiffs(*accessor, zone_id, 11, 16));
+}
+
+// Count the indexes of the records table of the new database.
+int
+countRecordsIndexes() {
+    sqlite3* db;
+    EXPECT_EQ(SQLITE_OK, sqlite3_open(SQLITE_NEW_DBFILE, &db));
+    sqlite3_stmt* stmt;
+    EXPECT_EQ(SQLITE_OK, sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM "
+                                            "sqlite_master WHERE "
+                                            "type='index' AND "
+                                            "tbl_name='records'", -1,
+                                            &stmt, NULL));
+    EXPECT_EQ(SQLITE_ROW, sqlite3_step(stmt));
+    const int count = sqlite3_column_int(stmt, 0);
+    sqlite3_finalize(stmt);
+    EXPECT_EQ(SQLITE_OK, sqlite3_close(db));
+    return (count);
+}
+
+// Add the A records start.example.com. to (end - 1).example.com.
+void
+addRecords(SQLite3Accessor& accessor, int start, int end) {
+    string columns[DatabaseAccessor::ADD_COLUMN_COUNT] =
+        { "", "", "3600", "A", "", "192.0.2.1" };
+    for (int i = start; i < end; ++i) {
+        const string label = lexical_cast<string>(i);
+        columns[DatabaseAccessor::ADD_NAME] = label + ".example.com.";
+        columns[DatabaseAccessor::ADD_REV_NAME] = "com.example." + label + ".";
+        accessor.addRecordToZone(columns);
+    }
+}
+
+// Count the records of a zone.
+size_t
+countRecords(const SQLite3Accessor& accessor, int zone_id) {
+    DatabaseAccessor::IteratorContextPtr context =
+        accessor.getAllRecords(zone_id);
+    string data[DatabaseAccessor::COLUMN_COUNT];
+    size_t count = 0;
+    while (context->getNext(data)) {
+        ++count;
+    }
+    return (count);
+}
+
+TEST_F(SQLite3Create, bulkLoad) {
+    boost::shared_ptr<SQLite3Accessor> accessor(
+        new SQLite3Accessor(SQLITE_NEW_DBFILE, "IN"));
+    EXPECT_EQ(SQLite3Accessor::DEFAULT_BULK_LOAD_THRESHOLD,
+              accessor->getBulkLoadThreshold());
+    const int indexes = countRecordsIndexes();
+    EXPECT_LT(0, indexes);
+    accessor->setBulkLoadThreshold(10);
+    accessor->startTransaction();
+    const int zone_id = accessor->addZone("example.com.");
+    accessor->commit();
+
+    // The clones, used for the updates, keep the threshold.
+    boost::shared_ptr<SQLite3Accessor> updater(
+        boost::dynamic_pointer_cast<SQLite3Accessor>(accessor->clone()));
+    ASSERT_TRUE(updater);
+    EXPECT_EQ(10, updater->getBulkLoadThreshold());
+
+    // A rolled back load leaves the indexes (and the zone) as they were.
+    updater->startUpdateZone("example.com.", true);
+    addRecords(*updater, 0, 1000);
+    updater->rollback();
+    EXPECT_EQ(indexes, countRecordsIndexes());
+    EXPECT_EQ(0, countRecords(*accessor, zone_id));
+
+    // The records are all there once committed, including the ones of an
+    // incomplete batch, and the indexes are rebuilt.
+    updater->startUpdateZone("example.com.", true);
+    addRecords(*updater, 0, 1000);
+    updater->commit();
+    EXPECT_EQ(indexes, countRecordsIndexes());
+    EXPECT_EQ(1000, countRecords(*accessor, zone_id));
+
+    // The records added so far can be read within the update, and the
+    // load goes on as usual after that.
+    updater->startUpdateZone("example.com.", true);
+    addRecords(*updater, 0, 700);
+    vector<const char* const*> expected_stored;
+    const char* const expected_data[] = {
+        "699.example.com.", "com.example.699.", "3600", "A", "", "192.0.2.1"
+    };
+    expected_stored.push_back(expected_data);
+    checkRecords(*updater, zone_id, "699.example.com.", expected_stored);
+    addRecords(*updater, 700, 800);
+    const string del_params[DatabaseAccessor::DEL_PARAM_COUNT] =
+        { "0.example.com.", "A", "192.0.2.1", "com.example.0." };
+    updater->deleteRecordInZone(del_params);
+    updater->commit();
+    EXPECT_EQ(indexes, countRecordsIndexes());
+    EXPECT_EQ(799, countRecords(*accessor, zone_id));
+
+    // Zero disables bulk loading; the result is the same.
+    updater->setBulkLoadThreshold(0);
+    updater->startUpdateZone("example.com.", true);
+    addRecords(*updater, 0, 100);
+    updater->commit();
+    EXPECT_EQ(indexes, countRecordsIndexes());
+    EXPECT_EQ(100, countRecords(*accessor, zone_id));
+}
+
 } // end anonymous namespace
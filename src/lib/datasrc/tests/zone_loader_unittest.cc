@@ -54,7 +54,8 @@ public:
         DataSourceClient("mock"),
         commit_called_(false),
         missing_zone_(false),
-        rrclass_(RRClass::IN())
+        rrclass_(RRClass::IN()),
+        add_limit_(0)
     {}
     class Finder : public ZoneFinder {
     public:
@@ -171,6 +172,8 @@ public:
     bool missing_zone_;
     // The pretended class of the client. Usualy IN, but can be overriden.
     RRClass rrclass_;
+    // If non 0, the updater fails to add more RRsets than this.
+    size_t add_limit_;
 };
 
 // Test implementation of RRsetCollectionBase. This is currently just a
@@ -210,6 +213,10 @@ public:
         if (client_->commit_called_) {
             bundy_throw(DataSourceError, "Add after commit");
         }
+        if (client_->add_limit_ != 0 &&
+            client_->rrsets_.size() >= client_->add_limit_) {
+            bundy_throw(DataSourceError, "Too many RRsets");
+        }
         // We need to copy the RRset. We don't do it properly (we omit the
         // signature, for example), because we don't need to.
         RRsetPtr new_rrset(new bundy::dns::BasicRRset(rrset.getName(),
@@ -657,4 +664,79 @@ TEST_F(ZoneLoaderTest, copyCheck) {
     EXPECT_FALSE(destination_client_.commit_called_);
 }
 
+// Load a zone in the pipelined mode; the result is the same as without it,
+// including the order of the RRs.
+TEST_F(ZoneLoaderTest, loadPipelined) {
+    ZoneLoader loader(destination_client_, Name::ROOT_NAME(),
+                      TEST_DATA_DIR "/root.zone", true);
+    loader.load();
+    EXPECT_TRUE(destination_client_.commit_called_);
+    EXPECT_EQ(34, destination_client_.rrsets_.size());
+    EXPECT_EQ(34, loader.getRRCount());
+    EXPECT_EQ(1, loader.getProgress());
+
+    MockClient sequential_client;
+    ZoneLoader(sequential_client, Name::ROOT_NAME(),
+               TEST_DATA_DIR "/root.zone").load();
+    EXPECT_TRUE(sequential_client.rrset_texts_ ==
+                destination_client_.rrset_texts_);
+
+    EXPECT_THROW(loader.loadIncremental(1), bundy::InvalidOperation);
+}
+
+TEST_F(ZoneLoaderTest, loadPipelinedIncremental) {
+    ZoneLoader loader(destination_client_, Name::ROOT_NAME(),
+                      TEST_DATA_DIR "/root.zone", true);
+    // The RRs are read, but may not have been stored yet; we can't check
+    // the destination until the loading completes.
+    EXPECT_FALSE(loader.loadIncremental(10));
+    EXPECT_EQ(10, loader.getRRCount());
+    EXPECT_FALSE(destination_client_.commit_called_);
+
+    EXPECT_TRUE(loader.loadIncremental(30));
+    EXPECT_EQ(34, destination_client_.rrsets_.size());
+    EXPECT_EQ(34, loader.getRRCount());
+    EXPECT_TRUE(destination_client_.commit_called_);
+}
+
+TEST_F(ZoneLoaderTest, copyPipelined) {
+    prepareSource(Name("example.org"), "example.org.nsec3-signed");
+    ZoneLoader loader(destination_client_, Name("example.org"),
+                      *source_client_, true);
+    EXPECT_FALSE(loader.loadIncremental(5));
+    loader.load();
+    EXPECT_EQ(14, destination_client_.rrsets_.size());
+    EXPECT_EQ(14, loader.getRRCount());
+    EXPECT_TRUE(destination_client_.commit_called_);
+}
+
+// An error in storing the RRs is thrown to the caller of loadIncremental().
+TEST_F(ZoneLoaderTest, loadPipelinedStoreError) {
+    destination_client_.add_limit_ = 20;
+    ZoneLoader loader(destination_client_, Name::ROOT_NAME(),
+                      TEST_DATA_DIR "/root.zone", true);
+    EXPECT_THROW(loader.load(), DataSourceError);
+    EXPECT_EQ(20, destination_client_.rrsets_.size());
+    EXPECT_FALSE(destination_client_.commit_called_);
+}
+
+// The zone is checked after all RRs are stored.
+TEST_F(ZoneLoaderTest, loadPipelinedCheck) {
+    ZoneLoader loader(destination_client_, Name("example.org"),
+                      TEST_DATA_DIR "/novalidate.zone", true);
+    EXPECT_THROW(loader.loadIncremental(10), ZoneContentError);
+    EXPECT_FALSE(destination_client_.commit_called_);
+}
+
+// Destroying the loader in the middle of a pipelined load stops the store
+// thread; nothing is committed.
+TEST_F(ZoneLoaderTest, loadPipelinedAbort) {
+    {
+        ZoneLoader loader(destination_client_, Name::ROOT_NAME(),
+                          TEST_DATA_DIR "/root.zone", true);
+        EXPECT_FALSE(loader.loadIncremental(10));
+    }
+    EXPECT_FALSE(destination_client_.commit_called_);
+}
+
 }
@@ -22,13 +22,19 @@
 
 #include <dns/name.h>
 
+#include <util/buffer.h>
+
 #include <gtest/gtest.h>
 
+#include <vector>
+
 using namespace bundy::dns;
 using namespace bundy::datasrc;
 using namespace bundy::datasrc::internal;
 using bundy::data::Element;
 using bundy::datasrc::unittest::MockDataSourceClient;
+using bundy::util::InputBuffer;
+using bundy::util::OutputBuffer;
 
 namespace {
 
@@ -46,7 +52,8 @@ protected:
                          "{\"cache-enable\": true,"
                          " \"params\": "
                          "  {\"example.com\": \"/example-com.zone\","
-                         "   \"example.org\": \"/example-org.zone\"}"
+                         "   \"example.org\": \"/example-org.zone\","
+                         "   \"www.example.org\": \"/www-example-org.zone\"}"
                          "}")),
         cache_config_("MasterFiles", NULL, *config_spec_, true),
         accessor_(cache_config_)
@@ -72,6 +79,10 @@ TEST_F(ZoneTableAccessorTest, iteratorFromCache) {
     EXPECT_EQ(0, it->getCurrent().index);
     EXPECT_EQ(Name("example.org"), it->getCurrent().origin);
 
+    it->next();
+    EXPECT_FALSE(it->isLast());
+    EXPECT_EQ(Name("www.example.org"), it->getCurrent().origin);
+
     it->next();                 // shouldn't cause disruption
     EXPECT_TRUE(it->isLast());
 
@@ -80,6 +91,72 @@ TEST_F(ZoneTableAccessorTest, iteratorFromCache) {
     EXPECT_THROW(it->next(), bundy::InvalidOperation);
 }
 
+// Decode the names of the buffer.
+std::vector<Name>
+getNames(const OutputBuffer& buffer) {
+    std::vector<Name> names;
+    InputBuffer ibuffer(buffer.getData(), buffer.getLength());
+    while (ibuffer.getPosition() < ibuffer.getLength()) {
+        names.push_back(Name(ibuffer));
+    }
+    return (names);
+}
+
+TEST_F(ZoneTableAccessorTest, zoneNamesFromCache) {
+    OutputBuffer buffer(0);
+    EXPECT_EQ(3, accessor_.getZoneNames(buffer, 10));
+    std::vector<Name> names = getNames(buffer);
+    ASSERT_EQ(3, names.size());
+    EXPECT_EQ(Name("example.com"), names[0]);
+    EXPECT_EQ(Name("example.org"), names[1]);
+    EXPECT_EQ(Name("www.example.org"), names[2]);
+
+    // Pages of 2, the buffer is reused.
+    buffer.clear();
+    EXPECT_EQ(2, accessor_.getZoneNames(buffer, 2));
+    names = getNames(buffer);
+    ASSERT_EQ(2, names.size());
+    EXPECT_EQ(Name("example.org"), names[1]);
+    buffer.clear();
+    EXPECT_EQ(1, accessor_.getZoneNames(buffer, 2, &names[1]));
+    names = getNames(buffer);
+    ASSERT_EQ(1, names.size());
+    EXPECT_EQ(Name("www.example.org"), names[0]);
+    buffer.clear();
+    EXPECT_EQ(0, accessor_.getZoneNames(buffer, 2, &names[0]));
+    EXPECT_EQ(0, buffer.getLength());
+
+    // It can resume after a name that isn't in the table.
+    const Name example_net("example.net");
+    EXPECT_EQ(1, accessor_.getZoneNames(buffer, 1, &example_net));
+    EXPECT_EQ(Name("example.org"), getNames(buffer)[0]);
+
+    buffer.clear();
+    EXPECT_EQ(0, accessor_.getZoneNames(buffer, 0));
+    EXPECT_EQ(0, buffer.getLength());
+}
+
+TEST_F(ZoneTableAccessorTest, zoneNamesFromIterator) {
+    // The default implementation gives the same names, but only resumes
+    // after a name in the table.
+    OutputBuffer expected(0);
+    EXPECT_EQ(3, accessor_.getZoneNames(expected, 10));
+    OutputBuffer buffer(0);
+    EXPECT_EQ(3, accessor_.ZoneTableAccessor::getZoneNames(buffer, 10));
+    EXPECT_TRUE(getNames(expected) == getNames(buffer));
+
+    buffer.clear();
+    const Name example_com("example.com");
+    EXPECT_EQ(1, accessor_.ZoneTableAccessor::getZoneNames(buffer, 1,
+                                                           &example_com));
+    EXPECT_EQ(Name("example.org"), getNames(buffer)[0]);
+
+    buffer.clear();
+    const Name example_net("example.net");
+    EXPECT_EQ(0, accessor_.ZoneTableAccessor::getZoneNames(buffer, 1,
+                                                           &example_net));
+}
+
 TEST_F(ZoneTableAccessorTest, emptyTable) {
     // Empty zone table is possible, while mostly useless.
     const CacheConfig empty_config(
@@ -91,6 +168,9 @@ TEST_F(ZoneTableAccessorTest, emptyTable) {
     EXPECT_TRUE(it->isLast());
     EXPECT_THROW(it->getCurrent(), bundy::InvalidOperation);
     EXPECT_THROW(it->next(), bundy::InvalidOperation);
+
+    OutputBuffer buffer(0);
+    EXPECT_EQ(0, accessor.getZoneNames(buffer, 10));
 }
 
 TEST_F(ZoneTableAccessorTest, disabledTable) {
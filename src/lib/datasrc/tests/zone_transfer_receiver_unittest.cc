@@ -0,0 +1,385 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+#include <datasrc/zone_transfer_receiver.h>
+#include <datasrc/zone_transfer_sender.h>
+#include <datasrc/zone_iterator.h>
+#include <datasrc/zone.h>
+
+#include <dns/message.h>
+#include <dns/messagerenderer.h>
+#include <dns/name.h>
+#include <dns/opcode.h>
+#include <dns/question.h>
+#include <dns/rcode.h>
+#include <dns/rdataclass.h>
+#include <dns/rrclass.h>
+#include <dns/rrset.h>
+#include <dns/rrttl.h>
+#include <dns/rrtype.h>
+#include <dns/tsig.h>
+#include <dns/tsigkey.h>
+
+#include <util/threads/thread.h>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <gtest/gtest.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+using namespace bundy::datasrc;
+using namespace bundy::dns;
+using namespace bundy::dns::rdata;
+using bundy::util::thread::Thread;
+using boost::lexical_cast;
+using std::string;
+using std::vector;
+
+namespace {
+
+// An updater only recording the added RRsets.
+class TestUpdater : public ZoneUpdater {
+public:
+    virtual ZoneFinder& getFinder() {
+        bundy_throw(bundy::NotImplemented, "getFinder");
+    }
+    virtual RRsetCollectionBase& getRRsetCollection() {
+        bundy_throw(bundy::NotImplemented, "getRRsetCollection");
+    }
+    virtual void addRRset(const AbstractRRset& rrset) {
+        RRsetPtr copy(new RRset(rrset.getName(), rrset.getClass(),
+                                rrset.getType(), rrset.getTTL()));
+        for (RdataIteratorPtr it = rrset.getRdataIterator(); !it->isLast();
+             it->next()) {
+            copy->addRdata(it->getCurrent());
+        }
+        added_.push_back(copy);
+    }
+    virtual void deleteRRset(const AbstractRRset&) {
+        bundy_throw(bundy::NotImplemented, "deleteRRset");
+    }
+    virtual void commit() {
+        bundy_throw(bundy::NotImplemented, "commit");
+    }
+
+    vector<ConstRRsetPtr> added_;
+};
+
+class TestIterator : public ZoneIterator {
+public:
+    TestIterator(const vector<ConstRRsetPtr>& rrsets) :
+        rrsets_(rrsets), it_(rrsets_.begin())
+    {}
+    virtual ConstRRsetPtr getNextRRset() {
+        return (it_ == rrsets_.end() ? ConstRRsetPtr() : *it_++);
+    }
+    virtual ConstRRsetPtr getSOA() const {
+        bundy_throw(bundy::NotImplemented, "getSOA");
+    }
+private:
+    const vector<ConstRRsetPtr> rrsets_;
+    vector<ConstRRsetPtr>::const_iterator it_;
+};
+
+const uint8_t TSIG_SECRET[] = { 0x48, 0x5b, 0x96, 0x77, 0xfa, 0xbd, 0xf5,
+                                0x2c, 0xc5, 0xf1, 0x8c, 0xdd, 0xd5, 0x06,
+                                0xc1, 0xf6 };
+const qid_t QID = 0x1035;
+
+class ZoneTransferReceiverTest : public ::testing::Test {
+public:
+    ZoneTransferReceiverTest() :
+        zname_("example.org"), question_(zname_, RRClass::IN(), RRType::AXFR()),
+        soa_(createSOA(1234)),
+        tsig_key_(Name("key.example"), TSIGKey::HMACMD5_NAME(), TSIG_SECRET,
+                  sizeof(TSIG_SECRET)),
+        cancel_count_(0)
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+            bundy_throw(bundy::Unexpected, "socketpair failed");
+        }
+        send_fd_ = fds[0];
+        recv_fd_ = fds[1];
+        receiver_.reset(new ZoneTransferReceiver(recv_fd_, QID, NULL, 1000));
+    }
+    ~ZoneTransferReceiverTest() {
+        if (sender_thread_) {
+            sender_thread_->wait();
+        }
+        close(send_fd_);
+        close(recv_fd_);
+    }
+
+    ConstRRsetPtr createSOA(uint32_t serial) const {
+        return (createRRset(zname_, RRType::SOA(),
+                            "ns.example.org. admin.example.org. " +
+                            lexical_cast<string>(serial) +
+                            " 3600 1800 2419200 7200"));
+    }
+
+    static ConstRRsetPtr createRRset(const Name& name, const RRType& type,
+                                     const string& rdata_txt)
+    {
+        RRsetPtr rrset(new RRset(name, RRClass::IN(), type, RRTTL(3600)));
+        rrset->addRdata(createRdata(type, RRClass::IN(), rdata_txt));
+        return (rrset);
+    }
+
+    // A zone of the given number of A RRsets.
+    vector<ConstRRsetPtr> createZone(size_t count) const {
+        vector<ConstRRsetPtr> rrsets;
+        for (size_t i = 0; i < count; ++i) {
+            rrsets.push_back(createRRset(
+                                 Name("host" + lexical_cast<string>(i)).
+                                 concatenate(zname_), RRType::A(),
+                                 "192.0.2." +
+                                 lexical_cast<string>(i % 256)));
+        }
+        return (rrsets);
+    }
+
+    // Write a response message containing the given RRsets.
+    void sendMessage(const vector<ConstRRsetPtr>& rrsets,
+                     TSIGContext* tsig_ctx = NULL, qid_t qid = QID,
+                     const Rcode& rcode = Rcode::NOERROR(), bool qr = true)
+    {
+        Message message(Message::RENDER);
+        message.setQid(qid);
+        message.setOpcode(Opcode::QUERY());
+        message.setRcode(rcode);
+        message.setHeaderFlag(Message::HEADERFLAG_QR, qr);
+        message.addQuestion(question_);
+        for (size_t i = 0; i < rrsets.size(); ++i) {
+            message.addRRset(Message::SECTION_ANSWER,
+                             boost::const_pointer_cast<AbstractRRset>(
+                                 rrsets[i]));
+        }
+        MessageRenderer renderer;
+        message.toWire(renderer, tsig_ctx);
+        const uint8_t len_buf[2] = {
+            static_cast<uint8_t>(renderer.getLength() >> 8),
+            static_cast<uint8_t>(renderer.getLength() & 0xff) };
+        writeData(len_buf, sizeof(len_buf));
+        writeData(renderer.getData(), renderer.getLength());
+    }
+
+    void writeData(const void* data, size_t len) {
+        ASSERT_EQ(static_cast<ssize_t>(len), write(send_fd_, data, len));
+    }
+
+    // Send a whole zone with ZoneTransferSender in a separate thread.
+    void startSender(size_t count, TSIGContext* tsig_ctx = NULL) {
+        zone_ = createZone(count);
+        iterator_.reset(new TestIterator(zone_));
+        sender_.reset(new ZoneTransferSender(send_fd_, QID, 0, question_,
+                                             tsig_ctx));
+        sender_thread_.reset(new Thread(
+                                 boost::bind(&ZoneTransferReceiverTest::
+                                             runSender, this)));
+    }
+
+    void runSender() {
+        sender_->sendZone(*iterator_, *soa_);
+    }
+
+    bool cancelAfter(size_t count) {
+        return (++cancel_count_ > count);
+    }
+
+    const Name zname_;
+    const Question question_;
+    const ConstRRsetPtr soa_;
+    const TSIGKey tsig_key_;
+    int send_fd_;
+    int recv_fd_;
+    boost::scoped_ptr<ZoneTransferReceiver> receiver_;
+    TestUpdater updater_;
+    vector<ConstRRsetPtr> zone_;
+    boost::scoped_ptr<TestIterator> iterator_;
+    boost::scoped_ptr<ZoneTransferSender> sender_;
+    boost::scoped_ptr<Thread> sender_thread_;
+    size_t cancel_count_;
+};
+
+TEST_F(ZoneTransferReceiverTest, receive) {
+    vector<ConstRRsetPtr> rrsets;
+    rrsets.push_back(soa_);
+    rrsets.push_back(createRRset(zname_, RRType::NS(), "ns.example.org."));
+    rrsets.push_back(createRRset(Name("ns.example.org"), RRType::A(),
+                                 "192.0.2.1"));
+    rrsets.push_back(createSOA(1235));
+    sendMessage(rrsets);
+    EXPECT_TRUE(receiver_->receiveAXFR(updater_));
+
+    // The first SOA isn't added, but the last one is.
+    ASSERT_EQ(3, updater_.added_.size());
+    EXPECT_EQ(RRType::NS(), updater_.added_[0]->getType());
+    EXPECT_EQ(RRType::A(), updater_.added_[1]->getType());
+    EXPECT_EQ(RRType::SOA(), updater_.added_[2]->getType());
+    EXPECT_EQ(3, receiver_->getRRCount());
+    EXPECT_EQ(1, receiver_->getMessageCount());
+    EXPECT_EQ(1234, receiver_->getBeginSerial());
+    EXPECT_EQ(1235, receiver_->getEndSerial());
+}
+
+TEST_F(ZoneTransferReceiverTest, receiveMultipleMessages) {
+    vector<ConstRRsetPtr> rrsets;
+    rrsets.push_back(soa_);
+    sendMessage(rrsets);
+    rrsets.clear();
+    rrsets.push_back(createRRset(zname_, RRType::NS(), "ns.example.org."));
+    sendMessage(rrsets);
+    rrsets.clear();
+    rrsets.push_back(soa_);
+    sendMessage(rrsets);
+    EXPECT_TRUE(receiver_->receiveAXFR(updater_));
+    EXPECT_EQ(2, updater_.added_.size());
+    EXPECT_EQ(3, receiver_->getMessageCount());
+}
+
+TEST_F(ZoneTransferReceiverTest, receiveLargeZone) {
+    startSender(10000);
+    EXPECT_TRUE(receiver_->receiveAXFR(updater_));
+    sender_thread_->wait();
+    sender_thread_.reset();
+    EXPECT_LT(1, receiver_->getMessageCount());
+    EXPECT_EQ(sender_->getMessageCount(), receiver_->getMessageCount());
+    ASSERT_EQ(zone_.size() + 1, updater_.added_.size());
+    for (size_t i = 0; i < zone_.size(); ++i) {
+        EXPECT_EQ(zone_[i]->getName(), updater_.added_[i]->getName());
+    }
+    EXPECT_EQ(RRType::SOA(), updater_.added_.back()->getType());
+}
+
+TEST_F(ZoneTransferReceiverTest, receiveSigned) {
+    // Sign the request at the client side and verify it at the server side.
+    TSIGContext client_ctx(tsig_key_);
+    TSIGContext server_ctx(tsig_key_);
+    Message request(Message::RENDER);
+    request.setQid(QID);
+    request.setOpcode(Opcode::QUERY());
+    request.setRcode(Rcode::NOERROR());
+    request.addQuestion(question_);
+    MessageRenderer renderer;
+    request.toWire(renderer, &client_ctx);
+    Message parsed(Message::PARSE);
+    bundy::util::InputBuffer buffer(renderer.getData(), renderer.getLength());
+    parsed.fromWire(buffer);
+    ASSERT_EQ(TSIGError::NOERROR(),
+              server_ctx.verify(parsed.getTSIGRecord(), renderer.getData(),
+                                renderer.getLength()));
+
+    receiver_.reset(new ZoneTransferReceiver(recv_fd_, QID, &client_ctx,
+                                             1000));
+    startSender(10000, &server_ctx);
+    EXPECT_TRUE(receiver_->receiveAXFR(updater_));
+    EXPECT_EQ(zone_.size() + 1, updater_.added_.size());
+}
+
+TEST_F(ZoneTransferReceiverTest, badTSIG) {
+    // The response is signed, but the request wasn't.
+    TSIGContext ctx(tsig_key_);
+    vector<ConstRRsetPtr> rrsets;
+    rrsets.push_back(soa_);
+    rrsets.push_back(soa_);
+    sendMessage(rrsets, &ctx);
+    EXPECT_THROW(receiver_->receiveAXFR(updater_), ZoneTransferError);
+}
+
+TEST_F(ZoneTransferReceiverTest, unsignedResponse) {
+    // The request was signed, but the response isn't.
+    TSIGContext ctx(tsig_key_);
+    receiver_.reset(new ZoneTransferReceiver(recv_fd_, QID, &ctx, 1000));
+    vector<ConstRRsetPtr> rrsets;
+    rrsets.push_back(soa_);
+    rrsets.push_back(soa_);
+    sendMessage(rrsets);
+    EXPECT_THROW(receiver_->receiveAXFR(updater_), ZoneTransferError);
+}
+
+TEST_F(ZoneTransferReceiverTest, badHeader) {
+    vector<ConstRRsetPtr> rrsets;
+    rrsets.push_back(soa_);
+    rrsets.push_back(soa_);
+
+    sendMessage(rrsets, NULL, QID + 1);
+    EXPECT_THROW(receiver_->receiveAXFR(updater_), ZoneTransferError);
+
+    receiver_.reset(new ZoneTransferReceiver(recv_fd_, QID, NULL, 1000));
+    sendMessage(rrsets, NULL, QID, Rcode::NOTAUTH());
+    EXPECT_THROW(receiver_->receiveAXFR(updater_), ZoneTransferError);
+
+    receiver_.reset(new ZoneTransferReceiver(recv_fd_, QID, NULL, 1000));
+    sendMessage(rrsets, NULL, QID, Rcode::NOERROR(), false);
+    EXPECT_THROW(receiver_->receiveAXFR(updater_), ZoneTransferError);
+}
+
+TEST_F(ZoneTransferReceiverTest, badSequence) {
+    // The first RR must be SOA.
+    vector<ConstRRsetPtr> rrsets;
+    rrsets.push_back(createRRset(zname_, RRType::NS(), "ns.example.org."));
+    rrsets.push_back(soa_);
+    sendMessage(rrsets);
+    EXPECT_THROW(receiver_->receiveAXFR(updater_), ZoneTransferError);
+}
+
+TEST_F(ZoneTransferReceiverTest, extraData) {
+    vector<ConstRRsetPtr> rrsets;
+    rrsets.push_back(soa_);
+    rrsets.push_back(soa_);
+    rrsets.push_back(createRRset(zname_, RRType::NS(), "ns.example.org."));
+    sendMessage(rrsets);
+    EXPECT_THROW(receiver_->receiveAXFR(updater_), ZoneTransferError);
+}
+
+TEST_F(ZoneTransferReceiverTest, connectionClosed) {
+    vector<ConstRRsetPtr> rrsets;
+    rrsets.push_back(soa_);
+    sendMessage(rrsets);
+    // A length field without the message.
+    const uint8_t len_buf[2] = { 0, 100 };
+    writeData(len_buf, sizeof(len_buf));
+    shutdown(send_fd_, SHUT_WR);
+    EXPECT_THROW(receiver_->receiveAXFR(updater_), ZoneTransferError);
+    EXPECT_EQ(1, receiver_->getMessageCount());
+}
+
+TEST_F(ZoneTransferReceiverTest, timeout) {
+    receiver_.reset(new ZoneTransferReceiver(recv_fd_, QID, NULL, 10));
+    EXPECT_THROW(receiver_->receiveAXFR(updater_), ZoneTransferError);
+}
+
+TEST_F(ZoneTransferReceiverTest, cancel) {
+    receiver_->setCancelCallback(
+        boost::bind(&ZoneTransferReceiverTest::cancelAfter, this, 1));
+    vector<ConstRRsetPtr> rrsets;
+    rrsets.push_back(soa_);
+    for (size_t i = 0; i < 3; ++i) {
+        sendMessage(rrsets);
+        rrsets[0] = createRRset(zname_, RRType::NS(), "ns.example.org.");
+    }
+    EXPECT_FALSE(receiver_->receiveAXFR(updater_));
+    EXPECT_EQ(2, cancel_count_);
+    EXPECT_EQ(2, receiver_->getMessageCount());
+}
+
+}
@@ -0,0 +1,396 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+#include <datasrc/zone_transfer_sender.h>
+#include <datasrc/zone_iterator.h>
+
+#include <dns/message.h>
+#include <dns/messagerenderer.h>
+#include <dns/name.h>
+#include <dns/opcode.h>
+#include <dns/question.h>
+#include <dns/rcode.h>
+#include <dns/rdataclass.h>
+#include <dns/rrclass.h>
+#include <dns/rrset.h>
+#include <dns/rrttl.h>
+#include <dns/rrtype.h>
+#include <dns/tsig.h>
+#include <dns/tsigkey.h>
+
+#include <util/buffer.h>
+#include <util/threads/thread.h>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <gtest/gtest.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+using namespace bundy::datasrc;
+using namespace bundy::dns;
+using namespace bundy::dns::rdata;
+using bundy::util::InputBuffer;
+using bundy::util::thread::Thread;
+using boost::lexical_cast;
+using std::string;
+using std::vector;
+
+namespace {
+
+// A zone iterator and journal reader returning the given RRsets.
+class TestIterator : public ZoneIterator {
+public:
+    TestIterator(const vector<ConstRRsetPtr>& rrsets) :
+        rrsets_(rrsets), it_(rrsets_.begin())
+    {}
+    virtual ConstRRsetPtr getNextRRset() {
+        return (it_ == rrsets_.end() ? ConstRRsetPtr() : *it_++);
+    }
+    virtual ConstRRsetPtr getSOA() const {
+        bundy_throw(bundy::NotImplemented, "getSOA");
+    }
+private:
+    const vector<ConstRRsetPtr> rrsets_;
+    vector<ConstRRsetPtr>::const_iterator it_;
+};
+
+class TestJournalReader : public ZoneJournalReader {
+public:
+    TestJournalReader(const vector<ConstRRsetPtr>& rrsets) :
+        rrsets_(rrsets), it_(rrsets_.begin())
+    {}
+    virtual ConstRRsetPtr getNextDiff() {
+        return (it_ == rrsets_.end() ? ConstRRsetPtr() : *it_++);
+    }
+private:
+    const vector<ConstRRsetPtr> rrsets_;
+    vector<ConstRRsetPtr>::const_iterator it_;
+};
+
+const uint8_t TSIG_SECRET[] = { 0x48, 0x5b, 0x96, 0x77, 0xfa, 0xbd, 0xf5,
+                                0x2c, 0xc5, 0xf1, 0x8c, 0xdd, 0xd5, 0x06,
+                                0xc1, 0xf6 };
+
+class ZoneTransferSenderTest : public ::testing::Test {
+public:
+    ZoneTransferSenderTest() :
+        zname_("example.org"), question_(zname_, RRClass::IN(), RRType::AXFR()),
+        soa_(createRRset(zname_, RRType::SOA(),
+                         "ns.example.org. admin.example.org. "
+                         "1234 3600 1800 2419200 7200")),
+        tsig_key_(Name("key.example"), TSIGKey::HMACMD5_NAME(), TSIG_SECRET,
+                  sizeof(TSIG_SECRET)),
+        cancel_count_(0)
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+            bundy_throw(bundy::Unexpected, "socketpair failed");
+        }
+        send_fd_ = fds[0];
+        recv_fd_ = fds[1];
+        sender_.reset(new ZoneTransferSender(send_fd_, 0x1035,
+                                             Message::HEADERFLAG_RD,
+                                             question_, NULL));
+        // Read the responses in a separate thread so large transfers
+        // won't block.
+        reader_.reset(new Thread(boost::bind(
+                                     &ZoneTransferSenderTest::readAll,
+                                     this)));
+    }
+    ~ZoneTransferSenderTest() {
+        finish();
+    }
+
+    static ConstRRsetPtr createRRset(const Name& name, const RRType& type,
+                                     const string& rdata_txt)
+    {
+        RRsetPtr rrset(new RRset(name, RRClass::IN(), type, RRTTL(3600)));
+        rrset->addRdata(createRdata(type, RRClass::IN(), rdata_txt));
+        return (rrset);
+    }
+
+    // A zone of the given number of A RRsets, with a SOA in the middle.
+    vector<ConstRRsetPtr> createZone(size_t count) const {
+        vector<ConstRRsetPtr> rrsets;
+        for (size_t i = 0; i < count; ++i) {
+            if (i == count / 2) {
+                rrsets.push_back(soa_);
+            }
+            rrsets.push_back(createRRset(
+                                 Name("host" + lexical_cast<string>(i)).
+                                 concatenate(zname_), RRType::A(),
+                                 "192.0.2." +
+                                 lexical_cast<string>(i % 256)));
+        }
+        return (rrsets);
+    }
+
+    void readAll() {
+        uint8_t buf[4096];
+        ssize_t cc;
+        while ((cc = read(recv_fd_, buf, sizeof(buf))) > 0) {
+            received_.insert(received_.end(), buf, buf + cc);
+        }
+    }
+
+    // Close the sending side and wait for all data to be read.
+    void finish() {
+        if (send_fd_ >= 0) {
+            close(send_fd_);
+            send_fd_ = -1;
+            reader_->wait();
+            close(recv_fd_);
+        }
+    }
+
+    // Split the received data into messages.
+    vector<vector<uint8_t> > getMessages() {
+        finish();
+        vector<vector<uint8_t> > messages;
+        size_t pos = 0;
+        while (pos + 2 <= received_.size()) {
+            const size_t len = (received_[pos] << 8) | received_[pos + 1];
+            pos += 2;
+            EXPECT_GE(received_.size(), pos + len);
+            messages.push_back(vector<uint8_t>(&received_[pos],
+                                               &received_[pos] + len));
+            pos += len;
+        }
+        EXPECT_EQ(received_.size(), pos);
+        return (messages);
+    }
+
+    // Parse the received messages, check the header and question, and
+    // return all answer RRsets in order.
+    vector<ConstRRsetPtr> parseMessages(TSIGContext* tsig_ctx = NULL) {
+        vector<ConstRRsetPtr> rrsets;
+        const vector<vector<uint8_t> > messages = getMessages();
+        for (size_t i = 0; i < messages.size(); ++i) {
+            Message message(Message::PARSE);
+            InputBuffer buffer(&messages[i][0], messages[i].size());
+            message.fromWire(buffer, Message::PRESERVE_ORDER);
+            EXPECT_EQ(0x1035, message.getQid());
+            EXPECT_EQ(Opcode::QUERY(), message.getOpcode());
+            EXPECT_EQ(Rcode::NOERROR(), message.getRcode());
+            EXPECT_TRUE(message.getHeaderFlag(Message::HEADERFLAG_QR));
+            EXPECT_TRUE(message.getHeaderFlag(Message::HEADERFLAG_AA));
+            EXPECT_TRUE(message.getHeaderFlag(Message::HEADERFLAG_RD));
+            EXPECT_FALSE(message.getHeaderFlag(Message::HEADERFLAG_TC));
+            // Only the first message has the question.
+            EXPECT_EQ(i == 0 ? 1 : 0,
+                      message.getRRCount(Message::SECTION_QUESTION));
+            if (tsig_ctx != NULL) {
+                EXPECT_EQ(TSIGError::NOERROR(),
+                          tsig_ctx->verify(message.getTSIGRecord(),
+                                           &messages[i][0],
+                                           messages[i].size()));
+            } else {
+                EXPECT_EQ(static_cast<const TSIGRecord*>(NULL),
+                          message.getTSIGRecord());
+            }
+            for (RRsetIterator it =
+                     message.beginSection(Message::SECTION_ANSWER);
+                 it != message.endSection(Message::SECTION_ANSWER); ++it) {
+                rrsets.push_back(*it);
+            }
+        }
+        return (rrsets);
+    }
+
+    bool cancelAfter(size_t count) {
+        return (++cancel_count_ > count);
+    }
+
+    const Name zname_;
+    const Question question_;
+    const ConstRRsetPtr soa_;
+    const TSIGKey tsig_key_;
+    int send_fd_;
+    int recv_fd_;
+    boost::scoped_ptr<ZoneTransferSender> sender_;
+    boost::scoped_ptr<Thread> reader_;
+    vector<uint8_t> received_;
+    size_t cancel_count_;
+};
+
+TEST_F(ZoneTransferSenderTest, sendZone) {
+    const vector<ConstRRsetPtr> zone = createZone(10);
+    TestIterator iterator(zone);
+    EXPECT_TRUE(sender_->sendZone(iterator, *soa_));
+    EXPECT_EQ(1, sender_->getMessageCount());
+
+    // SOA, all RRsets but the SOA in the middle, then SOA again.
+    const vector<ConstRRsetPtr> rrsets = parseMessages();
+    ASSERT_EQ(zone.size() + 1, rrsets.size());
+    EXPECT_EQ(RRType::SOA(), rrsets.front()->getType());
+    EXPECT_EQ(RRType::SOA(), rrsets.back()->getType());
+    size_t j = 1;
+    for (size_t i = 0; i < zone.size(); ++i) {
+        if (zone[i]->getType() == RRType::SOA()) {
+            continue;
+        }
+        EXPECT_EQ(zone[i]->getName(), rrsets[j]->getName());
+        EXPECT_EQ(zone[i]->getType(), rrsets[j]->getType());
+        ++j;
+    }
+}
+
+TEST_F(ZoneTransferSenderTest, sendLargeZone) {
+    // This can't fit in a single 64KB message.
+    const vector<ConstRRsetPtr> zone = createZone(10000);
+    TestIterator iterator(zone);
+    EXPECT_TRUE(sender_->sendZone(iterator, *soa_));
+    EXPECT_LT(1, sender_->getMessageCount());
+
+    // Every message other than the last one should be nearly full.
+    const vector<vector<uint8_t> > messages = getMessages();
+    ASSERT_EQ(sender_->getMessageCount(), messages.size());
+    for (size_t i = 0; i + 1 < messages.size(); ++i) {
+        EXPECT_LT(ZoneTransferSender::MAX_MESSAGE_SIZE - 100,
+                  messages[i].size());
+        EXPECT_GE(ZoneTransferSender::MAX_MESSAGE_SIZE, messages[i].size());
+    }
+}
+
+TEST_F(ZoneTransferSenderTest, sendLargeZoneRRsets) {
+    const vector<ConstRRsetPtr> zone = createZone(10000);
+    TestIterator iterator(zone);
+    EXPECT_TRUE(sender_->sendZone(iterator, *soa_));
+    const vector<ConstRRsetPtr> rrsets = parseMessages();
+    ASSERT_EQ(zone.size() + 1, rrsets.size());
+    EXPECT_EQ(RRType::SOA(), rrsets.front()->getType());
+    EXPECT_EQ(RRType::SOA(), rrsets.back()->getType());
+    EXPECT_EQ(zone.back()->getName(), rrsets[rrsets.size() - 2]->getName());
+}
+
+TEST_F(ZoneTransferSenderTest, sendDiffs) {
+    vector<ConstRRsetPtr> diffs;
+    diffs.push_back(createRRset(zname_, RRType::SOA(),
+                                "ns.example.org. admin.example.org. "
+                                "1233 3600 1800 2419200 7200"));
+    diffs.push_back(createRRset(Name("host.example.org"), RRType::A(),
+                                "192.0.2.1"));
+    diffs.push_back(soa_);
+    diffs.push_back(createRRset(Name("host.example.org"), RRType::A(),
+                                "192.0.2.2"));
+    TestJournalReader reader(diffs);
+    EXPECT_TRUE(sender_->sendDiffs(reader, *soa_));
+
+    // The SOAs in the diffs are kept.
+    const vector<ConstRRsetPtr> rrsets = parseMessages();
+    ASSERT_EQ(diffs.size() + 2, rrsets.size());
+    EXPECT_EQ(RRType::SOA(), rrsets[0]->getType());
+    for (size_t i = 0; i < diffs.size(); ++i) {
+        EXPECT_EQ(diffs[i]->getType(), rrsets[i + 1]->getType());
+        EXPECT_EQ(diffs[i]->getName(), rrsets[i + 1]->getName());
+    }
+    EXPECT_EQ(RRType::SOA(), rrsets.back()->getType());
+}
+
+TEST_F(ZoneTransferSenderTest, sendSOA) {
+    sender_->sendSOA(*soa_);
+    EXPECT_EQ(1, sender_->getMessageCount());
+    const vector<ConstRRsetPtr> rrsets = parseMessages();
+    ASSERT_EQ(1, rrsets.size());
+    EXPECT_EQ(RRType::SOA(), rrsets[0]->getType());
+}
+
+TEST_F(ZoneTransferSenderTest, caseSensitiveCompression) {
+    // Names differing only in case must be preserved as they are.
+    vector<ConstRRsetPtr> zone;
+    zone.push_back(createRRset(Name("host.Example.ORG"), RRType::A(),
+                               "192.0.2.1"));
+    TestIterator iterator(zone);
+    EXPECT_TRUE(sender_->sendZone(iterator, *soa_));
+    const vector<ConstRRsetPtr> rrsets = parseMessages();
+    ASSERT_EQ(3, rrsets.size());
+    EXPECT_EQ("host.Example.ORG.", rrsets[1]->getName().toText());
+}
+
+TEST_F(ZoneTransferSenderTest, cancel) {
+    sender_->setCancelCallback(
+        boost::bind(&ZoneTransferSenderTest::cancelAfter, this, 1));
+    const vector<ConstRRsetPtr> zone = createZone(10000);
+    TestIterator iterator(zone);
+    EXPECT_FALSE(sender_->sendZone(iterator, *soa_));
+    // The callback was called before the second and third messages.
+    EXPECT_EQ(2, cancel_count_);
+    EXPECT_EQ(2, sender_->getMessageCount());
+    EXPECT_EQ(2, getMessages().size());
+}
+
+TEST_F(ZoneTransferSenderTest, tooLargeRRset) {
+    // An RRset of 64KB or more can never fit in a message.
+    RRsetPtr rrset(new RRset(Name("txt.example.org"), RRClass::IN(),
+                             RRType::TXT(), RRTTL(3600)));
+    const string txt = "\"" + string(255, 'x') + "\"";
+    for (size_t i = 0; i < 300; ++i) {
+        rrset->addRdata(createRdata(RRType::TXT(), RRClass::IN(),
+                                    txt + " \"" + lexical_cast<string>(i) +
+                                    "\""));
+    }
+    vector<ConstRRsetPtr> zone;
+    zone.push_back(rrset);
+    TestIterator iterator(zone);
+    EXPECT_THROW(sender_->sendZone(iterator, *soa_), ZoneTransferError);
+}
+
+TEST_F(ZoneTransferSenderTest, writeError) {
+    // Using a bad file descriptor to emulate write errors.
+    ZoneTransferSender sender(-1, 0x1035, 0, question_, NULL);
+    EXPECT_THROW(sender.sendSOA(*soa_), ZoneTransferError);
+    EXPECT_EQ(0, sender.getMessageCount());
+}
+
+TEST_F(ZoneTransferSenderTest, signedResponses) {
+    // Sign the request at the client side and verify it at the server
+    // side, so that the contexts are ready for the responses.
+    TSIGContext client_ctx(tsig_key_);
+    TSIGContext server_ctx(tsig_key_);
+    Message request(Message::RENDER);
+    request.setQid(0x1035);
+    request.setOpcode(Opcode::QUERY());
+    request.setRcode(Rcode::NOERROR());
+    request.addQuestion(question_);
+    MessageRenderer renderer;
+    request.toWire(renderer, &client_ctx);
+    Message parsed(Message::PARSE);
+    InputBuffer buffer(renderer.getData(), renderer.getLength());
+    parsed.fromWire(buffer);
+    ASSERT_EQ(TSIGError::NOERROR(),
+              server_ctx.verify(parsed.getTSIGRecord(), renderer.getData(),
+                                renderer.getLength()));
+
+    sender_.reset(new ZoneTransferSender(send_fd_, 0x1035,
+                                         Message::HEADERFLAG_RD,
+                                         question_, &server_ctx));
+    const vector<ConstRRsetPtr> zone = createZone(10000);
+    TestIterator iterator(zone);
+    EXPECT_TRUE(sender_->sendZone(iterator, *soa_));
+    EXPECT_LT(1, sender_->getMessageCount());
+
+    // Every message is signed, and is still within the size limit.
+    const vector<ConstRRsetPtr> rrsets = parseMessages(&client_ctx);
+    EXPECT_EQ(zone.size() + 1, rrsets.size());
+    EXPECT_TRUE(client_ctx.lastHadSignature());
+}
+
+}
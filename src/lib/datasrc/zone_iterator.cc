@@ -0,0 +1,120 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+#include <datasrc/zone_iterator.h>
+
+#include <dns/messagerenderer.h>
+#include <dns/rdata.h>
+#include <dns/rrclass.h>
+#include <dns/rrttl.h>
+#include <dns/rrtype.h>
+
+using namespace bundy::dns;
+using bundy::util::OutputBuffer;
+
+namespace bundy {
+namespace datasrc {
+
+namespace {
+// Render the RRs of the RRset without name compression.  We don't use
+// AbstractRRset::toWire() as not all implementations support rendering to
+// a plain buffer.
+size_t
+renderRRs(const AbstractRRset& rrset, OutputBuffer& buffer) {
+    size_t count = 0;
+    for (RdataIteratorPtr it = rrset.getRdataIterator(); !it->isLast();
+         it->next()) {
+        rrset.getName().toWire(buffer);
+        rrset.getType().toWire(buffer);
+        rrset.getClass().toWire(buffer);
+        rrset.getTTL().toWire(buffer);
+        const size_t rdlen_pos = buffer.getLength();
+        buffer.skip(sizeof(uint16_t));
+        it->getCurrent().toWire(buffer);
+        buffer.writeUint16At(buffer.getLength() - rdlen_pos -
+                             sizeof(uint16_t), rdlen_pos);
+        ++count;
+    }
+    return (count);
+}
+}
+
+size_t
+ZoneIterator::getNextRRs(OutputBuffer& buffer, size_t max_length) {
+    const size_t start = buffer.getLength();
+    size_t count = 0;
+    while (!rrs_end_ && buffer.getLength() - start < max_length) {
+        const ConstRRsetPtr rrset = getNextRRset();
+        if (!rrset) {
+            rrs_end_ = true;
+        } else {
+            count += renderRRs(*rrset, buffer);
+            if (rrset->getRRsig()) {
+                count += renderRRs(*rrset->getRRsig(), buffer);
+            }
+        }
+    }
+    return (count);
+}
+
+size_t
+ZoneIterator::getNextRRsText(MasterTextRenderer& renderer,
+                             size_t max_length)
+{
+    const size_t start = renderer.getLength();
+    size_t count = 0;
+    while (!rrs_end_ && renderer.getLength() - start < max_length) {
+        const ConstRRsetPtr rrset = getNextRRset();
+        if (!rrset) {
+            rrs_end_ = true;
+        } else {
+            count += renderer.render(*rrset);
+        }
+    }
+    return (count);
+}
+
+size_t
+ZoneIterator::renderNextRRsets(AbstractMessageRenderer& renderer,
+                               bool skip_soa)
+{
+    size_t count = 0;
+    while (true) {
+        if (!pending_rrset_) {
+            if (rrs_end_) {
+                break;
+            }
+            pending_rrset_ = getNextRRset();
+            if (!pending_rrset_) {
+                rrs_end_ = true;
+                break;
+            }
+            if (skip_soa && pending_rrset_->getType() == RRType::SOA()) {
+                pending_rrset_.reset();
+                continue;
+            }
+        }
+        const size_t pos = renderer.getLength();
+        const unsigned int rendered = pending_rrset_->toWire(renderer);
+        if (renderer.isTruncated()) {
+            renderer.trim(renderer.getLength() - pos);
+            break;
+        }
+        count += rendered;
+        pending_rrset_.reset();
+    }
+    return (count);
+}
+
+} // namespace datasrc
+} // namespace bundy
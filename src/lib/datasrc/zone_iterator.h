@@ -15,8 +15,11 @@
 #ifndef DATASRC_ZONE_ITERATOR_H
 #define DATASRC_ZONE_ITERATOR_H 1
 
+#include <dns/master_text_renderer.h>
 #include <dns/rrset.h>
 
+#include <util/buffer.h>
+
 #include <boost/noncopyable.hpp>
 
 #include <datasrc/zone.h>
@@ -35,6 +38,14 @@ namespace datasrc {
  * There's no way to start iterating from the beginning again or return.
  */
 class ZoneIterator : public boost::noncopyable {
+protected:
+    /**
+     * \brief Constructor
+     *
+     * The class is abstract, so this is only used by the descendants.
+     */
+    ZoneIterator() : rrs_end_(false) { }
+
 public:
     /**
      * \brief Destructor
@@ -61,6 +72,96 @@ public:
      */
     virtual bundy::dns::ConstRRsetPtr getNextRRset() = 0;
 
+    /**
+     * \brief Get next RRs of the zone in wire format.
+     *
+     * This appends the following RRs of the zone to the buffer, in the
+     * uncompressed wire format, until at least the given amount of data
+     * is added or the iteration gets to the end of the zone.  This is a
+     * bulk version of \c getNextRRset() for applications that only need
+     * the zone data in wire format (e.g. for zone transfers); it can be
+     * mixed with calls to \c getNextRRset(), and both continue the same
+     * iteration.
+     *
+     * The RRs of an RRset are not necessarily adjacent and may have
+     * different TTLs as stored in the data source, even if the iterator
+     * was created to combine them into RRsets.
+     *
+     * The default implementation renders the RRsets returned by
+     * \c getNextRRset() (with their RRSIGs, if any); derived classes are
+     * expected to override it if they can produce the wire data more
+     * efficiently.
+     *
+     * \param buffer The buffer to which the RRs are appended.
+     * \param max_length The length of data to be added, in bytes.  It's a
+     *     soft limit: the last RRset (for the default implementation) or RR
+     *     can make the total exceed it.
+     * \return The number of RRs added to the buffer.  0 means the end of
+     *     the zone.
+     */
+    virtual size_t getNextRRs(bundy::util::OutputBuffer& buffer,
+                              size_t max_length);
+
+    /**
+     * \brief Get next RRs of the zone in the master file format.
+     *
+     * This is the text version of \c getNextRRs(): it renders the following
+     * RRsets of the zone (with their RRSIGs, if any) into the renderer, in
+     * the format of \c AbstractRRset::toText(), until at least the given
+     * amount of text is added or the iteration gets to the end of the zone.
+     * It's meant for dumping large zones to files, where the renderer is
+     * much cheaper than building the text of each RRset.  It can be mixed
+     * with calls to \c getNextRRset() and \c getNextRRs(), and all of them
+     * continue the same iteration.
+     *
+     * The default implementation renders the RRsets returned by
+     * \c getNextRRset().
+     *
+     * \param renderer The renderer to which the text is appended.
+     * \param max_length The length of text to be added, in bytes.  It's a
+     *     soft limit: the last RRset can make the total exceed it.
+     * \return The number of RRs added to the renderer.  0 means the end of
+     *     the zone.
+     */
+    virtual size_t getNextRRsText(bundy::dns::MasterTextRenderer& renderer,
+                                  size_t max_length);
+
+    /**
+     * \brief Render next RRsets of the zone into a DNS message.
+     *
+     * This renders the following RRsets of the zone (with their RRSIGs,
+     * if any) into the renderer, as long as they fit in its length limit,
+     * so the names are compressed against everything already in the
+     * message, including the RRsets of previous calls for the same message.
+     * This is meant for zone transfers, where the caller fills each message
+     * with as many calls as needed.
+     *
+     * It returns when an RRset doesn't fit or at the end of the zone.  In
+     * the former case, the partially rendered RRset is removed and the
+     * renderer is marked as truncated; the caller should finish the message
+     * (it can't render anything else into it, as the compression table may
+     * refer to the removed data) and call this method again with a cleared
+     * renderer, which will start with that RRset.  An RRset that doesn't
+     * fit in an otherwise empty message makes the iteration stuck, which
+     * the caller is expected to detect.  The iteration at the end of the
+     * zone is indicated by returning without marking the renderer as
+     * truncated.
+     *
+     * Unlike \c getNextRRs(), this method shouldn't be mixed with
+     * \c getNextRRset(), as the RRset that didn't fit could be lost.
+     *
+     * The default implementation renders the RRsets returned by
+     * \c getNextRRset(); derived classes can override it if they can render
+     * their data directly.
+     *
+     * \param renderer The renderer of the message.
+     * \param skip_soa Whether to skip the SOA RRsets of the zone, which
+     *     zone transfers send on their own.
+     * \return The number of RRs rendered.
+     */
+    virtual size_t renderNextRRsets(bundy::dns::AbstractMessageRenderer&
+                                    renderer, bool skip_soa);
+
     /**
      * \brief Return the SOA record of the zone in the iterator context.
      *
@@ -94,6 +195,15 @@ public:
      * from the iteration.  It will be NULL if the zone doesn't have an SOA.
      */
     virtual bundy::dns::ConstRRsetPtr getSOA() const = 0;
+
+private:
+    // Whether the default getNextRRs() or getNextRRsText() got to the end
+    // of the zone.
+    bool rrs_end_;
+
+    // The RRset that didn't fit in the last call of the default
+    // renderNextRRsets(), if any.
+    bundy::dns::ConstRRsetPtr pending_rrset_;
 };
 
 }
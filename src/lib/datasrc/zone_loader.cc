@@ -27,23 +27,149 @@
 #include <dns/rrclass.h>
 #include <dns/rrset_collection_base.h>
 
+#include <util/threads/sync.h>
+#include <util/threads/thread.h>
+
 #include <boost/bind.hpp>
+#include <boost/noncopyable.hpp>
 
+#include <deque>
 #include <string>
+#include <vector>
 
 using bundy::dns::Name;
 using bundy::dns::ConstRRsetPtr;
 using bundy::dns::RRsetCollectionBase;
 using bundy::dns::MasterLoader;
 using bundy::dns::MasterLexer;
+using bundy::util::thread::CondVar;
+using bundy::util::thread::Mutex;
+using bundy::util::thread::Thread;
 
 namespace bundy {
 namespace datasrc {
 
 const double ZoneLoader::PROGRESS_UNKNOWN = -1;
 
+// The store stage of the pipelined mode.  The RRsets are passed to the
+// store thread in batches, to keep the locking overhead per RRset low; the
+// number of queued batches is limited so a fast reader doesn't accumulate
+// the whole zone in memory.
+class ZoneLoader::Pipeline : boost::noncopyable {
+public:
+    Pipeline(ZoneUpdater& updater) :
+        updater_(updater), stopping_(false), done_(false), failed_(false)
+    {
+        batch_.reserve(BATCH_SIZE);
+        thread_.reset(new Thread(boost::bind(&Pipeline::run, this)));
+    }
+
+    ~Pipeline() {
+        {
+            Mutex::Locker locker(mutex_);
+            stopping_ = true;
+            not_empty_.signal();
+        }
+        thread_->wait();
+    }
+
+    // Queue the RRset for the store thread.  If the store thread failed,
+    // its error is thrown here.
+    void add(const ConstRRsetPtr& rrset) {
+        batch_.push_back(rrset);
+        if (batch_.size() >= BATCH_SIZE) {
+            push();
+        }
+    }
+
+    // Wait for the store thread to store all queued RRsets.  If it failed,
+    // its error is thrown here.
+    void finish() {
+        push();
+        Mutex::Locker locker(mutex_);
+        done_ = true;
+        not_empty_.signal();
+        while (!queue_.empty() && !failed_) {
+            not_full_.wait(mutex_);
+        }
+        if (failed_) {
+            bundy_throw(DataSourceError, error_);
+        }
+    }
+
+private:
+    typedef std::vector<ConstRRsetPtr> Batch;
+
+    void push() {
+        if (batch_.empty()) {
+            return;
+        }
+        Mutex::Locker locker(mutex_);
+        while (queue_.size() >= MAX_QUEUED_BATCHES && !failed_) {
+            not_full_.wait(mutex_);
+        }
+        if (failed_) {
+            bundy_throw(DataSourceError, error_);
+        }
+        queue_.push_back(Batch());
+        queue_.back().swap(batch_);
+        batch_.reserve(BATCH_SIZE);
+        not_empty_.signal();
+    }
+
+    void run() {
+        Batch batch;
+        while (true) {
+            {
+                Mutex::Locker locker(mutex_);
+                // The batch stored in the previous round is only removed
+                // now, so finish() doesn't return before it's stored.
+                if (!batch.empty()) {
+                    queue_.pop_front();
+                    batch.clear();
+                    not_full_.signal();
+                }
+                while (queue_.empty() && !done_ && !stopping_) {
+                    not_empty_.wait(mutex_);
+                }
+                if (queue_.empty() || stopping_) {
+                    return;
+                }
+                batch.swap(queue_.front());
+            }
+            try {
+                for (Batch::const_iterator it = batch.begin();
+                     it != batch.end(); ++it) {
+                    updater_.addRRset(**it);
+                }
+            } catch (const std::exception& ex) {
+                Mutex::Locker locker(mutex_);
+                error_ = ex.what();
+                failed_ = true;
+                not_full_.signal();
+                return;
+            }
+        }
+    }
+
+    static const size_t BATCH_SIZE = 256;
+    static const size_t MAX_QUEUED_BATCHES = 16;
+
+    ZoneUpdater& updater_;
+    Batch batch_;               // only used by the reading thread
+    Mutex mutex_;
+    CondVar not_empty_;
+    CondVar not_full_;
+    std::deque<Batch> queue_;
+    bool stopping_;
+    bool done_;
+    bool failed_;
+    std::string error_;
+    boost::scoped_ptr<Thread> thread_;
+};
+
 ZoneLoader::ZoneLoader(DataSourceClient& destination, const Name& zone_name,
-                       DataSourceClient& source) :
+                       DataSourceClient& source, bool pipelined) :
     // Separate the RRsets as that is possibly faster (the data source doesn't
     // have to aggregate them) and also because our limit semantics.
     iterator_(source.getIterator(zone_name, true)),
@@ -67,25 +193,32 @@ ZoneLoader::ZoneLoader(DataSourceClient& destination, const Name& zone_name,
         bundy_throw(bundy::InvalidParameter,
                   "Source and destination class mismatch");
     }
+    if (pipelined) {
+        pipeline_.reset(new Pipeline(*updater_));
+    }
 }
 
-namespace {
 // Unified callback to install RR and increment RR count at the same time.
 void
-addRR(ZoneUpdater* updater, size_t* rr_count,
-      const dns::Name& name, const dns::RRClass& rrclass,
-      const dns::RRType& type, const dns::RRTTL& ttl,
-      const dns::rdata::RdataPtr& data)
+ZoneLoader::addRR(const dns::Name& name, const dns::RRClass& rrclass,
+                  const dns::RRType& type, const dns::RRTTL& ttl,
+                  const dns::rdata::RdataPtr& data)
 {
-    bundy::dns::BasicRRset rrset(name, rrclass, type, ttl);
-    rrset.addRdata(data);
-    updater->addRRset(rrset);
-    ++*rr_count;
-}
+    if (pipeline_) {
+        const dns::RRsetPtr rrset(new bundy::dns::BasicRRset(name, rrclass,
+                                                             type, ttl));
+        rrset->addRdata(data);
+        pipeline_->add(rrset);
+    } else {
+        bundy::dns::BasicRRset rrset(name, rrclass, type, ttl);
+        rrset.addRdata(data);
+        updater_->addRRset(rrset);
+    }
+    ++rr_count_;
 }
 
 ZoneLoader::ZoneLoader(DataSourceClient& destination, const Name& zone_name,
-                       const char* filename) :
+                       const char* filename, bool pipelined) :
     updater_(destination.getUpdater(zone_name, true, false)),
     complete_(false), loaded_ok_(true), rr_count_(0)
 {
@@ -101,34 +234,19 @@ ZoneLoader::ZoneLoader(DataSourceClient& destination, const Name& zone_name,
                                    createMasterLoaderCallbacks(zone_name,
                                        updater_->getFinder().getClass(),
                                        &loaded_ok_),
-                                   boost::bind(addRR,
-                                               updater_.get(), &rr_count_,
+                                   boost::bind(&ZoneLoader::addRR, this,
                                                _1, _2, _3, _4, _5)));
+        if (pipelined) {
+            pipeline_.reset(new Pipeline(*updater_));
+        }
     }
 }
 
-namespace {
-
-// Copy up to limit RRsets from source to destination
-bool
-copyRRsets(const ZoneUpdaterPtr& destination, const ZoneIteratorPtr& source,
-           size_t limit, size_t& rr_count_)
-{
-    size_t loaded = 0;
-    while (loaded < limit) {
-        const ConstRRsetPtr rrset(source->getNextRRset());
-        if (rrset == ConstRRsetPtr()) {
-            // Done loading, no more RRsets in the input.
-            return (true);
-        } else {
-            destination->addRRset(*rrset);
-        }
-        ++loaded;
-        rr_count_ += rrset->getRdataCount();
-    }
-    return (false); // Not yet, there may be more
+ZoneLoader::~ZoneLoader() {
 }
 
+namespace {
+
 void
 logWarning(const dns::Name* zone_name, const dns::RRClass* rrclass,
            const std::string& reason)
@@ -147,6 +265,26 @@ logError(const dns::Name* zone_name, const dns::RRClass* rrclass,
 
 } // end unnamed namespace
 
+// Copy up to limit RRsets from source to destination
+bool
+ZoneLoader::copyRRsets(size_t limit) {
+    size_t loaded = 0;
+    while (loaded < limit) {
+        const ConstRRsetPtr rrset(iterator_->getNextRRset());
+        if (rrset == ConstRRsetPtr()) {
+            // Done loading, no more RRsets in the input.
+            return (true);
+        } else if (pipeline_) {
+            pipeline_->add(rrset);
+        } else {
+            updater_->addRRset(*rrset);
+        }
+        ++loaded;
+        rr_count_ += rrset->getRdataCount();
+    }
+    return (false); // Not yet, there may be more
+}
+
 bool
 ZoneLoader::loadIncremental(size_t limit) {
     if (complete_) {
@@ -165,7 +303,20 @@ ZoneLoader::loadIncremental(size_t limit) {
             bundy_throw(MasterFileError, "Error while loading master file");
         }
     } else {
-        complete_ = copyRRsets(updater_, iterator_, limit, rr_count_);
+        complete_ = copyRRsets(limit);
+    }
+
+    if (complete_ && pipeline_) {
+        // Wait for all the RRsets to be stored before checking the zone.
+        // The store thread is done then, so it's stopped now; on error,
+        // the loader can't be used any more anyway.
+        try {
+            pipeline_->finish();
+        } catch (...) {
+            pipeline_.reset();
+            throw;
+        }
+        pipeline_.reset();
     }
 
     if (complete_) {
@@ -66,6 +66,17 @@ public:
 /// purpose of the class is only to hold the state for incremental loading.
 ///
 /// The old content of zone is discarded and no journal is stored.
+///
+/// In the pipelined mode, the RRsets are stored into the destination by a
+/// separate thread, while the calling thread keeps reading them from the
+/// master file or the source data source; the two are connected by a
+/// bounded queue.  The post-load check and the commit take place in the
+/// calling thread once the store thread has stored all RRsets.  As long as
+/// the destination data source allows its updater to be used from another
+/// thread than the one that created it (any data source that can be used
+/// by multiple threads does), this gives the same result, usually faster.
+/// The \c ZoneLoader object itself must still be used by one thread at a
+/// time; separate loaders can load different zones in parallel.
 class ZoneLoader {
 public:
     /// \brief Constructor from master file.
@@ -77,6 +88,7 @@ public:
     /// \param zone_name The origin of the zone. The class is implicit in the
     ///     destination.
     /// \param master_file Path to the master file to read data from.
+    /// \param pipelined Whether to store the RRsets in a separate thread.
     /// \throw DataSourceError in case the zone does not exist in destination.
     ///     This class does not support creating brand new zones, only loading
     ///     data into them. In case a new zone is needed, it must be created
@@ -84,7 +96,7 @@ public:
     /// \throw DataSourceError in case of other (possibly low-level) errors,
     ///     such as read-only data source or database error.
     ZoneLoader(DataSourceClient& destination, const bundy::dns::Name& zone_name,
-               const char* master_file);
+               const char* master_file, bool pipelined = false);
 
     /// \brief Constructor from another data source.
     ///
@@ -95,6 +107,7 @@ public:
     ///     go.
     /// \param zone_name The origin of the zone.
     /// \param source The data source from which the data would be read.
+    /// \param pipelined Whether to store the RRsets in a separate thread.
     /// \throw InvalidParameter in case the class of destination and source
     ///     differs.
     /// \throw NotImplemented in case the source data source client doesn't
@@ -107,7 +120,13 @@ public:
     /// \throw DataSourceError in case of other (possibly low-level) errors,
     ///     such as read-only data source or database error.
     ZoneLoader(DataSourceClient& destination, const bundy::dns::Name& zone_name,
-               DataSourceClient& source);
+               DataSourceClient& source, bool pipelined = false);
+
+    /// \brief Destructor.
+    ///
+    /// If the load hasn't completed, the store thread of the pipelined mode
+    /// is stopped and the data stored so far is discarded.
+    ~ZoneLoader();
 
     /// \brief Perform the whole load.
     ///
@@ -157,12 +176,17 @@ public:
     ///     call (which will load 0 RRs). This is because the end of iterator
     ///     or master file is detected when reading past the end, not when the
     ///     last one is read.
+    /// \note In the pipelined mode, the RRs may not have been stored yet
+    ///     when this returns false, and an error in storing some RRs may be
+    ///     thrown by a later call.
     bool loadIncremental(size_t limit);
 
     /// \brief Return the number of RRs loaded.
     ///
     /// This method returns the number of RRs loaded via this loader by the
-    /// time of the call.  Before starting the load it will return 0.
+    /// time of the call (in the pipelined mode, the number of RRs read; they
+    /// may not all have been stored yet).  Before starting the load it will
+    /// return 0.
     /// It will return the total number of RRs of the zone on and after
     /// completing the load.
     ///
@@ -215,6 +239,21 @@ public:
     static const double PROGRESS_UNKNOWN;
 
 private:
+    class Pipeline;
+
+    /// \brief The callback of the master loader; it stores the RR into
+    /// the destination, directly or through the pipeline.
+    void addRR(const bundy::dns::Name& name,
+               const bundy::dns::RRClass& rrclass,
+               const bundy::dns::RRType& type, const bundy::dns::RRTTL& ttl,
+               const bundy::dns::rdata::RdataPtr& data);
+
+    /// \brief Copy up to limit RRsets from the source iterator into the
+    /// destination, directly or through the pipeline.
+    ///
+    /// \return true if there are no more RRsets in the source.
+    bool copyRRsets(size_t limit);
+
     /// \brief The iterator used as source of data in case of the copy mode.
     const ZoneIteratorPtr iterator_;
     /// \brief The destination zone updater
@@ -226,6 +265,11 @@ private:
     /// \brief Was the loading successful?
     bool loaded_ok_;
     size_t rr_count_;
+    /// \brief The store stage of the pipelined mode (NULL otherwise)
+    ///
+    /// It's declared after updater_, so it's destroyed (and its thread
+    /// stopped) before the updater.
+    boost::scoped_ptr<Pipeline> pipeline_;
 };
 
 }
@@ -17,6 +17,8 @@
 
 #include <dns/name.h>
 
+#include <util/buffer.h>
+
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
 
@@ -200,6 +202,48 @@ public:
     /// \return A smart pointer to a newly created iterator object.  Once
     /// returned, the \c ZoneTableAccessor effectively releases its ownership.
     virtual IteratorPtr getIterator() const = 0;
+
+    /// \brief Get a page of the zone names of the table in wire format.
+    ///
+    /// This appends the origin names of up to \c max_count zones to the
+    /// buffer, in the uncompressed wire format, in the order of the
+    /// iterator.  With a non-NULL \c after, it starts with the zone that
+    /// follows \c after, so the application can go through a large table
+    /// page by page, passing the last name of each page to get the next
+    /// one.  Unlike the iterator, this doesn't create a \c ZoneSpec (and
+    /// a copy of the name) for each zone, and the application can reuse
+    /// the same buffer for all pages.
+    ///
+    /// The default implementation goes through the iterator from the
+    /// beginning, and \c after must be one of the zones; if it isn't (e.g.
+    /// it was removed since the last page), nothing is appended.  Derived
+    /// classes that keep the zones in order should override it to resume
+    /// directly after any name.
+    ///
+    /// \throw std::bad_alloc Memory allocation failed.
+    ///
+    /// \param buffer The buffer to which the names are appended.
+    /// \param max_count The maximum number of names to be appended.
+    /// \param after If non-NULL, the name of the zone preceding the page.
+    /// \return The number of names appended.  It's less than \c max_count
+    /// only at the end of the table.
+    virtual size_t getZoneNames(util::OutputBuffer& buffer, size_t max_count,
+                                const dns::Name* after = NULL) const
+    {
+        size_t count = 0;
+        bool found = (after == NULL);
+        for (IteratorPtr it = getIterator(); count < max_count && !it->isLast();
+             it->next()) {
+            const ZoneSpec spec = it->getCurrent();
+            if (found) {
+                spec.origin.toWire(buffer);
+                ++count;
+            } else {
+                found = (spec.origin == *after);
+            }
+        }
+        return (count);
+    }
 };
 
 typedef boost::shared_ptr<ZoneTableAccessor> ZoneTableAccessorPtr;
@@ -55,6 +55,21 @@ ZoneTableAccessorCache::getIterator() const {
                 new ZoneTableIteratorCache(config_)));
 }
 
+size_t
+ZoneTableAccessorCache::getZoneNames(util::OutputBuffer& buffer,
+                                     size_t max_count,
+                                     const dns::Name* after) const
+{
+    size_t count = 0;
+    for (CacheConfig::ConstZoneIterator it =
+             (after == NULL ? config_.begin() : config_.upperBound(*after));
+         count < max_count && it != config_.end(); ++it) {
+        it->first.toWire(buffer);
+        ++count;
+    }
+    return (count);
+}
+
 }
 }
 }
@@ -61,6 +61,16 @@ public:
     /// \throw None except std::bad_alloc in case of memory allocation failure
     virtual IteratorPtr getIterator() const;
 
+    /// \brief In-memory cache version of \c getZoneNames().
+    ///
+    /// The names are in the DNSSEC order, the order of the iterator, and
+    /// \c after doesn't have to be in the table.  The names are rendered
+    /// from the configuration directly.
+    ///
+    /// \throw None except std::bad_alloc in case of memory allocation failure
+    virtual size_t getZoneNames(util::OutputBuffer& buffer, size_t max_count,
+                                const dns::Name* after = NULL) const;
+
 private:
     const CacheConfig& config_;
 };
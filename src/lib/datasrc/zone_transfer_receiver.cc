@@ -0,0 +1,292 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+#include <datasrc/zone_transfer_receiver.h>
+#include <datasrc/zone.h>
+
+#include <dns/rdataclass.h>
+#include <dns/rrset.h>
+#include <dns/rrtype.h>
+#include <dns/tsig.h>
+#include <dns/tsigerror.h>
+
+#include <util/buffer.h>
+#include <util/threads/sync.h>
+#include <util/threads/thread.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+
+using namespace bundy::dns;
+using namespace bundy::dns::rdata;
+using bundy::util::InputBuffer;
+using bundy::util::thread::CondVar;
+using bundy::util::thread::Mutex;
+using bundy::util::thread::Thread;
+
+namespace bundy {
+namespace datasrc {
+
+const size_t ZoneTransferReceiver::MAX_QUEUED_MESSAGES;
+
+namespace {
+// Reader of length-prefixed DNS messages from a TCP socket, running in a
+// separate thread.  The destructor stops the thread, which may be blocked
+// on the socket; a pipe is used to wake it up.
+class MessageReader : boost::noncopyable {
+public:
+    MessageReader(int fd, int timeout) :
+        fd_(fd), timeout_(timeout), stopping_(false), done_(false)
+    {
+        if (pipe(wakeup_fds_) != 0) {
+            bundy_throw(ZoneTransferError, "Failed to create a pipe: " <<
+                        std::strerror(errno));
+        }
+        try {
+            thread_.reset(new Thread(boost::bind(&MessageReader::run,
+                                                 this)));
+        } catch (...) {
+            close(wakeup_fds_[0]);
+            close(wakeup_fds_[1]);
+            throw;
+        }
+    }
+
+    ~MessageReader() {
+        {
+            Mutex::Locker locker(mutex_);
+            stopping_ = true;
+            not_full_.signal();
+        }
+        const char c = 0;
+        while (write(wakeup_fds_[1], &c, 1) < 0 && errno == EINTR) {
+            ;
+        }
+        thread_->wait();
+        close(wakeup_fds_[0]);
+        close(wakeup_fds_[1]);
+    }
+
+    // Get the next message, waiting for it if necessary.  The content of
+    // data is replaced with that of the message.
+    void getNext(std::vector<uint8_t>& data) {
+        Mutex::Locker locker(mutex_);
+        while (queue_.empty() && !done_) {
+            not_empty_.wait(mutex_);
+        }
+        if (queue_.empty()) {
+            bundy_throw(ZoneTransferError, error_);
+        }
+        data.swap(queue_.front());
+        queue_.pop_front();
+        not_full_.signal();
+    }
+
+private:
+    void run() {
+        try {
+            while (true) {
+                uint8_t len_buf[2];
+                if (!readData(len_buf, sizeof(len_buf))) {
+                    return;
+                }
+                std::vector<uint8_t> data((len_buf[0] << 8) | len_buf[1]);
+                if (!data.empty() && !readData(&data[0], data.size())) {
+                    return;
+                }
+
+                Mutex::Locker locker(mutex_);
+                while (queue_.size() >=
+                       ZoneTransferReceiver::MAX_QUEUED_MESSAGES &&
+                       !stopping_) {
+                    not_full_.wait(mutex_);
+                }
+                if (stopping_) {
+                    return;
+                }
+                queue_.push_back(std::vector<uint8_t>());
+                queue_.back().swap(data);
+                not_empty_.signal();
+            }
+        } catch (const std::exception& ex) {
+            Mutex::Locker locker(mutex_);
+            error_ = ex.what();
+            done_ = true;
+            not_empty_.signal();
+        }
+    }
+
+    // Read exactly len bytes.  Returns false if stopped in the middle.
+    bool readData(uint8_t* buf, size_t len) {
+        while (len > 0) {
+            struct pollfd fds[2] = {
+                { fd_, POLLIN, 0 },
+                { wakeup_fds_[0], POLLIN, 0 }
+            };
+            const int n = poll(fds, 2, timeout_);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                bundy_throw(ZoneTransferError, "poll failed in zone transfer: "
+                            << std::strerror(errno));
+            } else if (n == 0) {
+                bundy_throw(ZoneTransferError, "zone transfer timed out");
+            } else if (fds[1].revents != 0) {
+                return (false);
+            }
+            const ssize_t cc = read(fd_, buf, len);
+            if (cc < 0) {
+                if (errno == EINTR || errno == EAGAIN ||
+                    errno == EWOULDBLOCK) {
+                    continue;
+                }
+                bundy_throw(ZoneTransferError, "Read failed in zone "
+                            "transfer: " << std::strerror(errno));
+            } else if (cc == 0) {
+                bundy_throw(ZoneTransferError, "Connection closed in zone "
+                            "transfer");
+            }
+            buf += cc;
+            len -= cc;
+        }
+        return (true);
+    }
+
+    const int fd_;
+    const int timeout_;
+    int wakeup_fds_[2];
+    Mutex mutex_;
+    CondVar not_empty_;
+    CondVar not_full_;
+    std::deque<std::vector<uint8_t> > queue_;
+    bool stopping_;
+    bool done_;
+    std::string error_;
+    boost::scoped_ptr<Thread> thread_;
+};
+
+uint32_t
+getSOASerial(const AbstractRRset& rrset) {
+    return (dynamic_cast<const generic::SOA&>(
+                rrset.getRdataIterator()->getCurrent()).getSerial().
+            getValue());
+}
+}
+
+ZoneTransferReceiver::ZoneTransferReceiver(int fd, qid_t qid,
+                                           TSIGContext* tsig_ctx,
+                                           int timeout) :
+    fd_(fd), qid_(qid), tsig_ctx_(tsig_ctx), timeout_(timeout),
+    message_count_(0), rr_count_(0), byte_count_(0), begin_serial_(0),
+    end_serial_(0)
+{}
+
+bool
+ZoneTransferReceiver::receiveAXFR(ZoneUpdater& updater) {
+    MessageReader reader(fd_, timeout_);
+    std::vector<uint8_t> data;
+    bool initial = true;
+    bool ended = false;
+    while (!ended) {
+        if (message_count_ > 0 && cancel_callback_ && cancel_callback_()) {
+            return (false);
+        }
+        reader.getNext(data);
+        ++message_count_;
+        byte_count_ += data.size() + 2;
+        if (data.empty()) {
+            bundy_throw(ZoneTransferError, "Empty message in zone transfer");
+        }
+
+        Message message(Message::PARSE);
+        InputBuffer buffer(&data[0], data.size());
+        message.fromWire(buffer, Message::PRESERVE_ORDER);
+        checkMessage(message, &data[0], data.size());
+
+        for (RRsetIterator it = message.beginSection(Message::SECTION_ANSWER);
+             it != message.endSection(Message::SECTION_ANSWER);
+             ++it) {
+            const AbstractRRset& rrset = **it;
+            if (ended) {
+                bundy_throw(ZoneTransferError, "Extra data after the end of "
+                            "AXFR: " << rrset.getName() << "/" <<
+                            rrset.getType());
+            }
+            const bool is_soa = (rrset.getType() == RRType::SOA());
+            if (initial) {
+                if (!is_soa) {
+                    bundy_throw(ZoneTransferError, "First RR in zone transfer "
+                                "must be SOA (" << rrset.getType() <<
+                                " received)");
+                }
+                begin_serial_ = getSOASerial(rrset);
+                initial = false;
+                continue;
+            }
+            updater.addRRset(rrset);
+            ++rr_count_;
+            if (is_soa) {
+                end_serial_ = getSOASerial(rrset);
+                ended = true;
+            }
+        }
+    }
+    if (tsig_ctx_ != NULL && !tsig_ctx_->lastHadSignature()) {
+        bundy_throw(ZoneTransferError, "TSIG verify fail: no TSIG on last "
+                    "message");
+    }
+    return (true);
+}
+
+void
+ZoneTransferReceiver::checkMessage(const Message& message,
+                                   const uint8_t* data, size_t len)
+{
+    const TSIGRecord* tsig = message.getTSIGRecord();
+    if (tsig_ctx_ != NULL) {
+        const TSIGError error = tsig_ctx_->verify(tsig, data, len);
+        if (error != TSIGError::NOERROR()) {
+            bundy_throw(ZoneTransferError, "TSIG verify fail: " << error);
+        }
+    } else if (tsig != NULL) {
+        // See the xfrin implementation about why this is an error.
+        bundy_throw(ZoneTransferError, "Unexpected TSIG in response");
+    }
+
+    if (message.getRcode() != Rcode::NOERROR()) {
+        bundy_throw(ZoneTransferError, "error response: " <<
+                    message.getRcode());
+    }
+    if (!message.getHeaderFlag(Message::HEADERFLAG_QR)) {
+        bundy_throw(ZoneTransferError, "response is not a response");
+    }
+    if (message.getQid() != qid_) {
+        bundy_throw(ZoneTransferError, "bad query id");
+    }
+    if (message.getRRCount(Message::SECTION_QUESTION) > 1) {
+        bundy_throw(ZoneTransferError, "query section count greater than 1");
+    }
+}
+
+} // namespace datasrc
+} // namespace bundy
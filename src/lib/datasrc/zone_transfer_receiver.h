@@ -0,0 +1,136 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+#ifndef DATASRC_ZONE_TRANSFER_RECEIVER_H
+#define DATASRC_ZONE_TRANSFER_RECEIVER_H 1
+
+#include <datasrc/exceptions.h>
+
+#include <dns/message.h>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace dns {
+class TSIGContext;
+}
+
+namespace datasrc {
+
+class ZoneUpdater;
+
+/// \brief Receiver of AXFR responses over TCP.
+///
+/// This class reads the response messages of an AXFR request from a
+/// connected TCP socket, verifies them (including TSIG, if the request
+/// was signed), and adds the received RRs to a \c ZoneUpdater.  This is
+/// the counterpart of \c ZoneTransferSender and is intended to do the time
+/// consuming part of an "xfrin" application, which sends the request and
+/// validates and commits the updater by itself.
+///
+/// The messages are read from the socket in a separate thread and queued
+/// (up to \c MAX_QUEUED_MESSAGES messages), so receiving the data from
+/// the network overlaps parsing the messages and writing the RRs to the
+/// data source.
+///
+/// Only AXFR (or an IXFR request known to be answered in the AXFR style)
+/// is supported; the sequence of RRs is expected to begin with a SOA and
+/// end with the next SOA, which are checked in the same way as the xfrin
+/// Python implementation: the first SOA isn't added to the updater, and the
+/// last one is.  The RRs are added to the updater one by one as received,
+/// without combining them into RRsets.
+class ZoneTransferReceiver : boost::noncopyable {
+public:
+    /// \brief The maximum number of messages read but not yet processed.
+    static const size_t MAX_QUEUED_MESSAGES = 16;
+
+    /// \brief Callback to check if the transfer should be stopped.
+    ///
+    /// It's called before each message other than the first one is
+    /// processed, and the transfer stops if it returns true.
+    typedef boost::function<bool()> CancelCallback;
+
+    /// \brief Constructor.
+    ///
+    /// \param fd The socket from which the messages are read.
+    /// \param qid The ID of the request.
+    /// \param tsig_ctx If non NULL, the TSIG context used to sign the request,
+    ///     with which each message is verified.  It must be valid as long
+    ///     as the receiver is used.
+    /// \param timeout The time in milliseconds to wait for data on the
+    ///     socket before giving up (negative for infinity).
+    ZoneTransferReceiver(int fd, dns::qid_t qid, dns::TSIGContext* tsig_ctx,
+                         int timeout);
+
+    /// \brief Set the callback to check cancellation of the transfer.
+    void setCancelCallback(const CancelCallback& callback) {
+        cancel_callback_ = callback;
+    }
+
+    /// \brief Receive an AXFR response.
+    ///
+    /// The received RRs are added to the updater, which isn't committed
+    /// in this method.
+    ///
+    /// \throw ZoneTransferError The response can't be read from the socket,
+    ///     or it's broken or invalid (including TSIG errors).
+    /// \throw DataSourceError (and others) from the updater.
+    ///
+    /// \param updater The updater to which the RRs are added.
+    /// \return true if the transfer has completed; false if it was
+    ///     cancelled.
+    bool receiveAXFR(ZoneUpdater& updater);
+
+    /// \brief Return the number of messages processed so far.
+    size_t getMessageCount() const { return (message_count_); }
+
+    /// \brief Return the number of RRs added so far.
+    size_t getRRCount() const { return (rr_count_); }
+
+    /// \brief Return the number of bytes (including the length fields)
+    /// processed so far.
+    size_t getByteCount() const { return (byte_count_); }
+
+    /// \brief Return the serial of the first SOA (0 if not yet received).
+    uint32_t getBeginSerial() const { return (begin_serial_); }
+
+    /// \brief Return the serial of the last SOA (0 if not yet received).
+    uint32_t getEndSerial() const { return (end_serial_); }
+
+private:
+    void checkMessage(const dns::Message& message, const uint8_t* data,
+                      size_t len);
+
+    const int fd_;
+    const dns::qid_t qid_;
+    dns::TSIGContext* const tsig_ctx_;
+    const int timeout_;
+    CancelCallback cancel_callback_;
+    size_t message_count_;
+    size_t rr_count_;
+    size_t byte_count_;
+    uint32_t begin_serial_;
+    uint32_t end_serial_;
+};
+
+} // namespace datasrc
+} // namespace bundy
+
+#endif // DATASRC_ZONE_TRANSFER_RECEIVER_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -0,0 +1,224 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+#include <config.h>
+
+#include <datasrc/zone_transfer_sender.h>
+#include <datasrc/zone_iterator.h>
+
+#include <dns/tsig.h>
+
+#include <boost/bind.hpp>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <cerrno>
+#include <cstring>
+
+using namespace bundy::dns;
+
+namespace bundy {
+namespace datasrc {
+
+namespace {
+const size_t HEADERLEN = 12;
+const uint16_t RESPONSE_FLAGS = Message::HEADERFLAG_QR |
+    Message::HEADERFLAG_AA;
+}
+
+const size_t ZoneTransferSender::MAX_MESSAGE_SIZE;
+
+ZoneTransferSender::ZoneTransferSender(int fd, qid_t qid, uint16_t flags,
+                                       const Question& question,
+                                       TSIGContext* tsig_ctx) :
+    fd_(fd), qid_(qid), flags_(flags | RESPONSE_FLAGS), question_(question),
+    tsig_ctx_(tsig_ctx), qdcount_(0), ancount_(0), message_count_(0)
+{}
+
+bool
+ZoneTransferSender::sendZone(ZoneIterator& iterator, const AbstractRRset& soa)
+{
+    startMessage();
+    if (!addRRset(soa)) {
+        return (false);
+    }
+    // The iterator fills the message as long as its RRsets fit.
+    while (true) {
+        ancount_ += iterator.renderNextRRsets(renderer_, true);
+        if (!renderer_.isTruncated()) {
+            break;
+        }
+        if (ancount_ == 0) {
+            bundy_throw(ZoneTransferError, "RRset too large for zone "
+                        "transfer of " << soa.getName());
+        }
+        sendMessage();
+        if (cancel_callback_ && cancel_callback_()) {
+            return (false);
+        }
+        startMessage();
+    }
+    if (!addRRset(soa)) {
+        return (false);
+    }
+    sendMessage();
+    return (true);
+}
+
+bool
+ZoneTransferSender::sendDiffs(ZoneJournalReader& reader,
+                              const AbstractRRset& soa)
+{
+    return (send(soa, boost::bind(&ZoneJournalReader::getNextDiff, &reader)));
+}
+
+void
+ZoneTransferSender::sendSOA(const AbstractRRset& soa) {
+    startMessage();
+    addRRset(soa);
+    sendMessage();
+}
+
+bool
+ZoneTransferSender::send(const AbstractRRset& soa, const RRsetSource& source)
+{
+    startMessage();
+    if (!addRRset(soa)) {
+        return (false);
+    }
+    ConstRRsetPtr rrset;
+    while ((rrset = source())) {
+        if (!addRRset(*rrset)) {
+            return (false);
+        }
+    }
+    if (!addRRset(soa)) {
+        return (false);
+    }
+    sendMessage();
+    return (true);
+}
+
+void
+ZoneTransferSender::startMessage() {
+    renderer_.clear();
+    renderer_.setCompressMode(MessageRenderer::CASE_SENSITIVE);
+    // Reserve the space for the TSIG RR, like Message::toWire().
+    const size_t tsig_len = (tsig_ctx_ != NULL) ?
+        tsig_ctx_->getTSIGLength() : 0;
+    renderer_.setLengthLimit(MAX_MESSAGE_SIZE - tsig_len);
+    renderer_.skip(HEADERLEN);
+    qdcount_ = 0;
+    if (message_count_ == 0) {
+        question_.toWire(renderer_);
+        qdcount_ = 1;
+    }
+    ancount_ = 0;
+}
+
+bool
+ZoneTransferSender::addRRset(const AbstractRRset& rrset) {
+    size_t pos = renderer_.getLength();
+    unsigned int count = rrset.toWire(renderer_);
+    if (renderer_.isTruncated()) {
+        // Remove the partially rendered RRset, and send the message so far
+        // unless it's empty.  The RRset must then fit in the next one.
+        renderer_.trim(renderer_.getLength() - pos);
+        if (ancount_ == 0) {
+            bundy_throw(ZoneTransferError, "RRset too large for zone "
+                        "transfer: " << rrset.getName() << "/" <<
+                        rrset.getType());
+        }
+        sendMessage();
+        if (cancel_callback_ && cancel_callback_()) {
+            return (false);
+        }
+        startMessage();
+        pos = renderer_.getLength();
+        count = rrset.toWire(renderer_);
+        if (renderer_.isTruncated()) {
+            bundy_throw(ZoneTransferError, "RRset too large for zone "
+                        "transfer: " << rrset.getName() << "/" <<
+                        rrset.getType());
+        }
+    }
+    ancount_ += count;
+    return (true);
+}
+
+void
+ZoneTransferSender::sendMessage() {
+    // Header: ID, flags (QUERY/NOERROR are 0), and the counts.
+    renderer_.writeUint16At(qid_, 0);
+    renderer_.writeUint16At(flags_, 2);
+    renderer_.writeUint16At(qdcount_, 4);
+    renderer_.writeUint16At(ancount_, 6);
+    renderer_.writeUint16At(0, 8);
+    renderer_.writeUint16At(0, 10);
+
+    if (tsig_ctx_ != NULL) {
+        // The TSIG RR is rendered separately, as the compression table of
+        // renderer_ may refer to a trimmed RRset.
+        tsig_renderer_.clear();
+        if (tsig_ctx_->sign(qid_, renderer_.getData(),
+                            renderer_.getLength())->toWire(tsig_renderer_)
+            != 1) {
+            bundy_throw(ZoneTransferError, "Failed to render a TSIG RR");
+        }
+        renderer_.setLengthLimit(MAX_MESSAGE_SIZE);
+        renderer_.writeData(tsig_renderer_.getData(),
+                            tsig_renderer_.getLength());
+        renderer_.writeUint16At(1, 10);
+    }
+
+    write(renderer_.getData(), renderer_.getLength());
+    ++message_count_;
+}
+
+void
+ZoneTransferSender::write(const void* data, size_t len) {
+    uint8_t len_buf[2] = { static_cast<uint8_t>(len >> 8),
+                           static_cast<uint8_t>(len & 0xff) };
+    struct iovec iov[2] = {
+        { len_buf, sizeof(len_buf) },
+        { const_cast<void*>(data), len }
+    };
+    struct iovec* iovp = iov;
+    int iovcnt = 2;
+    while (iovcnt > 0) {
+        const ssize_t cc = writev(fd_, iovp, iovcnt);
+        if (cc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            bundy_throw(ZoneTransferError, "Write failed in zone transfer: "
+                        << std::strerror(errno));
+        }
+        // Skip what has been written; it can be partial for a blocking
+        // socket if interrupted by a signal.
+        size_t written = cc;
+        while (iovcnt > 0 && written >= iovp->iov_len) {
+            written -= iovp->iov_len;
+            ++iovp;
+            --iovcnt;
+        }
+        if (iovcnt > 0) {
+            iovp->iov_base = static_cast<uint8_t*>(iovp->iov_base) + written;
+            iovp->iov_len -= written;
+        }
+    }
+}
+
+} // namespace datasrc
+} // namespace bundy
@@ -0,0 +1,154 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+#ifndef DATASRC_ZONE_TRANSFER_SENDER_H
+#define DATASRC_ZONE_TRANSFER_SENDER_H 1
+
+#include <datasrc/exceptions.h>
+#include <datasrc/zone.h>
+
+#include <dns/message.h>
+#include <dns/messagerenderer.h>
+#include <dns/question.h>
+#include <dns/rrset.h>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace dns {
+class TSIGContext;
+}
+
+namespace datasrc {
+
+class ZoneIterator;
+
+/// \brief Sender of AXFR and IXFR responses over TCP.
+///
+/// This class renders the RRsets from a zone iterator or journal reader
+/// into a sequence of DNS messages and writes them to a connected TCP
+/// socket, each preceded by the 2-byte length field.  Each message is
+/// filled with as many RRs as fit within the 64KB limit (taking into
+/// account the TSIG RR, if the messages are to be signed), and names are
+/// compressed in the case-preserving mode as described in RFC5936
+/// Section 3.4.  The socket is expected to be in the blocking mode.
+///
+/// Only the first message contains the question section.  All messages
+/// have the given ID and header flags, the QUERY opcode and NOERROR
+/// Rcode; the QR and AA bits are always set.
+///
+/// This is intended to do the time consuming part of an "xfrout"
+/// application, which handles the request and decides on the source of
+/// the data (and possibly on errors) by itself.
+class ZoneTransferSender : boost::noncopyable {
+public:
+    /// \brief The maximum size of a DNS message over TCP.
+    static const size_t MAX_MESSAGE_SIZE = 65535;
+
+    /// \brief Callback to check if the transfer should be stopped.
+    ///
+    /// It's called before each message is sent, and the transfer stops
+    /// if it returns true.
+    typedef boost::function<bool()> CancelCallback;
+
+    /// \brief Constructor.
+    ///
+    /// \param fd The socket to which the messages are written.
+    /// \param qid The ID of the request.
+    /// \param flags The header flags of the messages (see
+    ///     \c Message::HeaderFlag).
+    /// \param question The question of the request.
+    /// \param tsig_ctx If non NULL, the TSIG context to sign each message
+    ///     with.  It must be valid as long as the sender is used.
+    ZoneTransferSender(int fd, dns::qid_t qid, uint16_t flags,
+                       const dns::Question& question,
+                       dns::TSIGContext* tsig_ctx);
+
+    /// \brief Set the callback to check cancellation of the transfer.
+    void setCancelCallback(const CancelCallback& callback) {
+        cancel_callback_ = callback;
+    }
+
+    /// \brief Send a whole zone (AXFR or AXFR-style IXFR).
+    ///
+    /// The messages contain the given SOA, all RRsets from the iterator
+    /// except SOA, and the SOA again.
+    ///
+    /// \throw ZoneTransferError The response can't be rendered or sent.
+    ///
+    /// \param iterator The iterator of the zone.
+    /// \param soa The SOA of the zone.
+    /// \return true if everything is sent; false if the transfer was
+    ///     cancelled.
+    bool sendZone(ZoneIterator& iterator, const dns::AbstractRRset& soa);
+
+    /// \brief Send zone differences (IXFR).
+    ///
+    /// The messages contain the given SOA, all RRsets (including SOAs)
+    /// from the reader, and the SOA again.
+    ///
+    /// \throw ZoneTransferError The response can't be rendered or sent.
+    ///
+    /// \param reader The journal reader of the differences.
+    /// \param soa The current SOA of the zone.
+    /// \return true if everything is sent; false if the transfer was
+    ///     cancelled.
+    bool sendDiffs(ZoneJournalReader& reader, const dns::AbstractRRset& soa);
+
+    /// \brief Send a single message only containing the SOA.
+    ///
+    /// This is a response to an IXFR request for the current version or
+    /// a newer one.
+    ///
+    /// \throw ZoneTransferError The response can't be rendered or sent.
+    void sendSOA(const dns::AbstractRRset& soa);
+
+    /// \brief Return the number of messages sent so far.
+    size_t getMessageCount() const { return (message_count_); }
+
+private:
+    // The source of RRsets other than the first and last SOAs.
+    typedef boost::function<dns::ConstRRsetPtr()> RRsetSource;
+
+    bool send(const dns::AbstractRRset& soa, const RRsetSource& source);
+    void startMessage();
+    // Add the RRset to the current message, sending it and starting a new
+    // one if it doesn't fit.  Returns false if cancelled.
+    bool addRRset(const dns::AbstractRRset& rrset);
+    void sendMessage();
+    void write(const void* data, size_t len);
+
+    const int fd_;
+    const dns::qid_t qid_;
+    const uint16_t flags_;
+    const dns::Question question_;
+    dns::TSIGContext* const tsig_ctx_;
+    CancelCallback cancel_callback_;
+    dns::MessageRenderer renderer_;
+    dns::MessageRenderer tsig_renderer_;
+    uint16_t qdcount_;
+    uint16_t ancount_;
+    size_t message_count_;
+};
+
+} // namespace datasrc
+} // namespace bundy
+
+#endif // DATASRC_ZONE_TRANSFER_SENDER_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -0,0 +1,107 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <dhcp/classify.h>
+
+#include <boost/unordered_map.hpp>
+
+namespace {
+
+using bundy::dhcp::ClientClass;
+using bundy::dhcp::ClientClasses;
+
+/// @brief Type of the table of the interned class names and their ids.
+typedef boost::unordered_map<ClientClass, size_t> InternTable;
+
+/// @brief Returns the table of the interned class names.
+///
+/// It's created on first use so that classes can be interned by
+/// constructors of static objects.
+InternTable&
+getInternTable() {
+    static InternTable table;
+    return (table);
+}
+
+/// @brief Returns the id of an interned class name.
+///
+/// @return The id, or ClientClasses::MAX_INTERNED if the name isn't interned.
+size_t
+getInternedId(const ClientClass& x) {
+    const InternTable& table = getInternTable();
+    const InternTable::const_iterator it = table.find(x);
+    return (it != table.end() ? it->second : ClientClasses::MAX_INTERNED);
+}
+
+}
+
+namespace bundy {
+namespace dhcp {
+
+const size_t ClientClasses::MAX_INTERNED;
+
+void
+ClientClasses::intern(const ClientClass& x) {
+    InternTable& table = getInternTable();
+    if (table.size() < MAX_INTERNED && table.find(x) == table.end()) {
+        const size_t id = table.size();
+        table[x] = id;
+    }
+}
+
+void
+ClientClasses::insert(const ClientClass& x) {
+    const size_t id = getInternedId(x);
+    if (id < MAX_INTERNED) {
+        interned_.set(id);
+    } else {
+        others_.insert(x);
+    }
+}
+
+bool
+ClientClasses::contains(const ClientClass& x) const {
+    const size_t id = getInternedId(x);
+    if (id < MAX_INTERNED && interned_.test(id)) {
+        return (true);
+    }
+    // The class may have been added before it was interned.
+    return (!others_.empty() && others_.find(x) != others_.end());
+}
+
+bool
+ClientClasses::intersects(const ClientClasses& other) const {
+    if ((interned_ & other.interned_).any()) {
+        return (true);
+    }
+    // Classes that weren't interned when they were added are compared by
+    // names.  Normally there are none of them in at least one of the
+    // containers.
+    for (std::set<ClientClass>::const_iterator it = others_.begin();
+         it != others_.end(); ++it) {
+        if (other.contains(*it)) {
+            return (true);
+        }
+    }
+    for (std::set<ClientClass>::const_iterator it = other.others_.begin();
+         it != other.others_.end(); ++it) {
+        if (contains(*it)) {
+            return (true);
+        }
+    }
+    return (false);
+}
+
+} // end of namespace bundy::dhcp
+} // end of namespace bundy
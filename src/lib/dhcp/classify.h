@@ -17,6 +17,7 @@
 #ifndef CLASSIFY_H
 #define CLASSIFY_H
 
+#include <bitset>
 #include <set>
 #include <string>
 
@@ -49,18 +50,75 @@ namespace dhcp {
     /// class names. It is expected to grow in complexity once support for
     /// client classes becomes more feature rich.
     ///
-    /// Note: This class is derived from std::set which may not have Doxygen
-    /// documentation. See  http://www.cplusplus.com/reference/set/set/.
-    class ClientClasses : public std::set<ClientClass> {
+    /// Class names used in the configuration (e.g. the classes a subnet is
+    /// restricted to) are interned by @ref intern into small integer
+    /// identifiers. Such classes are stored as bits of a fixed-width bitset,
+    /// so that checking whether a client belongs to any of the classes a
+    /// subnet allows is a single AND operation (see @ref intersects). Any
+    /// other class names, e.g. vendor class names sent by clients, are not
+    /// interned (we don't want clients to be able to fill the table) and are
+    /// stored as strings.
+    class ClientClasses {
     public:
+        /// @brief Maximum number of class names that can be interned.
+        ///
+        /// Class names interned beyond this limit are stored as strings,
+        /// which is still correct but slower.
+        static const size_t MAX_INTERNED = 256;
+
+        /// @brief Interns a class name.
+        ///
+        /// Assigns an identifier to the class name unless it already has
+        /// one. It's expected to be called when parsing the configuration,
+        /// for any class name that the server checks packets against.
+        /// The identifiers are never released, so it must not be called
+        /// for names coming from received packets.
+        ///
+        /// This is not thread safe; the DHCP servers are single threaded.
+        ///
+        /// @param x client class to be interned
+        static void intern(const ClientClass& x);
+
+        /// @brief Adds a class to the container.
+        ///
+        /// @param x client class to be added
+        void insert(const ClientClass& x);
+
         /// @brief returns if class x belongs to the defined classes
         ///
         /// @param x client class to be checked
         /// @return true if x belongs to the classes
-        bool
-        contains(const ClientClass& x) const {
-            return (find(x) != end());
+        bool contains(const ClientClass& x) const;
+
+        /// @brief Checks if this and the other container have a class in
+        /// common.
+        ///
+        /// @param other container to be checked against this one
+        /// @return true if at least one class belongs to both containers
+        bool intersects(const ClientClasses& other) const;
+
+        /// @brief Checks if the container is empty.
+        bool empty() const {
+            return (interned_.none() && others_.empty());
+        }
+
+        /// @brief Returns the number of classes in the container.
+        size_t size() const {
+            return (interned_.count() + others_.size());
         }
+
+        /// @brief Removes all classes from the container.
+        void clear() {
+            interned_.reset();
+            others_.clear();
+        }
+
+    private:
+        /// @brief Bits of the interned classes in the container.
+        std::bitset<MAX_INTERNED> interned_;
+
+        /// @brief Classes that were not interned when added.
+        std::set<ClientClass> others_;
     };
 
 };
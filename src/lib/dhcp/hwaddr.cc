@@ -15,15 +15,29 @@
 #include <dhcp/hwaddr.h>
 #include <dhcp/dhcp4.h>
 #include <exceptions/exceptions.h>
-#include <util/encode/hex.h>
-#include <boost/algorithm/string/classification.hpp>
-#include <boost/algorithm/string/constants.hpp>
-#include <boost/algorithm/string/split.hpp>
 #include <iomanip>
 #include <sstream>
 #include <vector>
 #include <string.h>
 
+namespace {
+
+/// @brief Returns the value of the hexadecimal digit or -1 if the character
+/// is not a hexadecimal digit.
+int
+hexDigitValue(const char c) {
+    if ((c >= '0') && (c <= '9')) {
+        return (c - '0');
+    } else if ((c >= 'a') && (c <= 'f')) {
+        return (c - 'a' + 10);
+    } else if ((c >= 'A') && (c <= 'F')) {
+        return (c - 'A' + 10);
+    }
+    return (-1);
+}
+
+}
+
 namespace bundy {
 namespace dhcp {
 
@@ -66,36 +80,48 @@ std::string HWAddr::toText(bool include_htype) const {
 
 HWAddr
 HWAddr::fromText(const std::string& text, const uint8_t htype) {
-    /// @todo optimize stream operations here.
-    std::vector<std::string> split_text;
-    boost::split(split_text, text, boost::is_any_of(":"),
-                 boost::algorithm::token_compress_off);
-
-    std::ostringstream s;
-    for (size_t i = 0; i < split_text.size(); ++i) {
-        // If there are multiple tokens and the current one is empty, it
-        // means that two consecutive colons were specified. This is not
-        // allowed for hardware address.
-        if ((split_text.size() > 1) && split_text[i].empty()) {
-            bundy_throw(bundy::BadValue, "failed to create hardware address"
-                      " from text '" << text << "': tokens of the hardware"
-                      " address must be separated with a single colon");
-
-        } else  if (split_text[i].size() == 1) {
-            s << "0";
-
-        } else if (split_text[i].size() > 2) {
+    // Decode the bytes in place rather than splitting the text into tokens
+    // and concatenating them for decodeHex, as this function is called for
+    // each lease read from the lease file.
+    std::vector<uint8_t> binary;
+    binary.reserve((text.size() + 1) / 3);
+    size_t digits = 0;
+    uint8_t value = 0;
+    for (std::string::const_iterator c = text.begin(); c != text.end(); ++c) {
+        if (*c == ':') {
+            // If the current token is empty, it means that two consecutive
+            // colons were specified or that the colon is leading. This is
+            // not allowed for hardware address.
+            if (digits == 0) {
+                bundy_throw(bundy::BadValue, "failed to create hardware address"
+                          " from text '" << text << "': tokens of the hardware"
+                          " address must be separated with a single colon");
+            }
+            binary.push_back(value);
+            digits = 0;
+            value = 0;
+            continue;
+        }
+
+        const int digit = hexDigitValue(*c);
+        if (digit < 0) {
+            bundy_throw(bundy::BadValue, "failed to create hwaddr from text '"
+                      << text << "': invalid hexadecimal digit '" << *c
+                      << "'");
+
+        } else if (++digits > 2) {
             bundy_throw(bundy::BadValue, "invalid hwaddr '" << text << "'");
         }
-        s << split_text[i];
+        value = (value << 4) | digit;
     }
 
-    std::vector<uint8_t> binary;
-    try {
-        util::encode::decodeHex(s.str(), binary);
-    } catch (const Exception& ex) {
-        bundy_throw(bundy::BadValue, "failed to create hwaddr from text '"
-                  << text << "': " << ex.what());
+    if (digits > 0) {
+        binary.push_back(value);
+
+    } else if (!text.empty()) {
+        bundy_throw(bundy::BadValue, "failed to create hardware address"
+                  " from text '" << text << "': tokens of the hardware"
+                  " address must be separated with a single colon");
     }
     return (HWAddr(binary, htype));
 }
@@ -28,6 +28,7 @@
 #include <exceptions/exceptions.h>
 #include <util/io/pktinfo_utilities.h>
 
+#include <algorithm>
 #include <cstring>
 #include <errno.h>
 #include <fstream>
@@ -171,7 +172,8 @@ IfaceMgr::IfaceMgr()
     :control_buf_len_(CMSG_SPACE(sizeof(struct in6_pktinfo))),
      control_buf_(new char[control_buf_len_]),
      packet_filter_(new PktFilterInet()),
-     packet_filter6_(new PktFilterInet6())
+     packet_filter6_(new PktFilterInet6()),
+     monitor_fd_(-1)
 {
 
     try {
@@ -222,6 +224,7 @@ void IfaceMgr::closeSockets() {
          iface != ifaces_.end(); ++iface) {
         iface->closeSockets();
     }
+    received4_.clear();
 }
 
 void
@@ -230,12 +233,16 @@ IfaceMgr::closeSockets(const uint16_t family) {
          iface != ifaces_.end(); ++iface) {
         iface->closeSockets(family);
     }
+    if (family == AF_INET) {
+        received4_.clear();
+    }
 }
 
 IfaceMgr::~IfaceMgr() {
     // control_buf_ is deleted automatically (scoped_ptr)
     control_buf_len_ = 0;
 
+    stopIfaceMonitor();
     closeSockets();
 }
 
@@ -275,6 +282,16 @@ IfaceMgr::deleteExternalSocket(int socketfd) {
     }
 }
 
+void
+IfaceMgr::stopIfaceMonitor() {
+    if (monitor_fd_ >= 0) {
+        deleteExternalSocket(monitor_fd_);
+        close(monitor_fd_);
+        monitor_fd_ = -1;
+    }
+    monitor_callback_ = IfaceChangeCallback();
+}
+
 void
 IfaceMgr::setPacketFilter(const PktFilterPtr& packet_filter) {
     // Do not allow NULL pointer.
@@ -398,6 +415,55 @@ bool
 IfaceMgr::openSockets4(const uint16_t port, const bool use_bcast,
                        IfaceMgrErrorMsgCallback error_handler) {
     int count = 0;
+    int bcast_num = 0;
+
+    for (IfaceCollection::iterator iface = ifaces_.begin();
+         iface != ifaces_.end();
+         ++iface) {
+        count += openIfaceSockets4(*iface, port, use_bcast, error_handler,
+                                   bcast_num);
+    }
+    return (count > 0);
+}
+
+bool
+IfaceMgr::reopenSockets4(const std::string& ifname, const uint16_t port,
+                         const bool use_bcast,
+                         IfaceMgrErrorMsgCallback error_handler) {
+    Iface* iface = getIface(ifname);
+    if (iface == NULL) {
+        bundy_throw(BadValue, "interface " << ifname << " doesn't exist");
+    }
+    iface->closeSockets(AF_INET);
+
+    // Without SO_BINDTODEVICE a single broadcast socket may be open, so
+    // count the ones the other interfaces have.
+    int bcast_num = 0;
+#ifndef SO_BINDTODEVICE
+    for (IfaceCollection::const_iterator other = ifaces_.begin();
+         other != ifaces_.end(); ++other) {
+        if (other->flag_broadcast_ && use_bcast) {
+            const Iface::SocketCollection& sockets = other->getSockets();
+            for (Iface::SocketCollection::const_iterator sock =
+                     sockets.begin(); sock != sockets.end(); ++sock) {
+                if (sock->family_ == AF_INET) {
+                    ++bcast_num;
+                }
+            }
+        }
+    }
+#endif
+
+    return (openIfaceSockets4(*iface, port, use_bcast, error_handler,
+                              bcast_num) > 0);
+}
+
+int
+IfaceMgr::openIfaceSockets4(Iface& iface, const uint16_t port,
+                            const bool use_bcast,
+                            IfaceMgrErrorMsgCallback error_handler,
+                            int& bcast_num) {
+    int count = 0;
 
 // This option is used to bind sockets to particular interfaces.
 // This is currently the only way to discover on which interface
@@ -410,85 +476,78 @@ IfaceMgr::openSockets4(const uint16_t port, const bool use_bcast,
     const bool bind_to_device = false;
 #endif
 
-    int bcast_num = 0;
+    if (iface.flag_loopback_ ||
+        !iface.flag_up_ ||
+        !iface.flag_running_ ||
+        iface.inactive4_) {
+        return (0);
+    }
 
-    for (IfaceCollection::iterator iface = ifaces_.begin();
-         iface != ifaces_.end();
-         ++iface) {
+    Iface::AddressCollection addrs = iface.getAddresses();
+    for (Iface::AddressCollection::iterator addr = addrs.begin();
+         addr != addrs.end();
+         ++addr) {
 
-        if (iface->flag_loopback_ ||
-            !iface->flag_up_ ||
-            !iface->flag_running_ ||
-            iface->inactive4_) {
+        // Skip all but V4 addresses.
+        if (!addr->isV4()) {
             continue;
         }
 
-        Iface::AddressCollection addrs = iface->getAddresses();
-        for (Iface::AddressCollection::iterator addr = addrs.begin();
-             addr != addrs.end();
-             ++addr) {
-
-            // Skip all but V4 addresses.
-            if (!addr->isV4()) {
+        // If selected interface is broadcast capable set appropriate
+        // options on the socket so as it can receive and send broadcast
+        // messages.
+        if (iface.flag_broadcast_ && use_bcast) {
+            // If our OS supports binding socket to a device we can listen
+            // for broadcast messages on multiple interfaces. Otherwise we
+            // bind to INADDR_ANY address but we can do it only once. Thus,
+            // if one socket has been bound we can't do it any further.
+            if (!bind_to_device && bcast_num > 0) {
+                IFACEMGR_ERROR(SocketConfigError, error_handler,
+                               "SO_BINDTODEVICE socket option is"
+                               " not supported on this OS;"
+                               " therefore, DHCP server can only"
+                               " listen broadcast traffic on a"
+                               " single interface");
                 continue;
-            }
-
-            // If selected interface is broadcast capable set appropriate
-            // options on the socket so as it can receive and send broadcast
-            // messages.
-            if (iface->flag_broadcast_ && use_bcast) {
-                // If our OS supports binding socket to a device we can listen
-                // for broadcast messages on multiple interfaces. Otherwise we
-                // bind to INADDR_ANY address but we can do it only once. Thus,
-                // if one socket has been bound we can't do it any further.
-                if (!bind_to_device && bcast_num > 0) {
-                    IFACEMGR_ERROR(SocketConfigError, error_handler,
-                                   "SO_BINDTODEVICE socket option is"
-                                   " not supported on this OS;"
-                                   " therefore, DHCP server can only"
-                                   " listen broadcast traffic on a"
-                                   " single interface");
-                    continue;
-
-                } else {
-                    try {
-                        // We haven't open any broadcast sockets yet, so we can
-                        // open at least one more.
-                        openSocket(iface->getName(), *addr, port, true, true);
-                    } catch (const Exception& ex) {
-                        IFACEMGR_ERROR(SocketConfigError, error_handler,
-                                       "failed to open socket on interface "
-                                       << iface->getName() << ", reason: "
-                                       << ex.what());
-                        continue;
-
-                    }
-                    // Binding socket to an interface is not supported so we
-                    // can't open any more broadcast sockets. Increase the
-                    // number of open broadcast sockets.
-                    if (!bind_to_device) {
-                        ++bcast_num;
-                    }
-                }
 
             } else {
                 try {
-                    // Not broadcast capable, do not set broadcast flags.
-                    openSocket(iface->getName(), *addr, port, false, false);
+                    // We haven't open any broadcast sockets yet, so we can
+                    // open at least one more.
+                    openSocket(iface.getName(), *addr, port, true, true);
                 } catch (const Exception& ex) {
                     IFACEMGR_ERROR(SocketConfigError, error_handler,
                                    "failed to open socket on interface "
-                                   << iface->getName() << ", reason: "
+                                   << iface.getName() << ", reason: "
                                    << ex.what());
                     continue;
+
                 }
+                // Binding socket to an interface is not supported so we
+                // can't open any more broadcast sockets. Increase the
+                // number of open broadcast sockets.
+                if (!bind_to_device) {
+                    ++bcast_num;
+                }
+            }
 
+        } else {
+            try {
+                // Not broadcast capable, do not set broadcast flags.
+                openSocket(iface.getName(), *addr, port, false, false);
+            } catch (const Exception& ex) {
+                IFACEMGR_ERROR(SocketConfigError, error_handler,
+                               "failed to open socket on interface "
+                               << iface.getName() << ", reason: "
+                               << ex.what());
+                continue;
             }
-            ++count;
 
         }
+        ++count;
+
     }
-    return (count > 0);
+    return (count);
 }
 
 bool
@@ -499,62 +558,81 @@ IfaceMgr::openSockets6(const uint16_t port,
     for (IfaceCollection::iterator iface = ifaces_.begin();
          iface != ifaces_.end();
          ++iface) {
+        count += openIfaceSockets6(*iface, port, error_handler);
+    }
+    return (count > 0);
+}
 
-        if (iface->flag_loopback_ ||
-            !iface->flag_up_ ||
-            !iface->flag_running_ ||
-            iface->inactive6_) {
-            continue;
-        }
-
-        // Open unicast sockets if there are any unicast addresses defined
-        Iface::AddressCollection unicasts = iface->getUnicasts();
-        for (Iface::AddressCollection::iterator addr = unicasts.begin();
-             addr != unicasts.end(); ++addr) {
+bool
+IfaceMgr::reopenSockets6(const std::string& ifname, const uint16_t port,
+                         IfaceMgrErrorMsgCallback error_handler) {
+    Iface* iface = getIface(ifname);
+    if (iface == NULL) {
+        bundy_throw(BadValue, "interface " << ifname << " doesn't exist");
+    }
+    iface->closeSockets(AF_INET6);
+    return (openIfaceSockets6(*iface, port, error_handler) > 0);
+}
 
-            try {
-                openSocket(iface->getName(), *addr, port);
-            } catch (const Exception& ex) {
-                IFACEMGR_ERROR(SocketConfigError, error_handler,
-                               "Failed to open unicast socket on  interface "
-                               << iface->getName() << ", reason: "
-                               << ex.what());
-                continue;
-            }
+int
+IfaceMgr::openIfaceSockets6(Iface& iface, const uint16_t port,
+                            IfaceMgrErrorMsgCallback error_handler) {
+    int count = 0;
 
-            count++;
+    if (iface.flag_loopback_ ||
+        !iface.flag_up_ ||
+        !iface.flag_running_ ||
+        iface.inactive6_) {
+        return (0);
+    }
 
+    // Open unicast sockets if there are any unicast addresses defined
+    Iface::AddressCollection unicasts = iface.getUnicasts();
+    for (Iface::AddressCollection::iterator addr = unicasts.begin();
+         addr != unicasts.end(); ++addr) {
+
+        try {
+            openSocket(iface.getName(), *addr, port);
+        } catch (const Exception& ex) {
+            IFACEMGR_ERROR(SocketConfigError, error_handler,
+                           "Failed to open unicast socket on  interface "
+                           << iface.getName() << ", reason: "
+                           << ex.what());
+            continue;
         }
 
-        Iface::AddressCollection addrs = iface->getAddresses();
-        for (Iface::AddressCollection::iterator addr = addrs.begin();
-             addr != addrs.end();
-             ++addr) {
+        count++;
 
-            // Skip all but V6 addresses.
-            if (!addr->isV6()) {
-                continue;
-            }
+    }
 
-            // Bind link-local addresses only. Otherwise we bind several sockets
-            // on interfaces that have several global addresses. For examples
-            // with interface with 2 global addresses, we would bind 3 sockets
-            // (one for link-local and two for global). That would result in
-            // getting each message 3 times.
-            if (!addr->isV6LinkLocal()){
-                continue;
-            }
+    Iface::AddressCollection addrs = iface.getAddresses();
+    for (Iface::AddressCollection::iterator addr = addrs.begin();
+         addr != addrs.end();
+         ++addr) {
 
-            // Run OS-specific function to open a socket on link-local address
-            // and join multicast group (non-Linux OSes), or open two sockets and
-            // bind one to link-local, another one to multicast address.
-            if (openMulticastSocket(*iface, *addr, port, error_handler)) {
-                ++count;
-            }
+        // Skip all but V6 addresses.
+        if (!addr->isV6()) {
+            continue;
+        }
 
+        // Bind link-local addresses only. Otherwise we bind several sockets
+        // on interfaces that have several global addresses. For examples
+        // with interface with 2 global addresses, we would bind 3 sockets
+        // (one for link-local and two for global). That would result in
+        // getting each message 3 times.
+        if (!addr->isV6LinkLocal()){
+            continue;
+        }
+
+        // Run OS-specific function to open a socket on link-local address
+        // and join multicast group (non-Linux OSes), or open two sockets and
+        // bind one to link-local, another one to multicast address.
+        if (openMulticastSocket(iface, *addr, port, error_handler)) {
+            ++count;
         }
+
     }
-    return (count > 0);
+    return (count);
 }
 
 void
@@ -614,6 +692,78 @@ IfaceMgr::clearIfaces() {
     ifaces_.clear();
 }
 
+std::string
+IfaceMgr::applyIfaceEvent(const IfaceEvent& event) {
+    IfaceCollection::iterator iface = ifaces_.begin();
+    while ((iface != ifaces_.end()) && (iface->getIndex() != event.ifindex_)) {
+        ++iface;
+    }
+
+    switch (event.type_) {
+    case IfaceEvent::LINK_UPDATED:
+        if ((iface != ifaces_.end()) && (iface->getName() != event.name_)) {
+            // The interface has been renamed. The sockets are bound to the
+            // old name, and the configuration refers to interfaces by name,
+            // so it is replaced by a new interface with the same addresses.
+            Iface renamed(event.name_, event.ifindex_);
+            const Iface::AddressCollection& addrs = iface->getAddresses();
+            for (Iface::AddressCollection::const_iterator addr =
+                     addrs.begin(); addr != addrs.end(); ++addr) {
+                renamed.addAddress(*addr);
+            }
+            iface->closeSockets();
+            ifaces_.erase(iface);
+            iface = ifaces_.insert(ifaces_.end(), renamed);
+
+        } else if (iface == ifaces_.end()) {
+            iface = ifaces_.insert(ifaces_.end(),
+                                   Iface(event.name_, event.ifindex_));
+
+        } else if ((iface->flags_ == event.flags_) &&
+                   (iface->getHWType() == event.hwtype_) &&
+                   (iface->getMacLen() == event.mac_.size()) &&
+                   (event.mac_.empty() ||
+                    (memcmp(iface->getMac(), &event.mac_[0],
+                            event.mac_.size()) == 0))) {
+            // Nothing we care about has changed.
+            return ("");
+        }
+        iface->setHWType(event.hwtype_);
+        iface->setFlags(event.flags_);
+        if (!event.mac_.empty()) {
+            iface->setMac(&event.mac_[0], event.mac_.size());
+        }
+        return (iface->getName());
+
+    case IfaceEvent::LINK_REMOVED:
+        if (iface != ifaces_.end()) {
+            const std::string name = iface->getName();
+            iface->closeSockets();
+            ifaces_.erase(iface);
+            return (name);
+        }
+        break;
+
+    case IfaceEvent::ADDRESS_ADDED:
+        if (iface != ifaces_.end()) {
+            const Iface::AddressCollection& addrs = iface->getAddresses();
+            if (std::find(addrs.begin(), addrs.end(), event.addr_) ==
+                addrs.end()) {
+                iface->addAddress(event.addr_);
+                return (iface->getName());
+            }
+        }
+        break;
+
+    case IfaceEvent::ADDRESS_REMOVED:
+        if ((iface != ifaces_.end()) && iface->delAddress(event.addr_)) {
+            return (iface->getName());
+        }
+        break;
+    }
+    return ("");
+}
+
 int IfaceMgr::openSocket(const std::string& ifname, const IOAddress& addr,
                          const uint16_t port, const bool receive_bcast,
                          const bool send_bcast) {
@@ -833,7 +983,14 @@ IfaceMgr::receive4(uint32_t timeout_sec, uint32_t timeout_usec /* = 0 */) {
         bundy_throw(BadValue, "fractional timeout must be shorter than"
                   " one million microseconds");
     }
-    const SocketInfo* candidate = 0;
+
+    // Return the packets received earlier first.
+    if (!received4_.empty()) {
+        Pkt4Ptr pkt = received4_.front();
+        received4_.pop_front();
+        return (pkt);
+    }
+
     IfaceCollection::const_iterator iface;
     fd_set sockets;
     int maxfd = 0;
@@ -896,26 +1053,38 @@ IfaceMgr::receive4(uint32_t timeout_sec, uint32_t timeout_usec /* = 0 */) {
 
         // Calling the external socket's callback provides its service
         // layer access without integrating any specific features
-        // in IfaceMgr
+        // in IfaceMgr. The callback is copied as it may add or delete
+        // the external sockets, including its own.
         if (s->callback_) {
-            s->callback_();
+            const SocketCallback callback = s->callback_;
+            callback();
         }
 
         return (Pkt4Ptr());
     }
 
-    // Let's find out which interface/socket has the data
+    // Let's find out which interfaces/sockets have the data and read it
+    // all. Packets read before a failure are kept for the next calls.
+    bool candidate = false;
+    std::vector<Pkt4Ptr> pkts;
     for (iface = ifaces_.begin(); iface != ifaces_.end(); ++iface) {
         const Iface::SocketCollection& socket_collection = iface->getSockets();
         for (Iface::SocketCollection::const_iterator s = socket_collection.begin();
              s != socket_collection.end(); ++s) {
-            if (FD_ISSET(s->sockfd_, &sockets)) {
-                candidate = &(*s);
-                break;
+            if (!s->addr_.isV4() || !FD_ISSET(s->sockfd_, &sockets)) {
+                continue;
             }
-        }
-        if (candidate) {
-            break;
+            candidate = true;
+            pkts.clear();
+            try {
+                // Assuming that packet filter is not NULL, because its
+                // modifier checks it.
+                packet_filter_->receiveBatch(*iface, *s, RCVBATCHSIZE, pkts);
+            } catch (...) {
+                received4_.insert(received4_.end(), pkts.begin(), pkts.end());
+                throw;
+            }
+            received4_.insert(received4_.end(), pkts.begin(), pkts.end());
         }
     }
 
@@ -923,9 +1092,12 @@ IfaceMgr::receive4(uint32_t timeout_sec, uint32_t timeout_usec /* = 0 */) {
         bundy_throw(SocketReadError, "received data over unknown socket");
     }
 
-    // Now we have a socket, let's get some data from it!
-    // Assuming that packet filter is not NULL, because its modifier checks it.
-    return (packet_filter_->receive(*iface, *candidate));
+    if (received4_.empty()) {
+        return (Pkt4Ptr());
+    }
+    Pkt4Ptr pkt = received4_.front();
+    received4_.pop_front();
+    return (pkt);
 }
 
 Pkt6Ptr IfaceMgr::receive6(uint32_t timeout_sec, uint32_t timeout_usec /* = 0 */ ) {
@@ -999,9 +1171,11 @@ Pkt6Ptr IfaceMgr::receive6(uint32_t timeout_sec, uint32_t timeout_usec /* = 0 */
 
         // Calling the external socket's callback provides its service
         // layer access without integrating any specific features
-        // in IfaceMgr
+        // in IfaceMgr. The callback is copied as it may add or delete
+        // the external sockets, including its own.
         if (s->callback_) {
-            s->callback_();
+            const SocketCallback callback = s->callback_;
+            callback();
         }
 
         return (Pkt6Ptr());
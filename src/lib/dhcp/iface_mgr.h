@@ -28,7 +28,9 @@
 #include <boost/scoped_array.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include <deque>
 #include <list>
+#include <vector>
 
 namespace bundy {
 
@@ -397,6 +399,61 @@ public:
 typedef
 boost::function<void(const std::string& errmsg)> IfaceMgrErrorMsgCallback;
 
+/// @brief Change of a network interface reported by the operating system.
+///
+/// The interface monitor of the @c IfaceMgr (see
+/// @ref IfaceMgr::startIfaceMonitor) translates the notifications sent by
+/// the kernel into these events and applies them to the interfaces it
+/// knows with @ref IfaceMgr::applyIfaceEvent.
+struct IfaceEvent {
+    /// @brief Type of the change.
+    enum Type {
+        LINK_UPDATED,    ///< Interface added, renamed or its flags changed.
+        LINK_REMOVED,    ///< Interface removed.
+        ADDRESS_ADDED,   ///< Address assigned to the interface.
+        ADDRESS_REMOVED  ///< Address removed from the interface.
+    };
+
+    /// @brief Constructor.
+    ///
+    /// @param type type of the change.
+    /// @param ifindex index of the interface changed.
+    IfaceEvent(const Type type, const int ifindex)
+        : type_(type), ifindex_(ifindex), hwtype_(0), flags_(0),
+          addr_("::") {
+    }
+
+    /// Type of the change.
+    Type type_;
+
+    /// Index of the interface.
+    int ifindex_;
+
+    /// Name of the interface (LINK_UPDATED only).
+    std::string name_;
+
+    /// Hardware type of the interface (LINK_UPDATED only).
+    uint16_t hwtype_;
+
+    /// Flags of the interface, as returned by the OS (LINK_UPDATED only).
+    uint64_t flags_;
+
+    /// Link-layer address, empty if there is none (LINK_UPDATED only).
+    std::vector<uint8_t> mac_;
+
+    /// Address assigned or removed (ADDRESS_ADDED and ADDRESS_REMOVED only).
+    bundy::asiolink::IOAddress addr_;
+};
+
+/// @brief Callback invoked when interfaces have changed.
+///
+/// @param ifnames names of the interfaces changed. An interface which has
+/// been removed is reported under its last name, and is no longer known
+/// by the @c IfaceMgr.
+typedef
+boost::function<void(const std::vector<std::string>& ifnames)>
+IfaceChangeCallback;
+
 /// @brief Handles network interfaces, transmission and reception.
 ///
 /// IfaceMgr is an interface manager class that detects available network
@@ -429,6 +486,9 @@ public:
     /// we don't support packets larger than 1500.
     static const uint32_t RCVBUFSIZE = 1500;
 
+    /// @brief Maximum number of IPv4 packets read from a socket at once
+    static const size_t RCVBATCHSIZE = 16;
+
     // TODO performance improvement: we may change this into
     //      2 maps (ifindex-indexed and name-indexed) and
     //      also hide it (make it public make tests easier for now)
@@ -494,6 +554,55 @@ public:
     /// IPv6 address is read from interfaces.txt file.
     void detectIfaces();
 
+    /// @brief Applies a change of an interface to the detected interfaces.
+    ///
+    /// An interface which is removed or renamed has its sockets closed.
+    /// The sockets of an interface which goes down or loses an address are
+    /// left to the caller, which is told about the change by the returned
+    /// name and is expected to reopen the sockets of the interface (see
+    /// @ref reopenSockets4 and @ref reopenSockets6).
+    ///
+    /// @param event the change.
+    ///
+    /// @return name of the interface changed, or an empty string if the
+    /// event doesn't change anything the @c IfaceMgr knows about (e.g. the
+    /// kernel reported the traffic counters of a link).
+    std::string applyIfaceEvent(const IfaceEvent& event);
+
+    /// @brief Starts following the changes of the interfaces.
+    ///
+    /// On large routers with thousands of VLAN interfaces rescanning all
+    /// interfaces and reopening all sockets whenever one of them changes
+    /// is slow. The monitor subscribes to the notifications of the kernel
+    /// instead (on Linux, the link and address groups of the rtnetlink
+    /// protocol), applies each change with @ref applyIfaceEvent and invokes
+    /// the callback with the names of the interfaces which have changed,
+    /// once per batch of notifications.
+    ///
+    /// The notifications are read from an external socket (see
+    /// @ref addExternalSocket), so the callback is invoked from within
+    /// @ref receive4 or @ref receive6. If the kernel drops notifications
+    /// because the process didn't read them fast enough, the monitor
+    /// compares the interfaces with a full dump instead.
+    ///
+    /// @param callback function invoked with the names of the interfaces
+    /// which have changed.
+    ///
+    /// @return true if the monitor has been started, false if it isn't
+    /// supported on this OS.
+    /// @throw bundy::Unexpected if the monitor socket can't be opened.
+    bool startIfaceMonitor(const IfaceChangeCallback& callback);
+
+    /// @brief Stops following the changes of the interfaces.
+    void stopIfaceMonitor();
+
+    /// @brief Checks whether the changes of the interfaces are followed.
+    ///
+    /// @return true if the monitor is running.
+    bool isIfaceMonitorRunning() const {
+        return (monitor_fd_ >= 0);
+    }
+
     /// @brief Return most suitable socket for transmitting specified IPv6 packet.
     ///
     /// This method takes Pkt6 (see overloaded implementation that takes
@@ -576,6 +685,11 @@ public:
     /// If reception is successful and all information about its sender
     /// are obtained, Pkt4 object is created and returned.
     ///
+    /// When the sockets have data, up to @c RCVBATCHSIZE packets are read
+    /// from each of them (see @c PktFilter::receiveBatch) and queued. The
+    /// following calls return the queued packets without waiting, and the
+    /// sockets are only checked again when the queue is empty.
+    ///
     /// @param timeout_sec specifies integral part of the timeout (in seconds)
     /// @param timeout_usec specifies fractional part of the timeout
     /// (in microseconds)
@@ -778,6 +892,42 @@ public:
                       const bool use_bcast = true,
                       IfaceMgrErrorMsgCallback error_handler = NULL);
 
+    /// @brief Reopens the IPv6 sockets of a single interface.
+    ///
+    /// It closes the IPv6 sockets of the interface and opens them again
+    /// under the conditions of @ref openSockets6, leaving the sockets of
+    /// the other interfaces alone.
+    ///
+    /// @param ifname name of the interface.
+    /// @param port specifies port number (usually DHCP6_SERVER_PORT)
+    /// @param error_handler A pointer to an error handler function, or NULL.
+    ///
+    /// @throw SocketOpenFailure if tried and failed to open socket and callback
+    /// function hasn't been specified.
+    /// @return true if any sockets were open on the interface
+    bool reopenSockets6(const std::string& ifname,
+                        const uint16_t port = DHCP6_SERVER_PORT,
+                        IfaceMgrErrorMsgCallback error_handler = NULL);
+
+    /// @brief Reopens the IPv4 sockets of a single interface.
+    ///
+    /// It closes the IPv4 sockets of the interface and opens them again
+    /// under the conditions of @ref openSockets4, leaving the sockets of
+    /// the other interfaces alone.
+    ///
+    /// @param ifname name of the interface.
+    /// @param port specifies port number (usually DHCP4_SERVER_PORT)
+    /// @param use_bcast configure sockets to support broadcast messages.
+    /// @param error_handler A pointer to an error handler function, or NULL.
+    ///
+    /// @throw SocketOpenFailure if tried and failed to open socket and callback
+    /// function hasn't been specified.
+    /// @return true if any sockets were open on the interface
+    bool reopenSockets4(const std::string& ifname,
+                        const uint16_t port = DHCP4_SERVER_PORT,
+                        const bool use_bcast = true,
+                        IfaceMgrErrorMsgCallback error_handler = NULL);
+
     /// @brief Closes all open sockets.
     /// Is used in destructor, but also from Dhcpv4Srv and Dhcpv6Srv classes.
     void closeSockets();
@@ -1041,6 +1191,43 @@ private:
                              const uint16_t port,
                              IfaceMgrErrorMsgCallback error_handler = NULL);
 
+    /// @brief Opens IPv4 sockets on a single interface.
+    ///
+    /// @note This function is intended to be called internally by the
+    /// @c IfaceMgr::openSockets4 and @c IfaceMgr::reopenSockets4.
+    ///
+    /// @param iface Interface on which sockets should be open.
+    /// @param port Port number to bind sockets to.
+    /// @param use_bcast configure sockets to support broadcast messages.
+    /// @param error_handler Error handler function, or NULL.
+    /// @param [in,out] bcast_num number of broadcast sockets open on the
+    /// OSes which don't support SO_BINDTODEVICE.
+    ///
+    /// @return number of sockets open.
+    int openIfaceSockets4(Iface& iface, const uint16_t port,
+                          const bool use_bcast,
+                          IfaceMgrErrorMsgCallback error_handler,
+                          int& bcast_num);
+
+    /// @brief Opens IPv6 sockets on a single interface.
+    ///
+    /// @note This function is intended to be called internally by the
+    /// @c IfaceMgr::openSockets6 and @c IfaceMgr::reopenSockets6.
+    ///
+    /// @param iface Interface on which sockets should be open.
+    /// @param port Port number to bind sockets to.
+    /// @param error_handler Error handler function, or NULL.
+    ///
+    /// @return number of sockets open.
+    int openIfaceSockets6(Iface& iface, const uint16_t port,
+                          IfaceMgrErrorMsgCallback error_handler);
+
+    /// @brief Reads the notifications of the interface monitor.
+    ///
+    /// Called when the monitor socket is readable. It applies the changes
+    /// and invokes the callback passed to @ref startIfaceMonitor.
+    void handleIfaceEvents();
+
     /// Holds instance of a class derived from PktFilter, used by the
     /// IfaceMgr to open sockets and send/receive packets through these
     /// sockets. It is possible to supply custom object using
@@ -1059,6 +1246,15 @@ private:
 
     /// @brief Contains list of callbacks for external sockets
     SocketCallbackInfoContainer callbacks_;
+
+    /// @brief IPv4 packets received but not yet returned by receive4().
+    std::deque<Pkt4Ptr> received4_;
+
+    /// Socket of the interface monitor, -1 if it isn't running.
+    int monitor_fd_;
+
+    /// Callback invoked when the monitor has applied changes.
+    IfaceChangeCallback monitor_callback_;
 };
 
 }; // namespace bundy::dhcp
@@ -26,6 +26,10 @@
 /// traffic classes, manipulation of neighbourhood tables and even the ability
 /// to do something with address labels. Getting a list of interfaces with
 /// addresses configured on it is just a small subset of all possible actions.
+///
+/// The interface monitor (IfaceMgr::startIfaceMonitor()) uses the same
+/// protocol: it subscribes to the multicast groups in which the kernel
+/// announces the changes of the links and of their addresses.
 
 #include <config.h>
 
@@ -40,8 +44,14 @@
 #include <util/io/sockaddr_util.h>
 
 #include <boost/array.hpp>
+#include <boost/bind.hpp>
 #include <boost/static_assert.hpp>
 
+#include <algorithm>
+#include <map>
+#include <set>
+
+#include <fcntl.h>
 #include <stdint.h>
 #include <net/if.h>
 #include <linux/rtnetlink.h>
@@ -106,7 +116,8 @@ public:
     void rtnl_send_request(int family, int type);
     void rtnl_store_reply(NetlinkMessages& storage, const nlmsghdr* msg);
     void parse_rtattr(RTattribPtrs& table, rtattr* rta, int len);
-    void ipaddrs_get(Iface& iface, NetlinkMessages& addr_info);
+    void link_get(const nlmsghdr* msg, IfaceEvent& event);
+    bool ipaddr_get(const nlmsghdr* msg, IfaceEvent& event);
     void rtnl_process_reply(NetlinkMessages& info);
     void release_list(NetlinkMessages& messages);
     void rtnl_close_socket();
@@ -125,6 +136,12 @@ const static size_t SNDBUF_SIZE = 32768;
 /// @brief defines a size of a received netlink buffer
 const static size_t RCVBUF_SIZE = 32768;
 
+/// @brief defines a size of the receive buffer of the interface monitor
+///
+/// It is large so that the kernel can queue the notifications about many
+/// VLAN interfaces going down at once.
+const static size_t MONITOR_RCVBUF_SIZE = 1024 * 1024;
+
 /// @brief Opens netlink socket and initializes handle structure.
 ///
 /// @throw bundy::Unexpected Thrown if socket configuration fails.
@@ -270,7 +287,37 @@ void Netlink::parse_rtattr(RTattribPtrs& table, struct rtattr* rta, int len)
     }
 }
 
-/// @brief Parses addr_info and appends appropriate addresses to Iface object.
+/// @brief Parses a message describing a link.
+///
+/// @param msg netlink message of RTM_NEWLINK type.
+/// @param [out] event the name, index, flags, hardware type and link-layer
+///        address of the link are stored here.
+void Netlink::link_get(const nlmsghdr* msg, IfaceEvent& event) {
+    RTattribPtrs attribs_table;
+    const ifinfomsg* interface_info =
+        static_cast<const ifinfomsg*>(NLMSG_DATA(msg));
+    int len = msg->nlmsg_len;
+    len -= NLMSG_LENGTH(sizeof(*interface_info));
+    parse_rtattr(attribs_table, IFLA_RTA(interface_info), len);
+
+    event.ifindex_ = interface_info->ifi_index;
+    event.hwtype_ = interface_info->ifi_type;
+    event.flags_ = interface_info->ifi_flags;
+    if (attribs_table[IFLA_IFNAME]) {
+        event.name_ = static_cast<const char*>
+            (RTA_DATA(attribs_table[IFLA_IFNAME]));
+    }
+
+    // Tunnels can have no LL_ADDR. RTA_PAYLOAD doesn't check it and
+    // try to dereference it in this manner
+    if (attribs_table[IFLA_ADDRESS]) {
+        const uint8_t* mac = static_cast<const uint8_t*>
+            (RTA_DATA(attribs_table[IFLA_ADDRESS]));
+        event.mac_.assign(mac, mac + RTA_PAYLOAD(attribs_table[IFLA_ADDRESS]));
+    }
+}
+
+/// @brief Parses a message describing an address.
 ///
 /// Netlink is a fine, but convoluted interface. It returns a concatenated
 /// collection of netlink messages. Some of those messages convey information
@@ -278,39 +325,37 @@ void Netlink::parse_rtattr(RTattribPtrs& table, struct rtattr* rta, int len)
 /// by concatenated lists of rtattr structures that define various pieces
 /// of address information.
 ///
-/// @param iface interface representation (addresses will be added here)
-/// @param addr_info collection of parsed netlink messages
-void Netlink::ipaddrs_get(Iface& iface, NetlinkMessages& addr_info) {
+/// @param msg netlink message of RTM_NEWADDR or RTM_DELADDR type.
+/// @param [out] event the index of the interface and the address are
+///        stored here.
+/// @return true if the message describes an IPv4 or IPv6 address.
+bool Netlink::ipaddr_get(const nlmsghdr* msg, IfaceEvent& event) {
     uint8_t addr[V6ADDRESS_LEN];
     RTattribPtrs rta_tb;
 
-    for (NetlinkMessages::const_iterator msg = addr_info.begin();
-         msg != addr_info.end(); ++msg) {
-        ifaddrmsg* ifa = static_cast<ifaddrmsg*>(NLMSG_DATA(*msg));
-
-        // These are not the addresses you are looking for
-        if (ifa->ifa_index != iface.getIndex()) {
-            continue;
-        }
+    const ifaddrmsg* ifa = static_cast<const ifaddrmsg*>(NLMSG_DATA(msg));
+    if ((ifa->ifa_family != AF_INET6) && (ifa->ifa_family != AF_INET)) {
+        return (false);
+    }
 
-        if ((ifa->ifa_family == AF_INET6) || (ifa->ifa_family == AF_INET)) {
-            std::fill(rta_tb.begin(), rta_tb.end(), static_cast<rtattr*>(NULL));
-            parse_rtattr(rta_tb, IFA_RTA(ifa), (*msg)->nlmsg_len - NLMSG_LENGTH(sizeof(*ifa)));
-            if (!rta_tb[IFA_LOCAL]) {
-                rta_tb[IFA_LOCAL] = rta_tb[IFA_ADDRESS];
-            }
-            if (!rta_tb[IFA_ADDRESS]) {
-                rta_tb[IFA_ADDRESS] = rta_tb[IFA_LOCAL];
-            }
+    parse_rtattr(rta_tb, IFA_RTA(ifa), msg->nlmsg_len - NLMSG_LENGTH(sizeof(*ifa)));
+    if (!rta_tb[IFA_LOCAL]) {
+        rta_tb[IFA_LOCAL] = rta_tb[IFA_ADDRESS];
+    }
+    if (!rta_tb[IFA_ADDRESS]) {
+        rta_tb[IFA_ADDRESS] = rta_tb[IFA_LOCAL];
+    }
+    if (!rta_tb[IFA_ADDRESS]) {
+        return (false);
+    }
 
-            memcpy(addr, RTA_DATA(rta_tb[IFLA_ADDRESS]),
-                   ifa->ifa_family==AF_INET?V4ADDRESS_LEN:V6ADDRESS_LEN);
-            IOAddress a = IOAddress::fromBytes(ifa->ifa_family, addr);
-            iface.addAddress(a);
+    memcpy(addr, RTA_DATA(rta_tb[IFLA_ADDRESS]),
+           ifa->ifa_family==AF_INET?V4ADDRESS_LEN:V6ADDRESS_LEN);
+    event.ifindex_ = ifa->ifa_index;
+    event.addr_ = IOAddress::fromBytes(ifa->ifa_family, addr);
 
-            /// TODO: Read lifetimes of configured IPv6 addresses
-        }
-    }
+    /// TODO: Read lifetimes of configured IPv6 addresses
+    return (true);
 }
 
 /// @brief Processes reply received over netlink socket.
@@ -428,11 +473,6 @@ void IfaceMgr::detectIfaces() {
     // Socket descriptors and other rtnl-related parameters.
     Netlink nl;
 
-    // Table with pointers to address attributes.
-    Netlink::RTattribPtrs attribs_table;
-    std::fill(attribs_table.begin(), attribs_table.end(),
-              static_cast<struct rtattr*>(NULL));
-
     // Open socket
     nl.rtnl_open_socket();
 
@@ -460,43 +500,225 @@ void IfaceMgr::detectIfaces() {
     // addr_info. It will be released later using release_info(addr_info).
     nl.rtnl_process_reply(addr_info);
 
-    // Now build list with interface names
+    // Now build list with interface names. The interfaces are indexed
+    // so that the addresses can be assigned in a single pass: on routers
+    // with thousands of VLAN interfaces searching all addresses for each
+    // interface takes long.
+    std::map<int, Iface*> by_index;
     for (Netlink::NetlinkMessages::iterator msg = link_info.begin();
          msg != link_info.end(); ++msg) {
-        // Required to display information about interface
-        struct ifinfomsg* interface_info = static_cast<ifinfomsg*>(NLMSG_DATA(*msg));
-        int len = (*msg)->nlmsg_len;
-        len -= NLMSG_LENGTH(sizeof(*interface_info));
-        nl.parse_rtattr(attribs_table, IFLA_RTA(interface_info), len);
-
-        // valgrind reports *possible* memory leak in the line below, but it is
-        // bogus. Nevertheless, the whole interface definition has been split
-        // into three separate steps for easier debugging.
-        const char* tmp = static_cast<const char*>(RTA_DATA(attribs_table[IFLA_IFNAME]));
-        string iface_name(tmp); // <--- bogus valgrind warning here
-        Iface iface = Iface(iface_name, interface_info->ifi_index);
-
-        iface.setHWType(interface_info->ifi_type);
-        iface.setFlags(interface_info->ifi_flags);
+        IfaceEvent link(IfaceEvent::LINK_UPDATED, 0);
+        nl.link_get(*msg, link);
+
+        Iface iface = Iface(link.name_, link.ifindex_);
+        iface.setHWType(link.hwtype_);
+        iface.setFlags(link.flags_);
 
         // Does interface have LL_ADDR?
-        if (attribs_table[IFLA_ADDRESS]) {
-            iface.setMac(static_cast<const uint8_t*>(RTA_DATA(attribs_table[IFLA_ADDRESS])),
-                         RTA_PAYLOAD(attribs_table[IFLA_ADDRESS]));
-        }
-        else {
-            // Tunnels can have no LL_ADDR. RTA_PAYLOAD doesn't check it and
-            // try to dereference it in this manner
+        if (!link.mac_.empty()) {
+            iface.setMac(&link.mac_[0], link.mac_.size());
         }
 
-        nl.ipaddrs_get(iface, addr_info);
         ifaces_.push_back(iface);
+        by_index[link.ifindex_] = &ifaces_.back();
+    }
+
+    for (Netlink::NetlinkMessages::iterator msg = addr_info.begin();
+         msg != addr_info.end(); ++msg) {
+        IfaceEvent addr(IfaceEvent::ADDRESS_ADDED, 0);
+        if (!nl.ipaddr_get(*msg, addr)) {
+            continue;
+        }
+        std::map<int, Iface*>::iterator iface = by_index.find(addr.ifindex_);
+        if (iface != by_index.end()) {
+            iface->second->addAddress(addr.addr_);
+        }
     }
 
     nl.release_list(link_info);
     nl.release_list(addr_info);
 }
 
+bool
+IfaceMgr::startIfaceMonitor(const IfaceChangeCallback& callback) {
+    stopIfaceMonitor();
+
+    const int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+    if (fd < 0) {
+        bundy_throw(Unexpected, "Failed to create NETLINK socket.");
+    }
+
+    // Set the socket to non-blocking mode so that all queued notifications
+    // can be read at once.
+    if ((fcntl(fd, F_SETFL, O_NONBLOCK) < 0) ||
+        (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &MONITOR_RCVBUF_SIZE,
+                    sizeof(MONITOR_RCVBUF_SIZE)) < 0)) {
+        close(fd);
+        bundy_throw(Unexpected, "Failed to configure netlink socket.");
+    }
+
+    sockaddr_nl local;
+    memset(&local, 0, sizeof(local));
+    local.nl_family = AF_NETLINK;
+    local.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+    if (bind(fd, convertSockAddr(&local), sizeof(local)) < 0) {
+        close(fd);
+        bundy_throw(Unexpected, "Failed to bind netlink socket.");
+    }
+
+    monitor_fd_ = fd;
+    monitor_callback_ = callback;
+    addExternalSocket(fd, boost::bind(&IfaceMgr::handleIfaceEvents, this));
+    return (true);
+}
+
+void
+IfaceMgr::handleIfaceEvents() {
+    if (monitor_fd_ < 0) {
+        return;
+    }
+
+    Netlink nl;
+    std::set<std::string> changed;
+    bool lost = false;
+    char buf[RCVBUF_SIZE];
+
+    while (true) {
+        sockaddr_nl nladdr;
+        socklen_t addr_len = sizeof(nladdr);
+        int status = recvfrom(monitor_fd_, buf, sizeof(buf), 0,
+                              convertSockAddr(&nladdr), &addr_len);
+        if (status < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == ENOBUFS) {
+                // The kernel dropped notifications because the socket
+                // buffer was full.
+                lost = true;
+                continue;
+            }
+            // EAGAIN: all queued notifications have been read.
+            break;
+        }
+
+        // Ignore the messages which don't come from the kernel.
+        if ((status == 0) || (nladdr.nl_pid != 0)) {
+            continue;
+        }
+
+        nlmsghdr* header = static_cast<nlmsghdr*>(static_cast<void*>(buf));
+        for (; NLMSG_OK(header, status); header = NLMSG_NEXT(header, status)) {
+            IfaceEvent event(IfaceEvent::LINK_UPDATED, 0);
+            switch (header->nlmsg_type) {
+            case RTM_NEWLINK:
+            case RTM_DELLINK:
+                // The bridge driver announces its ports in the same group,
+                // with the AF_BRIDGE family; they are not links being added
+                // or removed.
+                if (static_cast<const ifinfomsg*>(NLMSG_DATA(header))->
+                    ifi_family != AF_UNSPEC) {
+                    continue;
+                }
+                nl.link_get(header, event);
+                if (header->nlmsg_type == RTM_DELLINK) {
+                    event.type_ = IfaceEvent::LINK_REMOVED;
+                }
+                break;
+
+            case RTM_NEWADDR:
+            case RTM_DELADDR:
+                if (!nl.ipaddr_get(header, event)) {
+                    continue;
+                }
+                event.type_ = (header->nlmsg_type == RTM_NEWADDR ?
+                               IfaceEvent::ADDRESS_ADDED :
+                               IfaceEvent::ADDRESS_REMOVED);
+                break;
+
+            default:
+                continue;
+            }
+
+            const std::string name = applyIfaceEvent(event);
+            if (!name.empty()) {
+                changed.insert(name);
+            }
+        }
+    }
+
+    if (lost) {
+        // Compare what we know with a full dump instead.
+        Netlink::NetlinkMessages link_info;
+        Netlink::NetlinkMessages addr_info;
+        nl.rtnl_open_socket();
+        nl.rtnl_send_request(AF_PACKET, RTM_GETLINK);
+        nl.rtnl_process_reply(link_info);
+        nl.rtnl_send_request(AF_UNSPEC, RTM_GETADDR);
+        nl.rtnl_process_reply(addr_info);
+
+        std::map<int, Iface::AddressCollection> dump;
+        for (Netlink::NetlinkMessages::iterator msg = link_info.begin();
+             msg != link_info.end(); ++msg) {
+            IfaceEvent link(IfaceEvent::LINK_UPDATED, 0);
+            nl.link_get(*msg, link);
+            dump[link.ifindex_];
+            const std::string name = applyIfaceEvent(link);
+            if (!name.empty()) {
+                changed.insert(name);
+            }
+        }
+        for (Netlink::NetlinkMessages::iterator msg = addr_info.begin();
+             msg != addr_info.end(); ++msg) {
+            IfaceEvent addr(IfaceEvent::ADDRESS_ADDED, 0);
+            if (nl.ipaddr_get(*msg, addr) && (dump.count(addr.ifindex_) > 0)) {
+                dump[addr.ifindex_].push_back(addr.addr_);
+                const std::string name = applyIfaceEvent(addr);
+                if (!name.empty()) {
+                    changed.insert(name);
+                }
+            }
+        }
+        nl.release_list(link_info);
+        nl.release_list(addr_info);
+
+        // Drop the interfaces and addresses which are gone.
+        std::vector<IfaceEvent> gone;
+        for (IfaceCollection::const_iterator iface = ifaces_.begin();
+             iface != ifaces_.end(); ++iface) {
+            std::map<int, Iface::AddressCollection>::const_iterator found =
+                dump.find(iface->getIndex());
+            if (found == dump.end()) {
+                gone.push_back(IfaceEvent(IfaceEvent::LINK_REMOVED,
+                                          iface->getIndex()));
+                continue;
+            }
+            const Iface::AddressCollection& addrs = iface->getAddresses();
+            for (Iface::AddressCollection::const_iterator addr = addrs.begin();
+                 addr != addrs.end(); ++addr) {
+                if (std::find(found->second.begin(), found->second.end(),
+                              *addr) == found->second.end()) {
+                    gone.push_back(IfaceEvent(IfaceEvent::ADDRESS_REMOVED,
+                                              iface->getIndex()));
+                    gone.back().addr_ = *addr;
+                }
+            }
+        }
+        for (std::vector<IfaceEvent>::const_iterator event = gone.begin();
+             event != gone.end(); ++event) {
+            const std::string name = applyIfaceEvent(*event);
+            if (!name.empty()) {
+                changed.insert(name);
+            }
+        }
+    }
+
+    if (!changed.empty() && monitor_callback_) {
+        monitor_callback_(std::vector<std::string>(changed.begin(),
+                                                   changed.end()));
+    }
+}
+
 /// @brief sets flag_*_ fields.
 ///
 /// This implementation is OS-specific as bits have different meaning
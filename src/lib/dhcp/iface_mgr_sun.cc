@@ -147,6 +147,18 @@ bool IfaceMgr::os_receive4(struct msghdr& /*m*/, Pkt4Ptr& /*pkt*/) {
   return (true); // pretend that we have everything set up for reception.
 }
 
+bool
+IfaceMgr::startIfaceMonitor(const IfaceChangeCallback& /* callback */) {
+    // @todo The routing socket could be used to follow the changes of
+    // the interfaces on Solaris. See iface_mgr_linux.cc for working Linux
+    // implementation.
+    return (false);
+}
+
+void
+IfaceMgr::handleIfaceEvents() {
+}
+
 void
 IfaceMgr::setMatchingPacketFilter(const bool /* direct_response_desired */) {
     // @todo Currently we ignore the preference to use direct traffic
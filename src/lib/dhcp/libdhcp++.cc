@@ -29,6 +29,7 @@
 #include <util/buffer.h>
 #include <dhcp/option_definition.h>
 
+#include <boost/make_shared.hpp>
 #include <boost/shared_array.hpp>
 #include <boost/shared_ptr.hpp>
 
@@ -52,6 +53,17 @@ VendorOptionDefContainers LibDHCP::vendor4_defs_;
 
 VendorOptionDefContainers LibDHCP::vendor6_defs_;
 
+// Static tables of the option definitions, indexed by the option code.
+OptionDefTable LibDHCP::v4option_def_table_;
+
+OptionDefTable LibDHCP::v6option_def_table_;
+
+VendorOptionDefTables LibDHCP::vendor4_def_tables_;
+
+VendorOptionDefTables LibDHCP::vendor6_def_tables_;
+
+const OptionDefinitionPtr LibDHCP::no_option_def_;
+
 // Those two vendor classes are used for cable modems:
 
 /// DOCSIS3.0 compatible cable modem
@@ -86,6 +98,35 @@ LibDHCP::getOptionDefs(const Option::Universe u) {
     }
 }
 
+const OptionDefTable&
+LibDHCP::getOptionDefTable(const Option::Universe u) {
+    // Make sure that the definitions have been initialized.
+    getOptionDefs(u);
+    return (u == Option::V4 ? v4option_def_table_ : v6option_def_table_);
+}
+
+const OptionDefTable*
+LibDHCP::getVendorOptionDefTable(const Option::Universe u,
+                                 const uint32_t vendor_id) {
+    VendorOptionDefTables* tables = NULL;
+    if (u == Option::V4) {
+        if (!getVendorOption4Defs(vendor_id)) {
+            return (NULL);
+        }
+        tables = &vendor4_def_tables_;
+    } else if (u == Option::V6) {
+        if (!getVendorOption6Defs(vendor_id)) {
+            return (NULL);
+        }
+        tables = &vendor6_def_tables_;
+    } else {
+        return (NULL);
+    }
+
+    VendorOptionDefTables::const_iterator table = tables->find(vendor_id);
+    return (table == tables->end() ? NULL : &table->second);
+}
+
 const OptionDefContainer*
 LibDHCP::getVendorOption4Defs(const uint32_t vendor_id) {
 
@@ -120,38 +161,15 @@ LibDHCP::getVendorOption6Defs(const uint32_t vendor_id) {
 
 OptionDefinitionPtr
 LibDHCP::getOptionDef(const Option::Universe u, const uint16_t code) {
-    const OptionDefContainer& defs = getOptionDefs(u);
-    const OptionDefContainerTypeIndex& idx = defs.get<1>();
-    const OptionDefContainerTypeRange& range = idx.equal_range(code);
-    if (range.first != range.second) {
-        return (*range.first);
-    }
-    return (OptionDefinitionPtr());
+    return (findOptionDef(&getOptionDefTable(u), code));
 }
 
 OptionDefinitionPtr
 LibDHCP::getVendorOptionDef(const Option::Universe u, const uint32_t vendor_id,
                             const uint16_t code) {
-    const OptionDefContainer* defs = NULL;
-    if (u == Option::V4) {
-        defs = getVendorOption4Defs(vendor_id);
-    } else if (u == Option::V6) {
-        defs = getVendorOption6Defs(vendor_id);
-    }
-
-    if (!defs) {
-        // Weird universe or unknown vendor_id. We don't care. No definitions
-        // one way or another
-        // What is it anyway?
-        return (OptionDefinitionPtr());
-    }
-
-    const OptionDefContainerTypeIndex& idx = defs->get<1>();
-    const OptionDefContainerTypeRange& range = idx.equal_range(code);
-    if (range.first != range.second) {
-        return (*range.first);
-    }
-    return (OptionDefinitionPtr());
+    // For a weird universe or unknown vendor_id there is no table, so no
+    // definition is returned.
+    return (findOptionDef(getVendorOptionDefTable(u, vendor_id), code));
 }
 
 bool
@@ -212,32 +230,42 @@ size_t LibDHCP::unpackOptions6(const OptionBuffer& buf,
                                bundy::dhcp::OptionCollection& options,
                                size_t* relay_msg_offset /* = 0 */,
                                size_t* relay_msg_len /* = 0 */) {
-    size_t offset = 0;
-    size_t length = buf.size();
+    return (unpackOptions6(buf, 0, buf.size(), option_space, options,
+                           relay_msg_offset, relay_msg_len));
+}
 
-    // Get the list of standard option definitions.
-    OptionDefContainer option_defs;
+size_t LibDHCP::unpackOptions6(const OptionBuffer& buf,
+                               size_t offset, size_t length,
+                               const std::string& option_space,
+                               bundy::dhcp::OptionCollection& options,
+                               size_t* relay_msg_offset /* = 0 */,
+                               size_t* relay_msg_len /* = 0 */) {
+    if (offset > buf.size() || length > buf.size() - offset) {
+        bundy_throw(OutOfRange, "options at " << offset << " ("
+                    << length << " bytes) beyond the end of the buffer ("
+                    << buf.size() << " bytes)");
+    }
+    const size_t end = offset + length;
+
+    // Get the table of standard option definitions.
+    const OptionDefTable* option_defs = NULL;
     if (option_space == "dhcp6") {
-        option_defs = LibDHCP::getOptionDefs(Option::V6);
+        option_defs = &LibDHCP::getOptionDefTable(Option::V6);
     }
     // @todo Once we implement other option spaces we should add else clause
     // here and gather option definitions for them. For now leaving option_defs
-    // empty will imply creation of generic Option.
-
-    // Get the search index #1. It allows to search for option definitions
-    // using option code.
-    const OptionDefContainerTypeIndex& idx = option_defs.get<1>();
+    // NULL will imply creation of generic Option.
 
     // The buffer being read comprises a set of options, each starting with
     // a two-byte type code and a two-byte length field.
-    while (offset + 4 <= length) {
+    while (offset + 4 <= end) {
         uint16_t opt_type = bundy::util::readUint16(&buf[offset], 2);
         offset += 2;
 
         uint16_t opt_len = bundy::util::readUint16(&buf[offset], 2);
         offset += 2;
 
-        if (offset + opt_len > length) {
+        if (offset + opt_len > end) {
             // @todo: consider throwing exception here.
             return (offset);
         }
@@ -253,15 +281,18 @@ size_t LibDHCP::unpackOptions6(const OptionBuffer& buf,
         }
 
         if (opt_type == D6O_VENDOR_OPTS) {
-            if (offset + 4 > length) {
+            if (offset + 4 > end) {
                 // Truncated vendor-option. There is expected at least 4 bytes
                 // long enterprise-id field
                 return (offset);
             }
 
             // Parse this as vendor option
-            OptionPtr vendor_opt(new OptionVendor(Option::V6, buf.begin() + offset,
-                                                  buf.begin() + offset + opt_len));
+            OptionPtr vendor_opt =
+                boost::make_shared<OptionVendor>(Option::V6,
+                                                 buf.begin() + offset,
+                                                 buf.begin() + offset +
+                                                 opt_len);
             options.insert(std::make_pair(opt_type, vendor_opt));
 
             offset += opt_len;
@@ -269,35 +300,23 @@ size_t LibDHCP::unpackOptions6(const OptionBuffer& buf,
         }
 
 
-        // Get all definitions with the particular option code. Note that option
-        // code is non-unique within this container however at this point we
-        // expect to get one option definition with the particular code. If more
-        // are returned we report an error.
-        const OptionDefContainerTypeRange& range = idx.equal_range(opt_type);
-        // Get the number of returned option definitions for the option code.
-        size_t num_defs = distance(range.first, range.second);
+        // Get the definition of the option. The table holds at most one
+        // definition for each option code.
+        const OptionDefinitionPtr& def = findOptionDef(option_defs, opt_type);
 
         OptionPtr opt;
-        if (num_defs > 1) {
-            // Multiple options of the same code are not supported right now!
-            bundy_throw(bundy::Unexpected, "Internal error: multiple option definitions"
-                      " for option type " << opt_type << " returned. Currently it is not"
-                      " supported to initialize multiple option definitions"
-                      " for the same option code. This will be supported once"
-                      " support for option spaces is implemented");
-        } else if (num_defs == 0) {
+        if (!def) {
             // @todo Don't crash if definition does not exist because only a few
             // option definitions are initialized right now. In the future
             // we will initialize definitions for all options and we will
             // remove this elseif. For now, return generic option.
-            opt = OptionPtr(new Option(Option::V6, opt_type,
-                                       buf.begin() + offset,
-                                       buf.begin() + offset + opt_len));
+            opt = boost::make_shared<Option>(Option::V6, opt_type,
+                                             buf.begin() + offset,
+                                             buf.begin() + offset +
+                                             opt_len);
         } else {
             // The option definition has been found. Use it to create
             // the option instance from the provided buffer chunk.
-            const OptionDefinitionPtr& def = *(range.first);
-            assert(def);
             opt = def->optionFactory(Option::V6, opt_type,
                                      buf.begin() + offset,
                                      buf.begin() + offset + opt_len);
@@ -315,18 +334,14 @@ size_t LibDHCP::unpackOptions4(const OptionBuffer& buf,
                                bundy::dhcp::OptionCollection& options) {
     size_t offset = 0;
 
-    // Get the list of stdandard option definitions.
-    OptionDefContainer option_defs;
+    // Get the table of standard option definitions.
+    const OptionDefTable* option_defs = NULL;
     if (option_space == "dhcp4") {
-        option_defs = LibDHCP::getOptionDefs(Option::V4);
+        option_defs = &LibDHCP::getOptionDefTable(Option::V4);
     }
     // @todo Once we implement other option spaces we should add else clause
     // here and gather option definitions for them. For now leaving option_defs
-    // empty will imply creation of generic Option.
-
-    // Get the search index #1. It allows to search for option definitions
-    // using option code.
-    const OptionDefContainerTypeIndex& idx = option_defs.get<1>();
+    // NULL will imply creation of generic Option.
 
     // The buffer being read comprises a set of options, each starting with
     // a one-byte type code and a one-byte length field.
@@ -356,32 +371,19 @@ size_t LibDHCP::unpackOptions4(const OptionBuffer& buf,
                       << "-byte long buffer.");
         }
 
-        // Get all definitions with the particular option code. Note that option code
-        // is non-unique within this container however at this point we expect
-        // to get one option definition with the particular code. If more are
-        // returned we report an error.
-        const OptionDefContainerTypeRange& range = idx.equal_range(opt_type);
-        // Get the number of returned option definitions for the option code.
-        size_t num_defs = distance(range.first, range.second);
+        // Get the definition of the option. The table holds at most one
+        // definition for each option code.
+        const OptionDefinitionPtr& def = findOptionDef(option_defs, opt_type);
 
         OptionPtr opt;
-        if (num_defs > 1) {
-            // Multiple options of the same code are not supported right now!
-            bundy_throw(bundy::Unexpected, "Internal error: multiple option definitions"
-                      " for option type " << static_cast<int>(opt_type)
-                      << " returned. Currently it is not supported to initialize"
-                      << " multiple option definitions for the same option code."
-                      << " This will be supported once support for option spaces"
-                      << " is implemented");
-        } else if (num_defs == 0) {
-            opt = OptionPtr(new Option(Option::V4, opt_type,
-                                       buf.begin() + offset,
-                                       buf.begin() + offset + opt_len));
+        if (!def) {
+            opt = boost::make_shared<Option>(Option::V4, opt_type,
+                                             buf.begin() + offset,
+                                             buf.begin() + offset +
+                                             opt_len);
         } else {
             // The option definition has been found. Use it to create
             // the option instance from the provided buffer chunk.
-            const OptionDefinitionPtr& def = *(range.first);
-            assert(def);
             opt = def->optionFactory(Option::V4, opt_type,
                                      buf.begin() + offset,
                                      buf.begin() + offset + opt_len);
@@ -399,16 +401,10 @@ size_t LibDHCP::unpackVendorOptions6(const uint32_t vendor_id,
     size_t offset = 0;
     size_t length = buf.size();
 
-    // Get the list of option definitions for this particular vendor-id
-    const OptionDefContainer* option_defs = LibDHCP::getVendorOption6Defs(vendor_id);
-
-    // Get the search index #1. It allows to search for option definitions
-    // using option code. If there's no such vendor-id space, we're out of luck
-    // anyway.
-    const OptionDefContainerTypeIndex* idx = NULL;
-    if (option_defs) {
-        idx = &(option_defs->get<1>());
-    }
+    // Get the table of option definitions for this particular vendor-id. If
+    // there's no such vendor-id space, we're out of luck anyway.
+    const OptionDefTable* option_defs =
+        LibDHCP::getVendorOptionDefTable(Option::V6, vendor_id);
 
     // The buffer being read comprises a set of options, each starting with
     // a two-byte type code and a two-byte length field.
@@ -428,40 +424,23 @@ size_t LibDHCP::unpackVendorOptions6(const uint32_t vendor_id,
         opt.reset();
 
         // If there is a definition for such a vendor option...
-        if (idx) {
-            // Get all definitions with the particular option code. Note that option
-            // code is non-unique within this container however at this point we
-            // expect to get one option definition with the particular code. If more
-            // are returned we report an error.
-            const OptionDefContainerTypeRange& range = idx->equal_range(opt_type);
-            // Get the number of returned option definitions for the option code.
-            size_t num_defs = distance(range.first, range.second);
-
-            if (num_defs > 1) {
-                // Multiple options of the same code are not supported right now!
-                bundy_throw(bundy::Unexpected, "Internal error: multiple option definitions"
-                          " for option type " << opt_type << " returned. Currently it is not"
-                          " supported to initialize multiple option definitions"
-                          " for the same option code. This will be supported once"
-                          " support for option spaces is implemented");
-            } else if (num_defs == 1) {
-                // The option definition has been found. Use it to create
-                // the option instance from the provided buffer chunk.
-                const OptionDefinitionPtr& def = *(range.first);
-                assert(def);
-                opt = def->optionFactory(Option::V6, opt_type,
-                                         buf.begin() + offset,
-                                         buf.begin() + offset + opt_len);
-            }
+        const OptionDefinitionPtr& def = findOptionDef(option_defs, opt_type);
+        if (def) {
+            // The option definition has been found. Use it to create
+            // the option instance from the provided buffer chunk.
+            opt = def->optionFactory(Option::V6, opt_type,
+                                     buf.begin() + offset,
+                                     buf.begin() + offset + opt_len);
         }
 
         // This can happen in one of 2 cases:
         // 1. we do not have definitions for that vendor-space
         // 2. we do have definitions, but that particular option was not defined
         if (!opt) {
-            opt = OptionPtr(new Option(Option::V6, opt_type,
-                                       buf.begin() + offset,
-                                       buf.begin() + offset + opt_len));
+            opt = boost::make_shared<Option>(Option::V6, opt_type,
+                                             buf.begin() + offset,
+                                             buf.begin() + offset +
+                                             opt_len);
         }
 
         // add option to options
@@ -478,14 +457,9 @@ size_t LibDHCP::unpackVendorOptions4(const uint32_t vendor_id, const OptionBuffe
                                      bundy::dhcp::OptionCollection& options) {
     size_t offset = 0;
 
-    // Get the list of stdandard option definitions.
-    const OptionDefContainer* option_defs = LibDHCP::getVendorOption4Defs(vendor_id);
-    // Get the search index #1. It allows to search for option definitions
-    // using option code.
-    const OptionDefContainerTypeIndex* idx = NULL;
-    if (option_defs) {
-        idx = &(option_defs->get<1>());
-    }
+    // Get the table of option definitions for this particular vendor-id.
+    const OptionDefTable* option_defs =
+        LibDHCP::getVendorOptionDefTable(Option::V4, vendor_id);
 
     // The buffer being read comprises a set of options, each starting with
     // a one-byte type code and a one-byte length field.
@@ -533,38 +507,21 @@ size_t LibDHCP::unpackVendorOptions4(const uint32_t vendor_id, const OptionBuffe
             OptionPtr opt;
             opt.reset();
 
-            if (idx) {
-                // Get all definitions with the particular option code. Note that option code
-                // is non-unique within this container however at this point we expect
-                // to get one option definition with the particular code. If more are
-                // returned we report an error.
-                const OptionDefContainerTypeRange& range = idx->equal_range(opt_type);
-            // Get the number of returned option definitions for the option code.
-                size_t num_defs = distance(range.first, range.second);
-
-                if (num_defs > 1) {
-                    // Multiple options of the same code are not supported right now!
-                    bundy_throw(bundy::Unexpected, "Internal error: multiple option definitions"
-                              " for option type " << static_cast<int>(opt_type)
-                              << " returned. Currently it is not supported to initialize"
-                              << " multiple option definitions for the same option code."
-                              << " This will be supported once support for option spaces"
-                              << " is implemented");
-                } else if (num_defs == 1) {
-                    // The option definition has been found. Use it to create
-                    // the option instance from the provided buffer chunk.
-                    const OptionDefinitionPtr& def = *(range.first);
-                    assert(def);
-                    opt = def->optionFactory(Option::V4, opt_type,
-                                             buf.begin() + offset,
-                                             buf.begin() + offset + opt_len);
-                }
+            const OptionDefinitionPtr& def =
+                findOptionDef(option_defs, opt_type);
+            if (def) {
+                // The option definition has been found. Use it to create
+                // the option instance from the provided buffer chunk.
+                opt = def->optionFactory(Option::V4, opt_type,
+                                         buf.begin() + offset,
+                                         buf.begin() + offset + opt_len);
             }
 
             if (!opt) {
-                opt = OptionPtr(new Option(Option::V4, opt_type,
-                                           buf.begin() + offset,
-                                           buf.begin() + offset + opt_len));
+                opt = boost::make_shared<Option>(Option::V4, opt_type,
+                                                 buf.begin() + offset,
+                                                 buf.begin() + offset +
+                                                 opt_len);
             }
 
             options.insert(std::make_pair(opt_type, opt));
@@ -629,22 +586,46 @@ void LibDHCP::OptionFactoryRegister(Option::Universe u,
 void
 LibDHCP::initStdOptionDefs4() {
     initOptionSpace(v4option_defs_, OPTION_DEF_PARAMS4, OPTION_DEF_PARAMS_SIZE4);
+    initOptionDefTable(v4option_defs_, v4option_def_table_);
 }
 
 void
 LibDHCP::initStdOptionDefs6() {
     initOptionSpace(v6option_defs_, OPTION_DEF_PARAMS6, OPTION_DEF_PARAMS_SIZE6);
+    initOptionDefTable(v6option_defs_, v6option_def_table_);
 }
 
 void
 LibDHCP::initVendorOptsDocsis4() {
     initOptionSpace(vendor4_defs_[VENDOR_ID_CABLE_LABS], DOCSIS3_V4_DEFS, DOCSIS3_V4_DEFS_SIZE);
+    initOptionDefTable(vendor4_defs_[VENDOR_ID_CABLE_LABS],
+                       vendor4_def_tables_[VENDOR_ID_CABLE_LABS]);
 }
 
 void
 LibDHCP::initVendorOptsDocsis6() {
     vendor6_defs_[VENDOR_ID_CABLE_LABS] = OptionDefContainer();
     initOptionSpace(vendor6_defs_[VENDOR_ID_CABLE_LABS], DOCSIS3_V6_DEFS, DOCSIS3_V6_DEFS_SIZE);
+    initOptionDefTable(vendor6_defs_[VENDOR_ID_CABLE_LABS],
+                       vendor6_def_tables_[VENDOR_ID_CABLE_LABS]);
+}
+
+void
+LibDHCP::initOptionDefTable(const OptionDefContainer& defs,
+                            OptionDefTable& table) {
+    table.clear();
+    for (OptionDefContainer::const_iterator def = defs.begin();
+         def != defs.end(); ++def) {
+        const uint16_t code = (*def)->getCode();
+        if (code >= table.size()) {
+            table.resize(code + 1);
+        } else if (table[code]) {
+            table.clear();
+            bundy_throw(bundy::BadValue, "multiple option definitions for"
+                        " option code " << code);
+        }
+        table[code] = *def;
+    }
 }
 
 void initOptionSpace(OptionDefContainer& defs,
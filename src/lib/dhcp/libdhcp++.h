@@ -55,6 +55,47 @@ public:
     static OptionDefinitionPtr getOptionDef(const Option::Universe u,
                                             const uint16_t code);
 
+    /// @brief Returns the table of the standard option definitions.
+    ///
+    /// The table holds the same definitions as the collection returned
+    /// by @c getOptionDefs, indexed by the option code.
+    ///
+    /// @param u universe of the options (V4 or V6).
+    ///
+    /// @return table of option definitions.
+    static const OptionDefTable& getOptionDefTable(const Option::Universe u);
+
+    /// @brief Returns the table of the option definitions of a vendor.
+    ///
+    /// @param u universe (V4 or V6)
+    /// @param vendor_id enterprise-id of the vendor
+    /// @return table of option definitions, or NULL if there are no
+    /// definitions for the vendor.
+    static const OptionDefTable*
+    getVendorOptionDefTable(const Option::Universe u,
+                            const uint32_t vendor_id);
+
+    /// @brief Returns the definition of an option from a table.
+    ///
+    /// @param defs table of option definitions, may be NULL.
+    /// @param code option code.
+    ///
+    /// @return reference to the option definition, or to a NULL pointer
+    /// if the table has no definition for the code.
+    static const OptionDefinitionPtr& findOptionDef(const OptionDefTable* defs,
+                                                    const uint16_t code) {
+        return (defs && code < defs->size() ? (*defs)[code] : no_option_def_);
+    }
+
+    /// @brief Builds the table of the option definitions of a space.
+    ///
+    /// @param defs option definitions of the space.
+    /// @param [out] table table to build, indexed by the option code.
+    ///
+    /// @throw bundy::BadValue if two definitions have the same code.
+    static void initOptionDefTable(const OptionDefContainer& defs,
+                                   OptionDefTable& table);
+
     /// @brief Returns vendor option definition for a given vendor-id and code
     ///
     /// @param u universe (V4 or V6)
@@ -154,6 +195,35 @@ public:
                                  size_t* relay_msg_offset = 0,
                                  size_t* relay_msg_len = 0);
 
+    /// @brief Parses a part of provided buffer as DHCPv6 options.
+    ///
+    /// This is the same as the other version of @c unpackOptions6, except
+    /// that only the @c length bytes starting at @c offset are parsed,
+    /// so that the options of a part of a packet (such as the options of
+    /// a relay or of the message encapsulated in the relay-msg option) can
+    /// be parsed without copying it to a buffer of its own. The offsets
+    /// are those in the whole buffer.
+    ///
+    /// @param buf Buffer holding the options to be parsed.
+    /// @param offset offset of the first option in the buffer.
+    /// @param length length of the options.
+    /// @param option_space A name of the option space which holds definitions
+    /// of to be used to parse options in the packets.
+    /// @param options Reference to option container. Options will be
+    ///        put here.
+    /// @param relay_msg_offset If specified, offset in the buffer of the
+    ///        beginning of relay_msg option data will be stored in it.
+    /// @param relay_msg_len If specified, length of the relay_msg option
+    ///        will be stored in it.
+    /// @return offset in the buffer of the first byte after last parsed
+    ///         option
+    static size_t unpackOptions6(const OptionBuffer& buf,
+                                 size_t offset, size_t length,
+                                 const std::string& option_space,
+                                 bundy::dhcp::OptionCollection& options,
+                                 size_t* relay_msg_offset = 0,
+                                 size_t* relay_msg_len = 0);
+
     /// Registers factory method that produces options of specific option types.
     ///
     /// @throw bundy::BadValue if provided the type is already registered, has
@@ -251,6 +321,21 @@ private:
 
     /// Container for v6 vendor option definitions
     static VendorOptionDefContainers vendor6_defs_;
+
+    /// Table of DHCPv4 option definitions.
+    static OptionDefTable v4option_def_table_;
+
+    /// Table of DHCPv6 option definitions.
+    static OptionDefTable v6option_def_table_;
+
+    /// Tables of v4 vendor option definitions
+    static VendorOptionDefTables vendor4_def_tables_;
+
+    /// Tables of v6 vendor option definitions
+    static VendorOptionDefTables vendor6_def_tables_;
+
+    /// NULL definition returned by @c findOptionDef
+    static const OptionDefinitionPtr no_option_def_;
 };
 
 }
@@ -85,13 +85,15 @@ Option::check() {
 
 void Option::pack(bundy::util::OutputBuffer& buf) {
     // Write a header.
-    packHeader(buf);
+    const size_t header_pos = packHeaderStart(buf);
     // Write data.
     if (!data_.empty()) {
         buf.writeData(&data_[0], data_.size());
     }
     // Write sub-options.
     packOptions(buf);
+    // And the length of all of it.
+    packLength(buf, header_pos);
 }
 
 void
@@ -114,6 +116,38 @@ Option::packHeader(bundy::util::OutputBuffer& buf) {
     }
 }
 
+size_t
+Option::packHeaderStart(bundy::util::OutputBuffer& buf) {
+    const size_t header_pos = buf.getLength();
+    if (universe_ == V4) {
+        buf.writeUint8(type_);
+        buf.writeUint8(0);
+    } else {
+        buf.writeUint16(type_);
+        buf.writeUint16(0);
+    }
+    return (header_pos);
+}
+
+void
+Option::packLength(bundy::util::OutputBuffer& buf, const size_t header_pos) {
+    const size_t length = buf.getLength() - header_pos;
+    if (universe_ == V4) {
+        if (length > 255) {
+            bundy_throw(OutOfRange, "DHCPv4 Option " << type_ << " is too big. "
+                      << "At most 255 bytes are supported.");
+        }
+        buf.writeUint8At(length - getHeaderLen(), header_pos + 1);
+
+    } else {
+        if (length - getHeaderLen() > 65535) {
+            bundy_throw(OutOfRange, "DHCPv6 Option " << type_ << " is too big. "
+                      << "At most 65535 bytes of data are supported.");
+        }
+        buf.writeUint16At(length - getHeaderLen(), header_pos + 2);
+    }
+}
+
 void
 Option::packOptions(bundy::util::OutputBuffer& buf) {
     LibDHCP::packOptions(buf, options_);
@@ -383,6 +383,29 @@ protected:
     /// @param [out] buf output buffer.
     void packHeader(bundy::util::OutputBuffer& buf);
 
+    /// @brief Store option's header with the length to be filled in later.
+    ///
+    /// Unlike @c packHeader, this function doesn't call @c len(), which
+    /// sums the lengths of all sub-options recursively. The pack function
+    /// of an option which may carry sub-options writes its data and
+    /// sub-options after this header and then calls @c packLength, so the
+    /// option tree is walked once.
+    ///
+    /// @param [out] buf output buffer.
+    ///
+    /// @return position of the header in the buffer, to be passed to
+    /// @c packLength.
+    size_t packHeaderStart(bundy::util::OutputBuffer& buf);
+
+    /// @brief Fill in the length of the option packed after its header.
+    ///
+    /// @param [out] buf output buffer holding the option.
+    /// @param header_pos position of the header returned by
+    /// @c packHeaderStart.
+    ///
+    /// @throw bundy::OutOfRange if the option is too big to be stored.
+    void packLength(bundy::util::OutputBuffer& buf, const size_t header_pos);
+
     /// @brief Store sub options in a buffer.
     ///
     /// This method stores all sub-options defined for a particular
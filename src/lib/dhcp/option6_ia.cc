@@ -56,13 +56,13 @@ Option6IA::Option6IA(uint16_t type, OptionBufferConstIter begin,
 }
 
 void Option6IA::pack(bundy::util::OutputBuffer& buf) {
-    buf.writeUint16(type_);
-    buf.writeUint16(len() - OPTION6_HDR_LEN);
+    const size_t header_pos = packHeaderStart(buf);
     buf.writeUint32(iaid_);
     buf.writeUint32(t1_);
     buf.writeUint32(t2_);
 
     packOptions(buf);
+    packLength(buf, header_pos);
 }
 
 void Option6IA::unpack(OptionBufferConstIter begin,
@@ -50,15 +50,13 @@ Option6IAAddr::Option6IAAddr(uint32_t type, OptionBuffer::const_iterator begin,
 
 void Option6IAAddr::pack(bundy::util::OutputBuffer& buf) {
 
-    buf.writeUint16(type_);
-
-    // len() returns complete option length. len field contains
-    // length without 4-byte option header
-    buf.writeUint16(len() - getHeaderLen());
-
     if (!addr_.isV6()) {
         bundy_throw(bundy::BadValue, addr_ << " is not an IPv6 address");
     }
+
+    // The length is filled in once the suboptions are stored.
+    const size_t header_pos = packHeaderStart(buf);
+
     buf.writeData(&addr_.toBytes()[0], bundy::asiolink::V6ADDRESS_LEN);
 
     buf.writeUint32(preferred_);
@@ -66,6 +64,7 @@ void Option6IAAddr::pack(bundy::util::OutputBuffer& buf) {
 
     // parse suboption (there shouldn't be any for IAADDR)
     packOptions(buf);
+    packLength(buf, header_pos);
 }
 
 void Option6IAAddr::unpack(OptionBuffer::const_iterator begin,
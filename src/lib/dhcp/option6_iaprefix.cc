@@ -54,11 +54,8 @@ void Option6IAPrefix::pack(bundy::util::OutputBuffer& buf) {
         bundy_throw(bundy::BadValue, addr_ << " is not an IPv6 address");
     }
 
-    buf.writeUint16(type_);
-
-    // len() returns complete option length. len field contains
-    // length without 4-byte option header
-    buf.writeUint16(len() - getHeaderLen());
+    // The length is filled in once the suboptions are stored.
+    const size_t header_pos = packHeaderStart(buf);
 
     buf.writeUint32(preferred_);
     buf.writeUint32(valid_);
@@ -68,6 +65,7 @@ void Option6IAPrefix::pack(bundy::util::OutputBuffer& buf) {
 
     // store encapsulated options (the only defined so far is PD_EXCLUDE)
     packOptions(buf);
+    packLength(buf, header_pos);
 }
 
 void Option6IAPrefix::unpack(OptionBuffer::const_iterator begin,
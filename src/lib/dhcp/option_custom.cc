@@ -366,8 +366,9 @@ OptionCustom::dataFieldToText(const OptionDataType data_type,
 void
 OptionCustom::pack(bundy::util::OutputBuffer& buf) {
 
-    // Pack DHCP header (V4 or V6).
-    packHeader(buf);
+    // Pack DHCP header (V4 or V6). The length is filled in once the
+    // suboptions are stored.
+    const size_t header_pos = packHeaderStart(buf);
 
     // Write data from buffers.
     for (std::vector<OptionBuffer>::const_iterator it = buffers_.begin();
@@ -382,6 +383,7 @@ OptionCustom::pack(bundy::util::OutputBuffer& buf) {
 
     // Write suboptions.
     packOptions(buf);
+    packLength(buf, header_pos);
 }
 
 
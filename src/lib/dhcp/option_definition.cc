@@ -136,7 +136,8 @@ OptionDefinition::optionFactory(Option::Universe u, uint16_t type,
             if (getEncapsulatedSpace().empty()) {
                     return (factoryEmpty(u, type));
             } else {
-                return (OptionPtr(new OptionCustom(*this, u, begin, end)));
+                return (boost::make_shared<OptionCustom>(*this, u, begin,
+                                                         end));
             }
 
         case OPT_BINARY_TYPE:
@@ -198,13 +199,13 @@ OptionDefinition::optionFactory(Option::Universe u, uint16_t type,
             break;
 
         case OPT_STRING_TYPE:
-            return (OptionPtr(new OptionString(u, type, begin, end)));
+            return (boost::make_shared<OptionString>(u, type, begin, end));
 
         default:
             // Do nothing. We will return generic option a few lines down.
             ;
         }
-        return (OptionPtr(new OptionCustom(*this, u, begin, end)));
+        return (boost::make_shared<OptionCustom>(*this, u, begin, end));
     } catch (const Exception& ex) {
         bundy_throw(InvalidOptionValue, ex.what());
     }
@@ -568,33 +569,27 @@ OptionPtr
 OptionDefinition::factoryAddrList4(uint16_t type,
                                   OptionBufferConstIter begin,
                                   OptionBufferConstIter end) {
-    boost::shared_ptr<Option4AddrLst> option(new Option4AddrLst(type, begin,
-                                                                end));
-    return (option);
+    return (boost::make_shared<Option4AddrLst>(type, begin, end));
 }
 
 OptionPtr
 OptionDefinition::factoryAddrList6(uint16_t type,
                                    OptionBufferConstIter begin,
                                    OptionBufferConstIter end) {
-    boost::shared_ptr<Option6AddrLst> option(new Option6AddrLst(type, begin,
-                                                                end));
-    return (option);
+    return (boost::make_shared<Option6AddrLst>(type, begin, end));
 }
 
 
 OptionPtr
 OptionDefinition::factoryEmpty(Option::Universe u, uint16_t type) {
-    OptionPtr option(new Option(u, type));
-    return (option);
+    return (boost::make_shared<Option>(u, type));
 }
 
 OptionPtr
 OptionDefinition::factoryGeneric(Option::Universe u, uint16_t type,
                                  OptionBufferConstIter begin,
                                  OptionBufferConstIter end) {
-    OptionPtr option(new Option(u, type, begin, end));
-    return (option);
+    return (boost::make_shared<Option>(u, type, begin, end));
 }
 
 OptionPtr
@@ -606,8 +601,7 @@ OptionDefinition::factoryIA6(uint16_t type,
                   << " expected at least " << Option6IA::OPTION6_IA_LEN
                   << " bytes");
     }
-    boost::shared_ptr<Option6IA> option(new Option6IA(type, begin, end));
-    return (option);
+    return (boost::make_shared<Option6IA>(type, begin, end));
 }
 
 OptionPtr
@@ -619,9 +613,7 @@ OptionDefinition::factoryIAAddr6(uint16_t type,
                   "input option buffer has invalid size, expected at least "
                   << Option6IAAddr::OPTION6_IAADDR_LEN << " bytes");
     }
-    boost::shared_ptr<Option6IAAddr> option(new Option6IAAddr(type, begin,
-                                                              end));
-    return (option);
+    return (boost::make_shared<Option6IAAddr>(type, begin, end));
 }
 
 OptionPtr
@@ -633,9 +625,7 @@ OptionDefinition::factoryIAPrefix6(uint16_t type,
                   "input option buffer has invalid size, expected at least "
                   << Option6IAPrefix::OPTION6_IAPREFIX_LEN << " bytes");
     }
-    boost::shared_ptr<Option6IAPrefix> option(new Option6IAPrefix(type, begin,
-                                                                  end));
-    return (option);
+    return (boost::make_shared<Option6IAPrefix>(type, begin, end));
 }
 
 OptionPtr
@@ -666,24 +656,26 @@ OptionDefinition::factorySpecialFormatOption(Option::Universe u,
         } else if (getCode() == D6O_CLIENT_FQDN && haveClientFqdnFormat()) {
             // FQDN option requires special processing. Thus, there is
             // a specialized class to handle it.
-            return (OptionPtr(new Option6ClientFqdn(begin, end)));
+            return (boost::make_shared<Option6ClientFqdn>(begin, end));
         } else if (getCode() == D6O_VENDOR_OPTS && haveVendor6Format()) {
             // Vendor-Specific Information (option code 17)
-            return (OptionPtr(new OptionVendor(Option::V6, begin, end)));
+            return (boost::make_shared<OptionVendor>(Option::V6, begin, end));
         } else if (getCode() == D6O_VENDOR_CLASS && haveVendorClass6Format()) {
             // Vendor Class (option code 16).
-            return (OptionPtr(new OptionVendorClass(Option::V6, begin, end)));
+            return (boost::make_shared<OptionVendorClass>(Option::V6, begin,
+                                                          end));
         }
     } else {
         if ((getCode() == DHO_FQDN) && haveFqdn4Format()) {
-            return (OptionPtr(new Option4ClientFqdn(begin, end)));
+            return (boost::make_shared<Option4ClientFqdn>(begin, end));
         } else if ((getCode() == DHO_VIVCO_SUBOPTIONS) &&
                    haveVendorClass4Format()) {
             // V-I Vendor Class (option code 124).
-            return (OptionPtr(new OptionVendorClass(Option::V4, begin, end)));
+            return (boost::make_shared<OptionVendorClass>(Option::V4, begin,
+                                                          end));
         } else if (getCode() == DHO_VIVSO_SUBOPTIONS && haveVendor4Format()) {
             // Vendor-Specific Information (option code 125).
-            return (OptionPtr(new OptionVendor(Option::V4, begin, end)));
+            return (boost::make_shared<OptionVendor>(Option::V4, begin, end));
 
         }
     }
@@ -18,12 +18,14 @@
 #include <dhcp/option.h>
 #include <dhcp/option_data_types.h>
 
+#include <boost/make_shared.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/mem_fun.hpp>
 #include <boost/multi_index/sequenced_index.hpp>
 #include <boost/multi_index_container.hpp>
 #include <boost/shared_ptr.hpp>
 #include <map>
+#include <vector>
 
 namespace bundy {
 namespace dhcp {
@@ -513,7 +515,7 @@ public:
                                     OptionBufferConstIter begin,
                                     OptionBufferConstIter end,
                                     UnpackOptionsCallback callback) {
-        OptionPtr option(new OptionInt<T>(u, type, 0));
+        OptionPtr option(boost::make_shared<OptionInt<T> >(u, type, 0));
         option->setEncapsulatedSpace(encapsulated_space);
         option->setCallback(callback);
         option->unpack(begin, end);
@@ -534,7 +536,8 @@ public:
                                          uint16_t type,
                                          OptionBufferConstIter begin,
                                          OptionBufferConstIter end) {
-        OptionPtr option(new OptionIntArray<T>(u, type, begin, end));
+        OptionPtr option(boost::make_shared<OptionIntArray<T> >(u, type, begin,
+                                                                end));
         return (option);
     }
 
@@ -696,6 +699,18 @@ typedef boost::shared_ptr<OptionDefContainer> OptionDefContainerPtr;
 /// Container that holds various vendor option containers
 typedef std::map<uint32_t, OptionDefContainer> VendorOptionDefContainers;
 
+/// @brief Option definitions of an option space indexed by option code.
+///
+/// The element at the position of an option code holds the definition of
+/// the option, or NULL if there is none. The table ends after the highest
+/// code having a definition. It is used where the definitions are looked
+/// up for each option parsed, as indexing it is cheaper than searching
+/// @c OptionDefContainer.
+typedef std::vector<OptionDefinitionPtr> OptionDefTable;
+
+/// Tables of the option definitions of various vendors.
+typedef std::map<uint32_t, OptionDefTable> VendorOptionDefTables;
+
 /// Type of the index #1 - option type.
 typedef OptionDefContainer::nth_index<1>::type OptionDefContainerTypeIndex;
 /// Pair of iterators to represent the range of options definitions
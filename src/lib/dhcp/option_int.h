@@ -90,8 +90,9 @@ public:
     /// equal to 1, 2 or 4 bytes. The data type is not checked in this function
     /// because it is checked in a constructor.
     void pack(bundy::util::OutputBuffer& buf) {
-        // Pack option header.
-        packHeader(buf);
+        // Pack option header. The length is filled in once the suboptions
+        // are stored.
+        const size_t header_pos = packHeaderStart(buf);
         // Depending on the data type length we use different utility functions
         // writeUint16 or writeUint32 which write the data in the network byte
         // order to the provided buffer. The same functions can be safely used
@@ -111,6 +112,7 @@ public:
             bundy_throw(dhcp::InvalidDataType, "non-integer type");
         }
         packOptions(buf);
+        packLength(buf, header_pos);
     }
 
     /// @brief Parses received buffer
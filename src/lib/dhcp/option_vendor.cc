@@ -30,21 +30,27 @@ OptionVendor::OptionVendor(Option::Universe u, OptionBufferConstIter begin,
 
 
 void OptionVendor::pack(bundy::util::OutputBuffer& buf) {
-    packHeader(buf);
+    const size_t header_pos = packHeaderStart(buf);
 
     // Store vendor-id
     buf.writeUint32(vendor_id_);
 
-    // The format is slightly different for v4
+    // The format is slightly different for v4: data-len follows the
+    // vendor-id. It is filled in once the suboptions are stored.
+    const size_t data_len_pos = buf.getLength();
     if (universe_ == Option::V4) {
-        // Calculate and store data-len as follows:
-        // data-len = total option length - header length
-        //            - enterprise id field length - data-len field size
-        buf.writeUint8(len() - getHeaderLen() -
-                       sizeof(uint32_t) - sizeof(uint8_t));
+        buf.writeUint8(0);
     }
 
     packOptions(buf);
+
+    if (universe_ == Option::V4) {
+        // data-len = total option length - header length
+        //            - enterprise id field length - data-len field size
+        buf.writeUint8At(buf.getLength() - data_len_pos - sizeof(uint8_t),
+                         data_len_pos);
+    }
+    packLength(buf, header_pos);
 }
 
 void OptionVendor::unpack(OptionBufferConstIter begin,
@@ -33,7 +33,8 @@ namespace dhcp {
 const IOAddress DEFAULT_ADDRESS("0.0.0.0");
 
 Pkt4::Pkt4(uint8_t msg_type, uint32_t transid)
-     :buffer_out_(DHCPV4_PKT_HDR_LEN),
+     :buffer_out_(buffer_storage_, sizeof(buffer_storage_)),
+      lazy_unpack_(false),
       local_addr_(DEFAULT_ADDRESS),
       remote_addr_(DEFAULT_ADDRESS),
       iface_(""),
@@ -59,6 +60,7 @@ Pkt4::Pkt4(uint8_t msg_type, uint32_t transid)
 
 Pkt4::Pkt4(const uint8_t* data, size_t len)
      :buffer_out_(0), // not used, this is RX packet
+      lazy_unpack_(false),
       local_addr_(DEFAULT_ADDRESS),
       remote_addr_(DEFAULT_ADDRESS),
       iface_(""),
@@ -93,6 +95,8 @@ size_t
 Pkt4::len() {
     size_t length = DHCPV4_PKT_HDR_LEN; // DHCPv4 header
 
+    unpackPendingOptions(true);
+
     // ... and sum of lengths of all options
     for (OptionCollection::const_iterator it = options_.begin();
          it != options_.end();
@@ -152,6 +156,7 @@ Pkt4::pack() {
         // write DHCP magic cookie
         buffer_out_.writeUint32(DHCP_OPTIONS_COOKIE);
 
+        unpackPendingOptions(true);
         LibDHCP::packOptions(buffer_out_, options_);
 
         // add END option that indicates end of options
@@ -213,6 +218,12 @@ Pkt4::unpack() {
       bundy_throw(Unexpected, "Invalid or missing DHCP magic cookie");
     }
 
+    if (lazy_unpack_) {
+        indexOptions(buffer_in.getPosition());
+        check();
+        return;
+    }
+
     size_t opts_len = buffer_in.getLength() - buffer_in.getPosition();
     vector<uint8_t> opts_buffer;
 
@@ -234,6 +245,84 @@ Pkt4::unpack() {
     check();
 }
 
+void
+Pkt4::indexOptions(size_t offset) {
+    pending_options_.clear();
+
+    // The same checks are done as when the options are parsed by
+    // LibDHCP::unpackOptions4, so as a packet which would be rejected
+    // isn't accepted only because its options aren't parsed.
+    while (offset + 1 <= data_.size()) {
+        PendingOption opt;
+        opt.offset_ = offset;
+        opt.type_ = data_[offset++];
+
+        // DHO_END is a special, one octet long option
+        if (opt.type_ == DHO_END) {
+            return;
+        }
+
+        // DHO_PAD is just a padding after DHO_END. Let's continue parsing
+        // in case we receive a message without DHO_END.
+        if (opt.type_ == DHO_PAD) {
+            continue;
+        }
+
+        if (offset + 1 >= data_.size()) {
+            bundy_throw(OutOfRange, "Attempt to parse truncated option "
+                      << static_cast<int>(opt.type_));
+        }
+
+        opt.len_ = data_[offset++];
+        if (offset + opt.len_ > data_.size()) {
+            bundy_throw(OutOfRange, "Option parse failed. Tried to parse "
+                      << offset + opt.len_ << " bytes from "
+                      << data_.size() << "-byte long buffer.");
+        }
+
+        pending_options_.push_back(opt);
+        offset += opt.len_;
+    }
+}
+
+void
+Pkt4::unpackPendingOptions(const bool all, const uint8_t type) const {
+    if (pending_options_.empty()) {
+        return;
+    }
+
+    // Take out the options to be parsed, keeping their order.
+    std::vector<PendingOption> selected;
+    std::vector<PendingOption>::iterator last = pending_options_.begin();
+    for (std::vector<PendingOption>::const_iterator opt =
+             pending_options_.begin(); opt != pending_options_.end(); ++opt) {
+        if (all || (opt->type_ == type)) {
+            selected.push_back(*opt);
+        } else {
+            *last++ = *opt;
+        }
+    }
+    pending_options_.erase(last, pending_options_.end());
+
+    for (std::vector<PendingOption>::const_iterator opt = selected.begin();
+         opt != selected.end(); ++opt) {
+        // The data_ is public, so make sure it still holds the option.
+        if (opt->offset_ + 2 + opt->len_ > data_.size()) {
+            continue;
+        }
+        // The parsing functions take a buffer holding the options on the
+        // wire, so the buffer holds just this option.
+        OptionBuffer opt_buffer(data_.begin() + opt->offset_,
+                                data_.begin() + opt->offset_ + 2 +
+                                opt->len_);
+        if (callback_.empty()) {
+            LibDHCP::unpackOptions4(opt_buffer, "dhcp4", options_);
+        } else {
+            callback_(opt_buffer, "dhcp4", options_, NULL, NULL);
+        }
+    }
+}
+
 void Pkt4::check() {
     uint8_t msg_type = getType();
     if (msg_type > DHCPLEASEACTIVE) {
@@ -284,6 +373,8 @@ Pkt4::toText() {
         << ":" << remote_port_ << ", msgtype=" << static_cast<int>(getType())
         << ", transid=0x" << hex << transid_ << dec << endl;
 
+    unpackPendingOptions(true);
+
     for (bundy::dhcp::OptionCollection::iterator opt=options_.begin();
          opt != options_.end();
          ++opt) {
@@ -444,6 +535,7 @@ Pkt4::addOption(boost::shared_ptr<Option> opt) {
 
 boost::shared_ptr<bundy::dhcp::Option>
 Pkt4::getOption(uint8_t type) const {
+    unpackPendingOptions(false, type);
     OptionCollection::const_iterator x = options_.find(type);
     if (x != options_.end()) {
         return (*x).second;
@@ -451,8 +543,30 @@ Pkt4::getOption(uint8_t type) const {
     return boost::shared_ptr<bundy::dhcp::Option>(); // NULL
 }
 
+bool
+Pkt4::getPendingOptionData(uint8_t type, const uint8_t** data,
+                           size_t* len) const {
+    if (pending_options_.empty() || options_.count(type) > 0) {
+        return (false);
+    }
+    for (std::vector<PendingOption>::const_iterator opt =
+             pending_options_.begin(); opt != pending_options_.end(); ++opt) {
+        if (opt->type_ == type) {
+            // The data_ is public, so make sure it still holds the option.
+            if (opt->offset_ + 2 + opt->len_ > data_.size()) {
+                return (false);
+            }
+            *data = &data_[0] + opt->offset_ + 2;
+            *len = opt->len_;
+            return (true);
+        }
+    }
+    return (false);
+}
+
 bool
 Pkt4::delOption(uint8_t type) {
+    unpackPendingOptions(false, type);
     bundy::dhcp::OptionCollection::iterator x = options_.find(type);
     if (x != options_.end()) {
         options_.erase(x);
@@ -486,14 +600,12 @@ Pkt4::isRelayed() const {
 }
 
 bool Pkt4::inClass(const bundy::dhcp::ClientClass& client_class) {
-    return (classes_.find(client_class) != classes_.end());
+    return (classes_.contains(client_class));
 }
 
 void
 Pkt4::addClass(const bundy::dhcp::ClientClass& client_class) {
-    if (classes_.find(client_class) == classes_.end()) {
-        classes_.insert(client_class);
-    }
+    classes_.insert(client_class);
 }
 
 } // end of namespace bundy::dhcp
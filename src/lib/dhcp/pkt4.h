@@ -50,6 +50,15 @@ public:
     /// specifies DHCPv4 packet header length (fixed part)
     const static size_t DHCPV4_PKT_HDR_LEN = 236;
 
+    /// @brief Length of the options field every client must accept.
+    ///
+    /// As per RFC 2131, section 2, this includes the magic cookie. With
+    /// the fixed part, this fills the 576 byte datagram every client must
+    /// accept. The message to be sent is packed into storage of this size
+    /// held by the packet itself, so no memory is allocated while building
+    /// typical responses.
+    const static size_t DHCPV4_MIN_OPTIONS_LEN = 312;
+
     /// Mask for the value of flags field in the DHCPv4 message
     /// to check whether client requested broadcast response.
     const static uint16_t FLAG_BROADCAST_MASK = 0x8000;
@@ -85,7 +94,9 @@ public:
     /// Parses received packet, stored in on-wire format in bufferIn_.
     ///
     /// Will create a collection of option objects that will
-    /// be stored in options_ container.
+    /// be stored in options_ container. If lazy unpacking is enabled,
+    /// only the location of each option is recorded, see
+    /// @ref setLazyUnpack.
     ///
     /// Method with throw exception if packet parsing fails.
     void unpack();
@@ -328,11 +339,32 @@ public:
 
     /// @brief Returns an option of specified type.
     ///
+    /// If the packet has been unpacked lazily, the options of the
+    /// specified type are parsed first.
+    ///
     /// @return returns option of requested type (or NULL)
     ///         if no such option is present
+    /// @throw An exception thrown by the option parsing function if the
+    /// option is parsed and it is malformed.
     boost::shared_ptr<Option>
     getOption(uint8_t opt_type) const;
 
+    /// @brief Returns the data of an option which hasn't been parsed yet.
+    ///
+    /// If the packet has been unpacked lazily and the option of the
+    /// specified type returned by @ref getOption would be parsed from the
+    /// received data, this returns the data of the option (without the
+    /// option header) from the received data, without parsing it.
+    ///
+    /// @param opt_type option type.
+    /// @param [out] data set to point to the option data in @c data_.
+    /// @param [out] len set to the length of the option data.
+    /// @return true if the data was found, false if the option isn't in
+    /// the packet or it has already been parsed.
+    bool
+    getPendingOptionData(uint8_t opt_type, const uint8_t** data,
+                         size_t* len) const;
+
     /// @brief Deletes specified option
     /// @param type option type to be deleted
     /// @return true if anything was deleted, false otherwise
@@ -512,6 +544,27 @@ public:
         callback_ = callback;
     }
 
+    /// @brief Enables or disables lazy unpacking of options.
+    ///
+    /// When enabled, @ref unpack only checks that the options are well
+    /// formed on the wire and records where each of them starts. An option
+    /// is parsed, using the callback if it is installed, when it is first
+    /// requested with @ref getOption or when all options are needed, e.g.
+    /// by @ref pack. Options which are never requested are never parsed,
+    /// so errors in their contents are not reported.
+    ///
+    /// @param lazy true if the options should be unpacked lazily.
+    void setLazyUnpack(const bool lazy) {
+        lazy_unpack_ = lazy;
+    }
+
+    /// @brief Checks if the options are unpacked lazily.
+    ///
+    /// @return true if lazy unpacking is enabled.
+    bool getLazyUnpack() const {
+        return (lazy_unpack_);
+    }
+
     /// @brief Update packet timestamp.
     ///
     /// Updates packet timestamp. This method is invoked
@@ -534,6 +587,11 @@ public:
     /// performance).
     bundy::util::OutputBuffer buffer_out_;
 
+    /// @brief Storage of @c buffer_out_ for a message to be sent.
+    ///
+    /// The buffer moves to allocated memory if the message doesn't fit.
+    uint8_t buffer_storage_[DHCPV4_PKT_HDR_LEN + DHCPV4_MIN_OPTIONS_LEN];
+
     /// @brief That's the data of input buffer used in RX packet.
     ///
     /// @note Note that InputBuffer does not store the data itself, but just
@@ -600,6 +658,43 @@ private:
                          const std::vector<uint8_t>& mac_addr,
                          HWAddrPtr& hw_addr);
 
+    /// @brief Records the location of the options in the received data.
+    ///
+    /// This is used instead of parsing the options when they are unpacked
+    /// lazily.
+    ///
+    /// @param offset offset of the first option in data_.
+    /// @throw bundy::OutOfRange if an option is truncated.
+    void indexOptions(size_t offset);
+
+    /// @brief Parses options which have been unpacked lazily.
+    ///
+    /// The options are removed from @c pending_options_ before they are
+    /// parsed, so a malformed option is reported only once.
+    ///
+    /// @param all true if all the options should be parsed, false if only
+    /// the options of the specified type.
+    /// @param type type of the options to be parsed if @c all is false.
+    void unpackPendingOptions(const bool all, const uint8_t type = 0) const;
+
+    /// @brief Location of an option which hasn't been parsed yet.
+    struct PendingOption {
+        /// Offset of the option, including its type and length, in data_.
+        uint32_t offset_;
+        /// Option type.
+        uint8_t type_;
+        /// Length of the option data.
+        uint8_t len_;
+    };
+
+    /// @brief Options which haven't been parsed yet.
+    ///
+    /// The options are held in the order they appear in the packet.
+    mutable std::vector<PendingOption> pending_options_;
+
+    /// Indicates whether the options are unpacked lazily.
+    bool lazy_unpack_;
+
 protected:
 
     /// converts DHCP message type to BOOTP op type
@@ -692,8 +787,9 @@ protected:
     /// @ref perfdhcp::PerfPkt4. The impact on derived classes'
     /// behavior must be taken into consideration before making
     /// changes to this member such as access scope restriction or
-    /// data format change etc.
-    bundy::dhcp::OptionCollection options_;
+    /// data format change etc. The options unpacked lazily are added
+    /// to this member when they are parsed.
+    mutable bundy::dhcp::OptionCollection options_;
 
     /// packet timestamp
     boost::posix_time::ptime timestamp_;
@@ -28,7 +28,8 @@ namespace bundy {
 namespace dhcp {
 
 Pkt6::RelayInfo::RelayInfo()
-    :msg_type_(0), hop_count_(0), linkaddr_("::"), peeraddr_("::"), relay_msg_len_(0) {
+    :msg_type_(0), hop_count_(0), linkaddr_("::"), peeraddr_("::"), relay_msg_len_(0),
+     relay_msg_offset_(0) {
     // interface_id_, subscriber_id_, remote_id_ initialized to NULL
     // echo_options_ initialized to empty collection
 }
@@ -205,24 +206,24 @@ Pkt6::packUDP() {
         // is this a relayed packet?
         if (!relay_info_.empty()) {
 
-            // calculate size needed for each relay (if there is only one relay,
-            // then it will be equal to "regular" length + relay-forw header +
-            // size of relay-msg option header + possibly size of interface-id
-            // option (if present). If there is more than one relay, the whole
-            // process is called iteratively for each relay.
-            calculateRelaySizes();
-
-            // Now for each relay, we need to...
+            // The relays are written from the outermost one, each with the
+            // header of its relay-msg option, and the length of the
+            // relay-msg options is filled in once the message they
+            // encapsulate has been written. This way the message is written
+            // in a single pass, without calculating the length of all
+            // options of every encapsulation level first (see
+            // calculateRelaySizes()).
+            uint8_t addr[bundy::asiolink::V6ADDRESS_LEN];
             for (vector<RelayInfo>::iterator relay = relay_info_.begin();
                  relay != relay_info_.end(); ++relay) {
 
                 // build relay-forw/relay-repl header (see RFC3315, section 7)
                 buffer_out_.writeUint8(relay->msg_type_);
                 buffer_out_.writeUint8(relay->hop_count_);
-                buffer_out_.writeData(&(relay->linkaddr_.toBytes()[0]),
-                                     bundy::asiolink::V6ADDRESS_LEN);
-                buffer_out_.writeData(&relay->peeraddr_.toBytes()[0],
-                                     bundy::asiolink::V6ADDRESS_LEN);
+                relay->linkaddr_.toBytes(addr);
+                buffer_out_.writeData(addr, sizeof(addr));
+                relay->peeraddr_.toBytes(addr);
+                buffer_out_.writeData(addr, sizeof(addr));
 
                 // store every option in this relay scope. Usually that will be
                 // only interface-id, but occasionally other options may be
@@ -238,9 +239,11 @@ Pkt6::packUDP() {
                 // and include header relay-msg option. Its payload will be
                 // generated in the next iteration (if there are more relays)
                 // or outside the loop (if there are no more relays and the
-                // payload is a direct message)
+                // payload is a direct message). For now, its length holds
+                // the offset of the payload.
                 buffer_out_.writeUint16(D6O_RELAY_MSG);
-                buffer_out_.writeUint16(relay->relay_msg_len_);
+                buffer_out_.skip(2);
+                relay->relay_msg_len_ = buffer_out_.getLength();
             }
 
         }
@@ -254,6 +257,15 @@ Pkt6::packUDP() {
 
         // the rest are options
         LibDHCP::packOptions(buffer_out_, options_);
+
+        // Each relay-msg option extends to the end of the message.
+        for (vector<RelayInfo>::iterator relay = relay_info_.begin();
+             relay != relay_info_.end(); ++relay) {
+            const size_t payload_offset = relay->relay_msg_len_;
+            relay->relay_msg_len_ = buffer_out_.getLength() - payload_offset;
+            buffer_out_.writeUint16At(relay->relay_msg_len_,
+                                      payload_offset - 2);
+        }
     }
     catch (const Exception& e) {
        // An exception is thrown and message will be written to Logger
@@ -302,7 +314,7 @@ Pkt6::unpackUDP() {
     case DHCPV6_INFORMATION_REQUEST:
     default: // assume that uknown messages are not using relay format
         {
-            return (unpackMsg(data_.begin(), data_.end()));
+            return (unpackMsg(0, data_.size()));
         }
     case DHCPV6_RELAY_FORW:
     case DHCPV6_RELAY_REPL:
@@ -311,30 +323,31 @@ Pkt6::unpackUDP() {
 }
 
 bool
-Pkt6::unpackMsg(OptionBuffer::const_iterator begin,
-                OptionBuffer::const_iterator end) {
-    if (std::distance(begin, end) < 4) {
+Pkt6::unpackMsg(size_t offset, size_t length) {
+    if (length < 4) {
         // truncated message (less than 4 bytes)
         return (false);
     }
 
-    msg_type_ = *begin++;
+    msg_type_ = data_[offset];
 
-    transid_ = ( (*begin++) << 16 ) +
-        ((*begin++) << 8) + (*begin++);
+    transid_ = (data_[offset + 1] << 16) +
+        (data_[offset + 2] << 8) + data_[offset + 3];
     transid_ = transid_ & 0xffffff;
 
     try {
-        OptionBuffer opt_buffer(begin, end);
-
         // If custom option parsing function has been set, use this function
-        // to parse options. Otherwise, use standard function from libdhcp.
+        // to parse options. Otherwise, use standard function from libdhcp,
+        // which parses the options where they are in data_.
         if (callback_.empty()) {
-            LibDHCP::unpackOptions6(opt_buffer, "dhcp6", options_);
+            LibDHCP::unpackOptions6(data_, offset + 4, length - 4, "dhcp6",
+                                    options_);
         } else {
             // The last two arguments hold the DHCPv6 Relay message offset and
             // length. Setting them to NULL because we are dealing with the
             // not-relayed message.
+            OptionBuffer opt_buffer(data_.begin() + offset + 4,
+                                    data_.begin() + offset + length);
             callback_(opt_buffer, "dhcp6", options_, NULL, NULL);
         }
     } catch (const Exception& e) {
@@ -350,7 +363,11 @@ Pkt6::unpackRelayMsg() {
     // we use offset + bufsize, because we want to avoid creating unnecessary
     // copies. There may be up to 32 relays. While using InputBuffer would
     // be probably a bit cleaner, copying data up to 32 times is unacceptable
-    // price here. Hence a single buffer with offets and lengths.
+    // price here. Hence a single buffer with offets and lengths, in which
+    // the options of the relays are parsed where they are (unless a custom
+    // option parsing function needs them in a buffer of their own), and
+    // the relays keep the offset and length of the message they
+    // encapsulate.
     size_t bufsize = data_.size();
     size_t offset = 0;
 
@@ -372,16 +389,21 @@ Pkt6::unpackRelayMsg() {
 
         try {
             // parse the rest as options
-            OptionBuffer opt_buffer(&data_[offset], &data_[offset+bufsize]);
-
             // If custom option parsing function has been set, use this function
             // to parse options. Otherwise, use standard function from libdhcp.
             if (callback_.empty()) {
-                LibDHCP::unpackOptions6(opt_buffer, "dhcp6", relay.options_,
-                                        &relay_msg_offset, &relay_msg_len);
+                LibDHCP::unpackOptions6(data_, offset, bufsize, "dhcp6",
+                                        relay.options_, &relay_msg_offset,
+                                        &relay_msg_len);
             } else {
+                OptionBuffer opt_buffer(&data_[offset],
+                                        &data_[offset + bufsize]);
                 callback_(opt_buffer, "dhcp6", relay.options_,
                           &relay_msg_offset, &relay_msg_len);
+                // the callback returns the offset in opt_buffer
+                if (relay_msg_len != 0) {
+                    relay_msg_offset += offset;
+                }
             }
 
             /// @todo: check that each option appears at most once
@@ -394,6 +416,8 @@ Pkt6::unpackRelayMsg() {
             }
 
             // store relay information parsed so far
+            relay.relay_msg_offset_ = relay_msg_offset;
+            relay.relay_msg_len_ = relay_msg_len;
             addRelayInfo(relay);
 
             /// @todo: implement ERO here
@@ -403,16 +427,15 @@ Pkt6::unpackRelayMsg() {
                 bundy_throw(Unexpected, "Relay-msg option is truncated.");
                 return false;
             }
-            uint8_t inner_type = data_[offset + relay_msg_offset];
-            offset += relay_msg_offset; // offset is relative
+            uint8_t inner_type = data_[relay_msg_offset];
+            offset = relay_msg_offset;  // offset is absolute
             bufsize = relay_msg_len;    // length is absolute
 
             if ( (inner_type != DHCPV6_RELAY_FORW) &&
                  (inner_type != DHCPV6_RELAY_REPL)) {
                 // Ok, the inner message is not encapsulated, let's decode it
                 // directly
-                return (unpackMsg(data_.begin() + offset, data_.begin() + offset
-                                  + relay_msg_len));
+                return (unpackMsg(offset, relay_msg_len));
             }
 
             // Oh well, there's inner relay-forw or relay-repl inside. Let's
@@ -588,14 +611,12 @@ void Pkt6::copyRelayInfo(const Pkt6Ptr& question) {
 
 bool
 Pkt6::inClass(const std::string& client_class) {
-    return (classes_.find(client_class) != classes_.end());
+    return (classes_.contains(client_class));
 }
 
 void
 Pkt6::addClass(const std::string& client_class) {
-    if (classes_.find(client_class) == classes_.end()) {
-        classes_.insert(client_class);
-    }
+    classes_.insert(client_class);
 }
 
 } // end of bundy::dhcp namespace
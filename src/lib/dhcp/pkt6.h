@@ -89,6 +89,14 @@ public:
         /// Used when calculating length during pack/unpack
         uint16_t  relay_msg_len_;
 
+        /// @brief offset of the relay-msg option data in the received packet
+        ///
+        /// Together with relay_msg_len_, it is a view of the message
+        /// encapsulated by this relay in Pkt6::data_, which is not copied
+        /// when the packet is parsed. It is 0 for the relays of a packet
+        /// being built.
+        size_t relay_msg_offset_;
+
         /// options received from a specified relay, except relay-msg option
         bundy::dhcp::OptionCollection options_;
     };
@@ -498,11 +506,10 @@ protected:
     /// (e.g. solicit or request) message. This method is called from
     /// unpackUDP() when received message is detected to be direct.
     ///
-    /// @param begin start of the buffer
-    /// @param end end of the buffer
+    /// @param offset offset of the message in data_
+    /// @param length length of the message
     /// @return true if parsing was successful and there are no leftover bytes
-    bool unpackMsg(OptionBuffer::const_iterator begin,
-                   OptionBuffer::const_iterator end);
+    bool unpackMsg(size_t offset, size_t length);
 
     /// @brief unpacks relayed message (RELAY-FORW or RELAY-REPL)
     ///
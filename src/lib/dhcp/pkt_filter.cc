@@ -61,6 +61,16 @@ PktFilter::openFallbackSocket(const bundy::asiolink::IOAddress& addr,
     return (sock);
 }
 
+size_t
+PktFilter::receiveBatch(const Iface& iface, const SocketInfo& socket_info,
+                        const size_t, std::vector<Pkt4Ptr>& pkts) {
+    Pkt4Ptr pkt = receive(iface, socket_info);
+    if (!pkt) {
+        return (0);
+    }
+    pkts.push_back(pkt);
+    return (1);
+}
 
 } // end of bundy::dhcp namespace
 } // end of bundy namespace
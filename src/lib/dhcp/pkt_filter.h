@@ -19,6 +19,8 @@
 #include <asiolink/io_address.h>
 #include <boost/shared_ptr.hpp>
 
+#include <vector>
+
 namespace bundy {
 namespace dhcp {
 
@@ -101,6 +103,24 @@ public:
     virtual Pkt4Ptr receive(const Iface& iface,
                             const SocketInfo& socket_info) = 0;
 
+    /// @brief Receive several packets over specified socket.
+    ///
+    /// This method is called when the socket is known to have data, and
+    /// receives up to @c max_count packets without blocking. The default
+    /// implementation receives a single packet using @c receive; derived
+    /// classes may override it to receive more with a single system call.
+    ///
+    /// @param iface interface
+    /// @param socket_info structure holding socket information
+    /// @param max_count maximum number of packets to be received
+    /// @param [out] pkts vector the received packets are appended to
+    ///
+    /// @return number of packets received
+    virtual size_t receiveBatch(const Iface& iface,
+                                const SocketInfo& socket_info,
+                                const size_t max_count,
+                                std::vector<Pkt4Ptr>& pkts);
+
     /// @brief Send packet over specified socket.
     ///
     /// @param iface interface to be used to send packet
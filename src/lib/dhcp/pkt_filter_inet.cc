@@ -16,20 +16,39 @@
 #include <dhcp/iface_mgr.h>
 #include <dhcp/pkt4.h>
 #include <dhcp/pkt_filter_inet.h>
+#include <boost/make_shared.hpp>
 #include <errno.h>
 #include <cstring>
+#include <string>
+#include <vector>
 
 using namespace bundy::asiolink;
 
 namespace bundy {
 namespace dhcp {
 
+/// @brief Buffers used by @c PktFilterInet::receiveBatch.
+///
+/// There is one element of each vector for each packet in a batch.
+struct PktFilterInet::BatchBuffers {
+#if defined (OS_LINUX) && defined (MSG_WAITFORONE)
+    std::vector<uint8_t> bufs_;
+    std::vector<char> control_bufs_;
+    std::vector<struct sockaddr_in> from_addrs_;
+    std::vector<struct iovec> iovs_;
+    std::vector<struct mmsghdr> hdrs_;
+#endif
+};
+
 PktFilterInet::PktFilterInet()
     : control_buf_len_(CMSG_SPACE(sizeof(struct in6_pktinfo))),
       control_buf_(new char[control_buf_len_])
 {
 }
 
+PktFilterInet::~PktFilterInet() {
+}
+
 SocketInfo
 PktFilterInet::openSocket(const Iface& iface,
                           const bundy::asiolink::IOAddress& addr,
@@ -135,8 +154,92 @@ PktFilterInet::receive(const Iface& iface, const SocketInfo& socket_info) {
         bundy_throw(SocketReadError, "failed to receive UDP4 data");
     }
 
+    return (createPacket(iface, socket_info, buf, result, from_addr, m));
+}
+
+size_t
+PktFilterInet::receiveBatch(const Iface& iface, const SocketInfo& socket_info,
+                            const size_t max_count,
+                            std::vector<Pkt4Ptr>& pkts) {
+#if defined (OS_LINUX) && defined (MSG_WAITFORONE)
+    if (max_count <= 1) {
+        return (PktFilter::receiveBatch(iface, socket_info, max_count, pkts));
+    }
+
+    // The buffers are kept between the calls, so they are only allocated
+    // when the batch grows.
+    if (!batch_) {
+        batch_.reset(new BatchBuffers());
+    }
+    BatchBuffers& b = *batch_;
+    if (b.hdrs_.size() < max_count) {
+        b.bufs_.resize(max_count * IfaceMgr::RCVBUFSIZE);
+        b.control_bufs_.resize(max_count * control_buf_len_);
+        b.from_addrs_.resize(max_count);
+        b.iovs_.resize(max_count);
+        b.hdrs_.resize(max_count);
+    }
+    memset(&b.control_bufs_[0], 0, max_count * control_buf_len_);
+    memset(&b.from_addrs_[0], 0, max_count * sizeof(sockaddr_in));
+    memset(&b.hdrs_[0], 0, max_count * sizeof(struct mmsghdr));
+
+    for (size_t i = 0; i < max_count; ++i) {
+        b.iovs_[i].iov_base = &b.bufs_[i * IfaceMgr::RCVBUFSIZE];
+        b.iovs_[i].iov_len = IfaceMgr::RCVBUFSIZE;
+        struct msghdr& m = b.hdrs_[i].msg_hdr;
+        m.msg_name = &b.from_addrs_[i];
+        m.msg_namelen = sizeof(sockaddr_in);
+        m.msg_iov = &b.iovs_[i];
+        m.msg_iovlen = 1;
+        m.msg_control = &b.control_bufs_[i * control_buf_len_];
+        m.msg_controllen = control_buf_len_;
+    }
+
+    // The socket is known to have data, so don't wait for the packets
+    // which haven't arrived yet.
+    int result = recvmmsg(socket_info.sockfd_, &b.hdrs_[0], max_count,
+                          MSG_DONTWAIT, NULL);
+    if (result < 0) {
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+            return (0);
+        }
+        bundy_throw(SocketReadError, "failed to receive UDP4 data");
+    }
+
+    // A malformed packet must not cause the others to be lost, so they
+    // are all created before the first failure is reported.
+    size_t count = 0;
+    std::string error;
+    for (int i = 0; i < result; ++i) {
+        try {
+            pkts.push_back(createPacket(iface, socket_info,
+                                        &b.bufs_[i * IfaceMgr::RCVBUFSIZE],
+                                        b.hdrs_[i].msg_len, b.from_addrs_[i],
+                                        b.hdrs_[i].msg_hdr));
+            ++count;
+        } catch (const std::exception& ex) {
+            if (error.empty()) {
+                error = ex.what();
+            }
+        }
+    }
+    if (!error.empty()) {
+        bundy_throw(SocketReadError, "failed to create a packet from the"
+                    " received UDP4 data: " << error);
+    }
+    return (count);
+#else
+    return (PktFilter::receiveBatch(iface, socket_info, max_count, pkts));
+#endif
+}
+
+Pkt4Ptr
+PktFilterInet::createPacket(const Iface& iface, const SocketInfo& socket_info,
+                            const uint8_t* buf, const size_t len,
+                            const struct sockaddr_in& from_addr,
+                            struct msghdr& m) {
     // We have all data let's create Pkt4 object.
-    Pkt4Ptr pkt = Pkt4Ptr(new Pkt4(buf, result));
+    Pkt4Ptr pkt = boost::make_shared<Pkt4>(buf, len);
 
     pkt->updateTimestamp();
 
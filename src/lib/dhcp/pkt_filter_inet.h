@@ -17,6 +17,12 @@
 
 #include <dhcp/pkt_filter.h>
 #include <boost/scoped_array.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <vector>
 
 namespace bundy {
 namespace dhcp {
@@ -33,6 +39,11 @@ public:
     /// Allocates control buffer.
     PktFilterInet();
 
+    /// @brief Destructor
+    ///
+    /// Frees the buffers used to receive batches of packets.
+    virtual ~PktFilterInet();
+
     /// @brief Check if packet can be sent to the host without address directly.
     ///
     /// This Packet Filter sends packets through AF_INET datagram sockets, so
@@ -73,6 +84,25 @@ public:
     /// message parsing fails.
     virtual Pkt4Ptr receive(const Iface& iface, const SocketInfo& socket_info);
 
+    /// @brief Receive several packets over specified socket.
+    ///
+    /// On Linux all the packets are received using a single recvmmsg()
+    /// call, which returns as many as are queued on the socket, up to
+    /// @c max_count. On other systems a single packet is received.
+    ///
+    /// @param iface interface
+    /// @param socket_info structure holding socket information
+    /// @param max_count maximum number of packets to be received
+    /// @param [out] pkts vector the received packets are appended to
+    ///
+    /// @return number of packets received
+    /// @throw bundy::dhcp::SocketReadError if an error occurs during reception
+    /// of the packets.
+    virtual size_t receiveBatch(const Iface& iface,
+                                const SocketInfo& socket_info,
+                                const size_t max_count,
+                                std::vector<Pkt4Ptr>& pkts);
+
     /// @brief Send packet over specified socket.
     ///
     /// @param iface interface to be used to send packet
@@ -86,10 +116,36 @@ public:
                      const Pkt4Ptr& pkt);
 
 private:
+
+    /// @brief Creates a packet from received data.
+    ///
+    /// @param iface interface the data was received on
+    /// @param socket_info structure holding socket information
+    /// @param buf received data
+    /// @param len length of the received data
+    /// @param from_addr address the data was received from
+    /// @param m message header used to receive the data, holding the
+    /// control messages
+    ///
+    /// @return the packet
+    Pkt4Ptr createPacket(const Iface& iface, const SocketInfo& socket_info,
+                         const uint8_t* buf, const size_t len,
+                         const struct sockaddr_in& from_addr,
+                         struct msghdr& m);
+
     /// Length of the control_buf_ array.
     size_t control_buf_len_;
     /// Control buffer, used in transmission and reception.
     boost::scoped_array<char> control_buf_;
+
+    /// @brief Buffers used to receive batches of packets.
+    ///
+    /// They are defined in the implementation, as they depend on the
+    /// system support for batch reception.
+    struct BatchBuffers;
+
+    /// Buffers used to receive batches of packets, allocated on first use.
+    boost::scoped_ptr<BatchBuffers> batch_;
 };
 
 } // namespace bundy::dhcp
@@ -19,10 +19,19 @@
 #include <dhcp/pkt_filter_lpf.h>
 #include <dhcp/protocol_util.h>
 #include <exceptions/exceptions.h>
+#include <boost/make_shared.hpp>
 #include <linux/filter.h>
 #include <linux/if_ether.h>
 #include <linux/if_packet.h>
 #include <net/ethernet.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include <cstring>
+#include <map>
+#include <string>
 
 namespace {
 
@@ -99,15 +108,293 @@ struct sock_filter dhcp_sock_filter [] = {
 
 using namespace bundy::util;
 
+namespace {
+
+/// Size of a receive ring frame. It must hold the frame header and the
+/// largest packet received.
+const unsigned int RING_FRAME_SIZE = 2048;
+
+/// Size of a receive ring block. It must be a multiple of the page size
+/// and of the frame size.
+const unsigned int RING_BLOCK_SIZE = 4096;
+
+/// Number of blocks in a receive ring.
+const unsigned int RING_BLOCK_COUNT = 64;
+
+/// @brief Receive ring of a raw socket.
+///
+/// The ring is a sequence of frames, mapped into the process memory and
+/// filled by the kernel in order. The frames hold the packets sent from
+/// this host, too, which are skipped. The frame holding the next packet to
+/// be received is handed back to the kernel once the packet is created.
+struct RxRing {
+    /// @brief Constructor
+    RxRing()
+        : sockfd_(-1), inode_(0), map_(NULL), size_(0), frame_count_(0),
+          frame_(0) {
+    }
+
+    /// @brief Returns header of the frame holding the next packet.
+    struct tpacket2_hdr* current() const {
+        return (reinterpret_cast<struct tpacket2_hdr*>(map_ + frame_ *
+                                                       RING_FRAME_SIZE));
+    }
+
+    /// @brief Checks if the kernel has filled the current frame.
+    bool ready() const {
+        __sync_synchronize();
+        return ((current()->tp_status & TP_STATUS_USER) != 0);
+    }
+
+    /// @brief Hands the current frame back to the kernel.
+    void release() {
+        __sync_synchronize();
+        current()->tp_status = TP_STATUS_KERNEL;
+        frame_ = (frame_ + 1) % frame_count_;
+    }
+
+    /// @brief Unmaps the ring.
+    void unmap() {
+        munmap(map_, size_);
+        map_ = NULL;
+    }
+
+    /// Socket descriptor.
+    int sockfd_;
+    /// Inode of the socket, telling it apart from a socket which reuses
+    /// the descriptor after it has been closed.
+    ino_t inode_;
+    /// Address the ring is mapped at.
+    uint8_t* map_;
+    /// Size of the mapping.
+    size_t size_;
+    /// Number of frames in the ring.
+    size_t frame_count_;
+    /// Index of the frame holding the next packet.
+    size_t frame_;
+};
+
+/// @brief Hands the current frame back to the kernel when going out of scope.
+class FrameReleaser {
+public:
+    /// @brief Constructor
+    ///
+    /// @param ring ring the current frame belongs to
+    FrameReleaser(RxRing& ring) : ring_(ring) {
+    }
+
+    /// @brief Destructor
+    ~FrameReleaser() {
+        ring_.release();
+    }
+
+private:
+    /// Ring the current frame belongs to.
+    RxRing& ring_;
+};
+
+/// @brief Sets up the receive ring of a raw socket.
+///
+/// @param sock socket descriptor
+/// @param [out] ring ring to be set up
+///
+/// @return true if the ring has been set up, false if the kernel doesn't
+/// support it, in which case the socket is left as it was.
+bool
+setupRing(const int sock, RxRing& ring) {
+    int version = TPACKET_V2;
+    if (setsockopt(sock, SOL_PACKET, PACKET_VERSION, &version,
+                   sizeof(version)) < 0) {
+        return (false);
+    }
+
+    struct tpacket_req req;
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = RING_BLOCK_SIZE;
+    req.tp_block_nr = RING_BLOCK_COUNT;
+    req.tp_frame_size = RING_FRAME_SIZE;
+    req.tp_frame_nr = RING_BLOCK_SIZE / RING_FRAME_SIZE * RING_BLOCK_COUNT;
+    if (setsockopt(sock, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+        return (false);
+    }
+
+    struct stat st;
+    const size_t size = RING_BLOCK_SIZE * RING_BLOCK_COUNT;
+    void* map = MAP_FAILED;
+    if (fstat(sock, &st) == 0) {
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, sock, 0);
+    }
+    if (map == MAP_FAILED) {
+        // The packets would go to the ring which isn't mapped, so it
+        // has to be removed.
+        memset(&req, 0, sizeof(req));
+        setsockopt(sock, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req));
+        return (false);
+    }
+
+    ring.sockfd_ = sock;
+    ring.inode_ = st.st_ino;
+    ring.map_ = static_cast<uint8_t*>(map);
+    ring.size_ = size;
+    ring.frame_count_ = req.tp_frame_nr;
+    ring.frame_ = 0;
+    return (true);
+}
+
+/// @brief Discards all data waiting on the socket.
+///
+/// @param sockfd socket descriptor
+void
+drainSocket(const int sockfd) {
+    uint8_t raw_buf[IfaceMgr::RCVBUFSIZE];
+    int datalen;
+    do {
+        datalen = recv(sockfd, raw_buf, sizeof(raw_buf), MSG_DONTWAIT);
+    } while (datalen > 0);
+}
+
+/// @brief Creates a packet from the data received on the raw socket.
+///
+/// @param iface interface the data was received on
+/// @param data received Ethernet frame
+/// @param len length of the received frame
+///
+/// @return the packet
+Pkt4Ptr
+createPacket(const Iface& iface, const uint8_t* data, const size_t len) {
+    InputBuffer buf(data, len);
+
+    // @todo: This is awkward way to solve the chicken and egg problem
+    // whereby we don't know the offset where DHCP data start in the
+    // received buffer when we create the packet object. In general case,
+    // the IP header has variable length. The information about its length
+    // is stored in one of its fields. Therefore, we have to decode the
+    // packet to get the offset of the DHCP data. The dummy object is
+    // created so as we can pass it to the functions which decode IP stack
+    // and find actual offset of the DHCP data.
+    // Once we find the offset we can create another Pkt4 object from
+    // the reminder of the input buffer and set the IP addresses and
+    // ports from the dummy packet. We should consider doing it
+    // in some more elegant way.
+    Pkt4Ptr dummy_pkt = boost::make_shared<Pkt4>(DHCPDISCOVER, 0);
+
+    // Decode ethernet, ip and udp headers.
+    decodeEthernetHeader(buf, dummy_pkt);
+    decodeIpUdpHeader(buf, dummy_pkt);
+
+    // Decode DHCP data into the Pkt4 object. The data is taken straight
+    // from the received frame.
+    Pkt4Ptr pkt = boost::make_shared<Pkt4>(data + buf.getPosition(),
+                                           buf.getLength() -
+                                           buf.getPosition());
+
+    // Set the appropriate packet members using data collected from
+    // the decoded headers.
+    pkt->setIndex(iface.getIndex());
+    pkt->setIface(iface.getName());
+    pkt->setLocalAddr(dummy_pkt->getLocalAddr());
+    pkt->setRemoteAddr(dummy_pkt->getRemoteAddr());
+    pkt->setLocalPort(dummy_pkt->getLocalPort());
+    pkt->setRemotePort(dummy_pkt->getRemotePort());
+    pkt->setLocalHWAddr(dummy_pkt->getLocalHWAddr());
+    pkt->setRemoteHWAddr(dummy_pkt->getRemoteHWAddr());
+
+    return (pkt);
+}
+
+/// @brief Creates a packet from the current frame of the ring.
+///
+/// The frame is handed back to the kernel, also if the packet can't be
+/// created.
+///
+/// @param iface interface the frame was received on
+/// @param ring receive ring
+///
+/// @return the packet, or an empty pointer if the frame was truncated or
+/// it has been sent from this host.
+Pkt4Ptr
+receiveFrame(const Iface& iface, RxRing& ring) {
+    FrameReleaser releaser(ring);
+    const struct tpacket2_hdr* hdr = ring.current();
+    const struct sockaddr_ll* from =
+        reinterpret_cast<const struct sockaddr_ll*>
+        (reinterpret_cast<const uint8_t*>(hdr) +
+         TPACKET_ALIGN(sizeof(struct tpacket2_hdr)));
+    if ((hdr->tp_snaplen < hdr->tp_len) ||
+        (from->sll_pkttype == PACKET_OUTGOING)) {
+        return (Pkt4Ptr());
+    }
+    return (createPacket(iface, reinterpret_cast<const uint8_t*>(hdr) +
+                         hdr->tp_mac, hdr->tp_snaplen));
+}
+
+}
+
 namespace bundy {
 namespace dhcp {
 
+/// @brief Receive rings used by @c PktFilterLPF.
+struct PktFilterLPF::Rings {
+    /// @brief Destructor
+    ///
+    /// Unmaps all rings.
+    ~Rings() {
+        for (std::map<int, RxRing>::iterator ring = rx_.begin();
+             ring != rx_.end(); ++ring) {
+            ring->second.unmap();
+        }
+    }
+
+    /// @brief Returns the ring of the socket.
+    ///
+    /// @param sockfd socket descriptor
+    ///
+    /// @return pointer to the ring or NULL if the socket has none.
+    RxRing* find(const int sockfd) {
+        std::map<int, RxRing>::iterator ring = rx_.find(sockfd);
+        return (ring != rx_.end() ? &ring->second : NULL);
+    }
+
+    /// @brief Unmaps the rings of the sockets which have been closed.
+    ///
+    /// The sockets are closed by the interfaces, without notifying the
+    /// packet filter. The mapping keeps the socket alive, so the rings
+    /// are looked for when the sockets are opened again.
+    void releaseClosed() {
+        std::map<int, RxRing>::iterator ring = rx_.begin();
+        while (ring != rx_.end()) {
+            struct stat st;
+            if ((fstat(ring->first, &st) < 0) ||
+                (st.st_ino != ring->second.inode_)) {
+                ring->second.unmap();
+                rx_.erase(ring++);
+            } else {
+                ++ring;
+            }
+        }
+    }
+
+    /// Receive rings, indexed by socket descriptor.
+    std::map<int, RxRing> rx_;
+};
+
+PktFilterLPF::PktFilterLPF(const bool use_rings)
+    : use_rings_(use_rings) {
+}
+
+PktFilterLPF::~PktFilterLPF() {
+}
+
 SocketInfo
 PktFilterLPF::openSocket(const Iface& iface,
                          const bundy::asiolink::IOAddress& addr,
                          const uint16_t port, const bool,
                          const bool) {
 
+    if (rings_) {
+        rings_->releaseClosed();
+    }
+
     // Open fallback socket first. If it fails, it will give us an indication
     // that there is another service (perhaps DHCP server) running.
     // The function will throw an exception and effectivelly cease opening
@@ -140,6 +427,11 @@ PktFilterLPF::openSocket(const Iface& iface,
                   << " on the socket " << sock);
     }
 
+    // The ring is set up before the socket is bound, so as the packets
+    // arriving on the interface go to the ring.
+    RxRing ring;
+    const bool has_ring = use_rings_ && setupRing(sock, ring);
+
     struct sockaddr_ll sa;
     memset(&sa, 0, sizeof(sockaddr_ll));
     sa.sll_family = AF_PACKET;
@@ -151,19 +443,31 @@ PktFilterLPF::openSocket(const Iface& iface,
     // interested in.
     if (bind(sock, reinterpret_cast<const struct sockaddr*>(&sa),
              sizeof(sa)) < 0) {
+        if (has_ring) {
+            ring.unmap();
+        }
         close(sock);
         close(fallback);
         bundy_throw(SocketConfigError, "Failed to bind LPF socket '" << sock
                   << "' to interface '" << iface.getName() << "'");
     }
 
+    if (has_ring) {
+        // The packets which came before the ring was set up are queued
+        // on the socket, which would then always be reported readable.
+        drainSocket(sock);
+        if (!rings_) {
+            rings_.reset(new Rings());
+        }
+        rings_->rx_[sock] = ring;
+    }
+
     return (SocketInfo(addr, port, sock, fallback));
 
 }
 
 Pkt4Ptr
 PktFilterLPF::receive(const Iface& iface, const SocketInfo& socket_info) {
-    uint8_t raw_buf[IfaceMgr::RCVBUFSIZE];
     // First let's get some data from the fallback socket. The data will be
     // discarded but we don't want the socket buffer to bloat. We get the
     // packets from the socket in loop but most of the time the loop will
@@ -178,13 +482,34 @@ PktFilterLPF::receive(const Iface& iface, const SocketInfo& socket_info) {
     // bytes received on the fallback socket in a single round. Further
     // optimizations would include an asynchronous read from the fallback socket
     // when the DHCP server is idle.
-    int datalen;
-    do {
-        datalen = recv(socket_info.fallbackfd_, raw_buf, sizeof(raw_buf), 0);
-    } while (datalen > 0);
+    drainSocket(socket_info.fallbackfd_);
+
+    RxRing* ring = rings_ ? rings_->find(socket_info.sockfd_) : NULL;
+    if (ring != NULL) {
+        // Like read() below, wait for the packet if the ring is empty.
+        if (!ring->ready()) {
+            struct pollfd pfd;
+            pfd.fd = socket_info.sockfd_;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            if ((poll(&pfd, 1, -1) <= 0) || !ring->ready()) {
+                return (Pkt4Ptr());
+            }
+        }
+        // The frames which don't hold a packet are skipped, but there is
+        // no waiting for another frame once they have been consumed.
+        while (ring->ready()) {
+            Pkt4Ptr pkt = receiveFrame(iface, *ring);
+            if (pkt) {
+                return (pkt);
+            }
+        }
+        return (Pkt4Ptr());
+    }
 
     // Now that we finished getting data from the fallback socket, we
     // have to get the data from the raw socket too.
+    uint8_t raw_buf[IfaceMgr::RCVBUFSIZE];
     int data_len = read(socket_info.sockfd_, raw_buf, sizeof(raw_buf));
     // If negative value is returned by read(), it indicates that an
     // error occured. If returned value is 0, no data was read from the
@@ -195,51 +520,48 @@ PktFilterLPF::receive(const Iface& iface, const SocketInfo& socket_info) {
         return Pkt4Ptr();
     }
 
-    InputBuffer buf(raw_buf, data_len);
-
-    // @todo: This is awkward way to solve the chicken and egg problem
-    // whereby we don't know the offset where DHCP data start in the
-    // received buffer when we create the packet object. In general case,
-    // the IP header has variable length. The information about its length
-    // is stored in one of its fields. Therefore, we have to decode the
-    // packet to get the offset of the DHCP data. The dummy object is
-    // created so as we can pass it to the functions which decode IP stack
-    // and find actual offset of the DHCP data.
-    // Once we find the offset we can create another Pkt4 object from
-    // the reminder of the input buffer and set the IP addresses and
-    // ports from the dummy packet. We should consider doing it
-    // in some more elegant way.
-    Pkt4Ptr dummy_pkt = Pkt4Ptr(new Pkt4(DHCPDISCOVER, 0));
-
-    // Decode ethernet, ip and udp headers.
-    decodeEthernetHeader(buf, dummy_pkt);
-    decodeIpUdpHeader(buf, dummy_pkt);
-
-    // Read the DHCP data.
-    std::vector<uint8_t> dhcp_buf;
-    buf.readVector(dhcp_buf, buf.getLength() - buf.getPosition());
-
-    // Decode DHCP data into the Pkt4 object.
-    Pkt4Ptr pkt = Pkt4Ptr(new Pkt4(&dhcp_buf[0], dhcp_buf.size()));
+    return (createPacket(iface, raw_buf, data_len));
+}
 
-    // Set the appropriate packet members using data collected from
-    // the decoded headers.
-    pkt->setIndex(iface.getIndex());
-    pkt->setIface(iface.getName());
-    pkt->setLocalAddr(dummy_pkt->getLocalAddr());
-    pkt->setRemoteAddr(dummy_pkt->getRemoteAddr());
-    pkt->setLocalPort(dummy_pkt->getLocalPort());
-    pkt->setRemotePort(dummy_pkt->getRemotePort());
-    pkt->setLocalHWAddr(dummy_pkt->getLocalHWAddr());
-    pkt->setRemoteHWAddr(dummy_pkt->getRemoteHWAddr());
+size_t
+PktFilterLPF::receiveBatch(const Iface& iface, const SocketInfo& socket_info,
+                           const size_t max_count,
+                           std::vector<Pkt4Ptr>& pkts) {
+    RxRing* ring = rings_ ? rings_->find(socket_info.sockfd_) : NULL;
+    if (ring == NULL) {
+        return (PktFilter::receiveBatch(iface, socket_info, max_count, pkts));
+    }
 
-    return (pkt);
+    drainSocket(socket_info.fallbackfd_);
+
+    // A malformed packet must not cause the others to be lost, so they
+    // are all created before the first failure is reported.
+    size_t count = 0;
+    std::string error;
+    while ((count < max_count) && ring->ready()) {
+        try {
+            Pkt4Ptr pkt = receiveFrame(iface, *ring);
+            if (pkt) {
+                pkts.push_back(pkt);
+                ++count;
+            }
+        } catch (const std::exception& ex) {
+            if (error.empty()) {
+                error = ex.what();
+            }
+        }
+    }
+    if (!error.empty()) {
+        bundy_throw(SocketReadError, "failed to create a packet from the"
+                    " data received on the raw socket: " << error);
+    }
+    return (count);
 }
 
 int
 PktFilterLPF::send(const Iface& iface, uint16_t sockfd, const Pkt4Ptr& pkt) {
 
-    OutputBuffer buf(14);
+    OutputBuffer buf(ETHERNET_HEADER_LEN + MIN_IP_HEADER_LEN + UDP_HEADER_LEN);
 
     // Some interfaces may have no HW address - e.g. loopback interface.
     // For these interfaces the HW address length is 0. If this is the case,
@@ -261,18 +583,28 @@ PktFilterLPF::send(const Iface& iface, uint16_t sockfd, const Pkt4Ptr& pkt) {
     // IP and UDP header
     writeIpUdpHeader(pkt, buf);
 
-    // DHCPv4 message
-    buf.writeData(pkt->getBuffer().getData(), pkt->getBuffer().getLength());
-
     sockaddr_ll sa;
     sa.sll_family = AF_PACKET;
     sa.sll_ifindex = iface.getIndex();
     sa.sll_protocol = htons(ETH_P_IP);
     sa.sll_halen = 6;
 
-    int result = sendto(sockfd, buf.getData(), buf.getLength(), 0,
-                        reinterpret_cast<const struct sockaddr*>(&sa),
-                        sizeof(sockaddr_ll));
+    // The DHCPv4 message is sent from its own buffer, following the
+    // headers, so as it isn't copied.
+    struct iovec iov[2];
+    iov[0].iov_base = const_cast<void*>(buf.getData());
+    iov[0].iov_len = buf.getLength();
+    iov[1].iov_base = const_cast<void*>(pkt->getBuffer().getData());
+    iov[1].iov_len = pkt->getBuffer().getLength();
+
+    struct msghdr m;
+    memset(&m, 0, sizeof(m));
+    m.msg_name = &sa;
+    m.msg_namelen = sizeof(sockaddr_ll);
+    m.msg_iov = iov;
+    m.msg_iovlen = 2;
+
+    int result = sendmsg(sockfd, &m, 0);
     if (result < 0) {
         bundy_throw(SocketWriteError, "failed to send DHCPv4 packet, errno="
                   << errno << " (check errno.h)");
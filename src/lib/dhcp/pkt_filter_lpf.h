@@ -19,6 +19,10 @@
 
 #include <util/buffer.h>
 
+#include <boost/scoped_ptr.hpp>
+
+#include <vector>
+
 namespace bundy {
 namespace dhcp {
 
@@ -28,9 +32,34 @@ namespace dhcp {
 /// sockets and Linux Packet Filtering. It is used by @c bundy::dhcp::IfaceMgr
 /// to send DHCPv4 messages to the hosts which don't have an IPv4 address
 /// assigned yet.
+///
+/// Optionally, the raw sockets may be set up with a receive ring shared
+/// with the kernel (PACKET_MMAP). The packets are then read from the ring
+/// frames, without a read() call per packet, and all the packets waiting
+/// in the ring are received in one batch.
 class PktFilterLPF : public PktFilter {
 public:
 
+    /// @brief Constructor
+    ///
+    /// @param use_rings indicates whether the raw sockets should receive
+    /// packets through a ring mapped into the process memory. If the
+    /// kernel doesn't support the rings, the socket is read as usual.
+    explicit PktFilterLPF(const bool use_rings = false);
+
+    /// @brief Destructor
+    ///
+    /// Unmaps the receive rings.
+    virtual ~PktFilterLPF();
+
+    /// @brief Checks if the receive rings are used.
+    ///
+    /// @return true if the sockets opened by this object are set up
+    /// with receive rings.
+    bool useRings() const {
+        return (use_rings_);
+    }
+
     /// @brief Check if packet can be sent to the host without address directly.
     ///
     /// This class supports direct responses to the host without address.
@@ -49,6 +78,8 @@ public:
     /// @param send_bcast Configure socket to send broadcast messages.
     ///
     /// @return A structure describing a primary and fallback socket.
+    /// @throw bundy::dhcp::SocketConfigError if error occurs when opening,
+    /// binding or configuring the socket.
     virtual SocketInfo openSocket(const Iface& iface,
                                   const bundy::asiolink::IOAddress& addr,
                                   const uint16_t port,
@@ -60,21 +91,53 @@ public:
     /// @param iface interface
     /// @param socket_info structure holding socket information
     ///
-    /// @throw bundy::NotImplemented always
     /// @return Received packet
     virtual Pkt4Ptr receive(const Iface& iface, const SocketInfo& socket_info);
 
+    /// @brief Receive several packets over specified socket.
+    ///
+    /// If the socket has a receive ring, all the packets waiting in the
+    /// ring are received, up to @c max_count. Otherwise a single packet is
+    /// received.
+    ///
+    /// @param iface interface
+    /// @param socket_info structure holding socket information
+    /// @param max_count maximum number of packets to be received
+    /// @param [out] pkts vector the received packets are appended to
+    ///
+    /// @return number of packets received
+    /// @throw bundy::dhcp::SocketReadError if any of the received packets
+    /// can't be created. The other packets are appended to @c pkts.
+    virtual size_t receiveBatch(const Iface& iface,
+                                const SocketInfo& socket_info,
+                                const size_t max_count,
+                                std::vector<Pkt4Ptr>& pkts);
+
     /// @brief Send packet over specified socket.
     ///
     /// @param iface interface to be used to send packet
     /// @param sockfd socket descriptor
     /// @param pkt packet to be sent
     ///
-    /// @throw bundy::NotImplemented always
     /// @return result of sending a packet. It is 0 if successful.
+    /// @throw bundy::dhcp::SocketWriteError if an error occures during sending
+    /// a DHCP message through the socket.
     virtual int send(const Iface& iface, uint16_t sockfd,
                      const Pkt4Ptr& pkt);
 
+private:
+
+    /// @brief Receive rings of the sockets opened by this object.
+    ///
+    /// They are defined in the implementation, as they depend on the
+    /// system headers.
+    struct Rings;
+
+    /// Indicates whether the sockets are set up with receive rings.
+    bool use_rings_;
+
+    /// Receive rings, indexed by socket descriptor.
+    boost::scoped_ptr<Rings> rings_;
 };
 
 } // namespace bundy::dhcp
@@ -49,4 +49,77 @@ TEST(ClassifyTest, ClientClasses) {
     EXPECT_TRUE (classes.contains("alpha"));
     EXPECT_TRUE (classes.contains("beta"));
     EXPECT_TRUE (classes.contains("gamma"));
+    EXPECT_EQ(3, classes.size());
+
+    classes.clear();
+    EXPECT_TRUE(classes.empty());
+    EXPECT_FALSE(classes.contains("beta"));
+}
+
+// Checks that interned and not interned classes are handled the same way,
+// including the classes which were added before they were interned.
+TEST(ClassifyTest, ClientClassesInterned) {
+    ClientClasses before;
+    before.insert("interned-before");
+
+    ClientClasses::intern("interned-before");
+    ClientClasses::intern("interned");
+    // Interning more than once is no-op.
+    ClientClasses::intern("interned");
+
+    ClientClasses classes;
+    EXPECT_TRUE(classes.empty());
+    classes.insert("interned");
+    classes.insert("interned");
+    classes.insert("not-interned");
+    EXPECT_FALSE(classes.empty());
+    EXPECT_EQ(2, classes.size());
+    EXPECT_TRUE(classes.contains("interned"));
+    EXPECT_TRUE(classes.contains("not-interned"));
+    EXPECT_FALSE(classes.contains("interned-before"));
+
+    EXPECT_TRUE(before.contains("interned-before"));
+    classes.insert("interned-before");
+    EXPECT_TRUE(classes.contains("interned-before"));
+}
+
+// Checks if intersects() finds a common class of two containers.
+TEST(ClassifyTest, ClientClassesIntersects) {
+    ClientClasses::intern("alpha");
+    ClientClasses::intern("beta");
+
+    ClientClasses empty;
+    ClientClasses alpha;
+    alpha.insert("alpha");
+    ClientClasses beta;
+    beta.insert("beta");
+    ClientClasses alpha_gamma;
+    alpha_gamma.insert("gamma");
+    alpha_gamma.insert("alpha");
+    ClientClasses gamma;
+    gamma.insert("gamma");
+
+    EXPECT_FALSE(empty.intersects(empty));
+    EXPECT_FALSE(empty.intersects(alpha));
+    EXPECT_FALSE(alpha.intersects(empty));
+    EXPECT_TRUE(alpha.intersects(alpha));
+    EXPECT_FALSE(alpha.intersects(beta));
+    EXPECT_TRUE(alpha.intersects(alpha_gamma));
+    EXPECT_TRUE(alpha_gamma.intersects(alpha));
+    EXPECT_FALSE(beta.intersects(alpha_gamma));
+
+    // "gamma" is not interned, so it is compared by name.
+    EXPECT_TRUE(gamma.intersects(alpha_gamma));
+    EXPECT_TRUE(alpha_gamma.intersects(gamma));
+    EXPECT_FALSE(gamma.intersects(alpha));
+
+    // The class was added to one container before it was interned.
+    ClientClasses delta_before;
+    delta_before.insert("delta");
+    ClientClasses::intern("delta");
+    ClientClasses delta_after;
+    delta_after.insert("delta");
+    EXPECT_TRUE(delta_before.intersects(delta_after));
+    EXPECT_TRUE(delta_after.intersects(delta_before));
+    EXPECT_FALSE(delta_after.intersects(gamma));
 }
@@ -155,6 +155,16 @@ TEST(DuidTest, fromText) {
        duid.reset(new DUID(DUID::fromText("00:01:021:03:04:05:06"))),
        bundy::BadValue
     );
+    // Trailing colon is not allowed.
+    EXPECT_THROW(
+       duid.reset(new DUID(DUID::fromText("00:01:02:03:04:05:"))),
+       bundy::BadValue
+    );
+    // DUID with a character which is not a hexadecimal digit.
+    EXPECT_THROW(
+       duid.reset(new DUID(DUID::fromText("00:01:02:x3:04:05:06"))),
+       bundy::BadValue
+    );
 }
 
 // Test checks if the toText() returns valid texual representation
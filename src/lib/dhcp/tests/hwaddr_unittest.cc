@@ -161,6 +161,22 @@ TEST(HWAddrTest, fromText) {
        bundy::BadValue
     );
 
+    // Leading and trailing colons are not allowed.
+    EXPECT_THROW(
+       hwaddr.reset(new HWAddr(HWAddr::fromText(":01:00:bc:0d:67"))),
+       bundy::BadValue
+    );
+    EXPECT_THROW(
+       hwaddr.reset(new HWAddr(HWAddr::fromText("00:01:00:bc:0d:"))),
+       bundy::BadValue
+    );
+
+    // Only hexadecimal digits are allowed.
+    EXPECT_THROW(
+       hwaddr.reset(new HWAddr(HWAddr::fromText("00:01:0g:bc:0d:67"))),
+       bundy::BadValue
+    );
+
 }
 
 } // end of anonymous namespace
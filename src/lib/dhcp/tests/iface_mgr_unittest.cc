@@ -1160,6 +1160,64 @@ TEST_F(IfaceMgrTest, sendReceive4) {
     EXPECT_THROW(ifacemgr->send(sendPkt), SocketWriteError);
 }
 
+// This test verifies that packets received together are queued and
+// returned by the subsequent calls to receive4().
+TEST_F(IfaceMgrTest, receive4Queued) {
+    scoped_ptr<NakedIfaceMgr> ifacemgr(new NakedIfaceMgr());
+
+    IOAddress loAddr("127.0.0.1");
+    int socket1 = 0;
+    ASSERT_NO_THROW(
+        socket1 = ifacemgr->openSocket(LOOPBACK, loAddr,
+                                       DHCP4_SERVER_PORT + 10000);
+    );
+    ASSERT_GE(socket1, 0);
+
+    // Send three packets with different transaction ids.
+    for (uint32_t transid = 1; transid <= 3; ++transid) {
+        Pkt4Ptr sendPkt(new Pkt4(DHCPDISCOVER, transid));
+        sendPkt->setLocalAddr(IOAddress("127.0.0.1"));
+        sendPkt->setLocalPort(DHCP4_SERVER_PORT + 10000 + 1);
+        sendPkt->setRemotePort(DHCP4_SERVER_PORT + 10000);
+        sendPkt->setRemoteAddr(IOAddress("127.0.0.1"));
+        sendPkt->setIndex(1);
+        sendPkt->setIface(string(LOOPBACK));
+        ASSERT_NO_THROW(sendPkt->pack());
+        ASSERT_NO_THROW(ifacemgr->send(sendPkt));
+    }
+
+    // The packets are returned in order. After the first one has been
+    // received, the others are returned without waiting.
+    Pkt4Ptr rcvPkt;
+    ASSERT_NO_THROW(rcvPkt = ifacemgr->receive4(10));
+    for (uint32_t transid = 1; transid <= 3; ++transid) {
+        ASSERT_TRUE(rcvPkt);
+        ASSERT_NO_THROW(rcvPkt->unpack());
+        EXPECT_EQ(transid, rcvPkt->getTransid());
+        ASSERT_NO_THROW(rcvPkt = ifacemgr->receive4(0, 0));
+    }
+    EXPECT_FALSE(rcvPkt);
+
+    // Closing the sockets drops the queued packets.
+    Pkt4Ptr sendPkt(new Pkt4(DHCPDISCOVER, 4));
+    sendPkt->setLocalAddr(IOAddress("127.0.0.1"));
+    sendPkt->setLocalPort(DHCP4_SERVER_PORT + 10000 + 1);
+    sendPkt->setRemotePort(DHCP4_SERVER_PORT + 10000);
+    sendPkt->setRemoteAddr(IOAddress("127.0.0.1"));
+    sendPkt->setIndex(1);
+    sendPkt->setIface(string(LOOPBACK));
+    ASSERT_NO_THROW(sendPkt->pack());
+    ASSERT_NO_THROW(ifacemgr->send(sendPkt));
+    ASSERT_NO_THROW(ifacemgr->send(sendPkt));
+    ASSERT_NO_THROW(rcvPkt = ifacemgr->receive4(10));
+    ASSERT_TRUE(rcvPkt);
+    ifacemgr->closeSockets();
+    ASSERT_NO_THROW(socket1 = ifacemgr->openSocket(LOOPBACK, loAddr,
+                                                   DHCP4_SERVER_PORT + 10000));
+    ASSERT_NO_THROW(rcvPkt = ifacemgr->receive4(0, 0));
+    EXPECT_FALSE(rcvPkt);
+}
+
 // Verifies that it is possible to set custom packet filter object
 // to handle sockets opening and send/receive operation.
 TEST_F(IfaceMgrTest, setPacketFilter) {
@@ -2625,6 +2683,106 @@ void my_callback2(void) {
     callback2_ok = true;
 }
 
+// This test checks that the changes reported by the interface monitor are
+// applied to the interfaces.
+TEST_F(IfaceMgrTest, applyIfaceEvent) {
+    NakedIfaceMgr ifacemgr;
+    ifacemgr.createIfaces();
+
+    // A new link.
+    IfaceEvent link(IfaceEvent::LINK_UPDATED, 10);
+    link.name_ = "vlan10";
+    link.hwtype_ = 1;
+    link.flags_ = IFF_UP | IFF_RUNNING | IFF_BROADCAST;
+    link.mac_.assign(6, 0x0a);
+    EXPECT_EQ("vlan10", ifacemgr.applyIfaceEvent(link));
+    Iface* iface = ifacemgr.getIface(10);
+    ASSERT_TRUE(iface);
+    EXPECT_EQ("vlan10", iface->getName());
+    EXPECT_TRUE(iface->flag_up_);
+    EXPECT_TRUE(iface->flag_running_);
+    EXPECT_EQ(6, iface->getMacLen());
+    EXPECT_EQ(4, ifacemgr.getIfaces().size());
+
+    // The same link again, nothing has changed.
+    EXPECT_TRUE(ifacemgr.applyIfaceEvent(link).empty());
+
+    // The link goes down.
+    link.flags_ = IFF_BROADCAST;
+    EXPECT_EQ("vlan10", ifacemgr.applyIfaceEvent(link));
+    EXPECT_FALSE(ifacemgr.getIface(10)->flag_up_);
+
+    // An address is assigned, once.
+    IfaceEvent addr(IfaceEvent::ADDRESS_ADDED, 10);
+    addr.addr_ = IOAddress("192.0.2.10");
+    EXPECT_EQ("vlan10", ifacemgr.applyIfaceEvent(addr));
+    EXPECT_TRUE(ifacemgr.applyIfaceEvent(addr).empty());
+    ASSERT_EQ(1, ifacemgr.getIface(10)->getAddresses().size());
+
+    // The link is renamed and keeps its address.
+    link.name_ = "vlan11";
+    EXPECT_EQ("vlan11", ifacemgr.applyIfaceEvent(link));
+    EXPECT_FALSE(ifacemgr.getIface("vlan10"));
+    iface = ifacemgr.getIface("vlan11");
+    ASSERT_TRUE(iface);
+    EXPECT_EQ(10, iface->getIndex());
+    EXPECT_EQ(1, iface->getAddresses().size());
+    EXPECT_EQ(4, ifacemgr.getIfaces().size());
+
+    // The address is removed.
+    addr.type_ = IfaceEvent::ADDRESS_REMOVED;
+    EXPECT_EQ("vlan11", ifacemgr.applyIfaceEvent(addr));
+    EXPECT_TRUE(ifacemgr.applyIfaceEvent(addr).empty());
+    EXPECT_TRUE(ifacemgr.getIface(10)->getAddresses().empty());
+
+    // The link is removed.
+    EXPECT_EQ("vlan11",
+              ifacemgr.applyIfaceEvent(IfaceEvent(IfaceEvent::LINK_REMOVED,
+                                                  10)));
+    EXPECT_FALSE(ifacemgr.getIface(10));
+    EXPECT_EQ(3, ifacemgr.getIfaces().size());
+
+    // Changes of unknown interfaces are ignored.
+    EXPECT_TRUE(ifacemgr.applyIfaceEvent(addr).empty());
+    EXPECT_TRUE(ifacemgr.applyIfaceEvent(IfaceEvent(IfaceEvent::LINK_REMOVED,
+                                                    10)).empty());
+}
+
+// This test checks that the IPv4 sockets of a single interface can be
+// reopened without touching the sockets of the other interfaces.
+TEST_F(IfaceMgrTest, reopenSockets4) {
+    NakedIfaceMgr ifacemgr;
+    ifacemgr.createIfaces();
+
+    boost::shared_ptr<TestPktFilter> custom_packet_filter(new TestPktFilter());
+    ASSERT_NO_THROW(ifacemgr.setPacketFilter(custom_packet_filter));
+    ASSERT_NO_THROW(ifacemgr.openSockets4(DHCP4_SERVER_PORT, true, NULL));
+    ASSERT_EQ(1, ifacemgr.getIface("eth0")->getSockets().size());
+    ASSERT_EQ(1, ifacemgr.getIface("eth1")->getSockets().size());
+    const int eth0_socket =
+        ifacemgr.getIface("eth0")->getSockets().front().sockfd_;
+
+    // The interface is deactivated: its socket is closed.
+    ifacemgr.getIface("eth1")->inactive4_ = true;
+    EXPECT_FALSE(ifacemgr.reopenSockets4("eth1", DHCP4_SERVER_PORT, true,
+                                         NULL));
+    EXPECT_TRUE(ifacemgr.getIface("eth1")->getSockets().empty());
+
+    // And reopened when it is activated again.
+    ifacemgr.getIface("eth1")->inactive4_ = false;
+    EXPECT_TRUE(ifacemgr.reopenSockets4("eth1", DHCP4_SERVER_PORT, true,
+                                        NULL));
+    EXPECT_EQ(1, ifacemgr.getIface("eth1")->getSockets().size());
+
+    // The other interface kept its socket.
+    ASSERT_EQ(1, ifacemgr.getIface("eth0")->getSockets().size());
+    EXPECT_EQ(eth0_socket,
+              ifacemgr.getIface("eth0")->getSockets().front().sockfd_);
+
+    EXPECT_THROW(ifacemgr.reopenSockets4("eth5", DHCP4_SERVER_PORT, true,
+                                         NULL), BadValue);
+}
+
 // Tests if a single external socket and its callback can be passed and
 // it is supported properly by receive4() method.
 TEST_F(IfaceMgrTest, SingleExternalSocket4) {
@@ -16,6 +16,7 @@
 
 #include <dhcp/dhcp4.h>
 #include <dhcp/dhcp6.h>
+#include <dhcp/docsis3_option_defs.h>
 #include <dhcp/libdhcp++.h>
 #include <dhcp/option4_addrlst.h>
 #include <dhcp/option4_client_fqdn.h>
@@ -37,6 +38,7 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
@@ -454,6 +456,47 @@ TEST_F(LibDhcpTest, unpackOptions6) {
     EXPECT_TRUE(x == options.end()); // option 32000 not found */
 }
 
+// This test verifies that a part of a buffer can be parsed as options, and
+// that the offsets of the relay-msg option are those in the whole buffer.
+TEST_F(LibDhcpTest, unpackOptions6Range) {
+    OptionBuffer buf(10, 0xff);
+    buf.insert(buf.end(), v6packed, v6packed + sizeof(v6packed));
+    // A relay-msg option, followed by garbage.
+    const uint8_t relay_msg[] = { 0, 9, 0, 2, 1, 2 };
+    buf.insert(buf.end(), relay_msg, relay_msg + sizeof(relay_msg));
+    buf.insert(buf.end(), 10, 0xff);
+
+    // CLIENT_ID, SERVER_ID and RAPID_COMMIT only.
+    bundy::dhcp::OptionCollection options;
+    EXPECT_EQ(30, LibDHCP::unpackOptions6(buf, 10, 20, "dhcp6", options));
+    ASSERT_EQ(3, options.size());
+    ASSERT_TRUE(options.find(D6O_CLIENTID) != options.end());
+    EXPECT_EQ(0, memcmp(&options.find(D6O_CLIENTID)->second->getData()[0],
+                        v6packed + 4, 5));
+    EXPECT_TRUE(options.find(D6O_SERVERID) != options.end());
+    EXPECT_TRUE(options.find(D6O_RAPID_COMMIT) != options.end());
+
+    // The last options, with the relay-msg.
+    options.clear();
+    size_t relay_msg_offset = 0;
+    size_t relay_msg_len = 0;
+    const size_t offset = 10 + sizeof(v6packed) - 26;
+    EXPECT_EQ(10 + sizeof(v6packed) + sizeof(relay_msg),
+              LibDHCP::unpackOptions6(buf, offset, 26 + sizeof(relay_msg),
+                                      "dhcp6", options, &relay_msg_offset,
+                                      &relay_msg_len));
+    ASSERT_EQ(1, options.size());
+    EXPECT_TRUE(options.find(D6O_VENDOR_OPTS) != options.end());
+    EXPECT_EQ(10 + sizeof(v6packed) + 4, relay_msg_offset);
+    EXPECT_EQ(2, relay_msg_len);
+
+    // The part must be in the buffer.
+    EXPECT_THROW(LibDHCP::unpackOptions6(buf, 10, buf.size(), "dhcp6",
+                                         options), bundy::OutOfRange);
+    EXPECT_THROW(LibDHCP::unpackOptions6(buf, buf.size() + 1, 0, "dhcp6",
+                                         options), bundy::OutOfRange);
+}
+
 /// V4 Options being used to test pack/unpack operations.
 /// These are variable length options only so as there
 /// is no restriction on the data length being carried by them.
@@ -1141,6 +1184,55 @@ TEST_F(LibDhcpTest, stdOptionDefs6) {
                                     typeid(Option6AddrLst));
 }
 
+// Checks that the tables of option definitions hold the same definitions as
+// the containers, indexed by the option code.
+TEST_F(LibDhcpTest, optionDefTable) {
+    const Option::Universe universes[] = { Option::V4, Option::V6 };
+    for (int i = 0; i < 2; ++i) {
+        const Option::Universe u = universes[i];
+        const OptionDefContainer& defs = LibDHCP::getOptionDefs(u);
+        const OptionDefTable& table = LibDHCP::getOptionDefTable(u);
+        ASSERT_FALSE(defs.empty());
+
+        for (OptionDefContainer::const_iterator def = defs.begin();
+             def != defs.end(); ++def) {
+            ASSERT_LT((*def)->getCode(), table.size());
+            EXPECT_EQ(*def, table[(*def)->getCode()]);
+            EXPECT_EQ(*def, LibDHCP::getOptionDef(u, (*def)->getCode()));
+        }
+        EXPECT_EQ(defs.size(), table.size() -
+                  std::count(table.begin(), table.end(),
+                             OptionDefinitionPtr()));
+
+        // The codes past the end of the table have no definitions.
+        EXPECT_FALSE(LibDHCP::getOptionDef(u, table.size()));
+        EXPECT_FALSE(LibDHCP::getOptionDef(u, 65535));
+    }
+
+    // The same for the DOCSIS3 vendor options.
+    const OptionDefTable* table =
+        LibDHCP::getVendorOptionDefTable(Option::V6, VENDOR_ID_CABLE_LABS);
+    ASSERT_TRUE(table);
+    const OptionDefContainer* defs =
+        LibDHCP::getVendorOption6Defs(VENDOR_ID_CABLE_LABS);
+    ASSERT_TRUE(defs);
+    for (OptionDefContainer::const_iterator def = defs->begin();
+         def != defs->end(); ++def) {
+        EXPECT_EQ(*def, LibDHCP::getVendorOptionDef(Option::V6,
+                                                    VENDOR_ID_CABLE_LABS,
+                                                    (*def)->getCode()));
+    }
+    EXPECT_TRUE(LibDHCP::getVendorOptionDefTable(Option::V4,
+                                                 VENDOR_ID_CABLE_LABS));
+
+    // There are no tables for unknown vendors.
+    EXPECT_FALSE(LibDHCP::getVendorOptionDefTable(Option::V6, 1234));
+    EXPECT_FALSE(LibDHCP::getVendorOptionDef(Option::V6, 1234, 1));
+
+    // A NULL table has no definitions.
+    EXPECT_FALSE(LibDHCP::findOptionDef(NULL, 1));
+}
+
 // tests whether v6 vendor-class option can be parsed properly.
 TEST_F(LibDhcpTest, vendorClass6) {
 
@@ -398,6 +398,37 @@ TEST_F(OptionTest, v6_suboptions2) {
     EXPECT_NO_THROW(opt1.reset());
 }
 
+// Checks that the lengths of DHCPv4 options carrying sub-options are stored
+// once the sub-options are packed, also when the option is packed after
+// other data in the buffer.
+TEST_F(OptionTest, v4_suboptionsPack) {
+    OptionPtr opt1(new Option(Option::V4, 43, buf_.begin(), buf_.begin() + 2));
+    OptionPtr opt2(new Option(Option::V4, 1));
+    OptionPtr opt3(new Option(Option::V4, 2, buf_.begin() + 2,
+                              buf_.begin() + 5));
+    opt1->addOption(opt2);
+    opt2->addOption(opt3);
+
+    const uint8_t expected[] = {
+        0xaa,
+        43, 9, 255, 254,
+        1, 5,
+        2, 3, 253, 252, 251
+    };
+
+    outBuf_.writeUint8(0xaa);
+    ASSERT_NO_THROW(opt1->pack(outBuf_));
+    ASSERT_EQ(sizeof(expected), outBuf_.getLength());
+    EXPECT_EQ(0, memcmp(outBuf_.getData(), expected, sizeof(expected)));
+    EXPECT_EQ(outBuf_.getLength() - 1, opt1->len());
+
+    // An option with the sub-options longer than 255 bytes can't be packed.
+    OptionPtr opt4(new Option(Option::V4, 3, buf_.begin(), buf_.begin() + 250));
+    opt1->addOption(opt4);
+    outBuf_.clear();
+    EXPECT_THROW(opt1->pack(outBuf_), OutOfRange);
+}
+
 TEST_F(OptionTest, v6_addgetdel) {
     for (int i = 0; i < 128; i++) {
         buf_[i] = 100 + i;
@@ -18,6 +18,7 @@
 #include <dhcp/dhcp4.h>
 #include <dhcp/libdhcp++.h>
 #include <dhcp/docsis3_option_defs.h>
+#include <dhcp/option_definition.h>
 #include <dhcp/option_string.h>
 #include <dhcp/pkt4.h>
 #include <exceptions/exceptions.h>
@@ -693,6 +694,97 @@ TEST_F(Pkt4Test, unpackOptionsWithCallback) {
 
 }
 
+// This test verifies that the options are parsed on demand when the packet
+// is unpacked lazily.
+TEST_F(Pkt4Test, unpackOptionsLazy) {
+    vector<uint8_t> expectedFormat = generateTestPacket2();
+
+    expectedFormat.push_back(0x63);
+    expectedFormat.push_back(0x82);
+    expectedFormat.push_back(0x53);
+    expectedFormat.push_back(0x63);
+
+    for (int i = 0; i < sizeof(v4_opts); i++) {
+        expectedFormat.push_back(v4_opts[i]);
+    }
+
+    // Append the Lease Time option, which is too short to hold the
+    // lease time.
+    expectedFormat.push_back(DHO_DHCP_LEASE_TIME);
+    expectedFormat.push_back(1);
+    expectedFormat.push_back(0);
+
+    // The malformed option causes the whole packet to be rejected when
+    // the options are parsed eagerly.
+    Pkt4Ptr pkt(new Pkt4(&expectedFormat[0], expectedFormat.size()));
+    EXPECT_THROW(pkt->unpack(), InvalidOptionValue);
+
+    pkt.reset(new Pkt4(&expectedFormat[0], expectedFormat.size()));
+    pkt->setLazyUnpack(true);
+    ASSERT_TRUE(pkt->getLazyUnpack());
+
+    CustomUnpackCallback cb;
+    pkt->setCallback(boost::bind(&CustomUnpackCallback::execute, &cb,
+                                 _1, _2, _3));
+
+    // The only option parsed by unpack is the Message Type, used to check
+    // the packet.
+    ASSERT_NO_THROW(pkt->unpack());
+    EXPECT_TRUE(cb.executed_);
+    EXPECT_EQ(DHCPOFFER, pkt->getType());
+
+    // The other options are parsed when they are requested.
+    verifyParsedOptions(pkt);
+
+    // The malformed option is reported once, when it is requested.
+    EXPECT_THROW(pkt->getOption(DHO_DHCP_LEASE_TIME), InvalidOptionValue);
+    EXPECT_FALSE(pkt->getOption(DHO_DHCP_LEASE_TIME));
+
+    // Truncated options are rejected by unpack in the lazy mode, too.
+    expectedFormat.push_back(DHO_HOST_NAME);
+    expectedFormat.push_back(10);
+    expectedFormat.push_back(0);
+    pkt.reset(new Pkt4(&expectedFormat[0], expectedFormat.size()));
+    pkt->setLazyUnpack(true);
+    EXPECT_THROW(pkt->unpack(), OutOfRange);
+}
+
+// This test verifies that the options which haven't been requested are
+// packed when the lazily unpacked packet is packed.
+TEST_F(Pkt4Test, packLazilyUnpacked) {
+    vector<uint8_t> expectedFormat = generateTestPacket2();
+
+    expectedFormat.push_back(0x63);
+    expectedFormat.push_back(0x82);
+    expectedFormat.push_back(0x53);
+    expectedFormat.push_back(0x63);
+
+    for (int i = 0; i < sizeof(v4_opts); i++) {
+        expectedFormat.push_back(v4_opts[i]);
+    }
+    expectedFormat.push_back(DHO_END);
+
+    Pkt4Ptr eager(new Pkt4(&expectedFormat[0], expectedFormat.size()));
+    ASSERT_NO_THROW(eager->unpack());
+    ASSERT_NO_THROW(eager->pack());
+
+    Pkt4Ptr lazy(new Pkt4(&expectedFormat[0], expectedFormat.size()));
+    lazy->setLazyUnpack(true);
+    ASSERT_NO_THROW(lazy->unpack());
+    EXPECT_EQ(eager->len(), lazy->len());
+    ASSERT_NO_THROW(lazy->pack());
+
+    ASSERT_EQ(eager->getBuffer().getLength(), lazy->getBuffer().getLength());
+    EXPECT_EQ(0, memcmp(eager->getBuffer().getData(),
+                        lazy->getBuffer().getData(),
+                        lazy->getBuffer().getLength()));
+
+    // The options deleted before being parsed are not packed.
+    EXPECT_TRUE(lazy->delOption(254));
+    EXPECT_FALSE(lazy->getOption(254));
+    EXPECT_FALSE(lazy->delOption(254));
+}
+
 // This test verifies methods that are used for manipulating meta fields
 // i.e. fields that are not part of DHCPv4 (e.g. interface name).
 TEST_F(Pkt4Test, metaFields) {
@@ -673,6 +673,60 @@ TEST_F(Pkt6Test, relayPack) {
 }
 
 
+// This test verifies that a message relayed twice is packed with the
+// lengths of the relay-msg options right, and that the relays of the
+// message unpacked keep the offsets of the messages they encapsulate.
+TEST_F(Pkt6Test, relayPackNested) {
+    scoped_ptr<Pkt6> parent(new Pkt6(DHCPV6_REPLY, 0x020304));
+
+    Pkt6::RelayInfo relay1;
+    relay1.msg_type_ = DHCPV6_RELAY_REPL;
+    relay1.hop_count_ = 1;
+    relay1.linkaddr_ = IOAddress("2001:db8::1");
+    relay1.peeraddr_ = IOAddress("fe80::1");
+    OptionPtr opt_relay1(new Option(Option::V6, 200, OptionBuffer(8, 1)));
+    relay1.options_.insert(make_pair(opt_relay1->getType(), opt_relay1));
+
+    Pkt6::RelayInfo relay2;
+    relay2.msg_type_ = DHCPV6_RELAY_REPL;
+    relay2.hop_count_ = 0;
+    relay2.linkaddr_ = IOAddress("2001:db8::2");
+    relay2.peeraddr_ = IOAddress("fe80::2");
+
+    parent->addRelayInfo(relay1);
+    parent->addRelayInfo(relay2);
+    parent->addOption(OptionPtr(new Option(Option::V6, 100,
+                                           OptionBuffer(5, 2))));
+
+    ASSERT_NO_THROW(parent->pack());
+    const uint16_t inner_len = Pkt6::DHCPV6_PKT_HDR_LEN +
+        Option::OPTION6_HDR_LEN + 5;
+    const uint16_t relay2_len = Pkt6::DHCPV6_RELAY_HDR_LEN +
+        Option::OPTION6_HDR_LEN + inner_len;
+    EXPECT_EQ(relay2_len, parent->relay_info_[0].relay_msg_len_);
+    EXPECT_EQ(inner_len, parent->relay_info_[1].relay_msg_len_);
+    EXPECT_EQ(parent->len(), parent->getBuffer().getLength());
+
+    scoped_ptr<Pkt6> clone(new Pkt6(static_cast<const uint8_t*>(
+                                    parent->getBuffer().getData()),
+                                    parent->getBuffer().getLength()));
+    ASSERT_TRUE(clone->unpack());
+    EXPECT_EQ(DHCPV6_REPLY, clone->getType());
+    EXPECT_TRUE(clone->getOption(100));
+    ASSERT_EQ(2, clone->relay_info_.size());
+    EXPECT_TRUE(clone->getRelayOption(200, 0));
+    EXPECT_EQ("2001:db8::2", clone->relay_info_[1].linkaddr_.toText());
+
+    const Pkt6::RelayInfo& outer = clone->relay_info_[0];
+    const Pkt6::RelayInfo& inner = clone->relay_info_[1];
+    EXPECT_EQ(relay2_len, outer.relay_msg_len_);
+    EXPECT_EQ(inner_len, inner.relay_msg_len_);
+    EXPECT_EQ(clone->data_.size(), outer.relay_msg_offset_ + relay2_len);
+    EXPECT_EQ(clone->data_.size(), inner.relay_msg_offset_ + inner_len);
+    EXPECT_EQ(DHCPV6_RELAY_REPL, clone->data_[outer.relay_msg_offset_]);
+    EXPECT_EQ(DHCPV6_REPLY, clone->data_[inner.relay_msg_offset_]);
+}
+
 // This test verified that options added by relays to the message can be
 // accessed and retrieved properly
 TEST_F(Pkt6Test, getAnyRelayOption) {
@@ -150,4 +150,42 @@ TEST_F(PktFilterInetTest, receive) {
     testRcvdMessage(rcvd_pkt);
 }
 
+// This test verifies that several DHCPv4 packets can be received at once.
+TEST_F(PktFilterInetTest, receiveBatch) {
+
+    // Packets will be received over loopback interface.
+    Iface iface(ifname_, ifindex_);
+    IOAddress addr("127.0.0.1");
+
+    PktFilterInet pkt_filter;
+    sock_info_ = pkt_filter.openSocket(iface, addr, PORT, false, false);
+    ASSERT_GE(sock_info_.sockfd_, 0);
+
+    // Send three messages to the server's port.
+    for (int i = 0; i < 3; ++i) {
+        sendMessage();
+    }
+
+    // The number of packets received is limited by the batch size. Any
+    // packets received are appended after the existing ones.
+    std::vector<Pkt4Ptr> pkts(1);
+    size_t count = pkt_filter.receiveBatch(iface, sock_info_, 2, pkts);
+    ASSERT_GE(count, 1);
+    ASSERT_EQ(count + 1, pkts.size());
+    EXPECT_FALSE(pkts[0]);
+
+    // The rest of the packets is received by the next call.
+    count += pkt_filter.receiveBatch(iface, sock_info_, 16, pkts);
+    ASSERT_EQ(3, count);
+    ASSERT_EQ(4, pkts.size());
+    for (int i = 1; i < pkts.size(); ++i) {
+        ASSERT_TRUE(pkts[i]);
+        ASSERT_NO_THROW(pkts[i]->unpack());
+        testRcvdMessage(pkts[i]);
+    }
+
+    // There is no more data, and the call doesn't block.
+    EXPECT_EQ(0, pkt_filter.receiveBatch(iface, sock_info_, 16, pkts));
+}
+
 } // anonymous namespace
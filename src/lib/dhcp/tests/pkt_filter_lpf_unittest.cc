@@ -54,6 +54,12 @@ TEST_F(PktFilterLPFTest, isDirectResponseSupported) {
     EXPECT_TRUE(pkt_filter.isDirectResponseSupported());
 }
 
+// This test verifies that the receive rings are only used when requested.
+TEST_F(PktFilterLPFTest, useRings) {
+    EXPECT_FALSE(PktFilterLPF().useRings());
+    EXPECT_TRUE(PktFilterLPF(true).useRings());
+}
+
 // All tests below require root privileges to execute successfully. If
 // they are run as non-root user they will fail due to insufficient privileges
 // to open raw network sockets. Therefore, they should remain disabled by default
@@ -189,4 +195,76 @@ TEST_F(PktFilterLPFTest, DISABLED_receive) {
     testRcvdMessage(rcvd_pkt);
 }
 
+// This test verifies that the packets are received through the receive
+// ring of the raw socket.
+TEST_F(PktFilterLPFTest, DISABLED_receiveRing) {
+
+    // Packets will be received over loopback interface.
+    Iface iface(ifname_, ifindex_);
+    IOAddress addr("127.0.0.1");
+
+    PktFilterLPF pkt_filter(true);
+    sock_info_ = pkt_filter.openSocket(iface, addr, PORT, false, false);
+    ASSERT_GE(sock_info_.sockfd_, 0);
+
+    sendMessage();
+
+    // The packet is received from the ring.
+    Pkt4Ptr rcvd_pkt = pkt_filter.receive(iface, sock_info_);
+    ASSERT_TRUE(rcvd_pkt);
+    ASSERT_NO_THROW(rcvd_pkt->unpack());
+    testRcvdMessage(rcvd_pkt);
+
+    // The socket may be closed and opened again, reusing the descriptor.
+    close(sock_info_.sockfd_);
+    close(sock_info_.fallbackfd_);
+    sock_info_ = pkt_filter.openSocket(iface, addr, PORT, false, false);
+    ASSERT_GE(sock_info_.sockfd_, 0);
+
+    sendMessage();
+
+    rcvd_pkt = pkt_filter.receive(iface, sock_info_);
+    ASSERT_TRUE(rcvd_pkt);
+    ASSERT_NO_THROW(rcvd_pkt->unpack());
+    testRcvdMessage(rcvd_pkt);
+}
+
+// This test verifies that all the packets waiting in the receive ring are
+// received in a batch.
+TEST_F(PktFilterLPFTest, DISABLED_receiveBatchRing) {
+
+    // Packets will be received over loopback interface.
+    Iface iface(ifname_, ifindex_);
+    IOAddress addr("127.0.0.1");
+
+    PktFilterLPF pkt_filter(true);
+    sock_info_ = pkt_filter.openSocket(iface, addr, PORT, false, false);
+    ASSERT_GE(sock_info_.sockfd_, 0);
+
+    // Send three messages to the server's port.
+    for (int i = 0; i < 3; ++i) {
+        sendMessage();
+    }
+
+    // Wait for the first packet, after which the others are in the ring.
+    // The copies of the packets sent over the loopback are skipped.
+    std::vector<Pkt4Ptr> pkts;
+    pkts.push_back(pkt_filter.receive(iface, sock_info_));
+
+    // The number of packets received is limited by the batch size.
+    size_t count = pkt_filter.receiveBatch(iface, sock_info_, 1, pkts);
+    ASSERT_EQ(1, count);
+    count += pkt_filter.receiveBatch(iface, sock_info_, 16, pkts);
+    ASSERT_EQ(2, count);
+    ASSERT_EQ(3, pkts.size());
+    for (int i = 0; i < pkts.size(); ++i) {
+        ASSERT_TRUE(pkts[i]);
+        ASSERT_NO_THROW(pkts[i]->unpack());
+        testRcvdMessage(pkts[i]);
+    }
+
+    // There is no more data, and the call doesn't block.
+    EXPECT_EQ(0, pkt_filter.receiveBatch(iface, sock_info_, 16, pkts));
+}
+
 } // anonymous namespace
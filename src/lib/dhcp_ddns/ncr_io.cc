@@ -155,6 +155,39 @@ NameChangeListener::invokeRecvHandler(const Result result,
     }
 }
 
+void
+NameChangeListener::invokeRecvHandler(const Result result,
+                                      NameChangeRequestList& ncrs) {
+    // Hand all but the last request to the application layer handler here.
+    // The last one is handed over by the single request variant, which also
+    // starts the next receive.
+    io_pending_ = false;
+    for (size_t i = 0; i < ncrs.size(); ++i) {
+        if (!amListening()) {
+            // The handler stopped listening, drop the remaining requests.
+            LOG_WARN(dhcp_ddns_logger, DHCP_DDNS_NCR_RECV_DISCARDED)
+                     .arg(ncrs.size() - i);
+            return;
+        }
+
+        if (i + 1 == ncrs.size()) {
+            invokeRecvHandler(result, ncrs[i]);
+            return;
+        }
+
+        // Surround the invocation with a try-catch. The invoked handler is
+        // not supposed to throw, but in the event it does we will at least
+        // report it.
+        try {
+            recv_handler_(result, ncrs[i]);
+        } catch (const std::exception& ex) {
+            LOG_ERROR(dhcp_ddns_logger,
+                      DHCP_DDNS_UNCAUGHT_NCR_RECV_HANDLER_ERROR)
+                      .arg(ex.what());
+        }
+    }
+}
+
 //************************* NameChangeSender ******************************
 
 NameChangeSender::NameChangeSender(RequestSendHandler& send_handler,
@@ -271,7 +304,8 @@ NameChangeSender::sendNext() {
 }
 
 void
-NameChangeSender::invokeSendHandler(const NameChangeSender::Result result) {
+NameChangeSender::invokeSendHandler(const NameChangeSender::Result result,
+                                    const size_t count) {
     // @todo reset defense timer
     if (result == SUCCESS) {
         // It shipped so pull it off the queue.
@@ -290,6 +324,22 @@ NameChangeSender::invokeSendHandler(const NameChangeSender::Result result) {
                   .arg(ex.what());
     }
 
+    // If other requests shipped along with the pending one, pull them off
+    // the queue and invoke the completion handler for each of them too.
+    if (result == SUCCESS) {
+        for (size_t i = 1; (i < count) && !send_queue_.empty(); ++i) {
+            NameChangeRequestPtr ncr = send_queue_.front();
+            send_queue_.pop_front();
+            try {
+                send_handler_(result, ncr);
+            } catch (const std::exception& ex) {
+                LOG_ERROR(dhcp_ddns_logger,
+                          DHCP_DDNS_UNCAUGHT_NCR_SEND_HANDLER_ERROR)
+                          .arg(ex.what());
+            }
+        }
+    }
+
     // Clear the pending ncr pointer.
     ncr_to_send_.reset();
 
@@ -273,6 +273,20 @@ protected:
     /// wise.
     void invokeRecvHandler(const Result result, NameChangeRequestPtr& ncr);
 
+    /// @brief Calls the NCR receive handler for each of a list of requests.
+    ///
+    /// This variant is used by derivations which may receive several
+    /// requests in a single IO layer read.  The handler is invoked for each
+    /// request in the list, in order, and the next IO layer asynchronous
+    /// receive is started after the last one.  Should the handler stop
+    /// listening part way through the list, the remaining requests are
+    /// discarded.
+    ///
+    /// @param result contains that receive outcome status.
+    /// @param ncrs is the list of newly received NameChangeRequests. It
+    /// must not be empty.
+    void invokeRecvHandler(const Result result, NameChangeRequestList& ncrs);
+
     /// @brief Abstract method which opens the IO source for reception.
     ///
     /// The derivation uses this method to perform the steps needed to
@@ -616,7 +630,15 @@ protected:
     /// the interface contract.
     ///
     /// @param result contains that send outcome status.
-    void invokeSendHandler(const NameChangeSender::Result result);
+    /// @param count is the number of requests, starting at the front of the
+    /// queue, that were delivered by the send.  Derivations which pack
+    /// several requests into a single IO layer send pass the number of
+    /// requests packed.  If the send was a success, the handler is invoked
+    /// for each of them and all of them are removed from the queue.  If
+    /// not, the handler is invoked for the first one only and all of them
+    /// remain queued to be retried.
+    void invokeSendHandler(const NameChangeSender::Result result,
+                           const size_t count = 1);
 
     /// @brief Abstract method which opens the IO sink for transmission.
     ///
@@ -34,6 +34,10 @@ NameChangeFormat stringToNcrFormat(const std::string& fmt_str) {
         return FMT_JSON;
     }
 
+    if (boost::iequals(fmt_str, "BINARY")) {
+        return FMT_BINARY;
+    }
+
     bundy_throw(BadValue, "Invalid NameChangeRequest format:" << fmt_str);
 }
 
@@ -43,6 +47,10 @@ std::string ncrFormatToString(NameChangeFormat format) {
         return ("JSON");
     }
 
+    if (format == FMT_BINARY) {
+        return ("BINARY");
+    }
+
     std::ostringstream stream;
     stream  << "UNKNOWN(" << format << ")";
     return (stream.str());
@@ -62,6 +70,14 @@ const uint8_t DHCID_ID_CLIENTID = 0x1;
 /// DHCID created from DUID.
 const uint8_t DHCID_ID_DUID     = 0x2;
 
+/// @name Constants which define the flags of the binary format.
+//@{
+/// The request has a forward change.
+const uint8_t BINARY_FLAG_FORWARD = 0x1;
+/// The request has a reverse change.
+const uint8_t BINARY_FLAG_REVERSE = 0x2;
+//@}
+
 }
 
 D2Dhcid::D2Dhcid() {
@@ -209,6 +225,8 @@ operator<<(std::ostream& os, const D2Dhcid& dhcid) {
 
 /**************************** NameChangeRequest ******************************/
 
+const uint8_t NameChangeRequest::BINARY_FORMAT_VERSION;
+
 NameChangeRequest::NameChangeRequest()
     : change_type_(CHG_ADD), forward_change_(false),
     reverse_change_(false), fqdn_(""), ip_io_address_("0.0.0.0"),
@@ -265,6 +283,10 @@ NameChangeRequest::fromFormat(const NameChangeFormat format,
 
         break;
         }
+    case FMT_BINARY:
+        // The binary factory may throw NcrMessageError.
+        ncr = NameChangeRequest::fromBinary(buffer);
+        break;
     default:
         // Programmatic error, shouldn't happen.
         bundy_throw(NcrMessageError, "fromFormat - invalid format");
@@ -291,6 +313,9 @@ NameChangeRequest::toFormat(const NameChangeFormat format,
         buffer.writeData(json.c_str(), length);
         break;
         }
+    case FMT_BINARY:
+        toBinary(buffer);
+        break;
     default:
         // Programmatic error, shouldn't happen.
         bundy_throw(NcrMessageError, "toFormat - invalid format");
@@ -359,6 +384,88 @@ NameChangeRequest::fromJSON(const std::string& json) {
     return (ncr);
 }
 
+NameChangeRequestPtr
+NameChangeRequest::fromBinary(bundy::util::InputBuffer& buffer) {
+    NameChangeRequestPtr ncr(new NameChangeRequest());
+    try {
+        uint8_t version = buffer.readUint8();
+        if (version != BINARY_FORMAT_VERSION) {
+            bundy_throw(NcrMessageError, "fromBinary: unsupported version: "
+                        << static_cast<int>(version));
+        }
+
+        uint8_t change_type = buffer.readUint8();
+        if (change_type > CHG_REMOVE) {
+            bundy_throw(NcrMessageError, "fromBinary: invalid change type: "
+                        << static_cast<int>(change_type));
+        }
+        ncr->setChangeType(static_cast<NameChangeType>(change_type));
+
+        uint8_t flags = buffer.readUint8();
+        ncr->setForwardChange(flags & BINARY_FLAG_FORWARD);
+        ncr->setReverseChange(flags & BINARY_FLAG_REVERSE);
+
+        std::vector<uint8_t> vec;
+        buffer.readVector(vec, buffer.readUint16());
+        ncr->setFqdn(std::string(vec.begin(), vec.end()));
+
+        size_t addr_len = buffer.readUint8();
+        if ((addr_len != asiolink::V4ADDRESS_LEN) &&
+            (addr_len != asiolink::V6ADDRESS_LEN)) {
+            bundy_throw(NcrMessageError, "fromBinary: invalid address length: "
+                        << addr_len);
+        }
+        buffer.readVector(vec, addr_len);
+        ncr->ip_io_address_ = bundy::asiolink::IOAddress::
+            fromBytes(addr_len == asiolink::V4ADDRESS_LEN ? AF_INET : AF_INET6,
+                      &vec[0]);
+
+        buffer.readVector(vec, buffer.readUint16());
+        ncr->dhcid_.fromBytes(vec);
+
+        uint64_t expires_on = buffer.readUint32();
+        expires_on = (expires_on << 32) | buffer.readUint32();
+        ncr->lease_expires_on_ = expires_on;
+
+        ncr->setLeaseLength(buffer.readUint32());
+    } catch (bundy::util::InvalidBufferPosition& ex) {
+        // Read error accessing data in InputBuffer.
+        bundy_throw(NcrMessageError, "fromBinary: buffer read error: "
+                  << ex.what());
+    }
+
+    // Validate the overall content semantically.  This will throw an
+    // NcrMessageError if anything is amiss.
+    ncr->validateContent();
+    return (ncr);
+}
+
+void
+NameChangeRequest::toBinary(bundy::util::OutputBuffer& buffer) const {
+    buffer.writeUint8(BINARY_FORMAT_VERSION);
+    buffer.writeUint8(getChangeType());
+    buffer.writeUint8((isForwardChange() ? BINARY_FLAG_FORWARD : 0) |
+                      (isReverseChange() ? BINARY_FLAG_REVERSE : 0));
+
+    const std::string& fqdn = getFqdn();
+    buffer.writeUint16(fqdn.size());
+    buffer.writeData(fqdn.c_str(), fqdn.size());
+
+    std::vector<uint8_t> addr = ip_io_address_.toBytes();
+    buffer.writeUint8(addr.size());
+    buffer.writeData(&addr[0], addr.size());
+
+    const std::vector<uint8_t>& dhcid = dhcid_.getBytes();
+    buffer.writeUint16(dhcid.size());
+    if (!dhcid.empty()) {
+        buffer.writeData(&dhcid[0], dhcid.size());
+    }
+
+    buffer.writeUint32(lease_expires_on_ >> 32);
+    buffer.writeUint32(lease_expires_on_ & 0xffffffff);
+    buffer.writeUint32(getLeaseLength());
+}
+
 std::string
 NameChangeRequest::toJSON() const  {
     // Create a JSON string of this request's contents.  Note that this method
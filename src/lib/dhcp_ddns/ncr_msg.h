@@ -67,13 +67,14 @@ enum NameChangeStatus  {
 
 /// @brief Defines the list of data wire formats supported.
 enum NameChangeFormat {
-  FMT_JSON
+  FMT_JSON,
+  FMT_BINARY
 };
 
 /// @brief Function which converts labels to  NameChangeFormat enum values.
 ///
 /// @param fmt_str text to convert to an enum.
-/// Valid string values: "JSON"
+/// Valid string values: "JSON", "BINARY"
 ///
 /// @return NameChangeFormat value which maps to the given string.
 ///
@@ -172,6 +173,13 @@ public:
     void fromHWAddr(const bundy::dhcp::HWAddrPtr& hwaddr,
                     const std::vector<uint8_t>& wire_fqdn);
 
+    /// @brief Sets the DHCID value to the given bytes.
+    ///
+    /// @param bytes the DHCID value in unsigned bytes.
+    void fromBytes(const std::vector<uint8_t>& bytes) {
+        bytes_ = bytes;
+    }
+
     /// @brief Returns a reference to the DHCID byte vector.
     ///
     /// @return a reference to the vector.
@@ -222,6 +230,9 @@ class NameChangeRequest;
 /// @brief Defines a pointer to a NameChangeRequest.
 typedef boost::shared_ptr<NameChangeRequest> NameChangeRequestPtr;
 
+/// @brief Defines a list of pointers to NameChangeRequests.
+typedef std::vector<NameChangeRequestPtr> NameChangeRequestList;
+
 /// @brief Defines a map of Elements, keyed by their string name.
 typedef std::map<std::string, bundy::data::ConstElementPtr> ElementMap;
 
@@ -229,11 +240,14 @@ typedef std::map<std::string, bundy::data::ConstElementPtr> ElementMap;
 /// This class is used by DHCP-DDNS clients (e.g. DHCP4, DHCP6) to
 /// request DNS updates.  Each message contains a single DNS change (either an
 /// add/update or a remove) for a single FQDN.  It provides marshalling services
-/// for moving instances to and from the wire.  Currently, the only format
-/// supported is JSON, however the class provides an interface such that other
-/// formats can be readily supported.
+/// for moving instances to and from the wire.  The formats supported are
+/// JSON and a compact binary format, and the class provides an interface
+/// such that other formats can be readily supported.
 class NameChangeRequest {
 public:
+    /// @brief Version of the binary format written by toBinary().
+    static const uint8_t BINARY_FORMAT_VERSION = 1;
+
     /// @brief Default Constructor.
     ///
     /// @todo Currently, fromWire makes use of the ability to create an empty
@@ -280,7 +294,12 @@ public:
     /// is than treated as JSON which is then parsed into the data needed
     /// to create a request instance.
     ///
-    /// (NOTE currently only JSON is supported.)
+    /// BINARY: The buffer is expected to contain a request as written by
+    /// toBinary().  See fromBinary() for details.
+    ///
+    /// In either format the buffer may hold further requests after the one
+    /// extracted.  Upon return the buffer is positioned at the first byte
+    /// following the extracted request.
     ///
     /// @param format indicates the data format to use
     /// @param buffer is the input buffer containing the marshalled request
@@ -303,7 +322,11 @@ public:
     /// the request data needed to reassemble the request on the receiving
     /// end. The JSON text in the buffer is NOT null-terminated.
     ///
-    /// (NOTE currently only JSON is supported.)
+    /// BINARY: Upon completion, the buffer will contain the request as
+    /// written by toBinary().
+    ///
+    /// The request is appended to the buffer contents, so several requests
+    /// may be marshalled into the same buffer one after another.
     ///
     /// @param format indicates the data format to use
     /// @param buffer is the output buffer to which the request should be
@@ -327,6 +350,40 @@ public:
     /// @return a string containing the JSON rendition of the request
     std::string toJSON() const;
 
+    /// @brief Static method for creating a NameChangeRequest from a
+    /// buffer containing the binary rendition of a request.
+    ///
+    /// The binary rendition starts with a one byte format version which
+    /// must be @c BINARY_FORMAT_VERSION, followed by the request members
+    /// in network byte order:
+    ///
+    /// - change type (one byte)
+    /// - flags (one byte): 0x01 for forward change, 0x02 for reverse change
+    /// - length of the FQDN text (two bytes), followed by the text
+    /// - length of the IP address (one byte, either 4 or 16), followed by
+    /// the address bytes
+    /// - length of the DHCID (two bytes), followed by the DHCID bytes
+    /// - lease expiration time in seconds since the epoch (eight bytes)
+    /// - lease length (four bytes)
+    ///
+    /// Unlike JSON, no text has to be parsed to read the rendition, which
+    /// makes it cheaper to process for the both sides of a busy connection.
+    ///
+    /// @param buffer is the input buffer containing the marshalled request
+    ///
+    /// @return a pointer to the new NameChangeRequest
+    ///
+    /// @throw NcrMessageError if the version is not supported, the buffer
+    /// is too short or the content of the request is invalid.
+    static NameChangeRequestPtr fromBinary(bundy::util::InputBuffer& buffer);
+
+    /// @brief Instance method for marshalling the contents of the request
+    /// into the given buffer in the binary format.
+    ///
+    /// @param buffer is the output buffer to which the request should be
+    /// marshalled.  See fromBinary() for the description of the format.
+    void toBinary(bundy::util::OutputBuffer& buffer) const;
+
     /// @brief Validates the content of a populated request.  This method is
     /// used by both the full constructor and from-wire marshalling to ensure
     /// that the request is content valid.  Currently it enforces the
@@ -166,17 +166,32 @@ NameChangeUDPListener::receiveCompletionHandler(const bool successful,
         bundy::util::InputBuffer input_buffer(callback->getData(),
                                             callback->getBytesTransferred());
 
+        // A sender may pack several requests into one packet, so extract
+        // requests until the buffer is exhausted.
+        NameChangeRequestList ncrs;
         try {
-            ncr = NameChangeRequest::fromFormat(format_, input_buffer);
+            do {
+                ncrs.push_back(NameChangeRequest::fromFormat(format_,
+                                                             input_buffer));
+            } while (input_buffer.getPosition() < input_buffer.getLength());
         } catch (const NcrMessageError& ex) {
             // log it and go back to listening
             LOG_ERROR(dhcp_ddns_logger, DHCP_DDNS_INVALID_NCR).arg(ex.what());
 
-            // Queue up the next recieve.
-            // NOTE: We must call the base class, NEVER doReceive
-            receiveNext();
-            return;
+            if (ncrs.empty()) {
+                // Queue up the next recieve.
+                // NOTE: We must call the base class, NEVER doReceive
+                receiveNext();
+                return;
+            }
+
+            // The requests preceding the invalid one are still delivered.
         }
+
+        // Call the application's registered request receive handler for
+        // each request.
+        invokeRecvHandler(result, ncrs);
+        return;
     } else {
         asio::error_code error_code = callback->getErrorCode();
         if (error_code.value() == asio::error::operation_aborted) {
@@ -207,7 +222,7 @@ NameChangeUDPSender(const bundy::asiolink::IOAddress& ip_address,
     : NameChangeSender(ncr_send_handler, send_que_max),
       ip_address_(ip_address), port_(port), server_address_(server_address),
       server_port_(server_port), format_(format),
-      reuse_address_(reuse_address) {
+      max_batch_size_(1), batch_size_(0), reuse_address_(reuse_address) {
     // Instantiate the send callback.  This gets passed into each send.
     // Note that the callback constructor is passed the an instance method
     // pointer to our completion handler, sendCompletionHandler.
@@ -287,12 +302,39 @@ NameChangeUDPSender::close() {
     watch_socket_.reset();
 }
 
+void
+NameChangeUDPSender::setMaxBatchSize(const size_t max_batch_size) {
+    if (max_batch_size == 0) {
+        bundy_throw(NcrSenderError, "NameChangeUDPSender:"
+                    " batch size must be greater than zero");
+    }
+
+    max_batch_size_ = max_batch_size;
+}
+
 void
 NameChangeUDPSender::doSend(NameChangeRequestPtr& ncr) {
-    // Now use the NCR to write JSON to an output buffer.
+    // Now use the NCR to write its wire form to an output buffer.
     bundy::util::OutputBuffer ncr_buffer(SEND_BUF_MAX);
     ncr->toFormat(format_, ncr_buffer);
 
+    // The given request is at the front of the queue.  Append as many of
+    // the requests queued behind it as the batch size and the packet size
+    // allow.
+    batch_size_ = 1;
+    while ((batch_size_ < max_batch_size_) &&
+           (batch_size_ < getQueueSize())) {
+        const size_t length = ncr_buffer.getLength();
+        peekAt(batch_size_)->toFormat(format_, ncr_buffer);
+        if (ncr_buffer.getLength() > SEND_BUF_MAX) {
+            // It doesn't fit, leave it for the next packet.
+            ncr_buffer.trim(ncr_buffer.getLength() - length);
+            break;
+        }
+
+        ++batch_size_;
+    }
+
     // Copy the wire-ized request to callback.  This way we know after
     // send completes what we sent (or attempted to send).
     send_callback_->putData(static_cast<const uint8_t*>(ncr_buffer.getData()),
@@ -346,7 +388,7 @@ NameChangeUDPSender::sendCompletionHandler(const bool successful,
     }
 
     // Call the application's registered request send handler.
-    invokeSendHandler(result);
+    invokeSendHandler(result, batch_size_);
 }
 
 int
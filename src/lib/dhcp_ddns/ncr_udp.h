@@ -385,14 +385,16 @@ public:
     /// passing in the boolean success indicator and pointer to itself.
     ///
     /// If the indicator denotes success, then the method will attempt to
-    /// to construct a NameChangeRequest from the received data.  If the
-    /// construction was successful, it will send the new NCR to the
-    /// application layer by calling invokeRecvHandler() with a success
-    /// status and a pointer to the new NCR.
+    /// to construct NameChangeRequests from the received data, which may
+    /// carry several requests one after another.  If the construction was
+    /// successful, it will send the new NCRs to the application layer by
+    /// calling invokeRecvHandler() with a success status and the list of
+    /// the new NCRs.
     ///
     /// If the buffer contains invalid data such that construction fails,
-    /// the method will log the failure and then call doReceive() to start a
-    /// initiate the next receive.
+    /// the method will log the failure.  The NCRs constructed before the
+    /// failure are sent to the application layer, if there are none it will
+    /// call doReceive() to start a initiate the next receive.
     ///
     /// If the indicator denotes failure the method will log the failure and
     /// notify the application layer by calling invokeRecvHandler() with
@@ -497,13 +499,34 @@ public:
     /// @throw NcrUDPError if the open fails.
     virtual void close();
 
+    /// @brief Returns the maximum number of requests sent in one packet.
+    size_t getMaxBatchSize() const {
+        return (max_batch_size_);
+    }
+
+    /// @brief Sets the maximum number of requests sent in one packet.
+    ///
+    /// With a value greater than one, the requests waiting in the send
+    /// queue behind the one being sent are packed into the same packet,
+    /// as long as they fit.  Nothing waits for a batch to fill up: a packet
+    /// carries the requests that are queued when it is sent, so batches
+    /// only form when requests arrive faster than they can be sent. The
+    /// default is one, as listeners prior to the support of batches only
+    /// read the first request of a packet.
+    ///
+    /// @param max_batch_size the new maximum number of requests per packet.
+    ///
+    /// @throw NcrSenderError if the value is less than one.
+    void setMaxBatchSize(const size_t max_batch_size);
+
     /// @brief Sends a given request asynchronously over the socket
     ///
-    /// The given NameChangeRequest is converted to wire format and copied
-    /// into the send callback's transfer buffer.  Then the socket's
-    /// asyncSend() method is called, passing in send_callback_ member's
-    /// transfer buffer as the send buffer and the send_callback_ itself
-    /// as the callback object.
+    /// The given NameChangeRequest, and as many of the requests queued
+    /// behind it as the maximum batch size allows, are converted to wire
+    /// format and copied into the send callback's transfer buffer.  Then
+    /// the socket's asyncSend() method is called, passing in send_callback_
+    /// member's transfer buffer as the send buffer and the send_callback_
+    /// itself as the callback object.
     /// @param ncr NameChangeRequest to send.
     virtual void doSend(NameChangeRequestPtr& ncr);
 
@@ -563,6 +586,12 @@ private:
     /// @brief Wire format of the outbound requests.
     NameChangeFormat format_;
 
+    /// @brief Maximum number of requests sent in one packet.
+    size_t max_batch_size_;
+
+    /// @brief Number of requests in the packet being sent.
+    size_t batch_size_;
+
     /// @brief Low level socket underneath the sending socket.
     boost::shared_ptr<asio::ip::udp::socket> asio_socket_;
 
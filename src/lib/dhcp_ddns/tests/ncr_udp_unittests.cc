@@ -160,6 +160,7 @@ public:
     NameChangeListener::Result result_;
     NameChangeRequestPtr sent_ncr_;
     NameChangeRequestPtr received_ncr_;
+    std::vector<NameChangeRequestPtr> received_ncrs_;
     NameChangeListenerPtr listener_;
     bundy::asiolink::IntervalTimer test_timer_;
 
@@ -222,6 +223,7 @@ public:
         // save the result and the NCR we received
         result_ = result;
         received_ncr_ = ncr;
+        received_ncrs_.push_back(ncr);
     }
     // @brief Handler invoked when test timeout is hit.
     //
@@ -269,6 +271,66 @@ TEST_F(NameChangeUDPListenerTest, basicReceivetest) {
     EXPECT_FALSE(listener_->isIoPending());
 }
 
+/// @brief Tests NameChangeUDPListener ability to receive several NCRs in
+/// a single packet.
+/// This test verifies that all of the NCRs a packet carries are delivered
+/// to the "application" layer in order, and that the NCRs which precede
+/// invalid data in a packet are still delivered.
+TEST_F(NameChangeUDPListenerTest, multipleReceivetest) {
+    ASSERT_NO_THROW(listener_->startListening(io_service_));
+
+    // Marshal all of the requests into one buffer.
+    std::vector<NameChangeRequestPtr> sent_ncrs;
+    bundy::util::OutputBuffer ncr_buffer(1024);
+    int num_msgs = sizeof(valid_msgs)/sizeof(char*);
+    for (int i = 0; i < num_msgs; i++) {
+        NameChangeRequestPtr ncr;
+        ASSERT_NO_THROW(ncr = NameChangeRequest::fromJSON(valid_msgs[i]));
+        ASSERT_NO_THROW(ncr->toFormat(FMT_JSON, ncr_buffer));
+        sent_ncrs.push_back(ncr);
+    }
+
+    asio::ip::udp::socket
+        udp_socket(io_service_.get_io_service(), asio::ip::udp::v4());
+    asio::ip::udp::endpoint
+        listener_endpoint(asio::ip::address::from_string(TEST_ADDRESS),
+                          LISTENER_PORT);
+    udp_socket.send_to(asio::buffer(ncr_buffer.getData(),
+                                    ncr_buffer.getLength()),
+                       listener_endpoint);
+
+    // A single receive completion delivers all of them.
+    EXPECT_NO_THROW(io_service_.run_one());
+    EXPECT_EQ(NameChangeListener::SUCCESS, result_);
+    ASSERT_EQ(num_msgs, received_ncrs_.size());
+    for (int i = 0; i < num_msgs; i++) {
+        EXPECT_TRUE(checkSendVsReceived(sent_ncrs[i], received_ncrs_[i]));
+    }
+
+    // Now follow the first request with garbage.
+    received_ncrs_.clear();
+    ASSERT_TRUE(listener_->isIoPending());
+    ncr_buffer.clear();
+    ASSERT_NO_THROW(sent_ncrs[0]->toFormat(FMT_JSON, ncr_buffer));
+    ncr_buffer.writeUint16(1);
+    ncr_buffer.writeUint8('{');
+    udp_socket.send_to(asio::buffer(ncr_buffer.getData(),
+                                    ncr_buffer.getLength()),
+                       listener_endpoint);
+
+    EXPECT_NO_THROW(io_service_.run_one());
+    ASSERT_EQ(1, received_ncrs_.size());
+    EXPECT_TRUE(checkSendVsReceived(sent_ncrs[0], received_ncrs_[0]));
+
+    // Verify that the listener goes on listening.
+    EXPECT_TRUE(listener_->amListening());
+    EXPECT_TRUE(listener_->isIoPending());
+
+    EXPECT_NO_THROW(listener_->stopListening());
+    EXPECT_NO_THROW(io_service_.run_one());
+    EXPECT_FALSE(listener_->isIoPending());
+}
+
 /// @brief A NOP derivation for constructor test purposes.
 class SimpleSendHandler : public NameChangeSender::RequestSendHandler {
 public:
@@ -322,6 +384,27 @@ TEST(NameChangeUDPSenderBasicTest, constructionTests) {
     EXPECT_EQ(100, sender->getQueueMaxSize());
 }
 
+/// @brief Tests the NameChangeUDPSender maximum batch size.
+/// This test verifies that:
+/// 1. The default maximum batch size is one
+/// 2. Setting it to 0 is not allowed
+/// 3. Setting it to a valid value works
+TEST(NameChangeUDPSenderBasicTest, maxBatchSize) {
+    bundy::asiolink::IOAddress ip_address(TEST_ADDRESS);
+    uint32_t port = SENDER_PORT;
+    SimpleSendHandler ncr_handler;
+
+    NameChangeUDPSender sender(ip_address, port, ip_address, port,
+                               FMT_BINARY, ncr_handler);
+    EXPECT_EQ(1, sender.getMaxBatchSize());
+
+    EXPECT_THROW(sender.setMaxBatchSize(0), NcrSenderError);
+    EXPECT_EQ(1, sender.getMaxBatchSize());
+
+    EXPECT_NO_THROW(sender.setMaxBatchSize(32));
+    EXPECT_EQ(32, sender.getMaxBatchSize());
+}
+
 /// @brief Tests NameChangeUDPSender basic send functionality
 /// This test verifies that:
 TEST(NameChangeUDPSenderBasicTest, basicSendTests) {
@@ -646,6 +729,24 @@ public:
         received_ncrs_.clear();
     }
 
+    /// @brief Replaces the listener and the sender with ones which use
+    /// the binary format.
+    ///
+    /// @param max_batch_size the maximum number of requests the sender
+    /// packs into one packet.
+    void useBinaryFormat(const size_t max_batch_size) {
+        bundy::asiolink::IOAddress addr(TEST_ADDRESS);
+        listener_.reset(
+            new NameChangeUDPListener(addr, LISTENER_PORT, FMT_BINARY,
+                                      *this, true));
+
+        NameChangeUDPSender* sender =
+            new NameChangeUDPSender(addr, SENDER_PORT, addr, LISTENER_PORT,
+                                    FMT_BINARY, *this, 100, true);
+        sender->setMaxBatchSize(max_batch_size);
+        sender_.reset(sender);
+    }
+
     /// @brief Implements the receive completion handler.
     virtual void operator ()(const NameChangeListener::Result result,
                              NameChangeRequestPtr& ncr) {
@@ -724,6 +825,59 @@ TEST_F (NameChangeUDPTest, roundTripTest) {
     EXPECT_FALSE(sender_->amSending());
 }
 
+/// @brief Uses a batching sender and listener to test UDP-based NCR delivery
+/// in the binary format.
+/// The test verifies that what was sent matches what was received both in
+/// quantity and in content, and that the requests which queue up while a
+/// packet is being sent go together in the next packet.
+TEST_F (NameChangeUDPTest, batchedRoundTripTest) {
+    useBinaryFormat(32);
+
+    ASSERT_NO_THROW(listener_->startListening(io_service_));
+    ASSERT_NO_THROW(sender_->startSending(io_service_));
+
+    // The first request is sent right away, the others are queued behind
+    // it.
+    int num_msgs = sizeof(valid_msgs)/sizeof(char*);
+    ASSERT_LT(1, num_msgs);
+    for (int i = 0; i < num_msgs; i++) {
+        NameChangeRequestPtr ncr;
+        ASSERT_NO_THROW(ncr = NameChangeRequest::fromJSON(valid_msgs[i]));
+        sender_->sendRequest(ncr);
+    }
+
+    // Execute callbacks until we have sent and received all of messages,
+    // keeping track of the most requests delivered by a single callback.
+    size_t max_sent = 0;
+    size_t max_received = 0;
+    while (sender_->getQueueSize() > 0 || (received_ncrs_.size() < num_msgs)) {
+        size_t sent = sent_ncrs_.size();
+        size_t received = received_ncrs_.size();
+        EXPECT_NO_THROW(io_service_.run_one());
+        max_sent = std::max(max_sent, sent_ncrs_.size() - sent);
+        max_received = std::max(max_received,
+                                received_ncrs_.size() - received);
+    }
+
+    // The queued requests were sent and received in one packet.
+    EXPECT_EQ(num_msgs - 1, max_sent);
+    EXPECT_EQ(num_msgs - 1, max_received);
+
+    // We should have the same number of sends and receives as we do messages.
+    EXPECT_EQ(NameChangeSender::SUCCESS, send_result_);
+    ASSERT_EQ(num_msgs, sent_ncrs_.size());
+    ASSERT_EQ(num_msgs, received_ncrs_.size());
+
+    // Verify that what we sent matches what we received.
+    for (int i = 0; i < num_msgs; i++) {
+        EXPECT_TRUE (checkSendVsReceived(sent_ncrs_[i], received_ncrs_[i]));
+    }
+
+    EXPECT_NO_THROW(listener_->stopListening());
+    EXPECT_NO_THROW(io_service_.run_one());
+    EXPECT_NO_THROW(sender_->stopSending());
+}
+
 // Tests error handling of a failure to mark the watch socket ready, when
 // sendRequestt() is called.
 TEST(NameChangeUDPSenderBasicTest, watchClosedBeforeSendRequest) {
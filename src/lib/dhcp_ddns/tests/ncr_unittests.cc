@@ -586,6 +586,95 @@ TEST(NameChangeRequestTest, toFromBufferTest) {
     ASSERT_EQ(final_str, msg_str);
 }
 
+/// @brief Tests converting to and from the binary format.
+/// This test verifies that:
+/// 1. Each of the valid requests survives a round trip through the binary
+/// format unchanged.
+/// 2. Several requests marshalled into the same buffer are read back one
+/// after another.
+TEST(NameChangeRequestTest, toFromBinaryTest) {
+    bundy::util::OutputBuffer output_buffer(1024);
+    std::vector<std::string> json_strs;
+    int num_msgs = sizeof(valid_msgs)/sizeof(char*);
+    for (int i = 0; i < num_msgs; i++) {
+        NameChangeRequestPtr ncr;
+        ASSERT_NO_THROW(ncr = NameChangeRequest::fromJSON(valid_msgs[i]));
+        json_strs.push_back(ncr->toJSON());
+
+        // Verify that the request alone survives the round trip.
+        bundy::util::OutputBuffer single_buffer(1024);
+        ASSERT_NO_THROW(ncr->toFormat(FMT_BINARY, single_buffer));
+        EXPECT_EQ(NameChangeRequest::BINARY_FORMAT_VERSION,
+                  *static_cast<const uint8_t*>(single_buffer.getData()));
+        bundy::util::InputBuffer input_buffer(single_buffer.getData(),
+                                              single_buffer.getLength());
+        NameChangeRequestPtr ncr2;
+        ASSERT_NO_THROW(ncr2 = NameChangeRequest::fromFormat(FMT_BINARY,
+                                                             input_buffer));
+        EXPECT_TRUE(*ncr == *ncr2) << "message idx: " << i;
+        EXPECT_EQ(json_strs.back(), ncr2->toJSON());
+        EXPECT_EQ(single_buffer.getLength(), input_buffer.getPosition());
+
+        // The binary rendition is more compact than the JSON one.
+        EXPECT_LT(single_buffer.getLength(), ncr->toJSON().size());
+
+        // Append the request to the buffer holding all of them.
+        ASSERT_NO_THROW(ncr->toFormat(FMT_BINARY, output_buffer));
+    }
+
+    // Verify that the requests are read back in order.
+    bundy::util::InputBuffer input_buffer(output_buffer.getData(),
+                                          output_buffer.getLength());
+    for (int i = 0; i < num_msgs; i++) {
+        NameChangeRequestPtr ncr;
+        ASSERT_NO_THROW(ncr = NameChangeRequest::fromFormat(FMT_BINARY,
+                                                            input_buffer));
+        EXPECT_EQ(json_strs[i], ncr->toJSON());
+    }
+    EXPECT_EQ(output_buffer.getLength(), input_buffer.getPosition());
+}
+
+/// @brief Tests that invalid binary renditions are detected.
+TEST(NameChangeRequestTest, invalidBinary) {
+    NameChangeRequestPtr ncr;
+    ASSERT_NO_THROW(ncr = NameChangeRequest::fromJSON(valid_msgs[0]));
+    bundy::util::OutputBuffer output_buffer(1024);
+    ASSERT_NO_THROW(ncr->toBinary(output_buffer));
+    std::vector<uint8_t> valid(static_cast<const uint8_t*>
+                               (output_buffer.getData()),
+                               static_cast<const uint8_t*>
+                               (output_buffer.getData()) +
+                               output_buffer.getLength());
+
+    // Verify that an unsupported version is rejected.
+    std::vector<uint8_t> data(valid);
+    data[0] = NameChangeRequest::BINARY_FORMAT_VERSION + 1;
+    bundy::util::InputBuffer version_buffer(&data[0], data.size());
+    EXPECT_THROW(NameChangeRequest::fromBinary(version_buffer),
+                 NcrMessageError);
+
+    // Verify that an invalid change type is rejected.
+    data = valid;
+    data[1] = CHG_REMOVE + 1;
+    bundy::util::InputBuffer type_buffer(&data[0], data.size());
+    EXPECT_THROW(NameChangeRequest::fromBinary(type_buffer),
+                 NcrMessageError);
+
+    // Verify that a truncated rendition is rejected.
+    for (size_t len = 0; len < valid.size(); ++len) {
+        bundy::util::InputBuffer short_buffer(&valid[0], len);
+        EXPECT_THROW(NameChangeRequest::fromBinary(short_buffer),
+                     NcrMessageError) << "length: " << len;
+    }
+
+    // Verify that a request without any change direction is rejected.
+    data = valid;
+    data[2] = 0;
+    bundy::util::InputBuffer flags_buffer(&data[0], data.size());
+    EXPECT_THROW(NameChangeRequest::fromBinary(flags_buffer),
+                 NcrMessageError);
+}
+
 /// @brief Tests ip address modification and validation
 TEST(NameChangeRequestTest, ipAddresses) {
     NameChangeRequest ncr;
@@ -612,9 +701,12 @@ TEST(NameChangeRequestTest, ipAddresses) {
 TEST(NameChangeFormatTest, formatEnumConversion){
     ASSERT_EQ(stringToNcrFormat("JSON"), dhcp_ddns::FMT_JSON);
     ASSERT_EQ(stringToNcrFormat("jSoN"), dhcp_ddns::FMT_JSON);
+    ASSERT_EQ(stringToNcrFormat("BINARY"), dhcp_ddns::FMT_BINARY);
+    ASSERT_EQ(stringToNcrFormat("Binary"), dhcp_ddns::FMT_BINARY);
     ASSERT_THROW(stringToNcrFormat("bogus"), bundy::BadValue);
 
     ASSERT_EQ(ncrFormatToString(dhcp_ddns::FMT_JSON), "JSON");
+    ASSERT_EQ(ncrFormatToString(dhcp_ddns::FMT_BINARY), "BINARY");
 }
 
 /// @brief Tests conversion of NameChangeProtocol between enum and strings.
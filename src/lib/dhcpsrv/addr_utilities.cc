@@ -15,8 +15,6 @@
 #include <dhcpsrv/addr_utilities.h>
 #include <exceptions/exceptions.h>
 
-#include <string.h>
-
 using namespace bundy;
 using namespace bundy::asiolink;
 
@@ -35,137 +33,22 @@ const uint32_t bitMask4[] = { 0xffffffff, 0x7fffffff, 0x3fffffff, 0x1fffffff,
                               0x0000000f, 0x00000007, 0x00000003, 0x00000001,
                               0x00000000 };
 
-/// @brief mask used for first/last address calculation in a IPv6 prefix
-const uint8_t bitMask6[]= { 0, 0x80, 0xc0, 0xe0, 0xf0, 0xf8, 0xfc, 0xfe, 0xff };
-
-/// @brief calculates the first IPv6 address in a IPv6 prefix
+/// @brief checks the length of a prefix
 ///
 /// Note: This is a private function. Do not use it directly.
-/// Please use firstAddrInPrefix() instead.
 ///
-/// @param prefix IPv6 prefix
+/// @param prefix prefix the length is for
 /// @param len prefix length
-bundy::asiolink::IOAddress firstAddrInPrefix6(const bundy::asiolink::IOAddress& prefix,
-                                            uint8_t len) {
-    if (len > 128) {
-        bundy_throw(bundy::BadValue,
-                  "Too large netmask. 0..128 is allowed in IPv6");
-    }
-
-    // First we copy the whole address as 16 bytes.
-    // We don't check that it is a valid IPv6 address and thus has
-    // the required length because it is already checked by
-    // the calling function.
-    uint8_t packed[V6ADDRESS_LEN];
-    memcpy(packed, &prefix.toBytes()[0], V6ADDRESS_LEN);
-
-    // If the length is divisible by 8, it is simple. We just zero out the host
-    // part. Otherwise we need to handle the byte that has to be partially
-    // zeroed.
-    if (len % 8 != 0) {
-
-        // Get the appropriate mask. It has relevant bits (those that should
-        // stay) set and irrelevant (those that should be wiped) cleared.
-        uint8_t mask = bitMask6[len % 8];
-
-        // Let's leave only whatever the mask says should not be cleared.
-        packed[len / 8] = packed[len / 8] & mask;
-
-        // Since we have just dealt with this byte, let's move the prefix length
-        // to the beginning of the next byte (len is expressed in bits).
-        len = (len / 8 + 1) * 8;
-    }
-
-    // Clear out the remaining bits.
-    for (int i = len / 8; i < sizeof(packed); ++i) {
-        packed[i] = 0x0;
-    }
-
-    // Finally, let's wrap this into nice and easy IOAddress object.
-    return (bundy::asiolink::IOAddress::fromBytes(AF_INET6, packed));
-}
-
-/// @brief calculates the first IPv4 address in a IPv4 prefix
-///
-/// Note: This is a private function. Do not use it directly.
-/// Please use firstAddrInPrefix() instead.
-///
-/// @param prefix IPv4 prefix
-/// @param len netmask length (0-32)
-bundy::asiolink::IOAddress firstAddrInPrefix4(const bundy::asiolink::IOAddress& prefix,
-                                            uint8_t len) {
-    if (len > 32) {
-        bundy_throw(bundy::BadValue, "Too large netmask. 0..32 is allowed in IPv4");
-    }
-
-    // We don't check that it is a valid IPv4 address and thus has
-    // a required length of 4 bytes because it has been already
-    // checked by the calling function.
-    uint32_t addr = prefix;
-    return (IOAddress(addr & (~bitMask4[len])));
-}
-
-/// @brief calculates the last IPv4 address in a IPv4 prefix
-///
-/// Note: This is a private function. Do not use it directly.
-/// Please use firstAddrInPrefix() instead.
-///
-/// @param prefix IPv4 prefix that we calculate first address for
-/// @param len netmask length (0-32)
-bundy::asiolink::IOAddress lastAddrInPrefix4(const bundy::asiolink::IOAddress& prefix,
-                                           uint8_t len) {
-    if (len > 32) {
-        bundy_throw(bundy::BadValue, "Too large netmask. 0..32 is allowed in IPv4");
-    }
-
-    uint32_t addr = prefix;
-    return (IOAddress(addr | bitMask4[len]));
-}
-
-/// @brief calculates the last IPv6 address in a IPv6 prefix
-///
-/// Note: This is a private function. Do not use it directly.
-/// Please use lastAddrInPrefix() instead.
-///
-/// @param prefix IPv6 prefix that we calculate first address for
-/// @param len netmask length (0-128)
-bundy::asiolink::IOAddress lastAddrInPrefix6(const bundy::asiolink::IOAddress& prefix,
-                                           uint8_t len) {
-    if (len > 128) {
+void checkPrefixLen(const bundy::asiolink::IOAddress& prefix, uint8_t len) {
+    if (prefix.isV4()) {
+        if (len > 32) {
+            bundy_throw(bundy::BadValue,
+                      "Too large netmask. 0..32 is allowed in IPv4");
+        }
+    } else if (len > 128) {
         bundy_throw(bundy::BadValue,
                   "Too large netmask. 0..128 is allowed in IPv6");
     }
-
-    // First we copy the whole address as 16 bytes.
-    uint8_t packed[V6ADDRESS_LEN];
-    memcpy(packed, &prefix.toBytes()[0], 16);
-
-    // if the length is divisible by 8, it is simple. We just fill the host part
-    // with ones. Otherwise we need to handle the byte that has to be partially
-    // zeroed.
-    if (len % 8 != 0) {
-        // Get the appropriate mask. It has relevant bits (those that should
-        // stay) set and irrelevant (those that should be set to 1) cleared.
-        uint8_t mask = bitMask6[len % 8];
-
-        // Let's set those irrelevant bits with 1. It would be perhaps
-        // easier to not use negation here and invert bitMask6 content. However,
-        // with this approach, we can use the same mask in first and last
-        // address calculations.
-        packed[len / 8] = packed[len / 8] | ~mask;
-
-        // Since we have just dealt with this byte, let's move the prefix length
-        // to the beginning of the next byte (len is expressed in bits).
-        len = (len / 8 + 1) * 8;
-    }
-
-    // Finally set remaining bits to 1.
-    for (int i = len / 8; i < sizeof(packed); ++i) {
-        packed[i] = 0xff;
-    }
-
-    // Finally, let's wrap this into nice and easy IOAddress object.
-    return (bundy::asiolink::IOAddress::fromBytes(AF_INET6, packed));
 }
 
 }; // end of anonymous namespace
@@ -175,24 +58,14 @@ namespace dhcp {
 
 bundy::asiolink::IOAddress firstAddrInPrefix(const bundy::asiolink::IOAddress& prefix,
                                            uint8_t len) {
-    if (prefix.isV4()) {
-        return (firstAddrInPrefix4(prefix, len));
-
-    } else {
-        return (firstAddrInPrefix6(prefix, len));
-
-    }
+    checkPrefixLen(prefix, len);
+    return (prefix.firstInPrefix(len));
 }
 
 bundy::asiolink::IOAddress lastAddrInPrefix(const bundy::asiolink::IOAddress& prefix,
                                            uint8_t len) {
-    if (prefix.isV4()) {
-        return (lastAddrInPrefix4(prefix, len));
-
-    } else {
-        return (lastAddrInPrefix6(prefix, len));
-
-    }
+    checkPrefixLen(prefix, len);
+    return (prefix.lastInPrefix(len));
 }
 
 bundy::asiolink::IOAddress getNetmask4(uint8_t len) {
@@ -13,13 +13,17 @@
 // PERFORMANCE OF THIS SOFTWARE.
 
 #include <dhcpsrv/alloc_engine.h>
+#include <dhcpsrv/cfgmgr.h>
 #include <dhcpsrv/dhcpsrv_log.h>
 #include <dhcpsrv/lease_mgr_factory.h>
 
 #include <hooks/server_hooks.h>
 #include <hooks/hooks_manager.h>
+#include <util/time_utilities.h>
 
 #include <cstring>
+#include <ctime>
+#include <limits>
 #include <vector>
 #include <string.h>
 
@@ -34,11 +38,25 @@ struct AllocEngineHooks {
     int hook_index_lease4_renew_;  ///< index for "lease4_renew" hook point
     int hook_index_lease6_select_; ///< index for "lease6_receive" hook point
 
-    /// Constructor that registers hook points for AllocationEngine
+    int arg_index_subnet4_;        ///< index for "subnet4" argument
+    int arg_index_clientid_;       ///< index for "clientid" argument
+    int arg_index_hwaddr_;         ///< index for "hwaddr" argument
+    int arg_index_fake_allocation_; ///< index for "fake_allocation" argument
+    int arg_index_lease4_;         ///< index for "lease4" argument
+
+    /// Constructor that registers hook points and callout arguments for
+    /// AllocationEngine
     AllocEngineHooks() {
         hook_index_lease4_select_ = HooksManager::registerHook("lease4_select");
         hook_index_lease4_renew_  = HooksManager::registerHook("lease4_renew");
         hook_index_lease6_select_ = HooksManager::registerHook("lease6_select");
+
+        arg_index_subnet4_  = HooksManager::registerArgument("subnet4");
+        arg_index_clientid_ = HooksManager::registerArgument("clientid");
+        arg_index_hwaddr_   = HooksManager::registerArgument("hwaddr");
+        arg_index_fake_allocation_ =
+            HooksManager::registerArgument("fake_allocation");
+        arg_index_lease4_   = HooksManager::registerArgument("lease4");
     }
 };
 
@@ -53,36 +71,40 @@ AllocEngineHooks Hooks;
 namespace bundy {
 namespace dhcp {
 
+namespace {
+
+/// @brief Checks if an address is reserved for another client.
+///
+/// @param hosts the host reservations.
+/// @param subnet_id identifier of the subnet of the address.
+/// @param address the address.
+/// @param host host of the client, NULL if it has none.
+/// @return true if the address is reserved for a host other than the
+/// client's.
+bool
+reservedForOther(const CfgHosts& hosts, const SubnetID subnet_id,
+                 const IOAddress& address, const ConstHostPtr& host) {
+    const ConstHostPtr owner = hosts.get(subnet_id, address);
+    return (owner && (owner != host));
+}
+
+/// @brief Returns the client identifier by which the offers to the client
+/// are held, empty if the client sent none.
+const std::vector<uint8_t>&
+offerClientId(const ClientIdPtr& clientid) {
+    static const std::vector<uint8_t> none;
+    return (clientid ? clientid->getClientId() : none);
+}
+
+}
+
 AllocEngine::IterativeAllocator::IterativeAllocator(Lease::Type lease_type)
     :Allocator(lease_type) {
 }
 
 bundy::asiolink::IOAddress
 AllocEngine::IterativeAllocator::increaseAddress(const bundy::asiolink::IOAddress& addr) {
-    // Get a buffer holding an address.
-    const std::vector<uint8_t>& vec = addr.toBytes();
-    // Get the address length.
-    const int len = vec.size();
-
-    // Since the same array will be used to hold the IPv4 and IPv6
-    // address we have to make sure that the size of the array
-    // we allocate will work for both types of address.
-    BOOST_STATIC_ASSERT(V4ADDRESS_LEN <= V6ADDRESS_LEN);
-    uint8_t packed[V6ADDRESS_LEN];
-
-    // Copy the address. It can be either V4 or V6.
-    std::memcpy(packed, &vec[0], len);
-
-    // Start increasing the least significant byte
-    for (int i = len - 1; i >= 0; --i) {
-        ++packed[i];
-        // if we haven't overflowed (0xff -> 0x0), than we are done
-        if (packed[i] != 0) {
-            break;
-        }
-    }
-
-    return (IOAddress::fromBytes(addr.getFamily(), packed));
+    return (addr.increase());
 }
 
 bundy::asiolink::IOAddress
@@ -93,52 +115,12 @@ AllocEngine::IterativeAllocator::increasePrefix(const bundy::asiolink::IOAddress
                   "increase prefix " << prefix << ")");
     }
 
-    // Get a buffer holding an address.
-    const std::vector<uint8_t>& vec = prefix.toBytes();
-
     if (prefix_len < 1 || prefix_len > 128) {
         bundy_throw(BadValue, "Cannot increase prefix: invalid prefix length: "
                   << prefix_len);
     }
 
-    // Brief explanation what happens here:
-    // http://www.youtube.com/watch?v=NFQCYpIHLNQ
-
-    uint8_t n_bytes = (prefix_len - 1)/8;
-    uint8_t n_bits = 8 - (prefix_len - n_bytes*8);
-    uint8_t mask = 1 << n_bits;
-
-    // Longer explanation: n_bytes specifies number of full bytes that are
-    // in-prefix. They can also be used as an offset for the first byte that
-    // is not in prefix. n_bits specifies number of bits on the last byte that
-    // is (often partially) in prefix. For example for a /125 prefix, the values
-    // are 15 and 3, respectively. Mask is a bitmask that has the least
-    // significant bit from the prefix set.
-
-    uint8_t packed[V6ADDRESS_LEN];
-
-    // Copy the address. It must be V6, but we already checked that.
-    std::memcpy(packed, &vec[0], V6ADDRESS_LEN);
-
-    // Can we safely increase only the last byte in prefix without overflow?
-    if (packed[n_bytes] + uint16_t(mask) < 256u) {
-        packed[n_bytes] += mask;
-        return (IOAddress::fromBytes(AF_INET6, packed));
-    }
-
-    // Overflow (done on uint8_t, but the sum is greater than 255)
-    packed[n_bytes] += mask;
-
-    // Deal with the overflow. Start increasing the least significant byte
-    for (int i = n_bytes - 1; i >= 0; --i) {
-        ++packed[i];
-        // If we haven't overflowed (0xff->0x0) the next byte, then we are done
-        if (packed[i] != 0) {
-            break;
-        }
-    }
-
-    return (IOAddress::fromBytes(AF_INET6, packed));
+    return (prefix.increasePrefix(prefix_len));
 }
 
 
@@ -217,6 +199,527 @@ AllocEngine::IterativeAllocator::pickAddress(const SubnetPtr& subnet,
     return (next);
 }
 
+const uint32_t AllocEngine::FreeMapAllocator::MAX_POOL_SIZE = 1 << 20;
+
+AllocEngine::FreeMapAllocator::FreeMapAllocator(Lease::Type lease_type)
+    :IterativeAllocator(lease_type) {
+    if (lease_type != Lease::TYPE_V4) {
+        bundy_throw(BadValue, "Free map allocator supports IPv4 only");
+    }
+}
+
+bundy::asiolink::IOAddress
+AllocEngine::FreeMapAllocator::pickAddress(const SubnetPtr& subnet,
+                                           const DuidPtr& duid,
+                                           const IOAddress& hint) {
+    const PoolCollection& pools = subnet->getPools(pool_type_);
+    if (pools.empty()) {
+        bundy_throw(AllocFailed, "No pools defined in selected subnet");
+    }
+
+    // Start with the pool that the last allocated address belongs to, so
+    // that a pool is used until it is full.
+    const IOAddress last = subnet->getLastAllocated(pool_type_);
+    size_t start = 0;
+    for (size_t i = 0; i < pools.size(); ++i) {
+        if (pools[i]->inRange(last)) {
+            start = i;
+            break;
+        }
+    }
+
+    const uint32_t now = bundy::util::CoarseClock::getTime();
+    for (size_t i = 0; i < pools.size(); ++i) {
+        PoolMap* map = getPoolMap(*pools[(start + i) % pools.size()]);
+        if ((map == NULL) || (now < map->full_until_)) {
+            continue;
+        }
+
+        // Search the pool, starting after the last address returned.
+        const size_t size = map->busy_until_.size();
+        uint32_t earliest = std::numeric_limits<uint32_t>::max();
+        for (size_t j = 0; j < size; ++j) {
+            const size_t offset = (map->next_ + j) % size;
+            const uint32_t busy_until = map->busy_until_[offset];
+            if (busy_until <= now) {
+                map->next_ = (offset + 1) % size;
+                const IOAddress next(map->first_ + offset);
+                subnet->setLastAllocated(pool_type_, next);
+                return (next);
+            }
+            earliest = std::min(earliest, busy_until);
+        }
+
+        // All addresses are in use: don't search again until one of the
+        // leases expires (or a lease is deleted).
+        map->full_until_ = earliest;
+    }
+
+    // No free address is known (or the pools are too large to be mapped).
+    // Hand out addresses in turn: the engine checks each one in the lease
+    // database, and the map is updated with the result.
+    return (IterativeAllocator::pickAddress(subnet, duid, hint));
+}
+
+void
+AllocEngine::FreeMapAllocator::leaseStored(const Lease& lease) {
+    const uint32_t addr = lease.addr_;
+    PoolMap* map = findPoolMap(addr);
+    if (map != NULL) {
+        const uint32_t busy_until = busyUntil(lease);
+        map->busy_until_[addr - map->first_] = busy_until;
+        map->full_until_ = std::min(map->full_until_, busy_until);
+    }
+}
+
+void
+AllocEngine::FreeMapAllocator::leaseDeleted(const IOAddress& address) {
+    const uint32_t addr = address;
+    PoolMap* map = findPoolMap(addr);
+    if (map != NULL) {
+        map->busy_until_[addr - map->first_] = 0;
+        map->full_until_ = 0;
+    }
+}
+
+AllocEngine::FreeMapAllocator::PoolMap*
+AllocEngine::FreeMapAllocator::getPoolMap(const Pool& pool) {
+    const uint32_t first = pool.getFirstAddress();
+    const uint32_t last = pool.getLastAddress();
+
+    std::map<uint32_t, PoolMap>::iterator it = maps_.find(first);
+    if (it != maps_.end()) {
+        if (it->second.last_ == last) {
+            return (&it->second);
+        }
+        // The pool has been reconfigured, so the map is out of date.
+        maps_.erase(it);
+    }
+
+    if (last - first >= MAX_POOL_SIZE) {
+        return (NULL);
+    }
+
+    // Build the map from the lease database.
+    PoolMap map(first, last);
+    size_t leased = 0;
+    for (size_t i = 0; i < map.busy_until_.size(); ++i) {
+        Lease4Ptr lease =
+            LeaseMgrFactory::instance().getLease4(IOAddress(first + i));
+        if (lease) {
+            map.busy_until_[i] = busyUntil(*lease);
+            ++leased;
+        }
+    }
+    LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE, DHCPSRV_FREE_MAP_BUILT)
+        .arg(pool.toText()).arg(leased).arg(map.busy_until_.size());
+
+    it = maps_.insert(std::make_pair(first, map)).first;
+    return (&it->second);
+}
+
+AllocEngine::FreeMapAllocator::PoolMap*
+AllocEngine::FreeMapAllocator::findPoolMap(uint32_t addr) {
+    // Find the map with the highest first address not above the address.
+    std::map<uint32_t, PoolMap>::iterator it = maps_.upper_bound(addr);
+    if (it == maps_.begin()) {
+        return (NULL);
+    }
+    --it;
+    return ((addr <= it->second.last_) ? &it->second : NULL);
+}
+
+uint32_t
+AllocEngine::FreeMapAllocator::busyUntil(const Lease& lease) {
+    const uint64_t expire = static_cast<uint64_t>(lease.cltt_) +
+        lease.valid_lft_;
+    if (expire > std::numeric_limits<uint32_t>::max()) {
+        return (std::numeric_limits<uint32_t>::max());
+    }
+    return (expire == 0 ? 1 : static_cast<uint32_t>(expire));
+}
+
+const uint8_t AllocEngine::PrefixTreeAllocator::MAX_DEPTH = 63;
+
+namespace {
+
+/// @brief Returns the length of the prefix common to two IPv6 addresses
+uint8_t
+commonPrefixLength(const IOAddress& first, const IOAddress& last) {
+    const std::vector<uint8_t> a = first.toBytes();
+    const std::vector<uint8_t> b = last.toBytes();
+    for (uint8_t bit = 0; bit < 128; ++bit) {
+        const uint8_t mask = 0x80 >> (bit % 8);
+        if ((a[bit / 8] & mask) != (b[bit / 8] & mask)) {
+            return (bit);
+        }
+    }
+    return (128);
+}
+
+/// @brief Returns the time until which a lease is in use
+uint32_t
+expireTime(const Lease& lease) {
+    const int64_t expire = lease.getExpirationTime();
+    if (expire > std::numeric_limits<uint32_t>::max()) {
+        return (std::numeric_limits<uint32_t>::max());
+    }
+    return (expire < 0 ? 0 : static_cast<uint32_t>(expire));
+}
+
+}
+
+AllocEngine::PrefixTreeAllocator::PrefixTree::PrefixTree(
+    const IOAddress& first, const IOAddress& last, uint8_t pool_len,
+    uint8_t delegated_len)
+    : pool_len_(pool_len), delegated_len_(delegated_len), first_(first),
+      last_(last), next_(0), hint_("::"),
+      expire_(std::numeric_limits<uint32_t>::max()),
+      size_(static_cast<uint64_t>(1) << (delegated_len - pool_len)),
+      nodes_(1) {
+}
+
+bool
+AllocEngine::PrefixTreeAllocator::PrefixTree::inRange(const IOAddress& prefix)
+    const {
+    return (first_.smallerEqual(prefix) && prefix.smallerEqual(last_));
+}
+
+uint64_t
+AllocEngine::PrefixTreeAllocator::PrefixTree::getOffset(const IOAddress& prefix)
+    const {
+    const std::vector<uint8_t> bytes = prefix.toBytes();
+    uint64_t offset = 0;
+    for (uint8_t bit = pool_len_; bit < delegated_len_; ++bit) {
+        offset = (offset << 1) | ((bytes[bit / 8] >> (7 - bit % 8)) & 1);
+    }
+    return (offset);
+}
+
+IOAddress
+AllocEngine::PrefixTreeAllocator::PrefixTree::getPrefix(uint64_t offset) const {
+    std::vector<uint8_t> bytes = first_.toBytes();
+    for (int bit = delegated_len_ - 1; bit >= pool_len_; --bit) {
+        const uint8_t mask = 0x80 >> (bit % 8);
+        if (offset & 1) {
+            bytes[bit / 8] |= mask;
+        } else {
+            bytes[bit / 8] &= ~mask;
+        }
+        offset >>= 1;
+    }
+    return (IOAddress::fromBytes(AF_INET6, &bytes[0]));
+}
+
+bool
+AllocEngine::PrefixTreeAllocator::PrefixTree::isUsed(uint64_t offset) const {
+    const uint8_t depth = delegated_len_ - pool_len_;
+    uint32_t node = 0;
+    for (uint8_t d = 0; d < depth; ++d) {
+        node = nodes_[node].child_[(offset >> (depth - 1 - d)) & 1];
+        if (node == 0) {
+            return (false);
+        }
+    }
+    // Only the leaves of the prefixes in use are stored.
+    return (nodes_[node].used_ != 0);
+}
+
+void
+AllocEngine::PrefixTreeAllocator::PrefixTree::setUsed(uint64_t offset) {
+    if ((offset >= size_) || isUsed(offset)) {
+        return;
+    }
+    const uint8_t depth = delegated_len_ - pool_len_;
+    uint32_t node = 0;
+    ++nodes_[node].used_;
+    for (uint8_t d = 0; d < depth; ++d) {
+        const unsigned int bit = (offset >> (depth - 1 - d)) & 1;
+        uint32_t child = nodes_[node].child_[bit];
+        if (child == 0) {
+            // newNode() may move the nodes, so index them again.
+            child = newNode();
+            nodes_[node].child_[bit] = child;
+        }
+        ++nodes_[child].used_;
+        node = child;
+    }
+}
+
+void
+AllocEngine::PrefixTreeAllocator::PrefixTree::setFree(uint64_t offset) {
+    if ((offset >= size_) || !isUsed(offset)) {
+        return;
+    }
+    const uint8_t depth = delegated_len_ - pool_len_;
+    uint32_t node = 0;
+    --nodes_[node].used_;
+    for (uint8_t d = 0; d < depth; ++d) {
+        const unsigned int bit = (offset >> (depth - 1 - d)) & 1;
+        uint32_t child = nodes_[node].child_[bit];
+        if (--nodes_[child].used_ == 0) {
+            // The subtree is no longer used: release its nodes, which are
+            // those on the path to the prefix.
+            nodes_[node].child_[bit] = 0;
+            for (++d; child != 0; ++d) {
+                const uint32_t next = (d < depth) ?
+                    nodes_[child].child_[(offset >> (depth - 1 - d)) & 1] : 0;
+                nodes_[child] = Node();
+                free_nodes_.push_back(child);
+                child = next;
+            }
+            return;
+        }
+        node = child;
+    }
+}
+
+bool
+AllocEngine::PrefixTreeAllocator::PrefixTree::findFree(uint64_t from,
+                                                       uint64_t& offset) const {
+    if (isFull()) {
+        return (false);
+    }
+    // Search after the starting offset, then from the start of the pool.
+    return (findFree(0, 0, 0, from, offset) || findFree(0, 0, 0, 0, offset));
+}
+
+bool
+AllocEngine::PrefixTreeAllocator::PrefixTree::findFree(uint32_t node,
+                                                       uint8_t depth,
+                                                       uint64_t base,
+                                                       uint64_t from,
+                                                       uint64_t& offset) const {
+    const uint8_t height = delegated_len_ - pool_len_ - depth;
+    const uint64_t size = static_cast<uint64_t>(1) << height;
+    if (from >= base + size) {
+        return (false);
+    }
+    // The root is the only node with the index zero; elsewhere it means
+    // that no prefix below is in use.
+    if ((node == 0) && (depth > 0)) {
+        offset = std::max(base, from);
+        return (true);
+    }
+    if (nodes_[node].used_ == size) {
+        return (false);
+    }
+    if (height == 0) {
+        // Only the root of a pool of a single prefix gets here.
+        offset = base;
+        return (true);
+    }
+    return (findFree(nodes_[node].child_[0], depth + 1, base, from, offset) ||
+            findFree(nodes_[node].child_[1], depth + 1, base + size / 2, from,
+                     offset));
+}
+
+uint32_t
+AllocEngine::PrefixTreeAllocator::PrefixTree::newNode() {
+    if (!free_nodes_.empty()) {
+        const uint32_t node = free_nodes_.back();
+        free_nodes_.pop_back();
+        return (node);
+    }
+    nodes_.push_back(Node());
+    return (nodes_.size() - 1);
+}
+
+AllocEngine::PrefixTreeAllocator::PrefixTreeAllocator(Lease::Type lease_type)
+    :IterativeAllocator(lease_type) {
+    if (lease_type != Lease::TYPE_PD) {
+        bundy_throw(BadValue, "Prefix tree allocator supports prefixes only");
+    }
+}
+
+bundy::asiolink::IOAddress
+AllocEngine::PrefixTreeAllocator::pickAddress(const SubnetPtr& subnet,
+                                              const DuidPtr& duid,
+                                              const IOAddress& hint) {
+    const PoolCollection& pools = subnet->getPools(pool_type_);
+    if (pools.empty()) {
+        bundy_throw(AllocFailed, "No pools defined in selected subnet");
+    }
+
+    // Start with the pool of the hint if there is one, otherwise with the
+    // pool that the last allocated prefix belongs to, so that a pool is used
+    // until it is full.
+    const IOAddress last = subnet->getLastAllocated(pool_type_);
+    size_t start = pools.size();
+    for (size_t i = 0; (i < pools.size()) && (start == pools.size()); ++i) {
+        if (pools[i]->inRange(hint)) {
+            start = i;
+        }
+    }
+    const bool hinted = (start != pools.size());
+    for (size_t i = 0; (i < pools.size()) && (start == pools.size()); ++i) {
+        if (pools[i]->inRange(last)) {
+            start = i;
+        }
+    }
+    if (start == pools.size()) {
+        start = 0;
+    }
+
+    const uint32_t now = bundy::util::CoarseClock::getTime();
+    for (size_t i = 0; i < pools.size(); ++i) {
+        const PoolPtr& pool = pools[(start + i) % pools.size()];
+        PrefixTree* tree = getPrefixTree(subnet, pool);
+        if ((tree != NULL) && tree->isFull() && (now >= tree->expire_)) {
+            // Some leases have expired since the tree was built, so the
+            // pool may have free prefixes.
+            trees_.clear();
+            tree = getPrefixTree(subnet, pool);
+        }
+        if (tree == NULL) {
+            continue;
+        }
+
+        // A new hint moves the search to the hint, so that the client gets
+        // the prefix nearest to the one it asked for.
+        uint64_t from = tree->next_;
+        if (hinted && (i == 0) && !(tree->hint_ == hint)) {
+            tree->hint_ = hint;
+            from = tree->getOffset(hint);
+        }
+
+        uint64_t offset;
+        if (tree->findFree(from, offset)) {
+            tree->next_ = offset + 1;
+            const IOAddress next = tree->getPrefix(offset);
+            subnet->setLastAllocated(pool_type_, next);
+            return (next);
+        }
+    }
+
+    // No free prefix is known (or the pools are too large to be tracked).
+    // Hand out prefixes in turn: the engine checks each one in the lease
+    // database, and the trees are updated with the result.
+    return (IterativeAllocator::pickAddress(subnet, duid, hint));
+}
+
+void
+AllocEngine::PrefixTreeAllocator::leaseStored(const Lease& lease) {
+    PrefixTree* tree = findPrefixTree(lease.addr_);
+    if ((tree != NULL) && !lease.expired()) {
+        tree->setUsed(tree->getOffset(lease.addr_));
+        tree->expire_ = std::min(tree->expire_, expireTime(lease));
+    }
+}
+
+void
+AllocEngine::PrefixTreeAllocator::leaseDeleted(const IOAddress& prefix) {
+    PrefixTree* tree = findPrefixTree(prefix);
+    if (tree != NULL) {
+        tree->setFree(tree->getOffset(prefix));
+    }
+}
+
+AllocEngine::PrefixTreeAllocator::PrefixTree*
+AllocEngine::PrefixTreeAllocator::getPrefixTree(const SubnetPtr& subnet,
+                                                const PoolPtr& pool) {
+    std::map<IOAddress, PrefixTreePtr>::iterator it =
+        trees_.find(pool->getFirstAddress());
+    if (it != trees_.end()) {
+        Pool6Ptr pool6 = boost::dynamic_pointer_cast<Pool6>(pool);
+        if (pool6 && (it->second->last_ == pool->getLastAddress()) &&
+            (it->second->delegated_len_ == pool6->getLength())) {
+            return (it->second.get());
+        }
+        // The pool has been reconfigured, so the tree is out of date.
+        trees_.erase(it);
+    } else if (!createTree(pool)) {
+        // The pool is too large to be tracked.
+        return (NULL);
+    }
+
+    buildTrees(subnet);
+    it = trees_.find(pool->getFirstAddress());
+    return (it == trees_.end() ? NULL : it->second.get());
+}
+
+AllocEngine::PrefixTreeAllocator::PrefixTree*
+AllocEngine::PrefixTreeAllocator::findPrefixTree(const IOAddress& prefix) {
+    // Find the tree with the highest first prefix not above the prefix.
+    std::map<IOAddress, PrefixTreePtr>::iterator it = trees_.upper_bound(prefix);
+    if (it == trees_.begin()) {
+        return (NULL);
+    }
+    --it;
+    return (it->second->inRange(prefix) ? it->second.get() : NULL);
+}
+
+void
+AllocEngine::PrefixTreeAllocator::buildTrees(const SubnetPtr& subnet) {
+    // Create the trees of the pools which have none, in this subnet and in
+    // all configured subnets, so that a single query serves them all.
+    std::vector<SubnetPtr> subnets(1, subnet);
+    const Subnet6Collection* configured = CfgMgr::instance().getSubnets6();
+    if (configured != NULL) {
+        subnets.insert(subnets.end(), configured->begin(), configured->end());
+    }
+    std::map<IOAddress, PrefixTreePtr> built;
+    for (size_t i = 0; i < subnets.size(); ++i) {
+        const PoolCollection& pools = subnets[i]->getPools(pool_type_);
+        for (PoolCollection::const_iterator pool = pools.begin();
+             pool != pools.end(); ++pool) {
+            const IOAddress& first = (*pool)->getFirstAddress();
+            if ((trees_.count(first) == 0) && (built.count(first) == 0)) {
+                PrefixTreePtr tree = createTree(*pool);
+                if (tree) {
+                    built[first] = tree;
+                }
+            }
+        }
+    }
+    if (built.empty()) {
+        return;
+    }
+
+    // Mark the prefixes of the leases which haven't expired as used.
+    const Lease6Collection leases =
+        LeaseMgrFactory::instance().getLeases6(pool_type_);
+    size_t used = 0;
+    for (Lease6Collection::const_iterator lease = leases.begin();
+         lease != leases.end(); ++lease) {
+        std::map<IOAddress, PrefixTreePtr>::iterator it =
+            built.upper_bound((*lease)->addr_);
+        if ((it == built.begin()) || (*lease)->expired()) {
+            continue;
+        }
+        --it;
+        PrefixTree& tree = *it->second;
+        if (tree.inRange((*lease)->addr_)) {
+            tree.setUsed(tree.getOffset((*lease)->addr_));
+            tree.expire_ = std::min(tree.expire_, expireTime(**lease));
+            ++used;
+        }
+    }
+    LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE, DHCPSRV_PREFIX_TREE_BUILT)
+        .arg(built.size()).arg(used).arg(leases.size());
+
+    trees_.insert(built.begin(), built.end());
+}
+
+AllocEngine::PrefixTreeAllocator::PrefixTreePtr
+AllocEngine::PrefixTreeAllocator::createTree(const PoolPtr& pool) {
+    Pool6Ptr pool6 = boost::dynamic_pointer_cast<Pool6>(pool);
+    if (!pool6) {
+        // Something is gravely wrong here
+        bundy_throw(Unexpected, "Wrong type of pool: " << pool->toText()
+                    << " is not Pool6");
+    }
+    const uint8_t pool_len = commonPrefixLength(pool->getFirstAddress(),
+                                                pool->getLastAddress());
+    const uint8_t delegated_len = pool6->getLength();
+    if ((delegated_len < pool_len) || (delegated_len - pool_len > MAX_DEPTH)) {
+        return (PrefixTreePtr());
+    }
+    return (PrefixTreePtr(new PrefixTree(pool->getFirstAddress(),
+                                         pool->getLastAddress(), pool_len,
+                                         delegated_len)));
+}
+
 AllocEngine::HashedAllocator::HashedAllocator(Lease::Type lease_type)
     :Allocator(lease_type) {
     bundy_throw(NotImplemented, "Hashed allocator is not implemented");
@@ -262,6 +765,16 @@ AllocEngine::AllocEngine(AllocType engine_type, unsigned int attempts,
     case ALLOC_RANDOM:
         allocators_[basic_type] = AllocatorPtr(new RandomAllocator(basic_type));
         break;
+    case ALLOC_FREE_MAP:
+        // Throws if this is an IPv6 engine.
+        allocators_[basic_type] = AllocatorPtr(new FreeMapAllocator(basic_type));
+        break;
+    case ALLOC_PREFIX_TREE:
+        if (!ipv6) {
+            bundy_throw(BadValue, "Prefix tree allocator supports IPv6 only");
+        }
+        allocators_[basic_type] = AllocatorPtr(new IterativeAllocator(basic_type));
+        break;
     default:
         bundy_throw(BadValue, "Invalid/unsupported allocation algorithm");
     }
@@ -282,6 +795,10 @@ AllocEngine::AllocEngine(AllocType engine_type, unsigned int attempts,
             allocators_[Lease::TYPE_TA] = AllocatorPtr(new RandomAllocator(Lease::TYPE_TA));
             allocators_[Lease::TYPE_PD] = AllocatorPtr(new RandomAllocator(Lease::TYPE_PD));
             break;
+        case ALLOC_PREFIX_TREE:
+            allocators_[Lease::TYPE_TA] = AllocatorPtr(new IterativeAllocator(Lease::TYPE_TA));
+            allocators_[Lease::TYPE_PD] = AllocatorPtr(new PrefixTreeAllocator(Lease::TYPE_PD));
+            break;
         default:
             bundy_throw(BadValue, "Invalid/unsupported allocation algorithm");
         }
@@ -332,18 +849,58 @@ AllocEngine::allocateLeases6(const Subnet6Ptr& subnet, const DuidPtr& duid,
                                    hostname, fake_allocation));
         }
 
+        // A client with addresses reserved in the subnet gets the first of
+        // them which is not leased to another client. Only addresses can be
+        // reserved for now.
+        const ConstCfgHostsPtr hosts = CfgMgr::instance().getHosts();
+        ConstHostPtr host;
+        if (type == Lease::TYPE_NA) {
+            host = hosts->get6(subnet->getID(), duid);
+        }
+        if (host) {
+            const std::vector<IOAddress>& reserved =
+                host->getIPv6Reservations();
+            for (std::vector<IOAddress>::const_iterator addr =
+                     reserved.begin(); addr != reserved.end(); ++addr) {
+                Lease6Ptr lease = LeaseMgrFactory::instance().getLease6(type,
+                                                                        *addr);
+                if (!lease) {
+                    lease = createLease6(subnet, duid, iaid, *addr, 128, type,
+                                         fwd_dns_update, rev_dns_update,
+                                         hostname, callout_handle,
+                                         fake_allocation);
+                    if (lease) {
+                        old_leases.push_back(Lease6Ptr());
+                        Lease6Collection collection;
+                        collection.push_back(lease);
+                        return (collection);
+                    }
+                } else if (lease->expired()) {
+                    old_leases.push_back(Lease6Ptr(new Lease6(*lease)));
+                    lease = reuseExpiredLease(lease, subnet, duid, iaid, 128,
+                                              fwd_dns_update, rev_dns_update,
+                                              hostname, callout_handle,
+                                              fake_allocation);
+                    Lease6Collection collection;
+                    collection.push_back(lease);
+                    return (collection);
+                }
+            }
+            // All reserved addresses are leased (e.g. they were leased to
+            // other clients before they were reserved), so allocate one from
+            // the pools.
+        }
+
         // check if the hint is in pool and is available
         // This is equivalent of subnet->inPool(hint), but returns the pool
         Pool6Ptr pool = boost::dynamic_pointer_cast<
             Pool6>(subnet->getPool(type, hint, false));
 
-        if (pool) {
+        // Addresses reserved for other clients are not given to this one.
+        if (pool && !reservedForOther(*hosts, subnet->getID(), hint, host)) {
             /// @todo: We support only one hint for now
             Lease6Ptr lease = LeaseMgrFactory::instance().getLease6(type, hint);
             if (!lease) {
-                /// @todo: check if the hint is reserved once we have host
-                /// support implemented
-
                 // The hint is valid and not currently used, let's create a
                 // lease for it
                 lease = createLease6(subnet, duid, iaid, hint,
@@ -385,6 +942,8 @@ AllocEngine::allocateLeases6(const Subnet6Ptr& subnet, const DuidPtr& duid,
                     return (collection);
                 }
 
+                // Let the allocator know that the address is in use.
+                allocator->leaseStored(*lease);
             }
         }
 
@@ -408,8 +967,10 @@ AllocEngine::allocateLeases6(const Subnet6Ptr& subnet, const DuidPtr& duid,
         do {
             IOAddress candidate = allocator->pickAddress(subnet, duid, hint);
 
-            /// @todo: check if the address is reserved once we have host support
-            /// implemented
+            if (reservedForOther(*hosts, subnet->getID(), candidate, host)) {
+                --i;
+                continue;
+            }
 
             // The first step is to find out prefix length. It is 128 for
             // non-PD leases.
@@ -459,6 +1020,10 @@ AllocEngine::allocateLeases6(const Subnet6Ptr& subnet, const DuidPtr& duid,
                     collection.push_back(existing);
                     return (collection);
                 }
+
+                // Let the allocator know that the address is in use, so that
+                // it is not picked again.
+                allocator->leaseStored(*existing);
             }
 
             // Continue trying allocation until we run out of attempts
@@ -509,6 +1074,22 @@ AllocEngine::allocateLease4(const SubnetPtr& subnet, const ClientIdPtr& clientid
             bundy_throw(InvalidOperation, "HWAddr must be defined");
         }
 
+        // A client retransmitting its DISCOVER gets the address offered to
+        // it before, unless it has been leased since.
+        const std::vector<uint8_t>& offer_clientid = offerClientId(clientid);
+        IOAddress offered("0.0.0.0");
+        if (fake_allocation &&
+            offers_.get(hwaddr->hwaddr_, offer_clientid, subnet->getID(),
+                        offered)) {
+            Lease4Ptr lease = createLease4(subnet, clientid, hwaddr, offered,
+                                           fwd_dns_update, rev_dns_update,
+                                           hostname, callout_handle,
+                                           fake_allocation);
+            if (lease) {
+                return (lease);
+            }
+        }
+
         // Check if there's existing lease for that subnet/clientid/hwaddr combination.
         Lease4Ptr existing = LeaseMgrFactory::instance().getLease4(*hwaddr, subnet->getID());
         if (existing) {
@@ -546,13 +1127,41 @@ AllocEngine::allocateLease4(const SubnetPtr& subnet, const ClientIdPtr& clientid
             }
         }
 
-        // check if the hint is in pool and is available
-        if (subnet->inPool(Lease::TYPE_V4, hint)) {
-            existing = LeaseMgrFactory::instance().getLease4(hint);
+        // A client with an address reserved in the subnet gets it, unless
+        // it is leased to another client.
+        const ConstCfgHostsPtr hosts = CfgMgr::instance().getHosts();
+        const ConstHostPtr host = hosts->get4(subnet->getID(), hwaddr,
+                                              clientid);
+        if (host && host->hasIPv4Reservation()) {
+            const IOAddress& reserved = host->getIPv4Reservation();
+            existing = LeaseMgrFactory::instance().getLease4(reserved);
             if (!existing) {
-                /// @todo: Check if the hint is reserved once we have host support
-                /// implemented
+                Lease4Ptr lease = createLease4(subnet, clientid, hwaddr,
+                                               reserved, fwd_dns_update,
+                                               rev_dns_update, hostname,
+                                               callout_handle,
+                                               fake_allocation);
+                if (lease) {
+                    return (lease);
+                }
+            } else if (existing->expired()) {
+                old_lease.reset(new Lease4(*existing));
+                return (reuseExpiredLease(existing, subnet, clientid, hwaddr,
+                                          fwd_dns_update, rev_dns_update,
+                                          hostname, callout_handle,
+                                          fake_allocation));
+            }
+            // The reserved address is leased to another client (e.g. it was
+            // leased before it was reserved), so allocate one from the pools.
+        }
 
+        // check if the hint is in pool and is available. Addresses reserved
+        // or offered to other clients are not given to this one.
+        if (subnet->inPool(Lease::TYPE_V4, hint) &&
+            !reservedForOther(*hosts, subnet->getID(), hint, host) &&
+            !offers_.offeredToOther(hint, hwaddr->hwaddr_, offer_clientid)) {
+            existing = LeaseMgrFactory::instance().getLease4(hint);
+            if (!existing) {
                 // The hint is valid and not currently used, let's create a lease for it
                 Lease4Ptr lease = createLease4(subnet, clientid, hwaddr, hint,
                                                fwd_dns_update, rev_dns_update,
@@ -575,6 +1184,8 @@ AllocEngine::allocateLease4(const SubnetPtr& subnet, const ClientIdPtr& clientid
                                               fake_allocation));
                 }
 
+                // Let the allocator know that the address is in use.
+                allocator->leaseStored(*existing);
             }
         }
 
@@ -598,8 +1209,12 @@ AllocEngine::allocateLease4(const SubnetPtr& subnet, const ClientIdPtr& clientid
         do {
             IOAddress candidate = allocator->pickAddress(subnet, clientid, hint);
 
-            /// @todo: check if the address is reserved once we have host support
-            /// implemented
+            if (reservedForOther(*hosts, subnet->getID(), candidate, host) ||
+                offers_.offeredToOther(candidate, hwaddr->hwaddr_,
+                                       offer_clientid)) {
+                --i;
+                continue;
+            }
 
             Lease4Ptr existing = LeaseMgrFactory::instance().getLease4(candidate);
             if (!existing) {
@@ -625,6 +1240,10 @@ AllocEngine::allocateLease4(const SubnetPtr& subnet, const ClientIdPtr& clientid
                                               hostname, callout_handle,
                                               fake_allocation));
                 }
+
+                // Let the allocator know that the address is in use, so that
+                // it is not picked again.
+                allocator->leaseStored(*existing);
             }
 
             // Continue trying allocation until we run out of attempts
@@ -666,7 +1285,7 @@ Lease4Ptr AllocEngine::renewLease4(const SubnetPtr& subnet,
     lease->subnet_id_ = subnet->getID();
     lease->hwaddr_ = hwaddr->hwaddr_;
     lease->client_id_ = clientid;
-    lease->cltt_ = time(NULL);
+    lease->cltt_ = bundy::util::CoarseClock::getTime();
     lease->t1_ = subnet->getT1();
     lease->t2_ = subnet->getT2();
     lease->valid_lft_ = subnet->getValid();
@@ -688,12 +1307,12 @@ Lease4Ptr AllocEngine::renewLease4(const SubnetPtr& subnet,
         Subnet4Ptr subnet4 = boost::dynamic_pointer_cast<Subnet4>(subnet);
 
         // Pass the parameters
-        callout_handle->setArgument("subnet4", subnet4);
-        callout_handle->setArgument("clientid", clientid);
-        callout_handle->setArgument("hwaddr", hwaddr);
+        callout_handle->setArgument(Hooks.arg_index_subnet4_, subnet4);
+        callout_handle->setArgument(Hooks.arg_index_clientid_, clientid);
+        callout_handle->setArgument(Hooks.arg_index_hwaddr_, hwaddr);
 
         // Pass the lease to be updated
-        callout_handle->setArgument("lease4", lease);
+        callout_handle->setArgument(Hooks.arg_index_lease4_, lease);
 
         // Call all installed callouts
         HooksManager::callCallouts(Hooks.hook_index_lease4_renew_, *callout_handle);
@@ -710,6 +1329,7 @@ Lease4Ptr AllocEngine::renewLease4(const SubnetPtr& subnet,
     if (!fake_allocation && !skip) {
         // for REQUEST we do update the lease
         LeaseMgrFactory::instance().updateLease4(lease);
+        getAllocator(Lease::TYPE_V4)->leaseStored(*lease);
     }
     if (skip) {
         // Rollback changes (really useful only for memfile)
@@ -746,7 +1366,7 @@ Lease6Ptr AllocEngine::reuseExpiredLease(Lease6Ptr& expired,
     expired->valid_lft_ = subnet->getValid();
     expired->t1_ = subnet->getT1();
     expired->t2_ = subnet->getT2();
-    expired->cltt_ = time(NULL);
+    expired->cltt_ = bundy::util::CoarseClock::getTime();
     expired->subnet_id_ = subnet->getID();
     expired->fixed_ = false;
     expired->hostname_ = hostname;
@@ -769,7 +1389,8 @@ Lease6Ptr AllocEngine::reuseExpiredLease(Lease6Ptr& expired,
         callout_handle->setArgument("subnet6", subnet);
 
         // Is this solicit (fake = true) or request (fake = false)
-        callout_handle->setArgument("fake_allocation", fake_allocation);
+        callout_handle->setArgument(Hooks.arg_index_fake_allocation_,
+                                    fake_allocation);
 
         // The lease that will be assigned to a client
         callout_handle->setArgument("lease6", expired);
@@ -793,6 +1414,7 @@ Lease6Ptr AllocEngine::reuseExpiredLease(Lease6Ptr& expired,
     if (!fake_allocation) {
         // for REQUEST we do update the lease
         LeaseMgrFactory::instance().updateLease6(expired);
+        getAllocator(expired->type_)->leaseStored(*expired);
     }
 
     // We do nothing for SOLICIT. We'll just update database when
@@ -823,7 +1445,7 @@ Lease4Ptr AllocEngine::reuseExpiredLease(Lease4Ptr& expired,
     expired->valid_lft_ = subnet->getValid();
     expired->t1_ = subnet->getT1();
     expired->t2_ = subnet->getT2();
-    expired->cltt_ = time(NULL);
+    expired->cltt_ = bundy::util::CoarseClock::getTime();
     expired->subnet_id_ = subnet->getID();
     expired->fixed_ = false;
     expired->hostname_ = hostname;
@@ -847,13 +1469,14 @@ Lease4Ptr AllocEngine::reuseExpiredLease(Lease4Ptr& expired,
         // boost smart pointers here, we need to do the cast using the boost
         // version of dynamic_pointer_cast.
         Subnet4Ptr subnet4 = boost::dynamic_pointer_cast<Subnet4>(subnet);
-        callout_handle->setArgument("subnet4", subnet4);
+        callout_handle->setArgument(Hooks.arg_index_subnet4_, subnet4);
 
         // Is this solicit (fake = true) or request (fake = false)
-        callout_handle->setArgument("fake_allocation", fake_allocation);
+        callout_handle->setArgument(Hooks.arg_index_fake_allocation_,
+                                    fake_allocation);
 
         // The lease that will be assigned to a client
-        callout_handle->setArgument("lease4", expired);
+        callout_handle->setArgument(Hooks.arg_index_lease4_, expired);
 
         // Call the callouts
         HooksManager::callCallouts(hook_index_lease6_select_, *callout_handle);
@@ -868,12 +1491,18 @@ Lease4Ptr AllocEngine::reuseExpiredLease(Lease4Ptr& expired,
 
         // Let's use whatever callout returned. Hopefully it is the same lease
         // we handled to it.
-        callout_handle->getArgument("lease4", expired);
+        callout_handle->getArgument(Hooks.arg_index_lease4_, expired);
     }
 
     if (!fake_allocation) {
         // for REQUEST we do update the lease
         LeaseMgrFactory::instance().updateLease4(expired);
+        getAllocator(Lease::TYPE_V4)->leaseStored(*expired);
+        offers_.remove(hwaddr->hwaddr_, offerClientId(clientid),
+                       subnet->getID());
+    } else {
+        offers_.put(hwaddr->hwaddr_, offerClientId(clientid),
+                    subnet->getID(), expired->addr_);
     }
 
     // We do nothing for SOLICIT. We'll just update database when
@@ -922,7 +1551,8 @@ Lease6Ptr AllocEngine::createLease6(const Subnet6Ptr& subnet,
         callout_handle->setArgument("subnet6", subnet);
 
         // Is this solicit (fake = true) or request (fake = false)
-        callout_handle->setArgument("fake_allocation", fake_allocation);
+        callout_handle->setArgument(Hooks.arg_index_fake_allocation_,
+                                    fake_allocation);
         callout_handle->setArgument("lease6", lease);
 
         // This is the first callout, so no need to clear any arguments
@@ -946,7 +1576,7 @@ Lease6Ptr AllocEngine::createLease6(const Subnet6Ptr& subnet,
         bool status = LeaseMgrFactory::instance().addLease(lease);
 
         if (status) {
-
+            getAllocator(type)->leaseStored(*lease);
             return (lease);
         } else {
             // One of many failures with LeaseMgr (e.g. lost connection to the
@@ -982,7 +1612,7 @@ Lease4Ptr AllocEngine::createLease4(const SubnetPtr& subnet,
     if (!hwaddr) {
         bundy_throw(BadValue, "Can't create a lease with NULL HW address");
     }
-    time_t now = time(NULL);
+    time_t now = bundy::util::CoarseClock::getTime();
 
     // @todo: remove this kludge after ticket #2590 is implemented
     std::vector<uint8_t> local_copy;
@@ -1014,13 +1644,14 @@ Lease4Ptr AllocEngine::createLease4(const SubnetPtr& subnet,
         // be confused with dynamic_pointer_casts. They should get a concrete
         // pointer (Subnet4Ptr) pointing to a Subnet4 object.
         Subnet4Ptr subnet4 = boost::dynamic_pointer_cast<Subnet4>(subnet);
-        callout_handle->setArgument("subnet4", subnet4);
+        callout_handle->setArgument(Hooks.arg_index_subnet4_, subnet4);
 
         // Is this solicit (fake = true) or request (fake = false)
-        callout_handle->setArgument("fake_allocation", fake_allocation);
+        callout_handle->setArgument(Hooks.arg_index_fake_allocation_,
+                                    fake_allocation);
 
         // Pass the intended lease as well
-        callout_handle->setArgument("lease4", lease);
+        callout_handle->setArgument(Hooks.arg_index_lease4_, lease);
 
         // This is the first callout, so no need to clear any arguments
         HooksManager::callCallouts(hook_index_lease4_select_, *callout_handle);
@@ -1035,13 +1666,15 @@ Lease4Ptr AllocEngine::createLease4(const SubnetPtr& subnet,
 
         // Let's use whatever callout returned. Hopefully it is the same lease
         // we handled to it.
-        callout_handle->getArgument("lease4", lease);
+        callout_handle->getArgument(Hooks.arg_index_lease4_, lease);
     }
 
     if (!fake_allocation) {
         // That is a real (REQUEST) allocation
         bool status = LeaseMgrFactory::instance().addLease(lease);
         if (status) {
+            getAllocator(Lease::TYPE_V4)->leaseStored(*lease);
+            offers_.remove(hwaddr->hwaddr_, local_copy, subnet->getID());
             return (lease);
         } else {
             // One of many failures with LeaseMgr (e.g. lost connection to the
@@ -1057,6 +1690,7 @@ Lease4Ptr AllocEngine::createLease4(const SubnetPtr& subnet,
         // but rather check that we could have inserted it.
         Lease4Ptr existing = LeaseMgrFactory::instance().getLease4(addr);
         if (!existing) {
+            offers_.put(hwaddr->hwaddr_, local_copy, subnet->getID(), addr);
             return (lease);
         } else {
             return (Lease4Ptr());
@@ -1098,6 +1732,14 @@ AllocEngine::AllocatorPtr AllocEngine::getAllocator(Lease::Type type) {
     return (alloc->second);
 }
 
+void
+AllocEngine::leaseDeleted(Lease::Type type, const IOAddress& addr) {
+    std::map<Lease::Type, AllocatorPtr>::const_iterator alloc = allocators_.find(type);
+    if (alloc != allocators_.end()) {
+        alloc->second->leaseDeleted(addr);
+    }
+}
+
 AllocEngine::~AllocEngine() {
     // no need to delete allocator. smart_ptr will do the trick for us
 }
@@ -20,12 +20,14 @@
 #include <dhcp/hwaddr.h>
 #include <dhcpsrv/subnet.h>
 #include <dhcpsrv/lease_mgr.h>
+#include <dhcpsrv/offer_cache.h>
 #include <hooks/callout_handle.h>
 
 #include <boost/shared_ptr.hpp>
 #include <boost/noncopyable.hpp>
 
 #include <map>
+#include <vector>
 
 namespace bundy {
 namespace dhcp {
@@ -98,6 +100,25 @@ protected:
         /// @brief virtual destructor
         virtual ~Allocator() {
         }
+
+        /// @brief Notifies the allocator that a lease has been stored
+        ///
+        /// Called by the AllocEngine when it has added or updated a lease in
+        /// the lease database, or has found that a candidate address is
+        /// in use.  Allocators that keep track of free addresses use this
+        /// to keep their state up to date; the default does nothing.
+        ///
+        /// @param lease Lease that is in the lease database.
+        virtual void leaseStored(const Lease&) {
+        }
+
+        /// @brief Notifies the allocator that a lease has been deleted
+        ///
+        /// The default does nothing.
+        ///
+        /// @param addr Address of the lease removed from the lease database.
+        virtual void leaseDeleted(const bundy::asiolink::IOAddress&) {
+        }
     protected:
 
         /// @brief defines pool type allocation
@@ -159,6 +180,330 @@ protected:
                        const uint8_t prefix_len);
     };
 
+    /// @brief IPv4 address allocator that keeps a map of the addresses in use
+    ///
+    /// The IterativeAllocator returns addresses without regard to whether
+    /// they are in use, so in a nearly-full pool the AllocEngine makes many
+    /// lease database lookups before finding a free address.  This allocator
+    /// holds, for each pool, the time until which each address is in use
+    /// (zero if there is no lease for it), so that it only returns addresses
+    /// that are believed to be free or whose lease has expired.  The engine
+    /// still checks the candidate in the lease database, and reports what it
+    /// finds via leaseStored(); the map is therefore self-correcting if the
+    /// database is modified elsewhere.
+    ///
+    /// The map of a pool is built from the lease database the first time an
+    /// address is requested from the pool.  Pools larger than MAX_POOL_SIZE,
+    /// and pools in which all addresses are in use, are handled as by the
+    /// IterativeAllocator.
+    class FreeMapAllocator : public IterativeAllocator {
+    public:
+
+        /// @brief Maximum number of addresses in a pool for which a map
+        ///        is built
+        static const uint32_t MAX_POOL_SIZE;
+
+        /// @brief Constructor
+        ///
+        /// @param type specifies allocation type (must be Lease::TYPE_V4)
+        ///
+        /// @throw BadValue if type is not Lease::TYPE_V4
+        FreeMapAllocator(Lease::Type type);
+
+        /// @brief returns the next free address from pools in a subnet
+        ///
+        /// @param subnet next address will be returned from pool of that subnet
+        /// @param duid Client's DUID (ignored)
+        /// @param hint client's hint (ignored)
+        /// @return the next address
+        virtual bundy::asiolink::IOAddress
+            pickAddress(const SubnetPtr& subnet,
+                        const DuidPtr& duid,
+                        const bundy::asiolink::IOAddress& hint);
+
+        /// @brief Marks the address of the lease as in use until the lease
+        ///        expires
+        ///
+        /// @param lease Lease that is in the lease database.
+        virtual void leaseStored(const Lease& lease);
+
+        /// @brief Marks the address as free
+        ///
+        /// @param addr Address of the lease removed from the lease database.
+        virtual void leaseDeleted(const bundy::asiolink::IOAddress& addr);
+
+    protected:
+
+        /// @brief Map of a single pool
+        struct PoolMap {
+            /// @brief Constructor
+            ///
+            /// @param first First address in the pool
+            /// @param last Last address in the pool
+            PoolMap(uint32_t first, uint32_t last)
+                : first_(first), last_(last), busy_until_(last - first + 1, 0),
+                  next_(0), full_until_(0) {
+            }
+
+            uint32_t first_;    ///< First address in the pool
+            uint32_t last_;     ///< Last address in the pool
+
+            /// Time until which each address is in use, zero for unused.
+            std::vector<uint32_t> busy_until_;
+
+            /// Offset at which the search for the next address starts
+            size_t next_;
+
+            /// If all addresses were found to be in use, the earliest time
+            /// at which one becomes free.  The pool is not searched again
+            /// until that time unless a lease changes.
+            uint32_t full_until_;
+        };
+
+        /// @brief Returns the map for a pool, building it if necessary
+        ///
+        /// @param pool Pool for which the map is returned.
+        ///
+        /// @return Pointer to the map, or NULL if the pool is too large.
+        PoolMap* getPoolMap(const Pool& pool);
+
+        /// @brief Returns the map of the pool containing an address
+        ///
+        /// @param addr Address to look for.
+        ///
+        /// @return Pointer to the map, or NULL if no map holds the address.
+        PoolMap* findPoolMap(uint32_t addr);
+
+        /// @brief Returns the time until which a lease is in use
+        ///
+        /// @param lease Lease to check.
+        ///
+        /// @return expiration time of the lease, limited to the range of
+        ///         uint32_t and never zero.
+        static uint32_t busyUntil(const Lease& lease);
+
+        /// Maps of the pools, indexed by the first address of the pool
+        std::map<uint32_t, PoolMap> maps_;
+    };
+
+    /// @brief Prefix allocator that keeps a tree of the free prefixes of
+    ///        each pool
+    ///
+    /// In a large prefix delegation pool, the IterativeAllocator returns a
+    /// long run of delegated prefixes that are in use after the server is
+    /// restarted, each checked in the lease database by the AllocEngine.
+    /// This allocator holds, for each pool, a binary tree of the prefixes
+    /// that can be delegated from it in which each node counts the prefixes
+    /// in use below it, like a buddy allocator. A free prefix is then found,
+    /// and a prefix is marked as used or free, in a number of steps equal to
+    /// the difference between the delegated length and the length of the
+    /// pool. Only the nodes above the used prefixes are stored, so the size
+    /// of a tree depends on the number of leases and not on the size of the
+    /// pool.
+    ///
+    /// The trees are built when a pool is first used, from all prefix
+    /// leases fetched in a single query. The pools of all configured subnets
+    /// are built at the same time. Expired leases are free in the trees; the
+    /// prefixes of the leases that expire later remain used until the lease
+    /// is deleted or the pool is full, in which case its tree is rebuilt
+    /// once the earliest lease has expired. The engine still checks each
+    /// candidate in the lease database and reports what it finds via
+    /// leaseStored(), so a stale tree only costs an extra attempt.
+    ///
+    /// When the client gives a hint in one of the pools, the free prefix
+    /// nearest after the hint in that pool is returned first.
+    class PrefixTreeAllocator : public IterativeAllocator {
+    public:
+
+        /// @brief Maximum difference between the delegated length and the
+        ///        length of a pool for which a tree is built
+        static const uint8_t MAX_DEPTH;
+
+        /// @brief Constructor
+        ///
+        /// @param type specifies allocation type (must be Lease::TYPE_PD)
+        ///
+        /// @throw BadValue if type is not Lease::TYPE_PD
+        PrefixTreeAllocator(Lease::Type type);
+
+        /// @brief returns the next free prefix from pools in a subnet
+        ///
+        /// @param subnet next prefix will be returned from pool of that subnet
+        /// @param duid Client's DUID (ignored)
+        /// @param hint client's hint
+        /// @return the next prefix
+        virtual bundy::asiolink::IOAddress
+            pickAddress(const SubnetPtr& subnet,
+                        const DuidPtr& duid,
+                        const bundy::asiolink::IOAddress& hint);
+
+        /// @brief Marks the prefix of the lease as in use
+        ///
+        /// @param lease Lease that is in the lease database.
+        virtual void leaseStored(const Lease& lease);
+
+        /// @brief Marks the prefix as free
+        ///
+        /// @param addr Prefix of the lease removed from the lease database.
+        virtual void leaseDeleted(const bundy::asiolink::IOAddress& addr);
+
+    protected:
+
+        /// @brief Tree of the delegated prefixes of a single pool
+        ///
+        /// The prefixes are identified by their offset in the pool, i.e. by
+        /// the bits of the prefix between the length of the pool and the
+        /// delegated length.
+        class PrefixTree {
+        public:
+            /// @brief Constructor
+            ///
+            /// @param first First prefix in the pool
+            /// @param last Last address in the pool
+            /// @param pool_len Length of the pool prefix
+            /// @param delegated_len Length of the delegated prefixes
+            PrefixTree(const bundy::asiolink::IOAddress& first,
+                       const bundy::asiolink::IOAddress& last,
+                       uint8_t pool_len, uint8_t delegated_len);
+
+            /// @brief Checks if a prefix belongs to the pool
+            bool inRange(const bundy::asiolink::IOAddress& prefix) const;
+
+            /// @brief Returns the offset of a prefix in the pool
+            ///
+            /// The prefix must belong to the pool. The bits after the
+            /// delegated length are ignored.
+            uint64_t getOffset(const bundy::asiolink::IOAddress& prefix) const;
+
+            /// @brief Returns the prefix at an offset in the pool
+            bundy::asiolink::IOAddress getPrefix(uint64_t offset) const;
+
+            /// @brief Checks if the prefix at an offset is in use
+            bool isUsed(uint64_t offset) const;
+
+            /// @brief Marks the prefix at an offset as in use
+            void setUsed(uint64_t offset);
+
+            /// @brief Marks the prefix at an offset as free
+            void setFree(uint64_t offset);
+
+            /// @brief Checks if all prefixes of the pool are in use
+            bool isFull() const {
+                return (count(0) == size_);
+            }
+
+            /// @brief Returns the first free prefix at or after an offset
+            ///
+            /// The search wraps around at the end of the pool.
+            ///
+            /// @param from Offset at which the search starts.
+            /// @param [out] offset Offset of the free prefix.
+            ///
+            /// @return true if a free prefix was found, false if the pool
+            ///         is full.
+            bool findFree(uint64_t from, uint64_t& offset) const;
+
+            /// @brief Returns the number of prefixes in use
+            uint64_t getUsed() const {
+                return (count(0));
+            }
+
+            uint8_t pool_len_;      ///< Length of the pool prefix
+            uint8_t delegated_len_; ///< Length of the delegated prefixes
+            bundy::asiolink::IOAddress first_; ///< First prefix in the pool
+            bundy::asiolink::IOAddress last_;  ///< Last address in the pool
+
+            /// Offset at which the search for the next prefix starts
+            uint64_t next_;
+
+            /// Last hint that was given for this pool
+            bundy::asiolink::IOAddress hint_;
+
+            /// Earliest expiration time of the leases marked as in use, at
+            /// which the tree is rebuilt if the pool is full.
+            uint32_t expire_;
+
+        private:
+            /// @brief A node of the tree
+            struct Node {
+                Node() : used_(0) {
+                    child_[0] = child_[1] = 0;
+                }
+
+                /// Number of the prefixes in use below the node
+                uint64_t used_;
+
+                /// Indexes of the children, zero if the subtree is unused
+                uint32_t child_[2];
+            };
+
+            /// @brief Returns the number of prefixes in use below a node
+            uint64_t count(uint32_t node) const {
+                return (nodes_[node].used_);
+            }
+
+            /// @brief Searches the subtree of a node for a free prefix
+            ///
+            /// @param node Index of the node, zero for an unused subtree.
+            /// @param depth Depth of the node.
+            /// @param base Offset of the first prefix below the node.
+            /// @param from Offset at which the search starts.
+            /// @param [out] offset Offset of the free prefix.
+            bool findFree(uint32_t node, uint8_t depth, uint64_t base,
+                          uint64_t from, uint64_t& offset) const;
+
+            /// @brief Allocates a node, reusing a released one if possible
+            uint32_t newNode();
+
+            /// Number of prefixes in the pool
+            uint64_t size_;
+
+            /// Nodes of the tree, the root being the first one.  The root is
+            /// never a child, so a zero index denotes an unused subtree.
+            std::vector<Node> nodes_;
+
+            /// Indexes of the released nodes
+            std::vector<uint32_t> free_nodes_;
+        };
+
+        /// @brief Pointer to a tree
+        typedef boost::shared_ptr<PrefixTree> PrefixTreePtr;
+
+        /// @brief Returns the tree for a pool, building the trees if
+        ///        necessary
+        ///
+        /// @param subnet Subnet the pool belongs to.
+        /// @param pool Pool for which the tree is returned.
+        ///
+        /// @return Pointer to the tree, or NULL if the pool is too large.
+        PrefixTree* getPrefixTree(const SubnetPtr& subnet, const PoolPtr& pool);
+
+        /// @brief Returns the tree of the pool containing a prefix
+        ///
+        /// @param prefix Prefix to look for.
+        ///
+        /// @return Pointer to the tree, or NULL if no tree holds the prefix.
+        PrefixTree* findPrefixTree(const bundy::asiolink::IOAddress& prefix);
+
+        /// @brief Builds the trees of the pools from the lease database
+        ///
+        /// Builds the trees of the given subnet and of all configured
+        /// subnets, using a single query for the leases.
+        ///
+        /// @param subnet Subnet for which the trees are built.
+        void buildTrees(const SubnetPtr& subnet);
+
+        /// @brief Creates a tree for a pool
+        ///
+        /// @param pool Pool for which the tree is created.
+        ///
+        /// @return Pointer to the tree, or NULL if the pool is too large.
+        static PrefixTreePtr createTree(const PoolPtr& pool);
+
+        /// Trees of the pools, indexed by the first prefix of the pool
+        std::map<bundy::asiolink::IOAddress, PrefixTreePtr> trees_;
+    };
+
     /// @brief Address/prefix allocator that gets an address based on a hash
     ///
     /// @todo: This is a skeleton class for now and is missing implementation.
@@ -211,7 +556,11 @@ protected:
     typedef enum {
         ALLOC_ITERATIVE, // iterative - one address after another
         ALLOC_HASHED,    // hashed - client's DUID/client-id is hashed
-        ALLOC_RANDOM     // random - an address is randomly selected
+        ALLOC_RANDOM,    // random - an address is randomly selected
+        ALLOC_FREE_MAP,  // free map - a free address is selected (IPv4 only)
+        ALLOC_PREFIX_TREE // prefix tree - a free prefix is selected from a
+                          // tree of the pool (IPv6 only, for prefixes;
+                          // addresses are allocated iteratively)
     } AllocType;
 
 
@@ -232,10 +581,15 @@ protected:
     ///
     /// This method finds the appropriate lease for the client using the
     /// following algorithm:
+    /// - If this is a fake allocation and an address offered to the client
+    /// is held (see @ref setOfferLifetime) and still free, return it.
     /// - If lease exists for the combination of the HW address, client id and
     /// subnet, try to renew a lease and return it.
     /// - If lease exists for the combination of the client id and subnet, try
     /// to renew the lease and return it.
+    /// - If the client has an address reserved in the subnet (see
+    /// @ref CfgMgr::getHosts) and no other client has a lease for it,
+    /// allocate the new lease with this address.
     /// - If client supplied an address hint and this address is available,
     /// allocate the new lease with this address.
     /// - If client supplied an address hint and the lease for this address
@@ -243,6 +597,9 @@ protected:
     /// - Pick new address from the pool and try to allocate it for the client,
     /// if expired lease exists for the picked address, try to reuse this lease.
     ///
+    /// The hint and the addresses picked from the pool are skipped if they
+    /// are reserved for other clients or offered to them.
+    ///
     /// When a server should do DNS updates, it is required that allocation
     /// returns the information how the lease was obtained by the allocation
     /// engine. In particular, the DHCP server should be able to check whether
@@ -322,6 +679,11 @@ protected:
     /// specified subnet, creates a lease for that address and then inserts
     /// it into LeaseMgr (if this allocation is not fake).
     ///
+    /// If the client has addresses reserved in the subnet (see
+    /// @ref CfgMgr::getHosts), the first of them which no other client has
+    /// a lease for is allocated instead. The hint and the addresses picked
+    /// by the allocator are skipped if they are reserved for other clients.
+    ///
     /// @param subnet subnet the allocation should come from
     /// @param duid Client's DUID
     /// @param iaid iaid field from the IA_NA container that client sent
@@ -360,6 +722,36 @@ protected:
     /// @return pointer to allocator handing a given resource types
     AllocatorPtr getAllocator(Lease::Type type);
 
+    /// @brief Notifies the allocator that a lease has been deleted
+    ///
+    /// The server must call this when it removes a lease from the lease
+    /// database, e.g. on a release, so that allocators that track free
+    /// addresses can make the address available again.
+    ///
+    /// @param type type of the lease
+    /// @param addr address of the deleted lease
+    void leaseDeleted(Lease::Type type, const bundy::asiolink::IOAddress& addr);
+
+    /// @brief Sets the time during which a DHCPv4 offer is held
+    ///
+    /// While an address offered to a client is held, the DHCPDISCOVERs
+    /// retransmitted by the client get the same address without a search of
+    /// the pools, and the address isn't offered to other clients (see
+    /// @ref OfferCache). The offer is dropped when a lease is allocated to
+    /// the client.
+    ///
+    /// @param lifetime time in seconds, zero (the default) not to hold the
+    ///        offers
+    void setOfferLifetime(const uint32_t lifetime) {
+        offers_.setLifetime(lifetime);
+    }
+
+    /// @brief Returns the time during which a DHCPv4 offer is held
+    /// @return time in seconds, zero if the offers are not held
+    uint32_t getOfferLifetime() const {
+        return (offers_.getLifetime());
+    }
+
     /// @brief Destructor. Used during DHCPv6 service shutdown.
     virtual ~AllocEngine();
 private:
@@ -527,6 +919,9 @@ private:
     /// @brief number of attempts before we give up lease allocation (0=unlimited)
     unsigned int attempts_;
 
+    /// @brief addresses recently offered to the DHCPv4 clients
+    OfferCache offers_;
+
     // hook name indexes (used in hooks callouts)
     int hook_index_lease4_select_; ///< index for lease4_select hook
     int hook_index_lease6_select_; ///< index for lease6_select hook
@@ -0,0 +1,608 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <dhcpsrv/binary_lease_file.h>
+#include <dhcpsrv/dhcpsrv_log.h>
+
+#include <boost/crc.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+using namespace bundy::asiolink;
+using namespace bundy::util;
+
+namespace {
+
+/// Flags of the records.
+const uint8_t FLAG_FQDN_FWD = 0x01;
+const uint8_t FLAG_FQDN_REV = 0x02;
+
+/// @brief Computes the CRC-32 of the data.
+uint32_t
+computeCRC(const void* data, const size_t length) {
+    boost::crc_32_type crc;
+    crc.process_bytes(data, length);
+    return (crc.checksum());
+}
+
+/// @brief Writes all data of the buffers to a file.
+///
+/// @param fd File descriptor.
+/// @param iov Buffers, which are modified when they are written in part.
+/// @param iovcnt Number of buffers.
+/// @param filename Name of the file, for the error message.
+void
+writeAll(const int fd, struct iovec* iov, int iovcnt,
+         const std::string& filename) {
+    while (iovcnt > 0) {
+        const ssize_t written = ::writev(fd, iov, iovcnt);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            bundy_throw(bundy::dhcp::BinaryLeaseFileError, "failed to write"
+                        " to the lease file '" << filename << "': "
+                        << strerror(errno));
+        }
+        // Skip what has been written, which may end in the middle of
+        // a buffer.
+        size_t left = written;
+        while (iovcnt > 0 && left >= iov->iov_len) {
+            left -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + left;
+            iov->iov_len -= left;
+        }
+    }
+}
+
+/// @brief Writes a 64-bit integer to the buffer, in network byte order.
+void
+writeUint64(OutputBuffer& buffer, const uint64_t value) {
+    buffer.writeUint32(value >> 32);
+    buffer.writeUint32(value & 0xffffffff);
+}
+
+/// @brief Reads a 64-bit integer from the buffer.
+uint64_t
+readUint64(InputBuffer& buffer) {
+    uint64_t value = buffer.readUint32();
+    return ((value << 32) | buffer.readUint32());
+}
+
+/// @brief Reads a string of the given length from the buffer.
+std::string
+readString(InputBuffer& buffer, const size_t length) {
+    std::vector<uint8_t> data;
+    buffer.readVector(data, length);
+    return (std::string(data.begin(), data.end()));
+}
+
+/// @brief Checks that the whole record has been read.
+void
+checkEnd(const InputBuffer& buffer) {
+    if (buffer.getPosition() != buffer.getLength()) {
+        bundy_throw(bundy::BadValue, "lease record has "
+                    << buffer.getLength() - buffer.getPosition()
+                    << " bytes of trailing data");
+    }
+}
+
+/// @brief Appends the leases read from a lease file to another one.
+///
+/// @tparam LeasePtrType One of the @c Lease4Ptr or @c Lease6Ptr.
+/// @tparam SourceType Type of the lease file to read.
+/// @tparam TargetType Type of the lease file to append to.
+template<typename LeasePtrType, typename SourceType, typename TargetType>
+size_t
+copyLeases(SourceType& source, TargetType& target) {
+    size_t count = 0;
+    LeasePtrType lease;
+    for (;;) {
+        if (!source.next(lease)) {
+            bundy_throw(bundy::dhcp::BinaryLeaseFileError, "failed to read"
+                        " a lease from '" << source.getFilename() << "': "
+                        << source.getReadMsg());
+        }
+        if (!lease) {
+            return (count);
+        }
+        try {
+            target.append(*lease);
+        } catch (const std::exception& ex) {
+            bundy_throw(bundy::dhcp::BinaryLeaseFileError, "failed to write"
+                        " a lease to '" << target.getFilename() << "': "
+                        << ex.what());
+        }
+        ++count;
+    }
+}
+
+}
+
+namespace bundy {
+namespace dhcp {
+
+const uint16_t BinaryLeaseFile::FORMAT_VERSION;
+const size_t BinaryLeaseFile::HEADER_LEN;
+const size_t BinaryLeaseFile::RECORD_HEADER_LEN;
+const size_t BinaryLeaseFile::MAX_RECORD_LEN;
+
+BinaryLeaseFile::BinaryLeaseFile(const std::string& filename,
+                                 const char* magic)
+    : filename_(filename), magic_(magic, 4), fd_(-1), auto_flush_(true),
+      read_done_(true), map_(NULL), map_len_(0), read_pos_(0) {
+}
+
+BinaryLeaseFile::~BinaryLeaseFile() {
+    try {
+        close();
+    } catch (const std::exception&) {
+        // The records which couldn't be written are lost.
+    }
+}
+
+void
+BinaryLeaseFile::open() {
+    close();
+    fd_ = ::open(filename_.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd_ < 0) {
+        bundy_throw(BinaryLeaseFileError, "unable to open the lease file '"
+                    << filename_ << "': " << strerror(errno));
+    }
+
+    try {
+        struct stat st;
+        if (fstat(fd_, &st) != 0) {
+            bundy_throw(BinaryLeaseFileError, "unable to get the size of the"
+                        " lease file '" << filename_ << "': "
+                        << strerror(errno));
+        }
+        if (st.st_size == 0) {
+            // A new file: it gets the header and there is nothing to read.
+            ::close(fd_);
+            fd_ = -1;
+            recreate();
+            return;
+        }
+        // The records are mapped when they are read; only the header is
+        // checked now.
+        uint8_t header_data[HEADER_LEN];
+        if (st.st_size < static_cast<off_t>(HEADER_LEN) ||
+            pread(fd_, header_data, HEADER_LEN, 0) !=
+            static_cast<ssize_t>(HEADER_LEN)) {
+            bundy_throw(BinaryLeaseFileError, "unable to read the header of"
+                        " the lease file '" << filename_ << "'");
+        }
+        InputBuffer header(header_data, HEADER_LEN);
+        const std::string magic = readString(header, magic_.size());
+        const uint16_t version = header.readUint16();
+        if (magic != magic_) {
+            bundy_throw(BinaryLeaseFileError, "the lease file '" << filename_
+                        << "' is not a binary lease file of the expected"
+                        " type");
+        }
+        if (version != FORMAT_VERSION) {
+            bundy_throw(BinaryLeaseFileError, "the lease file '" << filename_
+                        << "' has unsupported version " << version);
+        }
+        read_pos_ = HEADER_LEN;
+        read_done_ = false;
+
+    } catch (...) {
+        ::close(fd_);
+        fd_ = -1;
+        throw;
+    }
+}
+
+void
+BinaryLeaseFile::recreate() {
+    close();
+    fd_ = ::open(filename_.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND,
+                 0644);
+    read_done_ = true;
+    if (fd_ < 0) {
+        bundy_throw(BinaryLeaseFileError, "unable to create the lease file '"
+                    << filename_ << "': " << strerror(errno));
+    }
+
+    OutputBuffer header(HEADER_LEN);
+    header.writeData(magic_.data(), magic_.size());
+    header.writeUint16(FORMAT_VERSION);
+    header.writeUint16(0);
+    struct iovec iov;
+    iov.iov_base = const_cast<void*>(header.getData());
+    iov.iov_len = header.getLength();
+    try {
+        writeAll(fd_, &iov, 1, filename_);
+    } catch (...) {
+        ::close(fd_);
+        fd_ = -1;
+        throw;
+    }
+}
+
+void
+BinaryLeaseFile::close() {
+    unmap();
+    if (fd_ < 0) {
+        return;
+    }
+    try {
+        flush();
+    } catch (...) {
+        pending_.clear();
+        ::close(fd_);
+        fd_ = -1;
+        throw;
+    }
+    ::close(fd_);
+    fd_ = -1;
+}
+
+void
+BinaryLeaseFile::flush() {
+    if (fd_ < 0 || pending_.empty()) {
+        return;
+    }
+    struct iovec iov;
+    iov.iov_base = &pending_[0];
+    iov.iov_len = pending_.size();
+    writeAll(fd_, &iov, 1, filename_);
+    pending_.clear();
+}
+
+void
+BinaryLeaseFile::sync() {
+    flush();
+    if (fd_ >= 0 && ::fsync(fd_) != 0) {
+        bundy_throw(BinaryLeaseFileError, "failed to synchronize the lease"
+                    " file '" << filename_ << "' with the disk: "
+                    << strerror(errno));
+    }
+}
+
+void
+BinaryLeaseFile::appendRecord(const OutputBuffer& record) {
+    if (fd_ < 0) {
+        bundy_throw(BinaryLeaseFileError, "the lease file '" << filename_
+                    << "' is not open");
+    }
+    if (record.getLength() > MAX_RECORD_LEN) {
+        bundy_throw(BinaryLeaseFileError, "lease record of " <<
+                    record.getLength() << " bytes is too long");
+    }
+
+    OutputBuffer header(RECORD_HEADER_LEN);
+    header.writeUint32(record.getLength());
+    header.writeUint32(computeCRC(record.getData(), record.getLength()));
+
+    if (auto_flush_ && pending_.empty()) {
+        // The header and the record are written at once, without copying
+        // them together.
+        struct iovec iov[2];
+        iov[0].iov_base = const_cast<void*>(header.getData());
+        iov[0].iov_len = header.getLength();
+        iov[1].iov_base = const_cast<void*>(record.getData());
+        iov[1].iov_len = record.getLength();
+        writeAll(fd_, iov, 2, filename_);
+        return;
+    }
+
+    const uint8_t* header_data =
+        static_cast<const uint8_t*>(header.getData());
+    const uint8_t* record_data =
+        static_cast<const uint8_t*>(record.getData());
+    pending_.insert(pending_.end(), header_data,
+                    header_data + header.getLength());
+    pending_.insert(pending_.end(), record_data,
+                    record_data + record.getLength());
+    if (auto_flush_) {
+        flush();
+    }
+}
+
+bool
+BinaryLeaseFile::nextRecord(const uint8_t*& data, size_t& length) {
+    if (read_done_ || fd_ < 0) {
+        return (false);
+    }
+    if (map_ == NULL) {
+        struct stat st;
+        if (fstat(fd_, &st) != 0) {
+            bundy_throw(BinaryLeaseFileError, "unable to get the size of the"
+                        " lease file '" << filename_ << "': "
+                        << strerror(errno));
+        }
+        if (st.st_size <= static_cast<off_t>(read_pos_)) {
+            read_done_ = true;
+            return (false);
+        }
+        void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (map == MAP_FAILED) {
+            bundy_throw(BinaryLeaseFileError, "unable to map the lease file '"
+                        << filename_ << "': " << strerror(errno));
+        }
+        madvise(map, st.st_size, MADV_SEQUENTIAL);
+        map_ = static_cast<const uint8_t*>(map);
+        map_len_ = st.st_size;
+    }
+
+    const size_t remaining = map_len_ - read_pos_;
+    if (remaining == 0) {
+        unmap();
+        read_done_ = true;
+        return (false);
+    }
+    if (remaining < RECORD_HEADER_LEN) {
+        truncate(read_pos_);
+        return (false);
+    }
+
+    InputBuffer header(map_ + read_pos_, RECORD_HEADER_LEN);
+    length = header.readUint32();
+    const uint32_t crc = header.readUint32();
+    if (length > MAX_RECORD_LEN) {
+        bundy_throw(BinaryLeaseFileError, "invalid length " << length
+                    << " of the lease record at offset " << read_pos_);
+    }
+    if (length > remaining - RECORD_HEADER_LEN) {
+        truncate(read_pos_);
+        return (false);
+    }
+    data = map_ + read_pos_ + RECORD_HEADER_LEN;
+    if (computeCRC(data, length) != crc) {
+        // The last record may have been partially written even though
+        // the file had grown to hold it.
+        if (length == remaining - RECORD_HEADER_LEN) {
+            truncate(read_pos_);
+            return (false);
+        }
+        bundy_throw(BinaryLeaseFileError, "invalid checksum of the lease"
+                    " record at offset " << read_pos_);
+    }
+    read_pos_ += RECORD_HEADER_LEN + length;
+    return (true);
+}
+
+void
+BinaryLeaseFile::unmap() {
+    if (map_ != NULL) {
+        munmap(const_cast<uint8_t*>(map_), map_len_);
+        map_ = NULL;
+        map_len_ = 0;
+    }
+}
+
+void
+BinaryLeaseFile::truncate(const size_t offset) {
+    LOG_WARN(dhcpsrv_logger, DHCPSRV_MEMFILE_BINARY_TRUNCATED)
+        .arg(map_len_ - offset).arg(filename_);
+    unmap();
+    read_done_ = true;
+    if (ftruncate(fd_, offset) != 0) {
+        bundy_throw(BinaryLeaseFileError, "failed to truncate the lease file '"
+                    << filename_ << "': " << strerror(errno));
+    }
+}
+
+BinaryLeaseFile4::BinaryLeaseFile4(const std::string& filename)
+    : BinaryLeaseFile(filename, "BLF4"), buffer_(256) {
+}
+
+void
+BinaryLeaseFile4::append(const Lease4& lease) {
+    createRecord(lease, buffer_);
+    appendRecord(buffer_);
+}
+
+bool
+BinaryLeaseFile4::next(Lease4Ptr& lease) {
+    // Like CSVLeaseFile4::next, this doesn't throw.
+    try {
+        const uint8_t* data;
+        size_t length;
+        if (!nextRecord(data, length)) {
+            lease.reset();
+            return (true);
+        }
+        InputBuffer buffer(data, length);
+        lease = parseRecord(buffer);
+
+    } catch (const std::exception& ex) {
+        lease.reset();
+        setReadMsg(ex.what());
+        return (false);
+    }
+    return (true);
+}
+
+void
+BinaryLeaseFile4::createRecord(const Lease4& lease, OutputBuffer& buffer) {
+    buffer.clear();
+    uint8_t addr[V6ADDRESS_LEN];
+    buffer.writeData(addr, lease.addr_.toBytes(addr));
+    buffer.writeUint32(lease.valid_lft_);
+    writeUint64(buffer, lease.cltt_ + lease.valid_lft_);
+    buffer.writeUint32(lease.subnet_id_);
+    buffer.writeUint8((lease.fqdn_fwd_ ? FLAG_FQDN_FWD : 0) |
+                      (lease.fqdn_rev_ ? FLAG_FQDN_REV : 0));
+    const std::vector<uint8_t> no_client_id;
+    const std::vector<uint8_t>& client_id =
+        lease.client_id_ ? lease.client_id_->getClientId() : no_client_id;
+    buffer.writeUint8(lease.hwaddr_.size());
+    buffer.writeUint8(client_id.size());
+    buffer.writeUint16(lease.hostname_.size());
+    if (!lease.hwaddr_.empty()) {
+        buffer.writeData(&lease.hwaddr_[0], lease.hwaddr_.size());
+    }
+    if (!client_id.empty()) {
+        buffer.writeData(&client_id[0], client_id.size());
+    }
+    buffer.writeData(lease.hostname_.data(), lease.hostname_.size());
+}
+
+Lease4Ptr
+BinaryLeaseFile4::parseRecord(InputBuffer& buffer) {
+    uint8_t addr[V4ADDRESS_LEN];
+    buffer.readData(addr, sizeof(addr));
+    const uint32_t valid = buffer.readUint32();
+    const uint64_t expire = readUint64(buffer);
+    const SubnetID subnet_id = buffer.readUint32();
+    const uint8_t flags = buffer.readUint8();
+    const size_t hwaddr_len = buffer.readUint8();
+    const size_t client_id_len = buffer.readUint8();
+    const size_t hostname_len = buffer.readUint16();
+
+    std::vector<uint8_t> hwaddr;
+    buffer.readVector(hwaddr, hwaddr_len);
+    if (hwaddr.empty()) {
+        bundy_throw(bundy::BadValue, "hardware address in the lease file"
+                    " must not be empty");
+    }
+    std::vector<uint8_t> client_id;
+    buffer.readVector(client_id, client_id_len);
+    const std::string hostname = readString(buffer, hostname_len);
+    checkEnd(buffer);
+
+    return (Lease4Ptr(new Lease4(IOAddress::fromBytes(AF_INET, addr),
+                                 &hwaddr[0], hwaddr.size(),
+                                 client_id.empty() ? NULL : &client_id[0],
+                                 client_id.size(), valid,
+                                 0, 0, // t1, t2 = 0
+                                 expire - valid, subnet_id,
+                                 flags & FLAG_FQDN_FWD,
+                                 flags & FLAG_FQDN_REV,
+                                 hostname)));
+}
+
+BinaryLeaseFile6::BinaryLeaseFile6(const std::string& filename)
+    : BinaryLeaseFile(filename, "BLF6"), buffer_(256) {
+}
+
+void
+BinaryLeaseFile6::append(const Lease6& lease) {
+    createRecord(lease, buffer_);
+    appendRecord(buffer_);
+}
+
+bool
+BinaryLeaseFile6::next(Lease6Ptr& lease) {
+    try {
+        const uint8_t* data;
+        size_t length;
+        if (!nextRecord(data, length)) {
+            lease.reset();
+            return (true);
+        }
+        InputBuffer buffer(data, length);
+        lease = parseRecord(buffer);
+
+    } catch (const std::exception& ex) {
+        lease.reset();
+        setReadMsg(ex.what());
+        return (false);
+    }
+    return (true);
+}
+
+void
+BinaryLeaseFile6::createRecord(const Lease6& lease, OutputBuffer& buffer) {
+    buffer.clear();
+    uint8_t addr[V6ADDRESS_LEN];
+    buffer.writeData(addr, lease.addr_.toBytes(addr));
+    buffer.writeUint32(lease.valid_lft_);
+    writeUint64(buffer, lease.cltt_ + lease.valid_lft_);
+    buffer.writeUint32(lease.subnet_id_);
+    buffer.writeUint32(lease.preferred_lft_);
+    buffer.writeUint32(lease.iaid_);
+    buffer.writeUint8(lease.type_);
+    buffer.writeUint8(lease.prefixlen_);
+    buffer.writeUint8((lease.fqdn_fwd_ ? FLAG_FQDN_FWD : 0) |
+                      (lease.fqdn_rev_ ? FLAG_FQDN_REV : 0));
+    const std::vector<uint8_t>& duid = lease.duid_->getDuid();
+    buffer.writeUint8(duid.size());
+    buffer.writeUint16(lease.hostname_.size());
+    buffer.writeData(&duid[0], duid.size());
+    buffer.writeData(lease.hostname_.data(), lease.hostname_.size());
+}
+
+Lease6Ptr
+BinaryLeaseFile6::parseRecord(InputBuffer& buffer) {
+    uint8_t addr[V6ADDRESS_LEN];
+    buffer.readData(addr, sizeof(addr));
+    const uint32_t valid = buffer.readUint32();
+    const uint64_t expire = readUint64(buffer);
+    const SubnetID subnet_id = buffer.readUint32();
+    const uint32_t preferred = buffer.readUint32();
+    const uint32_t iaid = buffer.readUint32();
+    const uint8_t type = buffer.readUint8();
+    const uint8_t prefixlen = buffer.readUint8();
+    const uint8_t flags = buffer.readUint8();
+    const size_t duid_len = buffer.readUint8();
+    const size_t hostname_len = buffer.readUint16();
+    if (type > Lease::TYPE_PD) {
+        bundy_throw(bundy::BadValue, "invalid lease type "
+                    << static_cast<int>(type));
+    }
+
+    std::vector<uint8_t> duid;
+    buffer.readVector(duid, duid_len);
+    const std::string hostname = readString(buffer, hostname_len);
+    checkEnd(buffer);
+
+    Lease6Ptr lease(new Lease6(static_cast<Lease::Type>(type),
+                               IOAddress::fromBytes(AF_INET6, addr),
+                               DuidPtr(new DUID(duid)), iaid, preferred,
+                               valid, 0, 0, // t1, t2 = 0
+                               subnet_id, prefixlen));
+    lease->cltt_ = expire - valid;
+    lease->fqdn_fwd_ = flags & FLAG_FQDN_FWD;
+    lease->fqdn_rev_ = flags & FLAG_FQDN_REV;
+    lease->hostname_ = hostname;
+    return (lease);
+}
+
+size_t
+convertLeaseFile(CSVLeaseFile4& source, BinaryLeaseFile4& target) {
+    return (copyLeases<Lease4Ptr>(source, target));
+}
+
+size_t
+convertLeaseFile(BinaryLeaseFile4& source, CSVLeaseFile4& target) {
+    return (copyLeases<Lease4Ptr>(source, target));
+}
+
+size_t
+convertLeaseFile(CSVLeaseFile6& source, BinaryLeaseFile6& target) {
+    return (copyLeases<Lease6Ptr>(source, target));
+}
+
+size_t
+convertLeaseFile(BinaryLeaseFile6& source, CSVLeaseFile6& target) {
+    return (copyLeases<Lease6Ptr>(source, target));
+}
+
+} // end of namespace bundy::dhcp
+} // end of namespace bundy
@@ -0,0 +1,354 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef BINARY_LEASE_FILE_H
+#define BINARY_LEASE_FILE_H
+
+#include <dhcpsrv/csv_lease_file4.h>
+#include <dhcpsrv/csv_lease_file6.h>
+#include <dhcpsrv/lease.h>
+#include <exceptions/exceptions.h>
+#include <util/buffer.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace bundy {
+namespace dhcp {
+
+/// @brief Exception thrown when the binary lease file can't be used.
+class BinaryLeaseFileError : public Exception {
+public:
+    BinaryLeaseFileError(const char* file, size_t line, const char* what) :
+        bundy::Exception(file, line, what) {}
+};
+
+/// @brief Provides methods to access a binary lease file.
+///
+/// This is the common part of the @c BinaryLeaseFile4 and
+/// @c BinaryLeaseFile6 classes, which are used by the memfile lease manager
+/// instead of the CSV lease files when the "format=binary" parameter is
+/// given (see @c Memfile_LeaseMgr). Like the CSV files, the binary lease
+/// files are only appended to, but the leases are written in fixed-width
+/// binary fields, so they don't have to be formatted to text when written
+/// or parsed when the file is loaded.
+///
+/// The file starts with a header of 8 bytes: 4 bytes identifying the type
+/// of the leases ("BLF4" or "BLF6") and the 16-bit version of the format,
+/// followed by 2 reserved bytes. Each record is then prefixed by its 32-bit
+/// length and the CRC-32 of its contents, all integers being in network
+/// byte order. A record whose length goes past the end of the file was
+/// being appended when the server stopped; it is dropped when the file is
+/// read, and the file is truncated to the last complete record. Any other
+/// invalid record is an error.
+///
+/// The records are appended with a single @c writev call for the length,
+/// checksum and contents, or buffered until @c flush when the auto flush
+/// is disabled. The file is read through a read-only memory mapping, made
+/// when the first record is read and released at the end of the file.
+///
+/// The file is expected to be read through to the end with @c next before
+/// any record is appended to it.
+class BinaryLeaseFile : public boost::noncopyable {
+public:
+    /// @brief Version of the format written.
+    static const uint16_t FORMAT_VERSION = 1;
+
+    /// @brief Length of the header of the file.
+    static const size_t HEADER_LEN = 8;
+
+    /// @brief Length of the length and checksum preceding each record.
+    static const size_t RECORD_HEADER_LEN = 8;
+
+    /// @brief Maximum length of the contents of a record.
+    ///
+    /// This is well above the length of any lease, so that a corrupted
+    /// length isn't taken for a record which was being appended.
+    static const size_t MAX_RECORD_LEN = 65536;
+
+    /// @brief Destructor.
+    ///
+    /// Closes the file, writing the buffered records.
+    virtual ~BinaryLeaseFile();
+
+    /// @brief Opens the file, creating it if it doesn't exist.
+    ///
+    /// @throw BinaryLeaseFileError if the file can't be opened or it holds
+    /// a header of another type of leases or another version.
+    void open();
+
+    /// @brief Creates a new empty file, replacing the existing one.
+    ///
+    /// @throw BinaryLeaseFileError if the file can't be created.
+    void recreate();
+
+    /// @brief Writes the buffered records and closes the file.
+    ///
+    /// It does nothing if the file isn't open.
+    void close();
+
+    /// @brief Writes the buffered records to the file.
+    ///
+    /// @throw BinaryLeaseFileError if the records can't be written.
+    void flush();
+
+    /// @brief Writes the buffered records and synchronizes the file with
+    /// the disk.
+    ///
+    /// @throw BinaryLeaseFileError if the records can't be written.
+    void sync();
+
+    /// @brief Sets whether each record is written as it is appended.
+    ///
+    /// @param auto_flush If false, the records are buffered until
+    /// @c flush or @c sync is called.
+    void setAutoFlush(const bool auto_flush) {
+        auto_flush_ = auto_flush;
+    }
+
+    /// @brief Returns whether each record is written as it is appended.
+    bool getAutoFlush() const {
+        return (auto_flush_);
+    }
+
+    /// @brief Returns the name of the file.
+    std::string getFilename() const {
+        return (filename_);
+    }
+
+    /// @brief Returns the description of the last error of @c next.
+    std::string getReadMsg() const {
+        return (read_msg_);
+    }
+
+protected:
+    /// @brief Constructor.
+    ///
+    /// @param filename Name of the file.
+    /// @param magic The 4 bytes at the start of the file, identifying the
+    /// type of the leases.
+    BinaryLeaseFile(const std::string& filename, const char* magic);
+
+    /// @brief Appends a record.
+    ///
+    /// @param record Contents of the record.
+    ///
+    /// @throw BinaryLeaseFileError if the file isn't open or the record
+    /// can't be written.
+    void appendRecord(const util::OutputBuffer& record);
+
+    /// @brief Reads the next record.
+    ///
+    /// @param [out] data Contents of the record.
+    /// @param [out] length Length of the contents.
+    ///
+    /// @return false if the end of the file has been reached.
+    ///
+    /// @throw BinaryLeaseFileError if the record is invalid.
+    bool nextRecord(const uint8_t*& data, size_t& length);
+
+    /// @brief Sets the description of the last error of @c next.
+    void setReadMsg(const std::string& read_msg) {
+        read_msg_ = read_msg;
+    }
+
+private:
+    /// @brief Releases the memory mapping of the file.
+    void unmap();
+
+    /// @brief Drops the end of the file, from the given offset.
+    void truncate(const size_t offset);
+
+    /// Name of the file.
+    const std::string filename_;
+
+    /// Identifies the type of the leases.
+    const std::string magic_;
+
+    /// File descriptor, negative if the file isn't open.
+    int fd_;
+
+    /// Whether each record is written as it is appended.
+    bool auto_flush_;
+
+    /// Whether the records of the file have all been read.
+    bool read_done_;
+
+    /// The file mapped for reading, NULL if it isn't being read.
+    const uint8_t* map_;
+
+    /// Length of the mapping.
+    size_t map_len_;
+
+    /// Offset of the next record to read.
+    size_t read_pos_;
+
+    /// Records appended and not written yet.
+    std::vector<uint8_t> pending_;
+
+    /// Description of the last error of @c next.
+    std::string read_msg_;
+};
+
+/// @brief Provides methods to access a binary file with DHCPv4 leases.
+///
+/// Each record holds the following fields:
+/// - address (4 bytes)
+/// - valid lifetime (4 bytes)
+/// - expiration time (8 bytes)
+/// - subnet identifier (4 bytes)
+/// - flags (1 byte): FQDN forward and reverse update
+/// - length of the hardware address (1 byte)
+/// - length of the client identifier (1 byte)
+/// - length of the hostname (2 bytes)
+/// - hardware address, client identifier and hostname
+///
+/// The client identifier is absent if its length is 0.
+class BinaryLeaseFile4 : public BinaryLeaseFile {
+public:
+    /// @brief Constructor.
+    ///
+    /// @param filename Name of the lease file.
+    BinaryLeaseFile4(const std::string& filename);
+
+    /// @brief Appends the lease record to the file.
+    ///
+    /// @param lease Structure representing a DHCPv4 lease.
+    ///
+    /// @throw BinaryLeaseFileError if the record can't be written.
+    void append(const Lease4& lease);
+
+    /// @brief Reads next lease from the file.
+    ///
+    /// If this function hits an error during lease read, it sets the error
+    /// message, which may be read using @c getReadMsg, and returns false.
+    ///
+    /// This function is exception safe.
+    ///
+    /// @param [out] lease Pointer to the lease read from the file or
+    /// NULL pointer if lease hasn't been read.
+    ///
+    /// @return Boolean value indicating that the new lease has been
+    /// read from the file (if true), or that the error has occurred
+    /// (false).
+    bool next(Lease4Ptr& lease);
+
+    /// @brief Writes the record of a lease.
+    ///
+    /// @param lease Structure representing a DHCPv4 lease.
+    /// @param [out] buffer Buffer to which the record is written.
+    static void createRecord(const Lease4& lease, util::OutputBuffer& buffer);
+
+    /// @brief Creates a lease from its record.
+    ///
+    /// @param buffer Buffer holding the record.
+    ///
+    /// @return Pointer to the lease.
+    ///
+    /// @throw bundy::Exception or derived class if the record is invalid.
+    static Lease4Ptr parseRecord(util::InputBuffer& buffer);
+
+private:
+    /// @brief Buffer in which the records are written, reused for each
+    /// record.
+    util::OutputBuffer buffer_;
+};
+
+/// @brief Provides methods to access a binary file with DHCPv6 leases.
+///
+/// Each record holds the following fields:
+/// - address (16 bytes)
+/// - valid lifetime (4 bytes)
+/// - expiration time (8 bytes)
+/// - subnet identifier (4 bytes)
+/// - preferred lifetime (4 bytes)
+/// - IAID (4 bytes)
+/// - lease type (1 byte)
+/// - prefix length (1 byte)
+/// - flags (1 byte): FQDN forward and reverse update
+/// - length of the DUID (1 byte)
+/// - length of the hostname (2 bytes)
+/// - DUID and hostname
+class BinaryLeaseFile6 : public BinaryLeaseFile {
+public:
+    /// @brief Constructor.
+    ///
+    /// @param filename Name of the lease file.
+    BinaryLeaseFile6(const std::string& filename);
+
+    /// @brief Appends the lease record to the file.
+    ///
+    /// @param lease Structure representing a DHCPv6 lease.
+    ///
+    /// @throw BinaryLeaseFileError if the record can't be written.
+    void append(const Lease6& lease);
+
+    /// @brief Reads next lease from the file.
+    ///
+    /// See @c BinaryLeaseFile4::next.
+    ///
+    /// @param [out] lease Pointer to the lease read from the file or
+    /// NULL pointer if lease hasn't been read.
+    ///
+    /// @return false if the error has occurred.
+    bool next(Lease6Ptr& lease);
+
+    /// @brief Writes the record of a lease.
+    ///
+    /// @param lease Structure representing a DHCPv6 lease.
+    /// @param [out] buffer Buffer to which the record is written.
+    static void createRecord(const Lease6& lease, util::OutputBuffer& buffer);
+
+    /// @brief Creates a lease from its record.
+    ///
+    /// @param buffer Buffer holding the record.
+    ///
+    /// @return Pointer to the lease.
+    ///
+    /// @throw bundy::Exception or derived class if the record is invalid.
+    static Lease6Ptr parseRecord(util::InputBuffer& buffer);
+
+private:
+    /// @brief Buffer in which the records are written, reused for each
+    /// record.
+    util::OutputBuffer buffer_;
+};
+
+/// @name Conversion between the CSV and binary lease files.
+///
+/// These functions append the leases read from an open lease file to
+/// another open lease file, in the same order, so the records superseded by
+/// later ones are kept. The target file is not flushed.
+///
+/// @param source Lease file to read, from its current position.
+/// @param target Lease file to append to.
+///
+/// @return Number of leases copied.
+///
+/// @throw BinaryLeaseFileError if a lease can't be read from the source
+/// file or written to the target file.
+//@{
+size_t convertLeaseFile(CSVLeaseFile4& source, BinaryLeaseFile4& target);
+size_t convertLeaseFile(BinaryLeaseFile4& source, CSVLeaseFile4& target);
+size_t convertLeaseFile(CSVLeaseFile6& source, BinaryLeaseFile6& target);
+size_t convertLeaseFile(BinaryLeaseFile6& source, CSVLeaseFile6& target);
+//@}
+
+} // namespace bundy::dhcp
+} // namespace bundy
+
+#endif // BINARY_LEASE_FILE_H
@@ -40,6 +40,11 @@ namespace dhcp {
 /// CalloutHandle.  As the stored pointers are shared pointers, clearing them
 /// removes one reference that keeps the pointed-to objects in existence.
 ///
+/// A packet parked by the callouts (see bundy::hooks::ParkingLot) gets
+/// processed again after other packets have been seen.  When it is resumed,
+/// its CalloutHandle is passed along with it, so that it is again the one
+/// returned for it.
+///
 /// @note If the behaviour of the server changes so that multiple packets can
 ///       be active at the same time, this simplistic approach will no longer
 ///       be adequate and a more complicated structure (such as a map) will
@@ -48,6 +53,8 @@ namespace dhcp {
 /// @param pktptr Pointer to the packet being processed.  This is typically a
 ///        Pkt4Ptr or Pkt6Ptr object.  An empty pointer is passed to clear
 ///        the stored pointers.
+/// @param handle CalloutHandle to associate with the packet, instead of a
+///        new one if the packet has not been seen before.
 ///
 /// @return Shared pointer to a CalloutHandle.  This is the previously-stored
 ///         CalloutHandle if pktptr points to a packet that has been seen
@@ -55,7 +62,11 @@ namespace dhcp {
 ///         pointer is returned if pktptr is itself an empty pointer.
 
 template <typename T>
-bundy::hooks::CalloutHandlePtr getCalloutHandle(const T& pktptr) {
+bundy::hooks::CalloutHandlePtr getCalloutHandle(const T& pktptr,
+                                                const bundy::hooks::
+                                                CalloutHandlePtr& handle =
+                                                bundy::hooks::
+                                                CalloutHandlePtr()) {
 
     // Stored data is declared static, so is initialized when first accessed
     static T stored_pointer;                // Pointer to last packet seen
@@ -66,7 +77,13 @@ bundy::hooks::CalloutHandlePtr getCalloutHandle(const T& pktptr) {
 
         // Pointer given, have we seen it before? (If we have, we don't need to
         // do anything as we will automatically return the stored handle.)
-        if (pktptr != stored_pointer) {
+        if (handle) {
+
+            // Handle given, so this is a packet resumed after others.
+            stored_pointer = pktptr;
+            stored_handle = handle;
+
+        } else if (pktptr != stored_pointer) {
 
             // Not seen before, so store the pointer passed to us and get a new
             // CalloutHandle.  (The latter operation frees and probably deletes
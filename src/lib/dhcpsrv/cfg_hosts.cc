@@ -0,0 +1,116 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <dhcpsrv/cfg_hosts.h>
+
+#include <boost/tuple/tuple.hpp>
+
+using namespace bundy::asiolink;
+
+namespace bundy {
+namespace dhcp {
+
+size_t
+CfgHosts::AddressHash::operator()(const IOAddress& address) const {
+    return (address.hash());
+}
+
+void
+CfgHosts::add(const HostPtr& host) {
+    std::pair<HostContainer::iterator, bool> inserted = hosts_.insert(host);
+    if (!inserted.second) {
+        bundy_throw(DuplicateHost, "duplicate host "
+                    << host->getIdentifierAsText() << " in the subnet "
+                    << host->getSubnetID());
+    }
+
+    std::vector<IOAddress> addresses = host->getIPv6Reservations();
+    if (host->hasIPv4Reservation()) {
+        addresses.push_back(host->getIPv4Reservation());
+    }
+    for (size_t i = 0; i < addresses.size(); ++i) {
+        if (!addresses_.insert(HostAddress(addresses[i], host)).second) {
+            // Leave the reservations as they were.
+            for (size_t j = 0; j < i; ++j) {
+                addresses_.erase(addresses[j]);
+            }
+            hosts_.erase(inserted.first);
+            bundy_throw(DuplicateHost, "address " << addresses[i]
+                        << " of the host " << host->getIdentifierAsText()
+                        << " is already reserved");
+        }
+    }
+}
+
+void
+CfgHosts::reserve(const size_t count) {
+    hosts_.reserve(count);
+    addresses_.reserve(count);
+}
+
+ConstHostPtr
+CfgHosts::get(const SubnetID subnet_id, const Host::IdentifierType type,
+              const std::vector<uint8_t>& identifier) const {
+    HostContainer::const_iterator host =
+        hosts_.find(boost::make_tuple(identifier, type, subnet_id));
+    return (host == hosts_.end() ? ConstHostPtr() : *host);
+}
+
+ConstHostPtr
+CfgHosts::get4(const SubnetID subnet_id, const HWAddrPtr& hwaddr,
+               const ClientIdPtr& clientid) const {
+    if (hosts_.empty()) {
+        return (ConstHostPtr());
+    }
+    ConstHostPtr host;
+    if (hwaddr) {
+        host = get(subnet_id, Host::IDENT_HWADDR, hwaddr->hwaddr_);
+    }
+    if (!host && clientid) {
+        host = get(subnet_id, Host::IDENT_CLIENT_ID, clientid->getClientId());
+    }
+    return (host);
+}
+
+ConstHostPtr
+CfgHosts::get6(const SubnetID subnet_id, const DuidPtr& duid,
+               const HWAddrPtr& hwaddr) const {
+    if (hosts_.empty()) {
+        return (ConstHostPtr());
+    }
+    ConstHostPtr host;
+    if (duid) {
+        host = get(subnet_id, Host::IDENT_DUID, duid->getDuid());
+    }
+    if (!host && hwaddr) {
+        host = get(subnet_id, Host::IDENT_HWADDR, hwaddr->hwaddr_);
+    }
+    return (host);
+}
+
+ConstHostPtr
+CfgHosts::get(const SubnetID subnet_id, const IOAddress& address) const {
+    if (addresses_.empty()) {
+        return (ConstHostPtr());
+    }
+    HostAddressContainer::const_iterator host = addresses_.find(address);
+    if (host == addresses_.end() ||
+        host->host_->getSubnetID() != subnet_id) {
+        return (ConstHostPtr());
+    }
+    return (host->host_);
+}
+
+} // end of namespace bundy::dhcp
+} // end of namespace bundy
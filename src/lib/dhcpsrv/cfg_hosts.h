@@ -0,0 +1,182 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef CFG_HOSTS_H
+#define CFG_HOSTS_H
+
+#include <asiolink/io_address.h>
+#include <dhcp/duid.h>
+#include <dhcp/hwaddr.h>
+#include <dhcpsrv/host.h>
+#include <exceptions/exceptions.h>
+
+#include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/indexed_by.hpp>
+#include <boost/multi_index/mem_fun.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index_container.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace bundy {
+namespace dhcp {
+
+/// @brief Exception thrown when a host can't be added to the reservations.
+class DuplicateHost : public Exception {
+public:
+    DuplicateHost(const char* file, size_t line, const char* what) :
+        bundy::Exception(file, line, what) { };
+};
+
+/// @brief Host reservations of the server.
+///
+/// The hosts are indexed by hash tables, so the lookups of the host of a
+/// client in a subnet and of the host an address is reserved for don't
+/// depend on the number of the hosts. The allocation engine (see
+/// @ref AllocEngine) uses them to assign the reserved addresses before
+/// picking addresses from the pools, and to skip the addresses reserved for
+/// other clients when it picks them.
+///
+/// The reservations are built from the configuration (or by any other
+/// source of the hosts) in a separate object which then replaces the one
+/// held by @ref CfgMgr.
+class CfgHosts {
+public:
+    /// @brief Adds a host.
+    ///
+    /// @param host the host.
+    /// @throw DuplicateHost if the subnet already has a host with the same
+    /// identifier, or one of the addresses of the host is already reserved.
+    void add(const HostPtr& host);
+
+    /// @brief Prepares the hash tables for the given number of hosts.
+    ///
+    /// This avoids rehashing while a large number of hosts is added.
+    ///
+    /// @param count expected number of the hosts.
+    void reserve(const size_t count);
+
+    /// @brief Returns the host of a DHCPv4 client in a subnet.
+    ///
+    /// The host is looked up by the hardware address first, then by the
+    /// client identifier.
+    ///
+    /// @param subnet_id identifier of the subnet.
+    /// @param hwaddr hardware address of the client, may be NULL.
+    /// @param clientid client identifier, may be NULL.
+    /// @return the host, or NULL if the client has none.
+    ConstHostPtr get4(const SubnetID subnet_id, const HWAddrPtr& hwaddr,
+                      const ClientIdPtr& clientid = ClientIdPtr()) const;
+
+    /// @brief Returns the host of a DHCPv6 client in a subnet.
+    ///
+    /// The host is looked up by the DUID first, then by the hardware
+    /// address.
+    ///
+    /// @param subnet_id identifier of the subnet.
+    /// @param duid DUID of the client, may be NULL.
+    /// @param hwaddr hardware address of the client, may be NULL.
+    /// @return the host, or NULL if the client has none.
+    ConstHostPtr get6(const SubnetID subnet_id, const DuidPtr& duid,
+                      const HWAddrPtr& hwaddr = HWAddrPtr()) const;
+
+    /// @brief Returns the host an address is reserved for in a subnet.
+    ///
+    /// @param subnet_id identifier of the subnet.
+    /// @param address IPv4 or IPv6 address.
+    /// @return the host, or NULL if the address isn't reserved.
+    ConstHostPtr get(const SubnetID subnet_id,
+                     const asiolink::IOAddress& address) const;
+
+    /// @brief Returns the number of the hosts.
+    size_t size() const {
+        return (hosts_.size());
+    }
+
+    /// @brief Checks if there are no hosts.
+    bool empty() const {
+        return (hosts_.empty());
+    }
+
+private:
+    /// @brief Returns the host with the given identifier in a subnet.
+    ConstHostPtr get(const SubnetID subnet_id,
+                     const Host::IdentifierType type,
+                     const std::vector<uint8_t>& identifier) const;
+
+    /// @brief Hash of the addresses.
+    struct AddressHash {
+        size_t operator()(const asiolink::IOAddress& address) const;
+    };
+
+    /// @brief Reserved address of a host.
+    struct HostAddress {
+        HostAddress(const asiolink::IOAddress& address,
+                    const ConstHostPtr& host) :
+            address_(address), host_(host)
+        {}
+
+        asiolink::IOAddress address_;
+        ConstHostPtr host_;
+    };
+
+    /// @brief Hosts indexed by their identifier and subnet.
+    typedef boost::multi_index_container<
+        ConstHostPtr,
+        boost::multi_index::indexed_by<
+            boost::multi_index::hashed_unique<
+                boost::multi_index::composite_key<
+                    Host,
+                    boost::multi_index::const_mem_fun<
+                        Host, const std::vector<uint8_t>&,
+                        &Host::getIdentifier>,
+                    boost::multi_index::const_mem_fun<
+                        Host, Host::IdentifierType,
+                        &Host::getIdentifierType>,
+                    boost::multi_index::const_mem_fun<
+                        Host, SubnetID, &Host::getSubnetID>
+                >
+            >
+        >
+    > HostContainer;
+
+    /// @brief Reserved addresses indexed by the address.
+    typedef boost::multi_index_container<
+        HostAddress,
+        boost::multi_index::indexed_by<
+            boost::multi_index::hashed_unique<
+                boost::multi_index::member<HostAddress, asiolink::IOAddress,
+                                           &HostAddress::address_>,
+                AddressHash
+            >
+        >
+    > HostAddressContainer;
+
+    /// The hosts.
+    HostContainer hosts_;
+
+    /// The reserved addresses.
+    HostAddressContainer addresses_;
+};
+
+/// @brief Pointer to the host reservations.
+typedef boost::shared_ptr<CfgHosts> CfgHostsPtr;
+
+/// @brief Pointer to the const host reservations.
+typedef boost::shared_ptr<const CfgHosts> ConstCfgHostsPtr;
+
+} // end of namespace bundy::dhcp
+} // end of namespace bundy
+
+#endif // CFG_HOSTS_H
@@ -0,0 +1,273 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <dhcp/iface_mgr.h>
+#include <dhcp/libdhcp++.h>
+#include <dhcpsrv/cfg_snapshot.h>
+#include <dhcpsrv/cfgmgr.h>
+#include <dhcpsrv/dhcpsrv_log.h>
+
+using namespace bundy::asiolink;
+
+namespace bundy {
+namespace dhcp {
+
+Subnet4Ptr
+selectSubnet4(const Subnet4Collection& subnets,
+              const SubnetIndex<Subnet4Collection>& index,
+              const IOAddress& hint, const ClientClasses& classes,
+              const bool relay) {
+    // Only the subnets which contain the hint, or have it as the relay
+    // address, need to be checked.
+    SubnetIndex<Subnet4Collection>::Positions positions;
+    index.find(hint, relay, positions);
+
+    // Iterate over these subnets to find a suitable one for the given
+    // address, in the order in which they were configured.
+    for (size_t i = 0; i < positions.size(); ++i) {
+        const Subnet4Ptr& subnet = subnets[positions[i]];
+
+        // If client is rejected because of not meeting client class criteria...
+        if (!subnet->clientSupported(classes)) {
+            continue;
+        }
+
+        // If the hint is a relay address, and there is relay info specified
+        // for this subnet and those two match, then use this subnet.
+        if (relay && (subnet->getRelayInfo().addr_ == hint) ) {
+            LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
+                      DHCPSRV_CFGMGR_SUBNET4_RELAY)
+                .arg(subnet->toText()).arg(hint.toText());
+            return (subnet);
+        }
+
+        // Let's check if the client belongs to the given subnet
+        if (subnet->inRange(hint)) {
+            LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
+                      DHCPSRV_CFGMGR_SUBNET4)
+                      .arg(subnet->toText()).arg(hint.toText());
+            return (subnet);
+        }
+    }
+
+    // sorry, we don't support that subnet
+    LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE, DHCPSRV_CFGMGR_NO_SUBNET4)
+              .arg(hint.toText());
+    return (Subnet4Ptr());
+}
+
+Subnet4Ptr
+selectSubnet4(const Subnet4Collection& subnets,
+              const SubnetIndex<Subnet4Collection>& index,
+              const std::string& iface_name, const ClientClasses& classes) {
+    Iface* iface = IfaceMgr::instance().getIface(iface_name);
+    // This should never happen in the real life. Hence we throw an exception.
+    if (iface == NULL) {
+        bundy_throw(bundy::BadValue, "interface " << iface_name <<
+                  " doesn't exist and therefore it is impossible"
+                  " to find a suitable subnet for its IPv4 address");
+    }
+    IOAddress addr("0.0.0.0");
+    // If IPv4 address assigned to the interface exists, find a suitable
+    // subnet for it, else return NULL pointer to indicate that no subnet
+    // could be found.
+    return (iface->getAddress4(addr) ?
+            selectSubnet4(subnets, index, addr, classes, false) :
+            Subnet4Ptr());
+}
+
+Subnet6Ptr
+selectSubnet6(const Subnet6Collection& subnets,
+              const SubnetIndex<Subnet6Collection>& index,
+              const IOAddress& hint, const ClientClasses& classes,
+              const bool relay) {
+    // Only the subnets which contain the hint, or have it as the relay
+    // address, need to be checked.
+    SubnetIndex<Subnet6Collection>::Positions positions;
+    index.find(hint, relay, positions);
+
+    // If there is more than one, we need to choose the proper one
+    for (size_t i = 0; i < positions.size(); ++i) {
+        const Subnet6Ptr& subnet = subnets[positions[i]];
+
+        // If client is rejected because of not meeting client class criteria...
+        if (!subnet->clientSupported(classes)) {
+            continue;
+        }
+
+        // If the hint is a relay address, and there is relay info specified
+        // for this subnet and those two match, then use this subnet.
+        if (relay && (subnet->getRelayInfo().addr_ == hint) ) {
+            LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
+                      DHCPSRV_CFGMGR_SUBNET6_RELAY)
+                .arg(subnet->toText()).arg(hint.toText());
+            return (subnet);
+        }
+
+        if (subnet->inRange(hint)) {
+            LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE, DHCPSRV_CFGMGR_SUBNET6)
+                      .arg(subnet->toText()).arg(hint.toText());
+            return (subnet);
+        }
+    }
+
+    // sorry, we don't support that subnet
+    LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE, DHCPSRV_CFGMGR_NO_SUBNET6)
+              .arg(hint.toText());
+    return (Subnet6Ptr());
+}
+
+Subnet6Ptr
+selectSubnet6(const Subnet6Collection& subnets,
+              const SubnetIndex<Subnet6Collection>& index,
+              const std::string& iface, const ClientClasses& classes) {
+    if (!iface.length()) {
+        return (Subnet6Ptr());
+    }
+
+    const SubnetIndex<Subnet6Collection>::Positions* positions =
+        index.findIface(iface);
+    if (!positions) {
+        return (Subnet6Ptr());
+    }
+
+    // If there is more than one, we need to choose the proper one
+    for (size_t i = 0; i < positions->size(); ++i) {
+        const Subnet6Ptr& subnet = subnets[(*positions)[i]];
+
+        // If client is rejected because of not meeting client class criteria...
+        if (!subnet->clientSupported(classes)) {
+            continue;
+        }
+
+        if (iface == subnet->getIface()) {
+            LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
+                      DHCPSRV_CFGMGR_SUBNET6_IFACE)
+                .arg(subnet->toText()).arg(iface);
+            return (subnet);
+        }
+    }
+    return (Subnet6Ptr());
+}
+
+Subnet6Ptr
+selectSubnet6(const Subnet6Collection& subnets,
+              const SubnetIndex<Subnet6Collection>& index,
+              const OptionPtr& iface_id_option, const ClientClasses& classes) {
+    if (!iface_id_option) {
+        return (Subnet6Ptr());
+    }
+
+    const SubnetIndex<Subnet6Collection>::Positions* positions =
+        index.findInterfaceId(iface_id_option);
+    if (!positions) {
+        return (Subnet6Ptr());
+    }
+
+    // Let's iterate over the subnets that have this interface-id and check
+    // if the interface-id is equal to what we are looking for
+    for (size_t i = 0; i < positions->size(); ++i) {
+        const Subnet6Ptr& subnet = subnets[(*positions)[i]];
+
+        // If client is rejected because of not meeting client class criteria...
+        if (!subnet->clientSupported(classes)) {
+            continue;
+        }
+
+        if (subnet->getInterfaceId() &&
+            (subnet->getInterfaceId()->equal(iface_id_option))) {
+            LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
+                      DHCPSRV_CFGMGR_SUBNET6_IFACE_ID)
+                .arg(subnet->toText());
+            return (subnet);
+        }
+    }
+    return (Subnet6Ptr());
+}
+
+CfgSnapshot::CfgSnapshot(const CfgMgr& cfg_mgr, const uint64_t generation)
+    : generation_(generation),
+      selection_generation_(Subnet::getSelectionGeneration()),
+      subnets4_(cfg_mgr.subnets4_), subnets6_(cfg_mgr.subnets6_),
+      option_def_tables_(cfg_mgr.option_def_tables_),
+      active_ifaces_(cfg_mgr.active_ifaces_),
+      unicast_addrs_(cfg_mgr.unicast_addrs_),
+      all_ifaces_active_(cfg_mgr.all_ifaces_active_),
+      echo_v4_client_id_(cfg_mgr.echo_v4_client_id_),
+      client_class_defs_(cfg_mgr.client_class_defs_),
+      hosts_(cfg_mgr.hosts_) {
+    subnets4_index_.build(subnets4_);
+    subnets6_index_.build(subnets6_);
+}
+
+Subnet4Ptr
+CfgSnapshot::getSubnet4(const IOAddress& hint, const ClientClasses& classes,
+                        bool relay) const {
+    return (selectSubnet4(subnets4_, subnets4_index_, hint, classes, relay));
+}
+
+Subnet4Ptr
+CfgSnapshot::getSubnet4(const std::string& iface,
+                        const ClientClasses& classes) const {
+    return (selectSubnet4(subnets4_, subnets4_index_, iface, classes));
+}
+
+Subnet6Ptr
+CfgSnapshot::getSubnet6(const IOAddress& hint, const ClientClasses& classes,
+                        const bool relay) const {
+    return (selectSubnet6(subnets6_, subnets6_index_, hint, classes, relay));
+}
+
+Subnet6Ptr
+CfgSnapshot::getSubnet6(const std::string& iface,
+                        const ClientClasses& classes) const {
+    return (selectSubnet6(subnets6_, subnets6_index_, iface, classes));
+}
+
+Subnet6Ptr
+CfgSnapshot::getSubnet6(OptionPtr interface_id,
+                        const ClientClasses& classes) const {
+    return (selectSubnet6(subnets6_, subnets6_index_, interface_id, classes));
+}
+
+const OptionDefTable*
+CfgSnapshot::getOptionDefTable(const std::string& option_space) const {
+    std::map<std::string, OptionDefTable>::const_iterator table =
+        option_def_tables_.find(option_space);
+    return (table == option_def_tables_.end() ? NULL : &table->second);
+}
+
+bool
+CfgSnapshot::isActiveIface(const std::string& iface) const {
+    if (all_ifaces_active_) {
+        return (true);
+    }
+    for (std::list<std::string>::const_iterator it = active_ifaces_.begin();
+         it != active_ifaces_.end(); ++it) {
+        if (iface == *it) {
+            return (true);
+        }
+    }
+    return (false);
+}
+
+const IOAddress*
+CfgSnapshot::getUnicast(const std::string& iface) const {
+    std::map<std::string, IOAddress>::const_iterator addr =
+        unicast_addrs_.find(iface);
+    return (addr == unicast_addrs_.end() ? NULL : &addr->second);
+}
+
+} // namespace bundy::dhcp
+} // namespace bundy
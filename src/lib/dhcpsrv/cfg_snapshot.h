@@ -0,0 +1,237 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef CFG_SNAPSHOT_H
+#define CFG_SNAPSHOT_H
+
+#include <asiolink/io_address.h>
+#include <dhcp/classify.h>
+#include <dhcp/option.h>
+#include <dhcp/option_definition.h>
+#include <dhcpsrv/cfg_hosts.h>
+#include <dhcpsrv/client_class_expr.h>
+#include <dhcpsrv/subnet.h>
+#include <dhcpsrv/subnet_index.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <list>
+#include <map>
+#include <stdint.h>
+#include <string>
+
+namespace bundy {
+namespace dhcp {
+
+class CfgMgr;
+
+/// @brief Immutable copy of the configuration used to process packets.
+///
+/// The @c CfgMgr is changed in place while a new configuration is being
+/// committed, which is only safe as long as nothing else uses it at the
+/// same time. A snapshot holds what the packet processing needs (the
+/// subnets with their selection indexes, the option definitions, the
+/// active interfaces, the client classes and the host reservations), as
+/// it was when the snapshot was taken, and is never modified afterwards.
+/// It can thus be used by any number of threads without locking, while a
+/// new configuration is being built.
+///
+/// The snapshots are published by @c CfgMgr::publishSnapshot() and read
+/// through a @c CfgMgr::SnapshotReader (or @c CfgMgr::getSnapshot()).
+///
+/// @note The subnets and host reservations are shared with the
+/// @c CfgMgr, not copied. A new configuration creates new subnet objects,
+/// so this is safe as long as the subnets aren't modified after they were
+/// committed.
+class CfgSnapshot : public boost::noncopyable {
+public:
+    /// @brief Takes a snapshot of the current configuration.
+    ///
+    /// @param cfg_mgr The configuration manager.
+    /// @param generation The configuration generation of the snapshot.
+    CfgSnapshot(const CfgMgr& cfg_mgr, const uint64_t generation);
+
+    /// @brief Returns the configuration generation of the snapshot.
+    ///
+    /// @see CfgMgr::getGeneration()
+    uint64_t getGeneration() const {
+        return (generation_);
+    }
+
+    /// @brief Returns the value of @c Subnet::getSelectionGeneration()
+    /// when the snapshot was taken.
+    uint64_t getSelectionGeneration() const {
+        return (selection_generation_);
+    }
+
+    /// @brief Returns an IPv4 subnet for an address.
+    ///
+    /// @see CfgMgr::getSubnet4(const bundy::asiolink::IOAddress&,
+    /// const ClientClasses&, bool)
+    Subnet4Ptr getSubnet4(const bundy::asiolink::IOAddress& hint,
+                          const ClientClasses& classes,
+                          bool relay = false) const;
+
+    /// @brief Returns an IPv4 subnet for an interface.
+    ///
+    /// @see CfgMgr::getSubnet4(const std::string&, const ClientClasses&)
+    Subnet4Ptr getSubnet4(const std::string& iface,
+                          const ClientClasses& classes) const;
+
+    /// @brief Returns an IPv6 subnet for an address.
+    ///
+    /// @see CfgMgr::getSubnet6(const bundy::asiolink::IOAddress&,
+    /// const ClientClasses&, const bool)
+    Subnet6Ptr getSubnet6(const bundy::asiolink::IOAddress& hint,
+                          const ClientClasses& classes,
+                          const bool relay = false) const;
+
+    /// @brief Returns an IPv6 subnet for an interface.
+    ///
+    /// @see CfgMgr::getSubnet6(const std::string&, const ClientClasses&)
+    Subnet6Ptr getSubnet6(const std::string& iface,
+                          const ClientClasses& classes) const;
+
+    /// @brief Returns an IPv6 subnet for an interface-id option.
+    ///
+    /// @see CfgMgr::getSubnet6(OptionPtr, const ClientClasses&)
+    Subnet6Ptr getSubnet6(OptionPtr interface_id,
+                          const ClientClasses& classes) const;
+
+    /// @brief Returns all IPv4 subnets.
+    const Subnet4Collection* getSubnets4() const {
+        return (&subnets4_);
+    }
+
+    /// @brief Returns all IPv6 subnets.
+    const Subnet6Collection* getSubnets6() const {
+        return (&subnets6_);
+    }
+
+    /// @brief Returns the table of option definitions of an option space.
+    ///
+    /// @see CfgMgr::getOptionDefTable()
+    const OptionDefTable*
+    getOptionDefTable(const std::string& option_space) const;
+
+    /// @brief Checks if the server listens on an interface.
+    ///
+    /// @see CfgMgr::isActiveIface()
+    bool isActiveIface(const std::string& iface) const;
+
+    /// @brief Returns the unicast address the server listens on an
+    /// interface, or NULL.
+    ///
+    /// @see CfgMgr::getUnicast()
+    const bundy::asiolink::IOAddress*
+    getUnicast(const std::string& iface) const;
+
+    /// @brief Returns whether the DHCPv4 server echoes the client-id.
+    bool echoClientId() const {
+        return (echo_v4_client_id_);
+    }
+
+    /// @brief Returns the client classes defined by test expressions.
+    const ClientClassDefList& getClientClassDefs() const {
+        return (client_class_defs_);
+    }
+
+    /// @brief Returns the host reservations.
+    ConstCfgHostsPtr getHosts() const {
+        return (hosts_);
+    }
+
+private:
+    /// Configuration generation the snapshot was taken at.
+    const uint64_t generation_;
+
+    /// Subnet selection generation the snapshot was taken at.
+    const uint64_t selection_generation_;
+
+    /// IPv4 subnets, in the configured order.
+    const Subnet4Collection subnets4_;
+
+    /// IPv6 subnets, in the configured order.
+    const Subnet6Collection subnets6_;
+
+    /// Index used to select IPv4 subnets.
+    SubnetIndex<Subnet4Collection> subnets4_index_;
+
+    /// Index used to select IPv6 subnets.
+    SubnetIndex<Subnet6Collection> subnets6_index_;
+
+    /// Tables of the option definitions, by option space name.
+    std::map<std::string, OptionDefTable> option_def_tables_;
+
+    /// Names of the interfaces the server listens on.
+    std::list<std::string> active_ifaces_;
+
+    /// Unicast addresses the server listens on, by interface name.
+    std::map<std::string, bundy::asiolink::IOAddress> unicast_addrs_;
+
+    /// Whether the server listens on all interfaces.
+    bool all_ifaces_active_;
+
+    /// Whether the DHCPv4 server echoes the client-id.
+    bool echo_v4_client_id_;
+
+    /// Client classes defined by test expressions.
+    ClientClassDefList client_class_defs_;
+
+    /// Host reservations.
+    ConstCfgHostsPtr hosts_;
+};
+
+/// @brief Pointer to a configuration snapshot.
+typedef boost::shared_ptr<const CfgSnapshot> ConstCfgSnapshotPtr;
+
+/// @name Subnet selection shared by @c CfgMgr and @c CfgSnapshot.
+///
+/// Each returns the first subnet, in the configured order, matching the
+/// criteria and supporting the client classes, using the index of the
+/// subnets. They are documented with the @c CfgMgr methods they implement.
+//@{
+Subnet4Ptr
+selectSubnet4(const Subnet4Collection& subnets,
+              const SubnetIndex<Subnet4Collection>& index,
+              const bundy::asiolink::IOAddress& hint,
+              const ClientClasses& classes, const bool relay);
+
+Subnet4Ptr
+selectSubnet4(const Subnet4Collection& subnets,
+              const SubnetIndex<Subnet4Collection>& index,
+              const std::string& iface, const ClientClasses& classes);
+
+Subnet6Ptr
+selectSubnet6(const Subnet6Collection& subnets,
+              const SubnetIndex<Subnet6Collection>& index,
+              const bundy::asiolink::IOAddress& hint,
+              const ClientClasses& classes, const bool relay);
+
+Subnet6Ptr
+selectSubnet6(const Subnet6Collection& subnets,
+              const SubnetIndex<Subnet6Collection>& index,
+              const std::string& iface, const ClientClasses& classes);
+
+Subnet6Ptr
+selectSubnet6(const Subnet6Collection& subnets,
+              const SubnetIndex<Subnet6Collection>& index,
+              const OptionPtr& interface_id, const ClientClasses& classes);
+//@}
+
+} // namespace bundy::dhcp
+} // namespace bundy
+
+#endif // CFG_SNAPSHOT_H
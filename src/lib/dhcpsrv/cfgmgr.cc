@@ -17,11 +17,51 @@
 #include <dhcp/libdhcp++.h>
 #include <dhcpsrv/cfgmgr.h>
 #include <dhcpsrv/dhcpsrv_log.h>
+
+#include <set>
 #include <string>
 
 using namespace bundy::asiolink;
 using namespace bundy::util;
 
+namespace {
+
+/// @brief Checks a new collection of subnets before it replaces the current
+/// one.
+///
+/// @param current the current collection of subnets.
+/// @param subnets the new collection of subnets.
+/// @param family "IPv4" or "IPv6", for the error message.
+///
+/// @return the number of subnet objects which are in both collections.
+/// @throw bundy::dhcp::DuplicateSubnetID if two of the new subnets have
+/// the same ID.
+template <typename SubnetCollectionType>
+size_t
+checkReplacedSubnets(const SubnetCollectionType& current,
+                     const SubnetCollectionType& subnets, const char* family) {
+    std::set<bundy::dhcp::SubnetID> ids;
+    for (typename SubnetCollectionType::const_iterator subnet =
+             subnets.begin(); subnet != subnets.end(); ++subnet) {
+        if (!ids.insert((*subnet)->getID()).second) {
+            bundy_throw(bundy::dhcp::DuplicateSubnetID, "ID of the new "
+                        << family << " subnet '" << (*subnet)->getID()
+                        << "' is already in use");
+        }
+    }
+
+    std::set<typename SubnetCollectionType::value_type>
+        kept(current.begin(), current.end());
+    size_t kept_count = 0;
+    for (typename SubnetCollectionType::const_iterator subnet =
+             subnets.begin(); subnet != subnets.end(); ++subnet) {
+        kept_count += kept.erase(*subnet);
+    }
+    return (kept_count);
+}
+
+}
+
 namespace bundy {
 namespace dhcp {
 
@@ -91,6 +131,14 @@ CfgMgr::addOptionDef(const OptionDefinitionPtr& def,
     }
     // Actually add a new item.
     option_def_spaces_.addItem(def, option_space);
+
+    // And index it by the code for the lookups made when parsing options.
+    OptionDefTable& table = option_def_tables_[option_space];
+    if (def->getCode() >= table.size()) {
+        table.resize(def->getCode() + 1);
+    }
+    table[def->getCode()] = def;
+    configChanged();
 }
 
 OptionDefContainerPtr
@@ -100,119 +148,40 @@ CfgMgr::getOptionDefs(const std::string& option_space) const {
     return (option_def_spaces_.getItems(option_space));
 }
 
+const OptionDefTable*
+CfgMgr::getOptionDefTable(const std::string& option_space) const {
+    std::map<std::string, OptionDefTable>::const_iterator table =
+        option_def_tables_.find(option_space);
+    return (table == option_def_tables_.end() ? NULL : &table->second);
+}
+
 OptionDefinitionPtr
 CfgMgr::getOptionDef(const std::string& option_space,
                      const uint16_t option_code) const {
     // @todo Validate the option space once the #2313 is implemented.
 
-    // Get a reference to option definitions for a particular option space.
-    OptionDefContainerPtr defs = getOptionDefs(option_space);
-    // If there are no matching option definitions then return the empty pointer.
-    if (!defs || defs->empty()) {
-        return (OptionDefinitionPtr());
-    }
-    // If there are some option definitions for a particular option space
-    // use an option code to get the one we want.
-    const OptionDefContainerTypeIndex& idx = defs->get<1>();
-    const OptionDefContainerTypeRange& range = idx.equal_range(option_code);
-    // If there is no definition that matches option code, return empty pointer.
-    if (std::distance(range.first, range.second) == 0) {
-        return (OptionDefinitionPtr());
-    }
-    // If there is more than one definition matching an option code, return
-    // the first one. This should not happen because we check for duplicates
-    // when addOptionDef is called.
-    return (*range.first);
+    return (LibDHCP::findOptionDef(getOptionDefTable(option_space),
+                                   option_code));
 }
 
 Subnet6Ptr
 CfgMgr::getSubnet6(const std::string& iface,
                    const bundy::dhcp::ClientClasses& classes) {
-
-    if (!iface.length()) {
-        return (Subnet6Ptr());
-    }
-
-    // If there is more than one, we need to choose the proper one
-    for (Subnet6Collection::iterator subnet = subnets6_.begin();
-         subnet != subnets6_.end(); ++subnet) {
-
-        // If client is rejected because of not meeting client class criteria...
-        if (!(*subnet)->clientSupported(classes)) {
-            continue;
-        }
-
-        if (iface == (*subnet)->getIface()) {
-            LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
-                      DHCPSRV_CFGMGR_SUBNET6_IFACE)
-                .arg((*subnet)->toText()).arg(iface);
-            return (*subnet);
-        }
-    }
-    return (Subnet6Ptr());
+    return (selectSubnet6(subnets6_, getSubnets6Index(), iface, classes));
 }
 
 Subnet6Ptr
 CfgMgr::getSubnet6(const bundy::asiolink::IOAddress& hint,
                    const bundy::dhcp::ClientClasses& classes,
                    const bool relay) {
-
-    // If there is more than one, we need to choose the proper one
-    for (Subnet6Collection::iterator subnet = subnets6_.begin();
-         subnet != subnets6_.end(); ++subnet) {
-
-        // If client is rejected because of not meeting client class criteria...
-        if (!(*subnet)->clientSupported(classes)) {
-            continue;
-        }
-
-        // If the hint is a relay address, and there is relay info specified
-        // for this subnet and those two match, then use this subnet.
-        if (relay && ((*subnet)->getRelayInfo().addr_ == hint) ) {
-            LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
-                      DHCPSRV_CFGMGR_SUBNET6_RELAY)
-                .arg((*subnet)->toText()).arg(hint.toText());
-            return (*subnet);
-        }
-
-        if ((*subnet)->inRange(hint)) {
-            LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE, DHCPSRV_CFGMGR_SUBNET6)
-                      .arg((*subnet)->toText()).arg(hint.toText());
-            return (*subnet);
-        }
-    }
-
-    // sorry, we don't support that subnet
-    LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE, DHCPSRV_CFGMGR_NO_SUBNET6)
-              .arg(hint.toText());
-    return (Subnet6Ptr());
+    return (selectSubnet6(subnets6_, getSubnets6Index(), hint, classes,
+                          relay));
 }
 
 Subnet6Ptr CfgMgr::getSubnet6(OptionPtr iface_id_option,
                               const bundy::dhcp::ClientClasses& classes) {
-    if (!iface_id_option) {
-        return (Subnet6Ptr());
-    }
-
-    // Let's iterate over all subnets and for those that have interface-id
-    // defined, check if the interface-id is equal to what we are looking for
-    for (Subnet6Collection::iterator subnet = subnets6_.begin();
-         subnet != subnets6_.end(); ++subnet) {
-
-        // If client is rejected because of not meeting client class criteria...
-        if (!(*subnet)->clientSupported(classes)) {
-            continue;
-        }
-
-        if ( (*subnet)->getInterfaceId() &&
-             ((*subnet)->getInterfaceId()->equal(iface_id_option))) {
-            LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
-                      DHCPSRV_CFGMGR_SUBNET6_IFACE_ID)
-                .arg((*subnet)->toText());
-            return (*subnet);
-        }
-    }
-    return (Subnet6Ptr());
+    return (selectSubnet6(subnets6_, getSubnets6Index(), iface_id_option,
+                          classes));
 }
 
 void CfgMgr::addSubnet6(const Subnet6Ptr& subnet) {
@@ -226,61 +195,23 @@ void CfgMgr::addSubnet6(const Subnet6Ptr& subnet) {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE, DHCPSRV_CFGMGR_ADD_SUBNET6)
               .arg(subnet->toText());
     subnets6_.push_back(subnet);
+    subnets6_index_.invalidate();
+    configChanged();
 }
 
 Subnet4Ptr
 CfgMgr::getSubnet4(const bundy::asiolink::IOAddress& hint,
                    const bundy::dhcp::ClientClasses& classes,
                    bool relay) const {
-    // Iterate over existing subnets to find a suitable one for the
-    // given address.
-    for (Subnet4Collection::const_iterator subnet = subnets4_.begin();
-         subnet != subnets4_.end(); ++subnet) {
-
-        // If client is rejected because of not meeting client class criteria...
-        if (!(*subnet)->clientSupported(classes)) {
-            continue;
-        }
-
-        // If the hint is a relay address, and there is relay info specified
-        // for this subnet and those two match, then use this subnet.
-        if (relay && ((*subnet)->getRelayInfo().addr_ == hint) ) {
-            LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
-                      DHCPSRV_CFGMGR_SUBNET4_RELAY)
-                .arg((*subnet)->toText()).arg(hint.toText());
-            return (*subnet);
-        }
-
-        // Let's check if the client belongs to the given subnet
-        if ((*subnet)->inRange(hint)) {
-            LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
-                      DHCPSRV_CFGMGR_SUBNET4)
-                      .arg((*subnet)->toText()).arg(hint.toText());
-            return (*subnet);
-        }
-    }
-
-    // sorry, we don't support that subnet
-    LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE, DHCPSRV_CFGMGR_NO_SUBNET4)
-              .arg(hint.toText());
-    return (Subnet4Ptr());
+    return (selectSubnet4(subnets4_, getSubnets4Index(), hint, classes,
+                          relay));
 }
 
 Subnet4Ptr
 CfgMgr::getSubnet4(const std::string& iface_name,
                    const bundy::dhcp::ClientClasses& classes) const {
-    Iface* iface = IfaceMgr::instance().getIface(iface_name);
-    // This should never happen in the real life. Hence we throw an exception.
-    if (iface == NULL) {
-        bundy_throw(bundy::BadValue, "interface " << iface_name <<
-                  " doesn't exist and therefore it is impossible"
-                  " to find a suitable subnet for its IPv4 address");
-    }
-    IOAddress addr("0.0.0.0");
-    // If IPv4 address assigned to the interface exists, find a suitable
-    // subnet for it, else return NULL pointer to indicate that no subnet
-    // could be found.
-    return (iface->getAddress4(addr) ? getSubnet4(addr, classes) : Subnet4Ptr());
+    return (selectSubnet4(subnets4_, getSubnets4Index(), iface_name,
+                          classes));
 }
 
 void CfgMgr::addSubnet4(const Subnet4Ptr& subnet) {
@@ -293,20 +224,56 @@ void CfgMgr::addSubnet4(const Subnet4Ptr& subnet) {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE, DHCPSRV_CFGMGR_ADD_SUBNET4)
               .arg(subnet->toText());
     subnets4_.push_back(subnet);
+    subnets4_index_.invalidate();
+    configChanged();
 }
 
 void CfgMgr::deleteOptionDefs() {
     option_def_spaces_.clearItems();
+    option_def_tables_.clear();
+    configChanged();
+}
+
+void CfgMgr::replaceSubnets4(const Subnet4Collection& subnets) {
+    const size_t kept = checkReplacedSubnets(subnets4_, subnets, "IPv4");
+    LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE, DHCPSRV_CFGMGR_REPLACE_SUBNET4)
+              .arg(subnets.size() - kept).arg(subnets4_.size() - kept)
+              .arg(kept);
+    // Build the index for the new subnets before they are committed, so
+    // that both are replaced together.
+    SubnetIndex<Subnet4Collection> index;
+    index.build(subnets);
+    subnets4_ = subnets;
+    subnets4_index_.swap(index);
+    configChanged();
+}
+
+void CfgMgr::replaceSubnets6(const Subnet6Collection& subnets) {
+    const size_t kept = checkReplacedSubnets(subnets6_, subnets, "IPv6");
+    LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE, DHCPSRV_CFGMGR_REPLACE_SUBNET6)
+              .arg(subnets.size() - kept).arg(subnets6_.size() - kept)
+              .arg(kept);
+    // Build the index for the new subnets before they are committed, so
+    // that both are replaced together.
+    SubnetIndex<Subnet6Collection> index;
+    index.build(subnets);
+    subnets6_ = subnets;
+    subnets6_index_.swap(index);
+    configChanged();
 }
 
 void CfgMgr::deleteSubnets4() {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE, DHCPSRV_CFGMGR_DELETE_SUBNET4);
     subnets4_.clear();
+    subnets4_index_.invalidate();
+    configChanged();
 }
 
 void CfgMgr::deleteSubnets6() {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE, DHCPSRV_CFGMGR_DELETE_SUBNET6);
     subnets6_.clear();
+    subnets6_index_.invalidate();
+    configChanged();
 }
 
 
@@ -341,6 +308,7 @@ CfgMgr::addActiveIface(const std::string& iface) {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE, DHCPSRV_CFGMGR_ADD_IFACE)
         .arg(iface_copy);
     active_ifaces_.push_back(iface_copy);
+    configChanged();
 }
 
 void
@@ -348,6 +316,7 @@ CfgMgr::activateAllIfaces() {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
               DHCPSRV_CFGMGR_ALL_IFACES_ACTIVE);
     all_ifaces_active_ = true;
+    configChanged();
 }
 
 void
@@ -358,6 +327,7 @@ CfgMgr::deleteActiveIfaces() {
     all_ifaces_active_ = false;
 
     unicast_addrs_.clear();
+    configChanged();
 }
 
 bool
@@ -407,6 +377,21 @@ CfgMgr::isDuplicate(const Subnet6& subnet) const {
     return (false);
 }
 
+const SubnetIndex<Subnet4Collection>&
+CfgMgr::getSubnets4Index() const {
+    if (!subnets4_index_.isCurrent()) {
+        subnets4_index_.build(subnets4_);
+    }
+    return (subnets4_index_);
+}
+
+const SubnetIndex<Subnet6Collection>&
+CfgMgr::getSubnets6Index() const {
+    if (!subnets6_index_.isCurrent()) {
+        subnets6_index_.build(subnets6_);
+    }
+    return (subnets6_index_);
+}
 
 const bundy::asiolink::IOAddress*
 CfgMgr::getUnicast(const std::string& iface) const {
@@ -417,6 +402,16 @@ CfgMgr::getUnicast(const std::string& iface) const {
     return (&(*addr).second);
 }
 
+void
+CfgMgr::setClientClassDefs(const ClientClassDefList& defs) {
+    for (ClientClassDefList::const_iterator def = defs.begin();
+         def != defs.end(); ++def) {
+        ClientClasses::intern(def->name_);
+    }
+    client_class_defs_ = defs;
+    configChanged();
+}
+
 void
 CfgMgr::setD2ClientConfig(D2ClientConfigPtr& new_config) {
     d2_client_mgr_.setD2ClientConfig(new_config);
@@ -437,16 +432,58 @@ CfgMgr::getD2ClientMgr() {
     return (d2_client_mgr_);
 }
 
+ConstCfgSnapshotPtr
+CfgMgr::getSnapshot() {
+    util::thread::EpochDomain::Guard guard(epoch_);
+    return (*acquireSnapshot());
+}
+
+void
+CfgMgr::publishSnapshot() {
+    const uint64_t generation = generation_;
+    const ConstCfgSnapshotPtr* snapshot =
+        new ConstCfgSnapshotPtr(new CfgSnapshot(*this, generation));
+    const ConstCfgSnapshotPtr* old = snapshot_.exchange(snapshot);
+    LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
+              DHCPSRV_CFGMGR_SNAPSHOT_PUBLISHED)
+        .arg(generation).arg(subnets4_.size()).arg(subnets6_.size());
+    if (old) {
+        epoch_.retireObject(old);
+    }
+}
+
+const ConstCfgSnapshotPtr*
+CfgMgr::acquireSnapshot() {
+    const ConstCfgSnapshotPtr* snapshot = snapshot_;
+    if (!snapshot ||
+        (auto_publish_ &&
+         (((*snapshot)->getGeneration() != generation_) ||
+          ((*snapshot)->getSelectionGeneration() !=
+           Subnet::getSelectionGeneration())))) {
+        publishSnapshot();
+        snapshot = snapshot_;
+    }
+    return (snapshot);
+}
+
 CfgMgr::CfgMgr()
     : datadir_(DHCP_DATA_DIR),
       all_ifaces_active_(false), echo_v4_client_id_(true),
-      d2_client_mgr_() {
+      reclaim_timer_(0), reclaim_max_leases_(100), reclaim_max_time_(250),
+      parked_query_limit_(256), parked_query_timeout_(5000),
+      receive_queue_limit_(0), shed_threshold_(0),
+      offer_lifetime_(0), d2_client_mgr_(), hosts_(new CfgHosts()),
+      snapshot_(NULL), generation_(0), auto_publish_(true) {
+    // A snapshot is big, so the replaced ones are destroyed as soon as
+    // possible.
+    epoch_.setReclaimThreshold(1);
     // DHCP_DATA_DIR must be set set with -DDHCP_DATA_DIR="..." in Makefile.am
     // Note: the definition of DHCP_DATA_DIR needs to include quotation marks
     // See AM_CPPFLAGS definition in Makefile.am
 }
 
 CfgMgr::~CfgMgr() {
+    delete snapshot_.load();
 }
 
 }; // end of bundy::dhcp namespace
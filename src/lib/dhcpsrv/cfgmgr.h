@@ -20,15 +20,21 @@
 #include <dhcp/option_definition.h>
 #include <dhcp/option_space.h>
 #include <dhcp/classify.h>
+#include <dhcpsrv/cfg_hosts.h>
+#include <dhcpsrv/cfg_snapshot.h>
+#include <dhcpsrv/client_class_expr.h>
 #include <dhcpsrv/d2_client_mgr.h>
 #include <dhcpsrv/option_space_container.h>
 #include <dhcpsrv/pool.h>
 #include <dhcpsrv/subnet.h>
+#include <dhcpsrv/subnet_index.h>
 #include <util/buffer.h>
+#include <util/threads/epoch.h>
 
 #include <boost/shared_ptr.hpp>
 #include <boost/noncopyable.hpp>
 
+#include <atomic>
 #include <map>
 #include <string>
 #include <vector>
@@ -135,6 +141,21 @@ public:
     OptionDefinitionPtr getOptionDef(const std::string& option_space,
                                      const uint16_t option_code) const;
 
+    /// @brief Return the table of option definitions of an option space.
+    ///
+    /// The table holds the definitions returned by @c getOptionDefs indexed
+    /// by the option code. It is meant for the code parsing the options,
+    /// which can look up the space once and then the definition of each
+    /// option directly. The table is only valid until the definitions are
+    /// modified.
+    ///
+    /// @param option_space option space.
+    ///
+    /// @return pointer to the table, or NULL if no option definition has
+    /// been added to the option space.
+    const OptionDefTable*
+    getOptionDefTable(const std::string& option_space) const;
+
     /// @brief Adds new DHCPv4 option space to the collection.
     ///
     /// @param space option space to be added.
@@ -249,6 +270,19 @@ public:
     /// completely new?
     void deleteSubnets6();
 
+    /// @brief replaces all IPv6 subnets
+    ///
+    /// This method replaces the existing IPv6 subnets with the given ones
+    /// in a single step. It is used during reconfiguration, where subnets
+    /// whose configuration didn't change are passed as the same objects
+    /// they were previously added as, so their state (like the last
+    /// allocated addresses) is kept.
+    ///
+    /// @param subnets new collection of subnets.
+    /// @throw bundy::dhcp::DuplicateSubnetID if two of the subnets have the
+    /// same ID, in which case the existing subnets are left unchanged.
+    void replaceSubnets6(const Subnet6Collection& subnets);
+
     /// @brief returns const reference to all subnets6
     ///
     /// This is used in a hook (subnet4_select), where the hook is able
@@ -325,6 +359,19 @@ public:
     /// completely new?
     void deleteSubnets4();
 
+    /// @brief replaces all IPv4 subnets
+    ///
+    /// This method replaces the existing IPv4 subnets with the given ones
+    /// in a single step. It is used during reconfiguration, where subnets
+    /// whose configuration didn't change are passed as the same objects
+    /// they were previously added as, so their state (like the last
+    /// allocated address) is kept.
+    ///
+    /// @param subnets new collection of subnets.
+    /// @throw bundy::dhcp::DuplicateSubnetID if two of the subnets have the
+    /// same ID, in which case the existing subnets are left unchanged.
+    void replaceSubnets4(const Subnet4Collection& subnets);
+
 
     /// @brief returns path do the data directory
     ///
@@ -389,6 +436,7 @@ public:
     /// @param echo should the client-id be sent or not
     void echoClientId(const bool echo) {
         echo_v4_client_id_ = echo;
+        configChanged();
     }
 
     /// @brief Returns whether server should send back client-id in DHCPv4.
@@ -397,6 +445,140 @@ public:
         return (echo_v4_client_id_);
     }
 
+    /// @brief Sets the parameters of the expired leases reclamation.
+    ///
+    /// The server periodically deletes a batch of the expired leases from
+    /// the lease database, removing the DNS entries for them, so that the
+    /// lookups don't have to skip over them.
+    ///
+    /// @param timer interval between the reclamations in seconds, zero
+    /// disables the reclamation.
+    /// @param max_leases maximum number of leases reclaimed at once, zero
+    /// for no limit.
+    /// @param max_time maximum time a reclamation may take in milliseconds,
+    /// zero for no limit.
+    void setLeaseReclamation(const uint32_t timer, const uint32_t max_leases,
+                             const uint32_t max_time) {
+        reclaim_timer_ = timer;
+        reclaim_max_leases_ = max_leases;
+        reclaim_max_time_ = max_time;
+    }
+
+    /// @brief Returns the interval between the lease reclamations.
+    /// @return interval in seconds, zero if the reclamation is disabled.
+    uint32_t getReclaimTimer() const {
+        return (reclaim_timer_);
+    }
+
+    /// @brief Returns the maximum number of leases reclaimed at once.
+    /// @return the number of leases, zero if unlimited.
+    uint32_t getReclaimMaxLeases() const {
+        return (reclaim_max_leases_);
+    }
+
+    /// @brief Returns the maximum time a lease reclamation may take.
+    /// @return time in milliseconds, zero if unlimited.
+    uint32_t getReclaimMaxTime() const {
+        return (reclaim_max_time_);
+    }
+
+    /// @brief Sets the limits on the queries parked by the callouts.
+    ///
+    /// A hook library waiting for an external server can park the query
+    /// (see @ref bundy::hooks::ParkingTicket), so that the server processes
+    /// other queries in the meantime.
+    ///
+    /// @param limit maximum number of parked queries, zero for no limit.
+    /// The queries parked beyond it are dropped.
+    /// @param timeout time after which a parked query is dropped, in
+    /// milliseconds, zero for no timeout.
+    void setQueryParking(const uint32_t limit, const uint32_t timeout) {
+        parked_query_limit_ = limit;
+        parked_query_timeout_ = timeout;
+    }
+
+    /// @brief Returns the maximum number of parked queries.
+    /// @return the number of queries, zero if unlimited.
+    uint32_t getParkedQueryLimit() const {
+        return (parked_query_limit_);
+    }
+
+    /// @brief Returns the time after which a parked query is dropped.
+    /// @return time in milliseconds, zero if the queries don't time out.
+    uint32_t getParkedQueryTimeout() const {
+        return (parked_query_timeout_);
+    }
+
+    /// @brief Sets the limits of the queue of the received queries.
+    ///
+    /// See @ref ReceiveQueue.
+    ///
+    /// @param limit maximum number of queries waiting in each priority
+    /// class, zero processes the queries in the order received.
+    /// @param shed_threshold number of queries waiting above which the
+    /// low priority queries are dropped, zero for no threshold.
+    void setReceiveQueue(const uint32_t limit, const uint32_t shed_threshold) {
+        receive_queue_limit_ = limit;
+        shed_threshold_ = shed_threshold;
+    }
+
+    /// @brief Returns the maximum number of queries of a priority class.
+    /// @return the number of queries, zero if the queue is disabled.
+    uint32_t getReceiveQueueLimit() const {
+        return (receive_queue_limit_);
+    }
+
+    /// @brief Returns the backlog above which low priority queries are
+    /// dropped.
+    /// @return the number of queries, zero if there is no threshold.
+    uint32_t getShedThreshold() const {
+        return (shed_threshold_);
+    }
+
+    /// @brief Sets the time during which a DHCPv4 offer is held.
+    ///
+    /// See @ref AllocEngine::setOfferLifetime.
+    ///
+    /// @param lifetime time in seconds, zero not to hold the offers.
+    void setOfferLifetime(const uint32_t lifetime) {
+        offer_lifetime_ = lifetime;
+    }
+
+    /// @brief Returns the time during which a DHCPv4 offer is held.
+    /// @return time in seconds, zero if the offers are not held.
+    uint32_t getOfferLifetime() const {
+        return (offer_lifetime_);
+    }
+
+    /// @brief Sets the client classes defined by test expressions.
+    ///
+    /// The names of the classes are interned (see
+    /// @ref bundy::dhcp::ClientClasses::intern).
+    ///
+    /// @param defs the new list of the classes, replacing the current one.
+    void setClientClassDefs(const ClientClassDefList& defs);
+
+    /// @brief Returns the client classes defined by test expressions.
+    const ClientClassDefList& getClientClassDefs() const {
+        return (client_class_defs_);
+    }
+
+    /// @brief Sets the host reservations.
+    ///
+    /// @param hosts the new reservations, replacing the current ones. They
+    /// must not be modified afterwards. NULL removes all reservations.
+    void setHosts(const CfgHostsPtr& hosts) {
+        hosts_ = (hosts ? hosts : CfgHostsPtr(new CfgHosts()));
+        configChanged();
+    }
+
+    /// @brief Returns the host reservations.
+    ///
+    /// @return the reservations, never NULL.
+    ConstCfgHostsPtr getHosts() const {
+        return (hosts_);
+    }
+
     /// @brief Updates the DHCP-DDNS client configuration to the given value.
     ///
     /// @param new_config pointer to the new client configuration.
@@ -420,6 +602,88 @@ public:
     /// @return a reference to the DHCP-DDNS manager.
     D2ClientMgr& getD2ClientMgr();
 
+    /// @name Configuration snapshots.
+    ///
+    /// The packet processing reads the configuration from an immutable
+    /// @c CfgSnapshot, so that a new configuration can be built in the
+    /// @c CfgMgr while the packets are processed with the previous one.
+    /// A server publishes a snapshot once it has committed a new
+    /// configuration, and its packet processing takes the current snapshot
+    /// for each packet with a @c SnapshotReader. The reader doesn't touch
+    /// any reference count or lock: the snapshot pointer is protected by an
+    /// epoch-based reclamation domain, so a replaced snapshot is destroyed
+    /// once no reader can use it any more.
+    ///
+    /// By default, a reader finding the published snapshot out of date
+    /// (because the configuration was changed through the @c CfgMgr since
+    /// it was taken) publishes a new one first, so the readers always see
+    /// the current configuration. This is only safe when the configuration
+    /// is changed by the thread processing the packets; a server processing
+    /// packets in other threads must disable it with @c setAutoPublish and
+    /// publish the snapshots explicitly.
+    //@{
+
+    /// @brief Reads the current configuration snapshot.
+    ///
+    /// The snapshot is valid during the lifetime of the reader, which
+    /// should not be longer than the processing of a packet.
+    class SnapshotReader : public boost::noncopyable {
+    public:
+        /// @brief Constructor.
+        ///
+        /// @param cfg_mgr The configuration manager.
+        explicit SnapshotReader(CfgMgr& cfg_mgr = CfgMgr::instance())
+            : guard_(cfg_mgr.epoch_), snapshot_(cfg_mgr.acquireSnapshot()) {
+        }
+
+        /// @brief Returns the snapshot.
+        const CfgSnapshot& operator*() const {
+            return (**snapshot_);
+        }
+
+        /// @brief Returns the snapshot.
+        const CfgSnapshot* operator->() const {
+            return (snapshot_->get());
+        }
+
+    private:
+        /// Keeps the snapshot from being destroyed.
+        util::thread::EpochDomain::Guard guard_;
+
+        /// The snapshot.
+        const ConstCfgSnapshotPtr* const snapshot_;
+    };
+
+    /// @brief Returns the current configuration snapshot.
+    ///
+    /// Unlike the @c SnapshotReader, this takes a reference to the
+    /// snapshot, so it can be kept as long as needed.
+    ConstCfgSnapshotPtr getSnapshot();
+
+    /// @brief Publishes the current configuration as a new snapshot.
+    ///
+    /// The snapshot replaces the published one atomically; the readers
+    /// which have taken the previous snapshot keep using it.
+    void publishSnapshot();
+
+    /// @brief Sets whether the readers publish a new snapshot when the
+    /// published one is out of date.
+    ///
+    /// @param auto_publish true (the default) to publish automatically.
+    /// The first snapshot is published by the first reader anyway.
+    void setAutoPublish(const bool auto_publish) {
+        auto_publish_ = auto_publish;
+    }
+
+    /// @brief Returns the generation of the configuration.
+    ///
+    /// It is incremented each time the configuration held by the
+    /// @c CfgMgr is changed.
+    uint64_t getGeneration() const {
+        return (generation_);
+    }
+    //@}
+
 protected:
 
     /// @brief Protected constructor.
@@ -435,22 +699,32 @@ protected:
 
     /// @brief a container for IPv6 subnets.
     ///
-    /// That is a simple vector of pointers. It does not make much sense to
-    /// optimize access time (e.g. using a map), because typical search
-    /// pattern will use calling inRange() method on each subnet until
-    /// a match is found.
+    /// That is a simple vector of pointers, in the configured order. The
+    /// subnets are looked up using @c subnets6_index_.
     Subnet6Collection subnets6_;
 
     /// @brief a container for IPv4 subnets.
     ///
-    /// That is a simple vector of pointers. It does not make much sense to
-    /// optimize access time (e.g. using a map), because typical search
-    /// pattern will use calling inRange() method on each subnet until
-    /// a match is found.
+    /// That is a simple vector of pointers, in the configured order. The
+    /// subnets are looked up using @c subnets4_index_.
     Subnet4Collection subnets4_;
 
 private:
 
+    /// The snapshot is taken from the private members.
+    friend class CfgSnapshot;
+
+    /// @brief Records a change of the configuration.
+    void configChanged() {
+        ++generation_;
+    }
+
+    /// @brief Returns the published snapshot, publishing one first if
+    /// needed.
+    ///
+    /// It must be called within a guard of @c epoch_.
+    const ConstCfgSnapshotPtr* acquireSnapshot();
+
     /// @brief Checks if the specified interface is listed as active.
     ///
     /// This function searches for the specified interface name on the list of
@@ -479,6 +753,28 @@ private:
     /// @return true if the duplicate subnet exists.
     bool isDuplicate(const Subnet6& subnet) const;
 
+    /// @brief Returns the index of the IPv4 subnets.
+    ///
+    /// The index is rebuilt first if it is out of date.
+    const SubnetIndex<Subnet4Collection>& getSubnets4Index() const;
+
+    /// @brief Returns the index of the IPv6 subnets.
+    ///
+    /// The index is rebuilt first if it is out of date.
+    const SubnetIndex<Subnet6Collection>& getSubnets6Index() const;
+
+    /// @brief Index used to select IPv4 subnets.
+    ///
+    /// It is rebuilt when the subnets are replaced, or on the first lookup
+    /// after they were changed in any other way.
+    mutable SubnetIndex<Subnet4Collection> subnets4_index_;
+
+    /// @brief Index used to select IPv6 subnets.
+    ///
+    /// It is rebuilt when the subnets are replaced, or on the first lookup
+    /// after they were changed in any other way.
+    mutable SubnetIndex<Subnet6Collection> subnets6_index_;
+
     /// @brief A collection of option definitions.
     ///
     /// A collection of option definitions that can be accessed
@@ -486,6 +782,9 @@ private:
     OptionSpaceContainer<OptionDefContainer,
         OptionDefinitionPtr, std::string> option_def_spaces_;
 
+    /// @brief Tables of the option definitions, by option space name.
+    std::map<std::string, OptionDefTable> option_def_tables_;
+
     /// @brief Container for defined DHCPv6 option spaces.
     OptionSpaceCollection spaces6_;
 
@@ -514,8 +813,48 @@ private:
     /// Indicates whether v4 server should send back client-id
     bool echo_v4_client_id_;
 
+    /// @name Parameters of the expired leases reclamation.
+    //@{
+    uint32_t reclaim_timer_;
+    uint32_t reclaim_max_leases_;
+    uint32_t reclaim_max_time_;
+    //@}
+
+    /// @name Limits on the queries parked by the callouts.
+    //@{
+    uint32_t parked_query_limit_;
+    uint32_t parked_query_timeout_;
+    //@}
+
+    /// @name Limits of the queue of the received queries.
+    //@{
+    uint32_t receive_queue_limit_;
+    uint32_t shed_threshold_;
+    //@}
+
+    /// @brief Time during which a DHCPv4 offer is held, in seconds.
+    uint32_t offer_lifetime_;
+
     /// @brief Manages the DHCP-DDNS client and its configuration.
     D2ClientMgr d2_client_mgr_;
+
+    /// @brief Client classes defined by test expressions.
+    ClientClassDefList client_class_defs_;
+
+    /// @brief Host reservations.
+    CfgHostsPtr hosts_;
+
+    /// @brief Protects the published snapshot from the readers.
+    util::thread::EpochDomain epoch_;
+
+    /// @brief The published snapshot, NULL if there is none.
+    std::atomic<const ConstCfgSnapshotPtr*> snapshot_;
+
+    /// @brief Generation of the configuration.
+    std::atomic<uint64_t> generation_;
+
+    /// @brief Whether readers publish a new snapshot if needed.
+    std::atomic<bool> auto_publish_;
 };
 
 } // namespace bundy::dhcp
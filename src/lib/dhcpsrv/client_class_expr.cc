@@ -0,0 +1,475 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <dhcp/pkt4.h>
+#include <dhcp/pkt6.h>
+#include <dhcpsrv/client_class_expr.h>
+#include <util/buffer.h>
+#include <util/encode/hex.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+using namespace std;
+
+namespace bundy {
+namespace dhcp {
+
+/// @brief Compiler of the client classification expressions.
+///
+/// This is a recursive descent parser of the grammar documented in
+/// @ref ClientClassExpr, which emits the instructions while parsing.
+class ClientClassExprCompiler {
+public:
+    ClientClassExprCompiler(ClientClassExpr& expr,
+                            const Option::Universe universe) :
+        expr_(expr), text_(expr.text_), pos_(0),
+        max_code_(universe == Option::V4 ? 254 : 65535)
+    {}
+
+    void compile() {
+        nextToken();
+        if (token_ == END) {
+            error("empty expression");
+        }
+        parseExpr();
+        if (token_ != END) {
+            error("unexpected '" + token_text_ + "'");
+        }
+    }
+
+private:
+    enum TokenType {
+        END,
+        WORD,           // keyword
+        NUMBER,         // decimal integer
+        STRING,         // quoted string or hexadecimal literal
+        PUNCT           // one of [ ] ( ) , . == !=
+    };
+
+    /// @brief Operand of a comparison.
+    struct Operand {
+        bool is_option_;
+        uint16_t code_;
+        uint16_t start_;
+        uint16_t length_;
+        vector<uint8_t> literal_;
+    };
+
+    void error(const string& msg) const {
+        bundy_throw(ClientClassExprError, "invalid client class expression '"
+                    << text_ << "': " << msg << " at offset "
+                    << token_pos_);
+    }
+
+    void nextToken() {
+        while (pos_ < text_.size() && isspace(text_[pos_])) {
+            ++pos_;
+        }
+        token_pos_ = pos_;
+        token_text_.clear();
+        if (pos_ == text_.size()) {
+            token_ = END;
+            token_text_ = "end of expression";
+            return;
+        }
+
+        const char c = text_[pos_];
+        if (c == '\'') {
+            const size_t end = text_.find('\'', pos_ + 1);
+            if (end == string::npos) {
+                error("unterminated string");
+            }
+            token_ = STRING;
+            token_text_ = text_.substr(pos_, end + 1 - pos_);
+            token_data_.assign(text_.begin() + pos_ + 1, text_.begin() + end);
+            pos_ = end + 1;
+        } else if (c == '0' && pos_ + 1 < text_.size() &&
+                   (text_[pos_ + 1] == 'x' || text_[pos_ + 1] == 'X')) {
+            size_t end = pos_ + 2;
+            while (end < text_.size() && isxdigit(text_[end])) {
+                ++end;
+            }
+            token_ = STRING;
+            token_text_ = text_.substr(pos_, end - pos_);
+            string digits = text_.substr(pos_ + 2, end - pos_ - 2);
+            if (digits.empty()) {
+                error("empty hexadecimal literal");
+            }
+            if (digits.size() % 2 != 0) {
+                digits.insert(0, "0");
+            }
+            token_data_.clear();
+            util::encode::decodeHex(digits, token_data_);
+            pos_ = end;
+        } else if (isdigit(c)) {
+            size_t end = pos_;
+            while (end < text_.size() && isdigit(text_[end])) {
+                ++end;
+            }
+            token_ = NUMBER;
+            token_text_ = text_.substr(pos_, end - pos_);
+            pos_ = end;
+        } else if (isalpha(c)) {
+            size_t end = pos_;
+            while (end < text_.size() &&
+                   (isalnum(text_[end]) || text_[end] == '_')) {
+                ++end;
+            }
+            token_ = WORD;
+            token_text_ = text_.substr(pos_, end - pos_);
+            pos_ = end;
+        } else if ((c == '=' || c == '!') && pos_ + 1 < text_.size() &&
+                   text_[pos_ + 1] == '=') {
+            token_ = PUNCT;
+            token_text_ = text_.substr(pos_, 2);
+            pos_ += 2;
+        } else if (strchr("[](),.", c) != NULL) {
+            token_ = PUNCT;
+            token_text_ = string(1, c);
+            ++pos_;
+        } else {
+            error("unexpected character '" + string(1, c) + "'");
+        }
+    }
+
+    bool accept(const TokenType type, const char* text) {
+        if (token_ == type && token_text_ == text) {
+            nextToken();
+            return (true);
+        }
+        return (false);
+    }
+
+    void expect(const TokenType type, const char* text) {
+        if (!accept(type, text)) {
+            error(string("expected '") + text + "' but got '" + token_text_ +
+                  "'");
+        }
+    }
+
+    uint16_t parseNumber(const size_t max) {
+        if (token_ != NUMBER) {
+            error("expected a number but got '" + token_text_ + "'");
+        }
+        if (token_text_.size() > 5 ||
+            strtoul(token_text_.c_str(), NULL, 10) > max) {
+            error("number " + token_text_ + " out of range");
+        }
+        const uint16_t value = strtoul(token_text_.c_str(), NULL, 10);
+        nextToken();
+        return (value);
+    }
+
+    // Parses "[" code "]" "." and returns the option code.
+    uint16_t parseOptionCode() {
+        expect(PUNCT, "[");
+        if (token_ == NUMBER && strtoul(token_text_.c_str(), NULL, 10) == 0) {
+            error("option code 0 is not allowed");
+        }
+        const uint16_t code = parseNumber(max_code_);
+        expect(PUNCT, "]");
+        expect(PUNCT, ".");
+        return (code);
+    }
+
+    void parseOptionData(Operand& operand) {
+        operand.code_ = parseOptionCode();
+        if (!accept(WORD, "text") && !accept(WORD, "hex")) {
+            error("expected 'text' or 'hex' but got '" + token_text_ + "'");
+        }
+    }
+
+    // Parses the "string" in the grammar.
+    void parseOperand(Operand& operand) {
+        operand.is_option_ = false;
+        operand.start_ = 0;
+        operand.length_ = numeric_limits<uint16_t>::max();
+        if (token_ == STRING) {
+            operand.literal_ = token_data_;
+            nextToken();
+        } else if (accept(WORD, "option")) {
+            operand.is_option_ = true;
+            parseOptionData(operand);
+        } else if (accept(WORD, "substring")) {
+            operand.is_option_ = true;
+            expect(PUNCT, "(");
+            expect(WORD, "option");
+            parseOptionData(operand);
+            expect(PUNCT, ",");
+            operand.start_ = parseNumber(numeric_limits<uint16_t>::max());
+            expect(PUNCT, ",");
+            if (!accept(WORD, "all")) {
+                operand.length_ =
+                    parseNumber(numeric_limits<uint16_t>::max());
+            }
+            expect(PUNCT, ")");
+        } else {
+            error("unexpected '" + token_text_ + "'");
+        }
+    }
+
+    void parseCondition() {
+        if (accept(WORD, "option")) {
+            // Either "exists" or the left side of a comparison.
+            const uint16_t code = parseOptionCode();
+            if (accept(WORD, "exists")) {
+                emit(ClientClassExpr::Instruction::EXISTS, code);
+                return;
+            }
+            if (!accept(WORD, "text") && !accept(WORD, "hex")) {
+                error("expected 'exists', 'text' or 'hex' but got '" +
+                      token_text_ + "'");
+            }
+            Operand left;
+            left.is_option_ = true;
+            left.code_ = code;
+            left.start_ = 0;
+            left.length_ = numeric_limits<uint16_t>::max();
+            parseComparison(left);
+        } else {
+            Operand left;
+            parseOperand(left);
+            parseComparison(left);
+        }
+    }
+
+    void parseComparison(const Operand& left) {
+        bool negate = false;
+        if (accept(PUNCT, "!=")) {
+            negate = true;
+        } else {
+            expect(PUNCT, "==");
+        }
+        Operand right;
+        parseOperand(right);
+
+        if (left.is_option_ == right.is_option_) {
+            error(left.is_option_ ? "comparing two options is not supported" :
+                  "comparison doesn't refer to any option");
+        }
+        const Operand& option = left.is_option_ ? left : right;
+        const Operand& literal = left.is_option_ ? right : left;
+        const size_t size = emit(ClientClassExpr::Instruction::EQUAL,
+                                 option.code_);
+        ClientClassExpr::Instruction& ins = expr_.code_[size - 1];
+        ins.start_ = option.start_;
+        ins.length_ = option.length_;
+        ins.literal_ = expr_.literals_.size();
+        ins.literal_len_ = std::min(literal.literal_.size(),
+                                    static_cast<size_t>(
+                                        numeric_limits<uint16_t>::max()));
+        expr_.literals_.insert(expr_.literals_.end(),
+                               literal.literal_.begin(),
+                               literal.literal_.begin() + ins.literal_len_);
+        if (negate) {
+            emit(ClientClassExpr::Instruction::NOT);
+        }
+    }
+
+    void parseFactor() {
+        if (accept(WORD, "not")) {
+            parseFactor();
+            emit(ClientClassExpr::Instruction::NOT);
+        } else if (accept(PUNCT, "(")) {
+            parseExpr();
+            expect(PUNCT, ")");
+        } else {
+            parseCondition();
+        }
+    }
+
+    void parseTerm() {
+        parseFactor();
+        while (accept(WORD, "and")) {
+            const size_t jump =
+                emit(ClientClassExpr::Instruction::JUMP_IF_FALSE) - 1;
+            parseFactor();
+            expr_.code_[jump].arg_ = expr_.code_.size();
+        }
+    }
+
+    void parseExpr() {
+        parseTerm();
+        while (accept(WORD, "or")) {
+            const size_t jump =
+                emit(ClientClassExpr::Instruction::JUMP_IF_TRUE) - 1;
+            parseTerm();
+            expr_.code_[jump].arg_ = expr_.code_.size();
+        }
+    }
+
+    // Appends an instruction and returns the number of instructions.
+    size_t emit(const ClientClassExpr::Instruction::Opcode op,
+                const uint16_t arg = 0)
+    {
+        // The jump targets must fit in the argument.
+        if (expr_.code_.size() >= numeric_limits<uint16_t>::max()) {
+            error("expression too long");
+        }
+        ClientClassExpr::Instruction ins;
+        ins.op_ = op;
+        ins.arg_ = arg;
+        ins.start_ = 0;
+        ins.length_ = 0;
+        ins.literal_ = 0;
+        ins.literal_len_ = 0;
+        expr_.code_.push_back(ins);
+        return (expr_.code_.size());
+    }
+
+    ClientClassExpr& expr_;
+    const string& text_;
+    size_t pos_;
+    const size_t max_code_;
+
+    TokenType token_;
+    string token_text_;
+    vector<uint8_t> token_data_;
+    size_t token_pos_;
+};
+
+namespace {
+
+// Gives access to the options of a DHCPv4 packet.
+class Pkt4OptionAccessor {
+public:
+    Pkt4OptionAccessor(const Pkt4& pkt) : pkt_(pkt), buffer_(0) {}
+
+    bool getOptionData(const uint16_t code, const uint8_t** data,
+                       size_t* len) const
+    {
+        if (code > 255) {
+            return (false);
+        }
+        // Options which haven't been parsed are read from the packet.
+        if (pkt_.getPendingOptionData(code, data, len)) {
+            return (true);
+        }
+        const OptionPtr option = pkt_.getOption(code);
+        if (!option) {
+            return (false);
+        }
+        buffer_.clear();
+        option->pack(buffer_);
+        *data = static_cast<const uint8_t*>(buffer_.getData()) +
+            Option::OPTION4_HDR_LEN;
+        *len = buffer_.getLength() - Option::OPTION4_HDR_LEN;
+        return (true);
+    }
+
+private:
+    const Pkt4& pkt_;
+    mutable util::OutputBuffer buffer_;
+};
+
+// Gives access to the options of a DHCPv6 packet.
+class Pkt6OptionAccessor {
+public:
+    Pkt6OptionAccessor(const Pkt6& pkt) : pkt_(pkt), buffer_(0) {}
+
+    bool getOptionData(const uint16_t code, const uint8_t** data,
+                       size_t* len) const
+    {
+        const OptionCollection::const_iterator it = pkt_.options_.find(code);
+        if (it == pkt_.options_.end()) {
+            return (false);
+        }
+        buffer_.clear();
+        it->second->pack(buffer_);
+        *data = static_cast<const uint8_t*>(buffer_.getData()) +
+            Option::OPTION6_HDR_LEN;
+        *len = buffer_.getLength() - Option::OPTION6_HDR_LEN;
+        return (true);
+    }
+
+private:
+    const Pkt6& pkt_;
+    mutable util::OutputBuffer buffer_;
+};
+
+}
+
+ClientClassExpr::ClientClassExpr(const std::string& text,
+                                 const Option::Universe universe) :
+    text_(text)
+{
+    ClientClassExprCompiler(*this, universe).compile();
+}
+
+template <typename OptionAccessor>
+bool
+ClientClassExpr::run(const OptionAccessor& accessor) const {
+    bool value = false;
+    const size_t count = code_.size();
+    for (size_t pc = 0; pc < count; ) {
+        const Instruction& ins = code_[pc++];
+        switch (ins.op_) {
+        case Instruction::EXISTS: {
+            const uint8_t* data;
+            size_t len;
+            value = accessor.getOptionData(ins.arg_, &data, &len);
+            break;
+        }
+        case Instruction::EQUAL: {
+            const uint8_t* data = NULL;
+            size_t len = 0;
+            accessor.getOptionData(ins.arg_, &data, &len);
+            // Take the substring, which is empty if it starts beyond the
+            // option data.
+            if (ins.start_ < len) {
+                data += ins.start_;
+                len = std::min(len - ins.start_,
+                               static_cast<size_t>(ins.length_));
+            } else {
+                len = 0;
+            }
+            value = (len == ins.literal_len_) &&
+                (len == 0 ||
+                 memcmp(data, &literals_[ins.literal_], len) == 0);
+            break;
+        }
+        case Instruction::NOT:
+            value = !value;
+            break;
+        case Instruction::JUMP_IF_FALSE:
+            if (!value) {
+                pc = ins.arg_;
+            }
+            break;
+        case Instruction::JUMP_IF_TRUE:
+            if (value) {
+                pc = ins.arg_;
+            }
+            break;
+        }
+    }
+    return (value);
+}
+
+bool
+ClientClassExpr::evaluate(const Pkt4& pkt) const {
+    return (run(Pkt4OptionAccessor(pkt)));
+}
+
+bool
+ClientClassExpr::evaluate(const Pkt6& pkt) const {
+    return (run(Pkt6OptionAccessor(pkt)));
+}
+
+} // end of namespace bundy::dhcp
+} // end of namespace bundy
@@ -0,0 +1,198 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef CLIENT_CLASS_EXPR_H
+#define CLIENT_CLASS_EXPR_H
+
+#include <dhcp/classify.h>
+#include <dhcp/option.h>
+#include <exceptions/exceptions.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace bundy {
+namespace dhcp {
+
+class Pkt4;
+class Pkt6;
+
+/// @brief Exception thrown when a client class expression is invalid.
+class ClientClassExprError : public Exception {
+public:
+    ClientClassExprError(const char* file, size_t line, const char* what) :
+        bundy::Exception(file, line, what) { };
+};
+
+/// @brief Compiled client classification expression.
+///
+/// An expression tells whether a packet belongs to a client class. It is
+/// compiled, when the configuration is parsed, into a short sequence of
+/// instructions that is evaluated directly against the option data of the
+/// packet. For DHCPv4 packets unpacked lazily (see
+/// @ref Pkt4::setLazyUnpack) the options which haven't been parsed are read
+/// from the received data, so the classification doesn't parse any option.
+///
+/// The grammar of the expressions is:
+///
+/// @code
+/// expr       := term ( "or" term )*
+/// term       := factor ( "and" factor )*
+/// factor     := "not" factor | "(" expr ")" | condition
+/// condition  := "option" "[" code "]" "." "exists"
+///             | string ( "==" | "!=" ) string
+/// string     := "option" "[" code "]" "." ( "text" | "hex" )
+///             | "substring" "(" "option" "[" code "]" "." ( "text" | "hex" )
+///               "," start "," ( length | "all" ) ")"
+///             | "'" characters "'" | "0x" hex-digits
+/// @endcode
+///
+/// An option is referred by its code and its data doesn't include the
+/// option header. The data of an option which isn't in the packet is an
+/// empty string. If the packet has more options of the same code, the first
+/// one is used. "text" and "hex" are the same data, the names only tell how
+/// the operator thinks of it. At least one side of a comparison must refer
+/// to an option. "and" and "or" are evaluated with short circuit.
+///
+/// For example, the test for the DOCSIS 3.0 cable modems sending
+/// "docsis3.0" in the vendor class identifier option is:
+///
+/// @code
+/// substring(option[60].text, 0, 9) == 'docsis3.0'
+/// @endcode
+class ClientClassExpr {
+public:
+    /// @brief Compiles an expression.
+    ///
+    /// @param text the expression.
+    /// @param universe universe of the options the expression refers to.
+    /// Option codes are 1 to 254 for DHCPv4 and 1 to 65535 for DHCPv6.
+    /// @throw ClientClassExprError if the expression is invalid.
+    ClientClassExpr(const std::string& text, const Option::Universe universe);
+
+    /// @brief Evaluates the expression for a DHCPv4 packet.
+    ///
+    /// @param pkt the packet.
+    /// @return true if the packet belongs to the class.
+    bool evaluate(const Pkt4& pkt) const;
+
+    /// @brief Evaluates the expression for a DHCPv6 packet.
+    ///
+    /// Only the options of the client message are used, not the options
+    /// of the relays.
+    ///
+    /// @param pkt the packet.
+    /// @return true if the packet belongs to the class.
+    bool evaluate(const Pkt6& pkt) const;
+
+    /// @brief Returns the text of the expression.
+    const std::string& getText() const {
+        return (text_);
+    }
+
+    /// @brief Returns the number of instructions the expression has been
+    /// compiled to.
+    ///
+    /// Principally for testing.
+    size_t getInstructionCount() const {
+        return (code_.size());
+    }
+
+    /// @brief Instruction of a compiled expression.
+    ///
+    /// The instructions set and test a single boolean value, which is the
+    /// result of the expression after the last instruction.
+    struct Instruction {
+        /// @brief Operations of the instructions.
+        enum Opcode {
+            /// The value is whether the option @c arg_ is in the packet.
+            EXISTS,
+            /// The value is whether the data of the option @c arg_ from the
+            /// octet @c start_, at most @c length_ octets, equal the
+            /// literal.
+            EQUAL,
+            /// The value is negated.
+            NOT,
+            /// If the value is false, go to the instruction @c arg_.
+            JUMP_IF_FALSE,
+            /// If the value is true, go to the instruction @c arg_.
+            JUMP_IF_TRUE
+        };
+
+        /// Operation.
+        Opcode op_;
+        /// Option code or the index of the instruction to go to.
+        uint16_t arg_;
+        /// Offset of the data of the option to compare.
+        uint16_t start_;
+        /// Maximum length of the data of the option to compare.
+        uint16_t length_;
+        /// Offset of the literal to compare in @c literals_.
+        uint32_t literal_;
+        /// Length of the literal to compare.
+        uint16_t literal_len_;
+    };
+
+private:
+    /// @brief Evaluates the instructions using the given option accessor.
+    template <typename OptionAccessor>
+    bool run(const OptionAccessor& accessor) const;
+
+    /// Text of the expression.
+    std::string text_;
+
+    /// Compiled instructions.
+    std::vector<Instruction> code_;
+
+    /// Literals of the expression, concatenated.
+    std::vector<uint8_t> literals_;
+
+    // The compiler fills in the instructions and the literals.
+    friend class ClientClassExprCompiler;
+};
+
+/// @brief Pointer to a compiled client classification expression.
+typedef boost::shared_ptr<const ClientClassExpr> ClientClassExprPtr;
+
+/// @brief Client class defined in the configuration.
+///
+/// A packet belongs to the class if it passes the test expression.
+struct ClientClassDef {
+    /// @brief Constructor.
+    ///
+    /// @param name name of the class.
+    /// @param test compiled test expression.
+    ClientClassDef(const ClientClass& name, const ClientClassExprPtr& test) :
+        name_(name), test_(test)
+    {}
+
+    /// Name of the class.
+    ClientClass name_;
+
+    /// Test expression of the class.
+    ClientClassExprPtr test_;
+};
+
+/// @brief List of the client classes defined in the configuration.
+///
+/// The classes are evaluated in the order they were configured.
+typedef std::vector<ClientClassDef> ClientClassDefList;
+
+} // end of namespace bundy::dhcp
+} // end of namespace bundy
+
+#endif // CLIENT_CLASS_EXPR_H
@@ -27,21 +27,7 @@ CSVLeaseFile4::CSVLeaseFile4(const std::string& filename)
 
 void
 CSVLeaseFile4::append(const Lease4& lease) const {
-    CSVRow row(getColumnCount());
-    row.writeAt(getColumnIndex("address"), lease.addr_.toText());
-    HWAddr hwaddr(lease.hwaddr_, HTYPE_ETHER);
-    row.writeAt(getColumnIndex("hwaddr"), hwaddr.toText(false));
-    // Client id may be unset (NULL).
-    if (lease.client_id_) {
-        row.writeAt(getColumnIndex("client_id"), lease.client_id_->toText());
-    }
-    row.writeAt(getColumnIndex("valid_lifetime"), lease.valid_lft_);
-    row.writeAt(getColumnIndex("expire"), lease.cltt_ + lease.valid_lft_);
-    row.writeAt(getColumnIndex("subnet_id"), lease.subnet_id_);
-    row.writeAt(getColumnIndex("fqdn_fwd"), lease.fqdn_fwd_);
-    row.writeAt(getColumnIndex("fqdn_rev"), lease.fqdn_rev_);
-    row.writeAt(getColumnIndex("hostname"), lease.hostname_);
-    CSVFile::append(row);
+    CSVFile::append(createRow(lease));
 }
 
 bool
@@ -51,39 +37,16 @@ CSVLeaseFile4::next(Lease4Ptr& lease) {
     // to throw exceptions, so we catch them all and rather return the
     // false value.
     try {
-        // Get the row of CSV values.
-        CSVRow row;
+        // Get the row of CSV values. The row object is reused for all rows,
+        // so as the storage for the values is not allocated for each lease.
+        CSVRow& row = row_;
         CSVFile::next(row);
         // The empty row signals EOF.
         if (row == CSVFile::EMPTY_ROW()) {
             lease.reset();
             return (true);
         }
-
-        // Get client id. It is possible that the client id is empty and the
-        // returned pointer is NULL. This is ok, but if the client id is NULL,
-        // we need to be careful to not use the NULL pointer.
-        ClientIdPtr client_id = readClientId(row);
-        std::vector<uint8_t> client_id_vec;
-        if (client_id) {
-            client_id_vec = client_id->getClientId();
-        }
-        size_t client_id_len = client_id_vec.size();
-
-        // Get the HW address. It should never be empty and the readHWAddr checks
-        // that.
-        HWAddr hwaddr = readHWAddr(row);
-        lease.reset(new Lease4(readAddress(row),
-                               &hwaddr.hwaddr_[0], hwaddr.hwaddr_.size(),
-                               client_id_vec.empty() ? NULL : &client_id_vec[0],
-                               client_id_len,
-                               readValid(row),
-                               0, 0, // t1, t2 = 0
-                               readCltt(row),
-                               readSubnetID(row),
-                               readFqdnFwd(row),
-                               readFqdnRev(row),
-                               readHostname(row)));
+        lease = parseRow(row);
 
     } catch (std::exception& ex) {
         // The lease might have been created, so let's set it back to NULL to
@@ -95,6 +58,54 @@ CSVLeaseFile4::next(Lease4Ptr& lease) {
     return (true);
 }
 
+CSVRow
+CSVLeaseFile4::createRow(const Lease4& lease) const {
+    CSVRow row(getColumnCount());
+    row.writeAt(getColumnIndex("address"), lease.addr_.toText());
+    HWAddr hwaddr(lease.hwaddr_, HTYPE_ETHER);
+    row.writeAt(getColumnIndex("hwaddr"), hwaddr.toText(false));
+    // Client id may be unset (NULL).
+    if (lease.client_id_) {
+        row.writeAt(getColumnIndex("client_id"), lease.client_id_->toText());
+    }
+    row.writeAt(getColumnIndex("valid_lifetime"), lease.valid_lft_);
+    row.writeAt(getColumnIndex("expire"), lease.cltt_ + lease.valid_lft_);
+    row.writeAt(getColumnIndex("subnet_id"), lease.subnet_id_);
+    row.writeAt(getColumnIndex("fqdn_fwd"), lease.fqdn_fwd_);
+    row.writeAt(getColumnIndex("fqdn_rev"), lease.fqdn_rev_);
+    row.writeAt(getColumnIndex("hostname"), lease.hostname_);
+    return (row);
+}
+
+Lease4Ptr
+CSVLeaseFile4::parseRow(const CSVRow& row) {
+    // Get client id. It is possible that the client id is empty and the
+    // returned pointer is NULL. This is ok, but if the client id is NULL,
+    // we need to be careful to not use the NULL pointer.
+    ClientIdPtr client_id = readClientId(row);
+    std::vector<uint8_t> client_id_vec;
+    if (client_id) {
+        client_id_vec = client_id->getClientId();
+    }
+    size_t client_id_len = client_id_vec.size();
+
+    // Get the HW address. It should never be empty and the readHWAddr checks
+    // that.
+    HWAddr hwaddr = readHWAddr(row);
+    return (Lease4Ptr(new Lease4(readAddress(row),
+                                 &hwaddr.hwaddr_[0], hwaddr.hwaddr_.size(),
+                                 client_id_vec.empty() ? NULL :
+                                 &client_id_vec[0],
+                                 client_id_len,
+                                 readValid(row),
+                                 0, 0, // t1, t2 = 0
+                                 readCltt(row),
+                                 readSubnetID(row),
+                                 readFqdnFwd(row),
+                                 readFqdnRev(row),
+                                 readHostname(row))));
+}
+
 void
 CSVLeaseFile4::initColumns() {
     addColumn("address");
@@ -27,21 +27,7 @@ CSVLeaseFile6::CSVLeaseFile6(const std::string& filename)
 
 void
 CSVLeaseFile6::append(const Lease6& lease) const {
-    CSVRow row(getColumnCount());
-    row.writeAt(getColumnIndex("address"), lease.addr_.toText());
-    row.writeAt(getColumnIndex("duid"), lease.duid_->toText());
-    row.writeAt(getColumnIndex("valid_lifetime"), lease.valid_lft_);
-    row.writeAt(getColumnIndex("expire"), lease.cltt_ + lease.valid_lft_);
-    row.writeAt(getColumnIndex("subnet_id"), lease.subnet_id_);
-    row.writeAt(getColumnIndex("pref_lifetime"), lease.preferred_lft_);
-    row.writeAt(getColumnIndex("lease_type"), lease.type_);
-    row.writeAt(getColumnIndex("iaid"), lease.iaid_);
-    row.writeAt(getColumnIndex("prefix_len"),
-                static_cast<int>(lease.prefixlen_));
-    row.writeAt(getColumnIndex("fqdn_fwd"), lease.fqdn_fwd_);
-    row.writeAt(getColumnIndex("fqdn_rev"), lease.fqdn_rev_);
-    row.writeAt(getColumnIndex("hostname"), lease.hostname_);
-    CSVFile::append(row);
+    CSVFile::append(createRow(lease));
 }
 
 bool
@@ -51,24 +37,16 @@ CSVLeaseFile6::next(Lease6Ptr& lease) {
     // to throw exceptions, so we catch them all and rather return the
     // false value.
     try {
-        // Get the row of CSV values.
-        CSVRow row;
+        // Get the row of CSV values. The row object is reused for all rows,
+        // so as the storage for the values is not allocated for each lease.
+        CSVRow& row = row_;
         CSVFile::next(row);
         // The empty row signals EOF.
         if (row == CSVFile::EMPTY_ROW()) {
             lease.reset();
             return (true);
         }
-
-        lease.reset(new Lease6(readType(row), readAddress(row), readDUID(row),
-                               readIAID(row), readPreferred(row),
-                               readValid(row), 0, 0, // t1, t2 = 0
-                               readSubnetID(row),
-                               readPrefixLen(row)));
-        lease->cltt_ = readCltt(row);
-        lease->fqdn_fwd_ = readFqdnFwd(row);
-        lease->fqdn_rev_ = readFqdnRev(row);
-        lease->hostname_ = readHostname(row);
+        lease = parseRow(row);
 
     } catch (std::exception& ex) {
         // The lease might have been created, so let's set it back to NULL to
@@ -80,6 +58,39 @@ CSVLeaseFile6::next(Lease6Ptr& lease) {
     return (true);
 }
 
+CSVRow
+CSVLeaseFile6::createRow(const Lease6& lease) const {
+    CSVRow row(getColumnCount());
+    row.writeAt(getColumnIndex("address"), lease.addr_.toText());
+    row.writeAt(getColumnIndex("duid"), lease.duid_->toText());
+    row.writeAt(getColumnIndex("valid_lifetime"), lease.valid_lft_);
+    row.writeAt(getColumnIndex("expire"), lease.cltt_ + lease.valid_lft_);
+    row.writeAt(getColumnIndex("subnet_id"), lease.subnet_id_);
+    row.writeAt(getColumnIndex("pref_lifetime"), lease.preferred_lft_);
+    row.writeAt(getColumnIndex("lease_type"), lease.type_);
+    row.writeAt(getColumnIndex("iaid"), lease.iaid_);
+    row.writeAt(getColumnIndex("prefix_len"),
+                static_cast<int>(lease.prefixlen_));
+    row.writeAt(getColumnIndex("fqdn_fwd"), lease.fqdn_fwd_);
+    row.writeAt(getColumnIndex("fqdn_rev"), lease.fqdn_rev_);
+    row.writeAt(getColumnIndex("hostname"), lease.hostname_);
+    return (row);
+}
+
+Lease6Ptr
+CSVLeaseFile6::parseRow(const CSVRow& row) {
+    Lease6Ptr lease(new Lease6(readType(row), readAddress(row), readDUID(row),
+                               readIAID(row), readPreferred(row),
+                               readValid(row), 0, 0, // t1, t2 = 0
+                               readSubnetID(row),
+                               readPrefixLen(row)));
+    lease->cltt_ = readCltt(row);
+    lease->fqdn_fwd_ = readFqdnFwd(row);
+    lease->fqdn_rev_ = readFqdnRev(row);
+    lease->hostname_ = readHostname(row);
+    return (lease);
+}
+
 void
 CSVLeaseFile6::initColumns() {
     addColumn("address");
@@ -77,6 +77,26 @@ public:
     /// ticket http://bundy.bundy.org/ticket/2405 is implemented.
     bool next(Lease6Ptr& lease);
 
+    /// @brief Creates the lease record.
+    ///
+    /// The record is the row which @c append writes to the file.
+    ///
+    /// @param lease Structure representing a DHCPv6 lease.
+    ///
+    /// @return Row holding the values of the lease.
+    util::CSVRow createRow(const Lease6& lease) const;
+
+    /// @brief Creates a lease from its record.
+    ///
+    /// @param row Row holding the values of the lease, as returned by
+    /// @c createRow.
+    ///
+    /// @return Pointer to the lease.
+    ///
+    /// @throw bundy::Exception or derived class if the row holds invalid
+    /// values.
+    Lease6Ptr parseRow(const util::CSVRow& row);
+
 private:
 
     /// @brief Initializes columns of the CSV file holding leases.
@@ -162,6 +182,9 @@ private:
     std::string readHostname(const util::CSVRow& row);
     //@}
 
+    /// @brief Holds the values of the row being read by @c next.
+    util::CSVRow row_;
+
 };
 
 } // namespace bundy::dhcp
@@ -75,6 +75,7 @@ D2ClientMgr::setD2ClientConfig(D2ClientConfigPtr& new_config) {
                 bundy::asiolink::IOAddress any_addr("0.0.0.0");
                 uint32_t any_port = 0;
                 uint32_t queue_max = 1024;
+                size_t max_batch = 32;
 
                 // Instantiate a new sender.
                 new_sender.reset(new dhcp_ddns::NameChangeUDPSender(
@@ -83,6 +84,14 @@ D2ClientMgr::setD2ClientConfig(D2ClientConfigPtr& new_config) {
                                                 new_config->getServerPort(),
                                                 new_config->getNcrFormat(),
                                                 *this, queue_max));
+
+                // A listener which reads the binary format also reads
+                // packets carrying several requests, so let the requests
+                // which pile up while a packet is sent go in the next one.
+                if (new_config->getNcrFormat() == dhcp_ddns::FMT_BINARY) {
+                    boost::static_pointer_cast<dhcp_ddns::NameChangeUDPSender>
+                        (new_sender)->setMaxBatchSize(max_batch);
+                }
                 break;
                 }
             default:
@@ -18,6 +18,7 @@
 #include <dhcpsrv/lease_mgr_factory.h>
 
 #include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
 
 #include <map>
 #include <string>
@@ -57,14 +58,29 @@ DbAccessParser::build(bundy::data::ConstElementPtr config_value) {
 
     // 3. Update the copy with the passed keywords.
     BOOST_FOREACH(ConfigPair param, config_value->mapValue()) {
-        // The persist parameter is the only boolean parameter at the
-        // moment. It needs special handling.
-        if (param.first != "persist") {
-            values_copy[param.first] = param.second->stringValue();
-
-        } else {
+        // The persist parameter is the only boolean parameter and the
+        // group-commit, cache-size, lfc-threshold, shards and the lease
+        // stream port parameters the only integer parameters at the moment.
+        // They need special handling.
+        if (param.first == "persist") {
             values_copy[param.first] = (param.second->boolValue() ?
                                         "true" : "false");
+
+        } else if ((param.first == "group-commit") ||
+                   (param.first == "cache-size") ||
+                   (param.first == "lfc-threshold") ||
+                   (param.first == "shards") ||
+                   (param.first == "standby-port") ||
+                   (param.first == "listen-port")) {
+            const int64_t value = param.second->intValue();
+            if (value < 0) {
+                bundy_throw(BadValue, param.first << " must not be negative: "
+                            << value);
+            }
+            values_copy[param.first] = boost::lexical_cast<std::string>(value);
+
+        } else {
+            values_copy[param.first] = param.second->stringValue();
         }
     }
 
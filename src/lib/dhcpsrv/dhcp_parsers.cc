@@ -25,6 +25,7 @@
 #include <boost/lexical_cast.hpp>
 
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -312,6 +313,50 @@ HooksLibrariesParser::getLibraries(std::vector<std::string>& libraries,
     changed = changed_;
 }
 
+// ************************ ClientClassDefListParser *************************
+ClientClassDefListParser::ClientClassDefListParser(const std::string&,
+                                                   const Option::Universe
+                                                   universe)
+    : universe_(universe)
+{
+}
+
+void
+ClientClassDefListParser::build(ConstElementPtr value) {
+    defs_.clear();
+    std::set<ClientClass> names;
+
+    BOOST_FOREACH(ConstElementPtr class_def, value->listValue()) {
+        ConstElementPtr name = class_def->get("name");
+        ConstElementPtr test = class_def->get("test");
+        if (!name || name->getType() != Element::string ||
+            name->stringValue().empty()) {
+            bundy_throw(DhcpConfigError, "client class must have a name");
+        }
+        if (!test || test->getType() != Element::string) {
+            bundy_throw(DhcpConfigError, "client class '"
+                        << name->stringValue() << "' must have a test");
+        }
+        if (!names.insert(name->stringValue()).second) {
+            bundy_throw(DhcpConfigError, "duplicate client class '"
+                        << name->stringValue() << "'");
+        }
+        try {
+            ClientClassExprPtr expr(new ClientClassExpr(test->stringValue(),
+                                                        universe_));
+            defs_.push_back(ClientClassDef(name->stringValue(), expr));
+        } catch (const ClientClassExprError& ex) {
+            bundy_throw(DhcpConfigError, "client class '"
+                        << name->stringValue() << "': " << ex.what());
+        }
+    }
+}
+
+void
+ClientClassDefListParser::commit() {
+    CfgMgr::instance().setClientClassDefs(defs_);
+}
+
 // **************************** OptionDataParser *************************
 OptionDataParser::OptionDataParser(const std::string&, OptionStoragePtr options,
                                   ParserContextPtr global_context)
@@ -872,6 +917,115 @@ RelayInfoParser::commit() {
     *storage_ = local_;
 }
 
+//************************* HostReservationsListParser **********************
+HostReservationsListParser::HostReservationsListParser(const std::string&,
+                                                       const SubnetPtr& subnet,
+                                                       const CfgHostsPtr& hosts,
+                                                       const Option::Universe
+                                                       family)
+    : subnet_(subnet), hosts_(hosts), family_(family) {
+    if (!subnet_ || !hosts_) {
+        bundy_throw(bundy::dhcp::DhcpConfigError, "parser logic error:"
+                  << "subnet and host storage may not be NULL");
+    }
+}
+
+void
+HostReservationsListParser::build(ConstElementPtr hosts_list) {
+    const std::vector<ConstElementPtr>& hosts = hosts_list->listValue();
+    hosts_->reserve(hosts_->size() + hosts.size());
+    BOOST_FOREACH(ConstElementPtr host_config, hosts) {
+        HostPtr host = parseHost(host_config);
+        try {
+            hosts_->add(host);
+        } catch (const DuplicateHost& ex) {
+            bundy_throw(DhcpConfigError, ex.what());
+        }
+    }
+}
+
+HostPtr
+HostReservationsListParser::parseHost(ConstElementPtr host_config) const {
+    std::string identifier;
+    std::string identifier_name;
+    asiolink::IOAddress ipv4_reservation("0.0.0.0");
+    std::vector<asiolink::IOAddress> ipv6_reservations;
+    std::string hostname;
+
+    BOOST_FOREACH(ConfigPair param, host_config->mapValue()) {
+        if (param.first == "hw-address" ||
+            (param.first == "client-id" && family_ == Option::V4) ||
+            (param.first == "duid" && family_ == Option::V6)) {
+            if (param.second->stringValue().empty()) {
+                continue;
+            }
+            if (!identifier_name.empty()) {
+                bundy_throw(DhcpConfigError, "host reservation must have "
+                            "only one of " << identifier_name << " and "
+                            << param.first);
+            }
+            identifier = param.second->stringValue();
+            identifier_name = param.first;
+
+        } else if (param.first == "ip-address" && family_ == Option::V4) {
+            if (!param.second->stringValue().empty()) {
+                ipv4_reservation = parseAddress(param.second);
+            }
+
+        } else if (param.first == "ip-addresses" && family_ == Option::V6) {
+            BOOST_FOREACH(ConstElementPtr address, param.second->listValue()) {
+                ipv6_reservations.push_back(parseAddress(address));
+            }
+
+        } else if (param.first == "hostname") {
+            hostname = param.second->stringValue();
+
+        } else {
+            bundy_throw(DhcpConfigError, "unsupported host reservation "
+                        "parameter " << param.first);
+        }
+    }
+
+    if (identifier_name.empty()) {
+        bundy_throw(DhcpConfigError, "host reservation must have "
+                    << (family_ == Option::V4 ? "hw-address or client-id" :
+                        "duid or hw-address"));
+    }
+
+    try {
+        HostPtr host(new Host(identifier, identifier_name, subnet_->getID(),
+                              ipv4_reservation, hostname));
+        for (size_t i = 0; i < ipv6_reservations.size(); ++i) {
+            host->addIPv6Reservation(ipv6_reservations[i]);
+        }
+        return (host);
+    } catch (const BadValue& ex) {
+        bundy_throw(DhcpConfigError, ex.what());
+    }
+}
+
+asiolink::IOAddress
+HostReservationsListParser::parseAddress(ConstElementPtr address_config)
+    const {
+    const std::string& text = address_config->stringValue();
+    boost::scoped_ptr<asiolink::IOAddress> address;
+    try {
+        address.reset(new asiolink::IOAddress(text));
+    } catch (...) {
+        bundy_throw(DhcpConfigError, "failed to parse reserved address "
+                    << text);
+    }
+    if (!subnet_->inRange(*address)) {
+        bundy_throw(DhcpConfigError, "reserved address " << text
+                    << " is not in the subnet " << subnet_->toText());
+    }
+    return (*address);
+}
+
+void
+HostReservationsListParser::commit() {
+}
+
 //****************************** PoolParser ********************************
 PoolParser::PoolParser(const std::string&,  PoolStoragePtr pools)
         :pools_(pools) {
@@ -972,6 +1126,12 @@ SubnetConfigParser::SubnetConfigParser(const std::string&,
 void
 SubnetConfigParser::build(ConstElementPtr subnet) {
     BOOST_FOREACH(ConfigPair param, subnet->mapValue()) {
+        // The reservations refer to the subnet ID, which is only known
+        // when the subnet is created, so the subnets list parser parses
+        // them (see HostReservationsListParser).
+        if (param.first == "reservations") {
+            continue;
+        }
         ParserPtr parser(createSubnetConfigParser(param.first));
         parser->build(param.second);
         parsers_.push_back(parser);
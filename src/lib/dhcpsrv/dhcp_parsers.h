@@ -18,6 +18,8 @@
 #include <asiolink/io_address.h>
 #include <cc/data.h>
 #include <dhcp/option_definition.h>
+#include <dhcpsrv/cfg_hosts.h>
+#include <dhcpsrv/client_class_expr.h>
 #include <dhcpsrv/d2_client_cfg.h>
 #include <dhcpsrv/dhcp_config_parser.h>
 #include <dhcpsrv/option_space_container.h>
@@ -27,6 +29,8 @@
 #include <boost/shared_ptr.hpp>
 
 #include <stdint.h>
+#include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -445,6 +449,42 @@ private:
     bool changed_;
 };
 
+/// @brief Parser for the list of client classes.
+///
+/// This parser handles the list of client classes defined by test
+/// expressions. Each of them is a map with the "name" of the class and the
+/// "test" expression, which is compiled (see @ref ClientClassExpr) when the
+/// list is built, so that invalid expressions are rejected with the rest
+/// of the configuration.
+class ClientClassDefListParser : public DhcpConfigParser {
+public:
+
+    /// @brief Constructor
+    ///
+    /// @param param_name name of the configuration parameter being parsed.
+    /// @param universe universe of the options the expressions refer to.
+    ClientClassDefListParser(const std::string& param_name,
+                             const Option::Universe universe);
+
+    /// @brief Parses and compiles the list of client classes.
+    ///
+    /// @param value pointer to the content of parsed values
+    /// @throw DhcpConfigError if a class is malformed, its name is used more
+    /// than once or its test expression is invalid.
+    virtual void build(bundy::data::ConstElementPtr value);
+
+    /// @brief Replaces the client classes in the configuration manager
+    /// with the parsed ones.
+    virtual void commit();
+
+private:
+    /// Universe of the options the expressions refer to.
+    const Option::Universe universe_;
+
+    /// Parsed classes.
+    ClientClassDefList defs_;
+};
+
 /// @brief Parser for option data value.
 ///
 /// This parser parses configuration entries that specify value of
@@ -829,6 +869,68 @@ protected:
     Option::Universe family_;
 };
 
+/// @brief Parser for the host reservations of a subnet.
+///
+/// This parser handles the "reservations" list of a subnet. Each of its
+/// entries is a map with exactly one identifier of the host: "hw-address"
+/// or "client-id" for IPv4, "hw-address" or "duid" for IPv6. The reserved
+/// addresses are given by "ip-address" for IPv4 and by the "ip-addresses"
+/// list for IPv6, and "hostname" may be specified. Empty strings are
+/// treated as not specified.
+///
+/// The hosts are added to the reservations given to the constructor when
+/// the list is built, so that duplicates are detected across the subnets.
+/// These reservations are expected to be a new object, which replaces the
+/// reservations of the configuration manager when the whole configuration
+/// is committed.
+class HostReservationsListParser : public DhcpConfigParser {
+public:
+
+    /// @brief Constructor
+    ///
+    /// @param param_name name of the configuration parameter being parsed.
+    /// @param subnet subnet the hosts belong to.
+    /// @param hosts reservations the hosts are added to.
+    /// @param family protocol family of the subnet.
+    HostReservationsListParser(const std::string& param_name,
+                               const SubnetPtr& subnet,
+                               const CfgHostsPtr& hosts,
+                               const Option::Universe family);
+
+    /// @brief Parses the list of the hosts and adds them to the reservations.
+    ///
+    /// @param value pointer to the content of parsed values
+    /// @throw DhcpConfigError if a host is malformed, its address is not in
+    /// the subnet, or it duplicates another host or reserved address.
+    virtual void build(bundy::data::ConstElementPtr value);
+
+    /// @brief Does nothing, as the hosts have been added by @c build.
+    virtual void commit();
+
+private:
+    /// @brief Parses a single host.
+    ///
+    /// @param host_config the host entry.
+    /// @return the host.
+    HostPtr parseHost(bundy::data::ConstElementPtr host_config) const;
+
+    /// @brief Parses an address and checks that it is in the subnet.
+    ///
+    /// @param address_config the address element.
+    /// @return the address.
+    bundy::asiolink::IOAddress
+    parseAddress(bundy::data::ConstElementPtr address_config) const;
+
+    /// Subnet the hosts belong to.
+    SubnetPtr subnet_;
+
+    /// Reservations the hosts are added to.
+    CfgHostsPtr hosts_;
+
+    /// Protocol family (IPv4 or IPv6)
+    Option::Universe family_;
+};
+
 /// @brief this class parses a single subnet
 ///
 /// This class parses the whole subnet definition. It creates parsers
@@ -959,6 +1061,213 @@ protected:
     bundy::dhcp::Subnet::RelayInfoPtr relay_info_;
 };
 
+/// @brief Keeps the subnets built from the last committed configuration.
+///
+/// When a single subnet changes, the server still receives the whole list
+/// of subnets. This class lets the subnets list parsers reuse the subnet
+/// objects whose configuration (compared structurally with
+/// @c bundy::data::Element::equals) didn't change, so only the changed
+/// subnets are parsed again, and the configuration manager gets the
+/// reused objects back with their state.
+///
+/// Subnets inherit global parameters (like timers and options), so the
+/// cached subnets are only reused when all other global parameters are
+/// the same as in the configuration they were built from. Subnets bound
+/// to an interface are always built again, as the interface is checked
+/// against the system when the subnet is built.
+///
+/// @tparam SubnetType Subnet4 or Subnet6.
+template <typename SubnetType>
+class SubnetConfigCache {
+public:
+    /// @brief Pointer to the type of the cached subnets.
+    typedef boost::shared_ptr<SubnetType> SubnetTypePtr;
+
+    /// @brief Constructor.
+    ///
+    /// @param subnets_name name of the global parameter holding the list
+    /// of subnets ("subnet4" or "subnet6").
+    SubnetConfigCache(const std::string& subnets_name) :
+        subnets_name_(subnets_name), next_id_(1) {
+    }
+
+    /// @brief Starts building the subnets of a new configuration.
+    ///
+    /// The cached subnets which are no longer used by the configuration
+    /// manager are dropped, and all of them are dropped if any global
+    /// parameter other than the subnets list changed.
+    ///
+    /// @param config the whole new configuration.
+    /// @param current the subnets currently in the configuration manager.
+    void startConfig(bundy::data::ConstElementPtr config,
+                     const std::vector<SubnetTypePtr>& current) {
+        pending_.clear();
+        pending_config_ = config;
+        next_id_ = 1;
+
+        if (!sameGlobals(config, config_)) {
+            subnets_.clear();
+            return;
+        }
+        const std::set<SubnetTypePtr> current_set(current.begin(),
+                                                  current.end());
+        for (typename SubnetMap::iterator it = subnets_.begin();
+             it != subnets_.end();) {
+            if (current_set.count(it->second.second) == 0) {
+                subnets_.erase(it++);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    /// @brief Returns the subnet to reuse for a subnet configuration.
+    ///
+    /// This must be called for each subnet of the new configuration in
+    /// order, before it is built (if it is not reused). A subnet without
+    /// an explicit ID is only reused if it has the ID which building it
+    /// would have given it. If there is nothing to reuse, the subnet ID
+    /// counter is set so the subnet gets the same ID as if none of the
+    /// previous subnets had been reused.
+    ///
+    /// @param subnet_config the configuration of the subnet.
+    /// @return the subnet built from the same configuration, or NULL if it
+    /// has to be built.
+    SubnetTypePtr reuseSubnet(bundy::data::ConstElementPtr subnet_config) {
+        SubnetTypePtr subnet;
+        bool auto_id = true;
+        if (subnet_config->getType() == bundy::data::Element::map) {
+            const bundy::data::ConstElementPtr id = subnet_config->get("id");
+            int64_t id_value = 0;
+            auto_id = !id || !id->getValue(id_value) || id_value == 0;
+            subnet = find(subnet_config);
+        }
+        if (subnet && auto_id && subnet->getID() != next_id_) {
+            subnet.reset();
+        }
+        if (!subnet) {
+            Subnet::resetSubnetID(next_id_);
+        }
+        if (auto_id) {
+            ++next_id_;
+        }
+        return (subnet);
+    }
+
+    /// @brief Records the subnet built (or reused) for a subnet
+    /// configuration of the new configuration.
+    ///
+    /// @param subnet_config the configuration of the subnet.
+    /// @param subnet the subnet.
+    void addSubnet(bundy::data::ConstElementPtr subnet_config,
+                   const SubnetTypePtr& subnet) {
+        std::string prefix;
+        if (getPrefix(subnet_config, prefix)) {
+            pending_.insert(std::make_pair(prefix,
+                                           std::make_pair(subnet_config,
+                                                          subnet)));
+        }
+    }
+
+    /// @brief Makes the subnets of the new configuration the cached ones.
+    ///
+    /// This should be called when they are committed to the configuration
+    /// manager.
+    void commit() {
+        subnets_.swap(pending_);
+        pending_.clear();
+        config_ = pending_config_;
+    }
+
+    /// @brief Drops all the cached subnets.
+    void clear() {
+        subnets_.clear();
+        pending_.clear();
+        config_.reset();
+    }
+
+private:
+    /// @brief Subnets by their prefix, with their configuration.
+    typedef std::multimap<std::string,
+                          std::pair<bundy::data::ConstElementPtr,
+                                    SubnetTypePtr> > SubnetMap;
+
+    /// @brief Returns the prefix of a subnet configuration, if it can be
+    /// reused.
+    static bool getPrefix(bundy::data::ConstElementPtr subnet_config,
+                          std::string& prefix) {
+        if (subnet_config->getType() != bundy::data::Element::map ||
+            subnet_config->contains("interface")) {
+            return (false);
+        }
+        const bundy::data::ConstElementPtr subnet =
+            subnet_config->get("subnet");
+        return (subnet && subnet->getValue(prefix));
+    }
+
+    /// @brief Returns the cached subnet with the same configuration.
+    SubnetTypePtr find(bundy::data::ConstElementPtr subnet_config) const {
+        std::string prefix;
+        if (getPrefix(subnet_config, prefix)) {
+            const std::pair<typename SubnetMap::const_iterator,
+                            typename SubnetMap::const_iterator>
+                range = subnets_.equal_range(prefix);
+            for (typename SubnetMap::const_iterator it = range.first;
+                 it != range.second; ++it) {
+                if (it->second.first->equals(*subnet_config)) {
+                    return (it->second.second);
+                }
+            }
+        }
+        return (SubnetTypePtr());
+    }
+
+    /// @brief Checks whether two configurations are the same except for
+    /// their subnets.
+    bool sameGlobals(bundy::data::ConstElementPtr config1,
+                     bundy::data::ConstElementPtr config2) const {
+        if (!config1 || !config2 ||
+            config1->getType() != bundy::data::Element::map ||
+            config2->getType() != bundy::data::Element::map) {
+            return (false);
+        }
+        std::map<std::string, bundy::data::ConstElementPtr>
+            globals1(config1->mapValue()), globals2(config2->mapValue());
+        globals1.erase(subnets_name_);
+        globals2.erase(subnets_name_);
+        if (globals1.size() != globals2.size()) {
+            return (false);
+        }
+        for (std::map<std::string, bundy::data::ConstElementPtr>::
+                 const_iterator it1 = globals1.begin(), it2 = globals2.begin();
+             it1 != globals1.end(); ++it1, ++it2) {
+            if (it1->first != it2->first ||
+                !it1->second->equals(*it2->second)) {
+                return (false);
+            }
+        }
+        return (true);
+    }
+
+    /// @brief Name of the global parameter holding the subnets.
+    const std::string subnets_name_;
+
+    /// @brief Configuration the cached subnets were built from.
+    bundy::data::ConstElementPtr config_;
+
+    /// @brief Cached subnets.
+    SubnetMap subnets_;
+
+    /// @brief Configuration being built.
+    bundy::data::ConstElementPtr pending_config_;
+
+    /// @brief Subnets of the configuration being built.
+    SubnetMap pending_;
+
+    /// @brief ID of the next subnet without an explicit ID.
+    SubnetID next_id_;
+};
+
 /// @brief Parser for  D2ClientConfig
 ///
 /// This class parses the configuration element "dhcp-ddns" common to the
@@ -0,0 +1,125 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <dhcpsrv/host.h>
+#include <exceptions/exceptions.h>
+
+#include <sstream>
+
+using namespace bundy::asiolink;
+
+namespace bundy {
+namespace dhcp {
+
+Host::Host(const uint8_t* identifier, const size_t identifier_len,
+           const IdentifierType identifier_type, const SubnetID subnet_id,
+           const IOAddress& ipv4_reservation, const std::string& hostname)
+    : identifier_type_(identifier_type), subnet_id_(subnet_id),
+      ipv4_reservation_(ipv4_reservation), hostname_(hostname) {
+    setIdentifier(identifier, identifier_len, identifier_type);
+    if (!ipv4_reservation_.isV4()) {
+        bundy_throw(BadValue, "reserved address " << ipv4_reservation_
+                    << " is not an IPv4 address");
+    }
+}
+
+Host::Host(const std::string& identifier, const std::string& identifier_name,
+           const SubnetID subnet_id, const IOAddress& ipv4_reservation,
+           const std::string& hostname)
+    : identifier_type_(IDENT_HWADDR), subnet_id_(subnet_id),
+      ipv4_reservation_(ipv4_reservation), hostname_(hostname) {
+    // Let the classes of the identifiers decode (and check) them.
+    std::vector<uint8_t> binary;
+    try {
+        if (identifier_name == "hw-address") {
+            binary = HWAddr::fromText(identifier).hwaddr_;
+            identifier_type_ = IDENT_HWADDR;
+        } else if (identifier_name == "duid") {
+            binary = DUID::fromText(identifier).getDuid();
+            identifier_type_ = IDENT_DUID;
+        } else if (identifier_name == "client-id") {
+            binary = ClientId::fromText(identifier)->getClientId();
+            identifier_type_ = IDENT_CLIENT_ID;
+        } else {
+            bundy_throw(BadValue, "invalid host identifier type '"
+                        << identifier_name << "'");
+        }
+    } catch (const BadValue&) {
+        throw;
+    } catch (const bundy::Exception& ex) {
+        bundy_throw(BadValue, "invalid " << identifier_name << " '"
+                    << identifier << "': " << ex.what());
+    }
+    setIdentifier(binary.empty() ? NULL : &binary[0], binary.size(),
+                  identifier_type_);
+    if (!ipv4_reservation_.isV4()) {
+        bundy_throw(BadValue, "reserved address " << ipv4_reservation_
+                    << " is not an IPv4 address");
+    }
+}
+
+void
+Host::setIdentifier(const uint8_t* identifier, const size_t len,
+                    const IdentifierType type) {
+    size_t max_len = (type == IDENT_HWADDR ? HWAddr::MAX_HWADDR_LEN :
+                      DUID::MAX_DUID_LEN);
+    if (len == 0 || len > max_len) {
+        bundy_throw(BadValue, "invalid length " << len << " of the "
+                    << getIdentifierName(type) << " host identifier");
+    }
+    identifier_.assign(identifier, identifier + len);
+    identifier_type_ = type;
+}
+
+bool
+Host::hasIPv4Reservation() const {
+    return (static_cast<uint32_t>(ipv4_reservation_) != 0);
+}
+
+void
+Host::addIPv6Reservation(const IOAddress& address) {
+    if (!address.isV6()) {
+        bundy_throw(BadValue, "reserved address " << address
+                    << " is not an IPv6 address");
+    }
+    ipv6_reservations_.push_back(address);
+}
+
+std::string
+Host::getIdentifierAsText() const {
+    std::ostringstream s;
+    s << getIdentifierName(identifier_type_) << "=";
+    if (identifier_type_ == IDENT_HWADDR) {
+        s << HWAddr(identifier_, HTYPE_ETHER).toText(false);
+    } else {
+        s << DUID(identifier_).toText();
+    }
+    return (s.str());
+}
+
+std::string
+Host::getIdentifierName(const IdentifierType type) {
+    switch (type) {
+    case IDENT_HWADDR:
+        return ("hw-address");
+    case IDENT_DUID:
+        return ("duid");
+    case IDENT_CLIENT_ID:
+        return ("client-id");
+    }
+    return ("unknown");
+}
+
+} // end of namespace bundy::dhcp
+} // end of namespace bundy
@@ -0,0 +1,170 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <asiolink/io_address.h>
+#include <dhcp/duid.h>
+#include <dhcp/hwaddr.h>
+#include <dhcpsrv/lease.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace bundy {
+namespace dhcp {
+
+/// @brief Reservation of addresses for a host.
+///
+/// A host is identified within a subnet by exactly one identifier: its
+/// hardware address, its client identifier (DHCPv4) or its DUID (DHCPv6).
+/// The host may have an IPv4 address and any number of IPv6 addresses
+/// reserved in the subnet, which are always assigned to it rather than
+/// being picked from the pools of the subnet. The reserved addresses don't
+/// have to be in the pools, but they must belong to the subnet.
+class Host {
+public:
+
+    /// @brief Types of the host identifiers.
+    enum IdentifierType {
+        IDENT_HWADDR,
+        IDENT_DUID,
+        IDENT_CLIENT_ID
+    };
+
+    /// @brief Constructor.
+    ///
+    /// @param identifier pointer to the identifier in the binary format.
+    /// @param identifier_len length of the identifier.
+    /// @param identifier_type type of the identifier.
+    /// @param subnet_id identifier of the subnet the host belongs to.
+    /// @param ipv4_reservation reserved IPv4 address, 0.0.0.0 if none.
+    /// @param hostname hostname of the host, may be empty.
+    ///
+    /// @throw BadValue if the identifier is empty or too long.
+    Host(const uint8_t* identifier, const size_t identifier_len,
+         const IdentifierType identifier_type, const SubnetID subnet_id,
+         const asiolink::IOAddress& ipv4_reservation,
+         const std::string& hostname = "");
+
+    /// @brief Constructor taking the identifier in the textual format.
+    ///
+    /// The identifier is a hardware address as accepted by
+    /// @ref HWAddr::fromText, or a DUID or a client identifier as accepted
+    /// by @ref DUID::fromText.
+    ///
+    /// @param identifier the identifier in the textual format.
+    /// @param identifier_name name of the identifier type: "hw-address",
+    /// "duid" or "client-id".
+    /// @param subnet_id identifier of the subnet the host belongs to.
+    /// @param ipv4_reservation reserved IPv4 address, 0.0.0.0 if none.
+    /// @param hostname hostname of the host, may be empty.
+    ///
+    /// @throw BadValue if the identifier or its type name is invalid.
+    Host(const std::string& identifier, const std::string& identifier_name,
+         const SubnetID subnet_id,
+         const asiolink::IOAddress& ipv4_reservation,
+         const std::string& hostname = "");
+
+    /// @brief Returns the identifier in the binary format.
+    const std::vector<uint8_t>& getIdentifier() const {
+        return (identifier_);
+    }
+
+    /// @brief Returns the type of the identifier.
+    IdentifierType getIdentifierType() const {
+        return (identifier_type_);
+    }
+
+    /// @brief Returns the identifier of the subnet the host belongs to.
+    SubnetID getSubnetID() const {
+        return (subnet_id_);
+    }
+
+    /// @brief Returns the reserved IPv4 address, 0.0.0.0 if none.
+    const asiolink::IOAddress& getIPv4Reservation() const {
+        return (ipv4_reservation_);
+    }
+
+    /// @brief Checks if the host has an IPv4 address reserved.
+    bool hasIPv4Reservation() const;
+
+    /// @brief Adds a reserved IPv6 address.
+    ///
+    /// @param address the address.
+    /// @throw BadValue if the address is not an IPv6 address.
+    void addIPv6Reservation(const asiolink::IOAddress& address);
+
+    /// @brief Returns the reserved IPv6 addresses.
+    const std::vector<asiolink::IOAddress>& getIPv6Reservations() const {
+        return (ipv6_reservations_);
+    }
+
+    /// @brief Returns the hostname of the host.
+    const std::string& getHostname() const {
+        return (hostname_);
+    }
+
+    /// @brief Returns the host identifier in the textual format.
+    ///
+    /// The identifier is prefixed by its type name, e.g.
+    /// "hw-address=01:02:03:04:05:06".
+    std::string getIdentifierAsText() const;
+
+    /// @brief Returns the name of an identifier type.
+    ///
+    /// @param type the identifier type.
+    static std::string getIdentifierName(const IdentifierType type);
+
+private:
+    /// @brief Sets the identifier, checking its length.
+    void setIdentifier(const uint8_t* identifier, const size_t len,
+                       const IdentifierType type);
+
+    /// Identifier of the host in the binary format.
+    std::vector<uint8_t> identifier_;
+
+    /// Type of the identifier.
+    IdentifierType identifier_type_;
+
+    /// Identifier of the subnet.
+    SubnetID subnet_id_;
+
+    /// Reserved IPv4 address.
+    asiolink::IOAddress ipv4_reservation_;
+
+    /// Reserved IPv6 addresses.
+    std::vector<asiolink::IOAddress> ipv6_reservations_;
+
+    /// Hostname.
+    std::string hostname_;
+};
+
+/// @brief Pointer to a host.
+typedef boost::shared_ptr<Host> HostPtr;
+
+/// @brief Pointer to a const host.
+typedef boost::shared_ptr<const Host> ConstHostPtr;
+
+/// @brief Collection of hosts.
+typedef std::vector<HostPtr> HostCollection;
+
+} // end of namespace bundy::dhcp
+} // end of namespace bundy
+
+#endif // HOST_H
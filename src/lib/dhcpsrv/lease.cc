@@ -13,6 +13,7 @@
 // PERFORMANCE OF THIS SOFTWARE.
 
 #include <dhcpsrv/lease.h>
+#include <util/time_utilities.h>
 #include <sstream>
 
 using namespace std;
@@ -51,9 +52,7 @@ Lease::typeToText(Lease::Type type) {
 
 bool Lease::expired() const {
 
-    // Let's use int64 to avoid problems with negative/large uint32 values
-    int64_t expire_time = cltt_ + valid_lft_;
-    return (expire_time < time(NULL));
+    return (getExpirationTime() < bundy::util::CoarseClock::getTime());
 }
 
 bool
@@ -147,7 +146,7 @@ Lease6::Lease6(Type type, const bundy::asiolink::IOAddress& addr,
         bundy_throw(InvalidOperation, "DUID must be specified for a lease");
     }
 
-    cltt_ = time(NULL);
+    cltt_ = bundy::util::CoarseClock::getTime();
 }
 
 Lease6::Lease6(Type type, const bundy::asiolink::IOAddress& addr,
@@ -163,7 +162,7 @@ Lease6::Lease6(Type type, const bundy::asiolink::IOAddress& addr,
         bundy_throw(InvalidOperation, "DUID must be specified for a lease");
     }
 
-    cltt_ = time(NULL);
+    cltt_ = bundy::util::CoarseClock::getTime();
 }
 
 Lease6::Lease6()
@@ -141,6 +141,14 @@ struct Lease {
     /// @return true if the lease is expired
     bool expired() const;
 
+    /// @brief Returns the time when the lease expires.
+    ///
+    /// @return Sum of the client last transmission time and the valid
+    /// lifetime, in seconds since the epoch.
+    int64_t getExpirationTime() const {
+        return (static_cast<int64_t>(cltt_) + valid_lft_);
+    }
+
     /// @brief Returns true if the other lease has equal FQDN data.
     ///
     /// @param other Lease which FQDN data is to be compared with our lease.
@@ -0,0 +1,94 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <dhcpsrv/lease4_cache.h>
+
+#include <boost/tuple/tuple.hpp>
+
+using namespace bundy::asiolink;
+
+namespace bundy {
+namespace dhcp {
+
+Lease4Cache::Lease4Cache(const size_t capacity)
+    : capacity_(capacity) {
+}
+
+bool
+Lease4Cache::get(const KeyType type, const std::vector<uint8_t>& key,
+                 const SubnetID subnet_id, Lease4Ptr& lease) {
+    if (entries_.empty()) {
+        return (false);
+    }
+    EntryContainer::iterator entry =
+        entries_.find(boost::make_tuple(type, key, subnet_id));
+    if (entry == entries_.end()) {
+        return (false);
+    }
+
+    // Keep the entry from being dropped for the longest time.
+    entries_.get<1>().relocate(entries_.get<1>().end(),
+                               entries_.project<1>(entry));
+    lease = entry->lease_ ? Lease4Ptr(new Lease4(*entry->lease_)) :
+        Lease4Ptr();
+    return (true);
+}
+
+void
+Lease4Cache::put(const KeyType type, const std::vector<uint8_t>& key,
+                 const SubnetID subnet_id, const Lease4Ptr& lease) {
+    if (capacity_ == 0) {
+        return;
+    }
+    const Entry entry(type, key, subnet_id,
+                      lease ? Lease4Ptr(new Lease4(*lease)) : Lease4Ptr());
+    EntryContainer::iterator existing =
+        entries_.find(boost::make_tuple(type, key, subnet_id));
+    if (existing != entries_.end()) {
+        entries_.replace(existing, entry);
+        entries_.get<1>().relocate(entries_.get<1>().end(),
+                                   entries_.project<1>(existing));
+        return;
+    }
+
+    if (entries_.size() >= capacity_) {
+        entries_.get<1>().pop_front();
+    }
+    entries_.insert(entry);
+}
+
+void
+Lease4Cache::update(const Lease4Ptr& lease) {
+    if (capacity_ == 0) {
+        return;
+    }
+    remove(lease->addr_);
+    if (!lease->hwaddr_.empty()) {
+        put(HWADDR, lease->hwaddr_, lease->subnet_id_, lease);
+    }
+    if (lease->client_id_) {
+        put(CLIENT_ID, lease->client_id_->getClientId(), lease->subnet_id_,
+            lease);
+    }
+}
+
+void
+Lease4Cache::remove(const IOAddress& addr) {
+    if (!entries_.empty()) {
+        entries_.get<2>().erase(static_cast<uint32_t>(addr));
+    }
+}
+
+} // end of namespace bundy::dhcp
+} // end of namespace bundy
@@ -0,0 +1,165 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef LEASE4_CACHE_H
+#define LEASE4_CACHE_H
+
+#include <asiolink/io_address.h>
+#include <dhcpsrv/lease.h>
+
+#include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/indexed_by.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+#include <boost/multi_index_container.hpp>
+
+#include <vector>
+
+namespace bundy {
+namespace dhcp {
+
+/// @brief Cache of the DHCPv4 leases of the clients in their subnets.
+///
+/// The allocation engine looks up the lease of a client in its subnet by
+/// the hardware address and by the client identifier for every DHCPREQUEST.
+/// The SQL lease managers keep the results of these lookups, including the
+/// ones which found no lease, in this cache so that the renewals of known
+/// clients don't need to query the database.
+///
+/// The cache is written through: the lease manager passes every lease it
+/// adds, updates or deletes to it, and clears it when a transaction is
+/// rolled back. The leases written to the database by other servers are not
+/// seen, so the cache must not be used when several servers share the lease
+/// database.
+///
+/// The cache holds at most the configured number of lookup results and
+/// drops the least recently used ones when it is full. The leases are
+/// copied in and out, as the callers modify the leases they get.
+class Lease4Cache {
+public:
+    /// @brief Identifier by which a lease is looked up.
+    enum KeyType {
+        HWADDR,
+        CLIENT_ID
+    };
+
+    /// @brief Constructor.
+    ///
+    /// @param capacity maximum number of lookup results held. The cache
+    /// holds nothing if it is zero.
+    explicit Lease4Cache(const size_t capacity);
+
+    /// @brief Returns the cached result of a lookup.
+    ///
+    /// @param type identifier type.
+    /// @param key hardware address or client identifier.
+    /// @param subnet_id identifier of the subnet.
+    /// @param [out] lease a copy of the lease, or NULL if the lookup
+    /// found no lease.
+    /// @return true if the result is cached, false if the database has to
+    /// be queried.
+    bool get(const KeyType type, const std::vector<uint8_t>& key,
+             const SubnetID subnet_id, Lease4Ptr& lease);
+
+    /// @brief Stores the result of a lookup in the database.
+    ///
+    /// @param type identifier type.
+    /// @param key hardware address or client identifier.
+    /// @param subnet_id identifier of the subnet.
+    /// @param lease the lease found, or NULL if none was found.
+    void put(const KeyType type, const std::vector<uint8_t>& key,
+             const SubnetID subnet_id, const Lease4Ptr& lease);
+
+    /// @brief Records a lease added or updated in the database.
+    ///
+    /// The results which returned the previous version of the lease are
+    /// dropped, and the lease becomes the result for its hardware address
+    /// and client identifier in its subnet.
+    ///
+    /// @param lease the lease written.
+    void update(const Lease4Ptr& lease);
+
+    /// @brief Records a lease deleted from the database.
+    ///
+    /// @param addr address of the lease.
+    void remove(const asiolink::IOAddress& addr);
+
+    /// @brief Drops all lookup results.
+    void clear() {
+        entries_.clear();
+    }
+
+    /// @brief Returns the number of lookup results held.
+    size_t size() const {
+        return (entries_.size());
+    }
+
+    /// @brief Returns the maximum number of lookup results held.
+    size_t getCapacity() const {
+        return (capacity_);
+    }
+
+private:
+    /// @brief Result of a lookup.
+    struct Entry {
+        Entry(const KeyType type, const std::vector<uint8_t>& key,
+              const SubnetID subnet_id, const Lease4Ptr& lease) :
+            type_(type), key_(key), subnet_id_(subnet_id),
+            address_(lease ? static_cast<uint32_t>(lease->addr_) : 0),
+            lease_(lease)
+        {}
+
+        KeyType type_;
+        std::vector<uint8_t> key_;
+        SubnetID subnet_id_;
+        /// Address of the lease, zero if none was found.
+        uint32_t address_;
+        Lease4Ptr lease_;
+    };
+
+    /// @brief Lookup results in the order of use, indexed by the lookup
+    /// and by the address of the lease.
+    typedef boost::multi_index_container<
+        Entry,
+        boost::multi_index::indexed_by<
+            boost::multi_index::hashed_unique<
+                boost::multi_index::composite_key<
+                    Entry,
+                    boost::multi_index::member<Entry, KeyType,
+                                               &Entry::type_>,
+                    boost::multi_index::member<Entry, std::vector<uint8_t>,
+                                               &Entry::key_>,
+                    boost::multi_index::member<Entry, SubnetID,
+                                               &Entry::subnet_id_>
+                >
+            >,
+            boost::multi_index::sequenced<>,
+            boost::multi_index::hashed_non_unique<
+                boost::multi_index::member<Entry, uint32_t, &Entry::address_>
+            >
+        >
+    > EntryContainer;
+
+    /// Maximum number of the entries.
+    size_t capacity_;
+
+    /// The entries.
+    EntryContainer entries_;
+};
+
+} // end of namespace bundy::dhcp
+} // end of namespace bundy
+
+#endif // LEASE4_CACHE_H
@@ -17,6 +17,7 @@
 
 #include <boost/foreach.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
 
 #include <algorithm>
 #include <iostream>
@@ -40,6 +41,30 @@ std::string LeaseMgr::getParameter(const std::string& name) const {
     return (param->second);
 }
 
+size_t
+LeaseMgr::getGroupCommitParameter() const {
+    return (getSizeParameter("group-commit"));
+}
+
+size_t
+LeaseMgr::getCacheSizeParameter() const {
+    return (getSizeParameter("cache-size"));
+}
+
+size_t
+LeaseMgr::getSizeParameter(const std::string& name) const {
+    ParameterMap::const_iterator param = parameters_.find(name);
+    if (param == parameters_.end()) {
+        return (0);
+    }
+    try {
+        return (boost::lexical_cast<size_t>(param->second));
+    } catch (const boost::bad_lexical_cast&) {
+        bundy_throw(BadValue, "invalid value '" << name << "="
+                    << param->second << "'");
+    }
+}
+
 Lease6Ptr
 LeaseMgr::getLease6(Lease::Type type, const DUID& duid,
                     uint32_t iaid, SubnetID subnet_id) const {
@@ -298,6 +298,42 @@ public:
     Lease6Ptr getLease6(Lease::Type type, const DUID& duid,
                         uint32_t iaid, SubnetID subnet_id) const;
 
+    /// @brief Returns a collection of expired IPv4 leases.
+    ///
+    /// The leases are returned in the order of their expiration time, the
+    /// lease which expired first being the first in the collection. It is
+    /// used by the server to reclaim the leases in batches.
+    ///
+    /// @param max_leases Maximum number of leases to be returned. The value
+    ///        of 0 means that all expired leases are returned.
+    ///
+    /// @return Lease collection (may be empty if no lease has expired)
+    virtual Lease4Collection
+    getExpiredLeases4(const size_t max_leases) const = 0;
+
+    /// @brief Returns a collection of expired IPv6 leases.
+    ///
+    /// The leases are returned in the order of their expiration time, the
+    /// lease which expired first being the first in the collection. It is
+    /// used by the server to reclaim the leases in batches.
+    ///
+    /// @param max_leases Maximum number of leases to be returned. The value
+    ///        of 0 means that all expired leases are returned.
+    ///
+    /// @return Lease collection (may be empty if no lease has expired)
+    virtual Lease6Collection
+    getExpiredLeases6(const size_t max_leases) const = 0;
+
+    /// @brief Returns all IPv6 leases of a given type.
+    ///
+    /// It is used by the allocation engine to learn, in a single query,
+    /// which addresses or prefixes are in use when it starts.
+    ///
+    /// @param type specifies lease type: (NA, TA or PD)
+    ///
+    /// @return Lease collection (may be empty if no lease is found)
+    virtual Lease6Collection getLeases6(Lease::Type type) const = 0;
+
     /// @brief Updates IPv4 lease.
     ///
     /// @param lease4 The lease to be updated.
@@ -368,6 +404,43 @@ public:
     /// support transactions, this is a no-op.
     virtual void rollback() = 0;
 
+    /// @brief Returns the group commit size.
+    ///
+    /// In group commit mode the backend does not commit the lease
+    /// writes as they are made, but only when @c commit is called. This
+    /// allows the writes made for several queries to be committed in one
+    /// transaction, at the cost of a single synchronous write to disk.
+    /// A caller using this mode must call @c commit before relying on the
+    /// writes being durable, e.g. before responding to the clients, and
+    /// should commit the writes made for at most this number of queries
+    /// together.
+    ///
+    /// The group commit mode is only supported by the database backends
+    /// and is selected with the "group-commit" parameter holding the
+    /// group commit size.
+    ///
+    /// @return Maximum number of queries for which the lease writes are
+    ///         committed together. Zero, the default, means that each
+    ///         write is committed as it is made.
+    virtual size_t getGroupCommit() const {
+        return (0);
+    }
+
+    /// @brief Starts a transaction for the lease writes of a query.
+    ///
+    /// Outside of the group commit mode, the lease writes made after this
+    /// call are not committed as they are made, but together when @c commit
+    /// is called, or discarded by @c rollback. A server processing several
+    /// IAs of a query this way commits all their leases at once. The
+    /// transaction is only started with the first write, so a query which
+    /// writes no leases doesn't cost additional database round trips.
+    ///
+    /// In the group commit mode, the writes are already made in a
+    /// transaction and this does nothing. The default implementation is
+    /// for the backends which don't support transactions.
+    virtual void beginTransaction() {
+    }
+
     /// @todo: Add host management here
     /// As host reservation is outside of scope for 2012, support for hosts
     /// is currently postponed.
@@ -375,7 +448,37 @@ public:
     /// @brief returns value of the parameter
     virtual std::string getParameter(const std::string& name) const;
 
+protected:
+    /// @brief Returns the value of the "group-commit" parameter
+    ///
+    /// This is for use by the backends supporting group commit, see
+    /// @c getGroupCommit.
+    ///
+    /// @return Group commit size, zero if the parameter is not present.
+    ///
+    /// @throw bundy::BadValue The parameter is not a valid number.
+    size_t getGroupCommitParameter() const;
+
+    /// @brief Returns the value of the "cache-size" parameter
+    ///
+    /// This is the capacity of the cache of the DHCPv4 lease lookups kept
+    /// by the SQL backends, see @c Lease4Cache.
+    ///
+    /// @return Cache size, zero if the parameter is not present.
+    ///
+    /// @throw bundy::BadValue The parameter is not a valid number.
+    size_t getCacheSizeParameter() const;
+
 private:
+    /// @brief Returns the value of a non-negative integer parameter
+    ///
+    /// @param name Name of the parameter.
+    ///
+    /// @return Value of the parameter, zero if it is not present.
+    ///
+    /// @throw bundy::BadValue The parameter is not a valid number.
+    size_t getSizeParameter(const std::string& name) const;
+
     /// @brief list of parameters passed in dbconfig
     ///
     /// That will be mostly used for storing database name, username,
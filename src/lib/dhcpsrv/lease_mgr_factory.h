@@ -98,6 +98,12 @@ public:
     ///        create() to create one before calling this method.
     static LeaseMgr& instance();
 
+    /// @brief Indicates if a lease manager is available
+    ///
+    /// @return true if a lease manager has been created and not destroyed,
+    ///         false otherwise.
+    static bool haveInstance();
+
     /// @brief Parse database access string
     ///
     /// Parses the string of "keyword=value" pairs and separates them
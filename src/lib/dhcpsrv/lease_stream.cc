@@ -0,0 +1,336 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <dhcp/iface_mgr.h>
+#include <dhcpsrv/dhcpsrv_log.h>
+#include <dhcpsrv/lease_mgr.h>
+#include <dhcpsrv/lease_stream.h>
+
+#include <boost/bind.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace bundy::asiolink;
+using namespace bundy::util;
+
+namespace bundy {
+namespace dhcp {
+
+const time_t LeaseStreamSender::RETRY_INTERVAL;
+const size_t LeaseStreamSender::MAX_PENDING;
+const size_t LeaseStreamReceiver::MAX_READ;
+
+namespace {
+
+/// @brief Converts the address and port to the socket address.
+///
+/// @param address IPv4 or IPv6 address.
+/// @param port Port.
+/// @param [out] storage Socket address.
+///
+/// @return Length of the socket address.
+socklen_t
+toSockaddr(const IOAddress& address, const uint16_t port,
+           sockaddr_storage& storage) {
+    memset(&storage, 0, sizeof(storage));
+    if (address.isV4()) {
+        sockaddr_in* addr4 = reinterpret_cast<sockaddr_in*>(&storage);
+        addr4->sin_family = AF_INET;
+        addr4->sin_port = htons(port);
+        addr4->sin_addr.s_addr = htonl(static_cast<uint32_t>(address));
+        return (sizeof(sockaddr_in));
+    }
+    sockaddr_in6* addr6 = reinterpret_cast<sockaddr_in6*>(&storage);
+    addr6->sin6_family = AF_INET6;
+    addr6->sin6_port = htons(port);
+    const std::vector<uint8_t> bytes = address.toBytes();
+    memcpy(&addr6->sin6_addr, &bytes[0], sizeof(addr6->sin6_addr));
+    return (sizeof(sockaddr_in6));
+}
+
+/// @brief Makes the socket non-blocking.
+///
+/// @return true on success.
+bool
+setNonBlocking(const int socket) {
+    const int flags = fcntl(socket, F_GETFL, 0);
+    return ((flags >= 0) && (fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0));
+}
+
+}
+
+LeaseStreamSender::LeaseStreamSender(const IOAddress& address,
+                                     const uint16_t port,
+                                     const CSVRow& header)
+    : address_(address), port_(port), header_(header), socket_(-1),
+      state_(DISCONNECTED), last_attempt_(0) {
+}
+
+LeaseStreamSender::~LeaseStreamSender() {
+    if (socket_ >= 0) {
+        close(socket_);
+    }
+}
+
+bool
+LeaseStreamSender::poll() {
+    if (state_ == CONNECTED) {
+        return (false);
+    }
+
+    if (state_ == DISCONNECTED) {
+        const time_t now = time(NULL);
+        if (now - last_attempt_ < RETRY_INTERVAL) {
+            return (false);
+        }
+        last_attempt_ = now;
+        connect();
+        if (state_ == DISCONNECTED) {
+            return (false);
+        }
+    }
+
+    if (state_ == CONNECTING) {
+        pollfd pfd;
+        pfd.fd = socket_;
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+        if (::poll(&pfd, 1, 0) <= 0) {
+            // Still connecting.
+            return (false);
+        }
+        int error = 0;
+        socklen_t error_len = sizeof(error);
+        if (getsockopt(socket_, SOL_SOCKET, SO_ERROR, &error,
+                       &error_len) != 0) {
+            error = errno;
+        }
+        if (error != 0) {
+            disconnect(strerror(error));
+            return (false);
+        }
+        state_ = CONNECTED;
+    }
+
+    // The connection has just been established: the stream starts with
+    // the header, like the lease file.
+    LOG_INFO(dhcpsrv_logger, DHCPSRV_MEMFILE_STANDBY_CONNECTED)
+        .arg(address_.toText()).arg(port_);
+    append(header_);
+    return (true);
+}
+
+void
+LeaseStreamSender::append(const CSVRow& row) {
+    if (state_ == CONNECTED) {
+        buffer_ += row.render();
+        buffer_ += '\n';
+    }
+}
+
+void
+LeaseStreamSender::flush() {
+    size_t sent = 0;
+    while ((state_ == CONNECTED) && (sent < buffer_.size())) {
+        const ssize_t status = send(socket_, buffer_.data() + sent,
+                                    buffer_.size() - sent,
+                                    MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (status > 0) {
+            sent += status;
+        } else if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+            break;
+        } else if (errno != EINTR) {
+            disconnect(strerror(errno));
+            return;
+        }
+    }
+    buffer_.erase(0, sent);
+
+    if (buffer_.size() > MAX_PENDING) {
+        disconnect("the standby server doesn't keep up with the changes");
+    }
+}
+
+void
+LeaseStreamSender::connect() {
+    sockaddr_storage storage;
+    const socklen_t len = toSockaddr(address_, port_, storage);
+    socket_ = socket(storage.ss_family, SOCK_STREAM, 0);
+    if (socket_ < 0) {
+        disconnect(strerror(errno));
+        return;
+    }
+    if (!setNonBlocking(socket_)) {
+        disconnect(strerror(errno));
+        return;
+    }
+    if (::connect(socket_, reinterpret_cast<const sockaddr*>(&storage),
+                  len) == 0) {
+        state_ = CONNECTED;
+    } else if (errno == EINPROGRESS) {
+        state_ = CONNECTING;
+    } else {
+        disconnect(strerror(errno));
+    }
+}
+
+void
+LeaseStreamSender::disconnect(const std::string& reason) {
+    // Only the loss of an established connection is worth a warning, not
+    // each failed attempt while the standby server is down.
+    if (state_ == CONNECTED) {
+        LOG_WARN(dhcpsrv_logger, DHCPSRV_MEMFILE_STANDBY_DISCONNECTED)
+            .arg(address_.toText()).arg(port_).arg(reason);
+    } else {
+        LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
+                  DHCPSRV_MEMFILE_STANDBY_CONNECT_FAIL)
+            .arg(address_.toText()).arg(port_).arg(reason);
+    }
+    if (socket_ >= 0) {
+        close(socket_);
+        socket_ = -1;
+    }
+    state_ = DISCONNECTED;
+    buffer_.clear();
+}
+
+LeaseStreamReceiver::LeaseStreamReceiver(const IOAddress& address,
+                                         const uint16_t port,
+                                         const CSVRow& header,
+                                         const Handler& handler)
+    : header_(header.render()), handler_(handler), listen_socket_(-1),
+      socket_(-1), header_received_(false) {
+    sockaddr_storage storage;
+    const socklen_t len = toSockaddr(address, port, storage);
+    listen_socket_ = socket(storage.ss_family, SOCK_STREAM, 0);
+    if (listen_socket_ < 0) {
+        bundy_throw(DbOperationError, "unable to open the socket for the"
+                    " lease stream: " << strerror(errno));
+    }
+    const int flag = 1;
+    if ((setsockopt(listen_socket_, SOL_SOCKET, SO_REUSEADDR, &flag,
+                    sizeof(flag)) != 0) ||
+        (bind(listen_socket_, reinterpret_cast<const sockaddr*>(&storage),
+              len) != 0) ||
+        (listen(listen_socket_, 1) != 0) ||
+        !setNonBlocking(listen_socket_)) {
+        const int error = errno;
+        close(listen_socket_);
+        bundy_throw(DbOperationError, "unable to listen for the lease stream"
+                    " on " << address << " port " << port << ": "
+                    << strerror(error));
+    }
+    IfaceMgr::instance().addExternalSocket(listen_socket_,
+        boost::bind(&LeaseStreamReceiver::accept, this));
+}
+
+LeaseStreamReceiver::~LeaseStreamReceiver() {
+    if (socket_ >= 0) {
+        IfaceMgr::instance().deleteExternalSocket(socket_);
+        close(socket_);
+    }
+    IfaceMgr::instance().deleteExternalSocket(listen_socket_);
+    close(listen_socket_);
+}
+
+void
+LeaseStreamReceiver::accept() {
+    const int socket = ::accept(listen_socket_, NULL, NULL);
+    if (socket < 0) {
+        return;
+    }
+    if (!setNonBlocking(socket)) {
+        close(socket);
+        return;
+    }
+    if (socket_ >= 0) {
+        disconnect("replaced by a new connection");
+    }
+    socket_ = socket;
+    IfaceMgr::instance().addExternalSocket(socket_,
+        boost::bind(&LeaseStreamReceiver::receive, this));
+    LOG_INFO(dhcpsrv_logger, DHCPSRV_MEMFILE_STREAM_ACCEPTED);
+}
+
+void
+LeaseStreamReceiver::receive() {
+    std::string reason;
+    char data[65536];
+    for (size_t total = 0; total < MAX_READ; ) {
+        const ssize_t status = recv(socket_, data, sizeof(data), 0);
+        if (status > 0) {
+            buffer_.append(data, status);
+            total += status;
+        } else if (status == 0) {
+            reason = "connection closed by the primary server";
+            break;
+        } else if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+            break;
+        } else if (errno != EINTR) {
+            reason = strerror(errno);
+            break;
+        }
+    }
+
+    // Split the complete records.
+    std::vector<CSVRow> rows;
+    bool reset = false;
+    size_t start = 0;
+    for (size_t end = buffer_.find('\n'); end != std::string::npos;
+         end = buffer_.find('\n', start)) {
+        const std::string line = buffer_.substr(start, end - start);
+        start = end + 1;
+        if (header_received_) {
+            rows.push_back(CSVRow(line));
+        } else if (line == header_) {
+            header_received_ = true;
+            reset = true;
+        } else {
+            reason = "the stream doesn't start with the lease file header";
+            break;
+        }
+    }
+    buffer_.erase(0, start);
+
+    if (reset || !rows.empty()) {
+        try {
+            handler_(reset, rows);
+        } catch (const std::exception& ex) {
+            reason = ex.what();
+        }
+    }
+
+    if (!reason.empty()) {
+        disconnect(reason);
+    }
+}
+
+void
+LeaseStreamReceiver::disconnect(const std::string& reason) {
+    LOG_WARN(dhcpsrv_logger, DHCPSRV_MEMFILE_STREAM_CLOSED).arg(reason);
+    IfaceMgr::instance().deleteExternalSocket(socket_);
+    close(socket_);
+    socket_ = -1;
+    header_received_ = false;
+    buffer_.clear();
+}
+
+} // end of namespace bundy::dhcp
+} // end of namespace bundy
@@ -0,0 +1,228 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef LEASE_STREAM_H
+#define LEASE_STREAM_H
+
+#include <asiolink/io_address.h>
+#include <util/csv_file.h>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace bundy {
+namespace dhcp {
+
+/// @brief Sends the lease records of the primary server to the standby
+/// server.
+///
+/// The lease stream is the TCP connection over which the memfile lease
+/// manager of the primary server sends the records it appends to its lease
+/// file (see @c Memfile_LeaseMgr). Each connection starts with the header
+/// of the lease file, followed by the records of all leases and then by the
+/// records of the changes made since, one per line, so the standby server
+/// has the same leases as the primary one without reading any file.
+///
+/// The sender never blocks the server: the connection is made in the
+/// background, the records are buffered and sent as far as the socket
+/// accepts them. If the standby server falls too far behind, or the
+/// connection fails, the records are dropped and a new connection is
+/// attempted later, which starts the stream over.
+///
+/// The sender is not thread safe, the caller serializes its use.
+class LeaseStreamSender : public boost::noncopyable {
+public:
+    /// @brief Constructor.
+    ///
+    /// The connection is not made until @c poll is called.
+    ///
+    /// @param address Address of the standby server.
+    /// @param port Port on which the standby server listens.
+    /// @param header Header of the lease file.
+    LeaseStreamSender(const asiolink::IOAddress& address, const uint16_t port,
+                      const util::CSVRow& header);
+
+    /// @brief Destructor.
+    ///
+    /// Closes the connection. The records not sent yet are lost.
+    ~LeaseStreamSender();
+
+    /// @brief Progresses the connection to the standby server.
+    ///
+    /// Starts a new connection if there is none and the last attempt was
+    /// made long enough ago, or checks if the connection being made has
+    /// been established.
+    ///
+    /// @return true if the connection has just been established. The caller
+    /// then appends the records of all leases.
+    bool poll();
+
+    /// @brief Appends a record to the stream.
+    ///
+    /// The record is dropped if there is no connection.
+    ///
+    /// @param row Lease record.
+    void append(const util::CSVRow& row);
+
+    /// @brief Sends the appended records.
+    ///
+    /// Sends as much as the socket accepts without blocking, the rest is
+    /// sent on the next call.
+    void flush();
+
+    /// @brief Checks if the records are being sent.
+    bool isConnected() const {
+        return (state_ == CONNECTED);
+    }
+
+    /// @brief Returns the number of bytes appended and not sent yet.
+    size_t getPending() const {
+        return (buffer_.size());
+    }
+
+    /// @brief Number of seconds between the connection attempts.
+    static const time_t RETRY_INTERVAL = 5;
+
+    /// @brief Maximum number of bytes not sent yet before the connection
+    /// is dropped.
+    static const size_t MAX_PENDING = 64 * 1024 * 1024;
+
+private:
+    /// @brief State of the connection.
+    enum State {
+        DISCONNECTED,
+        CONNECTING,
+        CONNECTED
+    };
+
+    /// @brief Starts a connection without waiting for it.
+    void connect();
+
+    /// @brief Closes the connection and drops the records not sent.
+    ///
+    /// @param reason Reason of the disconnection, logged.
+    void disconnect(const std::string& reason);
+
+    /// Address of the standby server.
+    asiolink::IOAddress address_;
+
+    /// Port of the standby server.
+    uint16_t port_;
+
+    /// Header of the lease file.
+    util::CSVRow header_;
+
+    /// Socket, negative if there is no connection.
+    int socket_;
+
+    /// State of the connection.
+    State state_;
+
+    /// Time of the last connection attempt.
+    time_t last_attempt_;
+
+    /// Records not sent yet.
+    std::string buffer_;
+};
+
+/// @brief Receives the lease records of the primary server on the standby
+/// server.
+///
+/// The receiver listens for the connection of the primary server and
+/// passes the records it receives to the handler in batches of all
+/// complete records read at once. The sockets are registered with the
+/// @c IfaceMgr, so the records are received by the thread of the server
+/// waiting for the DHCP queries. A new connection replaces the previous one,
+/// as it is made when the primary server restarts or has lost the previous
+/// connection.
+class LeaseStreamReceiver : public boost::noncopyable {
+public:
+    /// @brief Handler of the received records.
+    ///
+    /// The first parameter is true if a new stream begins with the records,
+    /// in which case the handler drops the leases it holds. The second one
+    /// holds the records.
+    typedef boost::function<void (bool, const std::vector<util::CSVRow>&)>
+    Handler;
+
+    /// @brief Constructor.
+    ///
+    /// Starts listening for the connection of the primary server.
+    ///
+    /// @param address Address on which to listen.
+    /// @param port Port on which to listen.
+    /// @param header Header of the lease file, which the stream is expected
+    /// to start with.
+    /// @param handler Handler of the received records.
+    ///
+    /// @throw DbOperationError if the listening socket can't be opened.
+    LeaseStreamReceiver(const asiolink::IOAddress& address,
+                        const uint16_t port, const util::CSVRow& header,
+                        const Handler& handler);
+
+    /// @brief Destructor.
+    ///
+    /// Closes the sockets.
+    ~LeaseStreamReceiver();
+
+    /// @brief Checks if the primary server is connected.
+    bool isConnected() const {
+        return (socket_ >= 0);
+    }
+
+    /// @brief Maximum number of bytes read at once.
+    ///
+    /// The server gets back to the DHCP queries when it has read that many
+    /// bytes, the rest is read when it waits for the queries again.
+    static const size_t MAX_READ = 1024 * 1024;
+
+private:
+    /// @brief Accepts the connection of the primary server.
+    void accept();
+
+    /// @brief Reads the records and passes them to the handler.
+    void receive();
+
+    /// @brief Closes the connection.
+    ///
+    /// @param reason Reason of the disconnection, logged.
+    void disconnect(const std::string& reason);
+
+    /// Header of the lease file.
+    std::string header_;
+
+    /// Handler of the received records.
+    Handler handler_;
+
+    /// Listening socket.
+    int listen_socket_;
+
+    /// Socket of the connection, negative if there is none.
+    int socket_;
+
+    /// Whether the header of the stream has been received.
+    bool header_received_;
+
+    /// Received part of the record being read.
+    std::string buffer_;
+};
+
+} // end of namespace bundy::dhcp
+} // end of namespace bundy
+
+#endif // LEASE_STREAM_H
@@ -17,27 +17,347 @@
 #include <dhcpsrv/memfile_lease_mgr.h>
 #include <exceptions/exceptions.h>
 
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
 #include <iostream>
+#include <unistd.h>
+#include <vector>
 
 using namespace bundy::dhcp;
+using bundy::asiolink::IOAddress;
+using bundy::util::CSVRow;
+using bundy::util::thread::Mutex;
+
+namespace {
+
+/// @brief Holds the locks of all partitions of the leases.
+///
+/// The partitions are locked in the order of their indexes. Any function
+/// holding the locks of several partitions takes them in this order.
+class ShardsLocker : boost::noncopyable {
+public:
+    /// @brief Locks the partitions.
+    ///
+    /// @param shards Partitions of the leases.
+    /// @param count Number of partitions.
+    ///
+    /// @tparam ShardType Partition of the leases of either type.
+    template<typename ShardType>
+    ShardsLocker(ShardType* shards, const size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            lockers_.push_back(boost::shared_ptr<Mutex::Locker>(
+                new Mutex::Locker(shards[i].mutex_)));
+        }
+    }
+
+private:
+    /// @brief Locks held, one per partition.
+    std::vector<boost::shared_ptr<Mutex::Locker> > lockers_;
+};
+
+/// @brief Returns the number of leases in all partitions.
+///
+/// @param shards Partitions of the leases.
+/// @param count Number of partitions.
+///
+/// @tparam ShardType Partition of the leases of either type.
+template<typename ShardType>
+size_t
+countLeases(ShardType* shards, const size_t count) {
+    size_t leases = 0;
+    for (size_t i = 0; i < count; ++i) {
+        Mutex::Locker locker(shards[i].mutex_);
+        leases += shards[i].storage_.size();
+    }
+    return (leases);
+}
+
+/// @brief Checks if an address is leased in any partition.
+///
+/// The caller must hold the locks of all partitions, so as the lease can't
+/// be added to another partition before the caller inserts it.
+///
+/// @param shards Partitions of the leases.
+/// @param count Number of partitions.
+/// @param addr Address of the lease.
+///
+/// @tparam ShardType Partition of the leases of either type.
+template<typename ShardType>
+bool
+leaseExists(ShardType* shards, const size_t count,
+            const bundy::asiolink::IOAddress& addr) {
+    for (size_t i = 0; i < count; ++i) {
+        if (shards[i].storage_.find(addr) != shards[i].storage_.end()) {
+            return (true);
+        }
+    }
+    return (false);
+}
+
+/// @brief Compares the expiration times of two leases.
+///
+/// @tparam LeasePtrType Pointer to a lease of either type.
+template<typename LeasePtrType>
+bool
+expiresEarlier(const LeasePtrType& first, const LeasePtrType& second) {
+    return (first->getExpirationTime() < second->getExpirationTime());
+}
+
+/// @brief Returns copies of the expired leases, first expired first.
+///
+/// @param shards Partitions of the leases.
+/// @param count Number of partitions.
+/// @param max_leases Maximum number of leases to be returned, 0 if all
+/// expired leases should be returned.
+/// @param [out] collection Collection to which the leases are appended.
+///
+/// @tparam Index Index of the lease storage sorting the leases by expiration
+/// time.
+/// @tparam ShardType Partition of the leases of either type.
+/// @tparam LeaseType Lease type matching the partition.
+template<int Index, typename ShardType, typename LeaseType>
+void
+getExpiredLeases(ShardType* shards, const size_t count,
+                 const size_t max_leases,
+                 std::vector<boost::shared_ptr<LeaseType> >& collection) {
+    // The leases which expire before the current time are expired.
+    const int64_t now = static_cast<int64_t>(time(NULL));
+    for (size_t i = 0; i < count; ++i) {
+        Mutex::Locker locker(shards[i].mutex_);
+        typedef typename ShardType::Storage::template
+            nth_index<Index>::type SearchIndex;
+        const SearchIndex& idx = shards[i].storage_.template get<Index>();
+        typename SearchIndex::const_iterator end = idx.lower_bound(now);
+        size_t taken = 0;
+        for (typename SearchIndex::const_iterator lease = idx.begin();
+             (lease != end) && ((max_leases == 0) || (taken < max_leases));
+             ++lease, ++taken) {
+            collection.push_back(boost::shared_ptr<LeaseType>(
+                new LeaseType(**lease)));
+        }
+    }
+
+    // Each partition has given its first expired leases. Merge them.
+    if (count > 1) {
+        std::stable_sort(collection.begin(), collection.end(),
+                         expiresEarlier<boost::shared_ptr<LeaseType> >);
+        if ((max_leases > 0) && (collection.size() > max_leases)) {
+            collection.resize(max_leases);
+        }
+    }
+}
+
+/// @brief Replaces the lease file with a snapshot of the leases in memory.
+///
+/// The leases are written to a temporary file, which is synchronized with
+/// the disk and renamed over the lease file. The lease file is then reopened
+/// so as subsequent records are appended to the new file.
+///
+/// The caller must hold the locks of all partitions and of the lease file.
+///
+/// @param lease_file Lease file to be replaced.
+/// @param shards Partitions holding the leases to be written.
+/// @param count Number of partitions.
+/// @param auto_flush Specifies if the reopened lease file should be flushed
+/// after each appended row.
+///
+/// @return Number of leases written.
+///
+/// @tparam LeaseFileType One of the @c CSVLeaseFile4, @c CSVLeaseFile6,
+/// @c BinaryLeaseFile4 or @c BinaryLeaseFile6.
+/// @tparam ShardType Partition of the leases of the respective type.
+template<typename LeaseFileType, typename ShardType>
+size_t
+replaceLeaseFile(const boost::shared_ptr<LeaseFileType>& lease_file,
+                 const ShardType* shards, const size_t count,
+                 const bool auto_flush) {
+    const std::string filename = lease_file->getFilename();
+    const std::string tmp_filename = filename + ".tmp";
+    size_t leases = 0;
+
+    try {
+        LeaseFileType tmp_file(tmp_filename);
+        tmp_file.recreate();
+        tmp_file.setAutoFlush(false);
+        for (size_t i = 0; i < count; ++i) {
+            typedef typename ShardType::Storage StorageType;
+            const StorageType& storage = shards[i].storage_;
+            for (typename StorageType::const_iterator lease = storage.begin();
+                 lease != storage.end(); ++lease) {
+                tmp_file.append(**lease);
+            }
+            leases += storage.size();
+        }
+        tmp_file.sync();
+        tmp_file.close();
+
+    } catch (const std::exception& ex) {
+        unlink(tmp_filename.c_str());
+        bundy_throw(DbOperationError, "failed to write the snapshot of the"
+                    " leases to '" << tmp_filename << "': " << ex.what());
+    }
+
+    // Closing the lease file flushes the records buffered for it. If the
+    // rename fails, they are in the lease file which is still in use.
+    lease_file->close();
+    const int status = rename(tmp_filename.c_str(), filename.c_str());
+    const int rename_errno = errno;
+    if (status != 0) {
+        unlink(tmp_filename.c_str());
+    }
+    lease_file->open();
+    lease_file->setAutoFlush(auto_flush);
+    if (status != 0) {
+        bundy_throw(DbOperationError, "failed to rename '" << tmp_filename
+                    << "' to '" << filename << "': " << strerror(rename_errno));
+    }
+    return (leases);
+}
+
+/// @brief Appends the records of all leases to the lease stream.
+///
+/// @param sender Stream to the standby server.
+/// @param format Converts the leases to the records.
+/// @param shards Partitions holding the leases to be sent.
+/// @param count Number of partitions.
+///
+/// @tparam LeaseFileType One of the @c CSVLeaseFile4 or @c CSVLeaseFile6.
+/// @tparam ShardType Partition of the leases of the respective type.
+template<typename LeaseFileType, typename ShardType>
+void
+sendLeases(LeaseStreamSender& sender, const LeaseFileType& format,
+           const ShardType* shards, const size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        typedef typename ShardType::Storage StorageType;
+        const StorageType& storage = shards[i].storage_;
+        for (typename StorageType::const_iterator lease = storage.begin();
+             lease != storage.end(); ++lease) {
+            sender.append(format.createRow(**lease));
+        }
+    }
+}
+
+/// @brief Creates the leases from the records of the lease stream.
+///
+/// The invalid records are logged and skipped.
+///
+/// @param format Converts the records to the leases.
+/// @param rows Records of the leases.
+///
+/// @tparam LeasePtrType One of the @c Lease4Ptr or @c Lease6Ptr.
+/// @tparam LeaseFileType One of the @c CSVLeaseFile4 or @c CSVLeaseFile6.
+template<typename LeasePtrType, typename LeaseFileType>
+std::vector<LeasePtrType>
+parseLeases(LeaseFileType& format, const std::vector<CSVRow>& rows) {
+    std::vector<LeasePtrType> leases;
+    leases.reserve(rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+        try {
+            leases.push_back(format.parseRow(rows[i]));
+        } catch (const std::exception& ex) {
+            LOG_ERROR(dhcpsrv_logger, DHCPSRV_MEMFILE_STREAM_INVALID_LEASE)
+                .arg(rows[i].render()).arg(ex.what());
+        }
+    }
+    return (leases);
+}
+
+}
 
 Memfile_LeaseMgr::Memfile_LeaseMgr(const ParameterMap& parameters)
-    : LeaseMgr(parameters) {
+    : LeaseMgr(parameters), shard_count_(1), binary_format_(false),
+      records4_(0), records6_(0), group_commit_(getGroupCommitParameter()),
+      lfc_threshold_(0), universe_(V4) {
+    std::string shards;
+    try {
+        shards = getParameter("shards");
+    } catch (const Exception& ex) {
+        // The leases are held in a single partition by default.
+    }
+    if (!shards.empty()) {
+        try {
+            shard_count_ = boost::lexical_cast<size_t>(shards);
+        } catch (const boost::bad_lexical_cast&) {
+            shard_count_ = 0;
+        }
+        if (shard_count_ == 0) {
+            bundy_throw(bundy::BadValue, "invalid value 'shards="
+                        << shards << "'");
+        }
+    }
+    shards4_.reset(new Lease4Shard[shard_count_]);
+    shards6_.reset(new Lease6Shard[shard_count_]);
+
+    std::string lfc_threshold;
+    try {
+        lfc_threshold = getParameter("lfc-threshold");
+    } catch (const Exception& ex) {
+        // The lease file cleanup is disabled unless explicitly enabled.
+    }
+    if (!lfc_threshold.empty()) {
+        try {
+            lfc_threshold_ = boost::lexical_cast<size_t>(lfc_threshold);
+        } catch (const boost::bad_lexical_cast&) {
+            bundy_throw(bundy::BadValue, "invalid value 'lfc-threshold="
+                        << lfc_threshold << "'");
+        }
+    }
+
+    std::string format;
+    try {
+        format = getParameter("format");
+    } catch (const Exception& ex) {
+        // The lease file is in the CSV format by default.
+    }
+    if (format == "binary") {
+        binary_format_ = true;
+    } else if (!format.empty() && format != "csv") {
+        bundy_throw(bundy::BadValue, "invalid value 'format="
+                    << format << "'");
+    }
+
     // Check the universe and use v4 file or v6 file.
     std::string universe = getParameter("universe");
-    if (universe == "4") {
+    universe_ = (universe == "4" ? V4 : V6);
+    if (universe_ == V4) {
         std::string file4 = initLeaseFilePath(V4);
         if (!file4.empty()) {
-            lease_file4_.reset(new CSVLeaseFile4(file4));
-            lease_file4_->open();
+            // In the group commit mode the lease file is flushed once for
+            // all records appended for the batch of queries.
+            if (binary_format_) {
+                binary_file4_.reset(new BinaryLeaseFile4(file4));
+                binary_file4_->open();
+                binary_file4_->setAutoFlush(group_commit_ == 0);
+            } else {
+                lease_file4_.reset(new CSVLeaseFile4(file4));
+                lease_file4_->open();
+                lease_file4_->setAutoFlush(group_commit_ == 0);
+            }
             load4();
+            checkLeaseFileCompaction(V4);
         }
     } else {
         std::string file6 = initLeaseFilePath(V6);
         if (!file6.empty()) {
-            lease_file6_.reset(new CSVLeaseFile6(file6));
-            lease_file6_->open();
+            if (binary_format_) {
+                binary_file6_.reset(new BinaryLeaseFile6(file6));
+                binary_file6_->open();
+                binary_file6_->setAutoFlush(group_commit_ == 0);
+            } else {
+                lease_file6_.reset(new CSVLeaseFile6(file6));
+                lease_file6_->open();
+                lease_file6_->setAutoFlush(group_commit_ == 0);
+            }
             load6();
+            checkLeaseFileCompaction(V6);
         }
     }
 
@@ -48,9 +368,13 @@ Memfile_LeaseMgr::Memfile_LeaseMgr(const ParameterMap& parameters)
     if (!persistLeases(V4) && !persistLeases(V6)) {
         LOG_WARN(dhcpsrv_logger, DHCPSRV_MEMFILE_NO_STORAGE);
     }
+
+    initLeaseStream(universe_);
 }
 
 Memfile_LeaseMgr::~Memfile_LeaseMgr() {
+    // Stop receiving the leases before the lease file is closed.
+    primary_.reset();
     if (lease_file4_) {
         lease_file4_->close();
         lease_file4_.reset();
@@ -59,6 +383,14 @@ Memfile_LeaseMgr::~Memfile_LeaseMgr() {
         lease_file6_->close();
         lease_file6_.reset();
     }
+    if (binary_file4_) {
+        binary_file4_->close();
+        binary_file4_.reset();
+    }
+    if (binary_file6_) {
+        binary_file6_->close();
+        binary_file6_.reset();
+    }
 }
 
 bool
@@ -66,19 +398,23 @@ Memfile_LeaseMgr::addLease(const Lease4Ptr& lease) {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_MEMFILE_ADD_ADDR4).arg(lease->addr_.toText());
 
-    if (getLease4(lease->addr_)) {
-        // there is a lease with specified address already
-        return (false);
-    }
+    {
+        // The address may be leased in another subnet, i.e. in another
+        // partition. All partitions are locked until the lease is inserted,
+        // so as the address can't be leased in another one meanwhile.
+        ShardsLocker shards_locker(shards4_.get(), shard_count_);
+        if (leaseExists(shards4_.get(), shard_count_, lease->addr_)) {
+            // there is a lease with specified address already
+            return (false);
+        }
 
-    // Try to write a lease to disk first. If this fails, the lease will
-    // not be inserted to the memory and the disk and in-memory data will
-    // remain consistent.
-    if (persistLeases(V4)) {
-        lease_file4_->append(*lease);
+        // Try to write a lease to disk first. If this fails, the lease will
+        // not be inserted to the memory and the disk and in-memory data will
+        // remain consistent.
+        appendLease(V4, *lease);
+        shards4_[getShard(lease->subnet_id_)].storage_.insert(lease);
     }
-
-    storage4_.insert(lease);
+    leasesWritten(V4);
     return (true);
 }
 
@@ -87,19 +423,23 @@ Memfile_LeaseMgr::addLease(const Lease6Ptr& lease) {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_MEMFILE_ADD_ADDR6).arg(lease->addr_.toText());
 
-    if (getLease6(lease->type_, lease->addr_)) {
-        // there is a lease with specified address already
-        return (false);
-    }
+    {
+        // The address may be leased in another subnet, i.e. in another
+        // partition. All partitions are locked until the lease is inserted,
+        // so as the address can't be leased in another one meanwhile.
+        ShardsLocker shards_locker(shards6_.get(), shard_count_);
+        if (leaseExists(shards6_.get(), shard_count_, lease->addr_)) {
+            // there is a lease with specified address already
+            return (false);
+        }
 
-    // Try to write a lease to disk first. If this fails, the lease will
-    // not be inserted to the memory and the disk and in-memory data will
-    // remain consistent.
-    if (persistLeases(V6)) {
-        lease_file6_->append(*lease);
+        // Try to write a lease to disk first. If this fails, the lease will
+        // not be inserted to the memory and the disk and in-memory data will
+        // remain consistent.
+        appendLease(V6, *lease);
+        shards6_[getShard(lease->subnet_id_)].storage_.insert(lease);
     }
-
-    storage6_.insert(lease);
+    leasesWritten(V6);
     return (true);
 }
 
@@ -108,14 +448,16 @@ Memfile_LeaseMgr::getLease4(const bundy::asiolink::IOAddress& addr) const {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_MEMFILE_GET_ADDR4).arg(addr.toText());
 
-    typedef Lease4Storage::nth_index<0>::type SearchIndex;
-    const SearchIndex& idx = storage4_.get<0>();
-    Lease4Storage::iterator l = idx.find(addr);
-    if (l == storage4_.end()) {
-        return (Lease4Ptr());
-    } else {
-        return (Lease4Ptr(new Lease4(**l)));
+    // The subnet is not known, so look the lease up in each partition.
+    for (size_t i = 0; i < shard_count_; ++i) {
+        Mutex::Locker locker(shards4_[i].mutex_);
+        const Lease4Storage& storage = shards4_[i].storage_;
+        Lease4Storage::const_iterator l = storage.find(addr);
+        if (l != storage.end()) {
+            return (Lease4Ptr(new Lease4(**l)));
+        }
     }
+    return (Lease4Ptr());
 }
 
 Lease4Collection
@@ -124,13 +466,16 @@ Memfile_LeaseMgr::getLease4(const HWAddr& hwaddr) const {
               DHCPSRV_MEMFILE_GET_HWADDR).arg(hwaddr.toText());
     typedef Lease4Storage::nth_index<0>::type SearchIndex;
     Lease4Collection collection;
-    const SearchIndex& idx = storage4_.get<0>();
-    for(SearchIndex::const_iterator lease = idx.begin();
-        lease != idx.end(); ++lease) {
-
-        // Every Lease4 has a hardware address, so we can compare it
-        if ((*lease)->hwaddr_ == hwaddr.hwaddr_) {
-            collection.push_back((*lease));
+    for (size_t i = 0; i < shard_count_; ++i) {
+        Mutex::Locker locker(shards4_[i].mutex_);
+        const SearchIndex& idx = shards4_[i].storage_.get<0>();
+        for(SearchIndex::const_iterator lease = idx.begin();
+            lease != idx.end(); ++lease) {
+
+            // Every Lease4 has a hardware address, so we can compare it
+            if ((*lease)->hwaddr_ == hwaddr.hwaddr_) {
+                collection.push_back(Lease4Ptr(new Lease4(**lease)));
+            }
         }
     }
 
@@ -147,11 +492,15 @@ Memfile_LeaseMgr::getLease4(const HWAddr& hwaddr, SubnetID subnet_id) const {
     // We define SearchIndex locally in this function because
     // currently only this function uses this index.
     typedef Lease4Storage::nth_index<1>::type SearchIndex;
-    // Get the index.
-    const SearchIndex& idx = storage4_.get<1>();
-    // Try to find the lease using HWAddr and subnet id.
+    // Get the index of the partition holding the leases of the subnet.
+    Lease4Shard& shard = shards4_[getShard(subnet_id)];
+    Mutex::Locker locker(shard.mutex_);
+    const SearchIndex& idx = shard.storage_.get<1>();
+    // Try to find the lease using HWAddr and subnet id. The key refers to
+    // the hardware address rather than copying it.
     SearchIndex::const_iterator lease =
-        idx.find(boost::make_tuple(hwaddr.hwaddr_, subnet_id));
+        idx.find(boost::tuple<const std::vector<uint8_t>&, SubnetID>(
+                     hwaddr.hwaddr_, subnet_id));
     // Lease was not found. Return empty pointer to the caller.
     if (lease == idx.end()) {
         return (Lease4Ptr());
@@ -167,14 +516,18 @@ Memfile_LeaseMgr::getLease4(const ClientId& client_id) const {
               DHCPSRV_MEMFILE_GET_CLIENTID).arg(client_id.toText());
     typedef Memfile_LeaseMgr::Lease4Storage::nth_index<0>::type SearchIndex;
     Lease4Collection collection;
-    const SearchIndex& idx = storage4_.get<0>();
-    for(SearchIndex::const_iterator lease = idx.begin();
-        lease != idx.end(); ++ lease) {
-
-        // client-id is not mandatory in DHCPv4. There can be a lease that does
-        // not have a client-id. Dereferencing null pointer would be a bad thing
-        if((*lease)->client_id_ && *(*lease)->client_id_ == client_id) {
-            collection.push_back((*lease));
+    for (size_t i = 0; i < shard_count_; ++i) {
+        Mutex::Locker locker(shards4_[i].mutex_);
+        const SearchIndex& idx = shards4_[i].storage_.get<0>();
+        for(SearchIndex::const_iterator lease = idx.begin();
+            lease != idx.end(); ++ lease) {
+
+            // client-id is not mandatory in DHCPv4. There can be a lease
+            // that does not have a client-id. Dereferencing null pointer
+            // would be a bad thing
+            if((*lease)->client_id_ && *(*lease)->client_id_ == client_id) {
+                collection.push_back(Lease4Ptr(new Lease4(**lease)));
+            }
         }
     }
 
@@ -194,12 +547,15 @@ Memfile_LeaseMgr::getLease4(const ClientId& client_id,
     // We define SearchIndex locally in this function because
     // currently only this function uses this index.
     typedef Lease4Storage::nth_index<3>::type SearchIndex;
-    // Get the index.
-    const SearchIndex& idx = storage4_.get<3>();
+    // Get the index of the partition holding the leases of the subnet.
+    Lease4Shard& shard = shards4_[getShard(subnet_id)];
+    Mutex::Locker locker(shard.mutex_);
+    const SearchIndex& idx = shard.storage_.get<3>();
     // Try to get the lease using client id, hardware address and subnet id.
     SearchIndex::const_iterator lease =
-        idx.find(boost::make_tuple(client_id.getClientId(), hwaddr.hwaddr_,
-                                   subnet_id));
+        idx.find(boost::tuple<const std::vector<uint8_t>&,
+                              const std::vector<uint8_t>&, SubnetID>(
+                     client_id.getClientId(), hwaddr.hwaddr_, subnet_id));
 
     if (lease == idx.end()) {
         // Lease was not found. Return empty pointer to the caller.
@@ -207,7 +563,7 @@ Memfile_LeaseMgr::getLease4(const ClientId& client_id,
     }
 
     // Lease was found. Return it to the caller.
-    return (*lease);
+    return (Lease4Ptr(new Lease4(**lease)));
 }
 
 Lease4Ptr
@@ -221,11 +577,14 @@ Memfile_LeaseMgr::getLease4(const ClientId& client_id,
     // We define SearchIndex locally in this function because
     // currently only this function uses this index.
     typedef Lease4Storage::nth_index<2>::type SearchIndex;
-    // Get the index.
-    const SearchIndex& idx = storage4_.get<2>();
+    // Get the index of the partition holding the leases of the subnet.
+    Lease4Shard& shard = shards4_[getShard(subnet_id)];
+    Mutex::Locker locker(shard.mutex_);
+    const SearchIndex& idx = shard.storage_.get<2>();
     // Try to get the lease using client id and subnet id.
     SearchIndex::const_iterator lease =
-        idx.find(boost::make_tuple(client_id.getClientId(), subnet_id));
+        idx.find(boost::tuple<const std::vector<uint8_t>&, SubnetID>(
+                     client_id.getClientId(), subnet_id));
     // Lease was not found. Return empty pointer to the caller.
     if (lease == idx.end()) {
         return (Lease4Ptr());
@@ -240,12 +599,16 @@ Memfile_LeaseMgr::getLease6(Lease::Type /* not used yet */,
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_MEMFILE_GET_ADDR6).arg(addr.toText());
 
-    Lease6Storage::iterator l = storage6_.find(addr);
-    if (l == storage6_.end()) {
-        return (Lease6Ptr());
-    } else {
-        return (Lease6Ptr(new Lease6(**l)));
+    // The subnet is not known, so look the lease up in each partition.
+    for (size_t i = 0; i < shard_count_; ++i) {
+        Mutex::Locker locker(shards6_[i].mutex_);
+        const Lease6Storage& storage = shards6_[i].storage_;
+        Lease6Storage::const_iterator l = storage.find(addr);
+        if (l != storage.end()) {
+            return (Lease6Ptr(new Lease6(**l)));
+        }
     }
+    return (Lease6Ptr());
 }
 
 Lease6Collection
@@ -271,11 +634,14 @@ Memfile_LeaseMgr::getLeases6(Lease::Type /* not used yet */,
     // We define SearchIndex locally in this function because
     // currently only this function uses this index.
     typedef Lease6Storage::nth_index<1>::type SearchIndex;
-    // Get the index.
-    const SearchIndex& idx = storage6_.get<1>();
+    // Get the index of the partition holding the leases of the subnet.
+    Lease6Shard& shard = shards6_[getShard(subnet_id)];
+    Mutex::Locker locker(shard.mutex_);
+    const SearchIndex& idx = shard.storage_.get<1>();
     // Try to get the lease using the DUID, IAID and Subnet ID.
     SearchIndex::const_iterator lease =
-        idx.find(boost::make_tuple(duid.getDuid(), iaid, subnet_id));
+        idx.find(boost::tuple<const std::vector<uint8_t>&, uint32_t, SubnetID>(
+                     duid.getDuid(), iaid, subnet_id));
     // Lease was not found. Return empty pointer.
     if (lease == idx.end()) {
         return (Lease6Collection());
@@ -288,25 +654,106 @@ Memfile_LeaseMgr::getLeases6(Lease::Type /* not used yet */,
     return (collection);
 }
 
+Lease6Collection
+Memfile_LeaseMgr::getLeases6(Lease::Type type) const {
+    LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
+              DHCPSRV_MEMFILE_GET_TYPE6).arg(type);
+
+    Lease6Collection collection;
+    for (size_t i = 0; i < shard_count_; ++i) {
+        Mutex::Locker locker(shards6_[i].mutex_);
+        const Lease6Storage& storage = shards6_[i].storage_;
+        for (Lease6Storage::const_iterator lease = storage.begin();
+             lease != storage.end(); ++lease) {
+            if ((*lease)->type_ == type) {
+                collection.push_back(Lease6Ptr(new Lease6(**lease)));
+            }
+        }
+    }
+    return (collection);
+}
+
+Lease4Collection
+Memfile_LeaseMgr::getExpiredLeases4(const size_t max_leases) const {
+    LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
+              DHCPSRV_MEMFILE_GET_EXPIRED4).arg(max_leases);
+
+    // We are going to use index #4 of the multi index container, which
+    // sorts the leases by expiration time.
+    Lease4Collection collection;
+    getExpiredLeases<4>(shards4_.get(), shard_count_, max_leases, collection);
+    return (collection);
+}
+
+Lease6Collection
+Memfile_LeaseMgr::getExpiredLeases6(const size_t max_leases) const {
+    LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
+              DHCPSRV_MEMFILE_GET_EXPIRED6).arg(max_leases);
+
+    // We are going to use index #2 of the multi index container, which
+    // sorts the leases by expiration time.
+    Lease6Collection collection;
+    getExpiredLeases<2>(shards6_.get(), shard_count_, max_leases, collection);
+    return (collection);
+}
+
 void
 Memfile_LeaseMgr::updateLease4(const Lease4Ptr& lease) {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_MEMFILE_UPDATE_ADDR4).arg(lease->addr_.toText());
 
-    Lease4Storage::iterator lease_it = storage4_.find(lease->addr_);
-    if (lease_it == storage4_.end()) {
-        bundy_throw(NoSuchLease, "failed to update the lease with address "
-                  << lease->addr_ << " - no such lease");
-    }
+    // The lease is held in the partition of its subnet, unless the update
+    // moves it to another subnet. Look there first.
+    const size_t target = getShard(lease->subnet_id_);
+    bool found = false;
+    for (size_t i = 0; (i < shard_count_) && !found; ++i) {
+        const size_t index = (target + i) % shard_count_;
+        Lease4Shard& shard = shards4_[index];
+        Lease4Shard& target_shard = shards4_[target];
+
+        // Moving the lease to another partition requires the locks of both
+        // partitions, which are taken in the order of their indexes.
+        Mutex::Locker locker(shards4_[std::min(index, target)].mutex_);
+        boost::scoped_ptr<Mutex::Locker> second_locker;
+        if (index != target) {
+            second_locker.reset(new Mutex::Locker(
+                shards4_[std::max(index, target)].mutex_));
+        }
 
-    // Try to write a lease to disk first. If this fails, the lease will
-    // not be inserted to the memory and the disk and in-memory data will
-    // remain consistent.
-    if (persistLeases(V4)) {
-        lease_file4_->append(*lease);
+        Lease4Storage::iterator lease_it = shard.storage_.find(lease->addr_);
+        if (lease_it == shard.storage_.end()) {
+            continue;
+        }
+        found = true;
+
+        // Try to write a lease to disk first. If this fails, the lease will
+        // not be inserted to the memory and the disk and in-memory data will
+        // remain consistent.
+        appendLease(V4, *lease);
+
+        // Replace the lease rather than assigning to the stored one, so as
+        // the container indexes, in particular the expiration time, are
+        // updated.
+        Lease4Ptr new_lease(new Lease4(*lease));
+        bool updated = false;
+        if (index == target) {
+            updated = shard.storage_.replace(lease_it, new_lease);
+        } else if (target_shard.storage_.insert(new_lease).second) {
+            shard.storage_.erase(lease_it);
+            updated = true;
+        }
+        if (!updated) {
+            bundy_throw(DbOperationError, "failed to update the lease with"
+                        " address " << lease->addr_ << " - the lease"
+                        " conflicts with another lease");
+        }
     }
 
-    **lease_it = *lease;
+    if (!found) {
+        bundy_throw(NoSuchLease, "failed to update the lease with address "
+                  << lease->addr_ << " - no such lease");
+    }
+    leasesWritten(V4);
 }
 
 void
@@ -314,66 +761,114 @@ Memfile_LeaseMgr::updateLease6(const Lease6Ptr& lease) {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_MEMFILE_UPDATE_ADDR6).arg(lease->addr_.toText());
 
-    Lease6Storage::iterator lease_it = storage6_.find(lease->addr_);
-    if (lease_it == storage6_.end()) {
-        bundy_throw(NoSuchLease, "failed to update the lease with address "
-                  << lease->addr_ << " - no such lease");
-    }
+    // The lease is held in the partition of its subnet, unless the update
+    // moves it to another subnet. Look there first.
+    const size_t target = getShard(lease->subnet_id_);
+    bool found = false;
+    for (size_t i = 0; (i < shard_count_) && !found; ++i) {
+        const size_t index = (target + i) % shard_count_;
+        Lease6Shard& shard = shards6_[index];
+        Lease6Shard& target_shard = shards6_[target];
+
+        // Moving the lease to another partition requires the locks of both
+        // partitions, which are taken in the order of their indexes.
+        Mutex::Locker locker(shards6_[std::min(index, target)].mutex_);
+        boost::scoped_ptr<Mutex::Locker> second_locker;
+        if (index != target) {
+            second_locker.reset(new Mutex::Locker(
+                shards6_[std::max(index, target)].mutex_));
+        }
 
-    // Try to write a lease to disk first. If this fails, the lease will
-    // not be inserted to the memory and the disk and in-memory data will
-    // remain consistent.
-    if (persistLeases(V6)) {
-        lease_file6_->append(*lease);
+        Lease6Storage::iterator lease_it = shard.storage_.find(lease->addr_);
+        if (lease_it == shard.storage_.end()) {
+            continue;
+        }
+        found = true;
+
+        // Try to write a lease to disk first. If this fails, the lease will
+        // not be inserted to the memory and the disk and in-memory data will
+        // remain consistent.
+        appendLease(V6, *lease);
+
+        // Replace the lease rather than assigning to the stored one, so as
+        // the container indexes, in particular the expiration time, are
+        // updated.
+        Lease6Ptr new_lease(new Lease6(*lease));
+        bool updated = false;
+        if (index == target) {
+            updated = shard.storage_.replace(lease_it, new_lease);
+        } else if (target_shard.storage_.insert(new_lease).second) {
+            shard.storage_.erase(lease_it);
+            updated = true;
+        }
+        if (!updated) {
+            bundy_throw(DbOperationError, "failed to update the lease with"
+                        " address " << lease->addr_ << " - the lease"
+                        " conflicts with another lease");
+        }
     }
 
-    **lease_it = *lease;
+    if (!found) {
+        bundy_throw(NoSuchLease, "failed to update the lease with address "
+                  << lease->addr_ << " - no such lease");
+    }
+    leasesWritten(V6);
 }
 
 bool
 Memfile_LeaseMgr::deleteLease(const bundy::asiolink::IOAddress& addr) {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_MEMFILE_DELETE_ADDR).arg(addr.toText());
+    // The subnet is not known, so look the lease up in each partition.
     if (addr.isV4()) {
         // v4 lease
-        Lease4Storage::iterator l = storage4_.find(addr);
-        if (l == storage4_.end()) {
-            // No such lease
-            return (false);
-        } else {
-            if (persistLeases(V4)) {
-                // Copy the lease. The valid lifetime needs to be modified and
-                // we don't modify the original lease.
-                Lease4 lease_copy = **l;
-                // Setting valid lifetime to 0 means that lease is being
-                // removed.
-                lease_copy.valid_lft_ = 0;
-                lease_file4_->append(lease_copy);
+        bool deleted = false;
+        for (size_t i = 0; (i < shard_count_) && !deleted; ++i) {
+            Mutex::Locker locker(shards4_[i].mutex_);
+            Lease4Storage& storage = shards4_[i].storage_;
+            Lease4Storage::iterator l = storage.find(addr);
+            if (l == storage.end()) {
+                continue;
             }
-            storage4_.erase(l);
-            return (true);
+            // Copy the lease. The valid lifetime needs to be modified and
+            // we don't modify the original lease.
+            Lease4 lease_copy = **l;
+            // Setting valid lifetime to 0 means that lease is being
+            // removed.
+            lease_copy.valid_lft_ = 0;
+            appendLease(V4, lease_copy);
+            storage.erase(l);
+            deleted = true;
         }
+        if (deleted) {
+            leasesWritten(V4);
+        }
+        return (deleted);
 
     } else {
         // v6 lease
-        Lease6Storage::iterator l = storage6_.find(addr);
-        if (l == storage6_.end()) {
-            // No such lease
-            return (false);
-        } else {
-            if (persistLeases(V6)) {
-                // Copy the lease. The lifetimes need to be modified and we
-                // don't modify the original lease.
-                Lease6 lease_copy = **l;
-                // Setting lifetimes to 0 means that lease is being removed.
-                lease_copy.valid_lft_ = 0;
-                lease_copy.preferred_lft_ = 0;
-                lease_file6_->append(lease_copy);
+        bool deleted = false;
+        for (size_t i = 0; (i < shard_count_) && !deleted; ++i) {
+            Mutex::Locker locker(shards6_[i].mutex_);
+            Lease6Storage& storage = shards6_[i].storage_;
+            Lease6Storage::iterator l = storage.find(addr);
+            if (l == storage.end()) {
+                continue;
             }
-
-            storage6_.erase(l);
-            return (true);
+            // Copy the lease. The lifetimes need to be modified and we
+            // don't modify the original lease.
+            Lease6 lease_copy = **l;
+            // Setting lifetimes to 0 means that lease is being removed.
+            lease_copy.valid_lft_ = 0;
+            lease_copy.preferred_lft_ = 0;
+            appendLease(V6, lease_copy);
+            storage.erase(l);
+            deleted = true;
+        }
+        if (deleted) {
+            leasesWritten(V6);
         }
+        return (deleted);
     }
 }
 
@@ -387,6 +882,33 @@ Memfile_LeaseMgr::getDescription() const {
 void
 Memfile_LeaseMgr::commit() {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL, DHCPSRV_MEMFILE_COMMIT);
+
+    // Outside of the group commit mode, each record is flushed as it is
+    // appended.
+    if (group_commit_ == 0) {
+        return;
+    }
+
+    sendToStandby();
+
+    Mutex::Locker locker(file_mutex_);
+    try {
+        if (lease_file4_) {
+            lease_file4_->sync();
+        }
+        if (lease_file6_) {
+            lease_file6_->sync();
+        }
+        if (binary_file4_) {
+            binary_file4_->sync();
+        }
+        if (binary_file6_) {
+            binary_file6_->sync();
+        }
+    } catch (const std::exception& ex) {
+        bundy_throw(DbOperationError, "failed to commit leases to the lease"
+                    " file: " << ex.what());
+    }
 }
 
 void
@@ -400,29 +922,320 @@ Memfile_LeaseMgr::getDefaultLeaseFilePath(Universe u) const {
     std::ostringstream s;
     s << CfgMgr::instance().getDataDir() << "/kea-leases";
     s << (u == V4 ? "4" : "6");
-    s << ".csv";
+    s << (binary_format_ ? ".bin" : ".csv");
     return (s.str());
 }
 
 std::string
 Memfile_LeaseMgr::getLeaseFilePath(Universe u) const {
     if (u == V4) {
+        if (binary_file4_) {
+            return (binary_file4_->getFilename());
+        }
         return (lease_file4_ ? lease_file4_->getFilename() : "");
     }
 
+    if (binary_file6_) {
+        return (binary_file6_->getFilename());
+    }
     return (lease_file6_ ? lease_file6_->getFilename() : "");
 }
 
+void
+Memfile_LeaseMgr::compactLeaseFile(Universe u) {
+    if (!persistLeases(u)) {
+        return;
+    }
+
+    size_t records = 0;
+    size_t leases = 0;
+    {
+        // No lease may be written while the file is replaced. The partitions
+        // are locked before the lease file, as in the functions which
+        // append leases.
+        if (u == V4) {
+            ShardsLocker shards_locker(shards4_.get(), shard_count_);
+            Mutex::Locker locker(file_mutex_);
+            records = records4_;
+            leases = binary_file4_ ?
+                replaceLeaseFile(binary_file4_, shards4_.get(), shard_count_,
+                                 group_commit_ == 0) :
+                replaceLeaseFile(lease_file4_, shards4_.get(), shard_count_,
+                                 group_commit_ == 0);
+            records4_ = leases;
+        } else {
+            ShardsLocker shards_locker(shards6_.get(), shard_count_);
+            Mutex::Locker locker(file_mutex_);
+            records = records6_;
+            leases = binary_file6_ ?
+                replaceLeaseFile(binary_file6_, shards6_.get(), shard_count_,
+                                 group_commit_ == 0) :
+                replaceLeaseFile(lease_file6_, shards6_.get(), shard_count_,
+                                 group_commit_ == 0);
+            records6_ = leases;
+        }
+    }
+
+    LOG_INFO(dhcpsrv_logger, DHCPSRV_MEMFILE_LFC_COMPLETE)
+        .arg(getLeaseFilePath(u)).arg(records).arg(leases);
+}
+
+size_t
+Memfile_LeaseMgr::getLeaseFileRecords(Universe u) const {
+    if (!persistLeases(u)) {
+        return (0);
+    }
+    Mutex::Locker locker(file_mutex_);
+    return (u == V4 ? records4_ : records6_);
+}
+
+void
+Memfile_LeaseMgr::appendLease(Universe u, const Lease& lease) {
+    if (!persistLeases(u) && !standby_) {
+        return;
+    }
+    // The rows of the leases held in the different partitions are
+    // appended to the same file.
+    Mutex::Locker locker(file_mutex_);
+    if (u == V4) {
+        const Lease4& lease4 = static_cast<const Lease4&>(lease);
+        if (lease_file4_) {
+            lease_file4_->append(lease4);
+            ++records4_;
+        } else if (binary_file4_) {
+            binary_file4_->append(lease4);
+            ++records4_;
+        }
+        if (standby_) {
+            standby_->append(stream_format4_->createRow(lease4));
+        }
+    } else {
+        const Lease6& lease6 = static_cast<const Lease6&>(lease);
+        if (lease_file6_) {
+            lease_file6_->append(lease6);
+            ++records6_;
+        } else if (binary_file6_) {
+            binary_file6_->append(lease6);
+            ++records6_;
+        }
+        if (standby_) {
+            standby_->append(stream_format6_->createRow(lease6));
+        }
+    }
+}
+
+void
+Memfile_LeaseMgr::leasesWritten(Universe u) {
+    // In the group commit mode the records are sent with the commit.
+    if (group_commit_ == 0) {
+        sendToStandby();
+    }
+    checkLeaseFileCompaction(u);
+}
+
+void
+Memfile_LeaseMgr::initLeaseStream(Universe u) {
+    // Unlike the other parameters, the stream parameters are optional.
+    LeaseMgr::ParameterMap stream;
+    const char* names[] = { "standby-address", "standby-port",
+                            "listen-address", "listen-port" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        try {
+            stream[names[i]] = getParameter(names[i]);
+        } catch (const Exception&) {
+            // Not specified.
+        }
+    }
+    if (stream.empty()) {
+        return;
+    }
+
+    if (u == V4) {
+        stream_format4_.reset(new CSVLeaseFile4(""));
+    } else {
+        stream_format6_.reset(new CSVLeaseFile6(""));
+    }
+    const CSVRow header = (u == V4 ? stream_format4_->getHeader() :
+                           stream_format6_->getHeader());
+
+    for (int standby = 1; standby >= 0; --standby) {
+        const std::string prefix = (standby ? "standby-" : "listen-");
+        if (!stream.count(prefix + "address") && !stream.count(prefix + "port")) {
+            continue;
+        }
+        if (!stream.count(prefix + "address") || !stream.count(prefix + "port")) {
+            bundy_throw(BadValue, "both '" << prefix << "address' and '"
+                        << prefix << "port' must be specified");
+        }
+        IOAddress address("::");
+        uint16_t port = 0;
+        try {
+            address = IOAddress(stream[prefix + "address"]);
+            port = boost::lexical_cast<uint16_t>(stream[prefix + "port"]);
+        } catch (const std::exception&) {
+            bundy_throw(BadValue, "invalid lease stream address '"
+                        << stream[prefix + "address"] << "' or port '"
+                        << stream[prefix + "port"] << "'");
+        }
+
+        if (standby) {
+            standby_.reset(new LeaseStreamSender(address, port, header));
+        } else {
+            primary_.reset(new LeaseStreamReceiver(address, port, header,
+                boost::bind(&Memfile_LeaseMgr::receiveLeases, this, _1, _2)));
+        }
+    }
+}
+
+void
+Memfile_LeaseMgr::sendToStandby() {
+    if (!standby_) {
+        return;
+    }
+
+    bool connected = false;
+    {
+        Mutex::Locker locker(file_mutex_);
+        connected = standby_->poll();
+    }
+    if (connected) {
+        // The standby server drops its leases when the stream starts, so
+        // it is sent all leases. The partitions are locked before the
+        // stream, as in the functions which append the leases. The leases
+        // written since the connection has been established may be sent
+        // twice, which is harmless.
+        if (universe_ == V4) {
+            ShardsLocker shards_locker(shards4_.get(), shard_count_);
+            Mutex::Locker locker(file_mutex_);
+            sendLeases(*standby_, *stream_format4_, shards4_.get(),
+                       shard_count_);
+        } else {
+            ShardsLocker shards_locker(shards6_.get(), shard_count_);
+            Mutex::Locker locker(file_mutex_);
+            sendLeases(*standby_, *stream_format6_, shards6_.get(),
+                       shard_count_);
+        }
+    }
+
+    Mutex::Locker locker(file_mutex_);
+    standby_->flush();
+}
+
+void
+Memfile_LeaseMgr::receiveLeases(const bool reset,
+                                const std::vector<CSVRow>& rows) {
+    {
+        // The whole batch is applied at once, under the locks of all
+        // partitions.
+        if (universe_ == V4) {
+            const std::vector<Lease4Ptr> leases =
+                parseLeases<Lease4Ptr>(*stream_format4_, rows);
+            ShardsLocker shards_locker(shards4_.get(), shard_count_);
+            Mutex::Locker locker(file_mutex_);
+            if (reset) {
+                for (size_t i = 0; i < shard_count_; ++i) {
+                    shards4_[i].storage_.clear();
+                }
+                if (lease_file4_) {
+                    lease_file4_->recreate();
+                } else if (binary_file4_) {
+                    binary_file4_->recreate();
+                }
+                records4_ = 0;
+            }
+            for (size_t i = 0; i < leases.size(); ++i) {
+                Lease4Ptr lease = leases[i];
+                loadLease4(lease);
+                if (lease_file4_) {
+                    lease_file4_->append(*lease);
+                    ++records4_;
+                } else if (binary_file4_) {
+                    binary_file4_->append(*lease);
+                    ++records4_;
+                }
+            }
+            if (lease_file4_) {
+                lease_file4_->flush();
+            } else if (binary_file4_) {
+                binary_file4_->flush();
+            }
+
+        } else {
+            const std::vector<Lease6Ptr> leases =
+                parseLeases<Lease6Ptr>(*stream_format6_, rows);
+            ShardsLocker shards_locker(shards6_.get(), shard_count_);
+            Mutex::Locker locker(file_mutex_);
+            if (reset) {
+                for (size_t i = 0; i < shard_count_; ++i) {
+                    shards6_[i].storage_.clear();
+                }
+                if (lease_file6_) {
+                    lease_file6_->recreate();
+                } else if (binary_file6_) {
+                    binary_file6_->recreate();
+                }
+                records6_ = 0;
+            }
+            for (size_t i = 0; i < leases.size(); ++i) {
+                Lease6Ptr lease = leases[i];
+                loadLease6(lease);
+                if (lease_file6_) {
+                    lease_file6_->append(*lease);
+                    ++records6_;
+                } else if (binary_file6_) {
+                    binary_file6_->append(*lease);
+                    ++records6_;
+                }
+            }
+            if (lease_file6_) {
+                lease_file6_->flush();
+            } else if (binary_file6_) {
+                binary_file6_->flush();
+            }
+        }
+    }
+    checkLeaseFileCompaction(universe_);
+}
+
+void
+Memfile_LeaseMgr::checkLeaseFileCompaction(Universe u) {
+    if ((lfc_threshold_ == 0) || !persistLeases(u)) {
+        return;
+    }
+
+    const size_t leases = (u == V4 ? countLeases(shards4_.get(), shard_count_) :
+                           countLeases(shards6_.get(), shard_count_));
+    if (getLeaseFileRecords(u) <= leases + lfc_threshold_) {
+        return;
+    }
+
+    try {
+        compactLeaseFile(u);
+
+    } catch (const std::exception& ex) {
+        LOG_ERROR(dhcpsrv_logger, DHCPSRV_MEMFILE_LFC_FAIL)
+            .arg(getLeaseFilePath(u)).arg(ex.what());
+        // Don't retry on each subsequent write. The next attempt is made
+        // when the file grows by another threshold worth of records.
+        Mutex::Locker locker(file_mutex_);
+        if (u == V4) {
+            records4_ = leases;
+        } else {
+            records6_ = leases;
+        }
+    }
+}
+
 bool
 Memfile_LeaseMgr::persistLeases(Universe u) const {
     // Currently, if the lease file IO is not created, it means that writes to
     // disk have been explicitly disabled by the administrator. At some point,
     // there may be a dedicated ON/OFF flag implemented to control this.
-    if (u == V4 && lease_file4_) {
-        return (true);
+    if (u == V4) {
+        return (lease_file4_ || binary_file4_);
     }
 
-    return (u == V6 && lease_file6_);
+    return (lease_file6_ || binary_file6_);
 }
 
 std::string
@@ -462,12 +1275,25 @@ Memfile_LeaseMgr::load4() {
         return;
     }
 
+    if (binary_file4_) {
+        loadLeaseFile4(*binary_file4_);
+    } else {
+        loadLeaseFile4(*lease_file4_);
+    }
+}
+
+template<typename LeaseFileType>
+void
+Memfile_LeaseMgr::loadLeaseFile4(LeaseFileType& lease_file) {
     LOG_INFO(dhcpsrv_logger, DHCPSRV_MEMFILE_LEASES_RELOAD4)
-        .arg(lease_file4_->getFilename());
+        .arg(lease_file.getFilename());
 
     // Remove existing leases (if any). We will recreate them based on the
     // data on disk.
-    storage4_.clear();
+    for (size_t i = 0; i < shard_count_; ++i) {
+        shards4_[i].storage_.clear();
+    }
+    records4_ = 0;
 
     Lease4Ptr lease;
     do {
@@ -475,9 +1301,9 @@ Memfile_LeaseMgr::load4() {
         /// that only one (or a few) leases are bad, so in theory we could
         /// continue parsing but that would require some error counters to
         /// prevent endless loops. That is enhancement for later time.
-        if (!lease_file4_->next(lease)) {
+        if (!lease_file.next(lease)) {
             bundy_throw(DbOperationError, "Failed to parse the DHCPv6 lease in"
-                      " the lease file: " << lease_file4_->getReadMsg());
+                      " the lease file: " << lease_file.getReadMsg());
         }
         // If we got the lease, we update the internal container holding
         // leases. Otherwise, we reached the end of file and we leave.
@@ -486,33 +1312,27 @@ Memfile_LeaseMgr::load4() {
                       DHCPSRV_MEMFILE_LEASE_LOAD4)
                 .arg(lease->toText());
             loadLease4(lease);
+            ++records4_;
         }
     } while (lease);
 }
 
 void
 Memfile_LeaseMgr::loadLease4(Lease4Ptr& lease) {
-    // Check if the lease already exists.
-    Lease4Storage::iterator lease_it = storage4_.find(lease->addr_);
-    // Lease doesn't exist.
-    if (lease_it == storage4_.end()) {
-        // Add the lease only if valid lifetime is greater than 0.
-        // We use valid lifetime of 0 to indicate that lease should
-        // be removed.
-        if (lease->valid_lft_ > 0) {
-           storage4_.insert(lease);
-       }
-    } else {
-        // We use valid lifetime of 0 to indicate that the lease is
-        // to be removed. In such case, erase the lease.
-        if (lease->valid_lft_ == 0) {
-            storage4_.erase(lease_it);
-
-        } else {
-            // Update existing lease.
-            **lease_it = *lease;
+    // The lease may have moved to another subnet, i.e. to another partition.
+    // Remove the existing lease (if any) from all partitions.
+    for (size_t i = 0; i < shard_count_; ++i) {
+        Lease4Storage& storage = shards4_[i].storage_;
+        Lease4Storage::iterator lease_it = storage.find(lease->addr_);
+        if (lease_it != storage.end()) {
+            storage.erase(lease_it);
         }
     }
+    // Add the lease only if valid lifetime is greater than 0. We use valid
+    // lifetime of 0 to indicate that lease should be removed.
+    if (lease->valid_lft_ > 0) {
+        shards4_[getShard(lease->subnet_id_)].storage_.insert(lease);
+    }
 }
 
 void
@@ -523,12 +1343,25 @@ Memfile_LeaseMgr::load6() {
         return;
     }
 
+    if (binary_file6_) {
+        loadLeaseFile6(*binary_file6_);
+    } else {
+        loadLeaseFile6(*lease_file6_);
+    }
+}
+
+template<typename LeaseFileType>
+void
+Memfile_LeaseMgr::loadLeaseFile6(LeaseFileType& lease_file) {
     LOG_INFO(dhcpsrv_logger, DHCPSRV_MEMFILE_LEASES_RELOAD6)
-        .arg(lease_file6_->getFilename());
+        .arg(lease_file.getFilename());
 
     // Remove existing leases (if any). We will recreate them based on the
     // data on disk.
-    storage6_.clear();
+    for (size_t i = 0; i < shard_count_; ++i) {
+        shards6_[i].storage_.clear();
+    }
+    records6_ = 0;
 
     Lease6Ptr lease;
     do {
@@ -536,9 +1369,9 @@ Memfile_LeaseMgr::load6() {
         /// that only one (or a few) leases are bad, so in theory we could
         /// continue parsing but that would require some error counters to
         /// prevent endless loops. That is enhancement for later time.
-        if (!lease_file6_->next(lease)) {
+        if (!lease_file.next(lease)) {
             bundy_throw(DbOperationError, "Failed to parse the DHCPv6 lease in"
-                      " the lease file: " << lease_file6_->getReadMsg());
+                      " the lease file: " << lease_file.getReadMsg());
         }
         // If we got the lease, we update the internal container holding
         // leases. Otherwise, we reached the end of file and we leave.
@@ -548,33 +1381,26 @@ Memfile_LeaseMgr::load6() {
                 .arg(lease->toText());
 
             loadLease6(lease);
+            ++records6_;
         }
     } while (lease);
 }
 
 void
 Memfile_LeaseMgr::loadLease6(Lease6Ptr& lease) {
-    // Check if the lease already exists.
-    Lease6Storage::iterator lease_it = storage6_.find(lease->addr_);
-    // Lease doesn't exist.
-    if (lease_it == storage6_.end()) {
-        // Add the lease only if valid lifetime is greater than 0.
-        // We use valid lifetime of 0 to indicate that lease should
-        // be removed.
-        if (lease->valid_lft_ > 0) {
-            storage6_.insert(lease);
-       }
-    } else {
-        // We use valid lifetime of 0 to indicate that the lease is
-        // to be removed. In such case, erase the lease.
-        if (lease->valid_lft_ == 0) {
-            storage6_.erase(lease_it);
-
-        } else {
-            // Update existing lease.
-            **lease_it = *lease;
+    // The lease may have moved to another subnet, i.e. to another partition.
+    // Remove the existing lease (if any) from all partitions.
+    for (size_t i = 0; i < shard_count_; ++i) {
+        Lease6Storage& storage = shards6_[i].storage_;
+        Lease6Storage::iterator lease_it = storage.find(lease->addr_);
+        if (lease_it != storage.end()) {
+            storage.erase(lease_it);
         }
     }
-
+    // Add the lease only if valid lifetime is greater than 0. We use valid
+    // lifetime of 0 to indicate that lease should be removed.
+    if (lease->valid_lft_ > 0) {
+        shards6_[getShard(lease->subnet_id_)].storage_.insert(lease);
+    }
 }
 
@@ -16,15 +16,22 @@
 #define MEMFILE_LEASE_MGR_H
 
 #include <dhcp/hwaddr.h>
+#include <dhcpsrv/binary_lease_file.h>
 #include <dhcpsrv/csv_lease_file4.h>
 #include <dhcpsrv/csv_lease_file6.h>
 #include <dhcpsrv/lease_mgr.h>
+#include <dhcpsrv/lease_stream.h>
+#include <util/threads/sync.h>
 
+#include <boost/functional/hash.hpp>
+#include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/indexed_by.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/composite_key.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/scoped_ptr.hpp>
 
 namespace bundy {
 namespace dhcp {
@@ -53,7 +60,36 @@ namespace dhcp {
 ///
 /// After the container holding leases is initialized, each subsequent update,
 /// removal or addition of the lease is appended to the lease file
-/// synchronously.
+/// synchronously. When the "group-commit=[n]" parameter is specified with
+/// a non-zero value, the appended records are buffered and the lease file is
+/// flushed and synchronized with the disk once for the whole batch, when the
+/// @c commit function is called.
+///
+/// Since the records are only appended, the lease file grows with every lease
+/// update, even if the number of leases doesn't. The "lfc-threshold=[n]"
+/// parameter enables the lease file cleanup (LFC) which rewrites the lease
+/// file when it holds more than n records in excess of the leases held
+/// in memory. The cleanup writes a snapshot of the leases held in memory to
+/// a temporary file and then renames it over the lease file, so the lease
+/// file is replaced atomically. The cleanup is also run after the leases
+/// have been loaded if the lease file exceeds the threshold. Cleanup is
+/// disabled by default.
+///
+/// The leases held in memory are partitioned by subnet ID into the number
+/// of partitions given by the "shards=[n]" parameter, 1 by default. Each
+/// partition has its own lock and indexes, so the lookups for different
+/// subnets don't contend. The lookups for a client in a subnet go to a
+/// single partition, while the lookups by address only, or by client only,
+/// are made in each partition in turn. Adding a lease locks all partitions,
+/// as the address must not be leased in any of them. All partitions share
+/// the lease file, which has its own lock.
+///
+/// With the "format=binary" parameter, the lease file holds the leases in
+/// binary records rather than in CSV rows (see @c BinaryLeaseFile4 and
+/// @c BinaryLeaseFile6), which are about half the size and don't have to
+/// be parsed when the leases are loaded. The existing lease files can be
+/// converted between the formats with @c convertLeaseFile. The lease stream
+/// uses the CSV rows in either case.
 ///
 /// Originally, the Memfile backend didn't write leases to disk. This was
 /// particularly useful for testing server performance in non-disk bound
@@ -62,12 +98,28 @@ namespace dhcp {
 /// For example, database access string: "type=memfile persist=true"
 /// enables writes of leases to a disk.
 ///
+/// The changes of the leases can be streamed to a standby server, which
+/// holds the same leases in memory and takes over without reading them from
+/// a file. The "standby-address=[address]" and "standby-port=[port]"
+/// parameters specify where the standby server listens, and the
+/// "listen-address=[address]" and "listen-port=[port]" parameters make the
+/// standby server listen there. The records appended to the lease file are
+/// sent as they are written, or on @c commit in the group commit mode,
+/// without waiting for the standby server (see @c LeaseStreamSender). Each
+/// connection starts with the records of all leases, so the standby server
+/// may be started, or reconnect, at any time. The standby server applies
+/// the records it receives in batches and appends them to its own lease
+/// file. The leases written by other servers to the standby server are not
+/// sent back, so only one server of the pair should allocate the leases at
+/// a time.
+///
 /// The lease file locations can be specified with the "name=[path]"
 /// parameter in the database access string. The [path] is the
 /// absolute path to the file (including file name). If this parameter
 /// is not specified, the default location in the installation
 /// directory is used: var/bundy/kea-leases4.csv and
-/// var/bundy/kea-leases6.csv.
+/// var/bundy/kea-leases6.csv, or var/bundy/kea-leases4.bin and
+/// var/bundy/kea-leases6.bin for the binary format.
 class Memfile_LeaseMgr : public LeaseMgr {
 public:
 
@@ -90,6 +142,12 @@ public:
     ///
     /// @param parameters A data structure relating keywords and values
     ///        concerned with the database.
+    ///
+    /// @throw bundy::BadValue If the "persist", "group-commit",
+    ///        "lfc-threshold", "shards", "format" or a lease stream parameter
+    ///        has an invalid value.
+    /// @throw DbOperationError If the server can't listen for the lease
+    ///        stream.
     Memfile_LeaseMgr(const ParameterMap& parameters);
 
     /// @brief Destructor (closes file)
@@ -216,6 +274,41 @@ public:
     virtual Lease6Collection getLeases6(Lease::Type type, const DUID& duid,
                                         uint32_t iaid, SubnetID subnet_id) const;
 
+    /// @brief Returns all IPv6 leases of a given type.
+    ///
+    /// This function returns copies of the leases.
+    ///
+    /// @param type specifies lease type: (NA, TA or PD)
+    ///
+    /// @return lease collection (may be empty if no lease is found)
+    virtual Lease6Collection getLeases6(Lease::Type type) const;
+
+    /// @brief Returns a collection of expired IPv4 leases.
+    ///
+    /// The leases are found using the index which sorts them by expiration
+    /// time, so the cost of this function depends on the number of expired
+    /// leases returned rather than on the total number of leases.
+    ///
+    /// This function returns copies of the leases. The modification in the
+    /// returned leases does not affect the instances held in the lease
+    /// storage.
+    ///
+    /// @param max_leases Maximum number of leases to be returned, 0 if all
+    ///        expired leases should be returned.
+    ///
+    /// @return Collection of expired leases, ordered by expiration time.
+    virtual Lease4Collection getExpiredLeases4(const size_t max_leases) const;
+
+    /// @brief Returns a collection of expired IPv6 leases.
+    ///
+    /// See @c Memfile_LeaseMgr::getExpiredLeases4 for details.
+    ///
+    /// @param max_leases Maximum number of leases to be returned, 0 if all
+    ///        expired leases should be returned.
+    ///
+    /// @return Collection of expired leases, ordered by expiration time.
+    virtual Lease6Collection getExpiredLeases6(const size_t max_leases) const;
+
     /// @brief Updates IPv4 lease.
     ///
     /// @warning This function does not validate the pointer to the lease.
@@ -289,6 +382,39 @@ public:
     /// support transactions, this is a no-op.
     virtual void rollback();
 
+    /// @brief Returns the group commit size.
+    ///
+    /// @return Value of the "group-commit" parameter, see
+    ///         @c LeaseMgr::getGroupCommit.
+    virtual size_t getGroupCommit() const {
+        return (group_commit_);
+    }
+
+    /// @brief Rewrites the lease file with the leases held in memory.
+    ///
+    /// This function writes all leases held in memory for the specified
+    /// universe to a new file and replaces the lease file with it. It is
+    /// called automatically when the "lfc-threshold" parameter is set, but
+    /// it may be also called explicitly. It is a no-op if leases for the
+    /// specified universe are not written to disk.
+    ///
+    /// @param u Universe (V4 or V6).
+    ///
+    /// @throw DbOperationError If the lease file could not be replaced. In
+    /// such case the original lease file is left intact.
+    void compactLeaseFile(Universe u);
+
+    /// @brief Returns the number of lease records in the lease file.
+    ///
+    /// This includes the records which have been superseded by subsequent
+    /// updates of the leases and which will be removed when the lease file
+    /// is compacted.
+    ///
+    /// @param u Universe (V4 or V6).
+    ///
+    /// @return Number of records or 0 if no lease file is used.
+    size_t getLeaseFileRecords(Universe u) const;
+
     /// @brief Returns default path to the lease file.
     ///
     /// @param u Universe (V4 or V6).
@@ -326,6 +452,15 @@ protected:
     /// file.
     void load4();
 
+    /// @brief Loads all DHCPv4 leases from the given lease file.
+    ///
+    /// @param lease_file The lease file of the leases.
+    ///
+    /// @tparam LeaseFileType One of the @c CSVLeaseFile4 or
+    /// @c BinaryLeaseFile4.
+    template<typename LeaseFileType>
+    void loadLeaseFile4(LeaseFileType& lease_file);
+
     /// @brief Loads a single DHCPv4 lease from the file.
     ///
     /// This method reads a single lease record from the lease file. If the
@@ -348,6 +483,15 @@ protected:
     /// file.
     void load6();
 
+    /// @brief Loads all DHCPv6 leases from the given lease file.
+    ///
+    /// @param lease_file The lease file of the leases.
+    ///
+    /// @tparam LeaseFileType One of the @c CSVLeaseFile6 or
+    /// @c BinaryLeaseFile6.
+    template<typename LeaseFileType>
+    void loadLeaseFile6(LeaseFileType& lease_file);
+
     /// @brief Loads a single DHCPv6 lease from the file.
     ///
     /// This method reads a single lease record from the lease file. If the
@@ -380,6 +524,53 @@ protected:
     /// argument to this function.
     std::string initLeaseFilePath(Universe u);
 
+    /// @brief Compacts the lease file if it exceeds the LFC threshold.
+    ///
+    /// This function is called whenever the record is appended to the lease
+    /// file. If the cleanup fails, the error is logged and the lease file
+    /// continues to be used as it is.
+    ///
+    /// @param u Universe (V4 or V6).
+    void checkLeaseFileCompaction(Universe u);
+
+    /// @brief Appends a lease record to the lease file.
+    ///
+    /// The record is also appended to the stream to the standby server.
+    ///
+    /// @param u Universe (V4 or V6).
+    /// @param lease Lease to be written, of the type matching the universe.
+    void appendLease(Universe u, const Lease& lease);
+
+    /// @brief Handles the lease records appended by a lease write.
+    ///
+    /// Sends the records to the standby server, unless they are sent on
+    /// commit, and compacts the lease file if it exceeds the LFC threshold.
+    ///
+    /// @param u Universe (V4 or V6).
+    void leasesWritten(Universe u);
+
+    /// @brief Creates the lease stream to or from the other server.
+    ///
+    /// @param u Universe (V4 or V6).
+    void initLeaseStream(Universe u);
+
+    /// @brief Sends the appended lease records to the standby server.
+    ///
+    /// If the connection to the standby server has just been established,
+    /// the records of all leases are sent first.
+    void sendToStandby();
+
+    /// @brief Applies the lease records received from the primary server.
+    ///
+    /// The leases are loaded as they are from the lease file, and appended
+    /// to the lease file.
+    ///
+    /// @param reset Whether a new stream starts with the records, in which
+    /// case the leases held are dropped and the lease file is recreated.
+    /// @param rows Lease records.
+    void receiveLeases(const bool reset,
+                       const std::vector<util::CSVRow>& rows);
+
     // This is a multi-index container, which holds elements that can
     // be accessed using different search indexes.
     typedef boost::multi_index_container<
@@ -394,7 +585,10 @@ protected:
             >,
 
             // Specification of the second index starts here.
-            boost::multi_index::ordered_unique<
+            // The leases are only looked up by the complete key, so the
+            // index is hashed rather than ordered: this avoids comparing
+            // the DUIDs at each level of a tree.
+            boost::multi_index::hashed_unique<
                 // This is a composite index that will be used to search for
                 // the lease using three attributes: DUID, IAID, Subnet Id.
                 boost::multi_index::composite_key<
@@ -408,6 +602,14 @@ protected:
                     boost::multi_index::member<Lease6, uint32_t, &Lease6::iaid_>,
                     boost::multi_index::member<Lease, SubnetID, &Lease::subnet_id_>
                 >
+            >,
+
+            // Specification of the third index starts here.
+            // This index sorts leases by their expiration time, so as the
+            // expired leases can be found without iterating over all leases.
+            boost::multi_index::ordered_non_unique<
+                boost::multi_index::const_mem_fun<Lease, int64_t,
+                                                  &Lease::getExpirationTime>
             >
         >
      > Lease6Storage; // Specify the type name of this container.
@@ -429,7 +631,11 @@ protected:
             >,
 
             // Specification of the second index starts here.
-            boost::multi_index::ordered_unique<
+            // The leases are only looked up by the complete keys of this
+            // and the next two indexes, so these indexes are hashed rather
+            // than ordered: this avoids comparing the hardware addresses
+            // and client identifiers at each level of a tree.
+            boost::multi_index::hashed_unique<
                 // This is a composite index that combines two attributes of the
                 // Lease4 object: hardware address and subnet id.
                 boost::multi_index::composite_key<
@@ -447,7 +653,7 @@ protected:
             >,
 
             // Specification of the third index starts here.
-            boost::multi_index::ordered_non_unique<
+            boost::multi_index::hashed_non_unique<
                 // This is a composite index that uses two values to search for a
                 // lease: client id and subnet id.
                 boost::multi_index::composite_key<
@@ -462,7 +668,7 @@ protected:
             >,
 
             // Specification of the fourth index starts here.
-            boost::multi_index::ordered_non_unique<
+            boost::multi_index::hashed_non_unique<
                 // This is a composite index that uses two values to search for a
                 // lease: client id and subnet id.
                 boost::multi_index::composite_key<
@@ -478,15 +684,55 @@ protected:
                     // The subnet id is accessed through the subnet_id_ member.
                     boost::multi_index::member<Lease, SubnetID, &Lease::subnet_id_>
                 >
+            >,
+
+            // Specification of the fifth index starts here.
+            // This index sorts leases by their expiration time, so as the
+            // expired leases can be found without iterating over all leases.
+            boost::multi_index::ordered_non_unique<
+                boost::multi_index::const_mem_fun<Lease, int64_t,
+                                                  &Lease::getExpirationTime>
             >
         >
     > Lease4Storage; // Specify the type name for this container.
 
-    /// @brief stores IPv4 leases
-    Lease4Storage storage4_;
+    /// @brief A partition of the leases.
+    ///
+    /// @tparam StorageType Container holding the leases of the partition.
+    template<typename StorageType>
+    struct LeaseShard {
+        /// @brief Type of the container holding the leases.
+        typedef StorageType Storage;
+
+        /// @brief The leases of the partition.
+        StorageType storage_;
+
+        /// @brief Lock protecting the leases of the partition.
+        bundy::util::thread::Mutex mutex_;
+    };
+
+    typedef LeaseShard<Lease4Storage> Lease4Shard;
+    typedef LeaseShard<Lease6Storage> Lease6Shard;
+
+    /// @brief Returns the index of the partition holding the leases of
+    /// a subnet.
+    ///
+    /// @param subnet_id Subnet identifier.
+    size_t getShard(const SubnetID subnet_id) const {
+        return (subnet_id % shard_count_);
+    }
+
+    /// @brief Number of partitions of the leases.
+    size_t shard_count_;
 
-    /// @brief stores IPv6 leases
-    Lease6Storage storage6_;
+    /// @brief Partitions of the IPv4 leases.
+    boost::scoped_array<Lease4Shard> shards4_;
+
+    /// @brief Partitions of the IPv6 leases.
+    boost::scoped_array<Lease6Shard> shards6_;
+
+    /// @brief Lock protecting the lease files and their record counts.
+    mutable bundy::util::thread::Mutex file_mutex_;
 
     /// @brief Holds the pointer to the DHCPv4 lease file IO.
     boost::shared_ptr<CSVLeaseFile4> lease_file4_;
@@ -494,6 +740,50 @@ protected:
     /// @brief Holds the pointer to the DHCPv6 lease file IO.
     boost::shared_ptr<CSVLeaseFile6> lease_file6_;
 
+    /// @brief Holds the pointer to the binary DHCPv4 lease file, used
+    /// instead of @c lease_file4_ for the binary format.
+    boost::shared_ptr<BinaryLeaseFile4> binary_file4_;
+
+    /// @brief Holds the pointer to the binary DHCPv6 lease file, used
+    /// instead of @c lease_file6_ for the binary format.
+    boost::shared_ptr<BinaryLeaseFile6> binary_file6_;
+
+    /// @brief Whether the lease file is in the binary format, set by the
+    /// "format" parameter.
+    bool binary_format_;
+
+    /// @brief Number of records in the DHCPv4 lease file.
+    size_t records4_;
+
+    /// @brief Number of records in the DHCPv6 lease file.
+    size_t records6_;
+
+    /// @brief Group commit size.
+    size_t group_commit_;
+
+    /// @brief Number of obsolete records which triggers the lease file
+    /// cleanup, 0 if the cleanup is disabled.
+    size_t lfc_threshold_;
+
+    /// @brief Universe of the leases, set by the "universe" parameter.
+    Universe universe_;
+
+    /// @brief Converts the IPv4 leases to and from the records of the
+    /// lease stream.
+    boost::scoped_ptr<CSVLeaseFile4> stream_format4_;
+
+    /// @brief Converts the IPv6 leases to and from the records of the
+    /// lease stream.
+    boost::scoped_ptr<CSVLeaseFile6> stream_format6_;
+
+    /// @brief Stream of the lease records to the standby server, NULL if
+    /// none is configured.
+    boost::scoped_ptr<LeaseStreamSender> standby_;
+
+    /// @brief Stream of the lease records from the primary server, NULL if
+    /// this is not a standby server.
+    boost::scoped_ptr<LeaseStreamReceiver> primary_;
+
 };
 
 }; // end of bundy::dhcp namespace
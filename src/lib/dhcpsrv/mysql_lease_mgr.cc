@@ -25,6 +25,7 @@
 
 #include <iostream>
 #include <iomanip>
+#include <limits>
 #include <sstream>
 #include <string>
 #include <time.h>
@@ -112,6 +113,18 @@ const size_t HOSTNAME_MAX_LEN = 255;
 
 ///@}
 
+/// @brief Returns the value for the LIMIT clause of the expired leases query.
+///
+/// @param max_leases Maximum number of leases, 0 meaning no limit.
+uint32_t
+getExpiredLeasesLimit(const size_t max_leases) {
+    if ((max_leases == 0) ||
+        (max_leases > std::numeric_limits<uint32_t>::max())) {
+        return (std::numeric_limits<uint32_t>::max());
+    }
+    return (static_cast<uint32_t>(max_leases));
+}
+
 /// @brief MySQL Selection Statements
 ///
 /// Each statement is associated with an index, which is used to reference the
@@ -145,6 +158,14 @@ TaggedStatement tagged_statements[] = {
                         "fqdn_fwd, fqdn_rev, hostname "
                             "FROM lease4 "
                             "WHERE client_id = ? AND subnet_id = ?"},
+    {MySqlLeaseMgr::GET_LEASE4_EXPIRE,
+                    "SELECT address, hwaddr, client_id, "
+                        "valid_lifetime, expire, subnet_id, "
+                        "fqdn_fwd, fqdn_rev, hostname "
+                            "FROM lease4 "
+                            "WHERE expire < ? "
+                            "ORDER BY expire "
+                            "LIMIT ?"},
     {MySqlLeaseMgr::GET_LEASE4_HWADDR,
                     "SELECT address, hwaddr, client_id, "
                         "valid_lifetime, expire, subnet_id, "
@@ -179,6 +200,22 @@ TaggedStatement tagged_statements[] = {
                             "FROM lease6 "
                             "WHERE duid = ? AND iaid = ? AND subnet_id = ? "
                             "AND lease_type = ?"},
+    {MySqlLeaseMgr::GET_LEASE6_EXPIRE,
+                    "SELECT address, duid, valid_lifetime, "
+                        "expire, subnet_id, pref_lifetime, "
+                        "lease_type, iaid, prefix_len, "
+                        "fqdn_fwd, fqdn_rev, hostname "
+                            "FROM lease6 "
+                            "WHERE expire < ? "
+                            "ORDER BY expire "
+                            "LIMIT ?"},
+    {MySqlLeaseMgr::GET_LEASE6_TYPE,
+                    "SELECT address, duid, valid_lifetime, "
+                        "expire, subnet_id, pref_lifetime, "
+                        "lease_type, iaid, prefix_len, "
+                        "fqdn_fwd, fqdn_rev, hostname "
+                            "FROM lease6 "
+                            "WHERE lease_type = ?"},
     {MySqlLeaseMgr::GET_VERSION,
                     "SELECT version, minor FROM schema_version"},
     {MySqlLeaseMgr::INSERT_LEASE4,
@@ -1102,17 +1139,24 @@ private:
 // MySqlLeaseMgr Constructor and Destructor
 
 MySqlLeaseMgr::MySqlLeaseMgr(const LeaseMgr::ParameterMap& parameters)
-    : LeaseMgr(parameters) {
+    : LeaseMgr(parameters), group_commit_(getGroupCommitParameter()),
+      query_transaction_(false), in_transaction_(false) {
+
+    // Create the cache of the lease4 lookups if it is configured.
+    cache4_.reset(new Lease4Cache(getCacheSizeParameter()));
 
     // Open the database.
     openDatabase();
 
-    // Enable autocommit.  To avoid a flush to disk on every commit, the global
-    // parameter innodb_flush_log_at_trx_commit should be set to 2.  This will
-    // cause the changes to be written to the log, but flushed to disk in the
-    // background every second.  Setting the parameter to that value will speed
-    // up the system, but at the risk of losing data if the system crashes.
-    my_bool result = mysql_autocommit(mysql_, 1);
+    // Enable autocommit unless the writes are group committed.  To avoid a
+    // flush to disk on every commit, the global parameter
+    // innodb_flush_log_at_trx_commit should be set to 2.  This will cause the
+    // changes to be written to the log, but flushed to disk in the background
+    // every second.  Setting the parameter to that value will speed up the
+    // system, but at the risk of losing data if the system crashes.  Group
+    // commit keeps the writes durable while making a single flush for the
+    // writes of several queries.
+    my_bool result = mysql_autocommit(mysql_, group_commit_ == 0 ? 1 : 0);
     if (result != 0) {
         bundy_throw(DbOperationError, mysql_error(mysql_));
     }
@@ -1339,6 +1383,8 @@ bool
 MySqlLeaseMgr::addLeaseCommon(StatementIndex stindex,
                               std::vector<MYSQL_BIND>& bind) {
 
+    startTransaction();
+
     // Bind the parameters to the statement
     int status = mysql_stmt_bind_param(statements_[stindex], &bind[0]);
     checkError(status, stindex, "unable to bind parameters");
@@ -1369,7 +1415,11 @@ MySqlLeaseMgr::addLease(const Lease4Ptr& lease) {
     std::vector<MYSQL_BIND> bind = exchange4_->createBindForSend(lease);
 
     // ... and drop to common code.
-    return (addLeaseCommon(INSERT_LEASE4, bind));
+    if (!addLeaseCommon(INSERT_LEASE4, bind)) {
+        return (false);
+    }
+    cache4_->update(lease);
+    return (true);
 }
 
 bool
@@ -1570,6 +1620,12 @@ MySqlLeaseMgr::getLease4(const HWAddr& hwaddr, SubnetID subnet_id) const {
               DHCPSRV_MYSQL_GET_SUBID_HWADDR)
         .arg(subnet_id).arg(hwaddr.toText());
 
+    Lease4Ptr result;
+    if (cache4_->get(Lease4Cache::HWADDR, hwaddr.hwaddr_, subnet_id,
+                     result)) {
+        return (result);
+    }
+
     // Set up the WHERE clause value
     MYSQL_BIND inbind[2];
     memset(inbind, 0, sizeof(inbind));
@@ -1592,8 +1648,8 @@ MySqlLeaseMgr::getLease4(const HWAddr& hwaddr, SubnetID subnet_id) const {
     inbind[1].is_unsigned = MLM_TRUE;
 
     // Get the data
-    Lease4Ptr result;
     getLease(GET_LEASE4_HWADDR_SUBID, inbind, result);
+    cache4_->put(Lease4Cache::HWADDR, hwaddr.hwaddr_, subnet_id, result);
 
     return (result);
 }
@@ -1638,6 +1694,12 @@ MySqlLeaseMgr::getLease4(const ClientId& clientid, SubnetID subnet_id) const {
               DHCPSRV_MYSQL_GET_SUBID_CLIENTID)
               .arg(subnet_id).arg(clientid.toText());
 
+    Lease4Ptr result;
+    if (cache4_->get(Lease4Cache::CLIENT_ID, clientid.getClientId(),
+                     subnet_id, result)) {
+        return (result);
+    }
+
     // Set up the WHERE clause value
     MYSQL_BIND inbind[2];
     memset(inbind, 0, sizeof(inbind));
@@ -1654,8 +1716,8 @@ MySqlLeaseMgr::getLease4(const ClientId& clientid, SubnetID subnet_id) const {
     inbind[1].is_unsigned = MLM_TRUE;
 
     // Get the data
-    Lease4Ptr result;
     getLease(GET_LEASE4_CLIENTID_SUBID, inbind, result);
+    cache4_->put(Lease4Cache::CLIENT_ID, client_data, subnet_id, result);
 
     return (result);
 }
@@ -1787,6 +1849,83 @@ MySqlLeaseMgr::getLeases6(Lease::Type lease_type,
     return (result);
 }
 
+Lease6Collection
+MySqlLeaseMgr::getLeases6(Lease::Type lease_type) const {
+    LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
+              DHCPSRV_MYSQL_GET_TYPE6).arg(lease_type);
+
+    // Set up the WHERE clause value
+    MYSQL_BIND inbind[1];
+    memset(inbind, 0, sizeof(inbind));
+
+    // LEASE_TYPE
+    inbind[0].buffer_type = MYSQL_TYPE_TINY;
+    inbind[0].buffer = reinterpret_cast<char*>(&lease_type);
+    inbind[0].is_unsigned = MLM_TRUE;
+
+    // ... and get the data
+    Lease6Collection result;
+    getLeaseCollection(GET_LEASE6_TYPE, inbind, result);
+
+    return (result);
+}
+
+Lease4Collection
+MySqlLeaseMgr::getExpiredLeases4(const size_t max_leases) const {
+    LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
+              DHCPSRV_MYSQL_GET_EXPIRED4).arg(max_leases);
+
+    // Set up the WHERE and LIMIT clause values
+    MYSQL_BIND inbind[2];
+    memset(inbind, 0, sizeof(inbind));
+
+    // Leases which expire before the current time are expired.
+    MYSQL_TIME expire;
+    convertToDatabaseTime(time(NULL), 0, expire);
+    inbind[0].buffer_type = MYSQL_TYPE_TIMESTAMP;
+    inbind[0].buffer = reinterpret_cast<char*>(&expire);
+    inbind[0].buffer_length = sizeof(expire);
+
+    uint32_t limit = getExpiredLeasesLimit(max_leases);
+    inbind[1].buffer_type = MYSQL_TYPE_LONG;
+    inbind[1].buffer = reinterpret_cast<char*>(&limit);
+    inbind[1].is_unsigned = MLM_TRUE;
+
+    // ... and get the data
+    Lease4Collection result;
+    getLeaseCollection(GET_LEASE4_EXPIRE, inbind, result);
+
+    return (result);
+}
+
+Lease6Collection
+MySqlLeaseMgr::getExpiredLeases6(const size_t max_leases) const {
+    LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
+              DHCPSRV_MYSQL_GET_EXPIRED6).arg(max_leases);
+
+    // Set up the WHERE and LIMIT clause values
+    MYSQL_BIND inbind[2];
+    memset(inbind, 0, sizeof(inbind));
+
+    // Leases which expire before the current time are expired.
+    MYSQL_TIME expire;
+    convertToDatabaseTime(time(NULL), 0, expire);
+    inbind[0].buffer_type = MYSQL_TYPE_TIMESTAMP;
+    inbind[0].buffer = reinterpret_cast<char*>(&expire);
+    inbind[0].buffer_length = sizeof(expire);
+
+    uint32_t limit = getExpiredLeasesLimit(max_leases);
+    inbind[1].buffer_type = MYSQL_TYPE_LONG;
+    inbind[1].buffer = reinterpret_cast<char*>(&limit);
+    inbind[1].is_unsigned = MLM_TRUE;
+
+    // ... and get the data
+    Lease6Collection result;
+    getLeaseCollection(GET_LEASE6_EXPIRE, inbind, result);
+
+    return (result);
+}
+
 // Update lease methods.  These comprise common code that handles the actual
 // update, and type-specific methods that set up the parameters for the prepared
 // statement depending on the type of lease.
@@ -1796,6 +1935,8 @@ void
 MySqlLeaseMgr::updateLeaseCommon(StatementIndex stindex, MYSQL_BIND* bind,
                                  const LeasePtr& lease) {
 
+    startTransaction();
+
     // Bind the parameters to the statement
     int status = mysql_stmt_bind_param(statements_[stindex], bind);
     checkError(status, stindex, "unable to bind parameters");
@@ -1841,6 +1982,7 @@ MySqlLeaseMgr::updateLease4(const Lease4Ptr& lease) {
 
     // Drop to common update code
     updateLeaseCommon(stindex, &bind[0], lease);
+    cache4_->update(lease);
 }
 
 
@@ -1882,6 +2024,8 @@ MySqlLeaseMgr::updateLease6(const Lease6Ptr& lease) {
 bool
 MySqlLeaseMgr::deleteLeaseCommon(StatementIndex stindex, MYSQL_BIND* bind) {
 
+    startTransaction();
+
     // Bind the input parameters to the statement
     int status = mysql_stmt_bind_param(statements_[stindex], bind);
     checkError(status, stindex, "unable to bind WHERE clause parameter");
@@ -1912,7 +2056,9 @@ MySqlLeaseMgr::deleteLease(const bundy::asiolink::IOAddress& addr) {
         inbind[0].buffer = reinterpret_cast<char*>(&addr4);
         inbind[0].is_unsigned = MLM_TRUE;
 
-        return (deleteLeaseCommon(DELETE_LEASE4, inbind));
+        const bool deleted = deleteLeaseCommon(DELETE_LEASE4, inbind);
+        cache4_->remove(addr);
+        return (deleted);
 
     } else {
         std::string addr6 = addr.toText();
@@ -2000,9 +2146,40 @@ MySqlLeaseMgr::getVersion() const {
 }
 
 
+void
+MySqlLeaseMgr::beginTransaction() {
+    // In group commit mode autocommit is disabled, so the writes are
+    // already made in a transaction.
+    if (group_commit_ == 0) {
+        query_transaction_ = true;
+    }
+}
+
+void
+MySqlLeaseMgr::startTransaction() {
+    if (!query_transaction_ || in_transaction_) {
+        return;
+    }
+
+    if (mysql_query(mysql_, "START TRANSACTION") != 0) {
+        bundy_throw(DbOperationError, "unable to start transaction: "
+                    << mysql_error(mysql_));
+    }
+    in_transaction_ = true;
+}
+
 void
 MySqlLeaseMgr::commit() {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL, DHCPSRV_MYSQL_COMMIT);
+    const bool query_transaction = query_transaction_;
+    query_transaction_ = false;
+    if (query_transaction) {
+        // Nothing has been written since the transaction was begun.
+        if (!in_transaction_) {
+            return;
+        }
+        in_transaction_ = false;
+    }
     if (mysql_commit(mysql_) != 0) {
         bundy_throw(DbOperationError, "commit failed: " << mysql_error(mysql_));
     }
@@ -2012,6 +2189,16 @@ MySqlLeaseMgr::commit() {
 void
 MySqlLeaseMgr::rollback() {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL, DHCPSRV_MYSQL_ROLLBACK);
+    // The cache may hold the leases written in the transaction.
+    cache4_->clear();
+    const bool query_transaction = query_transaction_;
+    query_transaction_ = false;
+    if (query_transaction) {
+        if (!in_transaction_) {
+            return;
+        }
+        in_transaction_ = false;
+    }
     if (mysql_rollback(mysql_) != 0) {
         bundy_throw(DbOperationError, "rollback failed: " << mysql_error(mysql_));
     }
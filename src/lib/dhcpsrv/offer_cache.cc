@@ -0,0 +1,113 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <dhcpsrv/offer_cache.h>
+#include <util/time_utilities.h>
+
+#include <boost/tuple/tuple.hpp>
+
+using namespace bundy::asiolink;
+using bundy::util::CoarseClock;
+
+namespace bundy {
+namespace dhcp {
+
+OfferCache::OfferCache(const uint32_t lifetime)
+    : lifetime_(lifetime) {
+}
+
+void
+OfferCache::setLifetime(const uint32_t lifetime) {
+    if (lifetime != lifetime_) {
+        // The offers must stay in the order in which they expire.
+        entries_.clear();
+        lifetime_ = lifetime;
+    }
+}
+
+bool
+OfferCache::get(const std::vector<uint8_t>& hwaddr,
+                const std::vector<uint8_t>& client_id,
+                const SubnetID subnet_id, IOAddress& address) {
+    if (entries_.empty()) {
+        return (false);
+    }
+    purge(CoarseClock::getTime());
+    EntryContainer::iterator entry =
+        entries_.find(boost::make_tuple(hwaddr, client_id, subnet_id));
+    if (entry == entries_.end()) {
+        return (false);
+    }
+    address = IOAddress(entry->address_);
+    return (true);
+}
+
+void
+OfferCache::put(const std::vector<uint8_t>& hwaddr,
+                const std::vector<uint8_t>& client_id,
+                const SubnetID subnet_id, const IOAddress& address) {
+    if (lifetime_ == 0) {
+        return;
+    }
+    const time_t now = CoarseClock::getTime();
+    purge(now);
+
+    // The client gets one offer, and the address is offered to one client.
+    const uint32_t addr = address;
+    remove(hwaddr, client_id, subnet_id);
+    entries_.get<2>().erase(addr);
+    entries_.get<1>().push_back(Entry(hwaddr, client_id, subnet_id, addr,
+                                      now + lifetime_));
+}
+
+void
+OfferCache::remove(const std::vector<uint8_t>& hwaddr,
+                   const std::vector<uint8_t>& client_id,
+                   const SubnetID subnet_id) {
+    if (entries_.empty()) {
+        return;
+    }
+    EntryContainer::iterator entry =
+        entries_.find(boost::make_tuple(hwaddr, client_id, subnet_id));
+    if (entry != entries_.end()) {
+        entries_.erase(entry);
+    }
+}
+
+bool
+OfferCache::offeredToOther(const IOAddress& address,
+                           const std::vector<uint8_t>& hwaddr,
+                           const std::vector<uint8_t>& client_id) {
+    if (entries_.empty()) {
+        return (false);
+    }
+    purge(CoarseClock::getTime());
+    EntryContainer::nth_index<2>::type::const_iterator entry =
+        entries_.get<2>().find(static_cast<uint32_t>(address));
+    if (entry == entries_.get<2>().end()) {
+        return (false);
+    }
+    return ((entry->hwaddr_ != hwaddr) || (entry->client_id_ != client_id));
+}
+
+void
+OfferCache::purge(const time_t now) {
+    EntryContainer::nth_index<1>::type& by_expire = entries_.get<1>();
+    while (!by_expire.empty() && (by_expire.front().expire_ <= now)) {
+        by_expire.pop_front();
+    }
+}
+
+} // end of namespace bundy::dhcp
+} // end of namespace bundy
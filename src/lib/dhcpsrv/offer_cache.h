@@ -0,0 +1,182 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef OFFER_CACHE_H
+#define OFFER_CACHE_H
+
+#include <asiolink/io_address.h>
+#include <dhcpsrv/lease.h>
+
+#include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/indexed_by.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+#include <boost/multi_index_container.hpp>
+
+#include <ctime>
+#include <vector>
+
+namespace bundy {
+namespace dhcp {
+
+/// @brief Addresses recently offered to the DHCPv4 clients.
+///
+/// A DHCPDISCOVER doesn't allocate a lease, so a client which retransmits
+/// it (typically 3 to 5 times when many clients start at once) makes the
+/// allocation engine search the pools and probe the lease database again.
+/// The engine keeps the address offered to each client in this table for
+/// a short time: a repeated DHCPDISCOVER from the same client gets the same
+/// address without a search, and the searches for other clients skip the
+/// address until the offer expires, so that it isn't offered twice.
+///
+/// The offers are identified by the hardware address and the client
+/// identifier (empty if the client sent none) of the client, and its
+/// subnet. All offers have the same lifetime, so they expire in the order
+/// in which they were made and the expired ones are dropped from the front
+/// of the table when it is used.
+class OfferCache {
+public:
+    /// @brief Constructor.
+    ///
+    /// @param lifetime time during which an offer is held, in seconds.
+    /// The table holds nothing if it is zero.
+    explicit OfferCache(const uint32_t lifetime = 0);
+
+    /// @brief Sets the time during which an offer is held.
+    ///
+    /// The offers held are dropped if the lifetime changes.
+    ///
+    /// @param lifetime time in seconds, zero to disable the table.
+    void setLifetime(const uint32_t lifetime);
+
+    /// @brief Returns the time during which an offer is held.
+    /// @return time in seconds, zero if the table is disabled.
+    uint32_t getLifetime() const {
+        return (lifetime_);
+    }
+
+    /// @brief Returns the address offered to a client.
+    ///
+    /// @param hwaddr hardware address of the client.
+    /// @param client_id client identifier, empty if there is none.
+    /// @param subnet_id identifier of the subnet.
+    /// @param [out] address the address offered.
+    /// @return true if an offer is held for the client.
+    bool get(const std::vector<uint8_t>& hwaddr,
+             const std::vector<uint8_t>& client_id, const SubnetID subnet_id,
+             asiolink::IOAddress& address);
+
+    /// @brief Records the address offered to a client.
+    ///
+    /// It replaces the previous offer to the client and any offer of the
+    /// same address to another client.
+    ///
+    /// @param hwaddr hardware address of the client.
+    /// @param client_id client identifier, empty if there is none.
+    /// @param subnet_id identifier of the subnet.
+    /// @param address the address offered.
+    void put(const std::vector<uint8_t>& hwaddr,
+             const std::vector<uint8_t>& client_id, const SubnetID subnet_id,
+             const asiolink::IOAddress& address);
+
+    /// @brief Drops the offer to a client.
+    ///
+    /// This is called when a lease is allocated to the client.
+    ///
+    /// @param hwaddr hardware address of the client.
+    /// @param client_id client identifier, empty if there is none.
+    /// @param subnet_id identifier of the subnet.
+    void remove(const std::vector<uint8_t>& hwaddr,
+                const std::vector<uint8_t>& client_id,
+                const SubnetID subnet_id);
+
+    /// @brief Checks whether an address is offered to another client.
+    ///
+    /// @param address the address to check.
+    /// @param hwaddr hardware address of the client.
+    /// @param client_id client identifier, empty if there is none.
+    /// @return true if the address is offered to a client with a different
+    /// hardware address or client identifier.
+    bool offeredToOther(const asiolink::IOAddress& address,
+                        const std::vector<uint8_t>& hwaddr,
+                        const std::vector<uint8_t>& client_id);
+
+    /// @brief Drops the offers which have expired.
+    ///
+    /// @param now the current time, in seconds since epoch.
+    void purge(const time_t now);
+
+    /// @brief Drops all offers.
+    void clear() {
+        entries_.clear();
+    }
+
+    /// @brief Returns the number of offers held.
+    size_t size() const {
+        return (entries_.size());
+    }
+
+private:
+    /// @brief Offer to a client.
+    struct Entry {
+        Entry(const std::vector<uint8_t>& hwaddr,
+              const std::vector<uint8_t>& client_id, const SubnetID subnet_id,
+              const uint32_t address, const time_t expire) :
+            hwaddr_(hwaddr), client_id_(client_id), subnet_id_(subnet_id),
+            address_(address), expire_(expire)
+        {}
+
+        std::vector<uint8_t> hwaddr_;
+        std::vector<uint8_t> client_id_;
+        SubnetID subnet_id_;
+        uint32_t address_;
+        /// Time at which the offer expires.
+        time_t expire_;
+    };
+
+    /// @brief Offers in the order in which they expire, indexed by the
+    /// client and by the address.
+    typedef boost::multi_index_container<
+        Entry,
+        boost::multi_index::indexed_by<
+            boost::multi_index::hashed_unique<
+                boost::multi_index::composite_key<
+                    Entry,
+                    boost::multi_index::member<Entry, std::vector<uint8_t>,
+                                               &Entry::hwaddr_>,
+                    boost::multi_index::member<Entry, std::vector<uint8_t>,
+                                               &Entry::client_id_>,
+                    boost::multi_index::member<Entry, SubnetID,
+                                               &Entry::subnet_id_>
+                >
+            >,
+            boost::multi_index::sequenced<>,
+            boost::multi_index::hashed_unique<
+                boost::multi_index::member<Entry, uint32_t, &Entry::address_>
+            >
+        >
+    > EntryContainer;
+
+    /// Time during which an offer is held.
+    uint32_t lifetime_;
+
+    /// The offers.
+    EntryContainer entries_;
+};
+
+} // end of namespace bundy::dhcp
+} // end of namespace bundy
+
+#endif // OFFER_CACHE_H
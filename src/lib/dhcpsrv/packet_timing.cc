@@ -0,0 +1,244 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <dhcpsrv/packet_timing.h>
+#include <exceptions/exceptions.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <time.h>
+
+using namespace bundy::data;
+using namespace bundy::statistics;
+using namespace boost::posix_time;
+
+namespace bundy {
+namespace dhcp {
+
+const unsigned int PacketTiming::HISTOGRAM_BITS;
+
+namespace {
+
+// Current value of the monotonic clock, in nanoseconds.
+uint64_t
+now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec);
+}
+
+// Converts nanoseconds to microseconds in a trace record.
+uint32_t
+toTraceTime(const uint64_t time) {
+    const uint64_t usec = time / 1000;
+    return (usec < 0xffffffffULL ? static_cast<uint32_t>(usec) : 0xffffffff);
+}
+
+}
+
+PacketTiming::PacketTiming()
+    : enabled_(false), active_(false), current_(ALLOCATION), last_(0),
+      count_(0), trace_(NULL), trace_threshold_(0) {
+    clear();
+}
+
+PacketTiming::~PacketTiming() {
+    closeTrace();
+}
+
+const char*
+PacketTiming::getStageName(const Stage stage) {
+    switch (stage) {
+    case RECEIVE:
+        return ("receive");
+    case UNPACK:
+        return ("unpack");
+    case CLASSIFY:
+        return ("classify");
+    case SUBNET:
+        return ("subnet");
+    case ALLOCATION:
+        return ("allocation");
+    case HOOKS:
+        return ("hooks");
+    case PACK:
+        return ("pack");
+    case SEND:
+        return ("send");
+    case COMMIT:
+        return ("commit");
+    default:
+        return ("total");
+    }
+}
+
+void
+PacketTiming::setEnabled(const bool enabled) {
+    enabled_ = enabled;
+    if (!enabled) {
+        active_ = false;
+    }
+}
+
+void
+PacketTiming::clear() {
+    for (int i = 0; i <= STAGE_COUNT; ++i) {
+        // The server has a single thread, which needs no more than one
+        // shard.
+        histograms_[i].reset(new Histogram(HISTOGRAM_BITS, 1));
+        totals_[i] = 0;
+    }
+    count_ = 0;
+}
+
+const Histogram&
+PacketTiming::getHistogram(const Stage stage) const {
+    if (stage > STAGE_COUNT) {
+        bundy_throw(OutOfRange, "invalid packet processing stage " << stage);
+    }
+    return (*histograms_[stage]);
+}
+
+uint64_t
+PacketTiming::getTotalTime(const Stage stage) const {
+    if (stage > STAGE_COUNT) {
+        bundy_throw(OutOfRange, "invalid packet processing stage " << stage);
+    }
+    return (totals_[stage]);
+}
+
+ElementPtr
+PacketTiming::toElement() const {
+    ElementPtr stages = Element::createList();
+    for (int i = 0; i <= STAGE_COUNT; ++i) {
+        const Histogram& histogram = *histograms_[i];
+        ElementPtr buckets = Element::createList();
+        for (size_t bucket = 0; bucket < histogram.getBucketCount();
+             ++bucket) {
+            const Histogram::Value count = histogram.get(bucket);
+            if (count > 0) {
+                ElementPtr entry = Element::createList();
+                entry->add(Element::create(static_cast<long long int>(
+                    histogram.getBucketLowerBound(bucket))));
+                entry->add(Element::create(static_cast<long long int>(count)));
+                buckets->add(entry);
+            }
+        }
+        ElementPtr stage = Element::createMap();
+        stage->set("stage", Element::create(std::string(
+            getStageName(static_cast<Stage>(i)))));
+        stage->set("total-time",
+                   Element::create(static_cast<long long int>(totals_[i])));
+        stage->set("histogram", buckets);
+        stages->add(stage);
+    }
+
+    ElementPtr result = Element::createMap();
+    result->set("enabled", Element::create(enabled_));
+    result->set("packets",
+                Element::create(static_cast<long long int>(count_)));
+    result->set("trace-file", Element::create(trace_file_));
+    result->set("trace-threshold",
+                Element::create(static_cast<long long int>(trace_threshold_)));
+    result->set("stages", stages);
+    return (result);
+}
+
+void
+PacketTiming::openTrace(const std::string& file, const uint32_t threshold) {
+    closeTrace();
+    trace_ = fopen(file.c_str(), "wb");
+    if (trace_ == NULL) {
+        bundy_throw(BadValue, "unable to open the packet trace file "
+                    << file << ": " << strerror(errno));
+    }
+    const uint32_t stages = STAGE_COUNT;
+    fwrite("PKTT", 1, 4, trace_);
+    fwrite(&stages, sizeof(stages), 1, trace_);
+    trace_file_ = file;
+    trace_threshold_ = threshold;
+}
+
+void
+PacketTiming::closeTrace() {
+    if (trace_ != NULL) {
+        fclose(trace_);
+        trace_ = NULL;
+    }
+    trace_file_.clear();
+    trace_threshold_ = 0;
+}
+
+void
+PacketTiming::startPacket(const ptime& received) {
+    memset(times_, 0, sizeof(times_));
+    received_ = received;
+    last_ = now();
+    current_ = ALLOCATION;
+    active_ = true;
+
+    // The packet was timestamped with the system clock when it was read.
+    if (!received.is_not_a_date_time()) {
+        const int64_t usec =
+            (microsec_clock::universal_time() - received).total_microseconds();
+        if (usec > 0) {
+            times_[RECEIVE] = static_cast<uint64_t>(usec) * 1000;
+        }
+    }
+}
+
+PacketTiming::Stage
+PacketTiming::switchStage(const Stage stage) {
+    const uint64_t time = now();
+    times_[current_] += time - last_;
+    last_ = time;
+    const Stage previous = current_;
+    current_ = stage;
+    return (previous);
+}
+
+void
+PacketTiming::finishPacket(const uint8_t type) {
+    switchStage(current_);
+    active_ = false;
+
+    uint64_t total = 0;
+    for (int i = 0; i < STAGE_COUNT; ++i) {
+        histograms_[i]->add(times_[i] / 1000);
+        totals_[i] += times_[i] / 1000;
+        total += times_[i];
+    }
+    histograms_[STAGE_COUNT]->add(total / 1000);
+    totals_[STAGE_COUNT] += total / 1000;
+    ++count_;
+
+    if ((trace_ != NULL) && (total / 1000 >= trace_threshold_)) {
+        const ptime epoch(boost::gregorian::date(1970, 1, 1));
+        const uint64_t received = received_.is_not_a_date_time() ? 0 :
+            (received_ - epoch).total_microseconds();
+        uint32_t record[STAGE_COUNT + 2];
+        record[0] = type;
+        record[1] = toTraceTime(total);
+        for (int i = 0; i < STAGE_COUNT; ++i) {
+            record[i + 2] = toTraceTime(times_[i]);
+        }
+        fwrite(&received, sizeof(received), 1, trace_);
+        fwrite(record, sizeof(record), 1, trace_);
+    }
+}
+
+} // end of namespace bundy::dhcp
+} // end of namespace bundy
@@ -0,0 +1,265 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef PACKET_TIMING_H
+#define PACKET_TIMING_H
+
+#include <cc/data.h>
+#include <statistics/histogram.h>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+
+namespace bundy {
+namespace dhcp {
+
+/// @brief Breakdown of the time the server spends on each packet.
+///
+/// The DHCP servers charge the time they spend on a query to the stages of
+/// its processing, from its reception to the sending of the response, and
+/// accumulate the time of each stage in a histogram. The processing which
+/// isn't charged to a specific stage, i.e. the allocation engine, the lease
+/// database queries and the building of the response, is charged to the
+/// @c ALLOCATION stage.
+///
+/// The server calls @c start when it has received a query and @c finish
+/// when it is done with it; in between, the code of a stage is enclosed in
+/// a @c Scope. The stages may be nested: the time of the inner stage is
+/// not charged to the outer one. The commit of the lease changes and the
+/// sending of the responses held for a group commit are charged to the
+/// query which completes the group.
+///
+/// The queries which take longer than a threshold can also be written to
+/// a binary trace file. The file starts with the "PKTT" magic and the
+/// number of stages as a 32-bit integer, followed by one record per query:
+/// the time the query was received, in microseconds since the epoch, as a
+/// 64-bit integer, then the message type, the total time and the time of
+/// each stage, in microseconds, as 32-bit integers. The integers are in the
+/// host byte order.
+///
+/// The timing is disabled by default, in which case each stage costs a
+/// test of a flag.
+class PacketTiming : public boost::noncopyable {
+public:
+    /// @brief Stages of the processing of a packet.
+    enum Stage {
+        RECEIVE,    ///< From the reading of the packet to its processing.
+        UNPACK,     ///< Parsing of the packet and of its options.
+        CLASSIFY,   ///< Client classification and the acceptance checks.
+        SUBNET,     ///< Subnet selection.
+        ALLOCATION, ///< Allocation, lease database and response building.
+        HOOKS,      ///< Hooks callouts called by the server.
+        PACK,       ///< Building of the wire format of the response.
+        SEND,       ///< Sending of the response.
+        COMMIT,     ///< Commit of the lease changes.
+        STAGE_COUNT
+    };
+
+    /// @brief Charges the time spent in a block of code to a stage.
+    ///
+    /// The stage which was being timed is resumed when the scope ends.
+    class Scope : public boost::noncopyable {
+    public:
+        /// @brief Constructor.
+        ///
+        /// @param timing The timing of the server.
+        /// @param stage The stage of the block.
+        Scope(PacketTiming& timing, const Stage stage)
+            : timing_(timing), previous_(timing.enter(stage)) {
+        }
+
+        /// @brief Destructor.
+        ~Scope() {
+            timing_.enter(previous_);
+        }
+
+    private:
+        PacketTiming& timing_;
+        const Stage previous_;
+    };
+
+    /// @brief log2 of the largest time told apart by the histograms, in
+    /// microseconds (about 16 seconds).
+    static const unsigned int HISTOGRAM_BITS = 24;
+
+    /// @brief Constructor.
+    ///
+    /// The timing is disabled.
+    PacketTiming();
+
+    /// @brief Destructor.
+    ///
+    /// Closes the trace file.
+    ~PacketTiming();
+
+    /// @brief Returns the name of a stage.
+    ///
+    /// @param stage The stage, or @c STAGE_COUNT for the total time.
+    static const char* getStageName(const Stage stage);
+
+    /// @brief Enables or disables the timing.
+    void setEnabled(const bool enabled);
+
+    /// @brief Checks whether the packets are timed.
+    bool isEnabled() const {
+        return (enabled_);
+    }
+
+    /// @brief Starts timing a packet.
+    ///
+    /// @param received The time the packet was read from its socket.
+    void start(const boost::posix_time::ptime& received) {
+        if (enabled_) {
+            startPacket(received);
+        }
+    }
+
+    /// @brief Switches to a stage.
+    ///
+    /// The time spent since the last switch is charged to the previous
+    /// stage. The @c Scope is normally used instead.
+    ///
+    /// @param stage The new stage.
+    /// @return The previous stage.
+    Stage enter(const Stage stage) {
+        if (!active_) {
+            return (stage);
+        }
+        return (switchStage(stage));
+    }
+
+    /// @brief Finishes timing a packet.
+    ///
+    /// Adds the time of its stages to the histograms, and writes the packet
+    /// to the trace file if it took longer than the threshold.
+    ///
+    /// @param type The message type of the packet.
+    void finish(const uint8_t type) {
+        if (active_) {
+            finishPacket(type);
+        }
+    }
+
+    /// @brief Drops the times collected so far.
+    void clear();
+
+    /// @brief Returns the number of packets timed.
+    uint64_t getCount() const {
+        return (count_);
+    }
+
+    /// @brief Returns the histogram of the time of a stage.
+    ///
+    /// @param stage The stage, or @c STAGE_COUNT for the total time of the
+    /// packets.
+    /// @return The histogram of the times in microseconds.
+    const statistics::Histogram& getHistogram(const Stage stage) const;
+
+    /// @brief Returns the total time spent in a stage, in microseconds.
+    ///
+    /// @param stage The stage, or @c STAGE_COUNT for the total time of the
+    /// packets.
+    uint64_t getTotalTime(const Stage stage) const;
+
+    /// @brief Returns the times collected so far.
+    ///
+    /// The result is a map holding "enabled", the number of "packets"
+    /// timed, the "trace-file" and "trace-threshold", and a "stages" list of maps with the "stage" name, its
+    /// "total-time" and its "histogram", the list of the non-empty buckets
+    /// as pairs of the lower bound of the bucket and of the number of
+    /// packets counted in it. The last entry is for the total time of the
+    /// packets. The times are in microseconds.
+    data::ElementPtr toElement() const;
+
+    /// @brief Starts writing the slow packets to a trace file.
+    ///
+    /// The file is truncated.
+    ///
+    /// @param file The name of the file.
+    /// @param threshold The minimum time of the packets written, in
+    /// microseconds; all packets are written if it is zero.
+    ///
+    /// @throw BadValue if the file can't be opened.
+    void openTrace(const std::string& file, const uint32_t threshold);
+
+    /// @brief Stops writing the trace file.
+    void closeTrace();
+
+    /// @brief Returns the name of the trace file, empty if there is none.
+    const std::string& getTraceFile() const {
+        return (trace_file_);
+    }
+
+    /// @brief Returns the threshold of the packets written to the trace file.
+    uint32_t getTraceThreshold() const {
+        return (trace_threshold_);
+    }
+
+private:
+    /// @brief Implements @c start.
+    void startPacket(const boost::posix_time::ptime& received);
+
+    /// @brief Implements @c enter.
+    Stage switchStage(const Stage stage);
+
+    /// @brief Implements @c finish.
+    void finishPacket(const uint8_t type);
+
+    /// Whether the timing is enabled.
+    bool enabled_;
+
+    /// Whether a packet is being timed.
+    bool active_;
+
+    /// The stage being timed.
+    Stage current_;
+
+    /// The time of the last stage switch, in nanoseconds of the monotonic
+    /// clock.
+    uint64_t last_;
+
+    /// The time the packet was received.
+    boost::posix_time::ptime received_;
+
+    /// The time of each stage of the packet, in nanoseconds.
+    uint64_t times_[STAGE_COUNT];
+
+    /// The histograms of the stages and of the total time.
+    boost::scoped_ptr<statistics::Histogram> histograms_[STAGE_COUNT + 1];
+
+    /// The total time of the stages and of the packets, in microseconds.
+    uint64_t totals_[STAGE_COUNT + 1];
+
+    /// The number of packets timed.
+    uint64_t count_;
+
+    /// The trace file, NULL if there is none.
+    FILE* trace_;
+
+    /// The name of the trace file.
+    std::string trace_file_;
+
+    /// The minimum time of the packets written to the trace file.
+    uint32_t trace_threshold_;
+};
+
+} // end of namespace bundy::dhcp
+} // end of namespace bundy
+
+#endif // PACKET_TIMING_H
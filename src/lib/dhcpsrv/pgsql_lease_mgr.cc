@@ -24,6 +24,7 @@
 
 #include <iostream>
 #include <iomanip>
+#include <limits>
 #include <sstream>
 #include <string>
 #include <time.h>
@@ -92,6 +93,13 @@ TaggedStatement tagged_statements[] = {
      "valid_lifetime, extract(epoch from expire)::bigint, subnet_id, fqdn_fwd, fqdn_rev, hostname "
      "FROM lease4 "
      "WHERE client_id = $1 AND subnet_id = $2"},
+    {PgSqlLeaseMgr::GET_LEASE4_EXPIRE, 2,
+        { 20, 20 },
+        "get_lease4_expire",
+     "SELECT address, hwaddr, client_id, "
+     "valid_lifetime, extract(epoch from expire)::bigint, subnet_id, fqdn_fwd, fqdn_rev, hostname "
+     "FROM lease4 "
+     "WHERE expire < to_timestamp($1) ORDER BY expire LIMIT $2"},
     {PgSqlLeaseMgr::GET_LEASE4_HWADDR, 1,
          { 17 },
          "get_lease4_hwaddr",
@@ -130,6 +138,22 @@ TaggedStatement tagged_statements[] = {
      "lease_type, iaid, prefix_len, fqdn_fwd, fqdn_rev, hostname "
      "FROM lease6 "
      "WHERE lease_type = $1 AND duid = $2 AND iaid = $3 AND subnet_id = $4"},
+    {PgSqlLeaseMgr::GET_LEASE6_EXPIRE, 2,
+        { 20, 20 },
+        "get_lease6_expire",
+     "SELECT address, duid, valid_lifetime, "
+     "extract(epoch from expire)::bigint, subnet_id, pref_lifetime, "
+     "lease_type, iaid, prefix_len, fqdn_fwd, fqdn_rev, hostname "
+     "FROM lease6 "
+     "WHERE expire < to_timestamp($1) ORDER BY expire LIMIT $2"},
+    {PgSqlLeaseMgr::GET_LEASE6_TYPE, 1,
+        { 21 },
+        "get_lease6_type",
+     "SELECT address, duid, valid_lifetime, "
+     "extract(epoch from expire)::bigint, subnet_id, pref_lifetime, "
+     "lease_type, iaid, prefix_len, fqdn_fwd, fqdn_rev, hostname "
+     "FROM lease6 "
+     "WHERE lease_type = $1"},
     {PgSqlLeaseMgr::GET_VERSION, 0,
         { 0 },
      "get_version",
@@ -167,6 +191,32 @@ TaggedStatement tagged_statements[] = {
     {PgSqlLeaseMgr::NUM_STATEMENTS, 0,  { 0 }, NULL, NULL}
 };
 
+/// @brief Sets the parameters of the expired leases query.
+///
+/// @param max_leases Maximum number of leases, 0 meaning no limit.
+/// @param [out] params Parameters to which the expiration time and the
+///        limit are appended.
+void
+setExpiredLeasesParams(const size_t max_leases, BindParams& params) {
+    ostringstream tmp;
+
+    // Leases which expire before the current time are expired.
+    tmp << static_cast<int64_t>(time(NULL));
+    params.push_back(PgSqlParam(tmp.str()));
+    tmp.str("");
+    tmp.clear();
+
+    // LIMIT; the maximum bigint value stands for "no limit".
+    if ((max_leases == 0) ||
+        (max_leases > static_cast<uint64_t>(
+            std::numeric_limits<int64_t>::max()))) {
+        tmp << std::numeric_limits<int64_t>::max();
+    } else {
+        tmp << static_cast<uint64_t>(max_leases);
+    }
+    params.push_back(PgSqlParam(tmp.str()));
+}
+
 };
 
 namespace bundy {
@@ -571,7 +621,10 @@ private:
 
 PgSqlLeaseMgr::PgSqlLeaseMgr(const LeaseMgr::ParameterMap& parameters)
     : LeaseMgr(parameters), exchange4_(new PgSqlLease4Exchange()),
-    exchange6_(new PgSqlLease6Exchange()), conn_(NULL) {
+    exchange6_(new PgSqlLease6Exchange()),
+    cache4_(new Lease4Cache(getCacheSizeParameter())), conn_(NULL),
+    group_commit_(getGroupCommitParameter()), in_transaction_(false),
+    query_transaction_(false) {
     openDatabase();
     prepareStatements();
 }
@@ -669,9 +722,36 @@ PgSqlLeaseMgr::openDatabase() {
     }
 }
 
+void
+PgSqlLeaseMgr::beginTransaction() {
+    if (group_commit_ == 0) {
+        query_transaction_ = true;
+    }
+}
+
+void
+PgSqlLeaseMgr::startTransaction() {
+    if ((group_commit_ == 0 && !query_transaction_) || in_transaction_) {
+        return;
+    }
+
+    PGresult * r = PQexec(conn_, "BEGIN");
+    if (PQresultStatus(r) != PGRES_COMMAND_OK) {
+        const char * errorMsg = PQerrorMessage(conn_);
+        PQclear(r);
+        bundy_throw(DbOperationError, "unable to start transaction: "
+                    << errorMsg);
+    }
+
+    PQclear(r);
+    in_transaction_ = true;
+}
+
 bool
 PgSqlLeaseMgr::addLeaseCommon(StatementIndex stindex,
                               BindParams& params) {
+    startTransaction();
+
     vector<const char *> out_values;
     vector<int> out_lengths;
     vector<int> out_formats;
@@ -711,7 +791,11 @@ PgSqlLeaseMgr::addLease(const Lease4Ptr& lease) {
               DHCPSRV_PGSQL_ADD_ADDR4).arg(lease->addr_.toText());
     BindParams params = exchange4_->createBindForSend(lease);
 
-    return (addLeaseCommon(INSERT_LEASE4, params));
+    if (!addLeaseCommon(INSERT_LEASE4, params)) {
+        return (false);
+    }
+    cache4_->update(lease);
+    return (true);
 }
 
 bool
@@ -842,6 +926,12 @@ PgSqlLeaseMgr::getLease4(const HWAddr& hwaddr, SubnetID subnet_id) const {
               DHCPSRV_PGSQL_GET_SUBID_HWADDR)
               .arg(subnet_id).arg(hwaddr.toText());
 
+    Lease4Ptr result;
+    if (cache4_->get(Lease4Cache::HWADDR, hwaddr.hwaddr_, subnet_id,
+                     result)) {
+        return (result);
+    }
+
     // Set up the WHERE clause value
     BindParams inparams;
     ostringstream tmp;
@@ -856,8 +946,8 @@ PgSqlLeaseMgr::getLease4(const HWAddr& hwaddr, SubnetID subnet_id) const {
     inparams.push_back(PgSqlParam(tmp.str()));
 
     // Get the data
-    Lease4Ptr result;
     getLease(GET_LEASE4_HWADDR_SUBID, inparams, result);
+    cache4_->put(Lease4Cache::HWADDR, hwaddr.hwaddr_, subnet_id, result);
 
     return (result);
 }
@@ -886,6 +976,12 @@ PgSqlLeaseMgr::getLease4(const ClientId& clientid, SubnetID subnet_id) const {
               DHCPSRV_PGSQL_GET_SUBID_CLIENTID)
               .arg(subnet_id).arg(clientid.toText());
 
+    Lease4Ptr result;
+    if (cache4_->get(Lease4Cache::CLIENT_ID, clientid.getClientId(),
+                     subnet_id, result)) {
+        return (result);
+    }
+
     // Set up the WHERE clause value
     BindParams inparams;
     ostringstream tmp;
@@ -897,8 +993,9 @@ PgSqlLeaseMgr::getLease4(const ClientId& clientid, SubnetID subnet_id) const {
     inparams.push_back(PgSqlParam(tmp.str()));
 
     // Get the data
-    Lease4Ptr result;
     getLease(GET_LEASE4_CLIENTID_SUBID, inparams, result);
+    cache4_->put(Lease4Cache::CLIENT_ID, clientid.getClientId(), subnet_id,
+                 result);
 
     return (result);
 }
@@ -1007,6 +1104,58 @@ PgSqlLeaseMgr::getLeases6(Lease::Type lease_type, const DUID& duid,
     return (result);
 }
 
+Lease6Collection
+PgSqlLeaseMgr::getLeases6(Lease::Type lease_type) const {
+    LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
+              DHCPSRV_PGSQL_GET_TYPE6).arg(lease_type);
+
+    // Set up the WHERE clause value
+    BindParams inparams;
+    ostringstream tmp;
+
+    // LEASE_TYPE
+    tmp << static_cast<uint16_t>(lease_type);
+    inparams.push_back(PgSqlParam(tmp.str()));
+
+    // ... and get the data
+    Lease6Collection result;
+    getLeaseCollection(GET_LEASE6_TYPE, inparams, result);
+
+    return (result);
+}
+
+Lease4Collection
+PgSqlLeaseMgr::getExpiredLeases4(const size_t max_leases) const {
+    LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
+              DHCPSRV_PGSQL_GET_EXPIRED4).arg(max_leases);
+
+    // Set up the WHERE and LIMIT clause values
+    BindParams inparams;
+    setExpiredLeasesParams(max_leases, inparams);
+
+    // ... and get the data
+    Lease4Collection result;
+    getLeaseCollection(GET_LEASE4_EXPIRE, inparams, result);
+
+    return (result);
+}
+
+Lease6Collection
+PgSqlLeaseMgr::getExpiredLeases6(const size_t max_leases) const {
+    LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
+              DHCPSRV_PGSQL_GET_EXPIRED6).arg(max_leases);
+
+    // Set up the WHERE and LIMIT clause values
+    BindParams inparams;
+    setExpiredLeasesParams(max_leases, inparams);
+
+    // ... and get the data
+    Lease6Collection result;
+    getLeaseCollection(GET_LEASE6_EXPIRE, inparams, result);
+
+    return (result);
+}
+
 template <typename LeasePtr>
 void
 PgSqlLeaseMgr::updateLeaseCommon(StatementIndex stindex, BindParams & params,
@@ -1014,6 +1163,8 @@ PgSqlLeaseMgr::updateLeaseCommon(StatementIndex stindex, BindParams & params,
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_PGSQL_ADD_ADDR4).arg(statements_[stindex].stmt_name);
 
+    startTransaction();
+
     vector<const char *> params_;
     vector<int> lengths_;
     vector<int> formats_;
@@ -1061,6 +1212,7 @@ PgSqlLeaseMgr::updateLease4(const Lease4Ptr& lease) {
 
     // Drop to common update code
     updateLeaseCommon(stindex, params, lease);
+    cache4_->update(lease);
 }
 
 void
@@ -1082,6 +1234,8 @@ PgSqlLeaseMgr::updateLease6(const Lease6Ptr& lease) {
 
 bool
 PgSqlLeaseMgr::deleteLeaseCommon(StatementIndex stindex, BindParams & params) {
+    startTransaction();
+
     vector<const char *> params_;
     vector<int> lengths_;
     vector<int> formats_;
@@ -1109,7 +1263,9 @@ PgSqlLeaseMgr::deleteLease(const bundy::asiolink::IOAddress& addr) {
         ostringstream tmp;
         tmp << static_cast<uint32_t>(addr);
         inparams.push_back(PgSqlParam(tmp.str()));
-        return (deleteLeaseCommon(DELETE_LEASE4, inparams));
+        const bool deleted = deleteLeaseCommon(DELETE_LEASE4, inparams);
+        cache4_->remove(addr);
+        return (deleted);
     }
 
     inparams.push_back(PgSqlParam(addr.toText()));
@@ -1188,6 +1344,15 @@ PgSqlLeaseMgr::getVersion() const {
 void
 PgSqlLeaseMgr::commit() {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL, DHCPSRV_PGSQL_COMMIT);
+    const bool query_transaction = query_transaction_;
+    query_transaction_ = false;
+    if (group_commit_ != 0 || query_transaction) {
+        // Nothing has been written since the last commit.
+        if (!in_transaction_) {
+            return;
+        }
+        in_transaction_ = false;
+    }
     PGresult * r = PQexec(conn_, "COMMIT");
     if (PQresultStatus(r) != PGRES_COMMAND_OK) {
         bundy_throw(DbOperationError, "commit failed: " << PQerrorMessage(conn_));
@@ -1199,6 +1364,16 @@ PgSqlLeaseMgr::commit() {
 void
 PgSqlLeaseMgr::rollback() {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL, DHCPSRV_PGSQL_ROLLBACK);
+    // The cache may hold the leases written in the transaction.
+    cache4_->clear();
+    const bool query_transaction = query_transaction_;
+    query_transaction_ = false;
+    if (group_commit_ != 0 || query_transaction) {
+        if (!in_transaction_) {
+            return;
+        }
+        in_transaction_ = false;
+    }
     PGresult * r = PQexec(conn_, "ROLLBACK");
     if (PQresultStatus(r) != PGRES_COMMAND_OK) {
         bundy_throw(DbOperationError, "rollback failed: "
@@ -16,6 +16,7 @@
 #define PGSQL_LEASE_MGR_H
 
 #include <dhcp/hwaddr.h>
+#include <dhcpsrv/lease4_cache.h>
 #include <dhcpsrv/lease_mgr.h>
 
 #include <boost/scoped_ptr.hpp>
@@ -91,6 +92,9 @@ public:
     /// - host - Host to which to connect (optional, defaults to "localhost")
     /// - user - Username under which to connect (optional)
     /// - password - Password for "user" on the database (optional)
+    /// - group-commit - Maximum number of queries for which the lease writes
+    ///   are committed together (optional, see @c getGroupCommit, defaults
+    ///   to 0 which commits each write as it is made)
     ///
     /// If the database is successfully opened, the version number in the
     /// schema_version table will be checked against hard-coded value in
@@ -290,6 +294,46 @@ public:
     virtual Lease6Collection getLeases6(Lease::Type type, const DUID& duid,
                                         uint32_t iaid, SubnetID subnet_id) const;
 
+    /// @brief Returns all IPv6 leases of a given type.
+    ///
+    /// @param type specifies lease type: (NA, TA or PD)
+    ///
+    /// @return lease collection (may be empty if no lease is found)
+    ///
+    /// @throw bundy::BadValue record retrieved from database had an invalid
+    ///        lease type field.
+    /// @throw bundy::dhcp::DbOperationError An operation on the open database has
+    ///        failed.
+    virtual Lease6Collection getLeases6(Lease::Type type) const;
+
+    /// @brief Returns a collection of expired IPv4 leases.
+    ///
+    /// The query uses the index on the expiration time of the leases.
+    ///
+    /// @param max_leases Maximum number of leases to be returned, 0 if all
+    ///        expired leases should be returned.
+    ///
+    /// @return Collection of expired leases, ordered by expiration time.
+    ///
+    /// @throw bundy::dhcp::DbOperationError An operation on the open database has
+    ///        failed.
+    virtual Lease4Collection getExpiredLeases4(const size_t max_leases) const;
+
+    /// @brief Returns a collection of expired IPv6 leases.
+    ///
+    /// The query uses the index on the expiration time of the leases.
+    ///
+    /// @param max_leases Maximum number of leases to be returned, 0 if all
+    ///        expired leases should be returned.
+    ///
+    /// @return Collection of expired leases, ordered by expiration time.
+    ///
+    /// @throw bundy::BadValue record retrieved from database had an invalid
+    ///        lease type field.
+    /// @throw bundy::dhcp::DbOperationError An operation on the open database has
+    ///        failed.
+    virtual Lease6Collection getExpiredLeases6(const size_t max_leases) const;
+
     /// @brief Updates IPv4 lease.
     ///
     /// Updates the record of the lease in the database (as identified by the
@@ -373,6 +417,20 @@ public:
     /// @throw DbOperationError If the rollback failed.
     virtual void rollback();
 
+    /// @brief Returns the group commit size.
+    ///
+    /// @return Value of the "group-commit" parameter, see
+    ///         @c LeaseMgr::getGroupCommit.
+    virtual size_t getGroupCommit() const {
+        return (group_commit_);
+    }
+
+    /// @brief Starts a transaction for the lease writes of a query.
+    ///
+    /// See @c LeaseMgr::beginTransaction. The BEGIN is sent with the first
+    /// lease write.
+    virtual void beginTransaction();
+
     /// @brief Statement Tags
     ///
     /// The contents of the enum are indexes into the list of compiled SQL statements
@@ -382,11 +440,14 @@ public:
         GET_LEASE4_ADDR,            // Get lease4 by address
         GET_LEASE4_CLIENTID,        // Get lease4 by client ID
         GET_LEASE4_CLIENTID_SUBID,  // Get lease4 by client ID & subnet ID
+        GET_LEASE4_EXPIRE,          // Get expired lease4
         GET_LEASE4_HWADDR,          // Get lease4 by HW address
         GET_LEASE4_HWADDR_SUBID,    // Get lease4 by HW address & subnet ID
         GET_LEASE6_ADDR,            // Get lease6 by address
         GET_LEASE6_DUID_IAID,       // Get lease6 by DUID and IAID
         GET_LEASE6_DUID_IAID_SUBID, // Get lease6 by DUID, IAID and subnet ID
+        GET_LEASE6_EXPIRE,          // Get expired lease6
+        GET_LEASE6_TYPE,            // Get all lease6 of a type
         GET_VERSION,                // Obtain version number
         INSERT_LEASE4,              // Add entry to lease4 table
         INSERT_LEASE6,              // Add entry to lease6 table
@@ -593,12 +654,34 @@ private:
     /// declare them as "mutable".)
     boost::scoped_ptr<PgSqlLease4Exchange> exchange4_; ///< Exchange object
     boost::scoped_ptr<PgSqlLease6Exchange> exchange6_; ///< Exchange object
+    boost::scoped_ptr<Lease4Cache> cache4_;     ///< Lease4 lookup cache
 
     /// A vector of compiled SQL statements
     std::vector<PgSqlStatementBind> statements_;
 
+    /// @brief Starts a transaction in group commit mode
+    ///
+    /// Called before each lease write. In group commit mode, or after
+    /// @c beginTransaction has been called, starts the transaction in which
+    /// the writes are made until the next call to @c commit or @c rollback,
+    /// unless it has already been started.
+    ///
+    /// @throw bundy::dhcp::DbOperationError The transaction could not be
+    ///        started.
+    void startTransaction();
+
     /// PostgreSQL connection handle
     PGconn* conn_;
+
+    /// Group commit size
+    size_t group_commit_;
+
+    /// True if a transaction has been started in group commit mode
+    bool in_transaction_;
+
+    /// True if @c beginTransaction has been called since the last commit
+    /// or rollback
+    bool query_transaction_;
 };
 
 }; // end of bundy::dhcp namespace
@@ -0,0 +1,264 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <dhcp/dhcp4.h>
+#include <dhcp/dhcp6.h>
+#include <dhcp/pkt4.h>
+#include <dhcp/pkt6.h>
+#include <dhcpsrv/receive_queue.h>
+
+#include <boost/lexical_cast.hpp>
+
+#include <algorithm>
+#include <string>
+
+using namespace bundy::data;
+
+namespace bundy {
+namespace dhcp {
+
+namespace {
+
+// Names of the DHCPv4 message types, by type.
+const char* const TYPE_NAMES4[] = {
+    NULL, "DHCPDISCOVER", "DHCPOFFER", "DHCPREQUEST", "DHCPDECLINE",
+    "DHCPACK", "DHCPNAK", "DHCPRELEASE", "DHCPINFORM", NULL,
+    "DHCPLEASEQUERY", "DHCPLEASEUNASSIGNED", "DHCPLEASEUNKNOWN",
+    "DHCPLEASEACTIVE", "DHCPBULKLEASEQUERY", "DHCPLEASEQUERYDONE"
+};
+
+// Names of the DHCPv6 message types, by type.
+const char* const TYPE_NAMES6[] = {
+    NULL, "SOLICIT", "ADVERTISE", "REQUEST", "CONFIRM", "RENEW", "REBIND",
+    "REPLY", "RELEASE", "DECLINE", "RECONFIGURE", "INFORMATION_REQUEST",
+    "RELAY_FORW", "RELAY_REPL", "LEASEQUERY", "LEASEQUERY_REPLY"
+};
+
+// Returns the name of a message type in the statistics.
+std::string
+typeName(const Option::Universe universe, const uint8_t type) {
+    const char* const* names = (universe == Option::V4 ? TYPE_NAMES4 :
+                                TYPE_NAMES6);
+    const size_t count = (universe == Option::V4 ?
+                          sizeof(TYPE_NAMES4) / sizeof(TYPE_NAMES4[0]) :
+                          sizeof(TYPE_NAMES6) / sizeof(TYPE_NAMES6[0]));
+    if (type == 0) {
+        return ("unknown");
+    } else if (type < count && names[type] != NULL) {
+        return (names[type]);
+    }
+    return ("type-" + boost::lexical_cast<std::string>(
+                static_cast<unsigned int>(type)));
+}
+
+// Hashes the identifier of a client (FNV-1a), never returning zero.
+uint32_t
+hashClient(const uint8_t* data, const size_t len, uint32_t hash = 2166136261U) {
+    for (size_t i = 0; i < len; ++i) {
+        hash = (hash ^ data[i]) * 16777619U;
+    }
+    return (hash != 0 ? hash : 1);
+}
+
+uint16_t
+readUint16(const uint8_t* data) {
+    return ((static_cast<uint16_t>(data[0]) << 8) | data[1]);
+}
+
+// Finds a DHCPv6 option in the options between offset and end.
+//
+// Returns true and sets offset and len to the data of the option if it
+// is found.
+bool
+findOption6(const uint8_t* data, size_t& offset, const size_t end,
+            const uint16_t code, size_t& len) {
+    while (offset + 4 <= end) {
+        const uint16_t opt_code = readUint16(data + offset);
+        const size_t opt_len = readUint16(data + offset + 2);
+        offset += 4;
+        if (opt_len > end - offset) {
+            return (false);
+        }
+        if (opt_code == code) {
+            len = opt_len;
+            return (true);
+        }
+        offset += opt_len;
+    }
+    return (false);
+}
+
+}
+
+ReceiveQueueBase::ReceiveQueueBase(const Option::Universe universe)
+    : universe_(universe), limit_(0), shed_threshold_(0) {
+    std::fill(sizes_, sizes_ + PRIORITY_COUNT, 0);
+    clearStatistics();
+}
+
+void
+ReceiveQueueBase::clearStatistics() {
+    received_ = 0;
+    std::fill(shed_, shed_ + 256, 0);
+}
+
+ElementPtr
+ReceiveQueueBase::toElement() const {
+    ElementPtr result = Element::createMap();
+    result->set("enabled", Element::create(isEnabled()));
+    result->set("queue-limit",
+                Element::create(static_cast<long long int>(limit_)));
+    result->set("shed-threshold",
+                Element::create(static_cast<long long int>(shed_threshold_)));
+    result->set("received",
+                Element::create(static_cast<long long int>(received_)));
+    result->set("high-priority",
+                Element::create(static_cast<long long int>(sizes_[HIGH])));
+    result->set("low-priority",
+                Element::create(static_cast<long long int>(sizes_[LOW])));
+    ElementPtr shed = Element::createMap();
+    for (unsigned int type = 0; type < 256; ++type) {
+        if (shed_[type] > 0) {
+            shed->set(typeName(universe_, type),
+                      Element::create(static_cast<long long int>(
+                                      shed_[type])));
+        }
+    }
+    result->set("shed", shed);
+    return (result);
+}
+
+ReceiveQueueBase::Priority
+ReceiveQueueBase::getPriority(const uint8_t type) const {
+    if (universe_ == Option::V4) {
+        switch (type) {
+        case DHCPREQUEST:
+        case DHCPDECLINE:
+        case DHCPRELEASE:
+        case DHCPINFORM:
+            return (HIGH);
+        default:
+            return (LOW);
+        }
+    }
+    switch (type) {
+    case DHCPV6_REQUEST:
+    case DHCPV6_CONFIRM:
+    case DHCPV6_RENEW:
+    case DHCPV6_REBIND:
+    case DHCPV6_RELEASE:
+    case DHCPV6_DECLINE:
+    case DHCPV6_INFORMATION_REQUEST:
+        return (HIGH);
+    default:
+        return (LOW);
+    }
+}
+
+bool
+ReceiveQueueBase::peek4(const uint8_t* data, const size_t len, uint8_t& type,
+                        uint32_t& client) {
+    type = 0;
+    client = 0;
+    const size_t options = Pkt4::DHCPV4_PKT_HDR_LEN + 4;
+    if (len < options) {
+        return (false);
+    }
+    const uint8_t* cookie = data + Pkt4::DHCPV4_PKT_HDR_LEN;
+    if (((static_cast<uint32_t>(readUint16(cookie)) << 16) |
+         readUint16(cookie + 2)) != DHCP_OPTIONS_COOKIE) {
+        return (false);
+    }
+
+    // The hardware type and the hardware address (hlen is at offset 2,
+    // chaddr at offset 28).
+    const size_t hlen = (data[2] < Pkt4::MAX_CHADDR_LEN ? data[2] :
+                         Pkt4::MAX_CHADDR_LEN);
+    client = hashClient(data + 28, hlen, hashClient(data + 1, 1));
+
+    size_t offset = options;
+    while (offset < len) {
+        const uint8_t code = data[offset];
+        if (code == DHO_END) {
+            break;
+        } else if (code == DHO_PAD) {
+            ++offset;
+            continue;
+        }
+        if (offset + 2 > len) {
+            break;
+        }
+        const size_t opt_len = data[offset + 1];
+        if (code == DHO_DHCP_MESSAGE_TYPE && opt_len > 0 &&
+            offset + 2 < len) {
+            type = data[offset + 2];
+            break;
+        }
+        offset += 2 + opt_len;
+    }
+    return (true);
+}
+
+bool
+ReceiveQueueBase::peek6(const uint8_t* data, const size_t len, uint8_t& type,
+                        uint32_t& client) {
+    type = 0;
+    client = 0;
+    size_t offset = 0;
+    size_t end = len;
+    // The relays are bounded by the hop count limit of RFC 3315.
+    for (int relays = 0; ; ++relays) {
+        if (end - offset < Pkt6::DHCPV6_PKT_HDR_LEN) {
+            return (false);
+        }
+        type = data[offset];
+        if (type != DHCPV6_RELAY_FORW) {
+            break;
+        }
+        if (relays > 32 || end - offset < Pkt6::DHCPV6_RELAY_HDR_LEN) {
+            return (false);
+        }
+        offset += Pkt6::DHCPV6_RELAY_HDR_LEN;
+        size_t msg_len = 0;
+        if (!findOption6(data, offset, end, D6O_RELAY_MSG, msg_len)) {
+            return (false);
+        }
+        end = offset + msg_len;
+    }
+
+    offset += Pkt6::DHCPV6_PKT_HDR_LEN;
+    size_t id_len = 0;
+    if (findOption6(data, offset, end, D6O_CLIENTID, id_len)) {
+        client = hashClient(data + offset, id_len);
+    }
+    return (true);
+}
+
+ReceiveQueueBase::Priority
+ReceiveQueueBase::classify(const uint8_t* data, const size_t len,
+                           uint8_t& type, uint32_t& client) {
+    ++received_;
+    const bool valid = (data != NULL) &&
+        (universe_ == Option::V4 ? peek4(data, len, type, client) :
+         peek6(data, len, type, client));
+    if (!valid) {
+        // The query will be rejected when it is unpacked.
+        type = 0;
+        client = 0;
+    }
+    return (getPriority(type));
+}
+
+} // end of namespace bundy::dhcp
+} // end of namespace bundy
@@ -0,0 +1,286 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef RECEIVE_QUEUE_H
+#define RECEIVE_QUEUE_H
+
+#include <cc/data.h>
+#include <dhcp/option.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <deque>
+#include <stdint.h>
+
+namespace bundy {
+namespace dhcp {
+
+/// @brief Limits, classification and statistics of a @c ReceiveQueue.
+///
+/// The part of the receive queue which doesn't depend on the type of the
+/// packets.
+class ReceiveQueueBase : public boost::noncopyable {
+public:
+    /// @brief Priority classes of the queries.
+    enum Priority {
+        HIGH,   ///< Queries of the clients which have or are getting a lease.
+        LOW,    ///< New clients (DHCPDISCOVER, SOLICIT) and unknown types.
+        PRIORITY_COUNT
+    };
+
+    /// @brief Constructor.
+    ///
+    /// The queue is disabled.
+    ///
+    /// @param universe V4 or V6, the protocol of the queries.
+    explicit ReceiveQueueBase(const Option::Universe universe);
+
+    /// @brief Destructor.
+    virtual ~ReceiveQueueBase() {
+    }
+
+    /// @brief Sets the limits of the queue.
+    ///
+    /// The queries already waiting beyond the new limit are kept.
+    ///
+    /// @param limit maximum number of queries waiting in each priority
+    /// class, zero disables the queue.
+    /// @param shed_threshold number of queries waiting above which the
+    /// low priority queries are dropped, zero for no threshold.
+    void setLimits(const size_t limit, const size_t shed_threshold) {
+        limit_ = limit;
+        shed_threshold_ = shed_threshold;
+    }
+
+    /// @brief Checks whether the queries are queued.
+    bool isEnabled() const {
+        return (limit_ > 0);
+    }
+
+    /// @brief Returns the maximum number of queries of a priority class.
+    size_t getLimit() const {
+        return (limit_);
+    }
+
+    /// @brief Returns the backlog above which low priority queries are
+    /// dropped.
+    size_t getShedThreshold() const {
+        return (shed_threshold_);
+    }
+
+    /// @brief Returns the number of queries waiting.
+    size_t size() const {
+        return (sizes_[HIGH] + sizes_[LOW]);
+    }
+
+    /// @brief Returns the number of queries waiting in a priority class.
+    size_t size(const Priority priority) const {
+        return (sizes_[priority]);
+    }
+
+    /// @brief Returns the number of queries of a message type dropped.
+    uint64_t getShedCount(const uint8_t type) const {
+        return (shed_[type]);
+    }
+
+    /// @brief Returns the number of queries received.
+    uint64_t getReceivedCount() const {
+        return (received_);
+    }
+
+    /// @brief Resets the counters.
+    void clearStatistics();
+
+    /// @brief Returns the limits and the counters.
+    ///
+    /// The result is a map holding "enabled", the "queue-limit" and
+    /// "shed-threshold", the number of "received" queries, the number of
+    /// queries waiting in the "high-priority" and "low-priority" classes,
+    /// and a "shed" map of the number of queries dropped by message type
+    /// name, for the types which have been dropped.
+    data::ElementPtr toElement() const;
+
+    /// @brief Returns the priority class of a message type.
+    ///
+    /// @param type the message type, zero if unknown.
+    Priority getPriority(const uint8_t type) const;
+
+    /// @brief Reads the message type and the client of a DHCPv4 query.
+    ///
+    /// Only the fixed header and the options following it are read: a
+    /// message type in the sname or file fields isn't found.
+    ///
+    /// @param data the wire format of the query.
+    /// @param len the length of the query.
+    /// @param [out] type the message type, zero if there is none.
+    /// @param [out] client a non-zero hash of the hardware address.
+    /// @return false if the query is truncated or has no magic cookie.
+    static bool peek4(const uint8_t* data, const size_t len, uint8_t& type,
+                      uint32_t& client);
+
+    /// @brief Reads the message type and the client of a DHCPv6 query.
+    ///
+    /// The relay headers are skipped to the message of the client.
+    ///
+    /// @param data the wire format of the query.
+    /// @param len the length of the query.
+    /// @param [out] type the message type of the client.
+    /// @param [out] client a non-zero hash of the client identifier, zero
+    /// if the client sent none.
+    /// @return false if the query is truncated.
+    static bool peek6(const uint8_t* data, const size_t len, uint8_t& type,
+                      uint32_t& client);
+
+protected:
+    /// @brief Classifies a received query.
+    ///
+    /// @param data the wire format of the query.
+    /// @param len the length of the query.
+    /// @param [out] type the message type, zero if unknown.
+    /// @param [out] client the hash of the client, zero if unknown.
+    /// @return the priority class of the query.
+    Priority classify(const uint8_t* data, const size_t len, uint8_t& type,
+                      uint32_t& client);
+
+    /// @brief Counts a dropped query.
+    void shed(const uint8_t type) {
+        ++shed_[type];
+    }
+
+    /// @brief The protocol of the queries.
+    const Option::Universe universe_;
+
+    /// @brief The maximum number of queries of a priority class.
+    size_t limit_;
+
+    /// @brief The backlog above which low priority queries are dropped.
+    size_t shed_threshold_;
+
+    /// @brief The number of queries waiting in each priority class.
+    size_t sizes_[PRIORITY_COUNT];
+
+    /// @brief The number of queries received.
+    uint64_t received_;
+
+    /// @brief The number of queries dropped, by message type.
+    uint64_t shed_[256];
+};
+
+/// @brief Queues of the received queries, by priority.
+///
+/// When the server falls behind, processing the queries in the order in
+/// which they arrive lets a flood of new clients starve the renewals which
+/// keep the existing clients online. The server reads the queries which
+/// are waiting on its sockets into this queue, which classifies them by a
+/// quick look at their wire format, before they are unpacked, and returns
+/// the high priority ones first: the low priority queries are delayed.
+///
+/// The queries of each class are bounded by a limit: when a class is full,
+/// its oldest query is dropped, as its client has most likely given up
+/// waiting or retransmitted it. When the number of queries waiting exceeds
+/// the shed threshold, the low priority queries are dropped as they are
+/// received. A low priority query from a client with a query of the same
+/// type still waiting replaces it: the client has retransmitted it and only
+/// waits for the answer to the latest. The clients are told apart by a hash
+/// of their identifier, so the query of another client is very rarely
+/// dropped instead, which costs that client a retransmission.
+///
+/// The number of queries dropped is counted by message type.
+///
+/// @tparam PktPtr Pkt4Ptr or Pkt6Ptr, the type of the queries.
+template<typename PktPtr>
+class ReceiveQueue : public ReceiveQueueBase {
+public:
+    /// @brief Constructor.
+    ///
+    /// The queue is disabled.
+    ///
+    /// @param universe V4 or V6, the protocol of the queries.
+    explicit ReceiveQueue(const Option::Universe universe)
+        : ReceiveQueueBase(universe) {
+    }
+
+    /// @brief Queues a received query.
+    ///
+    /// @param query the query, not unpacked.
+    /// @return false if the query was dropped.
+    bool push(const PktPtr& query) {
+        uint8_t type = 0;
+        uint32_t client = 0;
+        const Priority priority =
+            classify(query->data_.empty() ? NULL : &query->data_[0],
+                     query->data_.size(), type, client);
+        std::deque<Entry>& queue = queues_[priority];
+        if (priority != HIGH) {
+            // Under overload, the new clients are turned away first.
+            if (shed_threshold_ > 0 && size() >= shed_threshold_) {
+                shed(type);
+                return (false);
+            }
+            if (client != 0) {
+                for (typename std::deque<Entry>::iterator entry =
+                         queue.begin(); entry != queue.end(); ++entry) {
+                    if (entry->client_ == client && entry->type_ == type) {
+                        shed(type);
+                        queue.erase(entry);
+                        break;
+                    }
+                }
+            }
+        }
+        if (queue.size() >= limit_) {
+            shed(queue.front().type_);
+            queue.pop_front();
+        }
+        queue.push_back(Entry(query, type, client));
+        sizes_[priority] = queue.size();
+        return (true);
+    }
+
+    /// @brief Takes the next query to be processed.
+    ///
+    /// @return the oldest query of the highest priority class, NULL if no
+    /// query is waiting.
+    PktPtr pop() {
+        for (int priority = HIGH; priority < PRIORITY_COUNT; ++priority) {
+            std::deque<Entry>& queue = queues_[priority];
+            if (!queue.empty()) {
+                const PktPtr query = queue.front().query_;
+                queue.pop_front();
+                sizes_[priority] = queue.size();
+                return (query);
+            }
+        }
+        return (PktPtr());
+    }
+
+private:
+    /// @brief A query waiting.
+    struct Entry {
+        Entry(const PktPtr& query, const uint8_t type, const uint32_t client)
+            : query_(query), type_(type), client_(client) {
+        }
+        PktPtr query_;
+        uint8_t type_;
+        uint32_t client_;
+    };
+
+    /// @brief The queries waiting, in the order received, by priority.
+    std::deque<Entry> queues_[PRIORITY_COUNT];
+};
+
+} // end of namespace bundy::dhcp
+} // end of namespace bundy
+
+#endif // RECEIVE_QUEUE_H
@@ -27,6 +27,11 @@ namespace dhcp {
 // This is an initial value of subnet-id. See comments in subnet.h for details.
 SubnetID Subnet::static_id_ = 1;
 
+// Counter of changes to the subnet selection data. See subnet.h.
+uint64_t Subnet::selection_generation_ = 0;
+
+const size_t Subnet::MAX_REQUESTED_OPTIONS_LISTS;
+
 Subnet::Subnet(const bundy::asiolink::IOAddress& prefix, uint8_t len,
                const Triplet<uint32_t>& t1,
                const Triplet<uint32_t>& t2,
@@ -70,11 +75,13 @@ Subnet::addOption(const OptionPtr& option, bool persistent,
 
     // Actually add new option descriptor.
     option_spaces_.addItem(OptionDescriptor(option, persistent), option_space);
+    requested_options_.clear();
 }
 
 void
 Subnet::setRelayInfo(const bundy::dhcp::Subnet::RelayInfo& relay) {
     relay_ = relay;
+    ++selection_generation_;
 }
 
 bool
@@ -84,24 +91,19 @@ Subnet::clientSupported(const bundy::dhcp::ClientClasses& classes) const {
                        // support everyone.
     }
 
-    for (ClientClasses::const_iterator it = white_list_.begin();
-         it != white_list_.end(); ++it) {
-        if (classes.contains(*it)) {
-            return (true);
-        }
-    }
-
-    return (false);
+    return (white_list_.intersects(classes));
 }
 
 void
 Subnet::allowClientClass(const bundy::dhcp::ClientClass& class_name) {
+    ClientClasses::intern(class_name);
     white_list_.insert(class_name);
 }
 
 void
 Subnet::delOptions() {
     option_spaces_.clearItems();
+    requested_options_.clear();
 }
 
 Subnet::OptionContainerPtr
@@ -125,6 +127,32 @@ Subnet::getOptionDescriptor(const std::string& option_space,
     return (*range.first);
 }
 
+Subnet::OptionListPtr
+Subnet::getRequestedOptions(const std::string& option_space,
+                            const std::vector<uint16_t>& option_codes) {
+    const OptionListKey key(option_space, option_codes);
+    std::map<OptionListKey, OptionListPtr>::const_iterator list =
+        requested_options_.find(key);
+    if (list != requested_options_.end()) {
+        return (list->second);
+    }
+
+    boost::shared_ptr<OptionList> options(new OptionList());
+    for (std::vector<uint16_t>::const_iterator code = option_codes.begin();
+         code != option_codes.end(); ++code) {
+        OptionDescriptor desc = getOptionDescriptor(option_space, *code);
+        if (desc.option) {
+            options->push_back(desc.option);
+        }
+    }
+
+    if (requested_options_.size() >= MAX_REQUESTED_OPTIONS_LISTS) {
+        requested_options_.clear();
+    }
+    requested_options_[key] = options;
+    return (options);
+}
+
 void Subnet::addVendorOption(const OptionPtr& option, bool persistent,
                              uint32_t vendor_id){
 
@@ -323,6 +351,7 @@ Subnet::delPools(Lease::Type type) {
 void
 Subnet::setIface(const std::string& iface_name) {
     iface_ = iface_name;
+    ++selection_generation_;
 }
 
 std::string
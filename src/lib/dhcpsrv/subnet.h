@@ -31,6 +31,11 @@
 #include <dhcpsrv/triplet.h>
 #include <dhcpsrv/lease.h>
 
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace bundy {
 namespace dhcp {
 
@@ -84,6 +89,17 @@ public:
     /// A pointer to option descriptor.
     typedef boost::shared_ptr<OptionDescriptor> OptionDescriptorPtr;
 
+    /// @brief List of options configured for a list of option codes.
+    typedef std::vector<OptionPtr> OptionList;
+
+    /// Pointer to the list of options.
+    typedef boost::shared_ptr<const OptionList> OptionListPtr;
+
+    /// @brief Maximum number of option lists held by a subnet.
+    ///
+    /// See @ref getRequestedOptions.
+    static const size_t MAX_REQUESTED_OPTIONS_LISTS = 64;
+
     /// @brief Multi index container for DHCP option descriptors.
     ///
     /// This container comprises three indexes to access option
@@ -274,6 +290,25 @@ public:
     getOptionDescriptor(const std::string& option_space,
                         const uint16_t option_code);
 
+    /// @brief Return the options configured for a list of option codes.
+    ///
+    /// This is used to get the options requested by a client, e.g. in the
+    /// Parameter Request List option. Clients mostly send one of a few
+    /// lists, so the list of options found is remembered for each list of
+    /// codes, and the options are looked up once per list rather than once
+    /// per message. The remembered lists are discarded when the options of
+    /// the subnet change, or all at once when there are more than
+    /// @ref MAX_REQUESTED_OPTIONS_LISTS of them.
+    ///
+    /// @param option_space name of the option space.
+    /// @param option_codes codes of the options to be returned.
+    ///
+    /// @return the first option configured for each code, in the order of
+    /// the codes. Codes for which no option is configured are skipped.
+    OptionListPtr
+    getRequestedOptions(const std::string& option_space,
+                        const std::vector<uint16_t>& option_codes);
+
     /// @brief Return single vendor option descriptor.
     ///
     /// @param vendor_id enterprise id of the option space.
@@ -392,8 +427,24 @@ public:
     /// This should be called during reconfiguration, before any new
     /// subnet objects are created. It will ensure that the subnet_id will
     /// be consistent between reconfigures.
-    static void resetSubnetID() {
-        static_id_ = 1;
+    ///
+    /// @param id the value to reset the counter to. Reconfiguration uses
+    /// values other than 1 to skip the IDs of subnets that are kept from
+    /// the previous configuration.
+    static void resetSubnetID(const SubnetID id = 1) {
+        static_id_ = id;
+    }
+
+    /// @brief Returns the number of changes to subnet selection data.
+    ///
+    /// The value is increased every time the relay address, the interface
+    /// name or the interface-id of any subnet is set. It allows indexes
+    /// over those (see @ref SubnetIndex) to detect that they are out of
+    /// date.
+    ///
+    /// @return the current value of the counter.
+    static uint64_t getSelectionGeneration() {
+        return (selection_generation_);
     }
 
     /// @brief Sets information about relay
@@ -449,7 +500,9 @@ public:
 
     /// @brief adds class class_name to the list of supported classes
     ///
-    /// Also see explanation note in @ref white_list_.
+    /// Also see explanation note in @ref white_list_. The class name is
+    /// interned (see @ref bundy::dhcp::ClientClasses::intern) so that
+    /// @ref clientSupported is a bitwise operation.
     ///
     /// @param class_name client class to be supported by this subnet
     void
@@ -504,6 +557,12 @@ protected:
     /// Static value initialized in subnet.cc.
     static SubnetID static_id_;
 
+    /// @brief counts changes to subnet selection data
+    ///
+    /// See @ref getSelectionGeneration. Static value initialized in
+    /// subnet.cc.
+    static uint64_t selection_generation_;
+
     /// @brief returns the next unique Subnet-ID
     ///
     /// This method generates and returns the next unique subnet-id.
@@ -620,6 +679,12 @@ private:
 
     /// Vendor options are kept here
     VendorOptionSpaceCollection vendor_option_spaces_;
+
+    /// Key of the lists of requested options: option space and codes.
+    typedef std::pair<std::string, std::vector<uint16_t> > OptionListKey;
+
+    /// Lists of options returned by @ref getRequestedOptions.
+    std::map<OptionListKey, OptionListPtr> requested_options_;
 };
 
 /// @brief A generic pointer to either Subnet4 or Subnet6 object
@@ -731,6 +796,7 @@ public:
     /// @param ifaceid pointer to interface-id option
     void setInterfaceId(const OptionPtr& ifaceid) {
         interface_id_ = ifaceid;
+        ++selection_generation_;
     }
 
     /// @brief returns interface-id value (if specified)
@@ -0,0 +1,257 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SUBNET_INDEX_H
+#define SUBNET_INDEX_H
+
+#include <asiolink/io_address.h>
+#include <dhcp/option.h>
+#include <dhcpsrv/addr_utilities.h>
+#include <dhcpsrv/subnet.h>
+
+#include <boost/unordered_map.hpp>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bundy {
+namespace dhcp {
+
+/// @brief Index over a collection of subnets used for subnet selection.
+///
+/// The subnet selection in @c CfgMgr returns the first subnet in the
+/// configured order that matches the client. Scanning the whole collection
+/// for every packet gets expensive with many thousands of subnets, so this
+/// class maps each selection key (the subnet prefix, the relay address, the
+/// interface name and the interface-id option) to the positions of the
+/// subnets matching it. A lookup returns the matching positions in
+/// ascending order, and the caller checks the remaining criteria (such as
+/// client classes) on each of them in turn, which gives the same result as
+/// the linear scan.
+///
+/// Prefixes are indexed by their length: for each prefix length in use
+/// there is a map from the first address of the prefix to the subnets, so
+/// an address lookup takes one search per distinct prefix length.
+///
+/// The index holds positions, so it must be rebuilt whenever the collection
+/// changes. It also remembers @c Subnet::getSelectionGeneration() at the
+/// time it was built: the relay address, interface name and interface-id
+/// can be changed on a subnet that has already been added, and
+/// @c isCurrent() returns false after such a change.
+///
+/// @tparam SubnetCollectionType type of the indexed subnet collection,
+/// a vector of pointers to subnets.
+template<typename SubnetCollectionType>
+class SubnetIndex {
+public:
+
+    /// @brief Positions of subnets in the collection.
+    typedef std::vector<size_t> Positions;
+
+    /// @brief Constructor.
+    ///
+    /// The index is created empty and not current.
+    SubnetIndex() : generation_(0), built_(false) {
+    }
+
+    /// @brief Builds the index for the specified subnets.
+    ///
+    /// The index is built aside and replaces the existing one only when
+    /// complete, so a failure leaves the previous index in place.
+    ///
+    /// @param subnets collection of subnets to be indexed.
+    void build(const SubnetCollectionType& subnets) {
+        SubnetIndex index;
+        for (size_t i = 0; i < subnets.size(); ++i) {
+            index.add(*subnets[i], i);
+        }
+        index.generation_ = Subnet::getSelectionGeneration();
+        index.built_ = true;
+        swap(index);
+    }
+
+    /// @brief Marks the index as out of date.
+    void invalidate() {
+        built_ = false;
+    }
+
+    /// @brief Checks if the index reflects the subnets it was built for.
+    ///
+    /// @return false if the index has not been built since it was
+    /// invalidated, or if the selection data of any subnet has changed
+    /// after it was built.
+    bool isCurrent() const {
+        return (built_ && (generation_ == Subnet::getSelectionGeneration()));
+    }
+
+    /// @brief Returns subnets which may be selected for an address.
+    ///
+    /// @param addr address to be looked up.
+    /// @param relay true if the relay address of the subnets should also be
+    /// matched against the address.
+    /// @param [out] positions ascending positions of the subnets which
+    /// contain the address or, if @c relay is true, have it as the relay
+    /// address. Any previous contents are discarded.
+    void find(const bundy::asiolink::IOAddress& addr, const bool relay,
+              Positions& positions) const {
+        positions.clear();
+        for (typename PrefixMaps::const_iterator prefixes = prefixes_.begin();
+             prefixes != prefixes_.end(); ++prefixes) {
+            // IPv4 addresses can't belong to longer (IPv6) prefixes and the
+            // first address couldn't even be calculated for them.
+            if (addr.isV4() && (prefixes->first > 32)) {
+                continue;
+            }
+            const typename AddressMap::const_iterator subnets =
+                prefixes->second.find(firstAddrInPrefix(addr,
+                                                        prefixes->first));
+            if (subnets != prefixes->second.end()) {
+                positions.insert(positions.end(), subnets->second.begin(),
+                                 subnets->second.end());
+            }
+        }
+        if (relay) {
+            const typename AddressMap::const_iterator subnets =
+                relays_.find(addr);
+            if (subnets != relays_.end()) {
+                positions.insert(positions.end(), subnets->second.begin(),
+                                 subnets->second.end());
+            }
+        }
+        std::sort(positions.begin(), positions.end());
+        positions.erase(std::unique(positions.begin(), positions.end()),
+                        positions.end());
+    }
+
+    /// @brief Returns subnets reachable over an interface.
+    ///
+    /// @param iface interface name.
+    /// @return ascending positions of the subnets with this interface name
+    /// or NULL if there are none.
+    const Positions* findIface(const std::string& iface) const {
+        const typename IfaceMap::const_iterator subnets = ifaces_.find(iface);
+        return (subnets == ifaces_.end() ? NULL : &subnets->second);
+    }
+
+    /// @brief Returns subnets with an interface-id.
+    ///
+    /// @param interface_id interface-id option sent by a relay.
+    /// @return ascending positions of the subnets whose interface-id option
+    /// is equal to the given one or NULL if there are none.
+    const Positions* findInterfaceId(const OptionPtr& interface_id) const {
+        const typename InterfaceIdMap::const_iterator subnets =
+            interface_ids_.find(interfaceIdKey(*interface_id));
+        return (subnets == interface_ids_.end() ? NULL : &subnets->second);
+    }
+
+    /// @brief Exchanges the contents of two indexes.
+    ///
+    /// @param other index to exchange the contents with.
+    void swap(SubnetIndex& other) {
+        prefixes_.swap(other.prefixes_);
+        relays_.swap(other.relays_);
+        ifaces_.swap(other.ifaces_);
+        interface_ids_.swap(other.interface_ids_);
+        std::swap(generation_, other.generation_);
+        std::swap(built_, other.built_);
+    }
+
+private:
+
+    /// @brief Interface-id option key: the option type and data, which
+    /// are what @c Option::equal compares.
+    typedef std::pair<uint16_t, OptionBuffer> InterfaceIdKey;
+
+    /// @brief Map of addresses to subnets.
+    typedef std::map<bundy::asiolink::IOAddress, Positions> AddressMap;
+
+    /// @brief Maps of first addresses of prefixes to subnets, by prefix
+    /// length.
+    typedef std::map<uint8_t, AddressMap> PrefixMaps;
+
+    /// @brief Map of interface names to subnets.
+    typedef boost::unordered_map<std::string, Positions> IfaceMap;
+
+    /// @brief Map of interface-id options to subnets.
+    typedef boost::unordered_map<InterfaceIdKey, Positions> InterfaceIdMap;
+
+    /// @brief Returns the key of an interface-id option.
+    ///
+    /// @param interface_id the option.
+    static InterfaceIdKey interfaceIdKey(const Option& interface_id) {
+        return (InterfaceIdKey(interface_id.getType(),
+                               interface_id.getData()));
+    }
+
+    /// @brief Adds a subnet to the index.
+    ///
+    /// Subnets must be added in the ascending order of positions.
+    ///
+    /// @param subnet subnet to be added.
+    /// @param position position of the subnet in the collection.
+    template<typename SubnetType>
+    void add(SubnetType& subnet, const size_t position) {
+        const std::pair<bundy::asiolink::IOAddress, uint8_t> prefix =
+            subnet.get();
+        prefixes_[prefix.second][firstAddrInPrefix(prefix.first,
+                                                   prefix.second)].
+            push_back(position);
+        relays_[subnet.getRelayInfo().addr_].push_back(position);
+        if (!subnet.getIface().empty()) {
+            ifaces_[subnet.getIface()].push_back(position);
+        }
+        addInterfaceId(subnet, position);
+    }
+
+    /// @brief Adds the interface-id of an IPv6 subnet to the index.
+    ///
+    /// @param subnet subnet to be added.
+    /// @param position position of the subnet in the collection.
+    void addInterfaceId(Subnet6& subnet, const size_t position) {
+        if (subnet.getInterfaceId()) {
+            interface_ids_[interfaceIdKey(*subnet.getInterfaceId())].
+                push_back(position);
+        }
+    }
+
+    /// @brief IPv4 subnets don't have an interface-id.
+    void addInterfaceId(Subnet4&, const size_t) {
+    }
+
+    /// @brief Subnets by prefix.
+    PrefixMaps prefixes_;
+
+    /// @brief Subnets by relay address.
+    AddressMap relays_;
+
+    /// @brief Subnets by interface name.
+    IfaceMap ifaces_;
+
+    /// @brief Subnets by interface-id option.
+    InterfaceIdMap interface_ids_;
+
+    /// @brief Value of @c Subnet::getSelectionGeneration() when built.
+    uint64_t generation_;
+
+    /// @brief Whether the index has been built since last invalidated.
+    bool built_;
+};
+
+} // end of bundy::dhcp namespace
+} // end of bundy namespace
+
+#endif // SUBNET_INDEX_H
@@ -64,6 +64,8 @@ public:
     // Expose internal classes for testing purposes
     using AllocEngine::Allocator;
     using AllocEngine::IterativeAllocator;
+    using AllocEngine::FreeMapAllocator;
+    using AllocEngine::PrefixTreeAllocator;
     using AllocEngine::getAllocator;
 
     /// @brief IterativeAllocator with internal methods exposed
@@ -381,6 +383,7 @@ public:
 
     virtual ~AllocEngine6Test() {
         factory_.destroy();
+        CfgMgr::instance().setHosts(CfgHostsPtr());
     }
 
     DuidPtr duid_;            ///< client-identifier (value used in tests)
@@ -455,6 +458,7 @@ public:
 
     virtual ~AllocEngine4Test() {
         factory_.destroy();
+        CfgMgr::instance().setHosts(CfgHostsPtr());
     }
 
     ClientIdPtr clientid_;    ///< Client-identifier (value used in tests)
@@ -985,6 +989,242 @@ TEST_F(AllocEngine6Test, requestReuseExpiredLease6) {
     detailCompareLease(lease, from_mgr);
 }
 
+// This test checks that a client with reserved addresses gets the first
+// of them which is not leased to another client.
+TEST_F(AllocEngine6Test, reservedAddress6) {
+    boost::scoped_ptr<AllocEngine> engine;
+    ASSERT_NO_THROW(engine.reset(new AllocEngine(AllocEngine::ALLOC_ITERATIVE, 100)));
+    ASSERT_TRUE(engine);
+
+    // Reserve two addresses for the client, one of them out of the pool.
+    CfgHostsPtr hosts(new CfgHosts());
+    HostPtr host(new Host(&duid_->getDuid()[0], duid_->getDuid().size(),
+                          Host::IDENT_DUID, subnet_->getID(),
+                          IOAddress("0.0.0.0")));
+    host->addIPv6Reservation(IOAddress("2001:db8:1::1"));
+    host->addIPv6Reservation(IOAddress("2001:db8:1::2"));
+    hosts->add(host);
+    CfgMgr::instance().setHosts(hosts);
+
+    // The first reserved address is leased to another client.
+    DuidPtr other_duid = DuidPtr(new DUID(vector<uint8_t>(12, 0xff)));
+    Lease6Ptr used(new Lease6(Lease::TYPE_NA, IOAddress("2001:db8:1::1"),
+                              other_duid, 2, 501, 502, 503, 504,
+                              subnet_->getID(), 0));
+    ASSERT_TRUE(LeaseMgrFactory::instance().addLease(used));
+
+    // The hint is ignored.
+    Lease6Ptr lease;
+    EXPECT_NO_THROW(lease = expectOneLease(engine->allocateLeases6(subnet_,
+                    duid_, iaid_, IOAddress("2001:db8:1::15"),
+                    Lease::TYPE_NA, false, false, "", false,
+                    CalloutHandlePtr(), old_leases_)));
+    ASSERT_TRUE(lease);
+    EXPECT_EQ("2001:db8:1::2", lease->addr_.toText());
+
+    // Now the client with another IAID gets an address from the pool.
+    EXPECT_NO_THROW(lease = expectOneLease(engine->allocateLeases6(subnet_,
+                    duid_, iaid_ + 1, IOAddress("::"), Lease::TYPE_NA,
+                    false, false, "", false, CalloutHandlePtr(),
+                    old_leases_)));
+    ASSERT_TRUE(lease);
+    EXPECT_TRUE(subnet_->inPool(Lease::TYPE_NA, lease->addr_));
+}
+
+// This test checks that the addresses reserved for a client are not
+// allocated to other clients, even if they ask for them.
+TEST_F(AllocEngine6Test, addressReservedForOther6) {
+    boost::scoped_ptr<AllocEngine> engine;
+    ASSERT_NO_THROW(engine.reset(new AllocEngine(AllocEngine::ALLOC_ITERATIVE, 100)));
+    ASSERT_TRUE(engine);
+
+    // Reserve the first address of the pool for another client.
+    CfgHostsPtr hosts(new CfgHosts());
+    const vector<uint8_t> other_duid(12, 0xff);
+    HostPtr host(new Host(&other_duid[0], other_duid.size(),
+                          Host::IDENT_DUID, subnet_->getID(),
+                          IOAddress("0.0.0.0")));
+    host->addIPv6Reservation(IOAddress("2001:db8:1::10"));
+    hosts->add(host);
+    CfgMgr::instance().setHosts(hosts);
+
+    // Neither the hint nor the iterative allocator get the address.
+    Lease6Ptr lease;
+    EXPECT_NO_THROW(lease = expectOneLease(engine->allocateLeases6(subnet_,
+                    duid_, iaid_, IOAddress("2001:db8:1::10"),
+                    Lease::TYPE_NA, false, false, "", false,
+                    CalloutHandlePtr(), old_leases_)));
+    ASSERT_TRUE(lease);
+    EXPECT_EQ("2001:db8:1::11", lease->addr_.toText());
+}
+
+// This test checks that the prefix tree allocator can only be used for
+// prefixes, in an IPv6 engine.
+TEST_F(AllocEngine6Test, PrefixTreeAllocatorPDOnly) {
+    boost::scoped_ptr<NakedAllocEngine::Allocator> alloc;
+    EXPECT_THROW(alloc.reset(new NakedAllocEngine::PrefixTreeAllocator(
+                                 Lease::TYPE_NA)), BadValue);
+    EXPECT_NO_THROW(alloc.reset(new NakedAllocEngine::PrefixTreeAllocator(
+                                    Lease::TYPE_PD)));
+
+    boost::scoped_ptr<AllocEngine> engine;
+    EXPECT_THROW(engine.reset(new AllocEngine(AllocEngine::ALLOC_PREFIX_TREE,
+                                              100, false)), BadValue);
+    EXPECT_NO_THROW(engine.reset(new AllocEngine(AllocEngine::ALLOC_PREFIX_TREE,
+                                                 100, true)));
+}
+
+// This test checks that the prefix tree allocator skips the prefixes that are
+// leased, returns those whose leases have expired, tracks changes made
+// through leaseStored() and leaseDeleted(), and starts at the hint.
+TEST_F(AllocEngine6Test, PrefixTreeAllocator) {
+    NakedAllocEngine::PrefixTreeAllocator alloc(Lease::TYPE_PD);
+
+    // Lease 2001:db8:1::/64 - 2001:db8:1:4::/64, with 2001:db8:1:3:: expired.
+    for (int i = 0; i < 5; ++i) {
+        stringstream prefix;
+        prefix << "2001:db8:1:" << i << "::";
+        Lease6Ptr lease(new Lease6(Lease::TYPE_PD, IOAddress(prefix.str()),
+                                   duid_, i, 501, 502, 503, 504,
+                                   subnet_->getID(), 64));
+        if (i == 3) {
+            lease->cltt_ = time(NULL) - 1000;
+        }
+        ASSERT_TRUE(LeaseMgrFactory::instance().addLease(lease));
+    }
+
+    // The trees are built on first use, so the first free prefix is the
+    // expired one.
+    EXPECT_EQ("2001:db8:1:3::", alloc.pickAddress(subnet_, duid_,
+                                                  IOAddress("::")).toText());
+    EXPECT_EQ("2001:db8:1:5::", alloc.pickAddress(subnet_, duid_,
+                                                  IOAddress("::")).toText());
+
+    // Deleting a lease makes the prefix available again, and storing
+    // one marks it as used.
+    alloc.leaseDeleted(IOAddress("2001:db8:1:1::"));
+    Lease6 used(Lease::TYPE_PD, IOAddress("2001:db8:1:6::"), duid_, 6, 501,
+                502, 503, 504, subnet_->getID(), 64);
+    alloc.leaseStored(used);
+    EXPECT_EQ("2001:db8:1:7::", alloc.pickAddress(subnet_, duid_,
+                                                  IOAddress("::")).toText());
+
+    // A hint moves the search to the first free prefix after it. The
+    // prefixes returned are not in use until the engine stores them.
+    EXPECT_EQ("2001:db8:1:1::", alloc.pickAddress(subnet_, duid_,
+                                                  IOAddress("2001:db8:1::"))
+              .toText());
+    EXPECT_EQ("2001:db8:1:3::", alloc.pickAddress(subnet_, duid_,
+                                                  IOAddress("2001:db8:1::"))
+              .toText());
+    EXPECT_EQ("2001:db8:1:80::", alloc.pickAddress(subnet_, duid_,
+                                                   IOAddress("2001:db8:1:80::"))
+              .toText());
+
+    // The search wraps around at the end of the pool.
+    EXPECT_EQ("2001:db8:1:ff::", alloc.pickAddress(subnet_, duid_,
+                                                   IOAddress("2001:db8:1:ff::"))
+              .toText());
+    EXPECT_EQ("2001:db8:1:1::", alloc.pickAddress(subnet_, duid_,
+                                                  IOAddress("2001:db8:1:ff::"))
+              .toText());
+}
+
+// This test checks that the prefix tree allocator handles pools of more
+// prefixes than could be mapped one by one.
+TEST_F(AllocEngine6Test, PrefixTreeAllocatorLargePool) {
+    NakedAllocEngine::PrefixTreeAllocator alloc(Lease::TYPE_PD);
+
+    // A /24 pool of /64 prefixes holds 2^40 prefixes.
+    Subnet6Ptr subnet(new Subnet6(IOAddress("3000::"), 24, 1, 2, 3, 4));
+    subnet->addPool(Pool6Ptr(new Pool6(Lease::TYPE_PD, IOAddress("3000::"),
+                                       24, 64)));
+
+    // The first ones are returned in turn.
+    EXPECT_EQ("3000::", alloc.pickAddress(subnet, duid_,
+                                          IOAddress("::")).toText());
+    EXPECT_EQ("3000:0:0:1::", alloc.pickAddress(subnet, duid_,
+                                                IOAddress("::")).toText());
+
+    // Leases stored anywhere in the pool are skipped.
+    for (int i = 0; i < 4; ++i) {
+        stringstream prefix;
+        prefix << "30ff:ffff:ffff:fff" << 8 + i << "::";
+        Lease6 used(Lease::TYPE_PD, IOAddress(prefix.str()), duid_, i, 501,
+                    502, 503, 504, subnet->getID(), 64);
+        alloc.leaseStored(used);
+    }
+    EXPECT_EQ("30ff:ffff:ffff:fff7::",
+              alloc.pickAddress(subnet, duid_,
+                                IOAddress("30ff:ffff:ffff:fff7::")).toText());
+    EXPECT_EQ("30ff:ffff:ffff:fffc::",
+              alloc.pickAddress(subnet, duid_,
+                                IOAddress("30ff:ffff:ffff:fff7::")).toText());
+
+    // Once freed, a prefix is found again.
+    alloc.leaseDeleted(IOAddress("30ff:ffff:ffff:fff9::"));
+    EXPECT_EQ("30ff:ffff:ffff:fff9::",
+              alloc.pickAddress(subnet, duid_,
+                                IOAddress("30ff:ffff:ffff:fff8::")).toText());
+}
+
+// This test checks that the allocation engine using the prefix tree
+// allocator delegates every prefix in the pool once, and keeps the allocator
+// up to date as it does so.
+TEST_F(AllocEngine6Test, PrefixTreeAllocateWholePool) {
+    // Use a pool of 16 /60 prefixes.
+    CfgMgr::instance().deleteSubnets6();
+    subnet_.reset(new Subnet6(IOAddress("2001:db8:1::"), 56, 1, 2, 3, 4));
+    subnet_->addPool(Pool6Ptr(new Pool6(Lease::TYPE_PD,
+                                        IOAddress("2001:db8:1::"), 56, 60)));
+    CfgMgr::instance().addSubnet6(subnet_);
+
+    boost::scoped_ptr<AllocEngine> engine;
+    ASSERT_NO_THROW(engine.reset(new AllocEngine(AllocEngine::ALLOC_PREFIX_TREE,
+                                                 1)));
+
+    // Another client has delegated a prefix before the tree is built; the
+    // engine must not hand it out.
+    DuidPtr other(new DUID(vector<uint8_t>(8, 0xfe)));
+    Lease6Ptr used(new Lease6(Lease::TYPE_PD, IOAddress("2001:db8:1:20::"),
+                              other, 1, 501, 502, 503, 504, subnet_->getID(),
+                              60));
+    ASSERT_TRUE(LeaseMgrFactory::instance().addLease(used));
+
+    // With a single attempt per allocation, each of the remaining fifteen
+    // prefixes must be found first time.
+    std::set<IOAddress> allocated;
+    for (int i = 0; i < 15; ++i) {
+        DuidPtr duid(new DUID(vector<uint8_t>(8, i)));
+        Lease6Ptr lease;
+        ASSERT_NO_THROW(lease = expectOneLease(engine->allocateLeases6(subnet_,
+                        duid, iaid_, IOAddress("::"), Lease::TYPE_PD, false,
+                        false, "", false, CalloutHandlePtr(), old_leases_)));
+        ASSERT_TRUE(lease) << "allocation " << i << " failed";
+        EXPECT_NE("2001:db8:1:20::", lease->addr_.toText());
+        EXPECT_EQ(60, lease->prefixlen_);
+        EXPECT_TRUE(allocated.insert(lease->addr_).second);
+    }
+
+    // The pool is now full.
+    DuidPtr duid(new DUID(vector<uint8_t>(8, 0x80)));
+    EXPECT_TRUE(engine->allocateLeases6(subnet_, duid, iaid_, IOAddress("::"),
+                                        Lease::TYPE_PD, false, false, "",
+                                        false, CalloutHandlePtr(),
+                                        old_leases_).empty());
+
+    // Releasing a prefix makes it available to the next client.
+    ASSERT_TRUE(LeaseMgrFactory::instance().deleteLease(
+                    IOAddress("2001:db8:1:70::")));
+    engine->leaseDeleted(Lease::TYPE_PD, IOAddress("2001:db8:1:70::"));
+    Lease6Ptr lease;
+    ASSERT_NO_THROW(lease = expectOneLease(engine->allocateLeases6(subnet_,
+                    duid, iaid_, IOAddress("::"), Lease::TYPE_PD, false,
+                    false, "", false, CalloutHandlePtr(), old_leases_)));
+    ASSERT_TRUE(lease);
+    EXPECT_EQ("2001:db8:1:70::", lease->addr_.toText());
+}
+
 // --- IPv4 ---
 
 // This test checks if the v4 Allocation Engine can be instantiated, parses
@@ -1070,6 +1310,72 @@ TEST_F(AllocEngine4Test, fakeAlloc4) {
     ASSERT_FALSE(from_mgr);
 }
 
+// This test checks that the address offered to a client is held: the
+// client gets it again without a search, and other clients don't get it
+// until the client has been allocated a lease.
+TEST_F(AllocEngine4Test, heldOffer4) {
+    boost::scoped_ptr<AllocEngine> engine;
+    ASSERT_NO_THROW(engine.reset(new AllocEngine(AllocEngine::ALLOC_ITERATIVE,
+                                                 100, false)));
+    ASSERT_TRUE(engine);
+    EXPECT_EQ(0, engine->getOfferLifetime());
+    engine->setOfferLifetime(10);
+
+    Lease4Ptr offer = engine->allocateLease4(subnet_, clientid_, hwaddr_,
+                                             IOAddress("192.0.2.105"),
+                                             false, false, "", true,
+                                             CalloutHandlePtr(), old_lease_);
+    ASSERT_TRUE(offer);
+    EXPECT_EQ("192.0.2.105", offer->addr_.toText());
+
+    // The retransmitted DISCOVER gets the same address, whatever its hint.
+    Lease4Ptr lease = engine->allocateLease4(subnet_, clientid_, hwaddr_,
+                                             IOAddress("0.0.0.0"),
+                                             false, false, "", true,
+                                             CalloutHandlePtr(), old_lease_);
+    ASSERT_TRUE(lease);
+    EXPECT_EQ(offer->addr_, lease->addr_);
+
+    // Another client asking for the address gets another one.
+    const uint8_t mac[] = { 0, 0xfe, 0xfe, 0xfe, 0xfe, 0xfe };
+    HWAddrPtr hwaddr2(new HWAddr(mac, sizeof(mac), HTYPE_ETHER));
+    lease = engine->allocateLease4(subnet_, ClientIdPtr(), hwaddr2,
+                                   IOAddress("192.0.2.105"), false, false,
+                                   "", true, CalloutHandlePtr(), old_lease_);
+    ASSERT_TRUE(lease);
+    EXPECT_NE(offer->addr_, lease->addr_);
+    lease = engine->allocateLease4(subnet_, ClientIdPtr(), hwaddr2,
+                                   IOAddress("192.0.2.105"), false, false,
+                                   "", false, CalloutHandlePtr(), old_lease_);
+    ASSERT_TRUE(lease);
+    EXPECT_NE(offer->addr_, lease->addr_);
+
+    // The client requesting the address gets it, and the offer is dropped.
+    lease = engine->allocateLease4(subnet_, clientid_, hwaddr_,
+                                   offer->addr_, false, false, "", false,
+                                   CalloutHandlePtr(), old_lease_);
+    ASSERT_TRUE(lease);
+    EXPECT_EQ(offer->addr_, lease->addr_);
+    EXPECT_TRUE(LeaseMgrFactory::instance().getLease4(offer->addr_));
+
+    // With the offers not held, another client may get the offered
+    // address.
+    engine->setOfferLifetime(0);
+    const uint8_t mac3[] = { 0, 0xfd, 0xfd, 0xfd, 0xfd, 0xfd };
+    HWAddrPtr hwaddr3(new HWAddr(mac3, sizeof(mac3), HTYPE_ETHER));
+    offer = engine->allocateLease4(subnet_, ClientIdPtr(), hwaddr3,
+                                   IOAddress("192.0.2.110"), false, false,
+                                   "", true, CalloutHandlePtr(), old_lease_);
+    ASSERT_TRUE(offer);
+    const uint8_t mac4[] = { 0, 0xfc, 0xfc, 0xfc, 0xfc, 0xfc };
+    HWAddrPtr hwaddr4(new HWAddr(mac4, sizeof(mac4), HTYPE_ETHER));
+    lease = engine->allocateLease4(subnet_, ClientIdPtr(), hwaddr4,
+                                   IOAddress("192.0.2.110"), false, false,
+                                   "", true, CalloutHandlePtr(), old_lease_);
+    ASSERT_TRUE(lease);
+    EXPECT_EQ(offer->addr_, lease->addr_);
+}
+
 
 // This test checks if the allocation with a hint that is valid (in range,
 // in pool and free) can succeed
@@ -1310,6 +1616,149 @@ TEST_F(AllocEngine4Test, IterativeAllocator_manyPools4) {
 }
 
 
+// This test checks that the free map allocator can only be used for IPv4.
+TEST_F(AllocEngine4Test, FreeMapAllocatorV4Only) {
+    boost::scoped_ptr<NakedAllocEngine::Allocator> alloc;
+    EXPECT_THROW(alloc.reset(new NakedAllocEngine::FreeMapAllocator(
+                                 Lease::TYPE_NA)), BadValue);
+    EXPECT_NO_THROW(alloc.reset(new NakedAllocEngine::FreeMapAllocator(
+                                    Lease::TYPE_V4)));
+
+    boost::scoped_ptr<AllocEngine> engine;
+    EXPECT_THROW(engine.reset(new AllocEngine(AllocEngine::ALLOC_FREE_MAP,
+                                              100, true)), BadValue);
+    EXPECT_NO_THROW(engine.reset(new AllocEngine(AllocEngine::ALLOC_FREE_MAP,
+                                                 100, false)));
+}
+
+// This test checks that the free map allocator skips the addresses that are
+// leased, returns those whose leases have expired, and tracks changes made
+// through leaseStored() and leaseDeleted().
+TEST_F(AllocEngine4Test, FreeMapAllocator) {
+    NakedAllocEngine::FreeMapAllocator alloc(Lease::TYPE_V4);
+
+    // Lease .100 - .104 in the pool of .100 - .109, with .103 expired.
+    uint8_t hwaddr[] = { 0, 0xfe, 0xfe, 0xfe, 0xfe, 0xfe };
+    const time_t now = time(NULL);
+    for (int i = 0; i < 5; ++i) {
+        stringstream addr;
+        addr << "192.0.2." << 100 + i;
+        hwaddr[5] = i;
+        Lease4Ptr lease(new Lease4(IOAddress(addr.str()), hwaddr,
+                                   sizeof(hwaddr), NULL, 0, 500, 501, 502,
+                                   (i == 3) ? now - 1000 : now,
+                                   subnet_->getID()));
+        ASSERT_TRUE(LeaseMgrFactory::instance().addLease(lease));
+    }
+
+    // The map is built on first use, so the first free address is the
+    // expired one.
+    EXPECT_EQ("192.0.2.103", alloc.pickAddress(subnet_, clientid_,
+                                               IOAddress("0.0.0.0")).toText());
+    EXPECT_EQ("192.0.2.105", alloc.pickAddress(subnet_, clientid_,
+                                               IOAddress("0.0.0.0")).toText());
+
+    // Deleting a lease makes the address available again, and storing
+    // one marks it as used.
+    alloc.leaseDeleted(IOAddress("192.0.2.101"));
+    hwaddr[5] = 6;
+    Lease4 used(IOAddress("192.0.2.106"), hwaddr, sizeof(hwaddr), NULL, 0,
+                500, 501, 502, now, subnet_->getID());
+    alloc.leaseStored(used);
+
+    EXPECT_EQ("192.0.2.107", alloc.pickAddress(subnet_, clientid_,
+                                               IOAddress("0.0.0.0")).toText());
+    EXPECT_EQ("192.0.2.108", alloc.pickAddress(subnet_, clientid_,
+                                               IOAddress("0.0.0.0")).toText());
+    EXPECT_EQ("192.0.2.109", alloc.pickAddress(subnet_, clientid_,
+                                               IOAddress("0.0.0.0")).toText());
+    // ... and wraps around.
+    EXPECT_EQ("192.0.2.101", alloc.pickAddress(subnet_, clientid_,
+                                               IOAddress("0.0.0.0")).toText());
+    EXPECT_EQ("192.0.2.103", alloc.pickAddress(subnet_, clientid_,
+                                               IOAddress("0.0.0.0")).toText());
+}
+
+// This test checks that the free map allocator still returns addresses in
+// the pool when all of them are believed to be in use.
+TEST_F(AllocEngine4Test, FreeMapAllocatorFullPool) {
+    NakedAllocEngine::FreeMapAllocator alloc(Lease::TYPE_V4);
+
+    uint8_t hwaddr[] = { 0, 0xfe, 0xfe, 0xfe, 0xfe, 0xfe };
+    for (int i = 0; i < 10; ++i) {
+        stringstream addr;
+        addr << "192.0.2." << 100 + i;
+        hwaddr[5] = i;
+        Lease4Ptr lease(new Lease4(IOAddress(addr.str()), hwaddr,
+                                   sizeof(hwaddr), NULL, 0, 500, 501, 502,
+                                   time(NULL), subnet_->getID()));
+        ASSERT_TRUE(LeaseMgrFactory::instance().addLease(lease));
+    }
+
+    for (int i = 0; i < 20; ++i) {
+        IOAddress candidate = alloc.pickAddress(subnet_, clientid_,
+                                                IOAddress("0.0.0.0"));
+        EXPECT_TRUE(subnet_->inPool(Lease::TYPE_V4, candidate));
+    }
+
+    // Once one is freed, it is found.
+    alloc.leaseDeleted(IOAddress("192.0.2.104"));
+    EXPECT_EQ("192.0.2.104", alloc.pickAddress(subnet_, clientid_,
+                                               IOAddress("0.0.0.0")).toText());
+}
+
+// This test checks that the allocation engine using the free map allocator
+// allocates every address in the pool once, and keeps the allocator up to
+// date as it does so.
+TEST_F(AllocEngine4Test, FreeMapAllocateWholePool) {
+    boost::scoped_ptr<AllocEngine> engine;
+    ASSERT_NO_THROW(engine.reset(new AllocEngine(AllocEngine::ALLOC_FREE_MAP,
+                                                 1, false)));
+
+    // Another client takes one address behind the engine's back before the
+    // map is built; the engine must not hand it out.
+    uint8_t other_hwaddr[] = { 0, 0xfe, 0xfe, 0xfe, 0xfe, 0xfe };
+    Lease4Ptr other(new Lease4(IOAddress("192.0.2.102"), other_hwaddr,
+                               sizeof(other_hwaddr), NULL, 0, 500, 501, 502,
+                               time(NULL), subnet_->getID()));
+    ASSERT_TRUE(LeaseMgrFactory::instance().addLease(other));
+
+    // With a single attempt per allocation, each of the remaining nine
+    // addresses must be found first time.
+    std::set<IOAddress> allocated;
+    for (int i = 0; i < 9; ++i) {
+        uint8_t mac[] = { 0, 1, 2, 3, 4, static_cast<uint8_t>(i) };
+        HWAddrPtr hwaddr(new HWAddr(mac, sizeof(mac), HTYPE_ETHER));
+        Lease4Ptr lease = engine->allocateLease4(subnet_, ClientIdPtr(),
+                                                 hwaddr, IOAddress("0.0.0.0"),
+                                                 false, false, "", false,
+                                                 CalloutHandlePtr(),
+                                                 old_lease_);
+        ASSERT_TRUE(lease) << "allocation " << i << " failed";
+        EXPECT_NE("192.0.2.102", lease->addr_.toText());
+        EXPECT_TRUE(allocated.insert(lease->addr_).second);
+    }
+
+    // The pool is now full.
+    uint8_t mac[] = { 0, 1, 2, 3, 5, 0 };
+    HWAddrPtr hwaddr(new HWAddr(mac, sizeof(mac), HTYPE_ETHER));
+    EXPECT_FALSE(engine->allocateLease4(subnet_, ClientIdPtr(), hwaddr,
+                                        IOAddress("0.0.0.0"), false, false,
+                                        "", false, CalloutHandlePtr(),
+                                        old_lease_));
+
+    // Releasing an address makes it available to the next client.
+    ASSERT_TRUE(LeaseMgrFactory::instance().deleteLease(
+                    IOAddress("192.0.2.107")));
+    engine->leaseDeleted(Lease::TYPE_V4, IOAddress("192.0.2.107"));
+    Lease4Ptr lease = engine->allocateLease4(subnet_, ClientIdPtr(), hwaddr,
+                                             IOAddress("0.0.0.0"), false,
+                                             false, "", false,
+                                             CalloutHandlePtr(), old_lease_);
+    ASSERT_TRUE(lease);
+    EXPECT_EQ("192.0.2.107", lease->addr_.toText());
+}
+
 // This test checks if really small pools are working
 TEST_F(AllocEngine4Test, smallPool4) {
     boost::scoped_ptr<AllocEngine> engine;
@@ -1556,6 +2005,97 @@ TEST_F(AllocEngine4Test, renewLease4) {
     detailCompareLease(lease, from_mgr);
 }
 
+// This test checks that a client with a reserved address gets it, even if
+// it is out of the pool and the client asks for another address.
+TEST_F(AllocEngine4Test, reservedAddress4) {
+    boost::scoped_ptr<AllocEngine> engine;
+    ASSERT_NO_THROW(engine.reset(new AllocEngine(AllocEngine::ALLOC_ITERATIVE,
+                                                 100, false)));
+    ASSERT_TRUE(engine);
+
+    CfgHostsPtr hosts(new CfgHosts());
+    hosts->add(HostPtr(new Host(&hwaddr_->hwaddr_[0], hwaddr_->hwaddr_.size(),
+                                Host::IDENT_HWADDR, subnet_->getID(),
+                                IOAddress("192.0.2.10"))));
+    CfgMgr::instance().setHosts(hosts);
+
+    Lease4Ptr lease = engine->allocateLease4(subnet_, clientid_, hwaddr_,
+                                             IOAddress("192.0.2.105"),
+                                             false, false, "",
+                                             false, CalloutHandlePtr(),
+                                             old_lease_);
+    ASSERT_TRUE(lease);
+    EXPECT_FALSE(old_lease_);
+    EXPECT_EQ("192.0.2.10", lease->addr_.toText());
+
+    Lease4Ptr from_mgr = LeaseMgrFactory::instance().getLease4(lease->addr_);
+    ASSERT_TRUE(from_mgr);
+    detailCompareLease(lease, from_mgr);
+}
+
+// This test checks that a client whose reserved address is leased to
+// another client gets an address from the pool.
+TEST_F(AllocEngine4Test, reservedAddressInUse4) {
+    boost::scoped_ptr<AllocEngine> engine;
+    ASSERT_NO_THROW(engine.reset(new AllocEngine(AllocEngine::ALLOC_ITERATIVE,
+                                                 100, false)));
+    ASSERT_TRUE(engine);
+
+    // The client is identified by its client identifier.
+    CfgHostsPtr hosts(new CfgHosts());
+    hosts->add(HostPtr(new Host(&clientid_->getClientId()[0],
+                                clientid_->getClientId().size(),
+                                Host::IDENT_CLIENT_ID, subnet_->getID(),
+                                IOAddress("192.0.2.101"))));
+    CfgMgr::instance().setHosts(hosts);
+
+    uint8_t hwaddr2[] = { 0, 0xfe, 0xfe, 0xfe, 0xfe, 0xfe};
+    uint8_t clientid2[] = { 8, 7, 6, 5, 4, 3, 2, 1 };
+    Lease4Ptr used(new Lease4(IOAddress("192.0.2.101"), hwaddr2,
+                              sizeof(hwaddr2), clientid2, sizeof(clientid2),
+                              1, 2, 3, time(NULL), subnet_->getID()));
+    ASSERT_TRUE(LeaseMgrFactory::instance().addLease(used));
+
+    Lease4Ptr lease = engine->allocateLease4(subnet_, clientid_, hwaddr_,
+                                             IOAddress("0.0.0.0"),
+                                             false, false, "",
+                                             false, CalloutHandlePtr(),
+                                             old_lease_);
+    ASSERT_TRUE(lease);
+    EXPECT_NE("192.0.2.101", lease->addr_.toText());
+    checkLease4(lease);
+}
+
+// This test checks that the addresses reserved for a client are not
+// allocated to other clients, even if they ask for them.
+TEST_F(AllocEngine4Test, addressReservedForOther4) {
+    boost::scoped_ptr<AllocEngine> engine;
+    ASSERT_NO_THROW(engine.reset(new AllocEngine(AllocEngine::ALLOC_ITERATIVE,
+                                                 100, false)));
+    ASSERT_TRUE(engine);
+
+    // Reserve the first two addresses of the pool for other clients.
+    CfgHostsPtr hosts(new CfgHosts());
+    const uint8_t hwaddr2[] = { 0, 0xfe, 0xfe, 0xfe, 0xfe, 0xfe};
+    const uint8_t hwaddr3[] = { 0, 0xfe, 0xfe, 0xfe, 0xfe, 0xff};
+    hosts->add(HostPtr(new Host(hwaddr2, sizeof(hwaddr2), Host::IDENT_HWADDR,
+                                subnet_->getID(),
+                                IOAddress("192.0.2.100"))));
+    hosts->add(HostPtr(new Host(hwaddr3, sizeof(hwaddr3), Host::IDENT_HWADDR,
+                                subnet_->getID(),
+                                IOAddress("192.0.2.101"))));
+    CfgMgr::instance().setHosts(hosts);
+
+    Lease4Ptr lease = engine->allocateLease4(subnet_, clientid_, hwaddr_,
+                                             IOAddress("192.0.2.100"),
+                                             false, false, "",
+                                             false, CalloutHandlePtr(),
+                                             old_lease_);
+    ASSERT_TRUE(lease);
+    EXPECT_EQ("192.0.2.102", lease->addr_.toText());
+    checkLease4(lease);
+}
+
 /// @brief helper class used in Hooks testing in AllocEngine6
 ///
 /// It features a couple of callout functions and buffers to store
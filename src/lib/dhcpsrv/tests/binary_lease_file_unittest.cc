@@ -0,0 +1,268 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+#include <asiolink/io_address.h>
+#include <dhcp/duid.h>
+#include <dhcpsrv/binary_lease_file.h>
+#include <dhcpsrv/lease.h>
+#include <dhcpsrv/tests/lease_file_io.h>
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace bundy;
+using namespace bundy::asiolink;
+using namespace bundy::dhcp;
+using namespace bundy::dhcp::test;
+
+namespace {
+
+const uint8_t HWADDR0[] = { 0, 1, 2, 3, 4, 5 };
+const uint8_t CLIENTID0[] = { 1, 2, 3, 4 };
+const uint8_t DUID0[] = { 0, 1, 0, 1, 0x0d, 0xde, 0xba, 0x0d };
+
+/// @brief Test fixture class for the binary lease files.
+class BinaryLeaseFileTest : public ::testing::Test {
+public:
+    /// @brief Constructor.
+    BinaryLeaseFileTest()
+        : filename_(absolutePath("leases.bin")), io_(filename_),
+          csv_io_(absolutePath("leases.csv")) {
+        io_.removeFile();
+        csv_io_.removeFile();
+    }
+
+    /// @brief Prepends the absolute path to the file specified
+    /// as an argument.
+    static std::string absolutePath(const std::string& filename) {
+        std::ostringstream s;
+        s << DHCP_DATA_DIR << "/" << filename;
+        return (s.str());
+    }
+
+    /// @brief Creates the DHCPv4 leases used by the tests.
+    static std::vector<Lease4Ptr> createLeases4() {
+        std::vector<Lease4Ptr> leases;
+        leases.push_back(Lease4Ptr(new Lease4(IOAddress("192.0.2.1"),
+                                              HWADDR0, sizeof(HWADDR0),
+                                              CLIENTID0, sizeof(CLIENTID0),
+                                              200, 0, 0, 1000, 8, true, true,
+                                              "host.example.com")));
+        leases.push_back(Lease4Ptr(new Lease4(IOAddress("192.0.3.15"),
+                                              HWADDR0, sizeof(HWADDR0),
+                                              NULL, 0, 100, 0, 0, 2000, 7)));
+        return (leases);
+    }
+
+    /// @brief Creates the DHCPv6 leases used by the tests.
+    static std::vector<Lease6Ptr> createLeases6() {
+        DuidPtr duid(new DUID(DUID0, sizeof(DUID0)));
+        std::vector<Lease6Ptr> leases;
+        leases.push_back(Lease6Ptr(new Lease6(Lease::TYPE_NA,
+                                              IOAddress("2001:db8:1::1"),
+                                              duid, 128, 100, 200, 0, 0, 8,
+                                              true, false,
+                                              "host.example.com")));
+        leases.push_back(Lease6Ptr(new Lease6(Lease::TYPE_PD,
+                                              IOAddress("3000:1::"), duid,
+                                              7, 150, 300, 0, 0, 6, false,
+                                              true, "", 64)));
+        leases[0]->cltt_ = 1000;
+        leases[1]->cltt_ = 2000;
+        return (leases);
+    }
+
+    /// @brief Checks that the DHCPv4 leases read are the expected ones.
+    template<typename LeaseFileType>
+    void checkLeases4(LeaseFileType& lf) {
+        const std::vector<Lease4Ptr> leases = createLeases4();
+        Lease4Ptr lease;
+        for (size_t i = 0; i < leases.size(); ++i) {
+            ASSERT_TRUE(lf.next(lease)) << lf.getReadMsg();
+            ASSERT_TRUE(lease);
+            EXPECT_TRUE(*leases[i] == *lease) << lease->toText();
+        }
+        EXPECT_TRUE(lf.next(lease));
+        EXPECT_FALSE(lease);
+    }
+
+    /// @brief Checks that the DHCPv6 leases read are the expected ones.
+    template<typename LeaseFileType>
+    void checkLeases6(LeaseFileType& lf) {
+        const std::vector<Lease6Ptr> leases = createLeases6();
+        Lease6Ptr lease;
+        for (size_t i = 0; i < leases.size(); ++i) {
+            ASSERT_TRUE(lf.next(lease)) << lf.getReadMsg();
+            ASSERT_TRUE(lease);
+            EXPECT_TRUE(*leases[i] == *lease) << lease->toText();
+        }
+        EXPECT_TRUE(lf.next(lease));
+        EXPECT_FALSE(lease);
+    }
+
+    /// @brief Writes the DHCPv4 leases to the binary lease file.
+    void writeLeases4() {
+        BinaryLeaseFile4 lf(filename_);
+        ASSERT_NO_THROW(lf.recreate());
+        const std::vector<Lease4Ptr> leases = createLeases4();
+        for (size_t i = 0; i < leases.size(); ++i) {
+            ASSERT_NO_THROW(lf.append(*leases[i]));
+        }
+    }
+
+    /// @brief Name of the test lease file.
+    std::string filename_;
+
+    /// @brief Object providing access to the binary lease file IO.
+    LeaseFileIO io_;
+
+    /// @brief Object providing access to the CSV lease file IO.
+    LeaseFileIO csv_io_;
+};
+
+// Checks that the DHCPv4 leases appended are read back.
+TEST_F(BinaryLeaseFileTest, appendAndRead4) {
+    writeLeases4();
+    BinaryLeaseFile4 lf(filename_);
+    ASSERT_NO_THROW(lf.open());
+    checkLeases4(lf);
+
+    // The leases can be appended after the existing ones.
+    ASSERT_NO_THROW(lf.append(*createLeases4()[0]));
+    ASSERT_NO_THROW(lf.open());
+    Lease4Ptr lease;
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(lf.next(lease));
+        EXPECT_TRUE(lease);
+    }
+    EXPECT_TRUE(lf.next(lease));
+    EXPECT_FALSE(lease);
+}
+
+// Checks that the DHCPv6 leases appended are read back, and that the
+// records are buffered until flushed when the auto flush is disabled.
+TEST_F(BinaryLeaseFileTest, appendAndRead6) {
+    BinaryLeaseFile6 lf(filename_);
+    ASSERT_NO_THROW(lf.open());
+    lf.setAutoFlush(false);
+    const std::vector<Lease6Ptr> leases = createLeases6();
+    for (size_t i = 0; i < leases.size(); ++i) {
+        ASSERT_NO_THROW(lf.append(*leases[i]));
+    }
+    EXPECT_EQ(BinaryLeaseFile::HEADER_LEN, io_.readFile().size());
+    ASSERT_NO_THROW(lf.sync());
+    EXPECT_LT(BinaryLeaseFile::HEADER_LEN, io_.readFile().size());
+
+    BinaryLeaseFile6 lf2(filename_);
+    ASSERT_NO_THROW(lf2.open());
+    checkLeases6(lf2);
+}
+
+// Checks that a file of another type of leases or version is rejected.
+TEST_F(BinaryLeaseFileTest, badHeader) {
+    writeLeases4();
+    BinaryLeaseFile6 lf6(filename_);
+    EXPECT_THROW(lf6.open(), BinaryLeaseFileError);
+
+    std::string contents = io_.readFile();
+    contents[5] = 2;
+    io_.writeFile(contents);
+    BinaryLeaseFile4 lf4(filename_);
+    EXPECT_THROW(lf4.open(), BinaryLeaseFileError);
+
+    io_.writeFile("BLF");
+    EXPECT_THROW(lf4.open(), BinaryLeaseFileError);
+}
+
+// Checks that a partially written record at the end of the file is dropped
+// and overwritten by the next record.
+TEST_F(BinaryLeaseFileTest, truncatedRecord) {
+    writeLeases4();
+    const std::string contents = io_.readFile();
+    io_.writeFile(contents.substr(0, contents.size() - 3));
+
+    BinaryLeaseFile4 lf(filename_);
+    ASSERT_NO_THROW(lf.open());
+    Lease4Ptr lease;
+    ASSERT_TRUE(lf.next(lease));
+    ASSERT_TRUE(lease);
+    EXPECT_TRUE(lf.next(lease));
+    EXPECT_FALSE(lease);
+
+    ASSERT_NO_THROW(lf.append(*createLeases4()[1]));
+    EXPECT_EQ(contents, io_.readFile());
+    ASSERT_NO_THROW(lf.open());
+    checkLeases4(lf);
+}
+
+// Checks that a corrupted record which isn't the last one is an error.
+TEST_F(BinaryLeaseFileTest, badChecksum) {
+    writeLeases4();
+    std::string contents = io_.readFile();
+    contents[BinaryLeaseFile::HEADER_LEN +
+             BinaryLeaseFile::RECORD_HEADER_LEN] ^= 1;
+    io_.writeFile(contents);
+
+    BinaryLeaseFile4 lf(filename_);
+    ASSERT_NO_THROW(lf.open());
+    Lease4Ptr lease;
+    EXPECT_FALSE(lf.next(lease));
+    EXPECT_FALSE(lease);
+    EXPECT_NE(std::string::npos, lf.getReadMsg().find("checksum"));
+}
+
+// Checks the conversion of the DHCPv4 leases to and from the CSV format.
+TEST_F(BinaryLeaseFileTest, convert4) {
+    writeLeases4();
+    BinaryLeaseFile4 binary_lf(filename_);
+    ASSERT_NO_THROW(binary_lf.open());
+    CSVLeaseFile4 csv_lf(csv_io_.testfile_);
+    ASSERT_NO_THROW(csv_lf.recreate());
+    EXPECT_EQ(2, convertLeaseFile(binary_lf, csv_lf));
+    csv_lf.close();
+
+    io_.removeFile();
+    ASSERT_NO_THROW(csv_lf.open());
+    ASSERT_NO_THROW(binary_lf.recreate());
+    EXPECT_EQ(2, convertLeaseFile(csv_lf, binary_lf));
+    ASSERT_NO_THROW(binary_lf.open());
+    checkLeases4(binary_lf);
+}
+
+// Checks the conversion of the DHCPv6 leases to and from the CSV format.
+TEST_F(BinaryLeaseFileTest, convert6) {
+    CSVLeaseFile6 csv_lf(csv_io_.testfile_);
+    ASSERT_NO_THROW(csv_lf.recreate());
+    const std::vector<Lease6Ptr> leases = createLeases6();
+    for (size_t i = 0; i < leases.size(); ++i) {
+        csv_lf.append(*leases[i]);
+    }
+    csv_lf.close();
+
+    ASSERT_NO_THROW(csv_lf.open());
+    BinaryLeaseFile6 binary_lf(filename_);
+    ASSERT_NO_THROW(binary_lf.recreate());
+    EXPECT_EQ(2, convertLeaseFile(csv_lf, binary_lf));
+    ASSERT_NO_THROW(binary_lf.open());
+    checkLeases6(binary_lf);
+
+    ASSERT_NO_THROW(binary_lf.open());
+    ASSERT_NO_THROW(csv_lf.recreate());
+    EXPECT_EQ(2, convertLeaseFile(binary_lf, csv_lf));
+    csv_lf.close();
+    ASSERT_NO_THROW(csv_lf.open());
+    checkLeases6(csv_lf);
+}
+
+}
@@ -102,6 +102,28 @@ TEST(CalloutHandleStoreTest, StoreRetrieve) {
     EXPECT_EQ(1, pktptr_2.use_count());
 }
 
+// Check that the handle of a packet resumed after others is the one passed
+// along with it.
+
+TEST(CalloutHandleStoreTest, ResumedPacket) {
+    Pkt4Ptr pktptr_1(new Pkt4(DHCPDISCOVER, 1234));
+    Pkt4Ptr pktptr_2(new Pkt4(DHCPDISCOVER, 5678));
+
+    CalloutHandlePtr chptr_1 = getCalloutHandle(pktptr_1);
+    ASSERT_TRUE(chptr_1);
+    CalloutHandlePtr chptr_2 = getCalloutHandle(pktptr_2);
+    EXPECT_FALSE(chptr_1 == chptr_2);
+
+    // The first packet is resumed with its handle.
+    EXPECT_TRUE(chptr_1 == getCalloutHandle(pktptr_1, chptr_1));
+    EXPECT_TRUE(chptr_1 == getCalloutHandle(pktptr_1));
+
+    // Clear the stored pointers.
+    EXPECT_FALSE(getCalloutHandle(Pkt4Ptr()));
+    EXPECT_EQ(1, chptr_1.use_count());
+    EXPECT_EQ(1, pktptr_1.use_count());
+}
+
 // The followings is a trival test to check that if the template function
 // is referred to in a separate compilation unit, only one copy of the static
 // objects stored in it are returned.  (For a change, we'll use a Pkt6 as the
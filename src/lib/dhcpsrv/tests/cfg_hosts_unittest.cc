@@ -0,0 +1,164 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <dhcpsrv/cfg_hosts.h>
+
+#include <gtest/gtest.h>
+
+using namespace bundy;
+using namespace bundy::asiolink;
+using namespace bundy::dhcp;
+
+namespace {
+
+/// @brief Test fixture class for the host reservations.
+class CfgHostsTest : public ::testing::Test {
+public:
+    /// @brief Constructor.
+    ///
+    /// Creates the identifiers used in the tests.
+    CfgHostsTest() {
+        const uint8_t mac[] = { 0, 1, 2, 3, 4, 5 };
+        hwaddr_.reset(new HWAddr(mac, sizeof(mac), HTYPE_ETHER));
+        clientid_.reset(new ClientId(std::vector<uint8_t>(8, 0x44)));
+        duid_.reset(new DUID(std::vector<uint8_t>(8, 0x42)));
+    }
+
+    /// @brief Creates a host identified by the hardware address.
+    HostPtr hwaddrHost(const SubnetID subnet_id, const char* address) const {
+        return (HostPtr(new Host(&hwaddr_->hwaddr_[0],
+                                 hwaddr_->hwaddr_.size(), Host::IDENT_HWADDR,
+                                 subnet_id, IOAddress(address))));
+    }
+
+    HWAddrPtr hwaddr_;
+    ClientIdPtr clientid_;
+    DuidPtr duid_;
+    CfgHosts hosts_;
+};
+
+// This test checks that the DHCPv4 hosts are found by their identifiers
+// and by their reserved addresses, in their subnet only.
+TEST_F(CfgHostsTest, get4) {
+    EXPECT_TRUE(hosts_.empty());
+    EXPECT_FALSE(hosts_.get4(1, hwaddr_, clientid_));
+
+    ASSERT_NO_THROW(hosts_.add(hwaddrHost(1, "192.0.2.10")));
+    HostPtr by_clientid(new Host(&clientid_->getClientId()[0],
+                                 clientid_->getClientId().size(),
+                                 Host::IDENT_CLIENT_ID, 2,
+                                 IOAddress("192.0.3.10")));
+    ASSERT_NO_THROW(hosts_.add(by_clientid));
+    EXPECT_EQ(2, hosts_.size());
+
+    ConstHostPtr host = hosts_.get4(1, hwaddr_, clientid_);
+    ASSERT_TRUE(host);
+    EXPECT_EQ("192.0.2.10", host->getIPv4Reservation().toText());
+    EXPECT_EQ(host, hosts_.get(1, IOAddress("192.0.2.10")));
+
+    // The host in the subnet 2 is found by the client identifier.
+    EXPECT_EQ(by_clientid, hosts_.get4(2, hwaddr_, clientid_));
+    EXPECT_EQ(by_clientid, hosts_.get4(2, HWAddrPtr(), clientid_));
+    EXPECT_FALSE(hosts_.get4(2, hwaddr_));
+    EXPECT_EQ(by_clientid, hosts_.get(2, IOAddress("192.0.3.10")));
+
+    // Nothing is found in other subnets.
+    EXPECT_FALSE(hosts_.get4(3, hwaddr_, clientid_));
+    EXPECT_FALSE(hosts_.get(2, IOAddress("192.0.2.10")));
+    EXPECT_FALSE(hosts_.get(1, IOAddress("192.0.2.11")));
+}
+
+// This test checks that the DHCPv6 hosts are found by their identifiers
+// and by each of their reserved addresses.
+TEST_F(CfgHostsTest, get6) {
+    HostPtr host(new Host(&duid_->getDuid()[0], duid_->getDuid().size(),
+                          Host::IDENT_DUID, 1, IOAddress("0.0.0.0")));
+    host->addIPv6Reservation(IOAddress("2001:db8::1"));
+    host->addIPv6Reservation(IOAddress("2001:db8::2"));
+    ASSERT_NO_THROW(hosts_.add(host));
+
+    EXPECT_EQ(host, hosts_.get6(1, duid_));
+    EXPECT_EQ(host, hosts_.get6(1, duid_, hwaddr_));
+    EXPECT_FALSE(hosts_.get6(1, DuidPtr(), hwaddr_));
+    EXPECT_FALSE(hosts_.get6(2, duid_));
+    EXPECT_EQ(host, hosts_.get(1, IOAddress("2001:db8::1")));
+    EXPECT_EQ(host, hosts_.get(1, IOAddress("2001:db8::2")));
+    EXPECT_FALSE(hosts_.get(1, IOAddress("2001:db8::3")));
+
+    // The hardware address is used if there is no host for the DUID.
+    ASSERT_NO_THROW(hosts_.add(hwaddrHost(1, "0.0.0.0")));
+    DuidPtr other_duid(new DUID(std::vector<uint8_t>(8, 0x43)));
+    host = boost::const_pointer_cast<Host>(hosts_.get6(1, other_duid,
+                                                       hwaddr_));
+    ASSERT_TRUE(host);
+    EXPECT_EQ(Host::IDENT_HWADDR, host->getIdentifierType());
+}
+
+// This test checks that duplicate hosts and reserved addresses are
+// rejected, leaving the reservations as they were.
+TEST_F(CfgHostsTest, duplicates) {
+    ASSERT_NO_THROW(hosts_.add(hwaddrHost(1, "192.0.2.10")));
+
+    // The same host in the same subnet.
+    EXPECT_THROW(hosts_.add(hwaddrHost(1, "192.0.2.11")), DuplicateHost);
+    EXPECT_FALSE(hosts_.get(1, IOAddress("192.0.2.11")));
+
+    // The same host in another subnet is fine.
+    EXPECT_NO_THROW(hosts_.add(hwaddrHost(2, "192.0.3.10")));
+
+    // An address reserved twice.
+    const uint8_t mac[] = { 0, 1, 2, 3, 4, 6 };
+    EXPECT_THROW(hosts_.add(HostPtr(new Host(mac, sizeof(mac),
+                                             Host::IDENT_HWADDR, 1,
+                                             IOAddress("192.0.2.10")))),
+                 DuplicateHost);
+    EXPECT_EQ(2, hosts_.size());
+
+    // A host with an IPv6 address already reserved.
+    HostPtr host(new Host(&duid_->getDuid()[0], duid_->getDuid().size(),
+                          Host::IDENT_DUID, 1, IOAddress("0.0.0.0")));
+    host->addIPv6Reservation(IOAddress("2001:db8::1"));
+    host->addIPv6Reservation(IOAddress("2001:db8::1"));
+    EXPECT_THROW(hosts_.add(host), DuplicateHost);
+    EXPECT_EQ(2, hosts_.size());
+    EXPECT_FALSE(hosts_.get(1, IOAddress("2001:db8::1")));
+    EXPECT_FALSE(hosts_.get6(1, duid_));
+}
+
+// This test checks that a large number of hosts can be added and found.
+TEST_F(CfgHostsTest, manyHosts) {
+    const size_t count = 10000;
+    hosts_.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint8_t mac[] = { 0, 1, static_cast<uint8_t>(i >> 24),
+                                static_cast<uint8_t>(i >> 16),
+                                static_cast<uint8_t>(i >> 8),
+                                static_cast<uint8_t>(i) };
+        ASSERT_NO_THROW(hosts_.add(HostPtr(new Host(mac, sizeof(mac),
+                                                    Host::IDENT_HWADDR, 1,
+                                                    IOAddress(0x0a000000 + i)))));
+    }
+    EXPECT_EQ(count, hosts_.size());
+
+    const uint8_t mac[] = { 0, 1, 0, 0, 0x12, 0x34 };
+    HWAddrPtr hwaddr(new HWAddr(mac, sizeof(mac), HTYPE_ETHER));
+    ConstHostPtr host = hosts_.get4(1, hwaddr);
+    ASSERT_TRUE(host);
+    EXPECT_EQ("10.0.18.52", host->getIPv4Reservation().toText());
+    EXPECT_EQ(host, hosts_.get(1, IOAddress("10.0.18.52")));
+}
+
+} // end of anonymous namespace
@@ -185,6 +185,7 @@ public:
         CfgMgr::instance().deleteSubnets4();
         CfgMgr::instance().deleteSubnets6();
         CfgMgr::instance().deleteOptionDefs();
+        CfgMgr::instance().setAutoPublish(true);
     }
 
     /// used in client classification (or just empty container for other tests)
@@ -330,6 +331,32 @@ TEST_F(CfgMgrTest, getOptionDef) {
 
 }
 
+// This test verifies that the tables of option definitions returned by
+// getOptionDefTable are indexed by the option code.
+TEST_F(CfgMgrTest, getOptionDefTable) {
+    CfgMgr& cfg_mgr = CfgMgr::instance();
+    EXPECT_FALSE(cfg_mgr.getOptionDefTable("bundy"));
+
+    OptionDefinitionPtr def1(new OptionDefinition("option-1", 1, "uint16"));
+    OptionDefinitionPtr def300(new OptionDefinition("option-300", 300,
+                                                    "uint16"));
+    ASSERT_NO_THROW(cfg_mgr.addOptionDef(def300, "bundy"));
+    ASSERT_NO_THROW(cfg_mgr.addOptionDef(def1, "bundy"));
+
+    const OptionDefTable* table = cfg_mgr.getOptionDefTable("bundy");
+    ASSERT_TRUE(table);
+    ASSERT_EQ(301, table->size());
+    EXPECT_EQ(def1, (*table)[1]);
+    EXPECT_EQ(def300, (*table)[300]);
+    EXPECT_FALSE((*table)[2]);
+    EXPECT_FALSE(cfg_mgr.getOptionDefTable("abcde"));
+
+    // The tables are removed with the definitions.
+    cfg_mgr.deleteOptionDefs();
+    EXPECT_FALSE(cfg_mgr.getOptionDefTable("bundy"));
+    EXPECT_FALSE(cfg_mgr.getOptionDef("bundy", 1));
+}
+
 // This test verifies that it is not allowed to override a definition of the
 // standard option which has its definition defined in libdhcp++, but it is
 // allowed to create a definition for the standard option which doesn't have
@@ -418,6 +445,48 @@ TEST_F(CfgMgrTest, subnet4) {
     EXPECT_FALSE(cfg_mgr.getSubnet4(IOAddress("192.0.2.85"), classify_));
 }
 
+// This test verifies that when subnets overlap, the one configured first
+// is selected, also after the subnets have been replaced.
+TEST_F(CfgMgrTest, subnet4Overlapping) {
+    CfgMgr& cfg_mgr = CfgMgr::instance();
+
+    Subnet4Ptr subnet1(new Subnet4(IOAddress("192.0.2.64"), 26, 1, 2, 3));
+    Subnet4Ptr subnet2(new Subnet4(IOAddress("192.0.2.0"), 24, 1, 2, 3));
+    Subnet4Ptr subnet3(new Subnet4(IOAddress("192.0.2.0"), 25, 1, 2, 3));
+
+    cfg_mgr.addSubnet4(subnet1);
+    cfg_mgr.addSubnet4(subnet2);
+    cfg_mgr.addSubnet4(subnet3);
+
+    EXPECT_EQ(subnet1, cfg_mgr.getSubnet4(IOAddress("192.0.2.65"), classify_));
+    EXPECT_EQ(subnet2, cfg_mgr.getSubnet4(IOAddress("192.0.2.1"), classify_));
+    EXPECT_EQ(subnet2, cfg_mgr.getSubnet4(IOAddress("192.0.2.129"),
+                                          classify_));
+
+    // A subnet rejecting the client is skipped for the next one.
+    subnet2->allowClientClass("foo");
+    EXPECT_EQ(subnet3, cfg_mgr.getSubnet4(IOAddress("192.0.2.1"), classify_));
+
+    // The relay address takes precedence only in subnets configured after
+    // the one containing the address.
+    subnet3->setRelayInfo(IOAddress("192.0.2.65"));
+    EXPECT_EQ(subnet1, cfg_mgr.getSubnet4(IOAddress("192.0.2.65"), classify_,
+                                          true));
+    Subnet4Collection subnets;
+    subnets.push_back(subnet3);
+    subnets.push_back(subnet1);
+    cfg_mgr.replaceSubnets4(subnets);
+    EXPECT_EQ(subnet3, cfg_mgr.getSubnet4(IOAddress("192.0.2.65"), classify_,
+                                          true));
+    EXPECT_FALSE(cfg_mgr.getSubnet4(IOAddress("192.0.2.129"), classify_));
+
+    // Changing the relay address of a subnet already added takes effect
+    // immediately.
+    subnet1->setRelayInfo(IOAddress("10.0.0.1"));
+    EXPECT_EQ(subnet1, cfg_mgr.getSubnet4(IOAddress("10.0.0.1"), classify_,
+                                          true));
+}
+
 // This test verifies if the configuration manager is able to hold subnets with
 // their classifier information and return proper subnets, based on those
 // classes.
@@ -971,6 +1040,54 @@ TEST_F(CfgMgrTest, echoClientId) {
     EXPECT_TRUE(cfg_mgr.echoClientId());
 }
 
+// This test verifies that the expired leases reclamation may be configured.
+TEST_F(CfgMgrTest, leaseReclamation) {
+    CfgMgr& cfg_mgr = CfgMgr::instance();
+
+    // The reclamation is disabled by default.
+    EXPECT_EQ(0, cfg_mgr.getReclaimTimer());
+    EXPECT_EQ(100, cfg_mgr.getReclaimMaxLeases());
+    EXPECT_EQ(250, cfg_mgr.getReclaimMaxTime());
+
+    cfg_mgr.setLeaseReclamation(10, 1000, 0);
+    EXPECT_EQ(10, cfg_mgr.getReclaimTimer());
+    EXPECT_EQ(1000, cfg_mgr.getReclaimMaxLeases());
+    EXPECT_EQ(0, cfg_mgr.getReclaimMaxTime());
+
+    // Restore the default.
+    cfg_mgr.setLeaseReclamation(0, 100, 250);
+    EXPECT_EQ(0, cfg_mgr.getReclaimTimer());
+}
+
+// This test verifies that the limits on the parked queries may be configured.
+TEST_F(CfgMgrTest, queryParking) {
+    CfgMgr& cfg_mgr = CfgMgr::instance();
+
+    EXPECT_EQ(256, cfg_mgr.getParkedQueryLimit());
+    EXPECT_EQ(5000, cfg_mgr.getParkedQueryTimeout());
+
+    cfg_mgr.setQueryParking(0, 100);
+    EXPECT_EQ(0, cfg_mgr.getParkedQueryLimit());
+    EXPECT_EQ(100, cfg_mgr.getParkedQueryTimeout());
+
+    // Restore the default.
+    cfg_mgr.setQueryParking(256, 5000);
+    EXPECT_EQ(256, cfg_mgr.getParkedQueryLimit());
+}
+
+// This test verifies that the DHCPv4 offers may be held.
+TEST_F(CfgMgrTest, offerLifetime) {
+    CfgMgr& cfg_mgr = CfgMgr::instance();
+
+    EXPECT_EQ(0, cfg_mgr.getOfferLifetime());
+    cfg_mgr.setOfferLifetime(10);
+    EXPECT_EQ(10, cfg_mgr.getOfferLifetime());
+
+    // Restore the default.
+    cfg_mgr.setOfferLifetime(0);
+    EXPECT_EQ(0, cfg_mgr.getOfferLifetime());
+}
+
 // This test checks the D2ClientMgr wrapper methods.
 TEST_F(CfgMgrTest, d2ClientConfig) {
     // After CfgMgr construction, D2ClientMgr member should be initialized
@@ -1088,6 +1205,144 @@ TEST_F(CfgMgrTest, subnet6Duplication) {
     EXPECT_THROW(cfg_mgr.addSubnet6(subnet3), bundy::dhcp::DuplicateSubnetID);
 }
 
+// Checks that the IPv4 subnets can be replaced in one step, keeping the
+// subnet objects which are passed again and rejecting duplicated IDs.
+TEST_F(CfgMgrTest, replaceSubnets4) {
+    CfgMgr& cfg_mgr = CfgMgr::instance();
+
+    Subnet4Ptr subnet1(new Subnet4(IOAddress("192.0.2.0"), 26, 1, 2, 3, 123));
+    Subnet4Ptr subnet2(new Subnet4(IOAddress("192.0.2.64"), 26, 1, 2, 3, 124));
+    Subnet4Ptr subnet3(new Subnet4(IOAddress("192.0.2.128"), 26, 1, 2, 3, 125));
+    Subnet4Ptr subnet4(new Subnet4(IOAddress("192.0.2.192"), 26, 1, 2, 3, 123));
+    cfg_mgr.addSubnet4(subnet1);
+    cfg_mgr.addSubnet4(subnet2);
+
+    Subnet4Collection subnets;
+    subnets.push_back(subnet2);
+    subnets.push_back(subnet3);
+    ASSERT_NO_THROW(cfg_mgr.replaceSubnets4(subnets));
+    ASSERT_EQ(2, cfg_mgr.getSubnets4()->size());
+    EXPECT_EQ(subnet2, (*cfg_mgr.getSubnets4())[0]);
+    EXPECT_EQ(subnet3, (*cfg_mgr.getSubnets4())[1]);
+    EXPECT_FALSE(cfg_mgr.getSubnet4(IOAddress("192.0.2.15"), classify_));
+
+    // Subnet 4 has the same ID as subnet 1, which is no longer there, so
+    // they can't be used together but subnet 4 can replace it.
+    subnets.push_back(subnet1);
+    subnets.push_back(subnet4);
+    EXPECT_THROW(cfg_mgr.replaceSubnets4(subnets),
+                 bundy::dhcp::DuplicateSubnetID);
+    EXPECT_EQ(2, cfg_mgr.getSubnets4()->size());
+    subnets.erase(subnets.begin() + 2);
+    ASSERT_NO_THROW(cfg_mgr.replaceSubnets4(subnets));
+    EXPECT_EQ(3, cfg_mgr.getSubnets4()->size());
+    EXPECT_EQ(subnet4, cfg_mgr.getSubnet4(IOAddress("192.0.2.200"), classify_));
+}
+
+// Checks that the IPv6 subnets can be replaced in one step, keeping the
+// subnet objects which are passed again and rejecting duplicated IDs.
+TEST_F(CfgMgrTest, replaceSubnets6) {
+    CfgMgr& cfg_mgr = CfgMgr::instance();
+
+    Subnet6Ptr subnet1(new Subnet6(IOAddress("2001:db8:1::"), 64, 1, 2, 3,
+                                   4, 123));
+    Subnet6Ptr subnet2(new Subnet6(IOAddress("2001:db8:2::"), 64, 1, 2, 3,
+                                   4, 124));
+    Subnet6Ptr subnet3(new Subnet6(IOAddress("2001:db8:3::"), 64, 1, 2, 3,
+                                   4, 124));
+    cfg_mgr.addSubnet6(subnet1);
+
+    Subnet6Collection subnets;
+    subnets.push_back(subnet1);
+    subnets.push_back(subnet2);
+    ASSERT_NO_THROW(cfg_mgr.replaceSubnets6(subnets));
+    ASSERT_EQ(2, cfg_mgr.getSubnets6()->size());
+    EXPECT_EQ(subnet1, (*cfg_mgr.getSubnets6())[0]);
+    EXPECT_EQ(subnet2, (*cfg_mgr.getSubnets6())[1]);
+
+    subnets.push_back(subnet3);
+    EXPECT_THROW(cfg_mgr.replaceSubnets6(subnets),
+                 bundy::dhcp::DuplicateSubnetID);
+    EXPECT_EQ(2, cfg_mgr.getSubnets6()->size());
+
+    ASSERT_NO_THROW(cfg_mgr.replaceSubnets6(Subnet6Collection()));
+    EXPECT_TRUE(cfg_mgr.getSubnets6()->empty());
+}
+
+// Checks that a snapshot holds the configuration as it was when it was
+// published, and that the readers get a new snapshot when the configuration
+// changes.
+TEST_F(CfgMgrTest, snapshot) {
+    CfgMgr& cfg_mgr = CfgMgr::instance();
+
+    Subnet4Ptr subnet1(new Subnet4(IOAddress("192.0.2.0"), 26, 1, 2, 3, 123));
+    Subnet4Ptr subnet2(new Subnet4(IOAddress("192.0.2.64"), 26, 1, 2, 3, 124));
+    Subnet6Ptr subnet3(new Subnet6(IOAddress("2001:db8:1::"), 64, 1, 2, 3,
+                                   4, 125));
+    cfg_mgr.addSubnet4(subnet1);
+    cfg_mgr.addSubnet6(subnet3);
+    cfg_mgr.publishSnapshot();
+
+    ConstCfgSnapshotPtr snapshot = cfg_mgr.getSnapshot();
+    ASSERT_TRUE(snapshot);
+    EXPECT_EQ(cfg_mgr.getGeneration(), snapshot->getGeneration());
+    EXPECT_EQ(1, snapshot->getSubnets4()->size());
+    EXPECT_EQ(subnet1, snapshot->getSubnet4(IOAddress("192.0.2.10"),
+                                            classify_));
+    EXPECT_EQ(subnet3, snapshot->getSubnet6(IOAddress("2001:db8:1::1"),
+                                            classify_));
+    // The snapshot isn't copied by the readers.
+    {
+        CfgMgr::SnapshotReader reader;
+        EXPECT_EQ(snapshot.get(), &*reader);
+    }
+
+    // A reader gets the new subnet as soon as it is added, while the
+    // snapshot taken before stays as it was.
+    cfg_mgr.addSubnet4(subnet2);
+    {
+        CfgMgr::SnapshotReader reader;
+        EXPECT_NE(snapshot.get(), &*reader);
+        EXPECT_EQ(2, reader->getSubnets4()->size());
+        EXPECT_EQ(subnet2, reader->getSubnet4(IOAddress("192.0.2.100"),
+                                              classify_));
+    }
+    EXPECT_EQ(1, snapshot->getSubnets4()->size());
+    EXPECT_FALSE(snapshot->getSubnet4(IOAddress("192.0.2.100"), classify_));
+
+    cfg_mgr.deleteSubnets4();
+    CfgMgr::SnapshotReader reader;
+    EXPECT_TRUE(reader->getSubnets4()->empty());
+    EXPECT_EQ(1, reader->getSubnets6()->size());
+}
+
+// Checks that the snapshot is only replaced explicitly when the automatic
+// publication is disabled.
+TEST_F(CfgMgrTest, snapshotNoAutoPublish) {
+    CfgMgr& cfg_mgr = CfgMgr::instance();
+
+    Subnet4Ptr subnet(new Subnet4(IOAddress("192.0.2.0"), 26, 1, 2, 3, 123));
+    cfg_mgr.publishSnapshot();
+    cfg_mgr.setAutoPublish(false);
+    const uint64_t generation = cfg_mgr.getGeneration();
+
+    cfg_mgr.addSubnet4(subnet);
+    EXPECT_LT(generation, cfg_mgr.getGeneration());
+    {
+        CfgMgr::SnapshotReader reader;
+        EXPECT_EQ(generation, reader->getGeneration());
+        EXPECT_FALSE(reader->getSubnet4(IOAddress("192.0.2.10"), classify_));
+    }
+
+    cfg_mgr.publishSnapshot();
+    {
+        CfgMgr::SnapshotReader reader;
+        EXPECT_EQ(cfg_mgr.getGeneration(), reader->getGeneration());
+        EXPECT_EQ(subnet, reader->getSubnet4(IOAddress("192.0.2.10"),
+                                             classify_));
+    }
+}
+
 
 /// @todo Add unit-tests for testing:
 /// - addActiveIface() with invalid interface name
@@ -0,0 +1,213 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <dhcp/dhcp4.h>
+#include <dhcp/dhcp6.h>
+#include <dhcp/option_string.h>
+#include <dhcp/pkt4.h>
+#include <dhcp/pkt6.h>
+#include <dhcpsrv/client_class_expr.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using namespace std;
+using namespace bundy;
+using namespace bundy::dhcp;
+
+namespace {
+
+class ClientClassExprTest : public ::testing::Test {
+public:
+    ClientClassExprTest() {
+        // The packet sent by a DOCSIS 3.0 cable modem, which also has an
+        // empty site specific option.
+        Pkt4 pkt(DHCPDISCOVER, 1234);
+        pkt.addOption(OptionPtr(new OptionString(Option::V4,
+                                                 DHO_VENDOR_CLASS_IDENTIFIER,
+                                                 "docsis3.0:modem")));
+        pkt.addOption(OptionPtr(new Option(Option::V4, 224)));
+        pkt.pack();
+        const util::OutputBuffer& buffer = pkt.getBuffer();
+        wire4_.assign(static_cast<const uint8_t*>(buffer.getData()),
+                      static_cast<const uint8_t*>(buffer.getData()) +
+                      buffer.getLength());
+    }
+
+    /// @brief Returns the DHCPv4 packet received from the wire.
+    ///
+    /// @param lazy whether the options should be unpacked lazily.
+    Pkt4Ptr getPkt4(const bool lazy) const {
+        Pkt4Ptr pkt(new Pkt4(&wire4_[0], wire4_.size()));
+        pkt->setLazyUnpack(lazy);
+        pkt->unpack();
+        return (pkt);
+    }
+
+    /// @brief Evaluates the expression for both lazily and eagerly unpacked
+    /// packets, and checks the results are the same.
+    bool evaluate4(const string& text) const {
+        const ClientClassExpr expr(text, Option::V4);
+        const bool result = expr.evaluate(*getPkt4(true));
+        EXPECT_EQ(result, expr.evaluate(*getPkt4(false))) << text;
+        return (result);
+    }
+
+    std::vector<uint8_t> wire4_;
+};
+
+// Checks the conditions on option data.
+TEST_F(ClientClassExprTest, conditions) {
+    EXPECT_TRUE(evaluate4("option[60].exists"));
+    EXPECT_TRUE(evaluate4("option[224].exists"));
+    EXPECT_FALSE(evaluate4("option[61].exists"));
+
+    EXPECT_TRUE(evaluate4("option[60].text == 'docsis3.0:modem'"));
+    EXPECT_TRUE(evaluate4("'docsis3.0:modem' == option[60].text"));
+    EXPECT_FALSE(evaluate4("option[60].text == 'docsis3.0'"));
+    EXPECT_TRUE(evaluate4("option[60].text != 'docsis3.0'"));
+    EXPECT_TRUE(evaluate4("option[60].hex == "
+                          "0x646f63736973332e303a6d6f64656d"));
+
+    EXPECT_TRUE(evaluate4("substring(option[60].text, 0, 9) == 'docsis3.0'"));
+    EXPECT_TRUE(evaluate4("substring(option[60].text, 10, all) == 'modem'"));
+    EXPECT_TRUE(evaluate4("substring(option[60].text, 10, 100) == 'modem'"));
+    EXPECT_TRUE(evaluate4("substring(option[60].text, 100, 1) == ''"));
+    EXPECT_FALSE(evaluate4("substring(option[60].text, 0, 9) == 'docsis2.0'"));
+
+    // Empty and missing options have empty data.
+    EXPECT_TRUE(evaluate4("option[224].text == ''"));
+    EXPECT_TRUE(evaluate4("option[61].text == ''"));
+    EXPECT_FALSE(evaluate4("option[61].text == 'foo'"));
+}
+
+// Checks the logical operators and their precedence.
+TEST_F(ClientClassExprTest, operators) {
+    EXPECT_FALSE(evaluate4("not option[60].exists"));
+    EXPECT_TRUE(evaluate4("not not option[60].exists"));
+    EXPECT_TRUE(evaluate4("option[60].exists and option[224].exists"));
+    EXPECT_FALSE(evaluate4("option[60].exists and option[61].exists"));
+    EXPECT_FALSE(evaluate4("option[61].exists and option[60].exists"));
+    EXPECT_TRUE(evaluate4("option[61].exists or option[60].exists"));
+    EXPECT_TRUE(evaluate4("option[60].exists or option[61].exists"));
+    EXPECT_FALSE(evaluate4("option[61].exists or option[62].exists"));
+    EXPECT_TRUE(evaluate4("option[61].exists or option[62].exists or "
+                          "option[224].exists"));
+    EXPECT_FALSE(evaluate4("option[60].exists and option[224].exists and "
+                           "option[61].exists"));
+
+    // "and" binds tighter than "or".
+    EXPECT_TRUE(evaluate4("option[60].exists or option[61].exists and "
+                          "option[62].exists"));
+    EXPECT_FALSE(evaluate4("(option[60].exists or option[61].exists) and "
+                           "option[62].exists"));
+    EXPECT_TRUE(evaluate4("not (option[61].exists or option[62].exists)"));
+    EXPECT_FALSE(evaluate4("not option[60].exists or option[61].exists"));
+}
+
+// Checks the options of a lazily unpacked packet are not parsed.
+TEST_F(ClientClassExprTest, lazyUnpack) {
+    const Pkt4Ptr pkt = getPkt4(true);
+    const uint8_t* data;
+    size_t len;
+    ASSERT_TRUE(pkt->getPendingOptionData(DHO_VENDOR_CLASS_IDENTIFIER,
+                                          &data, &len));
+
+    const ClientClassExpr expr("substring(option[60].text, 0, 9) == "
+                               "'docsis3.0'", Option::V4);
+    EXPECT_TRUE(expr.evaluate(*pkt));
+    EXPECT_TRUE(pkt->getPendingOptionData(DHO_VENDOR_CLASS_IDENTIFIER,
+                                          &data, &len));
+
+    // Once the option is parsed, the parsed option is used.
+    ASSERT_TRUE(pkt->getOption(DHO_VENDOR_CLASS_IDENTIFIER));
+    EXPECT_FALSE(pkt->getPendingOptionData(DHO_VENDOR_CLASS_IDENTIFIER,
+                                           &data, &len));
+    EXPECT_TRUE(expr.evaluate(*pkt));
+}
+
+// Checks an expression is evaluated for DHCPv6 packets.
+TEST_F(ClientClassExprTest, pkt6) {
+    Pkt6 pkt(DHCPV6_SOLICIT, 1234);
+    pkt.addOption(OptionPtr(new OptionString(Option::V6, 1000,
+                                             "tftp://192.0.2.1/boot")));
+
+    EXPECT_TRUE(ClientClassExpr("option[1000].exists",
+                                Option::V6).evaluate(pkt));
+    EXPECT_TRUE(ClientClassExpr("substring(option[1000].text, 0, 7) == "
+                                "'tftp://'", Option::V6).evaluate(pkt));
+    EXPECT_FALSE(ClientClassExpr("option[60].exists",
+                                 Option::V6).evaluate(pkt));
+    EXPECT_FALSE(ClientClassExpr("option[300].exists",
+                                 Option::V6).evaluate(pkt));
+}
+
+// Checks the short circuit evaluation shows in the compiled code: there is
+// one instruction per condition, operator, and jump.
+TEST_F(ClientClassExprTest, compile) {
+    EXPECT_EQ(1, ClientClassExpr("option[60].exists",
+                                 Option::V4).getInstructionCount());
+    EXPECT_EQ(2, ClientClassExpr("option[60].text != 'foo'",
+                                 Option::V4).getInstructionCount());
+    EXPECT_EQ(3, ClientClassExpr("option[60].exists and option[61].exists",
+                                 Option::V4).getInstructionCount());
+    EXPECT_EQ(2, ClientClassExpr("(not option[60].exists)",
+                                 Option::V4).getInstructionCount());
+}
+
+// Checks invalid expressions are rejected.
+TEST_F(ClientClassExprTest, invalid) {
+    const char* const invalid[] = {
+        "",
+        "   ",
+        "option",
+        "option[60]",
+        "option[60].exists and",
+        "option[60].exists or or option[61].exists",
+        "option[60].text",
+        "option[60].text == ",
+        "option[60].text = 'foo'",
+        "option[60].foo",
+        "option[60].text == 'foo",
+        "option[60].text == option[61].text",
+        "'foo' == 'foo'",
+        "option[0].exists",
+        "option[255].exists",
+        "option[99999999].exists",
+        "option[-1].exists",
+        "option[60].exists)",
+        "(option[60].exists",
+        "substring(option[60].text, 0) == 'foo'",
+        "substring('foo', 0, 1) == 'f'",
+        "option[60].hex == 0x",
+        "option[60].exists option[61].exists",
+        "option[60].exists && option[61].exists",
+        NULL
+    };
+    for (const char* const* text = invalid; *text != NULL; ++text) {
+        EXPECT_THROW(ClientClassExpr(*text, Option::V4),
+                     ClientClassExprError) << *text;
+    }
+
+    // The option codes are wider for DHCPv6.
+    EXPECT_NO_THROW(ClientClassExpr("option[255].exists", Option::V6));
+    EXPECT_NO_THROW(ClientClassExpr("option[65535].exists", Option::V6));
+    EXPECT_THROW(ClientClassExpr("option[65536].exists", Option::V6),
+                 ClientClassExprError);
+}
+
+}
@@ -107,6 +107,21 @@ TEST(D2ClientConfigTest, constructorsAndAccessors) {
                                                        qualifying_suffix)),
                  D2ClientError);
 
+    // Verify that constructor allows use of FMT_BINARY.
+    ASSERT_NO_THROW(d2_client_config.reset(new
+                                           D2ClientConfig(enable_updates,
+                                                          server_ip,
+                                                          server_port,
+                                                          ncr_protocol,
+                                                          dhcp_ddns::FMT_BINARY,
+                                                          always_include_fqdn,
+                                                          override_no_update,
+                                                         override_client_update,
+                                                          replace_client_name,
+                                                          generated_prefix,
+                                                          qualifying_suffix)));
+    EXPECT_EQ(dhcp_ddns::FMT_BINARY, d2_client_config->getNcrFormat());
+
     /// @todo if additional validation is added to ctor, this test needs to
     /// expand accordingly.
 }
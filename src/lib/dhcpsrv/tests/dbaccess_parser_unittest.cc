@@ -87,10 +87,17 @@ public:
             }
 
             // Add the keyword and value - make sure that they are quoted.
-            // The only parameter which is not quoted is persist as it
-            // is a boolean value.
+            // The only parameters which are not quoted are persist as it
+            // is a boolean value and group-commit, cache-size, lfc-threshold,
+            // shards and the ports as they are integers.
             result += quote + keyval[i] + quote + colon + space;
-            if (std::string(keyval[i]) != "persist") {
+            if ((std::string(keyval[i]) != "persist") &&
+                (std::string(keyval[i]) != "group-commit") &&
+                (std::string(keyval[i]) != "cache-size") &&
+                (std::string(keyval[i]) != "lfc-threshold") &&
+                (std::string(keyval[i]) != "shards") &&
+                (std::string(keyval[i]) != "standby-port") &&
+                (std::string(keyval[i]) != "listen-port")) {
                 result += quote + keyval[i + 1] + quote;
             } else {
                 result += keyval[i + 1];
@@ -299,6 +306,137 @@ TEST_F(DbAccessParserTest, validTypeMysql) {
     checkAccessString("Valid mysql", parser.getDbAccessParameters(), config);
 }
 
+// Check that the parser accepts the group commit size, and rejects a
+// negative one.
+TEST_F(DbAccessParserTest, groupCommit) {
+    const char* config[] = {"type",         "mysql",
+                            "name",         "keatest",
+                            "group-commit", "32",
+                            NULL};
+
+    string json_config = toJson(config);
+    ConstElementPtr json_elements = Element::fromJSON(json_config);
+    EXPECT_TRUE(json_elements);
+
+    TestDbAccessParser parser("lease-database", ParserContext(Option::V4));
+    EXPECT_NO_THROW(parser.build(json_elements));
+    checkAccessString("Valid group commit", parser.getDbAccessParameters(),
+                      config);
+
+    const char* invalid[] = {"type",         "mysql",
+                             "name",         "keatest",
+                             "group-commit", "-1",
+                             NULL};
+    json_elements = Element::fromJSON(toJson(invalid));
+    EXPECT_TRUE(json_elements);
+
+    TestDbAccessParser invalid_parser("lease-database",
+                                      ParserContext(Option::V4));
+    EXPECT_THROW(invalid_parser.build(json_elements), BadValue);
+}
+
+// Check that the parser accepts the lease cache size, and rejects a
+// negative one.
+TEST_F(DbAccessParserTest, cacheSize) {
+    const char* config[] = {"type",       "pgsql",
+                            "name",       "keatest",
+                            "cache-size", "100000",
+                            NULL};
+
+    string json_config = toJson(config);
+    ConstElementPtr json_elements = Element::fromJSON(json_config);
+    EXPECT_TRUE(json_elements);
+
+    TestDbAccessParser parser("lease-database", ParserContext(Option::V4));
+    EXPECT_NO_THROW(parser.build(json_elements));
+    checkAccessString("Valid cache size", parser.getDbAccessParameters(),
+                      config);
+
+    const char* invalid[] = {"type",       "pgsql",
+                             "name",       "keatest",
+                             "cache-size", "-1",
+                             NULL};
+    json_elements = Element::fromJSON(toJson(invalid));
+    EXPECT_TRUE(json_elements);
+
+    TestDbAccessParser invalid_parser("lease-database",
+                                      ParserContext(Option::V4));
+    EXPECT_THROW(invalid_parser.build(json_elements), BadValue);
+}
+
+// Check that the lfc-threshold parameter is accepted and that a negative
+// value is rejected.
+TEST_F(DbAccessParserTest, lfcThreshold) {
+    const char* config[] = {"type",          "memfile",
+                            "lfc-threshold", "1000",
+                            NULL};
+
+    string json_config = toJson(config);
+    ConstElementPtr json_elements = Element::fromJSON(json_config);
+    EXPECT_TRUE(json_elements);
+
+    TestDbAccessParser parser("lease-database", ParserContext(Option::V4));
+    EXPECT_NO_THROW(parser.build(json_elements));
+    checkAccessString("Valid LFC threshold", parser.getDbAccessParameters(),
+                      config);
+
+    const char* invalid[] = {"type",          "memfile",
+                             "lfc-threshold", "-1",
+                             NULL};
+    json_elements = Element::fromJSON(toJson(invalid));
+    EXPECT_TRUE(json_elements);
+
+    TestDbAccessParser invalid_parser("lease-database",
+                                      ParserContext(Option::V4));
+    EXPECT_THROW(invalid_parser.build(json_elements), BadValue);
+}
+
+// Check that the shards parameter is accepted and that a negative value is
+// rejected.
+TEST_F(DbAccessParserTest, shards) {
+    const char* config[] = {"type",   "memfile",
+                            "shards", "4",
+                            NULL};
+
+    string json_config = toJson(config);
+    ConstElementPtr json_elements = Element::fromJSON(json_config);
+    EXPECT_TRUE(json_elements);
+
+    TestDbAccessParser parser("lease-database", ParserContext(Option::V4));
+    EXPECT_NO_THROW(parser.build(json_elements));
+    checkAccessString("Valid number of shards", parser.getDbAccessParameters(),
+                      config);
+
+    const char* invalid[] = {"type",   "memfile",
+                             "shards", "-1",
+                             NULL};
+    json_elements = Element::fromJSON(toJson(invalid));
+    EXPECT_TRUE(json_elements);
+
+    TestDbAccessParser invalid_parser("lease-database",
+                                      ParserContext(Option::V4));
+    EXPECT_THROW(invalid_parser.build(json_elements), BadValue);
+}
+
+// Check that the lease stream parameters are accepted.
+TEST_F(DbAccessParserTest, leaseStream) {
+    const char* config[] = {"type",            "memfile",
+                            "standby-address", "192.0.2.2",
+                            "standby-port",    "6747",
+                            "listen-address",  "192.0.2.1",
+                            "listen-port",     "6747",
+                            NULL};
+
+    string json_config = toJson(config);
+    ConstElementPtr json_elements = Element::fromJSON(json_config);
+    EXPECT_TRUE(json_elements);
+
+    TestDbAccessParser parser("lease-database", ParserContext(Option::V4));
+    EXPECT_NO_THROW(parser.build(json_elements));
+    checkAccessString("Valid lease stream", parser.getDbAccessParameters(),
+                      config);
+}
+
 // A missing 'type' keyword should cause an exception to be thrown.
 TEST_F(DbAccessParserTest, missingTypeKeyword) {
     const char* config[] = {"host",     "erewhon",
@@ -391,6 +391,8 @@ public:
                 boost::dynamic_pointer_cast<HooksLibrariesParser>(parser);
         } else if (config_id.compare("dhcp-ddns") == 0) {
             parser.reset(new D2ClientConfigParser(config_id));
+        } else if (config_id.compare("client-classes") == 0) {
+            parser.reset(new ClientClassDefListParser(config_id, Option::V4));
         } else {
             bundy_throw(NotImplemented,
                 "Parser error: configuration parameter not supported: "
@@ -496,6 +498,8 @@ public:
         // Set it to minimal, disabled config
         D2ClientConfigPtr tmp(new D2ClientConfig());
         CfgMgr::instance().setD2ClientConfig(tmp);
+
+        CfgMgr::instance().setClientClassDefs(ClientClassDefList());
     }
 
     /// @brief Parsers used in the parsing of the configuration
@@ -596,6 +600,70 @@ TEST_F(ParseConfigTest, basicOptionDataTest) {
 /// These tests check basic operation of the HooksLibrariesParser.
 
 // hooks-libraries that do not contain anything.
+/// @brief Check that client classes are parsed and their tests compiled.
+TEST_F(ParseConfigTest, clientClassesTest) {
+    std::string config =
+        "{ \"client-classes\": ["
+        "    { \"name\": \"docsis3\","
+        "      \"test\": \"substring(option[60].text, 0, 9) == 'docsis3.0'\""
+        "    },"
+        "    { \"name\": \"with-hostname\","
+        "      \"test\": \"option[12].exists\""
+        "    } ]"
+        "}";
+    int rcode = parseConfiguration(config);
+    ASSERT_EQ(0, rcode) << error_text_;
+
+    const ClientClassDefList& defs = CfgMgr::instance().getClientClassDefs();
+    ASSERT_EQ(2, defs.size());
+    EXPECT_EQ("docsis3", defs[0].name_);
+    EXPECT_EQ("substring(option[60].text, 0, 9) == 'docsis3.0'",
+              defs[0].test_->getText());
+    EXPECT_EQ("with-hostname", defs[1].name_);
+
+    // An empty list removes the classes.
+    rcode = parseConfiguration("{ \"client-classes\": [] }");
+    ASSERT_EQ(0, rcode) << error_text_;
+    EXPECT_TRUE(CfgMgr::instance().getClientClassDefs().empty());
+}
+
+/// @brief Check that invalid client classes are rejected.
+TEST_F(ParseConfigTest, invalidClientClassesTest) {
+    // Invalid test expression.
+    std::string config =
+        "{ \"client-classes\": ["
+        "    { \"name\": \"foo\", \"test\": \"option[60].text ==\" } ]"
+        "}";
+    EXPECT_NE(0, parseConfiguration(config));
+
+    // Option code out of range for DHCPv4.
+    config = "{ \"client-classes\": ["
+        "    { \"name\": \"foo\", \"test\": \"option[256].exists\" } ]"
+        "}";
+    EXPECT_NE(0, parseConfiguration(config));
+
+    // Missing name.
+    config = "{ \"client-classes\": ["
+        "    { \"test\": \"option[60].exists\" } ]"
+        "}";
+    EXPECT_NE(0, parseConfiguration(config));
+
+    // Missing test.
+    config = "{ \"client-classes\": ["
+        "    { \"name\": \"foo\" } ]"
+        "}";
+    EXPECT_NE(0, parseConfiguration(config));
+
+    // Duplicate name.
+    config = "{ \"client-classes\": ["
+        "    { \"name\": \"foo\", \"test\": \"option[60].exists\" },"
+        "    { \"name\": \"foo\", \"test\": \"option[61].exists\" } ]"
+        "}";
+    EXPECT_NE(0, parseConfiguration(config));
+
+    EXPECT_TRUE(CfgMgr::instance().getClientClassDefs().empty());
+}
+
 TEST_F(ParseConfigTest, noHooksLibrariesTest) {
 
     // Configuration with hooks-libraries not present.
@@ -1374,3 +1442,150 @@ TEST_F(ParseConfigTest, validRelayInfo6) {
     // Unparseable text that looks like IPv6 address, but has too many colons
     EXPECT_THROW(parser->build(json_bogus2), DhcpConfigError);
 }
+
+/// @brief Checks that the IPv4 host reservations of a subnet are parsed.
+TEST_F(ParseConfigTest, hostReservations4) {
+    SubnetPtr subnet(new Subnet4(asiolink::IOAddress("192.0.2.0"), 24,
+                                 1, 2, 3, 10));
+    CfgHostsPtr hosts(new CfgHosts());
+    HostReservationsListParser parser("reservations", subnet, hosts,
+                                      Option::V4);
+
+    // The empty strings are the defaults of the specification.
+    ElementPtr json = Element::fromJSON(
+        "[ { \"hw-address\": \"01:02:03:04:05:06\","
+        "    \"client-id\": \"\","
+        "    \"ip-address\": \"192.0.2.10\","
+        "    \"hostname\": \"foo\" },"
+        "  { \"client-id\": \"01:02:03:04\","
+        "    \"ip-address\": \"192.0.2.11\" } ]");
+    ASSERT_NO_THROW(parser.build(json));
+    ASSERT_NO_THROW(parser.commit());
+    ASSERT_EQ(2, hosts->size());
+
+    const uint8_t mac[] = { 1, 2, 3, 4, 5, 6 };
+    HWAddrPtr hwaddr(new HWAddr(mac, sizeof(mac), HTYPE_ETHER));
+    ConstHostPtr host = hosts->get4(10, hwaddr);
+    ASSERT_TRUE(host);
+    EXPECT_EQ("192.0.2.10", host->getIPv4Reservation().toText());
+    EXPECT_EQ("foo", host->getHostname());
+    host = hosts->get(10, asiolink::IOAddress("192.0.2.11"));
+    ASSERT_TRUE(host);
+    EXPECT_EQ(Host::IDENT_CLIENT_ID, host->getIdentifierType());
+
+    // No identifier, two identifiers, an address out of the subnet, an IPv6
+    // address, a DUID, an address reserved twice and an unknown parameter.
+    const char* bogus[] = {
+        "[ { \"ip-address\": \"192.0.2.12\" } ]",
+        "[ { \"hw-address\": \"01:02:03:04:05:07\","
+        "    \"client-id\": \"01:02:03:05\" } ]",
+        "[ { \"hw-address\": \"01:02:03:04:05:07\","
+        "    \"ip-address\": \"192.0.3.1\" } ]",
+        "[ { \"hw-address\": \"01:02:03:04:05:07\","
+        "    \"ip-address\": \"2001:db8::1\" } ]",
+        "[ { \"duid\": \"01:02:03:04:05:07\" } ]",
+        "[ { \"hw-address\": \"01:02:03:04:05:07\","
+        "    \"ip-address\": \"192.0.2.10\" } ]",
+        "[ { \"hw-address\": \"01:02:03:04:05:07\", \"foo\": \"\" } ]",
+        NULL
+    };
+    for (int i = 0; bogus[i] != NULL; ++i) {
+        EXPECT_THROW(parser.build(Element::fromJSON(bogus[i])),
+                     DhcpConfigError) << bogus[i];
+    }
+    EXPECT_EQ(2, hosts->size());
+}
+
+/// @brief Checks that the IPv6 host reservations of a subnet are parsed.
+TEST_F(ParseConfigTest, hostReservations6) {
+    SubnetPtr subnet(new Subnet6(asiolink::IOAddress("2001:db8:1::"), 64,
+                                 1, 2, 3, 4, 10));
+    CfgHostsPtr hosts(new CfgHosts());
+    HostReservationsListParser parser("reservations", subnet, hosts,
+                                      Option::V6);
+
+    ElementPtr json = Element::fromJSON(
+        "[ { \"duid\": \"01:02:03:04:05:06\","
+        "    \"ip-addresses\": [ \"2001:db8:1::10\", "
+        "                        \"2001:db8:1::11\" ] } ]");
+    ASSERT_NO_THROW(parser.build(json));
+    ASSERT_EQ(1, hosts->size());
+
+    const uint8_t duid[] = { 1, 2, 3, 4, 5, 6 };
+    ConstHostPtr host =
+        hosts->get6(10, DuidPtr(new DUID(duid, sizeof(duid))));
+    ASSERT_TRUE(host);
+    ASSERT_EQ(2, host->getIPv6Reservations().size());
+    EXPECT_EQ(host, hosts->get(10, asiolink::IOAddress("2001:db8:1::11")));
+
+    // Client identifiers and addresses out of the subnet are rejected.
+    EXPECT_THROW(parser.build(Element::fromJSON(
+        "[ { \"client-id\": \"01:02:03:04\" } ]")), DhcpConfigError);
+    EXPECT_THROW(parser.build(Element::fromJSON(
+        "[ { \"hw-address\": \"01:02:03:04:05:06\","
+        "    \"ip-addresses\": [ \"2001:db8:2::10\" ] } ]")),
+        DhcpConfigError);
+}
+
+// Checks that SubnetConfigCache only returns the subnets built from the same
+// subnet and global configurations, which are still in use and keep the
+// subnet IDs as they would be assigned by building all subnets again.
+TEST(SubnetConfigCacheTest, reuseSubnet) {
+    SubnetConfigCache<Subnet4> cache("subnet4");
+    ConstElementPtr config = Element::fromJSON(
+        "{ \"renew-timer\": 1000, \"subnet4\": [ "
+        "  { \"subnet\": \"192.0.2.0/24\" },"
+        "  { \"subnet\": \"192.0.3.0/24\", \"id\": 100 },"
+        "  { \"subnet\": \"192.0.4.0/24\" } ] }");
+    const std::vector<ConstElementPtr>& subnet_configs =
+        config->get("subnet4")->listValue();
+    Subnet4Collection subnets;
+    subnets.push_back(Subnet4Ptr(new Subnet4(asiolink::IOAddress("192.0.2.0"),
+                                             24, 1, 2, 3, 1)));
+    subnets.push_back(Subnet4Ptr(new Subnet4(asiolink::IOAddress("192.0.3.0"),
+                                             24, 1, 2, 3, 100)));
+    subnets.push_back(Subnet4Ptr(new Subnet4(asiolink::IOAddress("192.0.4.0"),
+                                             24, 1, 2, 3, 2)));
+
+    // Nothing to reuse at first.
+    cache.startConfig(config, Subnet4Collection());
+    for (size_t i = 0; i < subnet_configs.size(); ++i) {
+        EXPECT_FALSE(cache.reuseSubnet(subnet_configs[i]));
+        cache.addSubnet(subnet_configs[i], subnets[i]);
+    }
+    cache.commit();
+
+    // The same configuration gives the same subnets.
+    cache.startConfig(config, subnets);
+    for (size_t i = 0; i < subnet_configs.size(); ++i) {
+        EXPECT_EQ(subnets[i], cache.reuseSubnet(subnet_configs[i]));
+        cache.addSubnet(subnet_configs[i], subnets[i]);
+    }
+    cache.commit();
+
+    // Removing the first subnet shifts the ID of the last one, so it can't
+    // be reused, unlike the one with an explicit ID. The next subnet built
+    // gets the ID the last one would have had.
+    cache.startConfig(Element::fromJSON(
+        "{ \"renew-timer\": 1000, \"subnet4\": [ ] }"), subnets);
+    EXPECT_EQ(subnets[1], cache.reuseSubnet(subnet_configs[1]));
+    EXPECT_FALSE(cache.reuseSubnet(subnet_configs[2]));
+    EXPECT_EQ(1, Subnet4(asiolink::IOAddress("192.0.4.0"), 24, 1, 2,
+                         3).getID());
+
+    // A changed subnet can't be reused.
+    cache.startConfig(config, subnets);
+    EXPECT_FALSE(cache.reuseSubnet(Element::fromJSON(
+        "{ \"subnet\": \"192.0.2.0/24\", \"valid-lifetime\": 10 }")));
+
+    // Subnets no longer in use are not reused.
+    cache.startConfig(config, Subnet4Collection(subnets.begin() + 1,
+                                                subnets.end()));
+    EXPECT_FALSE(cache.reuseSubnet(subnet_configs[0]));
+    EXPECT_EQ(subnets[1], cache.reuseSubnet(subnet_configs[1]));
+
+    // None are reused if a global parameter changed.
+    cache.startConfig(Element::fromJSON(
+        "{ \"renew-timer\": 2000, \"subnet4\": [ ] }"), subnets);
+    EXPECT_FALSE(cache.reuseSubnet(subnet_configs[1]));
+}
@@ -1506,6 +1506,239 @@ GenericLeaseMgrTest::testRecreateLease6() {
     detailCompareLease(lease, l_returned);
 }
 
+void
+GenericLeaseMgrTest::testGroupCommit() {
+    // Get the leases to be used for the test.
+    vector<Lease4Ptr> leases = createLeases4();
+
+    // Add a lease and roll it back.
+    EXPECT_TRUE(lmptr_->addLease(leases[1]));
+    lmptr_->rollback();
+
+    // Add two leases and commit them together.
+    EXPECT_TRUE(lmptr_->addLease(leases[2]));
+    EXPECT_TRUE(lmptr_->addLease(leases[3]));
+    lmptr_->commit();
+
+    // Committing without writes in between should be fine.
+    EXPECT_NO_THROW(lmptr_->commit());
+
+    // Update a lease but don't commit the update.
+    Lease4Ptr lease(new Lease4(*leases[2]));
+    ++lease->valid_lft_;
+    EXPECT_NO_THROW(lmptr_->updateLease4(lease));
+
+    // Reopen the database: only the committed writes should be there.
+    reopen(V4);
+
+    EXPECT_FALSE(lmptr_->getLease4(ioaddress4_[1]));
+
+    Lease4Ptr l_returned = lmptr_->getLease4(ioaddress4_[2]);
+    ASSERT_TRUE(l_returned);
+    detailCompareLease(leases[2], l_returned);
+
+    l_returned = lmptr_->getLease4(ioaddress4_[3]);
+    ASSERT_TRUE(l_returned);
+    detailCompareLease(leases[3], l_returned);
+}
+
+void
+GenericLeaseMgrTest::testQueryTransaction() {
+    // Get the leases to be used for the test.
+    vector<Lease6Ptr> leases = createLeases6();
+
+    // Add two leases in a transaction and roll them back.
+    lmptr_->beginTransaction();
+    EXPECT_TRUE(lmptr_->addLease(leases[1]));
+    EXPECT_TRUE(lmptr_->addLease(leases[2]));
+    lmptr_->rollback();
+
+    // A transaction in which nothing is written can be committed.
+    lmptr_->beginTransaction();
+    EXPECT_FALSE(lmptr_->getLease6(leases[1]->type_, ioaddress6_[1]));
+    EXPECT_NO_THROW(lmptr_->commit());
+
+    // Add two leases in a transaction and commit them together.
+    lmptr_->beginTransaction();
+    EXPECT_TRUE(lmptr_->addLease(leases[1]));
+    EXPECT_TRUE(lmptr_->addLease(leases[3]));
+    lmptr_->commit();
+
+    // Once the transaction is committed, the writes are committed as they
+    // are made.
+    EXPECT_TRUE(lmptr_->addLease(leases[4]));
+    lmptr_->rollback();
+
+    // Update a lease in a transaction but don't commit the update.
+    lmptr_->beginTransaction();
+    Lease6Ptr lease(new Lease6(*leases[1]));
+    ++lease->valid_lft_;
+    EXPECT_NO_THROW(lmptr_->updateLease6(lease));
+
+    // Reopen the database: only the committed writes should be there.
+    reopen(V6);
+
+    EXPECT_FALSE(lmptr_->getLease6(leases[2]->type_, ioaddress6_[2]));
+
+    Lease6Ptr l_returned = lmptr_->getLease6(leases[1]->type_,
+                                             ioaddress6_[1]);
+    ASSERT_TRUE(l_returned);
+    detailCompareLease(leases[1], l_returned);
+
+    l_returned = lmptr_->getLease6(leases[3]->type_, ioaddress6_[3]);
+    ASSERT_TRUE(l_returned);
+    detailCompareLease(leases[3], l_returned);
+
+    l_returned = lmptr_->getLease6(leases[4]->type_, ioaddress6_[4]);
+    ASSERT_TRUE(l_returned);
+    detailCompareLease(leases[4], l_returned);
+}
+
+void
+GenericLeaseMgrTest::testGetExpiredLeases4() {
+    // Get the leases to be used for the test.
+    vector<Lease4Ptr> leases = createLeases4();
+    ASSERT_EQ(8, leases.size());
+
+    // Leases with an even index are expired, those with the lower index
+    // having expired later. The others are valid.
+    const time_t now = time(NULL);
+    for (size_t i = 0; i < leases.size(); ++i) {
+        leases[i]->valid_lft_ = 100;
+        if (i % 2 == 0) {
+            leases[i]->cltt_ = now - 200 - 10 * i;
+        } else {
+            leases[i]->cltt_ = now;
+        }
+        ASSERT_TRUE(lmptr_->addLease(leases[i]));
+    }
+    lmptr_->commit();
+
+    // All expired leases should be returned, the first expired first.
+    Lease4Collection expired = lmptr_->getExpiredLeases4(0);
+    ASSERT_EQ(4, expired.size());
+    for (size_t i = 0; i < expired.size(); ++i) {
+        size_t index = 2 * (expired.size() - 1 - i);
+        detailCompareLease(leases[index], expired[i]);
+    }
+
+    // Only the two leases which expired first should be returned.
+    expired = lmptr_->getExpiredLeases4(2);
+    ASSERT_EQ(2, expired.size());
+    EXPECT_TRUE(expired[0]->addr_ == leases[6]->addr_);
+    EXPECT_TRUE(expired[1]->addr_ == leases[4]->addr_);
+
+    // Renewing a lease should remove it from the expired ones.
+    leases[0]->cltt_ = now;
+    lmptr_->updateLease4(leases[0]);
+    lmptr_->commit();
+    expired = lmptr_->getExpiredLeases4(0);
+    ASSERT_EQ(3, expired.size());
+    for (size_t i = 0; i < expired.size(); ++i) {
+        EXPECT_FALSE(expired[i]->addr_ == leases[0]->addr_);
+    }
+
+    // Deleted leases shouldn't be returned either.
+    for (size_t i = 0; i < expired.size(); ++i) {
+        EXPECT_TRUE(lmptr_->deleteLease(expired[i]->addr_));
+    }
+    lmptr_->commit();
+    EXPECT_TRUE(lmptr_->getExpiredLeases4(0).empty());
+}
+
+void
+GenericLeaseMgrTest::testGetExpiredLeases6() {
+    // Get the leases to be used for the test.
+    vector<Lease6Ptr> leases = createLeases6();
+    ASSERT_EQ(8, leases.size());
+
+    // Leases with an even index are expired, those with the lower index
+    // having expired later. The others are valid.
+    const time_t now = time(NULL);
+    for (size_t i = 0; i < leases.size(); ++i) {
+        leases[i]->valid_lft_ = 100;
+        if (i % 2 == 0) {
+            leases[i]->cltt_ = now - 200 - 10 * i;
+        } else {
+            leases[i]->cltt_ = now;
+        }
+        ASSERT_TRUE(lmptr_->addLease(leases[i]));
+    }
+    lmptr_->commit();
+
+    // All expired leases should be returned, the first expired first.
+    Lease6Collection expired = lmptr_->getExpiredLeases6(0);
+    ASSERT_EQ(4, expired.size());
+    for (size_t i = 0; i < expired.size(); ++i) {
+        size_t index = 2 * (expired.size() - 1 - i);
+        detailCompareLease(leases[index], expired[i]);
+    }
+
+    // Only the two leases which expired first should be returned.
+    expired = lmptr_->getExpiredLeases6(2);
+    ASSERT_EQ(2, expired.size());
+    EXPECT_TRUE(expired[0]->addr_ == leases[6]->addr_);
+    EXPECT_TRUE(expired[1]->addr_ == leases[4]->addr_);
+
+    // Renewing a lease should remove it from the expired ones.
+    leases[0]->cltt_ = now;
+    lmptr_->updateLease6(leases[0]);
+    lmptr_->commit();
+    expired = lmptr_->getExpiredLeases6(0);
+    ASSERT_EQ(3, expired.size());
+    for (size_t i = 0; i < expired.size(); ++i) {
+        EXPECT_FALSE(expired[i]->addr_ == leases[0]->addr_);
+    }
+
+    // Deleted leases shouldn't be returned either.
+    for (size_t i = 0; i < expired.size(); ++i) {
+        EXPECT_TRUE(lmptr_->deleteLease(expired[i]->addr_));
+    }
+    lmptr_->commit();
+    EXPECT_TRUE(lmptr_->getExpiredLeases6(0).empty());
+}
+
+void
+GenericLeaseMgrTest::testGetLeases6Type() {
+    // Get the leases to be used for the test and add them to the database.
+    vector<Lease6Ptr> leases = createLeases6();
+    ASSERT_EQ(8, leases.size());
+    for (size_t i = 0; i < leases.size(); ++i) {
+        ASSERT_TRUE(lmptr_->addLease(leases[i]));
+    }
+    lmptr_->commit();
+
+    // Each type should return exactly the leases of that type.
+    const Lease::Type types[] = { Lease::TYPE_NA, Lease::TYPE_TA,
+                                  Lease::TYPE_PD };
+    for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); ++t) {
+        Lease6Collection returned = lmptr_->getLeases6(types[t]);
+        size_t expected = 0;
+        for (size_t i = 0; i < leases.size(); ++i) {
+            if (leases[i]->type_ != types[t]) {
+                continue;
+            }
+            ++expected;
+            bool found = false;
+            for (size_t j = 0; j < returned.size(); ++j) {
+                if (returned[j]->addr_ == leases[i]->addr_) {
+                    detailCompareLease(leases[i], returned[j]);
+                    found = true;
+                }
+            }
+            EXPECT_TRUE(found) << "lease " << i << " not returned";
+        }
+        EXPECT_EQ(expected, returned.size());
+    }
+
+    // Deleted leases shouldn't be returned.
+    for (size_t i = 0; i < leases.size(); ++i) {
+        EXPECT_TRUE(lmptr_->deleteLease(leases[i]->addr_));
+    }
+    lmptr_->commit();
+    EXPECT_TRUE(lmptr_->getLeases6(Lease::TYPE_PD).empty());
+}
+
 
 }; // namespace test
 }; // namespace dhcp
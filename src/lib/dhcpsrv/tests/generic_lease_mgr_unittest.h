@@ -245,6 +245,41 @@ public:
     /// persistent storage has been updated as expected.
     void testRecreateLease6();
 
+    /// @brief Check that the lease writes are group committed.
+    ///
+    /// The lease manager must be in group commit mode. This test checks
+    /// that the lease writes are only stored once committed, and that
+    /// those rolled back are lost.
+    void testGroupCommit();
+
+    /// @brief Check that the lease writes of a query are committed together.
+    ///
+    /// The lease manager must not be in group commit mode. This test checks
+    /// that the lease writes made after @c LeaseMgr::beginTransaction are
+    /// only stored once committed, and that the writes made after the
+    /// commit are committed as they are made again.
+    void testQueryTransaction();
+
+    /// @brief Checks that the expired IPv4 leases can be retrieved.
+    ///
+    /// This test adds a number of leases, some of them expired, and checks
+    /// that the expired ones are returned in the order of their expiration
+    /// time and that the limit on their number is honored.
+    void testGetExpiredLeases4();
+
+    /// @brief Checks that the expired IPv6 leases can be retrieved.
+    ///
+    /// This test adds a number of leases, some of them expired, and checks
+    /// that the expired ones are returned in the order of their expiration
+    /// time and that the limit on their number is honored.
+    void testGetExpiredLeases6();
+
+    /// @brief Checks that all IPv6 leases of a type can be retrieved.
+    ///
+    /// This test adds leases of all types and checks that each type
+    /// returns its leases only.
+    void testGetLeases6Type();
+
     /// @brief String forms of IPv4 addresses
     std::vector<std::string>  straddress4_;
 
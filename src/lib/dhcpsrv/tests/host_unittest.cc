@@ -0,0 +1,87 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <dhcpsrv/host.h>
+#include <exceptions/exceptions.h>
+
+#include <gtest/gtest.h>
+
+using namespace bundy;
+using namespace bundy::asiolink;
+using namespace bundy::dhcp;
+
+namespace {
+
+// This test checks that a host can be created from a binary identifier.
+TEST(HostTest, binaryIdentifier) {
+    const uint8_t hwaddr[] = { 0, 1, 2, 3, 4, 5 };
+    Host host(hwaddr, sizeof(hwaddr), Host::IDENT_HWADDR, 7,
+              IOAddress("192.0.2.1"), "myhost");
+
+    EXPECT_EQ(std::vector<uint8_t>(hwaddr, hwaddr + sizeof(hwaddr)),
+              host.getIdentifier());
+    EXPECT_EQ(Host::IDENT_HWADDR, host.getIdentifierType());
+    EXPECT_EQ(7, host.getSubnetID());
+    EXPECT_TRUE(host.hasIPv4Reservation());
+    EXPECT_EQ("192.0.2.1", host.getIPv4Reservation().toText());
+    EXPECT_TRUE(host.getIPv6Reservations().empty());
+    EXPECT_EQ("myhost", host.getHostname());
+    EXPECT_EQ("hw-address=00:01:02:03:04:05", host.getIdentifierAsText());
+
+    // The identifier must not be empty, nor the reserved address IPv6.
+    EXPECT_THROW(Host(hwaddr, 0, Host::IDENT_HWADDR, 7,
+                      IOAddress("192.0.2.1")), BadValue);
+    EXPECT_THROW(Host(hwaddr, sizeof(hwaddr), Host::IDENT_HWADDR, 7,
+                      IOAddress("2001:db8::1")), BadValue);
+}
+
+// This test checks that a host can be created from a textual identifier.
+TEST(HostTest, textIdentifier) {
+    Host hw("01:02:03:04:05:06", "hw-address", 1, IOAddress("0.0.0.0"));
+    EXPECT_EQ(Host::IDENT_HWADDR, hw.getIdentifierType());
+    EXPECT_EQ(6, hw.getIdentifier().size());
+    EXPECT_FALSE(hw.hasIPv4Reservation());
+
+    Host duid("00:01:02:03:04:05:06:07", "duid", 1, IOAddress("0.0.0.0"));
+    EXPECT_EQ(Host::IDENT_DUID, duid.getIdentifierType());
+    EXPECT_EQ("duid=00:01:02:03:04:05:06:07", duid.getIdentifierAsText());
+
+    Host clientid("01:02:03", "client-id", 1, IOAddress("192.0.2.5"));
+    EXPECT_EQ(Host::IDENT_CLIENT_ID, clientid.getIdentifierType());
+    EXPECT_EQ(3, clientid.getIdentifier().size());
+
+    // Invalid identifiers and unknown identifier types are rejected.
+    EXPECT_THROW(Host("01:0x", "hw-address", 1, IOAddress("0.0.0.0")),
+                 BadValue);
+    EXPECT_THROW(Host("01", "client-id", 1, IOAddress("0.0.0.0")),
+                 BadValue);
+    EXPECT_THROW(Host("01:02", "circuit-id", 1, IOAddress("0.0.0.0")),
+                 BadValue);
+}
+
+// This test checks that IPv6 addresses can be reserved.
+TEST(HostTest, ipv6Reservations) {
+    Host host("00:01:02:03", "duid", 1, IOAddress("0.0.0.0"));
+    host.addIPv6Reservation(IOAddress("2001:db8::1"));
+    host.addIPv6Reservation(IOAddress("2001:db8::2"));
+    ASSERT_EQ(2, host.getIPv6Reservations().size());
+    EXPECT_EQ("2001:db8::1", host.getIPv6Reservations()[0].toText());
+    EXPECT_EQ("2001:db8::2", host.getIPv6Reservations()[1].toText());
+
+    EXPECT_THROW(host.addIPv6Reservation(IOAddress("192.0.2.1")), BadValue);
+}
+
+} // end of anonymous namespace
@@ -0,0 +1,139 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <dhcpsrv/lease4_cache.h>
+
+#include <gtest/gtest.h>
+
+using namespace bundy;
+using namespace bundy::asiolink;
+using namespace bundy::dhcp;
+
+namespace {
+
+/// @brief Test fixture class for the cache of the DHCPv4 leases.
+class Lease4CacheTest : public ::testing::Test {
+public:
+    /// @brief Constructor.
+    ///
+    /// Creates the identifiers used in the tests.
+    Lease4CacheTest() : hwaddr_(6, 0x11), clientid_(8, 0x44) {
+    }
+
+    /// @brief Creates a lease of the client in the subnet 1.
+    Lease4Ptr createLease(const char* address) const {
+        return (Lease4Ptr(new Lease4(IOAddress(address), &hwaddr_[0],
+                                     hwaddr_.size(), &clientid_[0],
+                                     clientid_.size(), 3600, 0, 0, 0, 1)));
+    }
+
+    std::vector<uint8_t> hwaddr_;
+    std::vector<uint8_t> clientid_;
+};
+
+// This test checks that the leases written are returned by the lookups
+// by their identifiers, as copies.
+TEST_F(Lease4CacheTest, update) {
+    Lease4Cache cache(10);
+    Lease4Ptr lease;
+    EXPECT_FALSE(cache.get(Lease4Cache::HWADDR, hwaddr_, 1, lease));
+
+    Lease4Ptr written = createLease("192.0.2.10");
+    cache.update(written);
+    EXPECT_EQ(2, cache.size());
+
+    ASSERT_TRUE(cache.get(Lease4Cache::HWADDR, hwaddr_, 1, lease));
+    ASSERT_TRUE(lease);
+    EXPECT_TRUE(*lease == *written);
+    EXPECT_NE(written.get(), lease.get());
+
+    // The caller may modify the lease it got.
+    lease->valid_lft_ = 7200;
+    ASSERT_TRUE(cache.get(Lease4Cache::CLIENT_ID, clientid_, 1, lease));
+    EXPECT_EQ(3600, lease->valid_lft_);
+
+    // Other subnets are not cached.
+    EXPECT_FALSE(cache.get(Lease4Cache::CLIENT_ID, clientid_, 2, lease));
+
+    // The lease is dropped when it is deleted.
+    cache.remove(written->addr_);
+    EXPECT_EQ(0, cache.size());
+    EXPECT_FALSE(cache.get(Lease4Cache::HWADDR, hwaddr_, 1, lease));
+}
+
+// This test checks that a lookup which found no lease is cached until a
+// lease of the client is written.
+TEST_F(Lease4CacheTest, noLease) {
+    Lease4Cache cache(10);
+    cache.put(Lease4Cache::HWADDR, hwaddr_, 1, Lease4Ptr());
+
+    Lease4Ptr lease = createLease("192.0.2.10");
+    ASSERT_TRUE(cache.get(Lease4Cache::HWADDR, hwaddr_, 1, lease));
+    EXPECT_FALSE(lease);
+
+    cache.update(createLease("192.0.2.10"));
+    ASSERT_TRUE(cache.get(Lease4Cache::HWADDR, hwaddr_, 1, lease));
+    ASSERT_TRUE(lease);
+    EXPECT_EQ("192.0.2.10", lease->addr_.toText());
+}
+
+// This test checks that the lookups returning the previous owner of an
+// address are dropped when the lease is given to another client.
+TEST_F(Lease4CacheTest, reuse) {
+    Lease4Cache cache(10);
+    cache.update(createLease("192.0.2.10"));
+
+    Lease4Ptr reused = createLease("192.0.2.10");
+    reused->hwaddr_.assign(6, 0x22);
+    reused->client_id_.reset();
+    cache.update(reused);
+    EXPECT_EQ(1, cache.size());
+
+    Lease4Ptr lease;
+    EXPECT_FALSE(cache.get(Lease4Cache::HWADDR, hwaddr_, 1, lease));
+    EXPECT_FALSE(cache.get(Lease4Cache::CLIENT_ID, clientid_, 1, lease));
+    ASSERT_TRUE(cache.get(Lease4Cache::HWADDR, reused->hwaddr_, 1, lease));
+    EXPECT_TRUE(*lease == *reused);
+}
+
+// This test checks that the least recently used lookups are dropped when
+// the cache is full, and that nothing is cached if the capacity is zero.
+TEST_F(Lease4CacheTest, capacity) {
+    Lease4Cache cache(2);
+    const std::vector<uint8_t> other(6, 0x22);
+    const std::vector<uint8_t> third(6, 0x33);
+    cache.put(Lease4Cache::HWADDR, hwaddr_, 1, Lease4Ptr());
+    cache.put(Lease4Cache::HWADDR, other, 1, Lease4Ptr());
+
+    // Use the first lookup so the second one is dropped.
+    Lease4Ptr lease;
+    EXPECT_TRUE(cache.get(Lease4Cache::HWADDR, hwaddr_, 1, lease));
+    cache.put(Lease4Cache::HWADDR, third, 1, Lease4Ptr());
+    EXPECT_EQ(2, cache.size());
+    EXPECT_TRUE(cache.get(Lease4Cache::HWADDR, hwaddr_, 1, lease));
+    EXPECT_FALSE(cache.get(Lease4Cache::HWADDR, other, 1, lease));
+    EXPECT_TRUE(cache.get(Lease4Cache::HWADDR, third, 1, lease));
+
+    cache.clear();
+    EXPECT_EQ(0, cache.size());
+
+    Lease4Cache disabled(0);
+    disabled.update(createLease("192.0.2.10"));
+    EXPECT_EQ(0, disabled.size());
+    EXPECT_FALSE(disabled.get(Lease4Cache::HWADDR, hwaddr_, 1, lease));
+}
+
+} // end of anonymous namespace
@@ -170,4 +170,18 @@ TEST_F(LeaseMgrFactoryTest, redactAccessStringNoPassword) {
     EXPECT_EQ("mysql", parameters["type"]);
 }
 
+/// @brief haveInstance test
+///
+/// Checks that haveInstance() tells whether a lease manager is available.
+TEST_F(LeaseMgrFactoryTest, haveInstance) {
+    LeaseMgrFactory::destroy();
+    EXPECT_FALSE(LeaseMgrFactory::haveInstance());
+
+    LeaseMgrFactory::create("type=memfile universe=4 persist=false");
+    EXPECT_TRUE(LeaseMgrFactory::haveInstance());
+
+    LeaseMgrFactory::destroy();
+    EXPECT_FALSE(LeaseMgrFactory::haveInstance());
+}
+
 }; // end of anonymous namespace
@@ -173,6 +173,33 @@ public:
         return (leases6_);
     }
 
+    /// @brief Returns all IPv6 leases of a type
+    ///
+    /// @param type ignored
+    ///
+    /// @return whatever is set in leases6_ field
+    virtual Lease6Collection getLeases6(Lease::Type) const {
+        return (leases6_);
+    }
+
+    /// @brief Returns expired IPv4 leases
+    ///
+    /// @param max_leases ignored
+    ///
+    /// @return an empty collection
+    virtual Lease4Collection getExpiredLeases4(const size_t) const {
+        return (Lease4Collection());
+    }
+
+    /// @brief Returns expired IPv6 leases
+    ///
+    /// @param max_leases ignored
+    ///
+    /// @return whatever is set in leases6_ field
+    virtual Lease6Collection getExpiredLeases6(const size_t) const {
+        return (leases6_);
+    }
+
     /// @brief Updates IPv4 lease.
     ///
     /// @param lease4 The lease to be updated.
@@ -241,6 +268,10 @@ public:
     // We need to use it in ConcreteLeaseMgr
     using LeaseMgr::getLease6;
 
+    // Make it accessible to the tests.
+    using LeaseMgr::getGroupCommitParameter;
+    using LeaseMgr::getCacheSizeParameter;
+
     Lease6Collection leases6_; ///< getLease6 methods return this as is
 };
 
@@ -276,6 +307,41 @@ TEST_F(LeaseMgrTest, getParameter) {
     EXPECT_THROW(leasemgr.getParameter("param3"), BadValue);
 }
 
+// This test checks that the group commit size is parsed properly and that
+// the group commit is not used by default.
+TEST_F(LeaseMgrTest, getGroupCommitParameter) {
+    LeaseMgr::ParameterMap pmap;
+    ConcreteLeaseMgr leasemgr(pmap);
+    EXPECT_EQ(0, leasemgr.getGroupCommit());
+    EXPECT_EQ(0, leasemgr.getGroupCommitParameter());
+
+    pmap["group-commit"] = "16";
+    ConcreteLeaseMgr leasemgr16(pmap);
+    EXPECT_EQ(16, leasemgr16.getGroupCommitParameter());
+    // The backend has to support the group commit for it to be used.
+    EXPECT_EQ(0, leasemgr16.getGroupCommit());
+
+    pmap["group-commit"] = "many";
+    ConcreteLeaseMgr leasemgr_invalid(pmap);
+    EXPECT_THROW(leasemgr_invalid.getGroupCommitParameter(), BadValue);
+}
+
+// This test checks that the lease cache size is parsed properly and that
+// the cache is not used by default.
+TEST_F(LeaseMgrTest, getCacheSizeParameter) {
+    LeaseMgr::ParameterMap pmap;
+    ConcreteLeaseMgr leasemgr(pmap);
+    EXPECT_EQ(0, leasemgr.getCacheSizeParameter());
+
+    pmap["cache-size"] = "100000";
+    ConcreteLeaseMgr leasemgr_cache(pmap);
+    EXPECT_EQ(100000, leasemgr_cache.getCacheSizeParameter());
+
+    pmap["cache-size"] = "-1";
+    ConcreteLeaseMgr leasemgr_invalid(pmap);
+    EXPECT_THROW(leasemgr_invalid.getCacheSizeParameter(), BadValue);
+}
+
 // This test checks if getLease6() method is working properly for 0 (NULL),
 // 1 (return the lease) and more than 1 leases (throw).
 TEST_F(LeaseMgrTest, getLease6) {
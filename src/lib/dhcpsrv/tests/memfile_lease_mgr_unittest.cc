@@ -16,6 +16,7 @@
 
 #include <asiolink/io_address.h>
 #include <dhcp/duid.h>
+#include <dhcp/iface_mgr.h>
 #include <dhcpsrv/cfgmgr.h>
 #include <dhcpsrv/lease_mgr.h>
 #include <dhcpsrv/lease_mgr_factory.h>
@@ -91,22 +92,28 @@ public:
     ///
     /// @param no_universe Indicates whether universe parameter should be
     /// included (false), or not (true).
+    /// @param params Additional parameters appended to the string.
     ///
     /// @return Configuration string for @c LeaseMgrFactory.
-    static std::string getConfigString(Universe u) {
+    static std::string getConfigString(Universe u,
+                                       const std::string& params = "") {
         std::ostringstream s;
         s << "type=memfile " << (u == V4 ? "universe=4 " : "universe=6 ")
           << "name="
           << getLeaseFilePath(u == V4 ? "leasefile4_0.csv" : "leasefile6_0.csv");
+        if (!params.empty()) {
+            s << " " << params;
+        }
         return (s.str());
     }
 
     /// @brief Creates instance of the backend.
     ///
     /// @param u Universe (v4 or V6).
-    void startBackend(Universe u) {
+    /// @param params Additional parameters of the backend.
+    void startBackend(Universe u, const std::string& params = "") {
         try {
-            LeaseMgrFactory::create(getConfigString(u));
+            LeaseMgrFactory::create(getConfigString(u, params));
         } catch (...) {
             std::cerr << "*** ERROR: unable to create instance of the Memfile\n"
                 " lease database backend.\n";
@@ -142,6 +149,26 @@ TEST_F(MemfileLeaseMgrTest, constructor) {
     pmap["persist"] = "bogus";
     pmap["name"] = getLeaseFilePath("leasefile4_1.csv");
     EXPECT_THROW(lease_mgr.reset(new Memfile_LeaseMgr(pmap)), bundy::BadValue);
+
+    // The LFC threshold must be a non-negative number.
+    pmap["persist"] = "true";
+    pmap["lfc-threshold"] = "bogus";
+    EXPECT_THROW(lease_mgr.reset(new Memfile_LeaseMgr(pmap)), bundy::BadValue);
+
+    // The number of shards must be a positive number.
+    pmap.erase("lfc-threshold");
+    pmap["shards"] = "0";
+    EXPECT_THROW(lease_mgr.reset(new Memfile_LeaseMgr(pmap)), bundy::BadValue);
+    pmap["shards"] = "bogus";
+    EXPECT_THROW(lease_mgr.reset(new Memfile_LeaseMgr(pmap)), bundy::BadValue);
+    pmap["shards"] = "4";
+    EXPECT_NO_THROW(lease_mgr.reset(new Memfile_LeaseMgr(pmap)));
+
+    // The lease file is either in the CSV or the binary format.
+    pmap["format"] = "bogus";
+    EXPECT_THROW(lease_mgr.reset(new Memfile_LeaseMgr(pmap)), bundy::BadValue);
+    pmap["format"] = "csv";
+    EXPECT_NO_THROW(lease_mgr.reset(new Memfile_LeaseMgr(pmap)));
 }
 
 // Checks if the getType() and getName() methods both return "memfile".
@@ -204,6 +231,265 @@ TEST_F(MemfileLeaseMgrTest, persistLeases) {
 }
 
 
+// Checks that in the group commit mode the lease records are written to the
+// lease file when the changes are committed.
+TEST_F(MemfileLeaseMgrTest, groupCommit) {
+    LeaseFileIO io4(getLeaseFilePath("leasefile4_1.csv"));
+
+    LeaseMgr::ParameterMap pmap;
+    pmap["universe"] = "4";
+    pmap["name"] = getLeaseFilePath("leasefile4_1.csv");
+    pmap["group-commit"] = "4";
+    boost::scoped_ptr<Memfile_LeaseMgr> lease_mgr(new Memfile_LeaseMgr(pmap));
+    EXPECT_EQ(4, lease_mgr->getGroupCommit());
+
+    std::vector<Lease4Ptr> leases = createLeases4();
+    ASSERT_TRUE(lease_mgr->addLease(leases[1]));
+    ASSERT_TRUE(lease_mgr->addLease(leases[2]));
+
+    // The records are buffered until the commit.
+    std::string contents = io4.readFile();
+    EXPECT_EQ(std::string::npos, contents.find(ioaddress4_[1].toText()));
+    EXPECT_EQ(std::string::npos, contents.find(ioaddress4_[2].toText()));
+
+    ASSERT_NO_THROW(lease_mgr->commit());
+    contents = io4.readFile();
+    EXPECT_NE(std::string::npos, contents.find(ioaddress4_[1].toText()));
+    EXPECT_NE(std::string::npos, contents.find(ioaddress4_[2].toText()));
+
+    // The committed leases should be loaded when the lease file is reopened.
+    lease_mgr.reset(new Memfile_LeaseMgr(pmap));
+    Lease4Ptr lease = lease_mgr->getLease4(ioaddress4_[1]);
+    ASSERT_TRUE(lease);
+    detailCompareLease(leases[1], lease);
+    EXPECT_TRUE(lease_mgr->getLease4(ioaddress4_[2]));
+}
+
+// Checks that the lease file is compacted when the number of superseded
+// records exceeds the LFC threshold.
+TEST_F(MemfileLeaseMgrTest, leaseFileCleanup) {
+    LeaseFileIO io4(getLeaseFilePath("leasefile4_1.csv"));
+    LeaseFileIO tmp_io4(getLeaseFilePath("leasefile4_1.csv.tmp"));
+
+    LeaseMgr::ParameterMap pmap;
+    pmap["universe"] = "4";
+    pmap["name"] = getLeaseFilePath("leasefile4_1.csv");
+    pmap["lfc-threshold"] = "4";
+    boost::scoped_ptr<Memfile_LeaseMgr> lease_mgr(new Memfile_LeaseMgr(pmap));
+
+    std::vector<Lease4Ptr> leases = createLeases4();
+    ASSERT_TRUE(lease_mgr->addLease(leases[1]));
+    ASSERT_TRUE(lease_mgr->addLease(leases[2]));
+    ASSERT_TRUE(lease_mgr->deleteLease(ioaddress4_[2]));
+    EXPECT_EQ(3, lease_mgr->getLeaseFileRecords(Memfile_LeaseMgr::V4));
+
+    // Update the lease until the file holds more than 4 superseded records.
+    Lease4Ptr lease(new Lease4(*leases[1]));
+    for (int i = 0; i < 2; ++i) {
+        ++lease->valid_lft_;
+        ASSERT_NO_THROW(lease_mgr->updateLease4(lease));
+    }
+    EXPECT_EQ(5, lease_mgr->getLeaseFileRecords(Memfile_LeaseMgr::V4));
+    ++lease->valid_lft_;
+    ASSERT_NO_THROW(lease_mgr->updateLease4(lease));
+
+    // The file should now hold the single lease.
+    EXPECT_EQ(1, lease_mgr->getLeaseFileRecords(Memfile_LeaseMgr::V4));
+    EXPECT_FALSE(tmp_io4.exists());
+    std::string contents = io4.readFile();
+    EXPECT_NE(std::string::npos, contents.find(ioaddress4_[1].toText()));
+    EXPECT_EQ(std::string::npos, contents.find(ioaddress4_[2].toText()));
+
+    // Subsequent records should be appended to the new file.
+    ASSERT_TRUE(lease_mgr->addLease(leases[3]));
+    EXPECT_EQ(2, lease_mgr->getLeaseFileRecords(Memfile_LeaseMgr::V4));
+
+    // Make sure that the leases are loaded from the compacted file.
+    pmap["lfc-threshold"] = "0";
+    lease_mgr.reset(new Memfile_LeaseMgr(pmap));
+    EXPECT_EQ(2, lease_mgr->getLeaseFileRecords(Memfile_LeaseMgr::V4));
+    Lease4Ptr l_returned = lease_mgr->getLease4(ioaddress4_[1]);
+    ASSERT_TRUE(l_returned);
+    detailCompareLease(lease, l_returned);
+    EXPECT_FALSE(lease_mgr->getLease4(ioaddress4_[2]));
+    EXPECT_TRUE(lease_mgr->getLease4(ioaddress4_[3]));
+}
+
+// Checks that the lease file holding too many superseded records is
+// compacted when the leases are loaded and that the compaction can be
+// also requested explicitly.
+TEST_F(MemfileLeaseMgrTest, leaseFileCleanupOnLoad) {
+    LeaseFileIO io6(getLeaseFilePath("leasefile6_1.csv"));
+
+    LeaseMgr::ParameterMap pmap;
+    pmap["universe"] = "6";
+    pmap["name"] = getLeaseFilePath("leasefile6_1.csv");
+    boost::scoped_ptr<Memfile_LeaseMgr> lease_mgr(new Memfile_LeaseMgr(pmap));
+
+    std::vector<Lease6Ptr> leases = createLeases6();
+    ASSERT_TRUE(lease_mgr->addLease(leases[1]));
+    Lease6Ptr lease(new Lease6(*leases[1]));
+    for (int i = 0; i < 3; ++i) {
+        ++lease->valid_lft_;
+        ASSERT_NO_THROW(lease_mgr->updateLease6(lease));
+    }
+    EXPECT_EQ(4, lease_mgr->getLeaseFileRecords(Memfile_LeaseMgr::V6));
+
+    // The cleanup is disabled, so the records are kept until the compaction
+    // is requested.
+    ASSERT_NO_THROW(lease_mgr->compactLeaseFile(Memfile_LeaseMgr::V6));
+    EXPECT_EQ(1, lease_mgr->getLeaseFileRecords(Memfile_LeaseMgr::V6));
+
+    ASSERT_TRUE(lease_mgr->addLease(leases[2]));
+    ASSERT_TRUE(lease_mgr->deleteLease(ioaddress6_[2]));
+    EXPECT_EQ(3, lease_mgr->getLeaseFileRecords(Memfile_LeaseMgr::V6));
+
+    // The file holds 2 superseded records, which exceeds the threshold.
+    pmap["lfc-threshold"] = "1";
+    lease_mgr.reset(new Memfile_LeaseMgr(pmap));
+    EXPECT_EQ(1, lease_mgr->getLeaseFileRecords(Memfile_LeaseMgr::V6));
+    Lease6Ptr l_returned = lease_mgr->getLease6(leases[1]->type_,
+                                                ioaddress6_[1]);
+    ASSERT_TRUE(l_returned);
+    detailCompareLease(lease, l_returned);
+    EXPECT_FALSE(lease_mgr->getLease6(leases[2]->type_, ioaddress6_[2]));
+}
+
+// Checks that the leases are written to and loaded from the binary lease
+// file, which is compacted like the CSV one.
+TEST_F(MemfileLeaseMgrTest, binaryFormat) {
+    LeaseFileIO io4(getLeaseFilePath("leasefile4_1.bin"));
+    LeaseFileIO io6(getLeaseFilePath("leasefile6_1.bin"));
+
+    LeaseMgr::ParameterMap pmap;
+    pmap["universe"] = "4";
+    pmap["format"] = "binary";
+    pmap["name"] = getLeaseFilePath("leasefile4_1.bin");
+    pmap["lfc-threshold"] = "2";
+    boost::scoped_ptr<Memfile_LeaseMgr> lease_mgr(new Memfile_LeaseMgr(pmap));
+    EXPECT_EQ(pmap["name"], lease_mgr->getLeaseFilePath(Memfile_LeaseMgr::V4));
+    EXPECT_TRUE(lease_mgr->persistLeases(Memfile_LeaseMgr::V4));
+
+    std::vector<Lease4Ptr> leases = createLeases4();
+    ASSERT_TRUE(lease_mgr->addLease(leases[1]));
+    ASSERT_TRUE(lease_mgr->addLease(leases[2]));
+    ASSERT_TRUE(lease_mgr->deleteLease(ioaddress4_[2]));
+    Lease4Ptr lease(new Lease4(*leases[1]));
+    ++lease->valid_lft_;
+    ASSERT_NO_THROW(lease_mgr->updateLease4(lease));
+    // The file held 3 superseded records, so it's been compacted.
+    EXPECT_EQ(1, lease_mgr->getLeaseFileRecords(Memfile_LeaseMgr::V4));
+    ASSERT_TRUE(lease_mgr->addLease(leases[3]));
+
+    // The records aren't text.
+    EXPECT_EQ(std::string::npos,
+              io4.readFile().find(ioaddress4_[1].toText()));
+
+    pmap["lfc-threshold"] = "0";
+    lease_mgr.reset(new Memfile_LeaseMgr(pmap));
+    EXPECT_EQ(2, lease_mgr->getLeaseFileRecords(Memfile_LeaseMgr::V4));
+    Lease4Ptr l_returned = lease_mgr->getLease4(ioaddress4_[1]);
+    ASSERT_TRUE(l_returned);
+    detailCompareLease(lease, l_returned);
+    EXPECT_FALSE(lease_mgr->getLease4(ioaddress4_[2]));
+    l_returned = lease_mgr->getLease4(ioaddress4_[3]);
+    ASSERT_TRUE(l_returned);
+    detailCompareLease(leases[3], l_returned);
+
+    // The same for the DHCPv6 leases, in the group commit mode.
+    pmap["universe"] = "6";
+    pmap["name"] = getLeaseFilePath("leasefile6_1.bin");
+    pmap["group-commit"] = "2";
+    lease_mgr.reset(new Memfile_LeaseMgr(pmap));
+    std::vector<Lease6Ptr> leases6 = createLeases6();
+    ASSERT_TRUE(lease_mgr->addLease(leases6[1]));
+    ASSERT_TRUE(lease_mgr->addLease(leases6[2]));
+    ASSERT_NO_THROW(lease_mgr->commit());
+
+    lease_mgr.reset(new Memfile_LeaseMgr(pmap));
+    Lease6Ptr l6_returned = lease_mgr->getLease6(leases6[1]->type_,
+                                                 ioaddress6_[1]);
+    ASSERT_TRUE(l6_returned);
+    detailCompareLease(leases6[1], l6_returned);
+    EXPECT_TRUE(lease_mgr->getLease6(leases6[2]->type_, ioaddress6_[2]));
+
+    // A CSV lease file can't be used as a binary one.
+    io6.writeFile("address,duid,valid_lifetime,expire,subnet_id,"
+                  "pref_lifetime,lease_type,iaid,prefix_len,fqdn_fwd,"
+                  "fqdn_rev,hostname\n");
+    EXPECT_THROW(lease_mgr.reset(new Memfile_LeaseMgr(pmap)),
+                 BinaryLeaseFileError);
+}
+
+// Checks that the lease changes are streamed to the standby server, which
+// starts with all leases of the primary server.
+TEST_F(MemfileLeaseMgrTest, leaseStream) {
+    LeaseMgr::ParameterMap standby_pmap;
+    standby_pmap["universe"] = "4";
+    standby_pmap["persist"] = "false";
+    standby_pmap["listen-address"] = "127.0.0.1";
+    standby_pmap["listen-port"] = "16747";
+    boost::scoped_ptr<Memfile_LeaseMgr>
+        standby(new Memfile_LeaseMgr(standby_pmap));
+
+    // The standby server drops the leases it holds when the stream starts.
+    std::vector<Lease4Ptr> leases = createLeases4();
+    ASSERT_TRUE(standby->addLease(leases[3]));
+
+    LeaseMgr::ParameterMap pmap;
+    pmap["universe"] = "4";
+    pmap["persist"] = "false";
+    pmap["standby-address"] = "127.0.0.1";
+    pmap["standby-port"] = "16747";
+    boost::scoped_ptr<Memfile_LeaseMgr> primary(new Memfile_LeaseMgr(pmap));
+    ASSERT_TRUE(primary->addLease(leases[1]));
+    // The connection may be established on the next write.
+    ASSERT_TRUE(primary->addLease(leases[2]));
+
+    // The standby server receives the records while it waits for the
+    // queries.
+    for (int i = 0; (i < 100) && standby->getLease4(ioaddress4_[3]); ++i) {
+        IfaceMgr::instance().receive4(0, 10000);
+    }
+    for (int i = 0; (i < 100) && !standby->getLease4(ioaddress4_[2]); ++i) {
+        IfaceMgr::instance().receive4(0, 10000);
+    }
+    EXPECT_FALSE(standby->getLease4(ioaddress4_[3]));
+    Lease4Ptr lease = standby->getLease4(ioaddress4_[1]);
+    ASSERT_TRUE(lease);
+    detailCompareLease(leases[1], lease);
+    EXPECT_TRUE(standby->getLease4(ioaddress4_[2]));
+
+    // The updates and deletions follow.
+    lease.reset(new Lease4(*leases[2]));
+    ++lease->valid_lft_;
+    ASSERT_NO_THROW(primary->updateLease4(lease));
+    ASSERT_TRUE(primary->deleteLease(ioaddress4_[1]));
+    for (int i = 0; (i < 100) && standby->getLease4(ioaddress4_[1]); ++i) {
+        IfaceMgr::instance().receive4(0, 10000);
+    }
+    EXPECT_FALSE(standby->getLease4(ioaddress4_[1]));
+    Lease4Ptr l_returned = standby->getLease4(ioaddress4_[2]);
+    ASSERT_TRUE(l_returned);
+    detailCompareLease(lease, l_returned);
+}
+
+// Checks that the lease stream parameters are validated.
+TEST_F(MemfileLeaseMgrTest, leaseStreamParameters) {
+    LeaseMgr::ParameterMap pmap;
+    pmap["universe"] = "4";
+    pmap["persist"] = "false";
+    pmap["standby-address"] = "127.0.0.1";
+    EXPECT_THROW(Memfile_LeaseMgr lease_mgr(pmap), BadValue);
+
+    pmap["standby-port"] = "65536";
+    EXPECT_THROW(Memfile_LeaseMgr lease_mgr(pmap), BadValue);
+
+    pmap["standby-address"] = "primary";
+    pmap["standby-port"] = "6747";
+    EXPECT_THROW(Memfile_LeaseMgr lease_mgr(pmap), BadValue);
+}
+
 // Checks that adding/getting/deleting a Lease6 object works.
 TEST_F(MemfileLeaseMgrTest, addGetDelete6) {
     startBackend(V6);
@@ -384,6 +670,128 @@ TEST_F(MemfileLeaseMgrTest, DISABLED_updateLease6) {
     testUpdateLease6();
 }
 
+/// @brief Expired leases retrieval tests
+///
+/// Checks that the expired leases are returned in the order of their
+/// expiration time, using the expiration time index.
+TEST_F(MemfileLeaseMgrTest, getExpiredLeases4) {
+    startBackend(V4);
+    testGetExpiredLeases4();
+}
+
+TEST_F(MemfileLeaseMgrTest, getExpiredLeases6) {
+    startBackend(V6);
+    testGetExpiredLeases6();
+}
+
+/// @brief Checks that all IPv6 leases of a type are returned.
+TEST_F(MemfileLeaseMgrTest, getLeases6Type) {
+    startBackend(V6);
+    testGetLeases6Type();
+}
+
+/// @brief Partitioned lease storage tests
+///
+/// Checks that the leases held in several partitions are added, returned,
+/// expired and deleted as if they were held in one.
+TEST_F(MemfileLeaseMgrTest, basicLease4Shards) {
+    startBackend(V4, "shards=4");
+    testBasicLease4();
+}
+
+TEST_F(MemfileLeaseMgrTest, basicLease6Shards) {
+    startBackend(V6, "shards=4");
+    testAddGetDelete6(true);
+}
+
+TEST_F(MemfileLeaseMgrTest, getExpiredLeases4Shards) {
+    startBackend(V4, "shards=4");
+    testGetExpiredLeases4();
+}
+
+TEST_F(MemfileLeaseMgrTest, getExpiredLeases6Shards) {
+    startBackend(V6, "shards=4");
+    testGetExpiredLeases6();
+}
+
+// Checks that a lease moved to a subnet held in another partition is found
+// by the subnet and that the partitioned leases are reloaded from the lease
+// file.
+TEST_F(MemfileLeaseMgrTest, moveLeaseBetweenShards) {
+    LeaseFileIO io4(getLeaseFilePath("leasefile4_1.csv"));
+
+    LeaseMgr::ParameterMap pmap;
+    pmap["universe"] = "4";
+    pmap["name"] = getLeaseFilePath("leasefile4_1.csv");
+    pmap["shards"] = "4";
+    boost::scoped_ptr<Memfile_LeaseMgr> lease_mgr(new Memfile_LeaseMgr(pmap));
+
+    // Leases 1, 3 and 5 share the hardware address and belong to subnets
+    // held in different partitions. Lease 7 has no hardware address, so it
+    // can't be written to the lease file.
+    std::vector<Lease4Ptr> leases = createLeases4();
+    leases.pop_back();
+    for (size_t i = 1; i < leases.size(); ++i) {
+        ASSERT_TRUE(lease_mgr->addLease(leases[i]));
+    }
+    EXPECT_EQ(3, lease_mgr->getLease4(HWAddr(leases[1]->hwaddr_,
+                                             HTYPE_ETHER)).size());
+    // The address is already leased in another partition.
+    Lease4Ptr duplicate(new Lease4(*leases[1]));
+    duplicate->subnet_id_ = leases[6]->subnet_id_;
+    EXPECT_FALSE(lease_mgr->addLease(duplicate));
+
+    // Move the lease to the subnet held in another partition.
+    const SubnetID old_subnet_id = leases[1]->subnet_id_;
+    Lease4Ptr lease(new Lease4(*leases[1]));
+    lease->subnet_id_ = leases[6]->subnet_id_;
+    ASSERT_NO_THROW(lease_mgr->updateLease4(lease));
+    HWAddr hwaddr(lease->hwaddr_, HTYPE_ETHER);
+    EXPECT_FALSE(lease_mgr->getLease4(hwaddr, old_subnet_id));
+    Lease4Ptr l_returned = lease_mgr->getLease4(hwaddr, lease->subnet_id_);
+    ASSERT_TRUE(l_returned);
+    detailCompareLease(lease, l_returned);
+    EXPECT_EQ(3, lease_mgr->getLease4(hwaddr).size());
+    ASSERT_TRUE(lease_mgr->deleteLease(ioaddress4_[2]));
+
+    // Reload the leases with a different number of partitions.
+    pmap["shards"] = "3";
+    lease_mgr.reset(new Memfile_LeaseMgr(pmap));
+    l_returned = lease_mgr->getLease4(hwaddr, lease->subnet_id_);
+    ASSERT_TRUE(l_returned);
+    detailCompareLease(lease, l_returned);
+    EXPECT_FALSE(lease_mgr->getLease4(hwaddr, old_subnet_id));
+    EXPECT_FALSE(lease_mgr->getLease4(ioaddress4_[2]));
+    EXPECT_TRUE(lease_mgr->getLease4(ioaddress4_[3]));
+
+    // The partitions are written to the one lease file.
+    ASSERT_NO_THROW(lease_mgr->compactLeaseFile(Memfile_LeaseMgr::V4));
+    EXPECT_EQ(leases.size() - 2,
+              lease_mgr->getLeaseFileRecords(Memfile_LeaseMgr::V4));
+}
+
+// Checks that the leases returned by hardware address and by client
+// identifier are copies, so as changing them doesn't corrupt the indexes of
+// the stored leases.
+TEST_F(MemfileLeaseMgrTest, getLease4CollectionCopies) {
+    startBackend(V4, "shards=4");
+    std::vector<Lease4Ptr> leases = createLeases4();
+    ASSERT_TRUE(lmptr_->addLease(leases[1]));
+    HWAddr hwaddr(leases[1]->hwaddr_, HTYPE_ETHER);
+
+    Lease4Collection returned = lmptr_->getLease4(hwaddr);
+    ASSERT_EQ(1, returned.size());
+    EXPECT_NE(leases[1], returned[0]);
+    detailCompareLease(leases[1], returned[0]);
+    returned[0]->hwaddr_.clear();
+    EXPECT_EQ(1, lmptr_->getLease4(hwaddr).size());
+
+    returned = lmptr_->getLease4(*leases[1]->client_id_);
+    ASSERT_EQ(1, returned.size());
+    EXPECT_NE(leases[1], returned[0]);
+    detailCompareLease(leases[1], returned[0]);
+}
+
 /// @brief DHCPv4 Lease recreation tests
 ///
 /// Checks that the lease can be created, deleted and recreated with
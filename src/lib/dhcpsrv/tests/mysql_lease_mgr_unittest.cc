@@ -488,6 +488,23 @@ TEST_F(MySqlLeaseMgrTest, updateLease6) {
     testUpdateLease6();
 }
 
+/// @brief Expired leases retrieval tests
+///
+/// Checks that the expired leases are returned in the order of their
+/// expiration time.
+TEST_F(MySqlLeaseMgrTest, getExpiredLeases4) {
+    testGetExpiredLeases4();
+}
+
+TEST_F(MySqlLeaseMgrTest, getExpiredLeases6) {
+    testGetExpiredLeases6();
+}
+
+/// @brief Checks that all IPv6 leases of a type are returned.
+TEST_F(MySqlLeaseMgrTest, getLeases6Type) {
+    testGetLeases6Type();
+}
+
 /// @brief DHCPv4 Lease recreation tests
 ///
 /// Checks that the lease can be created, deleted and recreated with
@@ -506,4 +523,27 @@ TEST_F(MySqlLeaseMgrTest, testRecreateLease6) {
     testRecreateLease6();
 }
 
+/// @brief Group commit test
+///
+/// Checks that the lease writes are only committed when requested if the
+/// database is opened with the group commit size set.
+TEST_F(MySqlLeaseMgrTest, groupCommit) {
+    EXPECT_EQ(0, lmptr_->getGroupCommit());
+
+    LeaseMgrFactory::destroy();
+    LeaseMgrFactory::create(validConnectionString() + " group-commit=8");
+    lmptr_ = &(LeaseMgrFactory::instance());
+    EXPECT_EQ(8, lmptr_->getGroupCommit());
+
+    testGroupCommit();
+}
+
+/// @brief Query transaction test
+///
+/// Checks that the lease writes made after beginTransaction() are committed
+/// together.
+TEST_F(MySqlLeaseMgrTest, queryTransaction) {
+    testQueryTransaction();
+}
+
 }; // Of anonymous namespace
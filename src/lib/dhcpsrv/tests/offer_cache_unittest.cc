@@ -0,0 +1,128 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <dhcpsrv/offer_cache.h>
+#include <util/time_utilities.h>
+
+#include <gtest/gtest.h>
+
+using namespace bundy;
+using namespace bundy::asiolink;
+using namespace bundy::dhcp;
+
+namespace {
+
+/// @brief Test fixture class for the table of the DHCPv4 offers.
+class OfferCacheTest : public ::testing::Test {
+public:
+    /// @brief Constructor.
+    ///
+    /// Creates the identifiers of two clients used in the tests.
+    OfferCacheTest() : hwaddr1_(6, 0x11), hwaddr2_(6, 0x22),
+                       clientid_(8, 0x44), address_("0.0.0.0") {
+    }
+
+    std::vector<uint8_t> hwaddr1_;
+    std::vector<uint8_t> hwaddr2_;
+    std::vector<uint8_t> clientid_;
+    std::vector<uint8_t> no_clientid_;
+    IOAddress address_;
+};
+
+// This test checks that an offer is returned to its client and hides the
+// address from the other clients.
+TEST_F(OfferCacheTest, offer) {
+    OfferCache offers(10);
+    EXPECT_FALSE(offers.get(hwaddr1_, clientid_, 1, address_));
+
+    offers.put(hwaddr1_, clientid_, 1, IOAddress("192.0.2.10"));
+    EXPECT_EQ(1, offers.size());
+    ASSERT_TRUE(offers.get(hwaddr1_, clientid_, 1, address_));
+    EXPECT_EQ("192.0.2.10", address_.toText());
+
+    // The client is identified by both identifiers in its subnet.
+    EXPECT_FALSE(offers.get(hwaddr1_, no_clientid_, 1, address_));
+    EXPECT_FALSE(offers.get(hwaddr2_, clientid_, 1, address_));
+    EXPECT_FALSE(offers.get(hwaddr1_, clientid_, 2, address_));
+
+    EXPECT_FALSE(offers.offeredToOther(IOAddress("192.0.2.10"), hwaddr1_,
+                                       clientid_));
+    EXPECT_TRUE(offers.offeredToOther(IOAddress("192.0.2.10"), hwaddr2_,
+                                      clientid_));
+    EXPECT_TRUE(offers.offeredToOther(IOAddress("192.0.2.10"), hwaddr1_,
+                                      no_clientid_));
+    EXPECT_FALSE(offers.offeredToOther(IOAddress("192.0.2.11"), hwaddr2_,
+                                       clientid_));
+
+    // A new offer to the client replaces the previous one.
+    offers.put(hwaddr1_, clientid_, 1, IOAddress("192.0.2.11"));
+    EXPECT_EQ(1, offers.size());
+    ASSERT_TRUE(offers.get(hwaddr1_, clientid_, 1, address_));
+    EXPECT_EQ("192.0.2.11", address_.toText());
+    EXPECT_FALSE(offers.offeredToOther(IOAddress("192.0.2.10"), hwaddr2_,
+                                       clientid_));
+
+    // So does an offer of the address to another client.
+    offers.put(hwaddr2_, no_clientid_, 1, IOAddress("192.0.2.11"));
+    EXPECT_EQ(1, offers.size());
+    EXPECT_FALSE(offers.get(hwaddr1_, clientid_, 1, address_));
+    ASSERT_TRUE(offers.get(hwaddr2_, no_clientid_, 1, address_));
+    EXPECT_EQ("192.0.2.11", address_.toText());
+
+    // The offer is dropped when the client gets a lease.
+    offers.remove(hwaddr2_, no_clientid_, 1);
+    EXPECT_EQ(0, offers.size());
+    EXPECT_FALSE(offers.offeredToOther(IOAddress("192.0.2.11"), hwaddr1_,
+                                       clientid_));
+}
+
+// This test checks that the offers are dropped when they expire.
+TEST_F(OfferCacheTest, expire) {
+    OfferCache offers(10);
+    offers.put(hwaddr1_, clientid_, 1, IOAddress("192.0.2.10"));
+    offers.put(hwaddr2_, clientid_, 1, IOAddress("192.0.2.11"));
+    EXPECT_EQ(2, offers.size());
+
+    const time_t now = bundy::util::CoarseClock::getTime();
+    offers.purge(now);
+    EXPECT_EQ(2, offers.size());
+    offers.purge(now + 10);
+    EXPECT_EQ(0, offers.size());
+    EXPECT_FALSE(offers.get(hwaddr1_, clientid_, 1, address_));
+    EXPECT_FALSE(offers.offeredToOther(IOAddress("192.0.2.11"), hwaddr1_,
+                                       clientid_));
+}
+
+// This test checks that no offer is held when the lifetime is zero, and
+// that the offers are dropped when the lifetime changes.
+TEST_F(OfferCacheTest, lifetime) {
+    OfferCache offers;
+    EXPECT_EQ(0, offers.getLifetime());
+    offers.put(hwaddr1_, clientid_, 1, IOAddress("192.0.2.10"));
+    EXPECT_EQ(0, offers.size());
+    EXPECT_FALSE(offers.get(hwaddr1_, clientid_, 1, address_));
+
+    offers.setLifetime(5);
+    EXPECT_EQ(5, offers.getLifetime());
+    offers.put(hwaddr1_, clientid_, 1, IOAddress("192.0.2.10"));
+    EXPECT_EQ(1, offers.size());
+    offers.setLifetime(5);
+    EXPECT_EQ(1, offers.size());
+    offers.setLifetime(10);
+    EXPECT_EQ(0, offers.size());
+}
+
+}
@@ -0,0 +1,148 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <dhcpsrv/packet_timing.h>
+#include <exceptions/exceptions.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+using namespace bundy;
+using namespace bundy::dhcp;
+using namespace boost::posix_time;
+
+namespace {
+
+/// @brief Returns the number of values counted in a histogram.
+uint64_t
+countValues(const statistics::Histogram& histogram) {
+    uint64_t count = 0;
+    for (size_t i = 0; i < histogram.getBucketCount(); ++i) {
+        count += histogram.get(i);
+    }
+    return (count);
+}
+
+// This test checks that nothing is timed while the timing is disabled.
+TEST(PacketTimingTest, disabled) {
+    PacketTiming timing;
+    EXPECT_FALSE(timing.isEnabled());
+
+    timing.start(microsec_clock::universal_time());
+    {
+        PacketTiming::Scope scope(timing, PacketTiming::UNPACK);
+    }
+    timing.finish(1);
+    EXPECT_EQ(0, timing.getCount());
+    EXPECT_EQ(0, countValues(timing.getHistogram(PacketTiming::STAGE_COUNT)));
+}
+
+// This test checks that the time of a packet is charged to its stages,
+// with the nested stages excluded from the outer ones.
+TEST(PacketTimingTest, stages) {
+    PacketTiming timing;
+    timing.setEnabled(true);
+
+    // The packet has been received 5 ms ago.
+    timing.start(microsec_clock::universal_time() - milliseconds(5));
+    {
+        PacketTiming::Scope subnet(timing, PacketTiming::SUBNET);
+        usleep(2000);
+        {
+            PacketTiming::Scope hooks(timing, PacketTiming::HOOKS);
+            usleep(3000);
+        }
+    }
+    timing.finish(1);
+
+    EXPECT_EQ(1, timing.getCount());
+    for (int i = 0; i <= PacketTiming::STAGE_COUNT; ++i) {
+        const PacketTiming::Stage stage = static_cast<PacketTiming::Stage>(i);
+        EXPECT_EQ(1, countValues(timing.getHistogram(stage)))
+            << PacketTiming::getStageName(stage);
+    }
+    EXPECT_LE(5000, timing.getTotalTime(PacketTiming::RECEIVE));
+    EXPECT_LE(2000, timing.getTotalTime(PacketTiming::SUBNET));
+    EXPECT_GT(3000, timing.getTotalTime(PacketTiming::SUBNET));
+    EXPECT_LE(3000, timing.getTotalTime(PacketTiming::HOOKS));
+    EXPECT_LE(10000, timing.getTotalTime(PacketTiming::STAGE_COUNT));
+
+    data::ConstElementPtr times = timing.toElement();
+    EXPECT_TRUE(times->get("enabled")->boolValue());
+    EXPECT_EQ(1, times->get("packets")->intValue());
+    data::ConstElementPtr stages = times->get("stages");
+    ASSERT_EQ(PacketTiming::STAGE_COUNT + 1, stages->size());
+    data::ConstElementPtr hooks = stages->get(PacketTiming::HOOKS);
+    EXPECT_EQ("hooks", hooks->get("stage")->stringValue());
+    EXPECT_LE(3000, hooks->get("total-time")->intValue());
+    ASSERT_EQ(1, hooks->get("histogram")->size());
+    EXPECT_EQ(1, hooks->get("histogram")->get(0)->get(1)->intValue());
+
+    timing.clear();
+    EXPECT_EQ(0, timing.getCount());
+    EXPECT_EQ(0, timing.getTotalTime(PacketTiming::STAGE_COUNT));
+    EXPECT_EQ(0, countValues(timing.getHistogram(PacketTiming::HOOKS)));
+
+    EXPECT_STREQ("hooks", PacketTiming::getStageName(PacketTiming::HOOKS));
+    EXPECT_STREQ("total",
+                 PacketTiming::getStageName(PacketTiming::STAGE_COUNT));
+}
+
+// This test checks that the packets slower than the threshold are written
+// to the trace file.
+TEST(PacketTimingTest, trace) {
+    const std::string file = "packet_timing_trace.bin";
+    PacketTiming timing;
+    timing.setEnabled(true);
+    EXPECT_THROW(timing.openTrace("/no/such/dir/trace.bin", 0), BadValue);
+    ASSERT_NO_THROW(timing.openTrace(file, 1000));
+    EXPECT_EQ(file, timing.getTraceFile());
+    EXPECT_EQ(1000, timing.getTraceThreshold());
+
+    // The fast packet is not written.
+    timing.start(microsec_clock::universal_time());
+    timing.finish(1);
+    timing.start(microsec_clock::universal_time() - milliseconds(2));
+    timing.finish(3);
+    timing.closeTrace();
+    EXPECT_TRUE(timing.getTraceFile().empty());
+
+    FILE* trace = fopen(file.c_str(), "rb");
+    ASSERT_TRUE(trace != NULL);
+    char magic[4];
+    uint32_t stages = 0;
+    uint64_t received = 0;
+    uint32_t record[PacketTiming::STAGE_COUNT + 2];
+    ASSERT_EQ(4, fread(magic, 1, 4, trace));
+    EXPECT_EQ(0, memcmp(magic, "PKTT", 4));
+    ASSERT_EQ(1, fread(&stages, sizeof(stages), 1, trace));
+    EXPECT_EQ(PacketTiming::STAGE_COUNT, stages);
+    ASSERT_EQ(1, fread(&received, sizeof(received), 1, trace));
+    ASSERT_EQ(1, fread(record, sizeof(record), 1, trace));
+    EXPECT_NE(0, received);
+    EXPECT_EQ(3, record[0]);
+    EXPECT_LE(2000, record[1]);
+    EXPECT_LE(2000, record[2 + PacketTiming::RECEIVE]);
+    EXPECT_EQ(0, fread(record, sizeof(record), 1, trace));
+    fclose(trace);
+    unlink(file.c_str());
+}
+
+} // end of anonymous namespace
@@ -0,0 +1,272 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <dhcp/dhcp4.h>
+#include <dhcp/dhcp6.h>
+#include <dhcp/pkt4.h>
+#include <dhcp/pkt6.h>
+#include <dhcpsrv/receive_queue.h>
+
+#include <gtest/gtest.h>
+
+using namespace bundy;
+using namespace bundy::data;
+using namespace bundy::dhcp;
+
+namespace {
+
+/// @brief Test fixture class for the queue of the received queries.
+class ReceiveQueueTest : public ::testing::Test {
+public:
+    /// @brief Constructor.
+    ReceiveQueueTest() : queue4_(Option::V4), queue6_(Option::V6) {
+    }
+
+    /// @brief Creates a received DHCPv4 query.
+    ///
+    /// @param type the message type.
+    /// @param client the last byte of the hardware address of the client.
+    /// @param transid the transaction id.
+    /// @return the query in wire format, not unpacked.
+    Pkt4Ptr createQuery4(const uint8_t type, const uint8_t client,
+                         const uint32_t transid = 1234) {
+        Pkt4 pkt(type, transid);
+        std::vector<uint8_t> hwaddr(6, 0x10);
+        hwaddr[5] = client;
+        pkt.setHWAddr(HTYPE_ETHER, hwaddr.size(), hwaddr);
+        pkt.pack();
+        const util::OutputBuffer& buf = pkt.getBuffer();
+        return (Pkt4Ptr(new Pkt4(static_cast<const uint8_t*>(buf.getData()),
+                                 buf.getLength())));
+    }
+
+    /// @brief Creates a received DHCPv6 query.
+    ///
+    /// @param type the message type.
+    /// @param client the last byte of the client identifier.
+    /// @param relays the number of relays the query went through.
+    /// @return the query in wire format, not unpacked.
+    Pkt6Ptr createQuery6(const uint8_t type, const uint8_t client,
+                         const int relays = 0) {
+        std::vector<uint8_t> data;
+        data.push_back(type);
+        data.push_back(0x12);
+        data.push_back(0x34);
+        data.push_back(0x56);
+        // An elapsed time option before the client identifier.
+        const uint8_t elapsed[] = { 0, D6O_ELAPSED_TIME, 0, 2, 0, 0 };
+        data.insert(data.end(), elapsed, elapsed + sizeof(elapsed));
+        const uint8_t clientid[] = { 0, D6O_CLIENTID, 0, 4, 0, 3, 0, client };
+        data.insert(data.end(), clientid, clientid + sizeof(clientid));
+        for (int i = 0; i < relays; ++i) {
+            std::vector<uint8_t> relay(Pkt6::DHCPV6_RELAY_HDR_LEN, 0);
+            relay[0] = DHCPV6_RELAY_FORW;
+            relay[1] = i;
+            // An interface id option before the relayed message.
+            const uint8_t ifaceid[] = { 0, D6O_INTERFACE_ID, 0, 1, 7 };
+            relay.insert(relay.end(), ifaceid, ifaceid + sizeof(ifaceid));
+            relay.push_back(0);
+            relay.push_back(D6O_RELAY_MSG);
+            relay.push_back(data.size() >> 8);
+            relay.push_back(data.size() & 0xff);
+            relay.insert(relay.end(), data.begin(), data.end());
+            data.swap(relay);
+        }
+        return (Pkt6Ptr(new Pkt6(&data[0], data.size())));
+    }
+
+    ReceiveQueue<Pkt4Ptr> queue4_;
+    ReceiveQueue<Pkt6Ptr> queue6_;
+};
+
+// This test checks that the message type and the client are read from a
+// DHCPv4 query.
+TEST_F(ReceiveQueueTest, peek4) {
+    uint8_t type = 0;
+    uint32_t client1 = 0;
+    Pkt4Ptr query = createQuery4(DHCPREQUEST, 1);
+    ASSERT_TRUE(ReceiveQueueBase::peek4(&query->data_[0], query->data_.size(),
+                                        type, client1));
+    EXPECT_EQ(DHCPREQUEST, type);
+    EXPECT_NE(0, client1);
+
+    // The same client is found in its other queries, not in the ones of
+    // another client.
+    uint32_t client2 = 0;
+    query = createQuery4(DHCPDISCOVER, 1, 5678);
+    ASSERT_TRUE(ReceiveQueueBase::peek4(&query->data_[0], query->data_.size(),
+                                        type, client2));
+    EXPECT_EQ(DHCPDISCOVER, type);
+    EXPECT_EQ(client1, client2);
+    query = createQuery4(DHCPDISCOVER, 2);
+    ASSERT_TRUE(ReceiveQueueBase::peek4(&query->data_[0], query->data_.size(),
+                                        type, client2));
+    EXPECT_NE(client1, client2);
+
+    // A truncated query and a query without the magic cookie are rejected.
+    EXPECT_FALSE(ReceiveQueueBase::peek4(&query->data_[0],
+                                         Pkt4::DHCPV4_PKT_HDR_LEN, type,
+                                         client2));
+    query->data_[Pkt4::DHCPV4_PKT_HDR_LEN] = 0;
+    EXPECT_FALSE(ReceiveQueueBase::peek4(&query->data_[0],
+                                         query->data_.size(), type, client2));
+}
+
+// This test checks that the message type and the client are read from a
+// DHCPv6 query, through its relays.
+TEST_F(ReceiveQueueTest, peek6) {
+    uint8_t type = 0;
+    uint32_t client1 = 0;
+    Pkt6Ptr query = createQuery6(DHCPV6_RENEW, 1);
+    ASSERT_TRUE(ReceiveQueueBase::peek6(&query->data_[0], query->data_.size(),
+                                        type, client1));
+    EXPECT_EQ(DHCPV6_RENEW, type);
+    EXPECT_NE(0, client1);
+
+    uint32_t client2 = 0;
+    query = createQuery6(DHCPV6_SOLICIT, 1, 2);
+    ASSERT_TRUE(ReceiveQueueBase::peek6(&query->data_[0], query->data_.size(),
+                                        type, client2));
+    EXPECT_EQ(DHCPV6_SOLICIT, type);
+    EXPECT_EQ(client1, client2);
+
+    query = createQuery6(DHCPV6_SOLICIT, 2, 1);
+    ASSERT_TRUE(ReceiveQueueBase::peek6(&query->data_[0], query->data_.size(),
+                                        type, client2));
+    EXPECT_NE(client1, client2);
+
+    // A relayed query which is truncated is rejected.
+    EXPECT_FALSE(ReceiveQueueBase::peek6(&query->data_[0],
+                                         query->data_.size() - 10, type,
+                                         client2));
+}
+
+// This test checks that the queries of the existing clients are processed
+// before the new clients.
+TEST_F(ReceiveQueueTest, priority) {
+    queue4_.setLimits(10, 0);
+    ASSERT_TRUE(queue4_.isEnabled());
+    Pkt4Ptr discover1 = createQuery4(DHCPDISCOVER, 1);
+    Pkt4Ptr discover2 = createQuery4(DHCPDISCOVER, 2);
+    Pkt4Ptr request = createQuery4(DHCPREQUEST, 3);
+    Pkt4Ptr release = createQuery4(DHCPRELEASE, 4);
+    EXPECT_TRUE(queue4_.push(discover1));
+    EXPECT_TRUE(queue4_.push(request));
+    EXPECT_TRUE(queue4_.push(discover2));
+    EXPECT_TRUE(queue4_.push(release));
+    EXPECT_EQ(4, queue4_.size());
+    EXPECT_EQ(2, queue4_.size(ReceiveQueueBase::HIGH));
+    EXPECT_EQ(2, queue4_.size(ReceiveQueueBase::LOW));
+
+    EXPECT_TRUE(queue4_.pop() == request);
+    EXPECT_TRUE(queue4_.pop() == release);
+    EXPECT_TRUE(queue4_.pop() == discover1);
+    EXPECT_TRUE(queue4_.pop() == discover2);
+    EXPECT_FALSE(queue4_.pop());
+    EXPECT_EQ(0, queue4_.size());
+    EXPECT_EQ(4, queue4_.getReceivedCount());
+}
+
+// This test checks that a query which can't be classified has the low
+// priority.
+TEST_F(ReceiveQueueTest, malformed) {
+    queue6_.setLimits(10, 0);
+    Pkt6Ptr garbage(new Pkt6(static_cast<const uint8_t*>(NULL), 0));
+    Pkt6Ptr renew = createQuery6(DHCPV6_RENEW, 1, 1);
+    EXPECT_TRUE(queue6_.push(garbage));
+    EXPECT_TRUE(queue6_.push(renew));
+    EXPECT_TRUE(queue6_.pop() == renew);
+    EXPECT_TRUE(queue6_.pop() == garbage);
+}
+
+// This test checks that the oldest query is dropped when its class is full.
+TEST_F(ReceiveQueueTest, limit) {
+    queue4_.setLimits(2, 0);
+    Pkt4Ptr request1 = createQuery4(DHCPREQUEST, 1);
+    Pkt4Ptr request2 = createQuery4(DHCPREQUEST, 2);
+    Pkt4Ptr request3 = createQuery4(DHCPREQUEST, 3);
+    EXPECT_TRUE(queue4_.push(request1));
+    EXPECT_TRUE(queue4_.push(request2));
+    EXPECT_TRUE(queue4_.push(request3));
+    EXPECT_EQ(2, queue4_.size());
+    EXPECT_EQ(1, queue4_.getShedCount(DHCPREQUEST));
+
+    // The other class is not affected.
+    EXPECT_TRUE(queue4_.push(createQuery4(DHCPDISCOVER, 4)));
+    EXPECT_EQ(3, queue4_.size());
+    EXPECT_TRUE(queue4_.pop() == request2);
+    EXPECT_TRUE(queue4_.pop() == request3);
+}
+
+// This test checks that the low priority queries are dropped when the
+// backlog exceeds the threshold.
+TEST_F(ReceiveQueueTest, shedThreshold) {
+    queue6_.setLimits(10, 3);
+    EXPECT_TRUE(queue6_.push(createQuery6(DHCPV6_SOLICIT, 1)));
+    EXPECT_TRUE(queue6_.push(createQuery6(DHCPV6_RENEW, 2)));
+    EXPECT_TRUE(queue6_.push(createQuery6(DHCPV6_REBIND, 3)));
+    EXPECT_FALSE(queue6_.push(createQuery6(DHCPV6_SOLICIT, 4)));
+    EXPECT_TRUE(queue6_.push(createQuery6(DHCPV6_REQUEST, 5)));
+    EXPECT_EQ(4, queue6_.size());
+    EXPECT_EQ(1, queue6_.getShedCount(DHCPV6_SOLICIT));
+    EXPECT_EQ(0, queue6_.getShedCount(DHCPV6_REQUEST));
+
+    // Once the backlog is back under the threshold, the new clients are
+    // queued again.
+    queue6_.pop();
+    queue6_.pop();
+    EXPECT_TRUE(queue6_.push(createQuery6(DHCPV6_SOLICIT, 4)));
+}
+
+// This test checks that a retransmitted query replaces the one waiting.
+TEST_F(ReceiveQueueTest, retransmission) {
+    queue4_.setLimits(10, 0);
+    Pkt4Ptr discover1 = createQuery4(DHCPDISCOVER, 1, 1);
+    Pkt4Ptr discover2 = createQuery4(DHCPDISCOVER, 2, 2);
+    Pkt4Ptr discover3 = createQuery4(DHCPDISCOVER, 1, 3);
+    EXPECT_TRUE(queue4_.push(discover1));
+    EXPECT_TRUE(queue4_.push(discover2));
+    EXPECT_TRUE(queue4_.push(discover3));
+    EXPECT_EQ(2, queue4_.size());
+    EXPECT_EQ(1, queue4_.getShedCount(DHCPDISCOVER));
+    EXPECT_TRUE(queue4_.pop() == discover2);
+    EXPECT_TRUE(queue4_.pop() == discover3);
+}
+
+// This test checks the statistics returned by the command.
+TEST_F(ReceiveQueueTest, toElement) {
+    EXPECT_FALSE(queue4_.isEnabled());
+    queue4_.setLimits(1, 0);
+    queue4_.push(createQuery4(DHCPDISCOVER, 1));
+    queue4_.push(createQuery4(DHCPDISCOVER, 2));
+    queue4_.push(createQuery4(DHCPREQUEST, 3));
+
+    ConstElementPtr stats = queue4_.toElement();
+    EXPECT_TRUE(stats->get("enabled")->boolValue());
+    EXPECT_EQ(1, stats->get("queue-limit")->intValue());
+    EXPECT_EQ(0, stats->get("shed-threshold")->intValue());
+    EXPECT_EQ(3, stats->get("received")->intValue());
+    EXPECT_EQ(1, stats->get("high-priority")->intValue());
+    EXPECT_EQ(1, stats->get("low-priority")->intValue());
+    EXPECT_EQ("{ \"DHCPDISCOVER\": 1 }", stats->get("shed")->str());
+
+    queue4_.clearStatistics();
+    stats = queue4_.toElement();
+    EXPECT_EQ(0, stats->get("received")->intValue());
+    EXPECT_TRUE(stats->get("shed")->mapValue().empty());
+}
+
+}
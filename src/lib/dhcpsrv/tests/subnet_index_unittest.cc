@@ -0,0 +1,171 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <asiolink/io_address.h>
+#include <dhcp/dhcp6.h>
+#include <dhcp/option.h>
+#include <dhcpsrv/subnet.h>
+#include <dhcpsrv/subnet_index.h>
+
+#include <gtest/gtest.h>
+
+using namespace bundy;
+using namespace bundy::dhcp;
+using namespace bundy::asiolink;
+
+namespace {
+
+/// @brief Returns the positions found in the index for an address.
+template<typename SubnetCollectionType>
+std::vector<size_t>
+findPositions(const SubnetIndex<SubnetCollectionType>& index,
+              const std::string& addr, const bool relay = false) {
+    std::vector<size_t> positions;
+    index.find(IOAddress(addr), relay, positions);
+    return (positions);
+}
+
+// Checks that IPv4 addresses are mapped to all subnets containing them, in
+// the order of the subnets.
+TEST(SubnetIndexTest, prefixes4) {
+    Subnet4Collection subnets;
+    subnets.push_back(Subnet4Ptr(new Subnet4(IOAddress("192.0.2.64"), 26,
+                                             1, 2, 3)));
+    subnets.push_back(Subnet4Ptr(new Subnet4(IOAddress("192.0.2.0"), 24,
+                                             1, 2, 3)));
+    subnets.push_back(Subnet4Ptr(new Subnet4(IOAddress("192.0.3.0"), 24,
+                                             1, 2, 3)));
+    // The prefix is not required to be the first address of the subnet.
+    subnets.push_back(Subnet4Ptr(new Subnet4(IOAddress("192.0.2.77"), 28,
+                                             1, 2, 3)));
+
+    SubnetIndex<Subnet4Collection> index;
+    EXPECT_FALSE(index.isCurrent());
+    index.build(subnets);
+    EXPECT_TRUE(index.isCurrent());
+
+    std::vector<size_t> positions = findPositions(index, "192.0.2.1");
+    ASSERT_EQ(1, positions.size());
+    EXPECT_EQ(1, positions[0]);
+
+    positions = findPositions(index, "192.0.2.79");
+    ASSERT_EQ(3, positions.size());
+    EXPECT_EQ(0, positions[0]);
+    EXPECT_EQ(1, positions[1]);
+    EXPECT_EQ(3, positions[2]);
+
+    positions = findPositions(index, "192.0.3.255");
+    ASSERT_EQ(1, positions.size());
+    EXPECT_EQ(2, positions[0]);
+
+    EXPECT_TRUE(findPositions(index, "192.0.4.0").empty());
+    EXPECT_TRUE(findPositions(index, "2001:db8::1").empty());
+
+    index.invalidate();
+    EXPECT_FALSE(index.isCurrent());
+}
+
+// Checks that IPv6 addresses are mapped to the subnets containing them.
+TEST(SubnetIndexTest, prefixes6) {
+    Subnet6Collection subnets;
+    subnets.push_back(Subnet6Ptr(new Subnet6(IOAddress("2001:db8:1::"), 48,
+                                             1, 2, 3, 4)));
+    subnets.push_back(Subnet6Ptr(new Subnet6(IOAddress("2001:db8:1:2::"), 64,
+                                             1, 2, 3, 4)));
+
+    SubnetIndex<Subnet6Collection> index;
+    index.build(subnets);
+
+    std::vector<size_t> positions = findPositions(index, "2001:db8:1:2::5");
+    ASSERT_EQ(2, positions.size());
+    EXPECT_EQ(0, positions[0]);
+    EXPECT_EQ(1, positions[1]);
+
+    positions = findPositions(index, "2001:db8:1:3::5");
+    ASSERT_EQ(1, positions.size());
+    EXPECT_EQ(0, positions[0]);
+
+    EXPECT_TRUE(findPositions(index, "2001:db8:2::1").empty());
+    EXPECT_TRUE(findPositions(index, "192.0.2.1").empty());
+}
+
+// Checks that relay addresses are only matched when requested and that
+// changing the relay address makes the index out of date.
+TEST(SubnetIndexTest, relay) {
+    Subnet4Collection subnets;
+    subnets.push_back(Subnet4Ptr(new Subnet4(IOAddress("192.0.2.0"), 24,
+                                             1, 2, 3)));
+    subnets.push_back(Subnet4Ptr(new Subnet4(IOAddress("192.0.3.0"), 24,
+                                             1, 2, 3)));
+    subnets[1]->setRelayInfo(IOAddress("192.0.2.1"));
+
+    SubnetIndex<Subnet4Collection> index;
+    index.build(subnets);
+
+    EXPECT_EQ(1, findPositions(index, "192.0.2.1").size());
+    std::vector<size_t> positions = findPositions(index, "192.0.2.1", true);
+    ASSERT_EQ(2, positions.size());
+    EXPECT_EQ(0, positions[0]);
+    EXPECT_EQ(1, positions[1]);
+
+    subnets[1]->setRelayInfo(IOAddress("10.0.0.1"));
+    EXPECT_FALSE(index.isCurrent());
+    index.build(subnets);
+    EXPECT_TRUE(index.isCurrent());
+    EXPECT_EQ(1, findPositions(index, "192.0.2.1", true).size());
+    positions = findPositions(index, "10.0.0.1", true);
+    ASSERT_EQ(1, positions.size());
+    EXPECT_EQ(1, positions[0]);
+}
+
+// Checks the lookup of subnets by interface name and interface-id.
+TEST(SubnetIndexTest, ifaces) {
+    Subnet6Collection subnets;
+    for (int i = 0; i < 3; ++i) {
+        subnets.push_back(Subnet6Ptr(new Subnet6(IOAddress("2001:db8::"),
+                                                 48 + i, 1, 2, 3, 4)));
+    }
+    subnets[0]->setIface("eth0");
+    subnets[2]->setIface("eth0");
+    OptionBuffer data(4, 1);
+    OptionPtr ifaceid(new Option(Option::V6, D6O_INTERFACE_ID, data));
+    subnets[1]->setInterfaceId(ifaceid);
+
+    SubnetIndex<Subnet6Collection> index;
+    index.build(subnets);
+
+    const SubnetIndex<Subnet6Collection>::Positions* positions =
+        index.findIface("eth0");
+    ASSERT_TRUE(positions);
+    ASSERT_EQ(2, positions->size());
+    EXPECT_EQ(0, (*positions)[0]);
+    EXPECT_EQ(2, (*positions)[1]);
+    EXPECT_FALSE(index.findIface("eth1"));
+
+    // An equal option is found, and one with different data is not.
+    positions = index.findInterfaceId(OptionPtr(new Option(Option::V6,
+                                                           D6O_INTERFACE_ID,
+                                                           data)));
+    ASSERT_TRUE(positions);
+    ASSERT_EQ(1, positions->size());
+    EXPECT_EQ(1, (*positions)[0]);
+    data[0] = 2;
+    EXPECT_FALSE(index.findInterfaceId(OptionPtr(new Option(Option::V6,
+                                                            D6O_INTERFACE_ID,
+                                                            data))));
+}
+
+} // end of anonymous namespace
@@ -840,6 +840,59 @@ TEST(Subnet6Test, getOptionDescriptor) {
     }
 }
 
+// This test verifies that the options configured for a list of
+// requested option codes are returned, and that the returned lists
+// are remembered until the options of the subnet change.
+TEST(Subnet6Test, getRequestedOptions) {
+    Subnet6Ptr subnet(new Subnet6(IOAddress("2001:db8::"), 56, 1, 2, 3, 4));
+
+    // Add 5 options to a "dhcp6" option space in the subnet.
+    for (uint16_t code = 100; code < 105; ++code) {
+        OptionPtr option(new Option(Option::V6, code, OptionBuffer(10, 0xFF)));
+        ASSERT_NO_THROW(subnet->addOption(option, false, "dhcp6"));
+    }
+
+    // Request some of the configured options, in a different order,
+    // and some which are not configured.
+    std::vector<uint16_t> codes;
+    codes.push_back(103);
+    codes.push_back(200);
+    codes.push_back(100);
+    codes.push_back(104);
+
+    Subnet::OptionListPtr options = subnet->getRequestedOptions("dhcp6", codes);
+    ASSERT_TRUE(options);
+    // Only the configured options should be returned, in the order
+    // in which they have been requested.
+    ASSERT_EQ(3, options->size());
+    EXPECT_EQ(103, (*options)[0]->getType());
+    EXPECT_EQ(100, (*options)[1]->getType());
+    EXPECT_EQ(104, (*options)[2]->getType());
+
+    // Nothing should be returned for the other option spaces.
+    Subnet::OptionListPtr other = subnet->getRequestedOptions("bundy", codes);
+    ASSERT_TRUE(other);
+    EXPECT_TRUE(other->empty());
+
+    // The same list of codes should give the same list of options.
+    EXPECT_TRUE(options == subnet->getRequestedOptions("dhcp6", codes));
+
+    // Adding an option must cause the list to be looked up again.
+    OptionPtr option(new Option(Option::V6, 200, OptionBuffer(10, 0xFF)));
+    ASSERT_NO_THROW(subnet->addOption(option, false, "dhcp6"));
+    Subnet::OptionListPtr added = subnet->getRequestedOptions("dhcp6", codes);
+    ASSERT_TRUE(added);
+    ASSERT_EQ(4, added->size());
+    EXPECT_EQ(200, (*added)[1]->getType());
+    // The list returned earlier must not have been modified.
+    EXPECT_EQ(3, options->size());
+
+    // The same applies when the options are deleted.
+    subnet->delOptions();
+    Subnet::OptionListPtr deleted = subnet->getRequestedOptions("dhcp6", codes);
+    ASSERT_TRUE(deleted);
+    EXPECT_TRUE(deleted->empty());
+}
 
 TEST(Subnet6Test, addVendorOptions) {
 
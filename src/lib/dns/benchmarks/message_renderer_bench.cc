@@ -19,6 +19,8 @@
 #include <dns/messagerenderer.h>
 #include <oldmessagerenderer.h>
 
+#include <boost/lexical_cast.hpp>
+
 #include <cassert>
 #include <vector>
 
@@ -100,6 +102,13 @@ const char* const example_servfail_names[] = {
     "www.example.com", NULL
 };
 
+// Names contained in a large response, such as a big referral or an ANY
+// response from a large signed zone; it's generated in main() as
+// "nsN.subM.example.com" (N = 0..7, M = 0..49) so that it contains many
+// names sharing some suffixes.
+const size_t LARGE_RESPONSE_SUBZONES = 50;
+const size_t LARGE_RESPONSE_HOSTS = 8;
+
 // An experimental "dumb" renderer for comparison.  It doesn't do any name
 // compression.  It simply ignores all setter method, returns a dummy value
 // for getter methods, and write names to the internal buffer as plain binary
@@ -159,6 +168,21 @@ main(int argc, char* argv[]) {
                                  "(NXDOMAIN response)"));
     spec_list.push_back(DataSpec(example_servfail_names,
                                  "(SERVFAIL response)"));
+    vector<string> large_names_txt;
+    for (size_t i = 0; i < LARGE_RESPONSE_SUBZONES; ++i) {
+        for (size_t j = 0; j < LARGE_RESPONSE_HOSTS; ++j) {
+            large_names_txt.push_back(
+                "ns" + boost::lexical_cast<string>(j) + ".sub" +
+                boost::lexical_cast<string>(i) + ".example.com");
+        }
+    }
+    vector<const char*> large_names;
+    for (size_t i = 0; i < large_names_txt.size(); ++i) {
+        large_names.push_back(large_names_txt[i].c_str());
+    }
+    large_names.push_back(NULL);
+    spec_list.push_back(DataSpec(&large_names[0], "(large response)"));
+
     for (vector<DataSpec>::const_iterator it = spec_list.begin();
          it != spec_list.end();
          ++it) {
@@ -0,0 +1,198 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+#include <bench/benchmark.h>
+
+#include <dns/name.h>
+#include <dns/labelsequence.h>
+#include <dns/name_internal.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace std;
+using namespace bundy::bench;
+using namespace bundy::dns;
+
+namespace {
+// Each benchmark compares every name of the first set with the
+// corresponding one of the second set (which consists of the same names,
+// but possibly with different cases).
+
+// LabelSequence::compare(), i.e., the comparison used in DomainTree.
+class CompareBenchMark {
+public:
+    CompareBenchMark(const vector<Name>& names1, const vector<Name>& names2) :
+        names1_(names1), names2_(names2)
+    {}
+    unsigned int run() {
+        for (size_t i = 0; i < names1_.size(); ++i) {
+            const LabelSequence ls1(names1_[i]);
+            const LabelSequence ls2(names2_[i]);
+            if (ls1.compare(ls2).getRelation() !=
+                NameComparisonResult::EQUAL) {
+                assert(false);
+            }
+        }
+        return (names1_.size());
+    }
+private:
+    const vector<Name>& names1_;
+    const vector<Name>& names2_;
+};
+
+// LabelSequence::equals(), i.e., the comparison used in the compression
+// of MessageRenderer and in hash based lookups.
+class EqualsBenchMark {
+public:
+    EqualsBenchMark(const vector<Name>& names1, const vector<Name>& names2) :
+        names1_(names1), names2_(names2)
+    {}
+    unsigned int run() {
+        for (size_t i = 0; i < names1_.size(); ++i) {
+            if (!LabelSequence(names1_[i]).equals(
+                    LabelSequence(names2_[i]))) {
+                assert(false);
+            }
+        }
+        return (names1_.size());
+    }
+private:
+    const vector<Name>& names1_;
+    const vector<Name>& names2_;
+};
+
+// The same as EqualsBenchMark, but with the naive byte-by-byte loop
+// for comparison.
+class NaiveEqualsBenchMark {
+public:
+    NaiveEqualsBenchMark(const vector<Name>& names1,
+                         const vector<Name>& names2) :
+        names1_(names1), names2_(names2)
+    {}
+    unsigned int run() {
+        using bundy::dns::name::internal::maptolower;
+        for (size_t i = 0; i < names1_.size(); ++i) {
+            size_t len1, len2;
+            const uint8_t* data1 = LabelSequence(names1_[i]).getData(&len1);
+            const uint8_t* data2 = LabelSequence(names2_[i]).getData(&len2);
+            bool equal = (len1 == len2);
+            for (size_t j = 0; equal && j < len1; ++j) {
+                equal = (maptolower[data1[j]] == maptolower[data2[j]]);
+            }
+            if (!equal) {
+                assert(false);
+            }
+        }
+        return (names1_.size());
+    }
+private:
+    const vector<Name>& names1_;
+    const vector<Name>& names2_;
+};
+
+// Typical short names.
+const char* const short_names[] = {
+    "www.example.com", "mail.example.com", "ns1.example.net",
+    "a.gtld-servers.net", "b.root-servers.net", "example.org",
+    "host-192-0-2-1.dynamic.example.jp", "_sip._udp.example.com",
+    NULL
+};
+
+// Names with long labels, such as NSEC3 owner names in signed zones and
+// generated host names.
+const char* const long_names[] = {
+    "2vptu5timamqttgl4luu9kg21e0aor3s.example.com",
+    "35mthgpgcu1qg68fab165klnsnk3dpvl.example.com",
+    "q04jkcevqvmu85r014c7dkba38o0ji5r.example.com",
+    "r53bq7cc2uvmubfu5ocmm6pers9tk9en.example.com",
+    "t644ebqk9bibcna874givr6joj62mlhv.example.com",
+    "this-is-a-long-label-to-test-vectorized-comparison.example.org",
+    "ec2-192-0-2-1.compute-1.amazonaws-like-provider.example.net",
+    NULL
+};
+
+vector<Name>
+makeNames(const char* const* names, bool upper) {
+    vector<Name> result;
+    for (size_t i = 0; names[i] != NULL; ++i) {
+        string name_txt(names[i]);
+        if (upper) {
+            transform(name_txt.begin(), name_txt.end(), name_txt.begin(),
+                      ::toupper);
+        }
+        result.push_back(Name(name_txt));
+    }
+    return (result);
+}
+
+void
+usage() {
+    cerr << "Usage: name_compare_bench [-n iterations]" << endl;
+    exit (1);
+}
+}
+
+int
+main(int argc, char* argv[]) {
+    int ch;
+    int iteration = 1000000;
+    while ((ch = getopt(argc, argv, "n:")) != -1) {
+        switch (ch) {
+        case 'n':
+            iteration = atoi(optarg);
+            break;
+        case '?':
+        default:
+            usage();
+        }
+    }
+    argc -= optind;
+    if (argc != 0) {
+        usage();
+    }
+
+    cout << "Parameters:" << endl;
+    cout << "  Iterations: " << iteration << endl;
+
+    typedef pair<const char* const*, string> DataSpec;
+    vector<DataSpec> spec_list;
+    spec_list.push_back(DataSpec(short_names, "(short names)"));
+    spec_list.push_back(DataSpec(long_names, "(long labels)"));
+    for (vector<DataSpec>::const_iterator it = spec_list.begin();
+         it != spec_list.end();
+         ++it) {
+        const vector<Name> names = makeNames(it->first, false);
+        const vector<Name> upper_names = makeNames(it->first, true);
+
+        cout << "Benchmark for LabelSequence::compare " << it->second << endl;
+        BenchMark<CompareBenchMark>(iteration,
+                                    CompareBenchMark(names, upper_names));
+
+        cout << "Benchmark for naive equals " << it->second << endl;
+        BenchMark<NaiveEqualsBenchMark>(
+            iteration, NaiveEqualsBenchMark(names, upper_names));
+
+        cout << "Benchmark for LabelSequence::equals " << it->second << endl;
+        BenchMark<EqualsBenchMark>(iteration,
+                                   EqualsBenchMark(names, upper_names));
+    }
+
+    return (0);
+}
@@ -85,6 +85,21 @@ LabelSequence::LabelSequence(const LabelSequence& src,
     offsets_ = &buf[Name::MAX_WIRE];
 }
 
+LabelSequence::LabelSequence(const char* name_data, size_t data_len,
+                             uint8_t buf[MAX_SERIALIZED_LENGTH],
+                             bool downcase)
+{
+    size_t data_len_parsed;
+    size_t label_count;
+    name::internal::parseText(name_data, name_data + data_len, downcase,
+                              buf, &buf[Name::MAX_WIRE], data_len_parsed,
+                              label_count);
+
+    first_label_ = 0;
+    last_label_ = label_count - 1;
+    data_ = buf;
+    offsets_ = &buf[Name::MAX_WIRE];
+}
 
 const uint8_t*
 LabelSequence::getData(size_t *len) const {
@@ -161,15 +176,8 @@ LabelSequence::equals(const LabelSequence& other, bool case_sensitive) const {
     // As long as the data was originally validated as (part of) a name,
     // label length must never be a capital ascii character, so we can
     // simply compare them after converting to lower characters.
-    for (size_t i = 0; i < len; ++i) {
-        const uint8_t ch = data[i];
-        const uint8_t other_ch = other_data[i];
-        if (bundy::dns::name::internal::maptolower[ch] !=
-            bundy::dns::name::internal::maptolower[other_ch]) {
-            return (false);
-        }
-    }
-    return (true);
+    return (bundy::dns::name::internal::compareLabelData(data, other_data,
+                                                         len, false) == 0);
 }
 
 NameComparisonResult
@@ -202,29 +210,13 @@ LabelSequence::compare(const LabelSequence& other,
         const int cdiff = static_cast<int>(count1) - static_cast<int>(count2);
         unsigned int count = (cdiff < 0) ? count1 : count2;
 
-        while (count > 0) {
-            const uint8_t label1 = data_[pos1];
-            const uint8_t label2 = other.data_[pos2];
-            int chdiff;
-
-            if (case_sensitive) {
-                chdiff = static_cast<int>(label1) - static_cast<int>(label2);
-            } else {
-                chdiff = static_cast<int>(
-                    bundy::dns::name::internal::maptolower[label1]) -
-                    static_cast<int>(
-                        bundy::dns::name::internal::maptolower[label2]);
-            }
-
-            if (chdiff != 0) {
-                return (NameComparisonResult(
-                            chdiff, nlabels,
-                            nlabels == 0 ? NameComparisonResult::NONE :
-                            NameComparisonResult::COMMONANCESTOR));
-            }
-            --count;
-            ++pos1;
-            ++pos2;
+        const int chdiff = bundy::dns::name::internal::compareLabelData(
+            &data_[pos1], &other.data_[pos2], count, case_sensitive);
+        if (chdiff != 0) {
+            return (NameComparisonResult(
+                        chdiff, nlabels,
+                        nlabels == 0 ? NameComparisonResult::NONE :
+                        NameComparisonResult::COMMONANCESTOR));
         }
         if (cdiff != 0) {
             return (NameComparisonResult(
@@ -43,6 +43,8 @@ namespace dns {
 class LabelSequence {
     // Name calls the private toText(bool) method of LabelSequence.
     friend std::string Name::toText(bool) const;
+    // QueryParser constructs a LabelSequence directly from the query data.
+    friend class QueryParser;
 
 public:
     /// \brief Max possible size of serialized image generated by \c serialize
@@ -70,8 +72,8 @@ public:
     ///
     /// \param name The Name to construct a LabelSequence for
     explicit LabelSequence(const Name& name):
-        data_(&name.ndata_[0]),
-        offsets_(&name.offsets_[0]),
+        data_(name.storage_),
+        offsets_(name.getOffsets()),
         first_label_(0),
         last_label_(name.getLabelCount() - 1)
     {}
@@ -121,6 +123,27 @@ public:
     /// \param buf external buffer to store this labelsequence's data in
     LabelSequence(const LabelSequence& src, uint8_t buf[MAX_SERIALIZED_LENGTH]);
 
+    /// \brief Construct 'extendable' LabelSequence from a textual name
+    ///
+    /// This is similar to the previous constructor, but the data placed
+    /// into the buffer are parsed from the given text of a name, in the
+    /// same way as the \c Name constructor from a string.  It's faster
+    /// than constructing a \c Name and a \c LabelSequence for it, as it
+    /// doesn't involve any memory allocation.  The text is always considered
+    /// an absolute name, and the resulting LabelSequence is absolute.
+    ///
+    /// The same notes as the previous constructor apply to \c buf.
+    ///
+    /// \throw NameParserException or its descendants The text is not a
+    /// valid name.
+    ///
+    /// \param name_data The textual name.
+    /// \param data_len The length of \c name_data.
+    /// \param buf external buffer to store this labelsequence's data in
+    /// \param downcase Whether to convert upper case letters to lower case.
+    LabelSequence(const char* name_data, size_t data_len,
+                  uint8_t buf[MAX_SERIALIZED_LENGTH], bool downcase = false);
+
     /// \brief Copy constructor.
     ///
     /// \note The associated data MUST remain in scope during the lifetime
@@ -433,6 +456,14 @@ public:
     bool isAbsolute() const;
 
 private:
+    // Constructor from wire-format name data and its label offsets.  No
+    // validation is done; the caller must ensure they are consistent.
+    LabelSequence(const uint8_t* data, const uint8_t* offsets,
+                  size_t label_count) :
+        data_(data), offsets_(offsets), first_label_(0),
+        last_label_(label_count - 1)
+    {}
+
     const uint8_t* data_;       // wire-format name data
     const uint8_t* offsets_;    // an array of offsets in data_ for the labels
     size_t first_label_;        // index of offsets_ for the first label
@@ -63,6 +63,12 @@ struct MasterLexer::MasterLexerImpl {
         separators_.set('"');
         esc_separators_.set('\r');
         esc_separators_.set('\n');
+        string_stops_ = separators_;
+        string_stops_.set(';');
+        string_stops_.set('\\');
+        qstring_stops_.set('"');
+        qstring_stops_.set('\\');
+        qstring_stops_.set('\n');
     }
 
     // A helper method to skip possible comments toward the end of EOL or EOF.
@@ -127,6 +133,12 @@ struct MasterLexer::MasterLexerImpl {
     std::bitset<128> separators_;
     std::bitset<128> esc_separators_;
 
+    // Characters that need to be examined one by one in the (unescaped)
+    // string and quoted string states.  Others can be taken at once by
+    // InputSource::getRun().
+    std::bitset<128> string_stops_;
+    std::bitset<128> qstring_stops_;
+
     // These are to allow restoring state before previous token.
     bool has_previous_;
     size_t previous_paren_count_;
@@ -519,6 +531,13 @@ String::handle(MasterLexer& lexer) const {
 
     bool escaped = false;
     while (true) {
+        if (!escaped) {
+            // Take ordinary characters at once, if possible.
+            const char* run;
+            const size_t run_len = getLexerImpl(lexer)->source_->getRun(
+                getLexerImpl(lexer)->string_stops_, &run);
+            data.insert(data.end(), run, run + run_len);
+        }
         const int c = getLexerImpl(lexer)->skipComment(
             getLexerImpl(lexer)->source_->getChar(), escaped);
 
@@ -544,6 +563,13 @@ QString::handle(MasterLexer& lexer) const {
 
     bool escaped = false;
     while (true) {
+        if (!escaped) {
+            // Take ordinary characters at once, if possible.
+            const char* run;
+            const size_t run_len = getLexerImpl(lexer)->source_->getRun(
+                getLexerImpl(lexer)->qstring_stops_, &run);
+            data.insert(data.end(), run, run + run_len);
+        }
         const int c = getLexerImpl(lexer)->source_->getChar();
         if (c == InputSource::END_OF_STREAM) {
             token = MasterToken(MasterToken::UNEXPECTED_END);
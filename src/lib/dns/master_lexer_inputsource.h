@@ -19,6 +19,7 @@
 
 #include <boost/noncopyable.hpp>
 
+#include <bitset>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -73,6 +74,11 @@ public:
     /// \brief Constructor which takes a filename to read from. The
     /// associated file stream is managed internally.
     ///
+    /// If the file is a (non empty) regular file, it's mapped in memory
+    /// and the characters are retrieved from there, rather than via the
+    /// stream.  The caller must ensure the file is not modified while it's
+    /// read (which is generally necessary anyway).
+    ///
     /// \throws OpenError when opening the input file fails or the size of
     /// the file cannot be detected.
     explicit InputSource(const char* filename);
@@ -152,6 +158,24 @@ public:
     /// file fails.
     int getChar();
 
+    /// \brief Skips a run of ordinary characters at once.
+    ///
+    /// This is a shortcut of calling \c getChar() repeatedly until it
+    /// returns a character contained in \c stops, a newline, or
+    /// END_OF_STREAM.  The stopping character is not skipped.  Like
+    /// \c MasterLexer, \c stops is examined with the lower 7 bits of each
+    /// character.
+    ///
+    /// This is only effective for a file mapped in memory; for other
+    /// sources it always returns an empty run, and the caller is expected
+    /// to fall back to \c getChar().
+    ///
+    /// \param stops The set of characters to stop at.
+    /// \param run Set to the beginning of the skipped characters, which is
+    /// valid as long as this source exists.
+    /// \return The number of skipped characters.
+    size_t getRun(const std::bitset<128>& stops, const char** run);
+
     /// \brief Skips backward a single character in the input
     /// source. The last-read character is unget.
     ///
@@ -180,6 +204,13 @@ private:
     std::ifstream file_stream_;
     std::istream& input_;
     const size_t input_size_;
+
+    // For a file mapped in memory (the data is NULL otherwise).  The whole
+    // data is the buffer, whose beginning (as adjusted by compact()) is
+    // mapped_begin_.
+    size_t mapped_size_;
+    const char* mapped_data_;
+    size_t mapped_begin_;
 };
 
 } // namespace master_lexer_internal
@@ -14,6 +14,7 @@
 
 #include <dns/master_loader.h>
 #include <dns/master_lexer.h>
+#include <dns/master_lexer_inputsource.h>
 #include <dns/name.h>
 #include <dns/rdataclass.h>
 #include <dns/rrttl.h>
@@ -21,16 +22,23 @@
 #include <dns/rrtype.h>
 #include <dns/rdata.h>
 
+#include <util/threads/sync.h>
+#include <util/threads/thread.h>
+
+#include <boost/bind.hpp>
 #include <boost/format.hpp>
 #include <boost/algorithm/string/predicate.hpp> // for iequals
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 
-#include <string>
+#include <deque>
 #include <memory>
+#include <sstream>
+#include <string>
 #include <vector>
 
 #include <cstdio> // for sscanf()
+#include <unistd.h> // for sysconf()
 
 using std::string;
 using std::unique_ptr;
@@ -38,10 +46,18 @@ using std::vector;
 using std::pair;
 using boost::algorithm::iequals;
 using boost::shared_ptr;
+using bundy::dns::master_lexer_internal::InputSource;
+using bundy::util::thread::CondVar;
+using bundy::util::thread::Mutex;
+using bundy::util::thread::Thread;
 
 namespace bundy {
 namespace dns {
 
+// Explicit definition of class static constant.  The value is given in the
+// declaration so it's not needed here.
+const size_t MasterLoader::DEFAULT_CHUNK_SIZE;
+
 namespace {
 
 // An internal exception, used to control the code flow in case of errors.
@@ -54,6 +70,67 @@ public:
     {}
 };
 
+// Something found in a chunk of the input in the parallel mode.  The
+// events are recorded by the worker thread parsing the chunk, and replayed
+// in order by the thread running the loader.
+struct ChunkEvent {
+    enum Type {
+        ADD_RR,                 // An RR was parsed
+        SET_CURRENT_TTL,        // A TTL field was found
+        SET_DEFAULT_TTL,        // $TTL
+        ERROR,                  // The error callback was called
+        WARNING                 // The warning callback was called
+    };
+
+    ChunkEvent(Type type_param, size_t source_param, size_t line_param) :
+        type(type_param), source(source_param), line(line_param),
+        rrtype(0), explicit_ttl(false), generated(false), ttl(0)
+    {}
+
+    Type type;
+    size_t source;           // Index to Chunk::sources
+    size_t line;             // For ADD_RR, the line of the lexer after
+                             // parsing the RR (for the callbacks we need to
+                             // adjust it the same way the sequential mode
+                             // would do)
+    shared_ptr<Name> name;   // ADD_RR only
+    RRType rrtype;           // ADD_RR only
+    bool explicit_ttl;       // ADD_RR only
+    bool generated;          // ADD_RR only; it comes from $GENERATE
+    RRTTL ttl;               // ADD_RR with explicit_ttl, and the TTL events
+    rdata::RdataPtr rdata;   // ADD_RR only
+    std::string reason;      // ERROR and WARNING only
+};
+
+// A chunk of the top-level input in the parallel mode.  It always begins
+// with an RR having an explicit owner name, and the origin at the beginning
+// is known, so it can be parsed independently from other chunks.
+struct Chunk {
+    Chunk(const std::string& source_name, size_t line_param,
+          const Name& origin_param) :
+        sources(1, source_name), line(line_param), origin(origin_param),
+        end_position(0), done(false), seen_error(false), failed(false),
+        unexpected(false)
+    {}
+
+    std::string data;
+    std::vector<std::string> sources; // The first one is the top-level
+                                      // source, others are $INCLUDEd files
+    const size_t line;                // The line at the beginning of data
+    const Name origin;                // The origin at the beginning of data
+    size_t end_position;              // Position in the top-level source
+                                      // at the end of data
+    std::vector<ChunkEvent> events;
+
+    // Results of the parse, set by the worker.
+    bool done;                  // The parse is complete (guarded by mutex).
+    bool seen_error;
+    bool failed;                // Stopped with MasterLoaderError
+    bool unexpected;            // Stopped with another exception
+    std::string error;          // The text of the exception
+};
+typedef shared_ptr<Chunk> ChunkPtr;
+
 } // end unnamed namespace
 
 /// \brief Private implementation class for the \c MasterLoader
@@ -83,18 +160,28 @@ public:
     ///     the Options values or DEFAULT. If the MANY_ERRORS option is
     ///     included, the parser tries to continue past errors. If it
     ///     is not included, it stops at first encountered error.
+    /// \param chunk If non NULL, the loader parses the chunk on behalf of
+    ///     another loader in the parallel mode.  The found RRs and issues
+    ///     are recorded in the chunk instead of being passed to the
+    ///     callbacks, and the chunk's origin is used as the initial origin.
     /// \throw std::bad_alloc when there's not enough memory.
     MasterLoaderImpl(const char* master_file,
                      const Name& zone_origin,
                      const RRClass& zone_class,
                      const MasterLoaderCallbacks& callbacks,
                      const AddRRCallback& add_callback,
-                     MasterLoader::Options options) :
+                     MasterLoader::Options options,
+                     Chunk* chunk = NULL) :
         lexer_(),
         zone_origin_(zone_origin),
-        active_origin_(zone_origin),
+        active_origin_(chunk != NULL ? chunk->origin : zone_origin),
         zone_class_(zone_class),
-        callbacks_(callbacks),
+        callbacks_(chunk == NULL ? callbacks :
+                   MasterLoaderCallbacks(
+                       boost::bind(&MasterLoaderImpl::recordIssue, this,
+                                   ChunkEvent::ERROR, _1, _2, _3),
+                       boost::bind(&MasterLoaderImpl::recordIssue, this,
+                                   ChunkEvent::WARNING, _1, _2, _3))),
         add_callback_(add_callback),
         options_(options),
         master_file_(master_file),
@@ -102,12 +189,19 @@ public:
         ok_(true),
         many_errors_((options & MANY_ERRORS) != 0),
         previous_name_(false),
+        chunk_(chunk),
+        thread_count_(0),
+        chunk_size_(DEFAULT_CHUNK_SIZE),
+        event_pos_(0),
+        parallel_position_(0),
         complete_(false),
         seen_error_(false),
         warn_rfc1035_ttl_(true),
         rr_count_(0)
     {}
 
+    ~MasterLoaderImpl();
+
     /// \brief Wrapper around \c MasterLexer::pushSource() (file version)
     ///
     /// This method is used as a wrapper around the lexer's
@@ -141,23 +235,25 @@ public:
     /// current origin as it is not used with $INCLUDE processing.
     ///
     /// \param stream The input stream to use as a new source.
-    void pushStreamSource(std::istream& stream) {
-        lexer_.pushSource(stream);
-        initialized_ = true;
-    }
+    void pushStreamSource(std::istream& stream);
 
     /// \brief Implementation of \c MasterLoader::loadIncremental()
     ///
     /// See \c MasterLoader::loadIncremental() for details.
     bool loadIncremental(size_t count_limit);
 
+    /// \brief Implementation of \c MasterLoader::setParallelism()
+    void setParallelism(size_t thread_count, size_t chunk_size);
+
     /// \brief Return the total size of the input sources pushed so
     /// far. See \c MasterLexer::getTotalSourceSize().
-    size_t getSize() const { return (lexer_.getTotalSourceSize()); }
+    size_t getSize() const;
 
     /// \brief Return the line number being parsed in the pushed input
     /// sources. See \c MasterLexer::getPosition().
-    size_t getPosition() const { return (lexer_.getPosition()); }
+    size_t getPosition() const {
+        return (parallel_ ? parallel_position_ : lexer_.getPosition());
+    }
 
 private:
     /// \brief Report an error using the callbacks that were supplied
@@ -202,6 +298,112 @@ private:
         return (true);
     }
 
+    /// \brief Return the number of worker threads in the parallel mode.
+    ///
+    /// Unless specified by \c setParallelism(), it's the number of online
+    /// processors, up to 8.
+    size_t getThreadCount() const {
+        if (thread_count_ != 0) {
+            return (thread_count_);
+        }
+        const long count = sysconf(_SC_NPROCESSORS_ONLN);
+        return (count < 1 ? 1 : (count > 8 ? 8 : count));
+    }
+
+    class ParallelLoader;
+
+    /// \brief Parse a chunk of input in the parallel mode.
+    ///
+    /// This is called in a worker thread.  The results are stored in the
+    /// chunk, so it never throws.
+    static void parseChunk(Chunk& chunk, const Name& zone_origin,
+                           const RRClass& zone_class,
+                           MasterLoader::Options options);
+
+    /// \brief Open the top-level master file in the parallel mode.
+    void openParallelSource();
+
+    /// \brief Implementation of \c loadIncremental() in the parallel mode.
+    bool loadParallelIncremental(size_t count_limit);
+
+    /// \brief Report the events of the current chunk, up to the count
+    /// limit of RRs, returning whether all of them have been reported.
+    bool replayChunk(size_t count_limit, size_t& count);
+
+    /// \brief Determine the TTL of an RR in the parallel mode.
+    ///
+    /// This is the counterpart of \c getCurrentTTL() for RRs recorded in
+    /// a chunk.  Returns false if the RR can't be added.
+    bool getRecordedTTL(const ChunkEvent& event, const std::string& source);
+
+    /// \brief Record an issue reported by the callbacks while parsing a
+    /// chunk.
+    void recordIssue(ChunkEvent::Type type, const std::string& source,
+                     size_t line, const std::string& reason)
+    {
+        chunk_->events.push_back(ChunkEvent(type, 0, line));
+        ChunkEvent& event = chunk_->events.back();
+        mapPosition(source, event);
+        event.reason = reason;
+    }
+
+    /// \brief Record an event other than issues while parsing a chunk.
+    ChunkEvent& recordEvent(ChunkEvent::Type type) {
+        chunk_->events.push_back(ChunkEvent(type, 0,
+                                            lexer_.getSourceLine()));
+        ChunkEvent& event = chunk_->events.back();
+        mapPosition(lexer_.getSourceName(), event);
+        return (event);
+    }
+
+    /// \brief Convert the position in the chunk to the one in the real
+    /// source, so the issues are reported as if the chunk were parsed in
+    /// the top-level source.
+    void mapPosition(const std::string& source, ChunkEvent& event) {
+        if (source == chunk_source_name_) {
+            event.line += chunk_->line - 1;
+            return;
+        }
+        std::vector<std::string>& sources = chunk_->sources;
+        for (size_t i = sources.size(); i > 1; --i) {
+            if (sources[i - 1] == source) {
+                event.source = i - 1;
+                return;
+            }
+        }
+        event.source = sources.size();
+        sources.push_back(source);
+    }
+
+    /// \brief Pass a parsed RR to the add callback (or record it in the
+    /// chunk in the parallel mode).
+    void addRR(const RRType& rrtype, bool explicit_ttl,
+               const rdata::RdataPtr& rdata, bool generated)
+    {
+        if (chunk_ == NULL) {
+            add_callback_(*last_name_, zone_class_, rrtype,
+                          getCurrentTTL(explicit_ttl, rrtype, rdata),
+                          rdata);
+            return;
+        }
+        // The TTL we have just recorded for this RR is carried by the RR
+        // itself.
+        std::vector<ChunkEvent>& events = chunk_->events;
+        if (explicit_ttl && !events.empty() &&
+            events.back().type == ChunkEvent::SET_CURRENT_TTL) {
+            events.pop_back();
+        }
+        ChunkEvent& event = recordEvent(ChunkEvent::ADD_RR);
+        event.name = last_name_;
+        event.rrtype = rrtype;
+        event.explicit_ttl = explicit_ttl;
+        event.generated = generated;
+        if (explicit_ttl) {
+            event.ttl = *current_ttl_;
+        }
+        event.rdata = rdata;
+    }
+
     /// \brief Get a string token. Handle it as error if it is not string.
     const string getString() {
         lexer_.getNextToken(MasterToken::STRING).getString(string_token_);
@@ -379,6 +581,9 @@ private:
     void setDefaultTTL(const RRTTL& ttl, bool post_parsing) {
         assignTTL(default_ttl_, ttl);
         limitTTL(*default_ttl_, post_parsing);
+        if (chunk_ != NULL) {
+            recordEvent(ChunkEvent::SET_DEFAULT_TTL).ttl = *default_ttl_;
+        }
     }
 
     /// \brief Try to set/reset the current TTL from candidate TTL text.
@@ -398,6 +603,9 @@ private:
         if (rrttl) {
             current_ttl_.reset(rrttl);
             limitTTL(*current_ttl_, false);
+            if (chunk_ != NULL) {
+                recordEvent(ChunkEvent::SET_CURRENT_TTL).ttl = *current_ttl_;
+            }
             return (true);
         }
         return (false);
@@ -544,6 +752,18 @@ private:
     bool previous_name_; // True if there was a previous name in this file
                          // (false at the beginning or after an $INCLUDE line)
 
+    // For parsing a chunk in the parallel mode
+    Chunk* const chunk_;        // The chunk to record the results in
+    std::string chunk_source_name_; // The lexer's name of the chunk
+
+    // For the parallel mode
+    size_t thread_count_;       // 0 means the default
+    size_t chunk_size_;
+    boost::scoped_ptr<ParallelLoader> parallel_;
+    ChunkPtr current_chunk_;    // The chunk being reported
+    size_t event_pos_;          // The next event to report in current_chunk_
+    size_t parallel_position_;  // The end of the last reported chunk
+
 public:
     bool complete_;             // All work done.
     bool seen_error_;           // Was there at least one error during the
@@ -849,9 +1069,7 @@ MasterLoader::MasterLoaderImpl::doGenerate() {
         // Rdata. The errors should have been reported by callbacks_
         // already. We need to decide if we want to continue or not.
         if (rdata) {
-            add_callback_(*last_name_, zone_class_, rrtype,
-                          getCurrentTTL(explicit_ttl, rrtype, rdata),
-                          rdata);
+            addRR(rrtype, explicit_ttl, rdata, true);
             // Good, we added another one
             ++rr_count_;
         } else {
@@ -953,7 +1171,14 @@ MasterLoader::MasterLoaderImpl::loadIncremental(size_t count_limit) {
                   "Trying to load when already loaded");
     }
     if (!initialized_) {
-        pushSource(master_file_, active_origin_);
+        if ((options_ & PARALLEL) != 0) {
+            openParallelSource();
+        } else {
+            pushSource(master_file_, active_origin_);
+        }
+    }
+    if (parallel_) {
+        return (loadParallelIncremental(count_limit));
     }
     size_t count = 0;
     while (ok_ && count < count_limit) {
@@ -981,9 +1206,7 @@ MasterLoader::MasterLoaderImpl::loadIncremental(size_t count_limit) {
             // callbacks_ already. We need to decide if we want to continue
             // or not.
             if (rdata) {
-                add_callback_(*last_name_, zone_class_, rrtype,
-                              getCurrentTTL(explicit_ttl, rrtype, rdata),
-                              rdata);
+                addRR(rrtype, explicit_ttl, rdata, false);
                 // Good, we loaded another one
                 ++count;
                 ++rr_count_;
@@ -1019,6 +1242,497 @@ MasterLoader::MasterLoaderImpl::loadIncremental(size_t count_limit) {
     return (!ok_);
 }
 
+/// \brief The engine of the parallel mode.
+///
+/// It splits the top-level input into chunks in the thread running the
+/// loader, and has them parsed by a pool of worker threads.  The chunks are
+/// returned in the order of the input, and at most twice as many chunks as
+/// the threads are kept at a time, so the memory footprint doesn't depend
+/// on the size of the input.
+class MasterLoader::MasterLoaderImpl::ParallelLoader : boost::noncopyable {
+public:
+    ParallelLoader(const MasterLoaderImpl& loader, const char* filename) :
+        loader_(loader), source_(new InputSource(filename)),
+        origin_(loader.active_origin_), splitting_(true), eof_(false),
+        shutdown_(false)
+    {}
+
+    ParallelLoader(const MasterLoaderImpl& loader, std::istream& stream) :
+        loader_(loader), source_(new InputSource(stream)),
+        origin_(loader.active_origin_), splitting_(true), eof_(false),
+        shutdown_(false)
+    {}
+
+    ~ParallelLoader() {
+        {
+            Mutex::Locker locker(mutex_);
+            shutdown_ = true;
+            for (size_t i = 0; i < threads_.size(); ++i) {
+                work_cond_.signal();
+            }
+        }
+        for (size_t i = 0; i < threads_.size(); ++i) {
+            threads_[i]->wait();
+        }
+    }
+
+    /// \brief Whether the workers have been started.
+    bool isStarted() const { return (!threads_.empty()); }
+
+    /// \brief The size of the top-level input.
+    size_t getSize() const { return (source_->getSize()); }
+
+    /// \brief Return the next chunk of the input, parsed.
+    ///
+    /// It returns NULL at the end of the input.
+    ChunkPtr getNextChunk() {
+        if (threads_.empty()) {
+            const size_t thread_count = loader_.getThreadCount();
+            for (size_t i = 0; i < thread_count; ++i) {
+                threads_.push_back(shared_ptr<Thread>(
+                    new Thread(boost::bind(&ParallelLoader::run, this))));
+            }
+        }
+        submitChunks();
+        if (chunks_.empty()) {
+            return (ChunkPtr());
+        }
+        const ChunkPtr chunk = chunks_.front();
+        chunks_.pop_front();
+        // Keep the workers busy while the caller reports this one.
+        submitChunks();
+
+        Mutex::Locker locker(mutex_);
+        while (!chunk->done) {
+            done_cond_.wait(mutex_);
+        }
+        return (chunk);
+    }
+
+private:
+    // The main loop of the worker threads.
+    void run() {
+        while (true) {
+            Chunk* chunk;
+            {
+                Mutex::Locker locker(mutex_);
+                while (!shutdown_ && work_queue_.empty()) {
+                    work_cond_.wait(mutex_);
+                }
+                if (shutdown_) {
+                    return;
+                }
+                chunk = work_queue_.front();
+                work_queue_.pop_front();
+            }
+            MasterLoaderImpl::parseChunk(*chunk, loader_.zone_origin_,
+                                         loader_.zone_class_,
+                                         loader_.options_);
+            Mutex::Locker locker(mutex_);
+            chunk->done = true;
+            done_cond_.signal();
+        }
+    }
+
+    // Split the input into chunks and pass them to the workers, until we
+    // have enough of them.
+    void submitChunks() {
+        const size_t max_chunks = threads_.size() * 2;
+        while (chunks_.size() < max_chunks) {
+            const ChunkPtr chunk = splitChunk();
+            if (!chunk) {
+                break;
+            }
+            chunks_.push_back(chunk);
+            if (!chunk->done) {
+                Mutex::Locker locker(mutex_);
+                work_queue_.push_back(chunk.get());
+                work_cond_.signal();
+            }
+        }
+    }
+
+    // Whether a line starting with the character begins with an owner name.
+    static bool isOwnerStart(int c) {
+        return (c != ' ' && c != '\t' && c != '\r' && c != '\n' &&
+                c != ';' && c != '$' && c != '(' && c != ')');
+    }
+
+    // Read the next chunk from the input.  It's at least as large as the
+    // chunk size unless it's the last one, and ends before a line starting
+    // with an owner name.  To find such lines, we follow the lexer on
+    // comments, quoted strings, escapes and parentheses.
+    ChunkPtr splitChunk() {
+        if (!read_error_.empty()) {
+            // Report the error after the data read before it.
+            ChunkPtr chunk(new Chunk(source_->getName(), 0, origin_));
+            chunk->events.push_back(ChunkEvent(ChunkEvent::ERROR, 0,
+                                               source_->getCurrentLine()));
+            chunk->events.back().reason = read_error_;
+            chunk->end_position = source_->getPosition();
+            chunk->done = chunk->seen_error = chunk->failed = true;
+            chunk->error.swap(read_error_);
+            return (chunk);
+        }
+        if (eof_) {
+            return (ChunkPtr());
+        }
+
+        ChunkPtr chunk(new Chunk(source_->getName(),
+                                 source_->getCurrentLine(), origin_));
+        std::string& data = chunk->data;
+        const size_t chunk_size = loader_.chunk_size_;
+        bool line_start = true;
+        size_t line_begin = 0;
+        bool multiline = false;
+        size_t paren_count = 0;
+        bool in_quote = false;
+        bool in_comment = false;
+        bool escaped = false;
+        try {
+            while (true) {
+                const int c = source_->getChar();
+                if (c == InputSource::END_OF_STREAM) {
+                    eof_ = true;
+                    break;
+                }
+                if (line_start) {
+                    if (splitting_ && data.size() >= chunk_size &&
+                        isOwnerStart(c)) {
+                        source_->ungetChar();
+                        break;
+                    }
+                    line_start = false;
+                    line_begin = data.size();
+                    multiline = false;
+                }
+                data.push_back(c);
+
+                if (in_comment) {
+                    if (c != '\n') {
+                        continue;
+                    }
+                    in_comment = false;
+                } else if (in_quote) {
+                    if (escaped) {
+                        escaped = false;
+                        continue;
+                    } else if (c == '\\') {
+                        escaped = true;
+                        continue;
+                    } else if (c == '"') {
+                        in_quote = false;
+                        continue;
+                    } else if (c != '\n') {
+                        continue;
+                    }
+                    // The lexer rejects a newline in a quoted string and
+                    // handles it as an end of line.
+                    in_quote = false;
+                } else if (escaped && c != '\n') {
+                    escaped = false;
+                    continue;
+                } else {
+                    escaped = false;
+                    if (c == '\\') {
+                        escaped = true;
+                    } else if (c == '"') {
+                        in_quote = true;
+                    } else if (c == ';') {
+                        in_comment = true;
+                    } else if (c == '(') {
+                        ++paren_count;
+                    } else if (c == ')') {
+                        if (paren_count > 0) {
+                            --paren_count;
+                        }
+                    }
+                    if (c != '\n') {
+                        continue;
+                    }
+                }
+
+                // We are at a newline.
+                if (paren_count > 0) {
+                    multiline = true;
+                } else {
+                    if (data[line_begin] == '$') {
+                        checkOrigin(data, line_begin, multiline);
+                    }
+                    line_start = true;
+                    source_->compact();
+                }
+            }
+        } catch (const MasterLexer::ReadError& ex) {
+            read_error_ = ex.what();
+            eof_ = true;
+        }
+        source_->compact();
+        chunk->end_position = source_->getPosition();
+        if (data.empty()) {
+            return (splitChunk());
+        }
+        return (chunk);
+    }
+
+    // Follow an $ORIGIN directive in the line beginning at data[begin], so
+    // we know the origin at the beginning of the next chunk.  The directive
+    // itself is handled by the worker (including errors).  If the new
+    // origin is not in a simple form, we stop splitting the input.
+    void checkOrigin(const std::string& data, size_t begin, bool multiline) {
+        const size_t directive_len = 7; // $ORIGIN
+        if (data.size() <= begin + directive_len ||
+            !iequals(data.substr(begin, directive_len), "$ORIGIN") ||
+            (data[begin + directive_len] != ' ' &&
+             data[begin + directive_len] != '\t')) {
+            return;
+        }
+        const size_t name_begin =
+            data.find_first_not_of(" \t", begin + directive_len);
+        const size_t name_end = data.find_first_of(" \t\r\n;", name_begin);
+        if (name_begin == name_end) {
+            return;             // no name, which is an error
+        }
+        const std::string name = data.substr(name_begin,
+                                             name_end - name_begin);
+        if (multiline || name.find_first_of("\"()\\") != std::string::npos) {
+            splitting_ = false;
+            return;
+        }
+        try {
+            origin_ = Name(name.c_str(), name.size(), &origin_);
+        } catch (const bundy::Exception&) {
+            splitting_ = false;
+        }
+    }
+
+    const MasterLoaderImpl& loader_;
+    const boost::scoped_ptr<InputSource> source_; // The top-level input
+    Name origin_;               // The origin after the last chunk
+    bool splitting_;            // False if we don't know origin_
+    bool eof_;
+    std::string read_error_;    // Error reading the input (if any)
+    std::deque<ChunkPtr> chunks_; // Chunks being parsed, in order
+
+    // The following are shared with the workers.
+    Mutex mutex_;
+    CondVar work_cond_;         // For workers, signaled with new work
+    CondVar done_cond_;         // For us, signaled when a chunk is parsed
+    std::deque<Chunk*> work_queue_;
+    bool shutdown_;
+    std::vector<shared_ptr<Thread> > threads_;
+};
+
+MasterLoader::MasterLoaderImpl::~MasterLoaderImpl() {
+}
+
+void
+MasterLoader::MasterLoaderImpl::setParallelism(size_t thread_count,
+                                               size_t chunk_size)
+{
+    if (thread_count == 0 || chunk_size == 0) {
+        bundy_throw(bundy::InvalidParameter,
+                    "Zero thread count or chunk size");
+    }
+    if (parallel_ && parallel_->isStarted()) {
+        bundy_throw(bundy::InvalidOperation,
+                    "Parallelism set after starting load");
+    }
+    thread_count_ = thread_count;
+    chunk_size_ = chunk_size;
+}
+
+void
+MasterLoader::MasterLoaderImpl::pushStreamSource(std::istream& stream) {
+    if ((options_ & PARALLEL) != 0) {
+        try {
+            parallel_.reset(new ParallelLoader(*this, stream));
+        } catch (const InputSource::OpenError& ex) {
+            // Same as MasterLexer::pushSource().
+            bundy_throw(Unexpected, "Failed to push a stream to lexer: " <<
+                        ex.what());
+        }
+    } else {
+        lexer_.pushSource(stream);
+        if (chunk_ != NULL) {
+            chunk_source_name_ = lexer_.getSourceName();
+        }
+    }
+    initialized_ = true;
+}
+
+size_t
+MasterLoader::MasterLoaderImpl::getSize() const {
+    if (parallel_) {
+        return (parallel_->getSize());
+    }
+    return (lexer_.getTotalSourceSize());
+}
+
+void
+MasterLoader::MasterLoaderImpl::openParallelSource() {
+    initialized_ = true;
+    try {
+        parallel_.reset(new ParallelLoader(*this, master_file_.c_str()));
+    } catch (const InputSource::OpenError& ex) {
+        // Same as the top-level case of pushSource().
+        reportError("", 0, ex.what());
+        ok_ = false;
+    }
+}
+
+void
+MasterLoader::MasterLoaderImpl::parseChunk(Chunk& chunk,
+                                           const Name& zone_origin,
+                                           const RRClass& zone_class,
+                                           MasterLoader::Options options)
+{
+    try {
+        std::istringstream stream(chunk.data);
+        MasterLoaderImpl parser("", zone_origin, zone_class,
+                                MasterLoaderCallbacks::getNullCallbacks(),
+                                AddRRCallback(),
+                                static_cast<MasterLoader::Options>(
+                                    options & ~PARALLEL),
+                                &chunk);
+        parser.pushStreamSource(stream);
+        while (!parser.loadIncremental(1000)) {
+            // Body intentionally left blank
+        }
+        chunk.seen_error = parser.seen_error_;
+    } catch (const MasterLoaderError& ex) {
+        chunk.seen_error = chunk.failed = true;
+        chunk.error = ex.what();
+    } catch (const std::exception& ex) {
+        chunk.unexpected = true;
+        chunk.error = ex.what();
+    }
+    std::string().swap(chunk.data);
+}
+
+bool
+MasterLoader::MasterLoaderImpl::getRecordedTTL(const ChunkEvent& event,
+                                               const std::string& source)
+{
+    // This follows getCurrentTTL(), including the line numbers.
+    const size_t current_line = event.line - 1;
+
+    if (event.explicit_ttl) {
+        assignTTL(current_ttl_, event.ttl);
+    }
+    if (!current_ttl_ && !default_ttl_) {
+        if (event.rrtype == RRType::SOA()) {
+            callbacks_.warning(source, current_line,
+                               "no TTL specified; using SOA MINTTL instead");
+            RRTTL ttl(dynamic_cast<const rdata::generic::SOA&>(*event.rdata).
+                      getMinimum());
+            if (ttl > RRTTL::MAX_TTL()) {
+                callbacks_.warning(source, current_line,
+                                   "TTL " + ttl.toText() + " > MAXTTL, "
+                                   "setting to 0 per RFC2181");
+                ttl = RRTTL(0);
+            }
+            assignTTL(default_ttl_, ttl);
+            assignTTL(current_ttl_, ttl);
+        } else {
+            // For $GENERATE the lexer isn't positioned at the next line.
+            reportError(source, event.generated ? event.line : current_line,
+                        "no TTL specified; load rejected");
+            return (false);
+        }
+    } else if (!event.explicit_ttl && default_ttl_) {
+        assignTTL(current_ttl_, *default_ttl_);
+    } else if (!event.explicit_ttl && warn_rfc1035_ttl_) {
+        callbacks_.warning(source, current_line,
+                           "using RFC1035 TTL semantics; default to the "
+                           "last explicitly stated TTL");
+        warn_rfc1035_ttl_ = false;
+    }
+    return (true);
+}
+
+bool
+MasterLoader::MasterLoaderImpl::replayChunk(size_t count_limit,
+                                            size_t& count)
+{
+    const std::vector<ChunkEvent>& events = current_chunk_->events;
+    while (event_pos_ < events.size()) {
+        if (count >= count_limit) {
+            return (false);
+        }
+        const ChunkEvent& event = events[event_pos_++];
+        const std::string& source = current_chunk_->sources[event.source];
+        switch (event.type) {
+        case ChunkEvent::ADD_RR:
+            if (getRecordedTTL(event, source)) {
+                add_callback_(*event.name, zone_class_, event.rrtype,
+                              *current_ttl_, event.rdata);
+                ++count;
+                ++rr_count_;
+            } else if (event.generated) {
+                // $GENERATE would have stopped at the error; skip the rest
+                // of the line.
+                while (event_pos_ < events.size() &&
+                       events[event_pos_].source == event.source &&
+                       events[event_pos_].line == event.line) {
+                    ++event_pos_;
+                }
+            }
+            break;
+        case ChunkEvent::SET_CURRENT_TTL:
+            assignTTL(current_ttl_, event.ttl);
+            break;
+        case ChunkEvent::SET_DEFAULT_TTL:
+            assignTTL(default_ttl_, event.ttl);
+            break;
+        case ChunkEvent::ERROR:
+            seen_error_ = true;
+            callbacks_.error(source, event.line, event.reason);
+            break;
+        case ChunkEvent::WARNING:
+            callbacks_.warning(source, event.line, event.reason);
+            break;
+        }
+    }
+    return (true);
+}
+
+bool
+MasterLoader::MasterLoaderImpl::loadParallelIncremental(size_t count_limit) {
+    size_t count = 0;
+    while (ok_ && count < count_limit) {
+        if (!current_chunk_) {
+            current_chunk_ = parallel_->getNextChunk();
+            if (!current_chunk_) {
+                return (true);  // we are done
+            }
+            event_pos_ = 0;
+        }
+        if (!replayChunk(count_limit, count)) {
+            break;
+        }
+
+        // We've reported everything in the chunk.  Now we can tell how it
+        // ended.
+        const ChunkPtr chunk = current_chunk_;
+        current_chunk_.reset();
+        parallel_position_ = chunk->end_position;
+        seen_error_ = seen_error_ || chunk->seen_error;
+        if (chunk->unexpected) {
+            ok_ = false;
+            complete_ = true;
+            bundy_throw(Unexpected, "Failed to parse zone data: " <<
+                        chunk->error);
+        } else if (chunk->failed) {
+            ok_ = false;
+            complete_ = true;
+            bundy_throw(MasterLoaderError, chunk->error.c_str());
+        }
+    }
+    // When there was a fatal error and ok is false, we say we are done.
+    return (!ok_);
+}
+
 MasterLoader::MasterLoader(const char* master_file,
                            const Name& zone_origin,
                            const RRClass& zone_class,
@@ -1062,6 +1776,11 @@ MasterLoader::loadIncremental(size_t count_limit) {
     return (result);
 }
 
+void
+MasterLoader::setParallelism(size_t thread_count, size_t chunk_size) {
+    impl_->setParallelism(thread_count, chunk_size);
+}
+
 bool
 MasterLoader::loadedSucessfully() const {
     return (impl_->complete_ && !impl_->seen_error_);
@@ -41,15 +41,39 @@ public:
 /// incrementally.
 ///
 /// It reports the loaded RRs and encountered errors by callbacks.
+///
+/// If the \c PARALLEL option is specified, the top-level input (file or
+/// stream) is split into chunks of roughly the same size, which are parsed
+/// on a pool of worker threads (see \c setParallelism()).  A chunk always
+/// begins at a line that starts an RR with an explicit owner name, outside
+/// of any parentheses and quoted strings, so each chunk can be parsed
+/// independently by knowing the origin active at its beginning.  The RRs
+/// and errors found in each chunk are recorded by the workers and then
+/// reported by the thread calling \c loadIncremental() in the order of the
+/// input, so the callbacks see exactly what they would see in the
+/// sequential mode and are never called from other threads.  TTLs that
+/// depend on preceding RRs (the RFC1035 semantics or the SOA minimum, as
+/// well as $TTL) are resolved at that point, too.  $INCLUDE, $GENERATE and
+/// $TTL are handled within the chunk containing them; the loader tracks
+/// $ORIGIN by itself to know the origin of the next chunk, and if it cannot
+/// (because the new origin is specified in an unusual form, e.g., quoted),
+/// the rest of the input is handled as a single chunk.  This mode is meant
+/// for very large zone files; for small ones the overhead of the threads
+/// may not pay off.
 class MasterLoader : boost::noncopyable {
 public:
     /// \brief Options how the parsing should work.
     enum Options {
         DEFAULT = 0,       ///< Nothing special.
-        MANY_ERRORS = 1    ///< Lenient mode (see documentation of MasterLoader
+        MANY_ERRORS = 1,   ///< Lenient mode (see documentation of MasterLoader
                            ///  constructor).
+        PARALLEL = 2       ///< Parse the input on multiple threads (see
+                           ///  the class description).
     };
 
+    /// \brief The default size of a chunk in the parallel mode (in bytes).
+    static const size_t DEFAULT_CHUNK_SIZE = 1024 * 1024;
+
     /// \brief Constructor
     ///
     /// This creates a master loader and provides it with all
@@ -102,6 +126,21 @@ public:
     /// \brief Destructor
     ~MasterLoader();
 
+    /// \brief Set the parameters of the parallel mode.
+    ///
+    /// This is only meaningful with the \c PARALLEL option, and must be
+    /// called before starting the load.  By default the number of threads
+    /// is the number of online processors (up to 8) and the chunk size is
+    /// \c DEFAULT_CHUNK_SIZE.
+    ///
+    /// \throw bundy::InvalidParameter thread_count or chunk_size is 0.
+    /// \throw bundy::InvalidOperation the load has already been started.
+    ///
+    /// \param thread_count The number of worker threads parsing chunks.
+    /// \param chunk_size The minimum size of a chunk (in bytes).  Smaller
+    ///     chunks are only made at the end of the input.
+    void setParallelism(size_t thread_count, size_t chunk_size);
+
     /// \brief Load some RRs
     ///
     /// This method loads at most count_limit RRs and reports them. In case
@@ -177,6 +216,10 @@ public:
     /// completion it will be equal to the return value of \c getSize()
     /// (unless the latter returns \c MasterLexer::SOURCE_SIZE_UNKNOWN).
     ///
+    /// In the parallel mode, both the size and position only count the
+    /// top-level input, and the position advances by chunks as their RRs
+    /// are reported.
+    ///
     /// \throw None
     size_t getPosition() const;
 
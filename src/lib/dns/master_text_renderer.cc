@@ -0,0 +1,438 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <dns/master_text_renderer.h>
+#include <dns/labelsequence.h>
+#include <dns/name.h>
+#include <dns/rdata.h>
+#include <dns/rrclass.h>
+#include <dns/rrttl.h>
+#include <dns/rrtype.h>
+
+#include <util/encode/base64.h>
+#include <util/encode/hex.h>
+#include <util/time_utilities.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+using namespace bundy::util;
+using namespace bundy::dns::rdata;
+
+namespace bundy {
+namespace dns {
+
+namespace {
+// The types whose mnemonic is cached.
+const size_t TYPE_NAMES_COUNT = 256;
+
+// The type codes of the RDATA formatted by the renderer.
+enum {
+    TYPE_A = 1,
+    TYPE_NS = 2,
+    TYPE_CNAME = 5,
+    TYPE_SOA = 6,
+    TYPE_PTR = 12,
+    TYPE_MX = 15,
+    TYPE_TXT = 16,
+    TYPE_AAAA = 28,
+    TYPE_DNAME = 39,
+    TYPE_DS = 43,
+    TYPE_RRSIG = 46,
+    TYPE_DNSKEY = 48,
+    TYPE_SPF = 99
+};
+
+inline uint16_t
+readUint16(const uint8_t* data) {
+    return ((static_cast<uint16_t>(data[0]) << 8) | data[1]);
+}
+
+inline uint32_t
+readUint32(const uint8_t* data) {
+    return ((static_cast<uint32_t>(readUint16(data)) << 16) |
+            readUint16(data + 2));
+}
+}
+
+MasterTextRenderer::MasterTextRenderer(size_t capacity) :
+    data_(std::max(capacity, static_cast<size_t>(1))), size_(0), wire_(512),
+    type_names_(TYPE_NAMES_COUNT), next_time_(0)
+{
+    std::fill(times_, times_ + 2, 0);
+    std::fill(&time_texts_[0][0], &time_texts_[0][0] + sizeof(time_texts_),
+              0);
+}
+
+void
+MasterTextRenderer::grow(const size_t len) {
+    data_.resize(std::max(data_.size() * 2, size_ + len));
+}
+
+void
+MasterTextRenderer::flush(std::ostream& os) {
+    if (size_ > 0) {
+        os.write(&data_[0], size_);
+    }
+    clear();
+}
+
+void
+MasterTextRenderer::appendUint(uint32_t value) {
+    char digits[10];
+    char* p = digits + sizeof(digits);
+    do {
+        *--p = '0' + (value % 10);
+        value /= 10;
+    } while (value != 0);
+    append(p, digits + sizeof(digits) - p);
+}
+
+// Appends the uncompressed name at pos of the wire data as
+// LabelSequence::toText() does, and moves pos past it.  Returns false if
+// the name is broken.
+bool
+MasterTextRenderer::appendName(const uint8_t* wire, const size_t len,
+                               size_t& pos)
+{
+    bool first = true;
+    while (pos < len) {
+        size_t count = wire[pos++];
+        if (count == 0) {
+            append('.');
+            return (true);
+        }
+        if (count > Name::MAX_LABELLEN || count > len - pos) {
+            return (false);
+        }
+        // Each character takes 4 at most, with the separating dot.
+        char* dst = reserve(count * 4 + 1);
+        char* const start = dst;
+        if (!first) {
+            *dst++ = '.';
+        }
+        first = false;
+        while (count-- > 0) {
+            const uint8_t c = wire[pos++];
+            switch (c) {
+            case 0x22: // '"'
+            case 0x28: // '('
+            case 0x29: // ')'
+            case 0x2E: // '.'
+            case 0x3B: // ';'
+            case 0x5C: // '\\'
+            case 0x40: // '@'
+            case 0x24: // '$'
+                *dst++ = '\\';
+                *dst++ = c;
+                break;
+            default:
+                if (c > 0x20 && c < 0x7f) {
+                    *dst++ = c;
+                } else {
+                    *dst++ = '\\';
+                    *dst++ = '0' + ((c / 100) % 10);
+                    *dst++ = '0' + ((c / 10) % 10);
+                    *dst++ = '0' + (c % 10);
+                }
+            }
+        }
+        size_ += dst - start;
+    }
+    return (false);
+}
+
+void
+MasterTextRenderer::appendType(const RRType& type) {
+    const uint16_t code = type.getCode();
+    if (code >= TYPE_NAMES_COUNT) {
+        append(type.toText());
+        return;
+    }
+    std::string& name = type_names_[code];
+    if (name.empty()) {
+        name = type.toText();
+    }
+    append(name);
+}
+
+void
+MasterTextRenderer::appendTime(const uint32_t value) {
+    // The text depends on the current time (see timeToText32()), but the
+    // cached texts don't live longer than the renderer.
+    for (size_t i = 0; i < 2; ++i) {
+        if (time_texts_[i][0] != 0 && times_[i] == value) {
+            append(time_texts_[i], sizeof(time_texts_[i]));
+            return;
+        }
+    }
+    const std::string text = timeToText32(value);
+    append(text);
+    if (text.size() == sizeof(time_texts_[0])) {
+        times_[next_time_] = value;
+        std::memcpy(time_texts_[next_time_], text.data(), text.size());
+        next_time_ = 1 - next_time_;
+    }
+}
+
+void
+MasterTextRenderer::appendBase64(const uint8_t* data, const size_t len) {
+    size_ += encode::encodeBase64(data, len, reserve((len + 2) / 3 * 4));
+}
+
+void
+MasterTextRenderer::appendHex(const uint8_t* data, const size_t len) {
+    size_ += encode::encodeHex(data, len, reserve(len * 2));
+}
+
+// Appends the text of the RDATA of the common types, formatted from its
+// wire format as their toText() would.  Returns false, with nothing
+// appended, for the other types.
+bool
+MasterTextRenderer::appendRdata(const RRType& type, const RRClass& rrclass,
+                                const Rdata& rdata)
+{
+    const uint16_t code = type.getCode();
+    switch (code) {
+    case TYPE_A:
+    case TYPE_AAAA:
+        if (rrclass != RRClass::IN()) {
+            return (false);
+        }
+        break;
+    case TYPE_NS:
+    case TYPE_CNAME:
+    case TYPE_SOA:
+    case TYPE_PTR:
+    case TYPE_MX:
+    case TYPE_TXT:
+    case TYPE_DNAME:
+    case TYPE_DS:
+    case TYPE_RRSIG:
+    case TYPE_DNSKEY:
+    case TYPE_SPF:
+        break;
+    default:
+        return (false);
+    }
+
+    wire_.clear();
+    rdata.toWire(wire_);
+    const uint8_t* const wire = static_cast<const uint8_t*>(wire_.getData());
+    const size_t len = wire_.getLength();
+    const size_t start = size_;
+    size_t pos = 0;
+    bool ok = false;
+
+    switch (code) {
+    case TYPE_A:
+        if (len == 4) {
+            for (pos = 0; pos < 4; ++pos) {
+                if (pos > 0) {
+                    append('.');
+                }
+                appendUint(wire[pos]);
+            }
+            ok = true;
+        }
+        break;
+    case TYPE_AAAA:
+        if (len == 16) {
+            char text[INET6_ADDRSTRLEN];
+            if (inet_ntop(AF_INET6, wire, text, sizeof(text)) != NULL) {
+                append(text, std::strlen(text));
+                ok = true;
+            }
+        }
+        break;
+    case TYPE_NS:
+    case TYPE_CNAME:
+    case TYPE_PTR:
+    case TYPE_DNAME:
+        ok = appendName(wire, len, pos) && pos == len;
+        break;
+    case TYPE_MX:
+        if (len > 2) {
+            appendUint(readUint16(wire));
+            append(' ');
+            pos = 2;
+            ok = appendName(wire, len, pos) && pos == len;
+        }
+        break;
+    case TYPE_SOA:
+        if (appendName(wire, len, pos)) {
+            append(' ');
+            if (appendName(wire, len, pos) && len - pos == 20) {
+                for (; pos < len; pos += 4) {
+                    append(' ');
+                    appendUint(readUint32(wire + pos));
+                }
+                ok = true;
+            }
+        }
+        break;
+    case TYPE_TXT:
+    case TYPE_SPF:
+        ok = true;
+        while (pos < len) {
+            size_t count = wire[pos++];
+            if (count > len - pos) {
+                ok = false;
+                break;
+            }
+            char* dst = reserve(count * 4 + 3);
+            char* const text_start = dst;
+            if (size_ > start) {
+                *dst++ = ' ';
+            }
+            *dst++ = '"';
+            while (count-- > 0) {
+                const uint8_t c = wire[pos++];
+                if (c < 0x20 || c >= 0x7f) {
+                    *dst++ = '\\';
+                    *dst++ = '0' + ((c / 100) % 10);
+                    *dst++ = '0' + ((c / 10) % 10);
+                    *dst++ = '0' + (c % 10);
+                    continue;
+                }
+                if (c == '"' || c == ';' || c == '\\') {
+                    *dst++ = '\\';
+                }
+                *dst++ = c;
+            }
+            *dst++ = '"';
+            size_ += dst - text_start;
+        }
+        break;
+    case TYPE_DS:
+        if (len >= 4) {
+            appendUint(readUint16(wire));
+            append(' ');
+            appendUint(wire[2]);
+            append(' ');
+            appendUint(wire[3]);
+            append(' ');
+            appendHex(wire + 4, len - 4);
+            ok = true;
+        }
+        break;
+    case TYPE_DNSKEY:
+        if (len >= 4) {
+            appendUint(readUint16(wire));
+            append(' ');
+            appendUint(wire[2]);
+            append(' ');
+            appendUint(wire[3]);
+            append(' ');
+            appendBase64(wire + 4, len - 4);
+            ok = true;
+        }
+        break;
+    case TYPE_RRSIG:
+        if (len > 18) {
+            appendType(RRType(readUint16(wire)));
+            append(' ');
+            appendUint(wire[2]);
+            append(' ');
+            appendUint(wire[3]);
+            append(' ');
+            appendUint(readUint32(wire + 4));
+            append(' ');
+            appendTime(readUint32(wire + 8));
+            append(' ');
+            appendTime(readUint32(wire + 12));
+            append(' ');
+            appendUint(readUint16(wire + 16));
+            append(' ');
+            pos = 18;
+            if (appendName(wire, len, pos)) {
+                append(' ');
+                appendBase64(wire + pos, len - pos);
+                ok = true;
+            }
+        }
+        break;
+    }
+
+    if (!ok) {
+        size_ = start;
+    }
+    return (ok);
+}
+
+size_t
+MasterTextRenderer::renderRRs(const AbstractRRset& rrset) {
+    const size_t start = size_;
+    size_t name_len;
+    const uint8_t* const name_data =
+        LabelSequence(rrset.getName()).getData(&name_len);
+    size_t pos = 0;
+    appendName(name_data, name_len, pos);
+    append(' ');
+    appendUint(rrset.getTTL().getValue());
+    append(' ');
+    const RRClass& rrclass = rrset.getClass();
+    append(rrclass.toText());
+    append(' ');
+    const RRType& type = rrset.getType();
+    appendType(type);
+    const size_t prefix_len = size_ - start;
+
+    RdataIteratorPtr it = rrset.getRdataIterator();
+    if (it->isLast()) {
+        // As toText(), print the name, TTL, class and type of an empty
+        // RRset, but only for class ANY or NONE.
+        if (rrclass != RRClass::ANY() && rrclass != RRClass::NONE()) {
+            size_ = start;
+            bundy_throw(EmptyRRset, "toText() is attempted for an empty RRset");
+        }
+        append('\n');
+        return (1);
+    }
+
+    size_t count = 0;
+    do {
+        if (count > 0) {
+            // Copy the name, TTL, class and type of the first RR.
+            char* const dst = reserve(prefix_len);
+            std::memcpy(dst, &data_[start], prefix_len);
+            size_ += prefix_len;
+        }
+        append(' ');
+        const Rdata& rdata = it->getCurrent();
+        if (!appendRdata(type, rrclass, rdata)) {
+            append(rdata.toText());
+        }
+        append('\n');
+        ++count;
+        it->next();
+    } while (!it->isLast());
+    return (count);
+}
+
+size_t
+MasterTextRenderer::render(const AbstractRRset& rrset) {
+    size_t count = renderRRs(rrset);
+    const RRsetPtr rrsig = rrset.getRRsig();
+    if (rrsig) {
+        count += render(*rrsig);
+    }
+    return (count);
+}
+
+}
+}
@@ -0,0 +1,151 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef MASTER_TEXT_RENDERER_H
+#define MASTER_TEXT_RENDERER_H 1
+
+#include <dns/rrset.h>
+#include <util/buffer.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace dns {
+
+/// \brief A renderer of RRsets in the master file format.
+///
+/// This class appends the text of RRsets to an internal buffer, in the
+/// same format as \c AbstractRRset::toText(): one line per RR, followed by
+/// the lines of the RRSIGs of the RRset, if any.  It's meant for writing
+/// large zones to files, where building a string for each RR and each
+/// RDATA field with \c toText() costs more than reading the zone.
+///
+/// The owner name, TTL, class and type of an RRset are formatted once and
+/// copied for its other RRs.  The RDATA of the common types (A and AAAA
+/// of class IN, NS, CNAME, PTR, DNAME, MX, SOA, TXT, SPF, DS, DNSKEY and
+/// RRSIG) is formatted from its wire format directly into the buffer;
+/// the other types fall back to \c Rdata::toText().
+///
+/// The buffer grows as needed.  The application typically renders RRsets
+/// until the buffer holds some amount of text, writes it out and clears
+/// the renderer, which keeps the allocated memory.
+class MasterTextRenderer : boost::noncopyable {
+public:
+    /// \brief Constructor.
+    ///
+    /// \throw std::bad_alloc Memory allocation fails.
+    ///
+    /// \param capacity The initial size of the buffer, in bytes.
+    explicit MasterTextRenderer(size_t capacity = 65536);
+
+    /// \brief Append the text of an RRset.
+    ///
+    /// \throw EmptyRRset The RRset is empty and its class is neither ANY
+    /// nor NONE (as \c AbstractRRset::toText()).
+    /// \throw std::bad_alloc Memory allocation fails.
+    ///
+    /// \param rrset The RRset to be rendered.
+    /// \return The number of RRs rendered, including the RRSIGs.
+    size_t render(const AbstractRRset& rrset);
+
+    /// \brief Return the text rendered so far.
+    ///
+    /// The text isn't nul-terminated; the pointer is invalidated by the
+    /// next call of \c render().
+    const char* getData() const {
+        return (size_ > 0 ? &data_[0] : NULL);
+    }
+
+    /// \brief Return the length of the text rendered so far.
+    size_t getLength() const {
+        return (size_);
+    }
+
+    /// \brief Write the text rendered so far to a stream and clear it.
+    ///
+    /// \param os The output stream.
+    void flush(std::ostream& os);
+
+    /// \brief Drop the text rendered so far.
+    ///
+    /// The memory of the buffer is kept.
+    void clear() {
+        size_ = 0;
+    }
+
+private:
+    // Makes sure that len more characters fit in the buffer and returns
+    // where they go.
+    char* reserve(const size_t len) {
+        if (data_.size() - size_ < len) {
+            grow(len);
+        }
+        return (&data_[size_]);
+    }
+    void grow(const size_t len);
+
+    void append(const char* text, const size_t len) {
+        if (len > 0) {
+            std::memcpy(reserve(len), text, len);
+            size_ += len;
+        }
+    }
+    void append(const std::string& text) {
+        append(text.data(), text.size());
+    }
+    void append(const char c) {
+        *reserve(1) = c;
+        ++size_;
+    }
+    void appendUint(uint32_t value);
+    bool appendName(const uint8_t* wire, const size_t len, size_t& pos);
+    void appendType(const RRType& type);
+    void appendTime(const uint32_t value);
+    void appendBase64(const uint8_t* data, const size_t len);
+    void appendHex(const uint8_t* data, const size_t len);
+    bool appendRdata(const RRType& type, const RRClass& rrclass,
+                     const rdata::Rdata& rdata);
+    size_t renderRRs(const AbstractRRset& rrset);
+
+    std::vector<char> data_;
+    size_t size_;
+
+    // The wire format of the RDATA being rendered.
+    util::OutputBuffer wire_;
+
+    // The mnemonics of the types with a small code, built when they are
+    // first rendered.
+    std::vector<std::string> type_names_;
+
+    // The text of the last times of RRSIGs, which are usually the same for
+    // all signatures of a zone.
+    uint32_t times_[2];
+    char time_texts_[2][14];
+    size_t next_time_;
+};
+
+}
+}
+#endif  // MASTER_TEXT_RENDERER_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -83,6 +83,10 @@ const unsigned int HEADERFLAG_MASK = 0x87b0;
 const uint16_t MESSAGE_REPLYPRESERVE = (Message::HEADERFLAG_RD |
                                         Message::HEADERFLAG_CD);
 
+// The maximum number of spare Question objects kept in a message.  Normal
+// messages have only one question, so we don't need many of them.
+const size_t MAX_QUESTION_POOL = 4;
+
 const char* const sectiontext[] = {
     "QUESTION",
     "ANSWER",
@@ -118,9 +122,16 @@ public:
     ConstEDNSPtr edns_;
     ConstTSIGRecordPtr tsig_rr_;
 
+    // Questions no longer referenced by anyone else are kept on clear() and
+    // reused for the next parse, saving memory allocations when a Message
+    // object is used for many messages.
+    vector<QuestionPtr> question_pool_;
+
     // RRsetsSorter* sorter_; : TODO
 
     void init();
+    QuestionPtr createQuestion(const Name& name, const RRClass& rrclass,
+                               const RRType& rrtype);
     void setOpcode(const Opcode& opcode);
     void setRcode(const Rcode& rcode);
     int parseQuestion(InputBuffer& buffer);
@@ -167,12 +178,30 @@ MessageImpl::init() {
     }
 
     header_parsed_ = false;
+    BOOST_FOREACH(const QuestionPtr& question, questions_) {
+        if (question.unique() && question_pool_.size() < MAX_QUESTION_POOL) {
+            question_pool_.push_back(question);
+        }
+    }
     questions_.clear();
     rrsets_[Message::SECTION_ANSWER].clear();
     rrsets_[Message::SECTION_AUTHORITY].clear();
     rrsets_[Message::SECTION_ADDITIONAL].clear();
 }
 
+QuestionPtr
+MessageImpl::createQuestion(const Name& name, const RRClass& rrclass,
+                            const RRType& rrtype)
+{
+    if (question_pool_.empty()) {
+        return (QuestionPtr(new Question(name, rrclass, rrtype)));
+    }
+    QuestionPtr question = question_pool_.back();
+    question_pool_.pop_back();
+    *question = Question(name, rrclass, rrtype);
+    return (question);
+}
+
 void
 MessageImpl::setOpcode(const Opcode& opcode) {
     opcode_placeholder_ = opcode;
@@ -680,7 +709,7 @@ MessageImpl::parseQuestion(InputBuffer& buffer) {
         // optimized algorithm that requires the question section contain
         // exactly one RR.
 
-        questions_.push_back(QuestionPtr(new Question(name, rrclass, rrtype)));
+        questions_.push_back(createQuestion(name, rrclass, rrtype));
         ++added;
     }
 
@@ -20,8 +20,10 @@
 #include <dns/messagerenderer.h>
 
 #include <boost/array.hpp>
+#include <boost/foreach.hpp>
 #include <boost/static_assert.hpp>
 
+#include <algorithm>
 #include <limits>
 #include <cassert>
 #include <vector>
@@ -158,57 +160,90 @@ private:
 /// It internally holds a hash table for OffsetItem objects corresponding
 /// to portions of names rendered in this renderer.  The offset information
 /// is used to compress subsequent names to be rendered.
+///
+/// The hash table is a single array of slots with open addressing (linear
+/// probing).  Each slot is stamped with the "generation" of the table in
+/// which it was filled; slots of older generations are considered empty,
+/// so the table can be cleared by simply incrementing the generation
+/// regardless of its size.  The table grows when it gets half full, and
+/// the grown size is kept for subsequent rendering, so in a steady state
+/// it doesn't involve any memory allocation or initialization per message.
 struct MessageRenderer::MessageRendererImpl {
-    // The size of hash buckets and number of hash entries per bucket for
-    // which space is preallocated and kept reserved for subsequent rendering
-    // to provide better performance.  These values are derived from the
-    // BIND 9 implementation that uses a similar hash table.
-    static const size_t BUCKETS = 64;
-    static const size_t RESERVED_ITEMS = 16;
+    // The initial number of slots of the hash table.  It can hold at least
+    // half of this number of offsets without growing, which should be
+    // sufficient for most of the messages.
+    static const size_t INITIAL_CAPACITY = 1024;
     static const uint16_t NO_OFFSET = 65535; // used as a marker of 'not found'
 
+    struct Slot {
+        Slot() : generation_(0), item_(0, 0, 0) {}
+        uint32_t generation_;
+        OffsetItem item_;
+    };
+
     /// \brief Constructor
     MessageRendererImpl() :
+        table_(INITIAL_CAPACITY), generation_(1), count_(0),
         msglength_limit_(512), truncated_(false),
         compress_mode_(MessageRenderer::CASE_INSENSITIVE)
+    {}
+
+    // Find the offset of a name that is equal to the given one.  If there
+    // are multiple such names (which can happen if names are rendered
+    // without compression), the one rendered last (i.e., of the largest
+    // offset) is used, which is generally more compression friendly.
+    template <bool CASE_SENSITIVE>
+    uint16_t findOffset(const OutputBuffer& buffer, InputBuffer& name_buf,
+                        size_t hash) const
     {
-        // Reserve some spaces for hash table items.
-        for (size_t i = 0; i < BUCKETS; ++i) {
-            table_[i].reserve(RESERVED_ITEMS);
+        const NameCompare<CASE_SENSITIVE> compare(buffer, name_buf, hash);
+        const size_t mask = table_.size() - 1;
+        uint16_t found = NO_OFFSET;
+        for (size_t i = hash & mask; table_[i].generation_ == generation_;
+             i = (i + 1) & mask) {
+            const OffsetItem& item = table_[i].item_;
+            if ((found == NO_OFFSET || item.pos_ > found) && compare(item)) {
+                found = item.pos_;
+            }
         }
+        return (found);
     }
 
     uint16_t findOffset(const OutputBuffer& buffer, InputBuffer& name_buf,
                         size_t hash, bool case_sensitive) const
     {
-        // Find a matching entry, if any.  We use some heuristics here: often
-        // the same name appears consecutively (like repeating the same owner
-        // name for a single RRset), so in case there's a collision in the
-        // bucket it will be more likely to find it in the tail side of the
-        // bucket.
-        const size_t bucket_id = hash % BUCKETS;
-        vector<OffsetItem>::const_reverse_iterator found;
         if (case_sensitive) {
-            found = find_if(table_[bucket_id].rbegin(),
-                            table_[bucket_id].rend(),
-                            NameCompare<true>(buffer, name_buf, hash));
-        } else {
-            found = find_if(table_[bucket_id].rbegin(),
-                            table_[bucket_id].rend(),
-                            NameCompare<false>(buffer, name_buf, hash));
+            return (findOffset<true>(buffer, name_buf, hash));
         }
-        if (found != table_[bucket_id].rend()) {
-            return (found->pos_);
-        }
-        return (NO_OFFSET);
+        return (findOffset<false>(buffer, name_buf, hash));
     }
 
     void addOffset(size_t hash, size_t offset, size_t len) {
-        table_[hash % BUCKETS].push_back(OffsetItem(hash, offset, len));
+        if ((count_ + 1) * 2 > table_.size()) {
+            grow();
+        }
+        insert(OffsetItem(hash, offset, len));
+        ++count_;
     }
 
-    // The hash table for the (offset + position in the buffer) entries
-    vector<OffsetItem> table_[BUCKETS];
+    void clearOffsets() {
+        count_ = 0;
+        if (++generation_ == 0) {
+            // On wrap around we need to explicitly invalidate all slots
+            // (this should be very rare).
+            std::fill(table_.begin(), table_.end(), Slot());
+            generation_ = 1;
+        }
+    }
+
+    /// The hash table for the (offset + position in the buffer) entries.
+    /// Its size is always a power of 2.
+    vector<Slot> table_;
+    /// The current generation of the hash table.  Slots of other
+    /// generations are unused.
+    uint32_t generation_;
+    /// The number of offsets stored in the current generation.
+    size_t count_;
     /// The maximum length of rendered data that can fit without
     /// truncation.
     uint16_t msglength_limit_;
@@ -222,6 +257,27 @@ struct MessageRenderer::MessageRendererImpl {
     // Note: we may want to make it a local variable of writeName() if it
     // works more efficiently.
     boost::array<size_t, Name::MAX_LABELS> seq_hashes_;
+
+private:
+    void insert(const OffsetItem& item) {
+        const size_t mask = table_.size() - 1;
+        size_t i = item.hash_ & mask;
+        while (table_[i].generation_ == generation_) {
+            i = (i + 1) & mask;
+        }
+        table_[i].generation_ = generation_;
+        table_[i].item_ = item;
+    }
+
+    void grow() {
+        vector<Slot> old_table(table_.size() * 2);
+        old_table.swap(table_);
+        BOOST_FOREACH(const Slot& slot, old_table) {
+            if (slot.generation_ == generation_) {
+                insert(slot.item_);
+            }
+        }
+    }
 };
 
 MessageRenderer::MessageRenderer() :
@@ -229,6 +285,11 @@ MessageRenderer::MessageRenderer() :
     impl_(new MessageRendererImpl)
 {}
 
+MessageRenderer::MessageRenderer(void* storage, size_t len) :
+    AbstractMessageRenderer(storage, len),
+    impl_(new MessageRendererImpl)
+{}
+
 MessageRenderer::~MessageRenderer() {
     delete impl_;
 }
@@ -240,18 +301,9 @@ MessageRenderer::clear() {
     impl_->truncated_ = false;
     impl_->compress_mode_ = CASE_INSENSITIVE;
 
-    // Clear the hash table.  We reserve the minimum space for possible
-    // subsequent use of the renderer.
-    for (size_t i = 0; i < MessageRendererImpl::BUCKETS; ++i) {
-        if (impl_->table_[i].size() > MessageRendererImpl::RESERVED_ITEMS) {
-            // Trim excessive capacity: swap ensures the new capacity is only
-            // reasonably large for the reserved space.
-            vector<OffsetItem> new_table;
-            new_table.reserve(MessageRendererImpl::RESERVED_ITEMS);
-            new_table.swap(impl_->table_[i]);
-        }
-        impl_->table_[i].clear();
-    }
+    // Clear the hash table.  This is a constant time operation, and its
+    // space is kept for subsequent use of the renderer.
+    impl_->clearOffsets();
 }
 
 size_t
@@ -373,6 +425,11 @@ AbstractMessageRenderer::AbstractMessageRenderer() :
 {
 }
 
+AbstractMessageRenderer::AbstractMessageRenderer(void* storage, size_t len) :
+    local_buffer_(storage, len), buffer_(&local_buffer_)
+{
+}
+
 void
 AbstractMessageRenderer::setBuffer(OutputBuffer* buffer) {
     if (buffer != NULL && buffer_->getLength() != 0) {
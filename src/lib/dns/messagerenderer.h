@@ -112,6 +112,15 @@ protected:
     /// never be instantiated (except as part of a derived class).
     AbstractMessageRenderer();
 
+    /// \brief Constructor with caller-provided storage.
+    ///
+    /// The default buffer is constructed on the given storage (see the
+    /// corresponding constructor of \c bundy::util::OutputBuffer).
+    ///
+    /// \param storage The head of the storage for the default buffer.
+    /// \param len The length of the storage in bytes.
+    AbstractMessageRenderer(void* storage, size_t len);
+
 public:
     /// \brief The destructor.
     virtual ~AbstractMessageRenderer() {}
@@ -369,6 +378,23 @@ public:
 
     MessageRenderer();
 
+    /// \brief Constructor rendering into caller-provided storage.
+    ///
+    /// The renderer writes data into the given storage, e.g., an array on
+    /// the stack or a slot of a larger buffer for sending many messages at
+    /// once, so a message fitting in it is rendered without dynamic memory
+    /// allocation for the data.  The storage is never freed by the renderer.
+    /// If the rendered data doesn't fit, it's moved to memory allocated
+    /// internally, so \c getData() must be used to get the result in
+    /// either case.
+    ///
+    /// \throw std::bad_alloc Memory allocation for the internal resources
+    /// fails.
+    ///
+    /// \param storage The head of the storage.
+    /// \param len The length of the storage in bytes.
+    MessageRenderer(void* storage, size_t len);
+
     virtual ~MessageRenderer();
     virtual bool isTruncated() const;
     virtual size_t getLengthLimit() const;
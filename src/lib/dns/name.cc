@@ -14,6 +14,7 @@
 
 #include <cctype>
 #include <cassert>
+#include <cstring>
 #include <iterator>
 #include <functional>
 #include <vector>
@@ -126,15 +127,38 @@ typedef enum {
     ft_escdecimal               // parsing a '\DDD' octet.
 } ft_state;
 
-// The parser of name from a string. It is a template, because
-// some parameters are used with two different types, while others
-// are private type aliases.
-template<class Iterator, class Offsets, class Data>
+// A minimal sequence container on a fixed size array given by the caller,
+// used as the output of stringParse().  The caller must ensure the array is
+// large enough.
+class FixedBuffer {
+public:
+    FixedBuffer(uint8_t* data, size_t capacity) :
+        data_(data), capacity_(capacity), size_(0)
+    {}
+    void push_back(uint8_t c) {
+        assert(size_ < capacity_);
+        data_[size_++] = c;
+    }
+    uint8_t& at(size_t pos) {
+        assert(pos < size_);
+        return (data_[pos]);
+    }
+    uint8_t back() const { return (data_[size_ - 1]); }
+    size_t size() const { return (size_); }
+private:
+    uint8_t* const data_;
+    const size_t capacity_;
+    size_t size_;
+};
+
+// The parser of name from a string.  The name data and offsets are stored in
+// ndata and offsets, which must be able to store Name::MAX_WIRE and
+// Name::MAX_LABELS bytes respectively.
 void
-stringParse(Iterator s, Iterator send, bool downcase, Offsets& offsets,
-            Data& ndata)
+stringParse(const char* s, const char* send, bool downcase,
+            FixedBuffer& offsets, FixedBuffer& ndata)
 {
-    const Iterator orig_s(s);
+    const char* const orig_s(s);
     //
     // Initialize things to make the compiler happy; they're not required.
     //
@@ -151,9 +175,7 @@ stringParse(Iterator s, Iterator send, bool downcase, Offsets& offsets,
     ft_state state = ft_init;
 
     // Prepare the output buffers.
-    offsets.reserve(Name::MAX_LABELS);
     offsets.push_back(0);
-    ndata.reserve(Name::MAX_WIRE);
 
     // should we refactor this code using, e.g, the state pattern?  Probably
     // not at this point, as this is based on proved code (derived from BIND9)
@@ -195,7 +217,12 @@ stringParse(Iterator s, Iterator send, bool downcase, Offsets& offsets,
                 break;
             }
             state = ft_ordinary;
-            assert(ndata.size() < Name::MAX_WIRE);
+            // The label would need at least one more byte, and the name
+            // another one for the trailing dot.
+            if (ndata.size() == Name::MAX_WIRE) {
+                bundy_throw(TooLongName,
+                          "name is too long in " << string(orig_s, send));
+            }
             // FALLTHROUGH
         case ft_ordinary:
             if (c == '.') {
@@ -296,28 +323,69 @@ stringParse(Iterator s, Iterator send, bool downcase, Offsets& offsets,
 
 }
 
-Name::Name(const std::string &namestring, bool downcase) {
-    // Prepare inputs for the parser
-    const std::string::const_iterator s = namestring.begin();
-    const std::string::const_iterator send = namestring.end();
+namespace name {
+namespace internal {
+void
+parseText(const char* begin, const char* end, bool downcase, uint8_t* ndata,
+          uint8_t* offsets, size_t& length, size_t& labelcount)
+{
+    FixedBuffer ndata_buf(ndata, Name::MAX_WIRE);
+    FixedBuffer offsets_buf(offsets, Name::MAX_LABELS);
+    stringParse(begin, end, downcase, offsets_buf, ndata_buf);
+    length = ndata_buf.size();
+    labelcount = offsets_buf.size();
+    assert(labelcount > 0 && labelcount <= Name::MAX_LABELS);
+}
+} // end of internal
+} // end of name
 
-    // Prepare outputs
-    NameOffsets offsets;
-    NameString ndata;
+uint8_t*
+Name::setStorage(unsigned int length, unsigned int labelcount) {
+    const size_t size = length + labelcount;
+    uint8_t* storage = inline_storage_;
+    if (size > INLINE_STORAGE_SIZE) {
+        // Reuse the current allocated storage if it's large enough.
+        if (storage_ != inline_storage_ && length_ + labelcount_ >= size) {
+            storage = storage_;
+        } else {
+            storage = new uint8_t[size];
+        }
+    }
+    if (storage_ != inline_storage_ && storage_ != storage) {
+        delete[] storage_;
+    }
+    storage_ = storage;
+    length_ = length;
+    labelcount_ = labelcount;
+    return (storage_);
+}
 
-    // To the parsing
-    stringParse(s, send, downcase, offsets, ndata);
+Name&
+Name::operator=(const Name& source) {
+    if (this != &source) {
+        setData(source.storage_, source.length_, source.getOffsets(),
+                source.labelcount_);
+    }
+    return (*this);
+}
 
-    // And get the output
-    labelcount_ = offsets.size();
-    assert(labelcount_ > 0 && labelcount_ <= Name::MAX_LABELS);
-    ndata_.assign(ndata.data(), ndata.size());
-    length_ = ndata_.size();
-    offsets_.assign(offsets.begin(), offsets.end());
+Name::Name(const std::string &namestring, bool downcase) :
+    storage_(inline_storage_), length_(0), labelcount_(0)
+{
+    // The name data and offsets are first built in local buffers, so that
+    // the storage is prepared only once with the exact size.
+    uint8_t ndata[Name::MAX_WIRE];
+    uint8_t offsets[Name::MAX_LABELS];
+    size_t length;
+    size_t labelcount;
+    parseText(namestring.data(), namestring.data() + namestring.size(),
+              downcase, ndata, offsets, length, labelcount);
+    setData(ndata, length, offsets, labelcount);
 }
 
 Name::Name(const char* namedata, size_t data_len, const Name* origin,
-           bool downcase)
+           bool downcase) :
+    storage_(inline_storage_), length_(0), labelcount_(0)
 {
     // Check validity of data
     if (namedata == NULL || data_len == 0) {
@@ -332,51 +400,41 @@ Name::Name(const char* namedata, size_t data_len, const Name* origin,
         bundy_throw(MissingNameOrigin,
                   "No origin available and name is relative");
     }
-    // Prepare inputs for the parser
-    const char* end = namedata + data_len;
-
-    // Prepare outputs
-    NameOffsets offsets;
-    NameString ndata;
-
     // Do the actual parsing
-    stringParse(namedata, end, downcase, offsets, ndata);
-
-    // Get the output
-    labelcount_ = offsets.size();
-    assert(labelcount_ > 0 && labelcount_ <= Name::MAX_LABELS);
-    ndata_.assign(ndata.data(), ndata.size());
-    length_ = ndata_.size();
-    offsets_.assign(offsets.begin(), offsets.end());
-
-    if (!absolute) {
+    uint8_t ndata[Name::MAX_WIRE];
+    uint8_t offsets[Name::MAX_LABELS];
+    size_t length;
+    size_t labelcount;
+    parseText(namedata, namedata + data_len, downcase, ndata, offsets,
+              length, labelcount);
+
+    if (absolute) {
+        setData(ndata, length, offsets, labelcount);
+    } else {
         // Now, extend the data with the ones from origin. But eat the
         // last label (the empty one).
+        const size_t prefix_length = length - 1;
+        const size_t prefix_labels = labelcount - 1;
 
-        // Drop the last character of the data (the \0) and append a copy of
-        // the origin's data
-        ndata_.erase(ndata_.end() - 1);
-        ndata_.append(origin->ndata_);
-
-        // Do a similar thing with offsets. However, we need to move them
-        // so they point after the prefix we parsed before.
-        size_t offset = offsets_.back();
-        offsets_.pop_back();
-        size_t offset_count = offsets_.size();
-        offsets_.insert(offsets_.end(), origin->offsets_.begin(),
-                        origin->offsets_.end());
-        for (NameOffsets::iterator it(offsets_.begin() + offset_count);
-             it != offsets_.end(); ++it) {
-            *it += offset;
+        // Check the combined sizes are OK.
+        if (prefix_labels + origin->labelcount_ > Name::MAX_LABELS ||
+            prefix_length + origin->length_ > Name::MAX_WIRE) {
+            bundy_throw(TooLongName, "Combined name is too long");
         }
 
-        // Adjust sizes.
-        length_ = ndata_.size();
-        labelcount_ = offsets_.size();
-
-        // And check the sizes are OK.
-        if (labelcount_ > Name::MAX_LABELS || length_ > Name::MAX_WIRE) {
-            bundy_throw(TooLongName, "Combined name is too long");
+        // Drop the last character of the data (the \0) and append a copy of
+        // the origin's data.  Do a similar thing with offsets; we need to
+        // move those of the origin so they point after the prefix.
+        uint8_t* storage = setStorage(prefix_length + origin->length_,
+                                      prefix_labels + origin->labelcount_);
+        std::memcpy(storage, ndata, prefix_length);
+        std::memcpy(storage + prefix_length, origin->storage_,
+                    origin->length_);
+        uint8_t* new_offsets = storage + length_;
+        std::memcpy(new_offsets, offsets, prefix_labels);
+        const uint8_t* origin_offsets = origin->getOffsets();
+        for (size_t i = 0; i < origin->labelcount_; ++i) {
+            new_offsets[prefix_labels + i] = origin_offsets[i] + prefix_length;
         }
     }
 }
@@ -392,9 +450,14 @@ typedef enum {
 } fw_state;
 }
 
-Name::Name(InputBuffer& buffer, bool downcase) {
-    NameOffsets offsets;
-    offsets.reserve(Name::MAX_LABELS);
+Name::Name(InputBuffer& buffer, bool downcase) :
+    storage_(inline_storage_), length_(0), labelcount_(0)
+{
+    // The name data and offsets are first built in local buffers, so that
+    // the storage is prepared only once with the exact size.
+    uint8_t ndata[Name::MAX_WIRE];
+    uint8_t offsets[Name::MAX_LABELS];
+    unsigned int nlabels = 0;
 
     /*
      * Initialize things to make the compiler happy; they're not required.
@@ -433,13 +496,13 @@ Name::Name(InputBuffer& buffer, bool downcase) {
         switch (state) {
         case fw_start:
             if (c <= MAX_LABELLEN) {
-                offsets.push_back(nused);
                 if (nused + c + 1 > Name::MAX_WIRE) {
                     bundy_throw(DNSMessageFORMERR, "wire name is too long: "
                               << nused + c + 1 << " bytes");
                 }
+                offsets[nlabels++] = nused;
+                ndata[nused] = c;
                 nused += c + 1;
-                ndata_.push_back(c);
                 if (c == 0) {
                     done = true;
                 }
@@ -462,7 +525,7 @@ Name::Name(InputBuffer& buffer, bool downcase) {
             if (downcase) {
                 c = maptolower[c];
             }
-            ndata_.push_back(c);
+            ndata[nused - n] = c;
             if (--n == 0) {
                 state = fw_start;
             }
@@ -493,15 +556,13 @@ Name::Name(InputBuffer& buffer, bool downcase) {
         bundy_throw(DNSMessageFORMERR, "incomplete wire-format name");
     }
 
-    labelcount_ = offsets.size();
-    length_ = nused;
-    offsets_.assign(offsets.begin(), offsets.end());
+    setData(ndata, nused, offsets, nlabels);
     buffer.setPosition(pos_begin + cused);
 }
 
 void
 Name::toWire(OutputBuffer& buffer) const {
-    buffer.writeData(ndata_.data(), ndata_.size());
+    buffer.writeData(storage_, length_);
 }
 
 void
@@ -528,25 +589,10 @@ Name::equals(const Name& other) const {
         return (false);
     }
 
-    for (unsigned int l = labelcount_, pos = 0; l > 0; --l) {
-        uint8_t count = ndata_[pos];
-        if (count != other.ndata_[pos]) {
-            return (false);
-        }
-        ++pos;
-
-        while (count-- > 0) {
-            uint8_t label1 = ndata_[pos];
-            uint8_t label2 = other.ndata_[pos];
-
-            if (maptolower[label1] != maptolower[label2]) {
-                return (false);
-            }
-            ++pos;
-        }
-    }
-
-    return (true);
+    // Label length bytes are never affected by maptolower, so comparing
+    // the entire data at once is equivalent to comparing label by label.
+    return (name::internal::compareLabelData(storage_, other.storage_,
+                                             length_, false) == 0);
 }
 
 bool
@@ -571,7 +617,7 @@ Name::gthan(const Name& other) const {
 
 bool
 Name::isWildcard() const {
-    return (length_ >= 2 && ndata_[0] == 1 && ndata_[1] == '*');
+    return (length_ >= 2 && storage_[0] == 1 && storage_[1] == '*');
 }
 
 Name
@@ -584,28 +630,25 @@ Name::concatenate(const Name& suffix) const {
         bundy_throw(TooLongName, "names are too long to concatenate");
     }
 
+    unsigned int labels = labelcount_ + suffix.labelcount_ - 1;
+    assert(labels <= Name::MAX_LABELS);
+
     Name retname;
-    retname.ndata_.reserve(length);
-    retname.ndata_.assign(ndata_, 0, length_ - 1);
-    retname.ndata_.insert(retname.ndata_.end(),
-                          suffix.ndata_.begin(), suffix.ndata_.end());
-    assert(retname.ndata_.size() == length);
-    retname.length_ = length;
+    uint8_t* ndata = retname.setStorage(length, labels);
+    std::memcpy(ndata, storage_, length_ - 1);
+    std::memcpy(ndata + length_ - 1, suffix.storage_, suffix.length_);
 
     //
-    // Setup the offsets vector.  Copy the offsets of this (prefix) name,
+    // Setup the offsets.  Copy the offsets of this (prefix) name,
     // excluding that for the trailing dot, and append the offsets of the
     // suffix name with the additional offset of the length of the prefix.
     //
-    unsigned int labels = labelcount_ + suffix.labelcount_ - 1;
-    assert(labels <= Name::MAX_LABELS);
-    retname.offsets_.reserve(labels);
-    retname.offsets_.assign(&offsets_[0], &offsets_[0] + labelcount_ - 1);
-    transform(suffix.offsets_.begin(), suffix.offsets_.end(),
-              back_inserter(retname.offsets_),
-              bind2nd(plus<char>(), length_ - 1));
-    assert(retname.offsets_.size() == labels);
-    retname.labelcount_ = labels;
+    uint8_t* offsets = ndata + length;
+    std::memcpy(offsets, getOffsets(), labelcount_ - 1);
+    const uint8_t* suffix_offsets = suffix.getOffsets();
+    for (unsigned int i = 0; i < suffix.labelcount_; ++i) {
+        offsets[labelcount_ - 1 + i] = suffix_offsets[i] + length_ - 1;
+    }
 
     return (retname);
 }
@@ -614,27 +657,23 @@ Name
 Name::reverse() const {
     Name retname;
     //
-    // Set up offsets: The size of the string and number of labels will
+    // Set up storage: The size of the data and number of labels will
     // be the same in as in the original.
     //
-    retname.offsets_.reserve(labelcount_);
-    retname.ndata_.reserve(length_);
+    uint8_t* ndata = retname.setStorage(length_, labelcount_);
+    uint8_t* offsets = ndata + length_;
 
     // Copy the original name, label by label, from tail to head.
-    NameOffsets::const_reverse_iterator rit0 = offsets_.rbegin();
-    NameOffsets::const_reverse_iterator rit1 = rit0 + 1;
-    NameString::const_iterator n0 = ndata_.begin();
-    retname.offsets_.push_back(0);
-    while (rit1 != offsets_.rend()) {
-        retname.ndata_.append(n0 + *rit1, n0 + *rit0);
-        retname.offsets_.push_back(retname.ndata_.size());
-        ++rit0;
-        ++rit1;
+    const uint8_t* src_offsets = getOffsets();
+    unsigned int pos = 0;
+    offsets[0] = 0;
+    for (unsigned int i = labelcount_ - 1; i > 0; --i) {
+        const unsigned int label_len = src_offsets[i] - src_offsets[i - 1];
+        std::memcpy(ndata + pos, storage_ + src_offsets[i - 1], label_len);
+        pos += label_len;
+        offsets[labelcount_ - i] = pos;
     }
-    retname.ndata_.push_back(0);
-
-    retname.labelcount_ = labelcount_;
-    retname.length_ = length_;
+    ndata[pos] = 0;
 
     return (retname);
 }
@@ -651,27 +690,26 @@ Name::split(const unsigned int first, const unsigned int n) const {
     unsigned int newlabels = (first + n == labelcount_) ? n : n + 1;
 
     //
-    // Set up offsets: copy the corresponding range of the original offsets
-    // with subtracting an offset of the prefix length.
-    //
-    retname.offsets_.reserve(newlabels);
-    transform(offsets_.begin() + first, offsets_.begin() + first + newlabels,
-              back_inserter(retname.offsets_),
-              bind2nd(plus<char>(), -offsets_[first]));
-
-    //
-    // Set up the new name.  At this point the tail of the new offsets specifies
+    // Set up the new name.  The offset of the last new label specifies
     // the position of the trailing dot, which should be equal to the length of
     // the extracted portion excluding the dot.  First copy that part from the
     // original name, and append the trailing dot explicitly.
     //
-    retname.ndata_.reserve(retname.offsets_.back() + 1);
-    retname.ndata_.assign(ndata_, offsets_[first], retname.offsets_.back());
-    retname.ndata_.push_back(0);
+    const uint8_t* src_offsets = getOffsets();
+    const unsigned int length =
+        src_offsets[first + newlabels - 1] - src_offsets[first] + 1;
+    uint8_t* ndata = retname.setStorage(length, newlabels);
+    std::memcpy(ndata, storage_ + src_offsets[first], length - 1);
+    ndata[length - 1] = 0;
 
-    retname.length_ = retname.ndata_.size();
-    retname.labelcount_ = retname.offsets_.size();
-    assert(retname.labelcount_ == newlabels);
+    //
+    // Set up offsets: copy the corresponding range of the original offsets
+    // with subtracting an offset of the prefix length.
+    //
+    uint8_t* offsets = ndata + length;
+    for (unsigned int i = 0; i < newlabels; ++i) {
+        offsets[i] = src_offsets[first + i] - src_offsets[first];
+    }
 
     return (retname);
 }
@@ -698,13 +736,12 @@ Name::downcase() {
 
         // we assume a valid name, and do abort() if the assumption fails
         // rather than throwing an exception.
-        unsigned int count = ndata_.at(pos++);
+        unsigned int count = storage_[pos++];
         assert(count <= MAX_LABELLEN);
         assert(nlen >= count);
 
         while (count > 0) {
-            ndata_.at(pos) =
-                maptolower[ndata_.at(pos)];
+            storage_[pos] = maptolower[storage_[pos]];
             ++pos;
             --nlen;
             --count;
@@ -17,6 +17,7 @@
 
 #include <stdint.h>
 
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -193,15 +194,15 @@ private:
 /// access to various properties of a name, etc.
 ///
 /// Notes to developers: Internally, a name object maintains the name %data
-/// in wire format as an instance of \c std::string.  Since many string
-/// implementations adopt copy-on-write %data sharing, we expect this approach
-/// will make copying a name less expensive in typical cases.  If this is
-/// found to be a significant performance bottleneck later, we may reconsider
-/// the internal representation or perhaps the API.
+/// in wire format, followed by the offsets described below, in a single
+/// array of bytes.  The array is stored in the object itself if it's not
+/// larger than \c INLINE_STORAGE_SIZE, which is the case for most names in
+/// practice, so constructing or copying such names doesn't involve dynamic
+/// memory allocation; otherwise it's allocated in the heap.
 ///
-/// A name object also maintains a vector of offsets (\c offsets_ member),
+/// A name object also maintains an array of offsets (\c getOffsets()),
 /// each of which is the offset to a label of the name: The n-th element of
-/// the vector specifies the offset to the n-th label.  For example, if the
+/// the array specifies the offset to the n-th label.  For example, if the
 /// object represents "www.example.com", the elements of the offsets vector
 /// are 0, 4, 12, and 16.  Note that the offset to the trailing dot (16) is
 /// included.  In the BIND9 DNS library from which this implementation is
@@ -230,8 +231,8 @@ private:
 ///
 class Name {
     // LabelSequences use knowledge about the internal data structure
-    // of this class for efficiency (they use the offsets_ vector and
-    // the ndata_ string)
+    // of this class for efficiency (they use the storage_ array and
+    // the offsets in it)
     friend class LabelSequence;
 
     ///
@@ -239,18 +240,13 @@ class Name {
     ///
     //@{
 private:
-    /// \brief Name data string
-    typedef std::basic_string<uint8_t> NameString;
-    /// \brief Name offsets type
-    typedef std::vector<uint8_t> NameOffsets;
-
     /// The default constructor
     ///
     /// This is used internally in the class implementation, but at least at
     /// the moment defined as private because it will construct an incomplete
     /// object in that it doesn't have any labels.  We may reconsider this
     /// design choice as we see more applications of the class.
-    Name() : length_(0), labelcount_(0) {}
+    Name() : storage_(inline_storage_), length_(0), labelcount_(0) {}
 public:
     /// Constructor from a string
     ///
@@ -311,11 +307,28 @@ public:
     /// \param buffer A buffer storing the wire format %data.
     /// \param downcase Whether to convert upper case alphabets to lower case.
     explicit Name(bundy::util::InputBuffer& buffer, bool downcase = false);
+
+    /// \brief Copy constructor.
     ///
-    /// We use the default copy constructor intentionally.
-    //@}
-    /// We use the default copy assignment operator intentionally.
+    /// It involves dynamic memory allocation only for long names (see the
+    /// class description).
     ///
+    /// \throw std::bad_alloc Memory allocation for a long name fails.
+    Name(const Name& source);
+
+    /// \brief Copy assignment operator.
+    ///
+    /// \throw std::bad_alloc Memory allocation for a long name fails.  In
+    /// that case this object isn't changed.
+    Name& operator=(const Name& source);
+
+    /// \brief Destructor.
+    ~Name() {
+        if (storage_ != inline_storage_) {
+            delete[] storage_;
+        }
+    }
+    //@}
 
     ///
     /// \name Getter Methods
@@ -356,7 +369,7 @@ public:
         if (pos >= length_) {
             bundy_throw(OutOfRange, "Out of range access in Name::at()");
         }
-        return (ndata_[pos]);
+        return (storage_[pos]);
     }
 
     /// \brief Gets the length of the <code>Name</code> in its wire format.
@@ -725,13 +738,59 @@ public:
     static const Name& ROOT_NAME();
     //@}
 
+    /// \brief The size of the name data and offsets that can be stored in
+    /// the object itself.
+    ///
+    /// This is sufficient for a name of 64 bytes and 16 labels, such as
+    /// "www.example.com" (17 bytes and 4 labels) or even a typical reverse
+    /// mapping name for an IPv4 address (30 bytes and 7 labels).
+    static const size_t INLINE_STORAGE_SIZE = 80;
+
 private:
-    NameString ndata_;
-    NameOffsets offsets_;
+    /// \brief Return the offsets of the labels in the name data.
+    const uint8_t* getOffsets() const { return (storage_ + length_); }
+
+    /// \brief Prepare the storage for the data of the given length and
+    /// number of labels.
+    ///
+    /// It sets \c length_ and \c labelcount_, and returns the storage,
+    /// where the caller is expected to store the name data followed by the
+    /// offsets.  The previous data are discarded.
+    ///
+    /// \throw std::bad_alloc Memory allocation fails.  In that case this
+    /// object isn't changed.
+    uint8_t* setStorage(unsigned int length, unsigned int labelcount);
+
+    /// \brief Set the name data and offsets, copying them via
+    /// \c setStorage().
+    void setData(const uint8_t* ndata, unsigned int length,
+                 const uint8_t* offsets, unsigned int labelcount)
+    {
+        uint8_t* storage = setStorage(length, labelcount);
+        std::memcpy(storage, ndata, length);
+        std::memcpy(storage + length, offsets, labelcount);
+    }
+
+    // The name data followed by the offsets.  It points to inline_storage_
+    // if they fit there; otherwise it's allocated by new[].
+    uint8_t* storage_;
     unsigned int length_;
     unsigned int labelcount_;
+    uint8_t inline_storage_[INLINE_STORAGE_SIZE];
 };
 
+inline
+Name::Name(const Name& source) :
+    storage_(inline_storage_), length_(source.length_),
+    labelcount_(source.labelcount_)
+{
+    const size_t size = length_ + labelcount_;
+    if (size > INLINE_STORAGE_SIZE) {
+        storage_ = new uint8_t[size];
+    }
+    std::memcpy(storage_, source.storage_, size);
+}
+
 inline const Name&
 Name::ROOT_NAME() {
     static Name root_name(".");
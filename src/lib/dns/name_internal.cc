@@ -0,0 +1,194 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+#include <dns/name_internal.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    defined(__SSE2__)
+#define LABEL_COMPARE_SSE2 1
+#include <emmintrin.h>
+#if defined(__clang__) || (__GNUC__ > 4) || \
+    (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+// AVX2 code is compiled with the target attribute and is only used if the
+// running CPU supports it.
+#define LABEL_COMPARE_AVX2 1
+#include <immintrin.h>
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define LABEL_COMPARE_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace bundy {
+namespace dns {
+namespace name {
+namespace internal {
+
+namespace {
+inline int
+compareScalar(const uint8_t* data1, const uint8_t* data2, size_t len,
+              bool case_sensitive)
+{
+    for (size_t i = 0; i < len; ++i) {
+        const int diff = case_sensitive ?
+            static_cast<int>(data1[i]) - static_cast<int>(data2[i]) :
+            static_cast<int>(maptolower[data1[i]]) -
+            static_cast<int>(maptolower[data2[i]]);
+        if (diff != 0) {
+            return (diff);
+        }
+    }
+    return (0);
+}
+
+// Return the difference at the first differing position in the 16 or 32
+// bytes whose equality mask (1 bit per byte, set if equal) is given.
+inline int
+diffAt(const uint8_t* data1, const uint8_t* data2, uint32_t eq_mask,
+       bool case_sensitive)
+{
+    const unsigned int pos = __builtin_ctz(~eq_mask);
+    return (compareScalar(data1 + pos, data2 + pos, 1, case_sensitive));
+}
+
+#ifdef LABEL_COMPARE_SSE2
+// Convert 'A'-'Z' in the vector to lower cases, as maptolower does.
+// Adding (0x80 - 'A') moves 'A'-'Z' to the signed range [-128, -103],
+// which can be identified by a single signed comparison.
+inline __m128i
+toLower128(__m128i v) {
+    const __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8(0x80 - 'A'));
+    const __m128i is_upper = _mm_cmplt_epi8(shifted,
+                                            _mm_set1_epi8(-128 + 26));
+    return (_mm_add_epi8(v, _mm_and_si128(is_upper, _mm_set1_epi8(0x20))));
+}
+
+int
+compareSSE2(const uint8_t* data1, const uint8_t* data2, size_t len,
+            bool case_sensitive)
+{
+    for (; len >= 16; len -= 16, data1 += 16, data2 += 16) {
+        __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data1));
+        __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data2));
+        if (!case_sensitive) {
+            v1 = toLower128(v1);
+            v2 = toLower128(v2);
+        }
+        const uint32_t eq_mask =
+            _mm_movemask_epi8(_mm_cmpeq_epi8(v1, v2)) | 0xffff0000;
+        if (eq_mask != 0xffffffff) {
+            return (diffAt(data1, data2, eq_mask, case_sensitive));
+        }
+    }
+    return (compareScalar(data1, data2, len, case_sensitive));
+}
+#endif
+
+#ifdef LABEL_COMPARE_AVX2
+__attribute__((target("avx2"))) int
+compareAVX2(const uint8_t* data1, const uint8_t* data2, size_t len,
+            bool case_sensitive)
+{
+    for (; len >= 32; len -= 32, data1 += 32, data2 += 32) {
+        __m256i v1 =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data1));
+        __m256i v2 =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data2));
+        if (!case_sensitive) {
+            const __m256i bias = _mm256_set1_epi8(0x80 - 'A');
+            const __m256i limit = _mm256_set1_epi8(-128 + 26);
+            const __m256i diff = _mm256_set1_epi8(0x20);
+            v1 = _mm256_add_epi8(v1, _mm256_and_si256(
+                                     _mm256_cmpgt_epi8(
+                                         limit, _mm256_add_epi8(v1, bias)),
+                                     diff));
+            v2 = _mm256_add_epi8(v2, _mm256_and_si256(
+                                     _mm256_cmpgt_epi8(
+                                         limit, _mm256_add_epi8(v2, bias)),
+                                     diff));
+        }
+        const uint32_t eq_mask =
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, v2));
+        if (eq_mask != 0xffffffff) {
+            return (diffAt(data1, data2, eq_mask, case_sensitive));
+        }
+    }
+    // Leave the AVX state explicitly; the compiler doesn't always do it
+    // before the tail call, which would make the SSE code very slow.
+    _mm256_zeroupper();
+    return (compareSSE2(data1, data2, len, case_sensitive));
+}
+
+bool
+detectAVX2() {
+    __builtin_cpu_init();
+    return (__builtin_cpu_supports("avx2"));
+}
+
+// This is dynamically initialized, so it could still be false while other
+// static objects are being initialized.  That's okay as it only means the
+// SSE2 version is used until then.
+const bool use_avx2 = detectAVX2();
+#endif
+
+#ifdef LABEL_COMPARE_NEON
+inline uint8x16_t
+toLower128(uint8x16_t v) {
+    const uint8x16_t is_upper =
+        vcltq_u8(vsubq_u8(v, vdupq_n_u8('A')), vdupq_n_u8(26));
+    return (vaddq_u8(v, vandq_u8(is_upper, vdupq_n_u8(0x20))));
+}
+
+int
+compareNEON(const uint8_t* data1, const uint8_t* data2, size_t len,
+            bool case_sensitive)
+{
+    for (; len >= 16; len -= 16, data1 += 16, data2 += 16) {
+        uint8x16_t v1 = vld1q_u8(data1);
+        uint8x16_t v2 = vld1q_u8(data2);
+        if (!case_sensitive) {
+            v1 = toLower128(v1);
+            v2 = toLower128(v2);
+        }
+        if (vminvq_u8(vceqq_u8(v1, v2)) != 0xff) {
+            // The difference is somewhere in these 16 bytes.
+            return (compareScalar(data1, data2, 16, case_sensitive));
+        }
+    }
+    return (compareScalar(data1, data2, len, case_sensitive));
+}
+#endif
+} // unnamed namespace
+
+int
+compareLongLabelData(const uint8_t* data1, const uint8_t* data2, size_t len,
+                     bool case_sensitive)
+{
+#if defined(LABEL_COMPARE_AVX2)
+    if (use_avx2) {
+        return (compareAVX2(data1, data2, len, case_sensitive));
+    }
+    return (compareSSE2(data1, data2, len, case_sensitive));
+#elif defined(LABEL_COMPARE_SSE2)
+    return (compareSSE2(data1, data2, len, case_sensitive));
+#elif defined(LABEL_COMPARE_NEON)
+    return (compareNEON(data1, data2, len, case_sensitive));
+#else
+    return (compareScalar(data1, data2, len, case_sensitive));
+#endif
+}
+
+} // end of internal
+} // end of name
+} // end of dns
+} // end of bundy
@@ -27,11 +27,74 @@
 // we'll keep it semi-private (note also that except for very performance
 // sensitive applications the standard std::tolower() function should be just
 // sufficient).
+
+#include <cstddef>
+
+#include <stdint.h>
+
 namespace bundy {
 namespace dns {
 namespace name {
 namespace internal {
 extern const uint8_t maptolower[];
+
+/// \brief Parse a textual domain name into the given arrays.
+///
+/// This is the parser of the \c Name constructors from text, also used by
+/// \c LabelSequence to parse a name into caller supplied storage.  The
+/// text is always considered an absolute name.  \c ndata and \c offsets
+/// must be able to store \c Name::MAX_WIRE and \c Name::MAX_LABELS bytes
+/// respectively; the length of the name data and the number of labels are
+/// set in \c length and \c labelcount.
+///
+/// \throw NameParserException or its descendants The text is not a valid
+/// name.
+void parseText(const char* begin, const char* end, bool downcase,
+               uint8_t* ndata, uint8_t* offsets, size_t& length,
+               size_t& labelcount);
+
+/// \brief Vectorized version of \c compareLabelData().
+///
+/// Normally it's only called via \c compareLabelData() for long data.
+int compareLongLabelData(const uint8_t* data1, const uint8_t* data2,
+                         size_t len, bool case_sensitive);
+
+/// \brief Compare two label data of the same length.
+///
+/// It compares \c len bytes of \c data1 and \c data2 from the beginning,
+/// and returns the difference of the first pair of differing bytes
+/// (that of \c data1 minus that of \c data2), or 0 if they are all equal.
+/// If \c case_sensitive is false, each byte is converted through
+/// \c maptolower before comparison, so the result is always identical to
+/// a naive loop of <code>maptolower[data1[i]] - maptolower[data2[i]]</code>.
+///
+/// This is the innermost loop of name comparison.  Data of 16 bytes or
+/// longer are compared by \c compareLongLabelData(), which is vectorized
+/// where the platform supports it (SSE2 or AVX2, the latter selected at
+/// run time, and NEON); shorter ones are compared inline, as most labels
+/// are shorter than a single vector, for which the setup cost of vector
+/// operations doesn't pay.  Label length bytes can be included in the data
+/// as they never fall in the range of upper case letters.
+///
+/// \throw None
+inline int
+compareLabelData(const uint8_t* data1, const uint8_t* data2, size_t len,
+                 bool case_sensitive)
+{
+    if (len >= 16) {
+        return (compareLongLabelData(data1, data2, len, case_sensitive));
+    }
+    for (size_t i = 0; i < len; ++i) {
+        const int diff = case_sensitive ?
+            static_cast<int>(data1[i]) - static_cast<int>(data2[i]) :
+            static_cast<int>(maptolower[data1[i]]) -
+            static_cast<int>(maptolower[data2[i]]);
+        if (diff != 0) {
+            return (diff);
+        }
+    }
+    return (0);
+}
 } // end of internal
 } // end of name
 } // end of dns
@@ -79,6 +79,25 @@ public:
         }
 
         SHA1Reset(&sha1_ctx_);
+
+        // Each additional iteration hashes the previous digest followed by
+        // the salt.  If it fits in a single SHA1 block, the salt and the
+        // padding are the same for all iterations (and all names), so we
+        // prepare such a block here and only replace the digest part in
+        // calculateForWiredata().
+        const size_t iter_length = SHA1_HASHSIZE + salt_length_;
+        use_iter_block_ = (iter_length <= SHA1_BLOCKSIZE - 9);
+        if (use_iter_block_) {
+            std::memset(iter_block_, 0, sizeof(iter_block_));
+            if (salt_length_ > 0) {
+                std::memcpy(&iter_block_[SHA1_HASHSIZE], salt_data_,
+                            salt_length_);
+            }
+            iter_block_[iter_length] = 0x80;
+            const uint32_t bits = iter_length * 8;
+            iter_block_[SHA1_BLOCKSIZE - 2] = (bits >> 8) & 0xff;
+            iter_block_[SHA1_BLOCKSIZE - 1] = bits & 0xff;
+        }
     }
 
     virtual ~NSEC3HashRFC5155() {
@@ -107,6 +126,12 @@ private:
     mutable SHA1Context sha1_ctx_;
     mutable vector<uint8_t> digest_;
     mutable OutputBuffer obuf_;
+
+    // The pre-padded block for the additional iterations (if the digest
+    // and the salt fit in one block).  Only the first SHA1_HASHSIZE bytes
+    // change over calls.
+    bool use_iter_block_;
+    mutable uint8_t iter_block_[SHA1_BLOCKSIZE];
 };
 
 inline void
@@ -146,11 +171,20 @@ NSEC3HashRFC5155::calculateForWiredata(const uint8_t* data,
     uint8_t* const digest = &digest_[0];
     assert(digest_.size() == SHA1_HASHSIZE);
 
-    iterateSHA1(&sha1_ctx_, name_buf, length,
-                salt_data_, salt_length_, digest);
-    for (unsigned int n = 0; n < iterations_; ++n) {
-        iterateSHA1(&sha1_ctx_, digest, SHA1_HASHSIZE,
+    if (use_iter_block_) {
+        iterateSHA1(&sha1_ctx_, name_buf, length,
+                    salt_data_, salt_length_, iter_block_);
+        for (unsigned int n = 0; n < iterations_; ++n) {
+            SHA1HashBlock(iter_block_, iter_block_);
+        }
+        std::memcpy(digest, iter_block_, SHA1_HASHSIZE);
+    } else {
+        iterateSHA1(&sha1_ctx_, name_buf, length,
                     salt_data_, salt_length_, digest);
+        for (unsigned int n = 0; n < iterations_; ++n) {
+            iterateSHA1(&sha1_ctx_, digest, SHA1_HASHSIZE,
+                        salt_data_, salt_length_, digest);
+        }
     }
 
     return (encodeBase32Hex(digest_));
@@ -235,6 +269,16 @@ NSEC3Hash::create(uint8_t algorithm, uint16_t iterations,
                                           salt_data, salt_length));
 }
 
+void
+NSEC3Hash::calculateBatch(const vector<LabelSequence>& names,
+                          vector<string>& hashes) const
+{
+    hashes.resize(names.size());
+    for (size_t i = 0; i < names.size(); ++i) {
+        hashes[i] = calculate(names[i]);
+    }
+}
+
 NSEC3Hash*
 DefaultNSEC3HashCreator::create(const generic::NSEC3PARAM& param) const {
     const vector<uint8_t>& salt = param.getSalt();
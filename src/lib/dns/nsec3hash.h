@@ -157,6 +157,24 @@ public:
     /// \return Base32hex-encoded string of the hash value.
     virtual std::string calculate(const LabelSequence& ls) const = 0;
 
+    /// \brief Calculate the NSEC3 hashes of multiple names at once.
+    ///
+    /// This method calculates the NSEC3 hash value for each of the given
+    /// absolute label sequences, and stores the base32hex-encoded results
+    /// in \c hashes in the same order.  Any existing content of \c hashes
+    /// is replaced.  Searches for the closest encloser, which need to hash
+    /// several ancestors of a name, are the main users of this method.
+    ///
+    /// The default implementation simply calls the \c LabelSequence variant
+    /// of \c calculate() for each name; derived classes can override it
+    /// with one that processes the names more efficiently as a batch.
+    ///
+    /// \param names The absolute label sequences for which the hash values
+    /// are to be calculated.
+    /// \param hashes A vector to store the calculated hash values.
+    virtual void calculateBatch(const std::vector<LabelSequence>& names,
+                                std::vector<std::string>& hashes) const;
+
     /// \brief Match given NSEC3 parameters with that of the hash.
     ///
     /// This method compares NSEC3 parameters used for hash calculation
@@ -0,0 +1,166 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <dns/query_parser.h>
+#include <dns/opcode.h>
+
+namespace bundy {
+namespace dns {
+
+namespace {
+// Wire format constants.  See also message.cc and edns.cc.
+const size_t HEADERLEN = 12;
+const uint16_t FLAG_QR = 0x8000;
+const uint16_t OPCODE_MASK = 0x7800;
+const unsigned int OPCODE_SHIFT = 11;
+const size_t RR_FIXED_LEN = 10; // type, class, TTL and RDLENGTH
+const uint32_t EDNS_VERSION_MASK = 0x00ff0000;
+const unsigned int EDNS_VERSION_SHIFT = 16;
+const uint32_t EDNS_FLAG_DO = 0x00008000;
+const uint8_t COMPRESS_POINTER_MARK8 = 0xc0;
+
+inline uint16_t
+readUint16(const uint8_t* cp) {
+    return ((cp[0] << 8) | cp[1]);
+}
+
+inline uint32_t
+readUint32(const uint8_t* cp) {
+    return ((static_cast<uint32_t>(cp[0]) << 24) | (cp[1] << 16) |
+            (cp[2] << 8) | cp[3]);
+}
+
+// Skip an owner name of an RR, which may be compressed, and return the
+// position after it.  Returns 0 on failure.
+size_t
+skipName(const uint8_t* data, size_t len, size_t pos) {
+    const size_t start = pos;
+    while (pos < len) {
+        const uint8_t c = data[pos];
+        if (c == 0) {
+            return (pos + 1);
+        } else if ((c & COMPRESS_POINTER_MARK8) == COMPRESS_POINTER_MARK8) {
+            return (pos + 2 <= len ? pos + 2 : 0);
+        } else if (c > Name::MAX_LABELLEN) {
+            return (0);         // unsupported extended label type
+        }
+        pos += c + 1;
+        if (pos - start > Name::MAX_WIRE) {
+            return (0);
+        }
+    }
+    return (0);
+}
+}
+
+QueryParser::QueryParser() :
+    qid_(0), flags_(0), qname_data_(NULL), qname_labels_(0),
+    qtype_(0), qclass_(0), has_edns_(false), edns_version_(0),
+    udp_size_(Message::DEFAULT_MAX_UDPSIZE), dnssec_ok_(false), tsig_pos_(0)
+{}
+
+bool
+QueryParser::parse(const void* data, size_t len) {
+    const uint8_t* const cp = static_cast<const uint8_t*>(data);
+
+    has_edns_ = false;
+    edns_version_ = 0;
+    udp_size_ = Message::DEFAULT_MAX_UDPSIZE;
+    dnssec_ok_ = false;
+    tsig_pos_ = 0;
+
+    // Header.  QDCOUNT must be 1, and ANCOUNT and NSCOUNT 0.
+    if (len < HEADERLEN) {
+        return (false);
+    }
+    qid_ = readUint16(cp);
+    flags_ = readUint16(cp + 2);
+    if ((flags_ & FLAG_QR) != 0 ||
+        ((flags_ & OPCODE_MASK) >> OPCODE_SHIFT) != Opcode::QUERY_CODE ||
+        readUint16(cp + 4) != 1 || readUint16(cp + 6) != 0 ||
+        readUint16(cp + 8) != 0) {
+        return (false);
+    }
+    const unsigned int arcount = readUint16(cp + 10);
+    if (arcount > 2) {
+        return (false);
+    }
+
+    // Question.  The name is recorded with the label offsets; compression
+    // pointers aren't expected at this point and not supported.
+    size_t pos = HEADERLEN;
+    qname_data_ = cp + pos;
+    qname_labels_ = 0;
+    while (true) {
+        if (pos >= len || qname_labels_ >= Name::MAX_LABELS) {
+            return (false);
+        }
+        const uint8_t c = cp[pos];
+        if (c > Name::MAX_LABELLEN) {
+            return (false);
+        }
+        qname_offsets_[qname_labels_++] = pos - HEADERLEN;
+        pos += c + 1;
+        if (pos - HEADERLEN > Name::MAX_WIRE) {
+            return (false);
+        }
+        if (c == 0) {
+            break;
+        }
+    }
+    if (pos + 4 > len) {
+        return (false);
+    }
+    qtype_ = RRType(readUint16(cp + pos));
+    qclass_ = RRClass(readUint16(cp + pos + 2));
+    pos += 4;
+
+    // Additional section: OPT and/or TSIG (which must be the last one).
+    for (unsigned int i = 0; i < arcount; ++i) {
+        const size_t rr_pos = pos;
+        const bool root_owner = (pos < len && cp[pos] == 0);
+        pos = skipName(cp, len, pos);
+        if (pos == 0 || pos + RR_FIXED_LEN > len) {
+            return (false);
+        }
+        const uint16_t rrtype = readUint16(cp + pos);
+        const uint16_t rrclass = readUint16(cp + pos + 2);
+        const uint32_t ttl = readUint32(cp + pos + 4);
+        const size_t rdlen = readUint16(cp + pos + 8);
+        pos += RR_FIXED_LEN + rdlen;
+        if (pos > len) {
+            return (false);
+        }
+        if (rrtype == RRType::OPT().getCode()) {
+            if (has_edns_ || !root_owner) {
+                return (false);
+            }
+            has_edns_ = true;
+            edns_version_ = (ttl & EDNS_VERSION_MASK) >> EDNS_VERSION_SHIFT;
+            udp_size_ = rrclass;
+            dnssec_ok_ = ((ttl & EDNS_FLAG_DO) != 0);
+        } else if (rrtype == RRType::TSIG().getCode() && i == arcount - 1) {
+            tsig_pos_ = rr_pos;
+        } else {
+            return (false);
+        }
+    }
+
+    return (pos == len);
+}
+
+} // namespace dns
+} // namespace bundy
@@ -0,0 +1,141 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef DNS_QUERY_PARSER_H
+#define DNS_QUERY_PARSER_H 1
+
+#include <dns/labelsequence.h>
+#include <dns/message.h>
+#include <dns/name.h>
+#include <dns/rrclass.h>
+#include <dns/rrtype.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace dns {
+
+/// \brief A lightweight parser of standard DNS queries.
+///
+/// \c Message::fromWire() builds \c Question, \c RRset and \c Rdata objects
+/// for everything in the message, which involves a number of memory
+/// allocations.  Many applications (such as authoritative servers), however,
+/// only need the question and a few parameters of EDNS and TSIG for most
+/// queries.  This class examines such "simple" queries in place, without
+/// creating any object on the heap; the query name is available as a
+/// \c LabelSequence referring to the given wire data.
+///
+/// This parser accepts a message only if all of the following hold:
+/// - It's a query (QR bit cleared) of opcode QUERY
+/// - It has exactly one question and no answer or authority RRs
+/// - The query name is not compressed
+/// - The additional section contains at most one OPT RR, whose owner name
+///   is the root, and at most one TSIG RR, which must be the last RR
+/// - The whole data is consumed by these components
+///
+/// \c parse() returns false for anything else, in which case the
+/// application is expected to fall back to \c Message::fromWire(), which
+/// handles the general case and reports errors in detail.  Note that this
+/// class doesn't check semantics beyond the above points: for example, the
+/// EDNS version is reported as is, and the TSIG RR is only located, not
+/// verified.
+///
+/// The same object can be reused for parsing multiple messages.  The
+/// accessors are only meaningful after a successful \c parse().
+class QueryParser : boost::noncopyable {
+public:
+    /// \brief Constructor.
+    QueryParser();
+
+    /// \brief Parse a wire-format query.
+    ///
+    /// The data must remain valid and unmodified as long as the result of
+    /// \c getQName() is used.
+    ///
+    /// \param data Pointer to the wire-format message.
+    /// \param len The length of \c data.
+    /// \return true if the message is a simple query as described in the
+    /// class description; false otherwise.
+    /// \throw None
+    bool parse(const void* data, size_t len);
+
+    /// \brief Return the query ID.
+    qid_t getQid() const { return (qid_); }
+
+    /// \brief Return whether the given header flag is set.
+    bool getHeaderFlag(Message::HeaderFlag flag) const {
+        return ((flags_ & flag) != 0);
+    }
+
+    /// \brief Return the query name.
+    ///
+    /// The returned object refers to the data passed to \c parse() and
+    /// to this parser, so it must not be used after either of them is
+    /// destroyed or another message is parsed.
+    LabelSequence getQName() const {
+        return (LabelSequence(qname_data_, qname_offsets_, qname_labels_));
+    }
+
+    /// \brief Return the query type.
+    const RRType& getQType() const { return (qtype_); }
+
+    /// \brief Return the query class.
+    const RRClass& getQClass() const { return (qclass_); }
+
+    /// \brief Return whether the query has an OPT RR.
+    bool hasEDNS() const { return (has_edns_); }
+
+    /// \brief Return the EDNS version of the OPT RR (0 if there's none).
+    uint8_t getEDNSVersion() const { return (edns_version_); }
+
+    /// \brief Return the UDP payload size of the OPT RR.
+    ///
+    /// It's \c Message::DEFAULT_MAX_UDPSIZE if there's no OPT RR.
+    uint16_t getUDPSize() const { return (udp_size_); }
+
+    /// \brief Return whether the DO bit of the OPT RR is set.
+    bool getDNSSECAwareness() const { return (dnssec_ok_); }
+
+    /// \brief Return whether the query has a TSIG RR.
+    bool hasTSIG() const { return (tsig_pos_ != 0); }
+
+    /// \brief Return the offset of the TSIG RR from the beginning of the
+    /// message (0 if there's none).
+    size_t getTSIGPosition() const { return (tsig_pos_); }
+
+private:
+    qid_t qid_;
+    uint16_t flags_;
+    const uint8_t* qname_data_;
+    uint8_t qname_offsets_[Name::MAX_LABELS];
+    size_t qname_labels_;
+    RRType qtype_;
+    RRClass qclass_;
+    bool has_edns_;
+    uint8_t edns_version_;
+    uint16_t udp_size_;
+    bool dnssec_ok_;
+    size_t tsig_pos_;
+};
+
+} // namespace dns
+} // namespace bundy
+
+#endif // DNS_QUERY_PARSER_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -21,6 +21,8 @@
 #include <dns/messagerenderer.h>
 #include <dns/master_lexer.h>
 #include <dns/rdata.h>
+#include <dns/rdataclass.h>
+#include <dns/rrclass.h>
 #include <dns/rrparamregistry.h>
 #include <dns/rrtype.h>
 
@@ -39,6 +41,9 @@
 #include <stdint.h>
 #include <string.h>
 
+#include <arpa/inet.h> // XXX: for inet_pton(), not exist in C++ standards
+#include <sys/socket.h> // for AF_INET6
+
 using namespace std;
 using boost::lexical_cast;
 using namespace bundy::util;
@@ -135,6 +140,101 @@ fromtextError(bool& error_issued, const MasterLexer& lexer,
 }
 }
 
+namespace {
+// Parses a textual IPv4 address of the form of four decimal numbers without
+// leading zeros, which is a subset of what inet_pton() accepts.
+bool
+parseIPv4Addr(const char* src, size_t src_len, uint8_t* dst) {
+    size_t pos = 0;
+    for (size_t i = 0; i < 4; ++i) {
+        if (i > 0) {
+            if (pos == src_len || src[pos] != '.') {
+                return (false);
+            }
+            ++pos;
+        }
+        const size_t start = pos;
+        unsigned int value = 0;
+        while (pos < src_len && pos - start < 3 &&
+               src[pos] >= '0' && src[pos] <= '9') {
+            value = value * 10 + (src[pos] - '0');
+            ++pos;
+        }
+        if (pos == start || (src[start] == '0' && pos - start > 1) ||
+            value > 255) {
+            return (false);
+        }
+        dst[i] = value;
+    }
+    return (pos == src_len);
+}
+
+// Parses a textual IPv6 address with inet_pton(), copying it to a buffer
+// on the stack instead of a string.
+bool
+parseIPv6Addr(const char* src, size_t src_len, uint8_t* dst) {
+    // The longest form is an IPv4-mapped address with all digits given.
+    char buf[INET6_ADDRSTRLEN];
+    if (src_len >= sizeof(buf) || memchr(src, '\0', src_len) != NULL) {
+        return (false);
+    }
+    memcpy(buf, src, src_len);
+    buf[src_len] = '\0';
+    return (inet_pton(AF_INET6, buf, dst) == 1);
+}
+
+// Creates the RDATA of the most common types of zones (IN/A, IN/AAAA, NS,
+// CNAME and PTR) directly from the string region of the next token,
+// without looking up the RDATA factory in the registry.  For other types,
+// or if the next token isn't a string in a form handled here, it returns
+// an empty pointer, leaving the lexer where it was, so the generic
+// constructor of the type parses it again and reports any error.  Errors
+// in names are the same for both and are thrown right away.
+RdataPtr
+createRdataFast(const RRType& rrtype, const RRClass& rrclass,
+                MasterLexer& lexer, const Name* origin)
+{
+    const bool is_in = (rrclass == RRClass::IN());
+    const bool is_addr = is_in &&
+        (rrtype == RRType::A() || rrtype == RRType::AAAA());
+    if (!is_addr && rrtype != RRType::NS() && rrtype != RRType::CNAME() &&
+        rrtype != RRType::PTR()) {
+        return (RdataPtr());
+    }
+
+    const MasterToken& token = lexer.getNextToken();
+    if (token.getType() != MasterToken::STRING) {
+        lexer.ungetToken();
+        return (RdataPtr());
+    }
+    const MasterToken::StringRegion& region = token.getStringRegion();
+
+    if (is_addr) {
+        uint8_t addr[16];
+        const size_t addr_len = (rrtype == RRType::A()) ? 4 : 16;
+        if (!(addr_len == 4 ?
+              parseIPv4Addr(region.beg, region.len, addr) :
+              parseIPv6Addr(region.beg, region.len, addr))) {
+            lexer.ungetToken();
+            return (RdataPtr());
+        }
+        InputBuffer buffer(addr, addr_len);
+        if (addr_len == 4) {
+            return (RdataPtr(new in::A(buffer, addr_len)));
+        }
+        return (RdataPtr(new in::AAAA(buffer, addr_len)));
+    }
+
+    const Name name(region.beg, region.len, origin);
+    if (rrtype == RRType::NS()) {
+        return (RdataPtr(new generic::NS(name)));
+    } else if (rrtype == RRType::CNAME()) {
+        return (RdataPtr(new generic::CNAME(name)));
+    }
+    return (RdataPtr(new generic::PTR(name)));
+}
+}
+
 RdataPtr
 createRdata(const RRType& rrtype, const RRClass& rrclass,
             MasterLexer& lexer, const Name* origin,
@@ -145,8 +245,11 @@ createRdata(const RRType& rrtype, const RRClass& rrclass,
 
     bool error_issued = false;
     try {
-        rdata = RRParamRegistry::getRegistry().createRdata(
-            rrtype, rrclass, lexer, origin, options, callbacks);
+        rdata = createRdataFast(rrtype, rrclass, lexer, origin);
+        if (!rdata) {
+            rdata = RRParamRegistry::getRegistry().createRdata(
+                rrtype, rrclass, lexer, origin, options, callbacks);
+        }
     } catch (const MasterLexer::LexerError& error) {
         fromtextError(error_issued, lexer, callbacks, &error.token_, "");
     } catch (const Exception& ex) {
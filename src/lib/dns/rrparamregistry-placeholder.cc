@@ -20,10 +20,13 @@
 #include <string>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 #include <stdint.h>
 
+#include <boost/functional/hash.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
 
 #include <exceptions/exceptions.h>
 
@@ -43,24 +46,83 @@ namespace dns {
 
 namespace {
 ///
-/// The following function and class are a helper to define case-insensitive
-/// equivalence relationship on strings.  They are used in the mapping
-/// containers below.
+/// The following classes are a helper to define case-insensitive hashing and
+/// equivalence relationship on strings.  They are used in the hash tables
+/// from textual representations below.
 ///
-bool
-CICharLess(char c1, char c2) {
-    return (tolower(static_cast<unsigned char>(c1)) <
-            tolower(static_cast<unsigned char>(c2)));
-}
+struct CIStringHash {
+    size_t operator()(const string& s) const {
+        size_t seed = 0;
+        for (string::const_iterator it = s.begin(); it != s.end(); ++it) {
+            boost::hash_combine(seed,
+                                tolower(static_cast<unsigned char>(*it)));
+        }
+        return (seed);
+    }
+};
 
-struct CIStringLess :
-        public binary_function<string, string, bool>
-{
-    bool operator()(const string& s1, const string& s2) const
-    {
-        return (lexicographical_compare(s1.begin(), s1.end(),
-                                        s2.begin(), s2.end(), CICharLess));
+struct CIStringEqual {
+    bool operator()(const string& s1, const string& s2) const {
+        if (s1.size() != s2.size()) {
+            return (false);
+        }
+        for (size_t i = 0; i < s1.size(); ++i) {
+            if (tolower(static_cast<unsigned char>(s1[i])) !=
+                tolower(static_cast<unsigned char>(s2[i]))) {
+                return (false);
+            }
+        }
+        return (true);
+    }
+};
+
+/// \brief A mapping from 16-bit RR type or class codes to values of \c T.
+///
+/// Codes below \c DENSE_CODES, which include all commonly used types and
+/// classes, are mapped with a flat array, so a value is found by a single
+/// index operation.  The other codes are kept in an overflow map, which is
+/// usually tiny.  A default constructed \c T means there's no value for the
+/// code.
+template <typename T>
+class CodeMap {
+public:
+    CodeMap() : dense_(DENSE_CODES) {}
+
+    /// \brief Return the value for the code, or a default constructed one
+    /// if there's none.
+    const T& get(uint16_t code) const {
+        if (code < DENSE_CODES) {
+            return (dense_[code]);
+        }
+        const typename map<uint16_t, T>::const_iterator found =
+            overflow_.find(code);
+        return (found != overflow_.end() ? found->second : none_);
+    }
+
+    /// \brief Return a mutable reference to the value for the code,
+    /// creating a default constructed one if there's none.
+    T& getMutable(uint16_t code) {
+        if (code < DENSE_CODES) {
+            return (dense_[code]);
+        }
+        return (overflow_[code]);
+    }
+
+    /// \brief Remove the value for the code, if any.
+    void erase(uint16_t code) {
+        if (code < DENSE_CODES) {
+            dense_[code] = T();
+        } else {
+            overflow_.erase(code);
+        }
     }
+
+private:
+    // This covers all the types and classes known to this library.
+    static const uint16_t DENSE_CODES = 512;
+    vector<T> dense_;
+    map<uint16_t, T> overflow_;
+    T none_;
 };
 
 struct RRTypeParam {
@@ -78,8 +140,9 @@ struct RRTypeParam {
 };
 
 typedef boost::shared_ptr<RRTypeParam> RRTypeParamPtr;
-typedef map<string, RRTypeParamPtr, CIStringLess> StrRRTypeMap;
-typedef map<uint16_t, RRTypeParamPtr> CodeRRTypeMap;
+typedef boost::unordered_map<string, RRTypeParamPtr, CIStringHash,
+                             CIStringEqual> StrRRTypeMap;
+typedef CodeMap<RRTypeParamPtr> CodeRRTypeMap;
 
 inline const string&
 RRTypeParam::UNKNOWN_PREFIX() {
@@ -120,8 +183,9 @@ struct RRClassParam {
 };
 
 typedef boost::shared_ptr<RRClassParam> RRClassParamPtr;
-typedef map<string, RRClassParamPtr, CIStringLess> StrRRClassMap;
-typedef map<uint16_t, RRClassParamPtr> CodeRRClassMap;
+typedef boost::unordered_map<string, RRClassParamPtr, CIStringHash,
+                             CIStringEqual> StrRRClassMap;
+typedef CodeMap<RRClassParamPtr> CodeRRClassMap;
 
 inline const string&
 RRClassParam::UNKNOWN_PREFIX() {
@@ -148,17 +212,33 @@ RRClassParam::UNKNOWN_MAXLEN() {
 }
 } // end of anonymous namespace
 
-/// Note: the element ordering in the type/class pair is intentional.
-/// The standard library will perform inequality comparison (i.e, '<')
-/// in the way that the second elements (RRClass) are compared only when
-/// the first elements are equivalent.
-/// In practice, when we compare two pairs of RRType and RRClass, RRClass
-/// would be the same (and, in particular, be class IN) in the majority of
-/// cases.  So this comparison ordering should be more efficient in common
-/// cases.
-typedef pair<RRType, RRClass> RRTypeClass;
-typedef map<RRTypeClass, RdataFactoryPtr> RdataFactoryMap;
-typedef map<RRType, RdataFactoryPtr> GenericRdataFactoryMap;
+///
+/// The Rdata factories of an RR type.  The class specific ones are searched
+/// first (linearly, as there are very few of them, usually only one for class
+/// IN); if none matches, the class independent one, if any, is used.
+struct RdataFactories {
+    typedef pair<uint16_t, RdataFactoryPtr> ClassFactory;
+    vector<ClassFactory> class_factories;
+    RdataFactoryPtr generic_factory;
+
+    /// Return the index of the factory for the class in class_factories,
+    /// or its size if there's none.
+    size_t findClass(uint16_t class_code) const {
+        size_t i = 0;
+        while (i < class_factories.size() &&
+               class_factories[i].first != class_code) {
+            ++i;
+        }
+        return (i);
+    }
+
+    const AbstractRdataFactory* find(uint16_t class_code) const {
+        const size_t i = findClass(class_code);
+        return (i < class_factories.size() ? class_factories[i].second.get() :
+                generic_factory.get());
+    }
+};
+typedef CodeMap<RdataFactories> RdataFactoryMap;
 
 template <typename T>
 class RdataFactory : public AbstractRdataFactory {
@@ -202,8 +282,8 @@ struct RRParamRegistryImpl {
     StrRRClassMap str2classmap;
     /// Mappings from textual representations of RR classes to integer codes.
     CodeRRClassMap code2classmap;
+    /// Mappings from RR type codes to Rdata factories.
     RdataFactoryMap rdata_factories;
-    GenericRdataFactoryMap genericrdata_factories;
 };
 
 RRParamRegistry::RRParamRegistry() {
@@ -237,9 +317,11 @@ RRParamRegistry::add(const std::string& typecode_string, uint16_t typecode,
     bool type_added = false;
     try {
         type_added = addType(typecode_string, typecode);
-        impl_->genericrdata_factories.insert(pair<RRType, RdataFactoryPtr>(
-                                                 RRType(typecode),
-                                                 rdata_factory));
+        RdataFactories& factories =
+            impl_->rdata_factories.getMutable(typecode);
+        if (!factories.generic_factory) {
+            factories.generic_factory = rdata_factory;
+        }
     } catch (...) {
         if (type_added) {
             removeType(typecode);
@@ -265,10 +347,14 @@ RRParamRegistry::add(const std::string& typecode_string, uint16_t typecode,
     try {
         type_added = addType(typecode_string, typecode);
         class_added = addClass(classcode_string, classcode);
-        impl_->rdata_factories.insert(pair<RRTypeClass, RdataFactoryPtr>(
-                                          RRTypeClass(RRType(typecode),
-                                                      RRClass(classcode)),
-                                          rdata_factory));
+        RdataFactories& factories =
+            impl_->rdata_factories.getMutable(typecode);
+        // An existing factory is kept, like the existing type or class.
+        if (factories.findClass(classcode) ==
+            factories.class_factories.size()) {
+            factories.class_factories.push_back(
+                RdataFactories::ClassFactory(classcode, rdata_factory));
+        }
     } catch (...) {
         if (type_added) {
             removeType(typecode);
@@ -284,10 +370,11 @@ bool
 RRParamRegistry::removeRdataFactory(const RRType& rrtype,
                                     const RRClass& rrclass)
 {
-    RdataFactoryMap::iterator found =
-        impl_->rdata_factories.find(RRTypeClass(rrtype, rrclass));
-    if (found != impl_->rdata_factories.end()) {
-        impl_->rdata_factories.erase(found);
+    RdataFactories& factories =
+        impl_->rdata_factories.getMutable(rrtype.getCode());
+    const size_t i = factories.findClass(rrclass.getCode());
+    if (i < factories.class_factories.size()) {
+        factories.class_factories.erase(factories.class_factories.begin() + i);
         return (true);
     }
 
@@ -296,10 +383,10 @@ RRParamRegistry::removeRdataFactory(const RRType& rrtype,
 
 bool
 RRParamRegistry::removeRdataFactory(const RRType& rrtype) {
-    GenericRdataFactoryMap::iterator found =
-        impl_->genericrdata_factories.find(rrtype);
-    if (found != impl_->genericrdata_factories.end()) {
-        impl_->genericrdata_factories.erase(found);
+    RdataFactoryPtr& factory =
+        impl_->rdata_factories.getMutable(rrtype.getCode()).generic_factory;
+    if (factory) {
+        factory.reset();
         return (true);
     }
 
@@ -341,9 +428,9 @@ inline bool
 addParam(const string& code_string, uint16_t code, MC& codemap, MS& stringmap)
 {
     // Duplicate type check
-    typename MC::const_iterator found = codemap.find(code);
-    if (found != codemap.end()) {
-        if (found->second->code_string_ != code_string) {
+    const boost::shared_ptr<PT>& found = codemap.get(code);
+    if (found) {
+        if (found->code_string_ != code_string) {
             bundy_throw(ET, "Duplicate RR parameter registration");
         }
         return (false);
@@ -351,11 +438,10 @@ addParam(const string& code_string, uint16_t code, MC& codemap, MS& stringmap)
 
     typedef boost::shared_ptr<PT> ParamPtr;
     typedef pair<string, ParamPtr> StrParamPair;
-    typedef pair<uint16_t, ParamPtr> CodeParamPair;
     ParamPtr param = ParamPtr(new PT(code_string, code));
     try {
         stringmap.insert(StrParamPair(code_string, param));
-        codemap.insert(CodeParamPair(code, param));
+        codemap.getMutable(code) = param;
     } catch (...) {
         // Rollback to the previous state: not all of the erase operations will
         // find the entry, but we don't care.
@@ -370,14 +456,14 @@ addParam(const string& code_string, uint16_t code, MC& codemap, MS& stringmap)
 template <typename MC, typename MS>
 inline bool
 removeParam(uint16_t code, MC& codemap, MS& stringmap) {
-    typename MC::iterator found = codemap.find(code);
+    const typename MS::mapped_type found = codemap.get(code);
 
-    if (found != codemap.end()) {
-        size_t erased = stringmap.erase(found->second->code_string_);
+    if (found) {
+        size_t erased = stringmap.erase(found->code_string_);
         // We must have a corresponding entry of the str2 map exists
         assert(erased == 1);
 
-        codemap.erase(found);
+        codemap.erase(code);
 
         return (true);
     }
@@ -417,11 +503,9 @@ textToCode(const string& code_str, MS& stringmap, uint16_t& ret_code) {
 template <typename PT, typename MC>
 inline string
 codeToText(uint16_t code, MC& codemap) {
-    typename MC::const_iterator found;
-
-    found = codemap.find(code);
-    if (found != codemap.end()) {
-        return (found->second->code_string_);
+    const boost::shared_ptr<PT>& found = codemap.get(code);
+    if (found) {
+        return (found->code_string_);
     }
 
     ostringstream ss;
@@ -487,19 +571,8 @@ inline const AbstractRdataFactory*
 findRdataFactory(RRParamRegistryImpl* reg_impl,
                  const RRType& rrtype, const RRClass& rrclass)
 {
-    RdataFactoryMap::const_iterator found;
-    found = reg_impl->rdata_factories.find(RRTypeClass(rrtype, rrclass));
-    if (found != reg_impl->rdata_factories.end()) {
-        return (found->second.get());
-    }
-
-    GenericRdataFactoryMap::const_iterator genfound =
-        reg_impl->genericrdata_factories.find(rrtype);
-    if (genfound != reg_impl->genericrdata_factories.end()) {
-        return (genfound->second.get());
-    }
-
-    return (NULL);
+    return (reg_impl->rdata_factories.get(rrtype.getCode()).find(
+                rrclass.getCode()));
 }
 }
 
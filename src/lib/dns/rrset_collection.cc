@@ -16,16 +16,37 @@
 #include <dns/master_loader_callbacks.h>
 #include <dns/master_loader.h>
 #include <dns/rrcollator.h>
+#include <dns/labelsequence.h>
 
 #include <exceptions/exceptions.h>
 
 #include <boost/bind.hpp>
+#include <boost/functional/hash.hpp>
+
+#include <algorithm>
 
 using namespace bundy;
 
 namespace bundy {
 namespace dns {
 
+namespace {
+template <typename Iterator>
+bool
+compareKeys(const Iterator& lhs, const Iterator& rhs) {
+    return (lhs->first < rhs->first);
+}
+}
+
+size_t
+RRsetCollection::CollectionKeyHash::operator()(const CollectionKey& key) const
+{
+    size_t hash = LabelSequence(key.get<2>()).getFullHash(false, 0);
+    boost::hash_combine(hash, key.get<0>().getCode());
+    boost::hash_combine(hash, key.get<1>().getCode());
+    return (hash);
+}
+
 void
 RRsetCollection::loaderCallback(const std::string&, size_t, const std::string&)
 {
@@ -44,6 +65,23 @@ RRsetCollection::addRRset(RRsetPtr rrset) {
     }
 
     rrsets_.insert(std::pair<CollectionKey, RRsetPtr>(key, rrset));
+    ordered_valid_ = false;
+}
+
+void
+RRsetCollection::buildOrderedRRsets() {
+    if (ordered_valid_) {
+        return;
+    }
+    ordered_rrsets_.clear();
+    ordered_rrsets_.reserve(rrsets_.size());
+    for (CollectionMap::iterator it = rrsets_.begin(); it != rrsets_.end();
+         ++it) {
+        ordered_rrsets_.push_back(it);
+    }
+    std::sort(ordered_rrsets_.begin(), ordered_rrsets_.end(),
+              compareKeys<CollectionMap::iterator>);
+    ordered_valid_ = true;
 }
 
 template<typename T>
@@ -63,13 +101,15 @@ RRsetCollection::constructHelper(T source, const bundy::dns::Name& origin,
 }
 
 RRsetCollection::RRsetCollection(const char* filename, const Name& origin,
-                                 const RRClass& rrclass)
+                                 const RRClass& rrclass) :
+    ordered_valid_(false)
 {
     constructHelper(filename, origin, rrclass);
 }
 
 RRsetCollection::RRsetCollection(std::istream& input_stream, const Name& origin,
-                                 const RRClass& rrclass)
+                                 const RRClass& rrclass) :
+    ordered_valid_(false)
 {
     constructHelper<std::istream&>(input_stream, origin, rrclass);
 }
@@ -109,18 +149,21 @@ RRsetCollection::removeRRset(const Name& name, const RRClass& rrclass,
     }
 
     rrsets_.erase(it);
+    ordered_valid_ = false;
     return (true);
 }
 
 RRsetCollectionBase::IterPtr
 RRsetCollection::getBeginning() {
-    CollectionMap::iterator it = rrsets_.begin();
+    buildOrderedRRsets();
+    OrderedRRsets::iterator it = ordered_rrsets_.begin();
     return (RRsetCollectionBase::IterPtr(new DnsIter(it)));
 }
 
 RRsetCollectionBase::IterPtr
 RRsetCollection::getEnd() {
-    CollectionMap::iterator it = rrsets_.end();
+    buildOrderedRRsets();
+    OrderedRRsets::iterator it = ordered_rrsets_.end();
     return (RRsetCollectionBase::IterPtr(new DnsIter(it)));
 }
 
@@ -20,14 +20,22 @@
 
 #include <boost/tuple/tuple.hpp>
 #include <boost/tuple/tuple_comparison.hpp>
+#include <boost/unordered_map.hpp>
 
-#include <map>
+#include <vector>
 
 namespace bundy {
 namespace dns {
 
 /// \brief libdns++ implementation of RRsetCollectionBase using an STL
 /// container.
+///
+/// The RRsets are kept in a hash table, so \c find() takes constant time
+/// even for large zones (\c checkZone() looks up several RRsets for each
+/// NS name).  The collection is iterated in the order of the class, type
+/// and name of the RRsets; this order is only established when an
+/// iteration begins after the collection was changed.  Adding or removing
+/// RRsets invalidates the iterators.
 class RRsetCollection : public RRsetCollectionBase {
 public:
     /// \brief Constructor.
@@ -35,7 +43,7 @@ public:
     /// This constructor creates an empty collection without any data in
     /// it. RRsets can be added to the collection with the \c addRRset()
     /// method.
-    RRsetCollection() {}
+    RRsetCollection() : ordered_valid_(false) {}
 
     /// \brief Constructor.
     ///
@@ -124,24 +132,38 @@ private:
 
     typedef boost::tuple<bundy::dns::RRClass, bundy::dns::RRType, bundy::dns::Name>
         CollectionKey;
-    typedef std::map<CollectionKey, bundy::dns::RRsetPtr> CollectionMap;
+
+    // Names are compared case-insensitively, so they're hashed the same way.
+    struct CollectionKeyHash {
+        size_t operator()(const CollectionKey& key) const;
+    };
+
+    typedef boost::unordered_map<CollectionKey, bundy::dns::RRsetPtr,
+                                 CollectionKeyHash> CollectionMap;
+    typedef std::vector<CollectionMap::iterator> OrderedRRsets;
+
+    // Sort the RRsets for iteration, unless they're sorted already.
+    void buildOrderedRRsets();
 
     CollectionMap rrsets_;
+    // The RRsets in the order of their keys; only valid if ordered_valid_.
+    OrderedRRsets ordered_rrsets_;
+    bool ordered_valid_;
 
 protected:
     class DnsIter : public RRsetCollectionBase::Iter {
     public:
-        DnsIter(CollectionMap::iterator& iter) :
+        DnsIter(OrderedRRsets::iterator& iter) :
             iter_(iter)
         {}
 
         virtual const bundy::dns::AbstractRRset& getValue() {
-            bundy::dns::RRsetPtr& rrset = iter_->second;
+            bundy::dns::RRsetPtr& rrset = (*iter_)->second;
             return (*rrset);
         }
 
         virtual IterPtr getNext() {
-            CollectionMap::iterator it = iter_;
+            OrderedRRsets::iterator it = iter_;
             ++it;
             return (RRsetCollectionBase::IterPtr(new DnsIter(it)));
         }
@@ -155,7 +177,7 @@ protected:
         }
 
     private:
-        CollectionMap::iterator iter_;
+        OrderedRRsets::iterator iter_;
     };
 
     virtual RRsetCollectionBase::IterPtr getBeginning();
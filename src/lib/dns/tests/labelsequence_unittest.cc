@@ -23,6 +23,7 @@
 #include <gtest/gtest.h>
 
 #include <boost/functional/hash.hpp>
+#include <boost/lexical_cast.hpp>
 
 #include <string>
 #include <vector>
@@ -447,6 +448,67 @@ getDataCheck(const char* expected_char_data, size_t expected_len,
     getDataCheck(&expected_data[0], expected_len, ls);
 }
 
+// Build a name of a single label of 'len' characters, where all characters
+// are 'a' except the one at 'pos', which is 'ch'.
+Name
+longLabelName(size_t len, size_t pos, uint8_t ch) {
+    string label;
+    for (size_t i = 0; i < len; ++i) {
+        const uint8_t c = (i == pos) ? ch : 'a';
+        label += "\\" + boost::lexical_cast<string>(c / 100) +
+            boost::lexical_cast<string>((c / 10) % 10) +
+            boost::lexical_cast<string>(c % 10);
+    }
+    return (Name(label + ".example"));
+}
+
+uint8_t
+lowerChar(uint8_t c) {
+    return ((c >= 'A' && c <= 'Z') ? (c - 'A' + 'a') : c);
+}
+
+// Comparison of long labels may be vectorized.  Check the result is still
+// identical to the character-by-character comparison for label lengths
+// around the vector sizes and all positions, including characters around
+// the upper case letters.
+TEST_F(LabelSequenceTest, compareLongLabels) {
+    const uint8_t chars[] = { 'A', 'Z', 'a', 'z', '@', '[', '`', '{',
+                              '0', 0x80, 0xc1, 0xda, 0xff };
+    const size_t chars_len = sizeof(chars) / sizeof(chars[0]);
+    const size_t lens[] = { 1, 15, 16, 17, 31, 32, 33, 48, 63 };
+    for (size_t k = 0; k < sizeof(lens) / sizeof(lens[0]); ++k) {
+        const size_t len = lens[k];
+        for (size_t pos = 0; pos < len; ++pos) {
+            for (size_t i = 0; i < chars_len; ++i) {
+                for (size_t j = 0; j < chars_len; ++j) {
+                    const Name n1 = longLabelName(len, pos, chars[i]);
+                    const Name n2 = longLabelName(len, pos, chars[j]);
+                    const LabelSequence ls_1(n1);
+                    const LabelSequence ls_2(n2);
+
+                    const int sensitive_diff = static_cast<int>(chars[i]) -
+                        static_cast<int>(chars[j]);
+                    EXPECT_EQ(sensitive_diff, ls_1.compare(ls_2, true).
+                              getOrder());
+                    EXPECT_EQ(sensitive_diff == 0, ls_1.equals(ls_2, true));
+
+                    const int insensitive_diff =
+                        static_cast<int>(lowerChar(chars[i])) -
+                        static_cast<int>(lowerChar(chars[j]));
+                    const NameComparisonResult result = ls_1.compare(ls_2);
+                    EXPECT_EQ(insensitive_diff, result.getOrder());
+                    EXPECT_EQ(insensitive_diff == 0 ?
+                              NameComparisonResult::EQUAL :
+                              NameComparisonResult::COMMONANCESTOR,
+                              result.getRelation());
+                    EXPECT_EQ(insensitive_diff == 0, ls_1.equals(ls_2));
+                    EXPECT_EQ(insensitive_diff == 0, n1 == n2);
+                }
+            }
+        }
+    }
+}
+
 TEST_F(LabelSequenceTest, getData) {
     getDataCheck("\007example\003org\000", 13, ls1);
     getDataCheck("\007example\003com\000", 13, ls2);
@@ -1010,6 +1072,30 @@ TEST_F(ExtendableLabelSequenceTest, extendableLabelSequence) {
     check_equal(ls2, els);
 }
 
+// Test LabelSequences parsed from text into the buffer
+TEST_F(ExtendableLabelSequenceTest, fromText) {
+    const char* const text = "Foo.Bar.Example.Org";
+    LabelSequence els(text, strlen(text), buf);
+    EXPECT_TRUE(els.isAbsolute());
+    check_equal(LabelSequence(Name(text)), els);
+    EXPECT_EQ("Foo.Bar.Example.Org.", els.toText());
+
+    els = LabelSequence(text, strlen(text), buf, true);
+    EXPECT_EQ("foo.bar.example.org.", els.toText());
+
+    // It's extendable.
+    els.stripRight(1);
+    els.extend(LabelSequence(foo_example), buf);
+    EXPECT_EQ("foo.bar.example.org.foo.example.", els.toText());
+
+    els = LabelSequence(".", 1, buf);
+    EXPECT_TRUE(els.isAbsolute());
+    EXPECT_EQ(1, els.getLabelCount());
+
+    EXPECT_THROW(LabelSequence("a..b", 4, buf), EmptyLabel);
+    EXPECT_THROW(LabelSequence("", 0, buf), IncompleteName);
+}
+
 // Test that 'extendable' LabelSequences behave correctly when initialized
 // with a stripped source LabelSequence
 TEST_F(ExtendableLabelSequenceTest, extendableLabelSequenceLeftStrippedSource) {
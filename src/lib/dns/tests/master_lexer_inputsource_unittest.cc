@@ -18,11 +18,13 @@
 
 #include <gtest/gtest.h>
 
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
 
 #include <string.h>
+#include <unistd.h>
 
 using namespace std;
 using namespace bundy::dns;
@@ -364,6 +366,132 @@ TEST_F(InputSourceTest, getSize) {
     EXPECT_EQ(143, InputSource(TEST_DATA_SRCDIR "/masterload.txt").getSize());
 }
 
+// A file is mapped in memory; check it works as a stream source beyond
+// getChar() and ungetChar().
+TEST_F(InputSourceTest, mappedFile) {
+    InputSource source(TEST_DATA_SRCDIR "/masterload.txt");
+    while (!source.atEOF()) {
+        source.getChar();
+    }
+    EXPECT_EQ(6, source.getCurrentLine());
+    EXPECT_EQ(143, source.getPosition());
+    source.ungetAll();
+    EXPECT_EQ(1, source.getCurrentLine());
+    EXPECT_EQ(0, source.getPosition());
+    EXPECT_FALSE(source.atEOF());
+
+    // Skip the first line, and mark the beginning of the second.
+    while (source.getChar() != '\n') {
+        ;
+    }
+    source.mark();
+    EXPECT_THROW(source.ungetChar(), InputSource::UngetBeforeBeginning);
+    EXPECT_EQ('\n', source.getChar());
+    EXPECT_EQ('e', source.getChar());
+    source.ungetAll();
+    EXPECT_EQ(2, source.getCurrentLine());
+    EXPECT_EQ(35, source.getPosition());
+    EXPECT_EQ('\n', source.getChar());
+}
+
+TEST_F(InputSourceTest, getRun) {
+    std::bitset<128> stops;
+    stops.set(' ');
+    const char* run = NULL;
+
+    // Streams don't support it.
+    EXPECT_EQ(0, source_.getRun(stops, &run));
+    EXPECT_EQ(0, source_.getPosition());
+
+    // The first line of the file is ";; a simple (incomplete) zone file".
+    InputSource source(TEST_DATA_SRCDIR "/masterload.txt");
+    ASSERT_EQ(2, source.getRun(stops, &run));
+    EXPECT_EQ(";;", string(run, 2));
+    EXPECT_EQ(2, source.getPosition());
+    // It doesn't skip the stopping character.
+    EXPECT_EQ(0, source.getRun(stops, &run));
+    EXPECT_EQ(' ', source.getChar());
+    // The skipped characters can be ungotten.
+    source.ungetChar();
+    source.ungetChar();
+    EXPECT_EQ(';', source.getChar());
+    EXPECT_EQ(' ', source.getChar());
+
+    // It always stops at a newline, and the line number is maintained.
+    stops.reset();
+    ASSERT_EQ(31, source.getRun(stops, &run));
+    EXPECT_EQ("a simple (incomplete) zone file", string(run, 31));
+    EXPECT_EQ(1, source.getCurrentLine());
+    EXPECT_EQ('\n', source.getChar());
+    EXPECT_EQ(2, source.getCurrentLine());
+
+    // And at the end.
+    while (source.getRun(stops, &run) != 0 || source.getChar() == '\n') {
+        ;
+    }
+    EXPECT_TRUE(source.atEOF());
+    EXPECT_EQ(143, source.getPosition());
+    EXPECT_EQ(0, source.getRun(stops, &run));
+}
+
+// Long runs may be scanned 16 characters at a time, after the first few.
+// Put the stops at every position of such blocks and check the runs are the
+// same as with getChar().
+TEST_F(InputSourceTest, getRunLong) {
+    std::bitset<128> stops;
+    stops.set(' ');
+    stops.set(';');
+    stops.set('\\');
+    stops.set('\t');
+
+    // Characters with the highest bit set are examined with the lower 7
+    // bits, so "\xa0" stops like a space, while "\x8a" isn't a newline.
+    const char* const stop_chars = " ;\\\t\n\xa0";
+    string data;
+    for (size_t i = 0; i < 80; ++i) {
+        data.append(i, (i % 2) == 0 ? 'x' : '\x8a');
+        data.push_back(stop_chars[i % strlen(stop_chars)]);
+    }
+    data.append(20, 'y');       // and a run to the end
+
+    const string filename = TEST_DATA_BUILDDIR "/getrun_long.txt";
+    {
+        ofstream ofs(filename.c_str());
+        ofs << data;
+    }
+    InputSource source(filename.c_str());
+    unlink(filename.c_str());
+
+    size_t pos = 0;
+    while (pos < data.size()) {
+        size_t expected = 0;
+        while (pos + expected < data.size() &&
+               !stops.test(data[pos + expected] & 0x7f) &&
+               data[pos + expected] != '\n') {
+            ++expected;
+        }
+        const char* run = NULL;
+        ASSERT_EQ(expected, source.getRun(stops, &run)) << "at " << pos;
+        EXPECT_EQ(data.substr(pos, expected), string(run, expected));
+        pos += expected;
+        EXPECT_EQ(pos, source.getPosition());
+        if (pos < data.size()) {
+            EXPECT_EQ(data[pos], static_cast<char>(source.getChar()));
+            ++pos;
+        }
+    }
+    EXPECT_EQ(InputSource::END_OF_STREAM, source.getChar());
+}
+
+// Special files can't be mapped, and it falls back to the stream.
+TEST_F(InputSourceTest, unmappedFile) {
+    InputSource source("/dev/null");
+    const char* run = NULL;
+    EXPECT_EQ(0, source.getRun(std::bitset<128>(), &run));
+    EXPECT_EQ(InputSource::END_OF_STREAM, source.getChar());
+    EXPECT_TRUE(source.atEOF());
+}
+
 TEST_F(InputSourceTest, getPosition) {
     // Initially the position is set to 0.  Other cases are tested in tests
     // for get and unget.
@@ -24,6 +24,7 @@
 #include <boost/scoped_ptr.hpp>
 #include <boost/bind.hpp>
 
+#include <fstream>
 #include <string>
 #include <sstream>
 
@@ -526,4 +527,43 @@ TEST_F(MasterLexerTest, getNextTokenErrors) {
               lexer.getNextToken(MasterToken::STRING).getString());
 }
 
+// Files (which are mapped in memory) and streams are tokenized the same way.
+TEST_F(MasterLexerTest, fileAndStream) {
+    const char* const filename = TEST_DATA_SRCDIR "/lexer_input.txt";
+    std::ifstream fs(filename);
+    ss << fs.rdbuf();
+    fs.close();
+
+    string tokens[2];
+    lexer.pushSource(ss);
+    ASSERT_TRUE(lexer.pushSource(filename));
+    for (int i = 0; i < 2; ++i) {
+        stringstream result;
+        while (true) {
+            const MasterToken& token =
+                lexer.getNextToken(MasterLexer::QSTRING |
+                                   MasterLexer::INITIAL_WS |
+                                   MasterLexer::NUMBER);
+            result << lexer.getSourceLine() << " " << token.getType();
+            if (token.getType() == MasterToken::STRING ||
+                token.getType() == MasterToken::QSTRING) {
+                result << " " << token.getString();
+            } else if (token.getType() == MasterToken::NUMBER) {
+                result << " " << token.getNumber();
+            } else if (token.getType() == MasterToken::ERROR) {
+                result << " " << token.getErrorText();
+            }
+            result << "\n";
+            if (token.getType() == MasterToken::END_OF_FILE) {
+                break;
+            }
+        }
+        tokens[i] = result.str();
+        EXPECT_EQ(ss.str().size(), lexer.getPosition() - (i == 0 ? 0 :
+                                                          ss.str().size()));
+        lexer.popSource();
+    }
+    EXPECT_EQ(tokens[1], tokens[0]);
+}
+
 }
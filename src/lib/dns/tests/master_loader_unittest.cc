@@ -141,6 +141,58 @@ public:
         checkRR(name, RRType::A(), "192.0.2.1");
     }
 
+    // Load the stream with the given options (and parallelism if the
+    // PARALLEL option is included), and return everything reported as
+    // text.  The stream can be loaded again, giving the same source name.
+    string loadAndDump(stringstream& ss, MasterLoader::Options options,
+                       size_t thread_count = 1, size_t chunk_size = 1) {
+        ss.clear();
+        setLoader(ss, Name("example.org."), RRClass::IN(), options);
+        if ((options & MasterLoader::PARALLEL) != 0) {
+            loader_->setParallelism(thread_count, chunk_size);
+        }
+        string result;
+        try {
+            loader_->load();
+        } catch (const MasterLoaderError& ex) {
+            result += string("exception: ") + ex.what() + "\n";
+        }
+        result += loader_->loadedSucessfully() ? "success\n" : "failure\n";
+        for (list<RRsetPtr>::const_iterator it = rrsets_.begin();
+             it != rrsets_.end(); ++it) {
+            result += (*it)->toText();
+        }
+        for (size_t i = 0; i < errors_.size(); ++i) {
+            result += "error: " + errors_[i] + "\n";
+        }
+        for (size_t i = 0; i < warnings_.size(); ++i) {
+            result += "warning: " + warnings_[i] + "\n";
+        }
+        clear();
+        return (result);
+    }
+
+    // Check the parallel mode gives the same result as the sequential one
+    // for the zone, with various chunk sizes.
+    void checkParallel(const string& zone, bool many_errors) {
+        stringstream ss(zone);
+        const MasterLoader::Options options = many_errors ?
+            MasterLoader::MANY_ERRORS : MasterLoader::DEFAULT;
+        const MasterLoader::Options parallel_options =
+            static_cast<MasterLoader::Options>(options |
+                                               MasterLoader::PARALLEL);
+        const string expected = loadAndDump(ss, options);
+        const size_t chunk_sizes[] = { 1, 16, 64, 256, 100000 };
+        for (size_t i = 0; i < sizeof(chunk_sizes) / sizeof(size_t); ++i) {
+            SCOPED_TRACE("chunk size " +
+                         lexical_cast<string>(chunk_sizes[i]));
+            EXPECT_EQ(expected, loadAndDump(ss, parallel_options, 1,
+                                            chunk_sizes[i]));
+            EXPECT_EQ(expected, loadAndDump(ss, parallel_options, 4,
+                                            chunk_sizes[i]));
+        }
+    }
+
     MasterLoaderCallbacks callbacks_;
     boost::scoped_ptr<MasterLoader> loader_;
     vector<string> errors_;
@@ -1444,4 +1496,118 @@ TEST_F(MasterLoaderTest, numericOwnerName) {
     checkRR("1.example.org", RRType::A(), "192.0.2.1");
 }
 
+// Test the parallel mode with a simple zone file.
+TEST_F(MasterLoaderTest, parallelLoad) {
+    setLoader(TEST_DATA_SRCDIR "/example.org", Name("example.org."),
+              RRClass::IN(), static_cast<MasterLoader::Options>(
+                  MasterLoader::MANY_ERRORS | MasterLoader::PARALLEL));
+    loader_->setParallelism(2, 1);
+    EXPECT_EQ(0, loader_->getSize());
+    EXPECT_EQ(0, loader_->getPosition());
+
+    // Chunks are reported in order, and the position follows them.
+    EXPECT_FALSE(loader_->loadIncremental(1));
+    EXPECT_EQ(550, loader_->getSize());
+    checkRR("example.org", RRType::SOA(),
+            "ns1.example.org. admin.example.org. "
+            "1234 3600 1800 2419200 7200");
+    EXPECT_FALSE(loader_->loadIncremental(2));
+    EXPECT_LT(0, loader_->getPosition());
+    EXPECT_GT(550, loader_->getPosition());
+    checkRR("example.org", RRType::NS(), "ns1.example.org.");
+    checkRR("www.example.org", RRType::A(), "192.0.2.1");
+
+    // Parameters can't be changed once started.
+    EXPECT_THROW(loader_->setParallelism(2, 2), bundy::InvalidOperation);
+
+    loader_->load();
+    EXPECT_TRUE(loader_->loadedSucessfully());
+    EXPECT_TRUE(errors_.empty());
+    EXPECT_TRUE(warnings_.empty());
+    EXPECT_EQ(550, loader_->getSize());
+    EXPECT_EQ(550, loader_->getPosition());
+    checkRR("www.example.org", RRType::AAAA(), "2001:db8::1");
+
+    // Invalid parameters
+    setLoader(TEST_DATA_SRCDIR "/example.org", Name("example.org."),
+              RRClass::IN(), MasterLoader::PARALLEL);
+    EXPECT_THROW(loader_->setParallelism(0, 1), bundy::InvalidParameter);
+    EXPECT_THROW(loader_->setParallelism(1, 0), bundy::InvalidParameter);
+}
+
+// The parallel mode reports the same things as the sequential one, wherever
+// the input is split.
+TEST_F(MasterLoaderTest, parallelCompare) {
+    const string zone =
+        "$TTL 3600\n"
+        "example.org. IN SOA ( ns1.example.org. ; comment with (\n"
+        "    admin.example.org. 1234 3600 1800 2419200 7200 )\n"
+        "example.org. NS ns1.example.org.\n"
+        "\"quoted\" TXT \"a ; \\\" ( b\"\n"
+        "txt TXT \"multi\\\n"
+        "line\"\n"
+        "paren TXT ( \"x\" \")\" ) ; (\n"
+        "\tIN A 192.0.2.1\n"
+        "\n"
+        "; comment\n"
+        "$TTL 300\n"
+        "www A 192.0.2.1\n"
+        "www\\ space\\( A 192.0.2.2\n"
+        "$ORIGIN sub.example.org.\n"
+        "a A 192.0.2.3\n"
+        "$origin rel ; relative\n"
+        "b 1800 A 192.0.2.4\n"
+        "$GENERATE 1-20 host$ A 192.0.2.$\n"
+        "$INCLUDE " TEST_DATA_SRCDIR "/example.org\n"
+        "c A 192.0.2.5\n"
+        "bad A 192.0.2.999\n"
+        "$ORIGIN\n"
+        "d 7200 A 192.0.2.6\n"
+        "$ORIGIN \"example.org.\"\n"
+        "e A 192.0.2.7\n"
+        "$ORIGIN sub\n"
+        "f A 192.0.2.8\n"
+        "g A 192.0.2.9";
+    checkParallel(zone, true);
+    // Without MANY_ERRORS, it stops at the first error.
+    checkParallel(zone, false);
+}
+
+// TTLs depending on the previous RRs are resolved the same way as the
+// sequential mode, too.
+TEST_F(MasterLoaderTest, parallelTTL) {
+    // From the SOA minimum (which is too large)
+    checkParallel("example.org. IN SOA ns1.example.org. admin.example.org. "
+                  "1234 3600 1800 2419200 4294967295\n"
+                  "a A 192.0.2.1\n"
+                  "b 100 A 192.0.2.2\n"
+                  "c A 192.0.2.3\n", true);
+    // RFC1035 semantics
+    checkParallel("a 100 A 192.0.2.1\n"
+                  "b A 192.0.2.2\n"
+                  "c 4294967295 A 192.0.2.3\n"
+                  "d A 192.0.2.4\n", true);
+    // No TTL.  An explicit TTL of a rejected RR is still effective.
+    const string no_ttl = "a A 192.0.2.1\n"
+        "$GENERATE 1-5 host$ A 192.0.2.$\n"
+        "b 100 A 192.0.2.999\n"
+        "c A 192.0.2.3\n";
+    checkParallel(no_ttl, true);
+    checkParallel(no_ttl, false);
+}
+
+// Errors opening the top-level file in the parallel mode.
+TEST_F(MasterLoaderTest, parallelInvalidFile) {
+    setLoader("This file doesn't exist at all", Name("example.org."),
+              RRClass::IN(), static_cast<MasterLoader::Options>(
+                  MasterLoader::MANY_ERRORS | MasterLoader::PARALLEL));
+    loader_->load();
+    EXPECT_FALSE(loader_->loadedSucessfully());
+    EXPECT_TRUE(warnings_.empty());
+    ASSERT_EQ(1, errors_.size());
+    EXPECT_EQ(0, errors_[0].find("Error opening the input source file: ")) <<
+        "Different error: " << errors_[0];
+    EXPECT_EQ(errors_[0].size() - 5, errors_[0].find(" [:0]"));
+}
+
 }
@@ -0,0 +1,165 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <dns/master_text_renderer.h>
+#include <dns/name.h>
+#include <dns/rdata.h>
+#include <dns/rrclass.h>
+#include <dns/rrset.h>
+#include <dns/rrttl.h>
+#include <dns/rrtype.h>
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+using namespace bundy::dns;
+using namespace bundy::dns::rdata;
+using std::string;
+
+namespace {
+
+class MasterTextRendererTest : public ::testing::Test {
+protected:
+    MasterTextRendererTest() : renderer(16) // small, to make it grow
+    {}
+
+    RRsetPtr createRRset(const string& name, const RRType& type,
+                         const string& rdata1, const string& rdata2 = "",
+                         const RRClass& rrclass = RRClass::IN())
+    {
+        RRsetPtr rrset(new RRset(Name(name), rrclass, type, RRTTL(3600)));
+        rrset->addRdata(createRdata(type, rrclass, rdata1));
+        if (!rdata2.empty()) {
+            rrset->addRdata(createRdata(type, rrclass, rdata2));
+        }
+        return (rrset);
+    }
+
+    // Renders the RRset and checks the text is the same as its toText(),
+    // and that it's appended to what was rendered before.
+    void checkRender(const AbstractRRset& rrset, const size_t count) {
+        const string before(renderer.getData(), renderer.getLength());
+        EXPECT_EQ(count, renderer.render(rrset));
+        EXPECT_EQ(before + rrset.toText(),
+                  string(renderer.getData(), renderer.getLength()));
+    }
+
+    MasterTextRenderer renderer;
+};
+
+TEST_F(MasterTextRendererTest, construct) {
+    EXPECT_EQ(0, renderer.getLength());
+    EXPECT_EQ(static_cast<const char*>(NULL), renderer.getData());
+}
+
+TEST_F(MasterTextRendererTest, commonTypes) {
+    checkRender(*createRRset("www.example.org", RRType::A(),
+                             "192.0.2.1", "192.0.2.255"), 2);
+    checkRender(*createRRset("www.example.org", RRType::AAAA(),
+                             "2001:db8::1", "2001:db8:0:1:2:3:4:5"), 2);
+    checkRender(*createRRset("example.org", RRType::NS(),
+                             "ns1.example.org.", "ns2.example.net."), 2);
+    checkRender(*createRRset("alias.example.org", RRType::CNAME(),
+                             "www.example.org."), 1);
+    checkRender(*createRRset("1.2.0.192.in-addr.arpa", RRType::PTR(),
+                             "www.example.org."), 1);
+    checkRender(*createRRset("sub.example.org", RRType::DNAME(),
+                             "example.net."), 1);
+    checkRender(*createRRset("example.org", RRType::MX(),
+                             "10 mail.example.org.", "65535 ."), 2);
+    checkRender(*createRRset("example.org", RRType::SOA(),
+                             "ns1.example.org. admin.example.org. "
+                             "4294967295 3600 300 3600000 0"), 1);
+    checkRender(*createRRset("example.org", RRType::TXT(),
+                             "\"a b\" \"quote\\\" semi\\; back\\\\\" "
+                             "\"\\000\\127\\255\"", "\"\""), 2);
+    checkRender(*createRRset("example.org", RRType::SPF(),
+                             "\"v=spf1 -all\""), 1);
+    checkRender(*createRRset("sub.example.org", RRType::DS(),
+                             "12892 5 2 F1E184C0E1D615D20EB3C223ACED3B03C773DD"
+                             "952D5F0EB5C777586DE18DA6B5"), 1);
+    checkRender(*createRRset("example.org", RRType::DNSKEY(),
+                             "257 3 5 AwEAAcHGFDFdSFoEs9Tnp8Sbl2ke7bK1f4S4"
+                             "7ZW7vHvEhj0SFDUGOtwx0zhwzFwgUyrMG7Zjqbk=",
+                             "256 3 5 AwEAAQ=="), 2);
+    // RRSIG, with the same times twice and a type without mnemonic.
+    checkRender(*createRRset("example.org", RRType::RRSIG(),
+                             "SOA 5 2 3600 20000201000000 20000101000000 "
+                             "12345 example.org. FAKEFAKEFAKE",
+                             "TYPE65000 5 2 3600 20000201000000 "
+                             "20000101000000 12345 example.org. "
+                             "FAKEFAKEFAKEFAKE"), 2);
+    EXPECT_NE(0, renderer.getLength());
+}
+
+TEST_F(MasterTextRendererTest, otherTypes) {
+    // Rendered by toText() of the RDATA.
+    checkRender(*createRRset("example.org", RRType::HINFO(),
+                             "\"PC\" \"Linux\""), 1);
+    checkRender(*createRRset("example.org", RRType("TYPE65000"),
+                             "\\# 3 010203"), 1);
+    // A and AAAA of other classes than IN aren't addresses.
+    checkRender(*createRRset("example.org", RRType::A(), "\\# 2 0102", "",
+                             RRClass("CLASS65000")), 1);
+    checkRender(*createRRset("example.org", RRType::NS(), "ns.example.org.",
+                             "", RRClass("CLASS65000")), 1);
+}
+
+TEST_F(MasterTextRendererTest, names) {
+    checkRender(*createRRset(".", RRType::NS(), "a.root-servers.net."), 1);
+    checkRender(*createRRset("*.example.org", RRType::CNAME(), "."), 1);
+    checkRender(*createRRset("a\\.b\\\"c\\(\\)\\;\\@\\$\\\\d.example.org",
+                             RRType::CNAME(), "\\000\\032\\127.example."), 1);
+}
+
+TEST_F(MasterTextRendererTest, rrsig) {
+    RRsetPtr rrset = createRRset("www.example.org", RRType::A(),
+                                 "192.0.2.1");
+    rrset->addRRsig(createRdata(RRType::RRSIG(), RRClass::IN(),
+                                "A 5 3 3600 20000201000000 20000101000000 "
+                                "12345 example.org. FAKEFAKEFAKE"));
+    checkRender(*rrset, 2);
+}
+
+TEST_F(MasterTextRendererTest, emptyRRset) {
+    RRset any(Name("example.org"), RRClass::ANY(), RRType::A(), RRTTL(0));
+    checkRender(any, 1);
+    RRset none(Name("example.org"), RRClass::NONE(), RRType::A(), RRTTL(0));
+    checkRender(none, 1);
+
+    // The text rendered before is kept.
+    const size_t length = renderer.getLength();
+    RRset empty(Name("example.org"), RRClass::IN(), RRType::A(), RRTTL(0));
+    EXPECT_THROW(renderer.render(empty), EmptyRRset);
+    EXPECT_EQ(length, renderer.getLength());
+}
+
+TEST_F(MasterTextRendererTest, flush) {
+    RRsetPtr rrset = createRRset("www.example.org", RRType::A(),
+                                 "192.0.2.1");
+    renderer.render(*rrset);
+    std::ostringstream os;
+    renderer.flush(os);
+    EXPECT_EQ(rrset->toText(), os.str());
+    EXPECT_EQ(0, renderer.getLength());
+
+    renderer.render(*rrset);
+    renderer.clear();
+    EXPECT_EQ(0, renderer.getLength());
+    checkRender(*rrset, 1);
+}
+
+}
@@ -638,6 +638,37 @@ TEST_F(MessageTest, fromWireMultiple) {
     checkMessageFromWire(message_parse, test_name);
 }
 
+TEST_F(MessageTest, fromWireReuseQuestion) {
+    // Question objects of a previous message may be recycled internally,
+    // but those still referenced by the application must be kept intact.
+    factoryFromFile(message_parse, "message_fromWire1");
+    const ConstQuestionPtr question = *message_parse.beginQuestion();
+
+    message_render.setQid(0x1035);
+    message_render.setOpcode(Opcode::QUERY());
+    message_render.setRcode(Rcode::NOERROR());
+    message_render.addQuestion(Question(Name("www.example.org"),
+                                        RRClass::CH(), RRType::TXT()));
+    message_render.toWire(renderer);
+    InputBuffer buffer(renderer.getData(), renderer.getLength());
+    message_parse.clear(Message::PARSE);
+    message_parse.fromWire(buffer);
+
+    EXPECT_EQ(test_name, question->getName());
+    EXPECT_EQ(RRClass::IN(), question->getClass());
+    EXPECT_EQ(RRType::A(), question->getType());
+    ASSERT_EQ(1, message_parse.getRRCount(Message::SECTION_QUESTION));
+    const ConstQuestionPtr new_question = *message_parse.beginQuestion();
+    EXPECT_NE(question, new_question);
+    EXPECT_EQ(Name("www.example.org"), new_question->getName());
+    EXPECT_EQ(RRClass::CH(), new_question->getClass());
+    EXPECT_EQ(RRType::TXT(), new_question->getType());
+
+    // Once released, it can be reused for the same content again.
+    factoryFromFile(message_parse, "message_fromWire1");
+    checkMessageFromWire(message_parse, test_name);
+}
+
 TEST_F(MessageTest, fromWireShortBuffer) {
     // We trim a valid message (ending with an SOA RR) for one byte.
     // fromWire() should throw an exception while parsing the trimmed RR.
@@ -280,6 +280,36 @@ TEST_F(MessageRendererTest, setBufferErrors) {
     EXPECT_NO_THROW(renderer.setBuffer(NULL));
 }
 
+TEST_F(MessageRendererTest, externalStorage) {
+    // Render the same names as the writeName test into a storage just
+    // large enough for the first two of them.
+    UnitTestUtil::readWireData("name_toWire1", data);
+    std::vector<uint8_t> storage(data.size() - 2);
+    const void* const storage_head = &storage[0];
+    MessageRenderer ext_renderer(&storage[0], storage.size());
+    ext_renderer.writeName(Name("a.example.com."));
+    ext_renderer.writeName(Name("b.example.com."));
+    EXPECT_EQ(storage_head, ext_renderer.getData());
+    matchWireData(&data[0], ext_renderer.getLength(),
+                  &storage[0], ext_renderer.getLength());
+
+    // The rest doesn't fit, and the whole data are moved elsewhere.  Name
+    // compression still works.
+    ext_renderer.writeName(Name("a.example.org."));
+    EXPECT_NE(storage_head, ext_renderer.getData());
+    matchWireData(&data[0], data.size(),
+                  ext_renderer.getData(), ext_renderer.getLength());
+
+    // Resetting to the default buffer is harmless.
+    OutputBuffer new_buffer(0);
+    ext_renderer.clear();
+    ext_renderer.setBuffer(&new_buffer);
+    ext_renderer.setBuffer(NULL);
+    ext_renderer.writeName(Name("a.example.com."));
+    EXPECT_EQ(data[0], static_cast<const uint8_t*>(
+                  ext_renderer.getData())[0]);
+}
+
 TEST_F(MessageRendererTest, manyRRs) {
     // Render a large number of names, and the confirm the resulting wire
     // data store the expected names in the correct order (1000 is an
@@ -291,8 +321,42 @@ TEST_F(MessageRendererTest, manyRRs) {
     for (size_t i = 0; i < 1000; ++i) {
         EXPECT_EQ(Name(lexical_cast<std::string>(i) + ".example"), Name(b));
     }
-    // This will trigger trimming excessive hash items.  It shouldn't cause
+    // This will invalidate all hash items at once.  It shouldn't cause
     // any disruption.
     EXPECT_NO_THROW(renderer.clear());
 }
+
+TEST_F(MessageRendererTest, manyRRsCompression) {
+    // Render enough names to make the internal hash table grow, twice.
+    // All names of the second round should be compressed into a single
+    // pointer to the corresponding name of the first round.
+    for (int j = 0; j < 2; ++j) {
+        for (size_t i = 0; i < 1000; ++i) {
+            renderer.writeName(Name(lexical_cast<std::string>(i) +
+                                    ".example"));
+        }
+    }
+    const size_t first_len = renderer.getLength() - 1000 * 2;
+    bundy::util::InputBuffer b(renderer.getData(), renderer.getLength());
+    b.setPosition(first_len);
+    for (size_t i = 0; i < 1000; ++i) {
+        EXPECT_EQ(Name(lexical_cast<std::string>(i) + ".example"), Name(b));
+    }
+    const std::vector<uint8_t> first_data(
+        static_cast<const uint8_t*>(renderer.getData()),
+        static_cast<const uint8_t*>(renderer.getData()) +
+        renderer.getLength());
+
+    // After clear(), no name should be compressed with the old ones, so
+    // the rendered data should be identical.
+    renderer.clear();
+    for (int j = 0; j < 2; ++j) {
+        for (size_t i = 0; i < 1000; ++i) {
+            renderer.writeName(Name(lexical_cast<std::string>(i) +
+                                    ".example"));
+        }
+    }
+    matchWireData(&first_data[0], first_data.size(),
+                  renderer.getData(), renderer.getLength());
+}
 }
@@ -284,6 +284,10 @@ TEST_F(NameTest, fromText) {
                                   "123456789.123456789.123456789.123456789."
                                   "123456789.123456789.123456789.123456789."
                                   "123456789.1234");
+    // Same, when the name data reach the limit at the end of a label
+    checkBadTextName<TooLongName>(string(63, 'a') + "." + string(63, 'a') +
+                                  "." + string(63, 'a') + "." +
+                                  string(61, 'a') + ".b");
     // This is a possible longest name and should be accepted
     EXPECT_NO_THROW(Name(string(max_len_str)));
     // \DDD must consist of 3 digits.
@@ -460,6 +464,31 @@ TEST_F(NameTest, assignment) {
     EXPECT_EQ(example_name, copy);
 }
 
+TEST_F(NameTest, longNames) {
+    // Names that don't fit in the storage of the object itself are
+    // allocated separately; check they work the same way, including copies
+    // and assignments between short and long names.
+    const Name long_name(max_len_str);
+    const Name many_labels(max_labels_str);
+
+    Name copy(long_name);
+    EXPECT_EQ(long_name, copy);
+    copy = example_name;
+    EXPECT_EQ(example_name, copy);
+    copy = long_name;
+    EXPECT_EQ(long_name, copy);
+    copy = many_labels;
+    EXPECT_EQ(many_labels, copy);
+    EXPECT_EQ(Name::MAX_LABELS, copy.getLabelCount());
+    copy = Name(".");
+    EXPECT_EQ(Name::ROOT_NAME(), copy);
+
+    EXPECT_EQ(long_name, long_name.reverse().reverse());
+    EXPECT_EQ(many_labels, many_labels.split(0, 1).concatenate(
+                  many_labels.split(1)));
+    EXPECT_EQ(long_name.toText(), Name(long_name.toText()).toText());
+}
+
 TEST_F(NameTest, toText) {
     // tests derived from BIND9
     EXPECT_EQ("a.b.c.d", Name("a.b.c.d").toText(true));
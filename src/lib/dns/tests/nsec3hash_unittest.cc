@@ -12,6 +12,7 @@
 // OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
 // PERFORMANCE OF THIS SOFTWARE.
 
+#include <vector>
 #include <string>
 
 #include <gtest/gtest.h>
@@ -138,6 +139,44 @@ TEST_F(NSEC3HashTest, calculate) {
               ->calculate(LabelSequence(Name("example.org"))));
 }
 
+TEST_F(NSEC3HashTest, calculateLongSalt) {
+    // The digest and the salt of the additional iterations fit in a single
+    // SHA1 block with a salt of up to 35 bytes.  Check both sides of that
+    // boundary.  (expected hash values calculated independently)
+    uint8_t salt[36];
+    for (size_t i = 0; i < sizeof(salt); ++i) {
+        salt[i] = i;
+    }
+    EXPECT_EQ("LIIBO37TKB8A59203HBENH9PG37GR887",
+              NSEC3HashPtr(NSEC3Hash::create(1, 5, salt, 35))
+              ->calculate(Name("example")));
+    EXPECT_EQ("BCGJ0S0E04TCJRD0IHL1IUIB0V7REISB",
+              NSEC3HashPtr(NSEC3Hash::create(1, 5, salt, 36))
+              ->calculate(Name("example")));
+}
+
+TEST_F(NSEC3HashTest, calculateBatch) {
+    const Name name("x.a.EXAMPLE");
+    vector<LabelSequence> names;
+    LabelSequence ls(name);
+    names.push_back(ls);
+    ls.stripLeft(1);
+    names.push_back(ls);
+    ls.stripLeft(1);
+    names.push_back(ls);
+
+    // Existing content of the result vector will be replaced.
+    vector<string> hashes(5, "garbage");
+    test_hash->calculateBatch(names, hashes);
+    ASSERT_EQ(3, hashes.size());
+    EXPECT_EQ("57F4SV1FHVKA0GTGATDOH58EN15OKOKK", hashes[0]);
+    EXPECT_EQ("35MTHGPGCU1QG68FAB165KLNSNK3DPVL", hashes[1]);
+    EXPECT_EQ("0P9MHAVEQVM6T7VBL5LOP2U3T2RP3TOM", hashes[2]);
+
+    test_hash->calculateBatch(vector<LabelSequence>(), hashes);
+    EXPECT_TRUE(hashes.empty());
+}
+
 // Common checks for match cases
 template <typename RDATAType>
 void
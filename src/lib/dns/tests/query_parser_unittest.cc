@@ -0,0 +1,258 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <dns/query_parser.h>
+
+#include <dns/edns.h>
+#include <dns/labelsequence.h>
+#include <dns/message.h>
+#include <dns/messagerenderer.h>
+#include <dns/name.h>
+#include <dns/opcode.h>
+#include <dns/question.h>
+#include <dns/rcode.h>
+#include <dns/rdata.h>
+#include <dns/rdataclass.h>
+#include <dns/rrclass.h>
+#include <dns/rrset.h>
+#include <dns/rrttl.h>
+#include <dns/rrtype.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace bundy::dns;
+using namespace bundy::dns::rdata;
+using std::vector;
+
+namespace {
+class QueryParserTest : public ::testing::Test {
+protected:
+    QueryParserTest() :
+        message_(Message::RENDER), qname_("www.Example.com")
+    {
+        resetMessage(qname_, RRClass::IN(), RRType::AAAA());
+    }
+
+    // Make message_ a new query with the given question.
+    void resetMessage(const Name& qname, const RRClass& qclass,
+                      const RRType& qtype)
+    {
+        message_.clear(Message::RENDER);
+        message_.setQid(0x1035);
+        message_.setOpcode(Opcode::QUERY());
+        message_.setRcode(Rcode::NOERROR());
+        message_.setHeaderFlag(Message::HEADERFLAG_RD);
+        message_.addQuestion(Question(qname, qclass, qtype));
+        renderer_.clear();
+    }
+
+    // Render the message into wire_.
+    void render() {
+        message_.toWire(renderer_);
+        const uint8_t* const data =
+            static_cast<const uint8_t*>(renderer_.getData());
+        wire_.assign(data, data + renderer_.getLength());
+    }
+
+    bool parse() {
+        return (parser_.parse(&wire_[0], wire_.size()));
+    }
+
+    RRsetPtr createTSIG() const {
+        RRsetPtr rrset(new RRset(Name("key.example"), RRClass::ANY(),
+                                 RRType::TSIG(), RRTTL(0)));
+        rrset->addRdata(createRdata(RRType::TSIG(), RRClass::ANY(),
+                                    "hmac-md5.sig-alg.reg.int. 1302890362 "
+                                    "300 0 11621 0 0"));
+        return (rrset);
+    }
+
+    Message message_;
+    const Name qname_;
+    MessageRenderer renderer_;
+    vector<uint8_t> wire_;
+    QueryParser parser_;
+};
+
+TEST_F(QueryParserTest, parse) {
+    render();
+    EXPECT_TRUE(parse());
+    EXPECT_EQ(0x1035, parser_.getQid());
+    EXPECT_TRUE(parser_.getHeaderFlag(Message::HEADERFLAG_RD));
+    EXPECT_FALSE(parser_.getHeaderFlag(Message::HEADERFLAG_CD));
+    EXPECT_TRUE(parser_.getQName().equals(LabelSequence(qname_), true));
+    EXPECT_EQ(3, parser_.getQName().getLabelCount() - 1);
+    EXPECT_EQ(RRType::AAAA(), parser_.getQType());
+    EXPECT_EQ(RRClass::IN(), parser_.getQClass());
+    EXPECT_FALSE(parser_.hasEDNS());
+    EXPECT_EQ(static_cast<uint16_t>(Message::DEFAULT_MAX_UDPSIZE),
+              parser_.getUDPSize());
+    EXPECT_FALSE(parser_.getDNSSECAwareness());
+    EXPECT_FALSE(parser_.hasTSIG());
+    EXPECT_EQ(0, parser_.getTSIGPosition());
+
+    // The name refers to the given data, not a copy of it.
+    size_t len;
+    EXPECT_EQ(&wire_[12], parser_.getQName().getData(&len));
+    EXPECT_EQ(qname_.getLength(), len);
+
+    // The root name
+    resetMessage(Name::ROOT_NAME(), RRClass::CH(), RRType::NS());
+    render();
+    EXPECT_TRUE(parse());
+    EXPECT_TRUE(parser_.getQName().equals(
+                    LabelSequence(Name::ROOT_NAME())));
+    EXPECT_EQ(RRClass::CH(), parser_.getQClass());
+}
+
+TEST_F(QueryParserTest, parseEDNS) {
+    EDNSPtr edns(new EDNS());
+    edns->setUDPSize(1232);
+    edns->setDNSSECAwareness(true);
+    message_.setEDNS(edns);
+    render();
+    EXPECT_TRUE(parse());
+    EXPECT_TRUE(parser_.hasEDNS());
+    EXPECT_EQ(0, parser_.getEDNSVersion());
+    EXPECT_EQ(1232, parser_.getUDPSize());
+    EXPECT_TRUE(parser_.getDNSSECAwareness());
+    EXPECT_FALSE(parser_.hasTSIG());
+
+    // Unsupported versions are reported as is (the OPT RR is at the end).
+    wire_[wire_.size() - 11 + 6] = 1;
+    EXPECT_TRUE(parse());
+    EXPECT_EQ(1, parser_.getEDNSVersion());
+
+    // A second parse resets the EDNS parameters.
+    resetMessage(qname_, RRClass::IN(), RRType::A());
+    render();
+    EXPECT_TRUE(parse());
+    EXPECT_FALSE(parser_.hasEDNS());
+    EXPECT_EQ(0, parser_.getEDNSVersion());
+    EXPECT_EQ(static_cast<uint16_t>(Message::DEFAULT_MAX_UDPSIZE),
+              parser_.getUDPSize());
+    EXPECT_FALSE(parser_.getDNSSECAwareness());
+}
+
+TEST_F(QueryParserTest, parseTSIG) {
+    // Append a TSIG RR after the OPT RR, like the signer would do.
+    EDNSPtr edns(new EDNS());
+    edns->setUDPSize(4096);
+    message_.setEDNS(edns);
+    render();
+    const size_t tsig_pos = wire_.size();
+    MessageRenderer tsig_renderer;
+    createTSIG()->toWire(tsig_renderer);
+    const uint8_t* const tsig_data =
+        static_cast<const uint8_t*>(tsig_renderer.getData());
+    wire_.insert(wire_.end(), tsig_data,
+                 tsig_data + tsig_renderer.getLength());
+    ++wire_[11];
+    EXPECT_TRUE(parse());
+    EXPECT_TRUE(parser_.hasEDNS());
+    EXPECT_EQ(4096, parser_.getUDPSize());
+    EXPECT_TRUE(parser_.hasTSIG());
+    EXPECT_EQ(tsig_pos, parser_.getTSIGPosition());
+
+    // TSIG only
+    resetMessage(qname_, RRClass::IN(), RRType::A());
+    message_.addRRset(Message::SECTION_ADDITIONAL, createTSIG());
+    render();
+    EXPECT_TRUE(parse());
+    EXPECT_FALSE(parser_.hasEDNS());
+    EXPECT_TRUE(parser_.hasTSIG());
+    EXPECT_EQ(12 + qname_.getLength() + 4, parser_.getTSIGPosition());
+}
+
+TEST_F(QueryParserTest, parseNonSimple) {
+    render();
+
+    // Too short
+    EXPECT_FALSE(parser_.parse(&wire_[0], 11));
+    EXPECT_FALSE(parser_.parse(&wire_[0], wire_.size() - 1));
+
+    // Trailing garbage
+    wire_.push_back(0);
+    EXPECT_FALSE(parse());
+    wire_.pop_back();
+
+    // Responses
+    wire_[2] |= 0x80;
+    EXPECT_FALSE(parse());
+    wire_[2] &= ~0x80;
+
+    // Non QUERY opcode (NOTIFY)
+    wire_[2] |= (Opcode::NOTIFY_CODE << 3);
+    EXPECT_FALSE(parse());
+    wire_[2] &= ~(Opcode::NOTIFY_CODE << 3);
+
+    // Bad section counts
+    for (size_t pos = 4; pos < 12; pos += 2) {
+        ++wire_[pos + 1];
+        EXPECT_FALSE(parse()) << pos;
+        --wire_[pos + 1];
+    }
+    wire_[5] = 0;
+    EXPECT_FALSE(parse());
+    wire_[5] = 1;
+
+    // Compressed (insanely, pointing to the header) and extended labels
+    wire_[12] = 0xc0;
+    EXPECT_FALSE(parse());
+    wire_[12] = 0x40;
+    EXPECT_FALSE(parse());
+    wire_[12] = 3;
+
+    // It's still good at this point.
+    EXPECT_TRUE(parse());
+}
+
+TEST_F(QueryParserTest, parseBadAdditional) {
+    // Non-root owner name of OPT.  We use an RRset of type OPT to build it.
+    RRsetPtr opt(new RRset(Name("example"), RRClass(4096), RRType::OPT(),
+                           RRTTL(0)));
+    opt->addRdata(ConstRdataPtr(new generic::OPT()));
+    message_.addRRset(Message::SECTION_ADDITIONAL, opt);
+    render();
+    EXPECT_FALSE(parse());
+
+    // Multiple OPT RRs.
+    resetMessage(qname_, RRClass::IN(), RRType::A());
+    opt.reset(new RRset(Name::ROOT_NAME(), RRClass(4096), RRType::OPT(),
+                        RRTTL(0)));
+    opt->addRdata(ConstRdataPtr(new generic::OPT()));
+    message_.addRRset(Message::SECTION_ADDITIONAL, opt);
+    message_.setEDNS(EDNSPtr(new EDNS()));
+    render();
+    EXPECT_FALSE(parse());
+
+    // TSIG which is not the last RR.
+    resetMessage(qname_, RRClass::IN(), RRType::A());
+    message_.addRRset(Message::SECTION_ADDITIONAL, createTSIG());
+    message_.addRRset(Message::SECTION_ADDITIONAL, opt);
+    render();
+    EXPECT_FALSE(parse());
+
+    // Other types of RRs.
+    resetMessage(qname_, RRClass::IN(), RRType::A());
+    RRsetPtr rrset(new RRset(qname_, RRClass::IN(), RRType::A(),
+                             RRTTL(3600)));
+    rrset->addRdata(createRdata(RRType::A(), RRClass::IN(), "192.0.2.1"));
+    message_.addRRset(Message::SECTION_ADDITIONAL, rrset);
+    render();
+    EXPECT_FALSE(parse());
+}
+}
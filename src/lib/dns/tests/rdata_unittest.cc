@@ -214,6 +214,79 @@ TEST_F(RdataTest, createRdataWithLexer) {
                    "file does not end with newline");
 }
 
+// The most common types are created without the RDATA factories, check
+// they're the same as those created by them, and that the errors are
+// still reported by the generic constructors.
+TEST_F(RdataTest, createRdataWithLexerCommonTypes) {
+    const Name origin("example.org.");
+    stringstream ss;
+    ss << "192.0.2.1\n";
+    ss << "(192.0.2.255)\n";     // parentheses are handled by the lexer
+    ss << "0.0.0.0\n";
+    ss << "2001:db8::1\n";
+    ss << "::ffff:192.0.2.1\n";
+    ss << "ns.example.com.\n";
+    ss << "ns\n";                // relative to the origin
+    ss << "www\n";
+    ss << "1.2.0.192.in-addr.arpa.\n";
+    ss << "192.0.2\n";           // invalid addresses
+    ss << "192.0.2.256\n";
+    ss << "2001:db8:::1\n";
+    ss << "\"192.0.2.1\"\n";     // not a plain string
+    ss << "bad..name\n";
+    lexer.pushSource(ss);
+
+    CreateRdataCallback callback;
+    MasterLoaderCallbacks callbacks(
+        boost::bind(&CreateRdataCallback::callback, &callback,
+                    CreateRdataCallback::ERROR, _1, _2, _3),
+        boost::bind(&CreateRdataCallback::callback, &callback,
+                    CreateRdataCallback::WARN,  _1, _2, _3));
+
+    const RRType types[] = {
+        RRType::A(), RRType::A(), RRType::A(), RRType::AAAA(),
+        RRType::AAAA(), RRType::NS(), RRType::CNAME(), RRType::PTR(),
+        RRType::PTR()
+    };
+    const char* const texts[] = {
+        "192.0.2.1", "192.0.2.255", "0.0.0.0", "2001:db8::1",
+        "::ffff:192.0.2.1", "ns.example.com.", "ns.example.org.",
+        "www.example.org.", "1.2.0.192.in-addr.arpa."
+    };
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); ++i) {
+        SCOPED_TRACE(texts[i]);
+        const ConstRdataPtr rdata = createRdata(types[i], RRClass::IN(),
+                                                lexer, &origin,
+                                                MasterLoader::MANY_ERRORS,
+                                                callbacks);
+        ASSERT_TRUE(rdata);
+        EXPECT_EQ(0, createRdata(types[i], RRClass::IN(),
+                                 texts[i])->compare(*rdata));
+        EXPECT_FALSE(callback.isCalled());
+    }
+
+    const RRType error_types[] = {
+        RRType::A(), RRType::A(), RRType::AAAA(), RRType::A(), RRType::NS()
+    };
+    const char* const errors[] = {
+        "createRdata from text failed: Bad IN/A RDATA text: '192.0.2'",
+        "createRdata from text failed: Bad IN/A RDATA text: '192.0.2.256'",
+        "createRdata from text failed: Bad IN/AAAA RDATA text: "
+        "'2001:db8:::1'",
+        "createRdata from text failed: unexpected quotes",
+        "createRdata from text failed: duplicate period in bad..name"
+    };
+    for (size_t i = 0; i < sizeof(error_types) / sizeof(error_types[0]);
+         ++i) {
+        callback.clear();
+        EXPECT_FALSE(createRdata(error_types[i], RRClass::IN(), lexer,
+                                 &origin, MasterLoader::MANY_ERRORS,
+                                 callbacks));
+        callback.check(lexer.getSourceName(), 10 + i,
+                       CreateRdataCallback::ERROR, errors[i]);
+    }
+}
+
 TEST_F(RdataTest, getLength) {
     const in::AAAA aaaa_rdata("2001:db8::1");
     EXPECT_EQ(16, aaaa_rdata.getLength());
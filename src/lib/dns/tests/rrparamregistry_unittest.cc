@@ -93,6 +93,28 @@ TEST_F(RRParamRegistryTest, addRemove) {
     EXPECT_FALSE(RRParamRegistry::getRegistry().removeClass(test_class_code));
 }
 
+TEST_F(RRParamRegistryTest, addRemoveSmallCode) {
+    // Smaller codes are managed differently from the large test codes
+    // internally; the behavior should be the same.  We assume 500 is also
+    // unassigned for both types and classes.
+    RRParamRegistry::getRegistry().addType(test_type_str, 500);
+    RRParamRegistry::getRegistry().addClass(test_class_str, 500);
+    EXPECT_EQ(500, RRType("TESTTYPE").getCode());
+    EXPECT_EQ(500, RRClass("TESTCLASS").getCode());
+    // Textual representations are case insensitive.
+    EXPECT_EQ(500, RRType("testtype").getCode());
+    EXPECT_EQ(500, RRClass("TestClass").getCode());
+    EXPECT_EQ(test_type_str, RRType(500).toText());
+    EXPECT_EQ(test_class_str, RRClass(500).toText());
+
+    EXPECT_TRUE(RRParamRegistry::getRegistry().removeType(500));
+    EXPECT_EQ("TYPE500", RRType(500).toText());
+    EXPECT_FALSE(RRParamRegistry::getRegistry().removeType(500));
+    EXPECT_TRUE(RRParamRegistry::getRegistry().removeClass(500));
+    EXPECT_EQ("CLASS500", RRClass(500).toText());
+    EXPECT_FALSE(RRParamRegistry::getRegistry().removeClass(500));
+}
+
 TEST_F(RRParamRegistryTest, addError) {
     // An attempt to override a pre-registered class should fail with an
     // exception, and the pre-registered one should remain in the registry.
@@ -160,6 +182,28 @@ TEST_F(RRParamRegistryTest, addRemoveFactory) {
                      RRType(test_type_code)));
 }
 
+TEST_F(RRParamRegistryTest, classSpecificFactories) {
+    // A type can have factories for multiple classes, each found
+    // independently, and removing one of them doesn't affect the others.
+    // This is a well known type with factories for IN, CH and HS.
+    EXPECT_EQ(0, in::A("192.0.2.1").compare(
+                  *createRdata(RRType::A(), RRClass::IN(), "192.0.2.1")));
+    RRParamRegistry::getRegistry().add("A", 1, test_class_str,
+                                       test_class_code,
+                                       RdataFactoryPtr(new TestRdataFactory));
+    EXPECT_EQ(0, in::A("192.0.2.1").compare(
+                  *createRdata(RRType::A(), RRClass(test_class_code),
+                               "192.0.2.1")));
+    EXPECT_TRUE(RRParamRegistry::getRegistry().removeRdataFactory(
+                    RRType::A(), RRClass(test_class_code)));
+    EXPECT_THROW(createRdata(RRType::A(), RRClass(test_class_code),
+                             "192.0.2.1"),
+                 InvalidRdataText);
+    EXPECT_EQ(0, in::A("192.0.2.1").compare(
+                  *createRdata(RRType::A(), RRClass::IN(), "192.0.2.1")));
+    EXPECT_NO_THROW(createRdata(RRType::A(), RRClass::CH(), "192.0.2.1"));
+}
+
 RdataPtr
 createRdataHelper(const std::string& str) {
     boost::scoped_ptr<AbstractRdataFactory> rdf(new TestRdataFactory);
@@ -172,6 +172,60 @@ TEST_F(RRsetCollectionTest, iteratorTest) {
     EXPECT_EQ(4, count);
 }
 
+TEST_F(RRsetCollectionTest, iteratorOrder) {
+    // RRsets added after an iteration are iterated in the order of their
+    // class, type and name, too.
+    RRsetPtr rrset(new BasicRRset(Name("a.example.org"), rrclass, RRType::A(),
+                                  RRTTL(3600)));
+    rrset->addRdata(in::A("192.0.2.1"));
+    collection.addRRset(rrset);
+    rrset.reset(new BasicRRset(Name("z.example.org"), rrclass, RRType::A(),
+                               RRTTL(3600)));
+    rrset->addRdata(in::A("192.0.2.2"));
+    collection.addRRset(rrset);
+    rrset.reset(new BasicRRset(Name("example.org"), RRClass::CH(),
+                               RRType::TXT(), RRTTL(3600)));
+    rrset->addRdata(generic::TXT("foo"));
+    collection.addRRset(rrset);
+
+    size_t count = 0;
+    RRsetCollection::Iterator prev = collection.end();
+    for (RRsetCollection::Iterator it = collection.begin();
+         it != collection.end(); ++it) {
+        ++count;
+        if (prev != collection.end()) {
+            const AbstractRRset& prev_rrset = *prev;
+            const AbstractRRset& cur_rrset = *it;
+            EXPECT_TRUE(
+                boost::make_tuple(prev_rrset.getClass(), prev_rrset.getType(),
+                                  prev_rrset.getName()) <
+                boost::make_tuple(cur_rrset.getClass(), cur_rrset.getType(),
+                                  cur_rrset.getName()));
+        }
+        prev = it;
+    }
+    EXPECT_EQ(7, count);
+
+    // Removing an RRset takes it out of the iteration.
+    EXPECT_TRUE(collection.removeRRset(Name("a.example.org"), rrclass,
+                                       RRType::A()));
+    count = 0;
+    for (RRsetCollection::Iterator it = collection.begin();
+         it != collection.end(); ++it) {
+        ++count;
+    }
+    EXPECT_EQ(6, count);
+}
+
+TEST_F(RRsetCollectionTest, findCaseInsensitive) {
+    EXPECT_TRUE(collection.find(Name("WWW.Example.ORG"), rrclass,
+                                RRType::A()));
+    EXPECT_TRUE(collection.removeRRset(Name("Www.EXAMPLE.org"), rrclass,
+                                       RRType::A()));
+    EXPECT_FALSE(collection.find(Name("www.example.org"), rrclass,
+                                 RRType::A()));
+}
+
 // This is a dummy class which is used in iteratorCompareDifferent test
 // to compare iterators from different RRsetCollectionBase
 // implementations.
@@ -19,12 +19,16 @@
 #include <exceptions/exceptions.h>
 
 #include <cryptolink/cryptolink.h>
+#include <cryptolink/crypto_hmac.h>
 
 #include <dns/tsigkey.h>
 
 #include <dns/tests/unittest_util.h>
+#include <util/buffer.h>
 #include <util/unittests/wiredata.h>
 
+#include <boost/shared_ptr.hpp>
+
 using namespace std;
 using namespace bundy::dns;
 using bundy::UnitTestUtil;
@@ -302,6 +306,53 @@ TEST_F(TSIGKeyRingTest, findFromSome) {
               keyring.find(Name("another.example"), sha256_name).key);
 }
 
+TEST_F(TSIGKeyRingTest, findCaseInsensitive) {
+    EXPECT_EQ(TSIGKeyRing::SUCCESS, keyring.add(TSIGKey(Name("Key.Example"),
+                                                        sha1_name,
+                                                        secret, secret_len)));
+    const TSIGKeyRing::FindResult result(
+        keyring.find(Name("kEY.eXAMPLE"), sha1_name));
+    EXPECT_EQ(TSIGKeyRing::SUCCESS, result.code);
+    EXPECT_EQ(Name("key.example"), result.key->getKeyName());
+    EXPECT_EQ(TSIGKeyRing::SUCCESS, keyring.remove(Name("KEY.EXAMPLE")));
+    EXPECT_EQ(0, keyring.size());
+}
+
+// The HMAC objects cloned from the one set up by the key ring compute the
+// same digest as the ones created from the secret.
+TEST_F(TSIGKeyRingTest, createHMAC) {
+    using namespace bundy::cryptolink;
+
+    const TSIGKey key(key_name, sha256_name, secret, secret_len);
+    EXPECT_EQ(TSIGKeyRing::SUCCESS, keyring.add(key));
+    const TSIGKeyRing::FindResult result(keyring.find(key_name, sha256_name));
+    ASSERT_EQ(TSIGKeyRing::SUCCESS, result.code);
+
+    bundy::util::OutputBuffer expected(0);
+    boost::shared_ptr<HMAC> hmac(key.createHMAC(), deleteHMAC);
+    hmac->update("data", 4);
+    hmac->sign(expected, hmac->getOutputLength());
+
+    // Twice, to check the clones don't share their state.  The copy of the
+    // key shares the object of the key ring.
+    const TSIGKey copy(*result.key);
+    for (int i = 0; i < 2; ++i) {
+        bundy::util::OutputBuffer actual(0);
+        boost::shared_ptr<HMAC> clone(copy.createHMAC(), deleteHMAC);
+        clone->update("data", 4);
+        clone->sign(actual, clone->getOutputLength());
+        matchWireData(expected.getData(), expected.getLength(),
+                      actual.getData(), actual.getLength());
+    }
+
+    // A key with an unknown algorithm can be stored, but not used.
+    EXPECT_EQ(TSIGKeyRing::SUCCESS,
+              keyring.add(TSIGKey(Name("unknown.example"),
+                                  Name("unknown-alg"), NULL, 0)));
+    EXPECT_THROW(keyring.find(Name("unknown.example")).key->createHMAC(),
+                 UnsupportedAlgorithm);
+}
+
 TEST(TSIGStringTest, TSIGKeyFromToString) {
     TSIGKey k1 = TSIGKey("test.example:MSG6Ng==:hmac-md5.sig-alg.reg.int");
     TSIGKey k2 = TSIGKey("test.example.:MSG6Ng==:hmac-md5.sig-alg.reg.int.");
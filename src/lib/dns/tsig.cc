@@ -75,10 +75,7 @@ struct TSIGContext::TSIGContextImpl {
             // it at this moment; a subsequent sign/verify operation will try
             // to create the HMAC, which would also fail.
             try {
-                hmac_.reset(CryptoLink::getCryptoLink().createHMAC(
-                                key_.getSecret(), key_.getSecretLength(),
-                                key_.getAlgorithm()),
-                            deleteHMAC);
+                hmac_.reset(key_.createHMAC(), deleteHMAC);
             } catch (const bundy::Exception&) {
                 return;
             }
@@ -109,20 +106,17 @@ struct TSIGContext::TSIGContextImpl {
     }
 
     // A shortcut method to create an HMAC object for sign/verify.  If one
-    // has been successfully created in the constructor, return it; otherwise
-    // create a new one and return it.  In the former case, the ownership is
-    // transferred to the caller; the stored HMAC will be reset after the
-    // call.
+    // has been successfully created in the constructor (or is kept from
+    // a previous sign/verify or update), return it; otherwise create a new
+    // one and return it.  In the former case, the ownership is transferred
+    // to the caller; the stored HMAC will be reset after the call.
     HMACPtr createHMAC() {
         if (hmac_) {
             HMACPtr ret = HMACPtr();
             ret.swap(hmac_);
             return (ret);
         }
-        return (HMACPtr(CryptoLink::getCryptoLink().createHMAC(
-                            key_.getSecret(), key_.getSecretLength(),
-                            key_.getAlgorithm()),
-                        deleteHMAC));
+        return (HMACPtr(key_.createHMAC(), deleteHMAC));
     }
 
     // The following three are helper methods to compute the digest for
@@ -414,6 +408,9 @@ TSIGContext::sign(const uint16_t qid, const void* const data,
     // Exception free from now on.
     impl_->previous_digest_.swap(digest);
     impl_->state_ = (impl_->state_ == INIT) ? SENT_REQUEST : SENT_RESPONSE;
+    // sign() has reset the HMAC for the same key; keep it for the next
+    // message of the same stream rather than deriving the key again.
+    impl_->hmac_ = hmac;
     return (tsig);
 }
 
@@ -535,8 +532,12 @@ TSIGContext::verify(const TSIGRecord* const record, const void* const data,
                                tsig_rdata.getOtherData(),
                                impl_->state_ == VERIFIED_RESPONSE);
 
-    // Verify the digest with the received signature.
-    if (hmac->verify(tsig_rdata.getMAC(), tsig_rdata.getMACSize())) {
+    // Verify the digest with the received signature.  The HMAC is reset
+    // for the same key by verify(), and is kept for the next message.
+    const bool verified = hmac->verify(tsig_rdata.getMAC(),
+                                       tsig_rdata.getMACSize());
+    impl_->hmac_ = hmac;
+    if (verified) {
         return (impl_->postVerifyUpdate(TSIGError::NOERROR(),
                                         tsig_rdata.getMAC(),
                                         tsig_rdata.getMACSize()));
@@ -12,7 +12,6 @@
 // OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
 // PERFORMANCE OF THIS SOFTWARE.
 
-#include <map>
 #include <utility>
 #include <vector>
 #include <sstream>
@@ -20,11 +19,16 @@
 #include <exceptions/exceptions.h>
 
 #include <cryptolink/cryptolink.h>
+#include <cryptolink/crypto_hmac.h>
 
 #include <dns/name.h>
+#include <dns/labelsequence.h>
 #include <util/encode/base64.h>
 #include <dns/tsigkey.h>
 
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
 using namespace std;
 using namespace bundy::cryptolink;
 
@@ -80,6 +84,9 @@ TSIGKey::TSIGKeyImpl {
     Name algorithm_name_;
     const bundy::cryptolink::HashAlgorithm algorithm_;
     const vector<uint8_t> secret_;
+    // The HMAC object cloned by createHMAC(), shared by the copies of
+    // the key.  It's never updated, so it can be cloned concurrently.
+    boost::shared_ptr<const HMAC> hmac_;
 };
 
 TSIGKey::TSIGKey(const Name& key_name, const Name& algorithm_name,
@@ -194,6 +201,32 @@ TSIGKey::getSecretLength() const {
     return (impl_->secret_.size());
 }
 
+HMAC*
+TSIGKey::createHMAC() const {
+    if (impl_->hmac_) {
+        return (impl_->hmac_->clone());
+    }
+    return (CryptoLink::getCryptoLink().createHMAC(getSecret(),
+                                                   getSecretLength(),
+                                                   getAlgorithm()));
+}
+
+void
+TSIGKey::preloadHMAC() {
+    if (impl_->hmac_ || impl_->algorithm_ == bundy::cryptolink::UNKNOWN_HASH ||
+        impl_->secret_.empty()) {
+        return;
+    }
+    try {
+        impl_->hmac_.reset(CryptoLink::getCryptoLink().createHMAC(
+                               getSecret(), getSecretLength(),
+                               getAlgorithm()),
+                           deleteHMAC);
+    } catch (const bundy::Exception&) {
+        // createHMAC() will report the error when the key is used.
+    }
+}
+
 std::string
 TSIGKey::toText() const {
     const vector<uint8_t> secret_v(static_cast<const uint8_t*>(getSecret()),
@@ -247,8 +280,18 @@ Name& TSIGKey::HMACSHA512_NAME() {
     return (alg_name);
 }
 
+namespace {
+// Hashes the key names in the key ring.  The names are compared case
+// insensitively, so is the hash.
+struct KeyNameHash {
+    size_t operator()(const Name& name) const {
+        return (LabelSequence(name).getFullHash(false, 0));
+    }
+};
+}
+
 struct TSIGKeyRing::TSIGKeyRingImpl {
-    typedef map<Name, TSIGKey> TSIGKeyMap;
+    typedef boost::unordered_map<Name, TSIGKey, KeyNameHash> TSIGKeyMap;
     typedef pair<Name, TSIGKey> NameAndKey;
     TSIGKeyMap keys;
 };
@@ -267,13 +310,13 @@ TSIGKeyRing::size() const {
 
 TSIGKeyRing::Result
 TSIGKeyRing::add(const TSIGKey& key) {
-    if (impl_->keys.insert(
-                TSIGKeyRingImpl::NameAndKey(key.getKeyName(), key)).second
-        == true) {
-        return (SUCCESS);
-    } else {
+    const pair<TSIGKeyRingImpl::TSIGKeyMap::iterator, bool> result =
+        impl_->keys.insert(TSIGKeyRingImpl::NameAndKey(key.getKeyName(), key));
+    if (!result.second) {
         return (EXIST);
     }
+    result.first->second.preloadHMAC();
+    return (SUCCESS);
 }
 
 TSIGKeyRing::Result
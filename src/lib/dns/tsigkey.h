@@ -195,6 +195,23 @@ public:
     /// \return The string representation of the given TSIGKey.
     std::string toText() const;
 
+    /// \brief Creates an HMAC object keyed with the secret of the key.
+    ///
+    /// The keys stored in a \c TSIGKeyRing keep an HMAC object whose key
+    /// has been set up when they were added, which is cloned; the others
+    /// create it from the secret with \c CryptoLink.
+    ///
+    /// The returned object must be freed with
+    /// \c bundy::cryptolink::deleteHMAC().
+    ///
+    /// \exception bundy::cryptolink::UnsupportedAlgorithm the algorithm of
+    /// the key is not supported.
+    /// \exception bundy::cryptolink::LibraryError an error occurred in the
+    /// crypto library.
+    ///
+    /// \return A new HMAC object.
+    bundy::cryptolink::HMAC* createHMAC() const;
+
     ///
     /// \name Well known algorithm names as defined in RFC2845 and RFC4635.
     ///
@@ -212,8 +229,16 @@ public:
     //@}
 
 private:
+    friend class TSIGKeyRing;
+
+    /// \brief Sets up the HMAC object cloned by \c createHMAC().
+    ///
+    /// The copies of the key share this object.  It is left unset if
+    /// the algorithm is not supported.
+    void preloadHMAC();
+
     struct TSIGKeyImpl;
-    const TSIGKeyImpl* impl_;
+    TSIGKeyImpl* impl_;
 };
 
 /// \brief A simple repository of a set of \c TSIGKey objects.
@@ -226,6 +251,10 @@ private:
 /// algorithms are considered to be the same, and cannot be stored in the
 /// key ring at the same time.
 ///
+/// The keys are indexed by a hash of their names, and each key keeps an
+/// HMAC object set up with its secret, so that \c TSIGKey::createHMAC()
+/// of a key found in the key ring only clones it.
+///
 /// <b>Implementation Note:</b>
 /// For simplicity the initial implementation requests the application make
 /// a copy of keys stored in the key ring if it needs to use the keys for
@@ -0,0 +1,193 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef ARGUMENT_SLOT_H
+#define ARGUMENT_SLOT_H
+
+#include <boost/any.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+
+#include <cstddef>
+#include <new>
+#include <typeinfo>
+
+namespace bundy {
+namespace hooks {
+
+/// @brief Storage for a single callout argument
+///
+/// This holds a value of any copyable type, like boost::any, but values
+/// that are no larger than two pointers (raw pointers, shared pointers,
+/// integers and the like - the arguments of most hooks) are stored inside
+/// the object rather than allocated on the heap.  In addition, setting a
+/// value of the same type as the one already held is a plain assignment.
+/// A slot that is reused for every packet therefore does not allocate.
+///
+/// This is used by CalloutHandle for the arguments registered with
+/// ServerHooks::registerArgument().
+class ArgumentSlot {
+public:
+    /// @brief Constructor
+    ///
+    /// Creates an empty slot.
+    ArgumentSlot() : ops_(NULL) {}
+
+    /// @brief Copy constructor
+    ArgumentSlot(const ArgumentSlot& other) : ops_(NULL) {
+        if (other.ops_ != NULL) {
+            other.ops_->copy(storage_.buf_, other.storage_.buf_);
+            ops_ = other.ops_;
+        }
+    }
+
+    /// @brief Assignment operator
+    ArgumentSlot& operator=(const ArgumentSlot& other) {
+        if (this != &other) {
+            clear();
+            if (other.ops_ != NULL) {
+                other.ops_->copy(storage_.buf_, other.storage_.buf_);
+                ops_ = other.ops_;
+            }
+        }
+        return (*this);
+    }
+
+    /// @brief Destructor
+    ~ArgumentSlot() {
+        clear();
+    }
+
+    /// @brief Set the value
+    ///
+    /// @param value Value to store.  It replaces any value already held.
+    template <typename T>
+    void set(const T& value) {
+        if (ops_ != NULL && *ops_->type == typeid(T)) {
+            *static_cast<T*>(ops_->get(storage_.buf_)) = value;
+            return;
+        }
+        clear();
+        Ops<T>::copyValue(storage_.buf_, value);
+        ops_ = &Ops<T>::table;
+    }
+
+    /// @brief Get the value
+    ///
+    /// @return Reference to the value held.
+    ///
+    /// @throw boost::bad_any_cast The slot is empty or holds a value of
+    ///        another type.
+    template <typename T>
+    const T& get() const {
+        if (ops_ == NULL || *ops_->type != typeid(T)) {
+            throw boost::bad_any_cast();
+        }
+        return (*static_cast<const T*>(ops_->get(
+                    const_cast<char*>(storage_.buf_))));
+    }
+
+    /// @brief Is the slot empty?
+    bool empty() const {
+        return (ops_ == NULL);
+    }
+
+    /// @brief Clear the slot
+    ///
+    /// Destroys the value held, if any.  N.B. If the value is a raw pointer,
+    /// the pointed-to data is NOT deleted.
+    void clear() {
+        if (ops_ != NULL) {
+            ops_->destroy(storage_.buf_);
+            ops_ = NULL;
+        }
+    }
+
+private:
+    /// Size of the values stored inline.
+    static const size_t INLINE_SIZE = 2 * sizeof(void*);
+
+    /// Type-specific operations on the stored value.
+    struct OpsTable {
+        const std::type_info* type;
+        void (*copy)(char* dst, const char* src);
+        void (*destroy)(char* buf);
+        void* (*get)(char* buf);
+    };
+
+    /// Operations for values of type T, which is stored inline if it's
+    /// small enough and as a pointer to a heap-allocated copy otherwise.
+    template <typename T,
+              bool Inline = (sizeof(T) <= INLINE_SIZE &&
+                             (sizeof(void*) % boost::alignment_of<T>::value)
+                             == 0)>
+    struct Ops {
+        static void copyValue(char* dst, const T& value) {
+            new(dst) T(value);
+        }
+        static void copy(char* dst, const char* src) {
+            new(dst) T(*reinterpret_cast<const T*>(src));
+        }
+        static void destroy(char* buf) {
+            reinterpret_cast<T*>(buf)->~T();
+        }
+        static void* get(char* buf) {
+            return (buf);
+        }
+        static const OpsTable table;
+    };
+
+    template <typename T>
+    struct Ops<T, false> {
+        static void copyValue(char* dst, const T& value) {
+            *reinterpret_cast<T**>(dst) = new T(value);
+        }
+        static void copy(char* dst, const char* src) {
+            *reinterpret_cast<T**>(dst) =
+                new T(**reinterpret_cast<T* const*>(src));
+        }
+        static void destroy(char* buf) {
+            delete *reinterpret_cast<T**>(buf);
+        }
+        static void* get(char* buf) {
+            return (*reinterpret_cast<T**>(buf));
+        }
+        static const OpsTable table;
+    };
+
+    /// Storage for the value, aligned for pointers.
+    union {
+        char buf_[INLINE_SIZE];
+        void* align_;
+    } storage_;
+
+    /// Operations for the value held; NULL if the slot is empty.
+    const OpsTable* ops_;
+};
+
+template <typename T, bool Inline>
+const ArgumentSlot::OpsTable ArgumentSlot::Ops<T, Inline>::table = {
+    &typeid(T), &Ops<T, Inline>::copy, &Ops<T, Inline>::destroy,
+    &Ops<T, Inline>::get
+};
+
+template <typename T>
+const ArgumentSlot::OpsTable ArgumentSlot::Ops<T, false>::table = {
+    &typeid(T), &Ops<T, false>::copy, &Ops<T, false>::destroy,
+    &Ops<T, false>::get
+};
+
+} // namespace hooks
+} // namespace bundy
+
+#endif // ARGUMENT_SLOT_H
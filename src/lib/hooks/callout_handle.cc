@@ -17,6 +17,7 @@
 #include <hooks/library_handle.h>
 #include <hooks/server_hooks.h>
 
+#include <algorithm>
 #include <string>
 #include <utility>
 #include <vector>
@@ -29,9 +30,11 @@ namespace hooks {
 // Constructor.
 CalloutHandle::CalloutHandle(const boost::shared_ptr<CalloutManager>& manager,
                     const boost::shared_ptr<LibraryManagerCollection>& lmcoll)
-    : lm_collection_(lmcoll), arguments_(), context_collection_(),
-      manager_(manager), server_hooks_(ServerHooks::getServerHooks()),
-      skip_(false) {
+    : lm_collection_(lmcoll), arguments_(),
+      slots_(ServerHooks::getServerHooks().getArgumentCount()),
+      context_collection_(), manager_(manager),
+      server_hooks_(ServerHooks::getServerHooks()), skip_(false),
+      parking_ticket_() {
 
     // Call the "context_create" hook.  We should be OK doing this - although
     // the constructor has not finished running, all the member variables
@@ -50,6 +53,7 @@ CalloutHandle::~CalloutHandle() {
     // Explicitly clear the argument and context objects.  This should free up
     // all memory that could have been allocated by libraries that were loaded.
     arguments_.clear();
+    slots_.clear();
     context_collection_.clear();
 
     // Normal destruction of the remaining variables will include the
@@ -72,14 +76,60 @@ vector<string>
 CalloutHandle::getArgumentNames() const {
 
     vector<string> names;
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        if (!slots_[i].empty()) {
+            names.push_back(server_hooks_.getArgumentName(i));
+        }
+    }
     for (ElementCollection::const_iterator i = arguments_.begin();
          i != arguments_.end(); ++i) {
         names.push_back(i->first);
     }
 
+    // Return the names in order, as when all arguments were held in the map.
+    sort(names.begin(), names.end());
     return (names);
 }
 
+// Delete all arguments.  The slots are only emptied, so that they can be
+// reused without allocation.
+
+void
+CalloutHandle::deleteAllArguments() {
+    for (vector<ArgumentSlot>::iterator i = slots_.begin(); i != slots_.end();
+         ++i) {
+        i->clear();
+    }
+    arguments_.clear();
+}
+
+// Return the slot of a registered argument, extending the slot vector for
+// arguments registered after the handle was created.
+
+ArgumentSlot&
+CalloutHandle::getSlot(int index) {
+    if (static_cast<size_t>(index) >= slots_.size()) {
+        if ((index < 0) || (index >= server_hooks_.getArgumentCount())) {
+            bundy_throw(OutOfRange, "argument index " << index <<
+                      " is not recognised");
+        }
+        slots_.resize(server_hooks_.getArgumentCount());
+    }
+    return (slots_[index]);
+}
+
+// Park the packet.  All the callouts parking the packet during a call of
+// the callouts get the same ticket.
+
+ParkingTicketPtr
+CalloutHandle::park() {
+    if (!parking_ticket_) {
+        parking_ticket_.reset(new ParkingTicket());
+    }
+    parking_ticket_->addReference();
+    return (parking_ticket_);
+}
+
 // Return the library handle allowing the callout to access the CalloutManager
 // registration/deregistration functions.
 
@@ -134,6 +184,8 @@ CalloutHandle::getContextNames() const {
         names.push_back(i->first);
     }
 
+    // Return the names in order, as when all arguments were held in the map.
+    sort(names.begin(), names.end());
     return (names);
 }
 
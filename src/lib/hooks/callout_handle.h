@@ -16,7 +16,10 @@
 #define CALLOUT_HANDLE_H
 
 #include <exceptions/exceptions.h>
+#include <hooks/argument_slot.h>
 #include <hooks/library_handle.h>
+#include <hooks/parking_lot.h>
+#include <hooks/server_hooks.h>
 
 #include <boost/any.hpp>
 #include <boost/shared_ptr.hpp>
@@ -28,8 +31,6 @@
 namespace bundy {
 namespace hooks {
 
-class ServerHooks;
-
 /// @brief No such argument
 ///
 /// Thrown if an attempt is made access an argument that does not exist.
@@ -70,6 +71,11 @@ class LibraryManagerCollection;
 ///   are passed information by the server (and can return information to it)
 ///   through name/value pairs.  Each of these pairs is an argument and the
 ///   information is accessed through the {get,set}Argument() methods.
+///   Arguments whose names have been registered with
+///   HooksManager::registerArgument() are stored in slots that the server
+///   can also access by index: this avoids the name lookup and, for small
+///   values such as (shared) pointers, any memory allocation.  Callouts can
+///   access them by name either way.
 ///
 /// - Per-packet context.  Each packet has a context associated with it, this
 ///   context being  on a per-library basis.  In other words, As a packet passes
@@ -87,6 +93,11 @@ class LibraryManagerCollection;
 ///   case, only functions registered by functions in the same library as the
 ///   callout doing the deregistration can be removed: callouts registered by
 ///   other libraries cannot be modified.
+///
+/// - Parking.  A callout which has to wait for something, typically an
+///   external server, before the packet can be processed further can park
+///   the packet (see park()) and resume it later, so that the server can
+///   process other packets in the meantime.
 
 class CalloutHandle {
 public:
@@ -145,7 +156,24 @@ public:
     /// @param value Value to set.  That can be of any data type.
     template <typename T>
     void setArgument(const std::string& name, T value) {
-        arguments_[name] = value;
+        const int index = server_hooks_.findArgument(name);
+        if (index >= 0) {
+            getSlot(index).set(value);
+        } else {
+            arguments_[name] = value;
+        }
+    }
+
+    /// @brief Set argument by index
+    ///
+    /// Sets the value of a registered argument.
+    ///
+    /// @param index Index of the argument, as returned by
+    ///        HooksManager::registerArgument().
+    /// @param value Value to set.  That can be of any data type.
+    template <typename T>
+    void setArgument(int index, T value) {
+        getSlot(index).set(value);
     }
 
     /// @brief Get argument
@@ -162,6 +190,12 @@ public:
     ///        the variable provided to receive the value.
     template <typename T>
     void getArgument(const std::string& name, T& value) const {
+        const ArgumentSlot* slot = findSlot(server_hooks_.findArgument(name));
+        if (slot != NULL) {
+            value = slot->get<T>();
+            return;
+        }
+
         ElementCollection::const_iterator element_ptr = arguments_.find(name);
         if (element_ptr == arguments_.end()) {
             bundy_throw(NoSuchArgument, "unable to find argument with name " <<
@@ -171,6 +205,29 @@ public:
         value = boost::any_cast<T>(element_ptr->second);
     }
 
+    /// @brief Get argument by index
+    ///
+    /// Gets the value of a registered argument.
+    ///
+    /// @param index Index of the argument, as returned by
+    ///        HooksManager::registerArgument().
+    /// @param value [out] Value to set.  The type of "value" is important:
+    ///        it must match the type of the value set.
+    ///
+    /// @throw NoSuchArgument The argument is not set.
+    /// @throw boost::bad_any_cast The argument is set, but the data type of
+    ///        the value is not the same as the type of the variable provided
+    ///        to receive the value.
+    template <typename T>
+    void getArgument(int index, T& value) const {
+        const ArgumentSlot* slot = findSlot(index);
+        if (slot == NULL) {
+            bundy_throw(NoSuchArgument, "argument with index " << index <<
+                      " is not set");
+        }
+        value = slot->get<T>();
+    }
+
     /// @brief Get argument names
     ///
     /// Returns a vector holding the names of arguments in the argument
@@ -189,6 +246,10 @@ public:
     ///
     /// @param name Name of the element in the argument list to set.
     void deleteArgument(const std::string& name) {
+        const int index = server_hooks_.findArgument(name);
+        if ((index >= 0) && (static_cast<size_t>(index) < slots_.size())) {
+            slots_[index].clear();
+        }
         static_cast<void>(arguments_.erase(name));
     }
 
@@ -198,9 +259,7 @@ public:
     ///
     /// N.B. If any elements are raw pointers, the pointed-to data is NOT
     /// deleted by this method.
-    void deleteAllArguments() {
-        arguments_.clear();
-    }
+    void deleteAllArguments();
 
     /// @brief Set skip flag
     ///
@@ -222,6 +281,48 @@ public:
         return (skip_);
     }
 
+    /// @brief Park the packet
+    ///
+    /// Called by a callout which can't complete its work at once.  Once the
+    /// callouts on the hook have returned, the server puts the packet aside
+    /// until the callout resumes or drops it through the returned ticket,
+    /// from any thread, and goes on with other packets.  The packet is
+    /// resumed when all the callouts which parked it have resumed it.  See
+    /// ParkingTicket for details.
+    ///
+    /// Only the hooks documented as allowing it support parking: on the
+    /// other ones, the server ignores it and goes on with the packet.
+    ///
+    /// @return Ticket with which the packet is resumed or dropped.
+    ParkingTicketPtr park();
+
+    /// @brief Is the packet parked?
+    ///
+    /// Called by the server after the callouts to know whether to park the
+    /// packet (see ParkingLot).
+    ///
+    /// @return true if a callout has called park() during the last call of
+    ///         the callouts.
+    bool isParked() const {
+        return (static_cast<bool>(parking_ticket_));
+    }
+
+    /// @brief Get parking ticket
+    ///
+    /// @return Ticket of the packet if it is parked, a null pointer if not.
+    ParkingTicketPtr getParkingTicket() const {
+        return (parking_ticket_);
+    }
+
+    /// @brief Clear parking
+    ///
+    /// Called by the CalloutManager before the callouts are called, so that
+    /// a packet is only parked by the callouts on one hook.  The ticket
+    /// itself is not affected.
+    void clearParking() {
+        parking_ticket_.reset();
+    }
+
     /// @brief Access current library handle
     ///
     /// Returns a reference to the current library handle.  This function is
@@ -343,6 +444,30 @@ private:
     ///        handle collection.
     ElementCollection& getContextForLibrary();
 
+    /// @brief Return the slot of a registered argument
+    ///
+    /// The slot vector is extended if the argument was registered after
+    /// this handle was created.
+    ///
+    /// @param index Index of the argument.
+    ///
+    /// @throw bundy::OutOfRange The index is not valid.
+    ArgumentSlot& getSlot(int index);
+
+    /// @brief Return the slot of a set argument
+    ///
+    /// @param index Index of the argument, or -1.
+    ///
+    /// @return Pointer to the slot, or NULL if the index is invalid or the
+    ///         argument is not set.
+    const ArgumentSlot* findSlot(int index) const {
+        if ((index < 0) || (static_cast<size_t>(index) >= slots_.size()) ||
+            slots_[index].empty()) {
+            return (NULL);
+        }
+        return (&slots_[index]);
+    }
+
     /// @brief Return reference to context for current library (const version)
     ///
     /// Called by all context-accessing functions, this a reference to the
@@ -365,6 +490,9 @@ private:
     /// Collection of arguments passed to the callouts
     ElementCollection arguments_;
 
+    /// Arguments registered with ServerHooks::registerArgument(), by index
+    std::vector<ArgumentSlot> slots_;
+
     /// Context collection - there is one entry per library context.
     ContextCollection context_collection_;
 
@@ -378,6 +506,9 @@ private:
 
     /// "Skip" flag, indicating if the caller should bypass remaining callouts.
     bool skip_;
+
+    /// Ticket of the packet, if a callout has parked it.
+    ParkingTicketPtr parking_ticket_;
 };
 
 /// A shared pointer to a CalloutHandle object.
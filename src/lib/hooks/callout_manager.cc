@@ -24,8 +24,23 @@
 #include <functional>
 #include <utility>
 
+#include <time.h>
+
 using namespace std;
 
+namespace {
+
+// Current value of the monotonic clock, in nanoseconds.  This is only used
+// for measuring intervals, so the reference point is not important.
+uint64_t
+monotonicTime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec);
+}
+
+}
+
 namespace bundy {
 namespace hooks {
 
@@ -33,9 +48,11 @@ namespace hooks {
 CalloutManager::CalloutManager(int num_libraries)
     : server_hooks_(ServerHooks::getServerHooks()),
       current_hook_(-1), current_library_(-1),
-      hook_vector_(ServerHooks::getServerHooks().getCount()),
+      hook_vector_(ServerHooks::getServerHooks().getCount(),
+                   ConstCalloutVectorPtr(new CalloutVector())),
       library_handle_(this), pre_library_handle_(this, 0),
-      post_library_handle_(this, INT_MAX), num_libraries_(num_libraries)
+      post_library_handle_(this, INT_MAX), num_libraries_(num_libraries),
+      statistics_enabled_(false)
 {
     if (num_libraries < 0) {
         bundy_throw(bundy::BadValue, "number of libraries passed to the "
@@ -75,24 +92,19 @@ CalloutManager::registerCallout(const std::string& name, CalloutPtr callout) {
     // process).
     int hook_index = server_hooks_.getIndex(name);
 
-    // Iterate through the callout vector for the hook from start to end,
-    // looking for the first entry where the library index is greater than
-    // the present index.
-    for (CalloutVector::iterator i = hook_vector_[hook_index].begin();
-         i != hook_vector_[hook_index].end(); ++i) {
-        if (i->first > current_library_) {
-            // Found an element whose library index number is greater than the
-            // current index, so insert the new element ahead of this one.
-            hook_vector_[hook_index].insert(i, make_pair(current_library_,
-                                                         callout));
-            return;
-        }
+    // Build the new callout vector for the hook: iterate through the current
+    // one from start to end, looking for the first entry where the library
+    // index is greater than the present index, and insert the new callout
+    // ahead of it.  If there is no such element in the (possibly empty) set
+    // of callouts, the callout goes at the end of the list.
+    boost::shared_ptr<CalloutVector> callouts(
+        new CalloutVector(*hook_vector_[hook_index]));
+    CalloutVector::iterator i = callouts->begin();
+    while ((i != callouts->end()) && (i->first <= current_library_)) {
+        ++i;
     }
-
-    // Reached the end of the vector, so there is no element in the (possibly
-    // empty) set of callouts with a library index greater than the current
-    // library index.  Inset the callout at the end of the list.
-    hook_vector_[hook_index].push_back(make_pair(current_library_, callout));
+    callouts->insert(i, make_pair(current_library_, callout));
+    hook_vector_[hook_index] = callouts;
 }
 
 // Check if callouts are present for a given hook index.
@@ -106,7 +118,7 @@ CalloutManager::calloutsPresent(int hook_index) const {
     }
 
     // Valid, so are there any callouts associated with that hook?
-    return (!hook_vector_[hook_index].empty());
+    return (!hook_vector_[hook_index]->empty());
 }
 
 // Call all the callouts for a given hook.
@@ -114,10 +126,12 @@ CalloutManager::calloutsPresent(int hook_index) const {
 void
 CalloutManager::callCallouts(int hook_index, CalloutHandle& callout_handle) {
 
-    // Clear the "skip" flag so we don't carry state from a previous call.
-    // This is done regardless of whether callouts are present to avoid passing
-    // any state from the previous call of callCallouts().
+    // Clear the "skip" flag and the parking so we don't carry state from a
+    // previous call.  This is done regardless of whether callouts are
+    // present to avoid passing any state from the previous call of
+    // callCallouts().
     callout_handle.setSkip(false);
+    callout_handle.clearParking();
 
     // Only initialize and iterate if there are callouts present.  This check
     // also catches the case of an invalid index.
@@ -127,21 +141,26 @@ CalloutManager::callCallouts(int hook_index, CalloutHandle& callout_handle) {
         // determine to what hook it is attached.
         current_hook_ = hook_index;
 
-        // Duplicate the callout vector for this hook and work through that.
-        // This step is needed because we allow dynamic registration and
-        // deregistration of callouts.  If a callout attached to a hook modified
-        // the list of callouts on that hook, the underlying CalloutVector would
-        // change and potentially affect the iteration through that vector.
-        CalloutVector callouts(hook_vector_[hook_index]);
+        // Hold on to the callout vector for this hook and work through that.
+        // We allow dynamic registration and deregistration of callouts: if a
+        // callout attached to a hook modified the list of callouts on that
+        // hook, the vector would be replaced, but the one held here remains
+        // unchanged.  Unlike a copy of the vector, this doesn't allocate.
+        const ConstCalloutVectorPtr callouts(hook_vector_[hook_index]);
 
         // Call all the callouts.
-        for (CalloutVector::const_iterator i = callouts.begin();
-             i != callouts.end(); ++i) {
+        for (CalloutVector::const_iterator i = callouts->begin();
+             i != callouts->end(); ++i) {
             // In case the callout tries to register or deregister a callout,
             // set the current library index to the index associated with the
             // library that registered the callout being called.
             current_library_ = i->first;
 
+            // Note the start time if statistics are being collected.  (The
+            // flag is copied in case the callout changes it.)
+            const bool timed = statistics_enabled_;
+            const uint64_t start = timed ? monotonicTime() : 0;
+
             // Call the callout
             try {
                 int status = (*i->second)(callout_handle);
@@ -165,6 +184,14 @@ CalloutManager::callCallouts(int hook_index, CalloutHandle& callout_handle) {
                     .arg(e.what());
             }
 
+            if (timed) {
+                const uint64_t elapsed = monotonicTime() - start;
+                CalloutStatistics& stats =
+                    statistics_[getStatisticsIndex(hook_index, i->first)];
+                ++stats.calls_;
+                stats.total_time_ += elapsed;
+                stats.max_time_ = max(stats.max_time_, elapsed);
+            }
         }
 
         // Reset the current hook and library indexs to an invalid value to
@@ -192,7 +219,9 @@ CalloutManager::deregisterCallout(const std::string& name, CalloutPtr callout) {
     /// To decide if any entries were removed, we'll record the initial size
     /// of the callout vector for the hook, and compare it with the size after
     /// the removal.
-    size_t initial_size = hook_vector_[hook_index].size();
+    boost::shared_ptr<CalloutVector> callouts(
+        new CalloutVector(*hook_vector_[hook_index]));
+    size_t initial_size = callouts->size();
 
     // The next bit is standard STL (see "Item 33" in "Effective STL" by
     // Scott Meyers).
@@ -203,15 +232,14 @@ CalloutManager::deregisterCallout(const std::string& name, CalloutPtr callout) {
     // is equal to the value of the passed callout.)  The erase() call
     // removes everything from that element to the end of the vector, i.e.
     // all the matching elements.
-    hook_vector_[hook_index].erase(remove_if(hook_vector_[hook_index].begin(),
-                                             hook_vector_[hook_index].end(),
-                                             bind1st(equal_to<CalloutEntry>(),
-                                                     target)),
-                                   hook_vector_[hook_index].end());
+    callouts->erase(remove_if(callouts->begin(), callouts->end(),
+                              bind1st(equal_to<CalloutEntry>(), target)),
+                    callouts->end());
 
     // Return an indication of whether anything was removed.
-    bool removed = initial_size != hook_vector_[hook_index].size();
+    bool removed = initial_size != callouts->size();
     if (removed) {
+        hook_vector_[hook_index] = callouts;
         LOG_DEBUG(hooks_logger, HOOKS_DBG_EXTENDED_CALLS,
                   HOOKS_CALLOUT_DEREGISTERED).arg(current_library_).arg(name);
     }
@@ -235,18 +263,19 @@ CalloutManager::deregisterAllCallouts(const std::string& name) {
     /// To decide if any entries were removed, we'll record the initial size
     /// of the callout vector for the hook, and compare it with the size after
     /// the removal.
-    size_t initial_size = hook_vector_[hook_index].size();
+    boost::shared_ptr<CalloutVector> callouts(
+        new CalloutVector(*hook_vector_[hook_index]));
+    size_t initial_size = callouts->size();
 
     // Remove all callouts matching this library.
-    hook_vector_[hook_index].erase(remove_if(hook_vector_[hook_index].begin(),
-                                             hook_vector_[hook_index].end(),
-                                             bind1st(CalloutLibraryEqual(),
-                                                     target)),
-                                   hook_vector_[hook_index].end());
+    callouts->erase(remove_if(callouts->begin(), callouts->end(),
+                              bind1st(CalloutLibraryEqual(), target)),
+                    callouts->end());
 
     // Return an indication of whether anything was removed.
-    bool removed = initial_size != hook_vector_[hook_index].size();
+    bool removed = initial_size != callouts->size();
     if (removed) {
+        hook_vector_[hook_index] = callouts;
         LOG_DEBUG(hooks_logger, HOOKS_DBG_EXTENDED_CALLS,
                   HOOKS_ALL_CALLOUTS_DEREGISTERED).arg(current_library_)
                                                 .arg(name);
@@ -255,5 +284,43 @@ CalloutManager::deregisterAllCallouts(const std::string& name) {
     return (removed);
 }
 
+// Enable or disable the collection of statistics.  The statistics vector is
+// allocated when collection is first enabled and retained after that, so
+// a callout disabling collection does not invalidate the figures.
+
+void
+CalloutManager::setStatisticsEnabled(bool enabled) {
+    if (enabled && statistics_.empty()) {
+        statistics_.resize(hook_vector_.size() * (num_libraries_ + 2));
+    }
+    statistics_enabled_ = enabled;
+}
+
+// Reset the statistics.
+
+void
+CalloutManager::clearStatistics() {
+    fill(statistics_.begin(), statistics_.end(), CalloutStatistics());
+}
+
+// Return the statistics for a hook and library.
+
+CalloutStatistics
+CalloutManager::getStatistics(int hook_index, int library_index) const {
+    if ((hook_index < 0) ||
+        (static_cast<size_t>(hook_index) >= hook_vector_.size())) {
+        bundy_throw(NoSuchHook, "hook index " << hook_index <<
+                  " is not valid for the list of registered hooks");
+    }
+    checkLibraryIndex(library_index);
+    if (library_index < 0) {
+        bundy_throw(NoSuchLibrary, "library index " << library_index <<
+                  " is not valid for statistics");
+    }
+
+    return (statistics_.empty() ? CalloutStatistics() :
+            statistics_[getStatisticsIndex(hook_index, library_index)]);
+}
+
 } // namespace util
 } // namespace bundy
@@ -21,9 +21,12 @@
 
 #include <boost/shared_ptr.hpp>
 
+#include <stdint.h>
+
 #include <climits>
 #include <map>
 #include <string>
+#include <vector>
 
 namespace bundy {
 namespace hooks {
@@ -38,6 +41,20 @@ public:
         bundy::Exception(file, line, what) {}
 };
 
+/// @brief Callout execution statistics
+///
+/// Counts the calls made to the callouts registered by one library on one
+/// hook, and the time spent in them.  These are only maintained if
+/// collection of statistics has been enabled in the CalloutManager.
+struct CalloutStatistics {
+    /// @brief Constructor
+    CalloutStatistics() : calls_(0), total_time_(0), max_time_(0) {}
+
+    uint64_t calls_;        ///< Number of callouts called
+    uint64_t total_time_;   ///< Cumulative execution time (nanoseconds)
+    uint64_t max_time_;     ///< Longest single execution time (nanoseconds)
+};
+
 /// @brief Callout Manager
 ///
 /// This class manages the registration, deregistration and execution of the
@@ -123,6 +140,12 @@ private:
     /// associated with a given hook.
     typedef std::vector<CalloutEntry> CalloutVector;
 
+    /// Pointer to the callout vector of a hook.  The vector is never modified
+    /// once built: registration and deregistration replace it.  This allows
+    /// callCallouts() to work through the vector without copying it even if
+    /// a callout modifies the registrations.
+    typedef boost::shared_ptr<const CalloutVector> ConstCalloutVectorPtr;
+
 public:
 
     /// @brief Constructor
@@ -205,6 +228,45 @@ public:
     ///        current object being processed.
     void callCallouts(int hook_index, CalloutHandle& callout_handle);
 
+    /// @brief Enable or disable collection of statistics
+    ///
+    /// When enabled, callCallouts() counts the number of callouts called and
+    /// measures the time spent in them (using the monotonic clock), keeping
+    /// the figures separately for each hook and each library.  Collection
+    /// is disabled by default, in which case the only overhead is a test of
+    /// a flag for each callout called.
+    ///
+    /// Enabling collection when it is already enabled does not affect the
+    /// figures collected so far.
+    ///
+    /// @param enabled true to enable collection, false to disable it.
+    void setStatisticsEnabled(bool enabled);
+
+    /// @brief Is collection of statistics enabled?
+    bool getStatisticsEnabled() const {
+        return (statistics_enabled_);
+    }
+
+    /// @brief Clear the statistics
+    ///
+    /// Resets all the figures to zero.
+    void clearStatistics();
+
+    /// @brief Get the statistics for a hook and library
+    ///
+    /// @param hook_index Index of the hook.
+    /// @param library_index Index of the library, which may be 0 or INT_MAX
+    ///        for callouts registered through the pre- and post-library
+    ///        handles.
+    ///
+    /// @return Statistics for the callouts registered on the hook by that
+    ///         library.  If collection has never been enabled, all figures
+    ///         are zero.
+    ///
+    /// @throw NoSuchHook Given index does not correspond to a valid hook.
+    /// @throw NoSuchLibrary The library index is not valid.
+    CalloutStatistics getStatistics(int hook_index, int library_index) const;
+
     /// @brief Get current hook index
     ///
     /// Made available during callCallouts, this is the index of the hook
@@ -319,6 +381,21 @@ private:
     /// @throw NoSuchLibrary Library index is not valid.
     void checkLibraryIndex(int library_index) const;
 
+    /// @brief Index into the statistics vector
+    ///
+    /// @param hook_index Index of the hook (assumed to be valid).
+    /// @param library_index Index of the library (assumed to be valid and
+    ///        not -1).
+    ///
+    /// @return Index of the statistics for the hook and library.
+    size_t getStatisticsIndex(int hook_index, int library_index) const {
+        // Library indexes are 0 to num_libraries_, plus INT_MAX, so there
+        // are num_libraries_ + 2 entries for each hook.
+        const int library = (library_index == INT_MAX) ? (num_libraries_ + 1) :
+            library_index;
+        return (hook_index * (num_libraries_ + 2) + library);
+    }
+
     /// @brief Compare two callout entries for library equality
     ///
     /// This is used in callout removal code when all callouts on a hook for a
@@ -356,9 +433,11 @@ private:
     int current_library_;
 
     /// Vector of callout vectors.  There is one entry in this outer vector for
-    /// each hook. Each element is itself a vector, with one entry for each
-    /// callout registered for that hook.
-    std::vector<CalloutVector> hook_vector_;
+    /// each hook. Each element points to a vector, with one entry for each
+    /// callout registered for that hook.  This is the dispatch table of
+    /// callCallouts(), built as callouts are registered when the libraries
+    /// are loaded.
+    std::vector<ConstCalloutVectorPtr> hook_vector_;
 
     /// LibraryHandle object user by the callout to access the callout
     /// registration methods on this CalloutManager object.  The object is set
@@ -376,6 +455,13 @@ private:
 
     /// Number of libraries.
     int num_libraries_;
+
+    /// Are statistics being collected?
+    bool statistics_enabled_;
+
+    /// Callout statistics, indexed by getStatisticsIndex().  This is only
+    /// allocated when collection is first enabled.
+    std::vector<CalloutStatistics> statistics_;
 };
 
 } // namespace util
@@ -32,7 +32,7 @@ namespace hooks {
 
 // Constructor
 
-HooksManager::HooksManager() {
+HooksManager::HooksManager() : statistics_enabled_(false) {
 }
 
 // Return reference to singleton hooks manager.
@@ -84,6 +84,7 @@ HooksManager::loadLibrariesInternal(const std::vector<std::string>& libraries) {
     if (status) {
         // ... and obtain the callout manager for them if successful.
         callout_manager_ = lm_collection_->getCalloutManager();
+        callout_manager_->setStatisticsEnabled(statistics_enabled_);
     } else {
         // Unable to load libraries, reset to state before this function was
         // called.
@@ -156,6 +157,7 @@ HooksManager::performConditionalInitialization() {
     lm_collection_->loadLibraries();
 
     callout_manager_ = lm_collection_->getCalloutManager();
+    callout_manager_->setStatisticsEnabled(statistics_enabled_);
 }
 
 // Shell around ServerHooks::registerHook()
@@ -165,6 +167,13 @@ HooksManager::registerHook(const std::string& name) {
     return (ServerHooks::getServerHooks().registerHook(name));
 }
 
+// Shell around ServerHooks::registerArgument()
+
+int
+HooksManager::registerArgument(const std::string& name) {
+    return (ServerHooks::getServerHooks().registerArgument(name));
+}
+
 // Return pre- and post- library handles.
 
 bundy::hooks::LibraryHandle&
@@ -196,5 +205,48 @@ HooksManager::validateLibraries(const std::vector<std::string>& libraries) {
     return (LibraryManagerCollection::validateLibraries(libraries));
 }
 
+// Callout statistics.
+
+void
+HooksManager::setStatisticsEnabledInternal(bool enabled) {
+    statistics_enabled_ = enabled;
+    if (callout_manager_) {
+        callout_manager_->setStatisticsEnabled(enabled);
+    }
+}
+
+void
+HooksManager::setStatisticsEnabled(bool enabled) {
+    getHooksManager().setStatisticsEnabledInternal(enabled);
+}
+
+bool
+HooksManager::getStatisticsEnabled() {
+    return (getHooksManager().statistics_enabled_);
+}
+
+std::vector<HookStatistics>
+HooksManager::getStatisticsInternal() {
+    conditionallyInitialize();
+    return (lm_collection_->getStatistics());
+}
+
+std::vector<HookStatistics>
+HooksManager::getStatistics() {
+    return (getHooksManager().getStatisticsInternal());
+}
+
+void
+HooksManager::clearStatisticsInternal() {
+    if (callout_manager_) {
+        callout_manager_->clearStatistics();
+    }
+}
+
+void
+HooksManager::clearStatistics() {
+    getHooksManager().clearStatisticsInternal();
+}
+
 } // namespace util
 } // namespace bundy
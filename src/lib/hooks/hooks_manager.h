@@ -15,6 +15,7 @@
 #ifndef HOOKS_MANAGER_H
 #define HOOKS_MANAGER_H
 
+#include <hooks/library_manager_collection.h>
 #include <hooks/server_hooks.h>
 
 #include <boost/noncopyable.hpp>
@@ -30,7 +31,6 @@ namespace hooks {
 class CalloutHandle;
 class CalloutManager;
 class LibraryHandle;
-class LibraryManagerCollection;
 
 /// @brief Hooks Manager
 ///
@@ -171,6 +171,18 @@ public:
     ///         registered.
     static int registerHook(const std::string& name);
 
+    /// @brief Register callout argument
+    ///
+    /// This is a convenience shell around ServerHooks::registerArgument().
+    /// The index returned can be passed to the index-based argument methods
+    /// of CalloutHandle, avoiding the name lookup and (for small values) any
+    /// memory allocation.  Callouts can still access the argument by name.
+    ///
+    /// @param name Name of the argument
+    ///
+    /// @return Index of the argument, greater than or equal to zero.
+    static int registerArgument(const std::string& name);
+
     /// @brief Return list of loaded libraries
     ///
     /// Returns the names of the loaded libraries.
@@ -195,6 +207,31 @@ public:
     static std::vector<std::string> validateLibraries(
                        const std::vector<std::string>& libraries);
 
+    /// @brief Enable or disable collection of callout statistics
+    ///
+    /// When enabled, the number of callouts called on each hook by each
+    /// library, and the time spent in them, are recorded.  Collection is
+    /// disabled by default.  The setting persists across the loading and
+    /// reloading of libraries, although the figures themselves are reset
+    /// when libraries are (re)loaded.
+    ///
+    /// @param enabled true to enable collection, false to disable it.
+    static void setStatisticsEnabled(bool enabled);
+
+    /// @brief Is collection of callout statistics enabled?
+    static bool getStatisticsEnabled();
+
+    /// @brief Return callout statistics
+    ///
+    /// @return Statistics for each hook and library for which callouts have
+    ///         been called since collection was enabled or the libraries
+    ///         were loaded.  In the latter case, the figures for each
+    ///         library are only those collected since the library was loaded.
+    static std::vector<HookStatistics> getStatistics();
+
+    /// @brief Clear callout statistics
+    static void clearStatistics();
+
     /// Index numbers for pre-defined hooks.
     static const int CONTEXT_CREATE = ServerHooks::CONTEXT_CREATE;
     static const int CONTEXT_DESTROY = ServerHooks::CONTEXT_DESTROY;
@@ -274,6 +311,19 @@ private:
     /// @return List of loaded library names.
     std::vector<std::string> getLibraryNamesInternal() const;
 
+    /// @brief Enable or disable collection of callout statistics
+    ///
+    /// @param enabled true to enable collection, false to disable it.
+    void setStatisticsEnabledInternal(bool enabled);
+
+    /// @brief Return callout statistics
+    ///
+    /// @return Statistics for each hook and library.
+    std::vector<HookStatistics> getStatisticsInternal();
+
+    /// @brief Clear callout statistics
+    void clearStatisticsInternal();
+
     //@}
 
     /// @brief Initialization to No Libraries
@@ -308,6 +358,10 @@ private:
 
     /// Callout manager for the set of library managers.
     boost::shared_ptr<CalloutManager> callout_manager_;
+
+    /// Whether callout statistics are to be collected.  This is applied
+    /// to each callout manager created.
+    bool statistics_enabled_;
 };
 
 } // namespace util
@@ -15,6 +15,9 @@
 #include <hooks/callout_manager.h>
 #include <hooks/library_manager.h>
 #include <hooks/library_manager_collection.h>
+#include <hooks/server_hooks.h>
+
+#include <climits>
 
 namespace bundy {
 namespace hooks {
@@ -111,6 +114,42 @@ LibraryManagerCollection::getLoadedLibraryCount() const {
 }
 
 // Validate the libraries.
+// Return the callout statistics.  The library indexes are visited in the
+// order in which the callouts are called: server "pre" callouts (0), the
+// user libraries (1 - n) and server "post" callouts (INT_MAX).
+
+std::vector<HookStatistics>
+LibraryManagerCollection::getStatistics() const {
+    const boost::shared_ptr<CalloutManager> manager = getCalloutManager();
+    const ServerHooks& hooks = ServerHooks::getServerHooks();
+    const int num_libraries = manager->getNumLibraries();
+
+    std::vector<HookStatistics> result;
+    for (int hook = 0; hook < hooks.getCount(); ++hook) {
+        for (int i = 0; i <= num_libraries + 1; ++i) {
+            const int library = (i <= num_libraries) ? i : INT_MAX;
+            const CalloutStatistics stats =
+                manager->getStatistics(hook, library);
+            if (stats.calls_ == 0) {
+                continue;
+            }
+
+            HookStatistics entry;
+            entry.hook_name_ = hooks.getName(hook);
+            if ((library > 0) && (library != INT_MAX)) {
+                entry.library_name_ = library_names_[library - 1];
+            }
+            entry.library_index_ = library;
+            entry.statistics_ = stats;
+            result.push_back(entry);
+        }
+    }
+
+    return (result);
+}
+
+// Validate the libraries.
+
 std::vector<std::string>
 LibraryManagerCollection::validateLibraries(
                           const std::vector<std::string>& libraries) {
@@ -16,9 +16,11 @@
 #define LIBRARY_MANAGER_COLLECTION_H
 
 #include <exceptions/exceptions.h>
+#include <hooks/callout_manager.h>
 
 #include <boost/shared_ptr.hpp>
 
+#include <string>
 #include <vector>
 
 namespace bundy {
@@ -36,9 +38,19 @@ public:
 
 
 // Forward declarations
-class CalloutManager;
 class LibraryManager;
 
+/// @brief Statistics for the callouts of one library on one hook
+///
+/// Returned by LibraryManagerCollection::getStatistics().
+struct HookStatistics {
+    std::string hook_name_;         ///< Name of the hook
+    std::string library_name_;      ///< Name of the library (empty for
+                                    ///< callouts registered by the server)
+    int library_index_;             ///< Index of the library
+    CalloutStatistics statistics_;  ///< Call count and execution times
+};
+
 /// @brief Library manager collection
 ///
 /// The LibraryManagerCollection class, as the name implies, is responsible for
@@ -131,6 +143,20 @@ public:
     /// @return Number of libraries that are loaded.
     int getLoadedLibraryCount() const;
 
+    /// @brief Get callout statistics
+    ///
+    /// Returns the statistics collected by the callout manager for each
+    /// hook and library, provided that collection has been enabled with
+    /// CalloutManager::setStatisticsEnabled().  Combinations of hook and
+    /// library for which no callouts have been called are omitted.
+    ///
+    /// @return Statistics for each hook and library, ordered by hook index
+    ///         and then by the order in which the callouts are called.
+    ///
+    /// @throw LoadLibrariesNotCalled Thrown if this method is called between
+    ///        construction and the time loadLibraries() is called.
+    std::vector<HookStatistics> getStatistics() const;
+
     /// @brief Validate libraries
     ///
     /// Utility function to validate libraries.  It checks that the libraries
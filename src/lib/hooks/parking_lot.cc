@@ -0,0 +1,303 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <exceptions/exceptions.h>
+#include <hooks/callout_handle.h>
+#include <hooks/parking_lot.h>
+#include <util/threads/event_notifier.h>
+#include <util/threads/sync.h>
+
+#include <list>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <time.h>
+
+using namespace std;
+using bundy::util::thread::EventNotifier;
+using bundy::util::thread::Mutex;
+
+namespace {
+
+// Current value of the monotonic clock, in milliseconds.
+uint64_t
+monotonicTime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (static_cast<uint64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000);
+}
+
+}
+
+namespace bundy {
+namespace hooks {
+
+// State of a ticket.  It's only accessed with the mutex locked, as the
+// library can resume the packet from any thread.  When both are needed,
+// the mutex of the ticket is locked before the one of the parking lot.
+
+struct ParkingTicket::Impl {
+    Impl() : references_(0), done_(false), dropped_(false) {}
+
+    Mutex mutex_;
+
+    /// Number of callouts which parked the packet and haven't resumed it.
+    int references_;
+
+    /// Has the packet been resumed or dropped (or ignored by the server)?
+    bool done_;
+
+    /// Has the packet been dropped?
+    bool dropped_;
+
+    /// Parking lot in which the server parked the packet, if any.
+    boost::shared_ptr<ParkingLotState> lot_;
+};
+
+// State of a parking lot, shared with the tickets of its packets so that
+// a late resume() on a ticket is harmless once the lot is destroyed.
+
+class ParkingLotState : boost::noncopyable {
+public:
+    ParkingLotState(size_t limit, uint32_t timeout) :
+        limit_(limit), timeout_(timeout)
+    {}
+
+    /// A parked packet.
+    struct Parked {
+        Parked(const ParkingTicketPtr& ticket,
+               const ParkingLot::Continuation& continuation,
+               uint64_t deadline) :
+            ticket_(ticket), continuation_(continuation), deadline_(deadline)
+        {}
+
+        ParkingTicketPtr ticket_;
+        ParkingLot::Continuation continuation_;
+        /// Time at which the packet times out, zero if it doesn't.
+        uint64_t deadline_;
+    };
+    typedef list<Parked> ParkedList;
+
+    /// A packet to go on with, and whether it was resumed.
+    typedef pair<ParkingLot::Continuation, bool> Ready;
+
+    /// Called by a ticket when the last callout has resumed the packet,
+    /// or one dropped it.  The mutex of the ticket is locked.
+    void setReady(const ParkingTicket* ticket, bool resume) {
+        Mutex::Locker locker(mutex_);
+        const map<const ParkingTicket*, ParkedList::iterator>::iterator
+            entry = index_.find(ticket);
+        if (entry == index_.end()) {
+            // Already timed out.
+            return;
+        }
+        ready_.push_back(Ready(entry->second->continuation_, resume));
+        parked_.erase(entry->second);
+        index_.erase(entry);
+        notifier_.notify();
+    }
+
+    mutable Mutex mutex_;
+    EventNotifier notifier_;
+    size_t limit_;
+    uint32_t timeout_;
+
+    /// Packets waiting to be resumed, in the order they were parked (which
+    /// is also the order in which they time out, unless the timeout is
+    /// changed).
+    ParkedList parked_;
+
+    /// The entries of parked_, by ticket.
+    map<const ParkingTicket*, ParkedList::iterator> index_;
+
+    /// Packets resumed or dropped since the last processReady().
+    vector<Ready> ready_;
+};
+
+ParkingTicket::ParkingTicket() : impl_(new Impl) {
+}
+
+ParkingTicket::~ParkingTicket() {
+    delete impl_;
+}
+
+void
+ParkingTicket::addReference() {
+    Mutex::Locker locker(impl_->mutex_);
+    ++impl_->references_;
+}
+
+void
+ParkingTicket::resume() {
+    release(false);
+}
+
+void
+ParkingTicket::drop() {
+    release(true);
+}
+
+void
+ParkingTicket::release(bool drop) {
+    Mutex::Locker locker(impl_->mutex_);
+    if (impl_->done_) {
+        return;
+    }
+    if (!drop && (--impl_->references_ > 0)) {
+        // Other callouts still wait for the packet.
+        return;
+    }
+
+    impl_->done_ = true;
+    impl_->dropped_ = drop;
+    if (impl_->lot_) {
+        impl_->lot_->setReady(this, !drop);
+    }
+}
+
+ParkingLot::ParkingLot(size_t limit, uint32_t timeout) :
+    state_(new ParkingLotState(limit, timeout))
+{
+}
+
+ParkingLot::~ParkingLot() {
+    // Release the references to the tickets and continuations now, rather
+    // than when the last ticket goes away.  They are destroyed without the
+    // lock, as that may call into the libraries.
+    ParkingLotState::ParkedList parked;
+    vector<ParkingLotState::Ready> ready;
+    Mutex::Locker locker(state_->mutex_);
+    state_->index_.clear();
+    state_->parked_.swap(parked);
+    state_->ready_.swap(ready);
+}
+
+bool
+ParkingLot::park(const CalloutHandle& handle,
+                 const Continuation& continuation)
+{
+    const ParkingTicketPtr ticket = handle.getParkingTicket();
+    if (!ticket) {
+        bundy_throw(InvalidOperation, "the packet was not parked by the "
+                    "callouts");
+    }
+
+    Mutex::Locker ticket_locker(ticket->impl_->mutex_);
+    if (ticket->impl_->lot_) {
+        bundy_throw(InvalidOperation, "the packet is already parked");
+    }
+
+    Mutex::Locker locker(state_->mutex_);
+    if (ticket->impl_->done_) {
+        // Resumed or dropped before the callouts returned.
+        state_->ready_.push_back(
+            ParkingLotState::Ready(continuation, !ticket->impl_->dropped_));
+        state_->notifier_.notify();
+    } else if ((state_->limit_ > 0) &&
+               (state_->index_.size() >= state_->limit_)) {
+        // The library's calls are ignored from now on.
+        ticket->impl_->done_ = true;
+        return (false);
+    } else {
+        const uint64_t deadline = (state_->timeout_ > 0) ?
+            (monotonicTime() + state_->timeout_) : 0;
+        state_->parked_.push_back(ParkingLotState::Parked(ticket, continuation,
+                                                          deadline));
+        state_->index_[ticket.get()] = --state_->parked_.end();
+    }
+    ticket->impl_->lot_ = state_;
+    return (true);
+}
+
+size_t
+ParkingLot::processReady() {
+    // Clear the notification first, so that a packet resumed while the
+    // continuations are called is noticed by the next call.
+    state_->notifier_.clear();
+
+    vector<ParkingLotState::Ready> ready;
+    {
+        Mutex::Locker locker(state_->mutex_);
+        ready.swap(state_->ready_);
+
+        const uint64_t now = monotonicTime();
+        while (!state_->parked_.empty()) {
+            const ParkingLotState::Parked& parked = state_->parked_.front();
+            if ((parked.deadline_ == 0) || (parked.deadline_ > now)) {
+                break;
+            }
+            ready.push_back(ParkingLotState::Ready(parked.continuation_,
+                                                   false));
+            state_->index_.erase(parked.ticket_.get());
+            state_->parked_.pop_front();
+        }
+    }
+
+    // Call the continuations without the lock, as they may park packets.
+    for (vector<ParkingLotState::Ready>::const_iterator i = ready.begin();
+         i != ready.end(); ++i) {
+        i->first(i->second);
+    }
+    return (ready.size());
+}
+
+int
+ParkingLot::getFD() const {
+    return (state_->notifier_.getFD());
+}
+
+int
+ParkingLot::getNextTimeout() const {
+    Mutex::Locker locker(state_->mutex_);
+    if (state_->parked_.empty() || (state_->parked_.front().deadline_ == 0)) {
+        return (-1);
+    }
+    const uint64_t deadline = state_->parked_.front().deadline_;
+    const uint64_t now = monotonicTime();
+    return ((deadline > now) ? static_cast<int>(deadline - now) : 0);
+}
+
+size_t
+ParkingLot::getParkedCount() const {
+    Mutex::Locker locker(state_->mutex_);
+    return (state_->index_.size());
+}
+
+void
+ParkingLot::setLimit(size_t limit) {
+    Mutex::Locker locker(state_->mutex_);
+    state_->limit_ = limit;
+}
+
+size_t
+ParkingLot::getLimit() const {
+    Mutex::Locker locker(state_->mutex_);
+    return (state_->limit_);
+}
+
+void
+ParkingLot::setTimeout(uint32_t timeout) {
+    Mutex::Locker locker(state_->mutex_);
+    state_->timeout_ = timeout;
+}
+
+uint32_t
+ParkingLot::getTimeout() const {
+    Mutex::Locker locker(state_->mutex_);
+    return (state_->timeout_);
+}
+
+} // namespace hooks
+} // namespace bundy
@@ -0,0 +1,200 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef PARKING_LOT_H
+#define PARKING_LOT_H
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <stdint.h>
+
+#include <cstddef>
+
+namespace bundy {
+namespace hooks {
+
+class CalloutHandle;
+class ParkingLotState;
+
+/// @brief Parked packet
+///
+/// A callout which can't complete its work at once, typically because it
+/// waits for the answer of an external server, parks the packet with
+/// CalloutHandle::park() and gets this ticket.  The server then puts the
+/// packet aside and goes on with other packets, until the library calls
+/// resume() (or drop()) on the ticket.  That can be done from any thread,
+/// for example from the one doing the I/O of the library.
+///
+/// If several callouts park the same packet, the packet is resumed when all
+/// of them have resumed it, and dropped as soon as one drops it.  Once the
+/// packet has been resumed, dropped or timed out, the calls are ignored, so
+/// the library need not know whether the server still waits for the packet.
+///
+/// The callouts on the hook which are after the parking one are still
+/// called before the packet is parked.  The arguments of the callout handle
+/// must not be accessed while the packet is parked: the server reads them
+/// back when the packet is resumed.
+class ParkingTicket : boost::noncopyable {
+public:
+    /// @brief Destructor
+    ~ParkingTicket();
+
+    /// @brief Resume the packet
+    ///
+    /// The server resumes the processing of the packet after the hook on
+    /// which it was parked, as if the callouts had returned at once.
+    void resume();
+
+    /// @brief Drop the packet
+    ///
+    /// The server drops the packet, as if the callouts had set the skip
+    /// flag.
+    void drop();
+
+private:
+    friend class CalloutHandle;
+    friend class ParkingLot;
+
+    /// @brief Constructor
+    ///
+    /// Only CalloutHandle::park() creates tickets.
+    ParkingTicket();
+
+    /// @brief Note one more callout waiting for the packet
+    void addReference();
+
+    /// @brief Note that a callout has done with the packet
+    ///
+    /// @param drop true if the packet is to be dropped.
+    void release(bool drop);
+
+    struct Impl;
+    Impl* impl_;
+};
+
+/// A shared pointer to a ParkingTicket object.
+typedef boost::shared_ptr<ParkingTicket> ParkingTicketPtr;
+
+/// @brief Packets parked by the callouts
+///
+/// The server keeps the packets parked by the callouts (see ParkingTicket)
+/// in an object of this class, with the function to call to go on with
+/// each of them.  The server watches the descriptor returned by getFD(),
+/// which is readable when a packet has been resumed or dropped, and calls
+/// processReady() to call the functions, in its own thread.
+///
+/// A packet which isn't resumed within the timeout is dropped, and no more
+/// than a limit of packets can be parked at a time: beyond that, the server
+/// drops the packets at once.  The server has to call processReady() at
+/// least when getNextTimeout() elapses for the timeout to be effective.
+class ParkingLot : boost::noncopyable {
+public:
+    /// @brief Function to go on with a packet
+    ///
+    /// The argument is true if the packet was resumed, false if it was
+    /// dropped or timed out.  The function is called in processReady() and
+    /// must not throw.
+    typedef boost::function<void (bool)> Continuation;
+
+    /// @brief Constructor
+    ///
+    /// @param limit Maximum number of parked packets, zero for no limit.
+    /// @param timeout Time after which a parked packet is dropped, in
+    ///        milliseconds, zero for no timeout.
+    ///
+    /// @throw bundy::Unexpected The descriptor couldn't be created.
+    ParkingLot(size_t limit = 0, uint32_t timeout = 0);
+
+    /// @brief Destructor
+    ///
+    /// The parked packets are forgotten: their continuations are not
+    /// called, and the tickets held by the libraries are ignored.
+    ~ParkingLot();
+
+    /// @brief Park a packet
+    ///
+    /// Called by the server after the callouts if the callout handle
+    /// reports the packet as parked.  If a callout has already resumed or
+    /// dropped the packet, the continuation is called by the next
+    /// processReady().
+    ///
+    /// @param handle Callout handle on which a callout called park().
+    /// @param continuation Function to go on with the packet.
+    ///
+    /// @return true if the packet was parked, false if the limit has been
+    ///         reached.  The packet should then be dropped, and the ticket
+    ///         is ignored.
+    ///
+    /// @throw bundy::InvalidOperation The packet was not parked by the
+    ///        callouts, or is already parked.
+    bool park(const CalloutHandle& handle, const Continuation& continuation);
+
+    /// @brief Go on with the packets resumed, dropped or timed out
+    ///
+    /// Calls the continuations of the packets resumed or dropped since the
+    /// last call, in that order, then the ones of the packets which have
+    /// timed out.  The continuations may park packets again.
+    ///
+    /// @return Number of continuations called.
+    size_t processReady();
+
+    /// @brief Get descriptor to watch
+    ///
+    /// @return Descriptor which is readable when processReady() has packets
+    ///         to go on with.
+    int getFD() const;
+
+    /// @brief Get time until the next timeout
+    ///
+    /// @return Time in milliseconds after which processReady() should be
+    ///         called to drop the packets which have timed out, -1 if no
+    ///         packet can time out.
+    int getNextTimeout() const;
+
+    /// @brief Get number of parked packets
+    ///
+    /// @return Number of packets waiting to be resumed.
+    size_t getParkedCount() const;
+
+    /// @brief Set maximum number of parked packets
+    ///
+    /// The packets already parked are not affected.
+    ///
+    /// @param limit Maximum number of packets, zero for no limit.
+    void setLimit(size_t limit);
+
+    /// @brief Get maximum number of parked packets
+    size_t getLimit() const;
+
+    /// @brief Set parking timeout
+    ///
+    /// The packets already parked keep their timeout.
+    ///
+    /// @param timeout Timeout in milliseconds, zero for no timeout.
+    void setTimeout(uint32_t timeout);
+
+    /// @brief Get parking timeout
+    uint32_t getTimeout() const;
+
+private:
+    /// State shared with the tickets of the parked packets.
+    boost::shared_ptr<ParkingLotState> state_;
+};
+
+} // namespace hooks
+} // namespace bundy
+
+#endif // PARKING_LOT_H
@@ -146,6 +146,32 @@ ServerHooks::getHookNames() const {
     return (names);
 }
 
+// Register a callout argument.  Registering the same name again returns the
+// index it was given the first time.
+
+int
+ServerHooks::registerArgument(const string& name) {
+    const int index = argument_names_.size();
+    pair<HookCollection::iterator, bool> result =
+        arguments_.insert(make_pair(name, index));
+    if (result.second) {
+        argument_names_.push_back(name);
+    }
+    return (result.first->second);
+}
+
+// Find the name associated with an argument index.
+
+const std::string&
+ServerHooks::getArgumentName(int index) const {
+    if ((index < 0) ||
+        (static_cast<size_t>(index) >= argument_names_.size())) {
+        bundy_throw(OutOfRange, "argument index " << index <<
+                  " is not recognised");
+    }
+    return (argument_names_[index]);
+}
+
 // Return global ServerHooks object
 
 ServerHooks&
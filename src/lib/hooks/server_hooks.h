@@ -134,6 +134,46 @@ public:
     /// @return Vector of strings holding hook names.
     std::vector<std::string> getHookNames() const;
 
+    /// @brief Register a callout argument
+    ///
+    /// Registers the name of an argument passed to callouts and returns its
+    /// index.  Arguments with a registered name are stored by CalloutHandle
+    /// in slots accessed by index, which is cheaper than by name.  Unlike
+    /// hooks, the same argument may be used with several hooks, so
+    /// registering a name again returns the existing index.  The arguments
+    /// are not affected by reset().
+    ///
+    /// @param name Name of the argument
+    ///
+    /// @return Index of the argument, greater than or equal to zero.
+    int registerArgument(const std::string& name);
+
+    /// @brief Find a callout argument
+    ///
+    /// @param name Name of the argument
+    ///
+    /// @return Index of the argument, or -1 if the name isn't registered.
+    int findArgument(const std::string& name) const {
+        const HookCollection::const_iterator i = arguments_.find(name);
+        return (i == arguments_.end() ? -1 : i->second);
+    }
+
+    /// @brief Get callout argument name
+    ///
+    /// @param index Index of the argument
+    ///
+    /// @return Name of the argument.
+    ///
+    /// @throw bundy::OutOfRange if the argument index is invalid.
+    const std::string& getArgumentName(int index) const;
+
+    /// @brief Return number of callout arguments
+    ///
+    /// @return Number of arguments registered.
+    int getArgumentCount() const {
+        return (argument_names_.size());
+    }
+
     /// @brief Return ServerHooks object
     ///
     /// Returns the global ServerHooks object.
@@ -175,6 +215,11 @@ private:
     /// simpler than using a multi-indexed container.)
     HookCollection  hooks_;                 ///< Hook name/index collection
     InverseHookCollection inverse_hooks_;   ///< Hook index/name collection
+
+    /// Registered callout arguments: name->index, and the names in index
+    /// order.
+    HookCollection  arguments_;
+    std::vector<std::string> argument_names_;
 };
 
 } // namespace util
@@ -0,0 +1,157 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <hooks/argument_slot.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using namespace bundy::hooks;
+using namespace std;
+
+namespace {
+
+/// @file
+/// @brief Holds the ArgumentSlot tests
+
+/// @brief Type too large to be held inside the slot itself
+struct Large {
+    Large(int value) : value_(value) {
+        ++instances_;
+    }
+    Large(const Large& other) : value_(other.value_) {
+        ++instances_;
+    }
+    ~Large() {
+        --instances_;
+    }
+    int value_;
+    char padding_[64];
+    static int instances_;
+};
+
+int Large::instances_ = 0;
+
+// Check that a new slot is empty and that getting a value from it throws.
+
+TEST(ArgumentSlotTest, Empty) {
+    ArgumentSlot slot;
+    EXPECT_TRUE(slot.empty());
+    EXPECT_THROW(slot.get<int>(), boost::bad_any_cast);
+}
+
+// Check that a simple value can be stored, replaced and cleared.
+
+TEST(ArgumentSlotTest, SimpleType) {
+    ArgumentSlot slot;
+    slot.set(42);
+    EXPECT_FALSE(slot.empty());
+    EXPECT_EQ(42, slot.get<int>());
+
+    slot.set(142);
+    EXPECT_EQ(142, slot.get<int>());
+
+    slot.clear();
+    EXPECT_TRUE(slot.empty());
+    EXPECT_THROW(slot.get<int>(), boost::bad_any_cast);
+}
+
+// Check that getting a value of the wrong type throws, and that a value of
+// another type replaces the one held.
+
+TEST(ArgumentSlotTest, IncorrectType) {
+    ArgumentSlot slot;
+    slot.set(42);
+    EXPECT_THROW(slot.get<long>(), boost::bad_any_cast);
+    EXPECT_THROW(slot.get<string>(), boost::bad_any_cast);
+
+    slot.set(string("forty-two"));
+    EXPECT_THROW(slot.get<int>(), boost::bad_any_cast);
+    EXPECT_EQ(string("forty-two"), slot.get<string>());
+}
+
+// Check that shared pointers are held correctly: the slot holds a
+// reference while it has the value and releases it when cleared.
+
+TEST(ArgumentSlotTest, SharedPointer) {
+    boost::shared_ptr<int> ptr(new int(42));
+    {
+        ArgumentSlot slot;
+        slot.set(ptr);
+        EXPECT_EQ(2, ptr.use_count());
+        EXPECT_EQ(42, *slot.get<boost::shared_ptr<int> >());
+
+        slot.clear();
+        EXPECT_EQ(1, ptr.use_count());
+
+        slot.set(ptr);
+        EXPECT_EQ(2, ptr.use_count());
+    }
+    EXPECT_EQ(1, ptr.use_count());
+}
+
+// Check that values too large to be stored inline are held correctly
+// and destroyed when replaced or cleared.
+
+TEST(ArgumentSlotTest, LargeType) {
+    {
+        ArgumentSlot slot;
+        slot.set(Large(1));
+        EXPECT_EQ(1, Large::instances_);
+        EXPECT_EQ(1, slot.get<Large>().value_);
+
+        slot.set(Large(2));
+        EXPECT_EQ(1, Large::instances_);
+        EXPECT_EQ(2, slot.get<Large>().value_);
+
+        slot.set(3);
+        EXPECT_EQ(0, Large::instances_);
+
+        slot.set(Large(4));
+        EXPECT_EQ(1, Large::instances_);
+    }
+    EXPECT_EQ(0, Large::instances_);
+}
+
+// Check that copying a slot copies the value held.
+
+TEST(ArgumentSlotTest, Copy) {
+    boost::shared_ptr<int> ptr(new int(42));
+    ArgumentSlot slot1;
+    slot1.set(ptr);
+
+    ArgumentSlot slot2(slot1);
+    EXPECT_EQ(3, ptr.use_count());
+    EXPECT_EQ(42, *slot2.get<boost::shared_ptr<int> >());
+
+    ArgumentSlot slot3;
+    slot3.set(Large(7));
+    ArgumentSlot slot4(slot3);
+    EXPECT_EQ(2, Large::instances_);
+    EXPECT_EQ(7, slot4.get<Large>().value_);
+
+    slot4 = slot1;
+    EXPECT_EQ(1, Large::instances_);
+    EXPECT_EQ(4, ptr.use_count());
+    EXPECT_EQ(42, *slot4.get<boost::shared_ptr<int> >());
+
+    slot3 = ArgumentSlot();
+    EXPECT_TRUE(slot3.empty());
+    EXPECT_EQ(0, Large::instances_);
+}
+
+} // Anonymous namespace
@@ -21,6 +21,10 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 using namespace bundy::hooks;
 using namespace std;
 
@@ -322,6 +326,85 @@ TEST_F(CalloutHandleTest, SkipFlag) {
     EXPECT_FALSE(handle.getSkip());
 }
 
+// *** Registered Argument Tests ***
+//
+// Arguments registered with ServerHooks are held in slots indexed by the
+// registration index.  They can be accessed by both index and name.
+
+// Check that a registered argument can be set and retrieved by index and
+// that the name-based interface sees the same value.
+
+TEST_F(CalloutHandleTest, RegisteredArgument) {
+    ServerHooks& hooks = ServerHooks::getServerHooks();
+    const int index = hooks.registerArgument("test_registered_one");
+    CalloutHandle handle(getCalloutManager());
+
+    int value = 0;
+    EXPECT_THROW(handle.getArgument(index, value), NoSuchArgument);
+
+    handle.setArgument(index, 42);
+    handle.getArgument(index, value);
+    EXPECT_EQ(42, value);
+
+    // The name-based interface accesses the same storage.
+    value = 0;
+    handle.getArgument("test_registered_one", value);
+    EXPECT_EQ(42, value);
+
+    handle.setArgument("test_registered_one", 142);
+    handle.getArgument(index, value);
+    EXPECT_EQ(142, value);
+
+    // Type mismatches are reported as for unregistered arguments.
+    long lvalue = 0;
+    EXPECT_THROW(handle.getArgument(index, lvalue), boost::bad_any_cast);
+
+    // An index that has not been registered cannot be set, and cannot be
+    // retrieved as it is never set.
+    EXPECT_THROW(handle.setArgument(hooks.getArgumentCount(), 1),
+                 bundy::OutOfRange);
+    EXPECT_THROW(handle.getArgument(-1, value), NoSuchArgument);
+}
+
+// Check that registered arguments are included in the argument names and
+// are removed by deleteArgument() and deleteAllArguments().
+
+TEST_F(CalloutHandleTest, RegisteredArgumentDelete) {
+    ServerHooks& hooks = ServerHooks::getServerHooks();
+    const int one = hooks.registerArgument("test_registered_one");
+    const int two = hooks.registerArgument("test_registered_two");
+    CalloutHandle handle(getCalloutManager());
+
+    handle.setArgument(one, 1);
+    handle.setArgument(two, 2);
+    handle.setArgument("unregistered", 3);
+
+    vector<string> names = handle.getArgumentNames();
+    sort(names.begin(), names.end());
+    ASSERT_EQ(3, names.size());
+    EXPECT_EQ(string("test_registered_one"), names[0]);
+    EXPECT_EQ(string("test_registered_two"), names[1]);
+    EXPECT_EQ(string("unregistered"), names[2]);
+
+    int value = 0;
+    handle.deleteArgument("test_registered_one");
+    EXPECT_THROW(handle.getArgument(one, value), NoSuchArgument);
+    EXPECT_THROW(handle.getArgument("test_registered_one", value),
+                 NoSuchArgument);
+    handle.getArgument(two, value);
+    EXPECT_EQ(2, value);
+
+    handle.deleteAllArguments();
+    EXPECT_THROW(handle.getArgument(two, value), NoSuchArgument);
+    EXPECT_THROW(handle.getArgument("unregistered", value), NoSuchArgument);
+    EXPECT_TRUE(handle.getArgumentNames().empty());
+
+    // Slots can be reused after deletion.
+    handle.setArgument(two, 22);
+    handle.getArgument(two, value);
+    EXPECT_EQ(22, value);
+}
+
 // Further tests of the "skip" flag and tests of getting the name of the
 // hook to which the current callout is attached is in the "handles_unittest"
 // module.
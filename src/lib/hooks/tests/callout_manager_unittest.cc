@@ -875,6 +875,91 @@ TEST_F(CalloutManagerTest, LibraryHandlePrePostUserLibrary) {
     EXPECT_EQ(154, callout_value_);
 }
 
+// *** Statistics Tests ***
+
+// Check that no statistics are collected by default, and that the
+// statistics can be retrieved even so.
+
+TEST_F(CalloutManagerTest, StatisticsDisabledByDefault) {
+    EXPECT_FALSE(getCalloutManager()->getStatisticsEnabled());
+
+    getCalloutManager()->setLibraryIndex(1);
+    getCalloutManager()->registerCallout("alpha", callout_one);
+    getCalloutManager()->callCallouts(alpha_index_, getCalloutHandle());
+    EXPECT_EQ(1, callout_value_);
+
+    EXPECT_EQ(0, getCalloutManager()->getStatistics(alpha_index_, 1).calls_);
+    EXPECT_EQ(0,
+              getCalloutManager()->getStatistics(alpha_index_, 1).total_time_);
+}
+
+// Check that when enabled, the callouts called are counted by hook and by
+// library.
+
+TEST_F(CalloutManagerTest, StatisticsCounts) {
+    getCalloutManager()->setStatisticsEnabled(true);
+    EXPECT_TRUE(getCalloutManager()->getStatisticsEnabled());
+
+    getCalloutManager()->setLibraryIndex(1);
+    getCalloutManager()->registerCallout("alpha", callout_one);
+    getCalloutManager()->registerCallout("alpha", callout_two);
+    getCalloutManager()->registerCallout("beta", callout_three);
+    getCalloutManager()->setLibraryIndex(2);
+    getCalloutManager()->registerCallout("alpha", callout_four_error);
+    getCalloutManager()->getPostLibraryHandle().registerCallout("alpha",
+                                                                callout_five);
+
+    getCalloutManager()->callCallouts(alpha_index_, getCalloutHandle());
+    getCalloutManager()->callCallouts(alpha_index_, getCalloutHandle());
+    getCalloutManager()->callCallouts(beta_index_, getCalloutHandle());
+
+    // Library 1 registered two callouts on alpha, so four calls; the error
+    // returned by library 2's callout does not stop it being counted.
+    CalloutStatistics stats = getCalloutManager()->getStatistics(alpha_index_,
+                                                                 1);
+    EXPECT_EQ(4, stats.calls_);
+    EXPECT_LE(stats.max_time_, stats.total_time_);
+    EXPECT_EQ(2, getCalloutManager()->getStatistics(alpha_index_, 2).calls_);
+    EXPECT_EQ(2,
+              getCalloutManager()->getStatistics(alpha_index_, INT_MAX).calls_);
+    EXPECT_EQ(0, getCalloutManager()->getStatistics(alpha_index_, 0).calls_);
+    EXPECT_EQ(1, getCalloutManager()->getStatistics(beta_index_, 1).calls_);
+    EXPECT_EQ(0, getCalloutManager()->getStatistics(beta_index_, 2).calls_);
+    EXPECT_EQ(0, getCalloutManager()->getStatistics(gamma_index_, 1).calls_);
+
+    // Disabling collection stops the counting but keeps the figures.
+    getCalloutManager()->setStatisticsEnabled(false);
+    getCalloutManager()->callCallouts(beta_index_, getCalloutHandle());
+    EXPECT_EQ(1, getCalloutManager()->getStatistics(beta_index_, 1).calls_);
+
+    // Re-enabling carries on from where it left off.
+    getCalloutManager()->setStatisticsEnabled(true);
+    getCalloutManager()->callCallouts(beta_index_, getCalloutHandle());
+    EXPECT_EQ(2, getCalloutManager()->getStatistics(beta_index_, 1).calls_);
+
+    // Clearing resets everything.
+    getCalloutManager()->clearStatistics();
+    stats = getCalloutManager()->getStatistics(alpha_index_, 1);
+    EXPECT_EQ(0, stats.calls_);
+    EXPECT_EQ(0, stats.total_time_);
+    EXPECT_EQ(0, stats.max_time_);
+    EXPECT_EQ(0, getCalloutManager()->getStatistics(beta_index_, 1).calls_);
+}
+
+// Check that invalid indexes are rejected when retrieving statistics.
+
+TEST_F(CalloutManagerTest, StatisticsInvalidIndex) {
+    getCalloutManager()->setStatisticsEnabled(true);
+
+    EXPECT_THROW(getCalloutManager()->getStatistics(-1, 1), NoSuchHook);
+    EXPECT_THROW(getCalloutManager()->getStatistics(
+                 ServerHooks::getServerHooks().getCount(), 1), NoSuchHook);
+    EXPECT_THROW(getCalloutManager()->getStatistics(alpha_index_, -1),
+                 NoSuchLibrary);
+    EXPECT_THROW(getCalloutManager()->getStatistics(alpha_index_, 11),
+                 NoSuchLibrary);
+}
+
 // The setting of the hook index is checked in the handles_unittest
 // set of tests, as access restrictions mean it is not easily tested
 // on its own.
@@ -47,9 +47,10 @@ public:
 
     /// @brief Destructor
     ///
-    /// Unload all libraries.
+    /// Unload all libraries and disable the collection of statistics.
     ~HooksManagerTest() {
         HooksManager::unloadLibraries();
+        HooksManager::setStatisticsEnabled(false);
     }
 
 
@@ -388,6 +389,48 @@ TEST_F(HooksManagerTest, NoLibrariesCallCallouts) {
     executeCallCallouts(-1, 3, -1, 22, -1, 83, -1);
 }
 
+// Check that callout statistics can be enabled and retrieved through the
+// HooksManager, and that the setting survives a reload of the libraries.
+
+TEST_F(HooksManagerTest, Statistics) {
+    HooksManager::setStatisticsEnabled(true);
+    EXPECT_TRUE(HooksManager::getStatisticsEnabled());
+
+    HooksManager::preCalloutsLibraryHandle().registerCallout("hookpt_two",
+                                                             testPreCallout);
+    CalloutHandlePtr handle = HooksManager::createCalloutHandle();
+    handle->setArgument("result", static_cast<int>(0));
+    HooksManager::callCallouts(hookpt_two_index_, *handle);
+    HooksManager::callCallouts(hookpt_two_index_, *handle);
+
+    std::vector<HookStatistics> stats = HooksManager::getStatistics();
+    ASSERT_EQ(1, stats.size());
+    EXPECT_EQ(std::string("hookpt_two"), stats[0].hook_name_);
+    EXPECT_EQ(0, stats[0].library_index_);
+    EXPECT_TRUE(stats[0].library_name_.empty());
+    EXPECT_EQ(2, stats[0].statistics_.calls_);
+
+    HooksManager::clearStatistics();
+    EXPECT_TRUE(HooksManager::getStatistics().empty());
+
+    // Reloading clears the figures but leaves collection enabled.
+    std::vector<std::string> library_names;
+    EXPECT_TRUE(HooksManager::loadLibraries(library_names));
+    HooksManager::preCalloutsLibraryHandle().registerCallout("hookpt_two",
+                                                             testPreCallout);
+    handle = HooksManager::createCalloutHandle();
+    handle->setArgument("result", static_cast<int>(0));
+    HooksManager::callCallouts(hookpt_two_index_, *handle);
+    stats = HooksManager::getStatistics();
+    ASSERT_EQ(1, stats.size());
+    EXPECT_EQ(1, stats[0].statistics_.calls_);
+
+    HooksManager::setStatisticsEnabled(false);
+    EXPECT_FALSE(HooksManager::getStatisticsEnabled());
+    HooksManager::callCallouts(hookpt_two_index_, *handle);
+    EXPECT_EQ(1, HooksManager::getStatistics()[0].statistics_.calls_);
+}
+
 // Test the encapsulation of the ServerHooks::registerHook() method.
 
 TEST_F(HooksManagerTest, RegisterHooks) {
@@ -0,0 +1,302 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <exceptions/exceptions.h>
+#include <hooks/callout_handle.h>
+#include <hooks/callout_manager.h>
+#include <hooks/parking_lot.h>
+#include <hooks/server_hooks.h>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+
+using namespace bundy;
+using namespace bundy::hooks;
+using namespace std;
+
+namespace {
+
+/// @file
+/// @brief Tests of the parking of the packets by the callouts.
+
+// Tickets got by the callouts.
+vector<ParkingTicketPtr> tickets;
+
+// Callout parking the packet.
+int
+park_callout(CalloutHandle& handle) {
+    tickets.push_back(handle.park());
+    return (0);
+}
+
+// Callout parking the packet and resuming it at once.
+int
+park_resume_callout(CalloutHandle& handle) {
+    handle.park()->resume();
+    return (0);
+}
+
+// Thread resuming a packet.
+void*
+resumeThread(void* ticket) {
+    static_cast<ParkingTicket*>(ticket)->resume();
+    return (NULL);
+}
+
+// Is the descriptor readable?
+bool
+isReadable(int fd, int timeout = 0) {
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    return ((poll(&pfd, 1, timeout) == 1) && ((pfd.revents & POLLIN) != 0));
+}
+
+class ParkingLotTest : public ::testing::Test {
+public:
+    ParkingLotTest() {
+        ServerHooks& hooks = ServerHooks::getServerHooks();
+        hooks.reset();
+        alpha_index_ = hooks.registerHook("alpha");
+        beta_index_ = hooks.registerHook("beta");
+
+        manager_.reset(new CalloutManager(2));
+        handle_.reset(new CalloutHandle(manager_));
+        tickets.clear();
+    }
+
+    ~ParkingLotTest() {
+        tickets.clear();
+    }
+
+    /// @brief Register a callout on "alpha" for a library
+    void registerCallout(int library_index, CalloutPtr callout) {
+        manager_->setLibraryIndex(library_index);
+        manager_->registerCallout("alpha", callout);
+    }
+
+    /// @brief Continuation recording the outcome
+    void continuation(bool resume) {
+        outcomes_.push_back(resume);
+    }
+
+    /// @brief Park the packet of the handle in the lot
+    bool park(ParkingLot& lot) {
+        return (lot.park(*handle_, boost::bind(&ParkingLotTest::continuation,
+                                               this, _1)));
+    }
+
+    int alpha_index_;
+    int beta_index_;
+    boost::shared_ptr<CalloutManager> manager_;
+    boost::shared_ptr<CalloutHandle> handle_;
+    vector<bool> outcomes_;
+};
+
+// The callouts park the packet through the callout handle, and that is
+// cleared for the next call of the callouts.
+TEST_F(ParkingLotTest, CalloutHandle) {
+    registerCallout(1, park_callout);
+
+    EXPECT_FALSE(handle_->isParked());
+    manager_->callCallouts(alpha_index_, *handle_);
+    EXPECT_TRUE(handle_->isParked());
+    ASSERT_EQ(1, tickets.size());
+    EXPECT_EQ(tickets[0], handle_->getParkingTicket());
+
+    manager_->callCallouts(beta_index_, *handle_);
+    EXPECT_FALSE(handle_->isParked());
+    EXPECT_FALSE(handle_->getParkingTicket());
+}
+
+// A packet can only be parked if the callouts parked it, and only once.
+TEST_F(ParkingLotTest, ParkErrors) {
+    ParkingLot lot;
+    EXPECT_THROW(park(lot), InvalidOperation);
+
+    registerCallout(1, park_callout);
+    manager_->callCallouts(alpha_index_, *handle_);
+    EXPECT_TRUE(park(lot));
+    EXPECT_THROW(park(lot), InvalidOperation);
+}
+
+// The continuation is called when the packet is resumed or dropped.
+TEST_F(ParkingLotTest, ResumeDrop) {
+    ParkingLot lot;
+    registerCallout(1, park_callout);
+
+    manager_->callCallouts(alpha_index_, *handle_);
+    ASSERT_TRUE(park(lot));
+    EXPECT_EQ(1, lot.getParkedCount());
+    EXPECT_FALSE(isReadable(lot.getFD()));
+    EXPECT_EQ(0, lot.processReady());
+    EXPECT_TRUE(outcomes_.empty());
+
+    tickets[0]->resume();
+    EXPECT_EQ(0, lot.getParkedCount());
+    EXPECT_TRUE(isReadable(lot.getFD()));
+    EXPECT_EQ(1, lot.processReady());
+    EXPECT_FALSE(isReadable(lot.getFD()));
+    ASSERT_EQ(1, outcomes_.size());
+    EXPECT_TRUE(outcomes_[0]);
+
+    // Further calls are ignored.
+    tickets[0]->resume();
+    tickets[0]->drop();
+    EXPECT_EQ(0, lot.processReady());
+
+    manager_->callCallouts(alpha_index_, *handle_);
+    ASSERT_TRUE(park(lot));
+    tickets[1]->drop();
+    EXPECT_EQ(1, lot.processReady());
+    ASSERT_EQ(2, outcomes_.size());
+    EXPECT_FALSE(outcomes_[1]);
+}
+
+// The packet parked by several callouts is resumed when all of them have
+// resumed it, and dropped as soon as one drops it.
+TEST_F(ParkingLotTest, SeveralCallouts) {
+    ParkingLot lot;
+    registerCallout(1, park_callout);
+    registerCallout(2, park_callout);
+
+    manager_->callCallouts(alpha_index_, *handle_);
+    ASSERT_EQ(2, tickets.size());
+    EXPECT_EQ(tickets[0], tickets[1]);
+    ASSERT_TRUE(park(lot));
+
+    tickets[0]->resume();
+    EXPECT_EQ(0, lot.processReady());
+    tickets[1]->resume();
+    EXPECT_EQ(1, lot.processReady());
+    ASSERT_EQ(1, outcomes_.size());
+    EXPECT_TRUE(outcomes_[0]);
+
+    tickets.clear();
+    manager_->callCallouts(alpha_index_, *handle_);
+    ASSERT_TRUE(park(lot));
+    tickets[1]->drop();
+    EXPECT_EQ(1, lot.processReady());
+    ASSERT_EQ(2, outcomes_.size());
+    EXPECT_FALSE(outcomes_[1]);
+}
+
+// A packet resumed before the server parks it goes on at once.
+TEST_F(ParkingLotTest, ResumedBeforeParking) {
+    ParkingLot lot;
+    registerCallout(1, park_resume_callout);
+
+    manager_->callCallouts(alpha_index_, *handle_);
+    EXPECT_TRUE(handle_->isParked());
+    ASSERT_TRUE(park(lot));
+    EXPECT_EQ(0, lot.getParkedCount());
+    EXPECT_TRUE(isReadable(lot.getFD()));
+    EXPECT_EQ(1, lot.processReady());
+    ASSERT_EQ(1, outcomes_.size());
+    EXPECT_TRUE(outcomes_[0]);
+}
+
+// No more packets than the limit are parked.
+TEST_F(ParkingLotTest, Limit) {
+    ParkingLot lot(1);
+    EXPECT_EQ(1, lot.getLimit());
+    registerCallout(1, park_callout);
+
+    manager_->callCallouts(alpha_index_, *handle_);
+    EXPECT_TRUE(park(lot));
+    manager_->callCallouts(alpha_index_, *handle_);
+    EXPECT_FALSE(park(lot));
+    EXPECT_EQ(1, lot.getParkedCount());
+
+    // The ticket of the packet which wasn't parked is ignored.
+    tickets[1]->resume();
+    EXPECT_EQ(0, lot.processReady());
+
+    lot.setLimit(0);
+    manager_->callCallouts(alpha_index_, *handle_);
+    EXPECT_TRUE(park(lot));
+    EXPECT_EQ(2, lot.getParkedCount());
+}
+
+// The packets not resumed in time are dropped.
+TEST_F(ParkingLotTest, Timeout) {
+    ParkingLot lot(0, 10);
+    EXPECT_EQ(10, lot.getTimeout());
+    EXPECT_EQ(-1, lot.getNextTimeout());
+    registerCallout(1, park_callout);
+
+    manager_->callCallouts(alpha_index_, *handle_);
+    ASSERT_TRUE(park(lot));
+    EXPECT_LE(0, lot.getNextTimeout());
+    EXPECT_GE(10, lot.getNextTimeout());
+
+    usleep(20000);
+    EXPECT_EQ(0, lot.getNextTimeout());
+    EXPECT_EQ(1, lot.processReady());
+    ASSERT_EQ(1, outcomes_.size());
+    EXPECT_FALSE(outcomes_[0]);
+    EXPECT_EQ(0, lot.getParkedCount());
+    EXPECT_EQ(-1, lot.getNextTimeout());
+
+    // A late resume is ignored.
+    tickets[0]->resume();
+    EXPECT_EQ(0, lot.processReady());
+
+    // Without a timeout, the packets stay parked.
+    lot.setTimeout(0);
+    manager_->callCallouts(alpha_index_, *handle_);
+    ASSERT_TRUE(park(lot));
+    EXPECT_EQ(-1, lot.getNextTimeout());
+    usleep(20000);
+    EXPECT_EQ(0, lot.processReady());
+}
+
+// A packet can be resumed from another thread, which wakes up the server.
+TEST_F(ParkingLotTest, ResumeFromThread) {
+    ParkingLot lot;
+    registerCallout(1, park_callout);
+
+    manager_->callCallouts(alpha_index_, *handle_);
+    ASSERT_TRUE(park(lot));
+
+    pthread_t thread;
+    ASSERT_EQ(0, pthread_create(&thread, NULL, resumeThread,
+                                tickets[0].get()));
+    EXPECT_TRUE(isReadable(lot.getFD(), 10000));
+    pthread_join(thread, NULL);
+
+    EXPECT_EQ(1, lot.processReady());
+    ASSERT_EQ(1, outcomes_.size());
+    EXPECT_TRUE(outcomes_[0]);
+}
+
+// The tickets can outlive the parking lot.
+TEST_F(ParkingLotTest, LotDestroyed) {
+    registerCallout(1, park_callout);
+    manager_->callCallouts(alpha_index_, *handle_);
+    {
+        ParkingLot lot;
+        ASSERT_TRUE(park(lot));
+    }
+    EXPECT_NO_THROW(tickets[0]->resume());
+    EXPECT_TRUE(outcomes_.empty());
+}
+
+}
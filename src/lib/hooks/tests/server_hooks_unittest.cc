@@ -175,4 +175,35 @@ TEST(ServerHooksTest, HookCount) {
     EXPECT_EQ(6, hooks.getCount());
 }
 
+// Check that callout arguments can be registered, that registration of
+// an existing name returns the existing index, and that the name can be
+// found from the index and vice versa.
+
+TEST(ServerHooksTest, RegisterArguments) {
+    ServerHooks& hooks = ServerHooks::getServerHooks();
+
+    // Argument registrations are not removed by reset(), so use names
+    // unlikely to be used elsewhere.
+    const int initial = hooks.getArgumentCount();
+    EXPECT_EQ(-1, hooks.findArgument("test_argument_alpha"));
+
+    const int alpha = hooks.registerArgument("test_argument_alpha");
+    const int beta = hooks.registerArgument("test_argument_beta");
+    EXPECT_NE(alpha, beta);
+    EXPECT_EQ(initial + 2, hooks.getArgumentCount());
+
+    // Registering again is not an error and returns the same index.
+    EXPECT_EQ(alpha, hooks.registerArgument("test_argument_alpha"));
+    EXPECT_EQ(initial + 2, hooks.getArgumentCount());
+
+    EXPECT_EQ(alpha, hooks.findArgument("test_argument_alpha"));
+    EXPECT_EQ(beta, hooks.findArgument("test_argument_beta"));
+    EXPECT_EQ(string("test_argument_alpha"), hooks.getArgumentName(alpha));
+    EXPECT_EQ(string("test_argument_beta"), hooks.getArgumentName(beta));
+
+    EXPECT_THROW(static_cast<void>(hooks.getArgumentName(-1)), OutOfRange);
+    EXPECT_THROW(static_cast<void>(
+                 hooks.getArgumentName(hooks.getArgumentCount())), OutOfRange);
+}
+
 } // Anonymous namespace
@@ -0,0 +1,334 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <log/async_output_impl.h>
+#include <log/log_formatter.h>
+#include <log/log_messages.h>
+#include <log/logger.h>
+#include <log/logger_impl.h>
+#include <log/logger_name.h>
+#include <log/message_dictionary.h>
+#include <log/interprocess/interprocess_sync_file.h>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <vector>
+
+#include <sched.h>
+#include <stdint.h>
+
+using namespace std;
+using bundy::util::thread::Mutex;
+using bundy::util::thread::Thread;
+
+namespace bundy {
+namespace log {
+namespace internal {
+
+namespace {
+
+// Maximum number of messages written under one acquisition of the locks.
+const size_t MAX_BATCH_SIZE = 256;
+
+size_t
+roundUpCapacity(size_t capacity) {
+    size_t rounded = 2;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+    return (rounded);
+}
+
+} // unnamed namespace
+
+AsyncOutput::AsyncOutput(size_t capacity,
+                         interprocess::InterprocessSync* sync) :
+    mask_(roundUpCapacity(capacity) - 1), slots_(new Slot[mask_ + 1]),
+    tail_(0), head_(0), running_(false), producers_(0), sleeping_(false),
+    full_(false), stopping_(false), queued_(0), written_(0), dropped_(0),
+    overflows_(0), reported_dropped_(0), sync_(sync)
+{
+    if (sync == NULL) {
+        bundy_throw(BadInterprocessSync,
+                    "NULL was passed to the asynchronous log output");
+    }
+    for (size_t i = 0; i <= mask_; ++i) {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+AsyncOutput::~AsyncOutput() {
+    stop();
+}
+
+void
+AsyncOutput::start() {
+    if (isRunning()) {
+        return;
+    }
+    stopping_ = false;
+    running_.store(true);
+    thread_.reset(new Thread(boost::bind(&AsyncOutput::run, this)));
+}
+
+void
+AsyncOutput::stop() {
+    if (!isRunning()) {
+        return;
+    }
+
+    // Reject new messages and wait for the producers already past the check
+    // to finish theirs, so nothing is left behind in the queue.
+    running_.store(false);
+    while (producers_.load() != 0) {
+        sched_yield();
+    }
+
+    {
+        Mutex::Locker locker(mutex_);
+        stopping_ = true;
+        wakeup_.signal();
+    }
+    thread_->wait();
+    thread_.reset();
+}
+
+bool
+AsyncOutput::push(const log4cplus::Logger& logger, const Severity& severity,
+                  const string& message)
+{
+    producers_.fetch_add(1);
+    if (!running_.load()) {
+        producers_.fetch_sub(1);
+        return (false);
+    }
+
+    // Claim a slot.  The sequence number of the slot at our position tells
+    // whether it is free (equal), still used by the consumer one lap ago
+    // (lower: the queue is full) or already claimed by another producer
+    // (higher: retry at the new tail).
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &slots_[pos & mask_];
+        const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        const intptr_t diff = static_cast<intptr_t>(sequence) -
+            static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (tail_.compare_exchange_weak(pos, pos + 1,
+                                            std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            if (!full_.exchange(true, std::memory_order_relaxed)) {
+                overflows_.fetch_add(1, std::memory_order_relaxed);
+            }
+            producers_.fetch_sub(1);
+            return (true);
+        } else {
+            pos = tail_.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->event.logger = logger;
+    slot->event.severity = severity;
+    slot->event.message.assign(message);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    queued_.fetch_add(1, std::memory_order_relaxed);
+    producers_.fetch_sub(1);
+
+    // Pairs with the fence in run(): either the consumer sees the message
+    // before going to sleep, or we see it sleeping and wake it up.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed)) {
+        Mutex::Locker locker(mutex_);
+        wakeup_.signal();
+    }
+    return (true);
+}
+
+bool
+AsyncOutput::pop(Event& event) {
+    Slot& slot = slots_[head_ & mask_];
+    if (slot.sequence.load(std::memory_order_acquire) != head_ + 1) {
+        return (false);
+    }
+    event.logger = slot.event.logger;
+    event.severity = slot.event.severity;
+    // Swapping hands the slot a string with spare capacity, so producers
+    // rarely need to allocate.
+    event.message.swap(slot.event.message);
+    slot.sequence.store(head_ + mask_ + 1, std::memory_order_release);
+    ++head_;
+    return (true);
+}
+
+void
+AsyncOutput::flush() {
+    const uint64_t target = queued_.load();
+    Mutex::Locker locker(mutex_);
+    while (isRunning() && written_.load() < target) {
+        written_cond_.wait(mutex_);
+    }
+    // Pass the wakeup on to any other thread waiting to flush.
+    written_cond_.signal();
+}
+
+AsyncOutputCounters
+AsyncOutput::getCounters() const {
+    const AsyncOutputCounters counters = {
+        queued_.load(std::memory_order_relaxed),
+        written_.load(std::memory_order_relaxed),
+        dropped_.load(std::memory_order_relaxed),
+        overflows_.load(std::memory_order_relaxed)
+    };
+    return (counters);
+}
+
+void
+AsyncOutput::run() {
+    vector<Event> batch(MAX_BATCH_SIZE);
+    while (true) {
+        size_t count = 0;
+        while (count < MAX_BATCH_SIZE && pop(batch[count])) {
+            ++count;
+        }
+        if (count > 0) {
+            write(&batch[0], count);
+            written_.fetch_add(count);
+            Mutex::Locker locker(mutex_);
+            written_cond_.signal();
+            continue;
+        }
+
+        // The queue is empty: we caught up, so report any drops.
+        reportDropped();
+
+        Mutex::Locker locker(mutex_);
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const bool empty = slots_[head_ & mask_].sequence.load(
+            std::memory_order_acquire) != head_ + 1;
+        if (empty) {
+            if (stopping_) {
+                sleeping_.store(false, std::memory_order_relaxed);
+                written_cond_.signal();
+                break;
+            }
+            wakeup_.wait(mutex_);
+        }
+        sleeping_.store(false, std::memory_order_relaxed);
+    }
+}
+
+void
+AsyncOutput::write(Event* events, size_t count) {
+    // The same exclusion as LoggerImpl::outputRaw(), but taken once for the
+    // whole batch.
+    Mutex::Locker mutex_locker(LoggerManager::getMutex());
+    interprocess::InterprocessSyncLocker locker(*sync_);
+
+    if (!locker.lock()) {
+        LoggerImpl::outputLog4cplus(events[0].logger, ERROR,
+                                    "Unable to lock logger lockfile");
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        try {
+            LoggerImpl::outputLog4cplus(events[i].logger, events[i].severity,
+                                        events[i].message);
+        } catch (...) {
+            // Nothing we can do about it; don't let it kill the thread.
+        }
+        events[i].message.clear();
+    }
+
+    if (!locker.unlock()) {
+        LoggerImpl::outputLog4cplus(events[0].logger, ERROR,
+                                    "Unable to unlock logger lockfile");
+    }
+}
+
+void
+AsyncOutput::reportDropped() {
+    const uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped == reported_dropped_) {
+        return;
+    }
+    full_.store(false, std::memory_order_relaxed);
+
+    Event event;
+    event.logger = log4cplus::Logger::getInstance(getRootLoggerName());
+    event.severity = WARN;
+    event.message = string(LOG_ASYNC_MESSAGES_DROPPED) + " " +
+        MessageDictionary::globalDictionary().getText(
+            LOG_ASYNC_MESSAGES_DROPPED);
+    replacePlaceholder(&event.message,
+                       boost::lexical_cast<string>(dropped -
+                                                   reported_dropped_), 1);
+    reported_dropped_ = dropped;
+    write(&event, 1);
+}
+
+namespace {
+
+// The process-wide output.  The pointer is what the logging threads look at;
+// the holder owns the object and stops it at exit, clearing the pointer
+// first so late messages are written synchronously.
+std::atomic<AsyncOutput*> async_output(NULL);
+
+struct AsyncOutputHolder {
+    ~AsyncOutputHolder() {
+        async_output.store(NULL);
+    }
+    boost::scoped_ptr<AsyncOutput> output;
+};
+
+AsyncOutputHolder&
+getHolder() {
+    static AsyncOutputHolder holder;
+    return (holder);
+}
+
+} // unnamed namespace
+
+AsyncOutput*
+getAsyncOutput() {
+    return (async_output.load(std::memory_order_acquire));
+}
+
+void
+enableAsyncOutput(size_t capacity) {
+    AsyncOutputHolder& holder = getHolder();
+    if (!holder.output) {
+        holder.output.reset(new AsyncOutput(
+            capacity, new interprocess::InterprocessSyncFile("logger")));
+        async_output.store(holder.output.get(), std::memory_order_release);
+    }
+    holder.output->start();
+}
+
+void
+disableAsyncOutput() {
+    AsyncOutput* output = getAsyncOutput();
+    if (output != NULL) {
+        output->stop();
+    }
+}
+
+} // namespace internal
+} // namespace log
+} // namespace bundy
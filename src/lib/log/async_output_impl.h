@@ -0,0 +1,201 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef LOG_ASYNC_OUTPUT_IMPL_H
+#define LOG_ASYNC_OUTPUT_IMPL_H
+
+#include <log/logger_level.h>
+#include <log/logger_manager.h>
+#include <log/interprocess/interprocess_sync.h>
+#include <util/threads/sync.h>
+#include <util/threads/thread.h>
+
+#include <log4cplus/logger.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <atomic>
+#include <string>
+
+namespace bundy {
+namespace log {
+namespace internal {
+
+/// \brief Asynchronous log output
+///
+/// This class moves the expensive part of logging - the layout of the
+/// message by log4cplus, the interprocess lock and the I/O - off the thread
+/// that logs the message.  The logging thread only places the (already
+/// expanded) message text on a bounded lock-free ring buffer, and a single
+/// background thread takes the messages off it and hands them to log4cplus
+/// in batches, taking the interprocess lock once per batch instead of once
+/// per message.
+///
+/// The queue never blocks the logging thread: if it is full, the message is
+/// dropped and counted.  The background thread reports the number of dropped
+/// messages with a LOG_ASYNC_MESSAGES_DROPPED warning once it catches up.
+///
+/// Any number of threads may call \c push() concurrently.  The remaining
+/// methods are meant to be called from a single controlling thread.
+class AsyncOutput : public boost::noncopyable {
+public:
+    /// \brief Constructor
+    ///
+    /// The output is created stopped; call \c start() to launch the
+    /// background thread.
+    ///
+    /// \param capacity Maximum number of queued messages.  It is rounded up
+    ///        to a power of two (and to at least 2).
+    /// \param sync The interprocess synchronization object used by the
+    ///        background thread.  Ownership is transferred to this object.
+    ///        It must not be NULL.
+    AsyncOutput(size_t capacity,
+                bundy::log::interprocess::InterprocessSync* sync);
+
+    /// \brief Destructor
+    ///
+    /// Stops the background thread, writing out any queued message.
+    ~AsyncOutput();
+
+    /// \brief Start the background thread
+    ///
+    /// Does nothing if it is already running.
+    void start();
+
+    /// \brief Stop the background thread
+    ///
+    /// Further calls to \c push() are rejected, and the messages already
+    /// queued are written out before this method returns.  Does nothing if
+    /// the output is not running.
+    void stop();
+
+    /// \brief Is the output accepting messages?
+    bool isRunning() const {
+        return (running_.load(std::memory_order_acquire));
+    }
+
+    /// \brief Queue a message for output
+    ///
+    /// \param logger The log4cplus logger the message is output to.
+    /// \param severity Severity of the message.
+    /// \param message Text of the message.  It is copied into a slot of the
+    ///        queue, whose storage is reused from message to message.
+    ///
+    /// \return false if the output is not running, in which case the caller
+    ///         should write the message itself.  true if the message was
+    ///         queued or dropped because the queue was full.
+    bool push(const log4cplus::Logger& logger, const Severity& severity,
+              const std::string& message);
+
+    /// \brief Wait until all messages queued so far are written
+    ///
+    /// Returns immediately if the output is not running.
+    void flush();
+
+    /// \brief Return the counters
+    AsyncOutputCounters getCounters() const;
+
+    /// \brief Return the capacity of the queue
+    size_t getCapacity() const {
+        return (mask_ + 1);
+    }
+
+private:
+    /// \brief One queued message
+    struct Event {
+        // log4cplus::Logger isn't default constructible everywhere, so use
+        // the root logger as placeholder.
+        Event() : logger(log4cplus::Logger::getRoot()), severity(NONE) {}
+
+        log4cplus::Logger logger;
+        Severity severity;
+        std::string message;
+    };
+
+    /// \brief A slot of the ring buffer
+    ///
+    /// The sequence number tells whose turn it is to use the slot: a producer
+    /// may claim it when it equals the queue position, the consumer may read
+    /// it when it equals the position plus one.
+    struct Slot {
+        std::atomic<size_t> sequence;
+        Event event;
+    };
+
+    /// \brief Take the next message off the queue (consumer only)
+    bool pop(Event& event);
+
+    /// \brief Main loop of the background thread
+    void run();
+
+    /// \brief Write a batch of messages to log4cplus
+    void write(Event* events, size_t count);
+
+    /// \brief Report messages dropped since the last report
+    void reportDropped();
+
+    static const size_t CACHE_LINE_SIZE = 64;
+
+    const size_t mask_;
+    boost::scoped_array<Slot> slots_;
+
+    // The producers' and the consumer's positions are kept on separate
+    // cache lines so that they don't bounce between the cores.
+    std::atomic<size_t> tail_;
+    char padding_[CACHE_LINE_SIZE];
+    size_t head_;
+
+    std::atomic<bool> running_;
+    std::atomic<size_t> producers_;
+    std::atomic<bool> sleeping_;
+    std::atomic<bool> full_;
+    bool stopping_;
+
+    std::atomic<uint64_t> queued_;
+    std::atomic<uint64_t> written_;
+    std::atomic<uint64_t> dropped_;
+    std::atomic<uint64_t> overflows_;
+    uint64_t reported_dropped_;
+
+    bundy::util::thread::Mutex mutex_;
+    bundy::util::thread::CondVar wakeup_;
+    bundy::util::thread::CondVar written_cond_;
+
+    boost::scoped_ptr<bundy::log::interprocess::InterprocessSync> sync_;
+    boost::scoped_ptr<bundy::util::thread::Thread> thread_;
+};
+
+/// \brief Return the process-wide asynchronous output
+///
+/// \return The output, or NULL if asynchronous output was never enabled.
+AsyncOutput* getAsyncOutput();
+
+/// \brief Enable the process-wide asynchronous output
+///
+/// Creates the output on first use (subsequent calls don't change the
+/// capacity) and starts it.
+void enableAsyncOutput(size_t capacity);
+
+/// \brief Disable the process-wide asynchronous output
+///
+/// Any message queued is written before this function returns.
+void disableAsyncOutput();
+
+} // namespace internal
+} // namespace log
+} // namespace bundy
+
+#endif // LOG_ASYNC_OUTPUT_IMPL_H
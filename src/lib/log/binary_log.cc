@@ -0,0 +1,379 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <log/binary_log.h>
+#include <log/log_messages.h>
+#include <log/macros.h>
+
+#include <boost/lexical_cast.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using boost::lexical_cast;
+
+namespace bundy {
+namespace log {
+
+namespace {
+
+const char BINARY_LOG_MAGIC[] = "BUNDYBLG";
+const uint32_t BINARY_LOG_VERSION = 1;
+const uint32_t BINARY_LOG_BYTE_ORDER = 0x01020304;
+
+// Minimum number of slots in a file: the header and one record.
+const size_t MIN_CAPACITY = 2;
+
+bool
+isValidHeader(const BinaryLogHeader& header) {
+    return (std::memcmp(header.magic, BINARY_LOG_MAGIC,
+                        sizeof(header.magic)) == 0 &&
+            header.version == BINARY_LOG_VERSION &&
+            header.record_size == BINARY_RECORD_SIZE &&
+            header.byte_order == BINARY_LOG_BYTE_ORDER);
+}
+
+// Read exactly len bytes at the current position.  Returns false at the
+// end of the file (including a partial slot left by a crashed writer).
+bool
+readFully(int fd, void* data, size_t len) {
+    uint8_t* cp = static_cast<uint8_t*>(data);
+    while (len > 0) {
+        const ssize_t cc = ::read(fd, cp, len);
+        if (cc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            bundy_throw(BinaryLogError, "read failed: " << strerror(errno));
+        } else if (cc == 0) {
+            return (false);
+        }
+        cp += cc;
+        len -= cc;
+    }
+    return (true);
+}
+
+// Shift file -> file.1 -> file.2 ... -> file.maxver, discarding the
+// oldest; with no versions to keep, the file is just removed.  Errors are
+// ignored, as in log4cplus's rolling file appender: a missing version
+// is normal, and the new file replaces the old one anyway.
+void
+rotateFiles(const std::string& filename, unsigned int maxver) {
+    if (maxver == 0) {
+        ::unlink(filename.c_str());
+        return;
+    }
+    for (unsigned int i = maxver - 1; i > 0; --i) {
+        ::rename((filename + "." + lexical_cast<std::string>(i)).c_str(),
+                 (filename + "." + lexical_cast<std::string>(i + 1)).c_str());
+    }
+    ::rename(filename.c_str(), (filename + ".1").c_str());
+}
+
+}
+
+// One mapping of a log file.  The two segments live as long as the
+// BinaryLog, so a writer can always safely access the counters of the
+// segment it loaded from current_, even after the log was rotated or
+// closed; the mapping itself is only touched after re-checking current_.
+struct BinaryLog::Segment {
+    Segment() : writers(0), next(0), base(NULL), fd(-1) {}
+
+    std::atomic<unsigned int> writers;  // Writers using this segment
+    std::atomic<size_t> next;           // Next slot to reserve
+    uint8_t* base;                      // Start of the mapping
+    int fd;
+};
+
+BinaryLog::BinaryLog() :
+    capacity_(0), maxver_(0), segments_(new Segment[2]), current_(NULL),
+    rotating_(false), written_(0), dropped_(0)
+{}
+
+BinaryLog::~BinaryLog() {
+    close();
+    delete[] segments_;
+}
+
+BinaryLog&
+BinaryLog::global() {
+    static BinaryLog log;
+    return (log);
+}
+
+void
+BinaryLog::open(const std::string& filename, size_t maxsize,
+                unsigned int maxver)
+{
+    if (maxsize == 0) {
+        maxsize = DEFAULT_MAX_SIZE;
+    }
+    const size_t capacity = std::max(maxsize / BINARY_RECORD_SIZE,
+                                     MIN_CAPACITY);
+    if (isOpen() && filename == name_ && capacity == capacity_ &&
+        maxver == maxver_) {
+        return;
+    }
+    close();
+
+    name_ = filename;
+    filename_ = filename;
+    capacity_ = capacity;
+    maxver_ = maxver;
+    try {
+        map(&segments_[0]);
+    } catch (...) {
+        name_.clear();
+        filename_.clear();
+        throw;
+    }
+    current_.store(&segments_[0]);
+}
+
+void
+BinaryLog::close() {
+    Segment* const segment = current_.exchange(NULL);
+    if (segment == NULL && segments_[0].base == NULL &&
+        segments_[1].base == NULL) {
+        return;
+    }
+
+    // A rotation in progress may still publish a new segment; wait for it
+    // and retract it.
+    while (rotating_.load()) {
+        sched_yield();
+    }
+    current_.store(NULL);
+    for (int i = 0; i < 2; ++i) {
+        waitForWriters(&segments_[i]);
+        unmap(&segments_[i], true);
+    }
+    name_.clear();
+    filename_.clear();
+}
+
+bool
+BinaryLog::write(const BinaryLogRecord& record) {
+    while (true) {
+        Segment* const segment = begin(current_.load());
+        if (segment == NULL) {
+            break;
+        }
+
+        const size_t slot = segment->next.fetch_add(1,
+                                                    std::memory_order_relaxed);
+        if (slot < capacity_) {
+            BinaryLogRecord* const dst = reinterpret_cast<BinaryLogRecord*>(
+                segment->base + slot * BINARY_RECORD_SIZE);
+            std::memcpy(reinterpret_cast<uint8_t*>(dst) +
+                        sizeof(dst->committed),
+                        reinterpret_cast<const uint8_t*>(&record) +
+                        sizeof(record.committed),
+                        BINARY_RECORD_SIZE - sizeof(record.committed));
+            // Make the body visible before the record is marked complete.
+            std::atomic_thread_fence(std::memory_order_release);
+            dst->committed = 1;
+            segment->writers.fetch_sub(1, std::memory_order_release);
+            written_.fetch_add(1, std::memory_order_relaxed);
+            return (true);
+        }
+
+        // The file is full.  The first thread to notice rotates it and
+        // tries again; the others drop their record rather than wait.
+        segment->writers.fetch_sub(1, std::memory_order_release);
+        bool expected = false;
+        if (!rotating_.compare_exchange_strong(expected, true)) {
+            break;
+        }
+        if (current_.load() == segment) {
+            rotate(segment);
+        }
+        rotating_.store(false);
+    }
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return (false);
+}
+
+// Register as a writer of the given segment.  A writer that loaded the
+// segment before it was replaced backs off, so that once current_ has
+// changed the writers count of the old segment can only go down.
+BinaryLog::Segment*
+BinaryLog::begin(Segment* segment) {
+    while (segment != NULL) {
+        segment->writers.fetch_add(1);
+        Segment* const current = current_.load();
+        if (current == segment) {
+            break;
+        }
+        segment->writers.fetch_sub(1, std::memory_order_release);
+        segment = current;
+    }
+    return (segment);
+}
+
+void
+BinaryLog::rotate(Segment* full) {
+    Segment* const other = (full == &segments_[0]) ? &segments_[1] :
+        &segments_[0];
+
+    // The other segment is the one replaced by the previous rotation;
+    // its last writers must be done before it's reused.
+    waitForWriters(other);
+    unmap(other, true);
+    try {
+        rotateFiles(filename_, maxver_);
+        map(other);
+        current_.store(other);
+    } catch (const std::exception& ex) {
+        Logger logger("log");
+        LOG_ERROR(logger, LOG_BINARY_ROTATE_FAILED).arg(filename_).
+            arg(ex.what());
+        current_.store(NULL);
+    }
+}
+
+// Open (or create) filename_ and map it in the given segment.  If the file
+// is locked by another process, the process ID is appended to the name.
+void
+BinaryLog::map(Segment* segment) {
+    int fd = ::open(filename_.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd >= 0 && flock(fd, LOCK_EX | LOCK_NB) != 0 && filename_ == name_) {
+        ::close(fd);
+        filename_ = name_ + "." + lexical_cast<std::string>(getpid());
+        fd = ::open(filename_.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd >= 0 && flock(fd, LOCK_EX | LOCK_NB) != 0) {
+            ::close(fd);
+            bundy_throw(BinaryLogError, filename_ << " is locked by "
+                        "another process");
+        }
+    }
+    if (fd < 0) {
+        bundy_throw(BinaryLogError, "failed to open " << filename_ << ": " <<
+                    strerror(errno));
+    }
+
+    // Append to an existing binary log file with room left in it.  A full
+    // one is rotated first; anything else is not ours to overwrite.
+    struct stat st;
+    BinaryLogHeader header;
+    size_t used = 1;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        if (!readFully(fd, &header, sizeof(header)) ||
+            !isValidHeader(header)) {
+            ::close(fd);
+            bundy_throw(BinaryLogError, filename_ << " exists and is not "
+                        "a binary log file");
+        }
+        used = st.st_size / BINARY_RECORD_SIZE;
+        if (used >= capacity_) {
+            ::close(fd);
+            rotateFiles(filename_, maxver_);
+            map(segment);
+            return;
+        }
+    }
+
+    const size_t length = capacity_ * BINARY_RECORD_SIZE;
+    void* base = MAP_FAILED;
+    if (ftruncate(fd, length) == 0) {
+        base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (base == MAP_FAILED) {
+        const int error = errno;
+        ::close(fd);
+        bundy_throw(BinaryLogError, "failed to map " << filename_ << ": " <<
+                    strerror(error));
+    }
+
+    if (used == 1) {
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, BINARY_LOG_MAGIC, sizeof(header.magic));
+        header.version = BINARY_LOG_VERSION;
+        header.record_size = BINARY_RECORD_SIZE;
+        header.byte_order = BINARY_LOG_BYTE_ORDER;
+        std::memcpy(base, &header, sizeof(header));
+    }
+    segment->base = static_cast<uint8_t*>(base);
+    segment->fd = fd;
+    segment->next.store(used);
+}
+
+// Unmap the segment, if mapped, optionally truncating the file to the
+// slots actually used.
+void
+BinaryLog::unmap(Segment* segment, bool truncate) {
+    if (segment->base == NULL) {
+        return;
+    }
+    munmap(segment->base, capacity_ * BINARY_RECORD_SIZE);
+    if (truncate) {
+        const size_t used = std::min(segment->next.load(), capacity_);
+        if (ftruncate(segment->fd, used * BINARY_RECORD_SIZE) != 0) {
+            // Nothing more can be done; the trailing slots are empty and
+            // skipped by the reader.
+        }
+    }
+    ::close(segment->fd);
+    segment->base = NULL;
+    segment->fd = -1;
+}
+
+void
+BinaryLog::waitForWriters(const Segment* segment) {
+    while (segment->writers.load(std::memory_order_acquire) != 0) {
+        sched_yield();
+    }
+}
+
+BinaryLogReader::BinaryLogReader(const std::string& filename) :
+    fd_(::open(filename.c_str(), O_RDONLY))
+{
+    if (fd_ < 0) {
+        bundy_throw(BinaryLogError, "failed to open " << filename << ": " <<
+                    strerror(errno));
+    }
+    BinaryLogHeader header;
+    if (!readFully(fd_, &header, sizeof(header)) || !isValidHeader(header)) {
+        ::close(fd_);
+        bundy_throw(BinaryLogError, filename << " is not a binary log file "
+                    "written in this format and byte order");
+    }
+}
+
+BinaryLogReader::~BinaryLogReader() {
+    ::close(fd_);
+}
+
+bool
+BinaryLogReader::next(BinaryLogRecord& record) {
+    while (readFully(fd_, &record, sizeof(record))) {
+        if (record.committed != 0) {
+            return (true);
+        }
+    }
+    return (false);
+}
+
+} // namespace log
+} // namespace bundy
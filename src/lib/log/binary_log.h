@@ -0,0 +1,236 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef LOG_BINARY_LOG_H
+#define LOG_BINARY_LOG_H
+
+#include <exceptions/exceptions.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/static_assert.hpp>
+
+#include <atomic>
+#include <string>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace log {
+
+/// \brief Binary log error
+///
+/// Thrown when the binary log file can't be opened, mapped or read.
+class BinaryLogError : public bundy::Exception {
+public:
+    BinaryLogError(const char* file, size_t line, const char* what) :
+        bundy::Exception(file, line, what)
+    {}
+};
+
+/// \brief A binary query log record
+///
+/// Each record occupies a fixed-size slot of the binary log file, so that
+/// a writer only needs to reserve a slot and copy the record in.  Integers
+/// are stored in the byte order of the writing host, which is identified
+/// by the \c byte_order field of the file header.
+///
+/// The \c committed field is set by \c BinaryLog::write() once the rest of
+/// the record is in place; slots where it is zero were reserved but never
+/// completed and are skipped by \c BinaryLogReader.
+struct BinaryLogRecord {
+    /// Bits of the \c flags field
+    enum {
+        FLAG_TCP = 0x01,        ///< The query was received over TCP
+        FLAG_NO_RESPONSE = 0x02 ///< No response was sent; rcode is unset
+    };
+
+    uint32_t committed;         ///< Non-zero once the record is complete
+    uint32_t latency;           ///< Processing time in microseconds
+    uint64_t timestamp;         ///< Microseconds since the epoch
+    uint16_t qtype;             ///< Query type
+    uint16_t port;              ///< Client port
+    uint8_t rcode;              ///< Response code (lower 8 bits)
+    uint8_t family;             ///< 4 or 6; the client address family
+    uint8_t qname_length;       ///< Length of qname in wire format
+    uint8_t flags;              ///< FLAG_xxx bits
+    uint8_t address[16];        ///< Client address, first 4 bytes for IPv4
+    uint8_t qname[255];         ///< Query name in (uncompressed) wire format
+    uint8_t padding[25];        ///< Pads the record to BINARY_RECORD_SIZE
+};
+
+/// \brief The binary log file header
+///
+/// The first slot of every binary log file holds this header.
+struct BinaryLogHeader {
+    char magic[8];              ///< "BUNDYBLG"
+    uint32_t version;           ///< Format version, currently 1
+    uint32_t record_size;       ///< Size of each slot, including this one
+    uint32_t byte_order;        ///< 0x01020304 in the writer's byte order
+    uint8_t padding[300];       ///< Pads the header to BINARY_RECORD_SIZE
+};
+
+/// Size of each slot of a binary log file.
+const size_t BINARY_RECORD_SIZE = 320;
+BOOST_STATIC_ASSERT(sizeof(BinaryLogRecord) == BINARY_RECORD_SIZE);
+BOOST_STATIC_ASSERT(sizeof(BinaryLogHeader) == BINARY_RECORD_SIZE);
+
+/// \brief Binary structured log
+///
+/// This is a logging destination for high-volume records such as query
+/// logs, for which the per-message cost of the text logging (formatting,
+/// layout, locking and a write system call) is too high.  Records have a
+/// fixed layout and are copied into a memory-mapped file: writing a record
+/// is a \c memcpy into a slot reserved with a single atomic increment, so
+/// any number of threads can write concurrently without taking a lock.
+///
+/// The file is rotated when it is full: "file" is renamed to "file.1",
+/// "file.1" to "file.2" and so on up to the configured number of versions,
+/// and a new file is mapped.  Only the thread that finds the file full
+/// does the rotation; records written by other threads while it is in
+/// progress are dropped and counted, as are records that arrive when the
+/// log isn't open.  Two mappings are alternated, so that writers that
+/// reserved a slot in the old file finish before it is unmapped.
+///
+/// If another process already holds the file, the log is opened with the
+/// process ID appended to the file name.
+///
+/// Unlike the other logging destinations, there is one binary log for the
+/// process (\c global()); it's opened with the "binary" output destination
+/// of the logging configuration.  \c open() and \c close() must not be
+/// called concurrently with each other, but may be called while other
+/// threads are writing.
+class BinaryLog : public boost::noncopyable {
+public:
+    /// Default maximum file size if none is configured (64MB).
+    static const size_t DEFAULT_MAX_SIZE = 64 * 1024 * 1024;
+
+    /// \brief Constructor
+    ///
+    /// The log is created closed.
+    BinaryLog();
+
+    /// \brief Destructor
+    ///
+    /// Closes the log.
+    ~BinaryLog();
+
+    /// \brief Open the log
+    ///
+    /// If the log is already open on the same file with the same
+    /// parameters, this does nothing; otherwise it's closed first.  An
+    /// existing file in the binary log format is appended to; any other
+    /// existing file is replaced.
+    ///
+    /// \param filename Name of the log file.
+    /// \param maxsize Maximum size of each file in bytes; 0 selects
+    ///        \c DEFAULT_MAX_SIZE.  It's rounded down to a number of slots.
+    /// \param maxver Number of old versions to keep when rotating.  If 0,
+    ///        the file is simply replaced when it's full.
+    ///
+    /// \throw BinaryLogError The file can't be created or mapped.
+    void open(const std::string& filename, size_t maxsize,
+              unsigned int maxver);
+
+    /// \brief Close the log
+    ///
+    /// Waits for the writers in progress, then unmaps the file and truncates
+    /// it to the records written.  Does nothing if the log isn't open.
+    void close();
+
+    /// \brief Is the log open?
+    bool isOpen() const {
+        return (current_.load(std::memory_order_relaxed) != NULL);
+    }
+
+    /// \brief Write a record
+    ///
+    /// The \c committed field of the record is ignored.
+    ///
+    /// \return true if the record was written, false if it was dropped.
+    /// \throw None
+    bool write(const BinaryLogRecord& record);
+
+    /// \brief Name of the file being written
+    ///
+    /// This may differ from the name passed to \c open() if the file was
+    /// held by another process.  Empty if the log isn't open.
+    const std::string& getFilename() const {
+        return (filename_);
+    }
+
+    /// \brief Number of records written since construction
+    uint64_t getWritten() const {
+        return (written_.load(std::memory_order_relaxed));
+    }
+
+    /// \brief Number of records dropped since construction
+    uint64_t getDropped() const {
+        return (dropped_.load(std::memory_order_relaxed));
+    }
+
+    /// \brief The binary log of the process
+    static BinaryLog& global();
+
+private:
+    struct Segment;
+
+    Segment* begin(Segment* segment);
+    void rotate(Segment* full);
+    void map(Segment* segment);
+    void unmap(Segment* segment, bool truncate);
+    static void waitForWriters(const Segment* segment);
+
+    std::string name_;              // Name passed to open()
+    std::string filename_;          // Name of the file being written
+    size_t capacity_;               // Slots per file, including the header
+    unsigned int maxver_;
+    Segment* segments_;             // The two alternating mappings
+    std::atomic<Segment*> current_;
+    std::atomic<bool> rotating_;
+    std::atomic<uint64_t> written_;
+    std::atomic<uint64_t> dropped_;
+};
+
+/// \brief Binary log reader
+///
+/// Reads the records of a single binary log file, as written by
+/// \c BinaryLog.  Slots that were reserved but never committed are
+/// skipped.
+class BinaryLogReader : public boost::noncopyable {
+public:
+    /// \brief Constructor
+    ///
+    /// \param filename Name of the file to read.
+    /// \throw BinaryLogError The file can't be opened, or isn't a binary
+    ///        log file written with this record layout and byte order.
+    explicit BinaryLogReader(const std::string& filename);
+
+    /// \brief Destructor
+    ~BinaryLogReader();
+
+    /// \brief Read the next record
+    ///
+    /// \param record Filled with the next record on success.
+    /// \return true if a record was read, false at the end of the file.
+    /// \throw BinaryLogError A read error occurred.
+    bool next(BinaryLogRecord& record);
+
+private:
+    int fd_;
+};
+
+} // namespace log
+} // namespace bundy
+
+#endif // LOG_BINARY_LOG_H
@@ -469,11 +469,18 @@ writeProgramFile(const string& file, const vector<string>& ns_components,
          "\n" <<
          "const char* values[] = {\n";
 
-    // Output the identifiers and the associated text.
+    // Output the identifiers and the associated text.  The identifiers are
+    // the message symbols rather than copies of their strings, so that the
+    // dictionary indexes the addresses used by the code.
+    string ns_prefix;
+    for (vector<string>::const_iterator i = ns_components.begin();
+        i != ns_components.end(); ++i) {
+        ns_prefix += *i + "::";
+    }
     idents = sortedIdentifiers(dictionary);
     for (vector<string>::const_iterator i = idents.begin();
         i != idents.end(); ++i) {
-            ccfile << "    \"" << *i << "\", \"" <<
+            ccfile << "    " << ns_prefix << *i << ", \"" <<
                 quoteString(dictionary.getText(*i)) << "\",\n";
     }
 
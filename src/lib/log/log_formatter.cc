@@ -16,6 +16,7 @@
 #include <log/log_formatter.h>
 
 #include <cassert>
+#include <vector>
 
 #ifdef ENABLE_LOGGER_CHECKS
 #include <iostream>
@@ -53,6 +54,70 @@ replacePlaceholder(string* message, const string& arg,
 #endif /* ENABLE_LOGGER_CHECKS */
 }
 
+void
+checkPlaceholder(const string* message, const string& arg,
+                 const unsigned placeholder)
+{
+#ifdef ENABLE_LOGGER_CHECKS
+    const string mark("%" + lexical_cast<string>(placeholder));
+    if (message->find(mark) == string::npos) {
+        bundy_throw(MismatchedPlaceholders,
+		  "Missing logger placeholder in message: " << *message);
+    }
+#else
+    // Nothing to check right now; replacePlaceholders() will complain
+    // about the missing placeholder.
+    static_cast<void>(message);
+    static_cast<void>(arg);
+    static_cast<void>(placeholder);
+#endif /* ENABLE_LOGGER_CHECKS */
+}
+
+void
+replacePlaceholders(string* message, const vector<string>& args) {
+    string result;
+    size_t length = message->size();
+    for (vector<string>::const_iterator arg = args.begin(); arg != args.end();
+         ++arg) {
+        length += arg->size();
+    }
+    result.reserve(length);
+
+    vector<bool> used(args.size(), false);
+    size_t start = 0;
+    size_t pos;
+    while ((pos = message->find('%', start)) != string::npos) {
+        // Parse the number following the '%', if any.
+        size_t end = pos + 1;
+        size_t placeholder = 0;
+        while (end < message->size() && (*message)[end] >= '0' &&
+               (*message)[end] <= '9' && placeholder <= args.size()) {
+            placeholder = placeholder * 10 + ((*message)[end] - '0');
+            ++end;
+        }
+        if (placeholder >= 1 && placeholder <= args.size()) {
+            result.append(*message, start, pos - start);
+            result.append(args[placeholder - 1]);
+            used[placeholder - 1] = true;
+            start = end;
+        } else {
+            // Not one of ours, keep it as it is.
+            result.append(*message, start, pos + 1 - start);
+            start = pos + 1;
+        }
+    }
+    result.append(*message, start, string::npos);
+
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (!used[i]) {
+            result.append(" @@Missing placeholder %" +
+                          lexical_cast<string>(i + 1) + " for '" + args[i] +
+                          "'@@");
+        }
+    }
+    message->swap(result);
+}
+
 void
 checkExcessPlaceholders(string* message, unsigned int placeholder) {
     const string mark("%" + lexical_cast<string>(placeholder));
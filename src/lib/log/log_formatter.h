@@ -18,6 +18,7 @@
 #include <cstddef>
 #include <string>
 #include <iostream>
+#include <vector>
 
 #include <exceptions/exceptions.h>
 #include <boost/lexical_cast.hpp>
@@ -63,13 +64,35 @@ checkExcessPlaceholders(std::string* message, unsigned int placeholder);
 ///
 /// \brief The internal replacement routine
 ///
-/// This is used internally by the Formatter. Replaces a placeholder
-/// in the message by replacement. If the placeholder is not found,
-/// it adds a complain at the end.
+/// Replaces a placeholder in the message by replacement. If the placeholder
+/// is not found, it adds a complain at the end.
 void
 replacePlaceholder(std::string* message, const std::string& replacement,
                    const unsigned placeholder);
 
+///
+/// \brief Internal check of a placeholder
+///
+/// This is used internally by the Formatter when an argument is given.  If
+/// logger checks are enabled and the message has no placeholder for the
+/// argument, it throws MismatchedPlaceholders.  Otherwise it does nothing:
+/// the complaint is added when the message is formatted.
+void
+checkPlaceholder(const std::string* message, const std::string& replacement,
+                 const unsigned placeholder);
+
+///
+/// \brief The internal formatting routine
+///
+/// This is used internally by the Formatter when the message is output.
+/// Replaces all the placeholders %1, %2... of the message by the
+/// corresponding arguments in a single pass over the message.  Arguments
+/// whose placeholder is not found are complained about at the end of the
+/// message, as with replacePlaceholder().
+void
+replacePlaceholders(std::string* message,
+                    const std::vector<std::string>& replacements);
+
 ///
 /// \brief The log message formatter
 ///
@@ -89,8 +112,11 @@ replacePlaceholder(std::string* message, const std::string& replacement,
 /// .arg can be called on it. After the last .arg call is done, the object is
 /// destroyed and, again, we can produce the output.
 ///
-/// Of course, if the logging is turned off, we don't bother with any replacing
-/// and just return.
+/// The arguments are only collected by the .arg calls; the placeholders are
+/// replaced when the message is output, in a single pass.  Of course, if the
+/// logging is turned off (or the message is suppressed by the
+/// MessageLimiter), we don't bother with any of this and
+/// just return.
 ///
 /// User of logging code should not really care much about this class, only
 /// call the .arg method to generate the correct output.
@@ -120,6 +146,11 @@ private:
     /// \brief The messages with %1, %2... placeholders
     std::string* message_;
 
+    /// \brief Arguments given so far, NULL if none
+    ///
+    /// Owned (like message_) by the formatter that is active.
+    std::vector<std::string>* args_;
+
     /// \brief Which will be the next placeholder to replace
     unsigned nextPlaceholder_;
 
@@ -141,7 +172,7 @@ public:
     ///     if no output is wanted.
     Formatter(const Severity& severity = NONE, std::string* message = NULL,
               Logger* logger = NULL) :
-        logger_(logger), severity_(severity), message_(message),
+        logger_(logger), severity_(severity), message_(message), args_(NULL),
         nextPlaceholder_(0)
     {
     }
@@ -153,7 +184,8 @@ public:
     /// object being copied relinquishes that responsibility.
     Formatter(const Formatter& other) :
         logger_(other.logger_), severity_(other.severity_),
-        message_(other.message_), nextPlaceholder_(other.nextPlaceholder_)
+        message_(other.message_), args_(other.args_),
+        nextPlaceholder_(other.nextPlaceholder_)
     {
         other.logger_ = NULL;
     }
@@ -164,12 +196,16 @@ public:
     ~ Formatter() {
         if (logger_) {
             try {
+                if (args_) {
+                    replacePlaceholders(message_, *args_);
+                }
                 checkExcessPlaceholders(message_, ++nextPlaceholder_);
                 logger_->output(severity_, *message_);
             } catch (...) {
                 // Catch and ignore all exceptions here.
             }
             delete message_;
+            delete args_;
         }
     }
 
@@ -182,6 +218,7 @@ public:
             logger_ = other.logger_;
             severity_ = other.severity_;
             message_ = other.message_;
+            args_ = other.args_;
             nextPlaceholder_ = other.nextPlaceholder_;
             other.logger_ = NULL;
         }
@@ -225,18 +262,16 @@ public:
     /// \param arg The text to place into the placeholder.
     Formatter& arg(const std::string& arg) {
         if (logger_) {
-            // Note that this method does a replacement and returns the
-            // modified string. If there are multiple invocations of arg() (e.g.
-            // logger.info(msgid).arg(xxx).arg(yyy)...), each invocation
-            // operates on the string returned by the previous one. This
-            // sequential operation means that if we had a message like "%1 %2",
-            // and called .arg("%2").arg(42), we would get "42 42"; the first
-            // call replaces the %1" with "%2" and the second replaces all
-            // occurrences of "%2" with 42. (Conversely, the sequence
-            // .arg(42).arg("%1") would return "42 %1" - there are no recursive
-            // replacements).
+            // Note that the argument is only stored here; the placeholders
+            // are all replaced at once when the message is output.  The
+            // replacement is not recursive: if we had a message like
+            // "%1 %2" and called .arg("%2").arg(42), we would get "%2 42".
             try {
-                replacePlaceholder(message_, arg, ++nextPlaceholder_ );
+                checkPlaceholder(message_, arg, ++nextPlaceholder_);
+                if (!args_) {
+                    args_ = new std::vector<std::string>;
+                }
+                args_->push_back(arg);
             }
             catch (...) {
                 // Something went wrong here, the log message is broken, so
@@ -261,6 +296,8 @@ public:
         if (logger_) {
             delete message_;
             message_ = NULL;
+            delete args_;
+            args_ = NULL;
             logger_ = NULL;
         }
     }
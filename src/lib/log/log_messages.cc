@@ -7,9 +7,12 @@
 namespace bundy {
 namespace log {
 
+extern const bundy::log::MessageID LOG_ASYNC_MESSAGES_DROPPED = "LOG_ASYNC_MESSAGES_DROPPED";
 extern const bundy::log::MessageID LOG_BAD_DESTINATION = "LOG_BAD_DESTINATION";
 extern const bundy::log::MessageID LOG_BAD_SEVERITY = "LOG_BAD_SEVERITY";
 extern const bundy::log::MessageID LOG_BAD_STREAM = "LOG_BAD_STREAM";
+extern const bundy::log::MessageID LOG_BINARY_OPEN_FAILED = "LOG_BINARY_OPEN_FAILED";
+extern const bundy::log::MessageID LOG_BINARY_ROTATE_FAILED = "LOG_BINARY_ROTATE_FAILED";
 extern const bundy::log::MessageID LOG_DUPLICATE_MESSAGE_ID = "LOG_DUPLICATE_MESSAGE_ID";
 extern const bundy::log::MessageID LOG_DUPLICATE_NAMESPACE = "LOG_DUPLICATE_NAMESPACE";
 extern const bundy::log::MessageID LOG_INPUT_OPEN_FAIL = "LOG_INPUT_OPEN_FAIL";
@@ -34,26 +37,29 @@ extern const bundy::log::MessageID LOG_WRITE_ERROR = "LOG_WRITE_ERROR";
 namespace {
 
 const char* values[] = {
-    "LOG_BAD_DESTINATION", "unrecognized log destination: %1",
-    "LOG_BAD_SEVERITY", "unrecognized log severity: %1",
-    "LOG_BAD_STREAM", "bad log console output stream: %1",
-    "LOG_DUPLICATE_MESSAGE_ID", "duplicate message ID (%1) in compiled code",
-    "LOG_DUPLICATE_NAMESPACE", "line %1: duplicate $NAMESPACE directive found",
-    "LOG_INPUT_OPEN_FAIL", "unable to open message file %1 for input: %2",
-    "LOG_INVALID_MESSAGE_ID", "line %1: invalid message identification '%2'",
-    "LOG_NAMESPACE_EXTRA_ARGS", "line %1: $NAMESPACE directive has too many arguments",
-    "LOG_NAMESPACE_INVALID_ARG", "line %1: $NAMESPACE directive has an invalid argument ('%2')",
-    "LOG_NAMESPACE_NO_ARGS", "line %1: no arguments were given to the $NAMESPACE directive",
-    "LOG_NO_MESSAGE_ID", "line %1: message definition line found without a message ID",
-    "LOG_NO_MESSAGE_TEXT", "line %1: line found containing a message ID ('%2') and no text",
-    "LOG_NO_SUCH_MESSAGE", "could not replace message text for '%1': no such message",
-    "LOG_OPEN_OUTPUT_FAIL", "unable to open %1 for output: %2",
-    "LOG_PREFIX_EXTRA_ARGS", "line %1: $PREFIX directive has too many arguments",
-    "LOG_PREFIX_INVALID_ARG", "line %1: $PREFIX directive has an invalid argument ('%2')",
-    "LOG_READING_LOCAL_FILE", "reading local message file %1",
-    "LOG_READ_ERROR", "error reading from message file %1: %2",
-    "LOG_UNRECOGNISED_DIRECTIVE", "line %1: unrecognised directive '%2'",
-    "LOG_WRITE_ERROR", "error writing to %1: %2",
+    bundy::log::LOG_ASYNC_MESSAGES_DROPPED, "%1 log messages were dropped as the asynchronous output queue was full",
+    bundy::log::LOG_BAD_DESTINATION, "unrecognized log destination: %1",
+    bundy::log::LOG_BAD_SEVERITY, "unrecognized log severity: %1",
+    bundy::log::LOG_BAD_STREAM, "bad log console output stream: %1",
+    bundy::log::LOG_BINARY_OPEN_FAILED, "unable to open binary log file %1: %2",
+    bundy::log::LOG_BINARY_ROTATE_FAILED, "unable to rotate binary log file %1: %2",
+    bundy::log::LOG_DUPLICATE_MESSAGE_ID, "duplicate message ID (%1) in compiled code",
+    bundy::log::LOG_DUPLICATE_NAMESPACE, "line %1: duplicate $NAMESPACE directive found",
+    bundy::log::LOG_INPUT_OPEN_FAIL, "unable to open message file %1 for input: %2",
+    bundy::log::LOG_INVALID_MESSAGE_ID, "line %1: invalid message identification '%2'",
+    bundy::log::LOG_NAMESPACE_EXTRA_ARGS, "line %1: $NAMESPACE directive has too many arguments",
+    bundy::log::LOG_NAMESPACE_INVALID_ARG, "line %1: $NAMESPACE directive has an invalid argument ('%2')",
+    bundy::log::LOG_NAMESPACE_NO_ARGS, "line %1: no arguments were given to the $NAMESPACE directive",
+    bundy::log::LOG_NO_MESSAGE_ID, "line %1: message definition line found without a message ID",
+    bundy::log::LOG_NO_MESSAGE_TEXT, "line %1: line found containing a message ID ('%2') and no text",
+    bundy::log::LOG_NO_SUCH_MESSAGE, "could not replace message text for '%1': no such message",
+    bundy::log::LOG_OPEN_OUTPUT_FAIL, "unable to open %1 for output: %2",
+    bundy::log::LOG_PREFIX_EXTRA_ARGS, "line %1: $PREFIX directive has too many arguments",
+    bundy::log::LOG_PREFIX_INVALID_ARG, "line %1: $PREFIX directive has an invalid argument ('%2')",
+    bundy::log::LOG_READING_LOCAL_FILE, "reading local message file %1",
+    bundy::log::LOG_READ_ERROR, "error reading from message file %1: %2",
+    bundy::log::LOG_UNRECOGNISED_DIRECTIVE, "line %1: unrecognised directive '%2'",
+    bundy::log::LOG_WRITE_ERROR, "error writing to %1: %2",
     NULL
 };
 
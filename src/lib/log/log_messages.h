@@ -8,9 +8,12 @@
 namespace bundy {
 namespace log {
 
+extern const bundy::log::MessageID LOG_ASYNC_MESSAGES_DROPPED;
 extern const bundy::log::MessageID LOG_BAD_DESTINATION;
 extern const bundy::log::MessageID LOG_BAD_SEVERITY;
 extern const bundy::log::MessageID LOG_BAD_STREAM;
+extern const bundy::log::MessageID LOG_BINARY_OPEN_FAILED;
+extern const bundy::log::MessageID LOG_BINARY_ROTATE_FAILED;
 extern const bundy::log::MessageID LOG_DUPLICATE_MESSAGE_ID;
 extern const bundy::log::MessageID LOG_DUPLICATE_NAMESPACE;
 extern const bundy::log::MessageID LOG_INPUT_OPEN_FAIL;
@@ -20,6 +20,7 @@
 #include <log/logger_name.h>
 #include <log/logger_support.h>
 #include <log/message_dictionary.h>
+#include <log/message_limiter.h>
 #include <log/message_types.h>
 
 #include <util/strutil.h>
@@ -127,7 +128,8 @@ Logger::isFatalEnabled() {
 // definition of the macro).  Also note that it expects that the message buffer
 // "message" is declared in the compilation unit.
 
-// Output methods
+// Output methods.  All but fatal() are subject to the limits set in the
+// MessageLimiter; those are checked before anything is formatted.
 
 void
 Logger::output(const Severity& severity, const std::string& message) {
@@ -136,7 +138,8 @@ Logger::output(const Severity& severity, const std::string& message) {
 
 Logger::Formatter
 Logger::debug(int dbglevel, const bundy::log::MessageID& ident) {
-    if (isDebugEnabled(dbglevel)) {
+    if (isDebugEnabled(dbglevel) &&
+        MessageLimiter::globalLimiter().allow(ident)) {
         return (Formatter(DEBUG, getLoggerPtr()->lookupMessage(ident),
                           this));
     } else {
@@ -146,7 +149,8 @@ Logger::debug(int dbglevel, const bundy::log::MessageID& ident) {
 
 Logger::Formatter
 Logger::info(const bundy::log::MessageID& ident) {
-    if (isInfoEnabled()) {
+    if (isInfoEnabled() &&
+        MessageLimiter::globalLimiter().allow(ident)) {
         return (Formatter(INFO, getLoggerPtr()->lookupMessage(ident),
                           this));
     } else {
@@ -156,7 +160,8 @@ Logger::info(const bundy::log::MessageID& ident) {
 
 Logger::Formatter
 Logger::warn(const bundy::log::MessageID& ident) {
-    if (isWarnEnabled()) {
+    if (isWarnEnabled() &&
+        MessageLimiter::globalLimiter().allow(ident)) {
         return (Formatter(WARN, getLoggerPtr()->lookupMessage(ident),
                           this));
     } else {
@@ -166,7 +171,8 @@ Logger::warn(const bundy::log::MessageID& ident) {
 
 Logger::Formatter
 Logger::error(const bundy::log::MessageID& ident) {
-    if (isErrorEnabled()) {
+    if (isErrorEnabled() &&
+        MessageLimiter::globalLimiter().allow(ident)) {
         return (Formatter(ERROR, getLoggerPtr()->lookupMessage(ident),
                           this));
     } else {
@@ -24,6 +24,7 @@
 #include <log4cplus/configurator.h>
 #include <log4cplus/loggingmacros.h>
 
+#include <log/async_output_impl.h>
 #include <log/logger.h>
 #include <log/logger_impl.h>
 #include <log/logger_level.h>
@@ -124,6 +125,18 @@ LoggerImpl::setInterprocessSync(bundy::log::interprocess::InterprocessSync* sync
 
 void
 LoggerImpl::outputRaw(const Severity& severity, const string& message) {
+    internal::AsyncOutput* async_output = internal::getAsyncOutput();
+    if (async_output != NULL) {
+        if (severity == FATAL) {
+            // A fatal message is usually followed by the exit of the
+            // program, so write it out synchronously, after everything
+            // logged before it.
+            async_output->flush();
+        } else if (async_output->push(logger_, severity, message)) {
+            return;
+        }
+    }
+
     // Use a mutex locker for mutual exclusion from other threads in
     // this process.
     bundy::util::thread::Mutex::Locker mutex_locker(LoggerManager::getMutex());
@@ -136,39 +149,46 @@ LoggerImpl::outputRaw(const Severity& severity, const string& message) {
         LOG4CPLUS_ERROR(logger_, "Unable to lock logger lockfile");
     }
 
+    outputLog4cplus(logger_, severity, message);
+
+    if (!locker.unlock()) {
+        LOG4CPLUS_ERROR(logger_, "Unable to unlock logger lockfile");
+    }
+}
+
+void
+LoggerImpl::outputLog4cplus(log4cplus::Logger& logger,
+                            const Severity& severity, const string& message)
+{
     switch (severity) {
         case DEBUG:
-            LOG4CPLUS_DEBUG(logger_, message);
+            LOG4CPLUS_DEBUG(logger, message);
             break;
 
         case INFO:
-            LOG4CPLUS_INFO(logger_, message);
+            LOG4CPLUS_INFO(logger, message);
             break;
 
         case WARN:
-            LOG4CPLUS_WARN(logger_, message);
+            LOG4CPLUS_WARN(logger, message);
             break;
 
         case ERROR:
-            LOG4CPLUS_ERROR(logger_, message);
+            LOG4CPLUS_ERROR(logger, message);
             break;
 
         case FATAL:
-            LOG4CPLUS_FATAL(logger_, message);
+            LOG4CPLUS_FATAL(logger, message);
             break;
 
         case NONE:
              break;
 
         default:
-            LOG4CPLUS_ERROR(logger_,
+            LOG4CPLUS_ERROR(logger,
                             "Unsupported severity in LoggerImpl::outputRaw(): "
                             << severity);
     }
-
-    if (!locker.unlock()) {
-        LOG4CPLUS_ERROR(logger_, "Unable to unlock logger lockfile");
-    }
 }
 
 } // namespace log
@@ -159,11 +159,26 @@ public:
     /// Writes the message with time into the log. Used by the Formatter
     /// to produce output.
     ///
+    /// If asynchronous output is enabled (see
+    /// \c LoggerManager::enableAsyncOutput()), the message is only queued
+    /// here and written by the background thread.
+    ///
     /// \param severity Severity of the message. (This controls the prefix
     ///        label output with the message text.)
     /// \param message Text of the message.
     void outputRaw(const Severity& severity, const std::string& message);
 
+    /// \brief Hand a message over to log4cplus
+    ///
+    /// Does no locking; it is the caller's responsibility.
+    ///
+    /// \param logger The log4cplus logger to output the message to.
+    /// \param severity Severity of the message.
+    /// \param message Text of the message.
+    static void outputLog4cplus(log4cplus::Logger& logger,
+                                const Severity& severity,
+                                const std::string& message);
+
     /// \brief Look up message text in dictionary
     ///
     /// This gets you the unformatted text of message for given ID.
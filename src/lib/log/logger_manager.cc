@@ -15,6 +15,7 @@
 #include <algorithm>
 #include <vector>
 
+#include <log/async_output_impl.h>
 #include <log/logger.h>
 #include <log/logger_manager.h>
 #include <log/logger_manager_impl.h>
@@ -74,6 +75,11 @@ LoggerManager::~LoggerManager() {
 // Initialize processing
 void
 LoggerManager::processInit() {
+    // Messages logged so far go to the old destinations.
+    internal::AsyncOutput* async_output = internal::getAsyncOutput();
+    if (async_output != NULL) {
+        async_output->flush();
+    }
     impl_->processInit();
 }
 
@@ -203,5 +209,27 @@ LoggerManager::getMutex() {
     return (mutex);
 }
 
+const size_t LoggerManager::DEFAULT_ASYNC_QUEUE_SIZE;
+
+void
+LoggerManager::enableAsyncOutput(size_t queue_size) {
+    internal::enableAsyncOutput(queue_size);
+}
+
+void
+LoggerManager::disableAsyncOutput() {
+    internal::disableAsyncOutput();
+}
+
+AsyncOutputCounters
+LoggerManager::getAsyncOutputCounters() {
+    const internal::AsyncOutput* async_output = internal::getAsyncOutput();
+    if (async_output == NULL) {
+        const AsyncOutputCounters counters = { 0, 0, 0, 0 };
+        return (counters);
+    }
+    return (async_output->getCounters());
+}
+
 } // namespace log
 } // namespace bundy
@@ -21,6 +21,8 @@
 
 #include <boost/noncopyable.hpp>
 
+#include <stdint.h>
+
 // Generated if, when updating the logging specification, an unknown
 // destination is encountered.
 class UnknownLoggingDestination : public bundy::Exception {
@@ -35,6 +37,16 @@ namespace log {
 
 class LoggerManagerImpl;
 
+/// \brief Counters of the asynchronous log output
+///
+/// \see LoggerManager::enableAsyncOutput()
+struct AsyncOutputCounters {
+    uint64_t queued;    ///< Messages placed on the queue
+    uint64_t written;   ///< Messages written by the background thread
+    uint64_t dropped;   ///< Messages dropped because the queue was full
+    uint64_t overflows; ///< Number of times the queue filled up
+};
+
 /// \brief Logger Manager
 ///
 /// The logger manager class exists to process the set of logger specifications
@@ -140,6 +152,38 @@ public:
     /// calls.
     static bundy::util::thread::Mutex& getMutex();
 
+    /// \brief Default size of the asynchronous output queue
+    static const size_t DEFAULT_ASYNC_QUEUE_SIZE = 8192;
+
+    /// \brief Enable asynchronous output
+    ///
+    /// Once enabled, log messages (except FATAL ones) are no longer written
+    /// by the thread logging them.  The message text is put on a bounded
+    /// queue and a background thread lays it out and writes it.  When the
+    /// queue is full, messages are dropped rather than blocking the caller;
+    /// the drops are counted and reported with a warning.  A FATAL message
+    /// first waits for all queued messages to be written and is then written
+    /// synchronously.
+    ///
+    /// Asynchronous output is off by default.  It should be enabled after
+    /// \c init() and before the program starts additional threads.
+    ///
+    /// \param queue_size Maximum number of queued messages (rounded up to a
+    ///        power of two).  Only the first call in a process sets it.
+    static void enableAsyncOutput(size_t queue_size = DEFAULT_ASYNC_QUEUE_SIZE);
+
+    /// \brief Disable asynchronous output
+    ///
+    /// All queued messages are written before the method returns, and
+    /// subsequent messages are written synchronously again.  Does nothing
+    /// if asynchronous output is not enabled.
+    static void disableAsyncOutput();
+
+    /// \brief Return the counters of the asynchronous output
+    ///
+    /// All the counters are zero if asynchronous output was never enabled.
+    static AsyncOutputCounters getAsyncOutputCounters();
+
 private:
     /// \brief Initialize Processing
     ///
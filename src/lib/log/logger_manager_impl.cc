@@ -34,6 +34,8 @@
 #include <log/logger_name.h>
 #include <log/logger_specification.h>
 #include <log/buffer_appender_impl.h>
+#include <log/binary_log.h>
+#include <log/macros.h>
 
 #include <boost/lexical_cast.hpp>
 
@@ -51,15 +53,20 @@ namespace log {
 void
 LoggerManagerImpl::processInit() {
     storeBufferAppenders();
+    binary_configured_ = false;
 
     log4cplus::Logger::getDefaultHierarchy().resetConfiguration();
     initRootLogger();
 }
 
-// Flush the BufferAppenders at the end of processing a new specification
+// Flush the BufferAppenders at the end of processing a new specification,
+// and close the binary log if it's no longer configured.
 void
 LoggerManagerImpl::processEnd() {
     flushBufferAppenders();
+    if (!binary_configured_) {
+        BinaryLog::global().close();
+    }
 }
 
 // Process logging specification.  Set up the common states then dispatch to
@@ -97,6 +104,11 @@ LoggerManagerImpl::processSpecification(const LoggerSpecification& spec) {
                 createSyslogAppender(logger, *i);
                 break;
 
+            case OutputOption::DEST_BINARY:
+                openBinaryLog(*i);
+                binary_configured_ = true;
+                break;
+
             default:
                 // Not a valid destination.  As we are in the middle of updating
                 // logging destinations, we could be in the situation where
@@ -179,6 +191,18 @@ LoggerManagerImpl::createSyslogAppender(log4cplus::Logger& logger,
     logger.addAppender(syslogapp);
 }
 
+// Binary log.  There is a single one for the process; opening it again with
+// the same parameters keeps it as it is.
+void
+LoggerManagerImpl::openBinaryLog(const OutputOption& opt) {
+    try {
+        BinaryLog::global().open(opt.filename, opt.maxsize, opt.maxver);
+    } catch (const BinaryLogError& ex) {
+        Logger logger("log");
+        LOG_ERROR(logger, LOG_BINARY_OPEN_FAILED).arg(opt.filename).
+            arg(ex.what());
+    }
+}
 
 // One-time initialization of the log4cplus system
 void
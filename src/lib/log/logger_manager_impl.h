@@ -51,7 +51,7 @@ class LoggerManagerImpl {
 public:
 
     /// \brief Constructor
-    LoggerManagerImpl() {}
+    LoggerManagerImpl() : binary_configured_(false) {}
 
     /// \brief Initialize Processing
     ///
@@ -65,11 +65,12 @@ public:
     /// Processes the specification for a single logger.
     ///
     /// \param spec Logging specification for this logger
-    static void processSpecification(const LoggerSpecification& spec);
+    void processSpecification(const LoggerSpecification& spec);
 
     /// \brief End Processing
     ///
-    /// Terminates the processing of the logging specifications.
+    /// Terminates the processing of the logging specifications.  The
+    /// binary log is closed if none of the specifications used it.
     void processEnd();
 
     /// \brief Implementation-specific initialization
@@ -133,6 +134,17 @@ private:
     static void createSyslogAppender(log4cplus::Logger& logger,
                                      const OutputOption& opt);
 
+    /// \brief Open the binary log
+    ///
+    /// Opens the process-wide \c BinaryLog with the file and rotation
+    /// parameters of the output option.  No appender is attached to the
+    /// logger: the binary log receives records written directly to it, not
+    /// log messages.  A failure is logged rather than thrown, so that the
+    /// rest of the configuration still takes effect.
+    ///
+    /// \param opt Output options for the binary log.
+    static void openBinaryLog(const OutputOption& opt);
+
     /// \brief Create buffered appender
     ///
     /// Appends an object to the logger that will store the log events sent
@@ -193,6 +205,10 @@ private:
     /// store the buffer appenders in order to flush them after
     /// processSpecification() calls have been completed
     std::vector<log4cplus::SharedAppenderPtr> buffer_appender_store_;
+
+    /// Set by processSpecification() if a specification (re)opened the
+    /// binary log since the last processInit()
+    bool binary_configured_;
 };
 
 } // namespace log
@@ -16,11 +16,38 @@
 #include <log/message_dictionary.h>
 #include <log/message_types.h>
 
+#include <stdint.h>
+
 using namespace std;
 
+namespace {
+
+// Initial number of entries of the index.  It must be a power of two.
+const size_t INITIAL_INDEX_SIZE = 256;
+
+// Position of an ID in an index of the given size (a power of two).  The
+// IDs are strings, so the low bits of their addresses vary little; the
+// multiplication spreads them over the table.
+size_t
+indexPosition(bundy::log::MessageID ident, size_t size) {
+    const uint64_t address = reinterpret_cast<uintptr_t>(ident);
+    return (static_cast<size_t>((address * 0x9e3779b97f4a7c15ULL) >> 32) &
+            (size - 1));
+}
+
+}
+
 namespace bundy {
 namespace log {
 
+// Constructor
+
+MessageDictionary::MessageDictionary() :
+    index_(INITIAL_INDEX_SIZE, IndexEntry(NULL, Dictionary::const_iterator())),
+    indexed_(0)
+{
+}
+
 // (Virtual) Destructor
 
 MessageDictionary::~MessageDictionary() {
@@ -77,11 +104,73 @@ MessageDictionary::load(const char* messages[]) {
             if (!added) {
                 duplicates.push_back(boost::lexical_cast<string>(ident));
             }
+
+            // The arrays loaded hold the IDs used by the code, so index the
+            // message by their address.  (If the ID was already present,
+            // the address may be the one used by the code instead of the
+            // first one.)
+            indexMessage(ident, dictionary_.find(ident));
         }
     }
     return (duplicates);
 }
 
+// Note the address of an ID in the index, growing it when half full so that
+// the probe sequences stay short.
+
+void
+MessageDictionary::indexMessage(const MessageID& ident,
+                                Dictionary::const_iterator entry)
+{
+    if (2 * (indexed_ + 1) > index_.size()) {
+        vector<IndexEntry> old_index(2 * index_.size(),
+                                     IndexEntry(NULL,
+                                                Dictionary::const_iterator()));
+        old_index.swap(index_);
+        indexed_ = 0;
+        for (vector<IndexEntry>::const_iterator i = old_index.begin();
+             i != old_index.end(); ++i) {
+            if (i->first) {
+                indexMessage(i->first, i->second);
+            }
+        }
+    }
+
+    const size_t mask = index_.size() - 1;
+    for (size_t pos = indexPosition(ident, index_.size()); ;
+         pos = (pos + 1) & mask) {
+        if (index_[pos].first == ident) {
+            index_[pos].second = entry;
+            return;
+        } else if (!index_[pos].first) {
+            index_[pos] = IndexEntry(ident, entry);
+            ++indexed_;
+            return;
+        }
+    }
+}
+
+// Return message text or blank string.  The IDs loaded with load() are found
+// by their address in the index; others (for instance IDs built from
+// strings) are looked up by name.  An entry of the index is used only if the
+// name matches, as the address may have been reused once the ID is gone
+// (e.g. a hooks library was unloaded).
+
+const string&
+MessageDictionary::getText(const MessageID& ident) const {
+    const size_t mask = index_.size() - 1;
+    for (size_t pos = indexPosition(ident, index_.size());
+         index_[pos].first; pos = (pos + 1) & mask) {
+        if (index_[pos].first == ident) {
+            if (index_[pos].second->first == ident) {
+                return (index_[pos].second->second);
+            }
+            break;
+        }
+    }
+    return (getText(boost::lexical_cast<string>(ident)));
+}
+
 // Return message text or blank string.  A reference is returned to a string
 // in the dictionary - this is fine, as the string is immediately used for
 // output.
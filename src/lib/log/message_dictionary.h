@@ -21,6 +21,7 @@
 #include <vector>
 
 #include <boost/lexical_cast.hpp>
+#include <boost/noncopyable.hpp>
 
 #include <log/message_types.h>
 
@@ -44,14 +45,22 @@ namespace log {
 ///
 /// Although the class can be used stand-alone, it does supply a static method
 /// to return a particular instance - the "global" dictionary.
-
-class MessageDictionary {
+///
+/// The message IDs used in the code are the symbols defined by the message
+/// compiler, whose values are the addresses of the strings in the arrays
+/// loaded with "Load".  The messages loaded that way are also indexed by
+/// the address of their ID, so that looking up the text of a message only
+/// takes hashing that address, rather than a search of the map comparing
+/// strings.  The other IDs are looked up in the map.
+
+class MessageDictionary : boost::noncopyable {
 public:
 
     typedef std::map<std::string, std::string> Dictionary;
     typedef Dictionary::const_iterator  const_iterator;
 
-    // Default constructor and assignment operator are OK for this class
+    /// \brief Constructor
+    MessageDictionary();
 
     /// \brief Virtual Destructor
     virtual ~MessageDictionary();
@@ -136,9 +145,7 @@ public:
     /// \return Text associated with message or empty string if the ID is not
     /// recognised.  (Note: this precludes an ID being associated with an empty
     /// string.)
-    virtual const std::string& getText(const MessageID& ident) const {
-        return(getText(boost::lexical_cast<std::string>(ident)));
-    }
+    virtual const std::string& getText(const MessageID& ident) const;
 
 
     /// \brief Get Message Text
@@ -181,7 +188,23 @@ public:
     static MessageDictionary& globalDictionary();
 
 private:
+    /// \brief Index the message of an ID
+    ///
+    /// Notes the entry of the dictionary for the address of the ID, which
+    /// must stay valid as long as the dictionary is used (as do the IDs in
+    /// the arrays loaded with "Load").
+    ///
+    /// \param ident Message identification
+    /// \param entry Entry of the dictionary for the ID
+    void indexMessage(const MessageID& ident, Dictionary::const_iterator entry);
+
+    /// Entry of the index: the address of an ID, and the entry of the
+    /// dictionary for it.  The address is NULL in the free entries.
+    typedef std::pair<MessageID, Dictionary::const_iterator> IndexEntry;
+
     Dictionary       dictionary_;   ///< Holds the ID to text lookups
+    std::vector<IndexEntry> index_; ///< Open addressing table, by ID address
+    size_t           indexed_;      ///< Number of used entries in index_
 };
 
 } // namespace log
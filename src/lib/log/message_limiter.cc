@@ -0,0 +1,131 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <log/message_limiter.h>
+
+#include <algorithm>
+
+#include <string.h>
+
+using namespace std;
+using bundy::util::thread::Mutex;
+
+namespace bundy {
+namespace log {
+
+namespace {
+
+struct IdentLess {
+    template <typename Entry>
+    bool operator()(const Entry& entry, const char* ident) const {
+        return (strcmp(entry.first.c_str(), ident) < 0);
+    }
+};
+
+// Find the entry of a message in the sorted limits, or return end.
+template <typename Iterator>
+Iterator
+findIdent(Iterator begin, Iterator end, const char* ident) {
+    const Iterator it = lower_bound(begin, end, ident, IdentLess());
+    if (it != end && strcmp(it->first.c_str(), ident) == 0) {
+        return (it);
+    }
+    return (end);
+}
+
+} // unnamed namespace
+
+MessageLimiter::MessageLimiter() : active_(false) {
+}
+
+void
+MessageLimiter::setLimit(const string& ident, unsigned int sample,
+                         unsigned int per_second)
+{
+    const Limit limit = { sample, per_second, 0, 0, 0, 0 };
+    Mutex::Locker locker(mutex_);
+    const Limits::iterator it =
+        lower_bound(limits_.begin(), limits_.end(), ident.c_str(),
+                    IdentLess());
+    if (it != limits_.end() && it->first == ident) {
+        it->second = limit;
+    } else {
+        limits_.insert(it, make_pair(ident, limit));
+    }
+    active_.store(true, std::memory_order_relaxed);
+}
+
+void
+MessageLimiter::clearLimit(const string& ident) {
+    Mutex::Locker locker(mutex_);
+    const Limits::iterator it =
+        findIdent(limits_.begin(), limits_.end(), ident.c_str());
+    if (it != limits_.end()) {
+        limits_.erase(it);
+    }
+    active_.store(!limits_.empty(), std::memory_order_relaxed);
+}
+
+void
+MessageLimiter::clearLimits() {
+    Mutex::Locker locker(mutex_);
+    limits_.clear();
+    active_.store(false, std::memory_order_relaxed);
+}
+
+bool
+MessageLimiter::allow(const MessageID& ident, time_t now) {
+    Mutex::Locker locker(mutex_);
+
+    const Limits::iterator it = findIdent(limits_.begin(), limits_.end(),
+                                          ident);
+    if (it == limits_.end()) {
+        return (true);
+    }
+    Limit* limit = &it->second;
+
+    if (limit->sample > 1 && (limit->seen++ % limit->sample) != 0) {
+        ++limit->suppressed;
+        return (false);
+    }
+    if (limit->per_second != 0) {
+        if (limit->second != now) {
+            limit->second = now;
+            limit->in_second = 0;
+        }
+        if (limit->in_second >= limit->per_second) {
+            ++limit->suppressed;
+            return (false);
+        }
+        ++limit->in_second;
+    }
+    return (true);
+}
+
+uint64_t
+MessageLimiter::getSuppressed(const string& ident) const {
+    Mutex::Locker locker(mutex_);
+    const Limits::const_iterator it =
+        findIdent(limits_.begin(), limits_.end(), ident.c_str());
+    return (it == limits_.end() ? 0 : it->second.suppressed);
+}
+
+MessageLimiter&
+MessageLimiter::globalLimiter() {
+    static MessageLimiter global;
+    return (global);
+}
+
+} // namespace log
+} // namespace bundy
@@ -0,0 +1,133 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef MESSAGE_LIMITER_H
+#define MESSAGE_LIMITER_H
+
+#include <log/message_types.h>
+#include <util/threads/sync.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <stdint.h>
+#include <time.h>
+
+namespace bundy {
+namespace log {
+
+/// \brief Per-message output limits
+///
+/// Some messages, typically debug messages logged for every packet, can be
+/// logged so often that formatting and writing them costs more than the
+/// work they describe.  The limiter allows such messages to be sampled
+/// (only one in N is output) or rate limited (at most M per second are
+/// output), based on their message ID.
+///
+/// The check is done by the Logger before the message text is looked up or
+/// any argument is formatted, so a suppressed message costs little more than
+/// a disabled one.  FATAL messages are never suppressed.  When no limit is
+/// set, the check is a single atomic load.
+///
+/// As with the MessageDictionary, a global instance is supplied by
+/// \c globalLimiter(); it is the one consulted by the loggers.
+class MessageLimiter : public boost::noncopyable {
+public:
+    /// \brief Constructor
+    MessageLimiter();
+
+    /// \brief Set the limit of a message
+    ///
+    /// Replaces any limit already set for the message, and resets its
+    /// counters.
+    ///
+    /// \param ident Identification of the message.
+    /// \param sample If larger than 1, only the first of every \c sample
+    ///        messages is output.
+    /// \param per_second If not 0, at most this many messages are output in
+    ///        each second (after sampling).
+    void setLimit(const std::string& ident, unsigned int sample,
+                  unsigned int per_second);
+
+    /// \brief Remove the limit of a message
+    ///
+    /// \param ident Identification of the message.  Nothing happens if it
+    ///        has no limit.
+    void clearLimit(const std::string& ident);
+
+    /// \brief Remove all limits
+    void clearLimits();
+
+    /// \brief Should the message be output?
+    ///
+    /// \param ident Identification of the message.
+    ///
+    /// \return false if the message is suppressed by its limit.
+    bool allow(const MessageID& ident) {
+        if (!active_.load(std::memory_order_relaxed)) {
+            return (true);
+        }
+        return (allow(ident, time(NULL)));
+    }
+
+    /// \brief Should the message be output at the given time?
+    ///
+    /// This is the implementation of \c allow(ident), with the current time
+    /// passed explicitly (mostly for testing).
+    ///
+    /// \param ident Identification of the message.
+    /// \param now The current time, in seconds.
+    bool allow(const MessageID& ident, time_t now);
+
+    /// \brief Return the number of suppressed messages
+    ///
+    /// \param ident Identification of the message.
+    ///
+    /// \return Number of messages suppressed since the limit was set.  0 if
+    ///         the message has no limit.
+    uint64_t getSuppressed(const std::string& ident) const;
+
+    /// \brief Return the global limiter
+    static MessageLimiter& globalLimiter();
+
+private:
+    /// \brief Limit and state of one message
+    struct Limit {
+        unsigned int sample;
+        unsigned int per_second;
+        uint64_t seen;           // Messages checked so far
+        time_t second;           // The second being counted
+        unsigned int in_second;  // Messages output in that second
+        uint64_t suppressed;
+    };
+
+    // The limits, sorted by message ID.  A sorted vector allows the lookup
+    // with the ID as given, without constructing a std::string from it (the
+    // ID may be a temporary, e.g. from Python, so its address can't be used
+    // as a key).
+    typedef std::vector<std::pair<std::string, Limit> > Limits;
+
+    mutable bundy::util::thread::Mutex mutex_;
+    Limits limits_;
+    std::atomic<bool> active_;
+};
+
+} // namespace log
+} // namespace bundy
+
+#endif // MESSAGE_LIMITER_H
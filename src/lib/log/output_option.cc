@@ -31,6 +31,8 @@ getDestination(const std::string& dest_str) {
         return OutputOption::DEST_FILE;
     } else if (boost::iequals(dest_str, "syslog")) {
         return OutputOption::DEST_SYSLOG;
+    } else if (boost::iequals(dest_str, "binary")) {
+        return OutputOption::DEST_BINARY;
     } else {
         Logger logger("log");
         LOG_ERROR(logger, LOG_BAD_DESTINATION).arg(dest_str);
@@ -26,10 +26,10 @@
 /// one or more of these are attached to a LoggerSpecification object which is
 /// then passed to the LoggerManager to configure the logger.
 ///
-/// Although there are three distinct output types (console, file, syslog) and
-/// the options for each do not really overlap.  Although it is tempting to
-/// define a base OutputOption class and derive a class for each type
-/// (ConsoleOutputOptions etc.), it would be messy to use in practice.  At
+/// Although there are four distinct output types (console, file, syslog,
+/// binary) and the options for each do not really overlap.  Although it is
+/// tempting to define a base OutputOption class and derive a class for each
+/// type (ConsoleOutputOptions etc.), it would be messy to use in practice.  At
 /// some point the exact class would have to be known to get the class-specific
 /// options and the (pointer to) the base class cast to the appropriate type.
 /// Instead, this "struct" contains the union of all output options; it is up
@@ -49,7 +49,8 @@ struct OutputOption {
     typedef enum {
         DEST_CONSOLE = 0,
         DEST_FILE = 1,
-        DEST_SYSLOG = 2
+        DEST_SYSLOG = 2,
+        DEST_BINARY = 3         ///< Binary records, see BinaryLog
     } Destination;
 
     /// If console, stream on which messages are output
@@ -70,7 +71,7 @@ struct OutputOption {
     Stream          stream;             ///< stdout/stderr if console output
     bool            flush;              ///< true to flush after each message
     std::string     facility;           ///< syslog facility
-    std::string     filename;           ///< Filename if file output
+    std::string     filename;           ///< Filename if file/binary output
     size_t          maxsize;            ///< 0 if no maximum size
     unsigned int    maxver;             ///< Maximum versions (none if <= 0)
 };
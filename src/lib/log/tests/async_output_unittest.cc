@@ -0,0 +1,204 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <log/async_output_impl.h>
+#include <log/log_messages.h>
+#include <log/logger.h>
+#include <log/logger_manager.h>
+#include <log/logger_name.h>
+#include <log/interprocess/interprocess_sync_null.h>
+
+#include <log4cplus/logger.h>
+#include <log4cplus/spi/loggingevent.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace bundy::log;
+using namespace bundy::log::internal;
+using bundy::log::interprocess::InterprocessSyncNull;
+using bundy::util::thread::Mutex;
+using bundy::util::thread::Thread;
+
+namespace {
+
+// Appender keeping the text of each message it gets.
+class RecordingAppender : public log4cplus::Appender {
+public:
+    virtual ~RecordingAppender() {
+        destructorImpl();
+    }
+    virtual void close() {}
+
+    std::vector<std::string> messages_;
+protected:
+    virtual void append(const log4cplus::spi::InternalLoggingEvent& event) {
+        messages_.push_back(event.getMessage());
+    }
+};
+
+class AsyncOutputTest : public ::testing::Test {
+protected:
+    AsyncOutputTest() :
+        recorder_(new RecordingAppender),
+        appender_(recorder_),
+        root_recorder_(new RecordingAppender),
+        root_appender_(root_recorder_),
+        logger_(log4cplus::Logger::getInstance("asynctest")),
+        root_logger_(log4cplus::Logger::getInstance(getRootLoggerName()))
+    {
+        logger_.setLogLevel(log4cplus::TRACE_LOG_LEVEL);
+        logger_.setAdditivity(false);
+        logger_.addAppender(appender_);
+        root_logger_.addAppender(root_appender_);
+    }
+
+    ~AsyncOutputTest() {
+        logger_.removeAppender(appender_);
+        root_logger_.removeAppender(root_appender_);
+    }
+
+    RecordingAppender* recorder_;
+    log4cplus::SharedAppenderPtr appender_;
+    RecordingAppender* root_recorder_;
+    log4cplus::SharedAppenderPtr root_appender_;
+    log4cplus::Logger logger_;
+    log4cplus::Logger root_logger_;
+};
+
+TEST_F(AsyncOutputTest, capacity) {
+    EXPECT_EQ(2, AsyncOutput(0, new InterprocessSyncNull("test")).
+              getCapacity());
+    EXPECT_EQ(2, AsyncOutput(2, new InterprocessSyncNull("test")).
+              getCapacity());
+    EXPECT_EQ(128, AsyncOutput(100, new InterprocessSyncNull("test")).
+              getCapacity());
+    EXPECT_THROW(AsyncOutput(100, NULL), BadInterprocessSync);
+}
+
+// Messages are written in order by the background thread, and only while
+// it is running.
+TEST_F(AsyncOutputTest, write) {
+    AsyncOutput output(4, new InterprocessSyncNull("test"));
+    EXPECT_FALSE(output.isRunning());
+    EXPECT_FALSE(output.push(logger_, INFO, "not running"));
+
+    output.start();
+    EXPECT_TRUE(output.isRunning());
+    for (int i = 0; i < 100; ++i) {
+        // The queue is small; wait for room so nothing is dropped.
+        if (i % 4 == 0) {
+            output.flush();
+        }
+        const std::string message("message " +
+                                  boost::lexical_cast<std::string>(i));
+        EXPECT_TRUE(output.push(logger_, INFO, message));
+    }
+    output.flush();
+
+    ASSERT_EQ(100, recorder_->messages_.size());
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ("message " + boost::lexical_cast<std::string>(i),
+                  recorder_->messages_[i]);
+    }
+    const AsyncOutputCounters counters = output.getCounters();
+    EXPECT_EQ(100, counters.queued);
+    EXPECT_EQ(100, counters.written);
+    EXPECT_EQ(0, counters.dropped);
+    EXPECT_EQ(0, counters.overflows);
+
+    output.stop();
+    EXPECT_FALSE(output.isRunning());
+    EXPECT_FALSE(output.push(logger_, INFO, "stopped"));
+    EXPECT_EQ(100, recorder_->messages_.size());
+}
+
+void
+pushMessages(AsyncOutput* output, log4cplus::Logger logger, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        output->push(logger, DEBUG, "message");
+    }
+}
+
+// Several threads can queue messages at the same time.
+TEST_F(AsyncOutputTest, concurrentPush) {
+    const size_t NUM_THREADS = 4;
+    const size_t NUM_MESSAGES = 1000;
+    AsyncOutput output(NUM_THREADS * NUM_MESSAGES,
+                       new InterprocessSyncNull("test"));
+    output.start();
+
+    boost::ptr_vector<Thread> threads;
+    for (size_t i = 0; i < NUM_THREADS; ++i) {
+        threads.push_back(new Thread(boost::bind(&pushMessages, &output,
+                                                 logger_, NUM_MESSAGES)));
+    }
+    for (size_t i = 0; i < NUM_THREADS; ++i) {
+        threads[i].wait();
+    }
+    output.flush();
+
+    EXPECT_EQ(NUM_THREADS * NUM_MESSAGES, recorder_->messages_.size());
+    EXPECT_EQ(NUM_THREADS * NUM_MESSAGES, output.getCounters().written);
+    EXPECT_EQ(0, output.getCounters().dropped);
+}
+
+// A full queue drops messages instead of blocking, and the drops get
+// reported once the background thread catches up.
+TEST_F(AsyncOutputTest, overflow) {
+    AsyncOutput output(2, new InterprocessSyncNull("test"));
+    output.start();
+
+    {
+        // The background thread can't write while we hold this.
+        Mutex::Locker locker(LoggerManager::getMutex());
+        for (int i = 0; i < 10; ++i) {
+            EXPECT_TRUE(output.push(logger_, INFO, "message"));
+        }
+        const AsyncOutputCounters counters = output.getCounters();
+        // The background thread may have taken up to two messages off the
+        // queue before blocking.
+        EXPECT_LE(2, counters.queued);
+        EXPECT_GE(4, counters.queued);
+        EXPECT_EQ(10, counters.queued + counters.dropped);
+        EXPECT_EQ(1, counters.overflows);
+    }
+
+    // Stopping writes out everything, including the report.
+    output.stop();
+    const AsyncOutputCounters counters = output.getCounters();
+    EXPECT_EQ(counters.queued, counters.written);
+    EXPECT_EQ(counters.queued, recorder_->messages_.size());
+    ASSERT_EQ(1, root_recorder_->messages_.size());
+    EXPECT_EQ(0, root_recorder_->messages_[0].find(
+                  LOG_ASYNC_MESSAGES_DROPPED));
+    EXPECT_NE(std::string::npos, root_recorder_->messages_[0].find(
+                  boost::lexical_cast<std::string>(counters.dropped)));
+
+    // The queue accepts messages again after a restart, and a new overflow
+    // is counted separately.
+    output.start();
+    EXPECT_TRUE(output.push(logger_, INFO, "message"));
+    output.flush();
+    EXPECT_EQ(counters.queued + 1, output.getCounters().written);
+    EXPECT_EQ(1, output.getCounters().overflows);
+}
+
+}
@@ -0,0 +1,254 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <log/binary_log.h>
+#include <util/threads/thread.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace bundy::log;
+using bundy::util::thread::Thread;
+using boost::lexical_cast;
+
+namespace {
+
+const char* const TEST_FILE = "binary_log_test.blg";
+const unsigned int TEST_MAXVER = 3;
+
+class BinaryLogTest : public ::testing::Test {
+protected:
+    BinaryLogTest() {
+        removeFiles();
+    }
+    ~BinaryLogTest() {
+        log_.close();
+        removeFiles();
+    }
+
+    void removeFiles() {
+        unlink(TEST_FILE);
+        for (unsigned int i = 1; i <= TEST_MAXVER + 1; ++i) {
+            unlink((std::string(TEST_FILE) + "." +
+                    lexical_cast<std::string>(i)).c_str());
+        }
+    }
+
+    // A record identified by its qtype and port
+    static BinaryLogRecord makeRecord(uint16_t qtype, uint16_t port) {
+        BinaryLogRecord record;
+        std::memset(&record, 0, sizeof(record));
+        record.latency = 42;
+        record.timestamp = 1400000000000000ULL;
+        record.qtype = qtype;
+        record.port = port;
+        record.rcode = 3;
+        record.family = 4;
+        record.address[0] = 192;
+        record.address[1] = 0;
+        record.address[2] = 2;
+        record.address[3] = 1;
+        const uint8_t qname[] = { 3, 'w', 'w', 'w', 7, 'e', 'x', 'a', 'm',
+                                  'p', 'l', 'e', 0 };
+        std::memcpy(record.qname, qname, sizeof(qname));
+        record.qname_length = sizeof(qname);
+        return (record);
+    }
+
+    // Return the number of committed records in the given file (0 if it
+    // doesn't exist), checking they are all well-formed.
+    static size_t countRecords(const std::string& filename) {
+        if (access(filename.c_str(), F_OK) != 0) {
+            return (0);
+        }
+        BinaryLogReader reader(filename);
+        BinaryLogRecord record;
+        size_t count = 0;
+        while (reader.next(record)) {
+            EXPECT_EQ(42, record.latency);
+            EXPECT_EQ(13, record.qname_length);
+            ++count;
+        }
+        return (count);
+    }
+
+    static std::string version(unsigned int i) {
+        return (std::string(TEST_FILE) + "." + lexical_cast<std::string>(i));
+    }
+
+    void writeRecords(uint16_t qtype, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            log_.write(makeRecord(qtype, i));
+        }
+    }
+
+    BinaryLog log_;
+};
+
+TEST_F(BinaryLogTest, closed) {
+    EXPECT_FALSE(log_.isOpen());
+    EXPECT_TRUE(log_.getFilename().empty());
+    EXPECT_FALSE(log_.write(makeRecord(1, 53)));
+    EXPECT_EQ(0, log_.getWritten());
+    EXPECT_EQ(1, log_.getDropped());
+
+    // Closing a closed log is harmless.
+    log_.close();
+}
+
+TEST_F(BinaryLogTest, writeAndRead) {
+    log_.open(TEST_FILE, 0, 0);
+    EXPECT_TRUE(log_.isOpen());
+    EXPECT_EQ(TEST_FILE, log_.getFilename());
+    EXPECT_TRUE(log_.write(makeRecord(1, 53)));
+    EXPECT_TRUE(log_.write(makeRecord(28, 5353)));
+    log_.close();
+    EXPECT_FALSE(log_.isOpen());
+    EXPECT_EQ(2, log_.getWritten());
+
+    // The file is truncated to the header and the two records.
+    std::ifstream ifs(TEST_FILE, std::ios::binary | std::ios::ate);
+    EXPECT_EQ(3 * BINARY_RECORD_SIZE, ifs.tellg());
+
+    BinaryLogReader reader(TEST_FILE);
+    BinaryLogRecord record;
+    const BinaryLogRecord expected = makeRecord(1, 53);
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(0, std::memcmp(&record.latency, &expected.latency,
+                             BINARY_RECORD_SIZE - sizeof(record.committed)));
+    EXPECT_NE(0, record.committed);
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(28, record.qtype);
+    EXPECT_EQ(5353, record.port);
+    EXPECT_FALSE(reader.next(record));
+}
+
+TEST_F(BinaryLogTest, append) {
+    log_.open(TEST_FILE, 0, 0);
+    writeRecords(1, 2);
+    log_.close();
+    log_.open(TEST_FILE, 0, 0);
+    writeRecords(2, 1);
+    log_.close();
+    EXPECT_EQ(3, countRecords(TEST_FILE));
+}
+
+TEST_F(BinaryLogTest, reopen) {
+    // Reopening with the same parameters keeps the log as it is; changing
+    // them reopens it.
+    log_.open(TEST_FILE, 0, 0);
+    writeRecords(1, 2);
+    log_.open(TEST_FILE, 0, 0);
+    writeRecords(1, 2);
+    log_.open(TEST_FILE, 100 * BINARY_RECORD_SIZE, 0);
+    writeRecords(1, 2);
+    log_.close();
+    EXPECT_EQ(6, countRecords(TEST_FILE));
+}
+
+TEST_F(BinaryLogTest, rotate) {
+    // Room for the header and 4 records per file.
+    log_.open(TEST_FILE, 5 * BINARY_RECORD_SIZE, 2);
+    writeRecords(1, 14);
+    log_.close();
+    EXPECT_EQ(14, log_.getWritten());
+    EXPECT_EQ(0, log_.getDropped());
+
+    // The first 4 records were discarded with the oldest version.
+    EXPECT_EQ(2, countRecords(TEST_FILE));
+    EXPECT_EQ(4, countRecords(version(1)));
+    EXPECT_EQ(4, countRecords(version(2)));
+    EXPECT_EQ(0, countRecords(version(3)));
+}
+
+TEST_F(BinaryLogTest, rotateNoVersions) {
+    log_.open(TEST_FILE, 5 * BINARY_RECORD_SIZE, 0);
+    writeRecords(1, 6);
+    log_.close();
+    EXPECT_EQ(2, countRecords(TEST_FILE));
+    EXPECT_EQ(0, countRecords(version(1)));
+}
+
+TEST_F(BinaryLogTest, rotateFullFileOnOpen) {
+    log_.open(TEST_FILE, 5 * BINARY_RECORD_SIZE, 1);
+    writeRecords(1, 4);
+    log_.close();
+    log_.open(TEST_FILE, 5 * BINARY_RECORD_SIZE, 1);
+    writeRecords(1, 1);
+    log_.close();
+    EXPECT_EQ(1, countRecords(TEST_FILE));
+    EXPECT_EQ(4, countRecords(version(1)));
+}
+
+TEST_F(BinaryLogTest, notBinaryLog) {
+    {
+        std::ofstream ofs(TEST_FILE);
+        ofs << "this is a text log file that must not be overwritten\n";
+    }
+    EXPECT_THROW(log_.open(TEST_FILE, 0, 0), BinaryLogError);
+    EXPECT_FALSE(log_.isOpen());
+    EXPECT_THROW(BinaryLogReader reader(TEST_FILE), BinaryLogError);
+    EXPECT_THROW(BinaryLogReader reader("no_such_binary_log.blg"),
+                 BinaryLogError);
+}
+
+void
+writeThread(BinaryLog* log, uint16_t qtype, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        BinaryLogRecord record;
+        std::memset(&record, 0, sizeof(record));
+        record.latency = 42;
+        record.qtype = qtype;
+        record.port = i;
+        record.qname_length = 13;
+        log->write(record);
+    }
+}
+
+// Concurrent writers, rotating the file a few times on the way.  Every
+// record is either written or dropped, and all written ones can be read.
+TEST_F(BinaryLogTest, concurrentWrite) {
+    const size_t THREADS = 4;
+    const size_t RECORDS = 1000;
+    log_.open(TEST_FILE, 1200 * BINARY_RECORD_SIZE, TEST_MAXVER);
+
+    boost::ptr_vector<Thread> threads;
+    for (size_t i = 0; i < THREADS; ++i) {
+        threads.push_back(new Thread(boost::bind(writeThread, &log_, i + 1,
+                                                 RECORDS)));
+    }
+    for (size_t i = 0; i < THREADS; ++i) {
+        threads[i].wait();
+    }
+    log_.close();
+
+    EXPECT_EQ(THREADS * RECORDS, log_.getWritten() + log_.getDropped());
+    size_t total = countRecords(TEST_FILE);
+    for (unsigned int i = 1; i <= TEST_MAXVER; ++i) {
+        total += countRecords(version(i));
+    }
+    EXPECT_EQ(log_.getWritten(), total);
+}
+
+}
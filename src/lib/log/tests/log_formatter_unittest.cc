@@ -184,4 +184,19 @@ TEST_F(FormatterTest, noRecurse) {
     EXPECT_EQ("%1 %1", outputs[0].second);
 }
 
+// Placeholders in an argument are not replaced by later arguments either
+TEST_F(FormatterTest, noSequentialReplacement) {
+    Formatter(bundy::log::INFO, s("%1 %2"), this).arg("%2").arg(42);
+    ASSERT_EQ(1, outputs.size());
+    EXPECT_EQ("%2 42", outputs[0].second);
+}
+
+// Percent signs that are not placeholders of an argument are kept
+TEST_F(FormatterTest, otherPercentSigns) {
+    Formatter(bundy::log::INFO, s("100% of %1, %x, %12 and %"), this).
+        arg("it");
+    ASSERT_EQ(1, outputs.size());
+    EXPECT_EQ("100% of it, %x, %12 and %", outputs[0].second);
+}
+
 }
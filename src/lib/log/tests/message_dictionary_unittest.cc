@@ -13,6 +13,7 @@
 // PERFORMANCE OF THIS SOFTWARE.
 
 #include <cstddef>
+#include <cstring>
 #include <string>
 #include <gtest/gtest.h>
 #include <log/message_dictionary.h>
@@ -177,6 +178,68 @@ TEST_F(MessageDictionaryTest, Lookups) {
     EXPECT_EQ(string(""), dictionary.getText("\n\n\n"));
 }
 
+// Check that the messages loaded are found by the address of their ID, and
+// that other IDs with the same name are still found.
+
+TEST_F(MessageDictionaryTest, IndexedLookups) {
+    static const char* data[] = {
+        "ALPHA", "This is alpha",
+        "BETA", "This is beta",
+        NULL
+    };
+
+    MessageDictionary dictionary;
+    dictionary.load(data);
+    EXPECT_EQ(string("This is alpha"), dictionary.getText(data[0]));
+    EXPECT_EQ(string("This is beta"), dictionary.getText(data[2]));
+
+    // A copy of the ID is at another address.
+    char alpha[] = "ALPHA";
+    EXPECT_EQ(string("This is alpha"), dictionary.getText(alpha));
+
+    // An ID at the address of a loaded one but with another name (as if
+    // the address was reused) is looked up by name.
+    static char reused[] = "BETA";
+    static const char* reused_data[] = {
+        reused, "This is reused",
+        NULL
+    };
+    dictionary.load(reused_data);
+    EXPECT_EQ(string("This is beta"), dictionary.getText(reused));
+    strcpy(reused, "ALPHA");
+    EXPECT_EQ(string("This is alpha"), dictionary.getText(reused));
+    strcpy(reused, "GAMMA");
+    EXPECT_EQ(string(""), dictionary.getText(reused));
+
+    // A replaced text is seen through the index.
+    EXPECT_TRUE(dictionary.replace("ALPHA", "Replaced alpha"));
+    EXPECT_EQ(string("Replaced alpha"), dictionary.getText(data[0]));
+}
+
+// Check that the index grows with the number of messages loaded.
+
+TEST_F(MessageDictionaryTest, IndexGrowth) {
+    const int count = 1000;
+    vector<string> strings;
+    for (int i = 0; i < count; ++i) {
+        strings.push_back("ID" + boost::lexical_cast<string>(i));
+        strings.push_back("Text " + boost::lexical_cast<string>(i));
+    }
+    vector<const char*> data;
+    for (vector<string>::const_iterator i = strings.begin();
+         i != strings.end(); ++i) {
+        data.push_back(i->c_str());
+    }
+    data.push_back(NULL);
+
+    MessageDictionary dictionary;
+    EXPECT_EQ(0, dictionary.load(&data[0]).size());
+    EXPECT_EQ(count, dictionary.size());
+    for (int i = 0; i < count; ++i) {
+        EXPECT_EQ(strings[2 * i + 1], dictionary.getText(data[2 * i]));
+    }
+}
+
 // Check that the global dictionary is a singleton.
 
 TEST_F(MessageDictionaryTest, GlobalTest) {
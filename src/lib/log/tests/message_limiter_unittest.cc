@@ -0,0 +1,117 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <log/message_limiter.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using namespace bundy::log;
+using namespace std;
+
+namespace {
+
+const MessageID TEST_ID = "LOG_LIMITER_TEST";
+const MessageID OTHER_ID = "LOG_LIMITER_OTHER";
+
+// Count how many of the given number of messages are allowed at the time.
+size_t
+countAllowed(MessageLimiter& limiter, const MessageID& ident, size_t count,
+             time_t now)
+{
+    size_t allowed = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (limiter.allow(ident, now)) {
+            ++allowed;
+        }
+    }
+    return (allowed);
+}
+
+TEST(MessageLimiterTest, noLimit) {
+    MessageLimiter limiter;
+    EXPECT_TRUE(limiter.allow(TEST_ID));
+    EXPECT_EQ(100, countAllowed(limiter, TEST_ID, 100, 1));
+    EXPECT_EQ(0, limiter.getSuppressed(TEST_ID));
+}
+
+TEST(MessageLimiterTest, sample) {
+    MessageLimiter limiter;
+    limiter.setLimit(TEST_ID, 10, 0);
+
+    // The first of every ten is allowed.
+    EXPECT_TRUE(limiter.allow(TEST_ID, 1));
+    EXPECT_EQ(0, countAllowed(limiter, TEST_ID, 9, 1));
+    EXPECT_TRUE(limiter.allow(TEST_ID, 1));
+    EXPECT_EQ(9, countAllowed(limiter, TEST_ID, 90, 1));
+    EXPECT_EQ(90, limiter.getSuppressed(TEST_ID));
+
+    // Other messages aren't affected.
+    EXPECT_EQ(100, countAllowed(limiter, OTHER_ID, 100, 1));
+    EXPECT_EQ(0, limiter.getSuppressed(OTHER_ID));
+}
+
+TEST(MessageLimiterTest, perSecond) {
+    MessageLimiter limiter;
+    limiter.setLimit(TEST_ID, 0, 5);
+
+    EXPECT_EQ(5, countAllowed(limiter, TEST_ID, 100, 1));
+    EXPECT_EQ(95, limiter.getSuppressed(TEST_ID));
+    // A new second starts a new count.
+    EXPECT_EQ(5, countAllowed(limiter, TEST_ID, 10, 2));
+    EXPECT_EQ(100, limiter.getSuppressed(TEST_ID));
+}
+
+TEST(MessageLimiterTest, sampleAndPerSecond) {
+    MessageLimiter limiter;
+    limiter.setLimit(TEST_ID, 2, 3);
+    // Half of the messages pass sampling and at most 3 of them get out.
+    EXPECT_EQ(3, countAllowed(limiter, TEST_ID, 100, 1));
+    EXPECT_EQ(97, limiter.getSuppressed(TEST_ID));
+}
+
+// The ID is compared by value, not by address.
+TEST(MessageLimiterTest, identByValue) {
+    MessageLimiter limiter;
+    limiter.setLimit(TEST_ID, 0, 1);
+    const string copy(TEST_ID);
+    EXPECT_TRUE(limiter.allow(copy.c_str(), 1));
+    EXPECT_FALSE(limiter.allow(TEST_ID, 1));
+    EXPECT_EQ(1, limiter.getSuppressed(copy));
+}
+
+TEST(MessageLimiterTest, clear) {
+    MessageLimiter limiter;
+    limiter.setLimit(TEST_ID, 0, 1);
+    limiter.setLimit(OTHER_ID, 0, 1);
+    EXPECT_EQ(1, countAllowed(limiter, TEST_ID, 10, 1));
+    EXPECT_EQ(1, countAllowed(limiter, OTHER_ID, 10, 1));
+
+    // Setting the limit again resets it.
+    limiter.setLimit(TEST_ID, 0, 2);
+    EXPECT_EQ(0, limiter.getSuppressed(TEST_ID));
+    EXPECT_EQ(2, countAllowed(limiter, TEST_ID, 10, 1));
+
+    limiter.clearLimit(TEST_ID);
+    EXPECT_EQ(10, countAllowed(limiter, TEST_ID, 10, 1));
+    EXPECT_EQ(0, countAllowed(limiter, OTHER_ID, 10, 1));
+    EXPECT_EQ(0, limiter.getSuppressed(TEST_ID));
+
+    limiter.clearLimits();
+    EXPECT_TRUE(limiter.allow(OTHER_ID));
+    EXPECT_EQ(0, limiter.getSuppressed(OTHER_ID));
+}
+
+}
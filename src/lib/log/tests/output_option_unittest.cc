@@ -46,6 +46,8 @@ TEST(OutputOption, getDestination) {
     EXPECT_EQ(OutputOption::DEST_SYSLOG, getDestination("syslog"));
     EXPECT_EQ(OutputOption::DEST_SYSLOG, getDestination("SYSLOG"));
     EXPECT_EQ(OutputOption::DEST_SYSLOG, getDestination("SYSlog"));
+    EXPECT_EQ(OutputOption::DEST_BINARY, getDestination("binary"));
+    EXPECT_EQ(OutputOption::DEST_BINARY, getDestination("BINARY"));
 
     // bad values should default to DEST_CONSOLE
     EXPECT_EQ(OutputOption::DEST_CONSOLE, getDestination("SOME_BAD_VALUE"));
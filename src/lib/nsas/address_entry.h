@@ -18,7 +18,9 @@
 /// \brief Address Entry
 ///
 /// Lightweight class that couples an address with a RTT and provides some
-/// convenience methods for accessing and updating the information.
+/// convenience methods for accessing and updating the information.  The
+/// weight used to select between addresses is derived from the RTT when the
+/// RTT changes, so it doesn't have to be recomputed on every selection.
 
 #include <stdint.h>
 #include <asiolink/io_address.h>
@@ -35,7 +37,8 @@ public:
     /// \param address Address object representing this address
     /// \param rtt Initial round-trip time
     AddressEntry(const asiolink::IOAddress& address, uint32_t rtt = 0) :
-        address_(address), rtt_(rtt), dead_until_(0)
+        address_(address), rtt_(rtt), weight_(calculateWeight(rtt)),
+        dead_until_(0)
     {}
 
     /// \return Address object
@@ -48,6 +51,7 @@ public:
         if(dead_until_ != 0 && time(NULL) >= dead_until_){
             dead_until_ = 0;
             rtt_ = 1; //reset the rtt to a small value so it has an opportunity to be updated
+            weight_ = calculateWeight(rtt_);
         }
 
         return rtt_;
@@ -62,6 +66,16 @@ public:
         }
 
         rtt_ = rtt;
+        weight_ = calculateWeight(rtt);
+    }
+
+    /// \return Selection weight of the address
+    ///
+    /// The weight is 1/(rtt*rtt), so faster addresses are preferred, and 0
+    /// for unreachable addresses (and the invalid RTT of 0).
+    double getWeight() {
+        getRTT();   // Revives the address if its dead time is over
+        return (weight_);
     }
 
     /// Mark address as unreachable.
@@ -90,8 +104,16 @@ public:
     static const uint32_t UNREACHABLE;  ///< RTT indicating unreachable address
 
 private:
+    static double calculateWeight(uint32_t rtt) {
+        if (rtt == 0 || rtt == UNREACHABLE) {
+            return (0.0);
+        }
+        return (1.0 / (static_cast<double>(rtt) * rtt));
+    }
+
     asiolink::IOAddress address_;       ///< Address
     uint32_t        rtt_;               ///< Round-trip time
+    double          weight_;            ///< Selection weight
     time_t  dead_until_;                ///< Dead time for unreachable server
 };
 
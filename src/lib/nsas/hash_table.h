@@ -15,9 +15,10 @@
 #ifndef HASH_TABLE_H
 #define HASH_TABLE_H
 
-#include <list>
+#include <vector>
 
 #include <boost/shared_ptr.hpp>
+#include <boost/version.hpp>
 
 #include <util/locks.h>
 
@@ -27,17 +28,28 @@
 // Maximum key length if the maximum size of a DNS name
 #define MAX_KEY_LENGTH 255
 
+// The slots are read without locking if shared_ptr supports atomic access.
+#if BOOST_VERSION >= 105300
+#define NSAS_HASH_TABLE_ATOMIC_SLOTS 1
+#endif
+
 namespace bundy {
 namespace nsas {
 
 /// \brief Hash Table Slot
 ///
-/// Describes the entry for the hash table.  This is non-copyable (because
-/// the mutex is non-copyable), but we need to be able to copy it to initialize
-/// a vector of hash table slots.  As the copy is only needed for
-/// initialization, and as there is no need to copy state when this happens, we
-/// cheat: the copy constructor constructs a newly initialized HashTableSlot and
-/// does not copy its argument.
+/// Describes the entry for the hash table.  The objects with the same hash
+/// are held in an array that is never modified once it's published; a
+/// writer makes a modified copy and replaces the pointer to the array, so
+/// readers can use the array they got without locking.  An old array (and
+/// the objects only it refers to) is freed when the last reader drops it.
+/// The mutex serializes the writers.
+///
+/// This is non-copyable (because the mutex is non-copyable), but we need to
+/// be able to copy it to initialize a vector of hash table slots.  As the
+/// copy is only needed for initialization, and as there is no need to copy
+/// state when this happens, we cheat: the copy constructor constructs a
+/// newly initialized HashTableSlot and does not copy its argument.
 template <typename T>
 struct HashTableSlot {
 
@@ -45,7 +57,11 @@ struct HashTableSlot {
     ///
     //@{
 
-    typedef typename std::list<boost::shared_ptr<T> >::iterator  iterator;
+    typedef std::vector<boost::shared_ptr<T> > array_type;
+                                    ///< Elements with same hash
+    typedef boost::shared_ptr<const array_type> array_ptr;
+                                    ///< Pointer to published elements
+    typedef typename array_type::const_iterator iterator;
                                     ///< Iterator over elements with same hash
 
     typedef bundy::util::locks::upgradable_mutex mutex_type;
@@ -59,12 +75,33 @@ struct HashTableSlot {
     /// \brief Copy Constructor
     ///
     /// ... which as noted in the class description does not copy.
-    HashTableSlot(const HashTableSlot<T>&) : mutex_(), list_()
+    HashTableSlot(const HashTableSlot<T>&) : mutex_(), array_()
     { }
 
+    /// \brief Get the current array of the slot (possibly NULL if empty).
+    array_ptr load() const {
+#ifdef NSAS_HASH_TABLE_ATOMIC_SLOTS
+        return (boost::atomic_load(&array_));
+#else
+        return (array_);
+#endif
+    }
+
+    /// \brief Publish a new array for the slot.
+    ///
+    /// The mutex must be held.
+    void store(const array_ptr& array) {
+#ifdef NSAS_HASH_TABLE_ATOMIC_SLOTS
+        boost::atomic_store(&array_, array);
+#else
+        array_ = array;
+#endif
+    }
+
 public:
     mutex_type                          mutex_;     ///< Protection mutex
-    std::list<boost::shared_ptr<T> >    list_;      ///< List head
+private:
+    array_ptr                           array_;     ///< Published elements
 };
 
 /// \brief Comparison Object Class
@@ -101,10 +138,12 @@ public:
 /// nameservers of the Nameserver Address Store are held.
 ///
 /// A special class has been written (rather than use an existing hash table
-/// class) to improve concurrency.  Rather than lock the entire hash table when
-/// an object is added/removed/looked up, only the entry for a particular hash
-/// value is locked.  To do this, each entry in the hash table is a pair of
-/// mutex/STL List; the mutex protects that particular list.
+/// class) to improve concurrency.  The table is read much more often than it
+/// is modified, so lookups don't lock at all: each entry in the hash table
+/// is a mutex and a pointer to an immutable array of the objects with that
+/// hash value (see \c HashTableSlot).  Only the writers of a particular
+/// hash value lock its mutex.  (Without atomic access to shared pointers,
+/// i.e., with Boost older than 1.53, the readers lock the mutex too.)
 ///
 /// \param T Class of object to be stored in the table.
 template <typename T>
@@ -150,7 +189,9 @@ public:
     /// \return Shared pointer to the object or NULL if it is not there.
     boost::shared_ptr<T> get(const HashKey& key) {
         uint32_t index = hash_(key);
+#ifndef NSAS_HASH_TABLE_ATOMIC_SLOTS
         sharable_lock lock(table_[index].mutex_);
+#endif
         return getInternal(key, index);
     }
 
@@ -202,20 +243,22 @@ public:
      * \return The boolean part of pair tells if the value was added (true
      *     means new value, false looked up one). The other part is the
      *     object, either found or created.
-     * \todo This uses a scoped_lock, which does not allow sharing and is
-     *     used a lot in the code. It might turn out in future that it is a
-     *     problem and that most of the accesses is read only. In that case we
-     *     could split it to fast-slow path - first try to find it with
-     *     shared_lock. If it fails, lock by scoped_lock, try to find again (we
-     *     unlocked it, so it might have appeared) and if it still isn't there,
-     *     create it. Not implemented now as it might or might not help (it
-     *     could even slow it down) and the code would get more complicated.
+     *
+     * The entry is looked up without locking first; only if it's not there,
+     * the slot is locked and it is looked up again (it might have been added
+     * in the meantime) before calling the generator.
      */
     template<class Generator>
     std::pair<bool, boost::shared_ptr<T> > getOrAdd(const HashKey& key,
         const Generator& generator)
     {
         uint32_t index = hash_(key);
+#ifdef NSAS_HASH_TABLE_ATOMIC_SLOTS
+        boost::shared_ptr<T> found(getInternal(key, index));
+        if (found) {
+            return (std::pair<bool, boost::shared_ptr<T> >(false, found));
+        }
+#endif
         scoped_lock lock(table_[index].mutex_);
         boost::shared_ptr<T> result(getInternal(key, index));
         if (result) {
@@ -227,6 +270,26 @@ public:
         }
     }
 
+    /// \brief Get All Entries
+    ///
+    /// Appends shared pointers to all objects in the table to the given
+    /// vector.  The slots are locked one by one, so objects added or
+    /// removed meanwhile may or may not be included.
+    ///
+    /// \param objects Vector the objects are appended to.
+    void getAll(std::vector<boost::shared_ptr<T> >& objects) {
+        for (size_t index = 0; index < table_.size(); ++index) {
+#ifndef NSAS_HASH_TABLE_ATOMIC_SLOTS
+            sharable_lock lock(table_[index].mutex_);
+#endif
+            const typename HashTableSlot<T>::array_ptr
+                array(table_[index].load());
+            if (array) {
+                objects.insert(objects.end(), array->begin(), array->end());
+            }
+        }
+    }
+
     /// \brief Returns Size of Hash Table
     ///
     /// \return Size of hash table
@@ -235,9 +298,9 @@ public:
     }
 
 protected:
-    // Internal parts, expect to be already locked
+    // Internal parts; the writers expect to be already locked
     boost::shared_ptr<T> getInternal(const HashKey& key,
-        uint32_t index);
+        uint32_t index) const;
     bool addInternal(boost::shared_ptr<T>& object, const HashKey& key,
         uint32_t index, bool replace = false);
 
@@ -257,15 +320,19 @@ HashTable<T>::HashTable(HashTableCompare<T>* compare, uint32_t size) :
 // Lookup an object in the table
 template <typename T>
 boost::shared_ptr<T> HashTable<T>::getInternal(const HashKey& key,
-    uint32_t index)
+    uint32_t index) const
 {
-    // Locate the object.
-    typename HashTableSlot<T>::iterator i;
-    for (i = table_[index].list_.begin(); i != table_[index].list_.end(); ++i) {
-        if ((*compare_)(i->get(), key)) {
-
-            // Found it, so return the shared pointer object
-            return (*i);
+    // Locate the object in the current array of the slot.  It stays valid
+    // while we hold the pointer, even if it's replaced in the table.
+    const typename HashTableSlot<T>::array_ptr array(table_[index].load());
+    if (array) {
+        typename HashTableSlot<T>::iterator i;
+        for (i = array->begin(); i != array->end(); ++i) {
+            if ((*compare_)(i->get(), key)) {
+
+                // Found it, so return the shared pointer object
+                return (*i);
+            }
         }
     }
 
@@ -280,19 +347,28 @@ bool HashTable<T>::remove(const HashKey& key) {
     // Calculate the hash value
     uint32_t index = hash_(key);
 
-    // Access to the elements of this hash slot are accessed under a mutex.
+    // Modifications of the elements of this hash slot are done under a mutex.
     // The mutex will be released when this object goes out of scope and is
     // destroyed.
     scoped_lock lock(table_[index].mutex_);
 
     // Now search this list to see if the element already exists.
-    typename HashTableSlot<T>::iterator i;
-    for (i = table_[index].list_.begin(); i != table_[index].list_.end(); ++i) {
-        if ((*compare_)(i->get(), key)) {
-
-            // Object found so delete it.
-            table_[index].list_.erase(i);
-            return true;;
+    const typename HashTableSlot<T>::array_ptr array(table_[index].load());
+    if (array) {
+        typename HashTableSlot<T>::iterator i;
+        for (i = array->begin(); i != array->end(); ++i) {
+            if ((*compare_)(i->get(), key)) {
+
+                // Object found so publish a copy without it.
+                typename HashTableSlot<T>::array_type* new_array =
+                    new typename HashTableSlot<T>::array_type;
+                new_array->reserve(array->size() - 1);
+                new_array->insert(new_array->end(), array->begin(), i);
+                new_array->insert(new_array->end(), i + 1, array->end());
+                table_[index].store(
+                    typename HashTableSlot<T>::array_ptr(new_array));
+                return true;
+            }
         }
     }
 
@@ -306,27 +382,37 @@ template <typename T>
 bool HashTable<T>::addInternal(boost::shared_ptr<T>& object,
     const HashKey& key, uint32_t index, bool replace)
 {
+    // The new array is a copy of the current one (if any) with the object.
+    typename HashTableSlot<T>::array_type* new_array =
+        new typename HashTableSlot<T>::array_type;
+    typename HashTableSlot<T>::array_ptr new_array_ptr(new_array);
+
     // Search this list to see if the element already exists.
-    typename HashTableSlot<T>::iterator i;
-    for (i = table_[index].list_.begin(); i != table_[index].list_.end(); ++i) {
-        if ((*compare_)(i->get(), key)) {
-
-            // Object found.  If we are not allowed to replace the element,
-            // return an error.  Otherwise erase it from the list and exit the
-            // loop.
-            if (replace) {
-                table_[index].list_.erase(i);
-                break;
-            }
-            else {
-                return false;
+    const typename HashTableSlot<T>::array_ptr array(table_[index].load());
+    if (array) {
+        new_array->reserve(array->size() + 1);
+        typename HashTableSlot<T>::iterator i;
+        for (i = array->begin(); i != array->end(); ++i) {
+            if ((*compare_)(i->get(), key)) {
+
+                // Object found.  If we are not allowed to replace the
+                // element, return an error.  Otherwise leave it out of the
+                // new array.
+                if (replace) {
+                    continue;
+                }
+                else {
+                    return false;
+                }
             }
+            new_array->push_back(*i);
         }
     }
 
     // When we get here, we know that there is no element with the key in the
     // list - in which case, add the new object.
-    table_[index].list_.push_back(object);
+    new_array->push_back(object);
+    table_[index].store(new_array_ptr);
 
     return true;
 }
@@ -56,6 +56,7 @@ NameserverAddressStore::NameserverAddressStore(
         new HashDeleter<ZoneEntry>(*zone_hash_))),
     nameserver_lru_(new bundy::util::LruList<NameserverEntry>((3 * nshashsize),
         new HashDeleter<NameserverEntry>(*nameserver_hash_))),
+    rtt_hints_(new AddressRTTs),
     resolver_(resolver.get())
 { }
 
@@ -72,10 +73,11 @@ newZone(
     bundy::resolve::ResolverInterface* resolver,
     const string* zone, const RRClass* class_code,
     const boost::shared_ptr<HashTable<NameserverEntry> >* ns_hash,
-    const boost::shared_ptr<bundy::util::LruList<NameserverEntry> >* ns_lru)
+    const boost::shared_ptr<bundy::util::LruList<NameserverEntry> >* ns_lru,
+    const boost::shared_ptr<AddressRTTs>* rtt_hints)
 {
     boost::shared_ptr<ZoneEntry> result(new ZoneEntry(resolver, *zone, *class_code,
-        *ns_hash, *ns_lru));
+        *ns_hash, *ns_lru, *rtt_hints));
     return (result);
 }
 
@@ -91,7 +93,8 @@ NameserverAddressStore::lookup(const string& zone, const RRClass& class_code,
     pair<bool, boost::shared_ptr<ZoneEntry> > zone_obj(
         zone_hash_->getOrAdd(HashKey(zone, class_code),
                              boost::bind(newZone, resolver_, &zone, &class_code,
-                                         &nameserver_hash_, &nameserver_lru_)));
+                                         &nameserver_hash_, &nameserver_lru_,
+                                         &rtt_hints_)));
     if (zone_obj.first) {
         zone_lru_->add(zone_obj.second);
     } else {
@@ -116,5 +119,21 @@ NameserverAddressStore::cancel(const string& zone,
     }
 }
 
+void
+NameserverAddressStore::getRTTs(AddressRTTs& rtts) {
+    vector<boost::shared_ptr<NameserverEntry> > nameservers;
+    nameserver_hash_->getAll(nameservers);
+    BOOST_FOREACH(const boost::shared_ptr<NameserverEntry>& nameserver,
+                  nameservers) {
+        nameserver->getAddressRTTs(rtts);
+    }
+}
+
+void
+NameserverAddressStore::setRTTHints(const AddressRTTs& rtts) {
+    // The map is shared with the zones, so it's updated in place.
+    *rtt_hints_ = rtts;
+}
+
 } // namespace nsas
 } // namespace bundy
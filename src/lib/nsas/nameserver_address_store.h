@@ -100,6 +100,29 @@ public:
                 const boost::shared_ptr<AddressRequestCallback>& callback,
                 AddressFamily family = ANY_OK);
 
+    /// \brief Get the RTTs of the known nameserver addresses
+    ///
+    /// The RTTs estimated for the addresses of all nameservers in the
+    /// store, except the unreachable ones, are stored in the given map.
+    /// They can be given to a new store with \c setRTTHints(), so it
+    /// doesn't need to learn them again.
+    ///
+    /// \param rtts The map to store the RTTs in.
+    void getRTTs(AddressRTTs& rtts);
+
+    /// \brief Set the initial RTTs of nameserver addresses
+    ///
+    /// When an address of a nameserver is found for the first time, its
+    /// RTT in \c rtts is used as the initial estimate.  Others start with
+    /// a small value, so they are tried soon.  The hints replace any
+    /// given before.
+    ///
+    /// This is not thread safe; it's expected to be called before the
+    /// store is used.
+    ///
+    /// \param rtts The RTTs, as returned by \c getRTTs().
+    void setRTTHints(const AddressRTTs& rtts);
+
     /// \brief Protected Members
     ///
     /// These members should be private.  However, with so few public methods
@@ -119,6 +142,8 @@ protected:
     // ... and the LRU lists
     boost::shared_ptr<bundy::util::LruList<ZoneEntry> > zone_lru_;
     boost::shared_ptr<bundy::util::LruList<NameserverEntry> > nameserver_lru_;
+    // Initial RTTs of addresses, shared by all zones
+    boost::shared_ptr<AddressRTTs> rtt_hints_;
     // The resolver we use
 private:
     bundy::resolve::ResolverInterface* resolver_;
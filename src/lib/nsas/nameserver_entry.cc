@@ -157,6 +157,32 @@ NameserverEntry::setAddressRTT(const IOAddress& address, uint32_t rtt) {
     }
 }
 
+// Collect the RTTs of the addresses
+void
+NameserverEntry::getAddressRTTs(AddressRTTs& rtts) {
+    Lock lock(mutex_);
+
+    for (int family = V4_ONLY; family < ANY_OK; ++family) {
+        BOOST_FOREACH(AddressEntry& entry, addresses_[family]) {
+            if (!entry.isUnreachable()) {
+                rtts[entry.getAddress().toText()] = entry.getRTT();
+            }
+        }
+    }
+}
+
+// Use the hint for the address if there's one
+uint32_t
+NameserverEntry::getInitialRTT(const string& address) const {
+    if (rtt_hints_) {
+        const AddressRTTs::const_iterator it = rtt_hints_->find(address);
+        if (it != rtt_hints_->end() && it->second != 0) {
+            return (it->second);
+        }
+    }
+    return (1);
+}
+
 // Update the address's rtt
 #define UPDATE_RTT_ALPHA 0.7
 void
@@ -287,7 +313,9 @@ class NameserverEntry::ResolverCallback :
                 }
                 // If we found it, use it. If not, create a new one.
                 entries.push_back(found ? *found : AddressEntry(
-                                                   IOAddress(address), 1));
+                                                   IOAddress(address),
+                                                   entry_->getInitialRTT(
+                                                       address)));
                 LOG_DEBUG(nsas_logger, NSAS_DBG_RESULTS, NSAS_FOUND_ADDRESS)
                           .arg(address).arg(entry_->getName());
             }
@@ -100,11 +100,17 @@ public:
     ///
     /// \param name Name of the nameserver,
     /// \param class_code class of the nameserver
+    /// \param rtt_hints If not NULL, the initial RTTs of addresses found
+    ///     in it are taken from there, instead of a small default value
+    ///     (see \c NameserverAddressStore::setRTTHints()).
     NameserverEntry(const std::string& name,
-        const bundy::dns::RRClass& class_code) :
+        const bundy::dns::RRClass& class_code,
+        const boost::shared_ptr<const AddressRTTs>& rtt_hints =
+        boost::shared_ptr<const AddressRTTs>()) :
         name_(name),
         classCode_(class_code),
-        expiration_(0)
+        expiration_(0),
+        rtt_hints_(rtt_hints)
     {
         has_address_[V4_ONLY] = false;
         has_address_[V6_ONLY] = false;
@@ -146,6 +152,15 @@ public:
     asiolink::IOAddress getAddressAtIndex(size_t index,
         AddressFamily family) const;
 
+    /// \brief Get the RTTs of the addresses
+    ///
+    /// The RTT of each address currently known, except unreachable ones,
+    /// is stored in the given map, replacing any there for the same
+    /// address.
+    ///
+    /// \param rtts The map to store the RTTs in.
+    void getAddressRTTs(AddressRTTs& rtts);
+
     /// \brief Update RTT
     ///
     /// Updates the RTT for a particular address
@@ -260,6 +275,8 @@ private:
      */
     std::vector<AddressEntry> addresses_[ANY_OK], previous_addresses_[ANY_OK];
     time_t          expiration_;        ///< Summary expiration time. 0 = unset
+    /// Initial RTTs of new addresses (may be NULL)
+    const boost::shared_ptr<const AddressRTTs> rtt_hints_;
     // Do we have some addresses already? Do we expect some to come?
     // These are set after asking for IP, if NOT_ASKED, they are uninitialized
     bool has_address_[ADDR_REQ_MAX], expect_address_[ADDR_REQ_MAX];
@@ -275,6 +292,8 @@ private:
     /// Call unlocked.
     void askIP(bundy::resolve::ResolverInterface* resolver,
         const bundy::dns::RRType&, AddressFamily);
+    /// \short The RTT a newly found address starts with
+    uint32_t getInitialRTT(const std::string& address) const;
 };
 
 }   // namespace dns
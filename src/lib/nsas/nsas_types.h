@@ -20,6 +20,11 @@
 ///
 /// Defines a set of types used within the Network Address Store.
 
+#include <map>
+#include <string>
+
+#include <stdint.h>
+
 namespace bundy {
 namespace nsas {
 
@@ -41,6 +46,13 @@ enum AddressFamily {
     ADDR_REQ_MAX
 };
 
+/// \brief Round-trip times of nameserver addresses
+///
+/// The addresses are in text form.  This is used to keep the RTTs estimated
+/// by a store beyond its lifetime (see
+/// \c NameserverAddressStore::getRTTs()).
+typedef std::map<std::string, uint32_t> AddressRTTs;
+
 }
 }
 
@@ -103,6 +103,27 @@ TEST_F(AddressEntryTest, RTT) {
     EXPECT_EQ(AddressEntry::UNREACHABLE, alpha.getRTT());
 }
 
+/// The selection weight follows the RTT.
+TEST_F(AddressEntryTest, Weight) {
+
+    AddressEntry alpha(v4a_);
+    EXPECT_EQ(0.0, alpha.getWeight());
+
+    alpha.setRTT(10);
+    EXPECT_DOUBLE_EQ(0.01, alpha.getWeight());
+
+    // Large RTTs don't overflow
+    alpha.setRTT(100000);
+    EXPECT_DOUBLE_EQ(1e-10, alpha.getWeight());
+
+    AddressEntry beta(v6a_, 2);
+    EXPECT_DOUBLE_EQ(0.25, beta.getWeight());
+
+    // Unreachable addresses are never selected
+    beta.setUnreachable();
+    EXPECT_EQ(0.0, beta.getWeight());
+}
+
 /// Checking the address type.
 TEST_F(AddressEntryTest, AddressType) {
 
@@ -179,6 +179,33 @@ TEST_F(HashTableTest, GetTest) {
     EXPECT_TRUE(value.get() == NULL);
 }
 
+// Test objects that share a slot are kept when one of them is changed.
+TEST_F(HashTableTest, SameSlotTest) {
+
+    // A table with a single slot, so all the objects collide
+    HashTable<TestEntry> table(new NsasEntryCompare<TestEntry>(), 1);
+    EXPECT_TRUE(table.add(dummy1_, dummy1_->hashKey()));
+    EXPECT_TRUE(table.add(dummy3_, dummy3_->hashKey()));
+    EXPECT_TRUE(table.add(dummy4_, dummy4_->hashKey()));
+    EXPECT_EQ(2, dummy1_.use_count());
+    EXPECT_EQ(2, dummy3_.use_count());
+    EXPECT_EQ(2, dummy4_.use_count());
+
+    // Replace the first one, the others stay
+    EXPECT_TRUE(table.add(dummy2_, dummy2_->hashKey(), true));
+    EXPECT_EQ(1, dummy1_.use_count());
+    EXPECT_EQ(dummy2_.get(), table.get(dummy1_->hashKey()).get());
+    EXPECT_EQ(dummy3_.get(), table.get(dummy3_->hashKey()).get());
+    EXPECT_EQ(dummy4_.get(), table.get(dummy4_->hashKey()).get());
+
+    // Remove the one in the middle
+    EXPECT_TRUE(table.remove(dummy3_->hashKey()));
+    EXPECT_EQ(1, dummy3_.use_count());
+    EXPECT_TRUE(table.get(dummy3_->hashKey()).get() == NULL);
+    EXPECT_EQ(dummy2_.get(), table.get(dummy2_->hashKey()).get());
+    EXPECT_EQ(dummy4_.get(), table.get(dummy4_->hashKey()).get());
+}
+
 boost::shared_ptr<TestEntry>
 pass(boost::shared_ptr<TestEntry> value) {
     return (value);
@@ -313,6 +313,28 @@ TEST_F(NameserverAddressStoreTest, emptyLookup) {
 /// \brief Try looking up a zone that does not have any nameservers.
 ///
 /// It should not ask anything and say it is unreachable right away.
+/// \brief Check the RTT hints are used for new addresses and the RTTs can
+/// be retrieved
+TEST_F(NameserverAddressStoreTest, RTTHints) {
+    DerivedNsas nsas(resolver_, 10, 10);
+    AddressRTTs hints;
+    hints["192.0.2.1"] = 42;
+    nsas.setRTTHints(hints);
+
+    nsas.lookupAndAnswer("example.net.", RRClass::IN(), authority_,
+        getCallback());
+    EXPECT_NO_THROW(resolver_->asksIPs(Name("ns.example.com."), 0, 1));
+    EXPECT_NO_THROW(resolver_->answer(0, Name("ns.example.com."), RRType::A(),
+        rdata::in::A("192.0.2.1")));
+    ASSERT_EQ(1, NSASCallback::results.size());
+    EXPECT_EQ(42, NSASCallback::results[0].second.getAddressEntry().getRTT());
+
+    AddressRTTs rtts;
+    nsas.getRTTs(rtts);
+    ASSERT_EQ(1, rtts.size());
+    EXPECT_EQ(42, rtts["192.0.2.1"]);
+}
+
 TEST_F(NameserverAddressStoreTest, zoneWithoutNameservers) {
     DerivedNsas nsas(resolver_, 10, 10);
 
@@ -128,6 +128,39 @@ TEST_F(NameserverEntryTest, InitialRTT) {
     }
 }
 
+// The RTTs of the addresses can be taken from hints, and retrieved again
+TEST_F(NameserverEntryTest, RTTHints) {
+    boost::shared_ptr<AddressRTTs> hints(new AddressRTTs);
+    (*hints)["5.6.7.8"] = 42;
+    (*hints)["dead:beef:feed::"] = 100;
+    boost::shared_ptr<NameserverEntry> alpha(new NameserverEntry(EXAMPLE_CO_UK,
+        RRClass::IN(), hints));
+    fillNSEntry(alpha, rrv4_, rrv6_);
+    NameserverEntry::AddressVector vec;
+    alpha->getAddresses(vec);
+    ASSERT_EQ(5, vec.size());
+
+    BOOST_FOREACH(NameserverAddress& entry, vec) {
+        const string address = entry.getAddress().toText();
+        if (address == "5.6.7.8") {
+            EXPECT_EQ(42, entry.getAddressEntry().getRTT());
+        } else if (address == "dead:beef:feed::") {
+            EXPECT_EQ(100, entry.getAddressEntry().getRTT());
+        } else {
+            EXPECT_LT(entry.getAddressEntry().getRTT(), 20);
+        }
+    }
+
+    // The unreachable addresses aren't included in the RTTs
+    alpha->setAddressUnreachable(IOAddress("1.2.3.4"));
+    AddressRTTs rtts;
+    alpha->getAddressRTTs(rtts);
+    EXPECT_EQ(4, rtts.size());
+    EXPECT_EQ(42, rtts["5.6.7.8"]);
+    EXPECT_EQ(100, rtts["dead:beef:feed::"]);
+    EXPECT_EQ(0, rtts.count("1.2.3.4"));
+}
+
 // Set an address RTT to a given value
 TEST_F(NameserverEntryTest, SetRTT) {
 
@@ -41,10 +41,12 @@ ZoneEntry::ZoneEntry(
     bundy::resolve::ResolverInterface* resolver,
     const std::string& name, const bundy::dns::RRClass& class_code,
     boost::shared_ptr<HashTable<NameserverEntry> > nameserver_table,
-    boost::shared_ptr<LruList<NameserverEntry> > nameserver_lru) :
+    boost::shared_ptr<LruList<NameserverEntry> > nameserver_lru,
+    boost::shared_ptr<const AddressRTTs> rtt_hints) :
     expiry_(0),
     name_(name), class_code_(class_code), resolver_(resolver),
-    nameserver_table_(nameserver_table), nameserver_lru_(nameserver_lru)
+    nameserver_table_(nameserver_table), nameserver_lru_(nameserver_lru),
+    rtt_hints_(rtt_hints)
 {
     in_process_[ANY_OK] = false;
     in_process_[V4_ONLY] = false;
@@ -61,9 +63,11 @@ typedef boost::shared_ptr<AddressRequestCallback> CallbackPtr;
  * Called inside a mutex so it is filled in atomically.
  */
 boost::shared_ptr<NameserverEntry>
-newNs(const std::string* name, const RRClass* class_code) {
+newNs(const std::string* name, const RRClass* class_code,
+      const boost::shared_ptr<const AddressRTTs>* rtt_hints)
+{
     return (boost::shared_ptr<NameserverEntry>(new NameserverEntry(*name,
-        *class_code)));
+        *class_code, *rtt_hints)));
 }
 
 }
@@ -157,7 +161,8 @@ class ZoneEntry::ResolverCallback :
                             pair<bool, NameserverPtr> from_hash(
                                 entry_->nameserver_table_->getOrAdd(HashKey(
                                 ns_name_str, entry_->class_code_), boost::bind(
-                                newNs, &ns_name_str, &entry_->class_code_)));
+                                newNs, &ns_name_str, &entry_->class_code_,
+                                &entry_->rtt_hints_)));
                             // Make it at the front of the list
                             if (from_hash.first) {
                                 entry_->nameserver_lru_->add(from_hash.second);
@@ -303,25 +308,25 @@ move(Container& into, Container& from) {
 // Each address has a probability to be selected if multiple addresses are available
 // The weight factor is equal to 1/(rtt*rtt), then all the weight factors are normalized
 // to make the sum equal to 1.0
+//
+// The weights are kept by the address entries, so this only normalizes them
+// into the probabilities vector (which is reused and so not reallocated).
 void
 updateAddressSelector(std::vector<NameserverAddress>& addresses,
-    WeightedRandomIntegerGenerator& selector)
+    vector<double>& probabilities, WeightedRandomIntegerGenerator& selector)
 {
-    vector<double> probabilities;
+    probabilities.clear();
+    double sum = 0;
     BOOST_FOREACH(NameserverAddress& address, addresses) {
-        uint32_t rtt = address.getAddressEntry().getRTT();
-        if(rtt == 0) {
+        AddressEntry& entry(address.getAddressEntry());
+        if(entry.getRTT() == 0) {
             bundy_throw(RTTIsZero, "The RTT is 0");
         }
 
-        if(rtt == AddressEntry::UNREACHABLE) {
-            probabilities.push_back(0);
-        } else {
-            probabilities.push_back(1.0/(rtt*rtt));
-        }
+        const double weight = entry.getWeight();
+        probabilities.push_back(weight);
+        sum += weight;
     }
-    // Calculate the sum
-    double sum = accumulate(probabilities.begin(), probabilities.end(), 0.0);
 
     if(sum != 0) {
         // Normalize the probabilities to make the sum equal to 1.0
@@ -341,6 +346,21 @@ updateAddressSelector(std::vector<NameserverAddress>& addresses,
     selector.reset(probabilities);
 }
 
+// Clears a container when it goes out of scope (the container keeps its
+// memory for the next use, but not its content).
+template<class Container>
+class ClearGuard {
+public:
+    ClearGuard(Container& container) :
+        container_(container)
+    { }
+    ~ ClearGuard() {
+        container_.clear();
+    }
+private:
+    Container& container_;
+};
+
 }
 
 /**
@@ -470,8 +490,13 @@ ZoneEntry::process(AddressFamily family,
                 // Mark we are on the stack
                 ProcessGuard guard(in_process_[family]);
                 in_process_[family] = true;
-                // Variables to store the data to
-                NameserverEntry::AddressVector addresses;
+                // Variables to store the data to (the addresses are
+                // collected in a buffer kept between calls)
+                NameserverEntry::AddressVector&
+                    addresses(address_buffers_[family]);
+                addresses.clear();
+                ClearGuard<NameserverEntry::AddressVector> clear_guard(
+                    addresses);
                 NameserverVector to_ask;
                 bool pending(false);
 
@@ -529,9 +554,8 @@ ZoneEntry::process(AddressFamily family,
                 // We have some addresses to answer
                 } else if (!addresses.empty()) {
                     // Prepare the selector of addresses
-                    // TODO: Think of a way how to keep it for a while
-                    //   (not update every time)
-                    updateAddressSelector(addresses, address_selector);
+                    updateAddressSelector(addresses, address_probabilities_,
+                                          address_selector);
 
                     // Extract the callbacks
                     vector<CallbackPtr> to_execute;
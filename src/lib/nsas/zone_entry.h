@@ -30,6 +30,7 @@
 
 #include "hash_key.h"
 #include "nsas_entry.h"
+#include "nameserver_entry.h"
 #include "fetchable.h"
 #include "nsas_types.h"
 #include "glue_hints.h"
@@ -66,13 +67,17 @@ public:
      * \param nameserver_table Hashtable of NameServerEntry objects for
      *     this zone
      * \param nameserver_lru LRU for the nameserver entries
+     * \param rtt_hints Initial RTTs of the addresses of the nameservers
+     *     created by this zone (see \c NameserverEntry), may be NULL
      * \todo Move to cc file, include the lookup (if NSAS uses resolver for
      *     everything)
      */
     ZoneEntry(bundy::resolve::ResolverInterface* resolver,
         const std::string& name, const bundy::dns::RRClass& class_code,
         boost::shared_ptr<HashTable<NameserverEntry> > nameserver_table,
-        boost::shared_ptr<bundy::util::LruList<NameserverEntry> > nameserver_lru);
+        boost::shared_ptr<bundy::util::LruList<NameserverEntry> > nameserver_lru,
+        boost::shared_ptr<const AddressRTTs> rtt_hints =
+        boost::shared_ptr<const AddressRTTs>());
 
     /// \return Name of the zone
     std::string getName() const {
@@ -162,6 +167,8 @@ private:
     // update
     boost::shared_ptr<HashTable<NameserverEntry> > nameserver_table_;
     boost::shared_ptr<bundy::util::LruList<NameserverEntry> > nameserver_lru_;
+    // Passed to the nameservers we create
+    boost::shared_ptr<const AddressRTTs> rtt_hints_;
     // Resolver callback class, documentation with the class declaration
     class ResolverCallback;
     // It has direct access to us
@@ -183,6 +190,12 @@ private:
     // A random generator for this zone entry
     // TODO: A more global one? Per thread one?
     bundy::util::random::WeightedRandomIntegerGenerator address_selector;
+    // Buffers for the addresses collected by process, one for each family
+    // (process doesn't recurse for the same family while using it).  They
+    // are emptied after use but keep their memory.
+    NameserverEntry::AddressVector address_buffers_[ADDR_REQ_MAX];
+    // Buffer for the probabilities passed to address_selector
+    std::vector<double> address_probabilities_;
 };
 
 } // namespace nsas
@@ -25,6 +25,9 @@ from libutil_io_python import recv_fd
 
 logger = bundy.log.Logger("init")
 
+# The maximum number of sockets of a group the creator accepts
+MAX_SOCKET_GROUP_SIZE = 1024
+
 """
 Module that communicates with the privileged socket creator (bundy-sockcreator).
 """
@@ -117,11 +120,46 @@ class Parser:
             raise CreatorError('Socket requested on terminated creator', True)
         # First, assemble the request from parts
         logger.info(BUNDY_SOCKET_GET, address, port, socktype)
-        data = b'S'
+        data = b'S' + self.__socket_request(address, port, socktype)
+        return self.__request(data, address, port, 1)[0]
+
+    def get_socket_group(self, address, port, socktype, count, cpus=None):
+        """
+        Asks the socket creator process to create a group of count sockets
+        bound to the same address with the SO_REUSEPORT option, so the
+        traffic is spread among them (eg. one socket for each thread of
+        a server). The address, port and socktype are the same as for
+        get_socket. The cpus is either None or a list of count CPU numbers
+        (or -1) the sockets are intended for; the system may use them as
+        a hint to pick the socket of the traffic processed on a CPU.
+
+        Returns the list of the file descriptor numbers. It raises a
+        CreatorError exception if the creation fails, in which case none
+        of the sockets is created.
+        """
+        if self.__socket is None:
+            raise CreatorError('Socket requested on terminated creator', True)
+        if count < 1 or count > MAX_SOCKET_GROUP_SIZE:
+            raise ValueError('Invalid number of sockets: ' + str(count))
+        if cpus is None:
+            cpus = [-1] * count
+        elif len(cpus) != count:
+            raise ValueError('The number of CPUs must be the number of ' +
+                             'sockets')
+        logger.info(BUNDY_SOCKET_GET_GROUP, count, address, port, socktype)
+        data = b'G' + self.__socket_request(address, port, socktype)
+        data += struct.pack('H', count)
+        data += struct.pack(str(count) + 'i', *cpus)
+        return self.__request(data, address, port, count)
+
+    def __socket_request(self, address, port, socktype):
+        """
+        Returns the description of a socket in a request to the creator.
+        """
         if socktype == 'UDP' or socktype == socket.SOCK_DGRAM:
-            data += b'U'
+            data = b'U'
         elif socktype == 'TCP' or socktype == socket.SOCK_STREAM:
-            data += b'T'
+            data = b'T'
         else:
             raise ValueError('Unknown socket type: ' + str(socktype))
         if address.family == socket.AF_INET:
@@ -132,14 +170,23 @@ class Parser:
             raise ValueError('Unknown address family in address')
         data += struct.pack('!H', port)
         data += address.addr
+        return data
+
+    def __request(self, data, address, port, count):
+        """
+        Sends the request for sockets and returns the list of the count file
+        descriptors received.
+        """
         try:
             # Send the request
             self.__socket.sendall(data)
             answer = self.__socket.recv(1)
             if answer == b'S':
                 # Success!
-                result = self.__socket.read_fd()
-                logger.info(BUNDY_SOCKET_CREATED, result)
+                result = []
+                for i in range(count):
+                    result.append(self.__socket.read_fd())
+                    logger.info(BUNDY_SOCKET_CREATED, result[-1])
                 return result
             elif answer == b'E':
                 # There was an error, read the error as well
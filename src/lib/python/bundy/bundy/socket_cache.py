@@ -53,16 +53,19 @@ class Socket:
     collector. In short, do not make reference cycles with this and generally
     leave this class alone to live peacefully.
     """
-    def __init__(self, protocol, address, port, fileno):
+    def __init__(self, protocol, address, port, fileno, key=None):
         """
         Creates the socket.
 
         The protocol, address and port are preserved for the information.
+        The key is the one of the socket in the cache under the protocol and
+        address; it's the port, unless the socket is part of a group.
         """
         self.protocol = protocol
         self.address = address
         self.port = port
         self.fileno = fileno
+        self.key = port if key is None else key
         # Mapping from token -> application
         self.active_tokens = {}
         # The tokens which were not yet picked up
@@ -205,6 +208,12 @@ class Cache:
         if not socket.share_compatible(share_mode, share_name):
             raise ShareError("Cached socket not compatible with mode " +
                              share_mode + " and name " + share_name)
+        return self.__add_token(socket, share_mode, share_name)
+
+    def __add_token(self, socket, share_mode, share_name):
+        """
+        Creates a new token for the socket, waiting to be picked up.
+        """
         # Grab yet unused token
         token = 't' + str(random.randint(0, 2 ** 32-1))
         while token in self._live_tokens:
@@ -215,6 +224,63 @@ class Cache:
         socket.waiting_tokens.add(token)
         return token
 
+    def get_group_tokens(self, protocol, address, port, count, share_mode,
+                         share_name, cpus=None):
+        """
+        This requests tokens representing a group of count sockets bound
+        to the same address and port with the SO_REUSEPORT option, so an
+        application can receive the traffic on several sockets (eg. one for
+        each of its threads). The group is created by the creator (see
+        bundy.bundy.sockcreator.Parser.get_socket_group, for the cpus too) or
+        found in the cache, as for get_token.
+
+        The other parameters, the result and the exceptions are the same as
+        for get_token, except a list of the tokens of the sockets is
+        returned. A ShareError is also raised if the cached group has
+        a different number of sockets, or some of its sockets were already
+        released.
+
+        The sockets of a group are cached separately from the single ones
+        (which can't be bound to the same address anyway), as
+        (port, 'group', index) under the protocol and address.
+        """
+        addr_str = str(address)
+        cached = self._sockets.get(protocol, {}).get(addr_str, {})
+        group = [key for key in cached.keys() if type(key) is tuple and
+                 key[0] == port]
+        if len(group) == 0:
+            try:
+                filenos = self._creator.get_socket_group(address, port,
+                                                         protocol, count, cpus)
+            except bundy.bundy.sockcreator.CreatorError as ce:
+                if ce.fatal:
+                    raise
+                else:
+                    raise SocketError(str(ce), ce.errno)
+            sockets = [Socket(protocol, address, port, fileno,
+                              (port, 'group', i))
+                       for (i, fileno) in enumerate(filenos)]
+            # And cache them
+            if protocol not in self._sockets:
+                self._sockets[protocol] = {}
+            if addr_str not in self._sockets[protocol]:
+                self._sockets[protocol][addr_str] = {}
+            for socket in sockets:
+                self._sockets[protocol][addr_str][socket.key] = socket
+        elif set(group) != set([(port, 'group', i) for i in range(count)]):
+            raise ShareError("Cached socket group of " + str(len(group)) +
+                             " sockets not compatible with " + str(count) +
+                             " sockets")
+        else:
+            sockets = [cached[(port, 'group', i)] for i in range(count)]
+        # Check all of them are compatible before handing out any token
+        for socket in sockets:
+            if not socket.share_compatible(share_mode, share_name):
+                raise ShareError("Cached socket not compatible with mode " +
+                                 share_mode + " and name " + share_name)
+        return [self.__add_token(socket, share_mode, share_name)
+                for socket in sockets]
+
     def get_socket(self, token, application):
         """
         This returns the socket created by get_token. The token should be the
@@ -271,9 +337,8 @@ class Cache:
         # The socket is not used by anything now, so remove it
         if len(socket.active_tokens) == 0 and len(socket.waiting_tokens) == 0:
             addr = str(socket.address)
-            port = socket.port
             proto = socket.protocol
-            del self._sockets[proto][addr][port]
+            del self._sockets[proto][addr][socket.key]
             # Clean up empty branches of the structure
             if len(self._sockets[proto][addr]) == 0:
                 del self._sockets[proto][addr]
@@ -253,6 +253,54 @@ class ParserTests(unittest.TestCase):
         self.__create('2001:db8::', socket.SOCK_STREAM,
             b'T6\0\x2A\x20\x01\x0d\xb8\0\0\0\0\0\0\0\0\0\0\0\0')
 
+    def test_create_group(self):
+        """
+        Test a group of sockets is requested and received.
+        """
+        request = b'GU4\0\x2A\xC0\0\x02\0' + struct.pack('H', 2)
+        creator = FakeCreator([('s', request + struct.pack('2i', 0, 3)),
+                               ('r', b'S'), ('f', 42), ('f', 43)])
+        parser = Parser(creator)
+        self.assertEqual([42, 43],
+                         parser.get_socket_group(IPAddr('192.0.2.0'), 42,
+                                                 'UDP', 2, [0, 3]))
+        self.assertTrue(creator.all_used())
+
+        # Without CPUs
+        creator = FakeCreator([('s', request + struct.pack('2i', -1, -1)),
+                               ('r', b'S'), ('f', 42), ('f', 43)])
+        parser = Parser(creator)
+        self.assertEqual([42, 43],
+                         parser.get_socket_group(IPAddr('192.0.2.0'), 42,
+                                                 'UDP', 2))
+        self.assertTrue(creator.all_used())
+
+    def test_create_group_error(self):
+        """
+        Test the errors of a group are handled as for a single socket.
+        """
+        creator = FakeCreator([('s', b'GT4\0\0\0\0\0\0' +
+                                struct.pack('H', 1) + struct.pack('i', -1)),
+                               ('r', b'EB' + struct.pack('@i', 98))])
+        parser = Parser(creator)
+        try:
+            parser.get_socket_group(IPAddr('0.0.0.0'), 0, 'TCP', 1)
+            self.fail("Not raised")
+        except CreatorError as ce:
+            self.assertTrue(creator.all_used())
+            self.assertFalse(ce.fatal)
+            self.assertEqual(98, ce.errno)
+
+        # Invalid numbers of sockets or CPUs are rejected before sending
+        # anything.
+        parser = Parser(FakeCreator([]))
+        self.assertRaises(ValueError, parser.get_socket_group,
+                          IPAddr('0.0.0.0'), 0, 'UDP', 0)
+        self.assertRaises(ValueError, parser.get_socket_group,
+                          IPAddr('0.0.0.0'), 0, 'UDP', 1025)
+        self.assertRaises(ValueError, parser.get_socket_group,
+                          IPAddr('0.0.0.0'), 0, 'UDP', 2, [0])
+
     def test_create_terminated(self):
         """
         Test we can't request sockets after it was terminated.
@@ -248,6 +248,87 @@ class SocketCacheTest(Test):
                           self.__cache.get_token, 'UDP', self.__address, 1024,
                           'NO', 'test')
 
+    def get_socket_group(self, address, port, socktype, count, cpus):
+        """
+        Pretend to be a socket creator, for a group of sockets.
+
+        This expects to be called with the _address, port 1024 and 'UDP'.
+
+        Returns file descriptors from 50 and notes down it was called.
+        """
+        self.assertEqual(self.__address, address)
+        self.assertEqual(1024, port)
+        self.assertEqual('UDP', socktype)
+        self.__get_socket_group_args = (count, cpus)
+        return list(range(50, 50 + count))
+
+    def test_get_group_tokens(self):
+        """
+        Check the tokens of a group of sockets are handed out, with the group
+        cached.
+        """
+        self.__get_socket_group_args = None
+        tokens = self.__cache.get_group_tokens('UDP', self.__address, 1024,
+                                               2, 'SAMEAPP', 'test', [0, 1])
+        self.assertEqual((2, [0, 1]), self.__get_socket_group_args)
+        self.assertEqual(2, len(tokens))
+        sockets = [self.__cache._waiting_tokens[token] for token in tokens]
+        self.assertEqual([50, 51], [socket.fileno for socket in sockets])
+        self.assertEqual({
+            'UDP': {'192.0.2.1': {(1024, 'group', 0): sockets[0],
+                                  (1024, 'group', 1): sockets[1]}}
+        }, self.__cache._sockets)
+        self.assertEqual(set(tokens), self.__cache._live_tokens)
+
+        # The same group is reused from the cache
+        self.__get_socket_group_args = None
+        tokens2 = self.__cache.get_group_tokens('UDP', self.__address, 1024,
+                                                2, 'SAMEAPP', 'test')
+        self.assertIsNone(self.__get_socket_group_args)
+        self.assertEqual(sockets, [self.__cache._waiting_tokens[token]
+                                   for token in tokens2])
+
+        # But not with a different size or share mode
+        self.assertRaises(bundy.bundy.socket_cache.ShareError,
+                          self.__cache.get_group_tokens, 'UDP',
+                          self.__address, 1024, 3, 'SAMEAPP', 'test')
+        self.assertRaises(bundy.bundy.socket_cache.ShareError,
+                          self.__cache.get_group_tokens, 'UDP',
+                          self.__address, 1024, 2, 'NO', 'test')
+        self.assertEqual(set(tokens + tokens2), self.__cache._live_tokens)
+
+        # Once all the tokens of a socket are dropped, it's removed from
+        # the cache by its key
+        for token in tokens + tokens2:
+            self.__cache.get_socket(token, 1)
+        self.__cache.drop_socket(tokens[0])
+        self.__cache.drop_socket(tokens2[0])
+        self.assertEqual({
+            'UDP': {'192.0.2.1': {(1024, 'group', 1): sockets[1]}}
+        }, self.__cache._sockets)
+        # The rest of the group can't be handed out any more
+        self.assertRaises(bundy.bundy.socket_cache.ShareError,
+                          self.__cache.get_group_tokens, 'UDP',
+                          self.__address, 1024, 2, 'SAMEAPP', 'test')
+
+    def test_get_group_tokens_excs(self):
+        """
+        Test the socket creator errors are handled as for get_token.
+        """
+        def raiseCreatorError(fatal):
+            raise bundy.bundy.sockcreator.CreatorError('test error', fatal)
+        self.get_socket_group = lambda addr, port, proto, count, cpus: \
+            raiseCreatorError(True)
+        self.assertRaises(bundy.bundy.sockcreator.CreatorError,
+                          self.__cache.get_group_tokens, 'UDP',
+                          self.__address, 1024, 2, 'NO', 'test')
+        self.get_socket_group = lambda addr, port, proto, count, cpus: \
+            raiseCreatorError(False)
+        self.assertRaises(bundy.bundy.socket_cache.SocketError,
+                          self.__cache.get_group_tokens, 'UDP',
+                          self.__address, 1024, 2, 'NO', 'test')
+        self.assertEqual({}, self.__cache._sockets)
+
     def test_get_socket(self):
         """
         Test that we can pickup a socket if we know a token.
@@ -15,7 +15,9 @@
 
 #
 # Functions for reading and parsing cc messages
-# Currently these are only abstraction functions for JSON conversion.
+# These are abstraction functions for JSON conversion, and for the binary
+# wire format that C++ modules may use for payloads (see
+# bundy::data::Element::toBinaryWire()).
 #
 
 import sys
@@ -23,6 +25,19 @@ import struct
 
 import json
 
+# The first byte of the binary wire format; it can't start JSON text.
+BINARY_WIRE_MARKER = 0xb1
+
+# The type bytes of the binary wire format
+_BINARY_NULL = 0
+_BINARY_FALSE = 1
+_BINARY_TRUE = 2
+_BINARY_INTEGER = 3
+_BINARY_REAL = 4
+_BINARY_STRING = 5
+_BINARY_LIST = 6
+_BINARY_MAP = 7
+
 def to_wire(items):
     '''Encodes the given python structure in JSON, and converts the
        result to bytes. Raises a TypeError if the given structure is
@@ -37,6 +52,139 @@ def from_wire(data):
        '''
     return json.loads(data.decode('utf8'), strict=False)
 
+def is_binary_wire(data):
+    '''Returns True if the given bytes are in the binary wire format
+       (as opposed to JSON).'''
+    return len(data) > 0 and data[0] == BINARY_WIRE_MARKER
+
+def _put_varint(out, value):
+    while value >= 0x80:
+        out.append((value & 0x7f) | 0x80)
+        value >>= 7
+    out.append(value)
+
+def _put_string(out, value):
+    data = value.encode('utf8')
+    _put_varint(out, len(data))
+    out.extend(data)
+
+def _put_item(out, item):
+    # bool is a subclass of int, so it's checked first
+    if item is None:
+        out.append(_BINARY_NULL)
+    elif item is True:
+        out.append(_BINARY_TRUE)
+    elif item is False:
+        out.append(_BINARY_FALSE)
+    elif isinstance(item, int):
+        if item < -2**63 or item >= 2**63:
+            raise TypeError("Integer out of range: " + str(item))
+        out.append(_BINARY_INTEGER)
+        _put_varint(out, ((item << 1) ^ (item >> 63)) & 0xffffffffffffffff)
+    elif isinstance(item, float):
+        out.append(_BINARY_REAL)
+        out.extend(struct.pack('>d', item))
+    elif isinstance(item, str):
+        out.append(_BINARY_STRING)
+        _put_string(out, item)
+    elif isinstance(item, (list, tuple)):
+        out.append(_BINARY_LIST)
+        _put_varint(out, len(item))
+        for child in item:
+            _put_item(out, child)
+    elif isinstance(item, dict):
+        out.append(_BINARY_MAP)
+        _put_varint(out, len(item))
+        for key, child in item.items():
+            if not isinstance(key, str):
+                raise TypeError("Map key is not a string: " + str(key))
+            _put_string(out, key)
+            _put_item(out, child)
+    else:
+        raise TypeError("Can't encode " + str(type(item)))
+
+def to_binary_wire(items):
+    '''Encodes the given python structure in the binary wire format.
+       Raises a TypeError if the given structure can't be encoded.'''
+    out = bytearray([BINARY_WIRE_MARKER])
+    _put_item(out, items)
+    return bytes(out)
+
+class _BinaryWireReader:
+    def __init__(self, data):
+        self.__data = data
+        self.__pos = 1
+
+    def at_end(self):
+        return self.__pos == len(self.__data)
+
+    def __get_byte(self):
+        if self.__pos >= len(self.__data):
+            raise ValueError("Binary wire format is truncated")
+        self.__pos += 1
+        return self.__data[self.__pos - 1]
+
+    def __get_varint(self):
+        value = 0
+        for shift in range(0, 64, 7):
+            byte = self.__get_byte()
+            value |= (byte & 0x7f) << shift
+            if byte & 0x80 == 0:
+                return value & 0xffffffffffffffff
+        raise ValueError("Binary wire format integer is too long")
+
+    def __get_size(self):
+        size = self.__get_varint()
+        if size > len(self.__data) - self.__pos:
+            raise ValueError("Binary wire format size is too large")
+        return size
+
+    def __get_string(self):
+        size = self.__get_size()
+        self.__pos += size
+        return self.__data[self.__pos - size:self.__pos].decode('utf8')
+
+    def get_item(self):
+        item_type = self.__get_byte()
+        if item_type == _BINARY_NULL:
+            return None
+        elif item_type == _BINARY_FALSE:
+            return False
+        elif item_type == _BINARY_TRUE:
+            return True
+        elif item_type == _BINARY_INTEGER:
+            value = self.__get_varint()
+            return (value >> 1) ^ -(value & 1)
+        elif item_type == _BINARY_REAL:
+            if len(self.__data) - self.__pos < 8:
+                raise ValueError("Binary wire format is truncated")
+            self.__pos += 8
+            return struct.unpack('>d', self.__data[self.__pos - 8:
+                                                   self.__pos])[0]
+        elif item_type == _BINARY_STRING:
+            return self.__get_string()
+        elif item_type == _BINARY_LIST:
+            return [self.get_item() for _ in range(self.__get_size())]
+        elif item_type == _BINARY_MAP:
+            result = {}
+            for _ in range(self.__get_size()):
+                key = self.__get_string()
+                result[key] = self.get_item()
+            return result
+        raise ValueError("Unknown type in binary wire format: " +
+                         str(item_type))
+
+def from_binary_wire(data):
+    '''Decodes the given bytes in the binary wire format.  Raises a
+       ValueError if the data is not valid binary wire format.'''
+    if not is_binary_wire(data):
+        raise ValueError("Not in binary wire format")
+    reader = _BinaryWireReader(data)
+    result = reader.get_item()
+    if not reader.at_end():
+        raise ValueError("Trailing data after binary wire format")
+    return result
+
 if __name__ == "__main__":
     import doctest
     doctest.testmod()
@@ -60,6 +60,40 @@ class MessageTest(unittest.TestCase):
         self.assertRaises(ValueError, bundy.cc.message.from_wire, b'[ 1 ')
         self.assertRaises(ValueError, bundy.cc.message.from_wire, b']')
 
+    def test_binary_wire(self):
+        for msg in [ self.msg1, self.msg2, self.msg3, self.msg_float, None,
+                     -1, 2**63 - 1, -2**63, "", {} ]:
+            wire = bundy.cc.message.to_binary_wire(msg)
+            self.assertTrue(bundy.cc.message.is_binary_wire(wire))
+            self.assertEqual(msg, bundy.cc.message.from_binary_wire(wire))
+
+        # This is the same as the C++ version produces.
+        self.assertEqual(b'\xb1\x07\x01\x01a\x06\x02\x03\x02\x05\x01b',
+                         bundy.cc.message.to_binary_wire({ "a": [ 1, "b" ] }))
+
+        self.assertFalse(bundy.cc.message.is_binary_wire(self.msg1_wire))
+        self.assertFalse(bundy.cc.message.is_binary_wire(b''))
+        self.assertRaises(TypeError, bundy.cc.message.to_binary_wire, 2**63)
+        self.assertRaises(TypeError, bundy.cc.message.to_binary_wire,
+                          { 1: 2 })
+        self.assertRaises(TypeError, bundy.cc.message.to_binary_wire,
+                          NotImplemented)
+
+        # Malformed data: not binary, truncated, trailing garbage, unknown
+        # type and too large size.
+        wire = bundy.cc.message.to_binary_wire(self.msg3)
+        self.assertRaises(ValueError, bundy.cc.message.from_binary_wire,
+                          self.msg1_wire)
+        for length in range(1, len(wire)):
+            self.assertRaises(ValueError, bundy.cc.message.from_binary_wire,
+                              wire[:length])
+        self.assertRaises(ValueError, bundy.cc.message.from_binary_wire,
+                          wire + b'\x00')
+        self.assertRaises(ValueError, bundy.cc.message.from_binary_wire,
+                          b'\xb1\x08')
+        self.assertRaises(ValueError, bundy.cc.message.from_binary_wire,
+                          b'\xb1\x05\x7fa')
+
 if __name__ == '__main__':
     unittest.main()
 
@@ -181,10 +181,14 @@ DataSourceClient_getIterator(PyObject* po_self, PyObject* args) {
                     return (NULL);
                 }
             }
-            return (createZoneIteratorObject(
-                self->client->getIterator(PyName_ToName(name_obj),
-                                                        separate_rrs),
-                po_self));
+            const bundy::dns::Name& name = PyName_ToName(name_obj);
+            ZoneIteratorPtr iterator;
+            {
+                // Getting the iterator can involve a database query.
+                GILReleaser releaser;
+                iterator = self->client->getIterator(name, separate_rrs);
+            }
+            return (createZoneIteratorObject(iterator, po_self));
         } catch (const bundy::NotImplemented& ne) {
             PyErr_SetString(getDataSourceException("NotImplemented"),
                             ne.what());
@@ -217,9 +221,13 @@ DataSourceClient_getUpdater(PyObject* po_self, PyObject* args) {
         const bool replace = (replace_obj != Py_False);
         const bool journaling = (journaling_obj == Py_True);
         try {
-            ZoneUpdaterPtr updater =
-                self->client->getUpdater(PyName_ToName(name_obj),
-                                                       replace, journaling);
+            const bundy::dns::Name& name = PyName_ToName(name_obj);
+            ZoneUpdaterPtr updater;
+            {
+                // This may wait for a database lock.
+                GILReleaser releaser;
+                updater = self->client->getUpdater(name, replace, journaling);
+            }
             if (!updater) {
                 return (Py_None);
             }
@@ -262,10 +270,14 @@ DataSourceClient_getJournalReader(PyObject* po_self, PyObject* args) {
     if (PyArg_ParseTuple(args, "O!kk", &name_type, &name_obj,
                          &begin_obj, &end_obj)) {
         try {
-            pair<ZoneJournalReader::Result, ZoneJournalReaderPtr> result =
-                self->client->getJournalReader(
-                    PyName_ToName(name_obj), static_cast<uint32_t>(begin_obj),
+            const bundy::dns::Name& name = PyName_ToName(name_obj);
+            pair<ZoneJournalReader::Result, ZoneJournalReaderPtr> result;
+            {
+                GILReleaser releaser;
+                result = self->client->getJournalReader(
+                    name, static_cast<uint32_t>(begin_obj),
                     static_cast<uint32_t>(end_obj));
+            }
             PyObject* po_reader;
             if (result.first == ZoneJournalReader::SUCCESS) {
                 po_reader = createZoneJournalReaderObject(result.second,
@@ -36,6 +36,7 @@
 #include "zonetable_accessor_python.h"
 #include "zonetable_iterator_python.h"
 #include "zonewriter_python.h"
+#include "zone_transfer_python.h"
 
 #include <util/python/pycppwrapper_util.h>
 #include <dns/python/pydnspp_common.h>
@@ -182,6 +183,9 @@ initModulePart_ZoneIterator(PyObject* mod) {
     if (PyType_Ready(&zoneiterator_type) < 0) {
         return (false);
     }
+    if (PyType_Ready(&rrsetwirebuffer_type) < 0) {
+        return (false);
+    }
     void* zip = &zoneiterator_type;
     if (PyModule_AddObject(mod, "ZoneIterator", static_cast<PyObject*>(zip)) < 0) {
         return (false);
@@ -300,14 +304,28 @@ PyObject* po_MasterFileError;
 PyObject* po_NotImplemented;
 PyObject* po_OutOfZone;
 
+PyMethodDef methods[] = {
+    { "send_zone_transfer", sendZoneTransfer, METH_VARARGS,
+      send_zone_transfer_doc },
+    { "receive_axfr", receiveAXFR, METH_VARARGS, receive_axfr_doc },
+    { NULL, NULL, 0, NULL }
+};
+
 PyModuleDef iscDataSrc = {
     { PyObject_HEAD_INIT(NULL) NULL, 0, NULL},
     "datasrc",
     "Python bindings for the classes in the bundy::datasrc namespace.\n\n"
     "These bindings are close match to the C++ API, but they are not complete "
-    "(some parts are not needed) and some are done in more python-like ways.",
+    "(some parts are not needed) and some are done in more python-like ways."
+    "\n\n"
+    "Calls which may take long or block, like loading zones, transferring "
+    "them, iterating over them, reading journals or getting and committing "
+    "updaters, release the global interpreter lock, so other threads can run "
+    "meanwhile.  A client may be used by several threads, but an iterator, "
+    "journal reader, updater, loader or writer must only be used by one "
+    "thread at a time.",
     -1,
-    NULL,
+    methods,
     NULL,
     NULL,
     NULL,
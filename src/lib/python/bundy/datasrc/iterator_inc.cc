@@ -46,6 +46,70 @@ Raises an bundy.datasrc.Error exception if it is called again after returning\n\
 None\n\
 ";
 
+const char* const ZoneIterator_getNextRRsetsWire_doc = "\
+get_next_rrsets_wire([size_hint]) -> (memoryview, integer)\n\
+\n\
+Get the next RRsets from the zone in the wire format.\n\
+\n\
+This reads RRsets from the iterator, like get_next_rrset() does, and\n\
+renders them without name compression into a single buffer, until the\n\
+buffer is at least size_hint bytes long or the end of the zone is\n\
+reached. The buffer contains at least one RRset, so it can be longer\n\
+than size_hint.\n\
+\n\
+No RRset object is created for the RRsets. The returned memoryview is\n\
+read-only and refers directly to the rendered data; for in-memory zones\n\
+it is rendered directly from the shared memory segment. This is meant\n\
+for streaming a large zone from Python code, e.g. for a zone transfer.\n\
+\n\
+The RRsets and their order are the same as what get_next_rrset() would\n\
+return, and the two methods can be mixed.\n\
+\n\
+Exceptions:\n\
+  bundy.datasrc.Error The data can't be read or rendered, or this is\n\
+                      called again after returning None.\n\
+  ValueError       size_hint is 0.\n\
+\n\
+Parameters:\n\
+  size_hint  The minimum size of the data to be returned unless the end\n\
+             of the zone is reached (default 16384).\n\
+\n\
+Return Value(s): A tuple of a memoryview of the data and the number of\n\
+RRs (not RRsets) in it, which can be used as the answer count of a DNS\n\
+message; or None when the iteration gets to the end of the zone.\n\
+";
+
+const char* const ZoneIterator_getNextRRsetsText_doc = "\
+get_next_rrsets_text([size_hint]) -> (string, integer)\n\
+\n\
+Get the next RRsets from the zone in the master file format.\n\
+\n\
+This reads RRsets from the iterator, like get_next_rrset() does, and\n\
+returns their text, until it is at least size_hint characters long or\n\
+the end of the zone is reached. The text contains at least one RRset,\n\
+so it can be longer than size_hint.\n\
+\n\
+The text is the same as the concatenated to_text() of the RRsets (with\n\
+their RRSIGs, if any), but no RRset object is created and the text is\n\
+formatted directly into a reused buffer. This is meant for dumping a\n\
+large zone to a file from Python code.\n\
+\n\
+The RRsets and their order are the same as what get_next_rrset() would\n\
+return, and the two methods can be mixed.\n\
+\n\
+Exceptions:\n\
+  bundy.datasrc.Error The data can't be read or rendered, or this is\n\
+                      called again after returning None.\n\
+  ValueError       size_hint is 0.\n\
+\n\
+Parameters:\n\
+  size_hint  The minimum size of the text to be returned unless the end\n\
+             of the zone is reached (default 65536).\n\
+\n\
+Return Value(s): A tuple of the text and the number of RRs (not RRsets)\n\
+in it; or None when the iteration gets to the end of the zone.\n\
+";
+
 // Modifications:
 //  - ConstRRset->RRset
 //  - NULL->None
@@ -20,6 +20,7 @@
 // http://docs.python.org/py3k/extending/extending.html#a-simple-example
 #include <Python.h>
 
+#include <util/buffer.h>
 #include <util/python/pycppwrapper_util.h>
 
 #include <datasrc/client.h>
@@ -27,6 +28,7 @@
 #include <datasrc/sqlite3_accessor.h>
 #include <datasrc/zone_iterator.h>
 
+#include <dns/master_text_renderer.h>
 #include <dns/python/name_python.h>
 #include <dns/python/rrset_python.h>
 
@@ -36,6 +38,7 @@
 #include "iterator_inc.cc"
 
 using namespace std;
+using namespace bundy::util;
 using namespace bundy::util::python;
 using namespace bundy::dns::python;
 using namespace bundy::datasrc;
@@ -45,7 +48,10 @@ namespace {
 // The s_* Class simply covers one instantiation of the object
 class s_ZoneIterator : public PyObject {
 public:
-    s_ZoneIterator() : cppobj(ZoneIteratorPtr()), base_obj(NULL) {};
+    s_ZoneIterator() :
+        cppobj(ZoneIteratorPtr()), base_obj(NULL), end_pending(false),
+        text_renderer(NULL), text_end(false)
+    {};
     ZoneIteratorPtr cppobj;
     // This is a reference to a base object; if the object of this class
     // depends on another object to be in scope during its lifetime,
@@ -53,6 +59,25 @@ public:
     // the end of the destructor
     // This is an optional argument to createXXX(). If NULL, it is ignored.
     PyObject* base_obj;
+    // Set when get_next_rrsets_wire() or get_next_rrsets_text() reached
+    // the end of the zone but returned the last RRsets; the next call of
+    // them or get_next_rrset() returns None instead of reading the
+    // (exhausted) C++ iterator.
+    bool end_pending;
+    // The renderer of get_next_rrsets_text(), created on its first call and
+    // reused so its buffer is only allocated once.
+    bundy::dns::MasterTextRenderer* text_renderer;
+    // Set when get_next_rrsets_text() got to the end of the zone.  The C++
+    // iterator then keeps returning no RRs, but calling it again after
+    // None is an error for Python, as for get_next_rrsets_wire().
+    bool text_end;
+};
+
+// The read-only buffer of the RRsets rendered by get_next_rrsets_wire().
+// It's only exposed to Python as a memoryview of its buffer.
+class s_RRsetWireBuffer : public PyObject {
+public:
+    OutputBuffer* buffer;
 };
 
 // Shortcut type which would be convenient for adding class variables safely.
@@ -74,6 +99,8 @@ ZoneIterator_destroy(s_ZoneIterator* const self) {
     // cppobj is a shared ptr, but to make sure things are not destroyed in
     // the wrong order, we reset it here.
     self->cppobj.reset();
+    delete self->text_renderer;
+    self->text_renderer = NULL;
     if (self->base_obj != NULL) {
         Py_DECREF(self->base_obj);
     }
@@ -92,8 +119,16 @@ ZoneIterator_getNextRRset(PyObject* po_self, PyObject*) {
                         "get_next_rrset() called past end of iterator");
         return (NULL);
     }
+    if (self->end_pending) {
+        self->end_pending = false;
+        Py_RETURN_NONE;
+    }
     try {
-        bundy::dns::ConstRRsetPtr rrset = self->cppobj->getNextRRset();
+        bundy::dns::ConstRRsetPtr rrset;
+        {
+            GILReleaser releaser;
+            rrset = self->cppobj->getNextRRset();
+        }
         if (!rrset) {
             Py_RETURN_NONE;
         }
@@ -114,6 +149,154 @@ ZoneIterator_getNextRRset(PyObject* po_self, PyObject*) {
     }
 }
 
+// The default of the size_hint argument of get_next_rrsets_wire(); together
+// with the header and question it fits TCP DNS messages of 64KB.
+const unsigned int WIRE_SIZE_HINT_DEFAULT = 16384;
+
+PyObject*
+ZoneIterator_getNextRRsetsWire(PyObject* po_self, PyObject* args) {
+    s_ZoneIterator* self = static_cast<s_ZoneIterator*>(po_self);
+    unsigned int size_hint = WIRE_SIZE_HINT_DEFAULT;
+    if (!PyArg_ParseTuple(args, "|I", &size_hint)) {
+        return (NULL);
+    }
+    if (size_hint == 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "size_hint of get_next_rrsets_wire() must be "
+                        "positive");
+        return (NULL);
+    }
+    if (!self->cppobj) {
+        PyErr_SetString(getDataSourceException("Error"),
+                        "get_next_rrsets_wire() called past end of iterator");
+        return (NULL);
+    }
+    if (self->end_pending) {
+        self->end_pending = false;
+        Py_RETURN_NONE;
+    }
+    try {
+        // The RRsets are rendered directly into the buffer that the
+        // returned memoryview refers to; for in-memory zones this also
+        // avoids building an Rdata object for each RR.
+        s_RRsetWireBuffer* py_buffer = static_cast<s_RRsetWireBuffer*>(
+            rrsetwirebuffer_type.tp_alloc(&rrsetwirebuffer_type, 0));
+        if (py_buffer == NULL) {
+            return (NULL);
+        }
+        py_buffer->buffer = NULL;
+        PyObjectContainer buffer_container(py_buffer);
+        py_buffer->buffer = new OutputBuffer(size_hint);
+        OutputBuffer* const buffer = py_buffer->buffer;
+        unsigned int rr_count = 0;
+        bool end = false;
+        {
+            // Nothing but C++ objects is used in the loop.
+            GILReleaser releaser;
+            while (buffer->getLength() < size_hint) {
+                bundy::dns::ConstRRsetPtr rrset = self->cppobj->getNextRRset();
+                if (!rrset) {
+                    end = true;
+                    break;
+                }
+                rr_count += rrset->toWire(*buffer);
+            }
+        }
+        if (end) {
+            if (buffer->getLength() == 0) {
+                Py_RETURN_NONE;
+            }
+            self->end_pending = true;
+        }
+
+        // The memoryview holds the only reference to the buffer object.
+        PyObjectContainer view_container(
+            PyMemoryView_FromObject(buffer_container.get()));
+        return (Py_BuildValue("(OI)", view_container.get(), rr_count));
+    } catch (const PyCPPWrapperException&) {
+        // A Python exception is already set by the container.
+        return (NULL);
+    } catch (const bundy::Exception& isce) {
+        PyErr_SetString(getDataSourceException("Error"), isce.what());
+        return (NULL);
+    } catch (const std::exception& exc) {
+        PyErr_SetString(getDataSourceException("Error"), exc.what());
+        return (NULL);
+    } catch (...) {
+        PyErr_SetString(getDataSourceException("Error"),
+                        "Unexpected exception");
+        return (NULL);
+    }
+}
+
+// The default of the size_hint argument of get_next_rrsets_text().
+const unsigned int TEXT_SIZE_HINT_DEFAULT = 65536;
+
+PyObject*
+ZoneIterator_getNextRRsetsText(PyObject* po_self, PyObject* args) {
+    s_ZoneIterator* self = static_cast<s_ZoneIterator*>(po_self);
+    unsigned int size_hint = TEXT_SIZE_HINT_DEFAULT;
+    if (!PyArg_ParseTuple(args, "|I", &size_hint)) {
+        return (NULL);
+    }
+    if (size_hint == 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "size_hint of get_next_rrsets_text() must be "
+                        "positive");
+        return (NULL);
+    }
+    if (!self->cppobj || (self->text_end && !self->end_pending)) {
+        PyErr_SetString(getDataSourceException("Error"),
+                        "get_next_rrsets_text() called past end of iterator");
+        return (NULL);
+    }
+    if (self->end_pending) {
+        self->end_pending = false;
+        Py_RETURN_NONE;
+    }
+    try {
+        if (self->text_renderer == NULL) {
+            self->text_renderer =
+                new bundy::dns::MasterTextRenderer(size_hint);
+        }
+        bundy::dns::MasterTextRenderer& renderer = *self->text_renderer;
+        renderer.clear();
+        size_t rr_count;
+        {
+            // Nothing but C++ objects is used in the loop.
+            GILReleaser releaser;
+            rr_count = self->cppobj->getNextRRsText(renderer, size_hint);
+        }
+        if (renderer.getLength() == 0) {
+            self->text_end = true;
+            Py_RETURN_NONE;
+        }
+        // The iterator only stops short of the hint at the end of the zone.
+        if (renderer.getLength() < size_hint) {
+            self->end_pending = true;
+            self->text_end = true;
+        }
+        PyObjectContainer text_container(
+            PyUnicode_FromStringAndSize(renderer.getData(),
+                                        renderer.getLength()));
+        return (Py_BuildValue("(OI)", text_container.get(),
+                              static_cast<unsigned int>(rr_count)));
+    } catch (const PyCPPWrapperException&) {
+        // A Python exception is already set by the container.
+        return (NULL);
+    } catch (const bundy::Exception& isce) {
+        PyErr_SetString(getDataSourceException("Error"), isce.what());
+        return (NULL);
+    } catch (const std::exception& exc) {
+        PyErr_SetString(getDataSourceException("Error"), exc.what());
+        return (NULL);
+    } catch (...) {
+        PyErr_SetString(getDataSourceException("Error"),
+                        "Unexpected exception");
+        return (NULL);
+    }
+}
+
 PyObject*
 ZoneIterator_iter(PyObject *self) {
     Py_INCREF(self);
@@ -161,9 +344,34 @@ PyMethodDef ZoneIterator_methods[] = {
     { "get_next_rrset", ZoneIterator_getNextRRset, METH_NOARGS,
       ZoneIterator_getNextRRset_doc },
     { "get_soa", ZoneIterator_getSOA, METH_NOARGS, ZoneIterator_getSOA_doc },
+    { "get_next_rrsets_wire", ZoneIterator_getNextRRsetsWire, METH_VARARGS,
+      ZoneIterator_getNextRRsetsWire_doc },
+    { "get_next_rrsets_text", ZoneIterator_getNextRRsetsText, METH_VARARGS,
+      ZoneIterator_getNextRRsetsText_doc },
     { NULL, NULL, 0, NULL }
 };
 
+void
+RRsetWireBuffer_destroy(s_RRsetWireBuffer* const self) {
+    delete self->buffer;
+    self->buffer = NULL;
+    Py_TYPE(self)->tp_free(self);
+}
+
+int
+RRsetWireBuffer_getBuffer(PyObject* po_self, Py_buffer* view, int flags) {
+    const s_RRsetWireBuffer* const self =
+        static_cast<s_RRsetWireBuffer*>(po_self);
+    return (PyBuffer_FillInfo(view, po_self,
+                              const_cast<void*>(self->buffer->getData()),
+                              self->buffer->getLength(), 1, flags));
+}
+
+PyBufferProcs RRsetWireBuffer_as_buffer = {
+    RRsetWireBuffer_getBuffer,          // bf_getbuffer
+    NULL                                // bf_releasebuffer
+};
+
 
 } // end of unnamed namespace
 
@@ -221,6 +429,57 @@ PyTypeObject zoneiterator_type = {
     BUNDY_UTIL_PYTHON_PyVarObject_TAIL_INIT
 };
 
+PyTypeObject rrsetwirebuffer_type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "datasrc.RRsetWireBuffer",
+    sizeof(s_RRsetWireBuffer),          // tp_basicsize
+    0,                                  // tp_itemsize
+    reinterpret_cast<destructor>(RRsetWireBuffer_destroy),// tp_dealloc
+    NULL,                               // tp_print
+    NULL,                               // tp_getattr
+    NULL,                               // tp_setattr
+    NULL,                               // tp_reserved
+    NULL,                               // tp_repr
+    NULL,                               // tp_as_number
+    NULL,                               // tp_as_sequence
+    NULL,                               // tp_as_mapping
+    NULL,                               // tp_hash
+    NULL,                               // tp_call
+    NULL,                               // tp_str
+    NULL,                               // tp_getattro
+    NULL,                               // tp_setattro
+    &RRsetWireBuffer_as_buffer,         // tp_as_buffer
+    Py_TPFLAGS_DEFAULT,                 // tp_flags
+    "Wire-format RRsets rendered by ZoneIterator.get_next_rrsets_wire()",
+    NULL,                               // tp_traverse
+    NULL,                               // tp_clear
+    NULL,                               // tp_richcompare
+    0,                                  // tp_weaklistoffset
+    NULL,                               // tp_iter
+    NULL,                               // tp_iternext
+    NULL,                               // tp_methods
+    NULL,                               // tp_members
+    NULL,                               // tp_getset
+    NULL,                               // tp_base
+    NULL,                               // tp_dict
+    NULL,                               // tp_descr_get
+    NULL,                               // tp_descr_set
+    0,                                  // tp_dictoffset
+    NULL,                               // tp_init
+    NULL,                               // tp_alloc
+    NULL,                               // tp_new
+    NULL,                               // tp_free
+    NULL,                               // tp_is_gc
+    NULL,                               // tp_bases
+    NULL,                               // tp_mro
+    NULL,                               // tp_cache
+    NULL,                               // tp_subclasses
+    NULL,                               // tp_weaklist
+    NULL,                               // tp_del
+    0,                                  // tp_version_tag
+    BUNDY_UTIL_PYTHON_PyVarObject_TAIL_INIT
+};
+
 PyObject*
 createZoneIteratorObject(bundy::datasrc::ZoneIteratorPtr source,
                          PyObject* base_obj)
@@ -237,6 +496,24 @@ createZoneIteratorObject(bundy::datasrc::ZoneIteratorPtr source,
     return (py_zi);
 }
 
+bool
+PyZoneIterator_Check(PyObject* obj) {
+    if (obj == NULL) {
+        bundy_throw(PyCPPWrapperException, "obj argument NULL in typecheck");
+    }
+    return (PyObject_TypeCheck(obj, &zoneiterator_type));
+}
+
+ZoneIterator&
+PyZoneIterator_ToZoneIterator(PyObject* iterator_obj) {
+    if (iterator_obj == NULL) {
+        bundy_throw(PyCPPWrapperException,
+                    "argument NULL in ZoneIterator PyObject conversion");
+    }
+    s_ZoneIterator* iterator = static_cast<s_ZoneIterator*>(iterator_obj);
+    return (*iterator->cppobj);
+}
+
 } // namespace python
 } // namespace datasrc
 } // namespace bundy
@@ -25,6 +25,13 @@ namespace python {
 
 extern PyTypeObject zoneiterator_type;
 
+/// \brief The type of the buffers that ZoneIterator.get_next_rrsets_wire()
+/// renders RRsets into.
+///
+/// It's not added to the module; Python code only sees the memoryviews
+/// of its objects.
+extern PyTypeObject rrsetwirebuffer_type;
+
 /// \brief Create a ZoneIterator python object
 ///
 /// \param source The zone iterator pointer to wrap
@@ -35,6 +42,25 @@ extern PyTypeObject zoneiterator_type;
 PyObject* createZoneIteratorObject(bundy::datasrc::ZoneIteratorPtr source,
                                    PyObject* base_obj = NULL);
 
+/// \brief Checks if the given python object is a ZoneIterator object
+///
+/// \exception PyCPPWrapperException if obj is NULL
+///
+/// \param obj The object to check the type of
+/// \return true if the object is of type ZoneIterator, false otherwise
+bool PyZoneIterator_Check(PyObject* obj);
+
+/// \brief Returns a reference to the ZoneIterator object contained
+///        in the given Python object.
+///
+/// \note The given object MUST be of type ZoneIterator; this can be
+///       checked with either the right call to ParseTuple("O!"), or with
+///       PyZoneIterator_Check()
+///
+/// \param iterator_obj Python object holding the ZoneIterator
+/// \return reference to the ZoneIterator object
+bundy::datasrc::ZoneIterator&
+PyZoneIterator_ToZoneIterator(PyObject* iterator_obj);
 
 } // namespace python
 } // namespace datasrc
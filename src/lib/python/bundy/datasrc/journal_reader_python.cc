@@ -78,7 +78,11 @@ PyObject*
 ZoneJournalReader_getNextDiff(PyObject* po_self, PyObject*) {
     s_ZoneJournalReader* self = static_cast<s_ZoneJournalReader*>(po_self);
     try {
-        bundy::dns::ConstRRsetPtr rrset = self->cppobj->getNextDiff();
+        bundy::dns::ConstRRsetPtr rrset;
+        {
+            GILReleaser releaser;
+            rrset = self->cppobj->getNextDiff();
+        }
         if (!rrset) {
             Py_RETURN_NONE;
         }
@@ -196,6 +200,24 @@ createZoneJournalReaderObject(ZoneJournalReaderPtr source,
     return (po);
 }
 
+bool
+PyZoneJournalReader_Check(PyObject* obj) {
+    if (obj == NULL) {
+        bundy_throw(PyCPPWrapperException, "obj argument NULL in typecheck");
+    }
+    return (PyObject_TypeCheck(obj, &journal_reader_type));
+}
+
+ZoneJournalReader&
+PyZoneJournalReader_ToZoneJournalReader(PyObject* reader_obj) {
+    if (reader_obj == NULL) {
+        bundy_throw(PyCPPWrapperException,
+                    "argument NULL in ZoneJournalReader PyObject conversion");
+    }
+    s_ZoneJournalReader* reader = static_cast<s_ZoneJournalReader*>(reader_obj);
+    return (*reader->cppobj);
+}
+
 } // namespace python
 } // namespace datasrc
 } // namespace bundy
@@ -36,6 +36,25 @@ PyObject* createZoneJournalReaderObject(
     bundy::datasrc::ZoneJournalReaderPtr source,
     PyObject* base_obj = NULL);
 
+/// \brief Checks if the given python object is a ZoneJournalReader object
+///
+/// \exception PyCPPWrapperException if obj is NULL
+///
+/// \param obj The object to check the type of
+/// \return true if the object is of type ZoneJournalReader, false otherwise
+bool PyZoneJournalReader_Check(PyObject* obj);
+
+/// \brief Returns a reference to the ZoneJournalReader object contained
+///        in the given Python object.
+///
+/// \note The given object MUST be of type ZoneJournalReader; this can be
+///       checked with either the right call to ParseTuple("O!"), or with
+///       PyZoneJournalReader_Check()
+///
+/// \param reader_obj Python object holding the ZoneJournalReader
+/// \return reference to the ZoneJournalReader object
+bundy::datasrc::ZoneJournalReader&
+PyZoneJournalReader_ToZoneJournalReader(PyObject* reader_obj);
 
 } // namespace python
 } // namespace datasrc
@@ -25,7 +25,7 @@ RR_RDATA_INDEX = 7
 
 # Current major and minor versions of schema
 SCHEMA_MAJOR_VERSION = 2
-SCHEMA_MINOR_VERSION = 2
+SCHEMA_MINOR_VERSION = 3
 
 class Sqlite3DSError(Exception):
     """ Define exceptions."""
@@ -92,6 +92,13 @@ def create(cur):
                     rrtype TEXT NOT NULL COLLATE NOCASE,
                     ttl INTEGER NOT NULL,
                     rdata TEXT NOT NULL)""")
+        cur.execute("""CREATE TABLE journal (id INTEGER PRIMARY KEY,
+                    zone_id INTEGER NOT NULL,
+                    from_serial INTEGER NOT NULL,
+                    to_serial INTEGER NOT NULL,
+                    diffs BLOB NOT NULL)""")
+        cur.execute("""CREATE INDEX journal_byzone_and_serial ON journal
+                       (zone_id, from_serial)""")
         cur.execute("SELECT version FROM schema_version")
         row = cur.fetchone()
     cur.execute("COMMIT TRANSACTION")
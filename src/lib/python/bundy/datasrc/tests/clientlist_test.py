@@ -224,6 +224,35 @@ class ClientListTest(unittest.TestCase):
             zonelist.remove(zone)
         self.assertEqual(0, len(zonelist))
 
+        # the names can be read page by page, in the order of the names
+        expected = [bundy.dns.Name(zone) for zone in
+                    ['example.biz', 'example.com', 'example.edu',
+                     'example.net', 'example.org']]
+        table = self.clist.get_zone_table_accessor(None, True)
+        names = []
+        after = None
+        while True:
+            data, count, last = table.get_zone_names(2, after)
+            position = 0
+            for _ in range(count):
+                names.append(bundy.dns.Name(data, position))
+                position += names[-1].get_length()
+            self.assertEqual(len(data), position)
+            if count < 2:
+                break
+            self.assertEqual(names[-1], last)
+            after = last
+        self.assertEqual(expected, names)
+        self.assertEqual((b'', 0, None),
+                         table.get_zone_names(10, bundy.dns.Name('example.org')))
+        # it resumes after names that aren't in the table
+        self.assertEqual(expected[3],
+                         table.get_zone_names(1,
+                                              bundy.dns.Name('example.i'))[2])
+        # all of them fit in the default size
+        self.assertEqual(5, table.get_zone_names()[1])
+        self.assertRaises(TypeError, table.get_zone_names, 1, 'example.org')
+
     def test_find(self):
         """
         Test the find accepts the right arguments, some of them can be omitted,
@@ -24,6 +24,8 @@ import os
 import shutil
 import sys
 import json
+import socket
+import struct
 
 TESTDATA_PATH = os.environ['TESTDATA_PATH'] + os.sep
 TESTDATA_WRITE_PATH = os.environ['TESTDATA_WRITE_PATH'] + os.sep
@@ -285,6 +287,96 @@ class DataSrcClient(unittest.TestCase):
 
         self.assertRaises(TypeError, dsc.get_iterator, "asdf")
 
+    def test_iterate_wire(self):
+        dsc = bundy.datasrc.DataSourceClient("sqlite3", READ_ZONE_DB_CONFIG)
+        expected_wire = b''
+        expected_rr_count = 0
+        for rrset in dsc.get_iterator(bundy.dns.Name("example.com")):
+            expected_wire = rrset.to_wire(expected_wire)
+            expected_rr_count += rrset.get_rdata_count()
+
+        # Small chunks: each one has at least one RRset and the rest of
+        # the zone follows in the next one.
+        rrs = dsc.get_iterator(bundy.dns.Name("example.com"))
+        wire = b''
+        rr_count = 0
+        chunk_count = 0
+        result = rrs.get_next_rrsets_wire(512)
+        while result is not None:
+            view, count = result
+            self.assertTrue(view.readonly)
+            self.assertTrue(count > 0)
+            wire += view.tobytes()
+            rr_count += count
+            chunk_count += 1
+            result = rrs.get_next_rrsets_wire(512)
+        self.assertEqual(expected_wire, wire)
+        self.assertEqual(expected_rr_count, rr_count)
+        self.assertTrue(chunk_count > 1)
+        self.assertRaises(bundy.datasrc.Error, rrs.get_next_rrsets_wire)
+
+        # The whole zone fits in the default size.  None follows it, and
+        # then it's past the end.
+        rrs = dsc.get_iterator(bundy.dns.Name("example.com"))
+        view, count = rrs.get_next_rrsets_wire()
+        self.assertEqual(expected_wire, bytes(view))
+        self.assertEqual(expected_rr_count, count)
+        self.assertIsNone(rrs.get_next_rrset())
+        self.assertRaises(bundy.datasrc.Error, rrs.get_next_rrsets_wire)
+
+        # Mixing it with get_next_rrset() doesn't lose or repeat RRsets.
+        rrs = dsc.get_iterator(bundy.dns.Name("example.com"))
+        wire = rrs.get_next_rrset().to_wire(b'')
+        wire += rrs.get_next_rrsets_wire(1)[0].tobytes()
+        wire = rrs.get_next_rrset().to_wire(wire)
+        self.assertTrue(expected_wire.startswith(wire))
+
+        self.assertRaises(ValueError, rrs.get_next_rrsets_wire, 0)
+        self.assertRaises(TypeError, rrs.get_next_rrsets_wire, 'x')
+
+    def test_iterate_text(self):
+        dsc = bundy.datasrc.DataSourceClient("sqlite3", READ_ZONE_DB_CONFIG)
+        expected_text = ''
+        expected_rr_count = 0
+        for rrset in dsc.get_iterator(bundy.dns.Name("example.com")):
+            expected_text += rrset.to_text()
+            expected_rr_count += rrset.get_rdata_count()
+
+        # Small chunks, as for get_next_rrsets_wire().
+        rrs = dsc.get_iterator(bundy.dns.Name("example.com"))
+        text = ''
+        rr_count = 0
+        chunk_count = 0
+        result = rrs.get_next_rrsets_text(512)
+        while result is not None:
+            chunk, count = result
+            self.assertTrue(count > 0)
+            text += chunk
+            rr_count += count
+            chunk_count += 1
+            result = rrs.get_next_rrsets_text(512)
+        self.assertEqual(expected_text, text)
+        self.assertEqual(expected_rr_count, rr_count)
+        self.assertTrue(chunk_count > 1)
+        self.assertRaises(bundy.datasrc.Error, rrs.get_next_rrsets_text)
+
+        # The whole zone fits in the default size.
+        rrs = dsc.get_iterator(bundy.dns.Name("example.com"))
+        self.assertEqual((expected_text, expected_rr_count),
+                         rrs.get_next_rrsets_text())
+        self.assertIsNone(rrs.get_next_rrset())
+        self.assertRaises(bundy.datasrc.Error, rrs.get_next_rrsets_text)
+
+        # Mixing it with get_next_rrset() doesn't lose or repeat RRsets.
+        rrs = dsc.get_iterator(bundy.dns.Name("example.com"))
+        text = rrs.get_next_rrset().to_text()
+        text += rrs.get_next_rrsets_text(1)[0]
+        text += rrs.get_next_rrset().to_text()
+        self.assertTrue(expected_text.startswith(text))
+
+        self.assertRaises(ValueError, rrs.get_next_rrsets_text, 0)
+        self.assertRaises(TypeError, rrs.get_next_rrsets_text, 'x')
+
     def test_iterator_soa(self):
         dsc = bundy.datasrc.DataSourceClient("sqlite3", READ_ZONE_DB_CONFIG)
         iterator = dsc.get_iterator(bundy.dns.Name("sql1.example.com."))
@@ -951,6 +1043,134 @@ class JournalRead(unittest.TestCase):
         # ZoneJournalReader can only be constructed via a factory
         self.assertRaises(TypeError, ZoneJournalReader)
 
+class ZoneTransfer(unittest.TestCase):
+    def setUp(self):
+        self.dsc = bundy.datasrc.DataSourceClient("sqlite3",
+                                                  READ_ZONE_DB_CONFIG)
+        self.zname = Name('sql1.example.com')
+        self.question = Question(self.zname, RRClass.IN, RRType.AXFR)
+        self.sock, self.peer = socket.socketpair()
+
+    def tearDown(self):
+        self.sock.close()
+        self.peer.close()
+
+    def get_messages(self):
+        """Read all messages sent to self.peer and parse them."""
+        self.sock.shutdown(socket.SHUT_WR)
+        data = b''
+        while True:
+            chunk = self.peer.recv(4096)
+            if not chunk:
+                break
+            data += chunk
+        messages = []
+        while data:
+            msglen = struct.unpack('!H', data[:2])[0]
+            msg = Message(Message.PARSE)
+            msg.from_wire(data[2:2 + msglen], Message.PRESERVE_ORDER)
+            messages.append(msg)
+            data = data[2 + msglen:]
+        return messages
+
+    def test_send_zone(self):
+        iterator = self.dsc.get_iterator(self.zname)
+        soa = iterator.get_soa()
+        self.assertTrue(bundy.datasrc.send_zone_transfer(
+                self.sock.fileno(), 0x1035, Message.HEADERFLAG_RD,
+                self.question, None, soa, iterator, None))
+        messages = self.get_messages()
+        self.assertEqual(1, len(messages))
+        msg = messages[0]
+        self.assertEqual(0x1035, msg.get_qid())
+        self.assertTrue(msg.get_header_flag(Message.HEADERFLAG_QR))
+        self.assertTrue(msg.get_header_flag(Message.HEADERFLAG_AA))
+        self.assertTrue(msg.get_header_flag(Message.HEADERFLAG_RD))
+        self.assertEqual(1, msg.get_rr_count(Message.SECTION_QUESTION))
+        answer = msg.get_section(Message.SECTION_ANSWER)
+        self.assertTrue(rrsets_equal(soa, answer[0]))
+        self.assertEqual(RRType.SOA, answer[-1].get_type())
+        # The SOA from the iterator shouldn't be included again.
+        self.assertEqual(1, len([rrset for rrset in answer[:-1]
+                                 if rrset.get_type() == RRType.SOA]))
+
+    def test_send_soa(self):
+        soa = self.dsc.get_iterator(self.zname).get_soa()
+        self.assertTrue(bundy.datasrc.send_zone_transfer(
+                self.sock.fileno(), 0x1035, 0, self.question, None, soa,
+                None, None))
+        messages = self.get_messages()
+        self.assertEqual(1, len(messages))
+        answer = messages[0].get_section(Message.SECTION_ANSWER)
+        self.assertEqual(1, len(answer))
+        self.assertTrue(rrsets_equal(soa, answer[0]))
+
+    def test_cancel(self):
+        # The callback is only called before messages following the first
+        # one, so a small zone is never cancelled.
+        iterator = self.dsc.get_iterator(self.zname)
+        self.assertTrue(bundy.datasrc.send_zone_transfer(
+                self.sock.fileno(), 0x1035, 0, self.question, None,
+                iterator.get_soa(), iterator, lambda: True))
+
+    def test_bad_params(self):
+        soa = self.dsc.get_iterator(self.zname).get_soa()
+        fd = self.sock.fileno()
+        self.assertRaises(TypeError, bundy.datasrc.send_zone_transfer,
+                          fd, 0, 0, 'not a question', None, soa, None, None)
+        self.assertRaises(TypeError, bundy.datasrc.send_zone_transfer,
+                          fd, 0, 0, self.question, 'not a context', soa,
+                          None, None)
+        self.assertRaises(TypeError, bundy.datasrc.send_zone_transfer,
+                          fd, 0, 0, self.question, None, soa, [soa], None)
+        self.assertRaises(TypeError, bundy.datasrc.send_zone_transfer,
+                          fd, 0, 0, self.question, None, soa, None,
+                          'not callable')
+
+    def test_write_error(self):
+        soa = self.dsc.get_iterator(self.zname).get_soa()
+        self.assertRaises(bundy.datasrc.Error,
+                          bundy.datasrc.send_zone_transfer, -1, 0, 0,
+                          self.question, None, soa, None, None)
+
+    def test_receive_axfr(self):
+        # Send the zone from the read-only DB first, then receive it into
+        # a writable copy.
+        iterator = self.dsc.get_iterator(self.zname)
+        soa = iterator.get_soa()
+        self.assertTrue(bundy.datasrc.send_zone_transfer(
+                self.sock.fileno(), 0x1035, 0, self.question, None, soa,
+                iterator, None))
+        shutil.copyfile(READ_ZONE_DB_FILE, WRITE_ZONE_DB_FILE)
+        dsc = bundy.datasrc.DataSourceClient("sqlite3", WRITE_ZONE_DB_CONFIG)
+        updater = dsc.get_updater(self.zname, True)
+        completed, msg_count, rr_count, byte_count, begin_serial, \
+            end_serial = bundy.datasrc.receive_axfr(self.peer.fileno(),
+                                                    0x1035, None, updater,
+                                                    1000, None)
+        self.assertTrue(completed)
+        self.assertEqual(1, msg_count)
+        self.assertLess(0, rr_count)
+        self.assertLess(0, byte_count)
+        self.assertEqual(678, begin_serial)
+        self.assertEqual(678, end_serial)
+        updater.commit()
+        result, finder = dsc.find_zone(self.zname)
+        self.assertEqual(ZoneFinder.SUCCESS,
+                         finder.find(self.zname, RRType.SOA)[0])
+
+    def test_receive_axfr_error(self):
+        # Nothing is sent; it will time out.
+        shutil.copyfile(READ_ZONE_DB_FILE, WRITE_ZONE_DB_FILE)
+        dsc = bundy.datasrc.DataSourceClient("sqlite3", WRITE_ZONE_DB_CONFIG)
+        updater = dsc.get_updater(self.zname, True)
+        self.assertRaises(bundy.datasrc.Error, bundy.datasrc.receive_axfr,
+                          self.peer.fileno(), 0x1035, None, updater, 10,
+                          None)
+        self.assertRaises(TypeError, bundy.datasrc.receive_axfr,
+                          self.peer.fileno(), 0x1035, None, 'not updater',
+                          10, None)
+
 if __name__ == "__main__":
     bundy.log.init("bundy")
     bundy.log.resetUnitTestRootLogger()
@@ -95,6 +95,9 @@ class ZoneLoaderTests(unittest.TestCase):
                           self.client, self.test_name, None)
         self.assertRaises(TypeError, bundy.datasrc.ZoneLoader,
                           self.client, self.test_name, self.test_file, 1)
+        self.assertRaises(TypeError, bundy.datasrc.ZoneLoader,
+                          self.client, self.test_name, self.test_file, True,
+                          1)
 
     def check_zone_soa(self, soa_txt):
         """
@@ -183,6 +186,25 @@ class ZoneLoaderTests(unittest.TestCase):
                                              self.source_client)
         self.check_load_incremental(False)
 
+    def test_load_pipelined(self):
+        self.loader = bundy.datasrc.ZoneLoader(self.client, self.test_name,
+                                             self.test_file, True)
+        self.check_load()
+        self.assertEqual(8, self.loader.get_rr_count())
+
+    def test_load_from_client_pipelined(self):
+        self.source_client = bundy.datasrc.DataSourceClient('sqlite3',
+                                            DB_SOURCE_CLIENT_CONFIG)
+        self.loader = bundy.datasrc.ZoneLoader(self.client, self.test_name,
+                                             self.source_client, True)
+        # The RRs are read, but the zone isn't committed until all are
+        # stored.
+        self.assertFalse(self.loader.load_incremental(5))
+        self.assertEqual(5, self.loader.get_rr_count())
+        self.assertTrue(self.loader.load_incremental(5))
+        self.check_zone_soa(NEW_SOA_TXT)
+        self.assertEqual(8, self.loader.get_rr_count())
+
     def test_bad_file(self):
         self.check_zone_soa(ORIG_SOA_TXT)
         self.loader = bundy.datasrc.ZoneLoader(self.client, self.test_name,
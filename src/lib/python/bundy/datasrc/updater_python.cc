@@ -141,7 +141,10 @@ PyObject*
 ZoneUpdater_commit(PyObject* po_self, PyObject*) {
     s_ZoneUpdater* const self = static_cast<s_ZoneUpdater*>(po_self);
     try {
-        self->cppobj->commit();
+        {
+            GILReleaser releaser;
+            self->cppobj->commit();
+        }
         Py_RETURN_NONE;
     } catch (const DataSourceError& dse) {
         PyErr_SetString(getDataSourceException("Error"), dse.what());
@@ -398,6 +401,24 @@ createZoneUpdaterObject(bundy::datasrc::ZoneUpdaterPtr source,
     return (py_zu);
 }
 
+bool
+PyZoneUpdater_Check(PyObject* obj) {
+    if (obj == NULL) {
+        bundy_throw(PyCPPWrapperException, "obj argument NULL in typecheck");
+    }
+    return (PyObject_TypeCheck(obj, &zoneupdater_type));
+}
+
+ZoneUpdater&
+PyZoneUpdater_ToZoneUpdater(PyObject* updater_obj) {
+    if (updater_obj == NULL) {
+        bundy_throw(PyCPPWrapperException,
+                    "argument NULL in ZoneUpdater PyObject conversion");
+    }
+    s_ZoneUpdater* updater = static_cast<s_ZoneUpdater*>(updater_obj);
+    return (*updater->cppobj);
+}
+
 bool
 initModulePart_ZoneUpdater(PyObject* mod) {
     // We initialize the static description object with PyType_Ready(),
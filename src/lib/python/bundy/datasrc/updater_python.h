@@ -36,6 +36,26 @@ extern PyTypeObject zoneupdater_type;
 PyObject* createZoneUpdaterObject(bundy::datasrc::ZoneUpdaterPtr source,
                                   PyObject* base_obj = NULL);
 
+/// \brief Checks if the given python object is a ZoneUpdater object
+///
+/// \exception PyCPPWrapperException if obj is NULL
+///
+/// \param obj The object to check the type of
+/// \return true if the object is of type ZoneUpdater, false otherwise
+bool PyZoneUpdater_Check(PyObject* obj);
+
+/// \brief Returns a reference to the ZoneUpdater object contained
+///        in the given Python object.
+///
+/// \note The given object MUST be of type ZoneUpdater; this can be
+///       checked with either the right call to ParseTuple("O!"), or with
+///       PyZoneUpdater_Check()
+///
+/// \param updater_obj Python object holding the ZoneUpdater
+/// \return reference to the ZoneUpdater object
+bundy::datasrc::ZoneUpdater&
+PyZoneUpdater_ToZoneUpdater(PyObject* updater_obj);
+
 bool initModulePart_ZoneUpdater(PyObject* mod);
 } // namespace python
 } // namespace datasrc
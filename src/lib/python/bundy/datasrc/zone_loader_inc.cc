@@ -23,7 +23,16 @@ incremental loading.\n\
 \n\
 The old content of zone is discarded and no journal is stored.\n\
 \n\
-ZoneLoader(destination, zone_name, master_file)\n\
+If pipelined is True, the RRs are stored into the destination by a\n\
+separate thread while they are read.  The zone is checked and\n\
+committed once all of them are stored.  Errors in storing an RR may\n\
+then be raised by a later call to load_incremental().\n\
+\n\
+load() and load_incremental() don't hold the Python interpreter lock,\n\
+so different zones can be loaded in parallel by multiple Python\n\
+threads (each with its own ZoneLoader).\n\
+\n\
+ZoneLoader(destination, zone_name, master_file, pipelined=False)\n\
 \n\
     Constructor from master file.\n\
 \n\
@@ -43,8 +52,9 @@ ZoneLoader(destination, zone_name, master_file)\n\
       zone_name   (bundy.dns.Name) The origin of the zone. The class is\n\
                   implicit in the destination.\n\
       master_file (string) Path to the master file to read data from.\n\
+      pipelined   (bool) Whether to store the RRs in a separate thread.\n\
 \n\
-ZoneLoader(destination, zone_name, source)\n\
+ZoneLoader(destination, zone_name, source, pipelined=False)\n\
 \n\
     Constructor from another data source.\n\
 \n\
@@ -55,6 +65,7 @@ ZoneLoader(destination, zone_name, source)\n\
                   implicit in the destination.\n\
       source      (bundy.datasrc.DataSourceClient) The data source from\n\
                   which the data would be read.\n\
+      pipelined   (bool) Whether to store the RRs in a separate thread.\n\
 \n\
     Exceptions:\n\
       InvalidParameter in case the class of destination and source\n\
@@ -57,21 +57,25 @@ ZoneLoader_init(PyObject* po_self, PyObject* args, PyObject*) {
     PyObject *po_target_client = NULL;
     PyObject *po_source_client = NULL;
     PyObject *po_name = NULL;
+    PyObject *po_pipelined = NULL;
     char* master_file;
-    if (!PyArg_ParseTuple(args, "O!O!s", &datasourceclient_type,
+    if (!PyArg_ParseTuple(args, "O!O!s|O!", &datasourceclient_type,
                           &po_target_client, &name_type, &po_name,
-                          &master_file) &&
-        !PyArg_ParseTuple(args, "O!O!O!", &datasourceclient_type,
+                          &master_file, &PyBool_Type, &po_pipelined) &&
+        !PyArg_ParseTuple(args, "O!O!O!|O!", &datasourceclient_type,
                           &po_target_client, &name_type, &po_name,
-                          &datasourceclient_type, &po_source_client)
+                          &datasourceclient_type, &po_source_client,
+                          &PyBool_Type, &po_pipelined)
        ) {
         PyErr_SetString(PyExc_TypeError,
                         "Invalid arguments to ZoneLoader constructor, "
                         "expects bundy.datasrc.DataSourceClient, bundy.dns.Name, "
-                        "and either a string or another DataSourceClient");
+                        "either a string or another DataSourceClient, "
+                        "and optionally a bool");
         return (-1);
     }
     PyErr_Clear();
+    const bool pipelined = (po_pipelined == Py_True);
     try {
         // The associated objects must be alive during the lifetime
         // of this instance, so incref them (through a container in case
@@ -85,13 +89,14 @@ ZoneLoader_init(PyObject* po_self, PyObject* args, PyObject*) {
             self->cppobj = new ZoneLoader(
                 PyDataSourceClient_ToDataSourceClient(po_target_client),
                 PyName_ToName(po_name),
-                PyDataSourceClient_ToDataSourceClient(po_source_client));
+                PyDataSourceClient_ToDataSourceClient(po_source_client),
+                pipelined);
             self->source_client = source_client.release();
         } else {
             self->cppobj = new ZoneLoader(
                 PyDataSourceClient_ToDataSourceClient(po_target_client),
                 PyName_ToName(po_name),
-                master_file);
+                master_file, pipelined);
         }
         self->target_client = target_client.release();
         return (0);
@@ -128,7 +133,10 @@ PyObject*
 ZoneLoader_load(PyObject* po_self, PyObject*) {
     s_ZoneLoader* self = static_cast<s_ZoneLoader*>(po_self);
     try {
-        self->cppobj->load();
+        {
+            GILReleaser releaser;
+            self->cppobj->load();
+        }
         Py_RETURN_NONE;
     } catch (const bundy::InvalidOperation& ivo) {
         PyErr_SetString(po_InvalidOperation, ivo.what());
@@ -163,7 +171,12 @@ ZoneLoader_loadIncremental(PyObject* po_self, PyObject* args) {
         return (NULL);
     }
     try {
-        if (self->cppobj->loadIncremental(limit)) {
+        bool complete;
+        {
+            GILReleaser releaser;
+            complete = self->cppobj->loadIncremental(limit);
+        }
+        if (complete) {
             Py_RETURN_TRUE;
         } else {
             Py_RETURN_FALSE;
@@ -0,0 +1,260 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+// Python.h needs to be placed at the head of the program file, see:
+// http://docs.python.org/py3k/extending/extending.html#a-simple-example
+#include <Python.h>
+
+#include <util/python/pycppwrapper_util.h>
+
+#include <datasrc/client.h>
+#include <datasrc/zone.h>
+#include <datasrc/zone_iterator.h>
+#include <datasrc/zone_transfer_receiver.h>
+#include <datasrc/zone_transfer_sender.h>
+
+#include <dns/python/question_python.h>
+#include <dns/python/rrset_python.h>
+#include <dns/python/tsig_python.h>
+
+#include <boost/bind.hpp>
+
+#include "datasrc.h"
+#include "iterator_python.h"
+#include "journal_reader_python.h"
+#include "updater_python.h"
+#include "zone_transfer_python.h"
+
+using namespace bundy::util::python;
+using namespace bundy::dns::python;
+using namespace bundy::datasrc;
+using namespace bundy::datasrc::python;
+
+namespace {
+// Call the Python cancel callback.  It's called without the GIL.  If the
+// callback raises an exception, it stops the transfer and the exception is
+// propagated to the caller of send_zone_transfer() or receive_axfr().
+bool
+callCancel(PyObject* callback) {
+    const PyGILState_STATE gstate = PyGILState_Ensure();
+    bool cancelled = true;
+    PyObject* result = PyObject_CallObject(callback, NULL);
+    if (result != NULL) {
+        const int ret = PyObject_IsTrue(result);
+        cancelled = (ret != 0); // including -1 (error)
+        Py_DECREF(result);
+    }
+    PyGILState_Release(gstate);
+    return (cancelled);
+}
+}
+
+namespace bundy {
+namespace datasrc {
+namespace python {
+
+const char* const send_zone_transfer_doc = "\
+send_zone_transfer(fd, qid, flags, question, tsig_ctx, soa, source,\n\
+                   cancel) -> bool\n\
+\n\
+Send an AXFR or IXFR response over a connected, blocking TCP socket.\n\
+\n\
+This renders the response messages and writes them to the socket in C++,\n\
+without the Python interpreter lock being held.\n\
+\n\
+If source is a ZoneIterator, the messages contain soa, the RRsets from\n\
+the iterator except SOAs, and soa again (AXFR).  If it's a\n\
+ZoneJournalReader, they contain soa, all difference RRsets, and soa again\n\
+(IXFR).  If it's None, a single message only containing soa is sent.\n\
+\n\
+Exceptions:\n\
+  bundy.datasrc.Error The response can't be rendered or sent.\n\
+\n\
+Parameters:\n\
+  fd        The file descriptor of the socket.\n\
+  qid       The ID of the request.\n\
+  flags     The header flags (other than QR and AA, which are always set).\n\
+  question  The Question of the request.\n\
+  tsig_ctx  A TSIGContext to sign the messages with, or None.\n\
+  soa       The SOA RRset of the zone.\n\
+  source    A ZoneIterator, ZoneJournalReader or None.\n\
+  cancel    A callable without arguments, or None.  It's called before\n\
+            each message but the first one is sent; if it returns True\n\
+            the transfer stops.\n\
+\n\
+Return Value(s): True if the response is completely sent; False if it's\n\
+cancelled.\n\
+";
+
+PyObject*
+sendZoneTransfer(PyObject*, PyObject* args) {
+    int fd;
+    unsigned int qid;
+    unsigned int flags;
+    PyObject* po_question;
+    PyObject* po_tsig_ctx;
+    PyObject* po_soa;
+    PyObject* po_source;
+    PyObject* po_cancel;
+    if (!PyArg_ParseTuple(args, "iIIO!OO!OO", &fd, &qid, &flags,
+                          &question_type, &po_question, &po_tsig_ctx,
+                          &rrset_type, &po_soa, &po_source, &po_cancel)) {
+        return (NULL);
+    }
+    if (po_tsig_ctx != Py_None && !PyTSIGContext_Check(po_tsig_ctx)) {
+        PyErr_SetString(PyExc_TypeError,
+                        "tsig_ctx must be a TSIGContext or None");
+        return (NULL);
+    }
+    if (po_source != Py_None && !PyZoneIterator_Check(po_source) &&
+        !PyZoneJournalReader_Check(po_source)) {
+        PyErr_SetString(PyExc_TypeError, "source must be a ZoneIterator, "
+                        "ZoneJournalReader or None");
+        return (NULL);
+    }
+    if (po_cancel != Py_None && !PyCallable_Check(po_cancel)) {
+        PyErr_SetString(PyExc_TypeError, "cancel must be callable or None");
+        return (NULL);
+    }
+
+    try {
+        ZoneTransferSender sender(
+            fd, qid, flags, PyQuestion_ToQuestion(po_question),
+            po_tsig_ctx == Py_None ? NULL :
+            PyTSIGContext_ToTSIGContext(po_tsig_ctx));
+        if (po_cancel != Py_None) {
+            sender.setCancelCallback(boost::bind(callCancel, po_cancel));
+        }
+        const bundy::dns::AbstractRRset& soa = PyRRset_ToRRset(po_soa);
+        bool completed = true;
+        {
+            GILReleaser releaser;
+            if (po_source == Py_None) {
+                sender.sendSOA(soa);
+            } else if (PyZoneIterator_Check(po_source)) {
+                completed = sender.sendZone(
+                    PyZoneIterator_ToZoneIterator(po_source), soa);
+            } else {
+                completed = sender.sendDiffs(
+                    PyZoneJournalReader_ToZoneJournalReader(po_source), soa);
+            }
+        }
+        if (PyErr_Occurred() != NULL) {
+            // from the cancel callback
+            return (NULL);
+        }
+        if (completed) {
+            Py_RETURN_TRUE;
+        } else {
+            Py_RETURN_FALSE;
+        }
+    } catch (const std::exception& exc) {
+        PyErr_SetString(getDataSourceException("Error"), exc.what());
+        return (NULL);
+    } catch (...) {
+        PyErr_SetString(getDataSourceException("Error"),
+                        "Unexpected exception");
+        return (NULL);
+    }
+}
+
+const char* const receive_axfr_doc = "\
+receive_axfr(fd, qid, tsig_ctx, updater, timeout, cancel) -> tuple\n\
+\n\
+Receive an AXFR response over a connected TCP socket.\n\
+\n\
+This reads, verifies and parses the response messages and adds the\n\
+received RRs to the updater in C++, without the Python interpreter lock\n\
+being held.  The first SOA isn't added, but the last one is.  The updater\n\
+isn't committed.\n\
+\n\
+Exceptions:\n\
+  bundy.datasrc.Error The response can't be received, or it's broken or\n\
+                      invalid (including TSIG errors), or the updater\n\
+                      fails.\n\
+\n\
+Parameters:\n\
+  fd        The file descriptor of the socket.\n\
+  qid       The ID of the request.\n\
+  tsig_ctx  The TSIGContext the request was signed with, or None.\n\
+  updater   The ZoneUpdater to add the RRs to.\n\
+  timeout   The time in milliseconds to wait for data (negative for\n\
+            infinity).\n\
+  cancel    A callable without arguments, or None.  It's called before\n\
+            each message but the first one is processed; if it returns\n\
+            True the transfer stops.\n\
+\n\
+Return Value(s): A tuple of whether the transfer has completed (False if\n\
+it's cancelled), the number of messages, the number of RRs, the number of\n\
+bytes, and the serials of the first and last SOAs.\n\
+";
+
+PyObject*
+receiveAXFR(PyObject*, PyObject* args) {
+    int fd;
+    unsigned int qid;
+    PyObject* po_tsig_ctx;
+    PyObject* po_updater;
+    int timeout;
+    PyObject* po_cancel;
+    if (!PyArg_ParseTuple(args, "iIOO!iO", &fd, &qid, &po_tsig_ctx,
+                          &zoneupdater_type, &po_updater, &timeout,
+                          &po_cancel)) {
+        return (NULL);
+    }
+    if (po_tsig_ctx != Py_None && !PyTSIGContext_Check(po_tsig_ctx)) {
+        PyErr_SetString(PyExc_TypeError,
+                        "tsig_ctx must be a TSIGContext or None");
+        return (NULL);
+    }
+    if (po_cancel != Py_None && !PyCallable_Check(po_cancel)) {
+        PyErr_SetString(PyExc_TypeError, "cancel must be callable or None");
+        return (NULL);
+    }
+
+    try {
+        ZoneTransferReceiver receiver(
+            fd, qid, po_tsig_ctx == Py_None ? NULL :
+            PyTSIGContext_ToTSIGContext(po_tsig_ctx), timeout);
+        if (po_cancel != Py_None) {
+            receiver.setCancelCallback(boost::bind(callCancel, po_cancel));
+        }
+        ZoneUpdater& updater = PyZoneUpdater_ToZoneUpdater(po_updater);
+        bool completed;
+        {
+            GILReleaser releaser;
+            completed = receiver.receiveAXFR(updater);
+        }
+        if (PyErr_Occurred() != NULL) {
+            // from the cancel callback
+            return (NULL);
+        }
+        return (Py_BuildValue("OnnnII", completed ? Py_True : Py_False,
+                              receiver.getMessageCount(),
+                              receiver.getRRCount(),
+                              receiver.getByteCount(),
+                              receiver.getBeginSerial(),
+                              receiver.getEndSerial()));
+    } catch (const std::exception& exc) {
+        PyErr_SetString(getDataSourceException("Error"), exc.what());
+        return (NULL);
+    } catch (...) {
+        PyErr_SetString(getDataSourceException("Error"),
+                        "Unexpected exception");
+        return (NULL);
+    }
+}
+
+} // namespace python
+} // namespace datasrc
+} // namespace bundy
@@ -0,0 +1,48 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+#ifndef PYTHON_DATASRC_ZONE_TRANSFER_H
+#define PYTHON_DATASRC_ZONE_TRANSFER_H 1
+
+#include <Python.h>
+
+namespace bundy {
+namespace datasrc {
+namespace python {
+
+/// \brief The documentation of \c sendZoneTransfer().
+extern const char* const send_zone_transfer_doc;
+
+/// \brief Python binding of \c ZoneTransferSender, the module-level
+/// \c send_zone_transfer() function of bundy.datasrc.
+///
+/// See \c send_zone_transfer_doc for the arguments.
+PyObject* sendZoneTransfer(PyObject* self, PyObject* args);
+
+/// \brief The documentation of \c receiveAXFR().
+extern const char* const receive_axfr_doc;
+
+/// \brief Python binding of \c ZoneTransferReceiver, the module-level
+/// \c receive_axfr() function of bundy.datasrc.
+///
+/// See \c receive_axfr_doc for the arguments.
+PyObject* receiveAXFR(PyObject* self, PyObject* args);
+
+} // namespace python
+} // namespace datasrc
+} // namespace bundy
+#endif // PYTHON_DATASRC_ZONE_TRANSFER_H
+
+// Local Variables:
+// mode: c++
+// End:
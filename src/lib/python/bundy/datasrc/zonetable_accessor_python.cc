@@ -22,13 +22,21 @@
 
 #include <datasrc/zone_table_accessor.h>
 
+#include <dns/python/name_python.h>
+
+#include <util/buffer.h>
 #include <util/python/pycppwrapper_util.h>
 
+#include <algorithm>
+
 #include "datasrc.h"
 #include "zonetable_accessor_python.h"
 #include "zonetable_iterator_python.h"
 
 using namespace std;
+using namespace bundy::util;
+using namespace bundy::util::python;
+using namespace bundy::dns::python;
 using namespace bundy::datasrc;
 using namespace bundy::datasrc::python;
 
@@ -89,6 +97,97 @@ ZoneTableAccessor_iter(PyObject* po_self) {
     }
 }
 
+// Return the last of the uncompressed names in the buffer, which must not
+// be empty.
+bundy::dns::Name
+getLastName(const OutputBuffer& buffer) {
+    const uint8_t* const data = static_cast<const uint8_t*>(buffer.getData());
+    size_t last = 0;
+    for (size_t pos = 0; pos < buffer.getLength(); ++pos) {
+        last = pos;
+        while (data[pos] != 0) {
+            pos += data[pos] + 1;
+        }
+    }
+    InputBuffer ibuffer(data, buffer.getLength());
+    ibuffer.setPosition(last);
+    return (bundy::dns::Name(ibuffer));
+}
+
+// The default of the max_count argument of get_zone_names().
+const unsigned int ZONE_NAMES_COUNT_DEFAULT = 1000;
+
+PyObject*
+ZoneTableAccessor_getZoneNames(PyObject* po_self, PyObject* args) {
+    s_ZoneTableAccessor* const self =
+        static_cast<s_ZoneTableAccessor*>(po_self);
+    unsigned int max_count = ZONE_NAMES_COUNT_DEFAULT;
+    PyObject* after_obj = Py_None;
+    if (!PyArg_ParseTuple(args, "|IO", &max_count, &after_obj)) {
+        return (NULL);
+    }
+    if (after_obj != Py_None && !PyName_Check(after_obj)) {
+        PyErr_SetString(PyExc_TypeError,
+                        "after of get_zone_names() must be a Name or None");
+        return (NULL);
+    }
+    try {
+        // The names of a typical zone fit in 32 bytes; the buffer grows
+        // for a large page.
+        OutputBuffer buffer(min(max_count, ZONE_NAMES_COUNT_DEFAULT) * 32);
+        const unsigned int count = self->cppobj->getZoneNames(
+            buffer, max_count,
+            after_obj == Py_None ? NULL : &PyName_ToName(after_obj));
+        PyObjectContainer data_container(
+            PyBytes_FromStringAndSize(
+                static_cast<const char*>(buffer.getData()),
+                buffer.getLength()));
+        if (count == 0) {
+            return (Py_BuildValue("(OIO)", data_container.get(), count,
+                                  Py_None));
+        }
+        PyObjectContainer last_container(
+            createNameObject(getLastName(buffer)));
+        return (Py_BuildValue("(OIO)", data_container.get(), count,
+                              last_container.get()));
+    } catch (const PyCPPWrapperException&) {
+        // A Python exception is already set by the container.
+        return (NULL);
+    } catch (const std::exception& exc) {
+        PyErr_SetString(getDataSourceException("Error"), exc.what());
+        return (NULL);
+    } catch (...) {
+        PyErr_SetString(getDataSourceException("Error"),
+                        "Unexpected exception");
+        return (NULL);
+    }
+}
+
+const char* const ZoneTableAccessor_getZoneNames_doc = "\
+get_zone_names([max_count[, after]]) -> (bytes, integer, bundy.dns.Name)\n\
+\n\
+Get a page of the zone names of the table.\n\
+\n\
+This returns the origin names of up to max_count zones, in the\n\
+uncompressed wire format, concatenated, in the order of the iterator.\n\
+No Name object is created for them, so a large table can be listed\n\
+page by page with little memory, passing the last name of each page as\n\
+after to get the next one. Each name can be read with\n\
+bundy.dns.Name(data, position).\n\
+\n\
+Exceptions:\n\
+  bundy.datasrc.Error The names can't be read.\n\
+  TypeError        after is neither a Name nor None.\n\
+\n\
+Parameters:\n\
+  max_count  The maximum number of names to be returned (default 1000).\n\
+  after      If not None, the page starts with the zone that follows it.\n\
+\n\
+Return Value(s): A tuple of the names, their number and the last of\n\
+them; the number is less than max_count only at the end of the table,\n\
+and the last name is None if there is no name.\n\
+";
+
 // This list contains the actual set of functions we have in
 // python. Each entry has
 // 1. Python method name
@@ -96,6 +195,8 @@ ZoneTableAccessor_iter(PyObject* po_self) {
 // 3. Argument type
 // 4. Documentation
 PyMethodDef ZoneTableAccessor_methods[] = {
+    { "get_zone_names", ZoneTableAccessor_getZoneNames, METH_VARARGS,
+      ZoneTableAccessor_getZoneNames_doc },
     { NULL, NULL, 0, NULL }
 };
 
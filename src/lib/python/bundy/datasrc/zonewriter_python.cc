@@ -94,7 +94,11 @@ ZoneWriter_load(PyObject* po_self, PyObject* args) {
     }
     try {
         std::string error_msg;
-        const bool completed = self->cppobj->load(count_limit, &error_msg);
+        bool completed;
+        {
+            GILReleaser releaser;
+            completed = self->cppobj->load(count_limit, &error_msg);
+        }
         if (!error_msg.empty()) {
             PyErr_SetString(getDataSourceException("Error"),
                             error_msg.c_str());
@@ -177,6 +177,91 @@ class DDNS_SOA:
             soa_num = soa_num + 1
         return self.__write_soa_internal(origin_soa, soa_num)
 
+class UpdateBatch:
+    '''A batch of update requests to a zone applied together.
+
+    The update sessions constructed with the same batch merge their changes
+    in a single diff, which the batch validates and commits in one data
+    source transaction once all of them are handled.  The changes of the
+    batch form a single changeset, from the SOA the zone had before the
+    batch to the one of its last update, so they are recorded as a single
+    difference in the journal.  Each update sees the changes of the updates
+    handled before it in the batch.
+
+    All the updates of a batch must be to the same zone, and nothing else
+    may update the zone until the batch is committed.
+
+    '''
+    def __init__(self):
+        self.__diff = None
+        self.__zname = None
+        self.__zclass = None
+        self.__update_count = 0
+
+    def _get_diff(self, datasrc_client, zname, zclass):
+        '''Return the diff holding the changes of the batch.
+
+        This is called by the update sessions of the batch once they have
+        identified the zone; the first one creates the diff.  Raises
+        UpdateError if the zone is not the zone of the batch.
+
+        '''
+        if self.__diff is None:
+            self.__diff = bundy.xfrin.diff.Diff(datasrc_client, zname,
+                                              journaling=True,
+                                              single_update_mode=True)
+            self.__zname = zname
+            self.__zclass = zclass
+        elif zname != self.__zname or zclass != self.__zclass:
+            raise UpdateError('update in a batch for another zone',
+                              zname, zclass, Rcode.SERVFAIL)
+        return self.__diff
+
+    def _add_update(self):
+        '''Called by an update session when its changes were merged.'''
+        self.__update_count += 1
+
+    def get_update_count(self):
+        '''Return the number of updates merged in the batch.'''
+        return self.__update_count
+
+    def commit(self):
+        '''Validate the updated zone and commit the changes of the batch.
+
+        Returns True if the changes were committed.  Returns False if the
+        batch has no change, or if the updated zone fails the validation or
+        the changes can't be committed, in which case none of them is
+        applied.  The batch can't be used any more after this call.
+
+        '''
+        diff = self.__diff
+        self.__diff = None
+        if diff is None or self.__update_count == 0:
+            return False
+        try:
+            if not check_zone(self.__zname, self.__zclass,
+                              diff.get_rrset_collection(),
+                              (self.__validate_error,
+                               self.__validate_warning)):
+                logger.info(LIBDDNS_BATCH_COMMIT_FAILED, self.__update_count,
+                            ZoneFormatter(self.__zname, self.__zclass),
+                            'validation of the new zone failed')
+                return False
+            diff.commit()
+            return True
+        except bundy.datasrc.Error as e:
+            logger.info(LIBDDNS_BATCH_COMMIT_FAILED, self.__update_count,
+                        ZoneFormatter(self.__zname, self.__zclass), e)
+            return False
+
+    def __validate_error(self, reason):
+        logger.error(LIBDDNS_ZONE_INVALID_ERROR, self.__zname, self.__zclass,
+                     reason)
+
+    def __validate_warning(self, reason):
+        logger.warn(LIBDDNS_ZONE_INVALID_WARN, self.__zname, self.__zclass,
+                    reason)
+
 class UpdateSession:
     '''Protocol handling for a single dynamic update request.
 
@@ -187,7 +272,7 @@ class UpdateSession:
     class can use the message to send a response to the client.
 
     '''
-    def __init__(self, req_message, client_addr, zone_config):
+    def __init__(self, req_message, client_addr, zone_config, batch=None):
         '''Constructor.
 
         Parameters:
@@ -199,12 +284,16 @@ class UpdateSession:
           logging and access control.
         - zone_config (ZoneConfig) A tentative container that encapsulates
           the server's zone configuration.  See zone_config.py.
+        - batch (UpdateBatch or None) If not None, the changes of the update
+          are merged in the given batch, which applies them when it's
+          committed, instead of being committed by handle().
 
         '''
         self.__message = req_message
         self.__tsig = req_message.get_tsig_record()
         self.__client_addr = client_addr
         self.__zone_config = zone_config
+        self.__batch = batch
         self.__added_soa = None
 
     def get_message(self):
@@ -239,7 +328,13 @@ class UpdateSession:
         - The name of the used data source associated with DataSourceClient
           in case of UPDATE_SUCCESS; otherwise None.
 
+        If the session was constructed with a batch, UPDATE_SUCCESS means
+        the changes were merged in the batch; they are applied (or not) when
+        the batch is committed.  The changes of a failed update are removed
+        from the batch.
+
         '''
+        saved = None
         try:
             self._get_update_zone()
             # Contrary to what RFC2136 specifies, we do ACL checks before
@@ -249,18 +344,24 @@ class UpdateSession:
             # by performing ACL check as early as possible.
             self.__check_update_acl(self.__zname, self.__zclass)
             self._create_diff()
+            if self.__batch is not None:
+                saved = self.__diff.save_buffers()
             prereq_result = self.__check_prerequisites()
             if prereq_result != Rcode.NOERROR:
                 self.__make_response(prereq_result)
                 return UPDATE_ERROR, self.__zname, self.__zclass, None
             update_result = self.__do_update()
             if update_result != Rcode.NOERROR:
+                self.__restore_batch(saved)
                 self.__make_response(update_result)
                 return UPDATE_ERROR, self.__zname, self.__zclass, None
             self.__make_response(Rcode.NOERROR)
             datasrc_name = self.__datasrc_client.get_datasource_name()
+            if self.__batch is not None:
+                self.__batch._add_update()
             return UPDATE_SUCCESS, self.__zname, self.__zclass, datasrc_name
         except UpdateError as e:
+            self.__restore_batch(saved)
             if not e.nolog:
                 logger.debug(logger.DBGLVL_TRACE_BASIC,
                              LIBDDNS_UPDATE_PROCESSING_FAILED,
@@ -274,11 +375,23 @@ class UpdateSession:
             self.__message = None
             return UPDATE_DROP, None, None, None
         except bundy.datasrc.Error as e:
+            self.__restore_batch(saved)
             logger.error(LIBDDNS_DATASRC_ERROR,
                          ClientFormatter(self.__client_addr, self.__tsig), e)
             self.__make_response(Rcode.SERVFAIL)
             return UPDATE_ERROR, None, None, None
 
+    def __restore_batch(self, saved):
+        '''Removes the changes of a failed update from the batch.
+
+        saved is what the diff of the batch returned by save_buffers()
+        before the update was handled, None if there is no batch or the
+        update failed before that.
+
+        '''
+        if saved is not None:
+            self.__diff.restore_buffers(saved)
+
     def _get_update_zone(self):
         '''Parse the zone section and find the zone to be updated.
 
@@ -342,11 +455,34 @@ class UpdateSession:
         methods are tested that need the setup done here without calling
         the full handle() method.
         '''
+        if self.__batch is not None:
+            self.__diff = self.__batch._get_diff(self.__datasrc_client,
+                                                 self.__zname, self.__zclass)
+            return
         self.__diff = bundy.xfrin.diff.Diff(self.__datasrc_client,
                                           self.__zname,
                                           journaling=True,
                                           single_update_mode=True)
 
+    def __find(self, name, rrtype):
+        '''Find the RRset of the given name and type in the zone.
+
+        In a batch, the zone includes the changes of the updates of the
+        batch before this one, which aren't in the data source yet.
+        Otherwise it's the zone as it was when the update started.
+
+        '''
+        if self.__batch is not None:
+            return self.__diff.find_updated(name, rrtype)
+        return self.__diff.find(name, rrtype)
+
+    def __find_all(self, name):
+        '''Find all the RRsets of the given name in the zone, like
+           __find().'''
+        if self.__batch is not None:
+            return self.__diff.find_all_updated(name)
+        return self.__diff.find_all(name)
+
     def __check_update_acl(self, zname, zclass):
         '''Apply update ACL for the zone to be updated.'''
         acl = self.__zone_config.get_update_acl(zname, zclass)
@@ -390,7 +526,7 @@ class UpdateSession:
            only return what the result code would be (and not read/copy
            any actual data).
         '''
-        result, _, _ = self.__diff.find(rrset.get_name(), rrset.get_type())
+        result, _, _ = self.__find(rrset.get_name(), rrset.get_type())
         return result == ZoneFinder.SUCCESS
 
     def __prereq_rrset_exists_value(self, rrset):
@@ -399,8 +535,8 @@ class UpdateSession:
            RFC2136 Section 2.4.2
            Returns True if the prerequisite is satisfied, False otherwise.
         '''
-        result, found_rrset, _ = self.__diff.find(rrset.get_name(),
-                                                  rrset.get_type())
+        result, found_rrset, _ = self.__find(rrset.get_name(),
+                                             rrset.get_type())
         if result == ZoneFinder.SUCCESS and\
            rrset.get_name() == found_rrset.get_name() and\
            rrset.get_type() == found_rrset.get_type():
@@ -439,7 +575,7 @@ class UpdateSession:
            to only return what the result code would be (and not read/copy
            any actual data).
         '''
-        result, rrsets, flags = self.__diff.find_all(rrset.get_name())
+        result, rrsets, flags = self.__find_all(rrset.get_name())
         if result == ZoneFinder.SUCCESS and\
            (flags & ZoneFinder.RESULT_WILDCARD == 0):
             return True
@@ -663,8 +799,8 @@ class UpdateSession:
         # is explicitly ignored here)
         if rrset.get_type() == RRType.SOA:
             return
-        result, orig_rrset, _ = self.__diff.find(rrset.get_name(),
-                                                 rrset.get_type())
+        result, orig_rrset, _ = self.__find(rrset.get_name(),
+                                            rrset.get_type())
         if result == ZoneFinder.CNAME:
             # Ignore non-cname rrs that try to update CNAME records
             # (if rrset itself is a CNAME, the finder result would be
@@ -797,9 +933,7 @@ class UpdateSession:
         # serial magic and add the newly created one
 
         # get it from DS and to increment and stuff
-        result, old_soa, _ = self.__diff.find(self.__zname, RRType.SOA,
-                                              ZoneFinder.NO_WILDCARD |
-                                              ZoneFinder.FIND_GLUE_OK)
+        result, old_soa, _ = self.__find(self.__zname, RRType.SOA)
         # We may implement recovering from missing SOA data at some point, but
         # for now servfail on such a broken state
         if result != ZoneFinder.SUCCESS:
@@ -813,6 +947,11 @@ class UpdateSession:
             # increment goes here
             new_soa = serial_operation.update_soa(old_soa)
 
+        # In a batch the SOA the previous updates end with is replaced, so
+        # that the changes of the batch form a single changeset.
+        if self.__batch is not None and self.__batch.get_update_count() > 0:
+            self.__diff.replace_soa(new_soa)
+            return
         self.__diff.delete_data(old_soa)
         self.__diff.add_data(new_soa)
 
@@ -867,6 +1006,10 @@ class UpdateSession:
                 elif rrset.get_class() == RRClass.NONE:
                     self.__do_update_delete_rrs_from_rrset(rrset)
 
+            # The changes of a batch are validated and committed together
+            # by the batch.
+            if self.__batch is not None:
+                return Rcode.NOERROR
             if not check_zone(self.__zname, self.__zclass,
                               self.__diff.get_rrset_collection(),
                               (self.__validate_error, self.__validate_warning)):
@@ -18,7 +18,7 @@ import shutil
 import bundy.log
 import unittest
 from bundy.dns import *
-from bundy.datasrc import DataSourceClient, ZoneFinder
+from bundy.datasrc import DataSourceClient, ZoneFinder, ZoneJournalReader
 from bundy.ddns.session import *
 from bundy.ddns.zone_config import *
 
@@ -1505,6 +1505,105 @@ class SessionTest(SessionTestBase):
 
         self.check_full_handle_result(Rcode.REFUSED, [ new_cname ])
 
+class SessionBatchTest(SessionTestBase):
+    '''Tests for the update sessions merged in a batch.'''
+    def setUp(self):
+        super().setUp()
+        # The batch opens its own updater on the zone.
+        self._session = None
+        self.__zconfig = ZoneConfig(set(),
+                                    {TEST_RRCLASS: self._dsrc_client_list},
+                                    self._acl_map)
+
+    def __handle(self, batch, updates, prerequisites=[]):
+        '''Handle an update in the batch, and return its result and the
+           Rcode of its response.'''
+        msg = create_update_msg([TEST_ZONE_RECORD], prerequisites, updates)
+        session = UpdateSession(msg, TEST_CLIENT4, self.__zconfig, batch)
+        result, _, _, _ = session.handle()
+        return result, session.get_message().get_rcode()
+
+    def __find(self, name, rrtype):
+        _, finder = self._datasrc_client.find_zone(TEST_ZONE_NAME)
+        return finder.find(Name(name), rrtype,
+                           finder.NO_WILDCARD | finder.FIND_GLUE_OK)
+
+    def test_batch(self):
+        batch = UpdateBatch()
+        a1 = create_rrset("a1.example.org", TEST_RRCLASS, RRType.A, 3600,
+                          [ "192.0.2.1" ])
+        a2 = create_rrset("a2.example.org", TEST_RRCLASS, RRType.A, 3600,
+                          [ "192.0.2.2" ])
+
+        self.assertEqual((UPDATE_SUCCESS, Rcode.NOERROR),
+                         self.__handle(batch, [ a1 ]))
+        # The prerequisites see the changes of the previous updates.
+        a1_exists = create_rrset("a1.example.org", RRClass.ANY, RRType.A, 0)
+        self.assertEqual((UPDATE_SUCCESS, Rcode.NOERROR),
+                         self.__handle(batch, [ a2 ], [ a1_exists ]))
+        a1_not_in_use = create_rrset("a1.example.org", RRClass.NONE,
+                                     RRType.ANY, 0)
+        self.assertEqual((UPDATE_ERROR, Rcode.YXDOMAIN),
+                         self.__handle(batch, [ a2 ], [ a1_not_in_use ]))
+        # Deleting what a previous update added cancels its addition.
+        a1_delete = create_rrset("a1.example.org", RRClass.ANY, RRType.A, 0)
+        self.assertEqual((UPDATE_SUCCESS, Rcode.NOERROR),
+                         self.__handle(batch, [ a1_delete ]))
+        self.assertEqual(3, batch.get_update_count())
+
+        self.assertTrue(batch.commit())
+        self.assertEqual(ZoneFinder.NXDOMAIN,
+                         self.__find("a1.example.org", RRType.A)[0])
+        self.assertEqual(ZoneFinder.SUCCESS,
+                         self.__find("a2.example.org", RRType.A)[0])
+        result, soa, _ = self.__find("example.org", RRType.SOA)
+        self.assertEqual(ZoneFinder.SUCCESS, result)
+        self.assertEqual("ns1.example.org. admin.example.org. " +
+                         "1237 3600 1800 2419200 7200",
+                         soa.get_rdata()[0].to_text())
+
+        # The batch is recorded as a single difference in the journal.
+        result, _ = self._datasrc_client.get_journal_reader(TEST_ZONE_NAME,
+                                                            1234, 1235)
+        self.assertEqual(ZoneJournalReader.NO_SUCH_VERSION, result)
+        result, reader = \
+            self._datasrc_client.get_journal_reader(TEST_ZONE_NAME, 1234,
+                                                    1237)
+        self.assertEqual(ZoneJournalReader.SUCCESS, result)
+        self.assertEqual(["example.org. 3600 IN SOA ns1.example.org. " +
+                          "admin.example.org. 1234 3600 1800 2419200 7200\n",
+                          "example.org. 3600 IN SOA ns1.example.org. " +
+                          "admin.example.org. 1237 3600 1800 2419200 7200\n",
+                          "a2.example.org. 3600 IN A 192.0.2.2\n"],
+                         [ rrset.to_text() for rrset in reader ])
+
+    def test_batch_failure(self):
+        batch = UpdateBatch()
+        # Nothing to commit.
+        self.assertFalse(batch.commit())
+
+        batch = UpdateBatch()
+        a1 = create_rrset("a1.example.org", TEST_RRCLASS, RRType.A, 3600,
+                          [ "192.0.2.1" ])
+        self.assertEqual((UPDATE_SUCCESS, Rcode.NOERROR),
+                         self.__handle(batch, [ a1 ]))
+        # ns3.example.org. is an NS and should not have a CNAME record, but
+        # the zone is only validated when the batch is committed.
+        new_cname = create_rrset("ns3.example.org", TEST_RRCLASS,
+                                 RRType.CNAME, 3600,
+                                 [ "cname.example.org." ])
+        self.assertEqual((UPDATE_SUCCESS, Rcode.NOERROR),
+                         self.__handle(batch, [ new_cname ]))
+
+        # None of the changes is applied.
+        self.assertFalse(batch.commit())
+        self.assertEqual(ZoneFinder.NXDOMAIN,
+                         self.__find("a1.example.org", RRType.A)[0])
+        result, soa, _ = self.__find("example.org", RRType.SOA)
+        self.assertEqual("ns1.example.org. admin.example.org. " +
+                         "1234 3600 1800 2419200 7200",
+                         soa.get_rdata()[0].to_text())
+
 class SessionACLTest(SessionTestBase):
     '''ACL related tests for update session.'''
     def test_update_acl_check(self):
@@ -116,17 +116,21 @@ class MemorySegmentBuilder:
         self.__send_response(('validate-completed', dsrc_info, rrclass,
                               dsrc_name, result))
 
-    def __reset_segment(self, clist, dsrc_name, rrclass, params):
-        try:
-            clist.reset_memory_segment(dsrc_name,
-                                       ConfigurableClientList.READ_WRITE,
-                                       params)
-            logger.debug(logger.DBGLVL_TRACE_BASIC,
-                         LIBMEMMGR_BUILDER_SEGMENT_RESET, dsrc_name, rrclass)
-            return self.__RESET_SEGMENT_OK
-        except Exception as ex:
-            logger.error(LIBMEMMGR_BUILDER_RESET_SEGMENT_ERROR, dsrc_name,
-                         rrclass, ex)
+    def __reset_segment(self, clist, dsrc_name, rrclass, params,
+                        create=False):
+        # If create is True, a new segment is always created.
+        if not create:
+            try:
+                clist.reset_memory_segment(dsrc_name,
+                                           ConfigurableClientList.READ_WRITE,
+                                           params)
+                logger.debug(logger.DBGLVL_TRACE_BASIC,
+                             LIBMEMMGR_BUILDER_SEGMENT_RESET, dsrc_name,
+                             rrclass)
+                return self.__RESET_SEGMENT_OK
+            except Exception as ex:
+                logger.error(LIBMEMMGR_BUILDER_RESET_SEGMENT_ERROR, dsrc_name,
+                             rrclass, ex)
         try:
             clist.reset_memory_segment(dsrc_name, ConfigurableClientList.CREATE,
                                        params)
@@ -207,8 +211,14 @@ class MemorySegmentBuilder:
 
         clist = dsrc_info.clients_map[rrclass]
         sgmt_info = dsrc_info.segment_info_map[(rrclass, dsrc_name)]
-        params = json.dumps(sgmt_info.get_reset_param(SegmentInfo.WRITER))
-        result = self.__reset_segment(clist, dsrc_name, rrclass, params)
+        param_map = sgmt_info.get_reset_param(SegmentInfo.WRITER)
+        params = json.dumps(param_map)
+        # A versioned segment may be in use by readers; loading all zones
+        # into it would double its size, so a new one is created instead.
+        # Readers keep using the old one until they are told to switch.
+        create = zone_name is None and param_map.get('versioned', False)
+        result = self.__reset_segment(clist, dsrc_name, rrclass, params,
+                                      create)
         if result == self.__RESET_SEGMENT_FAILED:
             self.__send_response(('load-completed', dsrc_info, rrclass,
                                   dsrc_name, False))
@@ -289,6 +299,43 @@ class MemorySegmentBuilder:
         self.__send_response(('load-completed', dsrc_info, rrclass, dsrc_name,
                               succeeded))
 
+    def _handle_reclaim(self, dsrc_info, rrclass, dsrc_name):
+        # This method is called when handling the 'reclaim' command. The
+        # following tuple is passed:
+        #
+        # ('reclaim', dsrc_info, rrclass, dsrc_name)
+        #
+        # The parameters are the same as those of 'load'.  The segment is
+        # shared with readers (in the 'versioned' mode), and all of them
+        # have moved to the latest version of zones; opening it for write
+        # releases the old versions retired by the previous update.  The
+        # result is reported as 'load-completed', as this command takes
+        # the place of the second load of other segment types.
+        clist = dsrc_info.clients_map[rrclass]
+        sgmt_info = dsrc_info.segment_info_map[(rrclass, dsrc_name)]
+        params = json.dumps(sgmt_info.get_reset_param(SegmentInfo.WRITER))
+        try:
+            clist.reset_memory_segment(dsrc_name,
+                                       ConfigurableClientList.READ_WRITE,
+                                       params)
+            logger.debug(logger.DBGLVL_TRACE_BASIC,
+                         LIBMEMMGR_BUILDER_SEGMENT_RESET, dsrc_name, rrclass)
+            succeeded = True
+        except Exception as ex:
+            # The old versions are then left in the segment until the next
+            # update.
+            logger.error(LIBMEMMGR_BUILDER_RESET_SEGMENT_ERROR, dsrc_name,
+                         rrclass, ex)
+            succeeded = False
+
+        # See _handle_load().
+        if succeeded:
+            clist.reset_memory_segment(dsrc_name,
+                                       ConfigurableClientList.READ_ONLY,
+                                       params)
+        self.__send_response(('load-completed', dsrc_info, rrclass, dsrc_name,
+                              succeeded))
+
     # Helper of main loop: discard any commands that involve data source info
     # that is to be canceled.  Or if 'shutdown' has been sent, simply ignore
     # all others.  This is essentially a private method, but defined as
@@ -303,7 +350,7 @@ class MemorySegmentBuilder:
         for cmd in commands:
             if cmd[0] == 'shutdown':
                 return [cmd]
-            if cmd[0] == 'validate' and cmd[1] in canceled_info:
+            if cmd[0] in ('validate', 'reclaim') and cmd[1] in canceled_info:
                 continue
             if cmd[0] == 'load' and cmd[2] in canceled_info:
                 continue
@@ -355,6 +402,9 @@ class MemorySegmentBuilder:
                         command_tuple
                     self._handle_load(zone_name, dsrc_info, rrclass,
                                       dsrc_name)
+                elif command == 'reclaim':
+                    _, dsrc_info, rrclass, dsrc_name = command_tuple
+                    self._handle_reclaim(dsrc_info, rrclass, dsrc_name)
                 elif command == 'shutdown':
                     self.__handle_shutdown()
                     # When the shutdown command is received, we do
@@ -167,6 +167,9 @@ class SegmentInfo:
         if not self.__old_readers:
             if self.__state is self.SYNCHRONIZING:
                 self.__state = self.COPYING
+                if self.__events:
+                    return self._copy_event(self.__events.popleft())
+                return None
             elif self.__state is self.SYNCHRONIZING2:
                 return self.__check_on_ready()
             else:
@@ -432,7 +435,8 @@ class SegmentInfo:
 
         This is specifically for the memmgr, and segments that are not of
         its interest will be ignored.  This method returns None in these
-        cases.  At least 'local' type segments will be ignored this way.
+        cases.  At least 'local' and 'local-slab' type segments will be
+        ignored this way.
 
         If an unknown type of segment is specified, this method throws an
         SegmentInfoError exception.  The assumption is that this method
@@ -455,7 +459,7 @@ class SegmentInfo:
         """
         if type == 'mapped':
             return MappedSegmentInfo(genid, rrclass, datasrc_name, mgr_config)
-        elif type is None or type == 'local':
+        elif type is None or type == 'local' or type == 'local-slab':
             return None
         raise SegmentInfoError('unknown segment type to create info: ' + type)
 
@@ -521,6 +525,19 @@ class SegmentInfo:
         """
         raise SegmentInfoError('_switch_versions is not implemented')
 
+    def _copy_event(self, event):
+        """Return the builder command for the COPYING state.
+
+        This is called when the state changes from SYNCHRONIZING to
+        COPYING, with the event that has been applied to the segment for
+        readers, and the returned command is used to bring the other
+        segment up to date.  By default it's the same event; a subclass
+        can override this method if the COPYING step needs to do something
+        else.
+
+        """
+        return event
+
 def _validate_mapped_segment_file(filename):
     """Callable used by MappedSegmentInfo, validating a mapped segment file.
 
@@ -552,6 +569,27 @@ class MappedSegmentInfo(SegmentInfo):
             'zone-' + str(rrclass) + '-' + str(genid) + '-' + datasrc_name + \
             '-mapped'
 
+        # Options of how the file should be mapped, passed to the users as
+        # part of the reset parameters.  Prefaulting and NUMA interleaving
+        # only matter for readers.
+        self.__writer_options = {}
+        if mgr_config.get('mapped_huge_pages'):
+            self.__writer_options['huge-pages'] = True
+        self.__reader_options = dict(self.__writer_options)
+        if mgr_config.get('mapped_prefault'):
+            self.__reader_options['prefault'] = True
+        if mgr_config.get('mapped_numa_interleave'):
+            self.__reader_options['numa-interleave'] = True
+
+        # In the versioned mode, memmgr updates a single mapped file while
+        # the readers are using it (see _copy_event()).  The file has a
+        # different name so it's never confused with a file of the other
+        # mode.
+        self.__versioned = bool(mgr_config.get('mapped_versioned'))
+        if self.__versioned:
+            self.__writer_options['versioned'] = True
+            self.__reader_options['versioned'] = True
+
         # Current versions (suffix of the mapped files) for readers and the
         # writer.  In this initial implementation we assume that all possible
         # readers are waiting for a new version (not using pre-existing one),
@@ -567,6 +605,13 @@ class MappedSegmentInfo(SegmentInfo):
         self.__reader_file_validated = False
 
         self.__map_versions_file = self.__mapped_file_base + '-vers.json'
+        if self.__versioned:
+            # There's only one file, so there's nothing to switch.
+            shared_file = self.__mapped_file_base + '.v'
+            self.__rvalidate_action = \
+                lambda: _validate_mapped_segment_file(shared_file)
+            self.__wvalidate_action = self.__rvalidate_action
+            return
         if os.path.exists(self.__map_versions_file):
             try:
                 with open(self.__map_versions_file) as f:
@@ -612,9 +657,17 @@ class MappedSegmentInfo(SegmentInfo):
         if utype == self.READER and not self.__reader_file_validated:
             return {'mapped-file': None}
 
-        ver = self.__reader_ver if utype == self.READER else self.__writer_ver
-        mapped_file = self.__mapped_file_base + '.' + str(ver)
-        return {'mapped-file': mapped_file}
+        if utype == self.READER:
+            ver = self.__reader_ver
+            param = dict(self.__reader_options)
+        else:
+            ver = self.__writer_ver
+            param = dict(self.__writer_options)
+        if self.__versioned:
+            param['mapped-file'] = self.__mapped_file_base + '.v'
+        else:
+            param['mapped-file'] = self.__mapped_file_base + '.' + str(ver)
+        return param
 
     def _start_validate(self):
         return self.__rvalidate_action, self.__wvalidate_action
@@ -624,6 +677,11 @@ class MappedSegmentInfo(SegmentInfo):
             self.__reader_file_validated = True
 
     def _switch_versions(self):
+        # In the versioned mode readers use the file just updated.
+        if self.__versioned:
+            self.__reader_file_validated = True
+            return
+
         # Swith the versions as noted in the constructor.
         self.__reader_ver = 1 - self.__reader_ver
         self.__writer_ver = 1 - self.__writer_ver
@@ -661,8 +719,18 @@ class MappedSegmentInfo(SegmentInfo):
         for vers in (0, 1):
             mapped_file = '%s.%d' % (self.__mapped_file_base, vers)
             rmfile(mapped_file)
+        rmfile(self.__mapped_file_base + '.v')
         logger.info(LIBMEMMGR_MAPPED_SEGMENT_REMOVED, self.get_generation_id())
 
+    def _copy_event(self, event):
+        # In the versioned mode the readers share the single file, which is
+        # already up to date; once they have all moved to it, the old zone
+        # data it still holds can be reclaimed.  The event is a 'load'
+        # command: ('load', zone_name, dsrc_info, rrclass, dsrc_name).
+        if self.__versioned:
+            return ('reclaim',) + tuple(event[2:])
+        return event
+
 class DataSrcInfo:
     """A container for datasrc.ConfigurableClientLists and associated
     in-memory segment information corresponding to a given geration of
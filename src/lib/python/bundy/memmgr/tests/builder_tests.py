@@ -513,10 +513,12 @@ class TestMemorySegmentBuilderWithoutThread(unittest.TestCase):
                     ('validate', 'info3'),
                     ('cancel', 'info1'), ('cancel', 'info2'),
                     ('validate', 'info2'), ('load', 1, 'info1'),
-                    ('load', 2, 'info3')]
+                    ('load', 2, 'info3'), ('reclaim', 'info2'),
+                    ('reclaim', 'info3')]
         result = self.__builder._handle_cancels(commands)
         self.assertEqual([('validate', 'info3'), ('cancel', 'info1'),
-                          ('cancel', 'info2'), ('load', 2, 'info3')], result)
+                          ('cancel', 'info2'), ('load', 2, 'info3'),
+                          ('reclaim', 'info3')], result)
 
         commands.extend([('shutdown',), ('load', 3, 'info4')])
         result = self.__builder._handle_cancels(commands)
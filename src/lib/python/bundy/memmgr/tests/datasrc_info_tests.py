@@ -73,6 +73,10 @@ class TestSegmentInfo(unittest.TestCase):
         self.__check_sgmt_reset_param(SegmentInfo.WRITER, 1)
         self.__check_sgmt_reset_param(SegmentInfo.READER, None)
 
+        # By default, no mapping option is included.
+        self.assertEqual(['mapped-file'], list(
+            self.__sgmt_info.get_reset_param(SegmentInfo.WRITER).keys()))
+
         self.assertEqual(self.__sgmt_info.get_state(), SegmentInfo.INIT)
         self.assertEqual(self.__sgmt_info.get_generation_id(), 0)
         self.assertEqual(len(self.__sgmt_info.get_readers()), 0)
@@ -110,6 +114,63 @@ class TestSegmentInfo(unittest.TestCase):
         self.assertEqual(False, raction())
         self.assertEqual(False, waction()) # should be the same result
 
+    def test_mapping_options(self):
+        sgmt_info = SegmentInfo.create('mapped', 0, RRClass.IN, 'sqlite3',
+                                       {'mapped_file_dir':
+                                            self.__mapped_file_dir,
+                                        'mapped_huge_pages': True,
+                                        'mapped_prefault': True,
+                                        'mapped_numa_interleave': False})
+        # Huge pages are for both readers and the writer; prefault is only
+        # for readers.
+        param = sgmt_info.get_reset_param(SegmentInfo.WRITER)
+        self.assertEqual({'mapped-file': self.__mapped_file_base + '1',
+                          'huge-pages': True}, param)
+        # Once the reader file is validated, it's passed to readers.
+        sgmt_info.start_validate()
+        sgmt_info.complete_validate(True)
+        param = sgmt_info.get_reset_param(SegmentInfo.READER)
+        self.assertEqual({'mapped-file': self.__mapped_file_base + '0',
+                          'huge-pages': True, 'prefault': True}, param)
+
+    def test_versioned(self):
+        sgmt_info = SegmentInfo.create('mapped', 0, RRClass.IN, 'sqlite3',
+                                       {'mapped_file_dir':
+                                            self.__mapped_file_dir,
+                                        'mapped_versioned': True})
+        shared_file = self.__mapped_file_base + 'v'
+        self.assertEqual({'mapped-file': shared_file, 'versioned': True},
+                         sgmt_info.get_reset_param(SegmentInfo.WRITER))
+
+        # Both actions validate the single file.
+        raction, waction = sgmt_info.start_validate()
+        self.assertFalse(raction())
+        self.assertFalse(waction())
+        with open(shared_file, 'w'): pass
+        self.assertTrue(raction())
+        self.assertTrue(waction())
+
+        # Go through the initial load.  The load is applied only once; the
+        # COPYING state reclaims old data instead of loading again.
+        load_event = ('load', None, 'dsrc_info', RRClass.IN, 'sqlite3')
+        sgmt_info.add_event(('validate',))
+        sgmt_info.add_event(load_event)
+        self.assertEqual(('validate',), sgmt_info.complete_validate(False))
+        self.assertEqual(load_event, sgmt_info.complete_validate(True))
+        self.assertEqual(('reclaim', 'dsrc_info', RRClass.IN, 'sqlite3'),
+                         sgmt_info.complete_update(True))
+        self.assertEqual(SegmentInfo.COPYING, sgmt_info.get_state())
+
+        # The versions are never switched, and no versions file is written.
+        self.assertEqual({'mapped-file': shared_file, 'versioned': True},
+                         sgmt_info.get_reset_param(SegmentInfo.READER))
+        self.assertFalse(os.path.exists(self.__ver_file))
+        self.assertIsNone(sgmt_info.complete_update(True))
+        self.assertEqual(SegmentInfo.READY, sgmt_info.get_state())
+
+        sgmt_info.remove()
+        self.assertFalse(os.path.exists(shared_file))
+
     def __si_to_rvalidate_state(self):
         # Go to a default starting state
         self.__sgmt_info = SegmentInfo.create('mapped', 0, RRClass.IN,
@@ -626,6 +687,8 @@ class TestSegmentInfo(unittest.TestCase):
         # created.
         self.assertIsNone(SegmentInfo.create('local', 0, RRClass.IN,
                                              'sqlite3', {}))
+        self.assertIsNone(SegmentInfo.create('local-slab', 0, RRClass.IN,
+                                             'sqlite3', {}))
 
         # Unknown type of segment will result in an exception.
         self.assertRaises(SegmentInfoError, SegmentInfo.create, 'unknown', 0,
@@ -13,6 +13,7 @@
 # NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION
 # WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
+import os
 import select
 import sys
 import random
@@ -36,6 +37,16 @@ logger = bundy.log.Logger("notify_out")
 # initialized yet. see trac ticket #1103
 from bundy.dns import *
 
+# The native sender, used when NotifyOut is asked to.  In the build tree,
+# the module is found in .libs.
+try:
+    from bundy.notify._notify import NotifySender
+except ImportError:
+    try:
+        from _notify import NotifySender
+    except ImportError:
+        NotifySender = None
+
 ZONE_NEW_DATA_READY_CMD = 'zone_new_data_ready'
 ZONE_XFRIN_FAILED = 'zone_xfrin_failed'
 
@@ -44,6 +55,10 @@ _MAX_NOTIFY_TRY_NUM = 5
 _EVENT_READ = 1
 _EVENT_TIMEOUT = 2
 _NOTIFY_TIMEOUT = 1
+# Maximum number of notifies outstanding at a time with the native sender,
+# and how long it runs (in milliseconds) before the results are collected.
+_NATIVE_MAX_NOTIFY_NUM = 1000
+_NATIVE_RUN_TIMEOUT = 1000
 
 # define the rcode for parsing notify reply message
 _REPLY_OK = 0
@@ -127,8 +142,16 @@ class NotifyOut:
     '''This class is used to handle notify logic for all zones(sending
     notify message to its slaves). notify service can be started by
     calling  dispatcher(), and it can be stopped by calling shutdown()
-    in another thread. '''
-    def __init__(self, datasrc_file, counters=None, verbose=True):
+    in another thread.
+
+    If native is True and the native sender is available, the notifies are
+    sent by it instead: the zones passed to send_notify() are handed over
+    to it in bulk by the dispatcher thread, and all their secondaries are
+    notified in parallel (up to _NATIVE_MAX_NOTIFY_NUM notifies at a time),
+    with the sending, retransmissions and responses handled in C++.
+    '''
+    def __init__(self, datasrc_file, counters=None, verbose=True,
+                 native=False):
         self._notify_infos = {} # key is (zone_name, zone_class)
         self._waiting_zones = []
         self._notifying_zones = []
@@ -144,6 +167,16 @@ class NotifyOut:
         # If there are no notifying zones, clear the event bit and wait.
         self._nonblock_event = threading.Event()
         self._counters = counters
+        # The native sender, if used.  _native_queue holds the zones to be
+        # handed over to it, and _native_zones the ZoneNotifyInfo and the
+        # number of notifies not done, by the sender's zone identifier.
+        self._native = None
+        if native and NotifySender is not None:
+            self._native = NotifySender(_NATIVE_MAX_NOTIFY_NUM,
+                                        _NOTIFY_TIMEOUT * 2000,
+                                        _MAX_NOTIFY_TRY_NUM)
+        self._native_queue = []
+        self._native_zones = {}
 
     def _init_notify_out(self, datasrc_file):
         '''Get all the zones name and its notify target's address.
@@ -189,6 +222,11 @@ class NotifyOut:
             return True
 
         with self._lock:
+            if self._native is not None:
+                if zone_id not in self._native_queue:
+                    self._native_queue.append(zone_id)
+                    self._native.wakeup()
+                return True
             if (self.notify_num >= _MAX_NOTIFY_NUM) or (zone_id in self._notifying_zones):
                 if zone_id not in self._waiting_zones:
                     self._waiting_zones.append(zone_id)
@@ -202,6 +240,9 @@ class NotifyOut:
 
     def _dispatcher(self, started_event):
         started_event.set() # Let the master know we are alive already
+        if self._native is not None:
+            self._native_dispatcher()
+            return
         while self._serving:
             replied_zones, not_replied_zones = self._wait_for_notify_reply()
 
@@ -259,6 +300,8 @@ class NotifyOut:
             # set self._nonblock_event to stop waiting for new notifying zones.
             self._nonblock_event.set()
         self._write_sock.send(SOCK_DATA) # make self._read_sock be readable.
+        if self._native is not None:
+            self._native.wakeup()
 
         # Wait for it
         self._thread.join()
@@ -270,6 +313,82 @@ class NotifyOut:
         self._read_sock = None
         self._thread = None
 
+    def _native_dispatcher(self):
+        '''The dispatcher loop with the native sender.'''
+        while self._serving:
+            with self._lock:
+                zones = self._native_queue
+                self._native_queue = []
+            if zones:
+                self._native_add(zones)
+            # Without notifies in progress, wait for send_notify() or
+            # shutdown() to wake us up.
+            timeout = 0
+            if self._native.get_pending_count() > 0:
+                timeout = _NATIVE_RUN_TIMEOUT
+            self._native.run(timeout)
+            self._native_handle_results()
+
+    def _native_add(self, zones):
+        '''Hand the notifies of the given zones over to the native sender.'''
+        targets = 0
+        for zone_id in zones:
+            zone_notify_info = self._notify_infos[zone_id]
+            try:
+                msg, _ = self._create_notify_message(
+                    Name(zone_notify_info.zone_name),
+                    RRClass(zone_notify_info.zone_class))
+            except Exception as ex:
+                logger.error(NOTIFY_OUT_ZONE_NOT_NOTIFIED,
+                             format_zone_str(Name(zone_notify_info.zone_name),
+                                             RRClass(zone_notify_info.zone_class)),
+                             ex)
+                continue
+            render = MessageRenderer()
+            render.set_length_limit(512)
+            msg.to_wire(render)
+            zone, rejected = self._native.add(render.get_data(),
+                                              zone_notify_info.notify_slaves)
+            for tgt in rejected:
+                logger.error(NOTIFY_OUT_INVALID_ADDRESS, AddressFormatter(tgt),
+                             'not an IPv4 or IPv6 address')
+            count = len(zone_notify_info.notify_slaves) - len(rejected)
+            if count > 0:
+                self._native_zones[zone] = [zone_notify_info, count]
+                targets += count
+        logger.debug(logger.DBGLVL_TRACE_BASIC, NOTIFY_OUT_SENDING_NOTIFIES,
+                     len(zones), targets)
+
+    def _native_handle_results(self):
+        '''Log the outcome of the notifies done by the native sender, and
+        count the notifies sent.'''
+        for (zone, address, port, tries, replied, rcode, error) in \
+                self._native.get_results():
+            entry = self._native_zones[zone]
+            zone_notify_info = entry[0]
+            entry[1] -= 1
+            if entry[1] == 0:
+                del self._native_zones[zone]
+
+            tgt = (address, port)
+            if self._counters is not None and tries > 0:
+                counter = 'notifyoutv6' if ':' in address else 'notifyoutv4'
+                for _ in range(tries):
+                    self._counters.inc('zones', zone_notify_info.zone_class,
+                                       zone_notify_info.zone_name, counter)
+            if replied:
+                logger.debug(logger.DBGLVL_TRACE_BASIC,
+                             NOTIFY_OUT_REPLY_RECEIVED,
+                             zone_notify_info.zone_name,
+                             zone_notify_info.zone_class,
+                             AddressFormatter(tgt), Rcode(rcode))
+            elif error != 0:
+                logger.error(NOTIFY_OUT_SOCKET_ERROR, AddressFormatter(tgt),
+                             os.strerror(error))
+            else:
+                logger.warn(NOTIFY_OUT_RETRY_EXCEEDED, AddressFormatter(tgt),
+                            _MAX_NOTIFY_TRY_NUM)
+
     def _get_rdata_data(self, rr):
         return rr[7].strip()
 
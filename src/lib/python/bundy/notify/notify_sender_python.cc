@@ -0,0 +1,378 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#define PY_SSIZE_T_CLEAN
+
+// Python.h needs to be placed at the head of the program file, see:
+// http://docs.python.org/py3k/extending/extending.html#a-simple-example
+#include <Python.h>
+
+#include <util/python/pycppwrapper_util.h>
+
+#include <asiodns/notify_sender.h>
+#include <exceptions/exceptions.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace bundy::util::python;
+using bundy::asiodns::NotifySender;
+
+namespace {
+
+const char* const NotifySender_doc = "\
+NotifySender(max_outstanding=1000, timeout=2000, max_tries=5)\n\
+\n\
+Sender of NOTIFY messages to many secondary servers.\n\
+\n\
+The NOTIFY message of each zone is given once in wire format, and is sent\n\
+to each of its targets with only the query ID changed.  The messages are\n\
+sent and the responses received in batches over one UDP socket per\n\
+address family, and the NOTIFYs are resent with an exponential backoff\n\
+until the targets answer, all in C++.\n\
+\n\
+No more than max_outstanding NOTIFYs are outstanding at a time.  A NOTIFY\n\
+is given up after being sent max_tries times; timeout is the time to\n\
+wait for the first response in milliseconds, and doubles after each try.\n\
+\n\
+The sender is driven by run(), which must be called in a single thread\n\
+along with the other methods but wakeup().\n\
+\n\
+Exceptions:\n\
+  ValueError A parameter is out of range.\n\
+";
+
+const char* const NotifySender_add_doc = "\
+add(message, targets) -> (zone, rejected)\n\
+\n\
+Send the NOTIFY message of a zone to a list of targets.\n\
+\n\
+message is the message in wire format (bytes); its query ID is ignored.\n\
+targets is a list of (address, port) tuples.  The NOTIFYs are sent by the\n\
+next run().\n\
+\n\
+This returns an identifier of the zone, which the results refer to, and\n\
+the list of the targets rejected for an invalid address.\n\
+\n\
+Exceptions:\n\
+  ValueError message is not a NOTIFY message with a single question.\n\
+";
+
+const char* const NotifySender_run_doc = "\
+run(timeout) -> int\n\
+\n\
+Send the NOTIFYs and handle the responses and timeouts.\n\
+\n\
+This returns when all NOTIFYs are done, after timeout milliseconds (0\n\
+for no limit), or when wakeup() is called, and returns the number of\n\
+results available.  If there's nothing to do, it waits for the timeout\n\
+or a wakeup.  The Python interpreter lock is released meanwhile.\n\
+";
+
+const char* const NotifySender_wakeup_doc = "\
+wakeup() -> None\n\
+\n\
+Make run() return as soon as possible (at once for the next call if it's\n\
+not running).  This can be called from any thread.\n\
+";
+
+const char* const NotifySender_get_results_doc = "\
+get_results() -> list\n\
+\n\
+Return the outcome of the NOTIFYs done so far, and forget them.\n\
+\n\
+Each is a tuple (zone, address, port, tries, replied, rcode, error):\n\
+zone is the identifier returned by add(), tries the number of times the\n\
+NOTIFY was sent, replied whether the target answered, rcode the RCODE\n\
+of the response (as an integer), and error the errno value if the NOTIFY\n\
+couldn't be sent (0 otherwise).\n\
+";
+
+const char* const NotifySender_get_pending_count_doc = "\
+get_pending_count() -> int\n\
+\n\
+Return the number of NOTIFYs not done yet.\n\
+";
+
+// PyType_GenericNew() zeroes the object, so cppobj is NULL until __init__
+// succeeds.
+class s_NotifySender : public PyObject {
+public:
+    NotifySender* cppobj;
+};
+
+int
+NotifySender_init(PyObject* po_self, PyObject* args, PyObject*) {
+    s_NotifySender* self = static_cast<s_NotifySender*>(po_self);
+    unsigned long max_outstanding = NotifySender::DEFAULT_MAX_OUTSTANDING;
+    long timeout = NotifySender::DEFAULT_TIMEOUT;
+    unsigned int max_tries = NotifySender::DEFAULT_MAX_TRIES;
+    if (!PyArg_ParseTuple(args, "|klI", &max_outstanding, &timeout,
+                          &max_tries)) {
+        return (-1);
+    }
+    try {
+        delete self->cppobj;
+        self->cppobj = NULL;
+        self->cppobj = new NotifySender(max_outstanding, timeout, max_tries);
+        return (0);
+    } catch (const bundy::BadValue& ex) {
+        PyErr_SetString(PyExc_ValueError, ex.what());
+    } catch (const std::exception& ex) {
+        PyErr_SetString(PyExc_SystemError, ex.what());
+    } catch (...) {
+        PyErr_SetString(PyExc_SystemError, "Unknown C++ exception");
+    }
+    return (-1);
+}
+
+void
+NotifySender_destroy(PyObject* po_self) {
+    s_NotifySender* self = static_cast<s_NotifySender*>(po_self);
+    delete self->cppobj;
+    self->cppobj = NULL;
+    Py_TYPE(self)->tp_free(self);
+}
+
+// Check the object was initialized, as it can't be used otherwise.
+NotifySender*
+getSender(PyObject* po_self) {
+    NotifySender* sender = static_cast<s_NotifySender*>(po_self)->cppobj;
+    if (sender == NULL) {
+        PyErr_SetString(PyExc_TypeError, "NotifySender is not initialized");
+    }
+    return (sender);
+}
+
+PyObject*
+NotifySender_add(PyObject* po_self, PyObject* args) {
+    NotifySender* sender = getSender(po_self);
+    const char* data;
+    Py_ssize_t length;
+    PyObject* targets;
+    if (sender == NULL ||
+        !PyArg_ParseTuple(args, "y#O!", &data, &length, &PyList_Type,
+                          &targets)) {
+        return (NULL);
+    }
+    try {
+        // Parse the targets first, so nothing is added on error.
+        std::vector<std::pair<std::string, uint16_t> > parsed;
+        for (Py_ssize_t i = 0; i < PyList_Size(targets); ++i) {
+            const char* address;
+            unsigned short port;
+            if (!PyArg_ParseTuple(PyList_GetItem(targets, i), "sH",
+                                  &address, &port)) {
+                return (NULL);
+            }
+            parsed.push_back(std::make_pair(address, port));
+        }
+
+        const size_t zone = sender->addZone(data, length);
+        PyObjectContainer rejected(PyList_New(0));
+        for (size_t i = 0; i < parsed.size(); ++i) {
+            try {
+                sender->addTarget(zone, parsed[i].first, parsed[i].second);
+            } catch (const bundy::BadValue&) {
+                if (PyList_Append(rejected.get(),
+                                  PyList_GetItem(targets, i)) < 0) {
+                    return (NULL);
+                }
+            }
+        }
+        return (Py_BuildValue("(kO)", static_cast<unsigned long>(zone),
+                              rejected.get()));
+    } catch (const bundy::BadValue& ex) {
+        PyErr_SetString(PyExc_ValueError, ex.what());
+    } catch (const PyCPPWrapperException&) {
+        // The Python error is set.
+    } catch (const std::exception& ex) {
+        PyErr_SetString(PyExc_SystemError, ex.what());
+    } catch (...) {
+        PyErr_SetString(PyExc_SystemError, "Unknown C++ exception");
+    }
+    return (NULL);
+}
+
+PyObject*
+NotifySender_run(PyObject* po_self, PyObject* args) {
+    NotifySender* sender = getSender(po_self);
+    long timeout;
+    if (sender == NULL || !PyArg_ParseTuple(args, "l", &timeout)) {
+        return (NULL);
+    }
+    try {
+        size_t count;
+        {
+            GILReleaser releaser;
+            count = sender->run(timeout);
+        }
+        return (Py_BuildValue("k", static_cast<unsigned long>(count)));
+    } catch (const std::exception& ex) {
+        PyErr_SetString(PyExc_SystemError, ex.what());
+    } catch (...) {
+        PyErr_SetString(PyExc_SystemError, "Unknown C++ exception");
+    }
+    return (NULL);
+}
+
+PyObject*
+NotifySender_wakeup(PyObject* po_self, PyObject*) {
+    NotifySender* sender = getSender(po_self);
+    if (sender == NULL) {
+        return (NULL);
+    }
+    sender->wakeup();
+    Py_RETURN_NONE;
+}
+
+PyObject*
+NotifySender_get_results(PyObject* po_self, PyObject*) {
+    NotifySender* sender = getSender(po_self);
+    if (sender == NULL) {
+        return (NULL);
+    }
+    try {
+        const std::vector<NotifySender::Result> results =
+            sender->getResults();
+        PyObjectContainer list(PyList_New(results.size()));
+        for (size_t i = 0; i < results.size(); ++i) {
+            const NotifySender::Result& result = results[i];
+            PyObject* item = Py_BuildValue(
+                "(ksHIOIi)", static_cast<unsigned long>(result.zone_),
+                result.address_.c_str(), result.port_, result.tries_,
+                result.replied_ ? Py_True : Py_False, result.rcode_,
+                result.error_);
+            if (item == NULL) {
+                return (NULL);
+            }
+            PyList_SET_ITEM(list.get(), i, item);
+        }
+        return (list.release());
+    } catch (const PyCPPWrapperException&) {
+        // The Python error is set.
+    } catch (const std::exception& ex) {
+        PyErr_SetString(PyExc_SystemError, ex.what());
+    } catch (...) {
+        PyErr_SetString(PyExc_SystemError, "Unknown C++ exception");
+    }
+    return (NULL);
+}
+
+PyObject*
+NotifySender_get_pending_count(PyObject* po_self, PyObject*) {
+    NotifySender* sender = getSender(po_self);
+    if (sender == NULL) {
+        return (NULL);
+    }
+    return (Py_BuildValue("k", static_cast<unsigned long>(
+                              sender->getPendingCount())));
+}
+
+PyMethodDef NotifySender_methods[] = {
+    { "add", NotifySender_add, METH_VARARGS, NotifySender_add_doc },
+    { "run", NotifySender_run, METH_VARARGS, NotifySender_run_doc },
+    { "wakeup", NotifySender_wakeup, METH_NOARGS, NotifySender_wakeup_doc },
+    { "get_results", NotifySender_get_results, METH_NOARGS,
+      NotifySender_get_results_doc },
+    { "get_pending_count", NotifySender_get_pending_count, METH_NOARGS,
+      NotifySender_get_pending_count_doc },
+    { NULL, NULL, 0, NULL }
+};
+
+PyTypeObject notifysender_type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "bundy.notify._notify.NotifySender",
+    sizeof(s_NotifySender),             // tp_basicsize
+    0,                                  // tp_itemsize
+    NotifySender_destroy,               // tp_dealloc
+    NULL,                               // tp_print
+    NULL,                               // tp_getattr
+    NULL,                               // tp_setattr
+    NULL,                               // tp_reserved
+    NULL,                               // tp_repr
+    NULL,                               // tp_as_number
+    NULL,                               // tp_as_sequence
+    NULL,                               // tp_as_mapping
+    NULL,                               // tp_hash
+    NULL,                               // tp_call
+    NULL,                               // tp_str
+    NULL,                               // tp_getattro
+    NULL,                               // tp_setattro
+    NULL,                               // tp_as_buffer
+    Py_TPFLAGS_DEFAULT,                 // tp_flags
+    NotifySender_doc,
+    NULL,                               // tp_traverse
+    NULL,                               // tp_clear
+    NULL,                               // tp_richcompare
+    0,                                  // tp_weaklistoffset
+    NULL,                               // tp_iter
+    NULL,                               // tp_iternext
+    NotifySender_methods,               // tp_methods
+    NULL,                               // tp_members
+    NULL,                               // tp_getset
+    NULL,                               // tp_base
+    NULL,                               // tp_dict
+    NULL,                               // tp_descr_get
+    NULL,                               // tp_descr_set
+    0,                                  // tp_dictoffset
+    NotifySender_init,                  // tp_init
+    NULL,                               // tp_alloc
+    PyType_GenericNew,                  // tp_new
+    NULL,                               // tp_free
+    NULL,                               // tp_is_gc
+    NULL,                               // tp_bases
+    NULL,                               // tp_mro
+    NULL,                               // tp_cache
+    NULL,                               // tp_subclasses
+    NULL,                               // tp_weaklist
+    NULL,                               // tp_del
+    0,                                  // tp_version_tag
+    BUNDY_UTIL_PYTHON_PyVarObject_TAIL_INIT
+};
+
+PyModuleDef notify_module = {
+    { PyObject_HEAD_INIT(NULL) NULL, 0, NULL},
+    "bundy.notify._notify",
+    "Native NOTIFY sender used by bundy.notify.notify_out",
+    -1,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
+} // end of unnamed namespace
+
+PyMODINIT_FUNC
+PyInit__notify(void) {
+    PyObject* mod = PyModule_Create(&notify_module);
+    if (mod == NULL) {
+        return (NULL);
+    }
+    if (PyType_Ready(&notifysender_type) < 0) {
+        Py_DECREF(mod);
+        return (NULL);
+    }
+    void* p = &notifysender_type;
+    if (PyModule_AddObject(mod, "NotifySender",
+                           static_cast<PyObject*>(p)) < 0) {
+        Py_DECREF(mod);
+        return (NULL);
+    }
+    Py_INCREF(&notifysender_type);
+    return (mod);
+}
@@ -543,6 +543,71 @@ class TestNotifyOut(unittest.TestCase):
         self.assertTrue(self._notify._nonblock_event.isSet())
         self.assertFalse(thread.is_alive())
 
+@unittest.skipIf(notify_out.NotifySender is None,
+                 'the native notify sender is not available')
+class TestNotifyOutNative(unittest.TestCase):
+    def setUp(self):
+        self._db_file = TESTDATA_SRCDIR + '/test.sqlite3'
+        self._notify = notify_out.NotifyOut(self._db_file,
+                                            counters=Counters(SPECFILE_LOCATION),
+                                            native=True)
+        # A secondary server for example.net, and an invalid one.
+        self._secondary = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self._secondary.bind(('127.0.0.1', 0))
+        self._secondary.settimeout(10)
+        net_info = notify_out.ZoneNotifyInfo('example.net.', 'IN')
+        net_info.notify_slaves = [self._secondary.getsockname(),
+                                  ('192.0.2.256', 53)]
+        self._notify._notify_infos[('example.net.', 'IN')] = net_info
+        self._notify._notify_infos[('nosuch.example.', 'IN')] = \
+            notify_out.ZoneNotifyInfo('nosuch.example.', 'IN')
+        self._notify._notify_infos[('nosuch.example.', 'IN')].notify_slaves = \
+            [self._secondary.getsockname()]
+
+    def tearDown(self):
+        if self._notify._serving:
+            self._notify.shutdown()
+        self._secondary.close()
+        self._notify._counters.clear_all()
+
+    def test_not_native(self):
+        notify = notify_out.NotifyOut(self._db_file)
+        self.assertIsNone(notify._native)
+
+    def test_send_notify(self):
+        thread = self._notify.dispatcher()
+        self.assertTrue(self._notify.send_notify('example.net'))
+        self.assertFalse(self._notify.send_notify('example.xxx'))
+
+        data, addr = self._secondary.recvfrom(512)
+        msg = Message(Message.PARSE)
+        msg.from_wire(data)
+        self.assertEqual(Opcode.NOTIFY, msg.get_opcode())
+        self.assertEqual(Name('example.net'), msg.get_question()[0].get_name())
+        self.assertEqual(RRType.SOA,
+                         msg.get_section(Message.SECTION_ANSWER)[0].get_type())
+
+        # The response completes the notify.
+        self._secondary.sendto(get_notify_msgdata(Name('example.net'),
+                                                  msg.get_qid()), addr)
+        deadline = time.time() + 10
+        while self._notify._native_zones and time.time() < deadline:
+            time.sleep(0.01)
+        self.assertEqual({}, self._notify._native_zones)
+        self.assertEqual(0, self._notify._native.get_pending_count())
+
+        self._notify.shutdown()
+        self.assertFalse(thread.is_alive())
+        self.assertEqual(1, self._notify._counters.get(
+                'zones', 'IN', 'example.net.', 'notifyoutv4'))
+
+    def test_zone_not_found(self):
+        # Zones whose SOA can't be found are skipped.
+        self._notify._native_add([('nosuch.example.', 'IN'),
+                                  ('example.net.', 'IN')])
+        self.assertEqual(1, self._notify._native.get_pending_count())
+        self.assertEqual(1, len(self._notify._native_zones))
+
 if __name__== "__main__":
     bundy.log.init("bundy")
     bundy.log.resetUnitTestRootLogger()
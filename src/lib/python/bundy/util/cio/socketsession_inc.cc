@@ -56,6 +56,10 @@ SocketSessionForwarder is the sender of the UNIX domain connection,\n\
 while SocketSessionReceiver is the receiver (this interface assumes\n\
 one direction of forwarding).\n\
 \n\
+Connecting, pushing and popping sessions release the Python global\n\
+interpreter lock, so other threads can run while they wait.  An object\n\
+must not be used by several threads at the same time.\n\
+\n\
 Note: this paragraph and following discussions on the internal\n\
 protocol are for reference purposes only; it's not necessary to\n\
 understand how to use the API.\n\
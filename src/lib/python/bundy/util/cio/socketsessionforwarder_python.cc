@@ -155,7 +155,10 @@ SocketSessionForwarder_connectToReceiver(PyObject* po_self, PyObject*) {
         static_cast<s_SocketSessionForwarder*>(po_self);
 
     try {
-        self->cppobj->connectToReceiver();
+        {
+            GILReleaser releaser;
+            self->cppobj->connectToReceiver();
+        }
         Py_RETURN_NONE;
     } catch (const bundy::BadValue& ex) {
         PyErr_SetString(PyExc_TypeError, ex.what());
@@ -193,10 +196,14 @@ SocketSessionForwarder_push(PyObject* po_self, PyObject* args) {
         struct sockaddr_storage ss_local, ss_remote;
         parsePySocketAddress(po_local_end, type, protocol, &ss_local);
         parsePySocketAddress(po_remote_end, type, protocol, &ss_remote);
-        self->cppobj->push(fd, family, type, protocol,
-                           *convertSockAddr(&ss_local),
-                           *convertSockAddr(&ss_remote),
-                           py_buf.buf, py_buf.len);
+        {
+            // The receiver may be slow to read the session.
+            GILReleaser releaser;
+            self->cppobj->push(fd, family, type, protocol,
+                               *convertSockAddr(&ss_local),
+                               *convertSockAddr(&ss_remote),
+                               py_buf.buf, py_buf.len);
+        }
         Py_RETURN_NONE;
     } catch (const AddressParseError& ex) {
         PyErr_SetString(PyExc_TypeError, ex.what());
@@ -164,6 +164,14 @@ struct ScopedSocket : boost::noncopyable {
     const int fd_;
 };
 
+// Pop a session without holding the GIL, as this blocks until a session
+// is forwarded.
+SocketSession
+popSession(SocketSessionReceiver& receiver) {
+    GILReleaser releaser;
+    return (receiver.pop());
+}
+
 PyObject*
 SocketSessionReceiver_pop(PyObject* po_self, PyObject*) {
     s_SocketSessionReceiver* const self =
@@ -172,7 +180,7 @@ SocketSessionReceiver_pop(PyObject* po_self, PyObject*) {
     try {
         // retrieve the session, and the convert it to a corresponding
         // Python tuple.
-        const SocketSession session = self->cppobj->pop();
+        const SocketSession session = popSession(*self->cppobj);
 
         // We need to immediately store the socket file descriptor in a
         // ScopedSocket object.  socket.fromfd() will dup() the FD, so we need
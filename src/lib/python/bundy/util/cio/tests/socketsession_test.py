@@ -225,7 +225,7 @@ class TestForwarder(unittest.TestCase):
     def test_push_too_fast(self):
         # A straightforward port of C++ pushTooFast test.
         def multi_push(forwarder, addr, data):
-            for i in range(0, 10):
+            for i in range(0, 30):
                 forwarder.push(1, AF_INET, SOCK_DGRAM, IPPROTO_UDP, addr,
                                addr, data)
         self.start_listen()
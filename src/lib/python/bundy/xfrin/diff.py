@@ -350,6 +350,60 @@ class Diff:
             # unusable.
             self.__updater = None
 
+    def replace_soa(self, rr):
+        """
+        Replaces the new SOA of the changes buffered in single_update_mode.
+
+        This lets several updates to the zone be merged into a single
+        changeset: the SOA the changeset ends with is replaced by the one
+        of the next update instead of being deleted and added again, which
+        isn't allowed as only the first deletion and addition may be SOA.
+
+        Raises a ValueError if the diff is not in single_update_mode, if
+        no SOA has been added yet, or in the same cases as add_data().
+        """
+        self.__check_committed()
+        if not self.__single_update_mode:
+            raise ValueError("replace_soa() can only be used in " +
+                             "single-update mode")
+        if rr.get_type() != bundy.dns.RRType.SOA:
+            raise ValueError("replace_soa() called with a non-SOA RR")
+        if rr.get_rdata_count() != 1:
+            raise ValueError('The rrset must contain exactly 1 Rdata, but ' +
+                             'it holds ' + str(rr.get_rdata_count()))
+        if len(self.__additions) == 0:
+            raise ValueError("No SOA to replace in single update mode")
+        self.__additions[0] = ('add', rr)
+
+    def save_buffers(self):
+        """
+        Returns a copy of the changes buffered in single_update_mode, which
+        can be passed to restore_buffers() to undo the changes buffered
+        since then.
+
+        Raises a ValueError if the diff is not in single_update_mode.
+        """
+        if not self.__single_update_mode:
+            raise ValueError("save_buffers() can only be used in " +
+                             "single-update mode")
+        return (list(self.__deletions), list(self.__additions))
+
+    def restore_buffers(self, saved):
+        """
+        Restores the changes buffered in single_update_mode to the state
+        returned by a previous call to save_buffers().
+
+        Raises a ValueError if the diff is not in single_update_mode or if
+        it was already committed.
+        """
+        self.__check_committed()
+        if not self.__single_update_mode:
+            raise ValueError("restore_buffers() can only be used in " +
+                             "single-update mode")
+        (deletions, additions) = saved
+        self.__deletions = list(deletions)
+        self.__additions = list(additions)
+
     def get_buffer(self):
         """
         Returns the current buffer of changes not yet passed into the data
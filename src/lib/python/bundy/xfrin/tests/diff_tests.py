@@ -677,6 +677,46 @@ class DiffTest(unittest.TestCase):
         self.assertEqual(1, len(deletions))
         self.assertEqual(1, len(additions))
 
+    def test_replace_soa(self):
+        '''
+        Test that the new SOA of a single update mode diff can be replaced,
+        and that the buffers can be saved and restored.
+        '''
+        new_soa = RRset(Name('example.org.'), self.__rrclass, RRType.SOA,
+                        RRTTL(3600))
+        new_soa.add_rdata(Rdata(RRType.SOA, self.__rrclass,
+                                "ns1.example.org. admin.example.org. " +
+                                "1234 3600 1800 2419200 7200"))
+
+        diff_multi = Diff(self, Name('example.org.'), single_update_mode=False)
+        self.assertRaises(ValueError, diff_multi.replace_soa, new_soa)
+        self.assertRaises(ValueError, diff_multi.save_buffers)
+
+        diff = Diff(self, Name('example.org.'), single_update_mode=True)
+        # There is no SOA to replace yet
+        self.assertRaises(ValueError, diff.replace_soa, new_soa)
+        diff.delete_data(self.__rrset_soa)
+        diff.add_data(self.__rrset_soa)
+        diff.add_data(self.__rrset3)
+        saved = diff.save_buffers()
+
+        # Only a SOA can replace the SOA
+        self.assertRaises(ValueError, diff.replace_soa, self.__rrset4)
+        diff.replace_soa(new_soa)
+        diff.add_data(self.__rrset4)
+        diff.delete_data(self.__rrset6)
+        self.assertEqual(([('delete', self.__rrset_soa),
+                           ('delete', self.__rrset6)],
+                          [('add', new_soa), ('add', self.__rrset3),
+                           ('add', self.__rrset4)]),
+                         diff.get_single_update_buffers())
+
+        diff.restore_buffers(saved)
+        self.assertEqual(([('delete', self.__rrset_soa)],
+                          [('add', self.__rrset_soa),
+                           ('add', self.__rrset3)]),
+                         diff.get_single_update_buffers())
+
     def test_find(self):
         diff = Diff(self, Name('example.org.'))
         name = Name('www.example.org.')
@@ -18,10 +18,13 @@
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <unistd.h>             // for some IPC/network system calls
+#include <algorithm>
 #include <string>
+#include <vector>
 
 #include <boost/lexical_cast.hpp>
 #include <boost/bind.hpp>
+#include <boost/noncopyable.hpp>
 
 #include <dns/question.h>
 #include <dns/message.h>
@@ -34,6 +37,7 @@
 #include <cache/resolver_cache.h>
 #include <nsas/address_request_callback.h>
 #include <nsas/nameserver_address.h>
+#include <util/free_list.h>
 
 #include <asio.hpp>
 #include <asiodns/dns_service.h>
@@ -52,6 +56,33 @@ namespace bundy {
 namespace asiodns {
 
 namespace {
+// The messages the answers of upstream servers are parsed into.  They are
+// costly to build, so each thread keeps them for the next answers.
+typedef bundy::util::FreeList<Message, 16> ParseMessageList;
+
+// A message taken from the list of the thread, and put back (cleared)
+// when this object is destroyed.
+class ParseMessage : boost::noncopyable {
+public:
+    ParseMessage() : message_(ParseMessageList::get()) {
+        if (message_ == NULL) {
+            message_ = new Message(Message::PARSE);
+        }
+    }
+
+    ~ParseMessage() {
+        message_->clear(Message::PARSE);
+        ParseMessageList::put(message_);
+    }
+
+    Message& get() {
+        return (*message_);
+    }
+
+private:
+    Message* message_;
+};
+
 // Function to check if the given name/class has any address in the cache
 bool
 hasAddress(const Name& name, const RRClass& rrClass,
@@ -141,7 +172,10 @@ RecursiveQuery::RecursiveQuery(DNSServiceBase& dns_service,
     upstream_root_(new AddressVector(upstream_root)),
     test_server_("", 0),
     query_timeout_(query_timeout), client_timeout_(client_timeout),
-    lookup_timeout_(lookup_timeout), retries_(retries), rtt_recorder_()
+    lookup_timeout_(lookup_timeout), stale_timeout_(-1), race_delay_(-1),
+    ns_port_(53), retries_(retries), rtt_recorder_(),
+    socket_pool_(new FetchSocketPool(dns_service.getIOService())),
+    pending_queries_(new PendingQueries)
 {
 }
 
@@ -153,6 +187,21 @@ RecursiveQuery::setTestServer(const std::string& address, uint16_t port) {
     test_server_.second = port;
 }
 
+void
+RecursiveQuery::setServeStale(int stale_timeout) {
+    stale_timeout_ = stale_timeout;
+}
+
+void
+RecursiveQuery::setRaceDelay(int race_delay) {
+    race_delay_ = race_delay;
+}
+
+void
+RecursiveQuery::setNameserverPort(uint16_t port) {
+    ns_port_ = port;
+}
+
 // Set the RTT recorder - only used for testing
 void
 RecursiveQuery::setRttRecorder(boost::shared_ptr<RttRecorder>& recorder) {
@@ -169,13 +218,22 @@ typedef std::pair<std::string, uint16_t> addr_t;
  *
  * Used by RecursiveQuery::sendQuery.
  */
-class RunningQuery : public IOFetch::Callback, public AbstractRunningQuery {
+class RunningQuery : public AbstractRunningQuery,
+                     public bundy::util::FreeListAllocated<RunningQuery> {
 
 class ResolverNSASCallback : public bundy::nsas::AddressRequestCallback {
 public:
-    ResolverNSASCallback(RunningQuery* rq) : rq_(rq) {}
+    // If race is true, the address is for racing the query already sent.
+    ResolverNSASCallback(RunningQuery* rq, bool race = false) :
+        rq_(rq), race_(race)
+    {}
 
     void success(const bundy::nsas::NameserverAddress& address) {
+        if (race_) {
+            rq_->raceCallbackCalled();
+            rq_->raceTo(address);
+            return;
+        }
         // Success callback, send query to found namesever
         LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_CB, RESLIB_RUNQ_SUCCESS)
                   .arg(address.getAddress().toText());
@@ -184,6 +242,11 @@ public:
     }
 
     void unreachable() {
+        if (race_) {
+            // Nothing to race with, keep waiting for the query already sent
+            rq_->raceCallbackCalled();
+            return;
+        }
         // Nameservers unreachable: drop query or send servfail?
         LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_CB, RESLIB_RUNQ_FAIL);
         rq_->nsasCallbackCalled();
@@ -194,6 +257,44 @@ public:
 
 private:
     RunningQuery* rq_;
+    const bool race_;
+};
+
+// A query sent to one nameserver.  There are two of them for the same
+// question while it is being raced.
+struct UpstreamFetch :
+    public IOFetch::Callback,
+    public bundy::util::FreeListAllocated<UpstreamFetch>
+{
+    UpstreamFetch(RunningQuery& rq, IOFetch::Protocol protocol,
+                  IOService& io, const Question& question,
+                  const bundy::nsas::NameserverAddress& ns_address,
+                  const IOAddress& address, uint16_t port,
+                  const OutputBufferPtr& buff, int timeout, bool edns) :
+        rq_(rq), ns_address_(ns_address), buffer_(buff),
+        query_(protocol, io, question, address, port, buffer_, this,
+               timeout, edns)
+    {
+        gettimeofday(&sent_time_, NULL);
+    }
+
+    virtual void operator()(IOFetch::Result result) {
+        rq_.fetchDone(this, result);
+    }
+
+    RunningQuery& rq_;
+
+    // The nameserver, to update its RTT (a default one for the test
+    // server, which is ignored)
+    bundy::nsas::NameserverAddress ns_address_;
+
+    // The moment in time the query was sent
+    struct timeval sent_time_;
+
+    // Where the answer is stored
+    OutputBufferPtr buffer_;
+
+    IOFetch query_;
 };
 
 
@@ -214,9 +315,15 @@ private:
     // other servers if the port is non-zero.
     std::pair<std::string, uint16_t> test_server_;
 
+    // Port the queries are sent to on the nameservers.
+    const uint16_t ns_port_;
+
     // Buffer to store the intermediate results.
     OutputBufferPtr buffer_;
 
+    // Sockets to send the upstream queries from
+    boost::shared_ptr<FetchSocketPool> socket_pool_;
+
     // The callback will be called when we have either decided we
     // are done, or when we give up
     bundy::resolve::ResolverInterface::CallbackPtr resolvercallback_;
@@ -258,6 +365,11 @@ private:
     // don't call back a second time later
     bool callback_called_;
 
+    // If the client timer is set to the stale answer deadline, and how
+    // long to wait after it for the client timeout (negative if none).
+    bool stale_pending_;
+    int client_wait_;
+
     // Reference to our NSAS
     bundy::nsas::NameserverAddressStore& nsas_;
 
@@ -282,12 +394,19 @@ private:
     // have a lookup timeout and decide to give up
     bool nsas_callback_out_;
 
-    // This is the nameserver we have an outstanding query to.
-    // It is used to update the RTT once the query returns
-    bundy::nsas::NameserverAddress current_ns_address;
+    // The queries to nameservers for the current question which haven't
+    // completed yet.  There is one, or two while racing.
+    std::vector<boost::shared_ptr<UpstreamFetch> > fetches_;
 
-    // The moment in time we sent a query to the nameserver above.
-    struct timeval current_ns_qsent_time;
+    // How long to wait for an answer before also sending the question to
+    // another nameserver, in ms (negative if it is never done).
+    int race_delay_;
+    asio::deadline_timer race_timer;
+
+    // The handler we pass on to the NSAS to get the nameserver to race
+    // with, and whether we are waiting for it.
+    boost::shared_ptr<ResolverNSASCallback> race_callback_;
+    bool race_callback_out_;
 
     // RunningQuery deletes itself when it is done. In order for us
     // to do this safely, we must make sure that there are no events
@@ -308,13 +427,16 @@ private:
     // perform a single lookup; first we check the cache to see
     // if we have a response for our query stored already. if
     // so, call handlerecursiveresponse(), if not, we call send()
-    void doLookup() {
+    // (the cache is skipped if use_cache is false, when the cached
+    // response is being refreshed).
+    void doLookup(bool use_cache = true) {
         LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_CACHE, RESLIB_RUNQ_CACHE_LOOKUP)
                   .arg(questionText(question_));
 
         Message cached_message(Message::RENDER);
         bundy::resolve::initResponseMessage(question_, cached_message);
-        if (cache_.lookup(question_.getName(), question_.getType(),
+        if (use_cache &&
+            cache_.lookup(question_.getName(), question_.getType(),
                           question_.getClass(), cached_message)) {
 
             LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_CACHE, RESLIB_RUNQ_CACHE_FIND)
@@ -337,26 +459,52 @@ private:
 
     }
 
+    // Send the current question to the given address.  We keep track of
+    // the nameserver, so that we can update its RTT.
+    void startFetch(const bundy::nsas::NameserverAddress& ns_address,
+                    const IOAddress& address, uint16_t port,
+                    const OutputBufferPtr& buffer)
+    {
+        ++outstanding_events_;
+        const boost::shared_ptr<UpstreamFetch> fetch(
+            new UpstreamFetch(*this, protocol_, io_, question_, ns_address,
+                              address, port, buffer, query_timeout_, edns_));
+        fetch->query_.setSocketPool(*socket_pool_);
+        fetches_.push_back(fetch);
+        io_.get_io_service().post(fetch->query_);
+    }
+
     // Send the current question to the given nameserver address
     void sendTo(const bundy::nsas::NameserverAddress& address) {
-        // We need to keep track of the Address, so that we can update
-        // the RTT
-        current_ns_address = address;
-        gettimeofday(&current_ns_qsent_time, NULL);
-        ++outstanding_events_;
         if (test_server_.second != 0) {
-            IOFetch query(protocol_, io_, question_,
-                test_server_.first,
-                test_server_.second, buffer_, this,
-                query_timeout_, edns_);
-            io_.get_io_service().post(query);
+            startFetch(address, IOAddress(test_server_.first),
+                       test_server_.second, buffer_);
         } else {
-            IOFetch query(protocol_, io_, question_,
-                current_ns_address.getAddress(),
-                53, buffer_, this,
-                query_timeout_, edns_);
-            io_.get_io_service().post(query);
+            startFetch(address, address.getAddress(), ns_port_, buffer_);
+            startRaceTimer(address);
+        }
+    }
+
+    // If racing is enabled, wait for the answer to the query just sent
+    // to the given nameserver for twice its RTT, but no less than the
+    // race delay, before also sending the question to another one.
+    void startRaceTimer(bundy::nsas::NameserverAddress address) {
+        if (race_delay_ < 0) {
+            return;
+        }
+        const uint64_t delay =
+            std::max(2 * static_cast<uint64_t>(
+                         address.getAddressEntry().getRTT()),
+                     static_cast<uint64_t>(race_delay_));
+        if (query_timeout_ >= 0 &&
+            delay >= static_cast<uint64_t>(query_timeout_)) {
+            // It would time out first anyway
+            return;
         }
+        race_timer.expires_from_now(boost::posix_time::milliseconds(delay));
+        ++outstanding_events_;
+        race_timer.async_wait(boost::bind(&RunningQuery::raceTimeout, this,
+                                          asio::placeholders::error));
     }
 
     // 'general' send, ask the NSAS to give us an address.
@@ -368,13 +516,9 @@ private:
             LOG_DEBUG(bundy::resolve::logger,
                       RESLIB_DBG_TRACE, RESLIB_TEST_UPSTREAM)
                 .arg(questionText(question_)).arg(test_server_.first);
-            gettimeofday(&current_ns_qsent_time, NULL);
-            ++outstanding_events_;
-            IOFetch query(protocol, io_, question_,
-                test_server_.first,
-                test_server_.second, buffer_, this,
-                query_timeout_, edns_);
-            io_.get_io_service().post(query);
+            startFetch(bundy::nsas::NameserverAddress(),
+                       IOAddress(test_server_.first), test_server_.second,
+                       buffer_);
 
         } else {
             // Ask the NSAS for an address for the current zone,
@@ -397,6 +541,91 @@ private:
         nsas_callback_out_ = false;
     }
 
+    // Same for the NSAS call for a nameserver to race with.
+    void raceCallbackCalled() {
+        race_callback_out_ = false;
+    }
+
+    // Called when the race delay has passed without an answer.  The
+    // time waited is known to be less than the RTT of the nameserver,
+    // which is recorded so that the NSAS is less likely to give it again
+    // when asked for another nameserver to send the question to.
+    void raceTimeout(const asio::error_code& error) {
+        assert(outstanding_events_ > 0);
+        --outstanding_events_;
+        if (done_) {
+            stop();
+            return;
+        }
+        if (error == asio::error::operation_aborted || fetches_.size() != 1 ||
+            race_callback_out_) {
+            // The question was settled meanwhile
+            return;
+        }
+        UpstreamFetch& fetch = *fetches_.front();
+        const uint32_t waited = elapsedSince(fetch.sent_time_);
+        if (waited > fetch.ns_address_.getAddressEntry().getRTT()) {
+            fetch.ns_address_.updateRTT(waited);
+        }
+        race_callback_out_ = true;
+        nsas_.lookup(cur_zone_, question_.getClass(), race_callback_);
+    }
+
+    // Send the current question to another nameserver as well.
+    void raceTo(const bundy::nsas::NameserverAddress& address) {
+        // The question may have been settled meanwhile, and there is no
+        // point in racing the nameserver with itself.
+        if (done_ || fetches_.size() != 1 ||
+            fetches_.front()->ns_address_.getAddress() ==
+            address.getAddress()) {
+            return;
+        }
+        LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_TRACE, RESLIB_RUNQ_RACE)
+                  .arg(questionText(question_))
+                  .arg(address.getAddress().toText());
+        startFetch(address, address.getAddress(), ns_port_,
+                   OutputBufferPtr(new OutputBuffer(0)));
+    }
+
+    // The current question is settled, stop racing it.  The queries
+    // still running for it are stopped, and their nameservers are
+    // considered to be twice as slow as they were so far.
+    void endRace() {
+        if (race_callback_out_) {
+            nsas_.cancel(cur_zone_, question_.getClass(), race_callback_);
+            race_callback_out_ = false;
+        }
+        race_timer.cancel();
+        while (!fetches_.empty()) {
+            const boost::shared_ptr<UpstreamFetch> loser(fetches_.back());
+            fetches_.pop_back();
+            LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_RESULTS,
+                      RESLIB_RUNQ_RACE_LOST)
+                      .arg(questionText(question_))
+                      .arg(loser->ns_address_.getAddress().toText());
+            const uint32_t penalty = 2 * elapsedSince(loser->sent_time_);
+            if (penalty > loser->ns_address_.getAddressEntry().getRTT()) {
+                loser->ns_address_.updateRTT(penalty);
+            }
+            // This calls fetchDone() with STOPPED
+            loser->query_.stop();
+        }
+    }
+
+    // Returns the time since the given moment, in ms.
+    static uint32_t elapsedSince(const struct timeval& start) {
+        struct timeval cur_time;
+        gettimeofday(&cur_time, NULL);
+        // Only calculate it if it is positive
+        if (cur_time.tv_sec > start.tv_sec ||
+            (cur_time.tv_sec == start.tv_sec &&
+             cur_time.tv_usec > start.tv_usec)) {
+            return (1000 * (cur_time.tv_sec - start.tv_sec) +
+                    (cur_time.tv_usec - start.tv_usec) / 1000);
+        }
+        return (0);
+    }
+
     // This function is called by operator() and lookup();
     // We have an answer either from a nameserver or the cache, and
     // we do not know yet if this is a final answer we can send back or
@@ -471,6 +700,8 @@ private:
             bundy::resolve::copyResponseMessage(incoming, answer_message_);
             // no negcache yet
             //cache_.update(*answer_message_);
+            // but keep the NSEC records proving it (if enabled)
+            cache_.updateNegative(incoming);
             return (true);
             break;
 
@@ -676,14 +907,19 @@ public:
         unsigned retries,
         bundy::nsas::NameserverAddressStore& nsas,
         bundy::cache::ResolverCache& cache,
-        boost::shared_ptr<RttRecorder>& recorder)
+        boost::shared_ptr<RttRecorder>& recorder,
+        const boost::shared_ptr<FetchSocketPool>& socket_pool,
+        bool prefetch = false, int stale_timeout = -1, int race_delay = -1,
+        uint16_t ns_port = 53)
         :
         io_(io),
         question_(question),
         query_message_(),
         answer_message_(answer_message),
         test_server_(test_server),
+        ns_port_(ns_port),
         buffer_(buffer),
+        socket_pool_(socket_pool),
         resolvercallback_(cb),
         protocol_(IOFetch::UDP),
         cname_count_(0),
@@ -693,16 +929,23 @@ public:
         lookup_timer(io.get_io_service()),
         done_(false),
         callback_called_(false),
+        stale_pending_(false),
+        client_wait_(-1),
         nsas_(nsas),
         cache_(cache),
         cur_zone_("."),
         nsas_callback_(),
         nsas_callback_out_(false),
+        race_delay_(race_delay),
+        race_timer(io.get_io_service()),
+        race_callback_(),
+        race_callback_out_(false),
         outstanding_events_(0),
         rtt_recorder_(recorder)
     {
         // Set here to avoid using "this" in initializer list.
         nsas_callback_.reset(new ResolverNSASCallback(this));
+        race_callback_.reset(new ResolverNSASCallback(this, true));
 
         // Setup the timer to stop trying (lookup_timeout)
         if (lookup_timeout >= 0) {
@@ -712,15 +955,25 @@ public:
             lookup_timer.async_wait(boost::bind(&RunningQuery::lookupTimeout, this));
         }
 
-        // Setup the timer to send an answer (client_timeout)
-        if (client_timeout >= 0) {
+        // Setup the timer to send an answer (client_timeout), or a stale
+        // one first if that's due earlier (stale_timeout)
+        if (stale_timeout >= 0 &&
+            (client_timeout < 0 || stale_timeout < client_timeout)) {
+            stale_pending_ = true;
+            client_wait_ = client_timeout < 0 ? -1 :
+                client_timeout - stale_timeout;
+            client_timer.expires_from_now(
+                boost::posix_time::milliseconds(stale_timeout));
+            ++outstanding_events_;
+            client_timer.async_wait(boost::bind(&RunningQuery::clientTimeout, this));
+        } else if (client_timeout >= 0) {
             client_timer.expires_from_now(
                 boost::posix_time::milliseconds(client_timeout));
             ++outstanding_events_;
             client_timer.async_wait(boost::bind(&RunningQuery::clientTimeout, this));
         }
 
-        doLookup();
+        doLookup(!prefetch);
     }
 
     virtual ~RunningQuery() {};
@@ -739,8 +992,21 @@ public:
 
     // called if we have a client timeout; if our callback has
     // not been called, call it now. But do not stop.
+    // At the stale answer deadline, the client is answered with stale
+    // data if there is some; otherwise the timer is set again for the
+    // rest of the client timeout.
     void clientTimeout() {
-        if (!callback_called_) {
+        if (stale_pending_) {
+            stale_pending_ = false;
+            if (!done_ && !callback_called_ && !answerStale() &&
+                client_wait_ >= 0) {
+                client_timer.expires_from_now(
+                    boost::posix_time::milliseconds(client_wait_));
+                client_timer.async_wait(
+                    boost::bind(&RunningQuery::clientTimeout, this));
+                return;
+            }
+        } else if (!callback_called_) {
             makeSERVFAIL();
             callCallback(true);
         }
@@ -791,8 +1057,13 @@ public:
             nsas_.cancel(cur_zone_, question_.getClass(), nsas_callback_);
             nsas_callback_out_ = false;
         }
+        if (race_callback_out_) {
+            nsas_.cancel(cur_zone_, question_.getClass(), race_callback_);
+            race_callback_out_ = false;
+        }
         client_timer.cancel();
         lookup_timer.cancel();
+        race_timer.cancel();
         if (outstanding_events_ > 0) {
             return;
         } else {
@@ -800,40 +1071,51 @@ public:
         }
     }
 
-    // This function is used as callback from DNSQuery.
-    virtual void operator()(IOFetch::Result result) {
+    // Called when a query to a nameserver completes, or is stopped.
+    void fetchDone(UpstreamFetch* fetch, IOFetch::Result result) {
         // XXX is this the place for TCP retry?
         assert(outstanding_events_ > 0);
         --outstanding_events_;
 
+        if (result == IOFetch::STOPPED) {
+            // It lost the race, the answer of the winner is being handled
+            return;
+        }
+
+        // Keep the fetch while we use it.
+        boost::shared_ptr<UpstreamFetch> current;
+        for (std::vector<boost::shared_ptr<UpstreamFetch> >::iterator it =
+                 fetches_.begin(); it != fetches_.end(); ++it) {
+            if (it->get() == fetch) {
+                current = *it;
+                fetches_.erase(it);
+                break;
+            }
+        }
+        assert(current);
+
         if (!done_ && result != IOFetch::TIME_OUT) {
             // we got an answer
 
             // Update the NSAS with the time it took
-            struct timeval cur_time;
-            gettimeofday(&cur_time, NULL);
-            uint32_t rtt = 0;
-
-            // Only calculate RTT if it is positive
-            if (cur_time.tv_sec > current_ns_qsent_time.tv_sec ||
-                (cur_time.tv_sec == current_ns_qsent_time.tv_sec &&
-                 cur_time.tv_usec > current_ns_qsent_time.tv_usec)) {
-                rtt = 1000 * (cur_time.tv_sec - current_ns_qsent_time.tv_sec);
-                rtt += (cur_time.tv_usec - current_ns_qsent_time.tv_usec) / 1000;
-            }
+            const uint32_t rtt = elapsedSince(current->sent_time_);
             LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_RESULTS, RESLIB_RTT).arg(rtt);
-            current_ns_address.updateRTT(rtt);
+            current->ns_address_.updateRTT(rtt);
             if (rtt_recorder_) {
                 rtt_recorder_->addRtt(rtt);
             }
 
             try {
-                Message incoming(Message::PARSE);
-                InputBuffer ibuf(buffer_->getData(), buffer_->getLength());
+                ParseMessage parse_message;
+                Message& incoming = parse_message.get();
+                InputBuffer ibuf(current->buffer_->getData(),
+                                 current->buffer_->getLength());
 
                 incoming.fromWire(ibuf);
 
-                buffer_->clear();
+                current->buffer_->clear();
+                // This is the first valid answer, it wins the race.
+                endRace();
                 done_ = handleRecursiveAnswer(incoming);
                 if (done_) {
                     callCallback(true);
@@ -844,12 +1126,18 @@ public:
                 // (except we don't store RTT)
                 // We probably want to make this an integral part
                 // of the fetch data process. (TODO)
-                if (retries_--) {
+                if (!fetches_.empty()) {
+                    // The other nameserver may still answer
+                    LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_RESULTS,
+                              RESLIB_PROTOCOL)
+                              .arg(questionText(question_)).arg(dpe.what());
+                } else if (retries_--) {
                     // Retry
                     LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_RESULTS,
                               RESLIB_PROTOCOL_RETRY)
                               .arg(questionText(question_)).arg(dpe.what())
                               .arg(retries_);
+                    endRace();
                     send();
                 } else {
                     // Give up
@@ -863,20 +1151,29 @@ public:
                     stop();
                 }
             }
+        } else if (!done_ && !fetches_.empty()) {
+            // Query timed out, but the nameserver it was raced with may
+            // still answer
+            LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_RESULTS, RESLIB_TIMEOUT)
+                      .arg(questionText(question_))
+                      .arg(current->ns_address_.getAddress().toText());
+            current->ns_address_.updateRTT(bundy::nsas::AddressEntry::UNREACHABLE);
         } else if (!done_ && retries_--) {
             // Query timed out, but we have some retries, so send again
             LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_RESULTS, RESLIB_TIMEOUT_RETRY)
                       .arg(questionText(question_))
-                      .arg(current_ns_address.getAddress().toText()).arg(retries_);
-            current_ns_address.updateRTT(bundy::nsas::AddressEntry::UNREACHABLE);
+                      .arg(current->ns_address_.getAddress().toText())
+                      .arg(retries_);
+            current->ns_address_.updateRTT(bundy::nsas::AddressEntry::UNREACHABLE);
+            endRace();
             send();
         } else {
             // We are either already done, or out of retries
             if (result == IOFetch::TIME_OUT) {
                 LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_RESULTS, RESLIB_TIMEOUT)
                           .arg(questionText(question_))
-                          .arg(current_ns_address.getAddress().toText());
-                current_ns_address.updateRTT(bundy::nsas::AddressEntry::UNREACHABLE);
+                          .arg(current->ns_address_.getAddress().toText());
+                current->ns_address_.updateRTT(bundy::nsas::AddressEntry::UNREACHABLE);
             }
             if (!callback_called_) {
                 makeSERVFAIL();
@@ -893,9 +1190,31 @@ public:
             bundy::resolve::makeErrorMessage(answer_message_, Rcode::SERVFAIL());
         }
     }
+
+    // Answer with the stale data of the cache, if there is any.  The
+    // query is not stopped, so the data is refreshed when it completes.
+    bool answerStale() {
+        Message stale_message(Message::RENDER);
+        bundy::resolve::initResponseMessage(question_, stale_message);
+        if (!cache_.lookupStale(question_.getName(), question_.getType(),
+                                question_.getClass(), stale_message)) {
+            return (false);
+        }
+        LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_CACHE, RESLIB_RUNQ_STALE)
+                  .arg(questionText(question_));
+        stale_message.setRcode(Rcode::NOERROR());
+        if (answer_message_) {
+            // Drop whatever was collected so far.
+            bundy::resolve::makeErrorMessage(answer_message_, Rcode::NOERROR());
+            bundy::resolve::copyResponseMessage(stale_message, answer_message_);
+        }
+        callCallback(true);
+        return (true);
+    }
 };
 
-class ForwardQuery : public IOFetch::Callback, public AbstractRunningQuery {
+class ForwardQuery : public IOFetch::Callback, public AbstractRunningQuery,
+                     public bundy::util::FreeListAllocated<ForwardQuery> {
 private:
     // The io service to handle async calls
     IOService& io_;
@@ -912,6 +1231,9 @@ private:
     // Buffer to store the result.
     OutputBufferPtr buffer_;
 
+    // Sockets to send the upstream queries from
+    boost::shared_ptr<FetchSocketPool> socket_pool_;
+
     // This will be notified when we succeed or fail
     bundy::resolve::ResolverInterface::CallbackPtr resolvercallback_;
 
@@ -953,6 +1275,7 @@ private:
             upstream_->at(serverIndex).first,
             upstream_->at(serverIndex).second,
             buffer_, this, query_timeout_);
+        query.setSocketPool(*socket_pool_);
 
         io_.get_io_service().post(query);
     }
@@ -964,12 +1287,14 @@ public:
         boost::shared_ptr<AddressVector> upstream,
         OutputBufferPtr buffer,
         bundy::resolve::ResolverInterface::CallbackPtr cb,
-        int query_timeout, int client_timeout, int lookup_timeout) :
+        int query_timeout, int client_timeout, int lookup_timeout,
+        const boost::shared_ptr<FetchSocketPool>& socket_pool) :
         io_(io),
         query_message_(query_message),
         answer_message_(answer_message),
         upstream_(upstream),
         buffer_(buffer),
+        socket_pool_(socket_pool),
         resolvercallback_(cb),
         query_timeout_(query_timeout),
         client_timer(io.get_io_service()),
@@ -1056,7 +1381,8 @@ public:
         --outstanding_events_;
         if (result != IOFetch::TIME_OUT) {
             // we got an answer
-            Message incoming(Message::PARSE);
+            ParseMessage parse_message;
+            Message& incoming = parse_message.get();
             InputBuffer ibuf(buffer_->getData(), buffer_->getLength());
             incoming.fromWire(ibuf);
             bundy::resolve::copyResponseMessage(incoming, answer_message_);
@@ -1073,14 +1399,129 @@ public:
     }
 };
 
+// The callback of a RunningQuery started by RecursiveQuery::resolve().  It
+// also answers the identical questions asked while it's running, each with
+// a copy of the answer, and removes itself from the pending queries when
+// it's called.
+class PendingQueryCallback : public bundy::resolve::ResolverInterface::Callback {
+public:
+    typedef std::map<Question,
+                     boost::weak_ptr<bundy::resolve::ResolverInterface::Callback> >
+        PendingQueries;
+
+    PendingQueryCallback(const boost::shared_ptr<PendingQueries>& pending,
+                         const Question& question) :
+        pending_(pending), question_(question)
+    {}
+
+    // Add a query waiting for the answer.  The first one is the one whose
+    // answer message is filled in by the RunningQuery.
+    void addWaiter(MessagePtr answer_message,
+                   bundy::resolve::ResolverInterface::CallbackPtr callback)
+    {
+        waiters_.push_back(Waiter(answer_message, callback));
+    }
+
+    virtual void success(const MessagePtr response) {
+        done();
+        for (std::vector<Waiter>::const_iterator it = waiters_.begin();
+             it != waiters_.end(); ++it) {
+            if (it->first != response) {
+                bundy::resolve::copyResponseMessage(*response, it->first);
+            }
+            it->second->success(it->first);
+        }
+    }
+
+    virtual void failure() {
+        done();
+        for (std::vector<Waiter>::const_iterator it = waiters_.begin();
+             it != waiters_.end(); ++it) {
+            it->second->failure();
+        }
+    }
+
+private:
+    // Remove ourselves from the pending queries, so further questions
+    // start a new query.
+    void done() {
+        PendingQueries::iterator it = pending_->find(question_);
+        if (it != pending_->end() && it->second.lock().get() == this) {
+            pending_->erase(it);
+        }
+    }
+
+    typedef std::pair<MessagePtr,
+                      bundy::resolve::ResolverInterface::CallbackPtr> Waiter;
+    const boost::shared_ptr<PendingQueries> pending_;
+    const Question question_;
+    std::vector<Waiter> waiters_;
+};
+
+// The callback of queries refreshing cached responses.  The RunningQuery
+// updates the cache itself, so there's nothing to do.
+class PrefetchCallback : public bundy::resolve::ResolverInterface::Callback {
+public:
+    virtual void success(const MessagePtr) {}
+    virtual void failure() {}
+};
+
+}
+
+void
+RecursiveQuery::prefetch(const Question& question) {
+    LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_CACHE, RESLIB_RECQ_PREFETCH)
+              .arg(questionText(question));
+    MessagePtr answer_message(new Message(Message::RENDER));
+    bundy::resolve::initResponseMessage(question, *answer_message);
+    // It deletes itself when it is done.
+    new RunningQuery(dns_service_.getIOService(), question, answer_message,
+                     test_server_, OutputBufferPtr(new OutputBuffer(0)),
+                     bundy::resolve::ResolverInterface::CallbackPtr(
+                         new PrefetchCallback),
+                     query_timeout_, -1, lookup_timeout_, retries_, nsas_,
+                     cache_, rtt_recorder_, socket_pool_, true, -1,
+                     race_delay_, ns_port_);
+}
+
+AbstractRunningQuery*
+RecursiveQuery::startQuery(const Question& question,
+                           MessagePtr answer_message,
+                           OutputBufferPtr buffer,
+                           bundy::resolve::ResolverInterface::CallbackPtr
+                           callback)
+{
+    const PendingQueries::const_iterator it =
+        pending_queries_->find(question);
+    if (it != pending_queries_->end()) {
+        const boost::shared_ptr<PendingQueryCallback> pending =
+            boost::static_pointer_cast<PendingQueryCallback>(
+                it->second.lock());
+        if (pending) {
+            LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_TRACE,
+                      RESLIB_RECQ_PENDING).arg(questionText(question));
+            pending->addWaiter(answer_message, callback);
+            return (NULL);
+        }
+    }
+
+    const boost::shared_ptr<PendingQueryCallback> pending(
+        new PendingQueryCallback(pending_queries_, question));
+    pending->addWaiter(answer_message, callback);
+    (*pending_queries_)[question] = pending;
+    // It will delete itself when it is done
+    return (new RunningQuery(dns_service_.getIOService(), question,
+                             answer_message, test_server_, buffer, pending,
+                             query_timeout_, client_timeout_, lookup_timeout_,
+                             retries_, nsas_, cache_, rtt_recorder_,
+                             socket_pool_, false, stale_timeout_,
+                             race_delay_, ns_port_));
 }
 
 AbstractRunningQuery*
 RecursiveQuery::resolve(const QuestionPtr& question,
     const bundy::resolve::ResolverInterface::CallbackPtr callback)
 {
-    IOService& io = dns_service_.getIOService();
-
     MessagePtr answer_message(new Message(Message::RENDER));
     bundy::resolve::initResponseMessage(*question, *answer_message);
 
@@ -1089,8 +1530,9 @@ RecursiveQuery::resolve(const QuestionPtr& question,
     // First try to see if we have something cached in the messagecache
     LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_TRACE, RESLIB_RESOLVE)
               .arg(questionText(*question)).arg(1);
+    bool need_prefetch;
     if (cache_.lookup(question->getName(), question->getType(),
-                      question->getClass(), *answer_message) &&
+                      question->getClass(), *answer_message, &need_prefetch) &&
         answer_message->getRRCount(Message::SECTION_ANSWER) > 0) {
         // Message found, return that
         LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_CACHE, RESLIB_RECQ_CACHE_FIND)
@@ -1099,6 +1541,9 @@ RecursiveQuery::resolve(const QuestionPtr& question,
         // TODO: err, should cache set rcode as well?
         answer_message->setRcode(Rcode::NOERROR());
         callback->success(answer_message);
+        if (need_prefetch) {
+            prefetch(*question);
+        }
     } else {
         // Perhaps we only have the one RRset?
         // TODO: can we do this? should we check for specific types only?
@@ -1113,16 +1558,22 @@ RecursiveQuery::resolve(const QuestionPtr& question,
                                      cached_rrset);
             answer_message->setRcode(Rcode::NOERROR());
             callback->success(answer_message);
+        } else if (cache_.lookupNegative(question->getName(),
+                                         question->getType(),
+                                         question->getClass(),
+                                         *answer_message)) {
+            // The name or type is proven not to exist by cached NSEC
+            // records
+            LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_CACHE,
+                      RESLIB_RECQ_NEGATIVE_FIND)
+                      .arg(questionText(*question)).arg(1);
+            callback->success(answer_message);
         } else {
-            // Message not found in cache, start recursive query.  It will
-            // delete itself when it is done
+            // Message not found in cache, start recursive query (or wait
+            // for the one already running for the question).
             LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_TRACE, RESLIB_RECQ_CACHE_NO_FIND)
                       .arg(questionText(*question)).arg(1);
-            return (new RunningQuery(io, *question, answer_message,
-                                     test_server_, buffer, callback,
-                                     query_timeout_, client_timeout_,
-                                     lookup_timeout_, retries_, nsas_,
-                                     cache_, rtt_recorder_));
+            return (startQuery(*question, answer_message, buffer, callback));
         }
     }
     return (NULL);
@@ -1138,8 +1589,6 @@ RecursiveQuery::resolve(const Question& question,
     // the message should be sent via TCP or UDP, or sent initially via
     // UDP and then fall back to TCP on failure, but for the moment
     // we're only going to handle UDP.
-    IOService& io = dns_service_.getIOService();
-
     bundy::resolve::ResolverInterface::CallbackPtr crs(
         new bundy::resolve::ResolverCallbackServer(server));
 
@@ -1151,8 +1600,9 @@ RecursiveQuery::resolve(const Question& question,
     LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_TRACE, RESLIB_RESOLVE)
               .arg(questionText(question)).arg(2);
 
+    bool need_prefetch;
     if (cache_.lookup(question.getName(), question.getType(),
-                      question.getClass(), *answer_message) &&
+                      question.getClass(), *answer_message, &need_prefetch) &&
         answer_message->getRRCount(Message::SECTION_ANSWER) > 0) {
 
         // Message found, return that
@@ -1161,6 +1611,9 @@ RecursiveQuery::resolve(const Question& question,
         // TODO: err, should cache set rcode as well?
         answer_message->setRcode(Rcode::NOERROR());
         crs->success(answer_message);
+        if (need_prefetch) {
+            prefetch(question);
+        }
     } else {
         // Perhaps we only have the one RRset?
         // TODO: can we do this? should we check for specific types only?
@@ -1176,15 +1629,22 @@ RecursiveQuery::resolve(const Question& question,
             answer_message->setRcode(Rcode::NOERROR());
             crs->success(answer_message);
 
+        } else if (cache_.lookupNegative(question.getName(),
+                                         question.getType(),
+                                         question.getClass(),
+                                         *answer_message)) {
+            // The name or type is proven not to exist by cached NSEC
+            // records
+            LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_CACHE,
+                      RESLIB_RECQ_NEGATIVE_FIND)
+                      .arg(questionText(question)).arg(2);
+            crs->success(answer_message);
         } else {
-            // Message not found in cache, start recursive query.  It will
-            // delete itself when it is done
+            // Message not found in cache, start recursive query (or wait
+            // for the one already running for the question).
             LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_TRACE, RESLIB_RECQ_CACHE_NO_FIND)
                       .arg(questionText(question)).arg(2);
-            return (new RunningQuery(io, question, answer_message,
-                                     test_server_, buffer, crs, query_timeout_,
-                                     client_timeout_, lookup_timeout_, retries_,
-                                     nsas_, cache_, rtt_recorder_));
+            return (startQuery(question, answer_message, buffer, crs));
         }
     }
     return (NULL);
@@ -1218,7 +1678,8 @@ RecursiveQuery::forward(ConstMessagePtr query_message,
     // It will delete itself when it is done
     return (new ForwardQuery(io, query_message, answer_message,
                              upstream_, buffer, callback, query_timeout_,
-                             client_timeout_, lookup_timeout_));
+                             client_timeout_, lookup_timeout_,
+                             socket_pool_));
 }
 
 } // namespace asiodns
@@ -15,9 +15,15 @@
 #ifndef RECURSIVE_QUERY_H
 #define RECURSIVE_QUERY_H 1
 
+#include <map>
+
+#include <boost/weak_ptr.hpp>
+
+#include <dns/question.h>
 #include <util/buffer.h>
 #include <asiodns/dns_service.h>
 #include <asiodns/dns_server.h>
+#include <asiodns/fetch_socket_pool.h>
 #include <nsas/nameserver_address_store.h>
 #include <cache/resolver_cache.h>
 
@@ -128,6 +134,39 @@ public:
     /// \param recorder Pointer to the RTT recorder object used to hold RTTs.
     void setRttRecorder(boost::shared_ptr<RttRecorder>& recorder);
 
+    /// \brief Set the deadline for answering with stale data.
+    ///
+    /// If a query isn't answered within \c stale_timeout ms, the client
+    /// is answered with the expired data of the cache, if there is any
+    /// (see \c bundy::cache::ResolverCache::setServeStale()), while the
+    /// query goes on refreshing it.  Otherwise it waits for the answer or
+    /// the client timeout as usual.  This is disabled by default.
+    ///
+    /// \param stale_timeout The deadline in ms; a negative value disables
+    ///        serving stale data.
+    void setServeStale(int stale_timeout);
+
+    /// \brief Set the delay before racing upstream queries.
+    ///
+    /// If a nameserver doesn't answer a query within \c race_delay ms,
+    /// or twice its known round-trip time if that's longer, the query
+    /// is also sent to another nameserver of the zone given by the
+    /// nameserver address store.  The first valid answer is used, and
+    /// the other query is stopped, its nameserver being considered
+    /// slower.  This is disabled by default.
+    ///
+    /// \param race_delay The delay in ms; a negative value disables
+    ///        racing.
+    void setRaceDelay(int race_delay);
+
+    /// \brief Set the port the queries are sent to on the nameservers.
+    ///
+    /// This is 53 by default; other ports are only useful for tests and
+    /// benchmarks running fake nameservers without privileges.
+    ///
+    /// \param port The port number.
+    void setNameserverPort(uint16_t port);
+
     /// \brief Initiate resolving
     ///
     /// When sendQuery() is called, a (set of) message(s) is sent
@@ -143,6 +182,10 @@ public:
     /// CallbackPtr object shall be called (with either success() or
     /// failure(). See ResolverInterface::Callback for more information.
     ///
+    /// If the same question is already being resolved, no new query is
+    /// started; the callback is called with a copy of the answer when the
+    /// running one completes (and NULL is returned).
+    ///
     /// \param question The question being answered <qname/qclass/qtype>
     /// \param callback Callback object. See
     ///        \c ResolverInterface::Callback for more information
@@ -167,8 +210,9 @@ public:
     ///         itself in normal circumstances, and can normally be ignored
     ///         by the caller, but a pointer is returned for use-cases
     ///         such as unit tests.
-    ///         Returns NULL if the data was found internally and no actual
-    ///         query was sent.
+    ///         Returns NULL if the data was found internally or the same
+    ///         question is already being resolved, and no actual query
+    ///         was sent.
     AbstractRunningQuery* resolve(const bundy::dns::Question& question,
                           bundy::dns::MessagePtr answer_message,
                           bundy::util::OutputBufferPtr buffer,
@@ -209,6 +253,23 @@ public:
     void setTestServer(const std::string& address, uint16_t port);
 
 private:
+    // Refresh the cached response to the question in the background.
+    void prefetch(const bundy::dns::Question& question);
+
+    // Start a RunningQuery for the question, or wait for the one already
+    // running for it.
+    AbstractRunningQuery* startQuery(
+        const bundy::dns::Question& question,
+        bundy::dns::MessagePtr answer_message,
+        bundy::util::OutputBufferPtr buffer,
+        bundy::resolve::ResolverInterface::CallbackPtr callback);
+
+    /// Queries being resolved (the callbacks of other queries waiting
+    /// for them), by question.
+    typedef std::map<bundy::dns::Question,
+                     boost::weak_ptr<bundy::resolve::ResolverInterface::Callback> >
+        PendingQueries;
+
     DNSServiceBase& dns_service_;
     bundy::nsas::NameserverAddressStore& nsas_;
     bundy::cache::ResolverCache& cache_;
@@ -220,8 +281,16 @@ private:
     int query_timeout_;
     int client_timeout_;
     int lookup_timeout_;
+    int stale_timeout_;
+    int race_delay_;
+    uint16_t ns_port_;
     unsigned retries_;
     boost::shared_ptr<RttRecorder>  rtt_recorder_;  ///< Round-trip time recorder
+    /// Sockets shared by the upstream queries
+    boost::shared_ptr<FetchSocketPool> socket_pool_;
+    /// Queries being resolved; shared with the running queries, which
+    /// remove themselves when they are done.
+    boost::shared_ptr<PendingQueries> pending_queries_;
 };
 
 }      // namespace asiodns
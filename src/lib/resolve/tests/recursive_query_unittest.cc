@@ -1000,6 +1000,142 @@ TEST_F(RecursiveQueryTest, CachedNS) {
         "It does not ask NSAS anything, how does it know where to send?";
 }
 
+// Callback counting how it's called, for the coalescing test.
+class CountingCallback : public bundy::resolve::ResolverInterface::Callback {
+public:
+    CountingCallback() : successes(0), failures(0) {}
+    void success(const bundy::dns::MessagePtr response) {
+        ++successes;
+        responses.push_back(response);
+    }
+    void failure() {
+        ++failures;
+    }
+    int successes;
+    int failures;
+    vector<MessagePtr> responses;
+};
+
+// Identical questions asked while one is being resolved share its query.
+TEST_F(RecursiveQueryTest, coalesceQueries) {
+    setDNSService();
+    vector<pair<string, uint16_t> > roots;
+    roots.push_back(pair<string, uint16_t>("192.0.2.2", 53));
+    vector<pair<string, uint16_t> > upstream;
+    // Nothing answers; the client timeout makes it SERVFAIL.
+    RecursiveQuery rq(*dns_service_, *nsas_, cache_, upstream, roots,
+                      10, 20, 50, 0);
+
+    const QuestionPtr q(new Question(Name("www.example.org"), RRClass::IN(),
+                                     RRType::A()));
+    boost::shared_ptr<CountingCallback> callback1(new CountingCallback);
+    boost::shared_ptr<CountingCallback> callback2(new CountingCallback);
+    boost::shared_ptr<CountingCallback> callback3(new CountingCallback);
+    EXPECT_NE(static_cast<AbstractRunningQuery*>(NULL),
+              rq.resolve(q, callback1));
+    EXPECT_EQ(static_cast<AbstractRunningQuery*>(NULL),
+              rq.resolve(q, callback2));
+    // A different question starts its own query.
+    const QuestionPtr q_aaaa(new Question(Name("www.example.org"),
+                                          RRClass::IN(), RRType::AAAA()));
+    EXPECT_NE(static_cast<AbstractRunningQuery*>(NULL),
+              rq.resolve(q_aaaa, callback3));
+
+    // Each query has a client and a lookup timeout.  (The IO service
+    // doesn't run out of work, so we can't just run() it.)
+    for (int i = 0; i < 4; ++i) {
+        io_service_.run_one();
+    }
+    EXPECT_EQ(1, callback1->successes);
+    EXPECT_EQ(1, callback2->successes);
+    EXPECT_EQ(1, callback3->successes);
+    ASSERT_EQ(1, callback2->responses.size());
+    // The waiting query has its own copy of the answer.
+    EXPECT_NE(callback1->responses[0], callback2->responses[0]);
+    EXPECT_EQ(Rcode::SERVFAIL(), callback2->responses[0]->getRcode());
+    EXPECT_EQ(1, callback2->responses[0]->getRRCount(Message::SECTION_QUESTION));
+
+    // Once it's done, a new query is started.
+    EXPECT_NE(static_cast<AbstractRunningQuery*>(NULL),
+              rq.resolve(q, callback1));
+    io_service_.run_one();
+    io_service_.run_one();
+    EXPECT_EQ(2, callback1->successes);
+}
+
+// With serve-stale enabled, the expired answer in the cache is given when
+// the upstream doesn't answer in time.
+TEST_F(RecursiveQueryTest, serveStale) {
+    setDNSService();
+    vector<pair<string, uint16_t> > roots;
+    roots.push_back(pair<string, uint16_t>("192.0.2.2", 53));
+    vector<pair<string, uint16_t> > upstream;
+    RecursiveQuery rq(*dns_service_, *nsas_, cache_, upstream, roots,
+                      10, 20, 50, 0);
+    rq.setServeStale(5);
+    cache_.setServeStale(10);
+
+    // An answer that expires immediately.
+    const QuestionPtr q(new Question(Name("www.example.org"), RRClass::IN(),
+                                     RRType::A()));
+    Message cached(Message::RENDER);
+    cached.setOpcode(Opcode::QUERY());
+    cached.setRcode(Rcode::NOERROR());
+    cached.setHeaderFlag(Message::HEADERFLAG_QR);
+    cached.addQuestion(*q);
+    RRsetPtr rrset(new RRset(q->getName(), RRClass::IN(), RRType::A(),
+                             RRTTL(0)));
+    rrset->addRdata(rdata::in::A("192.0.2.1"));
+    cached.addRRset(Message::SECTION_ANSWER, rrset);
+    EXPECT_TRUE(cache_.update(cached));
+
+    boost::shared_ptr<CountingCallback> callback(new CountingCallback);
+    EXPECT_NE(static_cast<AbstractRunningQuery*>(NULL),
+              rq.resolve(q, callback));
+
+    // The stale answer is given at its deadline, before the client
+    // timeout.
+    io_service_.run_one();
+    ASSERT_EQ(1, callback->successes);
+    EXPECT_EQ(Rcode::NOERROR(), callback->responses[0]->getRcode());
+    ASSERT_EQ(1, callback->responses[0]->getRRCount(Message::SECTION_ANSWER));
+    EXPECT_EQ(RRTTL(bundy::cache::MessageCache::STALE_TTL),
+              (*callback->responses[0]->beginSection(
+                  Message::SECTION_ANSWER))->getTTL());
+
+    // The query goes on until the lookup timeout, without calling back
+    // again.
+    io_service_.run_one();
+    EXPECT_EQ(1, callback->successes);
+    EXPECT_EQ(0, callback->failures);
+}
+
+// Racing doesn't change how a query nobody answers ends.
+TEST_F(RecursiveQueryTest, raceDelay) {
+    setDNSService();
+    vector<pair<string, uint16_t> > roots;
+    roots.push_back(pair<string, uint16_t>("192.0.2.2", 53));
+    vector<pair<string, uint16_t> > upstream;
+    RecursiveQuery rq(*dns_service_, *nsas_, cache_, upstream, roots,
+                      10, 20, 50, 0);
+    rq.setRaceDelay(1);
+
+    const QuestionPtr q(new Question(Name("www.example.org"), RRClass::IN(),
+                                     RRType::A()));
+    boost::shared_ptr<CountingCallback> callback(new CountingCallback);
+    EXPECT_NE(static_cast<AbstractRunningQuery*>(NULL),
+              rq.resolve(q, callback));
+
+    // The client timeout answers SERVFAIL, and the lookup timeout ends
+    // the query without calling back again.
+    io_service_.run_one();
+    ASSERT_EQ(1, callback->successes);
+    EXPECT_EQ(Rcode::SERVFAIL(), callback->responses[0]->getRcode());
+    io_service_.run_one();
+    EXPECT_EQ(1, callback->successes);
+    EXPECT_EQ(0, callback->failures);
+}
+
 // TODO: add tests that check whether the cache is updated on succesfull
 // responses, and not updated on failures.
 
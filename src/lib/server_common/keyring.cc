@@ -41,7 +41,10 @@ updateKeyring(const std::string&, ConstElementPtr data,
     for (size_t i(0); list && i < list->size(); ++ i) {
         load->add(TSIGKey(list->get(i)->stringValue()));
     }
-    keyring.swap(load);
+    // The new key ring, with its HMAC objects, is completely built before
+    // it's published, so the threads using the old one either keep it or
+    // see the new one.
+    boost::atomic_store(&keyring, load);
 }
 
 }
@@ -63,7 +66,7 @@ deinitKeyring(config::ModuleCCSession& session) {
         return;
     }
     LOG_DEBUG(logger, DBG_TRACE_BASIC, SRVCOMM_KEYS_DEINIT);
-    keyring.reset();
+    boost::atomic_store(&keyring, KeyringPtr());
     session.removeRemoteConfig("tsig_keys");
 }
 
@@ -35,7 +35,10 @@
  * If you want to keep a key (or session) for longer time or your application
  * is multithreaded, you might want to have a copy of the shared pointer to
  * hold a reference. Otherwise an update might replace the keyring and delete
- * the keys in the old one.
+ * the keys in the old one. An update builds the new key ring before it
+ * replaces the old one with boost::atomic_store, so the threads other than
+ * the one handling the configuration should take their copy with
+ * boost::atomic_load.
  *
  * Also note that, while the interface doesn't prevent application from
  * modifying the keyring, it is not a good idea to do so. As mentioned above,
@@ -68,6 +68,9 @@ const std::string& RELEASE_SOCKET_COMMAND() {
 const size_t SOCKET_ERROR_CODE = 2;
 const size_t SHARE_ERROR_CODE = 3;
 
+// The maximum number of sockets of a group the socket creator accepts.
+const size_t MAX_SOCKET_GROUP_SIZE = 1024;
+
 // A helper converter from numeric protocol ID to the corresponding string.
 // used both for generating a message for the bundy-init process and for logging.
 inline const char*
@@ -85,11 +88,11 @@ protocolString(SocketRequestor::Protocol protocol) {
 // Creates the cc session message to request a socket.
 // The actual command format is hardcoded, and should match
 // the format as read in bundy-init.py.in
-bundy::data::ConstElementPtr
-createRequestSocketMessage(SocketRequestor::Protocol protocol,
-                           const std::string& address, uint16_t port,
-                           SocketRequestor::ShareMode share_mode,
-                           const std::string& share_name)
+bundy::data::ElementPtr
+createRequestSocketArgs(SocketRequestor::Protocol protocol,
+                        const std::string& address, uint16_t port,
+                        SocketRequestor::ShareMode share_mode,
+                        const std::string& share_name)
 {
     const bundy::data::ElementPtr request = bundy::data::Element::createMap();
     request->set("address", bundy::data::Element::create(address));
@@ -114,6 +117,50 @@ createRequestSocketMessage(SocketRequestor::Protocol protocol,
     }
     request->set("share_name", bundy::data::Element::create(share_name));
 
+    return (request);
+}
+
+bundy::data::ConstElementPtr
+createRequestSocketMessage(SocketRequestor::Protocol protocol,
+                           const std::string& address, uint16_t port,
+                           SocketRequestor::ShareMode share_mode,
+                           const std::string& share_name)
+{
+    return (bundy::config::createCommand(REQUEST_SOCKET_COMMAND(),
+                                         createRequestSocketArgs(
+                                             protocol, address, port,
+                                             share_mode, share_name)));
+}
+
+bundy::data::ConstElementPtr
+createRequestSocketGroupMessage(SocketRequestor::Protocol protocol,
+                                const std::string& address, uint16_t port,
+                                size_t count,
+                                SocketRequestor::ShareMode share_mode,
+                                const std::string& share_name,
+                                const std::vector<int>& cpus)
+{
+    if (count == 0 || count > MAX_SOCKET_GROUP_SIZE) {
+        bundy_throw(InvalidParameter, "invalid socket group size: " << count);
+    }
+    if (!cpus.empty() && cpus.size() != count) {
+        bundy_throw(InvalidParameter, "socket group of " << count <<
+                    " sockets with " << cpus.size() << " CPUs");
+    }
+    const bundy::data::ElementPtr request =
+        createRequestSocketArgs(protocol, address, port, share_mode,
+                                share_name);
+    request->set("count",
+                 bundy::data::Element::create(static_cast<long int>(count)));
+    if (!cpus.empty()) {
+        const bundy::data::ElementPtr cpu_list =
+            bundy::data::Element::createList();
+        for (size_t i = 0; i < cpus.size(); ++i) {
+            cpu_list->add(bundy::data::Element::create(cpus[i]));
+        }
+        request->set("cpus", cpu_list);
+    }
+
     return (bundy::config::createCommand(REQUEST_SOCKET_COMMAND(), request));
 }
 
@@ -130,10 +177,10 @@ createReleaseSocketMessage(const std::string& token) {
 // answer.
 // If the response was an error response, or does not contain the
 // expected elements, a CCSessionError is raised.
-void
-readRequestSocketAnswer(bundy::data::ConstElementPtr recv_msg,
-                        std::string& token, std::string& path)
-{
+// Parse the answer to a socket request and check its status.  Returns the
+// content of the answer.
+bundy::data::ConstElementPtr
+parseRequestSocketAnswer(bundy::data::ConstElementPtr recv_msg) {
     int rcode;
     bundy::data::ConstElementPtr answer = bundy::config::parseAnswer(rcode,
                                                                  recv_msg);
@@ -149,7 +196,15 @@ readRequestSocketAnswer(bundy::data::ConstElementPtr recv_msg,
         bundy_throw(bundy::config::CCSessionError,
                   "Error response when requesting socket: " << answer->str());
     }
+    return (answer);
+}
 
+void
+readRequestSocketAnswer(bundy::data::ConstElementPtr recv_msg,
+                        std::string& token, std::string& path)
+{
+    const bundy::data::ConstElementPtr answer =
+        parseRequestSocketAnswer(recv_msg);
     if (!answer || !answer->contains("token") || !answer->contains("path")) {
         bundy_throw(bundy::config::CCSessionError,
                   "Malformed answer when requesting socket");
@@ -158,6 +213,25 @@ readRequestSocketAnswer(bundy::data::ConstElementPtr recv_msg,
     path = answer->get("path")->stringValue();
 }
 
+void
+readRequestSocketGroupAnswer(bundy::data::ConstElementPtr recv_msg,
+                             size_t count, std::vector<std::string>& tokens,
+                             std::string& path)
+{
+    const bundy::data::ConstElementPtr answer =
+        parseRequestSocketAnswer(recv_msg);
+    if (!answer || !answer->contains("tokens") || !answer->contains("path") ||
+        answer->get("tokens")->getType() != bundy::data::Element::list ||
+        answer->get("tokens")->size() != count) {
+        bundy_throw(bundy::config::CCSessionError,
+                  "Malformed answer when requesting socket group");
+    }
+    for (size_t i = 0; i < count; ++i) {
+        tokens.push_back(answer->get("tokens")->get(i)->stringValue());
+    }
+    path = answer->get("path")->stringValue();
+}
+
 // Connect to the domain socket that has been received from Init.
 // (i.e. the one that is used to pass created sockets over).
 //
@@ -326,6 +400,58 @@ public:
         return (SocketID(passed_sock_fd, token));
     }
 
+    virtual std::vector<SocketID>
+    requestSocketGroup(Protocol protocol, const std::string& address,
+                       uint16_t port, size_t count, ShareMode share_mode,
+                       const std::string& share_name,
+                       const std::vector<int>& cpus)
+    {
+        const bundy::data::ConstElementPtr request_msg =
+            createRequestSocketGroupMessage(protocol, address, port, count,
+                                            share_mode,
+                                            share_name.empty() ? app_name_ :
+                                            share_name, cpus);
+
+        // Send it to bundy-init and get the answer, as for a single socket
+        const int seq = session_.group_sendmsg(request_msg, "Init");
+        bundy::data::ConstElementPtr env, recv_msg;
+        if (!session_.group_recvmsg(env, recv_msg, false, seq)) {
+            bundy_throw(bundy::config::CCSessionError,
+                      "Incomplete response when requesting socket group");
+        }
+        std::vector<std::string> tokens;
+        std::string path;
+        readRequestSocketGroupAnswer(recv_msg, count, tokens, path);
+        const int sock_pass_fd = getFdShareSocket(path);
+
+        // Get the sockets one by one.  If one fails, we give up the ones
+        // we already got, so the caller holds all of them or none.
+        std::vector<SocketID> sockets;
+        try {
+            for (size_t i = 0; i < count; ++i) {
+                const int passed_sock_fd = getSocketFd(tokens[i],
+                                                       sock_pass_fd);
+                sockets.push_back(SocketID(passed_sock_fd, tokens[i]));
+                LOG_DEBUG(logger, DBGLVL_TRACE_DETAIL,
+                          SOCKETREQUESTOR_GETSOCKET).
+                    arg(protocolString(protocol)).arg(address).arg(port).
+                    arg(passed_sock_fd).arg(tokens[i]).arg(path);
+            }
+        } catch (...) {
+            for (size_t i = 0; i < sockets.size(); ++i) {
+                close(sockets[i].first);
+                try {
+                    releaseSocket(sockets[i].second);
+                } catch (const bundy::Exception&) {
+                    // We're already failing, and bundy-init will release
+                    // the socket when we terminate anyway.
+                }
+            }
+            throw;
+        }
+        return (sockets);
+    }
+
     virtual void releaseSocket(const std::string& token) {
         const bundy::data::ConstElementPtr release_msg =
             createReleaseSocketMessage(token);
@@ -388,6 +514,15 @@ private:
 
 }
 
+std::vector<SocketRequestor::SocketID>
+SocketRequestor::requestSocketGroup(Protocol, const std::string&, uint16_t,
+                                    size_t, ShareMode, const std::string&,
+                                    const std::vector<int>&)
+{
+    bundy_throw(NotImplemented,
+                "this socket requestor doesn't support socket groups");
+}
+
 SocketRequestor&
 socketRequestor() {
     if (requestor != NULL) {
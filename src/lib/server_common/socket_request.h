@@ -20,6 +20,7 @@
 #include <boost/noncopyable.hpp>
 #include <utility>
 #include <string>
+#include <vector>
 #include <stdint.h>
 
 namespace bundy {
@@ -201,6 +202,40 @@ public:
                                    uint16_t port, ShareMode share_mode,
                                    const std::string& share_name = "") = 0;
 
+    /// \brief Ask for a group of sockets bound to the same address
+    ///
+    /// Asks the socket creator to give us \c count sockets, all bound to
+    /// the given address and port with the SO_REUSEPORT option, so the
+    /// system spreads the incoming traffic among them.  This allows for
+    /// example each thread of a multi-threaded server to have a socket of
+    /// its own.  The sockets are created (and shared with other requests)
+    /// as a whole; a group is never shared with a request of a single
+    /// socket.
+    ///
+    /// The default implementation throws NotImplemented.
+    ///
+    /// \param protocol same as for \c requestSocket().
+    /// \param address same as for \c requestSocket().
+    /// \param port same as for \c requestSocket().
+    /// \param count the number of sockets of the group, from 1 to 1024.
+    /// \param share_mode same as for \c requestSocket().
+    /// \param share_name same as for \c requestSocket().
+    /// \param cpus either empty, or the CPU each socket is intended for
+    ///     (or -1).  The system may use it as a hint to prefer the socket
+    ///     for the traffic processed on that CPU.
+    /// \return the sockets, in the order of \c cpus.
+    ///
+    /// \throw InvalidParameter protocol or share_mode is invalid, or cpus
+    ///     has not \c count elements.
+    /// \throw NotImplemented the requestor doesn't support groups.
+    /// Other exceptions are the same as for \c requestSocket().  If any of
+    /// them is thrown, we hold none of the sockets.
+    virtual std::vector<SocketID>
+    requestSocketGroup(Protocol protocol, const std::string& address,
+                       uint16_t port, size_t count, ShareMode share_mode,
+                       const std::string& share_name = "",
+                       const std::vector<int>& cpus = std::vector<int>());
+
     /// \brief Tell the socket creator we no longer need the socket
     ///
     /// Releases the identified socket. This must be called *after*
@@ -202,6 +202,58 @@ TEST_F(SocketRequestorTest, testSocketRequestMessages) {
     EXPECT_EQ(*expected_request, *(session.getMsgQueue()->get(0)));
 }
 
+TEST_F(SocketRequestorTest, testSocketGroupRequestMessages) {
+    clearMsgQueue();
+    const ElementPtr expected_request = Element::fromJSON(
+        createExpectedRequest("192.0.2.1", 12345, "UDP", "SAMEAPP",
+                              "tests")->str());
+    ElementPtr args = boost::const_pointer_cast<Element>(
+        expected_request->get(2)->get("command")->get(1));
+    args->set("count", Element::create(2));
+    args->set("cpus", Element::fromJSON("[0, -1]"));
+    std::vector<int> cpus;
+    cpus.push_back(0);
+    cpus.push_back(-1);
+    EXPECT_THROW(socketRequestor().requestSocketGroup(
+                     SocketRequestor::UDP, "192.0.2.1", 12345, 2,
+                     SocketRequestor::SHARE_SAME, "", cpus),
+                 CCSessionError);
+    ASSERT_EQ(1, session.getMsgQueue()->size());
+    EXPECT_EQ(*expected_request, *(session.getMsgQueue()->get(0)));
+
+    // Without CPUs
+    clearMsgQueue();
+    args->remove("cpus");
+    EXPECT_THROW(socketRequestor().requestSocketGroup(
+                     SocketRequestor::UDP, "192.0.2.1", 12345, 2,
+                     SocketRequestor::SHARE_SAME),
+                 CCSessionError);
+    ASSERT_EQ(1, session.getMsgQueue()->size());
+    EXPECT_EQ(*expected_request, *(session.getMsgQueue()->get(0)));
+
+    // Invalid sizes are rejected before sending anything
+    clearMsgQueue();
+    EXPECT_THROW(socketRequestor().requestSocketGroup(
+                     SocketRequestor::UDP, "192.0.2.1", 12345, 0,
+                     SocketRequestor::SHARE_SAME),
+                 InvalidParameter);
+    EXPECT_THROW(socketRequestor().requestSocketGroup(
+                     SocketRequestor::UDP, "192.0.2.1", 12345, 3,
+                     SocketRequestor::SHARE_SAME, "", cpus),
+                 InvalidParameter);
+    EXPECT_EQ(0, session.getMsgQueue()->size());
+
+    // The answer must have a token for each socket
+    ElementPtr answer_part = Element::createMap();
+    answer_part->set("tokens", Element::fromJSON("[\"foo\"]"));
+    answer_part->set("path", Element::create("/does/not/exist"));
+    session.getMessages()->add(createAnswer(0, answer_part));
+    EXPECT_THROW(socketRequestor().requestSocketGroup(
+                     SocketRequestor::UDP, "192.0.2.1", 12345, 2,
+                     SocketRequestor::SHARE_SAME),
+                 CCSessionError);
+}
+
 TEST_F(SocketRequestorTest, invalidParameterForSocketRequest) {
     // Bad protocol
     EXPECT_THROW(socketRequestor().
@@ -578,6 +630,40 @@ TEST_F(SocketRequestorTest, testSocketPassing) {
             EXPECT_THROW(doRequest(), SocketRequestor::SocketError);
         }
 
+        // A group of sockets
+        TestSocket ts3;
+        std::vector<std::pair<std::string, int> > data3;
+        data3.push_back(std::pair<std::string, int>("foo\n", 1));
+        data3.push_back(std::pair<std::string, int>("bar\n", 2));
+        data3.push_back(std::pair<std::string, int>("foo\n", 1));
+        data3.push_back(std::pair<std::string, int>("bar\n", -1));
+        if (ts3.run(data3)) {
+            ElementPtr answer_part = Element::createMap();
+            answer_part->set("tokens", Element::fromJSON("[\"foo\", \"bar\"]"));
+            answer_part->set("path", Element::create(ts3.getPath()));
+            session.getMessages()->add(createAnswer(0, answer_part));
+            const std::vector<SocketRequestor::SocketID> sockets =
+                socketRequestor().requestSocketGroup(
+                    SocketRequestor::UDP, "192.0.2.1", 12345, 2,
+                    SocketRequestor::DONT_SHARE, "test");
+            ASSERT_EQ(2, sockets.size());
+            EXPECT_EQ("foo", sockets[0].second);
+            EXPECT_EQ("bar", sockets[1].second);
+            EXPECT_EQ(0, close(sockets[0].first));
+            EXPECT_EQ(0, close(sockets[1].first));
+
+            // If one of them fails, the ones already received are released
+            clearMsgQueue();
+            session.getMessages()->add(createAnswer(0, answer_part));
+            EXPECT_THROW(socketRequestor().requestSocketGroup(
+                             SocketRequestor::UDP, "192.0.2.1", 12345, 2,
+                             SocketRequestor::DONT_SHARE, "test"),
+                         SocketRequestor::SocketError);
+            ASSERT_EQ(2, session.getMsgQueue()->size());
+            EXPECT_EQ(*createExpectedRelease("foo"),
+                      *session.getMsgQueue()->get(1));
+        }
+
         // Vector is of first socket is now empty, so the socket should be gone
         addAnswer("foo", ts.getPath());
         EXPECT_THROW(doRequest(), SocketRequestor::SocketError);
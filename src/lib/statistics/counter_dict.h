@@ -17,32 +17,67 @@
 
 #include <statistics/counter.h>
 #include <exceptions/exceptions.h>
+#include <util/threads/rcu.h>
 
 #include <boost/noncopyable.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/iterator/iterator_facade.hpp>
 
+#include <atomic>
 #include <cassert>
 #include <stdexcept>
 #include <string>
 #include <map>
 #include <iterator>
+#include <memory>
 #include <utility>
+#include <vector>
 
 
 namespace bundy {
 namespace statistics {
 
+/// \brief A dictionary of \c Counter objects keyed by name.
+///
+/// Besides its name, each element is given a \c Handle when it's added,
+/// which is an index into an array of the counters.  Incrementing a
+/// counter through \c inc() with the handle doesn't have to look up the
+/// name, and it doesn't take a lock: the array is replaced by a new copy
+/// when an element is added or deleted, and the old one is only freed
+/// after the threads incrementing the counters have stopped using it
+/// (see \c bundy::util::thread::RCU).  So \c inc() can be called from
+/// multiple threads while another thread adds or deletes elements;
+/// the other methods must not be called concurrently with each other.
 class CounterDictionary : boost::noncopyable {
+public:
+    /// \brief The type of handles to the elements.
+    typedef size_t Handle;
+
 private:
     typedef boost::shared_ptr<bundy::statistics::Counter> CounterPtr;
-    typedef std::map<std::string, CounterPtr> DictionaryMap;
+    typedef std::map<std::string, std::pair<CounterPtr, Handle> >
+        DictionaryMap;
+    // The counters indexed by the handles; NULL for the free handles.
+    typedef std::vector<Counter*> SlotTable;
     DictionaryMap dictionary_;
     const size_t items_;
+    // The slots are only replaced as a whole, so inc() can use them within
+    // a read-side critical section of rcu_.
+    mutable bundy::util::thread::RCU rcu_;
+    std::atomic<const SlotTable*> slots_;
+    std::vector<Handle> free_handles_;
     // Default constructor is forbidden; number of counter items must be
     // specified at the construction of this class.
     CounterDictionary();
+
+    // Replace the slots with new_slots and free the old ones once no
+    // reader can use them.
+    void publishSlots(const SlotTable* new_slots) {
+        const boost::scoped_ptr<const SlotTable> old_slots(
+            slots_.exchange(new_slots, std::memory_order_acq_rel));
+        rcu_.synchronize();
+    }
 public:
     /// The constructor.
     ///
@@ -55,30 +90,58 @@ public:
     ///
     /// \throw bundy::InvalidParameter \a items is 0
     explicit CounterDictionary(const size_t items) :
-        items_(items)
+        items_(items), slots_(NULL)
     {
         // The number of items must not be 0
         if (items == 0) {
             bundy_throw(bundy::InvalidParameter, "Items must not be 0");
         }
+        slots_ = new SlotTable;
+    }
+
+    /// \brief The destructor.
+    ///
+    /// There must be no thread in \c inc() when it's destroyed.
+    ~CounterDictionary() {
+        delete slots_.load(std::memory_order_relaxed);
     }
 
     /// \brief Add an element which has a key \a name to the dictionary.
     ///
+    /// The handles of deleted elements are reused, so the handles in use
+    /// stay small and the slot array doesn't grow beyond the largest
+    /// number of elements the dictionary had at the same time.
+    ///
     /// \param name A key of the element to add
+    /// \return The handle of the new element
     ///
     /// \throw bundy::InvalidParameter an element which has \a name as key
     ///                              already exists
-    void addElement(const std::string& name) {
+    Handle addElement(const std::string& name) {
         // throw if the element already exists
         if (dictionary_.find(name) != dictionary_.end()) {
             bundy_throw(bundy::InvalidParameter,
                       "Element " << name << " already exists");
         }
         assert(items_ != 0);
-        // Create a new Counter and add to the map
+        // Create a new Counter and put it in a copy of the slots, then add
+        // it to the map; nothing changes if any of them fails.
+        const CounterPtr counter(new Counter(items_));
+        std::unique_ptr<SlotTable> new_slots(
+            new SlotTable(*slots_.load(std::memory_order_relaxed)));
+        const Handle handle = free_handles_.empty() ? new_slots->size() :
+            free_handles_.back();
+        if (handle == new_slots->size()) {
+            new_slots->push_back(NULL);
+        }
+        (*new_slots)[handle] = counter.get();
         dictionary_.insert(
-            DictionaryMap::value_type(name, CounterPtr(new Counter(items_))));
+            DictionaryMap::value_type(name, std::make_pair(counter, handle)));
+        if (!free_handles_.empty()) {
+            free_handles_.pop_back();
+        }
+        publishSlots(new_slots.release());
+        return (handle);
     }
 
     /// \brief Delete the element which has a key \a name from the dictionary.
@@ -88,13 +151,64 @@ public:
     /// \throw bundy::OutOfRange an element which has \a name as key does not
     ///                        exist
     void deleteElement(const std::string& name) {
-        const size_t result = dictionary_.erase(name);
-        if (result != 1) {
+        const DictionaryMap::iterator i = dictionary_.find(name);
+        if (i == dictionary_.end()) {
             // If an element with specified name does not exist, throw
             // bundy::OutOfRange.
             bundy_throw(bundy::OutOfRange,
                       "Element " << name << " does not exist");
         }
+        const Handle handle = i->second.second;
+        std::unique_ptr<SlotTable> new_slots(
+            new SlotTable(*slots_.load(std::memory_order_relaxed)));
+        (*new_slots)[handle] = NULL;
+        free_handles_.reserve(free_handles_.size() + 1);
+        // Once the new slots are published, no thread in inc() can still
+        // see the counter, so it can be destroyed.
+        publishSlots(new_slots.release());
+        free_handles_.push_back(handle);
+        dictionary_.erase(i);
+    }
+
+    /// \brief Get the handle of the element which has \a name as key.
+    ///
+    /// The handle is valid until the element is deleted, after which it
+    /// may be given to another element.
+    ///
+    /// \param name A key of the element
+    ///
+    /// \throw bundy::OutOfRange an element which has \a name as key does not
+    ///                        exist
+    Handle getHandle(const std::string& name) const {
+        const DictionaryMap::const_iterator i = dictionary_.find(name);
+        if (i == dictionary_.end()) {
+            bundy_throw(bundy::OutOfRange,
+                      "Element " << name << " does not exist");
+        }
+        return (i->second.second);
+    }
+
+    /// \brief Increment the counter item \a type of the element of
+    /// \a handle.
+    ///
+    /// This can be called from multiple threads without locking, while
+    /// another thread adds or deletes elements.  The \c Counter itself
+    /// isn't synchronized though, so the threads should increment the
+    /// counters of different elements, or the counts may be lost.
+    ///
+    /// \param handle The handle of the element
+    /// \param type %Counter item to increment
+    ///
+    /// \throw bundy::OutOfRange \a handle is not of an element, or \a type
+    ///                        is invalid
+    void inc(const Handle handle, const Counter::Type& type) {
+        const bundy::util::thread::RCU::ReadLocker locker(rcu_);
+        const SlotTable& slots = *slots_.load(std::memory_order_acquire);
+        if (handle >= slots.size() || slots[handle] == NULL) {
+            bundy_throw(bundy::OutOfRange,
+                      "Element handle " << handle << " does not exist");
+        }
+        slots[handle]->inc(type);
     }
 
     /// \brief Get a reference to a %Counter which has \a name as key
@@ -107,7 +221,7 @@ public:
         DictionaryMap::const_iterator i = dictionary_.find(name);
         if (i != dictionary_.end()) {
             // the key was found. return the element.
-            return (*(i->second));
+            return (*(i->second.first));
         } else {
             // If an element with specified name does not exist, throw
             // bundy::OutOfRange.
@@ -116,6 +230,20 @@ public:
         }
     }
 
+    /// \brief Get a reference to the %Counter of the element of \a handle.
+    ///
+    /// \param handle The handle of the element
+    ///
+    /// \throw bundy::OutOfRange \a handle is not of an element
+    Counter& getElement(const Handle handle) {
+        const SlotTable& slots = *slots_.load(std::memory_order_relaxed);
+        if (handle >= slots.size() || slots[handle] == NULL) {
+            bundy_throw(bundy::OutOfRange,
+                      "Element handle " << handle << " does not exist");
+        }
+        return (*slots[handle]);
+    }
+
     /// \brief Same as \c getElement()
     Counter& operator[](const std::string& name) {
         return (getElement(name));
@@ -0,0 +1,147 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef STATISTICS_HISTOGRAM_H
+#define STATISTICS_HISTOGRAM_H 1
+
+#include <statistics/sharded_counter.h>
+#include <exceptions/exceptions.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace statistics {
+
+/// \brief A log-linear histogram that can be updated by multiple threads.
+///
+/// Each power of two of the value range is split into \c SUB_BUCKETS
+/// buckets of the same width, so the precision relative to the value is
+/// the same (within 1/SUB_BUCKETS) over the whole range while the number
+/// of buckets only grows with the logarithm of the maximum value.  Values
+/// smaller than \c SUB_BUCKETS get a bucket each.  Values not smaller than
+/// 2 to the power of the \c bits given to the constructor are counted in
+/// the last, overflow, bucket.
+///
+/// The buckets are kept in a \c ShardedCounter, so \c add() takes no lock
+/// and the memory used is fixed on construction.
+class Histogram : boost::noncopyable {
+public:
+    typedef ShardedCounter::Value Value;
+
+    /// \brief log2 of the number of buckets per power of two.
+    static const unsigned int SUB_BUCKET_BITS = 3;
+
+    /// \brief The number of buckets per power of two.
+    static const unsigned int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+
+    /// \brief Constructor.
+    ///
+    /// \param bits The number of bits of the largest value to be told
+    ///     from bigger ones (greater than \c SUB_BUCKET_BITS and less
+    ///     than 64).
+    /// \param shards The number of shards of the underlying counter.
+    ///
+    /// \throw bundy::InvalidParameter \a bits is out of range or
+    ///     \a shards is 0
+    explicit Histogram(const unsigned int bits,
+                       const size_t shards = ShardedCounter::SHARD_COUNT) :
+        overflow_(checkBits(bits) << SUB_BUCKET_BITS),
+        counter_(overflow_ + 1, shards)
+    {}
+
+    /// \brief Count a value.
+    ///
+    /// \throw None
+    void add(const uint64_t value) {
+        counter_.inc(getBucket(value));
+    }
+
+    /// \brief The number of buckets, including the overflow one.
+    size_t getBucketCount() const {
+        return (overflow_ + 1);
+    }
+
+    /// \brief The count of values in a bucket.
+    ///
+    /// \throw bundy::OutOfRange \a bucket is not less than
+    ///     \c getBucketCount()
+    Value get(const size_t bucket) const {
+        return (counter_.get(bucket));
+    }
+
+    /// \brief The bucket a value is counted in.
+    size_t getBucket(const uint64_t value) const {
+        if (value < SUB_BUCKETS) {
+            return (value);
+        }
+        const unsigned int exponent = highestBit(value);
+        const size_t bucket =
+            ((exponent - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS) |
+            ((value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+        return (bucket < overflow_ ? bucket : overflow_);
+    }
+
+    /// \brief The smallest value counted in a bucket.
+    ///
+    /// For the overflow bucket, this is the smallest value that overflows.
+    ///
+    /// \throw bundy::OutOfRange \a bucket is not less than
+    ///     \c getBucketCount()
+    uint64_t getBucketLowerBound(const size_t bucket) const {
+        if (bucket > overflow_) {
+            bundy_throw(bundy::OutOfRange, "Bucket is out of range");
+        }
+        if (bucket < SUB_BUCKETS) {
+            return (bucket);
+        }
+        const unsigned int exponent =
+            (bucket >> SUB_BUCKET_BITS) + SUB_BUCKET_BITS - 1;
+        const uint64_t mantissa = SUB_BUCKETS + (bucket & (SUB_BUCKETS - 1));
+        return (mantissa << (exponent - SUB_BUCKET_BITS));
+    }
+
+private:
+    // The number of power of two ranges, with the linear one at the
+    // bottom counted as one.
+    static size_t checkBits(const unsigned int bits) {
+        if (bits <= SUB_BUCKET_BITS || bits >= 64) {
+            bundy_throw(bundy::InvalidParameter,
+                        "Histogram bits out of range: " << bits);
+        }
+        return (bits - SUB_BUCKET_BITS + 1);
+    }
+
+    // The index of the highest bit set in a non-zero value.
+    static unsigned int highestBit(uint64_t value) {
+#ifdef __GNUC__
+        return (63 - __builtin_clzll(value));
+#else
+        unsigned int result = 0;
+        while (value >>= 1) {
+            ++result;
+        }
+        return (result);
+#endif
+    }
+
+    const size_t overflow_;     // The index of the overflow bucket.
+    ShardedCounter counter_;
+};
+
+}   // namespace statistics
+}   // namespace bundy
+
+#endif // STATISTICS_HISTOGRAM_H
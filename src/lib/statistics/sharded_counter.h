@@ -0,0 +1,141 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SHARDED_COUNTER_H
+#define SHARDED_COUNTER_H 1
+
+#include <statistics/counter.h>
+#include <exceptions/exceptions.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <vector>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace statistics {
+
+/// \brief A set of counters that can be incremented by multiple threads.
+///
+/// This is a thread safe variant of \c Counter.  Each thread increments
+/// the counters in its own shard, which takes whole cache lines, so the
+/// threads neither lock nor bounce cache lines between them.  \c get()
+/// sums the shards when the value is needed, without blocking the
+/// writers; a value that is being incremented meanwhile may or may not
+/// be included.
+///
+/// Threads are assigned shards on their first increment.  If there are
+/// more threads than shards, some share a shard, which is still correct
+/// but makes them contend.  Fewer shards than \c SHARD_COUNT can be used
+/// to save memory where contention is less of a concern.
+class ShardedCounter : boost::noncopyable {
+public:
+    typedef Counter::Type Type;
+    typedef Counter::Value Value;
+
+    /// \brief The default number of shards.
+    static const size_t SHARD_COUNT = 64;
+
+    /// \brief The size of a cache line on common architectures.
+    static const size_t CACHE_LINE_SIZE = 64;
+
+    /// The constructor.
+    ///
+    /// This constructor prepares a set of counters which has \a items
+    /// elements. The counters will be initialized with 0.
+    ///
+    /// \param items A number of counter items to hold (greater than 0)
+    /// \param shards The number of shards (greater than 0)
+    ///
+    /// \throw bundy::InvalidParameter \a items or \a shards is 0
+    explicit ShardedCounter(const size_t items,
+                            const size_t shards = SHARD_COUNT) :
+        items_(items),
+        shards_(shards),
+        stride_((items + VALUES_PER_LINE - 1) / VALUES_PER_LINE *
+                VALUES_PER_LINE),
+        // One more line leaves room to align the first shard.
+        counters_(stride_ * shards + VALUES_PER_LINE),
+        offset_(0)
+    {
+        if (items == 0) {
+            bundy_throw(bundy::InvalidParameter, "Items must not be 0");
+        }
+        if (shards == 0) {
+            bundy_throw(bundy::InvalidParameter, "Shards must not be 0");
+        }
+        while (reinterpret_cast<uintptr_t>(&counters_[offset_]) %
+               CACHE_LINE_SIZE != 0) {
+            ++offset_;
+        }
+    }
+
+    /// \brief Increment a counter item specified with \a type.
+    ///
+    /// The item is not checked; it must be less than the number of items.
+    ///
+    /// \param type %Counter item to increment
+    ///
+    /// \throw None
+    void inc(const Type& type) {
+        assert(type < items_);
+        counters_[offset_ + getThreadShard() % shards_ * stride_ + type].
+            fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// \brief Get the value of a counter item specified with \a type.
+    ///
+    /// \param type %Counter item to get the value of
+    ///
+    /// \throw bundy::OutOfRange \a type is invalid
+    Value get(const Type& type) const {
+        if (type >= items_) {
+            bundy_throw(bundy::OutOfRange, "Counter type is out of range");
+        }
+        Value value = 0;
+        for (size_t i = 0; i < shards_; ++i) {
+            value += counters_[offset_ + i * stride_ + type].
+                load(std::memory_order_relaxed);
+        }
+        return (value);
+    }
+
+private:
+    static const size_t VALUES_PER_LINE = CACHE_LINE_SIZE / sizeof(Value);
+
+    // The shard of the calling thread, assigned on the first use.  It's
+    // the same for all the counters.
+    static size_t getThreadShard() {
+        static std::atomic<size_t> next_shard(0);
+        static thread_local size_t shard =
+            next_shard.fetch_add(1) % SHARD_COUNT;
+        return (shard);
+    }
+
+    const size_t items_;
+    const size_t shards_;
+    // The distance between the shards, the items rounded up to whole
+    // cache lines.
+    const size_t stride_;
+    std::vector<std::atomic<Value> > counters_;
+    size_t offset_; // The index of the first (aligned) shard.
+};
+
+}   // namespace statistics
+}   // namespace bundy
+
+#endif // SHARDED_COUNTER_H
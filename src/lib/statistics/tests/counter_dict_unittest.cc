@@ -105,6 +105,41 @@ TEST_F(CounterDictionaryTest, uniquenessCheck) {
     EXPECT_THROW(counters.addElement("test"), bundy::InvalidParameter);
 }
 
+TEST_F(CounterDictionaryTest, handle) {
+    const CounterDictionary::Handle test_handle = counters.getHandle("test");
+    const CounterDictionary::Handle sub_handle =
+        counters.getHandle("sub.test");
+    EXPECT_NE(test_handle, sub_handle);
+    EXPECT_THROW(counters.getHandle("nosuch"), bundy::OutOfRange);
+
+    // Increments through the handles are seen through the names
+    counters.inc(test_handle, ITEM1);
+    counters.inc(sub_handle, ITEM2);
+    counters.inc(sub_handle, ITEM2);
+    EXPECT_EQ(1, counters["test"].get(ITEM1));
+    EXPECT_EQ(0, counters["test"].get(ITEM2));
+    EXPECT_EQ(2, counters["sub.test"].get(ITEM2));
+    EXPECT_EQ(&counters["test"], &counters.getElement(test_handle));
+    EXPECT_THROW(counters.inc(test_handle, NUMBER_OF_ITEMS),
+                 bundy::OutOfRange);
+
+    // The handle of a deleted element is invalid, and it's reused by the
+    // next element added, which starts with 0 again.
+    counters.deleteElement("test");
+    EXPECT_THROW(counters.inc(test_handle, ITEM1), bundy::OutOfRange);
+    EXPECT_THROW(counters.getElement(test_handle), bundy::OutOfRange);
+    EXPECT_EQ(test_handle, counters.addElement("other.test"));
+    EXPECT_EQ(test_handle, counters.getHandle("other.test"));
+    EXPECT_EQ(0, counters.getElement(test_handle).get(ITEM1));
+    EXPECT_EQ(2, counters.getElement(sub_handle).get(ITEM2));
+
+    // A new handle once no one is free
+    const CounterDictionary::Handle new_handle = counters.addElement("new");
+    EXPECT_NE(test_handle, new_handle);
+    EXPECT_NE(sub_handle, new_handle);
+    EXPECT_THROW(counters.inc(new_handle + 1, ITEM1), bundy::OutOfRange);
+}
+
 TEST_F(CounterDictionaryTest, iteratorTest) {
     // Increment counters
     counters["test"].inc(ITEM1);
@@ -0,0 +1,80 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+#include <gtest/gtest.h>
+
+#include <statistics/histogram.h>
+
+using namespace bundy::statistics;
+
+namespace {
+
+TEST(HistogramTest, invalidBits) {
+    EXPECT_THROW(Histogram(Histogram::SUB_BUCKET_BITS),
+                 bundy::InvalidParameter);
+    EXPECT_THROW(Histogram(64), bundy::InvalidParameter);
+    EXPECT_THROW(Histogram(10, 0), bundy::InvalidParameter);
+}
+
+TEST(HistogramTest, buckets) {
+    // 8 linear buckets, 8 more for each of 8 to 1023, and the overflow.
+    Histogram histogram(10);
+    EXPECT_EQ(8 * 8 + 1, histogram.getBucketCount());
+
+    // Small values get a bucket each.
+    for (uint64_t i = 0; i < 16; ++i) {
+        EXPECT_EQ(i, histogram.getBucket(i));
+        EXPECT_EQ(i, histogram.getBucketLowerBound(i));
+    }
+    // Then they are split to 8 buckets per power of two.
+    EXPECT_EQ(16, histogram.getBucket(16));
+    EXPECT_EQ(16, histogram.getBucket(17));
+    EXPECT_EQ(17, histogram.getBucket(18));
+    EXPECT_EQ(23, histogram.getBucket(31));
+    EXPECT_EQ(24, histogram.getBucket(32));
+    EXPECT_EQ(18, histogram.getBucketLowerBound(17));
+    EXPECT_EQ(30, histogram.getBucketLowerBound(23));
+    EXPECT_EQ(32, histogram.getBucketLowerBound(24));
+    EXPECT_EQ(960, histogram.getBucketLowerBound(63));
+    EXPECT_EQ(63, histogram.getBucket(1023));
+
+    // Anything bigger overflows.
+    EXPECT_EQ(64, histogram.getBucket(1024));
+    EXPECT_EQ(64, histogram.getBucket(0xffffffffffffffffULL));
+    EXPECT_EQ(1024, histogram.getBucketLowerBound(64));
+    EXPECT_THROW(histogram.getBucketLowerBound(65), bundy::OutOfRange);
+
+    // Every value falls between the bounds of its bucket.
+    for (uint64_t i = 0; i < 1024; ++i) {
+        const size_t bucket = histogram.getBucket(i);
+        EXPECT_LE(histogram.getBucketLowerBound(bucket), i);
+        EXPECT_GT(histogram.getBucketLowerBound(bucket + 1), i);
+    }
+}
+
+TEST(HistogramTest, add) {
+    Histogram histogram(10);
+    histogram.add(3);
+    histogram.add(100);
+    histogram.add(101);
+    histogram.add(5000);
+    EXPECT_EQ(1, histogram.get(3));
+    EXPECT_EQ(2, histogram.get(histogram.getBucket(100)));
+    EXPECT_EQ(1, histogram.get(64));
+    EXPECT_EQ(0, histogram.get(4));
+    EXPECT_THROW(histogram.get(65), bundy::OutOfRange);
+}
+
+}
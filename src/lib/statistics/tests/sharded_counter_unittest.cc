@@ -0,0 +1,88 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+#include <gtest/gtest.h>
+
+#include <statistics/sharded_counter.h>
+#include <util/threads/thread.h>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
+
+using namespace bundy::statistics;
+using bundy::util::thread::Thread;
+
+namespace {
+enum CounterItems {
+    ITEM1 = 0,
+    ITEM2 = 1,
+    ITEM3 = 2,
+    NUMBER_OF_ITEMS = 3
+};
+
+TEST(ShardedCounterTest, invalidCounterSize) {
+    EXPECT_THROW(ShardedCounter counter(0), bundy::InvalidParameter);
+}
+
+TEST(ShardedCounterTest, incrementCounterItem) {
+    ShardedCounter counter(NUMBER_OF_ITEMS);
+    EXPECT_EQ(0, counter.get(ITEM1));
+    EXPECT_EQ(0, counter.get(ITEM2));
+    EXPECT_EQ(0, counter.get(ITEM3));
+
+    counter.inc(ITEM1);
+    counter.inc(ITEM2);
+    counter.inc(ITEM2);
+    counter.inc(ITEM3);
+    counter.inc(ITEM3);
+    counter.inc(ITEM3);
+    EXPECT_EQ(1, counter.get(ITEM1));
+    EXPECT_EQ(2, counter.get(ITEM2));
+    EXPECT_EQ(3, counter.get(ITEM3));
+
+    // Trying to get out-of-bound counter will cause an bundy::OutOfRange
+    // exception
+    EXPECT_THROW(counter.get(NUMBER_OF_ITEMS), bundy::OutOfRange);
+}
+
+void
+incrementMany(ShardedCounter* counter, int count) {
+    for (int i = 0; i < count; ++i) {
+        counter->inc(ITEM1);
+        counter->inc(ITEM3);
+    }
+}
+
+// Increments don't get lost when done from several threads.  (There are
+// more threads than shards, so some of them share one.)
+TEST(ShardedCounterTest, threads) {
+    ShardedCounter counter(NUMBER_OF_ITEMS);
+    const int thread_count = 70;
+    const int count = 10000;
+    std::vector<boost::shared_ptr<Thread> > threads;
+    for (int i = 0; i < thread_count; ++i) {
+        threads.push_back(boost::shared_ptr<Thread>(
+            new Thread(boost::bind(incrementMany, &counter, count))));
+    }
+    for (int i = 0; i < thread_count; ++i) {
+        threads[i]->wait();
+    }
+    EXPECT_EQ(thread_count * count, counter.get(ITEM1));
+    EXPECT_EQ(0, counter.get(ITEM2));
+    EXPECT_EQ(thread_count * count, counter.get(ITEM3));
+}
+}
@@ -75,7 +75,9 @@ public:
     virtual void subscribe(std::string, std::string) {}
     virtual void unsubscribe(std::string, std::string) {}
 
-    virtual void startRead(boost::function<void()>) {}
+    virtual void startRead(boost::function<void()> read_callback) {
+        read_callback_ = read_callback;
+    }
 
     virtual int reply(bundy::data::ConstElementPtr, bundy::data::ConstElementPtr) {
         return (-1);
@@ -100,6 +102,18 @@ public:
     /// to group_sendmsg().
     bool wasAnswerWanted() const { return (answer_wanted_); }
 
+    /// \brief Return whether startRead() has been called and the callback
+    /// is still pending.
+    bool isReading() const { return (!read_callback_.empty()); }
+
+    /// \brief Call the callback passed to the previous call to startRead(),
+    /// as if a message had arrived.
+    void deliverMessage() {
+        boost::function<void()> callback;
+        callback.swap(read_callback_);
+        callback();
+    }
+
 private:
     bundy::data::ConstElementPtr sent_msg_;
     std::string msg_dest_;
@@ -107,13 +121,17 @@ private:
     bool send_ok_;
     bool receive_ok_;
     bool answer_wanted_;
+    boost::function<void()> read_callback_;
 };
 
 // This mock object does nothing except for recording passed parameters
 // to addServerXXX methods so the test code subsequently checks the parameters.
 class MockDNSService : public bundy::asiodns::DNSServiceBase {
 public:
-    MockDNSService() : tcp_recv_timeout_(0) {}
+    MockDNSService() :
+        tcp_recv_timeout_(0), udp_batch_size_(1), tcp_max_in_flight_(16),
+        udp_overload_latency_(0)
+    {}
 
     // A helper tuple of parameters passed to addServerUDPFromFD().
     struct UDPFdParams {
@@ -153,22 +171,52 @@ public:
         return tcp_recv_timeout_;
     }
 
+    virtual void setUDPBatchSize(size_t batch_size) {
+        udp_batch_size_ = batch_size;
+    }
+
+    size_t getUDPBatchSize() const {
+        return (udp_batch_size_);
+    }
+
+    virtual void setTCPMaxInFlight(size_t max_in_flight) {
+        tcp_max_in_flight_ = max_in_flight;
+    }
+
+    size_t getTCPMaxInFlight() const {
+        return (tcp_max_in_flight_);
+    }
+
+    virtual void setUDPOverloadLatency(size_t latency) {
+        udp_overload_latency_ = latency;
+    }
+
+    size_t getUDPOverloadLatency() const {
+        return (udp_overload_latency_);
+    }
+
 private:
     std::vector<std::pair<int, int> > tcp_fd_params_;
     std::vector<UDPFdParams> udp_fd_params_;
     size_t tcp_recv_timeout_;
+    size_t udp_batch_size_;
+    size_t tcp_max_in_flight_;
+    size_t udp_overload_latency_;
 };
 
 // A nonoperative DNSServer object to be used in calls to processMessage().
 class MockServer : public bundy::asiodns::DNSServer {
 public:
-    MockServer() : done_(false) {}
+    MockServer() : done_(false), overloaded_(false) {}
     void operator()(asio::error_code, size_t) {}
     virtual void resume(const bool done) { done_ = done; }
     virtual bool hasAnswer() { return (done_); }
     virtual int value() { return (0); }
+    virtual bool isOverloaded() const { return (overloaded_); }
+    void setOverloaded(bool overloaded) { overloaded_ = overloaded; }
 private:
     bool done_;
+    bool overloaded_;
 };
 
 } // end of testutils
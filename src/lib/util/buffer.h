@@ -288,6 +288,14 @@ protected:
 /// by the system.  This also applies to the constructor with a very large
 /// initial size.
 ///
+/// An \c OutputBuffer can also be constructed on storage provided by the
+/// caller, such as an array on the stack or a slot of a larger I/O buffer,
+/// so that rendering data of an expected maximum size doesn't involve any
+/// dynamic memory allocation.  The buffer never frees or reallocates that
+/// storage; if data is written beyond its end, the buffer falls back to
+/// memory allocated by itself, copies the data written so far, and works
+/// as a normal buffer from that point (see \c isExternalStorage()).
+///
 /// Note to developers: it may make more sense to introduce an abstract base
 /// class for the \c OutputBuffer and define the simple implementation as a
 /// a concrete derived class.  That way we can provide flexibility for future
@@ -311,7 +319,8 @@ public:
     OutputBuffer(size_t len) :
         buffer_(NULL),
         size_(0),
-        allocated_(len)
+        allocated_(len),
+        external_(false)
     {
         // We use malloc and free instead of C++ new[] and delete[].
         // This way we can use realloc, which may in fact do it without a copy.
@@ -321,11 +330,34 @@ public:
         }
     }
 
+    /// \brief Constructor on caller-provided storage.
+    ///
+    /// The buffer initially writes data into \c storage, whose capacity is
+    /// \c len bytes.  The storage must be valid while the buffer uses it,
+    /// and it's never freed by the buffer.  If more than \c len bytes are
+    /// written, the data is moved to memory allocated by the buffer.
+    ///
+    /// \throw None
+    ///
+    /// \param storage The head of the storage.  It can be NULL if \c len
+    /// is 0.
+    /// \param len The length of the storage in bytes.
+    OutputBuffer(void* storage, size_t len) :
+        buffer_(static_cast<uint8_t*>(storage)),
+        size_(0),
+        allocated_(len),
+        external_(true)
+    {}
+
     /// \brief Copy constructor
+    ///
+    /// The new buffer always has its own memory, even if \c other uses
+    /// caller-provided storage.
     OutputBuffer(const OutputBuffer& other) :
         buffer_(NULL),
         size_(other.size_),
-        allocated_(other.allocated_)
+        allocated_(other.allocated_),
+        external_(false)
     {
         buffer_ = static_cast<uint8_t*>(malloc(allocated_));
         if (buffer_ == NULL && allocated_ != 0) {
@@ -336,21 +368,29 @@ public:
 
     /// \brief Destructor
     ~ OutputBuffer() {
-        free(buffer_);
+        if (!external_) {
+            free(buffer_);
+        }
     }
     //@}
 
     /// \brief Assignment operator
+    ///
+    /// Like the copy constructor, the buffer has its own memory after the
+    /// assignment.
     OutputBuffer& operator =(const OutputBuffer& other) {
         if (this != &other) {
             uint8_t* newbuff(static_cast<uint8_t*>(malloc(other.allocated_)));
             if (newbuff == NULL && other.allocated_ != 0) {
                 throw std::bad_alloc();
             }
-            free(buffer_);
+            if (!external_) {
+                free(buffer_);
+            }
             buffer_ = newbuff;
             size_ = other.size_;
             allocated_ = other.allocated_;
+            external_ = false;
             std::memcpy(buffer_, other.buffer_, size_);
         }
         return (*this);
@@ -372,6 +412,12 @@ public:
     const void* getData() const { return (buffer_); }
     /// \brief Return the length of data written in the buffer.
     size_t getLength() const { return (size_); }
+    /// \brief Return whether the buffer still uses caller-provided storage.
+    ///
+    /// This is \c true if the buffer was constructed on caller-provided
+    /// storage and no data has been written beyond its end; in that case
+    /// \c getData() returns the head of that storage.
+    bool isExternalStorage() const { return (external_); }
     /// \brief Return the value of the buffer at the specified position.
     ///
     /// \c pos must specify the valid position of the buffer; otherwise an
@@ -505,14 +551,35 @@ private:
     size_t size_;
     // How many bytes do we have preallocated (eg. the capacity)
     size_t allocated_;
+    // Whether buffer_ is caller-provided storage (which we must not free)
+    bool external_;
     // Make sure at last needed_size bytes are allocated in the buffer
     void ensureAllocated(size_t needed_size) {
         if (allocated_ < needed_size) {
-            // Guess some bigger size
-            size_t new_size = (allocated_ == 0) ? 1024 : allocated_;
-            while (new_size < needed_size) {
-                new_size *= 2;
+            grow(needed_size);
+        }
+    }
+    // The slow path of ensureAllocated(), kept separate from the common
+    // case inlined in the write methods.
+    void grow(size_t needed_size) {
+        // Guess some bigger size
+        size_t new_size = (allocated_ == 0) ? 1024 : allocated_;
+        while (new_size < needed_size) {
+            new_size *= 2;
+        }
+        if (external_) {
+            // Move the data out of the caller-provided storage.
+            uint8_t* new_buffer_(static_cast<uint8_t*>(malloc(new_size)));
+            if (new_buffer_ == NULL) {
+                throw std::bad_alloc();
             }
+            // The storage can be NULL if it's empty.
+            if (size_ > 0) {
+                std::memcpy(new_buffer_, buffer_, size_);
+            }
+            buffer_ = new_buffer_;
+            external_ = false;
+        } else {
             // Allocate bigger space
             uint8_t* new_buffer_(static_cast<uint8_t*>(realloc(buffer_,
                 new_size)));
@@ -521,8 +588,8 @@ private:
                 throw std::bad_alloc();
             }
             buffer_ = new_buffer_;
-            allocated_ = new_size;
         }
+        allocated_ = new_size;
     }
 };
 
@@ -13,11 +13,12 @@
 // PERFORMANCE OF THIS SOFTWARE.
 
 #include <util/csv_file.h>
-#include <boost/algorithm/string/classification.hpp>
-#include <boost/algorithm/string/constants.hpp>
-#include <boost/algorithm/string/split.hpp>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
 #include <fstream>
 #include <sstream>
+#include <unistd.h>
 
 namespace bundy {
 namespace util {
@@ -34,13 +35,33 @@ CSVRow::CSVRow(const std::string& text, const char separator)
 
 void
 CSVRow::parse(const std::string& line) {
-    // Tokenize the string using a specified separator. Disable compression,
-    // so as the two consecutive separators mark an empty value.
-    boost::split(values_, line, boost::is_any_of(separator_),
-                 boost::algorithm::token_compress_off);
+    // Tokenize the string using a specified separator. The two consecutive
+    // separators mark an empty value. The strings already held in the
+    // container are reused, so as parsing rows of the same file into the
+    // same object doesn't allocate memory for each value.
+    const char separator = separator_[0];
+    size_t count = 0;
+    size_t start = 0;
+    for (;;) {
+        size_t end = line.find(separator, start);
+        if (end == std::string::npos) {
+            end = line.size();
+        }
+        if (count < values_.size()) {
+            values_[count].assign(line, start, end - start);
+        } else {
+            values_.push_back(line.substr(start, end - start));
+        }
+        ++count;
+        if (end == line.size()) {
+            break;
+        }
+        start = end + 1;
+    }
+    values_.resize(count);
 }
 
-std::string
+const std::string&
 CSVRow::readAt(const size_t at) const {
     checkIndex(at);
     return (values_[at]);
@@ -80,7 +101,8 @@ CSVRow::checkIndex(const size_t at) const {
 }
 
 CSVFile::CSVFile(const std::string& filename)
-    : filename_(filename), fs_(), cols_(0), read_msg_() {
+    : filename_(filename), fs_(), cols_(0), read_msg_(), line_(),
+      auto_flush_(true), at_eof_(false) {
 }
 
 CSVFile::~CSVFile() {
@@ -103,6 +125,34 @@ CSVFile::flush() const {
     fs_->flush();
 }
 
+void
+CSVFile::sync() const {
+    flush();
+    if (!fs_->good()) {
+        fs_->clear();
+        bundy_throw(CSVFileError, "failed to flush the file '"
+                  << filename_ << "'");
+    }
+
+    // The file stream doesn't expose its descriptor, so open the file once
+    // more. Synchronizing any descriptor of the file writes out all its
+    // data held by the operating system.
+    int fd = ::open(filename_.c_str(), O_RDONLY);
+    if (fd < 0) {
+        bundy_throw(CSVFileError, "unable to open the file '" << filename_
+                  << "' to synchronize it with the disk: "
+                  << strerror(errno));
+    }
+    int status = ::fsync(fd);
+    int fsync_errno = errno;
+    ::close(fd);
+    if (status != 0) {
+        bundy_throw(CSVFileError, "failed to synchronize the file '"
+                  << filename_ << "' with the disk: "
+                  << strerror(fsync_errno));
+    }
+}
+
 void
 CSVFile::addColumn(const std::string& col_name) {
     // It is not allowed to add a new column when file is open.
@@ -140,15 +190,24 @@ CSVFile::append(const CSVRow& row) const {
     /// content. If we come up with the scenarios when read and write is
     /// needed at the same time, we may revisit this: perhaps remember the
     /// old pointer. Also, for safety, we call both functions so as we are
-    /// sure that both pointers are moved.
-    fs_->seekp(0, std::ios_base::end);
-    fs_->seekg(0, std::ios_base::end);
-    fs_->clear();
+    /// sure that both pointers are moved. Seeking flushes the stream, so
+    /// it is skipped when the previous operation has been an append and the
+    /// pointers are already at the EOF.
+    if (!at_eof_) {
+        fs_->seekp(0, std::ios_base::end);
+        fs_->seekg(0, std::ios_base::end);
+        fs_->clear();
+        at_eof_ = true;
+    }
 
     std::string text = row.render();
-    *fs_ << text << std::endl;
+    *fs_ << text << '\n';
+    if (auto_flush_) {
+        fs_->flush();
+    }
     if (!fs_->good()) {
         fs_->clear();
+        at_eof_ = false;
         bundy_throw(CSVFileError, "failed to write CSV row '"
                   << text << "' to the file '" << filename_ << "'");
     }
@@ -229,8 +288,10 @@ CSVFile::next(CSVRow& row, const bool skip_validation) {
         return (false);
     }
 
-    // Get exactly one line of the file.
-    std::string line;
+    // Get exactly one line of the file. The line buffer is reused for all
+    // rows read from the file.
+    std::string& line = line_;
+    at_eof_ = false;
     std::getline(*fs_, line);
     // If we got empty line because we reached the end of file
     // return an empty row.
@@ -261,6 +322,7 @@ CSVFile::open() {
     } else {
         // Try to open existing file, holding some data.
         fs_.reset(new std::fstream(filename_.c_str()));
+        at_eof_ = false;
 
         // Catch exceptions so as we can close the file if error occurs.
         try {
@@ -306,6 +368,15 @@ CSVFile::open() {
     }
 }
 
+CSVRow
+CSVFile::getHeader() const {
+    CSVRow header(getColumnCount());
+    for (size_t i = 0; i < getColumnCount(); ++i) {
+        header.writeAt(i, getColumnName(i));
+    }
+    return (header);
+}
+
 void
 CSVFile::recreate() {
     // There is no sense creating a file if we don't specify columns for it.
@@ -324,11 +395,8 @@ CSVFile::recreate() {
     }
     // Opened successfuly. Write a header to it.
     try {
-        CSVRow header(getColumnCount());
-        for (int i = 0; i < getColumnCount(); ++i) {
-            header.writeAt(i, getColumnName(i));
-        }
-        *fs_ << header << std::endl;
+        *fs_ << getHeader() << std::endl;
+        at_eof_ = true;
 
     } catch (const std::exception& ex) {
         close();
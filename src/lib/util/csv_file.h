@@ -110,12 +110,13 @@ public:
     /// @param at Index of the value in the container. The values are indexed
     /// from 0, where 0 corresponds to the left-most value in the CSV file row.
     ///
-    /// @return Value at specified index in the text form.
+    /// @return Value at specified index in the text form. The reference
+    /// remains valid until the row is parsed again or destroyed.
     ///
     /// @throw CSVFileError if the index is out of range. The number of elements
     /// being held by the container can be obtained using
     /// @c CSVRow::getValuesCount.
-    std::string readAt(const size_t at) const;
+    const std::string& readAt(const size_t at) const;
 
     /// @brief Retrieves a value from the internal container.
     ///
@@ -135,7 +136,7 @@ public:
     T readAndConvertAt(const size_t at) const {
         T cast_value;
         try {
-            cast_value = boost::lexical_cast<T>(readAt(at).c_str());
+            cast_value = boost::lexical_cast<T>(readAt(at));
 
         } catch (const boost::bad_lexical_cast& ex) {
             bundy_throw(CSVFileError, ex.what());
@@ -232,10 +233,8 @@ private:
 
     /// @brief Separator character specifed in the constructor.
     ///
-    /// @note Separator is held as a string object (one character long),
-    /// because the boost::is_any_of algorithm requires a string, not a
-    /// char value. If we held the separator as a char, we would need to
-    /// convert it to string on every call to @c CSVRow::parse.
+    /// @note Separator is held as a string object (one character long), so
+    /// as it can be written by @c CSVRow::render without conversion.
     std::string separator_;
 
     /// @brief Internal container holding values that belong to the row.
@@ -309,6 +308,34 @@ public:
     /// @brief Flushes a file.
     void flush() const;
 
+    /// @brief Flushes a file and forces its contents to the disk.
+    ///
+    /// Unlike @c flush, which only hands the buffered rows to the operating
+    /// system, this function also waits until the operating system has
+    /// written them to the storage device. It is meant to be called once
+    /// for a batch of rows appended with the automatic flush disabled.
+    ///
+    /// @throw CSVFileError if the file is not open or if the contents of
+    /// the file could not be synchronized with the disk.
+    void sync() const;
+
+    /// @brief Enables or disables flushing the file after each row.
+    ///
+    /// By default, the file is flushed each time the row is appended. A
+    /// caller appending many rows at once may disable it and call @c flush
+    /// or @c sync when the whole batch has been appended.
+    ///
+    /// @param auto_flush A boolean value which indicates if the file should
+    /// be flushed after appending a row (true) or not (false).
+    void setAutoFlush(const bool auto_flush) {
+        auto_flush_ = auto_flush;
+    }
+
+    /// @brief Checks if the file is flushed after each appended row.
+    bool getAutoFlush() const {
+        return (auto_flush_);
+    }
+
     /// @brief Returns the number of columns in the file.
     size_t getColumnCount() const {
         return (cols_.size());
@@ -344,6 +371,11 @@ public:
     /// @throw CSVFileError if the specified index is out of range.
     std::string getColumnName(const size_t col_index) const;
 
+    /// @brief Returns the header of the file.
+    ///
+    /// @return Row holding the names of the columns.
+    CSVRow getHeader() const;
+
     /// @brief Reads next row from CSV file.
     ///
     /// This function will return the @c CSVRow object representing a
@@ -469,6 +501,17 @@ private:
 
     /// @brief Holds last error during row reading or validation.
     std::string read_msg_;
+
+    /// @brief Holds the line being read by @c next.
+    std::string line_;
+
+    /// @brief Indicates if the file is flushed after each appended row.
+    bool auto_flush_;
+
+    /// @brief Indicates if the file pointers are known to be at the EOF.
+    ///
+    /// It is set by @c append, which is a const function, hence mutable.
+    mutable bool at_eof_;
 };
 
 } // namespace bundy::util
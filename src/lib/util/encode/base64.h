@@ -44,6 +44,20 @@ namespace encode {
 /// \return A newly created string that stores base64 encoded value for binary.
 std::string encodeBase64(const std::vector<uint8_t>& binary);
 
+/// \brief Encode binary data in the base64 format into a buffer.
+///
+/// This is the same as the other version, but the text is written to the
+/// given buffer instead of a new string, for applications that build a
+/// larger text.  The buffer isn't nul-terminated.  This function never
+/// throws an exception.
+///
+/// \param binary The data to be encoded.
+/// \param len The length of the data.
+/// \param dst The buffer; it must have room for ((len + 2) / 3) * 4
+/// characters.
+/// \return The number of characters written.
+size_t encodeBase64(const uint8_t* binary, size_t len, char* dst);
+
 /// \brief Decode a text encoded in the base64 format into the original %data.
 ///
 /// The \c input argument must be a valid string represented in the base64
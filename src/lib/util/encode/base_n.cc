@@ -16,27 +16,39 @@
 #define BOOST_PFTO_WRAPPER(T) T
 #define BOOST_MAKE_PFTO_WRAPPER(t) t
 
-#include <util/encode/base32hex_from_binary.h>
 #include <util/encode/binary_from_base32hex.h>
-#include <util/encode/base16_from_binary.h>
 #include <util/encode/binary_from_base16.h>
 #include <util/encode/base32hex.h>
 #include <util/encode/base64.h>
+#include <util/encode/hex.h>
 
 #include <exceptions/exceptions.h>
 
-#include <boost/archive/iterators/base64_from_binary.hpp>
 #include <boost/archive/iterators/binary_from_base64.hpp>
 #include <boost/archive/iterators/transform_width.hpp>
 #include <boost/math/common_factor.hpp>
 
 #include <stdint.h>
+#include <algorithm>
 #include <stdexcept>
 #include <cassert>
 #include <iterator>
 #include <string>
 #include <vector>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (__GNUC__ > 4) || \
+     (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+// The SSSE3 and AVX2 code is compiled with the target attribute and is only
+// used if the running CPU supports it.
+#define BASE_N_SSSE3 1
+#define BASE_N_AVX2 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define BASE_N_NEON 1
+#include <arm_neon.h>
+#endif
+
 using namespace std;
 using namespace boost::archive::iterators;
 
@@ -54,18 +66,26 @@ class IncompleteBaseInput : public std::exception {
 } // end namespace internal
 
 // In the following anonymous namespace, we provide a generic framework
-// to encode/decode baseN format.  We use the following tools:
-// - boost base64_from_binary/binary_from_base64: provide mapping table for
-//   base64.
-//   These classes take another iterator (Base) as a template argument, and
-//   their dereference operator (operator*()) first retrieves an input value
-//   from Base via Base::operator* and converts the value using their mapping
-//   table.  The converted value is returned as their own operator*.
-// - base{32hex,16}_from_binary/binary_from_base{32hex,16}: provide mapping
-//   table for base32hex and base16.  A straightforward variation of their
-//   base64 counterparts.
-// - EncodeNormalizer/DecodeNormalizer: supplemental filter handling baseN
-//   padding characters (=)
+// to encode/decode baseN format.
+//
+// Encoding never fails, and is done by a simple table driven converter
+// (encodeTable()), optionally preceded by a vectorized one for the bulk of
+// the data (see the XXXCodec classes below).
+//
+// Decoding has a fast path of the same structure (decodeTable()), which only
+// accepts the most common form of input: a canonical encoding without any
+// spaces.  Anything else, including all invalid input, is passed to the
+// generic decoder, which handles spaces and figures out the exact error.
+// The generic decoder uses the following tools:
+// - boost binary_from_base64: provides mapping table for base64.
+//   This class takes another iterator (Base) as a template argument, and
+//   its dereference operator (operator*()) first retrieves an input value
+//   from Base via Base::operator* and converts the value using its mapping
+//   table.  The converted value is returned as its own operator*.
+// - binary_from_base{32hex,16}: provide mapping table for base32hex and
+//   base16.  A straightforward variation of their base64 counterpart.
+// - DecodeNormalizer: supplemental filter handling baseN padding
+//   characters (=)
 // - boost transform_width: an iterator framework for handling data stream
 //   per bit-group.  It takes another iterator (Base) and output/input bit
 //   numbers (BitsOut/BitsIn) template arguments.  A transform_width object
@@ -73,22 +93,10 @@ class IncompleteBaseInput : public std::exception {
 //   bits via its dereference operator (operator*()).  It builds the stream
 //   by internally iterating over the Base object via Base::operator++ and
 //   Base::operator*, using the least BitsIn bits of the result of
-//   Base::operator*.  In our usage BitsIn for encoding and BitsOut for
-//   decoding are always 8 (# of bits for one byte).
+//   Base::operator*.  In our usage BitsOut is always 8 (# of bits for one
+//   byte).
 //
-// Its dereference operator
-//   retrieves BitsIn bits from the result of "*Base" (if necessary it
-//   internally calls ++Base) 
-//
-// A conceptual description of how the encoding and decoding work is as
-// follows:
-// Encoding:
-//   input binary data => Normalizer (append sufficient number of 0 bits)
-//                     => transform_width (extract bit groups from the original
-//                                         stream)
-//                     => baseXX_from_binary (convert each bit group to an
-//                                            encoded byte using the mapping)
-// Decoding:
+// A conceptual description of how the generic decoding works is as follows:
 //   input baseXX text => Normalizer (convert '='s to the encoded characters
 //                                    corresponding to 0, e.g. 'A's in base64)
 //                     => binary_from_baseXX (convert each encoded byte into
@@ -102,61 +110,7 @@ class IncompleteBaseInput : public std::exception {
 namespace {
 // Common constants used for all baseN encoding.
 const char BASE_PADDING_CHAR = '=';
-const uint8_t BINARY_ZERO_CODE = 0;
   
-// EncodeNormalizer is an input iterator intended to be used as a filter
-// between the binary stream and baseXX_from_binary translator (via
-// transform_width).  An EncodeNormalizer object is configured with two
-// iterators (base and base_end), specifying the head and end of the input
-// stream.  It internally iterators over the original stream, and return
-// each byte of the stream intact via its dereference operator until it
-// reaches the end of the stream.  After that the EncodeNormalizer object
-// will return 0 no matter how many times it is subsequently incremented.
-// This is necessary because the input binary stream may not contain
-// sufficient bits for a full encoded text while baseXX_from_binary expects
-// a sufficient length of input.
-// Note: this class is intended to be used within this implementation file,
-// and assumes "base < base_end" on construction without validating the
-// arguments.  The behavior is undefined if this assumption doesn't hold.
-class EncodeNormalizer : public iterator<input_iterator_tag, uint8_t> {
-public:
-    EncodeNormalizer(const vector<uint8_t>::const_iterator& base,
-                     const vector<uint8_t>::const_iterator& base_end) :
-        base_(base), base_end_(base_end), in_pad_(false)
-    {}
-    EncodeNormalizer& operator++() { // prefix version
-        increment();
-        return (*this);
-    }
-    EncodeNormalizer operator++(int) { // postfix version
-        const EncodeNormalizer copy = *this;
-        increment();
-        return (copy);
-    }
-    const uint8_t& operator*() const {
-        if (in_pad_) {
-            return (BINARY_ZERO_CODE);
-        } else {
-            return (*base_);
-        }
-    }
-    bool operator==(const EncodeNormalizer& other) const {
-        return (base_ == other.base_);
-    }
-private:
-    void increment() {
-        if (!in_pad_) {
-            ++base_;
-        }
-        if (base_ == base_end_) {
-            in_pad_ = true;
-        }
-    }
-    vector<uint8_t>::const_iterator base_;
-    const vector<uint8_t>::const_iterator base_end_;
-    bool in_pad_;
-};
-
 // DecodeNormalizer is an input iterator intended to be used as a filter
 // between the encoded baseX stream and binary_from_baseXX.
 // A DecodeNormalizer object is configured with three string iterators
@@ -257,20 +211,473 @@ private:
     size_t* char_count_;
 };
 
+// encodeTable() converts binary data in [src, end) into the encoded text
+// stored from dst, using the given mapping from BitsPerChunk-bit values to
+// the encoded characters.  The last character contains 0 bits for a
+// partial chunk; padding characters are not added.
+template <int BitsPerChunk>
+void
+encodeTable(const uint8_t* src, const uint8_t* end, const char* encode_map,
+            char* dst)
+{
+    const uint32_t mask = (1 << BitsPerChunk) - 1;
+    uint32_t bits = 0;
+    int nbits = 0;
+    for (; src != end; ++src) {
+        bits = (bits << 8) | *src;
+        nbits += 8;
+        while (nbits >= BitsPerChunk) {
+            nbits -= BitsPerChunk;
+            *dst++ = encode_map[(bits >> nbits) & mask];
+        }
+    }
+    if (nbits > 0) {
+        *dst = encode_map[(bits << (BitsPerChunk - nbits)) & mask];
+    }
+}
+
+// decodeTable() is the reverse of encodeTable(), using the mapping from the
+// (7-bit) encoded characters to their values, -1 for invalid ones.  It
+// returns false if [src, end) contains an invalid character or if the
+// remaining bits of the last character aren't all 0, i.e., the text isn't
+// the canonical encoding.
+template <int BitsPerChunk>
+bool
+decodeTable(const char* src, const char* end, const signed char* decode_map,
+            uint8_t* dst)
+{
+    uint32_t bits = 0;
+    int nbits = 0;
+    for (; src != end; ++src) {
+        const uint8_t ch = *src;
+        const int value = (ch < 0x80) ? decode_map[ch] : -1;
+        if (value < 0) {
+            return (false);
+        }
+        bits = (bits << BitsPerChunk) | value;
+        nbits += BitsPerChunk;
+        if (nbits >= 8) {
+            nbits -= 8;
+            *dst++ = static_cast<uint8_t>(bits >> nbits);
+        }
+    }
+    return ((bits & ((1 << nbits) - 1)) == 0);
+}
+
+// Vectorized base64 codec.  Each function converts as much of the data
+// from src as it can in whole vectors, and advances src and dst to the
+// rest (each vector covers whole groups of 3 bytes and 4 characters, so
+// the rest can be converted by encodeTable() or decodeTable()).  The
+// decoders return false if they find an invalid character.  They may
+// write a few garbage bytes after the converted part, so they need some
+// more input in addition to each vector, which ensures their output buffer
+// extends beyond them.
+//
+// The SSSE3/AVX2 versions use the well known pshufb technique by Wojciech
+// Mula: the characters are classified by their higher and lower 4 bits
+// with table lookups, which both validates them and gives the offset to
+// their values, and the 6-bit values are then packed with multiplications.
+// The NEON version is more straightforward thanks to its interleaving load
+// and store, and its 64-byte table lookup.
+#ifdef BASE_N_SSSE3
+// Convert 6-bit values in bytes into base64 characters: 0-25 are offset by
+// 'A', 26-51 by 'a' - 26, and other ranges are distinguished by saturated
+// subtraction.
+__attribute__((target("ssse3"))) inline __m128i
+toBase64SSSE3(__m128i values) {
+    const __m128i offset_map = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+        '/' - 63, 'A', 0, 0);
+    __m128i index = _mm_subs_epu8(values, _mm_set1_epi8(51));
+    index = _mm_or_si128(index,
+                         _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26),
+                                                      values),
+                                       _mm_set1_epi8(13)));
+    return (_mm_add_epi8(values, _mm_shuffle_epi8(offset_map, index)));
+}
+
+// Split each 3 bytes of the lower 12 bytes into 4 6-bit values in bytes.
+__attribute__((target("ssse3"))) inline __m128i
+splitBase64SSSE3(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4,
+                                            7, 6, 8, 7, 10, 9, 11, 10));
+    const __m128i hi = _mm_mulhi_epu16(
+        _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)),
+        _mm_set1_epi32(0x04000040));
+    const __m128i lo = _mm_mullo_epi16(
+        _mm_and_si128(in, _mm_set1_epi32(0x003f03f0)),
+        _mm_set1_epi32(0x01000010));
+    return (_mm_or_si128(hi, lo));
+}
+
+__attribute__((target("ssse3"))) void
+encodeBase64SSSE3(const uint8_t*& src, const uint8_t* end, char*& dst) {
+    // Each vector loads 16 bytes, 12 of which are encoded.
+    for (; end - src >= 16; src += 12, dst += 16) {
+        const __m128i in =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),
+                         toBase64SSSE3(splitBase64SSSE3(in)));
+    }
+}
+
+// Lookup tables to classify characters by their lower and higher 4 bits:
+// a character is invalid iff the results for its two halves have a common
+// bit.  The offset to the value of a character is determined by the higher
+// bits, except for '/', which is distinguished from '+' separately.
+#define BASE64_CLASSIFY_LO \
+    0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, \
+    0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a
+#define BASE64_CLASSIFY_HI \
+    0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, \
+    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10
+#define BASE64_OFFSETS \
+    0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0
+
+__attribute__((target("ssse3"))) bool
+decodeBase64SSSE3(const char*& src, const char* end, uint8_t*& dst) {
+    const __m128i classify_lo = _mm_setr_epi8(BASE64_CLASSIFY_LO);
+    const __m128i classify_hi = _mm_setr_epi8(BASE64_CLASSIFY_HI);
+    const __m128i offsets = _mm_setr_epi8(BASE64_OFFSETS);
+    const __m128i nibble_mask = _mm_set1_epi8(0x0f);
+    // Each vector decodes 16 characters into 12 bytes, but stores 16 bytes.
+    // 8 more characters ensure the output buffer has the extra 4 bytes.
+    for (; end - src >= 16 + 8; src += 16, dst += 12) {
+        const __m128i in =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        const __m128i hi_nibbles =
+            _mm_and_si128(_mm_srli_epi32(in, 4), nibble_mask);
+        const __m128i lo_nibbles = _mm_and_si128(in, nibble_mask);
+        const __m128i invalid =
+            _mm_and_si128(_mm_shuffle_epi8(classify_lo, lo_nibbles),
+                          _mm_shuffle_epi8(classify_hi, hi_nibbles));
+        if (_mm_movemask_epi8(_mm_cmpgt_epi8(invalid,
+                                             _mm_setzero_si128())) != 0) {
+            return (false);
+        }
+        const __m128i is_slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+        const __m128i values =
+            _mm_add_epi8(in, _mm_shuffle_epi8(offsets,
+                                              _mm_add_epi8(is_slash,
+                                                           hi_nibbles)));
+        // Pack 4 6-bit values into 3 bytes in each 32 bits (in the reverse
+        // order), and then put the bytes together.
+        const __m128i packed =
+            _mm_madd_epi16(_mm_maddubs_epi16(values,
+                                             _mm_set1_epi32(0x01400140)),
+                           _mm_set1_epi32(0x00011000));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),
+                         _mm_shuffle_epi8(packed,
+                                          _mm_setr_epi8(2, 1, 0, 6, 5, 4,
+                                                        10, 9, 8, 14, 13, 12,
+                                                        -1, -1, -1, -1)));
+    }
+    return (true);
+}
+#endif
+
+#ifdef BASE_N_AVX2
+// The AVX2 versions are the same as the SSSE3 ones, just with two 16-byte
+// lanes in parallel.  Unlike the name comparison code they are called
+// with enough data to be worth it, so they are tried first, and leave the
+// rest to the SSSE3 versions.
+__attribute__((target("avx2"))) inline __m256i
+toBase64AVX2(__m256i values) {
+    const __m256i offset_map = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+        '/' - 63, 'A', 0, 0));
+    __m256i index = _mm256_subs_epu8(values, _mm256_set1_epi8(51));
+    index = _mm256_or_si256(
+        index, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26),
+                                                  values),
+                                _mm256_set1_epi8(13)));
+    return (_mm256_add_epi8(values, _mm256_shuffle_epi8(offset_map, index)));
+}
+
+__attribute__((target("avx2"))) void
+encodeBase64AVX2(const uint8_t*& src, const uint8_t* end, char*& dst) {
+    const __m256i split_shuffle = _mm256_broadcastsi128_si256(
+        _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+    // Each lane loads 16 bytes, 12 of which are encoded, and the upper
+    // lane starts at the 12th byte.
+    for (; end - src >= 12 + 16; src += 24, dst += 32) {
+        __m256i in = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(src))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 12)), 1);
+        in = _mm256_shuffle_epi8(in, split_shuffle);
+        const __m256i hi = _mm256_mulhi_epu16(
+            _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)),
+            _mm256_set1_epi32(0x04000040));
+        const __m256i lo = _mm256_mullo_epi16(
+            _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)),
+            _mm256_set1_epi32(0x01000010));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst),
+                            toBase64AVX2(_mm256_or_si256(hi, lo)));
+    }
+    // See compareAVX2() of the DNS name code: leave the AVX state before
+    // going on to the SSE code.
+    _mm256_zeroupper();
+}
+
+__attribute__((target("avx2"))) bool
+decodeBase64AVX2(const char*& src, const char* end, uint8_t*& dst) {
+    const __m256i classify_lo =
+        _mm256_broadcastsi128_si256(_mm_setr_epi8(BASE64_CLASSIFY_LO));
+    const __m256i classify_hi =
+        _mm256_broadcastsi128_si256(_mm_setr_epi8(BASE64_CLASSIFY_HI));
+    const __m256i offsets =
+        _mm256_broadcastsi128_si256(_mm_setr_epi8(BASE64_OFFSETS));
+    const __m256i pack_shuffle = _mm256_broadcastsi128_si256(
+        _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                      -1, -1, -1, -1));
+    const __m256i nibble_mask = _mm256_set1_epi8(0x0f);
+    bool valid = true;
+    // Each vector decodes 32 characters into 24 bytes, but stores 32 bytes.
+    // 12 more characters ensure the output buffer has the extra 8 bytes.
+    for (; end - src >= 32 + 12; src += 32, dst += 24) {
+        const __m256i in =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+        const __m256i hi_nibbles =
+            _mm256_and_si256(_mm256_srli_epi32(in, 4), nibble_mask);
+        const __m256i lo_nibbles = _mm256_and_si256(in, nibble_mask);
+        const __m256i invalid =
+            _mm256_and_si256(_mm256_shuffle_epi8(classify_lo, lo_nibbles),
+                             _mm256_shuffle_epi8(classify_hi, hi_nibbles));
+        if (_mm256_movemask_epi8(
+                _mm256_cmpgt_epi8(invalid, _mm256_setzero_si256())) != 0) {
+            valid = false;
+            break;
+        }
+        const __m256i is_slash =
+            _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/'));
+        const __m256i values =
+            _mm256_add_epi8(in,
+                            _mm256_shuffle_epi8(offsets,
+                                                _mm256_add_epi8(is_slash,
+                                                                hi_nibbles)));
+        const __m256i packed =
+            _mm256_madd_epi16(
+                _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140)),
+                _mm256_set1_epi32(0x00011000));
+        // Move the 12 bytes of the upper lane next to the lower ones.
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(dst),
+            _mm256_permutevar8x32_epi32(
+                _mm256_shuffle_epi8(packed, pack_shuffle),
+                _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7)));
+    }
+    _mm256_zeroupper();
+    return (valid);
+}
+#endif
+
+#ifdef BASE_N_SSSE3
+bool
+detectSSSE3() {
+    __builtin_cpu_init();
+    return (__builtin_cpu_supports("ssse3"));
+}
+
+bool
+detectAVX2() {
+    __builtin_cpu_init();
+    return (__builtin_cpu_supports("avx2"));
+}
+
+// These are dynamically initialized, so they could still be false while
+// other static objects are being initialized.  That's okay as it only means
+// the table driven versions are used until then.
+const bool use_ssse3 = detectSSSE3();
+const bool use_avx2 = detectAVX2();
+#endif
+
+#ifdef BASE_N_NEON
+inline uint8x16x4_t
+loadTable64(const uint8_t* table) {
+    uint8x16x4_t result;
+    result.val[0] = vld1q_u8(table);
+    result.val[1] = vld1q_u8(table + 16);
+    result.val[2] = vld1q_u8(table + 32);
+    result.val[3] = vld1q_u8(table + 48);
+    return (result);
+}
+
+void
+encodeBase64NEON(const uint8_t*& src, const uint8_t* end, char*& dst,
+                 const char* encode_map_data)
+{
+    const uint8x16x4_t encode_map =
+        loadTable64(reinterpret_cast<const uint8_t*>(encode_map_data));
+    const uint8x16_t mask = vdupq_n_u8(0x3f);
+    // vld3q_u8 splits 48 bytes into the 1st, 2nd and 3rd bytes of the
+    // groups, and vst4q_u8 stores the 4 characters of the groups in turn.
+    for (; end - src >= 48; src += 48, dst += 64) {
+        const uint8x16x3_t in = vld3q_u8(src);
+        uint8x16x4_t out;
+        out.val[0] = vshrq_n_u8(in.val[0], 2);
+        out.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(in.val[0], 4),
+                                       vshrq_n_u8(in.val[1], 4)), mask);
+        out.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(in.val[1], 2),
+                                       vshrq_n_u8(in.val[2], 6)), mask);
+        out.val[3] = vandq_u8(in.val[2], mask);
+        for (int i = 0; i < 4; ++i) {
+            out.val[i] = vqtbl4q_u8(encode_map, out.val[i]);
+        }
+        vst4q_u8(reinterpret_cast<uint8_t*>(dst), out);
+    }
+}
+
+bool
+decodeBase64NEON(const char*& src, const char* end, uint8_t*& dst,
+                 const signed char* decode_map)
+{
+    // The decode map is split into 2 tables for 0x00-0x3f and 0x40-0x7f.
+    // Out of range indices result in 0 for vqtbl4q_u8 and keep the original
+    // value for vqtbx4q_u8, so characters of 0x80 or larger are converted
+    // into 0 and are detected separately.
+    const uint8_t* const table = reinterpret_cast<const uint8_t*>(decode_map);
+    const uint8x16x4_t lo_table = loadTable64(table);
+    const uint8x16x4_t hi_table = loadTable64(table + 64);
+    const uint8x16_t hi_offset = vdupq_n_u8(0x40);
+    for (; end - src >= 64; src += 64, dst += 48) {
+        const uint8x16x4_t in =
+            vld4q_u8(reinterpret_cast<const uint8_t*>(src));
+        uint8x16x4_t values;
+        uint8x16_t invalid = vdupq_n_u8(0);
+        for (int i = 0; i < 4; ++i) {
+            values.val[i] = vqtbx4q_u8(vqtbl4q_u8(lo_table, in.val[i]),
+                                       hi_table,
+                                       vsubq_u8(in.val[i], hi_offset));
+            // Invalid characters are mapped to 0xff; either way they have
+            // the highest bit set here.
+            invalid = vorrq_u8(invalid, vorrq_u8(values.val[i], in.val[i]));
+        }
+        if (vmaxvq_u8(invalid) >= 0x80) {
+            return (false);
+        }
+        uint8x16x3_t out;
+        out.val[0] = vorrq_u8(vshlq_n_u8(values.val[0], 2),
+                              vshrq_n_u8(values.val[1], 4));
+        out.val[1] = vorrq_u8(vshlq_n_u8(values.val[1], 4),
+                              vshrq_n_u8(values.val[2], 2));
+        out.val[2] = vorrq_u8(vshlq_n_u8(values.val[2], 6), values.val[3]);
+        vst3q_u8(dst, out);
+    }
+    return (true);
+}
+#endif
+
+// Codec classes: the mapping tables of each encoding, and the bulk version
+// of its encoder and decoder, which convert the beginning part of the data
+// (see the vectorized codec above) and are no-op if they are not vectorized.
+struct NoBulkCodec {
+    static void encodeBulk(const uint8_t*&, const uint8_t*, char*&) {}
+    static bool decodeBulk(const char*&, const char*, uint8_t*&) {
+        return (true);
+    }
+};
+
+struct Base64Codec {
+    static const char* const ENCODE_MAP;
+    static const signed char DECODE_MAP[0x80];
+
+    static void encodeBulk(const uint8_t*& src, const uint8_t* end,
+                           char*& dst)
+    {
+#if defined(BASE_N_SSSE3)
+        if (use_avx2) {
+            encodeBase64AVX2(src, end, dst);
+        }
+        if (use_ssse3) {
+            encodeBase64SSSE3(src, end, dst);
+        }
+#elif defined(BASE_N_NEON)
+        encodeBase64NEON(src, end, dst, ENCODE_MAP);
+#else
+        (void)src; (void)end; (void)dst;
+#endif
+    }
+    static bool decodeBulk(const char*& src, const char* end, uint8_t*& dst) {
+#if defined(BASE_N_SSSE3)
+        if (use_avx2 && !decodeBase64AVX2(src, end, dst)) {
+            return (false);
+        }
+        return (!use_ssse3 || decodeBase64SSSE3(src, end, dst));
+#elif defined(BASE_N_NEON)
+        return (decodeBase64NEON(src, end, dst, DECODE_MAP));
+#else
+        (void)src; (void)end; (void)dst;
+        return (true);
+#endif
+    }
+};
+
+const char* const Base64Codec::ENCODE_MAP =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+const signed char Base64Codec::DECODE_MAP[0x80] = {
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, // 00-0f
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, // 10-1f
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,62,-1,-1,-1,63, // 20-2f
+    52,53,54,55,56,57,58,59,60,61,-1,-1,-1,-1,-1,-1, // 30-3f
+    -1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9,10,11,12,13,14, // 40-4f
+    15,16,17,18,19,20,21,22,23,24,25,-1,-1,-1,-1,-1, // 50-5f
+    -1,26,27,28,29,30,31,32,33,34,35,36,37,38,39,40, // 60-6f
+    41,42,43,44,45,46,47,48,49,50,51,-1,-1,-1,-1,-1  // 70-7f
+};
+
+struct Base32HexCodec : public NoBulkCodec {
+    static const char* const ENCODE_MAP;
+    static const signed char DECODE_MAP[0x80];
+};
+
+const char* const Base32HexCodec::ENCODE_MAP =
+    "0123456789ABCDEFGHIJKLMNOPQRSTUV";
+const signed char Base32HexCodec::DECODE_MAP[0x80] = {
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, // 00-0f
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, // 10-1f
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, // 20-2f
+     0, 1, 2, 3, 4, 5, 6, 7, 8, 9,-1,-1,-1,-1,-1,-1, // 30-3f
+    -1,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24, // 40-4f
+    25,26,27,28,29,30,31,-1,-1,-1,-1,-1,-1,-1,-1,-1, // 50-5f
+    -1,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24, // 60-6f
+    25,26,27,28,29,30,31,-1,-1,-1,-1,-1,-1,-1,-1,-1  // 70-7f
+};
+
+struct Base16Codec : public NoBulkCodec {
+    static const char* const ENCODE_MAP;
+    static const signed char DECODE_MAP[0x80];
+};
+
+const char* const Base16Codec::ENCODE_MAP = "0123456789ABCDEF";
+const signed char Base16Codec::DECODE_MAP[0x80] = {
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, // 00-0f
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, // 10-1f
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, // 20-2f
+     0, 1, 2, 3, 4, 5, 6, 7, 8, 9,-1,-1,-1,-1,-1,-1, // 30-3f
+    -1,10,11,12,13,14,15,-1,-1,-1,-1,-1,-1,-1,-1,-1, // 40-4f
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, // 50-5f
+    -1,10,11,12,13,14,15,-1,-1,-1,-1,-1,-1,-1,-1,-1, // 60-6f
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1  // 70-7f
+};
+
 // BitsPerChunk: number of bits to be converted using the baseN mapping table.
 //               e.g. 6 for base64.
 // BaseZeroCode: the byte character that represents a value of 0 in
 //               the corresponding encoding.  e.g. 'A' for base64.
-// Encoder: baseX_from_binary<transform_width<EncodeNormalizer,
-//                                            BitsPerChunk, 8> >
 // Decoder: transform_width<binary_from_baseX<DecodeNormalizer>,
 //                          8, BitsPerChunk>
+// Codec: XXXCodec above for the encoding.
 template <int BitsPerChunk, char BaseZeroCode,
-          typename Encoder, typename Decoder>
+          typename Decoder, typename Codec>
 struct BaseNTransformer {
     static string encode(const vector<uint8_t>& binary);
+    static size_t encode(const uint8_t* binary, size_t len, char* dst);
     static void decode(const char* algorithm,
                        const string& base64, vector<uint8_t>& result);
+    static bool decodeFast(const string& input, vector<uint8_t>& result);
 
     // BITS_PER_GROUP is the number of bits for the smallest possible (non
     // empty) bit string that can be converted to a valid baseN encoded text
@@ -294,9 +701,9 @@ struct BaseNTransformer {
 }; 
 
 template <int BitsPerChunk, char BaseZeroCode,
-          typename Encoder, typename Decoder>
+          typename Decoder, typename Codec>
 string
-BaseNTransformer<BitsPerChunk, BaseZeroCode, Encoder, Decoder>::encode(
+BaseNTransformer<BitsPerChunk, BaseZeroCode, Decoder, Codec>::encode(
     const vector<uint8_t>& binary)
 {
     // calculate the resulting length.
@@ -306,23 +713,85 @@ BaseNTransformer<BitsPerChunk, BaseZeroCode, Encoder, Decoder>::encode(
     }
     const size_t len = bits / BitsPerChunk;
 
-    string result;
-    result.reserve(len);
-    result.assign(Encoder(EncodeNormalizer(binary.begin(), binary.end())),
-                  Encoder(EncodeNormalizer(binary.end(), binary.end())));
-    assert(len >= result.length());
-    result.append(len - result.length(), BASE_PADDING_CHAR);
+    string result(len, BASE_PADDING_CHAR);
+    if (!binary.empty()) {
+        encode(&binary[0], binary.size(), &result[0]);
+    }
     return (result);
 }
 
 template <int BitsPerChunk, char BaseZeroCode,
-          typename Encoder, typename Decoder>
+          typename Decoder, typename Codec>
+size_t
+BaseNTransformer<BitsPerChunk, BaseZeroCode, Decoder, Codec>::encode(
+    const uint8_t* binary, size_t len, char* dst)
+{
+    size_t bits = len * 8;
+    if (bits % BITS_PER_GROUP > 0) {
+        bits += (BITS_PER_GROUP - (bits % BITS_PER_GROUP));
+    }
+    const size_t result_len = bits / BitsPerChunk;
+
+    // The characters not overridden by the encoded data are padding.
+    std::fill(dst, dst + result_len, BASE_PADDING_CHAR);
+    const uint8_t* src = binary;
+    const uint8_t* const end = src + len;
+    Codec::encodeBulk(src, end, dst);
+    encodeTable<BitsPerChunk>(src, end, Codec::ENCODE_MAP, dst);
+    return (result_len);
+}
+
+// The fast path of decode(): it decodes input into result and returns true
+// if input is a canonical encoding without spaces; otherwise it returns false
+// (possibly modifying result).
+template <int BitsPerChunk, char BaseZeroCode,
+          typename Decoder, typename Codec>
+bool
+BaseNTransformer<BitsPerChunk, BaseZeroCode, Decoder, Codec>::decodeFast(
+    const string& input,
+    vector<uint8_t>& result)
+{
+    if (input.size() % (BITS_PER_GROUP / BitsPerChunk) != 0) {
+        return (false);
+    }
+    const char* src = input.data();
+    const char* end = src + input.size();
+    size_t padchars = 0;
+    while (end != src && *(end - 1) == BASE_PADDING_CHAR) {
+        --end;
+        ++padchars;
+    }
+    if (padchars > MAX_PADDING_CHARS) {
+        return (false);
+    }
+    // The characters must be the shortest sequence for the bytes; otherwise
+    // a padding byte would contain a full set of encoded bits.
+    const size_t len = (end - src) * BitsPerChunk / 8;
+    if ((len * 8 + BitsPerChunk - 1) / BitsPerChunk !=
+        static_cast<size_t>(end - src)) {
+        return (false);
+    }
+    result.resize(len);
+    if (len == 0) {
+        return (true);
+    }
+    uint8_t* dst = &result[0];
+    return (Codec::decodeBulk(src, end, dst) &&
+            decodeTable<BitsPerChunk>(src, end, Codec::DECODE_MAP, dst));
+}
+
+template <int BitsPerChunk, char BaseZeroCode,
+          typename Decoder, typename Codec>
 void
-BaseNTransformer<BitsPerChunk, BaseZeroCode, Encoder, Decoder>::decode(
+BaseNTransformer<BitsPerChunk, BaseZeroCode, Decoder, Codec>::decode(
     const char* const algorithm,
     const string& input,
     vector<uint8_t>& result)
 {
+    if (decodeFast(input, result)) {
+        return;
+    }
+
     // enumerate the number of trailing padding characters (=), ignoring
     // white spaces.  since baseN_from_binary doesn't accept padding,
     // we handle it explicitly.
@@ -418,32 +887,25 @@ BaseNTransformer<BitsPerChunk, BaseZeroCode, Encoder, Decoder>::decode(
 // Instantiation for BASE-64
 //
 typedef
-base64_from_binary<transform_width<EncodeNormalizer, 6, 8> > base64_encoder;
-typedef
 transform_width<binary_from_base64<DecodeNormalizer>, 8, 6> base64_decoder;
-typedef BaseNTransformer<6, 'A', base64_encoder, base64_decoder>
+typedef BaseNTransformer<6, 'A', base64_decoder, Base64Codec>
 Base64Transformer;
 
 //
 // Instantiation for BASE-32HEX
 //
 typedef
-base32hex_from_binary<transform_width<EncodeNormalizer, 5, 8> >
-base32hex_encoder;
-typedef
 transform_width<binary_from_base32hex<DecodeNormalizer>, 8, 5>
 base32hex_decoder;
-typedef BaseNTransformer<5, '0', base32hex_encoder, base32hex_decoder>
+typedef BaseNTransformer<5, '0', base32hex_decoder, Base32HexCodec>
 Base32HexTransformer;
 
 //
 // Instantiation for BASE-16 (HEX)
 //
 typedef
-base16_from_binary<transform_width<EncodeNormalizer, 4, 8> > base16_encoder;
-typedef
 transform_width<binary_from_base16<DecodeNormalizer>, 8, 4> base16_decoder;
-typedef BaseNTransformer<4, '0', base16_encoder, base16_decoder>
+typedef BaseNTransformer<4, '0', base16_decoder, Base16Codec>
 Base16Transformer;
 }
 
@@ -452,6 +914,11 @@ encodeBase64(const vector<uint8_t>& binary) {
     return (Base64Transformer::encode(binary));
 }
 
+size_t
+encodeBase64(const uint8_t* binary, size_t len, char* dst) {
+    return (Base64Transformer::encode(binary, len, dst));
+}
+
 void
 decodeBase64(const string& input, vector<uint8_t>& result) {
     Base64Transformer::decode("base64", input, result);
@@ -472,6 +939,11 @@ encodeHex(const vector<uint8_t>& binary) {
     return (Base16Transformer::encode(binary));
 }
 
+size_t
+encodeHex(const uint8_t* binary, size_t len, char* dst) {
+    return (Base16Transformer::encode(binary, len, dst));
+}
+
 void
 decodeHex(const string& input, vector<uint8_t>& result) {
     Base16Transformer::decode("base16", input, result);
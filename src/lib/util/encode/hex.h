@@ -41,6 +41,17 @@ namespace encode {
 /// binary.
 std::string encodeHex(const std::vector<uint8_t>& binary);
 
+/// \brief Encode binary data in the base16 ('hex') format into a buffer.
+///
+/// See the buffer version of \c encodeBase64; the buffer must have room
+/// for len * 2 characters.
+///
+/// \param binary The data to be encoded.
+/// \param len The length of the data.
+/// \param dst The buffer.
+/// \return The number of characters written.
+size_t encodeHex(const uint8_t* binary, size_t len, char* dst);
+
 /// \brief Decode a text encoded in the base16 ('hex') format into the
 /// original %data.
 ///
@@ -0,0 +1,165 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef FREE_LIST_H
+#define FREE_LIST_H
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace bundy {
+namespace util {
+
+/// \brief Per-thread list of unused objects of a class.
+///
+/// Objects which are expensive to build, typically because they own
+/// buffers, and which are used for a short time at a high rate, can be
+/// put in the list of the current thread when they are no longer used
+/// rather than destroyed, and taken from it the next time one is needed.
+/// The class is responsible for resetting the objects.
+///
+/// Up to \c MaxFree objects are kept per thread, the others are deleted.
+/// The objects of a thread are deleted when it ends, so the objects must
+/// not be put in the list by a thread which has ended.
+template <typename T, size_t MaxFree = 256>
+class FreeList {
+public:
+    /// \brief Takes an object from the list of the current thread.
+    ///
+    /// \return The object, NULL if there is none.
+    static T* get() {
+        std::vector<T*>& objects = getObjects().objects;
+        if (objects.empty()) {
+            return (NULL);
+        }
+        T* const object = objects.back();
+        objects.pop_back();
+        return (object);
+    }
+
+    /// \brief Puts an object in the list of the current thread.
+    ///
+    /// The object is deleted if the list is full.
+    ///
+    /// \param object The object, allocated with new.
+    static void put(T* object) {
+        std::vector<T*>& objects = getObjects().objects;
+        if (objects.size() < MaxFree) {
+            objects.push_back(object);
+        } else {
+            delete object;
+        }
+    }
+
+    /// \brief Returns the number of objects in the list of the current
+    /// thread.
+    static size_t getCount() {
+        return (getObjects().objects.size());
+    }
+
+private:
+    struct Objects {
+        Objects() {
+            objects.reserve(MaxFree);
+        }
+        ~Objects() {
+            for (size_t i = 0; i < objects.size(); ++i) {
+                delete objects[i];
+            }
+        }
+        std::vector<T*> objects;
+    };
+
+    static Objects& getObjects() {
+        static thread_local Objects objects;
+        return (objects);
+    }
+};
+
+/// \brief Allocation of the objects of a class from per-thread free lists.
+///
+/// A class deriving from this one has its objects allocated from a list
+/// of free memory blocks of the current thread, and their memory given
+/// back to it when they are deleted, rather than going through the
+/// general purpose allocator each time.  This is meant for the objects
+/// created and deleted at a high rate, like the state of the upstream
+/// queries of the resolver.  An object may be deleted by another thread
+/// than the one which created it; its memory then goes to the list of
+/// that thread.
+///
+/// Up to \c MaxFree blocks are kept per thread, they are freed when it
+/// ends.  Objects of derived classes of a different size are allocated
+/// with the global operators.
+template <typename T, size_t MaxFree = 256>
+class FreeListAllocated {
+public:
+    /// \brief Allocates the memory of an object.
+    ///
+    /// \throw std::bad_alloc if the memory can't be allocated.
+    static void* operator new(size_t size) {
+        if (size == sizeof(T)) {
+            std::vector<void*>& blocks = getBlocks().blocks;
+            if (!blocks.empty()) {
+                void* const block = blocks.back();
+                blocks.pop_back();
+                return (block);
+            }
+        }
+        return (::operator new(size));
+    }
+
+    /// \brief Gives back the memory of an object.
+    static void operator delete(void* block, size_t size) {
+        if (block == NULL) {
+            return;
+        }
+        if (size == sizeof(T)) {
+            std::vector<void*>& blocks = getBlocks().blocks;
+            if (blocks.size() < MaxFree) {
+                blocks.push_back(block);
+                return;
+            }
+        }
+        ::operator delete(block);
+    }
+
+    /// \brief Returns the number of free blocks of the current thread.
+    static size_t getFreeCount() {
+        return (getBlocks().blocks.size());
+    }
+
+private:
+    struct Blocks {
+        Blocks() {
+            blocks.reserve(MaxFree);
+        }
+        ~Blocks() {
+            for (size_t i = 0; i < blocks.size(); ++i) {
+                ::operator delete(blocks[i]);
+            }
+        }
+        std::vector<void*> blocks;
+    };
+
+    static Blocks& getBlocks() {
+        static thread_local Blocks blocks;
+        return (blocks);
+    }
+};
+
+} // namespace util
+} // namespace bundy
+
+#endif // FREE_LIST_H
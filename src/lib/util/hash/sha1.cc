@@ -52,6 +52,8 @@
  */
 #include <util/hash/sha1.h>
 
+#include <cstring>
+
 namespace bundy {
 namespace util {
 namespace hash {
@@ -327,6 +329,43 @@ static void SHA1Finalize(SHA1Context *context, uint8_t Pad_Byte) {
     context->Computed = 1;
 }
 
+/*
+ *  SHA1HashBlock
+ *
+ *  Description:
+ *      This function computes the message digest of a message that
+ *      fits in a single block, which the caller has already padded
+ *      (including the message length) as described in SHA1PadMessage.
+ *      This allows callers hashing many short messages of the same
+ *      length and trailing content to build the padding only once.
+ *      Message_Digest may overlap Message_Block.
+ *
+ *  Parameters:
+ *      Message_Block: [in]
+ *          The padded 512-bit message block.
+ *      Message_Digest: [out]
+ *          Where the digest is returned.
+ *
+ *  Returns:
+ *      Nothing.
+ *
+ */
+void
+SHA1HashBlock(const uint8_t Message_Block[SHA1_BLOCKSIZE],
+              uint8_t Message_Digest[SHA1_HASHSIZE])
+{
+    SHA1Context context;
+
+    SHA1Reset(&context);
+    std::memcpy(context.Message_Block, Message_Block, SHA1_BLOCKSIZE);
+    SHA1ProcessMessageBlock(&context);
+
+    for (int i = 0; i < SHA1_HASHSIZE; ++i) {
+        Message_Digest[i] = context.Intermediate_Hash[i>>2]
+                            >> 8 * (3 - (i & 0x03));
+    }
+}
+
 /*
  *  SHA1PadMessage
  *
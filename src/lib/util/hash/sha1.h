@@ -84,6 +84,8 @@ extern int SHA1Input(SHA1Context *, const uint8_t *bytes,
 extern int SHA1FinalBits(SHA1Context *, const uint8_t bits,
                          unsigned int bitcount);
 extern int SHA1Result(SHA1Context *, uint8_t Message_Digest[SHA1_HASHSIZE]);
+extern void SHA1HashBlock(const uint8_t Message_Block[SHA1_BLOCKSIZE],
+                          uint8_t Message_Digest[SHA1_HASHSIZE]);
 
 } // namespace hash
 } // namespace util
@@ -126,16 +126,25 @@ recv_fd(const int sock) {
 
 int
 send_fd(const int sock, const int fd) {
-    struct msghdr msghdr;
     struct iovec iov_dummy;
     unsigned char dummy_data = 0;
 
     iov_dummy.iov_base = &dummy_data;
     iov_dummy.iov_len = sizeof(dummy_data);
+    const int ret = send_fd_with_data(sock, fd, &iov_dummy, 1);
+    return (ret >= 0 ? 0 : ret);
+}
+
+int
+send_fd_with_data(const int sock, const int fd, const struct iovec* iov,
+                  const int iovcnt)
+{
+    struct msghdr msghdr;
+
     msghdr.msg_name = NULL;
     msghdr.msg_namelen = 0;
-    msghdr.msg_iov = &iov_dummy;
-    msghdr.msg_iovlen = 1;
+    msghdr.msg_iov = const_cast<struct iovec*>(iov);
+    msghdr.msg_iovlen = iovcnt;
     msghdr.msg_flags = 0;
     msghdr.msg_controllen = cmsg_space(sizeof(int));
     msghdr.msg_control = malloc(msghdr.msg_controllen);
@@ -152,7 +161,7 @@ send_fd(const int sock, const int fd) {
 
     const int ret = sendmsg(sock, &msghdr, 0);
     free(msghdr.msg_control);
-    return (ret >= 0 ? 0 : FD_SYSTEM_ERROR);
+    return (ret >= 0 ? ret : FD_SYSTEM_ERROR);
 }
 
 } // End for namespace io
@@ -21,6 +21,8 @@
  * \todo This interface is very C-ish. Should we have some kind of exceptions?
  */
 
+#include <sys/uio.h>
+
 namespace bundy {
 namespace util {
 namespace io {
@@ -58,6 +60,29 @@ int recv_fd(const int sock);
  */
 int send_fd(const int sock, const int fd);
 
+/**
+ * \short Sends a file descriptor with data.
+ * This is similar to send_fd(), but sends the given data in the same
+ * message, instead of the 1-byte dummy data.  The file descriptor can be
+ * received by recv_fd() with the first byte of the data, and the rest
+ * of the data is read by normal reads.
+ *
+ * For a non blocking socket, only a part of the data may be sent; the
+ * file descriptor is sent with the first byte in that case, so the rest
+ * must be sent by normal writes.
+ *
+ * \return The number of bytes sent, or FD_SYSTEM_ERROR when there's an
+ * error at the operating system level (such as a system call failure).
+ * The global 'errno' variable indicates the specific error.
+ * FD_OTHER_ERROR when there's a different error.
+ * \param sock The unix domain socket to send to.
+ * \param fd The file descriptor to send.
+ * \param iov The data to send, must be at least 1 byte long in total.
+ * \param iovcnt The number of elements of \c iov.
+ */
+int send_fd_with_data(const int sock, const int fd, const struct iovec* iov,
+                      const int iovcnt);
+
 } // End for namespace io
 } // End for namespace util
 } // End for namespace bundy
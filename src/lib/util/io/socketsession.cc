@@ -32,6 +32,7 @@
 #include <cstring>
 #include <cassert>
 
+#include <deque>
 #include <string>
 #include <vector>
 
@@ -83,14 +84,88 @@ const size_t INITIAL_BUFSIZE = 512;
 // may want to customize this value in future.
 const int SOCKSESSION_BUFSIZE = (DEFAULT_HEADER_BUFLEN + MAX_DATASIZE) * 2;
 
+// The maximum total size of socket sessions the forwarder queues while the
+// socket doesn't accept them.  This is 4 times the socket buffer, so it can
+// absorb a burst of some thousands of typical UPDATE requests, while still
+// bounding the memory when the receiver doesn't keep up at all.
+const size_t MAX_QUEUED_BYTES = SOCKSESSION_BUFSIZE * 4;
+
+// A socket session waiting in the forwarder's queue.  data_ is the entire
+// wire-format session (including the leading dummy byte), and offset_ is
+// the size already sent.  fd_ is a duplicate of the forwarded socket, -1
+// once it's been sent with the first byte.
+struct PendingSession {
+    PendingSession() : fd_(-1), offset_(0) {}
+    int fd_;
+    vector<uint8_t> data_;
+    size_t offset_;
+};
+
 struct SocketSessionForwarder::ForwarderImpl {
-    ForwarderImpl() : fd_(-1), buf_(DEFAULT_HEADER_BUFLEN) {}
+    ForwarderImpl() : fd_(-1), buf_(DEFAULT_HEADER_BUFLEN), queued_bytes_(0),
+                      blocked_count_(0)
+    {}
+
+    // Close the duplicated sockets of the queued sessions and drop them.
+    void clearQueue() {
+        for (deque<PendingSession>::iterator it = queue_.begin();
+             it != queue_.end();
+             ++it) {
+            if (it->fd_ != -1) {
+                ::close(it->fd_);
+            }
+        }
+        queue_.clear();
+        queued_bytes_ = 0;
+    }
+
+    void enqueue(int sock, const struct iovec* iov, int iovcnt,
+                 size_t offset);
+
     struct sockaddr_un sock_un_;
     socklen_t sock_un_len_;
     int fd_;
     OutputBuffer buf_;
+    deque<PendingSession> queue_;
+    size_t queued_bytes_;
+    size_t blocked_count_;
 };
 
+// Queue the session of the given wire data, of which the first 'offset'
+// bytes have been sent.  The socket is duplicated unless it's been sent,
+// i.e., 'offset' is 0, so it stays valid even if the caller closes it.
+void
+SocketSessionForwarder::ForwarderImpl::enqueue(int sock,
+                                               const struct iovec* iov,
+                                               int iovcnt, size_t offset)
+{
+    PendingSession session;
+    for (int i = 0; i < iovcnt; ++i) {
+        const uint8_t* const data = static_cast<const uint8_t*>(
+            iov[i].iov_base);
+        session.data_.insert(session.data_.end(), data,
+                             data + iov[i].iov_len);
+    }
+    session.offset_ = offset;
+    if (offset == 0) {
+        session.fd_ = dup(sock);
+        if (session.fd_ == -1) {
+            bundy_throw(SocketSessionError, "Failed to duplicate a socket "
+                        "to be forwarded: " << strerror(errno));
+        }
+    }
+    try {
+        queue_.push_back(session);
+    } catch (...) {
+        if (session.fd_ != -1) {
+            ::close(session.fd_);
+        }
+        throw;
+    }
+    queued_bytes_ += session.data_.size() - offset;
+    ++blocked_count_;
+}
+
 SocketSessionForwarder::SocketSessionForwarder(const std::string& unix_file) :
     impl_(NULL)
 {
@@ -124,6 +199,16 @@ SocketSessionForwarder::SocketSessionForwarder(const std::string& unix_file) :
     *impl_ = impl;
 }
 
+size_t
+SocketSessionForwarder::getPendingCount() const {
+    return (impl_->queue_.size());
+}
+
+size_t
+SocketSessionForwarder::getBlockedCount() const {
+    return (impl_->blocked_count_);
+}
+
 SocketSessionForwarder::~SocketSessionForwarder() {
     if (impl_->fd_ != -1) {
         close();
@@ -184,10 +269,46 @@ SocketSessionForwarder::close() {
     if (impl_->fd_ == -1) {
         bundy_throw(BadValue, "Attempt of close before connect");
     }
+    impl_->clearQueue();
     ::close(impl_->fd_);
     impl_->fd_ = -1;
 }
 
+bool
+SocketSessionForwarder::flush() {
+    if (impl_->fd_ == -1) {
+        bundy_throw(BadValue, "Attempt of flush before connect");
+    }
+    while (!impl_->queue_.empty()) {
+        PendingSession& session = impl_->queue_.front();
+        const struct iovec iov = {
+            &session.data_[session.offset_],
+            session.data_.size() - session.offset_
+        };
+        const int cc = session.fd_ != -1 ?
+            send_fd_with_data(impl_->fd_, session.fd_, &iov, 1) :
+            writev(impl_->fd_, &iov, 1);
+        if (cc < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return (false);
+            }
+            bundy_throw(SocketSessionError,
+                        "Write failed in forwarding a socket session: " <<
+                        strerror(errno));
+        }
+        if (session.fd_ != -1) {
+            ::close(session.fd_);
+            session.fd_ = -1;
+        }
+        session.offset_ += cc;
+        impl_->queued_bytes_ -= cc;
+        if (session.offset_ == session.data_.size()) {
+            impl_->queue_.pop_front();
+        }
+    }
+    return (true);
+}
+
 void
 SocketSessionForwarder::push(int sock, int family, int type, int protocol,
                              const struct sockaddr& local_end,
@@ -219,11 +340,6 @@ SocketSessionForwarder::push(int sock, int family, int type, int protocol,
                   data_len << ", must not exceed " << MAX_DATASIZE);
     }
 
-    if (send_fd(impl_->fd_, sock) != 0) {
-        bundy_throw(SocketSessionError, "FD passing failed: " <<
-                  strerror(errno));
-    }
-
     impl_->buf_.clear();
     // Leave the space for the header length
     impl_->buf_.skip(sizeof(uint16_t));
@@ -244,20 +360,40 @@ SocketSessionForwarder::push(int sock, int family, int type, int protocol,
     // Write the resulting header length at the beginning of the buffer
     impl_->buf_.writeUint16At(impl_->buf_.getLength() - sizeof(uint16_t), 0);
 
-    const struct iovec iov[2] = {
+    // The FD is passed with the dummy byte, followed by the header and
+    // data, all in a single message.
+    uint8_t dummy_data = 0;
+    const struct iovec iov[3] = {
+        { &dummy_data, sizeof(dummy_data) },
         { const_cast<void*>(impl_->buf_.getData()), impl_->buf_.getLength() },
         { const_cast<void*>(data), data_len }
     };
-    const int cc = writev(impl_->fd_, iov, 2);
-    if (cc != impl_->buf_.getLength() + data_len) {
-        if (cc < 0) {
-            bundy_throw(SocketSessionError,
-                      "Write failed in forwarding a socket session: " <<
-                      strerror(errno));
+    const size_t total_len = sizeof(dummy_data) + impl_->buf_.getLength() +
+        data_len;
+
+    // Sessions must be sent in order, so if some are still queued, this one
+    // has to wait unless they can be sent now.
+    if (!flush()) {
+        if (impl_->queued_bytes_ + total_len > MAX_QUEUED_BYTES) {
+            bundy_throw(SocketSessionError, "Too many socket sessions are "
+                        "waiting to be forwarded: " << impl_->queue_.size());
         }
+        impl_->enqueue(sock, iov, 3, 0);
+        return;
+    }
+
+    const int cc = send_fd_with_data(impl_->fd_, sock, iov, 3);
+    if (cc == FD_SYSTEM_ERROR && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        // The queue is empty here, so it never exceeds the limit.
+        impl_->enqueue(sock, iov, 3, 0);
+    } else if (cc < 0) {
         bundy_throw(SocketSessionError,
-                  "Incomplete write in forwarding a socket session: " << cc <<
-                  "/" << (impl_->buf_.getLength() + data_len));
+                    "Write failed in forwarding a socket session: " <<
+                    strerror(errno));
+    } else if (static_cast<size_t>(cc) != total_len) {
+        // The FD and some of the data have been sent; the rest must follow
+        // before anything else.
+        impl_->enqueue(sock, iov, 3, cc);
     }
 }
 
@@ -118,12 +118,27 @@ namespace io {
 /// hang up) and cannot keep up with the volume of incoming sessions.
 ///
 /// So, in this implementation, the forwarder uses non blocking writes to
-/// forward sessions.  If a write attempt could block, it immediately gives
-/// up the operation with an exception.  The corresponding application is
-/// expected to catch it, close the connection, and perform any necessary
-/// recovery for that application (that would normally be re-establish the
-/// connection with a new receiver, possibly after confirming the receiving
-/// side is still alive).  On the other hand, the receiver implementation
+/// forward sessions.  If a write attempt could block, the forwarder keeps
+/// the rest of the session in a bounded queue, and sends it (and any
+/// sessions pushed after it, in order) once the receiver catches up; see
+/// \c SocketSessionForwarder::flush().  Only if the queue is full, it
+/// gives up the operation with an exception.  The corresponding
+/// application is expected to catch it, close the connection, and perform
+/// any necessary recovery for that application (that would normally be
+/// re-establish the connection with a new receiver, possibly after
+/// confirming the receiving side is still alive).  The number of sessions
+/// that had to be queued is available as a counter (see
+/// \c SocketSessionForwarder::getBlockedCount()), so the application can
+/// tell the receiver doesn't keep up before it really fails.
+///
+/// The forwarder sends the file descriptor and the rest of the session
+/// in a single message, so a session is normally forwarded by a single
+/// system call.  This is only about how the data are written; the wire
+/// format is the same as described above.  Each message carries one file
+/// descriptor, since descriptors are attached to the first byte of the
+/// message and the receiver takes one descriptor per session.
+///
+/// On the other hand, the receiver implementation
 /// assumes it's possible that it only receive incomplete elements of a
 /// session (such as in the case where the forwarder writes part of the
 /// entire session and gives up the connection).  The receiver implementation
@@ -289,13 +304,17 @@ public:
     ///
     /// Since the underlying UNIX domain socket is non blocking
     /// (see the description for the constructor), a call to this method
-    /// should either return immediately or result in exception (in case of
-    /// "would block").
+    /// never blocks.  If the socket doesn't accept (the rest of) the session,
+    /// it's queued with a duplicate of \c sock, and sent on later calls to
+    /// this method or \c flush().  Any queued sessions are sent before this
+    /// one, so the sessions are forwarded in the order of the calls.  If the
+    /// total size of queued sessions would exceed an internal limit, it
+    /// results in an exception.
     ///
     /// \exception BadValue The method is called before establishing a
     /// connection or given parameters are invalid.
     /// \exception SocketSessionError A system error in socket operation,
-    /// including the case where the write operation would block.
+    /// including the case where the queue is full.
     ///
     /// \param sock The socket file descriptor
     /// \param family The address family (such as AF_INET6) of the socket
@@ -314,6 +333,36 @@ public:
                       const struct sockaddr& remote_end,
                       const void* data, size_t data_len);
 
+    /// Send the queued socket sessions to the receiver.
+    ///
+    /// It sends as many of the sessions queued by \c push() as the socket
+    /// accepts without blocking.  As \c push() does the same first, the
+    /// application only needs to call it to forward the queued sessions
+    /// without pushing a new one, e.g., when the socket becomes writable.
+    ///
+    /// The connection must have been established by \c connectToReceiver().
+    ///
+    /// \exception BadValue The connection hasn't been established.
+    /// \exception SocketSessionError A system error in socket operation.
+    ///
+    /// \return true if no session is queued any more; false otherwise.
+    bool flush();
+
+    /// Return the number of socket sessions currently queued.
+    ///
+    /// \throw None
+    size_t getPendingCount() const;
+
+    /// Return the number of socket sessions that have been queued.
+    ///
+    /// This is the number of pushed sessions that the socket didn't
+    /// accept (entirely) at once since the construction, i.e., how often
+    /// the forwarder had to wait for the receiver.  It's not reset by
+    /// \c close().
+    ///
+    /// \throw None
+    size_t getBlockedCount() const;
+
 private:
     struct ForwarderImpl;
     ForwarderImpl* impl_;
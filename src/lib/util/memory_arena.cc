@@ -0,0 +1,103 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <util/memory_arena.h>
+
+#include <algorithm>
+#include <new>
+
+#include <stdlib.h>
+
+namespace bundy {
+namespace util {
+
+namespace {
+// The alignment of the allocated memory, enough for any object.
+const size_t ARENA_ALIGNMENT = 16;
+
+// The arena of each thread.
+thread_local MemoryArena* current_arena = NULL;
+
+char*
+allocateChunk(const size_t size) {
+    void* chunk = malloc(size);
+    if (chunk == NULL) {
+        throw std::bad_alloc();
+    }
+    return (static_cast<char*>(chunk));
+}
+}
+
+MemoryArena::Scope::Scope(MemoryArena* arena) : previous_(current_arena) {
+    current_arena = arena;
+}
+
+MemoryArena::Scope::~Scope() {
+    current_arena = previous_;
+}
+
+MemoryArena::MemoryArena(const size_t chunk_size) :
+    chunk_size_((chunk_size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1)),
+    current_(NULL), left_(0), allocated_(0)
+{}
+
+MemoryArena::~MemoryArena() {
+    std::for_each(chunks_.begin(), chunks_.end(), free);
+    std::for_each(big_chunks_.begin(), big_chunks_.end(), free);
+}
+
+void*
+MemoryArena::allocate(size_t size) {
+    size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+    if (size > left_) {
+        if (size > chunk_size_) {
+            // Too big to share a chunk; the current one is still used for
+            // the next objects.
+            big_chunks_.reserve(big_chunks_.size() + 1);
+            big_chunks_.push_back(allocateChunk(size));
+            allocated_ += size;
+            return (big_chunks_.back());
+        }
+        chunks_.reserve(chunks_.size() + 1);
+        chunks_.push_back(allocateChunk(chunk_size_));
+        current_ = chunks_.back();
+        left_ = chunk_size_;
+    }
+    void* const memory = current_;
+    current_ += size;
+    left_ -= size;
+    allocated_ += size;
+    return (memory);
+}
+
+void
+MemoryArena::reset() {
+    std::for_each(big_chunks_.begin(), big_chunks_.end(), free);
+    big_chunks_.clear();
+    if (!chunks_.empty()) {
+        std::for_each(chunks_.begin() + 1, chunks_.end(), free);
+        chunks_.resize(1);
+        current_ = chunks_.front();
+        left_ = chunk_size_;
+    }
+    allocated_ = 0;
+}
+
+MemoryArena*
+MemoryArena::getCurrent() {
+    return (current_arena);
+}
+
+} // namespace util
+} // namespace bundy
@@ -0,0 +1,216 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef MEMORY_ARENA_H
+#define MEMORY_ARENA_H
+
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace bundy {
+namespace util {
+
+/// \brief Memory for short-lived objects, given back all at once.
+///
+/// The arena hands out memory from large chunks, by moving a pointer
+/// forward; the memory of the objects isn't given back one by one, but
+/// all at once by \c reset(), which keeps the first chunk for the next
+/// objects.  This is meant for the objects built while processing a
+/// request, which are all dropped at its end, so that the processing
+/// doesn't have to go through the general purpose allocator.
+///
+/// The objects are created with \c createShared(), as shared pointers
+/// whose reference count is allocated from the arena as well, and which
+/// keep the arena alive.  The owner of the arena can thus tell whether
+/// any of the objects is still in use when it's done with a request: if it
+/// holds the only reference to the arena, it can \c reset() it, otherwise
+/// it should drop it and use a new one, the old one being destroyed with
+/// the last of its objects.
+///
+/// The arena is only allocated from by one thread at a time, but its
+/// objects may be released by any thread.
+class MemoryArena : public boost::enable_shared_from_this<MemoryArena>,
+                    boost::noncopyable
+{
+public:
+    /// \brief The default size of the chunks of memory.
+    static const size_t DEFAULT_CHUNK_SIZE = 16 * 1024;
+
+    /// \brief Sets the arena the objects are created from by
+    /// \c createShared() in the current thread.
+    ///
+    /// The previous arena is restored when the scope ends.
+    class Scope : boost::noncopyable {
+    public:
+        /// \brief Constructor.
+        ///
+        /// \param arena The arena, NULL to create the objects on the heap.
+        explicit Scope(MemoryArena* arena);
+
+        /// \brief Destructor.
+        ~Scope();
+
+    private:
+        MemoryArena* const previous_;
+    };
+
+    /// \brief Constructor.
+    ///
+    /// No memory is allocated until the first object is.
+    ///
+    /// \param chunk_size The size of the chunks of memory.
+    explicit MemoryArena(const size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+    /// \brief Destructor.
+    ///
+    /// Frees the memory of the arena.
+    ~MemoryArena();
+
+    /// \brief Allocates memory.
+    ///
+    /// The memory is suitably aligned for any object.  Requests bigger
+    /// than a chunk get a chunk of their own.
+    ///
+    /// \param size The number of bytes.
+    /// \throw std::bad_alloc if the memory can't be allocated.
+    void* allocate(size_t size);
+
+    /// \brief Makes all the memory of the arena available again.
+    ///
+    /// The first chunk is kept, the others are freed.  The memory must no
+    /// longer be in use.
+    void reset();
+
+    /// \brief Returns the number of bytes allocated since the last reset.
+    size_t getAllocatedSize() const {
+        return (allocated_);
+    }
+
+    /// \brief Returns the arena of the current thread, NULL if there is
+    /// none.
+    static MemoryArena* getCurrent();
+
+    /// \brief Creates an object from the arena of the current thread.
+    ///
+    /// The object is created with \c boost::make_shared if there is no
+    /// current arena.
+    template <typename T, typename... Args>
+    static boost::shared_ptr<T> createShared(Args&&... args);
+
+private:
+    const size_t chunk_size_;
+    // The chunks shared by the objects, the current one last.
+    std::vector<char*> chunks_;
+    // The chunks of the objects bigger than a chunk.
+    std::vector<char*> big_chunks_;
+    char* current_;
+    size_t left_;
+    size_t allocated_;
+};
+
+/// \brief Allocator giving memory from a \c MemoryArena.
+///
+/// The memory is never given back one by one, only with the whole arena.
+/// The allocator holds a reference to the arena.
+template <typename T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    template <typename U>
+    struct rebind {
+        typedef ArenaAllocator<U> other;
+    };
+
+    /// \brief Constructor.
+    ///
+    /// \param arena The arena the memory is allocated from.
+    explicit ArenaAllocator(const boost::shared_ptr<MemoryArena>& arena) :
+        arena_(arena)
+    {}
+
+    /// \brief Converting constructor.
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) :
+        arena_(other.getArena())
+    {}
+
+    T* allocate(size_t n, const void* = NULL) {
+        return (static_cast<T*>(arena_->allocate(n * sizeof(T))));
+    }
+
+    void deallocate(T*, size_t) {}
+
+    size_t max_size() const {
+        return (static_cast<size_t>(-1) / sizeof(T));
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    void destroy(U* p) {
+        p->~U();
+    }
+
+    /// \brief Returns the arena.
+    const boost::shared_ptr<MemoryArena>& getArena() const {
+        return (arena_);
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const {
+        return (arena_ == other.getArena());
+    }
+
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const {
+        return (arena_ != other.getArena());
+    }
+
+private:
+    boost::shared_ptr<MemoryArena> arena_;
+};
+
+template <typename T, typename... Args>
+boost::shared_ptr<T>
+MemoryArena::createShared(Args&&... args) {
+    MemoryArena* const arena = getCurrent();
+    if (arena == NULL) {
+        return (boost::make_shared<T>(std::forward<Args>(args)...));
+    }
+    return (boost::allocate_shared<T>(
+                ArenaAllocator<T>(arena->shared_from_this()),
+                std::forward<Args>(args)...));
+}
+
+} // namespace util
+} // namespace bundy
+
+#endif // MEMORY_ARENA_H
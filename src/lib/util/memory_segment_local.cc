@@ -15,6 +15,8 @@
 #include "memory_segment_local.h"
 #include <exceptions/exceptions.h>
 
+#include <typeinfo>
+
 namespace bundy {
 namespace util {
 
@@ -51,6 +53,25 @@ MemorySegmentLocal::allMemoryDeallocated() const {
     return (allocated_size_ == 0 && named_addrs_.empty());
 }
 
+void
+MemorySegmentLocal::adopt(MemorySegmentLocal& other) {
+    if (typeid(other) != typeid(*this)) {
+        bundy_throw(InvalidOperation, "Memory segment to be adopted is of "
+                    "a different type");
+    }
+    if (!other.named_addrs_.empty()) {
+        bundy_throw(InvalidOperation, "Memory segment to be adopted has "
+                    "named addresses");
+    }
+    allocated_size_ += other.allocated_size_;
+    other.allocated_size_ = 0;
+}
+
+MemorySegmentLocal*
+MemorySegmentLocal::createPeer() const {
+    return (new MemorySegmentLocal);
+}
+
 MemorySegment::NamedAddressResult
 MemorySegmentLocal::getNamedAddressImpl(const char* name) const {
     std::map<std::string, void*>::const_iterator found =
@@ -66,6 +66,33 @@ public:
     /// deallocated, <code>false</code> otherwise.
     virtual bool allMemoryDeallocated() const;
 
+    /// \brief Take over the memory allocated from another local segment.
+    ///
+    /// After this call, the memory allocated from \c other so far is
+    /// considered to be allocated from this segment: it must be deallocated
+    /// through this segment, and \c other behaves as if it had not allocated
+    /// anything.  This allows building data in a separate segment (e.g.,
+    /// in a different thread) and then moving it into this segment.
+    ///
+    /// \c other must be of the same type as this segment; derived classes
+    /// which manage the memory themselves override this method to take
+    /// over their internal state as well.
+    ///
+    /// \throw bundy::InvalidOperation \c other has named addresses or is
+    /// of a different type.
+    ///
+    /// \param other The segment whose memory is taken over.
+    virtual void adopt(MemorySegmentLocal& other);
+
+    /// \brief Create a new, empty segment of the same type.
+    ///
+    /// The new segment can be used to build data that is then adopted by
+    /// this segment (see \c adopt()).  The caller is responsible for
+    /// deleting it.
+    ///
+    /// \throw std::bad_alloc Memory allocation fails.
+    virtual MemorySegmentLocal* createPeer() const;
+
     /// \brief Local segment version of getNamedAddress.
     ///
     /// There's a small chance this method could throw std::bad_alloc.
@@ -24,11 +24,23 @@
 #include <boost/interprocess/mapped_region.hpp>
 #include <boost/interprocess/sync/file_lock.hpp>
 
+#include <algorithm>
 #include <cassert>
 #include <string>
 #include <new>
+#include <system_error>
+#include <thread>
+#include <vector>
 
 #include <stdint.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
 
 // boost::interprocess namespace is big and can cause unexpected import
 // (e.g., it has "read_only"), so it's safer to be specific for shortcuts.
@@ -52,6 +64,88 @@ namespace { // unnamed namespace
 const char* const RESERVED_NAMED_ADDRESS_STORAGE_NAME =
     "_RESERVED_NAMED_ADDRESS_STORAGE";
 
+// Size of the address range a writable segment reserves to grow in without
+// being moved: 64GB, or 256MB on systems with a 32-bit address space.  It's
+// also the size limit of a segment in the MAPPING_CONCURRENT mode, where
+// readers reserve a range of this size, too.
+// Reserving the range costs nothing but the address space; it's mapped
+// without access and backed by nothing until the file is mapped there.
+const size_t RESERVED_RANGE_SIZE =
+    static_cast<size_t>(1) << (sizeof(size_t) > 4 ? 36 : 28);
+
+#ifdef MAP_NORESERVE
+const int RESERVED_RANGE_FLAGS = MAP_PRIVATE | MAP_ANON | MAP_NORESERVE;
+#else
+const int RESERVED_RANGE_FLAGS = MAP_PRIVATE | MAP_ANON;
+#endif
+
+size_t
+roundUpToPage(size_t size) {
+    const size_t pagesize =
+        boost::interprocess::mapped_region::get_page_size();
+    return ((size + pagesize - 1) / pagesize * pagesize);
+}
+
+bool
+truncateFile(int fd, size_t size) {
+    return (ftruncate(fd, size) == 0);
+}
+
+// Read one byte of each page in the range so they are all faulted in.
+size_t
+touchPages(const void* addr, size_t size) {
+    const size_t pagesize =
+        boost::interprocess::mapped_region::get_page_size();
+    const uint8_t* const cp_begin = static_cast<const uint8_t*>(addr);
+    const uint8_t* const cp_end = cp_begin + size;
+
+    size_t sum = 0;
+    for (const uint8_t* cp = cp_begin; cp < cp_end; cp += pagesize) {
+        sum += *cp;
+    }
+    return (sum);
+}
+
+// touchPages() for a thread, storing the sum in *sum.
+void
+touchPagesInto(const void* addr, size_t size, size_t* sum) {
+    *sum = touchPages(addr, size);
+}
+
+#if defined(__linux__) && defined(SYS_set_mempolicy) && \
+    defined(SYS_get_mempolicy)
+#define HAVE_NUMA_MEMPOLICY 1
+
+// Upper bound of the NUMA node numbers we handle; far beyond any real
+// system we'll run on.
+const unsigned long MAX_NUMA_NODES = 1024;
+const size_t NODE_MASK_WORDS = MAX_NUMA_NODES / (8 * sizeof(unsigned long));
+
+// Temporarily set the NUMA policy of the calling thread to interleaving
+// over all allowed nodes, restoring the default local policy on
+// destruction.  isActive() is false if the policy can't be set.
+class InterleavePolicy : boost::noncopyable {
+public:
+    InterleavePolicy() : active_(false) {
+        unsigned long mask[NODE_MASK_WORDS] = { 0 };
+        int mode;
+        if (syscall(SYS_get_mempolicy, &mode, mask, MAX_NUMA_NODES, NULL,
+                    MPOL_F_MEMS_ALLOWED) == 0) {
+            active_ = (syscall(SYS_set_mempolicy, MPOL_INTERLEAVE, mask,
+                               MAX_NUMA_NODES) == 0);
+        }
+    }
+    ~InterleavePolicy() {
+        if (active_) {
+            syscall(SYS_set_mempolicy, MPOL_DEFAULT, NULL, 0);
+        }
+    }
+    bool isActive() const { return (active_); }
+private:
+    bool active_;
+};
+#endif
+
 } // end of unnamed namespace
 
 
@@ -75,8 +169,11 @@ struct MemorySegmentMapped::Impl {
     // tricky because we want to remove any existing file but we also want
     // to detect possible conflict with other readers or writers using
     // file lock.
-    Impl(const std::string& filename, create_only_t, size_t initial_size) :
-        read_only_(false), filename_(filename)
+    Impl(const std::string& filename, create_only_t, size_t initial_size,
+         int mapping_flags) :
+        read_only_(false), filename_(filename), mapping_flags_(mapping_flags),
+        active_mapping_flags_(MAPPING_DEFAULT), fd_(-1), range_base_(NULL),
+        range_size_(0), mapped_size_(0)
     {
         try {
             // First, try opening it in boost create_only mode; it fails if
@@ -106,39 +203,279 @@ struct MemorySegmentMapped::Impl {
                                              initial_size));
         }
 
-        // confirm there's no other user and there won't either.
+        // confirm there's no other user and there won't either.  The file
+        // is remapped first, as closing (any descriptor of) the file would
+        // release the lock.
+        reserveAddressRange();
         lock_.reset(new boost::interprocess::file_lock(filename.c_str()));
         checkWriter();
+        applyMappingFlags();
         reserveMemory();
     }
 
     // Constructor for open-or-write (and read-write) mode
-    Impl(const std::string& filename, open_or_create_t, size_t initial_size) :
-        read_only_(false), filename_(filename),
+    Impl(const std::string& filename, open_or_create_t, size_t initial_size,
+         int mapping_flags) :
+        read_only_(false), filename_(filename), mapping_flags_(mapping_flags),
+        active_mapping_flags_(MAPPING_DEFAULT), fd_(-1), range_base_(NULL),
+        range_size_(0), mapped_size_(0),
         base_sgmt_(new BaseSegment(open_or_create, filename.c_str(),
                                    initial_size)),
         lock_(new boost::interprocess::file_lock(filename.c_str()))
     {
+        reserveAddressRange();
         checkWriter();
+        applyMappingFlags();
         reserveMemory();
     }
 
     // Constructor for existing segment, either read-only or read-write
-    Impl(const std::string& filename, bool read_only) :
+    Impl(const std::string& filename, bool read_only, int mapping_flags) :
         read_only_(read_only), filename_(filename),
+        mapping_flags_(mapping_flags), active_mapping_flags_(MAPPING_DEFAULT),
+        fd_(-1), range_base_(NULL), range_size_(0), mapped_size_(0),
         base_sgmt_(read_only_ ?
                    new BaseSegment(open_read_only, filename.c_str()) :
                    new BaseSegment(open_only, filename.c_str())),
         lock_(new boost::interprocess::file_lock(filename.c_str()))
     {
+        reserveAddressRange();
         if (read_only_) {
             checkReader();
         } else {
             checkWriter();
         }
+        applyMappingFlags();
         reserveMemory();
     }
 
+    ~Impl() {
+        // The mapping must be gone before the range is released, as it
+        // would otherwise unmap whatever is mapped there next.
+        base_sgmt_.reset();
+        releaseAddressRange();
+    }
+
+    // Reserve a range of the address space for the segment to grow in, and
+    // remap the file at its start.  If this fails the segment is left
+    // wherever it's mapped, and it grows by being remapped.
+    //
+    // A read-only segment only reserves the range in the MAPPING_CONCURRENT
+    // mode, where the rest of the range is mapped to the file beyond its
+    // current end, so the pages become accessible as the writer extends the
+    // file.  This must succeed in that case.
+    //
+    // The file is kept open for extending its mapping.  Note that this
+    // must be called before the file lock is acquired; closing a descriptor
+    // of the file would release it.
+    void reserveAddressRange() {
+        if ((mapping_flags_ & MAPPING_CONCURRENT) != 0) {
+            active_mapping_flags_ |= MAPPING_CONCURRENT;
+        } else if (read_only_) {
+            return;
+        }
+        if (!read_only_ && (mapping_flags_ & MAPPING_NO_RESERVE) != 0) {
+            active_mapping_flags_ |= MAPPING_NO_RESERVE;
+            return;
+        }
+
+        const size_t size = base_sgmt_->get_size();
+        const size_t range_size =
+            roundUpToPage(std::max(RESERVED_RANGE_SIZE, size * 2));
+        const int fd = open(filename_.c_str(), read_only_ ? O_RDONLY : O_RDWR);
+        if (fd < 0) {
+            checkReservedForReader();
+            return;
+        }
+        void* const range = mmap(NULL, range_size, PROT_NONE,
+                                 RESERVED_RANGE_FLAGS, -1, 0);
+        if (range == MAP_FAILED) {
+            close(fd);
+            checkReservedForReader();
+            return;
+        }
+
+        // Free the start of the range and map the file there; the address
+        // is only a hint for Boost, and it fails if it's not honored.
+        const size_t mapped_size = roundUpToPage(size);
+        base_sgmt_.reset();
+        munmap(range, mapped_size);
+        try {
+            base_sgmt_.reset(read_only_ ?
+                             new BaseSegment(open_read_only,
+                                             filename_.c_str(), range) :
+                             new BaseSegment(open_only, filename_.c_str(),
+                                             range));
+        } catch (const boost::interprocess::interprocess_exception&) {
+            munmap(range, range_size);
+            close(fd);
+            base_sgmt_.reset(read_only_ ?
+                             new BaseSegment(open_read_only,
+                                             filename_.c_str()) :
+                             new BaseSegment(open_only, filename_.c_str()));
+            checkReservedForReader();
+            return;
+        }
+        if (read_only_ &&
+            mmap(static_cast<uint8_t*>(range) + mapped_size,
+                 range_size - mapped_size, PROT_READ, MAP_SHARED | MAP_FIXED,
+                 fd, mapped_size) == MAP_FAILED) {
+            base_sgmt_.reset();
+            munmap(range, range_size);
+            close(fd);
+            checkReservedForReader();
+        }
+        fd_ = fd;
+        range_base_ = static_cast<uint8_t*>(range);
+        range_size_ = range_size;
+        mapped_size_ = mapped_size;
+    }
+
+    // Throw if a read-only segment failed to reserve the range it needs.
+    void checkReservedForReader() const {
+        if (read_only_) {
+            bundy_throw(MemorySegmentOpenError,
+                        "failed to reserve address range for concurrently "
+                        "updated mapped memory segment " << filename_);
+        }
+    }
+
+    // Release the reserved range, including the parts of the file mapped
+    // in it.  base_sgmt_ must have been reset.
+    void releaseAddressRange() {
+        assert(!base_sgmt_);
+        if (range_base_ != NULL) {
+            munmap(range_base_, range_size_);
+            close(fd_);
+            fd_ = -1;
+            range_base_ = NULL;
+            range_size_ = 0;
+            mapped_size_ = 0;
+        }
+    }
+
+    // Release the reserved range from the given offset.  This is used when
+    // a part of the range may have been lost, so that a later growth won't
+    // map over whatever is mapped there next.
+    void releaseAddressRangeFrom(size_t offset) {
+        munmap(range_base_ + offset, range_size_ - offset);
+        range_size_ = offset;
+    }
+
+    // Give the mapped pages from the given offset of the reserved range back
+    // to the range.
+    void unmapFrom(size_t offset) {
+        assert(offset <= mapped_size_);
+        if (offset < mapped_size_ &&
+            mmap(range_base_ + offset, mapped_size_ - offset, PROT_NONE,
+                 RESERVED_RANGE_FLAGS | MAP_FIXED, -1, 0) == MAP_FAILED) {
+            releaseAddressRangeFrom(offset);
+        }
+        mapped_size_ = offset;
+    }
+
+    // Extend the file to the given size and map the extension right after
+    // the current mapping, so the segment stays at the same address.
+    // Returns false if there's no reserved range or it's too small; throws
+    // std::bad_alloc if the file can't be extended.
+    bool growInPlace(size_t new_size) {
+        const size_t new_mapped_size = roundUpToPage(new_size);
+        if (range_base_ == NULL || new_mapped_size > range_size_) {
+            return (false);
+        }
+
+        const size_t prev_size = base_sgmt_->get_size();
+        if (!truncateFile(fd_, new_size)) {
+            throw std::bad_alloc();
+        }
+        if (new_mapped_size > mapped_size_) {
+            void* const addr =
+                mmap(range_base_ + mapped_size_,
+                     new_mapped_size - mapped_size_, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_FIXED, fd_, mapped_size_);
+            if (addr == MAP_FAILED) {
+                // The range may have lost the pages it failed to map over.
+                // If the file can't be restored it's merely larger than the
+                // segment.
+                releaseAddressRangeFrom(mapped_size_);
+                truncateFile(fd_, prev_size);
+                throw std::bad_alloc();
+            }
+            mapped_size_ = new_mapped_size;
+        }
+        base_sgmt_->get_segment_manager()->grow(new_size - prev_size);
+        return (true);
+    }
+
+    // Shrink the segment to the actually used size without moving it.
+    // Only used with a reserved range.  Failing to truncate the file is
+    // harmless; it's then just larger than the segment.
+    void shrinkInPlace() {
+        base_sgmt_->get_segment_manager()->shrink_to_fit();
+        const size_t new_size = base_sgmt_->get_size();
+
+        // No page of the mapping may be beyond the end of the file, so it's
+        // truncated after the pages are given back to the range.
+        unmapFrom(std::min(roundUpToPage(new_size), mapped_size_));
+        truncateFile(fd_, new_size);
+    }
+
+    // Schedule the dirty pages to be written back.  It doesn't wait for
+    // the writes.
+    void flush() {
+        if (range_base_ != NULL) {
+            msync(range_base_, mapped_size_, MS_ASYNC);
+        } else {
+            base_sgmt_->flush();
+        }
+    }
+
+    // Apply the requested mapping options to the current mapping.  This is
+    // called whenever the file is (re)mapped.  Prefaulting (possibly with
+    // NUMA interleaving) only happens on the initial read-only open, where
+    // the entire segment is expected to be looked up soon.
+    void applyMappingFlags() {
+        void* const addr = base_sgmt_->get_address();
+        const size_t size = base_sgmt_->get_size();
+
+        // Failure to apply any of these is not fatal; the mapping is just
+        // used with the default behavior.
+        active_mapping_flags_ &= ~MAPPING_HUGE_PAGES;
+#ifdef MADV_HUGEPAGE
+        if ((mapping_flags_ & MAPPING_HUGE_PAGES) != 0 &&
+            madvise(addr, size, MADV_HUGEPAGE) == 0) {
+            active_mapping_flags_ |= MAPPING_HUGE_PAGES;
+        }
+#endif
+
+        if (!read_only_ ||
+            (mapping_flags_ & (MAPPING_PREFAULT | MAPPING_NUMA_INTERLEAVE))
+            == 0) {
+            return;
+        }
+#ifdef HAVE_NUMA_MEMPOLICY
+        if ((mapping_flags_ & MAPPING_NUMA_INTERLEAVE) != 0) {
+            const InterleavePolicy policy;
+            if (policy.isActive()) {
+                active_mapping_flags_ |= MAPPING_NUMA_INTERLEAVE;
+            }
+            prefault(addr, size);
+            return;
+        }
+#endif
+        prefault(addr, size);
+    }
+
+    void prefault(void* addr, size_t size) {
+#ifdef MADV_WILLNEED
+        // Let the kernel start reading ahead the whole file before we touch
+        // each page.
+        madvise(addr, size, MADV_WILLNEED);
+#endif
+        touchPages(addr, size);
+        active_mapping_flags_ |= MAPPING_PREFAULT;
+    }
+
     void reserveMemory(bool no_grow = false) {
         if (!read_only_) {
             // Reserve a named address for use during
@@ -170,19 +507,19 @@ struct MemorySegmentMapped::Impl {
         }
     }
 
-    // Internal helper to grow the underlying mapped segment.
-    void growSegment() {
-        // We first need to unmap it before calling grow().  We also flush
-        // the segment to the disk here, so we can incrementally synchronize
-        // dirty pages as the segment grows.  In typical cases, if the segment
-        // is growing it's more likely we are building large data (such as
-        // loading a large DNS zone), so it's less likely that we'll make
-        // existing pages dirty again.  By incrementally flushing the pages
-        // we can avoid a big pause (some operating system seems to sync
-        // dirty pages before reading them).
+    // Internal helper to grow the underlying mapped segment.  It returns
+    // true if the segment has been moved to a different address, and
+    // false if it has grown in place.
+    bool growSegment() {
+        // We flush the segment to the disk here, so we can incrementally
+        // synchronize dirty pages as the segment grows.  In typical cases,
+        // if the segment is growing it's more likely we are building large
+        // data (such as loading a large DNS zone), so it's less likely that
+        // we'll make existing pages dirty again.  By incrementally flushing
+        // the pages we can avoid a big pause (some operating system seems to
+        // sync dirty pages before reading them).
         const size_t prev_size = base_sgmt_->get_size();
-        base_sgmt_->flush();
-        base_sgmt_.reset();
+        flush();
 
         // We'll gradually increase the segment size.  Up to some point
         // we double it, and after that increase it by a constant amount.
@@ -196,27 +533,49 @@ struct MemorySegmentMapped::Impl {
         // behavior.  But we basically assume grow() would fail before this
         // happens, so we assert it shouldn't happen.
         const size_t max_increase = 1024 * 1024 * 64; // 64MB, arbitrary choice
-        const size_t new_size = (prev_size < max_increase) ?
+        size_t new_size = (prev_size < max_increase) ?
             (prev_size * 2) : (prev_size + max_increase);
         assert(new_size > prev_size);
 
+        // Concurrent readers can't access the file beyond their range.
+        if ((mapping_flags_ & MAPPING_CONCURRENT) != 0) {
+            if (prev_size >= RESERVED_RANGE_SIZE) {
+                throw std::bad_alloc();
+            }
+            new_size = std::min(new_size, RESERVED_RANGE_SIZE);
+        }
+
+        // Normally the segment grows within the reserved address range.
+        if (growInPlace(new_size)) {
+            applyMappingFlags();
+            return (false);
+        }
+
+        // Otherwise we first need to unmap it before calling grow(), and
+        // then map it again elsewhere.
+        base_sgmt_.reset();
+        releaseAddressRange();
         const bool grown = BaseSegment::grow(filename_.c_str(),
                                              new_size - prev_size);
 
-        // Remap the file, whether or not grow() succeeded.  this should
-        // normally succeed(*), but it's not 100% guaranteed.  We abort
-        // if it fails (see the method description in the header file).
+        // Remap the file, whether or not grow() succeeded, and reserve a
+        // new range for it.  this should normally succeed(*), but it's not
+        // 100% guaranteed.  We abort if it fails (see the method description
+        // in the header file).
         // (*) Although it's not formally documented, the implementation
         // of grow() seems to provide strong guarantee, i.e, if it fails
         // the underlying file can be used with the previous size.
         try {
             base_sgmt_.reset(new BaseSegment(open_only, filename_.c_str()));
+            reserveAddressRange();
         } catch (...) {
             abort();
         }
+        applyMappingFlags();
         if (!grown) {
             throw std::bad_alloc();
         }
+        return (true);
     }
 
     // remember if the segment is opened read-only or not
@@ -225,6 +584,18 @@ struct MemorySegmentMapped::Impl {
     // mapped file; remember it in case we need to grow it.
     const std::string filename_;
 
+    // requested MappingFlags, and those actually applied.
+    const int mapping_flags_;
+    int active_mapping_flags_;
+
+    // Descriptor of the file used for growing it in place, address range
+    // reserved for a writable segment to grow in (NULL if none), and the
+    // size of its start where the file is mapped.
+    int fd_;
+    uint8_t* range_base_;
+    size_t range_size_;
+    size_t mapped_size_;
+
     // actual Boost implementation of mapped segment.
     boost::scoped_ptr<BaseSegment> base_sgmt_;
 
@@ -243,7 +614,13 @@ private:
     }
 
     void checkWriter() {
-        if (!lock_->try_lock()) {
+        if ((mapping_flags_ & MAPPING_CONCURRENT) != 0) {
+            if (!lock_->try_lock_sharable()) {
+                bundy_throw(MemorySegmentOpenError,
+                            "mapped memory segment can't be opened as "
+                            "read-write with another writer process");
+            }
+        } else if (!lock_->try_lock()) {
             bundy_throw(MemorySegmentOpenError,
                       "mapped memory segment can't be opened as read-write "
                       "with other reader or writer processes");
@@ -253,11 +630,12 @@ private:
     boost::scoped_ptr<boost::interprocess::file_lock> lock_;
 };
 
-MemorySegmentMapped::MemorySegmentMapped(const std::string& filename) :
+MemorySegmentMapped::MemorySegmentMapped(const std::string& filename,
+                                         int mapping_flags) :
     impl_(NULL)
 {
     try {
-        impl_ = new Impl(filename, true);
+        impl_ = new Impl(filename, true, mapping_flags);
     } catch (const boost::interprocess::interprocess_exception& ex) {
         bundy_throw(MemorySegmentOpenError,
                   "failed to open mapped memory segment for " << filename
@@ -266,19 +644,22 @@ MemorySegmentMapped::MemorySegmentMapped(const std::string& filename) :
 }
 
 MemorySegmentMapped::MemorySegmentMapped(const std::string& filename,
-                                         OpenMode mode, size_t initial_size) :
+                                         OpenMode mode, size_t initial_size,
+                                         int mapping_flags) :
     impl_(NULL)
 {
     try {
         switch (mode) {
         case OPEN_FOR_WRITE:
-            impl_ = new Impl(filename, false);
+            impl_ = new Impl(filename, false, mapping_flags);
             break;
         case OPEN_OR_CREATE:
-            impl_ = new Impl(filename, open_or_create, initial_size);
+            impl_ = new Impl(filename, open_or_create, initial_size,
+                             mapping_flags);
             break;
         case CREATE_ONLY:
-            impl_ = new Impl(filename, create_only, initial_size);
+            impl_ = new Impl(filename, create_only, initial_size,
+                             mapping_flags);
             break;
         default:
             bundy_throw(InvalidParameter,
@@ -292,7 +673,10 @@ MemorySegmentMapped::MemorySegmentMapped(const std::string& filename,
 }
 
 MemorySegmentMapped::~MemorySegmentMapped() {
-    if (impl_->base_sgmt_ && !impl_->read_only_) {
+    // With concurrent readers the reserved storage is kept, as destroying it
+    // would modify the index of the named addresses they may be looking up.
+    if (impl_->base_sgmt_ && !impl_->read_only_ &&
+        (impl_->mapping_flags_ & MAPPING_CONCURRENT) == 0) {
         impl_->freeReservedMemory();
     }
     delete impl_;
@@ -315,13 +699,26 @@ MemorySegmentMapped::allocate(size_t size) {
     }
 
     // Grow the mapped segment doubling the size until we have sufficient
-    // free memory in the revised segment for the requested size.
-    do {
-        impl_->growSegment();
-    } while (impl_->base_sgmt_->get_free_memory() < size);
-    bundy_throw(MemorySegmentGrown, "mapped memory segment grown, size: "
-              << impl_->base_sgmt_->get_size() << ", free size: "
-              << impl_->base_sgmt_->get_free_memory());
+    // free memory in the revised segment for the requested size.  As long
+    // as the segment grows in place, the memory is allocated right away;
+    // if it had to be moved, the caller needs to know it.
+    bool relocated = false;
+    while (true) {
+        relocated = impl_->growSegment() || relocated;
+        if (impl_->base_sgmt_->get_free_memory() < size) {
+            continue;
+        }
+        if (relocated) {
+            bundy_throw(MemorySegmentGrown, "mapped memory segment grown, "
+                        "size: " << impl_->base_sgmt_->get_size()
+                        << ", free size: "
+                        << impl_->base_sgmt_->get_free_memory());
+        }
+        void* ptr = impl_->base_sgmt_->allocate(size, std::nothrow);
+        if (ptr) {
+            return (ptr);
+        }
+    }
 }
 
 void
@@ -342,6 +739,12 @@ MemorySegmentMapped::deallocate(void* ptr, size_t) {
 
 bool
 MemorySegmentMapped::allMemoryDeallocated() const {
+    if (!impl_->read_only_ &&
+        (impl_->mapping_flags_ & MAPPING_CONCURRENT) != 0) {
+        bundy_throw(MemorySegmentError,
+                    "allMemoryDeallocated on concurrently read segment");
+    }
+
     // This method is not technically const, but it reserves the
     // const-ness property. In case of exceptions, we abort here. (See
     // ticket #2850 for additional commentary.)
@@ -401,8 +804,7 @@ MemorySegmentMapped::setNamedAddressImpl(const char* name, void* addr) {
             return (grown);
         }
 
-        impl_->growSegment();
-        grown = true;
+        grown = impl_->growSegment() || grown;
     }
 }
 
@@ -421,6 +823,9 @@ MemorySegmentMapped::shrinkToFit() {
     if (impl_->read_only_) {
         bundy_throw(MemorySegmentError, "shrinkToFit on read-only segment");
     }
+    if ((impl_->mapping_flags_ & MAPPING_CONCURRENT) != 0) {
+        return;
+    }
 
     // It appears an assertion failure is triggered within Boost if the size
     // is too small (happening if shrink_to_fit() is called twice without
@@ -436,7 +841,15 @@ MemorySegmentMapped::shrinkToFit() {
         return;
     }
 
-    // First, unmap the underlying file.
+    // Normally the segment shrinks within the reserved address range, which
+    // doesn't need the file to be remapped.
+    if (impl_->range_base_ != NULL) {
+        impl_->shrinkInPlace();
+        impl_->flush();
+        return;
+    }
+
+    // Otherwise, first unmap the underlying file.
     impl_->base_sgmt_.reset();
 
     BaseSegment::shrink_to_fit(impl_->filename_.c_str());
@@ -455,6 +868,7 @@ MemorySegmentMapped::shrinkToFit() {
         bundy_throw(MemorySegmentError,
                   "remap after shrink failed; segment is now unusable");
     }
+    impl_->applyMappingFlags();
 
     // Flush possible dirty pages after shrinking the segment.  As documented
     // in growSegment(), we don't expect too much memory to be flushed here,
@@ -468,20 +882,52 @@ MemorySegmentMapped::getSize() const {
 }
 
 size_t
-MemorySegmentMapped::getCheckSum() const {
+MemorySegmentMapped::getCheckSum(size_t thread_count) const {
+    const uint8_t* const addr =
+        static_cast<const uint8_t*>(impl_->base_sgmt_->get_address());
+    const size_t size = impl_->base_sgmt_->get_size();
     const size_t pagesize =
         boost::interprocess::mapped_region::get_page_size();
-    const uint8_t* const cp_begin = static_cast<const uint8_t*>(
-        impl_->base_sgmt_->get_address());
-    const uint8_t* const cp_end = cp_begin + impl_->base_sgmt_->get_size();
+    const size_t page_count = (size + pagesize - 1) / pagesize;
+    thread_count = std::max<size_t>(1, std::min(thread_count, page_count));
+    if (thread_count == 1) {
+        return (touchPages(addr, size));
+    }
 
-    size_t sum = 0;
-    for (const uint8_t* cp = cp_begin; cp < cp_end; cp += pagesize) {
-        sum += *cp;
+    // Each part starts at a page boundary, so the pages read are the same
+    // as for a single thread, and the sum doesn't depend on the order.
+    // A part whose thread can't be started is done by this thread.
+    const size_t part_size =
+        (page_count + thread_count - 1) / thread_count * pagesize;
+    std::vector<size_t> sums(thread_count, 0);
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for (size_t i = 1; i < thread_count && i * part_size < size; ++i) {
+        const size_t part_len = std::min(part_size, size - i * part_size);
+        try {
+            threads.push_back(std::thread(touchPagesInto,
+                                          addr + i * part_size, part_len,
+                                          &sums[i]));
+        } catch (const std::system_error&) {
+            sums[i] = touchPages(addr + i * part_size, part_len);
+        }
+    }
+    sums[0] = touchPages(addr, std::min(part_size, size));
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
     }
 
+    size_t sum = 0;
+    for (size_t i = 0; i < thread_count; ++i) {
+        sum += sums[i];
+    }
     return (sum);
 }
 
+int
+MemorySegmentMapped::getMappingFlags() const {
+    return (impl_->active_mapping_flags_);
+}
+
 } // namespace util
 } // namespace bundy
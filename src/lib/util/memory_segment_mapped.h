@@ -45,7 +45,9 @@ namespace util {
 /// shouldn't be any other process that opens a segment for the file in
 /// read-write mode. This class tries to detect any violation of this
 /// restriction, but this does not intend to provide 100% safety.  It's
-/// generally the user's responsibility to ensure this condition.
+/// generally the user's responsibility to ensure this condition.  The only
+/// exception is segments opened with \c MAPPING_CONCURRENT, where one
+/// writer and readers can use the file at the same time.
 ///
 /// The same restriction applies within the single process, whether
 /// multi-threaded or not: a process shouldn't open read-only and read-write
@@ -64,6 +66,21 @@ namespace util {
 /// used as a cache, and corrupted image will be detected and discarded with
 /// checksums.  If a future extension requires more robustness, we can then
 /// consider adding a "synchronous" mode.
+///
+/// In the read-write mode, the segment reserves a large range of the address
+/// space (64GB on 64-bit systems) on construction and maps the file at its
+/// start.  The segment then grows by extending the file and mapping the
+/// extension within the range, and shrinks by giving the pages back to the
+/// range, so its address doesn't change and the addresses of the allocated
+/// memory stay valid.  Only if the range can't be reserved or the segment
+/// outgrows it, the file is remapped at a different address and
+/// \c MemorySegmentGrown is thrown as described in \c MemorySegment.
+///
+/// For a large segment, the application can ask how the mapped pages should
+/// be backed by OR'ing the \c MappingFlags values on construction.  These are
+/// hints to the operating system and are applied on a best-effort basis
+/// (and are simply ignored on systems that don't support them);
+/// \c getMappingFlags() tells the ones that actually took effect.
 class MemorySegmentMapped : boost::noncopyable, public MemorySegment {
 public:
     /// \brief The default value of the mapped file size when newly created.
@@ -72,6 +89,46 @@ public:
     /// sufficiently but not too large.
     static const size_t INITIAL_SIZE = 32768;
 
+    /// \brief Options of how the mapped memory is backed.
+    ///
+    /// - MAPPING_HUGE_PAGES: advise the kernel to back the segment with
+    ///   (transparent) huge pages, reducing TLB misses when walking large
+    ///   data.  The advice is renewed whenever the segment is remapped.
+    /// - MAPPING_PREFAULT: fault in all pages of the segment when it's opened
+    ///   so the first lookups won't suffer from page faults.  This only
+    ///   takes effect in the read-only mode.
+    /// - MAPPING_NUMA_INTERLEAVE: interleave the pages over all allowed NUMA
+    ///   nodes as they are faulted in on open, rather than placing them all
+    ///   on the node of the opening thread.  As the kernel allocates pages
+    ///   of shared file mappings according to the policy of the faulting
+    ///   thread, this implies MAPPING_PREFAULT, and it only takes effect in
+    ///   the read-only mode and for pages not yet in the page cache.
+    /// - MAPPING_NO_RESERVE: don't reserve an address range for a writable
+    ///   segment to grow in (see the class description); the segment is
+    ///   remapped, possibly at a different address, whenever it grows.
+    ///   This is mainly for systems with a scarce address space.
+    /// - MAPPING_CONCURRENT: let a writer and readers use the file at the
+    ///   same time.  A reader then reserves an address range of at least the
+    ///   size a writer reserves and maps the file over all of it, so the
+    ///   memory the writer allocates after the reader opened the file is
+    ///   accessible to the reader without remapping.  The writer never
+    ///   shrinks the file nor grows it beyond that size, and only shares
+    ///   the file lock with the readers, so there's no detection of another
+    ///   writer.  It's the application's responsibility not to modify
+    ///   anything the readers may be using, including the named addresses;
+    ///   for the latter reason \c allMemoryDeallocated() can't be called
+    ///   on a writable segment in this mode.  The application would
+    ///   typically build new data in free memory and make the readers see it
+    ///   by a single store of a pointer.
+    enum MappingFlags {
+        MAPPING_DEFAULT = 0,
+        MAPPING_HUGE_PAGES = 1,
+        MAPPING_PREFAULT = 2,
+        MAPPING_NUMA_INTERLEAVE = 4,
+        MAPPING_NO_RESERVE = 8,
+        MAPPING_CONCURRENT = 16
+    };
+
     /// \brief Open modes of \c MemorySegmentMapped.
     ///
     /// These modes matter only for \c MemorySegmentMapped to be opened
@@ -97,12 +154,15 @@ public:
     ///
     /// \throw MemorySegmentOpenError The given file does not exist, is not
     /// readable, or not valid mappable segment.  Or there is another process
-    /// that has already opened a segment for the file.
+    /// that has already opened a segment for the file.  Or the address range
+    /// for \c MAPPING_CONCURRENT can't be reserved.
     /// \throw std::bad_alloc (rare case) internal resource allocation
     /// failure.
     ///
     /// \param filename The file name to be mapped to memory.
-    MemorySegmentMapped(const std::string& filename);
+    /// \param mapping_flags OR'ed \c MappingFlags values.
+    explicit MemorySegmentMapped(const std::string& filename,
+                                 int mapping_flags = MAPPING_DEFAULT);
 
     /// \brief Constructor in the read-write mode.
     ///
@@ -145,8 +205,12 @@ public:
     /// \param mode Open mode (see the description).
     /// \param initial_size Specifies the size of the newly created file;
     /// ignored if \c mode is OPEN_FOR_WRITE.
+    /// \param mapping_flags OR'ed \c MappingFlags values.  Only
+    /// MAPPING_HUGE_PAGES, MAPPING_NO_RESERVE and MAPPING_CONCURRENT are
+    /// meaningful in the read-write mode.
     MemorySegmentMapped(const std::string& filename, OpenMode mode,
-                        size_t initial_size = INITIAL_SIZE);
+                        size_t initial_size = INITIAL_SIZE,
+                        int mapping_flags = MAPPING_DEFAULT);
 
     /// \brief Destructor.
     ///
@@ -158,7 +222,10 @@ public:
 
     /// \brief Allocate/acquire a segment of memory.
     ///
-    /// This version can throw \c MemorySegmentGrown.  Furthermore, there is
+    /// If the segment doesn't have sufficient space, it's grown.  This
+    /// normally happens in place, and the memory is allocated from the
+    /// grown segment; only if the segment had to be moved (see the class
+    /// description), \c MemorySegmentGrown is thrown.  Furthermore, there is
     /// a very small chance that the object loses its integrity and can't be
     /// usable in the case where \c MemorySegmentGrown would be thrown.
     /// In this case, throwing a different exception wouldn't help, because
@@ -190,6 +257,11 @@ public:
     /// read-only mode; in that case MemorySegmentError will be thrown.
     virtual void deallocate(void* ptr, size_t size);
 
+    /// \brief Mapped segment version of allMemoryDeallocated.
+    ///
+    /// This method cannot be called if the segment object is created in the
+    /// read-write mode with \c MAPPING_CONCURRENT; in that case
+    /// MemorySegmentError will be thrown.
     virtual bool allMemoryDeallocated() const;
 
     /// \brief Mapped segment version of setNamedAddress.
@@ -200,8 +272,8 @@ public:
     /// This version of method should normally return false.  However,
     /// it internally allocates memory in the segment for the name and
     /// address to be stored, which can require segment extension, just like
-    /// allocate().  So it's possible to return true unlike
-    /// \c MemorySegmentLocal version of the method.
+    /// allocate().  If the segment then had to be moved it returns true,
+    /// unlike \c MemorySegmentLocal version of the method.
     ///
     /// This method cannot be called if the segment object is created in the
     /// read-only mode; in that case MemorySegmentError will be thrown.
@@ -225,11 +297,18 @@ public:
     /// segment at a reasonable size.
     ///
     /// This method works by a best-effort basis, and does not guarantee
-    /// any specific result.
+    /// any specific result.  In particular, it does nothing for a segment
+    /// opened with \c MAPPING_CONCURRENT, as readers would crash on
+    /// accessing their mapping beyond the end of the file.
+    ///
+    /// Normally the segment is shrunk in place: the unused end of the
+    /// segment is released and the file is truncated, but the segment isn't
+    /// remapped, and writing back the dirty pages is only scheduled; so this
+    /// doesn't block the caller for long even for a large segment.
     ///
     /// This method is generally expected to be failure-free, but it's still
-    /// possible to fail.  For example, the underlying file may not be writable
-    /// at the time of shrink attempt; it also tries to remap the shrunk
+    /// possible to fail.  If the segment isn't within a reserved address
+    /// range (see the class description), it tries to remap the shrunk
     /// segment internally, and there's a small chance it could fail.
     /// In such a case it throws \c MemorySegmentError.  If it's thrown the
     /// segment is not usable anymore.
@@ -258,8 +337,24 @@ public:
     /// pages are actually in memory.  The latter property will be useful
     /// if the application cannot allow the initial page fault overhead.
     ///
+    /// With a \c thread_count larger than 1, the segment is split into
+    /// that many runs of pages (at most one per page), each of them read
+    /// by a separate thread, which mostly helps when the pages have to be
+    /// read from the file.  The result doesn't depend on \c thread_count.
+    ///
+    /// \throw None
+    ///
+    /// \param thread_count The number of threads reading the segment.
+    size_t getCheckSum(size_t thread_count = 1) const;
+
+    /// \brief Return the mapping options in effect.
+    ///
+    /// It's the subset of the \c MappingFlags values given on construction
+    /// that have been successfully applied to the current mapping.  This is
+    /// provided mainly for diagnosis and statistics.
+    ///
     /// \throw None
-    size_t getCheckSum() const;
+    int getMappingFlags() const;
 
 private:
     struct Impl;
@@ -0,0 +1,137 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "memory_segment_slab.h"
+#include <exceptions/exceptions.h>
+
+#include <cstdlib>
+
+namespace bundy {
+namespace util {
+
+const size_t MemorySegmentSlab::SLAB_GRANULARITY;
+const size_t MemorySegmentSlab::MAX_SLAB_SIZE;
+const size_t MemorySegmentSlab::CHUNK_SIZE;
+
+MemorySegmentSlab::MemorySegmentSlab() :
+    chunk_free_(NULL), chunk_free_size_(0), slab_allocated_size_(0)
+{
+    for (size_t i = 0; i < SIZE_CLASS_COUNT; ++i) {
+        free_lists_[i] = NULL;
+    }
+}
+
+MemorySegmentSlab::~MemorySegmentSlab() {
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        free(chunks_[i]);
+    }
+}
+
+void*
+MemorySegmentSlab::allocate(size_t size) {
+    if (size > MAX_SLAB_SIZE) {
+        return (MemorySegmentLocal::allocate(size));
+    }
+
+    const size_t size_class = getSizeClass(size);
+    void* ptr = free_lists_[size_class];
+    if (ptr != NULL) {
+        free_lists_[size_class] = *static_cast<void**>(ptr);
+    } else {
+        const size_t block_size = (size_class + 1) * SLAB_GRANULARITY;
+        if (chunk_free_size_ < block_size) {
+            // The tail of the current chunk, if any, is left unused.
+            // Reserve the room for the new chunk first so that adding it
+            // can't fail after the allocation.
+            chunks_.reserve(chunks_.size() + 1);
+            void* chunk = malloc(CHUNK_SIZE);
+            if (chunk == NULL) {
+                throw std::bad_alloc();
+            }
+            chunks_.push_back(chunk);
+            chunk_free_ = static_cast<uint8_t*>(chunk);
+            chunk_free_size_ = CHUNK_SIZE;
+        }
+        ptr = chunk_free_;
+        chunk_free_ += block_size;
+        chunk_free_size_ -= block_size;
+    }
+
+    slab_allocated_size_ += size;
+    return (ptr);
+}
+
+void
+MemorySegmentSlab::deallocate(void* ptr, size_t size) {
+    if (ptr == NULL) {
+        return;
+    }
+
+    if (size > MAX_SLAB_SIZE) {
+        MemorySegmentLocal::deallocate(ptr, size);
+        return;
+    }
+
+    if (size > slab_allocated_size_) {
+      bundy_throw(OutOfRange, "Invalid size to deallocate: " << size
+                << "; currently allocated size: " << slab_allocated_size_);
+    }
+
+    slab_allocated_size_ -= size;
+    const size_t size_class = getSizeClass(size);
+    *static_cast<void**>(ptr) = free_lists_[size_class];
+    free_lists_[size_class] = ptr;
+}
+
+bool
+MemorySegmentSlab::allMemoryDeallocated() const {
+    return (slab_allocated_size_ == 0 &&
+            MemorySegmentLocal::allMemoryDeallocated());
+}
+
+void
+MemorySegmentSlab::adopt(MemorySegmentLocal& other) {
+    // This checks the type and the named addresses of other.
+    MemorySegmentLocal::adopt(other);
+    MemorySegmentSlab& other_slab = static_cast<MemorySegmentSlab&>(other);
+
+    chunks_.insert(chunks_.end(), other_slab.chunks_.begin(),
+                   other_slab.chunks_.end());
+    other_slab.chunks_.clear();
+
+    // The free blocks of other are moved one by one.  There are normally
+    // few of them, as other is expected to be used for building new data.
+    // The unused part of its last chunk is simply left unused.
+    for (size_t i = 0; i < SIZE_CLASS_COUNT; ++i) {
+        while (other_slab.free_lists_[i] != NULL) {
+            void* ptr = other_slab.free_lists_[i];
+            other_slab.free_lists_[i] = *static_cast<void**>(ptr);
+            *static_cast<void**>(ptr) = free_lists_[i];
+            free_lists_[i] = ptr;
+        }
+    }
+    other_slab.chunk_free_ = NULL;
+    other_slab.chunk_free_size_ = 0;
+
+    slab_allocated_size_ += other_slab.slab_allocated_size_;
+    other_slab.slab_allocated_size_ = 0;
+}
+
+MemorySegmentLocal*
+MemorySegmentSlab::createPeer() const {
+    return (new MemorySegmentSlab);
+}
+
+} // namespace util
+} // namespace bundy
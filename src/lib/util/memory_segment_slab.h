@@ -0,0 +1,145 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef MEMORY_SEGMENT_SLAB_H
+#define MEMORY_SEGMENT_SLAB_H
+
+#include <util/memory_segment_local.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <vector>
+
+namespace bundy {
+namespace util {
+
+/// \brief Size-class slab allocator based Memory Segment class
+///
+/// This is a variant of \c MemorySegmentLocal intended for data consisting
+/// of a very large number of small objects, such as the in-memory zone
+/// data.  Small requests are not passed to malloc() one by one; they are
+/// rounded up to a multiple of \c SLAB_GRANULARITY and carved out of large
+/// chunks, and deallocated blocks are kept in a free list per size class
+/// for reuse.  Requests larger than \c MAX_SLAB_SIZE are handled by
+/// \c MemorySegmentLocal.
+///
+/// Deallocating a small block never returns memory to the system; all the
+/// chunks are released at once when the segment is destroyed.  This makes
+/// both building and destroying the data much cheaper than with
+/// individual malloc() and free() calls, and avoids fragmenting the heap,
+/// at the cost of keeping the peak amount of memory until then.
+///
+/// Blocks are aligned to \c SLAB_GRANULARITY bytes.
+class MemorySegmentSlab : boost::noncopyable, public MemorySegmentLocal {
+public:
+    /// \brief The size classes are multiples of this value.
+    static const size_t SLAB_GRANULARITY = 8;
+
+    /// \brief The largest request served by the slabs.
+    static const size_t MAX_SLAB_SIZE = 256;
+
+    /// \brief The size of the chunks the slabs are carved from.
+    static const size_t CHUNK_SIZE = 64 * 1024;
+
+    /// \brief Constructor
+    ///
+    /// Creates an empty slab memory segment object.  No chunk is allocated
+    /// until the first small request.
+    MemorySegmentSlab();
+
+    /// \brief Destructor
+    ///
+    /// Releases all the chunks, regardless of whether the blocks carved
+    /// from them have been deallocated.
+    virtual ~MemorySegmentSlab();
+
+    /// \brief Allocate/acquire a segment of memory.
+    ///
+    /// Throws <code>std::bad_alloc</code> if the implementation cannot
+    /// allocate the requested storage.
+    ///
+    /// \param size The size of the memory requested in bytes.
+    /// \return Returns pointer to the memory allocated.
+    virtual void* allocate(size_t size);
+
+    /// \brief Free/release a segment of memory.
+    ///
+    /// A small block is put on the free list of its size class.
+    ///
+    /// This method may throw <code>bundy::OutOfRange</code> if \c size is
+    /// larger than the currently allocated size.
+    ///
+    /// \param ptr Pointer to the block of memory to free/release. This
+    /// should be equal to a value returned by <code>allocate()</code>.
+    /// \param size The size of the memory to be freed in bytes. This
+    /// should be equal to the number of bytes originally allocated.
+    virtual void deallocate(void* ptr, size_t size);
+
+    /// \brief Check if all allocated memory was deallocated.
+    ///
+    /// \return Returns <code>true</code> if all allocated memory was
+    /// deallocated, <code>false</code> otherwise.
+    virtual bool allMemoryDeallocated() const;
+
+    /// \brief Take over the memory allocated from another slab segment.
+    ///
+    /// In addition to what \c MemorySegmentLocal::adopt() does, the chunks
+    /// and the free blocks of \c other are moved to this segment.
+    ///
+    /// \throw bundy::InvalidOperation \c other has named addresses or is
+    /// not a \c MemorySegmentSlab.
+    ///
+    /// \param other The segment whose memory is taken over.
+    virtual void adopt(MemorySegmentLocal& other);
+
+    /// \brief Create a new, empty \c MemorySegmentSlab.
+    virtual MemorySegmentLocal* createPeer() const;
+
+    /// \brief Return the number of chunks the segment holds.
+    size_t getChunkCount() const {
+        return (chunks_.size());
+    }
+
+private:
+    // Number of the size classes.
+    static const size_t SIZE_CLASS_COUNT = MAX_SLAB_SIZE / SLAB_GRANULARITY;
+
+    // Return the size class of a small request of the given size.
+    static size_t getSizeClass(size_t size) {
+        return ((size == 0) ? 0 : (size - 1) / SLAB_GRANULARITY);
+    }
+
+    // Chunks the slabs are carved from.
+    std::vector<void*> chunks_;
+
+    // Head of the free list of each size class.  The first word of a free
+    // block points to the next free block of the same class.
+    void* free_lists_[SIZE_CLASS_COUNT];
+
+    // Unused part of the last chunk.
+    uint8_t* chunk_free_;
+    size_t chunk_free_size_;
+
+    // Total size of the small blocks currently allocated.
+    size_t slab_allocated_size_;
+};
+
+} // namespace util
+} // namespace bundy
+
+#endif // MEMORY_SEGMENT_SLAB_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -19,6 +19,8 @@
 
 #include <exceptions/exceptions.h>
 
+#include <boost/noncopyable.hpp>
+
 /**
  * @file pycppwrapper_util.h
  * @short Shared definitions for python/C(++) API
@@ -339,6 +341,32 @@ installClassVariable(PyTypeObject& pyclass, const char* name, PyObject* obj) {
     PyObjectContainer(obj).installAsClassVariable(pyclass, name);
 }
 
+/// This helper class releases the GIL (global interpreter lock) for its
+/// lifetime, so other Python threads can run while a long or blocking C++
+/// call is in progress.  The GIL is reacquired on destruction, including
+/// the case of an exception.
+///
+/// No Python API may be used while the GIL is released, so only the C++
+/// call itself should be in the scope of the releaser:
+/// \code
+///    {
+///        GILReleaser releaser;
+///        result = self->cppobj->longOperation();
+///    }
+///    return (createResultObject(result));
+/// \endcode
+///
+/// Another Python thread can then use the same Python object, so a wrapped
+/// C++ object should only be used by one thread at a time, unless the C++
+/// class is thread safe.
+class GILReleaser : boost::noncopyable {
+public:
+    GILReleaser() : state_(PyEval_SaveThread()) {}
+    ~GILReleaser() { PyEval_RestoreThread(state_); }
+private:
+    PyThreadState* const state_;
+};
+
 } // namespace python
 } // namespace util
 } // namespace bundy
@@ -12,6 +12,7 @@
 // OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
 // PERFORMANCE OF THIS SOFTWARE.
 
+#include <cstring>
 #include <string>
 #include <utility>
 #include <vector>
@@ -96,4 +97,59 @@ TEST_F(Base64Test, encode) {
         EXPECT_EQ((*it).second, encodeBase64(decoded_data));
     }
 }
+
+TEST_F(Base64Test, encodeToBuffer) {
+    for (vector<StringPair>::const_iterator it = test_sequence.begin();
+         it != test_sequence.end();
+         ++it) {
+        // The characters beyond the text are left intact.
+        char buffer[16];
+        memset(buffer, '!', sizeof(buffer));
+        const size_t len = encodeBase64(
+            reinterpret_cast<const uint8_t*>((*it).first.data()),
+            (*it).first.size(), buffer);
+        EXPECT_EQ((*it).second, string(buffer, len));
+        EXPECT_EQ('!', buffer[len]);
+    }
+}
+
+// Longer data are converted in vectors where supported, with the rest
+// converted byte by byte.  Check all of them meet at the right place by
+// a round trip of every length up to a few vectors.
+TEST_F(Base64Test, longData) {
+    vector<uint8_t> data;
+    for (size_t len = 0; len < 200; ++len) {
+        const string encoded = encodeBase64(data);
+        EXPECT_EQ((len + 2) / 3 * 4, encoded.size());
+        decodeBase64(encoded, decoded_data);
+        EXPECT_TRUE(data == decoded_data);
+        data.push_back(len * 37 + 11);
+    }
+
+    // the first and last characters map to all 0 and all 1 bits.
+    EXPECT_EQ(string(64, 'A'), encodeBase64(vector<uint8_t>(48, 0)));
+    EXPECT_EQ(string(64, '/'), encodeBase64(vector<uint8_t>(48, 0xff)));
+
+    // Invalid characters are detected wherever they are, and so is padding
+    // before the last group.
+    const string encoded = encodeBase64(data);
+    const char invalid_chars[] = { '*', '\0', '\x80', '\xff', '=' };
+    for (size_t i = 0; i < encoded.size(); ++i) {
+        for (size_t j = 0; j < sizeof(invalid_chars); ++j) {
+            if (invalid_chars[j] == '=' && i >= encoded.size() - 4) {
+                continue;
+            }
+            string bad_encoded = encoded;
+            bad_encoded[i] = invalid_chars[j];
+            EXPECT_THROW(decodeBase64(bad_encoded, decoded_data), BadValue);
+        }
+    }
+
+    // Spaces are still allowed anywhere.
+    string spaced_encoded = encoded;
+    spaced_encoded.insert(50, " ");
+    spaced_encoded.insert(10, "\n");
+    decodeBase64(spaced_encoded, decoded_data);
+    EXPECT_TRUE(data == decoded_data);
+}
 }
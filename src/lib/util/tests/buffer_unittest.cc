@@ -263,6 +263,54 @@ TEST_F(BufferTest, outputBufferZeroSize) {
     });
 }
 
+TEST_F(BufferTest, outputBufferExternalStorage) {
+    uint8_t storage[8];
+    const void* const storage_head = storage;
+    OutputBuffer buffer(storage, sizeof(storage));
+    EXPECT_TRUE(buffer.isExternalStorage());
+    EXPECT_EQ(sizeof(storage), buffer.getCapacity());
+
+    // Data fitting in the storage is written there.
+    buffer.writeData(testdata, 5);
+    buffer.writeUint16(0x0607);
+    EXPECT_TRUE(buffer.isExternalStorage());
+    EXPECT_EQ(storage_head, buffer.getData());
+    EXPECT_EQ(0, std::memcmp(storage, testdata, 5));
+    EXPECT_EQ(6, storage[5]);
+
+    // Clearing the buffer keeps using the storage.
+    buffer.clear();
+    buffer.writeData(testdata, 5);
+    EXPECT_EQ(storage_head, buffer.getData());
+
+    // Overflowing moves the data to memory allocated by the buffer.
+    buffer.writeUint32(0x05060708);
+    EXPECT_FALSE(buffer.isExternalStorage());
+    EXPECT_NE(storage_head, buffer.getData());
+    EXPECT_LE(9, buffer.getCapacity());
+    ASSERT_EQ(9, buffer.getLength());
+    for (size_t i = 0; i < 5; ++i) {
+        EXPECT_EQ(testdata[i], buffer[i]);
+    }
+    EXPECT_EQ(8, buffer[8]);
+
+    // A copy always has its own memory.
+    OutputBuffer other(storage, sizeof(storage));
+    other.writeUint8(1);
+    OutputBuffer copy(other);
+    EXPECT_FALSE(copy.isExternalStorage());
+    EXPECT_NE(other.getData(), copy.getData());
+    other = buffer;
+    EXPECT_FALSE(other.isExternalStorage());
+    EXPECT_EQ(9, other.getLength());
+
+    // Empty storage works, too.
+    OutputBuffer empty(NULL, 0);
+    empty.writeUint8(1);
+    EXPECT_FALSE(empty.isExternalStorage());
+    EXPECT_EQ(1, empty[0]);
+}
+
 TEST_F(BufferTest, inputBufferReadVectorAll) {
     std::vector<uint8_t> vec;
 
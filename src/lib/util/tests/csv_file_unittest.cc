@@ -48,6 +48,16 @@ TEST(CSVRow, parse) {
     row1.parse("");
     ASSERT_EQ(1, row1.getValuesCount());
     EXPECT_TRUE(row1.readAt(0).empty());
+
+    // Parsing a row with more values than the previous one should extend
+    // the row.
+    row1.parse("cat|dog||lion|tiger");
+    ASSERT_EQ(5, row1.getValuesCount());
+    EXPECT_EQ("cat", row1.readAt(0));
+    EXPECT_EQ("dog", row1.readAt(1));
+    EXPECT_TRUE(row1.readAt(2).empty());
+    EXPECT_EQ("lion", row1.readAt(3));
+    EXPECT_EQ("tiger", row1.readAt(4));
 }
 
 // This test checks that the text representation of the CSV row
@@ -367,6 +377,47 @@ TEST_F(CSVFileTest, recreate) {
               readFile());
 }
 
+// This test checks that the rows are flushed to the file as they are appended
+// unless the automatic flush is disabled, in which case they are written when
+// the file is synchronized.
+TEST_F(CSVFileTest, autoFlush) {
+    boost::scoped_ptr<CSVFile> csv(new CSVFile(testfile_));
+    csv->addColumn("animal");
+    csv->addColumn("color");
+    ASSERT_NO_THROW(csv->recreate());
+    ASSERT_TRUE(csv->getAutoFlush());
+
+    CSVRow row0(2);
+    row0.writeAt(0, "dog");
+    row0.writeAt(1, "grey");
+    ASSERT_NO_THROW(csv->append(row0));
+    EXPECT_EQ("animal,color\n"
+              "dog,grey\n",
+              readFile());
+
+    csv->setAutoFlush(false);
+    EXPECT_FALSE(csv->getAutoFlush());
+
+    CSVRow row1(2);
+    row1.writeAt(0, "cat");
+    row1.writeAt(1, "black");
+    ASSERT_NO_THROW(csv->append(row1));
+    // The row is buffered until the file is synchronized.
+    EXPECT_EQ("animal,color\n"
+              "dog,grey\n",
+              readFile());
+
+    ASSERT_NO_THROW(csv->sync());
+    EXPECT_EQ("animal,color\n"
+              "dog,grey\n"
+              "cat,black\n",
+              readFile());
+
+    // Synchronizing a closed file is an error.
+    csv->close();
+    EXPECT_THROW(csv->sync(), CSVFileError);
+}
+
 // This test checks that the error is reported when the size of the row being
 // read doesn't match the number of columns of the CSV file.
 TEST_F(CSVFileTest, validate) {
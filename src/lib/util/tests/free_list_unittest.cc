@@ -0,0 +1,111 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <util/free_list.h>
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+using namespace bundy::util;
+
+namespace {
+
+// An object counting its live instances.
+class Counted {
+public:
+    Counted() {
+        ++count;
+    }
+    ~Counted() {
+        --count;
+    }
+    static int count;
+};
+
+int Counted::count = 0;
+
+TEST(FreeListTest, getPut) {
+    typedef FreeList<Counted, 2> List;
+    EXPECT_EQ(static_cast<Counted*>(NULL), List::get());
+
+    Counted* const first = new Counted;
+    Counted* const second = new Counted;
+    Counted* const third = new Counted;
+    List::put(first);
+    List::put(second);
+    EXPECT_EQ(2, List::getCount());
+    // The list is full, the object is deleted.
+    List::put(third);
+    EXPECT_EQ(2, List::getCount());
+    EXPECT_EQ(2, Counted::count);
+
+    // The objects are given back, last in first out, and not destroyed.
+    EXPECT_EQ(second, List::get());
+    EXPECT_EQ(first, List::get());
+    EXPECT_EQ(0, List::getCount());
+    EXPECT_EQ(2, Counted::count);
+    delete first;
+    delete second;
+}
+
+TEST(FreeListTest, perThread) {
+    typedef FreeList<Counted, 2> List;
+    std::thread([] {
+        List::put(new Counted);
+        EXPECT_EQ(1, List::getCount());
+    }).join();
+    // The other thread had its own list, deleted when it ended.
+    EXPECT_EQ(0, List::getCount());
+    EXPECT_EQ(0, Counted::count);
+}
+
+class Allocated : public FreeListAllocated<Allocated, 2> {
+public:
+    virtual ~Allocated() {}
+    char data[40];
+};
+
+class BiggerAllocated : public Allocated {
+public:
+    char more[100];
+};
+
+TEST(FreeListTest, allocated) {
+    EXPECT_EQ(0, Allocated::getFreeCount());
+    Allocated* const first = new Allocated;
+    Allocated* const second = new Allocated;
+    Allocated* const third = new Allocated;
+    delete first;
+    delete second;
+    // The list is full, the memory is freed.
+    delete third;
+    EXPECT_EQ(2, Allocated::getFreeCount());
+
+    // The memory is used again.
+    Allocated* const reused = new Allocated;
+    EXPECT_EQ(second, reused);
+    EXPECT_EQ(1, Allocated::getFreeCount());
+
+    // Bigger objects don't use the list.
+    Allocated* const bigger = new BiggerAllocated;
+    EXPECT_EQ(1, Allocated::getFreeCount());
+    delete bigger;
+    EXPECT_EQ(1, Allocated::getFreeCount());
+
+    delete reused;
+    EXPECT_EQ(2, Allocated::getFreeCount());
+}
+
+}
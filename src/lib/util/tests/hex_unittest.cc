@@ -50,6 +50,11 @@ TEST_F(HexTest, encodeHex) {
     data.push_back(0xca);
     data.push_back(0xde);
     EXPECT_EQ(hex_txt, encodeHex(data));
+
+    // The same into a buffer.
+    char buffer[16];
+    EXPECT_EQ(hex_txt.size(), encodeHex(&data[0], data.size(), buffer));
+    EXPECT_EQ(hex_txt, string(buffer, hex_txt.size()));
 }
 
 void
@@ -0,0 +1,125 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <util/memory_arena.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <string>
+
+#include <stdint.h>
+
+using namespace bundy::util;
+
+namespace {
+
+// An object counting its live instances.
+class Counted {
+public:
+    Counted(int& count, const std::string& name) :
+        count_(count), name_(name)
+    {
+        ++count_;
+    }
+    ~Counted() {
+        --count_;
+    }
+    const std::string& getName() const {
+        return (name_);
+    }
+private:
+    int& count_;
+    const std::string name_;
+};
+
+TEST(MemoryArenaTest, allocate) {
+    MemoryArena arena(1024);
+    EXPECT_EQ(0, arena.getAllocatedSize());
+
+    // The memory is aligned and doesn't overlap.
+    char* const first = static_cast<char*>(arena.allocate(1));
+    char* const second = static_cast<char*>(arena.allocate(20));
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(first) % 16);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(second) % 16);
+    EXPECT_LE(first + 1, second);
+    EXPECT_EQ(48, arena.getAllocatedSize());
+
+    // More than a chunk, and bigger than a chunk.
+    for (int i = 0; i < 100; ++i) {
+        arena.allocate(100);
+    }
+    char* const big = static_cast<char*>(arena.allocate(4000));
+    big[0] = big[3999] = 0;
+
+    // Everything is given back, and the first chunk is used again.
+    arena.reset();
+    EXPECT_EQ(0, arena.getAllocatedSize());
+    EXPECT_EQ(first, arena.allocate(1));
+}
+
+TEST(MemoryArenaTest, createShared) {
+    int count = 0;
+    boost::shared_ptr<MemoryArena> arena(new MemoryArena);
+
+    // Without a scope, the objects are created on the heap.
+    boost::shared_ptr<Counted> heap =
+        MemoryArena::createShared<Counted>(count, "heap");
+    EXPECT_EQ(1, count);
+    EXPECT_EQ("heap", heap->getName());
+    EXPECT_TRUE(arena.unique());
+    EXPECT_EQ(0, arena->getAllocatedSize());
+
+    {
+        MemoryArena::Scope scope(arena.get());
+        EXPECT_EQ(arena.get(), MemoryArena::getCurrent());
+        boost::shared_ptr<Counted> object =
+            MemoryArena::createShared<Counted>(count, "arena");
+        EXPECT_EQ(2, count);
+        EXPECT_EQ("arena", object->getName());
+        EXPECT_LT(0, arena->getAllocatedSize());
+        // The object keeps the arena.
+        EXPECT_FALSE(arena.unique());
+
+        // Scopes can be nested.
+        {
+            MemoryArena::Scope heap_scope(NULL);
+            EXPECT_EQ(static_cast<MemoryArena*>(NULL),
+                      MemoryArena::getCurrent());
+        }
+        EXPECT_EQ(arena.get(), MemoryArena::getCurrent());
+    }
+    EXPECT_EQ(static_cast<MemoryArena*>(NULL), MemoryArena::getCurrent());
+    // The object was destroyed, and the arena is no longer used.
+    EXPECT_EQ(1, count);
+    EXPECT_TRUE(arena.unique());
+}
+
+TEST(MemoryArenaTest, outliveOwner) {
+    int count = 0;
+    boost::shared_ptr<Counted> object;
+    {
+        boost::shared_ptr<MemoryArena> arena(new MemoryArena);
+        MemoryArena::Scope scope(arena.get());
+        object = MemoryArena::createShared<Counted>(count, "kept");
+    }
+    // The arena is destroyed with the last object.
+    EXPECT_EQ(1, count);
+    EXPECT_EQ("kept", object->getName());
+    object.reset();
+    EXPECT_EQ(0, count);
+}
+
+}
@@ -108,6 +108,30 @@ TEST(MemorySegmentLocal, TestNullDeallocate) {
     EXPECT_TRUE(segment->allMemoryDeallocated());
 }
 
+TEST(MemorySegmentLocal, adopt) {
+    MemorySegmentLocal segment;
+    MemorySegmentLocal other;
+
+    void* ptr = other.allocate(1024);
+    segment.adopt(other);
+
+    // The memory now belongs to segment.
+    EXPECT_TRUE(other.allMemoryDeallocated());
+    EXPECT_FALSE(segment.allMemoryDeallocated());
+    EXPECT_THROW(other.deallocate(ptr, 1024), bundy::OutOfRange);
+    segment.deallocate(ptr, 1024);
+    EXPECT_TRUE(segment.allMemoryDeallocated());
+
+    // A segment with named addresses can't be adopted.
+    ptr = other.allocate(42);
+    other.setNamedAddress("test address", ptr);
+    EXPECT_THROW(segment.adopt(other), bundy::InvalidOperation);
+    EXPECT_TRUE(segment.allMemoryDeallocated());
+    other.clearNamedAddress("test address");
+    other.deallocate(ptr, 42);
+    EXPECT_TRUE(other.allMemoryDeallocated());
+}
+
 TEST(MemorySegmentLocal, namedAddress) {
     MemorySegmentLocal segment;
     bundy::util::test::checkSegmentNamedAddress(segment, true);
@@ -36,7 +36,9 @@
 #include <vector>
 #include <map>
 
+#include <sys/resource.h>
 #include <sys/stat.h>
+#include <signal.h>
 #include <unistd.h>
 #include <stdlib.h>
 
@@ -210,51 +212,86 @@ TEST_F(MemorySegmentMappedTest, allocate) {
     EXPECT_TRUE(segment_->allMemoryDeallocated());
 
     // (Clearly) exceeding the available size, which should cause growing
-    // the segment
+    // the segment.  It grows in place, so the allocation succeeds at once.
     const size_t prev_size = segment_->getSize();
-    EXPECT_THROW(segment_->allocate(prev_size + 1), MemorySegmentGrown);
-    // The size should have been doubled.
-    EXPECT_EQ(prev_size * 2, segment_->getSize());
-    // But nothing should have been allocated.
-    EXPECT_TRUE(segment_->allMemoryDeallocated());
-
-    // Now, the allocation should now succeed.
     void* ptr = segment_->allocate(prev_size + 1);
     EXPECT_NE(static_cast<void*>(NULL), ptr);
     EXPECT_FALSE(segment_->allMemoryDeallocated());
+    // The size should have been doubled.
+    EXPECT_EQ(prev_size * 2, segment_->getSize());
 
     // Same set of checks, but for a larger size.
-    EXPECT_THROW(segment_->allocate(prev_size * 10), MemorySegmentGrown);
+    ptr = segment_->allocate(prev_size * 10);
+    EXPECT_NE(static_cast<void*>(NULL), ptr);
     // the segment should have grown to the minimum power-of-2 size that
     // could allocate the given size of memory.
     EXPECT_EQ(prev_size * 16, segment_->getSize());
-    // And allocate() should now succeed.
-    ptr = segment_->allocate(prev_size * 10);
-    EXPECT_NE(static_cast<void*>(NULL), ptr);
 
     // (we'll left the regions created in the file there; the entire file
     // will be removed at the end of the test)
 }
 
 TEST_F(MemorySegmentMappedTest, badAllocate) {
-    // If the test is run as the root user, the following allocate()
-    // call will result in a successful MemorySegmentGrown exception,
-    // instead of an abort (due to insufficient permissions during
-    // reopen).
-    if (getuid() == 0) {
-        std::cerr << "Skipping test as it's run as the root user" << std::endl;
-        return;
-    }
-
-    // Make the mapped file non-writable; managed_mapped_file::grow() will
-    // fail, resulting in abort.
+    // Make the mapped file non-writable.  As the segment grows in place
+    // without reopening the file, growing it still succeeds.
     const int ret = chmod(mapped_file, 0444);
     ASSERT_EQ(0, ret);
+    EXPECT_NE(static_cast<void*>(NULL),
+              segment_->allocate(DEFAULT_INITIAL_SIZE * 2));
+
+    // If the file can't be extended, allocate() fails, but the segment is
+    // still usable.
+    const size_t size = segment_->getSize();
+    struct rlimit orig_limit;
+    ASSERT_EQ(0, getrlimit(RLIMIT_FSIZE, &orig_limit));
+    struct rlimit limit = orig_limit;
+    limit.rlim_cur = size;
+    ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &limit));
+    void (*orig_handler)(int) = signal(SIGXFSZ, SIG_IGN);
+    EXPECT_THROW(segment_->allocate(size * 2), std::bad_alloc);
+    signal(SIGXFSZ, orig_handler);
+    ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &orig_limit));
+
+    EXPECT_EQ(size, segment_->getSize());
+    void* ptr = segment_->allocate(sizeof(uint32_t));
+    EXPECT_NE(static_cast<void*>(NULL), ptr);
+    segment_->deallocate(ptr, sizeof(uint32_t));
+}
 
-    if (!bundy::util::unittests::runningOnValgrind()) {
-        EXPECT_DEATH_IF_SUPPORTED(
-            {segment_->allocate(DEFAULT_INITIAL_SIZE * 2);}, "");
-    }
+TEST_F(MemorySegmentMappedTest, growInPlace) {
+    void* ptr = segment_->allocate(sizeof(uint32_t));
+    *static_cast<uint32_t*>(ptr) = 42;
+    EXPECT_FALSE(segment_->setNamedAddress("test address", ptr));
+
+    // Growing the segment several times doesn't move it; the addresses
+    // remain valid.
+    const size_t prev_size = segment_->getSize();
+    void* large_ptr = segment_->allocate(prev_size * 100);
+    EXPECT_LT(prev_size * 100, segment_->getSize());
+    EXPECT_EQ(ptr, segment_->getNamedAddress("test address").second);
+    EXPECT_EQ(42, *static_cast<const uint32_t*>(ptr));
+    std::memset(large_ptr, 0xff, prev_size * 100);
+
+    // Neither does shrinking it.
+    segment_->deallocate(large_ptr, prev_size * 100);
+    segment_->shrinkToFit();
+    EXPECT_GT(prev_size * 100, segment_->getSize());
+    EXPECT_EQ(ptr, segment_->getNamedAddress("test address").second);
+    EXPECT_EQ(42, *static_cast<const uint32_t*>(ptr));
+
+    // It can grow again after being shrunk.
+    large_ptr = segment_->allocate(prev_size * 10);
+    std::memset(large_ptr, 0, prev_size * 10);
+    EXPECT_EQ(42, *static_cast<const uint32_t*>(ptr));
+    segment_->deallocate(large_ptr, prev_size * 10);
+
+    // The data are in the file.
+    segment_.reset();
+    segment_.reset(new MemorySegmentMapped(mapped_file));
+    const MemorySegment::NamedAddressResult result =
+        segment_->getNamedAddress("test address");
+    ASSERT_TRUE(result.first);
+    EXPECT_EQ(42, *static_cast<const uint32_t*>(result.second));
 }
 
 // XXX: this test can cause too strong side effect (creating a very large
@@ -335,8 +372,11 @@ TEST_F(MemorySegmentMappedTest, namedAddress) {
     boost::interprocess::file_mapping::remove(mapped_file);
     segment_.reset(new MemorySegmentMapped(mapped_file, OPEN_OR_CREATE, 1024));
     const std::string long_name(1025, 'x'); // definitely larger than segment
-    // setNamedAddress should return true, indicating segment has grown.
-    EXPECT_TRUE(segment_->setNamedAddress(long_name.c_str(), NULL));
+    // The segment grows in place, so setNamedAddress should still return
+    // false.
+    const size_t size_before_long_name = segment_->getSize();
+    EXPECT_FALSE(segment_->setNamedAddress(long_name.c_str(), NULL));
+    EXPECT_LT(size_before_long_name, segment_->getSize());
     result = segment_->getNamedAddress(long_name.c_str());
     EXPECT_TRUE(result.first);
     EXPECT_FALSE(result.second);
@@ -356,7 +396,7 @@ TEST_F(MemorySegmentMappedTest, namedAddress) {
         std::vector<uint8_t>(5000); // larger than usual segment size
     data_list["data3"] =
         std::vector<uint8_t>(65535); // bigger than most usual data
-    bool grown = false;
+    const size_t initial_size = segment_->getSize();
 
     // Allocate memory and store data
     for (TestData::iterator it = data_list.begin(); it != data_list.end();
@@ -373,12 +413,13 @@ TEST_F(MemorySegmentMappedTest, namedAddress) {
                 std::memcpy(dp, &data[0], data.size());
                 segment_->setNamedAddress(it->first.c_str(), dp);
             } catch (const MemorySegmentGrown&) {
-                grown = true;
+                // The segment shouldn't have been moved.
+                ADD_FAILURE() << "unexpected MemorySegmentGrown";
             }
         }
     }
     // Confirm there's at least one segment extension
-    EXPECT_TRUE(grown);
+    EXPECT_LT(initial_size, segment_->getSize());
     // Check named data are still valid
     for (TestData::iterator it = data_list.begin(); it != data_list.end();
          ++it)
@@ -562,6 +603,133 @@ TEST_F(MemorySegmentMappedTest, getCheckSum) {
     EXPECT_EQ(old_cksum + 1, segment_->getCheckSum());
 }
 
+TEST_F(MemorySegmentMappedTest, getCheckSumThreads) {
+    // The segment is read by several threads, but the result should be
+    // the same for any number of them, including silly ones.
+    const size_t cksum = segment_->getCheckSum();
+    const size_t page_sz = boost::interprocess::mapped_region::get_page_size();
+    const size_t page_count = segment_->getSize() / page_sz;
+    EXPECT_EQ(cksum, segment_->getCheckSum(0));
+    EXPECT_EQ(cksum, segment_->getCheckSum(1));
+    EXPECT_EQ(cksum, segment_->getCheckSum(2));
+    EXPECT_EQ(cksum, segment_->getCheckSum(3));
+    EXPECT_EQ(cksum, segment_->getCheckSum(page_count - 1));
+    EXPECT_EQ(cksum, segment_->getCheckSum(page_count));
+    EXPECT_EQ(cksum, segment_->getCheckSum(page_count + 1));
+    EXPECT_EQ(cksum, segment_->getCheckSum(static_cast<size_t>(-1)));
+
+    // A change in the last page is seen with several threads too.
+    uint8_t* cp0 = static_cast<uint8_t*>(segment_->allocate(page_sz));
+    for (uint8_t* cp = cp0; cp < cp0 + page_sz; ++cp) {
+        ++*cp;
+    }
+    EXPECT_EQ(cksum + 1, segment_->getCheckSum(4));
+}
+
+TEST_F(MemorySegmentMappedTest, mappingFlags) {
+    // By default no option is in effect.
+    EXPECT_EQ(MemorySegmentMapped::MAPPING_DEFAULT,
+              segment_->getMappingFlags());
+    segment_.reset();
+
+    // Prefaulting only happens in the read-only mode.
+    segment_.reset(new MemorySegmentMapped(
+                       mapped_file, OPEN_FOR_WRITE,
+                       MemorySegmentMapped::INITIAL_SIZE,
+                       MemorySegmentMapped::MAPPING_PREFAULT));
+    EXPECT_EQ(0, segment_->getMappingFlags() &
+              MemorySegmentMapped::MAPPING_PREFAULT);
+    segment_.reset();
+
+    segment_.reset(new MemorySegmentMapped(
+                       mapped_file, MemorySegmentMapped::MAPPING_PREFAULT));
+    EXPECT_NE(0, segment_->getMappingFlags() &
+              MemorySegmentMapped::MAPPING_PREFAULT);
+    const size_t cksum = segment_->getCheckSum();
+    segment_.reset();
+
+    // NUMA interleaving implies prefaulting.  Whether the interleaving
+    // itself and huge pages take effect depends on the system, but they
+    // shouldn't affect the segment in any case.
+    segment_.reset(new MemorySegmentMapped(
+                       mapped_file,
+                       MemorySegmentMapped::MAPPING_NUMA_INTERLEAVE |
+                       MemorySegmentMapped::MAPPING_HUGE_PAGES));
+    EXPECT_NE(0, segment_->getMappingFlags() &
+              MemorySegmentMapped::MAPPING_PREFAULT);
+    EXPECT_EQ(cksum, segment_->getCheckSum());
+    segment_.reset();
+
+    // The options are kept while a writable segment grows.
+    segment_.reset(new MemorySegmentMapped(
+                       mapped_file, OPEN_FOR_WRITE,
+                       MemorySegmentMapped::INITIAL_SIZE,
+                       MemorySegmentMapped::MAPPING_HUGE_PAGES));
+    const int flags = segment_->getMappingFlags();
+    EXPECT_NE(static_cast<void*>(NULL),
+              segment_->allocate(segment_->getSize() + 1));
+    EXPECT_EQ(flags, segment_->getMappingFlags());
+    segment_.reset();
+
+    // Without a reserved address range, the segment is remapped to grow.
+    segment_.reset(new MemorySegmentMapped(
+                       mapped_file, OPEN_FOR_WRITE,
+                       MemorySegmentMapped::INITIAL_SIZE,
+                       MemorySegmentMapped::MAPPING_NO_RESERVE));
+    EXPECT_EQ(MemorySegmentMapped::MAPPING_NO_RESERVE,
+              segment_->getMappingFlags());
+    EXPECT_THROW(segment_->allocate(segment_->getSize() + 1),
+                 MemorySegmentGrown);
+    EXPECT_EQ(MemorySegmentMapped::MAPPING_NO_RESERVE,
+              segment_->getMappingFlags());
+    EXPECT_NE(static_cast<void*>(NULL),
+              segment_->allocate(segment_->getSize() / 2 + 1));
+    segment_->shrinkToFit();
+}
+
+TEST_F(MemorySegmentMappedTest, concurrentReader) {
+    segment_.reset();
+    segment_.reset(new MemorySegmentMapped(
+                       mapped_file, OPEN_FOR_WRITE,
+                       MemorySegmentMapped::INITIAL_SIZE,
+                       MemorySegmentMapped::MAPPING_CONCURRENT));
+    EXPECT_EQ(MemorySegmentMapped::MAPPING_CONCURRENT,
+              segment_->getMappingFlags());
+    uint8_t* const base = static_cast<uint8_t*>(segment_->allocate(1));
+    segment_->setNamedAddress("base", base);
+
+    scoped_ptr<MemorySegmentMapped> reader(
+        new MemorySegmentMapped(mapped_file,
+                                MemorySegmentMapped::MAPPING_CONCURRENT));
+    EXPECT_EQ(MemorySegmentMapped::MAPPING_CONCURRENT,
+              reader->getMappingFlags());
+    const uint8_t* const reader_base = static_cast<const uint8_t*>(
+        reader->getNamedAddress("base").second);
+    ASSERT_NE(static_cast<const uint8_t*>(NULL), reader_base);
+
+    // Memory allocated by the writer beyond the end of the file at the
+    // time the reader opened it is accessible to the reader without
+    // remapping.
+    const size_t prev_size = segment_->getSize();
+    uint8_t* const large_ptr =
+        static_cast<uint8_t*>(segment_->allocate(prev_size * 10));
+    EXPECT_LT(prev_size * 10, segment_->getSize());
+    std::memset(large_ptr, 42, prev_size * 10);
+    EXPECT_EQ(segment_->getSize(), reader->getSize());
+    const uint8_t* const reader_ptr = reader_base + (large_ptr - base);
+    EXPECT_EQ(42, reader_ptr[0]);
+    EXPECT_EQ(42, reader_ptr[prev_size * 10 - 1]);
+
+    // The file isn't shrunk, as the reader may be using it.
+    segment_->deallocate(large_ptr, prev_size * 10);
+    const size_t size = segment_->getSize();
+    segment_->shrinkToFit();
+    EXPECT_EQ(size, segment_->getSize());
+
+    // This would modify the named addresses.
+    EXPECT_THROW(segment_->allMemoryDeallocated(), MemorySegmentError);
+}
+
 // Mode of opening segments in the tests below.
 enum TestOpenMode {
     READER = 0,
@@ -0,0 +1,157 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <util/tests/memory_segment_common_unittest.h>
+
+#include <util/memory_segment_slab.h>
+#include <exceptions/exceptions.h>
+#include <gtest/gtest.h>
+#include <boost/scoped_ptr.hpp>
+#include <cstring>
+#include <vector>
+#include <limits.h>
+
+using namespace std;
+using namespace bundy::util;
+
+namespace {
+
+TEST(MemorySegmentSlab, allocate) {
+    MemorySegmentSlab segment;
+
+    // By default, nothing is allocated, not even a chunk.
+    EXPECT_TRUE(segment.allMemoryDeallocated());
+    EXPECT_EQ(0, segment.getChunkCount());
+
+    // Small blocks come from a single chunk and don't overlap.
+    void* ptr = segment.allocate(42);
+    void* ptr2 = segment.allocate(1);
+    void* ptr3 = segment.allocate(0);
+    EXPECT_FALSE(segment.allMemoryDeallocated());
+    EXPECT_EQ(1, segment.getChunkCount());
+    memset(ptr, 0xff, 42);
+    memset(ptr2, 0, 1);
+    EXPECT_EQ(0xff, static_cast<uint8_t*>(ptr)[41]);
+    EXPECT_NE(ptr, ptr2);
+    EXPECT_NE(ptr2, ptr3);
+
+    // The blocks are aligned.
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(ptr2) %
+              MemorySegmentSlab::SLAB_GRANULARITY);
+
+    // Large blocks don't use the chunks.
+    void* ptr4 = segment.allocate(MemorySegmentSlab::MAX_SLAB_SIZE + 1);
+    EXPECT_EQ(1, segment.getChunkCount());
+
+    segment.deallocate(ptr, 42);
+    segment.deallocate(ptr2, 1);
+    segment.deallocate(ptr3, 0);
+    EXPECT_FALSE(segment.allMemoryDeallocated());
+    segment.deallocate(ptr4, MemorySegmentSlab::MAX_SLAB_SIZE + 1);
+    EXPECT_TRUE(segment.allMemoryDeallocated());
+
+    // The chunk is kept until the segment is destroyed.
+    EXPECT_EQ(1, segment.getChunkCount());
+}
+
+TEST(MemorySegmentSlab, reuse) {
+    MemorySegmentSlab segment;
+
+    // A deallocated block is reused for a request of the same size class.
+    void* ptr = segment.allocate(42);
+    segment.deallocate(ptr, 42);
+    EXPECT_EQ(ptr, segment.allocate(48));
+    EXPECT_NE(ptr, segment.allocate(42));
+
+    // A new chunk is allocated when the current one is used up.
+    const size_t count = MemorySegmentSlab::CHUNK_SIZE /
+        MemorySegmentSlab::MAX_SLAB_SIZE;
+    vector<void*> ptrs;
+    for (size_t i = 0; i < count; ++i) {
+        ptrs.push_back(segment.allocate(MemorySegmentSlab::MAX_SLAB_SIZE));
+    }
+    EXPECT_EQ(2, segment.getChunkCount());
+    for (size_t i = 0; i < count; ++i) {
+        segment.deallocate(ptrs[i], MemorySegmentSlab::MAX_SLAB_SIZE);
+    }
+
+    // Reallocating them doesn't need any new chunk.
+    for (size_t i = 0; i < count; ++i) {
+        segment.allocate(MemorySegmentSlab::MAX_SLAB_SIZE);
+    }
+    EXPECT_EQ(2, segment.getChunkCount());
+}
+
+TEST(MemorySegmentSlab, TestTooMuchMemory) {
+    MemorySegmentSlab segment;
+
+    EXPECT_THROW(segment.allocate(ULONG_MAX), bad_alloc);
+}
+
+TEST(MemorySegmentSlab, TestBadDeallocate) {
+    MemorySegmentSlab segment;
+
+    void* ptr = segment.allocate(42);
+
+    // This should throw as the size passed to deallocate() is larger
+    // than what was allocated.
+    EXPECT_THROW(segment.deallocate(ptr, 48), bundy::OutOfRange);
+
+    // NULL deallocation is a no-op.
+    EXPECT_NO_THROW(segment.deallocate(NULL, 42));
+    EXPECT_FALSE(segment.allMemoryDeallocated());
+
+    EXPECT_NO_THROW(segment.deallocate(ptr, 42));
+    EXPECT_TRUE(segment.allMemoryDeallocated());
+}
+
+TEST(MemorySegmentSlab, adopt) {
+    MemorySegmentSlab segment;
+    boost::scoped_ptr<MemorySegmentLocal> other(segment.createPeer());
+
+    void* ptr = other->allocate(42);
+    void* ptr2 = other->allocate(1024);
+    void* ptr3 = other->allocate(42);
+    other->deallocate(ptr3, 42);
+    segment.adopt(*other);
+
+    // The memory and the chunk now belong to segment.
+    EXPECT_TRUE(other->allMemoryDeallocated());
+    EXPECT_FALSE(segment.allMemoryDeallocated());
+    EXPECT_EQ(1, segment.getChunkCount());
+    EXPECT_THROW(other->deallocate(ptr, 42), bundy::OutOfRange);
+    segment.deallocate(ptr, 42);
+    segment.deallocate(ptr2, 1024);
+    EXPECT_TRUE(segment.allMemoryDeallocated());
+
+    // And so do the free blocks; the block deallocated last is reused first.
+    EXPECT_EQ(ptr, segment.allocate(42));
+    EXPECT_EQ(ptr3, segment.allocate(42));
+
+    // The other segment can still be used.
+    other->deallocate(other->allocate(42), 42);
+    EXPECT_TRUE(other->allMemoryDeallocated());
+
+    // A segment of a different type can't be adopted, in either direction.
+    MemorySegmentLocal local;
+    EXPECT_THROW(segment.adopt(local), bundy::InvalidOperation);
+    EXPECT_THROW(local.adopt(segment), bundy::InvalidOperation);
+}
+
+TEST(MemorySegmentSlab, namedAddress) {
+    MemorySegmentSlab segment;
+    bundy::util::test::checkSegmentNamedAddress(segment, true);
+}
+
+} // anonymous namespace
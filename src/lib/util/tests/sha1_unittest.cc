@@ -103,6 +103,28 @@ TEST_F(Sha1Test, Test4) {
     }
 }
 
+// Same as Test1, but with a pre-padded block
+TEST_F(Sha1Test, hashBlock) {
+    uint8_t block[SHA1_BLOCKSIZE] = { 'a', 'b', 'c', 0x80 };
+    block[SHA1_BLOCKSIZE - 1] = 3 * 8;
+    uint8_t expected[SHA1_HASHSIZE] = {
+        0xa9, 0x99, 0x3e, 0x36, 0x47, 0x06, 0x81, 0x6a, 0xba, 0x3e,
+        0x25, 0x71, 0x78, 0x50, 0xc2, 0x6c, 0x9c, 0xd0, 0xd8, 0x9d
+    };
+
+    uint8_t digest[SHA1_HASHSIZE];
+    SHA1HashBlock(block, digest);
+    for (int i = 0; i < SHA1_HASHSIZE; i++) {
+        EXPECT_EQ(digest[i], expected[i]);
+    }
+
+    // The digest can be stored in the block itself.
+    SHA1HashBlock(block, block);
+    for (int i = 0; i < SHA1_HASHSIZE; i++) {
+        EXPECT_EQ(block[i], expected[i]);
+    }
+}
+
 } // namespace hash
 } // namespace util
 } // namespace bundy
@@ -675,20 +675,21 @@ TEST_F(ForwardTest, badPush) {
 
 // A subroutine for pushTooFast, continuously pushing socket sessions
 // with full-size DNS messages (65535 bytes) without receiving them.  
-// the push attempts will eventually fill the socket send buffer and trigger
-// an exception.  Unfortunately exactly how many we can forward depends on
-// the internal system implementation; it should be close to 3, because
-// in our current implementation it sets the send buffer to a size that
-// is sufficiently large to hold 2 sessions (but not much larger than that),
-// but (for example) Linux internally doubles the specified upper limit.
-// Experimentally we know 10 is enough to produce a reliable result, but
+// the push attempts will eventually fill the socket send buffer and the
+// forwarder's queue, and trigger an exception.  Unfortunately exactly how
+// many we can forward depends on the internal system implementation; the
+// send buffer should hold close to 3, because in our current implementation
+// it sets the send buffer to a size that is sufficiently large to hold 2
+// sessions (but not much larger than that), but (for example) Linux
+// internally doubles the specified upper limit.  The queue holds 8 more.
+// Experimentally we know 30 is enough to produce a reliable result, but
 // if it turns out to be not the case, we should do it a bit harder, e.g.,
 // by probing the actual buffer size by getsockopt(SO_SNDBUF).
 void
 multiPush(SocketSessionForwarder& forwarder, const struct sockaddr& sa,
           const void* data, size_t data_len)
 {
-    for (int i = 0; i < 10; ++i) {
+    for (int i = 0; i < 30; ++i) {
         forwarder.push(1, AF_INET, SOCK_DGRAM, IPPROTO_UDP, sa, sa,
                        data, data_len);
     }
@@ -702,6 +703,50 @@ TEST_F(ForwardTest, pushTooFast) {
     EXPECT_THROW(multiPush(forwarder_, *getSockAddr("192.0.2.1", "53").first,
                            large_text_.c_str(), large_text_.length()),
                  SocketSessionError);
+    EXPECT_LT(0, forwarder_.getPendingCount());
+    EXPECT_EQ(forwarder_.getPendingCount(), forwarder_.getBlockedCount());
+    EXPECT_FALSE(forwarder_.flush());
+
+    // Closing the connection drops the queued sessions, but the counter
+    // is kept.
+    const size_t blocked_count = forwarder_.getBlockedCount();
+    forwarder_.close();
+    EXPECT_EQ(0, forwarder_.getPendingCount());
+    EXPECT_EQ(blocked_count, forwarder_.getBlockedCount());
+    EXPECT_THROW(forwarder_.flush(), BadValue);
+}
+
+TEST_F(ForwardTest, pushQueued) {
+    // Sessions the socket doesn't accept are queued, and forwarded in order
+    // as the receiver catches up.
+    startListen();
+    forwarder_.connectToReceiver();
+    accept_sock_.reset(acceptForwarder());
+    const SockAddrInfo sai(getSockAddr("192.0.2.1", "53"));
+    string data(large_text_);
+    size_t pushed = 0;
+    while (forwarder_.getPendingCount() < 2) {
+        ASSERT_GT(20, pushed);
+        data[0] = 'a' + pushed;
+        forwarder_.push(0, AF_INET, SOCK_DGRAM, IPPROTO_UDP, *sai.first,
+                        *sai.first, data.c_str(), data.length());
+        ++pushed;
+    }
+    EXPECT_EQ(2, forwarder_.getBlockedCount());
+
+    SocketSessionReceiver receiver(accept_sock_.fd);
+    for (size_t i = 0; i < pushed; ++i) {
+        alarm(1);
+        const SocketSession session = receiver.pop();
+        alarm(0);
+        const ScopedSocket passed_sock(session.getSocket());
+        EXPECT_LE(0, passed_sock.fd);
+        ASSERT_EQ(data.length(), session.getDataLength());
+        EXPECT_EQ('a' + i, static_cast<const char*>(session.getData())[0]);
+        forwarder_.flush();
+    }
+    EXPECT_EQ(0, forwarder_.getPendingCount());
+    EXPECT_TRUE(forwarder_.flush());
 }
 
 TEST_F(ForwardTest, badPop) {
@@ -158,4 +158,26 @@ TEST_F(DNSSECTimeTest, overflow) {
     EXPECT_THROW(timeToText32(4294197632LU), InvalidTime);
 }
 
+TEST(CoarseClockTest, getTime) {
+    // The coarse clock can lag behind by a tick, so it may still be at the
+    // previous second.
+    const time_t before = time(NULL);
+    const time_t now = CoarseClock::getTime();
+    const time_t after = time(NULL);
+    EXPECT_LE(before - 1, now);
+    EXPECT_GE(after, now);
+}
+
+TEST(CoarseClockTest, getMonotonicMillis) {
+    const uint64_t start = CoarseClock::getMonotonicMillis();
+    EXPECT_LE(start, CoarseClock::getMonotonicMillis());
+
+    // It moves forward, at about the pace of real time.
+    const struct timespec delay = { 0, 100 * 1000 * 1000 }; // 100ms
+    nanosleep(&delay, NULL);
+    const uint64_t elapsed = CoarseClock::getMonotonicMillis() - start;
+    EXPECT_LE(80, elapsed);
+    EXPECT_GT(10000, elapsed);
+}
+
 }
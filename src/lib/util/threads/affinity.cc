@@ -0,0 +1,135 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <util/threads/affinity.h>
+
+#include <exceptions/exceptions.h>
+
+#include <boost/foreach.hpp>
+
+#include <cerrno>
+#include <cstring>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// The CPU sets are a GNU extension.
+#if defined(__linux__) && defined(CPU_SET)
+#define BUNDY_HAVE_CPU_AFFINITY 1
+#endif
+
+namespace bundy {
+namespace util {
+namespace thread {
+
+namespace {
+
+void
+checkCPU(int cpu) {
+#ifdef BUNDY_HAVE_CPU_AFFINITY
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+#else
+    if (cpu < 0) {
+#endif
+        bundy_throw(InvalidParameter, "CPU number out of range: " << cpu);
+    }
+}
+
+}
+
+bool
+isAffinitySupported() {
+#ifdef BUNDY_HAVE_CPU_AFFINITY
+    return (true);
+#else
+    return (false);
+#endif
+}
+
+size_t
+getCPUCount() {
+    const long count = sysconf(_SC_NPROCESSORS_CONF);
+    return (count > 0 ? count : 1);
+}
+
+void
+setCurrentThreadAffinity(const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+        bundy_throw(InvalidParameter, "Empty CPU set for a thread");
+    }
+    BOOST_FOREACH(int cpu, cpus) {
+        checkCPU(cpu);
+    }
+#ifdef BUNDY_HAVE_CPU_AFFINITY
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    BOOST_FOREACH(int cpu, cpus) {
+        CPU_SET(cpu, &set);
+    }
+    const int result = pthread_setaffinity_np(pthread_self(), sizeof(set),
+                                              &set);
+    if (result != 0) {
+        bundy_throw(InvalidOperation, "Failed to set the CPU affinity of "
+                    "a thread: " << std::strerror(result));
+    }
+#else
+    bundy_throw(NotImplemented, "CPU affinity is not supported");
+#endif
+}
+
+std::vector<int>
+getCurrentThreadAffinity() {
+    std::vector<int> cpus;
+#ifdef BUNDY_HAVE_CPU_AFFINITY
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    const int result = pthread_getaffinity_np(pthread_self(), sizeof(set),
+                                              &set);
+    if (result != 0) {
+        bundy_throw(InvalidOperation, "Failed to get the CPU affinity of "
+                    "a thread: " << std::strerror(result));
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set)) {
+            cpus.push_back(cpu);
+        }
+    }
+#else
+    const int count = getCPUCount();
+    for (int cpu = 0; cpu < count; ++cpu) {
+        cpus.push_back(cpu);
+    }
+#endif
+    return (cpus);
+}
+
+void
+setSocketIncomingCPU(int fd, int cpu) {
+    checkCPU(cpu);
+#if defined(BUNDY_HAVE_CPU_AFFINITY) && defined(SO_INCOMING_CPU)
+    if (setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu,
+                   sizeof(cpu)) == -1) {
+        bundy_throw(InvalidOperation, "Failed to set the incoming CPU of "
+                    "socket " << fd << ": " << std::strerror(errno));
+    }
+#else
+    bundy_throw(NotImplemented, "SO_INCOMING_CPU is not supported");
+#endif
+}
+
+} // namespace thread
+} // namespace util
+} // namespace bundy
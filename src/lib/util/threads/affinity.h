@@ -0,0 +1,86 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef BUNDY_THREAD_AFFINITY_H
+#define BUNDY_THREAD_AFFINITY_H
+
+#include <vector>
+
+#include <stddef.h>
+
+namespace bundy {
+namespace util {
+namespace thread {
+
+/// \brief Check whether threads can be bound to CPUs on this system.
+///
+/// If it returns false, \c setCurrentThreadAffinity() and
+/// \c setSocketIncomingCPU() throw \c bundy::NotImplemented.
+///
+/// \throw None
+bool isAffinitySupported();
+
+/// \brief Return the number of CPUs configured in the system.
+///
+/// The CPUs are numbered from 0 to the returned value minus 1.
+///
+/// \throw None
+size_t getCPUCount();
+
+/// \brief Bind the calling thread to a set of CPUs.
+///
+/// The thread will only be scheduled on the given CPUs from now on, so the
+/// data it works on stays in the caches of these CPUs.  The affinity of
+/// the other threads of the process isn't changed; the threads created by
+/// the calling thread afterwards inherit it.
+///
+/// \param cpus The numbers of the CPUs.  It must not be empty.
+///
+/// \throw bundy::InvalidParameter the set is empty or a CPU number is
+///     out of range.
+/// \throw bundy::InvalidOperation the system refused the set (e.g. none
+///     of the CPUs is online or allowed for the process).
+/// \throw bundy::NotImplemented not supported on this system.
+void setCurrentThreadAffinity(const std::vector<int>& cpus);
+
+/// \brief Return the CPUs the calling thread may be scheduled on.
+///
+/// The returned numbers are in the ascending order.  If the affinity is
+/// not supported on this system, all the CPUs are returned.
+///
+/// \throw bundy::InvalidOperation the system failed to return the set.
+std::vector<int> getCurrentThreadAffinity();
+
+/// \brief Hint the kernel the CPU which processes a socket.
+///
+/// This sets the \c SO_INCOMING_CPU option of the socket, so when several
+/// sockets are bound to the same address with \c SO_REUSEPORT, the
+/// packets received on the given CPU (i.e., by the RX queue whose
+/// interrupts it handles) are preferably delivered to this socket.
+/// Combined with a thread bound to the same CPU, packets are handled
+/// without being passed between CPUs.
+///
+/// \param fd The socket.
+/// \param cpu The number of the CPU.
+///
+/// \throw bundy::InvalidParameter the CPU number is out of range.
+/// \throw bundy::InvalidOperation the option couldn't be set.
+/// \throw bundy::NotImplemented not supported on this system.
+void setSocketIncomingCPU(int fd, int cpu);
+
+} // namespace thread
+} // namespace util
+} // namespace bundy
+
+#endif // BUNDY_THREAD_AFFINITY_H
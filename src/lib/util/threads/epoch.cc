@@ -0,0 +1,195 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "config.h"
+
+#include "epoch.h"
+
+#include <util/threads/sync.h>
+
+#include <atomic>
+#include <deque>
+#include <vector>
+
+namespace bundy {
+namespace util {
+namespace thread {
+
+const size_t EpochDomain::DEFAULT_RECLAIM_THRESHOLD;
+
+namespace {
+
+// The number of reader counter slots.  Threads beyond this share slots,
+// which is still correct but makes them contend.
+const size_t SLOT_COUNT = 64;
+
+// The size of a cache line on common architectures; each slot takes one
+// so readers on different threads don't bounce the same line.
+const size_t CACHE_LINE_SIZE = 64;
+
+// Source of the per-thread slot indices.
+std::atomic<size_t> next_slot(0);
+
+// The slot index of the calling thread, assigned on the first use.
+size_t
+getThreadSlot() {
+    static thread_local size_t slot = next_slot.fetch_add(1) % SLOT_COUNT;
+    return (slot);
+}
+
+struct Retired {
+    Retired(uint64_t epoch_param, const EpochDomain::Deleter& deleter_param) :
+        epoch(epoch_param), deleter(deleter_param)
+    {}
+    uint64_t epoch;
+    EpochDomain::Deleter deleter;
+};
+
+}
+
+struct EpochDomain::Impl {
+    struct alignas(CACHE_LINE_SIZE) Slot {
+        Slot() {
+            readers[0] = 0;
+            readers[1] = 0;
+        }
+        // The readers which entered in an even and odd epoch, respectively.
+        std::atomic<size_t> readers[2];
+        // The objects retired by the threads of this slot, in the order of
+        // their epochs.
+        Mutex mutex;
+        std::deque<Retired> retired;
+    };
+
+    Impl() : epoch(0), pending(0), threshold(DEFAULT_RECLAIM_THRESHOLD) {}
+
+    Slot slots[SLOT_COUNT];
+    std::atomic<uint64_t> epoch;
+    std::atomic<size_t> pending;
+    std::atomic<size_t> threshold;
+};
+
+EpochDomain::EpochDomain() :
+    impl_(new Impl)
+{}
+
+EpochDomain::~EpochDomain() {
+    for (size_t i = 0; i < SLOT_COUNT; ++i) {
+        std::deque<Retired>& retired = impl_->slots[i].retired;
+        for (std::deque<Retired>::iterator it = retired.begin();
+             it != retired.end(); ++it) {
+            it->deleter();
+        }
+    }
+    delete impl_;
+}
+
+size_t
+EpochDomain::enter() {
+    const size_t slot = getThreadSlot();
+    while (true) {
+        // Both this and tryAdvance() use sequentially consistent
+        // operations, so either the epoch hasn't changed since we counted
+        // ourselves in, or we retry with the new one.
+        const uint64_t epoch = impl_->epoch.load();
+        const size_t parity = epoch & 1;
+        impl_->slots[slot].readers[parity].fetch_add(1);
+        if (impl_->epoch.load() == epoch) {
+            return (slot * 2 + parity);
+        }
+        impl_->slots[slot].readers[parity].fetch_sub(1);
+    }
+}
+
+void
+EpochDomain::leave(size_t counter) {
+    impl_->slots[counter / 2].readers[counter % 2].fetch_sub(
+        1, std::memory_order_release);
+}
+
+bool
+EpochDomain::tryAdvance() {
+    uint64_t epoch = impl_->epoch.load();
+    // The readers of the previous epoch have the other parity.
+    const size_t parity = (epoch + 1) & 1;
+    for (size_t i = 0; i < SLOT_COUNT; ++i) {
+        if (impl_->slots[i].readers[parity].load() != 0) {
+            return (false);
+        }
+    }
+    // If it fails, someone else has advanced it, which is just as good.
+    impl_->epoch.compare_exchange_strong(epoch, epoch + 1);
+    return (true);
+}
+
+void
+EpochDomain::retire(const Deleter& deleter) {
+    Impl::Slot& slot = impl_->slots[getThreadSlot()];
+    {
+        // The epoch is read under the lock, so each list is ordered.
+        Mutex::Locker locker(slot.mutex);
+        slot.retired.push_back(Retired(impl_->epoch.load(), deleter));
+    }
+    const size_t threshold = impl_->threshold.load(std::memory_order_relaxed);
+    if (impl_->pending.fetch_add(1) + 1 >= threshold && threshold > 0) {
+        reclaim();
+    }
+}
+
+size_t
+EpochDomain::reclaim() {
+    // Objects retired in the current epoch need two advances.
+    if (tryAdvance()) {
+        tryAdvance();
+    }
+    const uint64_t epoch = impl_->epoch.load();
+
+    std::vector<Deleter> ready;
+    for (size_t i = 0; i < SLOT_COUNT; ++i) {
+        Impl::Slot& slot = impl_->slots[i];
+        Mutex::Locker locker(slot.mutex);
+        while (!slot.retired.empty() &&
+               slot.retired.front().epoch + 2 <= epoch) {
+            ready.push_back(slot.retired.front().deleter);
+            slot.retired.pop_front();
+        }
+    }
+    impl_->pending.fetch_sub(ready.size());
+
+    // Run the deleters without holding any lock, so they may retire more.
+    for (std::vector<Deleter>::iterator it = ready.begin(); it != ready.end();
+         ++it) {
+        (*it)();
+    }
+    return (ready.size());
+}
+
+void
+EpochDomain::setReclaimThreshold(size_t threshold) {
+    impl_->threshold.store(threshold);
+}
+
+uint64_t
+EpochDomain::getEpoch() const {
+    return (impl_->epoch.load());
+}
+
+size_t
+EpochDomain::getPendingCount() const {
+    return (impl_->pending.load());
+}
+
+} // namespace thread
+} // namespace util
+} // namespace bundy
@@ -0,0 +1,162 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef BUNDY_THREAD_EPOCH_H
+#define BUNDY_THREAD_EPOCH_H
+
+#include <boost/bind.hpp>
+#include <boost/checked_delete.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <cstdlib> // for size_t
+
+#include <stdint.h>
+
+namespace bundy {
+namespace util {
+namespace thread {
+
+/// \brief Epoch-based reclamation of shared data.
+///
+/// This class lets readers use shared data structures without locking or
+/// reference counting, while writers replace parts of them and defer the
+/// destruction of the old versions until no reader can hold them any more.
+///
+/// Readers enclose each access in a \c Guard.  Entering and leaving a guard
+/// only increments and decrements a counter of the reader's thread (the
+/// counters are spread over multiple cache lines like those of \c RCU),
+/// so readers on different threads don't contend with each other.
+///
+/// A writer first unpublishes an object (e.g., by atomically swapping a
+/// pointer to a new version) and then passes it to \c retire() (or
+/// \c retireObject()).  Retired objects are kept in lists tagged with the
+/// global epoch at the time of retirement.  The epoch is advanced once
+/// all the guards entered in the previous epoch have been left; an object
+/// retired in epoch \c e is destroyed once the epoch reaches \c e + 2,
+/// as no guard can be active since before its retirement then.
+///
+/// Unlike \c RCU::synchronize(), nothing here ever waits for readers:
+/// retired objects are destroyed later by \c reclaim().  It is called
+/// from \c retire() when enough objects are pending, and should also be
+/// called regularly by a thread at a quiescent point, for example from a
+/// periodic timer of its event loop, so the objects retired last don't
+/// linger.  The deleters are run by the thread calling \c reclaim().
+///
+/// \note Guards must not be nested within the same thread; a nested guard
+/// is harmless for correctness but delays the reclamation.  Guards should
+/// be short (like processing a single query) for the same reason.
+class EpochDomain : boost::noncopyable {
+public:
+    /// \brief Functor destroying a retired object.
+    ///
+    /// It must not throw.
+    typedef boost::function<void()> Deleter;
+
+    /// \brief Default number of pending objects triggering a reclamation.
+    static const size_t DEFAULT_RECLAIM_THRESHOLD = 64;
+
+    /// \brief Constructor.
+    ///
+    /// \throw std::bad_alloc memory allocation failure.
+    EpochDomain();
+
+    /// \brief Destructor.
+    ///
+    /// Destroys all the objects still pending.  There must be no active
+    /// guard when it's destroyed.
+    ~EpochDomain();
+
+    /// \brief Read-side critical section.
+    ///
+    /// Objects reachable from the shared data when the guard was created
+    /// are not destroyed during the lifetime of this object.  It never
+    /// blocks.
+    class Guard : boost::noncopyable {
+    public:
+        /// \brief Enter the critical section.
+        ///
+        /// \throw None
+        explicit Guard(EpochDomain& domain) :
+            domain_(domain), counter_(domain.enter())
+        {}
+
+        /// \brief Leave the critical section.
+        ~Guard() {
+            domain_.leave(counter_);
+        }
+    private:
+        EpochDomain& domain_;
+        const size_t counter_;
+    };
+
+    /// \brief Defer the destruction of an unpublished object.
+    ///
+    /// The object must have been made unreachable for new readers before
+    /// this call.  It can be called from any thread, including from
+    /// within a guard.
+    ///
+    /// \param deleter Functor destroying the object.
+    ///
+    /// \throw std::bad_alloc memory allocation failure (the deleter
+    ///     isn't called then).
+    void retire(const Deleter& deleter);
+
+    /// \brief Defer the deletion of an unpublished object.
+    ///
+    /// A shortcut of \c retire() with a deleter deleting the object.
+    template <typename T>
+    void retireObject(T* object) {
+        retire(boost::bind(&boost::checked_delete<T>, object));
+    }
+
+    /// \brief Destroy the retired objects which are no longer reachable.
+    ///
+    /// It tries to advance the epoch and runs the deleters of the objects
+    /// retired early enough.  It never blocks on readers.
+    ///
+    /// \return The number of objects destroyed.
+    /// \throw bundy::InvalidOperation an error on an internal mutex.
+    size_t reclaim();
+
+    /// \brief Set the number of pending objects at which \c retire()
+    /// calls \c reclaim().
+    ///
+    /// 0 disables the automatic reclamation.
+    void setReclaimThreshold(size_t threshold);
+
+    /// \brief Return the current global epoch.
+    uint64_t getEpoch() const;
+
+    /// \brief Return the number of retired objects not destroyed yet.
+    size_t getPendingCount() const;
+
+private:
+    size_t enter();
+    void leave(size_t counter);
+    bool tryAdvance();
+
+    struct Impl;
+    Impl* impl_;
+};
+
+} // namespace thread
+} // namespace util
+} // namespace bundy
+
+#endif // BUNDY_THREAD_EPOCH_H
+
+// Local Variables:
+// mode: c++
+// End:
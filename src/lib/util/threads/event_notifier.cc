@@ -0,0 +1,127 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <util/threads/event_notifier.h>
+
+#include <exceptions/exceptions.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+namespace bundy {
+namespace util {
+namespace thread {
+
+namespace {
+
+#ifndef __linux__
+void
+setNonBlocking(int fd) {
+    const int flags = fcntl(fd, F_GETFL);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1 ||
+        fcntl(fd, F_SETFD, FD_CLOEXEC) == -1) {
+        bundy_throw(Unexpected, "Failed to set up a notifier pipe: " <<
+                    std::strerror(errno));
+    }
+}
+#endif
+
+}
+
+EventNotifier::EventNotifier() :
+    read_fd_(-1), write_fd_(-1)
+{
+#ifdef __linux__
+    read_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (read_fd_ == -1) {
+        bundy_throw(Unexpected, "Failed to create an eventfd: " <<
+                    std::strerror(errno));
+    }
+    write_fd_ = read_fd_;
+#else
+    int fds[2];
+    if (pipe(fds) == -1) {
+        bundy_throw(Unexpected, "Failed to create a notifier pipe: " <<
+                    std::strerror(errno));
+    }
+    read_fd_ = fds[0];
+    write_fd_ = fds[1];
+    try {
+        setNonBlocking(read_fd_);
+        setNonBlocking(write_fd_);
+    } catch (...) {
+        close(read_fd_);
+        close(write_fd_);
+        throw;
+    }
+#endif
+}
+
+EventNotifier::~EventNotifier() {
+    close(read_fd_);
+    if (write_fd_ != read_fd_) {
+        close(write_fd_);
+    }
+}
+
+void
+EventNotifier::notify() {
+    // If the write would block, the counter or the pipe is full, which
+    // means there is a pending notification anyway.
+#ifdef __linux__
+    const uint64_t one = 1;
+    while (write(write_fd_, &one, sizeof(one)) == -1 && errno == EINTR) {
+    }
+#else
+    const char one = 1;
+    while (write(write_fd_, &one, sizeof(one)) == -1 && errno == EINTR) {
+    }
+#endif
+}
+
+bool
+EventNotifier::clear() {
+    bool notified = false;
+#ifdef __linux__
+    // A single read resets the counter.
+    uint64_t count;
+    ssize_t result;
+    while ((result = read(read_fd_, &count, sizeof(count))) == -1 &&
+           errno == EINTR) {
+    }
+    notified = (result == sizeof(count));
+#else
+    char buf[256];
+    ssize_t result;
+    while ((result = read(read_fd_, buf, sizeof(buf))) > 0 ||
+           (result == -1 && errno == EINTR)) {
+        if (result > 0) {
+            notified = true;
+        }
+    }
+#endif
+    return (notified);
+}
+
+} // namespace thread
+} // namespace util
+} // namespace bundy
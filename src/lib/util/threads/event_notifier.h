@@ -0,0 +1,85 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef BUNDY_THREAD_EVENT_NOTIFIER_H
+#define BUNDY_THREAD_EVENT_NOTIFIER_H
+
+#include <boost/noncopyable.hpp>
+
+namespace bundy {
+namespace util {
+namespace thread {
+
+/// \brief Wake-up signal between threads through a file descriptor.
+///
+/// Any thread can \c notify() the notifier; this makes its descriptor
+/// readable until the waiting thread calls \c clear().  The waiting thread
+/// can therefore watch the descriptor in its event loop (for example with
+/// \c bundy::asiolink::FDWatcher) along with its sockets, and needs no
+/// condition variable.  Multiple notifications before a \c clear() are
+/// merged into one.
+///
+/// It's typically combined with the queues of \c ring_queue.h: the
+/// producer pushes an item and calls \c notify(); when the descriptor is
+/// readable the consumer calls \c clear() and then pops all the items.
+/// Clearing first ensures that an item pushed while the consumer is
+/// popping is followed by a new notification.
+///
+/// It uses an eventfd on Linux, and a non-blocking pipe elsewhere.
+class EventNotifier : boost::noncopyable {
+public:
+    /// \brief Constructor.
+    ///
+    /// \throw bundy::Unexpected the descriptor couldn't be created.
+    EventNotifier();
+
+    /// \brief Destructor.
+    ///
+    /// Closes the descriptor(s).
+    ~EventNotifier();
+
+    /// \brief Return the descriptor to watch for readability.
+    int getFD() const { return (read_fd_); }
+
+    /// \brief Wake up the waiting thread.
+    ///
+    /// It can be called from any thread, and never blocks.
+    ///
+    /// \throw None
+    void notify();
+
+    /// \brief Acknowledge the notifications.
+    ///
+    /// The descriptor isn't readable after this until the next
+    /// \c notify().  It never blocks.
+    ///
+    /// \throw None
+    /// \return true if there was any notification, false otherwise.
+    bool clear();
+
+private:
+    int read_fd_;
+    // The same as read_fd_ in the eventfd case.
+    int write_fd_;
+};
+
+} // namespace thread
+} // namespace util
+} // namespace bundy
+
+#endif // BUNDY_THREAD_EVENT_NOTIFIER_H
+
+// Local Variables:
+// mode: c++
+// End:
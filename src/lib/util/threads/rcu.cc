@@ -0,0 +1,117 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "config.h"
+
+#include "rcu.h"
+
+#include <atomic>
+
+#include <sched.h>
+
+namespace bundy {
+namespace util {
+namespace thread {
+
+namespace {
+
+// The number of reader counters.  Threads beyond this share counters,
+// which is still correct but makes them contend.
+const size_t SLOT_COUNT = 64;
+
+// The size of a cache line on common architectures; each counter takes one
+// so readers on different threads don't bounce the same line.
+const size_t CACHE_LINE_SIZE = 64;
+
+// Source of the per-thread counter indices.
+std::atomic<size_t> next_slot(0);
+
+// The counter index of the calling thread, assigned on the first use.
+size_t
+getThreadSlot() {
+    static thread_local size_t slot = next_slot.fetch_add(1) % SLOT_COUNT;
+    return (slot);
+}
+
+}
+
+struct RCU::Impl {
+    struct alignas(CACHE_LINE_SIZE) Slot {
+        Slot() : readers(0) {}
+        std::atomic<size_t> readers;
+    };
+
+    Impl() : exclusive(false) {}
+
+    Slot slots[SLOT_COUNT];
+    std::atomic<bool> exclusive;
+};
+
+RCU::RCU() :
+    impl_(new Impl)
+{}
+
+RCU::~RCU() {
+    delete impl_;
+}
+
+size_t
+RCU::readLock() {
+    const size_t slot = getThreadSlot();
+    std::atomic<size_t>& readers = impl_->slots[slot].readers;
+    while (true) {
+        // Both this and the writer use sequentially consistent operations,
+        // so either the writer sees our counter or we see its flag.
+        readers.fetch_add(1);
+        if (!impl_->exclusive.load()) {
+            return (slot);
+        }
+        // A writer is (about to be) active.  Back off and wait until it
+        // releases the mutex, then try again.
+        readers.fetch_sub(1);
+        Mutex::Locker locker(writer_mutex_);
+    }
+}
+
+void
+RCU::readUnlock(size_t slot) {
+    impl_->slots[slot].readers.fetch_sub(1, std::memory_order_release);
+}
+
+void
+RCU::blockReaders() {
+    impl_->exclusive.store(true);
+    for (size_t i = 0; i < SLOT_COUNT; ++i) {
+        while (impl_->slots[i].readers.load() != 0) {
+            sched_yield();
+        }
+    }
+}
+
+void
+RCU::unblockReaders() {
+    impl_->exclusive.store(false);
+}
+
+void
+RCU::synchronize() {
+    // New readers can only see what has been published, so waiting for
+    // all readers to leave (blocking new ones in the meantime for
+    // simplicity) is enough for a grace period.
+    ExclusiveLocker locker(*this);
+}
+
+} // namespace thread
+} // namespace util
+} // namespace bundy
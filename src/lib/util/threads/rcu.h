@@ -0,0 +1,144 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef BUNDY_THREAD_RCU_H
+#define BUNDY_THREAD_RCU_H
+
+#include <util/threads/sync.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <cstdlib> // for size_t
+
+namespace bundy {
+namespace util {
+namespace thread {
+
+/// \brief Read-mostly synchronization in the style of read-copy-update.
+///
+/// This class lets any number of reader threads access shared data
+/// without locking, while a (rare) writer thread replaces or updates it.
+///
+/// Readers enclose each access in a read-side critical section by
+/// creating a \c ReadLocker.  As long as no writer is active this only
+/// increments and decrements a counter; the counters are spread over
+/// multiple cache lines, so readers running on different threads
+/// normally don't contend with each other either.
+///
+/// Writers have two ways to make an update safe:
+/// - Publish a new version of the data (e.g., by atomically swapping a
+///   pointer) and then call \c synchronize() before reclaiming the old
+///   version.  \c synchronize() returns only after all readers that
+///   could have seen the old version have left their critical sections.
+/// - Modify the data in place within the scope of an \c ExclusiveLocker.
+///   It blocks new readers and waits for the current ones to leave, so
+///   the writer has exclusive access until it's destroyed.
+///
+/// Writers are serialized with each other, but a writer never waits for
+/// more than the read-side critical sections that are active at the time,
+/// so those are expected to be short (like processing a single query).
+///
+/// \note Read-side critical sections must not be nested, and a thread
+/// must not start a writer operation while it's in a read-side critical
+/// section; either would deadlock once a writer is waiting.
+class RCU : boost::noncopyable {
+public:
+    /// \brief Constructor.
+    ///
+    /// \throw std::bad_alloc memory allocation failure.
+    RCU();
+
+    /// \brief Destructor.
+    ///
+    /// There must be no readers or writers when it's destroyed.
+    ~RCU();
+
+    /// \brief Read-side critical section.
+    ///
+    /// The shared data can be safely used during the lifetime of this
+    /// object.  It normally doesn't block; it only waits if a writer
+    /// holds an \c ExclusiveLocker.
+    class ReadLocker : boost::noncopyable {
+    public:
+        /// \brief Enter the read-side critical section.
+        ///
+        /// \throw None
+        explicit ReadLocker(RCU& rcu) :
+            rcu_(rcu), slot_(rcu.readLock())
+        {}
+
+        /// \brief Leave the read-side critical section.
+        ~ReadLocker() {
+            rcu_.readUnlock(slot_);
+        }
+    private:
+        RCU& rcu_;
+        const size_t slot_;
+    };
+
+    /// \brief Exclusive access for writers.
+    ///
+    /// During the lifetime of this object no reader is in its critical
+    /// section, so the shared data can be modified in place.
+    class ExclusiveLocker : boost::noncopyable {
+    public:
+        /// \brief Block new readers and wait for the current ones.
+        ///
+        /// \throw bundy::InvalidOperation an error on the internal mutex.
+        explicit ExclusiveLocker(RCU& rcu) :
+            rcu_(rcu), locker_(rcu.writer_mutex_)
+        {
+            rcu_.blockReaders();
+        }
+
+        /// \brief Let readers in again.
+        ~ExclusiveLocker() {
+            rcu_.unblockReaders();
+        }
+    private:
+        RCU& rcu_;
+        Mutex::Locker locker_;
+    };
+
+    /// \brief Wait for a grace period.
+    ///
+    /// It returns once all the readers that were in their critical
+    /// sections at the time of the call have left them, so anything the
+    /// writer unpublished before the call can be safely reclaimed.
+    ///
+    /// \throw bundy::InvalidOperation an error on the internal mutex.
+    void synchronize();
+
+private:
+    size_t readLock();
+    void readUnlock(size_t slot);
+    void blockReaders();
+    void unblockReaders();
+
+    // Held by the writer; readers that see the writer active wait on it.
+    Mutex writer_mutex_;
+
+    struct Impl;
+    Impl* impl_;
+};
+
+} // namespace thread
+} // namespace util
+} // namespace bundy
+
+#endif // BUNDY_THREAD_RCU_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -0,0 +1,259 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef BUNDY_THREAD_RING_QUEUE_H
+#define BUNDY_THREAD_RING_QUEUE_H
+
+#include <exceptions/exceptions.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_array.hpp>
+
+#include <atomic>
+#include <cstdlib> // for size_t
+
+#include <stdint.h>
+
+namespace bundy {
+namespace util {
+namespace thread {
+
+namespace detail {
+
+/// \brief The size of a cache line on common architectures.
+///
+/// The producer and consumer positions of the queues are kept on separate
+/// lines, so the threads don't bounce the same line on every operation.
+const size_t RING_CACHE_LINE_SIZE = 64;
+
+/// \brief Return the smallest power of 2 not smaller than \c capacity.
+///
+/// \throw bundy::InvalidParameter the capacity is 0 or too large.
+inline size_t
+getRingSize(size_t capacity) {
+    if (capacity == 0 || capacity > (static_cast<size_t>(1) << 30)) {
+        bundy_throw(InvalidParameter, "Invalid queue capacity: " << capacity);
+    }
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    return (size);
+}
+
+} // namespace detail
+
+/// \brief Bounded lock-free queue for a single producer and consumer.
+///
+/// One thread pushes items to the queue and another one pops them, without
+/// any lock or system call.  The capacity is fixed on construction; when
+/// the queue is full, \c push() fails and it's up to the producer to drop
+/// the item or retry later.
+///
+/// The queue doesn't block the consumer when it's empty.  If the consumer
+/// needs to wait for items, the producer would signal it through an
+/// \c EventNotifier after pushing, and the consumer would clear the
+/// notifier before popping all the items available (so an item pushed in
+/// between is not missed).
+///
+/// \c T must be default constructible and assignable.  A popped slot is
+/// reset to a default constructed value, so resources held by the item
+/// (e.g., a shared pointer) are released when it's popped.
+///
+/// \note Calling \c push() from more than one thread at a time, or
+/// \c pop() from more than one thread at a time, is not safe.  Use
+/// \c MPSCQueue if there are multiple producers.
+template <typename T>
+class SPSCQueue : boost::noncopyable {
+public:
+    /// \brief Constructor.
+    ///
+    /// \param capacity The minimum number of items the queue can hold.
+    ///     It's rounded up to a power of 2.
+    ///
+    /// \throw bundy::InvalidParameter the capacity is 0 or too large.
+    /// \throw std::bad_alloc memory allocation failure.
+    explicit SPSCQueue(size_t capacity) :
+        mask_(detail::getRingSize(capacity) - 1),
+        items_(new T[mask_ + 1]), head_(0), tail_(0)
+    {}
+
+    /// \brief Return the number of items the queue can hold.
+    size_t getCapacity() const { return (mask_ + 1); }
+
+    /// \brief Add an item to the back of the queue (producer only).
+    ///
+    /// \return true if the item was added, false if the queue was full.
+    bool push(const T& item) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) > mask_) {
+            return (false);
+        }
+        items_[tail & mask_] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return (true);
+    }
+
+    /// \brief Remove the item at the front of the queue (consumer only).
+    ///
+    /// \param item Set to the removed item.  It's intact if the queue
+    ///     was empty.
+    /// \return true if an item was removed, false if the queue was empty.
+    bool pop(T& item) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return (false);
+        }
+        T& slot = items_[head & mask_];
+        item = slot;
+        slot = T();
+        head_.store(head + 1, std::memory_order_release);
+        return (true);
+    }
+
+    /// \brief Return whether the queue is empty.
+    ///
+    /// The result is only a snapshot if the other thread is active.
+    bool empty() const {
+        return (head_.load(std::memory_order_acquire) ==
+                tail_.load(std::memory_order_acquire));
+    }
+
+private:
+    const size_t mask_;
+    boost::scoped_array<T> items_;
+    // Position of the next item to pop; written by the consumer.
+    alignas(detail::RING_CACHE_LINE_SIZE) std::atomic<size_t> head_;
+    // Position of the next item to push; written by the producer.
+    alignas(detail::RING_CACHE_LINE_SIZE) std::atomic<size_t> tail_;
+};
+
+/// \brief Bounded lock-free queue for multiple producers and one consumer.
+///
+/// Like \c SPSCQueue, but any number of threads may push items
+/// concurrently.  Each slot of the ring has a sequence number telling
+/// whether it's free for the producer at a given position or filled for
+/// the consumer, so producers only compete on a compare-and-swap of the
+/// tail position and never wait for each other to finish copying an item.
+///
+/// \c T must be default constructible and assignable.
+///
+/// \note Calling \c pop() from more than one thread at a time is not safe.
+template <typename T>
+class MPSCQueue : boost::noncopyable {
+public:
+    /// \brief Constructor.
+    ///
+    /// \param capacity The minimum number of items the queue can hold.
+    ///     It's rounded up to a power of 2.
+    ///
+    /// \throw bundy::InvalidParameter the capacity is 0 or too large.
+    /// \throw std::bad_alloc memory allocation failure.
+    explicit MPSCQueue(size_t capacity) :
+        mask_(detail::getRingSize(capacity) - 1),
+        cells_(new Cell[mask_ + 1]), head_(0), tail_(0)
+    {
+        for (size_t i = 0; i <= mask_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /// \brief Return the number of items the queue can hold.
+    size_t getCapacity() const { return (mask_ + 1); }
+
+    /// \brief Add an item to the back of the queue (any thread).
+    ///
+    /// \return true if the item was added, false if the queue was full.
+    bool push(const T& item) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            const size_t sequence =
+                cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(sequence) -
+                static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                // The slot is free; claim it.  On failure pos is updated
+                // to the current tail.
+                if (tail_.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // The slot still holds the item of the previous round.
+                return (false);
+            } else {
+                // Another producer took this position.
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->item = item;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return (true);
+    }
+
+    /// \brief Remove the item at the front of the queue (consumer only).
+    ///
+    /// An item whose producer is still copying it is not available yet,
+    /// so this may return false while a \c push() is in progress even if
+    /// the queue isn't empty.
+    ///
+    /// \param item Set to the removed item.  It's intact if no item was
+    ///     removed.
+    /// \return true if an item was removed, false otherwise.
+    bool pop(T& item) {
+        const size_t pos = head_.load(std::memory_order_relaxed);
+        Cell& cell = cells_[pos & mask_];
+        if (cell.sequence.load(std::memory_order_acquire) != pos + 1) {
+            return (false);
+        }
+        item = cell.item;
+        cell.item = T();
+        cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+        head_.store(pos + 1, std::memory_order_relaxed);
+        return (true);
+    }
+
+    /// \brief Return whether the queue is empty.
+    ///
+    /// The result is only a snapshot if other threads are active.
+    bool empty() const {
+        return (head_.load(std::memory_order_acquire) ==
+                tail_.load(std::memory_order_acquire));
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T item;
+    };
+
+    const size_t mask_;
+    boost::scoped_array<Cell> cells_;
+    // Position of the next item to pop; written by the consumer.
+    alignas(detail::RING_CACHE_LINE_SIZE) std::atomic<size_t> head_;
+    // Position of the next slot to claim; written by the producers.
+    alignas(detail::RING_CACHE_LINE_SIZE) std::atomic<size_t> tail_;
+};
+
+} // namespace thread
+} // namespace util
+} // namespace bundy
+
+#endif // BUNDY_THREAD_RING_QUEUE_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -0,0 +1,93 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <util/threads/affinity.h>
+#include <util/threads/thread.h>
+
+#include <exceptions/exceptions.h>
+
+#include <boost/bind.hpp>
+
+#include <gtest/gtest.h>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace bundy::util::thread;
+using std::vector;
+
+namespace {
+
+TEST(AffinityTest, getCPUCount) {
+    EXPECT_LE(1, getCPUCount());
+}
+
+// Bind the thread to the first CPU it's allowed to run on and store the
+// resulting affinity.
+void
+pinToFirst(vector<int>* result) {
+    const vector<int> allowed = getCurrentThreadAffinity();
+    ASSERT_FALSE(allowed.empty());
+    setCurrentThreadAffinity(vector<int>(1, allowed.front()));
+    *result = getCurrentThreadAffinity();
+}
+
+// The affinity is set for the calling thread only.  We do it in a separate
+// thread, so the other tests are not affected.
+TEST(AffinityTest, setAffinity) {
+    if (!isAffinitySupported()) {
+        return;
+    }
+    const vector<int> original = getCurrentThreadAffinity();
+    ASSERT_FALSE(original.empty());
+
+    vector<int> pinned;
+    Thread thread(boost::bind(pinToFirst, &pinned));
+    thread.wait();
+    ASSERT_EQ(1, pinned.size());
+    EXPECT_EQ(original.front(), pinned.front());
+
+    // This thread is intact.
+    EXPECT_EQ(original, getCurrentThreadAffinity());
+}
+
+TEST(AffinityTest, badAffinity) {
+    EXPECT_THROW(setCurrentThreadAffinity(vector<int>()),
+                 bundy::InvalidParameter);
+    EXPECT_THROW(setCurrentThreadAffinity(vector<int>(1, -1)),
+                 bundy::InvalidParameter);
+    if (isAffinitySupported()) {
+        EXPECT_THROW(setCurrentThreadAffinity(vector<int>(1, 1000000)),
+                     bundy::InvalidParameter);
+    } else {
+        EXPECT_THROW(setCurrentThreadAffinity(vector<int>(1, 0)),
+                     bundy::NotImplemented);
+    }
+}
+
+TEST(AffinityTest, socketIncomingCPU) {
+    const int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    ASSERT_NE(-1, fd);
+    EXPECT_THROW(setSocketIncomingCPU(fd, -1), bundy::InvalidParameter);
+    try {
+        setSocketIncomingCPU(fd, 0);
+    } catch (const bundy::NotImplemented&) {
+        // Old kernel headers, nothing more to check.
+    }
+    close(fd);
+    EXPECT_THROW(setSocketIncomingCPU(fd, 0), bundy::Exception);
+}
+
+}
@@ -0,0 +1,203 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <util/threads/epoch.h>
+#include <util/threads/thread.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <atomic>
+#include <vector>
+
+#include <sched.h>
+
+using namespace bundy::util::thread;
+
+namespace {
+
+void
+countDeleted(size_t* count) {
+    ++*count;
+}
+
+// An object recording its destruction.
+class Tracked {
+public:
+    Tracked(size_t* count) : count_(count) {}
+    ~Tracked() { ++*count_; }
+private:
+    size_t* count_;
+};
+
+TEST(EpochTest, noReaders) {
+    EpochDomain domain;
+    size_t deleted = 0;
+    const uint64_t epoch = domain.getEpoch();
+    domain.retire(boost::bind(countDeleted, &deleted));
+    EXPECT_EQ(1, domain.getPendingCount());
+    EXPECT_EQ(0, deleted);
+
+    // Without readers the epoch moves on immediately.
+    EXPECT_EQ(1, domain.reclaim());
+    EXPECT_EQ(1, deleted);
+    EXPECT_EQ(0, domain.getPendingCount());
+    EXPECT_LE(epoch + 2, domain.getEpoch());
+    EXPECT_EQ(0, domain.reclaim());
+
+    domain.retireObject(new Tracked(&deleted));
+    EXPECT_EQ(1, domain.reclaim());
+    EXPECT_EQ(2, deleted);
+}
+
+TEST(EpochTest, guard) {
+    EpochDomain domain;
+    size_t deleted = 0;
+    {
+        // An object can't be destroyed while a guard older than its
+        // retirement is active.
+        EpochDomain::Guard guard(domain);
+        domain.retire(boost::bind(countDeleted, &deleted));
+        EXPECT_EQ(0, domain.reclaim());
+        EXPECT_EQ(0, domain.reclaim());
+        EXPECT_EQ(0, deleted);
+    }
+    EXPECT_EQ(1, domain.reclaim());
+    EXPECT_EQ(1, deleted);
+
+    // Objects retired before the guard was created can go once the epoch
+    // has passed them.
+    domain.retire(boost::bind(countDeleted, &deleted));
+    const uint64_t epoch = domain.getEpoch();
+    while (domain.getEpoch() < epoch + 2) {
+        EpochDomain::Guard guard(domain);
+        domain.reclaim();
+    }
+    EXPECT_EQ(2, deleted);
+}
+
+void
+runReclaim(EpochDomain* domain, size_t* reclaimed) {
+    *reclaimed = domain->reclaim();
+}
+
+// Guards of other threads block the reclamation too.
+TEST(EpochTest, otherThread) {
+    EpochDomain domain;
+    size_t deleted = 0;
+    size_t reclaimed = 1;
+    EpochDomain::Guard* guard = new EpochDomain::Guard(domain);
+    domain.retire(boost::bind(countDeleted, &deleted));
+    Thread thread(boost::bind(runReclaim, &domain, &reclaimed));
+    thread.wait();
+    EXPECT_EQ(0, reclaimed);
+    EXPECT_EQ(0, deleted);
+    delete guard;
+    EXPECT_EQ(1, domain.reclaim());
+}
+
+TEST(EpochTest, threshold) {
+    EpochDomain domain;
+    size_t deleted = 0;
+    domain.setReclaimThreshold(3);
+    domain.retire(boost::bind(countDeleted, &deleted));
+    domain.retire(boost::bind(countDeleted, &deleted));
+    EXPECT_EQ(0, deleted);
+    // The third one triggers the reclamation.
+    domain.retire(boost::bind(countDeleted, &deleted));
+    EXPECT_EQ(3, deleted);
+    EXPECT_EQ(0, domain.getPendingCount());
+
+    domain.setReclaimThreshold(0);
+    for (int i = 0; i < 10; ++i) {
+        domain.retire(boost::bind(countDeleted, &deleted));
+    }
+    EXPECT_EQ(3, deleted);
+    EXPECT_EQ(10, domain.getPendingCount());
+}
+
+// Whatever is still pending is destroyed with the domain.
+TEST(EpochTest, destroy) {
+    size_t deleted = 0;
+    {
+        EpochDomain domain;
+        domain.setReclaimThreshold(0);
+        domain.retireObject(new Tracked(&deleted));
+        domain.retireObject(new Tracked(&deleted));
+        EXPECT_EQ(0, deleted);
+    }
+    EXPECT_EQ(2, deleted);
+}
+
+// A version of shared data.  Retired versions are marked dead instead of
+// being freed, so a reader seeing one is detected safely.
+struct Version {
+    Version() : alive(true) {}
+    std::atomic<bool> alive;
+};
+
+void
+killVersion(Version* version) {
+    version->alive = false;
+}
+
+void
+readVersions(EpochDomain* domain, std::atomic<Version*>* current,
+             std::atomic<bool>* stop, std::atomic<size_t>* errors)
+{
+    while (!*stop) {
+        EpochDomain::Guard guard(*domain);
+        Version* version = current->load();
+        sched_yield();
+        if (!version->alive) {
+            ++*errors;
+        }
+    }
+}
+
+TEST(EpochTest, concurrent) {
+    EpochDomain domain;
+    domain.setReclaimThreshold(4);
+    std::vector<boost::shared_ptr<Version> > versions;
+    versions.push_back(boost::shared_ptr<Version>(new Version));
+    std::atomic<Version*> current(versions.back().get());
+    std::atomic<bool> stop(false);
+    std::atomic<size_t> errors(0);
+
+    std::vector<boost::shared_ptr<Thread> > readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.push_back(boost::shared_ptr<Thread>(
+            new Thread(boost::bind(readVersions, &domain, &current, &stop,
+                                   &errors))));
+    }
+    for (int i = 0; i < 1000; ++i) {
+        versions.push_back(boost::shared_ptr<Version>(new Version));
+        Version* old = current.exchange(versions.back().get());
+        domain.retire(boost::bind(killVersion, old));
+        sched_yield();
+    }
+    stop = true;
+    for (size_t i = 0; i < readers.size(); ++i) {
+        readers[i]->wait();
+    }
+    EXPECT_EQ(0, errors);
+    domain.reclaim();
+    EXPECT_EQ(0, domain.getPendingCount());
+}
+
+}
@@ -0,0 +1,70 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+
+#include <util/threads/event_notifier.h>
+#include <util/threads/thread.h>
+
+#include <boost/bind.hpp>
+
+#include <gtest/gtest.h>
+
+#include <poll.h>
+
+using namespace bundy::util::thread;
+
+namespace {
+
+// Check whether the descriptor is readable within the timeout (in ms).
+bool
+isReadable(int fd, int timeout) {
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    return (poll(&pfd, 1, timeout) == 1 && (pfd.revents & POLLIN) != 0);
+}
+
+TEST(EventNotifierTest, notify) {
+    EventNotifier notifier;
+    EXPECT_LE(0, notifier.getFD());
+    EXPECT_FALSE(isReadable(notifier.getFD(), 0));
+    EXPECT_FALSE(notifier.clear());
+
+    // Notifications are merged until cleared.
+    notifier.notify();
+    notifier.notify();
+    EXPECT_TRUE(isReadable(notifier.getFD(), 0));
+    EXPECT_TRUE(notifier.clear());
+    EXPECT_FALSE(isReadable(notifier.getFD(), 0));
+    EXPECT_FALSE(notifier.clear());
+}
+
+// Many notifications don't block the notifying thread.
+TEST(EventNotifierTest, manyNotifications) {
+    EventNotifier notifier;
+    for (int i = 0; i < 100000; ++i) {
+        notifier.notify();
+    }
+    EXPECT_TRUE(notifier.clear());
+    EXPECT_FALSE(isReadable(notifier.getFD(), 0));
+}
+
+// Another thread wakes up a thread waiting on the descriptor.
+TEST(EventNotifierTest, otherThread) {
+    EventNotifier notifier;
+    Thread thread(boost::bind(&EventNotifier::notify, &notifier));
+    EXPECT_TRUE(isReadable(notifier.getFD(), 5000));
+    thread.wait();
+    EXPECT_TRUE(notifier.clear());
+}
+
+}
@@ -0,0 +1,99 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <util/threads/rcu.h>
+#include <util/threads/thread.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <atomic>
+
+#include <unistd.h>
+
+using namespace bundy::util::thread;
+
+namespace {
+
+// How long (in microseconds) we wait to see a thread is blocked.  It's
+// an arbitrary choice; the tests may miss a bug if it's too short, but
+// never fail spuriously.
+const useconds_t BLOCK_WAIT = 100000;
+
+void
+runSynchronize(RCU* rcu, std::atomic<bool>* done) {
+    rcu->synchronize();
+    *done = true;
+}
+
+void
+runReader(RCU* rcu, std::atomic<bool>* done) {
+    RCU::ReadLocker locker(*rcu);
+    *done = true;
+}
+
+TEST(RCUTest, readers) {
+    RCU rcu;
+
+    // Readers don't block each other, and without readers nothing blocks
+    // writers.
+    {
+        RCU::ReadLocker locker1(rcu);
+        std::atomic<bool> done(false);
+        Thread thread(boost::bind(runReader, &rcu, &done));
+        thread.wait();
+        EXPECT_TRUE(done);
+    }
+    rcu.synchronize();
+    {
+        RCU::ExclusiveLocker locker(rcu);
+    }
+    RCU::ReadLocker locker(rcu);
+}
+
+TEST(RCUTest, synchronize) {
+    RCU rcu;
+    std::atomic<bool> done(false);
+    boost::scoped_ptr<Thread> thread;
+    {
+        // The grace period can't end while there's an old reader.
+        RCU::ReadLocker locker(rcu);
+        thread.reset(new Thread(boost::bind(runSynchronize, &rcu, &done)));
+        usleep(BLOCK_WAIT);
+        EXPECT_FALSE(done);
+    }
+    thread->wait();
+    EXPECT_TRUE(done);
+}
+
+TEST(RCUTest, exclusive) {
+    RCU rcu;
+    std::atomic<bool> done(false);
+    boost::scoped_ptr<Thread> thread;
+    {
+        // Readers are blocked while a writer has exclusive access.
+        RCU::ExclusiveLocker locker(rcu);
+        thread.reset(new Thread(boost::bind(runReader, &rcu, &done)));
+        usleep(BLOCK_WAIT);
+        EXPECT_FALSE(done);
+    }
+    thread->wait();
+    EXPECT_TRUE(done);
+}
+
+}
@@ -0,0 +1,150 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+
+#include <util/threads/ring_queue.h>
+#include <util/threads/thread.h>
+
+#include <exceptions/exceptions.h>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <sched.h>
+
+using namespace bundy::util::thread;
+
+namespace {
+
+template <typename Queue>
+class RingQueueTest : public ::testing::Test {};
+
+typedef ::testing::Types<SPSCQueue<int>, MPSCQueue<int> > QueueTypes;
+TYPED_TEST_CASE(RingQueueTest, QueueTypes);
+
+// The capacity is rounded up to a power of 2, and 0 is rejected.
+TYPED_TEST(RingQueueTest, capacity) {
+    EXPECT_EQ(1, TypeParam(1).getCapacity());
+    EXPECT_EQ(8, TypeParam(5).getCapacity());
+    EXPECT_EQ(16, TypeParam(16).getCapacity());
+    EXPECT_THROW(TypeParam queue(0), bundy::InvalidParameter);
+}
+
+// Items come out in the order they were pushed, and a full queue rejects
+// new ones.
+TYPED_TEST(RingQueueTest, pushPop) {
+    TypeParam queue(4);
+    int item = -1;
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.pop(item));
+    EXPECT_EQ(-1, item);
+
+    // Go around the ring a few times.
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 4; ++i) {
+            EXPECT_TRUE(queue.push(round * 10 + i));
+        }
+        EXPECT_FALSE(queue.push(100));
+        EXPECT_FALSE(queue.empty());
+        for (int i = 0; i < 4; ++i) {
+            ASSERT_TRUE(queue.pop(item));
+            EXPECT_EQ(round * 10 + i, item);
+        }
+        EXPECT_FALSE(queue.pop(item));
+        EXPECT_TRUE(queue.empty());
+    }
+}
+
+// Popped items don't stay referenced by the queue.
+TEST(SPSCQueueTest, release) {
+    SPSCQueue<boost::shared_ptr<int> > queue(2);
+    boost::shared_ptr<int> item(new int(1));
+    EXPECT_TRUE(queue.push(item));
+    EXPECT_EQ(2, item.use_count());
+    boost::shared_ptr<int> popped;
+    EXPECT_TRUE(queue.pop(popped));
+    popped.reset();
+    EXPECT_EQ(1, item.use_count());
+}
+
+TEST(MPSCQueueTest, release) {
+    MPSCQueue<boost::shared_ptr<int> > queue(2);
+    boost::shared_ptr<int> item(new int(1));
+    EXPECT_TRUE(queue.push(item));
+    EXPECT_EQ(2, item.use_count());
+    boost::shared_ptr<int> popped;
+    EXPECT_TRUE(queue.pop(popped));
+    popped.reset();
+    EXPECT_EQ(1, item.use_count());
+}
+
+const int ITEM_COUNT = 10000;
+
+// Push ITEM_COUNT items tagged with the producer, retrying while the queue
+// is full.
+template <typename Queue>
+void
+produce(Queue* queue, int producer) {
+    for (int i = 0; i < ITEM_COUNT; ++i) {
+        while (!queue->push(producer * ITEM_COUNT + i)) {
+            sched_yield();
+        }
+    }
+}
+
+// Consume everything the producers push, and check each producer's items
+// arrive complete and in order.
+template <typename Queue>
+void
+checkConcurrent(Queue& queue, int producer_count) {
+    std::vector<boost::shared_ptr<Thread> > producers;
+    for (int i = 0; i < producer_count; ++i) {
+        producers.push_back(boost::shared_ptr<Thread>(
+            new Thread(boost::bind(produce<Queue>, &queue, i))));
+    }
+    std::vector<int> next(producer_count, 0);
+    for (int count = 0; count < ITEM_COUNT * producer_count; ) {
+        int item;
+        if (queue.pop(item)) {
+            const int producer = item / ITEM_COUNT;
+            ASSERT_LE(0, producer);
+            ASSERT_GT(producer_count, producer);
+            ASSERT_EQ(next[producer], item % ITEM_COUNT);
+            ++next[producer];
+            ++count;
+        } else {
+            sched_yield();
+        }
+    }
+    for (int i = 0; i < producer_count; ++i) {
+        producers[i]->wait();
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(SPSCQueueTest, concurrent) {
+    SPSCQueue<int> queue(64);
+    checkConcurrent(queue, 1);
+}
+
+TEST(MPSCQueueTest, concurrent) {
+    MPSCQueue<int> queue(64);
+    checkConcurrent(queue, 4);
+}
+
+}
@@ -203,5 +203,38 @@ timeFromText32(const string& time_txt) {
     return (timeFromText64(time_txt));
 }
 
+namespace {
+#ifdef CLOCK_REALTIME_COARSE
+const clockid_t COARSE_REALTIME_CLOCK = CLOCK_REALTIME_COARSE;
+#else
+const clockid_t COARSE_REALTIME_CLOCK = CLOCK_REALTIME;
+#endif
+
+#ifdef CLOCK_MONOTONIC_COARSE
+const clockid_t COARSE_MONOTONIC_CLOCK = CLOCK_MONOTONIC_COARSE;
+#else
+const clockid_t COARSE_MONOTONIC_CLOCK = CLOCK_MONOTONIC;
+#endif
+}
+
+time_t
+CoarseClock::getTime() {
+    struct timespec now;
+    if (clock_gettime(COARSE_REALTIME_CLOCK, &now) != 0) {
+        return (time(NULL));
+    }
+    return (now.tv_sec);
+}
+
+uint64_t
+CoarseClock::getMonotonicMillis() {
+    struct timespec now;
+    if (clock_gettime(COARSE_MONOTONIC_CLOCK, &now) != 0 &&
+        clock_gettime(CLOCK_MONOTONIC, &now) != 0) {
+        return (0);
+    }
+    return (static_cast<uint64_t>(now.tv_sec) * 1000 + now.tv_nsec / 1000000);
+}
+
 }
 }
@@ -19,6 +19,7 @@
 
 #include <sys/types.h>
 #include <stdint.h>
+#include <time.h>
 
 #include <exceptions/exceptions.h>
 
@@ -163,6 +164,38 @@ std::string
 timeToText32(const uint32_t value);
 
 //@}
+
+/// \brief A cheap clock for time checks on hot paths.
+///
+/// Many operations only need the current time in seconds (e.g. to check
+/// whether a cached entry has expired) or a rough measure of elapsed time,
+/// and do it for every query or packet.  This class reads the coarse
+/// clocks maintained by the kernel (\c CLOCK_REALTIME_COARSE and
+/// \c CLOCK_MONOTONIC_COARSE), which are read from the vDSO on Linux
+/// without a system call or reading the hardware clock.  Their resolution
+/// is a kernel tick (a few milliseconds); where they aren't available the
+/// precise clocks are used instead.
+///
+/// It's not meant for time that needs to be accurate to less than a tick,
+/// such as measuring the processing time of a single packet.
+class CoarseClock {
+public:
+    /// \brief Returns the current time in seconds since epoch.
+    ///
+    /// This is a replacement of \c time(NULL).
+    ///
+    /// \throw None
+    static time_t getTime();
+
+    /// \brief Returns the monotonic time in milliseconds.
+    ///
+    /// The time is counted from an unspecified point in the past, and isn't
+    /// affected by changes of the system time, so it's only meaningful to
+    /// compare two values of it.
+    ///
+    /// \throw None
+    static uint64_t getMonotonicMillis();
+};
 }
 }
 
@@ -36,7 +36,7 @@ uBenchmark::uBenchmark(uint32_t iterations, const std::string& dbname,
                        const std::string& pass /* = "" */)
     :num_(iterations), sync_(sync), verbose_(verbose),
      hostname_(host), user_(user), passwd_(pass), dbname_(dbname),
-     hitratio_(0.9f), compiled_stmt_(true)
+     hitratio_(0.9f), compiled_stmt_(true), clients_(1)
 {
     /// @todo: make compiled statements a configurable parameter
 
@@ -60,6 +60,7 @@ void uBenchmark::usage() {
     cout << " -s yes|no - synchronous/asynchronous operation (MySQL, SQLite and memfile)" << endl;
     cout << " -v yes|no - verbose mode (MySQL, SQLite and memfile)" << endl;
     cout << " -c yes|no - compiled statements (MySQL and SQLite)" << endl;
+    cout << " -t integer - number of concurrent clients (MySQL only)" << endl;
 
     exit(EXIT_FAILURE);
 }
@@ -67,7 +68,7 @@ void uBenchmark::usage() {
 void uBenchmark::parseCmdline(int argc, char* const argv[]) {
     int ch;
 
-    while ((ch = getopt(argc, argv, "hm:u:p:f:n:s:v:c:")) != -1) {
+    while ((ch = getopt(argc, argv, "hm:u:p:f:n:s:v:c:t:")) != -1) {
         switch (ch) {
         case 'h':
             usage();
@@ -92,6 +93,19 @@ void uBenchmark::parseCmdline(int argc, char* const argv[]) {
                 usage();
             }
             break;
+        case 't':
+            try {
+                clients_ = boost::lexical_cast<unsigned int>(optarg);
+            } catch (const boost::bad_lexical_cast &) {
+                cerr << "Failed to parse number of clients (-t option):"
+                     << optarg << endl;
+                usage();
+            }
+            if (clients_ == 0) {
+                cerr << "Number of clients (-t option) must be positive" << endl;
+                usage();
+            }
+            break;
         case 'c':
             compiled_stmt_ = !strcasecmp(optarg, "yes") || !strcmp(optarg, "1");
             break;
@@ -139,6 +153,7 @@ int uBenchmark::run() {
          << "Sync/async           : " << (sync_ ? "sync" : "async") << endl
          << "Verbose              : " << (verbose_ ? "verbose" : "quiet") << endl
          << "Compiled statements  : " << (compiled_stmt_ ? "yes": "no") << endl
+         << "Concurrent clients   : " << clients_ << endl
          << "Database name        : " << dbname_ << endl
          << "MySQL hostname       : " << hostname_ << endl
          << "MySQL username       : " << user_ << endl
@@ -204,6 +204,10 @@ protected:
 
     /// should compiled statements be used?
     bool compiled_stmt_;
+
+    /// number of concurrent clients, each with its own connection
+    /// (currently supported by MySQL only)
+    uint32_t clients_;
 };
 
 #endif
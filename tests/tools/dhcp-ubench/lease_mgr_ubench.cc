@@ -0,0 +1,370 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <asiolink/io_address.h>
+#include <dhcpsrv/lease_mgr_factory.h>
+#ifdef HAVE_MYSQL
+#include <dhcpsrv/mysql_lease_mgr.h>
+#endif
+#ifdef HAVE_PGSQL
+#include <dhcpsrv/pgsql_lease_mgr.h>
+#endif
+#include <log/logger_support.h>
+
+#include "benchmark.h"
+#include "lease_mgr_ubench.h"
+
+using namespace std;
+using namespace bundy::asiolink;
+using namespace bundy::dhcp;
+
+LeaseMgr_uBenchmark::LeaseMgr_uBenchmark(const string& dbaccess,
+                                         uint32_t num_iterations, bool sync,
+                                         bool verbose)
+    :uBenchmark(num_iterations, dbaccess, sync, verbose) {
+}
+
+void LeaseMgr_uBenchmark::printInfo() {
+    cout << "Lease manager of the servers, created from the access string"
+         << endl << "\"" << dbname_ << "\"." << endl;
+}
+
+void LeaseMgr_uBenchmark::connect() {
+    try {
+        LeaseMgrFactory::create(dbname_);
+        LeaseMgr& lmptr = LeaseMgrFactory::instance();
+        mgrs_.assign(1, &lmptr);
+
+        for (uint32_t i = 1; i < clients_; ++i) {
+            // The memfile lease manager is thread-safe and shared by the
+            // clients. The database lease managers are not, so each client
+            // gets its own, with its own connection.
+            if (lmptr.getType() == "memfile") {
+                mgrs_.push_back(&lmptr);
+                continue;
+            }
+            const LeaseMgr::ParameterMap parameters =
+                LeaseMgrFactory::parse(dbname_);
+            boost::shared_ptr<LeaseMgr> own;
+#ifdef HAVE_MYSQL
+            if (lmptr.getType() == "mysql") {
+                own.reset(new MySqlLeaseMgr(parameters));
+            }
+#endif
+#ifdef HAVE_PGSQL
+            if (lmptr.getType() == "postgresql") {
+                own.reset(new PgSqlLeaseMgr(parameters));
+            }
+#endif
+            if (!own) {
+                failure("creating the lease managers of the clients");
+            }
+            own_mgrs_.push_back(own);
+            mgrs_.push_back(own.get());
+        }
+    } catch (const bundy::Exception& e) {
+        cout << e.what() << endl;
+        failure("connecting to the lease database");
+    }
+
+    printInfo();
+}
+
+void LeaseMgr_uBenchmark::disconnect() {
+    mgrs_.clear();
+    own_mgrs_.clear();
+    LeaseMgrFactory::destroy();
+}
+
+Lease4Ptr LeaseMgr_uBenchmark::makeLease4(uint32_t i) const {
+    const uint8_t hwaddr[] = { 0x08, 0x00, 0x27, static_cast<uint8_t>(i >> 16),
+                               static_cast<uint8_t>(i >> 8),
+                               static_cast<uint8_t>(i) };
+    const uint8_t client_id[] = { 0x01, hwaddr[0], hwaddr[1], hwaddr[2],
+                                  hwaddr[3], hwaddr[4], hwaddr[5] };
+    return (Lease4Ptr(new Lease4(IOAddress(BASE_ADDR4 + i), hwaddr,
+                                 sizeof(hwaddr), client_id,
+                                 sizeof(client_id), 4000, 1000, 2000,
+                                 time(NULL), 1 + i % SUBNETS)));
+}
+
+uint32_t LeaseMgr_uBenchmark::elapsed(const struct timespec& since) {
+    const struct timespec now = getTime();
+    const int64_t ns = static_cast<int64_t>(now.tv_sec - since.tv_sec) *
+        1000000000 + (now.tv_nsec - since.tv_nsec);
+    return (static_cast<uint32_t>(std::min<int64_t>(
+        ns, numeric_limits<uint32_t>::max())));
+}
+
+void* LeaseMgr_uBenchmark::clientThread(void* arg) {
+    Client* client = static_cast<Client*>(arg);
+
+    try {
+        (client->bench_->*(client->operation_))(*client);
+    } catch (const std::string& e) {
+        client->error_ = e;
+    } catch (const bundy::Exception& e) {
+        client->error_ = e.what();
+    }
+
+    return (NULL);
+}
+
+void LeaseMgr_uBenchmark::runClients(Operation operation, const char* name) {
+    if (mgrs_.empty()) {
+        throw string("Lease manager not created.");
+    }
+
+    cout << name;
+
+    vector<Client> clients(mgrs_.size());
+    for (size_t i = 0; i < clients.size(); ++i) {
+        Client& client = clients[i];
+        client.bench_ = this;
+        client.operation_ = operation;
+        client.lmptr_ = mgrs_[i];
+        client.first_ = static_cast<uint64_t>(num_) * i / clients.size();
+        client.count_ = static_cast<uint64_t>(num_) * (i + 1) /
+            clients.size() - client.first_;
+        client.seed_ = random();
+        client.latencies_.reserve(client.count_);
+    }
+
+    const struct timespec start = getTime();
+
+    // A single client runs the operation directly.
+    string error;
+    if (clients.size() == 1) {
+        clientThread(&clients[0]);
+        error = clients[0].error_;
+    } else {
+        size_t started = 0;
+        for (; started < clients.size(); ++started) {
+            Client& client = clients[started];
+            if (pthread_create(&client.thread_, NULL, clientThread, &client)) {
+                client.error_ = "creating client thread";
+                break;
+            }
+        }
+        for (size_t i = 0; i < clients.size(); ++i) {
+            if (i < started) {
+                pthread_join(clients[i].thread_, NULL);
+            }
+            if (error.empty()) {
+                error = clients[i].error_;
+            }
+        }
+    }
+
+    const double seconds = elapsed(start) / 1e9;
+    cout << endl;
+
+    if (!error.empty()) {
+        throw error;
+    }
+
+    vector<uint32_t> latencies;
+    latencies.reserve(num_);
+    for (size_t i = 0; i < clients.size(); ++i) {
+        latencies.insert(latencies.end(), clients[i].latencies_.begin(),
+                         clients[i].latencies_.end());
+    }
+    if (latencies.empty()) {
+        return;
+    }
+    sort(latencies.begin(), latencies.end());
+
+    const double percentiles[] = { 50, 90, 99, 99.9 };
+    cout << "    " << latencies.size() << " operations by " << clients.size()
+         << " client(s): " << (seconds > 0 ? latencies.size() / seconds : 0)
+         << " oper/sec, latency";
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); ++i) {
+        const size_t rank = static_cast<size_t>(percentiles[i] / 100 *
+                                                (latencies.size() - 1));
+        cout << " p" << percentiles[i] << "=" << latencies[rank] / 1000.0
+             << "us";
+    }
+    cout << " max=" << latencies.back() / 1000.0 << "us" << endl;
+}
+
+void LeaseMgr_uBenchmark::createLease4Test() {
+    runClients(&LeaseMgr_uBenchmark::createLease4, "CREATE:   ");
+}
+
+void LeaseMgr_uBenchmark::createLease4(Client& client) {
+    for (uint32_t i = client.first_; i < client.first_ + client.count_; ++i) {
+        const struct timespec start = getTime();
+        if (!client.lmptr_->addLease(makeLease4(i))) {
+            failure("inserting a lease");
+        }
+        client.latencies_.push_back(elapsed(start));
+        if (verbose_) {
+            cout << ".";
+        }
+    }
+}
+
+void LeaseMgr_uBenchmark::searchLease4Test() {
+    runClients(&LeaseMgr_uBenchmark::searchLease4, "SEARCH:   ");
+}
+
+void LeaseMgr_uBenchmark::searchLease4(Client& client) {
+    // The leases are searched for in a range larger than the one in which
+    // they were created, so that the search succeeds with hitratio_.
+    const uint32_t range = static_cast<uint32_t>(num_ / hitratio_);
+    for (uint32_t n = 0; n < client.count_; ++n) {
+        const uint32_t i = rand_r(&client.seed_) % range;
+        const Lease4Ptr lease = makeLease4(i);
+        const struct timespec start = getTime();
+        switch (n % 3) {
+        case 0:
+            client.lmptr_->getLease4(lease->addr_);
+            break;
+        case 1:
+            client.lmptr_->getLease4(HWAddr(lease->hwaddr_, HTYPE_ETHER),
+                                     lease->subnet_id_);
+            break;
+        default:
+            client.lmptr_->getLease4(*lease->client_id_, lease->subnet_id_);
+        }
+        client.latencies_.push_back(elapsed(start));
+        if (verbose_) {
+            cout << ".";
+        }
+    }
+}
+
+void LeaseMgr_uBenchmark::updateLease4Test() {
+    runClients(&LeaseMgr_uBenchmark::updateLease4, "UPDATE:   ");
+}
+
+void LeaseMgr_uBenchmark::renewLease4(LeaseMgr& lmptr, uint32_t i) {
+    const Lease4Ptr lease = makeLease4(i);
+    const Lease4Ptr existing = lmptr.getLease4(*lease->client_id_,
+                                               lease->subnet_id_);
+    if (!existing) {
+        failure("renewing a lease");
+    }
+    existing->cltt_ = time(NULL);
+    lmptr.updateLease4(existing);
+}
+
+void LeaseMgr_uBenchmark::updateLease4(Client& client) {
+    for (uint32_t n = 0; n < client.count_; ++n) {
+        // Each client renews the leases it has created, so that the
+        // clients don't update the same leases.
+        const uint32_t i = client.first_ +
+            rand_r(&client.seed_) % client.count_;
+        const struct timespec start = getTime();
+        renewLease4(*client.lmptr_, i);
+        client.latencies_.push_back(elapsed(start));
+        if (verbose_) {
+            cout << ".";
+        }
+    }
+}
+
+void LeaseMgr_uBenchmark::deleteLease4Test() {
+    runClients(&LeaseMgr_uBenchmark::deleteLease4, "DELETE:   ");
+}
+
+void LeaseMgr_uBenchmark::deleteLease4(Client& client) {
+    for (uint32_t i = client.first_; i < client.first_ + client.count_; ++i) {
+        const struct timespec start = getTime();
+        if (!client.lmptr_->deleteLease(IOAddress(BASE_ADDR4 + i))) {
+            failure("deleting a lease");
+        }
+        client.latencies_.push_back(elapsed(start));
+        if (verbose_) {
+            cout << ".";
+        }
+    }
+}
+
+void LeaseMgr_uBenchmark::mixedLease4(Client& client) {
+    for (uint32_t n = 0; n < client.count_; ++n) {
+        const uint32_t op = rand_r(&client.seed_) % 100;
+        // The leases written are those of the client, the leases read
+        // may be any.
+        const uint32_t own = client.first_ +
+            rand_r(&client.seed_) % client.count_;
+        const Lease4Ptr lease = makeLease4(rand_r(&client.seed_) % num_);
+        const struct timespec start = getTime();
+        if (op < 40) {
+            renewLease4(*client.lmptr_, own);
+        } else if (op < 65) {
+            client.lmptr_->getLease4(HWAddr(lease->hwaddr_, HTYPE_ETHER),
+                                     lease->subnet_id_);
+        } else if (op < 90) {
+            client.lmptr_->getLease4(*lease->client_id_, lease->subnet_id_);
+        } else if (op < 99) {
+            if (!client.lmptr_->deleteLease(IOAddress(BASE_ADDR4 + own)) ||
+                !client.lmptr_->addLease(makeLease4(own))) {
+                failure("releasing and allocating a lease");
+            }
+        } else {
+            client.lmptr_->getExpiredLeases4(100);
+        }
+        client.latencies_.push_back(elapsed(start));
+        if (verbose_) {
+            cout << ".";
+        }
+    }
+}
+
+int LeaseMgr_uBenchmark::runMixed() {
+    try {
+        connect();
+        createLease4Test();
+        runClients(&LeaseMgr_uBenchmark::mixedLease4, "MIXED:    ");
+        deleteLease4Test();
+        disconnect();
+    } catch (const std::string& e) {
+        cout << "Failed: " << e << endl;
+        return (-1);
+    }
+    return (0);
+}
+
+int main(int argc, char * const argv[]) {
+
+    const char * dbaccess = "type=memfile universe=4 persist=false";
+    uint32_t num = 100;
+    bool sync = true;
+    bool verbose = false;
+
+    // The lease managers only log the creation of the database, and
+    // the errors which are reported by the benchmark anyway.
+    bundy::log::initLogger("lease_mgr_ubench", bundy::log::WARN);
+
+    LeaseMgr_uBenchmark bench(dbaccess, num, sync, verbose);
+
+    bench.parseCmdline(argc, argv);
+
+    int result = bench.run();
+    if (result == 0) {
+        result = bench.runMixed();
+    }
+
+    return (result);
+}
@@ -0,0 +1,182 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <boost/shared_ptr.hpp>
+#include <dhcpsrv/lease_mgr.h>
+#include "benchmark.h"
+
+/// @brief Lease manager micro-benchmark.
+///
+/// Unlike the other benchmarks, which model the backends with their own
+/// code, this one drives the lease managers used by the servers (memfile,
+/// MySQL or PostgreSQL), created by the LeaseMgrFactory from the database
+/// access string given with -f. The numbers include everything the server
+/// pays for a lease operation: building the Lease4 objects, the indexes
+/// of the memfile and the lease file, or the SQL statements and the
+/// conversions of the database backends.
+///
+/// The steps of uBenchmark::run() are run with several clients (-t), each
+/// in its own thread. The memfile lease manager is shared by the clients,
+/// as it would be by the threads of a server. The database lease managers
+/// are not thread-safe, so each client gets its own manager and connection.
+/// Besides the elapsed time of each step, the ops/sec and the percentiles
+/// of the latency of the individual operations are printed.
+///
+/// mixedLease4Test() then runs a workload close to the one of a server:
+/// renewals, lookups by hardware address and client identifier, releases
+/// followed by new allocations, and scans for the expired leases.
+class LeaseMgr_uBenchmark: public uBenchmark {
+public:
+
+    /// @brief The sole lease manager benchmark constructor.
+    ///
+    /// @param dbaccess database access string passed to the LeaseMgrFactory
+    /// @param num_iterations number of iterations
+    /// @param sync ignored, the persistence is set in the access string
+    /// @param verbose would you like extra logging?
+    LeaseMgr_uBenchmark(const std::string& dbaccess, uint32_t num_iterations,
+                        bool sync, bool verbose);
+
+    /// @brief Prints backend info.
+    virtual void printInfo();
+
+    /// @brief Creates the lease manager(s) of the clients.
+    virtual void connect();
+
+    /// @brief Destroys the lease managers.
+    virtual void disconnect();
+
+    /// @brief Creates new leases.
+    ///
+    /// See uBenchmark::createLease4Test() for detailed explanation.
+    virtual void createLease4Test();
+
+    /// @brief Searches for existing leases.
+    ///
+    /// The leases are looked up alternately by address, by hardware address
+    /// and by client identifier. See uBenchmark::searchLease4Test() for
+    /// detailed explanation.
+    virtual void searchLease4Test();
+
+    /// @brief Renews existing leases.
+    ///
+    /// Each lease is looked up by client identifier, as a server handling
+    /// a DHCPREQUEST would, and its client last transmission time updated.
+    /// See uBenchmark::updateLease4Test() for detailed explanation.
+    virtual void updateLease4Test();
+
+    /// @brief Deletes existing leases.
+    ///
+    /// See uBenchmark::deleteLease4Test() for detailed explanation.
+    virtual void deleteLease4Test();
+
+    /// @brief Runs the mixed workload.
+    ///
+    /// Connects, creates the leases, runs num_ operations drawn from the
+    /// mix below, deletes the leases and disconnects:
+    /// - 40% renewals (see updateLease4Test()),
+    /// - 25% lookups by hardware address,
+    /// - 25% lookups by client identifier,
+    /// - 9% releases of a lease immediately allocated again,
+    /// - 1% scans for at most 100 expired leases.
+    ///
+    /// @return 0 if the run was successful, negative value if detected errors
+    int runMixed();
+
+protected:
+
+    /// @brief State of a client thread.
+    struct Client;
+
+    /// @brief Benchmark operation run by each client.
+    ///
+    /// The operation runs the iterations from client.first_ to
+    /// client.first_ + client.count_ - 1 and records their latencies.
+    typedef void (LeaseMgr_uBenchmark::*Operation)(Client& client);
+
+    /// @brief State of a client thread.
+    struct Client {
+        LeaseMgr_uBenchmark* bench_;     ///< Benchmark running the client
+        Operation operation_;            ///< Operation run by the client
+        bundy::dhcp::LeaseMgr* lmptr_;   ///< Lease manager used by the client
+        uint32_t first_;                 ///< First iteration of the client
+        uint32_t count_;                 ///< Number of iterations
+        unsigned int seed_;              ///< Random generator state
+        std::vector<uint32_t> latencies_; ///< Latencies of operations (ns)
+        pthread_t thread_;               ///< Thread running the client
+        std::string error_;              ///< Error reported, if any
+    };
+
+    /// @brief Runs a benchmark operation with all clients.
+    ///
+    /// The iterations are shared among the clients. If there are several
+    /// clients, each runs its part in its own thread. The ops/sec and the
+    /// latency percentiles of all clients together are printed.
+    ///
+    /// @param operation operation to be run
+    /// @param name name of the operation to be printed out
+    void runClients(Operation operation, const char* name);
+
+    /// @brief Client thread entry point.
+    ///
+    /// @param arg pointer to the Client structure
+    /// @return NULL
+    static void* clientThread(void* arg);
+
+    /// @brief Builds the lease of an iteration.
+    ///
+    /// The lease of iteration i has address BASE_ADDR4 + i, a hardware
+    /// address and client identifier derived from i, and belongs to one of
+    /// SUBNETS subnets.
+    ///
+    /// @param i iteration
+    /// @return lease
+    bundy::dhcp::Lease4Ptr makeLease4(uint32_t i) const;
+
+    /// @brief Returns the nanoseconds elapsed since a time.
+    ///
+    /// @param since start time
+    uint32_t elapsed(const struct timespec& since);
+
+    /// @brief Inserts the leases of the client.
+    void createLease4(Client& client);
+
+    /// @brief Searches for count leases.
+    void searchLease4(Client& client);
+
+    /// @brief Renews the leases of the client.
+    void updateLease4(Client& client);
+
+    /// @brief Deletes the leases of the client.
+    void deleteLease4(Client& client);
+
+    /// @brief Runs count operations of the mixed workload.
+    void mixedLease4(Client& client);
+
+    /// @brief Renews the lease of an iteration.
+    void renewLease4(bundy::dhcp::LeaseMgr& lmptr, uint32_t i);
+
+    /// Number of subnets the leases are spread over.
+    static const uint32_t SUBNETS = 16;
+
+    /// Lease managers of the clients, one per client.
+    std::vector<bundy::dhcp::LeaseMgr*> mgrs_;
+
+    /// Lease managers created for the clients, other than the one of the
+    /// LeaseMgrFactory.
+    std::vector<boost::shared_ptr<bundy::dhcp::LeaseMgr> > own_mgrs_;
+};
@@ -18,6 +18,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <time.h>
+#include <pthread.h>
 #include <mysql.h>
 
 #include "benchmark.h"
@@ -44,9 +45,13 @@ void MySQL_uBenchmark::stmt_failure(MYSQL_STMT * stmt, const char* operation) {
 
 
 void MySQL_uBenchmark::failure(const char* operation) {
+    failure(conn_, operation);
+}
+
+void MySQL_uBenchmark::failure(MYSQL* conn, const char* operation) {
     stringstream tmp;
-    tmp << "Error " << mysql_errno(conn_) << " during " << operation
-        << ": " << mysql_error(conn_);
+    tmp << "Error " << mysql_errno(conn) << " during " << operation
+        << ": " << mysql_error(conn);
     throw tmp.str();
 }
 
@@ -81,22 +86,113 @@ void MySQL_uBenchmark::connect() {
         q = "Failed to run query:" + q;
         failure(q.c_str());
     }
+
+    // Each concurrent client uses its own connection, the first one
+    // being the connection opened above.
+    conns_.push_back(conn_);
+    while (conns_.size() < clients_) {
+        MYSQL* conn = mysql_init(NULL);
+        if (!conn) {
+            failure("initializing MySQL connection");
+        }
+        conns_.push_back(conn);
+        if (!mysql_real_connect(conn, hostname_.c_str(), user_.c_str(),
+                                passwd_.c_str(), dbname_.c_str(), 0, NULL, 0)) {
+            failure(conn, "connecting to MySQL server");
+        }
+    }
+    if (clients_ > 1) {
+        cout << "MySQL connections established for " << clients_
+             << " clients." << endl;
+    }
 }
 
 void MySQL_uBenchmark::disconnect() {
     if (!conn_) {
         throw "NULL MySQL connection pointer.";
     }
+    for (size_t i = 0; i < conns_.size(); ++i) {
+        if (conns_[i] != conn_) {
+            mysql_close(conns_[i]);
+        }
+    }
+    conns_.clear();
     mysql_close(conn_);
     conn_ = NULL;
 }
 
-void MySQL_uBenchmark::createLease4Test() {
+void* MySQL_uBenchmark::clientThread(void* arg) {
+    Client* client = static_cast<Client*>(arg);
+
+    mysql_thread_init();
+    try {
+        (client->bench_->*(client->operation_))(client->conn_, client->first_,
+                                                client->count_);
+    } catch (const std::string& e) {
+        client->error_ = e;
+    } catch (const char* e) {
+        client->error_ = e;
+    }
+    mysql_thread_end();
+
+    return (NULL);
+}
+
+void MySQL_uBenchmark::runClients(Operation operation, const char* name) {
     if (!conn_) {
         throw "Not connected to MySQL server.";
     }
 
-    uint32_t addr = BASE_ADDR4; // Let's start with 1.0.0.0 address
+    cout << name;
+
+    // A single client runs the operation directly.
+    if (conns_.size() <= 1) {
+        (this->*operation)(conn_, 0, num_);
+        cout << endl;
+        return;
+    }
+
+    // Otherwise the iterations are shared among the clients, each running
+    // in its own thread with its own connection.
+    vector<Client> clients(conns_.size());
+    size_t started = 0;
+    for (; started < clients.size(); ++started) {
+        Client& client = clients[started];
+        client.bench_ = this;
+        client.operation_ = operation;
+        client.conn_ = conns_[started];
+        client.first_ = static_cast<uint64_t>(num_) * started / clients.size();
+        client.count_ = static_cast<uint64_t>(num_) * (started + 1) /
+            clients.size() - client.first_;
+        if (pthread_create(&client.thread_, NULL, clientThread, &client)) {
+            clients[started].error_ = "creating client thread";
+            break;
+        }
+    }
+
+    string error;
+    for (size_t i = 0; i < clients.size(); ++i) {
+        if (i < started) {
+            pthread_join(clients[i].thread_, NULL);
+        }
+        if (error.empty()) {
+            error = clients[i].error_;
+        }
+    }
+    cout << endl;
+
+    if (!error.empty()) {
+        throw error;
+    }
+}
+
+void MySQL_uBenchmark::createLease4Test() {
+    runClients(&MySQL_uBenchmark::createLease4, "CREATE:   ");
+}
+
+void MySQL_uBenchmark::createLease4(MYSQL* conn, uint32_t first,
+                                    uint32_t count) {
+    uint32_t addr = BASE_ADDR4 + first; // Let's start with 1.0.0.0 address
     char hwaddr[20];
     size_t hwaddr_len = 20;    // Not a real field
     char client_id[128];
@@ -120,8 +216,6 @@ void MySQL_uBenchmark::createLease4Test() {
     bool fqdn_fwd = true;       // Let's pretend to do AAAA update
     bool fqdn_rev = true;       // Let's pretend to do PTR update
 
-    cout << "CREATE:   ";
-
     for (uint8_t i = 0; i < hwaddr_len; i++) {
         hwaddr[i] = 'A' + i; // let's make hwaddr consisting of letters
     }
@@ -138,9 +232,9 @@ void MySQL_uBenchmark::createLease4Test() {
 
     if (compiled_stmt_) {
         // create a statement once
-        stmt = mysql_stmt_init(conn_);
+        stmt = mysql_stmt_init(conn);
         if (!stmt) {
-            failure("Unable to create compiled statement, mysql_stmt_init() failed");
+            failure(conn, "Unable to create compiled statement, mysql_stmt_init() failed");
         }
 
         const char * statement = "INSERT INTO lease4(addr,hwaddr,client_id,"
@@ -148,11 +242,11 @@ void MySQL_uBenchmark::createLease4Test() {
             "fqdn_fwd,fqdn_rev) VALUES(?,?,?,?,?,?,?,?,?,?,?)";
 
         if (mysql_stmt_prepare(stmt, statement, strlen(statement) )) {
-            failure("Failed to prepare statement, mysql_stmt_prepare() returned non-zero");
+            failure(conn, "Failed to prepare statement, mysql_stmt_prepare() returned non-zero");
         }
         int param_cnt = mysql_stmt_param_count(stmt);
         if (param_cnt != 11) {
-            failure("Parameter count sanity check failed.");
+            failure(conn, "Parameter count sanity check failed.");
         }
 
         memset(bind, 0, sizeof(bind));
@@ -228,7 +322,7 @@ void MySQL_uBenchmark::createLease4Test() {
         bind[10].length = 0;
     }
 
-    for (uint32_t i = 0; i < num_; i++) {
+    for (uint32_t i = first; i < first + count; i++) {
 
         sprintf(cltt, "2012-07-11 15:43:%02d", i % 60);
 
@@ -243,9 +337,9 @@ void MySQL_uBenchmark::createLease4Test() {
                    "fqdn_fwd,fqdn_rev) VALUES(");
             end = query + strlen(query);
             end += sprintf(end, "%u,\'", addr);
-            end += mysql_real_escape_string(conn_, end, hwaddr, hwaddr_len);
+            end += mysql_real_escape_string(conn, end, hwaddr, hwaddr_len);
             end += sprintf(end,"\',\'");
-            end += mysql_real_escape_string(conn_, end, client_id, client_id_len);
+            end += mysql_real_escape_string(conn, end, client_id, client_id_len);
             end += sprintf(end, "\',%d,%d,'%s',%d,%s,\'%s\',%s,%s);",
                            valid_lft, recycle_time, cltt,
                            pool_id, (fixed?"true":"false"), hostname,
@@ -254,19 +348,19 @@ void MySQL_uBenchmark::createLease4Test() {
             // options and comments fields are not set
 
             unsigned int len = end - query;
-            if (mysql_real_query(conn_, query, len)) {
+            if (mysql_real_query(conn, query, len)) {
                 // something failed.
-                failure("INSERT query");
+                failure(conn, "INSERT query");
             }
         } else {
             // compiled statement
 
             if (mysql_stmt_bind_param(stmt, bind)) {
-                failure("Failed to bind parameters: mysql_stmt_bind_param() returned non-zero");
+                failure(conn, "Failed to bind parameters: mysql_stmt_bind_param() returned non-zero");
             }
 
             if (mysql_stmt_execute(stmt)) {
-                failure("Failed to execute statement: mysql_stmt_execute() returned non-zero");
+                failure(conn, "Failed to execute statement: mysql_stmt_execute() returned non-zero");
             }
 
         }
@@ -278,38 +372,35 @@ void MySQL_uBenchmark::createLease4Test() {
 
     if (compiled_stmt_) {
         if (mysql_stmt_close(stmt)) {
-            failure("Failed to close compiled statement, mysql_stmt_close returned non-zero");
+            failure(conn, "Failed to close compiled statement, mysql_stmt_close returned non-zero");
         }
     }
-
-    cout << endl;
 }
 
 void MySQL_uBenchmark::searchLease4Test() {
-    if (!conn_) {
-        throw "Not connected to MySQL server.";
-    }
-
-    cout << "RETRIEVE: ";
+    runClients(&MySQL_uBenchmark::searchLease4, "RETRIEVE: ");
+}
 
+void MySQL_uBenchmark::searchLease4(MYSQL* conn, uint32_t /* first */,
+                                    uint32_t count) {
     uint32_t addr = 0;
 
     MYSQL_STMT * stmt = NULL;
     MYSQL_BIND bind[1]; // just a single element
     if (compiled_stmt_) {
-        stmt = mysql_stmt_init(conn_);
+        stmt = mysql_stmt_init(conn);
         if (!stmt) {
-            failure("Unable to create compiled statement");
+            failure(conn, "Unable to create compiled statement");
         }
         const char * statement = "SELECT lease_id,addr,hwaddr,client_id,"
             "valid_lft, cltt,pool_id,fixed,hostname,fqdn_fwd,fqdn_rev "
             "FROM lease4 where addr=?";
         if (mysql_stmt_prepare(stmt, statement, strlen(statement))) {
-           failure("Failed to prepare statement, mysql_stmt_prepare() returned non-zero");
+           failure(conn, "Failed to prepare statement, mysql_stmt_prepare() returned non-zero");
         }
         int param_cnt = mysql_stmt_param_count(stmt);
         if (param_cnt != 1) {
-            failure("Parameter count sanity check failed.");
+            failure(conn, "Parameter count sanity check failed.");
         }
 
         memset(bind, 0, sizeof(bind));
@@ -321,7 +412,7 @@ void MySQL_uBenchmark::searchLease4Test() {
         bind[0].length = 0;
     }
 
-    for (uint32_t i = 0; i < num_; i++) {
+    for (uint32_t i = 0; i < count; i++) {
 
         addr = BASE_ADDR4 + random() % int(num_ / hitratio_);
 
@@ -330,9 +421,9 @@ void MySQL_uBenchmark::searchLease4Test() {
             sprintf(query, "SELECT lease_id,addr,hwaddr,client_id,valid_lft,"
                     "cltt,pool_id,fixed,hostname,fqdn_fwd,fqdn_rev "
                     "FROM lease4 where addr=%d", addr);
-            mysql_real_query(conn_, query, strlen(query));
+            mysql_real_query(conn, query, strlen(query));
 
-            MYSQL_RES * result = mysql_store_result(conn_);
+            MYSQL_RES * result = mysql_store_result(conn);
 
             int num_rows = mysql_num_rows(result);
             int num_fields = mysql_num_fields(result);
@@ -341,19 +432,19 @@ void MySQL_uBenchmark::searchLease4Test() {
                 stringstream tmp;
                 tmp << "Search: DB returned " << num_rows << " leases for address "
                     << hex << addr << dec;
-                failure(tmp.str().c_str());
+                failure(conn, tmp.str().c_str());
             }
 
             if (num_rows) {
                 if (num_fields == 0) {
-                    failure("Query returned empty set");
+                    failure(conn, "Query returned empty set");
                 }
 
                 MYSQL_ROW row = mysql_fetch_row(result);
 
                 // pretend to do something with it
                 if (row[0] == NULL) {
-                    failure("SELECT returned NULL data.");
+                    failure(conn, "SELECT returned NULL data.");
                 }
                 mysql_free_result(result);
 
@@ -370,11 +461,11 @@ void MySQL_uBenchmark::searchLease4Test() {
             // compiled statement
 
             if (mysql_stmt_bind_param(stmt, bind)) {
-                failure("Failed to bind parameters: mysql_stmt_bind_param() returned non-zero");
+                failure(conn, "Failed to bind parameters: mysql_stmt_bind_param() returned non-zero");
             }
 
             if (mysql_stmt_execute(stmt)) {
-                failure("Failed to execute statement: mysql_stmt_execute() returned non-zero");
+                failure(conn, "Failed to execute statement: mysql_stmt_execute() returned non-zero");
             }
 
             MYSQL_BIND response[11];
@@ -450,7 +541,7 @@ void MySQL_uBenchmark::searchLease4Test() {
             if (mysql_stmt_bind_result(stmt, response))
             {
                 cout << "Error:" << mysql_stmt_error(stmt) << endl;
-                failure("mysql_stmt_bind_result() failed");
+                failure(conn, "mysql_stmt_bind_result() failed");
             }
             int num_rows = 0;
 
@@ -458,7 +549,7 @@ void MySQL_uBenchmark::searchLease4Test() {
             switch (result) {
             case 0: {
                 if (lease_addr != addr) {
-                    failure("Returned data is bogus!");
+                    failure(conn, "Returned data is bogus!");
                 }
                 num_rows++;
                 break;
@@ -493,20 +584,17 @@ void MySQL_uBenchmark::searchLease4Test() {
 
     if (compiled_stmt_) {
         if (mysql_stmt_close(stmt)) {
-            failure("Failed to close compiled statement, mysql_stmt_close returned non-zero");
+            failure(conn, "Failed to close compiled statement, mysql_stmt_close returned non-zero");
         }
     }
-
-    cout << endl;
 }
 
 void MySQL_uBenchmark::updateLease4Test() {
-    if (!conn_) {
-        throw "Not connected to MySQL server.";
-    }
-
-    cout << "UPDATE:   ";
+    runClients(&MySQL_uBenchmark::updateLease4, "UPDATE:   ");
+}
 
+void MySQL_uBenchmark::updateLease4(MYSQL* conn, uint32_t /* first */,
+                                    uint32_t count) {
     uint32_t valid_lft = 1002; // just some dummy value
     char cltt[] = "now()";
     size_t cltt_len = strlen(cltt);
@@ -515,17 +603,17 @@ void MySQL_uBenchmark::updateLease4Test() {
     MYSQL_STMT * stmt = NULL;
     MYSQL_BIND bind[3];
     if (compiled_stmt_) {
-        stmt = mysql_stmt_init(conn_);
+        stmt = mysql_stmt_init(conn);
         if (!stmt) {
-            failure("Unable to create compiled statement");
+            failure(conn, "Unable to create compiled statement");
         }
         const char * statement = "UPDATE lease4 SET valid_lft=?, cltt=? WHERE addr=?";
         if (mysql_stmt_prepare(stmt, statement, strlen(statement))) {
-           failure("Failed to prepare statement, mysql_stmt_prepare() returned non-zero");
+           failure(conn, "Failed to prepare statement, mysql_stmt_prepare() returned non-zero");
         }
         int param_cnt = mysql_stmt_param_count(stmt);
         if (param_cnt != 3) {
-            failure("Parameter count sanity check failed.");
+            failure(conn, "Parameter count sanity check failed.");
         }
 
         memset(bind, 0, sizeof(bind));
@@ -544,23 +632,23 @@ void MySQL_uBenchmark::updateLease4Test() {
     }
 
 
-    for (uint32_t i = 0; i < num_; i++) {
+    for (uint32_t i = 0; i < count; i++) {
 
         addr = BASE_ADDR4 + random() % num_;
 
         if (!compiled_stmt_) {
             char query[128];
             sprintf(query, "UPDATE lease4 SET valid_lft=1002, cltt=now() WHERE addr=%d", addr);
-            mysql_real_query(conn_, query, strlen(query));
+            mysql_real_query(conn, query, strlen(query));
 
         } else {
             // compiled statement
             if (mysql_stmt_bind_param(stmt, bind)) {
-                failure("Failed to bind parameters: mysql_stmt_bind_param() returned non-zero");
+                failure(conn, "Failed to bind parameters: mysql_stmt_bind_param() returned non-zero");
             }
 
             if (mysql_stmt_execute(stmt)) {
-                failure("Failed to execute statement: mysql_stmt_execute() returned non-zero");
+                failure(conn, "Failed to execute statement: mysql_stmt_execute() returned non-zero");
             }
         }
 
@@ -571,39 +659,36 @@ void MySQL_uBenchmark::updateLease4Test() {
 
     if (compiled_stmt_) {
         if (mysql_stmt_close(stmt)) {
-            failure("Failed to close compiled statement, mysql_stmt_close returned non-zero");
+            failure(conn, "Failed to close compiled statement, mysql_stmt_close returned non-zero");
         }
     }
-
-    cout << endl;
 }
 
 void MySQL_uBenchmark::deleteLease4Test() {
-    if (!conn_) {
-        throw "Not connected to MySQL server.";
-    }
-
-    cout << "DELETE:   ";
+    runClients(&MySQL_uBenchmark::deleteLease4, "DELETE:   ");
+}
 
+void MySQL_uBenchmark::deleteLease4(MYSQL* conn, uint32_t first,
+                                    uint32_t count) {
     uint32_t addr = 0;
 
     MYSQL_STMT * stmt = NULL;
     MYSQL_BIND bind[1]; // just a single element
     if (compiled_stmt_) {
 
-        stmt = mysql_stmt_init(conn_);
+        stmt = mysql_stmt_init(conn);
         if (!stmt) {
-            failure("Unable to create compiled statement, mysql_stmt_init() failed");
+            failure(conn, "Unable to create compiled statement, mysql_stmt_init() failed");
         }
 
         const char * statement = "DELETE FROM lease4 WHERE addr=?";
 
         if (mysql_stmt_prepare(stmt, statement, strlen(statement) )) {
-            failure("Failed to prepare statement, mysql_stmt_prepare() returned non-zero");
+            failure(conn, "Failed to prepare statement, mysql_stmt_prepare() returned non-zero");
         }
         int param_cnt = mysql_stmt_param_count(stmt);
         if (param_cnt != 1) {
-            failure("Parameter count sanity check failed.");
+            failure(conn, "Parameter count sanity check failed.");
         }
 
         memset(bind, 0, sizeof(bind));
@@ -616,22 +701,22 @@ void MySQL_uBenchmark::deleteLease4Test() {
     }
 
 
-    for (uint32_t i = 0; i < num_; i++) {
+    for (uint32_t i = first; i < first + count; i++) {
 
         addr = BASE_ADDR4 + i;
 
         if (!compiled_stmt_) {
             char query[128];
             sprintf(query, "DELETE FROM lease4 WHERE addr=%d", addr);
-            mysql_real_query(conn_, query, strlen(query));
+            mysql_real_query(conn, query, strlen(query));
         } else {
             // compiled statement
             if (mysql_stmt_bind_param(stmt, bind)) {
-                failure("Failed to bind parameters: mysql_stmt_bind_param() returned non-zero");
+                failure(conn, "Failed to bind parameters: mysql_stmt_bind_param() returned non-zero");
             }
 
             if (mysql_stmt_execute(stmt)) {
-                failure("Failed to execute statement: mysql_stmt_execute() returned non-zero");
+                failure(conn, "Failed to execute statement: mysql_stmt_execute() returned non-zero");
             }
         }
 
@@ -642,11 +727,9 @@ void MySQL_uBenchmark::deleteLease4Test() {
 
     if (compiled_stmt_) {
         if (mysql_stmt_close(stmt)) {
-            failure("Failed to close compiled statement, mysql_stmt_close returned non-zero");
+            failure(conn, "Failed to close compiled statement, mysql_stmt_close returned non-zero");
         }
     }
-
-    cout << endl;
 }
 
 void MySQL_uBenchmark::printInfo() {
@@ -13,6 +13,8 @@
 // PERFORMANCE OF THIS SOFTWARE.
 
 #include <string>
+#include <vector>
+#include <pthread.h>
 #include "benchmark.h"
 
 /// @brief MySQL micro-benchmark.
@@ -86,6 +88,15 @@ protected:
     /// @sa stmt_failure()
     void failure(const char* operation);
 
+    /// @brief Used to report database failures on a specific connection.
+    ///
+    /// This is the same as failure(const char*), but reports the error of
+    /// the given client connection.
+    ///
+    /// @param conn MySQL connection on which the error occurred
+    /// @param operation brief description of the operation that caused error
+    void failure(MYSQL* conn, const char* operation);
+
     /// @brief Used to report compiled statement failures.
     ///
     /// Compared to its base version in uBenchmark class, this one logs additional
@@ -98,7 +109,56 @@ protected:
     /// @sa failure()
     void stmt_failure(MYSQL_STMT * stmt, const char* operation);
 
+    /// @brief Benchmark operation run by each client.
+    ///
+    /// The operation is given the connection of the client and the range of
+    /// iterations the client is to run (from first to first + count - 1).
+    typedef void (MySQL_uBenchmark::*Operation)(MYSQL* conn, uint32_t first,
+                                                uint32_t count);
+
+    /// @brief Runs a benchmark operation with all clients.
+    ///
+    /// If several clients have been requested (see uBenchmark::clients_),
+    /// the iterations are shared among them and each client runs its
+    /// part in its own thread, over its own connection. Otherwise the
+    /// operation is run directly.
+    ///
+    /// @param operation operation to be run
+    /// @param name name of the operation to be printed out
+    void runClients(Operation operation, const char* name);
+
+    /// @brief Inserts leases first + 1 to first + count.
+    void createLease4(MYSQL* conn, uint32_t first, uint32_t count);
+
+    /// @brief Searches for count leases.
+    void searchLease4(MYSQL* conn, uint32_t first, uint32_t count);
+
+    /// @brief Updates count leases.
+    void updateLease4(MYSQL* conn, uint32_t first, uint32_t count);
+
+    /// @brief Deletes leases first to first + count - 1.
+    void deleteLease4(MYSQL* conn, uint32_t first, uint32_t count);
+
+    /// @brief State of a client thread.
+    struct Client {
+        MySQL_uBenchmark* bench_; ///< Benchmark running the client
+        Operation operation_;     ///< Operation run by the client
+        MYSQL* conn_;             ///< Connection used by the client
+        uint32_t first_;          ///< First iteration run by the client
+        uint32_t count_;          ///< Number of iterations run by the client
+        pthread_t thread_;        ///< Thread running the client
+        std::string error_;       ///< Error reported by the client, if any
+    };
+
+    /// @brief Client thread entry point.
+    ///
+    /// @param arg pointer to the Client structure
+    /// @return NULL
+    static void* clientThread(void* arg);
 
     /// Handle to MySQL database connection.
     MYSQL* conn_;
+
+    /// Connections of all clients, the first one being conn_.
+    std::vector<MYSQL*> conns_;
 };
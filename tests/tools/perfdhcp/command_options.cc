@@ -127,7 +127,9 @@ CommandOptions::reset() {
     max_drop_.clear();
     max_pdrop_.clear();
     localname_.clear();
+    localnames_.clear();
     is_interface_ = false;
+    threads_ = 1;
     preload_ = 0;
     aggressivity_ = 1;
     local_port_ = 0;
@@ -144,6 +146,8 @@ CommandOptions::reset() {
     rip_offset_ = -1;
     diags_.clear();
     wrapped_.clear();
+    series_file_.clear();
+    max_outstanding_ = 0;
     server_name_.clear();
     generateDuidTemplate();
 }
@@ -212,7 +216,7 @@ CommandOptions::initialize(int argc, char** argv, bool print_cmd_line) {
     // In this section we collect argument values from command line
     // they will be tuned and validated elsewhere
     while((opt = getopt(argc, argv, "hv46r:t:R:b:n:p:d:D:l:P:a:L:"
-                        "s:iBc1T:X:O:E:S:I:x:w:e:f:F:")) != -1) {
+                        "s:iBc1T:X:O:E:S:I:x:w:e:f:F:g:y:M:")) != -1) {
         stream << " -" << static_cast<char>(opt);
         if (optarg) {
             stream << " " << optarg;
@@ -314,6 +318,11 @@ CommandOptions::initialize(int argc, char** argv, bool print_cmd_line) {
                                             " positive integer");
             break;
 
+        case 'g':
+            threads_ = positiveInteger("number of threads: -g<threads>"
+                                       " must be a positive integer");
+            break;
+
         case 'h':
             usage();
             return (true);
@@ -329,8 +338,14 @@ CommandOptions::initialize(int argc, char** argv, bool print_cmd_line) {
             break;
 
         case 'l':
-            localname_ = std::string(optarg);
-            initIsInterface();
+            // Each thread uses a distinct local address or interface, so
+            // the option may be repeated. The first one is used for the
+            // initial settings.
+            localnames_.push_back(std::string(optarg));
+            if (localnames_.size() == 1) {
+                localname_ = localnames_[0];
+                initIsInterface();
+            }
             break;
 
         case 'L':
@@ -343,6 +358,12 @@ CommandOptions::initialize(int argc, char** argv, bool print_cmd_line) {
                   boost::lexical_cast<std::string>(std::numeric_limits<uint16_t>::max()));
             break;
 
+        case 'M':
+            max_outstanding_ = positiveInteger("maximum number of outstanding"
+                                               " packets: -M<max-outstanding>"
+                                               " must be a positive integer");
+            break;
+
         case 'n':
             num_req = positiveInteger("value of num-request:"
                                       " -n<value> must be a positive integer");
@@ -447,6 +468,12 @@ CommandOptions::initialize(int argc, char** argv, bool print_cmd_line) {
             xid_offset_.push_back(offset_arg);
             break;
 
+        case 'y':
+            series_file_ = nonEmptyString("name of the time series file:"
+                                          " -y<series-file> must be"
+                                          " specified");
+            break;
+
         default:
             bundy_throw(bundy::InvalidParameter, "unknown command line option");
         }
@@ -763,6 +790,29 @@ CommandOptions::validate() const {
     check((getTemplateFiles().size() < 2) && (getRequestedIpOffset() >= 0),
           "second/request -T<template-file> must be set to "
           "use -I<ip-offset>");
+    check((getThreadsNum() > 1) &&
+          (getLocalNames().size() != getThreadsNum()),
+          "-l<local-addr|interface> must be specified once for each of"
+          " the -g<threads>");
+    check((getThreadsNum() == 1) && (getLocalNames().size() > 1),
+          "second -l<local-addr|interface> requires -g<threads>");
+    const int threads = static_cast<int>(getThreadsNum());
+    check((threads > 1) && (getRate() != 0) &&
+          ((getRate() < threads) ||
+           ((getRenewRate() != 0) && (getRenewRate() < threads)) ||
+           ((getReleaseRate() != 0) && (getReleaseRate() < threads))),
+          "-r<rate>, -f<renew-rate> and -F<release-rate> must not be"
+          " lower than -g<threads>");
+    check((getThreadsNum() > 1) && (getClientsNum() > 1) &&
+          (getClientsNum() < getThreadsNum()),
+          "-R<range> must not be lower than -g<threads>");
+    check((getThreadsNum() > 1) && (getReportDelay() != 0),
+          "-t<report> is not compatible with -g<threads>");
+    check(!getTimeSeriesFile().empty() && (getReportDelay() == 0),
+          "-y<series-file> requires -t<report>");
+    check((getMaxOutstanding() > 0) &&
+          (getDiags().find('t') != std::string::npos),
+          "-M<max-outstanding> is not compatible with -xt");
 
 }
 
@@ -901,6 +951,12 @@ CommandOptions::printCommandLine() const {
     if (!wrapped_.empty()) {
         std::cout << "wrapped=" << wrapped_ << std::endl;
     }
+    if (!series_file_.empty()) {
+        std::cout << "time-series=" << series_file_ << std::endl;
+    }
+    if (max_outstanding_ > 0) {
+        std::cout << "max-outstanding=" << max_outstanding_ << std::endl;
+    }
     if (!localname_.empty()) {
         if (is_interface_) {
             std::cout << "interface=" << localname_ << std::endl;
@@ -908,6 +964,9 @@ CommandOptions::printCommandLine() const {
             std::cout << "local-addr=" << localname_ << std::endl;
         }
     }
+    if (threads_ > 1) {
+        std::cout << "threads=" << threads_ << std::endl;
+    }
     if (!server_name_.empty()) {
         std::cout << "server=" << server_name_ << std::endl;
     }
@@ -924,6 +983,7 @@ CommandOptions::usage() const {
         "         [-c] [-1] [-T<template-file>] [-X<xid-offset>]\n"
         "         [-O<random-offset] [-E<time-offset>] [-S<srvid-offset>]\n"
         "         [-I<ip-offset>] [-x<diagnostic-selector>] [-w<wrapped>]\n"
+        "         [-g<threads>] [-y<series-file>] [-M<max-outstanding>]\n"
         "         [server]\n"
         "\n"
         "The [server] argument is the name/address of the DHCP server to\n"
@@ -967,6 +1027,11 @@ CommandOptions::usage() const {
         "-E<time-offset>: Offset of the (DHCPv4) secs field / (DHCPv6)\n"
         "    elapsed-time option in the (second/request) template.\n"
         "    The value 0 disables it.\n"
+        "-g<threads>: Number of threads generating the traffic, each using\n"
+        "    its own socket and its own part of the simulated clients.  The\n"
+        "    rates and the number of requests are divided between the\n"
+        "    threads.  The -l option must be given once for each thread,\n"
+        "    because the server sends the responses to a fixed port.\n"
         "-h: Print this help.\n"
         "-i: Do only the initial part of an exchange: DO or SA, depending on\n"
         "    whether -6 is given.\n"
@@ -980,6 +1045,11 @@ CommandOptions::usage() const {
         "    via which exchanges are initiated.\n"
         "-L<local-port>: Specify the local port to use\n"
         "    (the value 0 means to use the default).\n"
+        "-M<max-outstanding>: Hold at most <max-outstanding> requests waiting\n"
+        "    for a response for each exchange, so that the memory used doesn't\n"
+        "    grow with the length of the test.  When the limit is reached the\n"
+        "    oldest request is counted as dropped.  This is incompatible with\n"
+        "    -xt.\n"
         "-O<random-offset>: Offset of the last octet to randomize in the template.\n"
         "-P<preload>: Initiate first <preload> exchanges back to back at startup.\n"
         "-r<rate>: Initiate <rate> DORA/SARR (or if -i is given, DO/SA)\n"
@@ -1041,6 +1111,10 @@ CommandOptions::usage() const {
         "    alternative to -n, or both options can be given, in which case the\n"
         "    testing is completed when either limit is reached.\n"
         "-t<report>: Delay in seconds between two periodic reports.\n"
+        "-y<series-file>: Write the rates, drops and delay percentiles of\n"
+        "    each exchange to <series-file> with every periodic report.\n"
+        "    The file is written in the JSON format (one object per line) if\n"
+        "    its name ends with '.json', in the CSV format otherwise.\n"
         "\n"
         "Errors:\n"
         "- tooshort: received a too short message\n"
@@ -229,6 +229,16 @@ public:
     /// \return local address or interface name.
     std::string getLocalName() const { return localname_; }
 
+    /// \brief Returns local addresses or interface names of all threads.
+    ///
+    /// \return local addresses or interface names in the order given.
+    std::vector<std::string> getLocalNames() const { return localnames_; }
+
+    /// \brief Returns number of threads generating the traffic.
+    ///
+    /// \return number of threads.
+    unsigned int getThreadsNum() const { return threads_; }
+
     /// \brief Checks if interface name was used.
     ///
     /// The method checks if interface name was used
@@ -317,6 +327,18 @@ public:
     /// \return wrapped command (start/stop).
     std::string getWrapped() const { return wrapped_; }
 
+    /// \brief Returns name of the time series file.
+    ///
+    /// \return name of the file or empty string if the time series
+    /// is not written.
+    std::string getTimeSeriesFile() const { return series_file_; }
+
+    /// \brief Returns maximum number of outstanding packets.
+    ///
+    /// \return maximum number of packets waiting for a response in each
+    /// exchange, zero if it isn't limited.
+    int getMaxOutstanding() const { return max_outstanding_; }
+
     /// \brief Returns server name.
     ///
     /// \return server name.
@@ -511,6 +533,12 @@ private:
     std::vector<double> max_pdrop_;
     /// Local address or interface specified with -l<value> option.
     std::string localname_;
+    /// Local addresses or interfaces of all threads, specified with
+    /// repeated -l<value> options.
+    std::vector<std::string> localnames_;
+    /// Number of threads generating the traffic, specified with
+    /// -g<value> option.
+    unsigned int threads_;
     /// Indicates that specified value with -l<value> is
     /// rather interface (not address)
     bool is_interface_;
@@ -557,6 +585,12 @@ private:
     /// Command to be executed at the beginning/end of the test.
     /// This command is expected to expose start and stop argument.
     std::string wrapped_;
+    /// Name of the file to which the time series of the statistics
+    /// is written every -t<report> seconds, specified with -y<value>.
+    std::string series_file_;
+    /// Maximum number of packets waiting for a response in each exchange,
+    /// specified with -M<value>, zero if it isn't limited.
+    int max_outstanding_;
     /// Server name specified as last argument of command line.
     std::string server_name_;
 };
@@ -0,0 +1,129 @@
+// Copyright (C) 2014 Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <exceptions/exceptions.h>
+#include "delay_histogram.h"
+
+#include <cmath>
+
+namespace {
+
+/// Number of buckets for the lowest values, each holding a single value.
+const uint64_t SUB_BUCKETS = 256;
+
+/// Number of buckets for each of the higher powers of two.
+const uint64_t HALF_SUB_BUCKETS = SUB_BUCKETS / 2;
+
+/// Highest trackable delay in microseconds.
+const uint64_t MAX_VALUE = 0xFFFFFFFF;
+
+}
+
+namespace bundy {
+namespace perfdhcp {
+
+DelayHistogram::DelayHistogram()
+    : counts_(getIndex(MAX_VALUE) + 1, 0), count_(0) {
+}
+
+void
+DelayHistogram::record(const double delay) {
+    if (delay < 0) {
+        bundy_throw(bundy::BadValue, "invalid delay " << delay
+                  << ", expected non-negative value");
+    }
+    const double usecs = delay * 1e6 + 0.5;
+    const uint64_t value = (usecs >= MAX_VALUE ? MAX_VALUE :
+                            static_cast<uint64_t>(usecs));
+    ++counts_[getIndex(value)];
+    ++count_;
+}
+
+void
+DelayHistogram::merge(const DelayHistogram& other) {
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+}
+
+void
+DelayHistogram::subtract(const DelayHistogram& other) {
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        if (counts_[i] < other.counts_[i]) {
+            bundy_throw(bundy::BadValue, "unable to subtract the histogram"
+                      " holding delays which have not been recorded");
+        }
+    }
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        counts_[i] -= other.counts_[i];
+    }
+    count_ -= other.count_;
+}
+
+double
+DelayHistogram::getPercentile(const double percentile) const {
+    if ((percentile < 0) || (percentile > 100)) {
+        bundy_throw(bundy::BadValue, "invalid percentile " << percentile
+                  << ", expected value between 0 and 100");
+    }
+    if (count_ == 0) {
+        bundy_throw(bundy::InvalidOperation, "no delays recorded");
+    }
+    // Number of the lowest delays which have to be covered, at least one.
+    uint64_t rank = static_cast<uint64_t>(ceil(percentile / 100 * count_));
+    if (rank == 0) {
+        rank = 1;
+    } else if (rank > count_) {
+        rank = count_;
+    }
+    uint64_t covered = 0;
+    size_t index = 0;
+    for (; index < counts_.size() - 1; ++index) {
+        covered += counts_[index];
+        if (covered >= rank) {
+            break;
+        }
+    }
+    return (static_cast<double>(getHighestValue(index)) / 1e6);
+}
+
+size_t
+DelayHistogram::getIndex(const uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return (value);
+    }
+    // Shift the value so as it falls into the upper half of the
+    // sub buckets. The shift identifies the power of two.
+    unsigned int shift = 1;
+    while ((value >> shift) >= SUB_BUCKETS) {
+        ++shift;
+    }
+    return (SUB_BUCKETS + (shift - 1) * HALF_SUB_BUCKETS +
+            (value >> shift) - HALF_SUB_BUCKETS);
+}
+
+uint64_t
+DelayHistogram::getHighestValue(const size_t index) {
+    if (index < SUB_BUCKETS) {
+        return (index);
+    }
+    const unsigned int shift = (index - SUB_BUCKETS) / HALF_SUB_BUCKETS + 1;
+    const uint64_t sub_bucket = (index - SUB_BUCKETS) % HALF_SUB_BUCKETS +
+        HALF_SUB_BUCKETS;
+    return (((sub_bucket + 1) << shift) - 1);
+}
+
+} // namespace perfdhcp
+} // namespace bundy
@@ -0,0 +1,103 @@
+// Copyright (C) 2014 Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef DELAY_HISTOGRAM_H
+#define DELAY_HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace bundy {
+namespace perfdhcp {
+
+/// \brief Histogram of the delays between sent and received packets.
+///
+/// The histogram is used by the Statistics Manager to calculate the
+/// percentiles of the packet delays (e.g. median, 99th percentile),
+/// which can't be derived from the minimum, maximum and average delays.
+///
+/// The delays are recorded with a microsecond resolution in the buckets
+/// laid out in the same way as in the HDR (High Dynamic Range) histogram.
+/// The delays below 256 microseconds have a bucket each. Above that, the
+/// range of each power of two is divided into 128 buckets of equal size,
+/// so the values returned by \c getPercentile are less than 1% above the
+/// actual delays. Recording a delay is thus a constant time operation
+/// and the size of the histogram doesn't depend on the number of delays.
+/// The delays above the highest trackable delay (over one hour) are
+/// recorded as the highest trackable delay.
+class DelayHistogram {
+public:
+
+    /// \brief Constructor.
+    ///
+    /// Creates an empty histogram.
+    DelayHistogram();
+
+    /// \brief Records a delay.
+    ///
+    /// \param delay delay in seconds.
+    /// \throw bundy::BadValue if the delay is negative.
+    void record(const double delay);
+
+    /// \brief Adds the delays recorded in another histogram.
+    ///
+    /// \param other histogram which delays are added.
+    void merge(const DelayHistogram& other);
+
+    /// \brief Removes the delays recorded in another histogram.
+    ///
+    /// This is used to get the histogram of the delays recorded since
+    /// the other histogram was copied from this one.
+    ///
+    /// \param other earlier copy of this histogram.
+    /// \throw bundy::BadValue if the other histogram holds delays which
+    /// have not been recorded in this histogram.
+    void subtract(const DelayHistogram& other);
+
+    /// \brief Returns the number of recorded delays.
+    uint64_t getCount() const {
+        return (count_);
+    }
+
+    /// \brief Returns the delay at the specified percentile.
+    ///
+    /// \param percentile percentile from the range of 0 to 100, e.g. 99.9.
+    /// \throw bundy::BadValue if the percentile is out of range.
+    /// \throw bundy::InvalidOperation if no delays have been recorded.
+    /// \return delay in seconds, which is not lower than the given
+    /// percentage of the recorded delays.
+    double getPercentile(const double percentile) const;
+
+private:
+
+    /// \brief Returns the index of the bucket holding a value.
+    ///
+    /// \param value delay in microseconds.
+    static size_t getIndex(const uint64_t value);
+
+    /// \brief Returns the highest value held in a bucket.
+    ///
+    /// \param index index of the bucket.
+    /// \return delay in microseconds.
+    static uint64_t getHighestValue(const size_t index);
+
+    std::vector<uint64_t> counts_; ///< Number of delays in each bucket.
+    uint64_t count_;               ///< Total number of delays.
+};
+
+} // namespace perfdhcp
+} // namespace bundy
+
+#endif // DELAY_HISTOGRAM_H
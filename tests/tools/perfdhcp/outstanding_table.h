@@ -0,0 +1,217 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef OUTSTANDING_TABLE_H
+#define OUTSTANDING_TABLE_H
+
+#include <exceptions/exceptions.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
+#include <stdint.h>
+
+namespace bundy {
+namespace perfdhcp {
+
+/// \brief Fixed-size table of the packets waiting for a response.
+///
+/// The Statistics Manager uses this table, instead of the lists of sent
+/// packets, when the memory it uses must not grow with the length of the
+/// test. The table holds at most the number of packets specified when it
+/// is created, in a ring ordered by the time at which they were sent, and
+/// indexes them by transaction id in a hash table whose chains are threaded
+/// through the ring slots. Nothing is allocated once the table is created.
+///
+/// The oldest packet is dropped from the table when a new packet is sent
+/// and the table is full, and the packets waiting for longer than the drop
+/// time are dropped from the front of the ring. Each dropped packet costs
+/// a constant time, whatever the number of packets in the table.
+///
+/// \tparam T Pkt4 or Pkt6 class, which represents DHCPv4 or DHCPv6 message
+/// respectively.
+template<typename T>
+class OutstandingTable : public boost::noncopyable {
+public:
+    /// A type which represents the pointer to a packet.
+    typedef boost::shared_ptr<T> PacketPtr;
+
+    /// \brief Constructor.
+    ///
+    /// \param capacity maximum number of packets in the table. It is
+    /// rounded up to a power of two.
+    /// \throw bundy::BadValue if the capacity is zero or too large.
+    explicit OutstandingTable(const size_t capacity) :
+        mask_(0), head_(0), tail_(0), size_(0) {
+        if ((capacity == 0) || (capacity > MAX_CAPACITY)) {
+            bundy_throw(BadValue, "capacity of the table of the outstanding"
+                        " packets must be between 1 and " << MAX_CAPACITY);
+        }
+        size_t slots = 1;
+        while (slots < capacity) {
+            slots <<= 1;
+        }
+        mask_ = slots - 1;
+        slots_.resize(slots);
+        buckets_.assign(slots, NONE);
+    }
+
+    /// \brief Adds a sent packet to the table.
+    ///
+    /// \param packet the packet sent, with its timestamp set.
+    /// \return false if the oldest packet had to be dropped to make room,
+    /// true otherwise.
+    bool insert(const PacketPtr& packet) {
+        bool room = true;
+        if (tail_ - head_ == slots_.size()) {
+            room = !drop(head_ & mask_);
+            ++head_;
+            skipEmpty();
+        }
+        const uint32_t slot = tail_ & mask_;
+        Slot& entry = slots_[slot];
+        entry.packet_ = packet;
+        entry.transid_ = packet->getTransid();
+        uint32_t& bucket = buckets_[hash(entry.transid_)];
+        entry.next_ = bucket;
+        bucket = slot;
+        ++tail_;
+        ++size_;
+        return (room);
+    }
+
+    /// \brief Removes the packet with a transaction id from the table.
+    ///
+    /// \param transid transaction id of the received packet.
+    /// \return the sent packet, or NULL if it isn't in the table.
+    PacketPtr remove(const uint32_t transid) {
+        for (uint32_t slot = buckets_[hash(transid)]; slot != NONE;
+             slot = slots_[slot].next_) {
+            if (slots_[slot].transid_ == transid) {
+                PacketPtr packet = slots_[slot].packet_;
+                drop(slot);
+                skipEmpty();
+                return (packet);
+            }
+        }
+        return (PacketPtr());
+    }
+
+    /// \brief Drops the packets which have waited too long.
+    ///
+    /// \param cutoff packets sent before this time are dropped.
+    /// \return number of packets dropped.
+    size_t expire(const boost::posix_time::ptime& cutoff) {
+        size_t dropped = 0;
+        while ((head_ != tail_) &&
+               (slots_[head_ & mask_].packet_->getTimestamp() < cutoff)) {
+            drop(head_ & mask_);
+            ++dropped;
+            ++head_;
+            skipEmpty();
+        }
+        return (dropped);
+    }
+
+    /// \brief Returns the number of packets in the table.
+    size_t size() const {
+        return (size_);
+    }
+
+    /// \brief Returns the maximum number of packets in the table.
+    size_t capacity() const {
+        return (slots_.size());
+    }
+
+private:
+    /// The largest capacity, so that a slot index fits in 32 bits.
+    static const size_t MAX_CAPACITY = 1 << 30;
+
+    /// Marks the end of a chain and an empty bucket.
+    static const uint32_t NONE = 0xffffffff;
+
+    /// \brief Slot of the ring.
+    struct Slot {
+        Slot() : transid_(0), next_(NONE) {
+        }
+
+        /// The packet sent, NULL if the slot is empty.
+        PacketPtr packet_;
+        /// Transaction id of the packet.
+        uint32_t transid_;
+        /// Next slot in the same bucket.
+        uint32_t next_;
+    };
+
+    /// \brief Returns the bucket of a transaction id.
+    ///
+    /// The multiplication by an odd number spreads sequential transaction
+    /// ids over the buckets as well as random ones.
+    uint32_t hash(const uint32_t transid) const {
+        return ((transid * 2654435761U) & mask_);
+    }
+
+    /// \brief Empties a slot and unlinks it from its bucket.
+    ///
+    /// \param slot index of the slot.
+    /// \return true if the slot held a packet.
+    bool drop(const uint32_t slot) {
+        Slot& entry = slots_[slot];
+        if (!entry.packet_) {
+            return (false);
+        }
+        uint32_t* link = &buckets_[hash(entry.transid_)];
+        while (*link != slot) {
+            link = &slots_[*link].next_;
+        }
+        *link = entry.next_;
+        entry.packet_.reset();
+        entry.next_ = NONE;
+        --size_;
+        return (true);
+    }
+
+    /// \brief Moves the front of the ring past the empty slots.
+    void skipEmpty() {
+        while ((head_ != tail_) && !slots_[head_ & mask_].packet_) {
+            ++head_;
+        }
+    }
+
+    /// The slots, in the order in which the packets were sent.
+    std::vector<Slot> slots_;
+    /// First slot of each bucket.
+    std::vector<uint32_t> buckets_;
+    /// Number of slots minus one.
+    size_t mask_;
+    /// Sequence number of the oldest slot in use.
+    uint64_t head_;
+    /// Sequence number of the next slot to use.
+    uint64_t tail_;
+    /// Number of packets in the table.
+    size_t size_;
+};
+
+template<typename T>
+const size_t OutstandingTable<T>::MAX_CAPACITY;
+
+template<typename T>
+const uint32_t OutstandingTable<T>::NONE;
+
+} // namespace perfdhcp
+} // namespace bundy
+
+#endif // OUTSTANDING_TABLE_H
@@ -18,6 +18,9 @@
 #include <dhcp/pkt4.h>
 #include <dhcp/pkt6.h>
 #include <exceptions/exceptions.h>
+#include "delay_histogram.h"
+#include "outstanding_table.h"
+#include "time_series_writer.h"
 
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
@@ -86,7 +89,7 @@ public:
             return (this_counter);
         }
 
-        const CustomCounter& operator+=(int val) {
+        const CustomCounter& operator+=(const uint64_t val) {
             counter_ += val;
             return (*this);
         }
@@ -266,10 +269,16 @@ public:
         /// \param archive_enabled if true packets archive mode is enabled.
         /// In this mode all packets are stored throughout the test execution.
         /// \param boot_time Holds the timestamp when perfdhcp has been started.
+        /// \param outstanding_limit if not zero, the sent packets are held
+        /// in a table of this size instead of the lists (see
+        /// \ref OutstandingTable) so that the memory used is bounded.
+        /// \throw bundy::BadValue if both the limit and the archive mode
+        /// are specified.
         ExchangeStats(const ExchangeType xchg_type,
                       const double drop_time,
                       const bool archive_enabled,
-                      const boost::posix_time::ptime boot_time)
+                      const boost::posix_time::ptime boot_time,
+                      const size_t outstanding_limit = 0)
             : xchg_type_(xchg_type),
               sent_packets_(),
               rcvd_packets_(),
@@ -280,6 +289,7 @@ public:
               max_delay_(0.),
               sum_delay_(0.),
               sum_delay_squared_(0.),
+              delay_histogram_(),
               orphans_(0),
               collected_(0),
               unordered_lookup_size_sum_(0),
@@ -290,6 +300,14 @@ public:
               boot_time_(boot_time)
         {
             next_sent_ = sent_packets_.begin();
+            if (outstanding_limit > 0) {
+                if (archive_enabled_) {
+                    bundy_throw(BadValue, "packets can't be archived when"
+                                " the number of outstanding packets is"
+                                " limited");
+                }
+                outstanding_.reset(new Outstanding(outstanding_limit));
+            }
         }
 
         /// \brief Add new packet to list of sent packets.
@@ -303,6 +321,20 @@ public:
                 bundy_throw(BadValue, "Packet is null");
             }
             ++sent_packets_num_;
+            if (outstanding_) {
+                // The packets which have timed out are at the front of the
+                // table, so they are dropped as new ones are sent.
+                if (drop_time_ > 0) {
+                    using namespace boost::posix_time;
+                    collected_ += outstanding_->expire(
+                        microsec_clock::universal_time() -
+                        microseconds(static_cast<int64_t>(drop_time_ * 1e6)));
+                }
+                if (!outstanding_->insert(packet)) {
+                    ++collected_;
+                }
+                return;
+            }
             sent_packets_.template get<0>().push_back(packet);
         }
 
@@ -370,6 +402,8 @@ public:
             // mean delays.
             sum_delay_ += delta;
             sum_delay_squared_ += delta * delta;
+            // Record the delay in the histogram used for percentiles.
+            delay_histogram_.record(delta);
         }
 
         /// \brief Match received packet with the corresponding sent packet.
@@ -395,6 +429,17 @@ public:
                 bundy_throw(BadValue, "Received packet is null");
             }
 
+            if (outstanding_) {
+                boost::shared_ptr<T> sent_packet =
+                    outstanding_->remove(rcvd_packet->getTransid());
+                if (!sent_packet) {
+                    ++orphans_;
+                } else {
+                    ++rcvd_packets_num_;
+                }
+                return (sent_packet);
+            }
+
             if (sent_packets_.size() == 0) {
                 // List of sent packets is empty so there is no sense
                 // to continue looking fo the packet. It also means
@@ -543,6 +588,38 @@ public:
                         getAvgDelay() * getAvgDelay()));
         }
 
+        /// \brief Return packet delay at the specified percentile.
+        ///
+        /// Method returns the delay which is not lower than the specified
+        /// percentage of the packet delays, e.g. 50 for the median delay.
+        /// The delay is calculated from the histogram of the delays, so it
+        /// is less than 1% above the actual delay.
+        ///
+        /// \param percentile percentile from the range of 0 to 100.
+        /// \throw bundy::BadValue if the percentile is out of range.
+        /// \throw bundy::InvalidOperation if no packets for this exchange
+        /// have been received yet.
+        /// \return packet delay at the percentile.
+        double getDelayPercentile(const double percentile) const {
+            return (delay_histogram_.getPercentile(percentile));
+        }
+
+        /// \brief Return histogram of packet delays.
+        ///
+        /// \return histogram holding delays of all received packets.
+        const DelayHistogram& getDelayHistogram() const {
+            return (delay_histogram_);
+        }
+
+        /// \brief Return number of packets waiting for a response.
+        ///
+        /// \return number of sent packets which haven't been matched or
+        /// garbage collected yet.
+        size_t getOutstandingNum() const {
+            return (outstanding_ ? outstanding_->size() :
+                    sent_packets_.size());
+        }
+
         /// \brief Return number of orphant packets.
         ///
         /// Method returns number of received packets that had no matching
@@ -628,6 +705,35 @@ public:
             return(drops);
         }
 
+        /// \brief Add statistics of another exchange.
+        ///
+        /// Method adds the counters and the delays collected by another
+        /// object of the same exchange type to this object. It is used to
+        /// aggregate the statistics collected by several threads when the
+        /// test has finished, so no locking is needed. The lists of packets
+        /// are not merged because the transaction ids are only unique
+        /// within each thread.
+        ///
+        /// \param other statistics to be added.
+        void merge(const ExchangeStats& other) {
+            if (other.min_delay_ < min_delay_) {
+                min_delay_ = other.min_delay_;
+            }
+            if (other.max_delay_ > max_delay_) {
+                max_delay_ = other.max_delay_;
+            }
+            sum_delay_ += other.sum_delay_;
+            sum_delay_squared_ += other.sum_delay_squared_;
+            delay_histogram_.merge(other.delay_histogram_);
+            orphans_ += other.orphans_;
+            collected_ += other.collected_;
+            unordered_lookup_size_sum_ += other.unordered_lookup_size_sum_;
+            unordered_lookups_ += other.unordered_lookups_;
+            ordered_lookups_ += other.ordered_lookups_;
+            sent_packets_num_ += other.sent_packets_num_;
+            rcvd_packets_num_ += other.rcvd_packets_num_;
+        }
+
         /// \brief Print main statistics for packet exchange.
         ///
         /// Method prints main statistics for particular exchange.
@@ -664,6 +770,12 @@ public:
                      << "max delay: " << getMaxDelay() * 1e3 << " ms" << endl
                      << "std deviation: " << getStdDevDelay() * 1e3 << " ms"
                      << endl
+                     << "p50 delay: " << getDelayPercentile(50) * 1e3
+                     << " ms" << endl
+                     << "p99 delay: " << getDelayPercentile(99) * 1e3
+                     << " ms" << endl
+                     << "p99.9 delay: " << getDelayPercentile(99.9) * 1e3
+                     << " ms" << endl
                      << "collected packets: " << getCollectedNum() << endl;
             } catch (const Exception& e) {
                 cout << "Delay summary unavailable! No packets received." << endl;
@@ -765,9 +877,16 @@ public:
              return(sent_packets_.template get<0>().erase(it));
         }
 
+        /// Table of the packets waiting for a response.
+        typedef OutstandingTable<T> Outstanding;
+
         ExchangeType xchg_type_;             ///< Packet exchange type.
         PktList sent_packets_;               ///< List of sent packets.
 
+        /// Table of the sent packets used instead of the list when the
+        /// number of outstanding packets is limited, NULL otherwise.
+        boost::shared_ptr<Outstanding> outstanding_;
+
         /// Iterator pointing to the packet on sent list which will most
         /// likely match next received packet. This is based on the
         /// assumption that server responds in order to incoming packets.
@@ -805,6 +924,8 @@ public:
                                        ///< and received packets.
         double sum_delay_squared_;     ///< Squared sum of delays between
                                        ///< sent and recived packets.
+        DelayHistogram delay_histogram_; ///< Histogram of delays between
+                                         ///< sent and received packets.
 
         uint64_t orphans_;   ///< Number of orphant received packets.
 
@@ -849,12 +970,28 @@ public:
     /// for performance reasons and to avoid waste of memory for storing
     /// large list of archived packets.
     ///
+    /// When the number of outstanding packets is limited, each exchange
+    /// holds the sent packets in a fixed-size table rather than in lists
+    /// which grow with the number of packets lost, so that long tests
+    /// with millions of clients run in a bounded memory. The packets
+    /// which don't fit are counted as garbage collected.
+    ///
     /// \param archive_enabled true indicates that packets
     /// archive mode is enabled.
-    StatsMgr(const bool archive_enabled = false) :
+    /// \param outstanding_limit maximum number of packets waiting for a
+    /// response per exchange, zero for no limit.
+    /// \throw bundy::BadValue if both the archive mode and the limit are
+    /// specified.
+    StatsMgr(const bool archive_enabled = false,
+             const size_t outstanding_limit = 0) :
         exchanges_(),
         archive_enabled_(archive_enabled),
+        outstanding_limit_(outstanding_limit),
         boot_time_(boost::posix_time::microsec_clock::universal_time()) {
+        if (archive_enabled_ && (outstanding_limit_ > 0)) {
+            bundy_throw(BadValue, "packets can't be archived when the number"
+                        " of outstanding packets is limited");
+        }
     }
 
     /// \brief Specify new exchange type.
@@ -876,7 +1013,8 @@ public:
             ExchangeStatsPtr(new ExchangeStats(xchg_type,
                                                drop_time,
                                                archive_enabled_,
-                                               boot_time_));
+                                               boot_time_,
+                                               outstanding_limit_));
     }
 
     /// \brief Check if the exchange type has been specified.
@@ -954,6 +1092,32 @@ public:
         return (*counter);
     }
 
+    /// \brief Add statistics collected by another Statistics Manager.
+    ///
+    /// Method adds the exchange statistics and the custom counters of
+    /// the other object to this object. Exchange types and counters which
+    /// don't exist in this object are added. The function is called when
+    /// the threads generating the traffic have finished, so the objects
+    /// are not locked.
+    ///
+    /// \param other Statistics Manager holding statistics to be added.
+    void merge(const StatsMgr& other) {
+        for (ExchangesMapIterator it = other.exchanges_.begin();
+             it != other.exchanges_.end(); ++it) {
+            if (!hasExchangeStats(it->first)) {
+                addExchangeStats(it->first);
+            }
+            getExchangeStats(it->first)->merge(*it->second);
+        }
+        for (CustomCountersMapIterator it = other.custom_counters_.begin();
+             it != other.custom_counters_.end(); ++it) {
+            if (custom_counters_.find(it->first) == custom_counters_.end()) {
+                addCustomCounter(it->first, it->second->getName());
+            }
+            incrementCounter(it->first, it->second->getValue());
+        }
+    }
+
     /// \brief Adds new packet to the sent packets list.
     ///
     /// Method adds new packet to the sent packets list.
@@ -1047,6 +1211,23 @@ public:
         return(xchg_stats->getStdDevDelay());
     }
 
+    /// \brief Return packet delay at the specified percentile.
+    ///
+    /// Method returns the delay which is not lower than the specified
+    /// percentage of the packet delays for specified exchange type.
+    ///
+    /// \param xchg_type exchange type.
+    /// \param percentile percentile from the range of 0 to 100.
+    /// \throw bundy::BadValue if invalid exchange type or percentile
+    /// specified.
+    /// \throw bundy::InvalidOperation if no packets have been received.
+    /// \return packet delay at the percentile.
+    double getDelayPercentile(const ExchangeType xchg_type,
+                              const double percentile) const {
+        ExchangeStatsPtr xchg_stats = getExchangeStats(xchg_type);
+        return(xchg_stats->getDelayPercentile(percentile));
+    }
+
     /// \brief Return number of orphant packets.
     ///
     /// Method returns number of orphant packets for specified
@@ -1159,6 +1340,16 @@ public:
         return(xchg_stats->getCollectedNum());
     }
 
+    /// \brief Return number of packets waiting for a response.
+    ///
+    /// \param xchg_type exchange type.
+    /// \throw bundy::BadValue if invalid exchange type specified.
+    /// \return number of sent packets neither matched nor collected yet.
+    uint64_t getOutstandingNum(const ExchangeType xchg_type) const {
+        ExchangeStatsPtr xchg_stats = getExchangeStats(xchg_type);
+        return(xchg_stats->getOutstandingNum());
+    }
+
 
     /// \brief Get time period since the start of test.
     ///
@@ -1257,6 +1448,25 @@ public:
                   << std::endl;
     }
 
+    /// \brief Write time series records.
+    ///
+    /// Method writes the record of each exchange, holding the packets
+    /// counters and the delay percentiles since the previous record.
+    ///
+    /// \param writer writer of the time series.
+    void writeTimeSeries(TimeSeriesWriter& writer) const {
+        const double elapsed =
+            getTestPeriod().length().total_nanoseconds() / 1e9;
+        for (ExchangesMapIterator it = exchanges_.begin();
+             it != exchanges_.end(); ++it) {
+            writer.write(elapsed, exchangeToString(it->first),
+                         it->second->getSentPacketsNum(),
+                         it->second->getRcvdPacketsNum(),
+                         it->second->getDroppedPacketsNum(),
+                         it->second->getDelayHistogram());
+        }
+    }
+
     /// \brief Print timestamps of all packets.
     ///
     /// Method prints timestamps of all sent and received
@@ -1335,6 +1545,10 @@ private:
     /// archived.
     bool archive_enabled_;
 
+    /// Maximum number of packets waiting for a response per exchange,
+    /// zero if it isn't limited.
+    size_t outstanding_limit_;
+
     boost::posix_time::ptime boot_time_; ///< Time when test is started.
 };
 
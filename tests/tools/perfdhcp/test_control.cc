@@ -19,20 +19,28 @@
 #include <dhcp/iface_mgr.h>
 #include <dhcp/dhcp4.h>
 #include <dhcp/option6_ia.h>
+#include <dhcp/pkt_filter_inet.h>
+#include <dhcp/pkt_filter_inet6.h>
+#include <util/threads/thread.h>
 #include <util/unittests/check_valgrind.h>
 #include "test_control.h"
 #include "command_options.h"
 #include "perf_pkt4.h"
 #include "perf_pkt6.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <fstream>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <unistd.h>
 #include <signal.h>
+#include <sys/select.h>
 #include <sys/wait.h>
 
+#include <boost/bind.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 using namespace std;
@@ -46,6 +54,36 @@ namespace perfdhcp {
 
 bool TestControl::interrupted_ = false;
 
+namespace {
+
+/// \brief Waits for a packet to arrive on a socket.
+///
+/// \param sockfd socket descriptor.
+/// \param timeout_usec timeout in microseconds.
+/// \throw bundy::Unexpected if the select() call failed.
+/// \return true if a packet can be read from the socket.
+bool
+waitForPacket(const int sockfd, const uint32_t timeout_usec) {
+    fd_set sockets;
+    FD_ZERO(&sockets);
+    FD_SET(sockfd, &sockets);
+    struct timeval select_timeout;
+    select_timeout.tv_sec = timeout_usec / 1000000;
+    select_timeout.tv_usec = timeout_usec % 1000000;
+    int result = select(sockfd + 1, &sockets, NULL, NULL, &select_timeout);
+    if (result < 0) {
+        // The select() is interrupted when the user interrupts the test.
+        if (errno == EINTR) {
+            return (false);
+        }
+        bundy_throw(Unexpected, "failed to wait for a packet on the socket "
+                    << sockfd << ": " << strerror(errno));
+    }
+    return (result > 0);
+}
+
+}
+
 TestControl::TestControlSocket::TestControlSocket(const int socket) :
     SocketInfo(asiolink::IOAddress("127.0.0.1"), 0, socket),
     ifindex_(0), valid_(true) {
@@ -93,7 +131,15 @@ TestControl::instance() {
     return (test_control);
 }
 
-TestControl::TestControl() {
+TestControl::TestControl()
+    : worker_index_(0), workers_num_(1) {
+    reset();
+}
+
+TestControl::TestControl(const unsigned int worker_index,
+                         const unsigned int workers_num)
+    : worker_index_(worker_index), workers_num_(workers_num),
+      pkt_filter_(new PktFilterInet()), pkt_filter6_(new PktFilterInet6()) {
     reset();
 }
 
@@ -216,12 +262,12 @@ TestControl::checkExitConditions() const {
     if (options.getNumRequests().size() > 0) {
         if (options.getIpVersion() == 4) {
             if (getSentPacketsNum(StatsMgr4::XCHG_DO) >=
-                options.getNumRequests()[0]) {
+                getWorkerShare(options.getNumRequests()[0])) {
                 max_requests = true;
             }
         } else if (options.getIpVersion() == 6) {
             if (stats_mgr6_->getSentPacketsNum(StatsMgr6::XCHG_SA) >=
-                options.getNumRequests()[0]) {
+                getWorkerShare(options.getNumRequests()[0])) {
                 max_requests = true;
             }
         }
@@ -230,12 +276,12 @@ TestControl::checkExitConditions() const {
     if (options.getNumRequests().size() > 1) {
         if (options.getIpVersion() == 4) {
             if (stats_mgr4_->getSentPacketsNum(StatsMgr4::XCHG_RA) >=
-                options.getNumRequests()[1]) {
+                getWorkerShare(options.getNumRequests()[1])) {
                 max_requests = true;
             }
         } else if (options.getIpVersion() == 6) {
             if (stats_mgr6_->getSentPacketsNum(StatsMgr6::XCHG_RR) >=
-                options.getNumRequests()[1]) {
+                getWorkerShare(options.getNumRequests()[1])) {
                 max_requests = true;
             }
         }
@@ -252,12 +298,12 @@ TestControl::checkExitConditions() const {
     if (options.getMaxDrop().size() > 0) {
         if (options.getIpVersion() == 4) {
             if (stats_mgr4_->getDroppedPacketsNum(StatsMgr4::XCHG_DO) >=
-                options.getMaxDrop()[0]) {
+                getWorkerShare(options.getMaxDrop()[0])) {
                 max_drops = true;
             }
         } else if (options.getIpVersion() == 6) {
             if (stats_mgr6_->getDroppedPacketsNum(StatsMgr6::XCHG_SA) >=
-                options.getMaxDrop()[0]) {
+                getWorkerShare(options.getMaxDrop()[0])) {
                 max_drops = true;
             }
         }
@@ -266,12 +312,12 @@ TestControl::checkExitConditions() const {
     if (options.getMaxDrop().size() > 1) {
         if (options.getIpVersion() == 4) {
             if (stats_mgr4_->getDroppedPacketsNum(StatsMgr4::XCHG_RA) >=
-                options.getMaxDrop()[1]) {
+                getWorkerShare(options.getMaxDrop()[1])) {
                 max_drops = true;
             }
         } else if (options.getIpVersion() == 6) {
             if (stats_mgr6_->getDroppedPacketsNum(StatsMgr6::XCHG_RR) >=
-                options.getMaxDrop()[1]) {
+                getWorkerShare(options.getMaxDrop()[1])) {
                 max_drops = true;
             }
         }
@@ -473,7 +519,9 @@ TestControl::generateMacAddress(uint8_t& randomized) const {
     if (mac_addr.size() != HW_ETHER_LEN) {
         bundy_throw(BadValue, "invalid MAC address template specified");
     }
-    uint32_t r = macaddr_gen_->generate();
+    // Each thread simulates its own part of the clients.
+    uint32_t r = macaddr_gen_->generate() +
+        static_cast<uint32_t>(getWorkerOffset(clients_num));
     randomized = 0;
     // Randomize MAC address octets.
     for (std::vector<uint8_t>::iterator it = mac_addr.end() - 1;
@@ -513,6 +561,19 @@ TestControl::generateDuid(uint8_t& randomized) const {
     return (duid);
 }
 
+uint64_t
+TestControl::getWorkerShare(const uint64_t total) const {
+    return ((total / workers_num_) +
+            (worker_index_ < total % workers_num_ ? 1 : 0));
+}
+
+uint64_t
+TestControl::getWorkerOffset(const uint64_t total) const {
+    return ((worker_index_ * (total / workers_num_)) +
+            std::min(static_cast<uint64_t>(worker_index_),
+                     total % workers_num_));
+}
+
 uint32_t
 TestControl::getCurrentTimeout() const {
     CommandOptions& options = CommandOptions::instance();
@@ -669,9 +730,11 @@ TestControl::initializeStatsMgr() {
     // requested diagnostics option -x t we have to enable
     // it so as StatsMgr preserves all packets.
     const bool archive_mode = testDiags('t') ? true : false;
+    const size_t max_outstanding = options.getMaxOutstanding();
     if (options.getIpVersion() == 4) {
         stats_mgr4_.reset();
-        stats_mgr4_ = StatsMgr4Ptr(new StatsMgr4(archive_mode));
+        stats_mgr4_ = StatsMgr4Ptr(new StatsMgr4(archive_mode,
+                                                  max_outstanding));
         stats_mgr4_->addExchangeStats(StatsMgr4::XCHG_DO,
                                       options.getDropTime()[0]);
         if (options.getExchangeMode() == CommandOptions::DORA_SARR) {
@@ -681,7 +744,8 @@ TestControl::initializeStatsMgr() {
 
     } else if (options.getIpVersion() == 6) {
         stats_mgr6_.reset();
-        stats_mgr6_ = StatsMgr6Ptr(new StatsMgr6(archive_mode));
+        stats_mgr6_ = StatsMgr6Ptr(new StatsMgr6(archive_mode,
+                                                  max_outstanding));
         stats_mgr6_->addExchangeStats(StatsMgr6::XCHG_SA,
                                       options.getDropTime()[0]);
         if (options.getExchangeMode() == CommandOptions::DORA_SARR) {
@@ -714,6 +778,12 @@ int
 TestControl::openSocket() const {
     CommandOptions& options = CommandOptions::instance();
     std::string localname = options.getLocalName();
+    bool is_interface = options.isInterface();
+    // Each thread binds its socket to its own local address or interface.
+    if (workers_num_ > 1) {
+        localname = options.getLocalNames()[worker_index_];
+        is_interface = (IfaceMgr::instance().getIface(localname) != NULL);
+    }
     std::string servername = options.getServerName();
     uint16_t port = options.getLocalPort();
     int sock = 0;
@@ -743,7 +813,7 @@ TestControl::openSocket() const {
         // CommandOptions should be already aware wether local name
         // is interface name or address because it uses IfaceMgr to
         // scan interfaces and get's their names.
-        if (options.isInterface()) {
+        if (is_interface) {
             sock = IfaceMgr::instance().openSocketFromIface(localname,
                                                             port,
                                                             family);
@@ -783,12 +853,11 @@ TestControl::openSocket() const {
                                  &hops, sizeof(hops));
             // If user specified interface name with '-l' the
             // IPV6_MULTICAST_IF has to be set.
-            if ((ret >= 0)  && options.isInterface()) {
-                Iface* iface =
-                    IfaceMgr::instance().getIface(options.getLocalName());
+            if ((ret >= 0)  && is_interface) {
+                Iface* iface = IfaceMgr::instance().getIface(localname);
                 if (iface == NULL) {
                     bundy_throw(Unexpected, "unknown interface "
-                              << options.getLocalName());
+                              << localname);
                 }
                 int idx = iface->getIndex();
                 ret = setsockopt(sock, IPPROTO_IPV6, IPV6_MULTICAST_IF,
@@ -976,6 +1045,13 @@ TestControl::printIntermediateStats() {
         } else if (options.getIpVersion() == 6) {
             stats_mgr6_->printIntermediateStats();
         }
+        if (series_writer_) {
+            if (options.getIpVersion() == 4) {
+                stats_mgr4_->writeTimeSeries(*series_writer_);
+            } else if (options.getIpVersion() == 6) {
+                stats_mgr6_->writeTimeSeries(*series_writer_);
+            }
+        }
         last_report_ = now;
     }
 }
@@ -1147,6 +1223,35 @@ TestControl::processReceivedPacket6(const TestControlSocket& socket,
     }
 }
 
+Pkt4Ptr
+TestControl::receivePacket4(const TestControlSocket& socket,
+                            const uint32_t timeout_usec) {
+    if (!pkt_filter_) {
+        return (IfaceMgr::instance().receive4(0, timeout_usec));
+    }
+    if (!waitForPacket(socket.sockfd_, timeout_usec)) {
+        return (Pkt4Ptr());
+    }
+    Iface* iface = IfaceMgr::instance().getIface(socket.ifindex_);
+    if (iface == NULL) {
+        bundy_throw(BadValue, "interface for the socket " << socket.sockfd_
+                    << " not found");
+    }
+    return (pkt_filter_->receive(*iface, socket));
+}
+
+Pkt6Ptr
+TestControl::receivePacket6(const TestControlSocket& socket,
+                            const uint32_t timeout_usec) {
+    if (!pkt_filter6_) {
+        return (IfaceMgr::instance().receive6(0, timeout_usec));
+    }
+    if (!waitForPacket(socket.sockfd_, timeout_usec)) {
+        return (Pkt6Ptr());
+    }
+    return (pkt_filter6_->receive(socket));
+}
+
 uint64_t
 TestControl::receivePackets(const TestControlSocket& socket) {
     bool receiving = true;
@@ -1155,7 +1260,7 @@ TestControl::receivePackets(const TestControlSocket& socket) {
         if (CommandOptions::instance().getIpVersion() == 4) {
             Pkt4Ptr pkt4;
             try {
-                pkt4 = IfaceMgr::instance().receive4(0, getCurrentTimeout());
+                pkt4 = receivePacket4(socket, getCurrentTimeout());
             } catch (const Exception& e) {
                 std::cerr << "Failed to receive DHCPv4 packet: "
                           << e.what() <<  std::endl;
@@ -1173,7 +1278,7 @@ TestControl::receivePackets(const TestControlSocket& socket) {
         } else if (CommandOptions::instance().getIpVersion() == 6) {
             Pkt6Ptr pkt6;
             try {
-                pkt6 = IfaceMgr::instance().receive6(0, getCurrentTimeout());
+                pkt6 = receivePacket6(socket, getCurrentTimeout());
             } catch (const Exception& e) {
                 std::cerr << "Failed to receive DHCPv6 packet: "
                           << e.what() << std::endl;
@@ -1273,11 +1378,15 @@ void
 TestControl::reset() {
     CommandOptions& options = CommandOptions::instance();
     basic_rate_control_.setAggressivity(options.getAggressivity());
-    basic_rate_control_.setRate(options.getRate());
+    // Each thread sends its own share of the messages.
+    basic_rate_control_.setRate(static_cast<int>(
+        getWorkerShare(options.getRate())));
     renew_rate_control_.setAggressivity(options.getAggressivity());
-    renew_rate_control_.setRate(options.getRenewRate());
+    renew_rate_control_.setRate(static_cast<int>(
+        getWorkerShare(options.getRenewRate())));
     release_rate_control_.setAggressivity(options.getAggressivity());
-    release_rate_control_.setRate(options.getReleaseRate());
+    release_rate_control_.setRate(static_cast<int>(
+        getWorkerShare(options.getReleaseRate())));
 
     transid_gen_.reset();
     last_report_ = microsec_clock::universal_time();
@@ -1286,6 +1395,8 @@ TestControl::reset() {
     setTransidGenerator(NumberGeneratorPtr());
     setMacAddrGenerator(NumberGeneratorPtr());
     first_packet_serverid_.clear();
+    series_writer_.reset();
+    workers_.clear();
     interrupted_ = false;
 }
 
@@ -1316,12 +1427,6 @@ TestControl::run() {
     printDiagnostics();
     // Option factories have to be registered.
     registerOptionFactories();
-    TestControlSocket socket(openSocket());
-    if (!socket.valid_) {
-        bundy_throw(Unexpected, "invalid socket descriptor");
-    }
-    // Initialize packet templates.
-    initPacketTemplates();
     // Initialize randomization seed.
     if (options.isSeeded()) {
         srandom(options.getSeed());
@@ -1335,16 +1440,106 @@ TestControl::run() {
     // If user interrupts the program we will exit gracefully.
     signal(SIGINT, TestControl::handleInterrupt);
 
-    // Preload server with the number of packets.
-    sendPackets(socket, options.getPreload(), true);
+    if (options.getThreadsNum() > 1) {
+        runWorkers();
+
+    } else {
+        TestControlSocket socket(openSocket());
+        if (!socket.valid_) {
+            bundy_throw(Unexpected, "invalid socket descriptor");
+        }
+        // Initialize packet templates.
+        initPacketTemplates();
+
+        // Preload server with the number of packets.
+        sendPackets(socket, options.getPreload(), true);
+
+        // Fork and run command specified with -w<wrapped-command>
+        if (!options.getWrapped().empty()) {
+            runWrapped();
+        }
+
+        // Initialize Statistics Manager. Release previous if any.
+        initializeStatsMgr();
+        // Open the time series file. With the -y<series-file> option,
+        // the -t<report> option guarantees that a single thread is used.
+        if (!options.getTimeSeriesFile().empty()) {
+            series_writer_.reset(
+                new TimeSeriesWriter(options.getTimeSeriesFile()));
+        }
+        runTest(socket);
+    }
+    printStats();
 
-    // Fork and run command specified with -w<wrapped-command>
     if (!options.getWrapped().empty()) {
-        runWrapped();
+        // true means that we execute wrapped command with 'stop' argument.
+        runWrapped(true);
     }
 
-    // Initialize Statistics Manager. Release previous if any.
-    initializeStatsMgr();
+    // Print packet timestamps. The packets sent by the threads are held
+    // by their own Statistics Managers.
+    if (testDiags('t')) {
+        if (workers_.empty()) {
+            if (options.getIpVersion() == 4) {
+                stats_mgr4_->printTimestamps();
+            } else if (options.getIpVersion() == 6) {
+                stats_mgr6_->printTimestamps();
+            }
+        }
+        for (unsigned int i = 0; i < workers_.size(); ++i) {
+            if (options.getIpVersion() == 4) {
+                workers_[i]->stats_mgr4_->printTimestamps();
+            } else if (options.getIpVersion() == 6) {
+                workers_[i]->stats_mgr6_->printTimestamps();
+            }
+        }
+    }
+
+    // Print server id.
+    if (testDiags('s') && (first_packet_serverid_.size() > 0)) {
+        std::cout << "Server id: " << vector2Hex(first_packet_serverid_) << std::endl;
+    }
+
+    // Diagnostics flag 'e' means show exit reason.
+    if (testDiags('e')) {
+        std::cout << "Interrupted" << std::endl;
+    }
+    // Print packet templates. Even if -T options have not been specified the
+    // dynamically build packet will be printed if at least one has been sent.
+    if (testDiags('T')) {
+        printTemplates();
+    }
+
+    int ret_code = 0;
+    // Check if any packet drops occured.
+    if (options.getIpVersion() == 4) {
+        ret_code = stats_mgr4_->droppedPackets() ? 3 : 0;
+    } else if (options.getIpVersion() == 6)  {
+        ret_code = stats_mgr6_->droppedPackets() ? 3 : 0;
+    }
+    return (ret_code);
+}
+
+void
+TestControl::runWrapped(bool do_stop /*= false */) const {
+    CommandOptions& options = CommandOptions::instance();
+    if (!options.getWrapped().empty()) {
+        pid_t pid = 0;
+        signal(SIGCHLD, handleChild);
+        pid = fork();
+        if (pid < 0) {
+            bundy_throw(Unexpected, "unable to fork");
+        } else if (pid == 0) {
+            execlp(options.getWrapped().c_str(),
+                   do_stop ? "stop" : "start",
+                   NULL);
+        }
+    }
+}
+
+void
+TestControl::runTest(const TestControlSocket& socket) {
+    CommandOptions& options = CommandOptions::instance();
     for (;;) {
         // Calculate number of packets to be sent to stay
         // catch up with rate.
@@ -1406,62 +1601,90 @@ TestControl::run() {
         // searches in the long list of Reply packets increases CPU utilization.
         cleanCachedPackets();
     }
-    printStats();
+}
 
-    if (!options.getWrapped().empty()) {
-        // true means that we execute wrapped command with 'stop' argument.
-        runWrapped(true);
-    }
+void
+TestControl::runWorkers() {
+    CommandOptions& options = CommandOptions::instance();
+    const unsigned int workers_num = options.getThreadsNum();
+    uint32_t clients_num = options.getClientsNum() == 0 ?
+        1 : options.getClientsNum();
 
-    // Print packet timestamps
-    if (testDiags('t')) {
+    // The sockets are opened and the server is preloaded before the
+    // threads are started, because the IfaceMgr is not thread safe.
+    workers_.clear();
+    std::vector<boost::shared_ptr<TestControlSocket> > sockets;
+    for (unsigned int i = 0; i < workers_num; ++i) {
+        boost::shared_ptr<TestControl> worker(new TestControl(i, workers_num));
+        // The transaction ids are only used to match the responses with
+        // the requests sent through the same socket, so the threads may
+        // use the same ids.
         if (options.getIpVersion() == 4) {
-            stats_mgr4_->printTimestamps();
-        } else if (options.getIpVersion() == 6) {
-            stats_mgr6_->printTimestamps();
-        }
+            worker->setTransidGenerator(NumberGeneratorPtr(
+                new SequentialGenerator()));
+        } else {
+            worker->setTransidGenerator(NumberGeneratorPtr(
+                new SequentialGenerator(0x00FFFFFF)));
+        }
+        worker->setMacAddrGenerator(NumberGeneratorPtr(
+            new SequentialGenerator(worker->getWorkerShare(clients_num))));
+        boost::shared_ptr<TestControlSocket>
+            socket(new TestControlSocket(worker->openSocket()));
+        if (!socket->valid_) {
+            bundy_throw(Unexpected, "invalid socket descriptor");
+        }
+        worker->initPacketTemplates();
+        worker->sendPackets(*socket,
+                            worker->getWorkerShare(options.getPreload()),
+                            true);
+        workers_.push_back(worker);
+        sockets.push_back(socket);
     }
-
-    // Print server id.
-    if (testDiags('s') && (first_packet_serverid_.size() > 0)) {
-        std::cout << "Server id: " << vector2Hex(first_packet_serverid_) << std::endl;
+    // Fork and run command specified with -w<wrapped-command>
+    if (!options.getWrapped().empty()) {
+        runWrapped();
     }
 
-    // Diagnostics flag 'e' means show exit reason.
-    if (testDiags('e')) {
-        std::cout << "Interrupted" << std::endl;
-    }
-    // Print packet templates. Even if -T options have not been specified the
-    // dynamically build packet will be printed if at least one has been sent.
-    if (testDiags('T')) {
-        printTemplates();
+    // The statistics of the threads are merged into this object's
+    // Statistics Manager, which is initialized first to hold the start
+    // time of the test.
+    initializeStatsMgr();
+    std::vector<boost::shared_ptr<util::thread::Thread> > threads;
+    for (unsigned int i = 0; i < workers_num; ++i) {
+        workers_[i]->initializeStatsMgr();
+        threads.push_back(boost::shared_ptr<util::thread::Thread>(
+            new util::thread::Thread(boost::bind(&TestControl::runTest,
+                                                 workers_[i].get(),
+                                                 boost::cref(*sockets[i])))));
+    }
+
+    // If a thread fails, stop the others and report the failure once all
+    // of them have finished.
+    std::string error;
+    for (unsigned int i = 0; i < workers_num; ++i) {
+        try {
+            threads[i]->wait();
+        } catch (const std::exception& ex) {
+            interrupted_ = true;
+            if (error.empty()) {
+                error = ex.what();
+            }
+        }
     }
-
-    int ret_code = 0;
-    // Check if any packet drops occured.
-    if (options.getIpVersion() == 4) {
-        ret_code = stats_mgr4_->droppedPackets() ? 3 : 0;
-    } else if (options.getIpVersion() == 6)  {
-        ret_code = stats_mgr6_->droppedPackets() ? 3 : 0;
+    if (!error.empty()) {
+        bundy_throw(Unexpected, "traffic generating thread failed: " << error);
     }
-    return (ret_code);
-}
 
-void
-TestControl::runWrapped(bool do_stop /*= false */) const {
-    CommandOptions& options = CommandOptions::instance();
-    if (!options.getWrapped().empty()) {
-        pid_t pid = 0;
-        signal(SIGCHLD, handleChild);
-        pid = fork();
-        if (pid < 0) {
-            bundy_throw(Unexpected, "unable to fork");
-        } else if (pid == 0) {
-            execlp(options.getWrapped().c_str(),
-                   do_stop ? "stop" : "start",
-                   NULL);
+    for (unsigned int i = 0; i < workers_num; ++i) {
+        if (options.getIpVersion() == 4) {
+            stats_mgr4_->merge(*workers_[i]->stats_mgr4_);
+        } else if (options.getIpVersion() == 6) {
+            stats_mgr6_->merge(*workers_[i]->stats_mgr6_);
         }
     }
+    first_packet_serverid_ = workers_[0]->first_packet_serverid_;
+    template_packets_v4_ = workers_[0]->template_packets_v4_;
+    template_packets_v6_ = workers_[0]->template_packets_v6_;
 }
 
 void
@@ -1515,7 +1738,7 @@ TestControl::sendDiscover4(const TestControlSocket& socket,
     pkt4->setHWAddr(HTYPE_ETHER, mac_address.size(), mac_address);
 
     pkt4->pack();
-    IfaceMgr::instance().send(pkt4);
+    sendPacket(socket, pkt4);
     if (!preload) {
         if (!stats_mgr4_) {
             bundy_throw(InvalidOperation, "Statistics Manager for DHCPv4 "
@@ -1565,7 +1788,7 @@ TestControl::sendDiscover4(const TestControlSocket& socket,
     // Pack the input packet buffer to output buffer so as it can
     // be sent to server.
     pkt4->rawPack();
-    IfaceMgr::instance().send(boost::static_pointer_cast<Pkt4>(pkt4));
+    sendPacket(socket, boost::static_pointer_cast<Pkt4>(pkt4));
     if (!preload) {
         if (!stats_mgr4_) {
             bundy_throw(InvalidOperation, "Statistics Manager for DHCPv4 "
@@ -1601,7 +1824,7 @@ TestControl::sendMessageFromReply(const uint16_t msg_type,
     setDefaults6(socket, msg);
     msg->pack();
     // And send it.
-    IfaceMgr::instance().send(msg);
+    sendPacket(socket, msg);
     if (!stats_mgr6_) {
         bundy_throw(Unexpected, "Statistics Manager for DHCPv6 "
                   "hasn't been initialized");
@@ -1611,6 +1834,34 @@ TestControl::sendMessageFromReply(const uint16_t msg_type,
     return (true);
 }
 
+void
+TestControl::sendPacket(const TestControlSocket& socket, const Pkt4Ptr& pkt) {
+    if (!pkt_filter_) {
+        IfaceMgr::instance().send(pkt);
+        return;
+    }
+    Iface* iface = IfaceMgr::instance().getIface(pkt->getIface());
+    if (iface == NULL) {
+        bundy_throw(BadValue, "unable to send DHCPv4 message, invalid"
+                    " interface " << pkt->getIface());
+    }
+    pkt_filter_->send(*iface, socket.sockfd_, pkt);
+}
+
+void
+TestControl::sendPacket(const TestControlSocket& socket, const Pkt6Ptr& pkt) {
+    if (!pkt_filter6_) {
+        IfaceMgr::instance().send(pkt);
+        return;
+    }
+    Iface* iface = IfaceMgr::instance().getIface(pkt->getIface());
+    if (iface == NULL) {
+        bundy_throw(BadValue, "unable to send DHCPv6 message, invalid"
+                    " interface " << pkt->getIface());
+    }
+    pkt_filter6_->send(*iface, socket.sockfd_, pkt);
+}
+
 void
 TestControl::sendRequest4(const TestControlSocket& socket,
                           const dhcp::Pkt4Ptr& discover_pkt4,
@@ -1662,7 +1913,7 @@ TestControl::sendRequest4(const TestControlSocket& socket,
     pkt4->setSecs(static_cast<uint16_t>(elapsed_time / 1000));
     // Prepare on wire data to send.
     pkt4->pack();
-    IfaceMgr::instance().send(pkt4);
+    sendPacket(socket, pkt4);
     if (!stats_mgr4_) {
         bundy_throw(InvalidOperation, "Statistics Manager for DHCPv4 "
                   "hasn't been initialized");
@@ -1767,7 +2018,7 @@ TestControl::sendRequest4(const TestControlSocket& socket,
     setDefaults4(socket, boost::static_pointer_cast<Pkt4>(pkt4));
     // Prepare on-wire data.
     pkt4->rawPack();
-    IfaceMgr::instance().send(boost::static_pointer_cast<Pkt4>(pkt4));
+    sendPacket(socket, boost::static_pointer_cast<Pkt4>(pkt4));
     if (!stats_mgr4_) {
         bundy_throw(InvalidOperation, "Statistics Manager for DHCPv4 "
                   "hasn't been initialized");
@@ -1822,7 +2073,7 @@ TestControl::sendRequest6(const TestControlSocket& socket,
     setDefaults6(socket, pkt6);
     // Prepare on-wire data.
     pkt6->pack();
-    IfaceMgr::instance().send(pkt6);
+    sendPacket(socket, pkt6);
     if (!stats_mgr6_) {
         bundy_throw(InvalidOperation, "Statistics Manager for DHCPv6 "
                   "hasn't been initialized");
@@ -1927,7 +2178,7 @@ TestControl::sendRequest6(const TestControlSocket& socket,
     // Prepare on wire data.
     pkt6->rawPack();
     // Send packet.
-    IfaceMgr::instance().send(pkt6);
+    sendPacket(socket, pkt6);
     if (!stats_mgr6_) {
         bundy_throw(InvalidOperation, "Statistics Manager for DHCPv6 "
                   "hasn't been initialized");
@@ -1982,7 +2233,7 @@ TestControl::sendSolicit6(const TestControlSocket& socket,
 
     setDefaults6(socket, pkt6);
     pkt6->pack();
-    IfaceMgr::instance().send(pkt6);
+    sendPacket(socket, pkt6);
     if (!preload) {
         if (!stats_mgr6_) {
             bundy_throw(InvalidOperation, "Statistics Manager for DHCPv6 "
@@ -2027,7 +2278,7 @@ TestControl::sendSolicit6(const TestControlSocket& socket,
     pkt6->rawPack();
     setDefaults6(socket, pkt6);
     // Send solicit packet.
-    IfaceMgr::instance().send(pkt6);
+    sendPacket(socket, pkt6);
     if (!preload) {
         if (!stats_mgr6_) {
             bundy_throw(InvalidOperation, "Statistics Manager for DHCPv6 "
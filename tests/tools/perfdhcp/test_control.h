@@ -18,11 +18,14 @@
 #include "packet_storage.h"
 #include "rate_control.h"
 #include "stats_mgr.h"
+#include "time_series_writer.h"
 
 #include <dhcp/iface_mgr.h>
 #include <dhcp/dhcp6.h>
 #include <dhcp/pkt4.h>
 #include <dhcp/pkt6.h>
+#include <dhcp/pkt_filter.h>
+#include <dhcp/pkt_filter6.h>
 
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
@@ -289,6 +292,18 @@ protected:
     /// only via \ref instance method.
     TestControl();
 
+    /// \brief Constructor of the object run by a thread.
+    ///
+    /// When the traffic is generated by several threads (-g<threads>),
+    /// each thread runs its own object, using its own socket, packet
+    /// filters and Statistics Manager and its own share of the rates,
+    /// the number of requests and the simulated clients.
+    ///
+    /// \param worker_index index of the thread, counted from 0.
+    /// \param workers_num number of threads.
+    TestControl(const unsigned int worker_index,
+                const unsigned int workers_num);
+
     /// \brief Check if test exit conditions fulfilled.
     ///
     /// Method checks if the test exit conditions are fulfilled.
@@ -492,6 +507,21 @@ protected:
     /// \return A current timeout in microseconds.
     uint32_t getCurrentTimeout() const;
 
+    /// \brief Returns the share of the thread in a total.
+    ///
+    /// The total is divided evenly between the threads. The remainder
+    /// is given to the threads with the lowest indexes.
+    ///
+    /// \param total total number, e.g. the rate or the number of clients.
+    /// \return share of this object's thread.
+    uint64_t getWorkerShare(const uint64_t total) const;
+
+    /// \brief Returns the offset of the thread in a total.
+    ///
+    /// \param total total number, e.g. the number of clients.
+    /// \return sum of the shares of the threads with lower indexes.
+    uint64_t getWorkerOffset(const uint64_t total) const;
+
     /// \brief Return template buffer.
     ///
     /// Method returns template buffer at specified index.
@@ -539,10 +569,32 @@ protected:
     /// \return socket descriptor.
     int openSocket() const;
 
+    /// \brief Receive a single DHCPv4 packet.
+    ///
+    /// In the single-threaded mode the packet is received by the
+    /// IfaceMgr. A thread receives the packet from its own socket,
+    /// using its own packet filter.
+    ///
+    /// \param socket socket to be used.
+    /// \param timeout_usec timeout in microseconds.
+    /// \return received packet or null pointer if no packet arrived.
+    dhcp::Pkt4Ptr receivePacket4(const TestControlSocket& socket,
+                                 const uint32_t timeout_usec);
+
+    /// \brief Receive a single DHCPv6 packet.
+    ///
+    /// \param socket socket to be used.
+    /// \param timeout_usec timeout in microseconds.
+    /// \return received packet or null pointer if no packet arrived.
+    dhcp::Pkt6Ptr receivePacket6(const TestControlSocket& socket,
+                                 const uint32_t timeout_usec);
+
     /// \brief Print intermediate statistics.
     ///
     /// Print brief statistics regarding number of sent packets,
-    /// received packets and dropped packets so far.
+    /// received packets and dropped packets so far. If the time series
+    /// file has been specified (-y<series-file>), the time series record
+    /// of each exchange is written at the same time.
     void printIntermediateStats();
 
     /// \brief Print rate statistics.
@@ -1052,6 +1104,35 @@ protected:
     /// \param do_stop execute wrapped command with "stop" argument.
     void runWrapped(bool do_stop = false) const;
 
+    /// \brief Run the main loop of the test.
+    ///
+    /// Initiates the exchanges at the configured rates and receives the
+    /// responses until the exit conditions are fulfilled.
+    ///
+    /// \param socket socket to be used.
+    void runTest(const TestControlSocket& socket);
+
+    /// \brief Run the test in several threads.
+    ///
+    /// Creates one object per thread, each with its own socket, runs
+    /// their tests and merges their statistics into this object's
+    /// Statistics Manager once all threads have finished.
+    void runWorkers();
+
+    /// \brief Send a DHCPv4 packet.
+    ///
+    /// \param socket socket to be used by a thread.
+    /// \param pkt packet to be sent.
+    void sendPacket(const TestControlSocket& socket,
+                    const dhcp::Pkt4Ptr& pkt);
+
+    /// \brief Send a DHCPv6 packet.
+    ///
+    /// \param socket socket to be used by a thread.
+    /// \param pkt packet to be sent.
+    void sendPacket(const TestControlSocket& socket,
+                    const dhcp::Pkt6Ptr& pkt);
+
     /// \brief Convert vector in hexadecimal string.
     ///
     /// \todo Consider moving this function to src/lib/util.
@@ -1070,6 +1151,9 @@ protected:
 
     boost::posix_time::ptime last_report_; ///< Last intermediate report time.
 
+    /// Writer of the time series, created if -y<series-file> is specified.
+    boost::shared_ptr<TimeSeriesWriter> series_writer_;
+
     StatsMgr4Ptr stats_mgr4_;  ///< Statistics Manager 4.
     StatsMgr6Ptr stats_mgr6_;  ///< Statistics Manager 6.
 
@@ -1089,6 +1173,20 @@ protected:
     std::map<uint8_t, dhcp::Pkt4Ptr> template_packets_v4_;
     std::map<uint8_t, dhcp::Pkt6Ptr> template_packets_v6_;
 
+    /// Index of the thread running this object.
+    unsigned int worker_index_;
+    /// Number of threads generating the traffic.
+    unsigned int workers_num_;
+
+    /// Packet filters used by a thread to send and receive the packets
+    /// through its own socket. They are not used in the single-threaded
+    /// mode, in which the packets are sent and received by the IfaceMgr.
+    boost::shared_ptr<dhcp::PktFilter> pkt_filter_;
+    boost::shared_ptr<dhcp::PktFilter6> pkt_filter6_;
+
+    /// Objects run by the threads.
+    std::vector<boost::shared_ptr<TestControl> > workers_;
+
     static bool interrupted_;  ///< Is program interrupted.
 };
 
@@ -631,6 +631,75 @@ TEST_F(CommandOptionsTest, Preload) {
                  bundy::InvalidParameter);
 }
 
+TEST_F(CommandOptionsTest, Threads) {
+    CommandOptions& opt = CommandOptions::instance();
+    // By default a single thread is used.
+    EXPECT_NO_THROW(process("perfdhcp -l 127.0.0.1 all"));
+    EXPECT_EQ(1, opt.getThreadsNum());
+    ASSERT_EQ(1, opt.getLocalNames().size());
+
+    // Each thread uses its own local address.
+    EXPECT_NO_THROW(process("perfdhcp -g 2 -l 127.0.0.1 -l 127.0.0.2"
+                            " -r 10 all"));
+    EXPECT_EQ(2, opt.getThreadsNum());
+    ASSERT_EQ(2, opt.getLocalNames().size());
+    EXPECT_EQ("127.0.0.1", opt.getLocalName());
+    EXPECT_EQ("127.0.0.1", opt.getLocalNames()[0]);
+    EXPECT_EQ("127.0.0.2", opt.getLocalNames()[1]);
+
+    // Negative test cases
+    // Number of threads must be a positive integer.
+    EXPECT_THROW(process("perfdhcp -g 0 -l 127.0.0.1 all"),
+                 bundy::InvalidParameter);
+    EXPECT_THROW(process("perfdhcp -g -2 -l 127.0.0.1 all"),
+                 bundy::InvalidParameter);
+    // Number of local addresses must match the number of threads.
+    EXPECT_THROW(process("perfdhcp -g 2 -l 127.0.0.1 all"),
+                 bundy::InvalidParameter);
+    EXPECT_THROW(process("perfdhcp -l 127.0.0.1 -l 127.0.0.2 all"),
+                 bundy::InvalidParameter);
+    // Rates must be high enough to give each thread a share.
+    EXPECT_THROW(process("perfdhcp -g 2 -l 127.0.0.1 -l 127.0.0.2"
+                         " -r 1 all"), bundy::InvalidParameter);
+    EXPECT_THROW(process("perfdhcp -g 3 -l 127.0.0.1 -l 127.0.0.2"
+                         " -l 127.0.0.3 -r 10 -R 2 all"),
+                 bundy::InvalidParameter);
+    // Periodic reports are not supported with multiple threads.
+    EXPECT_THROW(process("perfdhcp -g 2 -l 127.0.0.1 -l 127.0.0.2"
+                         " -r 10 -t 1 all"), bundy::InvalidParameter);
+}
+
+TEST_F(CommandOptionsTest, TimeSeries) {
+    CommandOptions& opt = CommandOptions::instance();
+    EXPECT_NO_THROW(process("perfdhcp -l ethx all"));
+    EXPECT_TRUE(opt.getTimeSeriesFile().empty());
+
+    EXPECT_NO_THROW(process("perfdhcp -r 10 -t 1 -y series.csv -l ethx all"));
+    EXPECT_EQ("series.csv", opt.getTimeSeriesFile());
+
+    // Negative test cases
+    // Time series is written with the periodic reports.
+    EXPECT_THROW(process("perfdhcp -r 10 -y series.csv -l ethx all"),
+                 bundy::InvalidParameter);
+}
+
+TEST_F(CommandOptionsTest, MaxOutstanding) {
+    CommandOptions& opt = CommandOptions::instance();
+    EXPECT_NO_THROW(process("perfdhcp -l ethx all"));
+    EXPECT_EQ(0, opt.getMaxOutstanding());
+
+    EXPECT_NO_THROW(process("perfdhcp -r 10 -M 1000 -l ethx all"));
+    EXPECT_EQ(1000, opt.getMaxOutstanding());
+
+    // Negative test cases
+    // The limit must be a positive integer.
+    EXPECT_THROW(process("perfdhcp -r 10 -M 0 -l ethx all"),
+                 bundy::InvalidParameter);
+    // The packets can't be archived when their number is limited.
+    EXPECT_THROW(process("perfdhcp -r 10 -M 1000 -x t -l ethx all"),
+                 bundy::InvalidParameter);
+}
+
 TEST_F(CommandOptionsTest, Seed) {
     CommandOptions& opt = CommandOptions::instance();
     EXPECT_NO_THROW(process("perfdhcp -6 -P 2 -s 23 -l ethx all"));
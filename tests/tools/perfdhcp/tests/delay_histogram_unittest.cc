@@ -0,0 +1,113 @@
+// Copyright (C) 2014 Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <exceptions/exceptions.h>
+#include "delay_histogram.h"
+#include <gtest/gtest.h>
+
+
+using namespace bundy;
+using namespace bundy::perfdhcp;
+
+namespace {
+
+// This test verifies that the percentiles can't be calculated for an
+// empty histogram and that invalid values are rejected.
+TEST(DelayHistogram, invalidValues) {
+    DelayHistogram histogram;
+    EXPECT_EQ(0, histogram.getCount());
+    EXPECT_THROW(histogram.getPercentile(50), bundy::InvalidOperation);
+
+    EXPECT_THROW(histogram.record(-0.001), bundy::BadValue);
+    EXPECT_EQ(0, histogram.getCount());
+
+    histogram.record(0.001);
+    EXPECT_THROW(histogram.getPercentile(-1), bundy::BadValue);
+    EXPECT_THROW(histogram.getPercentile(100.1), bundy::BadValue);
+    EXPECT_NO_THROW(histogram.getPercentile(0));
+    EXPECT_NO_THROW(histogram.getPercentile(100));
+}
+
+// This test verifies that the delays below 256 microseconds are held
+// with a microsecond resolution.
+TEST(DelayHistogram, lowDelays) {
+    DelayHistogram histogram;
+    for (int i = 1; i <= 100; ++i) {
+        histogram.record(i * 1e-6);
+    }
+    EXPECT_EQ(100, histogram.getCount());
+    EXPECT_DOUBLE_EQ(1e-6, histogram.getPercentile(0));
+    EXPECT_DOUBLE_EQ(1e-6, histogram.getPercentile(1));
+    EXPECT_DOUBLE_EQ(50e-6, histogram.getPercentile(50));
+    EXPECT_DOUBLE_EQ(99e-6, histogram.getPercentile(99));
+    EXPECT_DOUBLE_EQ(100e-6, histogram.getPercentile(99.9));
+    EXPECT_DOUBLE_EQ(100e-6, histogram.getPercentile(100));
+}
+
+// This test verifies that the percentiles of the higher delays are
+// less than 1% above the actual delays.
+TEST(DelayHistogram, highDelays) {
+    DelayHistogram histogram;
+    // Record the delays from 1ms to 1000ms.
+    for (int i = 1; i <= 1000; ++i) {
+        histogram.record(i * 1e-3);
+    }
+    const double percentiles[] = { 10, 50, 90, 99, 99.9, 100 };
+    const double delays[] = { 0.1, 0.5, 0.9, 0.99, 0.999, 1 };
+    const size_t percentiles_num = sizeof(percentiles) / sizeof(percentiles[0]);
+    for (size_t i = 0; i < percentiles_num; ++i) {
+        SCOPED_TRACE(percentiles[i]);
+        EXPECT_GE(histogram.getPercentile(percentiles[i]), delays[i]);
+        EXPECT_LT(histogram.getPercentile(percentiles[i]), delays[i] * 1.01);
+    }
+
+    // The delays above the highest trackable delay are not lost.
+    histogram.record(1e6);
+    EXPECT_EQ(1001, histogram.getCount());
+    EXPECT_GT(histogram.getPercentile(100), 3600);
+}
+
+// This test verifies that the histograms can be merged and subtracted.
+TEST(DelayHistogram, mergeSubtract) {
+    DelayHistogram histogram;
+    DelayHistogram other;
+    for (int i = 0; i < 90; ++i) {
+        histogram.record(0.0001);
+    }
+    for (int i = 0; i < 10; ++i) {
+        other.record(0.2);
+    }
+    histogram.merge(other);
+    EXPECT_EQ(100, histogram.getCount());
+    EXPECT_DOUBLE_EQ(0.0001, histogram.getPercentile(90));
+    EXPECT_GE(histogram.getPercentile(91), 0.2);
+
+    // The copy of the histogram is used to get the delays recorded
+    // since then.
+    DelayHistogram earlier(histogram);
+    for (int i = 0; i < 5; ++i) {
+        histogram.record(0.05);
+    }
+    DelayHistogram period(histogram);
+    ASSERT_NO_THROW(period.subtract(earlier));
+    EXPECT_EQ(5, period.getCount());
+    EXPECT_GE(period.getPercentile(0), 0.05);
+    EXPECT_LT(period.getPercentile(100), 0.0505);
+
+    // The delays which haven't been recorded can't be subtracted.
+    EXPECT_THROW(earlier.subtract(histogram), bundy::BadValue);
+    EXPECT_EQ(100, earlier.getCount());
+}
+
+}
@@ -0,0 +1,136 @@
+// Copyright (C) 2014  The Bundy Project.
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "../outstanding_table.h"
+#include <dhcp/dhcp4.h>
+#include <dhcp/pkt4.h>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using namespace bundy;
+using namespace bundy::dhcp;
+using namespace perfdhcp;
+
+typedef OutstandingTable<Pkt4> OutstandingTable4;
+
+/// Test fixture class for OutstandingTable testing.
+class OutstandingTableTest : public ::testing::Test {
+public:
+    /// \brief Constructor.
+    OutstandingTableTest() : last_(boost::posix_time::min_date_time) {
+    }
+
+    /// \brief Creates a DHCPDISCOVER with its timestamp set.
+    ///
+    /// The timestamp is later than the one of the previous packet, so
+    /// that the packets can be told apart by the time they were sent.
+    ///
+    /// \param transid Transaction id.
+    /// \return An instance of the Pkt4.
+    Pkt4Ptr createPacket4(const uint32_t transid) {
+        Pkt4Ptr packet(new Pkt4(DHCPDISCOVER, transid));
+        do {
+            packet->updateTimestamp();
+        } while (packet->getTimestamp() <= last_);
+        last_ = packet->getTimestamp();
+        return (packet);
+    }
+
+    /// Timestamp of the last packet created.
+    boost::posix_time::ptime last_;
+};
+
+// This test verifies that the capacity is rounded up to a power of two and
+// that an invalid capacity is rejected.
+TEST_F(OutstandingTableTest, capacity) {
+    EXPECT_EQ(1, OutstandingTable4(1).capacity());
+    EXPECT_EQ(8, OutstandingTable4(5).capacity());
+    EXPECT_EQ(8, OutstandingTable4(8).capacity());
+    EXPECT_THROW(OutstandingTable4(0), bundy::BadValue);
+    EXPECT_THROW(OutstandingTable4(static_cast<size_t>(1) << 31),
+                 bundy::BadValue);
+}
+
+// This test verifies that the packets are found by their transaction ids,
+// in any order, and only once.
+TEST_F(OutstandingTableTest, insertRemove) {
+    OutstandingTable4 table(64);
+    std::vector<Pkt4Ptr> packets;
+    // The transaction ids are chosen so that several of them share a bucket.
+    for (uint32_t i = 0; i < 40; ++i) {
+        packets.push_back(createPacket4(i * 64));
+        EXPECT_TRUE(table.insert(packets.back()));
+    }
+    EXPECT_EQ(40, table.size());
+
+    for (int i = 39; i >= 0; i -= 2) {
+        EXPECT_TRUE(table.remove(i * 64) == packets[i]);
+    }
+    EXPECT_EQ(20, table.size());
+    for (int i = 0; i < 40; i += 2) {
+        EXPECT_TRUE(table.remove(i * 64) == packets[i]);
+        EXPECT_FALSE(table.remove(i * 64));
+    }
+    EXPECT_EQ(0, table.size());
+    EXPECT_FALSE(table.remove(1));
+}
+
+// This test verifies that the oldest packet is dropped when the table is
+// full, unless it has already been removed.
+TEST_F(OutstandingTableTest, full) {
+    OutstandingTable4 table(4);
+    for (uint32_t i = 0; i < 4; ++i) {
+        EXPECT_TRUE(table.insert(createPacket4(i)));
+    }
+    EXPECT_FALSE(table.insert(createPacket4(4)));
+    EXPECT_EQ(4, table.size());
+    EXPECT_FALSE(table.remove(0));
+
+    // The oldest slot is reused even if a response has freed another one.
+    ASSERT_TRUE(table.remove(2));
+    EXPECT_FALSE(table.insert(createPacket4(5)));
+    EXPECT_FALSE(table.remove(1));
+    EXPECT_TRUE(table.insert(createPacket4(6)));
+    EXPECT_EQ(4, table.size());
+    EXPECT_TRUE(table.remove(3));
+    EXPECT_TRUE(table.remove(4));
+    EXPECT_TRUE(table.remove(5));
+    EXPECT_TRUE(table.remove(6));
+}
+
+// This test verifies that the packets sent before a given time are dropped.
+TEST_F(OutstandingTableTest, expire) {
+    OutstandingTable4 table(16);
+    std::vector<Pkt4Ptr> packets;
+    for (uint32_t i = 0; i < 10; ++i) {
+        packets.push_back(createPacket4(i));
+        table.insert(packets.back());
+    }
+    // The packets removed are skipped.
+    ASSERT_TRUE(table.remove(1));
+    ASSERT_TRUE(table.remove(3));
+    EXPECT_EQ(0, table.expire(packets[0]->getTimestamp()));
+    EXPECT_EQ(3, table.expire(packets[5]->getTimestamp()));
+    EXPECT_EQ(5, table.size());
+    EXPECT_FALSE(table.remove(4));
+    EXPECT_TRUE(table.remove(5));
+
+    EXPECT_EQ(4, table.expire(last_ + boost::posix_time::seconds(1)));
+    EXPECT_EQ(0, table.size());
+    EXPECT_EQ(0, table.expire(last_ + boost::posix_time::seconds(1)));
+}
+
+}
@@ -14,6 +14,9 @@
 
 #include <boost/shared_ptr.hpp>
 
+#include <algorithm>
+#include <sstream>
+
 #include <exceptions/exceptions.h>
 #include <dhcp/dhcp4.h>
 #include <dhcp/dhcp6.h>
@@ -364,6 +367,38 @@ TEST_F(StatsMgrTest, Orphans) {
     EXPECT_EQ(packets_num / 2, stats_mgr->getOrphans(StatsMgr4::XCHG_DO));
 }
 
+TEST_F(StatsMgrTest, MaxOutstanding) {
+    // The packets can't be both archived and limited.
+    EXPECT_THROW(StatsMgr4(true, 4), bundy::BadValue);
+
+    boost::scoped_ptr<StatsMgr4> stats_mgr(new StatsMgr4(false, 4));
+    stats_mgr->addExchangeStats(StatsMgr4::XCHG_DO);
+
+    // Six packets are sent, the first two don't fit in the table.
+    for (int i = 0; i < 6; ++i) {
+        boost::shared_ptr<Pkt4> sent_packet(createPacket4(DHCPDISCOVER, i));
+        ASSERT_NO_THROW(
+            stats_mgr->passSentPacket(StatsMgr4::XCHG_DO, sent_packet)
+        );
+    }
+    EXPECT_EQ(4, stats_mgr->getOutstandingNum(StatsMgr4::XCHG_DO));
+    EXPECT_EQ(2, stats_mgr->getCollectedNum(StatsMgr4::XCHG_DO));
+
+    // The responses to them are orphans, the others are matched in any
+    // order.
+    const uint32_t transid[] = { 5, 0, 3, 1, 2, 4 };
+    for (int i = 0; i < 6; ++i) {
+        boost::shared_ptr<Pkt4> rcvd_packet(createPacket4(DHCPOFFER,
+                                                          transid[i]));
+        ASSERT_NO_THROW(
+            stats_mgr->passRcvdPacket(StatsMgr4::XCHG_DO, rcvd_packet);
+        );
+    }
+    EXPECT_EQ(2, stats_mgr->getOrphans(StatsMgr4::XCHG_DO));
+    EXPECT_EQ(4, stats_mgr->getRcvdPacketsNum(StatsMgr4::XCHG_DO));
+    EXPECT_EQ(0, stats_mgr->getOutstandingNum(StatsMgr4::XCHG_DO));
+}
+
 TEST_F(StatsMgrTest, Delays) {
 
     boost::shared_ptr<StatsMgr4> stats_mgr(new StatsMgr4());
@@ -393,6 +428,43 @@ TEST_F(StatsMgrTest, Delays) {
     passDOPacketsWithDelay(stats_mgr, delay2, common_transid + 1);
     // Standard deviation is expected to be non-zero.
     EXPECT_GT(stats_mgr->getStdDevDelay(StatsMgr4::XCHG_DO), 0);
+
+    // The median is the shorter delay and the highest percentiles
+    // are the longer one.
+    EXPECT_GE(stats_mgr->getDelayPercentile(StatsMgr4::XCHG_DO, 50),
+              stats_mgr->getMinDelay(StatsMgr4::XCHG_DO));
+    EXPECT_LT(stats_mgr->getDelayPercentile(StatsMgr4::XCHG_DO, 50), 2);
+    EXPECT_GE(stats_mgr->getDelayPercentile(StatsMgr4::XCHG_DO, 99.9),
+              stats_mgr->getMaxDelay(StatsMgr4::XCHG_DO));
+}
+
+TEST_F(StatsMgrTest, DelayPercentiles) {
+    boost::shared_ptr<StatsMgr6> stats_mgr(new StatsMgr6());
+    stats_mgr->addExchangeStats(StatsMgr6::XCHG_SA);
+    // Percentiles are not available until the packets are received.
+    EXPECT_THROW(stats_mgr->getDelayPercentile(StatsMgr6::XCHG_SA, 50),
+                 InvalidOperation);
+
+    passMultiplePackets6(stats_mgr, StatsMgr6::XCHG_SA, DHCPV6_SOLICIT, 10);
+    passMultiplePackets6(stats_mgr, StatsMgr6::XCHG_SA, DHCPV6_ADVERTISE, 10,
+                         true);
+    EXPECT_LE(stats_mgr->getDelayPercentile(StatsMgr6::XCHG_SA, 50),
+              stats_mgr->getDelayPercentile(StatsMgr6::XCHG_SA, 99));
+    EXPECT_GE(stats_mgr->getDelayPercentile(StatsMgr6::XCHG_SA, 100),
+              stats_mgr->getMaxDelay(StatsMgr6::XCHG_SA));
+    EXPECT_THROW(stats_mgr->getDelayPercentile(StatsMgr6::XCHG_SA, 101),
+                 BadValue);
+    EXPECT_THROW(stats_mgr->getDelayPercentile(StatsMgr6::XCHG_RR, 50),
+                 BadValue);
+
+    // Time series record is written for each exchange.
+    std::ostringstream stream;
+    TimeSeriesWriter writer(stream, TimeSeriesWriter::CSV);
+    stats_mgr->addExchangeStats(StatsMgr6::XCHG_RR);
+    stats_mgr->writeTimeSeries(writer);
+    EXPECT_NE(std::string::npos,
+              stream.str().find(",SOLICIT-ADVERTISE,10,10,0,"));
+    EXPECT_NE(std::string::npos, stream.str().find(",REQUEST-REPLY,0,0,0,"));
 }
 
 TEST_F(StatsMgrTest, CustomCounters) {
@@ -434,6 +506,56 @@ TEST_F(StatsMgrTest, CustomCounters) {
 
 }
 
+TEST_F(StatsMgrTest, Merge) {
+    boost::shared_ptr<StatsMgr6> stats_mgr(new StatsMgr6());
+    boost::shared_ptr<StatsMgr6> other_mgr(new StatsMgr6());
+    stats_mgr->addExchangeStats(StatsMgr6::XCHG_SA);
+    other_mgr->addExchangeStats(StatsMgr6::XCHG_SA);
+    // The other Statistics Manager has an exchange and a counter which
+    // this one lacks. They should be created by the merge.
+    other_mgr->addExchangeStats(StatsMgr6::XCHG_RR);
+    other_mgr->addCustomCounter("shortwait", "Short waits for packets");
+
+    // Simulate the exchanges made by two threads.
+    passMultiplePackets6(stats_mgr, StatsMgr6::XCHG_SA, DHCPV6_SOLICIT, 10);
+    passMultiplePackets6(stats_mgr, StatsMgr6::XCHG_SA, DHCPV6_ADVERTISE, 8,
+                         true);
+    passMultiplePackets6(other_mgr, StatsMgr6::XCHG_SA, DHCPV6_SOLICIT, 5);
+    passMultiplePackets6(other_mgr, StatsMgr6::XCHG_SA, DHCPV6_ADVERTISE, 5,
+                         true);
+    passMultiplePackets6(other_mgr, StatsMgr6::XCHG_RR, DHCPV6_REQUEST, 3);
+    for (int i = 0; i < 4; ++i) {
+        other_mgr->incrementCounter("shortwait");
+    }
+
+    const double min_delay = std::min(
+        stats_mgr->getMinDelay(StatsMgr6::XCHG_SA),
+        other_mgr->getMinDelay(StatsMgr6::XCHG_SA));
+    const double max_delay = std::max(
+        stats_mgr->getMaxDelay(StatsMgr6::XCHG_SA),
+        other_mgr->getMaxDelay(StatsMgr6::XCHG_SA));
+
+    ASSERT_NO_THROW(stats_mgr->merge(*other_mgr));
+
+    // Counters are summed up.
+    EXPECT_EQ(15, stats_mgr->getSentPacketsNum(StatsMgr6::XCHG_SA));
+    EXPECT_EQ(13, stats_mgr->getRcvdPacketsNum(StatsMgr6::XCHG_SA));
+    EXPECT_EQ(2, stats_mgr->getDroppedPacketsNum(StatsMgr6::XCHG_SA));
+    // Delays are the extremes of both.
+    EXPECT_EQ(min_delay, stats_mgr->getMinDelay(StatsMgr6::XCHG_SA));
+    EXPECT_EQ(max_delay, stats_mgr->getMaxDelay(StatsMgr6::XCHG_SA));
+
+    // Missing exchanges and counters are added.
+    ASSERT_TRUE(stats_mgr->hasExchangeStats(StatsMgr6::XCHG_RR));
+    EXPECT_EQ(3, stats_mgr->getSentPacketsNum(StatsMgr6::XCHG_RR));
+    StatsMgr6::CustomCounterPtr counter = stats_mgr->getCounter("shortwait");
+    EXPECT_EQ("Short waits for packets", counter->getName());
+    EXPECT_EQ(4, counter->getValue());
+
+    // The merged Statistics Manager is left unchanged.
+    EXPECT_EQ(5, other_mgr->getSentPacketsNum(StatsMgr6::XCHG_SA));
+}
+
 TEST_F(StatsMgrTest, PrintStats) {
     std::cout << "This unit test is checking statistics printing "
               << "capabilities. It is expected that some counters "
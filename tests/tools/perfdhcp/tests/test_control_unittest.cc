@@ -24,6 +24,7 @@
 
 #include <cstddef>
 #include <stdint.h>
+#include <set>
 #include <string>
 #include <fstream>
 #include <gtest/gtest.h>
@@ -109,6 +110,8 @@ public:
     using TestControl::generateDuid;
     using TestControl::generateMacAddress;
     using TestControl::getCurrentTimeout;
+    using TestControl::getWorkerOffset;
+    using TestControl::getWorkerShare;
     using TestControl::getTemplateBuffer;
     using TestControl::initPacketTemplates;
     using TestControl::initializeStatsMgr;
@@ -139,6 +142,19 @@ public:
         setMacAddrGenerator(NumberGeneratorPtr(new TestControl::SequentialGenerator(clients_num)));
     };
 
+    /// \brief Constructor of the object run by a thread.
+    ///
+    /// \param worker_index index of the thread, counted from 0.
+    /// \param workers_num number of threads.
+    NakedTestControl(const unsigned int worker_index,
+                     const unsigned int workers_num)
+        : TestControl(worker_index, workers_num) {
+        uint32_t clients_num = CommandOptions::instance().getClientsNum() == 0 ?
+            1 : CommandOptions::instance().getClientsNum();
+        setMacAddrGenerator(NumberGeneratorPtr(
+            new TestControl::SequentialGenerator(getWorkerShare(clients_num))));
+    }
+
 };
 
 /// \brief Test Fixture Class
@@ -957,6 +973,51 @@ TEST_F(TestControlTest, GenerateMacAddress) {
     testMacAddress();
 }
 
+TEST_F(TestControlTest, WorkerShare) {
+    // A single thread gets everything.
+    NakedTestControl tc;
+    EXPECT_EQ(10, tc.getWorkerShare(10));
+    EXPECT_EQ(0, tc.getWorkerOffset(10));
+
+    // The remainder is given to the threads with the lowest indexes.
+    NakedTestControl tc0(0, 3);
+    NakedTestControl tc1(1, 3);
+    NakedTestControl tc2(2, 3);
+    EXPECT_EQ(4, tc0.getWorkerShare(10));
+    EXPECT_EQ(3, tc1.getWorkerShare(10));
+    EXPECT_EQ(3, tc2.getWorkerShare(10));
+    EXPECT_EQ(0, tc0.getWorkerOffset(10));
+    EXPECT_EQ(4, tc1.getWorkerOffset(10));
+    EXPECT_EQ(7, tc2.getWorkerOffset(10));
+
+    // The shares are even when the total is divisible.
+    EXPECT_EQ(3, tc0.getWorkerShare(9));
+    EXPECT_EQ(3, tc2.getWorkerShare(9));
+    EXPECT_EQ(6, tc2.getWorkerOffset(9));
+}
+
+TEST_F(TestControlTest, GenerateMacAddressWorkers) {
+    ASSERT_NO_THROW(processCmdLine("perfdhcp -l 127.0.0.1 -l 127.0.0.2"
+                                   " -g 2 -R 10 -r 10 all"));
+    // Each thread generates MAC addresses of its own part of the clients,
+    // so none of them is generated by both.
+    NakedTestControl tc0(0, 2);
+    NakedTestControl tc1(1, 2);
+    std::set<std::vector<uint8_t> > macs0;
+    std::set<std::vector<uint8_t> > macs1;
+    uint8_t randomized = 0;
+    for (int i = 0; i < 10; ++i) {
+        macs0.insert(tc0.generateMacAddress(randomized));
+        macs1.insert(tc1.generateMacAddress(randomized));
+    }
+    EXPECT_EQ(5, macs0.size());
+    EXPECT_EQ(5, macs1.size());
+    for (std::set<std::vector<uint8_t> >::const_iterator it = macs0.begin();
+         it != macs0.end(); ++it) {
+        EXPECT_TRUE(macs1.find(*it) == macs1.end());
+    }
+}
+
 TEST_F(TestControlTest, Options4) {
     using namespace bundy::dhcp;
     NakedTestControl tc;
@@ -0,0 +1,104 @@
+// Copyright (C) 2014 Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <exceptions/exceptions.h>
+#include "time_series_writer.h"
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+
+
+using namespace bundy;
+using namespace bundy::perfdhcp;
+
+namespace {
+
+// This test verifies that the CSV records hold the values of the period
+// since the previous record of the same exchange.
+TEST(TimeSeriesWriter, csv) {
+    std::ostringstream stream;
+    TimeSeriesWriter writer(stream, TimeSeriesWriter::CSV);
+    EXPECT_EQ(TimeSeriesWriter::CSV, writer.getFormat());
+    EXPECT_EQ("time,exchange,sent,received,drops,rate,p50,p99,p999\n",
+              stream.str());
+
+    DelayHistogram delays;
+    for (int i = 0; i < 10; ++i) {
+        delays.record(0.0001);
+    }
+    writer.write(2., "DISCOVER-OFFER", 12, 10, 2, delays);
+    // No packets have been received for the other exchange.
+    writer.write(2., "REQUEST-ACK", 0, 0, 0, DelayHistogram());
+    for (int i = 0; i < 5; ++i) {
+        delays.record(0.0002);
+    }
+    writer.write(3., "DISCOVER-OFFER", 17, 15, 2, delays);
+
+    EXPECT_EQ("time,exchange,sent,received,drops,rate,p50,p99,p999\n"
+              "2.000,DISCOVER-OFFER,12,10,2,5.000,0.100,0.100,0.100\n"
+              "2.000,REQUEST-ACK,0,0,0,0.000,,,\n"
+              "3.000,DISCOVER-OFFER,5,5,2,5.000,0.200,0.200,0.200\n",
+              stream.str());
+}
+
+// This test verifies that the JSON records are written one per line.
+TEST(TimeSeriesWriter, json) {
+    std::ostringstream stream;
+    TimeSeriesWriter writer(stream, TimeSeriesWriter::JSON);
+    EXPECT_TRUE(stream.str().empty());
+
+    DelayHistogram delays;
+    writer.write(1., "SOLICIT-ADVERTISE", 5, 0, 5, delays);
+    delays.record(0.0001);
+    writer.write(2., "SOLICIT-ADVERTISE", 10, 1, 9, delays);
+
+    EXPECT_EQ("{\"time\": 1.000, \"exchange\": \"SOLICIT-ADVERTISE\","
+              " \"sent\": 5, \"received\": 0, \"drops\": 5, \"rate\": 0.000,"
+              " \"p50\": null, \"p99\": null, \"p999\": null}\n"
+              "{\"time\": 2.000, \"exchange\": \"SOLICIT-ADVERTISE\","
+              " \"sent\": 5, \"received\": 1, \"drops\": 9, \"rate\": 1.000,"
+              " \"p50\": 0.100, \"p99\": 0.100, \"p999\": 0.100}\n",
+              stream.str());
+}
+
+// This test verifies that the format of the file is selected using the
+// extension of its name.
+TEST(TimeSeriesWriter, file) {
+    const std::string csv_file("series.csv");
+    const std::string json_file("series.json");
+    {
+        TimeSeriesWriter csv_writer(csv_file);
+        EXPECT_EQ(TimeSeriesWriter::CSV, csv_writer.getFormat());
+        TimeSeriesWriter json_writer(json_file);
+        EXPECT_EQ(TimeSeriesWriter::JSON, json_writer.getFormat());
+        json_writer.write(1., "SOLICIT-ADVERTISE", 1, 0, 1,
+                          DelayHistogram());
+    }
+    std::ifstream csv_stream(csv_file.c_str());
+    std::string line;
+    ASSERT_TRUE(std::getline(csv_stream, line));
+    EXPECT_EQ("time,exchange,sent,received,drops,rate,p50,p99,p999", line);
+    std::ifstream json_stream(json_file.c_str());
+    ASSERT_TRUE(std::getline(json_stream, line));
+    EXPECT_EQ('{', line[0]);
+    remove(csv_file.c_str());
+    remove(json_file.c_str());
+
+    EXPECT_THROW(TimeSeriesWriter("/no/such/directory/series.csv"),
+                 bundy::InvalidOperation);
+}
+
+}
@@ -0,0 +1,119 @@
+// Copyright (C) 2014 Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <exceptions/exceptions.h>
+#include "time_series_writer.h"
+
+#include <iomanip>
+
+namespace {
+
+/// Percentiles of the delays written in each record.
+const double PERCENTILES[] = { 50., 99., 99.9 };
+
+/// Names of the percentiles in the CSV header and the JSON objects.
+const char* PERCENTILE_NAMES[] = { "p50", "p99", "p999" };
+
+/// Number of the percentiles written in each record.
+const size_t PERCENTILES_NUM = sizeof(PERCENTILES) / sizeof(PERCENTILES[0]);
+
+}
+
+namespace bundy {
+namespace perfdhcp {
+
+TimeSeriesWriter::TimeSeriesWriter(const std::string& file_name)
+    : file_(), stream_(file_), format_(CSV), snapshots_() {
+    const std::string json_suffix(".json");
+    if ((file_name.size() >= json_suffix.size()) &&
+        (file_name.compare(file_name.size() - json_suffix.size(),
+                           json_suffix.size(), json_suffix) == 0)) {
+        format_ = JSON;
+    }
+    file_.open(file_name.c_str(), std::ios::out | std::ios::trunc);
+    if (!file_.is_open()) {
+        bundy_throw(bundy::InvalidOperation, "unable to open the time"
+                  " series file " << file_name);
+    }
+    initialize();
+}
+
+TimeSeriesWriter::TimeSeriesWriter(std::ostream& stream, const Format format)
+    : file_(), stream_(stream), format_(format), snapshots_() {
+    initialize();
+}
+
+void
+TimeSeriesWriter::initialize() {
+    if (format_ == CSV) {
+        stream_ << "time,exchange,sent,received,drops,rate";
+        for (size_t i = 0; i < PERCENTILES_NUM; ++i) {
+            stream_ << "," << PERCENTILE_NAMES[i];
+        }
+        stream_ << std::endl;
+    }
+}
+
+void
+TimeSeriesWriter::write(const double elapsed, const std::string& exchange,
+                        const uint64_t sent, const uint64_t rcvd,
+                        const uint64_t drops, const DelayHistogram& delays) {
+    Snapshot& snapshot = snapshots_[exchange];
+
+    // Get the values for the period since the previous record.
+    DelayHistogram period_delays(delays);
+    period_delays.subtract(snapshot.delays_);
+    const uint64_t period_sent = sent - snapshot.sent_;
+    const uint64_t period_rcvd = rcvd - snapshot.rcvd_;
+    const double period = elapsed - snapshot.elapsed_;
+    const double rate = (period > 0 ? period_rcvd / period : 0.);
+
+    stream_ << std::fixed << std::setprecision(3);
+    if (format_ == CSV) {
+        stream_ << elapsed << "," << exchange << "," << period_sent << ","
+                << period_rcvd << "," << drops << "," << rate;
+    } else {
+        stream_ << "{\"time\": " << elapsed
+                << ", \"exchange\": \"" << exchange << "\""
+                << ", \"sent\": " << period_sent
+                << ", \"received\": " << period_rcvd
+                << ", \"drops\": " << drops
+                << ", \"rate\": " << rate;
+    }
+    for (size_t i = 0; i < PERCENTILES_NUM; ++i) {
+        if (format_ == CSV) {
+            stream_ << ",";
+        } else {
+            stream_ << ", \"" << PERCENTILE_NAMES[i] << "\": ";
+        }
+        if (period_delays.getCount() > 0) {
+            stream_ << period_delays.getPercentile(PERCENTILES[i]) * 1e3;
+        } else if (format_ == JSON) {
+            stream_ << "null";
+        }
+    }
+    if (format_ == JSON) {
+        stream_ << "}";
+    }
+    // Flush each record so that the file can be followed during the test.
+    stream_ << std::endl;
+
+    snapshot.elapsed_ = elapsed;
+    snapshot.sent_ = sent;
+    snapshot.rcvd_ = rcvd;
+    snapshot.delays_ = delays;
+}
+
+} // namespace perfdhcp
+} // namespace bundy
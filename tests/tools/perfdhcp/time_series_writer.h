@@ -0,0 +1,125 @@
+// Copyright (C) 2014 Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef TIME_SERIES_WRITER_H
+#define TIME_SERIES_WRITER_H
+
+#include "delay_histogram.h"
+
+#include <boost/noncopyable.hpp>
+
+#include <fstream>
+#include <map>
+#include <ostream>
+#include <string>
+
+namespace bundy {
+namespace perfdhcp {
+
+/// \brief Writer of the time series of the exchange statistics.
+///
+/// The writer is used to record the state of the exchanges periodically
+/// during the test (see -y<series-file>), so that the changes of the
+/// server's performance can be related to the phases of the load. Each
+/// record describes a single exchange type in the period since the
+/// previous record of the same exchange type and it holds:
+/// - time since the start of the test, in seconds,
+/// - name of the exchange,
+/// - number of the packets sent and received in the period,
+/// - total number of the dropped packets,
+/// - rate of the received packets in the period, per second,
+/// - median, 99th and 99.9th percentile of the delays in the period,
+///   in milliseconds; they are empty (or null) if no packets have been
+///   received in the period.
+///
+/// The records are written in the CSV format, preceded by the header
+/// line, or in the JSON format with one object per line. Each record is
+/// flushed immediately, so the file can be read while the test is running.
+class TimeSeriesWriter : public boost::noncopyable {
+public:
+
+    /// \brief Format of the records.
+    enum Format {
+        CSV,  ///< Comma separated values with a header line.
+        JSON  ///< One JSON object per line.
+    };
+
+    /// \brief Constructor writing to a file.
+    ///
+    /// The file is truncated. The JSON format is used if the name of the
+    /// file ends with ".json", the CSV format otherwise.
+    ///
+    /// \param file_name name of the file.
+    /// \throw bundy::InvalidOperation if the file can't be opened.
+    TimeSeriesWriter(const std::string& file_name);
+
+    /// \brief Constructor writing to a stream.
+    ///
+    /// \param stream stream to write to. It must outlive the writer.
+    /// \param format format of the records.
+    TimeSeriesWriter(std::ostream& stream, const Format format);
+
+    /// \brief Returns the format of the records.
+    Format getFormat() const {
+        return (format_);
+    }
+
+    /// \brief Writes the record of an exchange.
+    ///
+    /// The counters and the histogram are the totals since the start of
+    /// the test. The writer calculates the values for the period since the
+    /// previous record of the exchange.
+    ///
+    /// \param elapsed time since the start of the test, in seconds.
+    /// \param exchange name of the exchange.
+    /// \param sent total number of sent packets.
+    /// \param rcvd total number of received packets.
+    /// \param drops total number of dropped packets.
+    /// \param delays histogram of all delays of the exchange.
+    void write(const double elapsed, const std::string& exchange,
+               const uint64_t sent, const uint64_t rcvd,
+               const uint64_t drops, const DelayHistogram& delays);
+
+private:
+
+    /// \brief Initializes the output, i.e. writes the CSV header.
+    void initialize();
+
+    /// \brief Totals of an exchange at the time of its previous record.
+    struct Snapshot {
+        /// \brief Constructor.
+        Snapshot()
+            : elapsed_(0.), sent_(0), rcvd_(0), delays_() {
+        }
+
+        double elapsed_;         ///< Time of the record.
+        uint64_t sent_;          ///< Number of sent packets.
+        uint64_t rcvd_;          ///< Number of received packets.
+        DelayHistogram delays_;  ///< Histogram of the delays.
+    };
+
+    /// Output file if the writer has been created for a file.
+    std::ofstream file_;
+    /// Stream the records are written to.
+    std::ostream& stream_;
+    /// Format of the records.
+    Format format_;
+    /// Totals of the previous records, by the exchange name.
+    std::map<std::string, Snapshot> snapshots_;
+};
+
+} // namespace perfdhcp
+} // namespace bundy
+
+#endif // TIME_SERIES_WRITER_H
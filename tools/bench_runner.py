@@ -0,0 +1,255 @@
+#!/usr/bin/env python3
+
+# Copyright (C) 2014  The Bundy Project.
+#
+# Permission to use, copy, modify, and/or distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+# REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+# AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+# INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+# LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+# OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+# PERFORMANCE OF THIS SOFTWARE.
+
+# Run the benchmark programs and compare them with a baseline
+#
+# This tool runs the benchmark programs of the tree which are built on
+# bundy::bench::BenchMark (src/lib/bench/benchmark.h), collects their results
+# in a single JSON file, and optionally compares them with the results of an
+# earlier run (the baseline), typically made with the previous release.
+#
+# The programs are run with the BUNDY_BENCH_OUTPUT environment variable set
+# to "json", so that each BenchMark prints its result, including the duration
+# of each repetition, as a line of JSON.  A result is named after the program
+# and its rank in the output of the program, with the text printed before it
+# (if any) as description.
+#
+# The time per iteration of each repetition is compared with that of the
+# baseline with Welch's t-test.  A benchmark has regressed if it is slower by
+# more than the threshold and the difference is significant, that is if the
+# probability that it is due to chance is lower than the significance level.
+#
+# Invocation:
+# The code is invoked using the command line:
+#
+# python bench_runner.py [-b <builddir>] [-s <srcdir>] [-r <repetitions>]
+#                        [-w <warmup>] [-o <output-file>] [-c <baseline>]
+#                        [-t <threshold>] [-a <significance>] [-l]
+#                        [benchmark ...]
+#
+# If no benchmark is given, all of those which are built are run.  The exit
+# status is 1 if a regression is found, 2 on error, and 0 otherwise.  "make
+# bench" in the build tree runs this tool with the values of BENCH_FLAGS.
+
+import json
+import math
+import os
+import subprocess
+import sys
+from optparse import OptionParser
+
+# The registered benchmarks: name, program relative to the build directory,
+# and arguments, in which {srcdir} is replaced by the source directory.
+# Programs which need more than the data files of the source tree (like a
+# data source configuration) aren't registered.
+BENCHMARKS = [
+    ('search', 'src/lib/bench/example/search_bench', []),
+    ('name_compare', 'src/lib/dns/benchmarks/name_compare_bench', []),
+    ('message_renderer', 'src/lib/dns/benchmarks/message_renderer_bench', []),
+    ('rdatarender', 'src/lib/dns/benchmarks/rdatarender_bench',
+     ['{srcdir}/src/lib/dns/benchmarks/benchmarkdata/rdatarender_data_com']),
+    ('rdata_reader', 'src/lib/datasrc/memory/benchmarks/rdata_reader_bench',
+     []),
+    ('rrset_render', 'src/lib/datasrc/memory/benchmarks/rrset_render_bench',
+     []),
+    ('domaintree', 'src/lib/datasrc/memory/benchmarks/domaintree_bench', []),
+    ('zone_finder', 'src/lib/datasrc/benchmarks/zone_finder_bench', []),
+    ('client_list', 'src/lib/datasrc/benchmarks/client_list_bench', []),
+    ('resolver', 'src/bin/resolver/bench/resolver-bench', [])
+]
+
+def run_benchmark(name, program, args, repetitions, warmup):
+    """Run a benchmark program and return the list of its results."""
+    env = dict(os.environ)
+    env['BUNDY_BENCH_OUTPUT'] = 'json'
+    env['BUNDY_BENCH_REPETITIONS'] = str(repetitions)
+    env['BUNDY_BENCH_WARMUP'] = str(warmup)
+    output = subprocess.check_output([program] + args, env=env,
+                                     universal_newlines=True)
+    results = []
+    description = ''
+    for line in output.splitlines():
+        start = line.find('{"')
+        if start < 0:
+            if line.strip():
+                description = line.strip()
+            continue
+        if line[:start].strip():
+            description = line[:start].strip()
+        result = json.loads(line[start:])
+        result['description'] = description
+        result['name'] = '%s/%d' % (name, len(results) + 1)
+        results.append(result)
+        description = ''
+    return results
+
+def times_per_iteration(result):
+    """Return the time per iteration of each repetition of a result."""
+    iterations = result['iterations'] / float(len(result['durations']))
+    if iterations == 0:
+        return []
+    return [duration / iterations for duration in result['durations']]
+
+def incomplete_beta(a, b, x):
+    """Regularized incomplete beta function I_x(a, b)."""
+    if x <= 0:
+        return 0.0
+    if x >= 1:
+        return 1.0
+    front = math.exp(math.lgamma(a + b) - math.lgamma(a) - math.lgamma(b) +
+                     a * math.log(x) + b * math.log(1 - x))
+    # The continued fraction converges quickly for x < (a + 1) / (a + b + 2),
+    # the symmetry relation is used otherwise.
+    if x > (a + 1) / (a + b + 2):
+        return 1 - incomplete_beta(b, a, 1 - x)
+    # Lentz's algorithm.
+    tiny = 1e-300
+    c = 1.0
+    d = 1 - (a + b) * x / (a + 1)
+    d = 1 / (d if abs(d) > tiny else tiny)
+    f = d
+    for m in range(1, 200):
+        for numerator in (m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m)),
+                          -(a + m) * (a + b + m) * x /
+                          ((a + 2 * m) * (a + 2 * m + 1))):
+            d = 1 + numerator * d
+            d = 1 / (d if abs(d) > tiny else tiny)
+            c = 1 + numerator / c
+            c = c if abs(c) > tiny else tiny
+            f *= c * d
+        if abs(c * d - 1) < 1e-12:
+            break
+    return front * f / a
+
+def welch_test(sample1, sample2):
+    """Return the two-sided p-value of Welch's t-test of two samples.
+
+    It is 1 if a sample has less than two values, and 0 if both have no
+    variance but different means."""
+    n1, n2 = len(sample1), len(sample2)
+    if n1 < 2 or n2 < 2:
+        return 1.0
+    mean1, mean2 = sum(sample1) / n1, sum(sample2) / n2
+    var1 = sum((x - mean1) ** 2 for x in sample1) / (n1 - 1) / n1
+    var2 = sum((x - mean2) ** 2 for x in sample2) / (n2 - 1) / n2
+    if var1 + var2 == 0:
+        return 1.0 if mean1 == mean2 else 0.0
+    t = (mean1 - mean2) / math.sqrt(var1 + var2)
+    df = (var1 + var2) ** 2 / (var1 ** 2 / (n1 - 1) + var2 ** 2 / (n2 - 1))
+    return incomplete_beta(df / 2, 0.5, df / (df + t * t))
+
+def compare(baseline, results, threshold, significance):
+    """Compare the results with the baseline and print the comparison.
+
+    Return the number of regressions."""
+    base = dict((result['name'], result) for result in baseline)
+    regressions = 0
+    print('%-24s %14s %14s %8s %8s' %
+          ('benchmark', 'baseline (ns)', 'current (ns)', 'change', 'p'))
+    for result in results:
+        if result['name'] not in base:
+            print('%-24s %14s' % (result['name'], 'new'))
+            continue
+        before = times_per_iteration(base[result['name']])
+        after = times_per_iteration(result)
+        if not before or not after:
+            continue
+        mean_before = sum(before) / len(before)
+        mean_after = sum(after) / len(after)
+        change = (mean_after - mean_before) / mean_before
+        p = welch_test(before, after)
+        verdict = ''
+        if p < significance and abs(change) > threshold:
+            if change > 0:
+                verdict = 'REGRESSION'
+                regressions += 1
+            else:
+                verdict = 'improvement'
+        print('%-24s %14.1f %14.1f %+7.1f%% %8.4f %s' %
+              (result['name'], mean_before * 1e9, mean_after * 1e9,
+               change * 100, p, verdict))
+    return regressions
+
+def main():
+    parser = OptionParser(usage='usage: %prog [options] [benchmark ...]')
+    parser.add_option('-b', '--builddir', default='.',
+                      help='top build directory (default: .)')
+    parser.add_option('-s', '--srcdir', default=None,
+                      help='top source directory (default: builddir)')
+    parser.add_option('-r', '--repetitions', type='int', default=10,
+                      help='repetitions of each measurement (default: 10)')
+    parser.add_option('-w', '--warmup', type='int', default=1,
+                      help='warm-up runs before measuring (default: 1)')
+    parser.add_option('-o', '--output', default=None,
+                      help='write the results to this file')
+    parser.add_option('-c', '--compare', default=None, metavar='BASELINE',
+                      help='compare with the results in this file')
+    parser.add_option('-t', '--threshold', type='float', default=5.0,
+                      help='slowdown in percent considered a regression '
+                      '(default: 5)')
+    parser.add_option('-a', '--significance', type='float', default=0.01,
+                      help='significance level of the test (default: 0.01)')
+    parser.add_option('-l', '--list', action='store_true', default=False,
+                      help='list the registered benchmarks')
+    (options, args) = parser.parse_args()
+
+    if options.list:
+        for name, program, _ in BENCHMARKS:
+            print('%-24s %s' % (name, program))
+        return 0
+    if options.repetitions < 2:
+        parser.error('at least two repetitions are needed for the comparison')
+    srcdir = options.srcdir or options.builddir
+    unknown = set(args) - set(name for name, _, _ in BENCHMARKS)
+    if unknown:
+        parser.error('unknown benchmark(s): ' + ', '.join(sorted(unknown)))
+
+    results = []
+    for name, program, program_args in BENCHMARKS:
+        if args and name not in args:
+            continue
+        path = os.path.join(options.builddir, program)
+        if not os.access(path, os.X_OK):
+            sys.stderr.write('%s: %s not built, skipped\n' % (name, path))
+            continue
+        sys.stderr.write('%s: running\n' % name)
+        try:
+            results += run_benchmark(name, path,
+                                     [arg.format(srcdir=srcdir)
+                                      for arg in program_args],
+                                     options.repetitions, options.warmup)
+        except (OSError, subprocess.CalledProcessError, ValueError) as e:
+            sys.stderr.write('%s: failed: %s\n' % (name, e))
+            return 2
+
+    if options.output:
+        with open(options.output, 'w') as f:
+            json.dump({'results': results}, f, indent=1)
+            f.write('\n')
+    else:
+        for result in results:
+            print(json.dumps(result))
+
+    if options.compare:
+        with open(options.compare) as f:
+            baseline = json.load(f)['results']
+        if compare(baseline, results, options.threshold / 100,
+                   options.significance) > 0:
+            return 1
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())